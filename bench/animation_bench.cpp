@@ -0,0 +1,261 @@
+// Skeletal animation check: packs random unit quaternions into 6 bytes (src/scene/animation.h) and reports
+// the worst angle lost, compresses a random sway clip over a chain with still joints and checks that
+// sampling at the keys gives back the source rotations, and compares skeleton_palette with palettes built
+// through 4x4 matrices (the bind pose must give the identity). Checks a clip baked for the GPU: the
+// placement times a baked frame must be the palette sampled at that frame, and between frames the lerp the
+// vertex shader does is reported against the sampled pose. Then times a crowd's poses on one thread and
+// across the job system.
+//
+// Usage: animation_bench [characters] [joints] [frames]
+
+#include "core/job_system.h"
+#include "scene/animation.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define FRAME_RATE 30.f
+#define TOLERANCE 1e-3f             // radians
+#define GRAIN 16                    // characters per job
+
+static uint32_t random_u32(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    return lo + (hi - lo) * (float)random_u32(state) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// In double, from the chord: acosf of the dot product can't resolve angles this small
+static float angle_between(quat const a, quat const b)
+{
+    const double sign = quat_mul_inner(a, b) < 0.f ? -1.0 : 1.0;
+    double chord = 0.0;
+    for (int i = 0; i < 4; ++i)
+        chord += (a[i] - sign * b[i]) * (a[i] - sign * b[i]);
+    return (float)(4.0 * asin(sqrt(chord) * 0.5));
+}
+
+static float max_difference(const mat3x4 a, const mat3x4 b)
+{
+    float worst = 0.f;
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 4; ++c)
+            worst = fmaxf(worst, fabsf(a[r][c] - b[r][c]));
+    return worst;
+}
+
+// The same palette through linmath's mat4x4 operations
+static void reference_palette(const Skeleton* s, const quat* rotations, mat3x4 const placement, mat3x4* palette)
+{
+    mat4x4 model[SKELETON_MAX_JOINTS], bind[SKELETON_MAX_JOINTS];
+    mat4x4 root;
+    mat4x4_identity(root);
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 4; ++c)
+            root[c][r] = placement[r][c];
+    for (uint32_t j = 0; j < s->joint_count; ++j)
+    {
+        mat4x4 local, translate;
+        mat4x4_translate(translate, s->rest[j][0], s->rest[j][1], s->rest[j][2]);
+        mat4x4_from_quat(local, rotations[j]);
+        mat4x4_mul(local, translate, local);
+        const bool root_joint = s->parent[j] == SKELETON_NO_PARENT;
+        mat4x4_mul(model[j], root_joint ? root : model[s->parent[j]], local);
+        if (root_joint)
+            mat4x4_dup(bind[j], translate);
+        else
+            mat4x4_mul(bind[j], bind[s->parent[j]], translate);
+        mat4x4 inverse, skin;
+        mat4x4_invert(inverse, bind[j]);
+        mat4x4_mul(skin, model[j], inverse);
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 4; ++c)
+                palette[j][r][c] = skin[c][r];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int characters = argc > 1 ? atoi(argv[1]) : 4096;
+    const int joints = argc > 2 ? atoi(argv[2]) : 32;
+    const int frames = argc > 3 ? atoi(argv[3]) : 60;
+    if (characters < 1 || joints < 2 || joints > SKELETON_MAX_JOINTS || frames < 2)
+    {
+        fprintf(stderr, "usage: %s [characters] [joints, 2 to %d] [frames, at least 2]\n", argv[0], SKELETON_MAX_JOINTS);
+        return EXIT_FAILURE;
+    }
+    unsigned int state = 1;
+    bool ok = true;
+
+    // Quaternion packing
+    float worst_pack = 0.f;
+    for (int i = 0; i < 100000; ++i)
+    {
+        quat q = { random_float(&state, -1.f, 1.f), random_float(&state, -1.f, 1.f), random_float(&state, -1.f, 1.f),
+            random_float(&state, -1.f, 1.f) };
+        quat_norm(q, q);
+        uint16_t packed[3];
+        animation_quat_pack(packed, q);
+        quat back;
+        animation_quat_unpack(back, packed);
+        worst_pack = fmaxf(worst_pack, angle_between(q, back));
+    }
+    const bool pack_ok = worst_pack < 2e-4f;
+    printf("pack:    6 bytes a key, worst %.2e rad  %s\n", worst_pack, pack_ok ? "ok" : "FAIL");
+    ok = ok && pack_ok;
+
+    // A chain along +y; every third joint stays still
+    std::vector<uint8_t> parent(joints);
+    std::vector<vec3> rest(joints);
+    for (int j = 0; j < joints; ++j)
+    {
+        parent[j] = j ? (uint8_t)(j - 1) : (uint8_t)SKELETON_NO_PARENT;
+        rest[j][0] = 0.f;
+        rest[j][1] = j ? 0.1f : 0.f;
+        rest[j][2] = 0.f;
+    }
+    Skeleton skeleton;
+    if (!skeleton_init(&skeleton, parent.data(), rest.data(), (uint32_t)joints))
+        return EXIT_FAILURE;
+    std::vector<quat> source((size_t)frames * joints);
+    std::vector<float> phase(joints), amplitude(joints);
+    for (int j = 0; j < joints; ++j)
+    {
+        phase[j] = random_float(&state, 0.f, 6.2832f);
+        amplitude[j] = j % 3 == 2 ? 0.f : random_float(&state, 0.1f, 0.6f);
+    }
+    for (int f = 0; f < frames; ++f)
+    {
+        for (int j = 0; j < joints; ++j)
+        {
+            vec3 axis = { 0.f, 0.f, 1.f };
+            quat_rotate(source[(size_t)f * joints + j], amplitude[j] * sinf(6.2832f * f / frames + phase[j]) + 0.05f * j, axis);
+        }
+    }
+    AnimationClip clip;
+    if (!animation_clip_init(&clip, source.data(), (uint32_t)joints, (uint32_t)frames, FRAME_RATE, TOLERANCE))
+        return EXIT_FAILURE;
+    const size_t raw = sizeof(quat) * source.size();
+    std::vector<quat> pose(joints);
+    float worst_key = 0.f;
+    for (int f = 0; f < frames; ++f)
+    {
+        animation_clip_sample(&clip, f / FRAME_RATE + clip.duration * (f % 3 - 1), pose.data());   // and wrapped
+        for (int j = 0; j < joints; ++j)
+            worst_key = fmaxf(worst_key, angle_between(pose[j], source[(size_t)f * joints + j]));
+    }
+    const bool clip_ok = worst_key < 2e-4f;
+    printf("clip:    %u of %d joints animated, %zu bytes from %zu (%.1fx), worst %.2e rad at the keys  %s\n",
+        clip.key_count / (uint32_t)frames, joints, animation_clip_bytes(&clip), raw,
+        (double)raw / animation_clip_bytes(&clip), worst_key, clip_ok ? "ok" : "FAIL");
+    ok = ok && clip_ok;
+
+    // Palettes against 4x4 matrices, and the bind pose
+    mat3x4 placement;
+    mat3x4_identity(placement);
+    placement[0][3] = 3.f;
+    placement[1][3] = -2.f;
+    std::vector<mat3x4> palette(joints), reference(joints);
+    float worst_palette = 0.f;
+    for (int f = 0; f < frames; ++f)
+    {
+        animation_clip_sample(&clip, (f + 0.5f) / FRAME_RATE, pose.data());
+        skeleton_palette(&skeleton, pose.data(), placement, palette.data());
+        reference_palette(&skeleton, pose.data(), placement, reference.data());
+        for (int j = 0; j < joints; ++j)
+            worst_palette = fmaxf(worst_palette, max_difference(palette[j], reference[j]));
+    }
+    for (int j = 0; j < joints; ++j)
+        quat_identity(pose[j]);
+    mat3x4 identity;
+    mat3x4_identity(identity);
+    skeleton_palette(&skeleton, pose.data(), identity, palette.data());
+    float worst_bind = 0.f;
+    for (int j = 0; j < joints; ++j)
+        worst_bind = fmaxf(worst_bind, max_difference(palette[j], identity));
+    const bool palette_ok = worst_palette < 1e-4f && worst_bind < 1e-5f;
+    printf("palette: worst %.2e from mat4x4, bind pose %.2e from identity  %s\n", worst_palette, worst_bind,
+        palette_ok ? "ok" : "FAIL");
+    ok = ok && palette_ok;
+
+    // Baked at twice the keys, as SKINNING_BAKED_GLSL reads it: placement times the lerp of the two frames around
+    const uint32_t baked_frames = 2 * (uint32_t)frames;
+    std::vector<mat3x4> baked((size_t)baked_frames * joints);
+    animation_clip_bake(&skeleton, &clip, baked_frames, baked.data());
+    float worst_at_frame = 0.f, worst_between = 0.f;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const bool at_frame = i % 2 == 0;
+        const float frame = at_frame ? (float)(random_u32(&state) % baked_frames)
+            : random_float(&state, 0.f, (float)baked_frames);
+        const uint32_t f0 = (uint32_t)frame < baked_frames ? (uint32_t)frame : baked_frames - 1;
+        const uint32_t f1 = f0 + 1 < baked_frames ? f0 + 1 : 0;
+        const float alpha = frame - (float)f0;
+        animation_clip_sample(&clip, frame / baked_frames * clip.duration, pose.data());
+        skeleton_palette(&skeleton, pose.data(), placement, reference.data());
+        for (int j = 0; j < joints; ++j)
+        {
+            mat3x4 lerped, placed;
+            for (int r = 0; r < 3; ++r)
+                for (int c = 0; c < 4; ++c)
+                    lerped[r][c] = baked[(size_t)f0 * joints + j][r][c] * (1.f - alpha)
+                        + baked[(size_t)f1 * joints + j][r][c] * alpha;
+            mat3x4_mul(placed, placement, lerped);
+            float& worst = at_frame ? worst_at_frame : worst_between;
+            worst = fmaxf(worst, max_difference(placed, reference[j]));
+        }
+    }
+    const bool bake_ok = worst_at_frame < 1e-4f;
+    printf("bake:    %u frames, %.1f KB of texture, worst %.2e at a frame, %.2e between frames  %s\n", baked_frames,
+        baked.size() * sizeof(mat3x4) / 1024.0, worst_at_frame, worst_between, bake_ok ? "ok" : "FAIL");
+    ok = ok && bake_ok;
+
+    // A crowd, one thread against the job system
+    std::vector<mat3x4> placements(characters);
+    std::vector<float> offsets(characters);
+    for (int i = 0; i < characters; ++i)
+    {
+        mat3x4_identity(placements[i]);
+        placements[i][0][3] = (float)(i % 64);
+        placements[i][1][3] = (float)(i / 64);
+        offsets[i] = random_float(&state, 0.f, clip.duration);
+    }
+    std::vector<mat3x4> palettes((size_t)characters * joints), serial((size_t)characters * joints);
+    AnimationCrowd crowd = { &skeleton, &clip, placements.data(), offsets.data(), 0.37f, serial.data() };
+    const int passes = 10;
+    double start = now_ms();
+    for (int p = 0; p < passes; ++p)
+        animation_crowd_range(&crowd, 0, (size_t)characters);
+    const double serial_ms = (now_ms() - start) / passes;
+
+    JobSystem jobs;
+    if (!job_system_init(&jobs, 0))
+        return EXIT_FAILURE;
+    crowd.palettes = palettes.data();
+    start = now_ms();
+    for (int p = 0; p < passes; ++p)
+        job_wait(&jobs, job_parallel_for(&jobs, animation_crowd_range, &crowd, (size_t)characters, GRAIN));
+    const double parallel_ms = (now_ms() - start) / passes;
+    bool same = true;
+    for (size_t i = 0; i < palettes.size() && same; ++i)
+        same = max_difference(palettes[i], serial[i]) == 0.f;
+    printf("crowd:   %d characters x %d joints, %.3f ms on 1 thread, %.3f ms on %d (%.1fx), %.1f MB of palettes  %s\n",
+        characters, joints, serial_ms, parallel_ms, jobs.thread_count, serial_ms / parallel_ms,
+        palettes.size() * sizeof(mat3x4) / 1048576.0, same ? "same" : "DIFFER");
+    ok = ok && same;
+    job_system_destroy(&jobs);
+    animation_clip_destroy(&clip);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
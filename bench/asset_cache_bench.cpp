@@ -0,0 +1,210 @@
+// Asset cache check (src/asset/asset_cache.h): asset_hash against published XXH64 values; file hashes remembered
+// by size and time, forgotten when either changes, never remembered for a file too new to trust, and kept across
+// a reopen; a cook's outputs stored, found up to date, restored byte for byte once deleted, fetched from a shared
+// cache into an empty local one, and stored once when two cooks write the same bytes. A manifest naming a file
+// outside its output directory must not restore. Times hashing, then the same files again through the stamps.
+//
+// Usage: asset_cache_bench [files] [MB per file]
+
+#include "asset/asset_cache.h"
+
+#include <chrono>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static bool write_file(const fs::path& path, const std::string& text, bool old)
+{
+    FILE* f = fopen(path.string().c_str(), "wb");
+    const bool ok = f && fwrite(text.data(), 1, text.size(), f) == text.size();
+    if (!f || fclose(f) != 0 || !ok)
+        return false;
+    std::error_code ec;
+    if (old)
+        fs::last_write_time(path, fs::file_time_type::clock::now() - std::chrono::hours(1), ec);
+    return !ec;
+}
+
+static std::string read_file(const fs::path& path)
+{
+    std::string text;
+    FILE* f = fopen(path.string().c_str(), "rb");
+    if (!f)
+        return text;
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        text.append(chunk, n);
+    fclose(f);
+    return text;
+}
+
+static size_t count_files(const fs::path& dir)
+{
+    size_t n = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+        n += it->is_regular_file(ec);
+    return n;
+}
+
+static bool hash_checks()
+{
+    const char* texts[3] = { "", "abc", "Nobody inspects the spammish repetition" };
+    const uint64_t expected[3] = { 0xef46db3751d8e999ull, 0x44bc2cf5ad770999ull, 0xfbcea83c8a378bf1ull };
+    bool ok = true;
+    for (int i = 0; i < 3; ++i)
+        ok = ok && asset_hash(0, texts[i], strlen(texts[i])) == expected[i];
+    return report("asset_hash matches XXH64", ok);
+}
+
+static bool stamp_checks(const fs::path& root)
+{
+    const fs::path cache_dir = root / "stamps";
+    const std::string old_file = (root / "old.bin").string(), new_file = (root / "new.bin").string();
+    bool ok = write_file(old_file, "the first version", true) && write_file(new_file, "just written", false);
+    AssetCache cache;
+    ok = ok && asset_cache_init(&cache, cache_dir.string().c_str(), NULL);
+    uint64_t a = 0, b = 0, c = 0, d = 0;
+    ok = ok && asset_cache_file_hash(&cache, old_file.c_str(), &a) && asset_cache_file_hash(&cache, old_file.c_str(), &b);
+    ok = report("an unchanged file is hashed once", ok && a == b && cache.hashed_files == 1 && cache.stamp_hits == 1) && ok;
+    ok = ok && asset_cache_file_hash(&cache, new_file.c_str(), &c) && asset_cache_file_hash(&cache, new_file.c_str(), &c);
+    ok = report("a just-written file is hashed every time", ok && cache.hashed_files == 3) && ok;
+    ok = ok && write_file(old_file, "the second version, longer", true) && asset_cache_file_hash(&cache, old_file.c_str(), &c);
+    ok = report("a changed file is hashed again", ok && c != a && cache.hashed_files == 4) && ok;
+    asset_cache_destroy(&cache);
+
+    ok = ok && asset_cache_init(&cache, cache_dir.string().c_str(), NULL)
+        && asset_cache_file_hash(&cache, old_file.c_str(), &d);
+    ok = report("stamps survive a reopen", ok && d == c && cache.hashed_files == 0 && cache.stamp_hits == 1) && ok;
+    asset_cache_destroy(&cache);
+    return ok;
+}
+
+static bool store_checks(const fs::path& root)
+{
+    const fs::path out = root / "out", local = root / "local", shared = root / "shared";
+    const char* names[2] = { "0_mesh.mesh", "scene.scene" };
+    const std::string contents[2] = { std::string(10000, 'm'), "a scene" };
+    std::error_code ec;
+    fs::create_directories(out, ec);
+    bool ok = write_file(out / names[0], contents[0], false) && write_file(out / names[1], contents[1], false);
+
+    AssetCache cache;
+    const uint64_t key = 0x1234;
+    ok = ok && asset_cache_init(&cache, local.string().c_str(), shared.string().c_str())
+        && asset_cache_store(&cache, key, out.string().c_str(), names, 2);
+    ok = report("the outputs are stored", ok) && ok;
+    ok = report("then they're up to date, for that key only", asset_cache_up_to_date(out.string().c_str(), key)
+        && !asset_cache_up_to_date(out.string().c_str(), key + 1)) && ok;
+
+    fs::remove(out / names[0], ec);
+    const bool missing = !asset_cache_up_to_date(out.string().c_str(), key);
+    const AssetCacheResult restored = asset_cache_restore(&cache, key, out.string().c_str());
+    ok = report("a deleted output restores from the cache", missing && restored == ASSET_CACHE_LOCAL
+        && read_file(out / names[0]) == contents[0] && asset_cache_up_to_date(out.string().c_str(), key)) && ok;
+    ok = report("an unknown cook misses", asset_cache_restore(&cache, key + 1, out.string().c_str()) == ASSET_CACHE_MISS)
+        && ok;
+
+    // The same bytes from another cook: one more action, no more blobs
+    const size_t blobs = count_files(local / "blobs");
+    ok = ok && asset_cache_store(&cache, key + 2, out.string().c_str(), names, 2);
+    ok = report("identical outputs are stored once", ok && count_files(local / "blobs") == blobs && blobs == 2) && ok;
+    asset_cache_destroy(&cache);
+
+    // A fresh local cache finds the cook in the shared one, and has it itself afterwards
+    const fs::path local2 = root / "local2", out2 = root / "out2";
+    ok = ok && asset_cache_init(&cache, local2.string().c_str(), shared.string().c_str());
+    const AssetCacheResult first = asset_cache_restore(&cache, key, out2.string().c_str());
+    fs::remove_all(out2, ec);
+    const AssetCacheResult second = asset_cache_restore(&cache, key, out2.string().c_str());
+    ok = report("the shared cache fills an empty local one", first == ASSET_CACHE_SHARED && second == ASSET_CACHE_LOCAL
+        && read_file(out2 / names[1]) == contents[1]) && ok;
+
+    // A manifest naming a file outside its directory is refused
+    char action[64];
+    snprintf(action, sizeof(action), "%016llx", (unsigned long long)(key + 3));
+    ok = ok && write_file(local2 / "actions" / action, std::string("ogt-cook 1 ") + action + "\n0 7 ../escape\n", false);
+    ok = report("a manifest leaving its directory fails", ok
+        && asset_cache_restore(&cache, key + 3, out2.string().c_str()) == ASSET_CACHE_MISS
+        && !fs::exists(root / "escape")) && ok;
+    asset_cache_destroy(&cache);
+    return ok;
+}
+
+static bool timing(const fs::path& root, int files, int mb)
+{
+    const fs::path dir = root / "inputs";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    std::string data((size_t)mb << 20, '\0');
+    unsigned int state = 1;
+    for (char& c : data)
+    {
+        state = state * 1664525u + 1013904223u;
+        c = (char)(state >> 24);
+    }
+    std::vector<std::string> paths;
+    bool ok = true;
+    for (int i = 0; i < files && ok; ++i)
+    {
+        data[0] = (char)i;
+        paths.push_back((dir / ("input" + std::to_string(i) + ".bin")).string());
+        ok = write_file(paths.back(), data, true);
+    }
+    AssetCache cache;
+    ok = ok && asset_cache_init(&cache, (root / "timing").string().c_str(), NULL);
+    uint64_t sum = 0, hash;
+    const double t0 = now_ms();
+    for (const std::string& p : paths)
+    {
+        ok = ok && asset_cache_file_hash(&cache, p.c_str(), &hash);
+        sum ^= hash;
+    }
+    const double t1 = now_ms();
+    for (const std::string& p : paths)
+    {
+        ok = ok && asset_cache_file_hash(&cache, p.c_str(), &hash);
+        sum ^= hash;
+    }
+    const double t2 = now_ms();
+    asset_cache_destroy(&cache);
+    ok = report("files hash, then all come from stamps", ok && sum == 0) && ok;
+    const double gb = (double)files * mb / 1024.0;
+    printf("  %d files, %.2f GB: hashed in %.1f ms (%.2f GB/s), through the stamps in %.2f ms (%.1f us a file)\n",
+        files, gb, t1 - t0, gb / ((t1 - t0) / 1000.0), t2 - t1, (t2 - t1) * 1000.0 / files);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int files = argc > 1 ? atoi(argv[1]) : 64;
+    const int mb = argc > 2 ? atoi(argv[2]) : 4;
+    const fs::path root = fs::temp_directory_path() / "asset_cache_bench";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root, ec);
+    bool ok = hash_checks();
+    ok = stamp_checks(root) && ok;
+    ok = store_checks(root) && ok;
+    ok = timing(root, files > 0 ? files : 1, mb > 0 ? mb : 1) && ok;
+    fs::remove_all(root, ec);
+    printf("%s\n", ok ? "asset_cache_bench: ok" : "asset_cache_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// Async I/O check (src/core/async_io.h), once per backend this machine has: a file read in 1 MB chunks, submitted
+// as one batch, comes back byte for byte with every tag; with two slots, reads needed now overtake a queue of
+// prefetches; a read over the end of the file comes back short and one of a file that isn't open fails; a poll
+// blocked with nothing in flight returns when another thread wakes it. Times the batched reads against fread.
+//
+// Usage: async_io_bench [MB]
+
+#include "core/async_io.h"
+
+#include <chrono>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#define CHUNK (1u << 20)
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static std::vector<unsigned char> random_bytes(size_t size, unsigned int seed)
+{
+    std::vector<unsigned char> data(size);
+    for (unsigned char& c : data)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        c = (unsigned char)(seed >> 24);
+    }
+    return data;
+}
+
+static bool write_file(const fs::path& path, const void* data, size_t size)
+{
+    FILE* f = fopen(path.string().c_str(), "wb");
+    const bool ok = f && fwrite(data, 1, size, f) == size;
+    return f && fclose(f) == 0 && ok;
+}
+
+// Every chunk of "file" in one submission; the completions must hand back each tag once with its whole chunk
+static bool read_chunks(AsyncIo* io, int file, unsigned char* out, size_t size)
+{
+    const uint32_t chunks = (uint32_t)((size + CHUNK - 1) / CHUNK);
+    std::vector<AsyncIoRead> reads(chunks);
+    for (uint32_t c = 0; c < chunks; ++c)
+    {
+        const size_t offset = (size_t)c * CHUNK;
+        const uint32_t n = (uint32_t)(size - offset < CHUNK ? size - offset : CHUNK);
+        reads[c] = { file, n, offset, out + offset, c, c % 2 ? ASYNC_IO_PREFETCH : ASYNC_IO_NOW, 0 };
+    }
+    if (async_io_submit(io, reads.data(), chunks) != chunks)
+        return false;
+    std::vector<bool> seen(chunks, false);
+    bool ok = true;
+    AsyncIoCompletion done[16];
+    for (uint32_t got = 0; got < chunks;)
+    {
+        const uint32_t n = async_io_poll(io, done, 16, true);
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            const uint64_t c = done[i].tag;
+            ok = ok && c < chunks && !seen[c] && done[i].result == reads[c].size;
+            if (c < chunks)
+                seen[c] = true;
+        }
+        got += n;
+    }
+    return ok && async_io_outstanding(io) == 0;
+}
+
+static bool backend_checks(AsyncIoBackend backend, const fs::path& path, const std::vector<unsigned char>& data)
+{
+    AsyncIo* io = new AsyncIo;
+    if (!async_io_init(io, backend, 8, 4) || io->backend != backend)
+    {
+        delete io;
+        return report("the backend starts", false);
+    }
+    uint64_t size = 0;
+    const int file = async_io_open(io, path.string().c_str(), false, &size);
+    bool ok = report("the file opens", file >= 0 && size == data.size());
+
+    std::vector<unsigned char> out(data.size());
+    ok = report("a batch of chunks reads back byte for byte", ok && read_chunks(io, file, out.data(), out.size())
+        && out == data) && ok;
+    async_io_destroy(io);
+
+    // Two slots, one of them kept from prefetches: what's needed now is done before prefetches queued ahead of it
+    ok = async_io_init(io, backend, 2, 1) && ok;
+    const int small = async_io_open(io, path.string().c_str(), false, &size);
+    std::vector<unsigned char> buffers(32 * 4096);
+    std::vector<AsyncIoRead> reads;
+    for (uint32_t i = 0; i < 32; ++i)
+        reads.push_back({ small, 4096, (uint64_t)i * 4096, buffers.data() + i * 4096, i, i < 24 ? ASYNC_IO_PREFETCH : ASYNC_IO_NOW, 0 });
+    async_io_submit(io, reads.data(), 24);
+    async_io_submit(io, reads.data() + 24, 8);
+    std::vector<uint64_t> order;
+    AsyncIoCompletion done[32];
+    while (order.size() < 32)
+    {
+        const uint32_t n = async_io_poll(io, done, 32, true);
+        for (uint32_t i = 0; i < n; ++i)
+            order.push_back(done[i].tag);
+    }
+    // The first prefetch may already be in flight; every NOW read still finishes before the last prefetches
+    size_t last_now = 0;
+    for (size_t i = 0; i < order.size(); ++i)
+        if (order[i] >= 24)
+            last_now = i;
+    ok = report("reads needed now overtake prefetches", last_now < 12) && ok;
+
+    // Past the end, and a file that isn't open
+    const AsyncIoRead edge[2] = { { small, 8192, data.size() - 1000, buffers.data(), 1, ASYNC_IO_NOW, 0 },
+        { 40, 4096, 0, buffers.data() + 8192, 2, ASYNC_IO_NOW, 0 } };
+    async_io_submit(io, edge, 2);
+    int64_t results[3] = { 0, 0, 0 };
+    for (uint32_t got = 0; got < 2;)
+    {
+        const uint32_t n = async_io_poll(io, done, 32, true);
+        for (uint32_t i = 0; i < n; ++i)
+            if (done[i].tag < 3)
+                results[done[i].tag] = done[i].result;
+        got += n;
+    }
+    ok = report("a read over the end comes back short",
+        results[1] == 1000 && !memcmp(buffers.data(), data.data() + data.size() - 1000, 1000)) && ok;
+    ok = report("a read of a file that isn't open fails", results[2] == -1) && ok;
+
+    // Nothing in flight: a blocking poll only returns for the wake
+    std::thread waker([io] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        async_io_wake(io);
+    });
+    const double t0 = now_ms();
+    const uint32_t n = async_io_poll(io, done, 32, true);
+    const double waited = now_ms() - t0;
+    waker.join();
+    ok = report("a wake ends a blocking poll", n == 0 && waited >= 40.0 && async_io_poll(io, done, 32, false) == 0) && ok;
+    async_io_destroy(io);
+    delete io;
+    return ok;
+}
+
+static bool timing(AsyncIoBackend backend, const fs::path& path, const std::vector<unsigned char>& data)
+{
+    AsyncIo* io = new AsyncIo;
+    std::vector<unsigned char> out(data.size());
+    bool ok = async_io_init(io, backend, 32, 4);
+    uint64_t size = 0;
+    const int file = ok ? async_io_open(io, path.string().c_str(), false, &size) : -1;
+    const double t0 = now_ms();
+    ok = file >= 0 && read_chunks(io, file, out.data(), out.size());
+    const double t1 = now_ms();
+    const uint32_t submissions = io->submissions;
+    async_io_destroy(io);
+    delete io;
+    ok = ok && out == data;
+    printf("  %-10s %6.1f ms, %.2f GB/s, %u reads in %u submissions\n", async_io_backend_name(backend), t1 - t0,
+        data.size() / 1e9 / ((t1 - t0) / 1000.0), (uint32_t)((data.size() + CHUNK - 1) / CHUNK), submissions);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int mb = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 64;
+    const fs::path root = fs::temp_directory_path() / "async_io_bench";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root, ec);
+    const fs::path path = root / "data.bin";
+    const std::vector<unsigned char> data = random_bytes((size_t)mb * CHUNK + 777, 3);
+    bool ok = write_file(path, data.data(), data.size());
+
+    // Only the backends that start here: asking for one that doesn't falls back to threads, with its warning
+    std::vector<AsyncIoBackend> backends = { ASYNC_IO_THREADS };
+    AsyncIo* probe = new AsyncIo;
+    if (async_io_init(probe, ASYNC_IO_AUTO, 1, 1) && probe->backend != ASYNC_IO_THREADS)
+        backends.push_back(probe->backend);
+    async_io_destroy(probe);
+    delete probe;
+    for (AsyncIoBackend backend : backends)
+    {
+        printf("%s:\n", async_io_backend_name(backend));
+        ok = backend_checks(backend, path, data) && ok;
+    }
+
+    // File cache warm, so this times the submission path and copies, not the disk
+    printf("reading %d MB in 1 MB chunks:\n", mb);
+    std::vector<unsigned char> out(data.size());
+    const double t0 = now_ms();
+    FILE* f = fopen(path.string().c_str(), "rb");
+    size_t total = 0, n;
+    while (f && (n = fread(out.data() + total, 1, out.size() - total < CHUNK ? out.size() - total : CHUNK, f)) > 0)
+        total += n;
+    if (f)
+        fclose(f);
+    const double t1 = now_ms();
+    printf("  %-10s %6.1f ms, %.2f GB/s\n", "fread", t1 - t0, data.size() / 1e9 / ((t1 - t0) / 1000.0));
+    for (AsyncIoBackend backend : backends)
+        ok = timing(backend, path, data) && ok;
+    ok = report("every timed read checks out", ok && total == data.size()) && ok;
+
+    fs::remove_all(root, ec);
+    printf("%s\n", ok ? "async_io_bench: ok" : "async_io_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+// Benchmark scene check (src/scene/bench_scene.h): makes every preset (or the one given, knobs and all) twice
+// and checks the two are the same, that the meshes, materials and translucent share are what was asked, that
+// every box holds its object and that a hierarchy's parents come first. Dynamic ones are then animated: every
+// child must keep its distance to its parent. Times the generation, the BVH build over it and, per tick, the
+// animation and the BVH refit after it - the CPU side of each preset's scaling curve.
+//
+// Usage: bench_scene_bench [preset[,knob=value...]] [ticks]
+
+#include "scene/bench_scene.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-46s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static uint64_t scene_hash(const BenchScene* bs)
+{
+    uint64_t h = 1469598103934665603ull;
+    const auto mix = [&h](const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i)
+            h = (h ^ bytes[i]) * 1099511628211ull;
+    };
+    mix(bs->x, sizeof(float) * bs->count);
+    mix(bs->y, sizeof(float) * bs->count);
+    mix(bs->angle, sizeof(float) * bs->count);
+    mix(bs->mesh, sizeof(uint32_t) * bs->count);
+    mix(bs->material, sizeof(uint32_t) * bs->count);
+    mix(bs->translucent, bs->count);
+    return h;
+}
+
+static bool boxes_hold(const BenchScene* bs)
+{
+    for (uint32_t i = 0; i < bs->count; ++i)
+    {
+        const Aabb* b = &bs->bounds[i];
+        if (!(b->min[0] <= bs->x[i] && bs->x[i] <= b->max[0] && b->min[1] <= bs->y[i] && bs->y[i] <= b->max[1])
+            || fabsf(bs->x[i]) > 1.5f || fabsf(bs->y[i]) > 1.5f)
+            return false;
+    }
+    return true;
+}
+
+// Every child's distance to its parent, in the world, against its local offset
+static bool links_hold(const BenchScene* bs)
+{
+    const TransformHierarchy* h = &bs->hierarchy;
+    for (uint32_t i = 0; i < h->count; ++i)
+    {
+        if (h->parent[i] == TRANSFORM_NO_PARENT)
+            continue;
+        const float dx = bs->x[i] - bs->x[h->parent[i]], dy = bs->y[i] - bs->y[h->parent[i]];
+        const float local = sqrtf(h->local[i].t[0] * h->local[i].t[0] + h->local[i].t[1] * h->local[i].t[1]);
+        if (fabsf(sqrtf(dx * dx + dy * dy) - local) > 1e-4f)
+            return false;
+    }
+    return true;
+}
+
+static bool run(const BenchSceneParams* params, int ticks)
+{
+    printf("%s\n", params->name);
+    BenchScene a, b;
+    double t = now_ms();
+    if (!bench_scene_generate(&a, params, 1.f))
+        return false;
+    const double generate_ms = now_ms() - t;
+    bool ok = report("it's the same scene every time", bench_scene_generate(&b, params, 1.f)
+        && scene_hash(&a) == scene_hash(&b));
+    bench_scene_destroy(&b);
+
+    bool in_range = a.count == params->objects;
+    for (uint32_t i = 0; i < a.count; ++i)
+        in_range = in_range && a.mesh[i] < a.params.meshes && a.material[i] < a.params.materials;
+    ok = report("meshes and materials are below their counts", in_range) && ok;
+    const double share = (double)a.translucent_count / a.count;
+    ok = report("the translucent share is the one asked for",
+        fabs(share - a.params.translucent) <= (a.count >= 10000 ? 0.02 : 0.2)) && ok;
+    ok = report("every box holds its object, near the view", boxes_hold(&a)) && ok;
+    if (a.params.depth)
+    {
+        bool ordered = a.hierarchy.count == a.count;
+        for (uint32_t i = 0; i < a.hierarchy.count && ordered; ++i)
+            ordered = a.hierarchy.parent[i] == TRANSFORM_NO_PARENT || a.hierarchy.parent[i] < i;
+        ok = report("parents come before their children", ordered) && ok;
+    }
+
+    Bvh bvh;
+    if (!bvh_init(&bvh, a.count))
+    {
+        bench_scene_destroy(&a);
+        return false;
+    }
+    t = now_ms();
+    bvh_build(&bvh, a.bounds, a.count);
+    const double build_ms = now_ms() - t;
+
+    double animate_ms = 0.0, refit_ms = 0.0;
+    if (a.moving)
+    {
+        const float x0 = a.x[a.count - 1], y0 = a.y[a.count - 1];
+        for (int k = 1; k <= ticks; ++k)
+        {
+            t = now_ms();
+            bench_scene_animate(&a, k / 60.0);
+            const double animated = now_ms();
+            bvh_refit(&bvh, a.bounds);
+            refit_ms += now_ms() - animated;
+            animate_ms += animated - t;
+        }
+        ok = report("animating moves the objects", a.x[a.count - 1] != x0 || a.y[a.count - 1] != y0) && ok;
+        ok = report("every child keeps its distance to its parent", links_hold(&a)) && ok;
+        ok = report("and every box still holds its object", boxes_hold(&a)) && ok;
+        animate_ms /= ticks;
+        refit_ms /= ticks;
+    }
+    bench_scene_print(&a, stdout);
+    printf("  generate %.1f ms, BVH build %.1f ms", generate_ms, build_ms);
+    if (a.moving)
+        printf("; a tick animates in %.2f ms and refits in %.2f ms (%.1f ns an object)", animate_ms, refit_ms,
+            1e6 * (animate_ms + refit_ms) / a.count);
+    printf("\n");
+    bvh_destroy(&bvh);
+    bench_scene_destroy(&a);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int ticks = argc > 2 ? atoi(argv[2]) : 60;
+    bool ok = true;
+    if (argc > 1 && strcmp(argv[1], "all") != 0)
+    {
+        BenchSceneParams params;
+        if (!bench_scene_parse(argv[1], &params))
+        {
+            bench_scene_print_presets(stderr);
+            return EXIT_FAILURE;
+        }
+        ok = run(&params, ticks > 0 ? ticks : 1);
+    }
+    else
+    {
+        BenchSceneParams custom;
+        ok = report("presets parse, with knobs over them", bench_scene_parse("10k-static,objects=5,depth=2,dynamic=1", &custom)
+            && custom.objects == 5 && custom.depth == 2 && custom.dynamic && !strcmp(custom.name, "custom"));
+        ok = report("unknown presets and knobs don't", !bench_scene_parse("10k-nothing", &custom)
+            && !bench_scene_parse("10k-static,colour=3", &custom)) && ok;
+        for (int i = 0; i < bench_scene_preset_count; ++i)
+            ok = run(&bench_scene_presets[i], ticks > 0 ? ticks : 1) && ok;
+    }
+    printf("%s\n", ok ? "all checks passed" : "some checks FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
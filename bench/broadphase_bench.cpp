@@ -0,0 +1,186 @@
+// Broadphase check (src/scene/broadphase.h): boxes scattered through a cube, about one other box touching each, a
+// share of them wandering. The pairs from the scene's grid must match a brute-force sweep along x after the first
+// update and after ticks where some moved, the began and ended counts must match the difference between the sweeps,
+// a tick where nothing moved must test nothing, and an update on the job system must give the serial one's list.
+// Then times "ticks" ticks, the grid rebuilt each time as the scene does: the pairs kept across ticks against found
+// from scratch.
+//
+// Usage: broadphase_bench [objects] [moving %] [ticks]
+
+#include "core/job_system.h"
+#include "scene/broadphase.h"
+#include "scene/spatial_grid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define EXTENT_MIN 0.1f             // box half-extents per axis
+#define EXTENT_MAX 0.4f
+#define STEP 0.05f                  // furthest a moving box goes a tick, per axis
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-50s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Every overlapping pair, sorted as the broadphase keeps them: boxes in order of min x, each against those that
+// start before it ends
+static std::vector<uint64_t> sweep(const std::vector<Aabb>& bounds)
+{
+    std::vector<uint32_t> order(bounds.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = (uint32_t)i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return bounds[a].min[0] < bounds[b].min[0]; });
+    std::vector<uint64_t> pairs;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        const Aabb* a = &bounds[order[i]];
+        for (size_t j = i + 1; j < order.size() && bounds[order[j]].min[0] <= a->max[0]; ++j)
+        {
+            const Aabb* b = &bounds[order[j]];
+            if (a->max[1] < b->min[1] || a->min[1] > b->max[1] || a->max[2] < b->min[2] || a->min[2] > b->max[2])
+                continue;
+            const uint32_t lo = std::min(order[i], order[j]), hi = std::max(order[i], order[j]);
+            pairs.push_back((uint64_t)lo << 32 | hi);
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+static bool same(const Broadphase* bp, const std::vector<uint64_t>& want)
+{
+    return bp->pairs.count == want.size() && std::equal(want.begin(), want.end(), bp->pairs.pairs);
+}
+
+// The first "moving" boxes take a random step
+static void wander(std::vector<Aabb>* bounds, uint32_t moving, unsigned int* state)
+{
+    for (uint32_t i = 0; i < moving; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const float d = random_float(state, -STEP, STEP);
+            (*bounds)[i].min[k] += d;
+            (*bounds)[i].max[k] += d;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t count = argc > 1 && atol(argv[1]) > 0 ? (uint32_t)atol(argv[1]) : 100000;
+    const double percent = argc > 2 && atof(argv[2]) >= 0.0 ? fmin(atof(argv[2]), 100.0) : 2.0;
+    const int ticks = argc > 3 && atoi(argv[3]) > 0 ? atoi(argv[3]) : 60;
+    const uint32_t moving = (uint32_t)(count * percent / 100.0);
+    bool ok = true;
+
+    // A unit cube of space a box: another box's centre within the mean 0.5 units either way along every axis
+    // overlaps it, so each touches about one other
+    const float spread = 0.5f * cbrtf((float)count);
+    unsigned int state = 1u;
+    std::vector<Aabb> bounds(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const float c = random_float(&state, -spread, spread), e = random_float(&state, EXTENT_MIN, EXTENT_MAX);
+            bounds[i].min[k] = c - e;
+            bounds[i].max[k] = c + e;
+        }
+    }
+    const float cell = 2.f * EXTENT_MAX;
+
+    JobSystem jobs;
+    SpatialGrid grid;
+    Broadphase serial, parallel, scratch;
+    if (!job_system_init(&jobs, 0) || !spatial_grid_init(&grid, count) || !broadphase_init(&serial, count, 1)
+        || !broadphase_init(&parallel, count, jobs.thread_count)
+        || !broadphase_init(&scratch, count, jobs.thread_count))
+        return EXIT_FAILURE;
+    printf("%u boxes in a %.0f-unit cube, %u (%.1f%%) moving; %d job threads\n", count, 2 * spread, moving, percent,
+        jobs.thread_count);
+
+    spatial_grid_build(&grid, NULL, bounds.data(), count, cell);
+    std::vector<uint64_t> want = sweep(bounds);
+    broadphase_update(&serial, &grid, bounds.data(), count, NULL);
+    broadphase_update(&parallel, &grid, bounds.data(), count, &jobs);
+    ok = report("first update finds every pair", same(&serial, want) && serial.began == want.size()) && ok;
+    ok = report("on the job system, the same list", same(&parallel, want)) && ok;
+
+    bool moved_ok = true, events_ok = true, parallel_ok = true;
+    for (int t = 0; t < 4; ++t)
+    {
+        wander(&bounds, moving, &state);
+        spatial_grid_build(&grid, NULL, bounds.data(), count, cell);
+        const std::vector<uint64_t> was = want;
+        want = sweep(bounds);
+        std::vector<uint64_t> began, ended;
+        std::set_difference(want.begin(), want.end(), was.begin(), was.end(), std::back_inserter(began));
+        std::set_difference(was.begin(), was.end(), want.begin(), want.end(), std::back_inserter(ended));
+        broadphase_update(&serial, &grid, bounds.data(), count, NULL);
+        broadphase_update(&parallel, &grid, bounds.data(), count, &jobs);
+        moved_ok = moved_ok && same(&serial, want) && serial.moved_count == moving;
+        events_ok = events_ok && serial.began == began.size() && serial.ended == ended.size();
+        parallel_ok = parallel_ok && same(&parallel, want);
+    }
+    ok = report("after ticks with some moving, every pair", moved_ok) && ok;
+    ok = report("pairs that began and ended counted", events_ok) && ok;
+    ok = report("on the job system, the same list", parallel_ok) && ok;
+    broadphase_update(&serial, &grid, bounds.data(), count, NULL);
+    ok = report("a tick with nothing moving queries nothing", same(&serial, want) && serial.visited == 0
+        && serial.kept == want.size()) && ok;
+
+    // Timed: the grid rebuilt each tick either way, then the pairs kept or found from scratch
+    double kept_ms = 0.0, scratch_ms = 0.0, grid_ms = 0.0;
+    uint64_t kept_visited = 0, scratch_visited = 0, kept_pairs = 0;
+    for (int t = 0; t < ticks; ++t)
+    {
+        wander(&bounds, moving, &state);
+        double start = now_ms();
+        spatial_grid_build(&grid, &jobs, bounds.data(), count, cell);
+        grid_ms += now_ms() - start;
+        start = now_ms();
+        broadphase_update(&parallel, &grid, bounds.data(), count, &jobs);
+        kept_ms += now_ms() - start;
+        broadphase_reset(&scratch);
+        start = now_ms();
+        broadphase_update(&scratch, &grid, bounds.data(), count, &jobs);
+        scratch_ms += now_ms() - start;
+        kept_visited += parallel.visited;
+        scratch_visited += scratch.visited;
+        kept_pairs += parallel.kept;
+    }
+    printf("  %u pairs; grid rebuilt in %.3f ms a tick\n", parallel.pairs.count, grid_ms / ticks);
+    printf("  from scratch: %.3f ms and %.0f overlaps visited a tick\n", scratch_ms / ticks,
+        (double)scratch_visited / ticks);
+    printf("  kept:         %.3f ms and %.0f overlaps visited a tick, %.1f%% of the pairs carried over\n",
+        kept_ms / ticks, (double)kept_visited / ticks,
+        100.0 * kept_pairs / ((double)ticks * (parallel.pairs.count ? parallel.pairs.count : 1)));
+    ok = report("kept and from scratch agree", parallel.pairs.count == scratch.pairs.count
+        && std::equal(parallel.pairs.pairs, parallel.pairs.pairs + parallel.pairs.count, scratch.pairs.pairs)) && ok;
+    ok = report("nothing dropped", !serial.dropped && !parallel.dropped && !scratch.dropped) && ok;
+
+    broadphase_destroy(&scratch);
+    broadphase_destroy(&parallel);
+    broadphase_destroy(&serial);
+    spatial_grid_destroy(&grid);
+    job_system_destroy(&jobs);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
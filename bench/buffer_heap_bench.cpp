@@ -0,0 +1,320 @@
+// Buffer heap check (src/core/buffer_heap.h): allocations never overlap and stay in range under random churn,
+// freeing everything merges back to one piece, exact fits and a full heap behave, refused allocations are counted
+// and the record pool's limit holds. Then mesh-sized churn reports how fragmented the free space gets, and
+// defragmenting a few hundred KB a frame has to gather it back into one piece with every allocation's contents
+// where its handle now says, during more churn and after it; allocating, freeing and defragmenting are timed.
+//
+// Usage: buffer_heap_bench [allocations]
+
+#include "core/buffer_heap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+typedef struct Live
+{
+    uint32_t handle;
+    uint32_t offset;
+    uint32_t size;
+} Live;
+
+// The live allocations are inside the range, apart, and add up to what the heap says is used
+static bool consistent(const BufferHeap* heap, std::vector<Live> live)
+{
+    std::sort(live.begin(), live.end(), [](const Live& a, const Live& b) { return a.offset < b.offset; });
+    uint64_t used = 0;
+    for (size_t i = 0; i < live.size(); ++i)
+    {
+        if ((uint64_t)live[i].offset + live[i].size > heap->capacity)
+            return false;
+        if (i > 0 && live[i - 1].offset + live[i - 1].size > live[i].offset)
+            return false;
+        if (buffer_heap_offset(heap, live[i].handle) != live[i].offset || buffer_heap_size(heap, live[i].handle) != live[i].size)
+            return false;
+        used += live[i].size;
+    }
+    return used == heap->used && live.size() == heap->allocations;
+}
+
+static bool churn_checks()
+{
+    bool ok = true;
+    BufferHeap heap;
+    buffer_heap_init(&heap, 1u << 20, 4096);
+    std::mt19937 rng(7);
+    std::vector<Live> live;
+    bool apart = true;
+    for (int step = 0; step < 200000; ++step)
+    {
+        if (live.size() < 2000 && (live.empty() || rng() % 3 != 0))
+        {
+            const uint32_t size = 1 + rng() % (rng() % 8 == 0 ? 20000 : 300);
+            Live l;
+            l.size = size;
+            l.handle = buffer_heap_alloc(&heap, size, &l.offset);
+            if (l.handle != BUFFER_HEAP_NONE)
+                live.push_back(l);
+        }
+        else
+        {
+            const size_t i = rng() % live.size();
+            buffer_heap_free(&heap, live[i].handle);
+            live[i] = live.back();
+            live.pop_back();
+        }
+        if (step % 1000 == 0)
+            apart = consistent(&heap, live) && apart;
+    }
+    ok = report("allocations apart and in range under churn", apart && consistent(&heap, live)) && ok;
+    for (const Live& l : live)
+        buffer_heap_free(&heap, l.handle);
+    ok = report("freeing everything leaves one piece", heap.free_blocks == 1 && heap.used == 0 &&
+        buffer_heap_largest_free(&heap) == heap.capacity) && ok;
+    buffer_heap_destroy(&heap);
+    return ok;
+}
+
+static bool edge_checks()
+{
+    bool ok = true;
+    BufferHeap heap;
+    buffer_heap_init(&heap, 1000, 4);
+    uint32_t offsets[4];
+    uint32_t handles[4];
+    handles[0] = buffer_heap_alloc(&heap, 1000, &offsets[0]);
+    ok = report("an exact fit takes the whole range", handles[0] != BUFFER_HEAP_NONE && offsets[0] == 0 &&
+        heap.free_blocks == 0 && buffer_heap_largest_free(&heap) == 0) && ok;
+    uint32_t offset;
+    ok = report("a full heap refuses and counts it", buffer_heap_alloc(&heap, 1, &offset) == BUFFER_HEAP_NONE &&
+        heap.failed == 1) && ok;
+    buffer_heap_free(&heap, handles[0]);
+    buffer_heap_free(&heap, handles[0]);
+    ok = report("a second free of a handle does nothing", heap.used == 0 && heap.free_blocks == 1) && ok;
+
+    // Four in a row, the middle two freed: they merge with each other but not with the live ones
+    for (int i = 0; i < 4; ++i)
+        handles[i] = buffer_heap_alloc(&heap, 100, &offsets[i]);
+    buffer_heap_free(&heap, handles[1]);
+    buffer_heap_free(&heap, handles[2]);
+    ok = report("freed neighbours merge", heap.free_blocks == 2 && buffer_heap_largest_free(&heap) == 600) && ok;
+    const uint32_t again = buffer_heap_alloc(&heap, 200, &offset);
+    ok = report("the merged piece is reused", again != BUFFER_HEAP_NONE && offset == offsets[1]) && ok;
+    ok = report("records run out at max_allocations", buffer_heap_alloc(&heap, 1, &offset) != BUFFER_HEAP_NONE &&
+        buffer_heap_alloc(&heap, 1, &offset) == BUFFER_HEAP_NONE) && ok;
+    buffer_heap_destroy(&heap);
+
+    // A request just past a size class still finds a piece big enough without walking a list
+    buffer_heap_init(&heap, 1u << 16, 64);
+    handles[0] = buffer_heap_alloc(&heap, 17, &offsets[0]);
+    handles[1] = buffer_heap_alloc(&heap, 1, &offsets[1]);
+    handles[2] = buffer_heap_alloc(&heap, 19, &offsets[2]);
+    handles[3] = buffer_heap_alloc(&heap, 1, &offsets[3]);
+    buffer_heap_free(&heap, handles[0]);
+    buffer_heap_free(&heap, handles[2]);
+    const uint32_t fit = buffer_heap_alloc(&heap, 18, &offset);
+    ok = report("a class search never returns a short piece", fit != BUFFER_HEAP_NONE &&
+        buffer_heap_size(&heap, fit) == 18 && (offset == offsets[2] || offset > offsets[3])) && ok;
+    buffer_heap_destroy(&heap);
+    return ok;
+}
+
+#define DEFRAG_UNITS (256u << 10)    // a frame's budget, as mesh_heap_defrag would be given it in units
+#define DEFRAG_MOVES 64
+
+// A heap with the data it holds: every unit of an allocation carries the allocation's stamp, and moves are copied
+// as a buffer's would be
+typedef struct Shadow
+{
+    BufferHeap* heap;
+    std::vector<uint32_t> units;
+    std::vector<uint32_t> live;         // handles
+    std::vector<uint32_t> stamps;       // [handle]
+    uint32_t next_stamp;
+    bool apart;                         // every move's source and destination
+} Shadow;
+
+static void shadow_alloc(Shadow* s, uint32_t size, uint64_t* refused_below_free)
+{
+    uint32_t offset;
+    const uint32_t h = buffer_heap_alloc(s->heap, size, &offset);
+    if (h == BUFFER_HEAP_NONE)
+    {
+        *refused_below_free += size <= s->heap->capacity - s->heap->used;
+        return;
+    }
+    s->live.push_back(h);
+    s->stamps[h] = ++s->next_stamp;
+    std::fill(s->units.begin() + offset, s->units.begin() + offset + size, s->next_stamp);
+}
+
+static void shadow_free(Shadow* s, size_t i)
+{
+    buffer_heap_free(s->heap, s->live[i]);
+    s->live[i] = s->live.back();
+    s->live.pop_back();
+}
+
+// One frame's defragmentation, copied in order; returns the moves
+static uint32_t shadow_defrag(Shadow* s)
+{
+    BufferHeapMove moves[DEFRAG_MOVES];
+    const uint32_t n = buffer_heap_defrag(s->heap, DEFRAG_UNITS, moves, DEFRAG_MOVES);
+    for (uint32_t m = 0; m < n; ++m)
+    {
+        const BufferHeapMove* move = &moves[m];
+        s->apart = s->apart && (move->to + move->size <= move->from || move->from + move->size <= move->to);
+        std::copy(s->units.begin() + move->from, s->units.begin() + move->from + move->size,
+            s->units.begin() + move->to);
+    }
+    return n;
+}
+
+// The live allocations where their handles now say they are, for consistent()
+static std::vector<Live> live_of(const Shadow* s)
+{
+    std::vector<Live> live;
+    for (uint32_t h : s->live)
+        live.push_back({ h, buffer_heap_offset(s->heap, h), buffer_heap_size(s->heap, h) });
+    return live;
+}
+
+// Every live allocation's units carry its stamp where its handle says it is
+static bool shadow_intact(const Shadow* s)
+{
+    for (uint32_t h : s->live)
+    {
+        const uint32_t offset = buffer_heap_offset(s->heap, h), size = buffer_heap_size(s->heap, h);
+        for (uint32_t u = offset; u < offset + size; ++u)
+            if (s->units[u] != s->stamps[h])
+                return false;
+    }
+    return true;
+}
+
+// Meshes of a few hundred to a few tens of thousands of vertices loaded and unloaded at random in a heap kept about
+// 3/4 full; prints how much of the free space is outside the largest piece. Then the same churn with a frame's
+// defragmentation every 100 loads and unloads, and frames of it alone until it's done.
+static bool fragmentation()
+{
+    BufferHeap heap;
+    const uint32_t capacity = 16u << 20, max_allocations = 8192;
+    buffer_heap_init(&heap, capacity, max_allocations);
+    std::mt19937 rng(11);
+    std::lognormal_distribution<double> mesh_size(7.5, 1.2);
+    Shadow s = { &heap, std::vector<uint32_t>(capacity), {}, std::vector<uint32_t>(2 * max_allocations + 1), 0, true };
+    uint64_t refused_below_free = 0;
+    bool ok = true, intact = true;
+    for (int step = 0; step < 200000; ++step)
+    {
+        if (heap.used < capacity / 4 * 3)
+            shadow_alloc(&s, (uint32_t)std::min(mesh_size(rng) + 1.0, 1e6), &refused_below_free);
+        else
+            shadow_free(&s, rng() % s.live.size());
+        if (step == 99999)
+        {
+            printf("  ");
+            buffer_heap_print(&heap, "after 100k mesh loads and unloads", stdout);
+            printf("  refused with enough free space in total: %llu\n", (unsigned long long)refused_below_free);
+            refused_below_free = 0;
+        }
+        if (step >= 100000 && step % 100 == 0)
+        {
+            shadow_defrag(&s);
+            if (step % 10000 == 0)
+                intact = consistent(&heap, live_of(&s)) && shadow_intact(&s) && intact;
+        }
+    }
+    printf("  ");
+    buffer_heap_print(&heap, "then 100k more, defragmenting every 100", stdout);
+    printf("  refused with enough free space in total: %llu\n", (unsigned long long)refused_below_free);
+    ok = report("defragmenting amid churn keeps the data", intact && consistent(&heap, live_of(&s))
+        && shadow_intact(&s)) && ok;
+
+    int frames = 0;
+    double ms = 0.0, worst_ms = 0.0;
+    for (uint32_t moved = 1; moved && frames < 100000; ++frames)
+    {
+        const double t0 = now_ms();
+        moved = shadow_defrag(&s);
+        const double t = now_ms() - t0;
+        ms += t;
+        worst_ms = std::max(worst_ms, t);
+    }
+    printf("  ");
+    buffer_heap_print(&heap, "defragmented", stdout);
+    printf("  %d frames of up to %u units: %.3f ms a frame, %.3f ms at worst, copies left out\n", frames,
+        DEFRAG_UNITS, ms / frames, worst_ms);
+    ok = report("no move's copy overlaps itself", s.apart) && ok;
+    ok = report("and keeps every allocation's data", consistent(&heap, live_of(&s)) && shadow_intact(&s)) && ok;
+    uint32_t end = 0;
+    for (const Live& l : live_of(&s))
+        end = std::max(end, l.offset + l.size);
+    ok = report("the free space ends as one piece at the top", heap.free_blocks == 1 && end == heap.used) && ok;
+    buffer_heap_destroy(&heap);
+    return ok;
+}
+
+static bool timing(uint32_t allocations)
+{
+    BufferHeap heap;
+    buffer_heap_init(&heap, 0xFFFFFFF0u, allocations);
+    std::mt19937 rng(3);
+    std::vector<uint32_t> sizes(allocations);
+    for (uint32_t& s : sizes)
+        s = 1 + rng() % 50000;
+    std::vector<uint32_t> handles(allocations);
+    std::vector<uint32_t> order(allocations);
+    for (uint32_t i = 0; i < allocations; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    double alloc_ms = 0.0, free_ms = 0.0;
+    bool ok = true;
+    for (int pass = 0; pass < 20; ++pass)
+    {
+        uint32_t offset;
+        const double t0 = now_ms();
+        for (uint32_t i = 0; i < allocations; ++i)
+            handles[i] = buffer_heap_alloc(&heap, sizes[i], &offset);
+        const double t1 = now_ms();
+        for (uint32_t i = 0; i < allocations; ++i)
+            buffer_heap_free(&heap, handles[order[i]]);     // out of order, so frees merge both ways
+        const double t2 = now_ms();
+        alloc_ms += t1 - t0;
+        free_ms += t2 - t1;
+        ok = ok && heap.free_blocks == 1 && heap.used == 0;
+    }
+    printf("  %u allocations: %.1f ns an alloc, %.1f ns a free\n", allocations, alloc_ms * 1e6 / (20.0 * allocations),
+        free_ms * 1e6 / (20.0 * allocations));
+    buffer_heap_destroy(&heap);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t allocations = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 50000;
+
+    printf("correctness:\n");
+    bool ok = churn_checks();
+    ok = edge_checks() && ok;
+    printf("fragmentation:\n");
+    ok = fragmentation() && ok;
+    printf("timing:\n");
+    ok = report("the timed heap ends as one piece", timing(allocations)) && ok;
+    printf("%s\n", ok ? "buffer_heap_bench: ok" : "buffer_heap_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// BVH check: scatters random boxes, then compares bvh_cull and bvh_raycast with brute-force answers after a
+// build, after moving the objects and refitting, and after an incremental rebuild spread over "frames". Prints
+// build/refit/query times next to the linear SIMD cull.
+//
+// Usage: bvh_bench [objects] [items per rebuild step]
+
+#include "scene/bvh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+typedef struct World
+{
+    std::vector<Aabb> bounds;
+    std::vector<float> cx, cy, cz, ex, ey, ez;      // the same boxes as SoA for frustum_cull_aabbs
+} World;
+
+static void world_place(World* w, unsigned int* state, float spread)
+{
+    const size_t n = w->bounds.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        const float c[3] = { random_float(state, -spread, spread), random_float(state, -spread, spread), random_float(state, -spread, spread) };
+        const float e[3] = { random_float(state, 0.05f, 1.f), random_float(state, 0.05f, 1.f), random_float(state, 0.05f, 1.f) };
+        for (int k = 0; k < 3; ++k)
+        {
+            w->bounds[i].min[k] = c[k] - e[k];
+            w->bounds[i].max[k] = c[k] + e[k];
+        }
+        w->cx[i] = c[0]; w->cy[i] = c[1]; w->cz[i] = c[2];
+        w->ex[i] = e[0]; w->ey[i] = e[1]; w->ez[i] = e[2];
+    }
+}
+
+// Every answer the BVH gives for this world must match the linear ones
+static bool check(const char* label, const Bvh* bvh, const World* w, const Frustum* frustum)
+{
+    const size_t n = w->bounds.size();
+    std::vector<uint32_t> linear(n), tree(n);
+    const size_t linear_count = frustum_cull_aabbs(frustum, w->cx.data(), w->cy.data(), w->cz.data(),
+        w->ex.data(), w->ey.data(), w->ez.data(), n, linear.data());
+    const size_t tree_count = bvh_cull(bvh, frustum, tree.data());
+    linear.resize(linear_count);
+    tree.resize(tree_count);
+    std::sort(tree.begin(), tree.end());
+    bool ok = linear == tree;
+
+    // Rays from the origin: nearest box entry by brute force vs the tree
+    unsigned int state = 99u;
+    int ray_mismatches = 0;
+    for (int r = 0; r < 256; ++r)
+    {
+        vec3 origin = { 0.f, 0.f, 0.f };
+        vec3 dir = { random_float(&state, -1.f, 1.f), random_float(&state, -1.f, 1.f), random_float(&state, -1.f, 1.f) };
+        vec3_norm(dir, dir);
+        float best = FLT_MAX;
+        for (size_t i = 0; i < n; ++i)
+        {
+            float t0 = 0.f, t1 = 1000.f;
+            for (int k = 0; k < 3; ++k)
+            {
+                const float a = (w->bounds[i].min[k] - origin[k]) / dir[k];
+                const float b = (w->bounds[i].max[k] - origin[k]) / dir[k];
+                t0 = fmaxf(t0, fminf(a, b));
+                t1 = fminf(t1, fmaxf(a, b));
+            }
+            if (t0 <= t1 && t0 < best)
+                best = t0;
+        }
+        float t = FLT_MAX;
+        const int64_t hit = bvh_raycast(bvh, origin, dir, 1000.f, NULL, NULL, &t);
+        if ((hit < 0) != (best == FLT_MAX) || (hit >= 0 && fabsf(t - best) > 1e-4f * (1.f + best)))
+            ++ray_mismatches;
+    }
+    ok = ok && ray_mismatches == 0;
+    printf("%-10s %zu visible of %zu, %d/256 rays differ%s\n", label, tree_count, n, ray_mismatches, ok ? "" : "  MISMATCH");
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t count = argc > 1 ? (uint32_t)atol(argv[1]) : 200000;
+    const uint32_t step_nodes = argc > 2 ? (uint32_t)atol(argv[2]) : 100000;
+
+    World world;
+    world.bounds.resize(count);
+    world.cx.resize(count); world.cy.resize(count); world.cz.resize(count);
+    world.ex.resize(count); world.ey.resize(count); world.ez.resize(count);
+    unsigned int state = 1u;
+    world_place(&world, &state, 200.f);
+
+    // A narrow camera inside the cloud: a few percent of the objects are visible
+    mat4x4 projection, view, view_projection;
+    mat4x4_perspective(projection, 0.8f, 16.f / 9.f, 0.1f, 150.f);
+    vec3 eye = { 0.f, 0.f, 0.f }, center = { 1.f, 0.2f, -1.f }, up = { 0.f, 1.f, 0.f };
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(view_projection, projection, view);
+    Frustum frustum;
+    frustum_from_matrix(&frustum, view_projection);
+
+    Bvh bvh;
+    if (!bvh_init(&bvh, count))
+        return EXIT_FAILURE;
+    double t0 = now_ms();
+    bvh_build(&bvh, world.bounds.data(), count);
+    printf("build      %8.2f ms, %u nodes\n", now_ms() - t0, bvh.node_count);
+    bool ok = check("built", &bvh, &world, &frustum);
+
+    // Query cost: the tree against the linear SIMD sweep
+    std::vector<uint32_t> visible(count);
+    const int reps = 50;
+    t0 = now_ms();
+    for (int i = 0; i < reps; ++i)
+        frustum_cull_aabbs(&frustum, world.cx.data(), world.cy.data(), world.cz.data(), world.ex.data(),
+            world.ey.data(), world.ez.data(), count, visible.data());
+    const double linear_ms = (now_ms() - t0) / reps;
+    t0 = now_ms();
+    for (int i = 0; i < reps; ++i)
+        bvh_cull(&bvh, &frustum, visible.data());
+    const double tree_ms = (now_ms() - t0) / reps;
+    printf("cull       %8.3f ms linear, %8.3f ms bvh\n", linear_ms, tree_ms);
+
+    // Everything moves: a refit keeps the answers right (but the tree is now a poor fit)
+    world_place(&world, &state, 200.f);
+    t0 = now_ms();
+    bvh_refit(&bvh, world.bounds.data());
+    printf("refit      %8.2f ms\n", now_ms() - t0);
+    ok = check("refit", &bvh, &world, &frustum) && ok;
+    t0 = now_ms();
+    for (int i = 0; i < reps; ++i)
+        bvh_cull(&bvh, &frustum, visible.data());
+    printf("cull       %8.3f ms bvh after refit\n", (now_ms() - t0) / reps);
+
+    // Incremental rebuild, one bounded step per "frame", with the live tree still queried in between
+    bvh_rebuild_begin(&bvh, world.bounds.data());
+    int frames = 0;
+    double worst_step = 0.0;
+    for (;;)
+    {
+        ++frames;
+        t0 = now_ms();
+        const bool done = bvh_rebuild_step(&bvh, world.bounds.data(), step_nodes);
+        worst_step = std::max(worst_step, now_ms() - t0);
+        if (done)
+            break;
+        bvh_cull(&bvh, &frustum, visible.data());
+    }
+    printf("rebuild    %d frames of %u items, worst step %.2f ms\n", frames, step_nodes, worst_step);
+    ok = check("rebuilt", &bvh, &world, &frustum) && ok;
+    t0 = now_ms();
+    for (int i = 0; i < reps; ++i)
+        bvh_cull(&bvh, &frustum, visible.data());
+    printf("cull       %8.3f ms bvh after rebuild\n", (now_ms() - t0) / reps);
+
+    bvh_destroy(&bvh);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,388 @@
+// Camera controller check (src/scene/camera_controller.h): an orbit camera that hasn't moved frames the grid as
+// the orthographic camera does and keeps its target centred as it tilts; the cached inverse undoes the
+// view-projection in every mode; a still controller never rebuilds the camera; arcball drags keep the quaternion
+// a unit one and the eye at its distance; flying moves along the view at the set speed; and 10^7 units out,
+// camera-relative matrices put the grid where they do at the origin; the tiles of a wall draw the whole view's
+// pixels, orthographic or perspective; and a stereo camera's cull frustum holds everything either eye sees, the
+// eyes agreeing at the convergence distance, as it does for a turned head's canted eyes and for those eyes
+// late-latched a little further on. Then times a rebuild.
+//
+// Usage: camera_bench [drags]
+
+#include "scene/camera_controller.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static InputEvent event(InputEventType type, int code, int action, double x, double y)
+{
+    const InputEvent e = { 0.0, type, code, action, 0, x, y };
+    return e;
+}
+
+// A right-button drag from (x0, y0) to (x1, y1) in "steps" cursor moves
+static void drag(CameraController* c, const Camera* camera, double x0, double y0, double x1, double y1, int steps)
+{
+    InputEvent e = event(INPUT_EVENT_MOUSE_BUTTON, CAMERA_BUTTON_RIGHT, CAMERA_PRESS, x0, y0);
+    camera_controller_event(c, &e, camera);
+    for (int s = 1; s <= steps; ++s)
+    {
+        e = event(INPUT_EVENT_CURSOR, 0, 0, x0 + (x1 - x0) * s / steps, y0 + (y1 - y0) * s / steps);
+        camera_controller_event(c, &e, camera);
+    }
+    e = event(INPUT_EVENT_MOUSE_BUTTON, CAMERA_BUTTON_RIGHT, CAMERA_RELEASE, x1, y1);
+    camera_controller_event(c, &e, camera);
+}
+
+// World point "p" through "m" to NDC
+static void project(mat4x4 const m, const float p[3], float out[3])
+{
+    const vec4 v = { p[0], p[1], p[2], 1.f };
+    vec4 clip;
+    mat4x4_mul_vec4(clip, m, v);
+    for (int k = 0; k < 3; ++k)
+        out[k] = clip[k] / clip[3];
+}
+
+// The largest difference from the identity of inverse_view_projection * view_projection
+static float inverse_error(const Camera* camera)
+{
+    mat4x4 product;
+    mat4x4_mul(product, camera->inverse_view_projection, camera->view_projection);
+    float error = 0.f;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            error = fmaxf(error, fabsf(product[i][j] - (i == j ? 1.f : 0.f)));
+    return error;
+}
+
+// A fly camera over a grid centred on (offset, offset, 0): tilted, turned and backed away for a second.
+// "ndc" gets "count" grid points (relative to the grid's centre) on screen, through the camera-relative matrices;
+// "world_ndc" through float world-space ones, the way they'd be without camera-relative rendering.
+static void far_flight(double offset, const float (*points)[3], int count, float (*ndc)[3], float (*world_ndc)[3])
+{
+    const dvec3 centre = { offset, offset, 0.0 };
+    Camera camera;
+    camera_init(&camera, 1.f);
+    camera_set_viewport(&camera, WIDTH, HEIGHT);
+    camera_set_origin(&camera, centre);
+    CameraController fly;
+    camera_controller_init(&fly, CAMERA_CONTROLLER_FLY, 1.f, centre);
+    drag(&fly, &camera, 0, 0, 37, -133, 5);
+    InputEvent e = event(INPUT_EVENT_KEY, CAMERA_KEY_DOWN, CAMERA_PRESS, 0, 0);
+    camera_controller_event(&fly, &e, &camera);
+    for (int f = 0; f <= 60; ++f)
+        camera_controller_apply(&fly, &camera, 10.0 + f / 60.0);
+    camera_update(&camera);
+    mat4x4 world_view, world_view_projection;
+    mat4x4_from_dmat4x4(world_view, camera.eye_view);
+    mat4x4_mul(world_view_projection, camera.projection, world_view);
+    for (int k = 0; k < count; ++k)
+    {
+        project(camera.view_projection, points[k], ndc[k]);
+        const float world[3] = { (float)(offset + points[k][0]), (float)(offset + points[k][1]), points[k][2] };
+        project(world_view_projection, world, world_ndc[k]);
+    }
+}
+
+static unsigned int random_state = 12345u;
+static double random_double(double lo, double hi)
+{
+    random_state = random_state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (double)(random_state >> 8) / 16777216.0;
+}
+
+// The worst pixel difference, over points "whole" shows, between it and the 3 side-by-side tiles of a
+// camera like it: each tile's pixels are its third of the whole view's
+static float tile_error(const Camera* whole)
+{
+    float worst = 0.f;
+    for (int k = 0; k < 3; ++k)
+    {
+        Camera tile = *whole;
+        camera_set_viewport(&tile, whole->width / 3, whole->height);
+        camera_set_tile(&tile, k / 3.f, 0.f, (k + 1) / 3.f, 1.f);
+        camera_update(&tile);
+        for (int i = 0; i < 32; ++i)
+        {
+            const float p[3] = { (float)random_double(-1.0, 1.0), (float)random_double(-1.0, 1.0), 0.f };
+            float a[3], b[3];
+            project(whole->view_projection, p, a);
+            project(tile.view_projection, p, b);
+            if (fabsf(a[0]) > 1.f || fabsf(a[1]) > 1.f)
+                continue;   // off the wall
+            const float x = (a[0] + 1.f) * 0.5f * whole->width - k * tile.width;
+            const float y = (a[1] + 1.f) * 0.5f * whole->height;
+            worst = fmaxf(worst, fmaxf(fabsf((b[0] + 1.f) * 0.5f * tile.width - x),
+                fabsf((b[1] + 1.f) * 0.5f * tile.height - y)));
+        }
+    }
+    return worst;
+}
+
+// A stereo camera's eyes: the share of points inside either eye's clip volume that its cull frustum would drop,
+// and how far apart, in pixels, the eyes put a point on the view axis at the convergence distance
+static float stereo_misses(const Camera* camera, float* parallax)
+{
+    int misses = 0, points = 0;
+    const double near_z = camera->reversed_z ? 1.0 : -1.0, far_z = camera->reversed_z ? 0.001 : 0.999;   // NDC
+    for (int e = 0; e < 2; ++e)
+    {
+        mat4x4 inverse;
+        mat4x4_invert(inverse, camera->stereo_view_projection[e]);
+        for (int i = 0; i < 4096; ++i, ++points)
+        {
+            const vec4 ndc = { (float)random_double(-1.0, 1.0), (float)random_double(-1.0, 1.0),
+                (float)random_double(near_z, far_z), 1.f };
+            vec4 p;
+            mat4x4_mul_vec4(p, inverse, ndc);
+            const vec3 world = { p[0] / p[3], p[1] / p[3], p[2] / p[3] };
+            for (int k = 0; k < 6; ++k)
+            {
+                const float* plane = camera->frustum.planes[k];
+                if (vec3_mul_inner(plane, world) + plane[3] < -1e-4f * (1.f + vec3_len(world)))
+                {
+                    ++misses;
+                    break;
+                }
+            }
+        }
+    }
+    mat4x4 eye_to_world;
+    mat4x4_invert(eye_to_world, camera->view);
+    const vec4 ahead = { 0.f, 0.f, -camera->stereo_convergence, 1.f };
+    vec4 p;
+    mat4x4_mul_vec4(p, eye_to_world, ahead);
+    const float point[3] = { p[0], p[1], p[2] };
+    float left[3], right[3];
+    project(camera->stereo_view_projection[0], point, left);
+    project(camera->stereo_view_projection[1], point, right);
+    *parallax = fabsf(left[0] - right[0]) * 0.25f * camera->width + fabsf(left[1] - right[1]) * 0.5f * camera->height;
+    return (float)misses / points;
+}
+
+int main(int argc, char** argv)
+{
+    const int drags = argc > 1 ? atoi(argv[1]) : 1000;
+    const float zoom = 1.7f;
+
+    // Untouched orbit vs the orthographic camera: the grid's plane lands on the same pixels
+    Camera flat, camera;
+    camera_init(&flat, zoom);
+    camera_set_viewport(&flat, WIDTH, HEIGHT);
+    camera_update(&flat);
+    camera_init(&camera, zoom);
+    camera_set_viewport(&camera, WIDTH, HEIGHT);
+    CameraController orbit;
+    const dvec3 centre = { 0.0, 0.0, 0.0 };
+    camera_controller_init(&orbit, CAMERA_CONTROLLER_ORBIT, zoom, centre);
+    camera_controller_apply(&orbit, &camera, 1.0);
+    camera_update(&camera);
+    float worst = 0.f;
+    for (int k = 0; k < 25; ++k)
+    {
+        const float p[3] = { (float)random_double(-1.8, 1.8), (float)random_double(-1.0, 1.0), 0.f };
+        float a[3], b[3];
+        project(flat.view_projection, p, a);
+        project(camera.view_projection, p, b);
+        worst = fmaxf(worst, fmaxf(fabsf(a[0] - b[0]), fabsf(a[1] - b[1])));
+    }
+    printf("  orbit at rest: grid %.2e NDC from the orthographic view\n", worst);
+    bool ok = report("an untouched orbit frames the grid as 2D", worst < 1e-4f);
+
+    // Tilting and turning keep the target in the middle of the screen
+    bool centred = true;
+    for (int d = 0; d < 20; ++d)
+    {
+        drag(&orbit, &camera, WIDTH / 2, HEIGHT / 2, WIDTH / 2 + random_double(-400, 400),
+            HEIGHT / 2 + random_double(-300, 300), 8);
+        camera_controller_apply(&orbit, &camera, 1.0 + d);
+        camera_update(&camera);
+        float c[3];
+        const float target[3] = { (float)orbit.target[0], (float)orbit.target[1], (float)orbit.target[2] };
+        project(camera.view_projection, target, c);
+        centred = centred && fabsf(c[0]) < 1e-4f && fabsf(c[1]) < 1e-4f && fabsf(orbit.pitch) <= 1.5f;
+    }
+    ok = report("orbit keeps its target centred", centred) && ok;
+
+    // A still controller: no rebuilds and no version bumps
+    const uint32_t version = camera.version;
+    bool rebuilt = false;
+    for (int f = 0; f < 100; ++f)
+    {
+        camera_controller_apply(&orbit, &camera, 100.0 + f / 60.0);
+        rebuilt = camera_update(&camera) || rebuilt;
+    }
+    ok = report("a still controller never rebuilds", !rebuilt && camera.version == version) && ok;
+
+    // Arcball: random drags, the quaternion stays a unit one and the eye at its distance from the target
+    CameraController ball;
+    camera_controller_init(&ball, CAMERA_CONTROLLER_ARCBALL, zoom, centre);
+    camera_set_reversed_z(&camera, true);
+    float norm_error = 0.f, distance_error = 0.f, arcball_inverse = 0.f;
+    for (int d = 0; d < drags; ++d)
+    {
+        drag(&ball, &camera, random_double(0, WIDTH), random_double(0, HEIGHT), random_double(0, WIDTH),
+            random_double(0, HEIGHT), 4);
+        camera_controller_apply(&ball, &camera, 200.0 + d);
+        camera_update(&camera);
+        const float* q = ball.orientation;
+        norm_error = fmaxf(norm_error, fabsf(sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]) - 1.f));
+        // The eye is the inverse view's translation
+        mat4x4 eye_to_world;
+        mat4x4_invert(eye_to_world, camera.view);
+        vec3 eye = { eye_to_world[3][0], eye_to_world[3][1], eye_to_world[3][2] };
+        distance_error = fmaxf(distance_error, fabsf(vec3_len(eye) - ball.distance) / ball.distance);
+        arcball_inverse = fmaxf(arcball_inverse, inverse_error(&camera));
+    }
+    printf("  arcball: %d drags, |q| off by %.1e, eye distance off by %.1e\n", drags, norm_error, distance_error);
+    ok = report("arcball stays a rotation about the target", norm_error < 1e-5f && distance_error < 1e-4f) && ok;
+
+    // Fly: a second of the up arrow at 60 Hz, straight down the view, then nothing once it's released
+    CameraController fly;
+    camera_controller_init(&fly, CAMERA_CONTROLLER_FLY, zoom, centre);
+    camera_set_reversed_z(&camera, false);
+    drag(&fly, &camera, 0, 0, 100, -200, 10);
+    camera_controller_apply(&fly, &camera, 300.0);
+    camera_update(&camera);
+    const vec3 forward = { -camera.view[0][2], -camera.view[1][2], -camera.view[2][2] };
+    dvec3 start;
+    dvec3_dup(start, fly.position);
+    InputEvent e = event(INPUT_EVENT_KEY, CAMERA_KEY_UP, CAMERA_PRESS, 0, 0);
+    camera_controller_event(&fly, &e, &camera);
+    for (int f = 1; f <= 60; ++f)
+    {
+        camera_controller_apply(&fly, &camera, 300.0 + f / 60.0);
+        camera_update(&camera);
+    }
+    e = event(INPUT_EVENT_KEY, CAMERA_KEY_UP, CAMERA_RELEASE, 0, 0);
+    camera_controller_event(&fly, &e, &camera);
+    vec3 moved;
+    vec3_from_dvec3_sub(moved, fly.position, start);
+    const float along = vec3_mul_inner(moved, forward);
+    dvec3 stopped;
+    dvec3_dup(stopped, fly.position);
+    camera_controller_apply(&fly, &camera, 302.0);
+    const bool still = stopped[0] == fly.position[0] && stopped[1] == fly.position[1] && stopped[2] == fly.position[2];
+    printf("  fly: %.4f forward of %.4f a second, %.1e off the view axis\n", along, fly.speed,
+        vec3_len(moved) - fabsf(along));
+    ok = report("fly moves along the view at its speed", fabsf(along - fly.speed) < 1e-3f * fly.speed
+        && vec3_len(moved) - along < 1e-4f * fly.speed && still) && ok;
+
+    const float fly_inverse = inverse_error(&camera);
+    printf("  inverse view-projection: %.1e arcball (reversed Z), %.1e fly\n", arcball_inverse, fly_inverse);
+    ok = report("the cached inverse undoes the camera", arcball_inverse < 1e-4f && fly_inverse < 1e-4f) && ok;
+
+    // Far out: the same flight over a grid at the origin and 10^7 units away; camera-relative, the grid lands on
+    // the same pixels, where float world positions would be whole units off
+    float points[64][3], near_ndc[64][3], far_ndc[64][3], near_world[64][3], far_world[64][3];
+    for (int k = 0; k < 64; ++k)
+    {
+        points[k][0] = (float)random_double(-1.0, 1.0);
+        points[k][1] = (float)random_double(-1.0, 1.0);
+        points[k][2] = 0.f;
+    }
+    far_flight(0.0, points, 64, near_ndc, near_world);
+    far_flight(1e7, points, 64, far_ndc, far_world);
+    float relative_error = 0.f, world_error = 0.f;
+    for (int k = 0; k < 64; ++k)
+        for (int c = 0; c < 2; ++c)
+        {
+            relative_error = fmaxf(relative_error, fabsf(far_ndc[k][c] - near_ndc[k][c]));
+            world_error = fmaxf(world_error, fabsf(far_world[k][c] - near_ndc[k][c]));
+        }
+    printf("  10^7 out: %.3f px off camera-relative, %.1f px off with float world positions\n",
+        relative_error * 0.5f * HEIGHT, world_error * 0.5f * HEIGHT);
+    ok = report("camera-relative keeps far grids in place", relative_error * 0.5f * HEIGHT < 0.01f) && ok;
+
+    // A wall of 3: the orthographic view, and the fly camera's perspective one from where it ended up
+    Camera wall;
+    camera_init(&wall, zoom);
+    camera_set_viewport(&wall, 3 * WIDTH, HEIGHT);
+    camera_update(&wall);
+    const float flat_tiles = tile_error(&wall);
+    camera_set_viewport(&camera, 3 * WIDTH, HEIGHT);
+    camera_update(&camera);
+    const float perspective_tiles = tile_error(&camera);
+    printf("  wall of 3 tiles: %.4f px orthographic, %.4f px perspective from the whole view\n", flat_tiles,
+        perspective_tiles);
+    ok = report("a wall's tiles draw the whole view", flat_tiles < 0.05f && perspective_tiles < 0.05f) && ok;
+
+    // Stereo from the orbit's eye, converging on its target, a thirtieth of that apart; reversed Z too
+    Camera stereo = camera;
+    camera_set_viewport(&stereo, WIDTH, HEIGHT);
+    camera_set_stereo(&stereo, orbit.distance / 30.f, orbit.distance);
+    camera_update(&stereo);
+    float parallax = 0.f;
+    const float missed = stereo_misses(&stereo, &parallax);
+    camera_set_reversed_z(&stereo, true);
+    camera_update(&stereo);
+    float reversed_parallax = 0.f;
+    const float reversed_missed = stereo_misses(&stereo, &reversed_parallax);
+    printf("  stereo: %.2f%% of the eyes' points outside the cull frustum, %.4f px parallax at convergence\n",
+        100.f * fmaxf(missed, reversed_missed), fmaxf(parallax, reversed_parallax));
+    ok = report("the stereo cull frustum holds both eyes", missed == 0.f && reversed_missed == 0.f
+        && parallax < 0.01f && reversed_parallax < 0.01f) && ok;
+
+    // A headset's: the head turned and tilted away from the orbit's eye, the eyes canted out with uneven sides, in
+    // world units of half the orbit's distance a metre. Then the eyes late-latched with the head turned on by less
+    // than the margin covers.
+    const float metre = orbit.distance / 2.f;
+    mat4x4 head;
+    mat4x4_translate(head, 0.1f * metre, 0.05f * metre, -0.2f * metre);
+    mat4x4_rotate_Y(head, head, 0.6f);
+    mat4x4_rotate_X(head, head, 0.2f);
+    CameraEye eyes[2] = { { {}, { -1.f, 0.85f, -0.95f, 0.9f } }, { {}, { -0.85f, 1.f, -0.95f, 0.9f } } };
+    for (int e = 0; e < 2; ++e)
+    {
+        mat4x4_translate(eyes[e].pose, (e ? 0.032f : -0.032f) * metre, 0.f, 0.f);
+        mat4x4_rotate_Y(eyes[e].pose, eyes[e].pose, e ? -0.05f : 0.05f);
+    }
+    Camera tracked = stereo;
+    camera_set_eyes(&tracked, head, eyes, 0.05f);
+    camera_update(&tracked);
+    const float tracked_missed = stereo_misses(&tracked, &parallax);
+    Camera late = tracked;
+    for (int e = 0; e < 2; ++e)
+    {
+        CameraEye eye = eyes[e];
+        mat4x4 turn;
+        mat4x4_identity(turn);
+        mat4x4_rotate_Y(turn, turn, 0.03f);
+        mat4x4_mul(eye.pose, turn, eyes[e].pose);
+        camera_eye_view_projection(&tracked, &eye, late.stereo_view_projection[e]);
+    }
+    const float late_missed = stereo_misses(&late, &parallax);
+    printf("  tracked: %.2f%% of the eyes' points outside the cull frustum, %.2f%% late-latched\n",
+        100.f * tracked_missed, 100.f * late_missed);
+    ok = report("the tracked cull frustum holds both eyes", tracked_missed == 0.f && late_missed == 0.f) && ok;
+
+    // Cost: a moving controller's apply and the rebuild it causes
+    const int frames = 100000;
+    const double t = now_ms();
+    for (int f = 0; f < frames; ++f)
+    {
+        e = event(INPUT_EVENT_SCROLL, 0, 0, 0, (f & 1) ? 1.0 : -1.0);
+        camera_controller_event(&orbit, &e, &camera);
+        camera_controller_apply(&orbit, &camera, 400.0 + f / 60.0);
+        camera_update(&camera);
+    }
+    printf("  apply and rebuild: %.1f ns\n", (now_ms() - t) * 1e6 / frames);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
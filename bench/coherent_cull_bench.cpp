@@ -0,0 +1,206 @@
+// Coherent culling (scene/coherent_cull.h): a plain of objects under a camera that slides, then turns, a little each
+// frame, a few objects moving too. Every frame the visible set must be frustum_cull_spheres' exactly and the kept
+// list in depth order; while the camera slides the insertion sorts must carry the order, the list's and the render
+// queue's; a camera that jumps across the plain is culled in full. Each frame's cull and sorts are timed against
+// culling everything and radix sorting the draws afresh.
+//
+// Usage: coherent_cull_bench [objects] [frames]
+
+#include "core/render_queue.h"
+#include "scene/coherent_cull.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SPREAD 400.f        // the plain's half-width
+#define MOVERS 64           // objects moved a frame
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Frame f: from above the plain, looking across it, sliding forward and sideways (or turning) a little each frame
+static void camera_at(float f, bool turning, float jump, mat4x4 view_projection)
+{
+    const float yaw = turning ? 0.002f * f : 0.3f;
+    vec3 eye = { 0.02f * f + jump, 0.05f * f - 0.25f * SPREAD, 40.f };
+    vec3 center = { eye[0] + sinf(yaw) * SPREAD, eye[1] + cosf(yaw) * SPREAD, 0.f }, up = { 0.f, 0.f, 1.f };
+    mat4x4 projection, view;
+    mat4x4_perspective(projection, 1.f, 16.f / 9.f, 0.1f, SPREAD);
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(view_projection, projection, view);
+}
+
+static float depth_of(mat4x4 const vp, float x, float y)
+{
+    return vp[0][2] * x + vp[1][2] * y + vp[3][2];
+}
+
+static int compare_ids(const void* a, const void* b)
+{
+    const uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// The visible objects' draws, keyed by depth as the app's naive path keys them, in the list's order
+static void record(RenderQueue* queue, mat4x4 const vp, const float* x, const float* y, const uint32_t* visible,
+    size_t n)
+{
+    render_queue_clear(queue);
+    RenderQueueEntry* entries = render_queue_reserve(queue, n);
+    for (size_t k = 0; k < n && entries; ++k)
+    {
+        const float d = depth_of(vp, x[visible[k]], y[visible[k]]) / SPREAD;
+        entries[k] = { render_key(0, 0, 0, 0, render_key_depth(d * 0.5f + 0.5f, false)), visible[k], 0 };
+    }
+}
+
+typedef struct Run
+{
+    bool same, in_order, queue_sorted;  // every frame
+    size_t coherent_sorts, coherent_queues, visible;
+    double cull_ms, sort_ms, queue_ms;  // summed over the frames after the first
+    double full_cull_ms, full_queue_ms;
+} Run;
+
+// "frames" frames after a first of a camera sliding or turning, a few objects moving, each checked against a full
+// cull and sort; the last jumps a long way
+static Run run(CoherentCull* cull, RenderQueue* queue, bool turning, int frames, std::vector<float>& x,
+    std::vector<float>& y, const std::vector<float>& radius, unsigned int* state)
+{
+    const uint32_t count = (uint32_t)x.size();
+    std::vector<uint32_t> visible(count), expected(count), sorted(count), moved(MOVERS);
+    std::vector<float> keys(count);
+    Run r = { true, true, true, 0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    coherent_cull_reset(cull);
+    for (int f = 0; f <= frames; ++f)
+    {
+        for (uint32_t m = 0; m < MOVERS && f > 0; ++m)
+        {
+            moved[m] = (uint32_t)(random_float(state, 0.f, 1.f) * (float)(count - 1));
+            x[moved[m]] += random_float(state, -5.f, 5.f);
+            y[moved[m]] += random_float(state, -5.f, 5.f);
+        }
+        if (f > 0)
+            coherent_cull_moved(cull, moved.data(), MOVERS);
+        mat4x4 vp;
+        camera_at((float)f, turning, f == frames ? 0.5f * SPREAD : 0.f, vp);
+        Frustum frustum;
+        frustum_from_matrix(&frustum, vp);
+
+        double t0 = now_ms();
+        const size_t n = coherent_cull(cull, &frustum, x.data(), y.data(), NULL, radius.data(), visible.data());
+        double t1 = now_ms();
+        for (size_t k = 0; k < n; ++k)
+            keys[k] = depth_of(vp, x[visible[k]], y[visible[k]]);
+        const bool coherent = coherent_cull_sort(cull, visible.data(), keys.data(), n);
+        double t2 = now_ms();
+        record(queue, vp, x.data(), y.data(), visible.data(), n);
+        double t3 = now_ms();
+        const bool queue_coherent = render_queue_sort_coherent(queue, NULL);
+        double t4 = now_ms();
+        for (size_t k = 1; k < n; ++k)
+            r.queue_sorted = r.queue_sorted && queue->entries[k - 1].key <= queue->entries[k].key;
+        for (size_t k = 1; k < n; ++k)
+            r.in_order = r.in_order && keys[k - 1] <= keys[k] && keys[k] == depth_of(vp, x[visible[k]], y[visible[k]]);
+        if (f > 0 && f < frames)
+        {
+            r.cull_ms += t1 - t0;
+            r.sort_ms += t2 - t1;
+            r.queue_ms += t4 - t3;
+            r.coherent_sorts += coherent;
+            r.coherent_queues += queue_coherent;
+            r.visible += n;
+        }
+
+        // Everything culled and sorted afresh
+        t0 = now_ms();
+        const size_t m = frustum_cull_spheres(&frustum, x.data(), y.data(), NULL, radius.data(), count,
+            expected.data());
+        t1 = now_ms();
+        record(queue, vp, x.data(), y.data(), expected.data(), m);
+        t2 = now_ms();
+        render_queue_sort(queue, NULL);
+        t3 = now_ms();
+        if (f > 0 && f < frames)
+        {
+            r.full_cull_ms += t1 - t0;
+            r.full_queue_ms += t3 - t2;
+        }
+        memcpy(sorted.data(), visible.data(), sizeof(uint32_t) * n);
+        qsort(sorted.data(), n, sizeof(uint32_t), compare_ids);
+        r.same = r.same && n == m && !memcmp(sorted.data(), expected.data(), sizeof(uint32_t) * n);
+    }
+    return r;
+}
+
+static void print(const char* name, const Run* r, const CoherentCull* cull, uint64_t tested, int frames)
+{
+    const double n = frames - 1;
+    printf("  %s: %.0f visible, %.2f%% of objects tested a frame, %zu of %d lists and %zu queues sorted by insertion\n",
+        name, r->visible / n, 100.0 * (double)tested / ((double)cull->count * (frames + 1)), r->coherent_sorts,
+        frames - 1, r->coherent_queues);
+    printf("    coherent: cull %7.3f ms, sort %7.3f ms, queue %7.3f ms\n", r->cull_ms / n, r->sort_ms / n,
+        r->queue_ms / n);
+    printf("    full:     cull %7.3f ms,                   queue %7.3f ms\n", r->full_cull_ms / n,
+        r->full_queue_ms / n);
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t count = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 1000000;
+    const int frames = argc > 2 && atoi(argv[2]) > 1 ? atoi(argv[2]) : 200;
+    unsigned int state = 12345u;
+    bool ok = true;
+
+    // Laid out row by row, a little jittered, as the app's grid and a cooked scene's spatial order have them
+    std::vector<float> x(count), y(count), radius(count);
+    const uint32_t cols = (uint32_t)ceil(sqrt((double)count));
+    const float cell = 2.f * SPREAD / (float)cols;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        x[i] = -SPREAD + cell * ((float)(i % cols) + random_float(&state, 0.25f, 0.75f));
+        y[i] = -SPREAD + cell * ((float)(i / cols) + random_float(&state, 0.25f, 0.75f));
+        radius[i] = random_float(&state, 0.2f, 1.f) * cell;
+    }
+    CoherentCull cull;
+    RenderQueue queue;
+    if (!coherent_cull_init(&cull, count) || !render_queue_init(&queue, count))
+        return EXIT_FAILURE;
+
+    const Run slide = run(&cull, &queue, false, frames, x, y, radius, &state);
+    const uint64_t slide_tested = cull.tested, slide_full = cull.full;
+    const Run turn = run(&cull, &queue, true, frames, x, y, radius, &state);
+    ok = report("the visible set is a full cull's, every frame", slide.same && turn.same) && ok;
+    ok = report("the kept list is in depth order", slide.in_order && turn.in_order) && ok;
+    ok = report("the queue's coherent sort leaves it in key order", slide.queue_sorted && turn.queue_sorted) && ok;
+    ok = report("a sliding camera keeps the order by insertion", slide.coherent_sorts == (size_t)frames - 1
+        && slide.coherent_queues == (size_t)frames - 1) && ok;
+    ok = report("the first frames and the jumps are culled in full", slide_full == 2 && cull.full == 4) && ok;
+
+    printf("%u objects, a frame over %d frames:\n", count, frames - 1);
+    print("sliding", &slide, &cull, slide_tested, frames);
+    print("turning", &turn, &cull, cull.tested - slide_tested, frames);
+    coherent_cull_print(&cull, stdout);
+    coherent_cull_destroy(&cull);
+    render_queue_destroy(&queue);
+    printf("%s\n", ok ? "coherent_cull_bench: ok" : "coherent_cull_bench: FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,292 @@
+// Command list check (src/core/command_list.h): draws recorded across the job system come back from replay each
+// exactly once, with their own commands, in key order; repeated bindings are left out and counted; a thread outside
+// the job system records too; draws recorded into entries claimed up front keep their order, and the coherent sort
+// finishes them when they're nearly sorted; draws that don't fit are refused and counted. Then recording is timed
+// on 1..N threads against one, with the sort and the replay after it.
+//
+// Usage: command_list_bench [draws] [max threads]
+
+#include "core/command_list.h"
+#include "core/job_system.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-46s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static inline uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    return x;
+}
+
+// Draw i: one of 4 programs and 2 vertex arrays, a material attribute of 8, its own uniform block and a random depth,
+// the way the app's naive path records an object
+static inline uint64_t draw_key(uint32_t i)
+{
+    return render_key(0, i % 4, 0, (i / 4) % 2, hash(i) & ((1u << RENDER_KEY_DEPTH_BITS) - 1u));
+}
+
+static inline void write_draw(Command* c, uint32_t i)
+{
+    c[0] = { COMMAND_PROGRAM, 0, (uint16_t)(i % 4), 0 };
+    c[1] = { COMMAND_VERTEX_ARRAY, 0, (uint16_t)((i / 4) % 2), 0 };
+    c[2] = { COMMAND_ATTRIBUTE, 5, 0, i % 8 };
+    c[3] = { COMMAND_UNIFORM, 2, 0, i };
+    c[4] = { COMMAND_DRAW, 0, (uint16_t)(i % 3), i };
+}
+
+static inline bool record_draw(CommandList* list, uint32_t i)
+{
+    Command* c = command_list_record(list, draw_key(i), 5);
+    if (c)
+        write_draw(c, i);
+    return c != NULL;
+}
+
+static void record_range(void* data, size_t begin, size_t end)
+{
+    CommandList* list = (CommandList*)data;
+    for (size_t i = begin; i < end; ++i)
+        record_draw(list, (uint32_t)i);
+}
+
+// Draw i's depth alone, nearly in order: every 50th is a few places late
+static inline uint32_t near_depth(uint32_t i)
+{
+    return i % 50 ? i : i + 3;
+}
+
+// Draw i into the i-th of "entries", claimed up front, keyed by near_depth or by draw_key's random order
+typedef struct OrderedRecording
+{
+    CommandList* list;
+    RenderQueueEntry* entries;
+    bool shuffled;
+} OrderedRecording;
+
+static void record_ordered_range(void* data, size_t begin, size_t end)
+{
+    OrderedRecording* o = (OrderedRecording*)data;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const uint64_t key = o->shuffled ? draw_key((uint32_t)i) : render_key(0, 0, 0, 0, near_depth((uint32_t)i));
+        if (Command* c = command_list_record_at(o->list, &o->entries[i], key, 5))
+            write_draw(c, (uint32_t)i);
+    }
+}
+
+typedef struct Replayed
+{
+    std::vector<uint32_t> order;    // the draws' objects, in replay order
+    std::vector<uint8_t> seen;
+    uint32_t block;                 // the uniform command's value, to match against the draw that follows
+    uint32_t program, vertex_array, material;
+    bool intact;                    // every draw's state and block were its own
+    size_t bindings;
+} Replayed;
+
+static void replay_command(void* user, const Command* c)
+{
+    Replayed* r = (Replayed*)user;
+    switch (c->type)
+    {
+    case COMMAND_PROGRAM: r->program = c->id; ++r->bindings; break;
+    case COMMAND_VERTEX_ARRAY: r->vertex_array = c->id; ++r->bindings; break;
+    case COMMAND_ATTRIBUTE: r->material = c->value; ++r->bindings; break;
+    case COMMAND_UNIFORM: r->block = c->value; break;
+    case COMMAND_DRAW:
+    {
+        const uint32_t i = c->value;
+        r->intact = r->intact && i < r->seen.size() && r->block == i && c->id == i % 3 && r->program == i % 4
+            && r->vertex_array == (i / 4) % 2 && r->material == i % 8;
+        if (i < r->seen.size())
+            r->seen[i]++;
+        r->order.push_back(i);
+        break;
+    }
+    }
+}
+
+static Replayed replay(const CommandList* list, size_t draws, CommandReplayStats* stats)
+{
+    Replayed r;
+    r.seen.assign(draws, 0);
+    r.block = r.program = r.vertex_array = r.material = ~0u;
+    r.intact = true;
+    r.bindings = 0;
+    command_list_replay(list, replay_command, &r, stats);
+    return r;
+}
+
+static bool correctness(JobSystem* jobs, uint32_t draws)
+{
+    bool ok = true;
+    CommandList list;
+    if (!command_list_init(&list, draws, jobs->thread_count))
+        return false;
+    command_list_begin(&list);
+    job_wait(jobs, job_parallel_for(jobs, record_range, &list, draws, 256));
+    command_list_sort(&list, jobs);
+    CommandReplayStats stats;
+    Replayed r = replay(&list, draws, &stats);
+
+    bool once = r.order.size() == draws;
+    for (uint32_t i = 0; i < draws && once; ++i)
+        once = r.seen[i] == 1;
+    ok = report("every draw replayed exactly once", once && stats.draws == draws
+        && command_list_draw_count(&list) == draws) && ok;
+    ok = report("each draw's commands are its own", r.intact) && ok;
+    bool sorted = true;
+    for (size_t k = 1; k < r.order.size(); ++k)
+        sorted = sorted && draw_key(r.order[k - 1]) <= draw_key(r.order[k]);
+    ok = report("draws come back in key order", sorted) && ok;
+
+    // What a submission walking the sorted order would have to bind anyway
+    size_t needed = 0;
+    for (size_t k = 0; k < r.order.size(); ++k)
+    {
+        const uint32_t i = r.order[k], p = k ? r.order[k - 1] : ~0u;
+        needed += !k || i % 4 != p % 4;
+        needed += !k || (i / 4) % 2 != (p / 4) % 2;
+        needed += !k || i % 8 != p % 8;
+    }
+    ok = report("only changed bindings reach the callback", r.bindings == needed
+        && stats.skipped == (size_t)draws * 3 - needed) && ok;
+    printf("  %u draws: %zu bindings replayed, %zu repeats skipped\n", draws, r.bindings, stats.skipped);
+
+    // A thread outside the job system (a render thread) has an arena of its own
+    command_list_begin(&list);
+    std::thread outside([&]() { record_range(&list, 0, 1000); });
+    outside.join();
+    job_wait(jobs, job_parallel_for(jobs, record_range, &list, 1000, 64));  // the same draws again, from the jobs
+    command_list_sort(&list, jobs);
+    r = replay(&list, 1000, &stats);
+    bool twice = r.order.size() == 2000 && r.intact;
+    for (uint32_t i = 0; i < 1000 && twice; ++i)
+        twice = r.seen[i] == 2;
+    ok = report("a thread outside the job system records too", twice) && ok;
+
+    // Again with the old frame's data still in the chunks: begin drops it all
+    command_list_begin(&list);
+    job_wait(jobs, job_parallel_for(jobs, record_range, &list, 10, 1));
+    command_list_sort(&list, jobs);
+    r = replay(&list, 10, &stats);
+    ok = report("begin drops the last frame's draws", r.order.size() == 10 && r.intact) && ok;
+
+    // Claimed up front, the draws keep their entries' order however the jobs interleave; nearly sorted, the
+    // coherent sort finishes them, and a shuffle falls back to the full sort
+    command_list_begin(&list);
+    OrderedRecording ordered = { &list, command_list_reserve(&list, draws), false };
+    if (ordered.entries)
+        job_wait(jobs, job_parallel_for(jobs, record_ordered_range, &ordered, draws, 256));
+    r = replay(&list, draws, &stats);
+    bool kept = ordered.entries && r.order.size() == draws && r.intact;
+    for (uint32_t i = 0; i < draws && kept; ++i)
+        kept = r.order[i] == i;
+    ok = report("reserved entries keep the recording order", kept) && ok;
+    const bool coherent = command_list_sort_coherent(&list, jobs);
+    r = replay(&list, draws, &stats);
+    sorted = r.order.size() == draws && r.intact;
+    for (size_t k = 1; k < r.order.size() && sorted; ++k)
+        sorted = near_depth(r.order[k - 1]) <= near_depth(r.order[k]);
+    ok = report("a nearly sorted list sorts coherently", coherent && sorted) && ok;
+    command_list_begin(&list);
+    ordered = { &list, command_list_reserve(&list, draws), true };
+    if (ordered.entries)
+        job_wait(jobs, job_parallel_for(jobs, record_ordered_range, &ordered, draws, 256));
+    const bool gave_up = !command_list_sort_coherent(&list, jobs);
+    r = replay(&list, draws, &stats);
+    sorted = r.order.size() == draws && r.intact;
+    for (size_t k = 1; k < r.order.size() && sorted; ++k)
+        sorted = draw_key(r.order[k - 1]) <= draw_key(r.order[k]);
+    ok = report("a shuffled one falls back to the full sort", gave_up && sorted) && ok;
+    command_list_destroy(&list);
+
+    // Room for 100 draws: the rest are refused and counted, the recorded ones still replay
+    if (!command_list_init(&list, 100, 1))
+        return false;
+    command_list_begin(&list);
+    uint32_t recorded = 0;
+    for (uint32_t i = 0; i < 1000; ++i)
+        recorded += record_draw(&list, i);
+    command_list_sort(&list, NULL);
+    r = replay(&list, 1000, &stats);
+    ok = report("a full list refuses and counts it", recorded >= 100 && recorded < 1000
+        && list.failed.load() == 1000 - recorded && r.order.size() == recorded && r.intact) && ok;
+    command_list_destroy(&list);
+    return ok;
+}
+
+// Recording "draws" on "threads" threads, best of "runs"
+static double time_recording(uint32_t draws, int threads, int runs, double* sort_ms, double* replay_ms, bool* ok)
+{
+    JobSystem jobs;
+    job_system_init(&jobs, threads);
+    CommandList list;
+    command_list_init(&list, draws, jobs.thread_count);
+    double best = 1e30;
+    *sort_ms = *replay_ms = 1e30;
+    for (int run = 0; run < runs; ++run)
+    {
+        command_list_begin(&list);
+        const double t0 = now_ms();
+        job_wait(&jobs, job_parallel_for(&jobs, record_range, &list, draws, 4096));
+        const double t1 = now_ms();
+        command_list_sort(&list, &jobs);
+        const double t2 = now_ms();
+        size_t drawn = 0;
+        command_list_replay(&list, [](void* user, const Command* c) { *(size_t*)user += c->type == COMMAND_DRAW; },
+            &drawn, NULL);
+        const double t3 = now_ms();
+        *ok = *ok && drawn == draws;
+        best = t1 - t0 < best ? t1 - t0 : best;
+        *sort_ms = t2 - t1 < *sort_ms ? t2 - t1 : *sort_ms;
+        *replay_ms = t3 - t2 < *replay_ms ? t3 - t2 : *replay_ms;
+    }
+    command_list_destroy(&list);
+    job_system_destroy(&jobs);
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t draws = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 1000000;
+    const int max_threads = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+
+    printf("correctness:\n");
+    JobSystem jobs;
+    job_system_init(&jobs, max_threads < 4 ? 4 : max_threads);
+    bool ok = correctness(&jobs, 100000);
+    job_system_destroy(&jobs);
+
+    printf("recording %u draws (5 commands each):\n", draws);
+    double single = 0.0;
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        double sort_ms, replay_ms;
+        const double ms = time_recording(draws, threads, 10, &sort_ms, &replay_ms, &ok);
+        if (threads == 1)
+            single = ms;
+        printf("  %2d threads: record %7.2f ms (x%.2f), sort %6.2f ms, replay %6.2f ms\n", threads, ms,
+            ms > 0.0 ? single / ms : 0.0, sort_ms, replay_ms);
+        if (threads < max_threads && threads * 2 > max_threads)
+            threads = max_threads / 2;      // end on max_threads itself
+    }
+    printf("%s\n", ok ? "command_list_bench: ok" : "command_list_bench: FAIL");
+    return ok ? 0 : 1;
+}
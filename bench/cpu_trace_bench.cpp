@@ -0,0 +1,187 @@
+// CPU trace check: times CPU_TRACE_SCOPE (src/core/cpu_trace.h) with tracing off and on, single-threaded and
+// with every thread recording at once, and the trace clock against steady_clock. Then checks that each
+// thread's track holds exactly its own scopes, properly nested, and that the exported Chrome JSON has one
+// complete event per recorded scope and one counter event per counter sample.
+//
+// Usage: cpu_trace_bench [scopes per thread] [threads] [output.json]
+//
+// The JSON goes to the build directory unless a path is given.
+
+#include "core/cpu_trace.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifndef BENCH_OUTPUT_DIR
+#define BENCH_OUTPUT_DIR "."    // CMake passes its build directory
+#endif
+
+static double now_ns()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static volatile unsigned int sink;
+
+// "count" scopes, each with one nested inside: 2 * count events
+static void nested_scopes(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        CPU_TRACE_SCOPE("outer");
+        sink = sink + 1;
+        {
+            CPU_TRACE_SCOPE("inner");
+            sink = sink + 1;
+        }
+    }
+}
+
+// The same loop with no scopes, to take out of the timings
+static void empty_loop(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        sink = sink + 1;
+        sink = sink + 1;
+    }
+}
+
+static double ns_per_scope(int count)
+{
+    double start = now_ns();
+    empty_loop(count);
+    const double base = now_ns() - start;
+    start = now_ns();
+    nested_scopes(count);
+    const double traced = now_ns() - start;
+    return (traced - base) / (2.0 * count);
+}
+
+// Counts occurrences of "needle" in the file
+static long count_in_file(const char* path, const char* needle)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return -1;
+    std::vector<char> text;
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        text.insert(text.end(), buffer, buffer + n);
+    fclose(f);
+    text.push_back(0);
+    long count = 0;
+    for (const char* p = text.data(); (p = strstr(p, needle)) != NULL; p += strlen(needle))
+        ++count;
+    return count;
+}
+
+int main(int argc, char** argv)
+{
+    const int scopes = argc > 1 ? atoi(argv[1]) : 10000;
+    const int thread_count = argc > 2 ? atoi(argv[2]) : 4;
+    const char* path = argc > 3 ? argv[3] : BENCH_OUTPUT_DIR "/cpu_trace_bench.json";
+    if (scopes < 1 || 2 * scopes > CPU_TRACE_EVENTS || thread_count < 1 || thread_count + 2 > CPU_TRACE_MAX_TRACKS)
+    {
+        fprintf(stderr, "usage: %s [scopes per thread, up to %d] [threads] [output.json]\n", argv[0], CPU_TRACE_EVENTS / 2);
+        return EXIT_FAILURE;
+    }
+    bool ok = true;
+
+    // Off: one relaxed load per scope, nothing recorded
+    const double off_ns = ns_per_scope(scopes);
+    printf("tracing off: %6.1f ns/scope\n", off_ns);
+
+    cpu_trace_init();
+    const double tick_start = (double)cpu_trace_now(), ns_start = now_ns();
+    cpu_trace_thread_name("main");
+    const double on_ns = ns_per_scope(scopes / 2);  // half here, leaving room in the ring for the check below
+    printf("tracing on:  %6.1f ns/scope, %.3f ticks/ns\n", on_ns, cpu_trace_ticks_per_ns());
+
+    // Every thread at once, each on its own track
+    std::vector<std::thread> threads;
+    std::vector<double> thread_ns(thread_count);
+    for (int t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([t, scopes, &thread_ns]
+        {
+            char name[CPU_TRACE_NAME_SIZE];
+            snprintf(name, sizeof(name), "worker %d", t);
+            cpu_trace_thread_name(name);
+            thread_ns[t] = ns_per_scope(scopes / 2);  // plus the empty loop's, below
+            nested_scopes(scopes - scopes / 2);
+        });
+    }
+    for (std::thread& th : threads)
+        th.join();
+    double worst = 0.0;
+    for (int t = 0; t < thread_count; ++t)
+        worst = thread_ns[t] > worst ? thread_ns[t] : worst;
+    printf("%d threads:  %6.1f ns/scope on the slowest\n", thread_count, worst);
+
+    // The trace clock converts back to steady_clock time
+    const double ticks = (double)cpu_trace_now() - tick_start, ns = now_ns() - ns_start;
+    const double drift = ticks / cpu_trace_ticks_per_ns() - ns;
+    printf("clock:       %.3f ms traced as %.3f ms (%+.1f us)\n", ns * 1e-6, ns * 1e-6 + drift * 1e-6, drift * 1e-3);
+    ok = ok && (drift < 0 ? -drift : drift) < 1e-3 * ns + 2000.0;
+
+    // A track from another clock, placed through a pair of readings taken together
+    const int other = cpu_trace_track("other clock");
+    const uint64_t sync_ticks = cpu_trace_now();
+    const uint64_t sync_other = 1000000000ull;
+    for (int i = 0; i < 4; ++i)
+    {
+        const uint64_t begin = sync_other + i * 1000000ull, end = begin + 500000ull;
+        cpu_trace_emit(other, "other", sync_ticks + (uint64_t)((begin - sync_other) * cpu_trace_ticks_per_ns()),
+            sync_ticks + (uint64_t)((end - sync_other) * cpu_trace_ticks_per_ns()));
+    }
+
+    // A few counter samples on a track of their own, as the GPU profiler records its per-pass counts
+    const int counter_track = cpu_trace_track("counters");
+    const int counters = counter_track >= 0 ? 3 : 0;
+    for (int i = 0; i < counters; ++i)
+        cpu_trace_counter(counter_track, "pass", "draws", sync_ticks + (uint64_t)i * 1000u, 10.0 * i);
+
+    // Each worker's track: its scopes only, outer ones in order and each inner scope inside its outer one
+    long expected = 2L * (scopes / 2) + 4;
+    int track_count = 0;
+    const CpuTraceTrack* tracks = cpu_trace_tracks(&track_count);
+    for (int i = 0; i < track_count; ++i)
+    {
+        const CpuTraceTrack* track = &tracks[i];
+        if (strncmp(track->name, "worker ", 7))
+            continue;
+        const uint64_t n = track->count.load();
+        bool nested = n == 2ull * scopes;
+        uint64_t last_end = 0;
+        for (uint64_t k = 0; k + 1 < n && nested; k += 2)
+        {
+            const CpuTraceEvent* inner = &track->events[k];
+            const CpuTraceEvent* outer = &track->events[k + 1];
+            nested = !strcmp(inner->name, "inner") && !strcmp(outer->name, "outer") && outer->begin >= last_end
+                && outer->begin <= inner->begin && inner->end <= outer->end;
+            last_end = outer->end;
+        }
+        if (!nested)
+        {
+            fprintf(stderr, "  track \"%s\": %llu events, not %d nested pairs in order\n", track->name,
+                (unsigned long long)n, scopes);
+            ok = false;
+        }
+        expected += (long)n;
+    }
+
+    ok = cpu_trace_write(path) && ok;
+    const long written = count_in_file(path, "\"ph\":\"X\"");
+    const long samples = count_in_file(path, "\"ph\":\"C\"");
+    ok = written == expected && samples == counters && ok;
+    printf("%s: %ld complete events, %ld expected, %ld counter samples of %d  %s\n", path, written, expected, samples,
+        counters, ok ? "ok" : "FAIL");
+    cpu_trace_shutdown();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
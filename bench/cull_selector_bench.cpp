@@ -0,0 +1,99 @@
+// CPU/GPU cull selection (src/core/cull_selector.h): a synthetic run whose scene is small, then big, then small
+// again, then near where the two paths cost the same. The CPU's cost grows with the objects; the GPU's is a fixed
+// dispatch plus a little per object, and comes back GPU_LATENCY frames late, as the profiler's does. Each frame's
+// costs are jittered. Checks that each phase settles on its cheaper path, that the near tie doesn't flip back and
+// forth, and what the trials cost once settled against always running the cheaper path.
+//
+// Usage: cull_selector_bench [frames per phase]
+
+#include "core/cull_selector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define GPU_LATENCY 5       // frames before a GPU cost is read back
+#define JITTER 0.15         // each frame's cost is within this fraction of the model's
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-56s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static double random_unit(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (double)(*state >> 8) / 16777216.0;
+}
+
+// A frame's cost of culling "objects" each way, in ms
+static double path_cost(CullPath path, double objects)
+{
+    return path == CULL_PATH_CPU ? 6e-6 * objects : 0.25 + 6e-7 * objects;
+}
+
+typedef struct Phase
+{
+    const char* name;
+    double objects;
+} Phase;
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 && atoi(argv[1]) > CULL_SELECT_RETRY_MAX_FRAMES ? atoi(argv[1]) : 20000;
+    const Phase phases[] = { { "small (10k objects)", 1e4 }, { "big (1M objects)", 1e6 },
+        { "small again", 1e4 }, { "near the crossover (46k)", 4.6e4 } };
+    unsigned int state = 12345u;
+    bool ok = true;
+
+    CullSelector selector;
+    cull_selector_init(&selector, "bench");
+    double in_flight[GPU_LATENCY] = {};     // the GPU's costs not read back yet, by frame; 0 for a CPU frame
+    int frame = 0;
+    for (const Phase& phase : phases)
+    {
+        const CullPath cheaper = path_cost(CULL_PATH_CPU, phase.objects) < path_cost(CULL_PATH_GPU, phase.objects)
+            ? CULL_PATH_CPU : CULL_PATH_GPU;
+        const uint32_t switches = selector.switches;
+        const uint32_t trials = selector.trials;
+        double spent = 0.0, best = 0.0;
+        int settled = -1, on_cheaper = 0, after = 0;
+        for (int f = 0; f < frames; ++f, ++frame)
+        {
+            const CullPath path = cull_selector_next(&selector);
+            const double cost = path_cost(path, phase.objects) * (1.0 + JITTER * (2.0 * random_unit(&state) - 1.0));
+            const int slot = frame % GPU_LATENCY;
+            if (in_flight[slot] > 0.0)
+                cull_selector_cost(&selector, CULL_PATH_GPU, in_flight[slot]);
+            in_flight[slot] = path == CULL_PATH_GPU ? cost : 0.0;
+            if (path == CULL_PATH_CPU)
+                cull_selector_cost(&selector, CULL_PATH_CPU, cost);
+            if (settled < 0 && selector.path == cheaper)
+                settled = f;
+            if (settled >= 0)
+            {
+                on_cheaper += path == cheaper;
+                ++after;
+                spent += cost;
+                best += path_cost(cheaper, phase.objects);
+            }
+        }
+        printf("%s: cpu %.3f ms, gpu %.3f ms; settled on the %s after %d frames; after, %.2f%% of frames on the "
+            "cheaper path and %.2f%% over always it; %u switches in %u trials\n", phase.name,
+            path_cost(CULL_PATH_CPU, phase.objects), path_cost(CULL_PATH_GPU, phase.objects),
+            cull_path_names[cheaper], settled, after ? 100.0 * on_cheaper / after : 0.0,
+            best > 0.0 ? 100.0 * (spent - best) / best : 0.0, selector.switches - switches, selector.trials - trials);
+        if (&phase - phases < 3)
+        {
+            ok = report("settles on the cheaper path within 2 trials", settled >= 0
+                && settled <= 2 * (CULL_SELECT_RETRY_FRAMES + CULL_SELECT_TRIAL_FRAMES)) && ok;
+            ok = report("then keeps to it outside the trials", after && on_cheaper >= after * 0.99) && ok;
+            ok = report("the trials then cost under 2% over always it", spent - best < 0.02 * best) && ok;
+        }
+        else
+            ok = report("the near tie switches at most twice", selector.switches - switches <= 2) && ok;
+    }
+    cull_selector_print(&selector, stdout);
+    printf("%s\n", ok ? "cull_selector_bench: ok" : "cull_selector_bench: FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,176 @@
+// ECS check: fills a world with entities spread over a few archetypes, runs the transform system and
+// compares every MVP with the linmath reference, then times the update serially and on 1..N threads.
+// Also churns the world (destroy / create / add and remove components) and checks it stays consistent.
+//
+// Usage: ecs_bench [entities] [max threads]
+
+#include "core/job_system.h"
+#include "scene/ecs.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+static uint32_t random_u32(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    return lo + (hi - lo) * (float)random_u32(state) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const uint32_t archetypes[] = {
+    ECS_MASK_ALL,
+    ECS_MASK(ECS_TRANSFORM) | ECS_MASK(ECS_MESH_REF) | ECS_MASK(ECS_BOUNDS),
+    ECS_MASK(ECS_TRANSFORM) | ECS_MASK(ECS_MESH_REF),
+    ECS_MASK(ECS_MESH_REF) | ECS_MASK(ECS_MATERIAL),    // no Transform: skipped by the transform system
+};
+
+static EcsEntity spawn(EcsWorld* world, unsigned int* state)
+{
+    const uint32_t mask = archetypes[random_u32(state) % (sizeof(archetypes) / sizeof(archetypes[0]))];
+    const EcsEntity e = ecs_create(world, mask);
+    if (!e || !(mask & ECS_MASK(ECS_TRANSFORM)))
+        return e;
+    *(float*)ecs_field(world, e, ECS_FIELD_X) = random_float(state, -100.f, 100.f);
+    *(float*)ecs_field(world, e, ECS_FIELD_Y) = random_float(state, -100.f, 100.f);
+    *(float*)ecs_field(world, e, ECS_FIELD_Z) = random_float(state, -1.f, 1.f);
+    *(float*)ecs_field(world, e, ECS_FIELD_ANGLE) = random_float(state, -3.14159f, 3.14159f);
+    *(float*)ecs_field(world, e, ECS_FIELD_SCALE) = random_float(state, 0.5f, 2.f);
+    return e;
+}
+
+// Every transformed entity's MVP against view_projection * translate * scale * rotate_Z
+static bool check_transforms(EcsWorld* world, const std::vector<EcsEntity>& entities, mat4x4 const vp)
+{
+    float worst = 0.f;
+    for (EcsEntity e : entities)
+    {
+        if (!ecs_alive(world, e) || !(ecs_mask(world, e) & ECS_MASK(ECS_TRANSFORM)))
+            continue;
+        const float k = *(float*)ecs_field(world, e, ECS_FIELD_SCALE);
+        mat4x4 model, expected;
+        mat4x4_translate(model, *(float*)ecs_field(world, e, ECS_FIELD_X), *(float*)ecs_field(world, e, ECS_FIELD_Y),
+            *(float*)ecs_field(world, e, ECS_FIELD_Z));
+        mat4x4_scale_aniso(model, model, k, k, k);
+        mat4x4_rotate_Z(model, model, *(float*)ecs_field(world, e, ECS_FIELD_ANGLE));
+        mat4x4_mul(expected, vp, model);
+        const vec4* mvp = *(const mat4x4*)ecs_field(world, e, ECS_FIELD_MVP);
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                worst = fmaxf(worst, fabsf(mvp[c][r] - expected[c][r]) / fmaxf(1.f, fabsf(expected[c][r])));
+    }
+    if (worst > 1e-5f)
+        fprintf(stderr, "  MVP off by %g\n", worst);
+    return worst <= 1e-5f;
+}
+
+// Every live entity's record and its chunk's entity id agree, and the per-archetype counts add up
+static bool check_world(const EcsWorld* world)
+{
+    size_t total = 0;
+    for (uint32_t m = 0; m < ECS_ARCHETYPE_COUNT; ++m)
+    {
+        const EcsArchetype* a = &world->archetypes[m];
+        size_t count = 0;
+        for (uint32_t c = 0; c < a->chunk_count; ++c)
+        {
+            const EcsChunk* chunk = &a->chunks[c];
+            if (!chunk->count || (c + 1 < a->chunk_count && chunk->count != ECS_CHUNK_CAPACITY))
+                return false;
+            const EcsEntity* ids = ecs_chunk_entities(a, chunk);
+            for (uint32_t row = 0; row < chunk->count; ++row)
+            {
+                const EcsRecord* r = &world->records[ids[row] & 0xFFFFFu];
+                if (!ecs_alive(world, ids[row]) || r->mask != m || r->chunk != c || r->row != row)
+                    return false;
+            }
+            count += chunk->count;
+        }
+        if (count != a->entity_count)
+            return false;
+        total += count;
+    }
+    return total == world->live;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t entities = argc > 1 ? (uint32_t)atol(argv[1]) : 1000000u;
+    const int max_threads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    const int runs = 20;
+
+    EcsWorld world;
+    if (!ecs_init(&world, entities))
+        return EXIT_FAILURE;
+    unsigned int state = 12345u;
+    std::vector<EcsEntity> ids(entities);
+    double start = now_ms();
+    for (uint32_t i = 0; i < entities; ++i)
+        ids[i] = spawn(&world, &state);
+    printf("%u entities created in %.1f ms\n", entities, now_ms() - start);
+
+    mat4x4 projection, view, vp;
+    mat4x4_perspective(projection, 1.f, 16.f / 9.f, 0.1f, 500.f);
+    vec3 eye = { 0.f, -50.f, 120.f }, center = { 0.f, 0.f, 0.f }, up = { 0.f, 0.f, 1.f };
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(vp, projection, view);
+
+    ecs_update_transforms(&world, NULL, vp);
+    bool ok = check_transforms(&world, ids, vp);
+
+    start = now_ms();
+    for (int r = 0; r < runs; ++r)
+        ecs_update_transforms(&world, NULL, vp);
+    const double serial_ms = (now_ms() - start) / runs;
+    printf("transform -> MVP, serial  %7.3f ms  %s\n", serial_ms, ok ? "ok" : "MISMATCH");
+
+    printf("threads  update ms  speedup\n");
+    for (int threads = 1; threads <= max_threads; threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2)
+    {
+        JobSystem js;
+        if (!job_system_init(&js, threads))
+            return EXIT_FAILURE;
+        ecs_update_transforms(&world, &js, vp);
+        start = now_ms();
+        for (int r = 0; r < runs; ++r)
+            ecs_update_transforms(&world, &js, vp);
+        const double ms = (now_ms() - start) / runs;
+        job_system_destroy(&js);
+        printf("%7d  %9.3f  %6.2fx\n", threads, ms, serial_ms / ms);
+        if (threads == max_threads)
+            break;
+    }
+
+    // Churn: a tenth of the entities destroyed and respawned, another tenth gaining or losing components
+    start = now_ms();
+    const uint32_t churn = entities / 10;
+    for (uint32_t n = 0; n < churn; ++n)
+    {
+        const uint32_t i = random_u32(&state) % entities;
+        ecs_destroy_entity(&world, ids[i]);
+        ids[i] = spawn(&world, &state);
+        const uint32_t j = random_u32(&state) % entities;
+        ecs_set_mask(&world, ids[j], ecs_mask(&world, ids[j]) ^ ECS_MASK(ECS_MATERIAL));
+    }
+    printf("churn: %u respawns + %u component changes in %.1f ms\n", churn, churn, now_ms() - start);
+    const bool consistent = check_world(&world);
+    printf("world consistent: %s\n", consistent ? "ok" : "BROKEN");
+    ecs_update_transforms(&world, NULL, vp);
+    const bool churned_ok = check_transforms(&world, ids, vp);
+    printf("MVPs after churn: %s\n", churned_ok ? "ok" : "MISMATCH");
+
+    ecs_destroy(&world);
+    return ok && consistent && churned_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,286 @@
+// Fast math check: sweeps the linmath_fast.h kernels (scalar and batch) against double-precision libm and fails
+// when any result is outside the error bounds documented there, checks the batches built on them against the
+// linmath.h functions, then times each batch kernel against the libm loop it replaces. Build the scalar variant
+// (LINMATH_NO_SIMD) to check the fallback code as well.
+//
+// Usage: fast_math_bench [elements] [reps]
+
+#include "linmath_fast.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SINCOS_BOUND 1.2e-7
+#define RSQRT_BOUND 3e-7
+#define DERIVED_BOUND 1e-6      // functions built on the kernels: one kernel error plus a few roundings
+#define TURNS 1024              // sincos_rotate_batch turns in a row, as the app's between resyncs
+#define TURN_BOUND (SINCOS_BOUND + TURNS * 2.4e-7)
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static float frand(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(*state >> 8) / 16777216.f;    // [0, 1)
+}
+
+static bool report(const char* what, double worst, double bound)
+{
+    const bool ok = worst <= bound;
+    printf("  %-40s %10.3g  (bound %.3g)  %s\n", what, worst, bound, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// 2^24 evenly spaced points over [-FAST_SINCOS_MAX, FAST_SINCOS_MAX], through both entry points
+static bool check_sincos()
+{
+    const long steps = 1L << 24;
+    const size_t block = 256;
+    float x[block], s[block], c[block];
+    double scalar = 0., batch = 0.;
+    for (long k = -steps / 2; k < steps / 2; k += (long)block)
+    {
+        for (size_t m = 0; m < block; ++m)
+            x[m] = (float)((double)(k + (long)m) * (2. * FAST_SINCOS_MAX / (double)steps));
+        fast_sincos_batch(s, c, x, block);
+        for (size_t m = 0; m < block; ++m)
+        {
+            const double rs = sin((double)x[m]), rc = cos((double)x[m]);
+            float ss, sc;
+            fast_sincos(x[m], &ss, &sc);
+            scalar = fmax(scalar, fmax(fabs(ss - rs), fabs(sc - rc)));
+            batch = fmax(batch, fmax(fabs(s[m] - rs), fabs(c[m] - rc)));
+        }
+    }
+    const bool a = report("fast_sincos (abs)", scalar, SINCOS_BOUND);
+    const bool b = report("fast_sincos_batch (abs)", batch, SINCOS_BOUND);
+    return a && b;
+}
+
+// Every float in [1, 4), which covers both exponent parities the estimates depend on, then a stride through
+// the rest of the normal range
+static bool check_rsqrt()
+{
+    double scalar = 0., batch = 0.;
+    std::vector<float> x, r;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        x.clear();
+        const uint32_t begin = pass ? 0x00800000u : 0x3f800000u, end = pass ? 0x7f7fffffu : 0x40800000u;
+        const uint32_t stride = pass ? 127u : 1u;
+        for (uint32_t bits = begin; bits < end; bits += stride)
+        {
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            x.push_back(f);
+        }
+        r.resize(x.size());
+        fast_rsqrt_batch(r.data(), x.data(), x.size());
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            const double t = 1. / sqrt((double)x[i]);
+            scalar = fmax(scalar, fabs(fast_rsqrt(x[i]) - t) / t);
+            batch = fmax(batch, fabs(r[i] - t) / t);
+        }
+    }
+    const bool a = report("fast_rsqrt (rel)", scalar, RSQRT_BOUND);
+    const bool b = report("fast_rsqrt_batch (rel)", batch, RSQRT_BOUND);
+    return a && b;
+}
+
+// The batches built on the kernels against their linmath.h counterparts (relative to the component, or absolute
+// below 1)
+static bool check_derived(unsigned int* state)
+{
+    const size_t n = 4096;
+    std::vector<float> x(n), y(n), z(n), angle(n), tx(n), ty(n);
+    std::vector<mat3x4> fast3(n), ref3(n);
+    std::vector<mat4x4> fast4(n), ref4(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        x[i] = frand(state) * 200.f - 100.f;
+        y[i] = frand(state) * 200.f - 100.f;
+        z[i] = frand(state) * 200.f - 100.f;
+        angle[i] = frand(state) * 200.f - 100.f;
+        tx[i] = frand(state) * 100.f;
+        ty[i] = frand(state) * 100.f;
+    }
+    double norm = 0., batch = 0.;
+    std::vector<float> nx(x), ny(y), nz(z);
+    vec3_norm_soa_fast(nx.data(), ny.data(), nz.data(), n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        vec3 v = { x[i], y[i], z[i] }, e;
+        vec3_norm(e, v);
+        norm = fmax(norm, fmax(fabs(e[0] - nx[i]), fmax(fabs(e[1] - ny[i]), fabs(e[2] - nz[i]))));
+    }
+    mat3x4_translate_rotate_Z_batch(ref3.data(), tx.data(), ty.data(), NULL, angle.data(), .5f, n);
+    mat3x4_translate_rotate_Z_batch_fast(fast3.data(), tx.data(), ty.data(), NULL, angle.data(), .5f, n);
+    mat4x4_translate_rotate_Z_batch(ref4.data(), tx.data(), ty.data(), z.data(), angle.data(), .5f, n);
+    mat4x4_translate_rotate_Z_batch_fast(fast4.data(), tx.data(), ty.data(), z.data(), angle.data(), .5f, n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 4; ++c)
+                batch = fmax(batch, fabs(ref3[i][r][c] - fast3[i][r][c]) / fmax(1., fabs(ref3[i][r][c])));
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                batch = fmax(batch, fabs(ref4[i][c][r] - fast4[i][c][r]) / fmax(1., fabs(ref4[i][c][r])));
+    }
+
+    // TURNS steps of a 60 Hz spin from the angles' fast sin/cos, against libm's of where they end up
+    const float step = 1.f / 60.f;
+    std::vector<float> s(n), c(n);
+    double turned = 0., sincos = 0.;
+    fast_sincos_batch(s.data(), c.data(), angle.data(), n);
+    for (int t = 0; t < TURNS; ++t)
+        sincos_rotate_batch(s.data(), c.data(), sinf(step), cosf(step), n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double a = (double)angle[i] + TURNS * (double)step;
+        turned = fmax(turned, fmax(fabs(sin(a) - s[i]), fabs(cos(a) - c[i])));
+    }
+    // A frame's fraction of a step on from the angles, against libm's in double: angle + frame rounded to float
+    // would be further off than the kernel
+    const float frame = .4f * step;
+    fast_sincos_batch(s.data(), c.data(), angle.data(), n);
+    mat3x4_translate_rotate_Z_batch_sincos(fast3.data(), tx.data(), ty.data(), NULL, s.data(), c.data(), sinf(frame),
+        cosf(frame), .5f, n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double a = (double)angle[i] + frame, ks = .5 * sin(a), kc = .5 * cos(a);
+        sincos = fmax(sincos, fmax(fmax(fabs(kc - fast3[i][0][0]), fabs(-ks - fast3[i][0][1])),
+            fmax(fabs(ks - fast3[i][1][0]), fabs(kc - fast3[i][1][1]))));
+        sincos = fmax(sincos, fmax(fabs(tx[i] - fast3[i][0][3]), fabs(ty[i] - fast3[i][1][3])));
+    }
+    const bool a = report("vec3_norm_soa_fast vs vec3_norm", norm, DERIVED_BOUND);
+    const bool b = report("translate_rotate_Z_batch_fast", batch, DERIVED_BOUND);
+    const bool e = report("sincos_rotate_batch, 1024 turns", turned, TURN_BOUND);
+    const bool f = report("translate_rotate_Z_batch_sincos", sincos, DERIVED_BOUND);
+    return a && b && e && f;
+}
+
+typedef struct TimingData
+{
+    std::vector<float> x, y, z, angle, s, c;
+    std::vector<mat3x4> models;
+} TimingData;
+
+static double time_ns(void (*body)(TimingData*), TimingData* d, int reps)
+{
+    body(d);    // warm up
+    const double start = now_ms();
+    for (int r = 0; r < reps; ++r)
+        body(d);
+    return (now_ms() - start) * 1e6 / ((double)reps * (double)d->x.size());
+}
+
+static void libm_sincos(TimingData* d)
+{
+    for (size_t i = 0; i < d->x.size(); ++i)
+    {
+        d->s[i] = sinf(d->angle[i]);
+        d->c[i] = cosf(d->angle[i]);
+    }
+}
+static void fast_sincos_loop(TimingData* d) { fast_sincos_batch(d->s.data(), d->c.data(), d->angle.data(), d->x.size()); }
+static void libm_rsqrt(TimingData* d)
+{
+    for (size_t i = 0; i < d->x.size(); ++i)
+        d->s[i] = 1.f / sqrtf(d->z[i]);
+}
+static void fast_rsqrt_loop(TimingData* d) { fast_rsqrt_batch(d->s.data(), d->z.data(), d->x.size()); }
+static void libm_norm(TimingData* d)
+{
+    for (size_t i = 0; i < d->x.size(); ++i)
+    {
+        vec3 v = { d->x[i], d->y[i], d->z[i] };
+        vec3_norm(v, v);
+        d->x[i] = v[0] * 2.f; d->y[i] = v[1] * 2.f; d->z[i] = v[2] * 2.f;    // keep the inputs away from 0
+    }
+}
+static void fast_norm(TimingData* d)
+{
+    vec3_norm_soa_fast(d->x.data(), d->y.data(), d->z.data(), d->x.size());
+    for (size_t i = 0; i < d->x.size(); ++i)
+    {
+        d->x[i] *= 2.f; d->y[i] *= 2.f; d->z[i] *= 2.f;
+    }
+}
+static void libm_models(TimingData* d)
+{
+    mat3x4_translate_rotate_Z_batch(d->models.data(), d->x.data(), d->y.data(), NULL, d->angle.data(), .5f, d->x.size());
+}
+static void fast_models(TimingData* d)
+{
+    mat3x4_translate_rotate_Z_batch_fast(d->models.data(), d->x.data(), d->y.data(), NULL, d->angle.data(), .5f, d->x.size());
+}
+// The angles kept as sines and cosines (d->s, d->c) and turned on by a frame's fraction of a step
+static void sincos_models(TimingData* d)
+{
+    mat3x4_translate_rotate_Z_batch_sincos(d->models.data(), d->x.data(), d->y.data(), NULL, d->s.data(), d->c.data(),
+        .0066f, .99998f, .5f, d->x.size());
+}
+static void sincos_turn(TimingData* d)
+{
+    sincos_rotate_batch(d->s.data(), d->c.data(), .0166659f, .999861f, d->x.size());
+}
+
+int main(int argc, char** argv)
+{
+    const size_t elements = argc > 1 ? (size_t)atol(argv[1]) : 4096;
+    const int reps = argc > 2 ? atoi(argv[2]) : 2000;
+    if (elements == 0 || reps <= 0)
+    {
+        fprintf(stderr, "usage: %s [elements] [reps]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("accuracy (%s)\n", LINMATH_H_SIMD == LINMATH_H_SIMD_NONE ? "scalar" : "simd");
+    unsigned int state = 12345u;
+    bool ok = check_sincos();
+    ok = check_rsqrt() && ok;
+    ok = check_derived(&state) && ok;
+
+    TimingData d;
+    d.x.resize(elements); d.y.resize(elements); d.z.resize(elements);
+    d.angle.resize(elements); d.s.resize(elements); d.c.resize(elements);
+    d.models = std::vector<mat3x4>(elements);
+    for (size_t i = 0; i < elements; ++i)
+    {
+        d.x[i] = frand(&state) + .5f;
+        d.y[i] = frand(&state) + .5f;
+        d.z[i] = frand(&state) + .5f;
+        d.angle[i] = frand(&state) * 100.f - 50.f;
+    }
+    const struct
+    {
+        const char* name;
+        void (*libm)(TimingData*);
+        void (*fast)(TimingData*);
+    } kernels[] =
+    {
+        { "sincos", libm_sincos, fast_sincos_loop },
+        { "rsqrt", libm_rsqrt, fast_rsqrt_loop },
+        { "vec3 norm (SoA)", libm_norm, fast_norm },
+        { "mat3x4_translate_rotate_Z_batch", libm_models, fast_models },
+        { "  ... from kept sin/cos", libm_models, sincos_models },
+        { "sincos turn vs sincos", libm_sincos, sincos_turn },
+    };
+    printf("%zu elements, ns/element       libm      fast   speedup\n", elements);
+    for (const auto& k : kernels)
+    {
+        const double libm_ns = time_ns(k.libm, &d, reps);
+        const double fast_ns = time_ns(k.fast, &d, reps);
+        printf("  %-31s %8.3f  %8.3f  %7.2fx\n", k.name, libm_ns, fast_ns, libm_ns / fast_ns);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
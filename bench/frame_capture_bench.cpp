@@ -0,0 +1,145 @@
+// Frame capture check: writes a capture of synthetic frames (src/core/frame_capture.h) with a view blob,
+// model matrices and, on every other frame, material indices, then reads it back through the mapping and
+// compares every byte. Then cuts the file short mid-record, as a crash would, and checks that it opens with
+// the frames before the cut. Reports write and read throughput.
+//
+// Usage: frame_capture_bench [frames] [objects] [capture file]
+
+#include "core/frame_capture.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define VIEW_SIZE 344       // about a Camera
+#define MODEL_SIZE 48       // a mat3x4
+
+static double now_s()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Frame "f"'s contents, reproducible from its index
+static void fill(std::vector<unsigned char>& view, std::vector<float>& models, std::vector<uint32_t>& materials,
+    uint32_t f, uint32_t visible)
+{
+    for (size_t i = 0; i < view.size(); ++i)
+        view[i] = (unsigned char)(f * 7 + i);
+    models.resize((size_t)visible * MODEL_SIZE / sizeof(float));
+    for (size_t i = 0; i < models.size(); ++i)
+        models[i] = (float)(f * 1000003u + i);
+    materials.resize(visible);
+    for (uint32_t i = 0; i < visible; ++i)
+        materials[i] = (f + i) % 5;
+}
+
+static uint32_t visible_in(uint32_t f, uint32_t objects)
+{
+    return objects - (f * 37u) % (objects / 2 + 1);     // varies, so records differ in size
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 300;
+    const int objects = argc > 2 ? atoi(argv[2]) : 10000;
+    const char* path = argc > 3 ? argv[3] : "frame_capture_bench.bin";
+    if (frames < 2 || objects < 1)
+    {
+        fprintf(stderr, "usage: %s [frames, at least 2] [objects] [capture file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<unsigned char> view(VIEW_SIZE);
+    std::vector<float> models;
+    std::vector<uint32_t> materials;
+    FrameCaptureHeader header;
+    memset(&header, 0, sizeof(header));
+    header.view_size = VIEW_SIZE;
+    header.model_size = MODEL_SIZE;
+    header.object_count = (uint32_t)objects;
+    header.width = 1920;
+    header.height = 1080;
+    FrameCaptureWriter writer;
+    if (!frame_capture_create(&writer, path, &header))
+        return EXIT_FAILURE;
+    double start = 0.0, write_s = 0.0;
+    std::vector<uint64_t> ends;     // file size after each record
+    for (int f = 0; f < frames; ++f)
+    {
+        const uint32_t visible = visible_in((uint32_t)f, (uint32_t)objects);
+        fill(view, models, materials, (uint32_t)f, visible);
+        FrameCaptureFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.frame_index = (uint32_t)f;
+        frame.visible_count = visible;
+        frame.time = f / 60.0;
+        frame.sim_time = f / 60.0 - 0.004;
+        frame.delta = 1.f / 60.f;
+        const double t = now_s();
+        if (!frame_capture_write(&writer, &frame, view.data(), models.data(), f % 2 ? materials.data() : NULL))
+            return EXIT_FAILURE;
+        write_s += now_s() - t;
+        ends.push_back(writer.bytes);
+    }
+    const uint64_t bytes = writer.bytes;
+    start = now_s();
+    if (!frame_capture_close(&writer))
+        return EXIT_FAILURE;
+    write_s += now_s() - start;     // the last buffered writes
+    printf("write: %d frames, %.1f MB at %.0f MB/s\n", frames, bytes / 1048576.0, bytes / 1048576.0 / write_s);
+
+    // Read back and compare
+    bool ok = true;
+    FrameCaptureReader reader;
+    start = now_s();
+    if (!frame_capture_open(&reader, path))
+        return EXIT_FAILURE;
+    double read_s = now_s() - start;
+    ok = reader.frame_count == (uint32_t)frames && reader.header->frame_count == (uint32_t)frames;
+    for (uint32_t f = 0; f < reader.frame_count && ok; ++f)
+    {
+        const FrameCaptureFrame* frame = reader.frames[f];
+        const uint32_t visible = visible_in(f, (uint32_t)objects);
+        fill(view, models, materials, f, visible);
+        const double t = now_s();
+        const void* got_view = frame_capture_view(&reader, frame);
+        const void* got_models = frame_capture_models(&reader, frame);
+        const uint32_t* got_materials = frame_capture_materials(&reader, frame);
+        ok = frame->frame_index == f && frame->visible_count == visible && frame->time == f / 60.0
+            && !memcmp(got_view, view.data(), VIEW_SIZE) && got_models
+            && !memcmp(got_models, models.data(), (size_t)visible * MODEL_SIZE)
+            && (f % 2 ? got_materials && !memcmp(got_materials, materials.data(), visible * sizeof(uint32_t)) : !got_materials)
+            && (size_t)((const unsigned char*)got_models - (const unsigned char*)reader.file.data) % FRAME_CAPTURE_ALIGN == 0;
+        read_s += now_s() - t;
+        if (!ok)
+            fprintf(stderr, "  frame %u differs\n", f);
+    }
+    printf("read:  %u frames, every byte %s, %.0f MB/s\n", reader.frame_count, ok ? "matches" : "checked: MISMATCH",
+        bytes / 1048576.0 / read_s);
+    frame_capture_close_reader(&reader);
+
+    // Cut short halfway through a record: the frames before it are still there
+    const uint32_t keep = (uint32_t)frames / 2;
+    const uint64_t cut = ends[keep - 1] + (ends[keep] - ends[keep - 1]) / 2;
+    std::vector<unsigned char> prefix((size_t)cut);
+    FILE* f = fopen(path, "rb");
+    const bool read_back = f && fread(prefix.data(), 1, prefix.size(), f) == prefix.size();
+    if (f)
+        fclose(f);
+    FrameCaptureHeader* cut_header = (FrameCaptureHeader*)prefix.data();
+    cut_header->frame_count = 0;    // as if never closed
+    f = read_back ? fopen(path, "wb") : NULL;
+    const bool rewritten = f && fwrite(prefix.data(), 1, prefix.size(), f) == prefix.size();
+    if (f)
+        fclose(f);
+    const bool reopened = rewritten && frame_capture_open(&reader, path);
+    const bool cut_ok = reopened && reader.frame_count == keep;
+    printf("cut at %llu bytes: %u frames, %u expected  %s\n", (unsigned long long)cut, reopened ? reader.frame_count : 0,
+        keep, cut_ok ? "ok" : "FAIL");
+    if (reopened)
+        frame_capture_close_reader(&reader);
+    remove(path);
+    return ok && cut_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,265 @@
+// Frame graph check (src/core/frame_graph.h): passes nothing needs are culled (including the writers of contents
+// a later pass overwrites), a ping-pong chain runs on two textures of its size, barriers go where image and storage
+// writes are read and only once per write, first writes discard, async compute passes stay off the graphics queue's
+// outputs and are waited for, a compute API's uses are mapped around their runs, and reading a transient before it's
+// written fails to compile. Then times building and compiling a full graph.
+//
+// Usage: frame_graph_bench [iterations]
+
+#include "core/frame_graph.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void nothing(void*, const FrameGraph*, int)
+{
+}
+
+static const FrameGraphTextureDesc full = { 1920, 1080, 0x881A, 8 };    // GL_RGBA16F
+static const FrameGraphTextureDesc half = { 960, 540, 0x881A, 8 };
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Unused output, a side effect, and an overwrite that makes the first writer dead
+static bool check_culling(FrameGraph* g)
+{
+    frame_graph_reset(g);
+    const int window = frame_graph_import(g, "window", NULL, 0, true);
+    const int a = frame_graph_create_texture(g, "a", &full);
+    const int unused = frame_graph_create_texture(g, "unused", &half);
+    const int dead = frame_graph_add_pass(g, "dead", nothing, NULL);       // its a is overwritten before it's read
+    frame_graph_write(g, dead, a, FRAME_GRAPH_ATTACHMENT);
+    const int orphan = frame_graph_add_pass(g, "orphan", nothing, NULL);   // nobody reads unused
+    frame_graph_write(g, orphan, unused, FRAME_GRAPH_ATTACHMENT);
+    const int fill = frame_graph_add_pass(g, "fill", nothing, NULL);
+    frame_graph_write(g, fill, a, FRAME_GRAPH_ATTACHMENT);
+    const int blend = frame_graph_add_pass(g, "blend", nothing, NULL);     // reads what fill left: fill stays
+    frame_graph_read(g, blend, a, FRAME_GRAPH_ATTACHMENT);
+    frame_graph_write(g, blend, a, FRAME_GRAPH_ATTACHMENT);
+    const int timer = frame_graph_add_pass(g, "timer", nothing, NULL);
+    frame_graph_set_side_effects(g, timer);
+    const int present = frame_graph_add_pass(g, "present", nothing, NULL);
+    frame_graph_read(g, present, a, FRAME_GRAPH_SAMPLED);
+    frame_graph_write(g, present, window, FRAME_GRAPH_ATTACHMENT);
+    const bool compiled = frame_graph_compile(g);
+    const bool ok = compiled && g->passes[dead].culled && g->passes[orphan].culled && !g->passes[fill].culled
+        && !g->passes[blend].culled && !g->passes[timer].culled && !g->passes[present].culled && g->order_count == 4
+        && g->resources[unused].physical < 0
+        && (g->passes[fill].discard >> a & 1) && !(g->passes[blend].discard >> a & 1)
+        && (g->passes[present].discard >> window & 1);
+    return report("culling and discards", ok);
+}
+
+// A blur ping-pong: each pass reads the last one's texture and writes a new one, all the same size
+static bool check_aliasing(FrameGraph* g, int steps)
+{
+    frame_graph_reset(g);
+    const int window = frame_graph_import(g, "window", NULL, 0, true);
+    int previous = frame_graph_create_texture(g, "scene", &full);
+    int p = frame_graph_add_pass(g, "scene", nothing, NULL);
+    frame_graph_write(g, p, previous, FRAME_GRAPH_ATTACHMENT);
+    for (int i = 0; i < steps; ++i)
+    {
+        const int next = frame_graph_create_texture(g, "blur", &full);
+        p = frame_graph_add_pass(g, "blur", nothing, NULL);
+        frame_graph_read(g, p, previous, FRAME_GRAPH_SAMPLED);
+        frame_graph_write(g, p, next, FRAME_GRAPH_ATTACHMENT);
+        previous = next;
+    }
+    const int small = frame_graph_create_texture(g, "small", &half);   // a different size never shares
+    p = frame_graph_add_pass(g, "reduce", nothing, NULL);
+    frame_graph_read(g, p, previous, FRAME_GRAPH_SAMPLED);
+    frame_graph_write(g, p, small, FRAME_GRAPH_ATTACHMENT);
+    p = frame_graph_add_pass(g, "present", nothing, NULL);
+    frame_graph_read(g, p, small, FRAME_GRAPH_SAMPLED);
+    frame_graph_write(g, p, window, FRAME_GRAPH_ATTACHMENT);
+    bool ok = frame_graph_compile(g) && g->physical_count == 3;
+    // No two transients alive at once share a texture
+    for (int x = 0; x < g->resource_count && ok; ++x)
+        for (int y = x + 1; y < g->resource_count && ok; ++y)
+        {
+            const FrameGraphResource* rx = &g->resources[x];
+            const FrameGraphResource* ry = &g->resources[y];
+            if (rx->imported || ry->imported || rx->physical != ry->physical)
+                continue;
+            ok = rx->last_use < ry->first_use || ry->last_use < rx->first_use;
+        }
+    printf("  %d transients on %d textures: %.1f MB instead of %.1f MB\n", g->resource_count - 1, g->physical_count,
+        g->physical_bytes / 1048576.0, g->transient_bytes / 1048576.0);
+    return report("aliasing", ok);
+}
+
+// Compute writes read as arguments, storage and textures
+static bool check_barriers(FrameGraph* g)
+{
+    frame_graph_reset(g);
+    const int window = frame_graph_import(g, "window", NULL, 0, true);
+    const int counts = frame_graph_import(g, "draw counts", NULL, 0, false);
+    const int image = frame_graph_create_texture(g, "image", &half);
+    const int target = frame_graph_create_texture(g, "target", &full);
+    const int cull = frame_graph_add_pass(g, "cull", nothing, NULL);
+    frame_graph_write(g, cull, counts, FRAME_GRAPH_STORAGE);
+    const int build = frame_graph_add_pass(g, "build", nothing, NULL);
+    frame_graph_write(g, build, image, FRAME_GRAPH_IMAGE);
+    const int draw = frame_graph_add_pass(g, "draw", nothing, NULL);        // arguments and image sampled
+    frame_graph_read(g, draw, counts, FRAME_GRAPH_INDIRECT);
+    frame_graph_read(g, draw, image, FRAME_GRAPH_SAMPLED);
+    frame_graph_write(g, draw, target, FRAME_GRAPH_ATTACHMENT);
+    const int again = frame_graph_add_pass(g, "again", nothing, NULL);      // same reads: already visible
+    frame_graph_read(g, again, counts, FRAME_GRAPH_INDIRECT);
+    frame_graph_read(g, again, target, FRAME_GRAPH_ATTACHMENT);
+    frame_graph_write(g, again, target, FRAME_GRAPH_ATTACHMENT);
+    const int present = frame_graph_add_pass(g, "present", nothing, NULL); // an attachment write sampled: none
+    frame_graph_read(g, present, target, FRAME_GRAPH_SAMPLED);
+    frame_graph_read(g, present, counts, FRAME_GRAPH_STORAGE);              // a new kind of read: its own bit
+    frame_graph_write(g, present, window, FRAME_GRAPH_ATTACHMENT);
+    const bool ok = frame_graph_compile(g) && g->passes[cull].barriers == 0 && g->passes[build].barriers == 0
+        && g->passes[draw].barriers == (FRAME_GRAPH_BARRIER(FRAME_GRAPH_INDIRECT) | FRAME_GRAPH_BARRIER(FRAME_GRAPH_SAMPLED))
+        && g->passes[again].barriers == 0 && g->passes[present].barriers == FRAME_GRAPH_BARRIER(FRAME_GRAPH_STORAGE)
+        && g->barrier_count == 2;
+    return report("barriers", ok);
+}
+
+// Compute passes asked onto the async queue: one that samples a graphics pass's output stays on the graphics queue,
+// and graphics passes wait for the async writes they use
+static bool check_async(FrameGraph* g)
+{
+    frame_graph_reset(g);
+    const int window = frame_graph_import(g, "window", NULL, 0, true);
+    const int counts = frame_graph_import(g, "draw counts", NULL, 0, false);
+    const int particles = frame_graph_import(g, "particles", NULL, 0, false);
+    const int lights = frame_graph_import(g, "light grid", NULL, 0, false);
+    const int shadow = frame_graph_create_texture(g, "shadow", &full);
+    const int target = frame_graph_create_texture(g, "target", &full);
+    const int shadows = frame_graph_add_pass(g, "shadows", nothing, NULL);
+    frame_graph_write(g, shadows, shadow, FRAME_GRAPH_ATTACHMENT);
+    const int cull = frame_graph_add_pass(g, "cull", nothing, NULL);
+    frame_graph_write(g, cull, counts, FRAME_GRAPH_STORAGE);
+    frame_graph_set_async_compute(g, cull);
+    const int simulate = frame_graph_add_pass(g, "simulate", nothing, NULL);
+    frame_graph_read(g, simulate, particles, FRAME_GRAPH_STORAGE);
+    frame_graph_write(g, simulate, particles, FRAME_GRAPH_STORAGE);
+    frame_graph_set_async_compute(g, simulate);
+    const int cluster = frame_graph_add_pass(g, "cluster", nothing, NULL);      // samples the shadows: demoted
+    frame_graph_read(g, cluster, shadow, FRAME_GRAPH_SAMPLED);
+    frame_graph_write(g, cluster, lights, FRAME_GRAPH_STORAGE);
+    frame_graph_set_async_compute(g, cluster);
+    const int scene = frame_graph_add_pass(g, "scene", nothing, NULL);          // waits for the culling
+    frame_graph_read(g, scene, counts, FRAME_GRAPH_INDIRECT);
+    frame_graph_read(g, scene, lights, FRAME_GRAPH_STORAGE);
+    frame_graph_write(g, scene, target, FRAME_GRAPH_ATTACHMENT);
+    const int present = frame_graph_add_pass(g, "present", nothing, NULL);      // and the particles
+    frame_graph_read(g, present, target, FRAME_GRAPH_SAMPLED);
+    frame_graph_read(g, present, particles, FRAME_GRAPH_VERTEX);
+    frame_graph_write(g, present, window, FRAME_GRAPH_ATTACHMENT);
+    const bool ok = frame_graph_compile(g) && !g->passes[shadows].async && g->passes[cull].async
+        && g->passes[simulate].async && !g->passes[cluster].async && g->passes[cluster].wait < 0
+        && g->passes[scene].wait == cull && g->passes[present].wait == simulate && g->async_count == 2
+        && g->wait_count == 2;
+    return report("async compute queue and waits", ok);
+}
+
+// Two CUDA passes in a row share one mapping, which a draw reading the buffer ends; a third after it maps again and
+// is given back with the frame. No barrier for an external write read by GL.
+static bool check_interop(FrameGraph* g)
+{
+    frame_graph_reset(g);
+    const int window = frame_graph_import(g, "window", NULL, 0, true);
+    const int points = frame_graph_import(g, "points", NULL, 0, false);
+    const int target = frame_graph_create_texture(g, "target", &full);
+    const int simulate = frame_graph_add_pass(g, "simulate", nothing, NULL);
+    frame_graph_write(g, simulate, points, FRAME_GRAPH_EXTERNAL);
+    const int sort = frame_graph_add_pass(g, "sort", nothing, NULL);
+    frame_graph_read(g, sort, points, FRAME_GRAPH_EXTERNAL);
+    frame_graph_write(g, sort, points, FRAME_GRAPH_EXTERNAL);
+    const int draw = frame_graph_add_pass(g, "draw", nothing, NULL);
+    frame_graph_read(g, draw, points, FRAME_GRAPH_VERTEX);
+    frame_graph_write(g, draw, target, FRAME_GRAPH_ATTACHMENT);
+    const int trail = frame_graph_add_pass(g, "trail", nothing, NULL);
+    frame_graph_read(g, trail, points, FRAME_GRAPH_EXTERNAL);
+    frame_graph_write(g, trail, points, FRAME_GRAPH_EXTERNAL);
+    frame_graph_set_side_effects(g, trail);
+    const int present = frame_graph_add_pass(g, "present", nothing, NULL);
+    frame_graph_read(g, present, target, FRAME_GRAPH_SAMPLED);
+    frame_graph_write(g, present, window, FRAME_GRAPH_ATTACHMENT);
+    const uint64_t bit = 1ull << points;
+    bool ok = frame_graph_compile(g) && g->passes[simulate].map == bit && g->passes[simulate].unmap == 0
+        && g->passes[sort].map == 0 && g->passes[sort].unmap == bit && g->passes[draw].map == 0
+        && g->passes[draw].unmap == 0 && g->passes[draw].barriers == 0 && g->passes[trail].map == bit
+        && g->passes[trail].unmap == bit && g->map_count == 2;
+
+    // A transient has nothing for another API to map
+    frame_graph_reset(g);
+    const int w = frame_graph_import(g, "window", NULL, 0, true);
+    const int scratch = frame_graph_create_texture(g, "scratch", &full);
+    const int p = frame_graph_add_pass(g, "compute", nothing, NULL);
+    frame_graph_write(g, p, scratch, FRAME_GRAPH_EXTERNAL);
+    frame_graph_write(g, p, w, FRAME_GRAPH_ATTACHMENT);
+    ok = ok && !frame_graph_compile(g);
+    return report("interop mapping", ok);
+}
+
+static bool check_invalid(FrameGraph* g)
+{
+    frame_graph_reset(g);
+    const int window = frame_graph_import(g, "window", NULL, 0, true);
+    const int never = frame_graph_create_texture(g, "never written", &full);
+    const int p = frame_graph_add_pass(g, "present", nothing, NULL);
+    frame_graph_read(g, p, never, FRAME_GRAPH_SAMPLED);
+    frame_graph_write(g, p, window, FRAME_GRAPH_ATTACHMENT);
+    const bool unwritten = !frame_graph_compile(g);
+    frame_graph_reset(g);
+    for (int i = 0; i <= FRAME_GRAPH_MAX_PASSES; ++i)
+        frame_graph_add_pass(g, "too many", nothing, NULL);
+    return report("unwritten read and overflow fail", unwritten && !frame_graph_compile(g));
+}
+
+int main(int argc, char** argv)
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    FrameGraph* g = (FrameGraph*)malloc(sizeof(FrameGraph));
+    bool ok = check_culling(g);
+    ok = check_aliasing(g, 8) && ok;
+    ok = check_barriers(g) && ok;
+    ok = check_async(g) && ok;
+    ok = check_interop(g) && ok;
+    ok = check_invalid(g) && ok;
+
+    // A full graph every frame: the cost of rebuilding it
+    const int steps = FRAME_GRAPH_MAX_PASSES - 2;
+    double build_ms = 0.0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        const double t = now_ms();
+        frame_graph_reset(g);
+        const int window = frame_graph_import(g, "window", NULL, 0, true);
+        int previous = -1;
+        for (int k = 0; k < steps; ++k)
+        {
+            const int next = frame_graph_create_texture(g, "t", k & 1 ? &half : &full);
+            const int p = frame_graph_add_pass(g, "p", nothing, NULL);
+            if (previous >= 0)
+                frame_graph_read(g, p, previous, FRAME_GRAPH_SAMPLED);
+            frame_graph_write(g, p, next, k % 3 ? FRAME_GRAPH_ATTACHMENT : FRAME_GRAPH_IMAGE);
+            previous = next;
+        }
+        const int p = frame_graph_add_pass(g, "present", nothing, NULL);
+        frame_graph_read(g, p, previous, FRAME_GRAPH_SAMPLED);
+        frame_graph_write(g, p, window, FRAME_GRAPH_ATTACHMENT);
+        ok = frame_graph_compile(g) && ok;
+        build_ms += now_ms() - t;
+    }
+    printf("  %d passes built and compiled in %.2f us\n", steps + 1, 1000.0 * build_ms / iterations);
+    free(g);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,183 @@
+// Frame pacing check: runs the frame-rate limiter (src/core/frame_pacer.h) at a target rate with a
+// randomly varying amount of work per frame and reports how close each frame lands on its deadline,
+// against a plain sleep_for to the deadline. Then feeds the simulation clock smoother a jittery frame
+// sequence and checks that it cuts the step jitter while staying with the wall clock, checks the
+// histogram's percentiles, and drives the dynamic resolution controller (src/core/resolution_scaler.h)
+// through a load spike.
+//
+// Usage: frame_pacer_bench [fps] [frames]
+
+#include "core/frame_pacer.h"
+#include "core/resolution_scaler.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+static uint32_t random_u32(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+// Busy work for "seconds", standing in for simulation and submission
+static void work(double seconds)
+{
+    const double end = frame_pacer_now() + seconds;
+    while (frame_pacer_now() < end)
+    {
+    }
+}
+
+typedef struct Lateness
+{
+    FrameHistogram frames;      // frame-to-frame times
+    double worst_ms;            // latest wake-up after a deadline
+    double sum_abs_ms;
+    int count;
+} Lateness;
+
+// "pacer" NULL: sleep_for(deadline - now) and nothing else, the naive limiter
+static void run(FramePacer* pacer, double fps, int frames, Lateness* out)
+{
+    unsigned int state = 12345u;
+    const double period = 1.0 / fps;
+    frame_histogram_clear(&out->frames);
+    out->worst_ms = out->sum_abs_ms = 0.0;
+    out->count = 0;
+    double deadline = frame_pacer_now() + period, last = frame_pacer_now();
+    for (int f = 0; f < frames; ++f)
+    {
+        work(period * (0.2 + 0.5 * (random_u32(&state) % 1000) / 1000.0));
+        if (pacer)
+        {
+            deadline = pacer->deadline > 0.0 ? pacer->deadline : frame_pacer_now();
+            frame_pacer_wait(pacer);
+        }
+        else
+        {
+            const double remaining = deadline - frame_pacer_now();
+            if (remaining > 0.0)
+                std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+        }
+        const double now = frame_pacer_now();
+        if (f > 0)      // the first frame has no deadline yet
+        {
+            const double error_ms = (now - deadline) * 1000.0;
+            out->worst_ms = fmax(out->worst_ms, error_ms);
+            out->sum_abs_ms += fabs(error_ms);
+            ++out->count;
+        }
+        frame_histogram_add(&out->frames, (now - last) * 1000.0);
+        last = now;
+        if (!pacer)
+            deadline += period;
+    }
+}
+
+static bool check_smoother()
+{
+    // 60 Hz frames with +-4 ms of jitter and a 250 ms stall in the middle
+    unsigned int state = 777u;
+    FrameSmoother s;
+    frame_smoother_init(&s, true);
+    double now = 1.0, worst_drift = 0.0, raw_var = 0.0, smooth_var = 0.0;
+    float delta = 0.f;
+    frame_smoother_step(&s, now, &delta);
+    const int frames = 2000;
+    for (int f = 0; f < frames; ++f)
+    {
+        const double raw = f == frames / 2 ? 0.25 : 1.0 / 60.0 + ((random_u32(&state) % 8001) / 1000.0 - 4.0) / 1000.0;
+        now += raw;
+        const double t = frame_smoother_step(&s, now, &delta);
+        if (f == frames / 2 || f == frames / 2 + 1)
+            continue;
+        worst_drift = fmax(worst_drift, fabs(t - now));
+        raw_var += (raw - 1.0 / 60.0) * (raw - 1.0 / 60.0);
+        smooth_var += (delta - 1.0 / 60.0) * (delta - 1.0 / 60.0);
+    }
+    const double raw_jitter = sqrt(raw_var / frames) * 1000.0, smooth_jitter = sqrt(smooth_var / frames) * 1000.0;
+    const bool ok = worst_drift <= 0.1 && smooth_jitter < raw_jitter * 0.5 && delta > 0.f;
+    printf("smoother: step jitter %.3f ms -> %.3f ms, worst drift from the wall clock %.1f ms  %s\n",
+        raw_jitter, smooth_jitter, worst_drift * 1000.0, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static bool check_histogram()
+{
+    FrameHistogram h;
+    frame_histogram_clear(&h);
+    for (int i = 0; i < 90; ++i)
+        frame_histogram_add(&h, 16.6);
+    for (int i = 0; i < 9; ++i)
+        frame_histogram_add(&h, 33.3);
+    frame_histogram_add(&h, 500.0);
+    const bool ok = frame_histogram_percentile(&h, .5) == 17.0 && frame_histogram_percentile(&h, .9) == 17.0
+        && frame_histogram_percentile(&h, .99) == 33.5 && frame_histogram_percentile(&h, 1.0) == 500.0;
+    printf("histogram percentiles: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static bool check_resolution_scaler()
+{
+    // GPU time 2 ms + 12 ms at full resolution against a 60 Hz budget, the pixel cost up 2.5x for a stretch in
+    // the middle; each time reaches the scaler 4 frames after its frame was drawn
+    ResolutionScaler s;
+    const double budget = 1000.0 / 60.0;
+    resolution_scaler_init(&s, budget, 0.5f, 1.f, 4);
+    float in_flight[4] = { 1.f, 1.f, 1.f, 1.f };
+    const int frames = 3000, spike_begin = 1000, spike_end = 2000;
+    int over = 0, settled_over = 0;
+    float lowest = 1.f;
+    for (int f = 0; f < frames; ++f)
+    {
+        const double pixel_ms = f >= spike_begin && f < spike_end ? 30.0 : 12.0;
+        const float drawn = in_flight[f % 4];
+        const double gpu_ms = 2.0 + pixel_ms * drawn * drawn;
+        over += gpu_ms > budget;
+        settled_over += gpu_ms > budget && (f < spike_begin || f >= spike_begin + 16);
+        in_flight[f % 4] = s.scale;     // this frame draws at the current scale; its time comes back 4 frames on
+        resolution_scaler_update(&s, gpu_ms);
+        lowest = lowest < s.scale ? lowest : s.scale;
+    }
+    // Over budget only while the spike's first samples are still in flight, down to ~0.66 and back to 1 after
+    const bool ok = settled_over == 0 && over <= 16 && lowest >= 0.5f && lowest < 0.75f && s.scale == 1.f
+        && s.changes < 40;
+    printf("resolution scaler: %d frames over budget (%d after settling), lowest scale %.3f, %u changes, "
+        "mean %.3f  %s\n", over, settled_over, lowest, s.changes, resolution_scaler_average(&s), ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const double fps = argc > 1 ? atof(argv[1]) : 240.0;
+    const int frames = argc > 2 ? atoi(argv[2]) : 480;
+    if (!(fps > 0.0) || frames < 2)
+    {
+        fprintf(stderr, "usage: %s [fps] [frames]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool ok = check_histogram();
+    ok = check_smoother() && ok;
+    ok = check_resolution_scaler() && ok;
+
+    printf("limiter at %.0f fps, %d frames    mean |error| ms  worst late ms  frame p50 / p99 ms\n", fps, frames);
+    Lateness naive, paced;
+    run(NULL, fps, frames, &naive);
+    FramePacer pacer;
+    frame_pacer_init(&pacer, VSYNC_OFF, fps, false);
+    run(&pacer, fps, frames, &paced);
+    const Lateness* results[] = { &naive, &paced };
+    const char* names[] = { "sleep_for", "sleep + spin" };
+    for (int k = 0; k < 2; ++k)
+        printf("  %-28s %15.3f  %13.3f  %8.2f / %.2f\n", names[k], results[k]->sum_abs_ms / results[k]->count,
+            results[k]->worst_ms, frame_histogram_percentile(&results[k]->frames, .5),
+            frame_histogram_percentile(&results[k]->frames, .99));
+    printf("  learned sleep overshoot %.3f ms, %llu late frames\n", pacer.overshoot * 1000.0,
+        (unsigned long long)pacer.late_frames);
+    frame_histogram_print(&paced.frames, "sleep + spin frame times", stdout);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,125 @@
+// Frame statistics check: feeds src/core/frame_stats.h a synthetic run (a steady frame rate with jitter and
+// an occasional hitch) through timestamps, as the swap would, and checks the rolling window's percentiles
+// and max against a sort of the same frames, the interval rows and stutter count against what was injected,
+// and the CSV against the rows. Also times one frame_stats_frame call.
+//
+// Usage: frame_stats_bench [frames] [output.csv]
+//
+// The CSV goes to the build directory unless a path is given.
+
+#include "core/frame_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifndef BENCH_OUTPUT_DIR
+#define BENCH_OUTPUT_DIR "."    // CMake passes its build directory
+#endif
+
+#define FRAME_MS 16.6
+#define HITCH_EVERY 500     // one frame in this many takes HITCH_MS
+#define HITCH_MS 60.0
+
+static uint32_t rng = 12345u;
+
+static double jitter(void)
+{
+    rng = rng * 1664525u + 1013904223u;
+    return ((rng >> 8) / 16777216.0 - 0.5) * 2.0;   // -1..1 ms
+}
+
+// Exact quantile of "sorted", for comparison with the bucketed one
+static double exact_percentile(const std::vector<double>& sorted, double fraction)
+{
+    const size_t rank = (size_t)ceil(fraction * sorted.size());
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static long count_lines(const char* path)
+{
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return -1;
+    long lines = 0;
+    int c;
+    while ((c = fgetc(f)) != EOF)
+        lines += c == '\n';
+    fclose(f);
+    return lines;
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 20000;
+    const char* path = argc > 2 ? argv[2] : BENCH_OUTPUT_DIR "/frame_stats_bench.csv";
+    if (frames < FRAME_STATS_WINDOW)
+    {
+        fprintf(stderr, "usage: %s [frames, at least %d] [output.csv]\n", argv[0], FRAME_STATS_WINDOW);
+        return EXIT_FAILURE;
+    }
+
+    FrameStats* stats = (FrameStats*)malloc(sizeof(FrameStats));
+    if (!stats || !frame_stats_init(stats))
+        return EXIT_FAILURE;
+    std::vector<double> times;
+    double now = 100.0, seconds = 0.0;
+    uint64_t hitches = 0;
+    frame_stats_frame(stats, now);
+    for (int i = 0; i < frames; ++i)
+    {
+        const bool hitch = i % HITCH_EVERY == HITCH_EVERY - 1;
+        const double ms = hitch ? HITCH_MS : FRAME_MS + jitter();
+        hitches += hitch;   // the first comes well after the first interval, which sets the median
+        now += ms * 1e-3;
+        times.push_back(ms);
+        const auto start = std::chrono::steady_clock::now();
+        frame_stats_frame(stats, now);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    printf("frame_stats_frame: %.1f ns/frame\n", seconds * 1e9 / frames);
+    bool ok = true;
+
+    // The window against the last FRAME_STATS_WINDOW frames, sorted: within a bucket, max exact
+    std::vector<double> last(times.end() - FRAME_STATS_WINDOW, times.end());
+    std::sort(last.begin(), last.end());
+    FrameStatsSummary window;
+    frame_stats_window(stats, &window);
+    const double fractions[] = { .50, .95, .99 };
+    const double got[] = { window.p50_ms, window.p95_ms, window.p99_ms };
+    for (int k = 0; k < 3; ++k)
+    {
+        const double want = exact_percentile(last, fractions[k]);
+        const bool close = got[k] >= want - 1e-6 && got[k] <= want + FRAME_STATS_BUCKET_MS + 1e-6;
+        printf("window p%-2.0f %7.2f ms, exact %7.3f ms  %s\n", fractions[k] * 100.0, got[k], want, close ? "ok" : "FAIL");
+        ok = ok && close;
+    }
+    const bool max_ok = fabs(window.max_ms - last.back()) < 1e-3 && window.frames == FRAME_STATS_WINDOW;
+    printf("window max %7.2f ms, exact %7.3f ms, %llu frames  %s\n", window.max_ms, last.back(),
+        (unsigned long long)window.frames, max_ok ? "ok" : "FAIL");
+    ok = ok && max_ok;
+
+    // Every hitch after the first interval is a stutter, and nothing else is
+    FrameStatsSummary total;
+    frame_stats_total(stats, &total);
+    const bool stutters_ok = total.stutters == hitches && total.frames == (uint64_t)frames;
+    printf("total: %llu frames, p99 %.1f ms, max %.1f ms, %llu stutters, %llu hitches  %s\n",
+        (unsigned long long)total.frames, total.p99_ms, total.max_ms, (unsigned long long)total.stutters,
+        (unsigned long long)hitches, stutters_ok ? "ok" : "FAIL");
+    ok = ok && stutters_ok;
+
+    // One row per second closed, the open one and the total, plus the header
+    ok = frame_stats_write_csv(stats, path) && ok;
+    const uint64_t rows = stats->row_count < FRAME_STATS_INTERVALS ? stats->row_count : FRAME_STATS_INTERVALS;
+    const long lines = count_lines(path), expected = (long)rows + (stats->interval.count ? 1 : 0) + 2;
+    printf("%s: %ld lines, %ld expected  %s\n", path, lines, expected, lines == expected ? "ok" : "FAIL");
+    ok = ok && lines == expected;
+
+    frame_stats_destroy(stats);
+    free(stats);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,186 @@
+// Frustum culling check: scatters random spheres and boxes around a perspective camera, checks the SIMD culling
+// paths against a plain per-bound reference and prints the time per bound and the fraction kept. Also checks
+// linmath_bounds.h's transforms: a box through a matrix against its transformed corners, a sphere against its
+// transformed surface.
+//
+// Usage: frustum_bench [bounds]
+
+#include "scene/frustum.h"
+
+#include "linmath_bounds.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+// Reference tests, written independently of the batch code
+static bool sphere_inside(const Frustum* f, float x, float y, float z, float r)
+{
+    const vec3 c = { x, y, z };
+    for (int p = 0; p < 6; ++p)
+        if (vec3_mul_inner(f->planes[p], c) + f->planes[p][3] < -r)
+            return false;
+    return true;
+}
+
+static bool aabb_inside(const Frustum* f, const float c[3], const float e[3])
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        // Most positive corner along the plane normal
+        vec3 corner;
+        for (int k = 0; k < 3; ++k)
+            corner[k] = c[k] + (f->planes[p][k] >= 0.f ? e[k] : -e[k]);
+        if (vec3_mul_inner(f->planes[p], corner) + f->planes[p][3] < 0.f)
+            return false;
+    }
+    return true;
+}
+
+template <typename F>
+static double time_ns(F&& fn, size_t count)
+{
+    int reps = 0;
+    const auto start = std::chrono::steady_clock::now();
+    auto now = start;
+    do
+    {
+        fn();
+        ++reps;
+        now = std::chrono::steady_clock::now();
+    } while (now - start < std::chrono::milliseconds(200));
+    return std::chrono::duration<double, std::nano>(now - start).count() / ((double)reps * count);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? (size_t)atol(argv[1]) : 100003;   // odd on purpose: exercises the scalar tail
+
+    mat4x4 projection, view, view_projection;
+    mat4x4_perspective(projection, 1.0f, 16.f / 9.f, 0.1f, 100.f);
+    vec3 eye = { 0.f, 2.f, 5.f }, center = { 0.f, 0.f, -20.f }, up = { 0.f, 1.f, 0.f };
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(view_projection, projection, view);
+    Frustum frustum;
+    frustum_from_matrix(&frustum, view_projection);
+
+    std::vector<float> x(count), y(count), z(count), r(count), ex(count), ey(count), ez(count);
+    unsigned int state = 7u;
+    for (size_t i = 0; i < count; ++i)
+    {
+        x[i] = random_float(&state, -60.f, 60.f);
+        y[i] = random_float(&state, -30.f, 30.f);
+        z[i] = random_float(&state, -110.f, 10.f);
+        r[i] = random_float(&state, 0.1f, 3.f);
+        ex[i] = random_float(&state, 0.1f, 2.f);
+        ey[i] = random_float(&state, 0.1f, 2.f);
+        ez[i] = random_float(&state, 0.1f, 2.f);
+    }
+
+    std::vector<uint32_t> visible(count);
+    bool ok = true;
+
+    size_t n = frustum_cull_spheres(&frustum, x.data(), y.data(), z.data(), r.data(), count, visible.data());
+    size_t expected = 0;
+    for (size_t i = 0; i < count && ok; ++i)
+    {
+        if (!sphere_inside(&frustum, x[i], y[i], z[i], r[i]))
+            continue;
+        ok = expected < n && visible[expected] == i;
+        ++expected;
+    }
+    ok = ok && expected == n;
+    const double sphere_ns = time_ns([&] { frustum_cull_spheres(&frustum, x.data(), y.data(), z.data(), r.data(), count, visible.data()); }, count);
+    printf("spheres: %zu of %zu kept (%.1f%%), %.2f ns/bound%s\n", n, count, 100.0 * n / count, sphere_ns, ok ? "" : "  MISMATCH");
+
+    bool aabb_ok = true;
+    n = frustum_cull_aabbs(&frustum, x.data(), y.data(), z.data(), ex.data(), ey.data(), ez.data(), count, visible.data());
+    expected = 0;
+    for (size_t i = 0; i < count && aabb_ok; ++i)
+    {
+        const float c[3] = { x[i], y[i], z[i] }, e[3] = { ex[i], ey[i], ez[i] };
+        if (!aabb_inside(&frustum, c, e))
+            continue;
+        aabb_ok = expected < n && visible[expected] == i;
+        ++expected;
+    }
+    aabb_ok = aabb_ok && expected == n;
+    const double aabb_ns = time_ns([&] { frustum_cull_aabbs(&frustum, x.data(), y.data(), z.data(), ex.data(), ey.data(), ez.data(), count, visible.data()); }, count);
+    printf("aabbs:   %zu of %zu kept (%.1f%%), %.2f ns/bound%s\n", n, count, 100.0 * n / count, aabb_ns, aabb_ok ? "" : "  MISMATCH");
+
+    // Rotated, non-uniformly scaled and translated: Arvo's box is exactly the corners' bounds, the sphere holds
+    // every transformed surface point. The batches want aligned arrays, so the bounds are copied into some.
+    const size_t transforms = count < 4096 ? count : 4096;
+    mat3x4* models = (mat3x4*)linmath_aligned_alloc(sizeof(mat3x4) * transforms, LINMATH_CACHE_LINE);
+    float* soa[17];     // x, y, z, r, ex, ey, ez in; sphere x, y, z, r out; box centre and extents out
+    for (int k = 0; k < 17; ++k)
+        soa[k] = (float*)linmath_aligned_alloc(sizeof(float) * transforms, LINMATH_CACHE_LINE);
+    const float* in[7] = { x.data(), y.data(), z.data(), r.data(), ex.data(), ey.data(), ez.data() };
+    for (int k = 0; k < 7; ++k)
+        memcpy(soa[k], in[k], sizeof(float) * transforms);
+    float** sphere = soa + 7;
+    float** box = soa + 11;
+    for (size_t i = 0; i < transforms; ++i)
+    {
+        mat4x4 identity, model;
+        mat4x4_identity(identity);
+        mat4x4_rotate(model, identity, x[i], y[i], z[i], r[i]);
+        mat4x4_scale_aniso(model, model, ex[i], ey[i], ez[i] * 2.f);
+        mat4x4_translate_in_place(model, y[i], z[i], x[i]);
+        mat3x4_from_mat4x4(models[i], model);
+    }
+    mat3x4_transform_aabb_soa(box[0], box[1], box[2], box[3], box[4], box[5], models, soa[0], soa[1], soa[2], soa[4],
+        soa[5], soa[6], transforms);
+    float box_error = 0.f;
+    for (size_t i = 0; i < transforms; ++i)
+        for (int k = 0; k < 3; ++k)
+        {
+            float lo = INFINITY, hi = -INFINITY;
+            for (int c = 0; c < 8; ++c)
+            {
+                const vec3 corner = { x[i] + (c & 1 ? ex[i] : -ex[i]), y[i] + (c & 2 ? ey[i] : -ey[i]),
+                    z[i] + (c & 4 ? ez[i] : -ez[i]) };
+                vec3 moved;
+                mat3x4_mul_vec3(moved, models[i], corner);
+                lo = fminf(lo, moved[k]);
+                hi = fmaxf(hi, moved[k]);
+            }
+            const float scale = fmaxf(fabsf(lo), fabsf(hi)) + 1.f;
+            box_error = fmaxf(box_error, fmaxf(fabsf(box[k][i] - box[3 + k][i] - lo),
+                fabsf(box[k][i] + box[3 + k][i] - hi)) / scale);
+        }
+    mat3x4_transform_sphere_soa(sphere[0], sphere[1], sphere[2], sphere[3], models, soa[0], soa[1], soa[2], soa[3],
+        transforms);
+    float sphere_excess = 0.f;
+    for (size_t i = 0; i < transforms; ++i)
+        for (int s = 0; s < 64; ++s)
+        {
+            vec3 direction = { random_float(&state, -1.f, 1.f), random_float(&state, -1.f, 1.f),
+                random_float(&state, -1.f, 1.f) };
+            vec3_norm(direction, direction);
+            const vec3 point = { x[i] + r[i] * direction[0], y[i] + r[i] * direction[1], z[i] + r[i] * direction[2] };
+            const vec3 centre = { sphere[0][i], sphere[1][i], sphere[2][i] };
+            vec3 moved, offset;
+            mat3x4_mul_vec3(moved, models[i], point);
+            vec3_sub(offset, moved, centre);
+            sphere_excess = fmaxf(sphere_excess, (vec3_len(offset) - sphere[3][i]) / (sphere[3][i] + 1.f));
+        }
+    const bool transform_ok = box_error < 1e-5f && sphere_excess < 1e-5f;
+    const double box_ns = time_ns([&] { mat3x4_transform_aabb_soa(box[0], box[1], box[2], box[3], box[4], box[5],
+        models, soa[0], soa[1], soa[2], soa[4], soa[5], soa[6], transforms); }, transforms);
+    printf("transforms: box error %.1e, sphere excess %.1e, %.2f ns/box%s\n", box_error, sphere_excess, box_ns,
+        transform_ok ? "" : "  MISMATCH");
+    linmath_aligned_free(models);
+    for (int k = 0; k < 17; ++k)
+        linmath_aligned_free(soa[k]);
+
+    return ok && aabb_ok && transform_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,599 @@
+// glTF import and cooking check (src/asset/json.h, gltf.h, mesh_cook.h): the JSON reader on escapes, nesting and
+// malformed text, base64, then one small model written three ways - base64 data URI, external .bin, binary .glb -
+// which must import to the same meshes, with normalised colours, a triangle strip made a list and the node tree's
+// world matrices. An accessor reaching past its buffer must be refused. A sphere then cooks to a mesh file that
+// opens with its levels, its meshlets covering level 0 and the vertex layout asked for, and a batch of them cooks
+// serially and across the job system to the same bytes. Split into a position stream and an attribute stream, as a
+// mesh that size is by default, it holds the same vertices as cooked interleaved, while a small sphere stays
+// interleaved. Static batching merges a grid of instances by material and cell into meshes in world space whose
+// triangles still face out, mirrored instances' included, leaving a lone instance and mixed materials alone. Prints
+// the cook times and the bytes a position-only pass fetches either way.
+//
+// Usage: gltf_bench [meshes]
+
+#include "asset/gltf.h"
+#include "asset/json.h"
+#include "asset/mesh_cook.h"
+#include "asset/mesh_file.h"
+#include "asset/static_batch.h"
+#include "asset/vertex_pack.h"
+#include "core/job_system.h"
+
+#include <chrono>
+#include <filesystem>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static bool parses(const char* text)
+{
+    JsonDocument doc;
+    const bool ok = json_parse(&doc, text, strlen(text));
+    json_free(&doc);
+    return ok;
+}
+
+static bool json_checks()
+{
+    const char* text = "{ \"a\": [1, -2.5e2, true, null], \"s\": \"tab\\t\\\"q\\\" \\u00e9\\ud83d\\ude00\",\n"
+                       "  \"o\": { \"x\": {} , \"y\": [] } }";
+    JsonDocument doc;
+    bool ok = json_parse(&doc, text, strlen(text));
+    const JsonValue* root = json_root(&doc);
+    const JsonValue* a = json_member(&doc, root, "a");
+    ok = ok && a && a->type == JSON_ARRAY && a->count == 4 && json_number(json_at(&doc, a, 1), 0.0) == -250.0
+        && json_at(&doc, a, 2)->type == JSON_TRUE && json_at(&doc, a, 3)->type == JSON_NULL && !json_at(&doc, a, 4);
+    ok = ok && !strcmp(json_member_string(&doc, root, "s", ""), "tab\t\"q\" \xc3\xa9\xf0\x9f\x98\x80");
+    const JsonValue* o = json_member(&doc, root, "o");
+    ok = ok && o && o->count == 2 && !strcmp(json_key(&doc, json_at(&doc, o, 1)), "y")
+        && json_member(&doc, o, "x")->type == JSON_OBJECT && !json_member(&doc, o, "z");
+    json_free(&doc);
+    ok = report("JSON values, escapes and nesting read", ok);
+
+    std::string deep(JSON_MAX_DEPTH + 1, '[');
+    deep += std::string(JSON_MAX_DEPTH + 1, ']');
+    const bool refused = !parses("{") && !parses("[1,]") && !parses("{\"a\" 1}") && !parses("\"\\x\"")
+        && !parses("01") && !parses("[1] 2") && !parses("\"\\ud800\"") && !parses(deep.c_str()) && parses("[[[]]]");
+    ok = report("malformed JSON is refused", refused) && ok;
+
+    uint8_t out[8];
+    const bool base64 = gltf_base64_decode("TWFu", 4, out) == 3 && !memcmp(out, "Man", 3)
+        && gltf_base64_decode("TWE=", 4, out) == 2 && !memcmp(out, "Ma", 2)
+        && gltf_base64_decode("TQ==", 4, out) == 1 && out[0] == 'M' && gltf_base64_decode("T!==", 4, out) == SIZE_MAX;
+    return report("base64 decodes", base64) && ok;
+}
+
+// The model's binary buffer: a cube (8 float positions, RGBA8 normalised colours, 36 uint16 indices) and a
+// 4-vertex strip without indices
+static std::vector<uint8_t> model_buffer()
+{
+    std::vector<uint8_t> b;
+    auto put = [&b](const void* p, size_t n) { b.insert(b.end(), (const uint8_t*)p, (const uint8_t*)p + n); };
+    for (int v = 0; v < 8; ++v)
+    {
+        const float p[3] = { v & 1 ? 1.f : -1.f, v & 2 ? 1.f : -1.f, v & 4 ? 1.f : -1.f };
+        put(p, sizeof(p));
+    }
+    for (int v = 0; v < 8; ++v)
+    {
+        const uint8_t c[4] = { (uint8_t)(v * 32), 255, 0, 255 };
+        put(c, sizeof(c));
+    }
+    static const uint16_t cube[36] = { 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+    put(cube, sizeof(cube));
+    for (int v = 0; v < 4; ++v)
+    {
+        const float p[3] = { (float)(v / 2), (float)(v % 2), 0.f };
+        put(p, sizeof(p));
+    }
+    return b;   // 96 + 32 + 72 + 48 = 248 bytes
+}
+
+// The JSON for model_buffer(), its buffer at "uri" (NULL: a GLB's BIN chunk). "positions" overrides the cube's
+// position count, to make an accessor reach too far.
+static std::string model_json(const char* uri, size_t size, int positions = 8)
+{
+    std::string buffer = "{\"byteLength\":" + std::to_string(size);
+    if (uri)
+        buffer += std::string(",\"uri\":\"") + uri + "\"";
+    buffer += "}";
+    return std::string("{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0,2]}],\n")
+        + "\"nodes\":[{\"translation\":[10,0,0],\"rotation\":[0,0,0.70710678,0.70710678],\"scale\":[2,2,2],"
+          "\"children\":[1]},{\"mesh\":0,\"translation\":[1,0,0]},"
+          "{\"mesh\":1,\"matrix\":[1,0,0,0,0,1,0,0,0,0,1,0,5,6,7,1]}],\n"
+        + "\"meshes\":[{\"name\":\"cube\",\"primitives\":[{\"attributes\":{\"POSITION\":0,\"COLOR_0\":1},\"indices\":2}]},"
+          "{\"primitives\":[{\"attributes\":{\"POSITION\":3},\"mode\":5,\"material\":1},"
+          "{\"attributes\":{\"POSITION\":3},\"mode\":1,\"material\":2}]}],\n"
+        + "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":" + std::to_string(positions)
+        + ",\"type\":\"VEC3\"},"
+          "{\"bufferView\":1,\"componentType\":5121,\"normalized\":true,\"count\":8,\"type\":\"VEC4\"},"
+          "{\"bufferView\":2,\"componentType\":5123,\"count\":36,\"type\":\"SCALAR\"},"
+          "{\"bufferView\":3,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"}],\n"
+          "\"bufferViews\":[{\"buffer\":0,\"byteLength\":96},{\"buffer\":0,\"byteOffset\":96,\"byteLength\":32},"
+          "{\"buffer\":0,\"byteOffset\":128,\"byteLength\":72},{\"buffer\":0,\"byteOffset\":200,\"byteLength\":48}],\n"
+          "\"buffers\":[" + buffer + "]}";
+}
+
+static std::string base64(const std::vector<uint8_t>& data)
+{
+    static const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string s;
+    for (size_t i = 0; i < data.size(); i += 3)
+    {
+        const uint32_t n = data[i] << 16 | (i + 1 < data.size() ? data[i + 1] << 8 : 0)
+            | (i + 2 < data.size() ? data[i + 2] : 0);
+        s += digits[n >> 18];
+        s += digits[n >> 12 & 63];
+        s += i + 1 < data.size() ? digits[n >> 6 & 63] : '=';
+        s += i + 2 < data.size() ? digits[n & 63] : '=';
+    }
+    return s;
+}
+
+static std::vector<uint8_t> glb(std::string json, const std::vector<uint8_t>& bin)
+{
+    while (json.size() % 4)
+        json += ' ';
+    std::vector<uint8_t> padded_bin = bin;
+    while (padded_bin.size() % 4)
+        padded_bin.push_back(0);
+    const uint32_t header[5] = { 0x46546C67u, 2, (uint32_t)(12 + 8 + json.size() + 8 + padded_bin.size()),
+        (uint32_t)json.size(), 0x4E4F534Au };
+    const uint32_t bin_chunk[2] = { (uint32_t)padded_bin.size(), 0x004E4942u };
+    std::vector<uint8_t> out((const uint8_t*)header, (const uint8_t*)header + sizeof(header));
+    out.insert(out.end(), json.begin(), json.end());
+    out.insert(out.end(), (const uint8_t*)bin_chunk, (const uint8_t*)bin_chunk + sizeof(bin_chunk));
+    out.insert(out.end(), padded_bin.begin(), padded_bin.end());
+    return out;
+}
+
+static bool write_file(const std::string& path, const void* data, size_t size)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    const bool ok = f && fwrite(data, 1, size, f) == size;
+    return f && fclose(f) == 0 && ok;
+}
+
+static bool same_meshes(const GltfScene* a, const GltfScene* b)
+{
+    if (a->mesh_count != b->mesh_count || a->instance_count != b->instance_count)
+        return false;
+    for (uint32_t m = 0; m < a->mesh_count; ++m)
+    {
+        const GltfMesh* x = &a->meshes[m];
+        const GltfMesh* y = &b->meshes[m];
+        if (x->vertex_count != y->vertex_count || x->index_count != y->index_count || !x->colors != !y->colors
+            || memcmp(x->positions, y->positions, sizeof(float) * 3 * x->vertex_count)
+            || memcmp(x->indices, y->indices, sizeof(uint32_t) * x->index_count)
+            || (x->colors && memcmp(x->colors, y->colors, sizeof(float) * 3 * x->vertex_count)))
+            return false;
+    }
+    return !memcmp(a->instances, b->instances, sizeof(GltfInstance) * a->instance_count);
+}
+
+static bool near(float a, float b)
+{
+    return fabsf(a - b) < 1e-5f;
+}
+
+static bool import_checks(const std::filesystem::path& dir)
+{
+    const std::vector<uint8_t> bin = model_buffer();
+    const std::string uri_json = model_json(("data:application/octet-stream;base64," + base64(bin)).c_str(), bin.size());
+    const std::string file_json = model_json("model%20data.bin", bin.size());
+    const std::vector<uint8_t> binary = glb(model_json(NULL, bin.size()), bin);
+    const std::string gltf_path = (dir / "gltf_bench.gltf").string();
+    const std::string glb_path = (dir / "gltf_bench.glb").string();
+    bool ok = write_file((dir / "model data.bin").string(), bin.data(), bin.size())
+        && write_file(gltf_path, file_json.data(), file_json.size()) && write_file(glb_path, binary.data(), binary.size());
+
+    GltfScene inline_scene, file_scene, glb_scene;
+    const bool loaded = gltf_load_memory(&inline_scene, uri_json.data(), uri_json.size(), "");
+    const bool loaded_file = gltf_load(&file_scene, gltf_path.c_str());
+    const bool loaded_glb = gltf_load(&glb_scene, glb_path.c_str());
+    ok = report("data URI, .bin and .glb models load", ok && loaded && loaded_file && loaded_glb) && ok;
+    if (!loaded || !loaded_file || !loaded_glb)
+        return false;
+    ok = report("all three import to the same meshes", same_meshes(&inline_scene, &file_scene)
+        && same_meshes(&inline_scene, &glb_scene)) && ok;
+
+    const GltfMesh* cube = &inline_scene.meshes[0];
+    const GltfMesh* strip = &inline_scene.meshes[1];
+    ok = report("the cube reads with normalised colours", !strcmp(cube->name, "cube") && cube->vertex_count == 8
+        && cube->index_count == 36 && cube->colors && near(cube->colors[3 * 4], 128.f / 255.f)
+        && near(cube->colors[3 * 4 + 1], 1.f) && cube->min[0] == -1.f && cube->max[2] == 1.f && !cube->normals) && ok;
+    static const uint32_t strip_list[6] = { 0, 1, 2, 2, 1, 3 };
+    ok = report("a strip becomes a list, lines are skipped", !strcmp(strip->name, "mesh1") && strip->index_count == 6
+        && !memcmp(strip->indices, strip_list, sizeof(strip_list)) && inline_scene.skipped_primitives == 1) && ok;
+    ok = report("materials of the triangles read", cube->material == -1 && strip->material == 1) && ok;
+
+    // Node 1 sits at its parent's (10, 0, 0) plus (1, 0, 0) scaled by 2 and turned a quarter about Z
+    const GltfInstance* child = &inline_scene.instances[0];
+    const GltfInstance* placed = &inline_scene.instances[1];
+    ok = report("node transforms compose", inline_scene.instance_count == 2 && child->mesh == 0
+        && near(child->world[3][0], 10.f) && near(child->world[3][1], 2.f) && near(child->world[0][1], 2.f)
+        && near(child->world[0][0], 0.f) && placed->mesh == 1 && placed->world[3][0] == 5.f
+        && placed->world[3][2] == 7.f) && ok;
+    gltf_free(&inline_scene);
+    gltf_free(&file_scene);
+    gltf_free(&glb_scene);
+
+    const std::string bad = model_json(("data:;base64," + base64(bin)).c_str(), bin.size(), 9);
+    GltfScene refused;
+    fprintf(stderr, "(an error about an accessor follows)\n");
+    ok = report("an accessor past its view is refused", !gltf_load_memory(&refused, bad.data(), bad.size(), "")) && ok;
+    std::error_code ec;
+    std::filesystem::remove(dir / "model data.bin", ec);
+    std::filesystem::remove(gltf_path, ec);
+    std::filesystem::remove(glb_path, ec);
+    return ok;
+}
+
+// A bumpy sphere with n segments, its triangles in row order (what an exporter writes)
+static void sphere_mesh(GltfMesh* mesh, int n)
+{
+    memset(mesh, 0, sizeof(*mesh));
+    snprintf(mesh->name, sizeof(mesh->name), "sphere");
+    const int rings = n / 2;
+    mesh->vertex_count = (uint32_t)((rings + 1) * (n + 1));
+    mesh->positions = (float*)malloc(sizeof(float) * 3 * mesh->vertex_count);
+    mesh->normals = (float*)malloc(sizeof(float) * 3 * mesh->vertex_count);
+    mesh->index_count = (uint32_t)(rings * n * 6);
+    mesh->indices = (uint32_t*)malloc(sizeof(uint32_t) * mesh->index_count);
+    float* p = mesh->positions;
+    float* normal = mesh->normals;
+    for (int r = 0; r <= rings; ++r)
+    {
+        for (int s = 0; s <= n; ++s)
+        {
+            const float theta = 3.14159265f * r / rings, phi = 2.f * 3.14159265f * s / n;
+            const float bump = 1.f + 0.05f * sinf(7.f * phi) * sinf(5.f * theta);
+            const float d[3] = { sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta) };
+            for (int c = 0; c < 3; ++c)
+            {
+                *p++ = bump * d[c];
+                *normal++ = d[c];
+            }
+        }
+    }
+    uint32_t* i = mesh->indices;
+    for (int r = 0; r < rings; ++r)
+    {
+        for (int s = 0; s < n; ++s)
+        {
+            const uint32_t a = r * (n + 1) + s, b = a + n + 1;
+            const uint32_t quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+            memcpy(i, quad, sizeof(quad));
+            i += 6;
+        }
+    }
+}
+
+typedef struct CookBatch
+{
+    const GltfMesh* mesh;
+    const MeshCookOptions* options;
+    const std::vector<std::string>* paths;
+    bool* cooked;
+} CookBatch;
+
+static void cook_range(void* data, size_t begin, size_t end)
+{
+    CookBatch* batch = (CookBatch*)data;
+    MeshCookResult result;
+    for (size_t m = begin; m < end; ++m)
+        batch->cooked[m] = mesh_cook(batch->mesh, batch->options, (*batch->paths)[m].c_str(), &result);
+}
+
+static std::vector<uint8_t> read_file(const std::string& path)
+{
+    std::vector<uint8_t> data;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return data;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+    fclose(f);
+    return data;
+}
+
+static bool cook_checks(const std::filesystem::path& dir, int batch_size)
+{
+    GltfMesh sphere;
+    sphere_mesh(&sphere, 256);
+    MeshCookOptions options;
+    mesh_cook_default_options(&options);
+    MeshCookResult result;
+    const std::string path = (dir / "gltf_bench_sphere.mesh").string();
+    bool ok = report("a sphere cooks", mesh_cook(&sphere, &options, path.c_str(), &result));
+
+    MeshFile file;
+    const bool opened = ok && mesh_file_open(&file, path.c_str());
+    ok = report("the mesh file opens", opened) && ok;
+    if (opened)
+    {
+        uint32_t meshlet_triangles = 0;
+        bool contiguous = true;
+        for (uint32_t m = 0; m < file.meshlet_count; ++m)
+        {
+            contiguous = contiguous && file.meshlets[m].first_index == 3 * meshlet_triangles;
+            meshlet_triangles += file.meshlets[m].triangle_count;
+        }
+        ok = report("levels shrink, errors grow", file.lod_count > 2 && file.lods[0].index_count == result.index_count
+            && file.lods[1].index_count < file.lods[0].index_count && file.lods[1].error > 0.f
+            && file.lods[file.lod_count - 1].error >= file.lods[1].error) && ok;
+        ok = report("meshlets cover level 0 in order", file.meshlet_count == result.meshlet_count
+            && file.meshlet_count > 1 && contiguous && 3 * meshlet_triangles == file.lods[0].index_count) && ok;
+        const MeshFileHeader* h = file.header;
+        ok = report("half positions, UNORM8 colours after them", h->attrib_count == 2 && h->attribs[0].location == 0
+            && h->attribs[0].type == VERTEX_ATTRIB_FLOAT16 && h->attribs[1].type == VERTEX_ATTRIB_UNORM8
+            && h->vertex_stride == 8 && h->attribute_stride == 4 && h->attribs[1].stream == 1 && result.split
+            && h->attribute_offset % MESH_FILE_ALIGN == 0 && h->vertex_count == result.vertex_count) && ok;
+        mesh_file_close(&file);
+    }
+    ok = report("the cache order beats the row order", result.acmr_after < result.acmr_before) && ok;
+    printf("  sphere: %u vertices, %u triangles, %u levels, %u meshlets, acmr %.3f -> %.3f\n", result.vertex_count,
+        result.index_count / 3, result.lod_count, result.meshlet_count, result.acmr_before, result.acmr_after);
+
+    // A batch serially, then across the job system: same files, in less time
+    std::vector<std::string> serial_paths, parallel_paths;
+    for (int m = 0; m < batch_size; ++m)
+    {
+        serial_paths.push_back((dir / ("gltf_bench_serial" + std::to_string(m) + ".mesh")).string());
+        parallel_paths.push_back((dir / ("gltf_bench_parallel" + std::to_string(m) + ".mesh")).string());
+    }
+    std::vector<char> cooked(2 * batch_size, 0);
+    CookBatch serial = { &sphere, &options, &serial_paths, (bool*)cooked.data() };
+    CookBatch parallel = { &sphere, &options, &parallel_paths, (bool*)cooked.data() + batch_size };
+    const double t0 = now_ms();
+    cook_range(&serial, 0, batch_size);
+    const double t1 = now_ms();
+    JobSystem jobs;
+    double t2 = t1;
+    int threads = 1;
+    if (job_system_init(&jobs, 0))
+    {
+        threads = jobs.thread_count;
+        job_wait(&jobs, job_parallel_for(&jobs, cook_range, &parallel, batch_size, 1));
+        t2 = now_ms();
+        job_system_destroy(&jobs);
+    }
+    bool same = true;
+    for (int m = 0; m < batch_size; ++m)
+        same = same && cooked[m] && cooked[batch_size + m] && read_file(serial_paths[m]) == read_file(parallel_paths[m]);
+    ok = report("parallel cooking writes the same files", same) && ok;
+    printf("  %d meshes: serial %.1f ms, %d threads %.1f ms (%.2fx)\n", batch_size, t1 - t0, threads, t2 - t1,
+        (t1 - t0) / (t2 - t1 > 0.0 ? t2 - t1 : 1e-3));
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    for (int m = 0; m < batch_size; ++m)
+    {
+        std::filesystem::remove(serial_paths[m], ec);
+        std::filesystem::remove(parallel_paths[m], ec);
+    }
+    free(sphere.positions);
+    free(sphere.normals);
+    free(sphere.indices);
+    return ok;
+}
+
+// The sphere cooked with "streams" into "path"; the file open in "file" when it returns true
+static bool cook_streams(const GltfMesh* sphere, MeshCookStreams streams, const std::string& path, MeshFile* file,
+    MeshCookResult* result)
+{
+    MeshCookOptions options;
+    mesh_cook_default_options(&options);
+    options.streams = streams;
+    return mesh_cook(sphere, &options, path.c_str(), result) && mesh_file_open(file, path.c_str());
+}
+
+static bool stream_checks(const std::filesystem::path& dir)
+{
+    GltfMesh sphere, small;
+    sphere_mesh(&sphere, 256);
+    sphere_mesh(&small, 16);
+    const std::string split_path = (dir / "gltf_bench_split.mesh").string();
+    const std::string interleaved_path = (dir / "gltf_bench_interleaved.mesh").string();
+    const std::string small_path = (dir / "gltf_bench_small.mesh").string();
+    MeshFile split, interleaved, small_file;
+    MeshCookResult split_result, interleaved_result, small_result;
+    const bool split_opened = cook_streams(&sphere, MESH_COOK_STREAMS_SPLIT, split_path, &split, &split_result);
+    const bool interleaved_opened = cook_streams(&sphere, MESH_COOK_STREAMS_INTERLEAVED, interleaved_path,
+        &interleaved, &interleaved_result);
+    bool ok = report("cooked split and interleaved", split_opened && interleaved_opened && split_result.split
+        && !interleaved_result.split);
+    if (split_opened && interleaved_opened)
+    {
+        // Every vertex's position and colour bytes, read out of either layout
+        const MeshFileHeader* s = split.header;
+        const MeshFileHeader* i = interleaved.header;
+        const unsigned char* sv = (const unsigned char*)split.vertices;
+        const unsigned char* iv = (const unsigned char*)interleaved.vertices;
+        bool same = s->vertex_count == i->vertex_count && i->attribute_stride == 0
+            && mesh_file_vertex_bytes(s) == vertex_pack_size(s->vertex_stride, s->attribute_stride, s->vertex_count);
+        for (uint32_t v = 0; same && v < s->vertex_count; ++v)
+            same = memcmp(sv + (size_t)s->vertex_stride * v + s->attribs[0].offset,
+                    iv + (size_t)i->vertex_stride * v + i->attribs[0].offset, 6) == 0
+                && memcmp(sv + s->attribute_offset + (size_t)s->attribute_stride * v + s->attribs[1].offset,
+                    iv + (size_t)i->vertex_stride * v + i->attribs[1].offset, 3) == 0;
+        ok = report("the same vertices either way", same) && ok;
+        printf("  position-only pass: %u vertices, %.1f KB fetched split, %.1f KB interleaved\n", s->vertex_count,
+            (double)s->vertex_stride * s->vertex_count / 1024.0, (double)i->vertex_stride * i->vertex_count / 1024.0);
+    }
+    if (split_opened)
+        mesh_file_close(&split);
+    if (interleaved_opened)
+        mesh_file_close(&interleaved);
+    const bool small_opened = cook_streams(&small, MESH_COOK_STREAMS_AUTO, small_path, &small_file, &small_result);
+    ok = report("a small mesh stays interleaved", small_opened && !small_result.split
+        && small_file.header->attribute_stride == 0) && ok;
+    if (small_opened)
+        mesh_file_close(&small_file);
+
+    std::error_code ec;
+    std::filesystem::remove(split_path, ec);
+    std::filesystem::remove(interleaved_path, ec);
+    std::filesystem::remove(small_path, ec);
+    for (GltfMesh* mesh : { &sphere, &small })
+    {
+        free(mesh->positions);
+        free(mesh->normals);
+        free(mesh->indices);
+    }
+    return ok;
+}
+
+// Which way a triangle faces, seen from "center": 1 out, -1 in, 0 for no area
+static int facing(const float* a, const float* b, const float* c, const float* center)
+{
+    vec3 ab, ac, n, out;
+    vec3_sub(ab, b, a);
+    vec3_sub(ac, c, a);
+    vec3_mul_cross(n, ab, ac);
+    vec3_sub(out, a, center);
+    const float d = vec3_mul_inner(n, out);
+    return fabsf(d) < 1e-6f ? 0 : d > 0.f ? 1 : -1;
+}
+
+static bool batch_checks()
+{
+    // A 4x4 grid of spheres of material 0 and one of material 1 over it, in cells of 2 x 2: four batches of each.
+    // Then a sphere alone far off, two with mixed materials side by side, and two mirrored ones.
+    GltfMesh meshes[3];
+    for (int m = 0; m < 3; ++m)
+    {
+        sphere_mesh(&meshes[m], 8);
+        for (int c = 0; c < 3; ++c)
+        {
+            meshes[m].min[c] = -1.05f;
+            meshes[m].max[c] = 1.05f;
+        }
+        meshes[m].material = m == 2 ? GLTF_MATERIAL_MIXED : m;
+    }
+    std::vector<GltfInstance> instances;
+    auto place = [&instances](uint32_t mesh, float x, float y, float z, float sx) {
+        GltfInstance instance;
+        instance.mesh = mesh;
+        mat4x4_identity(instance.world);
+        mat4x4_rotate_Z(instance.world, instance.world, 0.3f * (float)instances.size());
+        mat4x4_scale_aniso(instance.world, instance.world, 0.4f * sx, 0.4f, 0.4f);
+        instance.world[3][0] = x;
+        instance.world[3][1] = y;
+        instance.world[3][2] = z;
+        instances.push_back(instance);
+    };
+    for (uint32_t m = 0; m < 2; ++m)
+        for (int i = 0; i < 16; ++i)
+            place(m, 0.5f + (float)(i % 4), 0.5f + (float)(i / 4), (float)m, 1.f);
+    place(0, 100.f, 100.f, 0.f, 1.f);
+    place(2, 20.5f, 0.5f, 0.f, 1.f);
+    place(2, 21.f, 0.5f, 0.f, 1.f);
+    place(0, 30.5f, 0.5f, 0.f, -1.f);
+    place(0, 31.f, 0.5f, 0.f, -1.f);
+    const GltfScene scene = { meshes, 3, instances.data(), (uint32_t)instances.size(), 0 };
+
+    StaticBatches batches;
+    bool ok = report("static batches built", static_batch_build(&batches, &scene, 2.f));
+    if (!ok)
+        return false;
+    bool grouped = batches.batch_count == 9 && batches.batched_count == 34;
+    for (uint32_t i = 32; i < 37; ++i)
+        grouped = grouped && batches.batched[i] == (i >= 35);
+    ok = report("by material and cell; lone and mixed left", grouped) && ok;
+
+    // Every batch's vertices are its instances' world positions about its centre, inside its box, and every
+    // triangle still faces out of its sphere, the mirrored ones' too
+    bool placed = true, outward = true;
+    for (uint32_t b = 0; b < batches.batch_count && grouped; ++b)
+    {
+        const StaticBatch* batch = &batches.batches[b];
+        const GltfMesh* mesh = &batch->mesh;
+        placed = placed && mesh->vertex_count == batch->instance_count * meshes[0].vertex_count
+            && mesh->index_count == batch->instance_count * meshes[0].index_count && mesh->colors && mesh->normals
+            && (mesh->material == 0 || mesh->material == 1);
+        uint32_t k = 0;
+        for (uint32_t i = 0; i < scene.instance_count && placed && k < batch->instance_count; ++i)
+        {
+            const GltfInstance* instance = &instances[i];
+            const GltfMesh* source = &meshes[instance->mesh];
+            float origin[3];
+            if (!batches.batched[i] || (int32_t)instance->mesh != mesh->material)
+                continue;
+            placed = (k + 1) * source->vertex_count <= mesh->vertex_count
+                && (k + 1) * source->index_count <= mesh->index_count;   // the batch has room for one more
+            if (!placed)
+                break;
+            const vec4 first = { source->positions[0], source->positions[1], source->positions[2], 1.f };
+            vec4 world;
+            mat4x4_mul_vec4(world, instance->world, first);
+            const float* p = &mesh->positions[3 * k * source->vertex_count];
+            bool here = true;
+            for (int c = 0; c < 3; ++c)
+                here = here && fabsf(p[c] + batch->center[c] - world[c]) < 1e-4f;
+            if (!here)
+                continue;   // another batch's
+            for (int c = 0; c < 3; ++c)
+                origin[c] = instance->world[3][c] - batch->center[c];
+            for (uint32_t t = 0; t < source->index_count / 3; ++t)
+            {
+                const uint32_t* tri = &mesh->indices[k * source->index_count + 3 * t];
+                const uint32_t* original = &source->indices[3 * t];
+                const float sphere_center[3] = { 0.f, 0.f, 0.f };
+                const int was = facing(&source->positions[3 * original[0]], &source->positions[3 * original[1]],
+                    &source->positions[3 * original[2]], sphere_center);
+                if (was)    // not one of the poles' triangles of no area
+                    outward = outward && facing(&mesh->positions[3 * tri[0]], &mesh->positions[3 * tri[1]],
+                        &mesh->positions[3 * tri[2]], origin) == was;
+            }
+            for (uint32_t v = 0; v < source->vertex_count; ++v)
+                for (int c = 0; c < 3; ++c)
+                    placed = placed && mesh->positions[3 * (k * source->vertex_count + v) + c] >= mesh->min[c] - 1e-5f
+                        && mesh->positions[3 * (k * source->vertex_count + v) + c] <= mesh->max[c] + 1e-5f;
+            ++k;
+        }
+        placed = placed && k == batch->instance_count;
+    }
+    ok = report("vertices in world space about the centre", placed) && ok;
+    ok = report("triangles face out, mirrored ones too", outward) && ok;
+    printf("  %u instances: %u static batches of %u, the rest %u entities\n", scene.instance_count,
+        batches.batch_count, batches.batched_count, scene.instance_count - batches.batched_count);
+    static_batch_free(&batches);
+    for (GltfMesh& mesh : meshes)
+    {
+        free(mesh.positions);
+        free(mesh.normals);
+        free(mesh.indices);
+    }
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int meshes = argc > 1 ? atoi(argv[1]) : 8;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    bool ok = json_checks();
+    ok = import_checks(dir) && ok;
+    ok = cook_checks(dir, meshes > 0 ? meshes : 1) && ok;
+    ok = stream_checks(dir) && ok;
+    ok = batch_checks() && ok;
+    printf("%s\n", ok ? "gltf_bench: ok" : "gltf_bench: FAIL");
+    return ok ? 0 : 1;
+}
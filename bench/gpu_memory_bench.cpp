@@ -0,0 +1,309 @@
+// Video memory accounting and residency check (src/core/gpu_memory.h): allocations add up per category and overall,
+// resizing replaces and deleting forgets, and the table still finds everything after heavy churn; over the budget
+// the residents lose their finest levels, the ones nothing drew first, the pinned levels never; a raised budget
+// brings back the levels still drawn; driver evictions cap the budget below what's tracked until it's been quiet;
+// the share is what the other categories leave; what's still tracked lists with where it was allocated. Times
+// tracking and forgetting against the table's size.
+//
+// Usage: gpu_memory_bench [objects]
+
+#include "core/gpu_memory.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define MB (1ull << 20)
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// A resident owned the way the renderer owns its mesh: one buffer holding levels [first, count)
+typedef struct Owner
+{
+    uint32_t buffer;
+    int id;
+    int first;
+    int level_count;
+    uint64_t level_bytes[GPU_MEMORY_MAX_LEVELS];
+} Owner;
+
+static uint64_t resident_bytes(const Owner* o)
+{
+    uint64_t bytes = 0;
+    for (int l = o->first; l < o->level_count; ++l)
+        bytes += o->level_bytes[l];
+    return bytes;
+}
+
+static void owner_add(GpuMemory* mem, Owner* o, uint32_t buffer, int level_count, uint64_t finest, int pinned)
+{
+    o->buffer = buffer;
+    o->first = 0;
+    o->level_count = level_count;
+    for (int l = 0; l < level_count; ++l)
+        o->level_bytes[l] = finest >> (2 * l);   // each level a quarter of the one before
+    o->id = gpu_memory_add_resident(mem, GPU_MEMORY_GEOMETRY, level_count, o->level_bytes, pinned);
+    gpu_memory_track(mem, GPU_MEMORY_BUFFER, buffer, GPU_MEMORY_GEOMETRY, resident_bytes(o));
+}
+
+// Ends a frame and carries out the changes; returns how many there were
+static int frame(GpuMemory* mem, Owner* owners, int count)
+{
+    GpuResidencyChange changes[GPU_MEMORY_MAX_RESIDENTS];
+    const int n = gpu_memory_update(mem, changes);
+    for (int i = 0; i < n; ++i)
+    {
+        for (int o = 0; o < count; ++o)
+        {
+            if (owners[o].id == changes[i].resident && owners[o].first == changes[i].from)
+            {
+                owners[o].first = changes[i].to;
+                gpu_memory_track(mem, GPU_MEMORY_BUFFER, owners[o].buffer, GPU_MEMORY_GEOMETRY, resident_bytes(&owners[o]));
+            }
+        }
+    }
+    return n;
+}
+
+static bool accounting_checks()
+{
+    GpuMemory* mem = new GpuMemory;
+    gpu_memory_init(mem, 0);
+    gpu_memory_track(mem, GPU_MEMORY_BUFFER, 1, GPU_MEMORY_GEOMETRY, 100);
+    gpu_memory_track(mem, GPU_MEMORY_BUFFER, 2, GPU_MEMORY_STORAGE, 50);
+    gpu_memory_track(mem, GPU_MEMORY_TEXTURE, 1, GPU_MEMORY_TEXTURES, 1000);    // same name, another kind
+    gpu_memory_track(mem, GPU_MEMORY_RENDERBUFFER, 7, GPU_MEMORY_RENDER_TARGETS, 400);
+    bool ok = report("allocations add up per category",
+        gpu_memory_bytes(mem, GPU_MEMORY_GEOMETRY) == 100 && gpu_memory_bytes(mem, GPU_MEMORY_STORAGE) == 50
+        && gpu_memory_bytes(mem, GPU_MEMORY_TEXTURES) == 1000 && gpu_memory_bytes(mem, GPU_MEMORY_RENDER_TARGETS) == 400
+        && gpu_memory_bytes(mem, GPU_MEMORY_CATEGORY_COUNT) == 1550);
+
+    gpu_memory_track(mem, GPU_MEMORY_BUFFER, 1, GPU_MEMORY_GEOMETRY, 300);      // respecified larger
+    gpu_memory_track(mem, GPU_MEMORY_BUFFER, 2, GPU_MEMORY_UNIFORMS, 50);       // and moved category
+    gpu_memory_forget(mem, GPU_MEMORY_TEXTURE, 1);
+    gpu_memory_forget(mem, GPU_MEMORY_TEXTURE, 99);                             // never tracked
+    gpu_memory_track(mem, GPU_MEMORY_BUFFER, 0, GPU_MEMORY_GEOMETRY, 999);      // no object
+    ok = report("resizing replaces, deleting forgets",
+        gpu_memory_bytes(mem, GPU_MEMORY_GEOMETRY) == 300 && gpu_memory_bytes(mem, GPU_MEMORY_STORAGE) == 0
+        && gpu_memory_bytes(mem, GPU_MEMORY_UNIFORMS) == 50 && gpu_memory_bytes(mem, GPU_MEMORY_TEXTURES) == 0
+        && gpu_memory_bytes(mem, GPU_MEMORY_CATEGORY_COUNT) == 750 && mem->object_count == 3 && mem->peak == 1750) && ok;
+
+    // The leak report's listing: every object still tracked, with where it was allocated
+    gpu_memory_track_at(mem, GPU_MEMORY_TEXTURE, 3, GPU_MEMORY_TEXTURES, 64, "a.cpp:1");
+    gpu_memory_track(mem, GPU_MEMORY_TEXTURE, 3, GPU_MEMORY_TEXTURES, 128);     // respecified: keeps its site
+    GpuMemoryObject left[8];
+    const uint32_t left_count = gpu_memory_objects(mem, left, 8);
+    bool sites_ok = left_count == 4 && gpu_memory_objects(mem, left, 2) == 4;
+    gpu_memory_objects(mem, left, 8);
+    for (uint32_t i = 0; i < left_count && i < 8; ++i)
+        sites_ok = sites_ok && (left[i].key == ((uint64_t)GPU_MEMORY_TEXTURE << 32 | 3)
+            ? left[i].bytes == 128 && left[i].site && !strcmp(left[i].site, "a.cpp:1") : !left[i].site);
+    ok = report("what's left lists where it was allocated", sites_ok) && ok;
+    gpu_memory_forget(mem, GPU_MEMORY_TEXTURE, 3);
+
+    // Churn: random creates and deletes against a reference, the table near its limit
+    gpu_memory_init(mem, 0);
+    std::vector<uint64_t> sizes(GPU_MEMORY_MAX_OBJECTS, 0);
+    uint64_t expected = 0;
+    unsigned int seed = 7;
+    for (int step = 0; step < 200000; ++step)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const uint32_t name = 1 + (seed >> 8) % (GPU_MEMORY_MAX_OBJECTS - 1);
+        const uint64_t bytes = (seed >> 4) % 3 ? 1 + (seed >> 12) % 4096 : 0;
+        if (!sizes[name] && bytes && mem->object_count >= GPU_MEMORY_MAX_OBJECTS * 3 / 4)
+            continue;   // would be dropped: keep the reference in step
+        expected += bytes;
+        expected -= sizes[name];
+        sizes[name] = bytes;
+        gpu_memory_track(mem, GPU_MEMORY_BUFFER, name, GPU_MEMORY_STORAGE, bytes);
+    }
+    // Still findable: retracking each at its size finds it where it is rather than adding it again
+    const uint32_t before = mem->object_count;
+    uint32_t live = 0;
+    for (uint32_t name = 1; name < GPU_MEMORY_MAX_OBJECTS; ++name)
+    {
+        if (sizes[name])
+        {
+            ++live;
+            gpu_memory_track(mem, GPU_MEMORY_BUFFER, name, GPU_MEMORY_STORAGE, sizes[name]);
+        }
+    }
+    ok = report("churn leaves every object findable", before == live && mem->object_count == live
+        && mem->dropped == 0 && gpu_memory_bytes(mem, GPU_MEMORY_STORAGE) == expected) && ok;
+    for (uint32_t name = 1; name < GPU_MEMORY_MAX_OBJECTS; ++name)
+        gpu_memory_forget(mem, GPU_MEMORY_BUFFER, name);
+    ok = report("forgetting them all empties the table",
+        mem->object_count == 0 && gpu_memory_bytes(mem, GPU_MEMORY_CATEGORY_COUNT) == 0) && ok;
+
+    // Past three quarters full, new objects go uncounted rather than slow every lookup
+    for (uint32_t name = 1; name <= GPU_MEMORY_MAX_OBJECTS; ++name)
+        gpu_memory_track(mem, GPU_MEMORY_BUFFER, name, GPU_MEMORY_STORAGE, 1);
+    ok = report("a full table drops, and counts, the rest", mem->object_count == GPU_MEMORY_MAX_OBJECTS * 3 / 4
+        && mem->dropped == GPU_MEMORY_MAX_OBJECTS / 4) && ok;
+    delete mem;
+    return ok;
+}
+
+static bool residency_checks()
+{
+    GpuMemory* mem = new GpuMemory;
+    gpu_memory_init(mem, 0);
+    gpu_memory_track(mem, GPU_MEMORY_TEXTURE, 1, GPU_MEMORY_RENDER_TARGETS, 16 * MB);   // not a resident
+    Owner owners[3];
+    owner_add(mem, &owners[0], 10, 4, 16 * MB, 3);  // 16 + 4 + 1 + 0.25 MB
+    owner_add(mem, &owners[1], 11, 4, 16 * MB, 3);
+    owner_add(mem, &owners[2], 12, 4, 16 * MB, 2);  // its last two levels stay
+    bool ok = report("no budget, nothing moves", frame(mem, owners, 3) == 0 && gpu_memory_budget(mem) == UINT64_MAX);
+
+    // 60 MB of 79.75: only 0 and 1 are drawn this frame, so 2 gives up its levels down to its pinned one
+    gpu_memory_set_budget(mem, 60 * MB);
+    gpu_memory_use(mem, owners[0].id, 0);
+    gpu_memory_use(mem, owners[1].id, 0);
+    frame(mem, owners, 3);
+    ok = report("the levels nothing drew go first", owners[2].first == 2 && owners[0].first == 0
+        && owners[1].first == 0 && gpu_memory_bytes(mem, GPU_MEMORY_CATEGORY_COUNT) <= 60 * MB) && ok;
+
+    // 0 drawn, then 1, then neither: 16 MB less takes 0's finest level, drawn longer ago
+    gpu_memory_use(mem, owners[0].id, 0);
+    frame(mem, owners, 3);
+    gpu_memory_use(mem, owners[1].id, 0);
+    frame(mem, owners, 3);
+    gpu_memory_set_budget(mem, 44 * MB);
+    frame(mem, owners, 3);
+    ok = report("then the least recently drawn", owners[0].first == 1 && owners[1].first == 0
+        && gpu_memory_bytes(mem, GPU_MEMORY_CATEGORY_COUNT) <= 44 * MB) && ok;
+
+    // Far too small: everything down to its pinned level, and an update that can't get under counts as over
+    gpu_memory_set_budget(mem, 1 * MB);
+    const uint64_t over_before = mem->over_budget_frames;
+    frame(mem, owners, 3);
+    ok = report("pinned levels stay, however small", owners[0].first == 3 && owners[1].first == 3
+        && owners[2].first == 2 && mem->over_budget_frames == over_before + 1) && ok;
+
+    // Room again: the drawn residents get their levels back, finest as wanted; the undrawn one waits
+    gpu_memory_set_budget(mem, 64 * MB);
+    gpu_memory_use(mem, owners[0].id, 0);
+    gpu_memory_use(mem, owners[1].id, 1);
+    frame(mem, owners, 3);
+    ok = report("a raised budget brings levels back", owners[0].first == 0 && owners[1].first == 1
+        && owners[2].first == 2 && mem->restored_bytes > 0) && ok;
+
+    // 1 wants its finest level back but it doesn't fit: 0 is drawn and 2 is down to its pinned level, so 1 waits
+    gpu_memory_set_budget(mem, 50 * MB);
+    gpu_memory_use(mem, owners[0].id, 0);
+    gpu_memory_use(mem, owners[1].id, 0);
+    frame(mem, owners, 3);
+    ok = report("restoring doesn't evict what's drawn",
+        owners[0].first == 0 && owners[1].first == 1 && gpu_memory_bytes(mem, GPU_MEMORY_CATEGORY_COUNT) <= 50 * MB) && ok;
+
+    // The share: the budget less the other categories
+    const uint64_t others = gpu_memory_bytes(mem, GPU_MEMORY_CATEGORY_COUNT)
+        - gpu_memory_bytes(mem, GPU_MEMORY_STREAMED_TEXTURES);
+    gpu_memory_track(mem, GPU_MEMORY_TEXTURE, 2, GPU_MEMORY_STREAMED_TEXTURES, 2 * MB);
+    ok = report("the share is what the others leave",
+        gpu_memory_share(mem, GPU_MEMORY_STREAMED_TEXTURES) == 50 * MB - others) && ok;
+
+    // A removed resident is left alone
+    gpu_memory_remove_resident(mem, owners[2].id);
+    gpu_memory_set_budget(mem, 1 * MB);
+    const int before2 = owners[2].first;
+    frame(mem, owners, 3);
+    ok = report("a removed resident is left alone", owners[2].first == before2) && ok;
+    delete mem;
+    return ok;
+}
+
+static bool driver_checks()
+{
+    GpuMemory* mem = new GpuMemory;
+    gpu_memory_init(mem, 0);
+    Owner owner;
+    owner_add(mem, &owner, 1, 4, 64 * MB, 3);       // 85 MB
+
+    // 1 GB free: the driver's cap is far off
+    GpuMemoryDriver driver = { 4 << 20, 1 << 20, 0, 0 };
+    gpu_memory_set_driver(mem, &driver);
+    gpu_memory_use(mem, owner.id, 0);
+    frame(mem, &owner, 1);
+    bool ok = report("the driver's free memory caps the budget", owner.first == 0
+        && gpu_memory_budget(mem) == gpu_memory_bytes(mem, GPU_MEMORY_CATEGORY_COUNT) + (1ull << 30) - GPU_MEMORY_HEADROOM);
+
+    // The driver evicts: down to 7/8 of what's tracked, which drops the finest level
+    driver.evictions = 3;
+    driver.evicted_kb = 32 << 10;
+    gpu_memory_set_driver(mem, &driver);
+    gpu_memory_use(mem, owner.id, 0);
+    frame(mem, &owner, 1);
+    ok = report("driver evictions shrink the budget", owner.first == 1 && mem->pressure_events == 1
+        && gpu_memory_budget(mem) < 85 * MB) && ok;
+
+    // The same count again isn't a new eviction; after the quiet frames the cap lifts and the level returns
+    gpu_memory_set_driver(mem, &driver);
+    bool held = true;
+    for (int f = 0; f < GPU_MEMORY_QUIET_FRAMES - 2; ++f)
+    {
+        gpu_memory_use(mem, owner.id, 0);
+        frame(mem, &owner, 1);
+        held = held && owner.first == 1;
+    }
+    ok = report("the cap holds while the driver is quiet", held) && ok;
+    for (int f = 0; f < 2; ++f)
+    {
+        gpu_memory_use(mem, owner.id, 0);
+        frame(mem, &owner, 1);
+    }
+    ok = report("the budget recovers once quiet", owner.first == 0 && mem->pressure_events == 1
+        && mem->pressure_cap == UINT64_MAX) && ok;
+    delete mem;
+    return ok;
+}
+
+static bool timing(uint32_t objects)
+{
+    GpuMemory* mem = new GpuMemory;
+    gpu_memory_init(mem, 0);
+    const double t0 = now_ms();
+    for (int pass = 0; pass < 100; ++pass)
+    {
+        for (uint32_t name = 1; name <= objects; ++name)
+            gpu_memory_track(mem, GPU_MEMORY_BUFFER, name, GPU_MEMORY_STORAGE, 256);
+        for (uint32_t name = 1; name <= objects; ++name)
+            gpu_memory_forget(mem, GPU_MEMORY_BUFFER, name);
+    }
+    const double t1 = now_ms();
+    printf("  %u objects tracked and forgotten 100 times: %.1f ns a call\n", objects,
+        (t1 - t0) * 1e6 / (200.0 * objects));
+    const bool ok = mem->object_count == 0 && gpu_memory_bytes(mem, GPU_MEMORY_CATEGORY_COUNT) == 0;
+    delete mem;
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t limit = GPU_MEMORY_MAX_OBJECTS * 3 / 4;
+    uint32_t objects = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : limit;
+    objects = objects < limit ? objects : limit;
+
+    printf("accounting:\n");
+    bool ok = accounting_checks();
+    printf("residency:\n");
+    ok = residency_checks() && ok;
+    printf("driver:\n");
+    ok = driver_checks() && ok;
+    printf("timing:\n");
+    ok = report("the timed table ends empty", timing(objects)) && ok;
+    printf("%s\n", ok ? "gpu_memory_bench: ok" : "gpu_memory_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+// Transform hierarchy check: builds a forest of random depth, sorts it breadth-first, then each frame
+// moves a fraction of the nodes and runs the incremental update. The world transforms are compared with a
+// full rebuild through 4x4 matrices, and the update is timed against that rebuild. Also checks the
+// linmath_trs.h operations (invert, lerp, to_mat4x4) against their matrix equivalents.
+//
+// Usage: hierarchy_bench [nodes] [frames]
+
+#include "scene/transform_hierarchy.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static uint32_t random_u32(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    return lo + (hi - lo) * (float)random_u32(state) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void random_local(unsigned int* state, trs* local)
+{
+    vec3 axis = { random_float(state, -.3f, .3f), random_float(state, -.3f, .3f), 1.f };
+    vec3_norm(axis, axis);
+    local->t[0] = random_float(state, -2.f, 2.f);
+    local->t[1] = random_float(state, -2.f, 2.f);
+    local->t[2] = random_float(state, -.1f, .1f);
+    quat_rotate(local->r, random_float(state, -3.14159f, 3.14159f), axis);
+    local->s[0] = local->s[1] = local->s[2] = random_float(state, .9f, 1.1f);
+}
+
+// What the update replaces: every world matrix rebuilt from scratch each frame with mat4x4_mul
+static void rebuild_all(const TransformHierarchy* h, const mat4x4* local, mat4x4* world)
+{
+    for (uint32_t i = 0; i < h->count; ++i)
+    {
+        if (h->parent[i] == TRANSFORM_NO_PARENT)
+            mat4x4_dup(world[i], local[i]);
+        else
+            mat4x4_mul(world[i], world[h->parent[i]], local[i]);
+    }
+}
+
+static float matrix_error(mat4x4 const a, mat4x4 const b)
+{
+    float worst = 0.f;
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            worst = fmaxf(worst, fabsf(a[c][r] - b[c][r]) / fmaxf(1.f, fabsf(b[c][r])));
+    return worst;
+}
+
+// World transforms against the matrix rebuild; float error grows with depth, hence the tolerance
+static bool check(const TransformHierarchy* h, mat4x4* local, mat4x4* reference)
+{
+    for (uint32_t i = 0; i < h->count; ++i)
+        trs_to_mat4x4(local[i], &h->local[i]);
+    rebuild_all(h, local, reference);
+    float worst = 0.f;
+    for (uint32_t i = 0; i < h->count; ++i)
+    {
+        mat4x4 world;
+        trs_to_mat4x4(world, &h->world[i]);
+        worst = fmaxf(worst, matrix_error(world, reference[i]));
+    }
+    if (worst > 1e-4f)
+        fprintf(stderr, "  world transforms off by %g\n", worst);
+    return worst <= 1e-4f;
+}
+
+// trs_invert, trs_lerp at its ends and trs_mul_vec3 against the matrix versions
+static bool check_trs_ops(unsigned int* state)
+{
+    float worst = 0.f;
+    for (int n = 0; n < 1000; ++n)
+    {
+        trs a, b, r;
+        random_local(state, &a);
+        random_local(state, &b);
+        mat4x4 ma, mb, mr, inverse;
+        trs_to_mat4x4(ma, &a);
+        trs_to_mat4x4(mb, &b);
+
+        trs_mul(&r, &a, &b);
+        trs_to_mat4x4(mr, &r);
+        mat4x4_mul(inverse, ma, mb);
+        worst = fmaxf(worst, matrix_error(mr, inverse));
+
+        trs_invert(&r, &a);
+        trs_to_mat4x4(mr, &r);
+        mat4x4_invert(inverse, ma);
+        worst = fmaxf(worst, matrix_error(mr, inverse));
+
+        trs_lerp(&r, &a, &b, 0.f);
+        trs_to_mat4x4(mr, &r);
+        worst = fmaxf(worst, matrix_error(mr, ma));
+        trs_lerp(&r, &a, &b, 1.f);
+        trs_to_mat4x4(mr, &r);
+        worst = fmaxf(worst, matrix_error(mr, mb));
+
+        vec4 p = { random_float(state, -5.f, 5.f), random_float(state, -5.f, 5.f), random_float(state, -5.f, 5.f), 1.f }, expected;
+        vec3 q;
+        trs_mul_vec3(q, &a, p);
+        mat4x4_mul_vec4(expected, ma, p);
+        for (int k = 0; k < 3; ++k)
+            worst = fmaxf(worst, fabsf(q[k] - expected[k]) / fmaxf(1.f, fabsf(expected[k])));
+    }
+    if (worst > 1e-5f)
+        fprintf(stderr, "  trs ops off by %g\n", worst);
+    return worst <= 1e-5f;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t nodes = argc > 1 ? (uint32_t)atol(argv[1]) : 200000u;
+    const int frames = argc > 2 ? atoi(argv[2]) : 50;
+
+    unsigned int state = 12345u;
+    const bool ops_ok = check_trs_ops(&state);
+    printf("trs (%zu bytes, mat4x4 %zu): mul / invert / lerp / mul_vec3 %s\n", sizeof(trs), sizeof(mat4x4), ops_ok ? "ok" : "MISMATCH");
+
+    TransformHierarchy h;
+    if (!transform_hierarchy_init(&h, nodes))
+        return EXIT_FAILURE;
+    // Parents are picked uniformly among the earlier nodes: a random recursive forest, O(log n) deep and
+    // not in breadth-first order
+    for (uint32_t i = 0; i < nodes; ++i)
+    {
+        trs local;
+        random_local(&state, &local);
+        const uint32_t parent = i < 16 || random_u32(&state) % 64 == 0 ? TRANSFORM_NO_PARENT : random_u32(&state) % i;
+        transform_hierarchy_add(&h, parent, &local);
+    }
+    double start = now_ms();
+    if (!transform_hierarchy_sort(&h, NULL))
+        return EXIT_FAILURE;
+    printf("%u nodes sorted breadth-first in %.1f ms\n", h.count, now_ms() - start);
+    bool ordered = true;
+    for (uint32_t i = 0; i < h.count; ++i)
+        ordered = ordered && (h.parent[i] == TRANSFORM_NO_PARENT ? i == 0 || h.parent[i - 1] == TRANSFORM_NO_PARENT : h.parent[i] < i
+            && (i == 0 || h.parent[i - 1] == TRANSFORM_NO_PARENT || h.parent[i - 1] <= h.parent[i]));
+    printf("breadth-first order: %s\n", ordered ? "ok" : "BROKEN");
+
+    std::vector<mat4x4> local(nodes), reference(nodes);
+    transform_hierarchy_update(&h);
+    bool ok = ops_ok && ordered && check(&h, local.data(), reference.data());
+
+    start = now_ms();
+    for (int f = 0; f < frames; ++f)
+        rebuild_all(&h, local.data(), reference.data());
+    const double rebuild_ms = (now_ms() - start) / frames;
+    printf("full mat4x4 rebuild: %u matrices %8.3f ms\n", h.count, rebuild_ms);
+
+    printf("moved/frame  updated/frame  update ms  vs rebuild\n");
+    const double fractions[] = { 0., 0.001, 0.01, 0.1, 1. };
+    for (double fraction : fractions)
+    {
+        const uint32_t moved = (uint32_t)(fraction * h.count);
+        uint64_t updated = 0;
+        double ms = 0.;
+        for (int f = 0; f < frames; ++f)
+        {
+            for (uint32_t m = 0; m < moved; ++m)
+            {
+                trs t;
+                random_local(&state, &t);
+                transform_hierarchy_set_local(&h, moved == h.count ? m : random_u32(&state) % h.count, &t);
+            }
+            start = now_ms();
+            transform_hierarchy_update(&h);
+            ms += now_ms() - start;
+            updated += h.updated;
+        }
+        ms /= frames;
+        const bool frame_ok = check(&h, local.data(), reference.data());
+        ok = ok && frame_ok;
+        printf("%11u  %13llu  %9.3f  %9.2fx  %s\n", moved, (unsigned long long)(updated / frames), ms, rebuild_ms / ms,
+            frame_ok ? "ok" : "MISMATCH");
+    }
+
+    transform_hierarchy_destroy(&h);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,148 @@
+// Hitch detector check (src/core/hitch_detector.h): a synthetic run of frames, each a few passes binding a few
+// programs, goes through core/frame_stats.h as the swap would. Now and then a pass runs long, and sometimes it binds
+// a program never bound before. Checks that exactly those frames are logged, each with the slow pass first and its
+// program marked as a first use when it was one, that nesting returns to the enclosing pass, and that programs
+// already seen aren't flagged. Then times a pass boundary and a program bind.
+//
+// Usage: hitch_detector_bench [frames]
+
+#include "core/frame_stats.h"
+#include "core/hitch_detector.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define FRAME_MS 16.0
+#define HITCH_EVERY 97      // one frame in this many has a slow pass
+#define HITCH_MS 40.0
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-46s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static const char* passes[] = { "shadow", "scene", "post" };
+
+// A frame on a clock that only moves when told to: three passes of FRAME_MS / 4, the middle one nesting a
+// "lights" pass, and the rest of the frame outside any pass. A hitch frame's slow pass takes HITCH_MS more.
+static double run_frame(HitchDetector* h, double t, int slow_pass, uint32_t slow_program)
+{
+    for (int p = 0; p < 3; ++p)
+    {
+        hitch_detector_push(h, passes[p], t);
+        hitch_detector_program(h, 1 + p);      // the same three programs every frame
+        if (p == 1)
+        {
+            hitch_detector_push(h, "lights", t + 0.001);
+            hitch_detector_program(h, 10 | HITCH_PIPELINE);
+            hitch_detector_pop(h, t + 0.002);
+        }
+        if (p == slow_pass)
+        {
+            hitch_detector_program(h, slow_program);
+            t += HITCH_MS / 1000.0;
+        }
+        t += FRAME_MS / 4000.0;
+        hitch_detector_pop(h, t);
+    }
+    return t + FRAME_MS / 4000.0;
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned frames = argc > 1 && atoi(argv[1]) > 0 ? (unsigned)atoi(argv[1]) : 2000;
+    bool ok = true;
+    printf("correctness:\n");
+
+    FILE* log = tmpfile();
+    FrameStats stats;
+    HitchDetector h;
+    if (!log || !frame_stats_init(&stats))
+        return 1;
+    hitch_detector_init(&h, true, log);
+
+    double t = 1.0;
+    frame_stats_frame(&stats, t);
+    hitch_detector_end_frame(&h, t, false, 0.0);
+    unsigned injected = 0, new_programs = 0, reported = 0;
+    for (unsigned f = 1; f <= frames; ++f)
+    {
+        // Hitches only once the first interval has given frame_stats a median
+        const bool hitch = f % HITCH_EVERY == 0 && f * FRAME_MS > 1000.0 * FRAME_STATS_INTERVAL_SECONDS;
+        const int slow_pass = hitch ? (int)(f / HITCH_EVERY % 3) : -1;
+        const bool fresh = hitch && f / HITCH_EVERY % 2 == 0;     // a program never bound before, or program 2 again
+        const uint32_t slow_program = fresh ? 100 + f : 2;
+        injected += hitch;
+        new_programs += fresh;
+        t = run_frame(&h, t, slow_pass, slow_program);
+        const bool stutter = frame_stats_frame(&stats, t);
+        reported += stutter;
+        hitch_detector_end_frame(&h, t, stutter, stats.median_ms);
+    }
+    ok = report("every injected hitch and nothing else logged", injected > 0 && reported == injected
+        && h.hitches == injected && h.frames == frames + 1) && ok;
+
+    // Read the log back: each hitch's first span line is the slow pass, with "(first use)" iff it was fresh
+    std::vector<std::string> lines;
+    char line[512];
+    rewind(log);
+    while (fgets(line, sizeof(line), log))
+        lines.push_back(line);
+    unsigned headers = 0, slow_first = 0, first_uses = 0;
+    bool nested = true, clean = true;
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        if (lines[i].compare(0, 6, "hitch:"))
+            continue;
+        ++headers;
+        if (i + 1 >= lines.size())
+            break;
+        const std::string& span = lines[i + 1];
+        for (int p = 0; p < 3; ++p)
+            slow_first += !span.compare(2, strlen(passes[p]), passes[p]) && span.find(" ms") != std::string::npos;
+        first_uses += span.find("(first use)") != std::string::npos;
+        // The slow pass binds its own program before the slow part: the span after a nested pass is the enclosing one's
+        nested = nested && span.compare(2, 6, "lights");
+        for (size_t k = i + 1; k < lines.size() && lines[k].compare(0, 6, "hitch:"); ++k)
+            clean = clean && (lines[k].find("pipeline 10 (first use)") == std::string::npos);
+    }
+    ok = report("the slow pass leads each hitch", headers == injected && slow_first == injected) && ok;
+    ok = report("new programs flagged as a first use, old not", first_uses == new_programs) && ok;
+    ok = report("a pop returns to the enclosing pass", nested) && ok;
+    ok = report("programs seen before aren't flagged again", clean
+        && h.seen_count == 4 + new_programs) && ok;
+    printf("  %u hitches in %u frames, %u with a program's first use\n", injected, frames, new_programs);
+    if (!lines.empty())
+    {
+        printf("  e.g.\n");
+        for (size_t i = 0; i < lines.size() && i < 4; ++i)
+            printf("    %s", lines[i].c_str());
+    }
+    fclose(log);
+    frame_stats_destroy(&stats);
+
+    // Cost: a pass boundary and a program bind, as the profiler and the state cache make them
+    HitchDetector timed;
+    hitch_detector_init(&timed, true, stdout);
+    const int calls = 1000000;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+    {
+        if (i % 64 == 0)
+            hitch_detector_end_frame(&timed, i * 1e-6, false, 0.0);
+        hitch_detector_push(&timed, "pass", i * 1e-6);
+        hitch_detector_program(&timed, 1 + (uint32_t)(i & 7));
+        hitch_detector_pop(&timed, i * 1e-6);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    printf("cost: %.1f ns per push + bind + pop\n", ns);
+    ok = ok && timed.frames > 0;
+
+    printf("%s\n", ok ? "hitch_detector_bench: ok" : "hitch_detector_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+// Huge pages: the same work over memory in normal pages and in huge pages (core/huge_pages.h), timed, with the data
+// TLB's read misses counted where the CPU's counters can be read (Linux perf_event_open; perf_event_paranoid 2 or
+// lower lets a process count its own user-space events). A random walk over a big buffer, a cache line in a random
+// page each step, shows the TLB alone; the ECS transform system over a big world (chunks from huge-page blocks or
+// the heap) shows what a real pass gets; its steps are entities.
+//
+// Huge pages come from MAP_HUGETLB when some are set aside (vm.nr_hugepages), else transparent huge pages. The
+// row says which the allocation got; "normal pages" in the huge row means the system had none to give.
+//
+// Usage: huge_page_bench [buffer MB] [entities] [steps]
+
+#include "core/huge_pages.h"
+#include "scene/ecs.h"
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t random_u64(uint64_t* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// The calling thread's data TLB read misses, user space only; fd -1 when they can't be counted
+typedef struct TlbCounter
+{
+    int fd;
+} TlbCounter;
+
+static void tlb_counter_open(TlbCounter* c)
+{
+    c->fd = -1;
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    c->fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static void tlb_counter_start(TlbCounter* c)
+{
+#ifdef __linux__
+    if (c->fd >= 0)
+    {
+        ioctl(c->fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(c->fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)c;
+#endif
+}
+
+// Misses since tlb_counter_start, -1 when not counted
+static long long tlb_counter_stop(TlbCounter* c)
+{
+#ifdef __linux__
+    if (c->fd < 0)
+        return -1;
+    long long count = -1;
+    ioctl(c->fd, PERF_EVENT_IOC_DISABLE, 0);
+    return read(c->fd, &count, sizeof(count)) == (ssize_t)sizeof(count) ? count : -1;
+#else
+    (void)c;
+    return -1;
+#endif
+}
+
+static void tlb_counter_close(TlbCounter* c)
+{
+#ifdef __linux__
+    if (c->fd >= 0)
+        close(c->fd);
+#endif
+    c->fd = -1;
+}
+
+static void print_row(const char* pass, const char* memory, double ns, long long misses, double steps)
+{
+    char text[32] = "n/a";
+    if (misses >= 0)
+        snprintf(text, sizeof(text), "%.3f", (double)misses / steps);
+    printf("%-8s %-24s %10.2f %14s\n", pass, memory, ns, text);
+}
+
+// A cycle through one cache line of every 4 KB page in a random order, each line holding the next one's offset;
+// walking it misses the TLB on nearly every step in normal pages
+static void random_walk(size_t bytes, uint64_t steps, bool huge, TlbCounter* counter, uint64_t* sink)
+{
+    huge_pages_enable(huge);
+    HugePageKind kind;
+    unsigned char* memory = (unsigned char*)huge_pages_alloc(bytes, &kind);
+    if (!memory)
+    {
+        printf("out of memory for %zu MB\n", bytes >> 20);
+        return;
+    }
+    const size_t pages = bytes / 4096;
+    std::vector<uint32_t> order(pages);
+    for (size_t i = 0; i < pages; ++i)
+        order[i] = (uint32_t)i;
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (size_t i = pages - 1; i > 0; --i)      // Sattolo's shuffle: one cycle through all of them
+    {
+        const size_t j = (size_t)(random_u64(&state) % i);
+        const uint32_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    std::vector<uint32_t> line(pages);
+    for (size_t i = 0; i < pages; ++i)
+        line[i] = (uint32_t)(random_u64(&state) % 64) * 64;
+    for (size_t i = 0; i < pages; ++i)
+    {
+        const size_t at = (size_t)i * 4096 + line[i];
+        const size_t next = (size_t)order[i] * 4096 + line[order[i]];
+        memcpy(memory + at, &next, sizeof(next));
+    }
+
+    size_t at = line[0];
+    for (uint64_t s = 0; s < pages; ++s)        // warm: every page faulted in and cached as far as it fits
+        memcpy(&at, memory + at, sizeof(at));
+    tlb_counter_start(counter);
+    const double start = now_ms();
+    for (uint64_t s = 0; s < steps; ++s)
+        memcpy(&at, memory + at, sizeof(at));
+    const double ms = now_ms() - start;
+    const long long misses = tlb_counter_stop(counter);
+    *sink += at;
+    print_row("walk", huge_page_kind_name(kind), ms * 1e6 / (double)steps, misses, (double)steps);
+    huge_pages_free(memory, bytes);
+}
+
+// The transform system over a world made with huge pages on or off, serially so one thread's counter sees it all
+static void ecs_pass(uint32_t entities, bool huge, TlbCounter* counter)
+{
+    huge_pages_enable(huge);
+    EcsWorld world;
+    if (!ecs_init(&world, entities))
+        return;
+    uint64_t state = 12345u;
+    for (uint32_t i = 0; i < entities; ++i)
+    {
+        const EcsEntity e = ecs_create(&world, ECS_MASK_ALL);
+        if (!e)
+            break;
+        *(float*)ecs_field(&world, e, ECS_FIELD_X) = (float)(random_u64(&state) % 200) - 100.f;
+        *(float*)ecs_field(&world, e, ECS_FIELD_Y) = (float)(random_u64(&state) % 200) - 100.f;
+        *(float*)ecs_field(&world, e, ECS_FIELD_SCALE) = 1.f;
+    }
+    mat4x4 vp;
+    mat4x4_identity(vp);
+    const int runs = 10;
+    ecs_update_transforms(&world, NULL, vp);
+    tlb_counter_start(counter);
+    const double start = now_ms();
+    for (int r = 0; r < runs; ++r)
+        ecs_update_transforms(&world, NULL, vp);
+    const double ms = (now_ms() - start) / runs;
+    const long long misses = tlb_counter_stop(counter);
+    print_row("ecs", world.huge_pages ? "huge page blocks" : "heap chunks", ms * 1e6 / entities, misses,
+        (double)entities * runs);
+    ecs_destroy(&world);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t megabytes = argc > 1 ? (size_t)atol(argv[1]) : 1024;
+    const uint32_t entities = argc > 2 ? (uint32_t)atol(argv[2]) : 1000000u;
+    const uint64_t steps = argc > 3 ? (uint64_t)atoll(argv[3]) : 4000000u;
+    const size_t bytes = megabytes << 20;
+    if (bytes < 4096 || !entities || !steps)
+    {
+        fprintf(stderr, "usage: huge_page_bench [buffer MB] [entities] [steps]\n");
+        return EXIT_FAILURE;
+    }
+
+    TlbCounter counter;
+    tlb_counter_open(&counter);
+    printf("huge page size %zu KB; dTLB read misses %s\n", huge_page_size() / 1024,
+        counter.fd >= 0 ? "counted" : "can't be counted here (n/a)");
+    printf("walk: %llu steps over %zu MB; ecs: %u entities, transform system\n", (unsigned long long)steps, megabytes,
+        entities);
+    printf("%-8s %-24s %10s %14s\n", "pass", "memory", "ns/step", "dTLB miss/step");
+    uint64_t sink = 0;
+    random_walk(bytes, steps, false, &counter, &sink);
+    random_walk(bytes, steps, true, &counter, &sink);
+    ecs_pass(entities, false, &counter);
+    ecs_pass(entities, true, &counter);
+    tlb_counter_close(&counter);
+    return sink == 1 ? EXIT_FAILURE : EXIT_SUCCESS;     // keeps the walk from being optimised away
+}
@@ -0,0 +1,188 @@
+// Impostors (scene/impostor.h): the atlas's frames and the choice of which objects are drawn as one. The frames
+// must cover every direction, the nearest frame within the frame spacing of it; each frame's bake matrix must put
+// its image plane where impostor_frame_basis says, so the quads the shader builds line up with what was baked. Then
+// a plain of objects seen from a low perspective camera chooses meshes or impostors, checked against the pixel
+// sizes worked out directly, with the hysteresis keeping the choice as the camera creeps to and fro, and the
+// selection and split are timed, serially and on the job system.
+//
+// Usage: impostor_bench [objects] [threshold pixels]
+
+#include "core/job_system.h"
+#include "scene/impostor.h"
+#include "scene/lod.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SPREAD 400.f        // the plain's half-width
+#define VIEWPORT_HEIGHT 1080.f
+#define DIRECTIONS 100000
+#define FRAMES 20
+#define GRAIN 4096
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Looking along +y from low over the plain's edge, "forward" units in
+static void camera_at(float forward, mat4x4 view_projection)
+{
+    vec3 eye = { 0.f, forward - SPREAD, 3.f }, center = { 0.f, forward, 0.f }, up = { 0.f, 0.f, 1.f };
+    mat4x4 projection, view;
+    mat4x4_perspective(projection, 1.f, 16.f / 9.f, 0.1f, 4.f * SPREAD);
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(view_projection, projection, view);
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t count = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 1000000;
+    const float threshold = argc > 2 && atof(argv[2]) > 0.0 ? (float)atof(argv[2]) : 8.f;
+    unsigned int state = 12345u;
+    bool ok = true;
+
+    // Every direction lands in a frame within the spacing: half a column's yaw and half a row's elevation
+    const float spacing = 3.14159265f * sqrtf(1.f / (IMPOSTOR_YAW_FRAMES * IMPOSTOR_YAW_FRAMES)
+        + 1.f / (IMPOSTOR_PITCH_FRAMES * IMPOSTOR_PITCH_FRAMES) / 4.f);
+    float worst = 0.f;
+    for (int d = 0; d < DIRECTIONS; ++d)
+    {
+        vec3 dir = { random_float(&state, -1.f, 1.f), random_float(&state, -1.f, 1.f),
+            random_float(&state, -1.f, 1.f) };
+        if (vec3_len(dir) < 1e-3f)
+            continue;
+        vec3_norm(dir, dir);
+        int column, row;
+        vec3 frame;
+        impostor_nearest_frame(dir, &column, &row);
+        impostor_frame_direction(column, row, frame);
+        const float angle = acosf(fminf(1.f, vec3_mul_inner(dir, frame)));
+        worst = angle > worst ? angle : worst;
+    }
+    ok = report("every direction within the frame spacing", worst <= spacing) && ok;
+
+    // Each frame's image plane: the bake matrix sends its right and up, at the quad's half-width, to the cell's edges
+    float plane_error = 0.f;
+    for (int row = 0; row < IMPOSTOR_PITCH_FRAMES; ++row)
+    {
+        for (int column = 0; column < IMPOSTOR_YAW_FRAMES; ++column)
+        {
+            vec3 dir, right, up;
+            mat4x4 m;
+            impostor_frame_direction(column, row, dir);
+            impostor_frame_basis(column, row, right, up);
+            impostor_frame_matrix(column, row, 1.f, m);
+            plane_error = fmaxf(plane_error, fabsf(vec3_mul_inner(dir, right)) + fabsf(vec3_mul_inner(dir, up))
+                + fabsf(vec3_mul_inner(right, up)) + fabsf(vec3_len(up) - 1.f));
+            for (int corner = 0; corner < 4; ++corner)
+            {
+                const float u = corner & 1 ? 1.f : -1.f, v = corner & 2 ? 1.f : -1.f;
+                const float extent = 1.f / IMPOSTOR_FRAME_FILL;
+                const vec4 p = { extent * (u * right[0] + v * up[0]), extent * (u * right[1] + v * up[1]),
+                    extent * (u * right[2] + v * up[2]), 1.f };
+                vec4 clip;
+                mat4x4_mul_vec4(clip, m, p);
+                plane_error = fmaxf(plane_error, fabsf(clip[0] / clip[3] - u) + fabsf(clip[1] / clip[3] - v));
+                plane_error = fmaxf(plane_error, fabsf(clip[2] / clip[3]) > 1.f ? 1.f : 0.f);
+            }
+        }
+    }
+    ok = report("bake matrices match the frames' image planes", plane_error < 1e-4f) && ok;
+
+    std::vector<float> x(count), y(count), radius(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        x[i] = random_float(&state, -SPREAD, SPREAD);
+        y[i] = random_float(&state, -SPREAD, SPREAD);
+        radius[i] = random_float(&state, 0.2f, 1.f);
+    }
+    mat4x4 vp;
+    camera_at(0.f, vp);
+    std::vector<uint8_t> impostor(count, 0);
+    ImpostorSelection selection = { vp, VIEWPORT_HEIGHT, threshold, 0.25f, x.data(), y.data(), NULL, radius.data(),
+        NULL, impostor.data() };
+    impostor_select_range(&selection, 0, count);
+    size_t wrong = 0, impostors = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float pixels = 2.f * radius[i] * lod_pixel_scale(vp, x[i], y[i], 0.f, VIEWPORT_HEIGHT);
+        wrong += (pixels < threshold) != (impostor[i] != 0);
+        impostors += impostor[i];
+    }
+    ok = report("the choice follows the objects' sizes in pixels", wrong == 0) && ok;
+
+    std::vector<uint32_t> split(count);
+    const size_t meshes = impostor_partition(impostor.data(), NULL, count, split.data());
+    bool ordered = meshes + impostors == count;
+    for (size_t k = 0; k < count && ordered; ++k)
+        ordered = (impostor[split[k]] != 0) == (k >= meshes) && (k == meshes || k == 0 || split[k] > split[k - 1]);
+    ok = report("meshes first, then impostors, each in order", ordered) && ok;
+
+    // Creeping forward and back by a fraction of a unit, the hysteresis keeps almost every choice
+    size_t flips = 0, flips_without = 0;
+    std::vector<uint8_t> plain(impostor);
+    ImpostorSelection no_hysteresis = selection;
+    no_hysteresis.hysteresis = 0.f;
+    no_hysteresis.impostor = plain.data();
+    for (int step = 0; step < 8; ++step)
+    {
+        camera_at(step & 1 ? 0.5f : 0.f, vp);
+        std::vector<uint8_t> last(impostor), last_plain(plain);
+        impostor_select_range(&selection, 0, count);
+        impostor_select_range(&no_hysteresis, 0, count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            flips += impostor[i] != last[i];
+            flips_without += plain[i] != last_plain[i];
+        }
+    }
+    ok = report("hysteresis keeps the choice while the camera creeps", flips < flips_without / 4 + 1) && ok;
+    printf("  %zu of %u objects are impostors under %.1f px (%.1f%%); %zu changes creeping, %zu without hysteresis\n",
+        impostors, count, (double)threshold, 100.0 * impostors / count, flips, flips_without);
+    printf("  nearest frames at most %.2f degrees off (%d x %d frames)\n", worst * 57.2957795, IMPOSTOR_YAW_FRAMES,
+        IMPOSTOR_PITCH_FRAMES);
+
+    JobSystem jobs;
+    if (!job_system_init(&jobs, 0))
+    {
+        fprintf(stderr, "impostor_bench: can't start the job system\n");
+        return 1;
+    }
+    camera_at(0.f, vp);
+    double serial = 0.0, parallel = 0.0;
+    for (int f = 0; f < FRAMES; ++f)
+    {
+        double t0 = now_ms();
+        impostor_select_range(&selection, 0, count);
+        impostor_partition(impostor.data(), NULL, count, split.data());
+        double t1 = now_ms();
+        serial += t1 - t0;
+        t0 = now_ms();
+        job_wait(&jobs, job_parallel_for(&jobs, impostor_select_range, &selection, count, GRAIN));
+        impostor_partition(impostor.data(), NULL, count, split.data());
+        parallel += now_ms() - t0;
+    }
+    printf("select and split per frame over %d frames, %d job threads:\n", FRAMES, jobs.thread_count);
+    printf("  %-22s %8.3f ms (%.2f ns an object)\n", "serial", serial / FRAMES, 1e6 * serial / FRAMES / count);
+    printf("  %-22s %8.3f ms\n", "jobs", parallel / FRAMES);
+    job_system_destroy(&jobs);
+
+    printf("%s\n", ok ? "impostor_bench: ok" : "impostor_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+// Input queue check: a producer thread pushes numbered events into the lock-free ring
+// (src/core/input_queue.h) as fast as it can, retrying whenever the ring is full, while the consumer
+// drains it in batches the way the simulation does each tick. Fails if any event is lost, duplicated or
+// reordered, and reports the throughput and how often the producer found the ring full.
+//
+// Usage: input_queue_bench [events] [batch]
+
+#include "core/input_queue.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv)
+{
+    const long events = argc > 1 ? atol(argv[1]) : 10000000L;
+    const size_t batch = argc > 2 ? (size_t)atol(argv[2]) : 32;
+    if (events < 1 || batch < 1)
+    {
+        fprintf(stderr, "usage: %s [events] [batch]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    InputQueue* q = new InputQueue;
+    input_queue_init(q);
+    const double start = now_ms();
+    std::thread producer([q, events]
+    {
+        for (long i = 0; i < events; ++i)
+        {
+            const InputEvent e = { (double)i, INPUT_EVENT_KEY, (int)(i & 0x7FFFFFFF), (int)(i % 3), 0, (double)i, -(double)i };
+            while (!input_queue_push(q, &e))
+                std::this_thread::yield();
+        }
+    });
+
+    std::vector<InputEvent> out(batch);
+    long expected = 0, drains = 0, empty = 0;
+    bool ok = true;
+    while (expected < events && ok)
+    {
+        const size_t n = input_queue_drain(q, out.data(), batch);
+        ++drains;
+        if (!n)
+        {
+            ++empty;
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t k = 0; k < n && ok; ++k, ++expected)
+        {
+            const InputEvent* e = &out[k];
+            ok = e->time == (double)expected && e->code == (int)(expected & 0x7FFFFFFF) && e->action == (int)(expected % 3)
+                && e->x == (double)expected && e->y == -(double)expected;
+            if (!ok)
+                fprintf(stderr, "  event %ld arrived as %.0f\n", expected, e->time);
+        }
+    }
+    producer.join();
+    const double ms = now_ms() - start;
+    ok = ok && input_queue_drain(q, out.data(), batch) == 0;
+    printf("%ld events, batches of %zu: %.1f ms, %.1f M events/s, %ld drains (%ld empty), ring full %u times  %s\n",
+        events, batch, ms, events / ms / 1000.0, drains, empty, q->dropped.load(), ok ? "ok" : "FAIL");
+    delete q;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,102 @@
+// Scaling benchmark for the job system: builds and multiplies model matrices for a large batch of objects
+// (the per-frame transform update) with 1..N threads and prints the time and speedup per thread count.
+//
+// Usage: job_scaling [objects] [frames] [max threads]
+
+#include "linmath.h"
+#include "linmath_batch.h"
+
+#include "core/cpu_topology.h"
+#include "core/job_system.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+typedef struct TransformBatch
+{
+    float* pos_x;
+    float* pos_y;
+    float* angle;
+    mat4x4* model;
+    mat4x4 view_projection;
+    float t;
+} TransformBatch;
+
+// One range of the frame's transform update: angle -> model -> view_projection * model
+static void transform_range(void* data, size_t begin, size_t end)
+{
+    TransformBatch* batch = (TransformBatch*)data;
+    for (size_t i = begin; i < end; ++i)
+        batch->angle[i] = batch->t + (float)i * 0.1f;
+    mat4x4_translate_rotate_Z_batch(batch->model + begin, batch->pos_x + begin, batch->pos_y + begin, NULL,
+        batch->angle + begin, 0.01f, end - begin);
+    mat4x4_mul_batch(batch->model + begin, batch->view_projection, batch->model + begin, end - begin);
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv)
+{
+    const size_t objects = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    const int frames = argc > 2 ? atoi(argv[2]) : 50;
+    const size_t grain = 4096;
+    const int max_threads = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+
+    TransformBatch batch;
+    batch.pos_x = new float[objects];
+    batch.pos_y = new float[objects];
+    batch.angle = new float[objects];
+    batch.model = new mat4x4[objects];
+    for (size_t i = 0; i < objects; ++i)
+    {
+        batch.pos_x[i] = (float)(i % 1000) * 0.002f - 1.f;
+        batch.pos_y[i] = (float)(i / 1000) * 0.002f - 1.f;
+    }
+    mat4x4_ortho(batch.view_projection, -1.333f, 1.333f, -1.f, 1.f, 1.f, -1.f);
+
+    CpuTopology topology;
+    cpu_topology_probe(&topology);
+    cpu_topology_print(&topology, stdout);
+    const int pool = cpu_topology_job_threads(&topology, true);     // the app's default, with its render thread
+
+    printf("%zu objects, %d frames, grain %zu\n", objects, frames, grain);
+    printf("threads  ms/frame  speedup  efficiency\n");
+    double base = 0.0;
+    for (int threads = 1; threads <= max_threads; threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2)
+    {
+        JobSystem js;
+        if (!job_system_init(&js, threads))
+            return EXIT_FAILURE;
+
+        // Warm up once, then time the frames
+        batch.t = 0.f;
+        job_wait(&js, job_parallel_for(&js, transform_range, &batch, objects, grain));
+        const double start = now_ms();
+        for (int f = 0; f < frames; ++f)
+        {
+            batch.t = (float)f * 0.016f;
+            job_wait(&js, job_parallel_for(&js, transform_range, &batch, objects, grain));
+        }
+        const double ms = (now_ms() - start) / frames;
+        job_system_destroy(&js);
+
+        if (threads == 1)
+            base = ms;
+        printf("%7d  %8.3f  %7.2fx  %9.0f%%%s\n", threads, ms, base / ms, 100.0 * base / ms / threads,
+            threads == pool ? "  (the app's pool)" : "");
+        if (threads == max_threads)
+            break;
+    }
+
+    delete[] batch.pos_x;
+    delete[] batch.pos_y;
+    delete[] batch.angle;
+    delete[] batch.model;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+// Line series check (src/core/line_series.h): every pyramid bucket is the min and max of its samples, after the
+// history has wrapped; views stay within the pixels and their range is the samples'; a copy kept with
+// line_series_take_dirty alone ends up equal to the series, while taking about two pairs a sample. Then times
+// appending and views at a few history lengths.
+//
+// Usage: line_series_bench [capacity] [frames]
+
+#include "core/line_series.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static float sample(uint64_t i)
+{
+    uint32_t x = (uint32_t)i * 0x9E3779B9u;
+    x ^= x >> 16; x *= 0x7FEB352Du; x ^= x >> 15;
+    return (float)sin(i * 0.001) + ((x >> 8) / 16777216.f - 0.5f);
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t capacity = argc > 1 ? (uint32_t)atoi(argv[1]) : 1u << 16;
+    const int frames = argc > 2 ? atoi(argv[2]) : 3000;
+    const int per_frame = 37;       // not a power of two, so buckets straddle frames
+    LineSeries series;
+    if (!line_series_init(&series, capacity))
+        return EXIT_FAILURE;
+    const uint64_t total = (uint64_t)frames * per_frame;
+    float* all = (float*)malloc(sizeof(float) * total);
+    for (uint64_t i = 0; i < total; ++i)
+        all[i] = sample(i);
+
+    // The copy the GPU would hold, kept current from the dirty ranges only
+    float* mirror = (float*)calloc(2 * (size_t)series.capacity * 2, sizeof(float));
+    uint64_t pairs_taken = 0;
+    for (int f = 0; f < frames; ++f)
+    {
+        line_series_append(&series, all + (size_t)f * per_frame, per_frame);
+        for (int l = 0; l < series.level_count; ++l)
+        {
+            uint32_t ranges[2][2];
+            const int n = line_series_take_dirty(&series, l, ranges);
+            for (int k = 0; k < n; ++k)
+            {
+                const uint32_t first = series.level_offset[l] + ranges[k][0];
+                memcpy(mirror + 2 * first, series.buckets + 2 * first, sizeof(float) * 2 * ranges[k][1]);
+                pairs_taken += ranges[k][1];
+            }
+        }
+    }
+    const size_t pyramid = 2 * (size_t)(2 * series.capacity - 1);
+    const bool mirrored = !memcmp(mirror, series.buckets, sizeof(float) * pyramid);
+    printf("  %u samples kept of %llu, %d levels; %.2f pairs taken a sample\n", series.capacity,
+        (unsigned long long)total, series.level_count, (double)pairs_taken / total);
+    bool ok = report("dirty ranges keep a copy equal", mirrored && pairs_taken < 4 * total);
+
+    // Every bucket of every level still in its ring, against its samples
+    bool exact = true;
+    for (int l = 0; l < series.level_count && exact; ++l)
+    {
+        const uint64_t buckets = series.capacity >> l, newest = (total - 1) >> l;
+        for (uint64_t b = newest + 1 - buckets; b <= newest && exact; ++b)
+        {
+            float lo = INFINITY, hi = -INFINITY;
+            for (uint64_t i = b << l; i < ((b + 1) << l) && i < total; ++i)
+            {
+                lo = all[i] < lo ? all[i] : lo;
+                hi = all[i] > hi ? all[i] : hi;
+            }
+            const float* p = series.buckets + 2 * (series.level_offset[l] + (b & (buckets - 1)));
+            exact = p[0] == lo && p[1] == hi;
+        }
+    }
+    ok = report("buckets hold their samples' min and max", exact) && ok;
+
+    // Views: within the pixels, level 0 when the samples fit, and the range of what they cover
+    bool fits = true;
+    const int pixels = 1000;
+    const uint64_t spans[4] = { 500, 5000, series.capacity, total };
+    for (int k = 0; k < 4; ++k)
+    {
+        LineSeriesView view;
+        line_series_view(&series, total - spans[k], spans[k], pixels, &view);
+        const uint64_t from = view.first << view.level;
+        const uint64_t to = ((view.first + view.buckets) << view.level) < total ? (view.first + view.buckets) << view.level
+            : total;
+        float lo = INFINITY, hi = -INFINITY;
+        for (uint64_t i = from; i < to; ++i)
+        {
+            lo = all[i] < lo ? all[i] : lo;
+            hi = all[i] > hi ? all[i] : hi;
+        }
+        printf("  last %8llu samples: level %2d, %4u buckets, %4u points\n", (unsigned long long)spans[k], view.level,
+            view.buckets, view.buckets * (view.level ? 2 : 1));
+        fits = fits && view.buckets <= (uint32_t)pixels && view.buckets > 0 && (spans[k] > (uint64_t)pixels || !view.level)
+            && view.min == lo && view.max == hi;
+    }
+    ok = report("views fit the pixels and cover the range", fits) && ok;
+
+    // Cost: appending a frame's samples, and a full-history view, at growing history lengths
+    for (uint32_t c = 1u << 12; c <= 1u << 24; c <<= 6)
+    {
+        LineSeries s;
+        line_series_init(&s, c);
+        float chunk[256];
+        for (int i = 0; i < 256; ++i)
+            chunk[i] = sample(i);
+        for (uint64_t n = 0; n < c; n += 256)
+            line_series_append(&s, chunk, 256);
+        double t = now_ms();
+        for (int i = 0; i < 1000; ++i)
+            line_series_append(&s, chunk, 32);
+        const double append_us = (now_ms() - t);
+        t = now_ms();
+        LineSeriesView view;
+        for (int i = 0; i < 1000; ++i)
+            line_series_view(&s, 0, s.count, 1920, &view);
+        const double view_us = (now_ms() - t);
+        printf("  history %8u: %.2f us appending 32 samples, %.2f us viewing all of it (level %d)\n", c, append_us,
+            view_us, view.level);
+        line_series_destroy(&s);
+    }
+    free(mirror);
+    free(all);
+    line_series_destroy(&series);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,614 @@
+// Microbenchmarks for linmath.h (and the batch entry points in linmath_batch.h, the affine matrices in linmath_affine.h,
+// the transforms in linmath_trs.h, the fast-math batches in linmath_fast.h, the quaternion kernels in linmath_quat.h,
+// the bounding volume kernels in linmath_bounds.h,
+// the double-precision variants in linmath_double.h and the C++ front-end in linmath.hpp).
+//
+// Every op runs over arrays of "batch" independent inputs, so small batches measure latency out of L1 and large
+// ones throughput with the working set spilling out of cache. Reported as ns per op. Build the scalar variant
+// (LINMATH_NO_SIMD) next to the default one to compare backends; --json output carries the backend so results
+// from both can be tracked side by side.
+//
+// Usage: linmath_bench [--json] [--filter SUBSTRING] [--min-time MS] [--batch N]...
+
+#include "linmath.h"
+#include "linmath_affine.h"
+#include "linmath_batch.h"
+#include "linmath_bounds.h"
+#include "linmath_double.h"
+#include "linmath_fast.h"
+#include "linmath.hpp"
+#include "linmath_quat.h"
+#include "linmath_trs.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BENCH_CLOBBER() _ReadWriteBarrier()
+#else
+#define BENCH_CLOBBER() __asm__ __volatile__("" ::: "memory")
+#endif
+
+#define BENCH_MAX_BATCH 65536
+
+// Inputs and outputs shared by every op; inputs are well-conditioned (invertible matrices, unit quaternions)
+typedef struct BenchData
+{
+    mat4x4* a;
+    mat4x4* b;
+    mat4x4* out;
+    mat4x4* straddled;  // b again, 16 bytes past a cache line: every matrix spans two
+    mat3x4* a3;         // a and b without their constant bottom row
+    mat3x4* b3;
+    mat3x4* out3;
+    vec4* u;
+    vec4* v;
+    vec4* vout;
+    quat* p;
+    quat* q;
+    quat_soa sp;        // p and q as structure-of-arrays
+    quat_soa sq;
+    quat_soa sout;
+    trs* ta;
+    trs* tb;
+    trs* tout;
+    float* angle;
+    float* x;
+    float* y;
+    float* z;
+    float* fout;
+    float* extent;      // box half-extents, x then y then z, around centres (x, y, z)
+    float* bounds_out;  // six arrays: transformed centres, then extents
+    vec4 planes[6];     // unit normals, with bounds on both sides of each
+    dmat4x4* da;        // a and b in double, their translations 10^7 out
+    dmat4x4* db;
+    dmat4x4* dout;
+    dvec4* du;          // u and v in double, as world positions 10^7 out
+    dvec4* dv;
+    dvec4* dvout;
+} BenchData;
+
+typedef void (*BenchFunction)(BenchData* d, size_t n);
+
+typedef struct BenchOp
+{
+    const char* name;
+    BenchFunction function;
+} BenchOp;
+
+// Defines bench_<name>: "body" runs once per element i
+#define BENCH_OP(name, body) \
+    static void bench_##name(BenchData* d, size_t n) \
+    { \
+        for (size_t i = 0; i < n; ++i) \
+        { \
+            body; \
+        } \
+    }
+
+// vec##n ops (vec2/vec3 read the leading components of the vec4 arrays)
+#define BENCH_VEC_OPS(n) \
+    BENCH_OP(vec##n##_add, vec##n##_add(d->vout[i], d->u[i], d->v[i])) \
+    BENCH_OP(vec##n##_sub, vec##n##_sub(d->vout[i], d->u[i], d->v[i])) \
+    BENCH_OP(vec##n##_scale, vec##n##_scale(d->vout[i], d->u[i], d->x[i])) \
+    BENCH_OP(vec##n##_mul_inner, d->fout[i] = vec##n##_mul_inner(d->u[i], d->v[i])) \
+    BENCH_OP(vec##n##_len, d->fout[i] = vec##n##_len(d->u[i])) \
+    BENCH_OP(vec##n##_norm, vec##n##_norm(d->vout[i], d->u[i])) \
+    BENCH_OP(vec##n##_min, vec##n##_min(d->vout[i], d->u[i], d->v[i])) \
+    BENCH_OP(vec##n##_max, vec##n##_max(d->vout[i], d->u[i], d->v[i])) \
+    BENCH_OP(vec##n##_dup, vec##n##_dup(d->vout[i], d->u[i]))
+
+BENCH_VEC_OPS(2)
+BENCH_VEC_OPS(3)
+BENCH_VEC_OPS(4)
+BENCH_OP(vec3_mul_cross, vec3_mul_cross(d->vout[i], d->u[i], d->v[i]))
+BENCH_OP(vec3_reflect, vec3_reflect(d->vout[i], d->u[i], d->v[i]))
+BENCH_OP(vec4_mul_cross, vec4_mul_cross(d->vout[i], d->u[i], d->v[i]))
+BENCH_OP(vec4_reflect, vec4_reflect(d->vout[i], d->u[i], d->v[i]))
+
+BENCH_OP(mat4x4_identity, mat4x4_identity(d->out[i]))
+BENCH_OP(mat4x4_dup, mat4x4_dup(d->out[i], d->a[i]))
+BENCH_OP(mat4x4_row, mat4x4_row(d->vout[i], d->a[i], (int)(i & 3)))
+BENCH_OP(mat4x4_col, mat4x4_col(d->vout[i], d->a[i], (int)(i & 3)))
+BENCH_OP(mat4x4_transpose, mat4x4_transpose(d->out[i], d->a[i]))
+BENCH_OP(mat4x4_add, mat4x4_add(d->out[i], d->a[i], d->b[i]))
+BENCH_OP(mat4x4_sub, mat4x4_sub(d->out[i], d->a[i], d->b[i]))
+BENCH_OP(mat4x4_scale, mat4x4_scale(d->out[i], d->a[i], d->x[i]))
+BENCH_OP(mat4x4_scale_aniso, mat4x4_scale_aniso(d->out[i], d->a[i], d->x[i], d->y[i], d->z[i]))
+BENCH_OP(mat4x4_mul, mat4x4_mul(d->out[i], d->a[i], d->b[i]))
+BENCH_OP(mat4x4_mul_restrict, mat4x4_mul_restrict(d->out[i], d->a[i], d->b[i]))
+BENCH_OP(mat4x4_mul_straddled, mat4x4_mul(d->out[i], d->a[i], d->straddled[i]))
+BENCH_OP(mat4x4_mul_vec4, mat4x4_mul_vec4(d->vout[i], d->a[i], d->v[i]))
+BENCH_OP(mat4x4_translate, mat4x4_translate(d->out[i], d->x[i], d->y[i], d->z[i]))
+BENCH_OP(mat4x4_translate_in_place, mat4x4_dup(d->out[i], d->a[i]); mat4x4_translate_in_place(d->out[i], d->x[i], d->y[i], d->z[i]))
+BENCH_OP(mat4x4_from_vec3_mul_outer, mat4x4_from_vec3_mul_outer(d->out[i], d->u[i], d->v[i]))
+BENCH_OP(mat4x4_rotate, mat4x4_rotate(d->out[i], d->a[i], d->u[i][0], d->u[i][1], d->u[i][2], d->angle[i]))
+BENCH_OP(mat4x4_rotate_X, mat4x4_rotate_X(d->out[i], d->a[i], d->angle[i]))
+BENCH_OP(mat4x4_rotate_Y, mat4x4_rotate_Y(d->out[i], d->a[i], d->angle[i]))
+BENCH_OP(mat4x4_rotate_Z, mat4x4_rotate_Z(d->out[i], d->a[i], d->angle[i]))
+BENCH_OP(mat4x4_invert, mat4x4_invert(d->out[i], d->a[i]))
+BENCH_OP(mat4x4_orthonormalize, mat4x4_orthonormalize(d->out[i], d->a[i]))
+BENCH_OP(mat4x4_frustum, mat4x4_frustum(d->out[i], -d->x[i], d->x[i], -d->y[i], d->y[i], 0.1f, 100.f))
+BENCH_OP(mat4x4_ortho, mat4x4_ortho(d->out[i], -d->x[i], d->x[i], -d->y[i], d->y[i], 1.f, -1.f))
+BENCH_OP(mat4x4_perspective, mat4x4_perspective(d->out[i], d->angle[i], d->x[i], 0.1f, 100.f))
+BENCH_OP(mat4x4_perspective_reversed, mat4x4_perspective_reversed(d->out[i], d->angle[i], d->x[i], 0.1f, 100.f))
+BENCH_OP(mat4x4_perspective_reversed_infinite, mat4x4_perspective_reversed_infinite(d->out[i], d->angle[i], d->x[i], 0.1f))
+BENCH_OP(mat4x4_ortho_reversed, mat4x4_ortho_reversed(d->out[i], -d->x[i], d->x[i], -d->y[i], d->y[i], 1.f, -1.f))
+BENCH_OP(mat4x4_frustum_invert, mat4x4_frustum_invert(d->out[i], d->b[i]))     // only reads the frustum entries
+BENCH_OP(mat4x4_ortho_invert, mat4x4_ortho_invert(d->out[i], d->a[i]))
+BENCH_OP(mat4x4_look_at, mat4x4_look_at(d->out[i], d->u[i], d->v[i], d->vout[0]))
+BENCH_OP(mat4x4_from_quat, mat4x4_from_quat(d->out[i], d->q[i]))
+BENCH_OP(mat4x4o_mul_quat, mat4x4o_mul_quat(d->out[i], d->a[i], d->q[i]))
+BENCH_OP(mat4x4_arcball, mat4x4_arcball(d->out[i], d->a[i], d->u[i], d->v[i], 1.f))
+
+BENCH_OP(mat3x4_mul, mat3x4_mul(d->out3[i], d->a3[i], d->b3[i]))
+BENCH_OP(mat3x4_invert, mat3x4_invert(d->out3[i], d->a3[i]))
+BENCH_OP(mat3x4_mul_vec3, mat3x4_mul_vec3(d->vout[i], d->a3[i], d->v[i]))
+BENCH_OP(mat3x4_from_mat4x4, mat3x4_from_mat4x4(d->out3[i], d->a[i]))
+
+BENCH_OP(dmat4x4_mul, dmat4x4_mul(d->dout[i], d->da[i], d->db[i]))
+BENCH_OP(dmat4x4_mul_dvec4, dmat4x4_mul_dvec4(d->dvout[i], d->da[i], d->dv[i]))
+BENCH_OP(dmat4x4_translate_in_place, dmat4x4_dup(d->dout[i], d->da[i]); dmat4x4_translate_in_place(d->dout[i], d->du[i][0], d->du[i][1], d->du[i][2]))
+BENCH_OP(mat4x4_from_dmat4x4_relative, mat4x4_from_dmat4x4_relative(d->out[i], d->da[i], d->du[i]))
+BENCH_OP(vec3_from_dvec3_sub, vec3_from_dvec3_sub(d->vout[i], d->du[i], d->dv[i]))
+
+BENCH_OP(quat_identity, quat_identity(d->vout[i]))
+BENCH_OP(quat_mul, quat_mul(d->vout[i], d->p[i], d->q[i]))
+BENCH_OP(quat_conj, quat_conj(d->vout[i], d->q[i]))
+BENCH_OP(quat_rotate, quat_rotate(d->vout[i], d->angle[i], d->u[i]))
+BENCH_OP(quat_mul_vec3, quat_mul_vec3(d->vout[i], d->q[i], d->v[i]))
+BENCH_OP(quat_from_mat4x4, quat_from_mat4x4(d->vout[i], d->b[i]))
+BENCH_OP(quat_from_mat4x4_fast, quat_from_mat4x4_fast(d->vout[i], d->b[i]))
+BENCH_OP(quat_nlerp, quat_nlerp(d->vout[i], d->p[i], d->q[i], d->x[i] - 0.5f))
+BENCH_OP(quat_slerp, quat_slerp(d->vout[i], d->p[i], d->q[i], d->x[i] - 0.5f))
+BENCH_OP(quat_to_mat3x4, quat_to_mat3x4(d->out3[i], d->q[i], d->u[i]))
+
+BENCH_OP(trs_mul, trs_mul(&d->tout[i], &d->ta[i], &d->tb[i]))
+BENCH_OP(trs_invert, trs_invert(&d->tout[i], &d->ta[i]))
+BENCH_OP(trs_lerp, trs_lerp(&d->tout[i], &d->ta[i], &d->tb[i], d->x[i] - 0.5f))
+BENCH_OP(trs_mul_vec3, trs_mul_vec3(d->vout[i], &d->ta[i], d->v[i]))
+BENCH_OP(trs_to_mat4x4, trs_to_mat4x4(d->out[i], &d->ta[i]))
+BENCH_OP(trs_mul_to_mat4x4, trs_mul_to_mat4x4(d->out[i], d->b[0], &d->ta[i]))
+
+// linmath.hpp: the same operations through the C++ value types, which should cost what the C calls do
+BENCH_OP(cpp_mat4_mul, linmath::view(d->out[i]) = linmath::view(d->a[i]) * linmath::view(d->b[i]))
+BENCH_OP(cpp_mat4_mul_vec4, linmath::view(d->vout[i]) = linmath::view(d->a[i]) * linmath::view(d->v[i]))
+BENCH_OP(cpp_mat4_invert, linmath::view(d->out[i]) = linmath::invert(linmath::view(d->a[i])))
+BENCH_OP(cpp_quat_mul, linmath::view_quat(d->vout[i]) = linmath::view_quat(d->p[i]) * linmath::view_quat(d->q[i]))
+BENCH_OP(cpp_vec4_mul_add, linmath::view(d->vout[i]) = linmath::mul_add(linmath::view(d->u[i]), d->x[i], linmath::view(d->v[i])))
+
+// Constant matrices fold: these are checked by the compiler, not at run time
+constexpr linmath::mat4 bench_projection = linmath::ortho(-2.f, 2.f, -1.f, 1.f, 1.f, -1.f);
+constexpr linmath::mat4 bench_view_projection = bench_projection * linmath::scale(2.f, 2.f, 1.f);
+static_assert(bench_projection[0][0] == .5f && bench_projection[1][1] == 1.f && bench_projection[2][2] == 1.f,
+    "ortho is constexpr");
+static_assert(bench_view_projection[0][0] == 1.f && bench_view_projection[1][1] == 2.f, "mat4 * mat4 is constexpr");
+static_assert(linmath::invert(bench_view_projection) * bench_view_projection == linmath::identity(), "invert is constexpr");
+static_assert(linmath::len(linmath::vec3{ { 3.f, 4.f, 12.f } }) == 13.f, "len is constexpr");
+
+// linmath_batch.h: one call over the whole batch, still reported per element
+static void bench_mat4x4_mul_batch(BenchData* d, size_t n) { mat4x4_mul_batch(d->out, d->a[0], d->b, n); }
+static void bench_mat4x4_rotate_Z_batch(BenchData* d, size_t n) { mat4x4_rotate_Z_batch(d->out, d->a, d->angle, n); }
+static void bench_mat4x4_mul_vec4_batch(BenchData* d, size_t n) { mat4x4_mul_vec4_batch(d->vout, d->a[0], d->v, n); }
+static void bench_mat4x4_transform_soa(BenchData* d, size_t n)
+{
+    mat4x4_transform_soa(d->fout, d->fout + BENCH_MAX_BATCH, d->fout + 2 * BENCH_MAX_BATCH, NULL, d->a[0], d->x, d->y, d->z, NULL, n);
+}
+static void bench_mat4x4_translate_rotate_Z_batch(BenchData* d, size_t n)
+{
+    mat4x4_translate_rotate_Z_batch(d->out, d->x, d->y, d->z, d->angle, 0.5f, n);
+}
+static void bench_mat4x4_mul_translate_rotate_Z_batch(BenchData* d, size_t n)
+{
+    mat4x4_mul_translate_rotate_Z_batch(d->out, d->b[0], d->x, d->y, d->z, d->angle, 0.5f, n);
+}
+// The model matrices first, then view-projection times each: what the fused batch above saves
+static void bench_mat4x4_translate_rotate_Z_then_mul_batch(BenchData* d, size_t n)
+{
+    mat4x4_translate_rotate_Z_batch(d->out, d->x, d->y, d->z, d->angle, 0.5f, n);
+    mat4x4_mul_batch(d->out, d->b[0], d->out, n);
+}
+static void bench_mat3x4_translate_rotate_Z_batch(BenchData* d, size_t n)
+{
+    mat3x4_translate_rotate_Z_batch(d->out3, d->x, d->y, d->z, d->angle, 0.5f, n);
+}
+// linmath_bounds.h: the batches per element, the plane tests eight elements a call
+BENCH_OP(mat3x4_transform_aabb, mat3x4_transform_aabb(d->vout[i], d->fout + 3 * i, d->a3[i], d->u[i], d->v[i]))
+static void bench_mat3x4_transform_aabb_soa(BenchData* d, size_t n)
+{
+    float* o = d->bounds_out;
+    mat3x4_transform_aabb_soa(o, o + BENCH_MAX_BATCH, o + 2 * BENCH_MAX_BATCH, o + 3 * BENCH_MAX_BATCH,
+        o + 4 * BENCH_MAX_BATCH, o + 5 * BENCH_MAX_BATCH, d->a3, d->x, d->y, d->z, d->extent,
+        d->extent + BENCH_MAX_BATCH, d->extent + 2 * BENCH_MAX_BATCH, n);
+}
+static void bench_mat3x4_transform_sphere_soa(BenchData* d, size_t n)
+{
+    float* o = d->bounds_out;
+    mat3x4_transform_sphere_soa(o, o + BENCH_MAX_BATCH, o + 2 * BENCH_MAX_BATCH, o + 3 * BENCH_MAX_BATCH, d->a3, d->x,
+        d->y, d->z, d->extent, n);
+}
+static void bench_planes_test_spheres8(BenchData* d, size_t n)
+{
+    unsigned int* masks = (unsigned int*)d->bounds_out;
+    for (size_t i = 0; i + 8 <= n; i += 8)
+        masks[i / 8] = planes_test_spheres8(d->planes, 6, d->x + i, d->y + i, d->z + i, d->extent + i);
+}
+static void bench_planes_test_aabbs8(BenchData* d, size_t n)
+{
+    unsigned int* masks = (unsigned int*)d->bounds_out;
+    for (size_t i = 0; i + 8 <= n; i += 8)
+        masks[i / 8] = planes_test_aabbs8(d->planes, 6, d->x + i, d->y + i, d->z + i, d->extent + i,
+            d->extent + BENCH_MAX_BATCH + i, d->extent + 2 * BENCH_MAX_BATCH + i);
+}
+static void bench_fast_sincos_batch(BenchData* d, size_t n) { fast_sincos_batch(d->fout, d->fout + BENCH_MAX_BATCH, d->angle, n); }
+static void bench_fast_rsqrt_batch(BenchData* d, size_t n) { fast_rsqrt_batch(d->fout, d->x, n); }
+static void bench_mat3x4_translate_rotate_Z_batch_fast(BenchData* d, size_t n)
+{
+    mat3x4_translate_rotate_Z_batch_fast(d->out3, d->x, d->y, d->z, d->angle, 0.5f, n);
+}
+static void bench_quat_mul_soa(BenchData* d, size_t n) { quat_mul_soa(d->sout, d->sp, d->sq, n); }
+static void bench_quat_nlerp_soa(BenchData* d, size_t n) { quat_nlerp_soa(d->sout, d->sp, d->sq, 0.3f, n); }
+static void bench_quat_slerp_soa(BenchData* d, size_t n) { quat_slerp_soa(d->sout, d->sp, d->sq, 0.3f, n); }
+static void bench_quat_to_mat4x4_soa(BenchData* d, size_t n) { quat_to_mat4x4_soa(d->out, d->sq, n); }
+static void bench_quat_to_mat3x4_soa(BenchData* d, size_t n) { quat_to_mat3x4_soa(d->out3, d->sq, d->x, d->y, d->z, n); }
+static void bench_quat_from_mat4x4_soa(BenchData* d, size_t n) { quat_from_mat4x4_soa(d->sout, d->b, n); }
+
+#define BENCH_ENTRY(name) { #name, bench_##name }
+#define BENCH_VEC_ENTRIES(n) \
+    BENCH_ENTRY(vec##n##_add), BENCH_ENTRY(vec##n##_sub), BENCH_ENTRY(vec##n##_scale), \
+    BENCH_ENTRY(vec##n##_mul_inner), BENCH_ENTRY(vec##n##_len), BENCH_ENTRY(vec##n##_norm), \
+    BENCH_ENTRY(vec##n##_min), BENCH_ENTRY(vec##n##_max), BENCH_ENTRY(vec##n##_dup)
+
+static const BenchOp bench_ops[] =
+{
+    BENCH_VEC_ENTRIES(2),
+    BENCH_VEC_ENTRIES(3),
+    BENCH_VEC_ENTRIES(4),
+    BENCH_ENTRY(vec3_mul_cross),
+    BENCH_ENTRY(vec3_reflect),
+    BENCH_ENTRY(vec4_mul_cross),
+    BENCH_ENTRY(vec4_reflect),
+    BENCH_ENTRY(mat4x4_identity),
+    BENCH_ENTRY(mat4x4_dup),
+    BENCH_ENTRY(mat4x4_row),
+    BENCH_ENTRY(mat4x4_col),
+    BENCH_ENTRY(mat4x4_transpose),
+    BENCH_ENTRY(mat4x4_add),
+    BENCH_ENTRY(mat4x4_sub),
+    BENCH_ENTRY(mat4x4_scale),
+    BENCH_ENTRY(mat4x4_scale_aniso),
+    BENCH_ENTRY(mat4x4_mul),
+    BENCH_ENTRY(mat4x4_mul_restrict),
+    BENCH_ENTRY(mat4x4_mul_straddled),
+    BENCH_ENTRY(mat4x4_mul_vec4),
+    BENCH_ENTRY(mat4x4_translate),
+    BENCH_ENTRY(mat4x4_translate_in_place),
+    BENCH_ENTRY(mat4x4_from_vec3_mul_outer),
+    BENCH_ENTRY(mat4x4_rotate),
+    BENCH_ENTRY(mat4x4_rotate_X),
+    BENCH_ENTRY(mat4x4_rotate_Y),
+    BENCH_ENTRY(mat4x4_rotate_Z),
+    BENCH_ENTRY(mat4x4_invert),
+    BENCH_ENTRY(mat4x4_orthonormalize),
+    BENCH_ENTRY(mat4x4_frustum),
+    BENCH_ENTRY(mat4x4_ortho),
+    BENCH_ENTRY(mat4x4_perspective),
+    BENCH_ENTRY(mat4x4_perspective_reversed),
+    BENCH_ENTRY(mat4x4_perspective_reversed_infinite),
+    BENCH_ENTRY(mat4x4_ortho_reversed),
+    BENCH_ENTRY(mat4x4_frustum_invert),
+    BENCH_ENTRY(mat4x4_ortho_invert),
+    BENCH_ENTRY(mat4x4_look_at),
+    BENCH_ENTRY(mat4x4_from_quat),
+    BENCH_ENTRY(mat4x4o_mul_quat),
+    BENCH_ENTRY(mat4x4_arcball),
+    BENCH_ENTRY(mat3x4_mul),
+    BENCH_ENTRY(mat3x4_invert),
+    BENCH_ENTRY(mat3x4_mul_vec3),
+    BENCH_ENTRY(mat3x4_from_mat4x4),
+    BENCH_ENTRY(dmat4x4_mul),
+    BENCH_ENTRY(dmat4x4_mul_dvec4),
+    BENCH_ENTRY(dmat4x4_translate_in_place),
+    BENCH_ENTRY(mat4x4_from_dmat4x4_relative),
+    BENCH_ENTRY(vec3_from_dvec3_sub),
+    BENCH_ENTRY(quat_identity),
+    BENCH_ENTRY(quat_mul),
+    BENCH_ENTRY(quat_conj),
+    BENCH_ENTRY(quat_rotate),
+    BENCH_ENTRY(quat_mul_vec3),
+    BENCH_ENTRY(quat_from_mat4x4),
+    BENCH_ENTRY(quat_from_mat4x4_fast),
+    BENCH_ENTRY(quat_nlerp),
+    BENCH_ENTRY(quat_slerp),
+    BENCH_ENTRY(quat_to_mat3x4),
+    BENCH_ENTRY(trs_mul),
+    BENCH_ENTRY(trs_invert),
+    BENCH_ENTRY(trs_lerp),
+    BENCH_ENTRY(trs_mul_vec3),
+    BENCH_ENTRY(trs_to_mat4x4),
+    BENCH_ENTRY(trs_mul_to_mat4x4),
+    BENCH_ENTRY(cpp_mat4_mul),
+    BENCH_ENTRY(cpp_mat4_mul_vec4),
+    BENCH_ENTRY(cpp_mat4_invert),
+    BENCH_ENTRY(cpp_quat_mul),
+    BENCH_ENTRY(cpp_vec4_mul_add),
+    BENCH_ENTRY(mat4x4_mul_batch),
+    BENCH_ENTRY(mat4x4_rotate_Z_batch),
+    BENCH_ENTRY(mat4x4_mul_vec4_batch),
+    BENCH_ENTRY(mat4x4_transform_soa),
+    BENCH_ENTRY(mat4x4_translate_rotate_Z_batch),
+    BENCH_ENTRY(mat4x4_mul_translate_rotate_Z_batch),
+    BENCH_ENTRY(mat4x4_translate_rotate_Z_then_mul_batch),
+    BENCH_ENTRY(mat3x4_translate_rotate_Z_batch),
+    BENCH_ENTRY(mat3x4_transform_aabb),
+    BENCH_ENTRY(mat3x4_transform_aabb_soa),
+    BENCH_ENTRY(mat3x4_transform_sphere_soa),
+    BENCH_ENTRY(planes_test_spheres8),
+    BENCH_ENTRY(planes_test_aabbs8),
+    BENCH_ENTRY(fast_sincos_batch),
+    BENCH_ENTRY(fast_rsqrt_batch),
+    BENCH_ENTRY(mat3x4_translate_rotate_Z_batch_fast),
+    BENCH_ENTRY(quat_mul_soa),
+    BENCH_ENTRY(quat_nlerp_soa),
+    BENCH_ENTRY(quat_slerp_soa),
+    BENCH_ENTRY(quat_to_mat4x4_soa),
+    BENCH_ENTRY(quat_to_mat3x4_soa),
+    BENCH_ENTRY(quat_from_mat4x4_soa),
+};
+
+static const char* simd_backend_name()
+{
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+    return "avx";
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2
+    return "sse2";
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+static bool simd_fma()
+{
+#if defined(LINMATH_H_SIMD_FMA)
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void* bench_alloc(size_t size)
+{
+    return linmath_aligned_alloc(size, LINMATH_CACHE_LINE);
+}
+
+static void bench_free(void* p)
+{
+    linmath_aligned_free(p);
+}
+
+static float frand(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(*state >> 8) / 16777216.f;    // [0, 1)
+}
+
+static void bench_data_init(BenchData* d)
+{
+    const size_t n = BENCH_MAX_BATCH;
+    d->a = mat4x4a_alloc(n);
+    d->b = mat4x4a_alloc(n);
+    d->out = mat4x4a_alloc(n);
+    d->straddled = (mat4x4*)((char*)bench_alloc(sizeof(mat4x4) * n + LINMATH_CACHE_LINE) + 16);
+    d->a3 = (mat3x4*)bench_alloc(sizeof(mat3x4) * n);
+    d->b3 = (mat3x4*)bench_alloc(sizeof(mat3x4) * n);
+    d->out3 = (mat3x4*)bench_alloc(sizeof(mat3x4) * n);
+    d->u = vec4a_alloc(n);
+    d->v = vec4a_alloc(n);
+    d->vout = vec4a_alloc(n);
+    d->p = (quat*)bench_alloc(sizeof(quat) * n);
+    d->q = (quat*)bench_alloc(sizeof(quat) * n);
+    quat_soa* soas[3] = { &d->sp, &d->sq, &d->sout };
+    for (int k = 0; k < 3; ++k)
+    {
+        soas[k]->x = (float*)bench_alloc(sizeof(float) * n * 4);
+        soas[k]->y = soas[k]->x + n;
+        soas[k]->z = soas[k]->y + n;
+        soas[k]->w = soas[k]->z + n;
+    }
+    d->ta = (trs*)bench_alloc(sizeof(trs) * n);
+    d->tb = (trs*)bench_alloc(sizeof(trs) * n);
+    d->tout = (trs*)bench_alloc(sizeof(trs) * n);
+    d->angle = (float*)bench_alloc(sizeof(float) * n);
+    d->x = (float*)bench_alloc(sizeof(float) * n);
+    d->y = (float*)bench_alloc(sizeof(float) * n);
+    d->z = (float*)bench_alloc(sizeof(float) * n);
+    d->fout = (float*)bench_alloc(sizeof(float) * n * 3);
+    d->extent = (float*)bench_alloc(sizeof(float) * n * 3);
+    d->bounds_out = (float*)bench_alloc(sizeof(float) * n * 6);
+    d->da = (dmat4x4*)bench_alloc(sizeof(dmat4x4) * n);
+    d->db = (dmat4x4*)bench_alloc(sizeof(dmat4x4) * n);
+    d->dout = (dmat4x4*)bench_alloc(sizeof(dmat4x4) * n);
+    d->du = (dvec4*)bench_alloc(sizeof(dvec4) * n);
+    d->dv = (dvec4*)bench_alloc(sizeof(dvec4) * n);
+    d->dvout = (dvec4*)bench_alloc(sizeof(dvec4) * n);
+
+    unsigned int seed = 12345u;
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            d->u[i][k] = frand(&seed) * 2.f - 1.f;
+            d->v[i][k] = frand(&seed) * 2.f - 1.f + 4.f;    // never equal to u (look_at, reflect)
+        }
+        d->angle[i] = frand(&seed) * 6.2831853f;
+        d->x[i] = frand(&seed) + 0.5f;
+        d->y[i] = frand(&seed) + 0.5f;
+        d->z[i] = frand(&seed) + 0.5f;
+        for (int k = 0; k < 3; ++k)
+            d->extent[k * n + i] = frand(&seed) * 0.25f + 0.01f;
+
+        // Rotation + translation + scale: invertible and well-conditioned
+        mat4x4 r;
+        mat4x4_identity(r);
+        mat4x4_rotate(d->a[i], r, d->u[i][0], d->u[i][1], d->u[i][2] + 2.f, d->angle[i]);
+        mat4x4_scale_aniso(d->a[i], d->a[i], d->x[i], d->y[i], d->z[i]);
+        mat4x4_translate_in_place(d->a[i], d->u[i][0], d->u[i][1], d->u[i][2]);
+        mat4x4_rotate(d->b[i], r, d->v[i][0], d->v[i][1], d->v[i][2], d->angle[i] * 0.5f);
+        mat3x4_from_mat4x4(d->a3[i], d->a[i]);
+        mat3x4_from_mat4x4(d->b3[i], d->b[i]);
+
+        vec3 axis = { d->u[i][0], d->u[i][1], d->u[i][2] + 2.f };
+        vec3_norm(axis, axis);
+        quat_rotate(d->p[i], d->angle[i], axis);
+        quat_rotate(d->q[i], d->angle[i] * 0.3f, axis);
+        d->sp.x[i] = d->p[i][0]; d->sp.y[i] = d->p[i][1]; d->sp.z[i] = d->p[i][2]; d->sp.w[i] = d->p[i][3];
+        d->sq.x[i] = d->q[i][0]; d->sq.y[i] = d->q[i][1]; d->sq.z[i] = d->q[i][2]; d->sq.w[i] = d->q[i][3];
+
+        memcpy(d->ta[i].t, d->u[i], sizeof(vec3));
+        memcpy(d->ta[i].r, d->p[i], sizeof(quat));
+        d->ta[i].s[0] = d->x[i]; d->ta[i].s[1] = d->y[i]; d->ta[i].s[2] = d->z[i];
+        memcpy(d->tb[i].t, d->v[i], sizeof(vec3));
+        memcpy(d->tb[i].r, d->q[i], sizeof(quat));
+        d->tb[i].s[0] = d->tb[i].s[1] = d->tb[i].s[2] = d->x[i];
+
+        dmat4x4_from_mat4x4(d->da[i], d->a[i]);
+        dmat4x4_from_mat4x4(d->db[i], d->b[i]);
+        for (int k = 0; k < 4; ++k)
+        {
+            d->du[i][k] = d->u[i][k] + (k < 3 ? 1e7 : 0.0);
+            d->dv[i][k] = d->v[i][k] + (k < 3 ? 1e7 : 0.0);
+        }
+        d->da[i][3][0] += 1e7;
+        d->db[i][3][1] += 1e7;
+    }
+    memcpy(d->straddled, d->b, sizeof(mat4x4) * n);
+    for (int p = 0; p < 6; ++p)
+    {
+        // Normals about the centres' mean (1, 1, 1), so each plane has bounds on both sides
+        vec3 normal = { frand(&seed) - 0.5f, frand(&seed) - 0.5f, frand(&seed) - 0.5f };
+        vec3_norm(normal, normal);
+        memcpy(d->planes[p], normal, sizeof(vec3));
+        d->planes[p][3] = 0.4f - (normal[0] + normal[1] + normal[2]);
+    }
+    mat4x4_dup(d->out[0], d->a[0]);
+    d->vout[0][0] = 0.f; d->vout[0][1] = 0.f; d->vout[0][2] = 1.f; d->vout[0][3] = 0.f;   // look_at up vector
+}
+
+static void bench_data_free(BenchData* d)
+{
+    bench_free(d->a); bench_free(d->b); bench_free(d->out); bench_free((char*)d->straddled - 16);
+    bench_free(d->a3); bench_free(d->b3); bench_free(d->out3);
+    bench_free(d->u); bench_free(d->v); bench_free(d->vout);
+    bench_free(d->p); bench_free(d->q);
+    bench_free(d->sp.x); bench_free(d->sq.x); bench_free(d->sout.x);
+    bench_free(d->ta); bench_free(d->tb); bench_free(d->tout);
+    bench_free(d->angle); bench_free(d->x); bench_free(d->y); bench_free(d->z); bench_free(d->fout);
+    bench_free(d->extent); bench_free(d->bounds_out);
+    bench_free(d->da); bench_free(d->db); bench_free(d->dout);
+    bench_free(d->du); bench_free(d->dv); bench_free(d->dvout);
+}
+
+// Runs "op" over "batch" elements, doubling the repetitions until at least min_seconds have passed
+static double bench_run(const BenchOp* op, BenchData* d, size_t batch, double min_seconds)
+{
+    typedef std::chrono::steady_clock clock;
+    op->function(d, batch);     // warm caches and branch predictors
+    BENCH_CLOBBER();
+    for (size_t reps = 1;; reps *= 2)
+    {
+        const clock::time_point start = clock::now();
+        for (size_t r = 0; r < reps; ++r)
+        {
+            op->function(d, batch);
+            BENCH_CLOBBER();    // the compiler must assume every rep's results are read
+        }
+        const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        if (seconds >= min_seconds)
+            return seconds * 1e9 / ((double)reps * (double)batch);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool json = false;
+    const char* filter = NULL;
+    double min_seconds = 0.02;
+    size_t batches[16] = { 1, 16, 256, 4096, 65536 };
+    int batch_count = 5;
+    bool custom_batches = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--json"))
+            json = true;
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+            filter = argv[++i];
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+            min_seconds = atof(argv[++i]) * 1e-3;
+        else if (!strcmp(argv[i], "--batch") && i + 1 < argc)
+        {
+            if (!custom_batches)
+                batch_count = 0;
+            custom_batches = true;
+            const long n = atol(argv[++i]);
+            if (n < 1 || n > BENCH_MAX_BATCH || batch_count == 16)
+            {
+                fprintf(stderr, "linmath_bench: --batch must be 1..%d (at most 16 of them)\n", BENCH_MAX_BATCH);
+                return EXIT_FAILURE;
+            }
+            batches[batch_count++] = (size_t)n;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--json] [--filter SUBSTRING] [--min-time MS] [--batch N]...\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    BenchData data;
+    bench_data_init(&data);
+
+    if (json)
+        printf("{\n  \"simd\": \"%s\",\n  \"fma\": %s,\n  \"results\": [", simd_backend_name(), simd_fma() ? "true" : "false");
+    else
+    {
+        printf("linmath_bench: backend %s%s\n", simd_backend_name(), simd_fma() ? "+fma" : "");
+        printf("%-44s", "op (ns/op)");
+        for (int b = 0; b < batch_count; ++b)
+            printf(" %9zu", batches[b]);
+        printf("\n");
+    }
+
+    bool first = true;
+    for (size_t o = 0; o < sizeof(bench_ops) / sizeof(bench_ops[0]); ++o)
+    {
+        const BenchOp* op = &bench_ops[o];
+        if (filter && !strstr(op->name, filter))
+            continue;
+        if (!json)
+            printf("%-44s", op->name);
+        for (int b = 0; b < batch_count; ++b)
+        {
+            const double ns = bench_run(op, &data, batches[b], min_seconds);
+            if (json)
+            {
+                printf("%s\n    { \"op\": \"%s\", \"batch\": %zu, \"ns_per_op\": %.4f }", first ? "" : ",", op->name, batches[b], ns);
+                first = false;
+            }
+            else
+                printf(" %9.3f", ns);
+        }
+        if (!json)
+            printf("\n");
+        fflush(stdout);
+    }
+    if (json)
+        printf("\n  ]\n}\n");
+
+    bench_data_free(&data);
+    return EXIT_SUCCESS;
+}
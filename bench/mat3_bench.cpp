@@ -0,0 +1,289 @@
+// 3x3 matrix check: linmath_mat3.h's normal matrices against the inverse transpose in double, the uniform-scale
+// shortcut against the general one on the matrices it's meant for, trs_from_mat4x4 against the trs the matrices
+// were built from (mirrored ones included), and every batch against its one-at-a-time function. Then the normal
+// matrices are timed against mat4x4_invert + mat4x4_transpose, and the decomposition per matrix. Build the scalar
+// variant (LINMATH_NO_SIMD) to check the fallback code as well.
+//
+// Usage: mat3_bench [elements] [reps]
+
+#include "linmath_mat3.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define NORMAL_BOUND 2e-6           // relative to the largest element of the exact inverse transpose
+#define KERNEL_BOUND 1e-6           // the batches against the one-at-a-time functions
+#define TRS_BOUND 2e-5              // translation, rotation and scale back from the matrix, relative to the scale
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static float frand(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(*state >> 8) / 16777216.f;    // [0, 1)
+}
+
+static bool report(const char* what, double worst, double bound)
+{
+    const bool ok = worst <= bound;
+    printf("  %-44s %10.3g  (bound %.3g)  %s\n", what, worst, bound, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// A random transform: any rotation, translation within 100, scale 0.1-10 per axis or the same on all three,
+// every fourth non-uniform one mirrored along x
+static void random_trs(trs* a, bool uniform, size_t i, unsigned int* state)
+{
+    vec3 axis = { frand(state) - .5f, frand(state) - .5f, frand(state) - .5f };
+    axis[2] += axis[2] < 0.f ? -.1f : .1f;
+    quat_rotate(a->r, frand(state) * 6.2831853f, axis);
+    quat_norm(a->r, a->r);
+    for (int k = 0; k < 3; ++k)
+    {
+        a->t[k] = 200.f * frand(state) - 100.f;
+        a->s[k] = powf(10.f, 2.f * frand(state) - 1.f);
+    }
+    if (uniform)
+        a->s[1] = a->s[2] = a->s[0];
+    else if (i % 4 == 3)
+        a->s[0] = -a->s[0];
+}
+
+// Largest difference between a and b over the largest element of a's exact counterpart "scale"
+static double mat3_distance(mat3x3 const a, mat3x3 const b, double scale)
+{
+    double d = 0.;
+    for (int c = 0; c < 3; ++c)
+        for (int r = 0; r < 3; ++r)
+            d = fmax(d, fabs((double)a[c][r] - (double)b[c][r]) / scale);
+    return d;
+}
+
+// The inverse transpose of M's 3x3 in double, and its largest element
+static double exact_normal(double N[3][3], mat4x4 const M)
+{
+    double m[3][3];
+    for (int c = 0; c < 3; ++c)
+        for (int r = 0; r < 3; ++r)
+            m[c][r] = M[c][r];
+    const double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+        - m[1][0] * (m[0][1] * m[2][2] - m[0][2] * m[2][1]) + m[2][0] * (m[0][1] * m[1][2] - m[0][2] * m[1][1]);
+    double largest = 0.;
+    for (int c = 0; c < 3; ++c)
+        for (int r = 0; r < 3; ++r)
+        {
+            // The cofactor of element (column c, row r), which is the inverse's (r, c) entry times det
+            const int c1 = (c + 1) % 3, c2 = (c + 2) % 3, r1 = (r + 1) % 3, r2 = (r + 2) % 3;
+            N[c][r] = (m[c1][r1] * m[c2][r2] - m[c1][r2] * m[c2][r1]) / det;
+            largest = fmax(largest, fabs(N[c][r]));
+        }
+    return largest;
+}
+
+static bool check(unsigned int* state)
+{
+    const size_t n = 4099;     // a scalar tail after the four-wide loop
+    std::vector<mat4x4> general(n), uniform(n);
+    std::vector<trs> source(n), back(n);
+    std::vector<mat3x3> N(n), Nb(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        random_trs(&source[i], false, i, state);
+        trs_to_mat4x4(general[i], &source[i]);
+        trs u;
+        random_trs(&u, true, i, state);
+        trs_to_mat4x4(uniform[i], &u);
+    }
+
+    // General matrices: the cofactor form and its batch against double, then against each other
+    double normal = 0., normal_batch = 0., via_invert = 0.;
+    mat3x3_normal_batch(Nb.data(), general.data(), n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        double exact[3][3];
+        const double scale = exact_normal(exact, general[i]);
+        mat4x4 inverse, transposed;
+        mat4x4_invert(inverse, general[i]);
+        mat4x4_transpose(transposed, inverse);
+        mat3x3_normal(N[i], general[i]);
+        for (int c = 0; c < 3; ++c)
+            for (int r = 0; r < 3; ++r)
+            {
+                normal = fmax(normal, fabs(N[i][c][r] - exact[c][r]) / scale);
+                via_invert = fmax(via_invert, fabs(transposed[c][r] - exact[c][r]) / scale);
+            }
+        normal_batch = fmax(normal_batch, mat3_distance(Nb[i], N[i], scale));
+    }
+
+    // Rotation and uniform scale: the shortcut against the general form
+    double shortcut = 0., shortcut_batch = 0.;
+    mat3x3_normal_uniform_batch(Nb.data(), uniform.data(), n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        double exact[3][3];
+        const double scale = exact_normal(exact, uniform[i]);
+        mat3x3 general_form, fast;
+        mat3x3_normal(general_form, uniform[i]);
+        mat3x3_normal_uniform(fast, uniform[i]);
+        shortcut = fmax(shortcut, mat3_distance(fast, general_form, scale));
+        shortcut_batch = fmax(shortcut_batch, mat3_distance(Nb[i], fast, scale));
+    }
+
+    // Decomposition: back to the trs each matrix came from, the rotation up to sign
+    double decompose = 0., decompose_batch = 0.;
+    trs_from_mat4x4_batch(back.data(), general.data(), n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        trs one;
+        trs_from_mat4x4(&one, general[i]);
+        const trs* a = &source[i];
+        const float scale = fmaxf(fabsf(a->s[0]), fmaxf(fabsf(a->s[1]), fabsf(a->s[2])));
+        const float sign = quat_mul_inner(one.r, a->r) < 0.f ? -1.f : 1.f;
+        const float sign_batch = quat_mul_inner(back[i].r, a->r) < 0.f ? -1.f : 1.f;
+        for (int k = 0; k < 3; ++k)
+        {
+            decompose = fmax(decompose, fabs(one.t[k] - a->t[k]) / fmax(1., fabs(a->t[k])));
+            decompose = fmax(decompose, fabs(one.s[k] - a->s[k]) / scale);
+            decompose_batch = fmax(decompose_batch, fabs(back[i].t[k] - one.t[k]) / fmax(1., fabs(a->t[k])));
+            decompose_batch = fmax(decompose_batch, fabs(back[i].s[k] - one.s[k]) / scale);
+        }
+        for (int k = 0; k < 4; ++k)
+        {
+            decompose = fmax(decompose, fabs(one.r[k] * sign - a->r[k]));
+            decompose_batch = fmax(decompose_batch, fabs(back[i].r[k] * sign_batch - a->r[k]));
+        }
+    }
+
+    // The 3x3 basics: M * M^-1 and (a * b)^T = b^T * a^T
+    double basics = 0.;
+    for (size_t i = 0; i + 1 < n; i += 97)
+    {
+        mat3x3 m, inverse, product, a, b, ab, abt, bt, at, btat;
+        mat3x3_from_mat4x4(m, general[i]);
+        mat3x3_invert(inverse, m);
+        mat3x3_mul(product, m, inverse);
+        for (int c = 0; c < 3; ++c)
+            for (int r = 0; r < 3; ++r)
+                basics = fmax(basics, fabs(product[c][r] - (c == r ? 1.f : 0.f)));
+        mat3x3_normal(a, general[i]);
+        mat3x3_from_mat4x4(b, general[i + 1]);
+        mat3x3_mul(ab, a, b);
+        mat3x3_transpose(abt, ab);
+        mat3x3_transpose(bt, b);
+        mat3x3_transpose(at, a);
+        mat3x3_mul(btat, bt, at);
+        basics = fmax(basics, mat3_distance(abt, btat, 1e3));
+    }
+
+    bool ok = report("mat3x3_normal vs exact", normal, NORMAL_BOUND);
+    ok = report("mat3x3_normal_batch vs mat3x3_normal", normal_batch, KERNEL_BOUND) && ok;
+    ok = report("mat3x3_normal_uniform vs mat3x3_normal", shortcut, NORMAL_BOUND) && ok;
+    ok = report("mat3x3_normal_uniform_batch vs one at a time", shortcut_batch, KERNEL_BOUND) && ok;
+    ok = report("trs_from_mat4x4 vs the trs it came from", decompose, TRS_BOUND) && ok;
+    ok = report("trs_from_mat4x4_batch vs trs_from_mat4x4", decompose_batch, TRS_BOUND) && ok;
+    ok = report("mat3x3 invert, mul and transpose", basics, 1e-4) && ok;
+    printf("  %-44s %10.3g  (linmath.h, for comparison)\n", "mat4x4_invert + mat4x4_transpose vs exact", via_invert);
+    return ok;
+}
+
+typedef struct TimingData
+{
+    std::vector<mat4x4> m, inverse;
+    std::vector<mat3x3> normal;
+    std::vector<trs> parts;
+
+    explicit TimingData(size_t n) : m(n), inverse(n), normal(n), parts(n) {}
+} TimingData;
+
+static double time_ns(void (*body)(TimingData*), TimingData* d, int reps)
+{
+    body(d);    // warm up
+    const double start = now_ms();
+    for (int r = 0; r < reps; ++r)
+        body(d);
+    return (now_ms() - start) * 1e6 / ((double)reps * (double)d->m.size());
+}
+
+// The normal matrix the way it's done without mat3x3: the full 4x4 inverse, transposed
+static void loop_invert_transpose(TimingData* d)
+{
+    for (size_t i = 0; i < d->m.size(); ++i)
+    {
+        mat4x4 inverse;
+        mat4x4_invert(inverse, d->m[i]);
+        mat4x4_transpose(d->inverse[i], inverse);
+    }
+}
+static void loop_normal(TimingData* d)
+{
+    for (size_t i = 0; i < d->m.size(); ++i)
+        mat3x3_normal(d->normal[i], d->m[i]);
+}
+static void batch_normal(TimingData* d) { mat3x3_normal_batch(d->normal.data(), d->m.data(), d->m.size()); }
+static void loop_normal_uniform(TimingData* d)
+{
+    for (size_t i = 0; i < d->m.size(); ++i)
+        mat3x3_normal_uniform(d->normal[i], d->m[i]);
+}
+static void batch_normal_uniform(TimingData* d)
+{
+    mat3x3_normal_uniform_batch(d->normal.data(), d->m.data(), d->m.size());
+}
+static void loop_decompose(TimingData* d)
+{
+    for (size_t i = 0; i < d->m.size(); ++i)
+        trs_from_mat4x4(&d->parts[i], d->m[i]);
+}
+static void batch_decompose(TimingData* d) { trs_from_mat4x4_batch(d->parts.data(), d->m.data(), d->m.size()); }
+
+int main(int argc, char** argv)
+{
+    const size_t elements = argc > 1 ? (size_t)atol(argv[1]) : 4096;
+    const int reps = argc > 2 ? atoi(argv[2]) : 2000;
+    if (elements == 0 || reps <= 0)
+    {
+        fprintf(stderr, "usage: %s [elements] [reps]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("accuracy (%s)\n", LINMATH_H_SIMD == LINMATH_H_SIMD_NONE ? "scalar" : "simd");
+    unsigned int state = 12345u;
+    bool ok = check(&state);
+
+    TimingData d(elements);
+    for (size_t i = 0; i < elements; ++i)
+    {
+        trs a;
+        random_trs(&a, true, i, &state);
+        trs_to_mat4x4(d.m[i], &a);
+    }
+    const double reference = time_ns(loop_invert_transpose, &d, reps);
+    const struct
+    {
+        const char* name;
+        void (*loop)(TimingData*);
+        void (*batch)(TimingData*);
+    } kernels[] =
+    {
+        { "normal matrix", loop_normal, batch_normal },
+        { "normal matrix, uniform scale", loop_normal_uniform, batch_normal_uniform },
+        { "trs_from_mat4x4", loop_decompose, batch_decompose },
+    };
+    printf("ns per matrix over %zu, %d reps (mat4x4_invert + mat4x4_transpose: %.2f ns)\n", elements, reps, reference);
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+    {
+        const double loop = time_ns(kernels[k].loop, &d, reps);
+        const double batch = time_ns(kernels[k].batch, &d, reps);
+        printf("  %-30s %8.2f one at a time %8.2f batch  (%.0f%% of invert + transpose)\n", kernels[k].name, loop,
+            batch, 100. * batch / reference);
+    }
+
+    printf("%s\n", ok ? "mat3_bench: ok" : "mat3_bench: FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,276 @@
+// Deterministic math golden check (LINMATH_DETERMINISTIC in linmath.h): runs a fixed set of linmath functions on
+// fixed inputs and hashes every result's bits against hashes recorded once. Any build in deterministic mode, on any
+// compiler, SIMD backend or optimization level, has to reproduce them exactly. Exact zeros hash without their sign,
+// which the SIMD paths don't keep (linmath.h). A mismatch names the function that drifted.
+//
+// Usage: math_golden_bench [--print]      --print lists the hashes of this build, to record new goldens
+
+#include "linmath.h"
+#include "linmath_affine.h"
+#include "linmath_batch.h"
+#include "linmath_fast.h"
+#include "linmath_quat.h"
+#include "linmath_trs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef LINMATH_DETERMINISTIC
+#error "math_golden_bench checks LINMATH_DETERMINISTIC builds"
+#endif
+
+#define GOLDEN_COUNT 256    // inputs per function; a multiple of the widest SIMD path
+
+typedef struct Golden
+{
+    const char* name;
+    uint64_t hash;
+} Golden;
+
+// Recorded from GCC 12 -O2 -ffp-contract=off with LINMATH_NO_SIMD; SSE2, AVX2 + FMA, -O0 and -O3 give the same
+static const Golden goldens[] = {
+    { "linmath_sincosf", 0x7842da5dabd0481eull },
+    { "linmath_tanf", 0xf6727fe67f1dbb75ull },
+    { "linmath_acosf", 0xd6662e04d24a23b9ull },
+    { "mat4x4_rotate", 0x63fe7002a621d731ull },
+    { "mat4x4_invert", 0xd1f9c960f5fd2df2ull },
+    { "mat4x4_mul", 0x742db698a7532bc3ull },
+    { "mat4x4_mul_vec4", 0x098c2d6b7f92d113ull },
+    { "mat4x4_perspective", 0xefd026961dccd403ull },
+    { "mat4x4_look_at", 0x155618802f3ef19full },
+    { "mat4x4_arcball", 0x70fe1c87890cf39full },
+    { "quat_rotate", 0xff2e14bff7a3679dull },
+    { "quat_mul", 0xff3ed42a833aabcaull },
+    { "quat_mul_vec3", 0x8e75662a94050f41ull },
+    { "mat4x4_from_quat", 0x9e8863e31ac8b844ull },
+    { "mat3x4_invert", 0x9b7861fcb1c7bfc3ull },
+    { "trs_mul", 0x730dbd59eed44facull },
+    { "trs_to_mat4x4", 0x5970b4ebc6f5902full },
+    { "trs_invert", 0x8ff60d892806269aull },
+    { "trs_lerp", 0x85476ba65937a50dull },
+    { "quat_slerp", 0x7f3e7f476f21bd70ull },
+    { "mat4x4_mul_batch", 0x175636788f14a36dull },
+    { "mat4x4_rotate_Z_batch", 0x1231d2675f5a12ffull },
+    { "mat4x4_translate_rotate_Z_batch", 0x2c0a8b3fdb8498a6ull },
+    { "fast_sincos_batch", 0xa1d3eeb9840217caull },
+    { "fast_rsqrt_batch", 0x099900ef742ab721ull },
+    { "mat3x4_translate_rotate_Z_batch_fast", 0xe89fd57f9907057eull },
+};
+
+static uint64_t fnv1a(uint64_t hash, const float* values, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        if (bits == 0x80000000u)
+            bits = 0;
+        for (int b = 0; b < 4; ++b)
+        {
+            hash ^= (bits >> (8 * b)) & 0xFFu;
+            hash *= 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+#define FNV_OFFSET 0xcbf29ce484222325ull
+
+// Inputs from integers, so they are the same bits everywhere: [lo, hi) in steps of (hi - lo) / 2^24
+static float input(uint32_t* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) * (1.f / 16777216.f);
+}
+
+static void random_model(uint32_t* state, mat4x4 M)
+{
+    mat4x4 identity;
+    mat4x4_identity(identity);
+    mat4x4_rotate(M, identity, input(state, -1.f, 1.f), input(state, -1.f, 1.f), input(state, 0.1f, 1.f),
+        input(state, -4.f, 4.f));
+    mat4x4_scale_aniso(M, M, input(state, 0.5f, 2.f), input(state, 0.5f, 2.f), input(state, 0.5f, 2.f));
+    M[3][0] = input(state, -100.f, 100.f);
+    M[3][1] = input(state, -100.f, 100.f);
+    M[3][2] = input(state, -100.f, 100.f);
+}
+
+static void random_quat(uint32_t* state, quat q)
+{
+    vec3 axis = { input(state, -1.f, 1.f), input(state, -1.f, 1.f), input(state, 0.1f, 1.f) };
+    quat_rotate(q, input(state, -6.f, 6.f), axis);
+}
+
+typedef struct Inputs
+{
+    mat4x4 a[GOLDEN_COUNT];
+    mat4x4 b[GOLDEN_COUNT];
+    quat p[GOLDEN_COUNT];
+    quat q[GOLDEN_COUNT];
+    vec4 v[GOLDEN_COUNT];
+    float x[GOLDEN_COUNT];
+    float y[GOLDEN_COUNT];
+    float angle[GOLDEN_COUNT];
+    float wide[GOLDEN_COUNT];   // angles out to +-1000 radians
+} Inputs;
+
+// The hash of one function's results over every input, in goldens[] order
+static uint64_t run(int which, const Inputs* in, mat4x4* out, mat3x4* out3, float* f)
+{
+    uint64_t h = FNV_OFFSET;
+    const size_t n = GOLDEN_COUNT;
+    for (size_t i = 0; i < n; ++i)
+    {
+        float r[16];
+        switch (which)
+        {
+        case 0: linmath_sincosf(in->wide[i], &r[0], &r[1]); h = fnv1a(h, r, 2); break;
+        case 1: r[0] = linmath_tanf(in->angle[i] * 0.24f); h = fnv1a(h, r, 1); break;
+        case 2: r[0] = linmath_acosf(in->x[i] - 1.f); h = fnv1a(h, r, 1); break;
+        case 3:
+            mat4x4_rotate(out[i], in->a[i], in->v[i][0], in->v[i][1], in->v[i][2], in->wide[i]);
+            h = fnv1a(h, out[i][0], 16);
+            break;
+        case 4: mat4x4_invert(out[i], in->a[i]); h = fnv1a(h, out[i][0], 16); break;
+        case 5: mat4x4_mul(out[i], in->a[i], in->b[i]); h = fnv1a(h, out[i][0], 16); break;
+        case 6: mat4x4_mul_vec4(r, in->a[i], in->v[i]); h = fnv1a(h, r, 4); break;
+        case 7:
+            mat4x4_perspective(out[i], in->angle[i] * 0.24f + 0.2f, in->x[i] + 0.5f, 0.1f, 100.f + in->y[i]);
+            h = fnv1a(h, out[i][0], 16);
+            break;
+        case 8:
+        {
+            const vec3 eye = { in->v[i][0] * 10.f, in->v[i][1] * 10.f, in->v[i][2] * 10.f };
+            const vec3 center = { in->x[i], in->y[i], -5.f };
+            const vec3 up = { 0.f, 1.f, 0.f };
+            mat4x4_look_at(out[i], eye, center, up);
+            h = fnv1a(h, out[i][0], 16);
+            break;
+        }
+        case 9:
+        {
+            const vec2 from = { in->x[i] - 1.f, in->y[i] - 1.f }, to = { in->y[i] - 1.f, 1.f - in->x[i] };
+            mat4x4_arcball(out[i], in->a[i], from, to, 1.f);
+            h = fnv1a(h, out[i][0], 16);
+            break;
+        }
+        case 10:
+        {
+            const vec3 axis = { in->v[i][0], in->v[i][1], in->v[i][2] };
+            quat_rotate(r, in->wide[i], axis);
+            h = fnv1a(h, r, 4);
+            break;
+        }
+        case 11: quat_mul(r, in->p[i], in->q[i]); h = fnv1a(h, r, 4); break;
+        case 12: quat_mul_vec3(r, in->p[i], in->v[i]); h = fnv1a(h, r, 3); break;
+        case 13: mat4x4_from_quat(out[i], in->p[i]); h = fnv1a(h, out[i][0], 16); break;
+        case 14:
+            mat3x4_from_mat4x4(out3[i], in->a[i]);
+            mat3x4_invert(out3[i], out3[i]);
+            h = fnv1a(h, out3[i][0], 12);
+            break;
+        case 15:
+        case 16:
+        case 17:
+        case 18:
+        {
+            trs a, b, t;
+            memcpy(a.t, in->v[i], sizeof(vec3));
+            memcpy(a.r, in->p[i], sizeof(quat));
+            a.s[0] = a.s[1] = a.s[2] = in->x[i] + 0.5f;
+            memcpy(b.t, in->b[i][3], sizeof(vec3));
+            memcpy(b.r, in->q[i], sizeof(quat));
+            b.s[0] = b.s[1] = b.s[2] = in->y[i] + 0.5f;
+            if (which == 15)
+            {
+                trs_mul(&t, &a, &b);
+                h = fnv1a(h, t.t, 3);
+                h = fnv1a(h, t.r, 4);
+                h = fnv1a(h, t.s, 3);
+            }
+            else if (which == 16)
+            {
+                trs_to_mat4x4(out[i], &a);
+                h = fnv1a(h, out[i][0], 16);
+            }
+            else
+            {
+                if (which == 17)
+                    trs_invert(&t, &a);
+                else
+                    trs_lerp(&t, &a, &b, in->x[i] * 0.5f);
+                h = fnv1a(h, t.t, 3);
+                h = fnv1a(h, t.r, 4);
+                h = fnv1a(h, t.s, 3);
+            }
+            break;
+        }
+        case 19: quat_slerp(r, in->p[i], in->q[i], in->x[i] * 0.5f); h = fnv1a(h, r, 4); break;
+        default:
+            i = n;      // the batches below, once over every input
+            break;
+        }
+    }
+    switch (which)
+    {
+    case 20: mat4x4_mul_batch(out, in->a[0], in->b, n); return fnv1a(h, out[0][0], 16 * n);
+    case 21: mat4x4_rotate_Z_batch(out, in->a, in->wide, n); return fnv1a(h, out[0][0], 16 * n);
+    case 22: mat4x4_translate_rotate_Z_batch(out, in->x, in->y, NULL, in->wide, 0.5f, n); return fnv1a(h, out[0][0], 16 * n);
+    case 23: fast_sincos_batch(f, f + n, in->wide, n); return fnv1a(h, f, 2 * n);
+    case 24:
+        fast_rsqrt_batch(f, in->y, n);
+        return fnv1a(h, f, n);
+    case 25: mat3x4_translate_rotate_Z_batch_fast(out3, in->x, in->y, NULL, in->wide, 0.5f, n); return fnv1a(h, out3[0][0], 12 * n);
+    }
+    return h;
+}
+
+int main(int argc, char** argv)
+{
+    const bool print = argc > 1 && strcmp(argv[1], "--print") == 0;
+    const size_t n = GOLDEN_COUNT;
+    Inputs* in = (Inputs*)linmath_aligned_alloc(sizeof(Inputs), LINMATH_CACHE_LINE);
+    mat4x4* out = (mat4x4*)mat4x4a_alloc(n);
+    mat3x4* out3 = (mat3x4*)linmath_aligned_alloc(sizeof(mat3x4) * n, LINMATH_CACHE_LINE);
+    float* f = (float*)linmath_aligned_alloc(sizeof(float) * 2 * n, LINMATH_CACHE_LINE);
+
+    uint32_t state = 20240601u;
+    for (size_t i = 0; i < n; ++i)
+    {
+        random_model(&state, in->a[i]);
+        random_model(&state, in->b[i]);
+        random_quat(&state, in->p[i]);
+        random_quat(&state, in->q[i]);
+        for (int k = 0; k < 4; ++k)
+            in->v[i][k] = input(&state, -1.f, 1.f);
+        in->x[i] = input(&state, 0.f, 2.f);
+        in->y[i] = input(&state, 0.01f, 2.f);
+        in->angle[i] = input(&state, -6.f, 6.f);
+        in->wide[i] = input(&state, -1000.f, 1000.f);
+    }
+
+    const int count = (int)(sizeof(goldens) / sizeof(goldens[0]));
+    int failed = 0;
+    for (int k = 0; k < count; ++k)
+    {
+        const uint64_t hash = run(k, in, out, out3, f);
+        if (print)
+            printf("    { \"%s\", 0x%016llxull },\n", goldens[k].name, (unsigned long long)hash);
+        else if (hash != goldens[k].hash)
+        {
+            printf("  %-40s MISMATCH %016llx, golden %016llx\n", goldens[k].name, (unsigned long long)hash,
+                (unsigned long long)goldens[k].hash);
+            ++failed;
+        }
+    }
+    if (!print)
+        printf("%d of %d functions match their goldens\n", count - failed, count);
+
+    linmath_aligned_free(in);
+    linmath_aligned_free(out);
+    linmath_aligned_free(out3);
+    linmath_aligned_free(f);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
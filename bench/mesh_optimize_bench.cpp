@@ -0,0 +1,135 @@
+// Vertex cache / overdraw optimisation check: builds a UV sphere, shuffles its triangles (what an
+// unoptimised exporter tends to produce), then prints ACMR/ATVR for FIFO caches of 16 and 32 entries plus the
+// time each pass takes.
+//
+// Usage: mesh_optimize_bench [rings]
+
+#include "asset/mesh_optimize.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef struct BenchVertex
+{
+    float pos[3];
+    float uv[2];
+} BenchVertex;
+
+static void build_sphere(int rings, std::vector<BenchVertex>* vertices, std::vector<uint32_t>* indices)
+{
+    const int segments = rings * 2;
+    for (int r = 0; r <= rings; ++r)
+    {
+        const float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; ++s)
+        {
+            const float phi = 6.2831853f * s / segments;
+            BenchVertex v = { { sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi) },
+                { (float)s / segments, (float)r / rings } };
+            vertices->push_back(v);
+        }
+    }
+    for (int r = 0; r < rings; ++r)
+    {
+        for (int s = 0; s < segments; ++s)
+        {
+            const uint32_t a = r * (segments + 1) + s, b = a + segments + 1;
+            const uint32_t quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+            indices->insert(indices->end(), quad, quad + 6);
+        }
+    }
+}
+
+static void shuffle_triangles(std::vector<uint32_t>* indices)
+{
+    unsigned int state = 42u;
+    const size_t n = indices->size() / 3;
+    for (size_t i = n - 1; i > 0; --i)
+    {
+        state = state * 1664525u + 1013904223u;
+        const size_t j = state % (i + 1);
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t t = (*indices)[i * 3 + k];
+            (*indices)[i * 3 + k] = (*indices)[j * 3 + k];
+            (*indices)[j * 3 + k] = t;
+        }
+    }
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char* name, const std::vector<uint32_t>& indices, size_t vertex_count, double ms)
+{
+    const MeshCacheStats s16 = mesh_analyze_vertex_cache(indices.data(), indices.size(), vertex_count, 16);
+    const MeshCacheStats s32 = mesh_analyze_vertex_cache(indices.data(), indices.size(), vertex_count, 32);
+    printf("%-22s %8.3f %8.3f %8.3f %8.3f %9.2f\n", name, s16.acmr, s16.atvr, s32.acmr, s32.atvr, ms);
+}
+
+int main(int argc, char** argv)
+{
+    const int rings = argc > 1 ? atoi(argv[1]) : 200;
+    std::vector<BenchVertex> vertices;
+    std::vector<uint32_t> original;
+    build_sphere(rings, &vertices, &original);
+    std::vector<uint32_t> shuffled = original;
+    shuffle_triangles(&shuffled);
+
+    printf("sphere: %zu vertices, %zu triangles\n", vertices.size(), original.size() / 3);
+    printf("%-22s %8s %8s %8s %8s %9s\n", "order", "acmr16", "atvr16", "acmr32", "atvr32", "ms");
+    report("generated (strips)", original, vertices.size(), 0.0);
+    report("shuffled", shuffled, vertices.size(), 0.0);
+
+    std::vector<uint32_t> forsyth = shuffled;
+    double t = now_ms();
+    mesh_optimize_vertex_cache(forsyth.data(), forsyth.size(), vertices.size());
+    report("forsyth", forsyth, vertices.size(), now_ms() - t);
+
+    std::vector<uint32_t> tipsify = shuffled;
+    t = now_ms();
+    mesh_optimize_vertex_cache_tipsify(tipsify.data(), tipsify.size(), vertices.size(), 16);
+    report("tipsify (16)", tipsify, vertices.size(), now_ms() - t);
+
+    std::vector<uint32_t> overdraw = tipsify;
+    t = now_ms();
+    mesh_optimize_overdraw(overdraw.data(), overdraw.size(), vertices[0].pos, sizeof(BenchVertex), vertices.size(), 1.05f);
+    report("tipsify + overdraw", overdraw, vertices.size(), now_ms() - t);
+
+    // Every pass must keep the same set of triangles
+    std::vector<BenchVertex> fetch_vertices = vertices;
+    std::vector<uint32_t> fetch = forsyth;
+    t = now_ms();
+    const size_t used = mesh_optimize_vertex_fetch(fetch_vertices.data(), fetch.data(), fetch.size(), fetch_vertices.size(), sizeof(BenchVertex));
+    const double fetch_ms = now_ms() - t;
+    bool same = used == vertices.size();
+    for (size_t i = 0; same && i < fetch.size(); ++i)
+        same = !memcmp(&fetch_vertices[fetch[i]], &vertices[forsyth[i]], sizeof(BenchVertex));
+    printf("vertex fetch remap: %zu vertices kept, %.2f ms, %s\n", used, fetch_ms, same ? "ok" : "MISMATCH");
+
+    const size_t tri_bytes = sizeof(uint32_t) * 3;
+    std::vector<uint32_t> sorted[4] = { original, forsyth, tipsify, overdraw };
+    for (std::vector<uint32_t>& list : sorted)
+    {
+        for (size_t i = 0; i < list.size(); i += 3)
+        {
+            // Canonical rotation so winding-preserving reorders compare equal
+            uint32_t* tri = &list[i];
+            while (tri[0] > tri[1] || tri[0] > tri[2])
+            {
+                const uint32_t first = tri[0];
+                tri[0] = tri[1]; tri[1] = tri[2]; tri[2] = first;
+            }
+        }
+        qsort(list.data(), list.size() / 3, tri_bytes, [](const void* a, const void* b) { return memcmp(a, b, sizeof(uint32_t) * 3); });
+    }
+    const bool preserved = sorted[1] == sorted[0] && sorted[2] == sorted[0] && sorted[3] == sorted[0];
+    printf("triangle sets preserved: %s\n", preserved ? "ok" : "MISMATCH");
+    return preserved && same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
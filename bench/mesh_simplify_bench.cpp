@@ -0,0 +1,159 @@
+// Mesh simplification check (src/asset/mesh_simplify.h): a flat grid must collapse to a couple of
+// triangles with no error and its outline intact, and a bumpy heightfield's LOD chain must shrink level by
+// level with non-decreasing error, keep every triangle facing up, and stay within about its reported error of
+// the original surface (measured at sampled original vertices). Prints the chain and the time it took.
+//
+// Usage: mesh_simplify_bench [grid size] [ratio]
+
+#include "asset/mesh_simplify.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SAMPLES 2000                // original vertices measured against each level
+
+static uint32_t random_u32(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// n x n quads over the unit square, heights from "height"
+static void build_grid(int n, float (*height)(float, float), std::vector<float>* positions, std::vector<uint32_t>* indices)
+{
+    for (int y = 0; y <= n; ++y)
+    {
+        for (int x = 0; x <= n; ++x)
+        {
+            const float u = (float)x / n, v = (float)y / n;
+            positions->push_back(u);
+            positions->push_back(v);
+            positions->push_back(height(u, v));
+        }
+    }
+    for (int y = 0; y < n; ++y)
+    {
+        for (int x = 0; x < n; ++x)
+        {
+            const uint32_t a = y * (n + 1) + x, b = a + n + 1;
+            const uint32_t quad[6] = { a, a + 1, b, a + 1, b + 1, b };
+            indices->insert(indices->end(), quad, quad + 6);
+        }
+    }
+}
+
+static float flat(float, float)
+{
+    return 0.f;
+}
+
+static float bumps(float u, float v)
+{
+    return 0.05f * sinf(9.f * u) * cosf(7.f * v) + 0.02f * sinf(23.f * u + 5.f * v);
+}
+
+static float cross_z(const float* p, const uint32_t* t)
+{
+    const float* a = p + 3 * t[0];
+    const float* b = p + 3 * t[1];
+    const float* c = p + 3 * t[2];
+    return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+// Vertical distance from (x, y, z) to the triangles covering (x, y); -1 when none does
+static float height_error(const float* p, const uint32_t* indices, size_t index_count, const float* q)
+{
+    float best = -1.f;
+    for (size_t i = 0; i < index_count; i += 3)
+    {
+        const float* a = p + 3 * indices[i];
+        const float* b = p + 3 * indices[i + 1];
+        const float* c = p + 3 * indices[i + 2];
+        const float area = cross_z(p, indices + i);
+        if (area <= 0.f)
+            continue;
+        const float w0 = ((b[0] - q[0]) * (c[1] - q[1]) - (b[1] - q[1]) * (c[0] - q[0])) / area;
+        const float w1 = ((c[0] - q[0]) * (a[1] - q[1]) - (c[1] - q[1]) * (a[0] - q[0])) / area;
+        const float w2 = 1.f - w0 - w1;
+        if (w0 < -1e-5f || w1 < -1e-5f || w2 < -1e-5f)
+            continue;
+        const float d = fabsf(w0 * a[2] + w1 * b[2] + w2 * c[2] - q[2]);
+        best = best < 0.f || d < best ? d : best;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? atoi(argv[1]) : 128;
+    const float ratio = argc > 2 ? (float)atof(argv[2]) : 0.5f;
+    if (n < 2 || !(ratio > 0.f && ratio < 1.f))
+    {
+        fprintf(stderr, "usage: %s [grid size, at least 2] [ratio, between 0 and 1]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    bool ok = true;
+
+    // A flat grid: nothing to lose but its outline, which mustn't move
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    build_grid(16, flat, &positions, &indices);
+    std::vector<uint32_t> simplified(indices.size());
+    float error = 0.f;
+    const size_t flat_count = mesh_simplify(simplified.data(), indices.data(), indices.size(), positions.data(),
+        3 * sizeof(float), positions.size() / 3, 0, 1e-4f, &error);
+    float area = 0.f;
+    for (size_t i = 0; i < flat_count; i += 3)
+        area += 0.5f * cross_z(positions.data(), &simplified[i]);
+    const bool flat_ok = flat_count >= 6 && flat_count <= 12 && error < 1e-4f && fabsf(area - 1.f) < 1e-4f;
+    printf("flat:      %zu triangles to %zu, error %.1e, area %.6f  %s\n", indices.size() / 3, flat_count / 3,
+        error, area, flat_ok ? "ok" : "FAIL");
+    ok = ok && flat_ok;
+
+    // A heightfield's chain
+    positions.clear();
+    indices.clear();
+    build_grid(n, bumps, &positions, &indices);
+    const size_t vertex_count = positions.size() / 3;
+    std::vector<uint32_t> chain(indices.size() * 2);
+    MeshLod lods[MESH_SIMPLIFY_MAX_LODS];
+    const double start = now_ms();
+    const int level_count = mesh_simplify_lods(chain.data(), chain.size(), lods, MESH_SIMPLIFY_MAX_LODS, indices.data(),
+        indices.size(), positions.data(), 3 * sizeof(float), vertex_count, ratio);
+    const double ms = now_ms() - start;
+    printf("chain:     %d levels from %zu triangles in %.1f ms\n", level_count, indices.size() / 3, ms);
+    ok = ok && level_count > 1;
+    unsigned int state = 1;
+    for (int l = 0; l < level_count; ++l)
+    {
+        const MeshLod* lod = &lods[l];
+        const uint32_t* level = chain.data() + lod->first_index;
+        bool level_ok = lod->index_count % 3 == 0 && lod->index_count > 0;
+        if (l)
+            level_ok = level_ok && lod->index_count < lods[l - 1].index_count && lod->error >= lods[l - 1].error;
+        size_t flipped = 0;
+        for (size_t i = 0; i < lod->index_count; i += 3)
+            flipped += cross_z(positions.data(), level + i) <= 0.f;
+        float measured = 0.f;
+        for (int s = 0; s < SAMPLES; ++s)
+        {
+            const float d = height_error(positions.data(), level, lod->index_count,
+                &positions[3 * (random_u32(&state) % vertex_count)]);
+            level_ok = level_ok && d >= 0.f;    // every sample still covered
+            measured = fmaxf(measured, d);
+        }
+        level_ok = level_ok && !flipped && measured <= 2.f * lod->error + 1e-5f;
+        printf("  lod %d:   %7u triangles, error %.2e, measured %.2e, %zu flipped  %s\n", l, lod->index_count / 3,
+            lod->error, measured, flipped, level_ok ? "ok" : "FAIL");
+        ok = ok && level_ok;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
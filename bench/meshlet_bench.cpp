@@ -0,0 +1,213 @@
+// Meshlet check (src/asset/meshlet.h): a bumpy sphere split into meshlets must keep every triangle exactly once,
+// stay within the vertex and triangle limits, and bound each meshlet's vertices with its sphere. For random
+// perspective, parallel and mirrored views, every meshlet the cone test culls must have all its triangles wound
+// clockwise on screen, which is what back-face culling would have dropped. Prints the split and its time.
+//
+// Usage: meshlet_bench [sphere segments] [views]
+
+#include "asset/meshlet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static uint32_t random_u32(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    return lo + (hi - lo) * (float)(random_u32(state) & 0xffff) / 65535.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// n segments around, n / 2 rings, wound counterclockwise seen from outside
+static void build_sphere(int n, std::vector<float>* positions, std::vector<uint32_t>* indices)
+{
+    const int rings = n / 2;
+    for (int r = 0; r <= rings; ++r)
+    {
+        const float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= n; ++s)
+        {
+            const float phi = 2.f * 3.14159265f * s / n;
+            const float bump = 1.f + 0.05f * sinf(7.f * phi) * sinf(5.f * theta);
+            positions->push_back(bump * sinf(theta) * cosf(phi));
+            positions->push_back(bump * sinf(theta) * sinf(phi));
+            positions->push_back(bump * cosf(theta));
+        }
+    }
+    for (int r = 0; r < rings; ++r)
+    {
+        for (int s = 0; s < n; ++s)
+        {
+            const uint32_t a = r * (n + 1) + s, b = a + n + 1;
+            const uint32_t quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+            indices->insert(indices->end(), quad, quad + 6);
+        }
+    }
+}
+
+// Twice the signed screen area of a triangle through "vp", or 0 when a corner is at or behind the eye
+static float screen_area(mat4x4 const vp, const float* a, const float* b, const float* c)
+{
+    vec2 ndc[3];
+    const float* p[3] = { a, b, c };
+    for (int k = 0; k < 3; ++k)
+    {
+        vec4 clip;
+        const vec4 point = { p[k][0], p[k][1], p[k][2], 1.f };
+        mat4x4_mul_vec4(clip, vp, point);
+        if (clip[3] <= 1e-4f)
+            return 0.f;
+        ndc[k][0] = clip[0] / clip[3];
+        ndc[k][1] = clip[1] / clip[3];
+    }
+    return (ndc[1][0] - ndc[0][0]) * (ndc[2][1] - ndc[0][1]) - (ndc[1][1] - ndc[0][1]) * (ndc[2][0] - ndc[0][0]);
+}
+
+static void random_view(mat4x4 vp, unsigned int* state, int kind)
+{
+    vec3 eye = { random_float(state, -1.f, 1.f), random_float(state, -1.f, 1.f), random_float(state, -1.f, 1.f) };
+    vec3_norm(eye, eye);
+    vec3_scale(eye, eye, random_float(state, 1.3f, 4.f));
+    const vec3 centre = { 0.f, 0.f, 0.f }, up = { 0.f, 0.f, 1.f };
+    mat4x4 view, projection;
+    mat4x4_look_at(view, eye, centre, up);
+    if (kind == 0)
+        mat4x4_perspective(projection, random_float(state, 0.5f, 1.5f), 1.f, 0.05f, 10.f);
+    else
+        mat4x4_ortho(projection, -1.5f, 1.5f, -1.5f, 1.5f, 0.1f, 10.f);
+    if (kind == 2)
+        projection[2][2] = -projection[2][2];   // the depth axis flipped, as the app's camera has it
+    if (kind == 3)
+    {
+        mat4x4_perspective(projection, 1.f, 1.f, 0.05f, 10.f);
+        for (int c = 0; c < 4; ++c)
+            projection[c][0] = -projection[c][0];   // mirrored left to right
+    }
+    mat4x4_mul(vp, projection, view);
+}
+
+int main(int argc, char** argv)
+{
+    const int segments = argc > 1 ? atoi(argv[1]) : 512;
+    const int views = argc > 2 ? atoi(argv[2]) : 64;
+    if (segments < 4 || views < 1)
+    {
+        fprintf(stderr, "usage: %s [sphere segments, at least 4] [views, at least 1]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    bool ok = true;
+
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    build_sphere(segments, &positions, &indices);
+    const size_t vertex_count = positions.size() / 3;
+    std::vector<Meshlet> meshlets(meshlet_bound(indices.size()));
+    std::vector<uint32_t> ordered(indices.size());
+    const double start = now_ms();
+    const size_t meshlet_count = meshlet_build(meshlets.data(), ordered.data(), indices.data(), indices.size(),
+        positions.data(), 3 * sizeof(float), vertex_count);
+    const double ms = now_ms() - start;
+
+    // The same triangles, each once, as whole meshlet ranges
+    size_t next = 0, shared = 0, coned = 0;
+    bool split_ok = meshlet_count > 0 && meshlet_count <= meshlets.size();
+    for (size_t k = 0; k < meshlet_count && split_ok; ++k)
+    {
+        const Meshlet* m = &meshlets[k];
+        split_ok = m->first_index == next && m->triangle_count > 0 && m->triangle_count <= MESHLET_MAX_TRIANGLES &&
+            m->vertex_count <= MESHLET_MAX_VERTICES;
+        next += 3 * (size_t)m->triangle_count;
+        shared += m->vertex_count;
+        coned += m->cone_cutoff < 1.f;
+        std::vector<uint32_t> distinct;
+        for (uint32_t i = m->first_index; i < m->first_index + 3 * m->triangle_count && split_ok; ++i)
+        {
+            const float* p = &positions[3 * ordered[i]];
+            const float d[3] = { p[0] - m->center[0], p[1] - m->center[1], p[2] - m->center[2] };
+            split_ok = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) <= m->radius * 1.0001f + 1e-6f;
+            bool known = false;
+            for (uint32_t v : distinct)
+                known = known || v == ordered[i];
+            if (!known)
+                distinct.push_back(ordered[i]);
+        }
+        split_ok = split_ok && distinct.size() == m->vertex_count;
+    }
+    split_ok = split_ok && next == indices.size();
+    {
+        // The same triangles: both lists, each triangle rotated to start at its smallest index, sorted
+        std::vector<uint64_t> a, b;
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            const std::vector<uint32_t>& list = pass ? ordered : indices;
+            std::vector<uint64_t>& keys = pass ? b : a;
+            for (size_t i = 0; i < list.size(); i += 3)
+            {
+                uint32_t t[3] = { list[i], list[i + 1], list[i + 2] };
+                while (t[0] > t[1] || t[0] > t[2])
+                {
+                    const uint32_t x = t[0];
+                    t[0] = t[1];
+                    t[1] = t[2];
+                    t[2] = x;
+                }
+                keys.push_back(((uint64_t)t[0] << 42) ^ ((uint64_t)t[1] << 21) ^ t[2]);
+            }
+            std::sort(keys.begin(), keys.end());
+        }
+        split_ok = split_ok && a == b;
+    }
+    printf("split:     %zu triangles into %zu meshlets (%.1f triangles, %.1f vertices each, %zu with cones) in %.1f ms  %s\n",
+        indices.size() / 3, meshlet_count, meshlet_count ? (double)indices.size() / 3 / meshlet_count : 0.,
+        meshlet_count ? (double)shared / meshlet_count : 0., coned, ms, split_ok ? "ok" : "FAIL");
+    ok = ok && split_ok;
+
+    // Culled meshlets must be entirely back-facing
+    static const char* kinds[] = { "perspective", "parallel", "flipped depth", "mirrored" };
+    unsigned int state = 1;
+    for (int kind = 0; kind < 4; ++kind)
+    {
+        size_t culled = 0, wrong = 0, total = 0;
+        for (int view = 0; view < views; ++view)
+        {
+            mat4x4 vp;
+            random_view(vp, &state, kind);
+            vec4 eye;
+            meshlet_view_eye(eye, vp);
+            for (size_t k = 0; k < meshlet_count; ++k)
+            {
+                const Meshlet* m = &meshlets[k];
+                ++total;
+                if (!meshlet_cone_culled(m, eye))
+                    continue;
+                ++culled;
+                for (uint32_t i = m->first_index; i < m->first_index + 3 * m->triangle_count; i += 3)
+                {
+                    if (screen_area(vp, &positions[3 * ordered[i]], &positions[3 * ordered[i + 1]],
+                        &positions[3 * ordered[i + 2]]) > 0.f)
+                    {
+                        ++wrong;
+                        break;
+                    }
+                }
+            }
+        }
+        const bool view_ok = !wrong && culled > 0;
+        printf("  %-13s %5.1f%% of meshlets culled by their cones, %zu wrongly  %s\n", kinds[kind],
+            100. * culled / total, wrong, view_ok ? "ok" : "FAIL");
+        ok = ok && view_ok;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
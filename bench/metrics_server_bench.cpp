@@ -0,0 +1,278 @@
+// Metrics endpoint check (src/core/metrics_server.h): the exposition is Prometheus' text format, every family with
+// its HELP and TYPE lines, figures not known left out and a buffer too small refused; a scrape over loopback HTTP
+// gets that text for the latest sample with a right Content-Length, another path a 404; samples published as fast
+// as one thread can while others read and scrape are never seen torn. Then what publishing costs the render
+// thread, alone and while it's being read, and a scrape's round trip.
+//
+// Usage: metrics_server_bench [publishes]
+
+#include "core/metrics_server.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#endif
+
+#define READERS 2
+#define SCRAPES 200
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-48s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Sample "k": every figure follows from k, so a sample mixing two publishes shows
+static void make_sample(MetricsSample* m, uint64_t k)
+{
+    m->uptime = (double)k * 0.25;
+    m->frames = k * 15;
+    m->hitches = k / 7;
+    m->frame_seconds_sum = (double)k * 0.25;
+    m->frame_p50_ms = 16.0 + (double)(k % 5);
+    m->frame_p95_ms = m->frame_p50_ms + 1.0;
+    m->frame_p99_ms = m->frame_p50_ms + 2.0;
+    m->frame_max_ms = m->frame_p50_ms + 3.0;
+    m->gpu_frame_ms = (double)(k % 11);
+    m->gpu_memory_bytes = (int64_t)k * 4096;
+    m->gpu_budget_bytes = (int64_t)k * 8192;
+    m->gpu_available_bytes = (int64_t)k * 2048;
+    m->heap_bytes = (int64_t)k * 1024;
+    m->mesh_queue = (int64_t)(k % 3);
+    m->texture_queue = (int64_t)(k % 13);
+}
+
+static bool consistent(const MetricsSample* m)
+{
+    MetricsSample expected;
+    make_sample(&expected, m->frames / 15);
+    return m->frames % 15 == 0 && memcmp(m, &expected, sizeof(expected)) == 0;
+}
+
+// Every "# TYPE name ..." line followed by samples of that name only, each sample after the TYPE of its family
+static bool well_formed(const char* text, int* families)
+{
+    char family[128] = "";
+    *families = 0;
+    for (const char* line = text; *line; )
+    {
+        const char* end = strchr(line, '\n');
+        if (!end)
+            return false;
+        const size_t length = (size_t)(end - line);
+        if (strncmp(line, "# TYPE ", 7) == 0)
+        {
+            const size_t name = strcspn(line + 7, " ");
+            const char* type = line + 8 + name;
+            if (name >= sizeof(family) || (strncmp(type, "gauge\n", 6) && strncmp(type, "counter\n", 8)
+                && strncmp(type, "summary\n", 8)))
+                return false;
+            memcpy(family, line + 7, name);
+            family[name] = 0;
+            ++*families;
+        }
+        else if (strncmp(line, "# HELP ", 7))
+        {
+            const size_t name = strcspn(line, " {");
+            const size_t f = strlen(family);
+            if (!f || name < f || strncmp(line, family, f) || (name > f && strncmp(line + f, "_sum", 4)
+                && strncmp(line + f, "_count", 6)))
+                return false;
+            const char* value = (const char*)memchr(line, ' ', length);
+            char* parsed = NULL;
+            if (!value || (strtod(value + 1, &parsed), parsed != end))
+                return false;
+        }
+        line = end + 1;
+    }
+    return *families > 0;
+}
+
+static socket_t connect_to(int port)
+{
+    const socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t)port);
+    if (s != INVALID_SOCKET && connect(s, (const sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close_socket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+// "GET path", the whole answer into "out" (NUL-terminated); false when the connection fails
+static bool scrape(int port, const char* path, std::vector<char>* out)
+{
+    const socket_t s = connect_to(port);
+    if (s == INVALID_SOCKET)
+        return false;
+    char request[256];
+    const int size = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n"
+        "Accept: text/plain\r\n\r\n", path);
+    send(s, request, size, 0);
+    out->clear();
+    char buffer[4096];
+    for (int n; (n = (int)recv(s, buffer, sizeof(buffer), 0)) > 0; )
+        out->insert(out->end(), buffer, buffer + n);
+    out->push_back(0);
+    close_socket(s);
+    return true;
+}
+
+// The body of an answer whose status line is "status" and whose Content-Length is the body's, NULL otherwise
+static const char* body_of(const std::vector<char>& answer, const char* status)
+{
+    const char* text = answer.data();
+    const char* body = strstr(text, "\r\n\r\n");
+    const char* length = strstr(text, "Content-Length: ");
+    if (strncmp(text, status, strlen(status)) || !body || !length || length > body)
+        return NULL;
+    body += 4;
+    return strtoull(length + 16, NULL, 10) == strlen(body) ? body : NULL;
+}
+
+int main(int argc, char** argv)
+{
+    const int publishes = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 2000000;
+    bool ok = true;
+
+    // The format, offline
+    MetricsSample sample;
+    make_sample(&sample, 40);
+    static char text[METRICS_RESPONSE_BYTES];
+    const size_t length = metrics_format(&sample, text, sizeof(text));
+    int families = 0;
+    ok = report("every family typed, every sample a number", length == strlen(text)
+        && well_formed(text, &families) && families == 11) && ok;
+    ok = report("quantiles, sum and count in seconds",
+        strstr(text, "\nopengltest_frame_time_seconds{quantile=\"0.99\"} 0.018\n")
+        && strstr(text, "\nopengltest_frame_time_seconds_sum 10\n")
+        && strstr(text, "\nopengltest_frame_time_seconds_count 600\n")
+        && strstr(text, "\nopengltest_streaming_queue_depth{queue=\"texture\"} 1\n")) && ok;
+    MetricsSample unknown;
+    metrics_sample_clear(&unknown);
+    metrics_format(&unknown, text, sizeof(text));
+    ok = report("figures not known left out", well_formed(text, &families) && families == 4
+        && !strstr(text, "{quantile") && !strstr(text, "memory_") && !strstr(text, "{queue")) && ok;
+    ok = report("a buffer too small refused", metrics_format(&sample, text, 200) == 0 && text[0] == 0) && ok;
+
+    // Served
+    if (!metrics_server_start(0))
+        return 1;
+    const int port = metrics_server_port();
+    metrics_publish(&sample);
+    std::vector<char> answer;
+    bool served = scrape(port, "/metrics", &answer);
+    const char* body = body_of(answer, "HTTP/1.1 200 OK\r\n");
+    metrics_format(&sample, text, sizeof(text));
+    served = served && body && strcmp(body, text) == 0
+        && strstr(answer.data(), "Content-Type: text/plain; version=0.0.4");
+    ok = report("GET /metrics answered with the latest sample", served) && ok;
+    ok = report("GET / as well", scrape(port, "/?x=1", &answer) && body_of(answer, "HTTP/1.1 200 OK\r\n")) && ok;
+    ok = report("another path a 404", scrape(port, "/other", &answer)
+        && body_of(answer, "HTTP/1.1 404 Not Found\r\n")) && ok;
+
+    // Never torn: one publisher flat out, readers and a scraper checking every sample they see
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0), read_count(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < READERS; ++i)
+        readers.emplace_back([&] {
+            while (!done.load())
+            {
+                MetricsSample seen;
+                metrics_read(&seen);
+                torn += consistent(&seen) ? 0 : 1;
+                ++read_count;
+            }
+        });
+    std::atomic<int> scrapes(0), bad_scrapes(0);
+    double scrape_ms = 1e30;
+    std::thread scraper([&] {
+        std::vector<char> got;
+        while (!done.load() && scrapes.load() < SCRAPES)
+        {
+            const double t0 = now_ms();
+            const bool answered = scrape(port, "/metrics", &got);
+            const double t1 = now_ms();
+            scrape_ms = t1 - t0 < scrape_ms ? t1 - t0 : scrape_ms;
+            const char* frames = answered ? strstr(got.data(), "\nopengltest_frames_total ") : NULL;
+            const char* hitches = answered ? strstr(got.data(), "\nopengltest_hitches_total ") : NULL;
+            const char* queue = answered ? strstr(got.data(), "{queue=\"texture\"} ") : NULL;
+            const uint64_t k = frames ? strtoull(frames + 25, NULL, 10) / 15 : 0;
+            bad_scrapes += frames && hitches && queue && strtoull(hitches + 26, NULL, 10) == k / 7
+                && strtoull(queue + 18, NULL, 10) == k % 13 ? 0 : 1;
+            ++scrapes;
+        }
+    });
+    MetricsSample m;
+    const double t0 = now_ms();
+    for (int k = 1; k <= publishes; ++k)
+    {
+        make_sample(&m, (uint64_t)k);
+        metrics_publish(&m);
+    }
+    const double contended = (now_ms() - t0) * 1e6 / publishes;
+    while (scrapes.load() < 10)
+        std::this_thread::yield();
+    done = true;
+    for (std::thread& t : readers)
+        t.join();
+    scraper.join();
+    char what[80];
+    snprintf(what, sizeof(what), "%d reads, %d scrapes, none torn", read_count.load(), scrapes.load());
+    ok = report(what, torn.load() == 0 && bad_scrapes.load() == 0) && ok;
+
+    // Alone: what the render thread pays every METRICS_PUBLISH_SECONDS with nobody scraping
+    const double t1 = now_ms();
+    for (int k = 1; k <= publishes; ++k)
+    {
+        make_sample(&m, (uint64_t)k);
+        metrics_publish(&m);
+    }
+    const double alone = (now_ms() - t1) * 1e6 / publishes;
+    const double t2 = now_ms();
+    for (int k = 0; k < publishes; ++k)
+        metrics_read(&m);
+    const double reading = (now_ms() - t2) * 1e6 / publishes;
+    metrics_server_stop();
+    ok = report("stopped: the port closed", connect_to(port) == INVALID_SOCKET) && ok;
+
+    printf("%d publishes of %zu bytes:\n", publishes, sizeof(MetricsSample));
+    printf("  publish alone      %8.1f ns\n", alone);
+    printf("  publish, %d readers %7.1f ns\n", READERS, contended);
+    printf("  read               %8.1f ns\n", reading);
+    printf("  scrape round trip  %8.3f ms (best of %d)\n", scrape_ms, scrapes.load());
+
+    printf("%s\n", ok ? "metrics_server_bench: ok" : "metrics_server_bench: FAIL");
+    return ok ? 0 : 1;
+}
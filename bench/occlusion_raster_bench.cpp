@@ -0,0 +1,216 @@
+// CPU occlusion culling (scene/occlusion_raster.h): a city of box buildings seen from the street, with small
+// objects scattered between and behind them. The buildings' faces are the occluders; every frame they're drawn into
+// the low-resolution depth buffer, serially and on the job system, and the objects the frustum keeps are tested
+// against it. The culling must be conservative: every hidden object is checked by rays from the eye to its corners
+// and centre, each of which must pass through a building first, and a box just in front of the eye must stay.
+//
+// Usage: occlusion_raster_bench [objects] [buildings per side] [buffer width]
+
+#include "core/job_system.h"
+#include "linmath_batch.h"
+#include "scene/frustum.h"
+#include "scene/occlusion_raster.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SPACING 4.f         // between building centres; the streets are what the buildings leave
+#define FOOTPRINT 3.f       // building width
+#define FRAMES 20
+#define CHECK_STRIDE 37     // every this many hidden objects gets the ray check
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Appends the box's 12 triangles, 3 vertices each, to the SoA vertex arrays
+static void box_triangles(const Aabb* b, float* x, float* y, float* z, uint32_t* n)
+{
+    static const int faces[6][4] = {
+        { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 } };
+    for (int f = 0; f < 6; ++f)
+    {
+        const int tri[6] = { faces[f][0], faces[f][1], faces[f][2], faces[f][0], faces[f][2], faces[f][3] };
+        for (int v = 0; v < 6; ++v)
+        {
+            x[*n] = (tri[v] & 1) ? b->max[0] : b->min[0];
+            y[*n] = (tri[v] & 2) ? b->max[1] : b->min[1];
+            z[*n] = (tri[v] & 4) ? b->max[2] : b->min[2];
+            ++*n;
+        }
+    }
+}
+
+// Whether the segment from "eye" to "p" passes through the box before reaching p
+static bool segment_blocked(const vec3 eye, const vec3 p, const Aabb* b)
+{
+    float t0 = 0.f, t1 = 0.999f;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float d = p[k] - eye[k];
+        if (fabsf(d) < 1e-9f)
+        {
+            if (eye[k] < b->min[k] || eye[k] > b->max[k])
+                return false;
+            continue;
+        }
+        float a = (b->min[k] - eye[k]) / d, c = (b->max[k] - eye[k]) / d;
+        if (a > c)
+        {
+            const float s = a; a = c; c = s;
+        }
+        t0 = a > t0 ? a : t0;
+        t1 = c < t1 ? c : t1;
+        if (t0 > t1)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t count = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 200000;
+    const int side = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 32;
+    const int width = argc > 3 && atoi(argv[3]) > 0 ? atoi(argv[3]) : 256;
+    const float extent = side * SPACING;
+    unsigned int state = 12345u;
+
+    std::vector<Aabb> buildings((size_t)side * side);
+    for (int j = 0; j < side; ++j)
+    {
+        for (int i = 0; i < side; ++i)
+        {
+            const float cx = (i + 0.5f) * SPACING, cy = (j + 0.5f) * SPACING, h = random_float(&state, 2.f, 12.f);
+            const Aabb b = { { cx - 0.5f * FOOTPRINT, cy - 0.5f * FOOTPRINT, 0.f },
+                { cx + 0.5f * FOOTPRINT, cy + 0.5f * FOOTPRINT, h } };
+            buildings[(size_t)j * side + i] = b;
+        }
+    }
+    std::vector<Aabb> objects(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float x = random_float(&state, 0.f, extent), y = random_float(&state, 0.f, extent);
+        const float e = random_float(&state, 0.1f, 0.4f);
+        const Aabb b = { { x - e, y - e, 0.f }, { x + e, y + e, 2.f * e } };
+        objects[i] = b;
+    }
+
+    // Standing in a street, looking along the city at a slant so the buildings hide most of it
+    vec3 eye = { 2.f * SPACING, -2.f, 1.7f }, center = { 0.6f * extent, extent, 1.f }, up = { 0.f, 0.f, 1.f };
+    mat4x4 projection, view, view_projection;
+    mat4x4_perspective(projection, 1.1f, 2.f, 0.1f, 4.f * extent);
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(view_projection, projection, view);
+    Frustum frustum;
+    frustum_from_matrix(&frustum, view_projection);
+
+    const uint32_t vertex_count = (uint32_t)buildings.size() * 36;
+    float* vx = (float*)linmath_aligned_alloc(sizeof(float) * vertex_count, LINMATH_BATCH_ALIGN);
+    float* vy = (float*)linmath_aligned_alloc(sizeof(float) * vertex_count, LINMATH_BATCH_ALIGN);
+    float* vz = (float*)linmath_aligned_alloc(sizeof(float) * vertex_count, LINMATH_BATCH_ALIGN);
+    uint32_t n = 0;
+    for (const Aabb& b : buildings)
+        box_triangles(&b, vx, vy, vz, &n);
+
+    JobSystem jobs;
+    OcclusionRaster raster;
+    if (!vx || !vy || !vz || !job_system_init(&jobs, 0)
+        || !occlusion_raster_init(&raster, width, width / 2, vertex_count / 3))
+    {
+        fprintf(stderr, "occlusion_raster_bench: out of memory\n");
+        return 1;
+    }
+    printf("%u objects among %d buildings (%u occluder triangles), %dx%d buffer; %d job threads\n", count,
+        side * side, vertex_count / 3, raster.width, raster.height, jobs.thread_count);
+
+    std::vector<uint32_t> in_view, visible(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (frustum_aabb_planes(&frustum, objects[i].min, objects[i].max, 0x3F) >= 0)
+            in_view.push_back(i);
+    }
+
+    double serial = 0.0, parallel = 0.0, cull = 0.0;
+    size_t kept = 0;
+    for (int f = 0; f < FRAMES; ++f)
+    {
+        double t0 = now_ms();
+        occlusion_raster_begin(&raster, view_projection);
+        occlusion_raster_add(&raster, vx, vy, vz, vertex_count);
+        occlusion_raster_render(&raster, NULL);
+        double t1 = now_ms();
+        serial += t1 - t0;
+        t0 = now_ms();
+        occlusion_raster_begin(&raster, view_projection);
+        occlusion_raster_add(&raster, vx, vy, vz, vertex_count);
+        occlusion_raster_render(&raster, &jobs);
+        t1 = now_ms();
+        parallel += t1 - t0;
+        visible.assign(in_view.begin(), in_view.end());
+        t0 = now_ms();
+        kept = occlusion_raster_cull(&raster, &jobs, objects.data(), visible.data(), visible.size());
+        cull += now_ms() - t0;
+    }
+
+    // Every hidden object, sampled, must be behind a building from every corner and its centre
+    bool ok = true;
+    size_t hidden = 0, checked = 0, leaks = 0;
+    for (size_t k = 0, v = 0; k < in_view.size(); ++k)
+    {
+        if (v < kept && visible[v] == in_view[k])
+        {
+            ++v;
+            continue;
+        }
+        if (hidden++ % CHECK_STRIDE)
+            continue;
+        const Aabb* b = &objects[in_view[k]];
+        for (int c = 0; c < 9; ++c)
+        {
+            vec3 p;
+            for (int a = 0; a < 3; ++a)
+                p[a] = c == 8 ? 0.5f * (b->min[a] + b->max[a]) : ((c >> a) & 1) ? b->max[a] : b->min[a];
+            bool blocked = false;
+            for (size_t i = 0; i < buildings.size() && !blocked; ++i)
+                blocked = segment_blocked(eye, p, &buildings[i]);
+            leaks += !blocked;
+        }
+        ++checked;
+    }
+    ok = report("hidden objects are behind buildings", leaks == 0) && ok;
+    const vec3 near_min = { eye[0] - 0.2f, -1.2f, 1.5f }, near_max = { eye[0] + 0.2f, -0.8f, 1.9f };
+    ok = report("a box in front of the eye is kept", occlusion_raster_test(&raster, near_min, near_max)) && ok;
+    ok = report("some objects are hidden", hidden > 0) && ok;
+    printf("  %zu in view, %zu hidden (%.1f%%), %zu checked; %u triangles drawn, %u left out\n", in_view.size(),
+        hidden, in_view.empty() ? 0.0 : 100.0 * hidden / in_view.size(), checked, raster.triangle_count,
+        raster.dropped);
+    printf("per frame over %d frames:\n", FRAMES);
+    printf("  %-22s %8.3f ms\n", "occluders, serial", serial / FRAMES);
+    printf("  %-22s %8.3f ms\n", "occluders, jobs", parallel / FRAMES);
+    printf("  %-22s %8.3f ms (%.1f ns an object)\n", "cull", cull / FRAMES,
+        in_view.empty() ? 0.0 : 1e6 * cull / FRAMES / in_view.size());
+
+    occlusion_raster_destroy(&raster);
+    job_system_destroy(&jobs);
+    linmath_aligned_free(vx);
+    linmath_aligned_free(vy);
+    linmath_aligned_free(vz);
+    printf("%s\n", ok ? "occlusion_raster_bench: ok" : "occlusion_raster_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+// Asset package check (src/asset/lz4.h, asset_package.h): a hand-made LZ4 block decodes, every kind of input
+// compresses and comes back byte for byte at every short length, and truncated or garbled blocks are refused. A
+// package of an empty, a small, a multi-block and an incompressible entry then writes with aligned blocks, finds
+// each entry by name and unpacks them the same one block at a time and across the job system; a mesh file comes
+// out of it and opens like one from disk. Duplicate names, a truncated package and a garbled block must fail.
+// Times compressing a mesh-like payload and unpacking it on one thread and on all of them.
+//
+// Usage: package_bench [MB]
+
+#include "asset/asset_package.h"
+#include "asset/lz4.h"
+#include "asset/mesh_file.h"
+#include "asset/vertex_pack.h"
+#include "core/job_system.h"
+
+#include <chrono>
+#include <filesystem>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static std::vector<unsigned char> random_bytes(size_t size, unsigned int seed)
+{
+    std::vector<unsigned char> data(size);
+    for (unsigned char& c : data)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        c = (unsigned char)(seed >> 24);
+    }
+    return data;
+}
+
+// Packed vertices of a bumpy grid - 16-bit positions, octahedral normals, 16-bit UVs - then its 32-bit indices:
+// the mix of smooth and noisy bytes a cooked mesh has
+static std::vector<unsigned char> mesh_like(size_t size)
+{
+    std::vector<unsigned char> data;
+    data.reserve(size);
+    const int side = 512;
+    for (int i = 0; data.size() + 16 <= size / 2; ++i)
+    {
+        const int x = i % side, y = (i / side) % side;
+        const float h = sinf(x * 0.05f) * cosf(y * 0.07f);
+        const int16_t v[8] = { (int16_t)(x * 64), (int16_t)(h * 8000.f), (int16_t)(y * 64), 0,
+            (int16_t)(h * 127.f), (int16_t)(127 - fabsf(h) * 64.f), (int16_t)(x * 128), (int16_t)(y * 128) };
+        data.insert(data.end(), (const unsigned char*)v, (const unsigned char*)(v + 8));
+    }
+    for (uint32_t q = 0; data.size() + 24 <= size; ++q)
+    {
+        const uint32_t x = q % (side - 1), y = q / (side - 1), a = y * side + x;
+        const uint32_t tri[6] = { a, a + 1, a + side, a + 1, a + side + 1, a + side };
+        data.insert(data.end(), (const unsigned char*)tri, (const unsigned char*)(tri + 6));
+    }
+    data.resize(size, 0);
+    return data;
+}
+
+static bool round_trips(const unsigned char* data, size_t size)
+{
+    std::vector<unsigned char> packed(lz4_compress_bound(size)), back(size + 1);
+    const size_t n = lz4_compress(data, size, packed.data(), packed.size());
+    return n > 0 && lz4_decompress(packed.data(), n, back.data(), size)
+        && (size == 0 || memcmp(back.data(), data, size) == 0) && !lz4_decompress(packed.data(), n, back.data(), size + 1);
+}
+
+static bool lz4_checks()
+{
+    // "abc", then a 9-byte match 3 back; then the last literals
+    const unsigned char block[] = { 0x35, 'a', 'b', 'c', 3, 0, 0x50, 'x', 'y', 'z', 'w', 'v' };
+    char text[18] = {};
+    bool ok = report("a reference LZ4 block decodes",
+        lz4_decompress(block, sizeof(block), text, 17) && !strcmp(text, "abcabcabcabcxyzwv"));
+
+    std::vector<unsigned char> inputs[4] = { std::vector<unsigned char>(300000, 7), random_bytes(300000, 1),
+        mesh_like(300000), std::vector<unsigned char>() };
+    for (int i = 0; i < 300000; ++i)
+        inputs[3].push_back((unsigned char)"the quick brown fox jumps over the lazy dog "[(i * 7 / 5) % 44]);
+    bool trips = true;
+    for (const std::vector<unsigned char>& input : inputs)
+    {
+        trips = trips && round_trips(input.data(), input.size());
+        for (size_t size = 0; size < 64 && trips; ++size)
+            trips = round_trips(input.data(), size);
+    }
+    ok = report("every input round-trips, at every length", trips) && ok;
+
+    // A truncated block never decodes to its size, nor does one whose offset reaches before the start
+    const std::vector<unsigned char>& input = inputs[2];
+    std::vector<unsigned char> packed(lz4_compress_bound(input.size())), back(input.size());
+    const size_t n = lz4_compress(input.data(), input.size(), packed.data(), packed.size());
+    bool refused = n > 0;
+    for (size_t cut = 0; cut < n && refused; cut += 1 + cut / 64)
+        refused = !lz4_decompress(packed.data(), cut, back.data(), back.size());
+    const unsigned char reaching[] = { 0x10, 'a', 5, 0, 0x50, 'x', 'y', 'z', 'w', 'v' };
+    refused = refused && !lz4_decompress(reaching, sizeof(reaching), text, 10);
+    std::vector<unsigned char> garbled(packed.begin(), packed.begin() + n);
+    memset(garbled.data() + n / 2, 0xff, n - n / 2);
+    refused = refused && !lz4_decompress(garbled.data(), n, back.data(), back.size());
+    ok = report("truncated and garbled blocks are refused", refused) && ok;
+    return ok;
+}
+
+static bool write_file(const fs::path& path, const void* data, size_t size)
+{
+    FILE* f = fopen(path.string().c_str(), "wb");
+    const bool ok = f && fwrite(data, 1, size, f) == size;
+    return f && fclose(f) == 0 && ok;
+}
+
+static std::vector<unsigned char> read_file(const fs::path& path)
+{
+    std::vector<unsigned char> data;
+    FILE* f = fopen(path.string().c_str(), "rb");
+    if (!f)
+        return data;
+    unsigned char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+    fclose(f);
+    return data;
+}
+
+// A 64-triangle grid mesh file, as the cooker would write one
+static std::vector<unsigned char> small_mesh(const fs::path& root)
+{
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    for (int y = 0; y < 5; ++y)
+        for (int x = 0; x < 9; ++x)
+            vertices.insert(vertices.end(), { (float)x, (float)y, 0.f });
+    for (int y = 0; y < 4; ++y)
+        for (int x = 0; x < 8; ++x)
+        {
+            const uint32_t a = (uint32_t)(y * 9 + x);
+            indices.insert(indices.end(), { a, a + 1, a + 9, a + 1, a + 10, a + 9 });
+        }
+    const MeshFileAttrib position = { 0, 3, VERTEX_ATTRIB_FLOAT32, 0, 0 };
+    const fs::path path = root / "grid.mesh";
+    if (!mesh_file_write(path.string().c_str(), &position, 1, 12, vertices.data(), (uint32_t)vertices.size() / 3,
+            indices.data(), (uint32_t)indices.size()))
+        return std::vector<unsigned char>();
+    return read_file(path);
+}
+
+static bool package_checks(const fs::path& root, JobSystem* jobs)
+{
+    const std::vector<unsigned char> mesh = small_mesh(root);
+    const std::vector<unsigned char> big = mesh_like(3 * PACKAGE_DEFAULT_BLOCK_SIZE + 12345);
+    const std::vector<unsigned char> noise = random_bytes(PACKAGE_DEFAULT_BLOCK_SIZE + 1, 2);
+    const char small[] = "a small entry, smaller than a block";
+    const PackageInput inputs[5] = { { "models/big.bin", big.data(), big.size() }, { "empty", small, 0 },
+        { "small.txt", small, sizeof(small) }, { "models/grid.mesh", mesh.data(), mesh.size() },
+        { "noise", noise.data(), noise.size() } };
+    const std::string path = (root / "test.pkg").string();
+    PackageWriteResult result;
+    bool ok = !mesh.empty() && package_write(path.c_str(), inputs, 5, PACKAGE_DEFAULT_BLOCK_SIZE, jobs, &result);
+    ok = report("a package writes", ok && result.blocks == 4 + 0 + 1 + 1 + 2 && result.stored_blocks >= 2
+        && result.packed_bytes < result.bytes + 10 * PACKAGE_ALIGN) && ok;
+
+    Package package;
+    ok = ok && package_open(&package, path.c_str());
+    bool aligned = ok, sorted = ok;
+    for (uint32_t b = 0; ok && b < package.header->block_count; ++b)
+        aligned = aligned && package.blocks[b].offset % PACKAGE_ALIGN == 0;
+    for (uint32_t e = 1; ok && e < package.header->entry_count; ++e)
+        sorted = sorted && strcmp(package_entry_name(&package, (int)e - 1), package_entry_name(&package, (int)e)) < 0;
+    ok = report("its blocks are aligned, its entries sorted", aligned && sorted) && ok;
+
+    bool found = ok && package_find(&package, "missing") == -1 && package_find(&package, "") == -1;
+    bool serial = ok, parallel = ok;
+    for (int i = 0; i < 5 && ok; ++i)
+    {
+        const int entry = package_find(&package, inputs[i].name);
+        found = found && entry >= 0 && !strcmp(package_entry_name(&package, entry), inputs[i].name)
+            && package.entries[entry].size == inputs[i].size;
+        if (entry < 0)
+            break;
+        std::vector<unsigned char> a(inputs[i].size + 1), b(inputs[i].size + 1);
+        serial = serial && package_read(&package, entry, a.data(), NULL)
+            && memcmp(a.data(), inputs[i].data, inputs[i].size) == 0;
+        parallel = parallel && package_read(&package, entry, b.data(), jobs)
+            && memcmp(b.data(), inputs[i].data, inputs[i].size) == 0;
+    }
+    ok = report("every entry is found by name", found) && ok;
+    ok = report("entries unpack one block at a time", serial) && ok;
+    ok = report("entries unpack across the job system", parallel) && ok;
+
+    MappedFile file;
+    MeshFile opened;
+    const int grid = ok ? package_find(&package, "models/grid.mesh") : -1;
+    const bool extracted = grid >= 0 && package_extract(&package, grid, &file, jobs)
+        && mesh_file_open_mapped(&opened, &file, "models/grid.mesh");
+    ok = report("a packaged mesh file opens", extracted && opened.header->vertex_count == 45
+        && opened.header->index_count == 192 && opened.lod_count == 1) && ok;
+    if (extracted)
+        mesh_file_close(&opened);
+    package_close(&package);
+
+    // Failures: a name twice, a package cut short, a block overwritten with garbage
+    const PackageInput twice[2] = { inputs[2], inputs[2] };
+    ok = report("a name given twice is refused",
+        !package_write((root / "twice.pkg").string().c_str(), twice, 2, PACKAGE_DEFAULT_BLOCK_SIZE, NULL, NULL)) && ok;
+    std::vector<unsigned char> bytes = read_file(path);
+    const bool truncated = bytes.size() > PACKAGE_ALIGN && write_file(root / "cut.pkg", bytes.data(), bytes.size() - 1)
+        && !package_open(&package, (root / "cut.pkg").string().c_str());
+    ok = report("a truncated package doesn't open", truncated) && ok;
+
+    bool garbled = package_open(&package, path.c_str());
+    const int entry = garbled ? package_find(&package, "models/big.bin") : -1;
+    garbled = entry >= 0 && package.blocks[package.entries[entry].first_block].codec == PACKAGE_CODEC_LZ4;
+    if (garbled)
+    {
+        const PackageBlock block = package.blocks[package.entries[entry].first_block];
+        package_close(&package);
+        memset(bytes.data() + block.offset + block.packed_size / 2, 0xff, block.packed_size - block.packed_size / 2);
+        std::vector<unsigned char> out(big.size());
+        garbled = write_file(root / "garbled.pkg", bytes.data(), bytes.size())
+            && package_open(&package, (root / "garbled.pkg").string().c_str())
+            && !package_read(&package, entry, out.data(), jobs);
+    }
+    package_close(&package);
+    ok = report("a garbled block fails to unpack", garbled) && ok;
+    return ok;
+}
+
+static bool timing(const fs::path& root, JobSystem* jobs, int mb)
+{
+    const std::vector<unsigned char> payload = mesh_like((size_t)mb << 20);
+    const PackageInput input = { "payload.mesh", payload.data(), payload.size() };
+    const std::string path = (root / "timing.pkg").string();
+    PackageWriteResult result;
+    const double t0 = now_ms();
+    bool ok = package_write(path.c_str(), &input, 1, PACKAGE_DEFAULT_BLOCK_SIZE, jobs, &result);
+    const double t1 = now_ms();
+
+    Package package;
+    ok = ok && package_open(&package, path.c_str());
+    std::vector<unsigned char> out(payload.size());
+    double serial = 0.0, parallel = 0.0;
+    if (ok)
+    {
+        // Pages the package in first, so both runs time decompression and not the disk
+        ok = package_read(&package, 0, out.data(), NULL);
+        const double t2 = now_ms();
+        ok = ok && package_read(&package, 0, out.data(), NULL);
+        const double t3 = now_ms();
+        memset(out.data(), 0, out.size());
+        ok = ok && package_read(&package, 0, out.data(), jobs);
+        const double t4 = now_ms();
+        serial = t3 - t2;
+        parallel = t4 - t3;
+        ok = ok && out == payload;
+    }
+    package_close(&package);
+    ok = report("a payload packs and unpacks", ok) && ok;
+    const double gb = payload.size() / 1e9;
+    printf("  %d MB mesh-like: packed to %.1f%% in %.1f ms on %d threads (%u of %u blocks stored)\n", mb,
+        100.0 * result.packed_bytes / payload.size(), t1 - t0, jobs->thread_count, result.stored_blocks, result.blocks);
+    printf("  unpacked in %.1f ms on one thread (%.2f GB/s), %.1f ms on %d (%.2f GB/s)\n", serial, gb / (serial / 1000.0),
+        parallel, jobs->thread_count, gb / (parallel / 1000.0));
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int mb = argc > 1 ? atoi(argv[1]) : 64;
+    const fs::path root = fs::temp_directory_path() / "package_bench";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root, ec);
+    JobSystem jobs;
+    if (!job_system_init(&jobs, 0))
+    {
+        fprintf(stderr, "package_bench: can't start the job system\n");
+        return 1;
+    }
+    bool ok = lz4_checks();
+    ok = package_checks(root, &jobs) && ok;
+    ok = timing(root, &jobs, mb > 0 ? mb : 1) && ok;
+    job_system_destroy(&jobs);
+    fs::remove_all(root, ec);
+    printf("%s\n", ok ? "package_bench: ok" : "package_bench: FAIL");
+    return ok ? 0 : 1;
+}
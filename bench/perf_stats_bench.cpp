@@ -0,0 +1,138 @@
+// Regression statistics check (src/core/perf_stats.h): summaries and intervals against worked values, comparisons
+// that must and mustn't flag, then many simulated harness runs: how often two sets of runs of the same build are
+// called a regression (the false alarm rate, which the confidence bounds), and how often a real 10% slowdown is
+// caught (and a 5% threshold's effect on both), for the run counts the harness uses.
+//
+// Usage: perf_stats_bench [trials]
+
+#include "core/perf_stats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static bool near(double a, double b, double tolerance)
+{
+    return fabs(a - b) <= tolerance;
+}
+
+// xorshift64* and Box-Muller: normal samples, the same on every machine
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static double uniform()
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return ((rng_state * 2685821657736338717ull) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double normal(double mean, double stddev)
+{
+    const double u = uniform(), v = uniform();
+    return mean + stddev * sqrt(-2.0 * log(u > 0.0 ? u : 1e-300)) * cos(6.283185307179586 * v);
+}
+
+static void simulate(PerfSummary* s, uint32_t runs, double mean, double stddev)
+{
+    double samples[64];
+    for (uint32_t i = 0; i < runs; ++i)
+        samples[i] = normal(mean, stddev);
+    perf_summarise(s, samples, runs);
+}
+
+// The share of "trials" comparisons of "runs" runs each that come out regressed, for a true slowdown of "shift"
+// with 3% run-to-run noise
+static double regressed_rate(uint32_t runs, double shift, double confidence, double threshold, int trials)
+{
+    int regressed = 0;
+    for (int t = 0; t < trials; ++t)
+    {
+        PerfSummary baseline, current;
+        PerfComparison c;
+        simulate(&baseline, runs, 10.0, 0.3);
+        simulate(&current, runs, 10.0 * (1.0 + shift), 0.3);
+        perf_compare(&baseline, &current, confidence, threshold, &c);
+        regressed += c.verdict == PERF_REGRESSED;
+    }
+    return (double)regressed / trials;
+}
+
+int main(int argc, char** argv)
+{
+    const int trials = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 20000;
+    bool ok = true;
+
+    const double samples[] = { 2, 4, 4, 4, 5, 5, 7, 9 };
+    PerfSummary s;
+    perf_summarise(&s, samples, 8);
+    ok = report("mean and sample standard deviation", s.n == 8 && near(s.mean, 5.0, 1e-12)
+        && near(s.stddev, sqrt(32.0 / 7.0), 1e-12)) && ok;
+    perf_summarise(&s, samples, 1);
+    ok = report("one sample has no spread and no interval", s.stddev == 0.0 && perf_interval(&s, 0.95) == 0.0) && ok;
+    ok = report("t quantiles from the table, rounded down to it", near(perf_t_critical(0.95, 4), 2.776, 1e-9)
+        && near(perf_t_critical(0.99, 9.7), 3.250, 1e-9) && near(perf_t_critical(0.95, 35), 2.042, 1e-9)
+        && near(perf_t_critical(0.99, 1e6), 2.617, 1e-9) && near(perf_t_critical(0.95, 0.5), 12.706, 1e-9)) && ok;
+    perf_summarise(&s, samples, 8);
+    ok = report("the interval is t times the standard error",
+        near(perf_interval(&s, 0.95), 2.365 * sqrt(32.0 / 7.0) / sqrt(8.0), 1e-9)) && ok;
+
+    const double base[] = { 10.0, 10.1, 9.9, 10.05, 9.95 };
+    const double slower[] = { 11.5, 11.6, 11.4, 11.55, 11.45 };
+    const double slightly[] = { 10.3, 10.4, 10.2, 10.35, 10.25 };
+    const double noisy[] = { 8.0, 14.0, 9.0, 15.0, 12.0 };
+    const double faster[] = { 8.0, 8.1, 7.9, 8.05, 7.95 };
+    PerfSummary b, c;
+    PerfComparison r;
+    perf_summarise(&b, base, 5);
+    perf_summarise(&c, slower, 5);
+    perf_compare(&b, &c, 0.99, 0.05, &r);
+    ok = report("a clean 15% slowdown regresses", r.verdict == PERF_REGRESSED && near(r.change, 0.15, 1e-9)
+        && r.t > r.critical) && ok;
+    perf_summarise(&c, slightly, 5);
+    perf_compare(&b, &c, 0.99, 0.05, &r);
+    ok = report("a significant 3% one is under the threshold", r.verdict == PERF_SAME) && ok;
+    perf_compare(&b, &c, 0.99, 0.0, &r);
+    ok = report("and regresses without one", r.verdict == PERF_REGRESSED) && ok;
+    perf_summarise(&c, noisy, 5);
+    perf_compare(&b, &c, 0.99, 0.05, &r);
+    ok = report("a 16% shift within the noise isn't significant", r.verdict == PERF_SAME && r.change > 0.15) && ok;
+    perf_summarise(&c, faster, 5);
+    perf_compare(&b, &c, 0.99, 0.05, &r);
+    ok = report("a 20% speed-up improves", r.verdict == PERF_IMPROVED && r.t < 0.0) && ok;
+    perf_compare(&b, &b, 0.99, 0.0, &r);
+    ok = report("a build against itself is the same", r.verdict == PERF_SAME) && ok;
+    PerfSummary one_a, one_b;
+    perf_summarise(&one_a, base, 1);
+    perf_summarise(&one_b, slower, 1);
+    perf_compare(&one_a, &one_b, 0.99, 0.05, &r);
+    ok = report("single runs fall back to the threshold", r.verdict == PERF_REGRESSED) && ok;
+
+    printf("%d simulated comparisons each, 3%% noise between runs:\n", trials);
+    printf("  %4s %22s %22s %22s\n", "runs", "false alarms at 95%", "false alarms at 99%", "10% slowdowns caught");
+    bool bounded = true, caught = true;
+    for (uint32_t runs = 3; runs <= 10; runs += runs < 5 ? 2 : 5)
+    {
+        const double alarm95 = regressed_rate(runs, 0.0, 0.95, 0.0, trials);
+        const double alarm99 = regressed_rate(runs, 0.0, 0.99, 0.0, trials);
+        const double power = regressed_rate(runs, 0.10, 0.99, 0.05, trials);
+        printf("  %4u %21.2f%% %21.2f%% %21.1f%%\n", runs, 100.0 * alarm95, 100.0 * alarm99, 100.0 * power);
+        // One-sided, so about half of each two-sided level; the table's rounding only makes it rarer
+        bounded = bounded && alarm95 < 0.035 && alarm99 < 0.01;
+        caught = caught && (runs < 5 || power > 0.8);
+    }
+    ok = report("false alarms stay within the confidence level", bounded) && ok;
+    ok = report("5 or more runs catch a 10% slowdown 4 times in 5", caught) && ok;
+    const double guarded = regressed_rate(5, 0.0, 0.99, 0.05, trials);
+    printf("  5 runs at 99%% with a 5%% threshold: %.3f%% false alarms\n", 100.0 * guarded);
+    ok = report("the threshold cuts false alarms further", guarded < 0.002) && ok;
+
+    printf("%s\n", ok ? "all checks passed" : "some checks FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
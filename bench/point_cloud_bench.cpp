@@ -0,0 +1,173 @@
+// Point cloud check (src/core/point_cloud.h): binning keeps every point once, in the tile of its cell; positions
+// come back within half a quantisation step and inside the tile's bounds; a prefix of a tile is spread over it
+// like the whole tile. Then times the build and shows what decimation leaves of the cloud at a few zooms of a
+// 1920x1080 view.
+//
+// Usage: point_cloud_bench [points]
+
+#include "core/point_cloud.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static inline uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16; x *= 0x7FEB352Du; x ^= x >> 15; x *= 0x846CA68Bu; x ^= x >> 16;
+    return x;
+}
+
+// Traces across [-2, 2] x [-1, 1] like the app's telemetry, and the index in the colour to tell the points apart
+static void traces(void* user, size_t first, size_t count, float* x, float* y, uint32_t* color)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t h0 = hash((uint32_t)(first + i)), h1 = hash(h0);
+        const float u0 = (h0 >> 8) * (1.f / 16777216.f), u1 = (h1 >> 8) * (1.f / 16777216.f);
+        const int channel = (int)(h1 % 16);
+        x[i] = -2.f + 4.f * u0;
+        y[i] = -0.9f + 0.12f * channel + 0.04f * sinf(x[i] * (3.f + channel)) + 0.012f * (u1 - 0.5f);
+        color[i] = (uint32_t)(first + i);
+    }
+}
+
+static bool check_points(const PointCloud* cloud, size_t count)
+{
+    // Every index once
+    unsigned char* seen = (unsigned char*)calloc(count, 1);
+    bool once = cloud->point_count == count;
+    uint32_t total = 0;
+    for (uint32_t t = 0; t < cloud->tile_count; ++t)
+    {
+        once = once && cloud->tiles[t].first == total;
+        total += cloud->tiles[t].count;
+    }
+    for (uint32_t i = 0; i < cloud->point_count && once; ++i)
+    {
+        const uint32_t index = cloud->records[i].color;
+        once = index < count && !seen[index];
+        if (once)
+            seen[index] = 1;
+    }
+    once = once && total == count;
+
+    // Each where the source put it
+    float* x = (float*)malloc(sizeof(float) * POINT_CLOUD_CHUNK);
+    float* y = (float*)malloc(sizeof(float) * POINT_CLOUD_CHUNK);
+    uint32_t* color = (uint32_t*)malloc(sizeof(uint32_t) * POINT_CLOUD_CHUNK);
+    float* sx = (float*)malloc(sizeof(float) * count);
+    float* sy = (float*)malloc(sizeof(float) * count);
+    for (size_t first = 0; first < count; first += POINT_CLOUD_CHUNK)
+    {
+        const size_t n = count - first < POINT_CLOUD_CHUNK ? count - first : POINT_CLOUD_CHUNK;
+        traces(NULL, first, n, x, y, color);
+        memcpy(sx + first, x, sizeof(float) * n);
+        memcpy(sy + first, y, sizeof(float) * n);
+    }
+    double worst = 0.0;
+    bool inside = true;
+    for (uint32_t t = 0; t < cloud->tile_count && once; ++t)
+    {
+        const PointCloudTile* tile = &cloud->tiles[t];
+        for (uint32_t i = tile->first; i < tile->first + tile->count; ++i)
+        {
+            const PointRecord* r = &cloud->records[i];
+            const float px = tile->origin[0] + r->pos[0] / 65535.f * tile->size[0];
+            const float py = tile->origin[1] + r->pos[1] / 65535.f * tile->size[1];
+            const double ex = fabs(px - sx[r->color]) / (tile->size[0] / 65535.0);
+            const double ey = fabs(py - sy[r->color]) / (tile->size[1] / 65535.0);
+            worst = ex > worst ? ex : ey > worst ? ey : worst;
+            const float* b = tile->bounds;
+            inside = inside && sx[r->color] >= b[0] && sx[r->color] <= b[2] && sy[r->color] >= b[1] && sy[r->color] <= b[3];
+        }
+    }
+    printf("  %u tiles (%dx%d cells), error at most %.3f of a step\n", cloud->tile_count, cloud->grid[0], cloud->grid[1],
+        worst);
+    free(sx);
+    free(sy);
+    free(x);
+    free(y);
+    free(color);
+    free(seen);
+    return report("every point once, where it was", once && inside && worst <= 0.75);    // half a step, and float rounding
+}
+
+// The fullest tile: its first sixteenth over a 4x4 split of the cell, against all of it. A prefix taken in the
+// order the source gave would be a narrow strip of its x range instead.
+static bool check_prefix(const PointCloud* cloud)
+{
+    const PointCloudTile* tile = &cloud->tiles[0];
+    for (uint32_t t = 1; t < cloud->tile_count; ++t)
+        tile = cloud->tiles[t].count > tile->count ? &cloud->tiles[t] : tile;
+    double all[16] = { 0 }, prefix[16] = { 0 };
+    const uint32_t sample = tile->count / 16;
+    for (uint32_t i = 0; i < tile->count; ++i)
+    {
+        const PointRecord* r = &cloud->records[tile->first + i];
+        const int bin = (r->pos[1] >> 14) * 4 + (r->pos[0] >> 14);
+        all[bin] += 1.0 / tile->count;
+        if (i < sample)
+            prefix[bin] += 1.0 / sample;
+    }
+    double worst = 0.0;
+    for (int b = 0; b < 16; ++b)
+        worst = fabs(prefix[b] - all[b]) > worst ? fabs(prefix[b] - all[b]) : worst;
+    printf("  largest tile %u points; its first %u off by at most %.4f of the points in a sixteenth of it\n",
+        tile->count, sample, worst);
+    return report("prefixes sample the whole tile", sample >= 256 && worst < 0.02);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? (size_t)atof(argv[1]) : 10000000;
+    const float bounds[4] = { -2.f, -1.f, 2.f, 1.f };
+    PointCloud cloud;
+    double t = now_ms();
+    if (!point_cloud_build(&cloud, traces, NULL, count, bounds))
+    {
+        printf("  can't build %zu points\n", count);
+        return EXIT_FAILURE;
+    }
+    const double build_ms = now_ms() - t;
+    bool ok = check_points(&cloud, count);
+    ok = check_prefix(&cloud) && ok;
+
+    // The camera's orthographic view at each zoom, about the centre, at one point a pixel
+    const int width = 1920, height = 1080;
+    const float ratio = (float)width / height;
+    bool bounded = true;
+    for (float zoom = 1.f; zoom <= 64.f; zoom *= 4.f)
+    {
+        const float view[4] = { -ratio / zoom, -1.f / zoom, ratio / zoom, 1.f / zoom };
+        uint64_t target = 0;
+        uint32_t visible = 0;
+        for (uint32_t i = 0; i < cloud.tile_count; ++i)
+        {
+            const uint32_t n = point_cloud_target(&cloud.tiles[i], view, width, height, 1.f);
+            target += n;
+            visible += n > 0;
+        }
+        printf("  zoom %6.0f: %u tiles in view, %llu points drawn (%.2f%% of the cloud, %.2f a pixel)\n", zoom, visible,
+            (unsigned long long)target, 100.0 * target / count, (double)target / (width * height));
+        bounded = bounded && target <= 2ull * width * height;
+    }
+    ok = report("drawn points follow the screen", bounded) && ok;
+    printf("  %zu points: %.0f ms to build, %.1f MB (%zu bytes a point)\n", count, build_ms,
+        (sizeof(PointRecord) * cloud.point_count + sizeof(PointCloudTile) * cloud.tile_count) / 1048576.0,
+        sizeof(PointRecord));
+    point_cloud_destroy(&cloud);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
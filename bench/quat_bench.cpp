@@ -0,0 +1,365 @@
+// Quaternion batch check: the linmath_quat.h kernels against double-precision slerp and their linmath.h
+// counterparts, failing when any result is outside the bounds documented there, then each batch timed against
+// the per-element loop it replaces. Build the scalar variant (LINMATH_NO_SIMD) to check the fallback code as well.
+//
+// Usage: quat_bench [elements] [reps]
+
+#include "linmath_quat.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SLERP_NEAR_BOUND 1.5e-6     // up to 120 degrees apart: the series' 1e-6 and a few roundings
+#define SLERP_FAR_BOUND 3e-5        // anything up to a half turn
+#define KERNEL_BOUND 1e-6           // the batches against linmath.h's one-at-a-time functions
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static float frand(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(*state >> 8) / 16777216.f;    // [0, 1)
+}
+
+static bool report(const char* what, double worst, double bound)
+{
+    const bool ok = worst <= bound;
+    printf("  %-40s %10.3g  (bound %.3g)  %s\n", what, worst, bound, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// A unit quaternion "angle" radians about a random axis from "from"'s
+static void quat_turned(quat r, quat const from, float angle, unsigned int* state)
+{
+    vec3 axis = { frand(state) - .5f, frand(state) - .5f, frand(state) - .5f };
+    quat turn;
+    axis[2] += axis[2] < 0.f ? -.1f : .1f;
+    quat_rotate(turn, angle, axis);
+    quat_mul(r, turn, from);
+    quat_norm(r, r);
+}
+
+static const quat identity = { 0.f, 0.f, 0.f, 1.f };
+
+// Quaternions as arrays per component, over one allocation: each array starts 16-byte aligned
+struct SoaQuats
+{
+    std::vector<float> data;
+    quat_soa q;
+
+    explicit SoaQuats(size_t n) : data(4 * ((n + 3) & ~(size_t)3))
+    {
+        const size_t stride = (n + 3) & ~(size_t)3;
+        q.x = data.data();
+        q.y = q.x + stride;
+        q.z = q.y + stride;
+        q.w = q.z + stride;
+    }
+    void set(size_t i, quat const v) { q.x[i] = v[0]; q.y[i] = v[1]; q.z[i] = v[2]; q.w[i] = v[3]; }
+    void get(size_t i, quat v) const { v[0] = q.x[i]; v[1] = q.y[i]; v[2] = q.z[i]; v[3] = q.w[i]; }
+};
+
+static double quat_distance(quat const a, const double b[4])
+{
+    double d = 0.;
+    for (int k = 0; k < 4; ++k)
+        d = fmax(d, fabs(a[k] - b[k]));
+    return d;
+}
+
+// Slerp against the exact one in double, pairs from 0 to "max_angle" apart, a quarter of them the long way round
+static bool check_slerp(unsigned int* state, float max_angle, double bound, const char* scalar_name, const char* batch_name)
+{
+    const size_t n = 4096;
+    SoaQuats a(n), b(n), r(n);
+    std::vector<float> t(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        quat qa, qb;
+        quat_turned(qa, identity, frand(state) * 6.2831853f, state);
+        quat_turned(qb, qa, max_angle * (float)i / (float)(n - 1), state);
+        if (i % 4 == 3)
+            quat_scale(qb, qb, -1.f);
+        a.set(i, qa);
+        b.set(i, qb);
+    }
+    double scalar = 0., batch = 0.;
+    for (int step = 0; step <= 8; ++step)
+    {
+        const float weight = step / 8.f;
+        quat_slerp_soa(r.q, a.q, b.q, weight, n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            quat qa, qb, qr, qs;
+            a.get(i, qa);
+            b.get(i, qb);
+            r.get(i, qr);
+            double dot = 0.;
+            for (int k = 0; k < 4; ++k)
+                dot += (double)qa[k] * qb[k];
+            const double sign = dot < 0. ? -1. : 1.;
+            const double theta = acos(fmin(1., fabs(dot)));
+            const double wa = theta < 1e-9 ? 1. - weight : sin((1. - weight) * theta) / sin(theta);
+            const double wb = theta < 1e-9 ? weight : sin(weight * theta) / sin(theta);
+            double exact[4];
+            for (int k = 0; k < 4; ++k)
+                exact[k] = wa * qa[k] + sign * wb * qb[k];
+            quat_slerp(qs, qa, qb, weight);
+            scalar = fmax(scalar, quat_distance(qs, exact));
+            batch = fmax(batch, quat_distance(qr, exact));
+        }
+    }
+    const bool x = report(scalar_name, scalar, bound);
+    const bool y = report(batch_name, batch, bound);
+    return x && y;
+}
+
+// The other batches against linmath.h, and the matrix round trip
+static bool check_kernels(unsigned int* state)
+{
+    const size_t n = 4099;     // a scalar tail after the four-wide loop
+    SoaQuats a(n), b(n), r(n);
+    std::vector<float> tx(n), ty(n), tz(n);
+    std::vector<mat4x4> m4(n);
+    std::vector<mat3x4> m3(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        quat qa, qb;
+        quat_turned(qa, identity, frand(state) * 6.2831853f, state);
+        quat_turned(qb, qa, frand(state) * 6.2831853f, state);
+        a.set(i, qa);
+        b.set(i, qb);
+        tx[i] = frand(state) * 10.f;
+        ty[i] = frand(state) * 10.f;
+        tz[i] = frand(state) * 10.f;
+    }
+
+    double mul = 0., nlerp = 0., to4 = 0., to3 = 0., from = 0., from_linmath = 0.;
+    quat_mul_soa(r.q, a.q, b.q, n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        quat qa, qb, qr, e;
+        a.get(i, qa);
+        b.get(i, qb);
+        r.get(i, qr);
+        quat_mul(e, qa, qb);
+        for (int k = 0; k < 4; ++k)
+            mul = fmax(mul, fabs(qr[k] - e[k]));
+    }
+    quat_nlerp_soa(r.q, a.q, b.q, .3f, n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        quat qa, qb, qr, e;
+        a.get(i, qa);
+        b.get(i, qb);
+        r.get(i, qr);
+        quat_nlerp(e, qa, qb, .3f);
+        for (int k = 0; k < 4; ++k)
+            nlerp = fmax(nlerp, fabs(qr[k] - e[k]));
+    }
+    quat_to_mat4x4_soa(m4.data(), a.q, n);
+    quat_to_mat3x4_soa(m3.data(), a.q, tx.data(), ty.data(), tz.data(), n);
+    quat_from_mat4x4_soa(r.q, m4.data(), n);
+    double from_batch = 0.;
+    for (size_t i = 0; i < n; ++i)
+    {
+        quat qa, back;
+        mat4x4 e;
+        a.get(i, qa);
+        mat4x4_from_quat(e, qa);
+        for (int c = 0; c < 4; ++c)
+            for (int k = 0; k < 4; ++k)
+            {
+                to4 = fmax(to4, fabs(m4[i][c][k] - e[c][k]));
+                // mat3x4 is the transpose of the upper three rows, with the translation
+                if (k < 3)
+                    to3 = fmax(to3, fabs(m3[i][k][c] - (c < 3 ? e[c][k] : k == 0 ? tx[i] : k == 1 ? ty[i] : tz[i])));
+            }
+
+        // Back from the matrix: the same rotation, either sign
+        quat_from_mat4x4_fast(back, e);
+        const float d = quat_mul_inner(back, qa) < 0.f ? -1.f : 1.f;
+        for (int k = 0; k < 4; ++k)
+            from = fmax(from, fabs(back[k] * d - qa[k]));
+        r.get(i, back);
+        const float db = quat_mul_inner(back, qa) < 0.f ? -1.f : 1.f;
+        for (int k = 0; k < 4; ++k)
+            from_batch = fmax(from_batch, fabs(back[k] * db - qa[k]));
+        quat_from_mat4x4(back, e);
+        const float dl = quat_mul_inner(back, qa) < 0.f ? -1.f : 1.f;
+        for (int k = 0; k < 4; ++k)
+            from_linmath = fmax(from_linmath, fabs(back[k] * dl - qa[k]));
+    }
+
+    // Half turns, where w and up to two of x, y and z vanish, and no turn at all: through both, four-wide
+    const quat edges[] = { { 1.f, 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f, 0.f }, { 0.f, 0.f, 0.f, 1.f },
+        { .70710678f, .70710678f, 0.f, 0.f }, { 0.f, .6f, .8f, 0.f }, { .5f, .5f, .5f, .5f }, { 0.f, 0.f, .6f, .8f } };
+    const size_t edge_count = sizeof(edges) / sizeof(edges[0]);
+    for (size_t i = 0; i < edge_count; ++i)
+        mat4x4_from_quat(m4[i], edges[i]);
+    quat_from_mat4x4_soa(r.q, m4.data(), edge_count);
+    for (size_t i = 0; i < edge_count; ++i)
+    {
+        quat back, batch;
+        quat_from_mat4x4_fast(back, m4[i]);
+        r.get(i, batch);
+        const float d = quat_mul_inner(back, edges[i]) < 0.f ? -1.f : 1.f;
+        const float db = quat_mul_inner(batch, edges[i]) < 0.f ? -1.f : 1.f;
+        for (int k = 0; k < 4; ++k)
+        {
+            from = fmax(from, fabs(back[k] * d - edges[i][k]));
+            from_batch = fmax(from_batch, fabs(batch[k] * db - edges[i][k]));
+        }
+    }
+
+    bool ok = report("quat_mul_soa vs quat_mul", mul, KERNEL_BOUND);
+    ok = report("quat_nlerp_soa vs quat_nlerp", nlerp, KERNEL_BOUND) && ok;
+    ok = report("quat_to_mat4x4_soa vs mat4x4_from_quat", to4, KERNEL_BOUND) && ok;
+    ok = report("quat_to_mat3x4_soa vs mat4x4_from_quat", to3, KERNEL_BOUND) && ok;
+    ok = report("quat_from_mat4x4_fast round trip", from, KERNEL_BOUND) && ok;
+    ok = report("quat_from_mat4x4_soa round trip", from_batch, KERNEL_BOUND) && ok;
+    printf("  %-40s %10.3g  (linmath.h, for comparison)\n", "quat_from_mat4x4 round trip", from_linmath);
+    return ok;
+}
+
+typedef struct TimingData
+{
+    std::vector<quat> a, b, r;
+    SoaQuats sa, sb, sr;
+    std::vector<mat4x4> m4;
+    std::vector<mat3x4> m3;
+    std::vector<float> tx, ty, tz;
+
+    explicit TimingData(size_t n) : a(n), b(n), r(n), sa(n), sb(n), sr(n), m4(n), m3(n), tx(n), ty(n), tz(n) {}
+} TimingData;
+
+static double time_ns(void (*body)(TimingData*), TimingData* d, int reps)
+{
+    body(d);    // warm up
+    const double start = now_ms();
+    for (int r = 0; r < reps; ++r)
+        body(d);
+    return (now_ms() - start) * 1e6 / ((double)reps * (double)d->a.size());
+}
+
+static void loop_mul(TimingData* d)
+{
+    for (size_t i = 0; i < d->a.size(); ++i)
+        quat_mul(d->r[i], d->a[i], d->b[i]);
+}
+static void soa_mul(TimingData* d) { quat_mul_soa(d->sr.q, d->sa.q, d->sb.q, d->a.size()); }
+static void loop_nlerp(TimingData* d)
+{
+    for (size_t i = 0; i < d->a.size(); ++i)
+        quat_nlerp(d->r[i], d->a[i], d->b[i], .3f);
+}
+static void soa_nlerp(TimingData* d) { quat_nlerp_soa(d->sr.q, d->sa.q, d->sb.q, .3f, d->a.size()); }
+// Textbook slerp through acosf and sinf
+static void loop_slerp(TimingData* d)
+{
+    for (size_t i = 0; i < d->a.size(); ++i)
+    {
+        const float dot = quat_mul_inner(d->a[i], d->b[i]);
+        const float theta = acosf(fminf(1.f, fabsf(dot)));
+        const float s = sinf(theta);
+        const float wa = s > 1e-6f ? sinf(.7f * theta) / s : .7f;
+        const float wb = (s > 1e-6f ? sinf(.3f * theta) / s : .3f) * (dot < 0.f ? -1.f : 1.f);
+        for (int k = 0; k < 4; ++k)
+            d->r[i][k] = d->a[i][k] * wa + d->b[i][k] * wb;
+    }
+}
+static void soa_slerp(TimingData* d) { quat_slerp_soa(d->sr.q, d->sa.q, d->sb.q, .3f, d->a.size()); }
+static void loop_to_mat4x4(TimingData* d)
+{
+    for (size_t i = 0; i < d->a.size(); ++i)
+        mat4x4_from_quat(d->m4[i], d->a[i]);
+}
+static void soa_to_mat4x4(TimingData* d) { quat_to_mat4x4_soa(d->m4.data(), d->sa.q, d->a.size()); }
+static void loop_to_mat3x4(TimingData* d)
+{
+    for (size_t i = 0; i < d->a.size(); ++i)
+    {
+        const vec3 t = { d->tx[i], d->ty[i], d->tz[i] };
+        quat_to_mat3x4(d->m3[i], d->a[i], t);
+    }
+}
+static void soa_to_mat3x4(TimingData* d)
+{
+    quat_to_mat3x4_soa(d->m3.data(), d->sa.q, d->tx.data(), d->ty.data(), d->tz.data(), d->a.size());
+}
+static void loop_from_mat4x4(TimingData* d)
+{
+    for (size_t i = 0; i < d->a.size(); ++i)
+        quat_from_mat4x4_fast(d->r[i], d->m4[i]);
+}
+static void soa_from_mat4x4(TimingData* d) { quat_from_mat4x4_soa(d->sr.q, d->m4.data(), d->a.size()); }
+
+int main(int argc, char** argv)
+{
+    const size_t elements = argc > 1 ? (size_t)atol(argv[1]) : 4096;
+    const int reps = argc > 2 ? atoi(argv[2]) : 2000;
+    if (elements == 0 || reps <= 0)
+    {
+        fprintf(stderr, "usage: %s [elements] [reps]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("accuracy (%s)\n", LINMATH_H_SIMD == LINMATH_H_SIMD_NONE ? "scalar" : "simd");
+    unsigned int state = 12345u;
+    bool ok = check_slerp(&state, 2.0943951f, SLERP_NEAR_BOUND, "quat_slerp to 120 degrees", "quat_slerp_soa to 120 degrees");
+    ok = check_slerp(&state, 3.1415927f, SLERP_FAR_BOUND, "quat_slerp to a half turn", "quat_slerp_soa to a half turn") && ok;
+    ok = check_kernels(&state) && ok;
+
+    TimingData d(elements);
+    for (size_t i = 0; i < elements; ++i)
+    {
+        quat_turned(d.a[i], identity, frand(&state) * 6.2831853f, &state);
+        quat_turned(d.b[i], d.a[i], frand(&state) * 1.5f, &state);
+        d.sa.set(i, d.a[i]);
+        d.sb.set(i, d.b[i]);
+        d.tx[i] = frand(&state);
+        d.ty[i] = frand(&state);
+        d.tz[i] = frand(&state);
+    }
+    loop_to_mat4x4(&d);
+    const struct
+    {
+        const char* name;
+        void (*loop)(TimingData*);
+        void (*batch)(TimingData*);
+    } kernels[] =
+    {
+        { "mul", loop_mul, soa_mul },
+        { "nlerp", loop_nlerp, soa_nlerp },
+        { "slerp (libm loop)", loop_slerp, soa_slerp },
+        { "to mat4x4", loop_to_mat4x4, soa_to_mat4x4 },
+        { "to mat3x4", loop_to_mat3x4, soa_to_mat3x4 },
+        { "from mat4x4", loop_from_mat4x4, soa_from_mat4x4 },
+    };
+    printf("%zu elements, ns/element       loop     batch   speedup\n", elements);
+    for (const auto& k : kernels)
+    {
+        const double loop_ns = time_ns(k.loop, &d, reps);
+        const double batch_ns = time_ns(k.batch, &d, reps);
+        printf("  %-31s %8.3f  %8.3f  %7.2fx\n", k.name, loop_ns, batch_ns, loop_ns / batch_ns);
+    }
+
+    // The scalar conversion's pivot branch is learnt over a few thousand repeated matrices; over more than the
+    // predictor holds it isn't, which the batch doesn't mind
+    const size_t many = 1 << 18;
+    TimingData u(many);
+    for (size_t i = 0; i < many; ++i)
+        quat_turned(u.a[i], identity, frand(&state) * 6.2831853f, &state);
+    loop_to_mat4x4(&u);
+    const int many_reps = (int)(reps * elements / many) > 0 ? (int)(reps * elements / many) : 1;
+    const double loop_ns = time_ns(loop_from_mat4x4, &u, many_reps);
+    const double batch_ns = time_ns(soa_from_mat4x4, &u, many_reps);
+    printf("  %-31s %8.3f  %8.3f  %7.2fx\n", "from mat4x4, 2^18 of them", loop_ns, batch_ns, loop_ns / batch_ns);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
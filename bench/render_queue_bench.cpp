@@ -0,0 +1,146 @@
+// Render queue sort: fills a queue with random draws (64 programs, 256 materials, 16 vertex arrays, random
+// depth), checks render_queue_sort against std::stable_sort, and times it serially and on 1..N threads.
+// Also counts the program / material / VAO switches a submission in queue order would make.
+//
+// Usage: render_queue_bench [entries] [max threads]
+
+#include "core/job_system.h"
+#include "core/render_queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+static uint32_t random_u32(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void fill(RenderQueue* q, const std::vector<RenderQueueEntry>& draws)
+{
+    render_queue_clear(q);
+    RenderQueueEntry* e = render_queue_reserve(q, draws.size());
+    std::copy(draws.begin(), draws.end(), e);
+}
+
+// State changes a submission loop would make, walking the entries in order
+static void count_switches(const RenderQueueEntry* e, size_t n, size_t* programs, size_t* materials, size_t* vaos)
+{
+    *programs = *materials = *vaos = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const uint64_t key = e[i].key;
+        const uint64_t prev = i ? e[i - 1].key : ~key;
+        *programs += RENDER_KEY_FIELD(key, PROGRAM) != RENDER_KEY_FIELD(prev, PROGRAM);
+        *materials += RENDER_KEY_FIELD(key, MATERIAL) != RENDER_KEY_FIELD(prev, MATERIAL);
+        *vaos += RENDER_KEY_FIELD(key, VAO) != RENDER_KEY_FIELD(prev, VAO);
+    }
+}
+
+static bool matches(const RenderQueue* q, const std::vector<RenderQueueEntry>& expected)
+{
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        if (q->entries[i].key != expected[i].key || q->entries[i].payload != expected[i].payload)
+        {
+            fprintf(stderr, "  mismatch at %zu\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t entries = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    const int max_threads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    const int runs = 20;
+
+    // Two passes (opaque near-to-far, transparent far-to-near), and duplicate keys so stability is observable
+    std::vector<RenderQueueEntry> draws(entries);
+    unsigned int state = 12345u;
+    for (size_t i = 0; i < entries; ++i)
+    {
+        const uint32_t pass = random_u32(&state) % 8 == 0;
+        const uint32_t depth = render_key_depth((float)(random_u32(&state) % 4096) / 4095.f, pass == 1);
+        draws[i].key = render_key(pass, random_u32(&state) % 64, random_u32(&state) % 256, random_u32(&state) % 16, depth);
+        draws[i].payload = (uint32_t)i;
+        draws[i].reserved = 0;
+    }
+    std::vector<RenderQueueEntry> expected = draws;
+    std::stable_sort(expected.begin(), expected.end(),
+        [](const RenderQueueEntry& a, const RenderQueueEntry& b) { return a.key < b.key; });
+
+    RenderQueue q;
+    if (!render_queue_init(&q, entries))
+        return EXIT_FAILURE;
+
+    size_t programs, materials, vaos;
+    count_switches(draws.data(), entries, &programs, &materials, &vaos);
+    printf("%zu draws, unsorted: %zu program, %zu material, %zu vao switches\n", entries, programs, materials, vaos);
+    fill(&q, draws);
+    render_queue_sort(&q, NULL);
+    count_switches(q.entries, entries, &programs, &materials, &vaos);
+    printf("%zu draws,   sorted: %zu program, %zu material, %zu vao switches\n", entries, programs, materials, vaos);
+
+    bool ok = matches(&q, expected);
+
+    // Depths at and just under 1 keep to the far end of the key range rather than wrapping to the near end
+    const uint32_t depth_max = (1u << RENDER_KEY_DEPTH_BITS) - 1u;
+    const bool depth_ok = render_key_depth(1.f, false) == depth_max && render_key_depth(1.f, true) == 0u
+        && render_key_depth(0.99999f, false) <= depth_max && render_key_depth(0.99999f, false) > depth_max - 256u
+        && render_key_depth(0.99999f, true) >= render_key_depth(1.f, true) && render_key_depth(0.f, false) == 0u;
+    printf("depth keys near 1: %s\n", depth_ok ? "ok" : "MISMATCH");
+    ok = ok && depth_ok;
+
+    // Every timed run refills the queue first; a fill-only loop measures that part to subtract it
+    double start = now_ms();
+    for (int r = 0; r < runs; ++r)
+        fill(&q, draws);
+    const double fill_ms = (now_ms() - start) / runs;
+
+    start = now_ms();
+    for (int r = 0; r < runs; ++r)
+    {
+        fill(&q, draws);
+        render_queue_sort(&q, NULL);
+    }
+    const double serial_ms = (now_ms() - start) / runs - fill_ms;
+    printf("serial   %7.3f ms  %s\n", serial_ms, ok ? "ok" : "MISMATCH");
+
+    printf("threads  sort ms  speedup\n");
+    for (int threads = 1; threads <= max_threads; threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2)
+    {
+        JobSystem js;
+        if (!job_system_init(&js, threads))
+            return EXIT_FAILURE;
+        fill(&q, draws);
+        render_queue_sort(&q, &js);
+        const bool threaded_ok = matches(&q, expected);
+        ok = ok && threaded_ok;
+
+        start = now_ms();
+        for (int r = 0; r < runs; ++r)
+        {
+            fill(&q, draws);
+            render_queue_sort(&q, &js);
+        }
+        const double ms = (now_ms() - start) / runs - fill_ms;
+        job_system_destroy(&js);
+        printf("%7d  %7.3f  %6.2fx  %s\n", threads, ms, serial_ms / ms, threaded_ok ? "ok" : "MISMATCH");
+        if (threads == max_threads)
+            break;
+    }
+
+    render_queue_destroy(&q);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
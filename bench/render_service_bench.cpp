@@ -0,0 +1,321 @@
+// Render service check (src/core/render_service.h), over loopback TCP with the bench standing in for the GPU: client
+// threads send requests of two sizes and read the answers while this thread takes batches and "draws" each image (a
+// fill that says which request it's for). Every request is answered once, with its own image; batches are of one
+// size and hold several requests under load; a bad request is answered as one; a queue flooded while nothing draws
+// answers busy rather than growing; a client that speaks another protocol is dropped. Then the images a second,
+// encoded as PNG, with one encoder and with the pool.
+//
+// Usage: render_service_bench [requests a client] [encoders]
+
+#include "core/render_service.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#endif
+
+#define CLIENTS 4
+#define WINDOW 32               // requests a client has out at once: 4 clients' fit in the queue
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static socket_t connect_to(int port)
+{
+    const socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t)port);
+    if (s != INVALID_SOCKET && connect(s, (const sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close_socket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+static bool receive_all(socket_t s, void* data, size_t size)
+{
+    char* p = (char*)data;
+    while (size > 0)
+    {
+        const int n = (int)recv(s, p, (int)size, 0);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// Request "id"'s: one of two sizes, PNG but every fourth raw
+static void make_request(RenderRequest* request, uint32_t id)
+{
+    memset(request, 0, sizeof(*request));
+    request->id = id;
+    request->width = id % 3 ? 256 : 192;
+    request->height = id % 3 ? 256 : 108;
+    request->format = id % 4 == 3 ? RENDER_SERVICE_RAW : RENDER_SERVICE_PNG;
+    request->fov_y = 0.8f;
+    request->eye[0] = 10.0 + id;
+    request->eye[2] = 5.0;
+}
+
+// What the bench "draws" for a request: its id in every pixel's colour, and a gradient for the encoder to work on
+static uint8_t* draw(const RenderRequest* request)
+{
+    uint8_t* pixels = (uint8_t*)malloc(4 * (size_t)request->width * request->height);
+    for (int y = 0; y < request->height; ++y)
+        for (int x = 0; x < request->width; ++x)
+        {
+            uint8_t* p = pixels + 4 * ((size_t)y * request->width + x);
+            p[0] = (uint8_t)request->id;
+            p[1] = (uint8_t)(request->id >> 8);
+            p[2] = (uint8_t)(x + y);
+            p[3] = 255;
+        }
+    return pixels;
+}
+
+typedef struct Client
+{
+    int port;
+    int requests;
+    uint32_t first_id;
+    std::atomic<int> answered;
+    int wrong;                  // answered with another size, format or id, or not an image of it
+    int duplicates;
+} Client;
+
+static void run_client(Client* c)
+{
+    const socket_t s = connect_to(c->port);
+    if (s == INVALID_SOCKET)
+        return;
+    std::thread sender([c, s] {
+        for (int i = 0; i < c->requests; ++i)
+        {
+            while (i - c->answered.load() >= WINDOW)
+                std::this_thread::yield();
+            RenderRequest request;
+            make_request(&request, c->first_id + (uint32_t)i);
+            uint8_t out[RENDER_SERVICE_REQUEST_BYTES];
+            render_service_write_request(&request, out);
+            send(s, (const char*)out, sizeof(out), 0);
+        }
+    });
+    std::vector<bool> seen((size_t)c->requests, false);
+    std::vector<uint8_t> image;
+    while (c->answered.load() < c->requests)
+    {
+        uint8_t header[RENDER_SERVICE_RESPONSE_BYTES];
+        uint32_t id, size;
+        int status, width, height, format;
+        if (!receive_all(s, header, sizeof(header))
+            || !render_service_read_response(header, &id, &status, &width, &height, &format, &size))
+            break;
+        image.resize(size);
+        if (size && !receive_all(s, image.data(), size))
+            break;
+        RenderRequest expected;
+        make_request(&expected, id);
+        const bool ours = id >= c->first_id && id < c->first_id + (uint32_t)c->requests;
+        bool right = ours && status == RENDER_SERVICE_OK && width == expected.width && height == expected.height
+            && format == expected.format;
+        if (right && format == RENDER_SERVICE_PNG)
+            right = size > 8 && !memcmp(image.data(), "\x89PNG\r\n\x1a\n", 8);
+        else if (right)
+            right = size == 4u * width * height && image[0] == (uint8_t)id && image[1] == (uint8_t)(id >> 8);
+        c->wrong += !right;
+        if (ours)
+        {
+            c->duplicates += seen[id - c->first_id];
+            seen[id - c->first_id] = true;
+        }
+        ++c->answered;
+    }
+    sender.join();
+    close_socket(s);
+}
+
+// The render thread's part until every client has its answers: a batch a frame, "drawn" and completed
+static bool serve(RenderService* svc, Client* clients, int count, int* largest, bool* one_size)
+{
+    const double deadline = now_ms() + 60000.0;
+    RenderRequest batch[RENDER_SERVICE_MAX_BATCH];
+    for (;;)
+    {
+        int answered = 0, wanted = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            answered += clients[i].answered.load();
+            wanted += clients[i].requests;
+        }
+        if (answered == wanted)
+            return true;
+        if (now_ms() > deadline)
+            return false;
+        render_service_poll(svc, 0.002);
+        const int n = render_service_batch(svc, batch, RENDER_SERVICE_MAX_BATCH);
+        *largest = n > *largest ? n : *largest;
+        for (int i = 0; i < n; ++i)
+        {
+            *one_size = *one_size && batch[i].width == batch[0].width && batch[i].height == batch[0].height;
+            render_service_complete(svc, &batch[i], draw(&batch[i]));
+        }
+    }
+}
+
+// Images a second through "encoders" encoders, "requests" from each client
+static double measure(int requests, int* encoders, bool* ok, int* largest, bool* one_size, RenderService* svc)
+{
+    if (!render_service_init(svc, 0, *encoders))
+    {
+        *ok = false;
+        return 0.0;
+    }
+    const int port = render_service_port(svc);
+    static Client clients[CLIENTS];
+    std::thread threads[CLIENTS];
+    const double start = now_ms();
+    for (int i = 0; i < CLIENTS; ++i)
+    {
+        clients[i].port = port;
+        clients[i].requests = requests;
+        clients[i].first_id = (uint32_t)(i * requests);
+        clients[i].answered = clients[i].wrong = clients[i].duplicates = 0;
+        threads[i] = std::thread(run_client, &clients[i]);
+    }
+    const bool finished = serve(svc, clients, CLIENTS, largest, one_size);
+    for (int i = 0; i < CLIENTS; ++i)
+        threads[i].join();
+    const double ms = now_ms() - start;
+    while (finished && svc->served.load() < (uint64_t)requests * CLIENTS && now_ms() < start + ms + 1000.0)
+        std::this_thread::yield();      // the last encoder counting what it sent
+    for (int i = 0; i < CLIENTS; ++i)
+        *ok = *ok && finished && clients[i].answered.load() == requests && !clients[i].wrong && !clients[i].duplicates;
+    render_service_print(svc, stdout);
+    *encoders = svc->encoder_count;
+    render_service_destroy(svc);
+    return 1000.0 * requests * CLIENTS / ms;
+}
+
+int main(int argc, char** argv)
+{
+    const int requests = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 400;
+    int encoders = argc > 2 ? atoi(argv[2]) : 0;
+    RenderService* svc = new RenderService;
+    bool ok = true;
+
+    // Every request answered with its image; batches of one size
+    bool answered = true, one_size = true;
+    int largest = 0;
+    const double pool = measure(requests, &encoders, &answered, &largest, &one_size, svc);
+    ok = report("every request answered once with its image", answered) && ok;
+    ok = report("a batch is of one size", one_size) && ok;
+    printf("  largest batch %d\n", largest);
+    ok = report("batches hold several requests under load", largest > 1) && ok;
+
+    bool single_ok = true, single_size = true;
+    int single_largest = 0;
+    int one = 1;
+    const double single = measure(requests, &one, &single_ok, &single_largest, &single_size, svc);
+    printf("  %.0f images a second with 1 encoder, %.0f with the pool of %d\n", single, pool, encoders);
+    ok = report("one encoder serves them all too", single_ok) && ok;
+
+    // A bad request, a flood while nothing draws, and another protocol
+    if (!render_service_init(svc, 0, 1))
+        return EXIT_FAILURE;
+    const int port = render_service_port(svc);
+    const socket_t s = connect_to(port);
+    RenderRequest bad;
+    make_request(&bad, 7);
+    bad.width = 0;
+    uint8_t out[RENDER_SERVICE_REQUEST_BYTES];
+    render_service_write_request(&bad, out);
+    send(s, (const char*)out, sizeof(out), 0);
+    const int flood = RENDER_SERVICE_QUEUE + 20;
+    for (int i = 0; i < flood; ++i)
+    {
+        RenderRequest request;
+        make_request(&request, 100 + (uint32_t)i);
+        render_service_write_request(&request, out);
+        send(s, (const char*)out, sizeof(out), 0);
+    }
+    int bad_answers = 0, busy = 0, others = 0;
+    for (int answers = 0; answers < 21;)
+    {
+        render_service_poll(svc, 0.01);
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(s, &readable);
+        timeval wait = { 0, 10000 };
+        if (select((int)s + 1, &readable, NULL, NULL, &wait) <= 0)
+            continue;
+        uint8_t header[RENDER_SERVICE_RESPONSE_BYTES];
+        uint32_t id, size;
+        int status, width, height, format;
+        if (!receive_all(s, header, sizeof(header))
+            || !render_service_read_response(header, &id, &status, &width, &height, &format, &size))
+            break;
+        bad_answers += status == RENDER_SERVICE_BAD_REQUEST && id == 7;
+        busy += status == RENDER_SERVICE_BUSY;
+        others += status == RENDER_SERVICE_OK;
+        ++answers;
+    }
+    ok = report("a bad request is answered as one", bad_answers == 1) && ok;
+    ok = report("a flooded queue answers busy, holding the rest", busy == 20 && svc->queue_count == RENDER_SERVICE_QUEUE
+        && others == 0) && ok;
+    close_socket(s);
+
+    const socket_t stranger = connect_to(port);
+    char junk[RENDER_SERVICE_REQUEST_BYTES];
+    memset(junk, 'x', sizeof(junk));
+    send(stranger, junk, sizeof(junk), 0);
+    bool dropped = false;
+    for (int i = 0; i < 100 && !dropped; ++i)
+    {
+        render_service_poll(svc, 0.01);
+        char byte;
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(stranger, &readable);
+        timeval wait = { 0, 10000 };
+        dropped = select((int)stranger + 1, &readable, NULL, NULL, &wait) > 0 && recv(stranger, &byte, 1, 0) <= 0;
+    }
+    ok = report("another protocol's client is dropped", dropped) && ok;
+    close_socket(stranger);
+    render_service_destroy(svc);
+    delete svc;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
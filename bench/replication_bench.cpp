@@ -0,0 +1,486 @@
+// Replication check (src/scene/replication.h, src/core/udp_channel.h): bits and gamma codes come back as written,
+// quantised transforms within a step (and rotations within a fraction of a degree), and a client that loses a
+// fifth of its snapshots and acknowledgements, some arriving out of order, ends up with the server's scene exactly.
+// Then what a snapshot costs: against how many of the objects moved, and against how many there are for the same
+// moves. A client with an area of interest holds what's in it and nothing beyond its margin, following it as it
+// moves; and a server and client on loopback UDP, dropping a tenth of their datagrams, get the reliable setup
+// message across once and the scene across whole.
+//
+// Usage: replication_bench [objects] [frames]
+
+#include "core/udp_channel.h"
+#include "scene/replication.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SPREAD 400.f
+#define ROOM (UDP_CHANNEL_MTU - UDP_CHANNEL_HEADER)
+#define AOI_RADIUS 60.f
+
+static const ReplicationQuantizer quantizer = { 1.f / 512.f, 1.f / 1024.f };
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void random_rotation(unsigned int* random, quat q)
+{
+    float length = 0.f;
+    for (int k = 0; k < 4; ++k)
+    {
+        q[k] = random_float(random, -1.f, 1.f);
+        length += q[k] * q[k];
+    }
+    length = sqrtf(length);
+    for (int k = 0; k < 4; ++k)
+        q[k] /= length;
+}
+
+typedef struct Scene
+{
+    std::vector<trs> objects;
+    std::vector<Aabb> bounds;
+    unsigned int random;
+} Scene;
+
+static void scene_init(Scene* scene, uint32_t count)
+{
+    scene->objects.resize(count);
+    scene->bounds.resize(count);
+    scene->random = 12345u;
+    for (trs& o : scene->objects)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            o.t[k] = random_float(&scene->random, -SPREAD, SPREAD);
+            o.s[k] = 1.f;
+        }
+        random_rotation(&scene->random, o.r);
+    }
+}
+
+// "moving" of the objects take a small step and turn a little; the rest stay put
+static void scene_step(Scene* scene, uint32_t moving)
+{
+    const uint32_t count = (uint32_t)scene->objects.size();
+    for (uint32_t m = 0; m < moving; ++m)
+    {
+        trs& o = scene->objects[(uint32_t)(random_float(&scene->random, 0.f, 1.f) * count) % count];
+        for (int k = 0; k < 3; ++k)
+            o.t[k] += random_float(&scene->random, -0.5f, 0.5f);
+        for (int k = 0; k < 4; ++k)
+            o.r[k] += random_float(&scene->random, -0.02f, 0.02f);
+        quat_norm(o.r, o.r);
+        o.s[0] = o.s[1] = o.s[2] = 1.f + random_float(&scene->random, -0.01f, 0.01f);
+    }
+}
+
+static void scene_bounds(Scene* scene)
+{
+    for (size_t i = 0; i < scene->objects.size(); ++i)
+        for (int k = 0; k < 3; ++k)
+        {
+            scene->bounds[i].min[k] = scene->objects[i].t[k] - 0.5f;
+            scene->bounds[i].max[k] = scene->objects[i].t[k] + 0.5f;
+        }
+}
+
+static bool same_as_server(const ReplicationSender* sender, const ReplicationReceiver* receiver)
+{
+    const ReplicatedTrs* state = replication_receiver_state(receiver);
+    return state && !memcmp(state, sender->current, sizeof(ReplicatedTrs) * sender->count);
+}
+
+// A server and one client in-process: each frame's snapshot is lost with "loss", or held back a frame (and so
+// arrives after the next) with the same chance; the client's acknowledgement of it comes back a frame later, lost
+// as often. Returns the bytes sent.
+typedef struct Link
+{
+    uint8_t held[ROOM];
+    size_t held_bytes;
+    uint16_t held_sequence;
+    bool holding;
+    uint16_t acks[64];
+    int ack_count;
+    uint16_t sequence;
+    unsigned int random;
+} Link;
+
+static size_t link_frame(Link* link, ReplicationSender* sender, int client, const SpatialGrid* grid,
+    ReplicationReceiver* receiver, float loss, size_t room)
+{
+    for (int a = 0; a < link->ack_count; ++a)
+        replication_sender_ack(sender, client, link->acks[a]);
+    link->ack_count = 0;
+
+    static uint8_t packet[1 << 20];
+    BitWriter w;
+    bit_writer_init(&w, packet, room);
+    const uint16_t sequence = link->sequence++;
+    replication_sender_write(sender, client, grid, sequence, &w);
+    const size_t bytes = bit_writer_bytes(&w);
+
+    BitReader r;
+    const float roll = random_float(&link->random, 0.f, 1.f);
+    if (roll >= 2.f * loss)
+    {
+        bit_reader_init(&r, packet, bytes);
+        if (replication_receiver_read(receiver, sequence, &r) && random_float(&link->random, 0.f, 1.f) >= loss)
+            link->acks[link->ack_count++] = sequence;
+    }
+    if (link->holding)
+    {
+        bit_reader_init(&r, link->held, link->held_bytes);
+        if (replication_receiver_read(receiver, link->held_sequence, &r)
+            && random_float(&link->random, 0.f, 1.f) >= loss)
+            link->acks[link->ack_count++] = link->held_sequence;
+        link->holding = false;
+    }
+    if (roll >= loss && roll < 2.f * loss && bytes <= sizeof(link->held))
+    {
+        memcpy(link->held, packet, bytes);
+        link->held_bytes = bytes;
+        link->held_sequence = sequence;
+        link->holding = true;
+    }
+    return bytes;
+}
+
+// The bytes a snapshot takes with "moving" of "count" objects changing each frame, sent whole (no packet limit)
+static double bytes_per_snapshot(uint32_t count, uint32_t moving, int frames)
+{
+    Scene scene;
+    scene_init(&scene, count);
+    ReplicationSender sender;
+    ReplicationReceiver receiver;
+    if (!replication_sender_init(&sender, count, &quantizer)
+        || !replication_receiver_init(&receiver, count, &quantizer))
+        return 0.0;
+    const int client = replication_sender_add_client(&sender);
+    Link link = {};
+    link.random = 99u;
+    replication_sender_update(&sender, scene.objects.data());
+    for (int f = 0; f < 3; ++f)
+        link_frame(&link, &sender, client, NULL, &receiver, 0.f, 1 << 20);     // the first, whole scene
+    size_t total = 0;
+    for (int f = 0; f < frames; ++f)
+    {
+        scene_step(&scene, moving);
+        replication_sender_update(&sender, scene.objects.data());
+        total += link_frame(&link, &sender, client, NULL, &receiver, 0.f, 1 << 20);
+    }
+    replication_sender_destroy(&sender);
+    replication_receiver_destroy(&receiver);
+    return (double)total / frames;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = argc > 1 ? (uint32_t)atoi(argv[1]) : 20000;
+    int frames = argc > 2 ? atoi(argv[2]) : 120;
+    count = count < 100 ? 100 : count;
+    frames = frames < 10 ? 10 : frames;
+    bool ok = true;
+
+    // Bits: every width, then gamma and signed codes from small to extreme, and a writer wound back over them
+    {
+        static uint8_t buffer[4096];
+        BitWriter w;
+        bit_writer_init(&w, buffer, sizeof(buffer));
+        unsigned int random = 7u;
+        uint32_t values[200];
+        for (int i = 0; i < 200; ++i)
+        {
+            random = random * 1664525u + 1013904223u;
+            values[i] = random;
+        }
+        for (int i = 0; i < 100; ++i)
+            bit_write(&w, values[i], i % 33);
+        const int32_t extremes[] = { 0, 1, -1, 2, -2, 1000, -1000, INT32_MAX, INT32_MIN };
+        for (int32_t e : extremes)
+            bit_write_signed(&w, e);
+        bit_write_gamma(&w, UINT32_MAX);
+        const size_t mark = w.bits;
+        bit_write(&w, 0xFFFFFFFFu, 32);
+        w.bits = mark;
+        bit_write(&w, 0x5u, 3);
+        BitReader r;
+        bit_reader_init(&r, buffer, bit_writer_bytes(&w));
+        bool same = true;
+        for (int i = 0; i < 100; ++i)
+        {
+            const int n = i % 33;
+            same = same && bit_read(&r, n) == (n == 32 ? values[i] : values[i] & ((1u << n) - 1u));
+        }
+        for (int32_t e : extremes)
+            same = same && bit_read_signed(&r) == e;
+        same = same && bit_read_gamma(&r) == UINT32_MAX && bit_read(&r, 3) == 0x5u && !r.overflow;
+        bit_read(&r, 32);
+        ok = report("bits read back as written", same && r.overflow) && ok;
+    }
+
+    // Quantisation: within half a step, and rotations within a fraction of a degree
+    {
+        unsigned int random = 3u;
+        float position = 0.f, scale = 0.f, angle = 0.f;
+        for (int i = 0; i < 100000; ++i)
+        {
+            trs in, out;
+            for (int k = 0; k < 3; ++k)
+            {
+                in.t[k] = random_float(&random, -1000.f, 1000.f);
+                in.s[k] = random_float(&random, 0.1f, 4.f);
+            }
+            random_rotation(&random, in.r);
+            ReplicatedTrs q;
+            replication_quantize(&quantizer, &in, &q);
+            replication_dequantize(&quantizer, &q, &out);
+            float dot = 0.f;
+            for (int k = 0; k < 3; ++k)
+            {
+                position = fmaxf(position, fabsf(out.t[k] - in.t[k]));
+                scale = fmaxf(scale, fabsf(out.s[k] - in.s[k]));
+            }
+            for (int k = 0; k < 4; ++k)
+                dot += out.r[k] * in.r[k];
+            angle = fmaxf(angle, 2.f * acosf(fminf(fabsf(dot), 1.f)) * 57.29577951308232f);
+        }
+        printf("  worst error: position %.5f, scale %.5f, rotation %.3f degrees\n", position, scale, angle);
+        ok = report("quantised transforms within a step", position <= quantizer.position_step * 0.51f
+            && scale <= quantizer.scale_step * 0.51f && angle < 0.25f) && ok;
+    }
+
+    // Loss and reordering: a fifth of the scene moving every frame, cut to a packet, then still until it settles
+    {
+        Scene scene;
+        scene_init(&scene, count);
+        ReplicationSender sender;
+        ReplicationReceiver receiver;
+        if (!replication_sender_init(&sender, count, &quantizer) || !replication_receiver_init(&receiver, count,
+            &quantizer))
+            return EXIT_FAILURE;
+        const int client = replication_sender_add_client(&sender);
+        Link link = {};
+        link.random = 5u;
+        replication_sender_update(&sender, scene.objects.data());
+        int settled = -1;
+        for (int f = 0; f < frames + 2000 && settled < 0; ++f)
+        {
+            if (f < frames)
+            {
+                scene_step(&scene, count / 5);
+                replication_sender_update(&sender, scene.objects.data());
+            }
+            link_frame(&link, &sender, client, NULL, &receiver, 0.2f, ROOM);
+            if (f >= frames && same_as_server(&sender, &receiver))
+                settled = f - frames;
+        }
+        const ReplicationClient* c = &sender.clients[client];
+        printf("  %u snapshots, %u cut, %u from nothing; received %u, %u out of order, %u missing a baseline\n",
+            c->snapshots, c->cut, c->from_nothing, receiver.snapshots, receiver.stale, receiver.missing_baseline);
+        printf("  settled %d frames after the scene stopped\n", settled);
+        ok = report("client converges under loss and reordering", settled >= 0) && ok;
+        replication_sender_destroy(&sender);
+        replication_receiver_destroy(&receiver);
+    }
+
+    // Cost: against the share of objects moving, and against the scene's size for the same moves
+    {
+        const uint32_t moves[] = { 0, count / 100, count / 10, count };
+        double bytes[4];
+        for (int m = 0; m < 4; ++m)
+        {
+            bytes[m] = bytes_per_snapshot(count, moves[m], 20);
+            printf("  %6u of %u moving: %9.1f bytes a snapshot (%.1f bits an object moved)\n", moves[m], count,
+                bytes[m], moves[m] ? 8.0 * bytes[m] / moves[m] : 0.0);
+        }
+        printf("  the whole scene as floats: %zu bytes\n", sizeof(trs) * count);
+        const double small = bytes_per_snapshot(count, 200, 20), large = bytes_per_snapshot(count * 5, 200, 20);
+        printf("  200 moving of %u: %.1f bytes; of %u: %.1f bytes\n", count, small, count * 5, large);
+        ok = report("a still scene costs a few bytes", bytes[0] <= 8.0) && ok;
+        ok = report("cost follows what moved", bytes[1] < bytes[2] && bytes[2] < bytes[3]
+            && bytes[3] < 0.5 * sizeof(trs) * count) && ok;
+        ok = report("not how big the scene is", large < 1.5 * small) && ok;
+    }
+
+    // Area of interest: what's within the radius, nothing beyond the margin, as the viewpoint moves
+    {
+        Scene scene;
+        scene_init(&scene, count);
+        scene_bounds(&scene);
+        SpatialGrid grid;
+        ReplicationSender sender;
+        ReplicationReceiver receiver;
+        if (!spatial_grid_init(&grid, count) || !replication_sender_init(&sender, count, &quantizer)
+            || !replication_receiver_init(&receiver, count, &quantizer))
+            return EXIT_FAILURE;
+        const int client = replication_sender_add_client(&sender);
+        Link link = {};
+        link.random = 11u;
+        bool held = true;
+        for (int leg = 0; leg < 3; ++leg)
+        {
+            const vec3 center = { leg * 50.f - 50.f, 0.f, leg * 20.f };
+            replication_sender_set_interest(&sender, client, center, AOI_RADIUS);
+            for (int f = 0; f < 60; ++f)
+            {
+                scene_step(&scene, count / 50);
+                scene_bounds(&scene);
+                spatial_grid_build(&grid, NULL, scene.bounds.data(), count, 8.f);
+                replication_sender_update(&sender, scene.objects.data());
+                link_frame(&link, &sender, client, &grid, &receiver, f < 40 ? 0.1f : 0.f, ROOM);
+            }
+            for (int f = 0; f < 8; ++f)
+                link_frame(&link, &sender, client, &grid, &receiver, 0.f, ROOM);
+            const ReplicatedTrs* state = replication_receiver_state(&receiver);
+            int inside = 0, margin = 0;
+            for (uint32_t i = 0; state && i < count; ++i)
+            {
+                float d2 = 0.f;
+                for (int k = 0; k < 3; ++k)
+                {
+                    const float v = center[k] < scene.bounds[i].min[k] ? scene.bounds[i].min[k] - center[k]
+                        : center[k] > scene.bounds[i].max[k] ? center[k] - scene.bounds[i].max[k] : 0.f;
+                    d2 += v * v;
+                }
+                const float d = sqrtf(d2);
+                if (d <= AOI_RADIUS * 0.999f)
+                {
+                    held = held && !memcmp(&state[i], &sender.current[i], sizeof(ReplicatedTrs));
+                    ++inside;
+                }
+                else if (d > AOI_RADIUS * REPLICATION_INTEREST_MARGIN * 1.001f)
+                    held = held && !state[i].present;
+                else
+                    margin += state[i].present;
+            }
+            held = held && state && inside > 0;
+            printf("  viewpoint %d: %d objects inside, %d more kept in the margin\n", leg, inside, margin);
+        }
+        ok = report("client holds its area of interest", held) && ok;
+        replication_sender_destroy(&sender);
+        replication_receiver_destroy(&receiver);
+        spatial_grid_destroy(&grid);
+    }
+
+    // Loopback UDP: the setup as a reliable message, then snapshots, a tenth of the datagrams dropped both ways
+    {
+        UdpSocket server_socket, client_socket;
+        if (!udp_socket_open(&server_socket, 0) || !udp_socket_open(&client_socket, 0))
+            return EXIT_FAILURE;
+        UdpAddress server_address, client_address;
+        udp_address_resolve("127.0.0.1", udp_socket_port(&server_socket), &server_address);
+        udp_address_resolve("127.0.0.1", udp_socket_port(&client_socket), &client_address);
+        static UdpChannel server, client_channel;
+        udp_channel_init(&server, &client_address);
+        udp_channel_init(&client_channel, &server_address);
+
+        Scene scene;
+        scene_init(&scene, count);
+        ReplicationSender sender;
+        ReplicationReceiver receiver = {};
+        if (!replication_sender_init(&sender, count, &quantizer))
+            return EXIT_FAILURE;
+        const int client = replication_sender_add_client(&sender);
+        struct Setup
+        {
+            uint32_t count;
+            ReplicationQuantizer quantizer;
+        } setup = { count, quantizer };
+        udp_channel_queue(&server, &setup, sizeof(setup));
+        const char greeting[] = "second message";
+        udp_channel_queue(&server, greeting, sizeof(greeting));
+
+        int setups = 0, greetings = 0, settled = -1;
+        bool in_order = true;
+        static uint8_t datagram[UDP_CHANNEL_MTU], payload[UDP_CHANNEL_MTU];
+        for (int f = 0; f < frames + 2000 && settled < 0; ++f)
+        {
+            if (f < frames)
+            {
+                scene_step(&scene, count / 20);
+                replication_sender_update(&sender, scene.objects.data());
+            }
+            BitWriter w;
+            bit_writer_init(&w, payload, udp_channel_payload_room(&server));
+            const uint16_t sequence = udp_channel_next_sequence(&server);
+            replication_sender_write(&sender, client, NULL, sequence, &w);
+            udp_channel_send(&server, &server_socket, payload, bit_writer_bytes(&w), 0.1f);
+
+            // The client: reads what came, then answers (with no payload) so its acknowledgements go back
+            udp_socket_wait(&client_socket, 0.002);
+            UdpAddress from;
+            size_t size;
+            while ((size = udp_socket_receive(&client_socket, &from, datagram, sizeof(datagram))) > 0)
+            {
+                uint16_t s;
+                const uint8_t* bytes;
+                size_t bytes_size;
+                if (!udp_address_equal(&from, &server_address)
+                    || !udp_channel_read(&client_channel, datagram, size, &s, &bytes, &bytes_size))
+                    continue;
+                for (int m = 0; m < client_channel.inbox_count; ++m)
+                {
+                    const UdpMessage* message = &client_channel.inbox[m];
+                    if (message->size == sizeof(setup))
+                    {
+                        in_order = in_order && setups + greetings == 0;
+                        ++setups;
+                        Setup got;
+                        memcpy(&got, message->data, sizeof(got));
+                        replication_receiver_init(&receiver, got.count, &got.quantizer);
+                    }
+                    else
+                    {
+                        in_order = in_order && setups == 1 && !strcmp((const char*)message->data, greeting);
+                        ++greetings;
+                    }
+                }
+                client_channel.inbox_count = 0;
+                if (receiver.records)
+                {
+                    BitReader r;
+                    bit_reader_init(&r, bytes, bytes_size);
+                    replication_receiver_read(&receiver, s, &r);
+                }
+            }
+            udp_channel_send(&client_channel, &client_socket, NULL, 0, 0.1f);
+
+            udp_socket_wait(&server_socket, 0.002);
+            while ((size = udp_socket_receive(&server_socket, &from, datagram, sizeof(datagram))) > 0)
+            {
+                uint16_t s;
+                const uint8_t* bytes;
+                size_t bytes_size;
+                if (!udp_address_equal(&from, &client_address)
+                    || !udp_channel_read(&server, datagram, size, &s, &bytes, &bytes_size))
+                    continue;
+                for (int a = 0; a < server.acked_count; ++a)
+                    replication_sender_ack(&sender, client, server.acked[a]);
+            }
+            if (f >= frames && receiver.records && same_as_server(&sender, &receiver))
+                settled = f - frames;
+        }
+        printf("  server: %u datagrams, %u lost, %u messages resent, %.1f KB; rtt %.2f ms\n", server.datagrams_sent,
+            server.datagrams_lost, server.resent, server.bytes_sent / 1024.0, server.rtt_ms);
+        ok = report("reliable messages arrive once, in order", setups == 1 && greetings == 1 && in_order) && ok;
+        ok = report("client converges over loopback UDP", settled >= 0) && ok;
+        replication_sender_destroy(&sender);
+        replication_receiver_destroy(&receiver);
+        udp_socket_close(&server_socket);
+        udp_socket_close(&client_socket);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,238 @@
+// Scene file check (src/scene/scene_file.h): writes a scene of random entities with its BVH, opens it and
+// compares every array and the tree's cull with what was written, reads the text export back, and checks that
+// truncated and corrupted files don't open. Times the open against what a load that builds the scene would
+// spend on the BVH alone.
+//
+// Usage: scene_file_bench [entities]
+
+#include "scene/scene_file.h"
+
+#include <chrono>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+typedef struct Entities
+{
+    std::vector<float> x, y, z, angle, scale, radius;
+    std::vector<uint32_t> mesh, material;
+    std::vector<Aabb> bounds;
+    SceneEntities view;
+} Entities;
+
+static void entities_make(Entities* e, uint32_t count, bool flat)
+{
+    unsigned int state = 12345u;
+    e->x.resize(count); e->y.resize(count); e->z.resize(count); e->angle.resize(count); e->scale.resize(count);
+    e->radius.resize(count); e->mesh.resize(count); e->material.resize(count); e->bounds.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        e->x[i] = random_float(&state, -1000.f, 1000.f);
+        e->y[i] = random_float(&state, -1000.f, 1000.f);
+        e->z[i] = flat ? 0.f : random_float(&state, -10.f, 10.f);
+        e->angle[i] = random_float(&state, -3.14159f, 3.14159f);
+        e->scale[i] = random_float(&state, 0.5f, 2.f);
+        e->radius[i] = e->scale[i] * 0.8f;
+        e->mesh[i] = i % 3;
+        e->material[i] = i % 5;
+        const float p[3] = { e->x[i], e->y[i], e->z[i] };
+        for (int k = 0; k < 3; ++k)
+        {
+            e->bounds[i].min[k] = p[k] - e->radius[i];
+            e->bounds[i].max[k] = p[k] + e->radius[i];
+        }
+    }
+    SceneEntities view = { count, e->x.data(), e->y.data(), e->z.data(), e->angle.data(), e->scale.data(),
+        e->mesh.data(), e->material.data(), e->radius.data(), e->bounds.data() };
+    e->view = view;
+}
+
+static bool same_arrays(const SceneEntities* a, const SceneEntities* b)
+{
+    const size_t n = a->count;
+    return a->count == b->count && !memcmp(a->x, b->x, n * 4) && !memcmp(a->y, b->y, n * 4)
+        && !memcmp(a->z, b->z, n * 4) && !memcmp(a->angle, b->angle, n * 4) && !memcmp(a->scale, b->scale, n * 4)
+        && !memcmp(a->mesh, b->mesh, n * 4) && !memcmp(a->material, b->material, n * 4)
+        && !memcmp(a->radius, b->radius, n * 4) && !memcmp(a->bounds, b->bounds, n * sizeof(Aabb));
+}
+
+// The file's tree culls exactly as the one it was written from
+static bool same_cull(const Bvh* built, const Bvh* mapped, uint32_t count)
+{
+    mat4x4 projection, view, vp;
+    mat4x4_perspective(projection, 1.f, 16.f / 9.f, 1.f, 3000.f);
+    const vec3 eye = { 0.f, -1200.f, 400.f }, centre = { 100.f, 0.f, 0.f }, up = { 0.f, 0.f, 1.f };
+    mat4x4_look_at(view, eye, centre, up);
+    mat4x4_mul(vp, projection, view);
+    Frustum frustum;
+    frustum_from_matrix(&frustum, vp);
+    std::vector<uint32_t> a(count), b(count);
+    const size_t na = bvh_cull(built, &frustum, a.data());
+    const size_t nb = bvh_cull(mapped, &frustum, b.data());
+    return na == nb && na > 0 && !memcmp(a.data(), b.data(), na * sizeof(uint32_t));
+}
+
+// Every entity line of the text export parses back to the same floats
+static bool text_round_trips(const char* path, const SceneEntities* e, uint32_t mesh_count)
+{
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return false;
+    char line[512];
+    uint32_t lines = 0, entities = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), f))
+    {
+        ++lines;
+        unsigned int i, mesh, material;
+        float x, y, z, angle, scale, radius;
+        Aabb b;
+        if (sscanf(line, "entity %u pos %g %g %g angle %g scale %g mesh %u material %u radius %g bounds %g %g %g %g "
+            "%g %g", &i, &x, &y, &z, &angle, &scale, &mesh, &material, &radius, &b.min[0], &b.min[1], &b.min[2],
+            &b.max[0], &b.max[1], &b.max[2]) != 15)
+            continue;
+        ok = ok && i == entities && x == e->x[i] && y == e->y[i] && z == e->z[i] && angle == e->angle[i]
+            && scale == e->scale[i] && mesh == e->mesh[i] && material == e->material[i] && radius == e->radius[i]
+            && !memcmp(&b, &e->bounds[i], sizeof(b));
+        ++entities;
+    }
+    fclose(f);
+    return ok && entities == e->count && lines == 1 + mesh_count + e->count;
+}
+
+// A copy of "from" with "size" bytes, and "patch" written at "offset" (unless it's NULL)
+static void write_copy(const char* from, const char* to, uint64_t size, uint64_t offset, const void* patch,
+    size_t patch_size)
+{
+    std::vector<char> bytes(size);
+    FILE* f = fopen(from, "rb");
+    const size_t got = f ? fread(bytes.data(), 1, size, f) : 0;
+    if (f)
+        fclose(f);
+    if (patch && offset + patch_size <= got)
+        memcpy(bytes.data() + offset, patch, patch_size);
+    f = fopen(to, "wb");
+    if (f)
+    {
+        fwrite(bytes.data(), 1, got, f);
+        fclose(f);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t count = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000000u;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string path = (dir / "scene_file_bench.ogts").string();
+    const std::string text = (dir / "scene_file_bench.txt").string();
+    const std::string bad = (dir / "scene_file_bench_bad.ogts").string();
+    static const char* const names[] = { "meshes/rock.ogtm", "meshes/tree.ogtm", "meshes/house.ogtm" };
+
+    Entities e;
+    entities_make(&e, count, false);
+    Bvh bvh;
+    if (!bvh_init(&bvh, count))
+        return EXIT_FAILURE;
+    double t = now_ms();
+    bvh_build(&bvh, e.bounds.data(), count);
+    const double build_ms = now_ms() - t;
+
+    t = now_ms();
+    bool ok = report("the scene is written", scene_file_write(path.c_str(), &e.view, names, 3, 5, &bvh));
+    const double write_ms = now_ms() - t;
+
+    SceneFile scene;
+    t = now_ms();
+    const bool opened = scene_file_open(&scene, path.c_str());
+    const double open_ms = now_ms() - t;
+    ok = report("it opens", opened) && ok;
+    if (!opened)
+        return EXIT_FAILURE;
+
+    // The first pass over the data pays for reading it in; the build would have had to touch it all too
+    t = now_ms();
+    double sum = 0.0;
+    for (uint32_t i = 0; i < count; ++i)
+        sum += scene.entities.x[i] + scene.entities.bounds[i].max[2];
+    const double touch_ms = now_ms() - t;
+
+    ok = report("every array reads back as written", same_arrays(&scene.entities, &e.view)) && ok;
+    ok = report("the mesh names read back", scene.header->mesh_count == 3
+        && !strcmp(scene_file_mesh_name(&scene, 1), names[1]) && !scene_file_mesh_name(&scene, 3)[0]) && ok;
+    ok = report("the flags say what the writer found", scene.header->flags == 0) && ok;
+    Bvh mapped;
+    ok = report("the mapped BVH culls as the built one",
+        scene_file_bvh(&scene, &mapped) && same_cull(&bvh, &mapped, count)) && ok;
+    bvh_destroy(&mapped);
+
+    // Text, for a scene small enough to read back
+    Entities small;
+    entities_make(&small, 1000, true);
+    FILE* out = fopen(text.c_str(), "w");
+    const bool written = out && scene_file_write_text(out, &small.view, names, 3, 5);
+    if (out)
+        fclose(out);
+    ok = report("the text export round-trips every float", written && text_round_trips(text.c_str(), &small.view, 3))
+        && ok;
+    t = now_ms();
+    out = fopen(text.c_str(), "w");
+    const bool exported = out && scene_file_export_text(out, &scene);
+    if (out)
+        fclose(out);
+    const double text_ms = now_ms() - t;
+    ok = report("an open file exports as text", exported) && ok;
+
+    // A flat scene of one scale says so, and writes without a BVH
+    for (float& s : small.scale)
+        s = 1.5f;
+    SceneFile flat;
+    ok = report("flat, uniform scenes are flagged", scene_file_write(bad.c_str(), &small.view, NULL, 0, 0, NULL)
+        && scene_file_open(&flat, bad.c_str())
+        && flat.header->flags == (SCENE_FILE_UNIFORM_SCALE | SCENE_FILE_FLAT) && !flat.bvh_nodes) && ok;
+    scene_file_close(&flat);
+
+    // Damage: cut short, and a BVH node pointing back at the root
+    const uint64_t size = scene.file.size;
+    const uint64_t node_offset = scene.header->sections[SCENE_FILE_BVH_NODES].offset;
+    BvhNode loop = scene.bvh_nodes[0];
+    loop.first = 0;
+    loop.count = 0;
+    scene_file_close(&scene);
+    SceneFile broken;
+    write_copy(path.c_str(), bad.c_str(), size - 64, 0, NULL, 0);
+    bool refused = !scene_file_open(&broken, bad.c_str());
+    write_copy(path.c_str(), bad.c_str(), size, node_offset, &loop, sizeof(loop));
+    refused = !scene_file_open(&broken, bad.c_str()) && refused;
+    ok = report("damaged files don't open", refused) && ok;
+
+    printf("  %u entities, %.1f MB\n", count, size / (1024.0 * 1024.0));
+    printf("  open %.3f ms (first pass over it %.1f ms), write %.1f ms, text export %.0f ms; BVH build %.1f ms\n",
+        open_ms, touch_ms, write_ms, text_ms, build_ms);
+    if (sum == 1e300)
+        printf("\n");   // keeps the pass
+    bvh_destroy(&bvh);
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    std::filesystem::remove(text, ec);
+    std::filesystem::remove(bad, ec);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
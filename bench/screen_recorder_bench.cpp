@@ -0,0 +1,372 @@
+// Screen recorder check (src/core/screen_recorder.h): a 1080p frame encodes to a PNG whose chunk CRCs hold and
+// whose pixels come back exactly through an inflate and unfilter of its own; a raw recording holds every frame
+// submitted, top row first and in order, with slots handed back as they're written; frames of another size are
+// skipped; a .png recording writes numbered files; and each ffmpeg encoder and stream gets the command line
+// it needs. Then times the PNG encoder, a raw frame, and a submit, the
+// only part of it the render thread runs.
+//
+// Usage: screen_recorder_bench [frames]
+
+#include "core/screen_recorder.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define SLOTS 3
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Something like a frame: a gradient sky, flat panels, and a noisy strip that doesn't compress. Bottom row
+// first, as glReadPixels gives it; "frame" shifts it so every frame of a recording differs.
+static void make_frame(uint8_t* rgba, int width, int height, unsigned int frame)
+{
+    uint32_t h = 0x9E3779B9u * (frame + 1);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            uint8_t* p = rgba + 4 * ((size_t)y * width + x);
+            const bool panel = (x / 240 + y / 180) % 3 == 0;
+            const bool noisy = y > height * 3 / 4 && x < width / 4;
+            h = h * 1664525u + 1013904223u;
+            p[0] = noisy ? (uint8_t)(h >> 24) : panel ? 40 : (uint8_t)(x * 255 / width + frame);
+            p[1] = noisy ? (uint8_t)(h >> 16) : panel ? 44 : (uint8_t)(y * 255 / height);
+            p[2] = noisy ? (uint8_t)(h >> 8) : panel ? 52 : 200;
+            p[3] = 255;
+        }
+}
+
+// --- A reader for what the encoder writes: PNG chunks, zlib, and deflate's fixed-code blocks ---
+
+static uint32_t crc32_of(const uint8_t* data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k)
+            crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+typedef struct BitReader
+{
+    const uint8_t* in;
+    size_t size;
+    size_t pos;
+    int bit;
+} BitReader;
+
+static int get_bit(BitReader* r)
+{
+    if (r->pos >= r->size)
+        return -1;
+    const int b = (r->in[r->pos] >> r->bit) & 1;
+    if (++r->bit == 8)
+    {
+        r->bit = 0;
+        ++r->pos;
+    }
+    return b;
+}
+
+static int get_bits(BitReader* r, int n)
+{
+    int v = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        const int b = get_bit(r);
+        if (b < 0)
+            return -1;
+        v |= b << i;
+    }
+    return v;
+}
+
+// Huffman codes are read most significant bit first, one bit at a time until the code is one of the fixed ones
+static int get_symbol(BitReader* r)
+{
+    int code = 0;
+    for (int len = 1; len <= 9; ++len)
+    {
+        const int b = get_bit(r);
+        if (b < 0)
+            return -1;
+        code = code << 1 | b;
+        if (len == 7 && code <= 23)
+            return 256 + code;
+        if (len == 8 && code >= 0x30 && code <= 0xBF)
+            return code - 0x30;
+        if (len == 8 && code >= 0xC0 && code <= 0xC7)
+            return 280 + code - 0xC0;
+        if (len == 9 && code >= 0x190)
+            return 144 + code - 0x190;
+    }
+    return -1;
+}
+
+// Inflates fixed-code blocks (the only kind the encoder makes) into "out". Returns the bytes, or 0 on an error.
+static size_t inflate_fixed(const uint8_t* in, size_t size, uint8_t* out, size_t capacity)
+{
+    static const int length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+        67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const int length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+        5, 5, 5, 5, 0 };
+    static const int distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+        769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    if (size < 6 || in[0] != 0x78 || ((in[0] << 8) | in[1]) % 31 != 0)
+        return 0;
+    BitReader r = { in + 2, size - 6, 0, 0 };
+    size_t n = 0;
+    for (int last = 0; !last;)
+    {
+        last = get_bit(&r);
+        if (last < 0 || get_bits(&r, 2) != 1)
+            return 0;
+        for (;;)
+        {
+            const int symbol = get_symbol(&r);
+            if (symbol < 0 || symbol > 285)
+                return 0;
+            if (symbol < 256)
+            {
+                if (n == capacity)
+                    return 0;
+                out[n++] = (uint8_t)symbol;
+                continue;
+            }
+            if (symbol == 256)
+                break;
+            const int length = length_base[symbol - 257] + get_bits(&r, length_extra[symbol - 257]);
+            int code = 0;
+            for (int i = 0; i < 5; ++i)
+                code = code << 1 | get_bit(&r);
+            if (code < 0 || code > 29)
+                return 0;
+            const size_t distance = (size_t)(distance_base[code] + get_bits(&r, code < 4 ? 0 : code / 2 - 1));
+            if (distance > n || n + length > capacity)
+                return 0;
+            for (int i = 0; i < length; ++i, ++n)
+                out[n] = out[n - distance];
+        }
+    }
+    // Adler-32, big-endian, after the stream
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        a = (a + out[i]) % 65521u;
+        b = (b + a) % 65521u;
+    }
+    return get_u32(in + size - 4) == (b << 16 | a) ? n : 0;
+}
+
+// Decodes the encoder's PNG back into top-row-first RGBA. Returns false on any error, CRCs included.
+static bool decode_png(const uint8_t* png, size_t size, uint8_t* rgba, int width, int height)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (size < 8 || memcmp(png, signature, 8))
+        return false;
+    const size_t stride = 4 * (size_t)width;
+    uint8_t* idat = (uint8_t*)malloc(size);
+    uint8_t* filtered = (uint8_t*)malloc((stride + 1) * height);
+    size_t idat_size = 0;
+    bool header = false, end = false;
+    for (size_t p = 8; p + 12 <= size && !end;)
+    {
+        const uint32_t length = get_u32(png + p);
+        if (p + 12 + length > size || get_u32(png + p + 8 + length) != crc32_of(png + p + 4, length + 4))
+            break;
+        const uint8_t* type = png + p + 4;
+        const uint8_t* data = png + p + 8;
+        if (!memcmp(type, "IHDR", 4))
+            header = length == 13 && get_u32(data) == (uint32_t)width && get_u32(data + 4) == (uint32_t)height
+                && data[8] == 8 && data[9] == 6;
+        else if (!memcmp(type, "IDAT", 4))
+        {
+            memcpy(idat + idat_size, data, length);
+            idat_size += length;
+        }
+        else if (!memcmp(type, "IEND", 4))
+            end = true;
+        p += 12 + length;
+    }
+    bool ok = header && end && inflate_fixed(idat, idat_size, filtered, (stride + 1) * height) == (stride + 1) * height;
+    for (int y = 0; y < height && ok; ++y)
+    {
+        const uint8_t* f = filtered + (stride + 1) * y;
+        uint8_t* row = rgba + stride * y;
+        for (size_t i = 0; i < stride; ++i)
+        {
+            const uint8_t left = i >= 4 ? row[i - 4] : 0, up = y ? row[i - stride] : 0;
+            row[i] = (uint8_t)(f[1 + i] + (f[0] == 1 ? left : f[0] == 2 ? up : 0));
+        }
+        ok = f[0] <= 2;
+    }
+    free(idat);
+    free(filtered);
+    return ok;
+}
+
+static bool flipped_equal(const uint8_t* top_first, const uint8_t* bottom_first, int width, int height)
+{
+    const size_t stride = 4 * (size_t)width;
+    for (int y = 0; y < height; ++y)
+        if (memcmp(top_first + stride * y, bottom_first + stride * (height - 1 - y), stride))
+            return false;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 60;
+    const size_t frame_bytes = 4 * (size_t)WIDTH * HEIGHT;
+    uint8_t* source = (uint8_t*)malloc(frame_bytes);
+    uint8_t* decoded = (uint8_t*)malloc(frame_bytes);
+    uint8_t* rows = (uint8_t*)malloc(2 * (4 * WIDTH + 1));
+    const size_t bound = screen_recorder_png_bound(WIDTH, HEIGHT);
+    uint8_t* png = (uint8_t*)malloc(bound);
+
+    // A frame through the encoder and back
+    make_frame(source, WIDTH, HEIGHT, 0);
+    double t = now_ms();
+    const size_t png_size = screen_recorder_encode_png(source, WIDTH, HEIGHT, true, rows, png, bound);
+    const double encode_ms = now_ms() - t;
+    printf("  png: %zu bytes for %zu of pixels (%.1f%%), %.1f ms to encode\n", png_size, frame_bytes,
+        100.0 * png_size / frame_bytes, encode_ms);
+    bool ok = report("a png decodes to the frame, top row first", png_size > 0 && png_size <= bound
+        && decode_png(png, png_size, decoded, WIDTH, HEIGHT) && flipped_equal(decoded, source, WIDTH, HEIGHT));
+    ok = report("a too small buffer encodes nothing", screen_recorder_encode_png(source, WIDTH, HEIGHT, true, rows,
+        png, png_size - 1) == 0) && ok;
+
+    // A raw recording, a slot per buffer as the GL side has them: every frame submitted comes out, in order
+    const int w = 320, h = 180;
+    const size_t small = 4 * (size_t)w * h;
+    uint8_t* slots = (uint8_t*)malloc(small * SLOTS);
+    ScreenRecorder rec;
+    screen_recorder_init(&rec, "screen_recorder_bench.rgba", 60);
+    for (int f = 0; f < frames; ++f)
+    {
+        const int slot = f % SLOTS;
+        while (screen_recorder_busy(&rec, slot))
+            std::this_thread::yield();
+        make_frame(slots + small * slot, w, h, (unsigned int)f);
+        screen_recorder_submit(&rec, slot, slots + small * slot, w, h, NULL);
+    }
+    while (screen_recorder_busy(&rec, 0))
+        std::this_thread::yield();
+    const bool resized = screen_recorder_submit(&rec, 0, slots, w / 2, h, NULL);
+    screen_recorder_destroy(&rec);
+    bool in_order = rec.frames == (unsigned int)frames && rec.bytes == small * frames;
+    FILE* f = fopen("screen_recorder_bench.rgba", "rb");
+    uint8_t* expected = (uint8_t*)malloc(small);
+    uint8_t* read = (uint8_t*)malloc(small);
+    for (int k = 0; k < frames && in_order && f; ++k)
+    {
+        make_frame(expected, w, h, (unsigned int)k);
+        in_order = fread(read, 1, small, f) == small && flipped_equal(read, expected, w, h);
+    }
+    in_order = in_order && f && fgetc(f) == EOF;
+    if (f)
+        fclose(f);
+    remove("screen_recorder_bench.rgba");
+    ok = report("a raw recording holds every frame in order", in_order) && ok;
+    ok = report("a frame of another size is skipped", resized && rec.skipped == 1) && ok;
+
+    // A .png recording and a screenshot beside it
+    screen_recorder_init(&rec, "screen_recorder_bench.png", 60);
+    screen_recorder_submit(&rec, 0, slots, w, h, NULL);
+    screen_recorder_submit(&rec, 1, slots + small, w, h, "screen_recorder_bench_shot.png");
+    screen_recorder_submit(&rec, 2, slots + 2 * small, w, h, NULL);
+    screen_recorder_destroy(&rec);
+    const char* written[3] = { "screen_recorder_bench_000001.png", "screen_recorder_bench_000002.png",
+        "screen_recorder_bench_shot.png" };
+    bool numbered = rec.frames == 2 && rec.screenshots == 1;
+    for (int k = 0; k < 3; ++k)
+    {
+        FILE* file = fopen(written[k], "rb");
+        numbered = numbered && file;
+        if (file)
+            fclose(file);
+        remove(written[k]);
+    }
+    ok = report("png recordings are numbered, shots apart", numbered) && ok;
+
+    // The ffmpeg command lines: made, not run (the worker opens them at the first frame)
+    char command[SCREEN_RECORDER_COMMAND];
+    screen_recorder_init(&rec, "rtp://10.0.0.2:5004", 60);
+    screen_recorder_set_encoder(&rec, SCREEN_RECORDER_ENCODER_NVENC, true, 12000);
+    bool commands = rec.format == SCREEN_RECORDER_STREAM
+        && screen_recorder_ffmpeg_command(&rec, WIDTH, HEIGHT, command, sizeof(command))
+        && strstr(command, "-s 1920x1080 -r 60 -i -") && strstr(command, "-c:v hevc_nvenc")
+        && strstr(command, "-b:v 12000k -maxrate 12000k -bufsize 201k") && strstr(command, "-g 60 -bf 0")
+        && strstr(command, "-f rtp \"rtp://10.0.0.2:5004\"");
+    printf("  %s\n", command);
+    screen_recorder_set_encoder(&rec, SCREEN_RECORDER_ENCODER_VAAPI, false, 0);
+    commands = commands && screen_recorder_ffmpeg_command(&rec, WIDTH, HEIGHT, command, sizeof(command))
+        && strstr(command, "-vaapi_device") < strstr(command, " -i -") && strstr(command, "hwupload -c:v h264_vaapi")
+        && strstr(command, "-b:v 8000k");
+    screen_recorder_destroy(&rec);
+    screen_recorder_init(&rec, "udp://239.0.0.1:1234", 60);
+    commands = commands && screen_recorder_ffmpeg_command(&rec, WIDTH, HEIGHT, command, sizeof(command))
+        && strstr(command, "-c:v libx264 -preset ultrafast -tune zerolatency") && strstr(command, "-f mpegts");
+    screen_recorder_destroy(&rec);
+    screen_recorder_init(&rec, "capture.mp4", 30);
+    commands = commands && rec.format == SCREEN_RECORDER_FFMPEG
+        && screen_recorder_ffmpeg_command(&rec, WIDTH, HEIGHT, command, sizeof(command)) && !strstr(command, "-c:v")
+        && !strstr(command, "-b:v") && strstr(command, "-r 30 ") && strstr(command, "\"capture.mp4\"")
+        && !screen_recorder_ffmpeg_command(&rec, WIDTH, HEIGHT, command, 40);
+    screen_recorder_destroy(&rec);
+    commands = commands && screen_recorder_encoder_from_name("amf") == SCREEN_RECORDER_ENCODER_AMF
+        && screen_recorder_encoder_from_name("default") < 0;
+    ok = report("encoders and streams get ffmpeg's flags", commands) && ok;
+
+    // The worker's cost for a raw 1080p frame, and the submit the render thread makes
+    uint8_t* big = (uint8_t*)malloc(frame_bytes * SLOTS);
+    for (int s = 0; s < SLOTS; ++s)
+        make_frame(big + frame_bytes * s, WIDTH, HEIGHT, (unsigned int)s);
+    screen_recorder_init(&rec, "screen_recorder_bench.rgba", 60);
+    double submit_ms = 0.0;
+    t = now_ms();
+    for (int k = 0; k < frames; ++k)
+    {
+        const int slot = k % SLOTS;
+        while (screen_recorder_busy(&rec, slot))
+            std::this_thread::yield();
+        const double s = now_ms();
+        screen_recorder_submit(&rec, slot, big + frame_bytes * slot, WIDTH, HEIGHT, NULL);
+        submit_ms += now_ms() - s;
+    }
+    screen_recorder_destroy(&rec);
+    const double total_ms = now_ms() - t;
+    remove("screen_recorder_bench.rgba");
+    printf("  raw 1080p: %.2f ms a frame written, %.2f us a submit\n", total_ms / frames, 1000.0 * submit_ms / frames);
+
+    free(big);
+    free(expected);
+    free(read);
+    free(slots);
+    free(png);
+    free(rows);
+    free(decoded);
+    free(source);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
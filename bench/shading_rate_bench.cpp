@@ -0,0 +1,101 @@
+// Shading rate check (src/core/shading_rate.h): the fovea's tiles are shaded at full rate and the rates only get
+// coarser going out, to the coarsest in the corners; flat or fast tiles go coarser than the foveation, never finer;
+// the fallback's inset covers the full-rate circle on even pixels. Prints what each costs against full-rate
+// shading at 1080p and 4K, and times filling a 4K rate image.
+//
+// Usage: shading_rate_bench [fills]
+
+#include "core/shading_rate.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TILE 16
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-46s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int fills = argc > 1 ? atoi(argv[1]) : 2000;
+    bool ok = true;
+
+    ShadingRateSettings s;
+    shading_rate_defaults(&s);
+    static uint8_t rates[(3840 / TILE) * (2160 / TILE + 1)];
+
+    // Along rays out of the centre: full rate first, never finer further out
+    bool outward = true;
+    const int width = 1920, height = 1080;
+    for (int a = 0; a < 16; ++a)
+    {
+        const float angle = a * 3.14159265f / 8.f;
+        int last = -1;
+        for (int k = 0; k <= 64; ++k)
+        {
+            const float t = k / 64.f * height;
+            const int rate = shading_rate_foveated(&s, 0.5f * width + cosf(angle) * t, 0.5f * height + sinf(angle) * t,
+                width, height);
+            outward = outward && rate >= last && (k > 0 || rate == SHADING_RATE_1X1);
+            last = rate;
+        }
+    }
+    ok = report("full rate in the fovea, coarser going out", outward) && ok;
+    ok = report("the corners at the coarsest rate",
+        shading_rate_foveated(&s, 0.f, 0.f, width, height) == SHADING_RATE_COUNT - 1
+        && shading_rate_foveated(&s, width - 1.f, height - 1.f, width, height) == SHADING_RATE_COUNT - 1) && ok;
+
+    // Content: detailed and still keeps the foveated rate, flat or fast goes coarser
+    bool adaptive = true;
+    for (int f = 0; f < SHADING_RATE_COUNT; ++f)
+    {
+        const ShadingRate foveated = (ShadingRate)f;
+        adaptive = adaptive && shading_rate_adaptive(&s, foveated, 0.5f, 0.f) == foveated;
+        adaptive = adaptive && shading_rate_adaptive(&s, foveated, 0.f, 0.f) >= foveated;
+        adaptive = adaptive && shading_rate_adaptive(&s, foveated, 0.5f, 100.f) >= foveated;
+    }
+    adaptive = adaptive && shading_rate_adaptive(&s, SHADING_RATE_1X1, 0.f, 0.f) == SHADING_RATE_2X2
+        && shading_rate_adaptive(&s, SHADING_RATE_1X1, 0.5f, s.motion) == SHADING_RATE_2X1
+        && shading_rate_adaptive(&s, SHADING_RATE_1X1, 0.5f, 4.f * s.motion) == SHADING_RATE_2X2;
+    ok = report("flat or fast tiles coarser, never finer", adaptive) && ok;
+
+    // The fallback's inset: the inner circle's box on even pixels
+    bool covers = true;
+    const int sizes[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    for (int i = 0; i < 2; ++i)
+    {
+        const int w = sizes[i][0], h = sizes[i][1];
+        int rect[4];
+        shading_rate_fovea(&s, w, h, rect);
+        for (int k = 0; k < 4; ++k)
+            covers = covers && (rect[k] & 1) == 0;
+        const float r = s.inner * h;
+        covers = covers && rect[0] <= 0.5f * w - r && rect[2] >= 0.5f * w + r && rect[1] <= 0.5f * h - r
+            && rect[3] >= 0.5f * h + r;
+
+        shading_rate_fill(&s, w, h, TILE, rates);
+        const int tiles = ((w + TILE - 1) / TILE) * ((h + TILE - 1) / TILE);
+        const float inset = (float)(rect[2] - rect[0]) * (rect[3] - rect[1]) / ((float)w * h);
+        printf("  %dx%d: shading rate image %.0f%% of the invocations, fallback %.0f%% of the pixels"
+            " (inset %.0f%% + periphery 25%%)\n", w, h, 100.f * shading_rate_mean_cost(rates, tiles),
+            100.f * (inset + 0.25f), 100.f * inset);
+    }
+    ok = report("the inset covers the fovea on even pixels", covers) && ok;
+
+    const double t = now_ms();
+    for (int f = 0; f < fills; ++f)
+        shading_rate_fill(&s, 3840, 2160, TILE, rates);
+    printf("  4K rate image fill (%d tiles): %.1f us\n", (3840 / TILE) * ((2160 + TILE - 1) / TILE),
+        (now_ms() - t) * 1e3 / fills);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,180 @@
+// Shadow cascades check (src/scene/shadow_cascades.h): splits run from near to far in order for every lambda; a
+// camera step smaller than the cache margin leaves every cascade's matrices as they were, and a refit puts its
+// centre on a whole texel; along a camera path with nothing changing each cascade is drawn only when it's refitted;
+// with casters changing every frame the far cascades are drawn every 2^i frames; and a new light refits them all.
+// Then times a fit.
+//
+// Usage: shadow_cascades_bench [frames]
+
+#include "scene/shadow_cascades.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CASCADES 4
+#define RESOLUTION 2048
+#define NEAR_PLANE 0.1f
+#define FAR_PLANE 100.f
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-46s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// A perspective camera at "eye" looking along -z (a little down), as the inverse view-projection the fit takes
+static void camera_inverse(mat4x4 inverse, float x, float y, float z)
+{
+    mat4x4 projection, view, view_projection;
+    mat4x4_perspective(projection, 1.f, 16.f / 9.f, NEAR_PLANE, FAR_PLANE);
+    const vec3 eye = { x, y, z }, center = { x, y - 3.f, z - 10.f }, up = { 0.f, 1.f, 0.f };
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(view_projection, projection, view);
+    mat4x4_invert(inverse, view_projection);
+}
+
+static void fit_at(ShadowCascades* sc, float x, float y, float z)
+{
+    mat4x4 inverse;
+    camera_inverse(inverse, x, y, z);
+    shadow_cascades_fit(sc, inverse, -1.f, 1.f, NEAR_PLANE, FAR_PLANE);
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 1024;
+    bool ok = true;
+
+    // Splits: in order, from near to far, logarithmic ones nearer than uniform ones
+    bool ordered = true;
+    float uniform[CASCADES + 1], logarithmic[CASCADES + 1];
+    for (int l = 0; l <= 4; ++l)
+    {
+        float splits[CASCADES + 1];
+        shadow_cascades_split(NEAR_PLANE, FAR_PLANE, CASCADES, l * 0.25f, splits);
+        ordered = ordered && splits[0] == NEAR_PLANE && splits[CASCADES] == FAR_PLANE;
+        for (int i = 0; i < CASCADES; ++i)
+            ordered = ordered && splits[i] < splits[i + 1];
+        memcpy(l == 0 ? uniform : logarithmic, splits, sizeof(splits));
+    }
+    for (int i = 1; i < CASCADES; ++i)
+        ordered = ordered && logarithmic[i] < uniform[i];
+    printf("  splits at lambda 1: %.2f %.2f %.2f %.2f %.2f\n", logarithmic[0], logarithmic[1], logarithmic[2],
+        logarithmic[3], logarithmic[4]);
+    ok = report("splits run near to far", ordered) && ok;
+
+    ShadowCascades sc;
+    const vec3 sun = { 0.3f, -0.4f, -1.f };
+    shadow_cascades_init(&sc, CASCADES, RESOLUTION, 0.75f, false);
+    shadow_cascades_set_light(&sc, sun);
+    fit_at(&sc, 0.f, 2.f, 0.f);
+    const uint32_t first = shadow_cascades_schedule(&sc);
+    ok = report("a first fit draws every cascade", first == (1u << CASCADES) - 1) && ok;
+
+    // A small step: the slices stay inside their maps, so nothing moves and nothing is drawn
+    ShadowCascades before = sc;
+    fit_at(&sc, 0.01f, 2.f, -0.01f);
+    bool still = shadow_cascades_schedule(&sc) == 0;
+    for (int i = 0; i < CASCADES; ++i)
+        still = still && !memcmp(sc.cascades[i].view_projection, before.cascades[i].view_projection, sizeof(mat4x4))
+            && sc.cascades[i].fits == before.cascades[i].fits;
+    ok = report("a small step leaves the maps where they are", still) && ok;
+
+    // A step past the margin: the near cascades move, each by whole texels
+    fit_at(&sc, 3.f, 2.f, -3.f);
+    float worst_snap = 0.f;
+    int moved = 0;
+    for (int i = 0; i < CASCADES; ++i)
+    {
+        const ShadowCascade* c = &sc.cascades[i];
+        if (c->fits == before.cascades[i].fits)
+            continue;
+        ++moved;
+        const float texel = 2.f * c->half_size / RESOLUTION;
+        for (int a = 0; a < 2; ++a)
+        {
+            const float off = fabsf(c->centre[a] / texel - floorf(c->centre[a] / texel + 0.5f));
+            worst_snap = off > worst_snap ? off : worst_snap;
+        }
+    }
+    printf("  3 m step: %d of %d cascades refitted, %.1e texels off the grid\n", moved, CASCADES, worst_snap);
+    ok = report("a refit lands on whole texels", moved > 0 && worst_snap < 1e-3f) && ok;
+
+    // Along a path with nothing changing, a cascade is only drawn when it's refitted
+    shadow_cascades_init(&sc, CASCADES, RESOLUTION, 0.75f, false);
+    shadow_cascades_set_light(&sc, sun);
+    for (int f = 0; f < frames; ++f)
+    {
+        fit_at(&sc, 0.02f * f, 2.f, -0.05f * f);
+        shadow_cascades_schedule(&sc);
+    }
+    bool cached = true;
+    printf("  path of %d frames, draws:", frames);
+    for (int i = 0; i < CASCADES; ++i)
+    {
+        printf(" %u", sc.cascades[i].draws);
+        cached = cached && sc.cascades[i].draws == sc.cascades[i].fits && sc.cascades[i].draws < (uint32_t)frames / 4;
+    }
+    printf("\n");
+    ok = report("still casters: drawn on refits alone", cached) && ok;
+
+    // Casters changing everywhere every frame: cascade i every 2^i frames
+    shadow_cascades_init(&sc, CASCADES, RESOLUTION, 0.75f, false);
+    shadow_cascades_set_light(&sc, sun);
+    fit_at(&sc, 0.f, 2.f, 0.f);
+    shadow_cascades_schedule(&sc);
+    const vec3 lo = { -1000.f, -1000.f, -1000.f }, hi = { 1000.f, 1000.f, 1000.f };
+    uint32_t draws[CASCADES] = {};
+    for (int i = 0; i < CASCADES; ++i)
+        draws[i] = sc.cascades[i].draws;
+    for (int f = 0; f < frames; ++f)
+    {
+        shadow_cascades_invalidate(&sc, lo, hi);
+        shadow_cascades_schedule(&sc);
+    }
+    bool paced = true;
+    printf("  changing casters, %d frames, draws:", frames);
+    for (int i = 0; i < CASCADES; ++i)
+    {
+        const uint32_t n = sc.cascades[i].draws - draws[i];
+        printf(" %u", n);
+        paced = paced && n == (uint32_t)frames >> i;
+    }
+    printf("\n");
+    ok = report("far cascades drawn every 2^i frames", paced) && ok;
+
+    // A box far off to the side reaches none of them
+    shadow_cascades_init(&sc, CASCADES, RESOLUTION, 0.75f, false);
+    shadow_cascades_set_light(&sc, sun);
+    fit_at(&sc, 0.f, 2.f, 0.f);
+    shadow_cascades_schedule(&sc);
+    const vec3 away_lo = { 5000.f, 5000.f, -1.f }, away_hi = { 5001.f, 5001.f, 1.f };
+    shadow_cascades_invalidate(&sc, away_lo, away_hi);
+    bool untouched = true;
+    for (int i = 0; i < CASCADES; ++i)
+        untouched = untouched && !sc.cascades[i].stale;
+    ok = report("changes out of reach draw nothing", untouched) && ok;
+
+    // A new light: every cascade refitted and drawn at once
+    const vec3 evening = { 1.f, -0.2f, -0.5f };
+    const bool changed = shadow_cascades_set_light(&sc, evening);
+    const bool unchanged = !shadow_cascades_set_light(&sc, evening);
+    fit_at(&sc, 0.f, 2.f, 0.f);
+    ok = report("a new light redraws every cascade",
+        changed && unchanged && shadow_cascades_schedule(&sc) == (1u << CASCADES) - 1) && ok;
+
+    const int fits = frames * 64;
+    const double t = now_ms();
+    for (int f = 0; f < fits; ++f)
+        fit_at(&sc, 0.001f * f, 2.f, -0.003f * f);
+    printf("  fit of %d cascades (and the camera's inverse): %.1f ns\n", CASCADES, (now_ms() - t) * 1e6 / fits);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
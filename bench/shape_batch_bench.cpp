@@ -0,0 +1,157 @@
+// 2D batch check (src/core/shape_batch.h): primitives sort into one bucket per layer and texture, in draw order,
+// whatever order they came in; every index stays inside its bucket; lines keep their width and circles get more
+// segments as they grow; a clear keeps the buckets' memory. Then times a frame of mixed primitives appended and
+// copied out the way gl/shape_renderer.h does.
+//
+// Usage: shape_batch_bench [primitives] [frames]
+
+#include "core/shape_batch.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static bool indices_valid(const ShapeBatch* b)
+{
+    for (int k = 0; k < b->bucket_count; ++k)
+        for (uint32_t i = 0; i < b->buckets[k].index_count; ++i)
+            if (b->buckets[k].indices[i] >= b->buckets[k].vertex_count)
+                return false;
+    return true;
+}
+
+static bool check_order(ShapeBatch* b)
+{
+    shape_batch_clear(b);
+    // Interleaved states: layer 1 before layer 0, two textures, back and forth
+    for (int i = 0; i < 100; ++i)
+    {
+        shape_batch_set_layer(b, i & 1);
+        shape_batch_set_texture(b, i % 3 == 0 ? 7 : 0);
+        shape_batch_rect(b, (float)i, 0.f, 1.f, 1.f, 0xFFFFFFFFu);
+    }
+    int order[SHAPE_BATCH_MAX_BUCKETS];
+    const int count = shape_batch_order(b, order);
+    bool sorted = count == 4;
+    for (int k = 1; k < count && sorted; ++k)
+        sorted = b->buckets[order[k - 1]].key < b->buckets[order[k]].key;
+    // Within a bucket, the order they came in: x rises
+    bool stable = true;
+    for (int k = 0; k < count; ++k)
+        for (uint32_t v = 4; v < b->buckets[order[k]].vertex_count; v += 4)
+            stable = stable && b->buckets[order[k]].vertices[v].pos[0] > b->buckets[order[k]].vertices[v - 4].pos[0];
+    return report("buckets per state, in draw order", sorted && stable && b->primitives == 100 && indices_valid(b));
+}
+
+static bool check_shapes(ShapeBatch* b)
+{
+    shape_batch_clear(b);
+    shape_batch_line(b, 0.f, 0.f, 10.f, 0.f, 4.f, 0xFFFFFFFFu);
+    const ShapeBucket* bucket = &b->buckets[b->current];
+    const bool line = bucket->vertex_count == 4 && fabsf(bucket->vertices[0].pos[1] - bucket->vertices[3].pos[1]) == 4.f
+        && bucket->index_count == 6;
+    shape_batch_circle(b, 0.f, 0.f, 1.f, 0xFFFFFFFFu);
+    const uint32_t small = bucket->vertex_count - 4 - 1;
+    shape_batch_circle(b, 0.f, 0.f, 30.f, 0xFFFFFFFFu);
+    const uint32_t large = bucket->vertex_count - 4 - (small + 1) - 1;
+    shape_batch_circle(b, 5.f, 5.f, 1000.f, 0xFFFFFFFFu);
+    const uint32_t capped = bucket->vertex_count - 4 - (small + 1) - (large + 1) - 1;
+    // The biggest circle's ring really is its radius from the centre
+    bool round = true;
+    for (uint32_t v = bucket->vertex_count - capped; v < bucket->vertex_count; ++v)
+    {
+        const float dx = bucket->vertices[v].pos[0] - 5.f, dy = bucket->vertices[v].pos[1] - 5.f;
+        round = round && fabsf(sqrtf(dx * dx + dy * dy) - 1000.f) < 0.5f;
+    }
+    shape_batch_line(b, 1.f, 1.f, 1.f, 1.f, 2.f, 0xFFFFFFFFu);    // no length: nothing
+    printf("  circle segments: %u at r = 1, %u at r = 30, %u at r = 1000\n", small, large, capped);
+    return report("lines and circles", line && small == 8 && large > small && capped == SHAPE_BATCH_CIRCLE_MAX && round
+        && b->primitives == 4 && indices_valid(b));
+}
+
+// A frame like the app's dashboard: panels under a layer of mixed primitives
+static void build(ShapeBatch* b, int count, float time)
+{
+    for (int c = 0; c < 16; ++c)
+        shape_batch_rect(b, c * 100.f, 0.f, 90.f, 90.f, 0x90201810u);
+    shape_batch_set_layer(b, 1);
+    for (int i = 0; i < count; ++i)
+    {
+        const float x = (float)(i % 1920), y = 540.f + 400.f * sinf(time + i * 0.01f);
+        switch (i & 3)
+        {
+        case 0: shape_batch_rect(b, x, y, 2.f, 1080.f - y, 0x80F0A040u); break;
+        case 1: shape_batch_line(b, x - 1.f, y - 2.f, x, y, 1.5f, 0xFF60E0FFu); break;
+        case 2: shape_batch_circle(b, x, y, 2.5f, 0xFF4080FFu); break;
+        default: shape_batch_triangle(b, x, y - 3.f, x - 3.f, y + 3.f, x + 3.f, y + 3.f, 0xFFFFFFFFu); break;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 ? atoi(argv[1]) : 200000;
+    const int frames = argc > 2 ? atoi(argv[2]) : 50;
+    ShapeBatch* b = (ShapeBatch*)malloc(sizeof(ShapeBatch));
+    shape_batch_init(b);
+    bool ok = check_order(b);
+    ok = check_shapes(b) && ok;
+
+    // The copy into one vertex and index region, indices rebased, as the renderer's flush does
+    build(b, count, 0.f);
+    uint32_t vertex_count = 0, index_count = 0;
+    shape_batch_totals(b, &vertex_count, &index_count);
+    ShapeVertex* vertices = (ShapeVertex*)malloc(sizeof(ShapeVertex) * vertex_count);
+    uint32_t* indices = (uint32_t*)malloc(sizeof(uint32_t) * index_count);
+    const ShapeVertex* kept = NULL;
+    int kept_bucket = 0;
+    double build_ms = 0.0, copy_ms = 0.0;
+    int draws = 0;
+    for (int f = 0; f < frames; ++f)
+    {
+        shape_batch_clear(b);
+        double t = now_ms();
+        build(b, count, f * 0.016f);
+        build_ms += now_ms() - t;
+        t = now_ms();
+        int order[SHAPE_BATCH_MAX_BUCKETS];
+        draws = shape_batch_order(b, order);
+        uint32_t v = 0, n = 0;
+        for (int k = 0; k < draws; ++k)
+        {
+            const ShapeBucket* bucket = &b->buckets[order[k]];
+            memcpy(vertices + v, bucket->vertices, sizeof(ShapeVertex) * bucket->vertex_count);
+            for (uint32_t i = 0; i < bucket->index_count; ++i)
+                indices[n + i] = bucket->indices[i] + v;
+            v += bucket->vertex_count;
+            n += bucket->index_count;
+        }
+        copy_ms += now_ms() - t;
+        if (f == 0)
+        {
+            kept_bucket = order[draws - 1];
+            kept = b->buckets[kept_bucket].vertices;
+        }
+    }
+    ok = report("clear keeps the buckets' memory", kept == b->buckets[kept_bucket].vertices && !b->dropped) && ok;
+    printf("  %d primitives: %u vertices, %u indices, %d draws; %.2f ms appending, %.2f ms copying a frame\n", count,
+        vertex_count, index_count, draws, build_ms / frames, copy_ms / frames);
+    free(indices);
+    free(vertices);
+    shape_batch_destroy(b);
+    free(b);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,193 @@
+// Shared-memory feed check (src/core/shared_feed.h): a producer thread and a consumer, each with a mapping of its
+// own as two processes would have. Opening a feed that isn't there fails quietly; every frame the consumer takes is
+// whole (each point tagged with its frame, the count the producer gave) and newer than the last; what it took and
+// what it skipped add up to what was published; a closed feed is let go and a new one, of another size, opened in its
+// place; and a consumer holding on to a frame keeps it whole while the producer carries on without waiting. Times
+// the consumer's copy of a frame, as into the renderer's stream buffer, and the producer's.
+//
+// Usage: shared_feed_bench [points] [frames]
+
+#include "core/shared_feed.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// The count frame "frame" has, a little under capacity so a wrong count shows
+static uint32_t frame_count(uint32_t capacity, uint64_t frame)
+{
+    return capacity - (uint32_t)(frame % 7);
+}
+
+typedef struct Producer
+{
+    const char* name;
+    uint32_t capacity;
+    int frames;
+    std::atomic<bool> created;
+    std::atomic<bool> done;
+    double ms;                  // publishing every frame
+} Producer;
+
+static void produce(Producer* p)
+{
+    SharedFeed feed;
+    if (!shared_feed_create(&feed, p->name, p->capacity))
+    {
+        p->done = true;
+        return;
+    }
+    p->created = true;
+    const double start = now_ms();
+    for (int f = 1; f <= p->frames; ++f)
+    {
+        FeedPoint* points = shared_feed_points(&feed);
+        const uint32_t count = frame_count(p->capacity, (uint64_t)f);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            points[i].pos[0] = (float)i;
+            points[i].pos[1] = points[i].pos[2] = 0.f;
+            points[i].color = (uint32_t)f;
+        }
+        shared_feed_publish(&feed, count, (uint64_t)f);
+    }
+    p->ms = now_ms() - start;
+    p->done = true;
+    while (p->created)      // until the consumer has seen the last frame
+        std::this_thread::yield();
+    shared_feed_close(&feed);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t points = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000000;
+    int frames = argc > 2 ? atoi(argv[2]) : 200;
+    points = points < 64 ? 64 : points;
+    frames = frames < 10 ? 10 : frames;
+    bool ok = true;
+
+    char name[48];
+    snprintf(name, sizeof(name), "bench-%ld", (long)(now_ms() * 1000.0) % 1000000);
+    SharedFeed consumer;
+    ok = report("no feed until it's created", !shared_feed_open(&consumer, name)) && ok;
+
+    // Frames whole and in order, the consumer copying each into a buffer as the renderer would
+    std::vector<FeedPoint> stream(points);
+    static Producer producer;
+    producer.name = name;
+    producer.capacity = points;
+    producer.frames = frames;
+    producer.created = false;
+    producer.done = false;
+    std::thread thread(produce, &producer);
+    while (!producer.created && !producer.done)
+        std::this_thread::yield();
+    bool opened = producer.created && shared_feed_open(&consumer, name);
+    ok = report("consumer opens the producer's feed", opened && consumer.header->capacity == points) && ok;
+    bool whole = opened, ordered = true;
+    uint64_t last = 0, received = 0;
+    double copy_ms = 0.0;
+    while (opened && last < (uint64_t)frames)
+    {
+        const FeedPoint* frame_points;
+        uint32_t count;
+        uint64_t frame;
+        if (!shared_feed_acquire(&consumer, &frame_points, &count, &frame))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        const double start = now_ms();
+        memcpy(stream.data(), frame_points, sizeof(FeedPoint) * count);
+        copy_ms += now_ms() - start;
+        ordered = ordered && frame > last;
+        whole = whole && count == frame_count(points, frame);
+        for (uint32_t i = 0; i < count && whole; i += 1 + i / 64)
+            whole = stream[i].color == (uint32_t)frame && stream[i].pos[0] == (float)i;
+        whole = whole && stream[count - 1].color == (uint32_t)frame;
+        last = frame;
+        ++received;
+    }
+    producer.created = false;
+    thread.join();
+    printf("  %llu of %d frames taken, %llu skipped; producer %.2f ms a frame of %u points\n",
+        (unsigned long long)received, frames, (unsigned long long)consumer.skipped, producer.ms / frames, points);
+    printf("  consumer copy: %.2f ms a frame, %.1f GB/s\n", copy_ms / (received ? received : 1),
+        received && copy_ms > 0.0 ? sizeof(FeedPoint) * (double)points * received / copy_ms / 1e6 : 0.0);
+    ok = report("every frame taken is whole", whole) && ok;
+    ok = report("frames come newest last", ordered && last == (uint64_t)frames) && ok;
+    ok = report("taken and skipped add up to published", received + consumer.skipped == (uint64_t)frames) && ok;
+    ok = report("a closed feed is seen as closed", opened && shared_feed_closed(&consumer)) && ok;
+    shared_feed_close(&consumer);
+
+    // A new producer under the same name, half the size: the consumer opens it as it is
+    {
+        static Producer again;
+        again.name = name;
+        again.capacity = points / 2;
+        again.frames = 3;
+        again.created = false;
+        again.done = false;
+        std::thread second(produce, &again);
+        while (!again.done)
+            std::this_thread::yield();
+        bool reopened = shared_feed_open(&consumer, name);
+        const FeedPoint* frame_points = NULL;
+        uint32_t count = 0;
+        uint64_t frame = 0;
+        reopened = reopened && consumer.header->capacity == points / 2
+            && shared_feed_acquire(&consumer, &frame_points, &count, &frame) && frame == 3
+            && count == frame_count(points / 2, 3) && frame_points[count - 1].color == 3u;
+        again.created = false;
+        second.join();
+        ok = report("a new feed by the same name is opened", reopened) && ok;
+        shared_feed_close(&consumer);
+    }
+
+    // A consumer that holds on to a frame: the producer publishes the rest without waiting, and the frame held
+    // stays as it was
+    {
+        static Producer held;
+        held.name = name;
+        held.capacity = points;
+        held.frames = frames;
+        held.created = false;
+        held.done = false;
+        std::thread busy(produce, &held);
+        while (!held.created && !held.done)
+            std::this_thread::yield();
+        const FeedPoint* frame_points = NULL;
+        uint32_t count = 0;
+        uint64_t frame = 0;
+        bool kept = shared_feed_open(&consumer, name);
+        while (kept && !held.done && !shared_feed_acquire(&consumer, &frame_points, &count, &frame))
+            std::this_thread::yield();
+        while (!held.done)
+            std::this_thread::yield();
+        kept = kept && frame_points && frame < (uint64_t)frames;
+        for (uint32_t i = 0; kept && i < count; ++i)
+            kept = frame_points[i].color == (uint32_t)frame;
+        held.created = false;
+        busy.join();
+        shared_feed_close(&consumer);
+        printf("  producer %.2f ms a frame while the consumer held frame %llu\n", held.ms / frames,
+            (unsigned long long)frame);
+        ok = report("a frame held stays whole as the producer runs", kept) && ok;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
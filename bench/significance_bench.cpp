@@ -0,0 +1,209 @@
+// Significance (scene/significance.h): a plain of objects seen from a low perspective camera, a band of them in
+// view. The tiers chosen must match the pixel sizes worked out directly; over SIGNIFICANCE_MAX_PERIOD frames of a
+// still camera every object in view must be updated exactly as often as its tier says, the updates spread evenly
+// over the frames; objects coming into view must be updated the frame they do, those out of view never, and
+// nothing in view may go longer than SIGNIFICANCE_MAX_PERIOD frames without one while the band slides. Then the
+// filtering and the scoring of what's due are timed against scoring everything every frame, serially and on the
+// job system.
+//
+// Usage: significance_bench [objects] [full pixels]
+
+#include "core/job_system.h"
+#include "scene/lod.h"
+#include "scene/significance.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SPREAD 400.f        // the plain's half-width
+#define VIEWPORT_HEIGHT 1080.f
+#define FRAMES 64
+#define GRAIN 4096
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Looking along +y from low over the plain's edge, "forward" units in
+static void camera_at(float forward, mat4x4 view_projection)
+{
+    vec3 eye = { 0.f, forward - SPREAD, 3.f }, center = { 0.f, forward, 0.f }, up = { 0.f, 0.f, 1.f };
+    mat4x4 projection, view;
+    mat4x4_perspective(projection, 1.f, 16.f / 9.f, 0.1f, 4.f * SPREAD);
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(view_projection, projection, view);
+}
+
+// The objects within a band of x: "in view", as a frustum cull would leave them, in order
+static size_t band(const std::vector<float>& x, float lo, float hi, std::vector<uint32_t>* visible)
+{
+    size_t n = 0;
+    for (uint32_t i = 0; i < (uint32_t)x.size(); ++i)
+    {
+        if (x[i] >= lo && x[i] < hi)
+            (*visible)[n++] = i;
+    }
+    return n;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t count = argc > 1 && atoi(argv[1]) > 0 ? (uint32_t)atoi(argv[1]) : 1000000;
+    const float full = argc > 2 && atof(argv[2]) > 0.0 ? (float)atof(argv[2]) : 32.f;
+    unsigned int state = 12345u;
+    bool ok = true;
+
+    std::vector<float> x(count), y(count), radius(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        x[i] = random_float(&state, -SPREAD, SPREAD);
+        y[i] = random_float(&state, -SPREAD, SPREAD);
+        radius[i] = random_float(&state, 0.2f, 1.f);
+    }
+    mat4x4 vp;
+    camera_at(0.f, vp);
+    Significance sig;
+    if (!significance_init(&sig, count, full))
+    {
+        fprintf(stderr, "significance_bench: out of memory\n");
+        return 1;
+    }
+    std::vector<uint32_t> visible(count), due(count);
+    size_t n = band(x, -0.25f * SPREAD, 0.25f * SPREAD, &visible);
+
+    // The first frame: everything in view just came into it
+    size_t d = significance_due(&sig, visible.data(), n, due.data());
+    SignificanceScoring scoring = { &sig, vp, VIEWPORT_HEIGHT, x.data(), y.data(), NULL, radius.data(), due.data() };
+    significance_score_range(&scoring, 0, d);
+    significance_count(&sig, due.data(), d);
+    ok = report("everything in view is due as it comes into view", d == n) && ok;
+    size_t wrong = 0;
+    uint64_t per_tier[SIGNIFICANCE_TIERS] = {};
+    for (size_t k = 0; k < n; ++k)
+    {
+        const uint32_t i = visible[k];
+        const float pixels = 2.f * radius[i] * lod_pixel_scale(vp, x[i], y[i], 0.f, VIEWPORT_HEIGHT);
+        int want = 0;
+        while (want + 1 < SIGNIFICANCE_TIERS && pixels * (float)(1 << want) < full)
+            ++want;
+        wrong += sig.tier[i] != want;
+        ++per_tier[sig.tier[i]];
+    }
+    ok = report("tiers follow the objects' sizes in pixels", wrong == 0) && ok;
+
+    // A still camera: each tier's objects updated 8 >> tier times in 8 frames, the frames' shares even
+    std::vector<uint8_t> updates(count, 0);
+    size_t fewest = n, most = 0, total = 0;
+    for (uint32_t f = 0; f < SIGNIFICANCE_MAX_PERIOD; ++f)
+    {
+        d = significance_due(&sig, visible.data(), n, due.data());
+        significance_score_range(&scoring, 0, d);
+        for (size_t k = 0; k < d; ++k)
+            ++updates[due[k]];
+        total += d;
+        fewest = d < fewest ? d : fewest;
+        most = d > most ? d : most;
+    }
+    size_t off_rate = 0;
+    for (size_t k = 0; k < n; ++k)
+        off_rate += updates[visible[k]] != SIGNIFICANCE_MAX_PERIOD >> sig.tier[visible[k]];
+    ok = report("each tier updated at its rate", off_rate == 0) && ok;
+    ok = report("the updates spread evenly over the frames", most - fewest <= total / SIGNIFICANCE_MAX_PERIOD / 4 + 16)
+        && ok;
+
+    // The band slides along x: what enters is due at once, what's outside never, and nothing in view waits long
+    std::vector<uint32_t> last(count, 0);
+    std::vector<uint8_t> in_view(count, 0);
+    for (size_t k = 0; k < n; ++k)
+        in_view[visible[k]] = 1;
+    bool entered_ok = true, outside_ok = true;
+    uint32_t longest = 0;
+    for (uint32_t f = 1; f <= FRAMES; ++f)
+    {
+        const float lo = -0.25f * SPREAD + 4.f * (float)f;
+        const size_t m = band(x, lo, lo + 0.5f * SPREAD, &visible);
+        d = significance_due(&sig, visible.data(), m, due.data());
+        significance_score_range(&scoring, 0, d);
+        std::vector<uint8_t> now(count, 0), is_due(count, 0);
+        for (size_t k = 0; k < m; ++k)
+            now[visible[k]] = 1;
+        for (size_t k = 0; k < d; ++k)
+        {
+            is_due[due[k]] = 1;
+            outside_ok = outside_ok && now[due[k]];
+        }
+        for (size_t k = 0; k < m; ++k)
+        {
+            const uint32_t i = visible[k];
+            entered_ok = entered_ok && (in_view[i] || is_due[i]);
+            if (is_due[i] || !in_view[i])
+                last[i] = f;
+            longest = f - last[i] > longest ? f - last[i] : longest;
+        }
+        in_view.swap(now);
+    }
+    ok = report("objects are due the frame they come into view", entered_ok) && ok;
+    ok = report("objects out of view are never due", outside_ok) && ok;
+    ok = report("nothing in view waits past the slowest tier", longest < SIGNIFICANCE_MAX_PERIOD) && ok;
+    printf("  %zu of %u objects in view; tiers every 1/2/4/8 frames: %llu %llu %llu %llu\n", n, count,
+        (unsigned long long)per_tier[0], (unsigned long long)per_tier[1], (unsigned long long)per_tier[2],
+        (unsigned long long)per_tier[3]);
+    significance_print(&sig, stdout);
+
+    // Timed: a still camera, due and scored against every visible object scored every frame
+    JobSystem jobs;
+    if (!job_system_init(&jobs, 0))
+    {
+        fprintf(stderr, "significance_bench: can't start the job system\n");
+        return 1;
+    }
+    n = band(x, -0.25f * SPREAD, 0.25f * SPREAD, &visible);
+    SignificanceScoring everything = scoring;
+    everything.objects = visible.data();
+    double all_serial = 0.0, due_serial = 0.0, all_jobs = 0.0, due_jobs = 0.0;
+    uint64_t due_total = 0;
+    for (int f = 0; f < FRAMES; ++f)
+    {
+        double t0 = now_ms();
+        significance_score_range(&everything, 0, n);
+        all_serial += now_ms() - t0;
+        t0 = now_ms();
+        d = significance_due(&sig, visible.data(), n, due.data());
+        significance_score_range(&scoring, 0, d);
+        due_serial += now_ms() - t0;
+        due_total += d;
+        t0 = now_ms();
+        job_wait(&jobs, job_parallel_for(&jobs, significance_score_range, &everything, n, GRAIN));
+        all_jobs += now_ms() - t0;
+        t0 = now_ms();
+        d = significance_due(&sig, visible.data(), n, due.data());
+        job_wait(&jobs, job_parallel_for(&jobs, significance_score_range, &scoring, d, GRAIN));
+        due_jobs += now_ms() - t0;
+    }
+    printf("per frame over %d frames, %zu objects in view, %.1f%% due, %d job threads:\n", FRAMES, n,
+        100.0 * due_total / FRAMES / (n ? n : 1), jobs.thread_count);
+    printf("  %-22s %8.3f ms serial %8.3f ms jobs\n", "everything scored", all_serial / FRAMES, all_jobs / FRAMES);
+    printf("  %-22s %8.3f ms serial %8.3f ms jobs\n", "filtered, due scored", due_serial / FRAMES,
+        due_jobs / FRAMES);
+    job_system_destroy(&jobs);
+    significance_destroy(&sig);
+
+    printf("%s\n", ok ? "significance_bench: ok" : "significance_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,350 @@
+// Software renderer check (src/core/software_renderer.h): a convex fan drawn with every pixel centre inside it
+// written exactly once and none outside; colour interpolated to a third each at a triangle's centroid and
+// perspective-correct across a tilted quad, against each pixel's ray through the quad; a ground plane through the
+// near plane drawn as well; nearer objects winning whatever their order and the later one at equal depth, for both
+// depth conventions. Then a scene of many small objects drawn serially and on the job system, the frames hashed the
+// same, with each step's time.
+//
+// Usage: software_renderer_bench [objects] [width] [height]
+
+#include "core/job_system.h"
+#include "core/software_renderer.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define FRAMES 10
+#define RIM 12              // the fan's outer vertices
+#define COLOUR_TOLERANCE 2  // of 255
+
+typedef struct Vertex
+{
+    float pos[2];
+    float col[3];
+} Vertex;
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static bool init(SoftwareRenderer* r, JobSystem* jobs, const std::vector<Vertex>& vertices,
+    const std::vector<uint32_t>& indices, uint32_t max_objects, int width, int height)
+{
+    SoftwareRendererDesc desc = {};
+    desc.vertices = vertices.data();
+    desc.vertex_size = sizeof(Vertex);
+    desc.vertex_count = vertices.size();
+    desc.indices = indices.data();
+    desc.index_count = indices.size();
+    desc.max_objects = max_objects;
+    desc.width = width;
+    desc.height = height;
+    return software_renderer_init(r, jobs, &desc);
+}
+
+// Draws "count" objects serially and returns the frame's pixels
+static std::vector<uint32_t> draw(SoftwareRenderer* r, mat4x4 const view_projection, bool reversed_z,
+    const mat4x4* models, int count)
+{
+    mat3x4* buffer = software_renderer_begin_frame(r);
+    for (int i = 0; i < count; ++i)
+        mat3x4_from_mat4x4(buffer[i], models[i]);
+    software_renderer_draw(r, NULL, view_projection, reversed_z, count);
+    std::vector<uint32_t> pixels((size_t)r->width * r->height);
+    for (int y = 0; y < r->height; ++y)
+        for (int x = 0; x < r->width; ++x)
+            pixels[(size_t)y * r->width + x] = software_renderer_pixel(r, x, y);
+    return pixels;
+}
+
+static int channel(uint32_t pixel, int c)
+{
+    return (int)(pixel >> (8 * c) & 0xFF);
+}
+
+// A vertex's pixel coordinate as the renderer snaps it, for an identity view-projection
+static double snapped(float ndc, int size)
+{
+    const float sub = (float)(1 << SOFTWARE_SUBPIXEL_BITS);
+    return floorf((ndc + 1.f) * (0.5f * (float)size) * sub + 0.5f) / sub;
+}
+
+// Every pixel centre strictly inside the fan written once, none outside it; centres on its rim may go either way
+static bool fan_check()
+{
+    const int width = 200, height = 150;
+    std::vector<Vertex> vertices = { { { 0.03f, 0.01f }, { 1.f, 1.f, 1.f } } };
+    std::vector<uint32_t> indices;
+    for (int i = 0; i < RIM; ++i)
+    {
+        const float angle = 6.2831853f * ((float)i + 0.3f * sinf(3.7f * (float)i)) / RIM;
+        vertices.push_back({ { 0.85f * cosf(angle), 0.8f * sinf(angle) }, { 0.5f, (float)i / RIM, 0.25f } });
+        indices.insert(indices.end(), { 0u, 1u + (uint32_t)i, 1u + (uint32_t)((i + 1) % RIM) });
+    }
+    SoftwareRenderer r;
+    if (!init(&r, NULL, vertices, indices, 1, width, height))
+        return false;
+    mat4x4 identity;
+    mat4x4_identity(identity);
+    const std::vector<uint32_t> pixels = draw(&r, identity, false, &identity, 1);
+
+    double rx[RIM], ry[RIM];
+    for (int i = 0; i < RIM; ++i)
+    {
+        rx[i] = snapped(vertices[1 + i].pos[0], width);
+        ry[i] = snapped(vertices[1 + i].pos[1], height);
+    }
+    size_t inside = 0, on_rim = 0, covered = 0, stray = 0;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            double least = 1e30;
+            for (int i = 0; i < RIM; ++i)
+            {
+                const int j = (i + 1) % RIM;
+                const double e = (rx[j] - rx[i]) * (y + 0.5 - ry[i]) - (ry[j] - ry[i]) * (x + 0.5 - rx[i]);
+                least = e < least ? e : least;
+            }
+            const bool drawn = pixels[(size_t)y * width + x] != 0;
+            inside += least > 0.0;
+            on_rim += least == 0.0;
+            covered += drawn;
+            stray += drawn && least < 0.0;
+        }
+    char what[96];
+    snprintf(what, sizeof(what), "fan: %zu centres inside, %zu on the rim, %zu drawn", inside, on_rim, covered);
+    const bool ok = report(what, r.pixels_written == covered && covered >= inside && covered <= inside + on_rim
+        && stray == 0 && r.triangles_binned == RIM);
+    software_renderer_destroy(&r);
+    return ok;
+}
+
+static bool centroid_check()
+{
+    const std::vector<Vertex> vertices = { { { -0.6f, -0.5f }, { 1.f, 0.f, 0.f } },
+        { { 0.7f, -0.4f }, { 0.f, 1.f, 0.f } }, { { 0.f, 0.8f }, { 0.f, 0.f, 1.f } } };
+    const std::vector<uint32_t> indices = { 0, 1, 2 };
+    SoftwareRenderer r;
+    if (!init(&r, NULL, vertices, indices, 1, 256, 256))
+        return false;
+    mat4x4 identity;
+    mat4x4_identity(identity);
+    const std::vector<uint32_t> pixels = draw(&r, identity, false, &identity, 1);
+    const int x = (int)((0.1f / 3.f + 1.f) * 128.f), y = (int)((-0.1f / 3.f + 1.f) * 128.f);
+    const uint32_t p = pixels[(size_t)y * 256 + x];
+    bool ok = p >> 24 == 0xFF;
+    for (int c = 0; c < 3; ++c)
+        ok = ok && abs(channel(p, c) - 85) <= 3;
+    software_renderer_destroy(&r);
+    return report("a third of each vertex's colour at the centroid", ok);
+}
+
+// The quad (-1, -1) to (1, 1) in its z = 0 plane, red (y + 1) / 2 and blue (x + 1) / 2, drawn through
+// "projection" * "model": every covered pixel's colour against where its ray meets the quad. Returns the pixels
+// covered, or -1 when one is off by more than COLOUR_TOLERANCE.
+static long quad_check(mat4x4 const projection, mat4x4 const model, int width, int height, int* worst)
+{
+    const std::vector<Vertex> vertices = { { { -1.f, -1.f }, { 0.f, 0.f, 0.f } }, { { 1.f, -1.f }, { 0.f, 0.f, 1.f } },
+        { { 1.f, 1.f }, { 1.f, 0.f, 1.f } }, { { -1.f, 1.f }, { 1.f, 0.f, 0.f } } };
+    const std::vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
+    SoftwareRenderer r;
+    if (!init(&r, NULL, vertices, indices, 1, width, height))
+        return -1;
+    mat4x4 m;
+    mat4x4_dup(m, model);
+    const std::vector<uint32_t> pixels = draw(&r, projection, false, &m, 1);
+    mat4x4 mvp, inverse;
+    mat4x4_mul(mvp, projection, model);
+    mat4x4_invert(inverse, mvp);
+    long covered = 0;
+    *worst = 0;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            const uint32_t p = pixels[(size_t)y * width + x];
+            if (!p)
+                continue;
+            ++covered;
+            vec4 ends[2];
+            for (int e = 0; e < 2; ++e)
+            {
+                const vec4 ndc = { 2.f * (x + 0.5f) / width - 1.f, 2.f * (y + 0.5f) / height - 1.f, e ? 1.f : -1.f,
+                    1.f };
+                mat4x4_mul_vec4(ends[e], inverse, ndc);
+                for (int c = 0; c < 3; ++c)
+                    ends[e][c] /= ends[e][3];
+            }
+            const double t = ends[0][2] / (ends[0][2] - ends[1][2]);
+            const double qx = ends[0][0] + t * (ends[1][0] - ends[0][0]);
+            const double qy = ends[0][1] + t * (ends[1][1] - ends[0][1]);
+            const int red = (int)lround(fmin(fmax((qy + 1.0) / 2.0, 0.0), 1.0) * 255.0);
+            const int blue = (int)lround(fmin(fmax((qx + 1.0) / 2.0, 0.0), 1.0) * 255.0);
+            const int off = abs(channel(p, 0) - red) > abs(channel(p, 2) - blue) ? abs(channel(p, 0) - red)
+                : abs(channel(p, 2) - blue);
+            *worst = off > *worst ? off : *worst;
+        }
+    software_renderer_destroy(&r);
+    return *worst <= COLOUR_TOLERANCE ? covered : -1;
+}
+
+static bool perspective_checks()
+{
+    const int width = 320, height = 240;
+    mat4x4 projection, model, tilt;
+    mat4x4_perspective(projection, 1.0f, (float)width / height, 0.1f, 100.f);
+    bool ok = true;
+
+    // Tilted away: colour linear along the quad, not across the screen
+    mat4x4_translate(model, 0.f, 0.f, -2.5f);
+    mat4x4_rotate_X(tilt, model, -1.1f);
+    int worst = 0;
+    long covered = quad_check(projection, tilt, width, height, &worst);
+    char what[96];
+    snprintf(what, sizeof(what), "perspective-correct on a tilted quad (%ld px, off %d)", covered, worst);
+    ok = report(what, covered > 1000) && ok;
+
+    // A ground plane from behind the eye to far away: clipped to the near plane and the guard band
+    mat4x4 ground;
+    mat4x4_translate(model, 0.f, -0.5f, 0.f);
+    mat4x4_rotate_X(tilt, model, -1.5707963f);
+    mat4x4_scale_aniso(ground, tilt, 20.f, 20.f, 1.f);
+    covered = quad_check(projection, ground, width, height, &worst);
+    snprintf(what, sizeof(what), "a ground plane through the near plane (%ld px, off %d)", covered, worst);
+    return report(what, covered > width * height / 4) && ok;
+}
+
+// Objects "a" and "b" (one triangle each, overlapping), drawn alone and together in both orders: where both cover
+// a pixel, "winner" (0 or 1) must show
+static bool depth_check(const char* what, mat4x4 const a, mat4x4 const b, bool reversed_z, int winner,
+    bool order_matters)
+{
+    const std::vector<Vertex> vertices = { { { -0.5f, -0.5f }, { 1.f, 0.f, 0.f } },
+        { { 0.5f, -0.5f }, { 0.f, 1.f, 0.f } }, { { 0.f, 0.5f }, { 0.f, 0.f, 1.f } } };
+    const std::vector<uint32_t> indices = { 0, 1, 2 };
+    SoftwareRenderer r;
+    if (!init(&r, NULL, vertices, indices, 2, 128, 128))
+        return false;
+    mat4x4 identity, models[2];
+    mat4x4_identity(identity);
+    mat4x4_dup(models[0], a);
+    const std::vector<uint32_t> only_a = draw(&r, identity, reversed_z, models, 1);
+    mat4x4_dup(models[0], b);
+    const std::vector<uint32_t> only_b = draw(&r, identity, reversed_z, models, 1);
+    mat4x4_dup(models[0], a);
+    mat4x4_dup(models[1], b);
+    const std::vector<uint32_t> ab = draw(&r, identity, reversed_z, models, 2);
+    mat4x4_dup(models[0], b);
+    mat4x4_dup(models[1], a);
+    const std::vector<uint32_t> ba = draw(&r, identity, reversed_z, models, 2);
+    size_t both = 0;
+    bool ok = true;
+    for (size_t i = 0; i < ab.size(); ++i)
+    {
+        const uint32_t first = winner == 0 ? only_a[i] : only_b[i], second = winner == 0 ? only_b[i] : only_a[i];
+        both += only_a[i] && only_b[i];
+        ok = ok && ab[i] == (first ? first : second);
+        if (!order_matters)
+            ok = ok && ba[i] == ab[i];
+    }
+    software_renderer_destroy(&r);
+    return report(what, ok && both > 100);
+}
+
+static bool depth_checks()
+{
+    mat4x4 a, b;
+    bool ok = true;
+    mat4x4_translate(a, -0.1f, 0.f, -0.5f);
+    mat4x4_translate(b, 0.1f, 0.05f, 0.5f);
+    ok = depth_check("the nearer object wins in either order", a, b, false, 0, false) && ok;
+    mat4x4_translate(a, -0.1f, 0.f, 0.75f);
+    mat4x4_translate(b, 0.1f, 0.05f, 0.25f);
+    ok = depth_check("... and with reversed Z", a, b, true, 0, false) && ok;
+    mat4x4_translate(a, -0.1f, 0.f, 0.25f);
+    mat4x4_translate(b, 0.1f, 0.05f, 0.25f);
+    ok = depth_check("at equal depth the later object wins", a, b, false, 1, true) && ok;
+    return depth_check("... and with reversed Z", a, b, true, 1, true) && ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 50000;
+    const int width = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 1920;
+    const int height = argc > 3 && atoi(argv[3]) > 0 ? atoi(argv[3]) : 1080;
+    bool ok = true;
+    ok = fan_check() && ok;
+    ok = centroid_check() && ok;
+    ok = perspective_checks() && ok;
+    ok = depth_checks() && ok;
+
+    // A scene of small triangles scattered in front of the eye, as main.cpp's
+    const std::vector<Vertex> vertices = { { { -0.6f, -0.4f }, { 1.f, 0.f, 0.f } },
+        { { 0.6f, -0.4f }, { 0.f, 1.f, 0.f } }, { { 0.f, 0.6f }, { 0.f, 0.f, 1.f } } };
+    const std::vector<uint32_t> indices = { 0, 1, 2 };
+    JobSystem jobs;
+    SoftwareRenderer serial, threaded;
+    if (!job_system_init(&jobs, 0) || !init(&serial, NULL, vertices, indices, (uint32_t)count, width, height)
+        || !init(&threaded, &jobs, vertices, indices, (uint32_t)count, width, height))
+    {
+        fprintf(stderr, "software_renderer_bench: out of memory\n");
+        return 1;
+    }
+    mat4x4 projection;
+    mat4x4_perspective(projection, 1.0f, (float)width / height, 0.1f, 200.f);
+    unsigned int state = 12345;
+    std::vector<mat3x4> models((size_t)count);
+    for (mat3x4& m : models)
+    {
+        mat4x4 placed, turned;
+        const float z = random_float(&state, -120.f, -10.f);
+        mat4x4_translate(placed, random_float(&state, 0.6f, -0.6f) * z, random_float(&state, 0.35f, -0.35f) * z, z);
+        mat4x4_rotate_Z(turned, placed, random_float(&state, 0.f, 6.2831853f));
+        mat3x4_from_mat4x4(m, turned);
+    }
+
+    double times[2] = { 0.0, 0.0 };
+    SoftwareRenderer* renderers[2] = { &serial, &threaded };
+    for (int f = 0; f < FRAMES; ++f)
+        for (int k = 0; k < 2; ++k)
+        {
+            memcpy(software_renderer_begin_frame(renderers[k]), models.data(), sizeof(mat3x4) * count);
+            const double t0 = now_ms();
+            software_renderer_draw(renderers[k], k ? &jobs : NULL, projection, false, count);
+            times[k] += now_ms() - t0;
+        }
+    ok = report("the same frame on 1 thread and on the job system",
+        software_renderer_hash(&serial) == software_renderer_hash(&threaded)
+        && serial.pixels_written == threaded.pixels_written && serial.triangles_dropped == 0) && ok;
+
+    printf("%d objects at %dx%d, %d job threads, per frame over %d frames:\n", count, width, height,
+        jobs.thread_count, FRAMES);
+    printf("  %-22s %8.3f ms (setup %.3f, raster %.3f)\n", "serial", times[0] / FRAMES, serial.setup_ms / FRAMES,
+        serial.raster_ms / FRAMES);
+    printf("  %-22s %8.3f ms (setup %.3f, raster %.3f)\n", "jobs", times[1] / FRAMES, threaded.setup_ms / FRAMES,
+        threaded.raster_ms / FRAMES);
+    printf("  %-22s %8.1f triangles, %.0f pixels\n", "drawn", (double)threaded.triangles_binned / FRAMES,
+        (double)threaded.pixels_written / FRAMES);
+
+    software_renderer_destroy(&serial);
+    software_renderer_destroy(&threaded);
+    job_system_destroy(&jobs);
+    printf("%s\n", ok ? "software_renderer_bench: ok" : "software_renderer_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,297 @@
+// Spatial hash grid check: a swarm of boxes that all move every frame. The grid's box, sphere, nearest, frustum
+// and ray answers are compared with brute-force ones, and a build on the job system must come out identical to a
+// serial one. Then the swarm flies for "frames" frames, each timed four ways: the grid rebuilt serially and on
+// the job system, the BVH refit (keeping the tree from the first frame) and the BVH rebuilt, each followed by the
+// frame's cull and its neighbour queries, radius queries around every 64th object.
+//
+// Usage: spatial_grid_bench [objects] [frames] [cell size]
+
+#include "core/job_system.h"
+#include "scene/bvh.h"
+#include "scene/spatial_grid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SPREAD 200.f
+#define NEIGHBOUR_RADIUS 2.f
+#define NEIGHBOUR_STRIDE 64
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+typedef struct Swarm
+{
+    std::vector<Aabb> bounds;
+    std::vector<float> vx, vy, vz;
+} Swarm;
+
+static void swarm_place(Swarm* w, unsigned int* state)
+{
+    for (size_t i = 0; i < w->bounds.size(); ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const float c = random_float(state, -SPREAD, SPREAD);
+            const float e = random_float(state, 0.05f, 0.5f);
+            w->bounds[i].min[k] = c - e;
+            w->bounds[i].max[k] = c + e;
+        }
+        w->vx[i] = random_float(state, -1.f, 1.f);
+        w->vy[i] = random_float(state, -1.f, 1.f);
+        w->vz[i] = random_float(state, -1.f, 1.f);
+    }
+}
+
+// Everything moves; a box leaving the cube turns back
+static void swarm_move(Swarm* w)
+{
+    for (size_t i = 0; i < w->bounds.size(); ++i)
+    {
+        float* v[3] = { &w->vx[i], &w->vy[i], &w->vz[i] };
+        for (int k = 0; k < 3; ++k)
+        {
+            const float c = 0.5f * (w->bounds[i].min[k] + w->bounds[i].max[k]);
+            if ((c > SPREAD && *v[k] > 0.f) || (c < -SPREAD && *v[k] < 0.f))
+                *v[k] = -*v[k];
+            w->bounds[i].min[k] += *v[k];
+            w->bounds[i].max[k] += *v[k];
+        }
+    }
+}
+
+static float box_distance(const Aabb* b, const vec3 p)
+{
+    float d = 0.f;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float v = fmaxf(fmaxf(b->min[k] - p[k], p[k] - b->max[k]), 0.f);
+        d += v * v;
+    }
+    return sqrtf(d);
+}
+
+static bool overlaps(const Aabb* b, const vec3 min, const vec3 max)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        if (b->max[k] < min[k] || b->min[k] > max[k])
+            return false;
+    }
+    return true;
+}
+
+static bool same_set(std::vector<uint32_t> a, size_t a_count, std::vector<uint32_t> b)
+{
+    a.resize(a_count);
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Every answer the grid gives must match the brute-force one
+static bool check(const SpatialGrid* grid, const Swarm* w, const Frustum* frustum)
+{
+    const size_t n = w->bounds.size();
+    unsigned int state = 7u;
+    std::vector<uint32_t> got(n), want;
+    bool boxes = true, spheres = true, nearest = true, rays = true;
+    for (int q = 0; q < 64; ++q)
+    {
+        const vec3 c = { random_float(&state, -SPREAD, SPREAD), random_float(&state, -SPREAD, SPREAD),
+            random_float(&state, -SPREAD, SPREAD) };
+        const float r = q < 60 ? random_float(&state, 0.5f, 8.f) : 150.f;     // the last few cover most cells
+        const vec3 min = { c[0] - r, c[1] - 0.5f * r, c[2] - r }, max = { c[0] + r, c[1] + r, c[2] + 0.5f * r };
+        want.clear();
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (overlaps(&w->bounds[i], min, max))
+                want.push_back((uint32_t)i);
+        }
+        boxes = boxes && same_set(got, spatial_grid_query_box(grid, min, max, got.data(), n), want);
+        want.clear();
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (box_distance(&w->bounds[i], c) <= r)
+                want.push_back((uint32_t)i);
+        }
+        spheres = spheres && same_set(got, spatial_grid_query_sphere(grid, c, r, got.data(), n), want);
+
+        float best = FLT_MAX;
+        for (size_t i = 0; i < n; ++i)
+            best = fminf(best, box_distance(&w->bounds[i], c));
+        float distance = -1.f;
+        const int64_t near = spatial_grid_nearest(grid, c, 50.f, &distance);
+        nearest = nearest && (best > 50.f ? near < 0 : near >= 0 && fabsf(distance - best) <= 1e-4f * (1.f + best));
+    }
+    for (int r = 0; r < 64; ++r)
+    {
+        const vec3 origin = { 0.f, 0.f, 0.f };
+        vec3 dir = { random_float(&state, -1.f, 1.f), random_float(&state, -1.f, 1.f),
+            random_float(&state, -1.f, 1.f) };
+        vec3_norm(dir, dir);
+        float best = FLT_MAX;
+        for (size_t i = 0; i < n; ++i)
+        {
+            float t0 = 0.f, t1 = 1000.f;
+            for (int k = 0; k < 3; ++k)
+            {
+                const float a = (w->bounds[i].min[k] - origin[k]) / dir[k];
+                const float b = (w->bounds[i].max[k] - origin[k]) / dir[k];
+                t0 = fmaxf(t0, fminf(a, b));
+                t1 = fminf(t1, fmaxf(a, b));
+            }
+            if (t0 <= t1 && t0 < best)
+                best = t0;
+        }
+        float t = FLT_MAX;
+        const int64_t hit = spatial_grid_raycast(grid, origin, dir, 1000.f, NULL, NULL, &t);
+        rays = rays && (hit < 0) == (best == FLT_MAX) && (hit < 0 || fabsf(t - best) <= 1e-4f * (1.f + best));
+    }
+    want.clear();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (frustum_aabb_planes(frustum, w->bounds[i].min, w->bounds[i].max, 0x3F) >= 0)
+            want.push_back((uint32_t)i);
+    }
+    const bool cull = same_set(got, spatial_grid_cull(grid, frustum, got.data()), want);
+    bool ok = report("box queries match brute force", boxes);
+    ok = report("sphere queries match brute force", spheres) && ok;
+    ok = report("nearest objects match brute force", nearest) && ok;
+    ok = report("rays hit what brute force hits", rays) && ok;
+    return report("frustum cull matches brute force", cull) && ok;
+}
+
+static bool same_grid(const SpatialGrid* a, const SpatialGrid* b)
+{
+    return a->count == b->count && !memcmp(a->slot_start, b->slot_start, sizeof(uint32_t) * (a->slot_count + 1))
+        && !memcmp(a->items, b->items, sizeof(uint32_t) * a->count)
+        && !memcmp(a->item_bounds, b->item_bounds, sizeof(Aabb) * a->count);
+}
+
+static size_t neighbours(const SpatialGrid* grid, const Swarm* w, uint32_t* out, size_t max_out)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < w->bounds.size(); i += NEIGHBOUR_STRIDE)
+    {
+        const Aabb* b = &w->bounds[i];
+        const vec3 c = { 0.5f * (b->min[0] + b->max[0]), 0.5f * (b->min[1] + b->max[1]),
+            0.5f * (b->min[2] + b->max[2]) };
+        found += spatial_grid_query_sphere(grid, c, NEIGHBOUR_RADIUS, out, max_out);
+    }
+    return found;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t count = argc > 1 && atol(argv[1]) > 0 ? (uint32_t)atol(argv[1]) : 200000;
+    const int frames = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 60;
+    const float cell = argc > 3 && atof(argv[3]) > 0.0 ? (float)atof(argv[3]) : 4.f;  // the neighbour queries' span
+
+    Swarm swarm;
+    swarm.bounds.resize(count);
+    swarm.vx.resize(count);
+    swarm.vy.resize(count);
+    swarm.vz.resize(count);
+    unsigned int state = 1u;
+    swarm_place(&swarm, &state);
+
+    mat4x4 projection, view, view_projection;
+    mat4x4_perspective(projection, 0.8f, 16.f / 9.f, 0.1f, 150.f);
+    vec3 eye = { 0.f, 0.f, 0.f }, center = { 1.f, 0.2f, -1.f }, up = { 0.f, 1.f, 0.f };
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(view_projection, projection, view);
+    Frustum frustum;
+    frustum_from_matrix(&frustum, view_projection);
+
+    JobSystem jobs;
+    SpatialGrid serial, parallel;
+    Bvh bvh;
+    if (!job_system_init(&jobs, 0) || !spatial_grid_init(&serial, count) || !spatial_grid_init(&parallel, count)
+        || !bvh_init(&bvh, count))
+        return EXIT_FAILURE;
+    printf("%u boxes in a %.0f-unit cube, all moving; %d job threads\n", count, 2 * SPREAD, jobs.thread_count);
+    spatial_grid_build(&serial, NULL, swarm.bounds.data(), count, cell);
+    spatial_grid_build(&parallel, &jobs, swarm.bounds.data(), count, cell);
+    bool ok = check(&serial, &swarm, &frustum);
+    ok = report("a parallel build equals a serial one", same_grid(&serial, &parallel)) && ok;
+    bvh_build(&bvh, swarm.bounds.data(), count);
+
+    // Per frame: move, update the index, cull, neighbour queries
+    std::vector<uint32_t> visible(count);
+    const size_t max_out = 4096;
+    std::vector<uint32_t> near(max_out);
+    double grid_serial = 0.0, grid_parallel = 0.0, refit = 0.0, rebuild = 0.0;
+    double grid_cull = 0.0, refit_cull = 0.0, rebuild_cull = 0.0, grid_near = 0.0;
+    size_t visible_count = 0, near_count = 0;
+    Bvh fresh;
+    if (!bvh_init(&fresh, count))
+        return EXIT_FAILURE;
+    for (int f = 0; f < frames; ++f)
+    {
+        swarm_move(&swarm);
+        double t0 = now_ms();
+        spatial_grid_build(&serial, NULL, swarm.bounds.data(), count, cell);
+        double t1 = now_ms();
+        spatial_grid_build(&parallel, &jobs, swarm.bounds.data(), count, cell);
+        double t2 = now_ms();
+        grid_serial += t1 - t0;
+        grid_parallel += t2 - t1;
+        visible_count = spatial_grid_cull(&parallel, &frustum, visible.data());
+        double t3 = now_ms();
+        near_count = neighbours(&parallel, &swarm, near.data(), max_out);
+        double t4 = now_ms();
+        grid_cull += t3 - t2;
+        grid_near += t4 - t3;
+
+        t0 = now_ms();
+        bvh_refit(&bvh, swarm.bounds.data());
+        t1 = now_ms();
+        bvh_cull(&bvh, &frustum, visible.data());
+        t2 = now_ms();
+        bvh_build(&fresh, swarm.bounds.data(), count);
+        t3 = now_ms();
+        bvh_cull(&fresh, &frustum, visible.data());
+        t4 = now_ms();
+        refit += t1 - t0;
+        refit_cull += t2 - t1;
+        rebuild += t3 - t2;
+        rebuild_cull += t4 - t3;
+    }
+    ok = report("the grid still equals brute force after flying", check(&parallel, &swarm, &frustum)) && ok;
+    printf("per frame over %d frames (%zu visible, %zu neighbours of every %dth):\n", frames, visible_count, near_count,
+        NEIGHBOUR_STRIDE);
+    printf("  %-22s %8.3f ms update %8.3f ms cull %8.3f ms neighbours\n", "grid, serial build", grid_serial / frames,
+        grid_cull / frames, grid_near / frames);
+    printf("  %-22s %8.3f ms update\n", "grid, parallel build", grid_parallel / frames);
+    printf("  %-22s %8.3f ms update %8.3f ms cull\n", "bvh refit", refit / frames, refit_cull / frames);
+    printf("  %-22s %8.3f ms update %8.3f ms cull\n", "bvh rebuild", rebuild / frames, rebuild_cull / frames);
+
+    bvh_destroy(&fresh);
+    bvh_destroy(&bvh);
+    spatial_grid_destroy(&parallel);
+    spatial_grid_destroy(&serial);
+    job_system_destroy(&jobs);
+    printf("%s\n", ok ? "spatial_grid_bench: ok" : "spatial_grid_bench: FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
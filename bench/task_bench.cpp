@@ -0,0 +1,218 @@
+// Coroutine tasks (src/core/task.h): LZ4-compressed assets loaded the way the app's streamer would, each as one task
+// written top to bottom - read the file (async I/O), decompress it on a job, wait for the next frame, take one of the
+// frame's upload slots, then a child task checksums it on another job - against loading them one at a time with
+// fread and decompressing on the calling thread. Every asset must come back byte for byte; the task row also says
+// how many frames it took and the longest a frame spent pumping the scheduler, which is what the frame pays (jobs
+// run inside the pump when the machine has one hardware thread and the job system no workers).
+//
+// Usage: task_bench [assets] [KB each]
+
+#include "asset/lz4.h"
+#include "core/async_io.h"
+#include "core/job_system.h"
+#include "core/task.h"
+
+#include <chrono>
+#include <filesystem>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#define UPLOADS_PER_FRAME 4
+#define LOADS_IN_FLIGHT 32      // well under async_io's open files
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static uint64_t checksum(const unsigned char* data, size_t size)
+{
+    uint64_t h = 1469598103934665603ull;       // FNV-1a
+    for (size_t i = 0; i < size; ++i)
+        h = (h ^ data[i]) * 1099511628211ull;
+    return h;
+}
+
+// Compressible but not trivially: runs of a few bytes with noise between them, like vertex data
+static std::vector<unsigned char> asset_bytes(size_t size, unsigned int seed)
+{
+    std::vector<unsigned char> data(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        data[i] = (seed >> 28) ? (unsigned char)(i / 16) : (unsigned char)(seed >> 20);
+    }
+    return data;
+}
+
+typedef struct Asset
+{
+    std::string path;
+    uint32_t packed_size;
+    uint32_t size;
+    uint64_t expected;
+    std::vector<unsigned char> packed;
+    std::vector<unsigned char> data;
+    bool unpacked;
+    uint64_t sum;
+} Asset;
+
+typedef struct UploadSlots
+{
+    int used;                   // this frame's
+} UploadSlots;
+
+static void decompress_job(Job* job, const void* data)
+{
+    (void)job;
+    Asset* asset = *(Asset* const*)data;
+    asset->unpacked = lz4_decompress(asset->packed.data(), asset->packed_size, asset->data.data(), asset->size);
+}
+
+static void checksum_job(Job* job, const void* data)
+{
+    (void)job;
+    Asset* asset = *(Asset* const*)data;
+    asset->sum = checksum(asset->data.data(), asset->size);
+}
+
+static bool upload_slot_free(void* data)
+{
+    UploadSlots* slots = (UploadSlots*)data;
+    if (slots->used == UPLOADS_PER_FRAME)
+        return false;
+    ++slots->used;
+    return true;
+}
+
+static Task verify(TaskScheduler* s, Asset* asset)
+{
+    co_await task_run(s, checksum_job, &asset, sizeof(asset));
+    co_return asset->sum == asset->expected;
+}
+
+static Task load(TaskScheduler* s, Asset* asset, UploadSlots* slots, int* loaded)
+{
+    uint64_t file_size = 0;
+    const int file = async_io_open(s->io, asset->path.c_str(), false, &file_size);
+    if (file < 0)
+        co_return false;
+    asset->packed.resize(asset->packed_size);
+    asset->data.resize(asset->size);
+    const AsyncIoRead read = { file, asset->packed_size, 0, asset->packed.data(), 0, ASYNC_IO_NOW, 0 };
+    const int64_t n = co_await task_read(s, read);
+    async_io_close(s->io, file);
+    if (n != (int64_t)asset->packed_size)
+        co_return false;
+    co_await task_run(s, decompress_job, &asset, sizeof(asset));
+    if (!asset->unpacked)
+        co_return false;
+    co_await task_next_frame(s);                        // where the app would upload, at a frame's start
+    co_await task_until(s, upload_slot_free, slots);
+    const bool ok = co_await verify(s, asset);
+    *loaded += ok;
+    co_return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 64;
+    const size_t size = (argc > 2 && atoi(argv[2]) > 0 ? (size_t)atoi(argv[2]) : 1024) * 1024;
+    const fs::path root = fs::temp_directory_path() / "task_bench";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root, ec);
+
+    bool ok = true;
+    size_t packed_total = 0;
+    std::vector<Asset> assets(count);
+    for (int i = 0; i < count; ++i)
+    {
+        Asset& asset = assets[i];
+        const std::vector<unsigned char> data = asset_bytes(size, (unsigned int)i + 1);
+        std::vector<unsigned char> packed(lz4_compress_bound(size));
+        asset.path = (root / ("asset" + std::to_string(i) + ".lz4")).string();
+        asset.packed_size = (uint32_t)lz4_compress(data.data(), size, packed.data(), packed.size());
+        asset.size = (uint32_t)size;
+        asset.expected = checksum(data.data(), size);
+        packed_total += asset.packed_size;
+        FILE* f = fopen(asset.path.c_str(), "wb");
+        ok = f && asset.packed_size && fwrite(packed.data(), 1, asset.packed_size, f) == asset.packed_size && ok;
+        if (f)
+            fclose(f);
+    }
+    printf("%d assets of %zu KB, %.1f MB compressed\n", count, size / 1024, packed_total / 1e6);
+
+    // One at a time on this thread
+    const double t0 = now_ms();
+    int loaded = 0;
+    for (Asset& asset : assets)
+    {
+        std::vector<unsigned char> packed(asset.packed_size);
+        std::vector<unsigned char> data(asset.size);
+        FILE* f = fopen(asset.path.c_str(), "rb");
+        const bool read = f && fread(packed.data(), 1, packed.size(), f) == packed.size();
+        if (f)
+            fclose(f);
+        loaded += read && lz4_decompress(packed.data(), packed.size(), data.data(), data.size())
+            && checksum(data.data(), data.size()) == asset.expected;
+    }
+    const double t1 = now_ms();
+    ok = report("blocking loads check out", loaded == count) && ok;
+
+    // Every load a task; the frame loop pumps the scheduler and counts what it costs
+    JobSystem jobs;
+    AsyncIo* io = new AsyncIo;
+    if (!job_system_init(&jobs, 0) || !async_io_init(io, ASYNC_IO_AUTO, 16, 2))
+    {
+        fprintf(stderr, "task_bench: no job system or async I/O\n");
+        return 1;
+    }
+    TaskScheduler* s = new TaskScheduler;
+    task_scheduler_init(s, &jobs, io);
+    UploadSlots slots = { 0 };
+    int task_loaded = 0;
+    uint64_t frames = 0;
+    double worst_pump = 0.0;
+    int started = 0;
+    const double t2 = now_ms();
+    while (started < count || s->running)
+    {
+        const double p0 = now_ms();
+        slots.used = 0;
+        while (started < count && s->running < LOADS_IN_FLIGHT)
+            task_start(s, load(s, &assets[started++], &slots, &task_loaded));
+        task_scheduler_frame(s);
+        const double pump = now_ms() - p0;
+        worst_pump = pump > worst_pump ? pump : worst_pump;
+        ++frames;
+        std::this_thread::sleep_for(std::chrono::microseconds(500));     // the rest of the frame
+    }
+    const double t3 = now_ms();
+    ok = report("task loads check out", task_loaded == count) && ok;
+    ok = report("upload slots held each frame to the limit", frames >= (uint64_t)(count / UPLOADS_PER_FRAME)) && ok;
+    printf("  %-10s %8.1f ms\n", "blocking", t1 - t0);
+    printf("  %-10s %8.1f ms, %llu frames, %llu resumptions, %.3f ms worst pump (%s I/O)\n", "tasks", t3 - t2,
+        (unsigned long long)frames, (unsigned long long)s->resumed, worst_pump, async_io_backend_name(io->backend));
+
+    task_scheduler_destroy(s);
+    delete s;
+    async_io_destroy(io);
+    delete io;
+    job_system_destroy(&jobs);
+    fs::remove_all(root, ec);
+    printf("%s\n", ok ? "task_bench: ok" : "task_bench: FAIL");
+    return ok ? 0 : 1;
+}
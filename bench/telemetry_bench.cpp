@@ -0,0 +1,134 @@
+// Telemetry ring check (src/core/telemetry.h): what a record costs on one thread and on several at once; a flush
+// while those threads record keeps only whole records, in order, and the newest of them; and, where there's fork,
+// a child that crashes leaves its last records behind with the signal that killed it. Writes telemetry_bench.tlm.
+//
+// Usage: telemetry_bench [records a thread] [threads]
+
+#include "core/telemetry.h"
+
+#include <atomic>
+#include <chrono>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define PATH "telemetry_bench.tlm"
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-46s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Record "i" of thread "t": a pass whose label and values say which, so a torn one shows
+static void record(int t, int i)
+{
+    char label[TELEMETRY_LABEL_SIZE];
+    snprintf(label, sizeof(label), "t%d-%d", t, i);
+    const float values[4] = { (float)t, (float)i, (float)(t + i), 0.f };
+    telemetry_record(TELEMETRY_PASS, (uint32_t)i, values, label);
+}
+
+static bool whole(const TelemetryRecord* r)
+{
+    char label[TELEMETRY_LABEL_SIZE];
+    snprintf(label, sizeof(label), "t%d-%d", (int)r->values[0], (int)r->values[1]);
+    return r->type == TELEMETRY_PASS && r->values[2] == r->values[0] + r->values[1] && r->frame == (uint32_t)r->values[1]
+        && !strcmp(label, r->label);
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 1000000;
+    const int threads = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 4;
+    bool ok = true;
+
+    ok = report("nothing to flush before init", !telemetry_flush("early")) && ok;
+    if (!telemetry_init(PATH))
+        return EXIT_FAILURE;
+
+    // One thread
+    double start = now_ms();
+    for (int i = 0; i < count; ++i)
+        record(0, i);
+    const double one_ns = (now_ms() - start) * 1e6 / count;
+
+    // Several at once, flushed twice while they run
+    std::atomic<int> running(threads);
+    std::vector<std::thread> writers;
+    start = now_ms();
+    for (int t = 1; t <= threads; ++t)
+        writers.emplace_back([t, count, &running] {
+            for (int i = 0; i < count; ++i)
+                record(t, i);
+            --running;
+        });
+    bool flushed = true;
+    for (int k = 0; k < 2 && running.load() > 0; ++k)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        flushed = telemetry_flush("bench") && flushed;
+    }
+    for (std::thread& w : writers)
+        w.join();
+    const double many_ns = (now_ms() - start) * 1e6 / ((double)count * threads);
+    printf("  %.1f ns a record on one thread, %.1f ns each with %d recording at once\n", one_ns, many_ns, threads);
+
+    TelemetryFileHeader header;
+    TelemetryRecord* records = (TelemetryRecord*)malloc(sizeof(TelemetryRecord) * TELEMETRY_RECORDS);
+    int kept = telemetry_read(PATH, &header, records);
+    bool all_whole = kept > 0, in_order = true;
+    for (int i = 0; i < kept; ++i)
+    {
+        all_whole = all_whole && whole(&records[i]);
+        in_order = in_order && (i == 0 || records[i].time >= records[i - 1].time);
+    }
+    printf("  a flush while recording kept %d of the last %d records\n", kept, TELEMETRY_RECORDS);
+    ok = report("a flush while recording keeps whole records", flushed && all_whole) && ok;
+    ok = report("oldest first", in_order) && ok;
+    ok = report("and nearly all of them", kept > TELEMETRY_RECORDS - 64 * threads) && ok;
+
+    // Quiet: the ring ends with the newest record
+    for (int i = 0; i < 100; ++i)
+        record(0, i);
+    kept = telemetry_flush("quiet") ? telemetry_read(PATH, &header, records) : -1;
+    ok = report("a quiet flush keeps every slot, newest last", kept == TELEMETRY_RECORDS
+        && records[kept - 1].values[1] == 99.f && !strcmp(header.reason, "quiet")) && ok;
+    FILE* sink = tmpfile();
+    ok = report("the file prints", sink && telemetry_print(PATH, sink)) && ok;
+    if (sink)
+        fclose(sink);
+
+#ifndef _WIN32
+    // A crash: the child's handler writes the ring as it was, then it dies of the signal all the same
+    const pid_t child = fork();
+    if (child == 0)
+    {
+        record(7, 7);
+        telemetry_record(TELEMETRY_ERROR, 0, NULL, "last words");
+        raise(SIGSEGV);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    kept = telemetry_read(PATH, &header, records);
+    ok = report("a crashed process still dies of its signal", WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV) && ok;
+    ok = report("and leaves its last records and the signal", kept > 1 && !strcmp(header.reason, "signal 11")
+        && !strcmp(records[kept - 1].label, "last words") && whole(&records[kept - 2])) && ok;
+#endif
+    free(records);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,145 @@
+// Temporal check (src/scene/temporal.h): a cycle of jitter stays inside the pixel, every phase a different point,
+// centred on it; the jitter matrix moves a projected point by exactly the jitter in pixels, orthographic and
+// perspective; the reprojection takes a point's clip position this frame to where it was drawn last frame as the
+// camera moves, and is the identity for a still one; and a resize or a reset drops the history. Then times a frame.
+//
+// Usage: temporal_bench [frames]
+
+#include "scene/temporal.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WIDTH 1280
+#define HEIGHT 720
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-46s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// A point through a matrix to pixels (x and y) and NDC depth (z)
+static void project(vec3 out, mat4x4 const m, vec3 const p)
+{
+    const vec4 world = { p[0], p[1], p[2], 1.f };
+    vec4 clip;
+    mat4x4_mul_vec4(clip, m, world);
+    out[0] = (clip[0] / clip[3] * 0.5f + 0.5f) * WIDTH;
+    out[1] = (clip[1] / clip[3] * 0.5f + 0.5f) * HEIGHT;
+    out[2] = clip[2] / clip[3];
+}
+
+static void view_projection_at(mat4x4 out, mat4x4 const projection, float x, float y, float z, float yaw)
+{
+    mat4x4 view;
+    const vec3 eye = { x, y, z }, center = { x + sinf(yaw), y, z - cosf(yaw) }, up = { 0.f, 1.f, 0.f };
+    mat4x4_look_at(view, eye, center, up);
+    mat4x4_mul(out, projection, view);
+}
+
+// How far the jitter matrix moves "p" from where "projection" alone puts it, against the jitter, in pixels
+static float jitter_error(const Temporal* t, mat4x4 const projection, vec3 const p)
+{
+    mat4x4 jitter, jittered;
+    temporal_jitter_matrix(t, jitter);
+    mat4x4_mul(jittered, jitter, projection);
+    vec3 a, b;
+    project(a, projection, p);
+    project(b, jittered, p);
+    return fabsf(b[0] - a[0] - t->jitter[0]) + fabsf(b[1] - a[1] - t->jitter[1]) + fabsf(b[2] - a[2]);
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    bool ok = true;
+
+    mat4x4 perspective, orthographic;
+    mat4x4_perspective(perspective, 1.f, (float)WIDTH / HEIGHT, 0.1f, 100.f);
+    mat4x4_ortho(orthographic, -8.f, 8.f, -4.5f, 4.5f, -10.f, 10.f);
+
+    // A cycle of jitter: inside the pixel, no phase repeated, centred
+    Temporal t;
+    temporal_init(&t);
+    vec2 seen[TEMPORAL_JITTER_PHASES];
+    float mean[2] = { 0.f, 0.f };
+    bool inside = true, distinct = true;
+    float worst_jitter = 0.f;
+    for (int f = 0; f < TEMPORAL_JITTER_PHASES; ++f)
+    {
+        temporal_begin_frame(&t, perspective, WIDTH, HEIGHT);
+        for (int a = 0; a < 2; ++a)
+        {
+            inside = inside && t.jitter[a] > -0.5f && t.jitter[a] < 0.5f;
+            mean[a] += t.jitter[a] / TEMPORAL_JITTER_PHASES;
+            seen[f][a] = t.jitter[a];
+        }
+        for (int g = 0; g < f; ++g)
+            distinct = distinct && (seen[g][0] != seen[f][0] || seen[g][1] != seen[f][1]);
+
+        const vec3 near_point = { 0.3f, -0.2f, -2.f }, far_point = { -7.f, 4.f, -60.f };
+        const float e = fmaxf(jitter_error(&t, perspective, near_point), jitter_error(&t, perspective, far_point));
+        const vec3 box_point = { 5.f, -3.f, 1.f };
+        worst_jitter = fmaxf(worst_jitter, fmaxf(e, jitter_error(&t, orthographic, box_point)));
+    }
+    printf("  %d phases, mean offset (%.3f, %.3f) px\n", TEMPORAL_JITTER_PHASES, mean[0], mean[1]);
+    ok = report("jitter inside the pixel, every phase new", inside && distinct) && ok;
+    ok = report("jitter centred on the pixel", fabsf(mean[0]) < 1.f / 16.f && fabsf(mean[1]) < 1.f / 16.f) && ok;
+    printf("  jitter matrix off by %.1e px at most\n", worst_jitter);
+    ok = report("the matrix shifts by the jitter exactly", worst_jitter < 1e-3f) && ok;
+
+    // A still camera: the history lines up pixel for pixel
+    mat4x4 a, b;
+    view_projection_at(a, perspective, 0.f, 1.f, 5.f, 0.f);
+    temporal_begin_frame(&t, a, WIDTH, HEIGHT);
+    temporal_begin_frame(&t, a, WIDTH, HEIGHT);
+    float off_identity = 0.f;
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            off_identity = fmaxf(off_identity, fabsf(t.reprojection[c][r] - (c == r ? 1.f : 0.f)));
+    ok = report("a still camera reprojects onto itself", t.history_valid && off_identity < 1e-4f) && ok;
+
+    // A moving, turning camera: each point's pixel and depth this frame, through the reprojection, is where it was
+    view_projection_at(b, perspective, 0.3f, 1.1f, 4.6f, 0.05f);
+    temporal_begin_frame(&t, b, WIDTH, HEIGHT);
+    float worst_reprojection = 0.f;
+    for (int k = 0; k < 64; ++k)
+    {
+        const vec3 p = { (float)(k % 8) - 3.5f, (float)(k / 8) * 0.5f - 1.f, -2.f - (float)k };
+        vec3 before, now;
+        project(before, a, p);
+        project(now, b, p);
+        const vec4 ndc = { now[0] / WIDTH * 2.f - 1.f, now[1] / HEIGHT * 2.f - 1.f, now[2], 1.f };
+        vec4 back;
+        mat4x4_mul_vec4(back, t.reprojection, ndc);
+        const float x = (back[0] / back[3] * 0.5f + 0.5f) * WIDTH, y = (back[1] / back[3] * 0.5f + 0.5f) * HEIGHT;
+        worst_reprojection = fmaxf(worst_reprojection, fabsf(x - before[0]) + fabsf(y - before[1]));
+    }
+    printf("  camera step: reprojection off by %.1e px at most\n", worst_reprojection);
+    ok = report("points reproject to last frame's pixels", worst_reprojection < 0.05f) && ok;
+
+    // A resize or a reset: one frame without history, then it's back
+    temporal_begin_frame(&t, b, WIDTH / 2, HEIGHT / 2);
+    const bool resized = !t.history_valid;
+    temporal_begin_frame(&t, b, WIDTH / 2, HEIGHT / 2);
+    const bool back = t.history_valid;
+    temporal_reset(&t);
+    temporal_begin_frame(&t, b, WIDTH / 2, HEIGHT / 2);
+    const bool cut = !t.history_valid;
+    temporal_begin_frame(&t, b, WIDTH / 2, HEIGHT / 2);
+    ok = report("a resize or a reset drops one frame's history", resized && back && cut && t.history_valid) && ok;
+
+    const double start = now_ms();
+    for (int f = 0; f < frames; ++f)
+        temporal_begin_frame(&t, (f & 1) ? a : b, WIDTH, HEIGHT);
+    printf("  begin_frame: %.1f ns\n", (now_ms() - start) * 1e6 / frames);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
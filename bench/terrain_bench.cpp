@@ -0,0 +1,242 @@
+// Terrain (scene/terrain.h): the CDLOD quadtree over made-up heights. The node bounds must hold every bilinear
+// sample under them. From eyes low in a valley, high over a ridge and off the edge, the selection must cover the
+// terrain exactly once, neighbours may differ by one level at most, and with every vertex morphed as the vertex
+// shader does it, each vertex on a patch's edge must be one of its neighbour's too: no T-junctions, so no cracks.
+// Then a perspective camera's frustum culls the selection, timed per frame.
+//
+// Usage: terrain_bench [height texels] [side]
+
+#include "scene/frustum.h"
+#include "scene/terrain.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unordered_map>
+#include <vector>
+
+#define GRID 32
+#define DETAIL 4.f
+#define RELIEF 0.08f        // of the side, the highest peak
+#define CAPACITY 8192
+#define SAMPLES 100000
+#define FRAMES 1000
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+// The height at (x, y) as the vertex shader samples it: bilinear between texel centres, clamped at the edges
+static float height_at(const Terrain* t, const uint16_t* heights, int width, float x, float y)
+{
+    const float u = (x - t->origin[0]) / t->size * width - 0.5f, v = (y - t->origin[1]) / t->size * width - 0.5f;
+    const float fu = floorf(u), fv = floorf(v);
+    float h[4];
+    for (int k = 0; k < 4; ++k)
+    {
+        int i = (int)fu + (k & 1), j = (int)fv + (k >> 1);
+        i = i < 0 ? 0 : i >= width ? width - 1 : i;
+        j = j < 0 ? 0 : j >= width ? width - 1 : j;
+        h[k] = heights[(size_t)j * width + i] / 65535.f;
+    }
+    const float a = u - fu, b = v - fv;
+    const float n = (h[0] * (1.f - a) + h[1] * a) * (1.f - b) + (h[2] * (1.f - a) + h[3] * a) * b;
+    return t->height_min + (t->height_max - t->height_min) * n;
+}
+
+// A patch's vertex (gx, gy), in cells of its level, after the morph
+static void morphed(const Terrain* t, const uint16_t* heights, int width, const TerrainPatch* p, const vec3 eye,
+    int gx, int gy, float out[2])
+{
+    const float x = p->x + gx * p->cell, y = p->y + gy * p->cell;
+    const float dz = height_at(t, heights, width, x, y) - eye[2];
+    const float d = sqrtf((x - eye[0]) * (x - eye[0]) + (y - eye[1]) * (y - eye[1]) + dz * dz);
+    const float m = fminf(1.f, fmaxf(0.f, (d - p->morph[0]) / (p->morph[1] - p->morph[0])));
+    out[0] = p->x + (gx - (float)(gx & 1) * m) * p->cell;
+    out[1] = p->y + (gy - (float)(gy & 1) * m) * p->cell;
+}
+
+static bool check_eye(const char* name, const Terrain* t, const uint16_t* heights, int width, const vec3 eye,
+    TerrainSelection* s)
+{
+    terrain_select(t, NULL, eye, s);
+    const uint32_t count = s->whole_count + s->quarter_count;
+    std::vector<const TerrainPatch*> patches;
+    for (uint32_t i = 0; i < s->whole_count; ++i)
+        patches.push_back(&s->whole[i]);
+    for (uint32_t i = 0; i < s->quarter_count; ++i)
+        patches.push_back(&s->quarters[i]);
+
+    // Coverage and levels on a grid of leaves: each covered once, the cell size of neighbours at most 2x apart
+    const int side = 1 << (t->levels - 1);
+    const float leaf = terrain_node_size(t, 0);
+    std::vector<int> covered((size_t)side * side, 0);
+    std::vector<float> cell((size_t)side * side, 0.f);
+    for (const TerrainPatch* p : patches)
+    {
+        const int x0 = (int)lroundf((p->x - t->origin[0]) / leaf), y0 = (int)lroundf((p->y - t->origin[1]) / leaf);
+        const int n = (int)lroundf(p->size / leaf);
+        for (int y = y0; y < y0 + n; ++y)
+        {
+            for (int x = x0; x < x0 + n; ++x)
+            {
+                ++covered[(size_t)y * side + x];
+                cell[(size_t)y * side + x] = p->cell;
+            }
+        }
+    }
+    bool once = s->dropped == 0, adjacent = true;
+    for (int y = 0; y < side; ++y)
+    {
+        for (int x = 0; x < side; ++x)
+        {
+            once = once && covered[(size_t)y * side + x] == 1;
+            const float c = cell[(size_t)y * side + x];
+            const float right = x + 1 < side ? cell[(size_t)y * side + x + 1] : c;
+            const float above = y + 1 < side ? cell[(size_t)(y + 1) * side + x] : c;
+            adjacent = adjacent && fmaxf(c, right) <= 2.f * fminf(c, right) && fmaxf(c, above) <= 2.f * fminf(c, above);
+        }
+    }
+
+    // Every patch's morphed edge vertices, keyed to a fine lattice; a vertex inside the terrain must be some other
+    // patch's as well
+    const float q = terrain_cell_size(t, 0) / 64.f;
+    std::unordered_map<uint64_t, int> shared;
+    std::vector<std::vector<uint64_t>> edges(patches.size());
+    for (size_t i = 0; i < patches.size(); ++i)
+    {
+        const TerrainPatch* p = patches[i];
+        const int n = (int)lroundf(p->size / p->cell);
+        for (int k = 0; k < 4 * n; ++k)
+        {
+            const int e = k / n, j = k % n;     // around the edge, a corner each
+            const int gx = e == 0 ? j : e == 1 ? n : e == 2 ? n - j : 0;
+            const int gy = e == 0 ? 0 : e == 1 ? j : e == 2 ? n : n - j;
+            float v[2];
+            morphed(t, heights, width, p, eye, gx, gy, v);
+            const uint64_t key = (uint64_t)(uint32_t)lroundf((v[0] - t->origin[0]) / q) << 32
+                | (uint32_t)lroundf((v[1] - t->origin[1]) / q);
+            bool seen = false;
+            for (uint64_t other : edges[i])
+                seen = seen || other == key;
+            if (!seen)
+            {
+                edges[i].push_back(key);
+                ++shared[key];
+            }
+        }
+    }
+    const uint32_t border = (uint32_t)lroundf(t->size / q);
+    size_t cracks = 0;
+    for (size_t i = 0; i < patches.size(); ++i)
+    {
+        for (uint64_t key : edges[i])
+        {
+            const uint32_t kx = (uint32_t)(key >> 32), ky = (uint32_t)key;
+            if (kx != 0 && ky != 0 && kx != border && ky != border && shared[key] < 2)
+                ++cracks;
+        }
+    }
+    uint32_t triangles = 2 * GRID * GRID * s->whole_count + GRID * GRID / 2 * s->quarter_count;
+    printf("  %s: %u patches (%u whole, %u quarters), %u triangles, finest level %d\n", name, count, s->whole_count,
+        s->quarter_count, triangles, s->finest);
+    char what[96];
+    snprintf(what, sizeof(what), "%s: every leaf covered once", name);
+    bool ok = report(what, once);
+    snprintf(what, sizeof(what), "%s: neighbours a level apart at most", name);
+    ok = report(what, adjacent) && ok;
+    snprintf(what, sizeof(what), "%s: no T-junctions after the morph (%zu)", name, cracks);
+    return report(what, cracks == 0) && ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int width = argc > 1 && atoi(argv[1]) >= GRID ? atoi(argv[1]) : 2048;
+    const float size = argc > 2 && atof(argv[2]) > 0.0 ? (float)atof(argv[2]) : 4096.f;
+    bool ok = true;
+
+    // A leaf cell to a texel: as many levels as take the grid down to the heights' resolution
+    int levels = 1;
+    while ((GRID << (levels - 1)) < width && levels < TERRAIN_MAX_LEVELS)
+        ++levels;
+    std::vector<uint16_t> heights((size_t)width * width);
+    double t0 = now_ms();
+    terrain_generate_heights(heights.data(), width, 1u, 1.f / 512.f);
+    const double generated = now_ms() - t0;
+    Terrain terrain;
+    const float origin[2] = { -0.5f * size, -0.5f * size };
+    if (!terrain_init(&terrain, origin, size, 0.f, RELIEF * size, levels, GRID, DETAIL))
+    {
+        fprintf(stderr, "terrain_bench: can't set up %d levels of %d cells\n", levels, GRID);
+        return 1;
+    }
+    t0 = now_ms();
+    terrain_set_heights(&terrain, heights.data(), width);
+    const double bounded = now_ms() - t0;
+    printf("terrain: %.0f units a side, %d x %d heights (%.1f ms), %d levels of %d x %d cells, bounds %.2f ms\n",
+        (double)size, width, width, generated, levels, GRID, GRID, bounded);
+
+    // Bounds: random samples against their leaf's and the root's
+    unsigned int state = 7u;
+    bool bounds = true;
+    const int side = 1 << (levels - 1);
+    const float leaf_size = terrain_node_size(&terrain, 0);
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        const float x = random_float(&state, origin[0], origin[0] + size);
+        const float y = random_float(&state, origin[1], origin[1] + size);
+        const float h = height_at(&terrain, heights.data(), width, x, y);
+        int nx = (int)((x - origin[0]) / leaf_size), ny = (int)((y - origin[1]) / leaf_size);
+        nx = nx < side ? nx : side - 1;
+        ny = ny < side ? ny : side - 1;
+        const float* leaf = &terrain.bounds[2 * ((size_t)ny * side + nx)];
+        const float* root = &terrain.bounds[2 * terrain.level_offset[levels - 1]];
+        const float slack = 1e-4f * terrain.height_max;
+        bounds = bounds && h >= leaf[0] - slack && h <= leaf[1] + slack && h >= root[0] - slack && h <= root[1] + slack;
+    }
+    ok = report("node bounds hold the heights under them", bounds) && ok;
+
+    std::vector<TerrainPatch> whole(CAPACITY), quarters(CAPACITY);
+    TerrainSelection selection = { whole.data(), quarters.data(), CAPACITY, 0, 0, 0, 0 };
+    const vec3 valley = { 0.f, 0.f, height_at(&terrain, heights.data(), width, 0.f, 0.f) + 2.f };
+    const vec3 ridge = { 0.3f * size, -0.2f * size, terrain.height_max + 0.02f * size };
+    const vec3 outside = { -0.7f * size, 0.1f * size, 0.05f * size };
+    ok = check_eye("valley", &terrain, heights.data(), width, valley, &selection) && ok;
+    ok = check_eye("ridge", &terrain, heights.data(), width, ridge, &selection) && ok;
+    ok = check_eye("outside", &terrain, heights.data(), width, outside, &selection) && ok;
+
+    // A walker's view over the valley, out to the terrain's far side
+    mat4x4 projection, view, vp;
+    mat4x4_perspective(projection, 1.f, 16.f / 9.f, 0.1f, 2.f * size);
+    const vec3 center = { valley[0] + 1.f, valley[1] + 1.f, valley[2] - 0.1f }, up = { 0.f, 0.f, 1.f };
+    mat4x4_look_at(view, valley, center, up);
+    mat4x4_mul(vp, projection, view);
+    Frustum frustum;
+    frustum_from_matrix(&frustum, vp);
+    const uint32_t all = terrain_select(&terrain, NULL, valley, &selection);
+    t0 = now_ms();
+    uint32_t culled = 0;
+    for (int f = 0; f < FRAMES; ++f)
+        culled = terrain_select(&terrain, &frustum, valley, &selection);
+    const double per_frame = (now_ms() - t0) / FRAMES;
+    printf("  frustum keeps %u of %u patches; selection %.4f ms a frame\n", culled, all, per_frame);
+    ok = report("the frustum culls patches behind the eye", culled > 0 && culled < all) && ok;
+
+    terrain_destroy(&terrain);
+    printf("%s\n", ok ? "terrain_bench: ok" : "terrain_bench: FAIL");
+    return ok ? 0 : 1;
+}
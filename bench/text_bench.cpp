@@ -0,0 +1,185 @@
+// Text check (core/glyph_atlas.h, core/text_cache.h): the distance field is above its outline value inside every
+// glyph pixel and below it outside, the padding stays outside, the disk cache round-trips and refuses a stale
+// file, and the text cache only lays out strings that changed. Then times building the atlas against loading it,
+// and a frame of unchanged labels against laying them all out.
+//
+// Usage: text_bench [dir] [iterations]
+
+#include "core/glyph_atlas.h"
+#include "core/text_cache.h"
+
+#include <chrono>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static unsigned char texel(const GlyphAtlas* atlas, int glyph, int x, int y)
+{
+    const int x0 = glyph % GLYPH_ATLAS_COLUMNS * GLYPH_ATLAS_CELL_WIDTH, y0 = glyph / GLYPH_ATLAS_COLUMNS * GLYPH_ATLAS_CELL_HEIGHT;
+    return atlas->pixels[(y0 + y) * GLYPH_ATLAS_WIDTH + x0 + x];
+}
+
+// Both texels either side of each font pixel's centre, against the bitmap; the cell's edge texels against nothing
+static bool check_field(const GlyphAtlas* atlas)
+{
+    bool ok = true;
+    for (int g = 0; g < GLYPH_ATLAS_GLYPHS; ++g)
+    {
+        const unsigned char* rows = glyph_font_rows(g);
+        for (int py = 0; py < GLYPH_FONT_HEIGHT; ++py)
+            for (int px = 0; px < GLYPH_FONT_WIDTH; ++px)
+            {
+                const bool set = rows[py] >> (7 - px) & 1;
+                for (int k = 0; k < GLYPH_ATLAS_SCALE * GLYPH_ATLAS_SCALE; ++k)
+                {
+                    const int tx = GLYPH_ATLAS_SPREAD + px * GLYPH_ATLAS_SCALE + k % GLYPH_ATLAS_SCALE;
+                    const int ty = GLYPH_ATLAS_SPREAD + py * GLYPH_ATLAS_SCALE + k / GLYPH_ATLAS_SCALE;
+                    ok = ok && (texel(atlas, g, tx, ty) > 128) == set;
+                }
+            }
+        for (int x = 0; x < GLYPH_ATLAS_CELL_WIDTH; ++x)
+            ok = ok && texel(atlas, g, x, 0) < 128 && texel(atlas, g, x, GLYPH_ATLAS_CELL_HEIGHT - 1) < 128;
+        for (int y = 0; y < GLYPH_ATLAS_CELL_HEIGHT; ++y)
+            ok = ok && texel(atlas, g, 0, y) < 128 && texel(atlas, g, GLYPH_ATLAS_CELL_WIDTH - 1, y) < 128;
+    }
+    return report("distance field against the bitmap", ok);
+}
+
+static bool check_cache(const GlyphAtlas* built, const char* dir)
+{
+    char path[320];
+    snprintf(path, sizeof(path), "%s/font_%016llx.sdf", dir, (unsigned long long)glyph_atlas_key());
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+
+    GlyphAtlas first, second;
+    const bool made = glyph_atlas_init(&first, dir) && !first.loaded;
+    const bool cached = glyph_atlas_init(&second, dir) && second.loaded
+        && !memcmp(second.pixels, built->pixels, GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_HEIGHT);
+    printf("  atlas %dx%d: built in %.2f ms, loaded in %.2f ms\n", GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT,
+        first.build_ms, second.build_ms);
+    glyph_atlas_destroy(&first);
+    glyph_atlas_destroy(&second);
+
+    // Another key in the header: stale, so it's refused and rebuilt
+    bool stale = false;
+    if (FILE* f = fopen(path, "r+b"))
+    {
+        GlyphAtlasHeader header;
+        if (fread(&header, sizeof(header), 1, f) == 1)
+        {
+            header.key ^= 1;
+            fseek(f, 0, SEEK_SET);
+            fwrite(&header, sizeof(header), 1, f);
+        }
+        fclose(f);
+        GlyphAtlas refused;
+        stale = !glyph_atlas_load(&refused, path) && glyph_atlas_init(&refused, dir) && !refused.loaded;
+        glyph_atlas_destroy(&refused);
+    }
+    std::filesystem::remove_all(dir, ec);
+    return report("disk cache", made && cached && stale);
+}
+
+static uint32_t glyphs_in(const char* text)
+{
+    uint32_t n = 0;
+    for (; *text; ++text)
+        n += *text > ' ' && *text < 127;
+    return n;
+}
+
+static bool check_text(TextCache* cache)
+{
+    text_cache_init(cache);
+    const int a = text_cache_add(cache), b = text_cache_add(cache), hidden = text_cache_add(cache);
+    text_cache_set(cache, a, 10.f, 20.f, 1.f, 0xFFFFFFFFu, "fps 60.0");
+    text_cache_set(cache, b, 10.f, 40.f, 2.f, 0xFF00FF00u, "two\nlines");
+    text_cache_set(cache, hidden, 0.f, 0.f, 1.f, 0xFFFFFFFFu, "hidden");
+    text_cache_show(cache, hidden, false);
+    const bool built = cache->built == 3;
+
+    // The same again: compares only. Then a move, and a new readout.
+    text_cache_set(cache, a, 10.f, 20.f, 1.f, 0xFFFFFFFFu, "fps 60.0");
+    text_cache_printf(cache, b, 10.f, 40.f, 2.f, 0xFF00FF00u, "%s\n%s", "two", "lines");
+    const bool reused = cache->reused == 2 && cache->built == 3;
+    text_cache_set(cache, a, 15.f, 25.f, 1.f, 0xFFFFFFFFu, "fps 60.0");
+    const TextQuad moved = cache->quads[a][0];
+    text_cache_set(cache, b, 10.f, 40.f, 2.f, 0xFF00FF00u, "two\nlines!");
+    const bool changed = cache->moved == 1 && cache->built == 4;
+
+    // The moved quads land where a fresh layout would put them
+    TextCache* fresh = (TextCache*)malloc(sizeof(TextCache));
+    text_cache_init(fresh);
+    text_cache_set(fresh, text_cache_add(fresh), 15.f, 25.f, 1.f, 0xFFFFFFFFu, "fps 60.0");
+    const bool same = !memcmp(&fresh->quads[0][0], &moved, sizeof(moved));
+    free(fresh);
+
+    // Hidden strings aren't gathered; the second line of b starts back at its x
+    TextQuad quads[64];
+    const uint32_t count = text_cache_gather(cache, quads, 64);
+    const uint32_t expected = glyphs_in("fps 60.0") + glyphs_in("two\nlines!");
+    const float pad = GLYPH_ATLAS_PAD * 2.f;
+    const TextQuad* l = &quads[glyphs_in("fps 60.0") + 3];  // the "l"
+    const bool layout = count == expected && l->glyph == 'l' - GLYPH_ATLAS_FIRST && l->rect[0] == 10.f - pad
+        && l->rect[1] == 40.f + (GLYPH_FONT_HEIGHT + 1) * 2.f - pad;
+    const bool capped = text_cache_gather(cache, quads, 5) == 5;
+    return report("text cache rebuilds, moves and gathers", built && reused && changed && same && layout && capped);
+}
+
+int main(int argc, char** argv)
+{
+    const char* dir = argc > 1 ? argv[1] : "text_bench_cache";
+    const int iterations = argc > 2 ? atoi(argv[2]) : 2000;
+    GlyphAtlas atlas;
+    bool ok = glyph_atlas_build(&atlas);
+    ok = ok && check_field(&atlas);
+    ok = ok && check_cache(&atlas, dir);
+    glyph_atlas_destroy(&atlas);
+    TextCache* cache = (TextCache*)malloc(sizeof(TextCache));
+    ok = check_text(cache) && ok;
+
+    // A frame of 100 labels: unchanged, against every readout changing and so laid out again
+    TextCache* changing = (TextCache*)malloc(sizeof(TextCache));
+    text_cache_init(cache);
+    text_cache_init(changing);
+    for (int i = 0; i < 100; ++i)
+    {
+        text_cache_add(cache);
+        text_cache_add(changing);
+    }
+    static TextQuad quads[TEXT_MAX_STRINGS * TEXT_MAX_GLYPHS];
+    double cached_ms = 0.0, rebuilt_ms = 0.0;
+    uint32_t gathered = 0;
+    for (int frame = 0; frame < iterations; ++frame)
+    {
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            TextCache* c = pass ? changing : cache;
+            const double t = now_ms();
+            for (int i = 0; i < 100; ++i)
+                text_cache_printf(c, i, 10.f, 16.f * i, 1.f, 0xFFFFFFFFu, "object %3d  %8.2f, %8.2f", i, i * 1.5,
+                    pass ? (double)frame : 0.0);
+            gathered += text_cache_gather(c, quads, TEXT_MAX_STRINGS * TEXT_MAX_GLYPHS);
+            (pass ? rebuilt_ms : cached_ms) += now_ms() - t;
+        }
+    }
+    printf("  100 labels a frame: %.2f us unchanged, %.2f us laid out (%u quads)\n", 1000.0 * cached_ms / iterations,
+        1000.0 * rebuilt_ms / iterations, gathered / (2 * iterations));
+    ok = report("only changed labels laid out", cache->built == 100 && changing->built == 100u * iterations) && ok;
+    free(changing);
+    free(cache);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
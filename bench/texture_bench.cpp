@@ -0,0 +1,253 @@
+// Texture check: writes DDS (legacy FourCC and DX10) and KTX2 files with full mip chains, opens them
+// with src/asset/texture_file.h and checks every level's size and position, and that Basis Universal
+// and truncated files are turned away. Then runs the mip residency policy (src/asset/texture_residency.h)
+// over a scene of large textures whose on-screen sizes drift from frame to frame. Fails if the memory or
+// upload budget is broken, or if a change doesn't follow from the previous state. It also fails if the
+// tails aren't all in after the first update. Reports how often textures had the detail they were
+// drawn at.
+//
+// Usage: texture_bench [textures] [frames] [budget_mb]
+
+#include "asset/texture_file.h"
+#include "asset/texture_residency.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static void put_u32(std::vector<unsigned char>& out, size_t at, uint32_t v)
+{
+    memcpy(&out[at], &v, sizeof(v));
+}
+
+static void put_u64(std::vector<unsigned char>& out, size_t at, uint64_t v)
+{
+    memcpy(&out[at], &v, sizeof(v));
+}
+
+// Level "l" filled with the byte l + 1, so a level read from the wrong place shows
+static void append_levels(std::vector<unsigned char>& out, TextureFormat format, uint32_t width, uint32_t height, int levels)
+{
+    for (int l = 0; l < levels; ++l)
+    {
+        out.insert(out.end(), texture_level_size(format, width, height), (unsigned char)(l + 1));
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+}
+
+static std::vector<unsigned char> make_dds(const char* code, uint32_t dxgi, TextureFormat format, uint32_t width, uint32_t height, int levels)
+{
+    std::vector<unsigned char> out(4 + 124 + (dxgi ? 20 : 0), 0);
+    memcpy(&out[0], "DDS ", 4);
+    put_u32(out, 4, 124);
+    put_u32(out, 8, 0x1007u | 0x20000u);    // caps, height, width, pixel format, mip count
+    put_u32(out, 12, height);
+    put_u32(out, 16, width);
+    put_u32(out, 28, (uint32_t)levels);
+    put_u32(out, 76, 32);
+    put_u32(out, 80, 0x4u);                 // DDPF_FOURCC
+    memcpy(&out[84], code, 4);
+    if (dxgi)
+    {
+        put_u32(out, 128, dxgi);
+        put_u32(out, 132, 3);               // TEXTURE2D
+        put_u32(out, 140, 1);               // array size
+    }
+    append_levels(out, format, width, height, levels);
+    return out;
+}
+
+// Tail first, as KTX2 tools write it; the level index still lists level 0 first
+static std::vector<unsigned char> make_ktx2(uint32_t vk_format, TextureFormat format, uint32_t width, uint32_t height, int levels,
+    uint32_t supercompression)
+{
+    static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> out(80 + 24 * levels, 0);
+    memcpy(&out[0], identifier, sizeof(identifier));
+    put_u32(out, 12, vk_format);
+    put_u32(out, 20, width);
+    put_u32(out, 24, height);
+    put_u32(out, 36, 1);                    // faces
+    put_u32(out, 40, (uint32_t)levels);
+    put_u32(out, 44, supercompression);
+    for (int l = levels - 1; l >= 0; --l)
+    {
+        const uint32_t w = width >> l ? width >> l : 1, h = height >> l ? height >> l : 1;
+        const uint64_t size = texture_level_size(format, w, h);
+        put_u64(out, 80 + 24 * l, out.size());
+        put_u64(out, 80 + 24 * l + 8, size);
+        put_u64(out, 80 + 24 * l + 16, size);
+        out.insert(out.end(), size, (unsigned char)(l + 1));
+    }
+    return out;
+}
+
+static bool check_file(const char* name, const std::vector<unsigned char>& bytes, TextureFormat format, bool srgb,
+    uint32_t width, uint32_t height, int levels)
+{
+    TextureFile t;
+    bool ok = texture_file_open_memory(&t, bytes.data(), bytes.size(), name) && t.format == format && t.srgb == srgb
+        && t.width == width && t.height == height && t.level_count == levels;
+    for (int l = 0; ok && l < levels; ++l)
+    {
+        const uint32_t w = width >> l ? width >> l : 1, h = height >> l ? height >> l : 1;
+        const unsigned char* data = (const unsigned char*)t.levels[l].data;
+        ok = t.levels[l].width == w && t.levels[l].height == h && t.levels[l].size == texture_level_size(format, w, h)
+            && data >= bytes.data() && data + t.levels[l].size <= bytes.data() + bytes.size()
+            && data[0] == l + 1 && data[t.levels[l].size - 1] == l + 1;
+    }
+    texture_file_close(&t);
+    printf("  %-34s %s\n", name, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static bool check_rejected(const char* name, const std::vector<unsigned char>& bytes)
+{
+    TextureFile t;
+    const bool ok = !texture_file_open_memory(&t, bytes.data(), bytes.size(), name);
+    printf("  %-34s %s\n", name, ok ? "rejected, ok" : "FAIL (accepted)");
+    return ok;
+}
+
+static bool check_files()
+{
+    printf("container parsing:\n");
+    bool ok = check_file("DDS DXT1 256x256", make_dds("DXT1", 0, TEXTURE_FORMAT_BC1, 256, 256, 9), TEXTURE_FORMAT_BC1, false, 256, 256, 9);
+    ok = check_file("DDS DX10 BC7 sRGB 300x200", make_dds("DX10", 99, TEXTURE_FORMAT_BC7, 300, 200, 9), TEXTURE_FORMAT_BC7, true, 300, 200, 9) && ok;
+    ok = check_file("DDS DX10 BC5 64x16", make_dds("DX10", 83, TEXTURE_FORMAT_BC5, 64, 16, 7), TEXTURE_FORMAT_BC5, false, 64, 16, 7) && ok;
+    ok = check_file("KTX2 ASTC 6x6 sRGB 1000x600", make_ktx2(166, TEXTURE_FORMAT_ASTC_6x6, 1000, 600, 10, 0),
+        TEXTURE_FORMAT_ASTC_6x6, true, 1000, 600, 10) && ok;
+    ok = check_file("KTX2 ETC2 RGBA8 512x512", make_ktx2(151, TEXTURE_FORMAT_ETC2_RGBA8, 512, 512, 10, 0),
+        TEXTURE_FORMAT_ETC2_RGBA8, false, 512, 512, 10) && ok;
+    ok = check_file("KTX2 BC1 128x128, 3 levels", make_ktx2(133, TEXTURE_FORMAT_BC1, 128, 128, 3, 0), TEXTURE_FORMAT_BC1, false, 128, 128, 3) && ok;
+    ok = check_rejected("KTX2 BasisLZ", make_ktx2(0, TEXTURE_FORMAT_BC7, 64, 64, 1, 1)) && ok;
+    std::vector<unsigned char> truncated = make_dds("DXT5", 0, TEXTURE_FORMAT_BC3, 128, 128, 8);
+    truncated.resize(truncated.size() - 1);
+    ok = check_rejected("DDS missing its last byte", truncated) && ok;
+    ok = check_rejected("DDS with more mips than 1x1", make_dds("DXT1", 0, TEXTURE_FORMAT_BC1, 4, 4, 4)) && ok;
+
+    // Through a real mapping too
+    const char* path = "texture_bench.dds";
+    const std::vector<unsigned char> dds = make_dds("DX10", 98, TEXTURE_FORMAT_BC7, 512, 256, 10);
+    FILE* f = fopen(path, "wb");
+    bool mapped = f && fwrite(dds.data(), 1, dds.size(), f) == dds.size();
+    if (f)
+        fclose(f);
+    TextureFile t;
+    mapped = mapped && texture_file_open(&t, path) && t.level_count == 10 && ((const unsigned char*)t.levels[9].data)[0] == 10;
+    texture_file_close(&t);
+    remove(path);
+    printf("  %-34s %s\n", "mapped from a file", mapped ? "ok" : "FAIL");
+    return ok && mapped;
+}
+
+static uint32_t random_u32(unsigned int* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static bool check_residency(int textures, int frames, uint64_t budget)
+{
+    const uint64_t upload_budget = 4u << 20;
+    TextureResidency* res = new TextureResidency;
+    texture_residency_init(res, budget, upload_budget);
+
+    // 2048x2048 BC7 with every level, 5.3 MB each
+    uint64_t level_bytes[12], texture_bytes = 0;
+    for (int l = 0; l < 12; ++l)
+    {
+        level_bytes[l] = texture_level_size(TEXTURE_FORMAT_BC7, 2048u >> l, 2048u >> l);
+        texture_bytes += level_bytes[l];
+    }
+    std::vector<int> top(textures, 12);
+    std::vector<float> distance(textures);
+    unsigned int state = 4242u;
+    for (int i = 0; i < textures; ++i)
+    {
+        texture_residency_add(res, 2048, 2048, 12, level_bytes);
+        distance[i] = 1.f + (random_u32(&state) % 1000) / 50.f;
+    }
+
+    TextureResidencyChange changes[TEXTURE_RESIDENCY_MAX_TEXTURES];
+    bool ok = true;
+    uint64_t tails = 0, satisfied = 0, requested = 0, worst_upload = 0;
+    for (int l = res->entries[0].tail; l < 12; ++l)
+        tails += level_bytes[l];
+    tails *= (uint64_t)textures;
+    for (int f = 0; f < frames && ok; ++f)
+    {
+        // Each texture drifts nearer or further; half of them are off screen at any time
+        for (int i = 0; i < textures; ++i)
+        {
+            distance[i] = fminf(fmaxf(distance[i] + ((int)(random_u32(&state) % 201) - 100) / 400.f, 0.5f), 25.f);
+            if ((i + f / 120) % 2 == 0)
+                texture_residency_request(res, i, 2048.f / distance[i]);
+        }
+        const int count = texture_residency_update(res, changes);
+        uint64_t uploaded = 0, resident = 0;
+        for (int c = 0; c < count; ++c)
+        {
+            const TextureResidencyChange* ch = &changes[c];
+            ok = ok && ch->from == top[ch->texture] && ch->to != ch->from && ch->to <= res->entries[ch->texture].tail;
+            for (int l = ch->to; l < ch->from; ++l)
+                uploaded += level_bytes[l];
+            top[ch->texture] = ch->to;
+        }
+        for (int i = 0; i < textures; ++i)
+        {
+            for (int l = top[i]; l < 12; ++l)
+                resident += level_bytes[l];
+            if ((i + f / 120) % 2 == 0)
+            {
+                ++requested;
+                satisfied += top[i] <= res->entries[i].wanted;
+            }
+        }
+        if (f > 0 && uploaded > worst_upload)
+            worst_upload = uploaded;
+        ok = ok && resident == res->resident_bytes && (resident <= budget || resident <= tails)
+            && (f == 0 || uploaded <= upload_budget || count == 1);
+        for (int i = 0; f == 0 && i < textures; ++i)
+            ok = ok && top[i] <= res->entries[i].tail;
+    }
+
+    // Halving the budget sheds levels, needed or not, down to it
+    res->budget = budget / 2;
+    const int count = texture_residency_update(res, changes);
+    uint64_t resident = 0;
+    for (int c = 0; c < count; ++c)
+        top[changes[c].texture] = changes[c].to;
+    for (int i = 0; i < textures; ++i)
+        for (int l = top[i]; l < 12; ++l)
+            resident += level_bytes[l];
+    ok = ok && resident == res->resident_bytes && resident <= budget / 2;
+
+    printf("residency: %d textures of 2048x2048 BC7 (%.1f MB each), %d frames, budget %.0f MB, upload %.0f MB/frame\n",
+        textures, texture_bytes / 1048576.0, frames, budget / 1048576.0, upload_budget / 1048576.0);
+    printf("  drawn with the detail wanted %.1f%% of the time, worst frame uploaded %.2f MB\n",
+        requested ? 100.0 * satisfied / requested : 0.0, worst_upload / 1048576.0);
+    printf("  %.1f MB uploaded, %.1f MB evicted, %llu upgrades waited for memory; %.1f MB resident at half the budget  %s\n",
+        res->uploaded_bytes / 1048576.0, res->evicted_bytes / 1048576.0, (unsigned long long)res->deferred,
+        resident / 1048576.0, ok ? "ok" : "FAIL");
+    delete res;
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int textures = argc > 1 ? atoi(argv[1]) : 64;
+    const int frames = argc > 2 ? atoi(argv[2]) : 2000;
+    const int budget_mb = argc > 3 ? atoi(argv[3]) : 96;
+    if (textures < 1 || textures > TEXTURE_RESIDENCY_MAX_TEXTURES || frames < 1 || budget_mb < 1)
+    {
+        fprintf(stderr, "usage: %s [textures (1-%d)] [frames] [budget_mb]\n", argv[0], TEXTURE_RESIDENCY_MAX_TEXTURES);
+        return EXIT_FAILURE;
+    }
+    bool ok = check_files();
+    ok = check_residency(textures, frames, (uint64_t)budget_mb << 20) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
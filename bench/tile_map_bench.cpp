@@ -0,0 +1,349 @@
+// Tile map check (src/core/tile_map.h): a settled view's quads tile it exactly at its level; a jump deep into the
+// map is covered at once from ancestors, each quad's texels the part of its ancestor over the tile; loads never
+// evict a tile the frame uses, and evict the least recently used first; and prefetch, over a pan and zoom with a
+// few frames of load latency, cuts the fallback tiles. Virtual texture feedback, a ground plane's pages seen in
+// perspective, loads a level at a time, coarsest first, until every page asked for is resident, and with too few
+// slots never evicts one it asked for. Then times an update 20 levels down and a feedback's worth of ids.
+//
+// Usage: tile_map_bench [slots] [latency frames]
+
+#include "core/tile_map.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DRAWS 4096
+#define MAX_REQUESTS 64
+#define WIDTH 1920
+#define HEIGHT 1080
+#define TILE 256
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// A loader that finishes every request "latency" frames after it was made
+typedef struct Loader
+{
+    int slots[1 << 14];
+    uint64_t due[1 << 14];
+    int count;
+    int latency;
+} Loader;
+
+static void loader_step(TileMap* map, Loader* loader, const TileRequest* requests, int request_count)
+{
+    int kept = 0;
+    for (int i = 0; i < loader->count; ++i)
+    {
+        if (loader->due[i] <= map->frame)
+            tile_map_loaded(map, loader->slots[i]);
+        else if (!tile_map_wanted(map, loader->slots[i]) && map->slots[loader->slots[i]].state == TILE_SLOT_LOADING
+            && !map->slots[loader->slots[i]].pinned)
+            tile_map_cancel(map, loader->slots[i]);
+        else
+        {
+            loader->slots[kept] = loader->slots[i];
+            loader->due[kept++] = loader->due[i];
+        }
+    }
+    loader->count = kept;
+    for (int i = 0; i < request_count; ++i)
+    {
+        loader->slots[loader->count] = requests[i].slot;
+        loader->due[loader->count++] = map->frame + loader->latency;
+    }
+}
+
+// The view around "centre" at "zoom" (the level whose texels are one a pixel, fractional)
+static void make_view(const double centre[2], double zoom, double view[4])
+{
+    const double px = TILE * exp2(zoom);   // pixels a map unit
+    view[0] = centre[0] - 0.5 * WIDTH / px;
+    view[1] = centre[1] - 0.5 * HEIGHT / px;
+    view[2] = centre[0] + 0.5 * WIDTH / px;
+    view[3] = centre[1] + 0.5 * HEIGHT / px;
+}
+
+// The map rectangle a quad's texels come from, as the map rectangle of its slot's tile narrowed to its uv
+static void draw_source(const TileMap* map, const TileDraw* d, double out[4])
+{
+    int level;
+    uint32_t x, y;
+    tile_map_key_tile(map->slots[d->slot].key, &level, &x, &y);
+    const double size = 1.0 / (double)(1u << level);
+    out[0] = (x + d->uv[0]) * size;
+    out[1] = (y + d->uv[1]) * size;
+    out[2] = (x + d->uv[2]) * size;
+    out[3] = (y + d->uv[3]) * size;
+}
+
+// A pan at "speed" pixels a second with the zoom swinging over "levels" levels, "frames" frames at 60 Hz. Returns
+// the fallback tiles summed over the frames; "worst" gets the most of any one frame.
+static uint64_t fly(TileMap* map, Loader* loader, int frames, double speed, double levels, TileDraw* draws,
+    TileRequest* requests, unsigned int* worst)
+{
+    double centre[2] = { 0.3, 0.4 };
+    uint64_t fallback = 0;
+    *worst = 0;
+    for (int f = 0; f < frames; ++f)
+    {
+        const double t = f / 60.0;
+        const double zoom = 12.0 + levels * sin(0.4 * t);
+        const double px = TILE * exp2(zoom);
+        centre[0] += cos(0.2 * t) * speed / 60.0 / px;
+        centre[1] += sin(0.2 * t) * speed / 60.0 / px;
+        double view[4];
+        make_view(centre, zoom, view);
+        int requested = 0;
+        tile_map_update(map, view, WIDTH, HEIGHT, 1.0 / 60.0, draws, MAX_DRAWS, requests, MAX_REQUESTS, &requested);
+        loader_step(map, loader, requests, requested);
+        if (f > 30)     // once the pinned levels are in
+        {
+            fallback += map->stats.fallback;
+            *worst = map->stats.fallback > *worst ? map->stats.fallback : *worst;
+        }
+    }
+    return fallback;
+}
+
+#define FEEDBACK_WIDTH 240       // a 1920 x 1080 frame's feedback, an eighth across
+#define FEEDBACK_HEIGHT 135
+
+// The pages a feedback pass over a ground plane sees from "eye" (x, y in [0, 1]), looking along +y: the rows
+// further up reach further away, their pixels spanning more of the plane and so coarser levels
+static int ground_feedback(const double eye[2], int levels, uint64_t* keys)
+{
+    int count = 0;
+    for (int row = 0; row < FEEDBACK_HEIGHT; ++row)
+    {
+        const double distance = 0.002 / (1.0 - row / (double)FEEDBACK_HEIGHT);   // to the horizon at the top
+        const double across = distance / FEEDBACK_WIDTH;                            // plane a feedback pixel spans
+        int level = (int)floor(log2(1.0 / (across / 8.0 * 126.0)));                 // a texel a frame pixel
+        level = level < 0 ? 0 : level >= levels ? levels - 1 : level;
+        for (int column = 0; column < FEEDBACK_WIDTH; ++column)
+        {
+            const double u = eye[0] + (column - FEEDBACK_WIDTH / 2) * across, v = eye[1] + distance;
+            if (u < 0.0 || u >= 1.0 || v >= 1.0)
+                continue;
+            const double n = (double)(1u << level);
+            keys[count++] = tile_map_key(level, (uint32_t)(u * n), (uint32_t)(v * n));
+        }
+    }
+    return count;
+}
+
+// Feedback rounds over a still view until nothing more loads, each a frame apart. Checks that every load is the
+// coarsest missing page of its path (its parent resident or loading, or itself pinned), that a round's loads come
+// coarsest first and that nothing the round asked for is evicted. Returns the rounds taken, -1 on a failed check.
+static int settle_feedback(TileMap* map, Loader* loader, const double eye[2], uint64_t* keys, TileRequest* requests)
+{
+    for (int round = 0; round < 400; ++round)
+    {
+        const int key_count = ground_feedback(eye, map->level_count, keys);
+        const int requested = tile_map_feedback(map, keys, key_count, requests, MAX_REQUESTS);
+        int last_level = 0;
+        for (int i = 0; i < requested; ++i)
+        {
+            int level;
+            uint32_t x, y;
+            tile_map_key_tile(requests[i].key, &level, &x, &y);
+            if (map->slots[requests[i].slot].pinned)
+                continue;
+            bool parent = false;
+            for (int s = 0; s < map->slot_count && !parent; ++s)
+                parent = map->slots[s].key == tile_map_key(level - 1, x >> 1, y >> 1)
+                    && map->slots[s].state != TILE_SLOT_EMPTY;
+            bool asked = false;
+            for (int k = 0; k < key_count && !asked && requests[i].evicted != TILE_MAP_NO_KEY; ++k)
+                asked = keys[k] == requests[i].evicted;
+            if (!parent || level < last_level || asked)
+                return -1;
+            last_level = level;
+        }
+        loader_step(map, loader, requests, requested);
+        if (!requested && !map->loading && map->stats.fallback == 0)
+            return round;
+    }
+    return 400;
+}
+
+int main(int argc, char** argv)
+{
+    const int slots = argc > 1 ? atoi(argv[1]) : 512;
+    const int latency = argc > 2 ? atoi(argv[2]) : 6;
+    TileDraw* draws = (TileDraw*)malloc(sizeof(TileDraw) * MAX_DRAWS);
+    TileRequest requests[MAX_REQUESTS];
+    static Loader loader;
+    TileMap map;
+    if (!tile_map_init(&map, slots, 21, TILE, 32, 0.0))
+        return EXIT_FAILURE;
+
+    // A still view, run until nothing more loads: its tiles at its level, covering it once
+    const double home[2] = { 0.61803, 0.41421 };
+    double view[4];
+    make_view(home, 6.3, view);
+    loader.latency = latency;
+    int draw_count = 0, requested = 0;
+    for (int f = 0, busy = 1; f < 200 && busy; ++f)
+    {
+        busy = map.loading;     // the update after loads stop coming in may still make new requests
+        draw_count = tile_map_update(&map, view, WIDTH, HEIGHT, 1.0 / 60.0, draws, MAX_DRAWS, requests, MAX_REQUESTS,
+            &requested);
+        loader_step(&map, &loader, requests, requested);
+        busy = busy || requested;
+    }
+    draw_count = tile_map_update(&map, view, WIDTH, HEIGHT, 1.0 / 60.0, draws, MAX_DRAWS, requests, MAX_REQUESTS,
+        &requested);
+    double covered = 0.0;
+    bool at_level = !requested && map.stats.fallback == 0;
+    for (int k = 0; k < draw_count; ++k)
+    {
+        const float x0 = fmaxf(draws[k].rect[0], 0.f), y0 = fmaxf(draws[k].rect[1], 0.f);
+        const float x1 = fminf(draws[k].rect[2], (float)WIDTH), y1 = fminf(draws[k].rect[3], (float)HEIGHT);
+        covered += (double)fmaxf(x1 - x0, 0.f) * fmaxf(y1 - y0, 0.f);
+        at_level = at_level && draws[k].level == map.view_level && draws[k].uv[0] == 0.f && draws[k].uv[2] == 1.f;
+    }
+    printf("  still view: level %d, %d tiles, %.4f of the screen covered\n", map.view_level, draw_count,
+        covered / ((double)WIDTH * HEIGHT));
+    bool ok = report("a settled view tiles the screen once", at_level && fabs(covered / ((double)WIDTH * HEIGHT) - 1.0)
+        < 1e-4);
+
+    // A jump 10 levels further down: nothing of it is resident, all of it still drawn, from the right texels
+    make_view(home, 16.7, view);
+    draw_count = tile_map_update(&map, view, WIDTH, HEIGHT, 1.0 / 60.0, draws, MAX_DRAWS, requests, MAX_REQUESTS,
+        &requested);
+    loader_step(&map, &loader, requests, requested);
+    bool sourced = map.stats.missing == 0 && map.stats.fallback == map.stats.visible && draw_count == (int)map.stats.visible;
+    const double n = (double)(1u << map.view_level);
+    for (int k = 0; k < draw_count && sourced; ++k)
+    {
+        // The quad's map rectangle, back from its pixels
+        const double px = WIDTH / (view[2] - view[0]);
+        const double tile[2] = { view[0] + draws[k].rect[0] / px, view[1] + draws[k].rect[1] / px };
+        double source[4];
+        draw_source(&map, &draws[k], source);
+        sourced = fabs(source[0] - tile[0]) * n < 1e-3 && fabs(source[1] - tile[1]) * n < 1e-3
+            && fabs((source[2] - source[0]) * n - 1.0) < 1e-3 && draws[k].level < map.view_level;
+    }
+    printf("  jump to level %d: %u tiles, %u from ancestors, %d requested\n", map.view_level, map.stats.visible,
+        map.stats.fallback, requested);
+    ok = report("a jump is drawn from ancestors' texels", sourced) && ok;
+
+    // A long flight: nothing the frame draws is evicted, and what is evicted was the least recently used
+    TileSlot* before = (TileSlot*)malloc(sizeof(TileSlot) * map.slot_count);
+    double centre[2] = { 0.2, 0.7 };
+    bool lru = true, safe = true;
+    uint64_t evicted = 0;
+    for (int f = 0; f < 2000 && lru && safe; ++f)
+    {
+        const double zoom = 11.0 + 5.0 * sin(f * 0.01);
+        centre[0] += 900.0 / 60.0 / (TILE * exp2(zoom));
+        make_view(centre, zoom, view);
+        memcpy(before, map.slots, sizeof(TileSlot) * map.slot_count);
+        draw_count = tile_map_update(&map, view, WIDTH, HEIGHT, 1.0 / 60.0, draws, MAX_DRAWS, requests, MAX_REQUESTS,
+            &requested);
+        for (int k = 0; k < draw_count; ++k)
+            safe = safe && map.slots[draws[k].slot].state == TILE_SLOT_RESIDENT;
+        // An evicted slot was resident before and holds a request's key now; no slot left resident and untouched
+        // this frame may be older than it
+        for (int i = 0; i < requested; ++i)
+        {
+            const TileSlot* old = &before[requests[i].slot];
+            if (old->state != TILE_SLOT_RESIDENT)
+                continue;
+            ++evicted;
+            for (int s = 0; s < map.slot_count && lru; ++s)
+                lru = !(map.slots[s].state == TILE_SLOT_RESIDENT && !map.slots[s].pinned && map.slots[s].used != map.frame
+                    && before[s].key == map.slots[s].key && map.slots[s].used < old->used);
+            lru = lru && old->used != map.frame && !old->pinned;
+        }
+        loader_step(&map, &loader, requests, requested);
+    }
+    printf("  flight: %llu evictions over %d slots\n", (unsigned long long)evicted, map.slot_count);
+    ok = report("drawn tiles stay resident", safe) && ok;
+    ok = report("evictions take the least recently used", lru && evicted > 0) && ok;
+    free(before);
+    tile_map_destroy(&map);
+
+    // Prefetch: the same pan and zoom, with and without a lookahead
+    unsigned int worst[2];
+    uint64_t fallback[2];
+    for (int p = 0; p < 2; ++p)
+    {
+        tile_map_init(&map, slots, 21, TILE, 32, p ? 0.4 : 0.0);
+        loader.count = 0;
+        fallback[p] = fly(&map, &loader, 1800, 1500.0, 6.0, draws, requests, &worst[p]);
+        printf("  lookahead %.1f s: %6llu fallback tiles over 30 s (at most %u a frame), %llu loads\n", map.lookahead,
+            (unsigned long long)fallback[p], worst[p], (unsigned long long)map.total_requested);
+        tile_map_destroy(&map);
+    }
+    ok = report("prefetch halves the fallback tiles", 2 * fallback[1] < fallback[0]) && ok;
+
+    // Virtual texture feedback: the ground's pages load a level at a time until all are in; then a step forward
+    // with too few slots for both views' pages evicts only what the new feedback didn't ask for
+    uint64_t* keys = (uint64_t*)malloc(sizeof(uint64_t) * FEEDBACK_WIDTH * FEEDBACK_HEIGHT);
+    const double eye[2] = { 0.5, 0.1 };
+    tile_map_init(&map, slots, 14, 128, 32, 0.0);
+    loader.count = 0;
+    loader.latency = 2;
+    const int rounds = settle_feedback(&map, &loader, eye, keys, requests);
+    printf("  feedback: %u pages asked for, all resident after %d rounds and %llu loads\n", map.stats.visible, rounds,
+        (unsigned long long)map.total_requested);
+    ok = report("feedback fills in coarsest first", rounds > 0 && rounds < 400) && ok;
+    const int needed = (int)map.total_requested;
+    tile_map_destroy(&map);
+    tile_map_init(&map, needed * 3 / 4 > 4 * TILE_MAP_PINNED_TILES ? needed * 3 / 4 : 4 * TILE_MAP_PINNED_TILES, 14,
+        128, 32, 0.0);
+    loader.count = 0;
+    const double ahead[2] = { 0.5, 0.1003 };
+    const int squeezed = settle_feedback(&map, &loader, eye, keys, requests);
+    const int moved = squeezed >= 0 ? settle_feedback(&map, &loader, ahead, keys, requests) : -1;
+    printf("  feedback in %d slots: settled in %d rounds, then in %d after a step, %llu evictions\n", map.slot_count,
+        squeezed, moved, (unsigned long long)map.total_evicted);
+    ok = report("feedback never evicts a page it asks for", squeezed > 0 && moved >= 0) && ok;
+
+    // Cost: a feedback's worth of ids, everything resident
+    const int key_count = ground_feedback(eye, map.level_count, keys);
+    uint64_t* unsorted = (uint64_t*)malloc(sizeof(uint64_t) * key_count);
+    memcpy(unsorted, keys, sizeof(uint64_t) * key_count);
+    double t = now_ms();
+    for (int f = 0; f < 100; ++f)
+    {
+        memcpy(keys, unsorted, sizeof(uint64_t) * key_count);     // sorted in place
+        tile_map_feedback(&map, keys, key_count, requests, MAX_REQUESTS);
+    }
+    printf("  feedback of %d ids: %.2f us each\n", key_count, (now_ms() - t) * 10.0);
+    tile_map_destroy(&map);
+    free(unsorted);
+    free(keys);
+
+    // Cost: an update over a view 20 levels down, everything resident
+    tile_map_init(&map, 4096, 28, TILE, 64, 0.4);
+    loader.count = 0;
+    loader.latency = 1;
+    make_view(home, 20.2, view);
+    for (int f = 0; f < 100; ++f)
+    {
+        tile_map_update(&map, view, WIDTH, HEIGHT, 1.0 / 60.0, draws, MAX_DRAWS, requests, MAX_REQUESTS, &requested);
+        loader_step(&map, &loader, requests, requested);
+    }
+    t = now_ms();
+    for (int f = 0; f < 1000; ++f)
+        draw_count = tile_map_update(&map, view, WIDTH, HEIGHT, 1.0 / 60.0, draws, MAX_DRAWS, requests, MAX_REQUESTS,
+            &requested);
+    printf("  level %d view: %d tiles, %.2f us an update\n", map.view_level, draw_count, (now_ms() - t));
+    tile_map_destroy(&map);
+    free(draws);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,214 @@
+// Retained UI check (src/core/ui_layer.h): a widget whose key hasn't changed isn't rebuilt and marks nothing; one
+// that changed rewrites only its own range and marks only the pixels it covered before and after; a widget that
+// shrinks leaves its old indices degenerate and one that outgrows its range is cut to whole triangles; dirty
+// rectangles merge. Then times frames of a 16-chart dashboard where each chart's feed ticks at 1 to 4 readings a
+// second, retained against rebuilt from scratch as an immediate-mode batch, at 60 frames a second.
+//
+// Usage: ui_layer_bench [primitives] [seconds]
+
+#include "core/ui_layer.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHARTS 16
+#define WIDTH 1920
+#define HEIGHT 1080
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-50s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Chart c, 4 x 4 over the screen, its "count" primitives at "time", as main.cpp's dashboard draws them
+static void chart(ShapeBatch* b, int c, int count, float time)
+{
+    const float w = WIDTH / 4.f - 8.f, h = HEIGHT / 4.f - 8.f;
+    const float x0 = 8.f + c % 4 * (w + 8.f), y0 = 8.f + c / 4 * (h + 8.f);
+    const float step = w / (count > 0 ? count : 1);
+    shape_batch_rect(b, x0, y0, w, h, 0x90201810u);
+    shape_batch_set_layer(b, 1);
+    for (int j = 0; j < count; ++j)
+    {
+        const float x = x0 + j * step, y = y0 + h * (0.5f - 0.4f * sinf(time * 1.7f + j * 0.05f + c));
+        switch (j & 3)
+        {
+        case 0:
+            shape_batch_rect(b, x, y, step > 1.f ? step : 1.f, y0 + h - y, 0x80F0A040u);
+            break;
+        case 1:
+            shape_batch_line(b, x - step, y, x, y + 4.f, 1.5f, 0xFF60E0FFu);
+            break;
+        case 2:
+            shape_batch_circle(b, x, y, 2.5f, 0xFF4080FFu);
+            break;
+        default:
+            shape_batch_triangle(b, x, y - 3.f, x - 3.f, y + 3.f, x + 3.f, y + 3.f, 0xFFFFFFFFu);
+            break;
+        }
+    }
+    shape_batch_set_layer(b, 0);
+}
+
+static bool inside(const float* outer, const float* inner)
+{
+    return outer[0] <= inner[0] && outer[1] <= inner[1] && outer[2] >= inner[2] && outer[3] >= inner[3];
+}
+
+static bool check_dirty(UiLayer* ui)
+{
+    for (int c = 0; c < CHARTS; ++c)
+        ui_layer_add(ui, 1024, 2048);
+    for (int c = 0; c < CHARTS; ++c)
+        if (ShapeBatch* b = ui_layer_begin(ui, c, 1))
+        {
+            chart(b, c, 64, 0.f);
+            ui_layer_end(ui);
+        }
+    bool ok = report("adding widgets marks everything", ui->all_dirty && ui->dropped == 0);
+    ui_layer_clean(ui);
+
+    bool unchanged = true;
+    for (int c = 0; c < CHARTS; ++c)
+        unchanged = unchanged && !ui_layer_begin(ui, c, 1);
+    ok = report("an unchanged key is only a compare", unchanged && ui->reused == CHARTS && !ui->dirty_count
+        && !ui->dirty_widgets) && ok;
+
+    const UiWidget* w = &ui->widgets[5];
+    float before[4];
+    memcpy(before, w->bounds, sizeof(before));
+    ShapeBatch* b = ui_layer_begin(ui, 5, 2);
+    chart(b, 5, 64, 1.f);
+    ui_layer_end(ui);
+    ok = report("a changed widget rewrites only its own range", ui->dirty_widgets == 1 && w->dirty
+        && w->dirty_indices == w->index_count) && ok;
+    bool covered = ui->dirty_count == 1 && inside(ui->dirty[0], before) && inside(ui->dirty[0], w->bounds);
+    const float* d = ui->dirty[0];
+    ok = report("and marks the pixels it covered, before and after", covered
+        && (d[2] - d[0]) * (d[3] - d[1]) < WIDTH * HEIGHT / 12.f) && ok;
+    ui_layer_clean(ui);
+
+    // Shrunk: the indices it used before go degenerate
+    const uint32_t had = w->index_count;
+    b = ui_layer_begin(ui, 5, 3);
+    chart(b, 5, 8, 1.f);
+    ui_layer_end(ui);
+    bool degenerate = w->index_count < had && w->dirty_indices == had;
+    for (uint32_t i = w->index_count; i < had; ++i)
+        degenerate = degenerate && ui->indices[w->first_index + i] == w->first_vertex;
+    bool valid = true;
+    for (uint32_t i = 0; i < w->index_count; ++i)
+        valid = valid && ui->indices[w->first_index + i] - w->first_vertex < w->vertex_count;
+    ok = report("a shrunk widget leaves its old indices degenerate", degenerate && valid) && ok;
+
+    // Outgrown: whole triangles that fit, the rest counted
+    b = ui_layer_begin(ui, 6, 4);
+    chart(b, 6, 1000, 1.f);
+    ui_layer_end(ui);
+    w = &ui->widgets[6];
+    valid = w->vertex_count <= w->vertex_capacity && w->index_count <= w->index_capacity && w->index_count % 3 == 0;
+    for (uint32_t i = 0; i < w->index_count; ++i)
+        valid = valid && ui->indices[w->first_index + i] - w->first_vertex < w->vertex_count;
+    ok = report("an outgrown widget is cut to whole triangles", valid && ui->dropped > 0) && ok;
+    ui_layer_clean(ui);
+
+    // Every chart changed: rectangles apart stay apart, up to the limit, and still cover every chart
+    for (int c = 0; c < CHARTS; ++c)
+    {
+        b = ui_layer_begin(ui, c, 10);
+        chart(b, c, 16, 2.f);
+        ui_layer_end(ui);
+    }
+    bool all_covered = ui->dirty_count <= UI_LAYER_MAX_DIRTY;
+    for (int c = 0; c < CHARTS; ++c)
+    {
+        bool found = false;
+        for (int i = 0; i < ui->dirty_count; ++i)
+            found = found || inside(ui->dirty[i], ui->widgets[c].bounds);
+        all_covered = all_covered && found;
+    }
+    return report("dirty rectangles merge and cover every change", all_covered && ui->dirty_count > 1) && ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 100000;
+    const double seconds = argc > 2 && atof(argv[2]) > 0.0 ? atof(argv[2]) : 60.0;
+    const int per_chart = count / CHARTS, frames = (int)(seconds * 60.0);
+    bool ok = true;
+
+    UiLayer ui;
+    ui_layer_init(&ui);
+    ok = check_dirty(&ui) && ok;
+    ui_layer_destroy(&ui);
+
+    // Rebuilt: every chart into a batch every frame, all of whose vertices and indices the shape renderer's
+    // stream would take
+    ShapeBatch batch;
+    shape_batch_init(&batch);
+    double start = now_ms();
+    uint64_t streamed = 0;
+    for (int f = 0; f < frames; ++f)
+    {
+        shape_batch_clear(&batch);
+        for (int c = 0; c < CHARTS; ++c)
+            chart(&batch, c, per_chart, (float)floor(f / 60.0 * (1 + c % 4)));
+        uint32_t vertices = 0, indices = 0;
+        shape_batch_totals(&batch, &vertices, &indices);
+        streamed += (uint64_t)vertices * sizeof(ShapeVertex) + (uint64_t)indices * sizeof(uint32_t);
+    }
+    const double rebuilt_ms = (now_ms() - start) / frames;
+    shape_batch_destroy(&batch);
+
+    // Retained: a chart rebuilt when its feed ticks; what's uploaded is the rewritten widgets, what's redrawn the
+    // dirty rectangles
+    ui_layer_init(&ui);
+    for (int c = 0; c < CHARTS; ++c)
+        ui_layer_add(&ui, 8 * per_chart + 64, 16 * per_chart + 64);
+    uint64_t uploaded = 0, pixels = 0;
+    int redrawn = 0;
+    start = now_ms();
+    for (int f = 0; f < frames; ++f)
+    {
+        for (int c = 0; c < CHARTS; ++c)
+        {
+            const double reading = floor(f / 60.0 * (1 + c % 4));
+            if (ShapeBatch* b = ui_layer_begin(&ui, c, (uint64_t)reading))
+            {
+                chart(b, c, per_chart, (float)reading);
+                ui_layer_end(&ui);
+            }
+        }
+        if (f == 0)
+        {
+            ui_layer_clean(&ui);
+            continue;
+        }
+        for (uint32_t c = 0; c < ui.widget_count; ++c)
+            if (ui.widgets[c].dirty)
+                uploaded += ui.widgets[c].vertex_count * sizeof(ShapeVertex)
+                    + ui.widgets[c].dirty_indices * sizeof(uint32_t);
+        for (int i = 0; i < ui.dirty_count; ++i)
+            pixels += (uint64_t)((ui.dirty[i][2] - ui.dirty[i][0]) * (ui.dirty[i][3] - ui.dirty[i][1]));
+        redrawn += ui.dirty_count > 0;
+        ui_layer_clean(&ui);
+    }
+    const double retained_ms = (now_ms() - start) / frames;
+    printf("  %d primitives, rebuilt: %.3f ms and %.0f KB streamed a frame\n", count, rebuilt_ms,
+        streamed / 1024.0 / frames);
+    printf("  %d primitives, retained: %.3f ms and %.1f KB uploaded a frame, %d of %d frames redrew %.1f%% of the"
+        " screen on average\n", count, retained_ms, uploaded / 1024.0 / frames, redrawn, frames,
+        100.0 * pixels / ((double)frames * WIDTH * HEIGHT));
+    ok = report("retained uploads less than a tenth of the stream", uploaded * 10 < streamed && ui.dropped == 0) && ok;
+    ui_layer_destroy(&ui);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
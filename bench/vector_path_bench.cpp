@@ -0,0 +1,281 @@
+// Vector path check (src/core/vector_path.h, the paths of src/core/shape_batch.h): curves flatten within the
+// tolerance and more finely as it shrinks; a flattening is kept however the path moves and made again only when
+// it's edited or zoomed well in; the fan a fill becomes winds around each point as its outline does, so holes and
+// self-intersections come out by either rule; strokes cover their width, with round or bevelled corners; and paths
+// that keep apart share a wave. Then times frames of gauges appended with their static paths, and with every
+// path rebuilt.
+//
+// Usage: vector_path_bench [gauges] [frames]
+
+#include "core/shape_batch.h"
+#include "core/vector_path.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-48s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// How many times, counted by facing (or every one, "any"), path "p"'s triangles cover x, y: what the coverage
+// target would hold there
+static int winding(const ShapeBatch* b, uint32_t p, float x, float y, bool any)
+{
+    const ShapePath* path = &b->paths[p];
+    int w = 0;
+    for (uint32_t i = 0; i < path->index_count; i += 3)
+    {
+        const float* a = b->path_vertices[b->path_indices[path->first_index + i]].pos;
+        const float* c = b->path_vertices[b->path_indices[path->first_index + i + 1]].pos;
+        const float* d = b->path_vertices[b->path_indices[path->first_index + i + 2]].pos;
+        const float e0 = (c[0] - a[0]) * (y - a[1]) - (c[1] - a[1]) * (x - a[0]);
+        const float e1 = (d[0] - c[0]) * (y - c[1]) - (d[1] - c[1]) * (x - c[0]);
+        const float e2 = (a[0] - d[0]) * (y - d[1]) - (a[1] - d[1]) * (x - d[0]);
+        if (e0 > 0.f && e1 > 0.f && e2 > 0.f)
+            w += 1;
+        else if (e0 < 0.f && e1 < 0.f && e2 < 0.f)
+            w += any ? 1 : -1;
+    }
+    return w;
+}
+
+static bool check_flatten()
+{
+    VectorPath path;
+    vector_path_init(&path);
+    vector_path_ellipse(&path, 0.f, 0.f, 100.f, 100.f);
+    bool within = vector_path_flatten(&path, 0.2f) && path.contour_count == 1;
+    const uint32_t coarse = path.flat_count;
+    for (uint32_t i = 0; i < path.flat_count && within; ++i)
+    {
+        // Each segment's middle, where a chord strays most, and its end, off the true circle
+        const float* a = path.flat + 2 * i;
+        const float* c = path.flat + 2 * ((i + 1) % path.flat_count);
+        const float mx = 0.5f * (a[0] + c[0]), my = 0.5f * (a[1] + c[1]);
+        within = fabsf(sqrtf(mx * mx + my * my) - 100.f) <= 0.2f + 0.03f
+            && fabsf(sqrtf(a[0] * a[0] + a[1] * a[1]) - 100.f) <= 0.03f;
+    }
+    vector_path_flatten(&path, 0.05f);
+    const uint32_t fine = path.flat_count;
+    printf("  a circle of radius 100: %u segments at 0.2, %u at 0.05\n", coarse, fine);
+    vector_path_destroy(&path);
+    return report("curves flatten within the tolerance", within && fine > coarse + coarse / 2);
+}
+
+static bool check_cache(ShapeBatch* b)
+{
+    VectorPath path;
+    vector_path_init(&path);
+    vector_path_rounded_rect(&path, 0.f, 0.f, 100.f, 60.f, 12.f);
+    shape_batch_clear(b);
+    float t[6] = { 1.f, 0.f, 0.f, 1.f, 10.f, 10.f };
+    shape_batch_fill_path(b, &path, t, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    const uint32_t first = path.flattens;
+    // Moved, rotated and a little larger: the same flattening
+    for (int i = 0; i < 100; ++i)
+    {
+        const float a = i * 0.1f, s = 1.f + i * 0.005f;
+        const float moved[6] = { s * cosf(a), s * sinf(a), -s * sinf(a), s * cosf(a), (float)i, 2.f * i };
+        shape_batch_fill_path(b, &path, moved, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    }
+    const bool kept = path.flattens == first;
+    t[0] = t[3] = 3.f;
+    shape_batch_fill_path(b, &path, t, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    const bool zoomed = path.flattens == first + 1;
+    vector_path_reset(&path);
+    vector_path_rounded_rect(&path, 0.f, 0.f, 100.f, 60.f, 20.f);
+    shape_batch_fill_path(b, &path, t, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    const bool edited = path.flattens == first + 2;
+    // A stroke of it: made once, kept while the width and join are
+    shape_batch_stroke_path(b, &path, t, 2.f, VECTOR_JOIN_ROUND, 0xFFFFFFFFu);
+    shape_batch_stroke_path(b, &path, t, 2.f, VECTOR_JOIN_ROUND, 0xFFFFFFFFu);
+    const bool stroked = path.flattens == first + 3;
+    shape_batch_stroke_path(b, &path, t, 3.f, VECTOR_JOIN_ROUND, 0xFFFFFFFFu);
+    const bool widened = path.flattens == first + 4;
+    vector_path_destroy(&path);
+    return report("flattened once however it moves, again on edits", kept && zoomed && edited && stroked && widened);
+}
+
+static bool check_winding(ShapeBatch* b)
+{
+    // A square with a square hole wound the other way, and one inside wound the same way; a pentagram
+    VectorPath path;
+    vector_path_init(&path);
+    vector_path_move_to(&path, 0.f, 0.f);
+    vector_path_line_to(&path, 100.f, 0.f);
+    vector_path_line_to(&path, 100.f, 100.f);
+    vector_path_line_to(&path, 0.f, 100.f);
+    vector_path_close(&path);
+    vector_path_move_to(&path, 10.f, 10.f);
+    vector_path_line_to(&path, 10.f, 40.f);
+    vector_path_line_to(&path, 40.f, 40.f);
+    vector_path_line_to(&path, 40.f, 10.f);
+    vector_path_close(&path);
+    vector_path_move_to(&path, 60.f, 60.f);
+    vector_path_line_to(&path, 90.f, 60.f);
+    vector_path_line_to(&path, 90.f, 90.f);
+    vector_path_line_to(&path, 60.f, 90.f);
+    vector_path_close(&path);
+    shape_batch_clear(b);
+    const float t[6] = { 1.f, 0.f, 0.f, 1.f, 200.f, 300.f };
+    shape_batch_fill_path(b, &path, t, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    bool holes = b->path_count == 1 && abs(winding(b, 0, 270.3f, 320.7f, false)) == 1
+        && winding(b, 0, 225.3f, 325.7f, false) == 0 && abs(winding(b, 0, 275.3f, 375.7f, false)) == 2
+        && winding(b, 0, 310.3f, 350.7f, false) == 0;
+
+    vector_path_reset(&path);
+    for (int i = 0; i <= 5; ++i)
+    {
+        const float a = -1.5707963f + i * 2.5132741f;     // every other point of a pentagon
+        if (i == 0)
+            vector_path_move_to(&path, 50.f * cosf(a), 50.f * sinf(a));
+        else
+            vector_path_line_to(&path, 50.f * cosf(a), 50.f * sinf(a));
+    }
+    vector_path_close(&path);
+    shape_batch_fill_path(b, &path, NULL, 0xFFFFFFFFu, SHAPE_FILL_EVEN_ODD);
+    const bool star = b->path_count == 2 && abs(winding(b, 1, 0.3f, 2.7f, false)) == 2
+        && abs(winding(b, 1, 0.3f, -40.7f, false)) == 1 && winding(b, 1, 45.3f, 45.7f, false) == 0;
+    vector_path_destroy(&path);
+    return report("fans wind as the outlines do, holes and all", holes && star);
+}
+
+static bool check_stroke(ShapeBatch* b)
+{
+    VectorPath path;
+    vector_path_init(&path);
+    vector_path_move_to(&path, 0.f, 0.f);
+    vector_path_line_to(&path, 100.f, 0.f);
+    vector_path_line_to(&path, 100.f, 100.f);
+    shape_batch_clear(b);
+    shape_batch_stroke_path(b, &path, NULL, 10.f, VECTOR_JOIN_ROUND, 0xFFFFFFFFu);
+    shape_batch_stroke_path(b, &path, NULL, 10.f, VECTOR_JOIN_BEVEL, 0xFFFFFFFFu);
+    const bool round = winding(b, 0, 50.1f, 4.7f, true) > 0 && winding(b, 0, 50.1f, 5.3f, true) == 0
+        && winding(b, 0, -4.7f, 0.1f, true) > 0 && winding(b, 0, -5.3f, 0.1f, true) == 0
+        && winding(b, 0, 103.1f, -3.1f, true) > 0;
+    const bool bevel = winding(b, 1, 50.1f, -4.7f, true) > 0 && winding(b, 1, -0.3f, 0.1f, true) == 0
+        && winding(b, 1, 102.1f, -2.1f, true) > 0 && winding(b, 1, 103.1f, -3.1f, true) == 0;
+    vector_path_destroy(&path);
+    return report("strokes cover their width, round or bevelled", round && bevel);
+}
+
+static bool check_waves(ShapeBatch* b)
+{
+    VectorPath path;
+    vector_path_init(&path);
+    vector_path_ellipse(&path, 0.f, 0.f, 10.f, 10.f);
+    shape_batch_clear(b);
+    shape_batch_set_layer(b, 1);
+    shape_batch_fill_path(b, &path, NULL, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    shape_batch_set_layer(b, 0);
+    for (int i = 0; i < 100; ++i)
+    {
+        const float t[6] = { 1.f, 0.f, 0.f, 1.f, 20.f + 40.f * (i % 10), 20.f + 40.f * (i / 10) };
+        shape_batch_fill_path(b, &path, t, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    }
+    const bool apart = shape_batch_path_waves(b) == 2 && b->waves[0].layer == 0 && b->waves[0].count == 100
+        && b->waves[1].layer == 1;
+    // One on the first and one on the last: a wave after them, together; another on the first, a wave after that
+    for (int i = 0; i < 3; ++i)
+    {
+        const float over[6] = { 1.f, 0.f, 0.f, 1.f, i == 1 ? 385.f : 25.f, i == 1 ? 385.f : 25.f };
+        shape_batch_fill_path(b, &path, over, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    }
+    const bool split = shape_batch_path_waves(b) == 4 && b->waves[0].count == 100 && b->waves[1].count == 2
+        && (uint32_t)b->path_order[b->waves[1].first] == 101 && b->waves[2].count == 1 && b->waves[3].layer == 1;
+    vector_path_destroy(&path);
+    return report("paths kept apart share a wave, in layer order", apart && split);
+}
+
+static void build_statics(VectorPath* statics)
+{
+    vector_path_reset(&statics[0]);
+    vector_path_rounded_rect(&statics[0], 4.f, 4.f, 92.f, 92.f, 10.f);
+    vector_path_reset(&statics[1]);
+    vector_path_arc(&statics[1], 50.f, 55.f, 32.f, 2.3561945f, 7.0685835f);
+    vector_path_reset(&statics[2]);
+    vector_path_move_to(&statics[2], 0.f, -3.f);
+    vector_path_line_to(&statics[2], 30.f, 0.f);
+    vector_path_line_to(&statics[2], 0.f, 3.f);
+    vector_path_close(&statics[2]);
+    vector_path_ellipse(&statics[2], 0.f, 0.f, 5.f, 5.f);
+}
+
+// Gauges: each a panel and a needle, filled, and a track and a value arc, stroked. The value arcs are rebuilt
+// every frame; the rest are the three paths in "statics", kept, or built again for every gauge when "rebuild", as
+// an immediate-mode dashboard would.
+static void gauges(ShapeBatch* b, VectorPath* statics, VectorPath* values, int count, float time, bool rebuild)
+{
+    for (int g = 0; g < count; ++g)
+    {
+        const float s = 0.64f, x = (g % 64) * 64.f, y = (g / 64) * 64.f;     // a panel to every 4 x 4 cells
+        const float value = 0.5f + 0.45f * sinf(time + g * 0.37f), a = 2.3561945f + 4.712389f * value;
+        const float t[6] = { s, 0.f, 0.f, s, x, y };
+        const float needle[6] = { s * cosf(a), s * sinf(a), -s * sinf(a), s * cosf(a), x + s * 50.f, y + s * 55.f };
+        if (rebuild)
+            build_statics(statics);
+        vector_path_reset(&values[g]);
+        vector_path_arc(&values[g], 50.f, 55.f, 32.f, 2.3561945f, a);
+        shape_batch_set_layer(b, 0);
+        shape_batch_fill_path(b, &statics[0], t, 0xC0201810u, SHAPE_FILL_NONZERO);
+        shape_batch_set_layer(b, 1);
+        shape_batch_stroke_path(b, &statics[1], t, 6.f, VECTOR_JOIN_ROUND, 0xFF404040u);
+        shape_batch_stroke_path(b, &values[g], t, 6.f, VECTOR_JOIN_ROUND, 0xFF40C0FFu);
+        shape_batch_fill_path(b, &statics[2], needle, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 1000;
+    const int frames = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 100;
+    ShapeBatch* b = (ShapeBatch*)malloc(sizeof(ShapeBatch));
+    shape_batch_init(b);
+    bool ok = check_flatten();
+    ok = check_cache(b) && ok;
+    ok = check_winding(b) && ok;
+    ok = check_stroke(b) && ok;
+    ok = check_waves(b) && ok;
+
+    VectorPath statics[3];
+    VectorPath* values = (VectorPath*)malloc(sizeof(VectorPath) * count);
+    for (int i = 0; i < 3; ++i)
+        vector_path_init(&statics[i]);
+    build_statics(statics);
+    for (int g = 0; g < count; ++g)
+        vector_path_init(&values[g]);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        uint32_t waves = 0, flattens = 0, vertices = 0;
+        double start = now_ms();
+        for (int f = 0; f < frames; ++f)
+        {
+            shape_batch_clear(b);
+            gauges(b, statics, values, count, f * 0.016f, pass == 1);
+            waves += shape_batch_path_waves(b);
+            flattens += b->path_flattens;
+            vertices += b->path_vertex_count;
+        }
+        const double ms = (now_ms() - start) / frames;
+        printf("  %d paths, statics %s: %.3f ms a frame, %.1f waves, %.0f flattened, %.0f vertices\n", 4 * count,
+            pass ? "rebuilt" : "kept", ms, (double)waves / frames, (double)flattens / frames,
+            (double)vertices / frames);
+    }
+    for (int i = 0; i < 3; ++i)
+        vector_path_destroy(&statics[i]);
+    for (int g = 0; g < count; ++g)
+        vector_path_destroy(&values[g]);
+    free(values);
+    shape_batch_destroy(b);
+    free(b);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,151 @@
+// Vertex layouts as types (asset/vertex_layout.h): for layouts covering every storage type, the offsets and stride
+// must be vertex_pack_add's, the packed bytes vertex_pack's to the byte (out-of-range values and padding included)
+// and the records vertex_layout_describe writes the ones vertex_pack_add builds; the GLSL declarations must read as
+// written out by hand. Then packing the built-in mesh's two layouts is timed both ways.
+//
+// Usage: vertex_layout_bench [vertices]
+
+#include "asset/vertex_layout.h"
+#include "asset/vertex_pack.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#define ROUNDS 16
+
+typedef VertexLayout<VertexLayoutAttrib<0, 2, VERTEX_ATTRIB_FLOAT16, "vPos">,
+    VertexLayoutAttrib<1, 3, VERTEX_ATTRIB_UNORM8, "vCol">> PackedVertex;
+typedef VertexLayout<VertexLayoutAttrib<0, 2, VERTEX_ATTRIB_FLOAT32, "vPos">,
+    VertexLayoutAttrib<1, 3, VERTEX_ATTRIB_FLOAT32, "vCol">> FloatVertex;
+// The rest of the types, odd component counts for the padding, and a location past 9
+typedef VertexLayout<VertexLayoutAttrib<2, 3, VERTEX_ATTRIB_SNORM16, "vNormal">,
+    VertexLayoutAttrib<3, 1, VERTEX_ATTRIB_UNORM16, "vShade">,
+    VertexLayoutAttrib<4, 3, VERTEX_ATTRIB_SNORM8, "vTangent">,
+    VertexLayoutAttrib<6, 4, VERTEX_ATTRIB_UINT8, "vJoints">,
+    VertexLayoutAttrib<11, 1, VERTEX_ATTRIB_FLOAT16, "vSide">> MixedVertex;
+
+static_assert(PackedVertex::stride == 8 && FloatVertex::stride == 20, "the built-in mesh's 8 and 20 bytes");
+
+static void random_floats(unsigned int* state, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        *state = *state * 1664525u + 1013904223u;
+        out[i] = -1.5f + 3.f * (float)(*state >> 8) / 16777216.f;   // past the normalized ranges both ways
+    }
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// "Layout"'s records built by vertex_pack_add, for vertex_pack
+template <typename Layout, size_t... I>
+static bool runtime_records(MeshFileAttrib* attribs, uint32_t* stride, std::index_sequence<I...>)
+{
+    int count = 0;
+    *stride = 0;
+    return (vertex_pack_add(attribs, &count, stride, Layout::template Attrib<I>::location,
+        Layout::template Attrib<I>::components, Layout::template Attrib<I>::type) && ...);
+}
+
+// Packs "count" vertices of "Layout" both ways from the same floats (4 a vertex per attribute): the same bytes?
+template <typename Layout>
+static bool same_as_runtime(const char* name, size_t count, unsigned int* state)
+{
+    MeshFileAttrib runtime[MESH_FILE_MAX_ATTRIBS], described[MESH_FILE_MAX_ATTRIBS];
+    uint32_t stride = 0;
+    bool ok = runtime_records<Layout>(runtime, &stride, std::make_index_sequence<Layout::count>());
+    vertex_layout_describe<Layout>(described);
+    ok = ok && stride == Layout::stride && memcmp(runtime, described, sizeof(MeshFileAttrib) * Layout::count) == 0;
+
+    std::vector<float> floats(4 * Layout::count * count);
+    random_floats(state, floats.data(), floats.size());
+    VertexSource sources[MESH_FILE_MAX_ATTRIBS];
+    for (int a = 0; a < Layout::count; ++a)
+        sources[a] = { floats.data() + 4 * a, 4 * sizeof(float) * Layout::count };
+    // Filled with garbage first: the padding must come out zeroed either way
+    std::vector<unsigned char> a(Layout::stride * count, 0xcd), b(Layout::stride * count, 0xab);
+    vertex_pack(runtime, Layout::count, stride, sources, count, a.data());
+    vertex_layout_pack<Layout>(sources, count, b.data());
+    ok = ok && a == b;
+
+    char what[64];
+    snprintf(what, sizeof(what), "%s: layout and bytes as vertex_pack's", name);
+    return report(what, ok);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 && atoi(argv[1]) > 0 ? (size_t)atoi(argv[1]) : 1000000;
+    unsigned int state = 12345u;
+    bool ok = true;
+
+    ok = same_as_runtime<PackedVertex>("PackedVertex", 4096, &state) && ok;
+    ok = same_as_runtime<FloatVertex>("FloatVertex", 4096, &state) && ok;
+    ok = same_as_runtime<MixedVertex>("MixedVertex", 4096, &state) && ok;
+    ok = report("the GLSL declarations", strcmp(PackedVertex::glsl.data(),
+        "layout(location = 0) in vec2 vPos;\n"
+        "layout(location = 1) in vec3 vCol;\n") == 0
+        && strcmp(MixedVertex::glsl.data(),
+        "layout(location = 2) in vec3 vNormal;\n"
+        "layout(location = 3) in float vShade;\n"
+        "layout(location = 4) in vec3 vTangent;\n"
+        "layout(location = 6) in uvec4 vJoints;\n"
+        "layout(location = 11) in float vSide;\n") == 0) && ok;
+    static constexpr char head[] = "#version 330\n", tail[] = "void main() {}\n";
+    static constexpr auto spliced = vertex_layout_splice(head, PackedVertex::glsl, tail);
+    ok = report("spliced into a shader", strcmp(spliced.data(), "#version 330\n"
+        "layout(location = 0) in vec2 vPos;\n"
+        "layout(location = 1) in vec3 vCol;\n"
+        "void main() {}\n") == 0 && spliced.size() == strlen(spliced.data()) + 1) && ok;
+
+    // Timed: the built-in mesh's Vertex (vec2 pos, vec3 col) packed each way
+    std::vector<float> authored(5 * count);
+    random_floats(&state, authored.data(), authored.size());
+    const VertexSource sources[] = {
+        { authored.data(), 5 * sizeof(float) },
+        { authored.data() + 2, 5 * sizeof(float) },
+    };
+    MeshFileAttrib packed_attribs[2], float_attribs[2];
+    uint32_t packed_stride = 0, float_stride = 0;
+    runtime_records<PackedVertex>(packed_attribs, &packed_stride, std::make_index_sequence<2>());
+    runtime_records<FloatVertex>(float_attribs, &float_stride, std::make_index_sequence<2>());
+    std::vector<unsigned char> out(FloatVertex::stride * count);
+    double packed_runtime = 1e30, packed_layout = 1e30, float_runtime = 1e30, float_layout = 1e30;
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        double t0 = now_ms();
+        vertex_pack(packed_attribs, 2, packed_stride, sources, count, out.data());
+        double t1 = now_ms();
+        packed_runtime = t1 - t0 < packed_runtime ? t1 - t0 : packed_runtime;
+        vertex_layout_pack<PackedVertex>(sources, count, out.data());
+        t0 = now_ms();
+        packed_layout = t0 - t1 < packed_layout ? t0 - t1 : packed_layout;
+        vertex_pack(float_attribs, 2, float_stride, sources, count, out.data());
+        t1 = now_ms();
+        float_runtime = t1 - t0 < float_runtime ? t1 - t0 : float_runtime;
+        vertex_layout_pack<FloatVertex>(sources, count, out.data());
+        t0 = now_ms();
+        float_layout = t0 - t1 < float_layout ? t0 - t1 : float_layout;
+    }
+    printf("packing %zu vertices, best of %d:\n", count, ROUNDS);
+    printf("  %-14s %8.3f ms vertex_pack %8.3f ms vertex_layout_pack (%.2fx)\n", "PackedVertex", packed_runtime,
+        packed_layout, packed_runtime / (packed_layout > 0.0 ? packed_layout : 1e-9));
+    printf("  %-14s %8.3f ms vertex_pack %8.3f ms vertex_layout_pack (%.2fx)\n", "FloatVertex", float_runtime,
+        float_layout, float_runtime / (float_layout > 0.0 ? float_layout : 1e-9));
+
+    printf("%s\n", ok ? "vertex_layout_bench: ok" : "vertex_layout_bench: FAIL");
+    return ok ? 0 : 1;
+}
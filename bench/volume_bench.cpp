@@ -0,0 +1,235 @@
+// Volume (scene/volume.h): a made-up field's occupancy pyramid must hold every sample above the threshold, at every
+// level. Marching rays from around the box with empty-space skipping must give the dense march's colours while
+// taking far fewer samples, early termination must stay within its transmittance of the full march, and the steps
+// growing with the distance are compared against uniform ones. Streaming into a quarter of the occupied bricks'
+// slots must leave exactly the nearest ones resident, from one side and then the other.
+//
+// Usage: volume_bench [side]
+
+#include "scene/volume.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define THRESHOLD 24
+#define SAMPLES 1000000
+#define RAYS 20000
+#define MAX_LOADS 64
+#define MIN_TRANSMITTANCE 0.01f
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-60s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static float random_float(unsigned int* state, float lo, float hi)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(*state >> 8) / 16777216.f;
+}
+
+typedef struct Ray
+{
+    vec3 origin, dir;
+} Ray;
+
+// Marches every ray with "march", returning the time; "out" gets the colours
+static double march_all(const Volume* volume, const std::vector<Ray>& rays, const VolumeMarch* march,
+    std::vector<float>& out, VolumeMarchStats* stats)
+{
+    out.resize(rays.size() * 4);
+    *stats = { 0, 0, 0 };
+    const double t0 = now_ms();
+    for (size_t i = 0; i < rays.size(); ++i)
+        volume_march(volume, rays[i].origin, rays[i].dir, 100.f, march, &out[4 * i], stats);
+    return now_ms() - t0;
+}
+
+static float max_difference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    float worst = 0.f;
+    for (size_t i = 0; i < a.size(); ++i)
+        worst = fmaxf(worst, fabsf(a[i] - b[i]));
+    return worst;
+}
+
+// The resident set must be the "capacity" nearest occupied bricks, slots and bricks pointing at each other
+static bool check_resident(const VolumeStreaming* s, const Volume* volume, const vec3 eye)
+{
+    std::vector<std::pair<float, uint32_t>> nearest;
+    const uint32_t bricks = volume_brick_count(volume);
+    for (uint32_t b = 0; b < bricks; ++b)
+    {
+        if (volume->occupancy[b])
+        {
+            const int bx = (int)(b % volume->bricks[0]), by = (int)(b / volume->bricks[0] % volume->bricks[1]);
+            const int bz = (int)(b / volume->bricks[0] / volume->bricks[1]);
+            const int c[3] = { bx, by, bz };
+            float d2 = 0.f;
+            for (int k = 0; k < 3; ++k)
+            {
+                const float voxel = (volume->box_max[k] - volume->box_min[k]) / volume->size[k];
+                const float centre = volume->box_min[k] + (c[k] + 0.5f) * VOLUME_BRICK * voxel;
+                d2 += (centre - eye[k]) * (centre - eye[k]);
+            }
+            nearest.push_back({ sqrtf(d2), b });
+        }
+    }
+    std::sort(nearest.begin(), nearest.end());
+    const size_t wanted = nearest.size() < s->capacity ? nearest.size() : s->capacity;
+    bool ok = s->resident == wanted;
+    for (size_t i = 0; i < wanted; ++i)
+    {
+        // Ties at the boundary may go either way
+        const int32_t slot = s->slot_of[nearest[i].second];
+        ok = ok && (slot >= 0 || nearest[i].first >= nearest[wanted - 1].first * 0.9999f);
+        ok = ok && (slot < 0 || s->brick_of[slot] == (int32_t)nearest[i].second);
+    }
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int side = argc > 1 && atoi(argv[1]) >= VOLUME_BRICK ? atoi(argv[1]) : 256;
+    bool ok = true;
+
+    std::vector<uint8_t> voxels((size_t)side * side * side);
+    double t0 = now_ms();
+    volume_generate(voxels.data(), side, 1u);
+    const double generated = now_ms() - t0;
+    const int size[3] = { side, side, side };
+    const float box_min[3] = { -1.f, -1.f, -1.f }, box_max[3] = { 1.f, 1.f, 1.f };
+    Volume volume;
+    t0 = now_ms();
+    if (!volume_init(&volume, voxels.data(), size, box_min, box_max, THRESHOLD))
+    {
+        fprintf(stderr, "volume_bench: can't build the occupancy of %d^3 voxels\n", side);
+        return 1;
+    }
+    const double built = now_ms() - t0;
+    const uint32_t bricks = volume_brick_count(&volume);
+    printf("volume: %d^3 voxels (%.0f ms), %u of %u bricks occupied (%.1f%%), %d pyramid levels (%.1f ms)\n", side,
+        generated, volume.occupied, bricks, 100.0 * volume.occupied / bricks, volume.levels, built);
+
+    // Every sample above the threshold lies in an occupied cell at every level
+    unsigned int state = 7u;
+    bool conservative = true;
+    uint32_t visible = 0;
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        const vec3 q = { random_float(&state, 0.f, (float)side), random_float(&state, 0.f, (float)side),
+            random_float(&state, 0.f, (float)side) };
+        if (volume_sample(&volume, q) <= THRESHOLD)
+            continue;
+        ++visible;
+        for (int l = 0; l < volume.levels; ++l)
+        {
+            const int cell = VOLUME_BRICK << l;
+            int c[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                c[k] = (int)(q[k] / cell);
+                c[k] = c[k] < volume.level_size[l][k] ? c[k] : volume.level_size[l][k] - 1;
+            }
+            conservative = conservative && volume_occupied(&volume, l, c[0], c[1], c[2]);
+        }
+    }
+    char what[128];
+    snprintf(what, sizeof(what), "occupancy holds every visible sample (%u of %d)", visible, SAMPLES);
+    ok = report(what, conservative && visible > 0) && ok;
+
+    // Rays from a sphere around the box through random points in it
+    std::vector<Ray> rays(RAYS);
+    for (Ray& ray : rays)
+    {
+        const float z = random_float(&state, -1.f, 1.f), phi = random_float(&state, 0.f, 6.2831853f);
+        const float r = sqrtf(1.f - z * z);
+        const vec3 eye = { 3.f * r * cosf(phi), 3.f * r * sinf(phi), 3.f * z };
+        const vec3 target = { random_float(&state, -0.8f, 0.8f), random_float(&state, -0.8f, 0.8f),
+            random_float(&state, -0.8f, 0.8f) };
+        vec3_dup(ray.origin, eye);
+        vec3_sub(ray.dir, target, eye);
+        vec3_norm(ray.dir, ray.dir);
+    }
+    const float voxel = 2.f / side;
+    VolumeMarch march = { 0.5f * voxel, FLT_MAX, 0.37f, 0.f, false };
+    std::vector<float> dense, skipped, terminated, adaptive;
+    VolumeMarchStats dense_stats, skip_stats, terminated_stats, adaptive_stats;
+    const double dense_ms = march_all(&volume, rays, &march, dense, &dense_stats);
+    march.skip = true;
+    const double skip_ms = march_all(&volume, rays, &march, skipped, &skip_stats);
+    printf("  dense: %.1f samples a ray, %.2f us; skipping: %.1f samples, %.1f skips and %.1f descents a ray, "
+        "%.2f us\n", (double)dense_stats.samples / RAYS, 1000.0 * dense_ms / RAYS, (double)skip_stats.samples / RAYS,
+        (double)skip_stats.skips / RAYS, (double)skip_stats.descents / RAYS, 1000.0 * skip_ms / RAYS);
+    const float skip_difference = max_difference(dense, skipped);
+    snprintf(what, sizeof(what), "skipping gives the dense march's colours (max difference %.2g)",
+        (double)skip_difference);
+    ok = report(what, skip_difference < 1e-4f) && ok;
+    ok = report("skipping takes fewer samples", skip_stats.samples < dense_stats.samples) && ok;
+
+    march.min_transmittance = MIN_TRANSMITTANCE;
+    const double terminated_ms = march_all(&volume, rays, &march, terminated, &terminated_stats);
+    const float termination_difference = max_difference(skipped, terminated);
+    printf("  early termination: %.1f samples a ray, %.2f us\n", (double)terminated_stats.samples / RAYS,
+        1000.0 * terminated_ms / RAYS);
+    snprintf(what, sizeof(what), "early termination within its transmittance (max difference %.3f)",
+        (double)termination_difference);
+    ok = report(what, termination_difference <= MIN_TRANSMITTANCE + 1e-4f) && ok;
+
+    // A step spans a pixel 1.8 units out in a 60-degree view marched at 540 lines, half of 1080; the eyes are 2 to 4
+    // units from what's in the box
+    march.detail_distance = march.step * 540.f / (2.f * tanf(0.5235988f));
+    const double adaptive_ms = march_all(&volume, rays, &march, adaptive, &adaptive_stats);
+    double mean = 0.0;
+    for (size_t i = 0; i < adaptive.size(); ++i)
+        mean += fabs(adaptive[i] - terminated[i]);
+    printf("  adaptive steps past %.2f units: %.1f samples a ray (%.0f%% of uniform), %.2f us, mean difference "
+        "%.2g\n", (double)march.detail_distance, (double)adaptive_stats.samples / RAYS,
+        100.0 * adaptive_stats.samples / terminated_stats.samples, 1000.0 * adaptive_ms / RAYS,
+        mean / adaptive.size());
+    ok = report("adaptive steps take fewer samples", adaptive_stats.samples < terminated_stats.samples) && ok;
+
+    // Streaming into a quarter of the occupied bricks' slots, from one side and then the other
+    VolumeStreaming streaming;
+    const uint32_t capacity = volume.occupied / 4 > 0 ? volume.occupied / 4 : 1;
+    if (!volume_streaming_init(&streaming, &volume, capacity))
+    {
+        fprintf(stderr, "volume_bench: out of memory for streaming\n");
+        return 1;
+    }
+    std::vector<VolumeLoad> loads(MAX_LOADS);
+    const vec3 eyes[2] = { { 3.f, 0.2f, 0.1f }, { -3.f, -0.3f, 0.2f } };
+    for (int e = 0; e < 2; ++e)
+    {
+        int frames = 0;
+        t0 = now_ms();
+        while (volume_streaming_plan(&streaming, &volume, eyes[e], MAX_LOADS, loads.data()) > 0)
+            ++frames;
+        const double plan_ms = now_ms() - t0;
+        printf("  eye %d: %d frames of up to %d loads to settle, %.3f ms a plan; %llu loads, %llu evictions so far\n",
+            e, frames, MAX_LOADS, plan_ms / (frames + 1), streaming.loads, streaming.evictions);
+        snprintf(what, sizeof(what), "eye %d: the %u nearest occupied bricks resident", e, capacity);
+        ok = report(what, check_resident(&streaming, &volume, eyes[e])) && ok;
+    }
+    ok = report("the second eye evicted the first's far side", streaming.evictions > 0) && ok;
+    t0 = now_ms();
+    for (int i = 0; i < 1000; ++i)
+        volume_streaming_plan(&streaming, &volume, eyes[1], MAX_LOADS, loads.data());
+    printf("  a settled plan: %.5f ms\n", (now_ms() - t0) / 1000.0);
+
+    volume_streaming_destroy(&streaming);
+    volume_destroy(&volume);
+    printf("%s\n", ok ? "volume_bench: ok" : "volume_bench: FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// Wall sync check (src/core/wall_sync.h): a leader and two followers on loopback, each in a thread of its own as
+// each would be a process. Every follower gets every frame's state, in order; no node leaves a barrier before the
+// last one has reached it; a follower that quits is dropped while the others carry on; and the followers' runs end
+// once the leader's does. Then times a barrier's round trip.
+//
+// Usage: wall_sync_bench [frames]
+
+#include "core/wall_sync.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#define NODES 3
+#define PORT 47811
+#define MAX_FRAMES 4096
+
+typedef struct FrameState
+{
+    uint32_t index;
+    float value;
+} FrameState;
+
+typedef struct NodeRun
+{
+    int node;
+    int nodes;
+    int frames;             // the leader's: how many it runs. A follower's: after how many it quits (0: never)
+    int port;
+    bool jitter;            // sleeps a little before each barrier
+    bool connected;
+    bool in_order;          // every frame's state, as the leader sent it
+    int received;           // frames a follower got before its run ended
+    double arrived[MAX_FRAMES];    // at the barrier
+    double released[MAX_FRAMES];
+    WallSync sync;
+} NodeRun;
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool report(const char* what, bool ok)
+{
+    printf("  %-42s %s\n", what, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void run_node(NodeRun* run)
+{
+    run->connected = wall_sync_init(&run->sync, run->node, run->nodes, "127.0.0.1", run->port);
+    run->in_order = true;
+    run->received = 0;
+    unsigned int random = 2654435761u * (run->node + 1);
+    for (int f = 0; run->connected && f < MAX_FRAMES; ++f)
+    {
+        if (run->node == 0 && f == run->frames)
+            break;
+        if (run->node > 0 && run->frames && f == run->frames)
+            break;      // quits
+        FrameState state = { (uint32_t)f, f * 0.5f };
+        if (run->node > 0)
+            state.index = 0xFFFFFFFFu;
+        if (!wall_sync_frame(&run->sync, &state, sizeof(state)))
+            break;
+        run->in_order = run->in_order && state.index == (uint32_t)f && state.value == f * 0.5f;
+        run->received = f + 1;
+        random = random * 1664525u + 1013904223u;
+        if (run->jitter)
+            std::this_thread::sleep_for(std::chrono::microseconds(random >> 22));     // up to 1 ms
+        run->arrived[f] = now_ms();
+        if (!wall_sync_barrier(&run->sync))
+            break;
+        run->released[f] = now_ms();
+    }
+    wall_sync_destroy(&run->sync);
+}
+
+int main(int argc, char** argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 200;
+    frames = frames < 4 ? 4 : frames > MAX_FRAMES ? MAX_FRAMES : frames;
+    const int quits = frames * 3 / 4;   // node 2 leaves then
+
+    // Followers first: they retry until the leader listens
+    static NodeRun runs[NODES];
+    for (int n = 0; n < NODES; ++n)
+    {
+        runs[n].node = n;
+        runs[n].nodes = NODES;
+        runs[n].frames = n == 0 ? frames : n == 2 ? quits : 0;
+        runs[n].port = PORT;
+        runs[n].jitter = true;
+    }
+    std::thread followers[NODES - 1];
+    for (int n = 1; n < NODES; ++n)
+        followers[n - 1] = std::thread(run_node, &runs[n]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    run_node(&runs[0]);
+    for (std::thread& t : followers)
+        t.join();
+
+    bool ok = report("every node joined the wall", runs[0].connected && runs[1].connected && runs[2].connected);
+    ok = report("followers get every frame in order", runs[1].in_order && runs[2].in_order
+        && runs[1].received == frames && runs[2].received == quits) && ok;
+
+    // A barrier's release comes after the last of its nodes arrived: all three while node 2 is there, then two
+    bool held = ok;
+    double spread = 0.0;
+    for (int f = 0; f < frames && held; ++f)
+    {
+        const int nodes = f < quits ? NODES : NODES - 1;
+        double last_arrival = 0.0, first_release = 1e300, last_release = 0.0;
+        for (int n = 0; n < nodes; ++n)
+        {
+            last_arrival = runs[n].arrived[f] > last_arrival ? runs[n].arrived[f] : last_arrival;
+            first_release = runs[n].released[f] < first_release ? runs[n].released[f] : first_release;
+            last_release = runs[n].released[f] > last_release ? runs[n].released[f] : last_release;
+        }
+        held = first_release >= last_arrival;
+        spread += last_release - first_release;
+    }
+    printf("  releases %.3f ms apart on average\n", spread / frames);
+    ok = report("no node leaves a barrier early", held) && ok;
+    ok = report("a follower that quits is dropped", runs[0].sync.barriers == (unsigned int)frames) && ok;
+    ok = report("followers stop when the leader does", runs[1].received == frames) && ok;
+
+    // The round trip: two nodes, no jitter
+    static NodeRun pair[2];
+    const int barriers = MAX_FRAMES;
+    for (int n = 0; n < 2; ++n)
+    {
+        pair[n].node = n;
+        pair[n].nodes = 2;
+        pair[n].frames = n == 0 ? barriers : 0;
+        pair[n].port = PORT + 1;
+        pair[n].jitter = false;
+    }
+    std::thread follower(run_node, &pair[1]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    const double t = now_ms();
+    run_node(&pair[0]);
+    const double total = now_ms() - t;
+    follower.join();
+    printf("  barrier round trip on loopback: %.1f us a frame\n", 1000.0 * total / barriers);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
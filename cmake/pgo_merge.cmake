@@ -0,0 +1,14 @@
+# Merges clang's raw profiles from a PGO training run into the default.profdata that
+# OPENGLTEST_PGO=USE reads. Run as: cmake -DPROFDATA=<llvm-profdata> -DDIR=<pgo dir> -P pgo_merge.cmake
+
+file(GLOB raw_profiles "${DIR}/*.profraw")
+if(NOT raw_profiles)
+    message(FATAL_ERROR "pgo_merge: no .profraw files in ${DIR}; did the training run execute?")
+endif()
+execute_process(COMMAND "${PROFDATA}" merge -o "${DIR}/default.profdata" ${raw_profiles}
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "pgo_merge: llvm-profdata failed (${result})")
+endif()
+list(LENGTH raw_profiles count)
+message(STATUS "pgo_merge: ${count} raw profiles -> ${DIR}/default.profdata")
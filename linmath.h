@@ -12,6 +12,166 @@
 #define LINMATH_H_FUNC static inline
 #endif
 
+#if defined(_MSC_VER) || defined(__GNUC__) || defined(__clang__)
+#define LINMATH_H_RESTRICT __restrict
+#else
+#define LINMATH_H_RESTRICT
+#endif
+
+/* SIMD code paths for the mat4x4 hot functions. Picked at compile time from
+ * the target flags unless LINMATH_H_SIMD is set explicitly; define
+ * LINMATH_NO_SIMD to force the scalar code. Without FMA the SIMD paths do the
+ * same operations in the same order as the scalar loops, so results match bit
+ * for bit (the sign of an exact zero result may differ). With FMA
+ * (LINMATH_H_SIMD_FMA, disable with LINMATH_NO_FMA) each multiply-add rounds
+ * once, so results can differ from scalar by a few ulp of the largest
+ * product term (4 * FLT_EPSILON * sum |a[k][r] * b[c][k]| on mat4x4_mul). The
+ * bit-for-bit guarantee also assumes the compiler does not contract the
+ * scalar code into FMAs on its own (GCC/Clang: -ffp-contract=off). */
+
+/* LINMATH_DETERMINISTIC: results that depend only on the inputs, not on the
+ * compiler, its flags or the C library, for nodes and replays that must
+ * agree bit for bit. It turns FMA off (LINMATH_NO_FMA) and contraction off
+ * where a pragma can (MSVC, Clang; GCC needs -ffp-contract=off, which
+ * OPENGLTEST_DETERMINISTIC_MATH passes), refuses -ffast-math and x87 float
+ * evaluation, and replaces libm's sinf/cosf/tanf/acos, whose last bits differ
+ * between C libraries, with the portable linmath_sinf & co. below. Every
+ * operation is then IEEE float or double arithmetic in a fixed order, sqrtf
+ * included, so any conforming build gives the same bits. SIMD and scalar
+ * builds agree too, up to the sign of exact zeros (see above): the SSE paths
+ * that order their operations unlike the scalar code (mat3x4_invert,
+ * trs_mul, trs_invert, trs_lerp) give way to it. */
+#ifdef LINMATH_DETERMINISTIC
+#include <float.h>
+#ifndef LINMATH_NO_FMA
+#define LINMATH_NO_FMA
+#endif
+#if defined(__FAST_MATH__)
+#error "LINMATH_DETERMINISTIC: -ffast-math reorders float arithmetic"
+#endif
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+#error "LINMATH_DETERMINISTIC: float arithmetic must be evaluated in float (SSE2, not x87)"
+#endif
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+#endif
+
+#define LINMATH_H_SIMD_NONE 0
+#define LINMATH_H_SIMD_SSE2 1
+#define LINMATH_H_SIMD_AVX  2
+#define LINMATH_H_SIMD_NEON 3
+
+#ifndef LINMATH_H_SIMD
+#if defined(LINMATH_NO_SIMD)
+#define LINMATH_H_SIMD LINMATH_H_SIMD_NONE
+#elif defined(__AVX__)
+#define LINMATH_H_SIMD LINMATH_H_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LINMATH_H_SIMD LINMATH_H_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define LINMATH_H_SIMD LINMATH_H_SIMD_NEON
+#else
+#define LINMATH_H_SIMD LINMATH_H_SIMD_NONE
+#endif
+#endif
+
+#if !defined(LINMATH_H_SIMD_FMA) && !defined(LINMATH_NO_FMA)
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_AVX && (defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#define LINMATH_H_SIMD_FMA
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON && (defined(__aarch64__) || defined(_M_ARM64))
+#define LINMATH_H_SIMD_FMA
+#endif
+#endif
+
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+#include <immintrin.h>
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2
+#include <emmintrin.h>
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+#if defined(LINMATH_H_SIMD_FMA)
+#define LINMATH_H_MADD_PS(a, b, c) _mm_fmadd_ps(a, b, c)
+#else
+#define LINMATH_H_MADD_PS(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+#endif
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+#if defined(LINMATH_H_SIMD_FMA)
+#define LINMATH_H_MADD_PS(a, b, c) vfmaq_f32(c, a, b)
+#else
+#define LINMATH_H_MADD_PS(a, b, c) vaddq_f32(vmulq_f32(a, b), c)
+#endif
+#endif
+
+#ifdef LINMATH_DETERMINISTIC
+/* sin and cos from + - * alone: x reduced by the nearest multiple of pi/2 in
+ * double (pi/2 in two parts, fdlibm's, the first exact times any multiple
+ * up to 2^20) and the Cephes minimax polynomials on [-pi/4, pi/4]. The
+ * error is at most 1.2e-7 for |x| <= 1e6 (libm: 6e-8); beyond that the
+ * reduction loses bits, and past 2^62 it is undefined. */
+#define LINMATH_DET_2_OVER_PI 0.63661977236758134308
+#define LINMATH_DET_PIO2_1 1.57079632673412561417e+00
+#define LINMATH_DET_PIO2_1T 6.07710050650619224932e-11
+LINMATH_H_FUNC void linmath_sincosf(float x, float* s, float* c)
+{
+	double const k = (double)x * LINMATH_DET_2_OVER_PI;
+	long long const q = (long long)(k < 0. ? k - .5 : k + .5);
+	double const j = (double)q;
+	float const y = (float)(((double)x - j * LINMATH_DET_PIO2_1) - j * LINMATH_DET_PIO2_1T);
+	float const y2 = y * y;
+	float const sy = y + y * y2 * (-1.6666654611e-1f + y2 * (8.3321608736e-3f + y2 * -1.9515295891e-4f));
+	float const cy = 1.f - .5f * y2 + y2 * y2 * (4.166664568298827e-2f + y2 * (-1.388731625493765e-3f
+		+ y2 * 2.443315711809948e-5f));
+	switch (q & 3) {
+	case 0: *s = sy; *c = cy; break;
+	case 1: *s = cy; *c = -sy; break;
+	case 2: *s = -sy; *c = -cy; break;
+	default: *s = -cy; *c = sy; break;
+	}
+}
+LINMATH_H_FUNC float linmath_sinf(float x)
+{
+	float s, c;
+	linmath_sincosf(x, &s, &c);
+	return s;
+}
+LINMATH_H_FUNC float linmath_cosf(float x)
+{
+	float s, c;
+	linmath_sincosf(x, &s, &c);
+	return c;
+}
+LINMATH_H_FUNC float linmath_tanf(float x)
+{
+	float s, c;
+	linmath_sincosf(x, &s, &c);
+	return s / c;
+}
+/* Cephes asinf's polynomial on [-0.5, 0.5], and acos x = 2 asin sqrt((1 - x) / 2)
+ * outside it; about 1e-7 relative error. Clamps x to [-1, 1]. */
+LINMATH_H_FUNC float linmath_acosf(float x)
+{
+	float const a = x < 0.f ? -x : x;
+	float const z = a > .5f ? .5f * (1.f - (a < 1.f ? a : 1.f)) : a * a;
+	float const t = a > .5f ? sqrtf(z) : a;
+	float const p = ((((4.2163199048e-2f * z + 2.4181311049e-2f) * z + 4.5470025998e-2f) * z
+		+ 7.4953002686e-2f) * z + 1.6666752422e-1f) * z * t + t;
+	if (a > .5f)
+		return x < 0.f ? 3.14159265358979f - 2.f * p : 2.f * p;
+	return 1.57079632679490f - (x < 0.f ? -p : p);
+}
+#else
+#define linmath_sinf sinf
+#define linmath_cosf cosf
+#define linmath_tanf tanf
+#define linmath_acosf acos
+#endif
+
 #define LINMATH_H_DEFINE_VEC(n) \
 typedef float vec##n[n]; \
 LINMATH_H_FUNC void vec##n##_add(vec##n r, vec##n const a, vec##n const b) \
@@ -131,12 +291,31 @@ LINMATH_H_FUNC void mat4x4_col(vec4 r, mat4x4 const M, int i)
 }
 LINMATH_H_FUNC void mat4x4_transpose(mat4x4 M, mat4x4 const N)
 {
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	/* The SIMD paths load all of N before storing, so M and N may alias. */
+	__m128 c0 = _mm_loadu_ps(N[0]);
+	__m128 c1 = _mm_loadu_ps(N[1]);
+	__m128 c2 = _mm_loadu_ps(N[2]);
+	__m128 c3 = _mm_loadu_ps(N[3]);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	_mm_storeu_ps(M[0], c0);
+	_mm_storeu_ps(M[1], c1);
+	_mm_storeu_ps(M[2], c2);
+	_mm_storeu_ps(M[3], c3);
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	float32x4x4_t t = vld4q_f32(N[0]);
+	vst1q_f32(M[0], t.val[0]);
+	vst1q_f32(M[1], t.val[1]);
+	vst1q_f32(M[2], t.val[2]);
+	vst1q_f32(M[3], t.val[3]);
+#else
 	// Note: if M and N are the same, the user has to
 	// explicitly make a copy of M and set it to N.
 	int i, j;
 	for (j = 0; j < 4; ++j)
 		for (i = 0; i < 4; ++i)
 			M[i][j] = N[j][i];
+#endif
 }
 LINMATH_H_FUNC void mat4x4_add(mat4x4 M, mat4x4 const a, mat4x4 const b)
 {
@@ -165,6 +344,66 @@ LINMATH_H_FUNC void mat4x4_scale_aniso(mat4x4 M, mat4x4 const a, float x, float
 }
 LINMATH_H_FUNC void mat4x4_mul(mat4x4 M, mat4x4 const a, mat4x4 const b)
 {
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	/* Two result columns per 256-bit register; each lane pair broadcasts
+	 * b[c][k] from its own column. */
+	__m256 const a0 = _mm256_broadcast_ps((__m128 const*)a[0]);
+	__m256 const a1 = _mm256_broadcast_ps((__m128 const*)a[1]);
+	__m256 const a2 = _mm256_broadcast_ps((__m128 const*)a[2]);
+	__m256 const a3 = _mm256_broadcast_ps((__m128 const*)a[3]);
+	__m256 const b01 = _mm256_loadu_ps(b[0]);
+	__m256 const b23 = _mm256_loadu_ps(b[2]);
+	__m256 r01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+	__m256 r23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, 0x00));
+#if defined(LINMATH_H_SIMD_FMA)
+	r01 = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b01, b01, 0x55), r01);
+	r23 = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b23, b23, 0x55), r23);
+	r01 = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b01, b01, 0xAA), r01);
+	r23 = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b23, b23, 0xAA), r23);
+	r01 = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b01, b01, 0xFF), r01);
+	r23 = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b23, b23, 0xFF), r23);
+#else
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_shuffle_ps(b01, b01, 0x55)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_shuffle_ps(b23, b23, 0x55)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_shuffle_ps(b01, b01, 0xAA)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_shuffle_ps(b23, b23, 0xAA)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_shuffle_ps(b01, b01, 0xFF)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_shuffle_ps(b23, b23, 0xFF)));
+#endif
+	_mm256_storeu_ps(M[0], r01);
+	_mm256_storeu_ps(M[2], r23);
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2
+	__m128 const a0 = _mm_loadu_ps(a[0]);
+	__m128 const a1 = _mm_loadu_ps(a[1]);
+	__m128 const a2 = _mm_loadu_ps(a[2]);
+	__m128 const a3 = _mm_loadu_ps(a[3]);
+	__m128 r[4];
+	int c;
+	for (c = 0; c < 4; ++c) {
+		__m128 const bc = _mm_loadu_ps(b[c]);
+		r[c] = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, 0x00));
+		r[c] = LINMATH_H_MADD_PS(a1, _mm_shuffle_ps(bc, bc, 0x55), r[c]);
+		r[c] = LINMATH_H_MADD_PS(a2, _mm_shuffle_ps(bc, bc, 0xAA), r[c]);
+		r[c] = LINMATH_H_MADD_PS(a3, _mm_shuffle_ps(bc, bc, 0xFF), r[c]);
+	}
+	for (c = 0; c < 4; ++c)
+		_mm_storeu_ps(M[c], r[c]);
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	float32x4_t const a0 = vld1q_f32(a[0]);
+	float32x4_t const a1 = vld1q_f32(a[1]);
+	float32x4_t const a2 = vld1q_f32(a[2]);
+	float32x4_t const a3 = vld1q_f32(a[3]);
+	float32x4_t r[4];
+	int c;
+	for (c = 0; c < 4; ++c) {
+		r[c] = vmulq_n_f32(a0, b[c][0]);
+		r[c] = LINMATH_H_MADD_PS(a1, vdupq_n_f32(b[c][1]), r[c]);
+		r[c] = LINMATH_H_MADD_PS(a2, vdupq_n_f32(b[c][2]), r[c]);
+		r[c] = LINMATH_H_MADD_PS(a3, vdupq_n_f32(b[c][3]), r[c]);
+	}
+	for (c = 0; c < 4; ++c)
+		vst1q_f32(M[c], r[c]);
+#else
 	mat4x4 temp;
 	int k, r, c;
 	for (c = 0; c < 4; ++c) for (r = 0; r < 4; ++r) {
@@ -173,15 +412,48 @@ LINMATH_H_FUNC void mat4x4_mul(mat4x4 M, mat4x4 const a, mat4x4 const b)
 			temp[c][r] += a[k][r] * b[c][k];
 	}
 	mat4x4_dup(M, temp);
+#endif
+}
+/* mat4x4_mul for an M that aliases neither input: the scalar code writes M
+ * directly instead of going through a temporary (the SIMD paths keep the
+ * product in registers either way). Same results as mat4x4_mul. */
+LINMATH_H_FUNC void mat4x4_mul_restrict(vec4* LINMATH_H_RESTRICT M, vec4 const* LINMATH_H_RESTRICT a,
+	vec4 const* LINMATH_H_RESTRICT b)
+{
+#if LINMATH_H_SIMD != LINMATH_H_SIMD_NONE
+	mat4x4_mul(M, a, b);
+#else
+	int k, r, c;
+	for (c = 0; c < 4; ++c) for (r = 0; r < 4; ++r) {
+		M[c][r] = 0.f;
+		for (k = 0; k < 4; ++k)
+			M[c][r] += a[k][r] * b[c][k];
+	}
+#endif
 }
 LINMATH_H_FUNC void mat4x4_mul_vec4(vec4 r, mat4x4 const M, vec4 const v)
 {
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const vv = _mm_loadu_ps(v);
+	__m128 x = _mm_mul_ps(_mm_loadu_ps(M[0]), _mm_shuffle_ps(vv, vv, 0x00));
+	x = LINMATH_H_MADD_PS(_mm_loadu_ps(M[1]), _mm_shuffle_ps(vv, vv, 0x55), x);
+	x = LINMATH_H_MADD_PS(_mm_loadu_ps(M[2]), _mm_shuffle_ps(vv, vv, 0xAA), x);
+	x = LINMATH_H_MADD_PS(_mm_loadu_ps(M[3]), _mm_shuffle_ps(vv, vv, 0xFF), x);
+	_mm_storeu_ps(r, x);
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	float32x4_t x = vmulq_n_f32(vld1q_f32(M[0]), v[0]);
+	x = LINMATH_H_MADD_PS(vld1q_f32(M[1]), vdupq_n_f32(v[1]), x);
+	x = LINMATH_H_MADD_PS(vld1q_f32(M[2]), vdupq_n_f32(v[2]), x);
+	x = LINMATH_H_MADD_PS(vld1q_f32(M[3]), vdupq_n_f32(v[3]), x);
+	vst1q_f32(r, x);
+#else
 	int i, j;
 	for (j = 0; j < 4; ++j) {
 		r[j] = 0.f;
 		for (i = 0; i < 4; ++i)
 			r[j] += M[i][j] * v[i];
 	}
+#endif
 }
 LINMATH_H_FUNC void mat4x4_translate(mat4x4 T, float x, float y, float z)
 {
@@ -208,8 +480,8 @@ LINMATH_H_FUNC void mat4x4_from_vec3_mul_outer(mat4x4 M, vec3 const a, vec3 cons
 }
 LINMATH_H_FUNC void mat4x4_rotate(mat4x4 R, mat4x4 const M, float x, float y, float z, float angle)
 {
-	float s = sinf(angle);
-	float c = cosf(angle);
+	float s = linmath_sinf(angle);
+	float c = linmath_cosf(angle);
 	vec3 u = { x, y, z };
 
 	if (vec3_len(u) > 1e-4) {
@@ -243,8 +515,8 @@ LINMATH_H_FUNC void mat4x4_rotate(mat4x4 R, mat4x4 const M, float x, float y, fl
 }
 LINMATH_H_FUNC void mat4x4_rotate_X(mat4x4 Q, mat4x4 const M, float angle)
 {
-	float s = sinf(angle);
-	float c = cosf(angle);
+	float s = linmath_sinf(angle);
+	float c = linmath_cosf(angle);
 	mat4x4 R = {
 		{1.f, 0.f, 0.f, 0.f},
 		{0.f,   c,   s, 0.f},
@@ -255,8 +527,8 @@ LINMATH_H_FUNC void mat4x4_rotate_X(mat4x4 Q, mat4x4 const M, float angle)
 }
 LINMATH_H_FUNC void mat4x4_rotate_Y(mat4x4 Q, mat4x4 const M, float angle)
 {
-	float s = sinf(angle);
-	float c = cosf(angle);
+	float s = linmath_sinf(angle);
+	float c = linmath_cosf(angle);
 	mat4x4 R = {
 		{   c, 0.f,  -s, 0.f},
 		{ 0.f, 1.f, 0.f, 0.f},
@@ -267,8 +539,8 @@ LINMATH_H_FUNC void mat4x4_rotate_Y(mat4x4 Q, mat4x4 const M, float angle)
 }
 LINMATH_H_FUNC void mat4x4_rotate_Z(mat4x4 Q, mat4x4 const M, float angle)
 {
-	float s = sinf(angle);
-	float c = cosf(angle);
+	float s = linmath_sinf(angle);
+	float c = linmath_cosf(angle);
 	mat4x4 R = {
 		{   c,   s, 0.f, 0.f},
 		{  -s,   c, 0.f, 0.f},
@@ -298,6 +570,41 @@ LINMATH_H_FUNC void mat4x4_invert(mat4x4 T, mat4x4 const M)
 	/* Assumes it is invertible */
 	float idet = 1.0f / (s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0]);
 
+#if LINMATH_H_SIMD != LINMATH_H_SIMD_NONE
+	/* Each result row is (x*p - y*q + z*r) over the lane vectors
+	 * V_k = (M[1][k], M[0][k], M[3][k], M[2][k]) and W_j = (c[j], c[j], s[j], s[j]),
+	 * with alternating lane signs. Negating the whole sum is exact, so this
+	 * matches the scalar expressions below bit for bit. */
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+#define LINMATH_H_V(k) float const v##k[4] = { M[1][k], M[0][k], M[3][k], M[2][k] }; \
+	float32x4_t const V##k = vld1q_f32(v##k)
+#define LINMATH_H_W(j) float const w##j[4] = { c[j], c[j], s[j], s[j] }; \
+	float32x4_t const W##j = vld1q_f32(w##j)
+#define LINMATH_H_ROW(i, x, p, y, q, z, r, sg) \
+	vst1q_f32(T[i], vmulq_n_f32(vmulq_f32(vaddq_f32(vsubq_f32(vmulq_f32(V##x, W##p), vmulq_f32(V##y, W##q)), vmulq_f32(V##z, W##r)), sg), idet))
+	float const sg[8] = { 1.f, -1.f, 1.f, -1.f, -1.f, 1.f, -1.f, 1.f };
+	float32x4_t const sgA = vld1q_f32(sg);
+	float32x4_t const sgB = vld1q_f32(sg + 4);
+#else
+#define LINMATH_H_V(k) __m128 const V##k = _mm_setr_ps(M[1][k], M[0][k], M[3][k], M[2][k])
+#define LINMATH_H_W(j) __m128 const W##j = _mm_setr_ps(c[j], c[j], s[j], s[j])
+#define LINMATH_H_ROW(i, x, p, y, q, z, r, sg) \
+	_mm_storeu_ps(T[i], _mm_mul_ps(_mm_xor_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(V##x, W##p), _mm_mul_ps(V##y, W##q)), _mm_mul_ps(V##z, W##r)), sg), videt))
+	__m128 const sgA = _mm_setr_ps(0.f, -0.f, 0.f, -0.f);
+	__m128 const sgB = _mm_setr_ps(-0.f, 0.f, -0.f, 0.f);
+	__m128 const videt = _mm_set1_ps(idet);
+#endif
+	LINMATH_H_V(0); LINMATH_H_V(1); LINMATH_H_V(2); LINMATH_H_V(3);
+	LINMATH_H_W(0); LINMATH_H_W(1); LINMATH_H_W(2);
+	LINMATH_H_W(3); LINMATH_H_W(4); LINMATH_H_W(5);
+	LINMATH_H_ROW(0, 1, 5, 2, 4, 3, 3, sgA);
+	LINMATH_H_ROW(1, 0, 5, 2, 2, 3, 1, sgB);
+	LINMATH_H_ROW(2, 0, 4, 1, 2, 3, 0, sgA);
+	LINMATH_H_ROW(3, 0, 3, 1, 1, 2, 0, sgB);
+#undef LINMATH_H_V
+#undef LINMATH_H_W
+#undef LINMATH_H_ROW
+#else
 	T[0][0] = (M[1][1] * c[5] - M[1][2] * c[4] + M[1][3] * c[3]) * idet;
 	T[0][1] = (-M[0][1] * c[5] + M[0][2] * c[4] - M[0][3] * c[3]) * idet;
 	T[0][2] = (M[3][1] * s[5] - M[3][2] * s[4] + M[3][3] * s[3]) * idet;
@@ -317,6 +624,7 @@ LINMATH_H_FUNC void mat4x4_invert(mat4x4 T, mat4x4 const M)
 	T[3][1] = (M[0][0] * c[3] - M[0][1] * c[1] + M[0][2] * c[0]) * idet;
 	T[3][2] = (-M[3][0] * s[3] + M[3][1] * s[1] - M[3][2] * s[0]) * idet;
 	T[3][3] = (M[2][0] * s[3] - M[2][1] * s[1] + M[2][2] * s[0]) * idet;
+#endif
 }
 LINMATH_H_FUNC void mat4x4_orthonormalize(mat4x4 R, mat4x4 const M)
 {
@@ -377,7 +685,7 @@ LINMATH_H_FUNC void mat4x4_perspective(mat4x4 m, float y_fov, float aspect, floa
 {
 	/* NOTE: Degrees are an unhandy unit to work with.
 	 * linmath.h uses radians for everything! */
-	float const a = 1.f / tanf(y_fov / 2.f);
+	float const a = 1.f / linmath_tanf(y_fov / 2.f);
 
 	m[0][0] = a / aspect;
 	m[0][1] = 0.f;
@@ -399,6 +707,106 @@ LINMATH_H_FUNC void mat4x4_perspective(mat4x4 m, float y_fov, float aspect, floa
 	m[3][2] = -((2.f * f * n) / (f - n));
 	m[3][3] = 0.f;
 }
+/* Variants for a [0, 1] clip depth range (glClipControl(GL_LOWER_LEFT,
+ * GL_ZERO_TO_ONE)), standard ("_zo": near 0, far 1) or reversed (near 1, far 0).
+ * Reversed Z over a floating point depth buffer puts the float exponent's
+ * precision where the perspective divide spends it: test with GL_GREATER (or
+ * GEQUAL) and clear depth to 0. Only the depth row differs from the [-1, 1]
+ * matrices above, so each patches its base's two entries. */
+LINMATH_H_FUNC void mat4x4_frustum_zo(mat4x4 M, float l, float r, float b, float t, float n, float f)
+{
+	mat4x4_frustum(M, l, r, b, t, n, f);
+	M[2][2] = f / (n - f);
+	M[3][2] = n * f / (n - f);
+}
+LINMATH_H_FUNC void mat4x4_frustum_reversed(mat4x4 M, float l, float r, float b, float t, float n, float f)
+{
+	mat4x4_frustum(M, l, r, b, t, n, f);
+	M[2][2] = n / (f - n);
+	M[3][2] = n * f / (f - n);
+}
+LINMATH_H_FUNC void mat4x4_ortho_zo(mat4x4 M, float l, float r, float b, float t, float n, float f)
+{
+	mat4x4_ortho(M, l, r, b, t, n, f);
+	M[2][2] = -1.f / (f - n);
+	M[3][2] = -n / (f - n);
+}
+LINMATH_H_FUNC void mat4x4_ortho_reversed(mat4x4 M, float l, float r, float b, float t, float n, float f)
+{
+	mat4x4_ortho(M, l, r, b, t, n, f);
+	M[2][2] = 1.f / (f - n);
+	M[3][2] = f / (f - n);
+}
+LINMATH_H_FUNC void mat4x4_perspective_zo(mat4x4 m, float y_fov, float aspect, float n, float f)
+{
+	mat4x4_perspective(m, y_fov, aspect, n, f);
+	m[2][2] = f / (n - f);
+	m[3][2] = n * f / (n - f);
+}
+LINMATH_H_FUNC void mat4x4_perspective_reversed(mat4x4 m, float y_fov, float aspect, float n, float f)
+{
+	mat4x4_perspective(m, y_fov, aspect, n, f);
+	m[2][2] = n / (f - n);
+	m[3][2] = n * f / (f - n);
+}
+/* The far plane at infinity: the limits of mat4x4_perspective and
+ * mat4x4_perspective_reversed as f grows. In [-1, 1], depth approaches 1 but
+ * rounds to it for distant points, so it wants a float depth buffer or depth
+ * clamping; reversed, depth is n / -z and never reaches 0. */
+LINMATH_H_FUNC void mat4x4_perspective_infinite(mat4x4 m, float y_fov, float aspect, float n)
+{
+	mat4x4_perspective(m, y_fov, aspect, n, 2.f * n);
+	m[2][2] = -1.f;
+	m[3][2] = -2.f * n;
+}
+LINMATH_H_FUNC void mat4x4_perspective_reversed_infinite(mat4x4 m, float y_fov, float aspect, float n)
+{
+	mat4x4_perspective(m, y_fov, aspect, n, 2.f * n);
+	m[2][2] = 0.f;
+	m[3][2] = n;
+}
+/* Closed-form inverses, for unprojecting without mat4x4_invert's cofactors.
+ * mat4x4_frustum_invert takes any of the frustum and perspective matrices
+ * (every depth convention, and an infinite far plane), mat4x4_ortho_invert any
+ * of the ortho ones: they rely on the zeros those leave, not on the values. */
+LINMATH_H_FUNC void mat4x4_frustum_invert(mat4x4 T, mat4x4 const M)
+{
+	/* x' = X x + A z, y' = Y y + B z, z' = C z + D, w' = -z */
+	float const X = M[0][0], Y = M[1][1], A = M[2][0], B = M[2][1], C = M[2][2], D = M[3][2];
+
+	T[0][0] = 1.f / X;
+	T[0][1] = T[0][2] = T[0][3] = 0.f;
+
+	T[1][1] = 1.f / Y;
+	T[1][0] = T[1][2] = T[1][3] = 0.f;
+
+	T[2][0] = T[2][1] = T[2][2] = 0.f;
+	T[2][3] = 1.f / D;
+
+	T[3][0] = A / X;
+	T[3][1] = B / Y;
+	T[3][2] = -1.f;
+	T[3][3] = C / D;
+}
+LINMATH_H_FUNC void mat4x4_ortho_invert(mat4x4 T, mat4x4 const M)
+{
+	float const X = M[0][0], Y = M[1][1], Z = M[2][2];
+	float const tx = M[3][0], ty = M[3][1], tz = M[3][2];
+
+	T[0][0] = 1.f / X;
+	T[0][1] = T[0][2] = T[0][3] = 0.f;
+
+	T[1][1] = 1.f / Y;
+	T[1][0] = T[1][2] = T[1][3] = 0.f;
+
+	T[2][2] = 1.f / Z;
+	T[2][0] = T[2][1] = T[2][3] = 0.f;
+
+	T[3][0] = -tx / X;
+	T[3][1] = -ty / Y;
+	T[3][2] = -tz / Z;
+	T[3][3] = 1.f;
+}
 LINMATH_H_FUNC void mat4x4_look_at(mat4x4 m, vec3 const eye, vec3 const center, vec3 const up)
 {
 	/* Adapted from Android's OpenGL Matrix.java.                        */
@@ -476,8 +884,8 @@ LINMATH_H_FUNC void quat_conj(quat r, quat const q)
 LINMATH_H_FUNC void quat_rotate(quat r, float angle, vec3 const axis) {
 	vec3 axis_norm;
 	vec3_norm(axis_norm, axis);
-	float s = sinf(angle / 2);
-	float c = cosf(angle / 2);
+	float s = linmath_sinf(angle / 2);
+	float c = linmath_cosf(angle / 2);
 	vec3_scale(r, axis_norm, s);
 	r[3] = c;
 }
@@ -603,7 +1011,7 @@ LINMATH_H_FUNC void mat4x4_arcball(mat4x4 R, mat4x4 const M, vec2 const _a, vec2
 	vec3 c_;
 	vec3_mul_cross(c_, a_, b_);
 
-	float const angle = acos(vec3_mul_inner(a_, b_)) * s;
+	float const angle = linmath_acosf(vec3_mul_inner(a_, b_)) * s;
 	mat4x4_rotate(R, M, c_[0], c_[1], c_[2], angle);
 }
 #endif
\ No newline at end of file
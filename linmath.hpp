@@ -0,0 +1,592 @@
+#pragma once
+#ifndef LINMATH_HPP
+#define LINMATH_HPP
+
+#include "linmath.h"
+#include "linmath_affine.h"
+
+/* C++17 front-end for linmath.h: value types with constexpr operators, so
+ * matrices built from constants (an ortho projection, a fixed camera, a
+ * unit cube's transforms) are computed by the compiler, and the same
+ * expressions at run time go through linmath.h's SIMD paths.
+ *
+ * The types are standard-layout wrappers around the C arrays: vec<N>::v is
+ * a vecN, mat4::m a mat4x4, quat::v a quat, affine::m a mat3x4. Passing
+ * .v / .m to the C functions costs nothing, and view() reinterprets a C
+ * array in place as the wrapper (the array is the wrapper's first and only
+ * member, so the two are pointer-interconvertible).
+ *
+ * Inside a constant expression every operation runs the portable scalar
+ * code; outside one, the operations that linmath.h vectorizes (mat4 * mat4,
+ * mat4 * vec4, invert, affine * affine) call it instead, picked with
+ * __builtin_is_constant_evaluated (GCC/Clang 9+, MSVC 19.25+). Compilers
+ * without it always get the scalar code, which is still constexpr. sqrt is
+ * a Newton iteration at compile time and sqrtf at run time; functions
+ * needing sin/cos/tan are run time only.
+ *
+ * mul_add(a, b, c) is a * b + c in one pass, the fused form of the
+ * expressions that would otherwise build temporaries (point transforms,
+ * blends, integration steps). */
+
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define LINMATH_HPP_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+#if !defined(LINMATH_HPP_CONSTANT_EVALUATED) && \
+	((defined(__clang__) && __clang_major__ >= 9) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 9) || \
+	(defined(_MSC_VER) && _MSC_VER >= 1925))
+#define LINMATH_HPP_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+
+namespace linmath {
+
+template <int N>
+struct vec {
+	static_assert(N >= 2 && N <= 4, "linmath vectors have 2, 3 or 4 components");
+	float v[N];
+
+	constexpr float& operator[](int i) { return v[i]; }
+	constexpr float operator[](int i) const { return v[i]; }
+};
+
+using vec2 = vec<2>;
+using vec3 = vec<3>;
+using vec4 = vec<4>;
+
+/* Column-major like mat4x4: m[column][row] */
+struct mat4 {
+	::mat4x4 m;
+
+	constexpr ::vec4& operator[](int c) { return m[c]; }
+	constexpr ::vec4 const& operator[](int c) const { return m[c]; }
+};
+
+/* x, y, z, w like linmath's quat */
+struct quat {
+	::quat v;
+
+	constexpr float& operator[](int i) { return v[i]; }
+	constexpr float operator[](int i) const { return v[i]; }
+};
+
+/* Row-major like mat3x4: m[row] is the linear row then the translation */
+struct affine {
+	::mat3x4 m;
+
+	constexpr ::vec4& operator[](int r) { return m[r]; }
+	constexpr ::vec4 const& operator[](int r) const { return m[r]; }
+};
+
+/* In-place views of the C arrays */
+template <int N>
+inline vec<N>& view(float (&a)[N]) { return *reinterpret_cast<vec<N>*>(&a); }
+template <int N>
+inline vec<N> const& view(float const (&a)[N]) { return *reinterpret_cast<vec<N> const*>(&a); }
+inline mat4& view(::mat4x4& a) { return *reinterpret_cast<mat4*>(&a); }
+inline mat4 const& view(::mat4x4 const& a) { return *reinterpret_cast<mat4 const*>(&a); }
+inline affine& view(::mat3x4& a) { return *reinterpret_cast<affine*>(&a); }
+inline affine const& view(::mat3x4 const& a) { return *reinterpret_cast<affine const*>(&a); }
+/* quat and vec4 are the same C type, so quaternions get their own name */
+inline quat& view_quat(::quat& a) { return *reinterpret_cast<quat*>(&a); }
+inline quat const& view_quat(::quat const& a) { return *reinterpret_cast<quat const*>(&a); }
+
+/* Copies out of the C arrays, usable in constant expressions */
+template <int N>
+constexpr vec<N> from(float const (&a)[N])
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = a[i];
+	return r;
+}
+constexpr mat4 from(::mat4x4 const& a)
+{
+	mat4 r{};
+	for (int c = 0; c < 4; ++c)
+		for (int i = 0; i < 4; ++i)
+			r.m[c][i] = a[c][i];
+	return r;
+}
+
+constexpr float sqrt(float x)
+{
+#if defined(LINMATH_HPP_CONSTANT_EVALUATED)
+	if (LINMATH_HPP_CONSTANT_EVALUATED()) {
+		if (!(x > 0.f))
+			return x == 0.f ? x : NAN;
+		double r = x > 1.f ? x : 1.;    /* at or above the root, so Newton decreases monotonically */
+		for (;;) {
+			double const next = .5 * (r + x / r);
+			if (next >= r)
+				return (float)r;
+			r = next;
+		}
+	}
+#endif
+	return sqrtf(x);
+}
+
+/* --- vectors --- */
+
+template <int N>
+constexpr vec<N> operator+(vec<N> const& a, vec<N> const& b)
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = a.v[i] + b.v[i];
+	return r;
+}
+template <int N>
+constexpr vec<N> operator-(vec<N> const& a, vec<N> const& b)
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = a.v[i] - b.v[i];
+	return r;
+}
+template <int N>
+constexpr vec<N> operator-(vec<N> const& a)
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = -a.v[i];
+	return r;
+}
+template <int N>
+constexpr vec<N> operator*(vec<N> const& a, float s)
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = a.v[i] * s;
+	return r;
+}
+template <int N>
+constexpr vec<N> operator*(float s, vec<N> const& a) { return a * s; }
+/* Component-wise */
+template <int N>
+constexpr vec<N> operator*(vec<N> const& a, vec<N> const& b)
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = a.v[i] * b.v[i];
+	return r;
+}
+template <int N>
+constexpr vec<N>& operator+=(vec<N>& a, vec<N> const& b) { return a = a + b; }
+template <int N>
+constexpr vec<N>& operator-=(vec<N>& a, vec<N> const& b) { return a = a - b; }
+template <int N>
+constexpr vec<N>& operator*=(vec<N>& a, float s) { return a = a * s; }
+template <int N>
+constexpr bool operator==(vec<N> const& a, vec<N> const& b)
+{
+	for (int i = 0; i < N; ++i)
+		if (a.v[i] != b.v[i])
+			return false;
+	return true;
+}
+template <int N>
+constexpr bool operator!=(vec<N> const& a, vec<N> const& b) { return !(a == b); }
+
+/* a * b + c, component-wise */
+template <int N>
+constexpr vec<N> mul_add(vec<N> const& a, vec<N> const& b, vec<N> const& c)
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = a.v[i] * b.v[i] + c.v[i];
+	return r;
+}
+/* a * s + c */
+template <int N>
+constexpr vec<N> mul_add(vec<N> const& a, float s, vec<N> const& c)
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = a.v[i] * s + c.v[i];
+	return r;
+}
+template <int N>
+constexpr float dot(vec<N> const& a, vec<N> const& b)
+{
+	float p = 0.f;
+	for (int i = 0; i < N; ++i)
+		p += b.v[i] * a.v[i];
+	return p;
+}
+template <int N>
+constexpr float len(vec<N> const& a) { return linmath::sqrt(dot(a, a)); }
+template <int N>
+constexpr vec<N> norm(vec<N> const& a) { return a * (1.f / len(a)); }
+template <int N>
+constexpr vec<N> min(vec<N> const& a, vec<N> const& b)
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+	return r;
+}
+template <int N>
+constexpr vec<N> max(vec<N> const& a, vec<N> const& b)
+{
+	vec<N> r{};
+	for (int i = 0; i < N; ++i)
+		r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+	return r;
+}
+constexpr vec3 cross(vec3 const& a, vec3 const& b)
+{
+	return vec3{ {
+		a.v[1] * b.v[2] - a.v[2] * b.v[1],
+		a.v[2] * b.v[0] - a.v[0] * b.v[2],
+		a.v[0] * b.v[1] - a.v[1] * b.v[0] } };
+}
+/* vec4_mul_cross: the cross product of the xyz parts, w = 1 */
+constexpr vec4 cross(vec4 const& a, vec4 const& b)
+{
+	return vec4{ {
+		a.v[1] * b.v[2] - a.v[2] * b.v[1],
+		a.v[2] * b.v[0] - a.v[0] * b.v[2],
+		a.v[0] * b.v[1] - a.v[1] * b.v[0],
+		1.f } };
+}
+template <int N>
+constexpr vec<N> reflect(vec<N> const& v, vec<N> const& n)
+{
+	return mul_add(n, -2.f * dot(v, n), v);
+}
+
+/* --- 4x4 matrices --- */
+
+constexpr mat4 identity()
+{
+	mat4 r{};
+	for (int i = 0; i < 4; ++i)
+		r.m[i][i] = 1.f;
+	return r;
+}
+constexpr mat4 transpose(mat4 const& a)
+{
+	mat4 r{};
+	for (int c = 0; c < 4; ++c)
+		for (int i = 0; i < 4; ++i)
+			r.m[c][i] = a.m[i][c];
+	return r;
+}
+constexpr mat4 translate(float x, float y, float z)
+{
+	mat4 r = identity();
+	r.m[3][0] = x;
+	r.m[3][1] = y;
+	r.m[3][2] = z;
+	return r;
+}
+constexpr mat4 scale(float x, float y, float z)
+{
+	mat4 r{};
+	r.m[0][0] = x;
+	r.m[1][1] = y;
+	r.m[2][2] = z;
+	r.m[3][3] = 1.f;
+	return r;
+}
+constexpr mat4 ortho(float l, float r, float b, float t, float n, float f)
+{
+	mat4 o{};
+	o.m[0][0] = 2.f / (r - l);
+	o.m[1][1] = 2.f / (t - b);
+	o.m[2][2] = -2.f / (f - n);
+	o.m[3][0] = -(r + l) / (r - l);
+	o.m[3][1] = -(t + b) / (t - b);
+	o.m[3][2] = -(f + n) / (f - n);
+	o.m[3][3] = 1.f;
+	return o;
+}
+constexpr mat4 frustum(float l, float r, float b, float t, float n, float f)
+{
+	mat4 o{};
+	o.m[0][0] = 2.f * n / (r - l);
+	o.m[1][1] = 2.f * n / (t - b);
+	o.m[2][0] = (r + l) / (r - l);
+	o.m[2][1] = (t + b) / (t - b);
+	o.m[2][2] = -(f + n) / (f - n);
+	o.m[2][3] = -1.f;
+	o.m[3][2] = -2.f * (f * n) / (f - n);
+	return o;
+}
+inline mat4 perspective(float y_fov, float aspect, float n, float f)
+{
+	mat4 r;
+	mat4x4_perspective(r.m, y_fov, aspect, n, f);
+	return r;
+}
+inline mat4 perspective_reversed(float y_fov, float aspect, float n, float f)
+{
+	mat4 r;
+	mat4x4_perspective_reversed(r.m, y_fov, aspect, n, f);
+	return r;
+}
+inline mat4 perspective_reversed_infinite(float y_fov, float aspect, float n)
+{
+	mat4 r;
+	mat4x4_perspective_reversed_infinite(r.m, y_fov, aspect, n);
+	return r;
+}
+inline mat4 frustum_invert(mat4 const& p)
+{
+	mat4 r;
+	mat4x4_frustum_invert(r.m, p.m);
+	return r;
+}
+inline mat4 ortho_invert(mat4 const& p)
+{
+	mat4 r;
+	mat4x4_ortho_invert(r.m, p.m);
+	return r;
+}
+constexpr mat4 operator*(mat4 const& a, mat4 const& b)
+{
+	mat4 r{};
+#if defined(LINMATH_HPP_CONSTANT_EVALUATED)
+	if (!LINMATH_HPP_CONSTANT_EVALUATED()) {
+		mat4x4_mul(r.m, a.m, b.m);
+		return r;
+	}
+#endif
+	for (int c = 0; c < 4; ++c)
+		for (int i = 0; i < 4; ++i)
+			for (int k = 0; k < 4; ++k)
+				r.m[c][i] += a.m[k][i] * b.m[c][k];
+	return r;
+}
+constexpr vec4 operator*(mat4 const& a, vec4 const& v)
+{
+	vec4 r{};
+#if defined(LINMATH_HPP_CONSTANT_EVALUATED)
+	if (!LINMATH_HPP_CONSTANT_EVALUATED()) {
+		mat4x4_mul_vec4(r.v, a.m, v.v);
+		return r;
+	}
+#endif
+	for (int j = 0; j < 4; ++j)
+		for (int i = 0; i < 4; ++i)
+			r.v[j] += a.m[i][j] * v.v[i];
+	return r;
+}
+constexpr mat4& operator*=(mat4& a, mat4 const& b) { return a = a * b; }
+constexpr bool operator==(mat4 const& a, mat4 const& b)
+{
+	for (int c = 0; c < 4; ++c)
+		for (int i = 0; i < 4; ++i)
+			if (a.m[c][i] != b.m[c][i])
+				return false;
+	return true;
+}
+constexpr bool operator!=(mat4 const& a, mat4 const& b) { return !(a == b); }
+/* a * (p, 1), the fused point transform: a's translation plus its first
+ * three columns scaled by p */
+constexpr vec3 mul_point(mat4 const& a, vec3 const& p)
+{
+	vec3 r{};
+	for (int j = 0; j < 3; ++j)
+		r.v[j] = a.m[3][j] + a.m[0][j] * p.v[0] + a.m[1][j] * p.v[1] + a.m[2][j] * p.v[2];
+	return r;
+}
+/* a * b + c */
+constexpr mat4 mul_add(mat4 const& a, mat4 const& b, mat4 const& c)
+{
+	mat4 r = a * b;
+	for (int col = 0; col < 4; ++col)
+		for (int i = 0; i < 4; ++i)
+			r.m[col][i] += c.m[col][i];
+	return r;
+}
+/* The cofactor inverse of mat4x4_invert; assumes a is invertible */
+constexpr mat4 invert(mat4 const& a)
+{
+	mat4 t{};
+#if defined(LINMATH_HPP_CONSTANT_EVALUATED)
+	if (!LINMATH_HPP_CONSTANT_EVALUATED()) {
+		mat4x4_invert(t.m, a.m);
+		return t;
+	}
+#endif
+	::mat4x4 const& M = a.m;
+	float const s[6] = {
+		M[0][0] * M[1][1] - M[1][0] * M[0][1],
+		M[0][0] * M[1][2] - M[1][0] * M[0][2],
+		M[0][0] * M[1][3] - M[1][0] * M[0][3],
+		M[0][1] * M[1][2] - M[1][1] * M[0][2],
+		M[0][1] * M[1][3] - M[1][1] * M[0][3],
+		M[0][2] * M[1][3] - M[1][2] * M[0][3] };
+	float const c[6] = {
+		M[2][0] * M[3][1] - M[3][0] * M[2][1],
+		M[2][0] * M[3][2] - M[3][0] * M[2][2],
+		M[2][0] * M[3][3] - M[3][0] * M[2][3],
+		M[2][1] * M[3][2] - M[3][1] * M[2][2],
+		M[2][1] * M[3][3] - M[3][1] * M[2][3],
+		M[2][2] * M[3][3] - M[3][2] * M[2][3] };
+	float const idet = 1.0f / (s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0]);
+
+	t.m[0][0] = ( M[1][1] * c[5] - M[1][2] * c[4] + M[1][3] * c[3]) * idet;
+	t.m[0][1] = (-M[0][1] * c[5] + M[0][2] * c[4] - M[0][3] * c[3]) * idet;
+	t.m[0][2] = ( M[3][1] * s[5] - M[3][2] * s[4] + M[3][3] * s[3]) * idet;
+	t.m[0][3] = (-M[2][1] * s[5] + M[2][2] * s[4] - M[2][3] * s[3]) * idet;
+
+	t.m[1][0] = (-M[1][0] * c[5] + M[1][2] * c[2] - M[1][3] * c[1]) * idet;
+	t.m[1][1] = ( M[0][0] * c[5] - M[0][2] * c[2] + M[0][3] * c[1]) * idet;
+	t.m[1][2] = (-M[3][0] * s[5] + M[3][2] * s[2] - M[3][3] * s[1]) * idet;
+	t.m[1][3] = ( M[2][0] * s[5] - M[2][2] * s[2] + M[2][3] * s[1]) * idet;
+
+	t.m[2][0] = ( M[1][0] * c[4] - M[1][1] * c[2] + M[1][3] * c[0]) * idet;
+	t.m[2][1] = (-M[0][0] * c[4] + M[0][1] * c[2] - M[0][3] * c[0]) * idet;
+	t.m[2][2] = ( M[3][0] * s[4] - M[3][1] * s[2] + M[3][3] * s[0]) * idet;
+	t.m[2][3] = (-M[2][0] * s[4] + M[2][1] * s[2] - M[2][3] * s[0]) * idet;
+
+	t.m[3][0] = (-M[1][0] * c[3] + M[1][1] * c[1] - M[1][2] * c[0]) * idet;
+	t.m[3][1] = ( M[0][0] * c[3] - M[0][1] * c[1] + M[0][2] * c[0]) * idet;
+	t.m[3][2] = (-M[3][0] * s[3] + M[3][1] * s[1] - M[3][2] * s[0]) * idet;
+	t.m[3][3] = ( M[2][0] * s[3] - M[2][1] * s[1] + M[2][2] * s[0]) * idet;
+	return t;
+}
+constexpr mat4 look_at(vec3 const& eye, vec3 const& center, vec3 const& up)
+{
+	vec3 const f = norm(center - eye);
+	vec3 const s = norm(cross(f, up));
+	vec3 const t = cross(s, f);
+	mat4 m{};
+	for (int i = 0; i < 3; ++i) {
+		m.m[i][0] = s.v[i];
+		m.m[i][1] = t.v[i];
+		m.m[i][2] = -f.v[i];
+	}
+	m.m[3][3] = 1.f;
+	return m * translate(-eye.v[0], -eye.v[1], -eye.v[2]);
+}
+inline mat4 rotate(mat4 const& a, float x, float y, float z, float angle)
+{
+	mat4 r;
+	mat4x4_rotate(r.m, a.m, x, y, z, angle);
+	return r;
+}
+inline mat4 rotate_X(mat4 const& a, float angle)
+{
+	mat4 r;
+	mat4x4_rotate_X(r.m, a.m, angle);
+	return r;
+}
+inline mat4 rotate_Y(mat4 const& a, float angle)
+{
+	mat4 r;
+	mat4x4_rotate_Y(r.m, a.m, angle);
+	return r;
+}
+inline mat4 rotate_Z(mat4 const& a, float angle)
+{
+	mat4 r;
+	mat4x4_rotate_Z(r.m, a.m, angle);
+	return r;
+}
+
+/* --- quaternions --- */
+
+constexpr quat quat_identity() { return quat{ { 0.f, 0.f, 0.f, 1.f } }; }
+constexpr quat operator*(quat const& p, quat const& q)
+{
+	return quat{ {
+		p.v[1] * q.v[2] - p.v[2] * q.v[1] + p.v[0] * q.v[3] + q.v[0] * p.v[3],
+		p.v[2] * q.v[0] - p.v[0] * q.v[2] + p.v[1] * q.v[3] + q.v[1] * p.v[3],
+		p.v[0] * q.v[1] - p.v[1] * q.v[0] + p.v[2] * q.v[3] + q.v[2] * p.v[3],
+		p.v[3] * q.v[3] - (p.v[0] * q.v[0] + p.v[1] * q.v[1] + p.v[2] * q.v[2]) } };
+}
+constexpr quat conj(quat const& q) { return quat{ { -q.v[0], -q.v[1], -q.v[2], q.v[3] } }; }
+/* q * v * conj(q) for a unit q, as quat_mul_vec3 */
+constexpr vec3 operator*(quat const& q, vec3 const& v)
+{
+	vec3 const u{ { q.v[0], q.v[1], q.v[2] } };
+	vec3 const t = cross(u, v) * 2.f;
+	return v + t * q.v[3] + cross(u, t);
+}
+/* mat4x4_from_quat */
+constexpr mat4 to_mat4(quat const& q)
+{
+	float const a = q.v[3], b = q.v[0], c = q.v[1], d = q.v[2];
+	float const a2 = a * a, b2 = b * b, c2 = c * c, d2 = d * d;
+	mat4 r{};
+	r.m[0][0] = a2 + b2 - c2 - d2;
+	r.m[0][1] = 2.f * (b * c + a * d);
+	r.m[0][2] = 2.f * (b * d - a * c);
+	r.m[1][0] = 2.f * (b * c - a * d);
+	r.m[1][1] = a2 - b2 + c2 - d2;
+	r.m[1][2] = 2.f * (c * d + a * b);
+	r.m[2][0] = 2.f * (b * d + a * c);
+	r.m[2][1] = 2.f * (c * d - a * b);
+	r.m[2][2] = a2 - b2 - c2 + d2;
+	r.m[3][3] = 1.f;
+	return r;
+}
+inline quat quat_rotate(float angle, vec3 const& axis)
+{
+	quat r;
+	::quat_rotate(r.v, angle, axis.v);
+	return r;
+}
+
+/* --- affine 3x4 matrices --- */
+
+constexpr affine affine_identity()
+{
+	affine r{};
+	for (int i = 0; i < 3; ++i)
+		r.m[i][i] = 1.f;
+	return r;
+}
+constexpr affine to_affine(mat4 const& a)
+{
+	affine r{};
+	for (int i = 0; i < 3; ++i)
+		for (int c = 0; c < 4; ++c)
+			r.m[i][c] = a.m[c][i];
+	return r;
+}
+constexpr mat4 to_mat4(affine const& a)
+{
+	mat4 r{};
+	for (int c = 0; c < 4; ++c)
+		for (int i = 0; i < 3; ++i)
+			r.m[c][i] = a.m[i][c];
+	r.m[3][3] = 1.f;
+	return r;
+}
+constexpr affine operator*(affine const& a, affine const& b)
+{
+	affine r{};
+#if defined(LINMATH_HPP_CONSTANT_EVALUATED)
+	if (!LINMATH_HPP_CONSTANT_EVALUATED()) {
+		mat3x4_mul(r.m, a.m, b.m);
+		return r;
+	}
+#endif
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 4; ++j)
+			r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + (j == 3 ? a.m[i][3] : 0.f);
+	return r;
+}
+constexpr vec3 mul_point(affine const& a, vec3 const& p)
+{
+	vec3 r{};
+	for (int i = 0; i < 3; ++i)
+		r.v[i] = a.m[i][0] * p.v[0] + a.m[i][1] * p.v[1] + a.m[i][2] * p.v[2] + a.m[i][3];
+	return r;
+}
+inline affine invert(affine const& a)
+{
+	affine r;
+	mat3x4_invert(r.m, a.m);
+	return r;
+}
+
+} /* namespace linmath */
+
+#endif
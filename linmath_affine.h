@@ -0,0 +1,161 @@
+#pragma once
+#ifndef LINMATH_AFFINE_H
+#define LINMATH_AFFINE_H
+
+#include "linmath.h"
+
+/* Affine matrices on top of linmath.h: the top three rows of a 4x4 whose
+ * bottom row is (0, 0, 0, 1), which model matrices always are. Unlike
+ * mat4x4 (column-major, M[column][row]) a mat3x4 is row-major: M[row] is
+ * that row's linear part then its translation, so a point transforms with
+ * three 4-wide dot products. The 48 bytes are also what a GLSL mat3x4
+ * attribute or std430 member reads, its columns being these rows:
+ * world = vec4(p, 1.0) * m.
+ *
+ * Multiply and invert skip the constant row: mat3x4_mul is 36 multiplies
+ * against mat4x4_mul's 64, mat3x4_invert a 3x3 cofactor inverse instead of
+ * mat4x4_invert's full 4x4 one. Both may be called with M aliasing an
+ * input. */
+
+typedef vec4 mat3x4[3];
+
+LINMATH_H_FUNC void mat3x4_identity(mat3x4 M)
+{
+	int i, j;
+	for (i = 0; i < 3; ++i)
+		for (j = 0; j < 4; ++j)
+			M[i][j] = i == j ? 1.f : 0.f;
+}
+LINMATH_H_FUNC void mat3x4_dup(mat3x4 M, mat3x4 const N)
+{
+	int i;
+	for (i = 0; i < 3; ++i)
+		vec4_dup(M[i], N[i]);
+}
+/* Drops A's bottom row, which must be (0, 0, 0, 1) */
+LINMATH_H_FUNC void mat3x4_from_mat4x4(mat3x4 M, mat4x4 const A)
+{
+	int r, c;
+	for (r = 0; r < 3; ++r)
+		for (c = 0; c < 4; ++c)
+			M[r][c] = A[c][r];
+}
+LINMATH_H_FUNC void mat4x4_from_mat3x4(mat4x4 A, mat3x4 const M)
+{
+	int r, c;
+	for (c = 0; c < 4; ++c) {
+		for (r = 0; r < 3; ++r)
+			A[c][r] = M[r][c];
+		A[c][3] = c == 3 ? 1.f : 0.f;
+	}
+}
+/* M = a * b */
+LINMATH_H_FUNC void mat3x4_mul(mat3x4 M, mat3x4 const a, mat3x4 const b)
+{
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	/* Row r of the product is sum_k a[r][k] * b[k], plus a[r]'s translation
+	 * times the implicit (0, 0, 0, 1) row. */
+	__m128 const w = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+	__m128 const b0 = _mm_loadu_ps(b[0]);
+	__m128 const b1 = _mm_loadu_ps(b[1]);
+	__m128 const b2 = _mm_loadu_ps(b[2]);
+	__m128 r[3];
+	int i;
+	for (i = 0; i < 3; ++i) {
+		__m128 const ai = _mm_loadu_ps(a[i]);
+		r[i] = _mm_mul_ps(_mm_shuffle_ps(ai, ai, 0x00), b0);
+		r[i] = LINMATH_H_MADD_PS(_mm_shuffle_ps(ai, ai, 0x55), b1, r[i]);
+		r[i] = LINMATH_H_MADD_PS(_mm_shuffle_ps(ai, ai, 0xAA), b2, r[i]);
+		r[i] = _mm_add_ps(r[i], _mm_and_ps(ai, w));
+	}
+	for (i = 0; i < 3; ++i)
+		_mm_storeu_ps(M[i], r[i]);
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	float32x4_t const b0 = vld1q_f32(b[0]);
+	float32x4_t const b1 = vld1q_f32(b[1]);
+	float32x4_t const b2 = vld1q_f32(b[2]);
+	float32x4_t r[3];
+	int i;
+	for (i = 0; i < 3; ++i) {
+		r[i] = vmulq_n_f32(b0, a[i][0]);
+		r[i] = LINMATH_H_MADD_PS(vdupq_n_f32(a[i][1]), b1, r[i]);
+		r[i] = LINMATH_H_MADD_PS(vdupq_n_f32(a[i][2]), b2, r[i]);
+		r[i] = vaddq_f32(r[i], vsetq_lane_f32(a[i][3], vdupq_n_f32(0.f), 3));
+	}
+	for (i = 0; i < 3; ++i)
+		vst1q_f32(M[i], r[i]);
+#else
+	mat3x4 temp;
+	int i, j;
+	for (i = 0; i < 3; ++i)
+		for (j = 0; j < 4; ++j)
+			temp[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + (j == 3 ? a[i][3] : 0.f);
+	mat3x4_dup(M, temp);
+#endif
+}
+/* The inverse of an invertible affine matrix: the linear part's inverse
+ * from its cofactors (the rows' cross products over the determinant), and
+ * the translation brought back through it. */
+LINMATH_H_FUNC void mat3x4_invert(mat3x4 M, mat3x4 const a)
+{
+#if (LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX) && !defined(LINMATH_DETERMINISTIC)
+	__m128 const r0 = _mm_loadu_ps(a[0]);
+	__m128 const r1 = _mm_loadu_ps(a[1]);
+	__m128 const r2 = _mm_loadu_ps(a[2]);
+	/* Lane 3 of a cross product is w*w - w*w: zero, or a rounding residue
+	 * where the compiler fuses it into an FMA, so it's masked off below */
+#define LINMATH_H_CROSS_PS(x, y) _mm_sub_ps( \
+	_mm_mul_ps(_mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 1, 0, 2))), \
+	_mm_mul_ps(_mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 0, 2, 1))))
+	__m128 c0 = LINMATH_H_CROSS_PS(r1, r2);
+	__m128 c1 = LINMATH_H_CROSS_PS(r2, r0);
+	__m128 c2 = LINMATH_H_CROSS_PS(r0, r1);
+#undef LINMATH_H_CROSS_PS
+	/* det = r0 . c0, in every lane */
+	__m128 const xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	__m128 det = _mm_mul_ps(_mm_and_ps(r0, xyz), c0);
+	det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+	det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 0, 3, 2)));
+	/* The inverse's columns are c0..c2 / det and its translation is
+	 * -(t0 * c0 + t1 * c1 + t2 * c2) / det: transposed, those are its rows */
+	__m128 t = _mm_mul_ps(_mm_shuffle_ps(r0, r0, 0xFF), c0);
+	t = LINMATH_H_MADD_PS(_mm_shuffle_ps(r1, r1, 0xFF), c1, t);
+	t = LINMATH_H_MADD_PS(_mm_shuffle_ps(r2, r2, 0xFF), c2, t);
+	t = _mm_sub_ps(_mm_setzero_ps(), t);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, t);
+	__m128 const k = _mm_div_ps(_mm_set1_ps(1.f), det);
+	_mm_storeu_ps(M[0], _mm_mul_ps(c0, k));
+	_mm_storeu_ps(M[1], _mm_mul_ps(c1, k));
+	_mm_storeu_ps(M[2], _mm_mul_ps(c2, k));
+#else
+	float const det =
+		a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+		a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+		a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+	float const k = 1.f / det;
+	mat3x4 R;
+	int i;
+	R[0][0] = (a[1][1] * a[2][2] - a[1][2] * a[2][1]) * k;
+	R[0][1] = (a[0][2] * a[2][1] - a[0][1] * a[2][2]) * k;
+	R[0][2] = (a[0][1] * a[1][2] - a[0][2] * a[1][1]) * k;
+	R[1][0] = (a[1][2] * a[2][0] - a[1][0] * a[2][2]) * k;
+	R[1][1] = (a[0][0] * a[2][2] - a[0][2] * a[2][0]) * k;
+	R[1][2] = (a[0][2] * a[1][0] - a[0][0] * a[1][2]) * k;
+	R[2][0] = (a[1][0] * a[2][1] - a[1][1] * a[2][0]) * k;
+	R[2][1] = (a[0][1] * a[2][0] - a[0][0] * a[2][1]) * k;
+	R[2][2] = (a[0][0] * a[1][1] - a[0][1] * a[1][0]) * k;
+	for (i = 0; i < 3; ++i)
+		R[i][3] = -(R[i][0] * a[0][3] + R[i][1] * a[1][3] + R[i][2] * a[2][3]);
+	mat3x4_dup(M, R);
+#endif
+}
+/* r = M * (v, 1): a point through the matrix */
+LINMATH_H_FUNC void mat3x4_mul_vec3(vec3 r, mat3x4 const M, vec3 const v)
+{
+	vec3 const p = { v[0], v[1], v[2] };
+	int i;
+	for (i = 0; i < 3; ++i)
+		r[i] = M[i][0] * p[0] + M[i][1] * p[1] + M[i][2] * p[2] + M[i][3];
+}
+
+#endif
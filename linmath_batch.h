@@ -0,0 +1,361 @@
+#pragma once
+#ifndef LINMATH_BATCH_H
+#define LINMATH_BATCH_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+#include "linmath.h"
+#include "linmath_affine.h"
+
+/* Batched entry points on top of linmath.h. Every function works on
+ * contiguous arrays: mat4x4 and vec4 arrays are array-of-structures, point
+ * sets are structure-of-arrays (one float array per component). Buffers are
+ * expected to be LINMATH_BATCH_ALIGN aligned (vec4a_alloc, mat4x4a_alloc or
+ * linmath_aligned_alloc below); the loops are written so the compiler can
+ * vectorise them, and the hot ones have hand-written kernels for the
+ * LINMATH_H_SIMD backends. Output arrays must not overlap the inputs
+ * unless a function says otherwise. */
+
+#define LINMATH_BATCH_ALIGN 16
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LINMATH_H_ASSUME_ALIGNED(p) ((__typeof__(p))__builtin_assume_aligned((p), LINMATH_BATCH_ALIGN))
+#else
+#define LINMATH_H_ASSUME_ALIGNED(p) (p)
+#endif
+
+/* Aligned storage. vec4 and mat4x4 are plain float arrays and carry no
+ * alignment of their own, so an array of them is only as aligned as the
+ * allocation it came from and a mat4x4 at an odd offset straddles two cache
+ * lines. vec4a and mat4x4a are the same arrays with the alignment in the type:
+ * 16 bytes for a vec4a, a cache line for a mat4x4a, so every matrix of an
+ * array or a struct member sits in a line of its own. Both convert to the
+ * plain types, and every linmath function takes them. There is no aligned
+ * mat3x4: at 48 bytes, an array of them can't be aligned element by element. */
+#define LINMATH_CACHE_LINE 64
+
+#if defined(_MSC_VER)
+typedef __declspec(align(16)) float vec4a[4];
+typedef __declspec(align(LINMATH_CACHE_LINE)) vec4 mat4x4a[4];
+#else
+typedef float vec4a[4] __attribute__((aligned(16)));
+typedef vec4 mat4x4a[4] __attribute__((aligned(LINMATH_CACHE_LINE)));
+#endif
+
+/* "size" bytes aligned to "align", a power of two of at least sizeof(void*);
+ * NULL when out of memory. Release with linmath_aligned_free. */
+LINMATH_H_FUNC void* linmath_aligned_alloc(size_t size, size_t align)
+{
+#if defined(_MSC_VER)
+	return _aligned_malloc(size, align);
+#else
+	void* p = NULL;
+	return posix_memalign(&p, align, size) == 0 ? p : NULL;
+#endif
+}
+
+LINMATH_H_FUNC void linmath_aligned_free(void* p)
+{
+#if defined(_MSC_VER)
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+/* Arrays of "n" aligned vectors and matrices, each starting a cache line and
+ * so fit for every batch function here */
+LINMATH_H_FUNC vec4a* vec4a_alloc(size_t n)
+{
+	return (vec4a*)linmath_aligned_alloc(sizeof(vec4a) * n, LINMATH_CACHE_LINE);
+}
+
+LINMATH_H_FUNC mat4x4a* mat4x4a_alloc(size_t n)
+{
+	return (mat4x4a*)linmath_aligned_alloc(sizeof(mat4x4a) * n, LINMATH_CACHE_LINE);
+}
+
+/* R[i] = a * b[i], e.g. view-projection times every model matrix. R may be
+ * the same array as b. */
+LINMATH_H_FUNC void mat4x4_mul_batch(mat4x4* R, mat4x4 const a, mat4x4 const* b, size_t n)
+{
+	size_t i;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	/* a's columns stay in registers for the whole batch. */
+	__m128 const a0 = _mm_loadu_ps(a[0]);
+	__m128 const a1 = _mm_loadu_ps(a[1]);
+	__m128 const a2 = _mm_loadu_ps(a[2]);
+	__m128 const a3 = _mm_loadu_ps(a[3]);
+	for (i = 0; i < n; ++i) {
+		__m128 r[4];
+		int c;
+		for (c = 0; c < 4; ++c) {
+			__m128 const bc = _mm_load_ps(b[i][c]);
+			r[c] = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, 0x00));
+			r[c] = LINMATH_H_MADD_PS(a1, _mm_shuffle_ps(bc, bc, 0x55), r[c]);
+			r[c] = LINMATH_H_MADD_PS(a2, _mm_shuffle_ps(bc, bc, 0xAA), r[c]);
+			r[c] = LINMATH_H_MADD_PS(a3, _mm_shuffle_ps(bc, bc, 0xFF), r[c]);
+		}
+		for (c = 0; c < 4; ++c)
+			_mm_store_ps(R[i][c], r[c]);
+	}
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	float32x4_t const a0 = vld1q_f32(a[0]);
+	float32x4_t const a1 = vld1q_f32(a[1]);
+	float32x4_t const a2 = vld1q_f32(a[2]);
+	float32x4_t const a3 = vld1q_f32(a[3]);
+	for (i = 0; i < n; ++i) {
+		float32x4_t r[4];
+		int c;
+		for (c = 0; c < 4; ++c) {
+			r[c] = vmulq_n_f32(a0, b[i][c][0]);
+			r[c] = LINMATH_H_MADD_PS(a1, vdupq_n_f32(b[i][c][1]), r[c]);
+			r[c] = LINMATH_H_MADD_PS(a2, vdupq_n_f32(b[i][c][2]), r[c]);
+			r[c] = LINMATH_H_MADD_PS(a3, vdupq_n_f32(b[i][c][3]), r[c]);
+		}
+		for (c = 0; c < 4; ++c)
+			vst1q_f32(R[i][c], r[c]);
+	}
+#else
+	for (i = 0; i < n; ++i)
+		mat4x4_mul(R[i], a, b[i]);
+#endif
+}
+
+/* R[i] = M[i] * rotate_Z(angle[i]), i.e. mat4x4_rotate_Z over a batch. Only
+ * the first two columns change, so the identity/multiply round trip of the
+ * single-matrix version is skipped. R may be the same array as M. */
+LINMATH_H_FUNC void mat4x4_rotate_Z_batch(mat4x4* R, mat4x4 const* M, float const* angle, size_t n)
+{
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		float const s = linmath_sinf(angle[i]);
+		float const c = linmath_cosf(angle[i]);
+		int k;
+		for (k = 0; k < 4; ++k) {
+			float const m0 = M[i][0][k];
+			float const m1 = M[i][1][k];
+			R[i][0][k] = m0 * c + m1 * s;
+			R[i][1][k] = m1 * c - m0 * s;
+			R[i][2][k] = M[i][2][k];
+			R[i][3][k] = M[i][3][k];
+		}
+	}
+}
+
+/* r[i] = M * v[i] for an array of vec4. */
+LINMATH_H_FUNC void mat4x4_mul_vec4_batch(vec4* LINMATH_H_RESTRICT r, mat4x4 const M, vec4 const* LINMATH_H_RESTRICT v, size_t n)
+{
+	size_t i;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const m0 = _mm_loadu_ps(M[0]);
+	__m128 const m1 = _mm_loadu_ps(M[1]);
+	__m128 const m2 = _mm_loadu_ps(M[2]);
+	__m128 const m3 = _mm_loadu_ps(M[3]);
+	for (i = 0; i < n; ++i) {
+		__m128 const vv = _mm_load_ps(v[i]);
+		__m128 x = _mm_mul_ps(m0, _mm_shuffle_ps(vv, vv, 0x00));
+		x = LINMATH_H_MADD_PS(m1, _mm_shuffle_ps(vv, vv, 0x55), x);
+		x = LINMATH_H_MADD_PS(m2, _mm_shuffle_ps(vv, vv, 0xAA), x);
+		x = LINMATH_H_MADD_PS(m3, _mm_shuffle_ps(vv, vv, 0xFF), x);
+		_mm_store_ps(r[i], x);
+	}
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	float32x4_t const m0 = vld1q_f32(M[0]);
+	float32x4_t const m1 = vld1q_f32(M[1]);
+	float32x4_t const m2 = vld1q_f32(M[2]);
+	float32x4_t const m3 = vld1q_f32(M[3]);
+	for (i = 0; i < n; ++i) {
+		float32x4_t x = vmulq_n_f32(m0, v[i][0]);
+		x = LINMATH_H_MADD_PS(m1, vdupq_n_f32(v[i][1]), x);
+		x = LINMATH_H_MADD_PS(m2, vdupq_n_f32(v[i][2]), x);
+		x = LINMATH_H_MADD_PS(m3, vdupq_n_f32(v[i][3]), x);
+		vst1q_f32(r[i], x);
+	}
+#else
+	for (i = 0; i < n; ++i)
+		mat4x4_mul_vec4(r[i], M, v[i]);
+#endif
+}
+
+/* Structure-of-arrays point transform: (ox, oy, oz, ow)[i] = M * (x, y, z, w)[i].
+ * w may be NULL, in which case every input w is 1 (positions); ow may be NULL
+ * when the caller does not need it. */
+LINMATH_H_FUNC void mat4x4_transform_soa(float* LINMATH_H_RESTRICT ox, float* LINMATH_H_RESTRICT oy,
+	float* LINMATH_H_RESTRICT oz, float* LINMATH_H_RESTRICT ow, mat4x4 const M,
+	float const* LINMATH_H_RESTRICT x, float const* LINMATH_H_RESTRICT y,
+	float const* LINMATH_H_RESTRICT z, float const* LINMATH_H_RESTRICT w, size_t n)
+{
+	size_t i = 0;
+	float const m00 = M[0][0], m01 = M[0][1], m02 = M[0][2], m03 = M[0][3];
+	float const m10 = M[1][0], m11 = M[1][1], m12 = M[1][2], m13 = M[1][3];
+	float const m20 = M[2][0], m21 = M[2][1], m22 = M[2][2], m23 = M[2][3];
+	float const m30 = M[3][0], m31 = M[3][1], m32 = M[3][2], m33 = M[3][3];
+	x = LINMATH_H_ASSUME_ALIGNED(x);
+	y = LINMATH_H_ASSUME_ALIGNED(y);
+	z = LINMATH_H_ASSUME_ALIGNED(z);
+	ox = LINMATH_H_ASSUME_ALIGNED(ox);
+	oy = LINMATH_H_ASSUME_ALIGNED(oy);
+	oz = LINMATH_H_ASSUME_ALIGNED(oz);
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	if (!w) {
+		/* Four points per iteration against broadcast matrix entries. */
+		for (; i + 4 <= n; i += 4) {
+			__m128 const vx = _mm_load_ps(x + i);
+			__m128 const vy = _mm_load_ps(y + i);
+			__m128 const vz = _mm_load_ps(z + i);
+#define LINMATH_H_SOA_ROW(o, a, b, c, d) \
+			o = LINMATH_H_MADD_PS(_mm_set1_ps(c), vz, LINMATH_H_MADD_PS(_mm_set1_ps(b), vy, \
+				LINMATH_H_MADD_PS(_mm_set1_ps(a), vx, _mm_set1_ps(d))))
+			__m128 rx, ry, rz, rw;
+			LINMATH_H_SOA_ROW(rx, m00, m10, m20, m30);
+			LINMATH_H_SOA_ROW(ry, m01, m11, m21, m31);
+			LINMATH_H_SOA_ROW(rz, m02, m12, m22, m32);
+			LINMATH_H_SOA_ROW(rw, m03, m13, m23, m33);
+#undef LINMATH_H_SOA_ROW
+			_mm_store_ps(ox + i, rx);
+			_mm_store_ps(oy + i, ry);
+			_mm_store_ps(oz + i, rz);
+			if (ow)
+				_mm_storeu_ps(ow + i, rw);
+		}
+	}
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	if (!w) {
+		for (; i + 4 <= n; i += 4) {
+			float32x4_t const vx = vld1q_f32(x + i);
+			float32x4_t const vy = vld1q_f32(y + i);
+			float32x4_t const vz = vld1q_f32(z + i);
+#define LINMATH_H_SOA_ROW(o, a, b, c, d) \
+			o = LINMATH_H_MADD_PS(vdupq_n_f32(c), vz, LINMATH_H_MADD_PS(vdupq_n_f32(b), vy, \
+				LINMATH_H_MADD_PS(vdupq_n_f32(a), vx, vdupq_n_f32(d))))
+			float32x4_t rx, ry, rz, rw;
+			LINMATH_H_SOA_ROW(rx, m00, m10, m20, m30);
+			LINMATH_H_SOA_ROW(ry, m01, m11, m21, m31);
+			LINMATH_H_SOA_ROW(rz, m02, m12, m22, m32);
+			LINMATH_H_SOA_ROW(rw, m03, m13, m23, m33);
+#undef LINMATH_H_SOA_ROW
+			vst1q_f32(ox + i, rx);
+			vst1q_f32(oy + i, ry);
+			vst1q_f32(oz + i, rz);
+			if (ow)
+				vst1q_f32(ow + i, rw);
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		float const px = x[i], py = y[i], pz = z[i];
+		float const pw = w ? w[i] : 1.f;
+		ox[i] = m30 * pw + m00 * px + m10 * py + m20 * pz;
+		oy[i] = m31 * pw + m01 * px + m11 * py + m21 * pz;
+		oz[i] = m32 * pw + m02 * px + m12 * py + m22 * pz;
+		if (ow)
+			ow[i] = m33 * pw + m03 * px + m13 * py + m23 * pz;
+	}
+}
+
+/* Builds model matrices for a batch of objects rotated about Z, uniformly
+ * scaled by k and placed at (tx, ty, tz):
+ * model[i] = translate(t[i]) * scale(k) * rotate_Z(angle[i]). This is the
+ * identity + translate + rotate_Z sequence of the main loop in one pass.
+ * tz may be NULL for objects in the z = 0 plane. */
+LINMATH_H_FUNC void mat4x4_translate_rotate_Z_batch(mat4x4* LINMATH_H_RESTRICT R, float const* LINMATH_H_RESTRICT tx,
+	float const* LINMATH_H_RESTRICT ty, float const* LINMATH_H_RESTRICT tz,
+	float const* LINMATH_H_RESTRICT angle, float k, size_t n)
+{
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		float const s = k * linmath_sinf(angle[i]);
+		float const c = k * linmath_cosf(angle[i]);
+		R[i][0][0] = c;   R[i][0][1] = s;   R[i][0][2] = 0.f; R[i][0][3] = 0.f;
+		R[i][1][0] = -s;  R[i][1][1] = c;   R[i][1][2] = 0.f; R[i][1][3] = 0.f;
+		R[i][2][0] = 0.f; R[i][2][1] = 0.f; R[i][2][2] = k;   R[i][2][3] = 0.f;
+		R[i][3][0] = tx[i];
+		R[i][3][1] = ty[i];
+		R[i][3][2] = tz ? tz[i] : 0.f;
+		R[i][3][3] = 1.f;
+	}
+}
+
+/* The same objects' MVPs straight from the view-projection:
+ * R[i] = VP * translate(t[i]) * scale(k) * rotate_Z(angle[i]), without the
+ * model matrices in between. scale(k) * rotate_Z only mixes VP's first two
+ * columns and the translation lands in the last, so each matrix is five
+ * vector multiply-adds instead of a full mat4x4_mul. */
+LINMATH_H_FUNC void mat4x4_mul_translate_rotate_Z_batch(mat4x4* LINMATH_H_RESTRICT R, mat4x4 const VP,
+	float const* LINMATH_H_RESTRICT tx, float const* LINMATH_H_RESTRICT ty, float const* LINMATH_H_RESTRICT tz,
+	float const* LINMATH_H_RESTRICT angle, float k, size_t n)
+{
+	size_t i;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const v0 = _mm_loadu_ps(VP[0]);
+	__m128 const v1 = _mm_loadu_ps(VP[1]);
+	__m128 const v2 = _mm_loadu_ps(VP[2]);
+	__m128 const v3 = _mm_loadu_ps(VP[3]);
+	__m128 const c2 = _mm_mul_ps(_mm_set1_ps(k), v2);
+	for (i = 0; i < n; ++i) {
+		__m128 const vs = _mm_set1_ps(k * linmath_sinf(angle[i]));
+		__m128 const vc = _mm_set1_ps(k * linmath_cosf(angle[i]));
+		__m128 t = LINMATH_H_MADD_PS(_mm_set1_ps(tx[i]), v0, v3);
+		t = LINMATH_H_MADD_PS(_mm_set1_ps(ty[i]), v1, t);
+		if (tz)
+			t = LINMATH_H_MADD_PS(_mm_set1_ps(tz[i]), v2, t);
+		_mm_store_ps(R[i][0], LINMATH_H_MADD_PS(vs, v1, _mm_mul_ps(vc, v0)));
+		_mm_store_ps(R[i][1], _mm_sub_ps(_mm_mul_ps(vc, v1), _mm_mul_ps(vs, v0)));
+		_mm_store_ps(R[i][2], c2);
+		_mm_store_ps(R[i][3], t);
+	}
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	float32x4_t const v0 = vld1q_f32(VP[0]);
+	float32x4_t const v1 = vld1q_f32(VP[1]);
+	float32x4_t const v2 = vld1q_f32(VP[2]);
+	float32x4_t const v3 = vld1q_f32(VP[3]);
+	float32x4_t const c2 = vmulq_n_f32(v2, k);
+	for (i = 0; i < n; ++i) {
+		float32x4_t const vs = vdupq_n_f32(k * linmath_sinf(angle[i]));
+		float32x4_t const vc = vdupq_n_f32(k * linmath_cosf(angle[i]));
+		float32x4_t t = LINMATH_H_MADD_PS(vdupq_n_f32(tx[i]), v0, v3);
+		t = LINMATH_H_MADD_PS(vdupq_n_f32(ty[i]), v1, t);
+		if (tz)
+			t = LINMATH_H_MADD_PS(vdupq_n_f32(tz[i]), v2, t);
+		vst1q_f32(R[i][0], LINMATH_H_MADD_PS(vs, v1, vmulq_f32(vc, v0)));
+		vst1q_f32(R[i][1], vsubq_f32(vmulq_f32(vc, v1), vmulq_f32(vs, v0)));
+		vst1q_f32(R[i][2], c2);
+		vst1q_f32(R[i][3], t);
+	}
+#else
+	for (i = 0; i < n; ++i) {
+		float const s = k * linmath_sinf(angle[i]);
+		float const c = k * linmath_cosf(angle[i]);
+		float const z = tz ? tz[i] : 0.f;
+		int r;
+		for (r = 0; r < 4; ++r) {
+			R[i][0][r] = c * VP[0][r] + s * VP[1][r];
+			R[i][1][r] = c * VP[1][r] - s * VP[0][r];
+			R[i][2][r] = k * VP[2][r];
+			R[i][3][r] = tx[i] * VP[0][r] + ty[i] * VP[1][r] + z * VP[2][r] + VP[3][r];
+		}
+	}
+#endif
+}
+
+/* mat4x4_translate_rotate_Z_batch's affine counterpart, writing 48 bytes
+ * per object instead of 64: the rows of the same model matrices. */
+LINMATH_H_FUNC void mat3x4_translate_rotate_Z_batch(mat3x4* LINMATH_H_RESTRICT R, float const* LINMATH_H_RESTRICT tx,
+	float const* LINMATH_H_RESTRICT ty, float const* LINMATH_H_RESTRICT tz,
+	float const* LINMATH_H_RESTRICT angle, float k, size_t n)
+{
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		float const s = k * linmath_sinf(angle[i]);
+		float const c = k * linmath_cosf(angle[i]);
+		R[i][0][0] = c;   R[i][0][1] = -s;  R[i][0][2] = 0.f; R[i][0][3] = tx[i];
+		R[i][1][0] = s;   R[i][1][1] = c;   R[i][1][2] = 0.f; R[i][1][3] = ty[i];
+		R[i][2][0] = 0.f; R[i][2][1] = 0.f; R[i][2][2] = k;   R[i][2][3] = tz ? tz[i] : 0.f;
+	}
+}
+
+#endif
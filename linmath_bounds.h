@@ -0,0 +1,339 @@
+#pragma once
+#ifndef LINMATH_BOUNDS_H
+#define LINMATH_BOUNDS_H
+
+#include "linmath.h"
+#include "linmath_affine.h"
+#include "linmath_batch.h"
+
+/* Bounding volumes through affine matrices and against planes, for culling
+ * and hierarchy refits.
+ *
+ * Boxes transform by Arvo's method: in centre/half-extent form the centre is
+ * a point through M and each new half-extent is the old ones through |M|,
+ * the linear part with every entry made positive. That is the tightest
+ * axis-aligned box around the transformed one, with no corners to visit.
+ * Spheres keep their centre exact and scale the radius by M's largest
+ * column length, so they stay conservative under non-uniform scale.
+ *
+ * The _soa batches take one mat3x4 per element and the bounds as
+ * structure-of-arrays, LINMATH_BATCH_ALIGN aligned like the rest of
+ * linmath_batch.h; SSE transposes four matrices at a time into lanes, NEON
+ * and scalar targets run the single-element functions. Outputs may be the
+ * input arrays.
+ *
+ * The plane tests take eight bounds at a time, in the same form, and return
+ * a bitmask of those not wholly behind any of the planes: one pass with AVX,
+ * two 4-wide ones with SSE2 and NEON. Planes are (n, d) with |n| = 1, inside
+ * when dot(n, p) + d >= 0 (frustum_from_matrix's). Their loads are
+ * unaligned, so they can run from any element of an array. */
+
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+#if defined(LINMATH_H_SIMD_FMA)
+#define LINMATH_H_MADD256_PS(a, b, c) _mm256_fmadd_ps(a, b, c)
+#else
+#define LINMATH_H_MADD256_PS(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#endif
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+/* _mm_movemask_ps: lane k's top bit to bit k */
+LINMATH_H_FUNC unsigned int planes_movemask_neon(uint32x4_t m)
+{
+	uint32_t const bits[4] = { 1, 2, 4, 8 };
+	uint32x4_t const weighted = vandq_u32(m, vld1q_u32(bits));
+	uint32x2_t const pair = vadd_u32(vget_low_u32(weighted), vget_high_u32(weighted));
+	return vget_lane_u32(vpadd_u32(pair, pair), 0);
+}
+#endif
+
+/* (rmin, rmax) around the box (min, max) through M */
+LINMATH_H_FUNC void mat3x4_transform_aabb(vec3 rmin, vec3 rmax, mat3x4 const M, vec3 const min, vec3 const max)
+{
+	float c[3], e[3];
+	int r, k;
+	for (k = 0; k < 3; ++k) {
+		c[k] = 0.5f * (min[k] + max[k]);
+		e[k] = 0.5f * (max[k] - min[k]);
+	}
+	for (r = 0; r < 3; ++r) {
+		float const cr = M[r][0] * c[0] + M[r][1] * c[1] + M[r][2] * c[2] + M[r][3];
+		float const er = fabsf(M[r][0]) * e[0] + fabsf(M[r][1]) * e[1] + fabsf(M[r][2]) * e[2];
+		rmin[r] = cr - er;
+		rmax[r] = cr + er;
+	}
+}
+
+/* The largest factor M scales a length by, bounded by its longest column */
+LINMATH_H_FUNC float mat3x4_max_scale(mat3x4 const M)
+{
+	float s = 0.f;
+	int c;
+	for (c = 0; c < 3; ++c) {
+		float const l = M[0][c] * M[0][c] + M[1][c] * M[1][c] + M[2][c] * M[2][c];
+		s = l > s ? l : s;
+	}
+	return sqrtf(s);
+}
+
+/* r = the sphere s (centre, radius) through M. r may be s. */
+LINMATH_H_FUNC void mat3x4_transform_sphere(vec4 r, mat3x4 const M, vec4 const s)
+{
+	float const radius = s[3] * mat3x4_max_scale(M);
+	mat3x4_mul_vec3(r, M, s);
+	r[3] = radius;
+}
+
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+/* Entry (r, c) of four consecutive matrices in m[r][c]'s lanes */
+LINMATH_H_FUNC void mat3x4_transpose4_ps(__m128 m[3][4], mat3x4 const* M)
+{
+	int r;
+	for (r = 0; r < 3; ++r) {
+		m[r][0] = _mm_load_ps(M[0][r]);
+		m[r][1] = _mm_load_ps(M[1][r]);
+		m[r][2] = _mm_load_ps(M[2][r]);
+		m[r][3] = _mm_load_ps(M[3][r]);
+		_MM_TRANSPOSE4_PS(m[r][0], m[r][1], m[r][2], m[r][3]);
+	}
+}
+#endif
+
+/* Boxes as centre (cx, cy, cz)[i] and half-extents (ex, ey, ez)[i], each
+ * through its own M[i], into (ocx, ..., oez) */
+LINMATH_H_FUNC void mat3x4_transform_aabb_soa(float* ocx, float* ocy, float* ocz, float* oex, float* oey, float* oez,
+	mat3x4 const* M, float const* cx, float const* cy, float const* cz,
+	float const* ex, float const* ey, float const* ez, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	float* const oc[3] = { ocx, ocy, ocz };
+	float* const oe[3] = { oex, oey, oez };
+	__m128 const abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	for (; i + 4 <= n; i += 4) {
+		__m128 m[3][4];
+		__m128 const x = _mm_load_ps(cx + i), y = _mm_load_ps(cy + i), z = _mm_load_ps(cz + i);
+		__m128 const wx = _mm_load_ps(ex + i), wy = _mm_load_ps(ey + i), wz = _mm_load_ps(ez + i);
+		__m128 c[3], e[3];
+		int r;
+		mat3x4_transpose4_ps(m, M + i);
+		for (r = 0; r < 3; ++r) {
+			c[r] = LINMATH_H_MADD_PS(m[r][0], x, m[r][3]);
+			c[r] = LINMATH_H_MADD_PS(m[r][1], y, c[r]);
+			c[r] = LINMATH_H_MADD_PS(m[r][2], z, c[r]);
+			e[r] = _mm_mul_ps(_mm_and_ps(m[r][0], abs_mask), wx);
+			e[r] = LINMATH_H_MADD_PS(_mm_and_ps(m[r][1], abs_mask), wy, e[r]);
+			e[r] = LINMATH_H_MADD_PS(_mm_and_ps(m[r][2], abs_mask), wz, e[r]);
+		}
+		for (r = 0; r < 3; ++r) {
+			_mm_store_ps(oc[r] + i, c[r]);
+			_mm_store_ps(oe[r] + i, e[r]);
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		float const x = cx[i], y = cy[i], z = cz[i];
+		float const wx = ex[i], wy = ey[i], wz = ez[i];
+		mat3x4 const* m = M + i;
+		ocx[i] = (*m)[0][0] * x + (*m)[0][1] * y + (*m)[0][2] * z + (*m)[0][3];
+		ocy[i] = (*m)[1][0] * x + (*m)[1][1] * y + (*m)[1][2] * z + (*m)[1][3];
+		ocz[i] = (*m)[2][0] * x + (*m)[2][1] * y + (*m)[2][2] * z + (*m)[2][3];
+		oex[i] = fabsf((*m)[0][0]) * wx + fabsf((*m)[0][1]) * wy + fabsf((*m)[0][2]) * wz;
+		oey[i] = fabsf((*m)[1][0]) * wx + fabsf((*m)[1][1]) * wy + fabsf((*m)[1][2]) * wz;
+		oez[i] = fabsf((*m)[2][0]) * wx + fabsf((*m)[2][1]) * wy + fabsf((*m)[2][2]) * wz;
+	}
+}
+
+/* Spheres at (x, y, z)[i] with radius[i], each through its own M[i] */
+LINMATH_H_FUNC void mat3x4_transform_sphere_soa(float* ox, float* oy, float* oz, float* oradius,
+	mat3x4 const* M, float const* x, float const* y, float const* z, float const* radius, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	float* const o[3] = { ox, oy, oz };
+	for (; i + 4 <= n; i += 4) {
+		__m128 m[3][4];
+		__m128 const vx = _mm_load_ps(x + i), vy = _mm_load_ps(y + i), vz = _mm_load_ps(z + i);
+		__m128 p[3], scale = _mm_setzero_ps();
+		int r, c;
+		mat3x4_transpose4_ps(m, M + i);
+		for (r = 0; r < 3; ++r) {
+			p[r] = LINMATH_H_MADD_PS(m[r][0], vx, m[r][3]);
+			p[r] = LINMATH_H_MADD_PS(m[r][1], vy, p[r]);
+			p[r] = LINMATH_H_MADD_PS(m[r][2], vz, p[r]);
+		}
+		for (c = 0; c < 3; ++c) {
+			__m128 l = _mm_mul_ps(m[0][c], m[0][c]);
+			l = LINMATH_H_MADD_PS(m[1][c], m[1][c], l);
+			l = LINMATH_H_MADD_PS(m[2][c], m[2][c], l);
+			scale = _mm_max_ps(scale, l);
+		}
+		for (r = 0; r < 3; ++r)
+			_mm_store_ps(o[r] + i, p[r]);
+		_mm_store_ps(oradius + i, _mm_mul_ps(_mm_load_ps(radius + i), _mm_sqrt_ps(scale)));
+	}
+#endif
+	for (; i < n; ++i) {
+		vec4 s = { x[i], y[i], z[i], radius[i] };
+		mat3x4_transform_sphere(s, M[i], s);
+		ox[i] = s[0];
+		oy[i] = s[1];
+		oz[i] = s[2];
+		oradius[i] = s[3];
+	}
+}
+
+/* Bit k set unless sphere k of the eight at (x, y, z, radius) lies wholly
+ * behind one of the "count" planes. z may be NULL for spheres in the z = 0
+ * plane. */
+LINMATH_H_FUNC unsigned int planes_test_spheres8(vec4 const* planes, int count, float const* x, float const* y,
+	float const* z, float const* radius)
+{
+	unsigned int mask = 0;
+	int p;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m256 const vx = _mm256_loadu_ps(x);
+	__m256 const vy = _mm256_loadu_ps(y);
+	__m256 const vz = z ? _mm256_loadu_ps(z) : _mm256_setzero_ps();
+	__m256 const neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius));
+	__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	for (p = 0; p < count; ++p) {
+		__m256 d = LINMATH_H_MADD256_PS(_mm256_set1_ps(planes[p][0]), vx, _mm256_set1_ps(planes[p][3]));
+		d = LINMATH_H_MADD256_PS(_mm256_set1_ps(planes[p][1]), vy, d);
+		d = LINMATH_H_MADD256_PS(_mm256_set1_ps(planes[p][2]), vz, d);
+		inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_r, _CMP_GE_OQ));
+	}
+	mask = (unsigned int)_mm256_movemask_ps(inside);
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2
+	int h;
+	for (h = 0; h < 8; h += 4) {
+		__m128 const vx = _mm_loadu_ps(x + h);
+		__m128 const vy = _mm_loadu_ps(y + h);
+		__m128 const vz = z ? _mm_loadu_ps(z + h) : _mm_setzero_ps();
+		__m128 const neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + h));
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (p = 0; p < count; ++p) {
+			__m128 d = LINMATH_H_MADD_PS(_mm_set1_ps(planes[p][0]), vx, _mm_set1_ps(planes[p][3]));
+			d = LINMATH_H_MADD_PS(_mm_set1_ps(planes[p][1]), vy, d);
+			d = LINMATH_H_MADD_PS(_mm_set1_ps(planes[p][2]), vz, d);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_r));
+		}
+		mask |= (unsigned int)_mm_movemask_ps(inside) << h;
+	}
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	int h;
+	for (h = 0; h < 8; h += 4) {
+		float32x4_t const vx = vld1q_f32(x + h);
+		float32x4_t const vy = vld1q_f32(y + h);
+		float32x4_t const vz = z ? vld1q_f32(z + h) : vdupq_n_f32(0.f);
+		float32x4_t const neg_r = vnegq_f32(vld1q_f32(radius + h));
+		uint32x4_t inside = vdupq_n_u32(0xFFFFFFFFu);
+		for (p = 0; p < count; ++p) {
+			float32x4_t d = LINMATH_H_MADD_PS(vdupq_n_f32(planes[p][0]), vx, vdupq_n_f32(planes[p][3]));
+			d = LINMATH_H_MADD_PS(vdupq_n_f32(planes[p][1]), vy, d);
+			d = LINMATH_H_MADD_PS(vdupq_n_f32(planes[p][2]), vz, d);
+			inside = vandq_u32(inside, vcgeq_f32(d, neg_r));
+		}
+		mask |= planes_movemask_neon(inside) << h;
+	}
+#else
+	int k;
+	for (k = 0; k < 8; ++k) {
+		unsigned int inside = 1;
+		for (p = 0; p < count; ++p)
+			inside &= planes[p][0] * x[k] + planes[p][1] * y[k] + planes[p][2] * (z ? z[k] : 0.f) + planes[p][3]
+				>= -radius[k];
+		mask |= inside << k;
+	}
+#endif
+	return mask;
+}
+
+/* Bit k set unless box k of the eight with centre (cx, cy, cz) and
+ * half-extents (ex, ey, ez) lies wholly behind one of the "count" planes:
+ * the centre's distance plus the extent projected onto the normal,
+ * dot(|n|, e), so only a box whose most inward corner is behind fails. */
+LINMATH_H_FUNC unsigned int planes_test_aabbs8(vec4 const* planes, int count, float const* cx, float const* cy,
+	float const* cz, float const* ex, float const* ey, float const* ez)
+{
+	unsigned int mask = 0;
+	int p;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m256 const abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256 const vx = _mm256_loadu_ps(cx);
+	__m256 const vy = _mm256_loadu_ps(cy);
+	__m256 const vz = _mm256_loadu_ps(cz);
+	__m256 const wx = _mm256_loadu_ps(ex);
+	__m256 const wy = _mm256_loadu_ps(ey);
+	__m256 const wz = _mm256_loadu_ps(ez);
+	__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	for (p = 0; p < count; ++p) {
+		__m256 const nx = _mm256_set1_ps(planes[p][0]), ny = _mm256_set1_ps(planes[p][1]);
+		__m256 const nz = _mm256_set1_ps(planes[p][2]);
+		__m256 d = LINMATH_H_MADD256_PS(nx, vx, _mm256_set1_ps(planes[p][3]));
+		d = LINMATH_H_MADD256_PS(ny, vy, d);
+		d = LINMATH_H_MADD256_PS(nz, vz, d);
+		d = LINMATH_H_MADD256_PS(_mm256_and_ps(nx, abs_mask), wx, d);
+		d = LINMATH_H_MADD256_PS(_mm256_and_ps(ny, abs_mask), wy, d);
+		d = LINMATH_H_MADD256_PS(_mm256_and_ps(nz, abs_mask), wz, d);
+		inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+	}
+	mask = (unsigned int)_mm256_movemask_ps(inside);
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2
+	__m128 const abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	int h;
+	for (h = 0; h < 8; h += 4) {
+		__m128 const vx = _mm_loadu_ps(cx + h);
+		__m128 const vy = _mm_loadu_ps(cy + h);
+		__m128 const vz = _mm_loadu_ps(cz + h);
+		__m128 const wx = _mm_loadu_ps(ex + h);
+		__m128 const wy = _mm_loadu_ps(ey + h);
+		__m128 const wz = _mm_loadu_ps(ez + h);
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (p = 0; p < count; ++p) {
+			__m128 const nx = _mm_set1_ps(planes[p][0]), ny = _mm_set1_ps(planes[p][1]), nz = _mm_set1_ps(planes[p][2]);
+			__m128 d = LINMATH_H_MADD_PS(nx, vx, _mm_set1_ps(planes[p][3]));
+			d = LINMATH_H_MADD_PS(ny, vy, d);
+			d = LINMATH_H_MADD_PS(nz, vz, d);
+			d = LINMATH_H_MADD_PS(_mm_and_ps(nx, abs_mask), wx, d);
+			d = LINMATH_H_MADD_PS(_mm_and_ps(ny, abs_mask), wy, d);
+			d = LINMATH_H_MADD_PS(_mm_and_ps(nz, abs_mask), wz, d);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+		}
+		mask |= (unsigned int)_mm_movemask_ps(inside) << h;
+	}
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	int h;
+	for (h = 0; h < 8; h += 4) {
+		float32x4_t const vx = vld1q_f32(cx + h);
+		float32x4_t const vy = vld1q_f32(cy + h);
+		float32x4_t const vz = vld1q_f32(cz + h);
+		float32x4_t const wx = vld1q_f32(ex + h);
+		float32x4_t const wy = vld1q_f32(ey + h);
+		float32x4_t const wz = vld1q_f32(ez + h);
+		uint32x4_t inside = vdupq_n_u32(0xFFFFFFFFu);
+		for (p = 0; p < count; ++p) {
+			float32x4_t d = LINMATH_H_MADD_PS(vdupq_n_f32(planes[p][0]), vx, vdupq_n_f32(planes[p][3]));
+			d = LINMATH_H_MADD_PS(vdupq_n_f32(planes[p][1]), vy, d);
+			d = LINMATH_H_MADD_PS(vdupq_n_f32(planes[p][2]), vz, d);
+			d = LINMATH_H_MADD_PS(vdupq_n_f32(fabsf(planes[p][0])), wx, d);
+			d = LINMATH_H_MADD_PS(vdupq_n_f32(fabsf(planes[p][1])), wy, d);
+			d = LINMATH_H_MADD_PS(vdupq_n_f32(fabsf(planes[p][2])), wz, d);
+			inside = vandq_u32(inside, vcgeq_f32(d, vdupq_n_f32(0.f)));
+		}
+		mask |= planes_movemask_neon(inside) << h;
+	}
+#else
+	int k;
+	for (k = 0; k < 8; ++k) {
+		unsigned int inside = 1;
+		for (p = 0; p < count; ++p) {
+			float const d = planes[p][0] * cx[k] + planes[p][1] * cy[k] + planes[p][2] * cz[k] + planes[p][3];
+			float const e = fabsf(planes[p][0]) * ex[k] + fabsf(planes[p][1]) * ey[k] + fabsf(planes[p][2]) * ez[k];
+			inside &= d + e >= 0.f;
+		}
+		mask |= inside << k;
+	}
+#endif
+	return mask;
+}
+
+#endif
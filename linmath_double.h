@@ -0,0 +1,155 @@
+#pragma once
+#ifndef LINMATH_DOUBLE_H
+#define LINMATH_DOUBLE_H
+
+#include "linmath.h"
+
+/* Double-precision vectors and matrices on top of linmath.h, for world
+ * positions that float can't hold: at 10^7 units from the origin a float
+ * steps in whole units, so anything drawn there jitters as it moves. They
+ * follow linmath's layout (dmat4x4 is column-major, M[column][row]) and
+ * names with a d in front, but only as far as the CPU needs them: placing
+ * things and building views. Nothing in double reaches the GPU.
+ *
+ * Camera-relative rendering is what bridges the two: positions are kept
+ * in double and turned into float only as differences from a nearby
+ * origin (vec3_from_dvec3_sub), and a world-space matrix becomes one over
+ * such differences with mat4x4_from_dmat4x4_relative. The subtraction
+ * happens in double, so the float that comes out is as exact as a small
+ * number can be, wherever in the world the two positions are. */
+
+#define LINMATH_H_DEFINE_DVEC(n) \
+typedef double dvec##n[n]; \
+LINMATH_H_FUNC void dvec##n##_add(dvec##n r, dvec##n const a, dvec##n const b) \
+{ \
+	int i; \
+	for(i=0; i<n; ++i) \
+		r[i] = a[i] + b[i]; \
+} \
+LINMATH_H_FUNC void dvec##n##_sub(dvec##n r, dvec##n const a, dvec##n const b) \
+{ \
+	int i; \
+	for(i=0; i<n; ++i) \
+		r[i] = a[i] - b[i]; \
+} \
+LINMATH_H_FUNC void dvec##n##_scale(dvec##n r, dvec##n const v, double const s) \
+{ \
+	int i; \
+	for(i=0; i<n; ++i) \
+		r[i] = v[i] * s; \
+} \
+LINMATH_H_FUNC double dvec##n##_mul_inner(dvec##n const a, dvec##n const b) \
+{ \
+	double p = 0.; \
+	int i; \
+	for(i=0; i<n; ++i) \
+		p += b[i]*a[i]; \
+	return p; \
+} \
+LINMATH_H_FUNC double dvec##n##_len(dvec##n const v) \
+{ \
+	return sqrt(dvec##n##_mul_inner(v,v)); \
+} \
+LINMATH_H_FUNC void dvec##n##_dup(dvec##n r, dvec##n const src) \
+{ \
+	int i; \
+	for(i=0; i<n; ++i) \
+		r[i] = src[i]; \
+} \
+LINMATH_H_FUNC void dvec##n##_from_vec##n(dvec##n r, vec##n const v) \
+{ \
+	int i; \
+	for(i=0; i<n; ++i) \
+		r[i] = v[i]; \
+} \
+/* r = a - b, subtracted in double and only then rounded to float */ \
+LINMATH_H_FUNC void vec##n##_from_dvec##n##_sub(vec##n r, dvec##n const a, dvec##n const b) \
+{ \
+	int i; \
+	for(i=0; i<n; ++i) \
+		r[i] = (float)(a[i] - b[i]); \
+}
+
+LINMATH_H_DEFINE_DVEC(2)
+LINMATH_H_DEFINE_DVEC(3)
+LINMATH_H_DEFINE_DVEC(4)
+
+typedef dvec4 dmat4x4[4];
+LINMATH_H_FUNC void dmat4x4_identity(dmat4x4 M)
+{
+	int i, j;
+	for (i = 0; i < 4; ++i)
+		for (j = 0; j < 4; ++j)
+			M[i][j] = i == j ? 1. : 0.;
+}
+LINMATH_H_FUNC void dmat4x4_dup(dmat4x4 M, dmat4x4 const N)
+{
+	int i;
+	for (i = 0; i < 4; ++i)
+		dvec4_dup(M[i], N[i]);
+}
+LINMATH_H_FUNC void dmat4x4_from_mat4x4(dmat4x4 M, mat4x4 const N)
+{
+	int i;
+	for (i = 0; i < 4; ++i)
+		dvec4_from_vec4(M[i], N[i]);
+}
+LINMATH_H_FUNC void mat4x4_from_dmat4x4(mat4x4 M, dmat4x4 const N)
+{
+	int i, j;
+	for (i = 0; i < 4; ++i)
+		for (j = 0; j < 4; ++j)
+			M[i][j] = (float)N[i][j];
+}
+/* M = a * b; M may alias either */
+LINMATH_H_FUNC void dmat4x4_mul(dmat4x4 M, dmat4x4 const a, dmat4x4 const b)
+{
+	dmat4x4 temp;
+	int k, r, c;
+	for (c = 0; c < 4; ++c)
+		for (r = 0; r < 4; ++r) {
+			temp[c][r] = 0.;
+			for (k = 0; k < 4; ++k)
+				temp[c][r] += a[k][r] * b[c][k];
+		}
+	dmat4x4_dup(M, temp);
+}
+LINMATH_H_FUNC void dmat4x4_mul_dvec4(dvec4 r, dmat4x4 const M, dvec4 const v)
+{
+	int i, j;
+	for (j = 0; j < 4; ++j) {
+		r[j] = 0.;
+		for (i = 0; i < 4; ++i)
+			r[j] += M[i][j] * v[i];
+	}
+}
+LINMATH_H_FUNC void dmat4x4_translate(dmat4x4 T, double x, double y, double z)
+{
+	dmat4x4_identity(T);
+	T[3][0] = x;
+	T[3][1] = y;
+	T[3][2] = z;
+}
+/* M = M * translate(x, y, z) */
+LINMATH_H_FUNC void dmat4x4_translate_in_place(dmat4x4 M, double x, double y, double z)
+{
+	int i;
+	for (i = 0; i < 4; ++i)
+		M[3][i] += M[0][i] * x + M[1][i] * y + M[2][i] * z;
+}
+/* R = M * translate(origin), in float: M, which takes world positions, as a
+ * matrix that takes positions relative to "origin" instead. Only the
+ * translation changes, and it is worked out in double, so a view whose eye
+ * is 10^7 units out comes back with the small translation of the eye from
+ * "origin" rather than two huge ones that no longer cancel in float. */
+LINMATH_H_FUNC void mat4x4_from_dmat4x4_relative(mat4x4 R, dmat4x4 const M, dvec3 const origin)
+{
+	int i, j;
+	for (i = 0; i < 3; ++i)
+		for (j = 0; j < 4; ++j)
+			R[i][j] = (float)M[i][j];
+	for (j = 0; j < 4; ++j)
+		R[3][j] = (float)(M[3][j] + M[0][j] * origin[0] + M[1][j] * origin[1] + M[2][j] * origin[2]);
+}
+
+#endif
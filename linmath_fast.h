@@ -0,0 +1,301 @@
+#pragma once
+#ifndef LINMATH_FAST_H
+#define LINMATH_FAST_H
+
+#include "linmath.h"
+#include "linmath_affine.h"
+#include "linmath_batch.h"
+
+/* Opt-in fast math on top of linmath.h: polynomial sine/cosine and a
+ * reciprocal square root estimate, and batch versions of them and of the
+ * linmath_batch.h kernels that spend their time in sinf/cosf/sqrtf. Nothing
+ * in linmath.h changes; callers pick these by name where the accuracy below
+ * is enough (animation, model matrices, normals), and keep libm where it
+ * isn't.
+ *
+ * The gain is in the batches, four lanes at a time and without libm's call
+ * and range checks per element. One angle or one vector at a time the
+ * scalar kernels are within a few percent of glibc's sincosf and of
+ * sqrtss + divss, so mat4x4_rotate, quat_rotate and vec*_norm keep libm.
+ *
+ * fast_sincos reduces x to [-pi/4, pi/4] by the nearest multiple of pi/2
+ * (pi/2 split in three parts, Cody-Waite) and evaluates degree 7 and 8
+ * polynomials there (the Cephes sinf/cosf minimax coefficients). For
+ * |x| <= FAST_SINCOS_MAX the absolute error of either result is at most
+ * 1.2e-7, two float ulps just below 1 (sinf/cosf: 3e-8); beyond it
+ * the reduction loses bits, and past 2^31 / (2/pi) it is undefined.
+ *
+ * fast_rsqrt is 1/sqrt(x) for x > 0 (normal, finite) with a relative error
+ * of at most 3e-7, against 1.2e-7 for 1.f / sqrtf(x) (two roundings):
+ * the SSE rsqrt estimate (12 bits) refined by one Newton-Raphson step; NEON
+ * refines its 8-bit estimate with two, the scalar code the 0x5f375a86 bit
+ * trick with three. x = 0 gives NaN or a huge finite value rather than inf.
+ *
+ * The batch versions work four at a time with SSE2 or AVX; NEON and scalar
+ * targets run the scalar kernels per element.
+ *
+ * Angles that all advance by the same amount (many objects spinning at one
+ * rate) needn't go through sin/cos at all: kept as their sines and cosines,
+ * sincos_rotate_batch turns them by angle addition, and
+ * mat3x4_translate_rotate_Z_batch_sincos builds matrices a further angle on,
+ * with that angle's sine and cosine computed once for the whole batch.
+ *
+ * Under LINMATH_DETERMINISTIC the scalar fast_sincos rounds to the nearest
+ * quadrant the way the SSE lanes do, so every backend gives the same bits,
+ * and fast_rsqrt is 1.f / sqrtf(x): the rsqrt estimates aren't specified
+ * to the bit and differ between CPU vendors. */
+
+#define FAST_SINCOS_MAX 8192.f
+
+/* pi/2 = FAST_PIO2_1 + FAST_PIO2_2 + FAST_PIO2_3; the first two have few
+ * enough bits that j * part is exact for the j that FAST_SINCOS_MAX allows */
+#define FAST_2_OVER_PI 0.636619772367581343f
+#define FAST_PIO2_1 1.5703125f
+#define FAST_PIO2_2 4.837512969970703125e-4f
+#define FAST_PIO2_3 7.54978995489188216e-8f
+#define FAST_SIN_C1 -1.6666654611e-1f
+#define FAST_SIN_C2 8.3321608736e-3f
+#define FAST_SIN_C3 -1.9515295891e-4f
+#define FAST_COS_C1 4.166664568298827e-2f
+#define FAST_COS_C2 -1.388731625493765e-3f
+#define FAST_COS_C3 2.443315711809948e-5f
+
+LINMATH_H_FUNC void fast_sincos(float x, float* s, float* c)
+{
+#ifdef LINMATH_DETERMINISTIC
+	/* x * 2/pi to the nearest integer, ties to even: 1.5 * 2^23 leaves no
+	 * fraction bits */
+	float const j = (x * FAST_2_OVER_PI + 12582912.f) - 12582912.f;
+	int const q = (int)j;
+#else
+	int const q = (int)(x * FAST_2_OVER_PI + (x < 0.f ? -.5f : .5f));
+	float const j = (float)q;
+#endif
+	float const y = ((x - j * FAST_PIO2_1) - j * FAST_PIO2_2) - j * FAST_PIO2_3;
+	float const y2 = y * y;
+	union { float f; unsigned int u; } sp, cp, rs, rc;
+	unsigned int const swap = 0u - (unsigned int)(q & 1);
+	sp.f = y + y * y2 * (FAST_SIN_C1 + y2 * (FAST_SIN_C2 + y2 * FAST_SIN_C3));
+	cp.f = 1.f - .5f * y2 + y2 * y2 * (FAST_COS_C1 + y2 * (FAST_COS_C2 + y2 * FAST_COS_C3));
+	/* Quadrant q: sin x = sin(y + q pi/2), so odd quadrants swap the two and
+	 * quadrants 2, 3 (sine) and 1, 2 (cosine) negate them. Masks and sign
+	 * bits rather than branches, which random angles would mispredict. */
+	rs.u = ((cp.u & swap) | (sp.u & ~swap)) ^ ((unsigned int)(q & 2) << 30);
+	rc.u = ((sp.u & swap) | (cp.u & ~swap)) ^ ((unsigned int)((q + 1) & 2) << 30);
+	*s = rs.f;
+	*c = rc.f;
+}
+LINMATH_H_FUNC float fast_rsqrt(float x)
+{
+#if defined(LINMATH_DETERMINISTIC)
+	return 1.f / sqrtf(x);
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const v = _mm_set_ss(x);
+	__m128 const y = _mm_rsqrt_ss(v);
+	__m128 const e = _mm_mul_ss(_mm_mul_ss(_mm_mul_ss(v, _mm_set_ss(.5f)), y), y);
+	return _mm_cvtss_f32(_mm_mul_ss(y, _mm_sub_ss(_mm_set_ss(1.5f), e)));
+#elif LINMATH_H_SIMD == LINMATH_H_SIMD_NEON
+	float32x2_t const v = vdup_n_f32(x);
+	float32x2_t y = vrsqrte_f32(v);
+	y = vmul_f32(y, vrsqrts_f32(vmul_f32(v, y), y));
+	y = vmul_f32(y, vrsqrts_f32(vmul_f32(v, y), y));
+	return vget_lane_f32(y, 0);
+#else
+	union { float f; unsigned int u; } bits;
+	float const half = .5f * x;
+	float y;
+	bits.f = x;
+	bits.u = 0x5f375a86u - (bits.u >> 1);
+	y = bits.f;
+	y = y * (1.5f - half * y * y);
+	y = y * (1.5f - half * y * y);
+	y = y * (1.5f - half * y * y);
+	return y;
+#endif
+}
+
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+/* fast_sincos on four lanes; rounds to the nearest quadrant with the
+ * current (default: nearest-even) rounding mode instead of half away from
+ * zero, which picks the other equally valid reduction on exact ties */
+LINMATH_H_FUNC void fast_sincos_ps(__m128 x, __m128* s, __m128* c)
+{
+	__m128i const one = _mm_set1_epi32(1);
+	__m128i const two = _mm_set1_epi32(2);
+	__m128i const q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(FAST_2_OVER_PI)));
+	__m128 const j = _mm_cvtepi32_ps(q);
+	__m128 y = LINMATH_H_MADD_PS(j, _mm_set1_ps(-FAST_PIO2_1), x);
+	y = LINMATH_H_MADD_PS(j, _mm_set1_ps(-FAST_PIO2_2), y);
+	y = LINMATH_H_MADD_PS(j, _mm_set1_ps(-FAST_PIO2_3), y);
+	__m128 const y2 = _mm_mul_ps(y, y);
+	__m128 sp = LINMATH_H_MADD_PS(y2, _mm_set1_ps(FAST_SIN_C3), _mm_set1_ps(FAST_SIN_C2));
+	sp = LINMATH_H_MADD_PS(y2, sp, _mm_set1_ps(FAST_SIN_C1));
+	sp = LINMATH_H_MADD_PS(_mm_mul_ps(y, y2), sp, y);
+	__m128 cp = LINMATH_H_MADD_PS(y2, _mm_set1_ps(FAST_COS_C3), _mm_set1_ps(FAST_COS_C2));
+	cp = LINMATH_H_MADD_PS(y2, cp, _mm_set1_ps(FAST_COS_C1));
+	cp = LINMATH_H_MADD_PS(_mm_mul_ps(y2, y2), cp, LINMATH_H_MADD_PS(y2, _mm_set1_ps(-.5f), _mm_set1_ps(1.f)));
+	__m128 const swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+	__m128 const sign_s = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+	__m128 const sign_c = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+	*s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cp), _mm_andnot_ps(swap, sp)), sign_s);
+	*c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sp), _mm_andnot_ps(swap, cp)), sign_c);
+}
+LINMATH_H_FUNC __m128 fast_rsqrt_ps(__m128 x)
+{
+#ifdef LINMATH_DETERMINISTIC
+	return _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(x));
+#else
+	__m128 const y = _mm_rsqrt_ps(x);
+	__m128 const e = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(x, _mm_set1_ps(.5f)), y), y);
+	return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), e));
+#endif
+}
+#endif
+
+/* s[i], c[i] = sin, cos of x[i]; s or c may be NULL */
+LINMATH_H_FUNC void fast_sincos_batch(float* LINMATH_H_RESTRICT s, float* LINMATH_H_RESTRICT c,
+	float const* LINMATH_H_RESTRICT x, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	for (; i < (n & ~(size_t)3); i += 4) {
+		__m128 vs, vc;
+		fast_sincos_ps(_mm_loadu_ps(x + i), &vs, &vc);
+		if (s)
+			_mm_storeu_ps(s + i, vs);
+		if (c)
+			_mm_storeu_ps(c + i, vc);
+	}
+#endif
+	for (; i < n; ++i) {
+		float vs, vc;
+		fast_sincos(x[i], &vs, &vc);
+		if (s)
+			s[i] = vs;
+		if (c)
+			c[i] = vc;
+	}
+}
+/* r[i] = 1 / sqrt(x[i]); r may be x */
+LINMATH_H_FUNC void fast_rsqrt_batch(float* r, float const* x, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	for (; i < (n & ~(size_t)3); i += 4)
+		_mm_storeu_ps(r + i, fast_rsqrt_ps(_mm_loadu_ps(x + i)));
+#endif
+	for (; i < n; ++i)
+		r[i] = fast_rsqrt(x[i]);
+}
+/* Normalizes n 3-vectors held as separate x, y, z arrays, in place */
+LINMATH_H_FUNC void vec3_norm_soa_fast(float* LINMATH_H_RESTRICT x, float* LINMATH_H_RESTRICT y,
+	float* LINMATH_H_RESTRICT z, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	for (; i < (n & ~(size_t)3); i += 4) {
+		__m128 const vx = _mm_loadu_ps(x + i);
+		__m128 const vy = _mm_loadu_ps(y + i);
+		__m128 const vz = _mm_loadu_ps(z + i);
+		__m128 const k = fast_rsqrt_ps(LINMATH_H_MADD_PS(vz, vz, LINMATH_H_MADD_PS(vy, vy, _mm_mul_ps(vx, vx))));
+		_mm_storeu_ps(x + i, _mm_mul_ps(vx, k));
+		_mm_storeu_ps(y + i, _mm_mul_ps(vy, k));
+		_mm_storeu_ps(z + i, _mm_mul_ps(vz, k));
+	}
+#endif
+	for (; i < n; ++i) {
+		float const k = fast_rsqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+		x[i] *= k;
+		y[i] *= k;
+		z[i] *= k;
+	}
+}
+
+/* The sines and cosines of the translate_rotate_Z batches are computed a
+ * block at a time into the stack, then the matrices are written from them */
+#define LINMATH_H_FAST_BLOCK 64
+
+/* mat4x4_translate_rotate_Z_batch with fast_sincos */
+LINMATH_H_FUNC void mat4x4_translate_rotate_Z_batch_fast(mat4x4* LINMATH_H_RESTRICT R, float const* LINMATH_H_RESTRICT tx,
+	float const* LINMATH_H_RESTRICT ty, float const* LINMATH_H_RESTRICT tz,
+	float const* LINMATH_H_RESTRICT angle, float k, size_t n)
+{
+	float s[LINMATH_H_FAST_BLOCK], c[LINMATH_H_FAST_BLOCK];
+	size_t base, i;
+	for (base = 0; base < n; base += LINMATH_H_FAST_BLOCK) {
+		size_t const m = n - base < LINMATH_H_FAST_BLOCK ? n - base : LINMATH_H_FAST_BLOCK;
+		fast_sincos_batch(s, c, angle + base, m);
+		for (i = 0; i < m; ++i) {
+			float const ks = k * s[i], kc = k * c[i];
+			mat4x4* const M = &R[base + i];
+			(*M)[0][0] = kc;  (*M)[0][1] = ks;  (*M)[0][2] = 0.f; (*M)[0][3] = 0.f;
+			(*M)[1][0] = -ks; (*M)[1][1] = kc;  (*M)[1][2] = 0.f; (*M)[1][3] = 0.f;
+			(*M)[2][0] = 0.f; (*M)[2][1] = 0.f; (*M)[2][2] = k;   (*M)[2][3] = 0.f;
+			(*M)[3][0] = tx[base + i];
+			(*M)[3][1] = ty[base + i];
+			(*M)[3][2] = tz ? tz[base + i] : 0.f;
+			(*M)[3][3] = 1.f;
+		}
+	}
+}
+/* mat3x4_translate_rotate_Z_batch with fast_sincos */
+LINMATH_H_FUNC void mat3x4_translate_rotate_Z_batch_fast(mat3x4* LINMATH_H_RESTRICT R, float const* LINMATH_H_RESTRICT tx,
+	float const* LINMATH_H_RESTRICT ty, float const* LINMATH_H_RESTRICT tz,
+	float const* LINMATH_H_RESTRICT angle, float k, size_t n)
+{
+	float s[LINMATH_H_FAST_BLOCK], c[LINMATH_H_FAST_BLOCK];
+	size_t base, i;
+	for (base = 0; base < n; base += LINMATH_H_FAST_BLOCK) {
+		size_t const m = n - base < LINMATH_H_FAST_BLOCK ? n - base : LINMATH_H_FAST_BLOCK;
+		fast_sincos_batch(s, c, angle + base, m);
+		for (i = 0; i < m; ++i) {
+			float const ks = k * s[i], kc = k * c[i];
+			mat3x4* const M = &R[base + i];
+			(*M)[0][0] = kc;  (*M)[0][1] = -ks; (*M)[0][2] = 0.f; (*M)[0][3] = tx[base + i];
+			(*M)[1][0] = ks;  (*M)[1][1] = kc;  (*M)[1][2] = 0.f; (*M)[1][3] = ty[base + i];
+			(*M)[2][0] = 0.f; (*M)[2][1] = 0.f; (*M)[2][2] = k;   (*M)[2][3] = tz ? tz[base + i] : 0.f;
+		}
+	}
+}
+
+/* Turns the angles whose sines and cosines are s[i], c[i] by one more angle
+ * d, given as sd, cd = sin d, cos d. Each turn rounds, by up to 2.4e-7 in
+ * the angle and in the length of (s, c), and repeated turns add it up:
+ * recompute s and c from the angles every thousand turns or so. */
+LINMATH_H_FUNC void sincos_rotate_batch(float* LINMATH_H_RESTRICT s, float* LINMATH_H_RESTRICT c, float sd, float cd,
+	size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const vsd = _mm_set1_ps(sd), vcd = _mm_set1_ps(cd);
+	for (; i < (n & ~(size_t)3); i += 4) {
+		__m128 const vs = _mm_loadu_ps(s + i);
+		__m128 const vc = _mm_loadu_ps(c + i);
+		_mm_storeu_ps(s + i, _mm_add_ps(_mm_mul_ps(vs, vcd), _mm_mul_ps(vc, vsd)));
+		_mm_storeu_ps(c + i, _mm_sub_ps(_mm_mul_ps(vc, vcd), _mm_mul_ps(vs, vsd)));
+	}
+#endif
+	for (; i < n; ++i) {
+		float const si = s[i], ci = c[i];
+		s[i] = si * cd + ci * sd;
+		c[i] = ci * cd - si * sd;
+	}
+}
+/* mat3x4_translate_rotate_Z_batch of angle[i] + d, from s[i], c[i] = sin,
+ * cos of angle[i] and sd, cd = sin d, cos d: no trigonometry per matrix */
+LINMATH_H_FUNC void mat3x4_translate_rotate_Z_batch_sincos(mat3x4* LINMATH_H_RESTRICT R, float const* LINMATH_H_RESTRICT tx,
+	float const* LINMATH_H_RESTRICT ty, float const* LINMATH_H_RESTRICT tz, float const* LINMATH_H_RESTRICT s,
+	float const* LINMATH_H_RESTRICT c, float sd, float cd, float k, size_t n)
+{
+	float const ksd = k * sd, kcd = k * cd;
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		float const ks = s[i] * kcd + c[i] * ksd, kc = c[i] * kcd - s[i] * ksd;
+		mat3x4* const M = &R[i];
+		(*M)[0][0] = kc;  (*M)[0][1] = -ks; (*M)[0][2] = 0.f; (*M)[0][3] = tx[i];
+		(*M)[1][0] = ks;  (*M)[1][1] = kc;  (*M)[1][2] = 0.f; (*M)[1][3] = ty[i];
+		(*M)[2][0] = 0.f; (*M)[2][1] = 0.f; (*M)[2][2] = k;   (*M)[2][3] = tz ? tz[i] : 0.f;
+	}
+}
+
+#endif
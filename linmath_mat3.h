@@ -0,0 +1,304 @@
+#pragma once
+#ifndef LINMATH_MAT3_H
+#define LINMATH_MAT3_H
+
+#include <stddef.h>
+#include "linmath.h"
+#include "linmath_batch.h"
+#include "linmath_quat.h"
+#include "linmath_trs.h"
+
+/* 3x3 matrices on top of linmath.h, for normal matrices and for taking
+ * model matrices apart. A mat3x3 is column-major like mat4x4 (M[column][row])
+ * and 36 bytes; mat3x3_from_mat4x4 is a 4x4's upper-left 3x3.
+ *
+ * Normals transform by the inverse transpose of the model matrix's 3x3.
+ * With columns a, b and c its inverse's rows are b x c, c x a and a x b over
+ * the determinant a . (b x c), so the inverse transpose has those as its
+ * columns: three cross products, a dot and one division (mat3x3_normal),
+ * against mat4x4_invert's full cofactor expansion and a mat4x4_transpose.
+ * When the 3x3 is a rotation times a uniform scale k (every model matrix the
+ * scene draws) it is its own inverse transpose up to scale, and the exact
+ * one is M / k^2: one dot and a division (mat3x3_normal_uniform). Normals
+ * are renormalised after the transform anyway, so either is fine for
+ * shading; only the general one is right under non-uniform scale.
+ *
+ * trs_from_mat4x4 undoes trs_to_mat4x4 (linmath_trs.h): the translation is
+ * the last column, each scale its column's length and the rotation the
+ * quaternion of the columns divided by them. A mirroring matrix (negative
+ * determinant) gets a negative x scale, so the rotation stays proper. The
+ * matrix must have no shear or zero scale: translate * rotate * scale is
+ * what comes apart exactly.
+ *
+ * The batch forms do four matrices per iteration with SSE2 or AVX: columns
+ * 0-2 of four mat4x4s are transposed so each register holds one element of
+ * all four, the arithmetic is the one-at-a-time functions' in the same
+ * order, and the results are transposed back. NEON and scalar targets run
+ * the one-at-a-time functions per element. Inputs are LINMATH_BATCH_ALIGN
+ * aligned (linmath_batch.h); outputs may be at any float boundary. The
+ * rotations of trs_from_mat4x4_batch are quat_from_mat4x4_soa's, so on
+ * pivot ties their sign can differ from trs_from_mat4x4's. */
+
+typedef vec3 mat3x3[3];
+
+LINMATH_H_FUNC void mat3x3_identity(mat3x3 M)
+{
+	int i, j;
+	for (i = 0; i < 3; ++i)
+		for (j = 0; j < 3; ++j)
+			M[i][j] = i == j ? 1.f : 0.f;
+}
+LINMATH_H_FUNC void mat3x3_dup(mat3x3 M, mat3x3 const N)
+{
+	int i;
+	for (i = 0; i < 3; ++i)
+		vec3_dup(M[i], N[i]);
+}
+LINMATH_H_FUNC void mat3x3_from_mat4x4(mat3x3 M, mat4x4 const A)
+{
+	int c, r;
+	for (c = 0; c < 3; ++c)
+		for (r = 0; r < 3; ++r)
+			M[c][r] = A[c][r];
+}
+/* M may alias N */
+LINMATH_H_FUNC void mat3x3_transpose(mat3x3 M, mat3x3 const N)
+{
+	mat3x3 T;
+	int c, r;
+	for (c = 0; c < 3; ++c)
+		for (r = 0; r < 3; ++r)
+			T[c][r] = N[r][c];
+	mat3x3_dup(M, T);
+}
+/* M = a * b; M may alias either */
+LINMATH_H_FUNC void mat3x3_mul(mat3x3 M, mat3x3 const a, mat3x3 const b)
+{
+	mat3x3 T;
+	int c, r;
+	for (c = 0; c < 3; ++c)
+		for (r = 0; r < 3; ++r)
+			T[c][r] = a[0][r] * b[c][0] + a[1][r] * b[c][1] + a[2][r] * b[c][2];
+	mat3x3_dup(M, T);
+}
+/* r = M * v; r must not alias v */
+LINMATH_H_FUNC void mat3x3_mul_vec3(vec3 r, mat3x3 const M, vec3 const v)
+{
+	int i;
+	for (i = 0; i < 3; ++i)
+		r[i] = M[0][i] * v[0] + M[1][i] * v[1] + M[2][i] * v[2];
+}
+LINMATH_H_FUNC float mat3x3_determinant(mat3x3 const M)
+{
+	vec3 bc;
+	vec3_mul_cross(bc, M[1], M[2]);
+	return vec3_mul_inner(M[0], bc);
+}
+
+/* The inverse transpose of the 3x3 of columns a, b and c: (b x c, c x a, a x b) / det */
+LINMATH_H_FUNC void mat3x3_cofactor_columns(mat3x3 N, float const* a, float const* b, float const* c)
+{
+	vec3 bc, ca, ab;
+	float k;
+	int i;
+	vec3_mul_cross(bc, b, c);
+	vec3_mul_cross(ca, c, a);
+	vec3_mul_cross(ab, a, b);
+	k = 1.f / vec3_mul_inner(a, bc);
+	for (i = 0; i < 3; ++i) {
+		N[0][i] = bc[i] * k;
+		N[1][i] = ca[i] * k;
+		N[2][i] = ab[i] * k;
+	}
+}
+/* M's inverse; M must be invertible, and may alias N */
+LINMATH_H_FUNC void mat3x3_invert(mat3x3 M, mat3x3 const N)
+{
+	mat3x3 T;
+	mat3x3_cofactor_columns(T, N[0], N[1], N[2]);
+	mat3x3_transpose(M, T);
+}
+
+/* The normal matrix of model matrix M: its 3x3's inverse transpose, which must exist */
+LINMATH_H_FUNC void mat3x3_normal(mat3x3 N, mat4x4 const M)
+{
+	mat3x3_cofactor_columns(N, M[0], M[1], M[2]);
+}
+/* mat3x3_normal for an M whose 3x3 is a rotation times a uniform scale: the 3x3 over the scale squared */
+LINMATH_H_FUNC void mat3x3_normal_uniform(mat3x3 N, mat4x4 const M)
+{
+	float const k = 1.f / vec3_mul_inner(M[0], M[0]);
+	int c, r;
+	for (c = 0; c < 3; ++c)
+		for (r = 0; r < 3; ++r)
+			N[c][r] = M[c][r] * k;
+}
+
+/* The translation, rotation and per-axis scale that trs_to_mat4x4 would turn into M */
+LINMATH_H_FUNC void trs_from_mat4x4(trs* r, mat4x4 const M)
+{
+	mat4x4 R;
+	vec3 bc;
+	int c, k;
+	for (c = 0; c < 3; ++c)
+		r->s[c] = sqrtf(vec3_mul_inner(M[c], M[c]));
+	vec3_mul_cross(bc, M[1], M[2]);
+	if (vec3_mul_inner(M[0], bc) < 0.f)
+		r->s[0] = -r->s[0];
+	for (c = 0; c < 3; ++c) {
+		for (k = 0; k < 3; ++k)
+			R[c][k] = M[c][k] / r->s[c];
+		R[c][3] = 0.f;
+		r->t[c] = M[3][c];
+	}
+	R[3][0] = R[3][1] = R[3][2] = 0.f;
+	R[3][3] = 1.f;
+	quat_from_mat4x4_fast(r->r, R);
+}
+
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+/* Column "c" of M[i..i+3], transposed: r[k] is row k of the four */
+LINMATH_H_FUNC void mat3x3_load_column4_ps(__m128 r[4], mat4x4 const* M, size_t i, int c)
+{
+	r[0] = _mm_load_ps(M[i][c]);
+	r[1] = _mm_load_ps(M[i + 1][c]);
+	r[2] = _mm_load_ps(M[i + 2][c]);
+	r[3] = _mm_load_ps(M[i + 3][c]);
+	_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+}
+/* a x b for four vectors at once, x y z in a register each */
+LINMATH_H_FUNC void mat3x3_cross4_ps(__m128 r[3], __m128 const a[3], __m128 const b[3])
+{
+	r[0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+	r[1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+	r[2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+}
+LINMATH_H_FUNC __m128 mat3x3_dot4_ps(__m128 const a[3], __m128 const b[3])
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])), _mm_mul_ps(a[2], b[2]));
+}
+/* N[i..i+3] from e[3 * column + row], each register one element of the four: their 144 bytes in order */
+LINMATH_H_FUNC void mat3x3_store4_ps(mat3x3* N, size_t i, __m128 e[9])
+{
+	int k;
+	_MM_TRANSPOSE4_PS(e[0], e[1], e[2], e[3]);
+	_MM_TRANSPOSE4_PS(e[4], e[5], e[6], e[7]);
+	for (k = 0; k < 4; ++k) {
+		float* const out = &N[i + k][0][0];
+		_mm_storeu_ps(out, e[k]);
+		_mm_storeu_ps(out + 4, e[4 + k]);
+	}
+	_mm_store_ss(&N[i][2][2], e[8]);
+	_mm_store_ss(&N[i + 1][2][2], _mm_shuffle_ps(e[8], e[8], _MM_SHUFFLE(1, 1, 1, 1)));
+	_mm_store_ss(&N[i + 2][2][2], _mm_shuffle_ps(e[8], e[8], _MM_SHUFFLE(2, 2, 2, 2)));
+	_mm_store_ss(&N[i + 3][2][2], _mm_shuffle_ps(e[8], e[8], _MM_SHUFFLE(3, 3, 3, 3)));
+}
+#endif
+
+/* N[i] = mat3x3_normal(M[i]) */
+LINMATH_H_FUNC void mat3x3_normal_batch(mat3x3* LINMATH_H_RESTRICT N, mat4x4 const* LINMATH_H_RESTRICT M, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const one = _mm_set1_ps(1.f);
+	for (; i + 4 <= n; i += 4) {
+		__m128 a[4], b[4], c[4], e[9];
+		__m128 k;
+		int r;
+		mat3x3_load_column4_ps(a, M, i, 0);
+		mat3x3_load_column4_ps(b, M, i, 1);
+		mat3x3_load_column4_ps(c, M, i, 2);
+		mat3x3_cross4_ps(e, b, c);
+		mat3x3_cross4_ps(e + 3, c, a);
+		mat3x3_cross4_ps(e + 6, a, b);
+		k = _mm_div_ps(one, mat3x3_dot4_ps(a, e));
+		for (r = 0; r < 9; ++r)
+			e[r] = _mm_mul_ps(e[r], k);
+		mat3x3_store4_ps(N, i, e);
+	}
+#endif
+	for (; i < n; ++i)
+		mat3x3_normal(N[i], M[i]);
+}
+
+/* N[i] = mat3x3_normal_uniform(M[i]) */
+LINMATH_H_FUNC void mat3x3_normal_uniform_batch(mat3x3* LINMATH_H_RESTRICT N, mat4x4 const* LINMATH_H_RESTRICT M,
+	size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const one = _mm_set1_ps(1.f);
+	for (; i + 4 <= n; i += 4) {
+		__m128 e[12];
+		__m128 k;
+		int r;
+		mat3x3_load_column4_ps(e, M, i, 0);
+		mat3x3_load_column4_ps(e + 3, M, i, 1);     /* over column 0's fourth row, which isn't needed */
+		mat3x3_load_column4_ps(e + 6, M, i, 2);
+		k = _mm_div_ps(one, mat3x3_dot4_ps(e, e));
+		for (r = 0; r < 9; ++r)
+			e[r] = _mm_mul_ps(e[r], k);
+		mat3x3_store4_ps(N, i, e);
+	}
+#endif
+	for (; i < n; ++i)
+		mat3x3_normal_uniform(N[i], M[i]);
+}
+
+/* r[i] = trs_from_mat4x4(M[i]) */
+LINMATH_H_FUNC void trs_from_mat4x4_batch(trs* LINMATH_H_RESTRICT r, mat4x4 const* LINMATH_H_RESTRICT M, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const sign = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+	for (; i + 4 <= n; i += 4) {
+		__m128 a[4], b[4], c[4], t[4], bc[3], s[3];
+		vec4a lanes[10];
+		quat_soa_ps q;
+		int k;
+		mat3x3_load_column4_ps(a, M, i, 0);
+		mat3x3_load_column4_ps(b, M, i, 1);
+		mat3x3_load_column4_ps(c, M, i, 2);
+		mat3x3_load_column4_ps(t, M, i, 3);
+		s[0] = _mm_sqrt_ps(mat3x3_dot4_ps(a, a));
+		s[1] = _mm_sqrt_ps(mat3x3_dot4_ps(b, b));
+		s[2] = _mm_sqrt_ps(mat3x3_dot4_ps(c, c));
+		mat3x3_cross4_ps(bc, b, c);
+		s[0] = _mm_xor_ps(s[0], _mm_and_ps(_mm_cmplt_ps(mat3x3_dot4_ps(a, bc), _mm_setzero_ps()), sign));
+		for (k = 0; k < 3; ++k) {
+			a[k] = _mm_div_ps(a[k], s[0]);
+			b[k] = _mm_div_ps(b[k], s[1]);
+			c[k] = _mm_div_ps(c[k], s[2]);
+		}
+		q = quat_from_columns_ps(a, b, c);
+		/* t, r and s lane by lane: 4 trs are 160 bytes, which no transpose lines up with */
+		_mm_store_ps(lanes[0], t[0]);
+		_mm_store_ps(lanes[1], t[1]);
+		_mm_store_ps(lanes[2], t[2]);
+		_mm_store_ps(lanes[3], q.x);
+		_mm_store_ps(lanes[4], q.y);
+		_mm_store_ps(lanes[5], q.z);
+		_mm_store_ps(lanes[6], q.w);
+		_mm_store_ps(lanes[7], s[0]);
+		_mm_store_ps(lanes[8], s[1]);
+		_mm_store_ps(lanes[9], s[2]);
+		for (k = 0; k < 4; ++k) {
+			trs* const o = &r[i + k];
+			o->t[0] = lanes[0][k];
+			o->t[1] = lanes[1][k];
+			o->t[2] = lanes[2][k];
+			o->r[0] = lanes[3][k];
+			o->r[1] = lanes[4][k];
+			o->r[2] = lanes[5][k];
+			o->r[3] = lanes[6][k];
+			o->s[0] = lanes[7][k];
+			o->s[1] = lanes[8][k];
+			o->s[2] = lanes[9][k];
+		}
+	}
+#endif
+	for (; i < n; ++i)
+		trs_from_mat4x4(&r[i], M[i]);
+}
+
+#endif
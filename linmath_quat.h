@@ -0,0 +1,443 @@
+#pragma once
+#ifndef LINMATH_QUAT_H
+#define LINMATH_QUAT_H
+
+#include <stddef.h>
+#include "linmath.h"
+#include "linmath_affine.h"
+#include "linmath_batch.h"
+
+/* Quaternion interpolation and conversion on top of linmath.h, one at a time
+ * and in batches. Animation blends every joint of every character through
+ * these, so the batch forms take structure-of-arrays quaternions (quat_soa:
+ * one float array per component, LINMATH_BATCH_ALIGN aligned) and do four
+ * per iteration with SSE2 or AVX; NEON and scalar targets run the same loops
+ * per element, written for the compiler to vectorise. Quaternions are x, y,
+ * z, w like linmath.h's, and every rotation must be unit length.
+ *
+ * Both interpolations go the short way round: b is negated when it's more
+ * than a half turn from a. quat_nlerp is the normalised lerp, the cheaper
+ * one, which eases in and out a little over wide arcs. quat_slerp is the
+ * constant-speed slerp without acos or sin: sin(t * theta) / sin(theta) is
+ * evaluated as Eberly's polynomial in t and cos(theta) (8 terms, "A Fast and
+ * Accurate Algorithm for Computing SLERP", 2011), whose t-only coefficients
+ * are computed once per call. The weights are within 1e-6 of the exact ones
+ * for rotations up to 120 degrees apart and within 3e-5 at a half turn.
+ *
+ * quat_from_mat4x4_fast replaces quat_from_mat4x4 on rotation matrices,
+ * and unlike it round-trips mat4x4_from_quat (linmath.h's pivot search never
+ * updates its running maximum). It is Shepperd's method: the largest of the
+ * four components comes from the diagonal, the other three from sums and
+ * differences of the off-diagonal pairs divided by it. One at a time it
+ * branches on the pivot, which is cheaper than building all four candidates
+ * while the branch predicts. quat_from_mat4x4_soa builds them four matrices
+ * at a time and picks by masks, with no branches: about even with the scalar
+ * loop when the pivots repeat, and well ahead when they don't (a large batch
+ * of unrelated rotations). Its pivot is the largest of the four squares, so
+ * on ties it can pick a different sign than the scalar one. */
+
+/* The sin(t * theta) / sin(theta) series, its last term scaled by Eberly's mu */
+#define LINMATH_QUAT_SLERP_TERMS 8
+#define LINMATH_QUAT_SLERP_MU 1.85298109240830f
+
+static const float quat_slerp_u[LINMATH_QUAT_SLERP_TERMS] = {
+	1.f / 3.f, 1.f / 10.f, 1.f / 21.f, 1.f / 36.f, 1.f / 55.f, 1.f / 78.f, 1.f / 105.f, LINMATH_QUAT_SLERP_MU / 136.f
+};
+static const float quat_slerp_v[LINMATH_QUAT_SLERP_TERMS] = {
+	1.f / 3.f, 2.f / 5.f, 3.f / 7.f, 4.f / 9.f, 5.f / 11.f, 6.f / 13.f, 7.f / 15.f, LINMATH_QUAT_SLERP_MU * 8.f / 17.f
+};
+
+/* The series' coefficients for a weight t: k[i] = u[i] * t^2 - v[i] */
+LINMATH_H_FUNC void quat_slerp_coefficients(float k[LINMATH_QUAT_SLERP_TERMS], float t)
+{
+	int i;
+	for (i = 0; i < LINMATH_QUAT_SLERP_TERMS; ++i)
+		k[i] = quat_slerp_u[i] * t * t - quat_slerp_v[i];
+}
+
+/* sin(t * theta) / sin(theta) for cos(theta) - 1 = xm1, from t's coefficients */
+LINMATH_H_FUNC float quat_slerp_weight(float const k[LINMATH_QUAT_SLERP_TERMS], float t, float xm1)
+{
+	float w = 1.f;
+	int i;
+	for (i = LINMATH_QUAT_SLERP_TERMS - 1; i >= 0; --i)
+		w = 1.f + k[i] * xm1 * w;
+	return t * w;
+}
+
+/* r = normalise(a * (1 - t) + b * t), b on a's side */
+LINMATH_H_FUNC void quat_nlerp(quat r, quat const a, quat const b, float t)
+{
+	float const w = quat_mul_inner(a, b) < 0.f ? -t : t;
+	quat q;
+	int i;
+	for (i = 0; i < 4; ++i)
+		q[i] = a[i] * (1.f - t) + b[i] * w;
+	quat_norm(r, q);
+}
+
+/* r = slerp(a, b, t), b on a's side */
+LINMATH_H_FUNC void quat_slerp(quat r, quat const a, quat const b, float t)
+{
+	float kt[LINMATH_QUAT_SLERP_TERMS], kd[LINMATH_QUAT_SLERP_TERMS];
+	float const dot = quat_mul_inner(a, b);
+	float const xm1 = (dot < 0.f ? -dot : dot) - 1.f;
+	float wa, wb;
+	int i;
+	quat_slerp_coefficients(kt, t);
+	quat_slerp_coefficients(kd, 1.f - t);
+	wa = quat_slerp_weight(kd, 1.f - t, xm1);
+	wb = quat_slerp_weight(kt, t, xm1) * (dot < 0.f ? -1.f : 1.f);
+	for (i = 0; i < 4; ++i)
+		r[i] = a[i] * wa + b[i] * wb;
+}
+
+/* M = [R(q) | t], rows as mat3x4 has them: translate(t) * mat4x4_from_quat(q) */
+LINMATH_H_FUNC void quat_to_mat3x4(mat3x4 M, quat const q, vec3 const t)
+{
+	float const x = q[0], y = q[1], z = q[2], w = q[3];
+	M[0][0] = 1.f - 2.f * (y * y + z * z);
+	M[0][1] = 2.f * (x * y - w * z);
+	M[0][2] = 2.f * (x * z + w * y);
+	M[0][3] = t[0];
+	M[1][0] = 2.f * (x * y + w * z);
+	M[1][1] = 1.f - 2.f * (x * x + z * z);
+	M[1][2] = 2.f * (y * z - w * x);
+	M[1][3] = t[1];
+	M[2][0] = 2.f * (x * z - w * y);
+	M[2][1] = 2.f * (y * z + w * x);
+	M[2][2] = 1.f - 2.f * (x * x + y * y);
+	M[2][3] = t[2];
+}
+
+/* The unit quaternion of M's upper 3x3, which must be a rotation (no scale).
+ * Its largest component is positive. */
+LINMATH_H_FUNC void quat_from_mat4x4_fast(quat q, mat4x4 const M)
+{
+	float const trace = M[0][0] + M[1][1] + M[2][2];
+	float s;
+	if (trace > 0.f) {
+		s = .5f / sqrtf(1.f + trace);
+		q[0] = (M[1][2] - M[2][1]) * s;
+		q[1] = (M[2][0] - M[0][2]) * s;
+		q[2] = (M[0][1] - M[1][0]) * s;
+		q[3] = .25f / s;
+	} else if (M[0][0] > M[1][1] && M[0][0] > M[2][2]) {
+		s = .5f / sqrtf(1.f + M[0][0] - M[1][1] - M[2][2]);
+		q[0] = .25f / s;
+		q[1] = (M[1][0] + M[0][1]) * s;
+		q[2] = (M[2][0] + M[0][2]) * s;
+		q[3] = (M[1][2] - M[2][1]) * s;
+	} else if (M[1][1] > M[2][2]) {
+		s = .5f / sqrtf(1.f - M[0][0] + M[1][1] - M[2][2]);
+		q[0] = (M[1][0] + M[0][1]) * s;
+		q[1] = .25f / s;
+		q[2] = (M[2][1] + M[1][2]) * s;
+		q[3] = (M[2][0] - M[0][2]) * s;
+	} else {
+		s = .5f / sqrtf(1.f - M[0][0] - M[1][1] + M[2][2]);
+		q[0] = (M[2][0] + M[0][2]) * s;
+		q[1] = (M[2][1] + M[1][2]) * s;
+		q[2] = .25f / s;
+		q[3] = (M[0][1] - M[1][0]) * s;
+	}
+}
+
+/* Structure-of-arrays quaternions: element i is (x[i], y[i], z[i], w[i]).
+ * A batch only reads the arrays of its inputs. */
+typedef struct quat_soa {
+	float* x;
+	float* y;
+	float* z;
+	float* w;
+} quat_soa;
+
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+/* Four quaternions' components, one register each */
+typedef struct quat_soa_ps {
+	__m128 x, y, z, w;
+} quat_soa_ps;
+
+LINMATH_H_FUNC quat_soa_ps quat_soa_load_ps(quat_soa q, size_t i)
+{
+	quat_soa_ps r;
+	r.x = _mm_load_ps(LINMATH_H_ASSUME_ALIGNED(q.x) + i);
+	r.y = _mm_load_ps(LINMATH_H_ASSUME_ALIGNED(q.y) + i);
+	r.z = _mm_load_ps(LINMATH_H_ASSUME_ALIGNED(q.z) + i);
+	r.w = _mm_load_ps(LINMATH_H_ASSUME_ALIGNED(q.w) + i);
+	return r;
+}
+LINMATH_H_FUNC void quat_soa_store_ps(quat_soa q, size_t i, quat_soa_ps r)
+{
+	_mm_store_ps(LINMATH_H_ASSUME_ALIGNED(q.x) + i, r.x);
+	_mm_store_ps(LINMATH_H_ASSUME_ALIGNED(q.y) + i, r.y);
+	_mm_store_ps(LINMATH_H_ASSUME_ALIGNED(q.z) + i, r.z);
+	_mm_store_ps(LINMATH_H_ASSUME_ALIGNED(q.w) + i, r.w);
+}
+LINMATH_H_FUNC __m128 quat_soa_dot_ps(quat_soa_ps a, quat_soa_ps b)
+{
+	return LINMATH_H_MADD_PS(a.w, b.w, LINMATH_H_MADD_PS(a.z, b.z, LINMATH_H_MADD_PS(a.y, b.y, _mm_mul_ps(a.x, b.x))));
+}
+/* b negated in the lanes where it's more than a half turn from a, and |a . b| in "cosine" */
+LINMATH_H_FUNC quat_soa_ps quat_soa_short_ps(quat_soa_ps a, quat_soa_ps b, __m128* cosine)
+{
+	__m128 const dot = quat_soa_dot_ps(a, b);
+	__m128 const sign = _mm_and_ps(dot, _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000)));
+	*cosine = _mm_xor_ps(dot, sign);
+	b.x = _mm_xor_ps(b.x, sign);
+	b.y = _mm_xor_ps(b.y, sign);
+	b.z = _mm_xor_ps(b.z, sign);
+	b.w = _mm_xor_ps(b.w, sign);
+	return b;
+}
+#endif
+
+/* r[i] = p[i] * q[i]. r may be p or q. */
+LINMATH_H_FUNC void quat_mul_soa(quat_soa r, quat_soa p, quat_soa q, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	for (; i + 4 <= n; i += 4) {
+		quat_soa_ps const a = quat_soa_load_ps(p, i);
+		quat_soa_ps const b = quat_soa_load_ps(q, i);
+		quat_soa_ps c;
+		/* p.xyz x q.xyz + p.xyz * q.w + q.xyz * p.w, and p.w * q.w - p.xyz . q.xyz */
+		c.x = _mm_sub_ps(LINMATH_H_MADD_PS(a.y, b.z, LINMATH_H_MADD_PS(a.x, b.w, _mm_mul_ps(b.x, a.w))), _mm_mul_ps(a.z, b.y));
+		c.y = _mm_sub_ps(LINMATH_H_MADD_PS(a.z, b.x, LINMATH_H_MADD_PS(a.y, b.w, _mm_mul_ps(b.y, a.w))), _mm_mul_ps(a.x, b.z));
+		c.z = _mm_sub_ps(LINMATH_H_MADD_PS(a.x, b.y, LINMATH_H_MADD_PS(a.z, b.w, _mm_mul_ps(b.z, a.w))), _mm_mul_ps(a.y, b.x));
+		c.w = _mm_sub_ps(_mm_mul_ps(a.w, b.w), LINMATH_H_MADD_PS(a.z, b.z, LINMATH_H_MADD_PS(a.y, b.y, _mm_mul_ps(a.x, b.x))));
+		quat_soa_store_ps(r, i, c);
+	}
+#endif
+	for (; i < n; ++i) {
+		float const px = p.x[i], py = p.y[i], pz = p.z[i], pw = p.w[i];
+		float const qx = q.x[i], qy = q.y[i], qz = q.z[i], qw = q.w[i];
+		r.x[i] = py * qz - pz * qy + px * qw + qx * pw;
+		r.y[i] = pz * qx - px * qz + py * qw + qy * pw;
+		r.z[i] = px * qy - py * qx + pz * qw + qz * pw;
+		r.w[i] = pw * qw - (px * qx + py * qy + pz * qz);
+	}
+}
+
+/* r[i] = quat_nlerp(a[i], b[i], t). r may be a or b. */
+LINMATH_H_FUNC void quat_nlerp_soa(quat_soa r, quat_soa a, quat_soa b, float t, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const wa = _mm_set1_ps(1.f - t);
+	__m128 const wb = _mm_set1_ps(t);
+	for (; i + 4 <= n; i += 4) {
+		__m128 cosine;
+		quat_soa_ps const qa = quat_soa_load_ps(a, i);
+		quat_soa_ps const qb = quat_soa_short_ps(qa, quat_soa_load_ps(b, i), &cosine);
+		quat_soa_ps q;
+		__m128 scale;
+		q.x = LINMATH_H_MADD_PS(qa.x, wa, _mm_mul_ps(qb.x, wb));
+		q.y = LINMATH_H_MADD_PS(qa.y, wa, _mm_mul_ps(qb.y, wb));
+		q.z = LINMATH_H_MADD_PS(qa.z, wa, _mm_mul_ps(qb.z, wb));
+		q.w = LINMATH_H_MADD_PS(qa.w, wa, _mm_mul_ps(qb.w, wb));
+		scale = _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(quat_soa_dot_ps(q, q)));
+		q.x = _mm_mul_ps(q.x, scale);
+		q.y = _mm_mul_ps(q.y, scale);
+		q.z = _mm_mul_ps(q.z, scale);
+		q.w = _mm_mul_ps(q.w, scale);
+		quat_soa_store_ps(r, i, q);
+	}
+#endif
+	for (; i < n; ++i) {
+		quat const qa = { a.x[i], a.y[i], a.z[i], a.w[i] };
+		quat const qb = { b.x[i], b.y[i], b.z[i], b.w[i] };
+		quat q;
+		quat_nlerp(q, qa, qb, t);
+		r.x[i] = q[0];
+		r.y[i] = q[1];
+		r.z[i] = q[2];
+		r.w[i] = q[3];
+	}
+}
+
+/* r[i] = quat_slerp(a[i], b[i], t). r may be a or b. */
+LINMATH_H_FUNC void quat_slerp_soa(quat_soa r, quat_soa a, quat_soa b, float t, size_t n)
+{
+	float kt[LINMATH_QUAT_SLERP_TERMS], kd[LINMATH_QUAT_SLERP_TERMS];
+	size_t i = 0;
+	quat_slerp_coefficients(kt, t);
+	quat_slerp_coefficients(kd, 1.f - t);
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	{
+		__m128 const one = _mm_set1_ps(1.f);
+		for (; i + 4 <= n; i += 4) {
+			__m128 cosine;
+			quat_soa_ps const qa = quat_soa_load_ps(a, i);
+			quat_soa_ps const qb = quat_soa_short_ps(qa, quat_soa_load_ps(b, i), &cosine);
+			__m128 const xm1 = _mm_sub_ps(cosine, one);
+			__m128 wa = one, wb = one;
+			quat_soa_ps q;
+			int k;
+			for (k = LINMATH_QUAT_SLERP_TERMS - 1; k >= 0; --k) {
+				wa = LINMATH_H_MADD_PS(_mm_mul_ps(_mm_set1_ps(kd[k]), xm1), wa, one);
+				wb = LINMATH_H_MADD_PS(_mm_mul_ps(_mm_set1_ps(kt[k]), xm1), wb, one);
+			}
+			wa = _mm_mul_ps(wa, _mm_set1_ps(1.f - t));
+			wb = _mm_mul_ps(wb, _mm_set1_ps(t));
+			q.x = LINMATH_H_MADD_PS(qa.x, wa, _mm_mul_ps(qb.x, wb));
+			q.y = LINMATH_H_MADD_PS(qa.y, wa, _mm_mul_ps(qb.y, wb));
+			q.z = LINMATH_H_MADD_PS(qa.z, wa, _mm_mul_ps(qb.z, wb));
+			q.w = LINMATH_H_MADD_PS(qa.w, wa, _mm_mul_ps(qb.w, wb));
+			quat_soa_store_ps(r, i, q);
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		float const dot = a.x[i] * b.x[i] + a.y[i] * b.y[i] + a.z[i] * b.z[i] + a.w[i] * b.w[i];
+		float const xm1 = (dot < 0.f ? -dot : dot) - 1.f;
+		float const wa = quat_slerp_weight(kd, 1.f - t, xm1);
+		float const wb = quat_slerp_weight(kt, t, xm1) * (dot < 0.f ? -1.f : 1.f);
+		float const x = a.x[i] * wa + b.x[i] * wb;
+		float const y = a.y[i] * wa + b.y[i] * wb;
+		float const z = a.z[i] * wa + b.z[i] * wb;
+		r.w[i] = a.w[i] * wa + b.w[i] * wb;
+		r.x[i] = x;
+		r.y[i] = y;
+		r.z[i] = z;
+	}
+}
+
+/* M[i] = mat4x4_from_quat(q[i]) */
+LINMATH_H_FUNC void quat_to_mat4x4_soa(mat4x4* LINMATH_H_RESTRICT M, quat_soa q, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const one = _mm_set1_ps(1.f);
+	__m128 const two = _mm_set1_ps(2.f);
+	__m128 const column3 = _mm_setr_ps(0.f, 0.f, 0.f, 1.f);
+	for (; i + 4 <= n; i += 4) {
+		quat_soa_ps const a = quat_soa_load_ps(q, i);
+		__m128 const x2 = _mm_mul_ps(a.x, two), y2 = _mm_mul_ps(a.y, two), z2 = _mm_mul_ps(a.z, two);
+		__m128 const xx = _mm_mul_ps(a.x, x2), yy = _mm_mul_ps(a.y, y2), zz = _mm_mul_ps(a.z, z2);
+		__m128 const xy = _mm_mul_ps(a.x, y2), xz = _mm_mul_ps(a.x, z2), yz = _mm_mul_ps(a.y, z2);
+		__m128 const wx = _mm_mul_ps(a.w, x2), wy = _mm_mul_ps(a.w, y2), wz = _mm_mul_ps(a.w, z2);
+		/* Column c's rows for the four quaternions, transposed into each one's column */
+		__m128 c0[4] = { _mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_add_ps(xy, wz), _mm_sub_ps(xz, wy), _mm_setzero_ps() };
+		__m128 c1[4] = { _mm_sub_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_add_ps(yz, wx), _mm_setzero_ps() };
+		__m128 c2[4] = { _mm_add_ps(xz, wy), _mm_sub_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy)), _mm_setzero_ps() };
+		int k;
+		_MM_TRANSPOSE4_PS(c0[0], c0[1], c0[2], c0[3]);
+		_MM_TRANSPOSE4_PS(c1[0], c1[1], c1[2], c1[3]);
+		_MM_TRANSPOSE4_PS(c2[0], c2[1], c2[2], c2[3]);
+		for (k = 0; k < 4; ++k) {
+			_mm_store_ps(M[i + k][0], c0[k]);
+			_mm_store_ps(M[i + k][1], c1[k]);
+			_mm_store_ps(M[i + k][2], c2[k]);
+			_mm_store_ps(M[i + k][3], column3);
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		quat const a = { q.x[i], q.y[i], q.z[i], q.w[i] };
+		mat4x4_from_quat(M[i], a);
+	}
+}
+
+/* M[i] = quat_to_mat3x4(q[i], (tx[i], ty[i], tz[i])). The translations may all be NULL for none. */
+LINMATH_H_FUNC void quat_to_mat3x4_soa(mat3x4* LINMATH_H_RESTRICT M, quat_soa q, float const* LINMATH_H_RESTRICT tx,
+	float const* LINMATH_H_RESTRICT ty, float const* LINMATH_H_RESTRICT tz, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	__m128 const one = _mm_set1_ps(1.f);
+	__m128 const two = _mm_set1_ps(2.f);
+	for (; i + 4 <= n; i += 4) {
+		quat_soa_ps const a = quat_soa_load_ps(q, i);
+		__m128 const x2 = _mm_mul_ps(a.x, two), y2 = _mm_mul_ps(a.y, two), z2 = _mm_mul_ps(a.z, two);
+		__m128 const xx = _mm_mul_ps(a.x, x2), yy = _mm_mul_ps(a.y, y2), zz = _mm_mul_ps(a.z, z2);
+		__m128 const xy = _mm_mul_ps(a.x, y2), xz = _mm_mul_ps(a.x, z2), yz = _mm_mul_ps(a.y, z2);
+		__m128 const wx = _mm_mul_ps(a.w, x2), wy = _mm_mul_ps(a.w, y2), wz = _mm_mul_ps(a.w, z2);
+		/* Row r's columns for the four quaternions, transposed into each one's row */
+		__m128 r0[4] = { _mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_sub_ps(xy, wz), _mm_add_ps(xz, wy),
+			tx ? _mm_loadu_ps(tx + i) : _mm_setzero_ps() };
+		__m128 r1[4] = { _mm_add_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_sub_ps(yz, wx),
+			ty ? _mm_loadu_ps(ty + i) : _mm_setzero_ps() };
+		__m128 r2[4] = { _mm_sub_ps(xz, wy), _mm_add_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy)),
+			tz ? _mm_loadu_ps(tz + i) : _mm_setzero_ps() };
+		int k;
+		_MM_TRANSPOSE4_PS(r0[0], r0[1], r0[2], r0[3]);
+		_MM_TRANSPOSE4_PS(r1[0], r1[1], r1[2], r1[3]);
+		_MM_TRANSPOSE4_PS(r2[0], r2[1], r2[2], r2[3]);
+		for (k = 0; k < 4; ++k) {
+			_mm_store_ps(M[i + k][0], r0[k]);
+			_mm_store_ps(M[i + k][1], r1[k]);
+			_mm_store_ps(M[i + k][2], r2[k]);
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		quat const a = { q.x[i], q.y[i], q.z[i], q.w[i] };
+		vec3 const t = { tx ? tx[i] : 0.f, ty ? ty[i] : 0.f, tz ? tz[i] : 0.f };
+		quat_to_mat3x4(M[i], a, t);
+	}
+}
+
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+#define LINMATH_H_SELECT_PS(mask, a, b) _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))
+/* The quaternions of four rotations from their columns 0-2, transposed:
+ * c0[r] is row r of the four matrices' column 0. Shepperd's method by masks,
+ * as quat_from_mat4x4_soa describes. */
+LINMATH_H_FUNC quat_soa_ps quat_from_columns_ps(__m128 const c0[3], __m128 const c1[3], __m128 const c2[3])
+{
+	__m128 const one = _mm_set1_ps(1.f);
+	__m128 const half = _mm_set1_ps(.5f);
+	/* 4 * the squares of w, x, y and z, then 4 * wx, wy, wz, xy, xz, yz */
+	__m128 const tw = _mm_add_ps(one, _mm_add_ps(c0[0], _mm_add_ps(c1[1], c2[2])));
+	__m128 const tx = _mm_add_ps(one, _mm_sub_ps(c0[0], _mm_add_ps(c1[1], c2[2])));
+	__m128 const ty = _mm_add_ps(one, _mm_sub_ps(c1[1], _mm_add_ps(c0[0], c2[2])));
+	__m128 const tz = _mm_add_ps(one, _mm_sub_ps(c2[2], _mm_add_ps(c0[0], c1[1])));
+	__m128 const wx = _mm_sub_ps(c1[2], c2[1]), wy = _mm_sub_ps(c2[0], c0[2]), wz = _mm_sub_ps(c0[1], c1[0]);
+	__m128 const xy = _mm_add_ps(c1[0], c0[1]), xz = _mm_add_ps(c2[0], c0[2]), yz = _mm_add_ps(c2[1], c1[2]);
+	/* The larger of w and x, of y and z, then of the two: each lane's pivot by masks */
+	__m128 const x_over_w = _mm_cmpgt_ps(tx, tw), z_over_y = _mm_cmpgt_ps(tz, ty);
+	__m128 const t01 = _mm_max_ps(tx, tw), t23 = _mm_max_ps(tz, ty);
+	__m128 const high = _mm_cmpgt_ps(t23, t01);
+	__m128 const s = _mm_div_ps(half, _mm_sqrt_ps(_mm_max_ps(t01, t23)));
+	quat_soa_ps r;
+	r.x = LINMATH_H_SELECT_PS(high, LINMATH_H_SELECT_PS(z_over_y, xz, xy), LINMATH_H_SELECT_PS(x_over_w, tx, wx));
+	r.y = LINMATH_H_SELECT_PS(high, LINMATH_H_SELECT_PS(z_over_y, yz, ty), LINMATH_H_SELECT_PS(x_over_w, xy, wy));
+	r.z = LINMATH_H_SELECT_PS(high, LINMATH_H_SELECT_PS(z_over_y, tz, yz), LINMATH_H_SELECT_PS(x_over_w, xz, wz));
+	r.w = LINMATH_H_SELECT_PS(high, LINMATH_H_SELECT_PS(z_over_y, wz, wy), LINMATH_H_SELECT_PS(x_over_w, wx, tw));
+	r.x = _mm_mul_ps(r.x, s);
+	r.y = _mm_mul_ps(r.y, s);
+	r.z = _mm_mul_ps(r.z, s);
+	r.w = _mm_mul_ps(r.w, s);
+	return r;
+}
+#undef LINMATH_H_SELECT_PS
+#endif
+
+/* q[i] = quat_from_mat4x4_fast(M[i]), its largest component positive, and
+ * when two tie any of them may be */
+LINMATH_H_FUNC void quat_from_mat4x4_soa(quat_soa q, mat4x4 const* LINMATH_H_RESTRICT M, size_t n)
+{
+	size_t i = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+	for (; i + 4 <= n; i += 4) {
+		/* Columns 0-2 of the four matrices, transposed: c0[r] is M[i..i+3][0][r] */
+		__m128 c0[4] = { _mm_load_ps(M[i][0]), _mm_load_ps(M[i + 1][0]), _mm_load_ps(M[i + 2][0]), _mm_load_ps(M[i + 3][0]) };
+		__m128 c1[4] = { _mm_load_ps(M[i][1]), _mm_load_ps(M[i + 1][1]), _mm_load_ps(M[i + 2][1]), _mm_load_ps(M[i + 3][1]) };
+		__m128 c2[4] = { _mm_load_ps(M[i][2]), _mm_load_ps(M[i + 1][2]), _mm_load_ps(M[i + 2][2]), _mm_load_ps(M[i + 3][2]) };
+		_MM_TRANSPOSE4_PS(c0[0], c0[1], c0[2], c0[3]);
+		_MM_TRANSPOSE4_PS(c1[0], c1[1], c1[2], c1[3]);
+		_MM_TRANSPOSE4_PS(c2[0], c2[1], c2[2], c2[3]);
+		quat_soa_store_ps(q, i, quat_from_columns_ps(c0, c1, c2));
+	}
+#endif
+	for (; i < n; ++i) {
+		quat r;
+		quat_from_mat4x4_fast(r, M[i]);
+		q.x[i] = r[0];
+		q.y[i] = r[1];
+		q.z[i] = r[2];
+		q.w[i] = r[3];
+	}
+}
+
+#endif
@@ -0,0 +1,251 @@
+#pragma once
+#ifndef LINMATH_TRS_H
+#define LINMATH_TRS_H
+
+#include "linmath.h"
+
+/* Compact transforms on top of linmath.h: translation, rotation quaternion
+ * and per-axis scale in 40 bytes, against 64 for the equivalent mat4x4.
+ * A trs maps a point p to t + r * (s * p), the same as
+ * translate(t) * mat4x4_from_quat(r) * scale_aniso(s), which trs_to_mat4x4
+ * builds when the matrix is needed (e.g. at upload time).
+ *
+ * trs_mul (compose) and trs_invert are exact for uniform scale. With
+ * non-uniform scale under a rotation the exact product has shear, which TRS
+ * can't hold; they keep the per-axis scale product, as engines with TRS
+ * hierarchies usually do. Rotations must be unit quaternions.
+ *
+ * The SSE paths work on the quaternion in one register and the vec3 parts
+ * in the low three lanes of another; NEON and scalar targets use the
+ * linmath.h quaternion functions. Every function may be called with r
+ * aliasing an input. */
+
+typedef struct trs {
+	vec3 t;
+	quat r;
+	vec3 s;
+} trs;
+
+LINMATH_H_FUNC void trs_identity(trs* r)
+{
+	r->t[0] = r->t[1] = r->t[2] = 0.f;
+	quat_identity(r->r);
+	r->s[0] = r->s[1] = r->s[2] = 1.f;
+}
+
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+/* Lanes 0-2 of a register hold t or s, lane 3 is don't-care. Loads and
+ * stores overlap the neighbouring member rather than going lane by lane,
+ * and never touch memory outside the trs. */
+LINMATH_H_FUNC __m128 trs_load_t_ps(trs const* a)
+{
+	return _mm_loadu_ps(a->t);
+}
+LINMATH_H_FUNC __m128 trs_load_s_ps(trs const* a)
+{
+	__m128 const ws = _mm_loadu_ps(&a->r[3]);
+	return _mm_shuffle_ps(ws, ws, _MM_SHUFFLE(0, 3, 2, 1));
+}
+/* Each store covers a member's bytes after the one before wrote over it */
+LINMATH_H_FUNC void trs_store_ps(trs* r, __m128 t, __m128 q, __m128 s)
+{
+	__m128 const ws = _mm_move_ss(_mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 1, 0, 3)), _mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 3, 3, 3)));
+	_mm_storeu_ps(r->t, t);
+	_mm_storeu_ps(r->r, q);
+	_mm_storeu_ps(&r->r[3], ws);
+}
+LINMATH_H_FUNC __m128 trs_cross_ps(__m128 a, __m128 b)
+{
+	__m128 const a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 const b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 const c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+	return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+/* p * q, lanes x y z w */
+LINMATH_H_FUNC __m128 trs_quat_mul_ps(__m128 p, __m128 q)
+{
+	__m128 const negate_w = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, (int)0x80000000));
+	__m128 r = _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3)), q);
+	__m128 const b = _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 2, 1, 0)), _mm_shuffle_ps(q, q, _MM_SHUFFLE(0, 3, 3, 3)));
+	__m128 const c = _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 0, 2, 1)), _mm_shuffle_ps(q, q, _MM_SHUFFLE(1, 1, 0, 2)));
+	__m128 const d = _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 1, 0, 2)), _mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 0, 2, 1)));
+	r = _mm_add_ps(r, _mm_xor_ps(b, negate_w));
+	r = _mm_add_ps(r, _mm_xor_ps(c, negate_w));
+	return _mm_sub_ps(r, d);
+}
+/* q * v * conj(q) for a unit q (see quat_mul_vec3); lane 3 passes v's through */
+LINMATH_H_FUNC __m128 trs_quat_rotate_ps(__m128 q, __m128 v)
+{
+	__m128 const t = _mm_add_ps(trs_cross_ps(q, v), trs_cross_ps(q, v));
+	__m128 const w = _mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm_add_ps(LINMATH_H_MADD_PS(w, t, v), trs_cross_ps(q, t));
+}
+LINMATH_H_FUNC __m128 trs_dot4_ps(__m128 a, __m128 b)
+{
+	__m128 d = _mm_mul_ps(a, b);
+	d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+#endif
+
+/* r = a * b: b applied first, then a (parent * local gives the world transform) */
+LINMATH_H_FUNC void trs_mul(trs* r, trs const* a, trs const* b)
+{
+#if (LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX) && !defined(LINMATH_DETERMINISTIC)
+	__m128 const ar = _mm_loadu_ps(a->r);
+	__m128 const as = trs_load_s_ps(a);
+	__m128 const t = _mm_add_ps(trs_load_t_ps(a), trs_quat_rotate_ps(ar, _mm_mul_ps(as, trs_load_t_ps(b))));
+	__m128 const q = trs_quat_mul_ps(ar, _mm_loadu_ps(b->r));
+	__m128 const s = _mm_mul_ps(as, trs_load_s_ps(b));
+	trs_store_ps(r, t, q, s);
+#else
+	trs m;
+	vec3 st;
+	int i;
+	for (i = 0; i < 3; ++i)
+		st[i] = a->s[i] * b->t[i];
+	quat_mul_vec3(m.t, a->r, st);
+	vec3_add(m.t, m.t, a->t);
+	quat_mul(m.r, a->r, b->r);
+	for (i = 0; i < 3; ++i)
+		m.s[i] = a->s[i] * b->s[i];
+	*r = m;
+#endif
+}
+
+/* The transform undoing a: trs_mul(r, a) is the identity (up to rounding) */
+LINMATH_H_FUNC void trs_invert(trs* r, trs const* a)
+{
+#if (LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX) && !defined(LINMATH_DETERMINISTIC)
+	__m128 const negate_xyz = _mm_castsi128_ps(_mm_setr_epi32((int)0x80000000, (int)0x80000000, (int)0x80000000, 0));
+	__m128 const q = _mm_xor_ps(_mm_loadu_ps(a->r), negate_xyz);
+	/* lane 3 set to 1 first, so the don't-care lane can't divide by zero */
+	__m128 const one = _mm_set1_ps(1.f);
+	__m128 const as = trs_load_s_ps(a);
+	__m128 const s = _mm_div_ps(one, _mm_shuffle_ps(as, _mm_unpackhi_ps(as, one), _MM_SHUFFLE(3, 0, 1, 0)));
+	__m128 const t = _mm_xor_ps(_mm_mul_ps(s, trs_quat_rotate_ps(q, trs_load_t_ps(a))), negate_xyz);
+	trs_store_ps(r, t, q, s);
+#else
+	trs m;
+	int i;
+	quat_conj(m.r, a->r);
+	quat_mul_vec3(m.t, m.r, a->t);
+	for (i = 0; i < 3; ++i) {
+		m.s[i] = 1.f / a->s[i];
+		m.t[i] = -m.t[i] * m.s[i];
+	}
+	*r = m;
+#endif
+}
+
+/* Blends a (k = 0) into b (k = 1): translation and scale linearly, rotation
+ * along the shorter arc, normalized (nlerp: no trigonometry, but the angular
+ * speed is not constant within one step). */
+LINMATH_H_FUNC void trs_lerp(trs* r, trs const* a, trs const* b, float k)
+{
+#if (LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX) && !defined(LINMATH_DETERMINISTIC)
+	__m128 const kk = _mm_set1_ps(k);
+	__m128 const at = trs_load_t_ps(a);
+	__m128 const as = trs_load_s_ps(a);
+	__m128 const ar = _mm_loadu_ps(a->r);
+	__m128 br = _mm_loadu_ps(b->r);
+	/* -b is the same rotation; flip it onto a's hemisphere */
+	br = _mm_xor_ps(br, _mm_and_ps(trs_dot4_ps(ar, br), _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000))));
+	__m128 const t = LINMATH_H_MADD_PS(kk, _mm_sub_ps(trs_load_t_ps(b), at), at);
+	__m128 const s = LINMATH_H_MADD_PS(kk, _mm_sub_ps(trs_load_s_ps(b), as), as);
+	__m128 q = LINMATH_H_MADD_PS(kk, _mm_sub_ps(br, ar), ar);
+	q = _mm_div_ps(q, _mm_sqrt_ps(trs_dot4_ps(q, q)));
+	trs_store_ps(r, t, q, s);
+#else
+	quat br, q;
+	float const sign = quat_mul_inner(a->r, b->r) < 0.f ? -1.f : 1.f;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		br[i] = b->r[i] * sign;
+		q[i] = a->r[i] + (br[i] - a->r[i]) * k;
+	}
+	for (i = 0; i < 3; ++i) {
+		r->t[i] = a->t[i] + (b->t[i] - a->t[i]) * k;
+		r->s[i] = a->s[i] + (b->s[i] - a->s[i]) * k;
+	}
+	quat_norm(r->r, q);
+#endif
+}
+
+/* r = t + r * (s * v), transforming a point */
+LINMATH_H_FUNC void trs_mul_vec3(vec3 r, trs const* a, vec3 const v)
+{
+	vec3 sv;
+	int i;
+	for (i = 0; i < 3; ++i)
+		sv[i] = a->s[i] * v[i];
+	quat_mul_vec3(r, a->r, sv);
+	vec3_add(r, r, a->t);
+}
+
+/* M = translate(t) * mat4x4_from_quat(r) * scale_aniso(s) */
+LINMATH_H_FUNC void trs_to_mat4x4(mat4x4 M, trs const* a)
+{
+	float const x = a->r[0], y = a->r[1], z = a->r[2], w = a->r[3];
+	float const x2 = x + x, y2 = y + y, z2 = z + z;
+	float const xx = x * x2, yy = y * y2, zz = z * z2;
+	float const xy = x * y2, xz = x * z2, yz = y * z2;
+	float const wx = w * x2, wy = w * y2, wz = w * z2;
+
+	M[0][0] = (1.f - yy - zz) * a->s[0];
+	M[0][1] = (xy + wz) * a->s[0];
+	M[0][2] = (xz - wy) * a->s[0];
+	M[0][3] = 0.f;
+
+	M[1][0] = (xy - wz) * a->s[1];
+	M[1][1] = (1.f - xx - zz) * a->s[1];
+	M[1][2] = (yz + wx) * a->s[1];
+	M[1][3] = 0.f;
+
+	M[2][0] = (xz + wy) * a->s[2];
+	M[2][1] = (yz - wx) * a->s[2];
+	M[2][2] = (1.f - xx - yy) * a->s[2];
+	M[2][3] = 0.f;
+
+	M[3][0] = a->t[0];
+	M[3][1] = a->t[1];
+	M[3][2] = a->t[2];
+	M[3][3] = 1.f;
+}
+
+/* M = VP * trs_to_mat4x4(a), e.g. a view-projection times a model, without
+ * building the model matrix: its rotation-scale columns mix VP's first three
+ * and its translation lands in the last. M must not alias VP. */
+LINMATH_H_FUNC void trs_mul_to_mat4x4(vec4* LINMATH_H_RESTRICT M, vec4 const* LINMATH_H_RESTRICT VP, trs const* a)
+{
+	float const x = a->r[0], y = a->r[1], z = a->r[2], w = a->r[3];
+	float const x2 = x + x, y2 = y + y, z2 = z + z;
+	float const xx = x * x2, yy = y * y2, zz = z * z2;
+	float const xy = x * y2, xz = x * z2, yz = y * z2;
+	float const wx = w * x2, wy = w * y2, wz = w * z2;
+	float const m[3][3] = {
+		{ (1.f - yy - zz) * a->s[0], (xy + wz) * a->s[0], (xz - wy) * a->s[0] },
+		{ (xy - wz) * a->s[1], (1.f - xx - zz) * a->s[1], (yz + wx) * a->s[1] },
+		{ (xz + wy) * a->s[2], (yz - wx) * a->s[2], (1.f - xx - yy) * a->s[2] },
+	};
+	int c, r;
+	for (c = 0; c < 3; ++c)
+		for (r = 0; r < 4; ++r)
+			M[c][r] = VP[0][r] * m[c][0] + VP[1][r] * m[c][1] + VP[2][r] * m[c][2];
+	for (r = 0; r < 4; ++r)
+		M[3][r] = VP[0][r] * a->t[0] + VP[1][r] * a->t[1] + VP[2][r] * a->t[2] + VP[3][r];
+}
+
+/* translate(x, y, z) * rotate_Z(angle) * scale(k), as the scene places its objects */
+LINMATH_H_FUNC void trs_translate_rotate_Z(trs* r, float x, float y, float z, float angle, float k)
+{
+	r->t[0] = x;
+	r->t[1] = y;
+	r->t[2] = z;
+	r->r[0] = r->r[1] = 0.f;
+	r->r[2] = linmath_sinf(angle * 0.5f);
+	r->r[3] = linmath_cosf(angle * 0.5f);
+	r->s[0] = r->s[1] = r->s[2] = k;
+}
+
+#endif
@@ -4,10 +4,140 @@
 #include <GLFW/glfw3.h>
 
 #include "linmath.h"
+#include "linmath_affine.h"
+#include "linmath_batch.h"
+#include "linmath_fast.h"
 
+#include "asset/asset_package.h"
+#include "asset/mesh_file.h"
+#include "asset/meshlet.h"
+#include "asset/mesh_optimize.h"
+#include "asset/mesh_simplify.h"
+#include "asset/vertex_layout.h"
+
+#include "gl/asset_streamer.h"
+#include "gl/batch_target.h"
+#include "gl/cluster_culling.h"
+#include "gl/draw_counters.h"
+#include "gl/draw_sampler.h"
+#include "gl/feed_renderer.h"
+#include "gl/foveation.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_resources.h"
+#include "gl/gl_state.h"
+#include "gl/gpu_animation.h"
+#include "gl/gpu_counters.h"
+#include "gl/gpu_culling.h"
+#include "gl/gpu_picker.h"
+#include "gl/gpu_primitives.h"
+#include "gl/gpu_profiler.h"
+#include "gl/gpu_readback.h"
+#include "gl/hiz.h"
+#include "gl/hud.h"
+#include "gl/impostor_renderer.h"
+#include "gl/lighting.h"
+#include "gl/line_renderer.h"
+#include "gl/loading_screen.h"
+#include "gl/mesh.h"
+#include "gl/oit.h"
+#include "gl/overdraw.h"
+#include "gl/particles.h"
+#include "gl/point_cloud_renderer.h"
+#include "gl/post_process.h"
+#include "gl/program_cache.h"
+#include "gl/pipeline_state.h"
+#include "gl/program_pipeline.h"
+#include "gl/render_target.h"
+#include "gl/render_target_pool.h"
+#include "gl/screen_capture.h"
+#include "gl/shader.h"
+#include "gl/shader_manager.h"
+#include "gl/shader_permutation.h"
+#include "gl/shadow_maps.h"
+#include "gl/temporal_aa.h"
+#include "gl/terrain_renderer.h"
+#include "gl/volume_renderer.h"
+#include "gl/shape_renderer.h"
+#include "gl/skinning.h"
+#include "gl/stream_buffer.h"
+#include "gl/swap_damage.h"
+#include "gl/swap_group.h"
+#include "gl/material.h"
+#include "gl/texture_streamer.h"
+#include "gl/tile_map_renderer.h"
+#include "gl/ui_renderer.h"
+#include "gl/uniforms.h"
+#include "gl/vertex_pull.h"
+#include "gl/vertex_format.h"
+#include "core/alloc_tracker.h"
+#include "core/command_list.h"
+#include "core/cpu_topology.h"
+#include "core/cpu_trace.h"
+#include "core/cull_selector.h"
+#include "core/file_watcher.h"
+#include "core/frame_capture.h"
+#include "core/fixed_timestep.h"
+#include "core/frame_arena.h"
+#include "core/frame_pacer.h"
+#include "core/frame_stats.h"
+#include "core/glyph_atlas.h"
+#include "core/hitch_detector.h"
+#include "core/huge_pages.h"
+#include "core/frame_queue.h"
+#include "core/input_queue.h"
+#include "core/job_system.h"
+#include "core/line_series.h"
+#include "core/metrics_server.h"
+#include "core/numa_memory.h"
+#include "core/point_cloud.h"
+#include "core/quality_governor.h"
+#include "core/redraw_policy.h"
+#include "core/render_queue.h"
+#include "core/render_service.h"
+#include "core/resolution_scaler.h"
+#include "core/settings.h"
+#include "core/software_renderer.h"
+#include "core/startup_profile.h"
+#include "core/telemetry.h"
+#include "core/wall_sync.h"
+#include "scene/animation.h"
+#include "scene/bench_scene.h"
+#include "scene/broadphase.h"
+#include "scene/bvh.h"
+#include "scene/camera.h"
+#include "scene/camera_controller.h"
+#include "scene/coherent_cull.h"
+#include "scene/frustum.h"
+#include "scene/impostor.h"
+#include "scene/lod.h"
+#include "scene/occlusion_raster.h"
+#include "scene/scene_file.h"
+#include "scene/significance.h"
+#include "scene/spatial_grid.h"
+#include "scene/terrain.h"
+#ifdef OPENGLTEST_VULKAN
+#include "vk/vulkan_renderer.h"
+#endif
+#ifdef OPENGLTEST_OPENXR
+#include "xr/openxr_presenter.h"
+#endif
+#ifdef OPENGLTEST_CUDA
+#include "cuda/cuda_points.h"
+#endif
+
+#include <chrono>
+#include <condition_variable>
+#include <limits.h>
+#include <math.h>
+#include <mutex>
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+#include <thread>
 
 // Define a custom Vertex type
 typedef struct Vertex
@@ -16,6 +146,15 @@ typedef struct Vertex
     vec3 col;
 } Vertex;
 
+// Vertex as uploaded, as types (asset/vertex_layout.h): half-float positions and unorm8 colors, 8 bytes instead of
+// 20, or with --float-vertices as authored. Either declares the vertex shader's vPos and vCol inputs below, and
+// packs and points the attributes at them with its own compiled code (renderer_load_builtin_mesh).
+typedef VertexLayout<VertexLayoutAttrib<0, 2, VERTEX_ATTRIB_FLOAT16, "vPos">,
+    VertexLayoutAttrib<1, 3, VERTEX_ATTRIB_UNORM8, "vCol">> PackedVertex;
+typedef VertexLayout<VertexLayoutAttrib<0, 2, VERTEX_ATTRIB_FLOAT32, "vPos">,
+    VertexLayoutAttrib<1, 3, VERTEX_ATTRIB_FLOAT32, "vCol">> FloatVertex;
+static_assert(PackedVertex::glsl == FloatVertex::glsl, "the shader declares one set of inputs for both layouts");
+
 // Define a list of verticies (using the Vertex type) for our triangle
 static const Vertex vertices[3] =
 {
@@ -24,151 +163,8981 @@ static const Vertex vertices[3] =
     { {   0.f,  0.6f }, { 0.f, 0.f, 1.f } }
 };
 
-// Vertex shader code (written in OpenGL Shading Language (GLSL))
-static const char* vertex_shader_text =
+// Index list into the vertices above (one triangle); meshes are drawn indexed from an element buffer
+static const uint32_t indices[3] = { 0, 1, 2 };
+
+// Vertex shader code (written in OpenGL Shading Language (GLSL)). This and the fragment shader below are
+// the masters of the scene's variants: each SCENE_FEATURE_* #defines its name in the variants that have it. The
+// attribute inputs go between its head and tail, declared by PackedVertex.
+static constexpr char vertex_shader_head[] =
 "#version 330\n"        // GLSL version, OpenGL 3.3
-"uniform mat4 MVP;\n"   // uniform (const vals passed from app to shader during draw call) (MVP -> model-view-projection matrix)
-"in vec3 vCol;\n"       // Input for vertex color (e.g. RGB)
-"in vec2 vPos;\n"       // Input for vertex position
+UNIFORMS_GLSL           // Camera (view/projection/viewport), Frame (time) and Draw (model) uniform blocks, see gl/uniforms.h
+"#ifdef INSTANCED\n"
+"layout(location = 2) in mat3x4 vModel;\n"  // Per-instance affine model matrix rows (locations 2-4)
+"#endif\n"
+"#ifdef SKINNED\n"
+"#ifdef BAKED\n"
+SKINNING_BAKED_GLSL     // skinMatrix() from the baked clips and the BakedInstances block instead (--bake-animation)
+"#else\n"
+SKINNING_GLSL           // the Palettes block, vJoints / vWeights (locations 6-7) and skinMatrix(), see gl/skinning.h
+"#endif\n"
+"#endif\n"
+"#ifdef PULLED\n"
+VERTEX_PULL_GLSL        // the PulledVertices and PulledFormat blocks and pullAttribute(), see gl/vertex_pull.h
+"#else\n";
+static constexpr char vertex_shader_tail[] =
+"#endif\n"
+"layout(location = 5) in uint vMaterial;\n"  // Per-instance material index (--material); a constant 0 without materials
+"#ifdef STEREO\n"
+UNIFORMS_STEREO_GLSL    // the Stereo block: both eyes' view-projections (--stereo)
+"#endif\n"
+"#ifdef PICK_ID\n"
+"layout(location = 8) in uint vObject;\n"    // Per-instance object index (--gpu-pick)
+"flat out uint objectId;\n"
+"#endif\n"
+"#if defined(OIT_WEIGHTED) || defined(OIT_LIST)\n"
+"flat out float translucency;\n"   // the object's alpha (--oit)
+"#endif\n"
+"#ifdef STEREO\n"
+"out gl_PerVertex { vec4 gl_Position; float gl_ClipDistance[1]; };\n"
+"#else\n"
+"out gl_PerVertex { vec4 gl_Position; };\n"   // declared, as a separable vertex stage (--separable) must
+"#endif\n"
+"invariant gl_Position;\n"  // the same depth from the depth pre-pass's program as from this one (GL_EQUAL)
 "out vec3 color;\n"     // output variable that passes from vertex shader to the next pipeline stage (frag shader, likely)
+"out vec2 uv;\n"        // texture coordinates, planar from the position: the texture spans MESH_UV_SPAN units
+"flat out uint material;\n"
+"out vec3 worldPosition;\n"    // for the lit variants (--lights)
+"out vec3 worldNormal;\n"      // the meshes lie in their z = 0 plane, facing +z
 "void main()\n"         // main function
 "{\n"
-"    gl_Position = MVP * vec4(vPos, 0.0, 1.0);\n"   // assigns to built in variable for clip-space position of the vertex
-"    color = vCol;\n"                               // assigns the color
+"#ifdef PULLED\n"
+"    vec2 vPos = pullAttribute(0u).xy;\n"     // the same locations, read and decoded here
+"    vec3 vCol = pullAttribute(1u).xyz;\n"
+"#endif\n"
+"    vec4 position = vec4(vPos, 0.0, 1.0);\n"
+"    vec4 normal = vec4(0.0, 0.0, 1.0, 0.0);\n"
+"#ifdef INSTANCED\n"
+"    position = vec4(position * vModel, 1.0);\n"
+"    normal = vec4(normal * vModel, 0.0);\n"     // rotations and uniform scales only, so no inverse transpose
+"#endif\n"
+"#ifdef SKINNED\n"
+"    mat3x4 skin = skinMatrix();\n"
+"    position = vec4(position * skin, 1.0);\n"    // the bind-pose vertex, posed and placed
+"    normal = vec4(normal * skin, 0.0);\n"
+"#endif\n"
+"    position = model * position;\n"
+"#if defined(OIT_WEIGHTED) || defined(OIT_LIST)\n"
+"    vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);\n"    // the object's centre, and its x axis for its size
+"    vec4 axis = vec4(1.0, 0.0, 0.0, 0.0);\n"
+"#ifdef INSTANCED\n"
+"    origin = vec4(origin * vModel, 1.0);\n"
+"    axis = vec4(axis * vModel, 0.0);\n"
+"#endif\n"
+"    origin = model * origin;\n"
+"    float h = fract(sin(dot(origin.xy, vec2(12.9898, 78.233))) * 43758.5453);\n"   // fixed per object: they spin in place
+"    translucency = 0.3 + 0.4 * h;\n"
+"    position.z += (h - 0.5) * length((model * axis).xyz);\n"   // a layer of its own, within its size of the plane
+"#endif\n"
+"#ifdef STEREO\n"
+"    int eye = gl_InstanceID & 1;\n"     // the instance attributes advance every other instance: each object twice
+"    vec4 clip = eyeViewProjection[eye] * position;\n"
+"    gl_ClipDistance[0] = clip.w + (eye == 0 ? -clip.x : clip.x);\n"     // kept off the other eye's half
+"    gl_Position = vec4(clip.x * 0.5 + (float(eye) - 0.5) * clip.w, clip.yzw);\n"   // into the eye's half of x
+"#else\n"
+"    gl_Position = viewProjection * position;\n"    // assigns to built in variable for clip-space position of the vertex
+"#endif\n"
+"    worldPosition = position.xyz;\n"
+"    worldNormal = (model * normal).xyz;\n"
+"    color = vCol;\n"                                       // assigns the color
+"    uv = vPos / 1.2 + 0.5;\n"
+"    material = vMaterial;\n"
+"#ifdef PICK_ID\n"
+"    objectId = vObject + 1u;\n"   // 0 is the cleared background
+"#endif\n"
 "}\n";
+static constexpr auto vertex_shader_source = vertex_layout_splice(vertex_shader_head, PackedVertex::glsl,
+    vertex_shader_tail);
+static const char* vertex_shader_text = vertex_shader_source.data();
 
+#define MESH_UV_SPAN 1.2f   // mesh units per texture repeat, as in the vertex shader
+
+// The vertex color, modulated by the streamed texture on unit 0 (--texture) or by the instance's material, from
+// the texture arrays or through bindless handles (--material). Lit, it's shaded by the lights of the fragment's
+// cluster (--lights); GBUFFER writes it unlit with the normal instead, for the deferred pass (--deferred).
+// DEPTH_ONLY writes nothing, for the depth pre-pass, and OVERDRAW a fixed amount to add up per pixel. PICK_ID
+// also writes the object's ID to the second attachment, for --gpu-pick to read back under the cursor. The OIT
+// variants (--oit) take the object's alpha and add the fragment to the weighted targets or append it to its
+// pixel's list instead of writing it. SHADOWED darkens it by the sun's shadow maps where they cover it (--shadows).
+// PIXEL_LOCAL, with GBUFFER, keeps albedo, normal and depth in the tile's pixel local storage instead (--gles).
 static const char* fragment_shader_text =
 "#version 330\n"
+"#if defined(LIT)\n"
+LIGHTING_GLSL
+"#elif defined(GBUFFER)\n"
+LIGHTING_OCTAHEDRAL_GLSL
+"#if defined(PIXEL_LOCAL)\n"
+LIGHTING_PIXEL_LOCAL_GLSL("__pixel_localEXT")     // see gl/lighting.h
+"vec2 packedNormal;\n"
+"#else\n"
+"layout(location = 1) out vec2 packedNormal;\n"
+"#endif\n"
+"#endif\n"
+"#if defined(PICK_ID)\n"
+"flat in uint objectId;\n"
+"layout(location = 1) out uint pickId;\n"
+"#endif\n"
+"#if defined(OIT_WEIGHTED) || defined(OIT_LIST)\n"
+OIT_GLSL                // the OitParams block, and oitAccumulate() or the lists and oitAppend(), see gl/oit.h
+"flat in float translucency;\n"
+"#endif\n"
+"#if defined(SHADOWED)\n"
+SHADOW_GLSL             // the Shadows block, the maps and shadowVisibility(), see gl/shadow_maps.h
+"#endif\n"
+"#if defined(MATERIAL_ARRAYS)\n"
+MATERIAL_ARRAYS_GLSL
+"#elif defined(MATERIAL_BINDLESS)\n"
+MATERIAL_BINDLESS_GLSL
+"#elif defined(TEXTURED)\n"
+"uniform sampler2D albedo;\n"
+"vec4 materialSample(uint material, vec2 uv) { return texture(albedo, uv); }\n"
+"#endif\n"
 "in vec3 color;\n"
-"out vec4 fragment;\n"  // Fragment color output (rgba)
+"in vec2 uv;\n"
+"flat in uint material;\n"
+"in vec3 worldPosition;\n"
+"in vec3 worldNormal;\n"
+"#if defined(PIXEL_LOCAL)\n"
+"vec4 fragment;\n"      // no colour output: the resolve writes the target
+"#else\n"
+"layout(location = 0) out vec4 fragment;\n"  // Fragment color output (rgba)
+"#endif\n"
 "void main()\n"
 "{\n"
+"#if defined(OVERDRAW)\n"
+"    fragment = vec4(0.25, 0.09, 0.03, 1.0);\n"   // additively blended: red after 4 layers, yellow by 11
+"#elif !defined(DEPTH_ONLY)\n"
+"#if defined(MATERIAL_ARRAYS) || defined(MATERIAL_BINDLESS) || defined(TEXTURED)\n"
+"    fragment = vec4(color * materialSample(material, uv).rgb, 1.0);\n"
+"#else\n"
 "    fragment = vec4(color, 1.0);\n"    // Returns color with a=1
+"#endif\n"
+"#if defined(LIT)\n"
+"    fragment.rgb = lightClustered(fragment.rgb, worldPosition, normalize(worldNormal), gl_FragCoord.xyz);\n"
+"#elif defined(GBUFFER)\n"
+"    packedNormal = octahedralEncode(normalize(worldNormal));\n"
+"#if defined(PIXEL_LOCAL)\n"
+"    gbuffer.albedo = fragment;\n"
+"    gbuffer.normal = vec4(packedNormal, 0.0, 0.0);\n"
+"    gbuffer.depth = gl_FragCoord.z;\n"
+"#endif\n"
+"#endif\n"
+"#if defined(SHADOWED)\n"
+"    fragment.rgb *= shadowVisibility(worldPosition);\n"
+"#endif\n"
+"#if defined(OIT_WEIGHTED)\n"
+"    fragment = oitAccumulate(vec4(fragment.rgb, translucency));\n"
+"#elif defined(OIT_LIST)\n"
+"    oitAppend(vec4(fragment.rgb, translucency));\n"    // colour writes are off: the resolve blends it
+"#endif\n"
+"#if defined(PICK_ID)\n"
+"    pickId = objectId;\n"
+"#endif\n"
+"#endif\n"
 "}\n";
 
-// Error callback function for GLFW
-static void error_callback(int error, const char* description)
+// The scene shaders' features, as variant key bits. Texturing and the two material paths are one choice, made in
+// the fragment stage only: every variant with the same vertex features shares its vertex stage. So are the two
+// ways of lighting and the two outputs that replace the colour.
+enum
 {
-    fprintf(stderr, "Error: %s\n", description);
+    SCENE_FEATURE_INSTANCED = 1 << 0,           // model matrices from the per-instance attributes
+    SCENE_FEATURE_TEXTURED = 1 << 1,            // --texture
+    SCENE_FEATURE_MATERIAL_ARRAYS = 1 << 2,     // --material, texture arrays
+    SCENE_FEATURE_MATERIAL_BINDLESS = 1 << 3,   // --material, bindless handles
+    SCENE_FEATURE_SKINNED = 1 << 4,             // --characters: model matrices blended from the instance's palette
+    SCENE_FEATURE_LIT = 1 << 5,                 // --lights: clustered forward shading
+    SCENE_FEATURE_GBUFFER = 1 << 6,             // --lights --deferred: albedo and normal out, shaded afterwards
+    SCENE_FEATURE_DEPTH_ONLY = 1 << 7,          // --depth-prepass: the pre-pass, depth and nothing else
+    SCENE_FEATURE_OVERDRAW = 1 << 8,            // --overdraw: fragments counted into the colour by additive blending
+    SCENE_FEATURE_PICK_ID = 1 << 9,             // --gpu-pick: the instance's object index out to the ID attachment
+    SCENE_FEATURE_PULLED = 1 << 10,             // --pull: the vertices read from shader storage and decoded in the shader
+    SCENE_FEATURE_OIT_WEIGHTED = 1 << 11,       // --oit weighted: translucent, into the accumulation targets
+    SCENE_FEATURE_OIT_LIST = 1 << 12,           // --oit list: translucent, appended to the per-pixel lists
+    SCENE_FEATURE_SHADOWED = 1 << 13,           // --shadows: darkened by the sun's shadow maps
+    SCENE_FEATURE_STEREO = 1 << 14,             // --stereo: each instance twice, once into each eye's half
+    SCENE_FEATURE_BAKED = 1 << 15,              // --bake-animation, with SKINNED: the palettes from baked clips
+    SCENE_FEATURE_PIXEL_LOCAL = 1 << 16         // --gles --deferred, with GBUFFER: into pixel local storage
+};
+
+static const ShaderFeature scene_features[] =
+{
+    { "INSTANCED", 0, NULL, SHADER_STAGE_VERTEX },
+    { "TEXTURED", 0, NULL, SHADER_STAGE_FRAGMENT },
+    { "MATERIAL_ARRAYS", 0, NULL, SHADER_STAGE_FRAGMENT },
+    { "MATERIAL_BINDLESS", 430, "GL_ARB_bindless_texture", SHADER_STAGE_FRAGMENT },
+    { "SKINNED", 430, NULL, SHADER_STAGE_VERTEX },
+    { "LIT", 430, NULL, SHADER_STAGE_FRAGMENT },
+    { "GBUFFER", 0, NULL, SHADER_STAGE_FRAGMENT },
+    { "DEPTH_ONLY", 0, NULL, SHADER_STAGE_FRAGMENT },
+    { "OVERDRAW", 0, NULL, SHADER_STAGE_FRAGMENT },
+    { "PICK_ID", 0, NULL, SHADER_STAGE_VERTEX | SHADER_STAGE_FRAGMENT },
+    { "PULLED", 430, NULL, SHADER_STAGE_VERTEX },
+    { "OIT_WEIGHTED", 430, NULL, SHADER_STAGE_VERTEX | SHADER_STAGE_FRAGMENT },
+    { "OIT_LIST", 430, NULL, SHADER_STAGE_VERTEX | SHADER_STAGE_FRAGMENT },
+    { "SHADOWED", 430, NULL, SHADER_STAGE_FRAGMENT },
+    { "STEREO", 0, NULL, SHADER_STAGE_VERTEX },
+    { "BAKED", 430, NULL, SHADER_STAGE_VERTEX },
+    { "PIXEL_LOCAL", 0, "GL_EXT_shader_pixel_local_storage", SHADER_STAGE_FRAGMENT },
+};
+
+static const uint64_t scene_exclusive_features[] =
+{
+    SCENE_FEATURE_TEXTURED | SCENE_FEATURE_MATERIAL_ARRAYS | SCENE_FEATURE_MATERIAL_BINDLESS,
+    SCENE_FEATURE_INSTANCED | SCENE_FEATURE_SKINNED,
+    SCENE_FEATURE_PULLED | SCENE_FEATURE_SKINNED,     // the characters' joints and weights are attributes
+    SCENE_FEATURE_INSTANCED | SCENE_FEATURE_PULLED | SCENE_FEATURE_BAKED,
+    SCENE_FEATURE_LIT | SCENE_FEATURE_GBUFFER | SCENE_FEATURE_DEPTH_ONLY | SCENE_FEATURE_OVERDRAW,
+    SCENE_FEATURE_GBUFFER | SCENE_FEATURE_PICK_ID,    // both are the second colour attachment
+    SCENE_FEATURE_OIT_WEIGHTED | SCENE_FEATURE_OIT_LIST | SCENE_FEATURE_GBUFFER | SCENE_FEATURE_DEPTH_ONLY
+        | SCENE_FEATURE_OVERDRAW,
+    SCENE_FEATURE_OIT_WEIGHTED | SCENE_FEATURE_OIT_LIST | SCENE_FEATURE_PICK_ID,    // revealage takes the second attachment
+    SCENE_FEATURE_SHADOWED | SCENE_FEATURE_GBUFFER | SCENE_FEATURE_DEPTH_ONLY | SCENE_FEATURE_OVERDRAW
+};
+
+static void scene_shaders_init(ShaderPermutation* sp)
+{
+    shader_permutation_init(sp, vertex_shader_text, fragment_shader_text, scene_features,
+        (int)(sizeof(scene_features) / sizeof(scene_features[0])), scene_exclusive_features,
+        (int)(sizeof(scene_exclusive_features) / sizeof(scene_exclusive_features[0])));
 }
 
-// Key callback function for GLFW that catches user input
-static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+// Fixed vertex attribute locations (the layout(location = N) qualifiers above), so the VAO can be set up
+// before the program has finished compiling
+static const GLint vpos_location = 0;       // the vertex position location
+static const GLint vcol_location = 1;       // the vertex color location
+static_assert(PackedVertex::Attrib<0>::location == vpos_location && PackedVertex::Attrib<1>::location == vcol_location,
+    "the layouts declare the locations the VAOs are set up with");
+static const GLint vmodel_location = 2;     // first of the 3 model matrix row locations
+static const GLint vmaterial_location = 5;  // the per-instance material index
+static const GLint vobject_location = 8;    // --gpu-pick: the per-instance object index
+
+// How the objects are submitted each frame
+typedef enum DrawMode
 {
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GLFW_TRUE);
+    DRAW_MODE_NAIVE,        // one Draw uniform block range + glDrawElements per object
+    DRAW_MODE_INSTANCED,    // one glDrawElementsInstanced for all objects, model matrices in a per-instance VBO
+    DRAW_MODE_GPU_DRIVEN    // 4.3+: culled and transformed by a compute shader, one glMultiDrawElementsIndirect
+} DrawMode;
+
+// Per-object scene state, kept as separate arrays so the batch math in linmath_batch.h can stream over it
+typedef struct Scene
+{
+    int count;          // number of objects
+    float scale;        // uniform scale so the grid fits the view
+    dvec3 origin;       // world position of the grid's centre (--world-offset); everything below is relative to it
+    float* pos_x;       // grid position of each object
+    float* pos_y;
+    float* phase;       // rotation offset, so the copies don't all spin in lockstep
+    float* radius;      // bounding sphere of each object, for culling
+    Aabb* bounds;       // world-space box around each object's bounding circle
+    Bvh bvh;            // over "bounds": culling for big scenes, picking for all
+    SpatialGrid grid;   // --spatial-index grid: over "bounds" instead of the BVH, rebuilt when objects move
+    bool use_grid;      // the grid answers culling and picking; else the BVH does
+    Broadphase* broadphase; // --broadphase: the overlapping pairs, found through "grid" every tick; else NULL
+    float grid_cell;
+    OcclusionRaster* occlusion; // --cpu-occlusion: occluders drawn and the objects tested on the CPU; else NULL
+    float* turn_sin;    // rotation as of the tick before the latest, as its sine and cosine; the latest is one
+    float* turn_cos;    // step on, and frames are drawn between the two
+    uint64_t turn_tick; // the tick turn_sin and turn_cos are for: behind when ticks ran without the objects
+    FixedTimestep step; // the simulation clock: ticks per frame and where the frame falls between the last two
+    int material_count; // --material: object i wears material i % material_count; 0 without materials
+    const uint32_t* material_ids;   // --scene: object i wears material_ids[i] % material_count instead; else NULL
+    bool mapped;        // --scene, --bench-scene: pos_x, pos_y, phase, radius and bounds are the file's or generator's
+    BenchScene* bench;  // --bench-scene: its hierarchy, when dynamic, moves pos_x, pos_y and bounds each tick; else NULL
+    LodChain lod_chain; // the mesh's levels of detail, errors in world units; one level when it has no others
+    float lod_error;    // --lod-error PX: the most a level's error may project to; 0 always draws level 0
+    const QualityGovernor* governor;    // --governor: its tier's scale on lod_error applies; NULL without
+    uint8_t* lod;       // the level each object was last drawn at, for the hysteresis
+    float impostor_pixels;  // --impostors PX: objects spanning fewer pixels are drawn as impostors; 0 for none
+    uint8_t* impostor;  // --impostors: whether each object was last drawn as one, for the hysteresis; else NULL
+    Significance* significance; // --significance PX: visible objects updated every 1 to 8 frames by size; else NULL
+    uint32_t* turn_ticks;   // --significance: the tick each object's turn is for (its low 32 bits); else NULL
+    CoherentCull* coherent; // --coherent: culled and depth-sorted from the last frame's results; else NULL
+} Scene;
+
+#define SCENE_SPIN_RATE 1.f     // radians per simulated second
+#define SCENE_MAX_TICKS 8       // per frame: after a longer stall the simulation drops the rest and runs slow
+#define SCENE_RESYNC_TICKS 1024 // the turns' rounding is cleared this often (17 s at 60 Hz), from the closed form
+#define SCENE_MAX_LAG (SIGNIFICANCE_MAX_PERIOD * SCENE_MAX_TICKS)  // --significance: ticks a visible turn is behind
+
+// Below this many objects the linear SIMD sweep culls faster than walking the BVH
+#define SCENE_BVH_CULL_MIN_OBJECTS 16384
+
+// An object only drops to a coarser level once its error there is this much under --lod-error
+#define SCENE_LOD_HYSTERESIS 0.25f
+
+// Lays out "count" copies of the triangle on a square grid covering [-1, 1], simulated at "tick_rate" Hz
+static void scene_init(Scene* scene, int count, double tick_rate)
+{
+    const int cols = (int)ceil(sqrt((double)count));
+    const float cell = 2.f / cols;
+
+    scene->count = count;
+    scene->scale = count > 1 ? cell * 0.5f : 1.f;
+    scene->origin[0] = scene->origin[1] = scene->origin[2] = 0.0;
+    scene->pos_x = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->pos_y = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->phase = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->radius = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->bounds = (Aabb*)malloc(sizeof(Aabb) * count);
+    scene->turn_sin = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->turn_cos = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->turn_tick = 0;
+    scene->lod = (uint8_t*)calloc(count, 1);
+    fixed_timestep_init(&scene->step, tick_rate, SCENE_MAX_TICKS);
+    scene->material_count = 0;
+    scene->material_ids = NULL;
+    scene->mapped = false;
+    scene->bench = NULL;
+    scene->lod_chain.level_count = 1;
+    scene->lod_chain.error[0] = 0.f;
+    scene->lod_error = 0.f;
+    scene->governor = NULL;
+    memset(&scene->grid, 0, sizeof(scene->grid));
+    scene->use_grid = false;
+    scene->grid_cell = 0.f;
+    scene->occlusion = NULL;
+    scene->broadphase = NULL;
+    scene->impostor_pixels = 0.f;
+    scene->impostor = NULL;
+    scene->significance = NULL;
+    scene->turn_ticks = NULL;
+    scene->coherent = NULL;
+
+    // Every copy is the same triangle, bounded by a circle around its origin
+    float mesh_radius = 0.f;
+    for (size_t v = 0; v < sizeof(vertices) / sizeof(vertices[0]); ++v)
+        mesh_radius = fmaxf(mesh_radius, vec2_len(vertices[v].pos));
+
+    for (int i = 0; i < count; ++i)
+    {
+        scene->pos_x[i] = count > 1 ? -1.f + cell * (i % cols + 0.5f) : 0.f;
+        scene->pos_y[i] = count > 1 ? -1.f + cell * (i / cols + 0.5f) : 0.f;
+        scene->phase[i] = count > 1 ? (float)i * 0.1f : 0.f;
+        scene->radius[i] = mesh_radius * scene->scale;
+        const Aabb box = { { scene->pos_x[i] - scene->radius[i], scene->pos_y[i] - scene->radius[i], -scene->radius[i] },
+            { scene->pos_x[i] + scene->radius[i], scene->pos_y[i] + scene->radius[i], scene->radius[i] } };
+        scene->bounds[i] = box;
+    }
+    fast_sincos_batch(scene->turn_sin, scene->turn_cos, scene->phase, (size_t)count);
+
+    // Objects only spin in place, so one build at load stays exact (moving objects would bvh_refit)
+    if (bvh_init(&scene->bvh, (uint32_t)count))
+        bvh_build(&scene->bvh, scene->bounds, (uint32_t)count);
 }
 
-int main(void)
+// --scene: the objects of "file" in place of the grid. The arrays that never change after loading are the
+// mapping's own (64-byte aligned in the file); only the simulated rotations are the scene's, and the file's BVH is
+// used as it is when it has one. Entity 0's scale stands for every object's, and z is taken as 0.
+static void scene_init_file(Scene* scene, const SceneFile* file, double tick_rate)
 {
-    // Setup the error callback
-    glfwSetErrorCallback(error_callback);
+    const SceneEntities* e = &file->entities;
+    const int count = (int)e->count;
+    scene->count = count;
+    scene->scale = e->scale[0];
+    scene->origin[0] = scene->origin[1] = scene->origin[2] = 0.0;
+    scene->pos_x = (float*)e->x;        // only ever read
+    scene->pos_y = (float*)e->y;
+    scene->phase = (float*)e->angle;
+    scene->radius = (float*)e->radius;
+    scene->bounds = (Aabb*)e->bounds;
+    scene->turn_sin = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->turn_cos = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->turn_tick = 0;
+    scene->lod = (uint8_t*)calloc(count, 1);
+    fixed_timestep_init(&scene->step, tick_rate, SCENE_MAX_TICKS);
+    scene->material_count = 0;
+    scene->material_ids = e->material;
+    scene->mapped = true;
+    scene->bench = NULL;
+    scene->lod_chain.level_count = 1;
+    scene->lod_chain.error[0] = 0.f;
+    scene->lod_error = 0.f;
+    scene->governor = NULL;
+    memset(&scene->grid, 0, sizeof(scene->grid));
+    scene->use_grid = false;
+    scene->grid_cell = 0.f;
+    scene->occlusion = NULL;
+    scene->broadphase = NULL;
+    scene->impostor_pixels = 0.f;
+    scene->impostor = NULL;
+    scene->significance = NULL;
+    scene->turn_ticks = NULL;
+    scene->coherent = NULL;
+    fast_sincos_batch(scene->turn_sin, scene->turn_cos, e->angle, (size_t)count);
+    if (!scene_file_bvh(file, &scene->bvh) && bvh_init(&scene->bvh, (uint32_t)count))
+        bvh_build(&scene->bvh, scene->bounds, (uint32_t)count);
+}
 
-    // Try to init GLFW, exit on failure
-    if (!glfwInit())
-        exit(EXIT_FAILURE);
+// --bench-scene: the generated objects in place of the grid, drawn from the generator's arrays. A dynamic
+// hierarchy moves them each tick (scene_simulate), so the BVH is built here and refitted after every move.
+static void scene_init_bench(Scene* scene, BenchScene* bench, double tick_rate)
+{
+    const int count = (int)bench->count;
+    scene->count = count;
+    scene->scale = bench->object_scale;
+    scene->origin[0] = scene->origin[1] = scene->origin[2] = 0.0;
+    scene->pos_x = bench->x;
+    scene->pos_y = bench->y;
+    scene->phase = bench->angle;
+    scene->radius = bench->radius;
+    scene->bounds = bench->bounds;
+    scene->turn_sin = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->turn_cos = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    scene->turn_tick = 0;
+    scene->lod = (uint8_t*)calloc(count, 1);
+    fixed_timestep_init(&scene->step, tick_rate, SCENE_MAX_TICKS);
+    scene->material_count = 0;
+    scene->material_ids = bench->material;
+    scene->mapped = true;
+    scene->bench = bench->moving ? bench : NULL;
+    scene->lod_chain.level_count = 1;
+    scene->lod_chain.error[0] = 0.f;
+    scene->lod_error = 0.f;
+    scene->governor = NULL;
+    memset(&scene->grid, 0, sizeof(scene->grid));
+    scene->use_grid = false;
+    scene->grid_cell = 0.f;
+    scene->occlusion = NULL;
+    scene->broadphase = NULL;
+    scene->impostor_pixels = 0.f;
+    scene->impostor = NULL;
+    scene->significance = NULL;
+    scene->turn_ticks = NULL;
+    scene->coherent = NULL;
+    fast_sincos_batch(scene->turn_sin, scene->turn_cos, bench->angle, (size_t)count);
+    if (bvh_init(&scene->bvh, (uint32_t)count))
+        bvh_build(&scene->bvh, scene->bounds, (uint32_t)count);
+}
 
-    // Setup Window Hints
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);      // Required OpenGL version minimum
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // Default core
+// --save-scene: the objects as a scene file, or as its text form for a path ending in .txt. Every object draws
+// "mesh_path" (NULL: the built-in triangle, and no meshes named).
+static bool scene_save(const Scene* scene, const char* path, const char* mesh_path)
+{
+    const uint32_t count = (uint32_t)scene->count;
+    float* zero = (float*)calloc(count, sizeof(float));
+    float* scale = (float*)malloc(sizeof(float) * count);
+    uint32_t* mesh = (uint32_t*)calloc(count, sizeof(uint32_t));
+    uint32_t* material = (uint32_t*)calloc(count, sizeof(uint32_t));
+    bool ok = zero && scale && mesh && material;
+    for (uint32_t i = 0; i < count && ok; ++i)
+    {
+        scale[i] = scene->scale;
+        if (scene->material_count > 0)
+            material[i] = (scene->material_ids ? scene->material_ids[i] : i) % (uint32_t)scene->material_count;
+    }
+    const SceneEntities entities = { count, scene->pos_x, scene->pos_y, zero, scene->phase, scale, mesh, material,
+        scene->radius, scene->bounds };
+    const uint32_t mesh_count = mesh_path ? 1u : 0u;
+    const size_t length = strlen(path);
+    if (!ok)
+        fprintf(stderr, "scene_file: out of memory for %u objects\n", count);
+    else if (length < 4 || strcmp(path + length - 4, ".txt"))
+        ok = scene_file_write(path, &entities, &mesh_path, mesh_count, (uint32_t)scene->material_count, &scene->bvh);
+    else
+    {
+        FILE* out = fopen(path, "w");
+        ok = out && scene_file_write_text(out, &entities, &mesh_path, mesh_count, (uint32_t)scene->material_count);
+        ok = out && fclose(out) == 0 && ok;
+        if (!ok)
+            fprintf(stderr, "scene_file: can't write %s\n", path);
+    }
+    free(zero);
+    free(scale);
+    free(mesh);
+    free(material);
+    return ok;
+}
 
-    // Try to create window
-    GLFWwindow* window = glfwCreateWindow(640, 480, "OpenGL Triangle", NULL, NULL);
-    if (!window)
+static void scene_free(Scene* scene)
+{
+    if (!scene->mapped)
     {
-        // Exit on failure (window is NULL on failure)
-        glfwTerminate();
-        exit(EXIT_FAILURE);
+        linmath_aligned_free(scene->pos_x);
+        linmath_aligned_free(scene->pos_y);
+        linmath_aligned_free(scene->phase);
+        linmath_aligned_free(scene->radius);
+        free(scene->bounds);
     }
+    linmath_aligned_free(scene->turn_sin);
+    linmath_aligned_free(scene->turn_cos);
+    free(scene->lod);
+    bvh_destroy(&scene->bvh);
+    spatial_grid_destroy(&scene->grid);
+    if (scene->broadphase)
+        broadphase_destroy(scene->broadphase);
+    free(scene->broadphase);
+    if (scene->occlusion)
+        occlusion_raster_destroy(scene->occlusion);
+    free(scene->occlusion);
+    free(scene->impostor);
+    if (scene->significance)
+        significance_destroy(scene->significance);
+    free(scene->significance);
+    free(scene->turn_ticks);
+    if (scene->coherent)
+        coherent_cull_destroy(scene->coherent);
+    free(scene->coherent);
+}
 
-    // Key callbacks - used for input
-    glfwSetKeyCallback(window, key_callback);
+// --spatial-index grid: the objects indexed by a spatial hash grid instead of the BVH. It's rebuilt from scratch
+// every tick they move, where the BVH would be refit and degrade. Cells are twice the mean bounding radius, about an
+// object each. Returns false (the BVH stays) when out of memory.
+static bool scene_use_grid(Scene* scene)
+{
+    double radius = 0.0;
+    for (int i = 0; i < scene->count; ++i)
+        radius += scene->radius[i];
+    if (!spatial_grid_init(&scene->grid, (uint32_t)scene->count))
+        return false;
+    scene->grid_cell = scene->count ? (float)(2.0 * radius / scene->count) : 1.f;
+    spatial_grid_build(&scene->grid, NULL, scene->bounds, (uint32_t)scene->count, scene->grid_cell);
+    scene->use_grid = true;
+    return true;
+}
 
-    // Sets the context for OpenGL to draw
-    glfwMakeContextCurrent(window);
-    
-    // Loads OpenGL through GLAD
-    gladLoadGL();
+// --broadphase: collision pairs through the grid the scene already keeps, updated every tick the objects are
+// simulated. Returns false when there's no grid or out of memory.
+static bool scene_use_broadphase(Scene* scene)
+{
+    if (!scene->use_grid)
+        return false;
+    scene->broadphase = (Broadphase*)malloc(sizeof(Broadphase));
+    if (scene->broadphase && broadphase_init(scene->broadphase, (uint32_t)scene->count, JOB_SYSTEM_MAX_THREADS))
+        return true;
+    free(scene->broadphase);
+    scene->broadphase = NULL;
+    return false;
+}
 
-    // Buffer intervals
-    glfwSwapInterval(1);
+// --cpu-occlusion: a depth buffer of SCENE_OCCLUSION_WIDTH x SCENE_OCCLUSION_HEIGHT pixels on the CPU, for
+// scene_occlusion_cull to draw the frame's biggest objects into. Returns false when out of memory.
+#define SCENE_OCCLUSION_WIDTH 256
+#define SCENE_OCCLUSION_HEIGHT 128
+#define SCENE_OCCLUDERS 4096            // most objects drawn as occluders a frame
+#define SCENE_OCCLUDER_MIN_PIXELS 8.f   // the narrowest an object's bounding circle may be on the buffer to be one
+static bool scene_use_occlusion(Scene* scene)
+{
+    scene->occlusion = (OcclusionRaster*)malloc(sizeof(OcclusionRaster));
+    const uint32_t triangles = SCENE_OCCLUDERS * (uint32_t)(sizeof(indices) / sizeof(indices[0]) / 3);
+    if (scene->occlusion
+        && occlusion_raster_init(scene->occlusion, SCENE_OCCLUSION_WIDTH, SCENE_OCCLUSION_HEIGHT, triangles))
+        return true;
+    free(scene->occlusion);
+    scene->occlusion = NULL;
+    return false;
+}
+
+// --impostors: objects whose bounding circle spans fewer than "pixels" pixels are drawn as impostors, until it
+// spans a quarter more (SCENE_IMPOSTOR_HYSTERESIS). Returns false when out of memory.
+#define SCENE_IMPOSTOR_HYSTERESIS 0.25f
+static bool scene_use_impostors(Scene* scene, float pixels)
+{
+    scene->impostor = (uint8_t*)calloc(scene->count, 1);
+    scene->impostor_pixels = scene->impostor ? pixels : 0.f;
+    return scene->impostor != NULL;
+}
 
-    // NOTE: OpenGL error checks have been omitted for brevity
+// --significance: the visible objects' turns, levels of detail and impostor choices are only updated every 1 to
+// SIGNIFICANCE_MAX_PERIOD frames, less often the fewer pixels under "pixels" they span, and the objects out of view
+// not at all. Between updates a turn is made up when the frame is drawn. Returns false when out of memory.
+static bool scene_use_significance(Scene* scene, float pixels)
+{
+    scene->significance = (Significance*)malloc(sizeof(Significance));
+    scene->turn_ticks = (uint32_t*)calloc(scene->count ? scene->count : 1, sizeof(uint32_t));
+    if (scene->significance && scene->turn_ticks
+        && significance_init(scene->significance, (uint32_t)scene->count, pixels))
+        return true;
+    free(scene->significance);
+    free(scene->turn_ticks);
+    scene->significance = NULL;
+    scene->turn_ticks = NULL;
+    scene->coherent = NULL;
+    return false;
+}
 
-    // Setup vertex buffer object for vertex data storage
-    GLuint vertex_buffer;                                                       // Holds the ID of the buffer objects
-    glGenBuffers(1, &vertex_buffer);                                            // Generates X buffer objects (set to 1 in this example, assigned to vertex_bffer))
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);                               // binds the array buffer to the created vertex buffer - all subsequent operations on GL_ARRAY_BUFFER are for this array
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);  // initializes buffer data -> GL_ARRAY_BUFFER specifies the target, sizeof(verticies) is size of the data, verticies is vertex dat, GL_STATIC_DRAW is how the data is used
+// --coherent: the visible list carried over from frame to frame (scene/coherent_cull.h), only the objects near the
+// frustum's sides or moved tested again, and kept near to far so the draws are recorded nearly in key order. It
+// stands in for the grid or BVH when culling. Returns false when out of memory.
+static bool scene_use_coherent(Scene* scene)
+{
+    scene->coherent = (CoherentCull*)malloc(sizeof(CoherentCull));
+    if (scene->coherent && coherent_cull_init(scene->coherent, (uint32_t)scene->count))
+        return true;
+    free(scene->coherent);
+    scene->coherent = NULL;
+    return false;
+}
 
-    // Setup the vertex shader
-    const GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);  // Creates a new shader of type GL_VERTEX_SHADER
-    glShaderSource(vertex_shader, 1, &vertex_shader_text, NULL);    // Source of shader -> (source, number of strings in shader source, pointer to the shader source string, string length auto)
-    glCompileShader(vertex_shader);                                 // Compiles the shader source code in vertex_shader
+// --significance: how many ticks object i's turn is behind the scene's, which the frame's turn makes up; else 0
+static uint32_t scene_lag(const Scene* scene, uint32_t i)
+{
+    return scene->turn_ticks ? (uint32_t)scene->turn_tick - scene->turn_ticks[i] : 0;
+}
 
-    // Setup the fragment (pixel) shader - basically same as above
-    const GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_text, NULL);
-    glCompileShader(fragment_shader);
+// --scene-reload: the --scene file is watched, and each new version of it is loaded and set up off the main thread,
+// then swapped in between two frames. The loader thread maps the file, faults its pages in, and builds what the
+// scene keeps beside them (the BVH when the file has none, and the grid, broadphase, occlusion buffer, impostor
+// flags and significance tiers it was started with). The swap is a struct exchange on the main thread; the old
+// version goes back to the loader thread to be freed. The renderer and the frame arenas are sized for "capacity"
+// objects at startup, so a version with more is refused. Replace the file by renaming over it: one written in place changes under the
+// mapping of the version being drawn.
+#define SCENE_RELOAD_POLL_SECONDS 0.25  // between looks at the file
 
-    // Creates the shader program and attaches the shaders to it.
-    const GLuint program = glCreateProgram();       // Creates program and gives it unique ID
-    glAttachShader(program, vertex_shader);         // attach vertex shader
-    glAttachShader(program, fragment_shader);       // attach fragment shader
-    glLinkProgram(program);                         // Links the attached shaders to the program
+typedef struct SceneReload
+{
+    const char* path;
+    int capacity;                   // most objects a version may have
+    double tick_rate;
+    bool spatial_grid;              // the setup each version gets, as the first had
+    bool broadphase;
+    bool cpu_occlusion;
+    float impostor_pixels;
+    float significance_pixels;
+    bool coherent;
+    FileWatcher watcher;
+    int watch_id;
+    double last_poll;               // steady clock, seconds
+    SceneFile* live_file;           // main's: the file the drawn version's arrays point into
+    std::thread thread;
+    std::mutex mutex;               // everything below
+    std::condition_variable wake;   // a version to load or to free, or stop
+    bool stop;
+    bool load;                      // the file changed since the last load began
+    bool ready;                     // "next" is set up and waits for a frame boundary
+    Scene next;
+    SceneFile next_file;
+    bool retire;                    // "old" and "old_file" are to be freed
+    Scene old;
+    SceneFile old_file;
 
-    const GLint mvp_location = glGetUniformLocation(program, "MVP");    // Gets the MVP (model-view-projection) location 
-    const GLint vpos_location = glGetAttribLocation(program, "vPos");   // the vertex position location
-    const GLint vcol_location = glGetAttribLocation(program, "vCol");   // the vertex color location
+    // Totals over the run
+    uint32_t loads;
+    uint32_t refused;               // versions that couldn't be opened or had too many objects
+    uint32_t swaps;
+    double load_ms;                 // the last version's, on the loader thread
+    double swap_ms;                 // the longest swap, on the main thread
+} SceneReload;
 
-    // Sets up Vertex Array object (VAO) to manage vertex attribute configs
-    GLuint vertex_array;                        // UID for vertex array
-    glGenVertexArrays(1, &vertex_array);        // generates X (1, here) arrays and assigns it's id to vertex array
-    glBindVertexArray(vertex_array);            // bind the VAO - vertex attributes or buffer configs are stored in it
-    glEnableVertexAttribArray(vpos_location);   // enables vertex attributes at location
-    glVertexAttribPointer(vpos_location, 2, GL_FLOAT, GL_FALSE,     // specify vertex attribute layouts
-        sizeof(Vertex), (void*)offsetof(Vertex, pos));
-    glEnableVertexAttribArray(vcol_location);   // enables vertex attributes at location
-    glVertexAttribPointer(vcol_location, 3, GL_FLOAT, GL_FALSE,     // specify vertex attribute layouts
-        sizeof(Vertex), (void*)offsetof(Vertex, col));
-
-    // While the window should not close
-    while (!glfwWindowShouldClose(window))
-    {
-        // Gets the framebuffer with the GLFW window and sets aspect ratio
-        int width, height;
-        glfwGetFramebufferSize(window, &width, &height);
-        const float ratio = width / (float)height;
+static double steady_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-        // Defines the area of the window (0,0 = bottom of viewport)
-        glViewport(0, 0, width, height);
+// The new version of the file as a scene set up like the first, or false (logged)
+static bool scene_reload_build(SceneReload* rl, Scene* scene, SceneFile* file)
+{
+    if (!scene_file_open(file, rl->path))
+        return false;
+    const uint32_t count = file->header->entity_count;
+    if (!count || count > (uint32_t)rl->capacity)
+    {
+        fprintf(stderr, "Warning: %s now has %u entities, and --scene-reload has room for 1 to %d; not reloaded\n",
+            rl->path, count, rl->capacity);
+        scene_file_close(file);
+        return false;
+    }
+    // Page faults here rather than in the first frames that read the arrays
+    const unsigned char* bytes = (const unsigned char*)file->file.data;
+    volatile unsigned char touched = 0;
+    for (size_t offset = 0; offset < file->file.size; offset += 4096)
+        touched = touched + bytes[offset];
+    scene_init_file(scene, file, rl->tick_rate);
+    if (rl->spatial_grid)
+        scene_use_grid(scene);
+    if (rl->broadphase)
+        scene_use_broadphase(scene);
+    if (rl->cpu_occlusion)
+        scene_use_occlusion(scene);
+    if (rl->impostor_pixels > 0.f)
+        scene_use_impostors(scene, rl->impostor_pixels);
+    if (rl->significance_pixels > 0.f)
+        scene_use_significance(scene, rl->significance_pixels);
+    if (rl->coherent)
+        scene_use_coherent(scene);
+    return true;
+}
 
-        // Clears the color buffer and resets to predefined color
-        glClear(GL_COLOR_BUFFER_BIT);
+static void scene_reload_thread(SceneReload* rl)
+{
+    cpu_trace_thread_name("scene reload");
+    std::unique_lock<std::mutex> lock(rl->mutex);
+    for (;;)
+    {
+        rl->wake.wait(lock, [rl] { return rl->stop || rl->retire || (rl->load && !rl->ready); });
+        if (rl->retire)
+        {
+            Scene old = rl->old;
+            SceneFile old_file = rl->old_file;
+            rl->retire = false;
+            lock.unlock();
+            scene_free(&old);
+            scene_file_close(&old_file);    // after the scene, whose arrays were its mapping
+            lock.lock();
+            continue;
+        }
+        if (rl->stop)
+            break;
+        rl->load = false;
+        lock.unlock();
+        const double start = steady_seconds();
+        Scene next;
+        SceneFile file;
+        const bool built = scene_reload_build(rl, &next, &file);
+        lock.lock();
+        if (!built)
+        {
+            ++rl->refused;
+            continue;
+        }
+        rl->next = next;
+        rl->next_file = file;
+        rl->ready = true;
+        ++rl->loads;
+        rl->load_ms = (steady_seconds() - start) * 1000.0;
+    }
+}
 
-        // Sets up a 4x4 matrix
-        mat4x4 m, p, mvp;   // m = model matrix (transforms object coordinates) // p = proejction matrix (handles perspective) // mvp = model-view-projection matrix, combines pm & p
-        mat4x4_identity(m); // sets "m" to be identity matrix (starting point for transformations)
-        mat4x4_rotate_Z(m, m, (float)glfwGetTime());    // apply rotation - rotates "m" around z axis by angle derived from glfwGetTime()
-        mat4x4_ortho(p, -ratio, ratio, -1.f, 1.f, 1.f, -1.f);   // create orthographic project matrix
-        mat4x4_mul(mvp, p, m);  // Combine the matricies
+// Starts watching "path", the file "live_file" (main's) has open and "scene" was set up from with the options
+// given. Returns false (logged) when the file can't be watched.
+static bool scene_reload_init(SceneReload* rl, const char* path, int capacity, const Scene* scene,
+    SceneFile* live_file, double tick_rate)
+{
+    rl->path = path;
+    rl->capacity = capacity;
+    rl->tick_rate = tick_rate;
+    rl->spatial_grid = scene->use_grid;
+    rl->broadphase = scene->broadphase != NULL;
+    rl->cpu_occlusion = scene->occlusion != NULL;
+    rl->impostor_pixels = scene->impostor_pixels;
+    rl->significance_pixels = scene->significance ? scene->significance->full_pixels : 0.f;
+    rl->coherent = scene->coherent != NULL;
+    rl->live_file = live_file;
+    rl->last_poll = steady_seconds();
+    rl->stop = rl->load = rl->ready = rl->retire = false;
+    rl->loads = rl->refused = rl->swaps = 0;
+    rl->load_ms = rl->swap_ms = 0.0;
+    file_watcher_init(&rl->watcher);
+    rl->watch_id = file_watcher_add(&rl->watcher, path);
+    if (rl->watch_id < 0)
+        return false;
+    rl->thread = std::thread(scene_reload_thread, rl);
+    return true;
+}
 
-        glUseProgram(program);  // activates the specified shader for subsequent OpenGL rendering calls
-        glUniformMatrix4fv(mvp_location, 1, GL_FALSE, (const GLfloat*)&mvp);    // Sends the "mvp" matrix to the GPU
-        glBindVertexArray(vertex_array);    // binds the vertex array object so OpenGL can interpret the vertex data
-        glDrawArrays(GL_TRIANGLES, 0, 3);   // Draw the object (GL_TRIANGLES is the type of object to draw)
+// Stops the loader thread and frees a version that was never swapped in
+static void scene_reload_destroy(SceneReload* rl)
+{
+    {
+        std::lock_guard<std::mutex> lock(rl->mutex);
+        rl->stop = true;
+    }
+    rl->wake.notify_one();
+    rl->thread.join();
+    if (rl->ready)
+    {
+        scene_free(&rl->next);
+        scene_file_close(&rl->next_file);
+    }
+}
 
-        glfwSwapBuffers(window);    // Swaps front and back buffers
-        glfwPollEvents();           // process all pending events in the event queue (inputs, e.g.)
+// On the main thread between frames: looks at the file now and then, and swaps a version that's ready in for
+// "scene". Never waits for the loader thread. What was given to the scene after its setup carries over: the
+// clock, the origin, the materials and the levels of detail (their errors rescaled to the new objects' scale).
+static void scene_reload_poll(SceneReload* rl, Scene* scene)
+{
+    const double now = steady_seconds();
+    if (now - rl->last_poll >= SCENE_RELOAD_POLL_SECONDS)
+    {
+        rl->last_poll = now;
+        if (file_watcher_poll(&rl->watcher) && file_watcher_take(&rl->watcher, rl->watch_id))
+        {
+            {
+                std::lock_guard<std::mutex> lock(rl->mutex);
+                rl->load = true;
+            }
+            rl->wake.notify_one();
+        }
     }
+    std::unique_lock<std::mutex> lock(rl->mutex, std::try_to_lock);
+    if (!lock.owns_lock() || !rl->ready || rl->retire)
+        return;
+    CPU_TRACE_SCOPE("scene swap");
+    Scene* next = &rl->next;
+    next->step = scene->step;       // its turns are a tick behind: the next simulate sets them from the closed form
+    dvec3_dup(next->origin, scene->origin);
+    next->material_count = scene->material_count;
+    next->lod_chain = scene->lod_chain;
+    for (int l = 0; l < next->lod_chain.level_count && scene->scale != 0.f; ++l)
+        next->lod_chain.error[l] = scene->lod_chain.error[l] / scene->scale * next->scale;
+    next->lod_error = scene->lod_error;
+    next->governor = scene->governor;
+    rl->old = *scene;
+    rl->old_file = *rl->live_file;
+    *scene = *next;
+    *rl->live_file = rl->next_file;
+    rl->ready = false;
+    rl->retire = true;
+    ++rl->swaps;
+    lock.unlock();
+    rl->wake.notify_one();
+    const double swap_ms = (steady_seconds() - now) * 1000.0;
+    rl->swap_ms = swap_ms > rl->swap_ms ? swap_ms : rl->swap_ms;
+    printf("scene: %s reloaded, %d objects, set up in %.1f ms off the main thread\n", rl->path, scene->count,
+        rl->load_ms);
+}
 
-    // Destroy window on "esc"
-    glfwDestroyWindow(window);
+static void scene_reload_print(const SceneReload* rl, FILE* out)
+{
+    fprintf(out, "scene reload: %u versions loaded (the last in %.1f ms), %u refused, %u swapped in, the longest "
+        "swap %.3f ms\n", rl->loads, rl->load_ms, rl->refused, rl->swaps, rl->swap_ms);
+}
 
-    // Terminate GLFW
-    glfwTerminate();
+// One frame's transform update, split across the job system in ranges of objects
+typedef struct SceneUpdate
+{
+    Scene* scene;
+    FrameArena* arena;          // the frame's: each job's scratch comes from its thread's sub-arena
+    const float* frame_sin;     // [lag]: the turn from "lag" ticks before the one before the latest to the frame, a
+    const float* frame_cos;     // fraction of a step past; only [0] without --significance, every turn being at it
+    const uint32_t* visible;    // NULL: every object, in order
+    mat3x4* model;
+    uint32_t* material;         // NULL: no material indices wanted
+    uint32_t* object;           // NULL: no object indices wanted (--gpu-pick's IDs)
+} SceneUpdate;
 
-    // Exit, with success code
-    exit(EXIT_SUCCESS);
-}
\ No newline at end of file
+#define SCENE_UPDATE_GRAIN 4096     // objects per job: ~0.1 ms of work, big enough to amortise scheduling
+
+// Per-thread scratch one range of at most SCENE_UPDATE_GRAIN objects needs: gathered x, y, sines and cosines
+#define SCENE_UPDATE_SCRATCH (4 * (SCENE_UPDATE_GRAIN * sizeof(float) + FRAME_ARENA_ALIGN))
+
+// One simulation tick's work for objects [begin, end): by angle addition, every rotation turns by the step,
+// whose sine and cosine are worked out once per tick rather than per object
+typedef struct SceneTick
+{
+    Scene* scene;
+    float step_sin;
+    float step_cos;
+    float resync;       // instead, set every rotation to its phase plus this, wrapped: the closed form
+    bool resyncing;
+    const uint32_t* objects;    // resyncing: NULL for every object, else entries [begin, end) of it are the ones
+    uint32_t tick;      // with "objects": the tick their turns are then for, into the scene's turn_ticks
+} SceneTick;
+
+static void scene_tick_range(void* data, size_t begin, size_t end)
+{
+    const SceneTick* tick = (const SceneTick*)data;
+    Scene* scene = tick->scene;
+    if (!tick->resyncing)
+    {
+        sincos_rotate_batch(scene->turn_sin + begin, scene->turn_cos + begin, tick->step_sin, tick->step_cos,
+            end - begin);
+        return;
+    }
+    float angle[LINMATH_H_FAST_BLOCK];
+    if (tick->objects)
+    {
+        // --significance: the objects due, gathered and scattered around the batch
+        float s[LINMATH_H_FAST_BLOCK], c[LINMATH_H_FAST_BLOCK];
+        for (size_t base = begin; base < end; base += LINMATH_H_FAST_BLOCK)
+        {
+            const size_t m = end - base < LINMATH_H_FAST_BLOCK ? end - base : LINMATH_H_FAST_BLOCK;
+            for (size_t k = 0; k < m; ++k)
+                angle[k] = scene->phase[tick->objects[base + k]] + tick->resync;
+            fast_sincos_batch(s, c, angle, m);
+            for (size_t k = 0; k < m; ++k)
+            {
+                const uint32_t i = tick->objects[base + k];
+                scene->turn_sin[i] = s[k];
+                scene->turn_cos[i] = c[k];
+                scene->turn_ticks[i] = tick->tick;
+            }
+        }
+        return;
+    }
+    for (size_t base = begin; base < end; base += LINMATH_H_FAST_BLOCK)
+    {
+        const size_t m = end - base < LINMATH_H_FAST_BLOCK ? end - base : LINMATH_H_FAST_BLOCK;
+        for (size_t k = 0; k < m; ++k)
+            angle[k] = scene->phase[base + k] + tick->resync;
+        fast_sincos_batch(scene->turn_sin + base, scene->turn_cos + base, angle, m);
+    }
+}
+
+// Spends a frame's real time "delta" on fixed ticks. "objects" false skips the per-object work and only
+// advances the clock (the GPU-driven path evaluates the rotation in closed form from the simulated time); the
+// rotations catch up, from the closed form, once the objects are back. So is the turns' rounding cleared every
+// SCENE_RESYNC_TICKS ticks. Either way only the tick count goes in, so the same ticks give the same rotations
+// however fast frames come. With --significance the rotations are left to scene_update, which sets each from the
+// closed form as it falls due. Returns the number of ticks run.
+static int scene_simulate(Scene* scene, JobSystem* jobs, double delta, bool objects)
+{
+    CPU_TRACE_SCOPE("simulate");
+    const int ticks = fixed_timestep_advance(&scene->step, delta);
+    const uint64_t target = scene->step.ticks ? scene->step.ticks - 1 : 0;     // the tick before the latest
+    if (!objects || target == scene->turn_tick)
+        return ticks;
+    // Each tick since the last frame's, in order: --bench-scene's hierarchy posed for it and, with --broadphase,
+    // the grid rebuilt around it and its pairs found, so contacts that begin and end between two frames still
+    // count. Culling only needs the latest tick's index. A gap longer than this frame's ticks (a pause, or the
+    // objects skipped) goes straight to the latest.
+    const uint64_t first = target - scene->turn_tick > (uint64_t)ticks ? target : scene->turn_tick + 1;
+    for (uint64_t t = first; (scene->bench || scene->broadphase) && t <= target; ++t)
+    {
+        if (scene->bench)
+        {
+            CPU_TRACE_SCOPE("hierarchy");
+            bench_scene_animate(scene->bench, (double)t * scene->step.dt);
+            if (scene->use_grid && (scene->broadphase || t == target))
+                spatial_grid_build(&scene->grid, jobs, scene->bounds, (uint32_t)scene->count, scene->grid_cell);
+            else if (!scene->use_grid && t == target)
+                bvh_refit(&scene->bvh, scene->bounds);
+        }
+        if (scene->broadphase)
+        {
+            // Only the objects the tick moved query the grid; a scene that stands still keeps its pairs
+            CPU_TRACE_SCOPE("broadphase");
+            broadphase_update(scene->broadphase, &scene->grid, scene->bounds, (uint32_t)scene->count, jobs);
+        }
+    }
+    if (scene->bench && scene->coherent)
+        coherent_cull_reset(scene->coherent);
+    if (scene->significance)
+    {
+        scene->turn_tick = target;
+        return ticks;
+    }
+    const double step = SCENE_SPIN_RATE * scene->step.dt;
+    SceneTick tick = { scene, linmath_sinf((float)step), linmath_cosf((float)step), 0.f, false, NULL, 0 };
+    uint64_t turns = target - scene->turn_tick;
+    if (turns > (uint64_t)ticks || target / SCENE_RESYNC_TICKS != scene->turn_tick / SCENE_RESYNC_TICKS)
+    {
+        tick.resync = (float)fmod(step * (double)target, 2.0 * 3.14159265358979323846);
+        tick.resyncing = true;
+        turns = 1;
+    }
+    const size_t count = (size_t)scene->count;
+    for (uint64_t t = 0; t < turns; ++t)
+    {
+        if (count <= SCENE_UPDATE_GRAIN || jobs->thread_count == 1)
+            scene_tick_range(&tick, 0, count);
+        else
+            job_wait(jobs, job_parallel_for(jobs, scene_tick_range, &tick, count, SCENE_UPDATE_GRAIN));
+    }
+    scene->turn_tick = target;
+    return ticks;
+}
+
+// Model matrices [begin, end) of the output list; with culling, entry k is object visible[k]
+static void scene_update_range(void* data, size_t begin, size_t end)
+{
+    const SceneUpdate* update = (const SceneUpdate*)data;
+    const Scene* scene = update->scene;
+    const size_t n = end - begin;
+    LinearArena* scratch = frame_arena_thread(update->arena);
+    const size_t mark = scratch ? linear_arena_mark(scratch) : 0;
+    const float* x = scene->pos_x + begin;
+    const float* y = scene->pos_y + begin;
+    const float* turn_sin = scene->turn_sin + begin;
+    const float* turn_cos = scene->turn_cos + begin;
+    float frame_sin = update->frame_sin[0], frame_cos = update->frame_cos[0];
+    if (update->material)
+    {
+        const uint32_t materials = (uint32_t)scene->material_count;
+        for (size_t k = begin; k < end; ++k)
+        {
+            const uint32_t i = update->visible ? update->visible[k] : (uint32_t)k;
+            update->material[k] = (scene->material_ids ? scene->material_ids[i] : i) % materials;
+        }
+    }
+    if (update->object)
+    {
+        for (size_t k = begin; k < end; ++k)
+            update->object[k] = update->visible ? update->visible[k] : (uint32_t)k;
+    }
+    if (update->visible)
+    {
+        // Gather the survivors so the batch transform still streams over contiguous arrays
+        float* visible_x = scratch ? (float*)linear_arena_alloc(scratch, sizeof(float) * n) : NULL;
+        float* visible_y = scratch ? (float*)linear_arena_alloc(scratch, sizeof(float) * n) : NULL;
+        float* visible_sin = scratch ? (float*)linear_arena_alloc(scratch, sizeof(float) * n) : NULL;
+        float* visible_cos = scratch ? (float*)linear_arena_alloc(scratch, sizeof(float) * n) : NULL;
+        if (!visible_x || !visible_y || !visible_sin || !visible_cos)
+            return;     // counted by the arena; the ranges' matrices are left as they were
+        for (size_t k = 0; k < n; ++k)
+        {
+            const uint32_t i = update->visible[begin + k];
+            visible_x[k] = scene->pos_x[i];
+            visible_y[k] = scene->pos_y[i];
+            visible_sin[k] = scene->turn_sin[i];
+            visible_cos[k] = scene->turn_cos[i];
+        }
+        if (scene->turn_ticks)
+        {
+            // --significance: each turned on by however far it's behind, so the batch's turn is none
+            for (size_t k = 0; k < n; ++k)
+            {
+                const uint32_t lag = scene_lag(scene, update->visible[begin + k]);
+                const uint32_t l = lag < SCENE_MAX_LAG ? lag : SCENE_MAX_LAG;
+                const float s = visible_sin[k], c = visible_cos[k];
+                visible_sin[k] = s * update->frame_cos[l] + c * update->frame_sin[l];
+                visible_cos[k] = c * update->frame_cos[l] - s * update->frame_sin[l];
+            }
+            frame_sin = 0.f;
+            frame_cos = 1.f;
+        }
+        x = visible_x;
+        y = visible_y;
+        turn_sin = visible_sin;
+        turn_cos = visible_cos;
+    }
+    // The frame's fraction of a step by angle addition: no sin/cos per object
+    mat3x4_translate_rotate_Z_batch_sincos(update->model + begin, x, y, NULL, turn_sin, turn_cos, frame_sin, frame_cos,
+        scene->scale, n);
+    linear_arena_rewind(scratch, mark);
+}
+
+// --cpu-occlusion: the first SCENE_OCCLUDERS of the "count" objects in "visible" that are SCENE_OCCLUDER_MIN_PIXELS
+// across on the occlusion buffer are drawn into it as the triangles they're drawn as this frame (turned by
+// "frame_sin" and "frame_cos", indexed by their lag, past their last tick), then every one is tested against it by
+// its box. The visible list is compacted in place; returns how many are left.
+static size_t scene_occlusion_cull(Scene* scene, JobSystem* jobs, FrameArena* arena, const Camera* camera,
+    const float* frame_sin, const float* frame_cos, uint32_t* visible, size_t count)
+{
+    CPU_TRACE_SCOPE("occlusion");
+    OcclusionRaster* r = scene->occlusion;
+    const size_t corners = sizeof(indices) / sizeof(indices[0]);
+    float* x = (float*)frame_arena_alloc(arena, sizeof(float) * SCENE_OCCLUDERS * corners);
+    float* y = (float*)frame_arena_alloc(arena, sizeof(float) * SCENE_OCCLUDERS * corners);
+    float* z = (float*)frame_arena_alloc(arena, sizeof(float) * SCENE_OCCLUDERS * corners);
+    if (!x || !y || !z)
+        return count;
+
+    // An object's width on the buffer from its distance: the projection's x row scales world units into NDC
+    const mat4x4* vp = &camera->view_projection;
+    const float x_scale = 0.5f * (float)r->width * sqrtf((*vp)[0][0] * (*vp)[0][0] + (*vp)[1][0] * (*vp)[1][0]
+        + (*vp)[2][0] * (*vp)[2][0]);
+    size_t n = 0;
+    for (size_t k = 0; k < count && n < SCENE_OCCLUDERS * corners; ++k)
+    {
+        const uint32_t i = visible[k];
+        const float w = (*vp)[0][3] * scene->pos_x[i] + (*vp)[1][3] * scene->pos_y[i] + (*vp)[3][3];
+        const uint32_t l = scene_lag(scene, i);
+        if (!(w > 0.f) || 2.f * scene->radius[i] * x_scale < SCENE_OCCLUDER_MIN_PIXELS * w)
+            continue;
+        if (l > SCENE_MAX_LAG)
+            continue;   // --significance: just come into view, and not turned since it was last; it's drawn anyway
+        const float s = scene->turn_sin[i] * frame_cos[l] + scene->turn_cos[i] * frame_sin[l];
+        const float c = scene->turn_cos[i] * frame_cos[l] - scene->turn_sin[i] * frame_sin[l];
+        for (size_t v = 0; v < corners; ++v)
+        {
+            const float* p = vertices[indices[v]].pos;
+            x[n] = scene->pos_x[i] + scene->scale * (c * p[0] - s * p[1]);
+            y[n] = scene->pos_y[i] + scene->scale * (s * p[0] + c * p[1]);
+            z[n] = 0.f;
+            ++n;
+        }
+    }
+    occlusion_raster_begin(r, camera->view_projection);
+    occlusion_raster_add(r, x, y, z, (uint32_t)n);
+    occlusion_raster_render(r, jobs);
+    return occlusion_raster_cull(r, jobs, scene->bounds, visible, count);
+}
+
+// --coherent: the objects in view, written to "visible" near to far by their origins' depth, as record_draw_range
+// keys their draws. Returns how many.
+static size_t scene_coherent_cull(Scene* scene, FrameArena* arena, const Frustum* frustum, const Camera* camera,
+    uint32_t* visible)
+{
+    CPU_TRACE_SCOPE("coherent cull");
+    const size_t count = coherent_cull(scene->coherent, frustum, scene->pos_x, scene->pos_y, NULL, scene->radius,
+        visible);
+    float* keys = (float*)frame_arena_alloc(arena, sizeof(float) * (count ? count : 1));
+    if (!keys)
+        return count;   // in the last frame's order, which is as good
+    vec4 const* vp = camera->view_projection;
+    for (size_t k = 0; k < count; ++k)
+    {
+        const float z = vp[0][2] * scene->pos_x[visible[k]] + vp[1][2] * scene->pos_y[visible[k]] + vp[3][2];
+        keys[k] = camera->reversed_z ? -z : z;
+    }
+    coherent_cull_sort(scene->coherent, visible, keys, count);
+    return count;
+}
+
+// Culls the objects against "frustum" (NULL: keep everything), then builds the survivors' model matrices,
+// interpolated between the last two ticks, into "model", compacted, in one batched pass spread over the job system's threads once there are
+// enough of them to be worth it. With materials, "material" (unless NULL) gets each survivor's material index
+// alongside; "object" (unless NULL) gets its object index. With levels of detail, the survivors choose theirs as
+// seen through "camera" and the matrices come out grouped by level, finest first, "lod_counts" saying how many of
+// each; otherwise they're all level 0. The visible lists and the jobs' scratch come from "arena". Returns how many
+// matrices were written. With --cpu-occlusion the frustum's survivors are culled by scene_occlusion_cull too. With
+// --impostors and "impostor_count" (NULL: none), the survivors too small on screen go last, left out of
+// "lod_counts", and "impostor_count" says how many. With --significance only the survivors due an update have
+// their turns set and their level and impostor choice made again; the rest are drawn with the ones they had.
+static int scene_update(Scene* scene, JobSystem* jobs, FrameArena* arena, const Frustum* frustum, const Camera* camera,
+    mat3x4* model, uint32_t* material, uint32_t* object, uint32_t* lod_counts, uint32_t* impostor_count)
+{
+    CPU_TRACE_SCOPE("matrices");
+    size_t count = (size_t)scene->count;
+    uint32_t* visible = NULL;
+    if (!model)
+        return 0;
+    if (frustum)
+    {
+        visible = (uint32_t*)frame_arena_alloc(arena, sizeof(uint32_t) * count);
+        if (!visible)
+            return 0;
+        if (scene->coherent)
+            count = scene_coherent_cull(scene, arena, frustum, camera, visible);
+        else if (count >= SCENE_BVH_CULL_MIN_OBJECTS && scene->use_grid)
+            count = spatial_grid_cull(&scene->grid, frustum, visible);
+        else if (count >= SCENE_BVH_CULL_MIN_OBJECTS && scene->bvh.node_count)
+            count = bvh_cull(&scene->bvh, frustum, visible);
+        else
+            count = frustum_cull_spheres(frustum, scene->pos_x, scene->pos_y, NULL, scene->radius, count, visible);
+    }
+    // Before the first tick both states are the initial one, as fixed_timestep_time has it. With --significance a
+    // turn "lag" ticks behind is drawn turned by that many steps more.
+    const float step = (float)(SCENE_SPIN_RATE * scene->step.dt);
+    const float frame_turn = scene->step.ticks ? step * fixed_timestep_alpha(&scene->step) : 0.f;
+    float frame_sin[SCENE_MAX_LAG + 1], frame_cos[SCENE_MAX_LAG + 1];
+    for (uint32_t lag = 0; lag <= (scene->turn_ticks ? SCENE_MAX_LAG : 0); ++lag)
+    {
+        frame_sin[lag] = linmath_sinf(frame_turn + step * (float)lag);
+        frame_cos[lag] = linmath_cosf(frame_turn + step * (float)lag);
+    }
+    if (frustum && scene->occlusion)
+        count = scene_occlusion_cull(scene, jobs, arena, camera, frame_sin, frame_cos, visible, count);
+
+    // --significance: the survivors due this frame have their turns set from the closed form and their tiers chosen,
+    // and are the only ones to choose impostors and levels below
+    const uint32_t* chosen = visible;
+    size_t chosen_count = count;
+    if (scene->significance)
+    {
+        CPU_TRACE_SCOPE("significance");
+        if (!visible)
+        {
+            visible = (uint32_t*)frame_arena_alloc(arena, sizeof(uint32_t) * count);
+            for (size_t k = 0; visible && k < count; ++k)
+                visible[k] = (uint32_t)k;
+        }
+        uint32_t* due = (uint32_t*)frame_arena_alloc(arena, sizeof(uint32_t) * count);
+        if (!visible || !due)
+            return 0;
+        chosen = due;
+        chosen_count = significance_due(scene->significance, visible, count, due);
+        const double closed = fmod(SCENE_SPIN_RATE * scene->step.dt * (double)scene->turn_tick,
+            2.0 * 3.14159265358979323846);
+        SceneTick tick = { scene, 0.f, 1.f, (float)closed, true, due, (uint32_t)scene->turn_tick };
+        SignificanceScoring scoring = { scene->significance, camera->view_projection, (float)camera->height,
+            scene->pos_x, scene->pos_y, NULL, scene->radius, due };
+        if (chosen_count <= SCENE_UPDATE_GRAIN || jobs->thread_count == 1)
+        {
+            scene_tick_range(&tick, 0, chosen_count);
+            significance_score_range(&scoring, 0, chosen_count);
+        }
+        else
+        {
+            job_wait(jobs, job_parallel_for(jobs, scene_tick_range, &tick, chosen_count, SCENE_UPDATE_GRAIN));
+            job_wait(jobs, job_parallel_for(jobs, significance_score_range, &scoring, chosen_count,
+                SCENE_UPDATE_GRAIN));
+        }
+        significance_count(scene->significance, due, chosen_count);
+    }
+
+    // The impostors split off the end, so the levels of detail are chosen among the meshes alone
+    size_t meshes = count;
+    uint32_t* split = impostor_count && scene->impostor
+        ? (uint32_t*)frame_arena_alloc(arena, sizeof(uint32_t) * count) : NULL;
+    if (split)
+    {
+        CPU_TRACE_SCOPE("impostors");
+        ImpostorSelection selection = { camera->view_projection, (float)camera->height, scene->impostor_pixels,
+            SCENE_IMPOSTOR_HYSTERESIS, scene->pos_x, scene->pos_y, NULL, scene->radius, chosen, scene->impostor };
+        if (chosen_count <= SCENE_UPDATE_GRAIN || jobs->thread_count == 1)
+            impostor_select_range(&selection, 0, chosen_count);
+        else
+            job_wait(jobs, job_parallel_for(jobs, impostor_select_range, &selection, chosen_count,
+                SCENE_UPDATE_GRAIN));
+        meshes = impostor_partition(scene->impostor, visible, count, split);
+        visible = split;
+    }
+    if (impostor_count)
+        *impostor_count = (uint32_t)(count - meshes);
+
+    memset(lod_counts, 0, sizeof(uint32_t) * LOD_MAX_LEVELS);
+    lod_counts[0] = (uint32_t)meshes;
+    uint32_t* grouped = scene->lod_error > 0.f && scene->lod_chain.level_count > 1 && scene->lod
+        ? (uint32_t*)frame_arena_alloc(arena, sizeof(uint32_t) * count) : NULL;
+    if (grouped)    // without it everything stays at level 0
+    {
+        CPU_TRACE_SCOPE("lod");
+        const float lod_error = scene->governor
+            ? scene->lod_error * quality_governor_tier(scene->governor)->lod_error_scale : scene->lod_error;
+        // --significance: the objects due choose, impostors among them too, so their levels are current once they
+        // turn back into meshes
+        const size_t choosing = scene->significance ? chosen_count : meshes;
+        LodSelection selection = { &scene->lod_chain, camera->view_projection, (float)camera->height, lod_error,
+            SCENE_LOD_HYSTERESIS, scene->pos_x, scene->pos_y, NULL, scene->significance ? chosen : visible,
+            scene->lod };
+        if (choosing <= SCENE_UPDATE_GRAIN || jobs->thread_count == 1)
+            lod_select_range(&selection, 0, choosing);
+        else
+            job_wait(jobs, job_parallel_for(jobs, lod_select_range, &selection, choosing, SCENE_UPDATE_GRAIN));
+        lod_group(scene->lod, visible, meshes, grouped, lod_counts);
+        if (meshes < count)
+            memcpy(grouped + meshes, visible + meshes, sizeof(uint32_t) * (count - meshes));
+        visible = grouped;
+    }
+
+    SceneUpdate update = { scene, arena, frame_sin, frame_cos, visible, model,
+        scene->material_count > 0 ? material : NULL, object };
+    if (count <= SCENE_UPDATE_GRAIN || jobs->thread_count == 1)
+    {
+        // Still in grain-sized ranges, so one range's scratch bounds the sub-arena
+        for (size_t begin = 0; begin < count; begin += SCENE_UPDATE_GRAIN)
+            scene_update_range(&update, begin, begin + SCENE_UPDATE_GRAIN < count ? begin + SCENE_UPDATE_GRAIN : count);
+    }
+    else
+        job_wait(jobs, job_parallel_for(jobs, scene_update_range, &update, count, SCENE_UPDATE_GRAIN));
+    return (int)count;
+}
+
+// --gpu-animate: each object's motion, for gl/gpu_animation.h to evaluate. All of them spin as the CPU path turns
+// them; every third one's centre also circles its grid position, and the next one's bobs up and down, each within
+// a quarter of its bounding radius. Returns NULL when out of memory; the caller frees it.
+#define SCENE_ORBIT_RATE 2.f    // radians per second
+#define SCENE_BOB_RATE 3.f
+static InstanceMotion* scene_motions(const Scene* scene)
+{
+    InstanceMotion* motions = (InstanceMotion*)malloc(sizeof(InstanceMotion) * scene->count);
+    for (int i = 0; motions && i < scene->count; ++i)
+    {
+        InstanceMotion* m = &motions[i];
+        m->x = scene->pos_x[i];
+        m->y = scene->pos_y[i];
+        m->phase = scene->phase[i];
+        m->spin_rate = SCENE_SPIN_RATE;
+        m->orbit_radius = i % 3 == 1 ? 0.25f * scene->radius[i] : 0.f;
+        m->orbit_rate = SCENE_ORBIT_RATE;
+        m->bob_amplitude = i % 3 == 2 ? 0.25f * scene->radius[i] : 0.f;
+        m->bob_rate = SCENE_BOB_RATE;
+    }
+    return motions;
+}
+
+// --gpu-animate: the GPU writes every object's matrix, so the frame draws all of them at level 0 and there's
+// nothing per object for the CPU to do. Returns how many are drawn.
+static int scene_gpu_animated(const Scene* scene, uint32_t* lod_counts)
+{
+    memset(lod_counts, 0, sizeof(uint32_t) * LOD_MAX_LEVELS);
+    lod_counts[0] = (uint32_t)scene->count;
+    return scene->count;
+}
+
+// Exact pick test once the BVH's box test passed: the ray against the object's bounding circle (a sphere at z = 0)
+static float scene_ray_hit(void* user, uint32_t object, const vec3 origin, const vec3 dir)
+{
+    const Scene* scene = (const Scene*)user;
+    const vec3 center = { scene->pos_x[object], scene->pos_y[object], 0.f };
+    vec3 oc;
+    vec3_sub(oc, origin, center);
+    const float a = vec3_mul_inner(dir, dir);
+    const float b = vec3_mul_inner(oc, dir);
+    const float c = vec3_mul_inner(oc, oc) - scene->radius[object] * scene->radius[object];
+    const float disc = b * b - a * c;
+    if (disc < 0.f)
+        return -1.f;
+    const float t = (-b - sqrtf(disc)) / a;
+    return t >= 0.f ? t : (-b + sqrtf(disc)) / a;
+}
+
+// The ray under window position (x, y), unprojected through the camera's inverse view-projection: "origin" on the
+// near plane, "dir" spanning it to the far one
+static void camera_pick_ray(const Camera* camera, double x, double y, int window_width, int window_height, vec3 origin,
+    vec3 dir)
+{
+    const float near_z = camera->reversed_z ? 1.f : -1.f, far_z = camera->reversed_z ? 0.f : 1.f;
+    const float ndc_x = (float)(2.0 * x / window_width - 1.0);
+    const float ndc_y = (float)(1.0 - 2.0 * y / window_height);
+    vec4 ends[2];
+    for (int e = 0; e < 2; ++e)
+    {
+        const vec4 clip = { ndc_x, ndc_y, e ? far_z : near_z, 1.f };
+        mat4x4_mul_vec4(ends[e], camera->inverse_view_projection, clip);
+        vec4_scale(ends[e], ends[e], 1.f / ends[e][3]);
+    }
+    for (int k = 0; k < 3; ++k)
+    {
+        origin[k] = ends[0][k];
+        dir[k] = ends[1][k] - ends[0][k];
+    }
+}
+
+// The object under window position (x, y), or -1: the cursor's ray cast through the scene's BVH or grid
+static int scene_pick(const Scene* scene, const Camera* camera, double x, double y, int window_width, int window_height)
+{
+    vec3 origin, dir;
+    camera_pick_ray(camera, x, y, window_width, window_height, origin, dir);
+    float t = 0.f;     // dir spans near to far
+    if (scene->use_grid)
+        return (int)spatial_grid_raycast(&scene->grid, origin, dir, 1.f, scene_ray_hit, (void*)scene, &t);
+    return (int)bvh_raycast(&scene->bvh, origin, dir, 1.f, scene_ray_hit, (void*)scene, &t);
+}
+
+// --characters N: a crowd of tentacles swaying along the bottom of the view, each a chain of joints skinned on
+// the GPU. The tree has no skinned assets, so the skeleton, its mesh and its clip are procedural; the clip still
+// goes through the compression a loaded one would. Poses are sampled on the job system every frame, or with
+// --bake-animation not at all: the clip is baked once at load and the GPU poses the crowd from it.
+#define CHARACTER_JOINTS 8
+#define CHARACTER_BONE 0.1f         // joint spacing, up +y in character space
+#define CHARACTER_WIDTH 0.07f       // at the base; the tip is a quarter of that
+#define CHARACTER_SEGMENTS 4        // mesh rows per bone
+#define CHARACTER_FRAMES 60         // clip keys, at CHARACTER_FRAME_RATE
+#define CHARACTER_FRAME_RATE 30.f
+#define CHARACTER_GRAIN 64          // characters per pose job
+#define CHARACTER_BAKE_FRAMES 120   // --bake-animation: poses baked over the clip, twice its keys, as matrices lerp
+
+typedef struct Characters
+{
+    int count;
+    Skeleton skeleton;
+    AnimationClip clip;
+    mat3x4* placements;         // [count]: scale and position in the grid's plane
+    float* offsets;             // [count]: seconds into the clip, so they don't sway in step
+    mat3x4* baked;              // --bake-animation: CHARACTER_BAKE_FRAMES palettes of the clip; NULL without
+} Characters;
+
+static bool characters_init(Characters* c, int count, bool bake)
+{
+    uint8_t parent[CHARACTER_JOINTS];
+    vec3 rest[CHARACTER_JOINTS];
+    for (int j = 0; j < CHARACTER_JOINTS; ++j)
+    {
+        parent[j] = j ? (uint8_t)(j - 1) : (uint8_t)SKELETON_NO_PARENT;
+        rest[j][0] = rest[j][2] = 0.f;
+        rest[j][1] = j ? CHARACTER_BONE : 0.f;
+    }
+    c->count = count;
+    c->placements = NULL;
+    c->offsets = NULL;
+    c->baked = NULL;
+    memset(&c->clip, 0, sizeof(c->clip));
+    if (!skeleton_init(&c->skeleton, parent, rest, CHARACTER_JOINTS))
+        return false;
+
+    // The sway: a wave travelling up the chain, each joint bending a little further than the one below
+    quat* frames = (quat*)malloc(sizeof(quat) * CHARACTER_FRAMES * CHARACTER_JOINTS);
+    if (!frames)
+        return false;
+    const vec3 axis = { 0.f, 0.f, 1.f };
+    for (int f = 0; f < CHARACTER_FRAMES; ++f)
+    {
+        for (int j = 0; j < CHARACTER_JOINTS; ++j)
+        {
+            const float angle = (0.08f + 0.03f * j) * sinf(6.2831853f * f / CHARACTER_FRAMES - 0.7f * j);
+            quat_rotate(frames[f * CHARACTER_JOINTS + j], angle, axis);
+        }
+    }
+    const bool ok = animation_clip_init(&c->clip, frames, CHARACTER_JOINTS, CHARACTER_FRAMES, CHARACTER_FRAME_RATE, 1e-3f);
+    free(frames);
+    if (!ok)
+        return false;
+
+    // Rows of them across the bottom half of the view, each scaled to fit its cell
+    c->placements = (mat3x4*)malloc(sizeof(mat3x4) * count);
+    c->offsets = (float*)malloc(sizeof(float) * count);
+    if (!c->placements || !c->offsets)
+    {
+        fprintf(stderr, "characters: out of memory for %d\n", count);
+        return false;
+    }
+    const int columns = (int)ceilf(sqrtf(count * 4.f));
+    const int rows = (count + columns - 1) / columns;
+    const float cell_width = 2.4f / columns, cell_height = 0.9f / rows;
+    const float scale = fminf(0.9f * cell_height / (CHARACTER_JOINTS * CHARACTER_BONE), cell_width / CHARACTER_WIDTH);
+    for (int i = 0; i < count; ++i)
+    {
+        mat3x4_identity(c->placements[i]);
+        for (int k = 0; k < 3; ++k)
+            c->placements[i][k][k] = scale;
+        c->placements[i][0][3] = -1.2f + cell_width * (i % columns + 0.5f);
+        c->placements[i][1][3] = -0.95f + cell_height * (i / columns);
+        c->offsets[i] = fmodf(i * 0.618034f, 1.f) * c->clip.duration;
+    }
+    if (bake)
+    {
+        c->baked = (mat3x4*)malloc(sizeof(mat3x4) * CHARACTER_BAKE_FRAMES * CHARACTER_JOINTS);
+        if (!c->baked)
+            return false;
+        animation_clip_bake(&c->skeleton, &c->clip, CHARACTER_BAKE_FRAMES, c->baked);
+    }
+    return true;
+}
+
+static void characters_free(Characters* c)
+{
+    animation_clip_destroy(&c->clip);
+    free(c->placements);
+    free(c->offsets);
+    free(c->baked);
+}
+
+// Every character's palette at "time", into "palettes" (count * CHARACTER_JOINTS matrices)
+static void characters_pose(const Characters* c, JobSystem* jobs, double time, mat3x4* palettes)
+{
+    CPU_TRACE_SCOPE("animate");
+    // Wrapped here in double: the clip's float time would lose precision as the run goes on
+    const AnimationCrowd crowd = { &c->skeleton, &c->clip, c->placements, c->offsets,
+        (float)fmod(time, (double)c->clip.duration), palettes };
+    if ((size_t)c->count <= CHARACTER_GRAIN || jobs->thread_count == 1)
+        animation_crowd_range((void*)&crowd, 0, (size_t)c->count);
+    else
+        job_wait(jobs, job_parallel_for(jobs, animation_crowd_range, (void*)&crowd, (size_t)c->count, CHARACTER_GRAIN));
+}
+
+// --detail N: the built-in triangle cut into N * N smaller ones, with a scalloped outline so its coarser levels
+// of detail have somewhere to lose shape, and a chain of them simplified at load. Colours interpolate the
+// corners' as before. Built on the main thread, since the scene chooses levels by their errors.
+#define DETAIL_LOBES 9              // scallops around the outline
+#define DETAIL_DEPTH 0.08f          // how far in they reach, as a fraction of the distance from the centre
+#define DETAIL_LOD_RATIO 0.5f       // triangles kept from one level to the next
+#define DETAIL_MAX 360              // N: vertices still fit 16-bit indices
+
+typedef struct DetailMesh
+{
+    Vertex* vertices;
+    size_t vertex_count;
+    uint32_t* indices;          // every level, one after the other
+    size_t index_count;
+    MeshLod lods[MESH_SIMPLIFY_MAX_LODS];
+    int lod_count;              // 0 when it couldn't be built
+} DetailMesh;
+
+static bool detail_mesh_init(DetailMesh* m, int n)
+{
+    memset(m, 0, sizeof(*m));
+    const size_t vertex_count = (size_t)(n + 1) * (n + 2) / 2;
+    const size_t index_count = 3 * (size_t)n * n;
+    m->vertices = (Vertex*)malloc(sizeof(Vertex) * vertex_count);
+    uint32_t* level0 = (uint32_t*)malloc(sizeof(uint32_t) * index_count);
+    float* positions = (float*)malloc(sizeof(float) * 3 * vertex_count);
+    m->indices = (uint32_t*)malloc(sizeof(uint32_t) * 2 * index_count);   // the levels take at most as much again
+    if (!m->vertices || !level0 || !positions || !m->indices)
+    {
+        fprintf(stderr, "detail: out of memory for %zu triangles\n", index_count / 3);
+        free(level0);
+        free(positions);
+        return false;
+    }
+
+    // Row r of the triangle holds n - r + 1 vertices, at barycentric (a, b, c) = ((n - r - k) / n, k / n, r / n)
+    vec2 centre = { 0.f, 0.f };
+    for (int c = 0; c < 3; ++c)
+        vec2_add(centre, centre, vertices[c].pos);
+    vec2_scale(centre, centre, 1.f / 3.f);
+    size_t v = 0;
+    for (int r = 0; r <= n; ++r)
+    {
+        for (int k = 0; k <= n - r; ++k, ++v)
+        {
+            const float weight[3] = { (float)(n - r - k) / n, (float)k / n, (float)r / n };
+            Vertex* out = &m->vertices[v];
+            memset(out, 0, sizeof(*out));
+            for (int c = 0; c < 3; ++c)
+            {
+                for (int i = 0; i < 2; ++i)
+                    out->pos[i] += weight[c] * vertices[c].pos[i];
+                for (int i = 0; i < 3; ++i)
+                    out->col[i] += weight[c] * vertices[c].col[i];
+            }
+            // Pulled towards the centre by the scallop at its angle: only inwards, so the bounds still hold
+            vec2 d;
+            vec2_sub(d, out->pos, centre);
+            const float pull = DETAIL_DEPTH * 0.5f * (1.f - cosf(DETAIL_LOBES * atan2f(d[1], d[0])));
+            vec2_scale(d, d, 1.f - pull);
+            vec2_add(out->pos, centre, d);
+            positions[3 * v] = out->pos[0];
+            positions[3 * v + 1] = out->pos[1];
+            positions[3 * v + 2] = 0.f;
+        }
+    }
+    size_t i = 0;
+    for (int r = 0, row = 0; r < n; row += n - r + 1, ++r)
+    {
+        const int next = row + n - r + 1;   // the first vertex of row r + 1
+        for (int k = 0; k < n - r; ++k)
+        {
+            const uint32_t up[3] = { (uint32_t)(row + k), (uint32_t)(row + k + 1), (uint32_t)(next + k) };
+            memcpy(level0 + i, up, sizeof(up));
+            i += 3;
+            if (k + 1 < n - r)
+            {
+                const uint32_t down[3] = { (uint32_t)(row + k + 1), (uint32_t)(next + k + 1), (uint32_t)(next + k) };
+                memcpy(level0 + i, down, sizeof(down));
+                i += 3;
+            }
+        }
+    }
+
+    m->lod_count = mesh_simplify_lods(m->indices, 2 * index_count, m->lods, MESH_SIMPLIFY_MAX_LODS, level0, index_count,
+        positions, 3 * sizeof(float), vertex_count, DETAIL_LOD_RATIO);
+    free(level0);
+    free(positions);
+    if (!m->lod_count)
+    {
+        fprintf(stderr, "detail: out of memory simplifying %zu triangles\n", index_count / 3);
+        return false;
+    }
+    m->index_count = m->lods[m->lod_count - 1].first_index + m->lods[m->lod_count - 1].index_count;
+    m->vertex_count = mesh_optimize_vertex_fetch(m->vertices, m->indices, m->index_count, vertex_count, sizeof(Vertex));
+    return m->vertex_count > 0;
+}
+
+static void detail_mesh_free(DetailMesh* m)
+{
+    free(m->vertices);
+    free(m->indices);
+}
+
+// Clicks waiting for the simulation to pick against the next camera. On their way to the renderer (--gpu-pick)
+// x and y are fractions of the window instead, from its top left.
+typedef struct PickRequest
+{
+    bool pending;
+    double x, y;
+} PickRequest;
+
+#define RENDER_MAX_WINDOWS 8     // --windows: most windows in one wall
+#define RENDER_MAX_LABELS 64     // --labels: most objects labelled
+#define RENDER_POINT_DENSITY 1.f        // --points: points a pixel the view is refined to
+#define RENDER_POINT_REFINE_FRAMES 8    // --points: frames a new view takes to get there
+#define RENDER_MAX_SERIES 16            // --series: most charts
+#define RENDER_SERIES_CAPACITY (1u << 20)   // --series: samples of history per chart
+#define RENDER_SERIES_SAMPLES 32        // --series: samples appended to each chart a frame
+#define RENDER_MAP_UPLOADS 8            // --map: decoded tiles uploaded a frame at most
+#define RENDER_MAP_SPEED 400.0          // --map: the tour's pan, in pixels a second
+#define RENDER_DRIVER_MEMORY_FRAMES 30  // frames between asking the driver about video memory
+#define RENDER_IMPOSTOR_FRAME 64        // --impostors: pixels an atlas frame is square
+#define RENDER_TERRAIN_RELIEF 0.05f     // --terrain: the highest peak, of the side
+#define RENDER_TERRAIN_BUDGET (64ull << 20) // --terrain-heightmap: video memory the streamed heights may take
+#define RENDER_VOLUME_BUDGET (64ull << 20)  // --volume: video memory the resident bricks may take
+#define RENDER_STEREO_DEPTH_RATIO 30.f  // --stereo: the convergence distance over the eyes' separation (the 1/30 rule)
+#define RENDER_XR_METRES 2.f            // --xr: the controller's starting distance to its target, in metres
+#define RENDER_XR_TURN_MARGIN 0.05f     // --xr: radians the head may turn after culling, before the late latch
+#define LOADING_ASSET_WAIT_SECONDS 2.0  // from renderer_init: how long the loading screen holds for the streamed mesh
+
+// The GLFW window user pointer. The callbacks only push timestamped events into "input"; the simulation
+// drains them with process_input at the start of each frame, and every field after it is the simulation's.
+typedef struct WindowState
+{
+    InputQueue input;
+    PickRequest pick;
+    bool focused;
+    FramePacer* pacer;      // V cycles its vsync mode, L toggles its limiter between off and "fps_limit"
+    double fps_limit;
+    FrameSmoother* smoother;    // S toggles smoothing of the simulation clock
+    bool hud;               // H toggles the performance overlay
+    double input_time;      // the earliest key or button press no frame has sampled yet (frame_pacer_now), 0 for none
+    double title_time;      // when the latency readout in the title was last refreshed
+    GLFWwindow* windows[RENDER_MAX_WINDOWS];    // --windows: the wall, left to right; windows[0] gets the mouse
+    int window_count;       // and the camera spans all of them, each showing its own horizontal tile
+    CameraController* controller;   // --camera: takes the drags, scrolls and keys it wants first; NULL for the 2D view
+    bool gpu_pick;          // --gpu-pick: clicks go to the renderer with the frame, the BVH ray cast is skipped
+    bool screenshot;        // P: the next frame is saved as a PNG
+    bool paused;            // Space stops the scene's clock and starts it again where it stopped
+    double pause_time;      // the scene's time when it stopped
+    double paused_for;      // seconds it has been stopped for in all, taken off the clock
+    RedrawPolicy* redraw;   // --on-demand: a frame only when something asks (NULL for every refresh)
+    bool idled;             // --on-demand: the loop waited for a reason to draw since the last frame
+    uint32_t drawn_camera;  // --on-demand: the camera version the last frame was built with
+    Settings* settings;     // the live settings, run from "console"'s lines; NULL without --console
+    SettingsConsole* console;
+    int vsync;              // the pacer's settings as the console sees them, read back from it before each line
+    int limit_fps;
+    bool low_latency;
+} WindowState;
+
+// Key presses: Escape closes, the rest switch frame pacing (the render thread picks each change up at its next swap).
+// T writes --telemetry's ring.
+static void handle_key(WindowState* state, GLFWwindow* window, int key)
+{
+    if (key == GLFW_KEY_ESCAPE)
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+    else if (key == GLFW_KEY_V)
+    {
+        static const char* names[] = { "off", "on", "adaptive" };
+        const int mode = (state->pacer->vsync.load(std::memory_order_relaxed) + 1) % VSYNC_MODE_COUNT;
+        frame_pacer_set_vsync(state->pacer, (VsyncMode)mode);
+        printf("vsync %s\n", names[mode]);
+    }
+    else if (key == GLFW_KEY_L)
+    {
+        const bool on = state->pacer->fps_limit.load(std::memory_order_relaxed) <= 0.0;
+        frame_pacer_set_fps_limit(state->pacer, on ? state->fps_limit : 0.0);
+        printf(on ? "frame rate limit %.0f fps\n" : "frame rate limit off\n", state->fps_limit);
+    }
+    else if (key == GLFW_KEY_S)
+    {
+        state->smoother->enabled = !state->smoother->enabled;
+        printf("frame time smoothing %s\n", state->smoother->enabled ? "on" : "off");
+    }
+    else if (key == GLFW_KEY_F)
+    {
+        const bool on = !frame_pacer_low_latency(state->pacer);
+        frame_pacer_set_low_latency(state->pacer, on);
+        printf("low latency %s\n", on ? "on" : "off");
+    }
+    else if (key == GLFW_KEY_H)
+        state->hud = !state->hud;
+    else if (key == GLFW_KEY_P)
+        state->screenshot = true;
+    else if (key == GLFW_KEY_T)
+        telemetry_flush("key");
+    else if (key == GLFW_KEY_SPACE)
+    {
+        const double now = glfwGetTime();
+        state->paused = !state->paused;
+        if (state->paused)
+            state->pause_time = now - state->paused_for;
+        else
+            state->paused_for = now - state->pause_time;
+        printf("scene clock %s\n", state->paused ? "stopped" : "running");
+    }
+}
+
+// The scene's time for a frame at "now": held while Space has it stopped (with no time passing), and without the
+// time it spent stopped after
+static double scene_clock(const WindowState* state, double now, float* delta)
+{
+    if (!state->paused)
+        return now - state->paused_for;
+    *delta = 0.f;
+    return state->pause_time;
+}
+
+// --console: runs the lines typed since the last frame. The pacer's settings go to it here, as the keys' do; the
+// rest are read where they're used, the renderer's through the next packet (FrameSettings).
+static void poll_console(WindowState* state)
+{
+    Settings* s = state->settings;
+    char line[SETTINGS_LINE_SIZE];
+    while (settings_console_take(state->console, line, sizeof(line)))
+    {
+        // The keys change the pacer too: start from where it is
+        state->vsync = state->pacer->vsync.load(std::memory_order_relaxed);
+        state->limit_fps = (int)state->pacer->fps_limit.load(std::memory_order_relaxed);
+        state->low_latency = frame_pacer_low_latency(state->pacer);
+        settings_command(s, line, stdout);
+        if (settings_take(s, settings_find(s, "vsync")))
+            frame_pacer_set_vsync(state->pacer, (VsyncMode)state->vsync);
+        if (settings_take(s, settings_find(s, "fps-limit")))
+        {
+            if (state->limit_fps > 0)
+                state->fps_limit = state->limit_fps;    // and L toggles to it from now on
+            frame_pacer_set_fps_limit(state->pacer, state->limit_fps);
+        }
+        if (settings_take(s, settings_find(s, "low-latency")))
+            frame_pacer_set_low_latency(state->pacer, state->low_latency);
+    }
+}
+
+// Drains the input queue in batches and applies the events in order: keys, pick requests, scroll zoom and
+// resizes (which only mark the camera dirty), with --camera's controller offered each event first. Then moves
+// the controller on and rebuilds the camera if any of that, or anything else, changed it. Returns the time of the earliest press since the last call, 0 for none, for the latency readout.
+static double process_input(WindowState* state, GLFWwindow* window, Camera* camera, bool headless)
+{
+    CPU_TRACE_SCOPE("input");
+    InputEvent batch[32];
+    size_t count;
+    while ((count = input_queue_drain(&state->input, batch, sizeof(batch) / sizeof(batch[0]))) > 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const InputEvent* e = &batch[i];
+            const bool press = e->action == GLFW_PRESS
+                && (e->type == INPUT_EVENT_KEY || e->type == INPUT_EVENT_MOUSE_BUTTON);
+            if (press && state->input_time <= 0.0)
+                state->input_time = e->time;
+            if (state->controller && camera_controller_event(state->controller, e, camera))
+                continue;
+            switch (e->type)
+            {
+            case INPUT_EVENT_KEY:
+                if (e->action == GLFW_PRESS)
+                    handle_key(state, window, e->code);
+                break;
+            case INPUT_EVENT_MOUSE_BUTTON:     // a left click asks for the object under the cursor
+                if (press && e->code == GLFW_MOUSE_BUTTON_LEFT)
+                {
+                    state->pick.pending = true;
+                    state->pick.x = e->x;
+                    state->pick.y = e->y;
+                }
+                break;
+            case INPUT_EVENT_SCROLL:
+                camera_set_zoom(camera, camera->zoom * powf(1.1f, (float)e->y));
+                break;
+            case INPUT_EVENT_RESIZE:           // the benchmark draws at --size whatever the hidden window does
+                if (!headless)
+                {
+                    // Only the first window of a wall resizes; the others follow it
+                    camera_set_viewport(camera, (int)e->x * state->window_count, (int)e->y);
+                    int width = 0, height = 0;
+                    glfwGetWindowSize(window, &width, &height);
+                    for (int k = 1; k < state->window_count; ++k)
+                        glfwSetWindowSize(state->windows[k], width, height);
+                }
+                break;
+            case INPUT_EVENT_FOCUS:
+                state->focused = e->action != 0;
+                break;
+            case INPUT_EVENT_CURSOR:
+                break;
+            }
+        }
+    }
+    if (state->controller)
+        camera_controller_apply(state->controller, camera, frame_pacer_now());
+    camera_update(camera);
+    if (state->console)
+        poll_console(state);
+    const double t = state->input_time;
+    state->input_time = 0.0;
+    return t;
+}
+
+// The latency overlay: the latest input-to-swap time in the window title, refreshed twice a second
+static void show_latency(WindowState* state, GLFWwindow* window)
+{
+    const double now = frame_pacer_now();
+    if (!state->focused || now - state->title_time < 0.5)
+        return;
+    state->title_time = now;
+    const double ms = state->pacer->last_latency_ms.load(std::memory_order_relaxed);
+    if (ms <= 0.0)
+        return;
+    char title[96];
+    snprintf(title, sizeof(title), "OpenGL Triangle - input to swap %.1f ms%s", ms,
+        frame_pacer_low_latency(state->pacer) ? " (low latency)" : "");
+    glfwSetWindowTitle(window, title);
+}
+
+// A click since the last frame: cast through the BVH now, or with --gpu-pick handed to the renderer in "gpu" (the
+// packet's), which reads the ID buffer under it once the frame is drawn
+static void pick_if_requested(WindowState* state, GLFWwindow* window, const Scene* scene, const Camera* camera,
+    PickRequest* gpu)
+{
+    gpu->pending = false;
+    if (!state->pick.pending)
+        return;
+    PickRequest* pick = &state->pick;
+    pick->pending = false;
+    int width = 0, height = 0;
+    glfwGetWindowSize(window, &width, &height);
+    if (width <= 0 || height <= 0)
+        return;
+    if (state->gpu_pick)
+        *gpu = { true, pick->x / width, pick->y / height };
+    else    // the window is the wall's leftmost tile
+        printf("picked object %d\n", scene_pick(scene, camera, pick->x, pick->y, width * state->window_count, height));
+}
+
+// --wall: what node 0 hands the followers each frame, so they simulate what it does and draw their tiles of its view
+typedef struct WallFrame
+{
+    double time;
+    float delta;
+    float zoom;
+    int projection_type;
+    float fov_y, near_plane, far_plane;
+    dmat4x4 eye_view;
+    dvec3 origin;
+    bool hud;
+} WallFrame;
+
+// --wall: node 0 sends this frame's clock and camera, a follower takes them in place of its own (and keeps its
+// viewport and tile). False once a follower's leader is gone.
+static bool wall_share_frame(WallSync* wall, double* time, float* delta, Camera* camera, bool* hud)
+{
+    WallFrame f;
+    memset(&f, 0, sizeof(f));
+    f.time = *time;
+    f.delta = *delta;
+    f.zoom = camera->zoom;
+    f.projection_type = camera->projection_type;
+    f.fov_y = camera->fov_y;
+    f.near_plane = camera->near_plane;
+    f.far_plane = camera->far_plane;
+    dmat4x4_dup(f.eye_view, camera->eye_view);
+    dvec3_dup(f.origin, camera->origin);
+    f.hud = *hud;
+    if (!wall_sync_frame(wall, &f, sizeof(f)))
+        return false;
+    if (wall->node == 0)
+        return true;
+    *time = f.time;
+    *delta = f.delta;
+    *hud = f.hud;
+    camera_set_zoom(camera, f.zoom);
+    if (f.projection_type == CAMERA_PERSPECTIVE)
+        camera_set_perspective(camera, f.fov_y, f.near_plane, f.far_plane);
+    camera_set_view(camera, f.eye_view);
+    camera_set_origin(camera, f.origin);
+    camera_update(camera);
+    return true;
+}
+
+// Points the 3 vModel row attributes at the instance matrices starting at "offset" in the bound GL_ARRAY_BUFFER
+static void set_instance_attribs(GLint vmodel_location, GLintptr offset)
+{
+    for (int r = 0; r < 3; ++r)
+    {
+        glVertexAttribPointer(vmodel_location + r, 4, GL_FLOAT, GL_FALSE,
+            sizeof(mat3x4), (void*)(offset + sizeof(vec4) * r));
+    }
+}
+
+// The live settings (--console) the renderer applies, as of a packet; renderer_apply_settings takes what changed
+typedef struct FrameSettings
+{
+    bool cull;
+    float render_scale;
+    int upload_budget_kb;
+    int vram_budget_mb;
+} FrameSettings;
+
+// Everything the render thread needs for one frame, filled in by the main thread. Two of these
+// cycle through a FrameQueue so the next frame is simulated while the previous one is submitted.
+typedef struct FramePacket
+{
+    double time;            // glfwGetTime() when the frame was simulated
+    float delta;            // seconds since the previous packet
+    unsigned int frame_index;
+    double input_time;      // the earliest input event this frame sampled, 0 for none: measured up to the swap
+    double sim_time;        // the fixed-step simulation's time, interpolated to this frame
+    Camera camera;          // the main thread's camera as of this frame; its version says whether it changed
+    int visible_count;      // objects that survived culling: how many of "models" are filled in
+    uint32_t lod_counts[LOD_MAX_LEVELS];    // of those, how many at each level of detail: "models" is grouped by level
+    uint32_t impostor_count;    // --impostors: and after them, how many are drawn as impostors
+    mat3x4* models;         // one model matrix per visible object, from "arena"
+    uint32_t* materials;    // --material: each visible object's material index, beside "models"; NULL without
+    uint32_t* objects;      // --gpu-pick: each visible object's index, beside "models"; NULL without (or replaying)
+    PickRequest pick;       // --gpu-pick: a click this frame, for the renderer to read the object ID under
+    mat3x4* palettes;       // --characters: every character's skinning palette, from "arena"; NULL without (or replaying)
+    bool hud;               // H: draw the performance overlay over this frame
+    bool screenshot;        // P: save this frame, overlay and all, as a PNG once it's drawn
+    uint32_t redraw;        // --on-demand: the RedrawReason bits it was drawn for; 0 without
+    bool resumed;           // --on-demand: the main thread waited for a reason to draw before it
+    bool gpu_cull;          // --cull-select: culled on the GPU this frame, so no "models" and nothing visible
+    FrameSettings settings; // the live settings as of this frame
+    FrameArena arena;       // the frame's transient data; reset once the packet is reused
+    CommandList commands;   // --naive: every visible object's draw, recorded across the job system and sorted
+} FramePacket;
+
+// --on-demand: true when a frame is asked for, input waiting to be processed included. Otherwise waits for events,
+// up to when the policy next needs a look, and returns false to be asked again.
+static bool redraw_wanted(WindowState* state)
+{
+    if (input_queue_pending(&state->input))
+        redraw_policy_request(state->redraw, REDRAW_INPUT);
+    const double now = glfwGetTime();
+    if (redraw_policy_due(state->redraw, now))
+        return true;
+    CPU_TRACE_SCOPE("idle");
+    glfwWaitEventsTimeout(redraw_policy_timeout(state->redraw, now));
+    redraw_policy_idle(state->redraw, glfwGetTime() - now);
+    state->idled = true;
+    return false;
+}
+
+// --on-demand: what "packet" is drawn for, and what it asks of the next frame: another while the camera moves (it
+// may carry on by itself, coasting) or the scene's clock runs
+static void redraw_frame(WindowState* state, FramePacket* packet)
+{
+    packet->redraw = redraw_policy_take(state->redraw, glfwGetTime());
+    packet->resumed = state->idled;
+    state->idled = false;
+    if (packet->camera.version != state->drawn_camera)
+        redraw_policy_request(state->redraw, REDRAW_CAMERA);
+    state->drawn_camera = packet->camera.version;
+    if (!state->paused)
+        redraw_policy_request(state->redraw, REDRAW_ANIMATION);
+}
+
+#define SCENE_RECORD_GRAIN 4096     // draws a recording job takes
+
+// --naive: one visible object's draw as a command run (core/command_list.h), for the renderer to replay. Ids are
+// the renderer's: program and vertex array 0 are the scene's, a uniform's value is the object's Draw block and a
+// draw's id its level of detail. The key orders the draws near to far by the model origin's depth, so the depth
+// test (--depth) rejects what's behind before it's shaded. With "entries" each draw goes into its own, claimed up
+// front, so the queue keeps the models' order.
+typedef struct DrawRecording
+{
+    FramePacket* packet;
+    RenderQueueEntry* entries;  // [visible_count], or NULL for command_list_record's batches
+} DrawRecording;
+
+static void record_draw_range(void* data, size_t begin, size_t end)
+{
+    const DrawRecording* recording = (const DrawRecording*)data;
+    FramePacket* packet = recording->packet;
+    vec4 const* vp = packet->camera.view_projection;
+    uint32_t level = 0;
+    size_t level_end = packet->lod_counts[0];    // the models are grouped by level
+    for (size_t i = begin; i < end; ++i)
+    {
+        while (i >= level_end && level + 1 < LOD_MAX_LEVELS)
+            level_end += packet->lod_counts[++level];
+        const mat3x4* m = &packet->models[i];
+        const float z = vp[0][2] * (*m)[0][3] + vp[1][2] * (*m)[1][3] + vp[2][2] * (*m)[2][3] + vp[3][2];
+        const uint32_t depth = render_key_depth(packet->camera.reversed_z ? 1.f - z : z * 0.5f + 0.5f, false);
+        const uint64_t key = render_key(0, 0, 0, 0, depth);
+        const int count = packet->materials ? 5 : 4;
+        Command* c = recording->entries ? command_list_record_at(&packet->commands, &recording->entries[i], key, count)
+            : command_list_record(&packet->commands, key, count);
+        if (!c)
+            continue;
+        *c++ = { COMMAND_PROGRAM, 0, 0, 0 };
+        *c++ = { COMMAND_VERTEX_ARRAY, 0, 0, 0 };
+        if (packet->materials)
+            *c++ = { COMMAND_ATTRIBUTE, (uint8_t)vmaterial_location, 0, packet->materials[i] };
+        *c++ = { COMMAND_UNIFORM, UNIFORMS_BINDING_DRAW, 0, (uint32_t)i };
+        *c = { COMMAND_DRAW, 0, (uint16_t)level, (uint32_t)i };
+    }
+}
+
+// Records and sorts the packet's draws on the main thread, which is in the job system, so the render thread only
+// replays them. The naive path's per-draw work that doesn't need the context is done here, spread across threads.
+// "coherent" (--coherent) when the models come near to far already: the draws keep their order in the queue, and
+// an insertion sort puts it right.
+static void scene_record_draws(FramePacket* packet, JobSystem* jobs, bool coherent)
+{
+    CPU_TRACE_SCOPE("record");
+    command_list_begin(&packet->commands);
+    DrawRecording recording = { packet, NULL };
+    if (packet->visible_count > 0 && packet->models)
+    {
+        if (coherent)
+            recording.entries = command_list_reserve(&packet->commands, (size_t)packet->visible_count);
+        job_wait(jobs, job_parallel_for(jobs, record_draw_range, &recording, (size_t)packet->visible_count,
+            SCENE_RECORD_GRAIN));
+    }
+    if (recording.entries)
+        command_list_sort_coherent(&packet->commands, jobs);
+    else
+        command_list_sort(&packet->commands, jobs);
+}
+
+// Renderer setup chosen on the command line
+typedef struct RenderConfig
+{
+    DrawMode draw_mode;
+    int object_count;
+    bool profile;               // --profile: GPU/CPU scope timings, summary printed on exit
+    const char* profile_csv;    // --profile-csv FILE: every frame's timings as CSV (implies --profile)
+    int headless_frames;        // --headless N: render N frames into an offscreen target, uncapped, then report
+    int width, height;          // --size WxH: offscreen target size
+    bool float_vertices;        // --float-vertices: upload Vertex as authored (20 bytes) instead of packed (8 bytes)
+    const char* mesh_path;      // --mesh FILE: draw a binary mesh file instead of the built-in triangle
+    const char* export_mesh;    // --export-mesh FILE: write the built-in mesh, packed, as a mesh file
+    const char* stream_mesh;    // --stream-mesh FILE: load a mesh file in the background, drawn once it arrives
+    int upload_budget_kb;       // --upload-budget KB: most bytes the streamer uploads per frame (0 = no limit)
+    AssetStreamer* streamer;    // set up by main for --stream-mesh
+    int streamed_mesh;          // the streamer's id for it
+    float zoom;                 // --zoom Z: camera magnification (the rest of the grid gets culled)
+    bool cull;                  // --no-cull: submit every object, visible or not
+    const Scene* scene;         // --gpu-driven: the objects to upload once for the compute cull
+    SceneReload* scene_reload;  // --scene-reload: versions of --scene swapped in between frames; else NULL
+    bool occlusion;             // --occlusion: two-phase Hi-Z occlusion culling on top of --gpu-driven
+    FramePacer* pacer;          // --vsync MODE / --fps-limit N: set up by main, applied around each swap
+    int window_count;           // --windows N: windows[1..] share the first one's context objects
+    GLFWwindow* const* windows;
+    const char* texture_path;   // --texture FILE: a DDS / KTX2 texture on every object, mip-streamed
+    int texture_budget_mb;      // --texture-budget MB: GPU memory its resident mips may take
+    AsyncIoBackend io_backend;  // --io-backend NAME: how --stream-mesh and --texture read their files
+    const char* material_paths[MATERIAL_MAX];   // --material FILE (repeatable): DDS / KTX2 textures the objects take turns wearing
+    int material_count;
+    bool arrays_only;           // --no-bindless: materials in texture arrays even where bindless handles work
+    const char* shader_dir;     // --shader-dir DIR: the scene shaders load from files there and reload when edited
+    bool separable;             // --separable: the scene as a pipeline of separable stages, where supported
+    const char* frame_stats_csv;    // --frame-stats FILE: per-second frame time percentiles as CSV, on exit
+    const char* capture_path;   // --capture FILE: record every frame the renderer is given, for --replay
+    int particle_count;         // --particles N: a GPU particle fountain of up to N particles (4.3+), first window only
+    int character_count;        // --characters N: a crowd of N skinned, animated characters (4.3+), first window only
+    const Characters* characters;   // set up by main for --characters
+    bool bake_animation;        // --bake-animation: the characters posed on the GPU from their clip baked at load
+    const DetailMesh* detail;   // --detail N: set up by main; drawn instead of the plain triangle, levels of detail and all
+    bool meshlets;              // --meshlets: level 0 split into meshlets, culled one by one after the object cull
+    int light_count;            // --lights N: N moving point lights, clustered (4.3+), first window only
+    bool deferred;              // --deferred: the lights shade a G-buffer in one pass instead of as the scene draws
+    bool depth;                 // --depth: depth tested against a float depth buffer, offscreen like occlusion's
+    bool reversed_z;            // set up by main: --depth's camera is reversed-Z (the capture's, replaying)
+    bool depth_prepass;         // --depth-prepass: the opaque scene's depth first, then its colour where it's equal
+    bool overdraw;              // --overdraw: shows fragments shaded per pixel as a heat map instead of the colours
+    double resolution_budget_ms; // --dynamic-res MS: the scene's resolution follows its GPU time; 0 for off
+    const PostSettings* post;   // --post: bloom, tonemapping and FXAA on the way to the window; NULL for off
+    int msaa_samples;           // --msaa N: the scene drawn offscreen with N samples a pixel and resolved; 0 for off
+    int labels;                 // --labels N: position readouts over the first N visible objects, in the overlay's text
+    int shape_count;            // --shapes N: a dashboard of N 2D primitives over the scene, batched; 0 for none
+    int path_count;             // --paths N: a wall of gauges drawn as N vector paths over the scene; 0 for none
+    bool retained_ui;           // --retained-ui: --shapes' charts kept as widgets, redrawn only where they change
+    int point_count;            // --points N: a scatter of N telemetry points under the scene (4.3+); 0 for none
+    const char* feed_name;      // --feed NAME: points another process publishes in shared memory; NULL for none
+    int cuda_point_count;       // --cuda-points N: points a CUDA kernel moves in a GL buffer; 0 for none
+    int serve_port;             // --serve PORT: images rendered for requests over TCP, in batches; 0 for none
+    int series_count;           // --series N: N live line charts over the scene, streamed a few samples a frame; 0 for none
+    int map_megabytes;          // --map MB: a streamed quadtree map under the scene, its tiles cached in MB; 0 for none
+    bool gpu_pick;              // --gpu-pick: clicks read the object ID the scene pass wrote under the cursor back
+    const char* record_path;    // --record FILE: every presented frame, read back and written on a thread of its own
+    int encoder;                // --encoder NAME: ffmpeg's for --record's videos and streams (ScreenRecorderEncoder)
+    bool hevc;                  // --hevc: HEVC instead of H.264
+    int bitrate_kbps;           // --bitrate KBPS: 0 for the encoder's own (8000 for a stream)
+    WallSync* wall;             // --wall I/N HOST: set up by main once every node has joined; NULL without
+    const Package* package;     // --package FILE: mesh and scene files it holds are unpacked from it; NULL without
+    bool no_dsa;                // --no-dsa: buffers and vertex arrays set up by binding even on 4.5 contexts
+    bool prewarm;               // --prewarm: loading waits for every program and draws with each, and each state, once
+    bool hitches;               // --hitches: every stutter logged with the passes and programs its time went to
+    bool gpu_animate;           // --gpu-animate: the instanced objects spin, orbit and bob by a compute pass (4.3+)
+    bool pull;                  // --pull: the scene's vertex shader reads and decodes the mesh's vertices itself (4.3+)
+    int oit;                    // --oit weighted|list: the scene drawn translucent, order-independent (OitMode, 4.3+)
+    int shadows;                // --shadows N: the sun's shadows from N cascaded maps (4.3+); 0 for none
+    bool taa;                   // --taa: jittered frames resolved against their reprojected history (implies --depth)
+    float impostor_pixels;      // --impostors PX: objects under PX pixels drawn as quads baked from the mesh; 0 for off
+    float terrain_size;         // --terrain SIZE: a CDLOD heightfield SIZE units a side under the scene; 0 for none
+    const char* terrain_heightmap;  // --terrain-heightmap FILE: its heights streamed from a DDS / KTX2; NULL: made up
+    bool terrain_tessellation;  // --no-tessellation clears it: the terrain's grids drawn as they are on 4.0 contexts
+    int terrain_texture_mb;     // --terrain-texture MB: its detail a virtual texture, MB of pages; 0 for none
+    int volume_side;            // --volume SIDE: a made-up field of SIDE^3 voxels, ray marched (4.3+); 0 for none
+    const char* volume_path;    // --volume-file FILE: a raw cube of 8-bit voxels marched instead; NULL for none
+    int vrs;                    // --vrs fixed|adaptive: the scene shaded coarser away from the fovea (FoveationMode)
+    bool startup;               // --startup: the startup phases printed once the first frame is out
+    RedrawPolicy* redraw;       // --on-demand: set up by main; the renderer asks it for the frames it needs. NULL without
+    QualityGovernor* governor;  // --governor MS: set up by main; the renderer feeds it and applies its tiers. NULL without
+    bool pipeline_stats;        // --pipeline-stats: each pass's shader invocations and clipped primitives (implies --profile)
+    const char* gpu_counters;   // --gpu-counters NAMES|default|list: hardware counters per pass (implies --profile); NULL for none
+    float render_scale;         // --render-scale S: the scene drawn at this fraction of the window's size, then scaled up
+    int vram_budget_mb;         // --vram-budget MB: gl_memory's budget, 0 for none
+    const CpuSet* render_cpus;  // --render-cpus / --affinity: where the render thread runs; NULL to leave it to the OS
+    bool high_priority;         // --high-priority: the render thread (and the main thread) above normal priority
+    bool alloc_stats;           // --alloc-stats: the heap per subsystem, counted every frame and printed on exit
+    bool assert_no_allocs;      // --assert-no-allocs: the main thread's frame work may not allocate once warmed up
+    bool stereo;                // --stereo: the instanced scene for two eyes side by side, one draw for both
+    bool xr;                    // --xr: --stereo's frames presented through an OpenXR runtime, the head tracked
+    int draw_timings;           // --draw-timings N: every Nth frame's costliest draws, GPU-timed; 0 for none
+    CullSelector* cull_selector;    // --cull-select: set up by main, each frame culled on the CPU or GPU; else NULL
+} RenderConfig;
+
+// FrameCaptureHeader flags, as this app writes them (its mode field is the DrawMode)
+#define CAPTURE_CULL 1u
+#define CAPTURE_OCCLUSION 2u
+#define CAPTURE_REVERSED_Z 4u   // the cameras are reversed-Z: replayed with clip control and depth testing
+
+// --windows: another window of the wall, drawn from its own context. The contexts share buffers and programs
+// but vertex arrays aren't shareable objects, so each has a VAO of its own over the same buffers.
+typedef struct RenderView
+{
+    GLFWwindow* window;
+    GLuint vertex_array;
+    GLuint vertex_buffer;       // the mesh buffer its vertex attributes point at: re-pointed when the mesh changes
+    VertexFormat vertex_format; // and the layout they have
+    GLState state;              // this context's state cache, swapped in with it
+    GLuint pipeline;            // --separable: this context's scene pipeline (pipeline objects aren't shared)
+    bool drawn;                 // drawn this frame: swap it
+} RenderView;
+
+// The pipeline states (gl/pipeline_state.h) one target's scene passes draw with; -1 where not made
+typedef struct ScenePassStates
+{
+    int scene;                  // the scene in one pass
+    int prepass;                // --depth-prepass: depth only, colour writes off
+    int shade;                  // and the colour after it: GL_EQUAL, depth writes off
+} ScenePassStates;
+
+// GL state, owned by whichever thread has the context current
+typedef struct Renderer
+{
+    GLFWwindow* window;
+    DrawMode draw_mode;
+    int object_count;
+    ProgramCache program_cache;
+    ShaderManager shader_manager;
+    ShaderPermutation scene_shaders;    // the scene program's variants
+    uint64_t scene_variant;     // the one this run draws with: SCENE_FEATURE_* bits
+    int scene_program_id;
+    GLuint program;             // the scene program, once the shader manager has it ready
+    ProgramPipelines* pipelines;    // --separable: the scene's separable stages; NULL when it's a whole program
+    int scene_pipeline_id;
+    GLuint pipeline;            // --separable: the scene pipeline, once both stages are ready (r->program stays 0)
+    bool failed;                // the scene program failed to build
+    GpuMesh mesh;
+    GLResources resources;      // owns the VAO and mesh buffers below; deletes retired ones after their frame
+    GLHandle vertex_array_handle;
+    GLHandle mesh_handles[2];   // the mesh's vertex and index buffers
+    GLuint vertex_array;        // resolved from its handle once, at creation
+    StreamBuffer instance_stream;
+    StreamBuffer uniform_stream;
+    GLHandle camera_buffer_handle;
+    GLuint camera_buffer;       // the Camera block: not streamed, rewritten only when the camera's version moves on
+    uint32_t camera_version;    // the version it holds, 0 for none yet
+    GLintptr* draw_offsets;
+    GpuProfiler profiler;
+    bool profiling;             // timings asked for up front (--profile, headless, a trace): summaries at exit
+    GpuCounters gpu_counters;   // --gpu-counters: sampled per pass by the profiler
+    Hud hud;                    // H: the performance overlay, on the first window (never headless)
+    bool hud_ready;
+    bool hud_pending;           // not made yet: renderer_show_hud makes it the first time it's asked for
+    bool hud_visible;           // the current packet asks for it; the profiler runs meanwhile
+    int label_slots[RENDER_MAX_LABELS]; // --labels: the hud's text slots, one per labelled object
+    int label_count;
+    int shape_count;            // --shapes: the dashboard's primitives, 0 for none
+    ShapeBatch* shapes;
+    ShapeRenderer shape_renderer;
+    unsigned long long shape_draws;     // over the run, for the report
+    unsigned long long shape_frames;
+    int path_count;             // --paths: the gauges' paths, 0 for none
+    VectorPath* gauge_paths;    // --paths: the panel, dial track and needle every gauge shares, then each value arc
+    unsigned long long path_waves;      // over the run, for the report
+    unsigned long long path_flattens;
+    UiLayer* ui;                // --retained-ui: the dashboard's panels and charts as widgets, NULL otherwise
+    UiRenderer ui_renderer;
+    double ui_next;             // when a chart has its next reading, on glfwGetTime()'s clock
+    PointCloudRenderer* points; // --points: NULL without, or when it couldn't be set up
+    FeedRenderer* feed;         // --feed and --cuda-points: NULL without
+#ifdef OPENGLTEST_CUDA
+    CudaPoints* cuda_points;    // --cuda-points: NULL without, or without a CUDA device
+#endif
+    RenderService* service;     // --serve: NULL without
+    BatchTarget* batch;         // --serve: the layers a batch is drawn into, and their readback
+    RenderRequest batch_requests[BATCH_TARGET_SLOTS][RENDER_SERVICE_MAX_BATCH];    // each slot's, while in flight
+    int series_count;           // --series: the charts, 0 for none
+    LineSeries* series;         // [series_count]
+    LineRenderer line_renderer;
+    unsigned long long series_frames;
+    TileMapRenderer* map;       // --map: NULL without, or when it couldn't be set up
+    double map_centre[2];       // --map: where the tour is, in map units
+    unsigned int draw_calls;    // this frame's scene draws, for the overlay
+    bool headless;
+    RenderTarget offscreen;     // headless or occlusion: what the frames are drawn into
+    double start_time;          // headless: when the first timed frame started
+    unsigned int frames_drawn;
+    bool startup_report;        // --startup: the phases printed once the first frame is out
+    unsigned long long objects_drawn;   // summed over frames_drawn, after culling
+    unsigned long long triangles_drawn; // the same, at the levels of detail they were drawn at
+    GpuReadback readback;       // what the GPU counted, brought back a few frames later without a stall
+    DrawElementsIndirectCommand culled[2];  // GPU-driven: the commands of the latest frame to come back
+    ClusterCullingStats cluster_stats;      // --meshlets: that frame's
+    uint32_t particles_alive;   // --particles: that frame's live count
+    unsigned int counted_frames;    // GPU-driven: frames whose commands came back, summed below
+    unsigned long long counted_objects;
+    unsigned long long counted_triangles;   // at level 0, or with --meshlets the meshlets' over meshlet_frames
+    unsigned int meshlet_frames;
+    AssetStreamer* streamer;    // NULL unless a mesh is streaming in
+    int streamed_mesh;          // id to swap in once ready, -1 when done
+    LoadingScreen loading;      // the window's frames until the scene draws, and its fade in (never headless)
+    bool loading_screen;
+    bool loading_frame;         // this frame is a loading one: renderer_begin_frame returned false to wait
+    double asset_deadline;      // glfwGetTime() past which the loading screen stops waiting for the streamed mesh
+    RedrawPolicy* redraw;       // --on-demand: asked for the frames the renderer needs; NULL without
+    uint32_t redraw_reasons;    // --on-demand: what this frame was drawn for (RedrawReason bits)
+    SwapDamage damage;          // --on-demand: partial presents, where the context has them
+    bool damage_swaps;
+    QualityGovernor* governor;  // --governor: fed each frame's times; its tier scales the settings below. NULL without
+    bool governed_resolution;   // --governor: the scene drawn at the tier's scale (not with --occlusion)
+    int governed_cascades;      // --shadows' count, which the tier takes cascades from
+    float governed_particle_rate;   // --particles' emission rate, which the tier scales
+    unsigned int governor_frame;    // the profiler frame the governor last took a GPU time from
+    double cpu_start;           // frame_pacer_now() as the frame began, for the governor's CPU time
+    double cpu_ms;              // the last frame's render thread time, waits and the swap left out
+    FrameSettings settings;     // the live settings as last applied: --render-scale's is read as each frame begins
+    bool cull;
+    GpuCulling gpu_culling;     // DRAW_MODE_GPU_DRIVEN, and --cull-select's frames culled on the GPU
+    CullSelector* cull_selector;    // --cull-select: given the GPU cull's times as they're read back; NULL without
+    unsigned int cull_frame;    // the profiler frame the selector last took a GPU time from
+    bool animate;               // --gpu-animate: the instance attributes read "animation"'s buffer, not the stream
+    GpuAnimation animation;
+    bool occlusion;
+    HiZ hiz;                    // occlusion: built from the offscreen depth between the two cull phases
+    bool meshlets;              // --meshlets: the mesh's meshlets are culled and drawn, until another mesh is swapped in
+    ClusterCulling clusters;
+    Meshlet* split_meshlets;    // what the mesh loaders split level 0 into, until the cluster cull has them
+    size_t split_meshlet_count;
+    FramePacer* pacer;          // swap interval and limiter; the frame times it records are printed with --profile
+    FrameStats frame_stats;     // swap-to-swap times: rolling percentiles for the overlay, per-second rows for the CSV
+    HitchDetector hitches;      // --hitches: the passes and program binds of the frame, logged when it's a stutter
+    DrawSampler draw_sampler;   // --draw-timings: told of the frames and passes through the profiler
+    const char* frame_stats_csv;    // --frame-stats: where the rows go on exit, NULL for nowhere
+    MetricsSample metrics;      // --metrics: filled in as the figures come, published every METRICS_PUBLISH_SECONDS
+    double metrics_published;
+    const char* capture_path;   // --capture: created at the first frame, once its size is known
+    FrameCaptureWriter capture;
+    bool late_limiter;          // single-threaded: in low-latency mode the loop waits out the limit before input
+    VertexFormat vertex_format; // the mesh's, for the views' VAOs
+    bool pull;                  // --pull: the scene program reads the mesh through "pulled", not the VAO's attributes
+    VertexPull pulled;
+    GLintptr instance_offset;   // instanced: this frame's region of the instance stream
+    GLsizeiptr camera_stride;   // one Camera block per window in camera_buffer
+    int eyes;                   // --stereo: 2, the instanced draws drawing each object once per eye; 1 otherwise
+    int view_count;             // windows besides r->window
+    RenderView views[RENDER_MAX_WINDOWS - 1];
+    TextureStreamer* textures;  // --texture: NULL without one
+    int texture_id;
+    float texture_size;         // pixels a texture repeat covers, per unit of view-projection y scale and of framebuffer height
+    int mesh_resident;          // gl_memory's id for the mesh's levels of detail, -1 when they all stay
+    void* mesh_indices;         // every level's indices, to bring back the ones dropped; NULL with mesh_resident -1
+    MaterialSet* materials;     // --material: NULL without, or when they failed to load (drawn untextured)
+    GLintptr material_offset;   // instanced: this frame's material indices in the instance stream
+    GpuPicker* picker;          // --gpu-pick: the offscreen target's ID attachment and its readbacks; NULL without
+    GLintptr object_offset;     // --gpu-pick: this frame's object indices in the instance stream
+    PickRequest pick;           // --gpu-pick: the latest click not read back yet, waiting for a free slot
+    WallSync* wall;             // --wall: every node's swap waits at its barrier; NULL without
+    bool swap_group;            // --wall: joined NV_swap_group's group 1
+    ScreenCapture* screen;      // P's screenshots and --record's frames, read back as they're presented; NULL headless
+                                // without --record
+    ParticleSystem* particles;  // --particles: NULL without, or when its program failed to build
+    int particle_program_id;    // the scene shaders' instanced variant, which the particles are drawn with
+    GLuint particle_program;    // once the shader manager has it ready
+    SkinnedBatch* characters;   // --characters: NULL without, or when its palette ring couldn't be created
+    uint32_t character_count;
+    int character_program_id;   // the scene shaders' skinned variant
+    GLuint character_program;   // once the shader manager has it ready
+    Lighting* lighting;         // --lights: NULL without, or when its programs failed to build
+    bool deferred;              // --deferred: the scene and characters draw to its G-buffer
+    Oit* oit;                   // --oit: the scene and characters drawn translucent; NULL without, or when it failed
+    ShadowMaps* shadows;        // --shadows: the sun's cascades; NULL without, or when they failed
+    int shadow_state;           // the casters' pipeline state: the pre-pass's program into a map; -1 until made
+    uint32_t shadow_camera_version;     // the camera the cascades were last fitted to
+    double shadow_sim_time;     // the simulated time the casters were last drawn at
+    Aabb casters;               // around every object: where the casters change while the simulation ticks
+    unsigned int shadow_draws;  // cascades drawn since the start
+    TemporalAa* taa;            // --taa: NULL without, or when its programs failed to build
+    dvec3 taa_origin;           // the camera's origin last frame: a new one is a cut for the history
+    ImpostorRenderer* impostors;    // --impostors: NULL without, or when its programs failed to build
+    TerrainRenderer* terrain;   // --terrain: NULL without, or when it couldn't be set up
+    VolumeRenderer* volume;     // --volume, --volume-file: NULL without, or when it couldn't be set up
+    float impostor_radius;      // the built-in mesh's bounding circle, which the atlas's frames fit
+    Foveation* foveation;       // --vrs: NULL without, or when it failed or can't draw this pass
+    bool depth;                 // --depth or occlusion: the frames are drawn offscreen, depth tested
+    bool reversed_z;            // depth runs 1 (near) to 0 (far): cleared to 0, tested GL_GEQUAL
+    GLenum depth_func;          // the scene's test: GL_LEQUAL, or GL_GEQUAL reversed (ties go to the later draw)
+    bool depth_prepass;         // --depth-prepass: the scene drawn depth-only first (not with occlusion or --windows)
+    int prepass_program_id;     // the scene shaders' DEPTH_ONLY variant for this run's vertex features
+    GLuint prepass_program;     // once the shader manager has it ready
+    PipelineStates states;      // the scene passes' program, vertex array and depth / blend / colour state, bundled
+    ScenePassStates pass_states[2];     // their ids drawing forward, and into --deferred's G-buffer
+    const ScenePassStates* pass;        // this frame's
+    bool float_depth;           // --depth: the offscreen target's depth is 32-bit float
+    bool overdraw_view;         // --overdraw: the scene and characters drawn as the OVERDRAW variant, blended
+    bool measure_overdraw;      // headless or --overdraw: samples passed per pixel, for the report
+    OverdrawCounter overdraw;
+    bool offscreen_frames;      // windowed frames go to the offscreen target and are upscaled to the window: --depth,
+                                // occlusion, --dynamic-res, --governor, --post, --msaa or --gpu-pick
+    int samples;                // the offscreen target's per pixel: --msaa's, or 1
+    bool dynamic_resolution;    // --dynamic-res: the scene drawn at the scaler's fraction of the window
+    ResolutionScaler scaler;
+    unsigned int scaler_frame;  // the profiler frame the scaler last took a GPU time from
+    int render_width;           // the scene's size this frame: the window's, or less with --dynamic-res
+    int render_height;
+    RenderTargetUpscale upscale;    // offscreen frames to the window's size; bilinear unless something else is set
+    void* upscale_user;
+    RenderTargetPool targets;   // transient render targets, post-processing's among them
+    PostProcess* post;          // --post: NULL without, or when its programs failed to build
+    PostSettings post_settings;
+    GLenum color_format;        // the offscreen target's: RGBA16F for --post's HDR input
+    bool post_presented;        // this frame's chain wrote the window, so there's nothing to upscale
+    struct OpenXrPresenter* xr; // --xr: the runtime the frames go to instead of the window; NULL without one
+    float xr_metre;             // world units a metre
+    float xr_depth[2];          // the drawn frame's depth 0 and depth 1, in metres
+    bool xr_drawn;              // the frame's eyes were late-latched into the stereo block and drawn
+} Renderer;
+
+#define RENDER_TEXTURE_UPLOAD_BYTES (4u << 20)     // new mip levels uploaded per frame at most
+#define RENDER_SHADOW_RESOLUTION 2048   // --shadows: texels across each cascade's map
+#define RENDER_SHADOW_DISTANCE 16.f     // --shadows, perspective: the view distance the cascades cover (8 grid widths)
+
+// --shapes: the dashboard, a grid of charts
+#define DASHBOARD_COLUMNS 4
+#define DASHBOARD_CHARTS 16
+#define DASHBOARD_MARGIN 8.f
+
+// --paths: a wall of gauges, four vector paths each: a panel and a needle filled, a dial track and a value arc
+// stroked. The panel, track and needle are three paths every gauge shares, flattened once and only moved; each
+// gauge's value arc is rebuilt every frame, as a live reading's would be.
+#define GAUGE_START 2.3561945f      // the dial from 135 degrees (clockwise from +x on screen), round 270 of them
+#define GAUGE_SWEEP 4.7123890f
+
+static inline int gauge_count(int paths)
+{
+    return paths / 4 > 0 ? paths / 4 : 1;
+}
+
+// In a gauge's own 100 x 100 units
+static void gauge_statics(VectorPath* paths)
+{
+    vector_path_rounded_rect(&paths[0], 4.f, 4.f, 92.f, 92.f, 10.f);
+    vector_path_arc(&paths[1], 50.f, 55.f, 32.f, GAUGE_START, GAUGE_START + GAUGE_SWEEP);
+    vector_path_move_to(&paths[2], 0.f, -3.f);      // the needle about its pivot, pointing along +x, and its hub
+    vector_path_line_to(&paths[2], 30.f, 0.f);
+    vector_path_line_to(&paths[2], 0.f, 3.f);
+    vector_path_close(&paths[2]);
+    vector_path_ellipse(&paths[2], 0.f, 0.f, 5.f, 5.f);
+}
+
+// --characters: the tentacle's mesh, a strip up the chain that narrows to the tip, and its skinned batch. Each
+// row follows the bone it's on, blending into the next joint towards the bone's end, so the bends stay smooth.
+// 16 bytes a vertex: half-float position, unorm8 colour, uint8 joints and unorm8 weights. With --bake-animation
+// the clip's baked frames and every character's placement and offset go up once, as the batch's only clip.
+static bool renderer_init_characters(SkinnedBatch* batch, const Characters* c)
+{
+    typedef struct CharacterVertex
+    {
+        float pos[2];
+        float col[3];
+        float joints[4];
+        float weights[4];
+    } CharacterVertex;
+    const int rows = CHARACTER_JOINTS * CHARACTER_SEGMENTS + 1;
+    CharacterVertex vertices[2 * rows];
+    uint32_t indices[6 * (rows - 1)];
+    for (int row = 0; row < rows; ++row)
+    {
+        const float t = (float)row / (rows - 1);
+        const float y = t * CHARACTER_JOINTS * CHARACTER_BONE;
+        const int bone = row / CHARACTER_SEGMENTS < CHARACTER_JOINTS ? row / CHARACTER_SEGMENTS : CHARACTER_JOINTS - 1;
+        const float along = y / CHARACTER_BONE - bone;
+        const bool tip = bone == CHARACTER_JOINTS - 1;
+        for (int side = 0; side < 2; ++side)
+        {
+            CharacterVertex* v = &vertices[2 * row + side];
+            v->pos[0] = (side ? 0.5f : -0.5f) * CHARACTER_WIDTH * (1.f - 0.75f * t);
+            v->pos[1] = y;
+            v->col[0] = 0.15f + 0.45f * t;
+            v->col[1] = 0.45f + 0.5f * t;
+            v->col[2] = 0.35f + 0.35f * t;
+            v->joints[0] = (float)bone;
+            v->joints[1] = (float)(tip ? bone : bone + 1);
+            v->joints[2] = v->joints[3] = 0.f;
+            v->weights[0] = tip ? 1.f : 1.f - along;
+            v->weights[1] = tip ? 0.f : along;
+            v->weights[2] = v->weights[3] = 0.f;
+        }
+        if (row + 1 < rows)
+        {
+            const uint32_t quad[6] = { 0, 1, 3, 0, 3, 2 };
+            for (int k = 0; k < 6; ++k)
+                indices[6 * row + k] = 2 * (uint32_t)row + quad[k];
+        }
+    }
+    VertexFormat format;
+    vertex_format_init(&format);
+    vertex_format_add(&format, vpos_location, 2, VERTEX_ATTRIB_FLOAT16);
+    vertex_format_add(&format, vcol_location, 3, VERTEX_ATTRIB_UNORM8);
+    vertex_format_add(&format, SKINNING_JOINTS_LOCATION, 4, VERTEX_ATTRIB_UINT8);
+    vertex_format_add(&format, SKINNING_WEIGHTS_LOCATION, 4, VERTEX_ATTRIB_UNORM8);
+    const VertexSource sources[] = {
+        { vertices[0].pos, sizeof(CharacterVertex) },
+        { vertices[0].col, sizeof(CharacterVertex) },
+        { vertices[0].joints, sizeof(CharacterVertex) },
+        { vertices[0].weights, sizeof(CharacterVertex) },
+    };
+    unsigned char packed[sizeof(vertices)];     // at most as big as the floats
+    vertex_format_pack(&format, sources, 2 * rows, packed);
+    if (!skinned_batch_init(batch, &format, packed, 2 * rows, indices, 6 * (rows - 1), CHARACTER_JOINTS,
+        (uint32_t)c->count))
+        return false;
+    if (!c->baked)
+        return true;
+    SkinnedInstance* instances = (SkinnedInstance*)calloc((size_t)c->count, sizeof(SkinnedInstance));
+    if (!instances)
+        return false;
+    for (int i = 0; i < c->count; ++i)
+    {
+        mat3x4_dup(instances[i].placement, c->placements[i]);
+        instances[i].offset = c->offsets[i];
+    }
+    const SkinnedClip clip = { c->baked, CHARACTER_BAKE_FRAMES, CHARACTER_BAKE_FRAMES / c->clip.duration };
+    const bool ok = skinned_batch_bake(batch, &clip, 1, instances, (uint32_t)c->count);
+    free(instances);
+    return ok;
+}
+
+// --lights: "count" lights scattered over the grid, each circling a point of its own a little above it, in
+// colours round the hue circle. Always the same ones, so runs compare.
+static bool renderer_init_lights(Lighting* lighting, int count, bool deferred, bool zero_to_one_depth)
+{
+    LightSource* lights = (LightSource*)malloc(sizeof(LightSource) * count);
+    if (!lights)
+    {
+        fprintf(stderr, "lights: out of memory for %d lights\n", count);
+        return false;
+    }
+    uint32_t seed = 0x2545F491u;
+    for (int i = 0; i < count; ++i)
+    {
+        float u[6];
+        for (int k = 0; k < 6; ++k)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            u[k] = (float)(seed >> 8) / 16777216.f;     // [0, 1)
+        }
+        LightSource* l = &lights[i];
+        l->center[0] = 2.f * u[0] - 1.f;
+        l->center[1] = 2.f * u[1] - 1.f;
+        l->orbit = 0.05f + 0.2f * u[2];
+        l->speed = (u[3] < 0.5f ? -1.f : 1.f) * (0.3f + 1.4f * u[3]);
+        l->phase = 6.2831853f * u[4];
+        l->height = 0.05f + 0.1f * u[5];
+        l->range = 0.15f + 0.25f * u[2];
+        const float hue = 6.f * (float)i / count;
+        for (int c = 0; c < 3; ++c)
+        {
+            const float h = fmodf(hue + 2.f * c, 6.f);     // red, green, blue peaks a third of the circle apart
+            l->color[c] = 1.5f * fmaxf(0.f, fminf(1.f, fabsf(h - 3.f) - 1.f));
+        }
+    }
+    const bool ok = lighting_init(lighting, lights, (uint32_t)count, deferred, zero_to_one_depth);
+    free(lights);
+    return ok;
+}
+
+// --points: synthetic telemetry over [-2, 2] x [-1, 1], made from the point's index so both of the build's passes
+// get the same points: 16 noisy channel traces, one in five points a burst around one of 8 events. Half the view
+// wide at the default zoom, so zooming in shows more of the same data.
+static inline uint32_t telemetry_hash(uint32_t x)
+{
+    x ^= x >> 16; x *= 0x7FEB352Du; x ^= x >> 15; x *= 0x846CA68Bu; x ^= x >> 16;
+    return x;
+}
+
+static void telemetry_points(void* user, size_t first, size_t count, float* x, float* y, uint32_t* color)
+{
+    static const uint32_t palette[4] = { 0xFFF0A040u, 0xFF60E0FFu, 0xFF4080FFu, 0xFFA0FF70u };
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t h0 = telemetry_hash((uint32_t)(first + i)), h1 = telemetry_hash(h0), h2 = telemetry_hash(h1);
+        const float u0 = (h0 >> 8) * (1.f / 16777216.f), u1 = (h1 >> 8) * (1.f / 16777216.f);
+        const float u2 = (h2 >> 8) * (1.f / 16777216.f);
+        const float noise = u1 + u2 - 1.f;     // triangular, in [-1, 1]
+        if (h0 % 5)
+        {
+            const int channel = (int)(h1 % 16);
+            x[i] = -2.f + 4.f * u0;
+            y[i] = -0.9f + 0.12f * channel + 0.04f * sinf(x[i] * (3.f + channel)) + 0.012f * noise;
+            color[i] = palette[channel & 3];
+        }
+        else
+        {
+            const int event = (int)(h2 % 8);
+            x[i] = -1.75f + 0.5f * event + 0.06f * noise + 0.03f * (u0 - 0.5f);
+            y[i] = 0.6f * sinf(event * 2.1f) + 0.08f * (u0 + u1 - 1.f);
+            color[i] = 0xFFFFFFFFu;
+        }
+    }
+}
+
+// --points: "count" points binned and uploaded; the CPU copy goes once the GPU has it
+static PointCloudRenderer* renderer_init_points(int count)
+{
+    const float bounds[4] = { -2.f, -1.f, 2.f, 1.f };
+    const double start = glfwGetTime();
+    PointCloud cloud;
+    if (!point_cloud_build(&cloud, telemetry_points, NULL, (size_t)count, bounds))
+    {
+        fprintf(stderr, "points: can't build a cloud of %d points\n", count);
+        return NULL;
+    }
+    printf("points: %u points in %u tiles (%dx%d), %.2f s\n", cloud.point_count, cloud.tile_count, cloud.grid[0],
+        cloud.grid[1], glfwGetTime() - start);
+    PointCloudRenderer* pcr = (PointCloudRenderer*)malloc(sizeof(PointCloudRenderer));
+    if (!point_cloud_renderer_init(pcr, &cloud, RENDER_POINT_DENSITY, RENDER_POINT_REFINE_FRAMES))
+    {
+        free(pcr);
+        pcr = NULL;
+    }
+    point_cloud_destroy(&cloud);
+    return pcr;
+}
+
+// Points the scene's draws at the mesh's vertex buffer, laid out as "format": the bound VAO's attributes ("previous"
+// being the layout it had, NULL for none), or with --pull the pulled layout, the VAO left alone
+static void renderer_attach_vertices(Renderer* r, const VertexFormat* format, const VertexFormat* previous)
+{
+    if (!r->pull)
+        vertex_format_attach(format, previous, r->mesh.vertex_buffer);
+    else if (!vertex_pull_attach(&r->pulled, format, r->mesh.vertex_buffer))
+        r->failed = true;
+    r->vertex_format = *format;
+}
+
+// --meshlets: splits level 0 (the first "index_count" of "indices") into meshlets, rewriting those indices in
+// meshlet order, and leaves the meshlets in r->split_meshlets. The bounds come from the positions as uploaded,
+// read back out of "vertices" in "format" (the position stream, when split). Logs and leaves the mesh as it was when
+// it can't.
+static void renderer_split_meshlets(Renderer* r, const VertexFormat* format, const void* vertices, size_t vertex_count,
+    uint32_t* indices, size_t index_count)
+{
+    const VertexAttrib* position = NULL;
+    for (int i = 0; i < format->count; ++i)
+        if (format->attribs[i].location == (GLuint)vpos_location)
+            position = &format->attribs[i];
+    if (!position || (position->type != VERTEX_ATTRIB_FLOAT32 && position->type != VERTEX_ATTRIB_FLOAT16))
+    {
+        fprintf(stderr, "meshlets: the mesh's positions aren't floats or half floats, drawn whole\n");
+        return;
+    }
+    float* positions = (float*)malloc(sizeof(float) * 3 * vertex_count);
+    uint32_t* ordered = (uint32_t*)malloc(sizeof(uint32_t) * index_count);
+    Meshlet* meshlets = (Meshlet*)malloc(sizeof(Meshlet) * meshlet_bound(index_count));
+    if (positions && ordered && meshlets)
+    {
+        for (size_t v = 0; v < vertex_count; ++v)
+        {
+            const unsigned char* p = (const unsigned char*)vertices + format->stride * v + position->offset;
+            for (int c = 0; c < 3; ++c)
+            {
+                float x = 0.f;
+                if (c < position->components && position->type == VERTEX_ATTRIB_FLOAT32)
+                    memcpy(&x, p + sizeof(float) * c, sizeof(float));
+                else if (c < position->components)
+                {
+                    uint16_t h;
+                    memcpy(&h, p + sizeof(uint16_t) * c, sizeof(uint16_t));
+                    x = vertex_half_to_float(h);
+                }
+                positions[3 * v + c] = x;
+            }
+        }
+        r->split_meshlet_count = meshlet_build(meshlets, ordered, indices, index_count, positions, 3 * sizeof(float), vertex_count);
+    }
+    if (r->split_meshlet_count)
+    {
+        memcpy(indices, ordered, sizeof(uint32_t) * index_count);
+        r->split_meshlets = meshlets;
+    }
+    else
+    {
+        fprintf(stderr, "meshlets: out of memory splitting %zu triangles, drawn whole\n", index_count / 3);
+        free(meshlets);
+    }
+    free(positions);
+    free(ordered);
+}
+
+// The built-in mesh's vertices packed as "Layout" into a new block (the caller frees it), "format" set to match
+template <typename Layout>
+static void* renderer_pack_builtin_vertices(const Vertex* mesh_vertices, size_t vertex_count, VertexFormat* format)
+{
+    const VertexSource sources[] = {
+        { mesh_vertices[0].pos, sizeof(Vertex) },
+        { mesh_vertices[0].col, sizeof(Vertex) },
+    };
+    static_assert(Layout::count == sizeof(sources) / sizeof(sources[0]), "a source per attribute");
+    vertex_layout_format<Layout>(format);
+    void* packed = malloc(Layout::stride * vertex_count);
+    vertex_layout_pack<Layout>(sources, vertex_count, packed);
+    return packed;
+}
+
+// renderer_attach_vertices for a mesh laid out as "Layout", the attributes set up by its own compiled code
+template <typename Layout>
+static void renderer_attach_layout(Renderer* r)
+{
+    VertexFormat format;
+    vertex_layout_format<Layout>(&format);
+    if (r->pull)
+    {
+        renderer_attach_vertices(r, &format, NULL);
+        return;
+    }
+    vertex_layout_attach<Layout>(NULL, r->mesh.vertex_buffer);
+    r->vertex_format = format;
+}
+
+// Builds the built-in triangle (or --detail's): optimized and packed at load time, then uploaded. The VAO must be bound.
+static void renderer_load_builtin_mesh(Renderer* r, const RenderConfig* config)
+{
+    // Load-time mesh preparation: triangles reordered for the post-transform cache, then vertices renumbered
+    // in first-use order, before uploading vertex + element buffers (the element buffer binding lands in the VAO).
+    // The detailed mesh arrives prepared, each level reordered on its own.
+    Vertex triangle_vertices[sizeof(vertices) / sizeof(vertices[0])];
+    uint32_t triangle_indices[sizeof(indices) / sizeof(indices[0])];
+    const Vertex* mesh_vertices = triangle_vertices;
+    const uint32_t* mesh_indices = triangle_indices;
+    size_t index_count = sizeof(indices) / sizeof(indices[0]);
+    size_t vertex_count = 0;
+    const DetailMesh* detail = config->detail;
+    if (detail)
+    {
+        mesh_vertices = detail->vertices;
+        mesh_indices = detail->indices;
+        index_count = detail->index_count;
+        vertex_count = detail->vertex_count;
+    }
+    else
+    {
+        memcpy(triangle_vertices, vertices, sizeof(vertices));
+        memcpy(triangle_indices, indices, sizeof(indices));
+        mesh_optimize_vertex_cache(triangle_indices, index_count, sizeof(vertices) / sizeof(vertices[0]));
+        vertex_count = mesh_optimize_vertex_fetch(triangle_vertices, triangle_indices, index_count,
+            sizeof(vertices) / sizeof(vertices[0]), sizeof(Vertex));
+    }
+
+    // Vertices are authored as floats and packed at load as PackedVertex (or FloatVertex): the layout is chosen
+    // once here, and each one's packing and attribute setup are compiled for it. The shader still sees vec2/vec3.
+    VertexFormat format;
+    void* packed = config->float_vertices
+        ? renderer_pack_builtin_vertices<FloatVertex>(mesh_vertices, vertex_count, &format)
+        : renderer_pack_builtin_vertices<PackedVertex>(mesh_vertices, vertex_count, &format);
+    uint32_t* split = NULL;
+    if (config->meshlets)
+    {
+        // Level 0 reordered into meshlets, the coarser levels as they were
+        split = (uint32_t*)malloc(sizeof(uint32_t) * index_count);
+        memcpy(split, mesh_indices, sizeof(uint32_t) * index_count);
+        renderer_split_meshlets(r, &format, packed, vertex_count, split, detail ? detail->lods[0].index_count : index_count);
+        mesh_indices = split;
+    }
+    gpu_mesh_init(&r->mesh, packed, format.stride, vertex_count, mesh_indices, index_count);
+    MeshFileLod file_lods[MESH_FILE_MAX_LODS] = { { 0, (uint32_t)index_count, 0.f, 0 } };
+    int lod_count = 1;
+    if (detail)
+    {
+        GpuMeshLod lods[GPU_MESH_MAX_LODS];
+        lod_count = detail->lod_count;
+        for (int l = 0; l < lod_count; ++l)
+        {
+            lods[l] = { detail->lods[l].first_index, (GLsizei)detail->lods[l].index_count, detail->lods[l].error };
+            file_lods[l] = { detail->lods[l].first_index, detail->lods[l].index_count, detail->lods[l].error, 0 };
+        }
+        gpu_mesh_set_lods(&r->mesh, lods, lod_count);
+    }
+
+    if (config->export_mesh)
+    {
+        MeshFileAttrib attribs[VERTEX_FORMAT_MAX_ATTRIBS];
+        for (int i = 0; i < format.count; ++i)
+            attribs[i] = { (uint8_t)format.attribs[i].location, (uint8_t)format.attribs[i].components,
+                (uint8_t)format.attribs[i].type, 0, (uint32_t)format.attribs[i].offset };
+        mesh_file_write_lods(config->export_mesh, attribs, format.count, (uint32_t)format.stride, packed,
+            (uint32_t)vertex_count, mesh_indices, (uint32_t)index_count, file_lods, lod_count);
+    }
+    free(packed);
+    free(split);
+
+    // The attributes, or the pulled vertices, read from the mesh's vertex buffer
+    if (config->float_vertices)
+        renderer_attach_layout<FloatVertex>(r);
+    else
+        renderer_attach_layout<PackedVertex>(r);
+}
+
+// --package: a mesh file the package holds is unpacked from it (one block after another: the renderer may be on a
+// thread outside the job system), anything else is mapped from the disk
+static bool open_mesh_file(MeshFile* mesh, const Package* package, const char* path)
+{
+    const int entry = package ? package_find(package, path) : -1;
+    if (entry < 0)
+        return mesh_file_open(mesh, path);
+    MappedFile file;
+    return package_extract(package, entry, &file, NULL) && mesh_file_open_mapped(mesh, &file, path);
+}
+
+// Uploads a binary mesh file straight from its mapping, in the layout it was written with (with --meshlets, level 0's
+// indices from a reordered copy, unless the file was cooked with its meshlets). The VAO must be bound.
+static bool renderer_load_mesh_file(Renderer* r, const Package* package, const char* path, bool meshlets)
+{
+    MeshFile file;
+    if (!open_mesh_file(&file, package, path))
+        return false;
+
+    const MeshFileHeader* h = file.header;
+    VertexFormat format;
+    if (!vertex_format_from_mesh_file(&format, h))
+    {
+        mesh_file_close(&file);
+        return false;
+    }
+
+    const void* indices = file.indices;
+    void* split = NULL;
+    if (meshlets && file.meshlet_count)
+    {
+        // Cooked: level 0 is already in meshlet order, and the meshlets come with it
+        r->split_meshlets = (Meshlet*)malloc(sizeof(Meshlet) * file.meshlet_count);
+        if (r->split_meshlets)
+        {
+            memcpy(r->split_meshlets, file.meshlets, sizeof(Meshlet) * file.meshlet_count);
+            r->split_meshlet_count = file.meshlet_count;
+        }
+    }
+    else if (meshlets)
+    {
+        const size_t level0 = file.lods[0].index_count;
+        uint32_t* wide = (uint32_t*)malloc(sizeof(uint32_t) * level0);
+        split = malloc((size_t)h->index_size * h->index_count);
+        if (wide && split)
+        {
+            memcpy(split, file.indices, (size_t)h->index_size * h->index_count);
+            for (size_t i = 0; i < level0; ++i)
+                wide[i] = h->index_size == 2 ? ((const uint16_t*)split)[i] : ((const uint32_t*)split)[i];
+            renderer_split_meshlets(r, &format, file.vertices, h->vertex_count, wide, level0);
+            for (size_t i = 0; i < level0; ++i)
+            {
+                if (h->index_size == 2)
+                    ((uint16_t*)split)[i] = (uint16_t)wide[i];
+                else
+                    ((uint32_t*)split)[i] = wide[i];
+            }
+            indices = split;
+        }
+        free(wide);
+    }
+    gpu_mesh_init_raw(&r->mesh, file.vertices, (size_t)mesh_file_vertex_bytes(h), h->vertex_count, indices,
+        h->index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, h->index_count);
+    free(split);
+    GpuMeshLod lods[GPU_MESH_MAX_LODS];
+    for (uint32_t l = 0; l < file.lod_count; ++l)
+        lods[l] = { file.lods[l].first_index, (GLsizei)file.lods[l].index_count, file.lods[l].error };
+    gpu_mesh_set_lods(&r->mesh, lods, (int)file.lod_count);
+    mesh_file_close(&file);     // glBufferData has copied out of the mapping
+
+    renderer_attach_vertices(r, &format, NULL);
+    return true;
+}
+
+// The mesh's finer levels of detail as a resident of gl_memory: dropped from the index buffer, finest first, when
+// video memory runs over the budget, and brought back from a copy kept here once there's room. Only where every draw
+// goes through the mesh's ranges: not GPU-driven or meshlets, whose commands index level 0 themselves, not a wall,
+// whose other contexts would see the buffer respecified under them, and not a mesh about to be swapped for a
+// streamed one.
+static void renderer_manage_mesh_lods(Renderer* r)
+{
+    r->mesh_resident = -1;
+    r->mesh_indices = NULL;
+    const GpuMesh* mesh = &r->mesh;
+    if (mesh->lod_count < 2 || r->draw_mode == DRAW_MODE_GPU_DRIVEN || r->meshlets || r->view_count > 0
+        || r->streamed_mesh >= 0)
+        return;
+    for (int l = 1; l < mesh->lod_count; ++l)
+    {
+        if (mesh->lods[l].first_index < mesh->lods[l - 1].first_index + (GLuint)mesh->lods[l - 1].index_count)
+            return;     // not laid out one after another
+    }
+    const size_t index_size = mesh->index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    const GpuMeshLod* last = &mesh->lods[mesh->lod_count - 1];
+    uint64_t level_bytes[GPU_MESH_MAX_LODS];
+    for (int l = 0; l + 1 < mesh->lod_count; ++l)
+        level_bytes[l] = index_size * (mesh->lods[l + 1].first_index - mesh->lods[l].first_index);
+    level_bytes[mesh->lod_count - 1] = index_size * last->index_count;
+    const size_t bytes = index_size * (last->first_index + last->index_count);
+    r->mesh_indices = malloc(bytes);
+    if (!r->mesh_indices)
+        return;
+    gl_state_bind_buffer(GL_COPY_READ_BUFFER, mesh->index_buffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)bytes, r->mesh_indices);
+    r->mesh_resident = gpu_memory_add_resident(&gl_memory, GPU_MEMORY_GEOMETRY, mesh->lod_count, level_bytes,
+        mesh->lod_count - 1);
+    if (r->mesh_resident < 0)
+    {
+        free(r->mesh_indices);
+        r->mesh_indices = NULL;
+    }
+}
+
+// Once a frame, before the draws: reports the finest level of detail the mesh is drawn at, passes on the driver's
+// numbers now and then, and carries out the levels gl_memory decides on
+static void renderer_update_memory(Renderer* r, const FramePacket* packet)
+{
+    for (int l = 0; r->mesh_resident >= 0 && l < LOD_MAX_LEVELS; ++l)
+    {
+        if (packet->lod_counts[l])
+        {
+            gpu_memory_use(&gl_memory, r->mesh_resident, l);
+            break;
+        }
+    }
+    GpuMemoryDriver driver;
+    const bool sample = packet->frame_index % RENDER_DRIVER_MEMORY_FRAMES == 0;
+    const bool driver_known = sample && gl_memory_query_driver(&driver);
+    if (driver_known)
+        gpu_memory_set_driver(&gl_memory, &driver);
+    if (sample && (telemetry_active() || metrics_active()))
+    {
+        // Bytes, -1 for not known: tracked, effective budget, driver's free, live heap
+        int64_t bytes[4] = { 0, -1, driver_known && driver.available_kb >= 0 ? driver.available_kb * 1024 : -1, -1 };
+        {
+            std::lock_guard<std::mutex> lock(gl_memory.mutex);
+            bytes[0] = (int64_t)gl_memory.total;
+            bytes[1] = gl_memory.effective_budget != UINT64_MAX ? (int64_t)gl_memory.effective_budget : -1;
+        }
+        if (alloc_tracking_available())
+        {
+            bytes[3] = 0;
+            for (int tag = 0; tag < ALLOC_TAG_COUNT; ++tag)
+            {
+                AllocTagStats stats;
+                alloc_tracker_stats((AllocTag)tag, &stats);
+                bytes[3] += stats.live;
+            }
+        }
+        float memory[4];
+        for (int i = 0; i < 4; ++i)
+            memory[i] = bytes[i] >= 0 ? bytes[i] / 1048576.f : -1.f;
+        memory[1] = bytes[1] >= 0 ? memory[1] : 0.f;    // the flight recorder's "no budget"
+        telemetry_record(TELEMETRY_MEMORY, packet->frame_index, memory, NULL);
+        r->metrics.gpu_memory_bytes = bytes[0];
+        r->metrics.gpu_budget_bytes = bytes[1];
+        r->metrics.gpu_available_bytes = bytes[2];
+        r->metrics.heap_bytes = bytes[3];
+    }
+    GpuResidencyChange changes[GPU_MEMORY_MAX_RESIDENTS];
+    const int count = gpu_memory_update(&gl_memory, changes);
+    for (int i = 0; i < count; ++i)
+    {
+        if (changes[i].resident == r->mesh_resident)
+            gpu_mesh_set_first_lod(&r->mesh, changes[i].to, r->mesh_indices);
+    }
+}
+
+// Hands the mesh's buffers to the registry, so replacing the mesh defers their deletion past the frames using them
+static void renderer_adopt_mesh(Renderer* r)
+{
+    r->mesh_handles[0] = gl_resources_add(&r->resources, GL_RESOURCE_BUFFER, r->mesh.vertex_buffer);
+    r->mesh_handles[1] = gl_resources_add(&r->resources, GL_RESOURCE_BUFFER, r->mesh.index_buffer);
+    gl_resources_label(&r->resources, r->mesh_handles[0], "mesh vertices");
+    gl_resources_label(&r->resources, r->mesh_handles[1], "mesh indices");
+}
+
+static void renderer_release_mesh(Renderer* r)
+{
+    gl_resources_release(&r->resources, r->mesh_handles[0]);
+    gl_resources_release(&r->resources, r->mesh_handles[1]);
+    r->mesh_handles[0] = r->mesh_handles[1] = 0;
+    memset(&r->mesh, 0, sizeof(r->mesh));
+}
+
+// Makes the view's context current along with its copy of the state cache; render_view_leave switches back.
+// Both copies live on, so neither context's cache has to be reset on every switch.
+static void render_view_enter(RenderView* v)
+{
+    glfwMakeContextCurrent(v->window);
+    const GLState main_state = gl_state;
+    gl_state = v->state;
+    v->state = main_state;
+}
+
+static void render_view_leave(Renderer* r, RenderView* v)
+{
+    glfwMakeContextCurrent(r->window);
+    const GLState view_state = gl_state;
+    gl_state = v->state;
+    v->state = view_state;
+}
+
+// Points the view's VAO at the current mesh, laid out as the main VAO is: only a buffer binding when the layout
+// hasn't changed and the context has vertex attrib binding. The view's context must be current.
+static void render_view_point_at_mesh(Renderer* r, RenderView* v)
+{
+    gl_state_bind_vertex_array(v->vertex_array);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, r->mesh.index_buffer);     // element buffer binding is VAO state
+    if (r->pull)
+        vertex_pull_bind(&r->pulled);      // the bindings are the context's own
+    else
+    {
+        vertex_format_attach(&r->vertex_format, &v->vertex_format, r->mesh.vertex_buffer);
+        v->vertex_format = r->vertex_format;
+    }
+    v->vertex_buffer = r->mesh.vertex_buffer;
+}
+
+// Loads GL through GLAD for the window's current context, plus the extensions glad wasn't generated with. glad's
+// loader finds an OpenGL ES context's version by its string; gladLoadGL() only knows desktop GL's.
+static void gl_load(GLFWwindow* window)
+{
+    if (glfwGetWindowAttrib(window, GLFW_CLIENT_API) == GLFW_OPENGL_ES_API)
+        gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    else
+        gladLoadGL();
+    gl_ext_load((GLADloadproc)glfwGetProcAddress);
+}
+
+// Loads GL and creates every GL object. The window's context must be current on the calling thread.
+static void renderer_init(Renderer* r, GLFWwindow* window, const RenderConfig* config)
+{
+    STARTUP_SCOPE("renderer_init");
+    const DrawMode draw_mode = config->draw_mode;
+    const int object_count = config->object_count;
+    r->window = window;
+    r->draw_mode = draw_mode;
+    r->object_count = object_count;
+    r->program = 0;
+    r->failed = false;
+    r->headless = config->headless_frames > 0;
+    r->frames_drawn = 0;
+    r->startup_report = config->startup;
+    r->objects_drawn = 0;
+    r->triangles_drawn = 0;
+    gpu_readback_init(&r->readback);
+    memset(r->culled, 0, sizeof(r->culled));
+    r->cluster_stats = { 0, 0, 0 };
+    r->particles_alive = 0;
+    r->counted_frames = 0;
+    r->counted_objects = 0;
+    r->counted_triangles = 0;
+    r->meshlet_frames = 0;
+    r->streamer = config->streamer;
+    r->streamed_mesh = config->streamer ? config->streamed_mesh : -1;
+    r->cull = config->cull;
+    r->settings.cull = config->cull;
+    r->settings.render_scale = config->render_scale;
+    r->settings.upload_budget_kb = config->upload_budget_kb;
+    r->settings.vram_budget_mb = config->vram_budget_mb;
+    r->occlusion = config->occlusion && draw_mode == DRAW_MODE_GPU_DRIVEN;
+    r->animate = config->gpu_animate && draw_mode == DRAW_MODE_INSTANCED;
+    r->pacer = config->pacer;
+    r->late_limiter = false;
+    r->xr = NULL;               // --xr: run_single_threaded's, once the renderer is up
+    r->xr_drawn = false;
+    r->frame_stats_csv = config->frame_stats_csv;
+    r->capture_path = config->capture_path;
+    memset(&r->capture, 0, sizeof(r->capture));
+    if (!frame_stats_init(&r->frame_stats))
+        r->failed = true;
+    metrics_sample_clear(&r->metrics);
+    r->metrics_published = 0.0;
+    memset(&r->offscreen, 0, sizeof(r->offscreen));
+
+    // Loads OpenGL through GLAD, plus the extensions glad wasn't generated with
+    {
+        STARTUP_SCOPE("gl load");
+        gl_load(window);
+    }
+    // The window shows at once, cleared, rather than blank or whatever was under it until the scene's first frame
+    // is ready: a swap now without waiting for a vblank (the pacer sets the real interval at the first frame)
+    if (!r->headless)
+    {
+        glfwSwapInterval(0);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glfwSwapBuffers(window);
+        startup_profile_milestone("window shown");
+    }
+    if (config->no_dsa)
+        gl_ext.ARB_direct_state_access = false;     // gl_dsa falls back to bind-to-edit
+    gl_state_reset();   // binds and state changes below go through the state cache, which starts out knowing nothing
+    gl_debug_init();    // debug builds: driver messages as they happen (nothing in Release or Profile)
+    gl_resources_init(&r->resources);
+
+    // --texture: mapped now, its mip tail uploaded with the first frame and larger levels as the objects need them
+    r->textures = NULL;
+    r->texture_id = -1;
+    if (config->texture_path)
+    {
+        r->textures = (TextureStreamer*)malloc(sizeof(TextureStreamer));
+        texture_streamer_init(r->textures, &r->resources, (uint64_t)(config->texture_budget_mb > 0 ? config->texture_budget_mb : 1) << 20,
+            RENDER_TEXTURE_UPLOAD_BYTES);
+        texture_streamer_stage(r->textures, config->io_backend);   // 4.4: levels read into a staging buffer
+        r->texture_id = texture_streamer_load(r->textures, config->texture_path);
+        r->texture_size = MESH_UV_SPAN * config->scene->scale * 0.5f;
+        if (r->texture_id < 0)
+        {
+            free(r->textures);      // drawn untextured
+            r->textures = NULL;
+        }
+    }
+
+    // --material: every texture uploaded whole now, packed into texture arrays or behind bindless handles, so
+    // objects with different materials still go out in one draw
+    r->materials = NULL;
+    if (config->material_count > 0)
+    {
+        r->materials = (MaterialSet*)malloc(sizeof(MaterialSet));
+        if (!material_set_init(r->materials, &r->resources, config->material_paths, config->material_count, !config->arrays_only))
+        {
+            free(r->materials);     // drawn untextured; the material indices still stream but nothing reads them
+            r->materials = NULL;
+        }
+    }
+
+    // --lights: lit variants of the scene shaders, forward or writing a G-buffer for one deferred pass. The
+    // lights move and are binned into clusters on the GPU every frame.
+    r->lighting = NULL;
+    r->deferred = false;
+    if (config->light_count > 0)
+    {
+        r->lighting = (Lighting*)malloc(sizeof(Lighting));
+        if (renderer_init_lights(r->lighting, config->light_count, config->deferred, config->reversed_z))
+            r->deferred = config->deferred;
+        else
+        {
+            lighting_destroy(r->lighting);  // drawn unlit
+            free(r->lighting);
+            r->lighting = NULL;
+        }
+    }
+
+    // Submits every program up front: cached binaries are ready at once, the rest compile on the driver's
+    // threads (GL_KHR_parallel_shader_compile) while we set up buffers and present the first frames
+    program_cache_init(&r->program_cache, "shader_cache");
+    shader_manager_init(&r->shader_manager, &r->program_cache, 0xFFFFFFFFu);
+    // The scene program is the variant of the master scene shaders for this run's features (a binary load when
+    // --precompile-shaders has been run for this driver)
+    scene_shaders_init(&r->scene_shaders);
+    r->scene_variant = draw_mode != DRAW_MODE_NAIVE ? SCENE_FEATURE_INSTANCED : 0;
+    if (config->stereo)
+        r->scene_variant |= SCENE_FEATURE_STEREO;
+    // --pull: the scene's vertex stage fetches the vertices, so the VAO keeps the instance attributes alone. Not with
+    // --shader-dir, whose files may not have the PULLED path.
+    r->pull = config->pull && !config->shader_dir && vertex_pull_supported();
+    if (config->pull && !r->pull)
+        fprintf(stderr, "Warning: %s, the vertices are fetched as attributes\n", config->shader_dir
+            ? "--shader-dir's scene shaders may not pull them" : "no shader storage in the vertex stage");
+    if (r->pull)
+    {
+        vertex_pull_init(&r->pulled);
+        r->scene_variant |= SCENE_FEATURE_PULLED;
+    }
+    if (r->materials)
+        r->scene_variant |= r->materials->mode == MATERIAL_MODE_BINDLESS ? SCENE_FEATURE_MATERIAL_BINDLESS
+            : SCENE_FEATURE_MATERIAL_ARRAYS;
+    else if (r->textures)
+        r->scene_variant |= SCENE_FEATURE_TEXTURED;
+    uint64_t lit = !r->lighting ? 0 : !r->deferred ? SCENE_FEATURE_LIT
+        : r->lighting->pixel_local ? SCENE_FEATURE_GBUFFER | SCENE_FEATURE_PIXEL_LOCAL : SCENE_FEATURE_GBUFFER;
+    // --oit: the scene and the characters go to the OIT targets or lists translucent, and are composited over what
+    // was drawn before them (main has ruled out the passes it can't share the frame with). Not with --shader-dir,
+    // whose files may not have the OIT paths.
+    r->oit = NULL;
+    if (config->oit != OIT_OFF && (config->shader_dir || !oit_supported((OitMode)config->oit)))
+        fprintf(stderr, "Warning: %s, the scene is drawn opaque\n", config->shader_dir
+            ? "--shader-dir's scene shaders may not have the OIT paths" : "no shader storage for --oit's lists");
+    else if (config->oit != OIT_OFF)
+    {
+        r->oit = (Oit*)malloc(sizeof(Oit));
+        if (oit_init(r->oit, (OitMode)config->oit, config->reversed_z))
+            lit |= r->oit->mode == OIT_LIST ? SCENE_FEATURE_OIT_LIST : SCENE_FEATURE_OIT_WEIGHTED;
+        else
+        {
+            oit_destroy(r->oit);    // drawn opaque
+            free(r->oit);
+            r->oit = NULL;
+        }
+    }
+    // --shadows: the sun's cascades, their casters drawn with the pre-pass's depth-only program. The scene and the
+    // characters take the SHADOWED variant, and a ground pass shows the shadows on the plane one object size under
+    // the flat scene. The sun stays where it is; the casters change wherever the objects are, whenever they spin.
+    r->shadows = NULL;
+    r->shadow_state = -1;
+    r->shadow_camera_version = 0;
+    r->shadow_sim_time = -1.0;
+    r->shadow_draws = 0;
+    if (config->shadows > 0 && (config->shader_dir || !shadow_maps_supported()))
+        fprintf(stderr, "Warning: %s, drawn without shadows\n", config->shader_dir
+            ? "--shader-dir's scene shaders may not have the SHADOWED path" : "no 4.3 context for --shadows");
+    else if (config->shadows > 0)
+    {
+        const Scene* scene = config->scene;
+        r->shadows = (ShadowMaps*)malloc(sizeof(ShadowMaps));
+        if (shadow_maps_init(r->shadows, config->shadows, RENDER_SHADOW_RESOLUTION, config->reversed_z && gl_ext.ARB_clip_control,
+            -scene->scale))
+        {
+            const vec3 sun = { 0.35f, -0.45f, -1.f };
+            shadow_cascades_set_light(&r->shadows->cascades, sun);
+            lit |= SCENE_FEATURE_SHADOWED;
+            r->casters = scene->bounds[0];
+            for (int i = 1; i < scene->count; ++i)
+                for (int k = 0; k < 3; ++k)
+                {
+                    r->casters.min[k] = fminf(r->casters.min[k], scene->bounds[i].min[k]);
+                    r->casters.max[k] = fmaxf(r->casters.max[k], scene->bounds[i].max[k]);
+                }
+        }
+        else
+        {
+            shadow_maps_destroy(r->shadows);
+            free(r->shadows);
+            r->shadows = NULL;
+        }
+    }
+    r->scene_variant |= lit;
+    // --gpu-pick: the instanced forward pass writes object IDs beside the colour (main has ruled out the rest)
+    r->picker = NULL;
+    r->pick = { false, 0.0, 0.0 };
+    if (config->gpu_pick && draw_mode == DRAW_MODE_INSTANCED)
+    {
+        r->picker = (GpuPicker*)malloc(sizeof(GpuPicker));
+        gpu_picker_init(r->picker);
+        r->scene_variant |= SCENE_FEATURE_PICK_ID;
+    }
+    // --wall: the swaps wait for every node's frame, through a hardware swap barrier too where there is one
+    r->wall = config->wall;
+    r->swap_group = false;
+    if (r->wall && !r->headless)
+    {
+        bool bound = false;
+        r->swap_group = swap_group_join(1, 1, &bound);
+        printf("wall: node %d of %d, %s\n", r->wall->node, r->wall->nodes, !r->swap_group ? "synchronised over the network"
+            : bound ? "in NV_swap_group 1 on swap barrier 1" : "in NV_swap_group 1, no swap barrier");
+    }
+    // P's screenshots in a window, and --record's frames: the recorder's thread idles until there's one
+    r->screen = NULL;
+    if (!r->headless || config->record_path)
+    {
+        const double limit = config->pacer->fps_limit.load(std::memory_order_relaxed);
+        r->screen = new ScreenCapture;
+        screen_capture_init(r->screen, config->record_path, limit > 0.0 ? (int)(limit + 0.5) : 60);
+        screen_recorder_set_encoder(&r->screen->recorder, (ScreenRecorderEncoder)config->encoder, config->hevc,
+            config->bitrate_kbps);
+    }
+    r->overdraw_view = config->overdraw;
+    if (r->overdraw_view)
+    {
+        // Every fragment the same: nothing of the colour, texture or lighting is computed
+        r->scene_variant = (r->scene_variant & (SCENE_FEATURE_INSTANCED | SCENE_FEATURE_PULLED | SCENE_FEATURE_STEREO))
+            | SCENE_FEATURE_OVERDRAW;
+        lit = SCENE_FEATURE_OVERDRAW;   // the characters too
+    }
+    r->pipelines = NULL;
+    r->scene_pipeline_id = -1;
+    r->scene_program_id = -1;
+    r->pipeline = 0;
+    if (config->separable && (config->shader_dir || !program_pipelines_supported()))
+        fprintf(stderr, "Warning: %s, the scene is drawn with a whole program\n", config->shader_dir
+            ? "--shader-dir reloads whole programs" : "no GL_ARB_separate_shader_objects");
+    if (config->separable && !config->shader_dir && program_pipelines_supported())
+    {
+        // Each distinct stage is compiled and linked once, and shared by every variant that composes it the same
+        r->pipelines = (ProgramPipelines*)malloc(sizeof(ProgramPipelines));
+        program_pipelines_init(r->pipelines, &r->program_cache);
+        r->scene_pipeline_id = shader_permutation_pipeline(&r->scene_shaders, r->pipelines, r->scene_variant);
+    }
+    else
+        r->scene_program_id = shader_permutation_program(&r->scene_shaders, &r->shader_manager, r->scene_variant);
+
+    // --depth-prepass: the same vertex stage with nothing in the fragment stage, a whole program even when the
+    // scene is separable. --shadows draws its casters with it too.
+    r->depth_prepass = config->depth_prepass && config->depth && !r->occlusion;
+    r->prepass_program_id = -1;
+    r->prepass_program = 0;
+    pipeline_states_init(&r->states);
+    r->pass_states[0] = r->pass_states[1] = { -1, -1, -1 };
+    r->pass = &r->pass_states[0];
+    if (r->depth_prepass || r->shadows)
+        r->prepass_program_id = shader_permutation_program(&r->scene_shaders, &r->shader_manager,
+            (r->scene_variant & (SCENE_FEATURE_INSTANCED | SCENE_FEATURE_PULLED | SCENE_FEATURE_STEREO))
+                | SCENE_FEATURE_DEPTH_ONLY);
+
+    // A window shows a progress bar until the scene draws, then fades it in; its program queues behind the scene's
+    r->loading_screen = !r->headless;
+    r->loading_frame = false;
+    r->asset_deadline = glfwGetTime() + LOADING_ASSET_WAIT_SECONDS;
+    if (r->loading_screen)
+        loading_screen_init(&r->loading, &r->shader_manager);
+
+    // --on-demand: an overlay refresh presents only the overlay as damage, where nothing else can have changed in
+    // a frame nothing else asked for. Overlays that move by themselves, TAA's jitter and a changing scale can.
+    r->redraw = r->headless ? NULL : config->redraw;
+    r->redraw_reasons = 0;
+    r->damage_swaps = r->redraw && !config->taa && config->resolution_budget_ms <= 0.0 && !config->governor
+        && (!config->shape_count || config->retained_ui) && !config->path_count
+        && !config->point_count && !config->feed_name && !config->cuda_point_count && !config->series_count
+        && !config->map_megabytes
+        && !config->particle_count
+        && swap_damage_init(&r->damage);
+
+    // --shader-dir: the master scene shaders come from files there, and the variant is rebuilt from them whenever
+    // they're saved
+    if (config->shader_dir)
+    {
+        char vertex_path[FILE_WATCHER_PATH_MAX], fragment_path[FILE_WATCHER_PATH_MAX];
+        snprintf(vertex_path, sizeof(vertex_path), "%s/scene.vert", config->shader_dir);
+        snprintf(fragment_path, sizeof(fragment_path), "%s/scene.frag", config->shader_dir);
+        shader_manager_watch(&r->shader_manager, r->scene_program_id, vertex_path, fragment_path);
+    }
+
+    // Buffer intervals (none when benchmarking: nothing is presented and nothing should cap the rate).
+    // Otherwise the pacer picks it before every swap, from the mode the command line or the V key asked for.
+    if (r->headless)
+        glfwSwapInterval(0);
+    else
+        r->pacer->tear_supported = glfwExtensionSupported("WGL_EXT_swap_control_tear")
+            || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+
+    // Errors: debug builds report them through gl/gl_debug.h as they happen (or checked once a frame without
+    // GL_KHR_debug); optimised builds don't check.
+
+    // Sets up Vertex Array object (VAO) to manage vertex attribute configs
+    r->vertex_array_handle = gl_resources_create_vertex_array(&r->resources);
+    r->vertex_array = gl_resources_get(&r->resources, r->vertex_array_handle);
+    gl_state_bind_vertex_array(r->vertex_array);    // bind the VAO - vertex attributes or buffer configs are stored in it
+    gl_resources_label(&r->resources, r->vertex_array_handle, "scene vertex array");
+
+    r->split_meshlets = NULL;
+    r->split_meshlet_count = 0;
+    if (!config->mesh_path || !renderer_load_mesh_file(r, config->package, config->mesh_path, config->meshlets))
+        renderer_load_builtin_mesh(r, config);
+    renderer_adopt_mesh(r);
+
+    // Setup the per-instance model matrix stream - one affine mat3x4 (48 bytes, the bottom row is implicit) per object,
+    // advancing once per instance instead of per vertex.
+    // Persistently mapped ring (orphaned buffer on 3.3) that the matrices are written into every frame. The GPU-driven
+    // path and --gpu-animate have a compute shader write them instead and need only a token ring.
+    // With materials each frame's region also holds a uint per object, the instance's material index, and with
+    // --gpu-pick another, its object index.
+    const GLsizeiptr instance_bytes = sizeof(mat3x4) + (r->materials ? sizeof(uint32_t) : 0)
+        + (r->picker ? sizeof(uint32_t) : 0);
+    stream_buffer_init(&r->instance_stream, GL_ARRAY_BUFFER, instance_bytes * (draw_mode == DRAW_MODE_GPU_DRIVEN || r->animate ? 1 : object_count));
+    gl_debug_label(GL_BUFFER, r->instance_stream.buffer, "instance stream");
+
+    // The camera changes on resize only, so its block lives in a buffer of its own, written when it does.
+    // A wall of windows has one block per window, each the camera narrowed to that window's tile. --stereo has
+    // the Stereo block after the camera's. --serve has a block for each request of a batch after the windows'.
+    r->view_count = config->window_count > 1 ? config->window_count - 1 : 0;
+    r->eyes = config->stereo ? 2 : 1;
+    r->camera_buffer_handle = gl_resources_create_buffer(&r->resources);
+    r->camera_buffer = gl_resources_get(&r->resources, r->camera_buffer_handle);
+    gl_resources_label(&r->resources, r->camera_buffer_handle, "camera uniforms");
+    r->camera_version = 0;
+    r->camera_stride = uniforms_block_stride(sizeof(CameraUniforms));
+    const GLsizeiptr camera_bytes = r->camera_stride * (1 + r->view_count)
+        + (config->stereo ? (GLsizeiptr)sizeof(StereoUniforms) : 0)
+        + (config->serve_port > 0 ? r->camera_stride * RENDER_SERVICE_MAX_BATCH : 0);
+    gl_state_bind_buffer(GL_UNIFORM_BUFFER, r->camera_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, camera_bytes, NULL, GL_DYNAMIC_DRAW);
+    gl_memory_buffer(r->camera_buffer, GPU_MEMORY_UNIFORMS, camera_bytes);
+
+    // Same kind of ring for the per-frame uniform blocks: one Frame block plus one Draw block per draw call
+    // (one identity block shared by the particles and the characters included)
+    const GLsizeiptr frame_block_stride = uniforms_block_stride(sizeof(FrameUniforms));
+    const GLsizeiptr draw_block_stride = uniforms_block_stride(sizeof(DrawUniforms));
+    const int draws_per_frame = draw_mode == DRAW_MODE_NAIVE ? object_count : 1;
+    stream_buffer_init(&r->uniform_stream, GL_UNIFORM_BUFFER,
+        frame_block_stride + draw_block_stride * (draws_per_frame + (config->particle_count > 0 || config->characters)));
+    gl_debug_label(GL_BUFFER, r->uniform_stream.buffer, "uniform stream");
+    r->draw_offsets = (GLintptr*)malloc(sizeof(GLintptr) * draws_per_frame);
+    for (int row = 0; row < 3; ++row)
+    {
+        // A mat3x4 attribute is 3 vec4 attributes at consecutive locations; each GLSL column is one of our rows
+        glVertexAttribDivisor(vmodel_location + row, r->eyes);  // advance once per instance (--stereo: per pair)
+        if (draw_mode != DRAW_MODE_NAIVE)
+            glEnableVertexAttribArray(vmodel_location + row);
+        else
+            glVertexAttrib4f(vmodel_location + row, row == 0, row == 1, row == 2, 0.f);   // disabled array -> constant identity row
+    }
+    glVertexAttribDivisor(vmaterial_location, r->eyes);
+    if (r->materials && draw_mode != DRAW_MODE_NAIVE)
+        glEnableVertexAttribArray(vmaterial_location);
+    else
+        glVertexAttribI4ui(vmaterial_location, 0, 0, 0, 1);    // naive: set per draw
+    glVertexAttribDivisor(vobject_location, r->eyes);
+    if (r->picker)
+        glEnableVertexAttribArray(vobject_location);
+
+    // GPU-driven: the objects go up once, and the instance attributes read the matrices the cull writes, always
+    // from the start of the same buffer. --cull-select's GPU frames point them there as they draw.
+    r->cull_selector = config->cull_selector;
+    r->cull_frame = ~0u;
+    if (draw_mode == DRAW_MODE_GPU_DRIVEN || r->cull_selector)
+    {
+        const Scene* scene = config->scene;
+        if (!gpu_culling_init(&r->gpu_culling, scene->pos_x, scene->pos_y, scene->phase, scene->radius,
+            (uint32_t)scene->count, scene->scale, r->materials ? (uint32_t)scene->material_count : 0))
+            r->failed = true;
+        gl_state_bind_buffer(GL_ARRAY_BUFFER, r->gpu_culling.instance_buffer);
+        set_instance_attribs(vmodel_location, 0);
+        if (r->gpu_culling.material_buffer)
+        {
+            gl_state_bind_buffer(GL_ARRAY_BUFFER, r->gpu_culling.material_buffer);
+            glVertexAttribIPointer(vmaterial_location, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        }
+    }
+
+    // --gpu-animate: the motions go up once, with the materials and object indices the draws read beside the
+    // matrices. The instance offsets stay put; each frame's dispatch rewrites the same matrices.
+    if (r->animate)
+    {
+        const Scene* scene = config->scene;
+        InstanceMotion* motions = scene_motions(scene);
+        uint32_t* materials = r->materials ? (uint32_t*)malloc(sizeof(uint32_t) * scene->count) : NULL;
+        for (int i = 0; materials && i < scene->count; ++i)
+            materials[i] = (scene->material_ids ? scene->material_ids[i] : (uint32_t)i) % (uint32_t)scene->material_count;
+        if (!motions || (r->materials && !materials) || !gpu_animation_init(&r->animation, motions, (uint32_t)scene->count,
+            scene->scale, materials, r->picker != NULL))
+            r->failed = true;
+        free(materials);
+        free(motions);
+        r->instance_offset = 0;
+        r->material_offset = r->animation.material_offset;
+        r->object_offset = r->animation.object_offset;
+    }
+
+    // --meshlets: the meshlets the loader split level 0 into go up once; without them the objects draw whole
+    r->meshlets = false;
+    if (r->split_meshlets)
+    {
+        r->meshlets = cluster_culling_init(&r->clusters, r->split_meshlets, r->split_meshlet_count, (uint32_t)object_count);
+        if (!r->meshlets)
+        {
+            fprintf(stderr, "Warning: --meshlets falls back to culling whole objects\n");
+            cluster_culling_destroy(&r->clusters);
+        }
+        free(r->split_meshlets);
+        r->split_meshlets = NULL;
+    }
+    renderer_manage_mesh_lods(r);
+
+    // --particles: a fountain rising from the bottom of the view. Its state, emission included, stays on the GPU;
+    // it's drawn with the scene shaders' instanced variant (the run's scene program too, unless that's naive or
+    // textured), the particle colours in place of the vertex colours.
+    r->particles = NULL;
+    r->particle_program_id = -1;
+    r->particle_program = 0;
+    if (config->particle_count > 0)
+    {
+        ParticleEmitter emitter;
+        emitter.position[0] = 0.f;
+        emitter.position[1] = -0.9f;
+        emitter.lifetime = 2.f;
+        emitter.rate = 0.8f * config->particle_count / emitter.lifetime;   // a little under full at the average lifetime
+        emitter.speed = 1.6f;
+        emitter.spread = 0.35f;
+        emitter.gravity = 1.2f;
+        emitter.size = 0.012f;
+        r->particles = (ParticleSystem*)malloc(sizeof(ParticleSystem));
+        if (particles_init(r->particles, (uint32_t)config->particle_count, &emitter, vpos_location, vcol_location,
+            vmodel_location))
+            r->particle_program_id = shader_permutation_program(&r->scene_shaders, &r->shader_manager, SCENE_FEATURE_INSTANCED);
+        else
+        {
+            particles_destroy(r->particles);    // drawn without
+            free(r->particles);
+            r->particles = NULL;
+        }
+        gl_state_bind_vertex_array(r->vertex_array);
+    }
+
+    // --characters: the palettes come from the packets; the mesh and the ring for them are set up here
+    r->characters = NULL;
+    r->character_count = 0;
+    r->character_program_id = -1;
+    r->character_program = 0;
+    if (config->characters)
+    {
+        r->characters = (SkinnedBatch*)malloc(sizeof(SkinnedBatch));
+        r->character_count = (uint32_t)config->characters->count;
+        if (renderer_init_characters(r->characters, config->characters))
+            r->character_program_id = shader_permutation_program(&r->scene_shaders, &r->shader_manager,
+                SCENE_FEATURE_SKINNED | (config->characters->baked ? SCENE_FEATURE_BAKED : 0) | lit);
+        else
+        {
+            skinned_batch_destroy(r->characters);   // drawn without
+            free(r->characters);
+            r->characters = NULL;
+        }
+        gl_state_bind_vertex_array(r->vertex_array);
+    }
+
+    // Depth testing (--depth, or occlusion, which needs a depth buffer it can read back): the frames go to an
+    // offscreen target (created at the framebuffer's size in renderer_begin_frame, unless headless) and are
+    // blitted to the window. --depth's is float and reversed-Z: floats are densest near 0, where reversed Z puts
+    // the far distances that need the precision. Without glClipControl the [-1, 1] range keeps the depth in its
+    // upper half, which still tests right, only without that gain.
+    r->depth = config->depth || r->occlusion;
+    r->float_depth = config->depth;
+    r->reversed_z = config->reversed_z;
+    r->depth_func = r->reversed_z ? GL_GEQUAL : GL_LEQUAL;
+    if (r->reversed_z)
+    {
+        if (gl_ext.ARB_clip_control)
+            gl_ext.ClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        if (gl_ext.es)
+            glClearDepthf(0.f);     // ES has only the float one
+        else
+            glClearDepth(0.0);
+    }
+    if (r->depth)
+    {
+        gl_state_enable(GL_DEPTH_TEST, true);
+        gl_state_depth_func(r->depth_func);
+    }
+    if (r->occlusion && !hiz_init(&r->hiz, &r->resources))
+        r->failed = true;
+
+    // Headless reports the overdraw; --overdraw measures it as it shows it
+    r->measure_overdraw = r->headless || config->overdraw;
+    if (r->measure_overdraw)
+        overdraw_init(&r->overdraw);
+
+    // --dynamic-res: the scene renders into the offscreen target at a fraction of its size, chosen each frame from
+    // the "frame" scope's GPU time, and is stretched over the window as it's presented
+    r->dynamic_resolution = config->resolution_budget_ms > 0.0;
+    resolution_scaler_init(&r->scaler, config->resolution_budget_ms, 0.5f, 1.f, GPU_PROFILER_LATENCY);
+    r->scaler_frame = ~0u;
+    r->render_width = config->width;
+    r->render_height = config->height;
+    r->upscale = render_target_upscale_bilinear;
+    r->upscale_user = NULL;
+
+    // --governor: each frame's GPU and CPU times go to the quality governor, and a change of its tier scales the
+    // resolution (offscreen, as --dynamic-res's, on top of any scale of its own), the shadow cascades, the particles'
+    // emission and (on the main thread, through the scene) the LOD error from what was asked for
+    r->governor = config->governor;
+    r->governed_resolution = r->governor && !config->occlusion;
+    r->governed_cascades = r->shadows ? r->shadows->cascades.count : 0;
+    r->governed_particle_rate = r->particles ? r->particles->emitter.rate : 0.f;
+    r->governor_frame = ~0u;
+    r->cpu_start = frame_pacer_now();
+    r->cpu_ms = 0.0;
+
+    // --post: the scene drawn to a half-float target, then through bloom, tonemapping and FXAA on its way to the
+    // window; the chain's last draw stretches it, so it stands in for the upscale
+    render_target_pool_init(&r->targets, &r->resources);
+    r->post = NULL;
+    r->post_presented = false;
+    if (config->post)
+    {
+        r->post = (PostProcess*)malloc(sizeof(PostProcess));
+        r->post_settings = *config->post;
+        if (!post_process_init(r->post, &r->targets))
+        {
+            post_process_destroy(r->post);  // presented without
+            free(r->post);
+            r->post = NULL;
+        }
+    }
+    r->color_format = r->post ? GL_RGBA16F : GL_RGBA8;
+    if (gl_ext.es)
+    {
+        // Tiled GPUs pay for every byte stored: the HDR input in 11/11/10-bit floats where ES renders them, and
+        // 10-bit colour rather than 8 for the same 32 bits
+        r->color_format = r->post && gl_ext.EXT_color_buffer_float ? GL_R11F_G11F_B10F : GL_RGB10_A2;
+    }
+
+    // --msaa: the scene's passes draw into multisampled buffers, resolved once the scene is done. Post-processing,
+    // the upscale and the overlay then run on single-sample targets (the window has no samples), so the extra
+    // bandwidth is the scene's alone.
+    GLint max_samples = 1;
+    if (config->msaa_samples > 1)
+        glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    r->samples = config->msaa_samples > 1 ? (config->msaa_samples < max_samples ? config->msaa_samples : max_samples) : 1;
+    if (r->samples < config->msaa_samples)
+        fprintf(stderr, "Warning: --msaa %d is more than the driver's %d samples\n", config->msaa_samples, r->samples);
+    r->offscreen_frames = r->depth || r->dynamic_resolution || r->governed_resolution || r->post || r->samples > 1
+        || r->picker || config->render_scale < 1.f || config->volume_side > 0 || config->volume_path;
+
+    // --taa: the projection jittered inside the pixel each frame, and the frame resolved against the last ones,
+    // reprojected through the offscreen depth (main keeps it single-sampled)
+    r->taa = NULL;
+    if (config->taa && r->depth && r->samples == 1)
+    {
+        r->taa = (TemporalAa*)malloc(sizeof(TemporalAa));
+        if (!temporal_aa_init(r->taa, r->reversed_z && gl_ext.ARB_clip_control))
+        {
+            temporal_aa_destroy(r->taa);    // drawn without
+            free(r->taa);
+            r->taa = NULL;
+        }
+    }
+
+    // --impostors: the atlas is baked from the mesh the first time the scene has impostors to draw
+    r->impostors = NULL;
+    r->impostor_radius = 0.f;
+    for (size_t v = 0; v < sizeof(vertices) / sizeof(vertices[0]); ++v)
+        r->impostor_radius = fmaxf(r->impostor_radius, vec2_len(vertices[v].pos));
+    if (config->impostor_pixels > 0.f && draw_mode == DRAW_MODE_INSTANCED)
+    {
+        r->impostors = (ImpostorRenderer*)malloc(sizeof(ImpostorRenderer));
+        if (!impostor_renderer_init(r->impostors, RENDER_IMPOSTOR_FRAME))
+        {
+            free(r->impostors);     // the scene still splits them off: drawn at the coarsest level instead
+            r->impostors = NULL;
+        }
+    }
+
+    // --terrain: made-up heights, or a file's streamed under a budget of their own; --terrain-texture: its detail
+    // paged in as the feedback asks, the feedback coming back through the renderer's readbacks
+    r->terrain = NULL;
+    if (config->terrain_size > 0.f && r->depth)
+    {
+        r->terrain = (TerrainRenderer*)malloc(sizeof(TerrainRenderer));
+        if (!terrain_renderer_init(r->terrain, &r->resources, config->terrain_heightmap, config->terrain_size, -0.05f,
+            RENDER_TERRAIN_RELIEF * config->terrain_size, config->terrain_tessellation, RENDER_TERRAIN_BUDGET))
+        {
+            free(r->terrain);
+            r->terrain = NULL;
+        }
+        else if (config->terrain_texture_mb > 0)
+            terrain_renderer_texture(r->terrain, (uint64_t)config->terrain_texture_mb << 20, &r->readback);
+    }
+
+    // --volume, --volume-file: marched over the scene target, stopping at its depth where there is one to read
+    r->volume = NULL;
+    if (config->volume_side > 0 || config->volume_path)
+    {
+        r->volume = (VolumeRenderer*)malloc(sizeof(VolumeRenderer));
+        if (!volume_renderer_init(r->volume, config->volume_path, config->volume_side, RENDER_VOLUME_BUDGET))
+        {
+            free(r->volume);
+            r->volume = NULL;
+        }
+    }
+
+    // --vrs: the scene's tiles shaded coarser away from the fovea (and, adaptive, where they're flat or moving)
+    // through the NV shading rate image. Without it the periphery is drawn at half size around a full-size inset,
+    // which only the plain forward pass can do: nothing may draw under the scene or in passes of its own.
+    r->foveation = NULL;
+    if (config->vrs)
+    {
+        ShadingRateSettings settings;
+        shading_rate_defaults(&settings);
+        r->foveation = (Foveation*)malloc(sizeof(Foveation));
+        const bool made = foveation_init(r->foveation, (FoveationMode)config->vrs, &settings);
+        const bool fits = r->foveation->rate_image || !(r->deferred || r->oit || r->shadows || r->depth_prepass || r->picker
+            || r->overdraw_view || r->draw_mode == DRAW_MODE_GPU_DRIVEN || r->samples > 1 || config->map_megabytes > 0
+            || config->point_count > 0 || config->feed_name || config->cuda_point_count > 0 || r->terrain
+            || r->volume);
+        if (made && !fits)
+            fprintf(stderr, "Warning: no GL_NV_shading_rate_image, and the half-size periphery only fits the plain "
+                "forward pass; --vrs ignored\n");
+        else if (made && (int)r->foveation->mode != config->vrs)
+            fprintf(stderr, "Warning: --vrs adaptive needs GL_NV_shading_rate_image and 4.3; the rates are fixed\n");
+        if (!made || !fits)
+        {
+            foveation_destroy(r->foveation);    // drawn at full rate
+            free(r->foveation);
+            r->foveation = NULL;
+        }
+    }
+    r->offscreen_frames = r->offscreen_frames || r->foveation;
+
+    // Timer queries per pass, read back a few frames late so they never stall (and steer --dynamic-res)
+    r->profiling = config->profile || config->profile_csv || r->headless || cpu_trace_active() || r->dynamic_resolution
+        || r->governor || config->pipeline_stats || config->gpu_counters || telemetry_active() || r->cull_selector;
+    gpu_profiler_init(&r->profiler, r->profiling, config->profile_csv);
+    if (config->pipeline_stats && !gpu_profiler_set_statistics(&r->profiler, true))
+        fprintf(stderr, "--pipeline-stats: GL_ARB_pipeline_statistics_query isn't supported, passes get CPU counts only\n");
+    memset(&r->gpu_counters, 0, sizeof(r->gpu_counters));
+    if (config->gpu_counters && !strcmp(config->gpu_counters, "list"))
+        gpu_counters_list(stdout);
+    else if (config->gpu_counters && gpu_counters_init(&r->gpu_counters,
+        strcmp(config->gpu_counters, "default") ? config->gpu_counters : NULL))
+    {
+        printf("gpu counters: %d", r->gpu_counters.count);
+        if (r->gpu_counters.set[0])
+            printf(" from the %s set", r->gpu_counters.set);
+        printf("\n");
+        r->profiler.hardware = &r->gpu_counters;
+    }
+    hitch_detector_init(&r->hitches, config->hitches, stdout);
+    r->profiler.hitches = config->hitches ? &r->hitches : NULL;     // the passes
+    gl_state.hitches = r->profiler.hitches;     // and the program binds
+    memset(&r->draw_sampler, 0, sizeof(r->draw_sampler));
+    if (config->draw_timings > 0)
+    {
+        if (draw_sampler_init(&r->draw_sampler, (unsigned int)config->draw_timings, stdout))
+            r->profiler.draws = &r->draw_sampler;
+        else
+            fprintf(stderr, "Warning: --draw-timings needs timestamp queries (GL_EXT_disjoint_timer_query on ES)\n");
+    }
+
+    // The overlay is only made for a window, and only once H shows it (its program links and its glyph atlas
+    // loads in the way of the first frame otherwise) unless --labels needs its text from the start
+    r->hud_pending = !r->headless && config->labels <= 0;
+    r->hud_ready = !r->headless && !r->hud_pending && hud_init(&r->hud, "shader_cache");
+    r->hud_visible = false;
+    r->label_count = 0;
+    for (int i = 0; i < config->labels && i < RENDER_MAX_LABELS && r->hud_ready; ++i)
+        r->label_slots[r->label_count++] = text_cache_add(r->hud.text);
+    r->draw_calls = 0;
+
+    // --shapes, --paths: the streams hold the dashboard's mix, which averages under 5 vertices and 10 indices a
+    // primitive, and the gauges', under 128 vertices and 192 indices a path however large the gauges are drawn
+    r->shape_count = config->shape_count;
+    r->path_count = config->path_count;
+    r->shapes = NULL;
+    r->gauge_paths = NULL;
+    r->shape_draws = r->shape_frames = r->path_waves = r->path_flattens = 0;
+    // --retained-ui: the dashboard's primitives go into the widgets' ranges instead, each chart's with room for its
+    // share of them at the streams' rate
+    r->ui = NULL;
+    r->ui_next = 0.0;
+    if (r->shape_count > 0 && config->retained_ui)
+    {
+        r->ui = (UiLayer*)malloc(sizeof(UiLayer));
+        ui_layer_init(r->ui);
+        const uint32_t per_chart = (uint32_t)r->shape_count / DASHBOARD_CHARTS + 1;
+        bool added = ui_layer_add(r->ui, 4 * DASHBOARD_CHARTS, 6 * DASHBOARD_CHARTS) >= 0;
+        for (int c = 0; c < DASHBOARD_CHARTS && added; ++c)
+            added = ui_layer_add(r->ui, 8 * per_chart, 16 * per_chart) >= 0;
+        if (!added || !ui_renderer_init(&r->ui_renderer))
+        {
+            fprintf(stderr, "Warning: the retained dashboard couldn't be set up; --retained-ui ignored\n");
+            ui_layer_destroy(r->ui);
+            free(r->ui);
+            r->ui = NULL;
+        }
+    }
+    if ((r->shape_count > 0 && !r->ui) || r->path_count > 0)
+    {
+        r->shapes = (ShapeBatch*)malloc(sizeof(ShapeBatch));
+        shape_batch_init(r->shapes);
+        const uint32_t shape_count = r->ui ? 0 : (uint32_t)r->shape_count;
+        const uint32_t path_vertices = r->path_count > 0 ? 128u * r->path_count + 16384 : 0;
+        if (!shape_renderer_init(&r->shape_renderer, 8u * shape_count + path_vertices + 1024,
+            16u * shape_count + path_vertices * 3 / 2 + 1024))
+        {
+            shape_batch_destroy(r->shapes);
+            free(r->shapes);
+            r->shapes = NULL;
+            if (!r->ui)
+                r->shape_count = 0;
+            r->path_count = 0;
+        }
+    }
+    if (r->path_count > 0)
+    {
+        r->gauge_paths = (VectorPath*)malloc(sizeof(VectorPath) * (3 + gauge_count(r->path_count)));
+        for (int i = 0; i < 3 + gauge_count(r->path_count); ++i)
+            vector_path_init(&r->gauge_paths[i]);
+        gauge_statics(r->gauge_paths);
+    }
+
+    // --points: decimated and refined on the GPU, from a layer of its own composited under the scene
+    r->points = config->point_count > 0 ? renderer_init_points(config->point_count) : NULL;
+
+    // --feed: another process's points, copied from its shared memory into a stream buffer of their own;
+    // --cuda-points: a CUDA kernel's, drawn by the same program from the buffer the kernel writes
+    r->feed = config->feed_name || config->cuda_point_count > 0 ? (FeedRenderer*)malloc(sizeof(FeedRenderer)) : NULL;
+    if (r->feed && !feed_renderer_init(r->feed, config->feed_name))
+    {
+        free(r->feed);
+        r->feed = NULL;
+    }
+#ifdef OPENGLTEST_CUDA
+    r->cuda_points = r->feed && config->cuda_point_count > 0 ? (CudaPoints*)malloc(sizeof(CudaPoints)) : NULL;
+    if (r->cuda_points && !cuda_points_init(r->cuda_points, (uint32_t)config->cuda_point_count))
+    {
+        fprintf(stderr, "Warning: --cuda-points: no CUDA points to draw\n");
+        cuda_points_destroy(r->cuda_points);
+        free(r->cuda_points);
+        r->cuda_points = NULL;
+    }
+#endif
+
+    // --serve: requests over TCP, each batch drawn into the layers of an array target and read back fenced
+    r->service = NULL;
+    r->batch = NULL;
+    if (config->serve_port > 0)
+    {
+        r->service = new RenderService;
+        if (!render_service_init(r->service, config->serve_port, 0))
+            r->failed = true;
+        r->batch = (BatchTarget*)malloc(sizeof(BatchTarget));
+        batch_target_init(r->batch);
+    }
+
+    // --map: the tile cache in a texture array of its own, filled by decode threads as the tour needs tiles
+    r->map = NULL;
+    r->map_centre[0] = 0.3;
+    r->map_centre[1] = 0.5;
+    if (config->map_megabytes > 0)
+    {
+        r->map = new TileMapRenderer;
+        if (!tile_map_renderer_init(r->map, (uint64_t)config->map_megabytes << 20, 0, RENDER_MAP_UPLOADS))
+        {
+            tile_map_renderer_destroy(r->map);
+            delete r->map;
+            r->map = NULL;
+        }
+        else
+            printf("map: %d levels of %d x %d tiles, %d cached, %d decode threads\n", TILE_MAP_RENDERER_LEVELS,
+                TILE_MAP_RENDERER_TILE_SIZE, TILE_MAP_RENDERER_TILE_SIZE, r->map->map.slot_count, r->map->thread_count);
+    }
+
+    // --series: the history on the CPU and its copy on the GPU, each only ever written where samples arrive
+    r->series_count = config->series_count;
+    r->series = NULL;
+    r->series_frames = 0;
+    if (r->series_count > 0)
+    {
+        r->series = (LineSeries*)calloc((size_t)r->series_count, sizeof(LineSeries));
+        bool ready = line_renderer_init(&r->line_renderer, r->series_count, RENDER_SERIES_CAPACITY);
+        for (int s = 0; s < r->series_count && ready; ++s)
+            ready = line_series_init(&r->series[s], RENDER_SERIES_CAPACITY);
+        if (!ready)
+        {
+            for (int s = 0; s < r->series_count; ++s)
+                line_series_destroy(&r->series[s]);
+            free(r->series);
+            line_renderer_destroy(&r->line_renderer);
+            r->series = NULL;
+            r->series_count = 0;
+        }
+    }
+
+    // Headless: draw into an offscreen target instead of the (hidden) window, and finish compiling up front so
+    // every timed frame renders the scene
+    if (r->headless)
+    {
+        if (!render_target_init(&r->offscreen, config->width, config->height, r->color_format, r->float_depth, r->samples))
+            r->failed = true;
+        render_target_bind(&r->offscreen);
+        if (r->pipelines)
+        {
+            while (program_pipelines_state(r->pipelines, r->scene_pipeline_id) < PROGRAM_STATE_READY)
+            {
+                program_pipelines_poll(r->pipelines);
+                std::this_thread::yield();
+            }
+            r->failed = r->failed || program_pipelines_state(r->pipelines, r->scene_pipeline_id) == PROGRAM_STATE_FAILED;
+        }
+        else if (!shader_manager_wait(&r->shader_manager, r->scene_program_id))
+            r->failed = true;
+        r->start_time = glfwGetTime();
+    }
+
+    // The wall's other windows: a VAO each, in its own context, with the same instance attribute setup. Only the
+    // first window waits for vsync; the rest swap right after it with interval 0, so a frame costs one vblank
+    // wait however many windows there are.
+    for (int i = 0; i < r->view_count; ++i)
+    {
+        RenderView* v = &r->views[i];
+        v->window = config->windows[i + 1];
+        v->state = gl_state;
+        v->drawn = false;
+        render_view_enter(v);
+        gl_state_reset();
+        glfwSwapInterval(0);
+        v->vertex_array = gl_dsa_create_vertex_array();
+        vertex_format_init(&v->vertex_format);     // nothing enabled in it yet
+        v->pipeline = 0;    // made once the main context's pipeline is ready
+        render_view_point_at_mesh(r, v);
+        for (int row = 0; row < 3; ++row)
+        {
+            glVertexAttribDivisor(vmodel_location + row, 1);
+            glEnableVertexAttribArray(vmodel_location + row);
+        }
+        glVertexAttribDivisor(vmaterial_location, 1);
+        if (r->materials)
+        {
+            glEnableVertexAttribArray(vmaterial_location);
+            material_set_make_resident(r->materials, true);     // bindless residency is per context
+        }
+        render_view_leave(r, v);
+    }
+}
+
+// Headless: the benchmark summary, from the wall clock and the profiler's "frame" scope
+static void renderer_report(Renderer* r, const RenderConfig* config)
+{
+    glFinish();
+    const double seconds = glfwGetTime() - r->start_time;
+    gpu_profiler_flush(&r->profiler);
+    double cpu_ms = 0.0, gpu_ms = 0.0;
+    gpu_profiler_average(&r->profiler, "frame", &cpu_ms, &gpu_ms);
+    static const char* mode_names[] = { "naive", "instanced", "gpu-driven" };
+    const char* mode_name = r->occlusion ? "gpu-driven + occlusion" : mode_names[r->draw_mode];
+    // The GPU-driven counts came back a few frames late, every frame's unless the readbacks ran out of slots: the
+    // average over those that did stands in for every frame's
+    gpu_readback_finish(&r->readback);
+    const unsigned int triangle_frames = r->meshlets ? r->meshlet_frames : r->counted_frames;
+    if (r->draw_mode == DRAW_MODE_GPU_DRIVEN && r->counted_frames)
+        r->objects_drawn = (unsigned long long)((double)r->counted_objects * r->frames_drawn / r->counted_frames);
+    if (r->draw_mode == DRAW_MODE_GPU_DRIVEN && triangle_frames)
+        r->triangles_drawn = (unsigned long long)((double)r->counted_triangles * r->frames_drawn / triangle_frames);
+    const ClusterCullingStats clusters = r->cluster_stats;
+    printf("headless: %u frames, %d objects (%s), %dx%d, %.3f s\n", r->frames_drawn, r->object_count,
+        mode_name, config->width, config->height, seconds);
+    printf("  frames/s      %10.1f\n", seconds > 0.0 ? r->frames_drawn / seconds : 0.0);
+    printf("  drawn/frame   %10.1f\n", r->frames_drawn ? (double)r->objects_drawn / r->frames_drawn : 0.0);
+    printf("  tris/frame    %10.1f (%d levels of detail)\n", r->frames_drawn ? (double)r->triangles_drawn / r->frames_drawn : 0.0,
+        r->mesh.lod_count);
+    if (r->meshlets)
+        printf("  meshlets/frame %9u (of %u per object, %u left out)\n", clusters.meshlets, r->clusters.meshlet_count,
+            clusters.dropped);
+    printf("  cpu ms/frame  %10.3f\n", cpu_ms);
+    printf("  gpu ms/frame  %10.3f\n", gpu_ms);
+    if (r->particles)
+        printf("  particles     %10u\n", r->particles_alive);    // the last frame's
+    if (r->characters)
+        printf("  characters    %10u (%u joints%s)\n", r->character_count, (unsigned)CHARACTER_JOINTS,
+            r->characters->baked_palettes ? ", baked" : "");
+    if (r->lighting)
+        printf("  lights        %10u (%s, %ux%ux%u clusters)\n", r->lighting->light_count, r->deferred ? "deferred" : "forward",
+            r->lighting->grid[0], r->lighting->grid[1], r->lighting->grid[2]);
+    if (r->oit)
+        printf("  oit           %10s (%.1f MB of %s)\n", r->oit->mode == OIT_LIST ? "list" : "weighted",
+            (r->oit->mode == OIT_LIST ? (double)(r->oit->node_bytes + r->oit->head_bytes)
+                : 10.0 * r->oit->width * r->oit->height) / 1048576.0, r->oit->mode == OIT_LIST ? "nodes and heads" : "targets");
+    if (r->shadows)
+    {
+        const ShadowCascades* sc = &r->shadows->cascades;
+        printf("  shadows       %10u cascades drawn (%d at %d px; draws / fits:", r->shadow_draws, sc->count, sc->resolution);
+        for (int i = 0; i < sc->count; ++i)
+            printf(" %u/%u", sc->cascades[i].draws, sc->cascades[i].fits);
+        printf(")\n");
+    }
+    if (r->taa)
+        printf("  taa           %10u frames (%d-phase jitter, %.0f%% of each frame new)\n", r->taa->temporal.frame,
+            TEMPORAL_JITTER_PHASES, 100.0 * TEMPORAL_AA_BLEND);
+    if (r->impostors)
+        printf("  impostors     %10.1f (per frame; %d frames of %d px, baked %u times)\n",
+            r->frames_drawn ? (double)r->impostors->drawn / r->frames_drawn : 0.0,
+            IMPOSTOR_YAW_FRAMES * IMPOSTOR_PITCH_FRAMES, r->impostors->frame_size, r->impostors->bakes);
+    if (r->terrain && r->terrain->frames)
+        printf("  terrain       %10.1f (patches per frame, %d levels%s; %u in the last frame, finest level %d)\n",
+            (double)r->terrain->patches / r->terrain->frames, r->terrain->terrain.levels,
+            r->terrain->tessellate ? ", tessellated" : "", r->terrain->last_patches, r->terrain->last_finest);
+    if (r->volume && r->volume->frames)
+        printf("  volume        %10.1f (bricks uploaded per frame; %u of %u occupied resident in %u slots, "
+            "%d^3 voxels)\n",
+            (double)r->volume->uploads / r->volume->frames, r->volume->streaming.resident, r->volume->volume.occupied,
+            r->volume->streaming.capacity, r->volume->volume.size[0]);
+    if (r->foveation)
+        printf("  vrs           %10s (%s, %s%.0f%% of full-rate shading)\n",
+            r->foveation->mode == FOVEATION_ADAPTIVE ? "adaptive" : "fixed",
+            r->foveation->rate_image ? "shading rate image" : "half-size periphery",
+            r->foveation->mode == FOVEATION_ADAPTIVE ? "at most " : "", 100.0 * r->foveation->cost);
+    if (r->eyes > 1)
+        printf("  stereo        %10u draws (the last frame's, for both eyes; %.1f object copies a frame)\n",
+            r->draw_calls, r->frames_drawn ? 2.0 * r->objects_drawn / r->frames_drawn : 0.0);
+    if (r->dynamic_resolution)
+        printf("  resolution    %10.3f (mean scale, %u changes, %.2f ms budget)\n", resolution_scaler_average(&r->scaler),
+            r->scaler.changes, r->scaler.budget_ms);
+    if (r->samples > 1)
+        printf("  msaa          %10d samples (resolved to %s)\n", r->samples, r->post ? "post" : "the target");
+    if (r->post)
+        printf("  post          %10u draws (%u for the stages, %u passes culled, %u render targets made)\n",
+            r->post->draws, r->post->merged_draws, r->post->culled, r->targets.created);
+    if (r->shape_count && !r->ui && r->shape_frames)
+        printf("  shapes        %10d primitives (%.1f draws a frame, %u vertices dropped)\n", r->shape_count,
+            (double)r->shape_draws / r->shape_frames, r->shape_renderer.dropped);
+    if (r->ui && r->ui_renderer.frames)
+    {
+        const UiRenderer* ur = &r->ui_renderer;
+        printf("  retained ui   %10d primitives (%u of %u frames redrew, %.1f KB uploaded and %.1f%% of the pixels a"
+            " frame)\n", r->shape_count, ur->redraws, ur->frames, ur->uploaded / 1024.0 / ur->frames,
+            100.0 * ur->pixels / ((double)ur->frames * ur->picture.width * ur->picture.height));
+        printf("                %10llu widgets rebuilt, %llu found unchanged, %u vertices dropped\n",
+            (unsigned long long)r->ui->built, (unsigned long long)r->ui->reused, r->ui->dropped);
+    }
+    if (r->path_count && r->shape_frames)
+        printf("  paths         %10d paths (%.1f waves and %.1f paths flattened a frame, %u vertices dropped)\n",
+            r->path_count, (double)r->path_waves / r->shape_frames, (double)r->path_flattens / r->shape_frames,
+            r->shape_renderer.dropped);
+    if (r->series_count && r->series_frames)
+        printf("  series        %10d charts (%llu samples each, %.1f KB uploaded and %.0f points drawn a frame)\n",
+            r->series_count, (unsigned long long)r->series[0].count,
+            r->line_renderer.bytes_uploaded / 1024.0 / r->series_frames, (double)r->line_renderer.points_drawn / r->series_frames);
+    if (r->points && r->points->frames)
+    {
+        PointCloudStats points;
+        point_cloud_renderer_stats(r->points, &points);
+        printf("  points        %10u in %u tiles (%u for the last view, %u of its %u tiles complete, %u drawn in the "
+            "last frame; %u views in %u frames)\n", r->points->point_count, r->points->tile_count, points.target,
+            points.complete, points.visible, points.drawn, r->points->resets, r->points->frames);
+    }
+    if (r->feed && r->feed->frames_received)
+        printf("  feed          %10llu frames received, %llu skipped, over %u connections (%.1f MB and %.2f ms "
+            "copied a frame)\n", (unsigned long long)r->feed->frames_received,
+            (unsigned long long)(r->feed->frames_skipped + r->feed->feed.skipped), r->feed->connections,
+            r->feed->bytes_copied / 1048576.0 / r->feed->frames_received, r->feed->copy_ms / r->feed->frames_received);
+#ifdef OPENGLTEST_CUDA
+    if (r->cuda_points && r->cuda_points->frames)
+    {
+        const CudaInterop* ci = &r->cuda_points->interop;
+        printf("  cuda points   %10u moved in place over %llu frames (%llu maps of %llu resources, %.3f ms a frame "
+            "mapping; %llu launches failed)\n", r->cuda_points->count, (unsigned long long)r->cuda_points->frames,
+            (unsigned long long)ci->map_calls, (unsigned long long)ci->resources_mapped,
+            ci->map_ms / r->cuda_points->frames, (unsigned long long)r->cuda_points->launch_failures);
+    }
+#endif
+    if (r->service)
+    {
+        printf("  serve         %10llu batches read back, %llu images (array target resized %llu times)\n",
+            (unsigned long long)r->batch->batches, (unsigned long long)r->batch->images,
+            (unsigned long long)r->batch->resizes);
+        render_service_print(r->service, stdout);
+    }
+    if (r->map && r->map->frames)
+    {
+        const TileMap* map = &r->map->map;
+        printf("  map           %10d tiles cached (%.0f MB; %u in the last view at level %d, %u of them from ancestors; "
+            "%llu loads, %llu evictions, %llu cancelled, %.1f MB uploaded)\n", map->slot_count,
+            map->slot_count * (double)tile_map_slot_bytes(map) / 1048576.0, map->stats.visible, map->view_level,
+            map->stats.fallback, (unsigned long long)map->total_requested, (unsigned long long)map->total_evicted,
+            (unsigned long long)r->map->tiles_cancelled, r->map->bytes_uploaded / 1048576.0);
+    }
+    printf("  overdraw      %10.2f (%s%s)\n", overdraw_average(&r->overdraw),
+        !r->depth ? "no depth test" : r->reversed_z ? "reversed Z" : "depth tested", r->depth_prepass ? ", pre-pass" : "");
+}
+
+// The performance overlay and the labels, over whatever the first window is about to show
+static void renderer_draw_hud(Renderer* r)
+{
+    if (r->hud_visible)
+    {
+        HudFrameStats stats;
+        stats.draw_calls = r->draw_calls;
+        stats.profiler = &r->profiler;
+        stats.frame_stats = &r->frame_stats;
+        hud_update(&r->hud, &stats);
+    }
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(r->window, &width, &height);
+    hud_draw(&r->hud, width, height, r->hud_visible);
+}
+
+// P and --record: the finished frame copied off to be written, as the window shows it (or the offscreen target headless)
+static void renderer_capture_screen(Renderer* r, bool screenshot)
+{
+    if (!r->screen)
+        return;
+    CPU_TRACE_SCOPE("screen capture");
+    char path[64];
+    snprintf(path, sizeof(path), "screenshot_%u.png", r->frames_drawn);
+    if (r->headless)
+        screen_capture_frame(r->screen, r->offscreen.color_framebuffer, GL_COLOR_ATTACHMENT0, r->render_width,
+            r->render_height, screenshot ? path : NULL);
+    else
+    {
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(r->window, &width, &height);
+        screen_capture_frame(r->screen, 0, GL_BACK, width, height, screenshot ? path : NULL);
+    }
+}
+
+// --wall: waits for this frame to finish on the GPU, then for every node to get that far, so the wall swaps
+// together. A follower whose leader has gone closes its window.
+static void renderer_wall_barrier(Renderer* r)
+{
+    if (!r->wall)
+        return;
+    CPU_TRACE_SCOPE("wall barrier");
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+    {
+    }
+    glDeleteSync(fence);
+    if (!wall_sync_barrier(r->wall) && !glfwWindowShouldClose(r->window))
+    {
+        fprintf(stderr, "wall: node 0 has gone\n");
+        glfwSetWindowShouldClose(r->window, GLFW_TRUE);
+        glfwPostEmptyEvent();
+    }
+}
+
+// Shows the finished frame: a swap for the window, a flush for the offscreen target. "input_time" is the
+// frame's packet's, for the latency measurement; "screenshot" its P press.
+// --on-demand: the frames the renderer needs whatever the main thread sees (loading and fading in, a mesh or a
+// program on its way, a pick being read back), and the overlay's next refresh while it's shown
+static void renderer_ask_redraw(Renderer* r)
+{
+    const double now = glfwGetTime();
+    if (r->loading_frame || loading_screen_fading(&r->loading, now) || r->streamed_mesh >= 0
+        || !shader_manager_idle(&r->shader_manager) || (r->picker && (r->picker->count || r->pick.pending)))
+    {
+        redraw_policy_request(r->redraw, REDRAW_RENDERER);
+        glfwPostEmptyEvent();
+    }
+    if (r->hud_visible)
+        redraw_policy_schedule(r->redraw, now + REDRAW_OVERLAY_SECONDS);
+    if (r->ui && r->ui_next > 0.0)
+        redraw_policy_schedule(r->redraw, r->ui_next);
+}
+
+// The frame boundary: its time into the stats and, if that made it a stutter, what it went on into the log
+// --metrics: the frame figures and queue depths as of "now", with the memory renderer_update_memory last sampled
+static void renderer_publish_metrics(Renderer* r, double now)
+{
+    FrameStatsSummary window;
+    frame_stats_window(&r->frame_stats, &window);
+    MetricsSample* m = &r->metrics;
+    m->uptime = r->frame_stats.frames ? now - r->frame_stats.start : 0.0;
+    m->frames = r->frame_stats.frames;
+    m->hitches = r->frame_stats.stutters;
+    m->frame_seconds_sum = r->frame_stats.total.sum_ms * 1e-3;
+    m->frame_p50_ms = window.frames ? window.p50_ms : -1.0;
+    m->frame_p95_ms = window.frames ? window.p95_ms : -1.0;
+    m->frame_p99_ms = window.frames ? window.p99_ms : -1.0;
+    m->frame_max_ms = window.frames ? window.max_ms : -1.0;
+    unsigned int frame = 0;
+    double gpu_ms = 0.0;
+    m->gpu_frame_ms = gpu_profiler_latest(&r->profiler, "frame", &frame, &gpu_ms) ? gpu_ms : -1.0;
+    m->mesh_queue = r->streamer ? asset_streamer_queued(r->streamer) : -1;
+    m->texture_queue = r->textures ? (int64_t)r->textures->staged_left : -1;
+    metrics_publish(m);
+    r->metrics_published = now;
+}
+
+static void renderer_frame_done(Renderer* r)
+{
+    const double previous = r->frame_stats.last, now = frame_pacer_now();
+    const bool stutter = frame_stats_frame(&r->frame_stats, now);
+    hitch_detector_end_frame(&r->hitches, glfwGetTime(), stutter, r->frame_stats.median_ms);   // the profiler's clock
+    if (telemetry_active() && previous > 0.0)
+    {
+        const double frame_ms = (now - previous) * 1e3;
+        telemetry_frame(r->frames_drawn, frame_ms, r->frame_stats.median_ms);
+        const float hitch[4] = { (float)frame_ms, (float)r->frame_stats.median_ms, 0.f, 0.f };
+        if (stutter)
+            telemetry_record(TELEMETRY_HITCH, r->frames_drawn, hitch, NULL);
+    }
+    if (metrics_active() && now - r->metrics_published >= METRICS_PUBLISH_SECONDS)
+        renderer_publish_metrics(r, now);
+    // The first frame with the scene in it ends startup (the frames before only clear while the programs compile)
+    if (r->frames_drawn && startup_profile_active() && startup_profile_first_frame() >= 0.0)
+    {
+        if (r->startup_report)
+            startup_profile_print(stdout);
+        startup_profile_trace();
+    }
+    if (r->redraw)
+        renderer_ask_redraw(r);
+}
+
+// Swaps the window. An --on-demand frame drawn only to refresh the overlay or the retained dashboard presents just
+// the overlay's rectangle and the widgets redrawn as damage, where the context has EGL's swap with damage: the rest
+// is as the last frame left it.
+static void renderer_swap(Renderer* r)
+{
+    const float* panel = r->hud.panel;
+    int rects[1 + UI_LAYER_MAX_DIRTY][4];
+    int count = 0;
+    bool partial = r->damage_swaps && r->redraw_reasons == REDRAW_TIMER && !r->label_count
+        && (!r->hud_visible || panel[2] > 0.f);
+    if (partial && r->hud_visible)
+    {
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(r->window, &width, &height);
+        const int top = (int)ceilf(panel[1] + panel[3]);
+        const int rect[4] = { (int)panel[0], height - top, (int)ceilf(panel[0] + panel[2]) - (int)panel[0],
+            top - (int)panel[1] };
+        memcpy(rects[count++], rect, sizeof(rect));
+    }
+    if (partial && r->ui)
+        for (int i = 0; i < r->ui_renderer.damage_count; ++i)
+            memcpy(rects[count++], r->ui_renderer.damage[i], sizeof(rects[0]));
+    if (partial && count)
+        swap_damage_swap(&r->damage, rects[0], count);
+    else
+        glfwSwapBuffers(r->window);    // Swaps front and back buffers
+}
+
+// How far loading has got: the programs built (or failed), the scene pipeline and the streamed mesh, as one fraction
+static float renderer_loading_progress(const Renderer* r)
+{
+    int done = 0, total = r->shader_manager.count;
+    for (int id = 0; id < r->shader_manager.count; ++id)
+        done += shader_manager_state(&r->shader_manager, id) >= PROGRAM_STATE_READY;
+    if (r->pipelines)
+    {
+        ++total;
+        done += program_pipelines_state(r->pipelines, r->scene_pipeline_id) >= PROGRAM_STATE_READY;
+    }
+    if (r->streamer)
+    {
+        ++total;
+        done += r->streamed_mesh < 0;
+    }
+    return total ? (float)done / (float)total : 1.f;
+}
+
+// The loading screen's progress bar over a frame that waited, or the fade over the scene's first frames. Under the
+// HUD, which stays readable throughout.
+static void renderer_draw_loading(Renderer* r)
+{
+    const double now = glfwGetTime();
+    if (!r->loading_frame && !loading_screen_fading(&r->loading, now))
+        return;
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(r->window, &width, &height);
+    if (r->loading_frame)
+        loading_screen_draw(&r->loading, width, height, renderer_loading_progress(r));
+    else
+        loading_screen_fade(&r->loading, &r->shader_manager, width, height, now);
+}
+
+// --on-demand: what "packet" is drawn for; after a wait its frame is timed from here, not from the last one
+static void renderer_redraw_packet(Renderer* r, const FramePacket* packet)
+{
+    r->redraw_reasons = packet->redraw;
+    if (packet->resumed)
+        frame_stats_resume(&r->frame_stats, frame_pacer_now());
+}
+
+static void renderer_present(Renderer* r, double input_time, bool screenshot)
+{
+    CPU_TRACE_SCOPE("swap");
+    gl_resources_end_frame(&r->resources);     // the frame's commands are all in: fence what it retired
+    gl_debug_check("frame");
+    if (r->headless)
+    {
+        renderer_capture_screen(r, screenshot);
+        glFlush();
+        renderer_wall_barrier(r);
+        // A stream goes out in real time, at --fps-limit: nothing else paces a headless run
+        if (r->screen && r->screen->recorder.format == SCREEN_RECORDER_STREAM)
+            frame_pacer_wait(r->pacer);
+        frame_pacer_frame_done(r->pacer);
+        frame_pacer_input_presented(r->pacer, input_time);
+        renderer_frame_done(r);
+        return;
+    }
+#ifdef OPENGLTEST_OPENXR
+    if (r->xr)
+    {
+        // The runtime's swapchain in place of the window's: the frame's colour and depth copied to it, and
+        // xrEndFrame presenting them (an undrawn frame is ended empty). xrWaitFrame has paced the loop already
+        r->cpu_ms = 1000.0 * (frame_pacer_now() - r->cpu_start);
+        openxr_presenter_end_frame(r->xr, r->xr_drawn ? r->offscreen.color_framebuffer : 0,
+            r->samples == 1 ? r->offscreen.framebuffer : 0, r->render_width, r->render_height, r->xr_depth[0],
+            r->xr_depth[1]);
+        r->xr_drawn = false;
+        frame_pacer_frame_done(r->pacer);
+        frame_pacer_input_presented(r->pacer, input_time);
+        renderer_frame_done(r);
+        return;
+    }
+#endif
+    if (r->offscreen_frames && r->offscreen.framebuffer)
+        render_target_discard_depth(&r->offscreen);     // the frame's passes have all read it
+    if (r->offscreen_frames && r->offscreen.framebuffer && !r->post_presented)
+        r->upscale(r->upscale_user, &r->offscreen, r->render_width, r->render_height, 0, r->offscreen.width,
+            r->offscreen.height);
+    r->post_presented = false;
+    if (r->loading_screen)
+        renderer_draw_loading(r);
+    if (r->hud_visible || r->label_count)
+        renderer_draw_hud(r);
+    renderer_capture_screen(r, screenshot);
+    r->cpu_ms = 1000.0 * (frame_pacer_now() - r->cpu_start);     // the frame's work, before the waits
+    int interval = 0;
+    if (frame_pacer_swap_interval(r->pacer, &interval))
+        glfwSwapInterval(interval);
+    const bool low_latency = frame_pacer_low_latency(r->pacer);
+    if (!low_latency || !r->late_limiter)
+        frame_pacer_wait(r->pacer);     // the frame-rate limit, when there is one
+    renderer_wall_barrier(r);
+    if (gl_ext.ARB_invalidate_subdata)
+    {
+        // Nothing reads the window's depth and stencil after the swap: a tiled GPU needn't store them
+        const GLenum attachments[2] = { GL_DEPTH, GL_STENCIL };
+        gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        gl_ext.InvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, 2, attachments);
+    }
+    hitch_detector_push(&r->hitches, "swap", glfwGetTime());
+    renderer_swap(r);
+    hitch_detector_pop(&r->hitches, glfwGetTime());
+    if (low_latency)
+    {
+        // Wait for the GPU to finish the frame, swap included, so the driver never has a second one queued:
+        // the next frame's input is sampled once this one is out, not a refresh or two ahead of it
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+        {
+        }
+        glDeleteSync(fence);
+    }
+    for (int i = 0; i < r->view_count; ++i)
+    {
+        // The rest of the wall, just after the first window's vblank (EGL swaps only the current context's surface)
+        RenderView* v = &r->views[i];
+        if (!v->drawn)
+            continue;
+        render_view_enter(v);
+        glfwSwapBuffers(v->window);
+        render_view_leave(r, v);
+        v->drawn = false;
+    }
+    frame_pacer_frame_done(r->pacer);
+    frame_pacer_input_presented(r->pacer, input_time);
+    renderer_frame_done(r);
+}
+
+static void renderer_destroy(Renderer* r)
+{
+    gpu_profiler_flush(&r->profiler);
+    if (r->profiling)
+    {
+        gpu_profiler_print(&r->profiler, stdout);
+        gl_state_print(stdout);     // how many binds and state changes the cache kept from the driver
+        frame_pacer_print(r->pacer, stdout);
+        frame_stats_print(&r->frame_stats, stdout);
+        if (r->readback.requested)
+            gpu_readback_print(&r->readback, stdout);
+        if (r->terrain && r->terrain->texture)
+            virtual_texture_print(r->terrain->texture, stdout);
+        if (r->shader_manager.watcher.count)
+            printf("shader reloads: %u, %u failed to build\n", r->shader_manager.reloads,
+                r->shader_manager.reload_failures);
+#ifdef OPENGLTEST_OPENXR
+        if (r->xr)
+            openxr_presenter_report(r->xr, stdout);
+#endif
+    }
+#ifdef OPENGLTEST_OPENXR
+    if (r->xr)
+    {
+        openxr_presenter_destroy(r->xr);
+        free(r->xr);
+        r->xr = NULL;
+    }
+#endif
+    gpu_profiler_destroy(&r->profiler);
+    gpu_counters_destroy(&r->gpu_counters);
+    gpu_readback_destroy(&r->readback);
+    if (r->frame_stats_csv)
+        frame_stats_write_csv(&r->frame_stats, r->frame_stats_csv);
+    if (r->capture.file)
+        frame_capture_close(&r->capture);
+    frame_stats_destroy(&r->frame_stats);
+    if (r->hud_ready)
+        hud_destroy(&r->hud);
+    if (r->loading_screen)
+        loading_screen_destroy(&r->loading);
+    if (r->shapes)
+    {
+        shape_renderer_destroy(&r->shape_renderer);
+        shape_batch_destroy(r->shapes);
+        free(r->shapes);
+    }
+    if (r->ui)
+    {
+        ui_renderer_destroy(&r->ui_renderer);
+        ui_layer_destroy(r->ui);
+        free(r->ui);
+    }
+    if (r->gauge_paths)
+    {
+        for (int i = 0; i < 3 + gauge_count(r->path_count); ++i)
+            vector_path_destroy(&r->gauge_paths[i]);
+        free(r->gauge_paths);
+    }
+    if (r->points)
+    {
+        point_cloud_renderer_destroy(r->points);
+        free(r->points);
+    }
+#ifdef OPENGLTEST_CUDA
+    if (r->cuda_points)
+    {
+        cuda_points_destroy(r->cuda_points);
+        free(r->cuda_points);
+    }
+#endif
+    if (r->service)
+    {
+        render_service_destroy(r->service);
+        delete r->service;
+    }
+    if (r->batch)
+    {
+        batch_target_destroy(r->batch);
+        free(r->batch);
+    }
+    if (r->feed)
+    {
+        feed_renderer_destroy(r->feed);
+        free(r->feed);
+    }
+    if (r->series)
+    {
+        for (int s = 0; s < r->series_count; ++s)
+            line_series_destroy(&r->series[s]);
+        free(r->series);
+        line_renderer_destroy(&r->line_renderer);
+    }
+    if (r->map)
+    {
+        tile_map_renderer_destroy(r->map);
+        delete r->map;
+    }
+    if (r->headless || r->offscreen_frames)
+        render_target_destroy(&r->offscreen);
+    if (r->wall)
+    {
+        if (r->swap_group)
+            swap_group_leave(1);
+        printf("wall: %u frames, %.3f ms average at the barrier, %.3f ms longest\n", r->wall->barriers,
+            r->wall->barriers ? 1000.0 * r->wall->barrier_seconds / r->wall->barriers : 0.0,
+            1000.0 * r->wall->barrier_max);
+    }
+    if (r->screen)
+    {
+        screen_capture_destroy(r->screen);     // writes what's still in flight first
+        if (r->screen->recorder.recording || r->screen->recorder.screenshots)
+            screen_capture_print(r->screen, stdout);
+        delete r->screen;
+    }
+    if (r->picker)
+    {
+        printf("gpu pick: %u readbacks\n", r->picker->reads);
+        gpu_picker_destroy(r->picker);
+        free(r->picker);
+    }
+    if (r->post)
+    {
+        post_process_destroy(r->post);
+        free(r->post);
+    }
+    render_target_pool_destroy(&r->targets);
+    if (r->measure_overdraw)
+    {
+        if (!r->headless)
+            printf("overdraw: %.2f fragments shaded per pixel\n", overdraw_average(&r->overdraw));
+        overdraw_destroy(&r->overdraw);
+    }
+    if (r->occlusion)
+        hiz_destroy(&r->hiz);
+    if (r->profiling)
+        gpu_memory_print(&gl_memory, stdout);
+    if (r->mesh_resident >= 0)
+        gpu_memory_remove_resident(&gl_memory, r->mesh_resident);
+    free(r->mesh_indices);
+    if (r->textures)
+    {
+        if (r->profiling)
+            texture_streamer_print(r->textures, stdout);
+        texture_streamer_destroy(r->textures);
+        free(r->textures);
+    }
+    if (r->materials)
+    {
+        if (r->profiling)
+            material_set_print(r->materials, stdout);
+        for (int i = 0; i < r->view_count; ++i)
+        {
+            render_view_enter(&r->views[i]);
+            material_set_make_resident(r->materials, false);
+            render_view_leave(r, &r->views[i]);
+        }
+        material_set_destroy(r->materials);
+        free(r->materials);
+    }
+    if (r->profiling)
+        pipeline_states_print(&r->states, stdout);
+    hitch_detector_print(&r->hitches, stdout);
+    gl_state.hitches = NULL;
+    if (r->profiler.draws)
+    {
+        draw_sampler_flush(&r->draw_sampler);
+        draw_sampler_print(&r->draw_sampler, stdout);
+        r->profiler.draws = NULL;
+    }
+    draw_sampler_destroy(&r->draw_sampler);
+    if (r->pipelines)
+    {
+        if (r->profiling)
+            program_pipelines_print(r->pipelines, stdout);
+        program_pipelines_destroy(r->pipelines);
+        free(r->pipelines);
+    }
+    shader_manager_destroy(&r->shader_manager);
+    shader_permutation_destroy(&r->scene_shaders);     // the manager and the pipelines borrowed its sources
+    free(r->draw_offsets);
+    stream_buffer_destroy(&r->uniform_stream);
+    stream_buffer_destroy(&r->instance_stream);
+    if (r->draw_mode == DRAW_MODE_GPU_DRIVEN || r->cull_selector)
+        gpu_culling_destroy(&r->gpu_culling);
+    if (r->animate)
+        gpu_animation_destroy(&r->animation);
+    if (r->pull)
+        vertex_pull_destroy(&r->pulled);
+    if (r->meshlets)
+        cluster_culling_destroy(&r->clusters);
+    if (r->particles)
+    {
+        particles_destroy(r->particles);
+        free(r->particles);
+    }
+    if (r->characters)
+    {
+        skinned_batch_destroy(r->characters);
+        free(r->characters);
+    }
+    if (r->lighting)
+    {
+        lighting_destroy(r->lighting);
+        free(r->lighting);
+    }
+    if (r->oit)
+    {
+        oit_destroy(r->oit);
+        free(r->oit);
+    }
+    if (r->shadows)
+    {
+        shadow_maps_destroy(r->shadows);
+        free(r->shadows);
+    }
+    if (r->taa)
+    {
+        temporal_aa_destroy(r->taa);
+        free(r->taa);
+    }
+    if (r->impostors)
+    {
+        impostor_renderer_destroy(r->impostors);
+        free(r->impostors);
+    }
+    if (r->terrain)
+    {
+        terrain_renderer_destroy(r->terrain);
+        free(r->terrain);
+    }
+    if (r->volume)
+    {
+        volume_renderer_destroy(r->volume);
+        free(r->volume);
+    }
+    if (r->foveation)
+    {
+        foveation_destroy(r->foveation);
+        free(r->foveation);
+    }
+    gl_resources_release(&r->resources, r->camera_buffer_handle);
+    gl_resources_release(&r->resources, r->vertex_array_handle);
+    renderer_release_mesh(r);
+    if (r->profiling)
+        gl_resources_print(&r->resources, stdout);
+    gl_resources_destroy(&r->resources, stderr);
+    for (int i = 0; i < r->view_count; ++i)
+    {
+        render_view_enter(&r->views[i]);
+        gl_state_delete_vertex_arrays(1, &r->views[i].vertex_array);
+        if (r->views[i].pipeline)
+            gl_state_delete_program_pipelines(1, &r->views[i].pipeline);
+        render_view_leave(r, &r->views[i]);
+    }
+
+    // Everything the renderer made is gone by now: what video memory is still accounted for was leaked
+    gl_memory_audit(stderr);
+}
+
+// Swaps the streamed mesh in for the placeholder once its upload has been waited on. The instance
+// attributes stay as they are; only the per-vertex ones are re-pointed at the new vertex buffer.
+static void renderer_poll_streaming(Renderer* r)
+{
+    asset_streamer_begin_frame(r->streamer);
+    if (r->streamed_mesh < 0)
+        return;
+    const AssetState state = asset_streamer_state(r->streamer, r->streamed_mesh);
+    GpuMesh mesh;
+    VertexFormat format;
+    if (state == ASSET_STATE_FAILED)
+        r->streamed_mesh = -1;      // keep drawing the placeholder
+    else if (asset_streamer_take_mesh(r->streamer, r->streamed_mesh, &mesh, &format))
+    {
+        renderer_release_mesh(r);   // the placeholder may still be in flight: deleted once its frames are done
+        r->mesh = mesh;
+        if (r->meshlets)
+        {
+            cluster_culling_destroy(&r->clusters);  // split from the placeholder: the streamed mesh draws whole
+            r->meshlets = false;
+        }
+        renderer_adopt_mesh(r);
+        gl_state_bind_vertex_array(r->vertex_array);
+        gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, r->mesh.index_buffer);     // element buffer binding is VAO state
+        renderer_attach_vertices(r, &format, &r->vertex_format);   // the views re-point theirs before they next draw
+        r->streamed_mesh = -1;
+    }
+}
+
+// Points a newly built scene program's uniform blocks and samplers at their bindings. "vertex" and "fragment"
+// are the same program, or the two stages of the scene pipeline.
+static void renderer_bind_scene_program(Renderer* r, GLuint vertex, GLuint fragment)
+{
+    gl_debug_label(GL_PROGRAM, vertex, vertex == fragment ? "scene program" : "scene vertex stage");
+    if (fragment != vertex)
+        gl_debug_label(GL_PROGRAM, fragment, "scene fragment stage");
+    uniforms_bind_blocks(vertex);   // Frame/Draw uniform blocks -> fixed binding points, filled from the uniform stream each frame
+    if (r->textures)
+    {
+        gl_state_use_program(fragment);
+        glUniform1i(glGetUniformLocation(fragment, "albedo"), 0);
+    }
+    if (r->materials)
+        material_set_bind_program(r->materials, fragment);
+}
+
+// The scene program, or the scene pipeline with no program in use to override it
+static void use_scene_program(GLuint program, GLuint pipeline)
+{
+    gl_state_use_program(pipeline ? 0 : program);
+    if (pipeline)
+        gl_state_bind_program_pipeline(pipeline);
+}
+
+// The scene passes' pipeline states for the programs as they are now, made again whenever one changes; drawn with
+// once, out of sight, before the next scene pass (renderer_warm_up)
+static void renderer_make_states(Renderer* r)
+{
+    pipeline_states_clear(&r->states);
+    for (int target = 0; target < 2; ++target)
+    {
+        ScenePassStates* pass = &r->pass_states[target];
+        *pass = { -1, -1, -1 };
+        if (target == 1 && !r->deferred)
+            break;
+        PipelineStateDesc desc;
+        memset(&desc, 0, sizeof(desc));
+        desc.program = r->pipeline ? 0 : r->program;
+        desc.program_pipeline = r->pipeline;
+        desc.vertex_array = r->vertex_array;
+        desc.depth_test = r->depth || target == 1;
+        desc.depth_func = target == 1 ? GL_ALWAYS : r->depth_func;     // the G-buffer keeps the last draw's
+        desc.depth_write = true;
+        desc.colour_write = true;
+        desc.blend = r->overdraw_view;
+        desc.blend_src = desc.blend_dst = GL_ONE;
+        if (r->oit)
+        {
+            // Translucent: tested against what's behind, never hiding each other. The weighted targets add up;
+            // the lists take the fragments through shader storage alone.
+            desc.depth_write = false;
+            desc.colour_write = r->oit->mode != OIT_LIST;
+            desc.blend = r->oit->mode != OIT_LIST;
+        }
+        pass->scene = pipeline_states_create(&r->states, target ? "scene (G-buffer)" : "scene", &desc);
+        if (!r->prepass_program || !r->depth_prepass)
+            continue;
+        PipelineStateDesc prepass = desc;
+        prepass.program = r->prepass_program;
+        prepass.program_pipeline = 0;
+        prepass.colour_write = false;
+        prepass.blend = false;
+        pass->prepass = pipeline_states_create(&r->states, target ? "pre-pass (G-buffer)" : "pre-pass", &prepass);
+        desc.depth_func = GL_EQUAL;
+        desc.depth_write = false;
+        pass->shade = pipeline_states_create(&r->states, target ? "shade (G-buffer)" : "shade", &desc);
+    }
+
+    // --shadows: the casters' depth into a cascade's map, nearest kept (the maps' depth isn't reversed)
+    r->shadow_state = -1;
+    if (r->shadows && r->prepass_program)
+    {
+        PipelineStateDesc shadow;
+        memset(&shadow, 0, sizeof(shadow));
+        shadow.program = r->prepass_program;
+        shadow.vertex_array = r->vertex_array;
+        shadow.depth_test = true;
+        shadow.depth_func = GL_LESS;
+        shadow.depth_write = true;
+        r->shadow_state = pipeline_states_create(&r->states, "shadow casters", &shadow);
+    }
+}
+
+static void renderer_warm_up_draw(void* user)
+{
+    Renderer* r = (Renderer*)user;
+    gpu_mesh_draw_lod(&r->mesh, 0);
+}
+
+// New pipeline states drawn with once into the frame's target, under an empty scissor, so whatever the driver
+// compiles for them happens here and not at the pass's first real draw. The uniform blocks must be bound.
+static void renderer_warm_up(Renderer* r)
+{
+    if (!pipeline_states_cold(&r->states))
+        return;
+    CPU_TRACE_SCOPE("warm up");
+    gpu_profiler_push(&r->profiler, "warm up");
+    pipeline_states_warm_up(&r->states, renderer_warm_up_draw, r);
+    gpu_profiler_pop(&r->profiler);
+    pipeline_state_bind(&r->states, r->pass->scene);
+}
+
+// The live settings as of the packet about to be drawn (--console): what changed since the last one is applied
+// before the frame begins
+static void renderer_apply_settings(Renderer* r, const FrameSettings* s)
+{
+    r->cull = s->cull;
+    if (s->render_scale != r->settings.render_scale && !r->offscreen_frames)
+        fprintf(stderr, "Warning: render-scale needs the scene drawn offscreen; start with --render-scale below 1\n");
+    if (s->upload_budget_kb != r->settings.upload_budget_kb && r->streamer)
+        asset_streamer_set_budget(r->streamer, (size_t)s->upload_budget_kb * 1024);
+    if (s->vram_budget_mb != r->settings.vram_budget_mb)
+        gpu_memory_set_budget(&gl_memory, (uint64_t)s->vram_budget_mb << 20);
+    r->settings = *s;
+}
+
+// Shows or hides the overlay from this frame on, before the profiler's frame begins: it times the passes while
+// the overlay is up even if nothing else asked for timings
+static void renderer_show_hud(Renderer* r, bool visible)
+{
+    if (visible && r->hud_pending)
+    {
+        r->hud_pending = false;
+        r->hud_ready = hud_init(&r->hud, "shader_cache");
+    }
+    visible = visible && r->hud_ready;
+    if (visible == r->hud_visible)
+        return;
+    r->hud_visible = visible;
+    if (!r->profiling)
+        gpu_profiler_set_enabled(&r->profiler, visible);
+}
+
+// Takes up the scene's programs once they're ready, or rebuilt, with their pipeline states. False while the scene
+// can't draw yet ("failed" set when it never will).
+static bool renderer_update_programs(Renderer* r)
+{
+    shader_manager_poll(&r->shader_manager);
+    if (r->pipelines)
+    {
+        program_pipelines_poll(r->pipelines);
+        if (!r->pipeline)
+        {
+            if (program_pipelines_state(r->pipelines, r->scene_pipeline_id) == PROGRAM_STATE_FAILED)
+            {
+                r->failed = true;
+                return false;
+            }
+            r->pipeline = program_pipelines_get(r->pipelines, r->scene_pipeline_id);
+            if (!r->pipeline)
+                return false;
+            renderer_bind_scene_program(r, program_pipelines_stage_program(r->pipelines, r->scene_pipeline_id, 0),
+                program_pipelines_stage_program(r->pipelines, r->scene_pipeline_id, 1));
+            renderer_make_states(r);
+        }
+    }
+    else
+    {
+        if (!r->program && shader_manager_state(&r->shader_manager, r->scene_program_id) == PROGRAM_STATE_FAILED)
+        {
+            r->failed = true;
+            return false;
+        }
+        const GLuint program = shader_manager_program(&r->shader_manager, r->scene_program_id);
+        if (!program)
+            return false;
+        if (program != r->program)
+        {
+            r->program = program;
+            renderer_bind_scene_program(r, program, program);
+            renderer_make_states(r);
+        }
+    }
+
+    // --depth-prepass and --shadows: their states are made once the program is ready (or rebuilt); until then the
+    // scene draws in one pass, without shadows
+    const GLuint prepass = r->depth_prepass || r->shadows ? shader_manager_program(&r->shader_manager, r->prepass_program_id) : 0;
+    if (prepass && prepass != r->prepass_program)
+    {
+        r->prepass_program = prepass;
+        gl_debug_label(GL_PROGRAM, prepass, "depth pre-pass program");
+        uniforms_bind_blocks(prepass);
+        renderer_make_states(r);
+    }
+    return true;
+}
+
+// --prewarm: loading waits for every program the shader manager has, takes up the scene's, and draws with each
+// program and each pipeline state once into a 1 x 1 target of the scene's formats. Nothing a driver compiles
+// lazily is left for a frame to hit; what --hitches reports after this is something else.
+static void renderer_prewarm(Renderer* r)
+{
+    STARTUP_SCOPE("prewarm");
+    const double start = glfwGetTime();
+    for (int id = 0; id < r->shader_manager.count; ++id)
+        shader_manager_wait(&r->shader_manager, id);
+    while (r->pipelines && program_pipelines_state(r->pipelines, r->scene_pipeline_id) < PROGRAM_STATE_READY)
+    {
+        program_pipelines_poll(r->pipelines);
+        std::this_thread::yield();
+    }
+    if (!renderer_update_programs(r))
+        return;
+    RenderTarget target;
+    if (!render_target_init(&target, 1, 1, r->color_format, r->float_depth, r->samples))
+        return;
+    render_target_bind(&target);
+    gl_state_viewport(0, 0, 1, 1);
+    uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_FRAME, 0, sizeof(FrameUniforms));   // read, never shown
+    uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_DRAW, 0, sizeof(DrawUniforms));
+    gl_state_bind_vertex_array(r->vertex_array);
+    const int programs = shader_manager_warm_up(&r->shader_manager, renderer_warm_up_draw, r);
+    const int states = pipeline_states_warm_up(&r->states, renderer_warm_up_draw, r);
+    glFinish();     // whatever the driver compiles, it's done before the first frame
+    render_target_destroy(&target);
+    if (r->headless)
+        render_target_bind(&r->offscreen);
+    else
+        gl_state_bind_framebuffer(GL_FRAMEBUFFER, 0);
+    printf("prewarm: %d programs and %d pipeline states drawn with in %.1f ms\n", programs, states,
+        (glfwGetTime() - start) * 1000.0);
+}
+
+// Clears the frame and, once the scene program is ready, opens this frame's instance stream region.
+// Returns false while the program is still compiling (present the cleared frame) or after it failed
+// (r->failed). On success *models is where the frame's model matrices go: straight into the mapped
+// instance buffer when instancing, NULL for the naive path (renderer_draw reads them from the packet)
+// and the GPU-driven one (nothing to write: the compute shader makes them). *materials is the same for
+// the material indices, and NULL without materials; *objects for the object indices, NULL without --gpu-pick.
+// --governor: the latest GPU and CPU frame times to the quality governor, and a new tier's settings applied. The
+// resolution's is read as each frame is sized.
+static void renderer_govern(Renderer* r)
+{
+    unsigned int frame = 0;
+    double gpu_ms = 0.0;
+    if (!gpu_profiler_latest(&r->profiler, "frame", &frame, &gpu_ms) || frame == r->governor_frame)
+        gpu_ms = 0.0;   // nothing new
+    r->governor_frame = frame;
+    if (!quality_governor_frame(r->governor, glfwGetTime(), gpu_ms, r->cpu_ms))
+        return;
+    const QualityTier* tier = quality_governor_tier(r->governor);
+    if (r->shadows)
+    {
+        shadow_maps_set_count(r->shadows, r->governed_cascades - tier->cascades_dropped);
+        r->shadow_camera_version = 0;   // refitted to the new splits
+    }
+    if (r->particles)
+        r->particles->emitter.rate = r->governed_particle_rate * tier->particle_rate;
+}
+
+// --cull-select: the GPU cull's time, once a frame that ran it is read back, to the selector
+static void renderer_select_cull(Renderer* r)
+{
+    unsigned int frame = 0;
+    double gpu_ms = 0.0;
+    if (gpu_profiler_latest(&r->profiler, "gpu cull", &frame, &gpu_ms) && frame != r->cull_frame)
+        cull_selector_cost(r->cull_selector, CULL_PATH_GPU, gpu_ms);
+    r->cull_frame = frame;
+}
+
+static bool renderer_begin_frame(Renderer* r, int width, int height, mat3x4** models, uint32_t** materials,
+    uint32_t** objects)
+{
+    r->loading_frame = false;
+    r->cpu_start = frame_pacer_now();
+    if (r->governor)
+        renderer_govern(r);
+    if (r->cull_selector)
+        renderer_select_cull(r);
+    if (r->streamer)
+        renderer_poll_streaming(r);
+
+    // The offscreen target follows the window's framebuffer size; the scene may only cover a corner of it
+    if (r->offscreen_frames && !r->headless)
+    {
+        if (r->offscreen.width != width || r->offscreen.height != height)
+        {
+            render_target_destroy(&r->offscreen);
+            if (width < 1 || height < 1 || !render_target_init(&r->offscreen, width, height, r->color_format, r->float_depth,
+                r->samples))
+                return false;
+            if (r->picker)
+                gpu_picker_attach(r->picker, &r->offscreen);    // picks are lost on failure; the frames still draw
+        }
+        render_target_bind(&r->offscreen);     // presenting left the window bound
+    }
+
+    // --dynamic-res: the latest GPU frame time picks this frame's scale
+    r->render_width = width;
+    r->render_height = height;
+    if (r->dynamic_resolution)
+    {
+        unsigned int frame = 0;
+        double gpu_ms = 0.0;
+        if (gpu_profiler_latest(&r->profiler, "frame", &frame, &gpu_ms) && frame != r->scaler_frame)
+        {
+            r->scaler_frame = frame;
+            resolution_scaler_update(&r->scaler, gpu_ms);
+        }
+        resolution_scaler_size(&r->scaler, width, height, &r->render_width, &r->render_height);
+    }
+    if (r->governed_resolution)
+    {
+        const float scale = quality_governor_tier(r->governor)->resolution_scale;
+        r->render_width = r->render_width * scale > 1.f ? (int)(r->render_width * scale) : 1;
+        r->render_height = r->render_height * scale > 1.f ? (int)(r->render_height * scale) : 1;
+    }
+    if (r->offscreen_frames && r->settings.render_scale < 1.f)
+    {
+        const float scale = r->settings.render_scale;
+        r->render_width = r->render_width * scale > 1.f ? (int)(r->render_width * scale) : 1;
+        r->render_height = r->render_height * scale > 1.f ? (int)(r->render_height * scale) : 1;
+    }
+
+    // Defines the area of the window (0,0 = bottom of viewport): for a wall, this window's tile of the camera
+    gl_state_viewport(0, 0, r->render_width / (1 + r->view_count), r->render_height);
+
+    // Clears the color buffer (and the depth the tests read) and resets to predefined color
+    glClear(r->depth ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT);
+
+    // Until the scene program has compiled, present cleared frames so the window stays responsive. A window shows
+    // the loading screen's progress on them, and holds a little longer for the streamed mesh rather than draw the
+    // placeholder and swap it. With --shader-dir the program can also change here, once a rebuild from edited files is ready.
+    if (!renderer_update_programs(r) || (r->loading_screen && r->loading.ready_time < 0.0 && r->streamed_mesh >= 0
+        && glfwGetTime() < r->asset_deadline))
+    {
+        r->loading_frame = r->loading_screen && !r->failed;
+        return false;
+    }
+    if (r->loading_screen)
+        loading_screen_ready(&r->loading, glfwGetTime());
+
+    *models = NULL;
+    *materials = NULL;
+    *objects = NULL;
+    if (r->draw_mode == DRAW_MODE_INSTANCED && !r->animate)
+    {
+        stream_buffer_begin_frame(&r->instance_stream);
+        *models = (mat3x4*)stream_buffer_alloc(&r->instance_stream, sizeof(mat3x4) * r->object_count, 64, &r->instance_offset);
+        gl_state_bind_buffer(GL_ARRAY_BUFFER, r->instance_stream.buffer);
+        gl_state_bind_vertex_array(r->vertex_array);
+        set_instance_attribs(vmodel_location, r->instance_offset);  // the region moves every frame
+        if (r->materials)
+        {
+            *materials = (uint32_t*)stream_buffer_alloc(&r->instance_stream, sizeof(uint32_t) * r->object_count, 16,
+                &r->material_offset);
+            glVertexAttribIPointer(vmaterial_location, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)r->material_offset);
+        }
+        if (r->picker)
+        {
+            *objects = (uint32_t*)stream_buffer_alloc(&r->instance_stream, sizeof(uint32_t) * r->object_count, 16,
+                &r->object_offset);
+            glVertexAttribIPointer(vobject_location, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)r->object_offset);
+        }
+    }
+    return true;
+}
+
+// Instanced: the buffer the instance attributes read, the stream the CPU writes into or --gpu-animate's
+static GLuint renderer_instance_buffer(const Renderer* r)
+{
+    return r->animate ? r->animation.instance_buffer : r->instance_stream.buffer;
+}
+
+// The instanced draws of the visible objects, one per level of detail they use, each with the instance attributes
+// pointed at its level's group of matrices (and materials, and object indices); --stereo's draw each object once
+// per eye. The array buffer must be renderer_instance_buffer's. Adds to "triangles" unless it's NULL, and returns
+// the draws made.
+static unsigned int renderer_draw_lod_groups(Renderer* r, const FramePacket* packet, unsigned long long* triangles)
+{
+    unsigned int draws = 0;
+    GLintptr first = 0;
+    for (int l = 0; l < LOD_MAX_LEVELS && first < packet->visible_count; ++l)
+    {
+        const uint32_t n = packet->lod_counts[l];
+        if (n == 0)
+            continue;
+        set_instance_attribs(vmodel_location, r->instance_offset + (GLintptr)sizeof(mat3x4) * first);
+        if (r->materials)
+        {
+            glVertexAttribIPointer(vmaterial_location, 1, GL_UNSIGNED_INT, sizeof(uint32_t),
+                (void*)(r->material_offset + (GLintptr)sizeof(uint32_t) * first));
+        }
+        if (r->picker)
+        {
+            glVertexAttribIPointer(vobject_location, 1, GL_UNSIGNED_INT, sizeof(uint32_t),
+                (void*)(r->object_offset + (GLintptr)sizeof(uint32_t) * first));
+        }
+        gpu_mesh_draw_lod_instanced(&r->mesh, l, (GLsizei)n * r->eyes);
+        if (triangles)
+            *triangles += (unsigned long long)(gpu_mesh_lod(&r->mesh, l)->index_count / 3) * n * r->eyes;
+        first += n;
+        ++draws;
+    }
+    return draws;
+}
+
+// --impostors: the visible objects after the levels of detail's, in one instanced draw of quads; without the
+// impostor renderer, at the mesh's coarsest level. The array buffer must be renderer_instance_buffer's; leaves the
+// pass's pipeline state bound again. Returns the draws made.
+static unsigned int renderer_draw_impostors(Renderer* r, const FramePacket* packet, const Camera* camera)
+{
+    const uint32_t n = packet->impostor_count;
+    const GLintptr first = packet->visible_count - (GLintptr)n;
+    const GLintptr offset = r->instance_offset + (GLintptr)sizeof(mat3x4) * first;
+    if (n == 0)
+        return 0;
+    if (!r->impostors)
+    {
+        set_instance_attribs(vmodel_location, offset);
+        if (r->materials)
+        {
+            glVertexAttribIPointer(vmaterial_location, 1, GL_UNSIGNED_INT, sizeof(uint32_t),
+                (void*)(r->material_offset + (GLintptr)sizeof(uint32_t) * first));
+        }
+        gpu_mesh_draw_lod_instanced(&r->mesh, LOD_MAX_LEVELS - 1, (GLsizei)n);
+        r->triangles_drawn += (unsigned long long)(gpu_mesh_lod(&r->mesh, LOD_MAX_LEVELS - 1)->index_count / 3) * n;
+        return 1;
+    }
+    const unsigned int draws = impostor_renderer_draw(r->impostors, renderer_instance_buffer(r), offset, (GLsizei)n,
+        camera->view, camera->projection_type == CAMERA_PERSPECTIVE);
+    r->triangles_drawn += 2ull * n;
+    pipeline_state_bind(&r->states, r->pass->scene);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, renderer_instance_buffer(r));
+    return draws;
+}
+
+// --windows: the instanced draw again in each of the wall's other windows, from the same regions of the shared
+// streams. Fences order the contexts on the GPU: the views wait for the main context's writes, and the main
+// context waits for the views before the streams fence the frame, so that fence also covers their reads. The
+// simulation, culling and matrix upload are done once; each extra window costs a context switch and a draw.
+static void renderer_draw_views(Renderer* r, const FramePacket* packet, GLintptr frame_offset)
+{
+    GLsync written = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();      // fences only reach other contexts once flushed
+    GLsync done[RENDER_MAX_WINDOWS - 1];
+    for (int i = 0; i < r->view_count; ++i)
+    {
+        RenderView* v = &r->views[i];
+        render_view_enter(v);
+        glWaitSync(written, 0, GL_TIMEOUT_IGNORED);
+        if (v->vertex_buffer != r->mesh.vertex_buffer)
+            render_view_point_at_mesh(r, v);
+        gl_state_viewport(0, 0, packet->camera.width / (1 + r->view_count), packet->camera.height);
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (r->pipeline && !v->pipeline)
+            v->pipeline = program_pipelines_create(r->pipelines, r->scene_pipeline_id);
+        use_scene_program(r->program, v->pipeline);
+        if (r->texture_id >= 0)
+            gl_state_bind_texture(0, GL_TEXTURE_2D, texture_streamer_texture(r->textures, r->texture_id));
+        if (r->materials)
+            material_set_bind(r->materials);
+        gl_state_bind_vertex_array(v->vertex_array);
+        gl_state_bind_buffer(GL_ARRAY_BUFFER, renderer_instance_buffer(r));
+        gl_state_bind_buffer_range(GL_UNIFORM_BUFFER, UNIFORMS_BINDING_CAMERA, r->camera_buffer, r->camera_stride * (i + 1),
+            sizeof(CameraUniforms));
+        uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_FRAME, frame_offset, sizeof(FrameUniforms));
+        uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_DRAW, r->draw_offsets[0], sizeof(DrawUniforms));
+        r->draw_calls += renderer_draw_lod_groups(r, packet, NULL);
+        done[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        v->drawn = true;
+        render_view_leave(r, v);
+    }
+    glDeleteSync(written);
+    for (int i = 0; i < r->view_count; ++i)
+    {
+        glWaitSync(done[i], 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(done[i]);
+    }
+}
+
+// --serve: a request's camera, looking from its eye at its target with z up (y up looking straight down or up),
+// its view built as the camera controller's is. The main camera's origin, so the instance matrices are relative to
+// it too, and its depth convention.
+static void request_camera(const Camera* main_camera, const RenderRequest* request, Camera* camera)
+{
+    camera_init(camera, 1.f);
+    camera_set_viewport(camera, request->width, request->height);
+    camera_set_reversed_z(camera, main_camera->reversed_z);
+    vec3 forward, centre = { 0.f, 0.f, 0.f };
+    for (int i = 0; i < 3; ++i)
+        forward[i] = (float)(request->target[i] - request->eye[i]);
+    const float distance = vec3_len(forward);
+    vec3 up = { 0.f, 0.f, 1.f };
+    if (fabsf(forward[2]) > 0.999f * distance)
+    {
+        up[1] = 1.f;
+        up[2] = 0.f;
+    }
+    mat4x4 turn;
+    mat4x4_look_at(turn, centre, forward, up);
+    dmat4x4 view;
+    dmat4x4_from_mat4x4(view, turn);
+    dmat4x4_translate_in_place(view, -request->eye[0], -request->eye[1], -request->eye[2]);
+    const float far_plane = main_camera->projection_type == CAMERA_PERSPECTIVE ? main_camera->far_plane : 0.f;
+    camera_set_perspective(camera, request->fov_y, 0.01f * distance, fmaxf(100.f * distance, far_plane));
+    camera_set_view(camera, view);
+    camera_set_origin(camera, main_camera->origin);
+    camera_update(camera);
+}
+
+// A layer read back: its pixels, copied out of the mapped buffer, go to the service's encoders
+static void renderer_batch_readback(void* user, int slot, int layer, const uint8_t* pixels, int width, int height)
+{
+    Renderer* r = (Renderer*)user;
+    const size_t bytes = 4 * (size_t)width * height;
+    uint8_t* image = pixels ? (uint8_t*)malloc(bytes) : NULL;
+    if (image)
+        memcpy(image, pixels, bytes);
+    render_service_complete(r->service, &r->batch_requests[slot][layer], image);
+}
+
+// --serve: takes the images read back since last frame to the encoders, then draws the next batch of waiting
+// requests, each into a layer of the batch target with a camera block of its own, and queues their readback. The
+// batch shares the frame: its simulation, its instance matrices and its levels of detail (chosen for the main
+// camera; --serve turns culling off so every object is there to draw). With nothing queued and nothing on its way
+// back, the wait for a request paces the loop.
+static_assert(BATCH_TARGET_LAYERS >= RENDER_SERVICE_MAX_BATCH, "a batch is drawn into the layers of one target");
+
+static void renderer_serve(Renderer* r, const FramePacket* packet)
+{
+    CPU_TRACE_SCOPE("serve");
+    batch_target_poll(r->batch, renderer_batch_readback, r);
+    render_service_poll(r->service, r->batch->count ? 0.0 : 0.01);
+    if (!batch_target_ready(r->batch))
+        return;
+    RenderRequest* batch = r->batch_requests[(r->batch->head + r->batch->count) % BATCH_TARGET_SLOTS];
+    const int n = render_service_batch(r->service, batch, RENDER_SERVICE_MAX_BATCH);
+    if (!n)
+        return;
+    const int width = batch[0].width, height = batch[0].height;
+    if (!batch_target_prepare(r->batch, width, height, n))
+    {
+        for (int k = 0; k < n; ++k)
+            render_service_complete(r->service, &batch[k], NULL);
+        return;
+    }
+
+    const GLintptr blocks = r->camera_stride * (1 + r->view_count);
+    gl_state_bind_buffer(GL_UNIFORM_BUFFER, r->camera_buffer);
+    for (int k = 0; k < n; ++k)
+    {
+        Camera camera;
+        request_camera(&packet->camera, &batch[k], &camera);
+        CameraUniforms block;
+        mat4x4_dup(block.view, camera.view);
+        mat4x4_dup(block.projection, camera.projection);
+        mat4x4_dup(block.view_projection, camera.view_projection);
+        block.viewport[0] = block.viewport[1] = 0.f;
+        block.viewport[2] = (float)width;
+        block.viewport[3] = (float)height;
+        glBufferSubData(GL_UNIFORM_BUFFER, blocks + r->camera_stride * k, sizeof(block), &block);
+        draw_counters_upload(sizeof(block));
+    }
+    gl_state_viewport(0, 0, width, height);
+    for (int k = 0; k < n; ++k)
+    {
+        batch_target_bind(r->batch, k);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        gl_state_bind_buffer_range(GL_UNIFORM_BUFFER, UNIFORMS_BINDING_CAMERA, r->camera_buffer,
+            blocks + r->camera_stride * k, sizeof(CameraUniforms));
+        r->draw_calls += renderer_draw_lod_groups(r, packet, NULL);
+    }
+    batch_target_read(r->batch, width, height, n);
+
+    // Back to the frame's target and camera for whatever the scene draws next
+    render_target_bind(&r->offscreen);
+    gl_state_viewport(0, 0, r->render_width, r->render_height);
+    gl_state_bind_buffer_range(GL_UNIFORM_BUFFER, UNIFORMS_BINDING_CAMERA, r->camera_buffer, 0, sizeof(CameraUniforms));
+}
+
+// --particles: advanced by the frame's delta on the GPU, then drawn over the scene with the instanced program and
+// "draw_offset"'s identity Draw block. Not in the wall's other windows.
+static void renderer_draw_particles(Renderer* r, const FramePacket* packet, GLintptr draw_offset)
+{
+    const GLuint program = shader_manager_program(&r->shader_manager, r->particle_program_id);
+    if (!program)
+        return;     // still compiling: the particles start once it's ready
+    if (program != r->particle_program)
+    {
+        r->particle_program = program;
+        uniforms_bind_blocks(program);
+    }
+    gpu_profiler_push(&r->profiler, "particles");
+    particles_update(r->particles, packet->delta);
+    gl_state_use_program(program);
+    uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_DRAW, draw_offset, sizeof(DrawUniforms));
+    particles_draw(r->particles);
+    particles_read_live_count(r->particles, &r->readback, &r->particles_alive, NULL, NULL);
+    ++r->draw_calls;
+    gpu_profiler_pop(&r->profiler);
+}
+
+// --characters: this frame's palettes into the ring, then every character in one instanced draw with the skinned
+// program and "draw_offset"'s identity Draw block. Not in the wall's other windows, nor in replays, which carry
+// no palettes. Baked (--bake-animation), there's nothing to upload and replays have them too.
+static void renderer_draw_characters(Renderer* r, const FramePacket* packet, GLintptr draw_offset)
+{
+    const GLuint program = shader_manager_program(&r->shader_manager, r->character_program_id);
+    const bool baked = r->characters->baked_palettes != 0;
+    if (!program || (!packet->palettes && !baked))
+        return;     // still compiling: the characters appear once it's ready
+    if (program != r->character_program)
+    {
+        r->character_program = program;
+        uniforms_bind_blocks(program);
+        skinned_batch_program(r->characters, program);
+    }
+    gpu_profiler_push(&r->profiler, "characters");
+    if (!baked)
+    {
+        CPU_TRACE_SCOPE("palettes");
+        skinned_batch_upload(r->characters, packet->palettes, r->character_count);
+    }
+    gl_state_use_program(program);
+    uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_DRAW, draw_offset, sizeof(DrawUniforms));
+    skinned_batch_draw(r->characters);
+    ++r->draw_calls;
+    gpu_profiler_pop(&r->profiler);
+}
+
+// A pass that only needs positions (the depth pre-pass, shadows) turns a split mesh's attribute stream off, so the
+// vertex fetch reads the position stream alone. Nothing to do for an interleaved mesh or pulled vertices.
+static void renderer_positions_only(Renderer* r, bool only)
+{
+    if (r->pull || !r->vertex_format.attribute_stride)
+        return;
+    gl_state_bind_vertex_array(r->vertex_array);
+    vertex_format_enable_attributes(&r->vertex_format, !only);
+}
+
+// --depth-prepass: the scene's depth on its own first, so its colour pass shades each pixel once (GL_EQUAL, depth
+// writes off). Returns false while its program is compiling (the scene draws in one pass meanwhile); otherwise
+// its state is bound.
+static bool renderer_depth_prepass_begin(Renderer* r)
+{
+    if (r->pass->prepass < 0)
+        return false;
+    gpu_profiler_push(&r->profiler, "prepass");
+    pipeline_state_bind(&r->states, r->pass->prepass);
+    renderer_positions_only(r, true);
+    return true;
+}
+
+// Colour back on for the draws whose depth the pre-pass laid down, with the scene program
+static void renderer_depth_prepass_end(Renderer* r)
+{
+    renderer_positions_only(r, false);
+    gpu_profiler_pop(&r->profiler);
+    pipeline_state_bind(&r->states, r->pass->shade);
+}
+
+// --gpu-pick: the readbacks whose copies are done, printed as they arrive; the ones still in flight wait for the
+// next frame's look
+static void renderer_pick_poll(Renderer* r)
+{
+    int object = -1;
+    unsigned int frame = 0;
+    while (gpu_picker_poll(r->picker, &object, &frame))
+        printf("picked object %d (GPU, %u frames later)\n", object, r->frames_drawn - frame);
+}
+
+// --gpu-pick: after the colour pass wrote the IDs, the pixel under the latest click copied off to be polled. The
+// click is a fraction of the window; the scene covers the bottom left render_width x render_height of the target.
+static void renderer_pick_read(Renderer* r)
+{
+    if (!r->pick.pending)
+        return;
+    const int x = (int)(r->pick.x * r->render_width);
+    const int y = r->render_height - 1 - (int)(r->pick.y * r->render_height);
+    if (gpu_picker_read(r->picker, x, y, r->frames_drawn))
+        r->pick.pending = false;    // otherwise it waits for a slot
+}
+
+// The scene's colour pass starts: what it shades is what the overdraw counts
+static void renderer_colour_pass(Renderer* r)
+{
+    if (r->measure_overdraw)
+        overdraw_begin(&r->overdraw, r->render_width * r->samples, r->render_height);    // it counts samples
+}
+
+// GPU-driven: what one phase of the cull kept, whole objects or their meshlets, with the program in use
+static void renderer_draw_kept(Renderer* r, GpuCullPhase phase)
+{
+    if (r->meshlets)
+        cluster_culling_draw(&r->clusters, &r->mesh);
+    else
+        gpu_culling_draw(&r->gpu_culling, &r->mesh, phase);
+    ++r->draw_calls;
+}
+
+// GPU-driven: one phase of the object cull and what it kept, whole objects or their meshlets that pass
+static void renderer_draw_culled(Renderer* r, const Frustum* cull, const Camera* camera, float t, GpuCullPhase phase)
+{
+    gpu_profiler_push(&r->profiler, "gpu cull");
+    gpu_culling_dispatch(&r->gpu_culling, &r->mesh, cull, t, phase, phase == GPU_CULL_FRUSTUM ? NULL : &r->hiz);
+    gpu_profiler_pop(&r->profiler);
+    if (r->meshlets)
+    {
+        gpu_profiler_push(&r->profiler, "meshlets");
+        cluster_culling_dispatch(&r->clusters, &r->gpu_culling, cull, camera->view_projection, phase);
+        gpu_profiler_pop(&r->profiler);
+    }
+    if (renderer_depth_prepass_begin(r))
+    {
+        renderer_draw_kept(r, phase);
+        renderer_depth_prepass_end(r);
+    }
+    else
+        pipeline_state_bind(&r->states, r->pass->scene);     // the cull left its compute program in use
+    renderer_colour_pass(r);
+    renderer_draw_kept(r, phase);
+}
+
+// GPU-driven: a frame's commands back, the objects they drew summed, and without meshlets their triangles at level 0
+static void renderer_culled_back(void* user, const void* data, size_t bytes, unsigned int frame)
+{
+    Renderer* r = (Renderer*)user;
+    const uint32_t objects = r->culled[0].instance_count + r->culled[1].instance_count;
+    r->counted_objects += objects;
+    if (!r->meshlets)
+        r->counted_triangles += (unsigned long long)objects * (r->mesh.index_count / 3);
+    ++r->counted_frames;
+}
+
+// --meshlets: a frame's totals back, their triangles summed
+static void renderer_clusters_back(void* user, const void* data, size_t bytes, unsigned int frame)
+{
+    Renderer* r = (Renderer*)user;
+    r->counted_triangles += r->cluster_stats.triangles;
+    ++r->meshlet_frames;
+}
+
+// GPU-driven: what the frame's phases kept, queued to come back a few frames later for the report. Nothing waits;
+// a frame with no slot free for it goes uncounted.
+static void renderer_read_culled(Renderer* r)
+{
+    gpu_culling_read_commands(&r->gpu_culling, &r->readback, r->culled, renderer_culled_back, r);
+    if (r->meshlets)
+        cluster_culling_read_stats(&r->clusters, &r->readback, &r->cluster_stats, renderer_clusters_back, r);
+}
+
+typedef struct SceneReplay
+{
+    Renderer* r;
+    int state;                  // the pipeline state a program command binds: the scene's, or the shading after a pre-pass
+    bool depth_only;
+} SceneReplay;
+
+// Naive: one command of the packet's list (see record_draw_range) in GL. "depth_only": the depth pre-pass, its
+// state already bound, no materials and nothing counted but the calls.
+static void renderer_replay_command(void* user, const Command* c)
+{
+    const SceneReplay* replay = (const SceneReplay*)user;
+    Renderer* r = replay->r;
+    switch (c->type)
+    {
+    case COMMAND_PROGRAM:
+        if (!replay->depth_only)
+            pipeline_state_bind(&r->states, replay->state);
+        break;
+    case COMMAND_VERTEX_ARRAY:
+        gl_state_bind_vertex_array(r->vertex_array);
+        break;
+    case COMMAND_UNIFORM:
+        uniforms_bind_range(&r->uniform_stream, c->slot, r->draw_offsets[c->value], sizeof(DrawUniforms));  // Points the Draw block at this object's model matrix
+        break;
+    case COMMAND_ATTRIBUTE:
+        if (!replay->depth_only && r->materials)
+            glVertexAttribI4ui(c->slot, c->value, 0, 0, 1);     // a constant, like vModel here
+        break;
+    case COMMAND_DRAW:
+        gpu_mesh_draw_lod(&r->mesh, c->id);     // Draw the object (indexed GL_TRIANGLES) at its level of detail
+        if (!replay->depth_only)
+            r->triangles_drawn += (unsigned long long)(gpu_mesh_lod(&r->mesh, c->id)->index_count / 3);
+        break;
+    }
+}
+
+// Naive: the packet's recorded draws, in key order, with only the bindings that change between them
+static void renderer_submit_commands(Renderer* r, const CommandList* commands, int state, bool depth_only)
+{
+    SceneReplay replay = { r, state, depth_only };
+    CommandReplayStats stats;
+    command_list_replay(commands, renderer_replay_command, &replay, &stats);
+    r->draw_calls += (unsigned int)stats.draws;
+}
+
+// --vrs without a shading rate image: the scene's draws once more into the half-size target, for the periphery.
+// The full-size draws that follow are scissored to the inset, and foveation_composite fills in around it.
+static bool renderer_draw_periphery(Renderer* r, const FramePacket* packet)
+{
+    if (!r->foveation || r->foveation->rate_image)
+        return false;
+    gpu_profiler_push(&r->profiler, "periphery");
+    foveation_periphery_begin(r->foveation, r->depth);
+    if (r->draw_mode != DRAW_MODE_NAIVE)
+        r->draw_calls += renderer_draw_lod_groups(r, packet, NULL);
+    else
+    {
+        const unsigned long long triangles = r->triangles_drawn;    // counted once, as the scene
+        renderer_submit_commands(r, &packet->commands, r->pass->scene, false);
+        r->triangles_drawn = triangles;
+    }
+    foveation_periphery_end(r->foveation);
+    gpu_profiler_pop(&r->profiler);
+    return true;
+}
+
+// --shadows: the cascades fitted to the view, and the ones their schedule picks drawn with this frame's casters -
+// the objects drawn, instanced or replayed from the packet's commands, whose Draw blocks are bound - then the
+// ground's shadows over the cleared frame. The scene's state is bound again after.
+static void renderer_draw_shadows(Renderer* r, const FramePacket* packet)
+{
+    ShadowMaps* s = r->shadows;
+    shadow_maps_bind(s);    // the SHADOWED variants read no cascades until the first fit
+    if (r->shadow_state < 0)
+        return;             // the depth-only program is still compiling
+    const Camera* camera = &packet->camera;
+    if (camera->version != r->shadow_camera_version)
+    {
+        const float ndc_near = camera->reversed_z ? 1.f : -1.f;
+        if (camera->projection_type == CAMERA_PERSPECTIVE)
+        {
+            // Only so far into the view: its far plane is a hundred times the orbit's distance
+            const float distance = fminf(camera->far_plane, RENDER_SHADOW_DISTANCE);
+            const vec4 eye = { 0.f, 0.f, -distance, 1.f };
+            vec4 clip;
+            mat4x4_mul_vec4(clip, camera->projection, eye);
+            shadow_maps_fit(s, camera->inverse_view_projection, ndc_near, clip[2] / clip[3], camera->near_plane, distance);
+        }
+        else
+            shadow_maps_fit(s, camera->inverse_view_projection, ndc_near, camera->reversed_z ? 0.f : 1.f, 0.f, 0.f);
+        if (r->cull)
+            shadow_cascades_invalidate(&s->cascades, r->casters.min, r->casters.max);   // the visible set changed
+        r->shadow_camera_version = camera->version;
+    }
+    if (packet->sim_time != r->shadow_sim_time)
+    {
+        shadow_cascades_invalidate(&s->cascades, r->casters.min, r->casters.max);     // they've turned
+        r->shadow_sim_time = packet->sim_time;
+    }
+
+    const uint32_t due = shadow_cascades_schedule(&s->cascades);
+    if (due)
+    {
+        gpu_profiler_push(&r->profiler, "shadows");
+        pipeline_state_bind(&r->states, r->shadow_state);
+        renderer_positions_only(r, true);
+        for (int i = 0; i < s->cascades.count; ++i)
+        {
+            if (!(due & (1u << i)))
+                continue;
+            shadow_maps_begin(s, i);
+            if (r->draw_mode != DRAW_MODE_NAIVE)
+                r->draw_calls += renderer_draw_lod_groups(r, packet, NULL);
+            else
+                renderer_submit_commands(r, &packet->commands, r->shadow_state, true);
+            ++r->shadow_draws;
+        }
+        renderer_positions_only(r, false);
+        shadow_maps_end(s);
+        gl_state_viewport(0, 0, r->render_width / (1 + r->view_count), r->render_height);
+        gl_state_bind_buffer_range(GL_UNIFORM_BUFFER, UNIFORMS_BINDING_CAMERA, r->camera_buffer, 0, sizeof(CameraUniforms));
+        gpu_profiler_pop(&r->profiler);
+    }
+    gpu_profiler_push(&r->profiler, "shadow ground");
+    shadow_maps_draw_ground(s, camera->inverse_view_projection, r->render_width, r->render_height);
+    gpu_profiler_pop(&r->profiler);
+    pipeline_state_bind(&r->states, r->pass->scene);
+}
+
+// Writes the uniform blocks and submits the draws for a frame begun with renderer_begin_frame.
+// "models" are the matrices from renderer_begin_frame (instanced) or the packet's own (naive); the naive path
+// takes each object's material from "materials".
+// --post: the scene's HDR colour through the chain to the window, or headless to a pooled target of the frame's
+// size so the chain costs the same. Unlike the upscale it runs in the frame, where the profiler times it.
+static void renderer_post_process(Renderer* r)
+{
+    gpu_profiler_push(&r->profiler, "post");
+    const PooledTarget* output = r->headless
+        ? render_target_pool_acquire(&r->targets, r->offscreen.width, r->offscreen.height, GL_RGBA8) : NULL;
+    if (!r->headless || output)
+        r->post_presented = post_process_run(r->post, &r->post_settings, &r->offscreen, r->render_width,
+            r->render_height, output ? output->framebuffer : 0, r->offscreen.width, r->offscreen.height) && !output;
+    render_target_pool_release(&r->targets, output);
+    render_target_pool_end_frame(&r->targets);
+    gpu_profiler_pop(&r->profiler);
+    if (r->depth)
+        gl_state_enable(GL_DEPTH_TEST, true);
+    if (r->headless)
+        render_target_bind(&r->offscreen);     // where the next frame draws
+}
+
+// --labels: each of the first visible objects gets its position printed over it. A label is only laid out
+// again when the camera moves it or its readout changes, so a still camera costs a compare per label. "models"
+// may be the mapped instance stream: a few matrices read back from it stay cheap.
+static void renderer_update_labels(Renderer* r, const Camera* camera, const mat3x4* models, int visible_count)
+{
+    for (int i = 0; i < r->label_count; ++i)
+    {
+        if (!models || i >= visible_count)
+        {
+            text_cache_show(r->hud.text, r->label_slots[i], false);
+            continue;
+        }
+        const vec4 world = { models[i][0][3], models[i][1][3], models[i][2][3], 1.f };
+        vec4 clip;
+        mat4x4_mul_vec4(clip, camera->view_projection, world);
+        const float x = clip[0] / clip[3], y = clip[1] / clip[3];
+        if (clip[3] <= 0.f || x < -1.f || x > 1.f || y < -1.f || y > 1.f)
+        {
+            text_cache_show(r->hud.text, r->label_slots[i], false);
+            continue;
+        }
+        char text[32];
+        snprintf(text, sizeof(text), "%.2f, %.2f", world[0], world[1]);
+        const float scale = camera->height >= 1440 ? 2.f : 1.f;
+        const float px = (x * 0.5f + 0.5f) * camera->width - 0.5f * text_width(text, scale);
+        const float py = (0.5f - y * 0.5f) * camera->height - (GLYPH_FONT_HEIGHT + 4) * scale;    // just above it
+        text_cache_set(r->hud.text, r->label_slots[i], floorf(px), floorf(py), scale, 0xFF80F0FFu, text);
+    }
+}
+
+// --shapes: a wall of 16 charts, their panels in layer 0 and the bars, sparkline segments, dots and markers over
+// them in layer 1, all moving. Built from scratch every frame, as an immediate-mode dashboard would be.
+// Chart c's top-left corner; false when the window's too small for charts
+static bool dashboard_layout(int width, int height, int c, float* x0, float* y0, float* chart_w, float* chart_h)
+{
+    const int rows = DASHBOARD_CHARTS / DASHBOARD_COLUMNS;
+    *chart_w = (width - DASHBOARD_MARGIN) / DASHBOARD_COLUMNS - DASHBOARD_MARGIN;
+    *chart_h = (height - DASHBOARD_MARGIN) / rows - DASHBOARD_MARGIN;
+    *x0 = DASHBOARD_MARGIN + c % DASHBOARD_COLUMNS * (*chart_w + DASHBOARD_MARGIN);
+    *y0 = DASHBOARD_MARGIN + c / DASHBOARD_COLUMNS * (*chart_h + DASHBOARD_MARGIN);
+    return *chart_w >= 8.f && *chart_h >= 8.f;
+}
+
+static void dashboard_panels(ShapeBatch* b, int width, int height)
+{
+    float x0, y0, chart_w, chart_h;
+    for (int c = 0; c < DASHBOARD_CHARTS && dashboard_layout(width, height, c, &x0, &y0, &chart_w, &chart_h); ++c)
+        shape_batch_rect(b, x0, y0, chart_w, chart_h, 0x90201810u);
+}
+
+// Chart c's share of the "count" primitives but its panel, in layer 1, as they stand at "time"
+static void dashboard_chart(ShapeBatch* b, int count, int c, int width, int height, float time)
+{
+    float x0, y0, chart_w, chart_h;
+    if (!dashboard_layout(width, height, c, &x0, &y0, &chart_w, &chart_h))
+        return;
+    shape_batch_set_layer(b, 1);
+    const int per_chart = (count - DASHBOARD_CHARTS + DASHBOARD_CHARTS - 1) / DASHBOARD_CHARTS;
+    const float step = chart_w / (per_chart > 0 ? per_chart : 1);
+    for (int j = 0; j * DASHBOARD_CHARTS + c < count - DASHBOARD_CHARTS; ++j)
+    {
+        const float x = x0 + j * step, value = 0.5f + 0.4f * sinf(time * 1.7f + j * 0.05f + c);
+        const float y = y0 + chart_h * (1.f - value);
+        switch (j & 3)
+        {
+        case 0:
+            shape_batch_rect(b, x, y, step > 1.f ? step : 1.f, y0 + chart_h - y, 0x80F0A040u);
+            break;
+        case 1:
+            shape_batch_line(b, x - step, y0 + chart_h * (0.5f - 0.4f * sinf(time + (j - 1) * 0.08f + c)), x,
+                y0 + chart_h * (0.5f - 0.4f * sinf(time + j * 0.08f + c)), 1.5f, 0xFF60E0FFu);
+            break;
+        case 2:
+            shape_batch_circle(b, x, y, 2.5f, 0xFF4080FFu);
+            break;
+        default:
+            shape_batch_triangle(b, x, y - 3.f, x - 3.f, y + 3.f, x + 3.f, y + 3.f, 0xFFFFFFFFu);
+            break;
+        }
+    }
+}
+
+static void dashboard_build(ShapeBatch* b, int count, int width, int height, float time)
+{
+    dashboard_panels(b, width, height);
+    for (int c = 0; c < DASHBOARD_CHARTS; ++c)
+        dashboard_chart(b, count, c, width, height, time);
+}
+
+// --retained-ui: the same charts as widgets of a UiLayer, the panels one and each chart another. Each chart is a
+// live feed with a rate of its own, 1 to 4 readings a second on the wall clock, and is rebuilt only when it has a
+// new one (or the window a new size); returns when the next is due.
+static double dashboard_widgets(UiLayer* ui, int count, int width, int height, double now)
+{
+    const uint64_t size = (uint64_t)width << 16 | (uint64_t)height;
+    if (ShapeBatch* b = ui_layer_begin(ui, 0, size))
+    {
+        dashboard_panels(b, width, height);
+        ui_layer_end(ui);
+    }
+    double next = INFINITY;
+    for (int c = 0; c < DASHBOARD_CHARTS; ++c)
+    {
+        const double rate = 1 + c % 4, reading = floor(now * rate);
+        next = fmin(next, (reading + 1.0) / rate);
+        if (ShapeBatch* b = ui_layer_begin(ui, 1 + c, (uint64_t)reading << 32 ^ size))
+        {
+            dashboard_chart(b, count, c, width, height, (float)(reading / rate));
+            ui_layer_end(ui);
+        }
+    }
+    return next;
+}
+
+// --paths: the gauges laid out in a grid filling the window, each panel on whole wave cells
+static void gauges_build(ShapeBatch* b, VectorPath* paths, int count, int width, int height, float time)
+{
+    const int gauges = gauge_count(count);
+    const int columns = (int)ceilf(sqrtf((float)gauges * width / height)), rows = (gauges + columns - 1) / columns;
+    float cell = fminf((float)width / columns, (float)height / rows);
+    if (cell >= 2.f * SHAPE_BATCH_PATH_CELL)
+        cell = floorf(cell / SHAPE_BATCH_PATH_CELL) * SHAPE_BATCH_PATH_CELL;   // no two panels in a wave cell
+    if (cell < 8.f)
+        return;
+    const float s = cell / 100.f;
+    for (int g = 0; g < gauges; ++g)
+    {
+        const float x = g % columns * cell, y = g / columns * cell;
+        const float value = 0.5f + 0.45f * sinf(time * 0.9f + g * 0.37f), a = GAUGE_START + GAUGE_SWEEP * value;
+        const float t[6] = { s, 0.f, 0.f, s, x, y };
+        const float needle[6] = { s * cosf(a), s * sinf(a), -s * sinf(a), s * cosf(a), x + 50.f * s, y + 55.f * s };
+        VectorPath* arc = &paths[3 + g];
+        vector_path_reset(arc);
+        vector_path_arc(arc, 50.f, 55.f, 32.f, GAUGE_START, a);
+        shape_batch_set_layer(b, 2);
+        shape_batch_fill_path(b, &paths[0], t, 0xC0201810u, SHAPE_FILL_NONZERO);
+        shape_batch_set_layer(b, 3);
+        shape_batch_stroke_path(b, &paths[1], t, 6.f, VECTOR_JOIN_ROUND, 0xFF404040u);
+        shape_batch_stroke_path(b, arc, t, 6.f, VECTOR_JOIN_ROUND, 0xFF40C0FFu);
+        shape_batch_fill_path(b, &paths[2], needle, 0xFFFFFFFFu, SHAPE_FILL_NONZERO);
+    }
+}
+
+// 2D overlays (--shapes, --paths, --series) go over whatever holds the finished frame, at its size: the window when
+// post-processing wrote it, otherwise the offscreen target's colour (before the upscale) or the window itself.
+// Binds it and returns true when the offscreen target has to be bound again afterwards.
+static bool renderer_bind_overlay(Renderer* r, const FramePacket* packet, int* width, int* height)
+{
+    *width = r->render_width;
+    *height = r->render_height;
+    const bool offscreen = !r->post_presented && (r->headless || r->offscreen_frames);
+    if (r->post_presented)
+    {
+        gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        *width = packet->camera.width;
+        *height = packet->camera.height;
+    }
+    else if (offscreen)
+        gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, r->offscreen.color_framebuffer);
+    return offscreen;
+}
+
+// --shapes, --paths: the dashboard and the gauges, over the finished frame; --retained-ui: the dashboard's widgets
+// brought up to date and their picture composited
+static void renderer_draw_shapes(Renderer* r, const FramePacket* packet)
+{
+    gpu_profiler_push(&r->profiler, "shapes");
+    int width, height;
+    const bool offscreen = renderer_bind_overlay(r, packet, &width, &height);
+    if (r->ui)
+    {
+        r->ui_next = dashboard_widgets(r->ui, r->shape_count, width, height, glfwGetTime());
+        ui_renderer_draw(&r->ui_renderer, r->ui, width, height);
+    }
+    else if (r->shape_count)
+        dashboard_build(r->shapes, r->shape_count, width, height, (float)packet->time);
+    if (r->shapes)
+    {
+        if (r->path_count)
+            gauges_build(r->shapes, r->gauge_paths, r->path_count, width, height, (float)packet->time);
+        r->path_flattens += r->shapes->path_flattens;
+        r->shape_draws += shape_renderer_flush(&r->shape_renderer, r->shapes, width, height);
+        r->path_waves += r->shape_renderer.waves;
+    }
+    ++r->shape_frames;
+    if (offscreen)
+        render_target_bind(&r->offscreen);
+    gpu_profiler_pop(&r->profiler);
+}
+
+// --series: this frame's samples of every series (a few drifting sines with noise, from the sample index, so runs
+// compare) appended and uploaded, then each series' whole history in a lane of a strip along the bottom of the
+// frame, scaled to the values in view
+static void renderer_draw_series(Renderer* r, const FramePacket* packet)
+{
+    gpu_profiler_push(&r->profiler, "series");
+    for (int s = 0; s < r->series_count; ++s)
+    {
+        LineSeries* series = &r->series[s];
+        float samples[RENDER_SERIES_SAMPLES];
+        for (int k = 0; k < RENDER_SERIES_SAMPLES; ++k)
+        {
+            const double t = (double)(series->count + k) * 0.001;
+            const uint32_t h = telemetry_hash((uint32_t)(series->count + k) * 16u + (uint32_t)s);
+            samples[k] = (float)(sin(t * (0.7 + 0.3 * s)) + 0.3 * sin(t * (11.0 + s))) + 0.1f * ((h >> 8) / 16777216.f - 0.5f);
+        }
+        line_series_append(series, samples, RENDER_SERIES_SAMPLES);
+        line_renderer_upload(&r->line_renderer, s, series);
+    }
+
+    int width, height;
+    const bool offscreen = renderer_bind_overlay(r, packet, &width, &height);
+    const float margin = 8.f, lane = (0.25f * height - margin) / r->series_count;
+    static const uint32_t palette[4] = { 0xFFF0A040u, 0xFF60E0FFu, 0xFF4080FFu, 0xFFA0FF70u };
+    line_renderer_begin(&r->line_renderer, width, height);
+    for (int s = 0; s < r->series_count && lane >= 4.f; ++s)
+    {
+        const float rect[4] = { margin, margin + s * lane, width - 2.f * margin, lane - 2.f };
+        LineSeriesView view;
+        line_series_view(&r->series[s], 0, r->series[s].count, (int)rect[2], &view);
+        line_renderer_draw(&r->line_renderer, s, &view, rect, view.min, view.max, 1.5f, palette[s & 3]);
+    }
+    line_renderer_end(&r->line_renderer);
+    ++r->series_frames;
+    if (offscreen)
+        render_target_bind(&r->offscreen);
+    gpu_profiler_pop(&r->profiler);
+}
+
+// --points: this frame's slice into the point layer, and the layer onto the scene target before anything else is
+// drawn, so the scene goes over it. The view is the world rectangle the camera's clip corners cover.
+static void renderer_draw_points(Renderer* r, const Camera* camera)
+{
+    gpu_profiler_push(&r->profiler, "points");
+    vec4 corners[2];
+    vec4 clip[2] = { { -1.f, -1.f, 0.f, 1.f }, { 1.f, 1.f, 0.f, 1.f } };
+    for (int k = 0; k < 2; ++k)
+        mat4x4_mul_vec4(corners[k], camera->inverse_view_projection, clip[k]);
+    const float view[4] = { fminf(corners[0][0], corners[1][0]), fminf(corners[0][1], corners[1][1]),
+        fmaxf(corners[0][0], corners[1][0]), fmaxf(corners[0][1], corners[1][1]) };
+    point_cloud_renderer_draw(r->points, view, camera->view_projection, r->render_width, r->render_height);
+    gpu_profiler_pop(&r->profiler);
+}
+
+#ifdef OPENGLTEST_CUDA
+typedef struct CudaPointsDraw
+{
+    FeedRenderer* feed;
+    const CudaPoints* points;
+    const Camera* camera;
+} CudaPointsDraw;
+
+static void draw_cuda_points(void* user, const FrameGraph* graph, int pass)
+{
+    const CudaPointsDraw* draw = (const CudaPointsDraw*)user;
+    feed_renderer_draw_buffer(draw->feed, draw->points->buffer, 0, draw->points->count, draw->camera->view_projection);
+}
+#endif
+
+// --feed: the producer's newest frame, if it published one since the last, then the points depth tested under the
+// scene's draws. --cuda-points: the kernel moves its points in their buffer, mapped to CUDA only while it runs, and
+// they're drawn the same way
+static void renderer_draw_feed(Renderer* r, const Camera* camera)
+{
+    gpu_profiler_push(&r->profiler, "feed");
+    feed_renderer_update(r->feed, glfwGetTime());
+    feed_renderer_draw(r->feed, camera->view_projection);
+#ifdef OPENGLTEST_CUDA
+    if (r->cuda_points)
+    {
+        CudaPointsDraw draw = { r->feed, r->cuda_points, camera };
+        cuda_points_frame(r->cuda_points, glfwGetTime(), draw_cuda_points, &draw);
+    }
+#endif
+    gpu_profiler_pop(&r->profiler);
+}
+
+// --terrain: the patches the camera's frustum keeps, opaque and depth tested ahead of the scene, which binds its own
+// pipeline state after
+static void renderer_draw_terrain(Renderer* r, const Camera* camera)
+{
+    gpu_profiler_push(&r->profiler, "terrain");
+    gl_state_enable(GL_DEPTH_TEST, true);
+    gl_state_depth_func(r->depth_func);
+    gl_state_depth_mask(true);
+    gl_state_colour_mask(true);
+    gl_state_enable(GL_BLEND, false);
+    gl_state_enable(GL_CULL_FACE, false);
+    terrain_renderer_draw(r->terrain, &camera->frustum, camera->view,
+        camera->projection[1][1] * 0.5f * (float)r->render_height);
+    gpu_profiler_pop(&r->profiler);
+}
+
+// --volume: marched at a fraction of the scene's resolution once it's resolved, and composited over its colour
+// ahead of post-processing; the rays stop at the scene's depth unless it's multisampled
+static void renderer_draw_volume(Renderer* r, const Camera* camera)
+{
+    gpu_profiler_push(&r->profiler, "volume");
+    VolumeView view;
+    mat4x4_dup(view.view_projection, camera->view_projection);
+    mat4x4_dup(view.inverse_view_projection, camera->inverse_view_projection);
+    view.pixel_scale = camera->projection_type == CAMERA_PERSPECTIVE
+        ? camera->projection[1][1] * 0.5f * (float)r->render_height : 0.f;
+    view.reversed_z = camera->reversed_z;
+    view.zero_to_one = camera->reversed_z && gl_ext.ARB_clip_control;
+    view.depth = r->depth && r->samples == 1 ? r->offscreen.depth_stencil : 0;
+    view.width = r->render_width;
+    view.height = r->render_height;
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, r->offscreen.color_framebuffer);
+    gl_state_viewport(0, 0, r->render_width, r->render_height);
+    volume_renderer_draw(r->volume, &view);
+    if (r->depth)
+        gl_state_enable(GL_DEPTH_TEST, true);
+    gpu_profiler_pop(&r->profiler);
+}
+
+// --map: the tour pans at RENDER_MAP_SPEED pixels a second, turning slowly, while the zoom swings between levels 3
+// and 17 (scrolling zooms on top of that), so it keeps reaching tiles it has never loaded. The map is drawn first
+// and opaque, the background of the scene target.
+static void renderer_draw_map(Renderer* r, const FramePacket* packet)
+{
+    gpu_profiler_push(&r->profiler, "map");
+    const double t = packet->time, dt = packet->delta > 0.f ? packet->delta : 0.0;
+    const double level = 10.0 + 7.0 * sin(0.05 * t) + log2(packet->camera.zoom);
+    const double px = TILE_MAP_RENDERER_TILE_SIZE * exp2(level);     // pixels a map unit
+    for (int k = 0; k < 2; ++k)
+    {
+        const double c = r->map_centre[k] + (k ? sin(0.13 * t) : cos(0.13 * t)) * RENDER_MAP_SPEED * dt / px;
+        r->map_centre[k] = c < 0.0 ? 0.0 : c > 1.0 ? 1.0 : c;
+    }
+    const double half[2] = { 0.5 * r->render_width / px, 0.5 * r->render_height / px };
+    const double view[4] = { r->map_centre[0] - half[0], r->map_centre[1] - half[1], r->map_centre[0] + half[0],
+        r->map_centre[1] + half[1] };
+    tile_map_renderer_draw(r->map, view, r->render_width, r->render_height, dt);
+    gpu_profiler_pop(&r->profiler);
+}
+
+static void renderer_draw(Renderer* r, const FramePacket* packet, const mat3x4* models, const uint32_t* materials)
+{
+    CPU_TRACE_SCOPE("submit");
+    // The camera block is only rewritten after a resize. The driver takes care of a draw still reading the
+    // old contents; that's a rare copy or stall instead of 208 bytes streamed every frame. --taa's jitter moves
+    // every frame, and so do --xr's late-latched eyes, so it's rewritten every frame then.
+    const Camera* camera = &packet->camera;
+    mat4x4 jitter;
+    mat4x4_identity(jitter);
+    if (r->taa)
+    {
+        if (memcmp(camera->origin, r->taa_origin, sizeof(dvec3)))
+            temporal_reset(&r->taa->temporal);     // the matrices' space moved: last frame's don't compare
+        memcpy(r->taa_origin, camera->origin, sizeof(dvec3));
+        temporal_begin_frame(&r->taa->temporal, camera->view_projection, r->render_width, r->render_height);
+        temporal_jitter_matrix(&r->taa->temporal, jitter);
+    }
+    if (camera->version != r->camera_version || r->taa || r->xr)
+    {
+        // Window k of a wall of n shows clip-space x in [-1 + 2k/n, -1 + 2(k+1)/n]: scale x by n and shift
+        // that tile back to [-1, 1]. A single window gets the identity.
+        const int tiles = 1 + r->view_count;
+        gl_state_bind_buffer(GL_UNIFORM_BUFFER, r->camera_buffer);
+        for (int k = 0; k < tiles; ++k)
+        {
+            mat4x4 tile;
+            mat4x4_identity(tile);
+            tile[0][0] = (float)tiles;
+            tile[3][0] = (float)(tiles - 1 - 2 * k);
+            mat4x4_mul(tile, tile, jitter);
+            CameraUniforms block;
+            mat4x4_dup(block.view, camera->view);
+            mat4x4_mul(block.projection, tile, camera->projection);
+            mat4x4_mul(block.view_projection, tile, camera->view_projection);
+            block.viewport[0] = (float)(camera->width / tiles * k);
+            block.viewport[1] = 0.f;
+            block.viewport[2] = (float)(camera->width / tiles);
+            block.viewport[3] = (float)camera->height;
+            glBufferSubData(GL_UNIFORM_BUFFER, r->camera_stride * k, sizeof(block), &block);
+            draw_counters_upload(sizeof(block));
+        }
+        if (r->eyes > 1)
+        {
+            StereoUniforms eyes;
+            mat4x4_dup(eyes.eye_view_projection[0], camera->stereo_view_projection[0]);
+            mat4x4_dup(eyes.eye_view_projection[1], camera->stereo_view_projection[1]);
+            glBufferSubData(GL_UNIFORM_BUFFER, r->camera_stride, sizeof(eyes), &eyes);
+            draw_counters_upload(sizeof(eyes));
+        }
+        r->camera_version = camera->version;
+    }
+    gl_state_bind_buffer_range(GL_UNIFORM_BUFFER, UNIFORMS_BINDING_CAMERA, r->camera_buffer, 0, sizeof(CameraUniforms));   // once; cached after
+    if (r->eyes > 1)
+        gl_state_bind_buffer_range(GL_UNIFORM_BUFFER, UNIFORMS_BINDING_STEREO, r->camera_buffer, r->camera_stride,
+            sizeof(StereoUniforms));
+    if (r->picker)
+        renderer_pick_poll(r);
+    gpu_readback_poll(&r->readback, r->frames_drawn);
+
+    renderer_update_memory(r, packet);
+
+    // The texture's mips follow the size the objects are drawn at: every object has the same size on screen
+    if (r->texture_id >= 0)
+    {
+        if (packet->visible_count > 0 || r->draw_mode == DRAW_MODE_GPU_DRIVEN || packet->gpu_cull)
+            texture_streamer_request(r->textures, r->texture_id, r->texture_size * camera->view_projection[1][1] * camera->height);
+        texture_streamer_update(r->textures);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, texture_streamer_texture(r->textures, r->texture_id));
+    }
+
+    // Materials are bound once for the frame, whatever mix of them the draws cover
+    if (r->materials)
+        material_set_bind(r->materials);
+
+    // The lights where they are this frame, and each cluster of the view's list of them
+    if (r->lighting)
+    {
+        gpu_profiler_push(&r->profiler, "lights");
+        lighting_update(r->lighting, (float)packet->sim_time, camera->inverse_view_projection, r->render_width,
+            r->render_height);
+        gpu_profiler_pop(&r->profiler);
+    }
+
+    // Per-frame constants go straight into this frame's region of the uniform stream
+    stream_buffer_begin_frame(&r->uniform_stream);
+    GLintptr frame_offset = 0;
+    FrameUniforms* frame = (FrameUniforms*)uniforms_alloc(&r->uniform_stream, sizeof(FrameUniforms), &frame_offset);
+    frame->time[0] = (float)packet->time;
+    frame->time[1] = packet->delta;
+    frame->time[2] = (float)packet->frame_index;
+    frame->time[3] = (float)packet->sim_time;
+    GLintptr identity_draw_offset = 0;     // the particles' and the characters'
+    if (r->particles || r->characters)
+    {
+        DrawUniforms* draw = (DrawUniforms*)uniforms_alloc(&r->uniform_stream, sizeof(DrawUniforms), &identity_draw_offset);
+        mat4x4_identity(draw->model);
+    }
+
+    if (r->map)
+        renderer_draw_map(r, packet);
+    if (r->points)
+        renderer_draw_points(r, camera);
+    if (r->feed)
+        renderer_draw_feed(r, camera);
+    if (r->terrain)
+        renderer_draw_terrain(r, camera);
+
+    if (r->impostors && packet->impostor_count)
+        impostor_renderer_bake(r->impostors, r->vertex_array, &r->mesh, r->impostor_radius);    // the first time
+    gpu_profiler_push(&r->profiler, "scene");
+    r->draw_calls = 0;
+    if (r->hud_visible)
+        hud_scene_begin(&r->hud);
+    if (r->foveation)
+    {
+        foveation_resize(r->foveation, &r->offscreen, r->render_width, r->render_height);
+        if (r->foveation->rate_image)
+            foveation_shade_begin(r->foveation);
+    }
+    const bool deferred = r->deferred && lighting_gbuffer_begin(r->lighting, r->render_width, r->render_height);
+    // --oit: the translucent scene goes to the accumulation targets (tested against the frame's depth) or the
+    // lists, apart from what's already drawn under it
+    const bool oit = r->oit && oit_begin(r->oit, r->render_width, r->render_height, r->depth ? r->offscreen.depth_stencil : 0);
+
+    // The scene program, its vertex array and the pass's depth and blend state in one bind. Usually all set
+    // already; the state cache drops the calls then.
+    r->pass = &r->pass_states[deferred ? 1 : 0];
+    pipeline_state_bind(&r->states, r->pass->scene);
+    if (r->draw_mode != DRAW_MODE_NAIVE)
+    {
+        // One Draw block for the whole batch; the instance matrices carry the per-object part
+        DrawUniforms* draw = (DrawUniforms*)uniforms_alloc(&r->uniform_stream, sizeof(DrawUniforms), &r->draw_offsets[0]);
+        mat4x4_identity(draw->model);
+        stream_buffer_commit(&r->uniform_stream);
+        uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_FRAME, frame_offset, sizeof(FrameUniforms));
+        uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_DRAW, r->draw_offsets[0], sizeof(DrawUniforms));
+        renderer_warm_up(r);
+
+        if (r->draw_mode == DRAW_MODE_GPU_DRIVEN || packet->gpu_cull)
+        {
+            // Cull + transform on the GPU, then one indirect draw of whatever survived. --cull-select's CPU frames
+            // point the instance attributes at the stream, so its GPU frames point them back at the cull's output.
+            if (packet->gpu_cull)
+            {
+                gl_state_bind_buffer(GL_ARRAY_BUFFER, r->gpu_culling.instance_buffer);
+                set_instance_attribs(vmodel_location, 0);
+                if (r->gpu_culling.material_buffer)
+                {
+                    gl_state_bind_buffer(GL_ARRAY_BUFFER, r->gpu_culling.material_buffer);
+                    glVertexAttribIPointer(vmaterial_location, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+                }
+            }
+            const Frustum* cull = r->cull ? &camera->frustum : NULL;
+            const float t = (float)packet->sim_time;   // the compute shader's rotation is SCENE_SPIN_RATE (1) * t + phase
+            if (r->occlusion)
+            {
+                // Last frame's visible objects first, then everything else against the depth they left
+                renderer_draw_culled(r, cull, camera, t, GPU_CULL_EARLY);
+                gpu_profiler_push(&r->profiler, "hiz");
+                hiz_build(&r->hiz, r->offscreen.depth_stencil, r->offscreen.width, r->offscreen.height, camera->view_projection);
+                gpu_profiler_pop(&r->profiler);
+                renderer_draw_culled(r, cull, camera, t, GPU_CULL_LATE);
+            }
+            else
+                renderer_draw_culled(r, cull, camera, t, GPU_CULL_FRUSTUM);
+            if (r->draw_mode == DRAW_MODE_GPU_DRIVEN)
+                renderer_read_culled(r);    // the report's counts: --cull-select's frames go uncounted
+        }
+        else
+        {
+            if (r->animate)
+            {
+                // Every object's matrix for the simulated time, written on the GPU where the draws read it
+                gpu_profiler_push(&r->profiler, "animation");
+                gpu_animation_dispatch(&r->animation);
+                gpu_profiler_pop(&r->profiler);
+                pipeline_state_bind(&r->states, r->pass->scene);     // the dispatch left its compute program in use
+            }
+            else
+                stream_buffer_commit(&r->instance_stream);  // the model matrices are in place
+            gl_state_bind_buffer(GL_ARRAY_BUFFER, renderer_instance_buffer(r));
+            if (r->shadows)
+                renderer_draw_shadows(r, packet);
+            if (r->eyes > 1)
+                gl_state_enable(GL_CLIP_DISTANCE0, true);   // the scene's draws write it, and only they do
+            if (renderer_depth_prepass_begin(r))
+            {
+                r->draw_calls += renderer_draw_lod_groups(r, packet, NULL);
+                renderer_depth_prepass_end(r);
+            }
+            renderer_colour_pass(r);
+            if (r->picker)
+            {
+                if (packet->pick.pending)
+                    r->pick = packet->pick;
+                gpu_picker_begin(r->picker);
+            }
+            const bool periphery = renderer_draw_periphery(r, packet);
+            r->draw_calls += renderer_draw_lod_groups(r, packet, &r->triangles_drawn);  // every visible copy, a call per level
+            r->draw_calls += renderer_draw_impostors(r, packet, camera);
+            if (r->eyes > 1)
+                gl_state_enable(GL_CLIP_DISTANCE0, false);
+            if (periphery)
+                foveation_composite(r->foveation, &r->offscreen, r->depth);
+            if (r->picker)
+            {
+                gpu_picker_end(r->picker);
+                renderer_pick_read(r);
+            }
+            if (r->view_count)
+                renderer_draw_views(r, packet, frame_offset);
+            if (r->service)
+                renderer_serve(r, packet);
+            if (!r->animate)
+                stream_buffer_end_frame(&r->instance_stream);   // fence this frame's region
+        }
+    }
+    else
+    {
+        // One Draw block per object, all written before the mapping is released
+        for (int i = 0; i < packet->visible_count; ++i)
+        {
+            DrawUniforms* draw = (DrawUniforms*)uniforms_alloc(&r->uniform_stream, sizeof(DrawUniforms), &r->draw_offsets[i]);
+            mat4x4_from_mat3x4(draw->model, models[i]);
+        }
+        stream_buffer_commit(&r->uniform_stream);
+        uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_FRAME, frame_offset, sizeof(FrameUniforms));
+        if (packet->visible_count > 0)
+        {
+            uniforms_bind_range(&r->uniform_stream, UNIFORMS_BINDING_DRAW, r->draw_offsets[0], sizeof(DrawUniforms));
+            renderer_warm_up(r);    // with nothing visible it waits for a frame that has a Draw block to bind
+        }
+
+        // The draws were recorded and sorted on the main thread (scene_record_draws); replaying them only
+        // rebinds where the program, vertex array or material changes
+        if (r->shadows)
+            renderer_draw_shadows(r, packet);
+        const bool prepassed = renderer_depth_prepass_begin(r);
+        if (prepassed)
+        {
+            renderer_submit_commands(r, &packet->commands, r->pass->prepass, true);
+            renderer_depth_prepass_end(r);
+        }
+        renderer_colour_pass(r);
+        const bool periphery = !prepassed && renderer_draw_periphery(r, packet);
+        renderer_submit_commands(r, &packet->commands, prepassed ? r->pass->shade : r->pass->scene, false);
+        if (periphery)
+            foveation_composite(r->foveation, &r->offscreen, r->depth);
+    }
+    if (r->depth && !r->oit)
+    {
+        // After a pre-pass: the characters weren't in it. Translucent, they leave the depth alone like the scene.
+        gl_state_depth_func(r->depth_func);
+        gl_state_depth_mask(true);
+    }
+    if (r->characters)
+        renderer_draw_characters(r, packet, identity_draw_offset);
+    if (r->measure_overdraw)
+        overdraw_end(&r->overdraw);
+    if (r->overdraw_view)
+        gl_state_enable(GL_BLEND, false);
+    if (oit)
+    {
+        gpu_profiler_push(&r->profiler, "oit resolve");
+        oit_resolve(r->oit);
+        gpu_profiler_pop(&r->profiler);
+        gl_state_depth_mask(true);      // for the next frame's clear
+    }
+    if (deferred)
+    {
+        // Blended particles go over the shaded result, unlit
+        gpu_profiler_push(&r->profiler, "resolve");
+        lighting_gbuffer_resolve(r->lighting, camera->inverse_view_projection);
+        gpu_profiler_pop(&r->profiler);
+    }
+    if (r->particles)
+        renderer_draw_particles(r, packet, identity_draw_offset);
+    if (r->hud_visible)
+        hud_scene_end(&r->hud);
+    if (r->foveation && r->foveation->rate_image)
+        foveation_shade_end(r->foveation);
+    gpu_profiler_pop(&r->profiler);
+    if (r->samples > 1)
+    {
+        gpu_profiler_push(&r->profiler, "msaa resolve");
+        render_target_resolve(&r->offscreen, r->render_width, r->render_height);
+        gpu_profiler_pop(&r->profiler);
+    }
+    if (r->taa)
+    {
+        gpu_profiler_push(&r->profiler, "taa");
+        temporal_aa_resolve(r->taa, &r->offscreen, r->render_width, r->render_height);
+        gpu_profiler_pop(&r->profiler);
+        gl_state_enable(GL_DEPTH_TEST, true);   // --taa implies --depth
+    }
+    if (r->foveation && r->foveation->mode == FOVEATION_ADAPTIVE)
+    {
+        // Next frame's rates from this one
+        gpu_profiler_push(&r->profiler, "vrs rates");
+        foveation_update(r->foveation, r->offscreen.color, r->taa ? r->taa->motion : 0);
+        gpu_profiler_pop(&r->profiler);
+    }
+    if (r->volume)
+        renderer_draw_volume(r, camera);
+    if (r->post)
+        renderer_post_process(r);
+    if (r->shapes || r->ui)
+        renderer_draw_shapes(r, packet);
+    if (r->series_count)
+        renderer_draw_series(r, packet);
+    if (r->label_count)
+        renderer_update_labels(r, camera, models, packet->visible_count);
+    stream_buffer_end_frame(&r->uniform_stream);
+    ++r->frames_drawn;
+    r->objects_drawn += (unsigned long long)packet->visible_count;
+}
+
+// --capture: appends the frame just drawn, as the renderer was given it. "models" and "materials" are what
+// renderer_draw read (single-threaded and instanced, that's the mapped stream: slow to read back, but this
+// only runs while capturing).
+static void renderer_capture(Renderer* r, const FramePacket* packet, const mat3x4* models, const uint32_t* materials)
+{
+    if (!r->capture_path)
+        return;
+    if (!r->capture.file)
+    {
+        FrameCaptureHeader header;
+        memset(&header, 0, sizeof(header));
+        header.view_size = sizeof(Camera);
+        header.model_size = sizeof(mat3x4);
+        header.mode = (uint32_t)r->draw_mode;
+        header.flags = (r->cull ? CAPTURE_CULL : 0u) | (r->occlusion ? CAPTURE_OCCLUSION : 0u)
+            | (r->reversed_z ? CAPTURE_REVERSED_Z : 0u);
+        header.object_count = (uint32_t)r->object_count;
+        header.material_count = r->materials ? (uint32_t)r->materials->count : 0u;
+        header.width = (uint32_t)packet->camera.width;
+        header.height = (uint32_t)packet->camera.height;
+        if (!frame_capture_create(&r->capture, r->capture_path, &header))
+        {
+            r->capture_path = NULL;     // logged; carry on without
+            return;
+        }
+    }
+    FrameCaptureFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.frame_index = packet->frame_index;
+    frame.visible_count = (uint32_t)(r->draw_mode == DRAW_MODE_GPU_DRIVEN ? 0 : packet->visible_count);
+    frame.time = packet->time;
+    frame.sim_time = packet->sim_time;
+    frame.delta = packet->delta;
+    if (!frame_capture_write(&r->capture, &frame, &packet->camera, frame.visible_count ? models : NULL,
+        frame.visible_count ? materials : NULL))
+        r->capture_path = NULL;
+}
+
+// The live settings for the next packet, from where the console's writes to them land
+static FrameSettings frame_settings(const RenderConfig* config)
+{
+    FrameSettings s = { config->cull, config->render_scale, config->upload_budget_kb, config->vram_budget_mb };
+    return s;
+}
+
+// --replay: captured frame "frame_index" (the capture loops) as the packet, its arrays straight from the mapping
+static void replay_packet(const FrameCaptureReader* replay, unsigned int frame_index, FramePacket* packet)
+{
+    const FrameCaptureFrame* frame = replay->frames[frame_index % replay->frame_count];
+    packet->time = frame->time;
+    packet->delta = frame->delta;
+    packet->frame_index = frame_index;
+    packet->input_time = 0.0;
+    packet->sim_time = frame->sim_time;
+    memcpy(&packet->camera, frame_capture_view(replay, frame), sizeof(Camera));
+    packet->visible_count = (int)frame->visible_count;
+    memset(packet->lod_counts, 0, sizeof(packet->lod_counts));
+    packet->lod_counts[0] = frame->visible_count;      // captures don't keep the levels
+    packet->impostor_count = 0;
+    packet->models = (mat3x4*)frame_capture_models(replay, frame);     // only ever read
+    packet->materials = (uint32_t*)frame_capture_materials(replay, frame);
+    packet->objects = NULL;
+    packet->pick.pending = false;
+    packet->palettes = NULL;
+    packet->hud = false;
+    packet->screenshot = false;
+}
+
+// Render thread: owns the GL context and submits packets as the main thread publishes them. The blocking
+// glfwSwapBuffers happens here, so vsync no longer stalls event polling or the simulation.
+#define ALLOC_STEADY_FRAMES 120     // --assert-no-allocs: frames of warm-up first (pools filling, first uploads)
+
+// --assert-no-allocs: the main thread's frame work from here until the guard is lifted may not allocate, once warmed up
+static void alloc_frame_begin(const RenderConfig* config, unsigned int frame_index)
+{
+    if (config->assert_no_allocs && frame_index >= ALLOC_STEADY_FRAMES)
+        alloc_tracker_guard(true);
+}
+
+// Lifts the guard and, with --alloc-stats or --assert-no-allocs, counts the frame
+static void alloc_frame_end(const RenderConfig* config)
+{
+    alloc_tracker_guard(false);
+    if (config->alloc_stats || config->assert_no_allocs)
+        alloc_tracker_frame();
+}
+
+static void render_thread_main(Renderer* r, FrameQueue* queue, GLFWwindow* window, const RenderConfig* config)
+{
+    ALLOC_TAG_SCOPE(ALLOC_TAG_RENDER);
+    // Placed before renderer_init starts threads of its own, which take its affinity
+    if (config->render_cpus && !cpu_thread_pin(NULL, config->render_cpus))
+        fprintf(stderr, "Warning: the render thread couldn't be pinned\n");
+    if (config->high_priority && !cpu_thread_raise_priority())
+        fprintf(stderr, "Warning: the render thread's priority couldn't be raised\n");
+    glfwMakeContextCurrent(window);
+    renderer_init(r, window, config);
+    if (config->prewarm && !r->failed)
+        renderer_prewarm(r);
+    if (r->failed)
+    {
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+        glfwPostEmptyEvent();
+    }
+
+    cpu_trace_thread_name("render");
+    while (FramePacket* packet = (FramePacket*)frame_queue_acquire_read(queue))
+    {
+        CPU_TRACE_SCOPE("frame");
+        if (r->redraw)
+            renderer_redraw_packet(r, packet);
+        renderer_apply_settings(r, &packet->settings);
+        renderer_show_hud(r, packet->hud);
+        gpu_profiler_begin_frame(&r->profiler);
+        gpu_profiler_push(&r->profiler, "frame");
+        mat3x4* models = NULL;
+        uint32_t* materials = NULL;
+        uint32_t* objects = NULL;
+        if (renderer_begin_frame(r, packet->camera.width, packet->camera.height, &models, &materials, &objects))
+        {
+            // The packet holds the simulation's copy; the instanced path moves it into the mapped ring
+            if (models && packet->models)
+            {
+                CPU_TRACE_SCOPE("upload");
+                gpu_profiler_push(&r->profiler, "upload");
+                memcpy(models, packet->models, sizeof(mat3x4) * packet->visible_count);
+                if (materials && packet->materials)
+                    memcpy(materials, packet->materials, sizeof(uint32_t) * packet->visible_count);
+                if (objects && packet->objects)
+                    memcpy(objects, packet->objects, sizeof(uint32_t) * packet->visible_count);
+                gpu_profiler_pop(&r->profiler);
+            }
+            renderer_draw(r, packet, models ? models : packet->models, r->materials ? packet->materials : NULL);
+            renderer_capture(r, packet, packet->models, packet->materials);
+        }
+        else if (r->failed)
+        {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+            glfwPostEmptyEvent();   // wake the main thread if it's waiting for events
+        }
+        gpu_profiler_pop(&r->profiler);
+        gpu_profiler_end_frame(&r->profiler);
+
+        // The packet's been consumed: the main thread can refill it during the swap. In low-latency mode it
+        // waits until the frame is out instead, so the next packet's input is sampled as late as possible.
+        const double input_time = packet->input_time;
+        const bool screenshot = packet->screenshot;
+        const bool low_latency = frame_pacer_low_latency(r->pacer);
+        if (!low_latency)
+            frame_queue_release(queue);
+        renderer_present(r, input_time, screenshot);
+        if (low_latency)
+            frame_queue_release(queue);
+        CPU_TRACE_FRAME();
+    }
+
+    if (r->headless && !r->failed)
+        renderer_report(r, config);
+    renderer_destroy(r);
+    glfwMakeContextCurrent(NULL);
+}
+
+#ifdef OPENGLTEST_OPENXR
+// --xr: the runtime's session on the renderer's context, the camera drawing at the headset's size. Without a runtime
+// or a headset the stereo frames stay in the window.
+static void renderer_start_xr(Renderer* r, Camera* camera, float distance)
+{
+    OpenXrPresenter* xr = (OpenXrPresenter*)malloc(sizeof(OpenXrPresenter));
+    int width = 0, height = 0;
+    if (!openxr_presenter_init(xr, GL_DEPTH32F_STENCIL8, &width, &height))     // --depth's
+    {
+        openxr_presenter_destroy(xr);
+        free(xr);
+        fprintf(stderr, "Warning: --xr: nothing to present to; the stereo frames go to the window\n");
+        return;
+    }
+    r->xr = xr;
+    r->xr_metre = distance / RENDER_XR_METRES;
+    camera_set_viewport(camera, width, height);
+}
+
+// The head and eyes where the runtime predicts them for the frame, before anything is culled: the camera's frustum
+// is built around them, with room for the head to turn RENDER_XR_TURN_MARGIN any way until the late latch
+static void renderer_track_xr(Renderer* r, Camera* camera)
+{
+    mat4x4 head;
+    CameraEye eyes[2];
+    if (openxr_presenter_locate(r->xr, r->xr_metre, head, eyes))
+        camera_set_eyes(camera, head, eyes, RENDER_XR_TURN_MARGIN);
+}
+
+// The late latch, just before the draws: the eyes located again with the tracking that came in since the frame was
+// culled, and the frame's stereo block made from them. The head's move is taken relative to the head the camera was
+// built with; the eyes stay as they were when the runtime has nothing newer.
+static void renderer_latch_xr(Renderer* r, Camera* camera)
+{
+    r->xr_drawn = camera->tracked;
+    if (!camera->tracked)
+        return;     // not located yet: the layer goes out empty
+    const float n = camera->near_plane / r->xr_metre, f = camera->far_plane / r->xr_metre;
+    r->xr_depth[0] = camera->reversed_z ? f : n;
+    r->xr_depth[1] = camera->reversed_z ? n : f;
+    mat4x4 head, moved;
+    CameraEye eyes[2];
+    if (!openxr_presenter_locate(r->xr, r->xr_metre, head, eyes))
+        return;
+    mat4x4_invert(moved, camera->head);
+    mat4x4_mul(moved, moved, head);
+    for (int e = 0; e < 2; ++e)
+    {
+        mat4x4 pose;
+        mat4x4_mul(pose, moved, eyes[e].pose);
+        mat4x4_dup(eyes[e].pose, pose);
+        camera_eye_view_projection(camera, &eyes[e], camera->stereo_view_projection[e]);
+    }
+}
+#endif
+
+// The single-threaded loop's state, for single_threaded_frame to pick up where the last pass left off
+typedef struct SingleThreadedLoop
+{
+    Renderer* r;
+    GLFWwindow* window;
+    Scene* scene;
+    JobSystem* jobs;
+    FramePacket* packet;
+    Camera* camera;
+    WindowState* state;
+    const RenderConfig* config;
+    unsigned int frame_index;
+} SingleThreadedLoop;
+
+// One pass of the single-threaded loop. Returns false once the loop is over: the window closed, the benchmark's
+// frames done or the renderer failed.
+static bool single_threaded_frame(SingleThreadedLoop* loop)
+{
+    Renderer* r = loop->r;
+    GLFWwindow* window = loop->window;
+    Scene* scene = loop->scene;
+    JobSystem* jobs = loop->jobs;
+    FramePacket* packet = loop->packet;
+    Camera* camera = loop->camera;
+    WindowState* state = loop->state;
+    const RenderConfig* config = loop->config;
+    if (r->failed || glfwWindowShouldClose(window)
+        || (r->headless && (int)loop->frame_index >= config->headless_frames))
+        return false;
+    ALLOC_TAG_SCOPE(ALLOC_TAG_FRAME);
+    if (state->redraw && !redraw_wanted(state))
+        return true;
+    CPU_TRACE_SCOPE("frame");
+#ifdef OPENGLTEST_OPENXR
+    // --xr: the runtime's frame loop paces this one. Until its session runs there's no frame to draw; a frame it
+    // won't show is ended undrawn
+    if (r->xr)
+    {
+        if (!openxr_presenter_poll(r->xr))
+            return false;
+        if (!openxr_presenter_begin_frame(r->xr))
+        {
+            glfwWaitEventsTimeout(0.1);
+            return true;
+        }
+        if (!openxr_presenter_should_render(r->xr))
+        {
+            openxr_presenter_end_frame(r->xr, 0, 0, 0, 0, 0.f, 0.f);
+            glfwPollEvents();
+            return true;
+        }
+        renderer_track_xr(r, camera);
+    }
+#endif
+    // Low latency: wait out the frame-rate limit first and read input after, right before it's used
+    const bool low_latency = frame_pacer_low_latency(r->pacer) && !r->headless && !r->xr;
+    if (low_latency)
+    {
+        frame_pacer_wait(r->pacer);
+        glfwPollEvents();
+    }
+    packet->time = scene_clock(state, frame_smoother_step(state->smoother, glfwGetTime(), &packet->delta), &packet->delta);
+    packet->frame_index = loop->frame_index;
+    packet->input_time = process_input(state, window, camera, r->headless || r->xr);
+    if (config->wall && !wall_share_frame(config->wall, &packet->time, &packet->delta, camera, &state->hud))
+        glfwSetWindowShouldClose(window, GLFW_TRUE);    // the leader has gone
+    packet->camera = *camera;
+    packet->screenshot = state->screenshot;
+    state->screenshot = false;
+    pick_if_requested(state, window, scene, camera, &packet->pick);
+    if (state->redraw)
+    {
+        redraw_frame(state, packet);
+        renderer_redraw_packet(r, packet);
+    }
+
+    packet->settings = frame_settings(config);
+    renderer_apply_settings(r, &packet->settings);
+    renderer_show_hud(r, state->hud);
+    gpu_profiler_begin_frame(&r->profiler);
+    gpu_profiler_push(&r->profiler, "frame");
+    gpu_profiler_push(&r->profiler, "tick");
+    if (config->scene_reload)
+        scene_reload_poll(config->scene_reload, scene);
+    alloc_frame_begin(config, loop->frame_index);     // around the CPU work only: the driver allocates as it likes
+    CullSelector* selector = config->cull_selector;
+    packet->gpu_cull = selector && cull_selector_next(selector) == CULL_PATH_GPU;
+    double cull_start = frame_pacer_now();
+    scene_simulate(scene, jobs, packet->delta,
+        config->draw_mode != DRAW_MODE_GPU_DRIVEN && !config->gpu_animate && !packet->gpu_cull);
+    double cull_seconds = frame_pacer_now() - cull_start;
+    alloc_tracker_guard(false);
+    packet->sim_time = fixed_timestep_time(&scene->step);
+    gpu_profiler_pop(&r->profiler);
+    mat3x4* models = NULL;
+    uint32_t* materials = NULL;
+    uint32_t* objects = NULL;
+    if (renderer_begin_frame(r, packet->camera.width, packet->camera.height, &models, &materials, &objects))
+    {
+        // Model matrices for every object: scale + rotate_Z (between the last two ticks) + grid offset, written in
+        // one batched pass straight into this frame's region of the mapped instance buffer (or the frame arena, for
+        // the naive path). Material indices go alongside.
+        if (!models && config->draw_mode == DRAW_MODE_NAIVE)
+        {
+            models = packet->models = (mat3x4*)frame_arena_alloc(&packet->arena, sizeof(mat3x4) * scene->count);
+            if (r->materials)
+                materials = (uint32_t*)frame_arena_alloc(&packet->arena, sizeof(uint32_t) * scene->count);
+        }
+        gpu_profiler_push(&r->profiler, "simulate");
+        alloc_frame_begin(config, loop->frame_index);
+        cull_start = frame_pacer_now();
+        packet->visible_count = config->draw_mode == DRAW_MODE_GPU_DRIVEN || packet->gpu_cull ? 0
+            : config->gpu_animate ? scene_gpu_animated(scene, packet->lod_counts)
+            : scene_update(scene, jobs, &packet->arena, config->cull ? &camera->frustum : NULL, camera, models, materials,
+                objects, packet->lod_counts, &packet->impostor_count);
+        cull_seconds += frame_pacer_now() - cull_start;
+        if (selector && !packet->gpu_cull)
+            cull_selector_cost(selector, CULL_PATH_CPU, 1000.0 * cull_seconds);
+        if (config->draw_mode == DRAW_MODE_NAIVE)
+        {
+            packet->materials = materials;
+            scene_record_draws(packet, jobs, scene->coherent != NULL);
+        }
+        alloc_tracker_guard(false);
+        gpu_profiler_pop(&r->profiler);
+        if (config->characters && !config->characters->baked)
+        {
+            gpu_profiler_push(&r->profiler, "animate");
+            packet->palettes = (mat3x4*)frame_arena_alloc(&packet->arena,
+                sizeof(mat3x4) * CHARACTER_JOINTS * config->characters->count);
+            characters_pose(config->characters, jobs, packet->time, packet->palettes);
+            gpu_profiler_pop(&r->profiler);
+        }
+#ifdef OPENGLTEST_OPENXR
+        if (r->xr)
+            renderer_latch_xr(r, &packet->camera);
+#endif
+        renderer_draw(r, packet, models, materials);
+        renderer_capture(r, packet, models, materials);
+        ++loop->frame_index;
+    }
+    else if (r->failed)
+        return false;
+    gpu_profiler_pop(&r->profiler);
+    gpu_profiler_end_frame(&r->profiler);
+
+    renderer_present(r, packet->input_time, packet->screenshot);
+    frame_arena_reset(&packet->arena);  // the frame is with the GPU now; nothing of it is needed on the CPU
+    if (!low_latency)
+    {
+        CPU_TRACE_SCOPE("poll");
+        glfwPollEvents();       // process all pending events in the event queue (inputs, e.g.)
+    }
+    if (!r->headless)
+        show_latency(state, window);
+    alloc_frame_end(config);
+    CPU_TRACE_FRAME();
+    return true;
+}
+
+static void single_threaded_finish(SingleThreadedLoop* loop)
+{
+    if (loop->r->headless && !loop->r->failed)
+        renderer_report(loop->r, loop->config);
+    renderer_destroy(loop->r);
+}
+
+// Single-threaded loop: simulate, submit and swap in turn on the main thread (--single-thread)
+static void run_single_threaded(Renderer* r, GLFWwindow* window, Scene* scene, JobSystem* jobs, FramePacket* packet,
+    Camera* camera, WindowState* state, const RenderConfig* config)
+{
+    glfwMakeContextCurrent(window);     // Sets the context for OpenGL to draw
+    renderer_init(r, window, config);
+    if (config->prewarm && !r->failed)
+        renderer_prewarm(r);
+    r->late_limiter = true;
+#ifdef OPENGLTEST_OPENXR
+    if (config->xr && !r->failed && state->controller)
+        renderer_start_xr(r, camera, state->controller->distance);
+#endif
+
+    SingleThreadedLoop loop = { r, window, scene, jobs, packet, camera, state, config, 0 };
+    while (single_threaded_frame(&loop))
+        ;
+    single_threaded_finish(&loop);
+}
+
+#ifdef OPENGLTEST_VULKAN
+// --vulkan: the same simulation and culling as the loops above, drawn by vk/vulkan_renderer.h. It runs on the main
+// thread, the job system's thread 0, so the command buffers can be recorded across the whole pool; scene_update
+// writes the model matrices straight into the frame's mapped instance buffer. Where the device has ray queries
+// (unless "ray_query" is off) clicks are traced against the frame's acceleration structure and answered a few
+// frames later, and "ray_shadows" traces the ground's shadows; otherwise clicks go through the BVH. With
+// "async_compute" the acceleration structure's passes run on an async compute queue where there is one.
+static bool run_vulkan(GLFWwindow* window, Scene* scene, JobSystem* jobs, FramePacket* packet, Camera* camera,
+    WindowState* state, const RenderConfig* config, bool vsync, bool ray_query, bool ray_shadows, bool async_compute)
+{
+    const bool headless = config->headless_frames > 0;
+    VulkanRendererDesc desc = { vertices, sizeof(Vertex), 3, indices, 3, (uint32_t)scene->count,
+        config->draw_mode == DRAW_MODE_NAIVE, vsync && !headless, ray_query, ray_shadows, -scene->scale,
+        async_compute };
+    VulkanRenderer r;
+    bool ready;
+    {
+        STARTUP_SCOPE("vulkan_renderer_init");
+        ready = vulkan_renderer_init(&r, window, jobs, &desc);
+    }
+    if (!ready)
+    {
+        vulkan_renderer_destroy(&r);
+        return false;
+    }
+
+    ALLOC_TAG_SCOPE(ALLOC_TAG_FRAME);
+    unsigned int frame_index = 0;
+    while (!r.failed && !glfwWindowShouldClose(window) && (!headless || (int)frame_index < config->headless_frames))
+    {
+        CPU_TRACE_SCOPE("frame");
+        const double now = frame_smoother_step(state->smoother, glfwGetTime(), &packet->delta);
+        packet->time = now;
+        packet->frame_index = frame_index;
+        packet->input_time = process_input(state, window, camera, headless);
+        scene_simulate(scene, jobs, packet->delta, true);
+        if (mat3x4* models = vulkan_renderer_begin_frame(&r))
+        {
+            packet->visible_count = scene_update(scene, jobs, &packet->arena, config->cull ? &camera->frustum : NULL, camera,
+                models, NULL, vulkan_renderer_objects(&r), packet->lod_counts, NULL);
+            int width = 0, height = 0;
+            glfwGetWindowSize(window, &width, &height);
+            if (r.ray_query && state->pick.pending && width > 0 && height > 0)
+            {
+                vec3 origin, dir;
+                camera_pick_ray(camera, state->pick.x, state->pick.y, width, height, origin, dir);
+                vulkan_renderer_pick(&r, origin, dir);
+                state->pick.pending = false;
+            }
+            else
+            {
+                PickRequest unused;
+                pick_if_requested(state, window, scene, camera, &unused);
+            }
+            if (!headless)
+                frame_pacer_wait(config->pacer);
+            vulkan_renderer_draw(&r, jobs, camera->view_projection, camera->inverse_view_projection,
+                packet->visible_count);
+            int picked = -1;
+            unsigned int latency = 0;
+            if (vulkan_renderer_poll_pick(&r, &picked, &latency))
+                printf("picked object %d (ray query, %u frames later)\n", picked, latency);
+            if (!frame_index && startup_profile_first_frame() >= 0.0)
+            {
+                if (config->startup)
+                    startup_profile_print(stdout);
+                startup_profile_trace();
+            }
+            frame_pacer_frame_done(config->pacer);
+            frame_pacer_input_presented(config->pacer, packet->input_time);
+            ++frame_index;
+        }
+        else if (!r.failed)
+            glfwWaitEventsTimeout(0.01);    // minimised: nothing to draw into
+        frame_arena_reset(&packet->arena);
+        {
+            CPU_TRACE_SCOPE("poll");
+            glfwPollEvents();
+        }
+        if (!headless)
+            show_latency(state, window);
+        alloc_frame_end(config);
+        CPU_TRACE_FRAME();
+    }
+
+    const bool ok = !r.failed;
+    if (headless && ok)
+        vulkan_renderer_report(&r, scene->count, stdout);
+    vulkan_renderer_destroy(&r);
+    return ok;
+}
+#endif
+
+// --software: the same simulation and culling again, drawn on the CPU by core/software_renderer.h across the job
+// system, for nodes with no GPU. It runs headless only, on GLFW's null platform; scene_update writes the model
+// matrices straight into the renderer's buffer, and clicks, with no window to click, aren't asked for.
+static bool run_software(GLFWwindow* window, Scene* scene, JobSystem* jobs, FramePacket* packet, Camera* camera,
+    WindowState* state, const RenderConfig* config)
+{
+    const SoftwareRendererDesc desc = { vertices, sizeof(Vertex), 3, indices, 3, (uint32_t)scene->count, config->width,
+        config->height };
+    SoftwareRenderer r;
+    bool ready;
+    {
+        STARTUP_SCOPE("software_renderer_init");
+        ready = software_renderer_init(&r, jobs, &desc);
+    }
+    if (!ready)
+        return false;
+
+    ALLOC_TAG_SCOPE(ALLOC_TAG_FRAME);
+    for (unsigned int frame_index = 0; !glfwWindowShouldClose(window) && (int)frame_index < config->headless_frames;
+        ++frame_index)
+    {
+        CPU_TRACE_SCOPE("frame");
+        packet->time = frame_smoother_step(state->smoother, glfwGetTime(), &packet->delta);
+        packet->frame_index = frame_index;
+        packet->input_time = process_input(state, window, camera, true);
+        scene_simulate(scene, jobs, packet->delta, true);
+        packet->visible_count = scene_update(scene, jobs, &packet->arena, config->cull ? &camera->frustum : NULL,
+            camera, software_renderer_begin_frame(&r), NULL, NULL, packet->lod_counts, NULL);
+        {
+            CPU_TRACE_SCOPE("software");
+            software_renderer_draw(&r, jobs, camera->view_projection, camera->reversed_z, packet->visible_count);
+        }
+        if (!frame_index && startup_profile_first_frame() >= 0.0)
+        {
+            if (config->startup)
+                startup_profile_print(stdout);
+            startup_profile_trace();
+        }
+        frame_pacer_frame_done(config->pacer);
+        frame_arena_reset(&packet->arena);
+        glfwPollEvents();
+        alloc_frame_end(config);
+        CPU_TRACE_FRAME();
+    }
+
+    software_renderer_report(&r, scene->count, stdout);
+    software_renderer_destroy(&r);
+    return true;
+}
+
+// --bench-submit N: the built-in triangle, N copies on the scene's grid, turning as the demo's did, drawn with each
+// way of submitting them in turn: a Draw block and a glDrawElements per object (the naive path), one instanced draw,
+// one glMultiDrawElementsIndirect of N commands a copy each, and the GPU-driven cull and indirect draw. Every way
+// draws with the scene shaders' base or INSTANCED variant into the same offscreen target, and the CPU's turn their
+// copies with scene_simulate and scene_update on one thread, so the CPU time is what the strategy costs per object
+// and not the job system's spread. Each strategy's frames end in a glFinish, so they don't overlap each other's.
+#define SUBMIT_BENCH_WARMUP 20      // frames a strategy runs before it's timed: programs linked, buffers settled
+#define SUBMIT_BENCH_FRAMES 200     // then timed
+#define SUBMIT_BENCH_SIZE 1024      // the offscreen target's side in pixels
+
+typedef enum SubmitStrategy
+{
+    SUBMIT_NAIVE,
+    SUBMIT_INSTANCED,
+    SUBMIT_MULTI_DRAW,      // 4.3+
+    SUBMIT_GPU_DRIVEN,      // 4.3+
+    SUBMIT_STRATEGY_COUNT
+} SubmitStrategy;
+
+static const char* const submit_strategy_names[SUBMIT_STRATEGY_COUNT] = { "naive", "instanced", "multi-draw",
+    "gpu-driven" };
+
+// One frame of "strategy": the objects turned and drawn. The VAO and the target are bound.
+static void submit_benchmark_frame(SubmitStrategy strategy, Scene* scene, JobSystem* jobs, FrameArena* arena,
+    const GpuMesh* mesh, const GLuint* programs, StreamBuffer* uniform_stream, StreamBuffer* instance_stream,
+    mat3x4* models, GLintptr* draw_offsets, GLuint commands, GpuCulling* culling)
+{
+    const int n = scene->count;
+    scene_simulate(scene, jobs, 1.0 / 60.0, strategy != SUBMIT_GPU_DRIVEN);
+    stream_buffer_begin_frame(uniform_stream);
+    GLintptr frame_offset = 0;
+    FrameUniforms* frame = (FrameUniforms*)uniforms_alloc(uniform_stream, sizeof(FrameUniforms), &frame_offset);
+    const float t = (float)fixed_timestep_time(&scene->step);
+    frame->time[0] = frame->time[3] = t;
+    frame->time[1] = 1.f / 60.f;
+    frame->time[2] = 0.f;
+    uint32_t lod_counts[LOD_MAX_LEVELS];
+    if (strategy == SUBMIT_NAIVE)
+    {
+        // As the renderer's naive path: every object's Draw block written, then a range bound and a draw per object
+        scene_update(scene, jobs, arena, NULL, NULL, models, NULL, NULL, lod_counts, NULL);
+        for (int i = 0; i < n; ++i)
+        {
+            DrawUniforms* draw = (DrawUniforms*)uniforms_alloc(uniform_stream, sizeof(DrawUniforms), &draw_offsets[i]);
+            mat4x4_from_mat3x4(draw->model, models[i]);
+        }
+        stream_buffer_commit(uniform_stream);
+        uniforms_bind_range(uniform_stream, UNIFORMS_BINDING_FRAME, frame_offset, sizeof(FrameUniforms));
+        gl_state_use_program(programs[0]);
+        for (int i = 0; i < n; ++i)
+        {
+            uniforms_bind_range(uniform_stream, UNIFORMS_BINDING_DRAW, draw_offsets[i], sizeof(DrawUniforms));
+            gpu_mesh_draw(mesh);
+        }
+        stream_buffer_end_frame(uniform_stream);
+        return;
+    }
+
+    // The rest draw the INSTANCED variant under one identity Draw block
+    GLintptr draw_offset = 0;
+    DrawUniforms* draw = (DrawUniforms*)uniforms_alloc(uniform_stream, sizeof(DrawUniforms), &draw_offset);
+    mat4x4_identity(draw->model);
+    stream_buffer_commit(uniform_stream);
+    uniforms_bind_range(uniform_stream, UNIFORMS_BINDING_FRAME, frame_offset, sizeof(FrameUniforms));
+    uniforms_bind_range(uniform_stream, UNIFORMS_BINDING_DRAW, draw_offset, sizeof(DrawUniforms));
+    if (strategy == SUBMIT_GPU_DRIVEN)
+    {
+        gpu_culling_dispatch(culling, mesh, NULL, t, GPU_CULL_FRUSTUM, NULL);
+        gl_state_use_program(programs[1]);
+        gl_state_bind_buffer(GL_ARRAY_BUFFER, culling->instance_buffer);
+        set_instance_attribs(vmodel_location, 0);
+        gpu_culling_draw(culling, mesh, GPU_CULL_FRUSTUM);
+        stream_buffer_end_frame(uniform_stream);
+        return;
+    }
+    stream_buffer_begin_frame(instance_stream);
+    GLintptr instance_offset = 0;
+    mat3x4* instances = (mat3x4*)stream_buffer_alloc(instance_stream, sizeof(mat3x4) * n, 64, &instance_offset);
+    scene_update(scene, jobs, arena, NULL, NULL, instances, NULL, NULL, lod_counts, NULL);
+    stream_buffer_commit(instance_stream);
+    gl_state_use_program(programs[1]);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, instance_stream->buffer);
+    set_instance_attribs(vmodel_location, instance_offset);
+    if (strategy == SUBMIT_INSTANCED)
+        gpu_mesh_draw_instanced(mesh, n);
+    else
+    {
+        // Command i draws the one instance i: base_instance picks its matrix
+        gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, commands);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, mesh->index_type, NULL, n, 0);
+        draw_counters_indirect(n);
+        gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    stream_buffer_end_frame(instance_stream);
+    stream_buffer_end_frame(uniform_stream);
+}
+
+// Needs a current context. Reports each strategy to "out"; those a 3.3 context doesn't have are skipped. Returns
+// false when a program fails to build or GL reports an error.
+static bool submit_benchmark(int objects, FILE* out)
+{
+    if (!GLAD_GL_VERSION_3_3)
+    {
+        fprintf(stderr, "--bench-submit: needs desktop GL, for its timer queries\n");
+        return false;
+    }
+    const bool gl_4_3 = GLAD_GL_VERSION_4_3 != 0;
+    Scene scene;
+    scene_init(&scene, objects, 60.0);
+    JobSystem jobs;
+    job_system_init(&jobs, 1);
+    FrameArena arena;
+    frame_arena_init(&arena, FRAME_ARENA_ALIGN, jobs.thread_count, SCENE_UPDATE_SCRATCH);
+    mat3x4* models = (mat3x4*)malloc(sizeof(mat3x4) * objects);
+    GLintptr* draw_offsets = (GLintptr*)malloc(sizeof(GLintptr) * objects);
+
+    // The triangle as the renderer loads it, packed, with the instance attributes beside it
+    GLuint vertex_array = 0;
+    glGenVertexArrays(1, &vertex_array);
+    gl_state_bind_vertex_array(vertex_array);
+    VertexFormat format;
+    void* packed = renderer_pack_builtin_vertices<PackedVertex>(vertices, sizeof(vertices) / sizeof(vertices[0]),
+        &format);
+    GpuMesh mesh;
+    gpu_mesh_init(&mesh, packed, format.stride, sizeof(vertices) / sizeof(vertices[0]), indices,
+        sizeof(indices) / sizeof(indices[0]));
+    free(packed);
+    vertex_layout_attach<PackedVertex>(NULL, mesh.vertex_buffer);
+    for (int row = 0; row < 3; ++row)
+    {
+        glVertexAttribDivisor(vmodel_location + row, 1);
+        glEnableVertexAttribArray(vmodel_location + row);
+    }
+
+    // The scene shaders' base variant, and the INSTANCED one the others draw with
+    ShaderPermutation shaders;
+    scene_shaders_init(&shaders);
+    GLuint programs[2] = {};
+    const uint64_t keys[2] = { 0, SCENE_FEATURE_INSTANCED };
+    bool ok = models && draw_offsets;
+    for (int v = 0; v < 2; ++v)
+    {
+        char* vertex_source = shader_permutation_compose(&shaders, 0, vertex_shader_text, keys[v]);
+        char* fragment_source = shader_permutation_compose(&shaders, 1, fragment_shader_text, keys[v]);
+        programs[v] = vertex_source && fragment_source ? program_build(vertex_source, fragment_source, false) : 0;
+        free(vertex_source);
+        free(fragment_source);
+        if (programs[v])
+            uniforms_bind_blocks(programs[v]);
+        ok = programs[v] && ok;
+    }
+    shader_permutation_destroy(&shaders);
+
+    // The whole grid is in view: an identity camera over [-1, 1]
+    CameraUniforms camera;
+    mat4x4_identity(camera.view);
+    mat4x4_identity(camera.projection);
+    mat4x4_identity(camera.view_projection);
+    camera.viewport[0] = camera.viewport[1] = 0.f;
+    camera.viewport[2] = camera.viewport[3] = (float)SUBMIT_BENCH_SIZE;
+    GLuint camera_buffer = 0;
+    glGenBuffers(1, &camera_buffer);
+    gl_state_bind_buffer(GL_UNIFORM_BUFFER, camera_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(camera), &camera, GL_STATIC_DRAW);
+    gl_state_bind_buffer_base(GL_UNIFORM_BUFFER, UNIFORMS_BINDING_CAMERA, camera_buffer);
+    StreamBuffer uniform_stream, instance_stream;
+    stream_buffer_init(&uniform_stream, GL_UNIFORM_BUFFER, uniforms_block_stride(sizeof(FrameUniforms))
+        + uniforms_block_stride(sizeof(DrawUniforms)) * objects);
+    stream_buffer_init(&instance_stream, GL_ARRAY_BUFFER, sizeof(mat3x4) * objects + 64);
+
+    // Multi-draw's commands don't change: one per object, its instance's matrix by base_instance
+    GLuint commands = 0;
+    GpuCulling culling;
+    memset(&culling, 0, sizeof(culling));
+    bool culling_ready = false;
+    if (gl_4_3)
+    {
+        DrawElementsIndirectCommand* list = (DrawElementsIndirectCommand*)malloc(
+            sizeof(DrawElementsIndirectCommand) * objects);
+        for (int i = 0; list && i < objects; ++i)
+            list[i] = { (GLuint)mesh.index_count, 1, 0, 0, (GLuint)i };
+        glGenBuffers(1, &commands);
+        gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, commands);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * objects, list, GL_STATIC_DRAW);
+        gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        ok = list && ok;
+        free(list);
+        culling_ready = gpu_culling_init(&culling, scene.pos_x, scene.pos_y, scene.phase, scene.radius,
+            (uint32_t)objects, scene.scale, 0);
+        ok = culling_ready && ok;
+    }
+
+    RenderTarget target;
+    ok = render_target_init(&target, SUBMIT_BENCH_SIZE, SUBMIT_BENCH_SIZE, GL_RGBA8, false, 1) && ok;
+    render_target_bind(&target);
+    gl_state_viewport(0, 0, SUBMIT_BENCH_SIZE, SUBMIT_BENCH_SIZE);
+    gl_state_bind_vertex_array(vertex_array);
+    GLuint query = 0;
+    glGenQueries(1, &query);
+
+    fprintf(out, "submission: %d triangles at %dx%d, %d frames each after %d to warm up; CPU on one thread\n",
+        objects, SUBMIT_BENCH_SIZE, SUBMIT_BENCH_SIZE, SUBMIT_BENCH_FRAMES, SUBMIT_BENCH_WARMUP);
+    fprintf(out, "  %-10s %9s %13s %9s %13s %12s\n", "strategy", "cpu ms", "cpu ms / 10k", "gpu ms", "draws/s",
+        "calls/frame");
+    for (int s = 0; s < SUBMIT_STRATEGY_COUNT && ok; ++s)
+    {
+        const SubmitStrategy strategy = (SubmitStrategy)s;
+        if (!gl_4_3 && (strategy == SUBMIT_MULTI_DRAW || strategy == SUBMIT_GPU_DRIVEN))
+        {
+            fprintf(out, "  %-10s needs a 4.3 context, skipped\n", submit_strategy_names[s]);
+            continue;
+        }
+        double cpu_seconds = 0.0, wall_seconds = 0.0;
+        GLuint64 gpu_ns = 0;
+        DrawCounters before, after, submitted_calls;
+        for (int f = 0; f < SUBMIT_BENCH_WARMUP + SUBMIT_BENCH_FRAMES; ++f)
+        {
+            const bool timed = f >= SUBMIT_BENCH_WARMUP;
+            if (f == SUBMIT_BENCH_WARMUP)
+                draw_counters_read(&before);
+            const double start = frame_pacer_now();
+            if (timed)
+                glBeginQuery(GL_TIME_ELAPSED, query);
+            glClear(GL_COLOR_BUFFER_BIT);
+            submit_benchmark_frame(strategy, &scene, &jobs, &arena, &mesh, programs, &uniform_stream,
+                &instance_stream, models, draw_offsets, commands, &culling);
+            if (timed)
+                glEndQuery(GL_TIME_ELAPSED);
+            const double submitted = frame_pacer_now();
+            glFinish();
+            if (!timed)
+                continue;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            gpu_ns += elapsed;
+            cpu_seconds += submitted - start;
+            wall_seconds += frame_pacer_now() - start;
+        }
+        draw_counters_read(&after);
+        draw_counters_difference(&submitted_calls, &before, &after);
+        const double cpu_ms = 1000.0 * cpu_seconds / SUBMIT_BENCH_FRAMES;
+        // The draws and dispatches, and the state calls gl_state let through: the naive path's per-object
+        // range binds among them. Uniforms, barriers and the clear aren't counted.
+        const double calls = (double)(submitted_calls.calls + submitted_calls.state_changes) / SUBMIT_BENCH_FRAMES;
+        fprintf(out, "  %-10s %9.3f %13.4f %9.3f %12.3gM %12.0f\n", submit_strategy_names[s], cpu_ms,
+            cpu_ms * 10000.0 / objects, (double)gpu_ns * 1e-6 / SUBMIT_BENCH_FRAMES,
+            wall_seconds > 0.0 ? 1e-6 * objects * SUBMIT_BENCH_FRAMES / wall_seconds : 0.0, calls);
+    }
+    const GLenum error = glGetError();
+    if (error != GL_NO_ERROR)
+        fprintf(stderr, "--bench-submit: GL error 0x%04x\n", error);
+    ok = ok && error == GL_NO_ERROR;
+
+    glDeleteQueries(1, &query);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, 0);
+    render_target_destroy(&target);
+    if (culling_ready)
+        gpu_culling_destroy(&culling);
+    gl_state_delete_buffers(1, &commands);
+    stream_buffer_destroy(&instance_stream);
+    stream_buffer_destroy(&uniform_stream);
+    gl_state_delete_buffers(1, &camera_buffer);
+    for (int v = 0; v < 2; ++v)
+    {
+        if (programs[v])
+            glDeleteProgram(programs[v]);
+    }
+    gpu_mesh_destroy(&mesh);
+    gl_state_delete_vertex_arrays(1, &vertex_array);
+    free(models);
+    free(draw_offsets);
+    frame_arena_destroy(&arena);
+    job_system_destroy(&jobs);
+    scene_free(&scene);
+    return ok;
+}
+
+// Error callback function for GLFW. Errors can be raised on the render thread too, so unlike input they
+// aren't queued: stderr is safe to write from any thread.
+static void error_callback(int error, const char* description)
+{
+    fprintf(stderr, "Error: %s\n", description);
+    const float code[4] = { (float)error, 0.f, 0.f, 0.f };
+    telemetry_record(TELEMETRY_ERROR, 0, code, description);
+}
+
+// Every input callback below just timestamps the event and queues it for process_input. GLFW runs them
+// inside glfwPollEvents, so the main thread is the queue's only producer.
+static void push_input(GLFWwindow* window, InputEventType type, int code, int action, int mods, double x, double y)
+{
+    WindowState* state = (WindowState*)glfwGetWindowUserPointer(window);
+    if (!state)
+        return;
+    const InputEvent event = { frame_pacer_now(), type, code, action, mods, x, y };    // GLFW events carry no timestamp
+    input_queue_push(&state->input, &event);
+}
+
+static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+    double x = 0.0, y = 0.0;
+    glfwGetCursorPos(window, &x, &y);
+    push_input(window, INPUT_EVENT_MOUSE_BUTTON, button, action, mods, x, y);
+}
+
+static void scroll_callback(GLFWwindow* window, double x, double y)
+{
+    push_input(window, INPUT_EVENT_SCROLL, 0, 0, 0, x, y);
+}
+
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    push_input(window, INPUT_EVENT_RESIZE, 0, 0, 0, width, height);
+}
+
+static void window_focus_callback(GLFWwindow* window, int focused)
+{
+    push_input(window, INPUT_EVENT_FOCUS, 0, focused, 0, 0.0, 0.0);
+}
+
+static void cursor_position_callback(GLFWwindow* window, double x, double y)
+{
+    push_input(window, INPUT_EVENT_CURSOR, 0, 0, 0, x, y);
+}
+
+// --on-demand: the window system lost what the window showed (uncovered, restored) and needs it drawn again
+static void window_refresh_callback(GLFWwindow* window)
+{
+    WindowState* state = (WindowState*)glfwGetWindowUserPointer(window);
+    if (state && state->redraw)
+        redraw_policy_request(state->redraw, REDRAW_INPUT);
+}
+
+// The camera controller's codes are GLFW's
+static_assert(CAMERA_KEY_RIGHT == GLFW_KEY_RIGHT && CAMERA_KEY_LEFT == GLFW_KEY_LEFT && CAMERA_KEY_DOWN == GLFW_KEY_DOWN
+    && CAMERA_KEY_UP == GLFW_KEY_UP && CAMERA_KEY_PAGE_UP == GLFW_KEY_PAGE_UP
+    && CAMERA_KEY_PAGE_DOWN == GLFW_KEY_PAGE_DOWN && CAMERA_BUTTON_RIGHT == GLFW_MOUSE_BUTTON_RIGHT
+    && CAMERA_PRESS == GLFW_PRESS && CAMERA_RELEASE == GLFW_RELEASE, "camera controller codes differ from GLFW's");
+
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    push_input(window, INPUT_EVENT_KEY, key, action, mods, 0.0, 0.0);
+}
+
+// Closing any window of a wall closes the application
+static void window_close_callback(GLFWwindow* window)
+{
+    if (WindowState* state = (WindowState*)glfwGetWindowUserPointer(window))
+        glfwSetWindowShouldClose(state->windows[0], GLFW_TRUE);
+}
+
+// The features that need a 4.3 context left out, each that was asked for with a warning saying "why"; the
+// clustered lights too unless "keep_lights" (ES 3.1 has what they need)
+static void config_without_4_3(RenderConfig* config, const char* why, bool keep_lights)
+{
+    if (config->draw_mode == DRAW_MODE_GPU_DRIVEN)
+        fprintf(stderr, "Warning: %s, --gpu-driven falls back to instancing\n", why);
+    if (config->particle_count > 0)
+        fprintf(stderr, "Warning: %s, --particles is left out\n", why);
+    if (config->character_count > 0)
+        fprintf(stderr, "Warning: %s, --characters is left out\n", why);
+    if (config->light_count > 0 && !keep_lights)
+        fprintf(stderr, "Warning: %s, --lights is left out\n", why);
+    if (config->point_count > 0)
+        fprintf(stderr, "Warning: %s, --points is left out\n", why);
+    if (config->gpu_animate)
+        fprintf(stderr, "Warning: %s, --gpu-animate falls back to the CPU's matrices\n", why);
+    if (config->pull)
+        fprintf(stderr, "Warning: %s, --pull falls back to vertex attributes\n", why);
+    if (config->oit)
+        fprintf(stderr, "Warning: %s, --oit is left out and the scene drawn opaque\n", why);
+    if (config->terrain_size > 0.f && config->terrain_tessellation)
+        fprintf(stderr, "Warning: %s, --terrain tessellates only where GL_ARB_tessellation_shader is there\n", why);
+    if (config->shadows)
+        fprintf(stderr, "Warning: %s, --shadows is left out\n", why);
+    if (config->volume_side > 0 || config->volume_path)
+        fprintf(stderr, "Warning: %s, --volume is left out\n", why);
+    if (config->cull_selector)
+        fprintf(stderr, "Warning: %s, --cull-select culls on the CPU only\n", why);
+    config->draw_mode = config->draw_mode == DRAW_MODE_GPU_DRIVEN ? DRAW_MODE_INSTANCED : config->draw_mode;
+    config->meshlets = false;
+    config->particle_count = 0;
+    config->character_count = 0;
+    config->point_count = 0;
+    config->gpu_animate = config->pull = false;
+    config->cull_selector = NULL;
+    config->oit = OIT_OFF;
+    config->shadows = 0;
+    config->volume_side = 0;
+    config->volume_path = NULL;
+    if (!keep_lights)
+    {
+        config->light_count = 0;
+        config->deferred = false;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // Command line: --objects N (number of triangles), --naive (one draw call per object),
+    // --single-thread (simulate and render on the main thread), --jobs N (simulation threads),
+    // --profile / --profile-csv FILE (per-pass CPU and GPU timings, draws, triangles, uploads and state changes),
+    // --pipeline-stats (per-pass shader invocations and clipped primitives, from pipeline statistics queries),
+    // --gpu-counters NAMES|default|list (per-pass hardware counters whose names contain one of the comma-separated
+    // NAMES, through GL_INTEL_performance_query / GL_AMD_performance_monitor; needs -DOPENGLTEST_GPU_COUNTERS=ON),
+    // --headless N [--size WxH] [--egl] (offscreen benchmark of N frames),
+    // --float-vertices (unpacked 32-bit float vertex attributes, for comparison),
+    // --mesh FILE (draw a binary mesh file), --export-mesh FILE (write the built-in mesh as one),
+    // --stream-mesh FILE [--upload-budget KB] (load a mesh file in the background), --io-backend auto|threads|uring|
+    // overlapped|fetch (how the streamers read files: io_uring on Linux, overlapped I/O on Windows, a thread pool,
+    // or in a browser HTTP range requests for the files' URLs),
+    // --zoom Z (magnify the grid, the scroll wheel changes it), --no-cull (draw objects outside the view too),
+    // --gpu-driven (4.3+ compute culling and indirect draws), --occlusion (Hi-Z occlusion culling, implies --gpu-driven),
+    // --meshlets (the mesh split into meshlets of up to 64 vertices and 124 triangles, each culled by its bounding
+    // sphere and normal cone after the objects are, implies --gpu-driven; needs ARB_indirect_parameters),
+    // --vsync off|on|adaptive (swap interval 0, 1 or -1), --fps-limit N (cap the frame rate), --smooth (smoothed
+    // simulation clock), --low-latency (late input sampling, at most one frame queued); V, L, S and F switch
+    // the four while running. --tick-rate HZ (fixed simulation steps per second, 60 by default),
+    // --windows N (a wall of N side-by-side windows with shared contexts, the camera spread across them),
+    // --texture FILE [--texture-budget MB] (a DDS / KTX2 texture, mips streamed in by on-screen size, 256 MB by default),
+    // --vram-budget MB (video memory the app keeps to: the mesh's finest levels of detail and the texture's mips are
+    // dropped to stay under it; the driver's free memory caps it where it says),
+    // --material FILE, repeatable (textures the objects take turns wearing, drawn in one batch), --no-bindless (texture
+    // arrays for them even where bindless handles work), --shader-dir DIR (the scene shaders from files in DIR,
+    // written there on first use and rebuilt in the background whenever one is saved), --precompile-shaders (build
+    // every scene shader variant into the program binary cache, then exit), --separable (the scene as a pipeline
+    // of separable stages, each compiled once for every variant sharing it), --trace FILE (CPU scopes on every
+    // thread and the GPU passes, written as a Chrome trace_event JSON file on exit), --telemetry FILE (the last ~20
+    // seconds of frame and pass times, memory, hitches and errors kept in a ring and written to FILE on a crash or when
+    // T is pressed, core/telemetry.h), --telemetry-print FILE (print one and exit), --metrics PORT (frame-time
+    // percentiles, GPU frame time, GPU memory against its budget, streaming queue depth and hitches served over HTTP in
+    // Prometheus' text format on a background thread, core/metrics_server.h), --hud (start with the performance overlay
+    // shown; H toggles it), --frame-stats FILE (frame time p50/p95/p99/max and stutters
+    // for every second of the run, written as CSV on exit), --capture FILE (record the frames the renderer is
+    // given), --replay FILE (draw a capture's frames headless as fast as they go, looping it for --headless N
+    // frames, without simulating anything), --particles N (4.3+: a fountain of up to N particles simulated,
+    // compacted and drawn entirely on the GPU), --characters N (4.3+: N skinned characters, their poses sampled
+    // from a compressed clip on the job system and blended on the GPU), --bake-animation (with --characters: the
+    // clip baked into a texture at load and the crowd posed from it in the vertex shader, with no work per
+    // character on the CPU), --detail N (the built-in triangle as N * N
+    // triangles with a scalloped outline, simplified into levels of detail at load), --lod-error PX (the most a level
+    // of detail's error may cover on screen, 1 pixel by default; 0 always draws the full mesh), --lights N (4.3+: N
+    // moving point lights, binned into screen tiles and depth slices by a compute pass so each fragment only loops
+    // over its cluster's), --deferred (with --lights: a G-buffer of albedo and packed normals, shaded in one pass),
+    // --depth (depth tested against a reversed-Z float depth buffer, the draws sorted front to back), --depth-prepass
+    // (implies --depth: the scene's depth drawn first, its colour then shaded once per pixel), --overdraw (fragments
+    // shaded per pixel as a heat map, their average printed on exit), --dynamic-res MS (the scene drawn at 50-100%
+    // of the window's size, whatever keeps its GPU time under MS milliseconds, and stretched bilinearly to fit), --post
+    // (an HDR scene through bloom, a filmic tonemap and FXAA; --no-bloom, --no-fxaa and --exposure X adjust it),
+    // --msaa N (the scene drawn offscreen with N samples a pixel, resolved before post-processing and the overlay),
+    // --labels N (the first N visible objects' positions printed over them, with the overlay's cached SDF text),
+    // --shapes N (a dashboard of N moving 2D rectangles, lines, circles and triangles, batched by layer and texture),
+    // --paths N (a wall of gauges drawn as N vector paths, filled and stroked on the GPU through a coverage target),
+    // --retained-ui (--shapes' charts kept as widgets that rebuild only their own vertices when their feed ticks, and
+    // redrawn only inside the rectangles that changed),
+    // --points N (4.3+: a scatter of N telemetry points under the scene, in 16-bit tiles decimated to the screen's
+    // density on the GPU and refined over a few frames whenever the view changes), --feed NAME (the points another
+    // process publishes through shared-memory feed NAME, core/shared_feed.h, copied once into a stream buffer and
+    // drawn in the scene; looked for again every second until it's there), --cuda-points N (OPENGLTEST_CUDA builds:
+    // N points a CUDA kernel moves in a GL vertex buffer the scene draws them from, cuda/cuda_interop.h, the
+    // buffer mapped to CUDA by the frame graph only while the kernel runs), --serve PORT (headless until stopped, or
+    // for --headless N frames: images of the scene for cameras clients send over TCP, core/render_service.h, up to
+    // 16 of a size drawn a frame into the layers of an array target, read back fenced and encoded as PNG on a pool
+    // of threads; culling off), --series N (N live line charts
+    // along the bottom, 32 new samples each a frame, only those uploaded, drawn from a min/max pyramid), --map MB (a
+    // tour over a 21-level quadtree map under the scene, its tiles decoded on threads of their own and cached in MB
+    // of GPU memory, evicted least recently used first, prefetched ahead of the pan), --camera orbit|arcball|fly (a
+    // perspective camera over the grid instead of the 2D view: right-drag turns it, the scroll wheel moves in and out,
+    // and in fly mode the arrow keys and Page Up/Down move the eye while the wheel sets its speed), --world-offset D
+    // (the grid D units out along x and y, drawn camera-relative: world positions in double, only differences of
+    // them in float), --gpu-pick (a click reads the object under the cursor from an ID attachment the instanced
+    // scene pass writes, copied back asynchronously and printed a frame or two later; the BVH ray cast otherwise),
+    // --record FILE (every frame as presented, read back through a ring of pixel pack buffers and written on a
+    // thread of its own: numbered PNGs for a .png, ffmpeg for .mp4/.mkv/.webm/.mov, raw RGBA otherwise; P saves a
+    // screenshot in a window, with it or without; an rtp://, udp://, srt://, tcp:// or rtsp:// URL streams live, paced
+    // by --fps-limit when headless), --encoder software|nvenc|vaapi|amf, --hevc and --bitrate KBPS (how ffmpeg encodes
+    // --record's videos and streams), --wall I/N HOST[:PORT] (node I of an N-node video wall, each a process with a
+    // window of its own showing its column of the one view: node 0 leads, listening on PORT (47800), and the
+    // others connect to it at HOST; every node swaps together), --scene FILE (the objects from a binary scene file,
+    // mapped and used in place, with the mesh it names unless --mesh is given), --bench-scene PRESET[,KNOB=V...] (a
+    // generated benchmark scene, src/scene/bench_scene.h, in place of the grid: its objects, their material indices,
+    // its lights unless --lights is given and a dynamic hierarchy's motion; "list" prints the presets),
+    // --save-scene FILE (the scene as drawn, to a scene file or, for a .txt, its text form for diffing),
+    // --scene-reload OBJECTS (the --scene file watched, and each new version loaded and set up in the background, then
+    // swapped in between frames; room for OBJECTS objects, 0 for as many as the first version has),
+    // --spatial-index bvh|grid (what culls and picks the objects: the BVH, refit when they move, or a spatial hash
+    // grid rebuilt in parallel every tick they move, for scenes where most of them do), --broadphase (with
+    // --spatial-index grid: every pair of objects whose boxes overlap, found through the same grid each tick, the
+    // pairs between objects that didn't move kept from the tick before), --cpu-occlusion (the objects
+    // frustum culling keeps tested against a small depth buffer the nearest of them are drawn into on the CPU, for
+    // contexts without --occlusion's compute), --impostors PX (instanced: objects spanning fewer than PX pixels drawn
+    // in one draw as quads of an atlas the mesh is baked into from 128 directions, unlit), --significance PX (the
+    // visible objects' turns, levels of detail and impostor choices updated every frame while they span PX pixels or
+    // more and every 2nd, 4th or 8th as they get smaller, the frame making up their turn in between; objects out of
+    // view aren't updated at all), --coherent (culling carried over from the last frame: only the objects near the
+    // frustum's sides or moved are tested again, the visible list kept near to far by an insertion sort, and the
+    // naive path's draws recorded in that order and insertion sorted too), --cull-select (4.3+, instanced: each
+    // frame culled by the CPU's sweep or --gpu-driven's compute pass, both timed as they run, the other tried every
+    // so often and taking over once under 90% of the chosen one's cost; level 0 only), --terrain SIZE (with a
+    // perspective --camera, implies --depth: a heightfield SIZE units a side under the scene, its patches chosen as a
+    // CDLOD quadtree for the eye and drawn as two instanced grids, tessellated down to 8 px on 4.0+ contexts unless
+    // --no-tessellation is given; its heights made up, or streamed mip by mip from --terrain-heightmap FILE, a DDS or
+    // KTX2, and its ground detail from --terrain-texture MB: a virtual texture over the whole terrain, only the pages a
+    // low-resolution feedback pass saw it sample cached, in MB), --volume SIDE (4.3+: a made-up field of SIDE^3 voxels
+    // in the box around the origin, ray marched at half resolution over the scene by compute shaders that skip empty
+    // space through an occupancy pyramid and stop once a ray is opaque, its bricks streamed nearest first and the
+    // frames accumulated), --volume-file FILE (a raw cube
+    // of 8-bit voxels marched instead), --package FILE
+    // (an asset package from asset_cooker --package: the --scene, --mesh and --stream-mesh files it holds are unpacked
+    // from it), --no-dsa (buffers and vertex arrays created and filled by binding them, as on a 3.3 context, even where
+    // 4.5's direct state access is there), --vulkan (the objects drawn through Vulkan instead, naive or instanced, their
+    // command buffers recorded across the job system; builds with OPENGLTEST_VULKAN only; where the device has ray
+    // queries, clicks are traced through an acceleration structure of the visible objects refit every frame),
+    // --rt-shadows (--vulkan with ray queries: the sun's shadows traced onto the ground plane, as --shadows draws
+    // them), --no-ray-query (--vulkan: clicks through the BVH even where the device has ray queries),
+    // --no-async-compute (--vulkan: the acceleration structure's compute passes on the graphics queue instead of
+    // an async compute queue overlapping it; the report gives each queue's time and their overlap), --software
+    // (with --headless N: the objects drawn on the CPU instead, by a tile-based rasterizer spread across the job
+    // system, for nodes without a GPU; the report gives its frame rate, triangles, pixels and a hash of the last
+    // frame), --gles (an OpenGL ES 3 context for tiled mobile GPUs: 3.1 with --lights, the desktop 4.3 features
+    // left out; depth invalidated each frame, 32-bit colour, and --deferred through pixel local storage where the
+    // driver has it), --prewarm
+    // (loading waits for every scene program and draws with each, and with each pipeline state, once offscreen, so no
+    // driver compiles one at its first real draw), --hitches (every stutter logged with the passes and programs its
+    // time went to), --draw-timings N (every Nth frame, a timestamp after each of its draws and dispatches only, and
+    // the 20 that took the GPU longest reported with their pass, program, vertex array, count and instances),
+    // --gpu-animate (4.3+, instanced: every object spins, and some orbit or bob, by a compute pass that writes the
+    // instance matrices from per-object motion parameters and the Frame block's time; nothing per object on the CPU),
+    // --pull (4.3+: the scene's vertex shader reads the mesh's vertices from shader storage by gl_VertexID and decodes
+    // them itself, the layout in a uniform block, so one VAO and program serve every vertex layout),
+    // --bench-primitives N (4.3+: time the compute scan, compaction, histogram and radix sorts on 1M, 10M and 100M
+    // elements, up to N, plain and with subgroups where the driver has them, check them against the CPU, then exit),
+    // --bench-submit N (the triangle drawn N times offscreen by each submission strategy in turn - a Draw block and
+    // draw per object, instanced, multi-draw indirect and GPU-driven, the last two 4.3+ - each reported with its CPU
+    // ms a frame and per 10k objects, GPU ms and draws a second, then exit),
+    // --oit weighted|list (4.3+: the scene's objects drawn translucent in any order and composited in one pass, by
+    // weighted blended accumulation, or exactly from per-pixel linked lists sorted in the resolve for quality captures),
+    // --shadows N (4.3+: the sun's shadows from N = 1 to 4 cascaded maps, texel-snapped and redrawn only when their
+    // region or the casters in it change, far ones every 2, 4, 8 frames; on a ground plane under the flat scene),
+    // --taa (implies --depth: the projection jittered inside the pixel each frame, and each frame blended into its
+    // history reprojected by per-pixel motion vectors from the depth, clamped to the frame's own neighbourhood),
+    // --vrs fixed|adaptive (the scene's tiles shaded coarser away from the fovea by GL_NV_shading_rate_image, and
+    // adaptive (4.3) also where last frame's tile was flat or moving fast; without the extension the periphery is
+    // drawn at half size around a full-size inset), --startup (where the time to the first frame went, by phase and
+    // thread, printed once it's out), --on-demand (a frame only when input arrives, the camera moves, the renderer is
+    // still loading or the overlay's readouts are due, the main thread asleep in between; the scene's clock starts
+    // stopped and Space runs it, which draws every frame again), --governor MS (the quality governor: resolution,
+    // shadow cascades, particles and LOD error stepped down a tier at a time when the frame time or the hottest
+    // sensor is heading past MS or its limit, or the machine is on battery, and back up after a long clear spell),
+    // --config FILE (options from a file, one per line with or without their "--", "#" for comments, read before the
+    // command line's so those win), --render-scale S (the scene drawn at S of the window's size and scaled up),
+    // --console (debug and profiling builds: vsync, fps-limit, low-latency, cull, lod-error, render-scale,
+    // upload-budget and vram-budget changed while it runs, by typing NAME VALUE; "list" shows them), --topology (the
+    // CPU's cores, SMT siblings, performance and efficiency cores and NUMA nodes, and where the threads went),
+    // --affinity auto|off (auto, the default: the main and render threads pinned to the performance cores of a hybrid
+    // CPU), --main-cpus, --render-cpus and --worker-cpus LIST (pinned to CPUs 0-3,8 and the like instead),
+    // --high-priority (the main and render threads above normal priority), --numa-node N (on a machine with several
+    // nodes, the one the main and render threads and the frame's data go on, in place of the GPU's; the workers are
+    // spread over the nodes, each pinned to one, and steal work from their own node first), --huge-pages (frame arenas
+    // and mapped scene files in huge pages where the system has them: MAP_HUGETLB or transparent huge pages on Linux,
+    // large pages on Windows given the "Lock pages in memory" right), --alloc-stats (builds with allocation tracking:
+    // live and peak heap bytes and allocations per frame for each subsystem, printed on exit), --assert-no-allocs
+    // (the same builds: abort on any heap allocation in the main thread's frame work once the first 120 frames are
+    // past, naming its size and subsystem), --stereo (instanced, with a perspective --camera: the scene for two eyes
+    // side by side, each a half of the window with its own off-centre frustum; one cull with a frustum around both
+    // eyes', and each level of detail's single instanced draw draws every object twice, the shader picking the eye),
+    // --xr (builds with OpenXR: --stereo presented through an OpenXR runtime, with --depth and on one thread; the
+    // head and eyes located before culling and again, late-latched, before the draws; colour and depth submitted)
+    startup_profile_begin();
+    RenderConfig config = { DRAW_MODE_INSTANCED, 1, false, NULL, 0, 1920, 1080, false, NULL, NULL, NULL, 1024, NULL, -1, 1.f, true, NULL, NULL, false, NULL, 1, NULL,
+        NULL, 256, ASYNC_IO_AUTO, { NULL }, 0, false, NULL, false, NULL, NULL, 0, 0, NULL, false, NULL, false, 0, false, false, false, false, false, 0.0, NULL, 0, 0, 0, 0, false, 0, NULL, 0, 0, 0, 0, false, NULL, 0, false, 0, NULL, NULL, false, false, false, false, false, OIT_OFF, 0, false, 0.f, 0.f, NULL, true, 0, 0, NULL, FOVEATION_OFF, false, NULL, NULL, false, NULL, 1.f, 0, NULL, false, false, false, false, false, 0, NULL };
+    VsyncMode vsync = VSYNC_ON;
+    double fps_limit = 0.0;
+    bool smooth = false;
+    bool low_latency = false;
+    double tick_rate = 60.0;
+    bool egl = false;
+    bool gles = false;                  // --gles: an OpenGL ES 3 context
+    bool precompile_shaders = false;
+    uint32_t bench_primitives = 0;      // --bench-primitives: the most elements, 0 for none
+    int bench_submit = 0;               // --bench-submit: the triangles each strategy draws, 0 for none
+    bool vulkan = false;
+    bool software = false;              // --software: drawn on the CPU
+    bool ray_query = true;              // --vulkan: where the device has them
+    bool ray_shadows = false;           // --rt-shadows
+    bool async_compute = true;          // --vulkan: where the device has a queue for it
+    bool on_demand = false;
+    double governor_ms = 0.0;           // --governor: the frame time the quality governor keeps under, 0 for none
+    const char* trace_path = NULL;
+    const char* telemetry_path = NULL;  // --telemetry FILE: the flight recorder's, NULL for off
+    int metrics_port = 0;               // --metrics PORT: the Prometheus endpoint's, 0 for none
+    bool show_hud = false;
+    const char* replay_path = NULL;
+    int wall_node = 0, wall_nodes = 0;     // --wall: 0 nodes for none
+    const char* scene_path = NULL;
+    const char* bench_scene_spec = NULL;
+    const char* save_scene_path = NULL;
+    int scene_reload = -1;              // --scene-reload OBJECTS: -1 for none, 0 for as many as the first version
+    bool spatial_grid = false;          // --spatial-index grid
+    bool broadphase = false;            // --broadphase
+    bool cpu_occlusion = false;         // --cpu-occlusion
+    float significance_pixels = 0.f;    // --significance PX: 0 for every visible object updated every frame
+    bool coherent = false;              // --coherent
+    bool cull_select = false;           // --cull-select
+    CullSelector cull_selector;
+    const char* package_path = NULL;
+    const char* wall_host = NULL;
+    int detail = 0;
+    float lod_error = 1.f;
+    bool render_thread = true;
+    int job_threads = 0;
+    PostSettings post = POST_PROCESS_DEFAULTS;
+    int camera_mode = -1;
+    double world_offset = 0.0;
+    bool console = false;
+    bool show_topology = false;
+    bool affinity = true;               // --affinity auto: the main and render threads on the performance cores
+    int numa_node_arg = -1;             // --numa-node N: the node the frame's data goes on, -1 for the GPU's
+    CpuSet main_cpus, render_cpus, worker_cpus;     // --main-cpus, --render-cpus, --worker-cpus: empty for none
+    cpu_set_clear(&main_cpus);
+    cpu_set_clear(&render_cpus);
+    cpu_set_clear(&worker_cpus);
+
+    // --config FILE: its options go in front of the command line's, which come after and so win
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (strcmp(argv[i], "--config"))
+            continue;
+        char** file_args = NULL;
+        int file_count = 0;
+        if (!settings_read_args(argv[i + 1], &file_args, &file_count))
+            exit(EXIT_FAILURE);
+        char** merged = (char**)malloc(sizeof(char*) * (argc + file_count + 1));    // kept, with the file's, to exit
+        merged[0] = argv[0];
+        memcpy(merged + 1, file_args, sizeof(char*) * file_count);
+        memcpy(merged + 1 + file_count, argv + 1, sizeof(char*) * argc);    // and the terminating NULL
+        argc += file_count;
+        argv = merged;
+        printf("config: %d options from %s\n", file_count, argv[i + 1 + file_count]);
+        break;
+    }
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--objects") && i + 1 < argc)
+            config.object_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--naive"))
+            config.draw_mode = DRAW_MODE_NAIVE;
+        else if (!strcmp(argv[i], "--single-thread"))
+            render_thread = false;
+        else if (!strcmp(argv[i], "--jobs") && i + 1 < argc)
+            job_threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--topology"))
+            show_topology = true;
+        else if (!strcmp(argv[i], "--affinity") && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "auto") && strcmp(argv[i], "off"))
+            {
+                fprintf(stderr, "Error: --affinity expects auto or off\n");
+                exit(EXIT_FAILURE);
+            }
+            affinity = !strcmp(argv[i], "auto");
+        }
+        else if ((!strcmp(argv[i], "--main-cpus") || !strcmp(argv[i], "--render-cpus") || !strcmp(argv[i], "--worker-cpus"))
+            && i + 1 < argc)
+        {
+            CpuSet* set = argv[i][2] == 'm' ? &main_cpus : argv[i][2] == 'r' ? &render_cpus : &worker_cpus;
+            if (!cpu_set_parse(set, argv[i + 1]))
+            {
+                fprintf(stderr, "Error: %s expects a CPU list such as 0-3,8\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            ++i;
+        }
+        else if (!strcmp(argv[i], "--high-priority"))
+            config.high_priority = true;
+        else if (!strcmp(argv[i], "--numa-node") && i + 1 < argc)
+            numa_node_arg = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--huge-pages"))
+            huge_pages_enable(true);        // before anything big is allocated or mapped
+        else if (!strcmp(argv[i], "--profile"))
+            config.profile = true;
+        else if (!strcmp(argv[i], "--profile-csv") && i + 1 < argc)
+            config.profile_csv = argv[++i];
+        else if (!strcmp(argv[i], "--config") && i + 1 < argc)
+            ++i;    // read above
+        else if (!strcmp(argv[i], "--console"))
+        {
+            if (SETTINGS_CONSOLE)
+                console = true;
+            else
+                fprintf(stderr, "Warning: --console isn't built in (configure with -DOPENGLTEST_SETTINGS_CONSOLE=ON)\n");
+        }
+        else if (!strcmp(argv[i], "--alloc-stats") || !strcmp(argv[i], "--assert-no-allocs"))
+        {
+            if (!alloc_tracking_available())
+                fprintf(stderr, "Warning: %s isn't built in (configure with -DOPENGLTEST_ALLOC_TRACKING=ON)\n", argv[i]);
+            else if (!strcmp(argv[i], "--alloc-stats"))
+                config.alloc_stats = true;
+            else
+                config.assert_no_allocs = true;
+        }
+        else if (!strcmp(argv[i], "--render-scale") && i + 1 < argc)
+        {
+            config.render_scale = (float)atof(argv[++i]);
+            if (!(config.render_scale >= 0.25f && config.render_scale <= 1.f))
+            {
+                fprintf(stderr, "Error: --render-scale expects a scale from 0.25 to 1\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--pipeline-stats"))
+            config.pipeline_stats = true;
+        else if (!strcmp(argv[i], "--gpu-counters") && i + 1 < argc)
+            config.gpu_counters = argv[++i];
+        else if (!strcmp(argv[i], "--headless") && i + 1 < argc)
+            config.headless_frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--size") && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &config.width, &config.height) != 2 || config.width < 1 || config.height < 1)
+            {
+                fprintf(stderr, "Error: --size expects WxH, e.g. 1920x1080\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--egl"))
+            egl = true;
+        else if (!strcmp(argv[i], "--gles"))
+            gles = true;
+        else if (!strcmp(argv[i], "--float-vertices"))
+            config.float_vertices = true;
+        else if (!strcmp(argv[i], "--mesh") && i + 1 < argc)
+            config.mesh_path = argv[++i];
+        else if (!strcmp(argv[i], "--export-mesh") && i + 1 < argc)
+            config.export_mesh = argv[++i];
+        else if (!strcmp(argv[i], "--stream-mesh") && i + 1 < argc)
+            config.stream_mesh = argv[++i];
+        else if (!strcmp(argv[i], "--upload-budget") && i + 1 < argc)
+            config.upload_budget_kb = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--io-backend") && i + 1 < argc)
+        {
+            if (!async_io_parse_backend(argv[++i], &config.io_backend))
+            {
+                fprintf(stderr, "Error: --io-backend expects auto, threads, uring, overlapped or fetch\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--zoom") && i + 1 < argc)
+            config.zoom = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--no-cull"))
+            config.cull = false;
+        else if (!strcmp(argv[i], "--gpu-driven"))
+            config.draw_mode = DRAW_MODE_GPU_DRIVEN;
+        else if (!strcmp(argv[i], "--occlusion"))
+        {
+            config.draw_mode = DRAW_MODE_GPU_DRIVEN;
+            config.occlusion = true;
+        }
+        else if (!strcmp(argv[i], "--meshlets"))
+        {
+            config.draw_mode = DRAW_MODE_GPU_DRIVEN;
+            config.meshlets = true;
+        }
+        else if (!strcmp(argv[i], "--vsync") && i + 1 < argc)
+        {
+            ++i;
+            if (!strcmp(argv[i], "off"))
+                vsync = VSYNC_OFF;
+            else if (!strcmp(argv[i], "on"))
+                vsync = VSYNC_ON;
+            else if (!strcmp(argv[i], "adaptive"))
+                vsync = VSYNC_ADAPTIVE;
+            else
+            {
+                fprintf(stderr, "Error: --vsync expects off, on or adaptive\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--fps-limit") && i + 1 < argc)
+            fps_limit = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--smooth"))
+            smooth = true;
+        else if (!strcmp(argv[i], "--low-latency"))
+            low_latency = true;
+        else if (!strcmp(argv[i], "--tick-rate") && i + 1 < argc)
+            tick_rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--windows") && i + 1 < argc)
+            config.window_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--texture") && i + 1 < argc)
+            config.texture_path = argv[++i];
+        else if (!strcmp(argv[i], "--texture-budget") && i + 1 < argc)
+            config.texture_budget_mb = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--vram-budget") && i + 1 < argc)
+        {
+            const int mb = atoi(argv[++i]);
+            if (mb <= 0)
+            {
+                fprintf(stderr, "Error: --vram-budget expects a size in MB\n");
+                exit(EXIT_FAILURE);
+            }
+            gpu_memory_set_budget(&gl_memory, (uint64_t)mb << 20);
+            config.vram_budget_mb = mb;
+        }
+        else if (!strcmp(argv[i], "--material") && i + 1 < argc)
+        {
+            if (config.material_count < MATERIAL_MAX)
+                config.material_paths[config.material_count++] = argv[++i];
+            else
+                fprintf(stderr, "Warning: at most %d materials, %s is left out\n", MATERIAL_MAX, argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--no-bindless"))
+            config.arrays_only = true;
+        else if (!strcmp(argv[i], "--no-dsa"))
+            config.no_dsa = true;
+        else if (!strcmp(argv[i], "--prewarm"))
+            config.prewarm = true;
+        else if (!strcmp(argv[i], "--hitches"))
+            config.hitches = true;
+        else if (!strcmp(argv[i], "--draw-timings") && i + 1 < argc)
+            config.draw_timings = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--gpu-animate"))
+            config.gpu_animate = true;
+        else if (!strcmp(argv[i], "--pull"))
+            config.pull = true;
+        else if (!strcmp(argv[i], "--oit") && i + 1 < argc)
+        {
+            ++i;
+            if (!strcmp(argv[i], "weighted"))
+                config.oit = OIT_WEIGHTED;
+            else if (!strcmp(argv[i], "list"))
+                config.oit = OIT_LIST;
+            else
+            {
+                fprintf(stderr, "Error: --oit expects weighted or list\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--shadows") && i + 1 < argc)
+            config.shadows = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--vrs") && i + 1 < argc)
+        {
+            ++i;
+            if (!strcmp(argv[i], "fixed"))
+                config.vrs = FOVEATION_FIXED;
+            else if (!strcmp(argv[i], "adaptive"))
+                config.vrs = FOVEATION_ADAPTIVE;
+            else
+            {
+                fprintf(stderr, "Error: --vrs expects fixed or adaptive\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--vulkan"))
+            vulkan = true;
+        else if (!strcmp(argv[i], "--software"))
+            software = true;
+        else if (!strcmp(argv[i], "--rt-shadows"))
+            ray_shadows = true;
+        else if (!strcmp(argv[i], "--no-ray-query"))
+            ray_query = false;
+        else if (!strcmp(argv[i], "--no-async-compute"))
+            async_compute = false;
+        else if (!strcmp(argv[i], "--startup"))
+            config.startup = true;
+        else if (!strcmp(argv[i], "--on-demand"))
+            on_demand = true;
+        else if (!strcmp(argv[i], "--governor") && i + 1 < argc)
+            governor_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--shader-dir") && i + 1 < argc)
+            config.shader_dir = argv[++i];
+        else if (!strcmp(argv[i], "--separable"))
+            config.separable = true;
+        else if (!strcmp(argv[i], "--precompile-shaders"))
+            precompile_shaders = true;
+        else if (!strcmp(argv[i], "--bench-primitives") && i + 1 < argc)
+            bench_primitives = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--bench-submit") && i + 1 < argc)
+            bench_submit = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            trace_path = argv[++i];
+        else if (!strcmp(argv[i], "--telemetry") && i + 1 < argc)
+            telemetry_path = argv[++i];
+        else if (!strcmp(argv[i], "--telemetry-print") && i + 1 < argc)
+            exit(telemetry_print(argv[++i], stdout) ? EXIT_SUCCESS : EXIT_FAILURE);
+        else if (!strcmp(argv[i], "--metrics") && i + 1 < argc)
+        {
+            metrics_port = atoi(argv[++i]);
+            if (metrics_port < 1 || metrics_port > 65535)
+            {
+                fprintf(stderr, "Error: --metrics expects a port, e.g. 9464\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--hud"))
+            show_hud = true;
+        else if (!strcmp(argv[i], "--particles") && i + 1 < argc)
+            config.particle_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--characters") && i + 1 < argc)
+            config.character_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bake-animation"))
+            config.bake_animation = true;
+        else if (!strcmp(argv[i], "--lights") && i + 1 < argc)
+            config.light_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--deferred"))
+            config.deferred = true;
+        else if (!strcmp(argv[i], "--depth"))
+            config.depth = true;
+        else if (!strcmp(argv[i], "--depth-prepass"))
+            config.depth = config.depth_prepass = true;
+        else if (!strcmp(argv[i], "--taa"))
+            config.depth = config.taa = true;
+        else if (!strcmp(argv[i], "--overdraw"))
+            config.overdraw = true;
+        else if (!strcmp(argv[i], "--dynamic-res") && i + 1 < argc)
+            config.resolution_budget_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--msaa") && i + 1 < argc)
+            config.msaa_samples = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--labels") && i + 1 < argc)
+            config.labels = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--shapes") && i + 1 < argc)
+            config.shape_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--paths") && i + 1 < argc)
+            config.path_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--retained-ui"))
+            config.retained_ui = true;
+        else if (!strcmp(argv[i], "--points") && i + 1 < argc)
+            config.point_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--feed") && i + 1 < argc)
+            config.feed_name = argv[++i];
+        else if (!strcmp(argv[i], "--cuda-points") && i + 1 < argc)
+            config.cuda_point_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--serve") && i + 1 < argc)
+        {
+            config.serve_port = atoi(argv[++i]);
+            if (config.serve_port < 1 || config.serve_port > 65535)
+            {
+                fprintf(stderr, "Error: --serve expects a port, e.g. %d\n", RENDER_SERVICE_PORT);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--map") && i + 1 < argc)
+            config.map_megabytes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--world-offset") && i + 1 < argc)
+            world_offset = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--camera") && i + 1 < argc)
+        {
+            camera_mode = camera_controller_mode_from_name(argv[++i]);
+            if (camera_mode < 0)
+            {
+                fprintf(stderr, "Error: --camera expects orbit, arcball or fly\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--gpu-pick"))
+            config.gpu_pick = true;
+        else if (!strcmp(argv[i], "--stereo"))
+            config.stereo = true;
+        else if (!strcmp(argv[i], "--xr"))
+            config.xr = config.stereo = true;
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc)
+            config.record_path = argv[++i];
+        else if (!strcmp(argv[i], "--encoder") && i + 1 < argc)
+        {
+            config.encoder = screen_recorder_encoder_from_name(argv[++i]);
+            if (config.encoder < 0)
+            {
+                fprintf(stderr, "Error: --encoder expects software, nvenc, vaapi or amf\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (!strcmp(argv[i], "--hevc"))
+            config.hevc = true;
+        else if (!strcmp(argv[i], "--bitrate") && i + 1 < argc)
+            config.bitrate_kbps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--series") && i + 1 < argc)
+            config.series_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--post"))
+            config.post = &post;
+        else if (!strcmp(argv[i], "--no-bloom"))
+            post.stages[POST_STAGE_BLOOM] = false;
+        else if (!strcmp(argv[i], "--no-fxaa"))
+            post.stages[POST_STAGE_FXAA] = false;
+        else if (!strcmp(argv[i], "--exposure") && i + 1 < argc)
+            post.exposure = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--detail") && i + 1 < argc)
+            detail = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--lod-error") && i + 1 < argc)
+            lod_error = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--frame-stats") && i + 1 < argc)
+            config.frame_stats_csv = argv[++i];
+        else if (!strcmp(argv[i], "--capture") && i + 1 < argc)
+            config.capture_path = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+            replay_path = argv[++i];
+        else if (!strcmp(argv[i], "--scene") && i + 1 < argc)
+            scene_path = argv[++i];
+        else if (!strcmp(argv[i], "--bench-scene") && i + 1 < argc)
+            bench_scene_spec = argv[++i];
+        else if (!strcmp(argv[i], "--save-scene") && i + 1 < argc)
+            save_scene_path = argv[++i];
+        else if (!strcmp(argv[i], "--scene-reload") && i + 1 < argc)
+            scene_reload = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 0;
+        else if (!strcmp(argv[i], "--spatial-index") && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "bvh") && strcmp(argv[i], "grid"))
+            {
+                fprintf(stderr, "Error: --spatial-index expects bvh or grid\n");
+                exit(EXIT_FAILURE);
+            }
+            spatial_grid = !strcmp(argv[i], "grid");
+        }
+        else if (!strcmp(argv[i], "--broadphase"))
+            broadphase = true;
+        else if (!strcmp(argv[i], "--cpu-occlusion"))
+            cpu_occlusion = true;
+        else if (!strcmp(argv[i], "--impostors") && i + 1 < argc)
+            config.impostor_pixels = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--significance") && i + 1 < argc)
+            significance_pixels = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--coherent"))
+            coherent = true;
+        else if (!strcmp(argv[i], "--cull-select"))
+            cull_select = true;
+        else if (!strcmp(argv[i], "--terrain") && i + 1 < argc)
+        {
+            config.terrain_size = (float)atof(argv[++i]);
+            config.depth = config.terrain_size > 0.f || config.depth;
+        }
+        else if (!strcmp(argv[i], "--terrain-heightmap") && i + 1 < argc)
+            config.terrain_heightmap = argv[++i];
+        else if (!strcmp(argv[i], "--no-tessellation"))
+            config.terrain_tessellation = false;
+        else if (!strcmp(argv[i], "--terrain-texture") && i + 1 < argc)
+            config.terrain_texture_mb = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--volume") && i + 1 < argc)
+            config.volume_side = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--volume-file") && i + 1 < argc)
+            config.volume_path = argv[++i];
+        else if (!strcmp(argv[i], "--package") && i + 1 < argc)
+            package_path = argv[++i];
+        else if (!strcmp(argv[i], "--wall") && i + 2 < argc)
+        {
+            if (!wall_sync_parse_node(argv[++i], &wall_node, &wall_nodes))
+            {
+                fprintf(stderr, "Error: --wall expects I/N (node I of N, 0 leading, N up to %d) and HOST[:PORT]\n",
+                    WALL_SYNC_MAX_NODES);
+                exit(EXIT_FAILURE);
+            }
+            wall_host = argv[++i];
+        }
+    }
+
+    // --replay: the capture's setup replaces the command line's, and the run becomes a headless benchmark of its
+    // frames. Textures and materials still come from the command line: the capture only has the indices.
+    FrameCaptureReader replay;
+    memset(&replay, 0, sizeof(replay));
+    if (replay_path)
+    {
+        if (!frame_capture_open(&replay, replay_path))
+            exit(EXIT_FAILURE);
+        const FrameCaptureHeader* header = replay.header;
+        if (header->view_size != sizeof(Camera) || header->model_size != sizeof(mat3x4) || header->mode > DRAW_MODE_GPU_DRIVEN)
+        {
+            fprintf(stderr, "%s was captured by an incompatible build\n", replay_path);
+            exit(EXIT_FAILURE);
+        }
+        config.draw_mode = (DrawMode)header->mode;
+        config.object_count = (int)header->object_count;
+        config.cull = (header->flags & CAPTURE_CULL) != 0;
+        config.occlusion = (header->flags & CAPTURE_OCCLUSION) != 0;
+        config.depth = (header->flags & CAPTURE_REVERSED_Z) != 0;
+        config.width = (int)header->width;
+        config.height = (int)header->height;
+        if (config.headless_frames <= 0)
+            config.headless_frames = (int)replay.frame_count;
+        if (header->material_count != (uint32_t)config.material_count)
+            fprintf(stderr, "Warning: captured with %u materials, replayed with %d\n", header->material_count,
+                config.material_count);
+        config.capture_path = NULL;
+        config.window_count = 1;
+        if (wall_nodes)
+            fprintf(stderr, "Warning: --replay draws its capture on its own; --wall ignored\n");
+        wall_nodes = 0;
+        if (!render_thread)
+            fprintf(stderr, "Warning: --replay runs on the render thread; --single-thread ignored\n");
+        render_thread = true;
+        printf("replay: %s, %u frames captured at %ux%u\n", replay_path, replay.frame_count, header->width, header->height);
+    }
+
+    // --package: mapped for the whole run; the files named below are looked up in it first
+    Package package;
+    memset(&package, 0, sizeof(package));
+    if (package_path)
+    {
+        if (!package_open(&package, package_path))
+            exit(EXIT_FAILURE);
+        config.package = &package;
+        printf("package: %s, %u files in %u blocks\n", package_path, package.header->entry_count,
+            package.header->block_count);
+    }
+
+    // --scene: the objects come from the file's mapping instead of the grid, as many as it has
+    SceneFile scene_file;
+    memset(&scene_file, 0, sizeof(scene_file));
+    if (scene_path && replay_path)
+    {
+        fprintf(stderr, "Warning: --replay draws the objects it captured; --scene ignored\n");
+        scene_path = NULL;
+    }
+    if (scene_path)
+    {
+        STARTUP_SCOPE("scene file");
+        ALLOC_TAG_SCOPE(ALLOC_TAG_SCENE);
+        const auto start = std::chrono::steady_clock::now();
+        const int entry = config.package ? package_find(config.package, scene_path) : -1;
+        MappedFile file;
+        if (entry >= 0 ? !package_extract(config.package, entry, &file, NULL)
+                || !scene_file_open_mapped(&scene_file, &file, scene_path)
+            : !scene_file_open(&scene_file, scene_path))
+            exit(EXIT_FAILURE);
+        const SceneFileHeader* header = scene_file.header;
+        if (!header->entity_count)
+        {
+            fprintf(stderr, "Error: %s has no entities\n", scene_path);
+            exit(EXIT_FAILURE);
+        }
+        config.object_count = (int)header->entity_count;
+        if (scene_reload >= 0 && entry >= 0)
+        {
+            fprintf(stderr, "Warning: --scene-reload watches files on disk, not a package's; ignored\n");
+            scene_reload = -1;
+        }
+        else if (scene_reload > config.object_count)
+            config.object_count = scene_reload;     // the renderer and frame arenas have room for the versions to come
+        if (!(header->flags & SCENE_FILE_UNIFORM_SCALE))
+            fprintf(stderr, "Warning: %s scales its entities differently; all are drawn at the first one's scale\n",
+                scene_path);
+        if (!(header->flags & SCENE_FILE_FLAT))
+            fprintf(stderr, "Warning: %s places entities off the z = 0 plane; all are drawn in it\n", scene_path);
+        if (header->mesh_count > 1)
+            fprintf(stderr, "Warning: %s names %u meshes; every entity draws the first\n", scene_path, header->mesh_count);
+        if (header->mesh_count && !config.mesh_path && !config.stream_mesh)
+            config.mesh_path = scene_file_mesh_name(&scene_file, 0);
+        if (config.draw_mode == DRAW_MODE_GPU_DRIVEN && config.material_count > 0)
+            fprintf(stderr, "Warning: --gpu-driven gives object i material i %% %d, not the one %s names\n",
+                config.material_count, scene_path);
+        printf("scene: %s, %u entities, %s, opened in %.2f ms\n", scene_path, header->entity_count,
+            header->bvh_node_count ? "with its BVH" : "BVH built at load",
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    if (scene_reload >= 0 && (!scene_path || vulkan || config.draw_mode == DRAW_MODE_GPU_DRIVEN || config.gpu_animate))
+    {
+        fprintf(stderr, "Warning: --scene-reload %s; ignored\n", !scene_path ? "needs --scene"
+            : "swaps scenes for the GL renderer's CPU paths only: --gpu-driven, --gpu-animate and --vulkan upload the "
+            "objects once");
+        scene_reload = -1;
+    }
+
+    // --bench-scene: the preset's knobs set what the renderer has switches for; the objects are generated with the
+    // scene below. The renderer draws one mesh, all opaque or (--oit) all blended, so those knobs only mark objects.
+    BenchSceneParams bench_params;
+    BenchScene bench_scene;
+    memset(&bench_scene, 0, sizeof(bench_scene));
+    if (bench_scene_spec && !strcmp(bench_scene_spec, "list"))
+    {
+        bench_scene_print_presets(stdout);
+        exit(EXIT_SUCCESS);
+    }
+    if (bench_scene_spec && (scene_path || replay_path))
+    {
+        fprintf(stderr, "Warning: %s places the objects; --bench-scene ignored\n", scene_path ? "--scene" : "--replay");
+        bench_scene_spec = NULL;
+    }
+    if (bench_scene_spec)
+    {
+        if (!bench_scene_parse(bench_scene_spec, &bench_params))
+        {
+            bench_scene_print_presets(stderr);
+            exit(EXIT_FAILURE);
+        }
+        config.object_count = (int)bench_params.objects;
+        if (!config.light_count)
+            config.light_count = (int)bench_params.lights;
+        if (bench_params.meshes > 1)
+            fprintf(stderr, "Warning: --bench-scene hands out %u meshes; every object draws the one mesh\n",
+                bench_params.meshes);
+        if (bench_params.translucent > 0.f)
+            fprintf(stderr, "Warning: --bench-scene marks %.0f%% of the objects translucent; all are drawn %s\n",
+                100.f * bench_params.translucent, config.oit ? "blended (--oit)" : "opaque");
+        if (bench_params.dynamic && bench_params.depth
+            && (config.draw_mode == DRAW_MODE_GPU_DRIVEN || config.gpu_animate))
+            fprintf(stderr, "Warning: the GPU places the objects; --bench-scene's hierarchy stays as generated\n");
+    }
+
+    // --trace: recording starts before any thread that traces does
+    if (trace_path)
+    {
+        cpu_trace_init();
+        cpu_trace_thread_name("main");
+    }
+    // --telemetry: so does the flight recorder, and its crash handlers with it
+    if (telemetry_path && !telemetry_init(telemetry_path))
+        exit(EXIT_FAILURE);
+    // --metrics: the endpoint answers from the start, with what's known so far
+    if (metrics_port && !metrics_server_start(metrics_port))
+        exit(EXIT_FAILURE);
+    if (config.material_count > 0 && config.texture_path)
+    {
+        fprintf(stderr, "Warning: --material replaces --texture\n");
+        config.texture_path = NULL;
+    }
+    if (config.light_count > LIGHTING_MAX_LIGHTS)
+    {
+        fprintf(stderr, "Warning: --lights takes at most %d lights\n", LIGHTING_MAX_LIGHTS);
+        config.light_count = LIGHTING_MAX_LIGHTS;
+    }
+    if (config.deferred && config.light_count <= 0)
+    {
+        fprintf(stderr, "Warning: --deferred needs --lights, ignored\n");
+        config.deferred = false;
+    }
+    if (config.deferred && config.occlusion)
+    {
+        fprintf(stderr, "Warning: --occlusion reads the frame's own depth, so the lights are shaded forward\n");
+        config.deferred = false;
+    }
+    if (config.taa && config.deferred)
+    {
+        fprintf(stderr, "Warning: --taa reprojects through the offscreen target's depth, so the lights are shaded forward\n");
+        config.deferred = false;
+    }
+    if (config.depth && config.occlusion)
+    {
+        fprintf(stderr, "Warning: --occlusion depth tests already, and its Hi-Z reads the standard depth; --depth ignored\n");
+        config.depth = config.depth_prepass = false;
+    }
+    if (config.depth && config.deferred)
+    {
+        fprintf(stderr, "Warning: the G-buffer has a depth buffer of its own; --depth ignored\n");
+        config.depth = config.depth_prepass = false;
+    }
+    if (config.resolution_budget_ms > 0.0 && config.occlusion)
+    {
+        fprintf(stderr, "Warning: --occlusion's depth pyramid covers the whole target; --dynamic-res ignored\n");
+        config.resolution_budget_ms = 0.0;
+    }
+    if (config.msaa_samples > 1 && config.occlusion)
+    {
+        fprintf(stderr, "Warning: --occlusion's Hi-Z is built from a single-sample depth texture; --msaa ignored\n");
+        config.msaa_samples = 0;
+    }
+    if (config.msaa_samples > 1 && config.deferred)
+    {
+        fprintf(stderr, "Warning: the G-buffer has one sample a pixel, so deferred lighting can't be multisampled; --msaa ignored\n");
+        config.msaa_samples = 0;
+    }
+    if (config.msaa_samples > 1 && config.taa)
+    {
+        fprintf(stderr, "Warning: --taa antialiases over frames, reading a single-sample depth texture; --msaa ignored\n");
+        config.msaa_samples = 0;
+    }
+    if (config.gpu_animate && (config.draw_mode != DRAW_MODE_INSTANCED || config.capture_path || replay_path))
+    {
+        fprintf(stderr, "Warning: --gpu-animate moves the instanced path's objects, which aren't captured or replayed; "
+            "--gpu-animate ignored\n");
+        config.gpu_animate = false;
+    }
+    if (config.labels > 0 && (config.draw_mode == DRAW_MODE_GPU_DRIVEN || config.gpu_animate || config.headless_frames > 0
+        || config.window_count > 1))
+    {
+        fprintf(stderr, "Warning: --labels needs one window and the objects' matrices on the CPU; --labels ignored\n");
+        config.labels = 0;
+    }
+    if (config.shape_count > 0 && config.window_count > 1)
+    {
+        fprintf(stderr, "Warning: the --shapes dashboard is drawn over one window; --shapes ignored\n");
+        config.shape_count = 0;
+    }
+    if (config.retained_ui && config.shape_count <= 0)
+    {
+        fprintf(stderr, "Warning: --retained-ui keeps the --shapes dashboard; ignored without it\n");
+        config.retained_ui = false;
+    }
+    if (config.bake_animation && config.character_count <= 0)
+    {
+        fprintf(stderr, "Warning: --bake-animation bakes the --characters' clip; ignored without it\n");
+        config.bake_animation = false;
+    }
+    if (config.path_count > 0 && config.window_count > 1)
+    {
+        fprintf(stderr, "Warning: the --paths gauges are drawn over one window; --paths ignored\n");
+        config.path_count = 0;
+    }
+    if (config.point_count > 0 && (config.window_count > 1 || config.deferred))
+    {
+        fprintf(stderr, "Warning: --points is composited under one window's forward scene; --points ignored\n");
+        config.point_count = 0;
+    }
+    if (config.point_count > 0 && camera_mode >= 0)
+    {
+        fprintf(stderr, "Warning: --points decimates to the 2D view's rectangle, not a perspective camera's; --points ignored\n");
+        config.point_count = 0;
+    }
+    if (config.feed_name && (config.window_count > 1 || config.deferred))
+    {
+        fprintf(stderr, "Warning: the --feed points are drawn in one window's forward scene; --feed ignored\n");
+        config.feed_name = NULL;
+    }
+    if (config.cuda_point_count > 0)
+    {
+#ifdef OPENGLTEST_CUDA
+        if (config.window_count > 1 || config.deferred)
+        {
+            fprintf(stderr, "Warning: the --cuda-points points are drawn in one window's forward scene; --cuda-points "
+                "ignored\n");
+            config.cuda_point_count = 0;
+        }
+#else
+        fprintf(stderr, "Error: --cuda-points needs a build configured with OPENGLTEST_CUDA=ON\n");
+        exit(EXIT_FAILURE);
+#endif
+    }
+    if (config.serve_port > 0)
+    {
+        // A render server: headless until stopped (or for --headless N frames), every object drawn for the
+        // requests' cameras, the main frame only what they share
+        if (config.draw_mode != DRAW_MODE_INSTANCED || config.deferred || config.stereo || config.xr || vulkan
+            || wall_nodes)
+        {
+            fprintf(stderr, "Error: --serve draws the instanced scene forward into its batches: not with --naive, "
+                "--gpu-driven, --deferred, --stereo, --xr, --vulkan or --wall\n");
+            exit(EXIT_FAILURE);
+        }
+        if (config.headless_frames <= 0)
+            config.headless_frames = INT_MAX;
+        config.cull = false;
+    }
+    if (config.map_megabytes > 0 && (config.window_count > 1 || config.deferred))
+    {
+        fprintf(stderr, "Warning: --map is drawn under one window's forward scene; --map ignored\n");
+        config.map_megabytes = 0;
+    }
+    if (config.terrain_size > 0.f && (config.window_count > 1 || config.deferred || config.gpu_pick))
+    {
+        fprintf(stderr, "Warning: --terrain is drawn into one window's forward scene, not with --windows, --deferred "
+            "or --gpu-pick; ignored\n");
+        config.terrain_size = 0.f;
+    }
+    if (config.terrain_size > 0.f && camera_mode < 0)
+    {
+        fprintf(stderr, "Warning: --terrain needs a perspective --camera to be seen from; ignored\n");
+        config.terrain_size = 0.f;
+    }
+    if (config.terrain_texture_mb > 0 && config.terrain_size <= 0.f)
+    {
+        fprintf(stderr, "Warning: --terrain-texture textures --terrain; ignored without it\n");
+        config.terrain_texture_mb = 0;
+    }
+    if ((config.volume_side > 0 || config.volume_path) && (config.window_count > 1 || config.deferred))
+    {
+        fprintf(stderr, "Warning: --volume is marched over one window's forward scene, not with --windows or "
+            "--deferred; ignored\n");
+        config.volume_side = 0;
+        config.volume_path = NULL;
+    }
+    if (config.series_count > 0 && config.window_count > 1)
+    {
+        fprintf(stderr, "Warning: the --series charts are drawn over one window; --series ignored\n");
+        config.series_count = 0;
+    }
+    if (config.series_count > RENDER_MAX_SERIES)
+        config.series_count = RENDER_MAX_SERIES;
+    if (config.overdraw && config.deferred)
+    {
+        fprintf(stderr, "Warning: --overdraw counts the forward pass, so the lights are shaded forward\n");
+        config.deferred = false;
+    }
+    if (config.oit && (config.occlusion || config.overdraw))
+    {
+        fprintf(stderr, "Warning: --occlusion and --overdraw need the scene's depth and colour as drawn; --oit ignored\n");
+        config.oit = OIT_OFF;
+    }
+    if (config.oit && config.deferred)
+    {
+        fprintf(stderr, "Warning: --oit composites the scene as it's shaded, so the lights are shaded forward\n");
+        config.deferred = false;
+    }
+    if (config.oit && config.depth_prepass)
+    {
+        fprintf(stderr, "Warning: --oit's translucent scene leaves the depth alone; --depth-prepass ignored\n");
+        config.depth_prepass = false;
+    }
+    if (config.oit && config.msaa_samples > 1)
+    {
+        fprintf(stderr, "Warning: --oit's targets and lists have one sample a pixel; --msaa ignored\n");
+        config.msaa_samples = 0;
+    }
+    if (config.shadows < 0 || config.shadows > SHADOW_MAX_CASCADES)
+        config.shadows = config.shadows < 0 ? 0 : SHADOW_MAX_CASCADES;
+    if (config.shadows > 1 && camera_mode < 0)
+    {
+        fprintf(stderr, "Warning: the orthographic view has no depth to split; --shadows draws one cascade\n");
+        config.shadows = 1;
+    }
+    if (config.shadows && (config.draw_mode == DRAW_MODE_GPU_DRIVEN || config.oit || config.overdraw))
+    {
+        fprintf(stderr, "Warning: --shadows draws the CPU-culled casters opaque, not --gpu-driven's, --oit's or --overdraw's; "
+            "ignored\n");
+        config.shadows = 0;
+    }
+    if (config.shadows && config.deferred)
+    {
+        fprintf(stderr, "Warning: --shadows are taken in as the scene is shaded, so the lights are shaded forward\n");
+        config.deferred = false;
+    }
+    if (cpu_occlusion && (config.draw_mode == DRAW_MODE_GPU_DRIVEN || config.gpu_animate || !config.cull))
+    {
+        fprintf(stderr, "Warning: --cpu-occlusion tests what the CPU's frustum cull keeps, with no --gpu-driven, "
+            "--gpu-animate or --no-cull; ignored\n");
+        cpu_occlusion = false;
+    }
+    if (cpu_occlusion && (config.mesh_path || config.stream_mesh || config.oit))
+    {
+        fprintf(stderr, "Warning: --cpu-occlusion's occluders are the built-in triangle in the z = 0 plane, not a mesh "
+            "file's or --oit's layers; ignored\n");
+        cpu_occlusion = false;
+    }
+    if (config.impostor_pixels > 0.f && (config.draw_mode != DRAW_MODE_INSTANCED || config.gpu_animate || config.pull
+        || config.mesh_path || config.stream_mesh))
+    {
+        fprintf(stderr, "Warning: --impostors stand in for the CPU's instanced objects of the built-in mesh, not "
+            "--naive's, --gpu-driven's, --gpu-animate's, --pull's or a mesh file's; ignored\n");
+        config.impostor_pixels = 0.f;
+    }
+    if (config.impostor_pixels > 0.f && (config.deferred || config.light_count > 0 || config.oit || config.gpu_pick
+        || config.depth_prepass || config.vrs || config.window_count > 1))
+    {
+        fprintf(stderr, "Warning: --impostors are drawn unlit into the first window's forward pass, not with "
+            "--deferred, --lights, --oit, --gpu-pick, --depth-prepass, --vrs or --windows; ignored\n");
+        config.impostor_pixels = 0.f;
+    }
+    if (config.stereo && (config.draw_mode != DRAW_MODE_INSTANCED || camera_mode < 0 || config.shader_dir))
+    {
+        fprintf(stderr, "Warning: --stereo draws the instanced path from a perspective --camera, with the built-in "
+            "scene shaders; ignored\n");
+        config.stereo = false;
+    }
+    if (config.stereo && (config.window_count > 1 || wall_nodes || config.light_count > 0 || config.shadows
+        || config.taa || config.vrs || config.impostor_pixels > 0.f || config.particle_count > 0
+        || config.character_count > 0 || config.labels > 0 || config.terrain_size > 0.f || config.volume_side > 0
+        || config.volume_path))
+    {
+        fprintf(stderr, "Warning: --stereo draws the scene's objects alone for both eyes; --windows, --wall, "
+            "--lights, --shadows, --taa, --vrs, --impostors, --particles, --characters, --labels, --terrain and "
+            "--volume ignored\n");
+        config.window_count = 1;
+        wall_nodes = 0;
+        config.light_count = 0;
+        config.deferred = false;
+        config.shadows = 0;
+        config.taa = false;
+        config.vrs = FOVEATION_OFF;
+        config.impostor_pixels = 0.f;
+        config.particle_count = 0;
+        config.character_count = 0;
+        config.labels = 0;
+        config.terrain_size = 0.f;
+        config.volume_side = 0;
+        config.volume_path = NULL;
+    }
+    if (config.object_count < 1)
+        config.object_count = 1;
+    if (!(config.zoom > 0.f))
+        config.zoom = 1.f;
+    if (!vulkan && (ray_shadows || !ray_query || !async_compute))
+        fprintf(stderr, "Warning: --rt-shadows, --no-ray-query and --no-async-compute are for --vulkan; GL has "
+            "--shadows N and --gpu-pick\n");
+    if (vulkan && software)
+    {
+        fprintf(stderr, "Error: --vulkan and --software are two renderers; pick one\n");
+        exit(EXIT_FAILURE);
+    }
+    if (gles && (vulkan || software || config.xr))
+    {
+        fprintf(stderr, "Error: --gles is an OpenGL ES context for the GL renderer; not with --vulkan, --software or "
+            "--xr\n");
+        exit(EXIT_FAILURE);
+    }
+    if (software && config.headless_frames <= 0)
+    {
+        fprintf(stderr, "Error: --software draws offscreen, for --headless N frames\n");
+        exit(EXIT_FAILURE);
+    }
+#ifndef OPENGLTEST_VULKAN
+    if (vulkan)
+    {
+        fprintf(stderr, "Error: --vulkan needs a build configured with OPENGLTEST_VULKAN=ON\n");
+        exit(EXIT_FAILURE);
+    }
+#endif
+    if (vulkan || software)
+    {
+        const char* backend = vulkan ? "--vulkan" : "--software";
+        if (precompile_shaders || replay_path || bench_primitives > 0 || bench_submit > 0)
+        {
+            fprintf(stderr, "Error: --precompile-shaders, --replay, --bench-primitives and --bench-submit are for "
+                "the GL renderer, not %s\n", backend);
+            exit(EXIT_FAILURE);
+        }
+        // The objects alone, on the main thread: the GL renderer's passes, overlays and extra windows have no
+        // Vulkan or CPU side, and whatever needs a GL context (the streamer's shared one, the wall's) is left out
+        if (config.draw_mode == DRAW_MODE_GPU_DRIVEN || config.stream_mesh || config.mesh_path || config.window_count > 1
+            || config.character_count > 0 || config.particle_count > 0 || config.light_count > 0 || config.point_count > 0
+            || config.post || config.msaa_samples > 1 || config.depth || config.gpu_pick || config.record_path
+            || config.texture_path || config.material_count || config.gpu_animate || config.pull || config.oit || config.shadows
+            || config.taa || config.vrs || config.impostor_pixels > 0.f || config.terrain_size > 0.f || wall_nodes
+            || detail || config.volume_side > 0 || config.volume_path || config.stereo)
+            fprintf(stderr, "Warning: %s draws the built-in mesh's objects%s; the GL renderer's other options are "
+                "ignored\n", backend, vulkan ? ", instanced or --naive" : "");
+        config.draw_mode = config.draw_mode == DRAW_MODE_NAIVE && vulkan ? DRAW_MODE_NAIVE : DRAW_MODE_INSTANCED;
+        config.occlusion = config.meshlets = config.gpu_animate = false;
+        config.stream_mesh = config.mesh_path = NULL;
+        config.window_count = 1;
+        config.character_count = 0;
+        config.material_count = 0;
+        config.depth = config.depth_prepass = config.gpu_pick = false;
+        config.oit = OIT_OFF;
+        config.shadows = 0;
+        config.taa = false;
+        config.vrs = FOVEATION_OFF;
+        config.impostor_pixels = 0.f;
+        config.terrain_size = 0.f;
+        config.volume_side = 0;
+        config.volume_path = NULL;
+        config.record_path = NULL;
+        config.stereo = false;
+        detail = 0;
+        wall_nodes = 0;
+        render_thread = false;
+    }
+    if (config.xr && (!config.stereo || config.headless_frames > 0))
+    {
+        fprintf(stderr, "Warning: --xr presents --stereo's frames to a headset as they're drawn, not --vulkan's or "
+            "a --headless run's; ignored\n");
+        config.xr = false;
+    }
+    if (config.xr)
+    {
+#ifdef OPENGLTEST_OPENXR
+        // The runtime's frame calls and the GL context stay on one thread; the frames keep a depth texture for its
+        // reprojection, and are copied to it as drawn, with no post-processing chain writing the window instead
+        if (config.occlusion || config.post || on_demand)
+            fprintf(stderr, "Warning: --xr draws every frame with --depth's depth; --occlusion, --post and "
+                "--on-demand ignored\n");
+        config.occlusion = false;
+        config.post = NULL;
+        config.depth = true;
+        on_demand = false;
+        render_thread = false;
+#else
+        fprintf(stderr, "Error: --xr needs a build configured with OPENGLTEST_OPENXR=ON\n");
+        exit(EXIT_FAILURE);
+#endif
+    }
+
+    // Setup the error callback
+    glfwSetErrorCallback(error_callback);
+
+    // Try to init GLFW, exit on failure. --software needs no display, only the clock and a window to stand in.
+    if (software)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    {
+        STARTUP_SCOPE("glfwInit");
+        if (!glfwInit())
+            exit(EXIT_FAILURE);
+    }
+
+    // --cull-select: each frame culled by the CPU's sweep or --gpu-driven's compute pass, the cheaper of the two.
+    // The GPU's cull knows the instanced scene's objects where they were made, spinning in place, and draws level 0
+    // of the mesh into one view; what else the CPU's visible list feeds has no GPU counterpart.
+    if (cull_select && (config.draw_mode != DRAW_MODE_INSTANCED || !config.cull || config.gpu_animate || config.meshlets
+        || config.stereo || config.xr || config.shadows || config.impostor_pixels > 0.f || significance_pixels > 0.f
+        || coherent || cpu_occlusion || config.gpu_pick || config.window_count > 1 || wall_host || config.capture_path
+        || replay_path || scene_reload >= 0 || config.labels > 0 || vulkan || software
+        || (scene_path && config.material_count > 0)
+        || (bench_scene_spec && bench_params.dynamic && bench_params.depth)))
+    {
+        fprintf(stderr, "Warning: --cull-select switches between the instanced scene's CPU and --gpu-driven culls of "
+            "one view; --gpu-animate, --meshlets, --stereo, --shadows, --impostors, --significance, --coherent, "
+            "--cpu-occlusion, --gpu-pick, --windows, --wall, --capture, --replay, --scene-reload, --labels, a "
+            "--scene's materials, a moving --bench-scene, --no-cull and the other renderers have none, ignored\n");
+        cull_select = false;
+    }
+    if (cull_select)
+    {
+        cull_selector_init(&cull_selector, "main view");
+        config.cull_selector = &cull_selector;
+    }
+
+    // --gles: an OpenGL ES 3 context, for ARM tablets' tiled GPUs. ES 3.1 has the compute and shader storage --lights
+    // needs; the renderer's other 4.3 features are written for desktop GL and left out.
+    if (gles)
+        config_without_4_3(&config, "OpenGL ES (--gles)", true);
+
+    // Setup Window Hints
+    const bool want_4_3 = config.draw_mode == DRAW_MODE_GPU_DRIVEN || config.particle_count > 0 || config.character_count > 0
+        || config.light_count > 0 || config.point_count > 0 || config.gpu_animate || config.pull || config.oit || config.shadows
+        || (config.terrain_size > 0.f && config.terrain_tessellation) || config.volume_side > 0 || config.volume_path
+        || precompile_shaders || bench_primitives > 0 || bench_submit > 0 || config.cull_selector;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, want_4_3 ? 4 : 3);  // Required OpenGL version minimum
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);      // 4.3 brings compute shaders and multi-draw indirect (and GLSL 430)
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // Default core
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_DEBUG_LAYER ? GLFW_TRUE : GLFW_FALSE);  // every message, in debug builds
+    glfwWindowHint(GLFW_SAMPLES, 0);    // --msaa multisamples the offscreen scene; the window is only blitted to
+    if (config.headless_frames > 0 || precompile_shaders || bench_primitives > 0 || bench_submit > 0)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);       // the context is all the benchmark needs
+    if (egl)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);    // e.g. render nodes without GLX
+    if (gles)
+    {
+        // 3.1 where a 4.3 context would have been asked for (the lights), else 3.0; the profile hint is ignored
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, want_4_3 ? 1 : 0);
+    }
+    if (vulkan)
+    {
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);   // no context: vk/vulkan_renderer.h makes the window's surface
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);        // headless too, for the swapchain to present to
+    }
+    if (software)
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+    // Try to create window
+    const uint64_t window_begin = cpu_trace_now();
+    const int64_t window_begin_ns = startup_profile_now_ns();
+    GLFWwindow* window = glfwCreateWindow(640, 480, "OpenGL Triangle", NULL, NULL);
+    if (window && vulkan && config.headless_frames > 0)
+        glfwSetWindowSize(window, config.width, config.height);     // the benchmark's size is the swapchain's
+    if (!window && want_4_3 && !vulkan && !software)
+    {
+        // No 4.3 driver: 3.3 (ES 3.0) and CPU culling with instancing instead
+        config_without_4_3(&config, "no OpenGL 4.3 context", false);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, gles ? 0 : 3);
+        window = glfwCreateWindow(640, 480, "OpenGL Triangle", NULL, NULL);
+    }
+    if (!window)
+    {
+        // Exit on failure (window is NULL on failure)
+        glfwTerminate();
+        exit(EXIT_FAILURE);
+    }
+    startup_profile_record("window", window_begin, window_begin_ns);
+
+    // --precompile-shaders: the offline step. Every reachable scene variant this driver supports goes into the
+    // program binary cache, so no run compiles one on first use.
+    if (precompile_shaders)
+    {
+        glfwMakeContextCurrent(window);
+        gl_load(window);
+        gl_debug_init();    // compile warnings the info logs don't carry
+        ProgramCache cache;
+        program_cache_init(&cache, "shader_cache");
+        ShaderPermutation scene_shaders;
+        scene_shaders_init(&scene_shaders);
+        const bool ok = shader_permutation_precompile(&scene_shaders, &cache, stdout);
+        shader_permutation_destroy(&scene_shaders);
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // --bench-primitives: the compute primitives timed and checked, then exit. Without a 4.3 context the window
+    // above is a 3.3 one and the benchmark says so.
+    if (bench_primitives > 0)
+    {
+        glfwMakeContextCurrent(window);
+        gl_load(window);
+        gl_debug_init();
+        const bool ok = gpu_primitives_benchmark(bench_primitives, stdout);
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // --bench-submit: the triangle drawn N times by each submission strategy, timed, then exit. Without a 4.3
+    // context multi-draw and the GPU-driven cull are skipped.
+    if (bench_submit > 0)
+    {
+        glfwMakeContextCurrent(window);
+        gl_load(window);
+        gl_debug_init();
+        const bool ok = submit_benchmark(bench_submit, stdout);
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // The rest of a wall: same size, lined up to the right of the first window, each context sharing its
+    // objects. They follow the first window's size rather than being resized on their own.
+    GLFWwindow* windows[RENDER_MAX_WINDOWS] = { window };
+    if (wall_nodes && config.window_count > 1)
+    {
+        fprintf(stderr, "Warning: with --wall each node draws one window; --windows ignored\n");
+        config.window_count = 1;
+    }
+    int window_count = config.window_count < 1 ? 1 : config.window_count > RENDER_MAX_WINDOWS ? RENDER_MAX_WINDOWS : config.window_count;
+    if (window_count > 1 && (config.headless_frames > 0 || config.draw_mode != DRAW_MODE_INSTANCED))
+    {
+        fprintf(stderr, "Warning: --windows needs the instanced path and a visible window; drawing one window\n");
+        window_count = 1;
+    }
+    if (window_count > 1)
+    {
+        int x = 0, y = 0, width = 0, height = 0;
+        glfwGetWindowPos(window, &x, &y);
+        glfwGetWindowSize(window, &width, &height);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        for (int k = 1; k < window_count; ++k)
+        {
+            char title[64];
+            snprintf(title, sizeof(title), "OpenGL Triangle (%d/%d)", k + 1, window_count);
+            windows[k] = glfwCreateWindow(width, height, title, NULL, window);
+            if (!windows[k])
+            {
+                fprintf(stderr, "Warning: could only create %d of %d windows\n", k, window_count);
+                window_count = k;
+                break;
+            }
+            glfwSetWindowPos(windows[k], x + k * width, y);
+        }
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    }
+    if (window_count > 1 && config.light_count > 0)
+    {
+        // The clusters are tiles of one framebuffer; each window of the wall only sees a slice of the camera's
+        fprintf(stderr, "Warning: --lights draws one window; the wall is drawn unlit\n");
+        config.light_count = 0;
+        config.deferred = false;
+    }
+    if (window_count > 1 && config.resolution_budget_ms > 0.0)
+    {
+        fprintf(stderr, "Warning: --dynamic-res draws one window; the wall is drawn at full size\n");
+        config.resolution_budget_ms = 0.0;
+    }
+    if (window_count > 1 && config.msaa_samples > 1)
+    {
+        fprintf(stderr, "Warning: --msaa draws one window offscreen; the wall isn't multisampled\n");
+        config.msaa_samples = 0;
+    }
+    if (window_count > 1 && config.post)
+    {
+        fprintf(stderr, "Warning: --post draws one window; the wall is shown as drawn\n");
+        config.post = NULL;
+    }
+    if (window_count > 1 && config.depth)
+    {
+        // The other windows draw straight to their own framebuffers, which have no depth
+        fprintf(stderr, "Warning: --depth draws one window; the wall isn't depth tested\n");
+        config.depth = config.depth_prepass = false;
+    }
+    if (window_count > 1 && config.oit)
+    {
+        fprintf(stderr, "Warning: --oit draws one window; the wall is drawn opaque\n");
+        config.oit = OIT_OFF;
+    }
+    if (window_count > 1 && config.shadows)
+    {
+        fprintf(stderr, "Warning: --shadows draws one window; the wall is drawn without\n");
+        config.shadows = 0;
+    }
+    if (window_count > 1 && config.taa)
+    {
+        fprintf(stderr, "Warning: --taa resolves one window's offscreen frames; the wall is drawn without\n");
+        config.taa = false;
+    }
+    if (window_count > 1 && config.vrs)
+    {
+        fprintf(stderr, "Warning: --vrs shades one window's offscreen frames; the wall is drawn at full rate\n");
+        config.vrs = FOVEATION_OFF;
+    }
+    if (config.gpu_pick && (config.draw_mode != DRAW_MODE_INSTANCED || window_count > 1 || config.headless_frames > 0
+        || config.deferred || config.overdraw || config.msaa_samples > 1 || config.oit))
+    {
+        // The G-buffer and --oit's revealage have the second attachment already, and an integer one can't be
+        // resolved from samples
+        fprintf(stderr, "Warning: --gpu-pick reads one window's single-sample instanced forward pass; clicks are ray cast "
+            "through the BVH instead\n");
+        config.gpu_pick = false;
+    }
+    const int record_format = config.record_path ? screen_recorder_format_for(config.record_path) : -1;
+    if ((config.encoder || config.hevc || config.bitrate_kbps) && record_format != SCREEN_RECORDER_FFMPEG
+        && record_format != SCREEN_RECORDER_STREAM)
+    {
+        fprintf(stderr, "Warning: --encoder, --hevc and --bitrate set up ffmpeg, for --record's videos and streams; "
+            "ignored\n");
+        config.encoder = 0;
+        config.hevc = false;
+        config.bitrate_kbps = 0;
+    }
+    if (on_demand && (config.headless_frames > 0 || wall_nodes || vulkan || software))
+    {
+        fprintf(stderr, "Warning: --on-demand waits on a GL window's events, alone; every frame is drawn\n");
+        on_demand = false;
+    }
+    if (governor_ms > 0.0 && (wall_nodes || window_count > 1 || vulkan || software))
+    {
+        fprintf(stderr, "Warning: --governor steers one GL renderer; the quality stays as asked\n");
+        governor_ms = 0.0;
+    }
+    config.reversed_z = config.depth || vulkan;    // Vulkan's clip space has GL_ZERO_TO_ONE's depth range
+    config.window_count = window_count;
+    config.windows = windows;
+
+    // Pacing starts out as the command line asked; the L key toggles a limit of --fps-limit, or 60 without one
+    FramePacer pacer;
+    frame_pacer_init(&pacer, vsync, fps_limit, low_latency);
+    config.pacer = &pacer;
+    FrameSmoother clock;
+    frame_smoother_init(&clock, smooth);
+    // --on-demand: frames only when something asks for one, the first at once; the scene's clock starts stopped
+    RedrawPolicy redraw;
+    if (on_demand)
+    {
+        redraw_policy_init(&redraw, glfwGetTime());
+        config.redraw = &redraw;
+    }
+    // --governor: the renderer feeds it and applies its tiers, the scene its LOD error's
+    QualityGovernor governor;
+    if (governor_ms > 0.0)
+    {
+        quality_governor_init(&governor, governor_ms, glfwGetTime());
+        config.governor = &governor;
+    }
+
+    // Input callbacks - they only queue events, which the simulation takes each frame
+    WindowState window_state;
+    input_queue_init(&window_state.input);
+    window_state.pick = { false, 0.0, 0.0 };
+    window_state.focused = glfwGetWindowAttrib(window, GLFW_FOCUSED) != 0;
+    window_state.pacer = &pacer;
+    window_state.fps_limit = fps_limit > 0.0 ? fps_limit : 60.0;
+    window_state.smoother = &clock;
+    window_state.hud = show_hud;
+    window_state.input_time = 0.0;
+    window_state.title_time = 0.0;
+    memcpy(window_state.windows, windows, sizeof(windows));
+    window_state.window_count = window_count;
+    window_state.gpu_pick = config.gpu_pick;
+    window_state.screenshot = false;
+    window_state.paused = on_demand;
+    window_state.pause_time = 0.0;
+    window_state.paused_for = 0.0;
+    window_state.redraw = config.redraw;
+    window_state.idled = false;
+    window_state.drawn_camera = 0;
+    window_state.settings = NULL;
+    window_state.console = NULL;
+    window_state.vsync = vsync;
+    window_state.limit_fps = (int)fps_limit;
+    window_state.low_latency = low_latency;
+    // --world-offset: the grid sits that far out along x and y, and the camera looks at it from there
+    const dvec3 world_centre = { world_offset, world_offset, 0.0 };
+    CameraController controller;
+    window_state.controller = NULL;
+    if (camera_mode >= 0)
+    {
+        camera_controller_init(&controller, camera_mode, config.zoom, world_centre);
+        controller.far_plane = 1.5f * config.terrain_size;     // --terrain: its far corners from its middle
+        window_state.controller = &controller;
+    }
+    for (int k = 1; k < window_count; ++k)
+    {
+        // Keys work in every window of a wall; the mouse, resizes and focus are the first window's
+        glfwSetWindowUserPointer(windows[k], &window_state);
+        glfwSetKeyCallback(windows[k], key_callback);
+        glfwSetWindowCloseCallback(windows[k], window_close_callback);
+    }
+    glfwSetWindowUserPointer(window, &window_state);
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetWindowFocusCallback(window, window_focus_callback);
+    if (window_state.controller)
+        glfwSetCursorPosCallback(window, cursor_position_callback);
+    if (window_state.redraw)
+        glfwSetWindowRefreshCallback(window, window_refresh_callback);
+
+    // The camera is built once for the starting size and after that only when a resize event arrives, the
+    // wheel zooms or --camera's controller moves. The benchmark draws at --size and never resizes.
+    Camera camera;
+    camera_init(&camera, config.zoom);
+    camera_set_reversed_z(&camera, config.reversed_z);
+    // --stereo: the eyes converge where the controller's target starts out, a thirtieth of that apart
+    if (config.stereo)
+        camera_set_stereo(&camera, controller.distance / RENDER_STEREO_DEPTH_RATIO, controller.distance);
+    if (config.headless_frames > 0)
+        camera_set_viewport(&camera, config.width, config.height);
+    else
+    {
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        camera_set_viewport(&camera, width * window_count, height);
+    }
+
+    // --wall: every node joins before any draws, and each shows its column of the one view node 0 drives
+    WallSync wall;
+    if (wall_nodes)
+    {
+        char host[256];
+        int port = WALL_SYNC_PORT;
+        snprintf(host, sizeof(host), "%s", wall_host);
+        char* colon = strrchr(host, ':');
+        if (colon)
+        {
+            port = atoi(colon + 1);
+            *colon = '\0';
+        }
+        printf("wall: node %d of %d, %s on port %d\n", wall_node, wall_nodes,
+            wall_node ? "joining the leader" : "waiting for the followers", port);
+        if (!wall_sync_init(&wall, wall_node, wall_nodes, host, port))
+            exit(EXIT_FAILURE);
+        config.wall = &wall;
+        camera_set_tile(&camera, wall_node / (float)wall_nodes, 0.f, (wall_node + 1) / (float)wall_nodes, 1.f);
+    }
+
+    // The CPU's topology (--topology prints it). On a machine with several NUMA nodes the frame's data goes on one
+    // node, with the main and render threads: the GPU's, where its uploads cross the fewest links (a wall's node I
+    // takes GPU I's), unless --numa-node says otherwise.
+    CpuTopology topology;
+    cpu_topology_probe(&topology);
+    if (show_topology)
+        cpu_topology_print(&topology, stdout);
+    int numa_node = -1;
+    if (affinity && topology.nodes > 1)
+    {
+        numa_node = numa_node_arg >= 0 ? numa_node_arg : numa_gpu_node(wall_nodes ? wall_node : 0);
+        if (numa_node < 0 || numa_node >= topology.nodes)
+        {
+            if (numa_node_arg >= 0)
+                fprintf(stderr, "Warning: --numa-node %d isn't one of the %d nodes\n", numa_node_arg, topology.nodes);
+            numa_node = 0;
+        }
+    }
+
+    // Background loading: the built-in triangle is drawn until the streamed mesh has been uploaded.
+    // Without a shared context the file is loaded synchronously instead.
+    AssetStreamer streamer;
+    if (config.stream_mesh)
+    {
+        if (asset_streamer_init(&streamer, window, config.io_backend, 2,
+            (size_t)(config.upload_budget_kb > 0 ? config.upload_budget_kb : 0) * 1024))
+        {
+            asset_streamer_set_node(&streamer, numa_node);
+            config.streamer = &streamer;
+            config.streamed_mesh = config.package && package_find(config.package, config.stream_mesh) >= 0
+                ? asset_streamer_load_packaged_mesh(&streamer, config.package, config.stream_mesh)
+                : asset_streamer_load_mesh(&streamer, config.stream_mesh);
+        }
+        else if (!config.mesh_path)
+            config.mesh_path = config.stream_mesh;
+    }
+
+    Scene scene;
+    {
+        STARTUP_SCOPE("scene");
+        ALLOC_TAG_SCOPE(ALLOC_TAG_SCENE);
+        if (scene_file.header)
+            scene_init_file(&scene, &scene_file, tick_rate);
+        else if (bench_scene_spec)
+        {
+            // The same bounding circle the grid's triangle has
+            float mesh_radius = 0.f;
+            for (size_t v = 0; v < sizeof(vertices) / sizeof(vertices[0]); ++v)
+                mesh_radius = fmaxf(mesh_radius, vec2_len(vertices[v].pos));
+            if (!bench_scene_generate(&bench_scene, &bench_params, mesh_radius))
+                exit(EXIT_FAILURE);
+            bench_scene_print(&bench_scene, stdout);
+            scene_init_bench(&scene, &bench_scene, tick_rate);
+        }
+        else
+            scene_init(&scene, config.object_count, tick_rate);
+        if (spatial_grid && scene_use_grid(&scene))
+            printf("scene: spatial hash grid of %u slots, cells %.4g units\n", scene.grid.slot_count,
+                (double)scene.grid_cell);
+        if (broadphase && !scene_use_broadphase(&scene))
+            fprintf(stderr, "Warning: --broadphase goes through --spatial-index grid's grid; ignored without it\n");
+        if (cpu_occlusion && scene_use_occlusion(&scene))
+            printf("scene: CPU occlusion culling at %dx%d, up to %d occluders\n", scene.occlusion->width,
+                scene.occlusion->height, SCENE_OCCLUDERS);
+        if (config.impostor_pixels > 0.f && scene_use_impostors(&scene, config.impostor_pixels))
+            printf("scene: objects under %g px drawn as impostors\n", (double)scene.impostor_pixels);
+        if (significance_pixels > 0.f && (config.draw_mode == DRAW_MODE_GPU_DRIVEN || config.gpu_animate))
+            fprintf(stderr, "Warning: --significance throttles the CPU's updates; --gpu-driven and --gpu-animate "
+                "have none, ignored\n");
+        else if (significance_pixels > 0.f && scene_use_significance(&scene, significance_pixels))
+            printf("scene: objects under %g px updated every 2 to %u frames, those out of view not at all\n",
+                (double)significance_pixels, SIGNIFICANCE_MAX_PERIOD);
+        if (coherent && (config.draw_mode == DRAW_MODE_GPU_DRIVEN || config.gpu_animate || !config.cull))
+            fprintf(stderr, "Warning: --coherent carries the CPU's culling over from frame to frame; --gpu-driven, "
+                "--gpu-animate and --no-cull have none, ignored\n");
+        else if (coherent && scene_use_coherent(&scene))
+            printf("scene: culled and sorted near to far from the last frame's results, the objects near the "
+                "frustum's sides tested again\n");
+    }
+    scene.material_count = config.material_count;
+    // Camera-relative rendering: the camera's matrices take positions relative to the scene's origin, which is
+    // what the scene's floats are, so objects, bounds and culling stay small numbers however far out it is
+    dvec3_dup(scene.origin, world_centre);
+    camera_set_origin(&camera, scene.origin);
+    config.scene = &scene;
+    SceneReload reload;
+    if (scene_reload >= 0
+        && scene_reload_init(&reload, scene_path, config.object_count, &scene, &scene_file, tick_rate))
+    {
+        config.scene_reload = &reload;
+        printf("scene: watching %s; new versions of up to %d objects are loaded in the background\n", scene_path,
+            config.object_count);
+    }
+    if (save_scene_path && scene_save(&scene, save_scene_path, config.stream_mesh ? config.stream_mesh : config.mesh_path))
+        printf("scene: %d objects written to %s\n", scene.count, save_scene_path);
+
+    // Levels of detail: the scene chooses between the drawn mesh's, so it needs their errors up front. A mesh
+    // file's are read from its header here; the streamed mesh's stand in while the built-in one is drawn (the
+    // renderer clamps to the levels it has).
+    DetailMesh detail_mesh;
+    memset(&detail_mesh, 0, sizeof(detail_mesh));
+    if (detail > 0)
+    {
+        STARTUP_SCOPE("detail mesh");
+        ALLOC_TAG_SCOPE(ALLOC_TAG_ASSETS);
+        if (detail <= DETAIL_MAX && detail_mesh_init(&detail_mesh, detail))
+            config.detail = &detail_mesh;
+        else
+        {
+            fprintf(stderr, "Warning: --detail %d is left out (1 to %d)\n", detail, DETAIL_MAX);
+            detail_mesh_free(&detail_mesh);
+        }
+    }
+    const char* lod_file = config.stream_mesh ? config.stream_mesh : config.mesh_path;
+    MeshFile lod_header;
+    if (lod_file && open_mesh_file(&lod_header, config.package, lod_file))
+    {
+        scene.lod_chain.level_count = (int)lod_header.lod_count;
+        for (uint32_t l = 0; l < lod_header.lod_count; ++l)
+            scene.lod_chain.error[l] = lod_header.lods[l].error * scene.scale;
+        mesh_file_close(&lod_header);
+    }
+    else if (config.detail)
+    {
+        scene.lod_chain.level_count = detail_mesh.lod_count;
+        for (int l = 0; l < detail_mesh.lod_count; ++l)
+            scene.lod_chain.error[l] = detail_mesh.lods[l].error * scene.scale;
+    }
+    scene.lod_error = lod_error > 0.f && !config.cull_selector ? lod_error : 0.f;   // the GPU's cull draws level 0
+    scene.governor = config.governor;
+
+    // --console: the settings that can change while it runs, over the variables their readers already use
+    static const char* const vsync_modes[] = { "off", "on", "adaptive" };
+    Settings settings;
+    SettingsConsole settings_console;
+    settings_init(&settings);
+    settings_add_choice(&settings, "vsync", &window_state.vsync, vsync_modes, VSYNC_MODE_COUNT, "swap interval (V)");
+    settings_add_int(&settings, "fps-limit", &window_state.limit_fps, 0, 1000, "frame rate limit, 0 for none (L)");
+    settings_add_bool(&settings, "low-latency", &window_state.low_latency, "input read after the limiter's wait (F)");
+    settings_add_bool(&settings, "cull", &config.cull, "frustum culling");
+    settings_add_float(&settings, "lod-error", &scene.lod_error, 0.f, 64.f, "pixels a level's error may project to");
+    settings_add_float(&settings, "render-scale", &config.render_scale, 0.25f, 1.f, "of the window's size, drawn");
+    settings_add_int(&settings, "upload-budget", &config.upload_budget_kb, 0, 1 << 20, "KB streamed per frame, 0 for any");
+    settings_add_int(&settings, "vram-budget", &config.vram_budget_mb, 0, 1 << 20, "MB of video memory, 0 for none");
+    if (console)
+    {
+        window_state.settings = &settings;
+        window_state.console = &settings_console;
+        settings_console_start(&settings_console, stdout);
+        settings_print(&settings, stdout);
+    }
+    Characters characters;
+    if (config.character_count > 0)
+    {
+        STARTUP_SCOPE("characters");
+        ALLOC_TAG_SCOPE(ALLOC_TAG_ASSETS);
+        if (characters_init(&characters, config.character_count, config.bake_animation))
+            config.characters = &characters;
+        else
+        {
+            fprintf(stderr, "Warning: --characters is left out\n");
+            characters_free(&characters);
+        }
+    }
+
+    // Worker pool for the simulation; the main thread is its thread 0. A thread per physical core, the SMT siblings
+    // left to the render thread, or without SMT one core (--jobs N overrides the total)
+    JobSystem jobs;
+    {
+        STARTUP_SCOPE("job system");
+        job_system_init(&jobs, job_threads > 0 ? job_threads : cpu_topology_job_threads(&topology, render_thread));
+    }
+
+    // Where the threads run. --affinity auto keeps the main and render threads on the performance cores of a hybrid
+    // CPU (numa_node's, on a machine with several nodes), so the scheduler can't put the frame's critical path on an
+    // efficiency core. The workers go wherever the OS puts them, but with several nodes they're spread over them,
+    // each pinned to one, in order from the main thread's node. --main-cpus, --render-cpus and --worker-cpus
+    // override it. The main thread is placed after the workers start, which would otherwise inherit its affinity.
+    int thread_nodes[JOB_SYSTEM_MAX_THREADS];
+    for (int i = 0; i < jobs.thread_count; ++i)
+        thread_nodes[i] = -1;
+    if (numa_node >= 0 && !cpu_set_count(&worker_cpus))
+    {
+        thread_nodes[0] = numa_node;
+        for (int i = 1; i < jobs.thread_count; ++i)
+        {
+            CpuSet node_cpus;
+            const int node = (numa_node + i * topology.nodes / jobs.thread_count) % topology.nodes;
+            cpu_topology_node(&topology, node, &node_cpus);
+            if (cpu_set_count(&node_cpus) && cpu_thread_pin(&jobs.workers[i - 1], &node_cpus))
+                thread_nodes[i] = node;
+        }
+        job_system_set_nodes(&jobs, thread_nodes);
+    }
+    if (affinity && (topology.hybrid || numa_node >= 0))
+    {
+        CpuSet performance;
+        cpu_topology_performance(&topology, numa_node, &performance);
+        if (!cpu_set_count(&main_cpus))
+            main_cpus = performance;
+        if (!cpu_set_count(&render_cpus))
+            render_cpus = performance;
+    }
+    if (cpu_set_count(&main_cpus) && !cpu_set_count(&render_cpus))
+    {
+        for (int i = 0; i < topology.count; ++i)    // anywhere, not where it would inherit from the main thread
+            cpu_set_add(&render_cpus, topology.cpus[i].number);
+    }
+    for (int i = 1; cpu_set_count(&worker_cpus) && i < jobs.thread_count; ++i)
+    {
+        if (!cpu_thread_pin(&jobs.workers[i - 1], &worker_cpus))
+            fprintf(stderr, "Warning: worker %d couldn't be pinned\n", i);
+    }
+    if (cpu_set_count(&main_cpus) && !cpu_thread_pin(NULL, &main_cpus))
+        fprintf(stderr, "Warning: the main thread couldn't be pinned\n");
+    if (config.high_priority && !cpu_thread_raise_priority())
+        fprintf(stderr, "Warning: the main thread's priority couldn't be raised\n");
+    config.render_cpus = render_thread && cpu_set_count(&render_cpus) ? &render_cpus : NULL;
+    if (show_topology)
+    {
+        char main_text[256], render_text[256], worker_text[256];
+        cpu_set_format(&main_cpus, main_text, sizeof(main_text));
+        cpu_set_format(&render_cpus, render_text, sizeof(render_text));
+        cpu_set_format(&worker_cpus, worker_text, sizeof(worker_text));
+        printf("threads: %d jobs; main on %s, render on %s, workers on %s\n", jobs.thread_count,
+            main_text[0] ? main_text : "any CPU", config.render_cpus ? render_text : render_thread ? "any CPU" : "the main thread",
+            worker_text[0] ? worker_text : numa_node >= 0 ? "their nodes" : "any CPU");
+        if (numa_node >= 0)
+            printf("numa: the frame's data on node %d\n", numa_node);
+    }
+
+    // Double-buffered frame packets: the main thread fills one while the render thread consumes the other
+    FramePacket packets[FRAME_QUEUE_SLOTS];
+    void* packet_slots[FRAME_QUEUE_SLOTS];
+    for (int i = 0; i < FRAME_QUEUE_SLOTS; ++i)
+    {
+        // Sized for the worst case: every object visible and every character's palette, plus each job's scratch
+        packets[i].models = NULL;
+        packets[i].materials = NULL;
+        packets[i].objects = NULL;
+        packets[i].pick = { false, 0.0, 0.0 };
+        packets[i].palettes = NULL;
+        packets[i].redraw = 0;
+        packets[i].resumed = false;
+        memset(packets[i].lod_counts, 0, sizeof(packets[i].lod_counts));
+        packets[i].impostor_count = 0;
+        // With several NUMA nodes, each job thread's scratch goes on its node and the rest on the main thread's
+        frame_arena_init_numa(&packets[i].arena, (sizeof(mat3x4) + (config.gpu_pick ? 4 : 3) * sizeof(uint32_t))
+            * config.object_count
+            + sizeof(mat3x4) * CHARACTER_JOINTS * (config.characters && !characters.baked ? characters.count : 0)
+            + 6 * FRAME_ARENA_ALIGN
+            + (scene.occlusion ? 3 * (sizeof(float) * SCENE_OCCLUDERS * (sizeof(indices) / sizeof(indices[0]))
+                + FRAME_ARENA_ALIGN) : 0)      // --cpu-occlusion's occluder vertices
+            + (scene.impostor ? sizeof(uint32_t) * config.object_count + FRAME_ARENA_ALIGN : 0)    // --impostors' split
+            + (scene.significance ? 2 * (sizeof(uint32_t) * config.object_count + FRAME_ARENA_ALIGN) : 0), // and due
+            jobs.thread_count, SCENE_UPDATE_SCRATCH, numa_node, thread_nodes);
+        command_list_init(&packets[i].commands, config.draw_mode == DRAW_MODE_NAIVE ? config.object_count : 0,
+            jobs.thread_count);
+        packet_slots[i] = &packets[i];
+    }
+    if (huge_pages_enabled() && !huge_page_size())
+        fprintf(stderr, "Warning: --huge-pages: this system has no huge pages\n");
+    else if (huge_pages_enabled())
+        printf("huge pages: %zu KB; frame arenas in %s\n", huge_page_size() / 1024,
+            packets[0].arena.huge_pages ? "huge pages" : "normal pages (too small, or none to be had)");
+
+    Renderer renderer;
+    if (software)
+    {
+        if (!run_software(window, &scene, &jobs, &packets[0], &camera, &window_state, &config))
+            fprintf(stderr, "Error: the software renderer failed\n");
+    }
+    else
+#ifdef OPENGLTEST_VULKAN
+    if (vulkan)
+    {
+        if (!run_vulkan(window, &scene, &jobs, &packets[0], &camera, &window_state, &config, vsync != VSYNC_OFF,
+            ray_query, ray_shadows, async_compute))
+            fprintf(stderr, "Error: the Vulkan renderer failed\n");
+    }
+    else
+#endif
+    if (!render_thread)
+        run_single_threaded(&renderer, window, &scene, &jobs, &packets[0], &camera, &window_state, &config);
+    else
+    {
+        FrameQueue queue;
+        frame_queue_init(&queue, packet_slots);
+
+        // The context is made current on the render thread only; event polling stays here, as GLFW requires
+        std::thread renderer_thread(render_thread_main, &renderer, &queue, window, &config);
+
+        ALLOC_TAG_SCOPE(ALLOC_TAG_FRAME);
+        unsigned int frame_index = 0;
+
+        // While the window should not close (or until every benchmark frame has been handed over)
+        while (!glfwWindowShouldClose(window) && (!config.headless_frames || (int)frame_index < config.headless_frames))
+        {
+            {
+                CPU_TRACE_SCOPE("poll");
+                glfwPollEvents();   // process all pending events in the event queue (inputs, e.g.)
+            }
+            if (window_state.redraw && !redraw_wanted(&window_state))
+                continue;
+
+            // Both packets in flight: the render thread is behind (usually blocked in the swap), keep handling input.
+            // The benchmark has no input to handle and just waits for the next free packet.
+            FramePacket* packet = (FramePacket*)(config.headless_frames > 0 ? frame_queue_acquire_write(&queue)
+                : frame_queue_try_acquire_write(&queue));
+            if (!packet)
+            {
+                glfwWaitEventsTimeout(0.001);
+                continue;
+            }
+            frame_arena_reset(&packet->arena);  // released by the render thread before its swap: last use is over
+            packet->settings = frame_settings(&config);
+            if (replay.frame_count)
+            {
+                replay_packet(&replay, frame_index++, packet);
+                if (config.draw_mode == DRAW_MODE_NAIVE)
+                    scene_record_draws(packet, &jobs, false);
+                frame_queue_publish(&queue);
+                alloc_frame_end(&config);
+                continue;
+            }
+
+            if (config.scene_reload)
+                scene_reload_poll(config.scene_reload, &scene);    // between frames: the last packet's been published
+            alloc_frame_begin(&config, frame_index);
+            packet->time = scene_clock(&window_state, frame_smoother_step(&clock, glfwGetTime(), &packet->delta),
+                &packet->delta);
+            packet->frame_index = frame_index++;
+            packet->input_time = process_input(&window_state, window, &camera, config.headless_frames > 0);
+            if (config.wall && !wall_share_frame(config.wall, &packet->time, &packet->delta, &camera, &window_state.hud))
+                glfwSetWindowShouldClose(window, GLFW_TRUE);    // the leader has gone
+            packet->camera = camera;
+            packet->hud = window_state.hud;
+            packet->screenshot = window_state.screenshot;
+            window_state.screenshot = false;
+            pick_if_requested(&window_state, window, &scene, &camera, &packet->pick);
+            if (window_state.redraw)
+                redraw_frame(&window_state, packet);
+
+            // Simulate and cull the next frame while the last one is drawn (on the GPU, for the GPU-driven path).
+            // The ticks keep to real time whatever the frame rate; the matrices are interpolated between the last two.
+            // With --gpu-animate only the clock ticks here: the objects are the GPU's altogether. --cull-select
+            // picks the frame's path first and, on the CPU's, times the objects' turns, cull and matrices.
+            packet->gpu_cull = config.cull_selector && cull_selector_next(config.cull_selector) == CULL_PATH_GPU;
+            const bool cpu_objects = config.draw_mode != DRAW_MODE_GPU_DRIVEN && !config.gpu_animate
+                && !packet->gpu_cull;
+            const double cull_start = frame_pacer_now();
+            scene_simulate(&scene, &jobs, packet->delta, cpu_objects);
+            packet->sim_time = fixed_timestep_time(&scene.step);
+            packet->models = !cpu_objects ? NULL
+                : (mat3x4*)frame_arena_alloc(&packet->arena, sizeof(mat3x4) * scene.count);
+            packet->materials = !cpu_objects || !scene.material_count ? NULL
+                : (uint32_t*)frame_arena_alloc(&packet->arena, sizeof(uint32_t) * scene.count);
+            packet->objects = !cpu_objects || !config.gpu_pick ? NULL
+                : (uint32_t*)frame_arena_alloc(&packet->arena, sizeof(uint32_t) * scene.count);
+            packet->visible_count = config.gpu_animate ? scene_gpu_animated(&scene, packet->lod_counts)
+                : scene_update(&scene, &jobs, &packet->arena, config.cull ? &camera.frustum : NULL, &camera,
+                    packet->models, packet->materials, packet->objects, packet->lod_counts, &packet->impostor_count);
+            if (config.cull_selector && !packet->gpu_cull)
+                cull_selector_cost(config.cull_selector, CULL_PATH_CPU, 1000.0 * (frame_pacer_now() - cull_start));
+            if (config.draw_mode == DRAW_MODE_NAIVE)
+                scene_record_draws(packet, &jobs, scene.coherent != NULL);
+            if (config.characters && !characters.baked)
+            {
+                packet->palettes = (mat3x4*)frame_arena_alloc(&packet->arena, sizeof(mat3x4) * CHARACTER_JOINTS * characters.count);
+                characters_pose(&characters, &jobs, packet->time, packet->palettes);
+            }
+            frame_queue_publish(&queue);
+            alloc_frame_end(&config);
+            if (!config.headless_frames)
+                show_latency(&window_state, window);
+        }
+
+        frame_queue_close(&queue);
+        renderer_thread.join();
+    }
+    if (config.redraw)
+        redraw_policy_print(config.redraw, glfwGetTime(), stdout);
+    if (config.governor)
+        quality_governor_print(config.governor, glfwGetTime(), stdout);
+    if (config.cull_selector)
+        cull_selector_print(config.cull_selector, stdout);
+    if (config.wall)
+        wall_sync_destroy(config.wall);     // the followers' runs end here, if this is the leader
+    if (replay.frame_count)
+        frame_capture_close_reader(&replay);
+    if (config.characters)
+        characters_free(&characters);
+    detail_mesh_free(&detail_mesh);
+
+    for (int i = 0; i < FRAME_QUEUE_SLOTS; ++i)
+    {
+        if (config.profile && (render_thread || i == 0))
+        {
+            frame_arena_print(&packets[i].arena, i ? "frame arena 1" : "frame arena 0", stdout);
+            if (config.draw_mode == DRAW_MODE_NAIVE)
+                command_list_print(&packets[i].commands, i ? "command list 1" : "command list 0", stdout);
+        }
+        frame_arena_destroy(&packets[i].arena);
+        command_list_destroy(&packets[i].commands);
+    }
+    if (config.alloc_stats)
+        alloc_tracker_print(stdout);
+    if (config.profile)
+        printf("simulation: %llu ticks at %.1f Hz, %llu dropped after stalls\n", (unsigned long long)scene.step.ticks,
+            1.0 / scene.step.dt, (unsigned long long)scene.step.dropped_ticks);
+    if (config.profile && scene.significance)
+        significance_print(scene.significance, stdout);
+    if (config.profile && scene.coherent)
+        coherent_cull_print(scene.coherent, stdout);
+    if (scene.broadphase)
+    {
+        const Broadphase* bp = scene.broadphase;
+        printf("broadphase: %u overlapping pairs after %llu updates; the last moved %u objects, kept %u pairs, %u "
+            "began and %u ended, %llu dropped\n", bp->pairs.count, (unsigned long long)bp->updates, bp->moved_count,
+            bp->kept, bp->began, bp->ended, (unsigned long long)bp->dropped);
+    }
+    if (console)
+        settings_console_stop(&settings_console);
+    if (config.scene_reload)
+    {
+        if (config.profile)
+            scene_reload_print(config.scene_reload, stdout);
+        scene_reload_destroy(config.scene_reload);
+    }
+    job_system_destroy(&jobs);
+    scene_free(&scene);
+    scene_file_close(&scene_file);     // after the scene, whose arrays may be its mapping
+    bench_scene_destroy(&bench_scene); // or the generator's
+    if (config.streamer)
+    {
+        asset_streamer_destroy(&streamer);
+        printf("streamed %zu bytes, %u frames hit the upload budget\n", streamer.bytes_uploaded, streamer.frames_throttled);
+    }
+    package_close(&package);           // after the streamer, which may still have been unpacking from it
+    metrics_server_stop();
+
+    // Every traced thread has stopped by now
+    if (trace_path)
+    {
+        cpu_trace_write(trace_path);
+        cpu_trace_shutdown();
+    }
+
+    // Destroy window on "esc"
+    for (int k = window_count - 1; k > 0; --k)
+        glfwDestroyWindow(windows[k]);
+    glfwDestroyWindow(window);
+
+    // Terminate GLFW
+    glfwTerminate();
+
+    // Exit, with success code
+    exit(EXIT_SUCCESS);
+}
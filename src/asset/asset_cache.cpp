@@ -0,0 +1,461 @@
+#include "asset/asset_cache.h"
+
+#include "core/mapped_file.h"
+
+#include <chrono>
+#include <filesystem>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define STAMP_RACY_SECONDS 2
+
+typedef struct ManifestEntry
+{
+    uint64_t hash;
+    uint64_t size;
+    char name[256];
+} ManifestEntry;
+
+static const uint64_t XXH_P1 = 11400714785074694791ull;
+static const uint64_t XXH_P2 = 14029467366897019727ull;
+static const uint64_t XXH_P3 = 1609587929392839161ull;
+static const uint64_t XXH_P4 = 9650029242287828579ull;
+static const uint64_t XXH_P5 = 2870177450012600261ull;
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return x << r | x >> (64 - r);
+}
+
+static inline uint64_t read64(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+    return rotl64(acc + input * XXH_P2, 31) * XXH_P1;
+}
+
+static inline uint64_t xxh_merge(uint64_t acc, uint64_t v)
+{
+    return (acc ^ xxh_round(0, v)) * XXH_P1 + XXH_P4;
+}
+
+uint64_t asset_hash(uint64_t seed, const void* data, size_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + size;
+    uint64_t h;
+    if (size >= 32)
+    {
+        // Four independent lanes over 32-byte stripes, so the multiplies overlap
+        uint64_t v1 = seed + XXH_P1 + XXH_P2, v2 = seed + XXH_P2, v3 = seed, v4 = seed - XXH_P1;
+        for (; p + 32 <= end; p += 32)
+        {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh_merge(xxh_merge(xxh_merge(xxh_merge(h, v1), v2), v3), v4);
+    }
+    else
+        h = seed + XXH_P5;
+    h += size;
+    for (; p + 8 <= end; p += 8)
+        h = rotl64(h ^ xxh_round(0, read64(p)), 27) * XXH_P1 + XXH_P4;
+    if (p + 4 <= end)
+    {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        h = rotl64(h ^ (uint64_t)v * XXH_P1, 23) * XXH_P2 + XXH_P3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+        h = rotl64(h ^ *p * XXH_P5, 11) * XXH_P1;
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    return h ^ h >> 32;
+}
+
+// --- Remembered file hashes ---
+
+static AssetFileStamp* find_stamp(AssetFileStamp* stamps, uint32_t capacity, uint64_t path_hash)
+{
+    for (uint32_t i = (uint32_t)path_hash & (capacity - 1);; i = (i + 1) & (capacity - 1))
+        if (stamps[i].path_hash == path_hash || !stamps[i].path_hash)
+            return &stamps[i];
+}
+
+static bool put_stamp(AssetCache* cache, const AssetFileStamp* stamp)
+{
+    if (2 * (cache->stamp_count + 1) > cache->stamp_capacity)
+    {
+        const uint32_t capacity = cache->stamp_capacity ? 2 * cache->stamp_capacity : 1024;
+        AssetFileStamp* stamps = (AssetFileStamp*)calloc(capacity, sizeof(AssetFileStamp));
+        if (!stamps)
+            return false;
+        for (uint32_t i = 0; i < cache->stamp_capacity; ++i)
+            if (cache->stamps[i].path_hash)
+                *find_stamp(stamps, capacity, cache->stamps[i].path_hash) = cache->stamps[i];
+        free(cache->stamps);
+        cache->stamps = stamps;
+        cache->stamp_capacity = capacity;
+    }
+    AssetFileStamp* slot = find_stamp(cache->stamps, cache->stamp_capacity, stamp->path_hash);
+    cache->stamp_count += !slot->path_hash;
+    *slot = *stamp;
+    cache->stamps_changed = true;
+    return true;
+}
+
+static void stamps_path(const AssetCache* cache, char* path, size_t size)
+{
+    snprintf(path, size, "%s/stamps", cache->dir);
+}
+
+bool asset_cache_init(AssetCache* cache, const char* dir, const char* shared_dir)
+{
+    snprintf(cache->dir, sizeof(cache->dir), "%s", dir ? dir : "");
+    snprintf(cache->shared, sizeof(cache->shared), "%s", shared_dir ? shared_dir : "");
+    cache->stamps = NULL;
+    cache->stamp_capacity = cache->stamp_count = 0;
+    cache->stamps_changed = false;
+    cache->hashed_bytes = 0;
+    cache->hashed_files = 0;
+    cache->stamp_hits = 0;
+    const char* dirs[2] = { cache->dir, cache->shared };
+    for (int d = 0; d < 2; ++d)
+    {
+        std::error_code ec;
+        if (dirs[d][0])
+            std::filesystem::create_directories(std::filesystem::path(dirs[d]) / "actions", ec);
+        if (ec)
+        {
+            fprintf(stderr, "asset_cache: can't create %s: %s\n", dirs[d], ec.message().c_str());
+            return false;
+        }
+    }
+    if (!cache->dir[0])
+        return true;
+    char path[600];
+    stamps_path(cache, path, sizeof(path));
+    FILE* f = fopen(path, "r");
+    AssetFileStamp stamp;
+    unsigned long long path_hash, size, hash;
+    long long mtime;
+    while (f && fscanf(f, "%llx %llu %lld %llx", &path_hash, &size, &mtime, &hash) == 4)
+    {
+        stamp = { path_hash, size, mtime, hash };
+        if (stamp.path_hash && !put_stamp(cache, &stamp))
+            break;
+    }
+    if (f)
+        fclose(f);
+    cache->stamps_changed = false;
+    return true;
+}
+
+void asset_cache_destroy(AssetCache* cache)
+{
+    if (cache->dir[0] && cache->stamps_changed)
+    {
+        char path[600], temp[620];
+        stamps_path(cache, path, sizeof(path));
+        snprintf(temp, sizeof(temp), "%s.tmp", path);
+        FILE* f = fopen(temp, "w");
+        bool ok = f != NULL;
+        for (uint32_t i = 0; ok && i < cache->stamp_capacity; ++i)
+        {
+            const AssetFileStamp* s = &cache->stamps[i];
+            if (s->path_hash)
+                ok = fprintf(f, "%016llx %llu %lld %016llx\n", (unsigned long long)s->path_hash,
+                    (unsigned long long)s->size, (long long)s->mtime, (unsigned long long)s->hash) > 0;
+        }
+        ok = f && fclose(f) == 0 && ok;
+        std::error_code ec;
+        if (ok)
+            std::filesystem::rename(temp, path, ec);
+        if (!ok || ec)
+            fprintf(stderr, "asset_cache: can't save %s\n", path);
+    }
+    free(cache->stamps);
+    cache->stamps = NULL;
+    cache->stamp_capacity = cache->stamp_count = 0;
+}
+
+bool asset_cache_file_hash(AssetCache* cache, const char* path, uint64_t* hash)
+{
+    std::error_code ec;
+    const std::filesystem::path p(path);
+    const uint64_t size = std::filesystem::file_size(p, ec);
+    const std::filesystem::file_time_type time = ec ? std::filesystem::file_time_type() : std::filesystem::last_write_time(p, ec);
+    if (ec)
+    {
+        fprintf(stderr, "asset_cache: can't read %s: %s\n", path, ec.message().c_str());
+        return false;
+    }
+    const int64_t mtime = (int64_t)time.time_since_epoch().count();
+    const uint64_t path_hash = asset_hash(0, path, strlen(path)) | 1;   // never 0, the empty slot
+    if (cache->dir[0])
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        const AssetFileStamp* s = cache->stamp_capacity ? find_stamp(cache->stamps, cache->stamp_capacity, path_hash) : NULL;
+        if (s && s->path_hash && s->size == size && s->mtime == mtime)
+        {
+            *hash = s->hash;
+            ++cache->stamp_hits;
+            return true;
+        }
+    }
+
+    MappedFile file;
+    if (size == 0)
+        *hash = asset_hash(0, "", 0);     // mapped_file_open refuses empty files
+    else if (mapped_file_open(&file, path))
+    {
+        *hash = asset_hash(0, file.data, file.size);
+        mapped_file_close(&file);
+    }
+    else
+        return false;
+    cache->hashed_bytes += size;
+    ++cache->hashed_files;
+
+    // A file written within the time stamp's resolution of now could change again without its stamp changing
+    const bool settled = std::filesystem::file_time_type::clock::now() - time > std::chrono::seconds(STAMP_RACY_SECONDS);
+    if (cache->dir[0] && settled)
+    {
+        const AssetFileStamp stamp = { path_hash, size, mtime, *hash };
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        put_stamp(cache, &stamp);
+    }
+    return true;
+}
+
+// --- Manifests and blobs ---
+
+static bool read_manifest(const char* path, uint64_t key, ManifestEntry** entries, uint32_t* count)
+{
+    *entries = NULL;
+    *count = 0;
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return false;
+    int version = 0;
+    unsigned long long file_key = 0;
+    uint32_t capacity = 0;
+    bool ok = fscanf(f, "ogt-cook %d %llx\n", &version, &file_key) == 2 && version == ASSET_CACHE_VERSION
+        && file_key == key;
+    ManifestEntry e;
+    unsigned long long hash, size;
+    while (ok && fscanf(f, "%llx %llu %255[^\n]\n", &hash, &size, e.name) == 3)
+    {
+        if (*count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 16;
+            ManifestEntry* grown = (ManifestEntry*)realloc(*entries, sizeof(ManifestEntry) * capacity);
+            if (!grown)
+            {
+                ok = false;
+                break;
+            }
+            *entries = grown;
+        }
+        e.hash = hash;
+        e.size = size;
+        // Names are relative, one level: nothing may be restored outside the output directory
+        ok = !strchr(e.name, '/') && !strchr(e.name, '\\') && strcmp(e.name, "..") && strcmp(e.name, ".");
+        (*entries)[(*count)++] = e;
+    }
+    ok = ok && feof(f);
+    fclose(f);
+    if (!ok)
+    {
+        free(*entries);
+        *entries = NULL;
+        *count = 0;
+    }
+    return ok;
+}
+
+// A name no other writer (thread or machine) picks for its temporary file next to "path"
+static std::string temp_path(const char* path)
+{
+    static std::atomic<uint64_t> counter(0);
+    const uint64_t nonce = asset_hash_value(
+        asset_hash_value((uint64_t)std::chrono::steady_clock::now().time_since_epoch().count(), counter++),
+        (uint64_t)(uintptr_t)&counter);
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%016" PRIx64 ".tmp", nonce);
+    return std::string(path) + suffix;
+}
+
+static bool write_manifest(const char* path, uint64_t key, const ManifestEntry* entries, uint32_t count)
+{
+    const std::string temp = temp_path(path);
+    FILE* f = fopen(temp.c_str(), "w");
+    bool ok = f && fprintf(f, "ogt-cook %d %016llx\n", ASSET_CACHE_VERSION, (unsigned long long)key) > 0;
+    for (uint32_t i = 0; ok && i < count; ++i)
+        ok = fprintf(f, "%016llx %llu %s\n", (unsigned long long)entries[i].hash, (unsigned long long)entries[i].size,
+            entries[i].name) > 0;
+    ok = f && fclose(f) == 0 && ok;
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(temp, path, ec);
+    if (!ok || ec)
+    {
+        std::filesystem::remove(temp, ec);
+        fprintf(stderr, "asset_cache: can't write %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+static std::string action_path(const char* dir, uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return std::string(dir) + "/actions/" + name;
+}
+
+static std::string blob_path(const char* dir, uint64_t hash)
+{
+    char name[40];
+    snprintf(name, sizeof(name), "%02x/%016llx", (unsigned int)(hash >> 56), (unsigned long long)hash);
+    return std::string(dir) + "/blobs/" + name;
+}
+
+static bool has_file(const std::string& path, uint64_t size)
+{
+    std::error_code ec;
+    return std::filesystem::file_size(path, ec) == size && !ec;
+}
+
+// Copies "from" to "to" through a temporary file, so readers never see half of it
+static bool copy_into_place(const std::string& from, const std::string& to)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(to).parent_path(), ec);
+    const std::string temp = temp_path(to.c_str());
+    std::filesystem::copy_file(from, temp, std::filesystem::copy_options::overwrite_existing, ec);
+    if (!ec)
+        std::filesystem::rename(temp, to, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool asset_cache_up_to_date(const char* out_dir, uint64_t key)
+{
+    ManifestEntry* entries;
+    uint32_t count;
+    if (!read_manifest((std::string(out_dir) + "/cook.manifest").c_str(), key, &entries, &count))
+        return false;
+    bool ok = true;
+    for (uint32_t i = 0; i < count && ok; ++i)
+        ok = has_file(std::string(out_dir) + "/" + entries[i].name, entries[i].size);
+    free(entries);
+    return ok;
+}
+
+AssetCacheResult asset_cache_restore(AssetCache* cache, uint64_t key, const char* out_dir)
+{
+    if (!cache->dir[0] && !cache->shared[0])
+        return ASSET_CACHE_MISS;
+    ManifestEntry* entries;
+    uint32_t count;
+    AssetCacheResult result = ASSET_CACHE_LOCAL;
+    if (!cache->dir[0] || !read_manifest(action_path(cache->dir, key).c_str(), key, &entries, &count))
+    {
+        if (!cache->shared[0] || !read_manifest(action_path(cache->shared, key).c_str(), key, &entries, &count))
+            return ASSET_CACHE_MISS;
+        result = ASSET_CACHE_SHARED;
+    }
+
+    // Every blob where the outputs will link from: the local cache (fetched from the shared one when it's
+    // only there), or the shared one itself without a local cache
+    bool ok = true;
+    std::vector<std::string> blobs(count);
+    for (uint32_t i = 0; i < count && ok; ++i)
+    {
+        const std::string local = cache->dir[0] ? blob_path(cache->dir, entries[i].hash) : std::string();
+        const std::string shared = cache->shared[0] ? blob_path(cache->shared, entries[i].hash) : std::string();
+        if (cache->dir[0] && has_file(local, entries[i].size))
+            blobs[i] = local;
+        else if (cache->shared[0] && has_file(shared, entries[i].size))
+        {
+            blobs[i] = cache->dir[0] && copy_into_place(shared, local) ? local : shared;
+            result = ASSET_CACHE_SHARED;
+        }
+        else
+            ok = false;     // evicted, or a store that didn't finish
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+    for (uint32_t i = 0; i < count && ok; ++i)
+    {
+        const std::string out = std::string(out_dir) + "/" + entries[i].name;
+        std::filesystem::remove(out, ec);
+        std::filesystem::create_hard_link(blobs[i], out, ec);
+        ok = !ec || copy_into_place(blobs[i], out);
+    }
+    if (ok && result == ASSET_CACHE_SHARED && cache->dir[0])
+        write_manifest(action_path(cache->dir, key).c_str(), key, entries, count);
+    ok = ok && write_manifest((std::string(out_dir) + "/cook.manifest").c_str(), key, entries, count);
+    free(entries);
+    return ok ? result : ASSET_CACHE_MISS;
+}
+
+bool asset_cache_store(AssetCache* cache, uint64_t key, const char* out_dir, const char* const* names, uint32_t count)
+{
+    ManifestEntry* entries = (ManifestEntry*)calloc(count ? count : 1, sizeof(ManifestEntry));
+    if (!entries)
+        return false;
+    bool ok = true;
+    for (uint32_t i = 0; i < count && ok; ++i)
+    {
+        const std::string out = std::string(out_dir) + "/" + names[i];
+        snprintf(entries[i].name, sizeof(entries[i].name), "%s", names[i]);
+        MappedFile file;
+        ok = mapped_file_open(&file, out.c_str());
+        if (!ok)
+            break;
+        entries[i].hash = asset_hash(0, file.data, file.size);
+        entries[i].size = file.size;
+        mapped_file_close(&file);
+
+        const char* dirs[2] = { cache->dir, cache->shared };
+        for (int d = 0; d < 2; ++d)
+        {
+            const std::string blob = dirs[d][0] ? blob_path(dirs[d], entries[i].hash) : std::string();
+            if (dirs[d][0] && !has_file(blob, entries[i].size) && !copy_into_place(out, blob))
+                fprintf(stderr, "asset_cache: can't store %s in %s\n", names[i], dirs[d]);
+        }
+    }
+    if (ok)
+    {
+        // The blobs first, then the actions naming them: a reader never finds an action without its blobs
+        if (cache->dir[0])
+            write_manifest(action_path(cache->dir, key).c_str(), key, entries, count);
+        if (cache->shared[0])
+            write_manifest(action_path(cache->shared, key).c_str(), key, entries, count);
+        ok = write_manifest((std::string(out_dir) + "/cook.manifest").c_str(), key, entries, count);
+    }
+    free(entries);
+    return ok;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+// Content-addressed cache of cooked outputs for the offline cooker
+// (tools/asset_cooker.cpp), so a rebuild only cooks what changed.
+//
+// A cook is keyed by a hash of everything that decides its outputs: the
+// bytes of every input file, the cooker's settings and its version. Its
+// outputs are stored as blobs named by the hash of their own bytes, under
+// blobs/<first two hex digits>/, and an action manifest (actions/<key>)
+// lists them: hash, size and file name. Identical outputs of different cooks
+// are stored once. A cache directory can be a local one and a shared one (a
+// network share the build farm fills): lookups go local first, then shared,
+// copying what they find into the local cache; stores go to both.
+//
+// Restoring a cook hard-links the blobs into the output directory (copying
+// where links aren't possible). That's safe because nothing writes an output
+// in place: the mesh and scene writers write a temporary file and rename it
+// over the old one. The output directory gets a copy of the manifest
+// (cook.manifest), so a rebuild can tell it's already up to date from
+// nothing but the manifest and the outputs' sizes, without the cache.
+//
+// Hashing 20 GB of inputs each build would take longer than the build
+// itself, so file hashes are remembered by path, size and modification
+// time (the stamps file). A file whose time is within a few seconds of being
+// hashed isn't remembered: it could still change within the file system's
+// time resolution without its stamp changing.
+//
+// The hash is XXH64, 64 bits: collisions are not a concern at the number of
+// files a build has. Every function may be called from any thread.
+
+#define ASSET_CACHE_VERSION 1
+
+typedef struct AssetFileStamp
+{
+    uint64_t path_hash;         // 0: empty slot
+    uint64_t size;
+    int64_t mtime;              // the file system's clock ticks
+    uint64_t hash;
+} AssetFileStamp;
+
+typedef struct AssetCache
+{
+    char dir[512];              // local cache; "" for none (nothing stored, nothing remembered)
+    char shared[512];           // shared cache; "" for none
+    AssetFileStamp* stamps;     // open addressing on path_hash, a power of two
+    uint32_t stamp_capacity;
+    uint32_t stamp_count;
+    bool stamps_changed;
+    std::mutex mutex;           // the stamps
+    std::atomic<uint64_t> hashed_bytes;     // read and hashed, stamps missed
+    std::atomic<uint32_t> hashed_files;
+    std::atomic<uint32_t> stamp_hits;
+} AssetCache;
+
+typedef enum AssetCacheResult
+{
+    ASSET_CACHE_MISS,
+    ASSET_CACHE_LOCAL,          // found in the local cache
+    ASSET_CACHE_SHARED          // found in the shared one, and copied into the local one
+} AssetCacheResult;
+
+// XXH64 of "size" bytes
+uint64_t asset_hash(uint64_t seed, const void* data, size_t size);
+
+// Folds one value into a running key
+static inline uint64_t asset_hash_value(uint64_t key, uint64_t value)
+{
+    return asset_hash(key, &value, sizeof(value));
+}
+
+// Opens the cache in "dir" (NULL or "": none) and "shared_dir" (NULL or "": none), creating them, and loads the
+// remembered file hashes. Logs and returns false when a directory can't be created.
+bool asset_cache_init(AssetCache* cache, const char* dir, const char* shared_dir);
+
+// Saves the remembered file hashes
+void asset_cache_destroy(AssetCache* cache);
+
+// The hash of "path"'s bytes, remembered when its size and time are unchanged. False when it can't be read.
+bool asset_cache_file_hash(AssetCache* cache, const char* path, uint64_t* hash);
+
+// True when "out_dir"'s cook.manifest is for "key" and every output it lists is there with its size
+bool asset_cache_up_to_date(const char* out_dir, uint64_t key);
+
+// Puts the outputs of cook "key" into "out_dir" (which it creates) and writes its cook.manifest
+AssetCacheResult asset_cache_restore(AssetCache* cache, uint64_t key, const char* out_dir);
+
+// Stores "count" files of "out_dir" (names relative to it) as the outputs of cook "key", and writes its
+// cook.manifest; without a cache, only the manifest. False (having logged) when an output can't be read or the
+// manifest written; the cook's own outputs are there either way.
+bool asset_cache_store(AssetCache* cache, uint64_t key, const char* out_dir, const char* const* names, uint32_t count);
@@ -0,0 +1,389 @@
+#include "asset/asset_package.h"
+
+#include "asset/lz4.h"
+
+#include <atomic>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Blocks compressed at once while writing: bounds the compressed bytes held in memory (64 MB at the default size)
+#define PACKAGE_WRITE_BATCH 256
+
+static uint64_t align_up(uint64_t x, uint64_t alignment)
+{
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+static uint32_t entry_block_count(const PackageEntry* entry, uint32_t block_size)
+{
+    return (uint32_t)((entry->size + block_size - 1) / block_size);
+}
+
+static uint32_t block_bytes(uint64_t entry_size, uint32_t block_size, uint32_t block)
+{
+    const uint64_t left = entry_size - (uint64_t)block * block_size;
+    return left < block_size ? (uint32_t)left : block_size;
+}
+
+// True when "count" records of "record" bytes at "offset" lie inside a package of "size" bytes
+static bool table_fits(uint64_t offset, uint64_t count, uint64_t record, uint64_t size)
+{
+    return offset % 8 == 0 && offset <= size && count <= (size - offset) / record;
+}
+
+// NULL when the package's tables and every block range lie inside it, else what is wrong with it
+static const char* validate(const Package* package)
+{
+    const PackageHeader* h = package->header;
+    const uint64_t size = package->file.size;
+    if (size < sizeof(PackageHeader) || h->magic != PACKAGE_MAGIC)
+        return "not an asset package";
+    if (h->version != PACKAGE_VERSION)
+        return "unsupported version";
+    if (h->size != size)
+        return "truncated";
+    if (h->block_size == 0 || h->block_size % PACKAGE_ALIGN)
+        return "bad block size";
+    if (!table_fits(h->entries_offset, h->entry_count, sizeof(PackageEntry), size)
+        || !table_fits(h->blocks_offset, h->block_count, sizeof(PackageBlock), size)
+        || h->names_offset > size || h->names_size > size - h->names_offset)
+        return "table out of bounds";
+    if (h->entry_count && (h->names_size == 0 || package->names[h->names_size - 1] != '\0'))
+        return "bad names";
+
+    for (uint32_t e = 0; e < h->entry_count; ++e)
+    {
+        const PackageEntry* entry = &package->entries[e];
+        if (entry->name >= h->names_size
+            || (e > 0 && strcmp(package->names + package->entries[e - 1].name, package->names + entry->name) >= 0))
+            return "names out of order";
+        const uint32_t count = entry_block_count(entry, h->block_size);
+        if (entry->first_block > h->block_count || count > h->block_count - entry->first_block)
+            return "blocks out of bounds";
+        for (uint32_t b = 0; b < count; ++b)
+        {
+            const PackageBlock* block = &package->blocks[entry->first_block + b];
+            const uint32_t bytes = block_bytes(entry->size, h->block_size, b);
+            if (block->offset % PACKAGE_ALIGN || block->offset > size || block->packed_size > size - block->offset)
+                return "block out of bounds";
+            if ((block->codec == PACKAGE_CODEC_STORED && block->packed_size != bytes)
+                || (block->codec == PACKAGE_CODEC_LZ4 && (block->packed_size == 0
+                    || block->packed_size > lz4_compress_bound(bytes)))
+                || block->codec > PACKAGE_CODEC_LZ4)
+                return "bad block";
+        }
+    }
+    return NULL;
+}
+
+bool package_open(Package* package, const char* path)
+{
+    memset(package, 0, sizeof(*package));
+    if (!mapped_file_open(&package->file, path))
+        return false;
+
+    const unsigned char* base = (const unsigned char*)package->file.data;
+    package->header = (const PackageHeader*)base;
+    const char* error = package->file.size < sizeof(PackageHeader) ? "not an asset package" : NULL;
+    if (!error)
+    {
+        // Pointers into the mapping are only formed here; validate checks them before anything reads through them
+        const PackageHeader* h = package->header;
+        package->entries = (const PackageEntry*)(base + (h->entries_offset <= package->file.size ? h->entries_offset : 0));
+        package->blocks = (const PackageBlock*)(base + (h->blocks_offset <= package->file.size ? h->blocks_offset : 0));
+        package->names = (const char*)(base + (h->names_offset <= package->file.size ? h->names_offset : 0));
+        error = validate(package);
+    }
+    if (error)
+    {
+        fprintf(stderr, "package: %s: %s\n", path, error);
+        package_close(package);
+        return false;
+    }
+    return true;
+}
+
+void package_close(Package* package)
+{
+    mapped_file_close(&package->file);
+    memset(package, 0, sizeof(*package));
+}
+
+int package_find(const Package* package, const char* name)
+{
+    int low = 0, high = package->header ? (int)package->header->entry_count - 1 : -1;
+    while (low <= high)
+    {
+        const int mid = low + (high - low) / 2;
+        const int order = strcmp(package->names + package->entries[mid].name, name);
+        if (order == 0)
+            return mid;
+        if (order < 0)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+    return -1;
+}
+
+const char* package_entry_name(const Package* package, int entry)
+{
+    return package->names + package->entries[entry].name;
+}
+
+uint32_t package_entry_block_count(const Package* package, int entry)
+{
+    return entry_block_count(&package->entries[entry], package->header->block_size);
+}
+
+static bool unpack_block(const Package* package, const PackageEntry* entry, uint32_t b, unsigned char* out)
+{
+    const uint32_t block_size = package->header->block_size;
+    const PackageBlock* block = &package->blocks[entry->first_block + b];
+    const unsigned char* packed = (const unsigned char*)package->file.data + block->offset;
+    const uint32_t bytes = block_bytes(entry->size, block_size, b);
+    unsigned char* dst = out + (uint64_t)b * block_size;
+    if (block->codec == PACKAGE_CODEC_STORED)
+    {
+        memcpy(dst, packed, bytes);
+        return true;
+    }
+    return lz4_decompress(packed, block->packed_size, dst, bytes);
+}
+
+typedef struct UnpackRun
+{
+    const Package* package;
+    const PackageEntry* entry;
+    unsigned char* out;
+    std::atomic<bool> ok;
+} UnpackRun;
+
+static void unpack_range(void* data, size_t begin, size_t end)
+{
+    UnpackRun* run = (UnpackRun*)data;
+    for (size_t b = begin; b < end; ++b)
+        if (!unpack_block(run->package, run->entry, (uint32_t)b, run->out))
+            run->ok.store(false);
+}
+
+bool package_read(const Package* package, int entry, void* out, JobSystem* jobs)
+{
+    const PackageEntry* e = &package->entries[entry];
+    const uint32_t count = entry_block_count(e, package->header->block_size);
+    UnpackRun run;
+    run.package = package;
+    run.entry = e;
+    run.out = (unsigned char*)out;
+    run.ok.store(true);
+    if (jobs && count > 1)
+        job_wait(jobs, job_parallel_for(jobs, unpack_range, &run, count, 1));
+    else
+        unpack_range(&run, 0, count);
+    if (!run.ok.load())
+        fprintf(stderr, "package: %s is corrupt\n", package_entry_name(package, entry));
+    return run.ok.load();
+}
+
+bool package_extract(const Package* package, int entry, MappedFile* file, JobSystem* jobs)
+{
+    memset(file, 0, sizeof(*file));
+    const uint64_t size = package->entries[entry].size;
+    void* buffer = size <= SIZE_MAX ? malloc(size ? (size_t)size : 1) : NULL;
+    if (!buffer)
+    {
+        fprintf(stderr, "package: out of memory for %s (%llu bytes)\n", package_entry_name(package, entry),
+            (unsigned long long)size);
+        return false;
+    }
+    if (!package_read(package, entry, buffer, jobs))
+    {
+        free(buffer);
+        return false;
+    }
+    mapped_file_adopt(file, buffer, (size_t)size);
+    return true;
+}
+
+// A block being written: "packed" is its LZ4 block, or NULL to store "data" as it is
+typedef struct PackBlock
+{
+    const unsigned char* data;
+    uint32_t size;
+    uint32_t packed_size;
+    unsigned char* packed;
+} PackBlock;
+
+static void pack_range(void* data, size_t begin, size_t end)
+{
+    PackBlock* blocks = (PackBlock*)data;
+    for (size_t i = begin; i < end; ++i)
+    {
+        PackBlock* block = &blocks[i];
+        const size_t capacity = lz4_compress_bound(block->size);
+        block->packed = (unsigned char*)malloc(capacity);
+        const size_t packed = block->packed ? lz4_compress(block->data, block->size, block->packed, capacity) : 0;
+        if (packed == 0 || packed >= block->size)
+        {
+            free(block->packed);
+            block->packed = NULL;
+            block->packed_size = block->size;
+        }
+        else
+            block->packed_size = (uint32_t)packed;
+    }
+}
+
+static int compare_inputs(const void* a, const void* b)
+{
+    return strcmp((*(const PackageInput* const*)a)->name, (*(const PackageInput* const*)b)->name);
+}
+
+static bool write_padding(FILE* f, uint64_t bytes)
+{
+    static const unsigned char zeros[PACKAGE_ALIGN] = {};
+    return fwrite(zeros, 1, bytes, f) == bytes;
+}
+
+bool package_write(const char* path, const PackageInput* inputs, uint32_t count, uint32_t block_size, JobSystem* jobs,
+    PackageWriteResult* result)
+{
+    if (block_size == 0 || block_size % PACKAGE_ALIGN)
+    {
+        fprintf(stderr, "package: block size %u isn't a multiple of %u\n", block_size, PACKAGE_ALIGN);
+        return false;
+    }
+
+    // The table of contents: entries in name order, their blocks in the same order
+    const PackageInput** sorted = (const PackageInput**)malloc(sizeof(PackageInput*) * (count ? count : 1));
+    PackageEntry* entries = (PackageEntry*)calloc(count ? count : 1, sizeof(PackageEntry));
+    if (!sorted || !entries)
+    {
+        free(sorted);
+        free(entries);
+        fprintf(stderr, "package: out of memory for %u entries\n", count);
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+        sorted[i] = &inputs[i];
+    qsort(sorted, count, sizeof(PackageInput*), compare_inputs);
+    uint64_t names_size = 0, block_count = 0;
+    bool ok = true;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (i > 0 && strcmp(sorted[i - 1]->name, sorted[i]->name) == 0)
+        {
+            fprintf(stderr, "package: %s is named twice\n", sorted[i]->name);
+            ok = false;
+        }
+        entries[i].name = (uint32_t)names_size;
+        entries[i].first_block = (uint32_t)block_count;
+        entries[i].size = sorted[i]->size;
+        names_size += strlen(sorted[i]->name) + 1;
+        block_count += entry_block_count(&entries[i], block_size);
+    }
+    if (names_size > UINT32_MAX || block_count > UINT32_MAX)
+    {
+        fprintf(stderr, "package: too many entries\n");
+        ok = false;
+    }
+
+    PackageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PACKAGE_MAGIC;
+    header.version = PACKAGE_VERSION;
+    header.entry_count = count;
+    header.block_count = (uint32_t)block_count;
+    header.block_size = block_size;
+    header.names_size = (uint32_t)names_size;
+    header.entries_offset = sizeof(header);
+    header.blocks_offset = header.entries_offset + sizeof(PackageEntry) * count;
+    header.names_offset = header.blocks_offset + sizeof(PackageBlock) * block_count;
+    const uint64_t data_offset = align_up(header.names_offset + names_size, PACKAGE_ALIGN);
+
+    PackageBlock* records = ok ? (PackageBlock*)calloc(block_count ? block_count : 1, sizeof(PackageBlock)) : NULL;
+    PackBlock batch[PACKAGE_WRITE_BATCH];
+    char temp[1024];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE* f = records ? fopen(temp, "wb") : NULL;
+    ok = ok && f != NULL;
+
+    // The blocks go first, after room for the table of contents, which is written once their offsets are known.
+    // They're compressed a batch at a time, in parallel, and written in order.
+    uint64_t offset = data_offset;
+    uint32_t stored = 0;
+    ok = ok && fseek(f, (long)data_offset, SEEK_SET) == 0;
+    uint32_t entry = 0, block = 0;
+    for (uint64_t next = 0; ok && next < block_count;)
+    {
+        size_t n = 0;
+        for (; n < PACKAGE_WRITE_BATCH && next + n < block_count; ++n)
+        {
+            while (block == entry_block_count(&entries[entry], block_size))
+            {
+                ++entry;
+                block = 0;
+            }
+            batch[n].data = (const unsigned char*)sorted[entry]->data + (uint64_t)block * block_size;
+            batch[n].size = block_bytes(entries[entry].size, block_size, block);
+            batch[n].packed = NULL;
+            ++block;
+        }
+        if (jobs && n > 1)
+            job_wait(jobs, job_parallel_for(jobs, pack_range, batch, n, 1));
+        else
+            pack_range(batch, 0, n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            PackageBlock* record = &records[next + i];
+            record->offset = offset;
+            record->packed_size = batch[i].packed_size;
+            record->codec = batch[i].packed ? PACKAGE_CODEC_LZ4 : PACKAGE_CODEC_STORED;
+            stored += !batch[i].packed;
+            const uint64_t padded = align_up(record->packed_size, PACKAGE_ALIGN);
+            ok = ok && fwrite(batch[i].packed ? batch[i].packed : batch[i].data, 1, record->packed_size, f)
+                == record->packed_size && write_padding(f, padded - record->packed_size);
+            offset += padded;
+            free(batch[i].packed);
+        }
+        next += n;
+    }
+    header.size = offset;
+
+    ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, f) == 1
+        && fwrite(entries, sizeof(PackageEntry), count, f) == count
+        && fwrite(records, sizeof(PackageBlock), block_count, f) == block_count;
+    for (uint32_t i = 0; ok && i < count; ++i)
+        ok = fwrite(sorted[i]->name, 1, strlen(sorted[i]->name) + 1, f) == strlen(sorted[i]->name) + 1;
+    // An empty package still ends where its blocks would start
+    ok = ok && (block_count || (fseek(f, 0, SEEK_END) == 0 && write_padding(f, data_offset - ftell(f))));
+    if (f)
+    {
+        ok = fclose(f) == 0 && ok;
+        std::error_code ec;
+        if (ok)
+            std::filesystem::rename(temp, path, ec);
+        if (!ok || ec)
+        {
+            std::filesystem::remove(temp, ec);
+            ok = false;
+        }
+    }
+    if (!ok)
+        fprintf(stderr, "package: can't write %s\n", path);
+    else if (result)
+    {
+        result->bytes = 0;
+        for (uint32_t i = 0; i < count; ++i)
+            result->bytes += entries[i].size;
+        result->packed_bytes = header.size;
+        result->blocks = (uint32_t)block_count;
+        result->stored_blocks = stored;
+    }
+    free(records);
+    free(entries);
+    free(sorted);
+    return ok;
+}
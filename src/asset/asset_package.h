@@ -0,0 +1,117 @@
+#pragma once
+
+#include "core/job_system.h"
+#include "core/mapped_file.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Asset packages: many cooked files (mesh files, scene files) in one
+// archive, so loading a level is a few large reads instead of a small read
+// per file.
+//
+// Layout: the header, then the table of contents - the entries sorted by
+// name (found by binary search), the block records, the name strings - and
+// then the blocks. Each entry's bytes are cut into blocks of "block_size"
+// bytes (its last one shorter), compressed independently with LZ4
+// (asset/lz4.h) or stored as they are when they don't shrink. Every block
+// starts at a PACKAGE_ALIGN boundary and is padded to one, which is what
+// direct (unbuffered) I/O asks of offsets and lengths, and an entry's blocks
+// are consecutive: one sequential read covers an asset.
+//
+// Independent blocks are what makes decompression parallel: package_read
+// spreads an entry's blocks over the job system, each written straight to its
+// place in the destination - which can be any memory, a mapped staging
+// buffer included. package_extract puts an entry in a heap buffer that stands
+// in for the file's mapping, so mesh_file_open_mapped and
+// scene_file_open_mapped open it like one mapped from disk.
+//
+// The package itself is mapped; sizes and offsets are validated at open, so
+// a truncated or corrupt package fails there or, for a block's contents, in
+// package_read. Fields are little-endian, as written by the host.
+
+#define PACKAGE_MAGIC 0x5054474Fu           // "OGTP"
+#define PACKAGE_VERSION 1
+#define PACKAGE_ALIGN 4096
+#define PACKAGE_DEFAULT_BLOCK_SIZE (256u * 1024u)
+
+typedef enum PackageCodec
+{
+    PACKAGE_CODEC_STORED,       // the bytes as they are
+    PACKAGE_CODEC_LZ4           // an LZ4 block
+} PackageCodec;
+
+typedef struct PackageHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t block_count;
+    uint32_t block_size;        // an entry's blocks hold this many bytes unpacked, but for its last one
+    uint32_t names_size;        // bytes of name strings, each 0-terminated
+    uint64_t entries_offset;    // PackageEntry[entry_count], sorted by name
+    uint64_t blocks_offset;     // PackageBlock[block_count], in file order
+    uint64_t names_offset;
+    uint64_t size;              // the whole package, to catch truncation
+} PackageHeader;
+
+typedef struct PackageEntry
+{
+    uint32_t name;              // offset into the names
+    uint32_t first_block;
+    uint64_t size;              // bytes once unpacked
+} PackageEntry;
+
+typedef struct PackageBlock
+{
+    uint64_t offset;            // from the start of the package, PACKAGE_ALIGN aligned
+    uint32_t packed_size;       // bytes in the package, before the padding
+    uint32_t codec;             // PackageCodec
+} PackageBlock;
+
+typedef struct Package
+{
+    MappedFile file;
+    const PackageHeader* header;
+    const PackageEntry* entries;
+    const PackageBlock* blocks;
+    const char* names;
+} Package;
+
+typedef struct PackageInput
+{
+    const char* name;           // unique within the package
+    const void* data;
+    size_t size;
+} PackageInput;
+
+typedef struct PackageWriteResult
+{
+    uint64_t bytes;             // unpacked
+    uint64_t packed_bytes;      // the package's size
+    uint32_t blocks;
+    uint32_t stored_blocks;     // that didn't shrink
+} PackageWriteResult;
+
+// Maps and validates "path" (magic, version, table bounds, names, block ranges). Logs and returns false on failure.
+bool package_open(Package* package, const char* path);
+void package_close(Package* package);
+
+// The entry named "name", or -1
+int package_find(const Package* package, const char* name);
+const char* package_entry_name(const Package* package, int entry);
+uint32_t package_entry_block_count(const Package* package, int entry);
+
+// Unpacks "entry" into "out" (its size in bytes). With "jobs", its blocks are decompressed on the job system,
+// which the calling thread must belong to; without, one after another on the calling thread. Logs and returns
+// false when a block is corrupt.
+bool package_read(const Package* package, int entry, void* out, JobSystem* jobs);
+
+// Unpacks "entry" into a new buffer that "file" adopts (mapped_file_adopt). Logs and returns false on failure.
+bool package_extract(const Package* package, int entry, MappedFile* file, JobSystem* jobs);
+
+// Writes "count" inputs to "path" in blocks of "block_size" bytes (a multiple of PACKAGE_ALIGN), compressed on
+// "jobs" when given (the calling thread must belong to it). Written to a temporary name and renamed into place.
+// Logs and returns false on failure; "result" (may be NULL) gets the sizes.
+bool package_write(const char* path, const PackageInput* inputs, uint32_t count, uint32_t block_size, JobSystem* jobs,
+    PackageWriteResult* result);
@@ -0,0 +1,752 @@
+#include "asset/gltf.h"
+
+#include "asset/json.h"
+#include "core/mapped_file.h"
+
+#include "linmath_trs.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLB_MAGIC 0x46546C67u       // "glTF"
+#define GLB_CHUNK_JSON 0x4E4F534Au
+#define GLB_CHUNK_BIN 0x004E4942u
+#define GLTF_MAX_NODE_DEPTH 64
+#define GLTF_MAX_INSTANCES (1u << 24)
+
+enum
+{
+    GLTF_BYTE = 5120,
+    GLTF_UNSIGNED_BYTE = 5121,
+    GLTF_SHORT = 5122,
+    GLTF_UNSIGNED_SHORT = 5123,
+    GLTF_UNSIGNED_INT = 5125,
+    GLTF_FLOAT = 5126
+};
+
+enum
+{
+    GLTF_POINTS,
+    GLTF_LINES,
+    GLTF_LINE_LOOP,
+    GLTF_LINE_STRIP,
+    GLTF_TRIANGLES,
+    GLTF_TRIANGLE_STRIP,
+    GLTF_TRIANGLE_FAN
+};
+
+typedef struct GltfBuffer
+{
+    const uint8_t* data;
+    size_t size;
+    MappedFile file;            // an external .bin's mapping; data is NULL when unused
+    uint8_t* decoded;           // a data URI's bytes
+} GltfBuffer;
+
+typedef struct GltfReader
+{
+    JsonDocument doc;
+    const JsonValue* root;
+    GltfBuffer* buffers;
+    uint32_t buffer_count;
+    const uint8_t* bin;         // a .glb's BIN chunk
+    size_t bin_size;
+    const char* base_dir;
+} GltfReader;
+
+// One accessor's elements, ready to read: "count" of them, "stride" bytes apart
+typedef struct GltfAccessor
+{
+    const uint8_t* data;        // NULL: no buffer view, all zeros
+    size_t stride;
+    uint32_t count;
+    int components;
+    uint32_t component_type;
+    bool normalized;
+} GltfAccessor;
+
+static const JsonValue* array_at(const GltfReader* r, const char* array, double index)
+{
+    if (index < 0.0 || index >= 4294967295.0)
+        return NULL;
+    return json_at(&r->doc, json_member(&r->doc, r->root, array), (uint32_t)index);
+}
+
+static int base64_value(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    return c == '+' || c == '-' ? 62 : c == '/' || c == '_' ? 63 : -1;
+}
+
+size_t gltf_base64_decode(const char* text, size_t length, uint8_t* out)
+{
+    while (length && text[length - 1] == '=')
+        --length;
+    if (length % 4 == 1)
+        return SIZE_MAX;
+    size_t n = 0;
+    uint32_t bits = 0;
+    int have = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        const int v = base64_value(text[i]);
+        if (v < 0)
+            return SIZE_MAX;
+        bits = bits << 6 | (uint32_t)v;
+        have += 6;
+        if (have >= 8)
+        {
+            have -= 8;
+            out[n++] = (uint8_t)(bits >> have);
+        }
+    }
+    return n;
+}
+
+// Where external buffer "uri" is: percent-decoded, under "base_dir". False for one outside the model's directory.
+static bool buffer_path(const char* base_dir, const char* uri, char* path, size_t size)
+{
+    if (strstr(uri, "://") || strstr(uri, ".."))
+        return false;
+    // URIs are percent-encoded; the common case is spaces
+    char name[1024];
+    size_t n = 0;
+    for (const char* c = uri; *c && n < sizeof(name) - 1; ++c)
+    {
+        unsigned int code;
+        if (*c == '%' && sscanf(c + 1, "%2x", &code) == 1)
+        {
+            name[n++] = (char)code;
+            c += 2;
+        }
+        else
+            name[n++] = *c;
+    }
+    name[n] = '\0';
+    snprintf(path, size, "%s%s%s", base_dir, base_dir[0] ? "/" : "", name);
+    return true;
+}
+
+// Buffer "i": the GLB chunk, a data URI decoded, or a file beside the glTF mapped
+static bool load_buffer(GltfReader* r, uint32_t i, const JsonValue* buffer)
+{
+    GltfBuffer* b = &r->buffers[i];
+    const double length = json_member_number(&r->doc, buffer, "byteLength", -1.0);
+    const char* uri = json_member_string(&r->doc, buffer, "uri", NULL);
+    if (length < 0.0)
+    {
+        fprintf(stderr, "gltf: buffer %u has no byteLength\n", i);
+        return false;
+    }
+    if (!uri)
+    {
+        if (i != 0 || !r->bin)
+        {
+            fprintf(stderr, "gltf: buffer %u has no data\n", i);
+            return false;
+        }
+        b->data = r->bin;
+        b->size = r->bin_size;
+    }
+    else if (!strncmp(uri, "data:", 5))
+    {
+        const char* comma = strstr(uri, ";base64,");
+        if (!comma)
+        {
+            fprintf(stderr, "gltf: buffer %u's data URI isn't base64\n", i);
+            return false;
+        }
+        const char* text = comma + 8;
+        const size_t chars = strlen(text);
+        b->decoded = (uint8_t*)malloc(chars / 4 * 3 + 3);
+        const size_t n = b->decoded ? gltf_base64_decode(text, chars, b->decoded) : SIZE_MAX;
+        if (n == SIZE_MAX)
+        {
+            fprintf(stderr, "gltf: buffer %u's base64 doesn't decode\n", i);
+            return false;
+        }
+        b->data = b->decoded;
+        b->size = n;
+    }
+    else
+    {
+        char path[2048];
+        if (!buffer_path(r->base_dir, uri, path, sizeof(path)))
+        {
+            fprintf(stderr, "gltf: buffer %u is outside the model's directory (%s)\n", i, uri);
+            return false;
+        }
+        if (!mapped_file_open(&b->file, path))
+            return false;
+        b->data = (const uint8_t*)b->file.data;
+        b->size = b->file.size;
+    }
+    if ((double)b->size < length)
+    {
+        fprintf(stderr, "gltf: buffer %u is shorter than its byteLength\n", i);
+        return false;
+    }
+    return true;
+}
+
+static size_t component_size(uint32_t type)
+{
+    switch (type)
+    {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE: return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT: return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT: return 4;
+    }
+    return 0;
+}
+
+static int type_components(const char* type)
+{
+    static const struct { const char* name; int components; } types[] = {
+        { "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 }, { "MAT2", 4 }, { "MAT3", 9 }, { "MAT4", 16 } };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i)
+        if (!strcmp(type, types[i].name))
+            return types[i].components;
+    return 0;
+}
+
+// Accessor "index", bounds-checked against its view and buffer. False with *sparse set for a sparse one.
+static bool open_accessor(const GltfReader* r, double index, GltfAccessor* a, bool* sparse)
+{
+    const JsonValue* accessor = array_at(r, "accessors", index);
+    *sparse = false;
+    if (!accessor)
+    {
+        fprintf(stderr, "gltf: no accessor %.0f\n", index);
+        return false;
+    }
+    if (json_member(&r->doc, accessor, "sparse"))
+    {
+        *sparse = true;
+        return false;
+    }
+    memset(a, 0, sizeof(*a));
+    const double count = json_member_number(&r->doc, accessor, "count", -1.0);
+    a->component_type = (uint32_t)json_member_number(&r->doc, accessor, "componentType", 0.0);
+    a->components = type_components(json_member_string(&r->doc, accessor, "type", ""));
+    a->normalized = json_member_bool(&r->doc, accessor, "normalized", false);
+    const size_t element = component_size(a->component_type) * (size_t)a->components;
+    if (count < 0.0 || count > 4294967295.0 || !element)
+    {
+        fprintf(stderr, "gltf: accessor %.0f has a bad count or type\n", index);
+        return false;
+    }
+    a->count = (uint32_t)count;
+    a->stride = element;
+    const JsonValue* view_index = json_member(&r->doc, accessor, "bufferView");
+    if (!view_index)
+        return true;    // zeros
+    const JsonValue* view = array_at(r, "bufferViews", json_number(view_index, -1.0));
+    const double buffer = json_member_number(&r->doc, view, "buffer", -1.0);
+    if (!view || buffer < 0.0 || buffer >= r->buffer_count)
+    {
+        fprintf(stderr, "gltf: accessor %.0f's buffer view is missing\n", index);
+        return false;
+    }
+    const GltfBuffer* b = &r->buffers[(uint32_t)buffer];
+    const double view_offset = json_member_number(&r->doc, view, "byteOffset", 0.0);
+    const double view_length = json_member_number(&r->doc, view, "byteLength", -1.0);
+    const double view_stride = json_member_number(&r->doc, view, "byteStride", 0.0);
+    const double offset = json_member_number(&r->doc, accessor, "byteOffset", 0.0);
+    if (view_stride > 0.0)
+        a->stride = (size_t)view_stride;
+    const double needed = a->count ? offset + (double)a->stride * (a->count - 1) + (double)element : 0.0;
+    if (view_offset < 0.0 || view_length < 0.0 || offset < 0.0 || view_offset + view_length > (double)b->size
+        || needed > view_length || (view_stride > 0.0 && view_stride < (double)element))
+    {
+        fprintf(stderr, "gltf: accessor %.0f reaches outside its buffer\n", index);
+        return false;
+    }
+    a->data = b->data + (size_t)view_offset + (size_t)offset;
+    return true;
+}
+
+// Component "c" of element "i", as a float (normalised integers mapped to [0, 1] or [-1, 1])
+static float accessor_float(const GltfAccessor* a, uint32_t i, int c)
+{
+    if (!a->data || c >= a->components)
+        return 0.f;
+    const uint8_t* p = a->data + a->stride * i + component_size(a->component_type) * c;
+    switch (a->component_type)
+    {
+    case GLTF_FLOAT:
+    {
+        float f;
+        memcpy(&f, p, 4);
+        return f;
+    }
+    case GLTF_BYTE:
+        return a->normalized ? fmaxf(*(const int8_t*)p / 127.f, -1.f) : (float)*(const int8_t*)p;
+    case GLTF_UNSIGNED_BYTE:
+        return a->normalized ? *p / 255.f : (float)*p;
+    case GLTF_SHORT:
+    {
+        int16_t s;
+        memcpy(&s, p, 2);
+        return a->normalized ? fmaxf(s / 32767.f, -1.f) : (float)s;
+    }
+    case GLTF_UNSIGNED_SHORT:
+    {
+        uint16_t u;
+        memcpy(&u, p, 2);
+        return a->normalized ? u / 65535.f : (float)u;
+    }
+    case GLTF_UNSIGNED_INT:
+    {
+        uint32_t u;
+        memcpy(&u, p, 4);
+        return (float)u;
+    }
+    }
+    return 0.f;
+}
+
+static uint32_t accessor_index(const GltfAccessor* a, uint32_t i)
+{
+    if (!a->data)
+        return 0;
+    const uint8_t* p = a->data + a->stride * i;
+    switch (a->component_type)
+    {
+    case GLTF_UNSIGNED_BYTE:
+        return *p;
+    case GLTF_UNSIGNED_SHORT:
+    {
+        uint16_t u;
+        memcpy(&u, p, 2);
+        return u;
+    }
+    case GLTF_UNSIGNED_INT:
+    {
+        uint32_t u;
+        memcpy(&u, p, 4);
+        return u;
+    }
+    }
+    return 0;
+}
+
+static bool grow(void** p, size_t bytes)
+{
+    void* q = realloc(*p, bytes ? bytes : 1);
+    if (!q)
+        return false;
+    *p = q;
+    return true;
+}
+
+// Appends one primitive to "mesh". False (having logged) on a broken one; *skipped for one that's just not read.
+static bool add_primitive(const GltfReader* r, GltfMesh* mesh, const JsonValue* primitive, bool* skipped)
+{
+    const JsonDocument* doc = &r->doc;
+    *skipped = false;
+    const int mode = (int)json_member_number(doc, primitive, "mode", GLTF_TRIANGLES);
+    const JsonValue* attributes = json_member(doc, primitive, "attributes");
+    const JsonValue* position_index = json_member(doc, attributes, "POSITION");
+    if ((mode != GLTF_TRIANGLES && mode != GLTF_TRIANGLE_STRIP && mode != GLTF_TRIANGLE_FAN) || !position_index)
+    {
+        *skipped = true;
+        return true;
+    }
+    GltfAccessor position, normal, color, index;
+    bool sparse = false;
+    const JsonValue* normal_index = json_member(doc, attributes, "NORMAL");
+    const JsonValue* color_index = json_member(doc, attributes, "COLOR_0");
+    const JsonValue* indices_index = json_member(doc, primitive, "indices");
+    bool ok = open_accessor(r, json_number(position_index, -1.0), &position, &sparse);
+    const bool has_normals = ok && normal_index && open_accessor(r, json_number(normal_index, -1.0), &normal, &sparse);
+    ok = ok && (!normal_index || has_normals);
+    const bool has_colors = ok && color_index && open_accessor(r, json_number(color_index, -1.0), &color, &sparse);
+    ok = ok && (!color_index || has_colors);
+    ok = ok && (!indices_index || open_accessor(r, json_number(indices_index, -1.0), &index, &sparse));
+    if (sparse)
+    {
+        *skipped = true;
+        return true;
+    }
+    if (!ok)
+        return false;
+    if (position.components < 3 || (has_normals && normal.count != position.count)
+        || (has_colors && color.count != position.count) || (indices_index && index.components != 1))
+    {
+        fprintf(stderr, "gltf: %s has mismatched attributes\n", mesh->name);
+        return false;
+    }
+
+    // The vertices, with normals and colours filled in for the primitives before that had none
+    const uint32_t base = mesh->vertex_count;
+    const uint64_t vertices = (uint64_t)base + position.count;
+    const bool had_normals = mesh->normals, had_colors = mesh->colors;
+    if (vertices > UINT32_MAX
+        || !grow((void**)&mesh->positions, sizeof(float) * 3 * vertices)
+        || ((has_normals || mesh->normals) && !grow((void**)&mesh->normals, sizeof(float) * 3 * vertices))
+        || ((has_colors || mesh->colors) && !grow((void**)&mesh->colors, sizeof(float) * 3 * vertices)))
+    {
+        fprintf(stderr, "gltf: out of memory for %s\n", mesh->name);
+        return false;
+    }
+    if (has_normals && !had_normals)
+        memset(mesh->normals, 0, sizeof(float) * 3 * base);
+    for (uint32_t i = 0; has_colors && !had_colors && i < 3 * base; ++i)
+        mesh->colors[i] = 1.f;
+    for (uint32_t v = 0; v < position.count; ++v)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            const float p = accessor_float(&position, v, c);
+            mesh->positions[3 * (base + v) + c] = p;
+            mesh->min[c] = base + v ? fminf(mesh->min[c], p) : p;
+            mesh->max[c] = base + v ? fmaxf(mesh->max[c], p) : p;
+            if (mesh->normals)
+                mesh->normals[3 * (base + v) + c] = has_normals ? accessor_float(&normal, v, c) : 0.f;
+            if (mesh->colors)
+                mesh->colors[3 * (base + v) + c] = has_colors ? accessor_float(&color, v, c) : 1.f;
+        }
+    }
+    mesh->vertex_count = (uint32_t)vertices;
+
+    // Triangles, strips and fans all as lists
+    const uint32_t n = indices_index ? index.count : position.count;
+    const uint64_t triangles = mode == GLTF_TRIANGLES ? n / 3 : n >= 3 ? n - 2 : 0;
+    const uint64_t indices = mesh->index_count + 3 * triangles;
+    if (indices > UINT32_MAX || !grow((void**)&mesh->indices, sizeof(uint32_t) * indices))
+    {
+        fprintf(stderr, "gltf: out of memory for %s\n", mesh->name);
+        return false;
+    }
+    uint32_t* out = mesh->indices + mesh->index_count;
+    for (uint32_t t = 0; t < triangles; ++t)
+    {
+        uint32_t k[3];
+        if (mode == GLTF_TRIANGLES)
+            k[0] = 3 * t, k[1] = 3 * t + 1, k[2] = 3 * t + 2;
+        else if (mode == GLTF_TRIANGLE_STRIP)
+            k[0] = t + (t & 1), k[1] = t + 1 - (t & 1), k[2] = t + 2;     // every other one flipped back
+        else
+            k[0] = 0, k[1] = t + 1, k[2] = t + 2;
+        for (int c = 0; c < 3; ++c)
+        {
+            const uint32_t i = indices_index ? accessor_index(&index, k[c]) : k[c];
+            if (i >= position.count)
+            {
+                fprintf(stderr, "gltf: %s has an index past its vertices\n", mesh->name);
+                return false;
+            }
+            out[3 * t + c] = base + i;
+        }
+    }
+    mesh->index_count = (uint32_t)indices;
+    return true;
+}
+
+static bool load_mesh(const GltfReader* r, GltfScene* scene, uint32_t m)
+{
+    const JsonValue* mesh = array_at(r, "meshes", m);
+    GltfMesh* out = &scene->meshes[m];
+    snprintf(out->name, sizeof(out->name), "%s", json_member_string(&r->doc, mesh, "name", ""));
+    if (!out->name[0])
+        snprintf(out->name, sizeof(out->name), "mesh%u", m);
+    const JsonValue* primitives = json_member(&r->doc, mesh, "primitives");
+    const uint32_t count = primitives && primitives->type == JSON_ARRAY ? primitives->count : 0;
+    bool first = true;
+    out->material = -1;
+    for (uint32_t p = 0; p < count; ++p)
+    {
+        bool skipped;
+        const JsonValue* primitive = json_at(&r->doc, primitives, p);
+        if (!add_primitive(r, out, primitive, &skipped))
+            return false;
+        scene->skipped_primitives += skipped;
+        const int32_t material = (int32_t)json_member_number(&r->doc, primitive, "material", -1.0);
+        if (!skipped)
+            out->material = first || out->material == material ? material : GLTF_MATERIAL_MIXED;
+        first = first && skipped;
+    }
+    return true;
+}
+
+// Node "n"'s matrix relative to its parent
+static void node_local(const GltfReader* r, const JsonValue* node, mat4x4 local)
+{
+    const JsonDocument* doc = &r->doc;
+    const JsonValue* matrix = json_member(doc, node, "matrix");
+    if (matrix && matrix->type == JSON_ARRAY && matrix->count == 16)
+    {
+        for (int i = 0; i < 16; ++i)
+            local[i / 4][i % 4] = (float)json_number(json_at(doc, matrix, i), i % 5 ? 0.0 : 1.0);     // columns
+        return;
+    }
+    const JsonValue* t = json_member(doc, node, "translation");
+    const JsonValue* q = json_member(doc, node, "rotation");
+    const JsonValue* s = json_member(doc, node, "scale");
+    trs a;
+    for (int k = 0; k < 3; ++k)
+    {
+        a.t[k] = (float)json_number(json_at(doc, t, k), 0.0);
+        a.s[k] = (float)json_number(json_at(doc, s, k), 1.0);
+    }
+    for (int k = 0; k < 4; ++k)
+        a.r[k] = (float)json_number(json_at(doc, q, k), k == 3 ? 1.0 : 0.0);
+    trs_to_mat4x4(local, &a);
+}
+
+static bool add_node(const GltfReader* r, GltfScene* scene, double index, mat4x4 const parent, int depth,
+    uint32_t* capacity)
+{
+    const JsonValue* node = array_at(r, "nodes", index);
+    if (!node || depth >= GLTF_MAX_NODE_DEPTH)
+    {
+        fprintf(stderr, "gltf: node %.0f is missing or nested too deeply\n", index);
+        return false;
+    }
+    mat4x4 local, world;
+    node_local(r, node, local);
+    mat4x4_mul_restrict(world, parent, local);
+    const JsonValue* mesh = json_member(&r->doc, node, "mesh");
+    if (mesh)
+    {
+        const double m = json_number(mesh, -1.0);
+        if (m < 0.0 || m >= scene->mesh_count || scene->instance_count == GLTF_MAX_INSTANCES)
+        {
+            fprintf(stderr, "gltf: node %.0f's mesh is missing, or too many instances\n", index);
+            return false;
+        }
+        if (scene->instance_count == *capacity)
+        {
+            *capacity = *capacity ? 2 * *capacity : 64;
+            if (!grow((void**)&scene->instances, sizeof(GltfInstance) * *capacity))
+                return false;
+        }
+        GltfInstance* instance = &scene->instances[scene->instance_count++];
+        instance->mesh = (uint32_t)m;
+        mat4x4_dup(instance->world, world);
+    }
+    const JsonValue* children = json_member(&r->doc, node, "children");
+    for (uint32_t c = 0; children && c < children->count; ++c)
+        if (!add_node(r, scene, json_number(json_at(&r->doc, children, c), -1.0), world, depth + 1, capacity))
+            return false;
+    return true;
+}
+
+static bool add_instances(const GltfReader* r, GltfScene* scene)
+{
+    const JsonDocument* doc = &r->doc;
+    mat4x4 identity;
+    mat4x4_identity(identity);
+    uint32_t capacity = 0;
+    const JsonValue* scenes = json_member(doc, r->root, "scenes");
+    const JsonValue* chosen = json_at(doc, scenes, (uint32_t)json_member_number(doc, r->root, "scene", 0.0));
+    const JsonValue* roots = json_member(doc, chosen, "nodes");
+    if (roots)
+    {
+        for (uint32_t i = 0; i < roots->count; ++i)
+            if (!add_node(r, scene, json_number(json_at(doc, roots, i), -1.0), identity, 0, &capacity))
+                return false;
+        return true;
+    }
+
+    // No scene: every node no other one lists as a child is a root
+    const JsonValue* nodes = json_member(doc, r->root, "nodes");
+    const uint32_t count = nodes && nodes->type == JSON_ARRAY ? nodes->count : 0;
+    bool* child = (bool*)calloc(count ? count : 1, sizeof(bool));
+    if (!child)
+        return false;
+    for (uint32_t n = 0; n < count; ++n)
+    {
+        const JsonValue* children = json_member(doc, json_at(doc, nodes, n), "children");
+        for (uint32_t c = 0; children && c < children->count; ++c)
+        {
+            const double k = json_number(json_at(doc, children, c), -1.0);
+            if (k >= 0.0 && k < count)
+                child[(uint32_t)k] = true;
+        }
+    }
+    bool ok = true;
+    for (uint32_t n = 0; n < count && ok; ++n)
+        ok = child[n] || add_node(r, scene, n, identity, 0, &capacity);
+    free(child);
+    return ok;
+}
+
+static void free_reader(GltfReader* r)
+{
+    for (uint32_t i = 0; i < r->buffer_count; ++i)
+    {
+        mapped_file_close(&r->buffers[i].file);
+        free(r->buffers[i].decoded);
+    }
+    free(r->buffers);
+    json_free(&r->doc);
+}
+
+// The JSON text of a .gltf (all of it) or a .glb, whose header is followed by the JSON chunk and optionally the
+// BIN chunk. False (having logged) for a damaged .glb.
+static bool split_glb(const void* data, size_t size, const char** json, size_t* json_size, const uint8_t** bin,
+    size_t* bin_size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    *json = (const char*)data;
+    *json_size = size;
+    *bin = NULL;
+    *bin_size = 0;
+    uint32_t magic = 0;
+    if (size >= 4)
+        memcpy(&magic, bytes, 4);
+    if (magic == GLB_MAGIC)
+    {
+        uint32_t header[3], chunk[2];
+        size_t at = 12;
+        if (size >= 20)
+        {
+            memcpy(header, bytes, 12);
+            memcpy(chunk, bytes + at, 8);
+        }
+        if (size < 20 || header[1] != 2 || header[2] > size || chunk[1] != GLB_CHUNK_JSON
+            || chunk[0] > header[2] - 20)
+        {
+            fprintf(stderr, "gltf: not a glTF 2.0 binary\n");
+            return false;
+        }
+        *json = (const char*)bytes + 20;
+        *json_size = chunk[0];
+        at = 20 + ((size_t)chunk[0] + 3) / 4 * 4;
+        if (at + 8 <= header[2])
+        {
+            memcpy(chunk, bytes + at, 8);
+            if (chunk[1] == GLB_CHUNK_BIN && chunk[0] <= header[2] - at - 8)
+            {
+                *bin = bytes + at + 8;
+                *bin_size = chunk[0];
+            }
+        }
+    }
+    return true;
+}
+
+// "path"'s directory, "" for none
+static void model_dir(const char* path, char* dir, size_t size)
+{
+    snprintf(dir, size, "%s", path);
+    char* slash = strrchr(dir, '/');
+    char* backslash = strrchr(dir, '\\');
+    if (backslash && (!slash || backslash > slash))
+        slash = backslash;
+    if (slash)
+        *slash = '\0';
+    else
+        dir[0] = '\0';
+}
+
+bool gltf_load_memory(GltfScene* scene, const void* data, size_t size, const char* base_dir)
+{
+    memset(scene, 0, sizeof(*scene));
+    GltfReader r;
+    memset(&r, 0, sizeof(r));
+    r.base_dir = base_dir ? base_dir : "";
+    const char* json;
+    size_t json_size;
+    if (!split_glb(data, size, &json, &json_size, &r.bin, &r.bin_size))
+        return false;
+
+    bool ok = json_parse(&r.doc, json, json_size);
+    if (!ok)
+        fprintf(stderr, "gltf: %s\n", r.doc.error);
+    r.root = json_root(&r.doc);
+    const JsonValue* asset = json_member(&r.doc, r.root, "asset");
+    if (ok && strncmp(json_member_string(&r.doc, asset, "version", ""), "2.", 2))
+    {
+        fprintf(stderr, "gltf: not glTF 2.0\n");
+        ok = false;
+    }
+    const JsonValue* buffers = json_member(&r.doc, r.root, "buffers");
+    r.buffer_count = ok && buffers && buffers->type == JSON_ARRAY ? buffers->count : 0;
+    r.buffers = (GltfBuffer*)calloc(r.buffer_count ? r.buffer_count : 1, sizeof(GltfBuffer));
+    ok = ok && r.buffers;
+    for (uint32_t i = 0; i < r.buffer_count && ok; ++i)
+        ok = load_buffer(&r, i, json_at(&r.doc, buffers, i));
+
+    const JsonValue* meshes = json_member(&r.doc, r.root, "meshes");
+    scene->mesh_count = ok && meshes && meshes->type == JSON_ARRAY ? meshes->count : 0;
+    scene->meshes = (GltfMesh*)calloc(scene->mesh_count ? scene->mesh_count : 1, sizeof(GltfMesh));
+    ok = ok && scene->meshes;
+    for (uint32_t m = 0; m < scene->mesh_count && ok; ++m)
+        ok = load_mesh(&r, scene, m);
+    ok = ok && add_instances(&r, scene);
+    free_reader(&r);
+    if (!ok)
+        gltf_free(scene);
+    return ok;
+}
+
+bool gltf_load(GltfScene* scene, const char* path)
+{
+    memset(scene, 0, sizeof(*scene));
+    MappedFile file;
+    if (!mapped_file_open(&file, path))
+        return false;
+    char dir[1024];
+    model_dir(path, dir, sizeof(dir));
+    const bool ok = gltf_load_memory(scene, file.data, file.size, dir);
+    mapped_file_close(&file);
+    if (!ok)
+        fprintf(stderr, "gltf: can't load %s\n", path);
+    return ok;
+}
+
+bool gltf_buffer_files(const char* path, void (*visit)(void* user, const char* file), void* user)
+{
+    MappedFile file;
+    if (!mapped_file_open(&file, path))
+        return false;
+    char dir[1024];
+    model_dir(path, dir, sizeof(dir));
+    const char* json;
+    size_t json_size;
+    const uint8_t* bin;
+    size_t bin_size;
+    JsonDocument doc;
+    memset(&doc, 0, sizeof(doc));
+    bool ok = split_glb(file.data, file.size, &json, &json_size, &bin, &bin_size) && json_parse(&doc, json, json_size);
+    const JsonValue* buffers = json_member(&doc, json_root(&doc), "buffers");
+    for (uint32_t i = 0; ok && buffers && i < buffers->count; ++i)
+    {
+        const char* uri = json_member_string(&doc, json_at(&doc, buffers, i), "uri", NULL);
+        char buffer[2048];
+        if (uri && strncmp(uri, "data:", 5) && buffer_path(dir, uri, buffer, sizeof(buffer)))
+            visit(user, buffer);
+    }
+    if (!ok)
+        fprintf(stderr, "gltf: can't read %s's buffer list\n", path);
+    json_free(&doc);
+    mapped_file_close(&file);
+    return ok;
+}
+
+void gltf_free(GltfScene* scene)
+{
+    for (uint32_t m = 0; m < scene->mesh_count && scene->meshes; ++m)
+    {
+        free(scene->meshes[m].positions);
+        free(scene->meshes[m].normals);
+        free(scene->meshes[m].colors);
+        free(scene->meshes[m].indices);
+    }
+    free(scene->meshes);
+    free(scene->instances);
+    memset(scene, 0, sizeof(*scene));
+}
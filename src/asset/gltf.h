@@ -0,0 +1,72 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// glTF 2.0 import for the offline cooker (tools/asset_cooker.cpp), never the
+// runtime: .gltf JSON (asset/json.h) with its buffers in .bin files beside it
+// or inline as base64 data URIs, or a binary .glb with the buffer in its BIN
+// chunk. External buffers are memory-mapped.
+//
+// Each mesh comes out as one indexed triangle list, its primitives appended
+// one after the other: POSITION, and NORMAL and COLOR_0 where a primitive has
+// them (zeros and white where another of the mesh's doesn't), read through
+// their accessors whatever the component type, stride or normalisation.
+// Triangle strips and fans become lists; points, lines and sparse accessors
+// are skipped and counted. Materials and textures aren't read, only which
+// material index the mesh's triangles use, for static batching
+// (asset/static_batch.h) to merge only meshes that draw alike.
+//
+// The default scene's node tree (every root node when there are no scenes)
+// is flattened into instances: each node with a mesh gives one, with its
+// world matrix, from "matrix" or translation * rotation * scale.
+
+typedef struct GltfMesh
+{
+    char name[64];              // the mesh's "name", or "mesh<index>"
+    float* positions;           // 3 per vertex
+    float* normals;             // 3 per vertex; NULL when no primitive has them
+    float* colors;              // 3 per vertex (COLOR_0's RGB); NULL when no primitive has them
+    uint32_t vertex_count;
+    uint32_t* indices;          // a triangle list
+    uint32_t index_count;
+    float min[3], max[3];       // of the positions
+    int32_t material;           // its triangles' "material": -1 for none, GLTF_MATERIAL_MIXED when primitives differ
+} GltfMesh;
+
+#define GLTF_MATERIAL_MIXED (-2)
+
+typedef struct GltfInstance
+{
+    uint32_t mesh;
+    mat4x4 world;
+} GltfInstance;
+
+typedef struct GltfScene
+{
+    GltfMesh* meshes;
+    uint32_t mesh_count;
+    GltfInstance* instances;
+    uint32_t instance_count;
+    uint32_t skipped_primitives;    // not triangles, or with sparse accessors
+} GltfScene;
+
+// Loads a .gltf or .glb file (told apart by the GLB magic). Logs and returns false when it's malformed, a buffer
+// can't be read or an accessor reaches outside its buffer.
+bool gltf_load(GltfScene* scene, const char* path);
+
+// The same for a file in memory; relative buffer URIs are resolved against "base_dir" ("" for none)
+bool gltf_load_memory(GltfScene* scene, const void* data, size_t size, const char* base_dir);
+
+void gltf_free(GltfScene* scene);
+
+// Calls visit(user, file) for each external file "path"'s buffers are read from (none for data URIs or a .glb's
+// own chunk), resolved as gltf_load resolves them, so build tools can hash everything a model depends on without
+// loading it. Reads only the JSON. False (having logged) when that can't be read.
+bool gltf_buffer_files(const char* path, void (*visit)(void* user, const char* file), void* user);
+
+// Decodes "length" characters of base64 (padding optional) into "out" (room for 3 * length / 4 bytes). Returns
+// the byte count, or SIZE_MAX when the text isn't base64.
+size_t gltf_base64_decode(const char* text, size_t length, uint8_t* out);
@@ -0,0 +1,399 @@
+#include "asset/json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct JsonParser
+{
+    JsonDocument* doc;
+    const char* p;
+    const char* end;
+    const char* text;
+    uint32_t* stack;            // children of the containers still open, innermost last
+    uint32_t stack_count;
+    uint32_t stack_capacity;
+    bool failed;
+} JsonParser;
+
+static bool fail(JsonParser* ps, const char* what)
+{
+    if (!ps->failed)
+    {
+        int line = 1;
+        for (const char* c = ps->text; c < ps->p && c < ps->end; ++c)
+            line += *c == '\n';
+        snprintf(ps->doc->error, sizeof(ps->doc->error), "%s on line %d", what, line);
+    }
+    ps->failed = true;
+    return false;
+}
+
+// Room for "extra" more of "*count" items of "size" bytes in "*data"
+static bool reserve(void** data, size_t* capacity, size_t count, size_t extra, size_t size)
+{
+    if (count + extra <= *capacity)
+        return true;
+    size_t grown = *capacity ? *capacity * 2 : 64;
+    while (grown < count + extra)
+        grown *= 2;
+    void* p = realloc(*data, grown * size);
+    if (!p)
+        return false;
+    *data = p;
+    *capacity = grown;
+    return true;
+}
+
+static bool reserve32(void** data, uint32_t* capacity, uint32_t count, size_t size)
+{
+    size_t wide = *capacity;
+    if (count == UINT32_MAX || !reserve(data, &wide, count, 1, size) || wide > UINT32_MAX)
+        return false;
+    *capacity = (uint32_t)wide;
+    return true;
+}
+
+static void skip_space(JsonParser* ps)
+{
+    while (ps->p < ps->end && (*ps->p == ' ' || *ps->p == '\t' || *ps->p == '\n' || *ps->p == '\r'))
+        ++ps->p;
+}
+
+static bool add_char(JsonParser* ps, char c)
+{
+    JsonDocument* doc = ps->doc;
+    if (!reserve((void**)&doc->strings, &doc->string_capacity, doc->string_size, 1, 1))
+        return fail(ps, "out of memory");
+    doc->strings[doc->string_size++] = c;
+    return true;
+}
+
+static bool add_utf8(JsonParser* ps, uint32_t cp)
+{
+    if (cp < 0x80)
+        return add_char(ps, (char)cp);
+    if (cp < 0x800)
+        return add_char(ps, (char)(0xC0 | cp >> 6)) && add_char(ps, (char)(0x80 | (cp & 0x3F)));
+    if (cp < 0x10000)
+        return add_char(ps, (char)(0xE0 | cp >> 12)) && add_char(ps, (char)(0x80 | (cp >> 6 & 0x3F)))
+            && add_char(ps, (char)(0x80 | (cp & 0x3F)));
+    return add_char(ps, (char)(0xF0 | cp >> 18)) && add_char(ps, (char)(0x80 | (cp >> 12 & 0x3F)))
+        && add_char(ps, (char)(0x80 | (cp >> 6 & 0x3F))) && add_char(ps, (char)(0x80 | (cp & 0x3F)));
+}
+
+static bool hex4(JsonParser* ps, uint32_t* out)
+{
+    if (ps->end - ps->p < 4)
+        return fail(ps, "short \\u escape");
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        const char c = *ps->p++;
+        v <<= 4;
+        if (c >= '0' && c <= '9')
+            v |= (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            v |= (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            v |= (uint32_t)(c - 'A' + 10);
+        else
+            return fail(ps, "bad \\u escape");
+    }
+    *out = v;
+    return true;
+}
+
+// A string at the opening quote, unescaped into the strings; its offset to "*offset"
+static bool parse_string(JsonParser* ps, uint32_t* offset)
+{
+    JsonDocument* doc = ps->doc;
+    if (doc->string_size > UINT32_MAX)
+        return fail(ps, "too much text");
+    *offset = (uint32_t)doc->string_size;
+    ++ps->p;
+    while (ps->p < ps->end && *ps->p != '"')
+    {
+        const char c = *ps->p++;
+        if ((unsigned char)c < 0x20)
+            return fail(ps, "control character in a string");
+        if (c != '\\')
+        {
+            if (!add_char(ps, c))
+                return false;
+            continue;
+        }
+        if (ps->p == ps->end)
+            break;
+        const char e = *ps->p++;
+        bool ok;
+        switch (e)
+        {
+        case '"': ok = add_char(ps, '"'); break;
+        case '\\': ok = add_char(ps, '\\'); break;
+        case '/': ok = add_char(ps, '/'); break;
+        case 'b': ok = add_char(ps, '\b'); break;
+        case 'f': ok = add_char(ps, '\f'); break;
+        case 'n': ok = add_char(ps, '\n'); break;
+        case 'r': ok = add_char(ps, '\r'); break;
+        case 't': ok = add_char(ps, '\t'); break;
+        case 'u':
+        {
+            uint32_t cp;
+            if (!hex4(ps, &cp))
+                return false;
+            if (cp >= 0xD800 && cp < 0xDC00)
+            {
+                // A surrogate pair: the low half must follow
+                uint32_t low;
+                if (ps->end - ps->p < 2 || ps->p[0] != '\\' || ps->p[1] != 'u')
+                    return fail(ps, "unpaired surrogate");
+                ps->p += 2;
+                if (!hex4(ps, &low))
+                    return false;
+                if (low < 0xDC00 || low >= 0xE000)
+                    return fail(ps, "unpaired surrogate");
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            ok = add_utf8(ps, cp);
+            break;
+        }
+        default:
+            return fail(ps, "bad escape");
+        }
+        if (!ok)
+            return false;
+    }
+    if (ps->p == ps->end)
+        return fail(ps, "unterminated string");
+    ++ps->p;
+    return add_char(ps, '\0');
+}
+
+static bool parse_number(JsonParser* ps, double* out)
+{
+    // strtod wants a terminated copy; numbers are short
+    char text[64];
+    size_t n = 0;
+    while (ps->p < ps->end && n < sizeof(text) - 1 && (strchr("+-.eE", *ps->p) || (*ps->p >= '0' && *ps->p <= '9')))
+        text[n++] = *ps->p++;
+    text[n] = '\0';
+    char* stop = NULL;
+    *out = strtod(text, &stop);
+    // strtod is laxer than JSON: the integer part must be a digit, or a 0 alone
+    const char* digits = text[0] == '-' ? text + 1 : text;
+    if (n == 0 || stop != text + n || !(digits[0] >= '0' && digits[0] <= '9')
+        || (digits[0] == '0' && digits[1] >= '0' && digits[1] <= '9'))
+        return fail(ps, "bad number");
+    return true;
+}
+
+static bool literal(JsonParser* ps, const char* word)
+{
+    const size_t n = strlen(word);
+    if ((size_t)(ps->end - ps->p) < n || memcmp(ps->p, word, n) != 0)
+        return fail(ps, "unexpected character");
+    ps->p += n;
+    return true;
+}
+
+static bool new_value(JsonParser* ps, JsonType type, uint32_t* index)
+{
+    JsonDocument* doc = ps->doc;
+    if (!reserve32((void**)&doc->values, &doc->value_capacity, doc->value_count, sizeof(JsonValue)))
+        return fail(ps, "out of memory");
+    *index = doc->value_count++;
+    JsonValue* v = &doc->values[*index];
+    memset(v, 0, sizeof(*v));
+    v->type = type;
+    return true;
+}
+
+static bool push_child(JsonParser* ps, uint32_t index)
+{
+    if (!reserve32((void**)&ps->stack, &ps->stack_capacity, ps->stack_count, sizeof(uint32_t)))
+        return fail(ps, "out of memory");
+    ps->stack[ps->stack_count++] = index;
+    return true;
+}
+
+// The children pushed since "mark" become the container's run
+static bool close_container(JsonParser* ps, uint32_t container, uint32_t mark)
+{
+    JsonDocument* doc = ps->doc;
+    const uint32_t count = ps->stack_count - mark;
+    size_t capacity = doc->child_capacity;
+    if (!reserve((void**)&doc->children, &capacity, doc->child_count, count, sizeof(uint32_t))
+        || capacity > UINT32_MAX)
+        return fail(ps, "out of memory");
+    doc->child_capacity = (uint32_t)capacity;
+    if (count)      // an empty container may find no children or stack allocated yet
+        memcpy(doc->children + doc->child_count, ps->stack + mark, sizeof(uint32_t) * count);
+    doc->values[container].first = doc->child_count;
+    doc->values[container].count = count;
+    doc->child_count += count;
+    ps->stack_count = mark;
+    return true;
+}
+
+static bool parse_value(JsonParser* ps, uint32_t* index, int depth);
+
+static bool parse_container(JsonParser* ps, uint32_t* index, int depth, bool object)
+{
+    if (depth >= JSON_MAX_DEPTH)
+        return fail(ps, "nested too deeply");
+    if (!new_value(ps, object ? JSON_OBJECT : JSON_ARRAY, index))
+        return false;
+    const char close = object ? '}' : ']';
+    const uint32_t mark = ps->stack_count;
+    ++ps->p;
+    skip_space(ps);
+    if (ps->p < ps->end && *ps->p == close)
+    {
+        ++ps->p;
+        return close_container(ps, *index, mark);
+    }
+    for (;;)
+    {
+        uint32_t key = 0, child;
+        skip_space(ps);
+        if (object)
+        {
+            if (ps->p == ps->end || *ps->p != '"')
+                return fail(ps, "expected a key");
+            if (!parse_string(ps, &key))
+                return false;
+            skip_space(ps);
+            if (ps->p == ps->end || *ps->p != ':')
+                return fail(ps, "expected ':'");
+            ++ps->p;
+        }
+        if (!parse_value(ps, &child, depth + 1) || !push_child(ps, child))
+            return false;
+        ps->doc->values[child].key = key;
+        skip_space(ps);
+        if (ps->p < ps->end && *ps->p == ',')
+        {
+            ++ps->p;
+            continue;
+        }
+        if (ps->p < ps->end && *ps->p == close)
+        {
+            ++ps->p;
+            return close_container(ps, *index, mark);
+        }
+        return fail(ps, object ? "expected ',' or '}'" : "expected ',' or ']'");
+    }
+}
+
+static bool parse_value(JsonParser* ps, uint32_t* index, int depth)
+{
+    skip_space(ps);
+    if (ps->p == ps->end)
+        return fail(ps, "unexpected end");
+    switch (*ps->p)
+    {
+    case '{':
+        return parse_container(ps, index, depth, true);
+    case '[':
+        return parse_container(ps, index, depth, false);
+    case '"':
+    {
+        uint32_t text;
+        if (!parse_string(ps, &text) || !new_value(ps, JSON_STRING, index))
+            return false;
+        ps->doc->values[*index].string = text;
+        return true;
+    }
+    case 't':
+        return literal(ps, "true") && new_value(ps, JSON_TRUE, index);
+    case 'f':
+        return literal(ps, "false") && new_value(ps, JSON_FALSE, index);
+    case 'n':
+        return literal(ps, "null") && new_value(ps, JSON_NULL, index);
+    default:
+    {
+        double number;
+        if (!parse_number(ps, &number) || !new_value(ps, JSON_NUMBER, index))
+            return false;
+        ps->doc->values[*index].number = number;
+        return true;
+    }
+    }
+}
+
+bool json_parse(JsonDocument* doc, const char* text, size_t size)
+{
+    memset(doc, 0, sizeof(*doc));
+    JsonParser ps = { doc, text, text + size, text, NULL, 0, 0, false };
+    uint32_t root;
+    // Offset 0 is the empty string every key-less value points at
+    bool ok = add_char(&ps, '\0') && parse_value(&ps, &root, 0);
+    if (ok)
+    {
+        skip_space(&ps);
+        if (ps.p != ps.end)
+            ok = fail(&ps, "text after the value");
+    }
+    free(ps.stack);
+    return ok;
+}
+
+void json_free(JsonDocument* doc)
+{
+    free(doc->values);
+    free(doc->children);
+    free(doc->strings);
+    memset(doc, 0, sizeof(*doc));
+}
+
+const JsonValue* json_at(const JsonDocument* doc, const JsonValue* v, uint32_t i)
+{
+    if (!v || (v->type != JSON_ARRAY && v->type != JSON_OBJECT) || i >= v->count)
+        return NULL;
+    return &doc->values[doc->children[v->first + i]];
+}
+
+const JsonValue* json_member(const JsonDocument* doc, const JsonValue* v, const char* key)
+{
+    if (!v || v->type != JSON_OBJECT)
+        return NULL;
+    for (uint32_t i = 0; i < v->count; ++i)
+    {
+        const JsonValue* member = &doc->values[doc->children[v->first + i]];
+        if (!strcmp(doc->strings + member->key, key))
+            return member;
+    }
+    return NULL;
+}
+
+const char* json_key(const JsonDocument* doc, const JsonValue* member)
+{
+    return doc->strings + member->key;
+}
+
+const char* json_string(const JsonDocument* doc, const JsonValue* v, const char* fallback)
+{
+    return v && v->type == JSON_STRING ? doc->strings + v->string : fallback;
+}
+
+double json_number(const JsonValue* v, double fallback)
+{
+    return v && v->type == JSON_NUMBER ? v->number : fallback;
+}
+
+double json_member_number(const JsonDocument* doc, const JsonValue* v, const char* key, double fallback)
+{
+    return json_number(json_member(doc, v, key), fallback);
+}
+
+const char* json_member_string(const JsonDocument* doc, const JsonValue* v, const char* key, const char* fallback)
+{
+    return json_string(doc, json_member(doc, v, key), fallback);
+}
+
+bool json_member_bool(const JsonDocument* doc, const JsonValue* v, const char* key, bool fallback)
+{
+    const JsonValue* m = json_member(doc, v, key);
+    return m && m->type == JSON_TRUE ? true : m && m->type == JSON_FALSE ? false : fallback;
+}
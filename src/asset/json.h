@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A small JSON reader for the offline tools (asset/gltf.h): the whole text
+// parsed in one pass into a document of values, for lookups afterwards.
+// Nothing at runtime parses JSON; the cooker turns it into mapped binaries.
+//
+// Every value lives in one array, and a container's children are a
+// contiguous run of another one (filled as each container closes), so an
+// array's element i or an object's member i is one index away. Strings are
+// unescaped into a shared buffer, NUL-terminated, \u escapes as UTF-8.
+// Member lookup by key is a linear scan of the object, which suits the
+// short objects of a glTF file. Nesting deeper than JSON_MAX_DEPTH is an
+// error rather than a stack overflow.
+
+#define JSON_MAX_DEPTH 256
+
+typedef enum JsonType
+{
+    JSON_NULL,
+    JSON_FALSE,
+    JSON_TRUE,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JsonType;
+
+typedef struct JsonValue
+{
+    JsonType type;
+    uint32_t count;             // elements of an array, members of an object
+    uint32_t first;             // of those, into the document's children
+    uint32_t key;               // a member's key, into the strings; 0 ("") otherwise
+    uint32_t string;            // a string's text, into the strings
+    double number;
+} JsonValue;
+
+typedef struct JsonDocument
+{
+    JsonValue* values;          // [0] is the root
+    uint32_t value_count;
+    uint32_t value_capacity;
+    uint32_t* children;         // value indices, each container's run in order
+    uint32_t child_count;
+    uint32_t child_capacity;
+    char* strings;              // NUL-terminated texts end to end; offset 0 is ""
+    size_t string_size;
+    size_t string_capacity;
+    char error[128];            // what json_parse found, with its line
+} JsonDocument;
+
+// Parses "size" bytes of "text" (one value, surrounded by nothing but whitespace). Returns false with "error"
+// set on malformed text or when out of memory; json_free is needed either way.
+bool json_parse(JsonDocument* doc, const char* text, size_t size);
+void json_free(JsonDocument* doc);
+
+static inline const JsonValue* json_root(const JsonDocument* doc)
+{
+    return doc->value_count ? &doc->values[0] : NULL;
+}
+
+// Element "i" of an array or member "i" of an object; NULL when "v" is neither (or NULL) or "i" is past its end
+const JsonValue* json_at(const JsonDocument* doc, const JsonValue* v, uint32_t i);
+
+// The member of object "v" called "key"; NULL when there's none or "v" isn't an object
+const JsonValue* json_member(const JsonDocument* doc, const JsonValue* v, const char* key);
+
+// An object member's key (json_at gives the members)
+const char* json_key(const JsonDocument* doc, const JsonValue* member);
+
+// A string's text, or "fallback" when "v" is NULL or not a string
+const char* json_string(const JsonDocument* doc, const JsonValue* v, const char* fallback);
+
+// A number, or "fallback" when "v" is NULL or not a number
+double json_number(const JsonValue* v, double fallback);
+
+// Shorthands for members: json_number / json_string of json_member, and a bool (true / false)
+double json_member_number(const JsonDocument* doc, const JsonValue* v, const char* key, double fallback);
+const char* json_member_string(const JsonDocument* doc, const JsonValue* v, const char* key, const char* fallback);
+bool json_member_bool(const JsonDocument* doc, const JsonValue* v, const char* key, bool fallback);
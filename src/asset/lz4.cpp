@@ -0,0 +1,189 @@
+#include "asset/lz4.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5         // a block always ends in this many literals
+#define LZ4_MATCH_LIMIT 12          // and no match starts within this many bytes of its end
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 12
+
+static uint32_t read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash4(const uint8_t* p)
+{
+    return (read32(p) * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+// Writes the 255-byte run that follows a length nibble of 15
+static uint8_t* write_length(uint8_t* p, size_t length)
+{
+    for (; length >= 255; length -= 255)
+        *p++ = 255;
+    *p++ = (uint8_t)length;
+    return p;
+}
+
+// One sequence: "literal_count" literals, then a match unless "match_length" is 0 (the last sequence). Returns
+// false when it doesn't fit before "end".
+static bool emit(uint8_t** out, const uint8_t* end, const uint8_t* literals, size_t literal_count, size_t offset,
+    size_t match_length)
+{
+    const size_t needed = 1 + literal_count + literal_count / 255 + 1 + (match_length ? 3 + match_length / 255 : 0);
+    if (needed > (size_t)(end - *out))
+        return false;
+    uint8_t* p = *out;
+    uint8_t* token = p++;
+    if (literal_count >= 15)
+    {
+        *token = 15 << 4;
+        p = write_length(p, literal_count - 15);
+    }
+    else
+        *token = (uint8_t)(literal_count << 4);
+    memcpy(p, literals, literal_count);
+    p += literal_count;
+    if (match_length)
+    {
+        *p++ = (uint8_t)offset;
+        *p++ = (uint8_t)(offset >> 8);
+        const size_t length = match_length - LZ4_MIN_MATCH;
+        if (length >= 15)
+        {
+            *token |= 15;
+            p = write_length(p, length - 15);
+        }
+        else
+            *token |= (uint8_t)length;
+    }
+    *out = p;
+    return true;
+}
+
+size_t lz4_compress_bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t lz4_compress(const void* src, size_t size, void* dst, size_t capacity)
+{
+    const uint8_t* in = (const uint8_t*)src;
+    uint8_t* op = (uint8_t*)dst;
+    const uint8_t* op_end = op + capacity;
+    const uint8_t* anchor = in;
+
+    if (size > LZ4_MATCH_LIMIT)
+    {
+        // Positions are offsets into "in"; a stale or empty slot is only a candidate that fails to match
+        uint32_t table[1u << LZ4_HASH_BITS];
+        memset(table, 0, sizeof(table));
+        const uint8_t* match_start_limit = in + size - LZ4_MATCH_LIMIT;
+        const uint8_t* match_end_limit = in + size - LZ4_LAST_LITERALS;
+        const uint8_t* ip = in + 1;
+        while (ip < match_start_limit)
+        {
+            const uint32_t h = hash4(ip);
+            const uint8_t* candidate = in + table[h];
+            table[h] = (uint32_t)(ip - in);
+            if (ip - candidate > LZ4_MAX_OFFSET || read32(candidate) != read32(ip))
+            {
+                // The longer nothing has matched, the bigger the steps, so incompressible data goes quickly
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            while (ip > anchor && candidate > in && ip[-1] == candidate[-1])
+            {
+                --ip;
+                --candidate;
+            }
+            size_t length = LZ4_MIN_MATCH;
+            while (ip + length < match_end_limit && ip[length] == candidate[length])
+                ++length;
+            if (!emit(&op, op_end, anchor, (size_t)(ip - anchor), (size_t)(ip - candidate), length))
+                return 0;
+            ip += length;
+            anchor = ip;
+            if (ip - 2 > in && ip < match_start_limit)
+                table[hash4(ip - 2)] = (uint32_t)(ip - 2 - in);
+        }
+    }
+    if (!emit(&op, op_end, anchor, (size_t)(in + size - anchor), 0, 0))
+        return 0;
+    return (size_t)(op - (uint8_t*)dst);
+}
+
+// Reads the bytes that extend a length nibble of 15. False when the block ends first.
+static bool read_length(const uint8_t** in, const uint8_t* end, size_t* length)
+{
+    uint8_t byte;
+    do
+    {
+        if (*in == end)
+            return false;
+        byte = *(*in)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool lz4_decompress(const void* src, size_t src_size, void* dst, size_t dst_size)
+{
+    const uint8_t* ip = (const uint8_t*)src;
+    const uint8_t* ip_end = ip + src_size;
+    uint8_t* out = (uint8_t*)dst;
+    uint8_t* op = out;
+    uint8_t* op_end = out + dst_size;
+    for (;;)
+    {
+        if (ip == ip_end)
+            return false;
+        const uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_length(&ip, ip_end, &literals))
+            return false;
+        if (literals > (size_t)(ip_end - ip) || literals > (size_t)(op_end - op))
+            return false;
+        // Most runs are short: with room on both sides, one fixed 16-byte copy is cheaper than an exact one
+        if (literals <= 16 && ip_end - ip >= 16 && op_end - op >= 16)
+            memcpy(op, ip, 16);
+        else
+            memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == ip_end)
+            return op == op_end;
+
+        if (ip_end - ip < 2)
+            return false;
+        const size_t offset = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        size_t length = token & 15;
+        if (length == 15 && !read_length(&ip, ip_end, &length))
+            return false;
+        length += LZ4_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - out) || length > (size_t)(op_end - op))
+            return false;
+        const uint8_t* match = op - offset;
+        if (offset >= 8 && (size_t)(op_end - op) >= length + 8)
+        {
+            // Eight bytes at a time, past the end if need be: each reads bytes already written
+            for (size_t i = 0; i < length; i += 8)
+                memcpy(op + i, match + i, 8);
+        }
+        else if (offset >= length)
+            memcpy(op, match, length);
+        else
+        {
+            // Overlapping: the match repeats bytes this copy is still writing
+            for (size_t i = 0; i < length; ++i)
+                op[i] = match[i];
+        }
+        op += length;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+
+// LZ4 block format compression (asset packages, asset/asset_package.h).
+//
+// The output is a standard LZ4 block - sequences of a token, literals, a
+// two-byte offset and a match length, with the last five bytes always
+// literals - so any LZ4 block decoder reads it, and lz4_decompress reads
+// blocks from the reference compressor. There is no frame: the caller
+// stores the sizes. The compressor is the single-pass greedy one (a hash of
+// the next four bytes finds a match candidate, 64 KB back at most) that
+// trades ratio for speed: cooking time is spent elsewhere, and decompressing
+// is what a load waits for.
+//
+// lz4_decompress checks every length and offset against both buffers, so a
+// corrupt block fails instead of reading or writing out of bounds.
+
+// The most bytes compressing "size" bytes can produce
+size_t lz4_compress_bound(size_t size);
+
+// Compresses "size" bytes into "dst". Returns the compressed size, or 0 when it doesn't fit in "capacity"
+// (lz4_compress_bound is always enough).
+size_t lz4_compress(const void* src, size_t size, void* dst, size_t capacity);
+
+// Decompresses a block that must come to exactly "dst_size" bytes. False when it's corrupt or another size.
+bool lz4_decompress(const void* src, size_t src_size, void* dst, size_t dst_size);
@@ -0,0 +1,138 @@
+#include "asset/mesh_cook.h"
+
+#include "asset/mesh_file.h"
+#include "asset/mesh_optimize.h"
+#include "asset/mesh_simplify.h"
+#include "asset/meshlet.h"
+#include "asset/vertex_pack.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct CookVertex
+{
+    float position[3];
+    float color[3];
+} CookVertex;
+
+void mesh_cook_default_options(MeshCookOptions* options)
+{
+    options->float_positions = false;
+    options->lod_ratio = 0.5f;
+    options->max_lods = MESH_FILE_MAX_LODS;
+    options->meshlets = true;
+    options->streams = MESH_COOK_STREAMS_AUTO;
+}
+
+bool mesh_cook(const GltfMesh* mesh, const MeshCookOptions* options, const char* path, MeshCookResult* result)
+{
+    memset(result, 0, sizeof(*result));
+    const size_t index_count = mesh->index_count / 3 * 3;
+    if (!index_count || !mesh->vertex_count)
+    {
+        fprintf(stderr, "mesh_cook: %s has no triangles\n", mesh->name);
+        return false;
+    }
+    int max_lods = options->max_lods < 1 ? 1 : options->max_lods;
+    if (max_lods > MESH_FILE_MAX_LODS)
+        max_lods = MESH_FILE_MAX_LODS;
+
+    const size_t chain_capacity = 2 * index_count;  // the levels shrink at least a tenth each
+    CookVertex* vertices = (CookVertex*)malloc(sizeof(CookVertex) * mesh->vertex_count);
+    uint32_t* indices = (uint32_t*)malloc(sizeof(uint32_t) * index_count);
+    uint32_t* chain = (uint32_t*)malloc(sizeof(uint32_t) * chain_capacity);
+    Meshlet* meshlets = options->meshlets ? (Meshlet*)malloc(sizeof(Meshlet) * meshlet_bound(index_count)) : NULL;
+    void* packed = NULL;
+    bool ok = vertices && indices && chain && (meshlets || !options->meshlets);
+
+    // Rounded to what's stored, so the simplifier's errors and the meshlets' bounds are the GPU's
+    for (uint32_t v = 0; v < mesh->vertex_count && ok; ++v)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            const float p = mesh->positions[3 * v + c];
+            vertices[v].position[c] = options->float_positions ? p : vertex_half_to_float(vertex_float_to_half(p));
+            vertices[v].color[c] = mesh->colors ? mesh->colors[3 * v + c]
+                : mesh->normals ? mesh->normals[3 * v + c] * 0.5f + 0.5f : 1.f;
+        }
+    }
+    if (ok)
+    {
+        memcpy(indices, mesh->indices, sizeof(uint32_t) * index_count);
+        result->acmr_before = mesh_analyze_vertex_cache(indices, index_count, mesh->vertex_count, 32).acmr;
+        ok = mesh_optimize_vertex_cache(indices, index_count, mesh->vertex_count);
+    }
+    const size_t vertex_count = ok ? mesh_optimize_vertex_fetch(vertices, indices, index_count, mesh->vertex_count,
+        sizeof(CookVertex)) : 0;
+    MeshLod lods[MESH_SIMPLIFY_MAX_LODS];
+    const int lod_count = vertex_count ? mesh_simplify_lods(chain, chain_capacity, lods, max_lods, indices, index_count,
+        vertices[0].position, sizeof(CookVertex), vertex_count, options->lod_ratio) : 0;
+    ok = lod_count > 0;
+
+    // Level 0 in meshlet order; its range in the chain stays where it was
+    size_t meshlet_count = 0;
+    if (ok && meshlets)
+    {
+        meshlet_count = meshlet_build(meshlets, indices, chain, lods[0].index_count, vertices[0].position,
+            sizeof(CookVertex), vertex_count);
+        ok = meshlet_count > 0;
+        if (ok)
+            memcpy(chain, indices, sizeof(uint32_t) * lods[0].index_count);
+    }
+
+    MeshFileAttrib attribs[MESH_FILE_MAX_ATTRIBS];
+    int attrib_count = 0;
+    uint32_t stride = 0, attribute_stride = 0;
+    ok = ok && vertex_pack_add(attribs, &attrib_count, &stride, 0, 3,
+                  options->float_positions ? VERTEX_ATTRIB_FLOAT32 : VERTEX_ATTRIB_FLOAT16)
+        && vertex_pack_add(attribs, &attrib_count, &stride, 1, 3, VERTEX_ATTRIB_UNORM8);
+    const bool split = options->streams == MESH_COOK_STREAMS_SPLIT
+        || (options->streams == MESH_COOK_STREAMS_AUTO && (uint64_t)stride * vertex_count >= MESH_COOK_SPLIT_BYTES);
+    if (ok && split)
+        vertex_pack_split(attribs, attrib_count, 0, &stride, &attribute_stride);
+    packed = ok ? malloc((size_t)vertex_pack_size(stride, attribute_stride, vertex_count)) : NULL;
+    if (!ok || !packed)
+    {
+        fprintf(stderr, "mesh_cook: out of memory for %s\n", mesh->name);
+        ok = false;
+    }
+    if (ok)
+    {
+        const VertexSource sources[2] = { { vertices[0].position, sizeof(CookVertex) },
+            { vertices[0].color, sizeof(CookVertex) } };
+        vertex_pack_streams(attribs, attrib_count, stride, attribute_stride, sources, vertex_count, packed);
+        MeshFileLod file_lods[MESH_FILE_MAX_LODS];
+        for (int l = 0; l < lod_count; ++l)
+            file_lods[l] = { lods[l].first_index, lods[l].index_count, lods[l].error, 0 };
+        const uint32_t chain_count = lods[lod_count - 1].first_index + lods[lod_count - 1].index_count;
+        ok = mesh_file_write_meshlets(path, attribs, attrib_count, stride, packed, (uint32_t)vertex_count, chain,
+            chain_count, file_lods, lod_count, meshlets, (uint32_t)meshlet_count);
+
+        result->vertex_count = (uint32_t)vertex_count;
+        result->index_count = lods[0].index_count;
+        result->lod_count = (uint32_t)lod_count;
+        result->meshlet_count = (uint32_t)meshlet_count;
+        result->split = attribute_stride != 0;
+        result->acmr_after = mesh_analyze_vertex_cache(chain, lods[0].index_count, vertex_count, 32).acmr;
+        float radius2 = 0.f;
+        for (size_t v = 0; v < vertex_count; ++v)
+        {
+            const float* p = vertices[v].position;
+            radius2 = fmaxf(radius2, p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+            for (int c = 0; c < 3; ++c)
+            {
+                result->min[c] = v ? fminf(result->min[c], p[c]) : p[c];
+                result->max[c] = v ? fmaxf(result->max[c], p[c]) : p[c];
+            }
+        }
+        result->radius = sqrtf(radius2);
+    }
+    free(packed);
+    free(meshlets);
+    free(chain);
+    free(indices);
+    free(vertices);
+    return ok;
+}
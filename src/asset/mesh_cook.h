@@ -0,0 +1,69 @@
+#pragma once
+
+#include "asset/gltf.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cooking one imported mesh (asset/gltf.h) into a mesh file (asset/mesh_file.h)
+// the runtime maps and uploads as it is. The steps are the ones the repo's
+// offline passes already provide, in the order they depend on each other:
+//
+//   - interleave position and colour (COLOR_0, else the normal mapped to
+//     [0, 1], else white) and round the positions to the precision they'll be
+//     stored at, so every later step measures what the GPU will read;
+//   - reorder the triangles for the post-transform cache, then the vertices
+//     into first-use order (asset/mesh_optimize.h), dropping unused ones;
+//   - simplify into a chain of levels of detail sharing that vertex buffer
+//     (asset/mesh_simplify.h);
+//   - split level 0 into meshlets with bounds and normal cones
+//     (asset/meshlet.h), which reorders its triangles once more;
+//   - pack position as 3 halves (or floats) and colour as 3 UNORM8 with the
+//     runtime's own layout code (asset/vertex_pack.h), interleaved or as a
+//     position stream and an attribute stream (MeshCookStreams), and write
+//     it all.
+//
+// Every call is independent, with its own allocations, so the cooker runs one
+// per mesh on all the job system's threads.
+
+// How the vertices are stored. Split, the passes that only need positions (the depth pre-pass, shadows) fetch the
+// position stream alone; interleaved, the colour pass fetches a vertex in one piece. MESH_COOK_STREAMS_AUTO splits
+// meshes whose vertices take MESH_COOK_SPLIT_BYTES or more: a smaller mesh's stay in the GPU's cache between passes,
+// so fetching less of them saves little.
+typedef enum MeshCookStreams
+{
+    MESH_COOK_STREAMS_AUTO,
+    MESH_COOK_STREAMS_INTERLEAVED,
+    MESH_COOK_STREAMS_SPLIT
+} MeshCookStreams;
+
+#define MESH_COOK_SPLIT_BYTES (256 * 1024)
+
+typedef struct MeshCookOptions
+{
+    bool float_positions;       // FLOAT32 positions instead of FLOAT16
+    float lod_ratio;            // each level's share of the triangles of the one before
+    int max_lods;               // 1: level 0 only; at most MESH_FILE_MAX_LODS
+    bool meshlets;              // store level 0's meshlets
+    MeshCookStreams streams;
+} MeshCookOptions;
+
+typedef struct MeshCookResult
+{
+    uint32_t vertex_count;      // after unused vertices are dropped
+    uint32_t index_count;       // level 0's
+    uint32_t lod_count;
+    uint32_t meshlet_count;
+    bool split;                 // stored as split streams
+    float radius;               // bounding sphere about the mesh's origin, as stored
+    float min[3], max[3];       // box, as stored
+    float acmr_before;          // level 0's misses per triangle in a 32-entry FIFO cache
+    float acmr_after;
+} MeshCookResult;
+
+// Half positions, LODs at half the triangles each, up to MESH_FILE_MAX_LODS levels, meshlets, streams chosen per mesh
+void mesh_cook_default_options(MeshCookOptions* options);
+
+// Cooks "mesh" to a mesh file at "path". Logs and returns false when it has no triangles, memory runs out or the
+// file can't be written.
+bool mesh_cook(const GltfMesh* mesh, const MeshCookOptions* options, const char* path, MeshCookResult* result);
@@ -0,0 +1,250 @@
+#include "asset/mesh_file.h"
+
+#include "asset/vertex_pack.h"
+
+#include <filesystem>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t align_up(uint64_t x)
+{
+    return (x + MESH_FILE_ALIGN - 1) & ~(uint64_t)(MESH_FILE_ALIGN - 1);
+}
+
+#define MESH_FILE_V1_HEADER_SIZE offsetof(MeshFileHeader, lods)
+#define MESH_FILE_V2_HEADER_SIZE offsetof(MeshFileHeader, meshlet_count)
+#define MESH_FILE_V3_HEADER_SIZE offsetof(MeshFileHeader, attribute_stride)
+
+uint64_t mesh_file_vertex_bytes(const MeshFileHeader* h)
+{
+    if (h->version < 4 || !h->attribute_stride)
+        return (uint64_t)h->vertex_count * h->vertex_stride;
+    return h->attribute_offset + (uint64_t)h->vertex_count * h->attribute_stride;
+}
+
+// NULL when the header describes blobs that lie inside the file, else what is wrong with it
+static const char* validate_header(const MeshFileHeader* h, uint64_t size)
+{
+    if (size < MESH_FILE_V1_HEADER_SIZE || h->magic != MESH_FILE_MAGIC)
+        return "not a mesh file";
+    if (h->version < 1 || h->version > MESH_FILE_VERSION)
+        return "unsupported version";
+    if ((h->version == 2 && size < MESH_FILE_V2_HEADER_SIZE) || (h->version == 3 && size < MESH_FILE_V3_HEADER_SIZE)
+        || (h->version >= 4 && size < sizeof(MeshFileHeader)))
+        return "not a mesh file";
+    if (h->attrib_count == 0 || h->attrib_count > MESH_FILE_MAX_ATTRIBS || h->vertex_stride == 0
+        || (h->index_size != 2 && h->index_size != 4) || h->index_count % 3 != 0)
+        return "bad layout";
+    const bool split = h->version >= 4 && h->attribute_stride;
+    for (uint32_t i = 0; h->version >= 4 && i < h->attrib_count; ++i)
+        if (h->attribs[i].stream > (split ? 1 : 0))
+            return "bad layout";
+    if (split && (h->attribute_offset % MESH_FILE_ALIGN
+        || h->attribute_offset < (uint64_t)h->vertex_count * h->vertex_stride))
+        return "bad layout";
+    const uint64_t vertex_bytes = mesh_file_vertex_bytes(h);
+    const uint64_t index_bytes = (uint64_t)h->index_count * h->index_size;
+    if (h->vertex_offset % MESH_FILE_ALIGN || h->index_offset % MESH_FILE_ALIGN
+        || h->vertex_offset > size || vertex_bytes > size - h->vertex_offset
+        || h->index_offset > size || index_bytes > size - h->index_offset)
+        return "blobs out of bounds";
+    if (h->version >= 2)
+    {
+        if (h->lod_count == 0 || h->lod_count > MESH_FILE_MAX_LODS)
+            return "bad level count";
+        for (uint32_t l = 0; l < h->lod_count; ++l)
+        {
+            const MeshFileLod* lod = &h->lods[l];
+            if (lod->index_count == 0 || lod->index_count % 3 != 0 || lod->first_index > h->index_count
+                || lod->index_count > h->index_count - lod->first_index || (l == 0 && lod->first_index != 0))
+                return "level out of bounds";
+        }
+    }
+    if (h->version >= 3 && h->meshlet_count)
+    {
+        const uint64_t meshlet_bytes = (uint64_t)h->meshlet_count * sizeof(Meshlet);
+        if (h->meshlet_offset % MESH_FILE_ALIGN || h->meshlet_offset > size || meshlet_bytes > size - h->meshlet_offset)
+            return "meshlets out of bounds";
+    }
+    return NULL;
+}
+
+// Each meshlet's triangles lie inside level 0
+static const char* validate_meshlets(const MeshFile* mesh)
+{
+    const uint64_t level0 = mesh->lods[0].index_count;
+    for (uint32_t m = 0; m < mesh->meshlet_count; ++m)
+    {
+        const Meshlet* meshlet = &mesh->meshlets[m];
+        if (meshlet->first_index > level0 || 3 * (uint64_t)meshlet->triangle_count > level0 - meshlet->first_index)
+            return "meshlet out of bounds";
+    }
+    return NULL;
+}
+
+bool mesh_file_open(MeshFile* mesh, const char* path)
+{
+    MappedFile file;
+    return mapped_file_open(&file, path) && mesh_file_open_mapped(mesh, &file, path);
+}
+
+bool mesh_file_open_mapped(MeshFile* mesh, MappedFile* file, const char* path)
+{
+    memset(mesh, 0, sizeof(*mesh));
+    mesh->file = *file;
+    memset(file, 0, sizeof(*file));
+
+    const MeshFileHeader* h = (const MeshFileHeader*)mesh->file.data;
+    const char* error = validate_header(h, mesh->file.size);
+    if (error)
+    {
+        fprintf(stderr, "mesh_file: %s: %s\n", path, error);
+        mesh_file_close(mesh);
+        return false;
+    }
+
+    mesh->header = h;
+    mesh->vertices = (const unsigned char*)mesh->file.data + h->vertex_offset;
+    mesh->indices = (const unsigned char*)mesh->file.data + h->index_offset;
+    if (h->version >= 2)
+    {
+        mesh->lod_count = h->lod_count;
+        memcpy(mesh->lods, h->lods, sizeof(MeshFileLod) * h->lod_count);
+    }
+    else
+    {
+        mesh->lod_count = 1;
+        mesh->lods[0].index_count = h->index_count;
+    }
+    if (h->version >= 3 && h->meshlet_count)
+    {
+        mesh->meshlets = (const Meshlet*)((const unsigned char*)mesh->file.data + h->meshlet_offset);
+        mesh->meshlet_count = h->meshlet_count;
+        error = validate_meshlets(mesh);
+        if (error)
+        {
+            fprintf(stderr, "mesh_file: %s: %s\n", path, error);
+            mesh_file_close(mesh);
+            return false;
+        }
+    }
+    return true;
+}
+
+void mesh_file_close(MeshFile* mesh)
+{
+    mapped_file_close(&mesh->file);
+    memset(mesh, 0, sizeof(*mesh));
+}
+
+static bool write_padded(FILE* f, const void* data, uint64_t size, uint64_t padding)
+{
+    static const unsigned char zeros[MESH_FILE_ALIGN] = {};
+    return fwrite(data, 1, size, f) == size && fwrite(zeros, 1, padding, f) == padding;
+}
+
+bool mesh_file_write(const char* path, const MeshFileAttrib* attribs, int attrib_count, uint32_t vertex_stride,
+    const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count)
+{
+    MeshFileLod lod = { 0, index_count, 0.f, 0 };
+    return mesh_file_write_lods(path, attribs, attrib_count, vertex_stride, vertices, vertex_count, indices, index_count,
+        &lod, 1);
+}
+
+bool mesh_file_write_lods(const char* path, const MeshFileAttrib* attribs, int attrib_count, uint32_t vertex_stride,
+    const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, const MeshFileLod* lods,
+    int lod_count)
+{
+    return mesh_file_write_meshlets(path, attribs, attrib_count, vertex_stride, vertices, vertex_count, indices,
+        index_count, lods, lod_count, NULL, 0);
+}
+
+bool mesh_file_write_meshlets(const char* path, const MeshFileAttrib* attribs, int attrib_count,
+    uint32_t vertex_stride, const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count,
+    const MeshFileLod* lods, int lod_count, const Meshlet* meshlets, uint32_t meshlet_count)
+{
+    if (attrib_count < 1 || attrib_count > MESH_FILE_MAX_ATTRIBS)
+    {
+        fprintf(stderr, "mesh_file: %d attributes (1-%d supported)\n", attrib_count, MESH_FILE_MAX_ATTRIBS);
+        return false;
+    }
+    if (lod_count < 1 || lod_count > MESH_FILE_MAX_LODS)
+    {
+        fprintf(stderr, "mesh_file: %d levels of detail (1-%d supported)\n", lod_count, MESH_FILE_MAX_LODS);
+        return false;
+    }
+
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertex_count = vertex_count;
+    header.index_count = index_count;
+    header.vertex_stride = vertex_stride;
+    header.index_size = vertex_count <= 65536 ? 2 : 4;
+    header.attrib_count = (uint32_t)attrib_count;
+    memcpy(header.attribs, attribs, sizeof(MeshFileAttrib) * attrib_count);
+    header.lod_count = (uint32_t)lod_count;
+    memcpy(header.lods, lods, sizeof(MeshFileLod) * lod_count);
+    for (int i = 0; i < attrib_count; ++i)
+    {
+        // The attribute stream's stride is where its last attribute ends, as vertex_pack_split lays it out
+        const MeshFileAttrib* a = &attribs[i];
+        const uint32_t end = a->offset + (uint32_t)vertex_attrib_size((VertexAttribType)a->type) * a->components;
+        if (a->stream == 1 && ((end + 3) & ~3u) > header.attribute_stride)
+            header.attribute_stride = (end + 3) & ~3u;
+    }
+    if (header.attribute_stride)
+        header.attribute_offset = vertex_pack_attribute_offset(vertex_stride, vertex_count);
+    const uint64_t vertex_bytes = mesh_file_vertex_bytes(&header);
+    const uint64_t index_bytes = (uint64_t)index_count * header.index_size;
+    header.vertex_offset = align_up(sizeof(header));
+    header.index_offset = align_up(header.vertex_offset + vertex_bytes);
+    header.meshlet_count = meshlets ? meshlet_count : 0;
+    header.meshlet_offset = align_up(header.index_offset + index_bytes);
+    const uint64_t meshlet_bytes = (uint64_t)header.meshlet_count * sizeof(Meshlet);
+
+    // Narrow indices up front so the file holds exactly what the element buffer gets
+    const void* index_data = indices;
+    uint16_t* narrow = NULL;
+    if (header.index_size == 2)
+    {
+        narrow = (uint16_t*)malloc(sizeof(uint16_t) * (index_count ? index_count : 1));
+        if (!narrow)
+        {
+            fprintf(stderr, "mesh_file: out of memory for %u indices\n", index_count);
+            return false;
+        }
+        for (uint32_t i = 0; i < index_count; ++i)
+            narrow[i] = (uint16_t)indices[i];
+        index_data = narrow;
+    }
+
+    char temp[1024];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE* f = fopen(temp, "wb");
+    bool ok = f != NULL;
+    if (f)
+    {
+        ok = write_padded(f, &header, sizeof(header), header.vertex_offset - sizeof(header))
+            && write_padded(f, vertices, vertex_bytes, header.index_offset - header.vertex_offset - vertex_bytes)
+            && write_padded(f, index_data, index_bytes, header.meshlet_offset - header.index_offset - index_bytes)
+            && (!meshlet_bytes || write_padded(f, meshlets, meshlet_bytes, 0));
+        ok = fclose(f) == 0 && ok;
+
+        std::error_code ec;
+        if (ok)
+            std::filesystem::rename(temp, path, ec);
+        if (!ok || ec)
+        {
+            std::filesystem::remove(temp, ec);
+            ok = false;
+        }
+    }
+    if (!ok)
+        fprintf(stderr, "mesh_file: can't write %s\n", path);
+    free(narrow);
+    return ok;
+}
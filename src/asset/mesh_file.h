@@ -0,0 +1,123 @@
+#pragma once
+
+#include "asset/meshlet.h"
+#include "core/mapped_file.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary mesh container, laid out so it can be used straight from a memory
+// mapping: fixed header, vertex layout descriptor, then the vertex and index
+// blobs at MESH_FILE_ALIGN-aligned offsets, already in their GPU formats
+// (packed attributes, 16- or 32-bit indices). Loading is mapping the file and
+// validating the header - there is no parsing and no copy before the buffers
+// are filled from the mapping. Fields are little-endian, as written by the
+// host.
+//
+// Attribute types are VertexAttribType values (asset/vertex_pack.h); this
+// module stays GL-free so tools can write meshes without a context.
+//
+// Version 2 adds levels of detail: ranges of the one index blob, finest
+// first, all over the same vertices (asset/mesh_simplify.h makes them),
+// each with the distance its surface may be from level 0's. Version 1 files
+// still open, as a single level.
+//
+// Version 3 adds meshlets (asset/meshlet.h): when a cooker has split level 0
+// into them, its indices are in meshlet order and the Meshlet records follow
+// the indices, so the runtime culls them without splitting at load. Version
+// 2 files open without meshlets.
+//
+// Version 4 adds split vertex streams: an attribute's "stream" is 0 for the
+// position stream (every attribute of an interleaved mesh) or 1 for the
+// attribute stream, laid out on its own with "attribute_stride" and starting
+// "attribute_offset" bytes into the vertex blob (asset/vertex_pack.h's
+// vertex_pack_split makes the layout). Passes that only need positions then
+// fetch the position stream and nothing else. Earlier versions are
+// interleaved.
+
+#define MESH_FILE_MAGIC 0x4D54474Fu       // "OGTM"
+#define MESH_FILE_VERSION 4
+#define MESH_FILE_MAX_ATTRIBS 8
+#define MESH_FILE_MAX_LODS 8
+#define MESH_FILE_ALIGN 64
+
+typedef struct MeshFileAttrib
+{
+    uint8_t location;
+    uint8_t components;
+    uint8_t type;               // VertexAttribType
+    uint8_t stream;             // 0: the position stream (or the only one), 1: the attribute stream; 0 before version 4
+    uint32_t offset;            // bytes into its stream's vertex
+} MeshFileAttrib;
+
+typedef struct MeshFileLod
+{
+    uint32_t first_index;       // into the index blob
+    uint32_t index_count;
+    float error;                // in model units, 0 for level 0
+    uint32_t reserved;
+} MeshFileLod;
+
+typedef struct MeshFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t vertex_stride;     // the position stream's, when split
+    uint32_t index_size;        // 2 or 4 bytes
+    uint32_t attrib_count;
+    uint32_t lod_count;         // version 2; reserved (0) in version 1
+    uint64_t vertex_offset;     // from the start of the file, MESH_FILE_ALIGN aligned
+    uint64_t index_offset;
+    MeshFileAttrib attribs[MESH_FILE_MAX_ATTRIBS];
+    MeshFileLod lods[MESH_FILE_MAX_LODS];   // version 2 on: a version 1 header ends before them
+    uint32_t meshlet_count;     // version 3 on, 0 for none: a version 2 header ends before it
+    uint32_t reserved;
+    uint64_t meshlet_offset;    // MESH_FILE_ALIGN aligned
+    uint32_t attribute_stride;  // version 4 on, 0 for interleaved vertices: a version 3 header ends before it
+    uint32_t reserved2;
+    uint64_t attribute_offset;  // into the vertex blob, MESH_FILE_ALIGN aligned; 0 for interleaved vertices
+} MeshFileHeader;
+
+// An open mesh: "header", "vertices", "indices" and "meshlets" point into the mapping. The levels are copied
+// out, so they're there whatever the version (read them here, not from the header).
+typedef struct MeshFile
+{
+    MappedFile file;
+    const MeshFileHeader* header;
+    const void* vertices;
+    const void* indices;
+    uint32_t lod_count;
+    MeshFileLod lods[MESH_FILE_MAX_LODS];
+    const Meshlet* meshlets;    // level 0's, in index order; NULL without
+    uint32_t meshlet_count;
+} MeshFile;
+
+// Maps and validates "path" (magic, version, blob, level and meshlet bounds). Logs and returns false on failure.
+bool mesh_file_open(MeshFile* mesh, const char* path);
+// The same over a file already mapped (or read out of a package), which "mesh" takes over - and closes, on failure.
+// "path" only names it in messages.
+bool mesh_file_open_mapped(MeshFile* mesh, MappedFile* file, const char* path);
+void mesh_file_close(MeshFile* mesh);
+
+// Bytes of the vertex blob: both streams, when split
+uint64_t mesh_file_vertex_bytes(const MeshFileHeader* header);
+
+// Writes a mesh whose vertices are already packed ("vertex_stride" bytes each, laid out as "attribs").
+// Indices are stored as 16 bits when every vertex fits. Written to a temporary name and renamed into place.
+// When "attribs" put any attribute in stream 1, "vertices" holds both streams as vertex_pack_streams packs them.
+bool mesh_file_write(const char* path, const MeshFileAttrib* attribs, int attrib_count, uint32_t vertex_stride,
+    const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count);
+
+// The same with "lod_count" levels (1 to MESH_FILE_MAX_LODS) over "indices", which holds them all; level 0 must
+// start it.
+bool mesh_file_write_lods(const char* path, const MeshFileAttrib* attribs, int attrib_count, uint32_t vertex_stride,
+    const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, const MeshFileLod* lods,
+    int lod_count);
+
+// The same with level 0 split into "meshlet_count" meshlets, whose ranges its indices are already ordered by
+// (meshlet_build's output)
+bool mesh_file_write_meshlets(const char* path, const MeshFileAttrib* attribs, int attrib_count,
+    uint32_t vertex_stride, const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count,
+    const MeshFileLod* lods, int lod_count, const Meshlet* meshlets, uint32_t meshlet_count);
@@ -0,0 +1,522 @@
+#include "asset/mesh_optimize.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Triangles touching each vertex, as one flat array indexed through offsets (CSR)
+typedef struct TriangleAdjacency
+{
+    uint32_t* counts;       // [vertex_count] triangles per vertex
+    uint32_t* offsets;      // [vertex_count] first entry in "triangles"
+    uint32_t* triangles;    // [index_count]
+} TriangleAdjacency;
+
+static bool adjacency_build(TriangleAdjacency* adj, const uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+    adj->counts = (uint32_t*)calloc(vertex_count, sizeof(uint32_t));
+    adj->offsets = (uint32_t*)malloc(vertex_count * sizeof(uint32_t));
+    adj->triangles = (uint32_t*)malloc(index_count * sizeof(uint32_t));
+    if (!adj->counts || !adj->offsets || !adj->triangles)
+        return false;
+
+    for (size_t i = 0; i < index_count; ++i)
+        ++adj->counts[indices[i]];
+    uint32_t offset = 0;
+    for (size_t v = 0; v < vertex_count; ++v)
+    {
+        adj->offsets[v] = offset;
+        offset += adj->counts[v];
+    }
+    for (size_t i = 0; i < index_count; ++i)
+        adj->triangles[adj->offsets[indices[i]]++] = (uint32_t)(i / 3);
+    // offsets were advanced while filling; rewind them
+    for (size_t v = 0; v < vertex_count; ++v)
+        adj->offsets[v] -= adj->counts[v];
+    return true;
+}
+
+static void adjacency_free(TriangleAdjacency* adj)
+{
+    free(adj->counts);
+    free(adj->offsets);
+    free(adj->triangles);
+}
+
+// --- Forsyth, "Linear-Speed Vertex Cache Optimisation" (2006) ---
+
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_MAX_VALENCE 64      // valence scores above this are computed, not looked up
+
+static float forsyth_cache_score[FORSYTH_CACHE_SIZE];
+static float forsyth_valence_score[FORSYTH_MAX_VALENCE];
+
+static void forsyth_init_tables()
+{
+    for (int i = 0; i < FORSYTH_CACHE_SIZE; ++i)
+    {
+        // Used by the last triangle: fixed score so the 3 don't compete for the next one
+        if (i < 3)
+            forsyth_cache_score[i] = 0.75f;
+        else
+            forsyth_cache_score[i] = powf(1.f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+    forsyth_valence_score[0] = 0.f;
+    for (int i = 1; i < FORSYTH_MAX_VALENCE; ++i)
+        forsyth_valence_score[i] = 2.f * powf((float)i, -0.5f);
+}
+
+static float forsyth_score(int cache_position, uint32_t live_triangles)
+{
+    if (live_triangles == 0)
+        return -1.f;    // nothing left to draw with it
+
+    const float score = cache_position >= 0 ? forsyth_cache_score[cache_position] : 0.f;
+    // Favour vertices with few triangles left, so they are finished off instead of left behind
+    return score + (live_triangles < FORSYTH_MAX_VALENCE ? forsyth_valence_score[live_triangles]
+        : 2.f * powf((float)live_triangles, -0.5f));
+}
+
+bool mesh_optimize_vertex_cache(uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count == 0)
+        return true;
+    forsyth_init_tables();
+
+    TriangleAdjacency adj;
+    uint32_t* live = (uint32_t*)malloc(vertex_count * sizeof(uint32_t));
+    int* cache_position = (int*)malloc(vertex_count * sizeof(int));
+    float* vertex_score = (float*)malloc(vertex_count * sizeof(float));
+    float* triangle_score = (float*)malloc(triangle_count * sizeof(float));
+    bool* emitted = (bool*)calloc(triangle_count, sizeof(bool));
+    uint32_t* output = (uint32_t*)malloc(index_count * sizeof(uint32_t));
+    bool ok = adjacency_build(&adj, indices, index_count, vertex_count) &&
+        live && cache_position && vertex_score && triangle_score && emitted && output;
+
+    if (ok)
+    {
+        for (size_t v = 0; v < vertex_count; ++v)
+        {
+            live[v] = adj.counts[v];
+            cache_position[v] = -1;
+            vertex_score[v] = forsyth_score(-1, live[v]);
+        }
+        for (size_t t = 0; t < triangle_count; ++t)
+        {
+            triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] +
+                vertex_score[indices[t * 3 + 2]];
+        }
+
+        // LRU cache model, with 3 spare slots for the vertices pushed out by each new triangle
+        uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+        int cache_count = 0;
+        size_t scan = 0;        // cursor for the fallback search when the cache has no candidates
+        long best = -1;
+
+        for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count)
+        {
+            if (best < 0)
+            {
+                // No cached candidate: continue with the next unemitted triangle in input order. Searching all
+                // of them for the best score (as the paper does) makes shuffled inputs quadratic and barely
+                // changes the result.
+                while (emitted[scan])
+                    ++scan;
+                best = (long)scan;
+            }
+
+            const uint32_t* tri = &indices[best * 3];
+            output[emitted_count * 3] = tri[0];
+            output[emitted_count * 3 + 1] = tri[1];
+            output[emitted_count * 3 + 2] = tri[2];
+            emitted[best] = true;
+
+            // Move the triangle's vertices to the front of the cache
+            uint32_t next_cache[FORSYTH_CACHE_SIZE + 3];
+            int next_count = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                next_cache[next_count++] = tri[k];
+                --live[tri[k]];
+            }
+            for (int c = 0; c < cache_count; ++c)
+            {
+                const uint32_t v = cache[c];
+                if (v != tri[0] && v != tri[1] && v != tri[2])
+                    next_cache[next_count++] = v;
+            }
+
+            // Rescore everything that moved (including what fell out), then pick the best cached triangle
+            best = -1;
+            float best_score = -1.f;
+            for (int c = 0; c < next_count; ++c)
+            {
+                const uint32_t v = next_cache[c];
+                cache_position[v] = c < FORSYTH_CACHE_SIZE ? c : -1;
+                const float score = forsyth_score(cache_position[v], live[v]);
+                const float delta = score - vertex_score[v];
+                vertex_score[v] = score;
+                const uint32_t* tris = &adj.triangles[adj.offsets[v]];
+                for (uint32_t i = 0; i < adj.counts[v]; ++i)
+                {
+                    const uint32_t t = tris[i];
+                    if (emitted[t])
+                        continue;
+                    triangle_score[t] += delta;
+                    if (c < FORSYTH_CACHE_SIZE && triangle_score[t] > best_score)
+                    {
+                        best_score = triangle_score[t];
+                        best = (long)t;
+                    }
+                }
+            }
+            cache_count = next_count < FORSYTH_CACHE_SIZE ? next_count : FORSYTH_CACHE_SIZE;
+            memcpy(cache, next_cache, cache_count * sizeof(uint32_t));
+        }
+        memcpy(indices, output, triangle_count * 3 * sizeof(uint32_t));
+    }
+
+    adjacency_free(&adj);
+    free(live);
+    free(cache_position);
+    free(vertex_score);
+    free(triangle_score);
+    free(emitted);
+    free(output);
+    return ok;
+}
+
+// --- Tipsify, Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007) ---
+
+// Next fanning vertex: the candidate still in cache with the most remaining work that stays in cache, else a
+// dead-end vertex with live triangles, else the next live vertex in input order
+static long tipsify_next_vertex(const uint32_t* candidates, size_t candidate_count, const uint32_t* live,
+    const uint32_t* timestamp, uint32_t time, unsigned int cache_size, uint32_t* dead_end, size_t* dead_end_count,
+    const uint32_t* indices, size_t index_count, size_t* cursor)
+{
+    long best = -1;
+    long best_priority = -1;
+    for (size_t i = 0; i < candidate_count; ++i)
+    {
+        const uint32_t v = candidates[i];
+        if (live[v] == 0)
+            continue;
+        long priority = 0;
+        // Fanning v emits up to 2 new vertices per live triangle; only worth it if they'll still find v cached
+        if ((long)(time - timestamp[v]) + 2 * (long)live[v] <= (long)cache_size)
+            priority = (long)(time - timestamp[v]);
+        if (priority > best_priority)
+        {
+            best_priority = priority;
+            best = (long)v;
+        }
+    }
+    if (best >= 0)
+        return best;
+
+    while (*dead_end_count > 0)
+    {
+        const uint32_t v = dead_end[--*dead_end_count];
+        if (live[v] > 0)
+            return (long)v;
+    }
+    while (*cursor < index_count)
+    {
+        const uint32_t v = indices[(*cursor)++];
+        if (live[v] > 0)
+            return (long)v;
+    }
+    return -1;
+}
+
+bool mesh_optimize_vertex_cache_tipsify(uint32_t* indices, size_t index_count, size_t vertex_count, unsigned int cache_size)
+{
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count == 0)
+        return true;
+
+    TriangleAdjacency adj;
+    uint32_t* live = (uint32_t*)malloc(vertex_count * sizeof(uint32_t));
+    uint32_t* timestamp = (uint32_t*)calloc(vertex_count, sizeof(uint32_t));
+    uint32_t* dead_end = (uint32_t*)malloc(index_count * sizeof(uint32_t));
+    uint32_t* candidates = (uint32_t*)malloc(index_count * sizeof(uint32_t));
+    bool* emitted = (bool*)calloc(triangle_count, sizeof(bool));
+    uint32_t* output = (uint32_t*)malloc(index_count * sizeof(uint32_t));
+    bool ok = adjacency_build(&adj, indices, index_count, vertex_count) &&
+        live && timestamp && dead_end && candidates && emitted && output;
+
+    if (ok)
+    {
+        memcpy(live, adj.counts, vertex_count * sizeof(uint32_t));
+        uint32_t time = cache_size + 1;
+        size_t dead_end_count = 0;
+        size_t cursor = 0;
+        size_t out = 0;
+        long fan = indices[0];
+
+        while (fan >= 0)
+        {
+            // Emit every remaining triangle around the fanning vertex
+            size_t candidate_count = 0;
+            const uint32_t* tris = &adj.triangles[adj.offsets[fan]];
+            for (uint32_t i = 0; i < adj.counts[fan]; ++i)
+            {
+                const uint32_t t = tris[i];
+                if (emitted[t])
+                    continue;
+                emitted[t] = true;
+                for (int k = 0; k < 3; ++k)
+                {
+                    const uint32_t v = indices[t * 3 + k];
+                    output[out++] = v;
+                    dead_end[dead_end_count++] = v;
+                    candidates[candidate_count++] = v;
+                    --live[v];
+                    if (time - timestamp[v] > cache_size)
+                        timestamp[v] = time++;      // cache miss: v enters the FIFO now
+                }
+            }
+            fan = tipsify_next_vertex(candidates, candidate_count, live, timestamp, time, cache_size,
+                dead_end, &dead_end_count, indices, index_count, &cursor);
+        }
+        memcpy(indices, output, triangle_count * 3 * sizeof(uint32_t));
+    }
+
+    adjacency_free(&adj);
+    free(live);
+    free(timestamp);
+    free(dead_end);
+    free(candidates);
+    free(emitted);
+    free(output);
+    return ok;
+}
+
+// --- Overdraw ordering (the cluster sort of the same paper) ---
+
+typedef struct OverdrawCluster
+{
+    size_t first;       // first triangle
+    size_t count;       // triangles
+    float sort_key;
+} OverdrawCluster;
+
+static int compare_clusters(const void* a, const void* b)
+{
+    const float ka = ((const OverdrawCluster*)a)->sort_key;
+    const float kb = ((const OverdrawCluster*)b)->sort_key;
+    return ka > kb ? -1 : ka < kb ? 1 : 0;
+}
+
+static const float* vertex_position(const float* positions, size_t stride, uint32_t v)
+{
+    return (const float*)((const unsigned char*)positions + stride * v);
+}
+
+bool mesh_optimize_overdraw(uint32_t* indices, size_t index_count, const float* positions, size_t stride,
+    size_t vertex_count, float threshold)
+{
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count < 2)
+        return true;
+
+    const unsigned int cache_size = 16;
+    uint32_t* timestamp = (uint32_t*)calloc(vertex_count, sizeof(uint32_t));
+    OverdrawCluster* clusters = (OverdrawCluster*)malloc(triangle_count * sizeof(OverdrawCluster));
+    uint32_t* output = (uint32_t*)malloc(index_count * sizeof(uint32_t));
+    if (!timestamp || !clusters || !output)
+    {
+        free(timestamp);
+        free(clusters);
+        free(output);
+        return false;
+    }
+
+    const MeshCacheStats mesh_stats = mesh_analyze_vertex_cache(indices, index_count, vertex_count, cache_size);
+    const float split_acmr = mesh_stats.acmr * threshold;
+
+    // Hard boundaries where a triangle misses all three vertices (the cache was effectively flushed anyway)
+    bool* hard = (bool*)calloc(triangle_count, sizeof(bool));
+    if (!hard)
+    {
+        free(timestamp);
+        free(clusters);
+        free(output);
+        return false;
+    }
+    uint32_t time = cache_size + 1;
+    for (size_t t = 0; t < triangle_count; ++t)
+    {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            if (time - timestamp[v] > cache_size)
+            {
+                timestamp[v] = time++;
+                ++misses;
+            }
+        }
+        hard[t] = misses == 3;
+    }
+
+    // Soft boundaries inside those: once a cluster drawn from a cold cache (as it will be after sorting) stays
+    // under the threshold ACMR, it can stand on its own
+    size_t cluster_count = 0;
+    unsigned int cluster_misses = 0;
+    for (size_t t = 0; t < triangle_count; ++t)
+    {
+        OverdrawCluster* current = cluster_count ? &clusters[cluster_count - 1] : NULL;
+        const bool soft = current && current->count >= cache_size && (float)cluster_misses / current->count <= split_acmr;
+        if (!current || hard[t] || soft)
+        {
+            clusters[cluster_count].first = t;
+            clusters[cluster_count].count = 0;
+            ++cluster_count;
+            cluster_misses = 0;
+            time += cache_size + 1;     // flush
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            if (time - timestamp[v] > cache_size)
+            {
+                timestamp[v] = time++;
+                ++cluster_misses;
+            }
+        }
+        ++clusters[cluster_count - 1].count;
+    }
+    free(hard);
+
+    // Mesh centroid (area weighted)
+    double mesh_center[3] = { 0.0, 0.0, 0.0 };
+    double mesh_area = 0.0;
+    for (size_t t = 0; t < triangle_count; ++t)
+    {
+        const float* a = vertex_position(positions, stride, indices[t * 3]);
+        const float* b = vertex_position(positions, stride, indices[t * 3 + 1]);
+        const float* c = vertex_position(positions, stride, indices[t * 3 + 2]);
+        const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        const double area = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+        for (int k = 0; k < 3; ++k)
+            mesh_center[k] += area * (a[k] + b[k] + c[k]) / 3.0;
+        mesh_area += area;
+    }
+    if (mesh_area > 0.0)
+    {
+        for (int k = 0; k < 3; ++k)
+            mesh_center[k] /= mesh_area;
+    }
+
+    // Sort key: how much the cluster faces away from the mesh center. Those clusters tend to occlude the rest
+    // from most view directions, so drawing them first lets early-Z reject more.
+    for (size_t i = 0; i < cluster_count; ++i)
+    {
+        OverdrawCluster* cluster = &clusters[i];
+        double center[3] = { 0.0, 0.0, 0.0 };
+        double normal[3] = { 0.0, 0.0, 0.0 };
+        double area_sum = 0.0;
+        for (size_t t = cluster->first; t < cluster->first + cluster->count; ++t)
+        {
+            const float* a = vertex_position(positions, stride, indices[t * 3]);
+            const float* b = vertex_position(positions, stride, indices[t * 3 + 1]);
+            const float* c = vertex_position(positions, stride, indices[t * 3 + 2]);
+            const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const double area = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+            for (int k = 0; k < 3; ++k)
+            {
+                center[k] += area * (a[k] + b[k] + c[k]) / 3.0;
+                normal[k] += n[k];  // area-weighted already (|n| = 2 * area)
+            }
+            area_sum += area;
+        }
+        const double normal_len = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        double key = 0.0;
+        if (area_sum > 0.0 && normal_len > 0.0)
+        {
+            for (int k = 0; k < 3; ++k)
+                key += (center[k] / area_sum - mesh_center[k]) * normal[k] / normal_len;
+        }
+        cluster->sort_key = (float)key;
+    }
+
+    qsort(clusters, cluster_count, sizeof(OverdrawCluster), compare_clusters);
+
+    size_t out = 0;
+    for (size_t i = 0; i < cluster_count; ++i)
+    {
+        memcpy(&output[out], &indices[clusters[i].first * 3], clusters[i].count * 3 * sizeof(uint32_t));
+        out += clusters[i].count * 3;
+    }
+    memcpy(indices, output, out * sizeof(uint32_t));
+
+    free(timestamp);
+    free(clusters);
+    free(output);
+    return true;
+}
+
+size_t mesh_optimize_vertex_fetch(void* vertices, uint32_t* indices, size_t index_count, size_t vertex_count, size_t vertex_size)
+{
+    uint32_t* remap = (uint32_t*)malloc(vertex_count * sizeof(uint32_t));
+    unsigned char* reordered = (unsigned char*)malloc(vertex_count * vertex_size);
+    if (!remap || !reordered)
+    {
+        free(remap);
+        free(reordered);
+        return 0;
+    }
+    memset(remap, 0xFF, vertex_count * sizeof(uint32_t));
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < index_count; ++i)
+    {
+        const uint32_t v = indices[i];
+        if (remap[v] == UINT32_MAX)
+        {
+            memcpy(reordered + (size_t)next * vertex_size, (const unsigned char*)vertices + (size_t)v * vertex_size, vertex_size);
+            remap[v] = next++;
+        }
+        indices[i] = remap[v];
+    }
+    memcpy(vertices, reordered, (size_t)next * vertex_size);
+
+    free(remap);
+    free(reordered);
+    return next;
+}
+
+MeshCacheStats mesh_analyze_vertex_cache(const uint32_t* indices, size_t index_count, size_t vertex_count, unsigned int cache_size)
+{
+    MeshCacheStats stats = { 0, 0.f, 0.f };
+    uint32_t* timestamp = (uint32_t*)calloc(vertex_count, sizeof(uint32_t));
+    if (!timestamp)
+        return stats;
+
+    uint32_t time = cache_size + 1;
+    size_t used_vertices = 0;
+    for (size_t i = 0; i < index_count; ++i)
+    {
+        const uint32_t v = indices[i];
+        if (timestamp[v] == 0)
+            ++used_vertices;
+        if (time - timestamp[v] > cache_size)
+        {
+            timestamp[v] = time++;
+            ++stats.misses;
+        }
+    }
+    if (index_count >= 3)
+        stats.acmr = (float)stats.misses / (float)(index_count / 3);
+    if (used_vertices)
+        stats.atvr = (float)stats.misses / (float)used_vertices;
+
+    free(timestamp);
+    return stats;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Load-time index and vertex reordering for indexed triangle lists.
+//
+// mesh_optimize_vertex_cache reorders triangles so consecutive ones share
+// vertices still in the post-transform cache (Forsyth's linear-speed
+// algorithm; works well for any cache size). mesh_optimize_vertex_cache_tipsify
+// does the same with Tipsify (Sander, Nehab, Barczak 2007), which targets a
+// given FIFO size and leaves the triangle order in locality clusters that
+// mesh_optimize_overdraw can then sort front-to-back-ish for less overdraw.
+// mesh_optimize_vertex_fetch finally renumbers vertices in first-use order so
+// vertex fetches walk memory linearly.
+//
+// All functions work in place on 32-bit indices; they return false only when
+// out of memory (leaving the input untouched).
+
+// Forsyth ordering
+bool mesh_optimize_vertex_cache(uint32_t* indices, size_t index_count, size_t vertex_count);
+
+// Tipsify ordering for a FIFO cache of "cache_size" entries (16-32 on current GPUs)
+bool mesh_optimize_vertex_cache_tipsify(uint32_t* indices, size_t index_count, size_t vertex_count, unsigned int cache_size);
+
+// Reorders clusters of a cache-optimized list so outward-facing ones are drawn first. "positions" are 3 floats
+// at "stride" bytes apart. Clusters are split wherever the cache would flush, then further while their ACMR
+// stays below "threshold" times the mesh's (1.05 is typical: trades up to 5% more vertex work for the sort).
+bool mesh_optimize_overdraw(uint32_t* indices, size_t index_count, const float* positions, size_t stride,
+    size_t vertex_count, float threshold);
+
+// Renumbers vertices in first-use order. "vertices" are vertex_count records of "vertex_size" bytes; unused
+// vertices are dropped. Returns the new vertex count (0 on failure).
+size_t mesh_optimize_vertex_fetch(void* vertices, uint32_t* indices, size_t index_count, size_t vertex_count, size_t vertex_size);
+
+typedef struct MeshCacheStats
+{
+    unsigned int misses;    // vertex shader invocations
+    float acmr;             // average cache miss ratio: misses per triangle (0.5 ideal for big grids, 3 worst)
+    float atvr;             // average transformed vertex ratio: misses per vertex (1.0 ideal)
+} MeshCacheStats;
+
+// Simulates a FIFO post-transform cache of "cache_size" entries over the index list
+MeshCacheStats mesh_analyze_vertex_cache(const uint32_t* indices, size_t index_count, size_t vertex_count, unsigned int cache_size);
@@ -0,0 +1,347 @@
+#include "asset/mesh_simplify.h"
+
+#include "asset/mesh_optimize.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BORDER_WEIGHT 10.0          // border planes against area-weighted triangle planes: outlines matter more
+#define MAX_NORMAL_TURN 0.5         // cosine: a collapse may turn a surviving triangle by up to 60 degrees
+#define MIN_ASPECT 0.02             // nor leave one thinner than this, height over longest edge
+
+// Sum of weighted squared distances to a set of planes ax + by + cz + d = 0, as the upper half of the symmetric
+// 4x4 matrix, plus the total weight it's normalised by
+typedef struct Quadric
+{
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+    double weight;
+} Quadric;
+
+typedef struct Collapse
+{
+    uint32_t from;              // removed: its triangles move onto "to"
+    uint32_t to;
+    double cost;
+} Collapse;
+
+// Triangles touching each vertex, as one flat array indexed through offsets
+typedef struct VertexTriangles
+{
+    uint32_t* offsets;          // [vertex_count + 1]
+    uint32_t* triangles;        // [index_count]
+} VertexTriangles;
+
+static const float* vertex_position(const float* positions, size_t stride, uint32_t v)
+{
+    return (const float*)((const unsigned char*)positions + stride * v);
+}
+
+static void cross3(double r[3], const float* o, const float* a, const float* b)
+{
+    const double u[3] = { (double)a[0] - o[0], (double)a[1] - o[1], (double)a[2] - o[2] };
+    const double v[3] = { (double)b[0] - o[0], (double)b[1] - o[1], (double)b[2] - o[2] };
+    r[0] = u[1] * v[2] - u[2] * v[1];
+    r[1] = u[2] * v[0] - u[0] * v[2];
+    r[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+static void quadric_add_plane(Quadric* q, const double n[3], double d, double weight)
+{
+    q->a2 += weight * n[0] * n[0];
+    q->ab += weight * n[0] * n[1];
+    q->ac += weight * n[0] * n[2];
+    q->ad += weight * n[0] * d;
+    q->b2 += weight * n[1] * n[1];
+    q->bc += weight * n[1] * n[2];
+    q->bd += weight * n[1] * d;
+    q->c2 += weight * n[2] * n[2];
+    q->cd += weight * n[2] * d;
+    q->d2 += weight * d * d;
+    q->weight += weight;
+}
+
+static void quadric_add(Quadric* q, const Quadric* r)
+{
+    q->a2 += r->a2;
+    q->ab += r->ab;
+    q->ac += r->ac;
+    q->ad += r->ad;
+    q->b2 += r->b2;
+    q->bc += r->bc;
+    q->bd += r->bd;
+    q->c2 += r->c2;
+    q->cd += r->cd;
+    q->d2 += r->d2;
+    q->weight += r->weight;
+}
+
+// Mean squared distance from the planes at "p"
+static double quadric_error(const Quadric* q, const float* p)
+{
+    const double x = p[0], y = p[1], z = p[2];
+    const double e = q->a2 * x * x + q->b2 * y * y + q->c2 * z * z
+        + 2.0 * (q->ab * x * y + q->ac * x * z + q->bc * y * z + q->ad * x + q->bd * y + q->cd * z) + q->d2;
+    return q->weight > 0.0 && e > 0.0 ? e / q->weight : 0.0;
+}
+
+static void vertex_triangles_build(VertexTriangles* vt, const uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+    memset(vt->offsets, 0, sizeof(uint32_t) * (vertex_count + 1));
+    for (size_t i = 0; i < index_count; ++i)
+        ++vt->offsets[indices[i] + 1];
+    for (size_t v = 0; v < vertex_count; ++v)
+        vt->offsets[v + 1] += vt->offsets[v];
+    for (size_t i = 0; i < index_count; ++i)
+        vt->triangles[vt->offsets[indices[i]]++] = (uint32_t)(i / 3);
+    // offsets were advanced to the next vertex's start while filling; shift them back
+    for (size_t v = vertex_count; v > 0; --v)
+        vt->offsets[v] = vt->offsets[v - 1];
+    vt->offsets[0] = 0;
+}
+
+// Whether some triangle around "a" has the directed edge a -> b
+static bool has_edge(const VertexTriangles* vt, const uint32_t* indices, uint32_t a, uint32_t b)
+{
+    for (uint32_t k = vt->offsets[a]; k < vt->offsets[a + 1]; ++k)
+    {
+        const uint32_t* t = indices + 3 * vt->triangles[k];
+        if ((t[0] == a && t[1] == b) || (t[1] == a && t[2] == b) || (t[2] == a && t[0] == b))
+            return true;
+    }
+    return false;
+}
+
+// An edge only one triangle uses (either way round)
+static bool is_border_edge(const VertexTriangles* vt, const uint32_t* indices, uint32_t a, uint32_t b)
+{
+    return has_edge(vt, indices, a, b) != has_edge(vt, indices, b, a);
+}
+
+// Whether moving "from" onto "to" keeps every surviving triangle around it facing the way it did. "shared" gets
+// the triangles that contain both, the ones the collapse removes.
+static bool collapse_keeps_orientation(const VertexTriangles* vt, const uint32_t* indices, const float* positions,
+    size_t stride, uint32_t from, uint32_t to, size_t* shared)
+{
+    *shared = 0;
+    const float* target = vertex_position(positions, stride, to);
+    for (uint32_t k = vt->offsets[from]; k < vt->offsets[from + 1]; ++k)
+    {
+        const uint32_t* t = indices + 3 * vt->triangles[k];
+        if (t[0] == to || t[1] == to || t[2] == to)
+        {
+            ++*shared;
+            continue;
+        }
+        const float* p[3];
+        const float* q[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            p[c] = vertex_position(positions, stride, t[c]);
+            q[c] = t[c] == from ? target : p[c];
+        }
+        double before[3], after[3];
+        cross3(before, p[0], p[1], p[2]);
+        cross3(after, q[0], q[1], q[2]);
+        const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        const double after_length = sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+        const double lengths = sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) * after_length;
+        if (!(dot > MAX_NORMAL_TURN * lengths))   // flipped, turned on edge or degenerate
+            return false;
+        // |cross| is twice the area, so over the longest edge squared it's twice its height over that edge
+        double longest = 0.0;
+        for (int c = 0; c < 3; ++c)
+        {
+            const float* a = q[c];
+            const float* b = q[(c + 1) % 3];
+            const double e = ((double)b[0] - a[0]) * (b[0] - a[0]) + ((double)b[1] - a[1]) * (b[1] - a[1])
+                + ((double)b[2] - a[2]) * (b[2] - a[2]);
+            longest = e > longest ? e : longest;
+        }
+        if (after_length < 2.0 * MIN_ASPECT * longest)
+            return false;
+    }
+    return true;
+}
+
+static int compare_collapses(const void* a, const void* b)
+{
+    const double ca = ((const Collapse*)a)->cost, cb = ((const Collapse*)b)->cost;
+    return ca < cb ? -1 : ca > cb ? 1 : 0;
+}
+
+size_t mesh_simplify(uint32_t* out, const uint32_t* indices, size_t index_count, const float* positions, size_t stride,
+    size_t vertex_count, size_t target_index_count, float max_error, float* error)
+{
+    Quadric* quadrics = (Quadric*)calloc(vertex_count ? vertex_count : 1, sizeof(Quadric));
+    uint32_t* remap = (uint32_t*)malloc(sizeof(uint32_t) * (vertex_count ? vertex_count : 1));
+    uint8_t* border = (uint8_t*)calloc(vertex_count ? vertex_count : 1, 1);
+    uint8_t* locked = (uint8_t*)malloc(vertex_count ? vertex_count : 1);
+    Collapse* collapses = (Collapse*)malloc(sizeof(Collapse) * 2 * (index_count ? index_count : 1));
+    uint32_t* work = (uint32_t*)malloc(sizeof(uint32_t) * (index_count ? index_count : 1));
+    VertexTriangles vt;
+    vt.offsets = (uint32_t*)malloc(sizeof(uint32_t) * (vertex_count + 1));
+    vt.triangles = (uint32_t*)malloc(sizeof(uint32_t) * (index_count ? index_count : 1));
+    size_t count = 0;
+    double worst = 0.0;
+    if (quadrics && remap && border && locked && collapses && work && vt.offsets && vt.triangles)
+    {
+        memcpy(work, indices, sizeof(uint32_t) * index_count);
+        count = index_count;
+        for (size_t v = 0; v < vertex_count; ++v)
+            remap[v] = (uint32_t)v;
+
+        // Every vertex starts out with the planes of its triangles, and border vertices with their edges' too
+        vertex_triangles_build(&vt, work, count, vertex_count);
+        for (size_t t = 0; t < count / 3; ++t)
+        {
+            const uint32_t* tri = work + 3 * t;
+            const float* p[3] = { vertex_position(positions, stride, tri[0]), vertex_position(positions, stride, tri[1]),
+                vertex_position(positions, stride, tri[2]) };
+            double n[3];
+            cross3(n, p[0], p[1], p[2]);
+            const double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length == 0.0)
+                continue;
+            n[0] /= length;
+            n[1] /= length;
+            n[2] /= length;
+            const double d = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+            for (int c = 0; c < 3; ++c)
+                quadric_add_plane(&quadrics[tri[c]], n, d, 0.5 * length);
+            for (int c = 0; c < 3; ++c)
+            {
+                const uint32_t a = tri[c], b = tri[(c + 1) % 3];
+                if (has_edge(&vt, work, b, a))
+                    continue;
+                border[a] = border[b] = 1;
+                const float* pa = p[c];
+                const float* pb = p[(c + 1) % 3];
+                const double e[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+                double m[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+                const double m_length = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+                if (m_length == 0.0)
+                    continue;
+                m[0] /= m_length;
+                m[1] /= m_length;
+                m[2] /= m_length;
+                const double md = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+                const double weight = BORDER_WEIGHT * (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+                quadric_add_plane(&quadrics[a], m, md, weight);
+                quadric_add_plane(&quadrics[b], m, md, weight);
+            }
+        }
+
+        // Passes of the cheapest collapses that don't touch each other, until the target or the error limit
+        const double limit = (double)max_error * max_error;
+        bool more = true;
+        while (more && count > target_index_count)
+        {
+            vertex_triangles_build(&vt, work, count, vertex_count);
+            size_t candidates = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const uint32_t a = work[i], b = work[i - i % 3 + (i + 1) % 3];
+                for (int dir = 0; dir < 2; ++dir)
+                {
+                    const uint32_t from = dir ? b : a, to = dir ? a : b;
+                    if (border[from] && !(border[to] && is_border_edge(&vt, work, from, to)))
+                        continue;   // border vertices only slide along the border
+                    Quadric q = quadrics[from];
+                    quadric_add(&q, &quadrics[to]);
+                    collapses[candidates++] = { from, to, quadric_error(&q, vertex_position(positions, stride, to)) };
+                }
+            }
+            qsort(collapses, candidates, sizeof(Collapse), compare_collapses);
+
+            memset(locked, 0, vertex_count);
+            size_t collapsed = 0;
+            size_t remaining = count;
+            more = false;
+            for (size_t c = 0; c < candidates && remaining > target_index_count; ++c)
+            {
+                const Collapse* collapse = &collapses[c];
+                if (collapse->cost > limit)
+                    break;
+                more = true;
+                if (locked[collapse->from] || locked[collapse->to])
+                    continue;
+                size_t shared = 0;
+                if (!collapse_keeps_orientation(&vt, work, positions, stride, collapse->from, collapse->to, &shared))
+                    continue;
+                quadric_add(&quadrics[collapse->to], &quadrics[collapse->from]);
+                remap[collapse->from] = collapse->to;
+                // Everything around it is now out of date until the next pass
+                for (uint32_t k = vt.offsets[collapse->from]; k < vt.offsets[collapse->from + 1]; ++k)
+                {
+                    const uint32_t* t = work + 3 * vt.triangles[k];
+                    locked[t[0]] = locked[t[1]] = locked[t[2]] = 1;
+                }
+                remaining -= 3 * shared;
+                worst = collapse->cost > worst ? collapse->cost : worst;
+                ++collapsed;
+            }
+            if (!collapsed)
+                break;
+
+            // Apply this pass's collapses and drop the triangles they closed up
+            size_t kept = 0;
+            for (size_t t = 0; t < count / 3; ++t)
+            {
+                const uint32_t a = remap[work[3 * t]], b = remap[work[3 * t + 1]], c = remap[work[3 * t + 2]];
+                if (a == b || b == c || c == a)
+                    continue;
+                work[kept++] = a;
+                work[kept++] = b;
+                work[kept++] = c;
+            }
+            count = kept;
+        }
+        memcpy(out, work, sizeof(uint32_t) * count);
+    }
+    free(quadrics);
+    free(remap);
+    free(border);
+    free(locked);
+    free(collapses);
+    free(work);
+    free(vt.offsets);
+    free(vt.triangles);
+    if (error)
+        *error = (float)sqrt(worst);
+    return count;
+}
+
+int mesh_simplify_lods(uint32_t* out, size_t out_capacity, MeshLod* lods, int max_lods, const uint32_t* indices,
+    size_t index_count, const float* positions, size_t stride, size_t vertex_count, float ratio)
+{
+    if (max_lods < 1 || index_count > out_capacity)
+        return 0;
+    memcpy(out, indices, sizeof(uint32_t) * index_count);
+    mesh_optimize_vertex_cache(out, index_count, vertex_count);     // left in input order when out of memory
+    lods[0].first_index = 0;
+    lods[0].index_count = (uint32_t)index_count;
+    lods[0].error = 0.f;
+    int level_count = 1;
+    size_t used = index_count;
+    while (level_count < max_lods)
+    {
+        const MeshLod* previous = &lods[level_count - 1];
+        const size_t target = (size_t)(previous->index_count / 3 * ratio) * 3;
+        if (target < 3 || used + previous->index_count > out_capacity)
+            break;
+        float error = 0.f;
+        const size_t simplified = mesh_simplify(out + used, out + previous->first_index, previous->index_count, positions,
+            stride, vertex_count, target, FLT_MAX, &error);
+        if (!simplified || simplified > (size_t)previous->index_count * 9 / 10)
+            break;
+        mesh_optimize_vertex_cache(out + used, simplified, vertex_count);
+        MeshLod* lod = &lods[level_count++];
+        lod->first_index = (uint32_t)used;
+        lod->index_count = (uint32_t)simplified;
+        lod->error = previous->error + error;   // each level is measured against the one before: a bound, summed
+        used += simplified;
+    }
+    return level_count;
+}
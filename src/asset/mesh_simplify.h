@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Offline simplification of indexed triangle lists into levels of detail.
+//
+// mesh_simplify collapses edges in order of quadric error (Garland and
+// Heckbert 1997): every vertex accumulates the planes of the triangles
+// around it, weighted by area, and moving it onto a neighbour costs the
+// squared distance from those planes. Edges on the mesh's border (used by
+// one triangle) also add a plane through the edge at a right angle to its
+// triangle, so outlines keep their shape and flat meshes, whose triangle
+// planes all agree, still have something to measure. A border vertex only
+// ever slides along the border. Collapses are half-edge collapses onto the
+// existing vertex, so every level indexes the same vertex buffer and
+// nothing but the indices changes between levels. A collapse that would
+// flip a triangle over is skipped.
+//
+// The error reported is the square root of the worst collapse cost, in the
+// positions' units: about how far the surface has moved. That's what the
+// runtime divides by the projected pixel size to choose a level.
+
+#define MESH_SIMPLIFY_MAX_LODS 8
+
+typedef struct MeshLod
+{
+    uint32_t first_index;       // into the chain's index list
+    uint32_t index_count;
+    float error;                // deviation from level 0, position units; 0 for level 0
+} MeshLod;
+
+// Simplifies "indices" towards "target_index_count" and writes the result to "out" (room for index_count indices).
+// "positions" are 3 floats at "stride" bytes apart. Stops early rather than move the surface further than
+// "max_error". Returns the index count written, with the deviation reached in "error" (unless NULL); 0, with
+// nothing written, when out of memory.
+size_t mesh_simplify(uint32_t* out, const uint32_t* indices, size_t index_count, const float* positions, size_t stride,
+    size_t vertex_count, size_t target_index_count, float max_error, float* error);
+
+// A chain of up to "max_lods" levels, each simplified from the one before to about "ratio" of its triangles and
+// reordered for the vertex cache. Level 0 is "indices" themselves, reordered. The levels go one after the other
+// into "out" (room for "out_capacity" indices); the chain ends when a level fails to shrink by a tenth or
+// wouldn't fit. Returns the level count, 0 when out of memory.
+int mesh_simplify_lods(uint32_t* out, size_t out_capacity, MeshLod* lods, int max_lods, const uint32_t* indices,
+    size_t index_count, const float* positions, size_t stride, size_t vertex_count, float ratio);
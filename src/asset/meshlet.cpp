@@ -0,0 +1,238 @@
+#include "asset/meshlet.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_CONE_SPREAD 0.1f        // least cosine between a triangle normal and the axis for the cone to be used
+
+static const float* vertex_position(const float* positions, size_t stride, uint32_t v)
+{
+    return (const float*)((const unsigned char*)positions + stride * v);
+}
+
+size_t meshlet_bound(size_t index_count)
+{
+    // A meshlet only closes when the triangle it would take next doesn't fit, which takes at least 62 vertices:
+    // 21 triangles, however few vertices they share
+    const size_t min_triangles = (MESHLET_MAX_VERTICES - 2 + 2) / 3;
+    return (index_count / 3 + min_triangles - 1) / min_triangles;
+}
+
+// The sphere around the meshlet's vertices (centred on their box) and the cone around its triangle normals
+static void meshlet_bounds(Meshlet* m, const uint32_t* indices, const float* positions, size_t stride)
+{
+    const size_t index_count = 3 * (size_t)m->triangle_count;
+    float lo[3], hi[3];
+    for (int c = 0; c < 3; ++c)
+        lo[c] = hi[c] = vertex_position(positions, stride, indices[0])[c];
+    for (size_t i = 1; i < index_count; ++i)
+    {
+        const float* p = vertex_position(positions, stride, indices[i]);
+        for (int c = 0; c < 3; ++c)
+        {
+            lo[c] = fminf(lo[c], p[c]);
+            hi[c] = fmaxf(hi[c], p[c]);
+        }
+    }
+    float radius2 = 0.f;
+    for (int c = 0; c < 3; ++c)
+        m->center[c] = 0.5f * (lo[c] + hi[c]);
+    for (size_t i = 0; i < index_count; ++i)
+    {
+        const float* p = vertex_position(positions, stride, indices[i]);
+        const float d[3] = { p[0] - m->center[0], p[1] - m->center[1], p[2] - m->center[2] };
+        radius2 = fmaxf(radius2, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    m->radius = sqrtf(radius2);
+
+    // Unit normals, averaged; degenerate triangles cover no pixels and don't count
+    float normals[3 * MESHLET_MAX_TRIANGLES];
+    float axis[3] = { 0.f, 0.f, 0.f };
+    uint32_t normal_count = 0;
+    for (size_t i = 0; i < index_count; i += 3)
+    {
+        const float* a = vertex_position(positions, stride, indices[i]);
+        const float* b = vertex_position(positions, stride, indices[i + 1]);
+        const float* c = vertex_position(positions, stride, indices[i + 2]);
+        const float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float* n = &normals[3 * normal_count];
+        n[0] = u[1] * v[2] - u[2] * v[1];
+        n[1] = u[2] * v[0] - u[0] * v[2];
+        n[2] = u[0] * v[1] - u[1] * v[0];
+        const float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.f)
+            continue;
+        for (int k = 0; k < 3; ++k)
+        {
+            n[k] /= length;
+            axis[k] += n[k];
+        }
+        ++normal_count;
+    }
+    const float axis_length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    m->cone_axis[0] = m->cone_axis[1] = 0.f;
+    m->cone_axis[2] = 1.f;
+    m->cone_cutoff = 1.f;
+    if (!normal_count || axis_length <= 0.f)
+        return;
+    float min_dot = 1.f;
+    for (int k = 0; k < 3; ++k)
+        m->cone_axis[k] = axis[k] / axis_length;
+    for (uint32_t t = 0; t < normal_count; ++t)
+    {
+        const float* n = &normals[3 * t];
+        min_dot = fminf(min_dot, n[0] * m->cone_axis[0] + n[1] * m->cone_axis[1] + n[2] * m->cone_axis[2]);
+    }
+    // Normals within angle a of the axis all face away from an eye more than 90 - a degrees off it: the cutoff
+    // is cos(90 - a) = sin(a). Past MIN_CONE_SPREAD the eye would have to be almost behind the axis anyway.
+    if (min_dot >= MIN_CONE_SPREAD)
+        m->cone_cutoff = sqrtf(fmaxf(0.f, 1.f - min_dot * min_dot));
+}
+
+size_t meshlet_build(Meshlet* meshlets, uint32_t* out, const uint32_t* indices, size_t index_count, const float* positions,
+    size_t stride, size_t vertex_count)
+{
+    const size_t triangle_count = index_count / 3;
+    uint32_t* offsets = (uint32_t*)calloc(vertex_count + 1, sizeof(uint32_t));
+    uint32_t* adjacent = (uint32_t*)malloc(sizeof(uint32_t) * (index_count ? index_count : 1));
+    uint32_t* live = (uint32_t*)calloc(vertex_count ? vertex_count : 1, sizeof(uint32_t));         // triangles left, per vertex
+    uint32_t* member = (uint32_t*)calloc(vertex_count ? vertex_count : 1, sizeof(uint32_t));       // meshlet + 1 it's in last
+    unsigned char* emitted = (unsigned char*)calloc(triangle_count ? triangle_count : 1, 1);
+    if (!offsets || !adjacent || !live || !member || !emitted)
+    {
+        free(offsets);
+        free(adjacent);
+        free(live);
+        free(member);
+        free(emitted);
+        return 0;
+    }
+
+    // Triangles around each vertex, as one flat array indexed through offsets
+    for (size_t i = 0; i < index_count; ++i)
+        ++live[indices[i]];
+    for (size_t v = 0; v < vertex_count; ++v)
+        offsets[v + 1] = offsets[v] + live[v];
+    for (size_t i = 0; i < index_count; ++i)
+        adjacent[offsets[indices[i]]++] = (uint32_t)(i / 3);
+    for (size_t v = vertex_count; v > 0; --v)
+        offsets[v] = offsets[v - 1];
+    offsets[0] = 0;
+
+    size_t meshlet_count = 0;
+    size_t written = 0;
+    size_t seed = 0;            // no triangle before it is left
+    uint32_t vertices[MESHLET_MAX_VERTICES];
+    while (written < index_count)
+    {
+        Meshlet* m = &meshlets[meshlet_count];
+        const uint32_t id = (uint32_t)meshlet_count + 1;
+        m->first_index = (uint32_t)written;
+        m->triangle_count = 0;
+        m->vertex_count = 0;
+        while (m->triangle_count < MESHLET_MAX_TRIANGLES)
+        {
+            // The neighbouring triangle that brings in the fewest vertices; failing any, the first one left
+            size_t best = triangle_count;
+            uint32_t best_new = 4;
+            for (uint32_t k = 0; k < m->vertex_count && best_new; ++k)
+            {
+                const uint32_t v = vertices[k];
+                if (!live[v])
+                    continue;
+                for (uint32_t a = offsets[v]; a < offsets[v + 1] && best_new; ++a)
+                {
+                    const uint32_t t = adjacent[a];
+                    if (emitted[t])
+                        continue;
+                    const uint32_t fresh = (member[indices[3 * t]] != id) + (member[indices[3 * t + 1]] != id) +
+                        (member[indices[3 * t + 2]] != id);
+                    if (fresh < best_new)
+                    {
+                        best = t;
+                        best_new = fresh;
+                    }
+                }
+            }
+            if (best == triangle_count)
+            {
+                while (seed < triangle_count && emitted[seed])
+                    ++seed;
+                if (seed == triangle_count)
+                    break;
+                best = seed;
+                best_new = 3 - (member[indices[3 * seed]] == id) - (member[indices[3 * seed + 1]] == id) -
+                    (member[indices[3 * seed + 2]] == id);
+            }
+            if (m->vertex_count + best_new > MESHLET_MAX_VERTICES)
+                break;
+
+            emitted[best] = 1;
+            for (int c = 0; c < 3; ++c)
+            {
+                const uint32_t v = indices[3 * best + c];
+                out[written++] = v;
+                --live[v];
+                if (member[v] != id)
+                {
+                    member[v] = id;
+                    vertices[m->vertex_count++] = v;
+                }
+            }
+            ++m->triangle_count;
+        }
+        meshlet_bounds(m, out + m->first_index, positions, stride);
+        ++meshlet_count;
+    }
+
+    free(offsets);
+    free(adjacent);
+    free(live);
+    free(member);
+    free(emitted);
+    return meshlet_count;
+}
+
+// The 3x3 determinant of rows 0, 1 and 3 of "vp" (column-major) without column "skip"
+static float minor3(mat4x4 const vp, int skip)
+{
+    const int rows[3] = { 0, 1, 3 };
+    float m[3][3];
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0, k = 0; c < 4; ++c)
+            if (c != skip)
+                m[r][k++] = vp[c][rows[r]];
+    return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+        m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+void meshlet_view_eye(vec4 eye, mat4x4 const vp)
+{
+    // The eye is the point clip x, y and w all vanish at: the null vector of those 3 rows, their cofactors. With
+    // this sign, a triangle's on-screen winding is counterclockwise exactly when its normal n (counterclockwise
+    // winding) has dot(n, eye.xyz - eye.w * p) > 0 for a point p on it - mirrored projections included.
+    float length2 = 0.f;
+    for (int i = 0; i < 4; ++i)
+    {
+        eye[i] = (i & 1 ? -1.f : 1.f) * minor3(vp, i);
+        length2 += eye[i] * eye[i];
+    }
+    const float scale = length2 > 0.f ? 1.f / sqrtf(length2) : 0.f;
+    for (int i = 0; i < 4; ++i)
+        eye[i] *= scale;
+}
+
+bool meshlet_cone_culled(const Meshlet* m, const vec4 eye)
+{
+    if (m->cone_cutoff >= 1.f)
+        return false;
+    // From the sphere's centre towards the eye; the sphere's radius covers where on the meshlet a triangle is
+    float toward[3];
+    for (int c = 0; c < 3; ++c)
+        toward[c] = eye[c] - eye[3] * m->center[c];
+    const float length = sqrtf(toward[0] * toward[0] + toward[1] * toward[1] + toward[2] * toward[2]);
+    const float away = -(toward[0] * m->cone_axis[0] + toward[1] * m->cone_axis[1] + toward[2] * m->cone_axis[2]);
+    return away >= m->cone_cutoff * length + m->radius * fabsf(eye[3]);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Splitting indexed triangle lists into meshlets: small clusters of
+// neighbouring triangles, each with bounds of its own, that the GPU can cull
+// one at a time instead of a whole object at once.
+//
+// Triangles are gathered greedily: a meshlet grows by the triangle next to
+// it that brings in the fewest new vertices, until it would exceed
+// MESHLET_MAX_VERTICES or MESHLET_MAX_TRIANGLES (sizes that suit a mesh
+// shader's output limits and a 64-wide work group alike). The output is the
+// same triangles, reordered so each meshlet's are one contiguous index range.
+//
+// Every meshlet gets a bounding sphere and a normal cone: the average of its
+// triangles' normals and a cutoff. When the eye is within the cone's
+// backward-facing region every triangle of the meshlet faces away, so the
+// whole meshlet can be skipped - it's what back-face culling would have
+// thrown away triangle by triangle. Meshlets whose normals spread too much
+// get a cutoff of 1, which nothing passes.
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+typedef struct Meshlet
+{
+    uint32_t first_index;       // into the reordered indices
+    uint32_t triangle_count;
+    uint32_t vertex_count;      // distinct vertices its triangles use
+    float center[3];            // bounding sphere, in the positions' units
+    float radius;
+    float cone_axis[3];         // unit; every triangle normal is within asin(cone_cutoff) of it
+    float cone_cutoff;          // 1: never culled by the cone
+} Meshlet;
+
+// Most meshlets "index_count" indices can split into
+size_t meshlet_bound(size_t index_count);
+
+// Splits the triangles of "indices" into meshlets (room for meshlet_bound of them) and writes the indices again to
+// "out", in meshlet order. "positions" are 3 floats at "stride" bytes apart; triangles face the side they wind
+// counterclockwise from. Returns the meshlet count, 0 when out of memory.
+size_t meshlet_build(Meshlet* meshlets, uint32_t* out, const uint32_t* indices, size_t index_count, const float* positions,
+    size_t stride, size_t vertex_count);
+
+// Where "vp" (projection * view) sees from, for meshlet_cone_culled: the eye position as a homogeneous point, w = 0
+// for a parallel projection (xyz then points back towards the viewer). Its sign follows the projection's
+// handedness, so "facing away" means what glFrontFace(GL_CCW) back-face culling means.
+void meshlet_view_eye(vec4 eye, mat4x4 const vp);
+
+// Every triangle of "m" faces away from "eye" (meshlet_view_eye, in the meshlet's space)
+bool meshlet_cone_culled(const Meshlet* m, const vec4 eye);
@@ -0,0 +1,227 @@
+#include "asset/static_batch.h"
+
+#include "linmath_mat3.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct BatchKey
+{
+    int32_t material;
+    int32_t cell[3];
+    uint32_t instance;
+} BatchKey;
+
+// By material, then cell, then the instances' order
+static int compare_keys(const void* a, const void* b)
+{
+    const BatchKey* x = (const BatchKey*)a;
+    const BatchKey* y = (const BatchKey*)b;
+    if (x->material != y->material)
+        return x->material < y->material ? -1 : 1;
+    for (int c = 0; c < 3; ++c)
+        if (x->cell[c] != y->cell[c])
+            return x->cell[c] < y->cell[c] ? -1 : 1;
+    return x->instance < y->instance ? -1 : x->instance > y->instance;
+}
+
+static float determinant(mat4x4 const world)
+{
+    mat3x3 m;
+    mat3x3_from_mat4x4(m, world);
+    return mat3x3_determinant(m);
+}
+
+// The box of the instance's mesh through its whole matrix
+static void instance_box(const GltfMesh* mesh, mat4x4 const world, float min[3], float max[3])
+{
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const vec4 local = { corner & 1 ? mesh->max[0] : mesh->min[0], corner & 2 ? mesh->max[1] : mesh->min[1],
+            corner & 4 ? mesh->max[2] : mesh->min[2], 1.f };
+        vec4 p;
+        mat4x4_mul_vec4(p, world, local);
+        for (int c = 0; c < 3; ++c)
+        {
+            min[c] = corner ? fminf(min[c], p[c]) : p[c];
+            max[c] = corner ? fmaxf(max[c], p[c]) : p[c];
+        }
+    }
+}
+
+// Appends the instance's vertices and triangles to "out", which has room for them
+static void append(GltfMesh* out, const GltfMesh* mesh, mat4x4 const world, const float center[3])
+{
+    mat3x3 normal_matrix;
+    mat3x3_normal(normal_matrix, world);
+    const bool mirrored = determinant(world) < 0.f;
+    const uint32_t base = out->vertex_count;
+    for (uint32_t v = 0; v < mesh->vertex_count; ++v)
+    {
+        const float* local = &mesh->positions[3 * v];
+        const vec4 position = { local[0], local[1], local[2], 1.f };
+        vec4 p;
+        mat4x4_mul_vec4(p, world, position);
+        float* color = &out->colors[3 * (base + v)];
+        for (int c = 0; c < 3; ++c)
+        {
+            out->positions[3 * (base + v) + c] = p[c] - center[c];
+            color[c] = mesh->colors ? mesh->colors[3 * v + c] : mesh->normals ? mesh->normals[3 * v + c] * 0.5f + 0.5f
+                : 1.f;
+        }
+        if (!out->normals)
+            continue;
+        vec3 n = { 0.f, 0.f, 0.f };
+        if (mesh->normals)
+            mat3x3_mul_vec3(n, normal_matrix, &mesh->normals[3 * v]);
+        const float length = vec3_len(n);
+        for (int c = 0; c < 3; ++c)
+            out->normals[3 * (base + v) + c] = length > 0.f ? n[c] / length : 0.f;
+    }
+    const uint32_t triangles = mesh->index_count / 3;
+    uint32_t* indices = &out->indices[out->index_count];
+    for (uint32_t t = 0; t < triangles; ++t)
+    {
+        const uint32_t* i = &mesh->indices[3 * t];
+        indices[3 * t] = base + i[0];
+        indices[3 * t + 1] = base + i[mirrored ? 2 : 1];
+        indices[3 * t + 2] = base + i[mirrored ? 1 : 2];
+    }
+    out->vertex_count += mesh->vertex_count;
+    out->index_count += 3 * triangles;
+}
+
+// Batch "out" of the instances keys[0, count)
+static bool merge(StaticBatch* out, const GltfScene* scene, const BatchKey* keys, uint32_t count, uint32_t index)
+{
+    memset(out, 0, sizeof(*out));
+    snprintf(out->mesh.name, sizeof(out->mesh.name), "batch%u", index);
+    out->mesh.material = keys[0].material;
+    out->instance_count = count;
+    size_t vertices = 0, indices = 0;
+    bool normals = false;
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        const GltfInstance* instance = &scene->instances[keys[k].instance];
+        const GltfMesh* mesh = &scene->meshes[instance->mesh];
+        vertices += mesh->vertex_count;
+        indices += mesh->index_count / 3 * 3;
+        normals = normals || mesh->normals;
+        float min[3], max[3];
+        instance_box(mesh, instance->world, min, max);
+        for (int c = 0; c < 3; ++c)
+        {
+            out->mesh.min[c] = k ? fminf(out->mesh.min[c], min[c]) : min[c];
+            out->mesh.max[c] = k ? fmaxf(out->mesh.max[c], max[c]) : max[c];
+        }
+    }
+    for (int c = 0; c < 3; ++c)
+    {
+        out->center[c] = 0.5f * (out->mesh.min[c] + out->mesh.max[c]);
+        out->mesh.min[c] -= out->center[c];
+        out->mesh.max[c] -= out->center[c];
+    }
+    out->mesh.positions = (float*)malloc(sizeof(float) * 3 * vertices);
+    out->mesh.colors = (float*)malloc(sizeof(float) * 3 * vertices);
+    out->mesh.normals = normals ? (float*)malloc(sizeof(float) * 3 * vertices) : NULL;
+    out->mesh.indices = (uint32_t*)malloc(sizeof(uint32_t) * indices);
+    if (!out->mesh.positions || !out->mesh.colors || (normals && !out->mesh.normals) || !out->mesh.indices)
+        return false;
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        const GltfInstance* instance = &scene->instances[keys[k].instance];
+        append(&out->mesh, &scene->meshes[instance->mesh], instance->world, out->center);
+    }
+    return true;
+}
+
+static int32_t cell_of(float x, float cell_size)
+{
+    const float cell = floorf(x / cell_size);
+    return cell < -2e9f ? -2000000000 : cell > 2e9f ? 2000000000 : (int32_t)cell;
+}
+
+bool static_batch_build(StaticBatches* out, const GltfScene* scene, float cell_size)
+{
+    memset(out, 0, sizeof(*out));
+    out->batched = (bool*)calloc(scene->instance_count ? scene->instance_count : 1, sizeof(bool));
+    BatchKey* keys = (BatchKey*)malloc(sizeof(BatchKey) * (scene->instance_count ? scene->instance_count : 1));
+    bool ok = out->batched && keys;
+    uint32_t key_count = 0;
+    for (uint32_t i = 0; i < scene->instance_count && ok; ++i)
+    {
+        const GltfInstance* instance = &scene->instances[i];
+        const GltfMesh* mesh = &scene->meshes[instance->mesh];
+        if (mesh->index_count < 3 || mesh->material == GLTF_MATERIAL_MIXED
+            || !(fabsf(determinant(instance->world)) > 1e-12f))
+            continue;
+        float min[3], max[3];
+        instance_box(mesh, instance->world, min, max);
+        BatchKey* key = &keys[key_count++];
+        key->material = mesh->material;
+        for (int c = 0; c < 3; ++c)
+            key->cell[c] = cell_of(0.5f * (min[c] + max[c]), cell_size);
+        key->instance = i;
+    }
+    if (ok)
+        qsort(keys, key_count, sizeof(BatchKey), compare_keys);
+
+    // Runs of one material and cell, cut where the vertices would pass the limit; a run of one stays an instance
+    uint32_t capacity = 0;
+    for (uint32_t begin = 0, end; begin < key_count && ok; begin = end)
+    {
+        uint64_t vertices = 0, indices = 0;
+        for (end = begin; end < key_count; ++end)
+        {
+            const BatchKey* a = &keys[begin];
+            const BatchKey* b = &keys[end];
+            if (a->material != b->material || memcmp(a->cell, b->cell, sizeof(a->cell)))
+                break;
+            const GltfMesh* mesh = &scene->meshes[scene->instances[b->instance].mesh];
+            if (end > begin && (vertices + mesh->vertex_count > STATIC_BATCH_MAX_VERTICES
+                || indices + mesh->index_count > UINT32_MAX))
+                break;
+            vertices += mesh->vertex_count;
+            indices += mesh->index_count;
+        }
+        if (end - begin < 2)
+            continue;
+        if (out->batch_count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 16;
+            StaticBatch* grown = (StaticBatch*)realloc(out->batches, sizeof(StaticBatch) * capacity);
+            ok = grown != NULL;
+            out->batches = grown ? grown : out->batches;
+            if (!ok)
+                break;
+        }
+        StaticBatch* batch = &out->batches[out->batch_count++];
+        ok = merge(batch, scene, &keys[begin], end - begin, out->batch_count - 1);
+        for (uint32_t k = begin; k < end; ++k)
+            out->batched[keys[k].instance] = true;
+        out->batched_count += end - begin;
+    }
+    free(keys);
+    if (!ok)
+    {
+        fprintf(stderr, "static_batch: out of memory\n");
+        static_batch_free(out);
+    }
+    return ok;
+}
+
+void static_batch_free(StaticBatches* batches)
+{
+    for (uint32_t b = 0; b < batches->batch_count; ++b)
+    {
+        free(batches->batches[b].mesh.positions);
+        free(batches->batches[b].mesh.normals);
+        free(batches->batches[b].mesh.colors);
+        free(batches->batches[b].mesh.indices);
+    }
+    free(batches->batches);
+    free(batches->batched);
+    memset(batches, 0, sizeof(*batches));
+}
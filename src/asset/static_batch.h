@@ -0,0 +1,50 @@
+#pragma once
+
+#include "asset/gltf.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Static batching at cook time (tools/asset_cooker.cpp --static-batch): the
+// instances of a model whose meshes draw alike - one material, or none - are
+// merged into a few meshes of vertices already through their world matrices,
+// so a block of a city that was hundreds of entities becomes a draw per
+// material per chunk. Nothing is left to do at run time; the cost is the
+// memory of the copies.
+//
+// Instances are grouped by material, then by the cell of a grid of
+// "cell_size" their boxes' centres fall in, so each batch stays compact and
+// culling still has something to reject: a batch is one entity, placed at its
+// box's centre with its box the union of its instances'. Its vertices are
+// stored relative to that centre, so half positions keep their precision.
+// Colours are baked as the cook would pick them (COLOR_0, else the model-space
+// normal mapped to [0, 1], else white), so a batch looks as its instances did;
+// normals go through each instance's normal matrix, and the triangles of a
+// mirrored instance are turned round so they still face out. A cell with more
+// than STATIC_BATCH_MAX_VERTICES vertices becomes several batches. Instances
+// are taken in their order, so the batches are the same on every run.
+//
+// A cell's lone instance is left as it was, as are instances of meshes whose
+// primitives use several materials, have no triangles or a singular matrix.
+
+#define STATIC_BATCH_MAX_VERTICES (1u << 20)
+
+typedef struct StaticBatch
+{
+    GltfMesh mesh;              // named "batch<index>", with the instances' material
+    float center[3];            // where the entity goes: the vertices are relative to it
+    uint32_t instance_count;
+} StaticBatch;
+
+typedef struct StaticBatches
+{
+    StaticBatch* batches;
+    uint32_t batch_count;
+    bool* batched;              // [the scene's instance_count]: merged, so not an entity of its own
+    uint32_t batched_count;
+} StaticBatches;
+
+// Merges "scene"'s instances into batches of "cell_size" world units (> 0). Logs and returns false when memory runs
+// out.
+bool static_batch_build(StaticBatches* out, const GltfScene* scene, float cell_size);
+void static_batch_free(StaticBatches* batches);
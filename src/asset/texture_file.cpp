@@ -0,0 +1,294 @@
+#include "asset/texture_file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const TextureFormatInfo format_infos[TEXTURE_FORMAT_COUNT] = {
+    { "unknown",    0,  0,  0, false },
+    { "RGBA8",      1,  1,  4, true },
+    { "BC1",        4,  4,  8, true },
+    { "BC2",        4,  4, 16, true },
+    { "BC3",        4,  4, 16, true },
+    { "BC4",        4,  4,  8, false },
+    { "BC5",        4,  4, 16, false },
+    { "BC6H",       4,  4, 16, false },
+    { "BC7",        4,  4, 16, true },
+    { "ETC2 RGB8",  4,  4,  8, true },
+    { "ETC2 RGBA8", 4,  4, 16, true },
+    { "ASTC 4x4",   4,  4, 16, true },
+    { "ASTC 5x4",   5,  4, 16, true },
+    { "ASTC 5x5",   5,  5, 16, true },
+    { "ASTC 6x5",   6,  5, 16, true },
+    { "ASTC 6x6",   6,  6, 16, true },
+    { "ASTC 8x5",   8,  5, 16, true },
+    { "ASTC 8x6",   8,  6, 16, true },
+    { "ASTC 8x8",   8,  8, 16, true },
+    { "ASTC 10x5", 10,  5, 16, true },
+    { "ASTC 10x6", 10,  6, 16, true },
+    { "ASTC 10x8", 10,  8, 16, true },
+    { "ASTC 10x10", 10, 10, 16, true },
+    { "ASTC 12x10", 12, 10, 16, true },
+    { "ASTC 12x12", 12, 12, 16, true },
+};
+
+const TextureFormatInfo* texture_format_info(TextureFormat format)
+{
+    return &format_infos[format < TEXTURE_FORMAT_COUNT ? format : TEXTURE_FORMAT_UNKNOWN];
+}
+
+uint64_t texture_level_size(TextureFormat format, uint32_t width, uint32_t height)
+{
+    const TextureFormatInfo* info = texture_format_info(format);
+    if (!info->block_bytes)
+        return 0;
+    const uint64_t blocks_x = (width + info->block_width - 1) / info->block_width;
+    const uint64_t blocks_y = (height + info->block_height - 1) / info->block_height;
+    return blocks_x * blocks_y * info->block_bytes;
+}
+
+static uint32_t read_u32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t read_u64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Fills in every level's size and dimensions for the format and size already set
+static const char* set_levels(TextureFile* t, int level_count)
+{
+    if (!t->width || !t->height || t->width > 32768 || t->height > 32768)
+        return "bad size";
+    if (level_count < 1 || level_count > TEXTURE_FILE_MAX_LEVELS)
+        return "bad mip count";
+    t->level_count = level_count;
+    uint32_t w = t->width, h = t->height;
+    for (int i = 0; i < level_count; ++i)
+    {
+        t->levels[i].width = w;
+        t->levels[i].height = h;
+        t->levels[i].size = texture_level_size(t->format, w, h);
+        if (w == 1 && h == 1 && i + 1 < level_count)
+            return "more mips than the size allows";
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    return NULL;
+}
+
+// --- DDS ---
+
+#define DDS_MAGIC           0x20534444u     // "DDS "
+#define DDS_HEADER_SIZE     124
+#define DDS_DX10_SIZE       20
+#define DDSD_MIPMAPCOUNT    0x20000u
+#define DDPF_ALPHAPIXELS    0x1u
+#define DDPF_FOURCC         0x4u
+#define DDPF_RGB            0x40u
+#define DDSCAPS2_CUBEMAP    0x200u
+#define DDSCAPS2_VOLUME     0x200000u
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_MISC_TEXTURECUBE    0x4u
+
+static uint32_t fourcc(const char* s)
+{
+    return (uint32_t)s[0] | (uint32_t)s[1] << 8 | (uint32_t)s[2] << 16 | (uint32_t)s[3] << 24;
+}
+
+static TextureFormat dds_dxgi_format(uint32_t dxgi, bool* srgb)
+{
+    *srgb = dxgi == 29 || dxgi == 72 || dxgi == 75 || dxgi == 78 || dxgi == 99;
+    switch (dxgi)
+    {
+    case 28: case 29: return TEXTURE_FORMAT_RGBA8;      // DXGI_FORMAT_R8G8B8A8_UNORM(_SRGB)
+    case 71: case 72: return TEXTURE_FORMAT_BC1;
+    case 74: case 75: return TEXTURE_FORMAT_BC2;
+    case 77: case 78: return TEXTURE_FORMAT_BC3;
+    case 80: return TEXTURE_FORMAT_BC4;                 // BC4_UNORM
+    case 83: return TEXTURE_FORMAT_BC5;                 // BC5_UNORM
+    case 95: return TEXTURE_FORMAT_BC6H;                // BC6H_UF16
+    case 98: case 99: return TEXTURE_FORMAT_BC7;
+    default: return TEXTURE_FORMAT_UNKNOWN;
+    }
+}
+
+static const char* parse_dds(TextureFile* t, const unsigned char* data, uint64_t size)
+{
+    if (size < 4 + DDS_HEADER_SIZE || read_u32(data + 4) != DDS_HEADER_SIZE)
+        return "truncated DDS header";
+    const unsigned char* h = data + 4;
+    const uint32_t flags = read_u32(h + 4);
+    t->height = read_u32(h + 8);
+    t->width = read_u32(h + 12);
+    const uint32_t mip_count = flags & DDSD_MIPMAPCOUNT ? read_u32(h + 24) : 1;
+    const unsigned char* pf = h + 72;
+    const uint32_t pf_flags = read_u32(pf + 4);
+    const uint32_t caps2 = read_u32(h + 108);
+    if (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME))
+        return "cube maps and volumes aren't supported";
+
+    uint64_t offset = 4 + DDS_HEADER_SIZE;
+    t->srgb = false;
+    if (pf_flags & DDPF_FOURCC)
+    {
+        const uint32_t code = read_u32(pf + 8);
+        if (code == fourcc("DX10"))
+        {
+            if (size < offset + DDS_DX10_SIZE)
+                return "truncated DX10 header";
+            const unsigned char* dx10 = data + offset;
+            if (read_u32(dx10 + 4) != DDS_DIMENSION_TEXTURE2D || (read_u32(dx10 + 8) & DDS_MISC_TEXTURECUBE)
+                || read_u32(dx10 + 12) > 1)
+                return "only single 2D textures are supported";
+            t->format = dds_dxgi_format(read_u32(dx10), &t->srgb);
+            offset += DDS_DX10_SIZE;
+        }
+        else if (code == fourcc("DXT1"))
+            t->format = TEXTURE_FORMAT_BC1;
+        else if (code == fourcc("DXT2") || code == fourcc("DXT3"))
+            t->format = TEXTURE_FORMAT_BC2;
+        else if (code == fourcc("DXT4") || code == fourcc("DXT5"))
+            t->format = TEXTURE_FORMAT_BC3;
+        else if (code == fourcc("ATI1") || code == fourcc("BC4U"))
+            t->format = TEXTURE_FORMAT_BC4;
+        else if (code == fourcc("ATI2") || code == fourcc("BC5U"))
+            t->format = TEXTURE_FORMAT_BC5;
+    }
+    else if ((pf_flags & DDPF_RGB) && (pf_flags & DDPF_ALPHAPIXELS) && read_u32(pf + 12) == 32
+        && read_u32(pf + 16) == 0xFFu && read_u32(pf + 20) == 0xFF00u && read_u32(pf + 24) == 0xFF0000u
+        && read_u32(pf + 28) == 0xFF000000u)
+        t->format = TEXTURE_FORMAT_RGBA8;                   // bytes R, G, B, A
+    if (t->format == TEXTURE_FORMAT_UNKNOWN)
+        return "unsupported DDS pixel format";
+
+    const char* error = set_levels(t, mip_count ? (int)mip_count : 1);
+    if (error)
+        return error;
+    for (int i = 0; i < t->level_count; ++i)     // levels follow one another, largest first
+    {
+        if (t->levels[i].size > size - offset)
+            return "mip data out of bounds";
+        t->levels[i].data = data + offset;
+        offset += t->levels[i].size;
+    }
+    return NULL;
+}
+
+// --- KTX2 ---
+
+#define KTX2_HEADER_SIZE        80
+#define KTX2_LEVEL_SIZE         24
+#define KTX2_SUPERCOMPRESSION_BASISLZ 1
+#define KTX2_DFD_MODEL_UASTC    166
+
+static const unsigned char ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+static TextureFormat ktx2_vk_format(uint32_t vk, bool* srgb)
+{
+    *srgb = false;
+    if (vk >= 157 && vk <= 184)         // VK_FORMAT_ASTC_4x4_UNORM_BLOCK .. ASTC_12x12_SRGB_BLOCK, UNORM/SRGB pairs
+    {
+        *srgb = (vk - 157) % 2 == 1;
+        return (TextureFormat)(TEXTURE_FORMAT_ASTC_4x4 + (vk - 157) / 2);
+    }
+    *srgb = vk == 43 || vk == 134 || vk == 136 || vk == 138 || vk == 146 || vk == 148 || vk == 152;
+    switch (vk)
+    {
+    case 37: case 43: return TEXTURE_FORMAT_RGBA8;      // VK_FORMAT_R8G8B8A8_UNORM / _SRGB
+    case 133: case 134: return TEXTURE_FORMAT_BC1;      // BC1_RGBA
+    case 135: case 136: return TEXTURE_FORMAT_BC2;
+    case 137: case 138: return TEXTURE_FORMAT_BC3;
+    case 139: return TEXTURE_FORMAT_BC4;
+    case 141: return TEXTURE_FORMAT_BC5;
+    case 143: return TEXTURE_FORMAT_BC6H;               // BC6H_UFLOAT
+    case 145: case 146: return TEXTURE_FORMAT_BC7;
+    case 147: case 148: return TEXTURE_FORMAT_ETC2_RGB8;
+    case 151: case 152: return TEXTURE_FORMAT_ETC2_RGBA8;
+    default: return TEXTURE_FORMAT_UNKNOWN;
+    }
+}
+
+static const char* parse_ktx2(TextureFile* t, const unsigned char* data, uint64_t size)
+{
+    if (size < KTX2_HEADER_SIZE)
+        return "truncated KTX2 header";
+    const uint32_t vk_format = read_u32(data + 12);
+    t->width = read_u32(data + 20);
+    t->height = read_u32(data + 24);
+    const uint32_t depth = read_u32(data + 28), layers = read_u32(data + 32), faces = read_u32(data + 36);
+    const uint32_t level_count = read_u32(data + 40), supercompression = read_u32(data + 44);
+    const uint32_t dfd_offset = read_u32(data + 48), dfd_length = read_u32(data + 52);
+    if (depth > 1 || layers > 1 || faces != 1)
+        return "only single 2D textures are supported";
+
+    // Basis Universal: vkFormat is UNDEFINED and the blocks need transcoding before any GPU can use them.
+    // UASTC says so in the data format descriptor's color model (the byte after the descriptor's headers).
+    const bool uastc = vk_format == 0 && dfd_length >= 16 && dfd_offset <= size - 16 && data[dfd_offset + 12] == KTX2_DFD_MODEL_UASTC;
+    if (supercompression == KTX2_SUPERCOMPRESSION_BASISLZ || uastc)
+        return "Basis Universal texture: needs a transcoder, which isn't built in";
+    if (supercompression != 0)
+        return "supercompressed KTX2 isn't supported";
+    t->format = ktx2_vk_format(vk_format, &t->srgb);
+    if (t->format == TEXTURE_FORMAT_UNKNOWN)
+        return "unsupported KTX2 vkFormat";
+
+    const char* error = set_levels(t, level_count ? (int)level_count : 1);
+    if (error)
+        return error;
+    if (size < KTX2_HEADER_SIZE + (uint64_t)KTX2_LEVEL_SIZE * t->level_count)
+        return "truncated level index";
+    for (int i = 0; i < t->level_count; ++i)     // the index is largest first; the data is usually stored tail first
+    {
+        const unsigned char* entry = data + KTX2_HEADER_SIZE + KTX2_LEVEL_SIZE * i;
+        const uint64_t offset = read_u64(entry), length = read_u64(entry + 8);
+        if (length != t->levels[i].size)
+            return "mip size doesn't match the format";
+        if (offset > size || length > size - offset)
+            return "mip data out of bounds";
+        t->levels[i].data = data + offset;
+    }
+    return NULL;
+}
+
+bool texture_file_open_memory(TextureFile* texture, const void* data, size_t size, const char* name)
+{
+    memset(texture, 0, sizeof(*texture));      // no mapping: closing unmaps nothing
+    const unsigned char* bytes = (const unsigned char*)data;
+    const char* error = "neither DDS nor KTX2";
+    if (size >= 4 && read_u32(bytes) == DDS_MAGIC)
+        error = parse_dds(texture, bytes, size);
+    else if (size >= sizeof(ktx2_identifier) && !memcmp(bytes, ktx2_identifier, sizeof(ktx2_identifier)))
+        error = parse_ktx2(texture, bytes, size);
+    if (error)
+    {
+        fprintf(stderr, "texture_file: %s: %s\n", name, error);
+        return false;
+    }
+    return true;
+}
+
+bool texture_file_open(TextureFile* texture, const char* path)
+{
+    MappedFile file;
+    if (!mapped_file_open(&file, path))
+        return false;
+    if (!texture_file_open_memory(texture, file.data, file.size, path))
+    {
+        mapped_file_close(&file);
+        return false;
+    }
+    texture->file = file;
+    return true;
+}
+
+void texture_file_close(TextureFile* texture)
+{
+    mapped_file_close(&texture->file);
+    memset(texture, 0, sizeof(*texture));
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "core/mapped_file.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Precompressed 2D textures in DDS or KTX2 containers, used straight from a
+// memory mapping like mesh files: opening maps the file, validates the header
+// and records where each mip level's blocks are. Nothing is decoded - the
+// blocks go to the driver as they are stored.
+//
+// DDS: the legacy DXT1/DXT3/DXT5/ATI1/ATI2 FourCCs, 32-bit RGBA, and the DX10
+// header's BC1-BC7 and RGBA8 DXGI formats. KTX2: the BC, ETC2, ASTC (LDR
+// block sizes) and RGBA8 Vulkan formats, without supercompression. Basis
+// Universal payloads (BasisLZ, UASTC) are recognised but rejected: they need
+// a transcoder to BCn / ETC2 / ASTC, which isn't built in. Cube maps, arrays
+// and volumes are rejected too.
+//
+// Like mesh_file this module is GL-free; gl/texture.h maps the formats to GL.
+
+#define TEXTURE_FILE_MAX_LEVELS 16      // 32768 x 32768
+
+typedef enum TextureFormat
+{
+    TEXTURE_FORMAT_UNKNOWN,
+    TEXTURE_FORMAT_RGBA8,
+    TEXTURE_FORMAT_BC1,         // RGB + 1-bit alpha, 8 bytes per 4x4
+    TEXTURE_FORMAT_BC2,
+    TEXTURE_FORMAT_BC3,
+    TEXTURE_FORMAT_BC4,         // one channel
+    TEXTURE_FORMAT_BC5,         // two channels (normal maps)
+    TEXTURE_FORMAT_BC6H,        // unsigned half-float RGB
+    TEXTURE_FORMAT_BC7,
+    TEXTURE_FORMAT_ETC2_RGB8,
+    TEXTURE_FORMAT_ETC2_RGBA8,  // ETC2 + EAC alpha
+    TEXTURE_FORMAT_ASTC_4x4,    // the LDR block sizes, in Vulkan / GL enum order
+    TEXTURE_FORMAT_ASTC_5x4,
+    TEXTURE_FORMAT_ASTC_5x5,
+    TEXTURE_FORMAT_ASTC_6x5,
+    TEXTURE_FORMAT_ASTC_6x6,
+    TEXTURE_FORMAT_ASTC_8x5,
+    TEXTURE_FORMAT_ASTC_8x6,
+    TEXTURE_FORMAT_ASTC_8x8,
+    TEXTURE_FORMAT_ASTC_10x5,
+    TEXTURE_FORMAT_ASTC_10x6,
+    TEXTURE_FORMAT_ASTC_10x8,
+    TEXTURE_FORMAT_ASTC_10x10,
+    TEXTURE_FORMAT_ASTC_12x10,
+    TEXTURE_FORMAT_ASTC_12x12,
+    TEXTURE_FORMAT_COUNT
+} TextureFormat;
+
+typedef struct TextureFormatInfo
+{
+    const char* name;
+    uint8_t block_width;        // 1 x 1 for uncompressed formats
+    uint8_t block_height;
+    uint8_t block_bytes;
+    bool has_srgb;              // an sRGB variant exists
+} TextureFormatInfo;
+
+const TextureFormatInfo* texture_format_info(TextureFormat format);
+
+// Bytes of one "width" x "height" level: whole blocks, partial ones at the edges rounded up
+uint64_t texture_level_size(TextureFormat format, uint32_t width, uint32_t height);
+
+typedef struct TextureLevel
+{
+    const void* data;           // into the mapping
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+} TextureLevel;
+
+// An open texture: "levels" point into the mapping, level 0 the largest
+typedef struct TextureFile
+{
+    MappedFile file;
+    TextureFormat format;
+    bool srgb;
+    uint32_t width;
+    uint32_t height;
+    int level_count;
+    TextureLevel levels[TEXTURE_FILE_MAX_LEVELS];
+} TextureFile;
+
+// Maps and validates "path", a .dds or .ktx2 (told apart by their magic). Logs and returns false on failure.
+bool texture_file_open(TextureFile* texture, const char* path);
+
+// Same, over bytes the caller keeps alive ("name" is for the log); texture_file_close then unmaps nothing
+bool texture_file_open_memory(TextureFile* texture, const void* data, size_t size, const char* name);
+void texture_file_close(TextureFile* texture);
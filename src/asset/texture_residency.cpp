@@ -0,0 +1,180 @@
+#include "asset/texture_residency.h"
+
+#include <string.h>
+
+void texture_residency_init(TextureResidency* res, uint64_t budget, uint64_t upload_budget)
+{
+    memset(res, 0, sizeof(*res));
+    res->budget = budget;
+    res->upload_budget = upload_budget;
+    res->frame = 1;     // 0 is "never needed"
+}
+
+int texture_residency_add(TextureResidency* res, uint32_t width, uint32_t height, int level_count, const uint64_t* level_bytes)
+{
+    if (res->count >= TEXTURE_RESIDENCY_MAX_TEXTURES || level_count < 1 || level_count > TEXTURE_RESIDENCY_MAX_LEVELS)
+        return -1;
+    TextureResidencyEntry* e = &res->entries[res->count];
+    e->level_count = level_count;
+    e->size = width > height ? width : height;
+    memcpy(e->level_bytes, level_bytes, sizeof(uint64_t) * level_count);
+    e->tail = level_count - 1;
+    while (e->tail > 0 && (e->size >> (e->tail - 1)) <= TEXTURE_RESIDENCY_TAIL_SIZE)
+        --e->tail;
+    e->top = level_count;
+    e->wanted = e->tail;
+    e->screen_size = 0.f;
+    e->last_needed = 0;
+    return res->count++;
+}
+
+void texture_residency_request(TextureResidency* res, int texture, float screen_size)
+{
+    TextureResidencyEntry* e = &res->entries[texture];
+    if (screen_size > e->screen_size)
+        e->screen_size = screen_size;
+    e->last_needed = res->frame;
+}
+
+static uint64_t range_bytes(const TextureResidencyEntry* e, int from, int to)
+{
+    uint64_t bytes = 0;
+    for (int l = from; l < to; ++l)
+        bytes += e->level_bytes[l];
+    return bytes;
+}
+
+// The texture to lose its largest level, or -1. First choice is a texture with a level it doesn't need,
+// least recently needed first. With "needed" set, one drawn at the smallest size above its tail is next.
+static int pick_victim(const TextureResidency* res, const int* target, int exclude, bool needed)
+{
+    int best = -1;
+    for (int i = 0; i < res->count; ++i)
+    {
+        const TextureResidencyEntry* e = &res->entries[i];
+        if (i != exclude && target[i] < e->wanted && (best < 0 || e->last_needed < res->entries[best].last_needed))
+            best = i;
+    }
+    if (best >= 0 || !needed)
+        return best;
+    for (int i = 0; i < res->count; ++i)
+    {
+        const TextureResidencyEntry* e = &res->entries[i];
+        if (i != exclude && target[i] < e->tail && (best < 0 || e->screen_size < res->entries[best].screen_size))
+            best = i;
+    }
+    return best;
+}
+
+static void evict_level(TextureResidency* res, int* target, int victim)
+{
+    const uint64_t bytes = res->entries[victim].level_bytes[target[victim]];
+    ++target[victim];
+    res->resident_bytes -= bytes;
+    res->evicted_bytes += bytes;
+}
+
+int texture_residency_update(TextureResidency* res, TextureResidencyChange* changes)
+{
+    int target[TEXTURE_RESIDENCY_MAX_TEXTURES];
+    int order[TEXTURE_RESIDENCY_MAX_TEXTURES];
+    int upgrades = 0;
+    uint64_t uploaded = 0;
+
+    // The detail each texture is drawn at: the smallest level at least as large as it appears. Tails go in
+    // first, whatever the budgets.
+    for (int i = 0; i < res->count; ++i)
+    {
+        TextureResidencyEntry* e = &res->entries[i];
+        e->wanted = e->tail;
+        if (e->last_needed == res->frame && e->screen_size > 0.f)
+        {
+            e->wanted = 0;
+            while (e->wanted < e->tail && (float)(e->size >> (e->wanted + 1)) >= e->screen_size)
+                ++e->wanted;
+        }
+        target[i] = e->top;
+        if (target[i] > e->tail)
+        {
+            const uint64_t bytes = range_bytes(e, e->tail, target[i]);
+            target[i] = e->tail;
+            res->resident_bytes += bytes;
+            uploaded += bytes;
+        }
+    }
+
+    // A lowered budget: shed levels until it's met, needed or not
+    while (res->resident_bytes > res->budget)
+    {
+        const int victim = pick_victim(res, target, -1, true);
+        if (victim < 0)
+            break;
+        evict_level(res, target, victim);
+    }
+
+    // Furthest below the detail it's drawn at first, then the largest on screen
+    for (int i = 0; i < res->count; ++i)
+    {
+        if (target[i] > res->entries[i].wanted)
+            order[upgrades++] = i;
+    }
+    for (int a = 1; a < upgrades; ++a)
+    {
+        const int i = order[a];
+        const TextureResidencyEntry* e = &res->entries[i];
+        int b = a;
+        for (; b > 0; --b)
+        {
+            const int j = order[b - 1];
+            const TextureResidencyEntry* f = &res->entries[j];
+            const int deficit_e = target[i] - e->wanted, deficit_f = target[j] - f->wanted;
+            if (deficit_f > deficit_e || (deficit_f == deficit_e && f->screen_size >= e->screen_size))
+                break;
+            order[b] = j;
+        }
+        order[b] = i;
+    }
+
+    // One level at a time, so the upload budget spreads the larger levels over frames
+    for (int k = 0; k < upgrades; ++k)
+    {
+        const int i = order[k];
+        const TextureResidencyEntry* e = &res->entries[i];
+        bool stop = false;
+        while (target[i] > e->wanted)
+        {
+            const uint64_t bytes = e->level_bytes[target[i] - 1];
+            if (uploaded > 0 && uploaded + bytes > res->upload_budget)
+            {
+                stop = true;
+                break;
+            }
+            int victim;
+            while (res->resident_bytes + bytes > res->budget && (victim = pick_victim(res, target, i, false)) >= 0)
+                evict_level(res, target, victim);
+            if (res->resident_bytes + bytes > res->budget)
+            {
+                ++res->deferred;
+                break;
+            }
+            --target[i];
+            res->resident_bytes += bytes;
+            uploaded += bytes;
+        }
+        if (stop)
+            break;
+    }
+
+    int count = 0;
+    for (int i = 0; i < res->count; ++i)
+    {
+        TextureResidencyEntry* e = &res->entries[i];
+        if (target[i] != e->top)
+            changes[count++] = { i, e->top, target[i] };
+        e->top = target[i];
+        e->screen_size = 0.f;
+    }
+    res->uploaded_bytes += uploaded;
+    ++res->frame;
+    return count;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+// Mip residency policy for streamed textures: which levels of each texture
+// should be in GPU memory, decided once a frame from how large the textures
+// appear on screen. GL-free; gl/texture_streamer.h carries the decisions out.
+//
+// Every texture is resident from its mip tail (levels TEXTURE_RESIDENCY_TAIL_SIZE
+// pixels and smaller) up to its "top" level. Tails load first, for every
+// texture, before any texture gets a larger level, so everything can be drawn
+// early at low detail. After that the textures furthest below the detail they
+// are drawn at get their next levels first, larger on screen first, within a
+// per-frame upload budget.
+//
+// The memory budget caps the bytes resident. To make room, levels a texture
+// no longer needs are evicted first, least recently needed first. If that
+// isn't enough the upgrade waits. Levels still in use are evicted only when
+// the budget is lowered below what is resident; the victims are the
+// textures smallest on screen. Tails are never evicted.
+
+#define TEXTURE_RESIDENCY_MAX_TEXTURES 256
+#define TEXTURE_RESIDENCY_MAX_LEVELS   16
+#define TEXTURE_RESIDENCY_TAIL_SIZE    64      // levels this size and under are loaded together, and first
+
+typedef struct TextureResidencyEntry
+{
+    int level_count;
+    int tail;                   // first level of the mip tail
+    uint32_t size;              // larger side of level 0
+    uint64_t level_bytes[TEXTURE_RESIDENCY_MAX_LEVELS];
+    int top;                    // largest resident level; level_count while nothing is
+    int wanted;                 // largest level worth having for the latest request
+    float screen_size;          // largest on-screen size requested for the current frame, in pixels
+    uint64_t last_needed;       // frame of the latest request
+} TextureResidencyEntry;
+
+// One texture's residency moving from levels [from, count) to [to, count)
+typedef struct TextureResidencyChange
+{
+    int texture;
+    int from;
+    int to;
+} TextureResidencyChange;
+
+typedef struct TextureResidency
+{
+    uint64_t budget;            // bytes resident at most (the tails are always let in)
+    uint64_t upload_budget;     // bytes of new levels per update; at least one level goes up regardless
+    uint64_t resident_bytes;
+    uint64_t frame;
+    int count;
+    TextureResidencyEntry entries[TEXTURE_RESIDENCY_MAX_TEXTURES];
+    uint64_t uploaded_bytes;    // totals since init
+    uint64_t evicted_bytes;
+    uint64_t deferred;          // updates that left an upgrade waiting for memory
+} TextureResidency;
+
+void texture_residency_init(TextureResidency* res, uint64_t budget, uint64_t upload_budget);
+
+// A "width" x "height" texture of "level_count" levels, "level_bytes" each (level 0 first), with nothing
+// resident. Returns its id, or -1 when the table is full.
+int texture_residency_add(TextureResidency* res, uint32_t width, uint32_t height, int level_count, const uint64_t* level_bytes);
+
+// The texture is drawn this frame at about "screen_size" pixels across; the largest request of a frame counts
+void texture_residency_request(TextureResidency* res, int texture, float screen_size);
+
+// Ends the frame's requests and decides the next residency. Writes one change per texture whose levels
+// moved into "changes" (room for TEXTURE_RESIDENCY_MAX_TEXTURES) and returns how many. The caller has
+// to apply all of them: from then on, they are what's resident.
+int texture_residency_update(TextureResidency* res, TextureResidencyChange* changes);
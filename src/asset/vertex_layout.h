@@ -0,0 +1,189 @@
+#pragma once
+
+#include "asset/mesh_file.h"
+#include "asset/vertex_pack.h"
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <tuple>
+#include <utility>
+
+// Vertex formats as C++ types. Where a VertexFormat (gl/vertex_format.h) or
+// a mesh file's MeshFileAttrib records describe a layout at runtime, and the
+// code reading them switches on each attribute's type, a VertexLayout says
+// the same in template arguments:
+//
+//     typedef VertexLayout<VertexLayoutAttrib<0, 2, VERTEX_ATTRIB_FLOAT16, "vPos">,
+//         VertexLayoutAttrib<1, 3, VERTEX_ATTRIB_UNORM8, "vCol">> PackedVertex;
+//
+// and everything derived from it is worked out when it's compiled: the
+// offsets and the stride (laid out as vertex_pack_add lays them out, so the
+// bytes are the same either way), a packing loop with each attribute's
+// conversion and offset fixed (vertex_layout_pack), and the GLSL input
+// declarations (VertexLayout::glsl), which vertex_layout_splice puts into a
+// shader's source, so the shader can't disagree with the buffer. The GL side,
+// the attribute setup with constant arguments, is gl/vertex_format.h's
+// vertex_layout_apply and vertex_layout_attach. No GL here, so tools can
+// pack with the same types.
+
+// An attribute's GLSL name, as a template argument
+template <size_t N>
+struct VertexLayoutName
+{
+    char text[N];
+    constexpr VertexLayoutName(const char (&name)[N])
+    {
+        for (size_t i = 0; i < N; ++i)
+            text[i] = name[i];
+    }
+};
+
+template <uint8_t Location, int Components, VertexAttribType Type, VertexLayoutName Name>
+struct VertexLayoutAttrib
+{
+    static_assert(Components >= 1 && Components <= 4, "an attribute has 1 to 4 components");
+    static constexpr uint8_t location = Location;
+    static constexpr int components = Components;
+    static constexpr VertexAttribType type = Type;
+    static constexpr size_t bytes = vertex_attrib_size(Type) * Components;
+    static constexpr const char* name = Name.text;
+};
+
+// Appends "text" at "at" of "out" (unless NULL, for measuring); returns where it ends
+constexpr size_t vertex_layout_put(char* out, size_t at, const char* text)
+{
+    for (; *text; ++text, ++at)
+    {
+        if (out)
+            out[at] = *text;
+    }
+    return at;
+}
+
+// Writes "Attrib"'s declaration, "layout(location = L) in vecN name;\n", at "at" of "out" (NULL: measures)
+template <typename Attrib>
+constexpr size_t vertex_layout_glsl_attrib(char* out, size_t at)
+{
+    // Normalized and float storage arrive as floats; UINT8 as unsigned integers
+    const bool integer = Attrib::type == VERTEX_ATTRIB_UINT8;
+    const char* scalar = integer ? "uint" : "float";
+    const char* vector[] = { "", integer ? "uvec2" : "vec2", integer ? "uvec3" : "vec3", integer ? "uvec4" : "vec4" };
+    const char digits[3] = { (char)('0' + Attrib::location / 10), (char)('0' + Attrib::location % 10), 0 };
+    at = vertex_layout_put(out, at, "layout(location = ");
+    at = vertex_layout_put(out, at, Attrib::location >= 10 ? digits : digits + 1);
+    at = vertex_layout_put(out, at, ") in ");
+    at = vertex_layout_put(out, at, Attrib::components == 1 ? scalar : vector[Attrib::components - 1]);
+    at = vertex_layout_put(out, at, " ");
+    at = vertex_layout_put(out, at, Attrib::name);
+    return vertex_layout_put(out, at, ";\n");
+}
+
+template <typename... Attribs>
+constexpr size_t vertex_layout_glsl_write(char* out)
+{
+    size_t at = 0;
+    ((at = vertex_layout_glsl_attrib<Attribs>(out, at)), ...);
+    return at;
+}
+
+// The declarations, NUL-terminated
+template <typename... Attribs>
+constexpr std::array<char, vertex_layout_glsl_write<Attribs...>(nullptr) + 1> vertex_layout_glsl()
+{
+    std::array<char, vertex_layout_glsl_write<Attribs...>(nullptr) + 1> text{};
+    vertex_layout_glsl_write<Attribs...>(text.data());
+    return text;
+}
+
+// Each attribute's offset, 4-byte aligned as vertex_pack_add has them, then the stride
+template <typename... Attribs>
+constexpr std::array<size_t, sizeof...(Attribs) + 1> vertex_layout_offsets()
+{
+    const size_t bytes[] = { Attribs::bytes... };
+    std::array<size_t, sizeof...(Attribs) + 1> at{};
+    size_t end = 0;
+    for (size_t i = 0; i < sizeof...(Attribs); ++i)
+    {
+        at[i] = (end + 3) & ~(size_t)3;
+        end = at[i] + bytes[i];
+    }
+    at[sizeof...(Attribs)] = (end + 3) & ~(size_t)3;
+    return at;
+}
+
+template <typename... Attribs>
+struct VertexLayout
+{
+    static_assert(sizeof...(Attribs) >= 1 && sizeof...(Attribs) <= MESH_FILE_MAX_ATTRIBS,
+        "a layout has 1 to MESH_FILE_MAX_ATTRIBS attributes");
+    static constexpr int count = (int)sizeof...(Attribs);
+    static constexpr std::array<size_t, sizeof...(Attribs) + 1> offsets = vertex_layout_offsets<Attribs...>();
+    static constexpr size_t stride = offsets[sizeof...(Attribs)];
+    static constexpr auto glsl = vertex_layout_glsl<Attribs...>();
+    template <size_t I>
+    using Attrib = std::tuple_element_t<I, std::tuple<Attribs...>>;
+};
+
+// "Layout" as a mesh file's records, for the code that takes a layout at runtime (writing mesh files, reading
+// positions back); "attribs" has room for Layout::count
+template <typename Layout, size_t... I>
+inline void vertex_layout_describe(MeshFileAttrib* attribs, std::index_sequence<I...>)
+{
+    ((attribs[I] = { Layout::template Attrib<I>::location, (uint8_t)Layout::template Attrib<I>::components,
+        (uint8_t)Layout::template Attrib<I>::type, 0, (uint32_t)Layout::offsets[I] }), ...);
+}
+
+template <typename Layout>
+inline void vertex_layout_describe(MeshFileAttrib* attribs)
+{
+    vertex_layout_describe<Layout>(attribs, std::make_index_sequence<Layout::count>());
+}
+
+template <typename Attrib, size_t Offset, size_t Stride>
+inline void vertex_layout_pack_attrib(const VertexSource* source, size_t vertex_count, unsigned char* out)
+{
+    constexpr size_t size = vertex_attrib_size(Attrib::type);
+    for (size_t v = 0; v < vertex_count; ++v)
+    {
+        const float* src = (const float*)((const unsigned char*)source->data + source->stride * v);
+        unsigned char* p = out + Stride * v + Offset;
+        for (int c = 0; c < Attrib::components; ++c)
+            vertex_pack_component<Attrib::type>(src[c], p + size * c);
+    }
+}
+
+template <typename Layout, size_t... I>
+inline void vertex_layout_pack(const VertexSource* sources, size_t vertex_count, void* out, std::index_sequence<I...>)
+{
+    memset(out, 0, vertex_count * Layout::stride);
+    (vertex_layout_pack_attrib<typename Layout::template Attrib<I>, Layout::offsets[I], Layout::stride>(&sources[I],
+        vertex_count, (unsigned char*)out), ...);
+}
+
+// Packs "vertex_count" vertices from one source per attribute (in declaration order) into "out", which must hold
+// vertex_count * Layout::stride bytes: the bytes vertex_pack would write for the same layout, each attribute's loop
+// compiled for its type, components and offset
+template <typename Layout>
+inline void vertex_layout_pack(const VertexSource* sources, size_t vertex_count, void* out)
+{
+    vertex_layout_pack<Layout>(sources, vertex_count, out, std::make_index_sequence<Layout::count>());
+}
+
+// "head", then "glsl" (a VertexLayout's), then "tail": a shader's source with the layout's inputs declared where they
+// go, put together when it's compiled. The three are NUL-terminated; so is the result.
+template <size_t H, size_t G, size_t T>
+constexpr std::array<char, H + G + T - 2> vertex_layout_splice(const char (&head)[H], const std::array<char, G>& glsl,
+    const char (&tail)[T])
+{
+    std::array<char, H + G + T - 2> text{};
+    size_t at = 0;
+    for (size_t i = 0; i + 1 < H; ++i)
+        text[at++] = head[i];
+    for (size_t i = 0; i + 1 < G; ++i)
+        text[at++] = glsl[i];
+    for (size_t i = 0; i < T; ++i)
+        text[at++] = tail[i];
+    return text;
+}
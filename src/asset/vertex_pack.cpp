@@ -0,0 +1,169 @@
+#include "asset/vertex_pack.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+bool vertex_pack_add(MeshFileAttrib* attribs, int* count, uint32_t* stride, uint8_t location, int components,
+    VertexAttribType type)
+{
+    if (*count == MESH_FILE_MAX_ATTRIBS || components < 1 || components > 4)
+    {
+        fprintf(stderr, "vertex_pack: can't add %d components at location %u\n", components, location);
+        return false;
+    }
+    MeshFileAttrib* attrib = &attribs[(*count)++];
+    attrib->location = location;
+    attrib->components = (uint8_t)components;
+    attrib->type = (uint8_t)type;
+    attrib->stream = 0;
+    attrib->offset = (*stride + 3) & ~3u;
+    *stride = attrib->offset + (uint32_t)vertex_attrib_size(type) * components;
+    *stride = (*stride + 3) & ~3u;
+    return true;
+}
+
+uint16_t vertex_float_to_half(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t abs = bits & 0x7FFFFFFFu;
+
+    if (abs >= 0x7F800000u)
+        return (uint16_t)(sign | 0x7C00u | (abs > 0x7F800000u ? 0x200u | ((abs >> 13) & 0x3FFu) : 0u));     // inf / quiet NaN
+    if (abs >= 0x477FF000u)
+        return (uint16_t)(sign | 0x7C00u);     // rounds past the largest half (65504)
+    if (abs < 0x38800000u)
+    {
+        // Subnormal half (or zero): shift the implicit-1 mantissa into place, rounding to nearest even
+        if (abs < 0x33000000u)
+            return (uint16_t)sign;
+        const uint32_t exponent = abs >> 23;
+        const uint32_t mantissa = (abs & 0x7FFFFFu) | 0x800000u;
+        const uint32_t shift = 126 - exponent;      // lands the value on the 2^-24 subnormal grid
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+            ++half;
+        return (uint16_t)(sign | half);
+    }
+    // Normal: rebias the exponent and round the 13 dropped mantissa bits to nearest even
+    uint32_t half = ((abs - 0x38000000u) >> 13);
+    const uint32_t remainder = abs & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1)))
+        ++half;     // may carry into the exponent, which is still correct
+    return (uint16_t)(sign | half);
+}
+
+float vertex_half_to_float(uint16_t h)
+{
+    const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1Fu;
+    uint32_t mantissa = h & 0x3FFu;
+    uint32_t bits;
+    if (exponent == 0x1Fu)
+        bits = sign | 0x7F800000u | (mantissa << 13);     // inf / NaN
+    else if (exponent)
+        bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    else if (!mantissa)
+        bits = sign;
+    else
+    {
+        // Subnormal half: normalise it, every one is a normal float
+        uint32_t e = 113u;
+        while (!(mantissa & 0x400u))
+        {
+            mantissa <<= 1;
+            --e;
+        }
+        bits = sign | (e << 23) | ((mantissa & 0x3FFu) << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+void vertex_pack(const MeshFileAttrib* attribs, int attrib_count, size_t stride, const VertexSource* sources,
+    size_t vertex_count, void* out)
+{
+    unsigned char* dst = (unsigned char*)out;
+    memset(dst, 0, vertex_count * stride);     // padding bytes stay deterministic (nice for caching / diffs)
+    for (int a = 0; a < attrib_count; ++a)
+    {
+        const MeshFileAttrib* attrib = &attribs[a];
+        const VertexSource* source = &sources[a];
+        for (size_t v = 0; v < vertex_count; ++v)
+        {
+            const float* src = (const float*)((const unsigned char*)source->data + source->stride * v);
+            unsigned char* p = dst + stride * v + attrib->offset;
+            for (int c = 0; c < attrib->components; ++c)
+            {
+                const float x = src[c];
+                switch ((VertexAttribType)attrib->type)
+                {
+                case VERTEX_ATTRIB_FLOAT32: vertex_pack_component<VERTEX_ATTRIB_FLOAT32>(x, p + c * 4); break;
+                case VERTEX_ATTRIB_FLOAT16: vertex_pack_component<VERTEX_ATTRIB_FLOAT16>(x, p + c * 2); break;
+                case VERTEX_ATTRIB_SNORM16: vertex_pack_component<VERTEX_ATTRIB_SNORM16>(x, p + c * 2); break;
+                case VERTEX_ATTRIB_UNORM16: vertex_pack_component<VERTEX_ATTRIB_UNORM16>(x, p + c * 2); break;
+                case VERTEX_ATTRIB_SNORM8: vertex_pack_component<VERTEX_ATTRIB_SNORM8>(x, p + c); break;
+                case VERTEX_ATTRIB_UNORM8: vertex_pack_component<VERTEX_ATTRIB_UNORM8>(x, p + c); break;
+                case VERTEX_ATTRIB_UINT8: vertex_pack_component<VERTEX_ATTRIB_UINT8>(x, p + c); break;
+                }
+            }
+        }
+    }
+}
+
+bool vertex_pack_split(MeshFileAttrib* attribs, int attrib_count, uint8_t position_location, uint32_t* stride,
+    uint32_t* attribute_stride)
+{
+    int position = -1;
+    for (int a = 0; a < attrib_count; ++a)
+        if (attribs[a].location == position_location)
+            position = a;
+    if (position < 0 || attrib_count < 2)
+        return false;
+    uint32_t ends[2] = { 0, 0 };
+    for (int a = 0; a < attrib_count; ++a)
+    {
+        MeshFileAttrib* attrib = &attribs[a];
+        uint32_t* end = &ends[a == position ? 0 : 1];
+        attrib->stream = a == position ? 0 : 1;
+        attrib->offset = (*end + 3) & ~3u;
+        *end = attrib->offset + (uint32_t)vertex_attrib_size((VertexAttribType)attrib->type) * attrib->components;
+        *end = (*end + 3) & ~3u;
+    }
+    *stride = ends[0];
+    *attribute_stride = ends[1];
+    return true;
+}
+
+void vertex_pack_streams(const MeshFileAttrib* attribs, int attrib_count, size_t stride, size_t attribute_stride,
+    const VertexSource* sources, size_t vertex_count, void* out)
+{
+    if (!attribute_stride)
+    {
+        vertex_pack(attribs, attrib_count, stride, sources, vertex_count, out);
+        return;
+    }
+    // Each stream packed on its own, from its attributes' sources
+    const uint64_t attribute_offset = vertex_pack_attribute_offset(stride, vertex_count);
+    for (int stream = 0; stream < 2; ++stream)
+    {
+        MeshFileAttrib stream_attribs[MESH_FILE_MAX_ATTRIBS] = {};
+        VertexSource stream_sources[MESH_FILE_MAX_ATTRIBS] = {};
+        int count = 0;
+        for (int a = 0; a < attrib_count; ++a)
+        {
+            if (attribs[a].stream != stream)
+                continue;
+            stream_attribs[count] = attribs[a];
+            stream_sources[count++] = sources[a];
+        }
+        vertex_pack(stream_attribs, count, stream ? attribute_stride : stride, stream_sources, vertex_count,
+            (unsigned char*)out + (stream ? attribute_offset : 0));
+    }
+    memset((unsigned char*)out + stride * vertex_count, 0, attribute_offset - stride * vertex_count);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "asset/mesh_file.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Packing float vertex data into compact storage types, without GL, so that
+// offline tools (tools/asset_cooker.cpp) write exactly what the runtime's
+// VertexFormat (gl/vertex_format.h) would have packed at load. A layout is
+// the mesh file's own: MeshFileAttrib records of location, component count,
+// VertexAttribType and offset, each attribute starting 4-byte aligned.
+
+typedef enum VertexAttribType
+{
+    VERTEX_ATTRIB_FLOAT32,
+    VERTEX_ATTRIB_FLOAT16,      // IEEE half (GL_HALF_FLOAT)
+    VERTEX_ATTRIB_SNORM16,      // [-1, 1] -> int16
+    VERTEX_ATTRIB_UNORM16,      // [0, 1] -> uint16
+    VERTEX_ATTRIB_SNORM8,       // [-1, 1] -> int8
+    VERTEX_ATTRIB_UNORM8,       // [0, 1] -> uint8, e.g. colors
+    VERTEX_ATTRIB_UINT8         // [0, 255] -> uint8, unnormalized (glVertexAttribIPointer), e.g. joint indices
+} VertexAttribType;
+
+// Where one attribute's float values come from when packing: "components" floats at "data", then every "stride" bytes
+typedef struct VertexSource
+{
+    const float* data;
+    size_t stride;
+} VertexSource;
+
+// Bytes per component
+constexpr size_t vertex_attrib_size(VertexAttribType type)
+{
+    switch (type)
+    {
+    case VERTEX_ATTRIB_FLOAT32: return 4;
+    case VERTEX_ATTRIB_FLOAT16:
+    case VERTEX_ATTRIB_SNORM16:
+    case VERTEX_ATTRIB_UNORM16: return 2;
+    case VERTEX_ATTRIB_SNORM8:
+    case VERTEX_ATTRIB_UNORM8:
+    case VERTEX_ATTRIB_UINT8: return 1;
+    }
+    return 4;
+}
+
+// Appends an attribute to "attribs" (room for MESH_FILE_MAX_ATTRIBS, "*count" used) and grows "*stride", laid out
+// as vertex_format_add lays it out. False when there's no room or "components" isn't 1-4.
+bool vertex_pack_add(MeshFileAttrib* attribs, int* count, uint32_t* stride, uint8_t location, int components,
+    VertexAttribType type);
+
+// Packs "vertex_count" vertices from one source per attribute (in "attribs" order) into "out", which must hold
+// vertex_count * stride bytes. Values outside a normalized type's range are clamped; padding is zeroed.
+void vertex_pack(const MeshFileAttrib* attribs, int attrib_count, size_t stride, const VertexSource* sources,
+    size_t vertex_count, void* out);
+
+// Split streams: the attribute at "position_location" alone in stream 0, the rest laid out again one after another
+// in stream 1, in place. "*stride" becomes the position stream's, "*attribute_stride" the attribute stream's.
+// False (the layout left alone) without an attribute at "position_location" or with nothing besides it.
+bool vertex_pack_split(MeshFileAttrib* attribs, int attrib_count, uint8_t position_location, uint32_t* stride,
+    uint32_t* attribute_stride);
+
+// Where the attribute stream starts: after "vertex_count" vertices of the position stream, MESH_FILE_ALIGN aligned
+inline uint64_t vertex_pack_attribute_offset(size_t stride, size_t vertex_count)
+{
+    return ((uint64_t)stride * vertex_count + MESH_FILE_ALIGN - 1) & ~(uint64_t)(MESH_FILE_ALIGN - 1);
+}
+
+// Bytes "vertex_count" vertices take: both streams and the padding between them when split ("attribute_stride" not 0)
+inline uint64_t vertex_pack_size(size_t stride, size_t attribute_stride, size_t vertex_count)
+{
+    if (!attribute_stride)
+        return (uint64_t)stride * vertex_count;
+    return vertex_pack_attribute_offset(stride, vertex_count) + (uint64_t)attribute_stride * vertex_count;
+}
+
+// vertex_pack for either layout: "attribute_stride" 0 packs interleaved; otherwise the position stream, then the
+// attribute stream at vertex_pack_attribute_offset, into vertex_pack_size bytes at "out"
+void vertex_pack_streams(const MeshFileAttrib* attribs, int attrib_count, size_t stride, size_t attribute_stride,
+    const VertexSource* sources, size_t vertex_count, void* out);
+
+// Round-to-nearest-even float -> half conversion (overflow goes to infinity, NaN stays NaN)
+uint16_t vertex_float_to_half(float f);
+
+// Exact half -> float conversion
+float vertex_half_to_float(uint16_t h);
+
+inline float vertex_pack_clamp(float x, float lo, float hi)
+{
+    return x < lo ? lo : x > hi ? hi : x;
+}
+
+// One component "x" stored as "Type" at "p": vertex_pack's conversions, for code that knows the type when it's
+// compiled (asset/vertex_layout.h). Values outside a normalized type's range are clamped.
+template <VertexAttribType Type>
+inline void vertex_pack_component(float x, unsigned char* p)
+{
+    if constexpr (Type == VERTEX_ATTRIB_FLOAT32)
+        memcpy(p, &x, 4);
+    else if constexpr (Type == VERTEX_ATTRIB_FLOAT16)
+    {
+        const uint16_t h = vertex_float_to_half(x);
+        memcpy(p, &h, 2);
+    }
+    else if constexpr (Type == VERTEX_ATTRIB_SNORM16)
+    {
+        const int16_t s = (int16_t)lrintf(vertex_pack_clamp(x, -1.f, 1.f) * 32767.f);
+        memcpy(p, &s, 2);
+    }
+    else if constexpr (Type == VERTEX_ATTRIB_UNORM16)
+    {
+        const uint16_t u = (uint16_t)lrintf(vertex_pack_clamp(x, 0.f, 1.f) * 65535.f);
+        memcpy(p, &u, 2);
+    }
+    else if constexpr (Type == VERTEX_ATTRIB_SNORM8)
+        *(int8_t*)p = (int8_t)lrintf(vertex_pack_clamp(x, -1.f, 1.f) * 127.f);
+    else if constexpr (Type == VERTEX_ATTRIB_UNORM8)
+        *p = (unsigned char)lrintf(vertex_pack_clamp(x, 0.f, 1.f) * 255.f);
+    else
+        *p = (unsigned char)lrintf(vertex_pack_clamp(x, 0.f, 255.f));
+}
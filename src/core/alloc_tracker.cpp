@@ -0,0 +1,379 @@
+#include "core/alloc_tracker.h"
+
+#include <atomic>
+#include <errno.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#if ALLOC_TRACKING && defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define ALLOC_HOOK_MALLOC 1     // replaces malloc and the rest
+#define ALLOC_HOOK_NEW 0
+#include <unistd.h>
+#else
+#define ALLOC_HOOK_MALLOC 0
+#define ALLOC_HOOK_NEW ALLOC_TRACKING       // replaces operator new and delete
+#endif
+
+// One thread's counters; only that thread writes them (the shared last slot excepted)
+typedef struct alignas(64) AllocSlot
+{
+    std::atomic<int64_t> live[ALLOC_TAG_COUNT];
+    std::atomic<uint64_t> allocations[ALLOC_TAG_COUNT];
+} AllocSlot;
+
+static AllocSlot slots[ALLOC_TRACKER_THREADS];
+static std::atomic<int> slot_count(0);
+
+// Plain old data only: nothing here may allocate, or construct on first use
+static thread_local int thread_tag = ALLOC_TAG_OTHER;
+static thread_local bool thread_guard = false;
+
+// Summed by alloc_tracker_frame
+static AllocTagStats tag_stats[ALLOC_TAG_COUNT];
+static uint64_t startup_allocations[ALLOC_TAG_COUNT];      // at the first frame's end, left out of the averages
+static uint64_t frames;
+
+static const char* const tag_names[ALLOC_TAG_COUNT] = {
+    "other", "frame", "scene", "assets", "render", "jobs", "streaming"
+};
+
+const char* alloc_tag_name(AllocTag tag)
+{
+    return tag >= 0 && tag < ALLOC_TAG_COUNT ? tag_names[tag] : "?";
+}
+
+bool alloc_tracking_available(void)
+{
+    return ALLOC_TRACKING != 0;
+}
+
+AllocTag alloc_tag_set(AllocTag tag)
+{
+    const AllocTag previous = (AllocTag)thread_tag;
+    thread_tag = tag;
+    return previous;
+}
+
+void alloc_tracker_guard(bool guard)
+{
+    thread_guard = guard;
+}
+
+#if ALLOC_TRACKING
+
+static thread_local int thread_slot = -1;
+
+static AllocSlot* own_slot(bool* shared)
+{
+    if (thread_slot < 0)
+    {
+        const int slot = slot_count.fetch_add(1, std::memory_order_relaxed);
+        thread_slot = slot < ALLOC_TRACKER_THREADS - 1 ? slot : ALLOC_TRACKER_THREADS - 1;
+    }
+    *shared = thread_slot == ALLOC_TRACKER_THREADS - 1;
+    return &slots[thread_slot];
+}
+
+static void add(std::atomic<int64_t>* counter, int64_t n, bool shared)
+{
+    if (shared)
+        counter->fetch_add(n, std::memory_order_relaxed);
+    else
+        counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static void count_allocation(size_t size, int tag)
+{
+    if (thread_guard)
+    {
+        thread_guard = false;
+        fprintf(stderr, "alloc_tracker: %zu-byte allocation (%s) on a thread that mustn't allocate\n", size,
+            tag_names[tag]);
+        abort();
+    }
+    bool shared = false;
+    AllocSlot* slot = own_slot(&shared);
+    add(&slot->live[tag], (int64_t)size, shared);
+    if (shared)
+        slot->allocations[tag].fetch_add(1, std::memory_order_relaxed);
+    else
+        slot->allocations[tag].store(slot->allocations[tag].load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+}
+
+static void count_free(size_t size, int tag)
+{
+    bool shared = false;
+    add(&own_slot(&shared)->live[tag], -(int64_t)size, shared);
+}
+
+// In front of every block: where the underlying allocation starts (before the header, for an aligned one), and
+// the size and tag it's charged with
+typedef struct AllocHeader
+{
+    void* raw;
+    size_t size : 56;
+    size_t tag : 8;
+} AllocHeader;
+
+static_assert(sizeof(AllocHeader) == 16, "the header keeps malloc's 16-byte alignment");
+
+static void* wrap(void* raw, size_t size, size_t alignment)
+{
+    if (!raw)
+        return NULL;
+    const uintptr_t user = ((uintptr_t)raw + sizeof(AllocHeader) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    AllocHeader* h = (AllocHeader*)user - 1;
+    h->raw = raw;
+    h->size = size;
+    h->tag = (size_t)thread_tag;
+    count_allocation(size, thread_tag);
+    return (void*)user;
+}
+
+static AllocHeader* header(void* p)
+{
+    return (AllocHeader*)p - 1;
+}
+
+// The underlying allocation's room for "alignment"-aligned user bytes after a header; 0 on overflow
+static size_t padded(size_t size, size_t alignment)
+{
+    const size_t extra = sizeof(AllocHeader) + (alignment > 16 ? alignment : 0);
+    return size <= SIZE_MAX - extra && size < ((size_t)1 << 56) ? size + extra : 0;
+}
+
+#endif
+
+#if ALLOC_HOOK_MALLOC
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+}
+
+static void* aligned(size_t alignment, size_t size)
+{
+    if (alignment <= 16)
+        return malloc(size);
+    const size_t total = padded(size, alignment);
+    return total ? wrap(__libc_malloc(total), size, alignment) : NULL;
+}
+
+extern "C" {
+
+void* malloc(size_t size)
+{
+    const size_t total = padded(size, 16);
+    return total ? wrap(__libc_malloc(total), size, 16) : NULL;
+}
+
+void* calloc(size_t count, size_t size)
+{
+    if (size && count > SIZE_MAX / size)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    const size_t total = padded(count * size, 16);
+    return total ? wrap(__libc_calloc(1, total), count * size, 16) : NULL;
+}
+
+void free(void* p)
+{
+    if (!p)
+        return;
+    AllocHeader* h = header(p);
+    count_free(h->size, (int)h->tag);
+    __libc_free(h->raw);
+}
+
+void* realloc(void* p, size_t size)
+{
+    if (!p)
+        return malloc(size);
+    if (!size)
+    {
+        free(p);
+        return NULL;
+    }
+    AllocHeader* h = header(p);
+    const size_t old_size = h->size;
+    if (h->raw != (void*)h)
+    {
+        // Aligned: moved into a plain block
+        void* q = malloc(size);
+        if (q)
+        {
+            memcpy(q, p, old_size < size ? old_size : size);
+            free(p);
+        }
+        return q;
+    }
+    const size_t total = padded(size, 16);
+    const int old_tag = (int)h->tag;
+    void* raw = total ? __libc_realloc(h, total) : NULL;
+    if (!raw)
+        return NULL;
+    count_free(old_size, old_tag);
+    return wrap(raw, size, 16);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    if (!alignment || (alignment & (alignment - 1)))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    return aligned(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size)
+{
+    if (!alignment || (alignment & (alignment - 1)) || alignment % sizeof(void*))
+        return EINVAL;
+    void* p = aligned(alignment, size);
+    if (!p)
+        return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void* valloc(size_t size)
+{
+    return aligned((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+void* pvalloc(size_t size)
+{
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return aligned(page, (size + page - 1) / page * page);
+}
+
+size_t malloc_usable_size(void* p)
+{
+    return p ? header(p)->size : 0;
+}
+
+}
+
+#elif ALLOC_HOOK_NEW
+
+static void* tracked_new(size_t size, size_t alignment)
+{
+    const size_t total = padded(size ? size : 1, alignment);
+    return total ? wrap(malloc(total), size, alignment > 16 ? alignment : 16) : NULL;
+}
+
+static void tracked_delete(void* p)
+{
+    if (!p)
+        return;
+    AllocHeader* h = header(p);
+    count_free(h->size, (int)h->tag);
+    free(h->raw);
+}
+
+static void* tracked_new_or_throw(size_t size, size_t alignment)
+{
+    void* p = tracked_new(size, alignment);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return tracked_new_or_throw(size, 16); }
+void* operator new[](size_t size) { return tracked_new_or_throw(size, 16); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return tracked_new(size, 16); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return tracked_new(size, 16); }
+void* operator new(size_t size, std::align_val_t a) { return tracked_new_or_throw(size, (size_t)a); }
+void* operator new[](size_t size, std::align_val_t a) { return tracked_new_or_throw(size, (size_t)a); }
+void* operator new(size_t size, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+    return tracked_new(size, (size_t)a);
+}
+void* operator new[](size_t size, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+    return tracked_new(size, (size_t)a);
+}
+void operator delete(void* p) noexcept { tracked_delete(p); }
+void operator delete[](void* p) noexcept { tracked_delete(p); }
+void operator delete(void* p, size_t) noexcept { tracked_delete(p); }
+void operator delete[](void* p, size_t) noexcept { tracked_delete(p); }
+void operator delete(void* p, std::align_val_t) noexcept { tracked_delete(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { tracked_delete(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { tracked_delete(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { tracked_delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { tracked_delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { tracked_delete(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { tracked_delete(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { tracked_delete(p); }
+
+#endif
+
+uint64_t alloc_tracker_frame(void)
+{
+    const int used = slot_count.load(std::memory_order_relaxed);
+    const int count = used < ALLOC_TRACKER_THREADS ? used : ALLOC_TRACKER_THREADS;
+    uint64_t total = 0;
+    for (int t = 0; t < ALLOC_TAG_COUNT; ++t)
+    {
+        int64_t live = 0;
+        uint64_t allocations = 0;
+        for (int s = 0; s < count; ++s)
+        {
+            live += slots[s].live[t].load(std::memory_order_relaxed);
+            allocations += slots[s].allocations[t].load(std::memory_order_relaxed);
+        }
+        AllocTagStats* stats = &tag_stats[t];
+        stats->live = live;
+        if (live > stats->peak)
+            stats->peak = live;
+        stats->frame_allocations = allocations - stats->allocations;
+        if (!frames)
+            startup_allocations[t] = allocations;           // the first "frame" is everything since the start
+        else if (stats->frame_allocations > stats->frame_max)
+            stats->frame_max = stats->frame_allocations;
+        stats->allocations = allocations;
+        total += stats->frame_allocations;
+    }
+    ++frames;
+    return total;
+}
+
+void alloc_tracker_stats(AllocTag tag, AllocTagStats* stats)
+{
+    *stats = tag_stats[tag];
+}
+
+void alloc_tracker_print(FILE* out)
+{
+    if (!ALLOC_TRACKING)
+    {
+        fprintf(out, "allocations: not tracked in this build (configure with -DOPENGLTEST_ALLOC_TRACKING=ON)\n");
+        return;
+    }
+    fprintf(out, "allocations over %llu frames%s:\n", (unsigned long long)frames,
+        ALLOC_HOOK_MALLOC ? "" : " (operator new only)");
+    fprintf(out, "  %-10s %12s %12s %12s %10s %10s\n", "tag", "live KB", "peak KB", "allocations", "per frame",
+        "max/frame");
+    for (int t = 0; t < ALLOC_TAG_COUNT; ++t)
+    {
+        const AllocTagStats* s = &tag_stats[t];
+        if (!s->allocations)
+            continue;
+        fprintf(out, "  %-10s %12.1f %12.1f %12llu %10.2f %10llu\n", tag_names[t], s->live / 1024.0, s->peak / 1024.0,
+            (unsigned long long)s->allocations,
+            frames > 1 ? (double)(s->allocations - startup_allocations[t]) / (double)(frames - 1) : 0.0,
+            (unsigned long long)s->frame_max);
+    }
+}
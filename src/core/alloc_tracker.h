@@ -0,0 +1,96 @@
+#pragma once
+
+#include "core/cpu_trace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Where the heap goes: every allocation is charged to the subsystem a tag
+// names, and its live bytes, peak and allocations per frame are kept per tag.
+//
+// The hook is global. On glibc it's malloc itself: the process's malloc,
+// calloc, realloc, free and the aligned ones are replaced (the set glibc's
+// manual lists for a replacement malloc) and passed on to __libc_malloc and
+// friends, so C++'s operator new, the C-style code's malloc and libraries'
+// allocations all go through it. Elsewhere operator new and delete are
+// replaced, which leaves plain malloc uncounted. Each block carries a
+// 16-byte header with its size and tag, so a free is charged back to the
+// tag that allocated it, on whichever thread frees it.
+//
+// A thread's tag is set by ALLOC_TAG_SCOPE(tag) for the rest of a block, or
+// for a whole thread at its start (the render thread, the job workers, the
+// streamer's threads); untagged allocations are ALLOC_TAG_OTHER. Counting is
+// a thread-local fast path: each thread adds to counters of its own, on
+// their own cache line, with plain loads and stores, and alloc_tracker_frame
+// sums them once a frame. Peaks are therefore the live bytes at frame ends.
+//
+// alloc_tracker_guard(true) turns any allocation on the calling thread into
+// an assertion: the app's --assert-no-allocs guards the main thread's frame
+// work once it has settled, so heap use on the hot path stops the run right
+// where it happens, with its size and tag, for the debugger or core dump.
+//
+// Tracking is built in with ALLOC_TRACKING 1 (-DOPENGLTEST_ALLOC_TRACKING=ON,
+// which the Profile preset sets); without it the scopes compile to nothing
+// and nothing is counted.
+
+#ifndef ALLOC_TRACKING
+#define ALLOC_TRACKING 0
+#endif
+
+#define ALLOC_TRACKER_THREADS 128       // threads with counters of their own; later ones share the last
+
+typedef enum AllocTag
+{
+    ALLOC_TAG_OTHER,
+    ALLOC_TAG_FRAME,        // the main thread's frame loop
+    ALLOC_TAG_SCENE,        // the scene and its files
+    ALLOC_TAG_ASSETS,       // meshes, characters and the like loaded up front
+    ALLOC_TAG_RENDER,       // the render thread: the renderer and the driver
+    ALLOC_TAG_JOBS,         // the job system's workers
+    ALLOC_TAG_STREAMING,    // the asset streamer's and async I/O's threads
+    ALLOC_TAG_COUNT
+} AllocTag;
+
+typedef struct AllocTagStats
+{
+    int64_t live;               // bytes
+    int64_t peak;               // most bytes live at a frame's end
+    uint64_t allocations;       // since the start
+    uint64_t frame_allocations; // in the last frame
+    uint64_t frame_max;         // the most in one frame
+} AllocTagStats;
+
+// Whether the hook is built in
+bool alloc_tracking_available(void);
+
+// Makes "tag" the calling thread's and returns the one it had
+AllocTag alloc_tag_set(AllocTag tag);
+
+// Allocations on the calling thread assert (print and abort) while "guard" is on
+void alloc_tracker_guard(bool guard);
+
+// Ends a frame: sums every thread's counters into the tags' stats and returns the frame's allocations, all tags
+uint64_t alloc_tracker_frame(void);
+
+// A tag's stats as of the last alloc_tracker_frame
+void alloc_tracker_stats(AllocTag tag, AllocTagStats* stats);
+
+// Every tag's live and peak bytes, allocations, and allocations per frame on average and at most
+void alloc_tracker_print(FILE* out);
+
+const char* alloc_tag_name(AllocTag tag);
+
+// Charges the enclosing block's allocations on this thread to a tag
+typedef struct AllocTagScope
+{
+    AllocTag previous;
+
+    explicit AllocTagScope(AllocTag tag) : previous(alloc_tag_set(tag)) {}
+    ~AllocTagScope() { alloc_tag_set(previous); }
+} AllocTagScope;
+
+#if ALLOC_TRACKING
+#define ALLOC_TAG_SCOPE(tag) AllocTagScope CPU_TRACE_CONCAT(alloc_tag_scope_, __LINE__)(tag)
+#else
+#define ALLOC_TAG_SCOPE(tag) ((void)0)
+#endif
@@ -0,0 +1,807 @@
+#include "core/async_io.h"
+
+#include "core/alloc_tracker.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#include <linux/io_uring.h>
+#define ASYNC_IO_HAVE_URING 1
+#endif
+#endif
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/fetch.h>
+#include <stdlib.h>
+#define ASYNC_IO_HAVE_FETCH 1
+#endif
+
+#define WAKE_TAG UINT64_MAX             // io_uring user data / completion key of a wake-up
+
+static intptr_t file_handle(const AsyncIo* io, int file)
+{
+    return file >= 0 && file < ASYNC_IO_MAX_FILES ? io->files[file] : -1;
+}
+
+// Reads at "offset" until "size" bytes are in or the file ends: the thread pool's read. -1 on failure.
+static int64_t read_at(intptr_t handle, void* buffer, uint32_t size, uint64_t offset)
+{
+    uint32_t done = 0;
+    while (done < size)
+    {
+#ifdef _WIN32
+        OVERLAPPED at;
+        memset(&at, 0, sizeof(at));
+        at.Offset = (DWORD)(offset + done);
+        at.OffsetHigh = (DWORD)((offset + done) >> 32);
+        DWORD n = 0;
+        if (!ReadFile((HANDLE)handle, (char*)buffer + done, size - done, &n, &at))
+            return GetLastError() == ERROR_HANDLE_EOF ? (int64_t)done : -1;
+#else
+        const ssize_t n = pread((int)handle, (char*)buffer + done, size - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+#endif
+        if (n == 0)
+            break;
+        done += (uint32_t)n;
+    }
+    return done;
+}
+
+// Hands back a busy slot's read, freeing the slot. Called with the lock held.
+static AsyncIoCompletion complete(AsyncIo* io, uint32_t slot, int64_t result)
+{
+    AsyncIoSlot* s = &io->slots[slot];
+    AsyncIoCompletion c = { s->read.tag, result < 0 ? -1 : result };
+    s->busy = false;
+    --io->in_flight;
+    ++io->reads;
+    if (result > 0)
+        io->bytes_read += (uint64_t)result;
+    return c;
+}
+
+static void signal_poller(AsyncIo* io);
+
+// A read that completed outside the backend's own completions; a poll waiting on the backend is woken for it
+static void finish(AsyncIo* io, uint32_t slot, int64_t result)
+{
+    io->finished[io->finished_count++] = { slot, result };
+    signal_poller(io);
+}
+
+// --- io_uring ---
+
+#ifdef ASYNC_IO_HAVE_URING
+
+static int uring_enter(int ring, unsigned int submit, unsigned int wait)
+{
+    return (int)syscall(__NR_io_uring_enter, ring, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+static void uring_destroy(AsyncIo* io)
+{
+    for (int i = 2; i >= 0; --i)
+        if (io->ring_memory[i] && (i != 1 || io->ring_memory[1] != io->ring_memory[0]))
+            munmap(io->ring_memory[i], io->ring_sizes[i]);
+    if (io->ring >= 0)
+        close(io->ring);
+    io->ring = -1;
+    memset(io->ring_memory, 0, sizeof(io->ring_memory));
+}
+
+// Sets up a ring twice the depth (room for a wake-up beside every read) and checks the kernel has IORING_OP_READ
+static const char* uring_init(AsyncIo* io)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    io->ring = (int)syscall(__NR_io_uring_setup, 2 * io->depth, &params);
+    if (io->ring < 0)
+        return strerror(errno);
+
+    io->ring_sizes[0] = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    io->ring_sizes[1] = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    io->ring_sizes[2] = params.sq_entries * sizeof(struct io_uring_sqe);
+    const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single)
+        io->ring_sizes[0] = io->ring_sizes[1] = io->ring_sizes[0] > io->ring_sizes[1] ? io->ring_sizes[0] : io->ring_sizes[1];
+    const off_t offsets[3] = { IORING_OFF_SQ_RING, IORING_OFF_CQ_RING, IORING_OFF_SQES };
+    for (int i = 0; i < 3; ++i)
+    {
+        if (i == 1 && single)
+        {
+            io->ring_memory[1] = io->ring_memory[0];
+            continue;
+        }
+        void* memory = mmap(NULL, io->ring_sizes[i], PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring, offsets[i]);
+        if (memory == MAP_FAILED)
+        {
+            uring_destroy(io);
+            return "can't map the rings";
+        }
+        io->ring_memory[i] = memory;
+    }
+    unsigned char* sq = (unsigned char*)io->ring_memory[0];
+    unsigned char* cq = (unsigned char*)io->ring_memory[1];
+    io->sq_head = (uint32_t*)(sq + params.sq_off.head);
+    io->sq_tail = (uint32_t*)(sq + params.sq_off.tail);
+    io->sq_mask = *(uint32_t*)(sq + params.sq_off.ring_mask);
+    io->sq_array = (uint32_t*)(sq + params.sq_off.array);
+    io->cq_head = (uint32_t*)(cq + params.cq_off.head);
+    io->cq_tail = (uint32_t*)(cq + params.cq_off.tail);
+    io->cq_mask = *(uint32_t*)(cq + params.cq_off.ring_mask);
+    io->cqes = cq + params.cq_off.cqes;
+    io->sqes = io->ring_memory[2];
+
+    // IORING_OP_READ arrived in 5.6, with the probe; older kernels refuse the probe
+    const size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    unsigned char probe_memory[sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op)];
+    memset(probe_memory, 0, probe_size);
+    struct io_uring_probe* probe = (struct io_uring_probe*)probe_memory;
+    if (syscall(__NR_io_uring_register, io->ring, IORING_REGISTER_PROBE, probe, 256) < 0
+        || probe->last_op < IORING_OP_READ || !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+    {
+        uring_destroy(io);
+        return "the kernel has no IORING_OP_READ";
+    }
+    return NULL;
+}
+
+// Writes a read (or, for WAKE_TAG, a no-op) into the submission ring; uring_flush hands them to the kernel
+static void uring_queue(AsyncIo* io, uint64_t user_data)
+{
+    const uint32_t tail = *io->sq_tail;
+    const uint32_t index = tail & io->sq_mask;
+    struct io_uring_sqe* sqe = &((struct io_uring_sqe*)io->sqes)[index];
+    memset(sqe, 0, sizeof(*sqe));
+    if (user_data == WAKE_TAG)
+        sqe->opcode = IORING_OP_NOP;
+    else
+    {
+        const AsyncIoRead* r = &io->slots[user_data].read;
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = (int)file_handle(io, r->file);
+        sqe->off = r->offset + r->done;
+        sqe->addr = (uint64_t)(uintptr_t)((char*)r->buffer + r->done);
+        sqe->len = r->size - r->done;
+    }
+    sqe->user_data = user_data;
+    io->sq_array[index] = index;
+    __atomic_store_n(io->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// One io_uring_enter for everything queued since the last
+static void uring_flush(AsyncIo* io, uint32_t count)
+{
+    if (count == 0)
+        return;
+    uint32_t submitted = 0;
+    for (int tries = 0; submitted < count && tries < 100; ++tries)
+    {
+        const int n = uring_enter(io->ring, count - submitted, 0);
+        if (n > 0)
+            submitted += (uint32_t)n;
+        else if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            fprintf(stderr, "async_io: io_uring_enter failed: %s\n", strerror(errno));
+            break;
+        }
+    }
+}
+
+// Completions out of the ring; short reads go back in for the rest
+static uint32_t uring_reap(AsyncIo* io, AsyncIoCompletion* out, uint32_t max)
+{
+    uint32_t head = *io->cq_head, n = 0, again = 0;
+    const uint32_t tail = __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail && n < max; ++head)
+    {
+        const struct io_uring_cqe* cqe = &((const struct io_uring_cqe*)io->cqes)[head & io->cq_mask];
+        if (cqe->user_data == WAKE_TAG)
+        {
+            io->wake_pending = false;
+            continue;
+        }
+        const uint32_t slot = (uint32_t)cqe->user_data;
+        AsyncIoRead* r = &io->slots[slot].read;
+        if (cqe->res > 0)
+        {
+            r->done += (uint32_t)cqe->res;
+            if (r->done < r->size)
+            {
+                uring_queue(io, slot);
+                ++again;
+                continue;
+            }
+        }
+        out[n++] = complete(io, slot, cqe->res < 0 ? -1 : (int64_t)r->done);
+    }
+    __atomic_store_n(io->cq_head, head, __ATOMIC_RELEASE);
+    if (again)
+    {
+        uring_flush(io, again);
+        ++io->submissions;
+    }
+    return n;
+}
+
+#endif
+
+// --- overlapped I/O ---
+
+#ifdef _WIN32
+
+static_assert(sizeof(OVERLAPPED) <= sizeof(((AsyncIoSlot*)0)->overlapped), "AsyncIoSlot::overlapped is too small");
+
+static bool overlapped_start(AsyncIo* io, uint32_t slot)
+{
+    AsyncIoRead* r = &io->slots[slot].read;
+    OVERLAPPED* at = (OVERLAPPED*)io->slots[slot].overlapped;
+    memset(at, 0, sizeof(*at));
+    at->Offset = (DWORD)(r->offset + r->done);
+    at->OffsetHigh = (DWORD)((r->offset + r->done) >> 32);
+    ++io->submissions;
+    if (ReadFile((HANDLE)file_handle(io, r->file), (char*)r->buffer + r->done, r->size - r->done, NULL, at)
+        || GetLastError() == ERROR_IO_PENDING)
+        return true;
+    // Failed without queueing a completion
+    finish(io, slot, GetLastError() == ERROR_HANDLE_EOF ? (int64_t)r->done : -1);
+    return false;
+}
+
+// Waits up to "timeout" ms for completion packets, without the lock
+static ULONG overlapped_dequeue(AsyncIo* io, OVERLAPPED_ENTRY* entries, uint32_t max, DWORD timeout)
+{
+    ULONG got = 0;
+    if (!GetQueuedCompletionStatusEx((HANDLE)io->port, entries, max, &got, timeout, FALSE))
+        return 0;
+    return got;
+}
+
+// With the lock: short reads are restarted for the rest
+static uint32_t overlapped_process(AsyncIo* io, const OVERLAPPED_ENTRY* entries, ULONG count, AsyncIoCompletion* out)
+{
+    uint32_t n = 0;
+    for (ULONG i = 0; i < count; ++i)
+    {
+        if (entries[i].lpCompletionKey == (ULONG_PTR)WAKE_TAG)
+        {
+            io->wake_pending = false;
+            continue;
+        }
+        AsyncIoSlot* s = (AsyncIoSlot*)((char*)entries[i].lpOverlapped - offsetof(AsyncIoSlot, overlapped));
+        const uint32_t slot = (uint32_t)(s - io->slots);
+        AsyncIoRead* r = &s->read;
+        DWORD bytes = 0;
+        const bool ok = GetOverlappedResult((HANDLE)file_handle(io, r->file), entries[i].lpOverlapped, &bytes, FALSE) != 0;
+        if (!ok && GetLastError() != ERROR_HANDLE_EOF)
+        {
+            out[n++] = complete(io, slot, -1);
+            continue;
+        }
+        r->done += bytes;
+        if (ok && bytes > 0 && r->done < r->size)
+        {
+            overlapped_start(io, slot);
+            continue;
+        }
+        out[n++] = complete(io, slot, r->done);
+    }
+    return n;
+}
+
+#endif
+
+// --- Fetch ---
+
+#ifdef ASYNC_IO_HAVE_FETCH
+
+// A synchronous request for "url" (a pool worker may block), its answer kept in memory. NULL when there's none.
+static emscripten_fetch_t* fetch_request(const char* url, const char* method, const char* const* headers)
+{
+    emscripten_fetch_attr_t attr;
+    emscripten_fetch_attr_init(&attr);
+    snprintf(attr.requestMethod, sizeof(attr.requestMethod), "%s", method);
+    attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_SYNCHRONOUS | EMSCRIPTEN_FETCH_REPLACE;
+    attr.requestHeaders = headers;
+    return emscripten_fetch(&attr, url);
+}
+
+// The file at "url"'s size, from the Content-Length of a HEAD request; false without one
+static bool fetch_size(const char* url, uint64_t* size)
+{
+    emscripten_fetch_t* fetch = fetch_request(url, "HEAD", NULL);
+    if (!fetch)
+        return false;
+    bool found = false;
+    const size_t length = fetch->status == 200 ? emscripten_fetch_get_response_headers_length(fetch) : 0;
+    char* headers = length ? (char*)malloc(length + 1) : NULL;
+    if (headers)
+    {
+        emscripten_fetch_get_response_headers(fetch, headers, length + 1);
+        for (const char* line = headers; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL)
+            if (!strncasecmp(line, "content-length:", 15))
+            {
+                *size = strtoull(line + 15, NULL, 10);
+                found = true;
+                break;
+            }
+        free(headers);
+    }
+    emscripten_fetch_close(fetch);
+    return found;
+}
+
+// Reads at "offset" with an HTTP range request: fetch's read. A server that ignores the range sends the whole
+// file, which is cut down to it here. -1 on failure.
+static int64_t fetch_at(const char* url, void* buffer, uint32_t size, uint64_t offset)
+{
+    if (size == 0)
+        return 0;
+    char range[64];
+    snprintf(range, sizeof(range), "bytes=%llu-%llu", (unsigned long long)offset,
+        (unsigned long long)(offset + size - 1));
+    const char* headers[] = { "Range", range, NULL };
+    emscripten_fetch_t* fetch = fetch_request(url, "GET", headers);
+    if (!fetch)
+        return -1;
+    int64_t result = -1;
+    if (fetch->status == 206)
+    {
+        result = fetch->numBytes < size ? (int64_t)fetch->numBytes : (int64_t)size;
+        memcpy(buffer, fetch->data, (size_t)result);
+    }
+    else if (fetch->status == 200)
+    {
+        const uint64_t left = offset < fetch->numBytes ? fetch->numBytes - offset : 0;
+        result = left < size ? (int64_t)left : (int64_t)size;
+        memcpy(buffer, fetch->data + offset, (size_t)result);
+    }
+    else if (fetch->status == 416)
+        result = 0;     // wholly past the end
+    emscripten_fetch_close(fetch);
+    return result;
+}
+
+#endif
+
+// --- Thread pool ---
+
+// A pool worker's read of "r": pread, or fetch's range request
+static int64_t pool_read(const AsyncIo* io, intptr_t handle, const AsyncIoRead* r)
+{
+#ifdef ASYNC_IO_HAVE_FETCH
+    if (io->backend == ASYNC_IO_FETCH)
+        return fetch_at((const char*)handle, r->buffer, r->size, r->offset);
+#endif
+    return read_at(handle, r->buffer, r->size, r->offset);
+}
+
+static void worker_main(AsyncIo* io)
+{
+    ALLOC_TAG_SCOPE(ALLOC_TAG_STREAMING);
+    std::unique_lock<std::mutex> lock(io->mutex);
+    for (;;)
+    {
+        io->work.wait(lock, [io] { return io->stop || io->ready_count > 0; });
+        if (io->stop)
+            return;
+        const uint32_t slot = io->ready[io->ready_head];
+        io->ready_head = (io->ready_head + 1) % ASYNC_IO_MAX_DEPTH;
+        --io->ready_count;
+        const AsyncIoRead r = io->slots[slot].read;
+        const intptr_t handle = file_handle(io, r.file);
+        lock.unlock();
+        const int64_t result = handle == -1 ? -1 : pool_read(io, handle, &r);
+        lock.lock();
+        finish(io, slot, result);
+        io->done.notify_one();
+    }
+}
+
+// --- Scheduling ---
+
+// Moves queued reads into free slots, NOW first, prefetches leaving a quarter of the slots (at least one), and
+// starts them in one submission. Called with the lock held.
+static void dispatch(AsyncIo* io)
+{
+    const uint32_t reserved = io->depth > 1 ? (io->depth + 3) / 4 : 0;
+    uint32_t started = 0;
+    uint32_t slot = 0;
+    while (io->in_flight < io->depth)
+    {
+        AsyncIoQueue* q = &io->queued[ASYNC_IO_NOW];
+        if (q->count == 0)
+        {
+            q = &io->queued[ASYNC_IO_PREFETCH];
+            if (q->count == 0 || io->in_flight >= io->depth - reserved)
+                break;
+        }
+        while (io->slots[slot].busy)
+            ++slot;
+        AsyncIoSlot* s = &io->slots[slot];
+        s->read = q->reads[q->head];
+        s->read.done = 0;
+        s->busy = true;
+        q->head = (q->head + 1) % ASYNC_IO_MAX_QUEUED;
+        --q->count;
+        ++io->in_flight;
+
+        if (file_handle(io, s->read.file) == -1)
+        {
+            finish(io, slot, -1);
+            continue;
+        }
+        switch (io->backend)
+        {
+#ifdef ASYNC_IO_HAVE_URING
+        case ASYNC_IO_URING:
+            uring_queue(io, slot);
+            ++started;
+            break;
+#endif
+#ifdef _WIN32
+        case ASYNC_IO_OVERLAPPED:
+            overlapped_start(io, slot);
+            break;
+#endif
+        default:
+            io->ready[(io->ready_head + io->ready_count++) % ASYNC_IO_MAX_DEPTH] = slot;
+            ++started;
+            break;
+        }
+    }
+    if (!started)
+        return;
+    ++io->submissions;
+#ifdef ASYNC_IO_HAVE_URING
+    if (io->backend == ASYNC_IO_URING)
+        uring_flush(io, started);
+#endif
+    if (io->backend == ASYNC_IO_THREADS || io->backend == ASYNC_IO_FETCH)
+        io->work.notify_all();
+}
+
+bool async_io_init(AsyncIo* io, AsyncIoBackend backend, uint32_t depth, int threads)
+{
+    io->depth = depth < 1 ? 1 : depth > ASYNC_IO_MAX_DEPTH ? ASYNC_IO_MAX_DEPTH : depth;
+    for (int p = 0; p < ASYNC_IO_PRIORITIES; ++p)
+        io->queued[p].head = io->queued[p].count = 0;
+    memset(io->slots, 0, sizeof(io->slots));
+    io->in_flight = 0;
+    for (int f = 0; f < ASYNC_IO_MAX_FILES; ++f)
+        io->files[f] = -1;
+    io->finished_count = 0;
+    io->woken = false;
+    io->wake_pending = false;
+    io->thread_count = 0;
+    io->ready_head = io->ready_count = 0;
+    io->stop = false;
+    io->ring = -1;
+    memset(io->ring_memory, 0, sizeof(io->ring_memory));
+    io->port = NULL;
+    io->bytes_read = 0;
+    io->reads = 0;
+    io->submissions = 0;
+
+    AsyncIoBackend chosen = ASYNC_IO_THREADS;
+    const char* missing = NULL;
+#ifdef ASYNC_IO_HAVE_URING
+    if (backend == ASYNC_IO_AUTO || backend == ASYNC_IO_URING)
+    {
+        missing = uring_init(io);
+        if (!missing)
+            chosen = ASYNC_IO_URING;
+    }
+#else
+    if (backend == ASYNC_IO_URING)
+        missing = "not on this platform";
+#endif
+#ifdef _WIN32
+    if (backend == ASYNC_IO_AUTO || backend == ASYNC_IO_OVERLAPPED)
+    {
+        io->port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+        if (io->port)
+            chosen = ASYNC_IO_OVERLAPPED;
+        else
+            missing = "can't create a completion port";
+    }
+#else
+    if (backend == ASYNC_IO_OVERLAPPED)
+        missing = "not on this platform";
+#endif
+#ifdef ASYNC_IO_HAVE_FETCH
+    if (backend == ASYNC_IO_FETCH)
+        chosen = ASYNC_IO_FETCH;
+#else
+    if (backend == ASYNC_IO_FETCH)
+        missing = "not outside a browser";
+#endif
+    if (missing && backend != ASYNC_IO_AUTO)
+        fprintf(stderr, "Warning: async I/O with %s: %s; using threads\n", async_io_backend_name(backend), missing);
+    io->backend = chosen;
+
+    if (chosen == ASYNC_IO_THREADS || chosen == ASYNC_IO_FETCH)
+    {
+        const int count = threads < 1 ? 1 : threads > ASYNC_IO_MAX_THREADS ? ASYNC_IO_MAX_THREADS : threads;
+        for (; io->thread_count < count; ++io->thread_count)
+            io->threads[io->thread_count] = std::thread(worker_main, io);
+    }
+    return true;
+}
+
+void async_io_destroy(AsyncIo* io)
+{
+    {
+        std::lock_guard<std::mutex> lock(io->mutex);
+        for (int p = 0; p < ASYNC_IO_PRIORITIES; ++p)
+            io->queued[p].count = 0;
+    }
+    AsyncIoCompletion discard[ASYNC_IO_MAX_DEPTH];
+    while (async_io_outstanding(io) > 0)
+        async_io_poll(io, discard, ASYNC_IO_MAX_DEPTH, true);
+
+    {
+        std::lock_guard<std::mutex> lock(io->mutex);
+        io->stop = true;
+    }
+    io->work.notify_all();
+    for (int i = 0; i < io->thread_count; ++i)
+        io->threads[i].join();
+    io->thread_count = 0;
+#ifdef ASYNC_IO_HAVE_URING
+    uring_destroy(io);
+#endif
+#ifdef _WIN32
+    if (io->port)
+        CloseHandle((HANDLE)io->port);
+#endif
+    io->port = NULL;
+    for (int f = 0; f < ASYNC_IO_MAX_FILES; ++f)
+        async_io_close(io, f);
+}
+
+const char* async_io_backend_name(AsyncIoBackend backend)
+{
+    switch (backend)
+    {
+    case ASYNC_IO_AUTO: return "auto";
+    case ASYNC_IO_THREADS: return "threads";
+    case ASYNC_IO_URING: return "io_uring";
+    case ASYNC_IO_OVERLAPPED: return "overlapped";
+    case ASYNC_IO_FETCH: return "fetch";
+    }
+    return "?";
+}
+
+bool async_io_parse_backend(const char* text, AsyncIoBackend* backend)
+{
+    const char* names[5] = { "auto", "threads", "uring", "overlapped", "fetch" };
+    for (int b = 0; b < 5; ++b)
+        if (!strcmp(text, names[b]))
+        {
+            *backend = (AsyncIoBackend)b;
+            return true;
+        }
+    return false;
+}
+
+int async_io_open(AsyncIo* io, const char* path, bool direct, uint64_t* size)
+{
+    std::lock_guard<std::mutex> lock(io->mutex);
+    int file = 0;
+    while (file < ASYNC_IO_MAX_FILES && io->files[file] != -1)
+        ++file;
+    if (file == ASYNC_IO_MAX_FILES)
+    {
+        fprintf(stderr, "async_io: more than %d files open\n", ASYNC_IO_MAX_FILES);
+        return -1;
+    }
+#ifdef _WIN32
+    const DWORD flags = FILE_ATTRIBUTE_NORMAL | (io->backend == ASYNC_IO_OVERLAPPED ? FILE_FLAG_OVERLAPPED : 0)
+        | (direct ? FILE_FLAG_NO_BUFFERING : 0);
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+    LARGE_INTEGER bytes;
+    if (handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(handle, &bytes)
+        || (io->backend == ASYNC_IO_OVERLAPPED && !CreateIoCompletionPort(handle, (HANDLE)io->port, 1, 0)))
+    {
+        fprintf(stderr, "async_io: can't open %s (error %lu)\n", path, GetLastError());
+        if (handle != INVALID_HANDLE_VALUE)
+            CloseHandle(handle);
+        return -1;
+    }
+    io->files[file] = (intptr_t)handle;
+    *size = (uint64_t)bytes.QuadPart;
+#else
+#ifdef ASYNC_IO_HAVE_FETCH
+    if (io->backend == ASYNC_IO_FETCH)
+    {
+        char* url = strdup(path);
+        if (!url || !fetch_size(path, size))
+        {
+            fprintf(stderr, "async_io: can't fetch %s's size\n", path);
+            free(url);
+            return -1;
+        }
+        io->files[file] = (intptr_t)url;
+        return file;
+    }
+#endif
+    int flags = O_RDONLY;
+#ifdef O_DIRECT
+    if (direct)
+        flags |= O_DIRECT;
+#endif
+    const int fd = open(path, flags);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "async_io: can't open %s: %s\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    io->files[file] = fd;
+    *size = (uint64_t)st.st_size;
+#endif
+    return file;
+}
+
+void async_io_close(AsyncIo* io, int file)
+{
+    std::lock_guard<std::mutex> lock(io->mutex);
+    if (file < 0 || file >= ASYNC_IO_MAX_FILES || io->files[file] == -1)
+        return;
+#ifdef _WIN32
+    CloseHandle((HANDLE)io->files[file]);
+#else
+#ifdef ASYNC_IO_HAVE_FETCH
+    if (io->backend == ASYNC_IO_FETCH)
+        free((void*)io->files[file]);
+    else
+#endif
+    close((int)io->files[file]);
+#endif
+    io->files[file] = -1;
+}
+
+uint32_t async_io_submit(AsyncIo* io, const AsyncIoRead* reads, uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(io->mutex);
+    uint32_t queued = 0;
+    for (; queued < count; ++queued)
+    {
+        const uint32_t priority = reads[queued].priority < ASYNC_IO_PRIORITIES ? reads[queued].priority : (uint32_t)ASYNC_IO_PREFETCH;
+        AsyncIoQueue* q = &io->queued[priority];
+        if (q->count == ASYNC_IO_MAX_QUEUED)
+            break;
+        q->reads[(q->head + q->count++) % ASYNC_IO_MAX_QUEUED] = reads[queued];
+    }
+    dispatch(io);
+    return queued;
+}
+
+uint32_t async_io_poll(AsyncIo* io, AsyncIoCompletion* out, uint32_t max, bool wait)
+{
+    std::unique_lock<std::mutex> lock(io->mutex);
+    for (;;)
+    {
+        uint32_t n = 0;
+        uint32_t taken = 0;
+        for (; taken < io->finished_count && n < max; ++taken)
+            out[n++] = complete(io, io->finished[taken].slot, io->finished[taken].result);
+        io->finished_count -= taken;
+        memmove(io->finished, io->finished + taken, sizeof(AsyncIoFinished) * io->finished_count);
+#ifdef ASYNC_IO_HAVE_URING
+        if (io->backend == ASYNC_IO_URING)
+            n += uring_reap(io, out + n, max - n);
+#endif
+#ifdef _WIN32
+        OVERLAPPED_ENTRY entries[ASYNC_IO_MAX_DEPTH + 1];
+        if (io->backend == ASYNC_IO_OVERLAPPED && n < max)
+        {
+            lock.unlock();
+            const ULONG got = overlapped_dequeue(io, entries, max - n < ASYNC_IO_MAX_DEPTH ? max - n : ASYNC_IO_MAX_DEPTH, 0);
+            lock.lock();
+            n += overlapped_process(io, entries, got, out + n);
+        }
+#endif
+        if (n)
+            dispatch(io);
+        if (n || !wait || io->woken || max == 0)
+        {
+            io->woken = false;
+            return n;
+        }
+
+        // Nothing yet: wait for the backend, without the lock where it waits in the kernel
+        switch (io->backend)
+        {
+#ifdef ASYNC_IO_HAVE_URING
+        case ASYNC_IO_URING:
+            lock.unlock();
+            uring_enter(io->ring, 0, 1);
+            lock.lock();
+            break;
+#endif
+#ifdef _WIN32
+        case ASYNC_IO_OVERLAPPED:
+        {
+            lock.unlock();
+            const ULONG got = overlapped_dequeue(io, entries, max < ASYNC_IO_MAX_DEPTH ? max : ASYNC_IO_MAX_DEPTH, INFINITE);
+            lock.lock();
+            n = overlapped_process(io, entries, got, out);
+            if (n)
+            {
+                dispatch(io);
+                io->woken = false;
+                return n;
+            }
+            break;
+        }
+#endif
+        default:
+            io->done.wait(lock, [io] { return io->finished_count > 0 || io->woken; });
+            break;
+        }
+    }
+}
+
+// Gets a poll that's waiting to look again: a no-op through the ring, a packet through the port, or the condition
+// variable. Called with the lock held.
+static void signal_poller(AsyncIo* io)
+{
+    switch (io->backend)
+    {
+#ifdef ASYNC_IO_HAVE_URING
+    case ASYNC_IO_URING:
+        if (!io->wake_pending)
+        {
+            io->wake_pending = true;
+            uring_queue(io, WAKE_TAG);
+            uring_flush(io, 1);
+        }
+        break;
+#endif
+#ifdef _WIN32
+    case ASYNC_IO_OVERLAPPED:
+        if (!io->wake_pending)
+            io->wake_pending = PostQueuedCompletionStatus((HANDLE)io->port, 0, (ULONG_PTR)WAKE_TAG, NULL) != 0;
+        break;
+#endif
+    default:
+        io->done.notify_all();
+        break;
+    }
+}
+
+void async_io_wake(AsyncIo* io)
+{
+    std::lock_guard<std::mutex> lock(io->mutex);
+    io->woken = true;
+    signal_poller(io);
+}
+
+uint32_t async_io_outstanding(AsyncIo* io)
+{
+    std::lock_guard<std::mutex> lock(io->mutex);
+    return io->in_flight + io->queued[ASYNC_IO_NOW].count + io->queued[ASYNC_IO_PREFETCH].count;
+}
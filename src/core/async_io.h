@@ -0,0 +1,178 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+
+// Asynchronous file reads for asset streaming, so one thread keeps the disk
+// busy with many reads in flight instead of blocking on one at a time.
+//
+// Reads are submitted in batches (async_io_submit) and their completions
+// collected with async_io_poll, which hands back each read's tag. At most
+// "depth" reads are in flight; the rest wait in a queue per priority class,
+// and a free slot always goes to a ASYNC_IO_NOW read (what's visible this
+// frame) before a ASYNC_IO_PREFETCH one. Prefetches never take the last
+// quarter of the slots, so a read that's needed now doesn't wait behind a
+// queue full of them.
+//
+// Four backends do the reading:
+//  - io_uring (Linux): a batch is written into the submission ring and
+//    handed to the kernel with one io_uring_enter, which is also how a poll
+//    waits. The rings are set up with the raw system calls, no liburing.
+//  - overlapped I/O (Windows): each read is a ReadFile with an OVERLAPPED,
+//    completing to an I/O completion port that a poll waits on.
+//  - a thread pool, anywhere else or when the others can't start (an old
+//    kernel, or io_uring disabled): workers pread the reads one each.
+//  - fetch (Emscripten, asked for by name): the same pool, its workers
+//    making each read an HTTP range request for the file's URL, relative to
+//    the page, so a browser streams assets from the server as they're
+//    needed rather than downloading them all before the first frame. The
+//    requests are synchronous, which browsers allow on workers only:
+//    async_io_open, which asks for the file's size, must be called off the
+//    main thread too.
+// A short read is continued until the read is complete or at the file's end,
+// so a completion's result is the whole size unless it reached the end.
+//
+// Files opened with "direct" bypass the OS cache (O_DIRECT,
+// FILE_FLAG_NO_BUFFERING): offsets, sizes and buffers must then be multiples
+// of the device's sector size - asset packages' 4 KB blocks are.
+//
+// Threading: async_io_submit and async_io_wake may be called from any thread,
+// async_io_poll from one thread at a time.
+
+#define ASYNC_IO_MAX_DEPTH 64       // reads in flight
+#define ASYNC_IO_MAX_QUEUED 1024    // reads waiting for a slot, per priority
+#define ASYNC_IO_MAX_FILES 64
+#define ASYNC_IO_MAX_THREADS 8      // thread pool backend
+
+typedef enum AsyncIoBackend
+{
+    ASYNC_IO_AUTO,              // io_uring or overlapped I/O where there is one, else threads
+    ASYNC_IO_THREADS,
+    ASYNC_IO_URING,
+    ASYNC_IO_OVERLAPPED,
+    ASYNC_IO_FETCH
+} AsyncIoBackend;
+
+typedef enum AsyncIoPriority
+{
+    ASYNC_IO_NOW,               // needed for what's on screen
+    ASYNC_IO_PREFETCH,          // needed soon
+    ASYNC_IO_PRIORITIES
+} AsyncIoPriority;
+
+typedef struct AsyncIoRead
+{
+    int file;                   // from async_io_open
+    uint32_t size;
+    uint64_t offset;
+    void* buffer;               // "size" bytes, valid until the read completes
+    uint64_t tag;               // handed back with its completion
+    uint32_t priority;          // AsyncIoPriority
+    uint32_t done;              // bytes read so far; 0 when submitted
+} AsyncIoRead;
+
+typedef struct AsyncIoCompletion
+{
+    uint64_t tag;
+    int64_t result;             // bytes read (fewer than asked only at the end of the file), or -1 on failure
+} AsyncIoCompletion;
+
+// A read done outside the backend's own completions (by the pool, or failed before it started)
+typedef struct AsyncIoFinished
+{
+    uint32_t slot;
+    int64_t result;
+} AsyncIoFinished;
+
+typedef struct AsyncIoSlot
+{
+    uint64_t overlapped[4];     // Windows: the read's OVERLAPPED
+    AsyncIoRead read;
+    bool busy;
+} AsyncIoSlot;
+
+// FIFO of reads waiting for a slot
+typedef struct AsyncIoQueue
+{
+    AsyncIoRead reads[ASYNC_IO_MAX_QUEUED];
+    uint32_t head;
+    uint32_t count;
+} AsyncIoQueue;
+
+typedef struct AsyncIo
+{
+    AsyncIoBackend backend;     // the one running, never ASYNC_IO_AUTO
+    uint32_t depth;
+    std::mutex mutex;           // everything below
+    AsyncIoQueue queued[ASYNC_IO_PRIORITIES];
+    AsyncIoSlot slots[ASYNC_IO_MAX_DEPTH];
+    uint32_t in_flight;         // slots busy, completions not yet polled included
+    intptr_t files[ASYNC_IO_MAX_FILES];     // fd, HANDLE or (fetch) the URL, -1 when free
+    AsyncIoFinished finished[ASYNC_IO_MAX_DEPTH];   // in completion order
+    uint32_t finished_count;
+    bool woken;                 // async_io_wake since the last poll returned
+    bool wake_pending;          // a wake-up is on its way through the backend
+
+    // Thread pool, and fetch's
+    std::thread threads[ASYNC_IO_MAX_THREADS];
+    int thread_count;
+    uint32_t ready[ASYNC_IO_MAX_DEPTH];     // slots waiting for a worker, FIFO
+    uint32_t ready_head;
+    uint32_t ready_count;
+    std::condition_variable work;   // a slot is ready, or stop
+    std::condition_variable done;   // a read finished, or a wake
+    bool stop;
+
+    // io_uring
+    int ring;
+    void* ring_memory[3];       // the submission ring, the completion ring (may be the same) and the entries
+    size_t ring_sizes[3];
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_array;
+    uint32_t sq_mask;
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t cq_mask;
+    void* sqes;                 // io_uring_sqe[]
+    void* cqes;                 // io_uring_cqe[]
+
+    // Overlapped I/O
+    void* port;                 // the completion port HANDLE
+
+    // Totals, for reporting
+    uint64_t bytes_read;
+    uint32_t reads;
+    uint32_t submissions;       // system calls that submitted reads (a batch is one with io_uring)
+} AsyncIo;
+
+// Starts "backend" (falling back to threads, with a message, when it isn't available here) with "depth" reads in
+// flight at most (1 to ASYNC_IO_MAX_DEPTH) and "threads" workers for the pool. Returns false when nothing starts.
+bool async_io_init(AsyncIo* io, AsyncIoBackend backend, uint32_t depth, int threads);
+// Waits for the reads in flight; queued ones are dropped
+void async_io_destroy(AsyncIo* io);
+
+const char* async_io_backend_name(AsyncIoBackend backend);
+// "auto", "threads", "uring", "overlapped" or "fetch"; false for anything else
+bool async_io_parse_backend(const char* text, AsyncIoBackend* backend);
+
+// Opens "path" for reading and stores its size. Returns the file, or -1 (logged).
+int async_io_open(AsyncIo* io, const char* path, bool direct, uint64_t* size);
+// Closes a file with no reads in flight or queued
+void async_io_close(AsyncIo* io, int file);
+
+// Queues "count" reads and starts as many as there are free slots for, in one submission where the backend
+// allows. Returns how many were queued: fewer than "count" when a priority's queue is full.
+uint32_t async_io_submit(AsyncIo* io, const AsyncIoRead* reads, uint32_t count);
+
+// Up to "max" completions into "out". With "wait", blocks until there is one or async_io_wake is called.
+uint32_t async_io_poll(AsyncIo* io, AsyncIoCompletion* out, uint32_t max, bool wait);
+
+// Makes a poll that's waiting (or the next one) return, with nothing if nothing has completed
+void async_io_wake(AsyncIo* io);
+
+// Reads submitted and not yet handed back by a poll
+uint32_t async_io_outstanding(AsyncIo* io);
@@ -0,0 +1,98 @@
+#include "core/bit_stream.h"
+
+void bit_writer_init(BitWriter* w, void* data, size_t capacity)
+{
+    w->data = (uint8_t*)data;
+    w->capacity = capacity;
+    w->bits = 0;
+    w->overflow = false;
+}
+
+void bit_write(BitWriter* w, uint32_t value, int count)
+{
+    if (w->overflow || w->bits + (size_t)count > 8 * w->capacity)
+    {
+        w->overflow = true;
+        return;
+    }
+    uint64_t v = count < 32 ? value & ((1u << count) - 1u) : value;
+    while (count > 0)
+    {
+        const size_t byte = w->bits >> 3;
+        const int offset = (int)(w->bits & 7);
+        const int take = 8 - offset < count ? 8 - offset : count;
+        // The bits above "offset" are cleared as they're written, so a writer wound back writes over stale ones
+        const uint8_t below = (uint8_t)((1u << offset) - 1u);
+        w->data[byte] = (uint8_t)((w->data[byte] & below) | ((v & ((1u << take) - 1u)) << offset));
+        v >>= take;
+        count -= take;
+        w->bits += (size_t)take;
+    }
+}
+
+// value + 1 as n: floor(log2(n)) zeros, a one, then n's bits below its top one
+void bit_write_gamma(BitWriter* w, uint32_t value)
+{
+    const uint64_t n = (uint64_t)value + 1;
+    int length = 0;
+    while ((n >> (length + 1)) != 0)
+        ++length;
+    bit_write(w, 0, length);
+    bit_write(w, 1, 1);
+    bit_write(w, (uint32_t)(n & ((1ull << length) - 1)), length);
+}
+
+void bit_write_signed(BitWriter* w, int32_t value)
+{
+    bit_write_gamma(w, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+void bit_reader_init(BitReader* r, const void* data, size_t size)
+{
+    r->data = (const uint8_t*)data;
+    r->size = size;
+    r->bits = 0;
+    r->overflow = false;
+}
+
+uint32_t bit_read(BitReader* r, int count)
+{
+    if (r->overflow || r->bits + (size_t)count > 8 * r->size)
+    {
+        r->overflow = true;
+        return 0;
+    }
+    uint64_t value = 0;
+    int shift = 0;
+    while (shift < count)
+    {
+        const size_t byte = r->bits >> 3;
+        const int offset = (int)(r->bits & 7);
+        const int take = 8 - offset < count - shift ? 8 - offset : count - shift;
+        value |= (uint64_t)((r->data[byte] >> offset) & ((1u << take) - 1u)) << shift;
+        shift += take;
+        r->bits += (size_t)take;
+    }
+    return (uint32_t)value;
+}
+
+uint32_t bit_read_gamma(BitReader* r)
+{
+    int length = 0;
+    while (!bit_read(r, 1))
+    {
+        if (r->overflow || ++length > 32)
+        {
+            r->overflow = true;
+            return 0;
+        }
+    }
+    const uint64_t n = (1ull << length) | bit_read(r, length);
+    return (uint32_t)(n - 1);
+}
+
+int32_t bit_read_signed(BitReader* r)
+{
+    const uint32_t u = bit_read_gamma(r);
+    return (int32_t)((u >> 1) ^ (0u - (u & 1u)));
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bits packed into bytes least significant first, for messages whose fields
+// are narrower than whole bytes: scene/replication.h's deltas. The bytes
+// come out the same on any host, whatever its byte order.
+//
+// Writing past the capacity sets "overflow" and drops the bits, and reading
+// past the end sets it and reads zeros, so a caller checks once when it's
+// done rather than after every field. A writer can be wound back to an
+// earlier bit count (to drop a field that didn't fit) and written on from
+// there.
+//
+// Elias gamma codes make small numbers short: 0 takes 1 bit, 1-2 take 3,
+// 3-6 take 5, and v in general 2 floor(log2(v + 1)) + 1. Signed values are
+// zigzagged first (0, -1, 1, -2, ... to 0, 1, 2, 3, ...), so a small change
+// either way is a few bits.
+
+typedef struct BitWriter
+{
+    uint8_t* data;
+    size_t capacity;            // bytes
+    size_t bits;                // written so far
+    bool overflow;
+} BitWriter;
+
+typedef struct BitReader
+{
+    const uint8_t* data;
+    size_t size;                // bytes
+    size_t bits;                // read so far
+    bool overflow;
+} BitReader;
+
+void bit_writer_init(BitWriter* w, void* data, size_t capacity);
+
+// The low "count" bits of "value", 0-32 of them
+void bit_write(BitWriter* w, uint32_t value, int count);
+void bit_write_gamma(BitWriter* w, uint32_t value);
+void bit_write_signed(BitWriter* w, int32_t value);
+
+// Bytes written, the last one partly
+static inline size_t bit_writer_bytes(const BitWriter* w)
+{
+    return (w->bits + 7) / 8;
+}
+
+void bit_reader_init(BitReader* r, const void* data, size_t size);
+uint32_t bit_read(BitReader* r, int count);
+uint32_t bit_read_gamma(BitReader* r);
+int32_t bit_read_signed(BitReader* r);
@@ -0,0 +1,367 @@
+#include "core/buffer_heap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define NONE BUFFER_HEAP_NONE
+
+// Index of the highest / lowest set bit of "x" (not 0)
+static int highest_bit(uint32_t x)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse(&i, x);
+    return (int)i;
+#else
+    return 31 - __builtin_clz(x);
+#endif
+}
+
+static int lowest_bit(uint32_t x)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (int)i;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+// The list a free block of "size" goes in; below BUFFER_HEAP_SUBCLASSES * 2 every size has a list of its own
+static void size_class(uint32_t size, int* f, int* s)
+{
+    if (size < BUFFER_HEAP_SUBCLASSES)
+    {
+        *f = 0;
+        *s = (int)size;
+        return;
+    }
+    const int bit = highest_bit(size);
+    *f = bit - BUFFER_HEAP_SUBCLASS_BITS + 1;
+    *s = (int)((size >> (bit - BUFFER_HEAP_SUBCLASS_BITS)) ^ BUFFER_HEAP_SUBCLASSES);
+}
+
+static uint32_t take_record(BufferHeap* heap)
+{
+    const uint32_t i = heap->unused;
+    if (i != NONE)
+        heap->unused = heap->blocks[i].next_free;
+    return i;
+}
+
+static void give_record(BufferHeap* heap, uint32_t i)
+{
+    heap->blocks[i].free = true;    // a stale handle to it frees nothing
+    heap->blocks[i].next_free = heap->unused;
+    heap->unused = i;
+}
+
+static void insert_free(BufferHeap* heap, uint32_t i)
+{
+    BufferHeapBlock* b = &heap->blocks[i];
+    int f, s;
+    size_class(b->size, &f, &s);
+    b->free = true;
+    b->prev_free = NONE;
+    b->next_free = heap->lists[f][s];
+    if (b->next_free != NONE)
+        heap->blocks[b->next_free].prev_free = i;
+    heap->lists[f][s] = i;
+    heap->subclass_bitmaps[f] |= 1u << s;
+    heap->class_bitmap |= 1u << f;
+    ++heap->free_blocks;
+}
+
+static void remove_free(BufferHeap* heap, uint32_t i)
+{
+    BufferHeapBlock* b = &heap->blocks[i];
+    int f, s;
+    size_class(b->size, &f, &s);
+    if (b->prev_free != NONE)
+        heap->blocks[b->prev_free].next_free = b->next_free;
+    else
+        heap->lists[f][s] = b->next_free;
+    if (b->next_free != NONE)
+        heap->blocks[b->next_free].prev_free = b->prev_free;
+    if (heap->lists[f][s] == NONE)
+    {
+        heap->subclass_bitmaps[f] &= ~(1u << s);
+        if (!heap->subclass_bitmaps[f])
+            heap->class_bitmap &= ~(1u << f);
+    }
+    b->free = false;
+    --heap->free_blocks;
+}
+
+bool buffer_heap_init(BufferHeap* heap, uint32_t capacity, uint32_t max_allocations)
+{
+    memset(heap, 0, sizeof(*heap));
+    for (int f = 0; f < BUFFER_HEAP_CLASSES; ++f)
+        for (int s = 0; s < BUFFER_HEAP_SUBCLASSES; ++s)
+            heap->lists[f][s] = NONE;
+    // Every allocation can split a free block in two, and the free blocks sit between allocations
+    heap->block_capacity = 2 * max_allocations + 1;
+    heap->blocks = (BufferHeapBlock*)malloc(sizeof(BufferHeapBlock) * heap->block_capacity);
+    if (!heap->blocks || !capacity)
+    {
+        if (capacity)
+            fprintf(stderr, "buffer_heap: out of memory for %u allocations\n", max_allocations);
+        free(heap->blocks);
+        heap->blocks = NULL;
+        return false;
+    }
+    heap->capacity = capacity;
+    for (uint32_t i = 0; i < heap->block_capacity; ++i)
+        heap->blocks[i].next_free = i + 1 < heap->block_capacity ? i + 1 : NONE;
+    heap->unused = 0;
+    // The whole range starts as one free block
+    const uint32_t all = take_record(heap);
+    heap->blocks[all] = { 0, capacity, NONE, NONE, NONE, NONE, false };
+    heap->first = all;
+    insert_free(heap, all);
+    return true;
+}
+
+void buffer_heap_destroy(BufferHeap* heap)
+{
+    free(heap->blocks);
+    memset(heap, 0, sizeof(*heap));
+}
+
+// A free block of at least "size", or NONE: the first list of a class whose every block is big enough. Failing
+// that, the head of the list "size" itself falls in, which can still fit (an exact fit of the whole range does).
+static uint32_t find_free(const BufferHeap* heap, uint32_t size)
+{
+    int f, s;
+    uint64_t rounded = size;
+    if (size >= BUFFER_HEAP_SUBCLASSES)
+        rounded += (1ull << (highest_bit(size) - BUFFER_HEAP_SUBCLASS_BITS)) - 1;
+    if (rounded <= 0xFFFFFFFFull)
+    {
+        size_class((uint32_t)rounded, &f, &s);
+        uint32_t subclasses = heap->subclass_bitmaps[f] & (~0u << s);
+        if (!subclasses)
+        {
+            const uint32_t classes = heap->class_bitmap & (~0u << (f + 1));
+            if (classes)
+            {
+                f = lowest_bit(classes);
+                subclasses = heap->subclass_bitmaps[f];
+            }
+        }
+        if (subclasses)
+            return heap->lists[f][lowest_bit(subclasses)];
+    }
+    size_class(size, &f, &s);
+    const uint32_t head = heap->lists[f][s];
+    return head != NONE && heap->blocks[head].size >= size ? head : NONE;
+}
+
+uint32_t buffer_heap_alloc(BufferHeap* heap, uint32_t size, uint32_t* offset)
+{
+    if (!heap->blocks || size == 0)
+        return NONE;
+    const uint32_t i = heap->allocations * 2 + 1 < heap->block_capacity ? find_free(heap, size) : NONE;
+    if (i == NONE)
+    {
+        ++heap->failed;
+        return NONE;
+    }
+    remove_free(heap, i);
+    BufferHeapBlock* b = &heap->blocks[i];
+    if (b->size > size)
+    {
+        // The rest stays free, right after it
+        const uint32_t r = take_record(heap);
+        b = &heap->blocks[i];
+        heap->blocks[r] = { b->offset + size, b->size - size, i, b->next, NONE, NONE, false };
+        if (b->next != NONE)
+            heap->blocks[b->next].prev = r;
+        b->next = r;
+        b->size = size;
+        insert_free(heap, r);
+    }
+    heap->used += size;
+    ++heap->allocations;
+    *offset = b->offset;
+    return i;
+}
+
+// Lists the block as free, merged with free neighbours on either side, so no two free blocks are ever adjacent
+static void release(BufferHeap* heap, uint32_t handle)
+{
+    BufferHeapBlock* b = &heap->blocks[handle];
+    const uint32_t prev = b->prev;
+    if (prev != NONE && heap->blocks[prev].free)
+    {
+        remove_free(heap, prev);
+        BufferHeapBlock* p = &heap->blocks[prev];
+        p->size += b->size;
+        p->next = b->next;
+        if (b->next != NONE)
+            heap->blocks[b->next].prev = prev;
+        give_record(heap, handle);
+        handle = prev;
+        b = p;
+    }
+    const uint32_t next = b->next;
+    if (next != NONE && heap->blocks[next].free)
+    {
+        remove_free(heap, next);
+        BufferHeapBlock* n = &heap->blocks[next];
+        b->size += n->size;
+        b->next = n->next;
+        if (n->next != NONE)
+            heap->blocks[n->next].prev = handle;
+        give_record(heap, next);
+    }
+    insert_free(heap, handle);
+}
+
+void buffer_heap_free(BufferHeap* heap, uint32_t handle)
+{
+    if (handle >= heap->block_capacity || heap->blocks[handle].free)
+        return;
+    heap->used -= heap->blocks[handle].size;
+    --heap->allocations;
+    release(heap, handle);
+}
+
+// Allocation "a" into the front of free block "f" below it. The two records trade places, so "a" keeps its handle
+// and "f" becomes the space "a" left, freed; what "a" doesn't fill of "f" stays free after it.
+static void relocate(BufferHeap* heap, uint32_t a, uint32_t f)
+{
+    remove_free(heap, f);
+    BufferHeapBlock* blocks = heap->blocks;
+    const BufferHeapBlock at_a = blocks[a], at_f = blocks[f];
+    const uint32_t size = at_a.size;
+    blocks[a].offset = at_f.offset;
+    blocks[a].size = at_f.size;
+    blocks[a].prev = at_f.prev;
+    blocks[a].next = at_f.next;
+    blocks[f].offset = at_a.offset;
+    blocks[f].size = at_a.size;
+    blocks[f].prev = at_a.prev;
+    blocks[f].next = at_a.next;
+    // Next to each other, they still point at the places they left
+    const uint32_t records[2] = { a, f };
+    for (uint32_t i : records)
+    {
+        BufferHeapBlock* b = &blocks[i];
+        b->prev = b->prev == a ? f : b->prev == f ? a : b->prev;
+        b->next = b->next == a ? f : b->next == f ? a : b->next;
+    }
+    for (uint32_t i : records)
+    {
+        const BufferHeapBlock* b = &blocks[i];
+        if (b->prev != NONE)
+            blocks[b->prev].next = i;
+        else
+            heap->first = i;
+        if (b->next != NONE)
+            blocks[b->next].prev = i;
+    }
+    if (blocks[a].size > size)
+    {
+        const uint32_t rest = take_record(heap);
+        blocks[rest] = { blocks[a].offset + size, blocks[a].size - size, a, blocks[a].next, NONE, NONE, false };
+        if (blocks[a].next != NONE)
+            blocks[blocks[a].next].prev = rest;
+        blocks[a].next = rest;
+        blocks[a].size = size;
+        insert_free(heap, rest);
+    }
+    release(heap, f);
+}
+
+uint32_t buffer_heap_defrag(BufferHeap* heap, uint32_t max_units, BufferHeapMove* moves, uint32_t max_moves)
+{
+    if (!heap->blocks)
+        return 0;
+    // In address order, the lowest free block and the last one passed
+    uint32_t count = 0, lowest = NONE, last = NONE;
+    uint64_t units = 0;
+    for (uint32_t i = heap->first; i != NONE && count < max_moves; i = heap->blocks[i].next)
+    {
+        const BufferHeapBlock* b = &heap->blocks[i];
+        if (b->free)
+        {
+            lowest = lowest == NONE ? i : lowest;
+            last = i;
+            continue;
+        }
+        if (count && units + b->size > max_units)
+            continue;
+        const uint32_t size = b->size;
+        uint32_t into = lowest != NONE && heap->blocks[lowest].size >= size ? lowest
+            : last != NONE && heap->blocks[last].size >= size ? last : NONE;
+        if (into == NONE && last != NONE && b->prev == last && count + 2 <= max_moves
+            && units + 2ull * size <= (count ? max_units : 2ull * size))
+        {
+            // The free piece just before is too small to slide into without the copy overlapping itself: it goes by
+            // way of the top free piece, and the two together slide it down
+            uint32_t top = b->next;
+            while (top != NONE && heap->blocks[top].next != NONE)
+                top = heap->blocks[top].next;
+            if (top == NONE || !heap->blocks[top].free || heap->blocks[top].size < size || heap->unused == NONE)
+                continue;
+            moves[count++] = { i, b->offset, heap->blocks[top].offset, size };
+            units += size;
+            relocate(heap, i, top);
+            into = last;    // merged with the place it left
+        }
+        if (into == NONE || (heap->blocks[into].size > size && heap->unused == NONE))
+            continue;
+        moves[count++] = { i, heap->blocks[i].offset, heap->blocks[into].offset, size };
+        units += size;
+        relocate(heap, i, into);
+        // The walk carries on from the allocation's new place, which passes whatever is left of "into" again
+        lowest = into == lowest ? NONE : lowest;
+        last = NONE;
+    }
+    heap->moves += count;
+    heap->moved_units += units;
+    return count;
+}
+
+uint32_t buffer_heap_offset(const BufferHeap* heap, uint32_t handle)
+{
+    return heap->blocks[handle].offset;
+}
+
+uint32_t buffer_heap_size(const BufferHeap* heap, uint32_t handle)
+{
+    return heap->blocks[handle].size;
+}
+
+uint32_t buffer_heap_largest_free(const BufferHeap* heap)
+{
+    if (!heap->class_bitmap)
+        return 0;
+    // The highest non-empty list holds it; its blocks differ in size within the list's step
+    const int f = highest_bit(heap->class_bitmap);
+    const int s = highest_bit(heap->subclass_bitmaps[f]);
+    uint32_t largest = 0;
+    for (uint32_t i = heap->lists[f][s]; i != NONE; i = heap->blocks[i].next_free)
+        largest = heap->blocks[i].size > largest ? heap->blocks[i].size : largest;
+    return largest;
+}
+
+float buffer_heap_fragmentation(const BufferHeap* heap)
+{
+    const uint32_t free_units = heap->capacity - heap->used;
+    return free_units ? (float)((double)(free_units - buffer_heap_largest_free(heap)) / free_units) : 0.f;
+}
+
+void buffer_heap_print(const BufferHeap* heap, const char* name, FILE* out)
+{
+    fprintf(out, "%s: %u of %u used in %u allocations, %u free in %u pieces (%.1f%% outside the largest), "
+        "%llu refused, %llu moved (%llu units)\n", name, heap->used, heap->capacity, heap->allocations, heap->capacity - heap->used,
+        heap->free_blocks, 100.0 * buffer_heap_fragmentation(heap), (unsigned long long)heap->failed,
+        (unsigned long long)heap->moves, (unsigned long long)heap->moved_units);
+}
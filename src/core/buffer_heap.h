@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Sub-allocation of one large range: a TLSF (two-level segregated fit)
+// allocator that hands out pieces of a GPU buffer without touching GL.
+// gl/mesh_heap.h packs many meshes' vertices and indices into a few big
+// buffers with it.
+//
+// Sizes and offsets are in the caller's units (vertices of one stride,
+// indices of one type), not bytes, so a piece's offset is directly a
+// draw's baseVertex or firstIndex and nothing needs aligning.
+//
+// Free pieces sit in lists by size class: a first level per power of two,
+// split into BUFFER_HEAP_SUBCLASSES linear steps. A bitmap of the non-empty
+// lists at each level finds a free piece that is big enough in a couple of
+// bit scans, so allocating and freeing take constant time whatever the
+// heap holds. The request is rounded up to the next class before the
+// search, so any piece found fits without walking a list; only when that
+// finds nothing is the head of the unrounded class tried. A piece larger
+// than the request is split and the rest goes back as a free piece, and a
+// freed piece merges with free neighbours at once, so free space never
+// stays fragmented into adjacent pieces.
+//
+// The pieces' records come from a pool sized at init: "max_allocations" live
+// allocations at most, which is also what bounds the free pieces between
+// them. Not thread-safe.
+//
+// Merging keeps free space in as few pieces as the live allocations allow,
+// but weeks of loads and unloads still leave it scattered in gaps too small
+// for the next big mesh. buffer_heap_defrag compacts a little at a time: it
+// moves live allocations down into the free pieces below them and returns
+// the moves, for the owner to copy the data (gl/mesh_heap.h does it with
+// glCopyBufferSubData) before anything reads the new offsets. A handle stays
+// the allocation's across a move; only its offset changes, so whoever looks
+// offsets up through handles rather than keeping them needs no telling.
+
+#define BUFFER_HEAP_SUBCLASS_BITS 4
+#define BUFFER_HEAP_SUBCLASSES (1 << BUFFER_HEAP_SUBCLASS_BITS)
+#define BUFFER_HEAP_CLASSES 29          // first-level classes: sizes below 2^32
+#define BUFFER_HEAP_NONE 0xFFFFFFFFu
+
+typedef struct BufferHeapBlock
+{
+    uint32_t offset;
+    uint32_t size;
+    uint32_t prev;              // the blocks next to it in the range, BUFFER_HEAP_NONE at either end
+    uint32_t next;
+    uint32_t prev_free;         // in its size class's list while it's free; "next_free" also links the unused records
+    uint32_t next_free;
+    bool free;
+} BufferHeapBlock;
+
+typedef struct BufferHeap
+{
+    uint32_t capacity;          // units in the range
+    BufferHeapBlock* blocks;
+    uint32_t block_capacity;
+    uint32_t unused;            // first record not in use, BUFFER_HEAP_NONE when the pool is empty
+    uint32_t class_bitmap;      // bit f: some list of class f holds a free block
+    uint32_t subclass_bitmaps[BUFFER_HEAP_CLASSES];
+    uint32_t lists[BUFFER_HEAP_CLASSES][BUFFER_HEAP_SUBCLASSES];
+    uint32_t used;              // units allocated
+    uint32_t allocations;       // live
+    uint32_t free_blocks;
+    uint32_t first;             // the block at offset 0
+    uint64_t failed;            // allocations refused since init: no free piece fits, or no record left
+    uint64_t moves;             // allocations buffer_heap_defrag moved since init
+    uint64_t moved_units;
+} BufferHeap;
+
+typedef struct BufferHeapMove
+{
+    uint32_t handle;
+    uint32_t from;              // its offset before the move
+    uint32_t to;                // and after: [to, to + size) never overlaps [from, from + size)
+    uint32_t size;
+} BufferHeapMove;
+
+// A heap over units [0, capacity). Logs and returns false when out of memory.
+bool buffer_heap_init(BufferHeap* heap, uint32_t capacity, uint32_t max_allocations);
+void buffer_heap_destroy(BufferHeap* heap);
+
+// "size" units (at least 1): returns the allocation's handle and its first unit in "offset", or BUFFER_HEAP_NONE
+uint32_t buffer_heap_alloc(BufferHeap* heap, uint32_t size, uint32_t* offset);
+void buffer_heap_free(BufferHeap* heap, uint32_t handle);
+
+uint32_t buffer_heap_offset(const BufferHeap* heap, uint32_t handle);
+uint32_t buffer_heap_size(const BufferHeap* heap, uint32_t handle);
+
+// The largest allocation that would succeed now: the largest free piece
+uint32_t buffer_heap_largest_free(const BufferHeap* heap);
+
+// The share of free space outside the largest free piece: 0 when it's all in one, near 1 when it's in crumbs
+float buffer_heap_fragmentation(const BufferHeap* heap);
+
+// Up to "max_moves" moves of live allocations into free pieces at lower offsets, each applied to the heap as it's
+// written to "moves"; the data is the caller's to copy, in order, since a later move can land where an earlier one
+// left. Together they move at most "max_units" units, bar a first move that is bigger on its own. An allocation goes
+// into the lowest free piece it fits in, else the free piece just before it; one too big for the free piece just
+// before it goes up into the top free piece and back down, two moves that slide it down without either copy
+// overlapping itself. Returns the moves written: 0 once the free space is one piece at the top, or when nothing left
+// fits the budget or the record pool has no record spare for a split.
+uint32_t buffer_heap_defrag(BufferHeap* heap, uint32_t max_units, BufferHeapMove* moves, uint32_t max_moves);
+
+// Use, free pieces, the share of free space outside the largest one and the moves made to gather it
+void buffer_heap_print(const BufferHeap* heap, const char* name, FILE* out);
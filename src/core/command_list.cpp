@@ -0,0 +1,240 @@
+#include "core/command_list.h"
+
+#include "core/job_system.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define THREAD_SHIFT (COMMAND_LIST_CHUNK_BITS + 7)
+#define CHUNK_MASK ((1u << 7) - 1u)
+
+bool command_list_init(CommandList* list, size_t max_draws, int thread_count)
+{
+    list->thread_count = thread_count < 1 ? 1 : thread_count >= COMMAND_LIST_MAX_THREADS ? COMMAND_LIST_MAX_THREADS - 1 : thread_count;
+    list->failed.store(0, std::memory_order_relaxed);
+    // Every thread may leave up to a batch reserved and unfilled
+    if (!render_queue_init(&list->queue, max_draws + (size_t)(list->thread_count + 1) * COMMAND_LIST_BATCH))
+        return false;
+    list->arenas = (CommandArena*)calloc((size_t)list->thread_count + 1, sizeof(CommandArena));
+    if (!list->arenas)
+    {
+        fprintf(stderr, "command_list: out of memory\n");
+        render_queue_destroy(&list->queue);
+        return false;
+    }
+    return true;
+}
+
+void command_list_destroy(CommandList* list)
+{
+    for (int t = 0; list->arenas && t <= list->thread_count; ++t)
+        for (uint32_t c = 0; c < list->arenas[t].chunk_count; ++c)
+            free(list->arenas[t].chunks[c]);
+    free(list->arenas);
+    list->arenas = NULL;
+    render_queue_destroy(&list->queue);
+}
+
+void command_list_begin(CommandList* list)
+{
+    render_queue_clear(&list->queue);
+    for (int t = 0; t <= list->thread_count; ++t)
+    {
+        CommandArena* a = &list->arenas[t];
+        a->chunk = a->used = a->draws = 0;
+        a->batch = NULL;
+        a->batch_left = 0;
+    }
+}
+
+// The calling thread's arena: its job thread index, or the last one outside the job system
+static inline uint32_t arena_index(const CommandList* list)
+{
+    const int t = job_thread_current();
+    return t >= 0 && t < list->thread_count ? (uint32_t)t : (uint32_t)list->thread_count;
+}
+
+// A run of "count" commands (COMMAND_END added) in the calling thread's arena, its queue entry's payload in
+// "payload", or NULL (counted in "failed") when the arena is full
+static Command* record_run(CommandList* list, int count, uint32_t* payload)
+{
+    const uint32_t t = arena_index(list);
+    CommandArena* a = &list->arenas[t];
+    const uint32_t n = (uint32_t)(count < 0 ? 0 : count > COMMAND_LIST_MAX_RUN ? COMMAND_LIST_MAX_RUN : count) + 1;
+    if (a->chunk < a->chunk_count && a->used + n > COMMAND_LIST_CHUNK_SIZE)
+    {
+        ++a->chunk;     // runs don't straddle chunks
+        a->used = 0;
+    }
+    if (a->chunk == a->chunk_count)
+    {
+        Command* chunk = a->chunk_count < COMMAND_LIST_MAX_CHUNKS
+            ? (Command*)malloc(sizeof(Command) * COMMAND_LIST_CHUNK_SIZE) : NULL;
+        if (!chunk)
+        {
+            list->failed.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+        a->chunks[a->chunk_count++] = chunk;
+        a->used = 0;
+    }
+    Command* run = a->chunks[a->chunk] + a->used;
+    *payload = (t << THREAD_SHIFT) | (a->chunk << COMMAND_LIST_CHUNK_BITS) | a->used;
+    a->used += n;
+    ++a->draws;
+    memset(&run[n - 1], 0, sizeof(Command));    // COMMAND_END
+    return run;
+}
+
+Command* command_list_record(CommandList* list, uint64_t key, int count)
+{
+    CommandArena* a = &list->arenas[arena_index(list)];
+    if (!a->batch_left)
+    {
+        a->batch = render_queue_reserve(&list->queue, COMMAND_LIST_BATCH);
+        if (!a->batch)
+        {
+            list->failed.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+        a->batch_left = COMMAND_LIST_BATCH;
+    }
+    uint32_t payload;
+    Command* run = record_run(list, count, &payload);
+    if (!run)
+        return NULL;
+    RenderQueueEntry* entry = a->batch++;
+    --a->batch_left;
+    entry->key = key;
+    entry->payload = payload;
+    entry->reserved = 0;
+    return run;
+}
+
+RenderQueueEntry* command_list_reserve(CommandList* list, size_t n)
+{
+    RenderQueueEntry* entries = render_queue_reserve(&list->queue, n);
+    for (size_t i = 0; entries && i < n; ++i)
+    {
+        entries[i].key = ~0ull;
+        entries[i].payload = COMMAND_LIST_NONE;
+        entries[i].reserved = 0;
+    }
+    if (!entries)
+        list->failed.fetch_add(n, std::memory_order_relaxed);
+    return entries;
+}
+
+Command* command_list_record_at(CommandList* list, RenderQueueEntry* entry, uint64_t key, int count)
+{
+    uint32_t payload;
+    Command* run = record_run(list, count, &payload);
+    if (!run)
+        return NULL;
+    entry->key = key;
+    entry->payload = payload;
+    return run;
+}
+
+// Reserved entries nothing went into sort last and replay skips them
+static void close_batches(CommandList* list)
+{
+    for (int t = 0; t <= list->thread_count; ++t)
+    {
+        CommandArena* a = &list->arenas[t];
+        for (uint32_t i = 0; i < a->batch_left; ++i)
+        {
+            a->batch[i].key = ~0ull;
+            a->batch[i].payload = COMMAND_LIST_NONE;
+            a->batch[i].reserved = 0;
+        }
+        a->batch_left = 0;
+    }
+}
+
+void command_list_sort(CommandList* list, JobSystem* jobs)
+{
+    close_batches(list);
+    render_queue_sort(&list->queue, jobs);
+}
+
+bool command_list_sort_coherent(CommandList* list, JobSystem* jobs)
+{
+    close_batches(list);
+    return render_queue_sort_coherent(&list->queue, jobs);
+}
+
+size_t command_list_draw_count(const CommandList* list)
+{
+    size_t draws = 0;
+    for (int t = 0; t <= list->thread_count; ++t)
+        draws += list->arenas[t].draws;
+    return draws;
+}
+
+static inline const Command* run_of(const CommandList* list, uint32_t payload)
+{
+    const CommandArena* a = &list->arenas[payload >> THREAD_SHIFT];
+    return a->chunks[(payload >> COMMAND_LIST_CHUNK_BITS) & CHUNK_MASK] + (payload & (COMMAND_LIST_CHUNK_SIZE - 1u));
+}
+
+void command_list_replay(const CommandList* list, CommandFunction function, void* user, CommandReplayStats* stats)
+{
+    CommandReplayStats s = { 0, 0, 0 };
+    uint32_t program = COMMAND_LIST_NONE, vertex_array = COMMAND_LIST_NONE;
+    uint32_t attributes[COMMAND_LIST_SLOTS];
+    bool attribute_set[COMMAND_LIST_SLOTS] = {};
+    const size_t count = list->queue.count.load(std::memory_order_relaxed);
+    for (size_t k = 0; k < count; ++k)
+    {
+        const uint32_t payload = list->queue.entries[k].payload;
+        if (payload == COMMAND_LIST_NONE)
+            continue;
+        ++s.draws;
+        for (const Command* c = run_of(list, payload); c->type != COMMAND_END; ++c)
+        {
+            bool skip = false;
+            if (c->type == COMMAND_PROGRAM)
+            {
+                skip = program == c->id;
+                program = c->id;
+            }
+            else if (c->type == COMMAND_VERTEX_ARRAY)
+            {
+                skip = vertex_array == c->id;
+                vertex_array = c->id;
+            }
+            else if (c->type == COMMAND_ATTRIBUTE && c->slot < COMMAND_LIST_SLOTS)
+            {
+                skip = attribute_set[c->slot] && attributes[c->slot] == c->value;
+                attribute_set[c->slot] = true;
+                attributes[c->slot] = c->value;
+            }
+            if (skip)
+            {
+                ++s.skipped;
+                continue;
+            }
+            ++s.commands;
+            function(user, c);
+        }
+    }
+    if (stats)
+        *stats = s;
+}
+
+void command_list_print(const CommandList* list, const char* name, FILE* out)
+{
+    uint32_t in_use = 0, allocated = 0, busiest = 0;
+    for (int t = 0; t <= list->thread_count; ++t)
+    {
+        const CommandArena* a = &list->arenas[t];
+        const uint32_t used = a->chunk_count ? (a->chunk < a->chunk_count ? a->chunk + (a->used > 0) : a->chunk) : 0;
+        in_use += used;
+        allocated += a->chunk_count;
+        busiest = a->chunk_count > busiest ? a->chunk_count : busiest;
+    }
+    fprintf(out, "%s: %zu draws, %u chunks in use of %u allocated (%.1f MB, at most %u on a thread), %llu refused\n", name,
+        command_list_draw_count(list), in_use, allocated, allocated * (double)(sizeof(Command) * COMMAND_LIST_CHUNK_SIZE) / 1048576.0,
+        busiest, (unsigned long long)list->failed.load(std::memory_order_relaxed));
+}
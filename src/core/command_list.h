@@ -0,0 +1,122 @@
+#pragma once
+
+#include "core/render_queue.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Deferred draw commands: recorded on any thread, replayed in sort-key order
+// on the one that owns the GL context.
+//
+// A recorded draw is a sort key (core/render_queue.h) plus a short run of
+// API-agnostic commands - bind a program or vertex array, point a uniform
+// binding at a block, set an attribute, draw - ended by COMMAND_END. Ids in
+// the commands are the renderer's own (which program, which level of detail,
+// which object's block); nothing here knows GL. The runs go into per-thread
+// arenas, so recording threads never share a cache line or take a lock: each
+// job thread (and one caller outside the job system) has a chain of chunks
+// that grows on demand and is rewound, not freed, by command_list_begin.
+// Queue entries are reserved COMMAND_LIST_BATCH at a time per thread too; a
+// caller whose draws come in an order worth keeping claims them all up front
+// instead (command_list_reserve) and records each draw into its own.
+//
+// command_list_sort orders the draws by key; command_list_replay then walks
+// them, handing each command to a callback and leaving out bindings that are
+// already in place, so state only changes where the sorted keys say it does.
+//
+// A queue entry's payload locates its run: 7 bits of thread, 7 of chunk and
+// 18 of command index.
+
+#define COMMAND_LIST_CHUNK_BITS 18
+#define COMMAND_LIST_CHUNK_SIZE (1u << COMMAND_LIST_CHUNK_BITS)     // commands per chunk (2 MB)
+#define COMMAND_LIST_MAX_CHUNKS 128                                 // per thread
+#define COMMAND_LIST_MAX_THREADS 128                                // job threads, plus one outside the system
+#define COMMAND_LIST_BATCH 64               // queue entries a thread reserves at once
+#define COMMAND_LIST_NONE 0xFFFFFFFFu       // the payload of a reserved entry nothing was recorded into
+#define COMMAND_LIST_MAX_RUN 32             // commands in one draw's run, COMMAND_END not included
+#define COMMAND_LIST_SLOTS 16               // uniform bindings / attribute locations whose state replay tracks
+
+typedef enum CommandType
+{
+    COMMAND_END,
+    COMMAND_PROGRAM,        // id: the program (or pipeline) to use
+    COMMAND_VERTEX_ARRAY,   // id: the vertex array to bind
+    COMMAND_UNIFORM,        // slot: the uniform block binding; value: the block (e.g. an object's draw data)
+    COMMAND_ATTRIBUTE,      // slot: the attribute location; value: its constant value
+    COMMAND_DRAW,           // id: the mesh (or its level of detail); value: the draw's object
+} CommandType;
+
+typedef struct Command
+{
+    uint8_t type;           // CommandType
+    uint8_t slot;
+    uint16_t id;
+    uint32_t value;
+} Command;
+
+typedef struct alignas(64) CommandArena
+{
+    Command* chunks[COMMAND_LIST_MAX_CHUNKS];
+    uint32_t chunk_count;       // allocated, kept across frames
+    uint32_t chunk;             // being filled
+    uint32_t used;              // commands in it
+    uint32_t draws;             // recorded since command_list_begin
+    RenderQueueEntry* batch;    // queue entries reserved and not yet filled
+    uint32_t batch_left;
+} CommandArena;
+
+typedef struct CommandList
+{
+    RenderQueue queue;
+    CommandArena* arenas;       // [thread_count + 1]: the last for a thread outside the job system
+    int thread_count;
+    std::atomic<uint64_t> failed;   // draws refused since init: the queue or a thread's chunks were full
+} CommandList;
+
+typedef struct CommandReplayStats
+{
+    size_t draws;
+    size_t commands;            // handed to the callback
+    size_t skipped;             // bindings left out because they were already in place
+} CommandReplayStats;
+
+typedef void (*CommandFunction)(void* user, const Command* command);
+
+// Room for "max_draws" draws a frame, recorded from a job system of "thread_count" threads (and one thread outside
+// it). Logs and returns false when out of memory.
+bool command_list_init(CommandList* list, size_t max_draws, int thread_count);
+void command_list_destroy(CommandList* list);
+
+// Drops the last frame's draws; every recording thread must be done with them
+void command_list_begin(CommandList* list);
+
+// A draw of "count" commands under "key", for the caller to fill in (COMMAND_END is added). Any thread of the job
+// system, or one thread outside it, at a time. NULL (counted in "failed") when it doesn't fit.
+Command* command_list_record(CommandList* list, uint64_t key, int count);
+
+// Claims "n" queue entries in a row, each empty until command_list_record_at fills it: draws recorded into them
+// keep the entries' order, whichever threads record them, where command_list_record's batches interleave. NULL
+// (and "n" draws counted in "failed") when they don't fit.
+RenderQueueEntry* command_list_reserve(CommandList* list, size_t n);
+
+// command_list_record into "entry", one command_list_reserve claimed. NULL (counted in "failed", the entry left
+// empty) when the thread's chunks are full.
+Command* command_list_record_at(CommandList* list, RenderQueueEntry* entry, uint64_t key, int count);
+
+// Sorts the draws by key, stably (render_queue_sort; "jobs" as there). After recording has finished.
+void command_list_sort(CommandList* list, JobSystem* jobs);
+
+// command_list_sort for draws recorded nearly in key order, into command_list_reserve's entries
+// (render_queue_sort_coherent). Returns false when they weren't, and the full sort ran.
+bool command_list_sort_coherent(CommandList* list, JobSystem* jobs);
+
+// Every draw's commands in key order. Program, vertex array and attribute commands that repeat the state the
+// previous draws left are skipped; uniform and draw commands always reach "function".
+void command_list_replay(const CommandList* list, CommandFunction function, void* user, CommandReplayStats* stats);
+
+// Draws recorded this frame (after sorting, entries nothing was recorded into are left out)
+size_t command_list_draw_count(const CommandList* list);
+
+// Chunks per thread in use and allocated, and refused draws
+void command_list_print(const CommandList* list, const char* name, FILE* out);
@@ -0,0 +1,442 @@
+#include "core/cpu_topology.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+void cpu_set_clear(CpuSet* set)
+{
+    memset(set, 0, sizeof(*set));
+}
+
+void cpu_set_add(CpuSet* set, int cpu)
+{
+    if (cpu >= 0 && cpu < CPU_TOPOLOGY_MAX)
+        set->bits[cpu / 64] |= 1ull << (cpu % 64);
+}
+
+bool cpu_set_has(const CpuSet* set, int cpu)
+{
+    return cpu >= 0 && cpu < CPU_TOPOLOGY_MAX && (set->bits[cpu / 64] >> (cpu % 64) & 1u);
+}
+
+int cpu_set_count(const CpuSet* set)
+{
+    int count = 0;
+    for (int i = 0; i < CPU_TOPOLOGY_MAX; ++i)
+        count += cpu_set_has(set, i);
+    return count;
+}
+
+bool cpu_set_parse(CpuSet* set, const char* list)
+{
+    cpu_set_clear(set);
+    const char* at = list;
+    while (*at && !isspace((unsigned char)*at))
+    {
+        char* end = NULL;
+        const long first = strtol(at, &end, 10);
+        long last = first;
+        if (end == at || first < 0)
+            break;
+        at = end;
+        if (*at == '-')
+        {
+            last = strtol(at + 1, &end, 10);
+            if (end == at + 1 || last < first)
+                break;
+            at = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_TOPOLOGY_MAX; ++cpu)
+            cpu_set_add(set, (int)cpu);
+        if (*at == ',')
+            ++at;
+        else if (*at && !isspace((unsigned char)*at))
+            break;
+    }
+    if (at == list || (*at && !isspace((unsigned char)*at)))
+    {
+        cpu_set_clear(set);
+        return false;
+    }
+    return true;
+}
+
+void cpu_set_format(const CpuSet* set, char* text, size_t size)
+{
+    size_t used = 0;
+    text[0] = '\0';
+    for (int cpu = 0; cpu < CPU_TOPOLOGY_MAX && used < size; ++cpu)
+    {
+        if (!cpu_set_has(set, cpu))
+            continue;
+        int last = cpu;
+        while (cpu_set_has(set, last + 1))
+            ++last;
+        const int n = last > cpu ? snprintf(text + used, size - used, "%s%d-%d", used ? "," : "", cpu, last)
+            : snprintf(text + used, size - used, "%s%d", used ? "," : "", cpu);
+        used += n > 0 ? (size_t)n : 0;
+        cpu = last;
+    }
+}
+
+// The entry for CPU "number", made the first time it's asked for; NULL past CPU_TOPOLOGY_MAX
+static CpuLogical* find_cpu(CpuTopology* t, int number, bool add)
+{
+    for (int i = 0; i < t->count; ++i)
+    {
+        if (t->cpus[i].number == number)
+            return &t->cpus[i];
+    }
+    if (!add || t->count == CPU_TOPOLOGY_MAX || number >= CPU_TOPOLOGY_MAX)
+        return NULL;
+    CpuLogical* cpu = &t->cpus[t->count++];
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->number = number;
+    return cpu;
+}
+
+// Every CPU its own core, all alike
+static void probe_count(CpuTopology* t)
+{
+    int count = (int)std::thread::hardware_concurrency();
+    count = count < 1 ? 1 : count < CPU_TOPOLOGY_MAX ? count : CPU_TOPOLOGY_MAX;
+    for (int i = 0; i < count; ++i)
+        find_cpu(t, i, true)->core = i;
+    t->cores = count;
+    t->packages = 1;
+    t->nodes = 1;
+    t->source = "the CPU count";
+}
+
+#if defined(__linux__)
+
+// The first line of a small sysfs file, without its newline. False when it can't be read.
+static bool read_line(const char* path, char* line, int size)
+{
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return false;
+    const bool read = fgets(line, size, f) != NULL;
+    fclose(f);
+    if (read)
+        line[strcspn(line, "\n")] = '\0';
+    return read;
+}
+
+static bool read_set(const char* path, CpuSet* set)
+{
+    char line[1024];
+    return read_line(path, line, sizeof(line)) && cpu_set_parse(set, line);
+}
+
+static bool probe_os(CpuTopology* t)
+{
+    CpuSet online;
+    if (!read_set("/sys/devices/system/cpu/online", &online))
+        return false;
+    CpuSet core_pmu, atom_pmu;      // Intel hybrids: the P-cores' and E-cores' PMUs
+    const bool intel_hybrid = read_set("/sys/devices/cpu_core/cpus", &core_pmu)
+        && read_set("/sys/devices/cpu_atom/cpus", &atom_pmu);
+    int core_of[CPU_TOPOLOGY_MAX];  // the core index of each core's lowest CPU, -1 before it's seen
+    for (int i = 0; i < CPU_TOPOLOGY_MAX; ++i)
+        core_of[i] = -1;
+
+    char path[128], line[64];
+    for (int number = 0; number < CPU_TOPOLOGY_MAX; ++number)
+    {
+        if (!cpu_set_has(&online, number))
+            continue;
+        CpuLogical* cpu = find_cpu(t, number, true);
+        if (!cpu)
+            break;
+        CpuSet siblings;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_cpus_list", number);
+        if (!read_set(path, &siblings))
+        {
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", number);
+            if (!read_set(path, &siblings))
+                cpu_set_clear(&siblings);
+        }
+        int lowest = number;
+        for (int i = 0; i < number; ++i)
+        {
+            if (cpu_set_has(&siblings, i))
+            {
+                lowest = i;
+                break;
+            }
+        }
+        if (core_of[lowest] < 0)
+            core_of[lowest] = t->cores++;
+        cpu->core = core_of[lowest];
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", number);
+        cpu->package = read_line(path, line, sizeof(line)) && atoi(line) > 0 ? atoi(line) : 0;
+        t->packages = cpu->package + 1 > t->packages ? cpu->package + 1 : t->packages;
+
+        if (intel_hybrid)
+            cpu->efficiency = cpu_set_has(&core_pmu, number) ? 1 : 0;
+        else
+        {
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpu_capacity", number);
+            cpu->efficiency = read_line(path, line, sizeof(line)) ? atoi(line) : 0;
+        }
+    }
+
+    t->nodes = 1;
+    for (int node = 0; node < 64; ++node)
+    {
+        CpuSet cpus;
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if (!read_set(path, &cpus))
+            continue;
+        for (int i = 0; i < t->count; ++i)
+        {
+            if (cpu_set_has(&cpus, t->cpus[i].number))
+                t->cpus[i].node = node;
+        }
+        t->nodes = node + 1 > t->nodes ? node + 1 : t->nodes;
+    }
+    t->source = intel_hybrid ? "sysfs, cpu_core/cpu_atom" : "sysfs";
+    return t->count > 0;
+}
+
+bool cpu_thread_pin(std::thread* thread, const CpuSet* set)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int i = 0; i < CPU_TOPOLOGY_MAX && i < CPU_SETSIZE; ++i)
+    {
+        if (cpu_set_has(set, i))
+            CPU_SET(i, &cpus);
+    }
+    const pthread_t handle = thread ? thread->native_handle() : pthread_self();
+    return CPU_COUNT(&cpus) > 0 && pthread_setaffinity_np(handle, sizeof(cpus), &cpus) == 0;
+}
+
+bool cpu_thread_raise_priority(void)
+{
+    return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), -5) == 0;
+}
+
+#elif defined(_WIN32)
+
+// Each CPU in "mask", a group's, passed to "found"
+template <typename Found>
+static void each_cpu(const GROUP_AFFINITY* mask, Found found)
+{
+    for (int bit = 0; bit < 64; ++bit)
+    {
+        if ((uint64_t)mask->Mask >> bit & 1u)
+            found(mask->Group * 64 + bit);
+    }
+}
+
+static bool probe_os(CpuTopology* t)
+{
+    DWORD size = 0;
+    GetLogicalProcessorInformationEx(RelationAll, NULL, &size);
+    if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+        return false;
+    unsigned char* buffer = (unsigned char*)malloc(size);
+    if (!buffer || !GetLogicalProcessorInformationEx(RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer, &size))
+    {
+        free(buffer);
+        return false;
+    }
+
+    // The cores first, which make the CPUs; then the packages and nodes they're in
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (DWORD offset = 0; offset < size;)
+        {
+            const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info = (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)(buffer + offset);
+            offset += info->Size;
+            if (pass == 0 && info->Relationship == RelationProcessorCore)
+            {
+                const int core = t->cores++;
+                const int efficiency = info->Processor.EfficiencyClass;
+                for (WORD g = 0; g < info->Processor.GroupCount; ++g)
+                    each_cpu(&info->Processor.GroupMask[g], [&](int number) {
+                        if (CpuLogical* cpu = find_cpu(t, number, true))
+                        {
+                            cpu->core = core;
+                            cpu->efficiency = efficiency;
+                        }
+                    });
+            }
+            else if (pass == 1 && info->Relationship == RelationProcessorPackage)
+            {
+                const int package = t->packages++;
+                for (WORD g = 0; g < info->Processor.GroupCount; ++g)
+                    each_cpu(&info->Processor.GroupMask[g], [&](int number) {
+                        if (CpuLogical* cpu = find_cpu(t, number, false))
+                            cpu->package = package;
+                    });
+            }
+            else if (pass == 1 && info->Relationship == RelationNumaNode)
+            {
+                const int node = (int)info->NumaNode.NodeNumber;
+                each_cpu(&info->NumaNode.GroupMask, [&](int number) {
+                    if (CpuLogical* cpu = find_cpu(t, number, false))
+                        cpu->node = node;
+                });
+                t->nodes = node + 1 > t->nodes ? node + 1 : t->nodes;
+            }
+        }
+    }
+    free(buffer);
+    t->source = "GetLogicalProcessorInformationEx";
+    return t->count > 0;
+}
+
+bool cpu_thread_pin(std::thread* thread, const CpuSet* set)
+{
+    int lowest = 0;
+    while (lowest < CPU_TOPOLOGY_MAX && !cpu_set_has(set, lowest))
+        ++lowest;
+    if (lowest == CPU_TOPOLOGY_MAX)
+        return false;
+    GROUP_AFFINITY affinity;
+    memset(&affinity, 0, sizeof(affinity));
+    affinity.Group = (WORD)(lowest / 64);
+    affinity.Mask = (KAFFINITY)set->bits[lowest / 64];
+    const HANDLE handle = thread ? (HANDLE)thread->native_handle() : GetCurrentThread();
+    return SetThreadGroupAffinity(handle, &affinity, NULL) != 0;
+}
+
+bool cpu_thread_raise_priority(void)
+{
+    const bool raised = SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL) != 0;
+#ifdef THREAD_POWER_THROTTLING_CURRENT_VERSION
+    THREAD_POWER_THROTTLING_STATE throttling;
+    memset(&throttling, 0, sizeof(throttling));
+    throttling.Version = THREAD_POWER_THROTTLING_CURRENT_VERSION;
+    throttling.ControlMask = THREAD_POWER_THROTTLING_EXECUTION_SPEED;
+    throttling.StateMask = 0;       // controlled, and off
+    SetThreadInformation(GetCurrentThread(), ThreadPowerThrottling, &throttling, sizeof(throttling));
+#endif
+    return raised;
+}
+
+#else
+
+static bool probe_os(CpuTopology* t)
+{
+    (void)t;
+    return false;
+}
+
+bool cpu_thread_pin(std::thread* thread, const CpuSet* set)
+{
+    (void)thread;
+    (void)set;
+    return false;
+}
+
+bool cpu_thread_raise_priority(void)
+{
+    return false;
+}
+
+#endif
+
+bool cpu_topology_probe(CpuTopology* t)
+{
+    memset(t, 0, sizeof(*t));
+    const bool probed = probe_os(t);
+    if (!probed)
+    {
+        memset(t, 0, sizeof(*t));
+        probe_count(t);
+    }
+    t->packages = t->packages > 0 ? t->packages : 1;
+    t->nodes = t->nodes > 0 ? t->nodes : 1;
+
+    int fastest = t->cpus[0].efficiency, slowest = t->cpus[0].efficiency;
+    for (int i = 1; i < t->count; ++i)
+    {
+        fastest = t->cpus[i].efficiency > fastest ? t->cpus[i].efficiency : fastest;
+        slowest = t->cpus[i].efficiency < slowest ? t->cpus[i].efficiency : slowest;
+    }
+    t->hybrid = fastest != slowest;
+    t->smt = t->count > t->cores;
+    unsigned char counted[CPU_TOPOLOGY_MAX] = {};     // per core
+    for (int i = 0; i < t->count; ++i)
+    {
+        const CpuLogical* cpu = &t->cpus[i];
+        if (cpu->efficiency == fastest && !counted[cpu->core])
+        {
+            counted[cpu->core] = 1;
+            ++t->performance_cores;
+        }
+    }
+    return probed;
+}
+
+void cpu_topology_print(const CpuTopology* t, FILE* out)
+{
+    fprintf(out, "cpu topology: %d CPUs, %d cores", t->count, t->cores);
+    if (t->hybrid)
+        fprintf(out, " (%d performance, %d efficiency)", t->performance_cores, t->cores - t->performance_cores);
+    fprintf(out, ", %d package%s, %d NUMA node%s, from %s\n", t->packages, t->packages == 1 ? "" : "s", t->nodes,
+        t->nodes == 1 ? "" : "s", t->source);
+    char text[256];
+    CpuSet set;
+    if (t->hybrid)
+    {
+        cpu_topology_performance(t, -1, &set);
+        cpu_set_format(&set, text, sizeof(text));
+        fprintf(out, "  performance cores: CPUs %s\n", text);
+    }
+    for (int node = 0; t->nodes > 1 && node < t->nodes; ++node)
+    {
+        cpu_topology_node(t, node, &set);
+        cpu_set_format(&set, text, sizeof(text));
+        fprintf(out, "  node %d: CPUs %s\n", node, text);
+    }
+}
+
+void cpu_topology_performance(const CpuTopology* t, int node, CpuSet* set)
+{
+    cpu_set_clear(set);
+    int fastest = t->cpus[0].efficiency;
+    for (int i = 1; i < t->count; ++i)
+        fastest = t->cpus[i].efficiency > fastest ? t->cpus[i].efficiency : fastest;
+    for (int i = 0; i < t->count; ++i)
+    {
+        if (t->cpus[i].efficiency == fastest && (node < 0 || t->cpus[i].node == node))
+            cpu_set_add(set, t->cpus[i].number);
+    }
+}
+
+void cpu_topology_node(const CpuTopology* t, int node, CpuSet* set)
+{
+    cpu_set_clear(set);
+    for (int i = 0; i < t->count; ++i)
+    {
+        if (t->cpus[i].node == node)
+            cpu_set_add(set, t->cpus[i].number);
+    }
+}
+
+int cpu_topology_job_threads(const CpuTopology* t, bool render_thread)
+{
+    int threads = t->cores;
+    if (!t->smt && render_thread && threads > 2)
+        --threads;
+    return threads > 0 ? threads : 1;
+}
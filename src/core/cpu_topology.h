@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+
+// The machine's cores, for placing threads: which logical CPUs share a
+// physical core (SMT siblings), which cores are performance and which
+// efficiency ones on a hybrid CPU, and which NUMA node each belongs to.
+//
+// Linux: sysfs. The siblings come from each CPU's topology/core_cpus_list
+// (thread_siblings_list before 5.7), the P/E split from the cpu_core and
+// cpu_atom PMUs Intel's hybrid parts register, or else each CPU's
+// cpu_capacity (ARM's big.LITTLE, and x86 hybrids on recent kernels); the
+// nodes from /sys/devices/system/node. Windows: GetLogicalProcessorInformationEx,
+// whose cores carry an EfficiencyClass. Elsewhere only the count is known,
+// and every CPU is taken for a core of its own.
+//
+// CPU numbers are the OS's: Linux's as in /proc/cpuinfo, Windows' as
+// group * 64 + number in the group. A CpuSet is a bit per number.
+//
+// Pinning (SetThreadGroupAffinity, pthread_setaffinity_np) and priority
+// (SetThreadPriority, or a negative nice value on Linux, which needs
+// CAP_SYS_NICE or an RLIMIT_NICE allowance) are best effort: they return
+// false and the thread stays as it was. Threads start with their creator's
+// affinity on Linux, so a thread should be pinned after the ones it starts
+// that shouldn't be.
+
+#define CPU_TOPOLOGY_MAX 256            // logical CPUs; numbers past it are left out
+
+typedef struct CpuSet
+{
+    uint64_t bits[CPU_TOPOLOGY_MAX / 64];
+} CpuSet;
+
+void cpu_set_clear(CpuSet* set);
+void cpu_set_add(CpuSet* set, int cpu);
+bool cpu_set_has(const CpuSet* set, int cpu);
+int cpu_set_count(const CpuSet* set);
+
+// A list as Linux writes them and taskset takes them: "0-3,8,10-11". False (and "set" empty) when it isn't one.
+bool cpu_set_parse(CpuSet* set, const char* list);
+
+// "set" as such a list
+void cpu_set_format(const CpuSet* set, char* text, size_t size);
+
+typedef struct CpuLogical
+{
+    int number;             // the OS's
+    int core;               // index of its physical core, shared by SMT siblings
+    int package;
+    int node;               // NUMA node, 0 without
+    int efficiency;         // higher is faster: the EfficiencyClass, cpu_capacity, or 1 for cpu_core and 0 for cpu_atom
+} CpuLogical;
+
+typedef struct CpuTopology
+{
+    CpuLogical cpus[CPU_TOPOLOGY_MAX];
+    int count;              // logical CPUs found
+    int cores;              // physical cores
+    int performance_cores;  // of them, the fastest class: all of them when the CPU isn't hybrid
+    int packages;
+    int nodes;
+    bool smt;               // some core has more than one logical CPU
+    bool hybrid;            // the cores differ in efficiency
+    const char* source;     // where it was read from
+} CpuTopology;
+
+// Reads the topology. False when the platform gives nothing but the CPU count, which it's then filled in from.
+bool cpu_topology_probe(CpuTopology* t);
+
+// One line: CPUs, cores, performance and efficiency cores, packages and nodes; then the sets
+void cpu_topology_print(const CpuTopology* t, FILE* out);
+
+// The logical CPUs of the performance cores (every CPU when the CPU isn't hybrid), on NUMA node "node" only
+// when it's 0 or more
+void cpu_topology_performance(const CpuTopology* t, int node, CpuSet* set);
+
+// Every logical CPU of node "node"
+void cpu_topology_node(const CpuTopology* t, int node, CpuSet* set);
+
+// The job system's size, the calling thread included: a thread per physical core, SMT siblings left to the render,
+// I/O and driver threads. Without SMT a core is left over for "render_thread" (from 3 cores up).
+int cpu_topology_job_threads(const CpuTopology* t, bool render_thread);
+
+// Pins "thread" (the calling thread for NULL) to "set". Windows can only pin to one processor group: "set"'s
+// CPUs in the group of its lowest one.
+bool cpu_thread_pin(std::thread* thread, const CpuSet* set);
+
+// Raises the calling thread's priority above normal. On Windows it's also opted out of power throttling (EcoQoS),
+// which would steer it to the efficiency cores.
+bool cpu_thread_raise_priority(void);
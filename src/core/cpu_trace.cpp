@@ -0,0 +1,214 @@
+#include "core/cpu_trace.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+std::atomic<bool> cpu_trace_enabled(false);
+
+static CpuTraceTrack tracks[CPU_TRACE_MAX_TRACKS];
+static std::atomic<int> track_count(0);
+static thread_local int thread_track = -1;
+
+// Calibration: a tick and a steady_clock reading taken together at init
+static uint64_t start_ticks;
+static int64_t start_ns;
+static double ticks_per_ns = 1.0;
+
+static int64_t steady_ns(void)
+{
+    return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void cpu_trace_init(void)
+{
+    start_ticks = cpu_trace_now();
+    start_ns = steady_ns();
+#if CPU_TRACE_TSC
+    // 20 ms against the steady clock: its read jitter is a few parts per million of that
+    int64_t ns = start_ns;
+    while ((ns = steady_ns()) - start_ns < 20000000)
+    {
+    }
+    ticks_per_ns = (double)(cpu_trace_now() - start_ticks) / (double)(ns - start_ns);
+#endif
+    cpu_trace_enabled.store(true, std::memory_order_release);
+}
+
+void cpu_trace_shutdown(void)
+{
+    cpu_trace_enabled.store(false, std::memory_order_release);
+    const int count = track_count.exchange(0);
+    for (int i = 0; i < count && i < CPU_TRACE_MAX_TRACKS; ++i)
+    {
+        free(tracks[i].events);
+        tracks[i].events = NULL;
+        tracks[i].count.store(0, std::memory_order_relaxed);
+    }
+}
+
+double cpu_trace_ticks_per_ns(void)
+{
+    return ticks_per_ns;
+}
+
+// A new track, or -1 when the table is full (logged once)
+static int add_track(const char* name)
+{
+    const int id = track_count.fetch_add(1);
+    if (id >= CPU_TRACE_MAX_TRACKS)
+    {
+        if (id == CPU_TRACE_MAX_TRACKS)
+            fprintf(stderr, "cpu_trace: more than %d tracks, the rest aren't recorded\n", CPU_TRACE_MAX_TRACKS);
+        return -1;
+    }
+    CpuTraceTrack* t = &tracks[id];
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    t->events = (CpuTraceEvent*)malloc(sizeof(CpuTraceEvent) * CPU_TRACE_EVENTS);
+    if (!t->events)
+        return -1;
+    memset(t->events, 0, sizeof(CpuTraceEvent) * CPU_TRACE_EVENTS);   // page it in now, not inside the first scopes
+    t->count.store(0, std::memory_order_relaxed);
+    return id;
+}
+
+// The calling thread's track, registered on first use
+static int own_track(void)
+{
+    if (thread_track < 0)
+    {
+        char name[CPU_TRACE_NAME_SIZE];
+        snprintf(name, sizeof(name), "thread %d", track_count.load(std::memory_order_relaxed));
+        thread_track = add_track(name);
+    }
+    return thread_track;
+}
+
+void cpu_trace_thread_name(const char* name)
+{
+#ifdef TRACY_ENABLE
+    tracy::SetThreadName(name);
+#endif
+    if (!cpu_trace_active())
+        return;
+    const int id = own_track();
+    if (id >= 0)
+        snprintf(tracks[id].name, sizeof(tracks[id].name), "%s", name);
+}
+
+void cpu_trace_emit(int track, const char* name, uint64_t begin, uint64_t end)
+{
+    if (track < 0)
+        return;
+    CpuTraceTrack* t = &tracks[track];
+    const uint64_t n = t->count.load(std::memory_order_relaxed);    // only this thread writes it
+    CpuTraceEvent* e = &t->events[n & (CPU_TRACE_EVENTS - 1)];
+    e->name = name;
+    e->series = NULL;
+    e->begin = begin;
+    e->end = end;
+    t->count.store(n + 1, std::memory_order_release);
+}
+
+void cpu_trace_counter(int track, const char* name, const char* series, uint64_t at, double value)
+{
+    if (track < 0)
+        return;
+    CpuTraceTrack* t = &tracks[track];
+    const uint64_t n = t->count.load(std::memory_order_relaxed);
+    CpuTraceEvent* e = &t->events[n & (CPU_TRACE_EVENTS - 1)];
+    e->name = name;
+    e->series = series;
+    e->begin = at;
+    e->value = value;
+    t->count.store(n + 1, std::memory_order_release);
+}
+
+void cpu_trace_record(const char* name, uint64_t begin, uint64_t end)
+{
+    cpu_trace_emit(thread_track >= 0 ? thread_track : own_track(), name, begin, end);
+}
+
+int cpu_trace_track(const char* name)
+{
+    return cpu_trace_active() ? add_track(name) : -1;
+}
+
+const CpuTraceTrack* cpu_trace_tracks(int* count)
+{
+    const int n = track_count.load(std::memory_order_acquire);
+    *count = n < CPU_TRACE_MAX_TRACKS ? n : CPU_TRACE_MAX_TRACKS;
+    return tracks;
+}
+
+// A JSON string; names are literals, but keep the file valid whatever they hold
+static void write_string(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(f, "\\u%04x", *s);
+        else
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+bool cpu_trace_write(const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        fprintf(stderr, "cpu_trace: can't open %s for writing\n", path);
+        return false;
+    }
+
+    // Microseconds since init, the unit trace_event timestamps are in
+    const double us_per_tick = 1e-3 / ticks_per_ns;
+    int count = 0;
+    cpu_trace_tracks(&count);
+    uint64_t written = 0, overwritten = 0;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int i = 0; i < count; ++i)
+    {
+        const CpuTraceTrack* t = &tracks[i];
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", i ? ",\n" : "", i + 1);
+        write_string(f, t->name);
+        fprintf(f, "}},\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+            i + 1, i);
+
+        const uint64_t n = t->count.load(std::memory_order_acquire);
+        const uint64_t first = n > CPU_TRACE_EVENTS ? n - CPU_TRACE_EVENTS : 0;
+        for (uint64_t k = first; k < n; ++k)
+        {
+            const CpuTraceEvent* e = &t->events[k & (CPU_TRACE_EVENTS - 1)];
+            fprintf(f, ",\n{\"name\":");
+            write_string(f, e->name);
+            if (e->series)
+            {
+                fprintf(f, ",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{", i + 1,
+                    (double)(int64_t)(e->begin - start_ticks) * us_per_tick);
+                write_string(f, e->series);
+                fprintf(f, ":%.17g}}", e->value);
+                continue;
+            }
+            fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", i + 1,
+                (double)(int64_t)(e->begin - start_ticks) * us_per_tick, (double)(e->end - e->begin) * us_per_tick);
+        }
+        written += n - first;
+        overwritten += first;
+    }
+    fprintf(f, "\n]}\n");
+    const bool ok = fclose(f) == 0;
+    if (!ok)
+        fprintf(stderr, "cpu_trace: can't write %s\n", path);
+    else
+        printf("trace: %llu events on %d tracks written to %s (%llu overwritten by newer ones)\n",
+            (unsigned long long)written, count, path, (unsigned long long)overwritten);
+    return ok;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_TRACE_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define CPU_TRACE_TSC 0
+#include <chrono>
+#endif
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+// CPU instrumentation: named scopes on every thread, written out as a Chrome
+// trace_event JSON file (chrome://tracing, ui.perfetto.dev) on one timeline
+// with the GPU passes.
+//
+// CPU_TRACE_SCOPE("name") times the rest of the enclosing block. Each thread
+// records into a ring of its own, registered the first time it traces, so a
+// scope is two timestamp reads and a store with no lock or shared cache line.
+// Timestamps are raw TSC ticks on x86 (steady_clock nanoseconds elsewhere),
+// converted once, at export, with the rate measured in cpu_trace_init. A ring
+// that wraps keeps the newest CPU_TRACE_EVENTS events.
+//
+// Until cpu_trace_init a scope costs one relaxed load. Other clocks (GPU
+// timestamp queries) go on tracks of their own: convert them with a pair of
+// readings taken together and cpu_trace_ticks_per_ns, then cpu_trace_emit.
+//
+// Built with TRACY_ENABLE (OPENGLTEST_TRACY=ON) every scope is also a Tracy
+// zone and threads are named there too, streamed live to the profiler.
+
+#define CPU_TRACE_MAX_TRACKS 64     // threads plus other tracks
+#define CPU_TRACE_EVENTS 65536      // per track, power of two
+#define CPU_TRACE_NAME_SIZE 32
+
+typedef struct CpuTraceEvent
+{
+    const char* name;       // borrowed, a string literal
+    const char* series;     // NULL for a scope; a counter's series (cpu_trace_counter), borrowed too
+    uint64_t begin;         // ticks; a counter's time
+    union
+    {
+        uint64_t end;
+        double value;       // a counter's
+    };
+} CpuTraceEvent;
+
+typedef struct alignas(64) CpuTraceTrack
+{
+    char name[CPU_TRACE_NAME_SIZE];
+    std::atomic<uint64_t> count;    // events ever recorded; the owner's release store publishes each one
+    CpuTraceEvent* events;          // [CPU_TRACE_EVENTS]
+} CpuTraceTrack;
+
+extern std::atomic<bool> cpu_trace_enabled;
+
+static inline bool cpu_trace_active(void)
+{
+    return cpu_trace_enabled.load(std::memory_order_relaxed);
+}
+
+// The trace clock, in ticks
+static inline uint64_t cpu_trace_now(void)
+{
+#if CPU_TRACE_TSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Calibrates the clock (20 ms of spinning on x86) and starts recording, once per process. Call it before the
+// threads to trace start, so the ones that name themselves get a track.
+void cpu_trace_init(void);
+
+// Stops recording and frees every track. Only once no thread traces any more.
+void cpu_trace_shutdown(void);
+
+// Ticks per nanosecond of the trace clock, as calibrated
+double cpu_trace_ticks_per_ns(void);
+
+// Names the calling thread's track (copied), registering it; ignored while tracing is off
+void cpu_trace_thread_name(const char* name);
+
+// Appends a finished scope to the calling thread's track
+void cpu_trace_record(const char* name, uint64_t begin, uint64_t end);
+
+// A track that no thread owns, for events from another clock; -1 when tracing is off or the table is
+// full. Only one thread at a time may emit to it.
+int cpu_trace_track(const char* name);
+void cpu_trace_emit(int track, const char* name, uint64_t begin, uint64_t end);
+
+// A counter event on such a track: "series" of counter "name" is "value" from "at" on (a "C" event, which the
+// viewers draw as a graph per name and series)
+void cpu_trace_counter(int track, const char* name, const char* series, uint64_t at, double value);
+
+// The tracks so far and their number, to inspect once no thread traces any more
+const CpuTraceTrack* cpu_trace_tracks(int* count);
+
+// Writes every track as Chrome trace_event JSON: one complete ("X") event per scope and a "C" event per counter
+// value, one tid per track.
+// Only once no thread traces any more. Returns false (logged) when the file can't be written.
+bool cpu_trace_write(const char* path);
+
+// Measures the enclosing block from construction to destruction
+typedef struct CpuTraceScope
+{
+    const char* name;
+    uint64_t begin;         // 0 when tracing was off as it started
+
+    explicit CpuTraceScope(const char* n) : name(n), begin(cpu_trace_active() ? cpu_trace_now() : 0) {}
+    ~CpuTraceScope()
+    {
+        if (begin)
+            cpu_trace_record(name, begin, cpu_trace_now());
+    }
+} CpuTraceScope;
+
+#define CPU_TRACE_CONCAT_(a, b) a##b
+#define CPU_TRACE_CONCAT(a, b) CPU_TRACE_CONCAT_(a, b)
+
+#ifdef TRACY_ENABLE
+#define CPU_TRACE_SCOPE(name) ZoneScopedN(name); CpuTraceScope CPU_TRACE_CONCAT(cpu_trace_scope_, __LINE__)(name)
+#define CPU_TRACE_FRAME() FrameMark
+#else
+#define CPU_TRACE_SCOPE(name) CpuTraceScope CPU_TRACE_CONCAT(cpu_trace_scope_, __LINE__)(name)
+#define CPU_TRACE_FRAME() ((void)0)
+#endif
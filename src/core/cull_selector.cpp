@@ -0,0 +1,99 @@
+#include "core/cull_selector.h"
+
+const char* const cull_path_names[CULL_PATH_COUNT] = { "cpu", "gpu" };
+
+void cull_selector_init(CullSelector* s, const char* view)
+{
+    s->view = view;
+    for (int p = 0; p < CULL_PATH_COUNT; ++p)
+    {
+        s->cost_ms[p].store(0.0, std::memory_order_relaxed);
+        s->trial[p].store(0, std::memory_order_relaxed);
+        s->samples[p].store(0, std::memory_order_relaxed);
+        s->frames[p] = 0;
+    }
+    s->path = s->running = CULL_PATH_CPU;
+    s->frame = 0;
+    s->trial_end = 0;
+    s->next_trial = CULL_SELECT_WARMUP_FRAMES;
+    s->retry = CULL_SELECT_RETRY_FRAMES;
+    s->settled_ms = 0.0;
+    s->trials = 0;
+    s->switches = 0;
+}
+
+// The path's samples since its latest trial began: none until the measuring thread has seen that trial
+static uint32_t samples_since_trial(const CullSelector* s, CullPath path)
+{
+    const uint64_t samples = s->samples[path].load(std::memory_order_acquire);
+    return (uint32_t)(samples >> 32) == s->trial[path].load(std::memory_order_relaxed) ? (uint32_t)samples : 0;
+}
+
+CullPath cull_selector_next(CullSelector* s)
+{
+    const CullPath other = s->path == CULL_PATH_CPU ? CULL_PATH_GPU : CULL_PATH_CPU;
+    ++s->frame;
+    const uint32_t tried = samples_since_trial(s, other);
+    if (s->trial_end && (tried >= CULL_SELECT_TRIAL_SAMPLES || s->frame >= s->trial_end))
+    {
+        // A trial with nothing back (the GPU's timings still in flight) is as good as not run
+        s->trial_end = 0;
+        if (tried && samples_since_trial(s, s->path)
+            && s->cost_ms[other].load(std::memory_order_relaxed)
+                < CULL_SELECT_MARGIN * s->cost_ms[s->path].load(std::memory_order_relaxed))
+        {
+            s->path = other;
+            s->retry = CULL_SELECT_RETRY_FRAMES;
+            ++s->switches;
+        }
+        else
+            s->retry = 2 * s->retry < CULL_SELECT_RETRY_MAX_FRAMES ? 2 * s->retry : CULL_SELECT_RETRY_MAX_FRAMES;
+        s->next_trial = s->frame + s->retry;
+        s->settled_ms = s->cost_ms[s->path].load(std::memory_order_relaxed);
+    }
+    else if (!s->trial_end && s->settled_ms > 0.0)
+    {
+        // The chosen path's cost moved off where the last trial left it: the scene changed, so ask again now
+        const double drift = s->cost_ms[s->path].load(std::memory_order_relaxed) / s->settled_ms;
+        if (drift > CULL_SELECT_DRIFT || drift * CULL_SELECT_DRIFT < 1.0)
+        {
+            s->retry = CULL_SELECT_RETRY_FRAMES;
+            s->next_trial = s->frame;
+        }
+    }
+    if (!s->trial_end && s->frame >= s->next_trial)
+    {
+        // Its average starts again from this trial's; the measuring thread restarts it on the next sample
+        s->trial[other].store(s->trial[other].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        s->trial_end = s->frame + CULL_SELECT_TRIAL_FRAMES;
+        ++s->trials;
+    }
+    s->running = s->trial_end ? other : s->path;
+    ++s->frames[s->running];
+    return s->running;
+}
+
+void cull_selector_cost(CullSelector* s, CullPath path, double ms)
+{
+    // A plain mean of the first few since the path's latest trial, so no one frame of a trial decides it. This
+    // thread is the only one writing the path's average and count: a new trial only renumbers it.
+    const uint32_t trial = s->trial[path].load(std::memory_order_acquire);
+    const uint64_t samples = s->samples[path].load(std::memory_order_relaxed);
+    const uint32_t n = (uint32_t)(samples >> 32) == trial ? (uint32_t)samples : 0;
+    const double average = s->cost_ms[path].load(std::memory_order_relaxed);
+    const double weight = (double)(n + 1) * CULL_SELECT_SMOOTHING < 1.0
+        ? 1.0 / (double)(n + 1) : CULL_SELECT_SMOOTHING;
+    s->cost_ms[path].store(average + weight * (ms - average), std::memory_order_relaxed);
+    s->samples[path].store((uint64_t)trial << 32 | (n + 1), std::memory_order_release);
+}
+
+void cull_selector_print(const CullSelector* s, FILE* out)
+{
+    const uint64_t frames = s->frames[CULL_PATH_CPU] + s->frames[CULL_PATH_GPU];
+    fprintf(out, "cull select (%s): %s now; cpu %.3f ms, gpu %.3f ms a frame; %.0f%% of %llu frames on the gpu, "
+        "%u switches in %u trials\n", s->view, cull_path_names[s->path],
+        s->cost_ms[CULL_PATH_CPU].load(std::memory_order_relaxed),
+        s->cost_ms[CULL_PATH_GPU].load(std::memory_order_relaxed),
+        frames ? 100.0 * (double)s->frames[CULL_PATH_GPU] / (double)frames : 0.0, (unsigned long long)frames,
+        s->switches, s->trials);
+}
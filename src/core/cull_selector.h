@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+
+// Picks, as the app runs, whether a view is culled on the CPU or the GPU
+// (--cull-select): the compute cull's dispatch and barrier cost about the
+// same whatever the scene, so it loses to the CPU's sweep on a small one and
+// wins on a big one, and where the two cross depends on the machine and the
+// scene. Each path's cost is measured while it runs: the CPU's on the thread
+// that culls (the objects' turns, the cull and the matrices), the GPU's from
+// the profiler's timestamps around the dispatch, which come back a few
+// frames late on the render thread. Each keeps a running average, written
+// only by the thread that measures it: a trial restarts the other path's by
+// numbering a new trial, which that thread sees on its next sample.
+//
+// The view runs the path chosen. After CULL_SELECT_WARMUP_FRAMES, and from
+// then on every so often, the other path is tried until
+// CULL_SELECT_TRIAL_SAMPLES of its costs are in (or CULL_SELECT_TRIAL_FRAMES
+// pass), so its average is fresh; it takes over if it cost under
+// CULL_SELECT_MARGIN of the chosen path's. A trial that doesn't win waits
+// twice as long for the next, from CULL_SELECT_RETRY_FRAMES up to
+// CULL_SELECT_RETRY_MAX_FRAMES, so a path far the worse costs next to
+// nothing to keep checking; but once the chosen path's cost drifts past
+// CULL_SELECT_DRIFT of what it was at the last trial - the scene grew or
+// shrank, the GPU got busier - the next trial is run straight away. So the
+// choice follows the scene within a second or so, and a draw between the
+// two doesn't flip it back and forth. The first path is the CPU's.
+//
+// One selector per view culled: the caller runs the path cull_selector_next
+// returns and reports what it cost.
+
+#define CULL_SELECT_WARMUP_FRAMES 30    // before the first trial: programs built, caches warm
+#define CULL_SELECT_TRIAL_SAMPLES 3     // the other path's costs a trial waits for
+#define CULL_SELECT_TRIAL_FRAMES 16     // and the most frames it runs, for the GPU's that come back a few frames late
+#define CULL_SELECT_RETRY_FRAMES 300    // from a trial to the next, doubled each time the other path loses
+#define CULL_SELECT_RETRY_MAX_FRAMES 4800
+#define CULL_SELECT_DRIFT 1.5           // the chosen path's cost this many times, or 1/this, its last trial's: retry now
+#define CULL_SELECT_MARGIN 0.9          // the other path takes over once it costs under this much of the chosen one
+#define CULL_SELECT_SMOOTHING 0.125     // a new sample's weight in its path's average, once past the first few
+
+typedef enum CullPath
+{
+    CULL_PATH_CPU,
+    CULL_PATH_GPU,
+    CULL_PATH_COUNT
+} CullPath;
+
+extern const char* const cull_path_names[CULL_PATH_COUNT];
+
+typedef struct CullSelector
+{
+    const char* view;                           // named in the summary, borrowed
+    std::atomic<double> cost_ms[CULL_PATH_COUNT];   // each path's average, written by the thread measuring it
+    std::atomic<uint32_t> trial[CULL_PATH_COUNT];   // the path's latest trial, numbered by the culling thread
+    std::atomic<uint64_t> samples[CULL_PATH_COUNT]; // the trial they count from (high 32 bits) and how many (low):
+                                                    // the first few are averaged; written by the thread measuring it
+    CullPath path;              // the one chosen: what frames outside a trial run
+    CullPath running;           // the latest frame's
+    uint64_t frame;             // frames asked for
+    uint64_t trial_end;         // the trial runs until this frame at most; 0 for none
+    uint64_t next_trial;
+    uint32_t retry;             // frames from the last trial to the next
+    double settled_ms;          // the chosen path's cost at the last trial's end
+
+    // Totals over the run
+    uint64_t frames[CULL_PATH_COUNT];
+    uint32_t trials;
+    uint32_t switches;
+} CullSelector;
+
+void cull_selector_init(CullSelector* s, const char* view);
+
+// The culling thread, once a frame: the path this frame runs
+CullPath cull_selector_next(CullSelector* s);
+
+// A frame's cost on the path it ran: the CPU's from the culling thread, the GPU's from whichever reads it back
+void cull_selector_cost(CullSelector* s, CullPath path, double ms);
+
+// One line: the path chosen, each path's average, the frames on each and the switches
+void cull_selector_print(const CullSelector* s, FILE* out);
@@ -0,0 +1,119 @@
+#include "core/file_watcher.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Modification time and size of "path"; false when it doesn't exist (or can't be read)
+static bool file_stamp(const char* path, uint64_t* stamp, uint64_t* size)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+        return false;
+    *stamp = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    *size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+#if defined(__APPLE__)
+    *stamp = (uint64_t)st.st_mtimespec.tv_sec * 1000000000u + (uint64_t)st.st_mtimespec.tv_nsec;
+#else
+    *stamp = (uint64_t)st.st_mtim.tv_sec * 1000000000u + (uint64_t)st.st_mtim.tv_nsec;
+#endif
+    *size = (uint64_t)st.st_size;
+#endif
+    if (*stamp == 0)
+        *stamp = 1;     // 0 is "missing"
+    return true;
+}
+
+void file_watcher_init(FileWatcher* fw)
+{
+    memset(fw, 0, sizeof(*fw));
+}
+
+int file_watcher_add(FileWatcher* fw, const char* path)
+{
+    if (fw->count == FILE_WATCHER_MAX_FILES || strlen(path) >= FILE_WATCHER_PATH_MAX)
+    {
+        fprintf(stderr, "file_watcher: can't watch %s: %s\n", path,
+            fw->count == FILE_WATCHER_MAX_FILES ? "too many files" : "path too long");
+        return -1;
+    }
+    WatchedFile* f = &fw->files[fw->count];
+    memset(f, 0, sizeof(*f));
+    strcpy(f->path, path);
+    if (!file_stamp(path, &f->stamp, &f->size))
+        f->stamp = f->size = 0;
+    return fw->count++;
+}
+
+int file_watcher_poll(FileWatcher* fw)
+{
+    int waiting = 0;
+    for (int i = 0; i < fw->count; ++i)
+    {
+        WatchedFile* f = &fw->files[i];
+        uint64_t stamp = 0, size = 0;
+        if (!file_stamp(f->path, &stamp, &size))
+            stamp = size = 0;
+        if (stamp != f->stamp || size != f->size)
+        {
+            f->stamp = stamp;
+            f->size = size;
+            f->settling = true;
+        }
+        else if (f->settling)
+        {
+            f->settling = false;
+            f->changed = stamp != 0;     // deleted files aren't a change to act on; their return will be
+            fw->changes += f->changed;
+        }
+        waiting += f->changed;
+    }
+    return waiting;
+}
+
+bool file_watcher_take(FileWatcher* fw, int id)
+{
+    if (id < 0 || id >= fw->count || !fw->files[id].changed)
+        return false;
+    fw->files[id].changed = false;
+    return true;
+}
+
+char* file_watcher_read(const char* path, size_t* size)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        fprintf(stderr, "file_watcher: can't open %s\n", path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    const long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = length >= 0 ? (char*)malloc((size_t)length + 1) : NULL;
+    if (!data || fread(data, 1, (size_t)length, f) != (size_t)length)
+    {
+        fprintf(stderr, "file_watcher: can't read %s\n", path);
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    data[length] = '\0';
+    if (size)
+        *size = (size_t)length;
+    return data;
+}
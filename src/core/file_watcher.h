@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Notices when files on disk change, by polling their modification time and
+// size. A handful of stat calls every quarter second costs nothing next to a
+// frame, and works the same for every editor and file system, where change
+// notification APIs differ per platform and miss saves that replace the file.
+//
+// A change is reported only once a poll finds the file as the previous poll
+// left it. Editors that save in several writes (truncate, write, rename) are
+// then read once, complete, after they're done.
+
+#define FILE_WATCHER_MAX_FILES 64
+#define FILE_WATCHER_PATH_MAX 260
+
+typedef struct WatchedFile
+{
+    char path[FILE_WATCHER_PATH_MAX];
+    uint64_t stamp;         // modification time, 0 while the file doesn't exist
+    uint64_t size;
+    bool settling;          // changed at the last poll: reported once a poll finds it the same
+    bool changed;           // settled since file_watcher_take last returned true for it
+} WatchedFile;
+
+typedef struct FileWatcher
+{
+    int count;
+    WatchedFile files[FILE_WATCHER_MAX_FILES];
+    uint64_t changes;       // settled changes reported, over the watcher's life
+} FileWatcher;
+
+void file_watcher_init(FileWatcher* fw);
+
+// Starts watching "path" as it is now; only later changes are reported. Returns its id, or -1 (logged) when
+// the table is full or the path too long.
+int file_watcher_add(FileWatcher* fw, const char* path);
+
+// Checks every file. Returns how many have a settled change waiting to be taken.
+int file_watcher_poll(FileWatcher* fw);
+
+// True, once, after file "id" changed and settled
+bool file_watcher_take(FileWatcher* fw, int id);
+
+// Reads the whole of "path" into a NUL-terminated malloc'd buffer (free it), or logs and returns NULL
+char* file_watcher_read(const char* path, size_t* size);
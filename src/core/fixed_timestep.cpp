@@ -0,0 +1,40 @@
+#include "core/fixed_timestep.h"
+
+void fixed_timestep_init(FixedTimestep* step, double tick_rate, int max_ticks)
+{
+    step->dt = tick_rate > 0.0 ? 1.0 / tick_rate : 1.0 / 60.0;
+    step->accumulator = 0.0;
+    step->max_ticks = max_ticks > 0 ? max_ticks : 1;
+    step->ticks = 0;
+    step->dropped_ticks = 0;
+}
+
+int fixed_timestep_advance(FixedTimestep* step, double delta)
+{
+    if (delta > 0.0)
+        step->accumulator += delta;
+    int ticks = (int)(step->accumulator / step->dt);
+    step->accumulator -= ticks * step->dt;
+    if (ticks > step->max_ticks)
+    {
+        step->dropped_ticks += (uint64_t)(ticks - step->max_ticks);
+        ticks = step->max_ticks;
+    }
+    step->ticks += (uint64_t)ticks;
+    return ticks;
+}
+
+float fixed_timestep_alpha(const FixedTimestep* step)
+{
+    const double alpha = step->accumulator / step->dt;
+    return (float)(alpha < 0.0 ? 0.0 : alpha > 1.0 ? 1.0 : alpha);
+}
+
+double fixed_timestep_time(const FixedTimestep* step)
+{
+    // The frame sits "accumulator" after the current tick, drawn as the blend from the previous one.
+    // Before the first tick both states are the initial one.
+    if (!step->ticks)
+        return 0.0;
+    return ((double)step->ticks - 1.0 + step->accumulator / step->dt) * step->dt;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fixed-timestep simulation clock.
+//
+// Real time is accumulated frame by frame and spent in whole ticks of "dt",
+// so the simulation does the same work per simulated second whatever the
+// frame rate, and the same sequence of ticks for the same inputs - its
+// results don't depend on how fast it was rendered. What's left over (less
+// than one tick) is the interpolation factor: a frame shows the previous
+// and current tick's states blended by "alpha", so motion stays smooth at
+// render rates above the tick rate.
+//
+// A frame that took very long (a debugger pause, a window drag) would owe
+// many ticks at once, which take long in turn and fall further behind. At
+// most "max_ticks" run per frame; the rest of the debt is dropped and the
+// simulation runs slow for that frame instead.
+
+typedef struct FixedTimestep
+{
+    double dt;              // seconds per tick
+    double accumulator;     // real time not yet simulated, [0, dt) between frames
+    int max_ticks;          // per frame, before the debt is dropped
+    uint64_t ticks;         // run since init
+    uint64_t dropped_ticks; // owed but dropped by the max_ticks clamp
+} FixedTimestep;
+
+void fixed_timestep_init(FixedTimestep* step, double tick_rate, int max_ticks);
+
+// Adds one frame's real time and returns how many ticks to run for it
+int fixed_timestep_advance(FixedTimestep* step, double delta);
+
+// Where between the previous tick (0) and the current one (1) the frame falls
+float fixed_timestep_alpha(const FixedTimestep* step);
+
+// Simulated time this frame shows: the current tick's, less the part of dt still to come
+double fixed_timestep_time(const FixedTimestep* step);
@@ -0,0 +1,175 @@
+#include "core/frame_arena.h"
+
+#include "core/huge_pages.h"
+#include "core/job_system.h"
+#include "core/numa_memory.h"
+
+#include <stdlib.h>
+
+#define ARENA_ROUND(size) (((size) + FRAME_ARENA_ALIGN - 1) & ~(size_t)(FRAME_ARENA_ALIGN - 1))
+
+static void* block_alloc(size_t size)
+{
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, 64);
+#else
+    void* p = NULL;
+    return posix_memalign(&p, 64, size) == 0 ? p : NULL;
+#endif
+}
+
+static void block_free(void* p)
+{
+#if defined(_MSC_VER)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+static void linear_arena_init(LinearArena* arena, unsigned char* base, size_t capacity)
+{
+    arena->base = base;
+    arena->capacity = capacity;
+    arena->used = 0;
+    arena->peak = 0;
+    arena->failed = 0;
+}
+
+bool frame_arena_init(FrameArena* arena, size_t main_size, int thread_count, size_t thread_size)
+{
+    return frame_arena_init_numa(arena, main_size, thread_count, thread_size, -1, NULL);
+}
+
+// Reserves the regions and commits each on its node; NULL when any of it fails
+static unsigned char* place_regions(size_t main_size, int thread_count, size_t thread_size, int main_node,
+    const int* thread_nodes, size_t reserved, bool* huge_pages)
+{
+    unsigned char* memory = (unsigned char*)numa_reserve(reserved);
+    if (memory)
+        *huge_pages = huge_pages_advise(memory, main_size);     // before the first touch
+    bool committed = memory && numa_commit(memory, main_size, main_node);
+    for (int i = 0; committed && i < thread_count; ++i)
+        committed = numa_commit(memory + main_size + thread_size * i, thread_size, thread_nodes ? thread_nodes[i] : -1);
+    const size_t tail = reserved - main_size - thread_size * thread_count;     // the byte past the end, rounded up
+    committed = committed && numa_commit(memory + reserved - tail, tail, main_node);
+    if (!committed)
+    {
+        numa_release(memory, reserved);
+        return NULL;
+    }
+    return memory;
+}
+
+bool frame_arena_init_numa(FrameArena* arena, size_t main_size, int thread_count, size_t thread_size, int main_node,
+    const int* thread_nodes)
+{
+    bool placed = main_node >= 0;
+    for (int i = 0; thread_nodes && i < thread_count; ++i)
+        placed = placed || thread_nodes[i] >= 0;
+
+    // Each region starts on its own cache line, so neighbouring threads' bumps don't share one; placed apart, on
+    // its own page
+    const size_t align = placed ? numa_page_size() : 64;
+    main_size = (main_size + align - 1) & ~(align - 1);
+    thread_size = (thread_size + align - 1) & ~(align - 1);
+    arena->thread_count = thread_count > 0 ? thread_count : 0;
+    const size_t size = main_size + thread_size * arena->thread_count + 1;
+    arena->reserved = placed ? (size + align - 1) & ~(align - 1) : 0;
+    arena->huge = !placed && huge_pages_enabled() && huge_page_size() && size >= huge_page_size() ? size : 0;
+    arena->huge_pages = false;
+    if (placed)
+        arena->memory = place_regions(main_size, arena->thread_count, thread_size, main_node, thread_nodes,
+            arena->reserved, &arena->huge_pages);
+    else if (arena->huge)
+    {
+        HugePageKind kind;
+        arena->memory = (unsigned char*)huge_pages_alloc(size, &kind);
+        arena->huge_pages = kind != HUGE_PAGES_NONE;
+    }
+    else
+        arena->memory = (unsigned char*)block_alloc(size);
+    arena->threads = arena->thread_count ? new LinearArena[arena->thread_count] : NULL;
+    if (!arena->memory)
+    {
+        fprintf(stderr, "frame_arena: out of memory for %zu bytes\n", main_size + thread_size * arena->thread_count);
+        delete[] arena->threads;
+        arena->threads = NULL;
+        arena->thread_count = 0;
+        arena->reserved = 0;
+        arena->huge = 0;
+        arena->huge_pages = false;
+        linear_arena_init(&arena->main, NULL, 0);
+        return false;
+    }
+    linear_arena_init(&arena->main, arena->memory, main_size);
+    for (int i = 0; i < arena->thread_count; ++i)
+        linear_arena_init(&arena->threads[i], arena->memory + main_size + thread_size * i, thread_size);
+    return true;
+}
+
+void frame_arena_destroy(FrameArena* arena)
+{
+    if (arena->reserved)
+        numa_release(arena->memory, arena->reserved);
+    else if (arena->huge)
+        huge_pages_free(arena->memory, arena->huge);
+    else
+        block_free(arena->memory);
+    arena->reserved = 0;
+    arena->huge = 0;
+    arena->huge_pages = false;
+    delete[] arena->threads;
+    arena->memory = NULL;
+    arena->threads = NULL;
+    arena->thread_count = 0;
+    linear_arena_init(&arena->main, NULL, 0);
+}
+
+void frame_arena_reset(FrameArena* arena)
+{
+    arena->main.used = 0;
+    for (int i = 0; i < arena->thread_count; ++i)
+        arena->threads[i].used = 0;
+}
+
+void* linear_arena_alloc(LinearArena* arena, size_t size)
+{
+    const size_t rounded = ARENA_ROUND(size);
+    if (rounded < size || rounded > arena->capacity - arena->used)
+    {
+        ++arena->failed;
+        return NULL;
+    }
+    void* p = arena->base + arena->used;
+    arena->used += rounded;
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+    return p;
+}
+
+void* frame_arena_alloc(FrameArena* arena, size_t size)
+{
+    return linear_arena_alloc(&arena->main, size);
+}
+
+LinearArena* frame_arena_thread(FrameArena* arena)
+{
+    const int index = job_thread_current();
+    return index >= 0 && index < arena->thread_count ? &arena->threads[index] : NULL;
+}
+
+void frame_arena_print(const FrameArena* arena, const char* name, FILE* out)
+{
+    size_t thread_peak = 0, thread_capacity = 0, failed = arena->main.failed;
+    for (int i = 0; i < arena->thread_count; ++i)
+    {
+        if (arena->threads[i].peak > thread_peak)
+            thread_peak = arena->threads[i].peak;
+        thread_capacity = arena->threads[i].capacity;
+        failed += arena->threads[i].failed;
+    }
+    fprintf(out, "%s: peak %zu of %zu KB, per job thread %zu of %zu KB (%d threads), %zu failed allocations%s\n", name,
+        (arena->main.peak + 1023) / 1024, arena->main.capacity / 1024, (thread_peak + 1023) / 1024, thread_capacity / 1024,
+        arena->thread_count, failed, arena->huge_pages ? ", huge pages" : "");
+}
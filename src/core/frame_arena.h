@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Bump-pointer memory for one frame's transient data.
+//
+// Everything a frame needs only until it has been drawn (culling results,
+// model matrices, per-job scratch) comes from its arena instead of the heap,
+// and the whole lot is dropped at once by frame_arena_reset. The arena is
+// one block carved into a main region, for the thread that owns the frame,
+// plus one sub-arena per job thread, so jobs allocate without locking or
+// sharing cache lines.
+//
+// On a machine with several NUMA nodes (core/numa_memory.h) each region can
+// be placed on the node of the thread that uses it: the regions are then
+// rounded up to whole pages and committed node by node.
+//
+// With huge pages enabled (core/huge_pages.h), an arena of a huge page or
+// more is allocated in them; a placed one has its main region, where the
+// per-object arrays go, advised for transparent huge pages instead.
+//
+// Nothing grows: an allocation that doesn't fit returns NULL and is counted.
+// The peak (high-water mark) of every region is kept across resets, and
+// frame_arena_print reports it, to size the arena for real content.
+
+#define FRAME_ARENA_ALIGN 16        // every allocation; matches the SIMD batches' alignment
+
+typedef struct alignas(64) LinearArena
+{
+    unsigned char* base;
+    size_t capacity;
+    size_t used;
+    size_t peak;            // most "used" ever reached
+    size_t failed;          // allocations that didn't fit, since init
+} LinearArena;
+
+typedef struct FrameArena
+{
+    unsigned char* memory;
+    size_t reserved;            // bytes of "memory" from numa_reserve, 0 when it's from the heap
+    size_t huge;                // bytes of "memory" from huge_pages_alloc, 0 otherwise
+    bool huge_pages;            // the main region was given or advised huge pages
+    LinearArena main;           // the owning thread's
+    LinearArena* threads;       // [thread_count]: job thread i's sub-arena
+    int thread_count;
+} FrameArena;
+
+// Allocates "main_size" bytes for the owning thread plus "thread_size" for each of "thread_count" job threads.
+// Logs and returns false when out of memory.
+bool frame_arena_init(FrameArena* arena, size_t main_size, int thread_count, size_t thread_size);
+
+// The same, with the main region on NUMA node "main_node" and job thread i's on "thread_nodes[i]" (-1, or NULL for
+// all of them: wherever they're first touched)
+bool frame_arena_init_numa(FrameArena* arena, size_t main_size, int thread_count, size_t thread_size, int main_node,
+    const int* thread_nodes);
+void frame_arena_destroy(FrameArena* arena);
+
+// Drops every allocation of the frame; called once the frame has been handed to the swap
+void frame_arena_reset(FrameArena* arena);
+
+// "size" bytes, FRAME_ARENA_ALIGN aligned, from the main region (owning thread only). NULL when full.
+void* frame_arena_alloc(FrameArena* arena, size_t size);
+
+// The calling job thread's sub-arena; NULL when the caller isn't a job thread or has none
+LinearArena* frame_arena_thread(FrameArena* arena);
+
+void* linear_arena_alloc(LinearArena* arena, size_t size);
+
+// Scoped scratch: everything allocated after a mark is released by rewinding to it
+static inline size_t linear_arena_mark(const LinearArena* arena)
+{
+    return arena->used;
+}
+
+static inline void linear_arena_rewind(LinearArena* arena, size_t mark)
+{
+    arena->used = mark;
+}
+
+// Peak usage of the main region and the busiest sub-arena, against their sizes, plus failed allocations
+void frame_arena_print(const FrameArena* arena, const char* name, FILE* out);
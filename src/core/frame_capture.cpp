@@ -0,0 +1,160 @@
+#include "core/frame_capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static size_t aligned(size_t size)
+{
+    return (size + FRAME_CAPTURE_ALIGN - 1) & ~(size_t)(FRAME_CAPTURE_ALIGN - 1);
+}
+
+bool frame_capture_create(FrameCaptureWriter* w, const char* path, const FrameCaptureHeader* header)
+{
+    memset(w, 0, sizeof(*w));
+    w->file = fopen(path, "wb");
+    if (!w->file)
+    {
+        fprintf(stderr, "frame_capture: can't create %s\n", path);
+        return false;
+    }
+    setvbuf(w->file, NULL, _IOFBF, 1 << 20);    // a frame's matrices go out in a few large writes
+    w->header = *header;
+    w->header.magic = FRAME_CAPTURE_MAGIC;
+    w->header.version = FRAME_CAPTURE_VERSION;
+    w->header.frame_count = 0;
+    if (fwrite(&w->header, sizeof(w->header), 1, w->file) != 1)
+    {
+        fprintf(stderr, "frame_capture: can't write %s\n", path);
+        fclose(w->file);
+        w->file = NULL;
+        return false;
+    }
+    w->bytes = sizeof(w->header);
+    return true;
+}
+
+// "size" bytes of "data", then zeros up to the alignment
+static bool write_part(FILE* f, const void* data, size_t size)
+{
+    static const unsigned char zeros[FRAME_CAPTURE_ALIGN] = { 0 };
+    const size_t padding = aligned(size) - size;
+    return (!size || fwrite(data, size, 1, f) == 1) && (!padding || fwrite(zeros, padding, 1, f) == 1);
+}
+
+bool frame_capture_write(FrameCaptureWriter* w, const FrameCaptureFrame* frame, const void* view, const void* models,
+    const uint32_t* materials)
+{
+    if (!w->file)
+        return false;
+    FrameCaptureFrame record = *frame;
+    const size_t model_bytes = models ? (size_t)record.visible_count * w->header.model_size : 0;
+    const size_t material_bytes = materials ? (size_t)record.visible_count * sizeof(uint32_t) : 0;
+    record.flags = (models ? FRAME_CAPTURE_MODELS : 0u) | (materials ? FRAME_CAPTURE_MATERIALS : 0u);
+    record.size = (uint32_t)(sizeof(record) + aligned(w->header.view_size) + aligned(model_bytes) + aligned(material_bytes));
+    if (!write_part(w->file, &record, sizeof(record)) || !write_part(w->file, view, w->header.view_size)
+        || !write_part(w->file, models, model_bytes) || !write_part(w->file, materials, material_bytes))
+    {
+        fprintf(stderr, "frame_capture: write failed after %u frames, capture stopped\n", w->header.frame_count);
+        fclose(w->file);
+        w->file = NULL;
+        return false;
+    }
+    w->bytes += record.size;
+    ++w->header.frame_count;
+    return true;
+}
+
+bool frame_capture_close(FrameCaptureWriter* w)
+{
+    if (!w->file)
+        return false;
+    bool ok = fseek(w->file, 0, SEEK_SET) == 0 && fwrite(&w->header, sizeof(w->header), 1, w->file) == 1;
+    ok = fclose(w->file) == 0 && ok;
+    w->file = NULL;
+    if (!ok)
+        fprintf(stderr, "frame_capture: can't finish the capture file\n");
+    else
+        printf("capture: %u frames, %.1f MB\n", w->header.frame_count, w->bytes / (1024.0 * 1024.0));
+    return ok;
+}
+
+bool frame_capture_open(FrameCaptureReader* r, const char* path)
+{
+    memset(r, 0, sizeof(*r));
+    if (!mapped_file_open(&r->file, path))
+        return false;
+    const unsigned char* base = (const unsigned char*)r->file.data;
+    const FrameCaptureHeader* header = (const FrameCaptureHeader*)base;
+    if (r->file.size < sizeof(*header) || header->magic != FRAME_CAPTURE_MAGIC || header->version != FRAME_CAPTURE_VERSION)
+    {
+        fprintf(stderr, "frame_capture: %s is not a version %d frame capture\n", path, FRAME_CAPTURE_VERSION);
+        frame_capture_close_reader(r);
+        return false;
+    }
+    r->header = header;
+
+    // Walk the records once: count them, then index them, stopping at the first one that doesn't fit
+    const size_t fixed = sizeof(FrameCaptureFrame) + aligned(header->view_size);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        uint32_t count = 0;
+        for (size_t offset = sizeof(*header); offset + sizeof(FrameCaptureFrame) <= r->file.size; ++count)
+        {
+            const FrameCaptureFrame* frame = (const FrameCaptureFrame*)(base + offset);
+            const size_t need = fixed
+                + (frame->flags & FRAME_CAPTURE_MODELS ? aligned((size_t)frame->visible_count * header->model_size) : 0)
+                + (frame->flags & FRAME_CAPTURE_MATERIALS ? aligned((size_t)frame->visible_count * sizeof(uint32_t)) : 0);
+            if (frame->size != need || offset + need > r->file.size)
+                break;
+            if (pass)
+                r->frames[count] = frame;
+            offset += need;
+        }
+        if (!pass)
+        {
+            if (!count)
+            {
+                fprintf(stderr, "frame_capture: %s has no complete frames\n", path);
+                frame_capture_close_reader(r);
+                return false;
+            }
+            if (header->frame_count && count != header->frame_count)
+                fprintf(stderr, "frame_capture: %s has %u of its %u frames\n", path, count, header->frame_count);
+            r->frames = (const FrameCaptureFrame**)malloc(sizeof(*r->frames) * count);
+            if (!r->frames)
+            {
+                frame_capture_close_reader(r);
+                return false;
+            }
+            r->frame_count = count;
+        }
+    }
+    return true;
+}
+
+void frame_capture_close_reader(FrameCaptureReader* r)
+{
+    free(r->frames);
+    mapped_file_close(&r->file);
+    memset(r, 0, sizeof(*r));
+}
+
+const void* frame_capture_view(const FrameCaptureReader* r, const FrameCaptureFrame* frame)
+{
+    return r->header->view_size ? (const void*)(frame + 1) : NULL;
+}
+
+const void* frame_capture_models(const FrameCaptureReader* r, const FrameCaptureFrame* frame)
+{
+    if (!(frame->flags & FRAME_CAPTURE_MODELS))
+        return NULL;
+    return (const unsigned char*)(frame + 1) + aligned(r->header->view_size);
+}
+
+const uint32_t* frame_capture_materials(const FrameCaptureReader* r, const FrameCaptureFrame* frame)
+{
+    if (!(frame->flags & FRAME_CAPTURE_MATERIALS))
+        return NULL;
+    const size_t models = frame->flags & FRAME_CAPTURE_MODELS ? aligned((size_t)frame->visible_count * r->header->model_size) : 0;
+    return (const uint32_t*)((const unsigned char*)(frame + 1) + aligned(r->header->view_size) + models);
+}
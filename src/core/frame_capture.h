@@ -0,0 +1,99 @@
+#pragma once
+
+#include "core/mapped_file.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Frame capture: the renderer's input for each frame, recorded so the same
+// frames can be replayed later without the simulation or any input.
+//
+// A frame is what the renderer turns into GL calls: the clock values its
+// uniforms are made of, the camera (the camera block), how many objects are
+// drawn and their model matrices and material indices (the instance or Draw
+// buffer uploads). State beyond that is fixed by the run's setup, which the
+// file header records. Replaying the records through the same renderer
+// reproduces the draws, uniforms and uploads of the captured frames exactly,
+// whatever the simulation would have done.
+//
+// The file: FrameCaptureHeader, then one record per frame, each a
+// FrameCaptureFrame followed by the view blob (header.view_size bytes, the
+// app's camera as is), the model matrices (model_size bytes each) and the
+// material indices, every part FRAME_CAPTURE_ALIGN aligned so a replay can
+// use them straight from the memory mapping. Little-endian, as written by the
+// host; the view blob is only meaningful to a build with the same layout,
+// which view_size stands in for.
+
+#define FRAME_CAPTURE_MAGIC 0x4346474Fu       // "OGFC"
+#define FRAME_CAPTURE_VERSION 1
+#define FRAME_CAPTURE_ALIGN 16
+
+// FrameCaptureFrame flags
+#define FRAME_CAPTURE_MODELS 1u         // the record has model matrices
+#define FRAME_CAPTURE_MATERIALS 2u      // and material indices
+
+typedef struct FrameCaptureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t view_size;         // bytes of each record's view blob
+    uint32_t model_size;        // bytes per model matrix
+    uint32_t mode;              // the app's setup, as it describes it (draw mode, culling, ...)
+    uint32_t flags;
+    uint32_t object_count;
+    uint32_t material_count;
+    uint32_t width, height;     // the first frame's framebuffer
+    uint32_t frame_count;       // written when the capture is closed properly; 0 means count the records
+    uint32_t reserved[5];
+} FrameCaptureHeader;
+
+typedef struct FrameCaptureFrame
+{
+    uint32_t size;              // the whole record, this header included, a multiple of FRAME_CAPTURE_ALIGN
+    uint32_t flags;             // FRAME_CAPTURE_*
+    uint32_t frame_index;
+    uint32_t visible_count;     // model matrices and material indices in the record
+    double time;                // the packet's clock values
+    double sim_time;
+    float delta;
+    uint32_t reserved[3];
+} FrameCaptureFrame;
+
+typedef struct FrameCaptureWriter
+{
+    FILE* file;
+    FrameCaptureHeader header;
+    uint64_t bytes;             // written so far, header included
+} FrameCaptureWriter;
+
+// Creates "path" and writes "header" (magic, version and frame_count are filled in). Logs and returns false
+// when the file can't be created.
+bool frame_capture_create(FrameCaptureWriter* w, const char* path, const FrameCaptureHeader* header);
+
+// Appends a record. "frame" supplies everything but size and flags; "models" (visible_count of them) and
+// "materials" may be NULL. Returns false (logged) when the write fails.
+bool frame_capture_write(FrameCaptureWriter* w, const FrameCaptureFrame* frame, const void* view, const void* models,
+    const uint32_t* materials);
+
+// Writes the frame count into the header and closes the file
+bool frame_capture_close(FrameCaptureWriter* w);
+
+// An open capture: every record found and checked at open
+typedef struct FrameCaptureReader
+{
+    MappedFile file;
+    const FrameCaptureHeader* header;
+    const FrameCaptureFrame** frames;   // [frame_count], into the mapping
+    uint32_t frame_count;
+} FrameCaptureReader;
+
+// Maps and validates "path": magic, version, and every record's bounds. A capture cut short (the app didn't
+// exit cleanly) opens with the complete records. Logs and returns false on failure.
+bool frame_capture_open(FrameCaptureReader* r, const char* path);
+void frame_capture_close_reader(FrameCaptureReader* r);
+
+// A record's parts, into the mapping; NULL where the record has none
+const void* frame_capture_view(const FrameCaptureReader* r, const FrameCaptureFrame* frame);
+const void* frame_capture_models(const FrameCaptureReader* r, const FrameCaptureFrame* frame);
+const uint32_t* frame_capture_materials(const FrameCaptureReader* r, const FrameCaptureFrame* frame);
@@ -0,0 +1,339 @@
+#include "core/frame_graph.h"
+
+#include <string.h>
+
+void frame_graph_reset(FrameGraph* g)
+{
+    g->pass_count = 0;
+    g->resource_count = 0;
+    g->physical_count = 0;
+    g->order_count = 0;
+    g->overflowed = false;
+    g->culled_count = 0;
+    g->transient_bytes = 0;
+    g->physical_bytes = 0;
+    g->barrier_count = 0;
+    g->async_count = 0;
+    g->wait_count = 0;
+    g->map_count = 0;
+    g->interop_map = g->interop_unmap = NULL;
+    g->interop_user = NULL;
+}
+
+static int frame_graph_add_resource(FrameGraph* g, const char* name, const FrameGraphTextureDesc* desc, bool imported)
+{
+    if (g->resource_count == FRAME_GRAPH_MAX_RESOURCES)
+    {
+        g->overflowed = true;
+        return -1;
+    }
+    FrameGraphResource* r = &g->resources[g->resource_count];
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    if (desc)
+        r->desc = *desc;
+    r->imported = imported;
+    r->first_use = r->last_use = -1;
+    r->physical = -1;
+    return g->resource_count++;
+}
+
+int frame_graph_import(FrameGraph* g, const char* name, const FrameGraphTextureDesc* desc, uintptr_t handle,
+    bool discard_on_entry)
+{
+    const int index = frame_graph_add_resource(g, name, desc, true);
+    if (index >= 0)
+    {
+        g->resources[index].handle = handle;
+        g->resources[index].discard_on_entry = discard_on_entry;
+    }
+    return index;
+}
+
+int frame_graph_create_texture(FrameGraph* g, const char* name, const FrameGraphTextureDesc* desc)
+{
+    return frame_graph_add_resource(g, name, desc, false);
+}
+
+int frame_graph_add_pass(FrameGraph* g, const char* name, FrameGraphExecute execute, void* user)
+{
+    if (g->pass_count == FRAME_GRAPH_MAX_PASSES)
+    {
+        g->overflowed = true;
+        return -1;
+    }
+    FrameGraphPass* p = &g->passes[g->pass_count];
+    memset(p, 0, sizeof(*p));
+    p->name = name;
+    p->execute = execute;
+    p->user = user;
+    return g->pass_count++;
+}
+
+static void frame_graph_use(FrameGraph* g, int pass, int resource, FrameGraphAccess access, bool write)
+{
+    if (pass < 0 || resource < 0 || g->passes[pass].use_count == FRAME_GRAPH_MAX_USES)
+    {
+        g->overflowed = true;
+        return;
+    }
+    FrameGraphUse* u = &g->passes[pass].uses[g->passes[pass].use_count++];
+    u->resource = (uint16_t)resource;
+    u->access = (uint8_t)access;
+    u->write = write;
+}
+
+void frame_graph_read(FrameGraph* g, int pass, int resource, FrameGraphAccess access)
+{
+    frame_graph_use(g, pass, resource, access, false);
+}
+
+void frame_graph_write(FrameGraph* g, int pass, int resource, FrameGraphAccess access)
+{
+    frame_graph_use(g, pass, resource, access, true);
+}
+
+void frame_graph_set_side_effects(FrameGraph* g, int pass)
+{
+    if (pass >= 0)
+        g->passes[pass].side_effects = true;
+}
+
+void frame_graph_set_async_compute(FrameGraph* g, int pass)
+{
+    if (pass >= 0)
+        g->passes[pass].async_compute = true;
+}
+
+void frame_graph_set_interop(FrameGraph* g, FrameGraphInterop map, FrameGraphInterop unmap, void* user)
+{
+    g->interop_map = map;
+    g->interop_unmap = unmap;
+    g->interop_user = user;
+}
+
+// Whether two passes' uses of a resource are ordered: both touch it and at least one writes
+static bool frame_graph_conflict(const FrameGraphPass* a, const FrameGraphPass* b)
+{
+    for (int i = 0; i < a->use_count; ++i)
+        for (int j = 0; j < b->use_count; ++j)
+            if (a->uses[i].resource == b->uses[j].resource && (a->uses[i].write || b->uses[j].write))
+                return true;
+    return false;
+}
+
+static bool frame_graph_pass_reads(const FrameGraphPass* p, int resource)
+{
+    for (int i = 0; i < p->use_count; ++i)
+        if (!p->uses[i].write && p->uses[i].resource == resource)
+            return true;
+    return false;
+}
+
+static bool desc_equal(const FrameGraphTextureDesc* a, const FrameGraphTextureDesc* b)
+{
+    return a->width == b->width && a->height == b->height && a->format == b->format && a->texel_bytes == b->texel_bytes;
+}
+
+static uint64_t desc_bytes(const FrameGraphTextureDesc* d)
+{
+    return (uint64_t)d->width * (uint64_t)d->height * d->texel_bytes;
+}
+
+bool frame_graph_compile(FrameGraph* g)
+{
+    if (g->overflowed)
+        return false;
+
+    // Culling, from the last pass back: a pass is kept when it writes something imported or read later. Its
+    // writes then end the need for what was there before (unless it reads it too), and its reads start one.
+    bool needed[FRAME_GRAPH_MAX_RESOURCES] = { false };
+    for (int p = g->pass_count - 1; p >= 0; --p)
+    {
+        FrameGraphPass* pass = &g->passes[p];
+        bool keep = pass->side_effects;
+        for (int i = 0; i < pass->use_count && !keep; ++i)
+            keep = pass->uses[i].write && (g->resources[pass->uses[i].resource].imported || needed[pass->uses[i].resource]);
+        pass->culled = !keep;
+        if (!keep)
+            continue;
+        for (int i = 0; i < pass->use_count; ++i)
+            if (pass->uses[i].write)
+                needed[pass->uses[i].resource] = false;
+        for (int i = 0; i < pass->use_count; ++i)
+            if (!pass->uses[i].write)
+                needed[pass->uses[i].resource] = true;
+    }
+
+    // Lifetimes over the passes that run, and what each one may discard
+    g->order_count = 0;
+    g->culled_count = 0;
+    bool written[FRAME_GRAPH_MAX_RESOURCES] = { false };
+    for (int p = 0; p < g->pass_count; ++p)
+    {
+        FrameGraphPass* pass = &g->passes[p];
+        pass->discard = 0;
+        pass->barriers = 0;
+        pass->map = pass->unmap = 0;
+        if (pass->culled)
+        {
+            ++g->culled_count;
+            continue;
+        }
+        const int step = g->order_count;
+        g->order[g->order_count++] = p;
+        for (int i = 0; i < pass->use_count; ++i)
+        {
+            const int r = pass->uses[i].resource;
+            FrameGraphResource* res = &g->resources[r];
+            const bool reads = frame_graph_pass_reads(pass, r);
+            if (!res->imported && ((reads && !written[r]) || pass->uses[i].access == FRAME_GRAPH_EXTERNAL))
+                return false;   // read before anything wrote it, or handed to another API that can't have it
+            if (pass->uses[i].write && !written[r] && !reads && (!res->imported || res->discard_on_entry))
+                pass->discard |= 1ull << r;
+            if (pass->uses[i].write)
+                written[r] = true;
+            if (res->first_use < 0)
+                res->first_use = step;
+            res->last_use = step;
+        }
+    }
+
+    // Aliasing: transients in order of first use, each on the first physical texture of its description that
+    // the ones before it are done with
+    int sorted[FRAME_GRAPH_MAX_RESOURCES];
+    int sorted_count = 0;
+    g->physical_count = 0;
+    g->transient_bytes = 0;
+    g->physical_bytes = 0;
+    for (int r = 0; r < g->resource_count; ++r)
+    {
+        const FrameGraphResource* res = &g->resources[r];
+        if (res->imported || res->first_use < 0)
+            continue;
+        int k = sorted_count++;
+        for (; k > 0 && g->resources[sorted[k - 1]].first_use > res->first_use; --k)
+            sorted[k] = sorted[k - 1];
+        sorted[k] = r;
+    }
+    for (int k = 0; k < sorted_count; ++k)
+    {
+        FrameGraphResource* res = &g->resources[sorted[k]];
+        g->transient_bytes += desc_bytes(&res->desc);
+        int physical = -1;
+        for (int i = 0; i < g->physical_count && physical < 0; ++i)
+            if (g->physical[i].last_use < res->first_use && desc_equal(&g->physical[i].desc, &res->desc))
+                physical = i;
+        if (physical < 0)
+        {
+            physical = g->physical_count++;
+            g->physical[physical].desc = res->desc;
+            g->physical[physical].handle = 0;
+            g->physical_bytes += desc_bytes(&res->desc);
+        }
+        g->physical[physical].last_use = res->last_use;
+        res->physical = physical;
+    }
+
+    // Barriers, per piece of memory: a transient's physical texture (an alias written by imageStore is the same
+    // memory as the next one on it), or the imported resource itself
+    int last_shader_write[2 * FRAME_GRAPH_MAX_RESOURCES];
+    int issued[FRAME_GRAPH_ACCESS_COUNT];
+    for (int i = 0; i < 2 * FRAME_GRAPH_MAX_RESOURCES; ++i)
+        last_shader_write[i] = -1;
+    for (int a = 0; a < FRAME_GRAPH_ACCESS_COUNT; ++a)
+        issued[a] = -1;
+    g->barrier_count = 0;
+    for (int step = 0; step < g->order_count; ++step)
+    {
+        FrameGraphPass* pass = &g->passes[g->order[step]];
+        for (int i = 0; i < pass->use_count; ++i)
+        {
+            const FrameGraphResource* res = &g->resources[pass->uses[i].resource];
+            const int memory = res->imported ? pass->uses[i].resource : FRAME_GRAPH_MAX_RESOURCES + res->physical;
+            if (pass->uses[i].access == FRAME_GRAPH_EXTERNAL)
+                continue;       // mapping it waits for GL's writes
+            // A barrier issued before a pass covers the writes of the passes before it
+            if (last_shader_write[memory] >= 0 && issued[pass->uses[i].access] <= last_shader_write[memory])
+                pass->barriers |= FRAME_GRAPH_BARRIER(pass->uses[i].access);
+        }
+        for (int a = 0; a < FRAME_GRAPH_ACCESS_COUNT; ++a)
+            if (pass->barriers & FRAME_GRAPH_BARRIER(a))
+                issued[a] = step;
+        g->barrier_count += pass->barriers != 0;
+        for (int i = 0; i < pass->use_count; ++i)
+        {
+            const FrameGraphUse* u = &pass->uses[i];
+            const FrameGraphResource* res = &g->resources[u->resource];
+            if (u->write && (u->access == FRAME_GRAPH_IMAGE || u->access == FRAME_GRAPH_STORAGE))
+                last_shader_write[res->imported ? u->resource : FRAME_GRAPH_MAX_RESOURCES + res->physical] = step;
+        }
+    }
+
+    // Queues: an async pass ordered after a graphics one stays on the graphics queue, which then runs it in
+    // order; a graphics pass ordered after async ones waits for the latest
+    g->async_count = 0;
+    g->wait_count = 0;
+    for (int step = 0; step < g->order_count; ++step)
+    {
+        FrameGraphPass* pass = &g->passes[g->order[step]];
+        pass->async = pass->async_compute;
+        pass->wait = -1;
+        for (int earlier = 0; earlier < step && pass->async; ++earlier)
+        {
+            const FrameGraphPass* before = &g->passes[g->order[earlier]];
+            if (!before->async && frame_graph_conflict(pass, before))
+                pass->async = false;
+        }
+        for (int earlier = step - 1; earlier >= 0 && !pass->async && pass->wait < 0; --earlier)
+        {
+            const FrameGraphPass* before = &g->passes[g->order[earlier]];
+            if (before->async && frame_graph_conflict(pass, before))
+                pass->wait = g->order[earlier];
+        }
+        g->async_count += pass->async;
+        g->wait_count += pass->wait >= 0;
+    }
+
+    // Interop: a resource is mapped before the first of a run of external uses and given back after the last,
+    // the run ending at a use of any other kind or with the frame
+    g->map_count = 0;
+    int mapped_by[FRAME_GRAPH_MAX_RESOURCES];      // the run's latest pass, -1 when not mapped
+    for (int r = 0; r < g->resource_count; ++r)
+        mapped_by[r] = -1;
+    for (int step = 0; step < g->order_count; ++step)
+    {
+        const int p = g->order[step];
+        FrameGraphPass* pass = &g->passes[p];
+        for (int i = 0; i < pass->use_count; ++i)
+        {
+            const int r = pass->uses[i].resource;
+            if (pass->uses[i].access != FRAME_GRAPH_EXTERNAL)
+            {
+                if (mapped_by[r] >= 0)
+                    g->passes[mapped_by[r]].unmap |= 1ull << r;
+                mapped_by[r] = -1;
+                continue;
+            }
+            if (mapped_by[r] < 0)
+            {
+                pass->map |= 1ull << r;
+                ++g->map_count;
+            }
+            mapped_by[r] = p;
+        }
+    }
+    for (int r = 0; r < g->resource_count; ++r)
+        if (mapped_by[r] >= 0)
+            g->passes[mapped_by[r]].unmap |= 1ull << r;
+    return true;
+}
+
+int frame_graph_pass_output(const FrameGraph* g, int pass, FrameGraphAccess access)
+{
+    const FrameGraphPass* p = &g->passes[pass];
+    for (int i = 0; i < p->use_count; ++i)
+        if (p->uses[i].write && p->uses[i].access == access)
+            return p->uses[i].resource;
+    return -1;
+}
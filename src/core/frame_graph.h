@@ -0,0 +1,187 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Frame graph: passes declare the resources they read and write, and
+// compiling the graph works out what the hand-ordered renderer had to keep
+// track of itself.
+//
+//   culling:   a pass runs only if something that outlives the frame depends
+//              on it: it writes an imported resource (the window, the scene
+//              target, a persistent buffer), has side effects, or writes what
+//              a running pass reads later. A full overwrite ends a resource's
+//              earlier contents, so their writers don't count.
+//   barriers:  image and shader storage writes aren't visible to later reads
+//              until a glMemoryBarrier with the bit for how they are read. Each
+//              pass gets the bits its reads need of the writes before it, and
+//              a bit is issued once for every write since it last was.
+//              Attachment writes read back by sampling need none.
+//   aliasing:  transient textures are only alive from their first use to
+//              their last. Ones that never overlap share a physical texture,
+//              so a chain of passes needs as many as are alive at once. GL
+//              textures can't share memory across sizes or formats, so only
+//              textures with the same description alias.
+//   queues:    a compute pass may ask to run on an async compute queue, in
+//              a submission of its own that overlaps the graphics one. It
+//              stays on the graphics queue when it uses anything an earlier
+//              graphics pass of the frame wrote, or writes anything one used,
+//              so each queue's passes go in one submission, async compute's
+//              first. A graphics pass that uses what an async pass wrote, or
+//              writes what one read, waits for it; GL has one queue and runs
+//              them all in order anyway.
+//   interop:   an imported resource another API works on (CUDA or OpenCL,
+//              through GL interop) is mapped to it for the passes that use
+//              it FRAME_GRAPH_EXTERNAL, and given back before the next pass
+//              that uses it any other way. A run of such passes shares one
+//              mapping: each pass gets the resources to map before it and
+//              to unmap after it, which the executor hands to the hooks
+//              frame_graph_set_interop set. Mapping and unmapping are the
+//              synchronisation, so external uses need no barriers.
+//
+// Passes run in the order they were added; a pass only reads what earlier
+// passes wrote. Nothing here calls GL: gl/frame_graph_gl.h runs the result,
+// and vk/vulkan_renderer.cpp runs the Vulkan frame's on two queues.
+// Capacities are fixed and the graph is rebuilt every frame, from
+// frame_graph_reset, at the cost of a few loops over these arrays.
+
+#define FRAME_GRAPH_MAX_PASSES 64
+#define FRAME_GRAPH_MAX_RESOURCES 64        // a bit each in FrameGraphPass::discard
+#define FRAME_GRAPH_MAX_USES 8              // reads and writes of one pass
+
+typedef enum FrameGraphAccess
+{
+    FRAME_GRAPH_ATTACHMENT,     // drawn into; as a read, blended onto or depth tested against
+    FRAME_GRAPH_SAMPLED,        // texture() / texelFetch
+    FRAME_GRAPH_IMAGE,          // imageLoad / imageStore
+    FRAME_GRAPH_STORAGE,        // shader storage buffer
+    FRAME_GRAPH_UNIFORM,        // uniform block
+    FRAME_GRAPH_INDIRECT,       // draw or dispatch arguments
+    FRAME_GRAPH_VERTEX,         // vertex attributes or indices
+    FRAME_GRAPH_EXTERNAL,       // another API's, through interop; imported resources only
+    FRAME_GRAPH_ACCESS_COUNT
+} FrameGraphAccess;
+
+// FrameGraphPass::barriers: the ways its reads need earlier shader writes made visible
+#define FRAME_GRAPH_BARRIER(access) (1u << (access))
+
+typedef struct FrameGraph FrameGraph;
+
+// Issues the pass's commands; "pass" is its index in the graph
+typedef void (*FrameGraphExecute)(void* user, const FrameGraph* graph, int pass);
+
+// Maps or unmaps the resources in "resources" (a bit per index) for the API that uses them FRAME_GRAPH_EXTERNAL
+typedef void (*FrameGraphInterop)(void* user, const FrameGraph* graph, uint64_t resources);
+
+typedef struct FrameGraphTextureDesc
+{
+    int width;
+    int height;
+    uint32_t format;            // the API's format value; aliasing needs it equal
+    uint32_t texel_bytes;       // for the memory totals
+} FrameGraphTextureDesc;
+
+typedef struct FrameGraphUse
+{
+    uint16_t resource;
+    uint8_t access;             // FrameGraphAccess
+    bool write;
+} FrameGraphUse;
+
+typedef struct FrameGraphResource
+{
+    const char* name;
+    FrameGraphTextureDesc desc; // all 0 for a buffer
+    bool imported;              // lives outside the frame: never aliased, and writing it keeps the pass
+    bool discard_on_entry;      // imported: its contents before the first write aren't needed
+    uintptr_t handle;           // imported: the caller's object; transient: the physical one, while executing
+    // Compiled:
+    int first_use;              // positions in the run order; -1 when no pass that runs uses it
+    int last_use;
+    int physical;               // transient: index into FrameGraph::physical, -1 when unused or imported
+} FrameGraphResource;
+
+typedef struct FrameGraphPass
+{
+    const char* name;
+    FrameGraphExecute execute;
+    void* user;
+    FrameGraphUse uses[FRAME_GRAPH_MAX_USES];
+    int use_count;
+    bool side_effects;          // runs even when nothing reads what it writes
+    bool async_compute;         // asked to run on the async compute queue
+    // Compiled:
+    bool culled;
+    bool async;                 // runs on the async compute queue
+    int wait;                   // a graphics pass's: the latest async pass it must wait for, -1 for none
+    uint32_t barriers;          // FRAME_GRAPH_BARRIER bits to issue before it
+    uint64_t discard;           // resources (bit per index) whose contents it needn't load: it overwrites them first
+    uint64_t map;               // resources to map for their external API before it
+    uint64_t unmap;             // and to give back after it
+} FrameGraphPass;
+
+typedef struct FrameGraphPhysical
+{
+    FrameGraphTextureDesc desc;
+    int last_use;               // of the transients sharing it, the latest
+    uintptr_t handle;           // the executor's texture while running
+} FrameGraphPhysical;
+
+struct FrameGraph
+{
+    FrameGraphPass passes[FRAME_GRAPH_MAX_PASSES];
+    int pass_count;
+    FrameGraphResource resources[FRAME_GRAPH_MAX_RESOURCES];
+    int resource_count;
+    FrameGraphPhysical physical[FRAME_GRAPH_MAX_RESOURCES];
+    int physical_count;
+    int order[FRAME_GRAPH_MAX_PASSES];      // the passes that run, in order
+    int order_count;
+    bool overflowed;            // something didn't fit: compile fails
+    // Compile's totals
+    int culled_count;
+    uint64_t transient_bytes;   // every transient that's used, each on its own
+    uint64_t physical_bytes;    // what the aliased ones take
+    uint32_t barrier_count;     // passes that issue a barrier
+    int async_count;            // passes on the async compute queue
+    int wait_count;             // graphics passes that wait for one
+    int map_count;              // interop mappings
+    // Set after frame_graph_reset
+    FrameGraphInterop interop_map;
+    FrameGraphInterop interop_unmap;
+    void* interop_user;
+};
+
+// Empties the graph for a new frame
+void frame_graph_reset(FrameGraph* g);
+
+// A resource made outside the graph. "desc" may be NULL (a buffer, or a target whose description doesn't matter).
+// Returns its index, or -1 when the graph is full.
+int frame_graph_import(FrameGraph* g, const char* name, const FrameGraphTextureDesc* desc, uintptr_t handle,
+    bool discard_on_entry);
+
+// A texture that only lives for this frame; the executor makes it (or one it aliases)
+int frame_graph_create_texture(FrameGraph* g, const char* name, const FrameGraphTextureDesc* desc);
+
+// Returns the pass's index, or -1 when the graph is full
+int frame_graph_add_pass(FrameGraph* g, const char* name, FrameGraphExecute execute, void* user);
+void frame_graph_read(FrameGraph* g, int pass, int resource, FrameGraphAccess access);
+void frame_graph_write(FrameGraph* g, int pass, int resource, FrameGraphAccess access);
+void frame_graph_set_side_effects(FrameGraph* g, int pass);
+// A compute pass that may run on the async compute queue
+void frame_graph_set_async_compute(FrameGraph* g, int pass);
+// What maps and unmaps the resources used FRAME_GRAPH_EXTERNAL; the executor calls them around the passes
+void frame_graph_set_interop(FrameGraph* g, FrameGraphInterop map, FrameGraphInterop unmap, void* user);
+
+// Culls, then places lifetimes, physical textures, barriers, queues and interop mappings. False when the graph
+// overflowed, a running pass reads a transient nothing wrote before it, or a transient is used FRAME_GRAPH_EXTERNAL.
+bool frame_graph_compile(FrameGraph* g);
+
+// A pass's first written resource with "access", -1 when there's none
+int frame_graph_pass_output(const FrameGraph* g, int pass, FrameGraphAccess access);
+
+// A resource's description (zeros for a buffer imported without one)
+static inline const FrameGraphTextureDesc* frame_graph_desc(const FrameGraph* g, int resource)
+{
+    return &g->resources[resource].desc;
+}
@@ -0,0 +1,249 @@
+#include "core/frame_pacer.h"
+
+#include <chrono>
+#include <math.h>
+#include <string.h>
+#include <thread>
+
+#define FRAME_PACER_SPIN_MARGIN 0.0002  // always spin the last 0.2 ms: sleep wake-ups are never that exact
+#define FRAME_SMOOTHER_MAX_STEP 0.1     // one step never simulates more than 100 ms
+#define FRAME_SMOOTHER_MAX_DRIFT 0.1    // further than this from the wall clock and the clock snaps back
+
+void frame_histogram_clear(FrameHistogram* h)
+{
+    memset(h->buckets, 0, sizeof(h->buckets));
+    h->count = 0;
+    h->sum_ms = 0.0;
+    h->max_ms = 0.0;
+}
+
+void frame_histogram_add(FrameHistogram* h, double ms)
+{
+    int bucket = (int)(ms / FRAME_HISTOGRAM_BUCKET_MS);
+    if (bucket < 0)
+        bucket = 0;
+    if (bucket >= FRAME_HISTOGRAM_BUCKETS)
+        bucket = FRAME_HISTOGRAM_BUCKETS - 1;
+    ++h->buckets[bucket];
+    ++h->count;
+    h->sum_ms += ms;
+    if (ms > h->max_ms)
+        h->max_ms = ms;
+}
+
+double frame_histogram_percentile(const FrameHistogram* h, double fraction)
+{
+    if (!h->count)
+        return 0.0;
+    const uint64_t target = (uint64_t)ceil(fraction * (double)h->count);
+    uint64_t seen = 0;
+    for (int i = 0; i < FRAME_HISTOGRAM_BUCKETS - 1; ++i)
+    {
+        seen += h->buckets[i];
+        if (seen >= target && seen > 0)
+            return (i + 1) * FRAME_HISTOGRAM_BUCKET_MS;
+    }
+    return h->max_ms;   // in the open-ended last bucket
+}
+
+void frame_histogram_print(const FrameHistogram* h, const char* name, FILE* out)
+{
+    if (!h->count)
+        return;
+    fprintf(out, "%s: %llu frames, mean %.2f ms, p50 %.1f, p90 %.1f, p99 %.1f, max %.2f ms\n", name,
+        (unsigned long long)h->count, h->sum_ms / (double)h->count, frame_histogram_percentile(h, .5),
+        frame_histogram_percentile(h, .9), frame_histogram_percentile(h, .99), h->max_ms);
+    uint32_t widest = 0;
+    for (int i = 0; i < FRAME_HISTOGRAM_BUCKETS; ++i)
+        widest = h->buckets[i] > widest ? h->buckets[i] : widest;
+    for (int i = 0; i < FRAME_HISTOGRAM_BUCKETS; ++i)
+    {
+        if (!h->buckets[i])
+            continue;
+        const int bar = (int)((h->buckets[i] * 40ull + widest - 1) / widest);
+        if (i < FRAME_HISTOGRAM_BUCKETS - 1)
+            fprintf(out, "  %5.1f-%5.1f ms %8u %.*s\n", i * FRAME_HISTOGRAM_BUCKET_MS, (i + 1) * FRAME_HISTOGRAM_BUCKET_MS,
+                h->buckets[i], bar, "########################################");
+        else
+            fprintf(out, "  %5.1f+    ms %8u %.*s\n", i * FRAME_HISTOGRAM_BUCKET_MS, h->buckets[i], bar,
+                "########################################");
+    }
+}
+
+void frame_pacer_init(FramePacer* p, VsyncMode vsync, double fps_limit, bool low_latency)
+{
+    p->vsync.store((int)vsync, std::memory_order_relaxed);
+    p->fps_limit.store(fps_limit > 0.0 ? fps_limit : 0.0, std::memory_order_relaxed);
+    p->tear_supported = false;
+    p->swap_interval = -2;
+    p->deadline = 0.0;
+    p->overshoot = 0.0;
+    p->last_frame = 0.0;
+    p->late_frames = 0;
+    frame_histogram_clear(&p->histogram);
+    p->low_latency.store(low_latency, std::memory_order_relaxed);
+    p->last_latency_ms.store(0.0, std::memory_order_relaxed);
+    frame_histogram_clear(&p->latency);
+}
+
+void frame_pacer_set_vsync(FramePacer* p, VsyncMode vsync)
+{
+    p->vsync.store((int)vsync, std::memory_order_relaxed);
+}
+
+void frame_pacer_set_fps_limit(FramePacer* p, double fps_limit)
+{
+    p->fps_limit.store(fps_limit > 0.0 ? fps_limit : 0.0, std::memory_order_relaxed);
+}
+
+void frame_pacer_set_low_latency(FramePacer* p, bool low_latency)
+{
+    p->low_latency.store(low_latency, std::memory_order_relaxed);
+}
+
+bool frame_pacer_low_latency(const FramePacer* p)
+{
+    return p->low_latency.load(std::memory_order_relaxed);
+}
+
+bool frame_pacer_swap_interval(FramePacer* p, int* interval)
+{
+    const int mode = p->vsync.load(std::memory_order_relaxed);
+    const int wanted = mode == VSYNC_OFF ? 0 : mode == VSYNC_ADAPTIVE && p->tear_supported ? -1 : 1;
+    if (wanted == p->swap_interval)
+        return false;
+    p->swap_interval = wanted;
+    *interval = wanted;
+    return true;
+}
+
+double frame_pacer_now(void)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void frame_pacer_wait_until(double deadline, double* overshoot)
+{
+    for (;;)
+    {
+        const double remaining = deadline - frame_pacer_now();
+        if (remaining <= 0.0)
+            return;
+        const double sleep = remaining - *overshoot - FRAME_PACER_SPIN_MARGIN;
+        if (sleep <= 0.0)
+        {
+            std::this_thread::yield();  // the spin: close enough that another sleep would wake late
+            continue;
+        }
+        // The overshoot estimate jumps to any worse wake-up and decays slowly, so one lucky sleep
+        // doesn't make the next one late
+        const double start = frame_pacer_now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(sleep));
+        const double error = frame_pacer_now() - start - sleep;
+        *overshoot = error > *overshoot ? error : *overshoot * 0.95 + (error > 0.0 ? error : 0.0) * 0.05;
+    }
+}
+
+void frame_pacer_wait(FramePacer* p)
+{
+    const double limit = p->fps_limit.load(std::memory_order_relaxed);
+    if (limit <= 0.0)
+    {
+        p->deadline = 0.0;
+        return;
+    }
+    const double period = 1.0 / limit;
+    const double now = frame_pacer_now();
+    if (p->deadline <= 0.0)
+        p->deadline = now;      // the first limited frame goes at once
+    if (now < p->deadline)
+        frame_pacer_wait_until(p->deadline, &p->overshoot);
+    else if (now > p->deadline)
+    {
+        // Late: keep to the cadence if it's within a frame, otherwise restart it from now rather than
+        // rushing out the frames that were missed
+        ++p->late_frames;
+        if (now - p->deadline > period)
+            p->deadline = now;
+    }
+    p->deadline += period;
+}
+
+void frame_pacer_frame_done(FramePacer* p)
+{
+    const double now = frame_pacer_now();
+    if (p->last_frame > 0.0)
+        frame_histogram_add(&p->histogram, (now - p->last_frame) * 1000.0);
+    p->last_frame = now;
+}
+
+void frame_pacer_input_presented(FramePacer* p, double input_time)
+{
+    if (input_time <= 0.0)
+        return;
+    const double ms = (p->last_frame - input_time) * 1000.0;
+    frame_histogram_add(&p->latency, ms);
+    p->last_latency_ms.store(ms, std::memory_order_relaxed);
+}
+
+void frame_pacer_print(const FramePacer* p, FILE* out)
+{
+    static const char* mode_names[] = { "off", "on", "adaptive" };
+    const int mode = p->vsync.load(std::memory_order_relaxed);
+    const double limit = p->fps_limit.load(std::memory_order_relaxed);
+    fprintf(out, "frame pacing: vsync %s (swap interval %d%s)", mode_names[mode], p->swap_interval,
+        mode == VSYNC_ADAPTIVE && !p->tear_supported ? ", no swap_control_tear" : "");
+    if (limit > 0.0)
+        fprintf(out, ", limit %.1f fps, %llu late, sleep overshoot %.3f ms", limit, (unsigned long long)p->late_frames,
+            p->overshoot * 1000.0);
+    fprintf(out, "%s\n", frame_pacer_low_latency(p) ? ", low latency" : "");
+    frame_histogram_print(&p->histogram, "frame times", out);
+    frame_histogram_print(&p->latency, "input to swap", out);
+}
+
+void frame_smoother_init(FrameSmoother* s, bool enabled)
+{
+    s->enabled = enabled;
+    s->count = 0;
+    s->next = 0;
+    s->time = 0.0;
+    s->last = 0.0;
+}
+
+double frame_smoother_step(FrameSmoother* s, double now, float* delta)
+{
+    if (s->last <= 0.0)
+    {
+        s->time = s->last = now;
+        *delta = 0.f;
+        return now;
+    }
+    const double raw = now - s->last;
+    s->last = now;
+    if (!s->enabled)
+    {
+        s->count = 0;
+        s->time = now;
+        *delta = (float)raw;
+        return now;
+    }
+    // Every delta contributes an eighth to each of the next eight steps, so over time the clock advances
+    // by what passed, minus whatever the clamp cut off; the drift check recovers that
+    s->deltas[s->next] = raw < 0.0 ? 0.0 : raw > FRAME_SMOOTHER_MAX_STEP ? FRAME_SMOOTHER_MAX_STEP : raw;
+    s->next = (s->next + 1) % FRAME_SMOOTHER_WINDOW;
+    if (s->count < FRAME_SMOOTHER_WINDOW)
+        ++s->count;
+    double sum = 0.0;
+    for (int i = 0; i < s->count; ++i)
+        sum += s->deltas[i];
+    const double step = sum / s->count;
+    s->time += step;
+    if (fabs(s->time - now) > FRAME_SMOOTHER_MAX_DRIFT)
+    {
+        s->time = now;      // and forget the stall, or the next steps would replay it
+        s->count = 0;
+        s->next = 0;
+    }
+    *delta = (float)step;
+    return s->time;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+
+// Frame pacing: vsync mode, an optional frame-rate limiter, frame-time
+// smoothing for the simulation clock, and frame-time histograms.
+//
+// With plain vsync (swap interval 1) a frame that misses one vblank waits for
+// the next, so 17 ms of work shows as 33 ms. Adaptive vsync (swap interval -1,
+// WGL/GLX_EXT_swap_control_tear) swaps late frames immediately and tears
+// instead; frame_pacer_swap_interval falls back to 1 where the extension is
+// missing. The limiter caps the rate below the refresh (or without vsync) by
+// waiting before the swap: it sleeps until just short of the deadline and
+// spins the rest, learning how far the OS sleep overshoots so it neither
+// wakes late nor spins longer than it has to.
+//
+// Low-latency mode trades throughput for input-to-photon latency. With vsync
+// the driver queues up finished frames, each a refresh of delay between when
+// input was sampled and when it's shown. In this mode the presenting thread
+// waits on a fence after every swap, so at most one frame is ever queued.
+// Where the caller runs the whole frame on one thread it also moves the
+// limiter wait ahead of input sampling, so input is read as late as it can
+// be. The time from an input event to the swap of the first frame that saw
+// it goes into the "latency" histogram.
+//
+// The mode, limit and low-latency switch may be changed from any thread (the
+// key callback) and take effect on the presenting thread's next frame;
+// everything else belongs to the presenting thread. Nothing here touches GL
+// or GLFW: the caller applies the swap interval and waits on the fence.
+
+typedef enum VsyncMode
+{
+    VSYNC_OFF,          // swap interval 0
+    VSYNC_ON,           // 1: every swap waits for a vblank
+    VSYNC_ADAPTIVE,     // -1: late swaps tear instead of waiting a whole extra refresh
+    VSYNC_MODE_COUNT
+} VsyncMode;
+
+#define FRAME_HISTOGRAM_BUCKETS   100       // the last bucket also collects everything slower
+#define FRAME_HISTOGRAM_BUCKET_MS 0.5
+
+typedef struct FrameHistogram
+{
+    uint32_t buckets[FRAME_HISTOGRAM_BUCKETS];  // frame times in FRAME_HISTOGRAM_BUCKET_MS steps
+    uint64_t count;
+    double sum_ms;
+    double max_ms;
+} FrameHistogram;
+
+void frame_histogram_clear(FrameHistogram* h);
+void frame_histogram_add(FrameHistogram* h, double ms);
+
+// Upper edge of the bucket holding the "fraction" (0..1) quantile, in milliseconds
+double frame_histogram_percentile(const FrameHistogram* h, double fraction);
+
+// Mean, percentiles and a bar per occupied bucket
+void frame_histogram_print(const FrameHistogram* h, const char* name, FILE* out);
+
+typedef struct FramePacer
+{
+    std::atomic<int> vsync;             // VsyncMode: requested, any thread
+    std::atomic<double> fps_limit;      // frames per second, 0 for no limit: any thread
+    bool tear_supported;                // the context has *_EXT_swap_control_tear: set before the first frame
+    int swap_interval;                  // the interval last handed out, -2 before the first
+    double deadline;                    // limiter: when the next swap is due (frame_pacer_now seconds)
+    double overshoot;                   // limiter: how late a sleep has woken, decaying
+    double last_frame;                  // when the previous frame finished, 0 before the first
+    uint64_t late_frames;               // limiter: frames that reached the wait after their deadline
+    FrameHistogram histogram;           // present-to-present frame times
+    std::atomic<bool> low_latency;      // any thread
+    std::atomic<double> last_latency_ms;    // the latest input-to-swap time, for display on any thread
+    FrameHistogram latency;             // input-to-swap times
+} FramePacer;
+
+void frame_pacer_init(FramePacer* p, VsyncMode vsync, double fps_limit, bool low_latency);
+
+// Any thread
+void frame_pacer_set_vsync(FramePacer* p, VsyncMode vsync);
+void frame_pacer_set_fps_limit(FramePacer* p, double fps_limit);
+void frame_pacer_set_low_latency(FramePacer* p, bool low_latency);
+bool frame_pacer_low_latency(const FramePacer* p);
+
+// Presenting thread: true when the swap interval for the current mode differs from the one last
+// returned, with the new one (0, 1 or -1) in "interval" for glfwSwapInterval
+bool frame_pacer_swap_interval(FramePacer* p, int* interval);
+
+// Presenting thread, right before the swap: waits out the limiter's deadline, if there is a limit
+void frame_pacer_wait(FramePacer* p);
+
+// Presenting thread, right after the swap: records the frame's time
+void frame_pacer_frame_done(FramePacer* p);
+
+// Presenting thread, after frame_pacer_frame_done: the frame's input was sampled with the earliest
+// unsampled event at "input_time" (frame_pacer_now seconds); 0 when there was none
+void frame_pacer_input_presented(FramePacer* p, double input_time);
+
+// Mode, limit and the frame-time and latency histograms
+void frame_pacer_print(const FramePacer* p, FILE* out);
+
+// Steady clock, in seconds
+double frame_pacer_now(void);
+
+// Sleeps then spins until frame_pacer_now() >= "deadline". "overshoot" is the sleep error learned so
+// far (seconds), updated in place; frame_pacer_wait is this plus the deadline bookkeeping.
+void frame_pacer_wait_until(double deadline, double* overshoot);
+
+// The simulation clock. Raw frame deltas jitter with scheduling and vsync phase; stepping the
+// simulation by them makes motion judder even at a steady frame rate. With smoothing on, the clock
+// advances by the mean of the last FRAME_SMOOTHER_WINDOW deltas (each clamped, so a stall is not
+// replayed as one huge step) and is pulled back to the wall clock if it drifts too far from it.
+#define FRAME_SMOOTHER_WINDOW 8
+
+typedef struct FrameSmoother
+{
+    bool enabled;
+    double deltas[FRAME_SMOOTHER_WINDOW];
+    int count;                  // deltas held, up to the window
+    int next;
+    double time;                // simulated time, 0 before the first step
+    double last;                // wall clock at the previous step
+} FrameSmoother;
+
+void frame_smoother_init(FrameSmoother* s, bool enabled);
+
+// Advances by the wall-clock time "now" (seconds) and returns the time to simulate, with the step
+// taken in "delta". Toggling "enabled" between steps is fine.
+double frame_smoother_step(FrameSmoother* s, double now, float* delta);
@@ -0,0 +1,72 @@
+#include "core/frame_queue.h"
+
+void frame_queue_init(FrameQueue* q, void* const* packets)
+{
+    for (int i = 0; i < FRAME_QUEUE_SLOTS; ++i)
+    {
+        q->packets[i] = packets[i];
+        q->state[i] = FRAME_SLOT_FREE;
+    }
+    q->next_write = 0;
+    q->next_read = 0;
+    q->closed = false;
+}
+
+void* frame_queue_try_acquire_write(FrameQueue* q)
+{
+    std::lock_guard<std::mutex> lock(q->mutex);
+    if (q->closed || q->state[q->next_write] != FRAME_SLOT_FREE)
+        return NULL;
+    q->state[q->next_write] = FRAME_SLOT_WRITING;
+    return q->packets[q->next_write];
+}
+
+void* frame_queue_acquire_write(FrameQueue* q)
+{
+    std::unique_lock<std::mutex> lock(q->mutex);
+    q->freed.wait(lock, [q] { return q->closed || q->state[q->next_write] == FRAME_SLOT_FREE; });
+    if (q->closed)
+        return NULL;
+    q->state[q->next_write] = FRAME_SLOT_WRITING;
+    return q->packets[q->next_write];
+}
+
+void frame_queue_publish(FrameQueue* q)
+{
+    {
+        std::lock_guard<std::mutex> lock(q->mutex);
+        q->state[q->next_write] = FRAME_SLOT_READY;
+        q->next_write = (q->next_write + 1) % FRAME_QUEUE_SLOTS;
+    }
+    q->ready.notify_one();
+}
+
+void* frame_queue_acquire_read(FrameQueue* q)
+{
+    std::unique_lock<std::mutex> lock(q->mutex);
+    q->ready.wait(lock, [q] { return q->closed || q->state[q->next_read] == FRAME_SLOT_READY; });
+    if (q->state[q->next_read] != FRAME_SLOT_READY)
+        return NULL;
+    q->state[q->next_read] = FRAME_SLOT_READING;
+    return q->packets[q->next_read];
+}
+
+void frame_queue_release(FrameQueue* q)
+{
+    {
+        std::lock_guard<std::mutex> lock(q->mutex);
+        q->state[q->next_read] = FRAME_SLOT_FREE;
+        q->next_read = (q->next_read + 1) % FRAME_QUEUE_SLOTS;
+    }
+    q->freed.notify_one();
+}
+
+void frame_queue_close(FrameQueue* q)
+{
+    {
+        std::lock_guard<std::mutex> lock(q->mutex);
+        q->closed = true;
+    }
+    q->ready.notify_all();
+    q->freed.notify_all();
+}
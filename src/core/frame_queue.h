@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+// Hands frame packets from the simulation thread to the render thread.
+//
+// The queue holds FRAME_QUEUE_SLOTS caller-owned packets. The producer fills a
+// free slot while the consumer renders the previous one, so with two slots CPU
+// simulation of frame N+1 overlaps GL submission of frame N. Packets are
+// handed over in order; the producer never overwrites a packet the consumer
+// hasn't finished with.
+
+#define FRAME_QUEUE_SLOTS 2
+
+typedef enum FrameSlotState
+{
+    FRAME_SLOT_FREE,
+    FRAME_SLOT_WRITING,
+    FRAME_SLOT_READY,
+    FRAME_SLOT_READING
+} FrameSlotState;
+
+typedef struct FrameQueue
+{
+    std::mutex mutex;
+    std::condition_variable ready;      // signalled when a packet is published or the queue closes
+    std::condition_variable freed;      // signalled when the consumer releases a packet
+    void* packets[FRAME_QUEUE_SLOTS];
+    FrameSlotState state[FRAME_QUEUE_SLOTS];
+    int next_write;
+    int next_read;
+    bool closed;
+} FrameQueue;
+
+// "packets" are the FRAME_QUEUE_SLOTS packet objects the queue cycles through
+void frame_queue_init(FrameQueue* q, void* const* packets);
+
+// Producer side. try_acquire returns NULL when both packets are still in flight;
+// acquire blocks until one is free (or returns NULL once closed).
+void* frame_queue_try_acquire_write(FrameQueue* q);
+void* frame_queue_acquire_write(FrameQueue* q);
+void frame_queue_publish(FrameQueue* q);
+
+// Consumer side. Blocks for the next published packet; NULL once the queue is closed and drained.
+void* frame_queue_acquire_read(FrameQueue* q);
+void frame_queue_release(FrameQueue* q);
+
+// Wakes both sides; the consumer finishes what was already published, then sees NULL.
+void frame_queue_close(FrameQueue* q);
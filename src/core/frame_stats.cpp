@@ -0,0 +1,202 @@
+#include "core/frame_stats.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int bucket_of(double ms)
+{
+    const int bucket = (int)(ms / FRAME_STATS_BUCKET_MS);
+    return bucket < 0 ? 0 : bucket >= FRAME_STATS_BUCKETS ? FRAME_STATS_BUCKETS - 1 : bucket;
+}
+
+static void histogram_clear(FrameStatsHistogram* h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+static void histogram_add(FrameStatsHistogram* h, double ms)
+{
+    ++h->buckets[bucket_of(ms)];
+    ++h->count;
+    h->sum_ms += ms;
+    if (ms > h->max_ms)
+        h->max_ms = ms;
+}
+
+double frame_stats_percentile(const FrameStatsHistogram* h, double fraction)
+{
+    if (!h->count)
+        return 0.0;
+    const uint64_t target = (uint64_t)ceil(fraction * (double)h->count);
+    uint64_t seen = 0;
+    for (int i = 0; i < FRAME_STATS_BUCKETS - 1; ++i)
+    {
+        seen += h->buckets[i];
+        if (seen >= target && seen > 0)
+            return (i + 1) * FRAME_STATS_BUCKET_MS;
+    }
+    return h->max_ms;   // in the open-ended last bucket
+}
+
+static void summarize(const FrameStatsHistogram* h, double time, double max_ms, uint64_t stutters, FrameStatsSummary* out)
+{
+    out->time = time;
+    out->frames = h->count;
+    out->mean_ms = h->count ? h->sum_ms / (double)h->count : 0.0;
+    out->p50_ms = frame_stats_percentile(h, .50);
+    out->p95_ms = frame_stats_percentile(h, .95);
+    out->p99_ms = frame_stats_percentile(h, .99);
+    out->max_ms = max_ms;
+    // A bucket's upper edge can pass the slowest frame in it
+    out->p50_ms = out->p50_ms < max_ms ? out->p50_ms : max_ms;
+    out->p95_ms = out->p95_ms < max_ms ? out->p95_ms : max_ms;
+    out->p99_ms = out->p99_ms < max_ms ? out->p99_ms : max_ms;
+    out->stutters = stutters;
+}
+
+bool frame_stats_init(FrameStats* s)
+{
+    memset(s, 0, sizeof(*s));
+    s->rows = (FrameStatsSummary*)malloc(sizeof(FrameStatsSummary) * FRAME_STATS_INTERVALS);
+    if (!s->rows)
+    {
+        fprintf(stderr, "frame_stats: can't allocate %d interval rows\n", FRAME_STATS_INTERVALS);
+        return false;
+    }
+    return true;
+}
+
+void frame_stats_destroy(FrameStats* s)
+{
+    free(s->rows);
+    memset(s, 0, sizeof(*s));
+}
+
+// Closes the interval ending at "now" into a row and starts the next
+static void close_interval(FrameStats* s, double now)
+{
+    if (s->rows)
+    {
+        summarize(&s->interval, now - s->start, s->interval.max_ms, s->interval_stutters,
+            &s->rows[s->row_count % FRAME_STATS_INTERVALS]);
+        ++s->row_count;
+    }
+    s->median_ms = frame_stats_percentile(&s->window_histogram, .50);
+    histogram_clear(&s->interval);
+    s->interval_stutters = 0;
+    s->interval_start = now;
+}
+
+bool frame_stats_frame(FrameStats* s, double now)
+{
+    if (s->last <= 0.0)
+    {
+        s->start = s->last = s->interval_start = now;
+        return false;
+    }
+    const double ms = (now - s->last) * 1000.0;
+    s->last = now;
+
+    // The window: the frame FRAME_STATS_WINDOW back leaves its histogram as this one enters
+    float* slot = &s->window[s->frames % FRAME_STATS_WINDOW];
+    if (s->frames >= FRAME_STATS_WINDOW)
+    {
+        FrameStatsHistogram* h = &s->window_histogram;
+        --h->buckets[bucket_of(*slot)];
+        --h->count;
+        h->sum_ms -= *slot;
+    }
+    *slot = (float)ms;
+    histogram_add(&s->window_histogram, *slot);     // the value that will leave it, so the sum stays exact
+    ++s->frames;
+
+    histogram_add(&s->interval, ms);
+    histogram_add(&s->total, ms);
+    const bool stutter = s->median_ms > 0.0 && ms > FRAME_STATS_STUTTER_FACTOR * s->median_ms;
+    if (stutter)
+    {
+        ++s->interval_stutters;
+        ++s->stutters;
+    }
+    if (now - s->interval_start >= FRAME_STATS_INTERVAL_SECONDS)
+        close_interval(s, now);
+    return stutter;
+}
+
+void frame_stats_resume(FrameStats* s, double now)
+{
+    if (s->last > 0.0)
+        s->last = now;
+}
+
+void frame_stats_window(const FrameStats* s, FrameStatsSummary* out)
+{
+    // The max and the stutters, from the ring: the histogram can't give either back once frames have left it
+    const uint64_t n = s->frames < FRAME_STATS_WINDOW ? s->frames : FRAME_STATS_WINDOW;
+    const double threshold = s->median_ms > 0.0 ? FRAME_STATS_STUTTER_FACTOR * s->median_ms : HUGE_VAL;
+    float max_ms = 0.f;
+    uint64_t stutters = 0;
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        max_ms = s->window[i] > max_ms ? s->window[i] : max_ms;
+        stutters += s->window[i] > threshold;
+    }
+    summarize(&s->window_histogram, s->last - s->start, max_ms, stutters, out);
+}
+
+void frame_stats_total(const FrameStats* s, FrameStatsSummary* out)
+{
+    summarize(&s->total, s->last - s->start, s->total.max_ms, s->stutters, out);
+}
+
+static void write_row(FILE* f, const char* label, const FrameStatsSummary* r)
+{
+    fprintf(f, "%s,%.3f,%llu,%.3f,%.1f,%.1f,%.1f,%.3f,%llu\n", label, r->time, (unsigned long long)r->frames,
+        r->mean_ms, r->p50_ms, r->p95_ms, r->p99_ms, r->max_ms, (unsigned long long)r->stutters);
+}
+
+bool frame_stats_write_csv(const FrameStats* s, const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        fprintf(stderr, "frame_stats: can't open %s for writing\n", path);
+        return false;
+    }
+    fprintf(f, "interval,time_s,frames,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,stutters\n");
+    const uint64_t first = s->row_count > FRAME_STATS_INTERVALS ? s->row_count - FRAME_STATS_INTERVALS : 0;
+    char label[32];
+    for (uint64_t i = first; i < s->row_count; ++i)
+    {
+        snprintf(label, sizeof(label), "%llu", (unsigned long long)i);
+        write_row(f, label, &s->rows[i % FRAME_STATS_INTERVALS]);
+    }
+    FrameStatsSummary row;
+    if (s->interval.count)
+    {
+        summarize(&s->interval, s->last - s->start, s->interval.max_ms, s->interval_stutters, &row);
+        snprintf(label, sizeof(label), "%llu", (unsigned long long)s->row_count);
+        write_row(f, label, &row);
+    }
+    frame_stats_total(s, &row);
+    write_row(f, "total", &row);
+    const bool ok = fclose(f) == 0;
+    if (!ok)
+        fprintf(stderr, "frame_stats: can't write %s\n", path);
+    return ok;
+}
+
+void frame_stats_print(const FrameStats* s, FILE* out)
+{
+    if (!s->frames)
+        return;
+    FrameStatsSummary w, t;
+    frame_stats_window(s, &w);
+    frame_stats_total(s, &t);
+    fprintf(out, "frame times, last %llu: mean %.2f ms, p50 %.1f, p95 %.1f, p99 %.1f, max %.2f ms\n",
+        (unsigned long long)w.frames, w.mean_ms, w.p50_ms, w.p95_ms, w.p99_ms, w.max_ms);
+    fprintf(out, "frame times, all %llu: mean %.2f ms, p50 %.1f, p95 %.1f, p99 %.1f, max %.2f ms, %llu stutters (> %.0fx median)\n",
+        (unsigned long long)t.frames, t.mean_ms, t.p50_ms, t.p95_ms, t.p99_ms, t.max_ms, (unsigned long long)t.stutters,
+        FRAME_STATS_STUTTER_FACTOR);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Frame-time statistics for soak runs: tail latency, not just the mean.
+//
+// Fed once per frame boundary (right after the swap) with a steady-clock
+// timestamp. Three views of the same frame times:
+//
+//  - a rolling window of the last FRAME_STATS_WINDOW frames: p50 / p95 / p99
+//    and max, queryable at any time (the overlay shows it);
+//  - one row per FRAME_STATS_INTERVAL_SECONDS of the run with the same
+//    figures, kept for the CSV written on exit, so a stutter shows up at the
+//    time it happened instead of vanishing into the run's average;
+//  - the whole run.
+//
+// Percentiles come from histograms of FRAME_STATS_BUCKET_MS buckets (the
+// upper edge of the bucket holding the quantile is reported); the window's
+// histogram is kept up to date as frames enter and leave it, so a query is a
+// scan of the buckets and never a sort. A frame longer than
+// FRAME_STATS_STUTTER_FACTOR times the window's median (as of the last
+// interval) counts as a stutter.
+//
+// All memory is allocated at init. When the run outgrows
+// FRAME_STATS_INTERVALS rows the oldest are overwritten. Everything belongs to
+// the thread that presents.
+
+#define FRAME_STATS_WINDOW 1024             // frames in the rolling window, a power of two
+#define FRAME_STATS_BUCKETS 1000            // the last bucket also collects everything slower
+#define FRAME_STATS_BUCKET_MS 0.1
+#define FRAME_STATS_INTERVAL_SECONDS 1.0
+#define FRAME_STATS_INTERVALS 7200          // two hours of rows
+#define FRAME_STATS_STUTTER_FACTOR 2.0
+
+typedef struct FrameStatsSummary
+{
+    double time;            // seconds since the first frame, at the end of the interval
+    uint64_t frames;
+    double mean_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+    uint64_t stutters;      // of those frames, the ones over the stutter threshold
+} FrameStatsSummary;
+
+typedef struct FrameStatsHistogram
+{
+    uint32_t buckets[FRAME_STATS_BUCKETS];
+    uint64_t count;
+    double sum_ms;
+    double max_ms;          // the largest ever added (the window finds its own max in its ring)
+} FrameStatsHistogram;
+
+typedef struct FrameStats
+{
+    double start;               // the first frame's timestamp (seconds)
+    double last;                // the previous frame's, 0 before the first
+    uint64_t frames;            // frame times recorded (one fewer than the timestamps)
+    float window[FRAME_STATS_WINDOW];   // ring of the latest frame times, ms
+    FrameStatsHistogram window_histogram;
+    double median_ms;           // the window's p50 as of the last interval: the stutter threshold's base
+    double interval_start;
+    FrameStatsHistogram interval;
+    uint64_t interval_stutters;
+    FrameStatsSummary* rows;    // [FRAME_STATS_INTERVALS], a ring
+    uint64_t row_count;         // rows ever closed
+    FrameStatsHistogram total;
+    uint64_t stutters;
+} FrameStats;
+
+// Returns false (logged) when the rows can't be allocated
+bool frame_stats_init(FrameStats* s);
+void frame_stats_destroy(FrameStats* s);
+
+// A frame boundary at "now" (seconds, any steady clock): records the time since the previous one. True when that
+// frame was a stutter.
+bool frame_stats_frame(FrameStats* s, double now);
+
+// The time since the previous frame boundary wasn't a frame (--on-demand waited for a reason to draw): the next
+// frame is timed from "now" instead
+void frame_stats_resume(FrameStats* s, double now);
+
+// The last FRAME_STATS_WINDOW frames (fewer early on); "time" is the latest frame's
+void frame_stats_window(const FrameStats* s, FrameStatsSummary* out);
+
+// Every frame so far
+void frame_stats_total(const FrameStats* s, FrameStatsSummary* out);
+
+// Upper edge of the bucket holding the "fraction" (0..1) quantile, in milliseconds
+double frame_stats_percentile(const FrameStatsHistogram* h, double fraction);
+
+// One row per interval (the one still open included) then one for the whole run: interval, time_s, frames,
+// mean_ms, p50_ms, p95_ms, p99_ms, max_ms, stutters. Returns false (logged) when the file can't be written.
+bool frame_stats_write_csv(const FrameStats* s, const char* path);
+
+// The rolling window and the whole run on two lines
+void frame_stats_print(const FrameStats* s, FILE* out);
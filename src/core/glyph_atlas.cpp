@@ -0,0 +1,321 @@
+#include "core/glyph_atlas.h"
+
+#include <chrono>
+#include <filesystem>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Printable ASCII (32 to 126) from DejaVu Sans Mono (Bitstream Vera license), rasterised at 13 px without
+// antialiasing: GLYPH_FONT_HEIGHT rows per character, one byte per row with the leftmost pixel in the high bit
+static const unsigned char font[95][GLYPH_FONT_HEIGHT] =
+{
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // space
+    { 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00 },  // !
+    { 0x00, 0x00, 0x28, 0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // "
+    { 0x00, 0x12, 0x12, 0x16, 0x7f, 0x24, 0x24, 0xfe, 0x28, 0x48, 0x48, 0x00, 0x00, 0x00 },  // #
+    { 0x00, 0x00, 0x08, 0x3e, 0x49, 0x48, 0x38, 0x0e, 0x09, 0x49, 0x3e, 0x08, 0x08, 0x00 },  // $
+    { 0x00, 0x00, 0x60, 0x90, 0x90, 0x62, 0x1c, 0x66, 0x09, 0x09, 0x06, 0x00, 0x00, 0x00 },  // %
+    { 0x00, 0x00, 0x1c, 0x20, 0x20, 0x30, 0x49, 0x4d, 0x45, 0x62, 0x3d, 0x00, 0x00, 0x00 },  // &
+    { 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '
+    { 0x0c, 0x08, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x08, 0x08, 0x04, 0x00, 0x00 },  // (
+    { 0x30, 0x10, 0x10, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x10, 0x10, 0x30, 0x00, 0x00 },  // )
+    { 0x00, 0x00, 0x08, 0x49, 0x3e, 0x1c, 0x6b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // *
+    { 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0xfe, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00 },  // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x20, 0x00 },  // ,
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00 },  // .
+    { 0x00, 0x00, 0x02, 0x04, 0x04, 0x08, 0x08, 0x18, 0x10, 0x10, 0x20, 0x20, 0x40, 0x00 },  // /
+    { 0x00, 0x00, 0x1c, 0x22, 0x41, 0x41, 0x49, 0x41, 0x41, 0x22, 0x1c, 0x00, 0x00, 0x00 },  // 0
+    { 0x00, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00 },  // 1
+    { 0x00, 0x00, 0x3e, 0x43, 0x01, 0x01, 0x02, 0x0c, 0x18, 0x20, 0x7f, 0x00, 0x00, 0x00 },  // 2
+    { 0x00, 0x00, 0x3e, 0x41, 0x01, 0x03, 0x1c, 0x03, 0x01, 0x43, 0x3e, 0x00, 0x00, 0x00 },  // 3
+    { 0x00, 0x00, 0x06, 0x0a, 0x1a, 0x12, 0x22, 0x42, 0x7f, 0x02, 0x02, 0x00, 0x00, 0x00 },  // 4
+    { 0x00, 0x00, 0x7e, 0x40, 0x40, 0x7c, 0x03, 0x01, 0x01, 0x43, 0x3c, 0x00, 0x00, 0x00 },  // 5
+    { 0x00, 0x00, 0x1e, 0x21, 0x40, 0x5e, 0x63, 0x41, 0x41, 0x23, 0x1e, 0x00, 0x00, 0x00 },  // 6
+    { 0x00, 0x00, 0x7f, 0x02, 0x02, 0x04, 0x04, 0x08, 0x18, 0x10, 0x20, 0x00, 0x00, 0x00 },  // 7
+    { 0x00, 0x00, 0x3e, 0x41, 0x41, 0x41, 0x3e, 0x63, 0x41, 0x61, 0x3e, 0x00, 0x00, 0x00 },  // 8
+    { 0x00, 0x00, 0x3c, 0x62, 0x41, 0x41, 0x63, 0x3d, 0x01, 0x42, 0x3c, 0x00, 0x00, 0x00 },  // 9
+    { 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00 },  // :
+    { 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x20, 0x00 },  // ;
+    { 0x00, 0x00, 0x00, 0x00, 0x01, 0x0e, 0x70, 0x70, 0x0e, 0x01, 0x00, 0x00, 0x00, 0x00 },  // <
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x00, 0x00, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00 },  // =
+    { 0x00, 0x00, 0x00, 0x00, 0x40, 0x38, 0x07, 0x07, 0x38, 0x40, 0x00, 0x00, 0x00, 0x00 },  // >
+    { 0x00, 0x00, 0x38, 0x44, 0x04, 0x08, 0x10, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00 },  // ?
+    { 0x00, 0x00, 0x1e, 0x33, 0x21, 0x47, 0x49, 0x49, 0x49, 0x47, 0x20, 0x30, 0x1e, 0x00 },  // @
+    { 0x00, 0x00, 0x08, 0x14, 0x14, 0x14, 0x22, 0x22, 0x3e, 0x63, 0x41, 0x00, 0x00, 0x00 },  // A
+    { 0x00, 0x00, 0x7e, 0x41, 0x41, 0x41, 0x7e, 0x41, 0x41, 0x41, 0x7e, 0x00, 0x00, 0x00 },  // B
+    { 0x00, 0x00, 0x1e, 0x21, 0x40, 0x40, 0x40, 0x40, 0x40, 0x21, 0x1e, 0x00, 0x00, 0x00 },  // C
+    { 0x00, 0x00, 0x7c, 0x42, 0x41, 0x41, 0x41, 0x41, 0x41, 0x42, 0x7c, 0x00, 0x00, 0x00 },  // D
+    { 0x00, 0x00, 0x7f, 0x40, 0x40, 0x40, 0x7f, 0x40, 0x40, 0x40, 0x7f, 0x00, 0x00, 0x00 },  // E
+    { 0x00, 0x00, 0x7f, 0x40, 0x40, 0x40, 0x7f, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00 },  // F
+    { 0x00, 0x00, 0x1e, 0x21, 0x40, 0x40, 0x43, 0x41, 0x41, 0x21, 0x1e, 0x00, 0x00, 0x00 },  // G
+    { 0x00, 0x00, 0x41, 0x41, 0x41, 0x41, 0x7f, 0x41, 0x41, 0x41, 0x41, 0x00, 0x00, 0x00 },  // H
+    { 0x00, 0x00, 0x7c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7c, 0x00, 0x00, 0x00 },  // I
+    { 0x00, 0x00, 0x1c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x44, 0x38, 0x00, 0x00, 0x00 },  // J
+    { 0x00, 0x00, 0x42, 0x44, 0x48, 0x50, 0x70, 0x48, 0x44, 0x44, 0x42, 0x00, 0x00, 0x00 },  // K
+    { 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x7f, 0x00, 0x00, 0x00 },  // L
+    { 0x00, 0x00, 0x63, 0x63, 0x55, 0x55, 0x55, 0x49, 0x41, 0x41, 0x41, 0x00, 0x00, 0x00 },  // M
+    { 0x00, 0x00, 0x61, 0x61, 0x51, 0x51, 0x49, 0x45, 0x45, 0x43, 0x43, 0x00, 0x00, 0x00 },  // N
+    { 0x00, 0x00, 0x1c, 0x22, 0x41, 0x41, 0x41, 0x41, 0x41, 0x22, 0x1c, 0x00, 0x00, 0x00 },  // O
+    { 0x00, 0x00, 0x7e, 0x43, 0x41, 0x41, 0x43, 0x7e, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00 },  // P
+    { 0x00, 0x00, 0x1c, 0x22, 0x41, 0x41, 0x41, 0x41, 0x41, 0x23, 0x1e, 0x06, 0x02, 0x00 },  // Q
+    { 0x00, 0x00, 0x7e, 0x43, 0x41, 0x41, 0x7e, 0x42, 0x41, 0x41, 0x40, 0x00, 0x00, 0x00 },  // R
+    { 0x00, 0x00, 0x3e, 0x61, 0x40, 0x60, 0x3e, 0x03, 0x01, 0x43, 0x3e, 0x00, 0x00, 0x00 },  // S
+    { 0x00, 0x00, 0xfe, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00 },  // T
+    { 0x00, 0x00, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x3e, 0x00, 0x00, 0x00 },  // U
+    { 0x00, 0x00, 0x41, 0x63, 0x22, 0x22, 0x22, 0x14, 0x14, 0x14, 0x08, 0x00, 0x00, 0x00 },  // V
+    { 0x00, 0x00, 0x81, 0x81, 0x81, 0x5a, 0x5a, 0x5a, 0x66, 0x66, 0x66, 0x00, 0x00, 0x00 },  // W
+    { 0x00, 0x00, 0x63, 0x22, 0x14, 0x1c, 0x08, 0x14, 0x36, 0x22, 0x41, 0x00, 0x00, 0x00 },  // X
+    { 0x00, 0x00, 0x82, 0x44, 0x28, 0x28, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00 },  // Y
+    { 0x00, 0x00, 0x7f, 0x03, 0x06, 0x04, 0x08, 0x10, 0x30, 0x60, 0x7f, 0x00, 0x00, 0x00 },  // Z
+    { 0x1c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1c, 0x00, 0x00 },  // [
+    { 0x00, 0x00, 0x40, 0x20, 0x20, 0x10, 0x10, 0x18, 0x08, 0x08, 0x04, 0x04, 0x02, 0x00 },  // backslash
+    { 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00, 0x00 },  // ]
+    { 0x00, 0x00, 0x10, 0x28, 0x44, 0xc6, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff },  // _
+    { 0x00, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // `
+    { 0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x02, 0x3e, 0x42, 0x46, 0x3a, 0x00, 0x00, 0x00 },  // a
+    { 0x40, 0x40, 0x40, 0x40, 0x7c, 0x66, 0x42, 0x42, 0x42, 0x66, 0x7c, 0x00, 0x00, 0x00 },  // b
+    { 0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x40, 0x40, 0x40, 0x22, 0x1c, 0x00, 0x00, 0x00 },  // c
+    { 0x02, 0x02, 0x02, 0x02, 0x3e, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3e, 0x00, 0x00, 0x00 },  // d
+    { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x42, 0x7e, 0x40, 0x62, 0x3c, 0x00, 0x00, 0x00 },  // e
+    { 0x0c, 0x10, 0x10, 0x10, 0x7c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00 },  // f
+    { 0x00, 0x00, 0x00, 0x00, 0x3e, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3a, 0x02, 0x22, 0x1c },  // g
+    { 0x40, 0x40, 0x40, 0x40, 0x5c, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00 },  // h
+    { 0x10, 0x00, 0x00, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7c, 0x00, 0x00, 0x00 },  // i
+    { 0x08, 0x00, 0x00, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x70 },  // j
+    { 0x40, 0x40, 0x40, 0x40, 0x44, 0x48, 0x50, 0x70, 0x48, 0x44, 0x42, 0x00, 0x00, 0x00 },  // k
+    { 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0e, 0x00, 0x00, 0x00 },  // l
+    { 0x00, 0x00, 0x00, 0x00, 0x7f, 0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x00, 0x00, 0x00 },  // m
+    { 0x00, 0x00, 0x00, 0x00, 0x5c, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00 },  // n
+    { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3c, 0x00, 0x00, 0x00 },  // o
+    { 0x00, 0x00, 0x00, 0x00, 0x7c, 0x66, 0x42, 0x42, 0x42, 0x66, 0x7c, 0x40, 0x40, 0x40 },  // p
+    { 0x00, 0x00, 0x00, 0x00, 0x3e, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3a, 0x02, 0x02, 0x02 },  // q
+    { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x32, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00 },  // r
+    { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x42, 0x40, 0x3c, 0x02, 0x42, 0x3c, 0x00, 0x00, 0x00 },  // s
+    { 0x00, 0x00, 0x10, 0x10, 0x7e, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0e, 0x00, 0x00, 0x00 },  // t
+    { 0x00, 0x00, 0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x46, 0x3a, 0x00, 0x00, 0x00 },  // u
+    { 0x00, 0x00, 0x00, 0x00, 0x42, 0x66, 0x24, 0x24, 0x3c, 0x18, 0x18, 0x00, 0x00, 0x00 },  // v
+    { 0x00, 0x00, 0x00, 0x00, 0x81, 0x81, 0x5a, 0x5a, 0x5a, 0x24, 0x24, 0x00, 0x00, 0x00 },  // w
+    { 0x00, 0x00, 0x00, 0x00, 0x66, 0x24, 0x18, 0x18, 0x18, 0x24, 0x66, 0x00, 0x00, 0x00 },  // x
+    { 0x00, 0x00, 0x00, 0x00, 0x42, 0x22, 0x24, 0x24, 0x14, 0x18, 0x08, 0x08, 0x10, 0x30 },  // y
+    { 0x00, 0x00, 0x00, 0x00, 0x7e, 0x02, 0x04, 0x18, 0x20, 0x40, 0x7e, 0x00, 0x00, 0x00 },  // z
+    { 0x1c, 0x10, 0x10, 0x10, 0x10, 0x60, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0c, 0x00, 0x00 },  // {
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00 },  // |
+    { 0x70, 0x10, 0x10, 0x10, 0x10, 0x0c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x60, 0x00, 0x00 },  // }
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x39, 0x46, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // ~
+};
+
+const unsigned char* glyph_font_rows(int index)
+{
+    return font[index];
+}
+
+#define TEXELS_PER_PIXEL (GLYPH_ATLAS_SCALE * GLYPH_ATLAS_SUPERSAMPLE)     // fine samples per font pixel
+#define FINE_WIDTH (GLYPH_ATLAS_CELL_WIDTH * GLYPH_ATLAS_SUPERSAMPLE)
+#define FINE_HEIGHT (GLYPH_ATLAS_CELL_HEIGHT * GLYPH_ATLAS_SUPERSAMPLE)
+#define FAR 1e20f
+
+uint64_t glyph_atlas_key(void)
+{
+    // FNV-1a over the bitmap, then the layout it's turned into
+    uint64_t h = 1469598103934665603ull;
+    const unsigned char* bytes = &font[0][0];
+    for (size_t i = 0; i < sizeof(font); ++i)
+        h = (h ^ bytes[i]) * 1099511628211ull;
+    const uint32_t parameters[] = { GLYPH_ATLAS_COLUMNS, GLYPH_ATLAS_ROWS, GLYPH_ATLAS_SCALE, GLYPH_ATLAS_SPREAD,
+        GLYPH_ATLAS_SUPERSAMPLE, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT };
+    for (size_t i = 0; i < sizeof(parameters) / sizeof(parameters[0]); ++i)
+        h = (h ^ parameters[i]) * 1099511628211ull;
+    return h;
+}
+
+// Squared distances to the nearest 0 in "f" along one line, in place (Felzenszwalb and Huttenlocher's lower envelope
+// of parabolas). "v" and "z" are scratch of n and n + 1 entries.
+static void distance_1d(float* f, int n, int stride, float* line, int* v, float* z)
+{
+    for (int q = 0; q < n; ++q)
+        line[q] = f[q * stride];
+    int k = 0;
+    v[0] = 0;
+    z[0] = -FAR;
+    z[1] = FAR;
+    for (int q = 1; q < n; ++q)
+    {
+        float s = ((line[q] + q * q) - (line[v[k]] + v[k] * v[k])) / (2.f * q - 2.f * v[k]);
+        while (s <= z[k])
+        {
+            --k;
+            s = ((line[q] + q * q) - (line[v[k]] + v[k] * v[k])) / (2.f * q - 2.f * v[k]);
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = FAR;
+    }
+    k = 0;
+    for (int q = 0; q < n; ++q)
+    {
+        while (z[k + 1] < q)
+            ++k;
+        f[q * stride] = (float)(q - v[k]) * (q - v[k]) + line[v[k]];
+    }
+}
+
+// "grid" holds 0 at the features, FAR elsewhere; afterwards, each sample's squared distance to the nearest feature
+static void distance_2d(float* grid, float* line, int* v, float* z)
+{
+    for (int x = 0; x < FINE_WIDTH; ++x)
+        distance_1d(grid + x, FINE_HEIGHT, FINE_WIDTH, line, v, z);
+    for (int y = 0; y < FINE_HEIGHT; ++y)
+        distance_1d(grid + y * FINE_WIDTH, FINE_WIDTH, 1, line, v, z);
+}
+
+static bool fine_inside(int glyph, int x, int y)
+{
+    const int fx = x - GLYPH_ATLAS_SPREAD * GLYPH_ATLAS_SUPERSAMPLE, fy = y - GLYPH_ATLAS_SPREAD * GLYPH_ATLAS_SUPERSAMPLE;
+    if (fx < 0 || fy < 0 || fx >= GLYPH_FONT_WIDTH * TEXELS_PER_PIXEL || fy >= GLYPH_FONT_HEIGHT * TEXELS_PER_PIXEL)
+        return false;
+    return font[glyph][fy / TEXELS_PER_PIXEL] >> (7 - fx / TEXELS_PER_PIXEL) & 1;
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool glyph_atlas_build(GlyphAtlas* atlas)
+{
+    const double start = now_ms();
+    const int n = FINE_WIDTH * FINE_HEIGHT;
+    const int longest = FINE_WIDTH > FINE_HEIGHT ? FINE_WIDTH : FINE_HEIGHT;
+    atlas->pixels = (unsigned char*)calloc(GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_HEIGHT, 1);
+    float* outside = (float*)malloc(sizeof(float) * n);     // distance from each sample to the glyph
+    float* inside = (float*)malloc(sizeof(float) * n);      // and to the background
+    float* line = (float*)malloc(sizeof(float) * longest);
+    int* v = (int*)malloc(sizeof(int) * longest);
+    float* z = (float*)malloc(sizeof(float) * (longest + 1));
+    const bool ok = atlas->pixels && outside && inside && line && v && z;
+    for (int g = 0; g < GLYPH_ATLAS_GLYPHS && ok; ++g)
+    {
+        for (int y = 0; y < FINE_HEIGHT; ++y)
+            for (int x = 0; x < FINE_WIDTH; ++x)
+            {
+                const bool in = fine_inside(g, x, y);
+                outside[y * FINE_WIDTH + x] = in ? 0.f : FAR;
+                inside[y * FINE_WIDTH + x] = in ? FAR : 0.f;
+            }
+        distance_2d(outside, line, v, z);
+        distance_2d(inside, line, v, z);
+
+        // Each texel: the mean signed distance of its samples, the outline half a sample from the last one in
+        const int x0 = g % GLYPH_ATLAS_COLUMNS * GLYPH_ATLAS_CELL_WIDTH, y0 = g / GLYPH_ATLAS_COLUMNS * GLYPH_ATLAS_CELL_HEIGHT;
+        for (int ty = 0; ty < GLYPH_ATLAS_CELL_HEIGHT; ++ty)
+            for (int tx = 0; tx < GLYPH_ATLAS_CELL_WIDTH; ++tx)
+            {
+                float sum = 0.f;
+                for (int sy = 0; sy < GLYPH_ATLAS_SUPERSAMPLE; ++sy)
+                    for (int sx = 0; sx < GLYPH_ATLAS_SUPERSAMPLE; ++sx)
+                    {
+                        const int i = (ty * GLYPH_ATLAS_SUPERSAMPLE + sy) * FINE_WIDTH + tx * GLYPH_ATLAS_SUPERSAMPLE + sx;
+                        sum += outside[i] > 0.f ? sqrtf(outside[i]) - 0.5f : 0.5f - sqrtf(inside[i]);
+                    }
+                const float samples = sum / (GLYPH_ATLAS_SUPERSAMPLE * GLYPH_ATLAS_SUPERSAMPLE);
+                const float texels = samples / GLYPH_ATLAS_SUPERSAMPLE;
+                float value = 0.5f - texels / (2.f * GLYPH_ATLAS_SPREAD);
+                value = value < 0.f ? 0.f : value > 1.f ? 1.f : value;
+                atlas->pixels[(y0 + ty) * GLYPH_ATLAS_WIDTH + x0 + tx] = (unsigned char)(value * 255.f + 0.5f);
+            }
+    }
+    free(z);
+    free(v);
+    free(line);
+    free(inside);
+    free(outside);
+    if (!ok)
+    {
+        fprintf(stderr, "glyph_atlas: out of memory\n");
+        glyph_atlas_destroy(atlas);
+        return false;
+    }
+    atlas->loaded = false;
+    atlas->build_ms = now_ms() - start;
+    return true;
+}
+
+bool glyph_atlas_load(GlyphAtlas* atlas, const char* path)
+{
+    const double start = now_ms();
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return false;
+    GlyphAtlasHeader header;
+    const size_t size = GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_HEIGHT;
+    unsigned char* pixels = NULL;
+    if (fread(&header, sizeof(header), 1, f) == 1 && header.magic == GLYPH_ATLAS_MAGIC
+        && header.key == glyph_atlas_key() && header.width == GLYPH_ATLAS_WIDTH && header.height == GLYPH_ATLAS_HEIGHT)
+    {
+        pixels = (unsigned char*)malloc(size);
+        if (pixels && fread(pixels, 1, size, f) != size)
+        {
+            free(pixels);
+            pixels = NULL;
+        }
+    }
+    fclose(f);
+    if (!pixels)
+        return false;
+    atlas->pixels = pixels;
+    atlas->loaded = true;
+    atlas->build_ms = now_ms() - start;
+    return true;
+}
+
+bool glyph_atlas_save(const GlyphAtlas* atlas, const char* path)
+{
+    char temp[330];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE* f = fopen(temp, "wb");
+    if (!f)
+        return false;
+    const GlyphAtlasHeader header = { GLYPH_ATLAS_MAGIC, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT, 0, glyph_atlas_key() };
+    const size_t size = GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_HEIGHT;
+    const bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(atlas->pixels, 1, size, f) == size;
+    fclose(f);
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(temp, path, ec);
+    if (!ok || ec)
+        std::filesystem::remove(temp, ec);
+    return ok && !ec;
+}
+
+bool glyph_atlas_init(GlyphAtlas* atlas, const char* dir)
+{
+    memset(atlas, 0, sizeof(*atlas));
+    char path[320] = "";
+    if (dir)
+    {
+        snprintf(path, sizeof(path), "%s/font_%016llx.sdf", dir, (unsigned long long)glyph_atlas_key());
+        if (glyph_atlas_load(atlas, path))
+            return true;
+    }
+    if (!glyph_atlas_build(atlas))
+        return false;
+    if (dir)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec || !glyph_atlas_save(atlas, path))
+            fprintf(stderr, "glyph_atlas: can't store %s\n", path);
+    }
+    return true;
+}
+
+void glyph_atlas_destroy(GlyphAtlas* atlas)
+{
+    free(atlas->pixels);
+    memset(atlas, 0, sizeof(*atlas));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Signed distance field atlas of the overlay's font: printable ASCII from an
+// 8x14 bitmap (DejaVu Sans Mono), each glyph turned into distances to its
+// outline so it can be drawn at any scale with one bilinear fetch and a
+// smoothstep instead of the blocky nearest-neighbour texels of the bitmap.
+//
+// A texel holds 0.5 on the outline, more inside, less outside, reaching 0 or
+// 1 GLYPH_ATLAS_SPREAD texels away. The atlas has GLYPH_ATLAS_SCALE texels
+// per font pixel, and each cell is padded by the spread so a glyph's falloff
+// never bleeds into its neighbour under bilinear filtering. Distances are
+// exact (a separable Euclidean distance transform) on the bitmap upsampled
+// GLYPH_ATLAS_SUPERSAMPLE times per texel, then averaged down.
+//
+// Making it takes tens of milliseconds, so it's done once and kept on disk:
+// glyph_atlas_init loads <dir>/font_<key>.sdf, whose key hashes the bitmap
+// and every parameter above, and builds and stores it when that's missing or
+// stale. Nothing here calls GL; gl/hud.h uploads it.
+
+#define GLYPH_ATLAS_FIRST 32                // ' ', the first character in the atlas
+#define GLYPH_ATLAS_GLYPHS 95               // up to '~'
+#define GLYPH_ATLAS_COLUMNS 16
+#define GLYPH_ATLAS_ROWS 6                  // 96 cells
+#define GLYPH_FONT_WIDTH 8                  // font pixels: the bitmap's cell, and the advance
+#define GLYPH_FONT_HEIGHT 14
+#define GLYPH_ATLAS_SCALE 2                 // atlas texels per font pixel
+#define GLYPH_ATLAS_SPREAD 4                // texels of distance either side of the outline, and the cell padding
+#define GLYPH_ATLAS_SUPERSAMPLE 4           // distance samples per texel, each way
+#define GLYPH_ATLAS_CELL_WIDTH (GLYPH_FONT_WIDTH * GLYPH_ATLAS_SCALE + 2 * GLYPH_ATLAS_SPREAD)
+#define GLYPH_ATLAS_CELL_HEIGHT (GLYPH_FONT_HEIGHT * GLYPH_ATLAS_SCALE + 2 * GLYPH_ATLAS_SPREAD)
+#define GLYPH_ATLAS_WIDTH (GLYPH_ATLAS_COLUMNS * GLYPH_ATLAS_CELL_WIDTH)
+#define GLYPH_ATLAS_HEIGHT (GLYPH_ATLAS_ROWS * GLYPH_ATLAS_CELL_HEIGHT)
+#define GLYPH_ATLAS_PAD ((float)GLYPH_ATLAS_SPREAD / GLYPH_ATLAS_SCALE)    // the padding in font pixels
+
+#define GLYPH_ATLAS_MAGIC 0x46445347u       // "GSDF"
+
+typedef struct GlyphAtlasHeader
+{
+    uint32_t magic;
+    uint32_t width, height;
+    uint32_t reserved;
+    uint64_t key;                           // glyph_atlas_key() of the build that wrote it
+} GlyphAtlasHeader;
+
+typedef struct GlyphAtlas
+{
+    unsigned char* pixels;                  // GLYPH_ATLAS_WIDTH x GLYPH_ATLAS_HEIGHT, one byte each, rows top down
+    bool loaded;                            // came from the disk cache rather than being built
+    double build_ms;                        // what making (or loading) it took
+} GlyphAtlas;
+
+// Identifies the font and the parameters above: a cached atlas is only used when its key matches
+uint64_t glyph_atlas_key(void);
+
+// Builds the distance field. False (logged) when it can't allocate.
+bool glyph_atlas_build(GlyphAtlas* atlas);
+
+// The cache file itself: load fails on a missing, short or mismatched file; save writes a temporary and renames it
+bool glyph_atlas_load(GlyphAtlas* atlas, const char* path);
+bool glyph_atlas_save(const GlyphAtlas* atlas, const char* path);
+
+// Loads the atlas from "dir" (NULL for no cache), or builds it and stores it there, creating "dir"
+bool glyph_atlas_init(GlyphAtlas* atlas, const char* dir);
+void glyph_atlas_destroy(GlyphAtlas* atlas);
+
+// The 1-bit bitmap the atlas is made from: GLYPH_FONT_HEIGHT rows for glyph "index" (character - GLYPH_ATLAS_FIRST),
+// the leftmost pixel in each row's high bit
+const unsigned char* glyph_font_rows(int index);
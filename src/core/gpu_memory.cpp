@@ -0,0 +1,372 @@
+#include "core/gpu_memory.h"
+
+#include <string.h>
+
+#define OBJECT_MASK (GPU_MEMORY_MAX_OBJECTS - 1)
+
+static_assert((GPU_MEMORY_MAX_OBJECTS & OBJECT_MASK) == 0, "GPU_MEMORY_MAX_OBJECTS must be a power of two");
+
+void gpu_memory_init(GpuMemory* mem, uint64_t budget)
+{
+    memset(mem->objects, 0, sizeof(mem->objects));
+    mem->object_count = 0;
+    memset(mem->bytes, 0, sizeof(mem->bytes));
+    memset(mem->counts, 0, sizeof(mem->counts));
+    memset(mem->peaks, 0, sizeof(mem->peaks));
+    mem->total = 0;
+    mem->peak = 0;
+    mem->dropped = 0;
+    mem->budget = budget;
+    mem->effective_budget = budget ? budget : UINT64_MAX;
+    mem->driver_known = false;
+    mem->driver = { -1, -1, -1, -1 };
+    mem->pressure_cap = UINT64_MAX;
+    mem->pressure_frame = 0;
+    mem->pressure_events = 0;
+    memset(mem->residents, 0, sizeof(mem->residents));
+    mem->resident_count = 0;
+    mem->frame = 1;     // 0 is "never used"
+    mem->evicted_bytes = 0;
+    mem->restored_bytes = 0;
+    mem->over_budget_frames = 0;
+}
+
+void gpu_memory_set_budget(GpuMemory* mem, uint64_t budget)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    mem->budget = budget;
+    if (mem->effective_budget == UINT64_MAX || budget < mem->effective_budget)
+        mem->effective_budget = budget ? budget : UINT64_MAX;
+}
+
+static uint32_t slot_of(uint64_t key)
+{
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 40) & OBJECT_MASK;
+}
+
+// The slot holding "key", or the empty one where it would go
+static uint32_t find(const GpuMemory* mem, uint64_t key)
+{
+    uint32_t slot = slot_of(key);
+    while (mem->objects[slot].key && mem->objects[slot].key != key)
+        slot = (slot + 1) & OBJECT_MASK;
+    return slot;
+}
+
+static void account(GpuMemory* mem, GpuMemoryCategory category, uint64_t bytes, bool add)
+{
+    if (add)
+    {
+        mem->bytes[category] += bytes;
+        ++mem->counts[category];
+        mem->total += bytes;
+        if (mem->bytes[category] > mem->peaks[category])
+            mem->peaks[category] = mem->bytes[category];
+        if (mem->total > mem->peak)
+            mem->peak = mem->total;
+    }
+    else
+    {
+        mem->bytes[category] -= bytes;
+        --mem->counts[category];
+        mem->total -= bytes;
+    }
+}
+
+// Empties "slot", moving later entries of its run back so every lookup still finds them without tombstones
+static void remove_slot(GpuMemory* mem, uint32_t slot)
+{
+    uint32_t hole = slot;
+    for (uint32_t next = (slot + 1) & OBJECT_MASK; mem->objects[next].key; next = (next + 1) & OBJECT_MASK)
+    {
+        const uint32_t home = slot_of(mem->objects[next].key);
+        // Movable when its home isn't in (hole, next], cyclically
+        const bool stays = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (stays)
+            continue;
+        mem->objects[hole] = mem->objects[next];
+        hole = next;
+    }
+    mem->objects[hole].key = 0;
+    --mem->object_count;
+}
+
+void gpu_memory_track(GpuMemory* mem, GpuMemoryKind kind, uint32_t name, GpuMemoryCategory category, uint64_t bytes)
+{
+    gpu_memory_track_at(mem, kind, name, category, bytes, NULL);
+}
+
+void gpu_memory_track_at(GpuMemory* mem, GpuMemoryKind kind, uint32_t name, GpuMemoryCategory category,
+    uint64_t bytes, const char* site)
+{
+    if (!name)
+        return;
+    const uint64_t key = (uint64_t)kind << 32 | name;
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    const uint32_t slot = find(mem, key);
+    GpuMemoryObject* o = &mem->objects[slot];
+    if (o->key)
+    {
+        account(mem, o->category, o->bytes, false);
+        if (bytes == 0)
+        {
+            remove_slot(mem, slot);
+            return;
+        }
+    }
+    else if (bytes == 0)
+        return;
+    else if (mem->object_count >= GPU_MEMORY_MAX_OBJECTS * 3 / 4)
+    {
+        // Past three quarters full the runs grow long; the allocation goes uncounted rather than slow
+        ++mem->dropped;
+        return;
+    }
+    else
+    {
+        o->key = key;
+        o->site = NULL;
+        ++mem->object_count;
+    }
+    o->bytes = bytes;
+    o->category = category;
+    if (site)
+        o->site = site;     // respecified without a site: it keeps the one it had
+    account(mem, category, bytes, true);
+}
+
+void gpu_memory_forget(GpuMemory* mem, GpuMemoryKind kind, uint32_t name)
+{
+    gpu_memory_track(mem, kind, name, GPU_MEMORY_GEOMETRY, 0);
+}
+
+uint32_t gpu_memory_objects(GpuMemory* mem, GpuMemoryObject* objects, uint32_t max)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < GPU_MEMORY_MAX_OBJECTS && count < max; ++i)
+    {
+        if (mem->objects[i].key)
+            objects[count++] = mem->objects[i];
+    }
+    return mem->object_count;
+}
+
+void gpu_memory_set_driver(GpuMemory* mem, const GpuMemoryDriver* driver)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    if (mem->driver_known && driver->evictions > mem->driver.evictions && mem->driver.evictions >= 0)
+    {
+        // The driver is paging video memory out: shrink to below what's tracked, so something gets freed
+        const uint64_t cap = mem->total - mem->total / 8;
+        mem->pressure_cap = cap < mem->pressure_cap ? cap : mem->pressure_cap;
+        mem->pressure_frame = mem->frame;
+        ++mem->pressure_events;
+    }
+    mem->driver = *driver;
+    mem->driver_known = true;
+}
+
+static uint64_t compute_budget(GpuMemory* mem)
+{
+    uint64_t budget = mem->budget ? mem->budget : UINT64_MAX;
+    if (mem->driver_known && mem->driver.available_kb >= 0)
+    {
+        const uint64_t reachable = mem->total + (uint64_t)mem->driver.available_kb * 1024;
+        const uint64_t cap = reachable > GPU_MEMORY_HEADROOM ? reachable - GPU_MEMORY_HEADROOM : 0;
+        budget = cap < budget ? cap : budget;
+    }
+    if (mem->pressure_cap != UINT64_MAX && mem->frame - mem->pressure_frame >= GPU_MEMORY_QUIET_FRAMES)
+        mem->pressure_cap = UINT64_MAX;
+    return mem->pressure_cap < budget ? mem->pressure_cap : budget;
+}
+
+uint64_t gpu_memory_bytes(GpuMemory* mem, GpuMemoryCategory category)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    return category < GPU_MEMORY_CATEGORY_COUNT ? mem->bytes[category] : mem->total;
+}
+
+uint64_t gpu_memory_budget(GpuMemory* mem)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    return mem->effective_budget;
+}
+
+uint64_t gpu_memory_share(GpuMemory* mem, GpuMemoryCategory category)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    if (mem->effective_budget == UINT64_MAX)
+        return UINT64_MAX;
+    const uint64_t others = mem->total - mem->bytes[category];
+    return mem->effective_budget > others ? mem->effective_budget - others : 0;
+}
+
+int gpu_memory_add_resident(GpuMemory* mem, GpuMemoryCategory category, int level_count, const uint64_t* level_bytes,
+    int pinned)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    if (mem->resident_count >= GPU_MEMORY_MAX_RESIDENTS || level_count < 1 || level_count > GPU_MEMORY_MAX_LEVELS)
+        return -1;
+    GpuResident* r = &mem->residents[mem->resident_count];
+    r->category = category;
+    r->level_count = level_count;
+    r->pinned = pinned < 0 ? 0 : pinned >= level_count ? level_count - 1 : pinned;
+    memcpy(r->level_bytes, level_bytes, sizeof(uint64_t) * level_count);
+    r->first = 0;
+    r->wanted = 0;
+    r->last_used = 0;
+    return mem->resident_count++;
+}
+
+void gpu_memory_remove_resident(GpuMemory* mem, int resident)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    if (resident >= 0 && resident < mem->resident_count)
+        mem->residents[resident].level_count = 0;
+}
+
+void gpu_memory_use(GpuMemory* mem, int resident, int level)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    if (resident < 0 || resident >= mem->resident_count || !mem->residents[resident].level_count)
+        return;
+    GpuResident* r = &mem->residents[resident];
+    level = level < 0 ? 0 : level >= r->level_count ? r->level_count - 1 : level;
+    if (r->last_used != mem->frame || level < r->wanted)
+        r->wanted = level;
+    r->last_used = mem->frame;
+}
+
+// The finest level a resident needs this frame: none (past its levels) when it wasn't drawn
+static int needed(const GpuMemory* mem, const GpuResident* r)
+{
+    return r->last_used == mem->frame ? r->wanted : r->level_count;
+}
+
+// The resident to lose its finest level, or -1: first one with a level it doesn't need, least recently used
+// first; with "in_use", then one that needs it, the same way
+static int pick_victim(const GpuMemory* mem, const int* target, int exclude, bool in_use)
+{
+    int best = -1;
+    for (int pass = 0; pass < (in_use ? 2 : 1) && best < 0; ++pass)
+    {
+        for (int i = 0; i < mem->resident_count; ++i)
+        {
+            const GpuResident* r = &mem->residents[i];
+            if (i == exclude || !r->level_count || target[i] >= r->pinned)
+                continue;
+            if (pass == 0 && target[i] >= needed(mem, r))
+                continue;
+            if (best < 0 || r->last_used < mem->residents[best].last_used)
+                best = i;
+        }
+    }
+    return best;
+}
+
+int gpu_memory_update(GpuMemory* mem, GpuResidencyChange* changes)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    const uint64_t budget = compute_budget(mem);
+    mem->effective_budget = budget;
+    int target[GPU_MEMORY_MAX_RESIDENTS];
+    for (int i = 0; i < mem->resident_count; ++i)
+        target[i] = mem->residents[i].first;
+
+    // Over: shed levels, unused ones first
+    uint64_t projected = mem->total;
+    while (projected > budget)
+    {
+        const int victim = pick_victim(mem, target, -1, true);
+        if (victim < 0)
+        {
+            ++mem->over_budget_frames;
+            break;
+        }
+        const uint64_t bytes = mem->residents[victim].level_bytes[target[victim]++];
+        projected -= bytes < projected ? bytes : projected;
+        mem->evicted_bytes += bytes;
+    }
+
+    // Under: levels drawn again come back, most recently used first, making room only from unused levels
+    int order[GPU_MEMORY_MAX_RESIDENTS];
+    int waiting = 0;
+    for (int i = 0; i < mem->resident_count; ++i)
+    {
+        const GpuResident* r = &mem->residents[i];
+        if (r->level_count && r->last_used == mem->frame && r->wanted < target[i])
+            order[waiting++] = i;
+    }
+    for (int k = 0; k < waiting; ++k)
+    {
+        const int i = order[k];
+        const GpuResident* r = &mem->residents[i];
+        while (target[i] > r->wanted)
+        {
+            const uint64_t bytes = r->level_bytes[target[i] - 1];
+            int victim;
+            while (projected + bytes > budget && (victim = pick_victim(mem, target, i, false)) >= 0)
+            {
+                const uint64_t freed = mem->residents[victim].level_bytes[target[victim]++];
+                projected -= freed < projected ? freed : projected;
+                mem->evicted_bytes += freed;
+            }
+            if (projected + bytes > budget)
+                break;
+            --target[i];
+            projected += bytes;
+            mem->restored_bytes += bytes;
+        }
+    }
+
+    int count = 0;
+    for (int i = 0; i < mem->resident_count; ++i)
+    {
+        GpuResident* r = &mem->residents[i];
+        if (target[i] != r->first)
+            changes[count++] = { i, r->first, target[i] };
+        r->first = target[i];
+    }
+    ++mem->frame;
+    return count;
+}
+
+const char* gpu_memory_category_name(GpuMemoryCategory category)
+{
+    static const char* names[GPU_MEMORY_CATEGORY_COUNT] = { "geometry", "uniforms", "storage", "staging", "textures",
+        "streamed textures", "render targets" };
+    return category < GPU_MEMORY_CATEGORY_COUNT ? names[category] : "?";
+}
+
+void gpu_memory_print(GpuMemory* mem, FILE* out)
+{
+    std::lock_guard<std::mutex> lock(mem->mutex);
+    const double mb = 1024.0 * 1024.0;
+    fprintf(out, "gpu memory: %.1f MB in %u objects (peak %.1f MB)", mem->total / mb, mem->object_count, mem->peak / mb);
+    if (mem->effective_budget != UINT64_MAX)
+        fprintf(out, ", budget %.1f MB", mem->effective_budget / mb);
+    fprintf(out, "\n");
+    for (int c = 0; c < GPU_MEMORY_CATEGORY_COUNT; ++c)
+    {
+        if (mem->peaks[c])
+            fprintf(out, "  %-18s %9.1f MB %6u objects, peak %.1f MB\n", gpu_memory_category_name((GpuMemoryCategory)c),
+                mem->bytes[c] / mb, mem->counts[c], mem->peaks[c] / mb);
+    }
+    if (mem->driver_known)
+    {
+        fprintf(out, "  driver: %.0f MB free", mem->driver.available_kb / 1024.0);
+        if (mem->driver.total_kb >= 0)
+            fprintf(out, " of %.0f MB", mem->driver.total_kb / 1024.0);
+        if (mem->driver.evictions >= 0)
+            fprintf(out, ", %lld evictions (%.1f MB)", (long long)mem->driver.evictions, mem->driver.evicted_kb / 1024.0);
+        fprintf(out, "\n");
+    }
+    if (mem->resident_count || mem->pressure_events)
+        fprintf(out, "  residency: %.1f MB evicted, %.1f MB restored, %llu frames over budget, %llu driver evictions reacted to\n",
+            mem->evicted_bytes / mb, mem->restored_bytes / mb, (unsigned long long)mem->over_budget_frames,
+            (unsigned long long)mem->pressure_events);
+    if (mem->dropped)
+        fprintf(out, "  %llu allocations not tracked: more than %d objects\n", (unsigned long long)mem->dropped,
+            GPU_MEMORY_MAX_OBJECTS * 3 / 4);
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+
+// Video memory accounting and a residency manager that keeps it under a
+// budget. GL-free: gl/gl_memory.h reports the allocations and the driver's
+// numbers, and the owners of streamed data carry out its decisions.
+//
+// Every buffer, texture and renderbuffer is recorded by its GL name with its
+// size and category, so there's a running total per category and overall,
+// with peaks. The driver's view (GL_NVX_gpu_memory_info, GL_ATI_meminfo) is
+// set beside it: what's still free, and how often the driver has evicted
+// video memory into system memory.
+//
+// The budget is the configured one, capped by what the driver says could
+// still be had: the tracked bytes plus its free memory, less
+// GPU_MEMORY_HEADROOM for what isn't tracked (the windows' own framebuffers,
+// the driver). When the driver starts evicting anyway - another process on a
+// shared node wants the memory - the budget drops to 7/8 of what's tracked,
+// and stays there until GPU_MEMORY_QUIET_FRAMES frames pass without another
+// eviction.
+//
+// Data that can be dropped and brought back is registered as a resident: a
+// chain of levels, finest first, like a mesh's levels of detail. Levels from
+// "pinned" on are never dropped, so there is always something to draw. Each
+// frame its owner reports the finest level it drew (gpu_memory_use), and
+// gpu_memory_update evicts whole levels, finest first, until the budget is
+// met: levels nothing drew this frame go first, least recently used first,
+// and levels in use only after those. Levels that are wanted again come back,
+// most recently used first, while they fit. Streamed texture mips have a
+// policy of their own (asset/texture_residency.h); gpu_memory_share gives it
+// what the budget leaves for them.
+//
+// Threading: every function locks, so GL threads of one share group can report
+// allocations while the render thread updates.
+
+#define GPU_MEMORY_MAX_OBJECTS 8192         // GL objects tracked at once (a power of two)
+#define GPU_MEMORY_MAX_RESIDENTS 64
+#define GPU_MEMORY_MAX_LEVELS 16
+#define GPU_MEMORY_HEADROOM (64ull << 20)   // kept free of the driver's free memory
+#define GPU_MEMORY_QUIET_FRAMES 600         // without driver evictions before the budget recovers
+
+typedef enum GpuMemoryCategory
+{
+    GPU_MEMORY_GEOMETRY,            // vertex and index buffers
+    GPU_MEMORY_UNIFORMS,            // uniform and texture buffers
+    GPU_MEMORY_STORAGE,             // shader storage, indirect and query result buffers
+    GPU_MEMORY_STAGING,             // streamed uploads and readbacks
+    GPU_MEMORY_TEXTURES,            // loaded whole: materials, atlases
+    GPU_MEMORY_STREAMED_TEXTURES,   // mips under asset/texture_residency.h
+    GPU_MEMORY_RENDER_TARGETS,      // colour, depth and the passes' intermediates
+    GPU_MEMORY_CATEGORY_COUNT
+} GpuMemoryCategory;
+
+typedef enum GpuMemoryKind
+{
+    GPU_MEMORY_BUFFER,
+    GPU_MEMORY_TEXTURE,
+    GPU_MEMORY_RENDERBUFFER
+} GpuMemoryKind;
+
+typedef struct GpuMemoryObject
+{
+    uint64_t key;                   // kind << 32 | GL name; 0 for an empty slot
+    uint64_t bytes;
+    GpuMemoryCategory category;
+    const char* site;               // "file:line" that allocated it (a string literal), NULL when not given
+} GpuMemoryObject;
+
+// What the driver reports, in KB; -1 where it doesn't say
+typedef struct GpuMemoryDriver
+{
+    int64_t total_kb;
+    int64_t available_kb;
+    int64_t evicted_kb;             // NVX: moved out to system memory so far
+    int64_t evictions;              // NVX: how many times
+} GpuMemoryDriver;
+
+typedef struct GpuResident
+{
+    GpuMemoryCategory category;
+    int level_count;
+    int pinned;                     // first level never evicted
+    uint64_t level_bytes[GPU_MEMORY_MAX_LEVELS];
+    int first;                      // finest level resident
+    int wanted;                     // finest level used in "last_used"
+    uint64_t last_used;             // frame, 0 for never
+} GpuResident;
+
+// A resident's levels moving from [from, level_count) to [to, level_count)
+typedef struct GpuResidencyChange
+{
+    int resident;
+    int from;
+    int to;
+} GpuResidencyChange;
+
+typedef struct GpuMemory
+{
+    std::mutex mutex;               // everything below
+    GpuMemoryObject objects[GPU_MEMORY_MAX_OBJECTS];    // open addressing on the key
+    uint32_t object_count;
+    uint64_t bytes[GPU_MEMORY_CATEGORY_COUNT];
+    uint32_t counts[GPU_MEMORY_CATEGORY_COUNT];
+    uint64_t peaks[GPU_MEMORY_CATEGORY_COUNT];
+    uint64_t total;
+    uint64_t peak;
+    uint64_t dropped;               // allocations not tracked: the table was full
+
+    uint64_t budget;                // configured, 0 for none
+    uint64_t effective_budget;      // as of the last update, UINT64_MAX for none
+    bool driver_known;
+    GpuMemoryDriver driver;
+    uint64_t pressure_cap;          // after driver evictions, UINT64_MAX otherwise
+    uint64_t pressure_frame;        // of the last driver eviction seen
+    uint64_t pressure_events;
+
+    GpuResident residents[GPU_MEMORY_MAX_RESIDENTS];
+    int resident_count;
+    uint64_t frame;
+    uint64_t evicted_bytes;         // totals since init
+    uint64_t restored_bytes;
+    uint64_t over_budget_frames;    // updates that couldn't get under the budget
+} GpuMemory;
+
+// "budget" in bytes, 0 for none (the driver's free memory still caps it where it's known)
+void gpu_memory_init(GpuMemory* mem, uint64_t budget);
+void gpu_memory_set_budget(GpuMemory* mem, uint64_t budget);
+
+// Records "name" as "bytes" of "category", replacing whatever it was before; 0 bytes forgets it
+void gpu_memory_track(GpuMemory* mem, GpuMemoryKind kind, uint32_t name, GpuMemoryCategory category, uint64_t bytes);
+// The same, remembering "site" (a string that outlives the object) as where it was allocated
+void gpu_memory_track_at(GpuMemory* mem, GpuMemoryKind kind, uint32_t name, GpuMemoryCategory category,
+    uint64_t bytes, const char* site);
+void gpu_memory_forget(GpuMemory* mem, GpuMemoryKind kind, uint32_t name);
+
+// Copies up to "max" of the objects tracked now into "objects", in no particular order, and returns how many
+// there are in all: what is still allocated, for a leak report at shutdown
+uint32_t gpu_memory_objects(GpuMemory* mem, GpuMemoryObject* objects, uint32_t max);
+
+void gpu_memory_set_driver(GpuMemory* mem, const GpuMemoryDriver* driver);
+
+// Bytes tracked in "category", or in all of them for GPU_MEMORY_CATEGORY_COUNT
+uint64_t gpu_memory_bytes(GpuMemory* mem, GpuMemoryCategory category);
+// As of the last update; UINT64_MAX for none
+uint64_t gpu_memory_budget(GpuMemory* mem);
+
+// The bytes "category" may hold under the current budget: what the others leave. UINT64_MAX without a budget.
+uint64_t gpu_memory_share(GpuMemory* mem, GpuMemoryCategory category);
+
+// "level_count" levels of "level_bytes" each, finest first, all resident; levels from "pinned" on stay.
+// Returns its id, or -1 when the table is full.
+int gpu_memory_add_resident(GpuMemory* mem, GpuMemoryCategory category, int level_count, const uint64_t* level_bytes,
+    int pinned);
+// Stops managing it (its owner freed it); its id isn't reused
+void gpu_memory_remove_resident(GpuMemory* mem, int resident);
+
+// The resident was drawn this frame, "level" the finest level drawn
+void gpu_memory_use(GpuMemory* mem, int resident, int level);
+
+// Ends the frame: recomputes the budget and decides the levels. Writes one change per resident whose levels
+// moved into "changes" (room for GPU_MEMORY_MAX_RESIDENTS) and returns how many. The caller must apply them
+// all and report the new sizes through gpu_memory_track.
+int gpu_memory_update(GpuMemory* mem, GpuResidencyChange* changes);
+
+// Per category, the budget, the driver's numbers and the evictions
+void gpu_memory_print(GpuMemory* mem, FILE* out);
+const char* gpu_memory_category_name(GpuMemoryCategory category);
@@ -0,0 +1,144 @@
+#include "core/hitch_detector.h"
+
+#include <string.h>
+
+void hitch_detector_init(HitchDetector* h, bool enabled, FILE* out)
+{
+    memset(h, 0, sizeof(*h));
+    h->enabled = enabled;
+    h->out = out;
+}
+
+static const char* current_pass(const HitchDetector* h)
+{
+    return h->depth > 0 ? h->stack[(h->depth < HITCH_MAX_DEPTH ? h->depth : HITCH_MAX_DEPTH) - 1] : "frame";
+}
+
+static void begin_span(HitchDetector* h, double now)
+{
+    if (h->count == HITCH_MAX_SPANS)
+        return;
+    HitchSpan* span = &h->spans[h->count++];
+    span->pass = current_pass(h);
+    span->begin = now;
+    span->program_count = 0;
+    span->first_use = 0;
+}
+
+void hitch_detector_push(HitchDetector* h, const char* pass, double now)
+{
+    if (!h->enabled)
+        return;
+    if (h->depth < HITCH_MAX_DEPTH)
+        h->stack[h->depth] = pass;
+    ++h->depth;
+    begin_span(h, now);
+}
+
+void hitch_detector_pop(HitchDetector* h, double now)
+{
+    if (!h->enabled || h->depth == 0)
+        return;
+    --h->depth;
+    begin_span(h, now);
+}
+
+// Remembers "program"; true the first time. Once the table is 3/4 full nothing new goes in or counts as new.
+static bool first_bind(HitchDetector* h, uint32_t program)
+{
+    const uint32_t mask = HITCH_SEEN_PROGRAMS - 1u;
+    for (uint32_t i = (program * 0x9E3779B1u) >> 20 & mask;; i = (i + 1) & mask)
+    {
+        if (h->seen[i] == program)
+            return false;
+        if (!h->seen[i])
+        {
+            if (h->seen_count >= HITCH_SEEN_PROGRAMS / 4 * 3)
+                return false;
+            h->seen[i] = program;
+            ++h->seen_count;
+            return true;
+        }
+    }
+}
+
+void hitch_detector_program(HitchDetector* h, uint32_t program)
+{
+    if (!h->enabled || !program || !(program & ~HITCH_PIPELINE))
+        return;
+    const bool first = first_bind(h, program);
+    if (!h->count)
+        return;     // before the first frame began
+    HitchSpan* span = &h->spans[h->count - 1];
+    if (span->program_count < HITCH_SPAN_PROGRAMS)
+    {
+        span->programs[span->program_count] = program;
+        span->first_use |= (uint8_t)(first ? 1u << span->program_count : 0u);
+    }
+    if (span->program_count < 255)
+        ++span->program_count;
+}
+
+static double span_ms(const HitchDetector* h, int i, double now)
+{
+    return ((i + 1 < h->count ? h->spans[i + 1].begin : now) - h->spans[i].begin) * 1000.0;
+}
+
+static void report(HitchDetector* h, double now, double median_ms)
+{
+    const double frame_ms = (now - h->frame_begin) * 1000.0;
+    fprintf(h->out, "hitch: frame %llu took %.1f ms, %.1fx the median of %.1f ms\n", (unsigned long long)h->frames,
+        frame_ms, median_ms > 0.0 ? frame_ms / median_ms : 0.0, median_ms);
+
+    // The longest spans, longest first
+    int longest[HITCH_REPORT_SPANS];
+    int n = 0;
+    for (int i = 0; i < h->count; ++i)
+    {
+        const double ms = span_ms(h, i, now);
+        if (n == HITCH_REPORT_SPANS && ms <= span_ms(h, longest[n - 1], now))
+            continue;
+        int at = n < HITCH_REPORT_SPANS ? n++ : n - 1;
+        for (; at > 0 && span_ms(h, longest[at - 1], now) < ms; --at)
+            longest[at] = longest[at - 1];
+        longest[at] = i;
+    }
+    for (int k = 0; k < n; ++k)
+    {
+        const HitchSpan* span = &h->spans[longest[k]];
+        fprintf(h->out, "  %-16s %7.2f ms", span->pass, span_ms(h, longest[k], now));
+        const int kept = span->program_count < HITCH_SPAN_PROGRAMS ? span->program_count : HITCH_SPAN_PROGRAMS;
+        for (int p = 0; p < kept; ++p)
+        {
+            const uint32_t name = span->programs[p];
+            fprintf(h->out, "%s%s %u%s", p ? ", " : ", bound ", name & HITCH_PIPELINE ? "pipeline" : "program",
+                name & ~HITCH_PIPELINE, span->first_use >> p & 1u ? " (first use)" : "");
+        }
+        if (span->program_count > kept)
+            fprintf(h->out, " and %d more", span->program_count - kept);
+        fputc('\n', h->out);
+    }
+}
+
+void hitch_detector_end_frame(HitchDetector* h, double now, bool hitch, double median_ms)
+{
+    if (!h->enabled)
+        return;
+    if (hitch && h->frame_begin > 0.0)
+    {
+        report(h, now, median_ms);
+        ++h->hitches;
+    }
+    ++h->frames;
+    h->count = 0;
+    h->frame_begin = now;
+    begin_span(h, now);
+}
+
+void hitch_detector_print(const HitchDetector* h, FILE* out)
+{
+    if (!h->enabled)
+        return;
+    fprintf(out, "hitches: %llu of %llu frames logged, %u programs seen bound\n", (unsigned long long)h->hitches,
+        (unsigned long long)h->frames, h->seen_count);
+}
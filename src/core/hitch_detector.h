@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Hitch detection: what the render thread was doing when a frame ran long.
+//
+// Each frame is cut into spans at pass boundaries. gl/gpu_profiler.h pushes
+// and pops every pass here, with its timing on or off, and gl/gl_state.h
+// reports each program (or program pipeline) bind that reaches GL. A span
+// keeps its pass and the first few programs bound in it. A program bound for
+// the first time in the run is flagged, because a driver that compiles
+// lazily does so at that program's first draw.
+//
+// The presenting thread ends every frame with hitch_detector_end_frame. For a
+// frame that core/frame_stats.h counted as a stutter (over
+// FRAME_STATS_STUTTER_FACTOR times the median), it logs the frame's longest
+// spans with their passes and programs. Other frames' spans are dropped.
+// Everything belongs to the render thread. Nothing is allocated.
+
+#define HITCH_MAX_SPANS 128         // per frame; later boundaries extend the last span
+#define HITCH_MAX_DEPTH 8
+#define HITCH_SPAN_PROGRAMS 4       // programs a span keeps; more are counted
+#define HITCH_REPORT_SPANS 3        // the longest spans logged per hitch
+#define HITCH_SEEN_PROGRAMS 4096    // programs remembered as bound before, a power of two
+#define HITCH_PIPELINE 0x80000000u  // the bit that marks a program pipeline's name among the programs
+
+typedef struct HitchSpan
+{
+    const char* pass;           // borrowed, usually a string literal
+    double begin;               // seconds
+    uint32_t programs[HITCH_SPAN_PROGRAMS];
+    uint8_t program_count;      // bound in the span, the ones not kept included
+    uint8_t first_use;          // bit i: programs[i] was bound for the first time
+} HitchSpan;
+
+typedef struct HitchDetector
+{
+    bool enabled;
+    FILE* out;
+    HitchSpan spans[HITCH_MAX_SPANS];
+    int count;
+    const char* stack[HITCH_MAX_DEPTH];     // the open passes: a pop returns to the one below
+    int depth;
+    double frame_begin;         // 0 before the first frame
+    uint32_t seen[HITCH_SEEN_PROGRAMS];     // open addressing; 0 is empty
+    uint32_t seen_count;
+    uint64_t frames;
+    uint64_t hitches;
+} HitchDetector;
+
+// With "enabled" false every call is a no-op. Hitches are logged to "out".
+void hitch_detector_init(HitchDetector* h, bool enabled, FILE* out);
+
+// A pass starts (or ends, back to the enclosing one) at "now", seconds on the caller's steady clock
+void hitch_detector_push(HitchDetector* h, const char* pass, double now);
+void hitch_detector_pop(HitchDetector* h, double now);
+
+// "program" was bound (HITCH_PIPELINE set for a pipeline); 0 unbinds and is ignored
+void hitch_detector_program(HitchDetector* h, uint32_t program);
+
+// The frame ends at "now". "hitch": frame_stats counted it as a stutter against "median_ms"; its spans are logged.
+// The next frame starts with the passes still open.
+void hitch_detector_end_frame(HitchDetector* h, double now, bool hitch, double median_ms);
+
+// Hitches logged out of frames seen, and programs seen bound
+void hitch_detector_print(const HitchDetector* h, FILE* out);
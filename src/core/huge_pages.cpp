@@ -0,0 +1,247 @@
+#include "core/huge_pages.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <unistd.h>
+#endif
+
+static std::atomic<bool> enabled(false);
+
+void huge_pages_enable(bool enable)
+{
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool huge_pages_enabled(void)
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+static size_t round_to(size_t size, size_t granule)
+{
+    return (size + granule - 1) / granule * granule;
+}
+
+const char* huge_page_kind_name(HugePageKind kind)
+{
+    switch (kind)
+    {
+    case HUGE_PAGES_TRANSPARENT: return "transparent huge pages";
+    case HUGE_PAGES_EXPLICIT: return "huge pages";
+    default: return "normal pages";
+    }
+}
+
+#if defined(__linux__)
+
+size_t huge_page_size(void)
+{
+    static const size_t size = []
+    {
+        size_t kb = 0;
+        FILE* f = fopen("/proc/meminfo", "r");
+        char line[128];
+        while (f && fgets(line, sizeof(line), f))
+        {
+            if (sscanf(line, "Hugepagesize: %zu kB", &kb) == 1)
+                break;
+        }
+        if (f)
+            fclose(f);
+        return kb * 1024;
+    }();
+    return size;
+}
+
+// Transparent huge pages can be asked for: "always" or "madvise" in the kernel's setting, not "never"
+static bool transparent_available(void)
+{
+    static const bool available = []
+    {
+        char line[128] = "";
+        FILE* f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+        if (!f)
+            return false;
+        const bool read = fgets(line, sizeof(line), f) != NULL;
+        fclose(f);
+        return read && !strstr(line, "[never]");
+    }();
+    return available;
+}
+
+size_t huge_pages_round(size_t size)
+{
+    const size_t huge = huge_page_size();
+    return round_to(size ? size : 1, huge ? huge : (size_t)sysconf(_SC_PAGESIZE));
+}
+
+void* huge_pages_alloc(size_t size, HugePageKind* kind)
+{
+    const size_t huge = huge_page_size();
+    size = huge_pages_round(size);
+    *kind = HUGE_PAGES_NONE;
+    if (huge_pages_enabled() && huge)
+    {
+        void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            *kind = HUGE_PAGES_EXPLICIT;
+            return p;
+        }
+        if (transparent_available())
+        {
+            // Over-map by a huge page and trim both ends, so the range starts on a huge page boundary
+            unsigned char* raw = (unsigned char*)mmap(NULL, size + huge, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw != (unsigned char*)MAP_FAILED)
+            {
+                unsigned char* aligned = (unsigned char*)round_to((uintptr_t)raw, huge);
+                if (aligned > raw)
+                    munmap(raw, (size_t)(aligned - raw));
+                munmap(aligned + size, (size_t)(raw + huge - aligned));
+                if (madvise(aligned, size, MADV_HUGEPAGE) == 0)
+                    *kind = HUGE_PAGES_TRANSPARENT;
+                return aligned;
+            }
+        }
+    }
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+void huge_pages_free(void* p, size_t size)
+{
+    if (p)
+        munmap(p, huge_pages_round(size));
+}
+
+bool huge_pages_advise(const void* p, size_t size)
+{
+    const uintptr_t huge = huge_page_size();
+    if (!huge_pages_enabled() || !huge || !transparent_available())
+        return false;
+    const uintptr_t begin = round_to((uintptr_t)p, huge);
+    const uintptr_t end = ((uintptr_t)p + size) / huge * huge;
+    return end > begin && madvise((void*)begin, end - begin, MADV_HUGEPAGE) == 0;
+}
+
+#elif defined(_WIN32)
+
+size_t huge_page_size(void)
+{
+    return GetLargePageMinimum();
+}
+
+// Large pages need SeLockMemoryPrivilege held and switched on in the process token; once is enough
+static bool lock_memory_privilege(void)
+{
+    static const bool held = []
+    {
+        HANDLE token;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+            return false;
+        TOKEN_PRIVILEGES privileges;
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        bool ok = LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid)
+            && AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL)
+            && GetLastError() == ERROR_SUCCESS;     // ERROR_NOT_ALL_ASSIGNED: the user hasn't been granted it
+        CloseHandle(token);
+        if (!ok)
+            fprintf(stderr, "huge_pages: no \"Lock pages in memory\" right, using normal pages\n");
+        return ok;
+    }();
+    return held;
+}
+
+size_t huge_pages_round(size_t size)
+{
+    size_t granule = huge_page_size();
+    if (!granule)
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        granule = info.dwPageSize;
+    }
+    return round_to(size ? size : 1, granule);
+}
+
+void* huge_pages_alloc(size_t size, HugePageKind* kind)
+{
+    size = huge_pages_round(size);
+    *kind = HUGE_PAGES_NONE;
+    if (huge_pages_enabled() && huge_page_size() && lock_memory_privilege())
+    {
+        void* p = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (p)
+        {
+            *kind = HUGE_PAGES_EXPLICIT;
+            return p;
+        }
+    }
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void huge_pages_free(void* p, size_t size)
+{
+    (void)size;
+    if (p)
+        VirtualFree(p, 0, MEM_RELEASE);
+}
+
+bool huge_pages_advise(const void* p, size_t size)
+{
+    (void)p;
+    (void)size;
+    return false;
+}
+
+#else
+
+size_t huge_page_size(void)
+{
+    return 0;
+}
+
+size_t huge_pages_round(size_t size)
+{
+    return round_to(size ? size : 1, (size_t)sysconf(_SC_PAGESIZE));
+}
+
+void* huge_pages_alloc(size_t size, HugePageKind* kind)
+{
+    size = huge_pages_round(size);
+    *kind = HUGE_PAGES_NONE;
+    void* p = NULL;
+    if (posix_memalign(&p, (size_t)sysconf(_SC_PAGESIZE), size) != 0)
+        return NULL;
+    memset(p, 0, size);
+    return p;
+}
+
+void huge_pages_free(void* p, size_t size)
+{
+    (void)size;
+    free(p);
+}
+
+bool huge_pages_advise(const void* p, size_t size)
+{
+    (void)p;
+    (void)size;
+    return false;
+}
+
+#endif
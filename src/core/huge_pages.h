@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+
+// Huge (large) pages for big, long-lived data: frame arenas sized for the
+// whole scene, ECS chunks, mapped scene files. A gigabyte in 4 KB pages is
+// 262144 TLB entries' worth; in 2 MB pages, 512, so a walk over it mostly
+// stops missing the TLB.
+//
+// They're off until huge_pages_enable (the app's --huge-pages), and always
+// fall back to normal pages. Linux first tries MAP_HUGETLB, which needs pages
+// set aside beforehand (vm.nr_hugepages), then transparent huge pages: the
+// mapping is aligned to a huge page and madvise(MADV_HUGEPAGE)d, which
+// works unless /sys/kernel/mm/transparent_hugepage/enabled is "never"; the
+// kernel then backs it with huge pages as it can. Windows allocates with
+// MEM_LARGE_PAGES, which needs the "Lock pages in memory" right
+// (SeLockMemoryPrivilege) granted to the user; it's switched on for the
+// process the first time. Large pages there are committed up front and never
+// paged out. Elsewhere there are only normal pages.
+//
+// Memory that's already mapped, like a file or a NUMA-placed reservation
+// (core/numa_memory.h), can only be advised: huge_pages_advise asks for
+// transparent huge pages over the whole huge pages inside it. Read-only file
+// mappings get them only from kernels built with READ_ONLY_THP_FOR_FS;
+// Windows can't back a file view with large pages at all.
+
+typedef enum HugePageKind
+{
+    HUGE_PAGES_NONE,            // normal pages
+    HUGE_PAGES_TRANSPARENT,     // asked for (Linux THP); the kernel may not have found all of them
+    HUGE_PAGES_EXPLICIT         // MAP_HUGETLB or MEM_LARGE_PAGES: every page is a huge one
+} HugePageKind;
+
+// The process-wide switch; off by default
+void huge_pages_enable(bool enable);
+bool huge_pages_enabled(void);
+
+// The size of a huge page (Linux: the default hugetlb size; Windows: GetLargePageMinimum), 0 when there are none
+size_t huge_page_size(void);
+
+// "size" rounded up to what huge_pages_alloc takes for it: whole huge pages, or whole normal pages without them
+size_t huge_pages_round(size_t size);
+
+// At least "size" bytes, zeroed and huge page aligned, in huge pages when enabled and the system has any to give,
+// else in normal pages; "kind" gets which. NULL when out of memory.
+void* huge_pages_alloc(size_t size, HugePageKind* kind);
+
+// Frees what huge_pages_alloc returned for the same "size"
+void huge_pages_free(void* p, size_t size);
+
+// Asks for transparent huge pages over the whole huge pages inside mapped memory, when enabled. Linux only: false
+// elsewhere, or when there are none to ask for.
+bool huge_pages_advise(const void* p, size_t size);
+
+const char* huge_page_kind_name(HugePageKind kind);
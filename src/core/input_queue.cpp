@@ -0,0 +1,40 @@
+#include "core/input_queue.h"
+
+void input_queue_init(InputQueue* q)
+{
+    q->head.store(0, std::memory_order_relaxed);
+    q->tail.store(0, std::memory_order_relaxed);
+    q->dropped.store(0, std::memory_order_relaxed);
+}
+
+bool input_queue_push(InputQueue* q, const InputEvent* event)
+{
+    const uint32_t head = q->head.load(std::memory_order_relaxed);
+    const uint32_t tail = q->tail.load(std::memory_order_acquire);   // the consumer is done with the slots below it
+    if (head - tail >= INPUT_QUEUE_CAPACITY)
+    {
+        q->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    q->events[head & (INPUT_QUEUE_CAPACITY - 1)] = *event;
+    q->head.store(head + 1, std::memory_order_release);             // publishes the slot
+    return true;
+}
+
+size_t input_queue_drain(InputQueue* q, InputEvent* out, size_t max)
+{
+    const uint32_t tail = q->tail.load(std::memory_order_relaxed);
+    const uint32_t head = q->head.load(std::memory_order_acquire);   // every slot below it is written
+    size_t count = head - tail;
+    if (count > max)
+        count = max;
+    for (size_t i = 0; i < count; ++i)
+        out[i] = q->events[(tail + (uint32_t)i) & (INPUT_QUEUE_CAPACITY - 1)];
+    q->tail.store(tail + (uint32_t)count, std::memory_order_release);   // hands the slots back
+    return count;
+}
+
+bool input_queue_pending(const InputQueue* q)
+{
+    return q->head.load(std::memory_order_acquire) != q->tail.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Timestamped input events, handed from the thread that polls the window
+// system to the simulation without a lock.
+//
+// A single-producer/single-consumer ring: GLFW callbacks (which all run
+// inside glfwPollEvents, on the main thread) push, and the simulation drains
+// whatever has arrived in batches at the start of each tick. The producer
+// only writes "head" and the consumer only writes "tail", each on its own
+// cache line; an event is published by the release store of "head" and its
+// slot handed back by the release store of "tail", so neither side ever
+// waits for the other. A full ring drops the new event and counts it rather
+// than blocking the window system's thread.
+
+#define INPUT_QUEUE_CAPACITY 256    // power of two
+
+typedef enum InputEventType
+{
+    INPUT_EVENT_KEY,            // code = GLFW key, action = GLFW_PRESS/RELEASE/REPEAT, mods
+    INPUT_EVENT_MOUSE_BUTTON,   // code = GLFW button, action, mods, (x, y) = cursor in window coordinates
+    INPUT_EVENT_SCROLL,         // (x, y) = scroll offsets
+    INPUT_EVENT_RESIZE,         // (x, y) = new framebuffer size in pixels
+    INPUT_EVENT_FOCUS,          // action = 1 when the window gained focus, 0 when it lost it
+    INPUT_EVENT_CURSOR          // (x, y) = cursor in window coordinates; only pushed for --camera
+} InputEventType;
+
+typedef struct InputEvent
+{
+    double time;                // when the producer saw it, in seconds of its clock
+    InputEventType type;
+    int code;
+    int action;
+    int mods;
+    double x, y;
+} InputEvent;
+
+typedef struct InputQueue
+{
+    alignas(64) std::atomic<uint32_t> head;     // producer: events pushed (wraps)
+    alignas(64) std::atomic<uint32_t> tail;     // consumer: events drained (wraps)
+    std::atomic<uint32_t> dropped;              // pushes that found the ring full
+    alignas(64) InputEvent events[INPUT_QUEUE_CAPACITY];
+} InputQueue;
+
+void input_queue_init(InputQueue* q);
+
+// Producer side: false (and the event is dropped) when the ring is full
+bool input_queue_push(InputQueue* q, const InputEvent* event);
+
+// Consumer side: moves up to "max" of the oldest events into "out", in push order, and returns how many
+size_t input_queue_drain(InputQueue* q, InputEvent* out, size_t max);
+
+// Consumer side: true when events are waiting to be drained
+bool input_queue_pending(const InputQueue* q);
@@ -0,0 +1,339 @@
+#include "core/job_system.h"
+
+#include "core/alloc_tracker.h"
+#include "core/cpu_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Index of the calling thread in the system it belongs to (-1 outside of any)
+static thread_local int job_thread_index = -1;
+
+// Chase-Lev deque, as in "Dynamic Circular Work-Stealing Deque" (Chase, Lev 2005) with the C11 orderings
+// of "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013). Capacity is fixed:
+// job pools are bounded anyway, so the deque never has to grow.
+static void deque_init(JobDeque* d)
+{
+    d->top.store(0, std::memory_order_relaxed);
+    d->bottom.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < JOB_SYSTEM_DEQUE_SIZE; ++i)
+        d->jobs[i].store(NULL, std::memory_order_relaxed);
+}
+
+// Owner only
+static bool deque_push(JobDeque* d, Job* job)
+{
+    const long long b = d->bottom.load(std::memory_order_relaxed);
+    const long long t = d->top.load(std::memory_order_acquire);
+    if (b - t >= JOB_SYSTEM_DEQUE_SIZE)
+        return false;
+    d->jobs[b & (JOB_SYSTEM_DEQUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    d->bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+// Owner only
+static Job* deque_pop(JobDeque* d)
+{
+    const long long b = d->bottom.load(std::memory_order_relaxed) - 1;
+    d->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long t = d->top.load(std::memory_order_relaxed);
+    if (t > b)
+    {
+        // Empty
+        d->bottom.store(b + 1, std::memory_order_relaxed);
+        return NULL;
+    }
+    Job* job = d->jobs[b & (JOB_SYSTEM_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+        // Last job: race the thieves for it
+        if (!d->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = NULL;
+        d->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+// Any thread
+static Job* deque_steal(JobDeque* d)
+{
+    long long t = d->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const long long b = d->bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return NULL;
+    Job* job = d->jobs[t & (JOB_SYSTEM_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+    if (!d->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return NULL;    // lost to the owner or another thief
+    return job;
+}
+
+static void job_finish(Job* job)
+{
+    while (job)
+    {
+        // The last one out finishes the parent too
+        if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        job = job->parent;
+    }
+}
+
+static void job_execute(Job* job)
+{
+    CPU_TRACE_SCOPE("job");
+    job->function(job, job->data);
+    job_finish(job);
+}
+
+static unsigned int steal_random(JobThread* self)
+{
+    unsigned int x = self->steal_seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    self->steal_seed = x;
+    return x;
+}
+
+// Own deque first, then a random victim on the same NUMA node (when the threads have nodes), then any random one
+static Job* job_get(JobSystem* js, int index)
+{
+    JobThread* self = &js->threads[index];
+    Job* job = deque_pop(&self->deque);
+    if (job || js->thread_count == 1)
+        return job;
+
+    if (const int near_count = self->near_count.load(std::memory_order_acquire))
+    {
+        const int near = self->near[steal_random(self) % (unsigned int)near_count];
+        if ((job = deque_steal(&js->threads[near].deque)) != NULL)
+            return job;
+    }
+    const int victim = (int)(steal_random(self) % (unsigned int)js->thread_count);
+    if (victim == index)
+        return NULL;
+    return deque_steal(&js->threads[victim].deque);
+}
+
+static void worker_main(JobSystem* js, int index)
+{
+    job_thread_index = index;
+    ALLOC_TAG_SCOPE(ALLOC_TAG_JOBS);
+    char name[CPU_TRACE_NAME_SIZE];
+    snprintf(name, sizeof(name), "worker %d", index);
+    cpu_trace_thread_name(name);
+    int idle = 0;
+    while (!js->stop.load(std::memory_order_acquire))
+    {
+        if (Job* job = job_get(js, index))
+        {
+            job_execute(job);
+            idle = 0;
+        }
+        else if (++idle < 256)
+            std::this_thread::yield();
+        else
+        {
+            // Nothing to do for a while: sleep until job_run wakes us (the timeout covers a missed wake-up)
+            std::unique_lock<std::mutex> lock(js->sleep_mutex);
+            js->sleeping.fetch_add(1, std::memory_order_relaxed);
+            js->wake.wait_for(lock, std::chrono::milliseconds(2));
+            js->sleeping.fetch_sub(1, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+    job_thread_index = -1;
+}
+
+bool job_system_init(JobSystem* js, int thread_count)
+{
+    if (thread_count <= 0)
+        thread_count = (int)std::thread::hardware_concurrency();
+    if (thread_count <= 0)
+        thread_count = 1;
+    if (thread_count > JOB_SYSTEM_MAX_THREADS)
+        thread_count = JOB_SYSTEM_MAX_THREADS;
+
+    js->thread_count = thread_count;
+    js->threads = new (std::nothrow) JobThread[thread_count];
+    if (!js->threads)
+    {
+        fprintf(stderr, "job_system: out of memory for %d threads\n", thread_count);
+        return false;
+    }
+    for (int i = 0; i < thread_count; ++i)
+    {
+        deque_init(&js->threads[i].deque);
+        js->threads[i].pool_next = 0;
+        js->threads[i].steal_seed = 0x9E3779B9u * (unsigned int)(i + 1);
+        js->threads[i].node = -1;
+        js->threads[i].near_count.store(0, std::memory_order_relaxed);
+    }
+    js->stop.store(false);
+    js->sleeping.store(0);
+
+    job_thread_index = 0;
+    js->workers = new std::thread[thread_count - 1];
+    for (int i = 1; i < thread_count; ++i)
+        js->workers[i - 1] = std::thread(worker_main, js, i);
+    return true;
+}
+
+void job_system_destroy(JobSystem* js)
+{
+    js->stop.store(true, std::memory_order_release);
+    js->wake.notify_all();
+    for (int i = 1; i < js->thread_count; ++i)
+        js->workers[i - 1].join();
+    delete[] js->workers;
+    delete[] js->threads;
+    js->workers = NULL;
+    js->threads = NULL;
+    js->thread_count = 0;
+    job_thread_index = -1;
+}
+
+void job_system_set_nodes(JobSystem* js, const int* nodes)
+{
+    for (int i = 0; i < js->thread_count; ++i)
+    {
+        JobThread* self = &js->threads[i];
+        self->node = nodes[i];
+        int count = 0;
+        for (int k = 0; k < js->thread_count && nodes[i] >= 0; ++k)
+        {
+            if (k != i && nodes[k] == nodes[i])
+                self->near[count++] = (short)k;
+        }
+        self->near_count.store(count, std::memory_order_release);
+    }
+}
+
+// Jobs only exist on the threads that own a pool and a deque: thread 0 and the workers
+static bool job_thread_check(void)
+{
+    if (job_thread_index >= 0)
+        return true;
+    fprintf(stderr, "job_system: jobs can only be created, run or waited for on thread 0 or a worker\n");
+    return false;
+}
+
+Job* job_create(JobSystem* js, JobFunction function, const void* data, size_t size)
+{
+    return job_create_child(js, NULL, function, data, size);
+}
+
+Job* job_create_child(JobSystem* js, Job* parent, JobFunction function, const void* data, size_t size)
+{
+    if (size > JOB_DATA_SIZE)
+    {
+        fprintf(stderr, "job_system: %zu bytes of job data, at most %d fit\n", size, JOB_DATA_SIZE);
+        return NULL;
+    }
+    if (!job_thread_check())
+        return NULL;
+    JobThread* self = &js->threads[job_thread_index];
+    Job* job = &self->pool[self->pool_next++ & (JOB_SYSTEM_POOL_SIZE - 1)];
+    job->function = function;
+    job->parent = parent;
+    job->unfinished.store(1, std::memory_order_relaxed);
+    if (parent)
+        parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+    if (size)
+        memcpy(job->data, data, size);
+    return job;
+}
+
+void job_run(JobSystem* js, Job* job)
+{
+    if (!job || !job_thread_check())
+        return;
+    if (!deque_push(&js->threads[job_thread_index].deque, job))
+    {
+        job_execute(job);   // deque full: run it inline rather than drop it
+        return;
+    }
+    if (js->sleeping.load(std::memory_order_relaxed) > 0)
+        js->wake.notify_one();
+}
+
+bool job_finished(const Job* job)
+{
+    return job->unfinished.load(std::memory_order_acquire) == 0;
+}
+
+int job_thread_current(void)
+{
+    return job_thread_index;
+}
+
+void job_wait(JobSystem* js, Job* job)
+{
+    if (!job || !job_thread_check())
+        return;
+    const int index = job_thread_index;
+    while (!job_finished(job))
+    {
+        if (Job* other = job_get(js, index))
+            job_execute(other);
+        else
+            std::this_thread::yield();
+    }
+}
+
+// What every range of one job_parallel_for shares; lives in the root job, which outlives all the ranges
+typedef struct ParallelFor
+{
+    JobSystem* js;
+    JobRangeFunction function;
+    void* data;
+    size_t grain;
+} ParallelFor;
+
+typedef struct ParallelForRange
+{
+    const ParallelFor* shared;
+    size_t begin;
+    size_t end;
+} ParallelForRange;
+
+// Halves the range into two child jobs until it is no larger than the grain
+static void parallel_for_range_job(Job* job, const void* data)
+{
+    const ParallelForRange* range = (const ParallelForRange*)data;
+    const ParallelFor* shared = range->shared;
+    if (range->end - range->begin <= shared->grain)
+    {
+        shared->function(shared->data, range->begin, range->end);
+        return;
+    }
+
+    const size_t mid = range->begin + (range->end - range->begin) / 2;
+    const ParallelForRange left = { shared, range->begin, mid };
+    const ParallelForRange right = { shared, mid, range->end };
+    Job* left_job = job_create_child(shared->js, job, parallel_for_range_job, &left, sizeof(left));
+    Job* right_job = job_create_child(shared->js, job, parallel_for_range_job, &right, sizeof(right));
+    job_run(shared->js, left_job);
+    job_run(shared->js, right_job);
+}
+
+// The root only carries the shared state and finishes once every range has
+static void parallel_for_job(Job* job, const void* data)
+{
+}
+
+Job* job_parallel_for(JobSystem* js, JobRangeFunction function, void* data, size_t count, size_t grain)
+{
+    const ParallelFor shared = { js, function, data, grain ? grain : 1 };
+    Job* root = job_create(js, parallel_for_job, &shared, sizeof(shared));
+    if (!root)
+        return NULL;
+    const ParallelForRange all = { (const ParallelFor*)root->data, 0, count };
+    job_run(js, job_create_child(js, root, parallel_for_range_job, &all, sizeof(all)));
+    job_run(js, root);
+    return root;
+}
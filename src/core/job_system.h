@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <stddef.h>
+
+// Work-stealing job scheduler for per-frame CPU work.
+//
+// A fixed pool of worker threads plus the thread that called job_system_init
+// (thread 0) each own a Chase-Lev deque: the owner pushes and pops jobs at the
+// bottom without locking, idle threads steal from the top of someone else's.
+// Jobs form trees through parent/child counters: a job is finished once it and
+// every child created under it have run, so waiting on a root waits for the
+// whole tree. job_wait doesn't block the calling thread, it runs queued jobs
+// until the one it waits for is done.
+//
+// On a machine with several NUMA nodes, job_system_set_nodes says which node
+// each thread is pinned to; a thread out of work then tries a thread of its
+// own node before a random one, so jobs, and the data their creators just
+// wrote, tend to stay on the node.
+//
+// Jobs come from a per-thread ring of JOB_SYSTEM_POOL_SIZE entries and are
+// never freed; a thread must not have more than that many unfinished jobs
+// outstanding (one frame's worth of work is far below it).
+
+#define JOB_SYSTEM_MAX_THREADS 64
+#define JOB_SYSTEM_POOL_SIZE 4096       // per thread, power of two
+#define JOB_SYSTEM_DEQUE_SIZE 4096      // per thread, power of two
+#define JOB_DATA_SIZE 40                // bytes of argument storage carried inline by each job
+
+typedef struct Job Job;
+typedef void (*JobFunction)(Job* job, const void* data);
+
+struct alignas(64) Job
+{
+    alignas(16) unsigned char data[JOB_DATA_SIZE];  // first, so pointers and doubles copied in are aligned
+    JobFunction function;
+    Job* parent;
+    std::atomic<int> unfinished;    // 1 for the job itself + one per unfinished child
+};
+
+static_assert(offsetof(Job, data) % 16 == 0, "job data holds pointers and doubles");
+static_assert(sizeof(Job) == 64, "a job fills one cache line");
+
+// Chase-Lev work-stealing deque (fixed capacity)
+typedef struct JobDeque
+{
+    alignas(64) std::atomic<long long> top;     // steal end
+    alignas(64) std::atomic<long long> bottom;  // owner end
+    std::atomic<Job*> jobs[JOB_SYSTEM_DEQUE_SIZE];
+} JobDeque;
+
+typedef struct JobThread
+{
+    JobDeque deque;
+    Job pool[JOB_SYSTEM_POOL_SIZE];
+    unsigned int pool_next;
+    unsigned int steal_seed;        // xorshift state for picking victims
+    int node;                       // NUMA node it's pinned to, -1 for any
+    std::atomic<int> near_count;    // the other threads on its node, tried first when stealing; published last
+    short near[JOB_SYSTEM_MAX_THREADS];
+} JobThread;
+
+typedef struct JobSystem
+{
+    int thread_count;               // workers + the owning thread
+    JobThread* threads;             // [thread_count], index 0 is the owning thread
+    std::thread* workers;           // [thread_count - 1]
+    std::atomic<bool> stop;
+    std::atomic<int> sleeping;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+} JobSystem;
+
+// Creates "thread_count" - 1 workers (0 = one per hardware thread); the calling thread becomes thread 0
+// and must be the one that calls job_system_destroy.
+bool job_system_init(JobSystem* js, int thread_count);
+void job_system_destroy(JobSystem* js);
+
+// Thread i's NUMA node is "nodes[i]" (-1 for none), for stealing from its own node first. Called once, by the
+// owning thread, after the threads have been pinned.
+void job_system_set_nodes(JobSystem* js, const int* nodes);
+
+// Allocates a job from the calling thread's pool. "data" (up to JOB_DATA_SIZE bytes) is copied into the
+// job and handed back to "function". Only threads running inside the system (thread 0 and workers) may
+// create, run or wait for jobs; anywhere else this reports the mistake and returns NULL.
+Job* job_create(JobSystem* js, JobFunction function, const void* data, size_t size);
+
+// As job_create, but "parent" isn't finished until this job is. Create children before running them.
+Job* job_create_child(JobSystem* js, Job* parent, JobFunction function, const void* data, size_t size);
+
+// Queues the job on the calling thread's deque. A NULL job, or a thread outside the system, is ignored (the
+// latter reported).
+void job_run(JobSystem* js, Job* job);
+
+// Runs other jobs until "job" (and all of its children) has finished; returns at once for NULL, as job_run
+void job_wait(JobSystem* js, Job* job);
+
+bool job_finished(const Job* job);
+
+// The calling thread's index in the system it runs in (0: the owning thread), -1 outside any job system
+int job_thread_current(void);
+
+// Calls function(data, begin, end) over [0, count) in ranges of at most "grain" items, split recursively
+// across the pool. Returns the root job, already running; job_wait on it. NULL, with nothing run, when the root
+// can't be created.
+typedef void (*JobRangeFunction)(void* data, size_t begin, size_t end);
+Job* job_parallel_for(JobSystem* js, JobRangeFunction function, void* data, size_t count, size_t grain);
@@ -0,0 +1,107 @@
+#include "core/line_series.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool line_series_init(LineSeries* series, uint32_t capacity)
+{
+    memset(series, 0, sizeof(*series));
+    uint32_t c = 1;
+    while (c < capacity && c < (1u << 30))
+        c <<= 1;
+    series->capacity = c;
+    uint32_t pairs = 0;
+    for (uint32_t n = c; n; n >>= 1)
+        series->level_offset[series->level_count++] = (pairs += n) - n;
+    series->buckets = (float*)malloc(sizeof(float) * 2 * pairs);
+    return series->buckets != NULL;
+}
+
+void line_series_destroy(LineSeries* series)
+{
+    free(series->buckets);
+    memset(series, 0, sizeof(*series));
+}
+
+void line_series_append(LineSeries* series, const float* values, size_t count)
+{
+    for (size_t k = 0; k < count; ++k)
+    {
+        const uint64_t i = series->count++;
+        const float v = values[k];
+        float* b = series->buckets + 2 * (i & (series->capacity - 1));
+        b[0] = b[1] = v;
+        for (int l = 1; l < series->level_count; ++l)
+        {
+            const uint32_t mask = (series->capacity >> l) - 1;
+            b = series->buckets + 2 * (series->level_offset[l] + ((i >> l) & mask));
+            if (!(i & ((1ull << l) - 1)))
+                b[0] = b[1] = v;        // the first of its run: the bucket starts over
+            else
+            {
+                b[0] = v < b[0] ? v : b[0];
+                b[1] = v > b[1] ? v : b[1];
+            }
+        }
+    }
+}
+
+void line_series_view(const LineSeries* series, uint64_t first, uint64_t count, int pixels, LineSeriesView* view)
+{
+    memset(view, 0, sizeof(*view));
+    const uint64_t kept = series->count < series->capacity ? 0 : series->count - series->capacity;
+    uint64_t end = first + count < series->count ? first + count : series->count;
+    first = first > kept ? first : kept;
+    if (end <= first || pixels < 1)
+        return;
+
+    // The finest level with no more buckets than pixels
+    int level = 0;
+    while (level + 1 < series->level_count && ((end - 1) >> level) - (first >> level) + 1 > (uint64_t)pixels)
+        ++level;
+    // A level's oldest bucket may have had its slot taken by a newer one
+    const uint64_t newest = (series->count - 1) >> level;
+    const uint64_t buckets = series->capacity >> level;
+    uint64_t from = first >> level;
+    from = newest + 1 - from > buckets ? newest + 1 - buckets : from;
+    view->level = level;
+    view->first = from;
+    view->buckets = (uint32_t)(((end - 1) >> level) - from + 1);
+
+    const float* b = series->buckets + 2 * series->level_offset[level];
+    const uint64_t mask = buckets - 1;
+    view->min = b[2 * (from & mask)];
+    view->max = b[2 * (from & mask) + 1];
+    for (uint64_t i = from + 1; i < from + view->buckets; ++i)
+    {
+        view->min = b[2 * (i & mask)] < view->min ? b[2 * (i & mask)] : view->min;
+        view->max = b[2 * (i & mask) + 1] > view->max ? b[2 * (i & mask) + 1] : view->max;
+    }
+}
+
+int line_series_take_dirty(LineSeries* series, int level, uint32_t ranges[2][2])
+{
+    if (!series->count || level >= series->level_count)
+        return 0;
+    const uint64_t newest = (series->count - 1) >> level;
+    const uint32_t buckets = series->capacity >> level;
+    const uint64_t from = series->dirty[level];
+    series->dirty[level] = newest;      // still partial: the next samples rewrite it
+    if (newest - from + 1 >= buckets)
+    {
+        ranges[0][0] = 0;
+        ranges[0][1] = buckets;
+        return 1;
+    }
+    const uint32_t start = (uint32_t)(from & (buckets - 1)), n = (uint32_t)(newest - from + 1);
+    ranges[0][0] = start;
+    if (start + n <= buckets)
+    {
+        ranges[0][1] = n;
+        return 1;
+    }
+    ranges[0][1] = buckets - start;
+    ranges[1][0] = 0;
+    ranges[1][1] = n - (buckets - start);
+    return 2;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Live time series for charts: samples appended as they arrive, a fixed
+// history kept, and a min/max pyramid over it so any span draws with about
+// as many points as it has pixels.
+//
+// Level 0 holds the samples, level L the min and max of each run of 2^L of
+// them, every level a ring over the same "capacity" samples of history
+// (capacity >> L buckets). Appending a sample writes its slot in each level:
+// the level's newest bucket is started or widened, so the levels are always
+// current and the newest bucket of each is partial until its run is
+// complete. All the levels together are 2 x capacity (min, max) pairs.
+//
+// line_series_view picks the finest level whose buckets over the span fit
+// the pixels, so a view of a million samples across 1000 pixels reads a
+// thousand buckets of level 10, and each bucket becomes two points: its min
+// and its max, drawn as one polyline that covers every sample's value.
+//
+// For a GPU copy (gl/line_renderer.h) line_series_take_dirty hands out the
+// ring slots written since the last call, per level: a new sample costs its
+// slot in each level, about two pairs in all, whatever the history length.
+// Nothing here calls GL.
+
+#define LINE_SERIES_MAX_LEVELS 32
+
+typedef struct LineSeries
+{
+    float* buckets;                 // (min, max) pairs, level by level
+    uint32_t level_offset[LINE_SERIES_MAX_LEVELS];  // first pair of each level
+    int level_count;                // down to one bucket holding the whole history
+    uint32_t capacity;              // samples kept, a power of two
+    uint64_t count;                 // appended since init
+    uint64_t dirty[LINE_SERIES_MAX_LEVELS];         // first bucket per level not taken yet
+} LineSeries;
+
+// What a span of history draws from
+typedef struct LineSeriesView
+{
+    int level;
+    uint64_t first;                 // bucket, at that level
+    uint32_t buckets;               // 0 when the span holds no kept samples
+    float min, max;                 // of the values in them
+} LineSeriesView;
+
+// "capacity" is rounded up to a power of two. Returns false if the memory isn't there.
+bool line_series_init(LineSeries* series, uint32_t capacity);
+void line_series_destroy(LineSeries* series);
+
+void line_series_append(LineSeries* series, const float* values, size_t count);
+
+// Samples first to first + count - 1 (clamped to what's kept) over "pixels" pixels
+void line_series_view(const LineSeries* series, uint64_t first, uint64_t count, int pixels, LineSeriesView* view);
+
+// The ring slots of "level" written since the last call for it, as up to two (first slot, slot count) ranges;
+// returns how many
+int line_series_take_dirty(LineSeries* series, int level, uint32_t ranges[2][2]);
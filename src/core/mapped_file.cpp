@@ -0,0 +1,133 @@
+#include "core/mapped_file.h"
+
+#include "core/huge_pages.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void mapped_file_adopt(MappedFile* file, void* buffer, size_t size)
+{
+    memset(file, 0, sizeof(*file));
+#ifndef _WIN32
+    file->fd = -1;
+#endif
+    file->data = buffer;
+    file->size = size;
+    file->buffer = buffer;
+}
+
+#ifdef _WIN32
+
+bool mapped_file_open(MappedFile* file, const char* path)
+{
+    memset(file, 0, sizeof(*file));
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "mapped_file: can't open %s (error %lu)\n", path, GetLastError());
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+    {
+        fprintf(stderr, "mapped_file: %s is empty or unreadable\n", path);
+        CloseHandle(handle);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data)
+    {
+        fprintf(stderr, "mapped_file: can't map %s (error %lu)\n", path, GetLastError());
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(handle);
+        return false;
+    }
+    file->data = data;
+    file->size = (size_t)size.QuadPart;
+    file->file = handle;
+    file->mapping = mapping;
+    return true;
+}
+
+void mapped_file_close(MappedFile* file)
+{
+    if (file->buffer)
+        free(file->buffer);
+    else if (file->data)
+        UnmapViewOfFile(file->data);
+    if (file->mapping)
+        CloseHandle((HANDLE)file->mapping);
+    if (file->file)
+        CloseHandle((HANDLE)file->file);
+    memset(file, 0, sizeof(*file));
+}
+
+#else
+
+bool mapped_file_open(MappedFile* file, const char* path)
+{
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "mapped_file: can't open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        fprintf(stderr, "mapped_file: %s is empty or unreadable\n", path);
+        close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "mapped_file: can't map %s: %s\n", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    // The whole file is about to be streamed into GL buffers: start readahead now
+    posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    posix_madvise(data, (size_t)st.st_size, POSIX_MADV_WILLNEED);
+    // A scene file is read straight from the mapping every frame: its huge-page-sized stretches can be collapsed
+    // into huge pages (with --huge-pages, on kernels that do it for read-only files)
+    huge_pages_advise(data, (size_t)st.st_size);
+    file->data = data;
+    file->size = (size_t)st.st_size;
+    file->fd = fd;
+    return true;
+}
+
+void mapped_file_close(MappedFile* file)
+{
+    if (file->buffer)
+        free(file->buffer);
+    else if (file->data)
+    {
+        munmap((void*)file->data, file->size);
+        close(file->fd);
+    }
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+}
+
+#endif
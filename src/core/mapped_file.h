@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile).
+//
+// The pages are the OS page cache itself: nothing is read until touched, and
+// handing "data" straight to glBufferData lets the driver DMA / copy from the
+// cache without an intermediate heap buffer. The mapping stays valid until
+// mapped_file_close. With huge pages enabled (core/huge_pages.h), Linux is
+// asked to back the mapping with transparent huge pages.
+//
+// A heap buffer can stand in for a mapping (mapped_file_adopt): a file read
+// out of an asset package (asset/asset_package.h) then opens through the same
+// loaders as one mapped from disk.
+
+typedef struct MappedFile
+{
+    const void* data;
+    size_t size;
+    void* buffer;       // adopted heap memory ("data"), freed on close; NULL for a mapping
+#ifdef _WIN32
+    void* file;         // HANDLE
+    void* mapping;      // HANDLE
+#else
+    int fd;
+#endif
+} MappedFile;
+
+// Maps "path". Logs and returns false when it can't be opened or is empty.
+bool mapped_file_open(MappedFile* file, const char* path);
+// Takes "buffer" (malloc'd, "size" bytes) as the file's contents
+void mapped_file_adopt(MappedFile* file, void* buffer, size_t size);
+// Unmaps, or frees an adopted buffer; safe to call on a MappedFile whose open failed
+void mapped_file_close(MappedFile* file);
@@ -0,0 +1,343 @@
+#include "core/metrics_server.h"
+
+#include "core/cpu_trace.h"
+
+#include <chrono>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#define SEND_FLAGS 0
+#define WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#define SEND_FLAGS MSG_NOSIGNAL     // a scraper that's gone is an answer dropped, not a SIGPIPE
+#define WOULD_BLOCK() (errno == EWOULDBLOCK || errno == EAGAIN)
+#endif
+
+#define METRICS_WORDS (sizeof(MetricsSample) / sizeof(uint64_t))
+#define METRICS_POLL_SECONDS 0.1    // how long the server waits for a connection before looking at "stop"
+
+std::atomic<bool> metrics_enabled(false);
+
+static std::atomic<uint64_t> sequence(0);   // odd while the words are being stored
+static std::atomic<uint64_t> words[METRICS_WORDS];
+static std::thread server_thread;
+static std::atomic<bool> stop(false);
+static socket_t listener = INVALID_SOCKET;
+
+static double now_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void metrics_sample_clear(MetricsSample* sample)
+{
+    memset(sample, 0, sizeof(*sample));
+    sample->frame_p50_ms = sample->frame_p95_ms = sample->frame_p99_ms = sample->frame_max_ms = -1.0;
+    sample->gpu_frame_ms = -1.0;
+    sample->gpu_memory_bytes = sample->gpu_budget_bytes = sample->gpu_available_bytes = sample->heap_bytes = -1;
+    sample->mesh_queue = sample->texture_queue = -1;
+}
+
+void metrics_publish(const MetricsSample* sample)
+{
+    uint64_t copy[METRICS_WORDS];
+    memcpy(copy, sample, sizeof(copy));
+    const uint64_t at = sequence.load(std::memory_order_relaxed);
+    sequence.store(at + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < METRICS_WORDS; ++i)
+        words[i].store(copy[i], std::memory_order_relaxed);
+    sequence.store(at + 2, std::memory_order_release);
+}
+
+void metrics_read(MetricsSample* out)
+{
+    uint64_t copy[METRICS_WORDS];
+    for (;;)
+    {
+        const uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before == 0)
+        {
+            metrics_sample_clear(out);
+            return;
+        }
+        if (before & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < METRICS_WORDS; ++i)
+            copy[i] = words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+            break;
+    }
+    memcpy(out, copy, sizeof(copy));
+}
+
+// Appends to "out" at "*at"; false once it no longer fits
+static bool put(char* out, size_t size, size_t* at, const char* format, ...)
+{
+    if (*at >= size)
+        return false;
+    va_list args;
+    va_start(args, format);
+    const int n = vsnprintf(out + *at, size - *at, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= size - *at)
+    {
+        *at = size;
+        return false;
+    }
+    *at += (size_t)n;
+    return true;
+}
+
+static void family(char* out, size_t size, size_t* at, const char* name, const char* type, const char* help)
+{
+    put(out, size, at, "# HELP opengltest_%s %s\n# TYPE opengltest_%s %s\n", name, help, name, type);
+}
+
+// A gauge in seconds from milliseconds, left out when not known
+static void gauge_ms(char* out, size_t size, size_t* at, const char* name, double ms, const char* help)
+{
+    if (ms < 0.0)
+        return;
+    family(out, size, at, name, "gauge", help);
+    put(out, size, at, "opengltest_%s %.9g\n", name, ms * 1e-3);
+}
+
+static void gauge_bytes(char* out, size_t size, size_t* at, const char* name, int64_t bytes, const char* help)
+{
+    if (bytes < 0)
+        return;
+    family(out, size, at, name, "gauge", help);
+    put(out, size, at, "opengltest_%s %lld\n", name, (long long)bytes);
+}
+
+size_t metrics_format(const MetricsSample* s, char* out, size_t size)
+{
+    size_t at = 0;
+    if (size)
+        out[0] = 0;
+    family(out, size, &at, "uptime_seconds", "gauge", "Seconds since the first frame.");
+    put(out, size, &at, "opengltest_uptime_seconds %.9g\n", s->uptime);
+    family(out, size, &at, "frames_total", "counter", "Frames presented.");
+    put(out, size, &at, "opengltest_frames_total %llu\n", (unsigned long long)s->frames);
+    family(out, size, &at, "frame_time_seconds", "summary",
+        "Swap-to-swap frame time; quantiles over the recent frames, sum and count over the run.");
+    const double quantiles[3][2] = { { 0.5, s->frame_p50_ms }, { 0.95, s->frame_p95_ms }, { 0.99, s->frame_p99_ms } };
+    for (int q = 0; q < 3; ++q)
+    {
+        if (quantiles[q][1] >= 0.0)
+            put(out, size, &at, "opengltest_frame_time_seconds{quantile=\"%g\"} %.9g\n", quantiles[q][0],
+                quantiles[q][1] * 1e-3);
+    }
+    put(out, size, &at, "opengltest_frame_time_seconds_sum %.9g\nopengltest_frame_time_seconds_count %llu\n",
+        s->frame_seconds_sum, (unsigned long long)s->frames);
+    gauge_ms(out, size, &at, "frame_time_max_seconds", s->frame_max_ms, "Longest of the recent frames.");
+    family(out, size, &at, "hitches_total", "counter", "Frames over the stutter threshold.");
+    put(out, size, &at, "opengltest_hitches_total %llu\n", (unsigned long long)s->hitches);
+    gauge_ms(out, size, &at, "gpu_frame_time_seconds", s->gpu_frame_ms, "GPU time of the latest profiled frame.");
+    gauge_bytes(out, size, &at, "gpu_memory_bytes", s->gpu_memory_bytes, "GPU memory in tracked resources.");
+    gauge_bytes(out, size, &at, "gpu_memory_budget_bytes", s->gpu_budget_bytes,
+        "Budget the tracked resources are kept under.");
+    gauge_bytes(out, size, &at, "gpu_memory_available_bytes", s->gpu_available_bytes,
+        "Free GPU memory as the driver reports it.");
+    gauge_bytes(out, size, &at, "heap_bytes", s->heap_bytes, "Live CPU heap allocations.");
+    if (s->mesh_queue >= 0 || s->texture_queue >= 0)
+    {
+        family(out, size, &at, "streaming_queue_depth", "gauge", "Streaming work waiting to be done.");
+        if (s->mesh_queue >= 0)
+            put(out, size, &at, "opengltest_streaming_queue_depth{queue=\"mesh\"} %lld\n", (long long)s->mesh_queue);
+        if (s->texture_queue >= 0)
+            put(out, size, &at, "opengltest_streaming_queue_depth{queue=\"texture\"} %lld\n",
+                (long long)s->texture_queue);
+    }
+    if (at >= size)
+    {
+        if (size)
+            out[0] = 0;
+        return 0;
+    }
+    return at;
+}
+
+static void set_non_blocking(socket_t s)
+{
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(s, FIONBIO, &on);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+// Waits up to "left" seconds for "s" to be readable (or writable)
+static void wait_socket(socket_t s, bool write, double left)
+{
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(s, &set);
+    timeval wait = { (long)left, (long)((left - (long)left) * 1e6) };
+    select((int)s + 1, write ? NULL : &set, write ? &set : NULL, NULL, &wait);
+}
+
+static bool send_all(socket_t s, const char* p, size_t size, double deadline)
+{
+    while (size > 0)
+    {
+        const int n = (int)send(s, p, (int)size, SEND_FLAGS);
+        if (n > 0)
+        {
+            p += n;
+            size -= (size_t)n;
+            continue;
+        }
+        const double left = deadline - now_seconds();
+        if (n == 0 || !WOULD_BLOCK() || left <= 0.0)
+            return false;
+        wait_socket(s, true, left);
+    }
+    return true;
+}
+
+// Reads the request line and headers, answers, and leaves closing to the caller
+static void serve(socket_t s)
+{
+    static char request[METRICS_REQUEST_BYTES + 1];
+    static char body[METRICS_RESPONSE_BYTES], header[256];
+    const double deadline = now_seconds() + METRICS_IO_TIMEOUT;
+    size_t size = 0;
+    request[0] = 0;
+    while (size < METRICS_REQUEST_BYTES && !strstr(request, "\r\n\r\n"))
+    {
+        const int n = (int)recv(s, request + size, (int)(METRICS_REQUEST_BYTES - size), 0);
+        if (n > 0)
+        {
+            size += (size_t)n;
+            request[size] = 0;
+            continue;
+        }
+        const double left = deadline - now_seconds();
+        if (n == 0 || !WOULD_BLOCK() || left <= 0.0)
+            break;
+        wait_socket(s, false, left);
+    }
+    // "GET /metrics" or "GET /", then the end of the path: a query is ignored
+    const char* path = strncmp(request, "GET ", 4) == 0 ? request + 4 : NULL;
+    const size_t path_size = path ? strcspn(path, " ?\r\n") : 0;
+    const bool found = path && ((path_size == 8 && strncmp(path, "/metrics", 8) == 0) || path_size == 1);
+    size_t body_size = 0;
+    if (found)
+    {
+        MetricsSample sample;
+        metrics_read(&sample);
+        body_size = metrics_format(&sample, body, sizeof(body));
+    }
+    else
+        body_size = (size_t)snprintf(body, sizeof(body), "not found\n");
+    const int header_size = snprintf(header, sizeof(header), "HTTP/1.1 %s\r\nContent-Type: %s\r\n"
+        "Content-Length: %zu\r\nConnection: close\r\n\r\n", found ? "200 OK" : "404 Not Found",
+        found ? "text/plain; version=0.0.4; charset=utf-8" : "text/plain", body_size);
+    if (send_all(s, header, (size_t)header_size, deadline))
+        send_all(s, body, body_size, deadline);
+}
+
+static void server_main()
+{
+    cpu_trace_thread_name("metrics");
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        wait_socket(listener, false, METRICS_POLL_SECONDS);
+        const socket_t s = accept(listener, NULL, NULL);
+        if (s == INVALID_SOCKET)
+            continue;
+        set_non_blocking(s);
+        serve(s);
+        close_socket(s);
+    }
+}
+
+bool metrics_server_start(int port)
+{
+    if (metrics_active())
+        return true;
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+        return false;
+#endif
+    listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    const int on = 1;
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t)port);
+    if (listener != INVALID_SOCKET)
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    if (listener == INVALID_SOCKET || bind(listener, (const sockaddr*)&address, sizeof(address)) != 0
+        || listen(listener, 8) != 0)
+    {
+        fprintf(stderr, "metrics_server: can't listen on port %d\n", port);
+        if (listener != INVALID_SOCKET)
+            close_socket(listener);
+        listener = INVALID_SOCKET;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+    set_non_blocking(listener);
+    MetricsSample cleared;
+    metrics_sample_clear(&cleared);
+    metrics_publish(&cleared);
+    stop.store(false);
+    server_thread = std::thread(server_main);
+    metrics_enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+int metrics_server_port(void)
+{
+    sockaddr_in address;
+    socklen_t size = sizeof(address);
+    if (!metrics_active() || getsockname(listener, (sockaddr*)&address, &size) != 0)
+        return 0;
+    return ntohs(address.sin_port);
+}
+
+void metrics_server_stop(void)
+{
+    if (!metrics_active())
+        return;
+    metrics_enabled.store(false, std::memory_order_relaxed);
+    stop.store(true);
+    server_thread.join();
+    close_socket(listener);
+    listener = INVALID_SOCKET;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Performance metrics for a fleet, over HTTP in Prometheus' text format
+// (--metrics PORT): frame-time percentiles, GPU frame time, GPU memory
+// against its budget, streaming queue depth and hitch counts, for a
+// scraper polling many instances.
+//
+// The render thread fills in a MetricsSample from the statistics it keeps
+// anyway (core/frame_stats.h, the GPU profiler, core/gpu_memory.h) and
+// publishes it every METRICS_PUBLISH_SECONDS; a scrape never asks the render
+// thread for anything. The published sample is a seqlock over relaxed atomic
+// words: the publisher bumps the sequence to odd, stores the words and bumps
+// it to even, never waiting; the server thread copies the words and keeps
+// the copy when the sequence was even and unchanged across it, trying again
+// otherwise. Publishing is a few dozen stores; until metrics_server_start it
+// costs one relaxed load.
+//
+// The server is one background thread: it accepts a connection, reads a
+// request, answers GET /metrics (or /) with the latest sample formatted by
+// metrics_format, and closes it. Anything else is a 404. A scraper that
+// doesn't send its request or read the answer within METRICS_IO_TIMEOUT is
+// dropped. One scrape at a time is plenty at Prometheus' intervals.
+
+#define METRICS_PUBLISH_SECONDS 0.25
+#define METRICS_IO_TIMEOUT 2.0              // seconds a scraper has to send its request, and to read the answer
+#define METRICS_REQUEST_BYTES 2048          // of a request's line and headers, the rest ignored
+#define METRICS_RESPONSE_BYTES 8192
+
+// A negative figure is one not known (no profiler, no driver query, no streamer): its metric is left out
+typedef struct MetricsSample
+{
+    double uptime;              // seconds since the first frame
+    uint64_t frames;            // frame times recorded
+    uint64_t hitches;           // of those, stutters (frame_stats.h's threshold)
+    double frame_seconds_sum;   // every frame's time, for the summary's _sum
+    double frame_p50_ms;        // over the last FRAME_STATS_WINDOW frames
+    double frame_p95_ms;
+    double frame_p99_ms;
+    double frame_max_ms;
+    double gpu_frame_ms;        // the profiler's "frame" scope, latest read back
+    int64_t gpu_memory_bytes;   // tracked by gl_memory
+    int64_t gpu_budget_bytes;   // its effective budget
+    int64_t gpu_available_bytes;    // free, as the driver reports it
+    int64_t heap_bytes;         // live CPU allocations (core/alloc_tracker.h)
+    int64_t mesh_queue;         // assets waiting to be read, unpacked or uploaded
+    int64_t texture_queue;      // texture levels staged and not uploaded yet
+} MetricsSample;
+
+static_assert(sizeof(MetricsSample) % sizeof(uint64_t) == 0, "published as whole words");
+
+extern std::atomic<bool> metrics_enabled;
+
+static inline bool metrics_active(void)
+{
+    return metrics_enabled.load(std::memory_order_relaxed);
+}
+
+// Every figure unknown
+void metrics_sample_clear(MetricsSample* sample);
+
+// Listens on "port" (0 for any free one) and starts the server thread, once per process. Returns false (logged)
+// when it can't listen.
+bool metrics_server_start(int port);
+// The port it listens on, 0 when it isn't
+int metrics_server_port(void);
+// Stops the thread and closes the socket
+void metrics_server_stop(void);
+
+// Makes "sample" the one scrapes see. One thread publishes; it never waits on a scrape.
+void metrics_publish(const MetricsSample* sample);
+
+// The latest published sample, whole; cleared before the first
+void metrics_read(MetricsSample* out);
+
+// "sample" in Prometheus' text exposition format (version 0.0.4), NUL-terminated in "out". Returns the length,
+// or 0 when it doesn't fit.
+size_t metrics_format(const MetricsSample* sample, char* out, size_t size);
@@ -0,0 +1,175 @@
+#include "core/numa_memory.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+
+#define NUMA_MPOL_PREFERRED 1           // <numaif.h>'s MPOL_PREFERRED, without libnuma's headers
+
+size_t numa_page_size(void)
+{
+    static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+void* numa_reserve(size_t size)
+{
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+// Mapped pages are committed on first touch already: only the placement is set
+static bool bind(void* p, size_t size, int node)
+{
+#ifdef SYS_mbind
+    if (node < 0 || node >= 64)
+        return false;
+    const unsigned long mask = 1ul << node;
+    return syscall(SYS_mbind, p, size, NUMA_MPOL_PREFERRED, &mask, (unsigned long)sizeof(mask) * 8 + 1, 0u) == 0;
+#else
+    (void)p;
+    (void)size;
+    (void)node;
+    return false;
+#endif
+}
+
+bool numa_commit(void* p, size_t size, int node)
+{
+    if (node >= 0)
+        bind(p, size, node);
+    return true;
+}
+
+void numa_release(void* p, size_t size)
+{
+    if (p)
+        munmap(p, size);
+}
+
+bool numa_prefer(void* p, size_t size, int node)
+{
+    const uintptr_t page = numa_page_size();
+    const uintptr_t begin = ((uintptr_t)p + page - 1) & ~(page - 1);
+    const uintptr_t end = ((uintptr_t)p + size) & ~(page - 1);
+    return node >= 0 && end > begin && bind((void*)begin, end - begin, node);
+}
+
+int numa_gpu_node(int gpu)
+{
+    int found = 0;
+    for (int card = 0; card < 64; ++card)
+    {
+        char path[96], line[16];
+        snprintf(path, sizeof(path), "/sys/class/drm/card%d/device/numa_node", card);
+        FILE* f = fopen(path, "r");
+        if (!f)
+            continue;
+        const bool read = fgets(line, sizeof(line), f) != NULL;
+        fclose(f);
+        if (found++ == gpu)
+            return read ? atoi(line) : -1;     // -1 already on a single-node machine
+    }
+    return -1;
+}
+
+#elif defined(_WIN32)
+
+size_t numa_page_size(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+}
+
+void* numa_reserve(size_t size)
+{
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_READWRITE);
+}
+
+bool numa_commit(void* p, size_t size, int node)
+{
+    if (node >= 0 && VirtualAllocExNuma(GetCurrentProcess(), p, size, MEM_COMMIT, PAGE_READWRITE, (DWORD)node))
+        return true;
+    return VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void numa_release(void* p, size_t size)
+{
+    (void)size;
+    if (p)
+        VirtualFree(p, 0, MEM_RELEASE);
+}
+
+bool numa_prefer(void* p, size_t size, int node)
+{
+    (void)p;
+    (void)size;
+    (void)node;
+    return false;
+}
+
+// The GPU's node would come from SetupAPI's DEVPKEY_Device_Numa_Node for its adapter, which isn't linked here
+int numa_gpu_node(int gpu)
+{
+    (void)gpu;
+    return -1;
+}
+
+#else
+
+size_t numa_page_size(void)
+{
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+void* numa_reserve(size_t size)
+{
+    void* p = NULL;
+    return posix_memalign(&p, numa_page_size(), size) == 0 ? p : NULL;
+}
+
+bool numa_commit(void* p, size_t size, int node)
+{
+    (void)p;
+    (void)size;
+    (void)node;
+    return true;
+}
+
+void numa_release(void* p, size_t size)
+{
+    (void)size;
+    free(p);
+}
+
+bool numa_prefer(void* p, size_t size, int node)
+{
+    (void)p;
+    (void)size;
+    (void)node;
+    return false;
+}
+
+int numa_gpu_node(int gpu)
+{
+    (void)gpu;
+    return -1;
+}
+
+#endif
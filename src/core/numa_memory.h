@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+
+// Memory placed on a NUMA node, for multi-socket machines: a frame's data
+// belongs on the node of the threads that write and read it, and what's
+// uploaded to the GPU on the node its PCIe root is on.
+//
+// Placement is a preference, made before the pages are first touched: Linux
+// sets it with mbind(MPOL_PREFERRED), called through syscall() so libnuma
+// isn't needed; Windows commits reserved pages with VirtualAllocExNuma. A
+// node without free memory falls back to the others. Elsewhere pages go
+// wherever the OS puts them.
+//
+// Regions to be placed apart are reserved together (numa_reserve) and
+// committed a range at a time, each range a whole number of pages
+// (numa_page_size). Heap memory that can't be reserved this way, like a
+// buffer handed on to be freed by someone else, gets numa_prefer, which
+// places its whole pages on Linux only.
+
+// The granularity of placement
+size_t numa_page_size(void);
+
+// "size" bytes (a multiple of numa_page_size()) of address space, page aligned. NULL when there's none. Nothing is
+// usable until it's committed.
+void* numa_reserve(size_t size);
+
+// Makes a page-aligned range of reserved memory usable, its pages on node "node" when first touched (-1: wherever
+// the touching thread is). False when it can't be committed; a placement that can't be made still commits.
+bool numa_commit(void* p, size_t size, int node);
+
+// Releases all of what numa_reserve returned
+void numa_release(void* p, size_t size);
+
+// The whole pages inside heap memory that hasn't been touched yet go on node "node". Linux only: false elsewhere.
+bool numa_prefer(void* p, size_t size, int node);
+
+// The NUMA node of GPU "gpu" (Linux: DRM card "gpu" in PCI order, from its device's numa_node), -1 when unknown
+// or the machine has one node
+int numa_gpu_node(int gpu);
@@ -0,0 +1,85 @@
+#include "core/perf_stats.h"
+
+#include <math.h>
+
+// Two-sided quantiles of Student's t: 95% and 99%, for 1 to 30 degrees of freedom, then 40, 60, 120 and infinity
+static const double t_dof[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+    25, 26, 27, 28, 29, 30, 40, 60, 120, INFINITY };
+static const double t_95[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179,
+    2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048,
+    2.045, 2.042, 2.021, 2.000, 1.980, 1.960 };
+static const double t_99[] = { 63.657, 9.925, 5.841, 4.604, 4.032, 3.707, 3.499, 3.355, 3.250, 3.169, 3.106, 3.055,
+    3.012, 2.977, 2.947, 2.921, 2.898, 2.878, 2.861, 2.845, 2.831, 2.819, 2.807, 2.797, 2.787, 2.779, 2.771, 2.763,
+    2.756, 2.750, 2.704, 2.660, 2.617, 2.576 };
+
+void perf_summarise(PerfSummary* s, const double* samples, uint32_t n)
+{
+    s->n = n;
+    s->mean = 0.0;
+    s->stddev = 0.0;
+    if (!n)
+        return;
+    for (uint32_t i = 0; i < n; ++i)
+        s->mean += samples[i];
+    s->mean /= n;
+    if (n < 2)
+        return;
+    double squares = 0.0;
+    for (uint32_t i = 0; i < n; ++i)
+        squares += (samples[i] - s->mean) * (samples[i] - s->mean);
+    s->stddev = sqrt(squares / (n - 1));
+}
+
+double perf_t_critical(double confidence, double dof)
+{
+    const double* table = confidence >= 0.97 ? t_99 : t_95;
+    const int count = (int)(sizeof(t_dof) / sizeof(t_dof[0]));
+    int i = 0;
+    while (i + 1 < count && t_dof[i + 1] <= dof)
+        ++i;
+    return table[i];
+}
+
+double perf_interval(const PerfSummary* s, double confidence)
+{
+    return s->n < 2 ? 0.0 : perf_t_critical(confidence, s->n - 1) * s->stddev / sqrt((double)s->n);
+}
+
+void perf_compare(const PerfSummary* baseline, const PerfSummary* current, double confidence, double threshold,
+    PerfComparison* out)
+{
+    out->verdict = PERF_SAME;
+    out->change = baseline->mean > 0.0 ? (current->mean - baseline->mean) / baseline->mean : 0.0;
+    out->t = 0.0;
+    out->dof = 0.0;
+    out->critical = 0.0;
+    if (!baseline->n || !current->n)
+        return;
+
+    const double vb = baseline->n > 1 ? baseline->stddev * baseline->stddev / baseline->n : 0.0;
+    const double vc = current->n > 1 ? current->stddev * current->stddev / current->n : 0.0;
+    const double difference = current->mean - baseline->mean;
+    bool significant;
+    if (vb + vc <= 0.0)
+    {
+        // No spread on either side (single runs, or a timer's resolution): the threshold alone decides
+        out->t = difference > 0.0 ? INFINITY : difference < 0.0 ? -INFINITY : 0.0;
+        significant = difference != 0.0;
+    }
+    else
+    {
+        out->t = difference / sqrt(vb + vc);
+        const double db = baseline->n > 1 ? vb * vb / (baseline->n - 1) : 0.0;
+        const double dc = current->n > 1 ? vc * vc / (current->n - 1) : 0.0;
+        out->dof = (vb + vc) * (vb + vc) / (db + dc);
+        out->critical = perf_t_critical(confidence, out->dof);
+        significant = fabs(out->t) > out->critical;
+    }
+    if (significant && fabs(out->change) > threshold)
+        out->verdict = difference > 0.0 ? PERF_REGRESSED : PERF_IMPROVED;
+}
+
+const char* perf_verdict_name(PerfVerdict verdict)
+{
+    return verdict == PERF_REGRESSED ? "regressed" : verdict == PERF_IMPROVED ? "improved" : "same";
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+// Statistics for the performance regression harness (tools/perf_harness.cpp):
+// a measurement repeated over several runs, summarised, and compared against
+// the same measurement's baseline.
+//
+// A summary keeps the count, mean and sample standard deviation, which is all
+// a baseline file needs to hold for a later comparison. Confidence intervals
+// use Student's t, since a harness run repeats each benchmark a handful of
+// times, not hundreds. A comparison is Welch's t-test (the two sides may have
+// different variances and counts), and a change only counts when it is both
+// significant and bigger than a threshold: with hundreds of metrics compared
+// at once, a tiny but "significant" shift would be flagged on every run.
+// Every metric is a time, so higher is worse.
+
+typedef struct PerfSummary
+{
+    uint32_t n;
+    double mean;
+    double stddev;              // the sample standard deviation (n - 1); 0 for fewer than 2 samples
+} PerfSummary;
+
+typedef enum PerfVerdict
+{
+    PERF_SAME,                  // no significant change over the threshold
+    PERF_REGRESSED,
+    PERF_IMPROVED
+} PerfVerdict;
+
+typedef struct PerfComparison
+{
+    PerfVerdict verdict;
+    double change;              // (current - baseline) / baseline mean
+    double t;                   // Welch's statistic, positive when the current runs are slower
+    double dof;                 // its degrees of freedom
+    double critical;            // the |t| that was needed
+} PerfComparison;
+
+void perf_summarise(PerfSummary* s, const double* samples, uint32_t n);
+
+// The two-sided Student's t quantile for "confidence" (0.95 or 0.99; others round to the nearer) at "dof" degrees
+// of freedom, rounded down to the table's, so it errs wide
+double perf_t_critical(double confidence, double dof);
+
+// Half the width of the mean's confidence interval; 0 for fewer than 2 samples
+double perf_interval(const PerfSummary* s, double confidence);
+
+// "current" against "baseline": regressed or improved when Welch's test is significant at "confidence" and the
+// means differ by more than "threshold" of the baseline's
+void perf_compare(const PerfSummary* baseline, const PerfSummary* current, double confidence, double threshold,
+    PerfComparison* out);
+
+const char* perf_verdict_name(PerfVerdict verdict);
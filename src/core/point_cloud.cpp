@@ -0,0 +1,177 @@
+#include "core/point_cloud.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct PointCloudGrid
+{
+    float origin[2];
+    float scale[2];                 // cells per world unit
+    int cells[2];
+} PointCloudGrid;
+
+// Both passes place a point with this, so they agree on its cell
+static inline int cell_axis(const PointCloudGrid* g, int axis, float v)
+{
+    const int c = (int)((v - g->origin[axis]) * g->scale[axis]);
+    return c < 0 ? 0 : c >= g->cells[axis] ? g->cells[axis] - 1 : c;
+}
+
+static inline uint16_t quantise(float v, float origin, float size)
+{
+    const float t = (v - origin) / size * 65535.f + 0.5f;
+    return (uint16_t)(t <= 0.f ? 0 : t >= 65535.f ? 65535 : (int)t);
+}
+
+static inline uint64_t splitmix(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+bool point_cloud_build(PointCloud* cloud, PointCloudSource source, void* user, size_t count, const float bounds[4])
+{
+    memset(cloud, 0, sizeof(*cloud));
+    if (!count || count > 0xFFFFFFFFu || !(bounds[2] > bounds[0]) || !(bounds[3] > bounds[1]))
+        return false;
+
+    // Square-ish cells, as many as the points fill to about POINT_CLOUD_TILE_POINTS
+    const float width = bounds[2] - bounds[0], height = bounds[3] - bounds[1];
+    const double cells = (double)count / POINT_CLOUD_TILE_POINTS;
+    PointCloudGrid g;
+    g.cells[0] = (int)ceil(sqrt(cells * width / height));
+    g.cells[0] = g.cells[0] < 1 ? 1 : g.cells[0] > 4096 ? 4096 : g.cells[0];
+    g.cells[1] = (int)ceil(cells / g.cells[0]);
+    g.cells[1] = g.cells[1] < 1 ? 1 : g.cells[1] > 4096 ? 4096 : g.cells[1];
+    g.origin[0] = bounds[0];
+    g.origin[1] = bounds[1];
+    g.scale[0] = g.cells[0] / width;
+    g.scale[1] = g.cells[1] / height;
+    const int cell_count = g.cells[0] * g.cells[1];
+
+    uint32_t* offsets = (uint32_t*)calloc((size_t)cell_count + 1, sizeof(uint32_t));
+    float* cell_bounds = (float*)malloc(sizeof(float) * 4 * cell_count);
+    float* x = (float*)malloc(sizeof(float) * POINT_CLOUD_CHUNK);
+    float* y = (float*)malloc(sizeof(float) * POINT_CLOUD_CHUNK);
+    uint32_t* color = (uint32_t*)malloc(sizeof(uint32_t) * POINT_CLOUD_CHUNK);
+    cloud->records = (PointRecord*)malloc(sizeof(PointRecord) * count);
+    if (!offsets || !cell_bounds || !x || !y || !color || !cloud->records)
+    {
+        free(offsets);
+        free(cell_bounds);
+        free(x);
+        free(y);
+        free(color);
+        point_cloud_destroy(cloud);
+        return false;
+    }
+
+    // Counting: each cell's size, then its first record
+    for (size_t first = 0; first < count; first += POINT_CLOUD_CHUNK)
+    {
+        const size_t n = count - first < POINT_CLOUD_CHUNK ? count - first : POINT_CLOUD_CHUNK;
+        source(user, first, n, x, y, color);
+        for (size_t i = 0; i < n; ++i)
+            ++offsets[cell_axis(&g, 1, y[i]) * g.cells[0] + cell_axis(&g, 0, x[i]) + 1];
+    }
+    for (int c = 0; c < cell_count; ++c)
+    {
+        offsets[c + 1] += offsets[c];
+        cell_bounds[4 * c] = cell_bounds[4 * c + 1] = INFINITY;
+        cell_bounds[4 * c + 2] = cell_bounds[4 * c + 3] = -INFINITY;
+    }
+
+    // Placing: quantised across the cell, the cell's bounds grown to fit
+    const float cell_size[2] = { width / g.cells[0], height / g.cells[1] };
+    for (size_t first = 0; first < count; first += POINT_CLOUD_CHUNK)
+    {
+        const size_t n = count - first < POINT_CLOUD_CHUNK ? count - first : POINT_CLOUD_CHUNK;
+        source(user, first, n, x, y, color);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const float px = x[i] < bounds[0] ? bounds[0] : x[i] > bounds[2] ? bounds[2] : x[i];
+            const float py = y[i] < bounds[1] ? bounds[1] : y[i] > bounds[3] ? bounds[3] : y[i];
+            const int cx = cell_axis(&g, 0, px), cy = cell_axis(&g, 1, py);
+            const int c = cy * g.cells[0] + cx;
+            PointRecord* r = &cloud->records[offsets[c]++];
+            r->pos[0] = quantise(px, bounds[0] + cx * cell_size[0], cell_size[0]);
+            r->pos[1] = quantise(py, bounds[1] + cy * cell_size[1], cell_size[1]);
+            r->color = color[i];
+            float* b = cell_bounds + 4 * c;
+            b[0] = px < b[0] ? px : b[0];
+            b[1] = py < b[1] ? py : b[1];
+            b[2] = px > b[2] ? px : b[2];
+            b[3] = py > b[3] ? py : b[3];
+        }
+    }
+    free(x);
+    free(y);
+    free(color);
+
+    // The filled cells become tiles; each offset has moved on to the next cell's first record
+    int filled = 0;
+    for (int c = 0; c < cell_count; ++c)
+        filled += offsets[c] > (c ? offsets[c - 1] : 0);
+    cloud->tiles = (PointCloudTile*)malloc(sizeof(PointCloudTile) * (filled ? filled : 1));
+    if (!cloud->tiles)
+    {
+        free(offsets);
+        free(cell_bounds);
+        point_cloud_destroy(cloud);
+        return false;
+    }
+    for (int c = 0; c < cell_count; ++c)
+    {
+        const uint32_t begin = c ? offsets[c - 1] : 0;
+        if (offsets[c] == begin)
+            continue;
+        PointCloudTile* t = &cloud->tiles[cloud->tile_count++];
+        t->origin[0] = bounds[0] + (c % g.cells[0]) * cell_size[0];
+        t->origin[1] = bounds[1] + (c / g.cells[0]) * cell_size[1];
+        t->size[0] = cell_size[0];
+        t->size[1] = cell_size[1];
+        memcpy(t->bounds, cell_bounds + 4 * c, sizeof(t->bounds));
+        t->first = begin;
+        t->count = offsets[c] - begin;
+
+        // Fisher-Yates, seeded by the cell: the same cloud comes out of the same points
+        uint64_t state = (uint64_t)c * 0x2545F4914F6CDD1Dull + 1;
+        PointRecord* r = cloud->records + t->first;
+        for (uint32_t i = t->count - 1; i > 0; --i)
+        {
+            const uint32_t j = (uint32_t)(splitmix(&state) % (i + 1));
+            const PointRecord swap = r[i];
+            r[i] = r[j];
+            r[j] = swap;
+        }
+    }
+    free(offsets);
+    free(cell_bounds);
+    cloud->point_count = (uint32_t)count;
+    cloud->grid[0] = g.cells[0];
+    cloud->grid[1] = g.cells[1];
+    memcpy(cloud->bounds, bounds, sizeof(cloud->bounds));
+    return true;
+}
+
+void point_cloud_destroy(PointCloud* cloud)
+{
+    free(cloud->records);
+    free(cloud->tiles);
+    memset(cloud, 0, sizeof(*cloud));
+}
+
+uint32_t point_cloud_target(const PointCloudTile* tile, const float view[4], int width, int height, float density)
+{
+    const float* b = tile->bounds;
+    if (b[2] < view[0] || b[0] > view[2] || b[3] < view[1] || b[1] > view[3])
+        return 0;
+    // A pixel more each way: a tile whose points lie on a line still covers the pixels along it
+    const float w = (b[2] - b[0]) / (view[2] - view[0]) * width + 1.f;
+    const float h = (b[3] - b[1]) / (view[3] - view[1]) * height + 1.f;
+    const float target = density * w * h;
+    return target >= (float)tile->count ? tile->count : target < 1.f ? 1u : (uint32_t)target;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Point clouds too large to draw whole every frame: scatter plots of
+// telemetry in the grid's plane with millions to hundreds of millions of points.
+//
+// The points are binned into a grid of tiles, about POINT_CLOUD_TILE_POINTS
+// each, and stored tile by tile. A point is 8 bytes: its position as two
+// UNORM16s across its tile's cell and an RGBA8 colour, against 20 for the
+// scene's Vertex. The tile keeps the cell's origin and size, to expand the
+// position, and the tight bounds of what's in it, to cull and size it.
+//
+// Within a tile the points are shuffled, so any prefix of its range is a
+// uniform sample of the whole tile. Drawing fewer points is then drawing a
+// shorter prefix, and refining is drawing the next slice after it: nothing is
+// stored twice and there's no level hierarchy to build. point_cloud_target
+// is the decimation: a tile gets at most "density" points per pixel it
+// covers, so zoomed out the cost follows the screen, not the data.
+// gl/point_cloud_renderer.h does the same on the GPU every frame, from the
+// same tile table.
+//
+// Building takes two passes over the points (counting, then placing), so
+// the source is a callback filling chunks on demand and the input never has
+// to exist as a whole. It must give the same points both times.
+
+#define POINT_CLOUD_TILE_POINTS 65536       // points per tile aimed for, on average
+#define POINT_CLOUD_CHUNK 65536             // points asked of the source at once
+
+typedef struct PointRecord
+{
+    uint16_t pos[2];                // across the tile's cell, 0 to 65535
+    uint32_t color;                 // RGBA8, red in the low byte
+} PointRecord;
+
+typedef struct PointCloudTile
+{
+    float origin[2];                // the cell's lower corner
+    float size[2];                  // and extent: position = origin + pos / 65535 * size
+    float bounds[4];                // the points' min x, min y, max x, max y
+    uint32_t first;                 // into the records
+    uint32_t count;
+} PointCloudTile;
+
+typedef struct PointCloud
+{
+    PointRecord* records;           // [point_count], tile by tile
+    PointCloudTile* tiles;          // [tile_count], empty cells left out
+    uint32_t point_count;
+    uint32_t tile_count;
+    int grid[2];                    // cells across and up
+    float bounds[4];                // the domain the grid covers: min x, min y, max x, max y
+} PointCloud;
+
+// Fills x, y and color for points first to first + count - 1
+typedef void (*PointCloudSource)(void* user, size_t first, size_t count, float* x, float* y, uint32_t* color);
+
+// Bins "count" points from "source" over "bounds" (min x, min y, max x, max y; points outside are clamped to it).
+// Returns false, with the cloud empty, if the memory isn't there or the count doesn't fit 32 bits.
+bool point_cloud_build(PointCloud* cloud, PointCloudSource source, void* user, size_t count, const float bounds[4]);
+void point_cloud_destroy(PointCloud* cloud);
+
+// The points "tile" draws for a view of the world rectangle "view" (min x, min y, max x, max y) over
+// "width" x "height" pixels: none outside it, otherwise at most "density" per pixel of the tile's bounds, and at
+// least one
+uint32_t point_cloud_target(const PointCloudTile* tile, const float view[4], int width, int height, float density);
@@ -0,0 +1,139 @@
+#include "core/power_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <dirent.h>
+#endif
+
+#if defined(__linux__)
+
+// The first line of a small sysfs file, without its newline. False when it can't be read.
+static bool read_line(const char* path, char* line, int size)
+{
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return false;
+    const bool read = fgets(line, size, f) != NULL;
+    fclose(f);
+    if (read)
+        line[strcspn(line, "\n")] = '\0';
+    return read;
+}
+
+static void add_sensor(PowerState* p, const char* path)
+{
+    char line[32];
+    if (p->sensors < POWER_STATE_MAX_SENSORS && read_line(path, line, sizeof(line)))
+        snprintf(p->paths[p->sensors++], sizeof(p->paths[0]), "%s", path);
+}
+
+// Every entry of "dir" starting with "prefix", as "dir/entry/suffix", handed to "found"
+static void each_entry(const char* dir, const char* prefix, const char* suffix, PowerState* p,
+    void (*found)(PowerState*, const char*))
+{
+    DIR* d = opendir(dir);
+    if (!d)
+        return;
+    for (const struct dirent* e; (e = readdir(d)) != NULL;)
+    {
+        if (strncmp(e->d_name, prefix, strlen(prefix)) != 0)
+            continue;
+        char path[96];
+        if (snprintf(path, sizeof(path), "%s/%s/%s", dir, e->d_name, suffix) < (int)sizeof(path))
+            found(p, path);
+    }
+    closedir(d);
+}
+
+// A DRM card's hwmon directory, whichever number it has
+static void add_card(PowerState* p, const char* hwmon)
+{
+    each_entry(hwmon, "hwmon", "temp1_input", p, add_sensor);
+}
+
+static void add_supply(PowerState* p, const char* type)
+{
+    char line[32];
+    if (p->mains[0] || !read_line(type, line, sizeof(line)) || strcmp(line, "Mains") != 0)
+        return;
+    snprintf(p->mains, sizeof(p->mains), "%.*sonline", (int)(strlen(type) - strlen("type")), type);
+}
+
+bool power_state_init(PowerState* p)
+{
+    memset(p, 0, sizeof(*p));
+    each_entry("/sys/class/thermal", "thermal_zone", "temp", p, add_sensor);
+    each_entry("/sys/class/drm", "card", "device/hwmon", p, add_card);
+    each_entry("/sys/class/power_supply", "", "type", p, add_supply);
+    power_state_sample(p);
+    return p->sensors > 0 || p->mains[0];
+}
+
+void power_state_sample(PowerState* p)
+{
+    // Millidegrees, the hottest counting
+    p->temperature = -1.f;
+    char line[32];
+    for (int i = 0; i < p->sensors; ++i)
+    {
+        if (!read_line(p->paths[i], line, sizeof(line)))
+            continue;
+        const float c = (float)atol(line) / 1000.f;
+        p->temperature = c > p->temperature ? c : p->temperature;
+    }
+    p->on_battery = p->mains[0] && read_line(p->mains, line, sizeof(line)) && line[0] == '0';
+}
+
+#elif defined(_WIN32)
+
+bool power_state_init(PowerState* p)
+{
+    memset(p, 0, sizeof(*p));
+    SYSTEM_POWER_STATUS status;
+    if (!GetSystemPowerStatus(&status) || status.ACLineStatus == 255)
+        return false;
+    snprintf(p->mains, sizeof(p->mains), "GetSystemPowerStatus");
+    power_state_sample(p);
+    return true;
+}
+
+void power_state_sample(PowerState* p)
+{
+    p->temperature = -1.f;
+    SYSTEM_POWER_STATUS status;
+    if (!GetSystemPowerStatus(&status))
+        return;
+    p->on_battery = status.ACLineStatus == 0;
+    p->power_saving = status.SystemStatusFlag == 1;
+}
+
+#else
+
+bool power_state_init(PowerState* p)
+{
+    memset(p, 0, sizeof(*p));
+    p->temperature = -1.f;
+    return false;
+}
+
+void power_state_sample(PowerState* p)
+{
+    (void)p;
+}
+
+#endif
+
+void power_state_print(const PowerState* p, FILE* out)
+{
+    fprintf(out, "power state: %d temperature sensor%s", p->sensors, p->sensors == 1 ? "" : "s");
+    if (p->temperature >= 0.f)
+        fprintf(out, " (hottest %.0f C)", p->temperature);
+    fprintf(out, ", %s\n", !p->mains[0] ? "no power source reported" : p->on_battery
+        ? (p->power_saving ? "on battery, saving power" : "on battery") : "on mains");
+}
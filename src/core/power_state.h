@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdio.h>
+
+// The platform's thermal and power state, for the quality governor
+// (core/quality_governor.h): how hot the hottest sensor is, and whether the
+// machine runs from a battery or has asked for power saving.
+//
+// Linux: the sysfs thermal zones (CPU packages, SoCs) and hwmon's temp1_input
+// under each DRM card (the GPU), found once at init and read on each sample;
+// a power_supply of type Mains that's offline means the battery. Windows has
+// no temperature for a user process: GetSystemPowerStatus gives the AC line
+// and the battery saver alone. Elsewhere nothing is known.
+
+#define POWER_STATE_MAX_SENSORS 32
+
+typedef struct PowerState
+{
+    int sensors;                    // temperature files found at init
+    char paths[POWER_STATE_MAX_SENSORS][96];
+    char mains[96];                 // where the power source is read (Linux: the Mains supply's "online"), empty for nowhere
+    float temperature;              // the hottest sensor's degrees C at the last sample; negative without sensors
+    bool on_battery;
+    bool power_saving;              // the OS's battery saver is on
+} PowerState;
+
+// Finds the sensors and takes the first sample. False when the platform reports nothing at all.
+bool power_state_init(PowerState* p);
+
+// Samples every sensor and the power source again. A handful of small reads: about once a second, not every frame.
+void power_state_sample(PowerState* p);
+
+// The sensors found, one line
+void power_state_print(const PowerState* p, FILE* out);
@@ -0,0 +1,176 @@
+#include "core/quality_governor.h"
+
+#include <string.h>
+
+const QualityTier quality_tiers[QUALITY_TIERS] = {
+    { 1.f, 0, 1.f, 1.f },
+    { 0.85f, 0, 0.75f, 1.5f },
+    { 0.75f, 1, 0.5f, 2.f },
+    { 0.65f, 2, 0.35f, 3.f },
+    { 0.5f, 3, 0.2f, 4.f },
+};
+
+static const char* reason_names[QUALITY_REASON_COUNT] = { "frame time", "heat", "power" };
+
+void quality_governor_init(QualityGovernor* g, double budget_ms, double now)
+{
+    g->budget_ms = budget_ms;
+    g->tier.store(0, std::memory_order_relaxed);
+    g->power_known = power_state_init(&g->power);
+    g->second_start = now;
+    g->gpu_sum = g->cpu_sum = 0.0;
+    g->gpu_frames = g->cpu_frames = 0;
+    g->frame_samples = g->temperature_samples = 0;
+    g->changed = g->clear_since = g->start = now;
+    g->up_hold = QUALITY_UP_HOLD_SECONDS;
+    g->last_up = -1.0;
+    for (int i = 0; i < QUALITY_TIERS; ++i)
+        g->tier_seconds[i] = 0.0;
+    memset(g->steps_down, 0, sizeof(g->steps_down));
+    g->steps_up = g->taken_back = 0;
+    g->hottest = g->power.temperature;
+}
+
+// The least-squares line through the last "count" samples of "ring" (oldest first), run "ahead" samples past the
+// newest. Never under the newest itself: a falling trend isn't counted on.
+static double project(const double* ring, int count, double ahead)
+{
+    const int n = count < QUALITY_HISTORY ? count : QUALITY_HISTORY;
+    const double newest = ring[(count - 1) % QUALITY_HISTORY];
+    if (n < 3)
+        return newest;
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        const double y = ring[(count - n + i) % QUALITY_HISTORY];
+        sx += i;
+        sy += y;
+        sxx += (double)i * i;
+        sxy += i * y;
+    }
+    const double slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    const double line = (sy - slope * sx) / n + slope * (n - 1 + ahead);
+    return line > newest ? line : newest;
+}
+
+static int power_floor(const QualityGovernor* g)
+{
+    return g->power.power_saving ? 2 : g->power.on_battery ? 1 : 0;
+}
+
+static void change_tier(QualityGovernor* g, int tier, double now)
+{
+    g->tier.store(tier, std::memory_order_relaxed);
+    g->changed = g->clear_since = now;
+    g->frame_samples = 0;       // the old tier's frame times say nothing about the new one's
+}
+
+// A second's samples in: a step, if the trends call for one
+static bool quality_governor_second(QualityGovernor* g, double now)
+{
+    if (g->gpu_frames || g->cpu_frames)
+    {
+        const double gpu = g->gpu_frames ? g->gpu_sum / g->gpu_frames : 0.0;
+        const double cpu = g->cpu_frames ? g->cpu_sum / g->cpu_frames : 0.0;
+        g->frame_ms[g->frame_samples++ % QUALITY_HISTORY] = gpu > cpu ? gpu : cpu;
+        if (g->frame_samples == 2 * QUALITY_HISTORY)
+            g->frame_samples = QUALITY_HISTORY;     // the ring's order is kept, the count kept small
+    }
+    if (g->power_known)
+    {
+        power_state_sample(&g->power);
+        if (g->power.temperature >= 0.f)
+        {
+            g->temperature[g->temperature_samples++ % QUALITY_HISTORY] = g->power.temperature;
+            if (g->temperature_samples == 2 * QUALITY_HISTORY)
+                g->temperature_samples = QUALITY_HISTORY;
+            g->hottest = g->power.temperature > g->hottest ? g->power.temperature : g->hottest;
+        }
+    }
+
+    const double frame = g->frame_samples ? project(g->frame_ms, g->frame_samples, QUALITY_LOOKAHEAD_SECONDS) : 0.0;
+    const double heat = g->temperature_samples
+        ? project(g->temperature, g->temperature_samples, QUALITY_LOOKAHEAD_SECONDS) : -1.0;
+    const int tier = g->tier.load(std::memory_order_relaxed);
+
+    int reason = -1;
+    if (tier < power_floor(g))
+        reason = QUALITY_POWER;
+    else if (heat > QUALITY_THERMAL_LIMIT)
+        reason = QUALITY_HEAT;
+    else if (frame > g->budget_ms)
+        reason = QUALITY_FRAME_TIME;
+    if (reason >= 0)
+    {
+        g->clear_since = now;
+        if (tier + 1 >= QUALITY_TIERS || now - g->changed < QUALITY_DOWN_HOLD_SECONDS)
+            return false;
+        if (g->last_up >= 0.0 && now - g->last_up < g->up_hold)
+        {
+            // The step up didn't hold: the next one waits longer
+            ++g->taken_back;
+            g->up_hold = 2.0 * g->up_hold < QUALITY_UP_HOLD_MAX_SECONDS ? 2.0 * g->up_hold : QUALITY_UP_HOLD_MAX_SECONDS;
+        }
+        ++g->steps_down[reason];
+        change_tier(g, tier + 1, now);
+        return true;
+    }
+
+    const bool headroom = g->frame_samples > 0 && frame < QUALITY_RESTORE_FRACTION * g->budget_ms
+        && heat < QUALITY_THERMAL_LIMIT - QUALITY_THERMAL_RESTORE && tier > power_floor(g);
+    if (!headroom)
+    {
+        g->clear_since = now;
+        return false;
+    }
+    if (now - g->clear_since < g->up_hold)
+        return false;
+    ++g->steps_up;
+    g->last_up = now;
+    change_tier(g, tier - 1, now);
+    return true;
+}
+
+bool quality_governor_frame(QualityGovernor* g, double now, double gpu_ms, double cpu_ms)
+{
+    if (gpu_ms > 0.0)
+    {
+        g->gpu_sum += gpu_ms;
+        ++g->gpu_frames;
+    }
+    if (cpu_ms > 0.0)
+    {
+        g->cpu_sum += cpu_ms;
+        ++g->cpu_frames;
+    }
+    if (now - g->second_start < 1.0)
+        return false;
+    g->tier_seconds[g->tier.load(std::memory_order_relaxed)] += now - g->second_start;
+    const bool changed = quality_governor_second(g, now);
+    g->second_start = now;
+    g->gpu_sum = g->cpu_sum = 0.0;
+    g->gpu_frames = g->cpu_frames = 0;
+    return changed;
+}
+
+const QualityTier* quality_governor_tier(const QualityGovernor* g)
+{
+    return &quality_tiers[g->tier.load(std::memory_order_relaxed)];
+}
+
+void quality_governor_print(const QualityGovernor* g, double now, FILE* out)
+{
+    const double seconds = now - g->start;
+    fprintf(out, "governor: %.1f ms budget, tier %d now; time at tiers 0-%d:", g->budget_ms,
+        g->tier.load(std::memory_order_relaxed), QUALITY_TIERS - 1);
+    for (int i = 0; i < QUALITY_TIERS; ++i)
+        fprintf(out, " %.0f%%", seconds > 0.0 ? 100.0 * g->tier_seconds[i] / seconds : 0.0);
+    fprintf(out, "\n  stepped down for");
+    for (int i = 0; i < QUALITY_REASON_COUNT; ++i)
+        fprintf(out, " %s %u%s", reason_names[i], g->steps_down[i], i + 1 < QUALITY_REASON_COUNT ? "," : "");
+    fprintf(out, "; up %u (%u taken back soon after)", g->steps_up, g->taken_back);
+    if (g->hottest >= 0.f)
+        fprintf(out, "; hottest %.0f C", g->hottest);
+    fprintf(out, "\n  ");
+    power_state_print(&g->power, out);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "core/power_state.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+
+// The quality governor (--governor MS): steps the renderer's quality down
+// before a sustained load makes the hardware throttle, and back up once
+// there's room again. Throttling costs more than the quality it saves: the
+// clocks drop for every frame, not just the heavy ones, and for seconds at a
+// time. Dropping a tier a little early keeps them up.
+//
+// Fed every frame with the GPU's time for it (the profiler's, a few frames
+// late) and the render thread's CPU time, and sampling the platform's power
+// state (core/power_state.h) once a second. Each second's frame time (the
+// slower of the two) and the hottest temperature go into a short history;
+// a least-squares line through it, run QUALITY_LOOKAHEAD_SECONDS ahead, is
+// what's compared against the limits, so a frame time or a temperature that
+// is climbing is acted on before it gets there. Running from a battery holds
+// the tier at 1 or under, and the OS's battery saver at 2.
+//
+// Steps are one tier at a time, QUALITY_DOWN_HOLD_SECONDS apart so each
+// step's effect shows before the next. A step up waits for a long spell with
+// plenty of headroom (the hysteresis): QUALITY_UP_HOLD_SECONDS, doubled each
+// time a step up has to be taken back soon after.
+
+#define QUALITY_TIERS 5
+#define QUALITY_HISTORY 8                   // one-second samples the trends are fitted to
+#define QUALITY_LOOKAHEAD_SECONDS 4.0       // how far ahead the trends are run
+#define QUALITY_DOWN_HOLD_SECONDS 2.0
+#define QUALITY_UP_HOLD_SECONDS 10.0
+#define QUALITY_UP_HOLD_MAX_SECONDS 160.0
+#define QUALITY_RESTORE_FRACTION 0.75       // of the budget: the headroom a step up needs
+#define QUALITY_THERMAL_LIMIT 85.f          // degrees C the trend is kept under; most parts throttle in the 90s
+#define QUALITY_THERMAL_RESTORE 10.f        // degrees under the limit before a step up
+
+// A tier's settings, as fractions of what the renderer was asked for
+typedef struct QualityTier
+{
+    float resolution_scale;     // of the window's size, each way
+    int cascades_dropped;       // --shadows: cascades left out, at least one kept
+    float particle_rate;        // --particles: of the emission rate
+    float lod_error_scale;      // --lod-error: the error allowed, times this
+} QualityTier;
+
+extern const QualityTier quality_tiers[QUALITY_TIERS];  // 0 is full quality
+
+typedef enum QualityReason
+{
+    QUALITY_FRAME_TIME,         // the frame time's trend runs past the budget
+    QUALITY_HEAT,               // the temperature's trend runs past QUALITY_THERMAL_LIMIT
+    QUALITY_POWER,              // the battery's tier floor
+    QUALITY_REASON_COUNT
+} QualityReason;
+
+typedef struct QualityGovernor
+{
+    double budget_ms;
+    std::atomic<int> tier;      // written by the thread that feeds frames, read by any
+    PowerState power;
+    bool power_known;           // the platform reports anything
+    double second_start;        // this second's frame times so far
+    double gpu_sum;
+    double cpu_sum;
+    uint32_t gpu_frames;
+    uint32_t cpu_frames;
+    double frame_ms[QUALITY_HISTORY];   // per second, a ring; restarted at each change of tier
+    int frame_samples;
+    double temperature[QUALITY_HISTORY];
+    int temperature_samples;
+    double changed;             // when the tier last changed
+    double clear_since;         // since when there's been headroom for a step up
+    double up_hold;             // the spell a step up waits for now
+    double last_up;             // when the last step up was, negative before any
+    double start;
+    double tier_seconds[QUALITY_TIERS];
+    uint32_t steps_down[QUALITY_REASON_COUNT];
+    uint32_t steps_up;
+    uint32_t taken_back;        // steps up undone within their hold
+    float hottest;
+} QualityGovernor;
+
+// Frames at "budget_ms" or under are the goal. Finds the platform's sensors.
+void quality_governor_init(QualityGovernor* g, double budget_ms, double now);
+
+// A frame's GPU and CPU milliseconds, each 0 when there's no new one. True when the tier changed: the caller
+// applies quality_governor_tier's settings.
+bool quality_governor_frame(QualityGovernor* g, double now, double gpu_ms, double cpu_ms);
+
+// Any thread: the current tier's settings
+const QualityTier* quality_governor_tier(const QualityGovernor* g);
+
+// Time at each tier, the steps and what caused them, and the hottest the sensors read
+void quality_governor_print(const QualityGovernor* g, double now, FILE* out);
@@ -0,0 +1,86 @@
+#include "core/redraw_policy.h"
+
+static const char* reason_names[REDRAW_REASON_COUNT] = { "input", "camera", "animation", "renderer", "timer", "first" };
+
+void redraw_policy_init(RedrawPolicy* p, double now)
+{
+    p->requests.store(REDRAW_FIRST, std::memory_order_relaxed);
+    p->timer.store(0.0, std::memory_order_relaxed);
+    p->start = now;
+    p->idle_seconds = 0.0;
+    p->frames = 0;
+    p->waits = 0;
+    for (int i = 0; i < REDRAW_REASON_COUNT; ++i)
+        p->reason_frames[i] = 0;
+}
+
+void redraw_policy_request(RedrawPolicy* p, uint32_t reasons)
+{
+    p->requests.fetch_or(reasons, std::memory_order_release);
+}
+
+void redraw_policy_schedule(RedrawPolicy* p, double when)
+{
+    double current = p->timer.load(std::memory_order_relaxed);
+    while ((current <= 0.0 || when < current)
+        && !p->timer.compare_exchange_weak(current, when, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+// The timer's bit when it has come due
+static uint32_t timer_due(const RedrawPolicy* p, double now)
+{
+    const double when = p->timer.load(std::memory_order_acquire);
+    return when > 0.0 && when <= now ? (uint32_t)REDRAW_TIMER : 0u;
+}
+
+bool redraw_policy_due(const RedrawPolicy* p, double now)
+{
+    return p->requests.load(std::memory_order_acquire) || timer_due(p, now);
+}
+
+uint32_t redraw_policy_take(RedrawPolicy* p, double now)
+{
+    uint32_t reasons = p->requests.exchange(0, std::memory_order_acquire);
+    if (timer_due(p, now))
+    {
+        // A later schedule that raced in stays; only the one that came due is cleared
+        double when = p->timer.load(std::memory_order_relaxed);
+        if (when > 0.0 && when <= now && p->timer.compare_exchange_strong(when, 0.0, std::memory_order_relaxed))
+            reasons |= REDRAW_TIMER;
+    }
+    if (!reasons)
+        return 0;
+    ++p->frames;
+    for (int i = 0; i < REDRAW_REASON_COUNT; ++i)
+        p->reason_frames[i] += reasons >> i & 1u;
+    return reasons;
+}
+
+double redraw_policy_timeout(const RedrawPolicy* p, double now)
+{
+    const double when = p->timer.load(std::memory_order_acquire);
+    double wait = REDRAW_MAX_WAIT_SECONDS;
+    if (when > 0.0 && when - now < wait)
+        wait = when - now;
+    return wait > 0.0 ? wait : 0.0;
+}
+
+void redraw_policy_idle(RedrawPolicy* p, double seconds)
+{
+    p->idle_seconds += seconds;
+    ++p->waits;
+}
+
+void redraw_policy_print(const RedrawPolicy* p, double now, FILE* out)
+{
+    const double seconds = now - p->start;
+    fprintf(out, "on demand: %llu frames in %.1f s (%.2f/s), %.0f%% of the time waiting\n",
+        (unsigned long long)p->frames, seconds, seconds > 0.0 ? p->frames / seconds : 0.0,
+        seconds > 0.0 ? 100.0 * p->idle_seconds / seconds : 0.0);
+    fprintf(out, "  drawn for");
+    for (int i = 0; i < REDRAW_REASON_COUNT; ++i)
+        fprintf(out, " %s %llu%s", reason_names[i], (unsigned long long)p->reason_frames[i],
+            i + 1 < REDRAW_REASON_COUNT ? "," : "\n");
+}
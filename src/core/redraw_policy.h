@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+
+// On-demand redraws (--on-demand), for a window that mostly shows the same
+// thing, such as a dashboard left up all day. Rather than a frame every
+// refresh, the main thread sleeps in glfwWaitEventsTimeout until something
+// asks for one:
+//
+//  - input arrived: anything the callbacks queued;
+//  - the camera changed, which asks for the frame after too, so a change that
+//    carries on by itself (a controller coasting) draws until it settles;
+//  - the scene is animating: its clock is running (Space stops it);
+//  - the renderer isn't settled: loading, fading in, a mesh streaming;
+//  - a refresh scheduled for a time, such as the overlay's readouts.
+//
+// Any thread may ask. Each ask sets its reason's bit; the asker wakes the
+// waiting thread with glfwPostEmptyEvent, as nothing here touches GLFW. The
+// frame that takes the bits knows why it was drawn: the renderer presents
+// only the overlay's rectangle as damage when its refresh is the sole reason.
+
+#define REDRAW_MAX_WAIT_SECONDS 0.25    // the longest single wait, so window close and wall messages aren't held up
+#define REDRAW_OVERLAY_SECONDS 0.5      // how often a shown overlay asks for a frame to refresh its readouts
+
+typedef enum RedrawReason
+{
+    REDRAW_INPUT = 1u << 0,
+    REDRAW_CAMERA = 1u << 1,
+    REDRAW_ANIMATION = 1u << 2,
+    REDRAW_RENDERER = 1u << 3,
+    REDRAW_TIMER = 1u << 4,
+    REDRAW_FIRST = 1u << 5,         // the first frame, asked for at init
+    REDRAW_REASON_COUNT = 6
+} RedrawReason;
+
+typedef struct RedrawPolicy
+{
+    std::atomic<uint32_t> requests;     // RedrawReason bits asked for since the last frame took them
+    std::atomic<double> timer;          // when REDRAW_TIMER comes due, 0 for never; the earliest asked for wins
+    double start;                       // redraw_policy_init's "now", for the report
+    double idle_seconds;                // spent waiting, summed
+    uint64_t frames;
+    uint64_t waits;
+    uint64_t reason_frames[REDRAW_REASON_COUNT];    // frames each reason was among the reasons for
+} RedrawPolicy;
+
+// Asks for the first frame at once
+void redraw_policy_init(RedrawPolicy* p, double now);
+
+// Any thread: a frame for "reasons" (RedrawReason bits), as soon as the waiting thread wakes
+void redraw_policy_request(RedrawPolicy* p, uint32_t reasons);
+
+// Any thread: a REDRAW_TIMER frame at "when" (the clock redraw_policy_due is given), unless one is due sooner
+void redraw_policy_schedule(RedrawPolicy* p, double when);
+
+// True when a frame is asked for as of "now". Leaves the requests for redraw_policy_take.
+bool redraw_policy_due(const RedrawPolicy* p, double now);
+
+// Takes the reasons due at "now" for the frame being built and counts it; 0 when nothing asked
+uint32_t redraw_policy_take(RedrawPolicy* p, double now);
+
+// How long the caller may wait for events before it looks again: up to the timer, at most REDRAW_MAX_WAIT_SECONDS
+double redraw_policy_timeout(const RedrawPolicy* p, double now);
+
+// The caller waited "seconds" with nothing to draw
+void redraw_policy_idle(RedrawPolicy* p, double seconds);
+
+// Frames drawn against the time run, the share of it spent waiting, and how often each reason asked
+void redraw_policy_print(const RedrawPolicy* p, double now, FILE* out);
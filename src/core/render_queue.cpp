@@ -0,0 +1,259 @@
+#include "core/render_queue.h"
+
+#include "core/job_system.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES ((64 + RADIX_BITS - 1) / RADIX_BITS)
+#define RADIX_MAX_CHUNKS JOB_SYSTEM_MAX_THREADS
+#define RADIX_MIN_CHUNK 16384       // entries per chunk below which threads cost more than they save
+
+bool render_queue_init(RenderQueue* q, size_t capacity)
+{
+    q->entries = (RenderQueueEntry*)malloc(sizeof(RenderQueueEntry) * capacity);
+    q->scratch = (RenderQueueEntry*)malloc(sizeof(RenderQueueEntry) * capacity);
+    q->count.store(0, std::memory_order_relaxed);
+    q->capacity = capacity;
+    if (capacity && (!q->entries || !q->scratch))
+    {
+        fprintf(stderr, "render_queue: out of memory for %zu entries\n", capacity);
+        render_queue_destroy(q);
+        return false;
+    }
+    return true;
+}
+
+void render_queue_destroy(RenderQueue* q)
+{
+    free(q->entries);
+    free(q->scratch);
+    q->entries = q->scratch = NULL;
+    q->count.store(0, std::memory_order_relaxed);
+    q->capacity = 0;
+}
+
+RenderQueueEntry* render_queue_reserve(RenderQueue* q, size_t n)
+{
+    size_t first = q->count.load(std::memory_order_relaxed);
+    do
+    {
+        if (first + n > q->capacity)
+            return NULL;
+    } while (!q->count.compare_exchange_weak(first, first + n, std::memory_order_relaxed));
+    return q->entries + first;
+}
+
+bool render_queue_push(RenderQueue* q, uint64_t key, uint32_t payload)
+{
+    RenderQueueEntry* e = render_queue_reserve(q, 1);
+    if (!e)
+        return false;
+    e->key = key;
+    e->payload = payload;
+    e->reserved = 0;
+    return true;
+}
+
+static inline uint32_t digit(uint64_t key, int pass)
+{
+    return (uint32_t)(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1);
+}
+
+// Turns counts into exclusive prefix sums: bucket starts
+static void bucket_offsets(size_t* offsets, const size_t* counts)
+{
+    size_t sum = 0;
+    for (int b = 0; b < RADIX_BUCKETS; ++b)
+    {
+        offsets[b] = sum;
+        sum += counts[b];
+    }
+}
+
+// True when every key shares this digit: the pass wouldn't move anything
+static bool pass_is_trivial(const size_t* counts, size_t n)
+{
+    for (int b = 0; b < RADIX_BUCKETS; ++b)
+    {
+        if (counts[b])
+            return counts[b] == n;
+    }
+    return true;
+}
+
+static void scatter(RenderQueueEntry* dst, const RenderQueueEntry* src, size_t begin, size_t end, int pass, size_t* offsets)
+{
+    for (size_t i = begin; i < end; ++i)
+        dst[offsets[digit(src[i].key, pass)]++] = src[i];
+}
+
+static void sort_serial(RenderQueue* q, size_t n)
+{
+    // One sweep counts every digit at once
+    static thread_local size_t counts[RADIX_PASSES][RADIX_BUCKETS];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; ++i)
+    {
+        const uint64_t key = q->entries[i].key;
+        for (int p = 0; p < RADIX_PASSES; ++p)
+            ++counts[p][digit(key, p)];
+    }
+
+    for (int p = 0; p < RADIX_PASSES; ++p)
+    {
+        if (pass_is_trivial(counts[p], n))
+            continue;
+        size_t offsets[RADIX_BUCKETS];
+        bucket_offsets(offsets, counts[p]);
+        scatter(q->scratch, q->entries, 0, n, p, offsets);
+        RenderQueueEntry* t = q->entries;
+        q->entries = q->scratch;
+        q->scratch = t;
+    }
+}
+
+// Parallel passes: each chunk counts its digits, then scatters to where its share of each bucket starts
+typedef struct RadixSort
+{
+    RenderQueueEntry* src;
+    RenderQueueEntry* dst;
+    size_t n;
+    size_t chunk_size;
+    int pass;               // -1: count every digit
+    size_t (*counts)[RADIX_PASSES][RADIX_BUCKETS];      // per chunk: digit counts, then a pass's scatter offsets
+} RadixSort;
+
+static void count_chunks(void* data, size_t begin, size_t end)
+{
+    RadixSort* sort = (RadixSort*)data;
+    for (size_t c = begin; c < end; ++c)
+    {
+        const size_t first = c * sort->chunk_size;
+        const size_t last = first + sort->chunk_size < sort->n ? first + sort->chunk_size : sort->n;
+        if (sort->pass < 0)
+        {
+            memset(sort->counts[c], 0, sizeof(sort->counts[c]));
+            for (size_t i = first; i < last; ++i)
+            {
+                const uint64_t key = sort->src[i].key;
+                for (int p = 0; p < RADIX_PASSES; ++p)
+                    ++sort->counts[c][p][digit(key, p)];
+            }
+        }
+        else
+        {
+            size_t* counts = sort->counts[c][sort->pass];
+            memset(counts, 0, sizeof(size_t) * RADIX_BUCKETS);
+            for (size_t i = first; i < last; ++i)
+                ++counts[digit(sort->src[i].key, sort->pass)];
+        }
+    }
+}
+
+static void scatter_chunks(void* data, size_t begin, size_t end)
+{
+    RadixSort* sort = (RadixSort*)data;
+    for (size_t c = begin; c < end; ++c)
+    {
+        const size_t first = c * sort->chunk_size;
+        const size_t last = first + sort->chunk_size < sort->n ? first + sort->chunk_size : sort->n;
+        scatter(sort->dst, sort->src, first, last, sort->pass, sort->counts[c][sort->pass]);
+    }
+}
+
+static void sort_parallel(RenderQueue* q, size_t n, JobSystem* jobs, size_t chunks)
+{
+    RadixSort sort;
+    sort.counts = (size_t(*)[RADIX_PASSES][RADIX_BUCKETS])malloc(sizeof(*sort.counts) * chunks);
+    if (!sort.counts)
+    {
+        sort_serial(q, n);
+        return;
+    }
+    sort.n = n;
+    sort.chunk_size = (n + chunks - 1) / chunks;
+
+    // Every digit counted in one parallel sweep finds the passes that can be skipped; the counts stay
+    // valid per chunk until the first pass moves entries between chunks
+    sort.src = q->entries;
+    sort.pass = -1;
+    job_wait(jobs, job_parallel_for(jobs, count_chunks, &sort, chunks, 1));
+    bool moved = false;
+
+    for (int p = 0; p < RADIX_PASSES; ++p)
+    {
+        size_t totals[RADIX_BUCKETS] = {};
+        for (size_t c = 0; c < chunks; ++c)
+        {
+            for (int b = 0; b < RADIX_BUCKETS; ++b)
+                totals[b] += sort.counts[c][p][b];
+        }
+        if (pass_is_trivial(totals, n))
+            continue;
+
+        sort.src = q->entries;
+        sort.dst = q->scratch;
+        sort.pass = p;
+        if (moved)
+            job_wait(jobs, job_parallel_for(jobs, count_chunks, &sort, chunks, 1));
+
+        // Offsets: bucket-major over the chunks, so each chunk's entries keep their order within a bucket
+        size_t sum = 0;
+        for (int b = 0; b < RADIX_BUCKETS; ++b)
+        {
+            for (size_t c = 0; c < chunks; ++c)
+            {
+                const size_t count = sort.counts[c][p][b];
+                sort.counts[c][p][b] = sum;
+                sum += count;
+            }
+        }
+        job_wait(jobs, job_parallel_for(jobs, scatter_chunks, &sort, chunks, 1));
+        RenderQueueEntry* t = q->entries;
+        q->entries = q->scratch;
+        q->scratch = t;
+        moved = true;
+    }
+    free(sort.counts);
+}
+
+void render_queue_sort(RenderQueue* q, JobSystem* jobs)
+{
+    const size_t n = q->count.load(std::memory_order_relaxed);
+    size_t chunks = jobs ? (size_t)jobs->thread_count : 1;
+    if (chunks > RADIX_MAX_CHUNKS)
+        chunks = RADIX_MAX_CHUNKS;
+    if (chunks > n / RADIX_MIN_CHUNK)
+        chunks = n / RADIX_MIN_CHUNK;
+    if (chunks <= 1)
+        sort_serial(q, n);
+    else
+        sort_parallel(q, n, jobs, chunks);
+}
+
+bool render_queue_sort_coherent(RenderQueue* q, JobSystem* jobs)
+{
+    const size_t n = q->count.load(std::memory_order_relaxed);
+    const size_t budget = RENDER_QUEUE_COHERENT_MOVES * n;
+    RenderQueueEntry* e = q->entries;
+    size_t moves = 0, i = 1;
+    for (; i < n && moves <= budget; ++i)
+    {
+        if (!(e[i].key < e[i - 1].key))
+            continue;
+        const RenderQueueEntry entry = e[i];
+        size_t j = i;
+        for (; j > 0 && e[j - 1].key > entry.key; --j)
+            e[j] = e[j - 1];
+        e[j] = entry;
+        moves += i - j;
+    }
+    if (i >= n)
+        return true;
+    render_queue_sort(q, jobs);     // what's been sorted so far stays stable through it
+    return false;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct JobSystem JobSystem;
+
+// Draw commands as sortable 64-bit keys plus a 32-bit payload.
+//
+// Each draw packs what it needs bound into a key, most expensive to change
+// first: pass, program, material, vertex array, then depth. After sorting,
+// draws that share state are adjacent, and submission only switches
+// program/VAO/material where the key's fields change. The payload picks the
+// draw's own data (object index, draw-data offset, ...).
+//
+// render_queue_sort is an LSD radix sort on 11-bit digits (six passes). A digit
+// that is the same in every key (an unused field, a single program) costs one
+// counting sweep and no pass. With a job system each pass is split into one
+// histogram-then-scatter chunk per thread, and the order stays stable.
+//
+//   bit 63      60 59        48 47         36 35         24 23               0
+//       [ pass  ] [ program  ] [ material  ] [ vertex arr] [      depth      ]
+
+#define RENDER_KEY_PASS_BITS     4
+#define RENDER_KEY_PROGRAM_BITS  12
+#define RENDER_KEY_MATERIAL_BITS 12
+#define RENDER_KEY_VAO_BITS      12
+#define RENDER_KEY_DEPTH_BITS    24
+
+#define RENDER_KEY_DEPTH_SHIFT    0
+#define RENDER_KEY_VAO_SHIFT      (RENDER_KEY_DEPTH_SHIFT + RENDER_KEY_DEPTH_BITS)
+#define RENDER_KEY_MATERIAL_SHIFT (RENDER_KEY_VAO_SHIFT + RENDER_KEY_VAO_BITS)
+#define RENDER_KEY_PROGRAM_SHIFT  (RENDER_KEY_MATERIAL_SHIFT + RENDER_KEY_MATERIAL_BITS)
+#define RENDER_KEY_PASS_SHIFT     (RENDER_KEY_PROGRAM_SHIFT + RENDER_KEY_PROGRAM_BITS)
+
+#define RENDER_KEY_FIELD(key, name) \
+    ((uint32_t)((key) >> RENDER_KEY_##name##_SHIFT) & ((1u << RENDER_KEY_##name##_BITS) - 1u))
+
+// Fields are small ids (indices into the renderer's own tables), masked to their widths
+static inline uint64_t render_key(uint32_t pass, uint32_t program, uint32_t material, uint32_t vertex_array, uint32_t depth)
+{
+    return ((uint64_t)(pass & ((1u << RENDER_KEY_PASS_BITS) - 1u)) << RENDER_KEY_PASS_SHIFT)
+        | ((uint64_t)(program & ((1u << RENDER_KEY_PROGRAM_BITS) - 1u)) << RENDER_KEY_PROGRAM_SHIFT)
+        | ((uint64_t)(material & ((1u << RENDER_KEY_MATERIAL_BITS) - 1u)) << RENDER_KEY_MATERIAL_SHIFT)
+        | ((uint64_t)(vertex_array & ((1u << RENDER_KEY_VAO_BITS) - 1u)) << RENDER_KEY_VAO_SHIFT)
+        | ((uint64_t)(depth & ((1u << RENDER_KEY_DEPTH_BITS) - 1u)) << RENDER_KEY_DEPTH_SHIFT);
+}
+
+// Depth in [0, 1] (clamped) quantized for the key: near first for opaque passes, far first when "back_to_front"
+static inline uint32_t render_key_depth(float depth, bool back_to_front)
+{
+    const float d = depth < 0.f ? 0.f : depth > 1.f ? 1.f : depth;
+    const uint32_t max = (1u << RENDER_KEY_DEPTH_BITS) - 1u;
+    uint32_t q = (uint32_t)(d * (float)max + 0.5f);
+    q = q < max ? q : max;      // near 1 the float rounds up to 1 << RENDER_KEY_DEPTH_BITS, which would wrap to 0
+    return back_to_front ? max - q : q;
+}
+
+#define RENDER_QUEUE_COHERENT_MOVES 8    // per entry, on average: what render_queue_sort_coherent spends at most
+
+typedef struct RenderQueueEntry
+{
+    uint64_t key;
+    uint32_t payload;
+    uint32_t reserved;
+} RenderQueueEntry;
+
+typedef struct RenderQueue
+{
+    RenderQueueEntry* entries;      // sorted by render_queue_sort
+    RenderQueueEntry* scratch;      // the sort's ping-pong buffer
+    std::atomic<size_t> count;
+    size_t capacity;
+} RenderQueue;
+
+// Logs and returns false when out of memory
+bool render_queue_init(RenderQueue* q, size_t capacity);
+void render_queue_destroy(RenderQueue* q);
+
+static inline void render_queue_clear(RenderQueue* q)
+{
+    q->count.store(0, std::memory_order_relaxed);
+}
+
+// Claims "n" consecutive entries for the caller to fill; safe to call from several threads at once.
+// Returns NULL (and claims nothing) when they don't fit.
+RenderQueueEntry* render_queue_reserve(RenderQueue* q, size_t n);
+
+// Single-entry render_queue_reserve
+bool render_queue_push(RenderQueue* q, uint64_t key, uint32_t payload);
+
+// Sorts the entries by key, stably. "jobs" (NULL: the calling thread only) must be called from a thread in the
+// job system; small queues are sorted on the calling thread either way.
+void render_queue_sort(RenderQueue* q, JobSystem* jobs);
+
+// render_queue_sort for entries that are nearly in key order already - recorded in the last frame's sorted order,
+// say, with a few draws come, gone or moved: an insertion sort, in place, linear in the entries plus how far each
+// has to move. Once it has shifted entries more than RENDER_QUEUE_COHERENT_MOVES times their count it gives up and
+// render_queue_sort finishes the job. Stable either way. Returns false when it gave up.
+bool render_queue_sort_coherent(RenderQueue* q, JobSystem* jobs);
@@ -0,0 +1,570 @@
+#include "core/render_service.h"
+
+#include "core/screen_recorder.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#define SEND_FLAGS 0
+#define WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#define SEND_FLAGS MSG_NOSIGNAL     // a client that's gone is an answer dropped, not a SIGPIPE
+#define WOULD_BLOCK() (errno == EWOULDBLOCK || errno == EAGAIN)
+#endif
+
+static double now_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void put16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put64(uint8_t* p, uint64_t v)
+{
+    put32(p, (uint32_t)v);
+    put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t get16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint64_t get64(const uint8_t* p)
+{
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+static void put_f32(uint8_t* p, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put32(p, bits);
+}
+
+static void put_f64(uint8_t* p, double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put64(p, bits);
+}
+
+static float get_f32(const uint8_t* p)
+{
+    const uint32_t bits = get32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static double get_f64(const uint8_t* p)
+{
+    const uint64_t bits = get64(p);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static void set_non_blocking(socket_t s)
+{
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(s, FIONBIO, &on);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+// All of it, waiting for room while the client reads, up to "deadline"
+static bool send_all(socket_t s, const void* data, size_t size, double deadline)
+{
+    const char* p = (const char*)data;
+    while (size > 0)
+    {
+        const int n = (int)send(s, p, (int)(size < (1u << 30) ? size : (1u << 30)), SEND_FLAGS);
+        if (n > 0)
+        {
+            p += n;
+            size -= (size_t)n;
+            continue;
+        }
+        const double left = deadline - now_seconds();
+        if (n == 0 || !WOULD_BLOCK() || left <= 0.0)
+            return false;
+        fd_set writable;
+        FD_ZERO(&writable);
+        FD_SET(s, &writable);
+        timeval wait = { (long)left, (long)((left - (long)left) * 1e6) };
+        select((int)s + 1, NULL, &writable, NULL, &wait);
+    }
+    return true;
+}
+
+static void encode_response(uint8_t out[RENDER_SERVICE_RESPONSE_BYTES], const RenderRequest* request, int status,
+    uint32_t size)
+{
+    put32(out, RENDER_SERVICE_RESPONSE_MAGIC);
+    put32(out + 4, request->id);
+    put32(out + 8, (uint32_t)status);
+    put16(out + 12, (uint16_t)(status == RENDER_SERVICE_OK ? request->width : 0));
+    put16(out + 14, (uint16_t)(status == RENDER_SERVICE_OK ? request->height : 0));
+    put32(out + 16, (uint32_t)request->format);
+    put32(out + 20, size);
+}
+
+void render_service_write_request(const RenderRequest* request, uint8_t out[RENDER_SERVICE_REQUEST_BYTES])
+{
+    memset(out, 0, RENDER_SERVICE_REQUEST_BYTES);
+    put32(out, RENDER_SERVICE_REQUEST_MAGIC);
+    put32(out + 4, request->id);
+    put16(out + 8, (uint16_t)request->width);
+    put16(out + 10, (uint16_t)request->height);
+    out[12] = (uint8_t)request->format;
+    put_f32(out + 16, request->fov_y * 57.2957795f);
+    for (int i = 0; i < 3; ++i)
+    {
+        put_f64(out + 20 + 8 * i, request->eye[i]);
+        put_f64(out + 44 + 8 * i, request->target[i]);
+    }
+}
+
+bool render_service_read_response(const uint8_t in[RENDER_SERVICE_RESPONSE_BYTES], uint32_t* id, int* status,
+    int* width, int* height, int* format, uint32_t* size)
+{
+    if (get32(in) != RENDER_SERVICE_RESPONSE_MAGIC)
+        return false;
+    *id = get32(in + 4);
+    *status = (int)get32(in + 8);
+    *width = get16(in + 12);
+    *height = get16(in + 14);
+    *format = (int)get32(in + 16);
+    *size = get32(in + 20);
+    return true;
+}
+
+// False for one that isn't this protocol's at all: the connection is out of step and is closed
+static bool read_request(const uint8_t* in, RenderRequest* request, bool* valid)
+{
+    if (get32(in) != RENDER_SERVICE_REQUEST_MAGIC)
+        return false;
+    request->id = get32(in + 4);
+    request->width = get16(in + 8);
+    request->height = get16(in + 10);
+    request->format = in[12];
+    const float degrees = get_f32(in + 16);
+    request->fov_y = degrees * 0.0174532925f;
+    double distance = 0.0;
+    bool finite = true;
+    for (int i = 0; i < 3; ++i)
+    {
+        request->eye[i] = get_f64(in + 20 + 8 * i);
+        request->target[i] = get_f64(in + 44 + 8 * i);
+        const double d = request->eye[i] - request->target[i];
+        distance += d * d;
+        finite = finite && isfinite(request->eye[i]) && isfinite(request->target[i]);
+    }
+    *valid = request->width >= 1 && request->width <= RENDER_SERVICE_MAX_SIZE && request->height >= 1
+        && request->height <= RENDER_SERVICE_MAX_SIZE && request->format >= 0
+        && request->format < RENDER_SERVICE_FORMAT_COUNT && degrees > 0.f && degrees < 180.f && finite
+        && distance > 0.0;
+    return true;
+}
+
+// An image for an encoder: a request's, or (pixels NULL) the refusal of one. False when even that has no room.
+static bool queue_image(RenderService* svc, const RenderRequest* request, int status, uint8_t* pixels)
+{
+    {
+        std::lock_guard<std::mutex> lock(svc->mutex);
+        if (svc->image_count == RENDER_SERVICE_QUEUE)
+            return false;
+        RenderServiceImage* image = &svc->images[(svc->image_head + svc->image_count) % RENDER_SERVICE_QUEUE];
+        image->request = *request;
+        image->status = status;
+        image->pixels = pixels;
+        ++svc->image_count;
+    }
+    svc->wake.notify_one();
+    return true;
+}
+
+static void encoder_thread(RenderService* svc)
+{
+    uint8_t* out = NULL;
+    size_t capacity = 0;
+    uint8_t* rows = NULL;
+    size_t rows_capacity = 0;
+    for (;;)
+    {
+        RenderServiceImage image;
+        {
+            std::unique_lock<std::mutex> lock(svc->mutex);
+            svc->wake.wait(lock, [svc] { return svc->stop || svc->image_count > 0; });
+            if (svc->stop)
+                break;
+            image = svc->images[svc->image_head];
+            svc->image_head = (svc->image_head + 1) % RENDER_SERVICE_QUEUE;
+            --svc->image_count;
+            ++svc->encoding;
+        }
+
+        const double start = now_seconds();
+        const RenderRequest* request = &image.request;
+        const uint8_t* data = NULL;
+        size_t size = 0;
+        if (image.pixels && request->format == RENDER_SERVICE_PNG)
+        {
+            const size_t bound = screen_recorder_png_bound(request->width, request->height);
+            const size_t row_bytes = 2 * (4 * (size_t)request->width + 1);
+            if (bound > capacity)
+            {
+                free(out);
+                out = (uint8_t*)malloc(bound);
+                capacity = out ? bound : 0;
+            }
+            if (row_bytes > rows_capacity)
+            {
+                free(rows);
+                rows = (uint8_t*)malloc(row_bytes);
+                rows_capacity = rows ? row_bytes : 0;
+            }
+            size = out && rows ? screen_recorder_encode_png(image.pixels, request->width, request->height, true, rows,
+                out, capacity) : 0;
+            data = out;
+        }
+        else if (image.pixels)
+        {
+            size = 4 * (size_t)request->width * request->height;
+            data = image.pixels;
+        }
+        const int status = image.pixels && !size ? RENDER_SERVICE_BUSY : image.status;
+        const double encoded = now_seconds();
+
+        uint8_t header[RENDER_SERVICE_RESPONSE_BYTES];
+        encode_response(header, request, status, status == RENDER_SERVICE_OK ? (uint32_t)size : 0);
+        bool sent = false;
+        RenderServiceClient* client = &svc->clients[request->client];
+        {
+            std::lock_guard<std::mutex> lock(client->send);
+            if (client->generation == request->generation && client->socket != (intptr_t)INVALID_SOCKET)
+            {
+                const double deadline = encoded + RENDER_SERVICE_SEND_TIMEOUT;
+                sent = send_all((socket_t)client->socket, header, sizeof(header), deadline)
+                    && (status != RENDER_SERVICE_OK || send_all((socket_t)client->socket, data, size, deadline));
+                if (!sent)
+                    shutdown((socket_t)client->socket, 2);     // the render thread's next read closes it
+            }
+        }
+        free(image.pixels);
+        if (sent && status == RENDER_SERVICE_OK)
+        {
+            svc->served.fetch_add(1, std::memory_order_relaxed);
+            svc->bytes_sent.fetch_add(sizeof(header) + size, std::memory_order_relaxed);
+        }
+        else if (!sent)
+            svc->dropped.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(svc->mutex);
+        --svc->encoding;
+        if (image.pixels)
+            svc->encode_seconds += encoded - start;
+        if (sent && status == RENDER_SERVICE_OK)
+            svc->latency_seconds += now_seconds() - request->received;
+    }
+    free(out);
+    free(rows);
+}
+
+bool render_service_init(RenderService* svc, int port, int encoders)
+{
+    svc->listener = (intptr_t)INVALID_SOCKET;
+    for (int i = 0; i < RENDER_SERVICE_MAX_CLIENTS; ++i)
+    {
+        svc->clients[i].socket = (intptr_t)INVALID_SOCKET;
+        svc->clients[i].generation = 0;
+        svc->clients[i].partial_size = 0;
+    }
+    svc->queue_count = svc->pending = 0;
+    svc->encoder_count = 0;
+    svc->image_head = svc->image_count = svc->encoding = 0;
+    svc->stop = false;
+    svc->connections = svc->requests = svc->batches = svc->batched = svc->refused = 0;
+    svc->served = 0;
+    svc->dropped = 0;
+    svc->bytes_sent = 0;
+    svc->encode_seconds = svc->latency_seconds = 0.0;
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+        return false;
+#endif
+    const socket_t listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    const int on = 1;
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t)port);
+    if (listener != INVALID_SOCKET)
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    if (listener == INVALID_SOCKET || bind(listener, (const sockaddr*)&address, sizeof(address)) != 0
+        || listen(listener, RENDER_SERVICE_MAX_CLIENTS) != 0)
+    {
+        fprintf(stderr, "render_service: can't listen on port %d\n", port);
+        if (listener != INVALID_SOCKET)
+            close_socket(listener);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+    set_non_blocking(listener);
+    svc->listener = (intptr_t)listener;
+
+    if (encoders <= 0)
+    {
+        const int cores = (int)std::thread::hardware_concurrency();
+        encoders = cores > 2 ? cores - 1 : 1;
+    }
+    svc->encoder_count = encoders < RENDER_SERVICE_MAX_ENCODERS ? encoders : RENDER_SERVICE_MAX_ENCODERS;
+    for (int i = 0; i < svc->encoder_count; ++i)
+        svc->encoders[i] = std::thread(encoder_thread, svc);
+    svc->start = now_seconds();
+    return true;
+}
+
+static void close_client(RenderService* svc, int i)
+{
+    RenderServiceClient* client = &svc->clients[i];
+    std::lock_guard<std::mutex> lock(client->send);
+    close_socket((socket_t)client->socket);
+    client->socket = (intptr_t)INVALID_SOCKET;
+    client->partial_size = 0;
+    ++client->generation;
+}
+
+void render_service_destroy(RenderService* svc)
+{
+    {
+        std::lock_guard<std::mutex> lock(svc->mutex);
+        svc->stop = true;
+    }
+    svc->wake.notify_all();
+    for (int i = 0; i < svc->encoder_count; ++i)
+        svc->encoders[i].join();
+    svc->encoder_count = 0;
+    for (; svc->image_count > 0; --svc->image_count)
+    {
+        free(svc->images[svc->image_head].pixels);
+        svc->image_head = (svc->image_head + 1) % RENDER_SERVICE_QUEUE;
+    }
+    for (int i = 0; i < RENDER_SERVICE_MAX_CLIENTS; ++i)
+        if (svc->clients[i].socket != (intptr_t)INVALID_SOCKET)
+            close_client(svc, i);
+    if (svc->listener != (intptr_t)INVALID_SOCKET)
+    {
+        close_socket((socket_t)svc->listener);
+        svc->listener = (intptr_t)INVALID_SOCKET;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+}
+
+int render_service_port(const RenderService* svc)
+{
+    sockaddr_in address;
+    socklen_t size = sizeof(address);
+    if (getsockname((socket_t)svc->listener, (sockaddr*)&address, &size) != 0)
+        return 0;
+    return ntohs(address.sin_port);
+}
+
+static void accept_clients(RenderService* svc)
+{
+    for (;;)
+    {
+        const socket_t s = accept((socket_t)svc->listener, NULL, NULL);
+        if (s == INVALID_SOCKET)
+            return;
+        int slot = -1;
+        for (int i = 0; i < RENDER_SERVICE_MAX_CLIENTS && slot < 0; ++i)
+            if (svc->clients[i].socket == (intptr_t)INVALID_SOCKET)
+                slot = i;
+        if (slot < 0)
+        {
+            close_socket(s);
+            continue;
+        }
+        const int on = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+        set_non_blocking(s);
+        std::lock_guard<std::mutex> lock(svc->clients[slot].send);
+        svc->clients[slot].socket = (intptr_t)s;
+        svc->clients[slot].partial_size = 0;
+        ++svc->connections;
+    }
+}
+
+// Whole requests from connection "i" into the queue. False when it closed, failed or spoke another protocol.
+static bool read_client(RenderService* svc, int i)
+{
+    RenderServiceClient* client = &svc->clients[i];
+    for (;;)
+    {
+        const int n = (int)recv((socket_t)client->socket, (char*)client->partial + client->partial_size,
+            (int)(RENDER_SERVICE_REQUEST_BYTES - client->partial_size), 0);
+        if (n <= 0)
+            return n < 0 && WOULD_BLOCK();
+        client->partial_size += (size_t)n;
+        if (client->partial_size < RENDER_SERVICE_REQUEST_BYTES)
+            continue;
+        client->partial_size = 0;
+
+        RenderRequest request;
+        bool valid;
+        if (!read_request(client->partial, &request, &valid))
+            return false;
+        request.client = i;
+        request.generation = client->generation;
+        request.received = now_seconds();
+        ++svc->requests;
+        if (valid && svc->queue_count < RENDER_SERVICE_QUEUE)
+        {
+            svc->queue[svc->queue_count++] = request;
+            continue;
+        }
+        ++svc->refused;
+        if (!queue_image(svc, &request, valid ? RENDER_SERVICE_BUSY : RENDER_SERVICE_BAD_REQUEST, NULL))
+            svc->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void render_service_poll(RenderService* svc, double seconds)
+{
+    if (svc->queue_count == 0 && seconds > 0.0)
+    {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET((socket_t)svc->listener, &readable);
+        socket_t highest = (socket_t)svc->listener;
+        for (int i = 0; i < RENDER_SERVICE_MAX_CLIENTS; ++i)
+        {
+            const socket_t s = (socket_t)svc->clients[i].socket;
+            if (s == INVALID_SOCKET)
+                continue;
+            FD_SET(s, &readable);
+            highest = s > highest ? s : highest;
+        }
+        timeval wait = { (long)seconds, (long)((seconds - (long)seconds) * 1e6) };
+        select((int)highest + 1, &readable, NULL, NULL, &wait);
+    }
+    accept_clients(svc);
+    for (int i = 0; i < RENDER_SERVICE_MAX_CLIENTS; ++i)
+        if (svc->clients[i].socket != (intptr_t)INVALID_SOCKET && !read_client(svc, i))
+            close_client(svc, i);
+}
+
+int render_service_batch(RenderService* svc, RenderRequest* batch, int max)
+{
+    if (svc->queue_count == 0)
+        return 0;
+    int room;
+    {
+        std::lock_guard<std::mutex> lock(svc->mutex);
+        room = RENDER_SERVICE_QUEUE - svc->image_count - svc->encoding - svc->pending;
+    }
+    max = max < RENDER_SERVICE_MAX_BATCH ? max : RENDER_SERVICE_MAX_BATCH;
+    max = max < room ? max : room;
+
+    // The oldest's size, and every later one of it up to "max"; the rest keep their order
+    const int width = svc->queue[0].width, height = svc->queue[0].height;
+    int count = 0, kept = 0;
+    for (int i = 0; i < svc->queue_count; ++i)
+    {
+        const RenderRequest* request = &svc->queue[i];
+        if (count < max && request->width == width && request->height == height)
+            batch[count++] = *request;
+        else
+            svc->queue[kept++] = *request;
+    }
+    svc->queue_count = kept;
+    svc->pending += count;
+    if (count)
+    {
+        ++svc->batches;
+        svc->batched += (uint64_t)count;
+    }
+    return count;
+}
+
+void render_service_complete(RenderService* svc, const RenderRequest* request, uint8_t* pixels)
+{
+    --svc->pending;
+    if (!queue_image(svc, request, pixels ? RENDER_SERVICE_OK : RENDER_SERVICE_BUSY, pixels))
+    {
+        free(pixels);       // render_service_batch kept room for it: only refusals can have taken it since
+        svc->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+double render_service_throughput(const RenderService* svc)
+{
+    const double seconds = now_seconds() - svc->start;
+    return seconds > 0.0 ? (double)svc->served.load(std::memory_order_relaxed) / seconds : 0.0;
+}
+
+void render_service_print(RenderService* svc, FILE* out)
+{
+    const uint64_t served = svc->served.load(std::memory_order_relaxed);
+    double encode, latency;
+    {
+        std::lock_guard<std::mutex> lock(svc->mutex);
+        encode = svc->encode_seconds;
+        latency = svc->latency_seconds;
+    }
+    fprintf(out, "service: %llu connections, %llu requests (%llu refused), %llu batches of %.1f; %llu images served, "
+        "%.1f a second, %.1f MB; %llu dropped\n", (unsigned long long)svc->connections,
+        (unsigned long long)svc->requests, (unsigned long long)svc->refused, (unsigned long long)svc->batches,
+        svc->batches ? (double)svc->batched / svc->batches : 0.0, (unsigned long long)served,
+        render_service_throughput(svc), svc->bytes_sent.load(std::memory_order_relaxed) / 1048576.0,
+        (unsigned long long)svc->dropped.load(std::memory_order_relaxed));
+    if (served)
+        fprintf(out, "  %.2f ms encoding an image (%d encoder threads), %.1f ms from request to sent\n",
+            1000.0 * encode / served, svc->encoder_count, 1000.0 * latency / served);
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Images rendered on request, over TCP: a headless renderer on a GPU
+// server answering for thumbnails and report figures (--serve).
+//
+// A client connects and sends requests, each a camera and an image size;
+// the answer to each is an image, on the same connection, in the order they
+// finish (the id says which). The render thread polls the listening socket
+// and the connections between frames (render_service_poll), and each frame
+// takes a batch: up to RENDER_SERVICE_MAX_BATCH waiting requests of one
+// size (render_service_batch), drawn into the layers of one array render
+// target and read back together (gl/batch_target.h). Each image read back
+// goes to the service with render_service_complete, and from there to a
+// pool of encoder threads: one encodes it (PNG, with screen_recorder.h's
+// encoder) and sends it while the render thread draws the next batch.
+//
+// Backpressure is the queues' size: a request arriving to a full queue is
+// answered RENDER_SERVICE_BUSY at once, and a batch is only as big as the
+// room the encoders have for its images, so a slow network or encoder slows
+// the batches rather than growing memory.
+//
+// The protocol is little-endian, whatever the hosts are:
+//
+//   request, RENDER_SERVICE_REQUEST_BYTES:
+//     u32 magic (RENDER_SERVICE_REQUEST_MAGIC), u32 id, u16 width, u16 height,
+//     u8 format (RenderServiceFormat), u8[3] zero, f32 vertical field of
+//     view in degrees, f64[3] eye, f64[3] target (world units, z up)
+//   response, RENDER_SERVICE_RESPONSE_BYTES then "size" bytes of image:
+//     u32 magic (RENDER_SERVICE_RESPONSE_MAGIC), u32 id, u32 status
+//     (RenderServiceStatus), u16 width, u16 height, u32 format, u32 size
+//
+// A raw image is width x height RGBA8, bottom row first as GL reads it.
+
+#define RENDER_SERVICE_PORT 47900
+#define RENDER_SERVICE_MAX_CLIENTS 32
+#define RENDER_SERVICE_QUEUE 256            // requests waiting for a batch, and images waiting for an encoder
+#define RENDER_SERVICE_MAX_BATCH 16         // requests drawn in one frame: layers of the array target
+#define RENDER_SERVICE_MAX_ENCODERS 16
+#define RENDER_SERVICE_MAX_SIZE 4096        // pixels along either side of an image
+#define RENDER_SERVICE_REQUEST_BYTES 72
+#define RENDER_SERVICE_RESPONSE_BYTES 24
+#define RENDER_SERVICE_REQUEST_MAGIC 0x31515352u    // "RSQ1"
+#define RENDER_SERVICE_RESPONSE_MAGIC 0x31535352u   // "RSS1"
+#define RENDER_SERVICE_SEND_TIMEOUT 10.0    // seconds an encoder waits on a client not reading before dropping it
+
+typedef enum RenderServiceFormat
+{
+    RENDER_SERVICE_PNG,
+    RENDER_SERVICE_RAW,
+    RENDER_SERVICE_FORMAT_COUNT
+} RenderServiceFormat;
+
+typedef enum RenderServiceStatus
+{
+    RENDER_SERVICE_OK,
+    RENDER_SERVICE_BAD_REQUEST,     // a size of 0 or past RENDER_SERVICE_MAX_SIZE, an unknown format, a bad camera
+    RENDER_SERVICE_BUSY             // the queue was full: ask again later
+} RenderServiceStatus;
+
+typedef struct RenderRequest
+{
+    uint32_t id;                // the client's
+    int client;                 // the connection's slot
+    uint32_t generation;        // and which connection in it, so nothing goes to a later one
+    int width, height;
+    int format;                 // RenderServiceFormat
+    float fov_y;                // radians
+    double eye[3];
+    double target[3];
+    double received;            // seconds, the service's clock: for the latency
+} RenderRequest;
+
+typedef struct RenderServiceClient
+{
+    intptr_t socket;            // INVALID_SOCKET when the slot is free
+    uint32_t generation;        // bumped whenever the slot's connection closes
+    uint8_t partial[RENDER_SERVICE_REQUEST_BYTES];  // a request read in part
+    size_t partial_size;
+    std::mutex send;            // an encoder's response goes out whole; closing takes it too
+} RenderServiceClient;
+
+typedef struct RenderServiceImage
+{
+    RenderRequest request;
+    int status;                 // RenderServiceStatus
+    uint8_t* pixels;            // RGBA8, bottom row first; malloc'd, the encoder frees it. NULL for a refusal
+} RenderServiceImage;
+
+typedef struct RenderService
+{
+    intptr_t listener;
+    RenderServiceClient clients[RENDER_SERVICE_MAX_CLIENTS];
+
+    // The render thread's: requests waiting for a batch, oldest first
+    RenderRequest queue[RENDER_SERVICE_QUEUE];
+    int queue_count;
+    int pending;                // batched and not yet complete: their images have room kept for them
+
+    // The encoders'
+    std::thread encoders[RENDER_SERVICE_MAX_ENCODERS];
+    int encoder_count;
+    std::mutex mutex;
+    std::condition_variable wake;       // an image was queued, or stop
+    RenderServiceImage images[RENDER_SERVICE_QUEUE];    // FIFO
+    int image_head;
+    int image_count;
+    int encoding;               // taken by an encoder, not yet sent
+    bool stop;
+
+    // Over the run
+    uint64_t connections;
+    uint64_t requests;
+    uint64_t batches;
+    uint64_t batched;           // requests drawn in them
+    uint64_t refused;           // answered busy or bad
+    std::atomic<uint64_t> served;       // images sent
+    std::atomic<uint64_t> dropped;      // answers for connections that had closed, or that stopped reading
+    std::atomic<uint64_t> bytes_sent;
+    double encode_seconds;      // the encoders', summed; under "mutex"
+    double latency_seconds;     // from request to sent, summed over "served"; under "mutex"
+    double start;               // when it started listening
+} RenderService;
+
+// Listens on "port" on every interface (0 for one the system picks), with "encoders" threads (0: one per core but
+// one, for the render thread). Logs and returns false when it can't.
+bool render_service_init(RenderService* svc, int port, int encoders);
+
+// Closes every connection and stops the encoders, dropping the images they hadn't sent
+void render_service_destroy(RenderService* svc);
+
+int render_service_port(const RenderService* svc);
+
+// The render thread, between frames: accepts connections and reads their requests into the queue, waiting up to
+// "seconds" for something to arrive when the queue is empty
+void render_service_poll(RenderService* svc, double seconds);
+
+// The render thread: takes up to "max" (at most RENDER_SERVICE_MAX_BATCH) waiting requests the size of the oldest,
+// oldest first, as many as the encoders have room for. Returns how many, into "batch".
+int render_service_batch(RenderService* svc, RenderRequest* batch, int max);
+
+// The render thread, for every request a batch took: its image, "pixels" (request->width x request->height RGBA8,
+// bottom row first, malloc'd), handed to an encoder, which frees it. NULL when it couldn't be drawn or read back:
+// the client is answered RENDER_SERVICE_BUSY.
+void render_service_complete(RenderService* svc, const RenderRequest* request, uint8_t* pixels);
+
+// Images served a second since the service started
+double render_service_throughput(const RenderService* svc);
+
+void render_service_print(RenderService* svc, FILE* out);
+
+// A client's side of the wire format, for tools and tests: packs "request" (its id, size, format, camera) into
+// "out", and reads a response header. read_response returns false when "in" isn't one.
+void render_service_write_request(const RenderRequest* request, uint8_t out[RENDER_SERVICE_REQUEST_BYTES]);
+bool render_service_read_response(const uint8_t in[RENDER_SERVICE_RESPONSE_BYTES], uint32_t* id, int* status,
+    int* width, int* height, int* format, uint32_t* size);
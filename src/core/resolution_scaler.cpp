@@ -0,0 +1,63 @@
+#include "core/resolution_scaler.h"
+
+#include <math.h>
+
+void resolution_scaler_init(ResolutionScaler* s, double budget_ms, float min_scale, float max_scale, int latency)
+{
+    s->budget_ms = budget_ms > 0.0 ? budget_ms : 1000.0 / 60.0;
+    s->min_scale = min_scale > 0.f ? min_scale : 0.5f;
+    s->max_scale = max_scale >= s->min_scale ? max_scale : s->min_scale;
+    s->latency = latency > 0 ? latency : 0;
+    s->scale = s->max_scale;
+    s->smoothed_ms = 0.0;
+    s->settle = 0;
+    s->changes = 0;
+    s->scale_sum = 0.0;
+    s->samples = 0;
+}
+
+bool resolution_scaler_update(ResolutionScaler* s, double gpu_ms)
+{
+    s->scale_sum += s->scale;
+    ++s->samples;
+    if (!(gpu_ms > 0.0))
+        return false;
+    if (s->settle > 0)
+    {
+        --s->settle;
+        return false;
+    }
+    if (s->smoothed_ms <= 0.0 || gpu_ms > s->smoothed_ms)
+        s->smoothed_ms = gpu_ms;
+    else
+        s->smoothed_ms += (gpu_ms - s->smoothed_ms) * RESOLUTION_SCALE_RELEASE;
+
+    float target = s->scale * (float)sqrt(s->budget_ms * RESOLUTION_SCALE_HEADROOM / s->smoothed_ms);
+    if (target > s->scale + RESOLUTION_SCALE_MAX_RISE)
+        target = s->scale + RESOLUTION_SCALE_MAX_RISE;
+    // Down rounds down and up rounds down too, so a rise never overshoots what the time allows
+    target = floorf(target * RESOLUTION_SCALE_STEPS) / RESOLUTION_SCALE_STEPS;
+    target = target < s->min_scale ? s->min_scale : target > s->max_scale ? s->max_scale : target;
+    if (target == s->scale)
+        return false;
+
+    // What the smoothed time would have been at the new scale, so the next samples aren't compared to the old one
+    const double ratio = (double)target / s->scale;
+    s->smoothed_ms *= ratio * ratio;
+    s->scale = target;
+    s->settle = s->latency;
+    ++s->changes;
+    return true;
+}
+
+void resolution_scaler_size(const ResolutionScaler* s, int width, int height, int* render_width, int* render_height)
+{
+    const int w = (int)(width * s->scale) & ~1, h = (int)(height * s->scale) & ~1;
+    *render_width = w > 0 ? w : 1;
+    *render_height = h > 0 ? h : 1;
+}
+
+float resolution_scaler_average(const ResolutionScaler* s)
+{
+    return s->samples ? (float)(s->scale_sum / (double)s->samples) : s->max_scale;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+// Dynamic resolution: the fraction of the window's size the scene renders at,
+// chosen from the GPU time of recent frames so that time stays at a budget.
+//
+// Fed one GPU frame time per frame (the profiler's "frame" scope, read a few
+// frames late). Cost is taken to follow the pixel count, so the scale that
+// fits the budget is the current one times sqrt(budget / time). Times are
+// smoothed with a fast attack and a slow release: a spike is answered by the
+// next sample, a quiet stretch only slowly gives the resolution back. After
+// a change the samples still in flight were drawn at the old scale, so
+// "latency" frames pass before the next decision.
+//
+// Scales are quantised to 1/RESOLUTION_SCALE_STEPS, rounded down both ways,
+// and only go up by RESOLUTION_SCALE_MAX_RISE per change. With the slow
+// release that keeps a borderline load from making the image oscillate, and
+// since part of a frame's cost doesn't scale with pixels the estimate for a
+// rise errs high. The scale applies to both axes; the render size is the
+// window's times it, rounded down to even pixels.
+
+#define RESOLUTION_SCALE_STEPS 64           // quantisation of the scale
+#define RESOLUTION_SCALE_MAX_RISE 0.0625f   // the most one change may raise it
+#define RESOLUTION_SCALE_HEADROOM 0.9       // the fraction of the budget aimed for
+#define RESOLUTION_SCALE_RELEASE 0.05       // weight of a sample below the smoothed time
+
+typedef struct ResolutionScaler
+{
+    double budget_ms;       // GPU time per frame to stay under
+    float min_scale;
+    float max_scale;
+    int latency;            // frames between a change and the first sample drawn at it
+    float scale;            // of each axis, in [min_scale, max_scale]
+    double smoothed_ms;     // 0 before the first sample
+    int settle;             // samples left to ignore since the last change
+    uint32_t changes;
+    double scale_sum;       // over "samples", for the average
+    uint64_t samples;
+} ResolutionScaler;
+
+// Starts at max_scale. "latency" is how many frames late the GPU times arrive (GPU_PROFILER_LATENCY).
+void resolution_scaler_init(ResolutionScaler* s, double budget_ms, float min_scale, float max_scale, int latency);
+
+// One frame's GPU time; returns true when the scale changed
+bool resolution_scaler_update(ResolutionScaler* s, double gpu_ms);
+
+// The render size for a "width" x "height" output at the current scale (at least 1 x 1)
+void resolution_scaler_size(const ResolutionScaler* s, int width, int height, int* render_width, int* render_height);
+
+// Mean scale over the samples so far (max_scale before the first)
+float resolution_scaler_average(const ResolutionScaler* s);
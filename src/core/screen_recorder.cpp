@@ -0,0 +1,516 @@
+#include "core/screen_recorder.h"
+
+#include <chrono>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define RECORDER_PIPE_MODE "wb"
+#else
+#define RECORDER_PIPE_MODE "w"
+#endif
+
+// --- PNG ---
+
+static uint32_t crc_table[256];
+static std::once_flag crc_once;
+
+static void crc_init()
+{
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k)
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Deflate's bit order: values go in least significant bit first, Huffman codes most significant bit first
+typedef struct BitWriter
+{
+    uint8_t* out;
+    size_t size;
+    size_t capacity;
+    uint32_t bits;
+    int count;
+} BitWriter;
+
+static inline void put_bits(BitWriter* w, uint32_t value, int n)
+{
+    w->bits |= value << w->count;
+    w->count += n;
+    while (w->count >= 8)
+    {
+        if (w->size < w->capacity)
+            w->out[w->size] = (uint8_t)w->bits;
+        ++w->size;
+        w->bits >>= 8;
+        w->count -= 8;
+    }
+}
+
+static inline void put_code(BitWriter* w, uint32_t code, int n)
+{
+    uint32_t reversed = 0;
+    for (int i = 0; i < n; ++i)
+        reversed |= ((code >> i) & 1u) << (n - 1 - i);
+    put_bits(w, reversed, n);
+}
+
+// The fixed literal/length code (RFC 1951 3.2.6)
+static inline void put_symbol(BitWriter* w, int symbol)
+{
+    if (symbol < 144)
+        put_code(w, 0x30u + symbol, 8);
+    else if (symbol < 256)
+        put_code(w, 0x190u + (symbol - 144), 9);
+    else if (symbol < 280)
+        put_code(w, (uint32_t)(symbol - 256), 7);
+    else
+        put_code(w, 0xC0u + (symbol - 280), 8);
+}
+
+static const uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+    67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+    5, 5, 5, 5, 0 };
+
+// A copy of the previous byte, "length" (3 to 258) times: distance 1 is distance code 0, five zero bits
+static inline void put_run(BitWriter* w, int length)
+{
+    int i = 28;
+    while (length_base[i] > length)
+        --i;
+    put_symbol(w, 257 + i);
+    put_bits(w, (uint32_t)(length - length_base[i]), length_extra[i]);
+    put_bits(w, 0, 5);
+}
+
+// One filtered row into the block: literals, with runs of the byte before as matches. "prev" is the last byte of
+// the stream so far (or -1 at its start), since a match may reach back into the previous row.
+static void deflate_row(BitWriter* w, const uint8_t* row, size_t size, int prev)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+        const int before = i ? row[i - 1] : prev;
+        size_t run = 0;
+        while (before >= 0 && run < 258 && i + run < size && row[i + run] == before)
+            ++run;
+        if (run >= 3)
+        {
+            put_run(w, (int)run);
+            i += run;
+            continue;
+        }
+        put_symbol(w, row[i]);
+        ++i;
+    }
+}
+
+size_t screen_recorder_png_bound(int width, int height)
+{
+    // At most 9 bits a filtered byte (a match is never longer than the literals it replaces), plus the chunks
+    const size_t filtered = (size_t)height * (4 * (size_t)width + 1);
+    return (filtered * 9 + 7) / 8 + 128;
+}
+
+size_t screen_recorder_encode_png(const uint8_t* rgba, int width, int height, bool bottom_up, uint8_t* rows,
+    uint8_t* out, size_t capacity)
+{
+    std::call_once(crc_once, crc_init);
+    if (width <= 0 || height <= 0 || capacity < 64)
+        return 0;
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    memcpy(out, signature, 8);
+    uint8_t* ihdr = out + 8;
+    put_u32(ihdr, 13);
+    memcpy(ihdr + 4, "IHDR", 4);
+    put_u32(ihdr + 8, (uint32_t)width);
+    put_u32(ihdr + 12, (uint32_t)height);
+    ihdr[16] = 8;       // bits a channel
+    ihdr[17] = 6;       // RGBA
+    ihdr[18] = ihdr[19] = ihdr[20] = 0;     // deflate, adaptive filtering, no interlace
+    put_u32(ihdr + 21, crc_update(0xFFFFFFFFu, ihdr + 4, 17) ^ 0xFFFFFFFFu);
+
+    // IDAT: its length is filled in once the stream is done
+    uint8_t* idat = ihdr + 25;
+    memcpy(idat + 4, "IDAT", 4);
+    BitWriter w = { out, (size_t)(idat + 8 - out), capacity, 0, 0 };
+    put_bits(&w, 0x78, 8);      // zlib: deflate, 32K window
+    put_bits(&w, 0x01, 8);      // no dictionary, fastest; 0x7801 is a multiple of 31
+    put_bits(&w, 1, 1);         // the last block
+    put_bits(&w, 1, 2);         // fixed Huffman codes
+
+    const size_t stride = 4 * (size_t)width;
+    uint8_t* sub = rows;
+    uint8_t* up = rows + stride + 1;
+    uint32_t a = 1, b = 0;      // Adler-32 of the filtered bytes
+    int prev = -1;
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* row = rgba + stride * (size_t)(bottom_up ? height - 1 - y : y);
+        const uint8_t* above = y == 0 ? NULL : rgba + stride * (size_t)(bottom_up ? height - y : y - 1);
+        // Sub (the pixel to the left) and Up (the pixel above), scored by how far from 0 they leave the bytes
+        sub[0] = 1;
+        up[0] = 2;
+        unsigned long sub_cost = 0, up_cost = 0;
+        for (size_t i = 0; i < stride; ++i)
+        {
+            sub[1 + i] = (uint8_t)(row[i] - (i >= 4 ? row[i - 4] : 0));
+            sub_cost += (unsigned long)abs((int8_t)sub[1 + i]);
+            if (above)
+            {
+                up[1 + i] = (uint8_t)(row[i] - above[i]);
+                up_cost += (unsigned long)abs((int8_t)up[1 + i]);
+            }
+        }
+        const uint8_t* filtered = above && up_cost < sub_cost ? up : sub;
+        deflate_row(&w, filtered, stride + 1, prev);
+        prev = filtered[stride];
+        for (size_t i = 0; i <= stride; i += 5552)
+        {
+            // 5552 bytes is the most b takes before it could overflow 32 bits
+            const size_t end = i + 5552 < stride + 1 ? i + 5552 : stride + 1;
+            for (size_t k = i; k < end; ++k)
+            {
+                a += filtered[k];
+                b += a;
+            }
+            a %= 65521u;
+            b %= 65521u;
+        }
+    }
+    put_symbol(&w, 256);        // end of block
+    if (w.count)
+        put_bits(&w, 0, 8 - w.count);
+    const uint32_t adler = (b << 16) | a;
+    for (int i = 3; i >= 0; --i)
+        put_bits(&w, (adler >> (8 * i)) & 0xFF, 8);
+    if (w.size + 4 + 12 > capacity)
+        return 0;
+
+    const size_t idat_size = w.size - (size_t)(idat + 8 - out);
+    put_u32(idat, (uint32_t)idat_size);
+    put_u32(out + w.size, crc_update(0xFFFFFFFFu, idat + 4, idat_size + 4) ^ 0xFFFFFFFFu);
+    uint8_t* iend = out + w.size + 4;
+    put_u32(iend, 0);
+    memcpy(iend + 4, "IEND", 4);
+    put_u32(iend + 8, crc_update(0xFFFFFFFFu, iend + 4, 4) ^ 0xFFFFFFFFu);
+    return w.size + 4 + 12;
+}
+
+// --- The worker ---
+
+ScreenRecorderFormat screen_recorder_format_for(const char* path)
+{
+    static const char* const schemes[] = { "rtp://", "udp://", "srt://", "tcp://", "rtsp://" };
+    for (const char* scheme : schemes)
+        if (!strncmp(path, scheme, strlen(scheme)))
+            return SCREEN_RECORDER_STREAM;
+    const char* dot = strrchr(path, '.');
+    if (!dot)
+        return SCREEN_RECORDER_RAW;
+    static const char* const videos[] = { ".mp4", ".mkv", ".webm", ".mov" };
+    for (const char* video : videos)
+        if (!strcmp(dot, video))
+            return SCREEN_RECORDER_FFMPEG;
+    return !strcmp(dot, ".png") ? SCREEN_RECORDER_PNG : SCREEN_RECORDER_RAW;
+}
+
+static bool write_png(ScreenRecorder* rec, const char* path, const ScreenRecorderJob* job)
+{
+    const size_t bound = screen_recorder_png_bound(job->width, job->height);
+    const size_t rows = 2 * (4 * (size_t)job->width + 1);
+    if (rec->png_capacity < bound)
+    {
+        free(rec->png);
+        rec->png = (uint8_t*)malloc(bound);
+        rec->png_capacity = rec->png ? bound : 0;
+    }
+    if (rec->rows_capacity < rows)
+    {
+        free(rec->rows);
+        rec->rows = (uint8_t*)malloc(rows);
+        rec->rows_capacity = rec->rows ? rows : 0;
+    }
+    if (!rec->png || !rec->rows)
+        return false;
+    const size_t size = screen_recorder_encode_png(job->pixels, job->width, job->height, true, rec->rows, rec->png,
+        rec->png_capacity);
+    FILE* f = size ? fopen(path, "wb") : NULL;
+    if (!f)
+    {
+        fprintf(stderr, "screen_recorder: can't write %s\n", path);
+        return false;
+    }
+    const bool ok = fwrite(rec->png, 1, size, f) == size;
+    fclose(f);
+    rec->bytes += ok ? size : 0;
+    return ok;
+}
+
+// --- ffmpeg ---
+
+static const char* const encoder_names[SCREEN_RECORDER_ENCODER_COUNT] = { "default", "software", "nvenc", "vaapi",
+    "amf" };
+
+void screen_recorder_set_encoder(ScreenRecorder* rec, ScreenRecorderEncoder encoder, bool hevc, int bitrate_kbps)
+{
+    rec->encoder = encoder;
+    rec->hevc = hevc;
+    rec->bitrate_kbps = bitrate_kbps > 0 ? bitrate_kbps : 0;
+}
+
+int screen_recorder_encoder_from_name(const char* name)
+{
+    for (int i = SCREEN_RECORDER_ENCODER_SOFTWARE; i < SCREEN_RECORDER_ENCODER_COUNT; ++i)
+        if (!strcmp(name, encoder_names[i]))
+            return i;
+    return -1;
+}
+
+// Appends to a command, keeping track of whether it still fits
+typedef struct Command
+{
+    char* text;
+    size_t size;
+    size_t length;
+    bool fits;
+} Command;
+
+static void append(Command* c, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const int n = c->fits ? vsnprintf(c->text + c->length, c->size - c->length, format, args) : -1;
+    va_end(args);
+    c->fits = n >= 0 && c->length + n < c->size;
+    if (c->fits)
+        c->length += n;
+}
+
+bool screen_recorder_ffmpeg_command(const ScreenRecorder* rec, int width, int height, char* command, size_t size)
+{
+    Command c = { command, size, 0, size > 0 };
+    const bool stream = rec->format == SCREEN_RECORDER_STREAM;
+    const int encoder = stream && rec->encoder == SCREEN_RECORDER_ENCODER_DEFAULT ? SCREEN_RECORDER_ENCODER_SOFTWARE
+        : rec->encoder;
+    const char* codec = rec->hevc ? "hevc" : "h264";
+    append(&c, "ffmpeg -loglevel error -y");
+    if (encoder == SCREEN_RECORDER_ENCODER_VAAPI)
+        append(&c, " -vaapi_device %s", SCREEN_RECORDER_VAAPI_DEVICE);
+    append(&c, " -f rawvideo -pix_fmt rgba -s %dx%d -r %d -i -", width, height, rec->fps);
+    switch (encoder)
+    {
+    case SCREEN_RECORDER_ENCODER_DEFAULT:
+        append(&c, rec->hevc ? " -c:v libx265 -pix_fmt yuv420p" : " -pix_fmt yuv420p");
+        break;
+    case SCREEN_RECORDER_ENCODER_SOFTWARE:
+        append(&c, " -c:v %s -preset ultrafast -tune zerolatency -pix_fmt yuv420p", rec->hevc ? "libx265" : "libx264");
+        break;
+    case SCREEN_RECORDER_ENCODER_NVENC:
+        append(&c, " -c:v %s_nvenc -preset p1 -tune ull -zerolatency 1 -delay 0 -pix_fmt yuv420p", codec);
+        break;
+    case SCREEN_RECORDER_ENCODER_VAAPI:    // converted and uploaded by ffmpeg's filters, encoded on the GPU
+        append(&c, " -vf format=nv12,hwupload -c:v %s_vaapi", codec);
+        break;
+    case SCREEN_RECORDER_ENCODER_AMF:
+        append(&c, " -c:v %s_amf -usage ultralowlatency -pix_fmt yuv420p", codec);
+        break;
+    }
+    const int kbps = rec->bitrate_kbps ? rec->bitrate_kbps : stream ? 8000 : 0;
+    if (kbps)   // a rate buffer of about a frame: nothing waits for a burst to drain
+        append(&c, " -b:v %dk -maxrate %dk -bufsize %dk", kbps, kbps, kbps / rec->fps + 1);
+    if (!stream)
+        append(&c, " \"%s\"", rec->path);
+    else
+    {
+        append(&c, " -g %d -bf 0", rec->fps);
+        if (!strncmp(rec->path, "rtp://", 6))
+            append(&c, " -f rtp \"%s\"", rec->path);
+        else if (!strncmp(rec->path, "rtsp://", 7))
+            append(&c, " -f rtsp -rtsp_transport tcp \"%s\"", rec->path);
+        else
+            append(&c, " -f mpegts -flush_packets 1 \"%s\"", rec->path);
+    }
+    return c.fits;
+}
+
+// raw, ffmpeg and streams: the output opens at the first frame, which sets its size
+static bool open_stream(ScreenRecorder* rec, int width, int height)
+{
+    rec->width = width;
+    rec->height = height;
+    if (rec->format == SCREEN_RECORDER_RAW)
+        rec->out = fopen(rec->path, "wb");
+    else
+    {
+#ifndef _WIN32
+        signal(SIGPIPE, SIG_IGN);   // a missing or failed ffmpeg shows as a write error, not a dead process
+#endif
+        char command[SCREEN_RECORDER_COMMAND];
+        if (screen_recorder_ffmpeg_command(rec, width, height, command, sizeof(command)))
+            rec->out = popen(command, RECORDER_PIPE_MODE);
+    }
+    if (!rec->out)
+        fprintf(stderr, "screen_recorder: can't open %s%s\n", rec->format != SCREEN_RECORDER_RAW ? "ffmpeg for " : "",
+            rec->path);
+    return rec->out != NULL;
+}
+
+static bool write_frame(ScreenRecorder* rec, const ScreenRecorderJob* job)
+{
+    if (rec->format == SCREEN_RECORDER_PNG)
+    {
+        char path[SCREEN_RECORDER_PATH];
+        const char* dot = strrchr(rec->path, '.');
+        snprintf(path, sizeof(path), "%.*s_%06u.png", (int)(dot - rec->path), rec->path, rec->frames + 1);
+        return write_png(rec, path, job);
+    }
+    if (!rec->out && !open_stream(rec, job->width, job->height))
+        return false;
+    if (job->width != rec->width || job->height != rec->height)
+    {
+        ++rec->skipped;
+        return true;
+    }
+    // Top row first: what ffmpeg's rawvideo expects, and how images are usually stored
+    const size_t stride = 4 * (size_t)job->width;
+    for (int y = job->height - 1; y >= 0; --y)
+        if (fwrite(job->pixels + stride * (size_t)y, 1, stride, rec->out) != stride)
+            return false;
+    rec->bytes += stride * (size_t)job->height;
+    return true;
+}
+
+static void recorder_worker(ScreenRecorder* rec)
+{
+    for (;;)
+    {
+        ScreenRecorderJob job;
+        {
+            std::unique_lock<std::mutex> lock(rec->mutex);
+            rec->wake.wait(lock, [rec] { return rec->count > 0 || rec->stop; });
+            if (rec->count == 0)
+                return;
+            job = rec->jobs[rec->head];
+        }
+        const auto start = std::chrono::steady_clock::now();
+        if (job.screenshot[0])
+        {
+            if (write_png(rec, job.screenshot, &job))
+            {
+                ++rec->screenshots;
+                printf("screenshot: %s\n", job.screenshot);
+            }
+        }
+        else if (!rec->failed)
+        {
+            const unsigned int skipped = rec->skipped;
+            rec->failed = !write_frame(rec, &job);
+            rec->frames += !rec->failed && rec->skipped == skipped;
+            if (rec->failed)
+                fprintf(stderr, "screen_recorder: writing %s failed, recording stopped\n", rec->path);
+        }
+        rec->encode_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(rec->mutex);
+            rec->head = (rec->head + 1) % SCREEN_RECORDER_MAX_SLOTS;
+            --rec->count;
+        }
+        rec->busy[job.slot].store(false, std::memory_order_release);   // its pixels can be reused
+    }
+}
+
+void screen_recorder_init(ScreenRecorder* rec, const char* path, int fps)
+{
+    rec->head = rec->count = 0;
+    for (int i = 0; i < SCREEN_RECORDER_MAX_SLOTS; ++i)
+        rec->busy[i].store(false, std::memory_order_relaxed);
+    rec->stop = false;
+    rec->recording = path != NULL;
+    rec->format = path ? screen_recorder_format_for(path) : SCREEN_RECORDER_RAW;
+    snprintf(rec->path, sizeof(rec->path), "%s", path ? path : "");
+    rec->fps = fps > 0 ? fps : 60;
+    rec->encoder = SCREEN_RECORDER_ENCODER_DEFAULT;
+    rec->hevc = false;
+    rec->bitrate_kbps = 0;
+    rec->out = NULL;
+    rec->width = rec->height = 0;
+    rec->png = rec->rows = NULL;
+    rec->png_capacity = rec->rows_capacity = 0;
+    rec->frames = rec->skipped = rec->screenshots = 0;
+    rec->bytes = 0;
+    rec->encode_seconds = 0.0;
+    rec->failed = false;
+    rec->worker = std::thread(recorder_worker, rec);
+}
+
+void screen_recorder_destroy(ScreenRecorder* rec)
+{
+    {
+        std::lock_guard<std::mutex> lock(rec->mutex);
+        rec->stop = true;
+    }
+    rec->wake.notify_one();
+    rec->worker.join();
+    if (rec->out)
+    {
+        if (rec->format != SCREEN_RECORDER_RAW)
+            pclose(rec->out);   // waits for ffmpeg to finish the file
+        else
+            fclose(rec->out);
+        rec->out = NULL;
+    }
+    free(rec->png);
+    free(rec->rows);
+    rec->png = rec->rows = NULL;
+}
+
+bool screen_recorder_submit(ScreenRecorder* rec, int slot, const uint8_t* pixels, int width, int height,
+    const char* screenshot)
+{
+    if (slot < 0 || slot >= SCREEN_RECORDER_MAX_SLOTS || screen_recorder_busy(rec, slot))
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(rec->mutex);
+        if (rec->count == SCREEN_RECORDER_MAX_SLOTS)
+            return false;
+        ScreenRecorderJob* job = &rec->jobs[(rec->head + rec->count) % SCREEN_RECORDER_MAX_SLOTS];
+        job->slot = slot;
+        job->pixels = pixels;
+        job->width = width;
+        job->height = height;
+        snprintf(job->screenshot, sizeof(job->screenshot), "%s", screenshot ? screenshot : "");
+        rec->busy[slot].store(true, std::memory_order_relaxed);
+        ++rec->count;
+    }
+    rec->wake.notify_one();
+    return true;
+}
+
+bool screen_recorder_busy(const ScreenRecorder* rec, int slot)
+{
+    return rec->busy[slot].load(std::memory_order_acquire);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Writes captured frames out on a thread of its own, so encoding and disk I/O
+// never run on the thread that presents. The GL side (gl/screen_capture.h)
+// reads the frames back into buffers it owns and submits them by slot; the
+// worker encodes each in turn and marks its slot free again, which is all the
+// render thread ever checks. Nothing is copied on the way in.
+//
+// A recording goes to "path" in one of four forms, chosen by its extension:
+//
+//  - .png: one PNG a frame, numbered (shot.png becomes shot_000001.png, ...).
+//    The encoder filters each row (Sub or Up, whichever leaves smaller
+//    values) and deflates with fixed Huffman codes and run-length matches:
+//    flat and smoothly shaded areas shrink a lot, at a fraction of zlib's
+//    cost, but it takes tens of milliseconds for a 1080p frame, so at 60 fps
+//    frames get dropped;
+//  - .mp4, .mkv, .webm or .mov: the raw frames piped into ffmpeg, which picks
+//    the codec for the container;
+//  - a URL (rtp://, udp://, srt://, tcp:// or rtsp://): a live stream
+//    through ffmpeg, tuned for latency: no B-frames, a keyframe a second so a
+//    receiver joins quickly, and a rate buffer of about a frame at the given
+//    bitrate. The UDP, SRT and TCP ones carry MPEG-TS; for RTP, ffmpeg prints
+//    the SDP the receiver opens;
+//  - anything else: the raw RGBA8 frames, top row first, one after another.
+//
+// ffmpeg encodes with whatever screen_recorder_set_encoder picked: x264 or
+// x265, or a hardware encoder (NVENC, VA-API on a render node, AMF) that
+// takes the frames as they come, in system memory. Either codec is H.264 or
+// HEVC. The ffmpeg on the path has to have been built with it.
+//
+// The raw and ffmpeg streams take their size from the first frame; frames of
+// another size (after a resize) are skipped and counted. Screenshots go to a
+// path of their own as PNGs, with or without a recording.
+//
+// Frames come in bottom row first, as glReadPixels gives them, tightly packed
+// RGBA8. Submitting and checking slots may happen on any one thread.
+
+#define SCREEN_RECORDER_MAX_SLOTS 8
+#define SCREEN_RECORDER_PATH 260
+
+typedef enum ScreenRecorderFormat
+{
+    SCREEN_RECORDER_PNG,
+    SCREEN_RECORDER_RAW,
+    SCREEN_RECORDER_FFMPEG,
+    SCREEN_RECORDER_STREAM
+} ScreenRecorderFormat;
+
+typedef enum ScreenRecorderEncoder
+{
+    SCREEN_RECORDER_ENCODER_DEFAULT,    // ffmpeg's pick for a file's container; x264 for a stream
+    SCREEN_RECORDER_ENCODER_SOFTWARE,   // libx264 / libx265, at their fastest and with zero-latency tuning
+    SCREEN_RECORDER_ENCODER_NVENC,
+    SCREEN_RECORDER_ENCODER_VAAPI,      // on SCREEN_RECORDER_VAAPI_DEVICE, uploaded as NV12
+    SCREEN_RECORDER_ENCODER_AMF,
+    SCREEN_RECORDER_ENCODER_COUNT
+} ScreenRecorderEncoder;
+
+#define SCREEN_RECORDER_VAAPI_DEVICE "/dev/dri/renderD128"
+#define SCREEN_RECORDER_COMMAND 1024    // room for an ffmpeg command line
+
+typedef struct ScreenRecorderJob
+{
+    int slot;
+    const uint8_t* pixels;      // owned by the submitter until the slot is free again
+    int width, height;
+    char screenshot[SCREEN_RECORDER_PATH];  // a PNG to write instead of a recording frame; empty for a frame
+} ScreenRecorderJob;
+
+typedef struct ScreenRecorder
+{
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;       // a job was queued, or stop
+    ScreenRecorderJob jobs[SCREEN_RECORDER_MAX_SLOTS];  // FIFO; the head stays queued while it's encoded
+    int head;
+    int count;
+    std::atomic<bool> busy[SCREEN_RECORDER_MAX_SLOTS];
+    bool stop;
+
+    // The recording: the worker's once it has started
+    bool recording;             // a path was given
+    int format;                 // ScreenRecorderFormat
+    char path[SCREEN_RECORDER_PATH];
+    int fps;
+    int encoder;                // ScreenRecorderEncoder: ffmpeg and streams
+    bool hevc;                  // HEVC instead of H.264 (the default encoder's file formats aside)
+    int bitrate_kbps;           // 0: the encoder's default (streams: 8000)
+    FILE* out;                  // raw: the file; ffmpeg and streams: the pipe. Opened at the first frame
+    int width, height;          // raw and ffmpeg: the stream's, from its first frame
+    uint8_t* png;               // the encoder's output, grown as needed
+    size_t png_capacity;
+    uint8_t* rows;              // the encoder's two filtered rows
+    size_t rows_capacity;
+
+    // Totals, read once destroy has joined the worker
+    unsigned int frames;        // written out
+    unsigned int skipped;       // of the wrong size for the stream
+    unsigned int screenshots;
+    unsigned long long bytes;   // written, or piped
+    double encode_seconds;      // the worker's time on frames and screenshots
+    bool failed;                // the output couldn't be opened or written: later frames are dropped
+} ScreenRecorder;
+
+// Starts the worker. "path" is the recording (NULL for screenshots only), at "fps" frames a second for ffmpeg.
+void screen_recorder_init(ScreenRecorder* rec, const char* path, int fps);
+
+// Finishes every queued job, stops the worker and closes the recording
+void screen_recorder_destroy(ScreenRecorder* rec);
+
+ScreenRecorderFormat screen_recorder_format_for(const char* path);
+
+// The encoder ffmpeg uses, before the first frame is submitted. "bitrate_kbps" 0 leaves it to the encoder.
+void screen_recorder_set_encoder(ScreenRecorder* rec, ScreenRecorderEncoder encoder, bool hevc, int bitrate_kbps);
+
+// "software", "nvenc", "vaapi" or "amf"; -1 for anything else
+int screen_recorder_encoder_from_name(const char* name);
+
+// The command the ffmpeg and stream formats open a pipe to, for "width" x "height" frames. Returns false when it
+// doesn't fit in "size" bytes.
+bool screen_recorder_ffmpeg_command(const ScreenRecorder* rec, int width, int height, char* command, size_t size);
+
+// Queues slot "slot"'s frame (a recording frame, or a screenshot to "screenshot" unless that's NULL). Returns
+// false, taking nothing, while the slot is busy or the queue is full; the slot is busy from here until its frame
+// has been written.
+bool screen_recorder_submit(ScreenRecorder* rec, int slot, const uint8_t* pixels, int width, int height,
+    const char* screenshot);
+bool screen_recorder_busy(const ScreenRecorder* rec, int slot);
+
+// The PNG encoder on its own. "rgba" is width x height tightly packed RGBA8, bottom row first when "bottom_up".
+// The bound is what the encoding of any such image fits in; encode returns the bytes written, 0 when "capacity"
+// is too small. "rows" is scratch of 2 * (4 * width + 1) bytes.
+size_t screen_recorder_png_bound(int width, int height);
+size_t screen_recorder_encode_png(const uint8_t* rgba, int width, int height, bool bottom_up, uint8_t* rows,
+    uint8_t* out, size_t capacity);
@@ -0,0 +1,338 @@
+#include "core/settings.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+void settings_init(Settings* s)
+{
+    memset(s->items, 0, sizeof(s->items));
+    s->count = 0;
+}
+
+static int add(Settings* s, const char* name, SettingType type, void* value, double min, double max, const char* help)
+{
+    if (s->count == SETTINGS_MAX)
+    {
+        fprintf(stderr, "settings: table full, \"%s\" left out\n", name);
+        return -1;
+    }
+    Setting* setting = &s->items[s->count];
+    memset(setting, 0, sizeof(*setting));
+    setting->name = name;
+    setting->help = help;
+    setting->type = type;
+    setting->value = value;
+    setting->min = min;
+    setting->max = max;
+    return s->count++;
+}
+
+int settings_add_bool(Settings* s, const char* name, bool* value, const char* help)
+{
+    return add(s, name, SETTING_BOOL, value, 0.0, 1.0, help);
+}
+
+int settings_add_int(Settings* s, const char* name, int* value, int min, int max, const char* help)
+{
+    return add(s, name, SETTING_INT, value, min, max, help);
+}
+
+int settings_add_float(Settings* s, const char* name, float* value, float min, float max, const char* help)
+{
+    return add(s, name, SETTING_FLOAT, value, min, max, help);
+}
+
+int settings_add_choice(Settings* s, const char* name, int* value, const char* const* choices, int count,
+    const char* help)
+{
+    const int id = add(s, name, SETTING_CHOICE, value, 0.0, count - 1, help);
+    if (id >= 0)
+    {
+        s->items[id].choices = choices;
+        s->items[id].choice_count = count;
+    }
+    return id;
+}
+
+int settings_find(const Settings* s, const char* name)
+{
+    if (!strncmp(name, "--", 2))
+        name += 2;      // as it's written on the command line
+    for (int i = 0; i < s->count; ++i)
+    {
+        if (!strcmp(s->items[i].name, name))
+            return i;
+    }
+    return -1;
+}
+
+bool settings_set(Settings* s, int id, const char* text, char* error, size_t size)
+{
+    Setting* setting = &s->items[id];
+    char* end = NULL;
+    errno = 0;
+    switch (setting->type)
+    {
+    case SETTING_BOOL:
+    {
+        static const char* const on[] = { "on", "true", "yes", "1" };
+        static const char* const off[] = { "off", "false", "no", "0" };
+        for (int i = 0; i < 4; ++i)
+        {
+            if (!strcmp(text, on[i]) || !strcmp(text, off[i]))
+            {
+                *(bool*)setting->value = !strcmp(text, on[i]);
+                setting->changed = true;
+                return true;
+            }
+        }
+        snprintf(error, size, "%s is on or off, not \"%s\"", setting->name, text);
+        return false;
+    }
+    case SETTING_INT:
+    {
+        const long v = strtol(text, &end, 10);
+        if (end == text || *end || errno || v < setting->min || v > setting->max)
+        {
+            snprintf(error, size, "%s is a whole number from %.0f to %.0f, not \"%s\"", setting->name, setting->min,
+                setting->max, text);
+            return false;
+        }
+        *(int*)setting->value = (int)v;
+        setting->changed = true;
+        return true;
+    }
+    case SETTING_FLOAT:
+    {
+        const double v = strtod(text, &end);
+        if (end == text || *end || errno || !(v >= setting->min && v <= setting->max))
+        {
+            snprintf(error, size, "%s is a number from %g to %g, not \"%s\"", setting->name, setting->min,
+                setting->max, text);
+            return false;
+        }
+        *(float*)setting->value = (float)v;
+        setting->changed = true;
+        return true;
+    }
+    case SETTING_CHOICE:
+        for (int i = 0; i < setting->choice_count; ++i)
+        {
+            if (!strcmp(text, setting->choices[i]))
+            {
+                *(int*)setting->value = i;
+                setting->changed = true;
+                return true;
+            }
+        }
+        snprintf(error, size, "%s is one of", setting->name);
+        for (int i = 0; i < setting->choice_count; ++i)
+        {
+            const size_t used = strlen(error);
+            snprintf(error + used, size - used, "%s %s", i ? "," : "", setting->choices[i]);
+        }
+        return false;
+    }
+    return false;
+}
+
+bool settings_take(Settings* s, int id)
+{
+    if (id < 0 || !s->items[id].changed)
+        return false;
+    s->items[id].changed = false;
+    return true;
+}
+
+void settings_format(const Settings* s, int id, char* text, size_t size)
+{
+    const Setting* setting = &s->items[id];
+    switch (setting->type)
+    {
+    case SETTING_BOOL: snprintf(text, size, "%s", *(const bool*)setting->value ? "on" : "off"); break;
+    case SETTING_INT: snprintf(text, size, "%d", *(const int*)setting->value); break;
+    case SETTING_FLOAT: snprintf(text, size, "%g", *(const float*)setting->value); break;
+    case SETTING_CHOICE:
+    {
+        const int i = *(const int*)setting->value;
+        snprintf(text, size, "%s", i >= 0 && i < setting->choice_count ? setting->choices[i] : "?");
+        break;
+    }
+    }
+}
+
+// "--name value", "name value" or "name = value": the name and the value (empty for none), trimmed
+static void split_line(const char* line, char* name, char* value, size_t size)
+{
+    while (isspace((unsigned char)*line))
+        ++line;
+    size_t n = 0;
+    while (*line && !isspace((unsigned char)*line) && *line != '=' && n + 1 < size)
+        name[n++] = *line++;
+    name[n] = '\0';
+    while (isspace((unsigned char)*line) || *line == '=')
+        ++line;
+    n = 0;
+    while (*line && n + 1 < size)
+        value[n++] = *line++;
+    while (n && isspace((unsigned char)value[n - 1]))
+        --n;
+    value[n] = '\0';
+}
+
+void settings_command(Settings* s, const char* line, FILE* out)
+{
+    char name[SETTINGS_LINE_SIZE], value[SETTINGS_LINE_SIZE];
+    split_line(line, name, value, sizeof(name));
+    if (!name[0])
+        return;
+    if (!strcmp(name, "list") || !strcmp(name, "help"))
+    {
+        settings_print(s, out);
+        return;
+    }
+    const int id = settings_find(s, name);
+    if (id < 0)
+    {
+        fprintf(out, "no live setting \"%s\" (list shows them; the rest need a restart)\n", name);
+        return;
+    }
+    char text[64], error[SETTINGS_LINE_SIZE];
+    if (value[0] && !settings_set(s, id, value, error, sizeof(error)))
+    {
+        fprintf(out, "%s\n", error);
+        return;
+    }
+    settings_format(s, id, text, sizeof(text));
+    fprintf(out, "%s %s\n", s->items[id].name, text);
+}
+
+void settings_print(const Settings* s, FILE* out)
+{
+    for (int i = 0; i < s->count; ++i)
+    {
+        const Setting* setting = &s->items[i];
+        char text[64], range[64] = "on|off";
+        settings_format(s, i, text, sizeof(text));
+        if (setting->type == SETTING_INT || setting->type == SETTING_FLOAT)
+            snprintf(range, sizeof(range), "%g..%g", setting->min, setting->max);
+        else if (setting->type == SETTING_CHOICE)
+        {
+            range[0] = '\0';
+            for (int c = 0; c < setting->choice_count; ++c)
+            {
+                const size_t used = strlen(range);
+                snprintf(range + used, sizeof(range) - used, "%s%s", c ? "|" : "", setting->choices[c]);
+            }
+        }
+        fprintf(out, "  %-16s %-10s %-22s %s\n", setting->name, text, range, setting->help);
+    }
+}
+
+bool settings_read_args(const char* path, char*** args, int* count)
+{
+    *args = NULL;
+    *count = 0;
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        fprintf(stderr, "settings: can't open %s\n", path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    // Every word is an argument, so there are at most half as many as characters (plus one); each is copied with
+    // its NUL, and "--" in front of a line's first
+    const size_t words = (size_t)size / 2 + 1;
+    char** array = (char**)malloc(words * sizeof(char*) + (size_t)size * 2 + words * 3 + 1);
+    char* text = array ? (char*)(array + words) : NULL;
+    if (!array || fread(text, 1, (size_t)size, f) != (size_t)size)
+    {
+        fprintf(stderr, "settings: can't read %s\n", path);
+        free(array);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+    text[size] = '\0';
+
+    char* out = text + size + 1;
+    int n = 0;
+    bool first = true;      // the next word starts a line
+    for (const char* at = text; *at;)
+    {
+        if (*at == '\n')
+        {
+            first = true;
+            ++at;
+        }
+        else if (*at == '#')
+        {
+            while (*at && *at != '\n')
+                ++at;
+        }
+        else if (isspace((unsigned char)*at) || (*at == '=' && !first))
+            ++at;       // "name = value" and "name=value" are "name value"
+        else
+        {
+            array[n++] = out;
+            if (first && strncmp(at, "--", 2))
+            {
+                memcpy(out, "--", 2);
+                out += 2;
+            }
+            while (*at && !isspace((unsigned char)*at) && *at != '#' && !(first && *at == '='))
+                *out++ = *at++;
+            *out++ = '\0';
+            first = false;
+        }
+    }
+    *args = array;
+    *count = n;
+    return true;
+}
+
+static void console_read(SettingsConsole* c)
+{
+    char line[SETTINGS_LINE_SIZE];
+    while (fgets(line, sizeof(line), stdin))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        std::lock_guard<std::mutex> lock(c->mutex);
+        if (c->count == SETTINGS_CONSOLE_LINES)
+            continue;       // nobody is taking them
+        memcpy(c->lines[(c->head + c->count) % SETTINGS_CONSOLE_LINES], line, sizeof(line));
+        ++c->count;
+    }
+}
+
+bool settings_console_start(SettingsConsole* c, FILE* out)
+{
+    c->head = 0;
+    c->count = 0;
+    c->reader = std::thread(console_read, c);
+    c->running = true;
+    fprintf(out, "console: type NAME VALUE to change a setting, NAME to see it, list for all of them\n");
+    return true;
+}
+
+bool settings_console_take(SettingsConsole* c, char* line, size_t size)
+{
+    std::lock_guard<std::mutex> lock(c->mutex);
+    if (!c->count)
+        return false;
+    snprintf(line, size, "%s", c->lines[c->head]);
+    c->head = (c->head + 1) % SETTINGS_CONSOLE_LINES;
+    --c->count;
+    return true;
+}
+
+void settings_console_stop(SettingsConsole* c)
+{
+    if (c->running)
+        c->reader.detach();
+    c->running = false;
+}
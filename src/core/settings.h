@@ -0,0 +1,118 @@
+#pragma once
+
+#include <mutex>
+#include <stddef.h>
+#include <stdio.h>
+#include <thread>
+
+// Run-time settings: a config file read at startup, and the knobs the perf
+// team bisects (resolution scale, vsync, culling, LOD error, budgets) open to
+// live edits from a console while the app runs.
+//
+// The config file (--config FILE) is the command line written down: one
+// option per line, with or without its leading "--", "#" starting a comment.
+// settings_read_args turns it into arguments that go before the real ones,
+// so every option works in it and the command line still wins.
+//
+// The live settings are a table of names over variables their owner keeps,
+// each with its type and range. settings_set parses, checks and stores a new
+// value and flags it changed; the owner takes the change when it's safe to
+// apply (the renderer's at the start of a frame, say). The console
+// (--console) reads stdin on a thread of its own and hands whole lines over,
+// to be run with settings_command on the thread that owns the values:
+// "NAME VALUE" sets, "NAME" shows, "list" shows them all.
+//
+// The console is only built into debug and profiling builds: with
+// SETTINGS_CONSOLE 0 (the default wherever NDEBUG is defined, unless
+// -DOPENGLTEST_SETTINGS_CONSOLE=ON, which the Profile preset sets) the app
+// doesn't offer it. The table itself is always there, for the config file's
+// values and for printing.
+
+#ifndef SETTINGS_CONSOLE
+#ifdef NDEBUG
+#define SETTINGS_CONSOLE 0
+#else
+#define SETTINGS_CONSOLE 1
+#endif
+#endif
+
+#define SETTINGS_MAX 32
+#define SETTINGS_CONSOLE_LINES 16       // typed and not yet taken; more are dropped
+#define SETTINGS_LINE_SIZE 256
+
+typedef enum SettingType
+{
+    SETTING_BOOL,           // on/off, true/false, yes/no or 1/0
+    SETTING_INT,
+    SETTING_FLOAT,
+    SETTING_CHOICE,         // one of "choices", stored as its index in an int
+} SettingType;
+
+typedef struct Setting
+{
+    const char* name;       // borrowed, usually a string literal
+    const char* help;
+    SettingType type;
+    void* value;            // bool*, int* or float*, the owner's
+    double min, max;        // INT and FLOAT
+    const char* const* choices;     // CHOICE
+    int choice_count;
+    bool changed;           // set since settings_take last returned true for it
+} Setting;
+
+typedef struct Settings
+{
+    Setting items[SETTINGS_MAX];
+    int count;
+} Settings;
+
+void settings_init(Settings* s);
+
+// Each adds a setting over "value" and returns its id, or -1 (logged) when the table is full
+int settings_add_bool(Settings* s, const char* name, bool* value, const char* help);
+int settings_add_int(Settings* s, const char* name, int* value, int min, int max, const char* help);
+int settings_add_float(Settings* s, const char* name, float* value, float min, float max, const char* help);
+int settings_add_choice(Settings* s, const char* name, int* value, const char* const* choices, int count,
+    const char* help);
+
+// The id of setting "name", -1 for none
+int settings_find(const Settings* s, const char* name);
+
+// Parses "text" for setting "id" and stores it when it's valid and in range. False, with why in "error", otherwise.
+bool settings_set(Settings* s, int id, const char* text, char* error, size_t size);
+
+// True, once, after setting "id" changed
+bool settings_take(Settings* s, int id);
+
+// Setting "id"'s value as text
+void settings_format(const Settings* s, int id, char* text, size_t size);
+
+// Runs one console line, answering on "out": "NAME VALUE" sets, "NAME" shows, "list" shows them all
+void settings_command(Settings* s, const char* line, FILE* out);
+
+// Every setting with its value, range and help
+void settings_print(const Settings* s, FILE* out);
+
+// Reads config file "path" as command-line arguments: "*args" gets a malloc'd array of "*count" strings, in one
+// block (free it). False, logged, when it can't be read.
+bool settings_read_args(const char* path, char*** args, int* count);
+
+// Lines typed on stdin, read on a thread of its own
+typedef struct SettingsConsole
+{
+    std::thread reader;
+    std::mutex mutex;
+    char lines[SETTINGS_CONSOLE_LINES][SETTINGS_LINE_SIZE];
+    int head;               // the oldest line not taken
+    int count;
+    bool running;
+} SettingsConsole;
+
+// Starts reading stdin; prints a prompt for the console's commands on "out"
+bool settings_console_start(SettingsConsole* c, FILE* out);
+
+// The oldest line typed and not taken yet, false for none
+bool settings_console_take(SettingsConsole* c, char* line, size_t size);
+
+// Lets the reader go: it can't be woken from a blocked read, so it's detached and ends with the process
+void settings_console_stop(SettingsConsole* c);
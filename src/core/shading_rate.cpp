@@ -0,0 +1,69 @@
+#include "core/shading_rate.h"
+
+#include <math.h>
+
+void shading_rate_defaults(ShadingRateSettings* s)
+{
+    s->centre[0] = s->centre[1] = 0.5f;
+    s->inner = 0.25f;
+    s->outer = 0.75f;
+    s->contrast = 0.1f;
+    s->motion = 8.f;
+}
+
+ShadingRate shading_rate_foveated(const ShadingRateSettings* s, float x, float y, int width, int height)
+{
+    const float dx = x - s->centre[0] * width, dy = y - s->centre[1] * height;
+    const float d = sqrtf(dx * dx + dy * dy) / (height > 0 ? height : 1);
+    if (d <= s->inner)
+        return SHADING_RATE_1X1;
+    if (d >= s->outer)
+        return (ShadingRate)(SHADING_RATE_COUNT - 1);
+    // The ring between them takes the rates in between in equal widths
+    const int step = 1 + (int)((d - s->inner) / (s->outer - s->inner) * (SHADING_RATE_COUNT - 2));
+    return (ShadingRate)(step < SHADING_RATE_COUNT - 2 ? step : SHADING_RATE_COUNT - 2);
+}
+
+ShadingRate shading_rate_adaptive(const ShadingRateSettings* s, ShadingRate foveated, float contrast, float motion)
+{
+    int rate = foveated;
+    const int flat = contrast >= s->contrast ? 0 : contrast >= 0.25f * s->contrast ? 1 : 2;
+    rate = flat > rate ? flat : rate;
+    rate += motion >= 4.f * s->motion ? 2 : motion >= s->motion ? 1 : 0;
+    return (ShadingRate)(rate < SHADING_RATE_COUNT - 1 ? rate : SHADING_RATE_COUNT - 1);
+}
+
+void shading_rate_fill(const ShadingRateSettings* s, int width, int height, int tile, uint8_t* rates)
+{
+    const int tiles_x = (width + tile - 1) / tile, tiles_y = (height + tile - 1) / tile;
+    for (int y = 0; y < tiles_y; ++y)
+        for (int x = 0; x < tiles_x; ++x)
+            rates[y * tiles_x + x] = (uint8_t)shading_rate_foveated(s, (x + 0.5f) * tile, (y + 0.5f) * tile, width, height);
+}
+
+float shading_rate_cost(ShadingRate rate)
+{
+    return 1.f / (float)(1 << rate);
+}
+
+float shading_rate_mean_cost(const uint8_t* rates, int count)
+{
+    if (count <= 0)
+        return 1.f;
+    double sum = 0.0;
+    for (int i = 0; i < count; ++i)
+        sum += shading_rate_cost((ShadingRate)rates[i]);
+    return (float)(sum / count);
+}
+
+void shading_rate_fovea(const ShadingRateSettings* s, int width, int height, int rect[4])
+{
+    const float r = s->inner * height;
+    const float cx = s->centre[0] * width, cy = s->centre[1] * height;
+    const int x0 = (int)floorf(cx - r) & ~1, y0 = (int)floorf(cy - r) & ~1;
+    const int x1 = ((int)ceilf(cx + r) + 1) & ~1, y1 = ((int)ceilf(cy + r) + 1) & ~1;
+    rect[0] = x0 > 0 ? x0 : 0;
+    rect[1] = y0 > 0 ? y0 : 0;
+    rect[2] = x1 < width ? x1 : width;
+    rect[3] = y1 < height ? y1 : height;
+}
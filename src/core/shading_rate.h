@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+// Variable-rate shading policy: how coarsely each tile of the view may be
+// shaded. Nothing here touches GL; gl/foveation.h turns the rates into an
+// NV shading rate image, or into a lower-resolution periphery where there is
+// none.
+//
+// Foveation is fixed: full rate within "inner" of the fovea's centre, the
+// coarsest rate past "outer", and the rates between stepping coarser across
+// the ring. Distances are in view heights, so the fovea is round on any
+// aspect ratio. The content-adaptive rate goes coarser still where it won't
+// be seen: a tile whose luma hardly varies (its relative contrast under
+// "contrast") gives up detail it doesn't have, and one moving at
+// "motion" pixels a frame or more is blurred by the motion anyway. It never
+// goes finer than the foveation allows.
+//
+// The GPU applies the same rule in gl/foveation.cpp's rate shader; a change
+// here goes there too.
+
+typedef enum ShadingRate
+{
+    SHADING_RATE_1X1,           // each step halves the invocations
+    SHADING_RATE_2X1,
+    SHADING_RATE_2X2,
+    SHADING_RATE_4X2,
+    SHADING_RATE_4X4,
+    SHADING_RATE_COUNT
+} ShadingRate;
+
+typedef struct ShadingRateSettings
+{
+    float centre[2];            // the fovea, as fractions of the view's width and height
+    float inner;                // full rate within this distance of it, in view heights
+    float outer;                // the coarsest rate from here out
+    float contrast;             // relative luma contrast under which a tile is shaded coarser
+    float motion;               // pixels a frame from which a tile is shaded a step coarser (two at four times it)
+} ShadingRateSettings;
+
+// The fovea in the middle, full rate within a quarter of the height, coarsest past three quarters
+void shading_rate_defaults(ShadingRateSettings* s);
+
+// The foveated rate at pixel (x, y) of a "width" x "height" view
+ShadingRate shading_rate_foveated(const ShadingRateSettings* s, float x, float y, int width, int height);
+
+// "foveated" made coarser for a tile whose luma spans "contrast" ((max - min) / max of the tonemapped luma) and
+// whose fastest pixel moved "motion" pixels since the last frame
+ShadingRate shading_rate_adaptive(const ShadingRateSettings* s, ShadingRate foveated, float contrast, float motion);
+
+// The foveated rates of a "width" x "height" view's tiles of "tile" pixels, row by row from the bottom, each taken
+// at its tile's centre: ceil(width / tile) x ceil(height / tile) of them
+void shading_rate_fill(const ShadingRateSettings* s, int width, int height, int tile, uint8_t* rates);
+
+// The fraction of a pixel's invocation a rate costs: 1, 1/2, 1/4, 1/8, 1/16
+float shading_rate_cost(ShadingRate rate);
+
+// Mean cost over "count" rates, each a ShadingRate
+float shading_rate_mean_cost(const uint8_t* rates, int count);
+
+// The full-rate inset drawn without a shading rate image: the box around the inner circle, clamped to the view
+// and grown to even pixels so it lands on whole pixels of a half-size periphery. rect is x0, y0, x1, y1 (exclusive).
+void shading_rate_fovea(const ShadingRateSettings* s, int width, int height, int rect[4]);
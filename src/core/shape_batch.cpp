@@ -0,0 +1,448 @@
+#include "core/shape_batch.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void shape_batch_init(ShapeBatch* batch)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->current = -1;
+}
+
+void shape_batch_destroy(ShapeBatch* batch)
+{
+    for (int i = 0; i < batch->bucket_count; ++i)
+    {
+        free(batch->buckets[i].vertices);
+        free(batch->buckets[i].indices);
+    }
+    free(batch->paths);
+    free(batch->path_vertices);
+    free(batch->path_indices);
+    free(batch->waves);
+    free(batch->path_order);
+    free(batch->cells);
+    shape_batch_init(batch);
+}
+
+void shape_batch_clear(ShapeBatch* batch)
+{
+    for (int i = 0; i < batch->bucket_count; ++i)
+        batch->buckets[i].vertex_count = batch->buckets[i].index_count = 0;
+    batch->current = -1;
+    batch->layer = 0;
+    batch->texture = 0;
+    batch->primitives = 0;
+    batch->dropped = 0;
+    batch->path_count = batch->path_vertex_count = batch->path_index_count = 0;
+    batch->path_flattens = 0;
+    batch->wave_count = 0;
+}
+
+void shape_batch_set_layer(ShapeBatch* batch, uint32_t layer)
+{
+    if (layer != batch->layer)
+        batch->current = -1;
+    batch->layer = layer;
+}
+
+void shape_batch_set_texture(ShapeBatch* batch, uint32_t texture)
+{
+    if (texture != batch->texture)
+        batch->current = -1;
+    batch->texture = texture;
+}
+
+// The current state's bucket, made the first time it's used
+static ShapeBucket* shape_batch_bucket(ShapeBatch* batch)
+{
+    if (batch->current >= 0)
+        return &batch->buckets[batch->current];
+    const uint64_t key = (uint64_t)batch->layer << 32 | batch->texture;
+    for (int i = 0; i < batch->bucket_count; ++i)
+        if (batch->buckets[i].key == key)
+        {
+            batch->current = i;
+            return &batch->buckets[i];
+        }
+    // A bucket emptied by a clear is reused for another state before a new one is made
+    for (int i = 0; i < batch->bucket_count; ++i)
+        if (!batch->buckets[i].vertex_count)
+        {
+            batch->buckets[i].key = key;
+            batch->current = i;
+            return &batch->buckets[i];
+        }
+    if (batch->bucket_count == SHAPE_BATCH_MAX_BUCKETS)
+        return NULL;
+    ShapeBucket* b = &batch->buckets[batch->bucket_count];
+    memset(b, 0, sizeof(*b));
+    b->key = key;
+    batch->current = batch->bucket_count++;
+    return b;
+}
+
+static bool grow(void** data, uint32_t* capacity, uint32_t needed, size_t element)
+{
+    if (needed <= *capacity)
+        return true;
+    uint32_t n = *capacity ? *capacity : 1024;
+    while (n < needed)
+        n *= 2;
+    void* p = realloc(*data, n * element);
+    if (!p)
+        return false;
+    *data = p;
+    *capacity = n;
+    return true;
+}
+
+// Room for one primitive in the current bucket: its vertices, its indices in *indices, and the index of its first
+// vertex in *base. NULL (counted as dropped) when there's none.
+static ShapeVertex* shape_batch_reserve(ShapeBatch* batch, uint32_t vertices, uint32_t indices, uint32_t** index_out,
+    uint32_t* base)
+{
+    ShapeBucket* b = shape_batch_bucket(batch);
+    if (!b || !grow((void**)&b->vertices, &b->vertex_capacity, b->vertex_count + vertices, sizeof(ShapeVertex))
+        || !grow((void**)&b->indices, &b->index_capacity, b->index_count + indices, sizeof(uint32_t)))
+    {
+        ++batch->dropped;
+        return NULL;
+    }
+    ShapeVertex* v = b->vertices + b->vertex_count;
+    *index_out = b->indices + b->index_count;
+    *base = b->vertex_count;
+    b->vertex_count += vertices;
+    b->index_count += indices;
+    ++batch->primitives;
+    return v;
+}
+
+static inline void put_vertex(ShapeVertex* v, float x, float y, uint32_t color, uint16_t u, uint16_t t)
+{
+    v->pos[0] = x;
+    v->pos[1] = y;
+    v->color = color;
+    v->uv[0] = u;
+    v->uv[1] = t;
+}
+
+static inline uint16_t unorm16(float f)
+{
+    return (uint16_t)(f <= 0.f ? 0 : f >= 1.f ? 65535 : (int)(f * 65535.f + 0.5f));
+}
+
+// Four corners, in order around the quad, as two triangles
+static void put_quad(ShapeBatch* batch, const float* x, const float* y, const uint16_t* u, const uint16_t* t,
+    uint32_t color)
+{
+    uint32_t* i;
+    uint32_t base;
+    ShapeVertex* v = shape_batch_reserve(batch, 4, 6, &i, &base);
+    if (!v)
+        return;
+    for (int k = 0; k < 4; ++k)
+        put_vertex(v + k, x[k], y[k], color, u[k], t[k]);
+    i[0] = base;
+    i[1] = base + 1;
+    i[2] = base + 2;
+    i[3] = base;
+    i[4] = base + 2;
+    i[5] = base + 3;
+}
+
+void shape_batch_triangle(ShapeBatch* batch, float x0, float y0, float x1, float y1, float x2, float y2, uint32_t color)
+{
+    uint32_t* i;
+    uint32_t base;
+    ShapeVertex* v = shape_batch_reserve(batch, 3, 3, &i, &base);
+    if (!v)
+        return;
+    put_vertex(v, x0, y0, color, 0, 0);
+    put_vertex(v + 1, x1, y1, color, 0, 0);
+    put_vertex(v + 2, x2, y2, color, 0, 0);
+    i[0] = base;
+    i[1] = base + 1;
+    i[2] = base + 2;
+}
+
+void shape_batch_rect(ShapeBatch* batch, float x, float y, float width, float height, uint32_t color)
+{
+    const float xs[4] = { x, x + width, x + width, x };
+    const float ys[4] = { y, y, y + height, y + height };
+    static const uint16_t zero[4] = { 0, 0, 0, 0 };
+    put_quad(batch, xs, ys, zero, zero, color);
+}
+
+void shape_batch_sprite(ShapeBatch* batch, float x, float y, float width, float height, float u0, float v0, float u1,
+    float v1, uint32_t color)
+{
+    const float xs[4] = { x, x + width, x + width, x };
+    const float ys[4] = { y, y, y + height, y + height };
+    const uint16_t us[4] = { unorm16(u0), unorm16(u1), unorm16(u1), unorm16(u0) };
+    const uint16_t vs[4] = { unorm16(v0), unorm16(v0), unorm16(v1), unorm16(v1) };
+    put_quad(batch, xs, ys, us, vs, color);
+}
+
+void shape_batch_line(ShapeBatch* batch, float x0, float y0, float x1, float y1, float width, uint32_t color)
+{
+    const float dx = x1 - x0, dy = y1 - y0;
+    const float length = sqrtf(dx * dx + dy * dy);
+    if (!(length > 0.f))
+        return;
+    const float nx = -dy / length * 0.5f * width, ny = dx / length * 0.5f * width;    // half the width, across it
+    const float xs[4] = { x0 + nx, x1 + nx, x1 - nx, x0 - nx };
+    const float ys[4] = { y0 + ny, y1 + ny, y1 - ny, y0 - ny };
+    static const uint16_t zero[4] = { 0, 0, 0, 0 };
+    put_quad(batch, xs, ys, zero, zero, color);
+}
+
+void shape_batch_circle(ShapeBatch* batch, float x, float y, float radius, uint32_t color)
+{
+    int segments = (int)ceilf(6.2831853f * radius / SHAPE_BATCH_CIRCLE_STEP);
+    segments = segments < 8 ? 8 : segments > SHAPE_BATCH_CIRCLE_MAX ? SHAPE_BATCH_CIRCLE_MAX : segments;
+    uint32_t* i;
+    uint32_t base;
+    ShapeVertex* v = shape_batch_reserve(batch, segments + 1, 3 * segments, &i, &base);
+    if (!v)
+        return;
+    // The ring by repeated rotation: one sin and cos per circle instead of per vertex
+    const float c = cosf(6.2831853f / segments), s = sinf(6.2831853f / segments);
+    float ox = radius, oy = 0.f;
+    put_vertex(v, x, y, color, 0, 0);
+    for (int k = 0; k < segments; ++k)
+    {
+        put_vertex(v + 1 + k, x + ox, y + oy, color, 0, 0);
+        const float nx = ox * c - oy * s;
+        oy = ox * s + oy * c;
+        ox = nx;
+        i[3 * k] = base;
+        i[3 * k + 1] = base + 1 + k;
+        i[3 * k + 2] = base + 1 + (k + 1) % segments;
+    }
+}
+
+// Room for a path of "vertices" corners and "indices" indices, and its cover quad's 4 corners after them. NULL
+// (counted as dropped) when there's none.
+static ShapePath* shape_batch_reserve_path(ShapeBatch* batch, uint32_t vertices, uint32_t indices)
+{
+    if (!grow((void**)&batch->paths, &batch->path_capacity, batch->path_count + 1, sizeof(ShapePath))
+        || !grow((void**)&batch->path_vertices, &batch->path_vertex_capacity, batch->path_vertex_count + vertices + 4,
+            sizeof(ShapeVertex))
+        || !grow((void**)&batch->path_indices, &batch->path_index_capacity, batch->path_index_count + indices,
+            sizeof(uint32_t)))
+    {
+        ++batch->dropped;
+        return NULL;
+    }
+    ShapePath* p = &batch->paths[batch->path_count++];
+    p->layer = batch->layer;
+    p->first_index = batch->path_index_count;
+    p->index_count = indices;
+    p->cover = batch->path_vertex_count + vertices;
+    batch->path_index_count += indices;
+    batch->path_vertex_count += vertices + 4;
+    return p;
+}
+
+// How much "transform" magnifies the path at most: its longer axis
+static inline float transform_scale(const float* t)
+{
+    return t ? sqrtf(fmaxf(t[0] * t[0] + t[1] * t[1], t[2] * t[2] + t[3] * t[3])) : 1.f;
+}
+
+static inline int32_t path_cell(float pixels)
+{
+    const int32_t c = (int32_t)floorf(pixels / SHAPE_BATCH_PATH_CELL);
+    return c < 0 ? 0 : c >= SHAPE_BATCH_PATH_GRID ? SHAPE_BATCH_PATH_GRID - 1 : c;
+}
+
+// The path's "count" corners from "xy" through "transform" into its vertices, white or clear; then its cover quad
+// over their bounds, out to whole pixels, in "color" with "rule" in u
+static void shape_batch_put_path(ShapePath* p, ShapeVertex* v, const float* xy, uint32_t count, const float* t,
+    uint32_t corner_color, uint32_t color, ShapeFillRule rule)
+{
+    float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+    for (uint32_t i = 0; i < count; ++i, xy += 2)
+    {
+        const float x = t ? t[0] * xy[0] + t[2] * xy[1] + t[4] : xy[0];
+        const float y = t ? t[1] * xy[0] + t[3] * xy[1] + t[5] : xy[1];
+        put_vertex(v + i, x, y, corner_color, 0, 0);
+        x0 = fminf(x0, x);
+        y0 = fminf(y0, y);
+        x1 = fmaxf(x1, x);
+        y1 = fmaxf(y1, y);
+    }
+    x0 = floorf(x0);
+    y0 = floorf(y0);
+    x1 = ceilf(x1);
+    y1 = ceilf(y1);
+    const uint16_t u = rule == SHAPE_FILL_EVEN_ODD ? 65535 : 0;
+    ShapeVertex* cover = v + count;
+    put_vertex(cover, x0, y0, color, u, 0);
+    put_vertex(cover + 1, x1, y0, color, u, 0);
+    put_vertex(cover + 2, x1, y1, color, u, 0);
+    put_vertex(cover + 3, x0, y1, color, u, 0);
+    p->cells[0] = path_cell(x0);
+    p->cells[1] = path_cell(y0);
+    p->cells[2] = path_cell(x1);
+    p->cells[3] = path_cell(y1);
+}
+
+void shape_batch_fill_path(ShapeBatch* batch, VectorPath* path, const float* transform, uint32_t color,
+    ShapeFillRule rule)
+{
+    const float scale = transform_scale(transform);
+    const uint32_t flattens = path->flattens;
+    if (!(scale > 0.f) || !vector_path_flatten(path, SHAPE_BATCH_PATH_TOLERANCE / scale))
+        return;
+    batch->path_flattens += path->flattens - flattens;
+
+    // A fan from the first point to every edge but the two that touch it
+    uint32_t edges = 0;
+    for (uint32_t c = 0, first = 0; c < path->contour_count; first = path->contour_ends[c++])
+        edges += path->contour_ends[c] - first;
+    if (path->contour_count == 0 || edges < 3)
+        return;
+    ShapePath* p = shape_batch_reserve_path(batch, path->flat_count, 3 * (edges - 2));
+    if (!p)
+        return;
+    const uint32_t base = p->cover - path->flat_count;
+    shape_batch_put_path(p, batch->path_vertices + base, path->flat, path->flat_count, transform, 0u, color, rule);
+    uint32_t* i = batch->path_indices + p->first_index;
+    for (uint32_t c = 0, first = 0; c < path->contour_count; first = path->contour_ends[c++])
+        for (uint32_t a = first, end = path->contour_ends[c]; a < end; ++a)
+        {
+            const uint32_t b = a + 1 < end ? a + 1 : first;
+            if (a == 0 || b == 0)
+                continue;
+            i[0] = base;
+            i[1] = base + a;
+            i[2] = base + b;
+            i += 3;
+        }
+}
+
+void shape_batch_stroke_path(ShapeBatch* batch, VectorPath* path, const float* transform, float width,
+    VectorJoin join, uint32_t color)
+{
+    const float scale = transform_scale(transform);
+    const uint32_t flattens = path->flattens;
+    if (!(scale > 0.f) || !vector_path_stroke(path, width, join, SHAPE_BATCH_PATH_TOLERANCE / scale))
+        return;
+    batch->path_flattens += path->flattens - flattens;
+    if (!path->stroke_count)
+        return;
+    ShapePath* p = shape_batch_reserve_path(batch, path->stroke_count, path->stroke_index_count);
+    if (!p)
+        return;
+    const uint32_t base = p->cover - path->stroke_count;
+    shape_batch_put_path(p, batch->path_vertices + base, path->stroke, path->stroke_count, transform, 0xFFFFFFFFu,
+        color, SHAPE_FILL_NONZERO);
+    uint32_t* i = batch->path_indices + p->first_index;
+    for (uint32_t k = 0; k < path->stroke_index_count; ++k)
+        i[k] = base + path->stroke_indices[k];
+}
+
+static int compare_keys(const void* a, const void* b)
+{
+    const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+uint32_t shape_batch_path_waves(ShapeBatch* batch)
+{
+    batch->wave_count = 0;
+    uint32_t capacity = batch->wave_capacity;   // the two arrays grow alike
+    if (!batch->path_count
+        || !grow((void**)&batch->waves, &capacity, batch->path_count, sizeof(ShapePathWave))
+        || !grow((void**)&batch->path_order, &batch->wave_capacity, batch->path_count, sizeof(uint64_t)))
+        return 0;
+    if (!batch->cells)
+    {
+        batch->cells = (uint32_t*)calloc((size_t)2 * SHAPE_BATCH_PATH_GRID * SHAPE_BATCH_PATH_GRID, sizeof(uint32_t));
+        if (!batch->cells)
+            return 0;
+    }
+    for (uint32_t k = 0; k < batch->path_count; ++k)
+        batch->path_order[k] = (uint64_t)batch->paths[k].layer << 32 | k;
+    qsort(batch->path_order, batch->path_count, sizeof(uint64_t), compare_keys);
+
+    for (uint32_t first = 0, end; first < batch->path_count; first = end)
+    {
+        const uint32_t layer = (uint32_t)(batch->path_order[first] >> 32);
+        for (end = first; end < batch->path_count && (uint32_t)(batch->path_order[end] >> 32) == layer; ++end)
+            ;
+        // A new mark for the layer; once the marks wrap, the grid starts over
+        if (++batch->cell_mark == 0)
+        {
+            memset(batch->cells, 0, sizeof(uint32_t) * 2 * SHAPE_BATCH_PATH_GRID * SHAPE_BATCH_PATH_GRID);
+            batch->cell_mark = 1;
+        }
+        // Each path after the last wave to take any of its cells, then its cells taken to its own wave
+        for (uint32_t k = first; k < end; ++k)
+        {
+            const uint32_t index = (uint32_t)batch->path_order[k];
+            ShapePath* p = &batch->paths[index];
+            uint32_t wave = 0;
+            for (int32_t y = p->cells[1]; y <= p->cells[3]; ++y)
+                for (int32_t x = p->cells[0]; x <= p->cells[2]; ++x)
+                {
+                    const uint32_t* cell = batch->cells + 2 * (y * SHAPE_BATCH_PATH_GRID + x);
+                    if (cell[0] == batch->cell_mark && cell[1] > wave)
+                        wave = cell[1];
+                }
+            for (int32_t y = p->cells[1]; y <= p->cells[3]; ++y)
+                for (int32_t x = p->cells[0]; x <= p->cells[2]; ++x)
+                {
+                    uint32_t* cell = batch->cells + 2 * (y * SHAPE_BATCH_PATH_GRID + x);
+                    cell[0] = batch->cell_mark;
+                    cell[1] = wave + 1;
+                }
+            batch->path_order[k] = (uint64_t)wave << 32 | index;
+        }
+        // The layer's paths by wave, each wave's in the order they came
+        qsort(batch->path_order + first, end - first, sizeof(uint64_t), compare_keys);
+        for (uint32_t k = first; k < end; ++k)
+        {
+            const ShapePath* p = &batch->paths[(uint32_t)batch->path_order[k]];
+            ShapePathWave* w = &batch->waves[batch->wave_count - 1];
+            if (k == first || batch->path_order[k] >> 32 != batch->path_order[k - 1] >> 32)
+            {
+                w = &batch->waves[batch->wave_count++];
+                w->layer = layer;
+                w->first = k;
+                w->count = w->index_count = 0;
+            }
+            ++w->count;
+            w->index_count += p->index_count;
+        }
+    }
+    return batch->wave_count;
+}
+
+int shape_batch_order(const ShapeBatch* batch, int* order)
+{
+    int count = 0;
+    for (int b = 0; b < batch->bucket_count; ++b)
+    {
+        if (!batch->buckets[b].index_count)
+            continue;
+        int k = count++;
+        for (; k > 0 && batch->buckets[order[k - 1]].key > batch->buckets[b].key; --k)
+            order[k] = order[k - 1];
+        order[k] = b;
+    }
+    return count;
+}
+
+void shape_batch_totals(const ShapeBatch* batch, uint32_t* vertices, uint32_t* indices)
+{
+    *vertices = *indices = 0;
+    for (int b = 0; b < batch->bucket_count; ++b)
+    {
+        *vertices += batch->buckets[b].vertex_count;
+        *indices += batch->buckets[b].index_count;
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "core/vector_path.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Immediate-mode 2D batching: triangles, rectangles, lines, circles and
+// sprites appended in any order, drawn in as few draws as their state allows.
+//
+// The state is a layer and a texture (0 for none: a white texel). Each state
+// has a bucket of its own vertices and indices, so appending is a copy into
+// the current bucket and the sort at the end is over buckets, not
+// primitives: a frame of 200k shapes in three layers is three buckets and
+// three draws. Within a bucket primitives keep the order they came in, and
+// layers draw in increasing order, so a later layer is on top.
+//
+// Everything becomes indexed triangles. A line is a quad of its width, a
+// circle a fan with a segment about every SHAPE_BATCH_CIRCLE_STEP pixels of
+// its outline (between 8 and SHAPE_BATCH_CIRCLE_MAX), so a dot is a few
+// triangles and a gauge stays round. Positions are in pixels from the
+// top-left corner. Nothing here calls GL: gl/shape_renderer.h draws a batch.
+//
+// Vector paths (core/vector_path.h) go in beside them, filled or stroked
+// through a transform. Each becomes its flattening's triangles, moved into
+// pixels (the fan of a fill, the widened outline of a stroke), and a cover
+// quad over its bounds; the renderer counts the triangles' windings and
+// colours what the cover finds inside. A layer's paths draw after its other
+// primitives, in waves: each path goes in the wave after the last one
+// holding a path its bounds share a SHAPE_BATCH_PATH_CELL cell with (the
+// first, when none does), so paths that overlap keep their order and the
+// rest draw together. A wave is two draws however many paths it holds: a
+// wall of gauges, each a dial, an arc and a needle over one another, is
+// three waves.
+
+#define SHAPE_BATCH_MAX_BUCKETS 64          // distinct layer and texture pairs in one frame; more are dropped
+#define SHAPE_BATCH_CIRCLE_STEP 4.f         // pixels of outline per segment
+#define SHAPE_BATCH_CIRCLE_MAX 64
+#define SHAPE_BATCH_PATH_TOLERANCE 0.2f     // pixels a flattened curve may stray from the true one
+#define SHAPE_BATCH_PATH_CELL 16            // pixels a side of the cells waves keep apart in
+#define SHAPE_BATCH_PATH_GRID 256           // cells a side; paths past 4096 pixels share the edge cells
+
+// 16 bytes: the scene's vPos and vCol (as RGBA8, red in the low byte) and a UNORM16 texture coordinate
+typedef struct ShapeVertex
+{
+    float pos[2];
+    uint32_t color;
+    uint16_t uv[2];
+} ShapeVertex;
+
+typedef struct ShapeBucket
+{
+    uint64_t key;                   // layer << 32 | texture: the draw order
+    ShapeVertex* vertices;
+    uint32_t* indices;              // into the bucket's own vertices
+    uint32_t vertex_count, vertex_capacity;
+    uint32_t index_count, index_capacity;
+} ShapeBucket;
+
+typedef enum ShapeFillRule
+{
+    SHAPE_FILL_NONZERO,         // inside wherever the outline winds around at all
+    SHAPE_FILL_EVEN_ODD         // inside wherever it winds an odd number of times
+} ShapeFillRule;
+
+typedef struct ShapePath
+{
+    uint32_t layer;
+    uint32_t first_index, index_count;  // its triangles, in path_indices
+    uint32_t cover;                 // its cover quad's first corner, in path_vertices
+    int32_t cells[4];               // its bounds in cells, x0, y0, x1, y1, inclusive
+} ShapePath;
+
+// Paths of one layer whose bounds keep apart, drawn together
+typedef struct ShapePathWave
+{
+    uint32_t layer;
+    uint32_t first, count;          // its paths, in path_order
+    uint32_t index_count;           // its paths' triangles' indices
+} ShapePathWave;
+
+typedef struct ShapeBatch
+{
+    ShapeBucket buckets[SHAPE_BATCH_MAX_BUCKETS];
+    int bucket_count;               // made so far; kept with their memory across shape_batch_clear
+    int current;                    // the bucket of the current state, -1 until one is needed
+    uint32_t layer;
+    uint32_t texture;
+    uint32_t primitives;            // appended since the last clear
+    uint32_t dropped;               // primitives lost to a full bucket table or a failed allocation
+
+    // Paths, as appended. A triangle's corners carry the fill's rule in their colour: 0 counts the triangle by
+    // its facing, white counts it whatever it faces (a stroke's); a cover quad's carry the path's colour and,
+    // in u, 1 for the even-odd rule.
+    ShapePath* paths;
+    ShapeVertex* path_vertices;     // each path's triangles' corners, then its cover quad's
+    uint32_t* path_indices;         // its triangles, into path_vertices
+    uint32_t path_count, path_capacity;
+    uint32_t path_vertex_count, path_vertex_capacity;
+    uint32_t path_index_count, path_index_capacity;
+    uint32_t path_flattens;         // paths flattened or stroked anew since the last clear: cache misses
+
+    // shape_batch_path_waves'
+    ShapePathWave* waves;           // room for a wave a path
+    uint64_t* path_order;           // wave in its layer << 32 | path, in draw order
+    uint32_t wave_count, wave_capacity;
+    uint32_t* cells;                // SHAPE_BATCH_PATH_GRID squared pairs: the layer's mark, 1 + the last wave in it
+    uint32_t cell_mark;             // layers sorted into waves, over the run: the current one's mark in "cells"
+} ShapeBatch;
+
+void shape_batch_init(ShapeBatch* batch);
+void shape_batch_destroy(ShapeBatch* batch);
+
+// Empties every bucket and resets the state to layer 0, untextured; their memory is kept for the next frame
+void shape_batch_clear(ShapeBatch* batch);
+
+// The state the following primitives are drawn with
+void shape_batch_set_layer(ShapeBatch* batch, uint32_t layer);
+void shape_batch_set_texture(ShapeBatch* batch, uint32_t texture);
+
+void shape_batch_triangle(ShapeBatch* batch, float x0, float y0, float x1, float y1, float x2, float y2, uint32_t color);
+void shape_batch_rect(ShapeBatch* batch, float x, float y, float width, float height, uint32_t color);
+void shape_batch_line(ShapeBatch* batch, float x0, float y0, float x1, float y1, float width, uint32_t color);
+void shape_batch_circle(ShapeBatch* batch, float x, float y, float radius, uint32_t color);
+
+// A rectangle of the current texture from u0, v0 to u1, v1 (0 to 1), tinted by "color"
+void shape_batch_sprite(ShapeBatch* batch, float x, float y, float width, float height, float u0, float v0, float u1,
+    float v1, uint32_t color);
+
+// A path's outline, flattened for its size on screen, through "transform" (x' = t0 x + t2 y + t4, y' = t1 x + t3 y +
+// t5, NULL for none) into pixels. The path keeps its flattening, and its stroke, for the next time it's drawn.
+void shape_batch_fill_path(ShapeBatch* batch, VectorPath* path, const float* transform, uint32_t color,
+    ShapeFillRule rule);
+
+// "width" is in the path's units, so it scales with the transform
+void shape_batch_stroke_path(ShapeBatch* batch, VectorPath* path, const float* transform, float width,
+    VectorJoin join, uint32_t color);
+
+// Sorts the paths into waves, in draw order: by layer, then each path in the wave after the last one to take any of
+// its cells. Returns how many, in batch->waves.
+uint32_t shape_batch_path_waves(ShapeBatch* batch);
+
+// The buckets with anything in them, in draw order, into "order"; returns how many
+int shape_batch_order(const ShapeBatch* batch, int* order);
+
+// Totals over the buckets
+void shape_batch_totals(const ShapeBatch* batch, uint32_t* vertices, uint32_t* indices);
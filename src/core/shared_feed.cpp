@@ -0,0 +1,194 @@
+#include "core/shared_feed.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define PAGE 4096
+
+static bool name_feed(SharedFeed* feed, const char* name)
+{
+    for (const char* c = name; *c; ++c)
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '-'
+            || *c == '_'))
+            return false;
+#ifdef _WIN32
+    const int n = snprintf(feed->name, sizeof(feed->name), "Local\\opengltest-feed-%s", name);
+#else
+    const int n = snprintf(feed->name, sizeof(feed->name), "/opengltest-feed-%s", name);
+#endif
+    return *name && n > 0 && n < (int)sizeof(feed->name);
+}
+
+static size_t slot_bytes(uint32_t capacity)
+{
+    return ((size_t)capacity * sizeof(FeedPoint) + PAGE - 1) & ~(size_t)(PAGE - 1);
+}
+
+static void* map_feed(SharedFeed* feed, bool create, size_t size)
+{
+#ifdef _WIN32
+    const DWORD high = (DWORD)((uint64_t)size >> 32), low = (DWORD)size;
+    HANDLE mapping = create ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, high, low, feed->name)
+        : OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, feed->name);
+    if (!mapping)
+        return NULL;
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return NULL;
+    }
+    feed->mapping = mapping;
+    return data;
+#else
+    const int fd = create ? shm_open(feed->name, O_CREAT | O_EXCL | O_RDWR, 0600) : shm_open(feed->name, O_RDWR, 0);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if ((create && ftruncate(fd, (off_t)size) != 0) || fstat(fd, &st) != 0 || (size_t)st.st_size < size)
+    {
+        close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);      // the mapping keeps the object
+    return data == MAP_FAILED ? NULL : data;
+#endif
+}
+
+static void unmap_feed(SharedFeed* feed)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(feed->header);
+    CloseHandle((HANDLE)feed->mapping);
+#else
+    munmap(feed->header, feed->size);
+#endif
+}
+
+bool shared_feed_create(SharedFeed* feed, const char* name, uint32_t capacity)
+{
+    memset(feed, 0, sizeof(*feed));
+    if (!name_feed(feed, name) || !capacity)
+    {
+        fprintf(stderr, "shared_feed: \"%s\" for %u points isn't a feed\n", name, capacity);
+        return false;
+    }
+    feed->slot_bytes = slot_bytes(capacity);
+    feed->size = SHARED_FEED_HEADER_BYTES + feed->slot_bytes * SHARED_FEED_SLOTS;
+#ifndef _WIN32
+    shm_unlink(feed->name);     // one a producer that crashed left behind
+#endif
+    void* data = map_feed(feed, true, feed->size);
+    if (!data)
+    {
+        fprintf(stderr, "shared_feed: can't create %s of %.1f MB\n", feed->name, feed->size / 1048576.0);
+        memset(feed, 0, sizeof(*feed));
+        return false;
+    }
+    feed->header = (SharedFeedHeader*)data;
+    feed->slots = (uint8_t*)data + SHARED_FEED_HEADER_BYTES;
+    feed->producer = true;
+
+    // The consumer starts on slot 0 (empty) and the producer on 1, slot 2 between them; the magic goes in last
+    SharedFeedHeader* h = feed->header;
+    h->version = SHARED_FEED_VERSION;
+    h->capacity = capacity;
+    h->point_size = sizeof(FeedPoint);
+    h->closed.store(0, std::memory_order_relaxed);
+    h->front = 0;
+    h->back = 1;
+    h->ready.store(2, std::memory_order_relaxed);
+    h->published = 0;
+    h->magic.store(SHARED_FEED_MAGIC, std::memory_order_release);
+    return true;
+}
+
+bool shared_feed_open(SharedFeed* feed, const char* name)
+{
+    memset(feed, 0, sizeof(*feed));
+    if (!name_feed(feed, name))
+        return false;
+    feed->size = SHARED_FEED_HEADER_BYTES;
+    void* data = map_feed(feed, false, feed->size);
+    if (!data)
+        return false;
+    feed->header = (SharedFeedHeader*)data;
+    const SharedFeedHeader* h = feed->header;
+    const bool ready = h->magic.load(std::memory_order_acquire) == SHARED_FEED_MAGIC;
+    const bool ours = ready && h->version == SHARED_FEED_VERSION && h->point_size == sizeof(FeedPoint);
+    const uint32_t capacity = h->capacity;
+    if (ready && !ours)
+        fprintf(stderr, "shared_feed: %s is version %u with %u-byte points, not %u with %zu\n", feed->name,
+            h->version, h->point_size, SHARED_FEED_VERSION, sizeof(FeedPoint));
+    unmap_feed(feed);
+    if (!ours)
+    {
+        memset(feed, 0, sizeof(*feed));
+        return false;
+    }
+
+    // The header says how big the slots are: map the whole of it again
+    feed->slot_bytes = slot_bytes(capacity);
+    feed->size = SHARED_FEED_HEADER_BYTES + feed->slot_bytes * SHARED_FEED_SLOTS;
+    data = map_feed(feed, false, feed->size);
+    if (!data)
+    {
+        fprintf(stderr, "shared_feed: can't map %s's %.1f MB\n", feed->name, feed->size / 1048576.0);
+        memset(feed, 0, sizeof(*feed));
+        return false;
+    }
+    feed->header = (SharedFeedHeader*)data;
+    feed->slots = (uint8_t*)data + SHARED_FEED_HEADER_BYTES;
+    return true;
+}
+
+void shared_feed_close(SharedFeed* feed)
+{
+    if (!feed->header)
+        return;
+    if (feed->producer)
+    {
+        feed->header->closed.store(1, std::memory_order_release);
+#ifndef _WIN32
+        shm_unlink(feed->name);     // a consumer's mapping outlives the name
+#endif
+    }
+    unmap_feed(feed);
+    memset(feed, 0, sizeof(*feed));
+}
+
+void shared_feed_publish(SharedFeed* feed, uint32_t count, uint64_t frame)
+{
+    SharedFeedHeader* h = feed->header;
+    h->counts[h->back] = count < h->capacity ? count : h->capacity;
+    h->frames[h->back] = frame;
+    h->serials[h->back] = ++h->published;
+    h->back = h->ready.exchange(h->back | SHARED_FEED_FRESH, std::memory_order_acq_rel) & 3u;
+}
+
+bool shared_feed_acquire(SharedFeed* feed, const FeedPoint** points, uint32_t* count, uint64_t* frame)
+{
+    SharedFeedHeader* h = feed->header;
+    if (shared_feed_closed(feed) || !(h->ready.load(std::memory_order_relaxed) & SHARED_FEED_FRESH))
+        return false;
+    h->front = h->ready.exchange(h->front, std::memory_order_acq_rel) & 3u;
+    const uint64_t serial = h->serials[h->front];
+    feed->skipped += serial - feed->acquired - 1;
+    feed->acquired = serial;
+    *points = (const FeedPoint*)(feed->slots + feed->slot_bytes * h->front);
+    *count = h->counts[h->front];
+    *frame = h->frames[h->front];
+    return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Points pushed into the renderer by another process through shared memory:
+// a simulator writes a frame's positions where the renderer reads them, with
+// no socket and no copy between the two.
+//
+// The producer creates the feed under a name (shared_feed_create) and the
+// renderer opens it (shared_feed_open); it's a named shared-memory object
+// (shm_open / CreateFileMapping) of a header and SHARED_FEED_SLOTS slots of
+// "capacity" FeedPoints each. The slots are a triple buffer: the producer
+// owns one and writes its frame there, the consumer owns another and reads
+// its frame from there, and the third sits between them. Publishing swaps
+// the producer's slot with the one between, marked fresh; acquiring swaps
+// the consumer's with it when it's fresh. Both are one atomic exchange, so
+// neither side ever waits on the other: a producer running ahead overwrites
+// frames the consumer never saw, and a consumer running ahead keeps the
+// frame it has. A frame acquired stays whole until the next acquire.
+//
+// A FeedPoint is laid out as the renderer's vertices for it (three floats,
+// then RGBA8), so a frame is copied straight from its slot into the
+// persistently mapped stream buffer it's drawn from (gl/feed_renderer.h).
+//
+// Both sides must be built for the same architecture: the header's atomics
+// are shared as they are.
+
+#define SHARED_FEED_SLOTS 3
+#define SHARED_FEED_MAGIC 0x44454546u       // "FEED"
+#define SHARED_FEED_VERSION 1u
+#define SHARED_FEED_HEADER_BYTES 4096       // the slots start a page in
+#define SHARED_FEED_FRESH 4u                // in "ready": published since the consumer last took it
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+    "the feed's header is shared between processes, so its atomics must not hide a lock");
+
+typedef struct FeedPoint
+{
+    float pos[3];
+    uint32_t color;                 // RGBA8, red in the low byte
+} FeedPoint;
+
+typedef struct SharedFeedHeader
+{
+    std::atomic<uint32_t> magic;    // SHARED_FEED_MAGIC, set last once the rest is
+    uint32_t version;
+    uint32_t capacity;              // points a slot holds
+    uint32_t point_size;            // sizeof(FeedPoint)
+    std::atomic<uint32_t> ready;    // the slot between the two, | SHARED_FEED_FRESH
+    std::atomic<uint32_t> closed;   // the producer is gone: the consumer lets go and looks again
+    uint32_t back;                  // the producer's slot
+    uint32_t front;                 // the consumer's, kept here so a restarted consumer takes it back
+    uint32_t counts[SHARED_FEED_SLOTS];     // points in each slot's frame
+    uint32_t reserved;
+    uint64_t frames[SHARED_FEED_SLOTS];     // the producer's number for each slot's frame
+    uint64_t serials[SHARED_FEED_SLOTS];    // and its place among those published, from 1
+    uint64_t published;             // frames published
+} SharedFeedHeader;
+
+typedef struct SharedFeed
+{
+    SharedFeedHeader* header;       // NULL when not open
+    uint8_t* slots;
+    size_t slot_bytes;              // a slot's stride, page-rounded
+    size_t size;                    // bytes mapped
+    bool producer;
+    uint64_t acquired;              // the consumer: its last frame's serial, to count the ones skipped
+    uint64_t skipped;               // the consumer: frames published it never saw, before it opened the feed too
+    char name[64];                  // the system's name for it
+#ifdef _WIN32
+    void* mapping;                  // HANDLE
+#endif
+} SharedFeed;
+
+// The producer: creates feed "name" (letters, digits, '-' and '_') with room for "capacity" points a frame,
+// replacing any left behind by a producer that didn't close it. Logs and returns false when it can't.
+bool shared_feed_create(SharedFeed* feed, const char* name, uint32_t capacity);
+
+// The consumer: opens feed "name". Returns false, quietly, while there's none by that name (or it's still being set
+// up); logs one that isn't this version's.
+bool shared_feed_open(SharedFeed* feed, const char* name);
+
+// Unmaps; the producer's close also marks the feed closed and removes the name. Safe on a feed that didn't open.
+void shared_feed_close(SharedFeed* feed);
+
+// The producer: its slot, to write up to "capacity" points of the next frame into
+static inline FeedPoint* shared_feed_points(SharedFeed* feed)
+{
+    return (FeedPoint*)(feed->slots + feed->slot_bytes * feed->header->back);
+}
+
+// The producer: the first "count" points of its slot are frame "frame". Takes another slot for the next.
+void shared_feed_publish(SharedFeed* feed, uint32_t count, uint64_t frame);
+
+// The consumer: takes the newest frame published since its last one. Returns false when there's none newer, or
+// when the producer has closed the feed (shared_feed_closed). The points stay as they are until the next acquire.
+bool shared_feed_acquire(SharedFeed* feed, const FeedPoint** points, uint32_t* count, uint64_t* frame);
+
+static inline bool shared_feed_closed(const SharedFeed* feed)
+{
+    return feed->header->closed.load(std::memory_order_acquire) != 0;
+}
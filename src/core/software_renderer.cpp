@@ -0,0 +1,601 @@
+#include "core/software_renderer.h"
+
+#include "core/job_system.h"
+#include "linmath_batch.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SETUP_GRAIN 1           // chunks per job
+#define RASTER_GRAIN 4          // tiles per job
+#define MIN_TRIANGLES 256       // a chunk's first allocation
+#define CLIP_PLANES 5           // the near plane and the guard band's four sides
+#define CLIP_VERTICES (3 + CLIP_PLANES)
+#define SUBPIXEL ((float)(1 << SOFTWARE_SUBPIXEL_BITS))
+
+struct SoftwareTriangle
+{
+    // Edge k, opposite vertex k: dx (py - oy) - dy (px - ox) at pixel centre (px, py), > 0 inside. (ox, oy) is
+    // whichever end of the edge sorts first by y then x, so a neighbour sharing the edge gets the exact negative.
+    float ox[3];
+    float oy[3];
+    float dx[3];
+    float dy[3];
+    uint32_t top_left;          // bit k: a centre on edge k is inside
+    float inv_area;             // edge k over the area is vertex k's barycentric weight
+    float z[3];                 // NDC depth, affine in screen space
+    float inv_w[3];
+    float colour[3][3];         // over w, for the perspective-correct colour
+    int x0, y0, x1, y1;         // pixel centres it may cover, inclusive, on screen
+};
+
+typedef struct ClipVertex
+{
+    float x, y, z, w;
+    float colour[3];
+} ClipVertex;
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool software_renderer_init(SoftwareRenderer* r, JobSystem* jobs, const SoftwareRendererDesc* desc)
+{
+    memset((void*)r, 0, sizeof(*r));
+    r->width = desc->width > 0 ? desc->width : 1;
+    r->height = desc->height > 0 ? desc->height : 1;
+    r->tiles_x = (r->width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    r->tiles_y = (r->height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    r->stride = r->tiles_x * SOFTWARE_TILE_SIZE;
+    const size_t pixels = (size_t)r->stride * r->tiles_y * SOFTWARE_TILE_SIZE;
+    r->colour = (uint32_t*)linmath_aligned_alloc(sizeof(uint32_t) * pixels, LINMATH_BATCH_ALIGN);
+    r->depth = (float*)linmath_aligned_alloc(sizeof(float) * pixels, LINMATH_BATCH_ALIGN);
+
+    r->vertex_count = (uint32_t)desc->vertex_count;
+    r->triangle_count = (uint32_t)(desc->index_count / 3);
+    const size_t padded = (desc->vertex_count + 3) & ~(size_t)3;
+    for (int k = 0; k < 3; ++k)
+        r->mesh[k] = (float*)linmath_aligned_alloc(sizeof(float) * (padded ? padded : 4), LINMATH_BATCH_ALIGN);
+    r->mesh_colour = (float*)malloc(sizeof(float) * 3 * (desc->vertex_count ? desc->vertex_count : 1));
+    r->indices = (uint32_t*)malloc(sizeof(uint32_t) * 3 * (r->triangle_count ? r->triangle_count : 1));
+    r->max_objects = desc->max_objects;
+    r->models = (mat3x4*)malloc(sizeof(mat3x4) * (desc->max_objects ? desc->max_objects : 1));
+    r->thread_count = jobs ? jobs->thread_count : 1;
+    r->clip_stride = 4 * (padded ? padded : 4);
+    r->clip = (float*)linmath_aligned_alloc(sizeof(float) * r->clip_stride * r->thread_count, LINMATH_BATCH_ALIGN);
+    if (!r->colour || !r->depth || !r->mesh[0] || !r->mesh[1] || !r->mesh[2] || !r->mesh_colour || !r->indices
+        || !r->models || !r->clip)
+    {
+        fprintf(stderr, "software_renderer: out of memory for %dx%d pixels and %u objects\n", r->width, r->height,
+            desc->max_objects);
+        software_renderer_destroy(r);
+        return false;
+    }
+
+    // The mesh as structure-of-arrays, in its z = 0 plane: the transform takes four vertices at a time
+    for (size_t v = 0; v < padded; ++v)
+    {
+        float position[2] = { 0.f, 0.f };
+        if (v < desc->vertex_count)
+        {
+            const unsigned char* vertex = (const unsigned char*)desc->vertices + desc->vertex_size * v;
+            memcpy(position, vertex, sizeof(position));
+            memcpy(r->mesh_colour + 3 * v, vertex + sizeof(position), 3 * sizeof(float));
+        }
+        r->mesh[0][v] = position[0];
+        r->mesh[1][v] = position[1];
+        r->mesh[2][v] = 0.f;
+    }
+    for (uint32_t i = 0; i < 3 * r->triangle_count; ++i)
+        r->indices[i] = desc->indices[i] < desc->vertex_count ? desc->indices[i] : 0;
+    r->objects_per_chunk = r->triangle_count && r->triangle_count < SOFTWARE_CHUNK_TRIANGLES
+        ? SOFTWARE_CHUNK_TRIANGLES / r->triangle_count : 1;
+    mat4x4_identity(r->view_projection);
+    r->start_ms = now_ms();
+    return true;
+}
+
+void software_renderer_destroy(SoftwareRenderer* r)
+{
+    linmath_aligned_free(r->colour);
+    linmath_aligned_free(r->depth);
+    for (int k = 0; k < 3; ++k)
+        linmath_aligned_free(r->mesh[k]);
+    free(r->mesh_colour);
+    free(r->indices);
+    free(r->models);
+    linmath_aligned_free(r->clip);
+    for (int c = 0; c < r->chunk_capacity; ++c)
+    {
+        free(r->chunks[c].triangles);
+        free(r->chunks[c].bin_start);
+        free(r->chunks[c].bin);
+    }
+    free(r->chunks);
+    memset((void*)r, 0, sizeof(*r));
+}
+
+mat3x4* software_renderer_begin_frame(SoftwareRenderer* r)
+{
+    return r->models;
+}
+
+// How far inside clip plane "plane": the near plane (GL's z >= -w, or z <= w for a reversed-Z camera), then the
+// guard band's left, right, bottom and top
+static float plane_distance(const ClipVertex* v, int plane, bool reversed_z)
+{
+    switch (plane)
+    {
+    case 0: return reversed_z ? v->w - v->z : v->z + v->w;
+    case 1: return SOFTWARE_GUARD_BAND * v->w + v->x;
+    case 2: return SOFTWARE_GUARD_BAND * v->w - v->x;
+    case 3: return SOFTWARE_GUARD_BAND * v->w + v->y;
+    default: return SOFTWARE_GUARD_BAND * v->w - v->y;
+    }
+}
+
+// The polygon "in" cut down to its part inside "plane", into "out". A new vertex is found from the edge's inside
+// end, so the two triangles sharing an edge cut it at the same point.
+static int clip_polygon(const ClipVertex* in, int count, ClipVertex* out, int plane, bool reversed_z)
+{
+    int out_count = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const ClipVertex* a = &in[i];
+        const ClipVertex* b = &in[i + 1 < count ? i + 1 : 0];
+        const float da = plane_distance(a, plane, reversed_z), db = plane_distance(b, plane, reversed_z);
+        if (da >= 0.f)
+            out[out_count++] = *a;
+        if ((da >= 0.f) != (db >= 0.f))
+        {
+            const ClipVertex* from = da >= 0.f ? a : b;
+            const ClipVertex* to = da >= 0.f ? b : a;
+            const float d_from = da >= 0.f ? da : db, d_to = da >= 0.f ? db : da;
+            const float t = d_from / (d_from - d_to);
+            ClipVertex* v = &out[out_count++];
+            v->x = from->x + t * (to->x - from->x);
+            v->y = from->y + t * (to->y - from->y);
+            v->z = from->z + t * (to->z - from->z);
+            v->w = from->w + t * (to->w - from->w);
+            for (int c = 0; c < 3; ++c)
+                v->colour[c] = from->colour[c] + t * (to->colour[c] - from->colour[c]);
+        }
+    }
+    return out_count;
+}
+
+// Sets up a clipped triangle in pixel coordinates. False when it covers no pixel centre, with "dropped" set when
+// a vertex isn't a finite point instead.
+static bool triangle_setup(const SoftwareRenderer* r, const ClipVertex* v, SoftwareTriangle* t, bool* dropped)
+{
+    float sx[3], sy[3];
+    const float half_w = 0.5f * (float)r->width, half_h = 0.5f * (float)r->height;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float inv_w = 1.f / v[k].w;
+        sx[k] = floorf((v[k].x * inv_w + 1.f) * half_w * SUBPIXEL + 0.5f) / SUBPIXEL;
+        sy[k] = floorf((v[k].y * inv_w + 1.f) * half_h * SUBPIXEL + 0.5f) / SUBPIXEL;
+        if (!(fabsf(sx[k] - half_w) <= (SOFTWARE_GUARD_BAND + 1.f) * half_w)
+            || !(fabsf(sy[k] - half_h) <= (SOFTWARE_GUARD_BAND + 1.f) * half_h))
+        {
+            *dropped = true;
+            return false;
+        }
+        t->z[k] = v[k].z * inv_w;
+        t->inv_w[k] = inv_w;
+        for (int c = 0; c < 3; ++c)
+            t->colour[k][c] = v[k].colour[c] * inv_w;
+    }
+    t->x0 = (int)ceilf(fminf(fminf(sx[0], sx[1]), sx[2]) - 0.5f);
+    t->y0 = (int)ceilf(fminf(fminf(sy[0], sy[1]), sy[2]) - 0.5f);
+    t->x1 = (int)floorf(fmaxf(fmaxf(sx[0], sx[1]), sx[2]) - 0.5f);
+    t->y1 = (int)floorf(fmaxf(fmaxf(sy[0], sy[1]), sy[2]) - 0.5f);
+    t->x0 = t->x0 > 0 ? t->x0 : 0;
+    t->y0 = t->y0 > 0 ? t->y0 : 0;
+    t->x1 = t->x1 < r->width - 1 ? t->x1 : r->width - 1;
+    t->y1 = t->y1 < r->height - 1 ? t->y1 : r->height - 1;
+    const float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+    if (t->x0 > t->x1 || t->y0 > t->y1 || area == 0.f)
+        return false;
+
+    const float orientation = area > 0.f ? 1.f : -1.f;
+    t->top_left = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        const int i = k == 2 ? 0 : k + 1, j = i == 2 ? 0 : i + 1;
+        // Walked with the inside on its left, an edge going down is a left edge and one going left a top edge
+        const float walk_x = orientation * (sx[j] - sx[i]), walk_y = orientation * (sy[j] - sy[i]);
+        if (walk_y < 0.f || (walk_y == 0.f && walk_x < 0.f))
+            t->top_left |= 1u << k;
+        int a = i, b = j;
+        float sign = orientation;
+        if (sy[a] > sy[b] || (sy[a] == sy[b] && sx[a] > sx[b]))
+        {
+            a = j;
+            b = i;
+            sign = -sign;
+        }
+        t->ox[k] = sx[a];
+        t->oy[k] = sy[a];
+        t->dx[k] = sign * (sx[b] - sx[a]);
+        t->dy[k] = sign * (sy[b] - sy[a]);
+    }
+    t->inv_area = 1.f / fabsf(area);
+    return true;
+}
+
+// Adds the triangle to the chunk, clipped to the planes in "planes" (bit p for plane p) as a fan of triangles
+static void chunk_add(const SoftwareRenderer* r, SoftwareChunk* chunk, const ClipVertex* v, unsigned int planes)
+{
+    ClipVertex buffers[2][CLIP_VERTICES];
+    ClipVertex* clipped = buffers[0];
+    int count = 3;
+    memcpy(clipped, v, 3 * sizeof(ClipVertex));
+    for (int plane = 0; plane < CLIP_PLANES && count >= 3; ++plane)
+        if (planes & (1u << plane))
+        {
+            ClipVertex* out = clipped == buffers[0] ? buffers[1] : buffers[0];
+            count = clip_polygon(clipped, count, out, plane, r->reversed_z);
+            clipped = out;
+        }
+    for (int k = 2; k < count; ++k)
+    {
+        if (chunk->triangle_count == chunk->triangle_capacity)
+        {
+            const uint32_t capacity = chunk->triangle_capacity ? 2 * chunk->triangle_capacity : MIN_TRIANGLES;
+            SoftwareTriangle* triangles = (SoftwareTriangle*)realloc(chunk->triangles,
+                sizeof(SoftwareTriangle) * capacity);
+            if (!triangles)
+            {
+                ++chunk->dropped;
+                continue;
+            }
+            chunk->triangles = triangles;
+            chunk->triangle_capacity = capacity;
+        }
+        const ClipVertex fan[3] = { clipped[0], clipped[k - 1], clipped[k] };
+        bool dropped = false;
+        if (triangle_setup(r, fan, &chunk->triangles[chunk->triangle_count], &dropped))
+            ++chunk->triangle_count;
+        chunk->dropped += dropped ? 1 : 0;
+    }
+}
+
+// Bins the chunk's triangles by a counting sort, as scene/occlusion_raster.cpp does its occluders: counted into
+// the tiles their bounds overlap, a prefix sum, then written in at each tile's cursor
+static void chunk_bin(const SoftwareRenderer* r, SoftwareChunk* chunk)
+{
+    const int tiles = r->tiles_x * r->tiles_y;
+    memset(chunk->bin_start, 0, sizeof(uint32_t) * (tiles + 1));
+    size_t total = 0;
+    for (uint32_t i = 0; i < chunk->triangle_count; ++i)
+    {
+        const SoftwareTriangle* t = &chunk->triangles[i];
+        for (int ty = t->y0 / SOFTWARE_TILE_SIZE; ty <= t->y1 / SOFTWARE_TILE_SIZE; ++ty)
+            for (int tx = t->x0 / SOFTWARE_TILE_SIZE; tx <= t->x1 / SOFTWARE_TILE_SIZE; ++tx)
+                ++chunk->bin_start[ty * r->tiles_x + tx];
+        total += (size_t)(t->y1 / SOFTWARE_TILE_SIZE - t->y0 / SOFTWARE_TILE_SIZE + 1)
+            * (t->x1 / SOFTWARE_TILE_SIZE - t->x0 / SOFTWARE_TILE_SIZE + 1);
+    }
+    if (total > chunk->bin_capacity)
+    {
+        const size_t capacity = total > 2 * chunk->bin_capacity ? total : 2 * chunk->bin_capacity;
+        uint32_t* bin = (uint32_t*)realloc(chunk->bin, sizeof(uint32_t) * capacity);
+        if (!bin)
+        {
+            chunk->dropped += chunk->triangle_count;
+            chunk->triangle_count = 0;
+            memset(chunk->bin_start, 0, sizeof(uint32_t) * (tiles + 1));
+            return;
+        }
+        chunk->bin = bin;
+        chunk->bin_capacity = capacity;
+    }
+    uint32_t sum = 0;
+    for (int t = 0; t < tiles; ++t)
+    {
+        const uint32_t n = chunk->bin_start[t];
+        chunk->bin_start[t] = sum;
+        sum += n;
+    }
+    for (uint32_t i = 0; i < chunk->triangle_count; ++i)
+    {
+        const SoftwareTriangle* t = &chunk->triangles[i];
+        for (int ty = t->y0 / SOFTWARE_TILE_SIZE; ty <= t->y1 / SOFTWARE_TILE_SIZE; ++ty)
+            for (int tx = t->x0 / SOFTWARE_TILE_SIZE; tx <= t->x1 / SOFTWARE_TILE_SIZE; ++tx)
+                chunk->bin[chunk->bin_start[ty * r->tiles_x + tx]++] = i;
+    }
+    for (int t = tiles; t > 0; --t)
+        chunk->bin_start[t] = chunk->bin_start[t - 1];
+    chunk->bin_start[0] = 0;
+}
+
+// Chunk "c": its objects' vertices into clip space, their triangles clipped, set up and binned
+static void setup_chunk(SoftwareRenderer* r, int c)
+{
+    SoftwareChunk* chunk = &r->chunks[c];
+    chunk->triangle_count = 0;
+    chunk->dropped = 0;
+    const int thread = job_thread_current();
+    float* clip = r->clip + r->clip_stride * (thread > 0 && thread < r->thread_count ? thread : 0);
+    const size_t padded = r->clip_stride / 4;
+    float* cx = clip;
+    float* cy = clip + padded;
+    float* cz = clip + 2 * padded;
+    float* cw = clip + 3 * padded;
+    const uint32_t begin = (uint32_t)c * r->objects_per_chunk;
+    const uint32_t end = begin + r->objects_per_chunk < (uint32_t)r->visible_count
+        ? begin + r->objects_per_chunk : (uint32_t)r->visible_count;
+    for (uint32_t o = begin; o < end; ++o)
+    {
+        mat4x4 model, mvp;
+        mat4x4_from_mat3x4(model, r->models[o]);
+        mat4x4_mul(mvp, r->view_projection, model);
+        mat4x4_transform_soa(cx, cy, cz, cw, mvp, r->mesh[0], r->mesh[1], r->mesh[2], NULL, padded);
+        for (uint32_t t = 0; t < r->triangle_count; ++t)
+        {
+            ClipVertex v[3];
+            int left = 0, right = 0, below = 0, above = 0, beyond = 0;
+            unsigned int planes = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                const uint32_t i = r->indices[3 * t + k];
+                v[k] = { cx[i], cy[i], cz[i], cw[i], { r->mesh_colour[3 * i], r->mesh_colour[3 * i + 1],
+                    r->mesh_colour[3 * i + 2] } };
+                left += v[k].x < -v[k].w;
+                right += v[k].x > v[k].w;
+                below += v[k].y < -v[k].w;
+                above += v[k].y > v[k].w;
+                beyond += r->reversed_z ? v[k].z < 0.f : v[k].z > v[k].w;
+                for (int plane = 0; plane < CLIP_PLANES; ++plane)
+                    planes |= plane_distance(&v[k], plane, r->reversed_z) < 0.f ? 1u << plane : 0u;
+            }
+            if (left < 3 && right < 3 && below < 3 && above < 3 && beyond < 3)     // not wholly off one side
+                chunk_add(r, chunk, v, planes);
+        }
+    }
+    chunk_bin(r, chunk);
+}
+
+static void setup_range(void* data, size_t begin, size_t end)
+{
+    SoftwareRenderer* r = (SoftwareRenderer*)data;
+    for (size_t c = begin; c < end; ++c)
+        setup_chunk(r, (int)c);
+}
+
+// Draws triangle "t" over the pixels [x0, x1] x [y0, y1] of its tile, depth tested. Returns the pixels written.
+static unsigned int draw_triangle(SoftwareRenderer* r, const SoftwareTriangle* t, int x0, int y0, int x1, int y1)
+{
+    unsigned int written = 0;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+    // Four pixels a step from a multiple of 4: the lanes outside the triangle's bounds fail its edges
+    x0 &= ~3;
+    const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+    __m128 ox[3], dy[3], top_left[3], z[3], inv_w[3], colour[3][3];
+    for (int k = 0; k < 3; ++k)
+    {
+        ox[k] = _mm_set1_ps(t->ox[k]);
+        dy[k] = _mm_set1_ps(t->dy[k]);
+        top_left[k] = _mm_castsi128_ps(_mm_set1_epi32(t->top_left & (1u << k) ? -1 : 0));
+        z[k] = _mm_set1_ps(t->z[k]);
+        inv_w[k] = _mm_set1_ps(t->inv_w[k]);
+        for (int c = 0; c < 3; ++c)
+            colour[k][c] = _mm_set1_ps(t->colour[k][c]);
+    }
+    const __m128 inv_area = _mm_set1_ps(t->inv_area), scale = _mm_set1_ps(255.f);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float py = (float)y + 0.5f;
+        __m128 row[3];
+        for (int k = 0; k < 3; ++k)
+            row[k] = _mm_set1_ps(t->dx[k] * (py - t->oy[k]));
+        uint32_t* colour_row = r->colour + (size_t)y * r->stride;
+        float* depth_row = r->depth + (size_t)y * r->stride;
+        for (int x = x0; x <= x1; x += 4)
+        {
+            const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+            __m128 e[3];
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int k = 0; k < 3; ++k)
+            {
+                e[k] = _mm_sub_ps(row[k], _mm_mul_ps(dy[k], _mm_sub_ps(px, ox[k])));
+                inside = _mm_and_ps(inside, _mm_or_ps(_mm_cmpgt_ps(e[k], zero),
+                    _mm_and_ps(_mm_cmpeq_ps(e[k], zero), top_left[k])));
+            }
+            if (!_mm_movemask_ps(inside))
+                continue;
+            const __m128 l0 = _mm_mul_ps(e[0], inv_area), l1 = _mm_mul_ps(e[1], inv_area);
+            const __m128 l2 = _mm_mul_ps(e[2], inv_area);
+            const __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l0, z[0]), _mm_mul_ps(l1, z[1])),
+                _mm_mul_ps(l2, z[2]));
+            const __m128 old_depth = _mm_load_ps(depth_row + x);
+            inside = _mm_and_ps(inside, r->reversed_z ? _mm_cmpge_ps(depth, old_depth)
+                : _mm_cmple_ps(depth, old_depth));
+            const int mask = _mm_movemask_ps(inside);
+            if (!mask)
+                continue;
+            const __m128 w = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(l0, inv_w[0]),
+                _mm_mul_ps(l1, inv_w[1])), _mm_mul_ps(l2, inv_w[2])));
+            __m128i packed = alpha;
+            for (int c = 0; c < 3; ++c)
+            {
+                __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(l0, colour[0][c]), _mm_mul_ps(l1, colour[1][c])),
+                    _mm_mul_ps(l2, colour[2][c])), w);
+                v = _mm_mul_ps(_mm_min_ps(_mm_max_ps(v, zero), one), scale);
+                packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvtps_epi32(v), 8 * c));
+            }
+            const __m128i keep = _mm_castps_si128(inside);
+            const __m128i old_colour = _mm_load_si128((const __m128i*)(colour_row + x));
+            _mm_store_si128((__m128i*)(colour_row + x), _mm_or_si128(_mm_and_si128(keep, packed),
+                _mm_andnot_si128(keep, old_colour)));
+            _mm_store_ps(depth_row + x, _mm_or_ps(_mm_and_ps(inside, depth), _mm_andnot_ps(inside, old_depth)));
+            written += (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3 & 1);
+        }
+    }
+#else
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float py = (float)y + 0.5f;
+        float row[3];
+        for (int k = 0; k < 3; ++k)
+            row[k] = t->dx[k] * (py - t->oy[k]);
+        uint32_t* colour_row = r->colour + (size_t)y * r->stride;
+        float* depth_row = r->depth + (size_t)y * r->stride;
+        for (int x = x0; x <= x1; ++x)
+        {
+            const float px = (float)x + 0.5f;
+            float l[3];
+            bool inside = true;
+            for (int k = 0; k < 3; ++k)
+            {
+                const float e = row[k] - t->dy[k] * (px - t->ox[k]);
+                inside = inside && (e > 0.f || (e == 0.f && (t->top_left & (1u << k))));
+                l[k] = e * t->inv_area;
+            }
+            if (!inside)
+                continue;
+            const float depth = l[0] * t->z[0] + l[1] * t->z[1] + l[2] * t->z[2];
+            if (r->reversed_z ? !(depth >= depth_row[x]) : !(depth <= depth_row[x]))
+                continue;
+            const float w = 1.f / (l[0] * t->inv_w[0] + l[1] * t->inv_w[1] + l[2] * t->inv_w[2]);
+            uint32_t packed = 0xFF000000u;
+            for (int c = 0; c < 3; ++c)
+            {
+                const float v = (l[0] * t->colour[0][c] + l[1] * t->colour[1][c] + l[2] * t->colour[2][c]) * w;
+                packed |= (uint32_t)lrintf(fminf(fmaxf(v, 0.f), 1.f) * 255.f) << (8 * c);
+            }
+            colour_row[x] = packed;
+            depth_row[x] = depth;
+            ++written;
+        }
+    }
+#endif
+    return written;
+}
+
+// Clears tile "tile" and draws every chunk's triangles binned to it, chunk by chunk
+static void raster_tile(SoftwareRenderer* r, int tile)
+{
+    const int px0 = tile % r->tiles_x * SOFTWARE_TILE_SIZE, py0 = tile / r->tiles_x * SOFTWARE_TILE_SIZE;
+    const int px1 = px0 + SOFTWARE_TILE_SIZE - 1, py1 = py0 + SOFTWARE_TILE_SIZE - 1;
+    const float far_depth = r->reversed_z ? 0.f : 1.f;
+    for (int y = py0; y <= py1; ++y)
+    {
+        memset(r->colour + (size_t)y * r->stride + px0, 0, sizeof(uint32_t) * SOFTWARE_TILE_SIZE);
+        float* row = r->depth + (size_t)y * r->stride;
+        for (int x = px0; x <= px1; ++x)
+            row[x] = far_depth;
+    }
+    unsigned long long written = 0;
+    for (int c = 0; c < r->chunk_count; ++c)
+    {
+        const SoftwareChunk* chunk = &r->chunks[c];
+        for (uint32_t k = chunk->bin_start[tile]; k < chunk->bin_start[tile + 1]; ++k)
+        {
+            const SoftwareTriangle* t = &chunk->triangles[chunk->bin[k]];
+            written += draw_triangle(r, t, t->x0 > px0 ? t->x0 : px0, t->y0 > py0 ? t->y0 : py0,
+                t->x1 < px1 ? t->x1 : px1, t->y1 < py1 ? t->y1 : py1);
+        }
+    }
+    r->pixels.fetch_add(written, std::memory_order_relaxed);
+}
+
+static void raster_range(void* data, size_t begin, size_t end)
+{
+    SoftwareRenderer* r = (SoftwareRenderer*)data;
+    for (size_t tile = begin; tile < end; ++tile)
+        raster_tile(r, (int)tile);
+}
+
+void software_renderer_draw(SoftwareRenderer* r, JobSystem* jobs, mat4x4 const view_projection, bool reversed_z,
+    int visible_count)
+{
+    mat4x4_dup(r->view_projection, view_projection);
+    r->reversed_z = reversed_z;
+    r->visible_count = visible_count < 0 ? 0 : (uint32_t)visible_count > r->max_objects ? (int)r->max_objects
+        : visible_count;
+    int chunk_count = (int)((r->visible_count + r->objects_per_chunk - 1) / r->objects_per_chunk);
+    if (chunk_count > r->chunk_capacity)
+    {
+        // Kept from frame to frame, with their triangles' and bins' storage
+        SoftwareChunk* chunks = (SoftwareChunk*)realloc(r->chunks, sizeof(SoftwareChunk) * chunk_count);
+        if (chunks)
+            r->chunks = chunks;
+        for (int c = r->chunk_capacity; chunks && c < chunk_count; ++c)
+        {
+            memset(&r->chunks[c], 0, sizeof(SoftwareChunk));
+            r->chunks[c].bin_start = (uint32_t*)calloc((size_t)r->tiles_x * r->tiles_y + 1, sizeof(uint32_t));
+            if (!r->chunks[c].bin_start)
+                break;
+            r->chunk_capacity = c + 1;
+        }
+        if (chunk_count > r->chunk_capacity)
+        {
+            fprintf(stderr, "software_renderer: out of memory for %d objects' triangles, drawing %u\n",
+                r->visible_count, r->chunk_capacity * r->objects_per_chunk);
+            chunk_count = r->chunk_capacity;
+            r->visible_count = (int)(chunk_count * r->objects_per_chunk);
+        }
+    }
+    r->chunk_count = chunk_count;
+    const bool parallel = jobs && jobs->thread_count > 1;
+
+    const double t0 = now_ms();
+    if (parallel && chunk_count > 1)
+        job_wait(jobs, job_parallel_for(jobs, setup_range, r, (size_t)chunk_count, SETUP_GRAIN));
+    else
+        setup_range(r, 0, (size_t)chunk_count);
+    const double t1 = now_ms();
+    r->pixels.store(0, std::memory_order_relaxed);
+    const size_t tiles = (size_t)r->tiles_x * r->tiles_y;
+    if (parallel && tiles > RASTER_GRAIN)
+        job_wait(jobs, job_parallel_for(jobs, raster_range, r, tiles, RASTER_GRAIN));
+    else
+        raster_range(r, 0, tiles);
+    const double t2 = now_ms();
+
+    ++r->frames_drawn;
+    r->objects_drawn += (unsigned long long)r->visible_count;
+    for (int c = 0; c < chunk_count; ++c)
+    {
+        r->triangles_binned += r->chunks[c].triangle_count;
+        r->triangles_dropped += r->chunks[c].dropped;
+    }
+    r->pixels_written += r->pixels.load(std::memory_order_relaxed);
+    r->setup_ms += t1 - t0;
+    r->raster_ms += t2 - t1;
+}
+
+uint64_t software_renderer_hash(const SoftwareRenderer* r)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (int y = 0; y < r->height; ++y)
+    {
+        const unsigned char* row = (const unsigned char*)(r->colour + (size_t)y * r->stride);
+        for (size_t i = 0; i < sizeof(uint32_t) * r->width; ++i)
+            hash = (hash ^ row[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void software_renderer_report(const SoftwareRenderer* r, int object_count, FILE* out)
+{
+    const double seconds = (now_ms() - r->start_ms) / 1000.0;
+    const double frames = r->frames_drawn ? (double)r->frames_drawn : 1.0;
+    fprintf(out, "software: %u frames, %d objects, %dx%d, %.3f s\n", r->frames_drawn, object_count, r->width,
+        r->height, seconds);
+    fprintf(out, "  frames/s      %10.1f\n", seconds > 0.0 ? r->frames_drawn / seconds : 0.0);
+    fprintf(out, "  drawn/frame   %10.1f\n", r->objects_drawn / frames);
+    fprintf(out, "  triangles     %10.1f a frame set up (%.1f dropped)\n", r->triangles_binned / frames,
+        r->triangles_dropped / frames);
+    fprintf(out, "  pixels        %10.1f a frame written (%.2f of the frame's)\n", r->pixels_written / frames,
+        r->pixels_written / frames / ((double)r->width * r->height));
+    fprintf(out, "  setup ms      %10.3f (on %d threads)\n", r->setup_ms / frames, r->thread_count);
+    fprintf(out, "  raster ms     %10.3f\n", r->raster_ms / frames);
+    fprintf(out, "  frame hash    %016llx\n", (unsigned long long)software_renderer_hash(r));
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "linmath.h"
+#include "linmath_affine.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct JobSystem JobSystem;
+
+// The scene drawn on the CPU (--software), for CI and batch nodes without a
+// GPU. It takes what the Vulkan renderer takes from a frame packet - the
+// camera's view-projection and the visible objects' model matrices, which
+// scene_update writes straight into its buffer - and draws the objects as
+// the scene shaders' plain colour pass does: the vertex colour interpolated
+// perspective-correct across each triangle, depth tested, into an RGBA8
+// colour buffer and a float depth buffer.
+//
+// Frames are cut into SOFTWARE_TILE_SIZE square tiles and drawn on the job
+// system in two steps, as scene/occlusion_raster.h draws its occluders. The
+// visible objects are split into chunks of about SOFTWARE_CHUNK_TRIANGLES
+// triangles; a job per chunk transforms its objects' vertices (each object's
+// model-view-projection through linmath_batch.h's SIMD structure-of-arrays
+// transform), clips the triangles against the near plane, sets them up and
+// bins them by the tiles they may cover. A job per tile then clears it and
+// draws its triangles chunk by chunk, in the objects' order, four pixels at
+// a time where linmath has SSE. Tiles share nothing, and the fixed order
+// makes a frame the same on any number of threads: at equal depth the later
+// object wins, as in the GL renderer's draw order.
+//
+// Coverage follows GL's rules: vertices snapped to 1 / 2^SOFTWARE_SUBPIXEL_BITS
+// of a pixel, pixel centres sampled, and the top-left rule for a centre on an
+// edge. Both triangles sharing an edge evaluate it from the same end, so
+// their values are exact negatives and no pixel along it is drawn twice or
+// missed. Triangles are clipped to the near plane and, so that huge ones
+// stay in float's range, to a guard band SOFTWARE_GUARD_BAND times the
+// viewport's half-size about its centre; the tiles' bounds do the rest.
+
+#define SOFTWARE_TILE_SIZE 64               // pixels; a multiple of 4, the width is rounded up to these
+#define SOFTWARE_CHUNK_TRIANGLES 4096       // a chunk's, rounded to whole objects
+#define SOFTWARE_SUBPIXEL_BITS 8
+#define SOFTWARE_GUARD_BAND 8.f             // |x|, |y| <= this times w in clip space
+
+typedef struct SoftwareTriangle SoftwareTriangle;
+
+// One job's share of the frame's objects: their triangles, set up, and where each tile's are
+typedef struct SoftwareChunk
+{
+    SoftwareTriangle* triangles;
+    uint32_t triangle_count;
+    uint32_t triangle_capacity;
+    uint32_t* bin_start;        // [tiles + 1]: tile t's triangles are bin[bin_start[t], bin_start[t + 1])
+    uint32_t* bin;
+    size_t bin_capacity;
+    uint32_t dropped;           // not finite, or out of memory
+} SoftwareChunk;
+
+// What to draw: a mesh of vertices laid out as the scene's Vertex (vec2 position, vec3 colour) with 32-bit indices
+typedef struct SoftwareRendererDesc
+{
+    const void* vertices;
+    size_t vertex_size;
+    size_t vertex_count;
+    const uint32_t* indices;
+    size_t index_count;
+    uint32_t max_objects;       // model matrix capacity
+    int width;
+    int height;
+} SoftwareRendererDesc;
+
+typedef struct SoftwareRenderer
+{
+    int width;
+    int height;
+    int stride;                 // pixels a row: the width in whole tiles
+    int tiles_x;
+    int tiles_y;
+    uint32_t* colour;           // [stride * tiles_y * SOFTWARE_TILE_SIZE] RGBA8, red the low byte, rows from the bottom
+    float* depth;               // the same pixels' NDC depth
+
+    float* mesh[3];             // x, y, z of the mesh's vertices, LINMATH_BATCH_ALIGN aligned
+    float* mesh_colour;         // [3 * vertex_count]
+    uint32_t* indices;
+    uint32_t vertex_count;
+    uint32_t triangle_count;    // the mesh's
+    mat3x4* models;             // [max_objects], what scene_update writes
+    uint32_t max_objects;
+
+    int thread_count;           // the job system's: a transform scratch each
+    float* clip;                // [thread_count][4 * padded vertex count]: x, y, z, w
+    size_t clip_stride;
+    SoftwareChunk* chunks;
+    int chunk_capacity;
+    int chunk_count;            // this frame's
+    uint32_t objects_per_chunk;
+    int visible_count;
+    mat4x4 view_projection;
+    bool reversed_z;            // the camera's: depth nearer is greater, cleared to 0
+    std::atomic<unsigned long long> pixels;     // written this frame
+
+    // For the report
+    unsigned int frames_drawn;
+    unsigned long long objects_drawn;
+    unsigned long long triangles_binned;
+    unsigned long long triangles_dropped;
+    unsigned long long pixels_written;
+    double setup_ms;            // transforming, clipping, setting up and binning, summed over the frames
+    double raster_ms;           // clearing and drawing the tiles
+    double start_ms;
+} SoftwareRenderer;
+
+// A width x height frame and the mesh, with a transform scratch for each of "jobs"' threads (NULL for one). Logs
+// and returns false when out of memory.
+bool software_renderer_init(SoftwareRenderer* r, JobSystem* jobs, const SoftwareRendererDesc* desc);
+void software_renderer_destroy(SoftwareRenderer* r);
+
+// The model matrices' buffer, for scene_update to write the frame's visible objects into
+mat3x4* software_renderer_begin_frame(SoftwareRenderer* r);
+
+// Draws "visible_count" objects from the buffer seen through "view_projection" (GL clip conventions; "reversed_z"
+// for a camera whose depth runs from 1 near to 0 far) across "jobs" (NULL draws serially; otherwise the system
+// given to init, called from a thread running in it)
+void software_renderer_draw(SoftwareRenderer* r, JobSystem* jobs, mat4x4 const view_projection, bool reversed_z,
+    int visible_count);
+
+// Pixel (x, y) of the last frame, from the bottom left
+static inline uint32_t software_renderer_pixel(const SoftwareRenderer* r, int x, int y)
+{
+    return r->colour[(size_t)y * r->stride + x];
+}
+
+// FNV-1a over the last frame's pixels: the same scene drawn on any number of threads hashes the same
+uint64_t software_renderer_hash(const SoftwareRenderer* r);
+
+// Frame rate, objects, triangles and pixels, and the two steps' times since init
+void software_renderer_report(const SoftwareRenderer* r, int object_count, FILE* out);
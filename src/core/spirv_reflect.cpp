@@ -0,0 +1,376 @@
+#include "core/spirv_reflect.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t spirv_magic = 0x07230203u;
+static const uint32_t none = UINT32_MAX;
+
+// The opcodes, decorations, storage classes and execution modes read here, as the SPIR-V specification numbers them
+enum
+{
+    OP_ENTRY_POINT = 15,
+    OP_EXECUTION_MODE = 16,
+    OP_TYPE_INT = 21,
+    OP_TYPE_FLOAT = 22,
+    OP_TYPE_VECTOR = 23,
+    OP_TYPE_MATRIX = 24,
+    OP_TYPE_IMAGE = 25,
+    OP_TYPE_SAMPLER = 26,
+    OP_TYPE_SAMPLED_IMAGE = 27,
+    OP_TYPE_ARRAY = 28,
+    OP_TYPE_RUNTIME_ARRAY = 29,
+    OP_TYPE_STRUCT = 30,
+    OP_TYPE_POINTER = 32,
+    OP_CONSTANT = 43,
+    OP_VARIABLE = 59,
+    OP_DECORATE = 71,
+    OP_MEMBER_DECORATE = 72,
+    OP_TYPE_ACCELERATION_STRUCTURE = 5341
+};
+
+enum
+{
+    DECORATION_BUFFER_BLOCK = 3,
+    DECORATION_ROW_MAJOR = 4,
+    DECORATION_ARRAY_STRIDE = 6,
+    DECORATION_MATRIX_STRIDE = 7,
+    DECORATION_BUILT_IN = 11,
+    DECORATION_LOCATION = 30,
+    DECORATION_BINDING = 33,
+    DECORATION_DESCRIPTOR_SET = 34,
+    DECORATION_OFFSET = 35
+};
+
+enum
+{
+    STORAGE_UNIFORM_CONSTANT = 0,
+    STORAGE_INPUT = 1,
+    STORAGE_UNIFORM = 2,
+    STORAGE_PUSH_CONSTANT = 9,
+    STORAGE_STORAGE_BUFFER = 12,
+    STORAGE_PHYSICAL_STORAGE_BUFFER = 5349      // buffer_reference
+};
+
+static const uint32_t execution_mode_local_size = 17;
+static const int max_type_depth = 16;       // arrays of structs of arrays...
+
+// An id's defining instruction and the decorations read here
+typedef struct SpirvId
+{
+    uint32_t def;               // word offset of the instruction, 0 for none
+    uint32_t location, binding, set, array_stride;  // "none" when undecorated
+    bool built_in, buffer_block;
+} SpirvId;
+
+typedef struct Module
+{
+    const uint32_t* words;
+    size_t count;
+    uint32_t bound;
+    SpirvId* ids;
+} Module;
+
+static const uint32_t* type_of(const Module* m, uint32_t id)
+{
+    return id < m->bound && m->ids[id].def ? m->words + m->ids[id].def : NULL;
+}
+
+static uint32_t opcode(const uint32_t* instruction)
+{
+    return instruction[0] & 0xffffu;
+}
+
+// An OpConstant's value, for array lengths
+static uint32_t constant_value(const Module* m, uint32_t id)
+{
+    const uint32_t* c = type_of(m, id);
+    return c && opcode(c) == OP_CONSTANT && (c[0] >> 16) > 3 ? c[3] : none;
+}
+
+// A struct member's decoration's literal, or "fallback" without it (or 1 for one that takes none)
+static uint32_t member_decoration(const Module* m, uint32_t id, uint32_t member, uint32_t decoration,
+    uint32_t fallback)
+{
+    for (size_t at = 5; at < m->count; at += m->words[at] >> 16)
+    {
+        const uint32_t* w = m->words + at;
+        if (opcode(w) == OP_MEMBER_DECORATE && w[1] == id && w[2] == member && w[3] == decoration)
+            return (w[0] >> 16) > 4 ? w[4] : 1;
+    }
+    return fallback;
+}
+
+// Bytes a type takes in a block; "matrix_stride" and "row_major" are the enclosing member's
+static uint32_t type_size(const Module* m, uint32_t id, uint32_t matrix_stride, bool row_major, int depth)
+{
+    const uint32_t* t = type_of(m, id);
+    if (!t || depth > max_type_depth)
+        return 0;
+    switch (opcode(t))
+    {
+    case OP_TYPE_INT:
+    case OP_TYPE_FLOAT:
+        return t[2] / 8;
+    case OP_TYPE_VECTOR:
+        return t[3] * type_size(m, t[2], 0, false, depth + 1);
+    case OP_TYPE_MATRIX:
+    {
+        // Column-major: a stride a column; row-major: a stride a row, as many as a column has components
+        const uint32_t* column = type_of(m, t[2]);
+        const uint32_t vectors = row_major && column ? column[3] : t[3];
+        return vectors * (matrix_stride ? matrix_stride : type_size(m, t[2], 0, false, depth + 1));
+    }
+    case OP_TYPE_ARRAY:
+    {
+        const uint32_t length = constant_value(m, t[3]);
+        const uint32_t stride = m->ids[id].array_stride != none ? m->ids[id].array_stride
+            : type_size(m, t[2], matrix_stride, row_major, depth + 1);
+        return length == none ? 0 : length * stride;
+    }
+    case OP_TYPE_STRUCT:
+    {
+        uint32_t end = 0;
+        for (uint32_t member = 0; member + 2 < (t[0] >> 16); ++member)
+        {
+            const uint32_t offset = member_decoration(m, id, member, DECORATION_OFFSET, 0);
+            const uint32_t size = type_size(m, t[2 + member],
+                member_decoration(m, id, member, DECORATION_MATRIX_STRIDE, 0),
+                member_decoration(m, id, member, DECORATION_ROW_MAJOR, 0) != 0, depth + 1);
+            if (offset + size > end)
+                end = offset + size;
+        }
+        return end;
+    }
+    case OP_TYPE_POINTER:
+        return t[2] == STORAGE_PHYSICAL_STORAGE_BUFFER ? 8 : 0;    // a device address
+    default:
+        return 0;   // runtime arrays and opaque types take nothing
+    }
+}
+
+// The locations an input of type "id" takes from "location" on, appended to "out"; the count taken, or -1
+static int add_inputs(const Module* m, uint32_t id, uint32_t location, SpirvReflection* out, int depth)
+{
+    const uint32_t* t = type_of(m, id);
+    if (!t || depth > max_type_depth)
+        return -1;
+    const uint32_t op = opcode(t);
+    if (op == OP_TYPE_ARRAY || op == OP_TYPE_MATRIX)
+    {
+        const uint32_t elements = op == OP_TYPE_ARRAY ? constant_value(m, t[3]) : t[3];
+        int taken = 0;
+        for (uint32_t i = 0; i < elements && elements != none; ++i)
+        {
+            const int n = add_inputs(m, t[2], location + (uint32_t)taken, out, depth + 1);
+            if (n < 0)
+                return -1;
+            taken += n;
+        }
+        return taken;
+    }
+    const uint32_t* scalar = op == OP_TYPE_VECTOR ? type_of(m, t[2]) : t;
+    if (!scalar || (opcode(scalar) != OP_TYPE_INT && opcode(scalar) != OP_TYPE_FLOAT) || scalar[2] != 32)
+    {
+        fprintf(stderr, "spirv_reflect: the input at location %u isn't made of 32-bit numbers\n", location);
+        return -1;
+    }
+    if (out->input_count == SPIRV_REFLECT_MAX_INPUTS)
+    {
+        fprintf(stderr, "spirv_reflect: more than %d input locations\n", SPIRV_REFLECT_MAX_INPUTS);
+        return -1;
+    }
+    SpirvInput* input = &out->inputs[out->input_count++];
+    input->location = location;
+    input->component = opcode(scalar) == OP_TYPE_FLOAT ? SPIRV_COMPONENT_FLOAT
+        : scalar[3] ? SPIRV_COMPONENT_INT : SPIRV_COMPONENT_UINT;
+    input->components = op == OP_TYPE_VECTOR ? t[3] : 1;
+    return 1;
+}
+
+// A uniform, storage or opaque variable's binding; false for a type this doesn't know
+static bool add_binding(const Module* m, const SpirvId* variable, uint32_t storage, uint32_t id,
+    SpirvReflection* out)
+{
+    const uint32_t* t = type_of(m, id);
+    uint32_t count = 1;
+    while (t && (opcode(t) == OP_TYPE_ARRAY || opcode(t) == OP_TYPE_RUNTIME_ARRAY))
+    {
+        count = opcode(t) == OP_TYPE_ARRAY ? constant_value(m, t[3]) : 0;   // 0: unsized
+        id = t[2];
+        t = type_of(m, id);
+    }
+    if (!t)
+        return false;
+    SpirvBindingKind kind;
+    if (storage == STORAGE_STORAGE_BUFFER || (storage == STORAGE_UNIFORM && m->ids[id].buffer_block))
+        kind = SPIRV_BINDING_STORAGE_BUFFER;
+    else if (storage == STORAGE_UNIFORM)
+        kind = SPIRV_BINDING_UNIFORM_BUFFER;
+    else if (opcode(t) == OP_TYPE_SAMPLED_IMAGE)
+        kind = SPIRV_BINDING_SAMPLED_IMAGE;
+    else if (opcode(t) == OP_TYPE_IMAGE)
+        kind = t[7] == 2 ? SPIRV_BINDING_STORAGE_IMAGE : SPIRV_BINDING_TEXTURE;     // Sampled: 2 for storage
+    else if (opcode(t) == OP_TYPE_SAMPLER)
+        kind = SPIRV_BINDING_SAMPLER;
+    else if (opcode(t) == OP_TYPE_ACCELERATION_STRUCTURE)
+        kind = SPIRV_BINDING_ACCELERATION_STRUCTURE;
+    else
+        return false;
+    if (out->binding_count == SPIRV_REFLECT_MAX_BINDINGS)
+    {
+        fprintf(stderr, "spirv_reflect: more than %d bindings\n", SPIRV_REFLECT_MAX_BINDINGS);
+        return false;
+    }
+    SpirvBinding* b = &out->bindings[out->binding_count++];
+    b->set = variable->set != none ? variable->set : 0;
+    b->binding = variable->binding != none ? variable->binding : 0;
+    b->kind = kind;
+    b->count = count;
+    return true;
+}
+
+static bool reflect_variables(const Module* m, SpirvReflection* out)
+{
+    for (uint32_t id = 1; id < m->bound; ++id)
+    {
+        const uint32_t* v = type_of(m, id);
+        if (!v || opcode(v) != OP_VARIABLE)
+            continue;
+        const uint32_t* pointer = type_of(m, v[1]);
+        if (!pointer || opcode(pointer) != OP_TYPE_POINTER)
+            return false;
+        const uint32_t storage = v[3];
+        const SpirvId* variable = &m->ids[id];
+        if (storage == STORAGE_INPUT)
+        {
+            if (out->stage == SPIRV_STAGE_VERTEX && !variable->built_in && variable->location != none
+                && add_inputs(m, pointer[3], variable->location, out, 0) < 0)
+                return false;
+        }
+        else if (storage == STORAGE_PUSH_CONSTANT)
+            out->push_constant_size = type_size(m, pointer[3], 0, false, 0);
+        else if (storage == STORAGE_UNIFORM_CONSTANT || storage == STORAGE_UNIFORM || storage == STORAGE_STORAGE_BUFFER)
+        {
+            if (!add_binding(m, variable, storage, pointer[3], out))
+            {
+                fprintf(stderr, "spirv_reflect: can't tell what the variable %u binds\n", id);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void sort_reflection(SpirvReflection* out)
+{
+    for (int i = 1; i < out->input_count; ++i)
+        for (int j = i; j > 0 && out->inputs[j - 1].location > out->inputs[j].location; --j)
+        {
+            const SpirvInput t = out->inputs[j];
+            out->inputs[j] = out->inputs[j - 1];
+            out->inputs[j - 1] = t;
+        }
+    for (int i = 1; i < out->binding_count; ++i)
+        for (int j = i; j > 0; --j)
+        {
+            const SpirvBinding* a = &out->bindings[j - 1];
+            const SpirvBinding* b = &out->bindings[j];
+            if (a->set < b->set || (a->set == b->set && a->binding <= b->binding))
+                break;
+            const SpirvBinding t = out->bindings[j];
+            out->bindings[j] = out->bindings[j - 1];
+            out->bindings[j - 1] = t;
+        }
+}
+
+bool spirv_reflect(const uint32_t* words, size_t size, SpirvReflection* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->stage = SPIRV_STAGE_OTHER;
+    const size_t count = size / sizeof(uint32_t);
+    if (count < 5 || words[0] != spirv_magic || !words[3] || words[3] > (1u << 22))
+    {
+        fprintf(stderr, "spirv_reflect: not a SPIR-V module\n");
+        return false;
+    }
+
+    Module m = { words, count, words[3], NULL };
+    m.ids = (SpirvId*)malloc(sizeof(SpirvId) * m.bound);
+    if (!m.ids)
+        return false;
+    for (uint32_t i = 0; i < m.bound; ++i)
+    {
+        m.ids[i].def = 0;
+        m.ids[i].location = m.ids[i].binding = m.ids[i].set = m.ids[i].array_stride = none;
+        m.ids[i].built_in = m.ids[i].buffer_block = false;
+    }
+
+    // One pass for the definitions, the decorations and the entry point
+    bool ok = true, entry = false;
+    for (size_t at = 5; at < count && ok; )
+    {
+        const uint32_t* w = words + at;
+        const uint32_t length = w[0] >> 16, op = opcode(w);
+        if (!length || at + length > count)
+        {
+            ok = false;
+            break;
+        }
+        uint32_t result = 0;
+        if ((op >= OP_TYPE_INT && op <= OP_TYPE_POINTER) || op == OP_TYPE_ACCELERATION_STRUCTURE)
+            result = length > 1 ? w[1] : 0;
+        else if (op == OP_CONSTANT || op == OP_VARIABLE)
+            result = length > 3 ? w[2] : 0;
+        else if (op == OP_DECORATE && length > 2 && w[1] < m.bound)
+        {
+            SpirvId* target = &m.ids[w[1]];
+            const uint32_t literal = length > 3 ? w[3] : 0;
+            if (w[2] == DECORATION_LOCATION)
+                target->location = literal;
+            else if (w[2] == DECORATION_BINDING)
+                target->binding = literal;
+            else if (w[2] == DECORATION_DESCRIPTOR_SET)
+                target->set = literal;
+            else if (w[2] == DECORATION_ARRAY_STRIDE)
+                target->array_stride = literal;
+            else if (w[2] == DECORATION_BUILT_IN)
+                target->built_in = true;
+            else if (w[2] == DECORATION_BUFFER_BLOCK)
+                target->buffer_block = true;
+        }
+        else if (op == OP_ENTRY_POINT && length > 2 && !entry)
+        {
+            entry = true;
+            out->stage = w[1] == SPIRV_STAGE_VERTEX || w[1] == SPIRV_STAGE_FRAGMENT || w[1] == SPIRV_STAGE_COMPUTE
+                ? (SpirvStage)w[1] : SPIRV_STAGE_OTHER;
+        }
+        else if (op == OP_EXECUTION_MODE && length > 5 && w[2] == execution_mode_local_size)
+        {
+            out->local_size[0] = w[3];
+            out->local_size[1] = w[4];
+            out->local_size[2] = w[5];
+        }
+        if (result)
+        {
+            if (result >= m.bound)
+                ok = false;
+            else
+                m.ids[result].def = (uint32_t)at;
+        }
+        at += length;
+    }
+    if (!ok || !entry)
+        fprintf(stderr, "spirv_reflect: %s\n", ok ? "no entry point" : "malformed instruction stream");
+    ok = ok && entry && reflect_variables(&m, out);
+    free(m.ids);
+    if (ok)
+        sort_reflection(out);
+    return ok;
+}
+
+uint32_t spirv_input_size(const SpirvInput* input)
+{
+    return input->components * 4;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// What a SPIR-V module asks of the pipeline that runs it, read from the
+// module itself: the stage, a compute shader's workgroup size, the vertex
+// inputs' locations and formats, the descriptor bindings and the size of
+// the push constant block. Nothing here touches GL or Vulkan;
+// vk/vulkan_renderer.cpp builds the pipelines' vertex input state and
+// layouts from it rather than restating the shaders by hand, and checks the
+// host's push constant structs against it.
+//
+// Only what glslc emits for this repo's shaders is understood: one entry
+// point, inputs of 32-bit scalars, vectors and matrices (a matrix or array
+// takes a location a column or element), and blocks laid out with explicit
+// offsets and strides, a buffer reference in one taking a device address's
+// 8 bytes. Built-in inputs (gl_VertexIndex and the like) are left out.
+
+#define SPIRV_REFLECT_MAX_INPUTS 16         // locations
+#define SPIRV_REFLECT_MAX_BINDINGS 16
+
+// SPIR-V's execution models
+typedef enum SpirvStage
+{
+    SPIRV_STAGE_VERTEX = 0,
+    SPIRV_STAGE_FRAGMENT = 4,
+    SPIRV_STAGE_COMPUTE = 5,
+    SPIRV_STAGE_OTHER = 0x7fffffff
+} SpirvStage;
+
+typedef enum SpirvComponent
+{
+    SPIRV_COMPONENT_FLOAT,
+    SPIRV_COMPONENT_INT,
+    SPIRV_COMPONENT_UINT
+} SpirvComponent;
+
+typedef enum SpirvBindingKind
+{
+    SPIRV_BINDING_UNIFORM_BUFFER,
+    SPIRV_BINDING_STORAGE_BUFFER,
+    SPIRV_BINDING_SAMPLED_IMAGE,            // a combined image sampler
+    SPIRV_BINDING_TEXTURE,                  // an image without its sampler
+    SPIRV_BINDING_STORAGE_IMAGE,
+    SPIRV_BINDING_SAMPLER,
+    SPIRV_BINDING_ACCELERATION_STRUCTURE
+} SpirvBindingKind;
+
+// One location's worth of a vertex input
+typedef struct SpirvInput
+{
+    uint32_t location;
+    SpirvComponent component;               // 32 bits each
+    uint32_t components;                    // 1-4
+} SpirvInput;
+
+typedef struct SpirvBinding
+{
+    uint32_t set;
+    uint32_t binding;
+    SpirvBindingKind kind;
+    uint32_t count;                         // array elements, 1 for none
+} SpirvBinding;
+
+typedef struct SpirvReflection
+{
+    SpirvStage stage;
+    uint32_t local_size[3];                 // compute only, 0 otherwise
+    SpirvInput inputs[SPIRV_REFLECT_MAX_INPUTS];    // by location
+    int input_count;                        // 0 outside vertex shaders
+    SpirvBinding bindings[SPIRV_REFLECT_MAX_BINDINGS];  // by set, then binding
+    int binding_count;
+    uint32_t push_constant_size;            // bytes, the block's last member's end; 0 for none
+} SpirvReflection;
+
+// Reflects "size" bytes of SPIR-V (as glslc writes them, in the host's byte order). Logs and returns false when
+// it isn't a module this understands.
+bool spirv_reflect(const uint32_t* words, size_t size, SpirvReflection* out);
+
+// Bytes one input takes in a vertex buffer
+uint32_t spirv_input_size(const SpirvInput* input);
@@ -0,0 +1,153 @@
+#include "core/startup_profile.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdlib.h>
+
+static StartupEvent events[STARTUP_MAX_EVENTS];
+static std::atomic<int> event_count(0);
+static std::atomic<bool> recording(false);
+static std::atomic<bool> finished(false);
+static std::atomic<int> thread_count(0);
+static thread_local int thread_index = -1;
+static uint64_t origin_ticks;
+static int64_t origin_ns;
+static uint64_t first_frame_ticks;
+static int64_t first_frame_ns;
+
+int64_t startup_profile_now_ns(void)
+{
+    return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int own_thread(void)
+{
+    if (thread_index < 0)
+        thread_index = thread_count.fetch_add(1);
+    return thread_index;
+}
+
+void startup_profile_begin(void)
+{
+    origin_ticks = cpu_trace_now();
+    origin_ns = startup_profile_now_ns();
+    own_thread();
+    recording.store(true, std::memory_order_release);
+}
+
+bool startup_profile_active(void)
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+static void add_event(const char* name, uint64_t begin, uint64_t end, int64_t begin_ns, int64_t end_ns)
+{
+    if (!recording.load(std::memory_order_acquire))
+        return;
+    const int i = event_count.fetch_add(1);
+    if (i >= STARTUP_MAX_EVENTS)
+        return;
+    StartupEvent* e = &events[i];
+    e->name = name;
+    e->thread = own_thread();
+    e->begin = begin;
+    e->end = end;
+    e->begin_ns = begin_ns;
+    e->end_ns = end_ns;
+}
+
+void startup_profile_record(const char* name, uint64_t begin, int64_t begin_ns)
+{
+    add_event(name, begin, cpu_trace_now(), begin_ns, startup_profile_now_ns());
+}
+
+void startup_profile_milestone(const char* name)
+{
+    const uint64_t now = cpu_trace_now();
+    const int64_t now_ns = startup_profile_now_ns();
+    add_event(name, now, now, now_ns, now_ns);
+}
+
+double startup_profile_first_frame(void)
+{
+    if (!recording.load(std::memory_order_acquire) || finished.exchange(true))
+        return -1.0;
+    first_frame_ticks = cpu_trace_now();
+    first_frame_ns = startup_profile_now_ns();
+    add_event("first frame", first_frame_ticks, first_frame_ticks, first_frame_ns, first_frame_ns);
+    recording.store(false, std::memory_order_release);
+    return (double)(first_frame_ns - origin_ns) * 1e-6;
+}
+
+static int compare_begin(const void* a, const void* b)
+{
+    const StartupEvent* x = (const StartupEvent*)a;
+    const StartupEvent* y = (const StartupEvent*)b;
+    return x->begin_ns < y->begin_ns ? -1 : x->begin_ns > y->begin_ns ? 1 : x->thread - y->thread;
+}
+
+// The recorded events by start time; returns how many
+static int sorted_events(StartupEvent* out)
+{
+    const int count = event_count.load() < STARTUP_MAX_EVENTS ? event_count.load() : STARTUP_MAX_EVENTS;
+    for (int i = 0; i < count; ++i)
+        out[i] = events[i];
+    qsort(out, (size_t)count, sizeof(StartupEvent), compare_begin);
+    return count;
+}
+
+void startup_profile_print(FILE* out)
+{
+    if (!finished.load(std::memory_order_acquire))
+        return;
+    StartupEvent sorted[STARTUP_MAX_EVENTS];
+    const int count = sorted_events(sorted);
+    const double total_ms = (double)(first_frame_ns - origin_ns) * 1e-6;
+    fprintf(out, "startup: first frame %.1f ms after main (target %.0f ms%s)\n", total_ms, STARTUP_TARGET_MS,
+        total_ms > STARTUP_TARGET_MS ? ", missed" : "");
+    fprintf(out, "  %-28s thread   at ms    took ms\n", "phase");
+    // What no phase on any thread covered, from the union of the phases' intervals
+    int64_t covered_ns = 0, reach_ns = origin_ns;
+    for (int i = 0; i < count; ++i)
+    {
+        const StartupEvent* e = &sorted[i];
+        const double at = (double)(e->begin_ns - origin_ns) * 1e-6;
+        if (e->end_ns == e->begin_ns)
+            fprintf(out, "  %-28s %6d %8.1f          -\n", e->name, e->thread, at);
+        else
+            fprintf(out, "  %-28s %6d %8.1f %10.1f\n", e->name, e->thread, at, (double)(e->end_ns - e->begin_ns) * 1e-6);
+        if (e->end_ns > reach_ns)
+        {
+            covered_ns += e->end_ns - (e->begin_ns > reach_ns ? e->begin_ns : reach_ns);
+            reach_ns = e->end_ns;
+        }
+    }
+    fprintf(out, "  %-28s %6s %8s %10.1f\n", "(in no phase)", "", "", (double)(first_frame_ns - origin_ns - covered_ns) * 1e-6);
+    if (event_count.load() > STARTUP_MAX_EVENTS)
+        fprintf(out, "  %d more not recorded\n", event_count.load() - STARTUP_MAX_EVENTS);
+}
+
+void startup_profile_trace(void)
+{
+    if (!finished.load(std::memory_order_acquire) || !cpu_trace_active())
+        return;
+    StartupEvent sorted[STARTUP_MAX_EVENTS];
+    const int count = sorted_events(sorted);
+    const int threads = thread_count.load();
+    for (int t = 0; t < threads; ++t)
+    {
+        char name[CPU_TRACE_NAME_SIZE];
+        snprintf(name, sizeof(name), "startup %d", t);
+        const int track = cpu_trace_track(name);
+        if (track < 0)
+            return;
+        if (t == 0)
+            cpu_trace_emit(track, "startup", origin_ticks, first_frame_ticks);
+        for (int i = 0; i < count; ++i)
+        {
+            if (sorted[i].thread == t && sorted[i].end != sorted[i].begin)
+                cpu_trace_emit(track, sorted[i].name, sorted[i].begin, sorted[i].end);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "core/cpu_trace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Startup breakdown: how long the app takes from main's entry to its first
+// frame on screen, and what that time went on.
+//
+// STARTUP_SCOPE("name") times the rest of the enclosing block as a phase,
+// on whichever thread runs it (the main thread's setup and the render
+// thread's overlap once it starts); startup_profile_milestone marks an
+// instant, such as the window's first present. Phases and milestones are
+// recorded from startup_profile_begin until the first frame with the scene
+// in it (startup_profile_first_frame) and dropped after: the scopes cost a
+// clock read and a store while it lasts, a relaxed load after.
+//
+// --startup prints the phases in order with their thread and what none of
+// them covered, against STARTUP_TARGET_MS. With --trace they also go onto a
+// "startup" track of the CPU trace, which only starts recording once the
+// command line is read: the phases before it still show there.
+
+#define STARTUP_MAX_EVENTS 64
+#define STARTUP_TARGET_MS 200.0     // main's entry to the first frame with the scene in it
+
+typedef struct StartupEvent
+{
+    const char* name;       // borrowed, a string literal
+    int thread;             // 0 for the thread that called startup_profile_begin, then in order of first use
+    uint64_t begin;         // cpu_trace_now() ticks; begin == end for a milestone
+    uint64_t end;
+    int64_t begin_ns;       // steady_clock, for the report without a calibrated trace clock
+    int64_t end_ns;
+} StartupEvent;
+
+// Time zero: main's first statement, on the main thread. Recording runs until startup_profile_first_frame.
+void startup_profile_begin(void);
+
+// True between startup_profile_begin and the first frame
+bool startup_profile_active(void);
+
+// A finished phase or an instant; dropped outside startup or past STARTUP_MAX_EVENTS
+void startup_profile_record(const char* name, uint64_t begin, int64_t begin_ns);
+void startup_profile_milestone(const char* name);
+
+// The first frame with the scene in it is out: ends recording and returns its milliseconds since time zero.
+// Negative on every call after the first, and when startup_profile_begin never ran.
+double startup_profile_first_frame(void);
+
+// The phases and milestones by start time, their thread, and the time between main's entry and the first frame
+// none of the main thread's phases covered. Only once startup_profile_first_frame has returned.
+void startup_profile_print(FILE* out);
+
+// The same onto a "startup" track of the CPU trace, while it's recording
+void startup_profile_trace(void);
+
+int64_t startup_profile_now_ns(void);
+
+// Measures the enclosing block from construction to destruction
+typedef struct StartupScope
+{
+    const char* name;
+    uint64_t begin;         // 0 after startup
+    int64_t begin_ns;
+
+    explicit StartupScope(const char* n) : name(n), begin(startup_profile_active() ? cpu_trace_now() : 0),
+        begin_ns(begin ? startup_profile_now_ns() : 0) {}
+    ~StartupScope()
+    {
+        if (begin)
+            startup_profile_record(name, begin, begin_ns);
+    }
+} StartupScope;
+
+#define STARTUP_SCOPE(name) StartupScope CPU_TRACE_CONCAT(startup_scope_, __LINE__)(name)
@@ -0,0 +1,212 @@
+#include "core/task.h"
+
+#include <stdio.h>
+#include <thread>
+
+#define TASK_POLL_BATCH 64
+
+std::coroutine_handle<> Task::await_suspend(std::coroutine_handle<> caller) noexcept
+{
+    handle.promise().continuation = caller;
+    return handle;
+}
+
+bool Task::await_resume() const noexcept
+{
+    return handle && handle.promise().result;
+}
+
+std::coroutine_handle<> TaskPromise::Final::await_suspend(std::coroutine_handle<TaskPromise> h) noexcept
+{
+    TaskPromise& promise = h.promise();
+    const std::coroutine_handle<> next = promise.continuation ? promise.continuation : std::noop_coroutine();
+    if (promise.scheduler)
+    {
+        // Started by task_start: nothing owns it but the scheduler, so it goes now
+        --promise.scheduler->running;
+        h.destroy();
+    }
+    return next;
+}
+
+static bool push_wait(TaskScheduler* s, const TaskWait& wait)
+{
+    if (s->wait_count == TASK_MAX_WAITS)
+        return false;
+    s->waits[s->wait_count++] = wait;
+    return true;
+}
+
+bool TaskRead::await_suspend(std::coroutine_handle<> h) noexcept
+{
+    handle = h;
+    read.tag = (uint64_t)(uintptr_t)this;
+    read.done = 0;
+    if (!async_io_submit(scheduler->io, &read, 1))
+    {
+        fprintf(stderr, "task: the read queue is full, read of %u bytes failed\n", read.size);
+        return false;
+    }
+    ++scheduler->reads;
+    return true;
+}
+
+bool TaskJob::await_suspend(std::coroutine_handle<> h) noexcept
+{
+    TaskWait wait = {};
+    wait.kind = TASK_WAIT_JOB;
+    wait.handle = h;
+    wait.job = job;
+    // Without workers nothing but a wait on this thread would ever run it
+    if (scheduler->jobs->thread_count > 1 && push_wait(scheduler, wait))
+        return true;
+    job_wait(scheduler->jobs, job);
+    return false;
+}
+
+bool TaskUntil::await_suspend(std::coroutine_handle<> h) noexcept
+{
+    TaskWait wait = {};
+    wait.kind = TASK_WAIT_UNTIL;
+    wait.handle = h;
+    wait.ready = ready;
+    wait.data = data;
+    if (push_wait(scheduler, wait))
+        return true;
+    while (!ready(data))
+        std::this_thread::yield();
+    return false;
+}
+
+bool TaskFrame::await_suspend(std::coroutine_handle<> h) noexcept
+{
+    TaskWait wait = {};
+    wait.kind = TASK_WAIT_FRAME;
+    wait.handle = h;
+    return push_wait(scheduler, wait);
+}
+
+void task_scheduler_init(TaskScheduler* s, JobSystem* jobs, AsyncIo* io)
+{
+    s->jobs = jobs;
+    s->io = io;
+    s->wait_count = 0;
+    s->reads = 0;
+    s->running = 0;
+    s->frame = 0;
+    s->resumed = 0;
+}
+
+void task_scheduler_destroy(TaskScheduler* s)
+{
+    if (s->running)
+        fprintf(stderr, "task: %d tasks still running at shutdown (%u reads in flight)\n", s->running, s->reads);
+    s->wait_count = 0;
+    s->running = 0;
+}
+
+void task_start(TaskScheduler* s, Task task)
+{
+    if (!task.handle)
+        return;
+    std::coroutine_handle<TaskPromise> handle = task.handle;
+    task.handle = {};
+    handle.promise().scheduler = s;
+    ++s->running;
+    ++s->resumed;
+    handle.resume();
+}
+
+// Resumes the waits that are over, the frame waits only with "frame". Waits added while resuming are left for the
+// next pass, which keeps a task that waits on a condition again and again from spinning here.
+static int resume_waits(TaskScheduler* s, bool frame)
+{
+    std::coroutine_handle<> ready[TASK_MAX_WAITS];
+    int count = 0;
+    int kept = 0;
+    for (int i = 0; i < s->wait_count; ++i)
+    {
+        const TaskWait& wait = s->waits[i];
+        bool over = false;
+        switch (wait.kind)
+        {
+        case TASK_WAIT_JOB: over = job_finished(wait.job); break;
+        case TASK_WAIT_UNTIL: over = wait.ready(wait.data); break;
+        case TASK_WAIT_FRAME: over = frame; break;
+        }
+        if (over)
+            ready[count++] = wait.handle;
+        else
+            s->waits[kept++] = wait;
+    }
+    s->wait_count = kept;
+    for (int i = 0; i < count; ++i)
+        ready[i].resume();
+    s->resumed += (uint64_t)count;
+    return count;
+}
+
+static int resume_reads(TaskScheduler* s, bool wait)
+{
+    if (!s->reads)
+        return 0;
+    AsyncIoCompletion completions[TASK_POLL_BATCH];
+    int resumed = 0;
+    uint32_t n;
+    while ((n = async_io_poll(s->io, completions, TASK_POLL_BATCH, wait)) > 0)
+    {
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            TaskRead* read = (TaskRead*)(uintptr_t)completions[i].tag;
+            read->result = completions[i].result;
+            --s->reads;
+            read->handle.resume();      // may submit its next read: it comes back in a later poll
+        }
+        resumed += (int)n;
+        wait = false;
+        if (!s->reads)
+            break;
+    }
+    s->resumed += (uint64_t)resumed;
+    return resumed;
+}
+
+int task_scheduler_poll(TaskScheduler* s)
+{
+    return resume_reads(s, false) + resume_waits(s, false);
+}
+
+int task_scheduler_frame(TaskScheduler* s)
+{
+    ++s->frame;
+    return resume_waits(s, true) + resume_reads(s, false);
+}
+
+void task_scheduler_drain(TaskScheduler* s)
+{
+    while (s->running)
+    {
+        if (task_scheduler_frame(s))
+            continue;
+        // Nothing was ready: block on a read if there's one in flight, else help with a job being waited for
+        if (s->reads)
+        {
+            resume_reads(s, true);
+            continue;
+        }
+        bool waited = false;
+        for (int i = 0; i < s->wait_count && !waited; ++i)
+        {
+            if (s->waits[i].kind == TASK_WAIT_JOB)
+            {
+                job_wait(s->jobs, s->waits[i].job);
+                waited = true;
+            }
+        }
+        if (!waited && !s->wait_count)
+        {
+            fprintf(stderr, "task: %d tasks can't make progress, stopping the drain\n", s->running);
+            return;
+        }
+    }
+}
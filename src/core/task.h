@@ -0,0 +1,209 @@
+#pragma once
+
+#include "core/async_io.h"
+#include "core/job_system.h"
+
+#include <coroutine>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Coroutine tasks for asynchronous loading: a chain like read, decompress,
+// transcode, upload, fence is written top to bottom, with a co_await at each
+// step that has to wait, instead of as callbacks or a state machine.
+//
+//     Task load_mesh(TaskScheduler* s, MeshLoad* load)
+//     {
+//         const int64_t n = co_await task_read(s, read);         // async_io
+//         co_await task_run(s, decompress, &load, sizeof(load)); // a job
+//         co_await task_next_frame(s);                           // upload at the frame's start
+//         co_await task_gl_fence(s, fence);                      // gl/gl_task.h
+//         co_return n > 0;
+//     }
+//
+// A Task finishes with true or false. It starts suspended: task_start hands
+// it to the scheduler, which runs it and frees it when it ends, and another
+// task can co_await it, which runs it to its end and gives its result.
+//
+// The scheduler lives on one thread, the job system's owning thread (it
+// creates jobs), and every task runs there. task_scheduler_poll resumes the
+// tasks whose waits are over: reads completed (it polls the AsyncIo, which
+// nothing else may), jobs finished, conditions met. task_scheduler_frame
+// also resumes the ones waiting for the next frame, and is called once a
+// frame; task_scheduler_drain runs everything to its end, blocking on I/O
+// between rounds, for a loading screen or a tool.
+//
+// A task's arguments are copied into its coroutine frame (heap allocated),
+// so they should be values, or pointers to what outlives it. There are no
+// exceptions: an escaping one aborts. Waits beyond TASK_MAX_WAITS don't
+// suspend: a job or condition is waited for in place, a frame isn't. So is
+// every job in a job system without workers.
+
+#define TASK_MAX_WAITS 256          // job, condition and next-frame waits at once; reads don't count
+
+typedef struct TaskScheduler TaskScheduler;
+struct TaskPromise;
+
+struct Task
+{
+    using promise_type = TaskPromise;
+    std::coroutine_handle<TaskPromise> handle;
+
+    Task() : handle() {}
+    explicit Task(std::coroutine_handle<TaskPromise> h) : handle(h) {}
+    Task(Task&& other) noexcept : handle(other.handle) { other.handle = {}; }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    // Awaited by another task: runs to its end, then resumes that one with its result
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept;
+    bool await_resume() const noexcept;
+};
+
+struct TaskPromise
+{
+    std::coroutine_handle<> continuation;   // the task awaiting this one
+    TaskScheduler* scheduler = NULL;        // set by task_start: the task frees itself at its end
+    bool result = false;
+
+    struct Final
+    {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<TaskPromise> h) noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    Task get_return_object() { return Task(std::coroutine_handle<TaskPromise>::from_promise(*this)); }
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    Final final_suspend() const noexcept { return {}; }
+    void return_value(bool value) { result = value; }
+    void unhandled_exception() { abort(); }
+};
+
+typedef enum TaskWaitKind
+{
+    TASK_WAIT_JOB,
+    TASK_WAIT_UNTIL,
+    TASK_WAIT_FRAME
+} TaskWaitKind;
+
+typedef struct TaskWait
+{
+    TaskWaitKind kind;
+    std::coroutine_handle<> handle;
+    Job* job;                       // TASK_WAIT_JOB
+    bool (*ready)(void* data);      // TASK_WAIT_UNTIL
+    void* data;
+} TaskWait;
+
+struct TaskScheduler
+{
+    JobSystem* jobs;
+    AsyncIo* io;
+    TaskWait waits[TASK_MAX_WAITS];
+    int wait_count;
+    uint32_t reads;                 // tasks' reads not yet completed
+    int running;                    // started with task_start and not finished
+    uint64_t frame;                 // task_scheduler_frame calls
+    uint64_t resumed;               // every resumption, for reporting
+};
+
+// co_await task_read(s, read): the bytes read (fewer than asked only at the end of the file), or -1. The read's
+// tag is the scheduler's.
+struct TaskRead
+{
+    TaskScheduler* scheduler;
+    AsyncIoRead read;
+    std::coroutine_handle<> handle;
+    int64_t result;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h) noexcept;
+    int64_t await_resume() const noexcept { return result; }
+};
+
+// co_await task_job(s, job): resumes once the job (and its children) has finished
+struct TaskJob
+{
+    TaskScheduler* scheduler;
+    Job* job;
+
+    bool await_ready() const noexcept { return !job || job_finished(job); }
+    bool await_suspend(std::coroutine_handle<> h) noexcept;
+    void await_resume() const noexcept {}
+};
+
+// co_await task_until(s, ready, data): resumes once ready(data) is true, checked at each poll
+struct TaskUntil
+{
+    TaskScheduler* scheduler;
+    bool (*ready)(void* data);
+    void* data;
+
+    bool await_ready() const noexcept { return ready(data); }
+    bool await_suspend(std::coroutine_handle<> h) noexcept;
+    void await_resume() const noexcept {}
+};
+
+// co_await task_next_frame(s): resumes at the next task_scheduler_frame
+struct TaskFrame
+{
+    TaskScheduler* scheduler;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h) noexcept;
+    void await_resume() const noexcept {}
+};
+
+static inline TaskRead task_read(TaskScheduler* s, const AsyncIoRead& read)
+{
+    return { s, read, {}, -1 };
+}
+
+static inline TaskJob task_job(TaskScheduler* s, Job* job)
+{
+    return { s, job };
+}
+
+// Creates and runs a job of "function" over a copy of "data" (up to JOB_DATA_SIZE bytes), to be awaited. When
+// the job can't be created (job_create reports why) its job is NULL, and awaiting it resumes straight away.
+static inline TaskJob task_run(TaskScheduler* s, JobFunction function, const void* data, size_t size)
+{
+    Job* job = job_create(s->jobs, function, data, size);
+    if (job)
+        job_run(s->jobs, job);
+    return { s, job };
+}
+
+static inline TaskUntil task_until(TaskScheduler* s, bool (*ready)(void* data), void* data)
+{
+    return { s, ready, data };
+}
+
+static inline TaskFrame task_next_frame(TaskScheduler* s)
+{
+    return { s };
+}
+
+// "io" is polled by the scheduler only from now on
+void task_scheduler_init(TaskScheduler* s, JobSystem* jobs, AsyncIo* io);
+// Logs the tasks still running, which are leaked: drain first
+void task_scheduler_destroy(TaskScheduler* s);
+
+// Runs "task" until its first wait; the scheduler frees it when it ends
+void task_start(TaskScheduler* s, Task task);
+
+// Resumes the tasks whose reads, jobs and conditions are done. Returns how many it resumed.
+int task_scheduler_poll(TaskScheduler* s);
+
+// A new frame: resumes the tasks waiting for it, then polls
+int task_scheduler_frame(TaskScheduler* s);
+
+// Runs until every started task has ended, a frame a round; waits on I/O or helps with a job when nothing is ready
+void task_scheduler_drain(TaskScheduler* s);
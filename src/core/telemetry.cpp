@@ -0,0 +1,343 @@
+#include "core/telemetry.h"
+
+#include <chrono>
+#include <mutex>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+std::atomic<bool> telemetry_enabled(false);
+
+static TelemetryRecord ring[TELEMETRY_RECORDS];
+static std::atomic<uint64_t> written(0);
+static char file_path[1024];
+static int64_t started;
+static std::chrono::steady_clock::time_point start;
+static std::mutex flush_mutex;
+static unsigned char snapshot[sizeof(ring)];    // telemetry_flush's checked copy of the ring; telemetry_read's file
+
+static double seconds(void)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void telemetry_record(TelemetryType type, uint32_t frame, const float* values, const char* label)
+{
+    if (!telemetry_active())
+        return;
+    const uint64_t index = written.fetch_add(1, std::memory_order_relaxed);
+    TelemetryRecord* r = &ring[index & (TELEMETRY_RECORDS - 1)];
+    r->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);   // the 0 before any of the new contents
+    r->time = seconds();
+    r->type = (uint32_t)type;
+    r->frame = frame;
+    for (int i = 0; i < 4; ++i)
+        r->values[i] = values ? values[i] : 0.f;
+    int n = 0;
+    for (; label && label[n] && n < TELEMETRY_LABEL_SIZE - 1; ++n)
+        r->label[n] = label[n];
+    memset(r->label + n, 0, TELEMETRY_LABEL_SIZE - n);
+    r->sequence.store(index + 1, std::memory_order_release);
+}
+
+// Only what's safe in a signal handler from here to the handlers: no locks, no allocation, no stdio
+
+static void append(char* out, size_t size, const char* text)
+{
+    size_t n = strlen(out);
+    for (; *text && n + 1 < size; ++text)
+        out[n++] = *text;
+    out[n] = 0;
+}
+
+static void append_number(char* out, size_t size, uint64_t value, int base)
+{
+    char digits[24];
+    int n = 0;
+    do
+    {
+        digits[n++] = "0123456789ABCDEF"[value % base];
+        value /= base;
+    } while (value);
+    char text[24];
+    for (int i = 0; i < n; ++i)
+        text[i] = digits[n - 1 - i];
+    text[n] = 0;
+    append(out, size, text);
+}
+
+static bool write_file(const char* reason, const void* records, uint64_t count)
+{
+    TelemetryFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TELEMETRY_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.record_size = sizeof(TelemetryRecord);
+    header.record_count = TELEMETRY_RECORDS;
+    header.written = count;
+    header.started = started;
+    header.time = seconds();
+    append(header.reason, sizeof(header.reason), reason);
+#ifdef _WIN32
+    HANDLE file = CreateFileA(file_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    DWORD n = 0;
+    bool ok = WriteFile(file, &header, sizeof(header), &n, NULL) && n == sizeof(header)
+        && WriteFile(file, records, (DWORD)sizeof(ring), &n, NULL) && n == sizeof(ring);
+    CloseHandle(file);
+#else
+    const int fd = open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    bool ok = true;
+    const void* parts[2] = { &header, records };
+    const size_t sizes[2] = { sizeof(header), sizeof(ring) };
+    for (int i = 0; i < 2 && ok; ++i)
+    {
+        const char* p = (const char*)parts[i];
+        for (size_t left = sizes[i]; left > 0 && ok;)
+        {
+            const ssize_t n = write(fd, p, left);
+            ok = n > 0;
+            p += ok ? n : 0;
+            left -= ok ? (size_t)n : 0;
+        }
+    }
+    ok = close(fd) == 0 && ok;
+#endif
+    return ok;
+}
+
+// The ring as it is: a record being written as the process died is dropped by its sequence
+#ifdef _WIN32
+static void on_abort(int signal_number)
+{
+    write_file("abort", ring, written.load(std::memory_order_relaxed));
+    signal(SIGABRT, SIG_DFL);
+    raise(SIGABRT);
+}
+
+static LONG WINAPI on_exception(EXCEPTION_POINTERS* exception)
+{
+    char reason[TELEMETRY_REASON_SIZE] = "exception 0x";
+    append_number(reason, sizeof(reason), exception->ExceptionRecord->ExceptionCode, 16);
+    write_file(reason, ring, written.load(std::memory_order_relaxed));
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+#else
+static void on_signal(int signal_number)
+{
+    char reason[TELEMETRY_REASON_SIZE] = "signal ";
+    append_number(reason, sizeof(reason), (uint64_t)signal_number, 10);
+    write_file(reason, ring, written.load(std::memory_order_relaxed));
+    raise(signal_number);       // SA_RESETHAND put the default back: the process dies as it would have
+}
+#endif
+
+bool telemetry_init(const char* path)
+{
+    if (telemetry_active())
+        return true;
+    if (strlen(path) >= sizeof(file_path))
+    {
+        fprintf(stderr, "telemetry: the path %s is too long\n", path);
+        return false;
+    }
+    strcpy(file_path, path);
+    started = (int64_t)time(NULL);
+    start = std::chrono::steady_clock::now();
+#ifdef _WIN32
+    SetUnhandledExceptionFilter(on_exception);
+    signal(SIGABRT, on_abort);
+#else
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND;
+    static const int fatal[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGTERM };
+    for (int s : fatal)
+        sigaction(s, &action, NULL);
+#endif
+    telemetry_enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+bool telemetry_flush(const char* reason)
+{
+    if (!telemetry_active())
+        return false;
+    std::lock_guard<std::mutex> lock(flush_mutex);
+    const uint64_t count = written.load(std::memory_order_acquire);
+    for (int i = 0; i < TELEMETRY_RECORDS; ++i)
+    {
+        // A seqlock's read: a record rewritten while it was copied reads differently before and after
+        const uint64_t before = ring[i].sequence.load(std::memory_order_acquire);
+        memcpy(snapshot + sizeof(TelemetryRecord) * i, (const void*)&ring[i], sizeof(TelemetryRecord));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (ring[i].sequence.load(std::memory_order_relaxed) != before)
+            memset(snapshot + sizeof(TelemetryRecord) * i, 0, sizeof(uint64_t));
+    }
+    if (!write_file(reason, snapshot, count))
+    {
+        fprintf(stderr, "telemetry: can't write %s\n", file_path);
+        return false;
+    }
+    printf("telemetry: the last %llu records written to %s (%s)\n",
+        (unsigned long long)(count < TELEMETRY_RECORDS ? count : TELEMETRY_RECORDS), file_path, reason);
+    return true;
+}
+
+int telemetry_read(const char* path, TelemetryFileHeader* header, TelemetryRecord* records)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        fprintf(stderr, "telemetry: can't open %s\n", path);
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(flush_mutex);      // read through the flush's buffer
+    const bool ok = fread(header, sizeof(*header), 1, f) == 1 && header->magic == TELEMETRY_MAGIC
+        && header->version == TELEMETRY_VERSION && header->record_size == sizeof(TelemetryRecord)
+        && header->record_count == TELEMETRY_RECORDS && fread(snapshot, sizeof(ring), 1, f) == 1;
+    fclose(f);
+    if (!ok)
+    {
+        fprintf(stderr, "telemetry: %s isn't a telemetry file of this version\n", path);
+        return -1;
+    }
+    header->reason[TELEMETRY_REASON_SIZE - 1] = 0;
+
+    // The last TELEMETRY_RECORDS written, each where its sequence says it should be
+    int count = 0;
+    const uint64_t first = header->written > TELEMETRY_RECORDS ? header->written - TELEMETRY_RECORDS : 0;
+    for (uint64_t index = first; index < header->written; ++index)
+    {
+        const unsigned char* slot = snapshot + sizeof(TelemetryRecord) * (index & (TELEMETRY_RECORDS - 1));
+        uint64_t sequence;
+        memcpy(&sequence, slot, sizeof(sequence));
+        if (sequence != index + 1)
+            continue;
+        memcpy((void*)&records[count], slot, sizeof(TelemetryRecord));
+        records[count].label[TELEMETRY_LABEL_SIZE - 1] = 0;
+        ++count;
+    }
+    return count;
+}
+
+typedef struct TelemetryPassTotals
+{
+    const char* name;
+    uint64_t count;
+    double cpu_ms, gpu_ms, gpu_max_ms;
+} TelemetryPassTotals;
+
+bool telemetry_print(const char* path, FILE* out)
+{
+    TelemetryFileHeader header;
+    TelemetryRecord* records = (TelemetryRecord*)malloc(sizeof(ring));
+    const int count = records ? telemetry_read(path, &header, records) : -1;
+    if (count < 0)
+    {
+        free(records);
+        return false;
+    }
+    char when[64] = "?";
+    const time_t started_at = (time_t)header.started;
+    if (const struct tm* local = localtime(&started_at))
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", local);
+    fprintf(out, "telemetry: %s, %.1f s after a start at %s; %d records of %llu written\n", header.reason,
+        header.time, when, count, (unsigned long long)header.written);
+
+    // A summary: the frames, the worst of them, the hitches and errors, and the passes' averages
+    uint64_t frames = 0, hitches = 0, errors = 0;
+    double frame_ms = 0.0, worst_ms = 0.0, worst_time = 0.0;
+    uint32_t worst_frame = 0;
+    TelemetryPassTotals passes[32];
+    int pass_count = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const TelemetryRecord* r = &records[i];
+        if (r->type == TELEMETRY_FRAME)
+        {
+            ++frames;
+            frame_ms += r->values[0];
+            if (r->values[0] > worst_ms)
+            {
+                worst_ms = r->values[0];
+                worst_frame = r->frame;
+                worst_time = r->time - header.time;
+            }
+        }
+        hitches += r->type == TELEMETRY_HITCH;
+        errors += r->type == TELEMETRY_ERROR;
+        if (r->type != TELEMETRY_PASS)
+            continue;
+        int k = 0;
+        while (k < pass_count && strcmp(passes[k].name, r->label))
+            ++k;
+        if (k == pass_count && pass_count < (int)(sizeof(passes) / sizeof(passes[0])))
+        {
+            memset(&passes[pass_count], 0, sizeof(passes[0]));
+            passes[pass_count++].name = r->label;
+        }
+        if (k < pass_count)
+        {
+            ++passes[k].count;
+            passes[k].cpu_ms += r->values[0];
+            passes[k].gpu_ms += r->values[1];
+            passes[k].gpu_max_ms = r->values[1] > passes[k].gpu_max_ms ? r->values[1] : passes[k].gpu_max_ms;
+        }
+    }
+    if (frames)
+        fprintf(out, "  %llu frames, %.2f ms on average; the worst %.2f ms (frame %u, %.3f s before the end)\n",
+            (unsigned long long)frames, frame_ms / frames, worst_ms, worst_frame, worst_time);
+    fprintf(out, "  %llu hitches, %llu errors\n", (unsigned long long)hitches, (unsigned long long)errors);
+    for (int k = 0; k < pass_count; ++k)
+        fprintf(out, "  %-24s %6llu times, %.3f ms CPU, %.3f ms GPU on average, %.3f ms GPU at most\n", passes[k].name,
+            (unsigned long long)passes[k].count, passes[k].cpu_ms / passes[k].count, passes[k].gpu_ms / passes[k].count,
+            passes[k].gpu_max_ms);
+
+    // Every record, its time counted back from when the file was written
+    static const char* type_names[TELEMETRY_TYPE_COUNT] = { "?", "frame", "pass", "memory", "hitch", "error" };
+    for (int i = 0; i < count; ++i)
+    {
+        const TelemetryRecord* r = &records[i];
+        const char* type = r->type < TELEMETRY_TYPE_COUNT ? type_names[r->type] : "?";
+        fprintf(out, "%10.4f s  %7u  %-6s ", r->time - header.time, r->frame, type);
+        switch (r->type)
+        {
+        case TELEMETRY_FRAME:
+        case TELEMETRY_HITCH:
+            fprintf(out, "%.2f ms (median %.2f ms)\n", r->values[0], r->values[1]);
+            break;
+        case TELEMETRY_PASS:
+            fprintf(out, "%-24s %.3f ms CPU, %.3f ms GPU\n", r->label, r->values[0], r->values[1]);
+            break;
+        case TELEMETRY_MEMORY:
+            fprintf(out, "%.1f MB video memory (budget %.0f MB, driver's free %.0f MB), %.1f MB heap\n", r->values[0],
+                r->values[1], r->values[2], r->values[3]);
+            break;
+        case TELEMETRY_ERROR:
+            fprintf(out, "%s (%.0f)\n", r->label, r->values[0]);
+            break;
+        default:
+            fprintf(out, "%s\n", r->label);
+            break;
+        }
+    }
+    free(records);
+    return true;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// A flight recorder for the field: the last few seconds of frame times, pass
+// timings, memory counters, hitches and errors, kept in memory at all times
+// and written to a file when the process crashes, is killed, or is asked to
+// (T, telemetry_flush). The file is read back with telemetry_print
+// (--telemetry-print FILE).
+//
+// The records live in one static ring of TELEMETRY_RECORDS fixed-size
+// slots, so recording never allocates and the ring is there to write however
+// the process dies. Any thread records: a fetch_add on the ring's count
+// picks the slot, the record is filled in, and its sequence number (its
+// place among every record written) is stored last. A slot being rewritten
+// holds sequence 0, so a reader keeps only records whose sequence matches
+// their place, and a record torn by a crash or a concurrent writer is
+// dropped rather than misread. Until telemetry_init a record costs one
+// relaxed load.
+//
+// telemetry_init installs handlers for the fatal signals (SIGSEGV, SIGBUS,
+// SIGFPE, SIGILL, SIGABRT, and SIGTERM for a watchdog killing a hung
+// process; an unhandled exception filter and SIGABRT on Windows). Each
+// writes the ring with nothing but open/write/close, then lets the process
+// die as it would have. Records are 64 bytes: at 60 frames a second with a
+// dozen passes each, the ring covers about 20 seconds.
+
+#define TELEMETRY_RECORDS 16384             // a power of two
+#define TELEMETRY_LABEL_SIZE 24
+#define TELEMETRY_REASON_SIZE 32
+#define TELEMETRY_MAGIC 0x314D4C54u         // "TLM1"
+#define TELEMETRY_VERSION 1u
+
+typedef enum TelemetryType
+{
+    TELEMETRY_FRAME = 1,        // frame ms, the stutter threshold's median ms
+    TELEMETRY_PASS,             // label: the pass; CPU ms, GPU ms
+    TELEMETRY_MEMORY,           // video memory tracked MB, its budget MB (0: none), the driver's free MB (-1: not
+                                // known), CPU heap MB (-1: not tracked)
+    TELEMETRY_HITCH,            // frame ms, the median ms it was measured against
+    TELEMETRY_ERROR,            // label: the message, cut short; the error's code
+    TELEMETRY_TYPE_COUNT
+} TelemetryType;
+
+typedef struct TelemetryRecord
+{
+    std::atomic<uint64_t> sequence;     // its place among the records written, from 1, stored last; 0 while written
+    double time;                // seconds since telemetry_init
+    uint32_t type;              // TelemetryType
+    uint32_t frame;
+    float values[4];            // by type, above
+    char label[TELEMETRY_LABEL_SIZE];   // NUL-terminated, cut short
+} TelemetryRecord;
+
+static_assert(sizeof(TelemetryRecord) == 64, "a record is a cache line, written whole");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the crash handlers write the ring as it is");
+
+// What a telemetry file starts with; TELEMETRY_RECORDS records follow, as they were in the ring
+typedef struct TelemetryFileHeader
+{
+    uint32_t magic;             // TELEMETRY_MAGIC
+    uint32_t version;           // TELEMETRY_VERSION
+    uint32_t record_size;       // sizeof(TelemetryRecord)
+    uint32_t record_count;      // TELEMETRY_RECORDS
+    uint64_t written;           // records ever written, as the file was
+    int64_t started;            // time() at telemetry_init: the records' times count from there
+    double time;                // seconds since telemetry_init, as the file was
+    char reason[TELEMETRY_REASON_SIZE];     // "signal 11", "key", ...
+} TelemetryFileHeader;
+
+extern std::atomic<bool> telemetry_enabled;
+
+static inline bool telemetry_active(void)
+{
+    return telemetry_enabled.load(std::memory_order_relaxed);
+}
+
+// Starts recording, once per process, into a ring written to "path" (copied) on a crash and by telemetry_flush.
+// Installs the crash handlers. Returns false (logged) when "path" is too long.
+bool telemetry_init(const char* path);
+
+// Appends a record; a no-op until telemetry_init. "values" may be NULL (all 0), "label" too.
+void telemetry_record(TelemetryType type, uint32_t frame, const float* values, const char* label);
+
+static inline void telemetry_frame(uint32_t frame, double frame_ms, double median_ms)
+{
+    if (!telemetry_active())
+        return;
+    const float values[4] = { (float)frame_ms, (float)median_ms, 0.f, 0.f };
+    telemetry_record(TELEMETRY_FRAME, frame, values, NULL);
+}
+
+static inline void telemetry_pass(uint32_t frame, const char* name, double cpu_ms, double gpu_ms)
+{
+    if (!telemetry_active())
+        return;
+    const float values[4] = { (float)cpu_ms, (float)gpu_ms, 0.f, 0.f };
+    telemetry_record(TELEMETRY_PASS, frame, values, name);
+}
+
+// Writes the ring to the file now, with "reason" in its header: the records whole at the time, each checked
+// against a concurrent writer. Thread-safe. Returns false (logged) when the file can't be written, or
+// telemetry_init hasn't run.
+bool telemetry_flush(const char* reason);
+
+// Reads a telemetry file: its header, and its whole records into "records" (room for TELEMETRY_RECORDS), oldest
+// first. Returns how many, -1 (logged) when it isn't one.
+int telemetry_read(const char* path, TelemetryFileHeader* header, TelemetryRecord* records);
+
+// Reads a telemetry file and prints it, oldest record first, with each record's time before the file was written
+// and a summary of the frames, hitches and errors in it. Returns false (logged) when it isn't one.
+bool telemetry_print(const char* path, FILE* out);
@@ -0,0 +1,132 @@
+#include "core/text_cache.h"
+
+#include "core/glyph_atlas.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+void text_cache_init(TextCache* cache)
+{
+    memset(cache, 0, sizeof(*cache));
+}
+
+int text_cache_add(TextCache* cache)
+{
+    if (cache->string_count == TEXT_MAX_STRINGS)
+        return -1;
+    TextString* s = &cache->strings[cache->string_count];
+    memset(s, 0, sizeof(*s));
+    return cache->string_count++;
+}
+
+// Lays the slot's text out at its position
+static void text_build(TextCache* cache, int slot)
+{
+    TextString* s = &cache->strings[slot];
+    TextQuad* quads = cache->quads[slot];
+    const float advance = GLYPH_FONT_WIDTH * s->scale, line = (GLYPH_FONT_HEIGHT + 1) * s->scale;
+    const float pad = GLYPH_ATLAS_PAD * s->scale;
+    const float width = (GLYPH_FONT_WIDTH + 2.f * GLYPH_ATLAS_PAD) * s->scale;
+    const float height = (GLYPH_FONT_HEIGHT + 2.f * GLYPH_ATLAS_PAD) * s->scale;
+    float x = s->x, y = s->y;
+    s->quad_count = 0;
+    for (const char* c = s->text; *c; ++c)
+    {
+        const unsigned char ch = (unsigned char)*c;
+        if (ch == '\n')
+        {
+            x = s->x;
+            y += line;
+            continue;
+        }
+        if (ch > ' ' && ch < GLYPH_ATLAS_FIRST + GLYPH_ATLAS_GLYPHS)
+        {
+            TextQuad* q = &quads[s->quad_count++];
+            q->rect[0] = x - pad;
+            q->rect[1] = y - pad;
+            q->rect[2] = width;
+            q->rect[3] = height;
+            q->glyph = ch - GLYPH_ATLAS_FIRST;
+            q->color = s->color;
+        }
+        x += advance;
+    }
+}
+
+void text_cache_set(TextCache* cache, int slot, float x, float y, float scale, uint32_t color, const char* text)
+{
+    if (slot < 0 || slot >= cache->string_count)
+        return;
+    TextString* s = &cache->strings[slot];
+    s->visible = true;
+    const size_t length = strnlen(text, TEXT_MAX_GLYPHS);
+    if (scale == s->scale && color == s->color && !strncmp(s->text, text, length) && s->text[length] == '\0')
+    {
+        if (x == s->x && y == s->y)
+        {
+            ++cache->reused;
+            return;
+        }
+        const float dx = x - s->x, dy = y - s->y;
+        for (uint32_t i = 0; i < s->quad_count; ++i)
+        {
+            cache->quads[slot][i].rect[0] += dx;
+            cache->quads[slot][i].rect[1] += dy;
+        }
+        s->x = x;
+        s->y = y;
+        ++cache->moved;
+        return;
+    }
+    memcpy(s->text, text, length);
+    s->text[length] = '\0';
+    s->x = x;
+    s->y = y;
+    s->scale = scale;
+    s->color = color;
+    text_build(cache, slot);
+    ++cache->built;
+}
+
+void text_cache_printf(TextCache* cache, int slot, float x, float y, float scale, uint32_t color, const char* format, ...)
+{
+    char text[TEXT_MAX_GLYPHS + 1];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    text_cache_set(cache, slot, x, y, scale, color, text);
+}
+
+void text_cache_show(TextCache* cache, int slot, bool visible)
+{
+    if (slot >= 0 && slot < cache->string_count)
+        cache->strings[slot].visible = visible;
+}
+
+uint32_t text_cache_gather(const TextCache* cache, TextQuad* out, uint32_t capacity)
+{
+    uint32_t count = 0;
+    for (int i = 0; i < cache->string_count; ++i)
+    {
+        const TextString* s = &cache->strings[i];
+        if (!s->visible)
+            continue;
+        const uint32_t n = s->quad_count < capacity - count ? s->quad_count : capacity - count;
+        memcpy(out + count, cache->quads[i], sizeof(TextQuad) * n);
+        count += n;
+    }
+    return count;
+}
+
+float text_width(const char* text, float scale)
+{
+    size_t longest = 0, length = 0;
+    for (; *text; ++text)
+    {
+        length = *text == '\n' ? 0 : length + 1;
+        longest = length > longest ? length : longest;
+    }
+    return longest * GLYPH_FONT_WIDTH * scale;
+}
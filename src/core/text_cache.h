@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Strings laid out once into glyph quads and kept until they change.
+//
+// Each string has a slot holding its text, position, scale and colour and
+// the quads they make. Setting a slot to what it already holds is a compare;
+// moving it only shifts its quads; anything else lays it out again. So a
+// label whose readout changes twice a second is rebuilt twice a second, not
+// every frame, and a screen of static text costs a copy per frame.
+// text_cache_gather concatenates the visible slots' quads for one instanced
+// draw (gl/hud.h's, which expands each quad in its vertex shader).
+//
+// A glyph's quad covers its atlas cell (core/glyph_atlas.h), padding
+// included, so the distance field's falloff has room; neighbouring quads
+// overlap by the padding, which blending makes invisible. Text is ASCII:
+// other bytes are skipped, and '\n' starts a new line. Nothing here calls GL.
+
+#define TEXT_MAX_STRINGS 128
+#define TEXT_MAX_GLYPHS 64          // per string; the rest of a longer one is dropped
+#define TEXT_SOLID 0xFFu            // TextQuad glyph for a filled rectangle
+
+// One instance: x, y, width, height in pixels from the top-left corner, a glyph (character - 32, or TEXT_SOLID) and
+// an RGBA8 colour with red in the low byte
+typedef struct TextQuad
+{
+    float rect[4];
+    uint32_t glyph;
+    uint32_t color;
+} TextQuad;
+
+typedef struct TextString
+{
+    char text[TEXT_MAX_GLYPHS + 1];
+    float x, y;                     // the first glyph's top-left corner, in pixels
+    float scale;                    // pixels per font pixel
+    uint32_t color;
+    uint32_t quad_count;
+    bool visible;
+} TextString;
+
+typedef struct TextCache
+{
+    TextString strings[TEXT_MAX_STRINGS];
+    TextQuad quads[TEXT_MAX_STRINGS][TEXT_MAX_GLYPHS];  // each slot's
+    int string_count;               // slots handed out
+    // text_cache_set calls since init
+    uint64_t built;                 // laid out again
+    uint64_t moved;                 // only shifted
+    uint64_t reused;                // unchanged
+} TextCache;
+
+void text_cache_init(TextCache* cache);
+
+// A new, empty and hidden slot; -1 when they're all taken
+int text_cache_add(TextCache* cache);
+
+// Makes the slot show "text" at x, y; visible until hidden
+void text_cache_set(TextCache* cache, int slot, float x, float y, float scale, uint32_t color, const char* text);
+
+// The same with printf formatting; a string that comes out the same is still only compared
+void text_cache_printf(TextCache* cache, int slot, float x, float y, float scale, uint32_t color, const char* format, ...);
+
+void text_cache_show(TextCache* cache, int slot, bool visible);
+
+// Copies the visible slots' quads, in slot order, into "out"; returns how many, at most "capacity"
+uint32_t text_cache_gather(const TextCache* cache, TextQuad* out, uint32_t capacity);
+
+// Width in pixels of the longest line of "text" at "scale"
+float text_width(const char* text, float scale);
@@ -0,0 +1,475 @@
+#include "core/tile_map.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t key_hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+static int table_find(const TileMap* map, uint64_t key)
+{
+    for (uint32_t i = key_hash(key) & map->table_mask;; i = (i + 1) & map->table_mask)
+    {
+        const int slot = map->table[i];
+        if (slot < 0 || map->slots[slot].key == key)
+            return slot;
+    }
+}
+
+static void table_insert(TileMap* map, int slot)
+{
+    uint32_t i = key_hash(map->slots[slot].key) & map->table_mask;
+    while (map->table[i] >= 0)
+        i = (i + 1) & map->table_mask;
+    map->table[i] = slot;
+}
+
+// Linear probing without tombstones: the entries after the hole that would no longer be found move back into it
+static void table_remove(TileMap* map, uint64_t key)
+{
+    uint32_t i = key_hash(key) & map->table_mask;
+    while (map->slots[map->table[i]].key != key)
+        i = (i + 1) & map->table_mask;
+    for (uint32_t j = (i + 1) & map->table_mask; map->table[j] >= 0; j = (j + 1) & map->table_mask)
+    {
+        const uint32_t home = key_hash(map->slots[map->table[j]].key) & map->table_mask;
+        if (((j - home) & map->table_mask) >= ((j - i) & map->table_mask))
+        {
+            map->table[i] = map->table[j];
+            i = j;
+        }
+    }
+    map->table[i] = -1;
+}
+
+static void list_unlink(TileMap* map, int slot)
+{
+    TileSlot* s = &map->slots[slot];
+    if (s->prev >= 0)
+        map->slots[s->prev].next = s->next;
+    else
+        map->head = s->next;
+    if (s->next >= 0)
+        map->slots[s->next].prev = s->prev;
+    else
+        map->tail = s->prev;
+    s->prev = s->next = -1;
+}
+
+static void list_push_front(TileMap* map, int slot)
+{
+    TileSlot* s = &map->slots[slot];
+    s->prev = -1;
+    s->next = map->head;
+    if (map->head >= 0)
+        map->slots[map->head].prev = slot;
+    else
+        map->tail = slot;
+    map->head = slot;
+}
+
+// Drawn or prefetched this frame: to the front of the list, if it's in it
+static void touch(TileMap* map, int slot)
+{
+    TileSlot* s = &map->slots[slot];
+    s->used = map->frame;
+    if (s->state == TILE_SLOT_RESIDENT && !s->pinned && map->head != slot)
+    {
+        list_unlink(map, slot);
+        list_push_front(map, slot);
+    }
+}
+
+bool tile_map_init(TileMap* map, int slot_count, int level_count, int tile_size, int max_loading, double lookahead)
+{
+    memset(map, 0, sizeof(*map));
+    if (slot_count <= TILE_MAP_PINNED_TILES)
+        return false;
+    map->slot_count = slot_count;
+    map->level_count = level_count < 1 ? 1 : level_count > TILE_MAP_MAX_LEVEL + 1 ? TILE_MAP_MAX_LEVEL + 1 : level_count;
+    map->tile_size = tile_size;
+    map->max_loading = max_loading < 1 ? 1 : max_loading;
+    map->lookahead = lookahead;
+    map->head = map->tail = -1;
+    uint32_t table_size = 1;
+    while (table_size < 2u * (uint32_t)slot_count)
+        table_size <<= 1;
+    map->table_mask = table_size - 1;
+    map->slots = (TileSlot*)malloc(sizeof(TileSlot) * slot_count);
+    map->free_slots = (int*)malloc(sizeof(int) * slot_count);
+    map->table = (int*)malloc(sizeof(int) * table_size);
+    if (!map->slots || !map->free_slots || !map->table)
+    {
+        tile_map_destroy(map);
+        return false;
+    }
+    for (uint32_t i = 0; i < table_size; ++i)
+        map->table[i] = -1;
+    for (int s = 0; s < slot_count; ++s)
+    {
+        map->slots[s].key = TILE_MAP_NO_KEY;
+        map->slots[s].state = TILE_SLOT_EMPTY;
+        map->slots[s].prev = map->slots[s].next = -1;
+        map->slots[s].used = 0;
+        map->slots[s].pinned = false;
+        map->free_slots[map->free_count++] = slot_count - 1 - s;    // slot 0 is taken first
+    }
+    return true;
+}
+
+void tile_map_destroy(TileMap* map)
+{
+    free(map->slots);
+    free(map->free_slots);
+    free(map->table);
+    free(map->candidates);
+    memset(map, 0, sizeof(*map));
+}
+
+uint64_t tile_map_key(int level, uint32_t x, uint32_t y)
+{
+    return (uint64_t)level << 58 | (uint64_t)y << 29 | x;
+}
+
+void tile_map_key_tile(uint64_t key, int* level, uint32_t* x, uint32_t* y)
+{
+    *level = (int)(key >> 58);
+    *y = (uint32_t)(key >> 29) & ((1u << 29) - 1);
+    *x = (uint32_t)key & ((1u << 29) - 1);
+}
+
+size_t tile_map_slot_bytes(const TileMap* map)
+{
+    return (size_t)map->tile_size * map->tile_size * 4;
+}
+
+// A slot for "key", loading from here on, and its request; -1 when the frame's requests, the loads in flight or
+// the slots free for it have run out
+static int request(TileMap* map, uint64_t key, bool prefetch, TileRequest* requests, int max_requests, int* count)
+{
+    if (*count >= max_requests || map->loading >= map->max_loading)
+        return -1;
+    int slot;
+    uint64_t evicted = TILE_MAP_NO_KEY;
+    if (map->free_count)
+        slot = map->free_slots[--map->free_count];
+    else if (map->tail >= 0 && map->slots[map->tail].used != map->frame)
+    {
+        slot = map->tail;       // the least recently used, and not by this frame
+        evicted = map->slots[slot].key;
+        list_unlink(map, slot);
+        table_remove(map, evicted);
+        ++map->stats.evicted;
+    }
+    else
+        return -1;
+    TileSlot* s = &map->slots[slot];
+    s->key = key;
+    s->state = TILE_SLOT_LOADING;
+    s->used = map->frame;
+    s->pinned = (int)(key >> 58) < TILE_MAP_PINNED_LEVELS;
+    table_insert(map, slot);
+    ++map->loading;
+    requests[*count].key = key;
+    requests[*count].slot = slot;
+    requests[*count].evicted = evicted;
+    requests[*count].prefetch = prefetch;
+    ++*count;
+    ++map->stats.requested;
+    map->stats.prefetched += prefetch;
+    return slot;
+}
+
+// The pinned levels come before anything, so a fallback is always there after the first frames
+static void request_pinned(TileMap* map, TileRequest* requests, int max_requests, int* count)
+{
+    const int pinned_levels = map->level_count < TILE_MAP_PINNED_LEVELS ? map->level_count : TILE_MAP_PINNED_LEVELS;
+    for (int l = 0; l < pinned_levels; ++l)
+        for (uint32_t y = 0; y < 1u << l; ++y)
+            for (uint32_t x = 0; x < 1u << l; ++x)
+            {
+                const uint64_t key = tile_map_key(l, x, y);
+                const int slot = table_find(map, key);
+                if (slot >= 0)
+                    touch(map, slot);
+                else
+                    request(map, key, false, requests, max_requests, count);
+            }
+}
+
+// The level whose texels come closest to one a pixel
+static int view_level(const TileMap* map, const double view[4], int width)
+{
+    const double texels = width / (view[2] - view[0]) / map->tile_size;     // per map unit, for a level 0 tile
+    const int level = (int)floor(log2(texels) + 0.5);
+    return level < 0 ? 0 : level >= map->level_count ? map->level_count - 1 : level;
+}
+
+static int compare_candidates(const void* a, const void* b)
+{
+    const double da = ((const TileCandidate*)a)->distance, db = ((const TileCandidate*)b)->distance;
+    return da < db ? -1 : da > db;
+}
+
+// The tiles of "level" across "view", nearest "centre" first, from the candidates scratch. Returns how many.
+static int gather(TileMap* map, int level, const double view[4], const double centre[2])
+{
+    const double n = (double)(1u << level);
+    const double x0 = fmax(view[0], 0.0) * n, y0 = fmax(view[1], 0.0) * n;
+    const double x1 = fmin(view[2], 1.0) * n, y1 = fmin(view[3], 1.0) * n;
+    if (x1 <= x0 || y1 <= y0)
+        return 0;
+    const uint32_t last = (1u << level) - 1;
+    const uint32_t tx0 = (uint32_t)x0, ty0 = (uint32_t)y0;
+    const uint32_t tx1 = (uint32_t)ceil(x1) - 1 < last ? (uint32_t)ceil(x1) - 1 : last;
+    const uint32_t ty1 = (uint32_t)ceil(y1) - 1 < last ? (uint32_t)ceil(y1) - 1 : last;
+    const uint64_t count = (uint64_t)(tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    if (count > (1u << 20))
+        return 0;               // a view no level fits; nothing sensible to load for it
+    if ((int)count > map->candidate_capacity)
+    {
+        TileCandidate* grown = (TileCandidate*)realloc(map->candidates, sizeof(TileCandidate) * count);
+        if (!grown)
+            return 0;
+        map->candidates = grown;
+        map->candidate_capacity = (int)count;
+    }
+    int k = 0;
+    for (uint32_t y = ty0; y <= ty1; ++y)
+        for (uint32_t x = tx0; x <= tx1; ++x)
+        {
+            const double dx = (x + 0.5) / n - centre[0], dy = (y + 0.5) / n - centre[1];
+            map->candidates[k].key = tile_map_key(level, x, y);
+            map->candidates[k++].distance = dx * dx + dy * dy;
+        }
+    qsort(map->candidates, k, sizeof(TileCandidate), compare_candidates);
+    return k;
+}
+
+int tile_map_update(TileMap* map, const double view[4], int width, int height, double dt, TileDraw* draws,
+    int max_draws, TileRequest* requests, int max_requests, int* request_count)
+{
+    ++map->frame;
+    memset(&map->stats, 0, sizeof(map->stats));
+    *request_count = 0;
+    for (int e = 0; e < 4; ++e)
+    {
+        const double v = map->tracking && dt > 0.0 ? (view[e] - map->last_view[e]) / dt : 0.0;
+        map->edge_velocity[e] = map->tracking ? 0.5 * map->edge_velocity[e] + 0.5 * v : 0.0;
+        map->last_view[e] = view[e];
+    }
+    map->tracking = true;
+    if (view[2] <= view[0] || view[3] <= view[1] || width < 1 || height < 1)
+        return 0;
+
+    request_pinned(map, requests, max_requests, request_count);
+    const int level = view_level(map, view, width);
+    map->view_level = level;
+    const double centre[2] = { 0.5 * (view[0] + view[2]), 0.5 * (view[1] + view[3]) };
+    const double px = width / (view[2] - view[0]), py = height / (view[3] - view[1]);
+    const int visible = gather(map, level, view, centre);
+    map->stats.visible = (unsigned int)visible;
+    int draw_count = 0;
+    for (int k = 0; k < visible; ++k)
+    {
+        const uint64_t key = map->candidates[k].key;
+        int l;
+        uint32_t x, y;
+        tile_map_key_tile(key, &l, &x, &y);
+        int slot = table_find(map, key);
+        if (slot >= 0)
+            touch(map, slot);
+        else
+            slot = request(map, key, false, requests, max_requests, request_count);
+
+        // Still loading: the nearest resident ancestor's part that covers the tile
+        int from = level;
+        while (from >= 0 && (slot < 0 || map->slots[slot].state != TILE_SLOT_RESIDENT))
+        {
+            --from;
+            slot = from >= 0 ? table_find(map, tile_map_key(from, x >> (level - from), y >> (level - from))) : -1;
+        }
+        if (from < 0)
+        {
+            ++map->stats.missing;
+            continue;
+        }
+        if (from != level)
+        {
+            touch(map, slot);
+            ++map->stats.fallback;
+        }
+        if (draw_count == max_draws)
+            continue;
+        TileDraw* d = &draws[draw_count++];
+        const double n = (double)(1u << level);
+        d->rect[0] = (float)((x / n - view[0]) * px);
+        d->rect[1] = (float)((y / n - view[1]) * py);
+        d->rect[2] = (float)(((x + 1) / n - view[0]) * px);
+        d->rect[3] = (float)(((y + 1) / n - view[1]) * py);
+        const uint32_t span = 1u << (level - from), mask = span - 1;
+        d->uv[0] = (float)(x & mask) / span;
+        d->uv[1] = (float)(y & mask) / span;
+        d->uv[2] = (float)((x & mask) + 1) / span;
+        d->uv[3] = (float)((y & mask) + 1) / span;
+        d->slot = slot;
+        d->level = from;
+    }
+
+    // The view the edges head for, at its own level, after everything in view
+    double ahead[4];
+    bool moving = false;
+    for (int e = 0; e < 4; ++e)
+    {
+        ahead[e] = view[e] + map->edge_velocity[e] * map->lookahead;
+        moving = moving || fabs(ahead[e] - view[e]) * (e & 1 ? py : px) >= 1.0;     // a pixel or more
+    }
+    if (moving && ahead[2] > ahead[0] && ahead[3] > ahead[1])
+    {
+        const int ahead_level = view_level(map, ahead, width);
+        const int count = gather(map, ahead_level, ahead, centre);
+        for (int k = 0; k < count; ++k)
+        {
+            const int slot = table_find(map, map->candidates[k].key);
+            if (slot >= 0)
+                touch(map, slot);
+            else if (request(map, map->candidates[k].key, true, requests, max_requests, request_count) < 0)
+                break;
+        }
+    }
+    map->total_requested += map->stats.requested;
+    map->total_evicted += map->stats.evicted;
+    return draw_count;
+}
+
+// Keys, or candidates by key (it comes first)
+static int compare_keys(const void* a, const void* b)
+{
+    const uint64_t ka = *(const uint64_t*)a, kb = *(const uint64_t*)b;
+    return ka < kb ? -1 : ka > kb;
+}
+
+static bool candidates_reserve(TileMap* map, int count)
+{
+    if (count <= map->candidate_capacity)
+        return true;
+    TileCandidate* grown = (TileCandidate*)realloc(map->candidates, sizeof(TileCandidate) * count);
+    if (!grown)
+        return false;
+    map->candidates = grown;
+    map->candidate_capacity = count;
+    return true;
+}
+
+int tile_map_feedback(TileMap* map, uint64_t* keys, int key_count, TileRequest* requests, int max_requests)
+{
+    ++map->frame;
+    memset(&map->stats, 0, sizeof(map->stats));
+    int request_count = 0;
+    request_pinned(map, requests, max_requests, &request_count);
+    qsort(keys, key_count, sizeof(uint64_t), compare_keys);
+    if (!candidates_reserve(map, key_count))
+        return request_count;
+
+    // Each distinct tile: resident, or the one below its nearest resident ancestor is a candidate, weighted by the
+    // pixels that asked for it
+    int candidate_count = 0;
+    for (int k = 0; k < key_count;)
+    {
+        int hits = 1;
+        while (k + hits < key_count && keys[k + hits] == keys[k])
+            ++hits;
+        int level;
+        uint32_t x, y;
+        tile_map_key_tile(keys[k], &level, &x, &y);
+        k += hits;
+        if (level >= map->level_count)
+        {
+            x >>= level - (map->level_count - 1);
+            y >>= level - (map->level_count - 1);
+            level = map->level_count - 1;
+        }
+        if (x >> level || y >> level)
+            continue;   // not a tile: the feedback's garbage
+        ++map->stats.visible;
+        uint64_t missing = TILE_MAP_NO_KEY;
+        int from = level;
+        for (; from >= 0; --from)
+        {
+            const uint64_t key = tile_map_key(from, x >> (level - from), y >> (level - from));
+            const int slot = table_find(map, key);
+            if (slot < 0)
+                missing = key;
+            else
+            {
+                touch(map, slot);       // a load still wanted, or what's drawn meanwhile
+                if (map->slots[slot].state == TILE_SLOT_RESIDENT)
+                    break;
+            }
+        }
+        map->stats.fallback += from != level;
+        map->stats.missing += from < 0;
+        if (missing != TILE_MAP_NO_KEY)
+        {
+            map->candidates[candidate_count].key = missing;
+            map->candidates[candidate_count++].distance = (double)hits;
+        }
+    }
+
+    // Paths that share a missing tile add up; then coarsest first, most asked for first within a level
+    qsort(map->candidates, candidate_count, sizeof(TileCandidate), compare_keys);
+    int unique = 0;
+    for (int c = 0; c < candidate_count; ++c)
+    {
+        if (unique && map->candidates[unique - 1].key == map->candidates[c].key)
+            map->candidates[unique - 1].distance += map->candidates[c].distance;
+        else
+            map->candidates[unique++] = map->candidates[c];
+    }
+    for (int c = 0; c < unique; ++c)
+    {
+        const double hits = map->candidates[c].distance;
+        map->candidates[c].distance = (double)(map->candidates[c].key >> 58) + 1.0 / (1.0 + hits);
+    }
+    qsort(map->candidates, unique, sizeof(TileCandidate), compare_candidates);
+    for (int c = 0; c < unique; ++c)
+    {
+        if (request(map, map->candidates[c].key, false, requests, max_requests, &request_count) < 0)
+            break;
+    }
+    map->total_requested += map->stats.requested;
+    map->total_evicted += map->stats.evicted;
+    return request_count;
+}
+
+void tile_map_loaded(TileMap* map, int slot)
+{
+    TileSlot* s = &map->slots[slot];
+    s->state = TILE_SLOT_RESIDENT;
+    s->used = map->frame;       // arriving counts as a use, so the list stays in the order of "used"
+    --map->loading;
+    if (!s->pinned)
+        list_push_front(map, slot);
+}
+
+void tile_map_cancel(TileMap* map, int slot)
+{
+    TileSlot* s = &map->slots[slot];
+    table_remove(map, s->key);
+    s->key = TILE_MAP_NO_KEY;
+    s->state = TILE_SLOT_EMPTY;
+    s->pinned = false;
+    --map->loading;
+    map->free_slots[map->free_count++] = slot;
+}
+
+bool tile_map_wanted(const TileMap* map, int slot)
+{
+    return map->slots[slot].used == map->frame;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Which tiles of a quadtree map to draw, keep and load, for an orthographic
+// view that pans and zooms over it.
+//
+// The map covers [0, 1] x [0, 1] (y up). Level L splits it into 2^L x 2^L
+// tiles of "tile_size" texels, so a map of 20 levels has a trillion tiles at
+// the bottom: nothing is ever enumerated, only the tiles a view touches.
+// tile_map_update picks the level whose texels come closest to the view's
+// pixels and, for every tile of it across the view, hands out either the slot
+// that holds it or, while it loads, the nearest ancestor that is resident
+// with the part of it the tile covers. The first TILE_MAP_PINNED_LEVELS levels
+// are loaded first and never evicted, so there is always something to draw.
+//
+// Slots are the GPU cache: "slot_count" of them, whatever fits the byte
+// budget. A resident slot sits in a least-recently-used list; drawing or
+// prefetching a tile moves it to the front, and a tile that needs a slot
+// takes the back one, unless that one was used this frame too, in which case
+// the request waits. Loading slots are out of the list until tile_map_loaded.
+//
+// Prefetch: the view's edges are tracked from frame to frame, and the view
+// they predict "lookahead" seconds on (after panning, or zooming, which moves
+// the level too) is requested after the visible tiles, so the tiles come in
+// before the view gets there. Requests stop at "max_loading" in flight, and
+// tile_map_wanted says whether a load still queued is worth starting.
+//
+// A virtual texture drives the same cache from what a frame actually
+// sampled instead: tile_map_feedback takes the tiles (pages) a feedback pass
+// saw, keeps each one's nearest resident ancestor warm as its stand-in and
+// loads the coarsest missing tile on each path down, the pages most pixels
+// asked for first, so detail arrives a level at a time. Nothing is loaded
+// that no pixel wanted.
+//
+// Nothing here calls GL or knows how tiles are loaded.
+
+#define TILE_MAP_MAX_LEVEL 28          // x and y of a key take 29 bits each
+#define TILE_MAP_PINNED_LEVELS 3       // levels 0-2, 21 tiles
+#define TILE_MAP_PINNED_TILES 21
+#define TILE_MAP_NO_KEY UINT64_MAX
+
+typedef enum TileSlotState
+{
+    TILE_SLOT_EMPTY,
+    TILE_SLOT_LOADING,          // handed out by tile_map_update, until tile_map_loaded
+    TILE_SLOT_RESIDENT
+} TileSlotState;
+
+typedef struct TileSlot
+{
+    uint64_t key;               // tile_map_key's, TILE_MAP_NO_KEY when empty
+    int state;                  // TileSlotState
+    int prev, next;             // least-recently-used list, most recent at the head; -1 at the ends
+    uint64_t used;              // last frame the tile was drawn, prefetched or asked for
+    bool pinned;                // a level below TILE_MAP_PINNED_LEVELS: never evicted
+} TileSlot;
+
+// One tile's quad for the frame: "slot"'s texels "uv" (u0, v0, u1, v1 of the slot's tile) over "rect" (x0, y0,
+// x1, y1 in pixels from the bottom left of the view)
+typedef struct TileDraw
+{
+    float rect[4];
+    float uv[4];
+    int slot;
+    int level;                  // the slot's; below the view's when it stands in for a tile still loading
+} TileDraw;
+
+// A tile for the loader: decode tile "key" into slot "slot", then tile_map_loaded
+typedef struct TileRequest
+{
+    uint64_t key;
+    int slot;
+    uint64_t evicted;           // the tile the slot held until now, TILE_MAP_NO_KEY when it was free
+    bool prefetch;              // ahead of the view rather than in it
+} TileRequest;
+
+// A tile of a view in the making, and how far it is from the view's centre
+typedef struct TileCandidate
+{
+    uint64_t key;
+    double distance;
+} TileCandidate;
+
+typedef struct TileMapStats
+{
+    unsigned int visible;       // tiles across the view at its level
+    unsigned int fallback;      // of those, drawn from an ancestor
+    unsigned int missing;       // of those, not drawn at all: no ancestor yet either
+    unsigned int requested;     // loads handed out, prefetches included
+    unsigned int prefetched;
+    unsigned int evicted;
+} TileMapStats;
+
+typedef struct TileMap
+{
+    TileSlot* slots;
+    int slot_count;
+    int* table;                 // open-addressed key -> slot, -1 for none
+    uint32_t table_mask;
+    int head, tail;             // of the resident, unpinned slots
+    int free_count;
+    int* free_slots;            // [slot_count]
+    int loading;
+    int max_loading;
+    int level_count;            // 0 to level_count - 1
+    int tile_size;              // texels across a tile
+    double lookahead;           // seconds of prefetch
+    uint64_t frame;
+    double last_view[4];
+    double edge_velocity[4];    // map units a second, smoothed
+    bool tracking;              // last_view holds the previous frame's
+    int view_level;             // of the last update
+    TileCandidate* candidates;  // scratch for the update's or feedback's tiles, grown as needed
+    int candidate_capacity;
+    TileMapStats stats;         // of the last update
+    uint64_t total_requested;
+    uint64_t total_evicted;
+} TileMap;
+
+// Cache of "slot_count" tiles (at least TILE_MAP_PINNED_TILES plus a view's worth), over a map of "level_count"
+// levels (up to TILE_MAP_MAX_LEVEL + 1), "max_loading" loads at a time. Returns false with fewer slots than
+// pinned tiles, or if the memory isn't there.
+bool tile_map_init(TileMap* map, int slot_count, int level_count, int tile_size, int max_loading, double lookahead);
+void tile_map_destroy(TileMap* map);
+
+uint64_t tile_map_key(int level, uint32_t x, uint32_t y);
+void tile_map_key_tile(uint64_t key, int* level, uint32_t* x, uint32_t* y);
+
+// The frame's view, the map rectangle "view" (x0, y0, x1, y1) over "width" x "height" pixels, "dt" seconds after
+// the last one. Writes up to "max_draws" quads into "draws" (the view's tiles, centre first) and up to
+// "max_requests" loads into "requests" (the pinned levels first, then the view's missing tiles, then the
+// prefetch), and returns the number of draws; "request_count" gets the number of loads.
+int tile_map_update(TileMap* map, const double view[4], int width, int height, double dt, TileDraw* draws,
+    int max_draws, TileRequest* requests, int max_requests, int* request_count);
+
+// The frame's feedback: "keys" (key_count of them, sorted in place, repeats allowed) are the tiles its pixels
+// sampled. Writes up to "max_requests" loads into "requests" (the pinned levels first, then a tile a level below
+// each path's nearest resident one, coarsest and most asked for first) and returns how many. stats.visible gets
+// the distinct tiles, stats.fallback those that aren't resident.
+int tile_map_feedback(TileMap* map, uint64_t* keys, int key_count, TileRequest* requests, int max_requests);
+
+// The load into "slot" finished: the tile is drawn from there on
+void tile_map_loaded(TileMap* map, int slot);
+
+// The load into "slot" won't happen (tile_map_wanted said so): the slot is free again
+void tile_map_cancel(TileMap* map, int slot);
+
+// Whether the last update still drew or prefetched what's loading into "slot"
+bool tile_map_wanted(const TileMap* map, int slot);
+
+// Bytes a slot holds at 4 bytes a texel
+size_t tile_map_slot_bytes(const TileMap* map);
@@ -0,0 +1,345 @@
+#include "core/udp_channel.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#endif
+
+#define PROTOCOL 0x5543u            // "UC"
+#define HAS_ACK 0x80u               // in the message count byte: the ack fields mean something
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// a is after b, 16-bit sequence numbers wrapping
+static bool newer(uint16_t a, uint16_t b)
+{
+    return (int16_t)(uint16_t)(a - b) > 0;
+}
+
+static void put16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void put32(uint8_t* p, uint32_t v)
+{
+    put16(p, (uint16_t)(v >> 16));
+    put16(p + 2, (uint16_t)v);
+}
+
+static uint16_t get16(const uint8_t* p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return ((uint32_t)get16(p) << 16) | get16(p + 2);
+}
+
+bool udp_address_resolve(const char* host, int port, UdpAddress* address)
+{
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* found = NULL;
+    if (getaddrinfo(host, NULL, &hints, &found) != 0 || !found)
+    {
+        fprintf(stderr, "udp_channel: can't resolve %s\n", host);
+        return false;
+    }
+    address->ip = ntohl(((const sockaddr_in*)found->ai_addr)->sin_addr.s_addr);
+    address->port = (uint16_t)port;
+    freeaddrinfo(found);
+    return true;
+}
+
+static sockaddr_in to_sockaddr(const UdpAddress* address)
+{
+    sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(address->ip);
+    a.sin_port = htons(address->port);
+    return a;
+}
+
+bool udp_socket_open(UdpSocket* s, int port)
+{
+    s->handle = (intptr_t)INVALID_SOCKET;
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+        return false;
+#endif
+    const auto handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    const UdpAddress any = { INADDR_ANY, (uint16_t)port };
+    const sockaddr_in address = to_sockaddr(&any);
+    if (handle == INVALID_SOCKET || bind(handle, (const sockaddr*)&address, sizeof(address)) != 0)
+    {
+        fprintf(stderr, "udp_channel: can't bind port %d\n", port);
+        if (handle != INVALID_SOCKET)
+            close_socket(handle);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(handle, FIONBIO, &on);
+#else
+    fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    s->handle = (intptr_t)handle;
+    return true;
+}
+
+void udp_socket_close(UdpSocket* s)
+{
+    if (s->handle == (intptr_t)INVALID_SOCKET)
+        return;
+    close_socket((socket_t)s->handle);
+    s->handle = (intptr_t)INVALID_SOCKET;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+int udp_socket_port(const UdpSocket* s)
+{
+    sockaddr_in address;
+    socklen_t size = sizeof(address);
+    if (getsockname((socket_t)s->handle, (sockaddr*)&address, &size) != 0)
+        return 0;
+    return ntohs(address.sin_port);
+}
+
+bool udp_socket_wait(UdpSocket* s, double seconds)
+{
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET((socket_t)s->handle, &readable);
+    timeval wait = { (long)seconds, (long)((seconds - (long)seconds) * 1e6) };
+    return select((int)s->handle + 1, &readable, NULL, NULL, &wait) > 0;
+}
+
+size_t udp_socket_receive(UdpSocket* s, UdpAddress* from, void* data, size_t capacity)
+{
+    sockaddr_in address;
+    socklen_t size = sizeof(address);
+    const int n = (int)recvfrom((socket_t)s->handle, (char*)data, (int)capacity, 0, (sockaddr*)&address, &size);
+    if (n <= 0)
+        return 0;
+    from->ip = ntohl(address.sin_addr.s_addr);
+    from->port = ntohs(address.sin_port);
+    return (size_t)n;
+}
+
+void udp_channel_init(UdpChannel* ch, const UdpAddress* peer)
+{
+    memset(ch, 0, sizeof(*ch));
+    ch->peer = *peer;
+    for (int i = 0; i < UDP_CHANNEL_SENT; ++i)
+        ch->sent_acked[i] = true;       // nothing there to be lost
+    ch->loss_random = 0x9E3779B9u;
+}
+
+bool udp_channel_queue(UdpChannel* ch, const void* data, size_t size)
+{
+    if (size > UDP_CHANNEL_MESSAGE_SIZE || ch->outgoing_count == UDP_CHANNEL_MAX_RELIABLE)
+        return false;
+    UdpMessage* m = &ch->outgoing[ch->outgoing_count++];
+    m->id = ch->next_id++;
+    m->size = (uint16_t)size;
+    m->sends = 0;
+    memcpy(m->data, data, size);
+    return true;
+}
+
+// The reliable messages the next datagram carries: the oldest, as many as fit with no payload at all
+static int messages_fitting(const UdpChannel* ch, size_t* bytes)
+{
+    size_t total = 0;
+    int count = 0;
+    while (count < ch->outgoing_count && UDP_CHANNEL_HEADER + total + 4 + ch->outgoing[count].size <= UDP_CHANNEL_MTU)
+        total += 4 + ch->outgoing[count++].size;
+    *bytes = total;
+    return count;
+}
+
+size_t udp_channel_payload_room(const UdpChannel* ch)
+{
+    size_t bytes = 0;
+    messages_fitting(ch, &bytes);
+    return UDP_CHANNEL_MTU - UDP_CHANNEL_HEADER - bytes;
+}
+
+bool udp_channel_send(UdpChannel* ch, UdpSocket* s, const void* payload, size_t size, float loss)
+{
+    uint8_t datagram[UDP_CHANNEL_MTU];
+    size_t bytes = 0;
+    const int messages = messages_fitting(ch, &bytes);
+    if (UDP_CHANNEL_HEADER + bytes + size > UDP_CHANNEL_MTU)
+        return false;
+    put16(datagram, PROTOCOL);
+    put16(datagram + 2, ch->sequence);
+    put16(datagram + 4, ch->remote);
+    put32(datagram + 6, ch->remote_bits);
+    datagram[10] = (uint8_t)(messages | (ch->received_any ? HAS_ACK : 0));
+    uint8_t* p = datagram + UDP_CHANNEL_HEADER;
+    for (int i = 0; i < messages; ++i)
+    {
+        UdpMessage* m = &ch->outgoing[i];
+        put16(p, m->id);
+        put16(p + 2, m->size);
+        memcpy(p + 4, m->data, m->size);
+        p += 4 + m->size;
+        if (m->sends++)
+            ++ch->resent;
+    }
+    if (size)
+        memcpy(p, payload, size);
+    p += size;
+
+    // Remembered for its acknowledgement; whatever it pushes out unacknowledged was lost
+    const int slot = ch->sequence % UDP_CHANNEL_SENT;
+    if (!ch->sent_acked[slot])
+        ++ch->datagrams_lost;
+    ch->sent[slot] = ch->sequence;
+    ch->sent_acked[slot] = false;
+    ch->sent_time[slot] = now_ms();
+    ch->sent_first_id[slot] = messages ? ch->outgoing[0].id : 0;
+    ch->sent_messages[slot] = (uint8_t)messages;
+    ++ch->sequence;
+    ++ch->datagrams_sent;
+    ch->bytes_sent += (uint64_t)(p - datagram);
+
+    ch->loss_random = ch->loss_random * 1664525u + 1013904223u;
+    if (loss > 0.f && (ch->loss_random >> 8) * (1.f / 16777216.f) < loss)
+        return true;
+    const sockaddr_in to = to_sockaddr(&ch->peer);
+    return sendto((socket_t)s->handle, (const char*)datagram, (int)(p - datagram), 0, (const sockaddr*)&to,
+        sizeof(to)) == (int)(p - datagram);
+}
+
+// One of ours got there: note it, time the round trip, and retire the reliable messages it carried
+static void acknowledge(UdpChannel* ch, uint16_t sequence)
+{
+    const int slot = sequence % UDP_CHANNEL_SENT;
+    if (ch->sent[slot] != sequence || ch->sent_acked[slot])
+        return;
+    ch->sent_acked[slot] = true;
+    ch->acked[ch->acked_count++] = sequence;
+    const double rtt = now_ms() - ch->sent_time[slot];
+    ch->rtt_ms = ch->rtt_ms > 0.0 ? ch->rtt_ms + 0.1 * (rtt - ch->rtt_ms) : rtt;
+    int kept = 0;
+    for (int i = 0; i < ch->outgoing_count; ++i)
+    {
+        const uint16_t offset = (uint16_t)(ch->outgoing[i].id - ch->sent_first_id[slot]);
+        if (offset >= ch->sent_messages[slot])
+            ch->outgoing[kept++] = ch->outgoing[i];
+    }
+    ch->outgoing_count = kept;
+}
+
+bool udp_channel_read(UdpChannel* ch, const void* datagram, size_t size, uint16_t* sequence, const uint8_t** payload,
+    size_t* payload_size)
+{
+    const uint8_t* d = (const uint8_t*)datagram;
+    ch->acked_count = 0;
+    if (size < UDP_CHANNEL_HEADER || get16(d) != PROTOCOL)
+        return false;
+    const uint16_t s = get16(d + 2);
+
+    // The messages first, so a malformed datagram changes nothing
+    const int messages = d[10] & ~HAS_ACK;
+    const uint8_t* p = d + UDP_CHANNEL_HEADER;
+    const uint8_t* end = d + size;
+    int fresh = 0;
+    for (int i = 0; i < messages; ++i)
+    {
+        if (end - p < 4 || end - p - 4 < get16(p + 2) || get16(p + 2) > UDP_CHANNEL_MESSAGE_SIZE)
+            return false;
+        if ((uint16_t)(get16(p) - ch->expected_id) < UDP_CHANNEL_MAX_RELIABLE)
+            ++fresh;
+        p += 4 + get16(p + 2);
+    }
+    if (ch->inbox_count + fresh > UDP_CHANNEL_MAX_RELIABLE)
+        return false;   // the caller hasn't emptied the inbox; the peer sends them again
+
+    // Where it falls among the peer's: the latest, or one of the 32 before it not seen yet
+    if (!ch->received_any || newer(s, ch->remote))
+    {
+        const int shift = ch->received_any ? (uint16_t)(s - ch->remote) : 64;
+        ch->remote_bits = shift > 32 ? 0 : shift == 32 ? 1u << 31 : (ch->remote_bits << shift) | (1u << (shift - 1));
+        ch->remote = s;
+        ch->received_any = true;
+    }
+    else
+    {
+        const int age = (uint16_t)(ch->remote - s);
+        if (age == 0 || age > 32 || (ch->remote_bits & (1u << (age - 1))))
+            return false;
+        ch->remote_bits |= 1u << (age - 1);
+    }
+    ++ch->datagrams_received;
+    ch->bytes_received += size;
+
+    if (d[10] & HAS_ACK)
+    {
+        const uint16_t ack = get16(d + 4);
+        const uint32_t bits = get32(d + 6);
+        acknowledge(ch, ack);
+        for (int i = 0; i < 32; ++i)
+            if (bits & (1u << i))
+                acknowledge(ch, (uint16_t)(ack - 1 - i));
+    }
+
+    // In order, once each: a message the inbox has had already is a resend the ack for missed
+    p = d + UDP_CHANNEL_HEADER;
+    for (int i = 0; i < messages; ++i)
+    {
+        const uint16_t id = get16(p), length = get16(p + 2);
+        if (id == ch->expected_id)
+        {
+            UdpMessage* m = &ch->inbox[ch->inbox_count++];
+            m->id = id;
+            m->size = length;
+            m->sends = 0;
+            memcpy(m->data, p + 4, length);
+            ++ch->expected_id;
+        }
+        p += 4 + length;
+    }
+    *sequence = s;
+    *payload = p;
+    *payload_size = (size_t)(end - p);
+    return true;
+}
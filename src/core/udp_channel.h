@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Datagrams between two endpoints over UDP, for state that is stale as soon
+// as something newer is sent: scene/replication.h's snapshots. Nothing waits
+// on a datagram that was lost, and nothing is sent twice unless it asks to be.
+//
+// Every datagram carries its own sequence number and acknowledges the
+// peer's: the latest it has had, and a bit for each of the 32 before that.
+// Acknowledgements then ride along with whatever goes the other way, and
+// each is repeated in the next 32 datagrams, so one getting through is
+// enough. udp_channel_read lists the sequence numbers newly acknowledged
+// (the caller's replication moves its baselines forward on them), and the
+// round trip is measured from the same.
+//
+// Reliability is only for the messages that ask for it (udp_channel_queue):
+// the few a peer can't do without, such as the scene's layout a client needs
+// before its first snapshot makes sense. A reliable message rides in every
+// datagram from when it's queued until one of them is acknowledged, and the
+// peer hands each over once and in order. It costs nothing when there are
+// none.
+//
+// The header is in network byte order; the payload is the caller's, and
+// bit_stream.h's packing is byte-order free. Sockets are non-blocking.
+
+#define UDP_CHANNEL_MTU 1200            // bytes a datagram takes, headers included: under any path's MTU
+#define UDP_CHANNEL_HEADER 11           // bytes: protocol, sequence, ack, ack bits and the reliable message count
+#define UDP_CHANNEL_MAX_RELIABLE 16     // queued and not yet acknowledged, and received between reads
+#define UDP_CHANNEL_MESSAGE_SIZE 256    // bytes of one reliable message
+#define UDP_CHANNEL_SENT 64             // datagrams remembered for their acknowledgement
+
+typedef struct UdpAddress
+{
+    uint32_t ip;                // IPv4, host byte order
+    uint16_t port;
+} UdpAddress;
+
+typedef struct UdpSocket
+{
+    intptr_t handle;
+} UdpSocket;
+
+typedef struct UdpMessage
+{
+    uint16_t id;                // counts up from 0, per direction
+    uint16_t size;
+    uint16_t sends;             // outgoing: datagrams it has ridden in
+    uint8_t data[UDP_CHANNEL_MESSAGE_SIZE];
+} UdpMessage;
+
+typedef struct UdpChannel
+{
+    UdpAddress peer;
+    uint16_t sequence;          // the next datagram's
+    uint16_t remote;            // the peer's latest
+    uint32_t remote_bits;       // bit i: the peer's remote - 1 - i arrived too
+    bool received_any;
+
+    uint16_t sent[UDP_CHANNEL_SENT];        // by sequence % UDP_CHANNEL_SENT: which of ours is there
+    bool sent_acked[UDP_CHANNEL_SENT];
+    double sent_time[UDP_CHANNEL_SENT];
+    uint16_t sent_first_id[UDP_CHANNEL_SENT];   // the reliable messages it carried: ids first, first + 1, ...
+    uint8_t sent_messages[UDP_CHANNEL_SENT];
+    uint16_t acked[33];         // the last read's newly acknowledged sequence numbers
+    int acked_count;
+
+    UdpMessage outgoing[UDP_CHANNEL_MAX_RELIABLE];  // oldest first
+    int outgoing_count;
+    uint16_t next_id;
+    UdpMessage inbox[UDP_CHANNEL_MAX_RELIABLE];     // delivered by the reads since the caller last emptied it
+    int inbox_count;
+    uint16_t expected_id;       // the peer's next reliable message
+
+    double rtt_ms;              // smoothed
+    unsigned int datagrams_sent;
+    unsigned int datagrams_received;
+    unsigned int datagrams_lost;        // fell out of UDP_CHANNEL_SENT unacknowledged
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    unsigned int resent;        // reliable messages sent again
+    uint32_t loss_random;       // udp_channel_send's dropping, for tests
+} UdpChannel;
+
+// Resolves "host" (a name or dotted address) and "port". Logs and returns false when it can't.
+bool udp_address_resolve(const char* host, int port, UdpAddress* address);
+
+static inline bool udp_address_equal(const UdpAddress* a, const UdpAddress* b)
+{
+    return a->ip == b->ip && a->port == b->port;
+}
+
+// Binds to "port" on every interface (0 for one the system picks). Logs and returns false when it can't.
+bool udp_socket_open(UdpSocket* s, int port);
+void udp_socket_close(UdpSocket* s);
+
+// The bound port, host byte order
+int udp_socket_port(const UdpSocket* s);
+
+// Waits up to "seconds" for a datagram. Returns whether one is there.
+bool udp_socket_wait(UdpSocket* s, double seconds);
+
+// The next datagram waiting, into "data", and who from. Returns its size, 0 when there's none.
+size_t udp_socket_receive(UdpSocket* s, UdpAddress* from, void* data, size_t capacity);
+
+void udp_channel_init(UdpChannel* ch, const UdpAddress* peer);
+
+// Queues a reliable message of "size" bytes. Returns false when it's too long or the queue is full: the peer
+// isn't acknowledging.
+bool udp_channel_queue(UdpChannel* ch, const void* data, size_t size);
+
+// Room for the unreliable payload in the next datagram, after its header and the reliable messages waiting
+size_t udp_channel_payload_room(const UdpChannel* ch);
+
+// The sequence number the next datagram goes out with: what its payload is acknowledged by
+static inline uint16_t udp_channel_next_sequence(const UdpChannel* ch)
+{
+    return ch->sequence;
+}
+
+// Sends a datagram with the channel's header, the reliable messages waiting (as many as fit, oldest first) and
+// "size" bytes of payload (at most udp_channel_payload_room). "loss" drops that fraction of datagrams unsent, as
+// a lossy network would, for tests; 0 otherwise. Returns false when the socket refused it.
+bool udp_channel_send(UdpChannel* ch, UdpSocket* s, const void* payload, size_t size, float loss);
+
+// Takes a datagram received from the peer: its acknowledgements (acked / acked_count), its new reliable messages
+// (appended to inbox, which the caller empties) and its payload, *payload and *payload_size pointing into
+// "datagram", and its sequence number. Returns false for one that isn't this protocol's, a duplicate, or one
+// more than 32 older than the latest.
+bool udp_channel_read(UdpChannel* ch, const void* datagram, size_t size, uint16_t* sequence, const uint8_t** payload,
+    size_t* payload_size);
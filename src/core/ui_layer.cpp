@@ -0,0 +1,209 @@
+#include "core/ui_layer.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void ui_layer_init(UiLayer* ui)
+{
+    memset(ui, 0, sizeof(*ui));
+    shape_batch_init(&ui->scratch);
+    ui->building = -1;
+}
+
+void ui_layer_destroy(UiLayer* ui)
+{
+    free(ui->widgets);
+    free(ui->vertices);
+    free(ui->indices);
+    shape_batch_destroy(&ui->scratch);
+    ui_layer_init(ui);
+}
+
+// Grows "*array" of "size"-byte elements to hold "count", doubling
+static bool ui_layer_reserve(void** array, uint32_t* capacity, uint32_t count, size_t size)
+{
+    if (count <= *capacity)
+        return true;
+    uint32_t grown = *capacity ? *capacity : 64;
+    while (grown < count)
+        grown *= 2;
+    void* p = realloc(*array, grown * size);
+    if (!p)
+        return false;
+    *array = p;
+    *capacity = grown;
+    return true;
+}
+
+int ui_layer_add(UiLayer* ui, uint32_t max_vertices, uint32_t max_indices)
+{
+    max_indices -= max_indices % 3;
+    if (!ui_layer_reserve((void**)&ui->widgets, &ui->widget_capacity, ui->widget_count + 1, sizeof(UiWidget))
+        || !ui_layer_reserve((void**)&ui->vertices, &ui->vertex_capacity, ui->vertex_count + max_vertices,
+            sizeof(ShapeVertex))
+        || !ui_layer_reserve((void**)&ui->indices, &ui->index_capacity, ui->index_count + max_indices,
+            sizeof(uint32_t)))
+        return -1;
+    UiWidget* w = &ui->widgets[ui->widget_count];
+    memset(w, 0, sizeof(*w));
+    w->first_vertex = ui->vertex_count;
+    w->vertex_capacity = max_vertices;
+    w->first_index = ui->index_count;
+    w->index_capacity = max_indices;
+    w->bounds[0] = w->bounds[1] = 1.f;
+    memset(ui->vertices + w->first_vertex, 0, sizeof(ShapeVertex) * max_vertices);
+    for (uint32_t i = 0; i < max_indices; ++i)
+        ui->indices[w->first_index + i] = w->first_vertex;     // degenerate until it's built
+    ui->vertex_count += max_vertices;
+    ui->index_count += max_indices;
+    ui->all_dirty = true;
+    return (int)ui->widget_count++;
+}
+
+ShapeBatch* ui_layer_begin(UiLayer* ui, int widget, uint64_t key)
+{
+    if (widget < 0 || (uint32_t)widget >= ui->widget_count || ui->building >= 0)
+        return NULL;
+    UiWidget* w = &ui->widgets[widget];
+    if (w->built && w->key == key)
+    {
+        ++ui->reused;
+        return NULL;
+    }
+    w->key = key;
+    ui->building = widget;
+    ++ui->built;
+    shape_batch_clear(&ui->scratch);
+    return &ui->scratch;
+}
+
+static float ui_rect_area(const float* r)
+{
+    return (r[2] - r[0]) * (r[3] - r[1]);
+}
+
+static void ui_rect_union(float* into, const float* r)
+{
+    into[0] = fminf(into[0], r[0]);
+    into[1] = fminf(into[1], r[1]);
+    into[2] = fmaxf(into[2], r[2]);
+    into[3] = fmaxf(into[3], r[3]);
+}
+
+// Adds "bounds" (x0 > x1 for none), padded out to whole pixels, to the dirty rectangles. One that meets another is
+// merged with it, and so on; with the list full, it's merged with whichever grows least.
+static void ui_layer_dirty_rect(UiLayer* ui, const float* bounds)
+{
+    if (bounds[0] > bounds[2])
+        return;
+    float r[4] = { floorf(bounds[0] - UI_LAYER_DIRTY_PAD), floorf(bounds[1] - UI_LAYER_DIRTY_PAD),
+        ceilf(bounds[2] + UI_LAYER_DIRTY_PAD), ceilf(bounds[3] + UI_LAYER_DIRTY_PAD) };
+    for (int i = 0; i < ui->dirty_count;)
+    {
+        const float* d = ui->dirty[i];
+        if (d[0] <= r[2] && r[0] <= d[2] && d[1] <= r[3] && r[1] <= d[3])
+        {
+            ui_rect_union(r, d);
+            memmove(ui->dirty[i], ui->dirty[i + 1], sizeof(ui->dirty[0]) * (ui->dirty_count - i - 1));
+            --ui->dirty_count;
+            i = 0;
+        }
+        else
+            ++i;
+    }
+    if (ui->dirty_count < UI_LAYER_MAX_DIRTY)
+    {
+        memcpy(ui->dirty[ui->dirty_count++], r, sizeof(r));
+        return;
+    }
+    int best = 0;
+    float best_growth = INFINITY;
+    for (int i = 0; i < ui->dirty_count; ++i)
+    {
+        float merged[4];
+        memcpy(merged, ui->dirty[i], sizeof(merged));
+        ui_rect_union(merged, r);
+        const float growth = ui_rect_area(merged) - ui_rect_area(ui->dirty[i]);
+        if (growth < best_growth)
+        {
+            best_growth = growth;
+            best = i;
+        }
+    }
+    ui_rect_union(ui->dirty[best], r);
+}
+
+void ui_layer_end(UiLayer* ui)
+{
+    if (ui->building < 0)
+        return;
+    UiWidget* w = &ui->widgets[ui->building];
+    ui->building = -1;
+    ShapeBatch* b = &ui->scratch;
+    ui_layer_dirty_rect(ui, w->bounds);
+
+    // The batch's buckets in its draw order, rebased onto the widget's range; a triangle past either capacity is cut
+    int order[SHAPE_BATCH_MAX_BUCKETS];
+    const int count = shape_batch_order(b, order);
+    ShapeVertex* vertices = ui->vertices + w->first_vertex;
+    uint32_t* indices = ui->indices + w->first_index;
+    uint32_t v = 0, n = 0, appended = 0;
+    for (int k = 0; k < count; ++k)
+    {
+        const ShapeBucket* bucket = &b->buckets[order[k]];
+        appended += bucket->vertex_count;
+        const uint32_t fit = v + bucket->vertex_count <= w->vertex_capacity ? bucket->vertex_count
+            : w->vertex_capacity - v;
+        memcpy(vertices + v, bucket->vertices, sizeof(ShapeVertex) * fit);
+        for (uint32_t i = 0; i + 3 <= bucket->index_count && n + 3 <= w->index_capacity; i += 3)
+        {
+            const uint32_t* t = bucket->indices + i;
+            if (t[0] >= fit || t[1] >= fit || t[2] >= fit)
+                continue;
+            indices[n++] = w->first_vertex + v + t[0];
+            indices[n++] = w->first_vertex + v + t[1];
+            indices[n++] = w->first_vertex + v + t[2];
+        }
+        v += fit;
+    }
+    ui->dropped += appended - v;
+    const uint32_t old_indices = w->index_count;
+    for (uint32_t i = n; i < old_indices; ++i)
+        indices[i] = w->first_vertex;   // the indices it no longer uses go degenerate
+    const uint32_t touched = n > old_indices ? n : old_indices;
+    w->dirty_indices = w->dirty && w->dirty_indices > touched ? w->dirty_indices : touched;
+    ui->dirty_widgets += !w->dirty;
+    w->dirty = true;
+    w->vertex_count = v;
+    w->index_count = n;
+    w->built = true;
+
+    w->bounds[0] = w->bounds[1] = INFINITY;
+    w->bounds[2] = w->bounds[3] = -INFINITY;
+    for (uint32_t i = 0; i < v; ++i)
+    {
+        const float pos[4] = { vertices[i].pos[0], vertices[i].pos[1], vertices[i].pos[0], vertices[i].pos[1] };
+        ui_rect_union(w->bounds, pos);
+    }
+    ui_layer_dirty_rect(ui, w->bounds);
+    shape_batch_clear(b);
+}
+
+void ui_layer_invalidate(UiLayer* ui)
+{
+    ui->all_dirty = true;
+}
+
+void ui_layer_clean(UiLayer* ui)
+{
+    for (uint32_t i = 0; i < ui->widget_count && ui->dirty_widgets; ++i)
+        if (ui->widgets[i].dirty)
+        {
+            ui->widgets[i].dirty = false;
+            ui->widgets[i].dirty_indices = 0;
+            --ui->dirty_widgets;
+        }
+    ui->dirty_count = 0;
+    ui->all_dirty = false;
+}
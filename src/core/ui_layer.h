@@ -0,0 +1,85 @@
+#pragma once
+
+#include "core/shape_batch.h"
+
+#include <stdint.h>
+
+// Retained 2D widgets: shapes built once and kept until they change, for a
+// dashboard that mostly shows the same thing.
+//
+// Each widget owns a fixed range of one vertex array and one index array,
+// sized when it's added. The caller rebuilds a widget from a key of its own
+// (a reading, a tick, a size): ui_layer_begin with the key it was last built
+// from is a compare and hands back nothing to build into; a new key hands
+// back a ShapeBatch to append the widget's shapes to, and ui_layer_end copies
+// them into the widget's range in place. Nothing else moves, so a screen of
+// widgets where one changed rewrites one widget's vertices.
+//
+// What changed is tracked for gl/ui_renderer.h: the widgets rewritten since
+// the renderer last drew the layer, whose vertices and indices are all it
+// uploads, and the pixels they covered before and after, as up to
+// UI_LAYER_MAX_DIRTY rectangles, which is all it draws again. Unused index
+// capacity holds degenerate triangles, so the layer is always one draw.
+//
+// A widget's shapes draw in its batch's order, by layer and then as they
+// were appended, and over those of the widgets added before it. Textures and
+// paths aren't kept: everything is untextured. A widget that outgrows its
+// range is cut to the whole triangles that fit, counted in "dropped".
+// Nothing here calls GL.
+
+#define UI_LAYER_MAX_DIRTY 16           // dirty rectangles kept apart; more are merged
+#define UI_LAYER_DIRTY_PAD 1.f          // pixels a dirty rectangle takes in around a widget's bounds
+
+typedef struct UiWidget
+{
+    uint32_t first_vertex, vertex_capacity, vertex_count;
+    uint32_t first_index, index_capacity, index_count;
+    uint64_t key;                   // the caller's, as last built from
+    float bounds[4];                // its vertices' x0, y0, x1, y1 in pixels; x0 > x1 when it has none
+    uint32_t dirty_indices;         // rewritten since ui_layer_clean: as many as it has or had, whichever's more
+    bool dirty;
+    bool built;
+} UiWidget;
+
+typedef struct UiLayer
+{
+    UiWidget* widgets;
+    uint32_t widget_count, widget_capacity;
+    ShapeVertex* vertices;          // every widget's range, in the order they were added
+    uint32_t* indices;              // into "vertices", each widget's rebased onto its range
+    uint32_t vertex_count, vertex_capacity;     // handed out to widgets
+    uint32_t index_count, index_capacity;
+    ShapeBatch scratch;             // what ui_layer_begin hands out
+    int building;                   // the widget between ui_layer_begin and ui_layer_end, -1 for none
+
+    // Changed since ui_layer_clean: how many widgets, and the pixel rectangles as x0, y0, x1, y1 from the top left.
+    // "all_dirty" means everything, added widgets or a new size.
+    uint32_t dirty_widgets;
+    float dirty[UI_LAYER_MAX_DIRTY][4];
+    int dirty_count;
+    bool all_dirty;
+
+    // Over the layer's life
+    uint64_t built;                 // ui_layer_begin calls that rebuilt a widget
+    uint64_t reused;                // that found it up to date
+    uint32_t dropped;               // vertices cut from widgets that outgrew their range
+} UiLayer;
+
+void ui_layer_init(UiLayer* ui);
+void ui_layer_destroy(UiLayer* ui);
+
+// A new, empty widget with room for "max_vertices" and "max_indices"; -1 when memory runs out
+int ui_layer_add(UiLayer* ui, uint32_t max_vertices, uint32_t max_indices);
+
+// Starts rebuilding "widget" unless it was last built from "key": the batch to append its shapes to, in pixels, or
+// NULL when it's up to date (nothing to do, and no ui_layer_end)
+ShapeBatch* ui_layer_begin(UiLayer* ui, int widget, uint64_t key);
+
+// Copies what was appended since ui_layer_begin into the widget's range and marks what changed
+void ui_layer_end(UiLayer* ui);
+
+// Everything to be drawn again, as after a resize
+void ui_layer_invalidate(UiLayer* ui);
+
+// Forgets what changed, once gl/ui_renderer.h has drawn it
+void ui_layer_clean(UiLayer* ui);
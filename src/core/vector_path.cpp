@@ -0,0 +1,462 @@
+#include "core/vector_path.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PI 3.14159265f
+
+void vector_path_init(VectorPath* path)
+{
+    memset(path, 0, sizeof(*path));
+    path->version = 1;
+}
+
+void vector_path_destroy(VectorPath* path)
+{
+    free(path->verbs);
+    free(path->points);
+    free(path->flat);
+    free(path->contour_ends);
+    free(path->contour_closed);
+    free(path->stroke);
+    free(path->stroke_indices);
+    vector_path_init(path);
+}
+
+void vector_path_reset(VectorPath* path)
+{
+    path->verb_count = path->point_count = 0;
+    path->current[0] = path->current[1] = 0.f;
+    path->open = false;
+    ++path->version;
+}
+
+static bool grow(void** data, uint32_t* capacity, uint32_t needed, size_t element)
+{
+    if (needed <= *capacity)
+        return true;
+    uint32_t n = *capacity ? *capacity : 64;
+    while (n < needed)
+        n *= 2;
+    void* p = realloc(*data, n * element);
+    if (!p)
+        return false;
+    *data = p;
+    *capacity = n;
+    return true;
+}
+
+// Appends a verb and its "count" points; a verb that won't fit is dropped
+static void vector_path_append(VectorPath* path, VectorVerb verb, const float* xy, uint32_t count)
+{
+    if (!grow((void**)&path->verbs, &path->verb_capacity, path->verb_count + 1, 1)
+        || !grow((void**)&path->points, &path->point_capacity, path->point_count + count, 2 * sizeof(float)))
+        return;
+    path->verbs[path->verb_count++] = (uint8_t)verb;
+    if (count)
+        memcpy(path->points + 2 * path->point_count, xy, 2 * sizeof(float) * count);
+    path->point_count += count;
+    ++path->version;
+}
+
+void vector_path_move_to(VectorPath* path, float x, float y)
+{
+    const float xy[2] = { x, y };
+    vector_path_append(path, VECTOR_MOVE, xy, 1);
+    path->current[0] = x;
+    path->current[1] = y;
+    path->open = true;
+}
+
+// The contour a line or curve continues: one started at the current point when none is open
+static void vector_path_ensure_open(VectorPath* path)
+{
+    if (!path->open)
+        vector_path_move_to(path, path->current[0], path->current[1]);
+}
+
+void vector_path_line_to(VectorPath* path, float x, float y)
+{
+    vector_path_ensure_open(path);
+    const float xy[2] = { x, y };
+    vector_path_append(path, VECTOR_LINE, xy, 1);
+    path->current[0] = x;
+    path->current[1] = y;
+}
+
+void vector_path_quad_to(VectorPath* path, float cx, float cy, float x, float y)
+{
+    vector_path_ensure_open(path);
+    const float xy[4] = { cx, cy, x, y };
+    vector_path_append(path, VECTOR_QUAD, xy, 2);
+    path->current[0] = x;
+    path->current[1] = y;
+}
+
+void vector_path_cubic_to(VectorPath* path, float c0x, float c0y, float c1x, float c1y, float x, float y)
+{
+    vector_path_ensure_open(path);
+    const float xy[6] = { c0x, c0y, c1x, c1y, x, y };
+    vector_path_append(path, VECTOR_CUBIC, xy, 3);
+    path->current[0] = x;
+    path->current[1] = y;
+}
+
+void vector_path_close(VectorPath* path)
+{
+    if (!path->open)
+        return;
+    vector_path_append(path, VECTOR_CLOSE, NULL, 0);
+    // Back to the contour's start: the last move's point
+    for (uint32_t v = path->verb_count, p = path->point_count; v-- > 0;)
+    {
+        const uint8_t verb = path->verbs[v];
+        p -= verb == VECTOR_QUAD ? 2 : verb == VECTOR_CUBIC ? 3 : verb == VECTOR_CLOSE ? 0 : 1;
+        if (verb == VECTOR_MOVE)
+        {
+            path->current[0] = path->points[2 * p];
+            path->current[1] = path->points[2 * p + 1];
+            break;
+        }
+    }
+    path->open = false;
+}
+
+void vector_path_arc(VectorPath* path, float cx, float cy, float radius, float a0, float a1)
+{
+    const float x0 = cx + radius * cosf(a0), y0 = cy + radius * sinf(a0);
+    if (!path->open)
+        vector_path_move_to(path, x0, y0);
+    else if (x0 != path->current[0] || y0 != path->current[1])
+        vector_path_line_to(path, x0, y0);
+    if (!(radius > 0.f) || a0 == a1)
+        return;
+
+    // Each piece a cubic whose control points lie along the tangents, 4/3 tan(angle / 4) of the radius out
+    const int pieces = (int)ceilf(fabsf(a1 - a0) / (0.5f * PI) - 1e-4f);
+    const float step = (a1 - a0) / (pieces > 0 ? pieces : 1), k = 4.f / 3.f * tanf(0.25f * step) * radius;
+    float a = a0, c = cosf(a0), s = sinf(a0);
+    for (int i = 0; i < pieces; ++i)
+    {
+        const float b = i + 1 == pieces ? a1 : a + step, cb = cosf(b), sb = sinf(b);
+        vector_path_cubic_to(path, cx + radius * c - k * s, cy + radius * s + k * c, cx + radius * cb + k * sb,
+            cy + radius * sb - k * cb, cx + radius * cb, cy + radius * sb);
+        a = b;
+        c = cb;
+        s = sb;
+    }
+}
+
+void vector_path_rounded_rect(VectorPath* path, float x, float y, float width, float height, float radius)
+{
+    const float r = fminf(fmaxf(radius, 0.f), 0.5f * fminf(width, height));
+    vector_path_move_to(path, x + r, y);
+    vector_path_arc(path, x + width - r, y + r, r, -0.5f * PI, 0.f);
+    vector_path_arc(path, x + width - r, y + height - r, r, 0.f, 0.5f * PI);
+    vector_path_arc(path, x + r, y + height - r, r, 0.5f * PI, PI);
+    vector_path_arc(path, x + r, y + r, r, PI, 1.5f * PI);
+    vector_path_close(path);
+}
+
+void vector_path_ellipse(VectorPath* path, float cx, float cy, float rx, float ry)
+{
+    const float kx = 0.5522848f * rx, ky = 0.5522848f * ry;     // a quarter circle's cubic, as in vector_path_arc
+    vector_path_move_to(path, cx + rx, cy);
+    vector_path_cubic_to(path, cx + rx, cy + ky, cx + kx, cy + ry, cx, cy + ry);
+    vector_path_cubic_to(path, cx - kx, cy + ry, cx - rx, cy + ky, cx - rx, cy);
+    vector_path_cubic_to(path, cx - rx, cy - ky, cx - kx, cy - ry, cx, cy - ry);
+    vector_path_cubic_to(path, cx + kx, cy - ry, cx + rx, cy - ky, cx + rx, cy);
+    vector_path_close(path);
+}
+
+// Flattening
+
+typedef struct Flattener
+{
+    VectorPath* path;
+    uint32_t contour_start;     // the open contour's first pair
+    bool failed;
+} Flattener;
+
+static void flat_point(Flattener* f, float x, float y)
+{
+    VectorPath* p = f->path;
+    if (p->flat_count > f->contour_start && p->flat[2 * p->flat_count - 2] == x && p->flat[2 * p->flat_count - 1] == y)
+        return;
+    if (!grow((void**)&p->flat, &p->flat_capacity, p->flat_count + 1, 2 * sizeof(float)))
+    {
+        f->failed = true;
+        return;
+    }
+    p->flat[2 * p->flat_count] = x;
+    p->flat[2 * p->flat_count + 1] = y;
+    ++p->flat_count;
+}
+
+// Ends the open contour; one of fewer than two points (a lone move) is dropped
+static void flat_end_contour(Flattener* f, bool closed)
+{
+    VectorPath* p = f->path;
+    const float* first = p->flat + 2 * f->contour_start;
+    uint32_t capacity = p->contour_capacity;    // the two arrays grow alike
+    if (closed && p->flat_count > f->contour_start + 1 && p->flat[2 * p->flat_count - 2] == first[0]
+        && p->flat[2 * p->flat_count - 1] == first[1])
+        --p->flat_count;    // closing onto its start: the closing edge is implicit
+    if (p->flat_count < f->contour_start + 2)
+        p->flat_count = f->contour_start;
+    else if (grow((void**)&p->contour_ends, &capacity, p->contour_count + 1, sizeof(uint32_t))
+        && grow((void**)&p->contour_closed, &p->contour_capacity, p->contour_count + 1, 1))
+    {
+        p->contour_ends[p->contour_count] = p->flat_count;
+        p->contour_closed[p->contour_count++] = closed;
+    }
+    else
+        f->failed = true;
+    f->contour_start = p->flat_count;
+}
+
+static inline int curve_segments(float second_difference, float tolerance)
+{
+    const int n = (int)ceilf(sqrtf(second_difference / tolerance));
+    return n < 1 ? 1 : n > VECTOR_PATH_MAX_SEGMENTS ? VECTOR_PATH_MAX_SEGMENTS : n;
+}
+
+bool vector_path_flatten(VectorPath* path, float tolerance)
+{
+    if (path->flat_version == path->version && path->flat_tolerance <= tolerance
+        && path->flat_tolerance * VECTOR_PATH_REFLATTEN > tolerance)
+        return true;
+    const float tol = 0.5f * tolerance;
+    Flattener f = { path, 0, false };
+    path->flat_count = path->contour_count = 0;
+    float x = 0.f, y = 0.f;
+    const float* q = path->points;
+    for (uint32_t v = 0; v < path->verb_count; ++v)
+        switch (path->verbs[v])
+        {
+        case VECTOR_MOVE:
+            flat_end_contour(&f, false);
+            x = q[0];
+            y = q[1];
+            flat_point(&f, x, y);
+            q += 2;
+            break;
+        case VECTOR_LINE:
+            x = q[0];
+            y = q[1];
+            flat_point(&f, x, y);
+            q += 2;
+            break;
+        case VECTOR_QUAD:
+        {
+            // A quadratic's chord over 1 / n of it strays at most |p0 - 2 p1 + p2| / (4 n^2)
+            const float ddx = x - 2.f * q[0] + q[2], ddy = y - 2.f * q[1] + q[3];
+            const int n = curve_segments(0.25f * sqrtf(ddx * ddx + ddy * ddy), tol);
+            for (int i = 1; i <= n; ++i)
+            {
+                const float t = (float)i / n, u = 1.f - t;
+                flat_point(&f, u * u * x + 2.f * u * t * q[0] + t * t * q[2],
+                    u * u * y + 2.f * u * t * q[1] + t * t * q[3]);
+            }
+            x = q[2];
+            y = q[3];
+            q += 4;
+            break;
+        }
+        case VECTOR_CUBIC:
+        {
+            // A cubic's at most 3/4 of its larger second difference over n^2
+            const float d0x = x - 2.f * q[0] + q[2], d0y = y - 2.f * q[1] + q[3];
+            const float d1x = q[0] - 2.f * q[2] + q[4], d1y = q[1] - 2.f * q[3] + q[5];
+            const float dd = fmaxf(d0x * d0x + d0y * d0y, d1x * d1x + d1y * d1y);
+            const int n = curve_segments(0.75f * sqrtf(dd), tol);
+            for (int i = 1; i <= n; ++i)
+            {
+                const float t = (float)i / n, u = 1.f - t;
+                const float a = u * u * u, b = 3.f * u * u * t, c = 3.f * u * t * t, d = t * t * t;
+                flat_point(&f, a * x + b * q[0] + c * q[2] + d * q[4], a * y + b * q[1] + c * q[3] + d * q[5]);
+            }
+            x = q[4];
+            y = q[5];
+            q += 6;
+            break;
+        }
+        default:
+            flat_end_contour(&f, true);
+            break;
+        }
+    flat_end_contour(&f, false);
+    path->flat_version = f.failed ? 0 : path->version;
+    path->flat_tolerance = tol;
+    ++path->flattens;
+    return !f.failed;
+}
+
+// Stroking
+
+typedef struct Stroker
+{
+    VectorPath* path;
+    float half;                 // half the width
+    float step;                 // radians between a round join's points
+    bool failed;
+} Stroker;
+
+// Adds a corner; returns its index
+static uint32_t stroke_vertex(Stroker* s, float x, float y)
+{
+    VectorPath* p = s->path;
+    if (!grow((void**)&p->stroke, &p->stroke_capacity, p->stroke_count + 1, 2 * sizeof(float)))
+    {
+        s->failed = true;
+        return 0;
+    }
+    p->stroke[2 * p->stroke_count] = x;
+    p->stroke[2 * p->stroke_count + 1] = y;
+    return p->stroke_count++;
+}
+
+static void stroke_triangle(Stroker* s, uint32_t a, uint32_t b, uint32_t c)
+{
+    VectorPath* p = s->path;
+    if (!grow((void**)&p->stroke_indices, &p->stroke_index_capacity, p->stroke_index_count + 3, sizeof(uint32_t)))
+    {
+        s->failed = true;
+        return;
+    }
+    uint32_t* i = p->stroke_indices + p->stroke_index_count;
+    i[0] = a;
+    i[1] = b;
+    i[2] = c;
+    p->stroke_index_count += 3;
+}
+
+// A fan about x, y from offset dx, dy turned through "angle" (signed) in steps of about s->step
+static void stroke_wedge(Stroker* s, float x, float y, float dx, float dy, float angle)
+{
+    int steps = (int)ceilf(fabsf(angle) / s->step);
+    steps = steps < 1 ? 1 : steps;
+    const float c = cosf(angle / steps), n = sinf(angle / steps);
+    const uint32_t center = stroke_vertex(s, x, y);
+    uint32_t last = stroke_vertex(s, x + dx, y + dy);
+    for (int i = 0; i < steps; ++i)
+    {
+        const float ex = dx * c - dy * n, ey = dx * n + dy * c;
+        const uint32_t next = stroke_vertex(s, x + ex, y + ey);
+        stroke_triangle(s, center, last, next);
+        last = next;
+        dx = ex;
+        dy = ey;
+    }
+}
+
+// Half the width across segment a -> b, to its left: (-dy, dx) scaled
+static inline void stroke_normal(const Stroker* s, const float* a, const float* b, float* nx, float* ny)
+{
+    const float dx = b[0] - a[0], dy = b[1] - a[1], scale = s->half / sqrtf(dx * dx + dy * dy);
+    *nx = -dy * scale;
+    *ny = dx * scale;
+}
+
+// The corners a point gives the segments on either side: a left and right pair for the one arriving and the one
+// leaving, the same pair where the turn is mitred
+typedef struct StrokeCorner
+{
+    uint32_t in_left, in_right, out_left, out_right;
+} StrokeCorner;
+
+// Point "b" between segments a -> b and b -> e: mitred if the turn is gentle, otherwise each segment's own pair
+// and the join between them on the outside of the turn
+static StrokeCorner stroke_corner(Stroker* s, const float* a, const float* b, const float* e, VectorJoin join)
+{
+    float nx, ny, mx, my;
+    stroke_normal(s, a, b, &nx, &ny);
+    stroke_normal(s, b, e, &mx, &my);
+    const float half2 = s->half * s->half, dot = nx * mx + ny * my;
+    StrokeCorner c;
+    if (dot >= VECTOR_PATH_MITER_TURN * half2)
+    {
+        // Out along the normals' mean, as far as keeps both edges "half" away: (n + m) half^2 / (half^2 + n.m)
+        const float k = half2 / (half2 + dot), ox = (nx + mx) * k, oy = (ny + my) * k;
+        c.in_left = c.out_left = stroke_vertex(s, b[0] + ox, b[1] + oy);
+        c.in_right = c.out_right = stroke_vertex(s, b[0] - ox, b[1] - oy);
+        return c;
+    }
+    c.in_left = stroke_vertex(s, b[0] + nx, b[1] + ny);
+    c.in_right = stroke_vertex(s, b[0] - nx, b[1] - ny);
+    c.out_left = stroke_vertex(s, b[0] + mx, b[1] + my);
+    c.out_right = stroke_vertex(s, b[0] - mx, b[1] - my);
+    const float cross = nx * my - ny * mx;
+    const bool right = cross > 0.f;     // turning left: the outside is on the right
+    const float side = right ? -1.f : 1.f;
+    if (join == VECTOR_JOIN_ROUND)
+        stroke_wedge(s, b[0], b[1], side * nx, side * ny, atan2f(cross, dot));
+    else
+        stroke_triangle(s, stroke_vertex(s, b[0], b[1]), right ? c.in_right : c.in_left,
+            right ? c.out_right : c.out_left);
+    return c;
+}
+
+bool vector_path_stroke(VectorPath* path, float width, VectorJoin join, float tolerance)
+{
+    if (!vector_path_flatten(path, tolerance))
+        return false;
+    if (path->stroke_version == path->version && path->stroke_tolerance == path->flat_tolerance
+        && path->stroke_width == width && path->stroke_join == join)
+        return true;
+    Stroker s = { path, 0.5f * width, 0.f, false };
+    // A round join's chords stray at most the tolerance from its arc
+    const float ratio = 1.f - path->flat_tolerance / (s.half > 0.f ? s.half : 1.f);
+    s.step = fminf(fmaxf(2.f * acosf(ratio > 0.f ? ratio : 0.f), 2.f * PI / 64.f), 0.5f * PI);
+    path->stroke_count = path->stroke_index_count = 0;
+    for (uint32_t c = 0, first = 0; c < path->contour_count && s.half > 0.f; first = path->contour_ends[c++])
+    {
+        const uint32_t n = path->contour_ends[c] - first;
+        const bool closed = path->contour_closed[c] && n > 2;
+        const float* pts = path->flat + 2 * first;
+
+        // The first point's corners: an open contour's start is square across its first segment
+        StrokeCorner start;
+        float nx, ny;
+        if (closed)
+            start = stroke_corner(&s, pts + 2 * (n - 1), pts, pts + 2, join);
+        else
+        {
+            stroke_normal(&s, pts, pts + 2, &nx, &ny);
+            start.out_left = stroke_vertex(&s, pts[0] + nx, pts[1] + ny);
+            start.out_right = stroke_vertex(&s, pts[0] - nx, pts[1] - ny);
+            if (join == VECTOR_JOIN_ROUND)
+                stroke_wedge(&s, pts[0], pts[1], nx, ny, PI);      // round back from the left, away from the line
+        }
+        StrokeCorner from = start;
+        const uint32_t segments = closed ? n : n - 1;
+        for (uint32_t i = 0; i < segments; ++i)
+        {
+            const float* b = pts + 2 * ((i + 1) % n);
+            StrokeCorner to;
+            if (closed && i + 1 == segments)
+                to = start;
+            else if (i + 2 < n || closed)
+                to = stroke_corner(&s, pts + 2 * i, b, pts + 2 * ((i + 2) % n), join);
+            else
+            {
+                // An open contour's end, square across its last segment
+                stroke_normal(&s, pts + 2 * i, b, &nx, &ny);
+                to.in_left = stroke_vertex(&s, b[0] + nx, b[1] + ny);
+                to.in_right = stroke_vertex(&s, b[0] - nx, b[1] - ny);
+                if (join == VECTOR_JOIN_ROUND)
+                    stroke_wedge(&s, b[0], b[1], nx, ny, -PI);
+            }
+            stroke_triangle(&s, from.out_left, to.in_left, to.in_right);
+            stroke_triangle(&s, from.out_left, to.in_right, from.out_right);
+            from = to;
+        }
+    }
+    path->stroke_version = s.failed ? 0 : path->version;
+    path->stroke_tolerance = path->flat_tolerance;
+    path->stroke_width = width;
+    path->stroke_join = join;
+    ++path->flattens;
+    return !s.failed;
+}
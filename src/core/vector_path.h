@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+
+// Vector paths for the 2D batch (core/shape_batch.h): outlines made of
+// lines, quadratic and cubic Béziers and arcs, filled or stroked by the GPU
+// without being triangulated.
+//
+// A path is a list of verbs and their points, in units of its own. To be
+// drawn it's flattened: each curve becomes enough line segments that none
+// strays more than a tolerance from it, and for a stroke the flattened
+// outline is widened into triangles. Both are cached in the path, for the
+// edit and the tolerance they were made at, and made again only when the
+// path is edited or drawn so much larger that its segments would show
+// (flattenings are made at half the tolerance asked for, so a slow zoom
+// doesn't make one every frame). A static path (a panel, a dial, an icon)
+// is flattened once however it's moved, rotated or recoloured; a path
+// rebuilt every frame pays for flattening, linear in its size, every frame.
+//
+// Nothing is triangulated: a fill is drawn as a fan of triangles from its
+// first point to each of its edges, which covers every point as many times,
+// counted by facing, as the outline winds around it (stencil-then-cover, in
+// gl/shape_renderer.h). Self-intersecting outlines and holes cost nothing
+// extra. Nothing here calls GL.
+
+#define VECTOR_PATH_MAX_SEGMENTS 256        // line segments a curve is flattened into, at most
+#define VECTOR_PATH_REFLATTEN 4.f           // a cached flattening this much finer than needed is made again
+#define VECTOR_PATH_MITER_TURN 0.5f         // the cosine of the sharpest turn a stroke mitres (60 degrees)
+
+typedef enum VectorVerb
+{
+    VECTOR_MOVE,                // one point: starts a contour
+    VECTOR_LINE,                // one point
+    VECTOR_QUAD,                // a control point, then the end
+    VECTOR_CUBIC,               // two control points, then the end
+    VECTOR_CLOSE                // no points: back to the contour's start
+} VectorVerb;
+
+// How a stroke turns corners. Round also rounds the ends of open contours; bevel leaves them square at the end point.
+typedef enum VectorJoin
+{
+    VECTOR_JOIN_BEVEL,
+    VECTOR_JOIN_ROUND
+} VectorJoin;
+
+typedef struct VectorPath
+{
+    uint8_t* verbs;             // VectorVerb
+    float* points;              // x, y pairs, as many as each verb takes
+    uint32_t verb_count, verb_capacity;
+    uint32_t point_count, point_capacity;   // pairs
+    float current[2];           // where the next line, curve or arc starts
+    bool open;                  // a contour is under way; the next line starts one at "current" otherwise
+    uint32_t version;           // bumped by every edit, from 1
+
+    // The flattening: contours of points, each closed for a fill
+    float* flat;                // x, y pairs
+    uint32_t* contour_ends;     // one past each contour's last pair
+    uint8_t* contour_closed;    // whether the contour was closed, for a stroke
+    uint32_t flat_count, flat_capacity;     // pairs
+    uint32_t contour_count, contour_capacity;
+    uint32_t flat_version;      // the version it was made from; 0 for none
+    float flat_tolerance;
+
+    // The stroke: the flattening widened into indexed triangles. Gentle corners (up to VECTOR_PATH_MITER_TURN) are
+    // mitred, the two segments sharing their corners; sharper ones get a join of their own.
+    float* stroke;              // x, y pairs
+    uint32_t* stroke_indices;   // three a triangle
+    uint32_t stroke_count, stroke_capacity;     // pairs
+    uint32_t stroke_index_count, stroke_index_capacity;
+    uint32_t stroke_version;    // the version it was made from; 0 for none
+    float stroke_tolerance;     // the flattening's it was made from
+    float stroke_width;
+    VectorJoin stroke_join;
+
+    uint32_t flattens;          // flattenings and strokes made, over the path's life: its cache misses
+} VectorPath;
+
+void vector_path_init(VectorPath* path);
+void vector_path_destroy(VectorPath* path);
+
+// Empties the path to build it again; its memory and its caches' memory are kept
+void vector_path_reset(VectorPath* path);
+
+void vector_path_move_to(VectorPath* path, float x, float y);
+
+// From the current point; with no contour open they start one there (after a close, at the closed one's start)
+void vector_path_line_to(VectorPath* path, float x, float y);
+void vector_path_quad_to(VectorPath* path, float cx, float cy, float x, float y);
+void vector_path_cubic_to(VectorPath* path, float c0x, float c0y, float c1x, float c1y, float x, float y);
+void vector_path_close(VectorPath* path);
+
+// The arc of the circle of "radius" about cx, cy from angle a0 to a1 (radians from +x towards +y, so clockwise on
+// screen), as cubics of a quarter turn or less; joined to an open contour by a line, or starting one
+void vector_path_arc(VectorPath* path, float cx, float cy, float radius, float a0, float a1);
+
+// Closed contours of their own
+void vector_path_rounded_rect(VectorPath* path, float x, float y, float width, float height, float radius);
+void vector_path_ellipse(VectorPath* path, float cx, float cy, float rx, float ry);
+
+// Flattens the path so no segment strays more than "tolerance" (path units) from its curve, unless the cached
+// flattening already does and isn't VECTOR_PATH_REFLATTEN times finer. Returns false when memory runs out.
+bool vector_path_flatten(VectorPath* path, float tolerance);
+
+// Flattens the path as vector_path_flatten and widens it by "width" (path units) into triangles, turning corners
+// with "join"; made again only when the flattening, the width or the join changes. Returns false when memory runs
+// out.
+bool vector_path_stroke(VectorPath* path, float width, VectorJoin join, float tolerance);
@@ -0,0 +1,306 @@
+#include "core/wall_sync.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#define SEND_FLAGS 0
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#define SEND_FLAGS MSG_NOSIGNAL     // a follower that's gone is an error to handle, not a SIGPIPE
+#endif
+
+enum
+{
+    MESSAGE_HELLO,      // a follower's first, on each connection: its node, and which connection it is
+    MESSAGE_FRAME,      // the leader's; "size" bytes of state follow
+    MESSAGE_READY,      // a follower's, at the barrier
+    MESSAGE_GO          // the leader's, once everyone is at the barrier
+};
+
+typedef struct WallMessage
+{
+    uint32_t type;
+    uint32_t node;
+    uint32_t frame;     // MESSAGE_FRAME / READY / GO: the frame it's for. MESSAGE_HELLO: 0 frames, 1 swaps
+    uint32_t size;
+} WallMessage;
+
+static double now_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool send_all(intptr_t s, const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+    while (size > 0)
+    {
+        const int n = (int)send((socket_t)s, p, (int)size, SEND_FLAGS);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool recv_all(intptr_t s, void* data, size_t size)
+{
+    char* p = (char*)data;
+    while (size > 0)
+    {
+        const int n = (int)recv((socket_t)s, p, (int)size, 0);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool send_message(intptr_t s, uint32_t type, uint32_t node, uint32_t frame, const void* data, uint32_t size)
+{
+    const WallMessage m = { type, node, frame, size };
+    return send_all(s, &m, sizeof(m)) && (!size || send_all(s, data, size));
+}
+
+static void no_delay(intptr_t s)
+{
+    int on = 1;
+    setsockopt((socket_t)s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+}
+
+static void close_all(WallSync* sync)
+{
+    for (int i = 0; i < WALL_SYNC_MAX_NODES; ++i)
+    {
+        if (sync->frame_sockets[i] != (intptr_t)INVALID_SOCKET)
+            close_socket((socket_t)sync->frame_sockets[i]);
+        if (sync->swap_sockets[i] != (intptr_t)INVALID_SOCKET)
+            close_socket((socket_t)sync->swap_sockets[i]);
+        sync->frame_sockets[i] = sync->swap_sockets[i] = (intptr_t)INVALID_SOCKET;
+        sync->alive[i] = false;
+    }
+}
+
+// The leader: accepts connections until every follower has both of its own, or the time is up
+static bool accept_followers(WallSync* sync, int port)
+{
+    const auto listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET)
+        return false;
+    int on = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t)port);
+    if (bind(listener, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 2 * WALL_SYNC_MAX_NODES))
+    {
+        fprintf(stderr, "wall_sync: can't listen on port %d\n", port);
+        close_socket(listener);
+        return false;
+    }
+
+    int missing = 2 * (sync->nodes - 1);
+    const double deadline = now_seconds() + WALL_SYNC_TIMEOUT;
+    while (missing > 0 && now_seconds() < deadline)
+    {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+        timeval wait = { 0, 100000 };
+        if (select((int)listener + 1, &readable, NULL, NULL, &wait) <= 0)
+            continue;
+        const auto s = accept(listener, NULL, NULL);
+        if (s == INVALID_SOCKET)
+            continue;
+        WallMessage hello;
+        const bool ok = recv_all((intptr_t)s, &hello, sizeof(hello)) && hello.type == MESSAGE_HELLO
+            && hello.node > 0 && (int)hello.node < sync->nodes && hello.frame <= 1;
+        intptr_t* slot = !ok ? NULL : hello.frame ? &sync->swap_sockets[hello.node] : &sync->frame_sockets[hello.node];
+        if (!slot || *slot != (intptr_t)INVALID_SOCKET)
+        {
+            close_socket(s);    // not a follower, or a second one with the same number
+            continue;
+        }
+        no_delay((intptr_t)s);
+        *slot = (intptr_t)s;
+        --missing;
+    }
+    close_socket(listener);
+    for (int i = 1; i < sync->nodes; ++i)
+        sync->alive[i] = true;
+    if (missing > 0)
+        fprintf(stderr, "wall_sync: %d of %d followers connected within %.0f s\n",
+            sync->nodes - 1 - (missing + 1) / 2, sync->nodes - 1, WALL_SYNC_TIMEOUT);
+    return missing == 0;
+}
+
+// A follower: a connection to the leader, retried while it isn't listening yet
+static intptr_t connect_leader(const WallSync* sync, const char* host, int port, uint32_t channel, double deadline)
+{
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = NULL;
+    if (getaddrinfo(host, service, &hints, &found) != 0 || !found)
+    {
+        fprintf(stderr, "wall_sync: can't resolve %s\n", host);
+        return (intptr_t)INVALID_SOCKET;
+    }
+    intptr_t result = (intptr_t)INVALID_SOCKET;
+    while (result == (intptr_t)INVALID_SOCKET && now_seconds() < deadline)
+    {
+        const auto s = socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+        if (s != INVALID_SOCKET && connect(s, found->ai_addr, (socklen_t)found->ai_addrlen) == 0)
+        {
+            no_delay((intptr_t)s);
+            if (send_message((intptr_t)s, MESSAGE_HELLO, (uint32_t)sync->node, channel, NULL, 0))
+                result = (intptr_t)s;
+            else
+                close_socket(s);
+        }
+        else
+        {
+            if (s != INVALID_SOCKET)
+                close_socket(s);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    freeaddrinfo(found);
+    return result;
+}
+
+bool wall_sync_init(WallSync* sync, int node, int nodes, const char* host, int port)
+{
+    sync->node = node;
+    sync->nodes = nodes;
+    sync->frames = sync->barriers = 0;
+    sync->barrier_seconds = sync->barrier_max = 0.0;
+    for (int i = 0; i < WALL_SYNC_MAX_NODES; ++i)
+    {
+        sync->frame_sockets[i] = sync->swap_sockets[i] = (intptr_t)INVALID_SOCKET;
+        sync->alive[i] = false;
+    }
+    if (nodes < 1 || nodes > WALL_SYNC_MAX_NODES || node < 0 || node >= nodes)
+        return false;
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+        return false;
+#endif
+    bool ok;
+    if (node == 0)
+        ok = accept_followers(sync, port);
+    else
+    {
+        const double deadline = now_seconds() + WALL_SYNC_TIMEOUT;
+        sync->frame_sockets[0] = connect_leader(sync, host, port, 0, deadline);
+        sync->swap_sockets[0] = sync->frame_sockets[0] == (intptr_t)INVALID_SOCKET ? (intptr_t)INVALID_SOCKET
+            : connect_leader(sync, host, port, 1, deadline);
+        ok = sync->swap_sockets[0] != (intptr_t)INVALID_SOCKET;
+        sync->alive[0] = ok;
+        if (!ok)
+            fprintf(stderr, "wall_sync: no leader at %s:%d within %.0f s\n", host, port, WALL_SYNC_TIMEOUT);
+    }
+    if (!ok)
+        wall_sync_destroy(sync);
+    return ok;
+}
+
+void wall_sync_destroy(WallSync* sync)
+{
+    close_all(sync);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+// The leader: a follower whose connection failed leaves the wall
+static void drop(WallSync* sync, int i)
+{
+    fprintf(stderr, "wall_sync: node %d left the wall\n", i);
+    close_socket((socket_t)sync->frame_sockets[i]);
+    close_socket((socket_t)sync->swap_sockets[i]);
+    sync->frame_sockets[i] = sync->swap_sockets[i] = (intptr_t)INVALID_SOCKET;
+    sync->alive[i] = false;
+}
+
+bool wall_sync_frame(WallSync* sync, void* state, size_t size)
+{
+    const uint32_t frame = sync->frames++;
+    if (sync->node == 0)
+    {
+        for (int i = 1; i < sync->nodes; ++i)
+            if (sync->alive[i] && !send_message(sync->frame_sockets[i], MESSAGE_FRAME, 0, frame, state, (uint32_t)size))
+                drop(sync, i);
+        return true;
+    }
+    WallMessage m;
+    return recv_all(sync->frame_sockets[0], &m, sizeof(m)) && m.type == MESSAGE_FRAME && m.frame == frame
+        && m.size == size && recv_all(sync->frame_sockets[0], state, size);
+}
+
+bool wall_sync_barrier(WallSync* sync)
+{
+    const double start = now_seconds();
+    const uint32_t frame = sync->barriers++;
+    bool ok = true;
+    if (sync->node == 0)
+    {
+        for (int i = 1; i < sync->nodes; ++i)
+        {
+            WallMessage m;
+            if (sync->alive[i] && (!recv_all(sync->swap_sockets[i], &m, sizeof(m)) || m.type != MESSAGE_READY
+                || m.frame != frame))
+                drop(sync, i);
+        }
+        for (int i = 1; i < sync->nodes; ++i)
+            if (sync->alive[i] && !send_message(sync->swap_sockets[i], MESSAGE_GO, 0, frame, NULL, 0))
+                drop(sync, i);
+    }
+    else
+    {
+        WallMessage m;
+        ok = send_message(sync->swap_sockets[0], MESSAGE_READY, (uint32_t)sync->node, frame, NULL, 0)
+            && recv_all(sync->swap_sockets[0], &m, sizeof(m)) && m.type == MESSAGE_GO && m.frame == frame;
+    }
+    const double waited = now_seconds() - start;
+    sync->barrier_seconds += waited;
+    if (waited > sync->barrier_max)
+        sync->barrier_max = waited;
+    return ok;
+}
+
+bool wall_sync_parse_node(const char* text, int* node, int* nodes)
+{
+    char end = 0;
+    return sscanf(text, "%d/%d%c", node, nodes, &end) == 2 && *nodes >= 1 && *nodes <= WALL_SYNC_MAX_NODES
+        && *node >= 0 && *node < *nodes;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Keeps the processes of a distributed video wall in step over TCP. Node 0
+// leads: it runs the input and the clock, and once a frame hands every
+// follower that frame's state (wall_sync_frame: the camera and the time step,
+// packed by the caller), so every node simulates the same scene and draws its
+// own tile of the same view. Before each swap every node waits at
+// wall_sync_barrier: the followers report the frame drawn and wait for the
+// leader's go, which it sends once all of them (and it) are there. The wall
+// then flips together, to within a network round trip; an NV_swap_group
+// barrier (gl/swap_group.h) takes it the rest of the way where there is one.
+//
+// Each follower keeps two connections to the leader, one for the frames and
+// one for the barrier, so the thread that simulates and the one that swaps
+// each have their own and never read the other's messages. Both run with
+// Nagle's algorithm off.
+//
+// A follower that goes away is dropped and the rest carry on; when the leader
+// goes, every follower's next call returns false and its run ends. The
+// messages are in the hosts' own byte order: the nodes of a wall are the
+// same kind of machine.
+
+#define WALL_SYNC_MAX_NODES 16
+#define WALL_SYNC_PORT 47800
+#define WALL_SYNC_TIMEOUT 30.0      // seconds the leader waits for everyone, or a follower for the leader
+
+typedef struct WallSync
+{
+    int node;                   // 0 leads
+    int nodes;
+    intptr_t frame_sockets[WALL_SYNC_MAX_NODES];   // the leader's, by follower; a follower's: [0], the leader
+    intptr_t swap_sockets[WALL_SYNC_MAX_NODES];
+    bool alive[WALL_SYNC_MAX_NODES];    // the leader's: which followers are still there
+    unsigned int frames;        // sent by the leader, received by a follower
+    unsigned int barriers;
+    double barrier_seconds;     // time spent waiting at the barrier, over the run
+    double barrier_max;         // the longest wait
+} WallSync;
+
+// Node "node" of "nodes": the leader listens on "port" until every follower has connected; a follower connects
+// to the leader at "host" (retrying while it starts). Returns false (with a message) when that doesn't happen
+// within WALL_SYNC_TIMEOUT.
+bool wall_sync_init(WallSync* sync, int node, int nodes, const char* host, int port);
+void wall_sync_destroy(WallSync* sync);
+
+// The thread that simulates, once a frame. The leader sends the "size" bytes at "state" to every follower; a
+// follower waits for the next frame's and copies it into "state". Returns false on a follower once the leader is
+// gone (or sent something else).
+bool wall_sync_frame(WallSync* sync, void* state, size_t size);
+
+// The thread that swaps, with the frame drawn: returns once every node has got here for this frame. False on a
+// follower once the leader is gone.
+bool wall_sync_barrier(WallSync* sync);
+
+// The "node/nodes" argument: fills both and returns true when it's well formed
+bool wall_sync_parse_node(const char* text, int* node, int* nodes);
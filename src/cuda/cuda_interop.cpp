@@ -0,0 +1,153 @@
+#include "cuda/cuda_interop.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool cuda_ok(cudaError_t error, const char* what)
+{
+    if (error == cudaSuccess)
+        return true;
+    fprintf(stderr, "cuda_interop: %s: %s\n", what, cudaGetErrorString(error));
+    return false;
+}
+
+bool cuda_interop_init(CudaInterop* ci)
+{
+    memset(ci, 0, sizeof(*ci));
+    unsigned int count = 0;
+    int devices[4];
+    if (cudaGLGetDevices(&count, devices, 4, cudaGLDeviceListAll) != cudaSuccess || !count)
+    {
+        cudaGetLastError();     // not sticky: clear it
+        fprintf(stderr, "cuda_interop: no CUDA device runs the GL context\n");
+        return false;
+    }
+    ci->device = devices[0];
+    if (!cuda_ok(cudaSetDevice(ci->device), "cudaSetDevice")
+        || !cuda_ok(cudaStreamCreateWithFlags(&ci->stream, cudaStreamNonBlocking), "cudaStreamCreate"))
+    {
+        ci->stream = NULL;
+        return false;
+    }
+    cudaDeviceProp prop;
+    if (cudaGetDeviceProperties(&prop, ci->device) == cudaSuccess)
+        printf("cuda_interop: device %d, %s\n", ci->device, prop.name);
+    return true;
+}
+
+void cuda_interop_destroy(CudaInterop* ci)
+{
+    for (int i = 0; i < ci->count; ++i)
+        cudaGraphicsUnregisterResource(ci->resources[i].handle);
+    if (ci->stream)
+        cudaStreamDestroy(ci->stream);
+    memset(ci, 0, sizeof(*ci));
+}
+
+static CudaInteropResource* add_resource(CudaInterop* ci, GLuint object, const char* name, bool buffer)
+{
+    if (ci->count == CUDA_INTEROP_MAX_RESOURCES)
+    {
+        fprintf(stderr, "cuda_interop: no room for %s past %d resources\n", name, CUDA_INTEROP_MAX_RESOURCES);
+        return NULL;
+    }
+    CudaInteropResource* res = &ci->resources[ci->count];
+    memset(res, 0, sizeof(*res));
+    res->object = object;
+    res->buffer = buffer;
+    res->graph_resource = -1;
+    snprintf(res->name, sizeof(res->name), "%s", name);
+    return res;
+}
+
+int cuda_interop_register_buffer(CudaInterop* ci, GLuint buffer, const char* name, bool write_only)
+{
+    CudaInteropResource* res = add_resource(ci, buffer, name, true);
+    const unsigned int flags = write_only ? cudaGraphicsRegisterFlagsWriteDiscard : cudaGraphicsRegisterFlagsNone;
+    if (!res || !cuda_ok(cudaGraphicsGLRegisterBuffer(&res->handle, buffer, flags), name))
+        return -1;
+    return ci->count++;
+}
+
+int cuda_interop_register_texture(CudaInterop* ci, GLuint texture, const char* name)
+{
+    CudaInteropResource* res = add_resource(ci, texture, name, false);
+    if (!res || !cuda_ok(cudaGraphicsGLRegisterImage(&res->handle, texture, GL_TEXTURE_2D,
+        cudaGraphicsRegisterFlagsSurfaceLoadStore), name))
+        return -1;
+    return ci->count++;
+}
+
+// The resources of "ci" in the mask, with their handles in "handles"
+static int masked(CudaInterop* ci, uint64_t resources, CudaInteropResource** picked,
+    cudaGraphicsResource_t* handles)
+{
+    int n = 0;
+    for (int i = 0; i < ci->count; ++i)
+    {
+        CudaInteropResource* res = &ci->resources[i];
+        if (res->graph_resource >= 0 && (resources & (1ull << res->graph_resource)))
+        {
+            picked[n] = res;
+            handles[n++] = res->handle;
+        }
+    }
+    return n;
+}
+
+static void map_resources(void* user, const FrameGraph* graph, uint64_t resources)
+{
+    CudaInterop* ci = (CudaInterop*)user;
+    CudaInteropResource* picked[CUDA_INTEROP_MAX_RESOURCES];
+    cudaGraphicsResource_t handles[CUDA_INTEROP_MAX_RESOURCES];
+    const int n = masked(ci, resources, picked, handles);
+    if (!n)
+        return;
+    const double start = now_ms();
+    if (!cuda_ok(cudaGraphicsMapResources(n, handles, ci->stream), "cudaGraphicsMapResources"))
+        return;
+    for (int i = 0; i < n; ++i)
+    {
+        CudaInteropResource* res = picked[i];
+        if (res->buffer)
+            cuda_ok(cudaGraphicsResourceGetMappedPointer(&res->pointer, &res->size, res->handle), res->name);
+        else
+            cuda_ok(cudaGraphicsSubResourceGetMappedArray(&res->array, res->handle, 0, 0), res->name);
+    }
+    ci->map_ms += now_ms() - start;
+    ++ci->map_calls;
+    ci->resources_mapped += n;
+}
+
+static void unmap_resources(void* user, const FrameGraph* graph, uint64_t resources)
+{
+    CudaInterop* ci = (CudaInterop*)user;
+    CudaInteropResource* picked[CUDA_INTEROP_MAX_RESOURCES];
+    cudaGraphicsResource_t handles[CUDA_INTEROP_MAX_RESOURCES];
+    const int n = masked(ci, resources, picked, handles);
+    if (!n)
+        return;
+    const double start = now_ms();
+    cuda_ok(cudaGraphicsUnmapResources(n, handles, ci->stream), "cudaGraphicsUnmapResources");
+    for (int i = 0; i < n; ++i)
+    {
+        picked[i]->pointer = NULL;
+        picked[i]->size = 0;
+        picked[i]->array = NULL;
+    }
+    ci->map_ms += now_ms() - start;
+}
+
+int cuda_interop_import(CudaInterop* ci, FrameGraph* g, int i)
+{
+    CudaInteropResource* res = &ci->resources[i];
+    res->graph_resource = frame_graph_import(g, res->name, NULL, res->object, false);
+    frame_graph_set_interop(g, map_resources, unmap_resources, ci);
+    return res->graph_resource;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glad/glad.h>      // before cuda_gl_interop.h, which would include GL/gl.h
+#include <cuda_gl_interop.h>
+#include <cuda_runtime.h>
+
+#include "core/frame_graph.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// GL buffers and textures CUDA kernels work on in place (CUDA-GL interop):
+// no copy through the host between a simulation and the draw that shows it.
+//
+// A GL object is registered with CUDA once (cudaGraphicsGLRegisterBuffer /
+// cudaGraphicsGLRegisterImage), which is slow and done at load. For a frame
+// it's imported into the frame graph (cuda_interop_import), where the passes
+// that launch kernels on it use it FRAME_GRAPH_EXTERNAL. The graph works out
+// where a run of them starts and ends and the executor calls this module's
+// hooks there: every resource a pass starts a run of is mapped in one
+// cudaGraphicsMapResources on the module's stream, and its device pointer
+// (or level 0's array) fetched for the kernels; at the run's end they're
+// unmapped in one cudaGraphicsUnmapResources. Mapping waits for the GL work
+// issued before it and unmapping makes what CUDA's stream did visible to
+// the GL work after it, so the graph issues no barriers for them, and a
+// chain of kernels on one buffer pays for one map.
+//
+// CUDA has to run on the GPU the GL context does (cudaGLGetDevices): init
+// logs and returns false without a CUDA device there. A buffer registered
+// write-only is given to CUDA with its contents discarded, so GL needn't
+// keep them for it.
+
+#define CUDA_INTEROP_MAX_RESOURCES 16
+
+typedef struct CudaInteropResource
+{
+    cudaGraphicsResource_t handle;
+    GLuint object;
+    bool buffer;                    // else a texture, mapped as level 0's array
+    char name[32];
+    int graph_resource;             // in the graph it was last imported into, -1 for none
+    void* pointer;                  // a buffer while mapped
+    size_t size;
+    cudaArray_t array;              // a texture while mapped
+} CudaInteropResource;
+
+typedef struct CudaInterop
+{
+    int device;
+    cudaStream_t stream;            // the kernels' and the maps'
+    CudaInteropResource resources[CUDA_INTEROP_MAX_RESOURCES];
+    int count;
+
+    // Over the run
+    uint64_t map_calls;             // cudaGraphicsMapResources, each for a pass's resources together
+    uint64_t resources_mapped;
+    double map_ms;                  // the host's time in map and unmap calls
+} CudaInterop;
+
+// On the current GL context's GPU. Logs and returns false without a CUDA device there.
+bool cuda_interop_init(CudaInterop* ci);
+void cuda_interop_destroy(CudaInterop* ci);
+
+// Registers "buffer" or "texture" (a 2D GL_TEXTURE_2D of a format CUDA takes, e.g. GL_RGBA8 or GL_RGBA32F) with CUDA.
+// Returns the resource's index, or -1 (logged) when CUDA won't take it or there are CUDA_INTEROP_MAX_RESOURCES.
+int cuda_interop_register_buffer(CudaInterop* ci, GLuint buffer, const char* name, bool write_only);
+int cuda_interop_register_texture(CudaInterop* ci, GLuint texture, const char* name);
+
+// Imports resource "i" into "g" (after its frame_graph_reset) and sets the graph's interop hooks to this module's.
+// Returns its index in the graph, -1 when the graph is full.
+int cuda_interop_import(CudaInterop* ci, FrameGraph* g, int i);
+
+// While a pass using it FRAME_GRAPH_EXTERNAL runs: a buffer's device pointer and size, a texture's array
+static inline void* cuda_interop_buffer(const CudaInterop* ci, int i, size_t* size)
+{
+    *size = ci->resources[i].size;
+    return ci->resources[i].pointer;
+}
+
+static inline cudaArray_t cuda_interop_array(const CudaInterop* ci, int i)
+{
+    return ci->resources[i].array;
+}
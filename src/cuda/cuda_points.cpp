@@ -0,0 +1,59 @@
+#include "cuda/cuda_points.h"
+
+#include "gl/frame_graph_gl.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool cuda_points_init(CudaPoints* cp, uint32_t count)
+{
+    memset(cp, 0, sizeof(*cp));
+    cp->resource = -1;
+    if (!cuda_interop_init(&cp->interop))
+        return false;
+    cp->count = count;
+    cp->buffer = gl_dsa_create_buffer((GLsizeiptr)sizeof(FeedPoint) * count, NULL, GL_DYNAMIC_DRAW);
+    gl_debug_label(GL_BUFFER, cp->buffer, "cuda points");
+    cp->resource = cuda_interop_register_buffer(&cp->interop, cp->buffer, "cuda points", true);
+    cp->graph = (FrameGraph*)malloc(sizeof(FrameGraph));
+    return cp->resource >= 0 && cp->graph;
+}
+
+void cuda_points_destroy(CudaPoints* cp)
+{
+    cuda_interop_destroy(&cp->interop);     // unregisters the buffer before it goes
+    if (cp->buffer)
+        glDeleteBuffers(1, &cp->buffer);
+    free(cp->graph);
+    memset(cp, 0, sizeof(*cp));
+}
+
+static void run_kernel(void* user, const FrameGraph* graph, int pass)
+{
+    CudaPoints* cp = (CudaPoints*)user;
+    size_t size;
+    FeedPoint* points = (FeedPoint*)cuda_interop_buffer(&cp->interop, cp->resource, &size);
+    if (!points || size < sizeof(FeedPoint) * cp->count
+        || cuda_points_launch(points, cp->count, cp->time, cp->interop.stream) != cudaSuccess)
+        ++cp->launch_failures;
+}
+
+bool cuda_points_frame(CudaPoints* cp, double time, FrameGraphExecute draw, void* user)
+{
+    FrameGraph* g = cp->graph;
+    frame_graph_reset(g);
+    const int points = cuda_interop_import(&cp->interop, g, cp->resource);
+    const int move = frame_graph_add_pass(g, "cuda points", run_kernel, cp);
+    frame_graph_write(g, move, points, FRAME_GRAPH_EXTERNAL);
+    const int show = frame_graph_add_pass(g, "draw cuda points", draw, user);
+    frame_graph_read(g, show, points, FRAME_GRAPH_VERTEX);
+    frame_graph_set_side_effects(g, show);
+    cp->time = (float)time;
+    if (!frame_graph_compile(g))
+        return false;
+    ++cp->frames;
+    return frame_graph_gl_execute(g, NULL);     // no transients: no pool
+}
@@ -0,0 +1,29 @@
+#include "cuda/cuda_points.h"
+
+// A disc of points turning at a speed of their radius's, breathing up and down, coloured by radius. Each thread
+// writes its point's 16 bytes whole, so a warp's writes are coalesced.
+static __global__ void move_points(FeedPoint* points, uint32_t count, float time)
+{
+    const uint32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i >= count)
+        return;
+    const float t = (i + 0.5f) / count;
+    const float radius = 20.f * sqrtf(t);
+    const float angle = 2.39996323f * i + time * (1.5f - t);       // golden angle apart
+    float s, c;
+    __sincosf(angle, &s, &c);
+    FeedPoint p;
+    p.pos[0] = radius * c;
+    p.pos[1] = 2.f + __sinf(radius * 0.5f - time * 2.f) * 1.5f;
+    p.pos[2] = radius * s;
+    const uint32_t r = (uint32_t)(255.f * t), g = (uint32_t)(255.f * (1.f - t)), b = 200u;
+    p.color = r | (g << 8) | (b << 16) | 0xff000000u;
+    points[i] = p;
+}
+
+cudaError_t cuda_points_launch(FeedPoint* points, uint32_t count, float time, cudaStream_t stream)
+{
+    const uint32_t blocks = (count + CUDA_POINTS_BLOCK - 1) / CUDA_POINTS_BLOCK;
+    move_points<<<blocks, CUDA_POINTS_BLOCK, 0, stream>>>(points, count, time);
+    return cudaGetLastError();
+}
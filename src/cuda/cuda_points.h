@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core/frame_graph.h"
+#include "core/shared_feed.h"
+#include "cuda/cuda_interop.h"
+
+#include <stdint.h>
+
+// --cuda-points: a CUDA kernel moves points in a GL vertex buffer that the
+// scene draws straight from, as the shared-memory feed's points would be
+// drawn (gl/feed_renderer.h) but with no copy at all: the kernel writes the
+// FeedPoints where the draw reads them (cuda/cuda_interop.h).
+//
+// Each frame is a graph of two passes over the buffer: "cuda points"
+// launches the kernel, using it FRAME_GRAPH_EXTERNAL, and the caller's draw
+// reads it as vertices. The graph maps the buffer to CUDA around the first
+// and gives it back before the second.
+
+#define CUDA_POINTS_BLOCK 256       // threads a block
+
+typedef struct CudaPoints
+{
+    CudaInterop interop;
+    FrameGraph* graph;              // the frame's, big enough to keep off the stack
+    GLuint buffer;
+    int resource;                   // the buffer's in "interop"
+    uint32_t count;
+    float time;                     // the kernel's, for the pass
+
+    // Over the run
+    uint64_t frames;
+    uint64_t launch_failures;
+} CudaPoints;
+
+// "count" points in a buffer of their own, registered with CUDA write-only. Logs and returns false without a CUDA
+// device on the GL context's GPU.
+bool cuda_points_init(CudaPoints* cp, uint32_t count);
+void cuda_points_destroy(CudaPoints* cp);
+
+// The frame at "time" seconds: the kernel writes the points, then "draw" (called as a pass, the graph's own)
+// draws them from cp->buffer. False when the graph didn't compile.
+bool cuda_points_frame(CudaPoints* cp, double time, FrameGraphExecute draw, void* user);
+
+// In cuda_points.cu: the kernel, launched on "stream"
+cudaError_t cuda_points_launch(FeedPoint* points, uint32_t count, float time, cudaStream_t stream);
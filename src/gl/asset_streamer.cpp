@@ -0,0 +1,502 @@
+#include "gl/asset_streamer.h"
+
+#include "gl/gl_dsa.h"
+#include "gl/gl_state.h"
+#include "core/alloc_tracker.h"
+#include "core/numa_memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void queue_push(AssetQueue* q, int id)
+{
+    q->ids[(q->head + q->count++) % ASSET_STREAMER_MAX_ASSETS] = id;
+}
+
+static int queue_pop(AssetQueue* q)
+{
+    const int id = q->ids[q->head];
+    q->head = (q->head + 1) % ASSET_STREAMER_MAX_ASSETS;
+    --q->count;
+    return id;
+}
+
+// Unpack thread: a packaged mesh's blocks unpack one after another here, as these threads aren't in the job system
+// (with two of them, two assets unpack at once)
+static void load_asset(StreamedMesh* asset)
+{
+    const int entry = package_find(asset->package, asset->path);
+    MappedFile file;
+    if (entry < 0)
+        fprintf(stderr, "asset_streamer: %s isn't in the package\n", asset->path);
+    const bool opened = entry >= 0 && package_extract(asset->package, entry, &file, NULL)
+        && mesh_file_open_mapped(&asset->file, &file, asset->path);
+    if (!opened || !vertex_format_from_mesh_file(&asset->format, asset->file.header))
+    {
+        mesh_file_close(&asset->file);
+        asset->state.store(ASSET_STATE_FAILED);
+    }
+}
+
+static void io_thread_main(AssetStreamer* s)
+{
+    ALLOC_TAG_SCOPE(ALLOC_TAG_STREAMING);
+    std::unique_lock<std::mutex> lock(s->mutex);
+    for (;;)
+    {
+        s->io_wake.wait(lock, [s] { return s->stop || s->load_queue.count > 0; });
+        if (s->stop)
+            return;
+        const int id = queue_pop(&s->load_queue);
+        StreamedMesh* asset = &s->assets[id];
+        asset->state.store(ASSET_STATE_LOADING);
+        lock.unlock();
+        load_asset(asset);
+        lock.lock();
+        if (asset->state.load() != ASSET_STATE_FAILED)
+        {
+            asset->state.store(ASSET_STATE_UPLOADING);
+            queue_push(&s->upload_queue, id);
+            s->upload_wake.notify_one();
+        }
+    }
+}
+
+// Reader: opens the file and sizes a buffer for it; its chunks are submitted by submit_chunks
+static bool start_read(AssetStreamer* s, StreamedMesh* asset)
+{
+    asset->io_file = async_io_open(s->io, asset->path, false, &asset->size);
+    if (asset->io_file < 0)
+        return false;
+    asset->buffer = asset->size > 0 ? (unsigned char*)malloc((size_t)asset->size) : NULL;
+    if (!asset->buffer)
+    {
+        fprintf(stderr, "asset_streamer: %s: can't read %llu bytes\n", asset->path, (unsigned long long)asset->size);
+        async_io_close(s->io, asset->io_file);
+        asset->io_file = -1;
+        return false;
+    }
+    if (s->node >= 0)
+        numa_prefer(asset->buffer, (size_t)asset->size, s->node);     // before the reads touch it
+    asset->chunks = (uint32_t)((asset->size + ASSET_STREAMER_CHUNK - 1) / ASSET_STREAMER_CHUNK);
+    asset->chunks_submitted = 0;
+    asset->chunks_left = asset->chunks;
+    asset->read_failed = false;
+    return true;
+}
+
+// Submits as many of an asset's remaining chunks as async I/O will queue, in one batch. The tag is the asset's id
+// and the chunk's index.
+static void submit_chunks(AssetStreamer* s, int id)
+{
+    StreamedMesh* asset = &s->assets[id];
+    AsyncIoRead reads[64];
+    while (asset->chunks_submitted < asset->chunks)
+    {
+        uint32_t count = 0;
+        for (uint32_t c = asset->chunks_submitted; c < asset->chunks && count < 64; ++c)
+        {
+            const uint64_t offset = (uint64_t)c * ASSET_STREAMER_CHUNK;
+            const uint64_t left = asset->size - offset;
+            reads[count++] = { asset->io_file, (uint32_t)(left < ASSET_STREAMER_CHUNK ? left : ASSET_STREAMER_CHUNK),
+                offset, asset->buffer + offset, (uint64_t)id << 32 | c, (uint32_t)asset->priority, 0 };
+        }
+        const uint32_t queued = async_io_submit(s->io, reads, count);
+        asset->chunks_submitted += queued;
+        if (queued < count)
+            return;
+    }
+}
+
+// Reader: the whole file is in, or a chunk failed. A read mesh is validated here, like a mapped one was.
+static void finish_read(AssetStreamer* s, int id)
+{
+    StreamedMesh* asset = &s->assets[id];
+    async_io_close(s->io, asset->io_file);
+    asset->io_file = -1;
+    bool opened = false;
+    if (asset->read_failed)
+    {
+        fprintf(stderr, "asset_streamer: can't read %s\n", asset->path);
+        free(asset->buffer);
+    }
+    else
+    {
+        MappedFile file;
+        mapped_file_adopt(&file, asset->buffer, (size_t)asset->size);
+        opened = mesh_file_open_mapped(&asset->file, &file, asset->path)
+            && vertex_format_from_mesh_file(&asset->format, asset->file.header);
+        if (!opened)
+            mesh_file_close(&asset->file);
+    }
+    asset->buffer = NULL;
+
+    std::lock_guard<std::mutex> lock(s->mutex);
+    if (!opened)
+    {
+        asset->state.store(ASSET_STATE_FAILED);
+        return;
+    }
+    asset->state.store(ASSET_STATE_UPLOADING);
+    queue_push(&s->upload_queue, id);
+    s->upload_wake.notify_one();
+}
+
+// One thread keeps every file's reads in flight: new requests start between polls, completions are counted off
+// their asset, and a poll waits for the next completion or for asset_streamer_load_mesh's wake
+static void reader_main(AssetStreamer* s)
+{
+    ALLOC_TAG_SCOPE(ALLOC_TAG_STREAMING);
+    int reading[ASSET_STREAMER_MAX_ASSETS];
+    int reading_count = 0;
+    AsyncIoCompletion done[ASYNC_IO_MAX_DEPTH];
+    for (;;)
+    {
+        int started[ASSET_STREAMER_MAX_ASSETS];
+        int started_count = 0;
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            if (s->stop)
+                break;
+            while (s->read_queue.count > 0)
+                started[started_count++] = queue_pop(&s->read_queue);
+        }
+        for (int i = 0; i < started_count; ++i)
+        {
+            StreamedMesh* asset = &s->assets[started[i]];
+            asset->state.store(ASSET_STATE_LOADING);
+            if (!start_read(s, asset))
+                asset->state.store(ASSET_STATE_FAILED);
+            else
+                reading[reading_count++] = started[i];
+        }
+        for (int i = 0; i < reading_count; ++i)
+            submit_chunks(s, reading[i]);
+
+        const uint32_t n = async_io_poll(s->io, done, ASYNC_IO_MAX_DEPTH, true);
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            const int id = (int)(done[i].tag >> 32);
+            const uint32_t chunk = (uint32_t)done[i].tag;
+            StreamedMesh* asset = &s->assets[id];
+            const uint64_t offset = (uint64_t)chunk * ASSET_STREAMER_CHUNK;
+            const uint64_t expected = asset->size - offset < ASSET_STREAMER_CHUNK ? asset->size - offset : ASSET_STREAMER_CHUNK;
+            if (done[i].result != (int64_t)expected)
+                asset->read_failed = true;
+            if (--asset->chunks_left > 0)
+                continue;
+            finish_read(s, id);
+            for (int r = 0; r < reading_count; ++r)
+                if (reading[r] == id)
+                {
+                    reading[r] = reading[--reading_count];
+                    break;
+                }
+        }
+    }
+
+    // Stopping: let the reads in flight land before their buffers go
+    async_io_destroy(s->io);
+    for (int i = 0; i < reading_count; ++i)
+    {
+        StreamedMesh* asset = &s->assets[reading[i]];
+        free(asset->buffer);
+        asset->buffer = NULL;
+        asset->state.store(ASSET_STATE_FAILED);
+    }
+}
+
+// Copies "size" bytes into the bound "target" buffer in budget-sized chunks, waiting for the next frame whenever
+// the budget runs out. Returns false if the streamer stopped first. Called with the lock held.
+static bool upload_chunked(AssetStreamer* s, std::unique_lock<std::mutex>& lock, GLuint buffer, const void* data, size_t size)
+{
+    size_t offset = 0;
+    while (offset < size)
+    {
+        s->upload_wake.wait(lock, [s] { return s->stop || s->bytes_per_frame == 0 || s->budget > 0; });
+        if (s->stop)
+            return false;
+        size_t chunk = size - offset;
+        if (s->bytes_per_frame)
+        {
+            chunk = chunk < s->budget ? chunk : s->budget;
+            s->budget -= chunk;
+            if (s->budget == 0)
+                ++s->frames_throttled;
+        }
+        lock.unlock();
+        gl_dsa_buffer_sub_data(buffer, (GLintptr)offset, (GLsizeiptr)chunk, (const unsigned char*)data + offset);
+        lock.lock();
+        offset += chunk;
+    }
+    s->bytes_uploaded += size;
+    return true;
+}
+
+// Upload thread: buffers are allocated up front and filled from the mapping, then the whole asset is fenced
+static bool upload_asset(AssetStreamer* s, std::unique_lock<std::mutex>& lock, StreamedMesh* asset)
+{
+    const MeshFileHeader* h = asset->file.header;
+    const size_t vertex_bytes = (size_t)mesh_file_vertex_bytes(h);
+    const size_t index_bytes = (size_t)h->index_count * h->index_size;
+
+    lock.unlock();
+    GpuMesh* mesh = &asset->mesh;
+    gpu_mesh_init_raw(mesh, NULL, vertex_bytes, h->vertex_count, NULL,
+        h->index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, h->index_count);
+    GpuMeshLod lods[GPU_MESH_MAX_LODS];
+    for (uint32_t l = 0; l < asset->file.lod_count; ++l)
+        lods[l] = { asset->file.lods[l].first_index, (GLsizei)asset->file.lods[l].index_count, asset->file.lods[l].error };
+    gpu_mesh_set_lods(mesh, lods, (int)asset->file.lod_count);
+    lock.lock();
+    bool ok = upload_chunked(s, lock, mesh->vertex_buffer, asset->file.vertices, vertex_bytes);
+    if (ok)
+        ok = upload_chunked(s, lock, mesh->index_buffer, asset->file.indices, index_bytes);
+    lock.unlock();
+
+    if (ok)
+    {
+        // The flush gets the fence to the GPU so the render context can wait on it
+        asset->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+    else
+        gpu_mesh_destroy(mesh);
+    mesh_file_close(&asset->file);
+    lock.lock();
+    return ok;
+}
+
+static void upload_thread_main(AssetStreamer* s)
+{
+    ALLOC_TAG_SCOPE(ALLOC_TAG_STREAMING);
+    std::unique_lock<std::mutex> lock(s->mutex);
+    s->upload_wake.wait(lock, [s] { return s->stop || s->started; });
+    GLuint vertex_array = 0;
+    if (!s->stop)
+    {
+        lock.unlock();
+        // Core profiles need a VAO bound for gpu_mesh_init_raw to bind the index buffer to; this one is never drawn with
+        glfwMakeContextCurrent(s->upload_window);
+        gl_state_reset();
+        vertex_array = gl_dsa_create_vertex_array();
+        gl_state_bind_vertex_array(vertex_array);
+        lock.lock();
+    }
+
+    while (!s->stop)
+    {
+        s->upload_wake.wait(lock, [s] { return s->stop || s->upload_queue.count > 0; });
+        if (s->stop)
+            break;
+        const int id = queue_pop(&s->upload_queue);
+        StreamedMesh* asset = &s->assets[id];
+        if (upload_asset(s, lock, asset))
+        {
+            asset->state.store(ASSET_STATE_UPLOADED);
+            queue_push(&s->done_queue, id);
+        }
+        else
+            asset->state.store(ASSET_STATE_FAILED);
+    }
+
+    // Nobody will take what's left: delete it while this thread still has a context (the objects are shared)
+    if (s->started)
+    {
+        for (int i = 0; i < s->asset_count; ++i)
+        {
+            StreamedMesh* asset = &s->assets[i];
+            const int state = asset->state.load();
+            if (state == ASSET_STATE_UPLOADED || state == ASSET_STATE_READY)
+            {
+                if (asset->fence)
+                    glDeleteSync(asset->fence);
+                gpu_mesh_destroy(&asset->mesh);
+                asset->fence = NULL;
+                asset->state.store(ASSET_STATE_FAILED);
+            }
+        }
+        gl_state_delete_vertex_arrays(1, &vertex_array);
+        glfwMakeContextCurrent(NULL);
+    }
+}
+
+bool asset_streamer_init(AssetStreamer* s, GLFWwindow* share, AsyncIoBackend backend, int io_threads,
+    size_t bytes_per_frame)
+{
+    s->upload_window = NULL;
+    s->io = NULL;
+    s->io_thread_count = 0;
+    s->read_queue = {};
+    s->load_queue = {};
+    s->upload_queue = {};
+    s->done_queue = {};
+    s->asset_count = 0;
+    s->bytes_per_frame = bytes_per_frame;
+    s->node = -1;
+    s->budget = 0;
+    s->started = false;
+    s->stop = false;
+    s->bytes_uploaded = 0;
+    s->frames_throttled = 0;
+
+    // Same context hints as the main window (they're still set), but never shown
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    s->upload_window = glfwCreateWindow(1, 1, "upload", NULL, share);
+    if (!s->upload_window)
+    {
+        fprintf(stderr, "asset_streamer: can't create a shared upload context\n");
+        return false;
+    }
+
+    if (io_threads < 1)
+        io_threads = 1;
+    s->io_thread_count = io_threads < ASSET_STREAMER_MAX_IO_THREADS ? io_threads : ASSET_STREAMER_MAX_IO_THREADS;
+    s->io = new AsyncIo;
+    async_io_init(s->io, backend, ASSET_STREAMER_IO_DEPTH, s->io_thread_count);
+    printf("asset_streamer: reading through %s\n", async_io_backend_name(s->io->backend));
+    s->reader_thread = std::thread(reader_main, s);
+    for (int i = 0; i < s->io_thread_count; ++i)
+        s->io_threads[i] = std::thread(io_thread_main, s);
+    s->upload_thread = std::thread(upload_thread_main, s);
+    return true;
+}
+
+void asset_streamer_destroy(AssetStreamer* s)
+{
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->stop = true;
+    }
+    s->io_wake.notify_all();
+    s->upload_wake.notify_all();
+    if (s->reader_thread.joinable())
+    {
+        async_io_wake(s->io);
+        s->reader_thread.join();
+    }
+    delete s->io;
+    s->io = NULL;
+    for (int i = 0; i < s->io_thread_count; ++i)
+        s->io_threads[i].join();
+    if (s->upload_thread.joinable())
+        s->upload_thread.join();
+
+    // Meshes read or unpacked that never reached the upload thread
+    for (int i = 0; i < s->asset_count; ++i)
+        mesh_file_close(&s->assets[i].file);
+    if (s->upload_window)
+        glfwDestroyWindow(s->upload_window);
+    s->upload_window = NULL;
+    s->io_thread_count = 0;
+}
+
+static int queue_asset(AssetStreamer* s, const Package* package, const char* name, AsyncIoPriority priority)
+{
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (s->asset_count == ASSET_STREAMER_MAX_ASSETS)
+        {
+            fprintf(stderr, "asset_streamer: more than %d assets requested\n", ASSET_STREAMER_MAX_ASSETS);
+            return -1;
+        }
+        id = s->asset_count++;
+        StreamedMesh* asset = &s->assets[id];
+        snprintf(asset->path, sizeof(asset->path), "%s", name);
+        asset->package = package;
+        asset->priority = priority;
+        memset(&asset->file, 0, sizeof(asset->file));
+        memset(&asset->mesh, 0, sizeof(asset->mesh));
+        asset->fence = NULL;
+        asset->io_file = -1;
+        asset->buffer = NULL;
+        asset->state.store(ASSET_STATE_QUEUED);
+        queue_push(package ? &s->load_queue : &s->read_queue, id);
+    }
+    if (package)
+        s->io_wake.notify_one();
+    else
+        async_io_wake(s->io);
+    return id;
+}
+
+int asset_streamer_load_mesh(AssetStreamer* s, const char* path)
+{
+    return queue_asset(s, NULL, path, ASYNC_IO_NOW);
+}
+
+int asset_streamer_prefetch_mesh(AssetStreamer* s, const char* path)
+{
+    return queue_asset(s, NULL, path, ASYNC_IO_PREFETCH);
+}
+
+int asset_streamer_load_packaged_mesh(AssetStreamer* s, const Package* package, const char* name)
+{
+    return queue_asset(s, package, name, ASYNC_IO_NOW);
+}
+
+void asset_streamer_set_node(AssetStreamer* s, int node)
+{
+    std::lock_guard<std::mutex> lock(s->mutex);
+    s->node = node;
+}
+
+void asset_streamer_set_budget(AssetStreamer* s, size_t bytes_per_frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->bytes_per_frame = bytes_per_frame;
+    }
+    s->upload_wake.notify_all();    // an upload waiting on the old budget may go on now there's none
+}
+
+int asset_streamer_begin_frame(AssetStreamer* s)
+{
+    int finished[ASSET_STREAMER_MAX_ASSETS];
+    int count = 0;
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->started = true;
+        s->budget = s->bytes_per_frame;
+        while (s->done_queue.count > 0)
+            finished[count++] = queue_pop(&s->done_queue);
+    }
+    s->upload_wake.notify_all();
+
+    // The fences were flushed by the upload context; waiting on them here orders this context's later draws
+    // after the uploads without blocking the CPU
+    for (int i = 0; i < count; ++i)
+    {
+        StreamedMesh* asset = &s->assets[finished[i]];
+        glWaitSync(asset->fence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(asset->fence);
+        asset->fence = NULL;
+        asset->state.store(ASSET_STATE_READY);
+    }
+    return count;
+}
+
+AssetState asset_streamer_state(const AssetStreamer* s, int id)
+{
+    return (AssetState)s->assets[id].state.load();
+}
+
+int asset_streamer_queued(AssetStreamer* s)
+{
+    std::lock_guard<std::mutex> lock(s->mutex);
+    return s->read_queue.count + s->load_queue.count + s->upload_queue.count;
+}
+
+bool asset_streamer_take_mesh(AssetStreamer* s, int id, GpuMesh* mesh, VertexFormat* format)
+{
+    StreamedMesh* asset = &s->assets[id];
+    if (asset->state.load() != ASSET_STATE_READY)
+        return false;
+    *mesh = asset->mesh;
+    *format = asset->format;
+    memset(&asset->mesh, 0, sizeof(asset->mesh));
+    asset->state.store(ASSET_STATE_TAKEN);
+    return true;
+}
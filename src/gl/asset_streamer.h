@@ -0,0 +1,152 @@
+#pragma once
+
+#include <glad/glad.h>
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include "asset/asset_package.h"
+#include "asset/mesh_file.h"
+#include "core/async_io.h"
+#include "gl/mesh.h"
+#include "gl/vertex_format.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Background loading of mesh files, so new content never stalls the frame.
+//
+// A request goes through three stages:
+//  1. the reader thread reads the file into memory through core/async_io.h
+//     (io_uring, overlapped I/O or its thread pool), in 1 MB chunks with many
+//     in flight, so no GL thread waits on the disk. A mesh needed on screen
+//     is read as ASYNC_IO_NOW and overtakes prefetched ones
+//     (asset_streamer_prefetch_mesh). A mesh from an asset package
+//     (asset/asset_package.h) goes to an unpack thread instead: its blocks are
+//     read in one sequential run out of the mapped package and decompressed
+//     into a buffer the upload copies from;
+//  2. the upload thread, which has its own GL context shared with the main
+//     window, fills the buffers from the mapping in chunks. It never uploads
+//     more than "bytes_per_frame" between two asset_streamer_begin_frame
+//     calls, so a large asset is spread over several frames;
+//  3. the upload is fenced (glFenceSync + glFlush), and the render thread's
+//     asset_streamer_begin_frame makes its own context wait for that fence
+//     with glWaitSync. That is a GPU-side wait, so the CPU never blocks.
+//
+// Buffers are shared between the contexts but VAOs aren't: the render thread
+// takes a finished mesh with asset_streamer_take_mesh and points its own VAO at
+// the buffers.
+//
+// Threading: asset_streamer_init and asset_streamer_destroy create and destroy
+// a window, so they must run on the main thread. Call destroy only after the
+// render side has stopped calling begin_frame. begin_frame and take_mesh
+// belong to the thread whose context renders. The upload thread makes no GL
+// calls until the first begin_frame, because GL is loaded on the render
+// thread.
+
+#define ASSET_STREAMER_MAX_ASSETS 64
+#define ASSET_STREAMER_MAX_IO_THREADS 8
+#define ASSET_STREAMER_CHUNK (1u << 20)     // bytes per read
+#define ASSET_STREAMER_IO_DEPTH 32          // reads in flight
+
+typedef enum AssetState
+{
+    ASSET_STATE_QUEUED,         // waiting for the reader or an unpack thread
+    ASSET_STATE_LOADING,        // being read / unpacked
+    ASSET_STATE_UPLOADING,      // waiting for, or being copied by, the upload thread
+    ASSET_STATE_UPLOADED,       // fenced, waiting for the render thread's glWaitSync
+    ASSET_STATE_READY,          // usable by the render thread
+    ASSET_STATE_TAKEN,          // handed over with asset_streamer_take_mesh
+    ASSET_STATE_FAILED
+} AssetState;
+
+typedef struct StreamedMesh
+{
+    char path[260];             // or the entry's name in "package"
+    const Package* package;     // NULL: "path" is a file
+    std::atomic<int> state;     // AssetState
+    AsyncIoPriority priority;
+    MeshFile file;              // read or unpacked, closed once uploaded
+    VertexFormat format;
+    GpuMesh mesh;
+    GLsync fence;
+
+    // The reader's progress through the file
+    int io_file;                // async_io_open's, -1 once closed
+    unsigned char* buffer;      // the whole file, adopted by "file" once read
+    uint64_t size;
+    uint32_t chunks;
+    uint32_t chunks_submitted;
+    uint32_t chunks_left;       // not yet completed
+    bool read_failed;
+} StreamedMesh;
+
+// Fixed-capacity FIFO of asset ids, guarded by AssetStreamer::mutex
+typedef struct AssetQueue
+{
+    int ids[ASSET_STREAMER_MAX_ASSETS];
+    int head;
+    int count;
+} AssetQueue;
+
+typedef struct AssetStreamer
+{
+    GLFWwindow* upload_window;  // hidden, only for its context
+    AsyncIo* io;
+    std::thread reader_thread;
+    std::thread io_threads[ASSET_STREAMER_MAX_IO_THREADS];  // unpack packaged meshes
+    int io_thread_count;
+    std::thread upload_thread;
+
+    std::mutex mutex;
+    std::condition_variable io_wake;        // a packaged mesh was queued, or stop
+    std::condition_variable upload_wake;    // an asset was read, the budget was refilled, or stop
+    AssetQueue read_queue;      // files for the reader, which is woken through async_io_wake
+    AssetQueue load_queue;      // packaged meshes for the unpack threads
+    AssetQueue upload_queue;
+    AssetQueue done_queue;      // fenced uploads for the next begin_frame
+    StreamedMesh assets[ASSET_STREAMER_MAX_ASSETS];
+    int asset_count;
+    size_t bytes_per_frame;     // 0 = unlimited
+    size_t budget;              // bytes the upload thread may still copy this frame
+    int node;                   // NUMA node the files are read into (the GPU's), -1 for wherever the reader runs
+    bool started;               // first begin_frame seen: GL is loaded
+    bool stop;
+    size_t bytes_uploaded;      // totals, for reporting
+    unsigned int frames_throttled;  // frames whose whole budget was used
+} AssetStreamer;
+
+// Creates the upload context (shared with "share"), starts the reader on "backend" and "io_threads" unpack threads
+// (also the size of async I/O's thread pool, when that's the backend). Logs and returns false if the shared context
+// can't be created - the caller then loads synchronously.
+bool asset_streamer_init(AssetStreamer* s, GLFWwindow* share, AsyncIoBackend backend, int io_threads,
+    size_t bytes_per_frame);
+void asset_streamer_destroy(AssetStreamer* s);
+
+// Queues a mesh file that's needed now. Returns its id, or -1 when the asset table is full.
+int asset_streamer_load_mesh(AssetStreamer* s, const char* path);
+// The same for one that will be needed soon: its reads wait for every ASYNC_IO_NOW read
+int asset_streamer_prefetch_mesh(AssetStreamer* s, const char* path);
+
+// The same for the mesh file "name" in "package", which must stay open until the streamer is destroyed
+int asset_streamer_load_packaged_mesh(AssetStreamer* s, const Package* package, const char* name);
+
+// Reads the files queued from now on into memory on NUMA node "node" (core/numa_memory.h), the one the GPU they're
+// uploaded to is on; -1, the default, for none
+void asset_streamer_set_node(AssetStreamer* s, int node);
+
+// Changes the upload budget from the next frame on, 0 for none (--console's upload-budget)
+void asset_streamer_set_budget(AssetStreamer* s, size_t bytes_per_frame);
+
+// Once per frame on the render thread, before drawing: refills the upload budget and makes this context wait
+// (on the GPU) for uploads that finished since the last call. Returns how many assets became ready.
+int asset_streamer_begin_frame(AssetStreamer* s);
+
+AssetState asset_streamer_state(const AssetStreamer* s, int id);
+
+// Assets waiting to be read, unpacked or uploaded (--metrics' queue depth)
+int asset_streamer_queued(AssetStreamer* s);
+
+// Hands a READY mesh's buffers and layout to the caller, who then owns (and deletes) them
+bool asset_streamer_take_mesh(AssetStreamer* s, int id, GpuMesh* mesh, VertexFormat* format);
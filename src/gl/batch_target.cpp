@@ -0,0 +1,168 @@
+#include "gl/batch_target.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void batch_target_init(BatchTarget* bt)
+{
+    memset(bt, 0, sizeof(*bt));
+    glGenBuffers(BATCH_TARGET_SLOTS, bt->buffers);
+    for (int i = 0; i < BATCH_TARGET_SLOTS; ++i)
+    {
+        gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, bt->buffers[i]);
+        gl_debug_label(GL_BUFFER, bt->buffers[i], "batch readback");
+    }
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+static void batch_target_release_arrays(BatchTarget* bt)
+{
+    gl_state_delete_framebuffers(BATCH_TARGET_LAYERS, bt->framebuffers);
+    gl_state_delete_textures(1, &bt->color);
+    gl_state_delete_textures(1, &bt->depth_stencil);
+    memset(bt->framebuffers, 0, sizeof(bt->framebuffers));
+    bt->color = bt->depth_stencil = 0;
+    bt->width = bt->height = bt->layers = 0;
+}
+
+void batch_target_destroy(BatchTarget* bt)
+{
+    for (int i = 0; i < BATCH_TARGET_SLOTS; ++i)
+        if (bt->fences[i])
+            glDeleteSync(bt->fences[i]);
+    batch_target_release_arrays(bt);
+    gl_state_delete_buffers(BATCH_TARGET_SLOTS, bt->buffers);
+    memset(bt, 0, sizeof(*bt));
+}
+
+bool batch_target_prepare(BatchTarget* bt, int width, int height, int layers)
+{
+    layers = layers < 1 ? 1 : layers > BATCH_TARGET_LAYERS ? BATCH_TARGET_LAYERS : layers;
+    if (width <= bt->width && height <= bt->height && layers <= bt->layers)
+        return true;
+
+    // Grown to cover this batch and the ones before; past the limit, just this one
+    int w = width > bt->width ? width : bt->width;
+    int h = height > bt->height ? height : bt->height;
+    int n = layers > bt->layers ? layers : bt->layers;
+    if ((int64_t)w * h * n > BATCH_TARGET_MAX_PIXELS)
+    {
+        w = width;
+        h = height;
+        n = layers;
+    }
+    batch_target_release_arrays(bt);
+    ++bt->resizes;
+
+    // Copies already queued read from the old textures; GL keeps them until those are done
+    glGenTextures(1, &bt->color);
+    gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, bt->color);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, w, h, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    gl_memory_texture(bt->color, GPU_MEMORY_RENDER_TARGETS, GL_RGBA8, w, h, n, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    gl_debug_label(GL_TEXTURE, bt->color, "batch color");
+    glGenTextures(1, &bt->depth_stencil);
+    gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, bt->depth_stencil);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH32F_STENCIL8, w, h, n, 0, GL_DEPTH_STENCIL,
+        GL_FLOAT_32_UNSIGNED_INT_24_8_REV, NULL);
+    gl_memory_texture(bt->depth_stencil, GPU_MEMORY_RENDER_TARGETS, GL_DEPTH32F_STENCIL8, w, h, n, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    gl_debug_label(GL_TEXTURE, bt->depth_stencil, "batch depth");
+    gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(n, bt->framebuffers);
+    GLenum status = GL_FRAMEBUFFER_COMPLETE;
+    for (int k = 0; k < n && status == GL_FRAMEBUFFER_COMPLETE; ++k)
+    {
+        gl_state_bind_framebuffer(GL_FRAMEBUFFER, bt->framebuffers[k]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, bt->color, 0, k);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, bt->depth_stencil, 0, k);
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    }
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "batch_target: %dx%d x %d layers framebuffer incomplete (0x%04X)\n", w, h, n, status);
+        batch_target_release_arrays(bt);
+        return false;
+    }
+    bt->width = w;
+    bt->height = h;
+    bt->layers = n;
+    return true;
+}
+
+void batch_target_bind(const BatchTarget* bt, int layer)
+{
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, bt->framebuffers[layer]);
+}
+
+int batch_target_read(BatchTarget* bt, int width, int height, int layers)
+{
+    if (!batch_target_ready(bt) || width > bt->width || height > bt->height || layers > bt->layers)
+        return -1;
+    const int slot = (bt->head + bt->count) % BATCH_TARGET_SLOTS;
+    const size_t layer_bytes = 4 * (size_t)width * height;
+    const size_t bytes = layer_bytes * layers;
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, bt->buffers[slot]);
+    if (bytes > bt->capacities[slot])
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)bytes, NULL, GL_STREAM_READ);
+        gl_memory_buffer(bt->buffers[slot], GPU_MEMORY_STAGING, bytes);
+        bt->capacities[slot] = bytes;
+    }
+
+    // Into the buffer, not client memory: each glReadPixels returns as soon as its copy is queued
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    for (int k = 0; k < layers; ++k)
+    {
+        gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, bt->framebuffers[k]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)(layer_bytes * k));
+    }
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+    bt->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    bt->slot_width[slot] = width;
+    bt->slot_height[slot] = height;
+    bt->slot_layers[slot] = layers;
+    ++bt->count;
+    return slot;
+}
+
+int batch_target_poll(BatchTarget* bt, BatchTargetReadback readback, void* user)
+{
+    int finished = 0;
+    while (bt->count)
+    {
+        const int slot = bt->head;
+        const GLenum status = glClientWaitSync(bt->fences[slot], 0, 0);    // asks, doesn't wait
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync(bt->fences[slot]);
+        bt->fences[slot] = NULL;
+        bt->head = (bt->head + 1) % BATCH_TARGET_SLOTS;
+        --bt->count;
+
+        const int width = bt->slot_width[slot], height = bt->slot_height[slot], layers = bt->slot_layers[slot];
+        const size_t layer_bytes = 4 * (size_t)width * height;
+        gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, bt->buffers[slot]);
+        const uint8_t* mapped = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+            (GLsizeiptr)(layer_bytes * layers), GL_MAP_READ_BIT);
+        for (int k = 0; k < layers; ++k)
+            readback(user, slot, k, mapped ? mapped + layer_bytes * k : NULL, width, height);
+        if (mapped)
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+        ++bt->batches;
+        bt->images += (uint64_t)layers;
+        ++finished;
+    }
+    return finished;
+}
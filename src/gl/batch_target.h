@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A batch of images drawn in one frame and read back without a stall, for
+// the render service's requests (core/render_service.h, --serve).
+//
+// The images are the layers of one GL_TEXTURE_2D_ARRAY, RGBA8 with a 32F/8
+// depth array beside it, and each layer has a framebuffer of its own: the
+// renderer binds layer k's, draws request k's camera into its bottom-left
+// "width" x "height" corner and goes on to the next. The arrays only grow
+// (unless growing them past BATCH_TARGET_MAX_PIXELS, when they're made the
+// batch's size exactly), so batches of different sizes reuse them.
+//
+// batch_target_read then copies every layer's corner into one pixel pack
+// buffer, one after another, and fences it, as gl/gpu_picker.h does for its
+// pixel: nothing waits. batch_target_poll maps the buffers whose fences have
+// passed, oldest first, usually a frame or two later, and hands each layer's
+// pixels to a callback. Up to BATCH_TARGET_SLOTS batches can be in flight;
+// the renderer takes no batch while they all are.
+
+#define BATCH_TARGET_LAYERS 16              // RENDER_SERVICE_MAX_BATCH
+#define BATCH_TARGET_SLOTS 3
+#define BATCH_TARGET_MAX_PIXELS (32 << 20)  // width x height x layers the arrays grow to before they're made exact
+
+typedef struct BatchTarget
+{
+    GLuint color;               // GL_TEXTURE_2D_ARRAY, RGBA8
+    GLuint depth_stencil;       // GL_TEXTURE_2D_ARRAY, GL_DEPTH32F_STENCIL8
+    GLuint framebuffers[BATCH_TARGET_LAYERS];   // one a layer
+    int width, height, layers;  // the arrays' size; 0 until the first batch
+    GLuint buffers[BATCH_TARGET_SLOTS];     // pixel pack buffers
+    size_t capacities[BATCH_TARGET_SLOTS];  // their sizes in bytes
+    GLsync fences[BATCH_TARGET_SLOTS];      // after each one's copies; NULL for a free slot
+    int slot_width[BATCH_TARGET_SLOTS], slot_height[BATCH_TARGET_SLOTS], slot_layers[BATCH_TARGET_SLOTS];
+    int head;                   // the oldest slot in flight
+    int count;                  // slots in flight
+    uint64_t batches;           // read back, over the run
+    uint64_t images;
+    uint64_t resizes;           // times the arrays were made again
+} BatchTarget;
+
+// Needs a current context. Allocates nothing until the first batch.
+void batch_target_init(BatchTarget* bt);
+void batch_target_destroy(BatchTarget* bt);
+
+// Whether a batch can be drawn now: a slot is free for reading it back
+static inline bool batch_target_ready(const BatchTarget* bt)
+{
+    return bt->count < BATCH_TARGET_SLOTS;
+}
+
+// Makes room for "layers" (at most BATCH_TARGET_LAYERS) images of "width" x "height". Returns false (and logs the
+// status) when the framebuffers aren't complete at that size.
+bool batch_target_prepare(BatchTarget* bt, int width, int height, int layers);
+
+// Binds layer "layer"'s framebuffer for drawing; the caller sets the viewport to the corner
+void batch_target_bind(const BatchTarget* bt, int layer);
+
+// Queues the copy of the first "layers" layers' "width" x "height" corners (what was prepared) and fences it.
+// Returns the slot it went to, -1 when every slot is in flight. Leaves GL_PIXEL_PACK_BUFFER unbound.
+int batch_target_read(BatchTarget* bt, int width, int height, int layers);
+
+// For every layer of a slot read back: "pixels" is the layer's RGBA8 corner, bottom row first, valid until the
+// callback returns
+typedef void (*BatchTargetReadback)(void* user, int slot, int layer, const uint8_t* pixels, int width, int height);
+
+// Hands the slots whose copies are done to "readback", oldest first, and frees them. Never waits; returns how many
+// slots it finished. A slot whose buffer won't map is finished with NULL pixels for each layer.
+int batch_target_poll(BatchTarget* bt, BatchTargetReadback readback, void* user);
@@ -0,0 +1,255 @@
+#include "gl/cluster_culling.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// The shaders' uniforms, at the locations their GLSL gives them rather than looked up by name
+enum
+{
+    PREPARE_LOCATION_COMMAND = 0,
+    PREPARE_LOCATION_FRAME_START = 1
+};
+
+enum
+{
+    CLUSTER_LOCATION_PLANES = 0,            // 6 of them
+    CLUSTER_LOCATION_CULL = 6,
+    CLUSTER_LOCATION_EYE = 7,
+    CLUSTER_LOCATION_MAX_DRAWS = 8
+};
+
+// Reads the object cull's command for the phase (binding 2, its command_buffer) and sizes the meshlet cull:
+// an instance per work group, rows of at most 65535 groups. The first phase of the frame clears the totals.
+static const char* prepare_shader_text =
+"#version 430\n"
+"layout(local_size_x = 1) in;\n"
+"struct Command { uint count; uint instanceCount; uint firstIndex; int baseVertex; uint baseInstance; };\n"
+"layout(std430, binding = 2) readonly buffer Objects { Command objectCommands[2]; uint objectDrawCounts[2]; };\n"
+"layout(std430, binding = 3) buffer Clusters { uint drawCount; uint meshlets; uint triangles; uint dropped; Command commands[]; };\n"
+"layout(std430, binding = 4) writeonly buffer Dispatch { uint groups[3]; uint firstInstance; uint instanceCount; };\n"
+"layout(location = 0) uniform int command;\n"
+"layout(location = 1) uniform bool frameStart;\n"
+"void main()\n"
+"{\n"
+"    uint n = objectCommands[command].instanceCount;\n"
+"    groups[0] = min(n, 65535u);\n"
+"    groups[1] = (n + 65534u) / 65535u;\n"
+"    groups[2] = 1u;\n"
+"    firstInstance = objectCommands[command].baseInstance;\n"
+"    instanceCount = n;\n"
+"    drawCount = 0u;\n"
+"    if (frameStart)\n"
+"    {\n"
+"        meshlets = 0u;\n"
+"        triangles = 0u;\n"
+"        dropped = 0u;\n"
+"    }\n"
+"}\n";
+
+// Bounds are in the mesh's space and go through the instance's matrix (a rotation and uniform scale, std430
+// mat3x4 as the object cull writes it). The cone test is meshlet_cone_culled's, with the eye from
+// meshlet_view_eye: "toward" points from the sphere's centre back to the eye.
+static const char* cull_shader_text =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+"struct Command { uint count; uint instanceCount; uint firstIndex; int baseVertex; uint baseInstance; };\n"
+"struct Meshlet { vec4 sphere; vec4 cone; uvec4 range; };\n"     // centre, radius; axis, cutoff; first index, index count
+"layout(std430, binding = 0) readonly buffer Meshlets { Meshlet meshlets[]; };\n"
+"layout(std430, binding = 1) readonly buffer Instances { mat3x4 instances[]; };\n"
+"layout(std430, binding = 3) buffer Clusters { uint drawCount; uint meshletsDrawn; uint triangles; uint dropped; Command commands[]; };\n"
+"layout(std430, binding = 4) readonly buffer Dispatch { uint groups[3]; uint firstInstance; uint instanceCount; };\n"
+"layout(location = 0) uniform vec4 planes[6];\n"
+"layout(location = 6) uniform bool cull;\n"
+"layout(location = 7) uniform vec4 eye;\n"
+"layout(location = 8) uniform uint maxDraws;\n"
+"void main()\n"
+"{\n"
+"    uint instance = gl_WorkGroupID.y * 65535u + gl_WorkGroupID.x;\n"
+"    if (instance >= instanceCount)\n"
+"        return;\n"
+"    uint slot = firstInstance + instance;\n"
+"    mat3x4 model = instances[slot];\n"
+"    float scale = length(model[0].xyz);\n"
+"    for (uint k = gl_LocalInvocationID.x; k < uint(meshlets.length()); k += gl_WorkGroupSize.x)\n"
+"    {\n"
+"        Meshlet m = meshlets[k];\n"
+"        vec3 centre = vec4(m.sphere.xyz, 1.0) * model;\n"
+"        float radius = m.sphere.w * scale;\n"
+"        bool visible = true;\n"
+"        if (cull)\n"
+"        {\n"
+"            for (int p = 0; p < 6; ++p)\n"
+"                visible = visible && dot(planes[p].xyz, centre) + planes[p].w >= -radius;\n"
+"        }\n"
+"        if (visible && m.cone.w < 1.0)\n"
+"        {\n"
+"            vec3 axis = normalize(vec4(m.cone.xyz, 0.0) * model);\n"
+"            vec3 toward = eye.xyz - eye.w * centre;\n"
+"            visible = -dot(toward, axis) < m.cone.w * length(toward) + radius * abs(eye.w);\n"
+"        }\n"
+"        if (!visible)\n"
+"            continue;\n"
+"        uint draw = atomicAdd(drawCount, 1u);\n"
+"        if (draw < maxDraws)\n"
+"        {\n"
+"            commands[draw] = Command(m.range.y, 1u, m.range.x, 0, slot);\n"
+"            atomicAdd(meshletsDrawn, 1u);\n"
+"            atomicAdd(triangles, m.range.y / 3u);\n"
+"        }\n"
+"        else\n"
+"            atomicAdd(dropped, 1u);\n"
+"    }\n"
+"}\n";
+
+// command_buffer contents: the draw count glMultiDrawElementsIndirectCount reads, the frame's totals, the draws
+#define COMMANDS_OFFSET (4 * sizeof(GLuint))
+
+typedef struct ClusterMeshlet
+{
+    float sphere[4];
+    float cone[4];
+    GLuint range[4];
+} ClusterMeshlet;
+
+static GLuint build_program(const char* text, const char* label)
+{
+    GLuint shader = shader_compile(GL_COMPUTE_SHADER, text);
+    const GLuint program = program_link(&shader, 1, false);
+    if (!program)
+        fprintf(stderr, "cluster_culling: can't build the %s compute shader\n", label);
+    else
+        gl_debug_label(GL_PROGRAM, program, label);
+    return program;
+}
+
+bool cluster_culling_init(ClusterCulling* c, const Meshlet* meshlets, size_t meshlet_count, uint32_t max_instances)
+{
+    c->prepare_program = c->program = 0;
+    c->meshlet_buffer = c->dispatch_buffer = c->command_buffer = 0;
+    c->meshlet_count = (uint32_t)meshlet_count;
+    const uint64_t max_draws = (uint64_t)meshlet_count * max_instances;
+    c->max_draws = max_draws < CLUSTER_CULLING_MAX_DRAWS ? (uint32_t)max_draws : CLUSTER_CULLING_MAX_DRAWS;
+    if (!gl_ext.ARB_indirect_parameters)
+    {
+        fprintf(stderr, "cluster_culling: needs ARB_indirect_parameters for its draw count\n");
+        return false;
+    }
+    if (!meshlet_count)
+        return false;
+
+    c->prepare_program = build_program(prepare_shader_text, "meshlet cull prepare");
+    c->program = build_program(cull_shader_text, "meshlet cull");
+    if (!c->prepare_program || !c->program)
+        return false;
+
+    ClusterMeshlet* packed = (ClusterMeshlet*)malloc(sizeof(ClusterMeshlet) * meshlet_count);
+    if (!packed)
+    {
+        fprintf(stderr, "cluster_culling: out of memory for %zu meshlets\n", meshlet_count);
+        return false;
+    }
+    for (size_t k = 0; k < meshlet_count; ++k)
+    {
+        const Meshlet* m = &meshlets[k];
+        ClusterMeshlet* p = &packed[k];
+        for (int i = 0; i < 3; ++i)
+        {
+            p->sphere[i] = m->center[i];
+            p->cone[i] = m->cone_axis[i];
+        }
+        p->sphere[3] = m->radius;
+        p->cone[3] = m->cone_cutoff;
+        p->range[0] = m->first_index;
+        p->range[1] = 3 * m->triangle_count;
+        p->range[2] = p->range[3] = 0;
+    }
+    c->meshlet_buffer = gl_dsa_create_buffer(sizeof(ClusterMeshlet) * meshlet_count, packed, GL_STATIC_DRAW);
+    gl_memory_buffer(c->meshlet_buffer, GPU_MEMORY_STORAGE, sizeof(ClusterMeshlet) * meshlet_count);
+    free(packed);
+    gl_debug_label(GL_BUFFER, c->meshlet_buffer, "meshlets");
+
+    // Written and read by the GPU only; the totals start at zero for a report before the first frame
+    c->dispatch_buffer = gl_dsa_create_buffer(5 * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(c->dispatch_buffer, GPU_MEMORY_STORAGE, 5 * sizeof(GLuint));
+    gl_debug_label(GL_BUFFER, c->dispatch_buffer, "meshlet cull dispatch");
+    c->command_buffer = gl_dsa_create_buffer(COMMANDS_OFFSET + sizeof(DrawElementsIndirectCommand) * c->max_draws, NULL,
+        GL_DYNAMIC_COPY);
+    gl_memory_buffer(c->command_buffer, GPU_MEMORY_STORAGE, COMMANDS_OFFSET + sizeof(DrawElementsIndirectCommand) * c->max_draws);
+    const GLuint zero = 0;
+    gl_dsa_clear_buffer(c->command_buffer, GL_R32UI, 0, COMMANDS_OFFSET, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    gl_debug_label(GL_BUFFER, c->command_buffer, "meshlet commands");
+    return true;
+}
+
+void cluster_culling_destroy(ClusterCulling* c)
+{
+    gl_state_delete_buffers(1, &c->command_buffer);
+    gl_state_delete_buffers(1, &c->dispatch_buffer);
+    gl_state_delete_buffers(1, &c->meshlet_buffer);
+    if (c->program)
+        glDeleteProgram(c->program);
+    if (c->prepare_program)
+        glDeleteProgram(c->prepare_program);
+    c->prepare_program = c->program = 0;
+    c->meshlet_buffer = c->dispatch_buffer = c->command_buffer = 0;
+}
+
+void cluster_culling_dispatch(ClusterCulling* c, const GpuCulling* objects, const Frustum* frustum,
+    mat4x4 const view_projection, GpuCullPhase phase)
+{
+    gl_state_use_program(c->prepare_program);
+    glUniform1i(PREPARE_LOCATION_COMMAND, phase == GPU_CULL_LATE ? 1 : 0);
+    glUniform1i(PREPARE_LOCATION_FRAME_START, phase != GPU_CULL_LATE);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 2, objects->command_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 3, c->command_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 4, c->dispatch_buffer);
+    glDispatchCompute(1, 1, 1);
+    draw_counters_dispatch();
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);    // the group counts, then the reset
+
+    vec4 eye;
+    meshlet_view_eye(eye, view_projection);
+    gl_state_use_program(c->program);
+    glUniform1i(CLUSTER_LOCATION_CULL, frustum != NULL);
+    if (frustum)
+        glUniform4fv(CLUSTER_LOCATION_PLANES, 6, &frustum->planes[0][0]);
+    glUniform4fv(CLUSTER_LOCATION_EYE, 1, eye);
+    glUniform1ui(CLUSTER_LOCATION_MAX_DRAWS, c->max_draws);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, c->meshlet_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, objects->instance_buffer);
+    gl_state_bind_buffer(GL_DISPATCH_INDIRECT_BUFFER, c->dispatch_buffer);
+    glDispatchComputeIndirect(0);
+    draw_counters_dispatch();
+    gl_state_bind_buffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    // The draw sources its commands and their count from command_buffer
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+void cluster_culling_draw(const ClusterCulling* c, const GpuMesh* mesh)
+{
+    gl_state_enable(GL_CULL_FACE, true);
+    gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, c->command_buffer);
+    gl_state_bind_buffer(GL_PARAMETER_BUFFER_ARB, c->command_buffer);
+    gl_ext.MultiDrawElementsIndirectCount(GL_TRIANGLES, mesh->index_type, (const void*)COMMANDS_OFFSET, 0,
+        (GLsizei)c->max_draws, sizeof(DrawElementsIndirectCommand));
+    draw_counters_indirect((GLsizei)c->max_draws);
+    gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    gl_state_enable(GL_CULL_FACE, false);
+}
+
+bool cluster_culling_read_stats(const ClusterCulling* c, GpuReadback* rb, ClusterCullingStats* stats,
+    GpuReadbackFunction done, void* user)
+{
+    // The counts after the draw count at the head of command_buffer are the stats, field for field
+    static_assert(sizeof(ClusterCullingStats) == 3 * sizeof(GLuint), "laid out as the counts");
+    return gpu_readback_buffer(rb, c->command_buffer, sizeof(GLuint), sizeof(*stats), stats, done, user);
+}
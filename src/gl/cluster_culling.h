@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "asset/meshlet.h"
+#include "gl/gpu_culling.h"
+#include "gl/mesh.h"
+#include "scene/frustum.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Meshlet culling on top of GPU-driven submission (needs 4.3 and
+// ARB_indirect_parameters): after each phase of the object cull, a compute
+// pass takes every instance it kept and tests each of the mesh's meshlets
+// (asset/meshlet.h) on its own - the bounding sphere against the frustum, the
+// normal cone against the eye. Each surviving (instance, meshlet) pair is
+// appended as a DrawElementsIndirectCommand of just that meshlet's index
+// range, for that one instance, and a single glMultiDrawElementsIndirectCount
+// draws the lot. The mesh's level 0 indices are kept in meshlet order, so
+// every range is contiguous and the index buffer doesn't change per frame.
+//
+// A work group per instance, a thread per meshlet. The pass is sized on the
+// GPU: a one-thread dispatch reads the object cull's instance count and
+// writes the group counts glDispatchComputeIndirect takes.
+//
+// The cone test drops what back-face culling would, so the draws enable
+// GL_CULL_FACE: the mesh's front faces must wind counterclockwise.
+
+#define CLUSTER_CULLING_GROUP_SIZE 64   // meshlets tested at once per instance (local_size_x in the shader)
+#define CLUSTER_CULLING_MAX_DRAWS (1u << 20)    // meshlet draws a phase may append; the rest are dropped and counted
+
+typedef struct ClusterCulling
+{
+    GLuint prepare_program;     // one invocation: sizes the cull for the instances a phase kept
+    GLuint program;             // the meshlet cull
+    GLuint meshlet_buffer;      // SSBO: sphere, cone and index range per meshlet
+    GLuint dispatch_buffer;     // the cull's group counts, then the phase's first instance and instance count
+    GLuint command_buffer;      // this phase's draw count, the frame's totals, then the meshlet draws
+    uint32_t meshlet_count;
+    uint32_t max_draws;
+} ClusterCulling;
+
+// What the meshlet cull kept over a frame
+typedef struct ClusterCullingStats
+{
+    uint32_t meshlets;          // meshlet draws
+    uint32_t triangles;         // in them
+    uint32_t dropped;           // meshlet draws past max_draws, left out
+} ClusterCullingStats;
+
+// Uploads the meshlets of a mesh drawn up to "max_instances" times and builds the compute programs. Logs and returns
+// false without ARB_indirect_parameters or when a program fails to build.
+bool cluster_culling_init(ClusterCulling* c, const Meshlet* meshlets, size_t meshlet_count, uint32_t max_instances);
+void cluster_culling_destroy(ClusterCulling* c);
+
+// Culls the meshlets of the instances "objects" kept in "phase" (dispatched just before), against "frustum" (NULL:
+// everything is inside) and the eye of "view_projection"
+void cluster_culling_dispatch(ClusterCulling* c, const GpuCulling* objects, const Frustum* frustum,
+    mat4x4 const view_projection, GpuCullPhase phase);
+
+// Draws the meshlets the last dispatch kept (VAO with the instance attributes on the object cull's buffers bound by
+// the caller)
+void cluster_culling_draw(const ClusterCulling* c, const GpuMesh* mesh);
+
+// Queues a readback of this frame's totals into "stats"; "done" and "user" as gpu_readback_buffer takes them
+bool cluster_culling_read_stats(const ClusterCulling* c, GpuReadback* rb, ClusterCullingStats* stats,
+    GpuReadbackFunction done, void* user);
@@ -0,0 +1,37 @@
+#include "gl/draw_counters.h"
+
+#include "gl/gl_state.h"
+
+thread_local DrawCounters draw_counters;
+
+void draw_counters_read(DrawCounters* out)
+{
+    *out = draw_counters;
+    out->state_changes = 0;
+    for (int i = 0; i < GL_STATE_CALL_COUNT; ++i)
+        out->state_changes += gl_state.issued[i];
+}
+
+void draw_counters_difference(DrawCounters* out, const DrawCounters* begin, const DrawCounters* end)
+{
+    out->draws = end->draws - begin->draws;
+    out->indirect_draws = end->indirect_draws - begin->indirect_draws;
+    out->instances = end->instances - begin->instances;
+    out->triangles = end->triangles - begin->triangles;
+    out->dispatches = end->dispatches - begin->dispatches;
+    out->calls = end->calls - begin->calls;
+    out->upload_bytes = end->upload_bytes - begin->upload_bytes;
+    out->state_changes = end->state_changes - begin->state_changes;
+}
+
+void draw_counters_add(DrawCounters* out, const DrawCounters* add)
+{
+    out->draws += add->draws;
+    out->indirect_draws += add->indirect_draws;
+    out->instances += add->instances;
+    out->triangles += add->triangles;
+    out->dispatches += add->dispatches;
+    out->calls += add->calls;
+    out->upload_bytes += add->upload_bytes;
+    out->state_changes += add->state_changes;
+}
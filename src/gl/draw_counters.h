@@ -0,0 +1,102 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// What the CPU submitted to GL, counted where it's submitted: draw calls with
+// their instances and triangles, compute dispatches, and buffer bytes
+// uploaded. gl/gpu_profiler.h reads the totals at every scope's push and pop,
+// so each pass gets its own share, next to the state calls gl/gl_state.h let
+// through in it.
+//
+// Every draw and dispatch in the renderer goes through one of the calls below
+// right where it's issued. Indirect draws are counted as draws, but their
+// instances and triangles are written by the GPU and only show up in the
+// pipeline statistics. Uploads are what the CPU hands to the driver: the
+// data of glBuffer(Sub)Data and their gl/gl_dsa.h wrappers, and the stream
+// buffer allocations written through their mappings, at the size reserved
+// (the overlay reserves room for all its quads). Texture uploads aren't
+// counted here.
+//
+// Like gl_state, the counters are per thread, for the thread whose context is
+// current; they only ever grow.
+//
+// On a frame gl/draw_sampler.h samples, the same calls also put a timestamp
+// query after each draw and dispatch; on the others that's one check.
+
+typedef struct DrawCounters
+{
+    uint64_t draws;             // draw calls, direct and indirect
+    uint64_t indirect_draws;    // of those, indirect: commands read from a buffer
+    uint64_t instances;         // of the direct draws
+    uint64_t triangles;         // of the direct draws, every instance's
+    uint64_t dispatches;        // compute dispatches, direct and indirect
+    uint64_t calls;             // the GL calls issuing the draws and dispatches: a multi-draw is one
+    uint64_t upload_bytes;
+    uint64_t state_changes;     // gl_state calls that reached GL: filled by draw_counters_read only
+} DrawCounters;
+
+extern thread_local DrawCounters draw_counters;
+
+// The sampler recording this thread's frame (gl/draw_sampler.h), NULL between its samples
+extern thread_local struct DrawSampler* draw_sampler;
+
+typedef enum DrawSampleKind
+{
+    DRAW_SAMPLE_DIRECT,
+    DRAW_SAMPLE_INDIRECT,   // "count" is its commands
+    DRAW_SAMPLE_DISPATCH,
+} DrawSampleKind;
+
+// Times the draw or dispatch just issued
+void draw_sampler_draw(struct DrawSampler* s, DrawSampleKind kind, GLenum mode, GLsizei count, GLsizei instances);
+
+// A direct draw of "count" vertices (or indices) in "mode", "instances" times
+static inline void draw_counters_draw(GLenum mode, GLsizei count, GLsizei instances)
+{
+    uint64_t triangles = 0;
+    if (mode == GL_TRIANGLES)
+        triangles = (uint64_t)count / 3;
+    else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2)
+        triangles = (uint64_t)count - 2;
+    ++draw_counters.draws;
+    ++draw_counters.calls;
+    draw_counters.instances += (uint64_t)instances;
+    draw_counters.triangles += triangles * (uint64_t)instances;
+    if (draw_sampler)
+        draw_sampler_draw(draw_sampler, DRAW_SAMPLE_DIRECT, mode, count, instances);
+}
+
+// "commands" indirect draws (a multi-draw's count; its maximum for a count read from a buffer)
+static inline void draw_counters_indirect(GLsizei commands)
+{
+    draw_counters.draws += (uint64_t)commands;
+    draw_counters.indirect_draws += (uint64_t)commands;
+    ++draw_counters.calls;
+    if (draw_sampler)
+        draw_sampler_draw(draw_sampler, DRAW_SAMPLE_INDIRECT, GL_NONE, commands, 0);
+}
+
+static inline void draw_counters_dispatch(void)
+{
+    ++draw_counters.dispatches;
+    ++draw_counters.calls;
+    if (draw_sampler)
+        draw_sampler_draw(draw_sampler, DRAW_SAMPLE_DISPATCH, GL_NONE, 0, 0);
+}
+
+static inline void draw_counters_upload(size_t bytes)
+{
+    draw_counters.upload_bytes += bytes;
+}
+
+// This thread's totals so far, state changes included
+void draw_counters_read(DrawCounters* out);
+
+// "end" - "begin", field by field
+void draw_counters_difference(DrawCounters* out, const DrawCounters* begin, const DrawCounters* end);
+
+// "out" += "add", field by field
+void draw_counters_add(DrawCounters* out, const DrawCounters* add);
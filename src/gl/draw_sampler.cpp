@@ -0,0 +1,225 @@
+#include "gl/draw_sampler.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+thread_local DrawSampler* draw_sampler;
+
+bool draw_sampler_init(DrawSampler* s, unsigned int interval, FILE* out)
+{
+    memset(s, 0, sizeof(*s));
+    if (!glQueryCounter || !glGetQueryObjectui64v)
+        return false;
+    s->interval = interval ? interval : 1;
+    s->out = out;
+    s->queries = (GLuint*)malloc(sizeof(GLuint) * DRAW_SAMPLER_MAX_QUERIES);
+    s->timestamps = (GLuint64*)malloc(sizeof(GLuint64) * DRAW_SAMPLER_MAX_QUERIES);
+    s->samples = (DrawSample*)malloc(sizeof(DrawSample) * DRAW_SAMPLER_MAX_QUERIES);
+    if (!s->queries || !s->timestamps || !s->samples)
+    {
+        free(s->queries);
+        free(s->timestamps);
+        free(s->samples);
+        memset(s, 0, sizeof(*s));
+        return false;
+    }
+    glGenQueries(DRAW_SAMPLER_MAX_QUERIES, s->queries);
+    return true;
+}
+
+void draw_sampler_destroy(DrawSampler* s)
+{
+    if (!s->queries)
+        return;
+    if (draw_sampler == s)
+        draw_sampler = NULL;
+    glDeleteQueries(DRAW_SAMPLER_MAX_QUERIES, s->queries);
+    free(s->queries);
+    free(s->timestamps);
+    free(s->samples);
+    memset(s, 0, sizeof(*s));
+}
+
+// A timestamp after everything issued so far; false once the pool is used up
+static bool mark(DrawSampler* s)
+{
+    if (s->query_count == DRAW_SAMPLER_MAX_QUERIES)
+        return false;
+    glQueryCounter(s->queries[s->query_count++], GL_TIMESTAMP);
+    return true;
+}
+
+void draw_sampler_draw(DrawSampler* s, DrawSampleKind kind, GLenum mode, GLsizei count, GLsizei instances)
+{
+    if (!mark(s))
+    {
+        ++s->unsampled;
+        return;
+    }
+    DrawSample* sample = &s->samples[s->sample_count++];
+    const int top = s->depth < DRAW_SAMPLER_MAX_DEPTH ? s->depth : DRAW_SAMPLER_MAX_DEPTH;
+    sample->pass = top ? s->stack[top - 1] : NULL;
+    sample->program = gl_state.program;
+    sample->program_pipeline = gl_state.program ? 0 : gl_state.program_pipeline;
+    sample->vertex_array = gl_state.vertex_array;
+    sample->kind = kind;
+    sample->mode = mode;
+    sample->count = count > 0 ? (uint32_t)count : 0;
+    sample->instances = instances > 0 ? (uint32_t)instances : 0;
+    sample->query = s->query_count - 1;
+    sample->gpu_ms = 0.0;
+}
+
+// Costliest first; ties in the order they were drawn
+static int compare_samples(const void* a, const void* b)
+{
+    const DrawSample* x = (const DrawSample*)a;
+    const DrawSample* y = (const DrawSample*)b;
+    if (x->gpu_ms != y->gpu_ms)
+        return x->gpu_ms > y->gpu_ms ? -1 : 1;
+    return x->query < y->query ? -1 : x->query > y->query;
+}
+
+// "<name>" and its label, when it has one
+static const char* describe(char* text, size_t size, GLenum identifier, GLuint name)
+{
+    char label[48] = "";
+    GLsizei length = 0;
+    if (name && gl_ext.GetObjectLabel)
+        gl_ext.GetObjectLabel(identifier, name, sizeof(label), &length, label);
+    if (length)
+        snprintf(text, size, "%u \"%s\"", name, label);
+    else
+        snprintf(text, size, "%u", name);
+    return text;
+}
+
+static const char* mode_name(const DrawSample* sample)
+{
+    if (sample->kind != DRAW_SAMPLE_DIRECT)
+        return sample->kind == DRAW_SAMPLE_INDIRECT ? "indirect" : "dispatch";
+    switch (sample->mode)
+    {
+    case GL_POINTS: return "points";
+    case GL_LINES: return "lines";
+    case GL_TRIANGLES: return "triangles";
+    case GL_TRIANGLE_STRIP: return "strip";
+    case GL_TRIANGLE_FAN: return "fan";
+    case GL_PATCHES: return "patches";
+    default: return "other";
+    }
+}
+
+static void report(DrawSampler* s)
+{
+    FILE* out = s->out;
+    const GLuint64* ts = s->timestamps;
+    const uint32_t n = s->sample_count;
+    double total = 0.0;
+    for (uint32_t k = 0; k < n; ++k)
+    {
+        DrawSample* sample = &s->samples[k];
+        sample->gpu_ms = ts[sample->query] > ts[sample->query - 1]
+            ? (double)(ts[sample->query] - ts[sample->query - 1]) * 1e-6 : 0.0;
+        total += sample->gpu_ms;
+    }
+    const double span = ts[s->query_count - 1] > ts[0] ? (double)(ts[s->query_count - 1] - ts[0]) * 1e-6 : 0.0;
+    qsort(s->samples, n, sizeof(DrawSample), compare_samples);
+
+    fprintf(out, "draw timings, frame %u: %u draws and dispatches, %.3f ms of the frame's %.3f ms on the GPU",
+        s->sampled_frame, n, total, span);
+    if (s->unsampled)
+        fprintf(out, " (%u more past the %d timestamps)", s->unsampled, DRAW_SAMPLER_MAX_QUERIES);
+    fprintf(out, "\n  %8s %6s  %-16s %-9s %-26s %-22s %9s %9s\n", "gpu ms", "%", "pass", "draw", "program",
+        "vertex array", "count", "instances");
+    for (uint32_t k = 0; k < n && k < DRAW_SAMPLER_TOP; ++k)
+    {
+        const DrawSample* sample = &s->samples[k];
+        char pipeline[64], program[80], vertex_array[64];
+        if (sample->program_pipeline)
+            snprintf(program, sizeof(program), "pipeline %s",
+                describe(pipeline, sizeof(pipeline), GL_PROGRAM_PIPELINE, sample->program_pipeline));
+        else
+            describe(program, sizeof(program), GL_PROGRAM, sample->program);
+        describe(vertex_array, sizeof(vertex_array), GL_VERTEX_ARRAY, sample->vertex_array);
+        fprintf(out, "  %8.3f %6.2f  %-16s %-9s %-26s %-22s %9u %9u\n", sample->gpu_ms,
+            span > 0.0 ? 100.0 * sample->gpu_ms / span : 0.0, sample->pass ? sample->pass : "-", mode_name(sample),
+            program, vertex_array, sample->count, sample->instances);
+    }
+    fflush(out);
+    ++s->reports;
+}
+
+// Reads back the sample in flight once its last timestamp is in; timestamps complete in order
+static void collect(DrawSampler* s, bool wait)
+{
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(s->queries[s->query_count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available && !wait)
+        return;
+    for (uint32_t q = 0; q < s->query_count; ++q)
+        glGetQueryObjectui64v(s->queries[q], GL_QUERY_RESULT, &s->timestamps[q]);
+    s->pending = false;
+    report(s);
+}
+
+void draw_sampler_begin_frame(DrawSampler* s)
+{
+    if (s->pending)
+        collect(s, false);
+    const bool nth = ++s->frame_index % s->interval == 0;
+    s->deferred += nth && s->pending;
+    s->due = s->due || nth;
+    if (!s->due || s->pending)
+        return;
+    s->due = false;
+    s->recording = true;
+    s->sampled_frame = s->frame_index;
+    s->query_count = 0;
+    s->sample_count = 0;
+    s->unsampled = 0;
+    s->depth = 0;
+    mark(s);        // the start of the first draw
+    draw_sampler = s;
+}
+
+void draw_sampler_end_frame(DrawSampler* s)
+{
+    if (!s->recording)
+        return;
+    draw_sampler = NULL;
+    s->recording = false;
+    s->pending = s->sample_count > 0;
+}
+
+void draw_sampler_push(DrawSampler* s, const char* name)
+{
+    if (!s->recording)
+        return;
+    if (s->depth < DRAW_SAMPLER_MAX_DEPTH)
+        s->stack[s->depth] = name;
+    ++s->depth;
+    mark(s);
+}
+
+void draw_sampler_pop(DrawSampler* s)
+{
+    if (!s->recording || s->depth == 0)
+        return;
+    mark(s);
+    --s->depth;
+}
+
+void draw_sampler_flush(DrawSampler* s)
+{
+    if (s->pending)
+        collect(s, true);
+}
+
+void draw_sampler_print(const DrawSampler* s, FILE* out)
+{
+    fprintf(out, "draw timings: every %u frames, %u reports, %u samples put off for the last to come in\n",
+        s->interval, s->reports, s->deferred);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/draw_counters.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Every Nth frame timed draw by draw (--draw-timings N): a GL_TIMESTAMP
+// query after each draw and dispatch of that frame only, so the frames in
+// between pay nothing but a thread_local check per draw. A draw's time is
+// from the timestamp before it to its own: the one after the draw or
+// dispatch ahead of it, or the one gl/gpu_profiler.h's push or pop makes
+// this sampler take at each pass boundary, so a pass's clears and copies
+// don't land on the last draw of the pass before. What the pass does
+// between two draws (a clear, a blit) still counts for the draw after it.
+// The GPU overlaps the work of neighbouring draws, so the times are what
+// each added to the frame rather than what it would cost alone.
+//
+// Each draw keeps what gl/gl_state.h had bound at it - the program (or
+// pipeline) and the vertex array - with its mode, vertex or index count
+// and instances, and the innermost profiler pass. A vertex array and count
+// together stand for the mesh: the mesh heap (gl/mesh_heap.h) shares one
+// vertex array among all its meshes. Indirect draws give their commands
+// instead: the GPU wrote their instances.
+//
+// The frame's results are read some frames later, without waiting, and the
+// DRAW_SAMPLER_TOP costliest draws written out with their programs' and
+// vertex arrays' debug labels where they have them (debug builds,
+// gl/gl_debug.h). A frame due while the last is still in flight is put off
+// until it's in. A frame with more than DRAW_SAMPLER_MAX_QUERIES draws and
+// boundaries times those that fit and counts the rest.
+
+#define DRAW_SAMPLER_MAX_QUERIES 16384  // timestamps a sampled frame: its draws and dispatches, and pass boundaries
+#define DRAW_SAMPLER_MAX_DEPTH 16
+#define DRAW_SAMPLER_TOP 20             // draws in a report
+
+typedef struct DrawSample
+{
+    const char* pass;       // the innermost profiler scope, borrowed; NULL outside every scope
+    GLuint program;         // bound at the draw; 0 when a program pipeline is used instead
+    GLuint program_pipeline;
+    GLuint vertex_array;
+    DrawSampleKind kind;
+    GLenum mode;            // a direct draw's primitive mode
+    uint32_t count;         // vertices or indices; commands, for an indirect draw
+    uint32_t instances;     // 0 for an indirect draw or a dispatch
+    uint32_t query;         // the timestamp after it; the one before it is its start
+    double gpu_ms;          // filled in when read back
+} DrawSample;
+
+typedef struct DrawSampler
+{
+    unsigned int interval;  // frames between samples
+    FILE* out;
+    GLuint* queries;        // [DRAW_SAMPLER_MAX_QUERIES]
+    GLuint64* timestamps;   // [DRAW_SAMPLER_MAX_QUERIES]: the results, when read
+    DrawSample* samples;    // [DRAW_SAMPLER_MAX_QUERIES]
+    uint32_t query_count;   // taken by the frame being recorded or read
+    uint32_t sample_count;
+    uint32_t unsampled;     // of its draws, those past the pool
+    const char* stack[DRAW_SAMPLER_MAX_DEPTH];  // the open scopes' names
+    int depth;
+    unsigned int frame_index;   // frames begun: the interval-th, and every interval after, are sampled
+    unsigned int sampled_frame; // the one recorded or in flight
+    bool due;               // a sample's frame came while the last was in flight
+    bool recording;
+    bool pending;           // recorded, not read back yet
+
+    // Totals over the run
+    unsigned int reports;
+    unsigned int deferred;  // samples put off for the last to come in
+} DrawSampler;
+
+// Needs a current context. Samples every "interval" (> 0) frames and writes the reports to "out". Returns false
+// when the context has no timestamp queries (GL_EXT_disjoint_timer_query on ES) or memory runs out.
+bool draw_sampler_init(DrawSampler* s, unsigned int interval, FILE* out);
+void draw_sampler_destroy(DrawSampler* s);
+
+// Bracket every frame, on the thread that draws it: gl/gpu_profiler.h calls these, and push and pop, for a
+// sampler set in its "draws". Begin reads back the last sample once it's in and starts the next when it's due.
+void draw_sampler_begin_frame(DrawSampler* s);
+void draw_sampler_end_frame(DrawSampler* s);
+void draw_sampler_push(DrawSampler* s, const char* name);
+void draw_sampler_pop(DrawSampler* s);
+
+// Waits for the GPU and reports a sample still in flight (at shutdown)
+void draw_sampler_flush(DrawSampler* s);
+
+// One line: the reports written and the samples put off
+void draw_sampler_print(const DrawSampler* s, FILE* out);
@@ -0,0 +1,149 @@
+#include "gl/feed_renderer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+static const char* vertex_shader_text =
+"#version 330 core\n"
+"layout(location = 0) in vec3 position;\n"
+"layout(location = 1) in vec4 color;\n"
+"uniform mat4 viewProjection;\n"
+"out vec4 pointColor;\n"
+"void main()\n"
+"{\n"
+"    pointColor = color;\n"
+"    gl_Position = viewProjection * vec4(position, 1.0);\n"
+"}\n";
+
+static const char* fragment_shader_text =
+"#version 330 core\n"
+"in vec4 pointColor;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    fragment = pointColor;\n"
+"}\n";
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool feed_renderer_init(FeedRenderer* fr, const char* name)
+{
+    memset(fr, 0, sizeof(*fr));
+    snprintf(fr->name, sizeof(fr->name), "%s", name ? name : "");
+    fr->program = program_build(vertex_shader_text, fragment_shader_text, false);
+    if (!fr->program)
+    {
+        fprintf(stderr, "feed_renderer: can't build the program\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, fr->program, "feed points");
+    fr->view_projection_location = glGetUniformLocation(fr->program, "viewProjection");
+    fr->vertex_array = gl_dsa_create_vertex_array();
+    gl_debug_label(GL_VERTEX_ARRAY, fr->vertex_array, "feed points");
+
+    // The producer's FeedPoint, as it is
+    vertex_format_init(&fr->format);
+    vertex_format_add(&fr->format, 0, 3, VERTEX_ATTRIB_FLOAT32);
+    vertex_format_add(&fr->format, 1, 4, VERTEX_ATTRIB_UNORM8);
+    static_assert(sizeof(FeedPoint) == 16, "FeedPoint is the feed's vertex: three floats and RGBA8");
+    return true;
+}
+
+void feed_renderer_destroy(FeedRenderer* fr)
+{
+    shared_feed_close(&fr->feed);
+    if (fr->stream_capacity)
+        stream_buffer_destroy(&fr->stream);
+    if (fr->vertex_array)
+        gl_state_delete_vertex_arrays(1, &fr->vertex_array);
+    if (fr->program)
+        glDeleteProgram(fr->program);
+    memset(fr, 0, sizeof(*fr));
+}
+
+void feed_renderer_update(FeedRenderer* fr, double now)
+{
+    if (fr->feed.header && shared_feed_closed(&fr->feed))
+    {
+        printf("feed: %s closed after frame %llu\n", fr->name, (unsigned long long)fr->frame);
+        fr->frames_skipped += fr->feed.skipped;
+        shared_feed_close(&fr->feed);
+        fr->count = 0;
+        fr->next_look = now;
+    }
+    if (!fr->feed.header)
+    {
+        if (!fr->name[0] || now < fr->next_look)
+            return;
+        fr->next_look = now + FEED_RENDERER_RETRY_SECONDS;
+        if (!shared_feed_open(&fr->feed, fr->name))
+            return;
+
+        // A region a frame for as many points as the producer's slots hold, made again only for a bigger feed
+        const uint32_t capacity = fr->feed.header->capacity;
+        if (capacity > fr->stream_capacity)
+        {
+            if (fr->stream_capacity)
+                stream_buffer_destroy(&fr->stream);
+            fr->stream_capacity = 0;
+            if (!stream_buffer_init(&fr->stream, GL_ARRAY_BUFFER, (GLsizeiptr)sizeof(FeedPoint) * capacity))
+            {
+                fprintf(stderr, "feed: no stream buffer for %u points\n", capacity);
+                shared_feed_close(&fr->feed);
+                return;
+            }
+            gl_debug_label(GL_BUFFER, fr->stream.buffer, "feed stream");
+            fr->stream_capacity = capacity;
+        }
+        ++fr->connections;
+        printf("feed: %s connected, %u points a frame\n", fr->name, capacity);
+    }
+
+    const FeedPoint* points;
+    uint32_t count;
+    uint64_t frame;
+    if (!shared_feed_acquire(&fr->feed, &points, &count, &frame))
+        return;     // the last one is drawn again
+    const double start = now_ms();
+    stream_buffer_begin_frame(&fr->stream);
+    void* out = stream_buffer_alloc(&fr->stream, (GLsizeiptr)sizeof(FeedPoint) * (count ? count : 1),
+        sizeof(FeedPoint), &fr->offset);
+    if (out)
+        memcpy(out, points, sizeof(FeedPoint) * count);
+    stream_buffer_end_frame(&fr->stream);
+    fr->copy_ms += now_ms() - start;
+    fr->count = out ? count : 0;
+    fr->frame = frame;
+    fr->bytes_copied += sizeof(FeedPoint) * count;
+    ++fr->frames_received;
+}
+
+void feed_renderer_draw(FeedRenderer* fr, mat4x4 const view_projection)
+{
+    if (fr->count)
+        feed_renderer_draw_buffer(fr, fr->stream.buffer, fr->offset, fr->count, view_projection);
+}
+
+void feed_renderer_draw_buffer(FeedRenderer* fr, GLuint buffer, GLintptr offset, uint32_t count,
+    mat4x4 const view_projection)
+{
+    gl_state_enable(GL_DEPTH_TEST, true);
+    gl_state_use_program(fr->program);
+    glUniformMatrix4fv(fr->view_projection_location, 1, GL_FALSE, &view_projection[0][0]);
+    gl_state_bind_vertex_array(fr->vertex_array);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, buffer);
+    vertex_format_apply(&fr->format, offset);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)count);
+    draw_counters_draw(GL_POINTS, (GLsizei)count, 1);
+    ++fr->draws;
+}
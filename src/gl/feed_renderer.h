@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/shared_feed.h"
+#include "gl/stream_buffer.h"
+#include "gl/vertex_format.h"
+#include "linmath.h"
+
+#include <stdint.h>
+
+// Draws the points another process pushes through a shared-memory feed
+// (core/shared_feed.h) as GL_POINTS in the scene, a pixel each and depth
+// tested.
+//
+// The renderer is the feed's consumer. Once a frame it takes the newest
+// frame the producer has published, if there's one it hasn't had, and copies
+// it from the feed's slot into its stream buffer (gl/stream_buffer.h),
+// persistently mapped on 4.4+: one memcpy from the producer's memory to
+// memory the GPU reads, the points already laid out as the vertices
+// (position as three floats at location 0, colour as UNORM8x4 at 1). A frame
+// without a new one draws the last again from where it already is. Until
+// the producer has created the feed, and again after it closes it, the
+// renderer looks for it every FEED_RENDERER_RETRY_SECONDS.
+//
+// Points already in a GL buffer, as a CUDA kernel writes them
+// (cuda/cuda_points.h), are drawn the same way with
+// feed_renderer_draw_buffer.
+
+#define FEED_RENDERER_RETRY_SECONDS 1.0
+
+typedef struct FeedRenderer
+{
+    GLuint program;
+    GLint view_projection_location;
+    GLuint vertex_array;
+    VertexFormat format;
+    StreamBuffer stream;            // sized for the feed's capacity when it's opened
+    uint32_t stream_capacity;       // points a frame's region holds; 0 before the first feed
+    SharedFeed feed;                // header NULL while not connected
+    char name[48];
+    double next_look;               // when to look for the feed again
+    GLintptr offset;                // the frame drawn: where it is in the stream buffer
+    uint32_t count;
+    uint64_t frame;                 // the producer's number for it
+
+    // Over the run
+    unsigned int connections;
+    uint64_t frames_received;
+    uint64_t frames_skipped;        // published while the renderer was slower, never drawn
+    uint64_t bytes_copied;
+    double copy_ms;
+    unsigned int draws;
+} FeedRenderer;
+
+// For the feed called "name" (see shared_feed_create), or NULL for none, only drawing buffers. Logs and returns
+// false when the program fails to build.
+bool feed_renderer_init(FeedRenderer* fr, const char* name);
+void feed_renderer_destroy(FeedRenderer* fr);
+
+// Once a frame, "now" in seconds: connects when the feed is there, lets go when it's closed, and takes a new frame
+// into the stream buffer
+void feed_renderer_update(FeedRenderer* fr, double now);
+
+// The last frame taken, depth tested against what's bound
+void feed_renderer_draw(FeedRenderer* fr, mat4x4 const view_projection);
+
+// "count" FeedPoints at "offset" in "buffer"
+void feed_renderer_draw_buffer(FeedRenderer* fr, GLuint buffer, GLintptr offset, uint32_t count,
+    mat4x4 const view_projection);
@@ -0,0 +1,259 @@
+#include "gl/foveation.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ShadingRate's order, as the image's values index it
+static const GLenum foveation_palette[SHADING_RATE_COUNT] = {
+    GL_SHADING_RATE_1_INVOCATION_PER_PIXEL_NV,
+    GL_SHADING_RATE_1_INVOCATION_PER_2X1_PIXELS_NV,
+    GL_SHADING_RATE_1_INVOCATION_PER_2X2_PIXELS_NV,
+    GL_SHADING_RATE_1_INVOCATION_PER_4X2_PIXELS_NV,
+    GL_SHADING_RATE_1_INVOCATION_PER_4X4_PIXELS_NV,
+};
+
+// The shader's uniforms, at the locations its GLSL gives them rather than looked up by name
+enum
+{
+    RATE_LOCATION_VIEW = 0,
+    RATE_LOCATION_FOVEA = 1,
+    RATE_LOCATION_THRESHOLDS = 2
+};
+
+// A group a tile (its pixel count a power of two): its luma range and fastest motion reduced in
+// shared memory, then shading_rate_foveated and shading_rate_adaptive's rule for the tile's texel
+static const char* rate_compute_shader_format =
+"#version 430\n"
+"#define TILE %d\n"
+"layout(local_size_x = TILE, local_size_y = TILE) in;\n"
+"layout(binding = 0) uniform sampler2D colour;\n"
+"layout(binding = 1) uniform sampler2D motion;\n"
+"layout(r8ui, binding = 0) writeonly uniform uimage2D rates;\n"
+"layout(location = 0) uniform vec3 view;\n"          // xy: the drawn size in pixels; z: 1 when "motion" has vectors
+"layout(location = 1) uniform vec4 fovea;\n"         // xy: its centre in pixels; z, w: inner and outer radii in pixels
+"layout(location = 2) uniform vec2 thresholds;\n"    // the settings' contrast and motion
+"shared float lo[TILE * TILE];\n"
+"shared float hi[TILE * TILE];\n"
+"shared float fast[TILE * TILE];\n"
+"void main()\n"
+"{\n"
+"    ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"    uint i = gl_LocalInvocationIndex;\n"
+"    bool inside = all(lessThan(p, ivec2(view.xy)));\n"
+"    float l = 0.0, m = 0.0;\n"
+"    if (inside)\n"
+"    {\n"
+"        l = dot(texelFetch(colour, p, 0).rgb, vec3(0.2126, 0.7152, 0.0722));\n"
+"        l = l / (1.0 + l);\n"  // tonemapped, so HDR and display colour compare alike
+"        if (view.z != 0.0)\n"
+"            m = length(texelFetch(motion, p, 0).xy);\n"
+"    }\n"
+"    lo[i] = inside ? l : 1.0;\n"
+"    hi[i] = l;\n"
+"    fast[i] = m;\n"
+"    barrier();\n"
+"    for (uint s = uint(TILE * TILE) / 2u; s > 0u; s >>= 1)\n"
+"    {\n"
+"        if (i < s)\n"
+"        {\n"
+"            lo[i] = min(lo[i], lo[i + s]);\n"
+"            hi[i] = max(hi[i], hi[i + s]);\n"
+"            fast[i] = max(fast[i], fast[i + s]);\n"
+"        }\n"
+"        barrier();\n"
+"    }\n"
+"    if (i != 0u)\n"
+"        return;\n"
+"    float d = distance((vec2(gl_WorkGroupID.xy) + 0.5) * vec2(TILE), fovea.xy);\n"
+"    int rate = d <= fovea.z ? 0 : d >= fovea.w ? 4 : min(1 + int((d - fovea.z) / (fovea.w - fovea.z) * 3.0), 3);\n"
+"    float contrast = (hi[0] - lo[0]) / max(hi[0], 1e-4);\n"
+"    int flat = contrast >= thresholds.x ? 0 : contrast >= 0.25 * thresholds.x ? 1 : 2;\n"
+"    rate = max(rate, flat) + (fast[0] >= 4.0 * thresholds.y ? 2 : fast[0] >= thresholds.y ? 1 : 0);\n"
+"    imageStore(rates, ivec2(gl_WorkGroupID.xy), uvec4(min(rate, 4)));\n"
+"}\n";
+
+bool foveation_init(Foveation* f, FoveationMode mode, const ShadingRateSettings* settings)
+{
+    memset(f, 0, sizeof(*f));
+    f->settings = *settings;
+    f->rate_image = gl_ext.NV_shading_rate_image && gl_ext.ARB_texture_storage;
+    f->mode = mode == FOVEATION_ADAPTIVE && !(f->rate_image && GLAD_GL_VERSION_4_3) ? FOVEATION_FIXED : mode;
+    f->cost = 1.f;
+    if (!f->rate_image)
+        return true;
+
+    GLint tile = 16;
+    glGetIntegerv(GL_SHADING_RATE_IMAGE_TEXEL_WIDTH_NV, &tile);     // square on every part, as is its height
+    f->tile = tile > 0 ? tile : 16;
+    gl_ext.ShadingRateImagePaletteNV(0, 0, SHADING_RATE_COUNT, foveation_palette);
+
+    if (f->mode == FOVEATION_ADAPTIVE)
+    {
+        char text[4096];
+        snprintf(text, sizeof(text), rate_compute_shader_format, f->tile);
+        GLuint shader = shader_compile(GL_COMPUTE_SHADER, text);
+        f->rate_program = program_link(&shader, 1, false);
+        if (!f->rate_program)
+        {
+            fprintf(stderr, "vrs: can't build the rate program\n");
+            return false;
+        }
+        gl_debug_label(GL_PROGRAM, f->rate_program, "vrs rates");
+    }
+    return true;
+}
+
+void foveation_destroy(Foveation* f)
+{
+    gl_state_delete_textures(1, &f->rates);
+    if (f->periphery.framebuffer)
+        render_target_destroy(&f->periphery);
+    if (f->rate_program)
+        glDeleteProgram(f->rate_program);
+    free(f->fixed);
+    memset(f, 0, sizeof(*f));
+}
+
+// The image for a target of "width" x "height": a texel per tile, immutable R8UI as the extension requires
+static void foveation_size_image(Foveation* f, int width, int height)
+{
+    const int tiles_x = (width + f->tile - 1) / f->tile, tiles_y = (height + f->tile - 1) / f->tile;
+    if (f->rates && tiles_x == f->tiles_x && tiles_y == f->tiles_y)
+        return;
+    gl_state_delete_textures(1, &f->rates);
+    f->tiles_x = tiles_x;
+    f->tiles_y = tiles_y;
+    f->fixed = (uint8_t*)realloc(f->fixed, (size_t)tiles_x * tiles_y);
+    glGenTextures(1, &f->rates);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, f->rates);
+    gl_ext.TexStorage2D(GL_TEXTURE_2D, 1, GL_R8UI, tiles_x, tiles_y);
+    gl_memory_texture(f->rates, GPU_MEMORY_RENDER_TARGETS, GL_R8UI, tiles_x, tiles_y, 1, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl_debug_label(GL_TEXTURE, f->rates, "shading rates");
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+    f->width = f->height = 0;   // refilled for the view
+}
+
+void foveation_resize(Foveation* f, const RenderTarget* target, int width, int height)
+{
+    if (f->rate_image)
+    {
+        foveation_size_image(f, target->width, target->height);
+        if (width == f->width && height == f->height)
+            return;
+        f->width = width;
+        f->height = height;
+        // The view's tiles, foveated: all of it for fixed, and adaptive's first frame. Tiles past the view are
+        // never read.
+        const int tiles_x = (width + f->tile - 1) / f->tile, tiles_y = (height + f->tile - 1) / f->tile;
+        shading_rate_fill(&f->settings, width, height, f->tile, f->fixed);
+        f->cost = shading_rate_mean_cost(f->fixed, tiles_x * tiles_y);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, f->rates);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tiles_x, tiles_y, GL_RED_INTEGER, GL_UNSIGNED_BYTE, f->fixed);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+        return;
+    }
+
+    const int half_width = (target->width + 1) / 2, half_height = (target->height + 1) / 2;
+    if (f->periphery.width != half_width || f->periphery.height != half_height
+        || f->periphery.color_format != target->color_format)
+    {
+        if (f->periphery.framebuffer)
+            render_target_destroy(&f->periphery);
+        const GLuint previous = gl_state.draw_framebuffer;
+        if (!render_target_init(&f->periphery, half_width, half_height, target->color_format, target->float_depth, 1))
+            fprintf(stderr, "vrs: no %dx%d periphery target\n", half_width, half_height);
+        else
+            gl_debug_label(GL_FRAMEBUFFER, f->periphery.framebuffer, "periphery");
+        gl_state_bind_framebuffer(GL_FRAMEBUFFER, previous);
+    }
+    if (width == f->width && height == f->height)
+        return;
+    f->width = width;
+    f->height = height;
+    shading_rate_fovea(&f->settings, width, height, f->fovea);
+    const float inset = (float)(f->fovea[2] - f->fovea[0]) * (f->fovea[3] - f->fovea[1]);
+    f->cost = inset / ((float)width * height) + 0.25f;
+}
+
+void foveation_shade_begin(Foveation* f)
+{
+    gl_ext.BindShadingRateImageNV(f->rates);
+    gl_state_enable(GL_SHADING_RATE_IMAGE_NV, true);
+}
+
+void foveation_shade_end(Foveation* f)
+{
+    gl_state_enable(GL_SHADING_RATE_IMAGE_NV, false);
+}
+
+void foveation_update(Foveation* f, GLuint colour, GLuint motion)
+{
+    if (f->mode != FOVEATION_ADAPTIVE || !f->rate_program || f->width < 1)
+        return;
+    const float height = (float)f->height;
+    gl_state_use_program(f->rate_program);
+    glUniform3f(RATE_LOCATION_VIEW, (float)f->width, height, motion ? 1.f : 0.f);
+    glUniform4f(RATE_LOCATION_FOVEA, f->settings.centre[0] * f->width, f->settings.centre[1] * height,
+        f->settings.inner * height, f->settings.outer * height);
+    glUniform2f(RATE_LOCATION_THRESHOLDS, f->settings.contrast, f->settings.motion);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, colour);
+    gl_state_bind_texture(1, GL_TEXTURE_2D, motion);
+    glBindImageTexture(0, f->rates, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8UI);
+    glDispatchCompute((f->width + f->tile - 1) / f->tile, (f->height + f->tile - 1) / f->tile, 1);
+    draw_counters_dispatch();
+    // The rasterizer reads the image: the stores have to land before the next frame's draws look
+    gl_ext.ShadingRateImageBarrierNV(GL_TRUE);
+}
+
+void foveation_periphery_begin(Foveation* f, bool depth)
+{
+    f->resume_framebuffer = gl_state.draw_framebuffer;
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, f->periphery.framebuffer);
+    gl_state_viewport(0, 0, (f->width + 1) / 2, (f->height + 1) / 2);
+    glClear(depth ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT);
+}
+
+void foveation_periphery_end(Foveation* f)
+{
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, f->resume_framebuffer);
+    gl_state_viewport(0, 0, f->width, f->height);
+    gl_state_enable(GL_SCISSOR_TEST, true);
+    glScissor(f->fovea[0], f->fovea[1], f->fovea[2] - f->fovea[0], f->fovea[3] - f->fovea[1]);
+}
+
+void foveation_composite(Foveation* f, const RenderTarget* target, bool depth)
+{
+    gl_state_enable(GL_SCISSOR_TEST, false);
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, f->periphery.framebuffer);
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, target->framebuffer);
+    // Four strips around the inset: below, above, left and right of it
+    const int w = f->width, h = f->height;
+    const int* i = f->fovea;
+    const int strips[4][4] = {
+        { 0, 0, w, i[1] }, { 0, i[3], w, h }, { 0, i[1], i[0], i[3] }, { i[2], i[1], w, i[3] },
+    };
+    const int pw = (w + 1) / 2, ph = (h + 1) / 2;
+    for (int k = 0; k < 4; ++k)
+    {
+        const int* d = strips[k];
+        if (d[2] <= d[0] || d[3] <= d[1])
+            continue;
+        const int s[4] = { d[0] * pw / w, d[1] * ph / h, d[2] * pw / w, d[3] * ph / h };
+        glBlitFramebuffer(s[0], s[1], s[2], s[3], d[0], d[1], d[2], d[3], GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        if (depth)
+            glBlitFramebuffer(s[0], s[1], s[2], s[3], d[0], d[1], d[2], d[3], GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    }
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, target->framebuffer);
+}
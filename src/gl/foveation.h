@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/shading_rate.h"
+#include "gl/render_target.h"
+
+#include <stdint.h>
+
+// Variable-rate shading of the scene: the GL side of core/shading_rate.h.
+//
+// With GL_NV_shading_rate_image the scene's passes draw with an R8UI image
+// of ShadingRates bound, a texel per tile of the framebuffer (the driver's
+// tile size, 16 pixels on every part so far) and a palette that maps each
+// rate to the extension's. Fixed foveation fills it once a size, on the CPU.
+// Adaptive (4.3) rewrites it after each frame with a compute pass, a group a
+// tile: the tile's luma range in the frame just drawn and its fastest motion
+// vector (--taa's, when there are any) through shading_rate_adaptive's rule,
+// for the next frame to shade with. A frame late, as a tile's content barely
+// changes between two.
+//
+// Without the extension the periphery is drawn at half the resolution
+// instead: the scene's draws go once to a half-size target, then again at full
+// size scissored to the fovea's inset (shading_rate_fovea), and the half-size
+// frame is stretched over the rest - colour filtered, depth nearest, so what
+// draws after still tests against it. The geometry is drawn twice; the
+// pixels shaded are the inset plus a quarter of the view.
+
+typedef enum FoveationMode
+{
+    FOVEATION_OFF,
+    FOVEATION_FIXED,            // --vrs fixed
+    FOVEATION_ADAPTIVE          // --vrs adaptive: the shading rate image and 4.3 only
+} FoveationMode;
+
+typedef struct Foveation
+{
+    FoveationMode mode;
+    bool rate_image;            // GL_NV_shading_rate_image; false draws the periphery at half size
+    ShadingRateSettings settings;
+    int width;                  // the view the rates and the inset are for
+    int height;
+    float cost;                 // of full-rate shading, as foveated: the image's mean, or the inset and periphery's pixels
+    GLuint rates;               // the shading rate image, sized for the target
+    int tile;                   // pixels across the square a texel of it covers
+    int tiles_x;                // its size in texels
+    int tiles_y;
+    uint8_t* fixed;             // tiles_x * tiles_y foveated rates, uploaded on a new view size
+    GLuint rate_program;        // adaptive
+    RenderTarget periphery;     // no shading rate image: half the target's size
+    int fovea[4];               // the full-rate inset, x0, y0, x1, y1
+    GLuint resume_framebuffer;  // where foveation_periphery_begin found the frame being drawn
+} Foveation;
+
+// Falls back from ADAPTIVE to FIXED without the extension or 4.3 (compare f->mode). Logs and returns false when
+// the rate program can't be built.
+bool foveation_init(Foveation* f, FoveationMode mode, const ShadingRateSettings* settings);
+void foveation_destroy(Foveation* f);
+
+// The frame's "width" x "height" corner of "target": the image or the periphery follows the target's size, the
+// fixed rates and the inset the view's. Cheap when neither changed.
+void foveation_resize(Foveation* f, const RenderTarget* target, int width, int height);
+
+// The shading rate image on for the draws that follow, and off again
+void foveation_shade_begin(Foveation* f);
+void foveation_shade_end(Foveation* f);
+
+// Adaptive: next frame's rates from the frame just drawn ("colour", the target's colour texture) and, unless 0, an
+// RG16F texture of its motion in pixels (gl/temporal_aa.h's)
+void foveation_update(Foveation* f, GLuint colour, GLuint motion);
+
+// No shading rate image: drawing switches to the half-size target, cleared ("depth": its depth too), and back to
+// the frame with the scissor around the inset. The pass's state is the caller's, bound for both.
+void foveation_periphery_begin(Foveation* f, bool depth);
+void foveation_periphery_end(Foveation* f);
+
+// The half-size periphery stretched around the inset of "target", and its depth too with "depth". Leaves the
+// scissor test off and the target bound.
+void foveation_composite(Foveation* f, const RenderTarget* target, bool depth);
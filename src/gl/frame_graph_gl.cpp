@@ -0,0 +1,73 @@
+#include "gl/frame_graph_gl.h"
+
+#include "gl/gl_ext.h"
+#include "gl/gl_state.h"
+
+GLbitfield frame_graph_gl_barrier_bits(uint32_t barriers)
+{
+    static const GLbitfield bits[FRAME_GRAPH_ACCESS_COUNT] = {
+        GL_FRAMEBUFFER_BARRIER_BIT,             // FRAME_GRAPH_ATTACHMENT
+        GL_TEXTURE_FETCH_BARRIER_BIT,           // FRAME_GRAPH_SAMPLED
+        GL_SHADER_IMAGE_ACCESS_BARRIER_BIT,     // FRAME_GRAPH_IMAGE
+        GL_SHADER_STORAGE_BARRIER_BIT,          // FRAME_GRAPH_STORAGE
+        GL_UNIFORM_BARRIER_BIT,                 // FRAME_GRAPH_UNIFORM
+        GL_COMMAND_BARRIER_BIT,                 // FRAME_GRAPH_INDIRECT
+        GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT,  // FRAME_GRAPH_VERTEX
+        0,                                      // FRAME_GRAPH_EXTERNAL: mapping synchronises
+    };
+    GLbitfield result = 0;
+    for (int a = 0; a < FRAME_GRAPH_ACCESS_COUNT; ++a)
+        if (barriers & FRAME_GRAPH_BARRIER(a))
+            result |= bits[a];
+    return result;
+}
+
+void frame_graph_gl_invalidate(GLenum attachment)
+{
+    if (gl_ext.ARB_invalidate_subdata)
+        gl_ext.InvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, 1, &attachment);
+}
+
+bool frame_graph_gl_execute(FrameGraph* g, RenderTargetPool* pool)
+{
+    bool ok = true;
+    for (int i = 0; i < g->physical_count; ++i)
+    {
+        const FrameGraphTextureDesc* d = &g->physical[i].desc;
+        const PooledTarget* t = ok ? render_target_pool_acquire(pool, d->width, d->height, (GLenum)d->format) : NULL;
+        ok = ok && t;
+        g->physical[i].handle = (uintptr_t)t;
+    }
+    for (int r = 0; r < g->resource_count; ++r)
+        if (!g->resources[r].imported)
+            g->resources[r].handle = g->resources[r].physical >= 0 ? g->physical[g->resources[r].physical].handle : 0;
+
+    for (int step = 0; step < g->order_count && ok; ++step)
+    {
+        const int p = g->order[step];
+        const FrameGraphPass* pass = &g->passes[p];
+        if (pass->barriers)
+            glMemoryBarrier(frame_graph_gl_barrier_bits(pass->barriers));
+        const int output = frame_graph_pass_output(g, p, FRAME_GRAPH_ATTACHMENT);
+        if (output >= 0)
+        {
+            const PooledTarget* t = frame_graph_gl_target(g, output);
+            gl_state_bind_framebuffer(GL_FRAMEBUFFER, t->framebuffer);
+            gl_state_viewport(0, 0, t->width, t->height);
+            if (pass->discard & (1ull << output))
+                frame_graph_gl_invalidate(t->framebuffer ? GL_COLOR_ATTACHMENT0 : GL_COLOR);
+        }
+        if (pass->map && g->interop_map)
+            g->interop_map(g->interop_user, g, pass->map);
+        pass->execute(pass->user, g, p);
+        if (pass->unmap && g->interop_unmap)
+            g->interop_unmap(g->interop_user, g, pass->unmap);
+    }
+
+    for (int i = 0; i < g->physical_count; ++i)
+    {
+        render_target_pool_release(pool, (const PooledTarget*)g->physical[i].handle);
+        g->physical[i].handle = 0;
+    }
+    return ok;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/frame_graph.h"
+#include "gl/render_target_pool.h"
+
+// Runs a compiled frame graph (core/frame_graph.h) on GL.
+//
+// Every resource's handle is a "const PooledTarget*". Transients get one from
+// the RenderTargetPool per physical texture, held for the run and released
+// after it; imported ones are the caller's (a PooledTarget filled in for the
+// scene's target, or for the window with framebuffer 0). Before each pass the
+// executor issues its barriers as one glMemoryBarrier, binds the framebuffer
+// of what it draws into with the viewport at its size, and invalidates that
+// target first when the pass overwrites it, so a tiled GPU never loads it.
+// The pass itself only binds its program and inputs and draws. Around the
+// passes that use a resource FRAME_GRAPH_EXTERNAL it calls the graph's
+// interop hooks to map and unmap it (cuda/cuda_interop.h).
+
+// Returns false (and runs nothing) when the pool couldn't supply a physical texture. "pool" isn't touched by a
+// graph without transients.
+bool frame_graph_gl_execute(FrameGraph* g, RenderTargetPool* pool);
+
+// The target behind "resource" while executing
+static inline const PooledTarget* frame_graph_gl_target(const FrameGraph* g, int resource)
+{
+    return (const PooledTarget*)g->resources[resource].handle;
+}
+
+// FRAME_GRAPH_BARRIER bits as glMemoryBarrier's
+GLbitfield frame_graph_gl_barrier_bits(uint32_t barriers);
+
+// glInvalidateFramebuffer of one attachment of the bound draw framebuffer, where the driver has it
+void frame_graph_gl_invalidate(GLenum attachment);
@@ -0,0 +1,107 @@
+#include "gl/gl_debug.h"
+
+#if GL_DEBUG_LAYER
+
+#include "gl/gl_ext.h"
+#include "gl/gl_state.h"
+#include "core/telemetry.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static bool callback_installed = false;
+
+static const char* source_name(GLenum source)
+{
+    switch (source)
+    {
+    case GL_DEBUG_SOURCE_API: return "api";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION: return "application";
+    default: return "other";
+    }
+}
+
+static const char* type_name(GLenum type)
+{
+    switch (type)
+    {
+    case GL_DEBUG_TYPE_ERROR: return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behaviour";
+    case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+    case GL_DEBUG_TYPE_MARKER: return "marker";
+    default: return "other";
+    }
+}
+
+static const char* severity_name(GLenum severity)
+{
+    switch (severity)
+    {
+    case GL_DEBUG_SEVERITY_HIGH: return "high";
+    case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+    case GL_DEBUG_SEVERITY_LOW: return "low";
+    default: return "notification";
+    }
+}
+
+static void APIENTRY debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+    const GLchar* message, const void* user)
+{
+    if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP)
+        return;     // our own groups, echoed back
+    fprintf(stderr, "gl: %s %s (%s, %u): %.*s\n", severity_name(severity), type_name(type), source_name(source), id,
+        (int)(length >= 0 ? length : (GLsizei)strlen(message)), message);
+    if (type == GL_DEBUG_TYPE_ERROR || severity == GL_DEBUG_SEVERITY_HIGH)
+    {
+        const float code[4] = { (float)id, 0.f, 0.f, 0.f };
+        telemetry_record(TELEMETRY_ERROR, 0, code, message);
+    }
+}
+
+void gl_debug_init(void)
+{
+    if (!gl_ext.KHR_debug)
+    {
+        fprintf(stderr, "gl_debug: no GL_KHR_debug, errors are only checked once a frame\n");
+        return;
+    }
+    gl_state_enable(GL_DEBUG_OUTPUT, true);
+    gl_state_enable(GL_DEBUG_OUTPUT_SYNCHRONOUS, true);
+    gl_ext.DebugMessageCallback(debug_callback, NULL);
+    gl_ext.DebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+    callback_installed = true;
+}
+
+void gl_debug_label(GLenum identifier, GLuint name, const char* label)
+{
+    if (gl_ext.KHR_debug && name)
+        gl_ext.ObjectLabel(identifier, name, -1, label);
+}
+
+void gl_debug_push(const char* name)
+{
+    if (gl_ext.KHR_debug)
+        gl_ext.PushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+}
+
+void gl_debug_pop(void)
+{
+    if (gl_ext.KHR_debug)
+        gl_ext.PopDebugGroup();
+}
+
+void gl_debug_check(const char* where)
+{
+    if (callback_installed)
+        return;
+    GLenum error;
+    for (int i = 0; i < 16 && (error = glGetError()) != GL_NO_ERROR; ++i)    // bounded: a lost context never clears
+        fprintf(stderr, "gl: error 0x%04x before the end of %s\n", error, where);
+}
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Debug layer: the driver's GL_KHR_debug messages (errors, undefined
+// behaviour, portability and performance warnings) reported as they happen,
+// names on the objects that matter, and debug groups around the passes, so
+// RenderDoc / Nsight captures and the messages themselves say what was
+// being drawn. Compile and link failures are logged by gl/shader.h.
+//
+// Only built into debug builds: with GL_DEBUG_LAYER 0 (the default wherever
+// NDEBUG is defined, i.e. Release, RelWithDebInfo and the Profile preset)
+// every call below is an empty inline function and costs nothing. Configure
+// with -DOPENGLTEST_GL_DEBUG=ON to keep the layer in an optimised build.
+//
+// Without GL_KHR_debug (a 3.3 context on an older driver) gl_debug_check
+// falls back to glGetError, once a frame. Errors and high-severity messages
+// also go into core/telemetry.h's ring while it records.
+
+#ifndef GL_DEBUG_LAYER
+#ifdef NDEBUG
+#define GL_DEBUG_LAYER 0
+#else
+#define GL_DEBUG_LAYER 1
+#endif
+#endif
+
+#if GL_DEBUG_LAYER
+
+// Installs the message callback (synchronous, so a message is reported from inside the call that caused it) and
+// drops the notification severity. Needs gl_ext loaded; ask GLFW for a debug context to get every message.
+void gl_debug_init(void);
+
+// glObjectLabel: "identifier" is GL_BUFFER, GL_TEXTURE, GL_PROGRAM, GL_VERTEX_ARRAY, GL_FRAMEBUFFER, ...
+void gl_debug_label(GLenum identifier, GLuint name, const char* label);
+
+// glPushDebugGroup / glPopDebugGroup, balanced
+void gl_debug_push(const char* name);
+void gl_debug_pop(void);
+
+// Logs anything glGetError has queued, tagged with "where", when the callback isn't there to report it
+void gl_debug_check(const char* where);
+
+#else
+
+static inline void gl_debug_init(void) {}
+static inline void gl_debug_label(GLenum, GLuint, const char*) {}
+static inline void gl_debug_push(const char*) {}
+static inline void gl_debug_pop(void) {}
+static inline void gl_debug_check(const char*) {}
+
+#endif
@@ -0,0 +1,89 @@
+#include "gl/gl_dsa.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_state.h"
+
+GLuint gl_dsa_create_buffer(GLsizeiptr bytes, const void* data, GLenum usage)
+{
+    GLuint buffer = 0;
+    if (data)
+        draw_counters_upload((size_t)bytes);
+    if (gl_ext.ARB_direct_state_access)
+    {
+        gl_ext.CreateBuffers(1, &buffer);
+        gl_ext.NamedBufferData(buffer, bytes, data, usage);
+        return buffer;
+    }
+    glGenBuffers(1, &buffer);
+    gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, data, usage);
+    return buffer;
+}
+
+GLuint gl_dsa_create_buffer_storage(GLsizeiptr bytes, const void* data, GLbitfield flags)
+{
+    // glad only loads glBufferStorage when the context is 4.4 or newer, and glNamedBufferStorage needs it too
+    if (!glBufferStorage)
+        return gl_dsa_create_buffer(bytes, data, (flags & GL_DYNAMIC_STORAGE_BIT) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+    GLuint buffer = 0;
+    if (data)
+        draw_counters_upload((size_t)bytes);
+    if (gl_ext.ARB_direct_state_access)
+    {
+        gl_ext.CreateBuffers(1, &buffer);
+        gl_ext.NamedBufferStorage(buffer, bytes, data, flags);
+        return buffer;
+    }
+    glGenBuffers(1, &buffer);
+    gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, bytes, data, flags);
+    return buffer;
+}
+
+void gl_dsa_buffer_data(GLuint buffer, GLsizeiptr bytes, const void* data, GLenum usage)
+{
+    if (data)
+        draw_counters_upload((size_t)bytes);
+    if (gl_ext.ARB_direct_state_access)
+    {
+        gl_ext.NamedBufferData(buffer, bytes, data, usage);
+        return;
+    }
+    gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, data, usage);
+}
+
+void gl_dsa_buffer_sub_data(GLuint buffer, GLintptr offset, GLsizeiptr bytes, const void* data)
+{
+    draw_counters_upload((size_t)bytes);
+    if (gl_ext.ARB_direct_state_access)
+    {
+        gl_ext.NamedBufferSubData(buffer, offset, bytes, data);
+        return;
+    }
+    gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+}
+
+void gl_dsa_clear_buffer(GLuint buffer, GLenum internal_format, GLintptr offset, GLsizeiptr bytes, GLenum format,
+    GLenum type, const void* data)
+{
+    if (gl_ext.ARB_direct_state_access)
+    {
+        gl_ext.ClearNamedBufferSubData(buffer, internal_format, offset, bytes, format, type, data);
+        return;
+    }
+    gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+    glClearBufferSubData(GL_COPY_WRITE_BUFFER, internal_format, offset, bytes, format, type, data);
+}
+
+GLuint gl_dsa_create_vertex_array(void)
+{
+    GLuint vertex_array = 0;
+    if (gl_ext.ARB_direct_state_access)
+        gl_ext.CreateVertexArrays(1, &vertex_array);
+    else
+        glGenVertexArrays(1, &vertex_array);
+    return vertex_array;
+}
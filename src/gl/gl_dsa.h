@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Creating and filling buffers and vertex arrays by name where the context
+// allows it, by binding where it doesn't.
+//
+// With direct state access (4.5 or GL_ARB_direct_state_access, found by
+// gl_ext_load) buffers come from glCreateBuffers and are specified with
+// glNamedBuffer*, vertex arrays from glCreateVertexArrays: nothing is bound
+// to set them up, so the bindings the draws use, and gl_state's copy of them,
+// stay as they were. On older contexts (3.3 is the floor) the same calls go
+// through GL_COPY_WRITE_BUFFER, which no draw reads, by way of gl_state. The
+// app's --no-dsa clears gl_ext.ARB_direct_state_access to force that path.
+//
+// Immutable storage (glBufferStorage, 4.4) is used where asked for and the
+// context has it; without it the buffer is a mutable one of the same size.
+// None of this touches gl/gl_memory.h's accounts: callers report sizes as
+// they always have.
+
+// A buffer of "bytes", from "data" (NULL: left undefined), respecifiable later
+GLuint gl_dsa_create_buffer(GLsizeiptr bytes, const void* data, GLenum usage);
+
+// One that keeps its size: glBufferStorage with "flags" where there is one. Include GL_DYNAMIC_STORAGE_BIT to
+// gl_dsa_buffer_sub_data it afterwards.
+GLuint gl_dsa_create_buffer_storage(GLsizeiptr bytes, const void* data, GLbitfield flags);
+
+// glBufferData / glBufferSubData on "buffer"
+void gl_dsa_buffer_data(GLuint buffer, GLsizeiptr bytes, const void* data, GLenum usage);
+void gl_dsa_buffer_sub_data(GLuint buffer, GLintptr offset, GLsizeiptr bytes, const void* data);
+
+// glClearBufferSubData: [offset, offset + bytes) filled with "data" in "format" / "type", stored as "internal_format"
+void gl_dsa_clear_buffer(GLuint buffer, GLenum internal_format, GLintptr offset, GLsizeiptr bytes, GLenum format,
+    GLenum type, const void* data);
+
+// A vertex array that exists (and can be labelled) before it's first bound
+GLuint gl_dsa_create_vertex_array(void);
@@ -0,0 +1,341 @@
+#include "gl/gl_ext.h"
+
+#include <stdio.h>
+#include <string.h>
+
+GLExtensions gl_ext;
+
+// Whether the context has a feature that's core from desktop GL's "desktop" flag (GLAD_GL_VERSION_x_y) or from
+// OpenGL ES "es" (300, 310, 320)
+static bool core(int desktop, int es)
+{
+    return gl_ext.es ? gl_ext.es_version >= es : desktop != 0;
+}
+
+#define LOAD_CORE(name) glad_##name = (decltype(glad_##name))load(#name)
+#define LOAD_SUFFIXED(name, suffix) glad_##name = (decltype(glad_##name))load(#name suffix)
+
+// ES 3.x core entry points the renderer calls that glad files under desktop 3.1 to 4.5, and the ES extensions'
+// stand-ins for desktop entry points ES doesn't have
+static void load_es(GLADloadproc load)
+{
+    LOAD_CORE(glCopyBufferSubData);
+    LOAD_CORE(glDrawArraysInstanced);
+    LOAD_CORE(glDrawElementsInstanced);
+    LOAD_CORE(glGetUniformBlockIndex);
+    LOAD_CORE(glUniformBlockBinding);
+    LOAD_CORE(glFenceSync);
+    LOAD_CORE(glClientWaitSync);
+    LOAD_CORE(glWaitSync);
+    LOAD_CORE(glDeleteSync);
+    LOAD_CORE(glGetInteger64v);
+    LOAD_CORE(glVertexAttribDivisor);
+    LOAD_CORE(glGetProgramBinary);
+    LOAD_CORE(glProgramBinary);
+    LOAD_CORE(glProgramParameteri);
+    LOAD_CORE(glInvalidateFramebuffer);
+    LOAD_CORE(glTexStorage2D);
+    LOAD_CORE(glTexStorage3D);
+    LOAD_CORE(glGetInternalformativ);
+    LOAD_CORE(glClearDepthf);
+    if (gl_ext.es_version >= 310)
+    {
+        LOAD_CORE(glDispatchCompute);
+        LOAD_CORE(glDispatchComputeIndirect);
+        LOAD_CORE(glDrawElementsIndirect);
+        LOAD_CORE(glMemoryBarrier);
+        LOAD_CORE(glBindImageTexture);
+        LOAD_CORE(glGenProgramPipelines);
+        LOAD_CORE(glDeleteProgramPipelines);
+        LOAD_CORE(glBindProgramPipeline);
+        LOAD_CORE(glUseProgramStages);
+        LOAD_CORE(glVertexAttribFormat);
+        LOAD_CORE(glVertexAttribIFormat);
+        LOAD_CORE(glVertexAttribBinding);
+        LOAD_CORE(glBindVertexBuffer);
+    }
+    if (gl_ext.es_version >= 320)
+    {
+        LOAD_CORE(glCopyImageSubData);
+        LOAD_CORE(glDebugMessageCallback);
+        LOAD_CORE(glDebugMessageControl);
+        LOAD_CORE(glObjectLabel);
+        LOAD_CORE(glGetObjectLabel);
+        LOAD_CORE(glPushDebugGroup);
+        LOAD_CORE(glPopDebugGroup);
+        LOAD_CORE(glDrawElementsBaseVertex);
+        LOAD_CORE(glDrawElementsInstancedBaseVertex);
+        LOAD_CORE(glPatchParameteri);
+        LOAD_CORE(glTexBuffer);
+    }
+
+    // Same enums and behaviour as the desktop functions: persistent mappings, indirect batches and GPU timestamps
+    if (gl_ext_supported("GL_EXT_buffer_storage"))
+        LOAD_SUFFIXED(glBufferStorage, "EXT");
+    if (gl_ext_supported("GL_EXT_multi_draw_indirect"))
+    {
+        LOAD_SUFFIXED(glMultiDrawArraysIndirect, "EXT");
+        LOAD_SUFFIXED(glMultiDrawElementsIndirect, "EXT");
+    }
+    if (gl_ext_supported("GL_EXT_disjoint_timer_query"))
+    {
+        LOAD_SUFFIXED(glQueryCounter, "EXT");
+        LOAD_SUFFIXED(glGetQueryObjectui64v, "EXT");
+    }
+}
+
+#undef LOAD_CORE
+#undef LOAD_SUFFIXED
+
+bool gl_ext_supported(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (ext && !strcmp(ext, name))
+            return true;
+    }
+    return false;
+}
+
+void gl_ext_load(GLADloadproc load)
+{
+    memset(&gl_ext, 0, sizeof(gl_ext));
+
+    // "OpenGL ES 3.2 ..." on an ES context
+    const char* version = (const char*)glGetString(GL_VERSION);
+    int major = 0, minor = 0;
+    if (version && sscanf(version, "OpenGL ES %d.%d", &major, &minor) == 2)
+    {
+        gl_ext.es = true;
+        gl_ext.es_version = major * 100 + minor * 10;
+        load_es(load);
+    }
+    gl_ext.EXT_shader_pixel_local_storage = gl_ext.es && gl_ext_supported("GL_EXT_shader_pixel_local_storage");
+    gl_ext.EXT_color_buffer_float = !gl_ext.es || gl_ext.es_version >= 320
+        || gl_ext_supported("GL_EXT_color_buffer_float");
+
+    if (gl_ext_supported("GL_KHR_parallel_shader_compile"))
+        gl_ext.MaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+    else if (gl_ext_supported("GL_ARB_parallel_shader_compile"))
+        gl_ext.MaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+    gl_ext.KHR_parallel_shader_compile = gl_ext.MaxShaderCompilerThreadsKHR != NULL;
+
+    if (GLAD_GL_VERSION_4_6)
+        gl_ext.MultiDrawElementsIndirectCount = glad_glMultiDrawElementsIndirectCount;
+    else if (gl_ext_supported("GL_ARB_indirect_parameters"))
+        gl_ext.MultiDrawElementsIndirectCount = (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)load("glMultiDrawElementsIndirectCountARB");
+    gl_ext.ARB_indirect_parameters = gl_ext.MultiDrawElementsIndirectCount != NULL;
+
+    // The ARB texture_storage and copy_image entry points have the core names, without a suffix
+    if (core(GLAD_GL_VERSION_4_2, 300))
+    {
+        gl_ext.TexStorage2D = glad_glTexStorage2D;
+        gl_ext.TexStorage3D = glad_glTexStorage3D;
+    }
+    else if (gl_ext_supported("GL_ARB_texture_storage"))
+    {
+        gl_ext.TexStorage2D = (PFNGLTEXSTORAGE2DPROC)load("glTexStorage2D");
+        gl_ext.TexStorage3D = (PFNGLTEXSTORAGE3DPROC)load("glTexStorage3D");
+    }
+    gl_ext.ARB_texture_storage = gl_ext.TexStorage2D != NULL;
+    if (core(GLAD_GL_VERSION_4_3, 320))
+        gl_ext.CopyImageSubData = glad_glCopyImageSubData;
+    else if (gl_ext_supported("GL_ARB_copy_image"))
+        gl_ext.CopyImageSubData = (PFNGLCOPYIMAGESUBDATAPROC)load("glCopyImageSubData");
+    gl_ext.ARB_copy_image = gl_ext.CopyImageSubData != NULL;
+
+    gl_ext.EXT_texture_compression_s3tc = gl_ext_supported("GL_EXT_texture_compression_s3tc");
+    gl_ext.ARB_texture_compression_bptc = GLAD_GL_VERSION_4_2 || gl_ext_supported("GL_ARB_texture_compression_bptc");
+    gl_ext.ARB_ES3_compatibility = GLAD_GL_VERSION_4_3 || gl_ext.es || gl_ext_supported("GL_ARB_ES3_compatibility");
+    gl_ext.KHR_texture_compression_astc_ldr = gl_ext_supported("GL_KHR_texture_compression_astc_ldr");
+
+    if (gl_ext_supported("GL_ARB_bindless_texture"))
+    {
+        gl_ext.GetTextureHandleARB = (PFNGLGETTEXTUREHANDLEARBPROC)load("glGetTextureHandleARB");
+        gl_ext.MakeTextureHandleResidentARB = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)load("glMakeTextureHandleResidentARB");
+        gl_ext.MakeTextureHandleNonResidentARB = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)load("glMakeTextureHandleNonResidentARB");
+    }
+    gl_ext.ARB_bindless_texture = gl_ext.GetTextureHandleARB && gl_ext.MakeTextureHandleResidentARB
+        && gl_ext.MakeTextureHandleNonResidentARB;
+    gl_ext.NV_gpu_shader5 = gl_ext_supported("GL_NV_gpu_shader5");
+
+    // Desktop GL_KHR_debug uses the core names, without a suffix; ES's has the KHR suffix
+    if (core(GLAD_GL_VERSION_4_3, 320))
+    {
+        gl_ext.DebugMessageCallback = glad_glDebugMessageCallback;
+        gl_ext.DebugMessageControl = glad_glDebugMessageControl;
+        gl_ext.ObjectLabel = glad_glObjectLabel;
+        gl_ext.GetObjectLabel = glad_glGetObjectLabel;
+        gl_ext.PushDebugGroup = glad_glPushDebugGroup;
+        gl_ext.PopDebugGroup = glad_glPopDebugGroup;
+    }
+    else if (gl_ext_supported("GL_KHR_debug"))
+    {
+        gl_ext.DebugMessageCallback = (PFNGLDEBUGMESSAGECALLBACKPROC)load("glDebugMessageCallback");
+        gl_ext.DebugMessageControl = (PFNGLDEBUGMESSAGECONTROLPROC)load("glDebugMessageControl");
+        gl_ext.ObjectLabel = (PFNGLOBJECTLABELPROC)load("glObjectLabel");
+        gl_ext.GetObjectLabel = (PFNGLGETOBJECTLABELPROC)load("glGetObjectLabel");
+        gl_ext.PushDebugGroup = (PFNGLPUSHDEBUGGROUPPROC)load("glPushDebugGroup");
+        gl_ext.PopDebugGroup = (PFNGLPOPDEBUGGROUPPROC)load("glPopDebugGroup");
+    }
+    else if (gl_ext.es && gl_ext_supported("GL_KHR_debug"))
+    {
+        gl_ext.DebugMessageCallback = (PFNGLDEBUGMESSAGECALLBACKPROC)load("glDebugMessageCallbackKHR");
+        gl_ext.DebugMessageControl = (PFNGLDEBUGMESSAGECONTROLPROC)load("glDebugMessageControlKHR");
+        gl_ext.ObjectLabel = (PFNGLOBJECTLABELPROC)load("glObjectLabelKHR");
+        gl_ext.GetObjectLabel = (PFNGLGETOBJECTLABELPROC)load("glGetObjectLabelKHR");
+        gl_ext.PushDebugGroup = (PFNGLPUSHDEBUGGROUPPROC)load("glPushDebugGroupKHR");
+        gl_ext.PopDebugGroup = (PFNGLPOPDEBUGGROUPPROC)load("glPopDebugGroupKHR");
+    }
+    gl_ext.KHR_debug = gl_ext.DebugMessageCallback && gl_ext.DebugMessageControl && gl_ext.ObjectLabel
+        && gl_ext.PushDebugGroup && gl_ext.PopDebugGroup;
+
+    // Core names here too
+    if (core(GLAD_GL_VERSION_4_1, 310))
+    {
+        gl_ext.ProgramParameteri = glad_glProgramParameteri;
+        gl_ext.GenProgramPipelines = glad_glGenProgramPipelines;
+        gl_ext.DeleteProgramPipelines = glad_glDeleteProgramPipelines;
+        gl_ext.BindProgramPipeline = glad_glBindProgramPipeline;
+        gl_ext.UseProgramStages = glad_glUseProgramStages;
+    }
+    else if (gl_ext_supported("GL_ARB_separate_shader_objects"))
+    {
+        gl_ext.ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+        gl_ext.GenProgramPipelines = (PFNGLGENPROGRAMPIPELINESPROC)load("glGenProgramPipelines");
+        gl_ext.DeleteProgramPipelines = (PFNGLDELETEPROGRAMPIPELINESPROC)load("glDeleteProgramPipelines");
+        gl_ext.BindProgramPipeline = (PFNGLBINDPROGRAMPIPELINEPROC)load("glBindProgramPipeline");
+        gl_ext.UseProgramStages = (PFNGLUSEPROGRAMSTAGESPROC)load("glUseProgramStages");
+    }
+    gl_ext.ARB_separate_shader_objects = gl_ext.ProgramParameteri && gl_ext.GenProgramPipelines && gl_ext.DeleteProgramPipelines
+        && gl_ext.BindProgramPipeline && gl_ext.UseProgramStages;
+
+    if (core(GLAD_GL_VERSION_4_0, 320))
+        gl_ext.PatchParameteri = glad_glPatchParameteri;
+    else if (gl_ext_supported("GL_ARB_tessellation_shader"))
+        gl_ext.PatchParameteri = (PFNGLPATCHPARAMETERIPROC)load("glPatchParameteri");
+    gl_ext.ARB_tessellation_shader = gl_ext.PatchParameteri != NULL;
+
+    if (GLAD_GL_VERSION_4_5)
+        gl_ext.ClipControl = glad_glClipControl;
+    else if (gl_ext_supported("GL_ARB_clip_control"))
+        gl_ext.ClipControl = (PFNGLCLIPCONTROLPROC)load("glClipControl");
+    else if (gl_ext.es && gl_ext_supported("GL_EXT_clip_control"))
+        gl_ext.ClipControl = (PFNGLCLIPCONTROLPROC)load("glClipControlEXT");
+    gl_ext.ARB_clip_control = gl_ext.ClipControl != NULL;
+
+    if (core(GLAD_GL_VERSION_4_3, 300))
+        gl_ext.InvalidateFramebuffer = glad_glInvalidateFramebuffer;
+    else if (gl_ext_supported("GL_ARB_invalidate_subdata"))
+        gl_ext.InvalidateFramebuffer = (PFNGLINVALIDATEFRAMEBUFFERPROC)load("glInvalidateFramebuffer");
+    gl_ext.ARB_invalidate_subdata = gl_ext.InvalidateFramebuffer != NULL;
+
+    // Core names as well
+    if (core(GLAD_GL_VERSION_4_3, 310))
+    {
+        gl_ext.VertexAttribFormat = glad_glVertexAttribFormat;
+        gl_ext.VertexAttribIFormat = glad_glVertexAttribIFormat;
+        gl_ext.VertexAttribBinding = glad_glVertexAttribBinding;
+        gl_ext.BindVertexBuffer = glad_glBindVertexBuffer;
+    }
+    else if (gl_ext_supported("GL_ARB_vertex_attrib_binding"))
+    {
+        gl_ext.VertexAttribFormat = (PFNGLVERTEXATTRIBFORMATPROC)load("glVertexAttribFormat");
+        gl_ext.VertexAttribIFormat = (PFNGLVERTEXATTRIBIFORMATPROC)load("glVertexAttribIFormat");
+        gl_ext.VertexAttribBinding = (PFNGLVERTEXATTRIBBINDINGPROC)load("glVertexAttribBinding");
+        gl_ext.BindVertexBuffer = (PFNGLBINDVERTEXBUFFERPROC)load("glBindVertexBuffer");
+    }
+    gl_ext.ARB_vertex_attrib_binding = gl_ext.VertexAttribFormat && gl_ext.VertexAttribIFormat
+        && gl_ext.VertexAttribBinding && gl_ext.BindVertexBuffer;
+
+    // And here
+    if (GLAD_GL_VERSION_4_5)
+    {
+        gl_ext.CreateBuffers = glad_glCreateBuffers;
+        gl_ext.NamedBufferData = glad_glNamedBufferData;
+        gl_ext.NamedBufferStorage = glad_glNamedBufferStorage;
+        gl_ext.NamedBufferSubData = glad_glNamedBufferSubData;
+        gl_ext.ClearNamedBufferSubData = glad_glClearNamedBufferSubData;
+        gl_ext.CreateVertexArrays = glad_glCreateVertexArrays;
+    }
+    else if (gl_ext_supported("GL_ARB_direct_state_access"))
+    {
+        gl_ext.CreateBuffers = (PFNGLCREATEBUFFERSPROC)load("glCreateBuffers");
+        gl_ext.NamedBufferData = (PFNGLNAMEDBUFFERDATAPROC)load("glNamedBufferData");
+        gl_ext.NamedBufferStorage = (PFNGLNAMEDBUFFERSTORAGEPROC)load("glNamedBufferStorage");
+        gl_ext.NamedBufferSubData = (PFNGLNAMEDBUFFERSUBDATAPROC)load("glNamedBufferSubData");
+        gl_ext.ClearNamedBufferSubData = (PFNGLCLEARNAMEDBUFFERSUBDATAPROC)load("glClearNamedBufferSubData");
+        gl_ext.CreateVertexArrays = (PFNGLCREATEVERTEXARRAYSPROC)load("glCreateVertexArrays");
+    }
+    gl_ext.ARB_direct_state_access = gl_ext.CreateBuffers && gl_ext.NamedBufferData && gl_ext.NamedBufferStorage
+        && gl_ext.NamedBufferSubData && gl_ext.ClearNamedBufferSubData && gl_ext.CreateVertexArrays;
+
+    if (gl_ext_supported("GL_NV_shading_rate_image"))
+    {
+        gl_ext.BindShadingRateImageNV = (PFNGLBINDSHADINGRATEIMAGENVPROC)load("glBindShadingRateImageNV");
+        gl_ext.ShadingRateImagePaletteNV = (PFNGLSHADINGRATEIMAGEPALETTENVPROC)load("glShadingRateImagePaletteNV");
+        gl_ext.ShadingRateImageBarrierNV = (PFNGLSHADINGRATEIMAGEBARRIERNVPROC)load("glShadingRateImageBarrierNV");
+    }
+    gl_ext.NV_shading_rate_image = gl_ext.BindShadingRateImageNV && gl_ext.ShadingRateImagePaletteNV
+        && gl_ext.ShadingRateImageBarrierNV;
+
+    // Only queries: the subgroup operations are GLSL's
+    if (gl_ext_supported("GL_KHR_shader_subgroup"))
+    {
+        GLint stages = 0, features = 0;
+        glGetIntegerv(GL_SUBGROUP_SIZE_KHR, &gl_ext.subgroup_size);
+        glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages);
+        glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features);
+        const GLint needed = GL_SUBGROUP_FEATURE_BASIC_BIT_KHR | GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR;
+        gl_ext.KHR_shader_subgroup = (stages & GL_COMPUTE_SHADER_BIT) && (features & needed) == needed;
+    }
+
+    // The ARB enums have the core values, so only the flag is needed
+    gl_ext.ARB_pipeline_statistics_query = GLAD_GL_VERSION_4_6 || gl_ext_supported("GL_ARB_pipeline_statistics_query");
+
+    // Sparse storage is immutable storage, and its page sizes are asked of glGetInternalformativ (4.2)
+    if (gl_ext.ARB_texture_storage && glGetInternalformativ && gl_ext_supported("GL_ARB_sparse_texture"))
+        gl_ext.TexPageCommitmentARB = (PFNGLTEXPAGECOMMITMENTARBPROC)load("glTexPageCommitmentARB");
+    gl_ext.ARB_sparse_texture = gl_ext.TexPageCommitmentARB != NULL;
+
+    if (gl_ext_supported("GL_INTEL_performance_query"))
+    {
+        gl_ext.GetFirstPerfQueryIdINTEL = (PFNGLGETFIRSTPERFQUERYIDINTELPROC)load("glGetFirstPerfQueryIdINTEL");
+        gl_ext.GetNextPerfQueryIdINTEL = (PFNGLGETNEXTPERFQUERYIDINTELPROC)load("glGetNextPerfQueryIdINTEL");
+        gl_ext.GetPerfQueryInfoINTEL = (PFNGLGETPERFQUERYINFOINTELPROC)load("glGetPerfQueryInfoINTEL");
+        gl_ext.GetPerfCounterInfoINTEL = (PFNGLGETPERFCOUNTERINFOINTELPROC)load("glGetPerfCounterInfoINTEL");
+        gl_ext.CreatePerfQueryINTEL = (PFNGLCREATEPERFQUERYINTELPROC)load("glCreatePerfQueryINTEL");
+        gl_ext.DeletePerfQueryINTEL = (PFNGLDELETEPERFQUERYINTELPROC)load("glDeletePerfQueryINTEL");
+        gl_ext.BeginPerfQueryINTEL = (PFNGLBEGINPERFQUERYINTELPROC)load("glBeginPerfQueryINTEL");
+        gl_ext.EndPerfQueryINTEL = (PFNGLENDPERFQUERYINTELPROC)load("glEndPerfQueryINTEL");
+        gl_ext.GetPerfQueryDataINTEL = (PFNGLGETPERFQUERYDATAINTELPROC)load("glGetPerfQueryDataINTEL");
+    }
+    gl_ext.INTEL_performance_query = gl_ext.GetFirstPerfQueryIdINTEL && gl_ext.GetNextPerfQueryIdINTEL
+        && gl_ext.GetPerfQueryInfoINTEL && gl_ext.GetPerfCounterInfoINTEL && gl_ext.CreatePerfQueryINTEL
+        && gl_ext.DeletePerfQueryINTEL && gl_ext.BeginPerfQueryINTEL && gl_ext.EndPerfQueryINTEL
+        && gl_ext.GetPerfQueryDataINTEL;
+
+    if (gl_ext_supported("GL_AMD_performance_monitor"))
+    {
+        gl_ext.GetPerfMonitorGroupsAMD = (PFNGLGETPERFMONITORGROUPSAMDPROC)load("glGetPerfMonitorGroupsAMD");
+        gl_ext.GetPerfMonitorCountersAMD = (PFNGLGETPERFMONITORCOUNTERSAMDPROC)load("glGetPerfMonitorCountersAMD");
+        gl_ext.GetPerfMonitorGroupStringAMD = (PFNGLGETPERFMONITORGROUPSTRINGAMDPROC)load("glGetPerfMonitorGroupStringAMD");
+        gl_ext.GetPerfMonitorCounterStringAMD =
+            (PFNGLGETPERFMONITORCOUNTERSTRINGAMDPROC)load("glGetPerfMonitorCounterStringAMD");
+        gl_ext.GetPerfMonitorCounterInfoAMD = (PFNGLGETPERFMONITORCOUNTERINFOAMDPROC)load("glGetPerfMonitorCounterInfoAMD");
+        gl_ext.GenPerfMonitorsAMD = (PFNGLGENPERFMONITORSAMDPROC)load("glGenPerfMonitorsAMD");
+        gl_ext.DeletePerfMonitorsAMD = (PFNGLDELETEPERFMONITORSAMDPROC)load("glDeletePerfMonitorsAMD");
+        gl_ext.SelectPerfMonitorCountersAMD = (PFNGLSELECTPERFMONITORCOUNTERSAMDPROC)load("glSelectPerfMonitorCountersAMD");
+        gl_ext.BeginPerfMonitorAMD = (PFNGLBEGINPERFMONITORAMDPROC)load("glBeginPerfMonitorAMD");
+        gl_ext.EndPerfMonitorAMD = (PFNGLENDPERFMONITORAMDPROC)load("glEndPerfMonitorAMD");
+        gl_ext.GetPerfMonitorCounterDataAMD = (PFNGLGETPERFMONITORCOUNTERDATAAMDPROC)load("glGetPerfMonitorCounterDataAMD");
+    }
+    gl_ext.AMD_performance_monitor = gl_ext.GetPerfMonitorGroupsAMD && gl_ext.GetPerfMonitorCountersAMD
+        && gl_ext.GetPerfMonitorGroupStringAMD && gl_ext.GetPerfMonitorCounterStringAMD
+        && gl_ext.GetPerfMonitorCounterInfoAMD && gl_ext.GenPerfMonitorsAMD && gl_ext.DeletePerfMonitorsAMD
+        && gl_ext.SelectPerfMonitorCountersAMD && gl_ext.BeginPerfMonitorAMD && gl_ext.EndPerfMonitorAMD
+        && gl_ext.GetPerfMonitorCounterDataAMD;
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Extensions the renderer uses on top of the glad core 4.6 loader (which was
+// generated without any extensions). Enums and entry points are declared here
+// and loaded by gl_ext_load right after gladLoadGL; every feature flag stays
+// false when the driver doesn't advertise the extension.
+//
+// On an OpenGL ES 3.x context (--gles) glad loads only what desktop GL had by
+// the matching 3.x, so gl_ext_load also loads the ES core entry points the
+// renderer calls that desktop GL only gained in 4.x (texture storage,
+// invalidation, compute, ...) into glad's pointers, and those of the ES
+// extensions standing in for desktop ones under their suffixed names. The
+// GLAD_GL_VERSION_4_x flags stay 0: what checks them stays off on ES.
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR           0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// GL_ARB_indirect_parameters (core in 4.6 with the same enums, without the ARB suffix)
+#define GL_PARAMETER_BUFFER_ARB 0x80EE
+
+// GL_EXT_texture_compression_s3tc (BC1-BC3) and its sRGB forms from GL_EXT_texture_sRGB
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT        0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT        0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT        0x83F3
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT  0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT  0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT  0x8C4F
+
+// GL_KHR_texture_compression_astc_ldr: the 14 block sizes are consecutive, 4x4 first, in both ranges
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR         0x93B0
+#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR 0x93D0
+
+// GL_KHR_shader_subgroup
+#define GL_SUBGROUP_SIZE_KHR                    0x9532
+#define GL_SUBGROUP_SUPPORTED_STAGES_KHR        0x9533
+#define GL_SUBGROUP_SUPPORTED_FEATURES_KHR      0x9534
+#define GL_SUBGROUP_FEATURE_BASIC_BIT_KHR       0x00000001
+#define GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR  0x00000004
+
+// GL_NV_shading_rate_image: a palette index per tile of the framebuffer picks its shading rate
+#define GL_SHADING_RATE_IMAGE_NV                        0x9563
+#define GL_SHADING_RATE_1_INVOCATION_PER_PIXEL_NV       0x9565
+#define GL_SHADING_RATE_1_INVOCATION_PER_1X2_PIXELS_NV  0x9566
+#define GL_SHADING_RATE_1_INVOCATION_PER_2X1_PIXELS_NV  0x9567
+#define GL_SHADING_RATE_1_INVOCATION_PER_2X2_PIXELS_NV  0x9568
+#define GL_SHADING_RATE_1_INVOCATION_PER_2X4_PIXELS_NV  0x9569
+#define GL_SHADING_RATE_1_INVOCATION_PER_4X2_PIXELS_NV  0x956A
+#define GL_SHADING_RATE_1_INVOCATION_PER_4X4_PIXELS_NV  0x956B
+#define GL_SHADING_RATE_IMAGE_TEXEL_WIDTH_NV            0x955C
+#define GL_SHADING_RATE_IMAGE_TEXEL_HEIGHT_NV           0x955D
+#define GL_SHADING_RATE_IMAGE_PALETTE_SIZE_NV           0x955E
+typedef void (APIENTRYP PFNGLBINDSHADINGRATEIMAGENVPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLSHADINGRATEIMAGEPALETTENVPROC)(GLuint viewport, GLuint first, GLsizei count, const GLenum* rates);
+typedef void (APIENTRYP PFNGLSHADINGRATEIMAGEBARRIERNVPROC)(GLboolean synchronize);
+
+// GL_ARB_bindless_texture (no enums needed: handles are plain 64-bit values)
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+// GL_ARB_sparse_texture: textures whose memory is committed a page at a time
+#define GL_TEXTURE_SPARSE_ARB                   0x91A6
+#define GL_VIRTUAL_PAGE_SIZE_INDEX_ARB          0x91A7
+#define GL_NUM_VIRTUAL_PAGE_SIZES_ARB           0x91A8
+#define GL_VIRTUAL_PAGE_SIZE_X_ARB              0x9195
+#define GL_VIRTUAL_PAGE_SIZE_Y_ARB              0x9196
+#define GL_VIRTUAL_PAGE_SIZE_Z_ARB              0x9197
+#define GL_MAX_SPARSE_ARRAY_TEXTURE_LAYERS_ARB  0x919A
+typedef void (APIENTRYP PFNGLTEXPAGECOMMITMENTARBPROC)(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+    GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLboolean commit);
+
+// GL_INTEL_performance_query: the driver's metric sets (Intel metrics-discovery on Windows, Mesa's on Linux)
+#define GL_PERFQUERY_SINGLE_CONTEXT_INTEL       0x00000000
+#define GL_PERFQUERY_DONOT_FLUSH_INTEL          0x83F9
+#define GL_PERFQUERY_COUNTER_EVENT_INTEL        0x94F0
+#define GL_PERFQUERY_COUNTER_DURATION_NORM_INTEL 0x94F1
+#define GL_PERFQUERY_COUNTER_DURATION_RAW_INTEL 0x94F2
+#define GL_PERFQUERY_COUNTER_THROUGHPUT_INTEL   0x94F3
+#define GL_PERFQUERY_COUNTER_RAW_INTEL          0x94F4
+#define GL_PERFQUERY_COUNTER_TIMESTAMP_INTEL    0x94F5
+#define GL_PERFQUERY_COUNTER_DATA_UINT32_INTEL  0x94F8
+#define GL_PERFQUERY_COUNTER_DATA_UINT64_INTEL  0x94F9
+#define GL_PERFQUERY_COUNTER_DATA_FLOAT_INTEL   0x94FA
+#define GL_PERFQUERY_COUNTER_DATA_DOUBLE_INTEL  0x94FB
+#define GL_PERFQUERY_COUNTER_DATA_BOOL32_INTEL  0x94FC
+typedef void (APIENTRYP PFNGLGETFIRSTPERFQUERYIDINTELPROC)(GLuint* queryId);
+typedef void (APIENTRYP PFNGLGETNEXTPERFQUERYIDINTELPROC)(GLuint queryId, GLuint* nextQueryId);
+typedef void (APIENTRYP PFNGLGETPERFQUERYINFOINTELPROC)(GLuint queryId, GLuint queryNameLength, GLchar* queryName,
+    GLuint* dataSize, GLuint* noCounters, GLuint* noInstances, GLuint* capsMask);
+typedef void (APIENTRYP PFNGLGETPERFCOUNTERINFOINTELPROC)(GLuint queryId, GLuint counterId, GLuint counterNameLength,
+    GLchar* counterName, GLuint counterDescLength, GLchar* counterDesc, GLuint* counterOffset, GLuint* counterDataSize,
+    GLuint* counterTypeEnum, GLuint* counterDataTypeEnum, GLuint64* rawCounterMaxValue);
+typedef void (APIENTRYP PFNGLCREATEPERFQUERYINTELPROC)(GLuint queryId, GLuint* queryHandle);
+typedef void (APIENTRYP PFNGLDELETEPERFQUERYINTELPROC)(GLuint queryHandle);
+typedef void (APIENTRYP PFNGLBEGINPERFQUERYINTELPROC)(GLuint queryHandle);
+typedef void (APIENTRYP PFNGLENDPERFQUERYINTELPROC)(GLuint queryHandle);
+typedef void (APIENTRYP PFNGLGETPERFQUERYDATAINTELPROC)(GLuint queryHandle, GLuint flags, GLsizei dataSize, void* data,
+    GLuint* bytesWritten);
+
+// GL_EXT_shader_pixel_local_storage (ES): per-pixel storage that stays in a tiled GPU's tile memory
+#define GL_MAX_SHADER_PIXEL_LOCAL_STORAGE_FAST_SIZE_EXT 0x8F63
+#define GL_SHADER_PIXEL_LOCAL_STORAGE_EXT               0x8F64
+#define GL_MAX_SHADER_PIXEL_LOCAL_STORAGE_SIZE_EXT      0x8F67
+
+// GL_AMD_performance_monitor: the hardware's counter groups (AMD's drivers, and Mesa's radeonsi and nouveau)
+#define GL_COUNTER_TYPE_AMD                     0x8BC0
+#define GL_UNSIGNED_INT64_AMD                   0x8BC2
+#define GL_PERCENTAGE_AMD                       0x8BC3
+#define GL_PERFMON_RESULT_AVAILABLE_AMD         0x8BC4
+#define GL_PERFMON_RESULT_SIZE_AMD              0x8BC5
+#define GL_PERFMON_RESULT_AMD                   0x8BC6
+typedef void (APIENTRYP PFNGLGETPERFMONITORGROUPSAMDPROC)(GLint* numGroups, GLsizei groupsSize, GLuint* groups);
+typedef void (APIENTRYP PFNGLGETPERFMONITORCOUNTERSAMDPROC)(GLuint group, GLint* numCounters, GLint* maxActiveCounters,
+    GLsizei counterSize, GLuint* counters);
+typedef void (APIENTRYP PFNGLGETPERFMONITORGROUPSTRINGAMDPROC)(GLuint group, GLsizei bufSize, GLsizei* length,
+    GLchar* groupString);
+typedef void (APIENTRYP PFNGLGETPERFMONITORCOUNTERSTRINGAMDPROC)(GLuint group, GLuint counter, GLsizei bufSize,
+    GLsizei* length, GLchar* counterString);
+typedef void (APIENTRYP PFNGLGETPERFMONITORCOUNTERINFOAMDPROC)(GLuint group, GLuint counter, GLenum pname, void* data);
+typedef void (APIENTRYP PFNGLGENPERFMONITORSAMDPROC)(GLsizei n, GLuint* monitors);
+typedef void (APIENTRYP PFNGLDELETEPERFMONITORSAMDPROC)(GLsizei n, GLuint* monitors);
+typedef void (APIENTRYP PFNGLSELECTPERFMONITORCOUNTERSAMDPROC)(GLuint monitor, GLboolean enable, GLuint group,
+    GLint numCounters, GLuint* counterList);
+typedef void (APIENTRYP PFNGLBEGINPERFMONITORAMDPROC)(GLuint monitor);
+typedef void (APIENTRYP PFNGLENDPERFMONITORAMDPROC)(GLuint monitor);
+typedef void (APIENTRYP PFNGLGETPERFMONITORCOUNTERDATAAMDPROC)(GLuint monitor, GLenum pname, GLsizei dataSize,
+    GLuint* data, GLint* bytesWritten);
+
+typedef struct GLExtensions
+{
+    bool es;                            // an OpenGL ES context (--gles)
+    int es_version;                     // its version: 300, 310 or 320; 0 on desktop GL
+    bool EXT_shader_pixel_local_storage;    // ES: the deferred G-buffer kept in tile memory (gl/lighting.h)
+    bool EXT_color_buffer_float;        // ES: float formats renderable (desktop: always); core in ES 3.2
+    bool KHR_parallel_shader_compile;   // also set for the ARB variant, which has the same enums
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreadsKHR;
+    bool ARB_indirect_parameters;       // also set on 4.6 contexts, pointing at the core entry point
+    PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC MultiDrawElementsIndirectCount;
+    bool ARB_texture_storage;           // or 4.2: immutable texture storage
+    PFNGLTEXSTORAGE2DPROC TexStorage2D;
+    PFNGLTEXSTORAGE3DPROC TexStorage3D; // texture arrays, from the same extension
+    bool ARB_copy_image;                // or 4.3: GPU copies between textures
+    PFNGLCOPYIMAGESUBDATAPROC CopyImageSubData;
+    bool EXT_texture_compression_s3tc;  // BC1-BC3 (RGTC's BC4/BC5 are core since 3.0)
+    bool ARB_texture_compression_bptc;  // or 4.2: BC6H, BC7
+    bool ARB_ES3_compatibility;         // or 4.3: ETC2 / EAC
+    bool KHR_texture_compression_astc_ldr;
+    bool ARB_bindless_texture;          // with the three entry points below
+    PFNGLGETTEXTUREHANDLEARBPROC GetTextureHandleARB;
+    PFNGLMAKETEXTUREHANDLERESIDENTARBPROC MakeTextureHandleResidentARB;
+    PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC MakeTextureHandleNonResidentARB;
+    bool NV_gpu_shader5;                // sampler handles may differ between the invocations of a draw
+    bool KHR_debug;                     // or 4.3: debug messages, object labels and debug groups (gl/gl_debug.h)
+    PFNGLDEBUGMESSAGECALLBACKPROC DebugMessageCallback;
+    PFNGLDEBUGMESSAGECONTROLPROC DebugMessageControl;
+    PFNGLOBJECTLABELPROC ObjectLabel;
+    PFNGLGETOBJECTLABELPROC GetObjectLabel;     // not required for KHR_debug: the leak audit's, where it's there
+    PFNGLPUSHDEBUGGROUPPROC PushDebugGroup;
+    PFNGLPOPDEBUGGROUPPROC PopDebugGroup;
+    bool ARB_separate_shader_objects;   // or 4.1: separable stage programs combined in pipeline objects
+    PFNGLPROGRAMPARAMETERIPROC ProgramParameteri;
+    PFNGLGENPROGRAMPIPELINESPROC GenProgramPipelines;
+    PFNGLDELETEPROGRAMPIPELINESPROC DeleteProgramPipelines;
+    PFNGLBINDPROGRAMPIPELINEPROC BindProgramPipeline;
+    PFNGLUSEPROGRAMSTAGESPROC UseProgramStages;
+    bool ARB_tessellation_shader;       // or 4.0: tessellation stages, drawing GL_PATCHES (gl/terrain_renderer.h)
+    PFNGLPATCHPARAMETERIPROC PatchParameteri;
+    bool ARB_clip_control;              // or 4.5, or ES's EXT_clip_control: a [0, 1] clip depth range, for reversed Z
+    PFNGLCLIPCONTROLPROC ClipControl;
+    bool ARB_invalidate_subdata;        // or 4.3: telling the driver an attachment's contents aren't needed
+    PFNGLINVALIDATEFRAMEBUFFERPROC InvalidateFramebuffer;
+    bool ARB_vertex_attrib_binding;     // or 4.3: attribute formats apart from the buffers they read (gl/vertex_format.h)
+    PFNGLVERTEXATTRIBFORMATPROC VertexAttribFormat;
+    PFNGLVERTEXATTRIBIFORMATPROC VertexAttribIFormat;
+    PFNGLVERTEXATTRIBBINDINGPROC VertexAttribBinding;
+    PFNGLBINDVERTEXBUFFERPROC BindVertexBuffer;
+    bool ARB_direct_state_access;       // or 4.5: buffers and vertex arrays created and edited by name (gl/gl_dsa.h)
+    PFNGLCREATEBUFFERSPROC CreateBuffers;
+    PFNGLNAMEDBUFFERDATAPROC NamedBufferData;
+    PFNGLNAMEDBUFFERSTORAGEPROC NamedBufferStorage;
+    PFNGLNAMEDBUFFERSUBDATAPROC NamedBufferSubData;
+    PFNGLCLEARNAMEDBUFFERSUBDATAPROC ClearNamedBufferSubData;
+    PFNGLCREATEVERTEXARRAYSPROC CreateVertexArrays;
+    bool NV_shading_rate_image;         // variable rate shading from an R8UI image of palette indices (gl/foveation.h)
+    PFNGLBINDSHADINGRATEIMAGENVPROC BindShadingRateImageNV;
+    PFNGLSHADINGRATEIMAGEPALETTENVPROC ShadingRateImagePaletteNV;
+    PFNGLSHADINGRATEIMAGEBARRIERNVPROC ShadingRateImageBarrierNV;
+    bool KHR_shader_subgroup;           // with basic and arithmetic operations in compute shaders (gl/gpu_primitives.h)
+    GLint subgroup_size;                // invocations in a subgroup; 0 without the extension
+    bool ARB_pipeline_statistics_query; // or 4.6: per-stage invocation counts (gl/gpu_profiler.h), the core enums
+    bool ARB_sparse_texture;            // with texture storage: layers committed as they're used (gl/virtual_texture.h)
+    PFNGLTEXPAGECOMMITMENTARBPROC TexPageCommitmentARB;
+    bool INTEL_performance_query;       // hardware counters in metric sets (gl/gpu_counters.h)
+    PFNGLGETFIRSTPERFQUERYIDINTELPROC GetFirstPerfQueryIdINTEL;
+    PFNGLGETNEXTPERFQUERYIDINTELPROC GetNextPerfQueryIdINTEL;
+    PFNGLGETPERFQUERYINFOINTELPROC GetPerfQueryInfoINTEL;
+    PFNGLGETPERFCOUNTERINFOINTELPROC GetPerfCounterInfoINTEL;
+    PFNGLCREATEPERFQUERYINTELPROC CreatePerfQueryINTEL;
+    PFNGLDELETEPERFQUERYINTELPROC DeletePerfQueryINTEL;
+    PFNGLBEGINPERFQUERYINTELPROC BeginPerfQueryINTEL;
+    PFNGLENDPERFQUERYINTELPROC EndPerfQueryINTEL;
+    PFNGLGETPERFQUERYDATAINTELPROC GetPerfQueryDataINTEL;
+    bool AMD_performance_monitor;       // hardware counters in groups (gl/gpu_counters.h)
+    PFNGLGETPERFMONITORGROUPSAMDPROC GetPerfMonitorGroupsAMD;
+    PFNGLGETPERFMONITORCOUNTERSAMDPROC GetPerfMonitorCountersAMD;
+    PFNGLGETPERFMONITORGROUPSTRINGAMDPROC GetPerfMonitorGroupStringAMD;
+    PFNGLGETPERFMONITORCOUNTERSTRINGAMDPROC GetPerfMonitorCounterStringAMD;
+    PFNGLGETPERFMONITORCOUNTERINFOAMDPROC GetPerfMonitorCounterInfoAMD;
+    PFNGLGENPERFMONITORSAMDPROC GenPerfMonitorsAMD;
+    PFNGLDELETEPERFMONITORSAMDPROC DeletePerfMonitorsAMD;
+    PFNGLSELECTPERFMONITORCOUNTERSAMDPROC SelectPerfMonitorCountersAMD;
+    PFNGLBEGINPERFMONITORAMDPROC BeginPerfMonitorAMD;
+    PFNGLENDPERFMONITORAMDPROC EndPerfMonitorAMD;
+    PFNGLGETPERFMONITORCOUNTERDATAAMDPROC GetPerfMonitorCounterDataAMD;
+} GLExtensions;
+
+extern GLExtensions gl_ext;
+
+// Fills gl_ext from the extension string and "load" (glfwGetProcAddress, eglGetProcAddress, ...)
+void gl_ext_load(GLADloadproc load);
+
+// True when the current context advertises "name" in its GL_EXTENSIONS list
+bool gl_ext_supported(const char* name);
@@ -0,0 +1,184 @@
+#include "gl/gl_memory.h"
+
+#include "gl/gl_ext.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX
+#define GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_MEMORY_NVX 0x9049
+#define GL_GPU_MEMORY_INFO_EVICTION_COUNT_NVX 0x904A
+#define GL_GPU_MEMORY_INFO_EVICTED_MEMORY_NVX 0x904B
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#endif
+
+GpuMemory gl_memory;
+static const bool gl_memory_ready = (gpu_memory_init(&gl_memory, 0), true);
+
+void gl_memory_buffer_at(GLuint buffer, GpuMemoryCategory category, size_t bytes, const char* site)
+{
+    gpu_memory_track_at(&gl_memory, GPU_MEMORY_BUFFER, buffer, category, bytes, site);
+}
+
+// Bytes per texel of an uncompressed format, or per block of a compressed one (with its block size); 0 for unknown
+static uint32_t format_size(GLenum format, uint32_t* block_width, uint32_t* block_height)
+{
+    *block_width = *block_height = 1;
+    switch (format)
+    {
+    case GL_R8:
+        return 1;
+    case GL_RG8: case GL_R16F: case GL_R16: case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_RG16: case GL_RG16F: case GL_R32F: case GL_R32UI: case GL_R11F_G11F_B10F:
+    case GL_RGB10_A2: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F: case GL_DEPTH24_STENCIL8:
+        return 4;
+    case GL_RGBA16F: case GL_RGBA16: case GL_RG32F: case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    }
+    *block_width = *block_height = 4;
+    switch (format)
+    {
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: case GL_COMPRESSED_RED_RGTC1:
+    case GL_COMPRESSED_RGB8_ETC2: case GL_COMPRESSED_SRGB8_ETC2:
+        return 8;
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: case GL_COMPRESSED_RG_RGTC2:
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT: case GL_COMPRESSED_RGBA_BPTC_UNORM: case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC: case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+        return 16;
+    }
+    // ASTC: always 16 bytes, over one of 14 block sizes
+    static const uint8_t astc[14][2] = { { 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 }, { 8, 8 },
+        { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 } };
+    GLenum first = 0;
+    if (format >= GL_COMPRESSED_RGBA_ASTC_4x4_KHR && format < GL_COMPRESSED_RGBA_ASTC_4x4_KHR + 14)
+        first = GL_COMPRESSED_RGBA_ASTC_4x4_KHR;
+    else if (format >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR && format < GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR + 14)
+        first = GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR;
+    if (!first)
+        return 0;
+    *block_width = astc[format - first][0];
+    *block_height = astc[format - first][1];
+    return 16;
+}
+
+uint64_t gl_memory_level_bytes(GLenum internal_format, GLsizei width, GLsizei height)
+{
+    uint32_t bw, bh;
+    const uint32_t size = format_size(internal_format, &bw, &bh);
+    const uint64_t w = width > 0 ? (uint64_t)width : 1, h = height > 0 ? (uint64_t)height : 1;
+    return (w + bw - 1) / bw * ((h + bh - 1) / bh) * size;
+}
+
+void gl_memory_texture_at(GLuint texture, GpuMemoryCategory category, GLenum internal_format, GLsizei width,
+    GLsizei height, GLsizei depth, GLsizei levels, GLsizei samples, const char* site)
+{
+    uint64_t bytes = 0;
+    for (GLsizei l = 0; l < (levels > 0 ? levels : 1); ++l)
+        bytes += gl_memory_level_bytes(internal_format, width >> l, height >> l);
+    bytes *= (uint64_t)(depth > 0 ? depth : 1) * (samples > 0 ? samples : 1);
+    gpu_memory_track_at(&gl_memory, GPU_MEMORY_TEXTURE, texture, category, bytes, site);
+}
+
+void gl_memory_texture_bytes_at(GLuint texture, GpuMemoryCategory category, uint64_t bytes, const char* site)
+{
+    gpu_memory_track_at(&gl_memory, GPU_MEMORY_TEXTURE, texture, category, bytes, site);
+}
+
+void gl_memory_renderbuffer_at(GLuint renderbuffer, GLenum internal_format, GLsizei width, GLsizei height,
+    GLsizei samples, const char* site)
+{
+    gpu_memory_track_at(&gl_memory, GPU_MEMORY_RENDERBUFFER, renderbuffer, GPU_MEMORY_RENDER_TARGETS,
+        gl_memory_level_bytes(internal_format, width, height) * (samples > 0 ? samples : 1), site);
+}
+
+void gl_memory_delete_renderbuffers(GLsizei count, const GLuint* renderbuffers)
+{
+    glDeleteRenderbuffers(count, renderbuffers);
+    for (GLsizei i = 0; i < count; ++i)
+        gpu_memory_forget(&gl_memory, GPU_MEMORY_RENDERBUFFER, renderbuffers[i]);
+}
+
+const char* gl_memory_site_name(const char* site)
+{
+    if (!site)
+        return "an unknown site";
+    // __FILE__ is whatever path the build gave the compiler: keep what follows its last "src" or the tree's root
+    const char* name = site;
+    for (const char* c = site; *c; ++c)
+    {
+        if ((*c == '/' || *c == '\\') && !strncmp(c + 1, "src", 3) && (c[4] == '/' || c[4] == '\\'))
+            name = c + 1;
+    }
+    if (name == site)
+    {
+        for (const char* c = site; *c; ++c)
+            name = *c == '/' || *c == '\\' ? c + 1 : name;
+    }
+    return name;
+}
+
+uint32_t gl_memory_audit(FILE* out)
+{
+    static const GLenum identifiers[3] = { GL_BUFFER, GL_TEXTURE, GL_RENDERBUFFER };
+    static const char* kinds[3] = { "buffer", "texture", "renderbuffer" };
+    const uint32_t count = gpu_memory_objects(&gl_memory, NULL, 0);
+    if (!count)
+        return 0;
+    GpuMemoryObject* objects = (GpuMemoryObject*)malloc(sizeof(GpuMemoryObject) * count);
+    const uint32_t listed = objects ? gpu_memory_objects(&gl_memory, objects, count) : 0;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < listed && i < count; ++i)
+        bytes += objects[i].bytes;
+    fprintf(out, "gl_memory: %u objects (%.1f MB) never deleted\n", count, bytes / 1048576.0);
+    for (uint32_t i = 0; i < listed && i < count; ++i)
+    {
+        const GpuMemoryObject* o = &objects[i];
+        const int kind = (int)(o->key >> 32);
+        const GLuint name = (GLuint)o->key;
+        char label[64] = "";
+        GLsizei length = 0;
+        if (gl_ext.GetObjectLabel && kind < 3)
+            gl_ext.GetObjectLabel(identifiers[kind], name, sizeof(label), &length, label);
+        fprintf(out, "  %s %u, %.1f KB of %s%s%s%s, from %s\n", kind < 3 ? kinds[kind] : "object", name,
+            o->bytes / 1024.0, gpu_memory_category_name(o->category), length ? " \"" : "", length ? label : "",
+            length ? "\"" : "", gl_memory_site_name(o->site));
+    }
+    free(objects);
+    return count;
+}
+
+bool gl_memory_query_driver(GpuMemoryDriver* driver)
+{
+    // The contexts share a driver, so one lookup does for all of them
+    static int nvx = -1, ati = -1;
+    if (nvx < 0)
+    {
+        nvx = gl_ext_supported("GL_NVX_gpu_memory_info");
+        ati = gl_ext_supported("GL_ATI_meminfo");
+    }
+    if (nvx)
+    {
+        GLint total_kb = 0, available_kb = 0, evictions = 0, evicted_kb = 0;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &total_kb);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_MEMORY_NVX, &available_kb);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_EVICTION_COUNT_NVX, &evictions);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_EVICTED_MEMORY_NVX, &evicted_kb);
+        *driver = { total_kb, available_kb, evicted_kb, evictions };
+        return true;
+    }
+    if (ati)
+    {
+        GLint free_kb[4] = { 0, 0, 0, 0 };     // total free, largest block, auxiliary free, largest auxiliary block
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, free_kb);
+        *driver = { -1, free_kb[0], -1, -1 };
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/gpu_memory.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// The app's video memory accounts (core/gpu_memory.h), fed from GL.
+//
+// There's one GpuMemory for the process, since the windows' and the upload
+// thread's contexts share their objects. Every glBufferData / glBufferStorage
+// and every texture or renderbuffer allocation reports its size here, named
+// by its object, and the gl_state_delete_* wrappers forget what they delete.
+// Texture sizes are worked out from the internal format, so compressed and
+// multisampled storage counts at what it really takes (give or take the
+// driver's padding).
+//
+// gl_memory_query_driver asks GL_NVX_gpu_memory_info or GL_ATI_meminfo for the
+// driver's view; the renderer passes it to gpu_memory_set_driver now and then.
+//
+// The calls below are macros that pass on the file and line they're made
+// from, so every object remembers where it was allocated. Whatever is still
+// accounted for once the renderer has torn everything down was leaked, and
+// gl_memory_audit lists it by that site and its debug label.
+
+extern GpuMemory gl_memory;
+
+#define GL_MEMORY_STRING(x) #x
+#define GL_MEMORY_LINE(x) GL_MEMORY_STRING(x)
+#define GL_MEMORY_SITE __FILE__ ":" GL_MEMORY_LINE(__LINE__)
+
+// A buffer of "bytes" (re)specified
+#define gl_memory_buffer(buffer, category, bytes) gl_memory_buffer_at(buffer, category, bytes, GL_MEMORY_SITE)
+void gl_memory_buffer_at(GLuint buffer, GpuMemoryCategory category, size_t bytes, const char* site);
+
+// A texture of "levels" mip levels from "width" x "height" x "depth" (layers for arrays, 1 otherwise), each texel
+// "samples" times
+#define gl_memory_texture(texture, category, internal_format, width, height, depth, levels, samples) \
+    gl_memory_texture_at(texture, category, internal_format, width, height, depth, levels, samples, GL_MEMORY_SITE)
+void gl_memory_texture_at(GLuint texture, GpuMemoryCategory category, GLenum internal_format, GLsizei width,
+    GLsizei height, GLsizei depth, GLsizei levels, GLsizei samples, const char* site);
+// One whose size is already known (the levels of a texture file)
+#define gl_memory_texture_bytes(texture, category, bytes) \
+    gl_memory_texture_bytes_at(texture, category, bytes, GL_MEMORY_SITE)
+void gl_memory_texture_bytes_at(GLuint texture, GpuMemoryCategory category, uint64_t bytes, const char* site);
+#define gl_memory_renderbuffer(renderbuffer, internal_format, width, height, samples) \
+    gl_memory_renderbuffer_at(renderbuffer, internal_format, width, height, samples, GL_MEMORY_SITE)
+void gl_memory_renderbuffer_at(GLuint renderbuffer, GLenum internal_format, GLsizei width, GLsizei height,
+    GLsizei samples, const char* site);
+// glDeleteRenderbuffers and forgets them
+void gl_memory_delete_renderbuffers(GLsizei count, const GLuint* renderbuffers);
+
+// Bytes of one "width" x "height" level in "internal_format": 0 for one it doesn't know
+uint64_t gl_memory_level_bytes(GLenum internal_format, GLsizei width, GLsizei height);
+
+// "site" (GL_MEMORY_SITE) from the source tree's root down: the build's own path to it dropped
+const char* gl_memory_site_name(const char* site);
+
+// At shutdown, with a context of the share group current and everything destroyed: one line to "out" per buffer,
+// texture and renderbuffer still accounted for, with its size, its debug label where GL_KHR_debug can read one
+// back, and where it was allocated. Returns how many there were.
+uint32_t gl_memory_audit(FILE* out);
+
+// The driver's numbers where it has either extension; false (and nothing written) otherwise. Needs a current
+// context; the extensions are looked up on the first call.
+bool gl_memory_query_driver(GpuMemoryDriver* driver);
@@ -0,0 +1,232 @@
+#include "gl/gl_resources.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_state.h"
+
+#include <string.h>
+
+static const char* type_names[GL_RESOURCE_TYPE_COUNT] = { "buffers", "vertex arrays", "programs", "textures" };
+static const char* type_name[GL_RESOURCE_TYPE_COUNT] = { "buffer", "vertex array", "program", "texture" };
+static const GLenum identifiers[GL_RESOURCE_TYPE_COUNT] = { GL_BUFFER, GL_VERTEX_ARRAY, GL_PROGRAM, GL_TEXTURE };
+
+#define GENERATION_MASK ((1u << GL_HANDLE_GENERATION_BITS) - 1u)
+
+static void delete_name(GLResourceType type, GLuint name)
+{
+    switch (type)
+    {
+    case GL_RESOURCE_BUFFER:
+        gl_state_delete_buffers(1, &name);
+        break;
+    case GL_RESOURCE_VERTEX_ARRAY:
+        gl_state_delete_vertex_arrays(1, &name);
+        break;
+    case GL_RESOURCE_PROGRAM:
+        glDeleteProgram(name);
+        break;
+    case GL_RESOURCE_TEXTURE:
+        gl_state_delete_textures(1, &name);
+        break;
+    default:
+        break;
+    }
+}
+
+void gl_resources_init(GLResources* res)
+{
+    memset(res, 0, sizeof(*res));
+    for (int t = 0; t < GL_RESOURCE_TYPE_COUNT; ++t)
+    {
+        GLResourcePool* pool = &res->pools[t];
+        for (uint32_t i = 0; i < GL_RESOURCE_POOL_SIZE; ++i)
+        {
+            pool->generations[i] = 1;
+            pool->next_free[i] = i + 1;
+        }
+        pool->free_head = 0;
+    }
+}
+
+// Deletes the oldest retired names up to (and including) those of frame "frame"
+static void delete_retired(GLResources* res, uint64_t frame)
+{
+    while (res->retired_count && res->retired[res->retired_head].frame <= frame)
+    {
+        const GLRetired* r = &res->retired[res->retired_head];
+        delete_name(r->type, r->name);
+        res->retired_head = (res->retired_head + 1) % GL_RESOURCE_MAX_RETIRED;
+        --res->retired_count;
+        ++res->deleted;
+    }
+}
+
+uint32_t gl_resources_destroy(GLResources* res, FILE* out)
+{
+    for (uint32_t f = 0; f < res->fence_count; ++f)
+        glDeleteSync(res->fences[(res->fence_head + f) % GL_RESOURCE_MAX_FENCES]);
+
+    // Nothing may be drawing with them anymore once the context is torn down
+    delete_retired(res, UINT64_MAX);
+    uint32_t leaked = 0;
+    for (int t = 0; t < GL_RESOURCE_TYPE_COUNT; ++t)
+    {
+        GLResourcePool* pool = &res->pools[t];
+        if (out && pool->live)
+            fprintf(out, "gl_resources: %u %s still registered at shutdown\n", pool->live, type_names[t]);
+        leaked += pool->live;
+        for (uint32_t i = 0; i < GL_RESOURCE_POOL_SIZE; ++i)
+        {
+            if (!pool->names[i])
+                continue;
+            if (out)
+                fprintf(out, "  %s %u%s%s%s, from %s\n", type_name[t], pool->names[i], pool->labels[i] ? " \"" : "",
+                    pool->labels[i] ? pool->labels[i] : "", pool->labels[i] ? "\"" : "",
+                    gl_memory_site_name(pool->sites[i]));
+            delete_name((GLResourceType)t, pool->names[i]);
+        }
+    }
+    memset(res, 0, sizeof(*res));
+    return leaked;
+}
+
+GLHandle gl_resources_add_at(GLResources* res, GLResourceType type, GLuint name, const char* site)
+{
+    GLResourcePool* pool = &res->pools[type];
+    if (!name)
+        return 0;
+    if (pool->free_head == GL_RESOURCE_POOL_SIZE)
+    {
+        fprintf(stderr, "gl_resources: more than %d %s\n", GL_RESOURCE_POOL_SIZE, type_names[type]);
+        delete_name(type, name);
+        return 0;
+    }
+    const uint32_t index = pool->free_head;
+    pool->free_head = pool->next_free[index];
+    pool->names[index] = name;
+    pool->labels[index] = NULL;
+    pool->sites[index] = site;
+    if (++pool->live > pool->peak)
+        pool->peak = pool->live;
+    return ((uint32_t)type << GL_HANDLE_TYPE_SHIFT) | ((uint32_t)pool->generations[index] << GL_HANDLE_INDEX_BITS) | index;
+}
+
+GLHandle gl_resources_create_at(GLResources* res, GLResourceType type, const char* site)
+{
+    GLuint name = 0;
+    switch (type)
+    {
+    case GL_RESOURCE_BUFFER:
+        glGenBuffers(1, &name);
+        break;
+    case GL_RESOURCE_VERTEX_ARRAY:
+        name = gl_dsa_create_vertex_array();
+        break;
+    case GL_RESOURCE_PROGRAM:
+        name = glCreateProgram();
+        break;
+    case GL_RESOURCE_TEXTURE:
+        glGenTextures(1, &name);
+        break;
+    default:
+        break;
+    }
+    return gl_resources_add_at(res, type, name, site);
+}
+
+void gl_resources_label(GLResources* res, GLHandle handle, const char* label)
+{
+    const GLuint name = gl_resources_get(res, handle);
+    if (!name)
+        return;
+    const GLResourceType type = gl_handle_type(handle);
+    res->pools[type].labels[handle & ((1u << GL_HANDLE_INDEX_BITS) - 1u)] = label;
+    gl_debug_label(identifiers[type], name, label);
+}
+
+void gl_resources_retire(GLResources* res, GLResourceType type, GLuint name)
+{
+    if (!name)
+        return;
+    if (res->retired_count == GL_RESOURCE_MAX_RETIRED)
+    {
+        // GL still keeps the object alive for commands in flight; only the name can come back early
+        delete_name(type, name);
+        ++res->deleted_early;
+        return;
+    }
+    GLRetired* r = &res->retired[(res->retired_head + res->retired_count) % GL_RESOURCE_MAX_RETIRED];
+    r->frame = res->frame;
+    r->type = type;
+    r->name = name;
+    ++res->retired_count;
+    ++res->frame_retired;
+}
+
+void gl_resources_release(GLResources* res, GLHandle handle)
+{
+    const GLuint name = gl_resources_get(res, handle);
+    if (!name)
+        return;
+    const GLResourceType type = gl_handle_type(handle);
+    GLResourcePool* pool = &res->pools[type];
+    const uint32_t index = handle & ((1u << GL_HANDLE_INDEX_BITS) - 1u);
+    pool->names[index] = 0;
+    pool->labels[index] = NULL;
+    pool->sites[index] = NULL;
+    const uint32_t generation = pool->generations[index] + 1u;
+    pool->generations[index] = (uint16_t)(generation > GENERATION_MASK ? 1 : generation);    // skips 0
+    pool->next_free[index] = pool->free_head;
+    pool->free_head = index;
+    --pool->live;
+    gl_resources_retire(res, type, name);
+}
+
+void gl_resources_end_frame(GLResources* res)
+{
+    if (res->frame_retired)
+    {
+        if (res->fence_count == GL_RESOURCE_MAX_FENCES)
+        {
+            // Too many frames in flight: wait for the oldest one
+            GLsync oldest = res->fences[res->fence_head];
+            while (glClientWaitSync(oldest, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(oldest);
+            delete_retired(res, res->fence_frames[res->fence_head]);
+            res->fence_head = (res->fence_head + 1) % GL_RESOURCE_MAX_FENCES;
+            --res->fence_count;
+        }
+        const uint32_t slot = (res->fence_head + res->fence_count) % GL_RESOURCE_MAX_FENCES;
+        res->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        res->fence_frames[slot] = res->frame;
+        ++res->fence_count;
+        res->frame_retired = 0;
+    }
+    ++res->frame;
+
+    // Frames finish in order: stop at the first fence that hasn't signalled
+    while (res->fence_count)
+    {
+        GLsync oldest = res->fences[res->fence_head];
+        const GLenum status = glClientWaitSync(oldest, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync(oldest);
+        delete_retired(res, res->fence_frames[res->fence_head]);
+        res->fence_head = (res->fence_head + 1) % GL_RESOURCE_MAX_FENCES;
+        --res->fence_count;
+    }
+}
+
+void gl_resources_print(const GLResources* res, FILE* out)
+{
+    fprintf(out, "gl resources      live       peak\n");
+    for (int t = 0; t < GL_RESOURCE_TYPE_COUNT; ++t)
+    {
+        if (res->pools[t].peak)
+            fprintf(out, "  %-13s %7u %10u\n", type_names[t], res->pools[t].live, res->pools[t].peak);
+    }
+    fprintf(out, "  %llu deleted after their frame's fence, %llu early, %u pending\n", (unsigned long long)res->deleted,
+        (unsigned long long)res->deleted_early, res->retired_count);
+}
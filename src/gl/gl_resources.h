@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/gl_memory.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Registry of the GL objects a context owns, addressed by generational handles.
+//
+// Each object type has a fixed pool of slots with a free list, so creating
+// and releasing objects never touches the heap. A handle packs the type, the
+// slot index and the slot's generation. Lookup is one array read plus a
+// generation compare, and a handle kept after its object was released
+// resolves to 0 instead of to whatever reused the slot.
+//
+// Releasing is deferred: the GL name goes on a retire list tagged with the
+// current frame, and gl_resources_end_frame fences every frame that retired
+// something. Names are deleted once their frame's fence has signalled, so a
+// frame still in flight never has its buffers, textures or programs deleted
+// underneath it (no implicit driver sync, no early name reuse).
+// gl_resources_destroy deletes everything still registered and reports it
+// as a leak, each object by its label (gl_resources_label) and the file and
+// line that registered it.
+//
+// Like gl_state, a registry belongs to one context and the thread that has it current.
+
+#define GL_RESOURCE_POOL_SIZE   1024    // slots per type
+#define GL_RESOURCE_MAX_RETIRED 1024    // names waiting for their frame's fence
+#define GL_RESOURCE_MAX_FENCES  8       // frames in flight with something retired
+
+typedef uint32_t GLHandle;              // 0 is never a valid handle
+
+typedef enum GLResourceType
+{
+    GL_RESOURCE_BUFFER,
+    GL_RESOURCE_VERTEX_ARRAY,
+    GL_RESOURCE_PROGRAM,
+    GL_RESOURCE_TEXTURE,
+    GL_RESOURCE_TYPE_COUNT
+} GLResourceType;
+
+//   bit 31  30 29          20 19                0
+//       [type] [ generation ] [    slot index    ]
+#define GL_HANDLE_INDEX_BITS      20
+#define GL_HANDLE_GENERATION_BITS 10
+#define GL_HANDLE_TYPE_SHIFT      (GL_HANDLE_INDEX_BITS + GL_HANDLE_GENERATION_BITS)
+
+typedef struct GLResourcePool
+{
+    GLuint names[GL_RESOURCE_POOL_SIZE];
+    const char* labels[GL_RESOURCE_POOL_SIZE];      // gl_resources_label's, NULL for none
+    const char* sites[GL_RESOURCE_POOL_SIZE];       // GL_MEMORY_SITE of the call that registered it
+    uint16_t generations[GL_RESOURCE_POOL_SIZE];    // never 0, so no live handle is 0
+    uint32_t next_free[GL_RESOURCE_POOL_SIZE];
+    uint32_t free_head;                             // GL_RESOURCE_POOL_SIZE: pool full
+    uint32_t live;
+    uint32_t peak;
+} GLResourcePool;
+
+typedef struct GLRetired
+{
+    uint64_t frame;             // serial of the frame that released it
+    GLResourceType type;
+    GLuint name;
+} GLRetired;
+
+typedef struct GLResources
+{
+    GLResourcePool pools[GL_RESOURCE_TYPE_COUNT];
+    GLRetired retired[GL_RESOURCE_MAX_RETIRED];     // ring, oldest first
+    uint32_t retired_head;
+    uint32_t retired_count;
+    GLsync fences[GL_RESOURCE_MAX_FENCES];          // ring, oldest first
+    uint64_t fence_frames[GL_RESOURCE_MAX_FENCES];
+    uint32_t fence_head;
+    uint32_t fence_count;
+    uint64_t frame;             // serial of the frame being recorded
+    uint64_t frame_retired;     // retires since the last fence
+    uint64_t deleted;           // names deleted after their fence
+    uint64_t deleted_early;     // names deleted right away: retire list full
+} GLResources;
+
+void gl_resources_init(GLResources* res);
+
+// Deletes everything: retired names and the ones still registered (reported as leaks to "out" when not NULL, one
+// line each). Returns how many were still registered.
+uint32_t gl_resources_destroy(GLResources* res, FILE* out);
+
+// Takes ownership of "name" (from glGen* / glCreateProgram). Logs, deletes the name and returns 0 when the
+// type's pool is full. The macros record the caller's file and line for the leak report.
+#define gl_resources_add(res, type, name) gl_resources_add_at(res, type, name, GL_MEMORY_SITE)
+GLHandle gl_resources_add_at(GLResources* res, GLResourceType type, GLuint name, const char* site);
+
+// glGen* + gl_resources_add
+#define gl_resources_create_buffer(res) gl_resources_create_at(res, GL_RESOURCE_BUFFER, GL_MEMORY_SITE)
+#define gl_resources_create_vertex_array(res) gl_resources_create_at(res, GL_RESOURCE_VERTEX_ARRAY, GL_MEMORY_SITE)
+#define gl_resources_create_texture(res) gl_resources_create_at(res, GL_RESOURCE_TEXTURE, GL_MEMORY_SITE)
+GLHandle gl_resources_create_at(GLResources* res, GLResourceType type, const char* site);
+
+// Names the object: "label" (a string that outlives it) for the leak report, and for debug tools through
+// gl/gl_debug.h. Stale handles are ignored.
+void gl_resources_label(GLResources* res, GLHandle handle, const char* label);
+
+static inline GLResourceType gl_handle_type(GLHandle handle)
+{
+    return (GLResourceType)(handle >> GL_HANDLE_TYPE_SHIFT);
+}
+
+// The GL name, or 0 when the handle is stale or 0
+static inline GLuint gl_resources_get(const GLResources* res, GLHandle handle)
+{
+    const uint32_t index = handle & ((1u << GL_HANDLE_INDEX_BITS) - 1u);
+    const uint32_t generation = (handle >> GL_HANDLE_INDEX_BITS) & ((1u << GL_HANDLE_GENERATION_BITS) - 1u);
+    const GLResourcePool* pool = &res->pools[gl_handle_type(handle)];
+    return handle && index < GL_RESOURCE_POOL_SIZE && pool->generations[index] == generation ? pool->names[index] : 0;
+}
+
+// Invalidates the handle at once and deletes its object once the frames using it are done. Stale handles
+// are ignored.
+void gl_resources_release(GLResources* res, GLHandle handle);
+
+// Deferred deletion for a name that was never registered (owned by a module with its own bookkeeping)
+void gl_resources_retire(GLResources* res, GLResourceType type, GLuint name);
+
+// Call after the frame's last command: fences the frame if it retired anything, then deletes every name
+// whose fence has signalled. Never blocks unless GL_RESOURCE_MAX_FENCES frames are still in flight.
+void gl_resources_end_frame(GLResources* res);
+
+// Per type: live and peak slots, plus how deletions went
+void gl_resources_print(const GLResources* res, FILE* out);
@@ -0,0 +1,357 @@
+#include "gl/gl_state.h"
+
+#include "core/hitch_detector.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+
+#include <string.h>
+
+thread_local GLState gl_state;
+
+static const GLenum buffer_targets[GL_STATE_BUFFER_COUNT] = {
+    GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER, GL_DRAW_INDIRECT_BUFFER,
+    GL_PARAMETER_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER,
+};
+
+static const GLenum capabilities[GL_STATE_CAP_COUNT] = {
+    GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST, GL_FRAMEBUFFER_SRGB,
+};
+
+static const char* call_names[GL_STATE_CALL_COUNT] = {
+    "program", "pipeline", "vertex array", "buffer", "buffer range", "texture", "enable", "blend", "depth", "viewport", "framebuffer",
+};
+
+static int buffer_slot(GLenum target)
+{
+    for (int i = 0; i < GL_STATE_BUFFER_COUNT; ++i)
+    {
+        if (buffer_targets[i] == target)
+            return i;
+    }
+    return -1;
+}
+
+static int capability_slot(GLenum capability)
+{
+    for (int i = 0; i < GL_STATE_CAP_COUNT; ++i)
+    {
+        if (capabilities[i] == capability)
+            return i;
+    }
+    return -1;
+}
+
+// Counts the call and returns true when it has to be issued
+static bool changed(GLStateCall call, bool differs)
+{
+    ++(differs ? gl_state.issued : gl_state.filtered)[call];
+    return differs;
+}
+
+static void forget_range(GLStateRange* range)
+{
+    range->buffer = GL_STATE_UNKNOWN;
+    range->offset = 0;
+    range->size = 0;
+}
+
+void gl_state_reset(void)
+{
+    GLState* s = &gl_state;
+    s->program = GL_STATE_UNKNOWN;
+    s->program_pipeline = GL_STATE_UNKNOWN;
+    s->vertex_array = GL_STATE_UNKNOWN;
+    for (int i = 0; i < GL_STATE_BUFFER_COUNT; ++i)
+        s->buffers[i] = GL_STATE_UNKNOWN;
+    for (int i = 0; i < GL_STATE_BUFFER_INDICES; ++i)
+    {
+        forget_range(&s->uniform_ranges[i]);
+        forget_range(&s->storage_ranges[i]);
+    }
+    s->active_texture = GL_STATE_UNKNOWN;
+    for (int i = 0; i < GL_STATE_TEXTURE_UNITS; ++i)
+        s->textures[i] = GL_STATE_UNKNOWN;
+    memset(s->capabilities, -1, sizeof(s->capabilities));
+    s->blend_src = s->blend_dst = GL_STATE_UNKNOWN;
+    s->depth_func = GL_STATE_UNKNOWN;
+    s->depth_mask = GL_STATE_UNKNOWN;
+    s->colour_mask = GL_STATE_UNKNOWN;
+    s->viewport_known = false;
+    s->read_framebuffer = s->draw_framebuffer = GL_STATE_UNKNOWN;
+}
+
+void gl_state_use_program(GLuint program)
+{
+    if (changed(GL_STATE_CALL_PROGRAM, gl_state.program != program))
+    {
+        glUseProgram(program);
+        gl_state.program = program;
+        if (gl_state.hitches)
+            hitch_detector_program(gl_state.hitches, program);
+    }
+}
+
+void gl_state_bind_program_pipeline(GLuint pipeline)
+{
+    if (changed(GL_STATE_CALL_PROGRAM_PIPELINE, gl_state.program_pipeline != pipeline))
+    {
+        gl_ext.BindProgramPipeline(pipeline);
+        gl_state.program_pipeline = pipeline;
+        if (gl_state.hitches)
+            hitch_detector_program(gl_state.hitches, pipeline | HITCH_PIPELINE);
+    }
+}
+
+void gl_state_bind_vertex_array(GLuint vertex_array)
+{
+    if (changed(GL_STATE_CALL_VERTEX_ARRAY, gl_state.vertex_array != vertex_array))
+    {
+        glBindVertexArray(vertex_array);
+        gl_state.vertex_array = vertex_array;
+        gl_state.buffers[GL_STATE_BUFFER_ELEMENT_ARRAY] = GL_STATE_UNKNOWN;   // whatever the new VAO holds
+    }
+}
+
+void gl_state_bind_buffer(GLenum target, GLuint buffer)
+{
+    const int slot = buffer_slot(target);
+    if (changed(GL_STATE_CALL_BUFFER, slot < 0 || gl_state.buffers[slot] != buffer))
+    {
+        glBindBuffer(target, buffer);
+        if (slot >= 0)
+            gl_state.buffers[slot] = buffer;
+    }
+}
+
+static GLStateRange* indexed_range(GLenum target, GLuint index)
+{
+    if (index >= GL_STATE_BUFFER_INDICES)
+        return NULL;
+    if (target == GL_UNIFORM_BUFFER)
+        return &gl_state.uniform_ranges[index];
+    if (target == GL_SHADER_STORAGE_BUFFER)
+        return &gl_state.storage_ranges[index];
+    return NULL;
+}
+
+// Indexed binds also replace the target's generic binding
+static void bound_indexed(GLenum target, GLStateRange* range, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    const int slot = buffer_slot(target);
+    if (slot >= 0)
+        gl_state.buffers[slot] = buffer;
+    if (range)
+    {
+        range->buffer = buffer;
+        range->offset = offset;
+        range->size = size;
+    }
+}
+
+void gl_state_bind_buffer_base(GLenum target, GLuint index, GLuint buffer)
+{
+    GLStateRange* range = indexed_range(target, index);
+    if (changed(GL_STATE_CALL_BUFFER_RANGE, !range || range->buffer != buffer || range->size != -1))
+    {
+        glBindBufferBase(target, index, buffer);
+        bound_indexed(target, range, buffer, 0, -1);
+    }
+}
+
+void gl_state_bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    GLStateRange* range = indexed_range(target, index);
+    if (changed(GL_STATE_CALL_BUFFER_RANGE, !range || range->buffer != buffer || range->offset != offset || range->size != size))
+    {
+        glBindBufferRange(target, index, buffer, offset, size);
+        bound_indexed(target, range, buffer, offset, size);
+    }
+}
+
+void gl_state_bind_texture(GLuint unit, GLenum target, GLuint texture)
+{
+    if (gl_state.active_texture != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        gl_state.active_texture = unit;
+    }
+    const bool tracked = target == GL_TEXTURE_2D && unit < GL_STATE_TEXTURE_UNITS;
+    if (changed(GL_STATE_CALL_TEXTURE, !tracked || gl_state.textures[unit] != texture))
+    {
+        glBindTexture(target, texture);
+        if (tracked)
+            gl_state.textures[unit] = texture;
+    }
+}
+
+void gl_state_enable(GLenum capability, bool enable)
+{
+    const int slot = capability_slot(capability);
+    if (changed(GL_STATE_CALL_CAPABILITY, slot < 0 || gl_state.capabilities[slot] != (signed char)enable))
+    {
+        if (enable)
+            glEnable(capability);
+        else
+            glDisable(capability);
+        if (slot >= 0)
+            gl_state.capabilities[slot] = (signed char)enable;
+    }
+}
+
+void gl_state_blend_func(GLenum src, GLenum dst)
+{
+    if (changed(GL_STATE_CALL_BLEND, gl_state.blend_src != src || gl_state.blend_dst != dst))
+    {
+        glBlendFunc(src, dst);
+        gl_state.blend_src = src;
+        gl_state.blend_dst = dst;
+    }
+}
+
+void gl_state_depth_func(GLenum func)
+{
+    if (changed(GL_STATE_CALL_DEPTH, gl_state.depth_func != func))
+    {
+        glDepthFunc(func);
+        gl_state.depth_func = func;
+    }
+}
+
+void gl_state_depth_mask(bool write)
+{
+    const GLuint mask = write ? GL_TRUE : GL_FALSE;
+    if (changed(GL_STATE_CALL_DEPTH, gl_state.depth_mask != mask))
+    {
+        glDepthMask((GLboolean)mask);
+        gl_state.depth_mask = mask;
+    }
+}
+
+void gl_state_colour_mask(bool write)
+{
+    const GLuint mask = write ? GL_TRUE : GL_FALSE;
+    if (changed(GL_STATE_CALL_BLEND, gl_state.colour_mask != mask))
+    {
+        glColorMask((GLboolean)mask, (GLboolean)mask, (GLboolean)mask, (GLboolean)mask);
+        gl_state.colour_mask = mask;
+    }
+}
+
+void gl_state_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLint* v = gl_state.viewport;
+    if (changed(GL_STATE_CALL_VIEWPORT, !gl_state.viewport_known || v[0] != x || v[1] != y || v[2] != width || v[3] != height))
+    {
+        glViewport(x, y, width, height);
+        v[0] = x;
+        v[1] = y;
+        v[2] = width;
+        v[3] = height;
+        gl_state.viewport_known = true;
+    }
+}
+
+void gl_state_bind_framebuffer(GLenum target, GLuint framebuffer)
+{
+    const bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    const bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    if (changed(GL_STATE_CALL_FRAMEBUFFER, (read && gl_state.read_framebuffer != framebuffer)
+        || (draw && gl_state.draw_framebuffer != framebuffer)))
+    {
+        glBindFramebuffer(target, framebuffer);
+        if (read)
+            gl_state.read_framebuffer = framebuffer;
+        if (draw)
+            gl_state.draw_framebuffer = framebuffer;
+    }
+}
+
+// A deleted name that was bound reverts to 0 in GL; the cache follows
+static void forget_name(GLuint* cached, GLuint name)
+{
+    if (*cached == name)
+        *cached = 0;
+}
+
+void gl_state_delete_buffers(GLsizei count, const GLuint* buffers)
+{
+    glDeleteBuffers(count, buffers);
+    for (GLsizei n = 0; n < count; ++n)
+    {
+        if (!buffers[n])
+            continue;
+        gpu_memory_forget(&gl_memory, GPU_MEMORY_BUFFER, buffers[n]);
+        for (int i = 0; i < GL_STATE_BUFFER_COUNT; ++i)
+            forget_name(&gl_state.buffers[i], buffers[n]);
+        for (int i = 0; i < GL_STATE_BUFFER_INDICES; ++i)
+        {
+            if (gl_state.uniform_ranges[i].buffer == buffers[n])
+                forget_range(&gl_state.uniform_ranges[i]);
+            if (gl_state.storage_ranges[i].buffer == buffers[n])
+                forget_range(&gl_state.storage_ranges[i]);
+        }
+    }
+}
+
+void gl_state_delete_textures(GLsizei count, const GLuint* textures)
+{
+    glDeleteTextures(count, textures);
+    for (GLsizei n = 0; n < count; ++n)
+    {
+        gpu_memory_forget(&gl_memory, GPU_MEMORY_TEXTURE, textures[n]);
+        for (int i = 0; textures[n] && i < GL_STATE_TEXTURE_UNITS; ++i)
+            forget_name(&gl_state.textures[i], textures[n]);
+    }
+}
+
+void gl_state_delete_vertex_arrays(GLsizei count, const GLuint* vertex_arrays)
+{
+    glDeleteVertexArrays(count, vertex_arrays);
+    for (GLsizei n = 0; n < count; ++n)
+    {
+        if (vertex_arrays[n] && gl_state.vertex_array == vertex_arrays[n])
+        {
+            gl_state.vertex_array = 0;
+            gl_state.buffers[GL_STATE_BUFFER_ELEMENT_ARRAY] = GL_STATE_UNKNOWN;
+        }
+    }
+}
+
+void gl_state_delete_program_pipelines(GLsizei count, const GLuint* pipelines)
+{
+    gl_ext.DeleteProgramPipelines(count, pipelines);
+    for (GLsizei n = 0; n < count; ++n)
+    {
+        if (pipelines[n] && gl_state.program_pipeline == pipelines[n])
+            gl_state.program_pipeline = 0;
+    }
+}
+
+void gl_state_delete_framebuffers(GLsizei count, const GLuint* framebuffers)
+{
+    glDeleteFramebuffers(count, framebuffers);
+    for (GLsizei n = 0; n < count; ++n)
+    {
+        if (!framebuffers[n])
+            continue;
+        forget_name(&gl_state.read_framebuffer, framebuffers[n]);
+        forget_name(&gl_state.draw_framebuffer, framebuffers[n]);
+    }
+}
+
+void gl_state_print(FILE* out)
+{
+    uint64_t issued = 0, filtered = 0;
+    fprintf(out, "gl state          issued   filtered\n");
+    for (int i = 0; i < GL_STATE_CALL_COUNT; ++i)
+    {
+        if (!gl_state.issued[i] && !gl_state.filtered[i])
+            continue;
+        fprintf(out, "  %-13s %10llu %10llu\n", call_names[i],
+            (unsigned long long)gl_state.issued[i], (unsigned long long)gl_state.filtered[i]);
+        issued += gl_state.issued[i];
+        filtered += gl_state.filtered[i];
+    }
+    fprintf(out, "  %-13s %10llu %10llu (%.1f%% filtered)\n", "total", (unsigned long long)issued,
+        (unsigned long long)filtered, issued + filtered ? 100.0 * filtered / (double)(issued + filtered) : 0.0);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Shadow copy of the GL binding and pipeline state, so calls that would set
+// what is already set never reach the driver. Each thread has its own copy:
+// GL state belongs to the context, and this app keeps each context current on
+// one thread only.
+//
+// Everything that changes tracked state must go through here. That covers the
+// program and program pipeline, VAO, generic and indexed buffer bindings, GL_TEXTURE_2D per unit,
+// the enables below, blend, depth and colour write state, the viewport and framebuffers. A
+// raw call behind the cache's back makes it skip a bind it shouldn't. When
+// that can't be avoided (third-party code), gl_state_reset afterwards.
+// Deleting a bound object unbinds it, so deletes go through the
+// gl_state_delete_* wrappers (which also drop buffers and textures from
+// gl/gl_memory.h's accounts); programs need none, since one stays in use
+// (and keeps its name) until another replaces it.
+//
+// The element array binding is VAO state: it's forgotten whenever the VAO changes.
+//
+// With a core/hitch_detector.h set in "hitches", every program and pipeline
+// bind that reaches GL is reported to it.
+
+#define GL_STATE_TEXTURE_UNITS  16
+#define GL_STATE_BUFFER_INDICES 16  // indexed uniform / shader storage bindings tracked per target
+
+typedef enum GLStateCall
+{
+    GL_STATE_CALL_PROGRAM,
+    GL_STATE_CALL_PROGRAM_PIPELINE,
+    GL_STATE_CALL_VERTEX_ARRAY,
+    GL_STATE_CALL_BUFFER,
+    GL_STATE_CALL_BUFFER_RANGE,
+    GL_STATE_CALL_TEXTURE,
+    GL_STATE_CALL_CAPABILITY,
+    GL_STATE_CALL_BLEND,
+    GL_STATE_CALL_DEPTH,
+    GL_STATE_CALL_VIEWPORT,
+    GL_STATE_CALL_FRAMEBUFFER,
+    GL_STATE_CALL_COUNT
+} GLStateCall;
+
+// Generic buffer binding points that are tracked; any other target goes straight through
+typedef enum GLStateBuffer
+{
+    GL_STATE_BUFFER_ARRAY,
+    GL_STATE_BUFFER_ELEMENT_ARRAY,
+    GL_STATE_BUFFER_UNIFORM,
+    GL_STATE_BUFFER_SHADER_STORAGE,
+    GL_STATE_BUFFER_DRAW_INDIRECT,
+    GL_STATE_BUFFER_PARAMETER,
+    GL_STATE_BUFFER_COPY_READ,
+    GL_STATE_BUFFER_COPY_WRITE,
+    GL_STATE_BUFFER_PIXEL_PACK,
+    GL_STATE_BUFFER_PIXEL_UNPACK,
+    GL_STATE_BUFFER_COUNT
+} GLStateBuffer;
+
+// Enables that are tracked (gl_state_enable); others go straight through
+typedef enum GLStateCapability
+{
+    GL_STATE_CAP_BLEND,
+    GL_STATE_CAP_DEPTH_TEST,
+    GL_STATE_CAP_CULL_FACE,
+    GL_STATE_CAP_SCISSOR_TEST,
+    GL_STATE_CAP_STENCIL_TEST,
+    GL_STATE_CAP_FRAMEBUFFER_SRGB,
+    GL_STATE_CAP_COUNT
+} GLStateCapability;
+
+typedef struct GLStateRange
+{
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;        // -1: the whole buffer (glBindBufferBase)
+} GLStateRange;
+
+// Unknown values hold GL_STATE_UNKNOWN (or -1 for the enables), so the next call always goes through
+#define GL_STATE_UNKNOWN 0xFFFFFFFFu
+
+typedef struct GLState
+{
+    GLuint program;
+    GLuint program_pipeline;
+    GLuint vertex_array;
+    GLuint buffers[GL_STATE_BUFFER_COUNT];
+    GLStateRange uniform_ranges[GL_STATE_BUFFER_INDICES];
+    GLStateRange storage_ranges[GL_STATE_BUFFER_INDICES];
+    GLuint active_texture;                      // unit index, not GL_TEXTUREi
+    GLuint textures[GL_STATE_TEXTURE_UNITS];    // GL_TEXTURE_2D per unit
+    signed char capabilities[GL_STATE_CAP_COUNT];
+    GLenum blend_src, blend_dst;
+    GLenum depth_func;
+    GLuint depth_mask;                          // GL_TRUE / GL_FALSE / GL_STATE_UNKNOWN
+    GLuint colour_mask;                         // all four channels alike: GL_TRUE / GL_FALSE / GL_STATE_UNKNOWN
+    GLint viewport[4];
+    bool viewport_known;
+    GLuint read_framebuffer, draw_framebuffer;
+
+    struct HitchDetector* hitches;              // told of the binds that reach GL; NULL for none (kept by gl_state_reset)
+
+    uint64_t issued[GL_STATE_CALL_COUNT];       // calls passed on to GL
+    uint64_t filtered[GL_STATE_CALL_COUNT];     // calls dropped because nothing would change
+} GLState;
+
+extern thread_local GLState gl_state;
+
+// Forgets every tracked value (counters are kept). Call after making a context current on a thread, and
+// after any code that changed state without going through the cache.
+void gl_state_reset(void);
+
+void gl_state_use_program(GLuint program);
+
+// glBindProgramPipeline (GL_ARB_separate_shader_objects). It only takes effect while no program is in use.
+void gl_state_bind_program_pipeline(GLuint pipeline);
+void gl_state_bind_vertex_array(GLuint vertex_array);
+void gl_state_bind_buffer(GLenum target, GLuint buffer);
+void gl_state_bind_buffer_base(GLenum target, GLuint index, GLuint buffer);
+void gl_state_bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+// Binds "texture" to "target" on texture unit "unit" (an index, not GL_TEXTUREi); leaves "unit" active
+void gl_state_bind_texture(GLuint unit, GLenum target, GLuint texture);
+
+// glEnable / glDisable
+void gl_state_enable(GLenum capability, bool enable);
+void gl_state_blend_func(GLenum src, GLenum dst);
+void gl_state_depth_func(GLenum func);
+void gl_state_depth_mask(bool write);
+
+// glColorMask with every channel the same; counted with the blend calls
+void gl_state_colour_mask(bool write);
+void gl_state_viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+// GL_FRAMEBUFFER sets both the read and the draw binding
+void gl_state_bind_framebuffer(GLenum target, GLuint framebuffer);
+
+// glDelete* that also clear the cache's references to the deleted names
+void gl_state_delete_buffers(GLsizei count, const GLuint* buffers);
+void gl_state_delete_textures(GLsizei count, const GLuint* textures);
+void gl_state_delete_vertex_arrays(GLsizei count, const GLuint* vertex_arrays);
+void gl_state_delete_program_pipelines(GLsizei count, const GLuint* pipelines);
+void gl_state_delete_framebuffers(GLsizei count, const GLuint* framebuffers);
+
+// Issued / filtered counts per kind of call, for this thread
+void gl_state_print(FILE* out);
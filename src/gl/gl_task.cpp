@@ -0,0 +1,8 @@
+#include "gl/gl_task.h"
+
+bool gl_fence_signalled(void* fence)
+{
+    // The flush bit only flushes when the fence hasn't been yet, so a fence nobody flushed still signals
+    const GLenum status = glClientWaitSync((GLsync)fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "core/task.h"
+
+#include <glad/glad.h>
+
+// The GL side of core/task.h: co_await task_gl_fence(s, fence) resumes a
+// task once the GPU has passed "fence" (an upload it made has landed, a
+// readback is ready). The fence is tested without blocking at each poll, so
+// the scheduler that waits on one has to be pumped on the thread holding the
+// GL context. The task still owns the fence and deletes it afterwards.
+
+// Whether the GLsync in "fence" has signalled; flushes the commands before it the first time it's tested
+bool gl_fence_signalled(void* fence);
+
+static inline TaskUntil task_gl_fence(TaskScheduler* s, GLsync fence)
+{
+    return task_until(s, gl_fence_signalled, (void*)fence);
+}
@@ -0,0 +1,123 @@
+#include "gl/gpu_animation.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+#include "gl/uniforms.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// The shader's uniforms, at the locations its GLSL gives them rather than looked up by name
+enum
+{
+    ANIMATION_LOCATION_SCALE = 0
+};
+
+// One invocation per object. The matrix is gpu_culling's: mat3x4_translate_rotate_Z's as a std430 mat3x4 (our rows
+// are its columns). Time is the Frame block's w, the fixed-step simulation's clock, so the motion keeps to real
+// time however fast frames come.
+static const char* animation_shader_text =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+"layout(std140) uniform Frame\n"
+"{\n"
+"    vec4 time;\n"
+"};\n"
+"layout(std430, binding = 0) readonly buffer Motions { vec4 motions[]; };\n"    // 2 per InstanceMotion
+"layout(std430, binding = 1) writeonly buffer Instances { mat3x4 instances[]; };\n"
+"layout(location = 0) uniform float scale;\n"
+"void main()\n"
+"{\n"
+"    uint i = gl_GlobalInvocationID.x;\n"
+"    if (i >= uint(instances.length()))\n"
+"        return;\n"
+"    vec4 a = motions[2u * i];\n"
+"    vec4 b = motions[2u * i + 1u];\n"
+"    float t = time.w;\n"
+"    float orbit = b.y * t + a.z;\n"
+"    vec2 p = a.xy + b.x * vec2(cos(orbit), sin(orbit));\n"
+"    p.y += b.z * sin(b.w * t + a.z);\n"
+"    float s = scale * sin(a.w * t + a.z);\n"
+"    float c = scale * cos(a.w * t + a.z);\n"
+"    instances[i] = mat3x4(vec4(c, -s, 0.0, p.x), vec4(s, c, 0.0, p.y), vec4(0.0, 0.0, scale, 0.0));\n"
+"}\n";
+
+bool gpu_animation_init(GpuAnimation* a, const InstanceMotion* motions, uint32_t count, float scale,
+    const uint32_t* materials, bool objects)
+{
+    a->program = 0;
+    a->motion_buffer = a->instance_buffer = 0;
+    a->material_offset = a->object_offset = 0;
+    a->count = count;
+    a->scale = scale;
+
+    GLuint shader = shader_compile(GL_COMPUTE_SHADER, animation_shader_text);
+    a->program = program_link(&shader, 1, false);
+    if (!a->program)
+    {
+        fprintf(stderr, "gpu_animation: can't build the animation compute shader\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, a->program, "animate");
+    uniforms_bind_blocks(a->program);
+
+    a->motion_buffer = gl_dsa_create_buffer(sizeof(InstanceMotion) * count, motions, GL_STATIC_DRAW);
+    gl_memory_buffer(a->motion_buffer, GPU_MEMORY_STORAGE, sizeof(InstanceMotion) * count);
+    gl_debug_label(GL_BUFFER, a->motion_buffer, "animation motions");
+
+    // The matrices are written by the GPU only; the indices after them once, here. The matrices' length is the
+    // shader's object count, so the SSBO binding covers them alone.
+    GLsizeiptr bytes = sizeof(float) * 12 * count;
+    if (materials)
+    {
+        a->material_offset = bytes;
+        bytes += sizeof(GLuint) * count;
+    }
+    if (objects)
+    {
+        a->object_offset = bytes;
+        bytes += sizeof(GLuint) * count;
+    }
+    a->instance_buffer = gl_dsa_create_buffer(bytes, NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(a->instance_buffer, GPU_MEMORY_STORAGE, bytes);
+    gl_debug_label(GL_BUFFER, a->instance_buffer, "animated instances");
+    if (materials)
+        gl_dsa_buffer_sub_data(a->instance_buffer, a->material_offset, sizeof(GLuint) * count, materials);
+    if (objects)
+    {
+        GLuint* index = (GLuint*)malloc(sizeof(GLuint) * count);
+        for (uint32_t i = 0; index && i < count; ++i)
+            index[i] = i;
+        if (index)
+            gl_dsa_buffer_sub_data(a->instance_buffer, a->object_offset, sizeof(GLuint) * count, index);
+        free(index);
+    }
+    return true;
+}
+
+void gpu_animation_destroy(GpuAnimation* a)
+{
+    gl_state_delete_buffers(1, &a->instance_buffer);
+    gl_state_delete_buffers(1, &a->motion_buffer);
+    if (a->program)
+        glDeleteProgram(a->program);
+    a->program = 0;
+    a->motion_buffer = a->instance_buffer = 0;
+}
+
+void gpu_animation_dispatch(const GpuAnimation* a)
+{
+    gl_state_use_program(a->program);
+    glUniform1f(ANIMATION_LOCATION_SCALE, a->scale);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, a->motion_buffer);
+    gl_state_bind_buffer_range(GL_SHADER_STORAGE_BUFFER, 1, a->instance_buffer, 0, sizeof(float) * 12 * a->count);
+    glDispatchCompute((a->count + GPU_ANIMATION_GROUP_SIZE - 1) / GPU_ANIMATION_GROUP_SIZE, 1, 1);
+    draw_counters_dispatch();
+
+    // The instanced draw sources its vModel attributes from instance_buffer
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
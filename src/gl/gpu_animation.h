@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stdint.h>
+
+// GPU-side instance animation (needs a 4.3 context): every object's motion is
+// a closed-form function of time, described once by a few parameters that go
+// up to a shader storage buffer at start. Each frame one compute dispatch
+// evaluates it for every object at the simulated time the Frame uniform
+// block carries (time.w), and writes the model matrices straight into the
+// instance buffer the instanced draw reads. The CPU neither transforms nor
+// uploads anything per object: its part of a frame is a dispatch.
+//
+// The material and object indices an instance draws with don't change, so
+// they go into the same buffer once, after the matrices, for the vMaterial
+// and vObject attributes to read.
+
+#define GPU_ANIMATION_GROUP_SIZE 64     // objects per work group (local_size_x in the shader)
+
+// One object's motion, laid out as the shader's two vec4s. Every term applies at once: an object spins about
+// its centre while that centre circles and bobs around its rest position. A zero rate or radius drops the term.
+typedef struct InstanceMotion
+{
+    float x, y;                 // rest position, in the grid's plane
+    float phase;                // radians added to every term's angle, so the copies don't move in lockstep
+    float spin_rate;            // radians per second about z
+    float orbit_radius;         // the centre circles the rest position at this distance
+    float orbit_rate;           // radians per second
+    float bob_amplitude;        // and swings along y this far either side
+    float bob_rate;             // radians per second
+} InstanceMotion;
+
+typedef struct GpuAnimation
+{
+    GLuint program;             // the animation compute shader
+    GLuint motion_buffer;       // SSBO: InstanceMotion per object
+    GLuint instance_buffer;     // mat3x4 per object, then the materials and object indices below
+    GLintptr material_offset;   // uint material index per object in instance_buffer; 0 without materials
+    GLintptr object_offset;     // uint object index per object in instance_buffer; 0 without
+    uint32_t count;
+    float scale;
+} GpuAnimation;
+
+// Uploads the motions and builds the compute program. "materials" (NULL: none) is each object's material index;
+// "objects" stores each object's own index too, for the ID buffer. Logs and returns false when the program fails
+// to build.
+bool gpu_animation_init(GpuAnimation* a, const InstanceMotion* motions, uint32_t count, float scale,
+    const uint32_t* materials, bool objects);
+void gpu_animation_destroy(GpuAnimation* a);
+
+// Writes every object's matrix for the time in the Frame block bound at UNIFORMS_BINDING_FRAME, leaving the
+// compute program in use. Draws that read instance_buffer after it see the new matrices.
+void gpu_animation_dispatch(const GpuAnimation* a);
@@ -0,0 +1,353 @@
+#include "gl/gpu_counters.h"
+
+#if GPU_COUNTERS
+
+#include "gl/gl_ext.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Whether "name" contains "fragment" ("length" characters of it), ignoring case
+static bool contains(const char* name, const char* fragment, size_t length)
+{
+    for (; *name; ++name)
+    {
+        size_t i = 0;
+        while (i < length && name[i] && tolower((unsigned char)name[i]) == tolower((unsigned char)fragment[i]))
+            ++i;
+        if (i == length)
+            return true;
+    }
+    return false;
+}
+
+// Whether "name" matches any fragment of the comma-separated "names"
+static bool matches(const char* name, const char* names)
+{
+    while (*names)
+    {
+        const char* end = strchr(names, ',');
+        const size_t length = end ? (size_t)(end - names) : strlen(names);
+        if (length && contains(name, names, length))
+            return true;
+        if (!end)
+            break;
+        names = end + 1;
+    }
+    return false;
+}
+
+// Intel: the set with the most matching counters, and those counters
+static bool init_intel(GpuCounters* c, const char* names)
+{
+    int best = 0;
+    GLuint id = 0;
+    gl_ext.GetFirstPerfQueryIdINTEL(&id);
+    for (; id; gl_ext.GetNextPerfQueryIdINTEL(id, &id))
+    {
+        GLchar set[GPU_COUNTERS_NAME_SIZE] = "";
+        GLuint data_size = 0, counter_count = 0, instances = 0, caps = 0;
+        gl_ext.GetPerfQueryInfoINTEL(id, sizeof(set), set, &data_size, &counter_count, &instances, &caps);
+        GpuCounter found[GPU_COUNTERS_MAX];
+        int n = 0;
+        // Counter IDs start at 1
+        for (GLuint k = 1; k <= counter_count && n < GPU_COUNTERS_MAX; ++k)
+        {
+            GpuCounter* counter = &found[n];
+            GLchar description[8];
+            GLuint size = 0, type = 0;
+            GLuint64 max = 0;
+            gl_ext.GetPerfCounterInfoINTEL(id, k, sizeof(counter->name), counter->name, sizeof(description),
+                description, &counter->offset, &size, &type, &counter->type, &max);
+            if (type == GL_PERFQUERY_COUNTER_TIMESTAMP_INTEL || counter->type == GL_PERFQUERY_COUNTER_DATA_BOOL32_INTEL
+                || !matches(counter->name, names))
+                continue;
+            counter->rate = type == GL_PERFQUERY_COUNTER_DURATION_NORM_INTEL
+                || type == GL_PERFQUERY_COUNTER_THROUGHPUT_INTEL;
+            counter->group = 0;
+            counter->id = k;
+            ++n;
+        }
+        if (n > best)
+        {
+            best = n;
+            memcpy(c->counters, found, sizeof(GpuCounter) * n);
+            c->count = n;
+            c->query_id = id;
+            c->data_size = data_size;
+            snprintf(c->set, sizeof(c->set), "%s", set);
+        }
+    }
+    return c->count > 0;
+}
+
+// AMD: matching counters from any group, as many of each group's as it can run at once
+static bool init_amd(GpuCounters* c, const char* names)
+{
+    GLint group_count = 0;
+    gl_ext.GetPerfMonitorGroupsAMD(&group_count, 0, NULL);
+    if (group_count <= 0)
+        return false;
+    GLuint* groups = (GLuint*)malloc(sizeof(GLuint) * group_count);
+    if (!groups)
+        return false;
+    gl_ext.GetPerfMonitorGroupsAMD(NULL, group_count, groups);
+    c->data_size = 0;
+    for (GLint g = 0; g < group_count && c->count < GPU_COUNTERS_MAX; ++g)
+    {
+        GLint counter_count = 0, max_active = 0;
+        gl_ext.GetPerfMonitorCountersAMD(groups[g], &counter_count, &max_active, 0, NULL);
+        if (counter_count <= 0)
+            continue;
+        GLuint* ids = (GLuint*)malloc(sizeof(GLuint) * counter_count);
+        if (!ids)
+            continue;
+        gl_ext.GetPerfMonitorCountersAMD(groups[g], NULL, NULL, counter_count, ids);
+        char group_name[32] = "";
+        gl_ext.GetPerfMonitorGroupStringAMD(groups[g], sizeof(group_name), NULL, group_name);
+        int active = 0;
+        for (GLint k = 0; k < counter_count && active < max_active && c->count < GPU_COUNTERS_MAX; ++k)
+        {
+            char counter_name[GPU_COUNTERS_NAME_SIZE] = "";
+            gl_ext.GetPerfMonitorCounterStringAMD(groups[g], ids[k], sizeof(counter_name), NULL, counter_name);
+            GpuCounter* counter = &c->counters[c->count];
+            snprintf(counter->name, sizeof(counter->name), "%s/%s", group_name, counter_name);
+            if (!matches(counter->name, names))
+                continue;
+            GLenum type = 0;
+            gl_ext.GetPerfMonitorCounterInfoAMD(groups[g], ids[k], GL_COUNTER_TYPE_AMD, &type);
+            counter->rate = type == GL_PERCENTAGE_AMD;
+            counter->type = type;
+            counter->group = groups[g];
+            counter->id = ids[k];
+            counter->offset = 0;
+            c->data_size += sizeof(GLuint) * 2 + sizeof(uint64_t);     // group, counter, value
+            ++c->count;
+            ++active;
+        }
+        free(ids);
+    }
+    free(groups);
+    return c->count > 0;
+}
+
+bool gpu_counters_init(GpuCounters* c, const char* names)
+{
+    memset(c, 0, sizeof(*c));
+    if (!names)
+        names = GPU_COUNTERS_DEFAULT;
+    if (gl_ext.INTEL_performance_query && init_intel(c, names))
+        c->backend = GPU_COUNTERS_INTEL;
+    else if (gl_ext.AMD_performance_monitor && init_amd(c, names))
+        c->backend = GPU_COUNTERS_AMD;
+    else
+    {
+        if (!gl_ext.INTEL_performance_query && !gl_ext.AMD_performance_monitor)
+            fprintf(stderr, "gpu_counters: the driver has neither GL_INTEL_performance_query nor "
+                "GL_AMD_performance_monitor\n");
+        else
+            fprintf(stderr, "gpu_counters: no counter matches \"%s\" (--gpu-counters list shows them)\n", names);
+        memset(c, 0, sizeof(*c));
+        return false;
+    }
+    c->data = malloc(c->data_size);
+    if (!c->data)
+    {
+        fprintf(stderr, "gpu_counters: out of memory\n");
+        memset(c, 0, sizeof(*c));
+        return false;
+    }
+    return true;
+}
+
+void gpu_counters_destroy(GpuCounters* c)
+{
+    for (int slot = 0; slot < GPU_COUNTERS_SLOTS; ++slot)
+    {
+        if (c->backend == GPU_COUNTERS_INTEL)
+        {
+            for (int i = 0; i < c->created[slot]; ++i)
+                gl_ext.DeletePerfQueryINTEL(c->samples[slot][i]);
+        }
+        else if (c->backend == GPU_COUNTERS_AMD && c->created[slot])
+            gl_ext.DeletePerfMonitorsAMD(c->created[slot], c->samples[slot]);
+    }
+    // The names stay: a trace written after this still refers to them
+    free(c->data);
+    c->data = NULL;
+    memset(c->created, 0, sizeof(c->created));
+    c->backend = GPU_COUNTERS_NONE;
+}
+
+void gpu_counters_list(FILE* out)
+{
+    if (gl_ext.INTEL_performance_query)
+    {
+        GLuint id = 0;
+        gl_ext.GetFirstPerfQueryIdINTEL(&id);
+        for (; id; gl_ext.GetNextPerfQueryIdINTEL(id, &id))
+        {
+            GLchar set[GPU_COUNTERS_NAME_SIZE] = "";
+            GLuint data_size = 0, counter_count = 0, instances = 0, caps = 0;
+            gl_ext.GetPerfQueryInfoINTEL(id, sizeof(set), set, &data_size, &counter_count, &instances, &caps);
+            fprintf(out, "%s:\n", set);
+            for (GLuint k = 1; k <= counter_count; ++k)
+            {
+                GLchar name[GPU_COUNTERS_NAME_SIZE] = "", description[256] = "";
+                GLuint offset = 0, size = 0, type = 0, data_type = 0;
+                GLuint64 max = 0;
+                gl_ext.GetPerfCounterInfoINTEL(id, k, sizeof(name), name, sizeof(description), description, &offset,
+                    &size, &type, &data_type, &max);
+                fprintf(out, "  %-40s %s\n", name, description);
+            }
+        }
+    }
+    else if (gl_ext.AMD_performance_monitor)
+    {
+        GLint group_count = 0;
+        gl_ext.GetPerfMonitorGroupsAMD(&group_count, 0, NULL);
+        GLuint* groups = group_count > 0 ? (GLuint*)malloc(sizeof(GLuint) * group_count) : NULL;
+        if (!groups)
+            return;
+        gl_ext.GetPerfMonitorGroupsAMD(NULL, group_count, groups);
+        for (GLint g = 0; g < group_count; ++g)
+        {
+            GLint counter_count = 0, max_active = 0;
+            gl_ext.GetPerfMonitorCountersAMD(groups[g], &counter_count, &max_active, 0, NULL);
+            char group_name[32] = "";
+            gl_ext.GetPerfMonitorGroupStringAMD(groups[g], sizeof(group_name), NULL, group_name);
+            fprintf(out, "%s (%d at once):\n", group_name, max_active);
+            GLuint* ids = counter_count > 0 ? (GLuint*)malloc(sizeof(GLuint) * counter_count) : NULL;
+            if (!ids)
+                continue;
+            gl_ext.GetPerfMonitorCountersAMD(groups[g], NULL, NULL, counter_count, ids);
+            for (GLint k = 0; k < counter_count; ++k)
+            {
+                char name[GPU_COUNTERS_NAME_SIZE] = "";
+                gl_ext.GetPerfMonitorCounterStringAMD(groups[g], ids[k], sizeof(name), NULL, name);
+                fprintf(out, "  %s\n", name);
+            }
+            free(ids);
+        }
+        free(groups);
+    }
+    else
+        fprintf(out, "gpu_counters: the driver has neither GL_INTEL_performance_query nor GL_AMD_performance_monitor\n");
+}
+
+// A sample's query or monitor, made the first time it's used: most frames use only a few
+static GLuint sample_handle(GpuCounters* c, int slot, int sample)
+{
+    while (c->created[slot] <= sample)
+    {
+        GLuint* handle = &c->samples[slot][c->created[slot]++];
+        if (c->backend == GPU_COUNTERS_INTEL)
+            gl_ext.CreatePerfQueryINTEL(c->query_id, handle);
+        else
+        {
+            gl_ext.GenPerfMonitorsAMD(1, handle);
+            for (int k = 0; k < c->count; ++k)
+                gl_ext.SelectPerfMonitorCountersAMD(*handle, GL_TRUE, c->counters[k].group, 1, &c->counters[k].id);
+        }
+    }
+    return c->samples[slot][sample];
+}
+
+void gpu_counters_begin(GpuCounters* c, int slot, int sample)
+{
+    if (c->backend == GPU_COUNTERS_INTEL)
+        gl_ext.BeginPerfQueryINTEL(sample_handle(c, slot, sample));
+    else if (c->backend == GPU_COUNTERS_AMD)
+        gl_ext.BeginPerfMonitorAMD(sample_handle(c, slot, sample));
+}
+
+void gpu_counters_end(GpuCounters* c, int slot, int sample)
+{
+    if (c->backend == GPU_COUNTERS_INTEL)
+        gl_ext.EndPerfQueryINTEL(c->samples[slot][sample]);
+    else if (c->backend == GPU_COUNTERS_AMD)
+        gl_ext.EndPerfMonitorAMD(c->samples[slot][sample]);
+}
+
+// A value of Intel's result data, of GL_PERFQUERY_COUNTER_DATA_* "type"
+static double intel_value(const unsigned char* data, GLuint type)
+{
+    switch (type)
+    {
+    case GL_PERFQUERY_COUNTER_DATA_UINT32_INTEL: { uint32_t v; memcpy(&v, data, sizeof(v)); return v; }
+    case GL_PERFQUERY_COUNTER_DATA_UINT64_INTEL: { uint64_t v; memcpy(&v, data, sizeof(v)); return (double)v; }
+    case GL_PERFQUERY_COUNTER_DATA_FLOAT_INTEL: { float v; memcpy(&v, data, sizeof(v)); return v; }
+    case GL_PERFQUERY_COUNTER_DATA_DOUBLE_INTEL: { double v; memcpy(&v, data, sizeof(v)); return v; }
+    default: return 0.0;
+    }
+}
+
+bool gpu_counters_read(GpuCounters* c, int slot, int sample, double* values)
+{
+    if (sample >= c->created[slot])
+        return false;
+    const GLuint handle = c->samples[slot][sample];
+    if (c->backend == GPU_COUNTERS_INTEL)
+    {
+        // Nothing is written until the result is in
+        GLuint written = 0;
+        gl_ext.GetPerfQueryDataINTEL(handle, GL_PERFQUERY_DONOT_FLUSH_INTEL, (GLsizei)c->data_size, c->data, &written);
+        if (!written)
+            return false;
+        for (int k = 0; k < c->count; ++k)
+            values[k] = intel_value((const unsigned char*)c->data + c->counters[k].offset, c->counters[k].type);
+        return true;
+    }
+    if (c->backend != GPU_COUNTERS_AMD)
+        return false;
+
+    GLuint available = 0;
+    gl_ext.GetPerfMonitorCounterDataAMD(handle, GL_PERFMON_RESULT_AVAILABLE_AMD, sizeof(available), &available, NULL);
+    if (!available)
+        return false;
+    GLint written = 0;
+    gl_ext.GetPerfMonitorCounterDataAMD(handle, GL_PERFMON_RESULT_AMD, (GLsizei)c->data_size, (GLuint*)c->data,
+        &written);
+    // (group, counter, value) records, the value's size going by the counter's type
+    for (int k = 0; k < c->count; ++k)
+        values[k] = 0.0;
+    const unsigned char* data = (const unsigned char*)c->data;
+    GLint at = 0;
+    while (at + (GLint)sizeof(GLuint) * 2 < written)
+    {
+        GLuint group, id;
+        memcpy(&group, data + at, sizeof(group));
+        memcpy(&id, data + at + sizeof(GLuint), sizeof(id));
+        at += sizeof(GLuint) * 2;
+        int k = 0;
+        while (k < c->count && (c->counters[k].group != group || c->counters[k].id != id))
+            ++k;
+        if (k == c->count)
+            break;      // can't know the size of a value we didn't ask for
+        if (c->counters[k].type == GL_UNSIGNED_INT64_AMD)
+        {
+            uint64_t v;
+            memcpy(&v, data + at, sizeof(v));
+            values[k] = (double)v;
+            at += sizeof(v);
+        }
+        else if (c->counters[k].type == GL_FLOAT || c->counters[k].type == GL_PERCENTAGE_AMD)
+        {
+            float v;
+            memcpy(&v, data + at, sizeof(v));
+            values[k] = v;
+            at += sizeof(v);
+        }
+        else
+        {
+            GLuint v;
+            memcpy(&v, data + at, sizeof(v));
+            values[k] = v;
+            at += sizeof(v);
+        }
+    }
+    return true;
+}
+
+#endif
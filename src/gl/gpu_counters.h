@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Hardware GPU counters (cache hits and misses, shader occupancy, memory
+// bandwidth, unit busy time) sampled per profiler pass, for the deep dives
+// the timings and pipeline statistics can't explain.
+//
+// They come through the driver's GL extensions rather than a vendor SDK:
+// GL_INTEL_performance_query, which Intel's Windows driver serves from
+// metrics-discovery and Mesa from its own metric sets, and
+// GL_AMD_performance_monitor, which AMD's drivers (the counters GPA reads)
+// and Mesa's radeonsi and nouveau have. NVIDIA's driver has neither, and
+// its counters are only reachable through the Nsight Perf SDK, which isn't
+// linked here: Nsight Graphics captures already name the passes by their
+// debug groups (gl/gl_debug.h).
+//
+// Counters are picked by name: a list of comma-separated fragments, each
+// matched case-insensitively against every counter the driver offers, up to
+// GPU_COUNTERS_MAX. Intel's counters come in metric sets of which only one
+// can run at a time, so the set matching the most fragments is used; AMD's
+// come in groups, each with a limit on how many of its counters run at once.
+//
+// The profiler (gl/gpu_profiler.h) drives the sampling: like its pipeline
+// statistics, a sample can't nest, so one runs for each stretch of a frame
+// between pushes and pops and is credited to the innermost pass. Counts add
+// up over a pass's samples; rates and percentages are averaged over them,
+// weighted by each sample's GPU time. Results are read back with the
+// timestamps, GPU_PROFILER_LATENCY frames later, without waiting.
+//
+// Only built into profiling builds: with GPU_COUNTERS 0 (the default;
+// -DOPENGLTEST_GPU_COUNTERS=ON, which the Profile preset sets, makes it 1)
+// gpu_counters_init reports the counters unavailable and the rest are
+// empty inline functions.
+
+#ifndef GPU_COUNTERS
+#define GPU_COUNTERS 0
+#endif
+
+#define GPU_COUNTERS_MAX 16             // counters sampled at once
+#define GPU_COUNTERS_NAME_SIZE 64
+#define GPU_COUNTERS_SLOTS 4            // frames in flight, GPU_PROFILER_LATENCY
+#define GPU_COUNTERS_SAMPLES 64         // per frame, GPU_PROFILER_MAX_SEGMENTS
+
+// What's sampled when no names are given
+#define GPU_COUNTERS_DEFAULT "busy,active,occupancy,stall,hit,miss,bandwidth,throughput"
+
+typedef enum GpuCountersBackend
+{
+    GPU_COUNTERS_NONE,
+    GPU_COUNTERS_INTEL,     // GL_INTEL_performance_query
+    GPU_COUNTERS_AMD,       // GL_AMD_performance_monitor
+} GpuCountersBackend;
+
+typedef struct GpuCounter
+{
+    char name[GPU_COUNTERS_NAME_SIZE];  // AMD's as "group/counter"
+    bool rate;                  // a rate or percentage, averaged over a pass; otherwise a count, added up
+    GLuint group, id;           // AMD: group and counter; Intel: counter index
+    GLuint offset, type;        // Intel: where in the query's data, and its GL_PERFQUERY_COUNTER_DATA_*
+} GpuCounter;
+
+typedef struct GpuCounters
+{
+    GpuCountersBackend backend;
+    GpuCounter counters[GPU_COUNTERS_MAX];
+    int count;
+    char set[GPU_COUNTERS_NAME_SIZE];   // Intel: the metric set
+    GLuint query_id;                    // Intel: the set's query
+    GLuint data_size;                   // Intel: bytes of one result; AMD: the largest a result can be
+    void* data;                         // a result's worth of scratch
+    GLuint samples[GPU_COUNTERS_SLOTS][GPU_COUNTERS_SAMPLES];   // query handles or monitors
+    int created[GPU_COUNTERS_SLOTS];    // of them, made so far
+} GpuCounters;
+
+#if GPU_COUNTERS
+
+// Picks the backend and the counters matching "names" (GPU_COUNTERS_DEFAULT for NULL). False, with the reason on
+// stderr, when the driver has no counters or none match.
+bool gpu_counters_init(GpuCounters* c, const char* names);
+
+// Deletes the queries; the counters' names stay valid, for the trace's counter events
+void gpu_counters_destroy(GpuCounters* c);
+
+// Every counter the driver offers, one per line, with its set or group
+void gpu_counters_list(FILE* out);
+
+// Starts and ends sample "sample" of frame slot "slot"; one may be running at a time
+void gpu_counters_begin(GpuCounters* c, int slot, int sample);
+void gpu_counters_end(GpuCounters* c, int slot, int sample);
+
+// Sample "sample"'s values, one per counter: false while they aren't in yet
+bool gpu_counters_read(GpuCounters* c, int slot, int sample, double* values);
+
+#else
+
+static inline bool gpu_counters_init(GpuCounters* c, const char*)
+{
+    c->backend = GPU_COUNTERS_NONE;
+    c->count = 0;
+    fprintf(stderr, "gpu_counters: built without them (configure with -DOPENGLTEST_GPU_COUNTERS=ON)\n");
+    return false;
+}
+static inline void gpu_counters_destroy(GpuCounters*) {}
+static inline void gpu_counters_list(FILE* out)
+{
+    fprintf(out, "gpu_counters: built without them (configure with -DOPENGLTEST_GPU_COUNTERS=ON)\n");
+}
+static inline void gpu_counters_begin(GpuCounters*, int, int) {}
+static inline void gpu_counters_end(GpuCounters*, int, int) {}
+static inline bool gpu_counters_read(GpuCounters*, int, int, double*) { return false; }
+
+#endif
@@ -0,0 +1,266 @@
+#include "gl/gpu_culling.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// The culling shader's uniforms, at the locations its GLSL gives them rather than looked up by name
+enum
+{
+    CULL_LOCATION_PLANES = 0,           // 6 of them
+    CULL_LOCATION_TIME = 6,
+    CULL_LOCATION_CULL = 7,
+    CULL_LOCATION_PHASE = 8,
+    CULL_LOCATION_HIZ_VALID = 9,
+    CULL_LOCATION_HIZ_VIEW_PROJECTION = 10,
+    CULL_LOCATION_MATERIAL_COUNT = 11
+};
+
+// One invocation per object. Bounds are spheres in the z = 0 plane, like frustum_cull_spheres with z NULL;
+// the matrix is mat3x4_translate_rotate_Z_batch's, as a std430 mat3x4 (our rows are its columns). Survivors take a slot with an atomic on their phase's
+// instance count, so the order of the instances changes from frame to frame. The late phase's instances go
+// after the early ones, through its command's baseInstance.
+//
+// visibility[i]: 0 hidden, 1 drawn last frame, 2 drawn by this frame's early phase (back to 1 in the late one).
+// The occlusion test projects the sphere's bounding box, picks the pyramid level where its pixel rect spans
+// at most 2x2 texels, and rejects it when its nearest depth is behind all 4.
+static const char* cull_shader_text =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+"struct Command { uint count; uint instanceCount; uint firstIndex; int baseVertex; uint baseInstance; };\n"
+"layout(std430, binding = 0) readonly buffer Objects { vec4 objects[]; };\n"   // x, y, phase, radius
+"layout(std430, binding = 1) writeonly buffer Instances { mat3x4 instances[]; };\n"
+"layout(std430, binding = 2) buffer Commands { Command commands[2]; uint drawCounts[2]; };\n"
+"layout(std430, binding = 3) buffer Visibility { uint visibility[]; };\n"
+"layout(std430, binding = 4) writeonly buffer InstanceMaterials { uint instanceMaterials[]; };\n"
+"layout(binding = 0) uniform sampler2D hiz;\n"
+"layout(location = 0) uniform vec4 planes[6];\n"
+"layout(location = 6) uniform vec2 time;\n"      // t, scale
+"layout(location = 7) uniform bool cull;\n"
+"layout(location = 8) uniform int phase;\n"      // GpuCullPhase
+"layout(location = 9) uniform bool hizValid;\n"
+"layout(location = 10) uniform mat4 hizViewProjection;\n"
+"layout(location = 11) uniform uint materialCount;\n"     // 0: no material stream
+"bool occluded(vec4 o)\n"
+"{\n"
+"    vec3 lo = vec3(1.0), hi = vec3(-1.0);\n"
+"    for (int k = 0; k < 8; ++k)\n"
+"    {\n"
+"        vec3 corner = vec3(o.xy, 0.0) + o.w * vec3((k & 1) != 0 ? 1.0 : -1.0, (k & 2) != 0 ? 1.0 : -1.0, (k & 4) != 0 ? 1.0 : -1.0);\n"
+"        vec4 clip = hizViewProjection * vec4(corner, 1.0);\n"
+"        if (clip.w <= 0.0)\n"
+"            return false;\n"   // crosses the eye plane: can't bound it on screen
+"        vec3 ndc = clip.xyz / clip.w;\n"
+"        lo = k == 0 ? ndc : min(lo, ndc);\n"
+"        hi = k == 0 ? ndc : max(hi, ndc);\n"
+"    }\n"
+"    ivec2 size = textureSize(hiz, 0);\n"
+"    ivec2 a = clamp(ivec2(floor((lo.xy * 0.5 + 0.5) * vec2(size))), ivec2(0), size - 1);\n"
+"    ivec2 b = clamp(ivec2(floor((hi.xy * 0.5 + 0.5) * vec2(size))), ivec2(0), size - 1);\n"
+"    int span = max(b.x - a.x, b.y - a.y);\n"
+"    int level = min(span > 0 ? findMSB(span) + 1 : 0, textureQueryLevels(hiz) - 1);\n"
+"    ivec2 top = textureSize(hiz, level) - 1;\n"
+"    a = min(a >> level, top);\n"
+"    b = min(b >> level, top);\n"
+"    float z = max(max(texelFetch(hiz, a, level).r, texelFetch(hiz, ivec2(b.x, a.y), level).r),\n"
+"                  max(texelFetch(hiz, ivec2(a.x, b.y), level).r, texelFetch(hiz, b, level).r));\n"
+"    return lo.z * 0.5 + 0.5 > z;\n"
+"}\n"
+"void append(int command, uint i, vec4 o)\n"
+"{\n"
+"    uint slot = atomicAdd(commands[command].instanceCount, 1u);\n"
+"    uint base = command == 1 ? commands[0].instanceCount : 0u;\n"
+"    if (slot == 0u)\n"
+"    {\n"
+"        drawCounts[command] = 1u;\n"
+"        commands[command].baseInstance = base;\n"
+"    }\n"
+"    float s = time.y * sin(time.x + o.z);\n"
+"    float c = time.y * cos(time.x + o.z);\n"
+"    instances[base + slot] = mat3x4(vec4(c, -s, 0.0, o.x), vec4(s, c, 0.0, o.y), vec4(0.0, 0.0, time.y, 0.0));\n"
+"    if (materialCount != 0u)\n"
+"        instanceMaterials[base + slot] = i % materialCount;\n"
+"}\n"
+"void main()\n"
+"{\n"
+"    uint i = gl_GlobalInvocationID.x;\n"
+"    if (i >= uint(objects.length()))\n"
+"        return;\n"
+"    vec4 o = objects[i];\n"
+"    bool inside = true;\n"
+"    if (cull)\n"
+"    {\n"
+"        for (int p = 0; p < 6; ++p)\n"
+"            inside = inside && dot(planes[p].xy, o.xy) + planes[p].w >= -o.w;\n"
+"    }\n"
+"    if (phase == 0)\n"
+"    {\n"
+"        if (inside)\n"
+"            append(0, i, o);\n"
+"    }\n"
+"    else if (phase == 1)\n"
+"    {\n"
+"        if (!inside)\n"
+"            visibility[i] = 0u;\n"
+"        else if (visibility[i] != 0u && !(hizValid && occluded(o)))\n"
+"        {\n"
+"            visibility[i] = 2u;\n"
+"            append(0, i, o);\n"
+"        }\n"
+"    }\n"
+"    else if (visibility[i] == 2u)\n"
+"        visibility[i] = 1u;\n"
+"    else if (inside)\n"
+"    {\n"
+"        bool visible = !(hizValid && occluded(o));\n"
+"        visibility[i] = visible ? 1u : 0u;\n"
+"        if (visible)\n"
+"            append(1, i, o);\n"
+"    }\n"
+"}\n";
+
+// command_buffer contents: the phases' commands, then the draw counts glMultiDrawElementsIndirectCount reads
+#define DRAW_COUNT_OFFSET (2 * sizeof(DrawElementsIndirectCommand))
+
+bool gpu_culling_init(GpuCulling* c, const float* x, const float* y, const float* phase, const float* radius,
+    uint32_t count, float scale, uint32_t material_count)
+{
+    c->program = 0;
+    c->object_buffer = c->instance_buffer = c->command_buffer = c->visibility_buffer = c->material_buffer = 0;
+    c->object_count = count;
+    c->material_count = material_count;
+    c->scale = scale;
+    c->indirect_count = gl_ext.ARB_indirect_parameters;
+
+    GLuint shader = shader_compile(GL_COMPUTE_SHADER, cull_shader_text);
+    c->program = program_link(&shader, 1, false);
+    if (!c->program)
+    {
+        fprintf(stderr, "gpu_culling: can't build the culling compute shader\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, c->program, "cull");
+
+    // The scene is static, so the objects go up once and only the frustum and time change per frame
+    float* objects = (float*)malloc(sizeof(float) * 4 * count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        objects[4 * i + 0] = x[i];
+        objects[4 * i + 1] = y[i];
+        objects[4 * i + 2] = phase[i];
+        objects[4 * i + 3] = radius[i];
+    }
+    c->object_buffer = gl_dsa_create_buffer(sizeof(float) * 4 * count, objects, GL_STATIC_DRAW);
+    gl_memory_buffer(c->object_buffer, GPU_MEMORY_STORAGE, sizeof(float) * 4 * count);
+    free(objects);
+    gl_debug_label(GL_BUFFER, c->object_buffer, "cull objects");
+
+    // Written and read by the GPU only
+    c->instance_buffer = gl_dsa_create_buffer(sizeof(float) * 12 * count, NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(c->instance_buffer, GPU_MEMORY_STORAGE, sizeof(float) * 12 * count);
+    gl_debug_label(GL_BUFFER, c->instance_buffer, "cull instances");
+    if (material_count)
+    {
+        c->material_buffer = gl_dsa_create_buffer(sizeof(GLuint) * count, NULL, GL_DYNAMIC_COPY);
+        gl_memory_buffer(c->material_buffer, GPU_MEMORY_STORAGE, sizeof(GLuint) * count);
+        gl_debug_label(GL_BUFFER, c->material_buffer, "cull materials");
+    }
+
+    c->command_buffer = gl_dsa_create_buffer(DRAW_COUNT_OFFSET + 2 * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+    gl_memory_buffer(c->command_buffer, GPU_MEMORY_STORAGE, DRAW_COUNT_OFFSET + 2 * sizeof(GLuint));
+    gl_debug_label(GL_BUFFER, c->command_buffer, "cull commands");
+
+    // Nothing was visible before the first frame: its early phase draws nothing and the late one tests everything
+    c->visibility_buffer = gl_dsa_create_buffer(sizeof(GLuint) * count, NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(c->visibility_buffer, GPU_MEMORY_STORAGE, sizeof(GLuint) * count);
+    const GLuint zero = 0;
+    gl_dsa_clear_buffer(c->visibility_buffer, GL_R32UI, 0, sizeof(GLuint) * count, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    gl_debug_label(GL_BUFFER, c->visibility_buffer, "cull visibility");
+    return true;
+}
+
+void gpu_culling_destroy(GpuCulling* c)
+{
+    if (c->material_buffer)
+        gl_state_delete_buffers(1, &c->material_buffer);
+    gl_state_delete_buffers(1, &c->visibility_buffer);
+    gl_state_delete_buffers(1, &c->command_buffer);
+    gl_state_delete_buffers(1, &c->instance_buffer);
+    gl_state_delete_buffers(1, &c->object_buffer);
+    if (c->program)
+        glDeleteProgram(c->program);
+    c->program = 0;
+    c->object_buffer = c->instance_buffer = c->command_buffer = c->visibility_buffer = c->material_buffer = 0;
+}
+
+void gpu_culling_dispatch(GpuCulling* c, const GpuMesh* mesh, const Frustum* frustum, float t, GpuCullPhase phase,
+    const HiZ* hiz)
+{
+    if (phase != GPU_CULL_LATE)
+    {
+        // The whole index buffer, no instances yet; the mesh may have been swapped since the last frame
+        struct
+        {
+            DrawElementsIndirectCommand commands[2];
+            GLuint draw_counts[2];
+        } reset = { { { (GLuint)mesh->index_count, 0, 0, 0, 0 }, { (GLuint)mesh->index_count, 0, 0, 0, 0 } }, { 0, 0 } };
+        gl_dsa_buffer_sub_data(c->command_buffer, 0, sizeof(reset), &reset);
+    }
+
+    gl_state_use_program(c->program);
+    glUniform1i(CULL_LOCATION_CULL, frustum != NULL);
+    if (frustum)
+        glUniform4fv(CULL_LOCATION_PLANES, 6, &frustum->planes[0][0]);
+    glUniform2f(CULL_LOCATION_TIME, t, c->scale);
+    glUniform1i(CULL_LOCATION_PHASE, (GLint)phase);
+    glUniform1ui(CULL_LOCATION_MATERIAL_COUNT, c->material_count);
+    const bool hiz_valid = phase != GPU_CULL_FRUSTUM && hiz && hiz->valid;   // without one, nothing is occluded
+    glUniform1i(CULL_LOCATION_HIZ_VALID, hiz_valid);
+    if (hiz_valid)
+    {
+        glUniformMatrix4fv(CULL_LOCATION_HIZ_VIEW_PROJECTION, 1, GL_FALSE, &hiz->view_projection[0][0]);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, hiz->texture);
+    }
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, c->object_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, c->instance_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 2, c->command_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 3, c->visibility_buffer);
+    if (c->material_buffer)
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 4, c->material_buffer);
+    glDispatchCompute((c->object_count + GPU_CULLING_GROUP_SIZE - 1) / GPU_CULLING_GROUP_SIZE, 1, 1);
+    draw_counters_dispatch();
+
+    // The draw sources its command and count from command_buffer and its instance attributes from instance_buffer;
+    // the late phase reads the early one's instance count and visibility flags
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void gpu_culling_draw(const GpuCulling* c, const GpuMesh* mesh, GpuCullPhase phase)
+{
+    const int command = phase == GPU_CULL_LATE ? 1 : 0;
+    const GLintptr command_offset = (GLintptr)(sizeof(DrawElementsIndirectCommand) * command);
+    gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, c->command_buffer);
+    if (c->indirect_count)
+    {
+        gl_state_bind_buffer(GL_PARAMETER_BUFFER_ARB, c->command_buffer);
+        gl_ext.MultiDrawElementsIndirectCount(GL_TRIANGLES, mesh->index_type, (const void*)command_offset,
+            (GLintptr)(DRAW_COUNT_OFFSET + sizeof(GLuint) * command), 1, sizeof(DrawElementsIndirectCommand));
+    }
+    else
+        glMultiDrawElementsIndirect(GL_TRIANGLES, mesh->index_type, (const void*)command_offset, 1, sizeof(DrawElementsIndirectCommand));
+    draw_counters_indirect(1);
+    gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+bool gpu_culling_read_commands(const GpuCulling* c, GpuReadback* rb, DrawElementsIndirectCommand* commands,
+    GpuReadbackFunction done, void* user)
+{
+    return gpu_readback_buffer(rb, c->command_buffer, 0, sizeof(DrawElementsIndirectCommand) * 2, commands, done, user);
+}
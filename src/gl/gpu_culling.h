@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/gpu_readback.h"
+#include "gl/hiz.h"
+#include "gl/mesh.h"
+#include "scene/frustum.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// GPU-driven submission (needs a 4.3 context): the per-object state lives in
+// a shader storage buffer, and every frame a compute shader tests each
+// object's bounding sphere against the frustum, writes the survivors' model
+// matrices compacted into the instance buffer and counts them straight into
+// a DrawElementsIndirectCommand. One glMultiDrawElementsIndirect then draws
+// the scene without the CPU touching a single object or reading anything back.
+//
+// With ARB_indirect_parameters (core in 4.6) the draw count comes from the
+// same buffer too, so a frame where nothing survives submits no draw at all.
+//
+// Occlusion culling runs in two phases per frame against a Hi-Z pyramid, and
+// the compute shader keeps a visibility flag per object between frames:
+//   early: objects visible last frame are tested against last frame's pyramid
+//          (built from its early draws, with its camera) and the ones that
+//          pass are drawn.
+//   late:  the pyramid is rebuilt from that depth, then everything else in the
+//          frustum - objects hidden last frame, and the visible ones whose
+//          early test failed - is tested against it and drawn if it passes.
+// The early draws are usually most of the frame and make the late pyramid a
+// good occluder. An object that becomes visible is still drawn in the same frame, so nothing pops.
+
+#define GPU_CULLING_GROUP_SIZE 64   // objects per work group (local_size_x in the shader)
+
+// Layout fixed by the GL spec for glMultiDrawElementsIndirect
+typedef struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+} DrawElementsIndirectCommand;
+
+typedef struct GpuCulling
+{
+    GLuint program;             // the culling compute shader
+    GLuint object_buffer;       // SSBO: vec4 (x, y, phase, radius) per object
+    GLuint instance_buffer;     // affine model matrix (mat3x4) per drawn instance; the vModel attributes read it
+    GLuint command_buffer;      // DrawElementsIndirectCommand per phase, then a uint draw count per phase
+    GLuint visibility_buffer;   // uint per object: drawn last frame (occlusion phases only)
+    GLuint material_buffer;     // uint material index per drawn instance, beside instance_buffer; 0 without materials
+    uint32_t object_count;
+    float scale;
+    uint32_t material_count;    // object i wears material i % material_count
+    bool indirect_count;        // draw count read from command_buffer (ARB_indirect_parameters)
+} GpuCulling;
+
+// Uploads the objects (grid position, rotation phase, bounding radius per object, uniform "scale") and
+// builds the compute program. With "material_count" > 0 the cull also writes each instance's material,
+// object index modulo the count, into material_buffer. Logs and returns false when the program fails to build.
+bool gpu_culling_init(GpuCulling* c, const float* x, const float* y, const float* phase, const float* radius,
+    uint32_t count, float scale, uint32_t material_count);
+void gpu_culling_destroy(GpuCulling* c);
+
+typedef enum GpuCullPhase
+{
+    GPU_CULL_FRUSTUM,           // frustum only, in one pass (command 0)
+    GPU_CULL_EARLY,             // occlusion, first phase: last frame's visible objects (command 0)
+    GPU_CULL_LATE               // occlusion, second phase: everything else (command 1)
+} GpuCullPhase;
+
+// Dispatches one cull phase for time "t" (NULL frustum: every object is inside). FRUSTUM and EARLY reset the
+// commands for "mesh" first. EARLY tests against "hiz" as last built (skipped until it's valid), LATE against
+// "hiz" rebuilt from the depth of the frame's early draws.
+void gpu_culling_dispatch(GpuCulling* c, const GpuMesh* mesh, const Frustum* frustum, float t, GpuCullPhase phase,
+    const HiZ* hiz);
+
+// Draws what a phase kept (VAO with the instance attributes on instance_buffer bound by the caller)
+void gpu_culling_draw(const GpuCulling* c, const GpuMesh* mesh, GpuCullPhase phase);
+
+// Queues a readback of this frame's commands into "commands" (one per phase: FRUSTUM or EARLY first, then LATE),
+// their instance counts summing to the objects drawn; "done" and "user" as gpu_readback_buffer takes them
+bool gpu_culling_read_commands(const GpuCulling* c, GpuReadback* rb, DrawElementsIndirectCommand* commands,
+    GpuReadbackFunction done, void* user);
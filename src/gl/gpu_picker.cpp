@@ -0,0 +1,134 @@
+#include "gl/gpu_picker.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const GLenum draw_buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+
+void gpu_picker_init(GpuPicker* picker)
+{
+    memset(picker, 0, sizeof(*picker));
+    glGenBuffers(GPU_PICKER_SLOTS, picker->buffers);
+    for (int i = 0; i < GPU_PICKER_SLOTS; ++i)
+    {
+        gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, picker->buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), NULL, GL_STREAM_READ);
+        gl_memory_buffer(picker->buffers[i], GPU_MEMORY_STAGING, sizeof(GLuint));
+        gl_debug_label(GL_BUFFER, picker->buffers[i], "pick readback");
+    }
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);     // glReadPixels elsewhere reads into client memory
+}
+
+void gpu_picker_destroy(GpuPicker* picker)
+{
+    for (int i = 0; i < GPU_PICKER_SLOTS; ++i)
+        if (picker->fences[i])
+            glDeleteSync(picker->fences[i]);
+    gl_state_delete_buffers(GPU_PICKER_SLOTS, picker->buffers);
+    gl_state_delete_textures(1, &picker->ids);
+    memset(picker, 0, sizeof(*picker));
+}
+
+bool gpu_picker_attach(GpuPicker* picker, const RenderTarget* rt)
+{
+    gl_state_delete_textures(1, &picker->ids);
+    picker->ids = 0;
+    picker->framebuffer = rt->framebuffer;
+    picker->width = rt->width;
+    picker->height = rt->height;
+    if (rt->samples > 1)
+        return false;
+
+    glGenTextures(1, &picker->ids);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, picker->ids);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, rt->width, rt->height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+    gl_memory_texture(picker->ids, GPU_MEMORY_RENDER_TARGETS, GL_R32UI, rt->width, rt->height, 1, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+    gl_debug_label(GL_TEXTURE, picker->ids, "object ids");
+
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, rt->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, picker->ids, 0);
+    glDrawBuffers(2, draw_buffers);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glDrawBuffers(1, draw_buffers);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "gpu_picker: %dx%d object ID attachment incomplete (0x%04X)\n", rt->width, rt->height, status);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, 0, 0);
+        gl_state_delete_textures(1, &picker->ids);
+        picker->ids = 0;
+        return false;
+    }
+    return true;
+}
+
+void gpu_picker_begin(const GpuPicker* picker)
+{
+    if (!picker->ids)
+        return;
+    static const GLuint background[4] = { 0, 0, 0, 0 };
+    glDrawBuffers(2, draw_buffers);
+    glClearBufferuiv(GL_COLOR, 1, background);
+}
+
+void gpu_picker_end(const GpuPicker* picker)
+{
+    if (picker->ids)
+        glDrawBuffers(1, draw_buffers);
+}
+
+bool gpu_picker_read(GpuPicker* picker, int x, int y, unsigned int frame)
+{
+    if (!picker->ids || picker->count == GPU_PICKER_SLOTS)
+        return false;
+    x = x < 0 ? 0 : x >= picker->width ? picker->width - 1 : x;
+    y = y < 0 ? 0 : y >= picker->height ? picker->height - 1 : y;
+    const unsigned int slot = (picker->head + picker->count) % GPU_PICKER_SLOTS;
+
+    // Into the buffer, not client memory: glReadPixels returns as soon as the copy is queued
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, picker->framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT1);
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, picker->buffers[slot]);
+    glReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);     // the upscale blits from the colour
+    picker->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    picker->frames[slot] = frame;
+    ++picker->count;
+    ++picker->reads;
+    return true;
+}
+
+bool gpu_picker_poll(GpuPicker* picker, int* object, unsigned int* frame)
+{
+    if (!picker->count)
+        return false;
+    const unsigned int slot = picker->head;
+    const GLenum status = glClientWaitSync(picker->fences[slot], 0, 0);    // asks, doesn't wait
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+    glDeleteSync(picker->fences[slot]);
+    picker->fences[slot] = NULL;
+    picker->head = (picker->head + 1) % GPU_PICKER_SLOTS;
+    --picker->count;
+
+    GLuint id = 0;
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, picker->buffers[slot]);
+    const GLuint* mapped = (const GLuint*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT);
+    if (mapped)
+    {
+        id = *mapped;
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+    *object = (int)id - 1;
+    *frame = picker->frames[slot];
+    return true;
+}
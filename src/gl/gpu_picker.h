@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/render_target.h"
+
+// Picking from an object ID buffer, read back without a stall. The scene's
+// instanced colour pass writes each fragment's object index (plus one; 0 is
+// the cleared background) into an R32UI texture attached to the offscreen
+// target as a second colour attachment, in the same pass as the colour: the
+// draw buffers name it only between gpu_picker_begin and gpu_picker_end, so
+// the particles, characters and overlays drawn afterwards never touch it.
+//
+// A click copies the one pixel under the cursor into a small pixel pack
+// buffer with glReadPixels and fences it. The copy is queued on the GPU like
+// any other command, so nothing waits; gpu_picker_poll looks at the fences
+// without blocking and maps a buffer only once its copy is done, which is
+// usually one to two frames later. Up to GPU_PICKER_SLOTS clicks can be in
+// flight; one more has to wait for a slot.
+//
+// Single-sample targets only: an integer attachment can't be resolved.
+
+#define GPU_PICKER_SLOTS 3
+
+typedef struct GpuPicker
+{
+    GLuint ids;                 // R32UI texture, the target's GL_COLOR_ATTACHMENT1; 0 until attached
+    GLuint framebuffer;         // the target it's attached to
+    int width, height;
+    GLuint buffers[GPU_PICKER_SLOTS];   // pixel pack buffers, one GLuint each
+    GLsync fences[GPU_PICKER_SLOTS];    // after each one's copy; NULL for a free slot
+    unsigned int frames[GPU_PICKER_SLOTS];  // the frame each copy was made in
+    unsigned int head;          // the oldest copy in flight
+    unsigned int count;         // copies in flight
+    unsigned int reads;         // over the run
+} GpuPicker;
+
+// Needs a current context
+void gpu_picker_init(GpuPicker* picker);
+void gpu_picker_destroy(GpuPicker* picker);
+
+// Attaches a new ID texture at "rt"'s size to its framebuffer; call again whenever the target is recreated.
+// Returns false (with the texture detached) when the framebuffer isn't complete with it.
+bool gpu_picker_attach(GpuPicker* picker, const RenderTarget* rt);
+
+// Around the draws that write object IDs, with the target bound: begin points the draw buffers at both
+// attachments and clears the IDs to 0, end points them back at the colour alone
+void gpu_picker_begin(const GpuPicker* picker);
+void gpu_picker_end(const GpuPicker* picker);
+
+// Queues a copy of the ID at pixel (x, y) of the target, counted from the bottom left, made in "frame".
+// Returns false when every slot is in flight.
+bool gpu_picker_read(GpuPicker* picker, int x, int y, unsigned int frame);
+
+// The oldest copy, if it's done: its object index in *object (-1 for the background) and the frame it was
+// made in in *frame. Never waits; returns false while it's still on its way (or none is in flight).
+bool gpu_picker_poll(GpuPicker* picker, int* object, unsigned int* frame);
@@ -0,0 +1,692 @@
+#include "gl/gpu_primitives.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#define RADIX_DIGITS (1 << GPU_PRIMITIVES_RADIX_BITS)
+#define MAX_GROUPS_X 65535u         // the least GL_MAX_COMPUTE_WORK_GROUP_COUNT promises: more tiles go 2D
+#define HISTOGRAM_GROUPS 512u       // work groups a histogram loops over its input with
+
+static const char* subgroup_header =
+"#extension GL_KHR_shader_subgroup_basic : require\n"
+"#extension GL_KHR_shader_subgroup_arithmetic : require\n"
+"#define SUBGROUP\n";
+
+// Every kernel's start: the tile, and tileScan, the work group's exclusive scan of one uint per invocation. Every
+// invocation of the group must call it, so kernels keep their out-of-range invocations to the end.
+static const char* prelude_text =
+"layout(local_size_x = 256) in;\n"
+"const uint TILE = 256u;\n"                 // GPU_PRIMITIVES_TILE
+"uniform uint count;\n"
+"uniform uint tiles;\n"
+"uint tileIndex()\n"
+"{\n"
+"    return gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;\n"
+"}\n"
+"void tileBarrier()\n"
+"{\n"
+"    memoryBarrierShared();\n"
+"    barrier();\n"
+"}\n"
+"#ifdef SUBGROUP\n"
+// Each subgroup scans its part, the first scans the subgroups' totals (16 or more invocations: 16 totals at most)
+"shared uint scanPartials[TILE / 16u + 1u];\n"
+"uint tileScan(uint v, out uint total)\n"
+"{\n"
+"    uint inclusive = subgroupInclusiveAdd(v);\n"
+"    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1u)\n"
+"        scanPartials[gl_SubgroupID] = inclusive;\n"
+"    tileBarrier();\n"
+"    if (gl_SubgroupID == 0u)\n"
+"    {\n"
+"        uint lane = gl_SubgroupInvocationID;\n"
+"        uint sum = lane < gl_NumSubgroups ? scanPartials[lane] : 0u;\n"
+"        uint before = subgroupExclusiveAdd(sum);\n"
+"        if (lane < gl_NumSubgroups)\n"
+"            scanPartials[lane] = before;\n"
+"        if (lane == gl_SubgroupSize - 1u)\n"
+"            scanPartials[TILE / 16u] = before + sum;\n"
+"    }\n"
+"    tileBarrier();\n"
+"    total = scanPartials[TILE / 16u];\n"
+"    uint result = inclusive - v + scanPartials[gl_SubgroupID];\n"
+"    tileBarrier();\n"
+"    return result;\n"
+"}\n"
+"#else\n"
+// Hillis-Steele: log2(TILE) steps, each adding the value that many places back
+"shared uint scanShared[TILE];\n"
+"uint tileScan(uint v, out uint total)\n"
+"{\n"
+"    uint lane = gl_LocalInvocationIndex;\n"
+"    scanShared[lane] = v;\n"
+"    tileBarrier();\n"
+"    for (uint offset = 1u; offset < TILE; offset <<= 1u)\n"
+"    {\n"
+"        uint add = lane >= offset ? scanShared[lane - offset] : 0u;\n"
+"        tileBarrier();\n"
+"        scanShared[lane] += add;\n"
+"        tileBarrier();\n"
+"    }\n"
+"    total = scanShared[TILE - 1u];\n"
+"    uint result = scanShared[lane] - v;\n"
+"    tileBarrier();\n"
+"    return result;\n"
+"}\n"
+"#endif\n";
+
+// Each tile scanned, its total to sums[tile]. Input and output may be the same buffer: an element is read and
+// written by the same invocation, in that order.
+static const char* scan_tiles_text =
+"layout(std430, binding = 0) readonly buffer Input { uint inputs[]; };\n"
+"layout(std430, binding = 1) writeonly buffer Output { uint outputs[]; };\n"
+"layout(std430, binding = 2) writeonly buffer Sums { uint sums[]; };\n"
+"uniform bool flags;\n"                     // scan (inputs[i] != 0): compaction's
+"void main()\n"
+"{\n"
+"    uint tile = tileIndex();\n"
+"    if (tile >= tiles)\n"
+"        return;\n"
+"    uint i = tile * TILE + gl_LocalInvocationIndex;\n"
+"    uint v = i < count ? inputs[i] : 0u;\n"
+"    if (flags)\n"
+"        v = min(v, 1u);\n"
+"    uint total;\n"
+"    uint before = tileScan(v, total);\n"
+"    if (i < count)\n"
+"        outputs[i] = before;\n"
+"    if (gl_LocalInvocationIndex == 0u)\n"
+"        sums[tile] = total;\n"
+"}\n";
+
+static const char* scan_add_text =
+"layout(std430, binding = 1) buffer Output { uint outputs[]; };\n"
+"layout(std430, binding = 2) readonly buffer Sums { uint sums[]; };\n"
+"void main()\n"
+"{\n"
+"    uint tile = tileIndex();\n"
+"    uint i = tile * TILE + gl_LocalInvocationIndex;\n"
+"    if (tile < tiles && i < count)\n"
+"        outputs[i] += sums[tile];\n"
+"}\n";
+
+// offsets: the flags scanned. The last element knows the total.
+static const char* compact_text =
+"layout(std430, binding = 0) readonly buffer Input { uint inputs[]; };\n"
+"layout(std430, binding = 1) readonly buffer Flags { uint flags[]; };\n"
+"layout(std430, binding = 2) readonly buffer Offsets { uint offsets[]; };\n"
+"layout(std430, binding = 3) writeonly buffer Output { uint outputs[]; };\n"
+"layout(std430, binding = 4) writeonly buffer Counted { uint counted; };\n"
+"void main()\n"
+"{\n"
+"    uint tile = tileIndex();\n"
+"    uint i = tile * TILE + gl_LocalInvocationIndex;\n"
+"    if (tile >= tiles || i >= count)\n"
+"        return;\n"
+"    bool kept = flags[i] != 0u;\n"
+"    if (kept)\n"
+"        outputs[offsets[i]] = inputs[i];\n"
+"    if (i == count - 1u)\n"
+"        counted = offsets[i] + (kept ? 1u : 0u);\n"
+"}\n";
+
+// A few hundred groups loop over the input, each counting into shared memory and adding its counts once
+static const char* histogram_text =
+"layout(std430, binding = 0) readonly buffer Input { uint inputs[]; };\n"
+"layout(std430, binding = 1) buffer Bins { uint bins[]; };\n"
+"uniform uint shift;\n"
+"uniform uint binCount;\n"
+"shared uint localBins[4096];\n"            // GPU_PRIMITIVES_MAX_BINS
+"void main()\n"
+"{\n"
+"    for (uint b = gl_LocalInvocationIndex; b < binCount; b += TILE)\n"
+"        localBins[b] = 0u;\n"
+"    tileBarrier();\n"
+"    uint mask = binCount - 1u;\n"
+"    uint stride = gl_NumWorkGroups.x * TILE;\n"
+"    for (uint i = gl_WorkGroupID.x * TILE + gl_LocalInvocationIndex; i < count; i += stride)\n"
+"        atomicAdd(localBins[(inputs[i] >> shift) & mask], 1u);\n"
+"    tileBarrier();\n"
+"    for (uint b = gl_LocalInvocationIndex; b < binCount; b += TILE)\n"
+"        if (localBins[b] != 0u)\n"
+"            atomicAdd(bins[b], localBins[b]);\n"
+"}\n";
+
+// Both radix kernels: the key type and its 4-bit digit at "shift"
+static const char* radix_common_text =
+"#ifdef KEY64\n"
+"#define Key uvec2\n"
+"#else\n"
+"#define Key uint\n"
+"#endif\n"
+"uniform uint shift;\n"
+"uint digitOf(Key key)\n"
+"{\n"
+"#ifdef KEY64\n"
+"    return ((shift < 32u ? key.x : key.y) >> (shift & 31u)) & 15u;\n"
+"#else\n"
+"    return (key >> shift) & 15u;\n"
+"#endif\n"
+"}\n";
+
+// The tile's count of each digit, digit-major: scanned, table[d * tiles + t] is where tile t's d's start
+static const char* radix_count_text =
+"layout(std430, binding = 0) readonly buffer Keys { Key keys[]; };\n"
+"layout(std430, binding = 1) writeonly buffer Table { uint table[]; };\n"
+"shared uint digitCounts[16];\n"
+"void main()\n"
+"{\n"
+"    uint tile = tileIndex();\n"
+"    if (tile >= tiles)\n"
+"        return;\n"
+"    uint lane = gl_LocalInvocationIndex;\n"
+"    if (lane < 16u)\n"
+"        digitCounts[lane] = 0u;\n"
+"    tileBarrier();\n"
+"    uint i = tile * TILE + lane;\n"
+"    if (i < count)\n"
+"        atomicAdd(digitCounts[digitOf(keys[i])], 1u);\n"
+"    tileBarrier();\n"
+"    if (lane < 16u)\n"
+"        table[lane * tiles + tile] = digitCounts[lane];\n"
+"}\n";
+
+// The tile sorted by the digit in shared memory, one stable split per bit, so each element's rank in its digit's
+// run is its place less where the run starts. Invocations past the end take digit 15 and, being last already,
+// stay after the tile's real 15s.
+static const char* radix_scatter_text =
+"layout(std430, binding = 0) readonly buffer Keys { Key keys[]; };\n"
+"layout(std430, binding = 1) writeonly buffer SortedKeys { Key sortedKeys[]; };\n"
+"layout(std430, binding = 2) readonly buffer Values { uint values[]; };\n"
+"layout(std430, binding = 3) writeonly buffer SortedValues { uint sortedValues[]; };\n"
+"layout(std430, binding = 4) readonly buffer Table { uint table[]; };\n"
+"uniform bool withValues;\n"
+"shared Key tileKeys[TILE];\n"
+"shared uint tileValues[TILE];\n"
+"shared uint tileDigits[TILE];\n"
+"shared uint digitCounts[16];\n"
+"shared uint digitStarts[16];\n"
+"void main()\n"
+"{\n"
+"    uint tile = tileIndex();\n"
+"    if (tile >= tiles)\n"
+"        return;\n"
+"    uint lane = gl_LocalInvocationIndex;\n"
+"    uint i = tile * TILE + lane;\n"
+"    uint valid = min(count - tile * TILE, TILE);\n"
+"    Key key = lane < valid ? keys[i] : Key(0u);\n"
+"    uint value = lane < valid && withValues ? values[i] : 0u;\n"
+"    uint digit = lane < valid ? digitOf(key) : 15u;\n"
+"    if (lane < 16u)\n"
+"        digitCounts[lane] = 0u;\n"
+"    tileBarrier();\n"
+"    if (lane < valid)\n"
+"        atomicAdd(digitCounts[digit], 1u);\n"
+"    for (uint bit = 0u; bit < 4u; ++bit)\n"
+"    {\n"
+"        uint one = (digit >> bit) & 1u;\n"
+"        uint zeros;\n"
+"        uint zerosBefore = tileScan(one ^ 1u, zeros);\n"
+"        uint at = one == 0u ? zerosBefore : zeros + lane - zerosBefore;\n"
+"        tileKeys[at] = key;\n"
+"        tileValues[at] = value;\n"
+"        tileDigits[at] = digit;\n"
+"        tileBarrier();\n"
+"        key = tileKeys[lane];\n"
+"        value = tileValues[lane];\n"
+"        digit = tileDigits[lane];\n"
+"        tileBarrier();\n"
+"    }\n"
+"    if (lane == 0u)\n"
+"    {\n"
+"        uint start = 0u;\n"
+"        for (uint d = 0u; d < 16u; ++d)\n"
+"        {\n"
+"            digitStarts[d] = start;\n"
+"            start += digitCounts[d];\n"
+"        }\n"
+"    }\n"
+"    tileBarrier();\n"
+"    if (lane < valid)\n"
+"    {\n"
+"        uint to = table[digit * tiles + tile] + lane - digitStarts[digit];\n"
+"        sortedKeys[to] = key;\n"
+"        if (withValues)\n"
+"            sortedValues[to] = value;\n"
+"    }\n"
+"}\n";
+
+static bool build_kernel(GpuKernel* k, bool subgroups, const char* defines, const char* common, const char* body,
+    const char* option, const char* label)
+{
+    char text[12288];
+    snprintf(text, sizeof(text), "#version 430\n%s%s%s%s%s", subgroups ? subgroup_header : "", defines, prelude_text,
+        common, body);
+    GLuint shader = shader_compile(GL_COMPUTE_SHADER, text);
+    k->program = program_link(&shader, 1, false);
+    if (!k->program)
+    {
+        fprintf(stderr, "gpu_primitives: can't build the %s kernel%s\n", label, subgroups ? " (subgroups)" : "");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, k->program, label);
+    k->count_location = glGetUniformLocation(k->program, "count");
+    k->tiles_location = glGetUniformLocation(k->program, "tiles");
+    k->shift_location = glGetUniformLocation(k->program, "shift");
+    k->option_location = option ? glGetUniformLocation(k->program, option) : -1;
+    return true;
+}
+
+// "buffer" at least "bytes" long, created or grown (its contents lost) as needed
+static void reserve(GLuint* buffer, GLsizeiptr* have, GLsizeiptr bytes, const char* label)
+{
+    if (*buffer && *have >= bytes)
+        return;
+    if (!*buffer)
+    {
+        *buffer = gl_dsa_create_buffer(bytes, NULL, GL_DYNAMIC_COPY);
+        gl_debug_label(GL_BUFFER, *buffer, label);
+    }
+    else
+        gl_dsa_buffer_data(*buffer, bytes, NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(*buffer, GPU_MEMORY_STORAGE, (size_t)bytes);
+    *have = bytes;
+}
+
+static uint32_t tiles_for(uint32_t count)
+{
+    return (uint32_t)(((uint64_t)count + GPU_PRIMITIVES_TILE - 1) / GPU_PRIMITIVES_TILE);
+}
+
+static void use_kernel(const GpuKernel* k, uint32_t count, uint32_t tiles)
+{
+    gl_state_use_program(k->program);
+    glUniform1ui(k->count_location, count);
+    glUniform1ui(k->tiles_location, tiles);
+}
+
+// One work group per tile, then the barrier the next kernel's reads need
+static void dispatch_tiles(uint32_t tiles)
+{
+    const uint32_t x = tiles < MAX_GROUPS_X ? tiles : MAX_GROUPS_X;
+    glDispatchCompute(x, (tiles + x - 1) / x, 1);
+    draw_counters_dispatch();
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+bool gpu_primitives_supported(void)
+{
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+bool gpu_primitives_init(GpuPrimitives* p, bool subgroups)
+{
+    memset(p, 0, sizeof(*p));
+    p->subgroups = subgroups && gl_ext.KHR_shader_subgroup && gl_ext.subgroup_size >= 16;
+    const bool s = p->subgroups;
+    const bool ok = build_kernel(&p->scan_tiles, s, "", "", scan_tiles_text, "flags", "scan tiles")
+        && build_kernel(&p->scan_add, s, "", "", scan_add_text, NULL, "scan add")
+        && build_kernel(&p->compact, s, "", "", compact_text, NULL, "compact")
+        && build_kernel(&p->histogram, s, "", "", histogram_text, "binCount", "histogram")
+        && build_kernel(&p->radix_count[0], s, "", radix_common_text, radix_count_text, NULL, "radix count")
+        && build_kernel(&p->radix_count[1], s, "#define KEY64\n", radix_common_text, radix_count_text, NULL,
+            "radix count 64")
+        && build_kernel(&p->radix_scatter[0], s, "", radix_common_text, radix_scatter_text, "withValues",
+            "radix scatter")
+        && build_kernel(&p->radix_scatter[1], s, "#define KEY64\n", radix_common_text, radix_scatter_text,
+            "withValues", "radix scatter 64");
+    if (!ok)
+        gpu_primitives_destroy(p);
+    return ok;
+}
+
+void gpu_primitives_destroy(GpuPrimitives* p)
+{
+    GpuKernel* kernels[] = { &p->scan_tiles, &p->scan_add, &p->compact, &p->histogram, &p->radix_count[0],
+        &p->radix_count[1], &p->radix_scatter[0], &p->radix_scatter[1] };
+    for (GpuKernel* k : kernels)
+    {
+        if (k->program)
+            glDeleteProgram(k->program);
+        k->program = 0;
+    }
+    gl_state_delete_buffers(GPU_PRIMITIVES_SCAN_LEVELS, p->scan_sums);
+    gl_state_delete_buffers(1, &p->scratch);
+    gl_state_delete_buffers(1, &p->value_scratch);
+    gl_state_delete_buffers(1, &p->table);
+    memset(p->scan_sums, 0, sizeof(p->scan_sums));
+    memset(p->scan_sums_bytes, 0, sizeof(p->scan_sums_bytes));
+    p->scratch = p->value_scratch = p->table = 0;
+    p->scratch_bytes = p->value_scratch_bytes = p->table_bytes = 0;
+}
+
+// One level: the tiles scanned, then (more than one) their totals scanned a level down and added back
+static void scan_level(GpuPrimitives* p, GLuint input, GLuint output, uint32_t count, bool flags, int level)
+{
+    const uint32_t tiles = tiles_for(count);
+    reserve(&p->scan_sums[level], &p->scan_sums_bytes[level], sizeof(GLuint) * tiles, "scan tile totals");
+    use_kernel(&p->scan_tiles, count, tiles);
+    glUniform1ui(p->scan_tiles.option_location, flags);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, input);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, output);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 2, p->scan_sums[level]);
+    dispatch_tiles(tiles);
+    if (tiles == 1)
+        return;
+
+    scan_level(p, p->scan_sums[level], p->scan_sums[level], tiles, false, level + 1);
+    use_kernel(&p->scan_add, count, tiles);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, output);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 2, p->scan_sums[level]);
+    dispatch_tiles(tiles);
+}
+
+void gpu_scan_exclusive(GpuPrimitives* p, GLuint input, GLuint output, uint32_t count)
+{
+    if (count)
+        scan_level(p, input, output, count, false, 0);
+}
+
+void gpu_compact(GpuPrimitives* p, GLuint input, GLuint flags, GLuint output, GLuint counted, uint32_t count)
+{
+    if (!count)
+    {
+        const GLuint zero = 0;
+        gl_dsa_clear_buffer(counted, GL_R32UI, 0, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        return;
+    }
+    reserve(&p->scratch, &p->scratch_bytes, sizeof(GLuint) * (GLsizeiptr)count, "primitives scratch");
+    scan_level(p, flags, p->scratch, count, true, 0);
+
+    const uint32_t tiles = tiles_for(count);
+    use_kernel(&p->compact, count, tiles);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, input);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, flags);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 2, p->scratch);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 3, output);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 4, counted);
+    dispatch_tiles(tiles);
+}
+
+void gpu_histogram(GpuPrimitives* p, GLuint input, uint32_t count, uint32_t shift, uint32_t bin_count, GLuint bins)
+{
+    const GLuint zero = 0;
+    gl_dsa_clear_buffer(bins, GL_R32UI, 0, sizeof(GLuint) * bin_count, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    if (!count)
+        return;
+    const uint32_t tiles = tiles_for(count);
+    const uint32_t groups = tiles < HISTOGRAM_GROUPS ? tiles : HISTOGRAM_GROUPS;
+    use_kernel(&p->histogram, count, groups);
+    glUniform1ui(p->histogram.shift_location, shift);
+    glUniform1ui(p->histogram.option_location, bin_count);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, input);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, bins);
+    glDispatchCompute(groups, 1, 1);
+    draw_counters_dispatch();
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void gpu_radix_sort(GpuPrimitives* p, GLuint keys, GLuint values, uint32_t count, int key_bits)
+{
+    if (count < 2)
+        return;
+    const int wide = key_bits == 64;
+    const uint32_t tiles = tiles_for(count);
+    reserve(&p->scratch, &p->scratch_bytes, (wide ? 8 : 4) * (GLsizeiptr)count, "primitives scratch");
+    if (values)
+        reserve(&p->value_scratch, &p->value_scratch_bytes, sizeof(GLuint) * (GLsizeiptr)count, "sort value scratch");
+    reserve(&p->table, &p->table_bytes, sizeof(GLuint) * RADIX_DIGITS * (GLsizeiptr)tiles, "radix digit table");
+
+    // Keys (and values) go back and forth between the caller's buffers and the scratch ones, an even number of times
+    GLuint from_keys = keys, to_keys = p->scratch;
+    GLuint from_values = values, to_values = p->value_scratch;
+    for (int shift = 0; shift < (wide ? 64 : 32); shift += GPU_PRIMITIVES_RADIX_BITS)
+    {
+        const GpuKernel* k = &p->radix_count[wide];
+        use_kernel(k, count, tiles);
+        glUniform1ui(k->shift_location, (GLuint)shift);
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, from_keys);
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, p->table);
+        dispatch_tiles(tiles);
+
+        scan_level(p, p->table, p->table, RADIX_DIGITS * tiles, false, 0);
+
+        // Without values their bindings repeat the keys', never read or written
+        k = &p->radix_scatter[wide];
+        use_kernel(k, count, tiles);
+        glUniform1ui(k->shift_location, (GLuint)shift);
+        glUniform1ui(k->option_location, values != 0);
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, from_keys);
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, to_keys);
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 2, values ? from_values : from_keys);
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 3, values ? to_values : to_keys);
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 4, p->table);
+        dispatch_tiles(tiles);
+
+        std::swap(from_keys, to_keys);
+        std::swap(from_values, to_values);
+    }
+}
+
+// --- Benchmark ---
+
+// The inputs and what each primitive should make of them, worked out once per size on the CPU
+typedef struct Reference
+{
+    uint32_t count;
+    std::vector<uint32_t> keys;         // random; also the histogram's and compaction's input
+    std::vector<uint32_t> small;        // 0-15, the scan's input
+    std::vector<uint32_t> flags;        // about half set
+    std::vector<uint64_t> wide;         // random 64-bit keys
+    std::vector<uint32_t> scanned;
+    std::vector<uint32_t> compacted;
+    std::vector<uint32_t> histogram;    // 256 bins of keys' bits 8-15
+    std::vector<uint32_t> sorted_keys;
+    std::vector<uint32_t> sorted_values;    // each key's original index: a stable sort's order
+    std::vector<uint64_t> sorted_wide;
+} Reference;
+
+static void reference_init(Reference* ref, uint32_t count)
+{
+    ref->count = count;
+    ref->keys.resize(count);
+    ref->small.resize(count);
+    ref->flags.resize(count);
+    ref->wide.resize(count);
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ count;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        ref->wide[i] = state;
+        ref->keys[i] = (uint32_t)(state >> 32) & 0xFFFF0FFFu;     // some equal keys, for stability to show
+        ref->small[i] = (uint32_t)(state >> 20) & 15u;
+        ref->flags[i] = (uint32_t)(state >> 63);
+    }
+    ref->scanned.resize(count);
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ref->scanned[i] = sum;
+        sum += ref->small[i];
+    }
+    ref->compacted.clear();
+    ref->histogram.assign(256, 0);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (ref->flags[i])
+            ref->compacted.push_back(ref->keys[i]);
+        ++ref->histogram[(ref->keys[i] >> 8) & 255u];
+    }
+    std::vector<uint32_t> order(count);
+    for (uint32_t i = 0; i < count; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [ref](uint32_t a, uint32_t b) { return ref->keys[a] < ref->keys[b]; });
+    ref->sorted_keys.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+        ref->sorted_keys[i] = ref->keys[order[i]];
+    ref->sorted_values = order;
+    ref->sorted_wide = ref->wide;
+    std::sort(ref->sorted_wide.begin(), ref->sorted_wide.end());
+}
+
+static GLuint bench_buffer(const void* data, GLsizeiptr bytes, const char* label)
+{
+    const GLuint buffer = gl_dsa_create_buffer(bytes, data, GL_DYNAMIC_COPY);
+    gl_debug_label(GL_BUFFER, buffer, label);
+    return buffer;
+}
+
+static bool bench_matches(GLuint buffer, const void* expected, size_t bytes)
+{
+    std::vector<uint8_t> got(bytes);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    gl_state_bind_buffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)bytes, got.data());
+    gl_state_bind_buffer(GL_COPY_READ_BUFFER, 0);
+    return !memcmp(got.data(), expected, bytes);
+}
+
+static double bench_ms(GLuint query)
+{
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+    return ns / 1e6;
+}
+
+static bool bench_report(FILE* out, const GpuPrimitives* p, const char* what, uint32_t count, double ms, bool ok)
+{
+    fprintf(out, "  %-20s %-9s %10u  %9.3f ms  %7.3f G/s  %s\n", what, p->subgroups ? "subgroup" : "plain", count, ms,
+        ms > 0.0 ? count / ms / 1e6 : 0.0, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Each primitive once to grow the scratch buffers, then again inside a GL_TIME_ELAPSED query, then checked.
+// False with GL_OUT_OF_MEMORY set when the size doesn't fit.
+static bool bench_size(GpuPrimitives* p, const Reference* ref, GLuint query, FILE* out)
+{
+    const uint32_t n = ref->count;
+    const GLsizeiptr bytes = sizeof(GLuint) * (GLsizeiptr)n;
+    bool ok = true;
+
+    GLuint input = bench_buffer(ref->small.data(), bytes, "bench scan input");
+    GLuint output = bench_buffer(NULL, bytes, "bench output");
+    gpu_scan_exclusive(p, input, output, n);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpu_scan_exclusive(p, input, output, n);
+    glEndQuery(GL_TIME_ELAPSED);
+    ok = bench_report(out, p, "exclusive scan", n, bench_ms(query), bench_matches(output, ref->scanned.data(), bytes))
+        && ok;
+    gl_state_delete_buffers(1, &input);
+
+    input = bench_buffer(ref->keys.data(), bytes, "bench keys");
+    GLuint flags = bench_buffer(ref->flags.data(), bytes, "bench flags");
+    GLuint counted = bench_buffer(NULL, sizeof(GLuint), "bench count");
+    gpu_compact(p, input, flags, output, counted, n);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpu_compact(p, input, flags, output, counted, n);
+    glEndQuery(GL_TIME_ELAPSED);
+    const uint32_t kept = (uint32_t)ref->compacted.size();
+    ok = bench_report(out, p, "stream compaction", n, bench_ms(query), bench_matches(counted, &kept, sizeof(kept))
+        && bench_matches(output, ref->compacted.data(), sizeof(GLuint) * kept)) && ok;
+    gl_state_delete_buffers(1, &flags);
+    gl_state_delete_buffers(1, &counted);
+
+    GLuint bins = bench_buffer(NULL, sizeof(GLuint) * 256, "bench bins");
+    gpu_histogram(p, input, n, 8, 256, bins);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpu_histogram(p, input, n, 8, 256, bins);
+    glEndQuery(GL_TIME_ELAPSED);
+    ok = bench_report(out, p, "histogram (256 bins)", n, bench_ms(query),
+        bench_matches(bins, ref->histogram.data(), sizeof(GLuint) * 256)) && ok;
+    gl_state_delete_buffers(1, &bins);
+
+    // The sorts' inputs go back up before the timed run: the warm-up sorted them
+    std::vector<uint32_t> index(n);
+    for (uint32_t i = 0; i < n; ++i)
+        index[i] = i;
+    gl_dsa_buffer_sub_data(output, 0, bytes, index.data());
+    gpu_radix_sort(p, input, output, n, 32);
+    gl_dsa_buffer_sub_data(input, 0, bytes, ref->keys.data());
+    gl_dsa_buffer_sub_data(output, 0, bytes, index.data());
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpu_radix_sort(p, input, output, n, 32);
+    glEndQuery(GL_TIME_ELAPSED);
+    ok = bench_report(out, p, "radix sort 32 + value", n, bench_ms(query),
+        bench_matches(input, ref->sorted_keys.data(), bytes) && bench_matches(output, ref->sorted_values.data(), bytes))
+        && ok;
+    gl_state_delete_buffers(1, &input);
+    gl_state_delete_buffers(1, &output);
+
+    input = bench_buffer(ref->wide.data(), 2 * bytes, "bench 64-bit keys");
+    gpu_radix_sort(p, input, 0, n, 64);
+    gl_dsa_buffer_sub_data(input, 0, 2 * bytes, ref->wide.data());
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpu_radix_sort(p, input, 0, n, 64);
+    glEndQuery(GL_TIME_ELAPSED);
+    ok = bench_report(out, p, "radix sort 64", n, bench_ms(query), bench_matches(input, ref->sorted_wide.data(), 2 * bytes))
+        && ok;
+    gl_state_delete_buffers(1, &input);
+    return ok;
+}
+
+bool gpu_primitives_benchmark(uint32_t max_count, FILE* out)
+{
+    GpuPrimitives variants[2];
+    int variant_count = 0;
+    if (!gpu_primitives_supported() || !gpu_primitives_init(&variants[0], false))
+    {
+        fprintf(stderr, "gpu_primitives: needs a 4.3 context\n");
+        return false;
+    }
+    variant_count = 1;
+    if (gpu_primitives_init(&variants[1], true))
+    {
+        if (variants[1].subgroups)
+            variant_count = 2;
+        else
+            gpu_primitives_destroy(&variants[1]);
+    }
+    fprintf(out, "GPU primitives, %s\n", variant_count == 2 ? "plain and with subgroups"
+        : "plain only (no GL_KHR_shader_subgroup arithmetic in compute shaders)");
+
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    const uint32_t sizes[] = { 1000000, 10000000, 100000000 };
+    bool ok = true;
+    int ran = 0;
+    for (uint32_t size : sizes)
+    {
+        const uint32_t n = size <= max_count ? size : !ran ? max_count : 0;
+        if (!n)
+            break;
+        Reference ref;
+        reference_init(&ref, n);
+        for (int v = 0; v < variant_count; ++v)
+        {
+            const bool passed = bench_size(&variants[v], &ref, query, out);
+            if (glGetError() == GL_OUT_OF_MEMORY)
+            {
+                fprintf(out, "  %u elements don't fit in video memory; stopping there\n", n);
+                max_count = 0;
+                break;
+            }
+            ok = passed && ok;
+            ++ran;
+        }
+    }
+    glDeleteQueries(1, &query);
+    for (int v = 0; v < variant_count; ++v)
+        gpu_primitives_destroy(&variants[v]);
+    return ok && ran > 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Data-parallel building blocks in compute shaders (needs a 4.3 context): an
+// exclusive prefix sum, stream compaction, a stable LSD radix sort of 32- or
+// 64-bit keys with optional 32-bit values, and a histogram. They work on the
+// caller's buffers of tightly packed uints (uvec2s for 64-bit keys), leave
+// their results in GPU memory and end with the memory barrier shader storage
+// reads after them need; nothing is read back.
+//
+// Everything is built on one tile of GPU_PRIMITIVES_TILE elements per work
+// group. A scan scans its tiles in shared memory, scans the tiles' totals the
+// same way (recursively: four levels cover 2^32 elements) and adds them back.
+// Compaction scans its flags and scatters the kept elements to their scanned
+// places. Each radix sort pass of 4 bits counts the digits per tile into a
+// digit-major table, scans the table, which turns every count into where
+// that tile's run of the digit goes, and scatters: each tile orders itself
+// by the digit with four one-bit splits in shared memory, so every element
+// knows its rank in its digit's run and the pass stays stable. Eight passes
+// sort 32-bit keys and sixteen 64-bit ones, an even number, so the sorted
+// keys end up back in the caller's buffer.
+//
+// With GL_KHR_shader_subgroup's arithmetic operations in compute shaders
+// (gl_ext.KHR_shader_subgroup) the in-tile scan, which every primitive but
+// the histogram runs, is a subgroupInclusiveAdd per subgroup and one more
+// over the subgroups' totals: three barriers instead of the shared-memory
+// ladder's eighteen. The histogram's cost is its shared-memory atomics, which
+// subgroups don't change. Scratch memory grows to the largest input seen and
+// is kept until gpu_primitives_destroy.
+
+#define GPU_PRIMITIVES_TILE 256             // elements per work group (local_size_x in every kernel)
+#define GPU_PRIMITIVES_SCAN_LEVELS 4        // tile totals scanned in turn: TILE^4 = 2^32 elements
+#define GPU_PRIMITIVES_MAX_BINS 4096        // histogram bins, in shared memory
+#define GPU_PRIMITIVES_RADIX_BITS 4         // key bits a sort pass orders by
+
+// A compute program and its uniforms (-1: the kernel has none by that name)
+typedef struct GpuKernel
+{
+    GLuint program;
+    GLint count_location;       // elements
+    GLint tiles_location;       // work groups the dispatch covers
+    GLint shift_location;       // the digit's or the bins' lowest key bit
+    GLint option_location;      // the kernel's own: scan flags, sort values, bin count
+} GpuKernel;
+
+typedef struct GpuPrimitives
+{
+    bool subgroups;             // built with the subgroup scan
+    GpuKernel scan_tiles;       // each tile scanned, its total kept
+    GpuKernel scan_add;         // the scanned totals added back
+    GpuKernel compact;          // kept elements scattered
+    GpuKernel histogram;
+    GpuKernel radix_count[2];   // [0]: 32-bit keys, [1]: 64-bit
+    GpuKernel radix_scatter[2];
+    GLuint scan_sums[GPU_PRIMITIVES_SCAN_LEVELS];   // each level's tile totals
+    GLsizeiptr scan_sums_bytes[GPU_PRIMITIVES_SCAN_LEVELS];
+    GLuint scratch;             // compaction's scanned flags, a sort's keys between passes
+    GLsizeiptr scratch_bytes;
+    GLuint value_scratch;       // a sort's values between passes
+    GLsizeiptr value_scratch_bytes;
+    GLuint table;               // a sort pass's digit counts per tile
+    GLsizeiptr table_bytes;
+} GpuPrimitives;
+
+// A 4.3 context: compute shaders and shader storage
+bool gpu_primitives_supported(void);
+
+// Builds the kernels, with the subgroup scan when "subgroups" asks for it and the context can (gl_ext loaded, a
+// subgroup of at least 16 invocations so one subgroup can scan a tile's totals); without it otherwise. Logs and
+// returns false when a kernel fails to build.
+bool gpu_primitives_init(GpuPrimitives* p, bool subgroups);
+void gpu_primitives_destroy(GpuPrimitives* p);
+
+// output[i] = input[0] + ... + input[i - 1] for i < count, uint arithmetic (wrapping). "output" may be "input".
+void gpu_scan_exclusive(GpuPrimitives* p, GLuint input, GLuint output, uint32_t count);
+
+// The input[i] whose flags[i] isn't 0, in order, packed at the start of "output"; how many, to the first uint of
+// "counted". "output" is another buffer than "input".
+void gpu_compact(GpuPrimitives* p, GLuint input, GLuint flags, GLuint output, GLuint counted, uint32_t count);
+
+// bins[b] = how many input[i] have (input[i] >> shift) & (bin_count - 1) == b. "bin_count" is a power of two up to
+// GPU_PRIMITIVES_MAX_BINS; the first bin_count uints of "bins" are overwritten.
+void gpu_histogram(GpuPrimitives* p, GLuint input, uint32_t count, uint32_t shift, uint32_t bin_count, GLuint bins);
+
+// Sorts "count" keys ascending in place, uints for key_bits 32, uvec2s (low word first) for 64, and with them the
+// uint values in "values" (0: keys alone). Stable.
+void gpu_radix_sort(GpuPrimitives* p, GLuint keys, GLuint values, uint32_t count, int key_bits);
+
+// Times every primitive on 1M, 10M and 100M random elements (up to "max_count"), once plain and, where the context
+// has them, once with subgroups, checking each result against the CPU's. One line per primitive and size to "out";
+// false when a result is wrong or nothing could run.
+bool gpu_primitives_benchmark(uint32_t max_count, FILE* out);
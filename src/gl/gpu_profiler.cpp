@@ -0,0 +1,522 @@
+#include "gl/gpu_profiler.h"
+#include "gl/draw_sampler.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_ext.h"
+
+#include "core/cpu_trace.h"
+#include "core/hitch_detector.h"
+#include "core/telemetry.h"
+
+#include <GLFW/glfw3.h>
+
+#include <string.h>
+
+const char* const gpu_statistic_names[GPU_STATISTIC_COUNT] = {
+    "vs invocations", "clipping in", "clipping out", "fs invocations", "cs invocations",
+};
+
+static_assert(GPU_COUNTERS_SLOTS == GPU_PROFILER_LATENCY && GPU_COUNTERS_SAMPLES >= GPU_PROFILER_MAX_SEGMENTS,
+    "gl/gpu_counters.h keeps a sample per profiler set per frame in flight");
+
+static const GLenum statistic_targets[GPU_STATISTIC_COUNT] = {
+    GL_VERTEX_SHADER_INVOCATIONS, GL_CLIPPING_INPUT_PRIMITIVES, GL_CLIPPING_OUTPUT_PRIMITIVES,
+    GL_FRAGMENT_SHADER_INVOCATIONS, GL_COMPUTE_SHADER_INVOCATIONS,
+};
+
+// The CPU counters put on the trace, next to the statistics under their own names
+static const char* const counter_series[] = { "draws", "triangles", "state changes", "upload bytes" };
+
+// Reads the GPU's clock and the trace's together. GL_TIMESTAMP is the time the GPU has reached once the
+// commands before it have been processed, so a flush first keeps that close to now.
+static void trace_sync(GpuProfiler* p)
+{
+    glFlush();
+    glGetInteger64v(GL_TIMESTAMP, &p->trace_sync_gpu);
+    p->trace_sync_ticks = cpu_trace_now();
+}
+
+// A GL_TIMESTAMP result on the trace clock
+static uint64_t trace_ticks(const GpuProfiler* p, GLuint64 gpu)
+{
+    return p->trace_sync_ticks + (uint64_t)(int64_t)((double)(int64_t)(gpu - (GLuint64)p->trace_sync_gpu)
+        * cpu_trace_ticks_per_ns());
+}
+
+bool gpu_profiler_init(GpuProfiler* p, bool enabled, const char* csv_path)
+{
+    memset(p, 0, sizeof(*p));
+    p->trace_track = -1;
+    p->counter_track = -1;
+    gpu_profiler_set_enabled(p, enabled);
+    if (!enabled)
+        return true;
+
+    if (csv_path)
+    {
+        p->csv = fopen(csv_path, "w");
+        if (!p->csv)
+        {
+            fprintf(stderr, "gpu_profiler: can't open %s for writing\n", csv_path);
+            return false;
+        }
+        fprintf(p->csv, "frame,scope,depth,cpu_ms,gpu_ms,draws,indirect_draws,instances,triangles,dispatches,"
+            "upload_bytes,state_changes,vs_invocations,clipping_in,clipping_out,fs_invocations,cs_invocations\n");
+    }
+    return true;
+}
+
+void gpu_profiler_set_enabled(GpuProfiler* p, bool enabled)
+{
+    if (enabled && !p->created)
+    {
+        for (int f = 0; f < GPU_PROFILER_LATENCY; ++f)
+            glGenQueries(GPU_PROFILER_MAX_SCOPES * 2, p->frames[f].queries);
+        p->created = true;
+        p->trace_track = cpu_trace_track("GPU");
+        p->counter_track = p->trace_track >= 0 ? cpu_trace_track("GPU counters") : -1;
+        if (p->trace_track >= 0)
+            trace_sync(p);
+    }
+    if (!enabled)
+    {
+        // Whatever is in flight is dropped: its queries are reissued before being read again
+        for (int f = 0; f < GPU_PROFILER_LATENCY; ++f)
+            p->frames[f].pending = false;
+    }
+    p->enabled = enabled;
+}
+
+bool gpu_profiler_set_statistics(GpuProfiler* p, bool enabled)
+{
+    if (enabled && !gl_ext.ARB_pipeline_statistics_query)
+        return false;
+    if (enabled && !p->statistics_created)
+    {
+        for (int f = 0; f < GPU_PROFILER_LATENCY; ++f)
+            glGenQueries(GPU_PROFILER_MAX_SEGMENTS * GPU_STATISTIC_COUNT, &p->frames[f].statistics[0][0]);
+        p->statistics_created = true;
+    }
+    // Frames in flight keep their sets either way: the queries stay, and a frame with none has nothing to read
+    p->statistics = enabled;
+    return true;
+}
+
+void gpu_profiler_destroy(GpuProfiler* p)
+{
+    if (!p->created)
+        return;
+    for (int f = 0; f < GPU_PROFILER_LATENCY; ++f)
+        glDeleteQueries(GPU_PROFILER_MAX_SCOPES * 2, p->frames[f].queries);
+    if (p->statistics_created)
+    {
+        for (int f = 0; f < GPU_PROFILER_LATENCY; ++f)
+            glDeleteQueries(GPU_PROFILER_MAX_SEGMENTS * GPU_STATISTIC_COUNT, &p->frames[f].statistics[0][0]);
+    }
+    if (p->csv)
+        fclose(p->csv);
+    memset(p, 0, sizeof(*p));
+}
+
+static GpuProfilerStats* find_stats(GpuProfiler* p, const char* name)
+{
+    for (int i = 0; i < p->stat_count; ++i)
+    {
+        if (p->stats[i].name == name || !strcmp(p->stats[i].name, name))
+            return &p->stats[i];
+    }
+    if (p->stat_count == GPU_PROFILER_MAX_NAMES)
+        return NULL;
+    GpuProfilerStats* s = &p->stats[p->stat_count++];
+    memset(s, 0, sizeof(*s));
+    s->name = name;
+    return s;
+}
+
+// Adds up a frame's pipeline statistics per scope, each scope's sets plus its children's; false when they aren't
+// all in yet
+static bool collect_statistics(const GpuProfilerFrame* frame, uint64_t (*totals)[GPU_STATISTIC_COUNT])
+{
+    memset(totals, 0, sizeof(uint64_t) * GPU_STATISTIC_COUNT * frame->count);
+    for (int k = 0; k < GPU_STATISTIC_COUNT; ++k)
+    {
+        // Sets end in order, but the counts of different statistics needn't land together
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame->statistics[frame->segment_count - 1][k], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+    for (int s = 0; s < frame->segment_count; ++s)
+    {
+        for (int k = 0; k < GPU_STATISTIC_COUNT; ++k)
+        {
+            GLuint64 count = 0;
+            glGetQueryObjectui64v(frame->statistics[s][k], GL_QUERY_RESULT, &count);
+            totals[frame->segment_scope[s]][k] += count;
+        }
+    }
+    // Children come after their parents, so going backwards each scope is complete before it's added upwards
+    for (int i = frame->count - 1; i >= 0; --i)
+    {
+        const int parent = frame->scopes[i].parent;
+        for (int k = 0; parent >= 0 && k < GPU_STATISTIC_COUNT; ++k)
+            totals[parent][k] += totals[i][k];
+    }
+    return true;
+}
+
+// A GL_TIMESTAMP query's result, known to be in
+static GLuint64 timestamp(const GpuProfilerFrame* frame, int query)
+{
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(frame->queries[query], GL_QUERY_RESULT, &ns);
+    return ns;
+}
+
+// The same for the hardware counters: counts add up, rates average over the sets' GPU time
+static bool collect_hardware(GpuProfiler* p, const GpuProfilerFrame* frame, double (*totals)[GPU_COUNTERS_MAX])
+{
+    GpuCounters* c = p->hardware;
+    const int slot = (int)(frame - p->frames);
+    double weights[GPU_PROFILER_MAX_SCOPES] = {};
+    memset(totals, 0, sizeof(double) * GPU_COUNTERS_MAX * frame->count);
+    for (int s = 0; s < frame->segment_count; ++s)
+    {
+        double values[GPU_COUNTERS_MAX];
+        if (!gpu_counters_read(c, slot, s, values))
+            return false;
+        const double ms = (double)(timestamp(frame, frame->segment_end[s])
+            - timestamp(frame, frame->segment_begin[s])) * 1e-6;
+        const int scope = frame->segment_scope[s];
+        weights[scope] += ms;
+        for (int k = 0; k < c->count; ++k)
+            totals[scope][k] += c->counters[k].rate ? values[k] * ms : values[k];
+    }
+    for (int i = frame->count - 1; i >= 0; --i)
+    {
+        const int parent = frame->scopes[i].parent;
+        if (parent >= 0)
+            weights[parent] += weights[i];
+        for (int k = 0; parent >= 0 && k < c->count; ++k)
+            totals[parent][k] += totals[i][k];
+    }
+    for (int i = 0; i < frame->count; ++i)
+    {
+        for (int k = 0; k < c->count; ++k)
+        {
+            if (c->counters[k].rate)
+                totals[i][k] = weights[i] > 0.0 ? totals[i][k] / weights[i] : 0.0;
+        }
+    }
+    return true;
+}
+
+// Reads back a frame recorded GPU_PROFILER_LATENCY frames ago, without waiting
+static void collect(GpuProfiler* p, GpuProfilerFrame* frame)
+{
+    frame->pending = false;
+    if (!frame->count)
+        return;
+
+    // Timestamps complete in order, so the last one being available means they all are
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(frame->queries[frame->count * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        ++p->dropped;
+        return;
+    }
+    uint64_t statistics[GPU_PROFILER_MAX_SCOPES][GPU_STATISTIC_COUNT];
+    const bool counted = frame->segment_count && frame->segment_statistics && collect_statistics(frame, statistics);
+    double hardware[GPU_PROFILER_MAX_SCOPES][GPU_COUNTERS_MAX];
+    const bool sampled = frame->segment_count && frame->segment_hardware && p->hardware
+        && collect_hardware(p, frame, hardware);
+
+    for (int i = 0; i < frame->count; ++i)
+    {
+        const GpuProfilerScope* scope = &frame->scopes[i];
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame->queries[i * 2], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame->queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+        const double gpu_ms = (double)(end - begin) * 1e-6;
+        const double cpu_ms = (scope->cpu_end - scope->cpu_begin) * 1e3;
+        const DrawCounters* c = &scope->counters;
+
+        if (GpuProfilerStats* s = find_stats(p, scope->name))
+        {
+            s->cpu_ms += cpu_ms;
+            s->gpu_ms += gpu_ms;
+            if (gpu_ms > s->gpu_ms_max)
+                s->gpu_ms_max = gpu_ms;
+            s->gpu_ms_last = gpu_ms;
+            s->last_frame = frame->frame_index;
+            ++s->samples;
+            draw_counters_add(&s->counters, c);
+            s->counters_last = *c;
+            if (counted)
+            {
+                for (int k = 0; k < GPU_STATISTIC_COUNT; ++k)
+                    s->statistics[k] += statistics[i][k];
+                memcpy(s->statistics_last, statistics[i], sizeof(s->statistics_last));
+                ++s->statistics_samples;
+            }
+            if (sampled)
+            {
+                for (int k = 0; k < p->hardware->count; ++k)
+                    s->hardware[k] += hardware[i][k];
+                ++s->hardware_samples;
+            }
+        }
+        if (p->csv)
+        {
+            fprintf(p->csv, "%u,%s,%d,%.4f,%.4f,%llu,%llu,%llu,%llu,%llu,%llu,%llu", frame->frame_index, scope->name,
+                scope->depth, cpu_ms, gpu_ms, (unsigned long long)c->draws, (unsigned long long)c->indirect_draws,
+                (unsigned long long)c->instances, (unsigned long long)c->triangles, (unsigned long long)c->dispatches,
+                (unsigned long long)c->upload_bytes, (unsigned long long)c->state_changes);
+            for (int k = 0; k < GPU_STATISTIC_COUNT; ++k)
+            {
+                if (counted)
+                    fprintf(p->csv, ",%llu", (unsigned long long)statistics[i][k]);
+                else
+                    fputc(',', p->csv);
+            }
+            fputc('\n', p->csv);
+        }
+        if (scope->depth <= 1)
+            telemetry_pass(frame->frame_index, scope->name, cpu_ms, gpu_ms);      // the frame and its passes
+        if (p->trace_track >= 0)
+            cpu_trace_emit(p->trace_track, scope->name, trace_ticks(p, begin), trace_ticks(p, end));
+        if (p->counter_track >= 0)
+        {
+            const uint64_t at = trace_ticks(p, begin);
+            const double values[] = { (double)c->draws, (double)c->triangles, (double)c->state_changes,
+                (double)c->upload_bytes };
+            for (int k = 0; k < (int)(sizeof(values) / sizeof(values[0])); ++k)
+                cpu_trace_counter(p->counter_track, scope->name, counter_series[k], at, values[k]);
+            for (int k = 0; counted && k < GPU_STATISTIC_COUNT; ++k)
+                cpu_trace_counter(p->counter_track, scope->name, gpu_statistic_names[k], at, (double)statistics[i][k]);
+            for (int k = 0; sampled && k < p->hardware->count; ++k)
+                cpu_trace_counter(p->counter_track, scope->name, p->hardware->counters[k].name, at, hardware[i][k]);
+        }
+    }
+}
+
+// Ends the running set of statistics queries and hardware sample at timestamp query "boundary" and, for a scope
+// ("scope" >= 0) while the frame has sets, starts the next there
+static void switch_segment(GpuProfiler* p, GpuProfilerFrame* frame, int scope, int boundary)
+{
+    if (p->segment_open)
+    {
+        const int open = frame->segment_count - 1;
+        for (int k = 0; frame->segment_statistics && k < GPU_STATISTIC_COUNT; ++k)
+            glEndQuery(statistic_targets[k]);
+        if (frame->segment_hardware)
+            gpu_counters_end(p->hardware, p->current, open);
+        frame->segment_end[open] = (unsigned char)boundary;
+        p->segment_open = false;
+    }
+    if (scope < 0 || !(frame->segment_statistics || frame->segment_hardware)
+        || frame->segment_count == GPU_PROFILER_MAX_SEGMENTS)
+        return;
+    const int segment = frame->segment_count++;
+    frame->segment_scope[segment] = (signed char)scope;
+    frame->segment_begin[segment] = (unsigned char)boundary;
+    for (int k = 0; frame->segment_statistics && k < GPU_STATISTIC_COUNT; ++k)
+        glBeginQuery(statistic_targets[k], frame->statistics[segment][k]);
+    if (frame->segment_hardware)
+        gpu_counters_begin(p->hardware, p->current, segment);
+    p->segment_open = true;
+}
+
+void gpu_profiler_begin_frame(GpuProfiler* p)
+{
+    if (p->draws)
+        draw_sampler_begin_frame(p->draws);
+    if (!p->enabled)
+        return;
+    GpuProfilerFrame* frame = &p->frames[p->current];
+    if (frame->pending)
+        collect(p, frame);
+    frame->count = 0;
+    frame->segment_count = 0;
+    frame->segment_statistics = p->statistics;
+    frame->segment_hardware = p->hardware && p->hardware->count;
+    frame->frame_index = p->frame_index;
+    p->depth = 0;
+    if (p->trace_track >= 0 && p->frame_index % GPU_PROFILER_TRACE_SYNC == 0)
+        trace_sync(p);      // the two clocks drift apart slowly
+}
+
+void gpu_profiler_end_frame(GpuProfiler* p)
+{
+    if (p->draws)
+        draw_sampler_end_frame(p->draws);
+    if (!p->enabled)
+        return;
+    while (p->depth > 0)
+        gpu_profiler_pop(p);    // close anything left open rather than lose the frame
+    p->frames[p->current].pending = true;
+    p->current = (p->current + 1) % GPU_PROFILER_LATENCY;
+    ++p->frame_index;
+}
+
+void gpu_profiler_push(GpuProfiler* p, const char* name)
+{
+    gl_debug_push(name);
+    if (p->hitches)
+        hitch_detector_push(p->hitches, name, glfwGetTime());
+    if (p->draws)
+        draw_sampler_push(p->draws, name);
+    if (!p->enabled)
+        return;
+    GpuProfilerFrame* frame = &p->frames[p->current];
+    if (frame->count == GPU_PROFILER_MAX_SCOPES || p->depth == GPU_PROFILER_MAX_DEPTH)
+    {
+        // Keep push/pop balanced even when the scope isn't recorded; its work counts for its parent
+        if (p->depth < GPU_PROFILER_MAX_DEPTH)
+            p->stack[p->depth] = -1;
+        ++p->depth;
+        return;
+    }
+    const int index = frame->count++;
+    GpuProfilerScope* scope = &frame->scopes[index];
+    scope->name = name;
+    scope->depth = p->depth;
+    scope->parent = p->depth ? p->stack[p->depth - 1] : -1;
+    draw_counters_read(&scope->counters);
+    scope->cpu_begin = glfwGetTime();
+    glQueryCounter(frame->queries[index * 2], GL_TIMESTAMP);
+    switch_segment(p, frame, index, index * 2);
+    p->stack[p->depth++] = index;
+}
+
+void gpu_profiler_pop(GpuProfiler* p)
+{
+    gl_debug_pop();
+    if (p->hitches)
+        hitch_detector_pop(p->hitches, glfwGetTime());
+    if (p->draws)
+        draw_sampler_pop(p->draws);
+    if (!p->enabled || p->depth == 0)
+        return;
+    --p->depth;
+    const int index = p->depth < GPU_PROFILER_MAX_DEPTH ? p->stack[p->depth] : -1;
+    if (index < 0)
+        return;
+    GpuProfilerFrame* frame = &p->frames[p->current];
+    GpuProfilerScope* scope = &frame->scopes[index];
+    glQueryCounter(frame->queries[index * 2 + 1], GL_TIMESTAMP);
+    switch_segment(p, frame, scope->parent, index * 2 + 1);
+    scope->cpu_end = glfwGetTime();
+    DrawCounters now;
+    draw_counters_read(&now);
+    draw_counters_difference(&scope->counters, &scope->counters, &now);
+}
+
+void gpu_profiler_flush(GpuProfiler* p)
+{
+    if (!p->enabled)
+        return;
+    glFinish();
+    for (int i = 0; i < GPU_PROFILER_LATENCY; ++i)
+    {
+        // Oldest first, so the CSV stays in frame order
+        GpuProfilerFrame* frame = &p->frames[(p->current + i) % GPU_PROFILER_LATENCY];
+        if (frame->pending)
+            collect(p, frame);
+    }
+}
+
+bool gpu_profiler_average(const GpuProfiler* p, const char* name, double* cpu_ms, double* gpu_ms)
+{
+    for (int i = 0; i < p->stat_count; ++i)
+    {
+        const GpuProfilerStats* s = &p->stats[i];
+        if (strcmp(s->name, name) || !s->samples)
+            continue;
+        *cpu_ms = s->cpu_ms / s->samples;
+        *gpu_ms = s->gpu_ms / s->samples;
+        return true;
+    }
+    return false;
+}
+
+bool gpu_profiler_latest(const GpuProfiler* p, const char* name, unsigned int* frame_index, double* gpu_ms)
+{
+    for (int i = 0; i < p->stat_count; ++i)
+    {
+        const GpuProfilerStats* s = &p->stats[i];
+        if (strcmp(s->name, name) || !s->samples)
+            continue;
+        *frame_index = s->last_frame;
+        *gpu_ms = s->gpu_ms_last;
+        return true;
+    }
+    return false;
+}
+
+void gpu_profiler_print(const GpuProfiler* p, FILE* out)
+{
+    if (!p->enabled)
+        return;
+    fprintf(out, "%-16s %8s %10s %10s %10s\n", "scope", "frames", "cpu ms", "gpu ms", "gpu max");
+    for (int i = 0; i < p->stat_count; ++i)
+    {
+        const GpuProfilerStats* s = &p->stats[i];
+        if (!s->samples)
+            continue;
+        fprintf(out, "%-16s %8u %10.3f %10.3f %10.3f\n", s->name, s->samples,
+            s->cpu_ms / s->samples, s->gpu_ms / s->samples, s->gpu_ms_max);
+    }
+    if (p->dropped)
+        fprintf(out, "(%u frames dropped, results not ready after %d frames)\n", p->dropped, GPU_PROFILER_LATENCY);
+
+    fprintf(out, "%-16s %9s %9s %11s %11s %10s %9s %11s\n", "per frame", "draws", "indirect", "instances", "triangles",
+        "dispatches", "state", "upload KB");
+    for (int i = 0; i < p->stat_count; ++i)
+    {
+        const GpuProfilerStats* s = &p->stats[i];
+        if (!s->samples)
+            continue;
+        const double n = s->samples;
+        const DrawCounters* c = &s->counters;
+        fprintf(out, "%-16s %9.1f %9.1f %11.0f %11.0f %10.1f %9.1f %11.1f\n", s->name, c->draws / n,
+            c->indirect_draws / n, c->instances / n, c->triangles / n, c->dispatches / n, c->state_changes / n,
+            c->upload_bytes / n / 1024.0);
+    }
+
+    // One block per pass: the counters' names are the driver's, too long for columns
+    for (int i = 0; p->hardware && i < p->stat_count; ++i)
+    {
+        const GpuProfilerStats* s = &p->stats[i];
+        if (!s->hardware_samples)
+            continue;
+        fprintf(out, "%s, per frame:\n", s->name);
+        for (int k = 0; k < p->hardware->count; ++k)
+            fprintf(out, "  %-48s %14.3f\n", p->hardware->counters[k].name, s->hardware[k] / s->hardware_samples);
+    }
+
+    bool any = false;
+    for (int i = 0; i < p->stat_count && !any; ++i)
+        any = p->stats[i].statistics_samples > 0;
+    if (!any)
+        return;
+    fprintf(out, "%-16s", "per frame");
+    for (int k = 0; k < GPU_STATISTIC_COUNT; ++k)
+        fprintf(out, " %15s", gpu_statistic_names[k]);
+    fprintf(out, " %8s\n", "clipped");
+    for (int i = 0; i < p->stat_count; ++i)
+    {
+        const GpuProfilerStats* s = &p->stats[i];
+        if (!s->statistics_samples)
+            continue;
+        fprintf(out, "%-16s", s->name);
+        for (int k = 0; k < GPU_STATISTIC_COUNT; ++k)
+            fprintf(out, " %15.0f", (double)s->statistics[k] / s->statistics_samples);
+        // The share of primitives clipping took away (frustum and guard band); above 0 means split ones outnumber it
+        const uint64_t in = s->statistics[GPU_STATISTIC_CLIPPING_IN], kept = s->statistics[GPU_STATISTIC_CLIPPING_OUT];
+        if (in)
+            fprintf(out, " %7.1f%%\n", 100.0 * (1.0 - (double)kept / in));
+        else
+            fprintf(out, " %8s\n", "-");
+    }
+}
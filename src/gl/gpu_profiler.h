@@ -0,0 +1,176 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/draw_counters.h"
+#include "gl/gpu_counters.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Scoped CPU + GPU frame timing.
+//
+// Each gpu_profiler_push/pop pair brackets a pass with two GL_TIMESTAMP
+// queries (glQueryCounter), so scopes can nest, and records glfwGetTime() on
+// the CPU side at the same points. Query objects come from a pool with one set
+// per frame in flight; a frame's results are read GPU_PROFILER_LATENCY frames
+// later, when the queries have long completed, so reading them never stalls
+// the pipeline. A frame that still isn't available by then is dropped rather
+// than waited for.
+//
+// Per-scope results are accumulated per name and optionally written out as
+// CSV (frame,scope,depth,cpu_ms,gpu_ms, then the CPU counters and the
+// pipeline statistics, empty when not gathered), one row per scope per frame.
+//
+// While a CPU trace is recording (core/cpu_trace.h) the GPU times also go on
+// its "GPU" track: GL_TIMESTAMP and the trace clock are read together every
+// GPU_PROFILER_TRACE_SYNC frames, and each query is placed on the CPU
+// timeline from the latest pair.
+//
+// Every scope is also a GL debug group of the same name (gl/gl_debug.h), even
+// with the profiler off. That part only exists in debug builds. So too, a
+// core/hitch_detector.h set in "hitches" is told of every scope as a pass.
+// While core/telemetry.h records, each frame's top two levels of scopes go
+// into its ring as they're read back.
+//
+// Each scope also gets what the CPU submitted inside it (gl/draw_counters.h:
+// draws, instances, triangles, dispatches, uploads, state changes), read at
+// its push and pop. With gpu_profiler_set_statistics, the GPU's own counts
+// come too (GL_ARB_pipeline_statistics_query, core in 4.6): vertex shader
+// invocations, primitives in and out of clipping, fragment and compute shader
+// invocations. Only one query per target can be active, so they can't nest
+// like the timestamps: every push and pop ends the running set of queries and
+// starts another for the innermost open scope, and a scope's totals are its
+// own sets plus its children's, added up when the frame is read back with
+// the timestamps. A set costs five queries begun and ended.
+//
+// A GpuCounters set in "hardware" (gl/gpu_counters.h) samples the GPU's
+// hardware counters over the same sets, weighting its rates by each set's
+// GPU time, which the timestamps of the push or pop at either end give.
+// While tracing, all three kinds go on a "GPU counters" track as counter
+// events per scope.
+//
+// A gl/draw_sampler.h set in "draws" is told of every frame and scope, timing
+// on or off, so the frames it samples time each draw between the passes'.
+
+#define GPU_PROFILER_LATENCY 4          // frames between issuing a query and reading it
+#define GPU_PROFILER_MAX_SCOPES 32      // per frame
+#define GPU_PROFILER_MAX_DEPTH 8
+#define GPU_PROFILER_MAX_NAMES 32       // distinct scope names with accumulated stats
+#define GPU_PROFILER_TRACE_SYNC 256     // frames between GPU / trace clock readings
+#define GPU_PROFILER_MAX_SEGMENTS (GPU_PROFILER_MAX_SCOPES * 2)    // pipeline statistics sets per frame
+
+typedef enum GpuStatistic
+{
+    GPU_STATISTIC_VERTEX_SHADER,    // GL_VERTEX_SHADER_INVOCATIONS
+    GPU_STATISTIC_CLIPPING_IN,      // GL_CLIPPING_INPUT_PRIMITIVES
+    GPU_STATISTIC_CLIPPING_OUT,     // GL_CLIPPING_OUTPUT_PRIMITIVES
+    GPU_STATISTIC_FRAGMENT_SHADER,  // GL_FRAGMENT_SHADER_INVOCATIONS
+    GPU_STATISTIC_COMPUTE_SHADER,   // GL_COMPUTE_SHADER_INVOCATIONS
+    GPU_STATISTIC_COUNT
+} GpuStatistic;
+
+extern const char* const gpu_statistic_names[GPU_STATISTIC_COUNT];
+
+typedef struct GpuProfilerScope
+{
+    const char* name;       // borrowed, usually a string literal
+    int depth;
+    int parent;             // the enclosing scope's index, -1 at the top
+    double cpu_begin;       // seconds
+    double cpu_end;
+    DrawCounters counters;  // draw_counters_read at the push, then what was submitted until the pop
+} GpuProfilerScope;
+
+typedef struct GpuProfilerFrame
+{
+    GLuint queries[GPU_PROFILER_MAX_SCOPES * 2];    // begin/end timestamp per scope
+    GpuProfilerScope scopes[GPU_PROFILER_MAX_SCOPES];
+    int count;
+    GLuint statistics[GPU_PROFILER_MAX_SEGMENTS][GPU_STATISTIC_COUNT];   // a query per statistic per set
+    signed char segment_scope[GPU_PROFILER_MAX_SEGMENTS];                   // the scope each set counts for
+    unsigned char segment_begin[GPU_PROFILER_MAX_SEGMENTS];                 // the timestamp queries around it
+    unsigned char segment_end[GPU_PROFILER_MAX_SEGMENTS];
+    int segment_count;
+    bool segment_statistics;    // what the frame's sets hold: pipeline statistics
+    bool segment_hardware;      // and hardware counter samples
+    unsigned int frame_index;
+    bool pending;           // issued, results not collected yet
+} GpuProfilerFrame;
+
+typedef struct GpuProfilerStats
+{
+    const char* name;
+    double cpu_ms;          // totals over "samples" frames
+    double gpu_ms;
+    double gpu_ms_max;
+    double gpu_ms_last;     // the latest frame's
+    unsigned int last_frame;    // and its frame index
+    unsigned int samples;
+    DrawCounters counters;  // totals over "samples" frames
+    DrawCounters counters_last;
+    uint64_t statistics[GPU_STATISTIC_COUNT];   // totals over "statistics_samples" frames
+    uint64_t statistics_last[GPU_STATISTIC_COUNT];
+    unsigned int statistics_samples;
+    double hardware[GPU_COUNTERS_MAX];  // the hardware counters' per frame values, totals over "hardware_samples"
+    unsigned int hardware_samples;
+} GpuProfilerStats;
+
+typedef struct GpuProfiler
+{
+    bool enabled;
+    bool created;           // the query pool exists: enabled once, at init or since
+    bool statistics;        // pipeline statistics are being gathered
+    bool statistics_created;    // and their queries exist
+    bool segment_open;      // a set of statistics queries (or hardware counter sample) is running
+    GpuProfilerFrame frames[GPU_PROFILER_LATENCY];
+    int current;            // frame slot being recorded
+    int stack[GPU_PROFILER_MAX_DEPTH];
+    int depth;
+    unsigned int frame_index;
+    unsigned int dropped;   // frames whose results weren't ready in time
+    GpuProfilerStats stats[GPU_PROFILER_MAX_NAMES];
+    int stat_count;
+    FILE* csv;
+    struct HitchDetector* hitches;  // told of every push and pop, timing on or off; NULL for none
+    struct DrawSampler* draws;      // and of every frame; NULL for none
+    GpuCounters* hardware;  // sampled per set while enabled, set before the first frame; NULL for none
+    int trace_track;        // the CPU trace's GPU track, -1 when not tracing
+    int counter_track;      // and its track of per-scope counters
+    GLint64 trace_sync_gpu;     // GL_TIMESTAMP (ns) and the trace clock, read together
+    uint64_t trace_sync_ticks;
+} GpuProfiler;
+
+// Needs a current context. With "enabled" false every call is a no-op. "csv_path" may be NULL. A CPU trace
+// started before this gets the GPU times too.
+bool gpu_profiler_init(GpuProfiler* p, bool enabled, const char* csv_path);
+void gpu_profiler_destroy(GpuProfiler* p);
+
+// Turns timing on or off at run time, between frames. The queries are created the first time it's turned on;
+// stats accumulated so far are kept.
+void gpu_profiler_set_enabled(GpuProfiler* p, bool enabled);
+
+// Turns the pipeline statistics on or off, between frames; only counted while the profiler is enabled. Returns
+// false (and stays off) when the context has no GL_ARB_pipeline_statistics_query.
+bool gpu_profiler_set_statistics(GpuProfiler* p, bool enabled);
+
+// Bracket every frame; begin collects the results of the frame GPU_PROFILER_LATENCY frames back
+void gpu_profiler_begin_frame(GpuProfiler* p);
+void gpu_profiler_end_frame(GpuProfiler* p);
+
+void gpu_profiler_push(GpuProfiler* p, const char* name);
+void gpu_profiler_pop(GpuProfiler* p);
+
+// Waits for the GPU and collects every frame still in flight (at shutdown, before printing)
+void gpu_profiler_flush(GpuProfiler* p);
+
+// Average CPU/GPU milliseconds per frame for scope "name" so far (false when it has no samples)
+bool gpu_profiler_average(const GpuProfiler* p, const char* name, double* cpu_ms, double* gpu_ms);
+
+// GPU milliseconds of the latest frame read back with scope "name", and that frame's index (false before the
+// first). A frame whose index hasn't been seen before is a new sample, GPU_PROFILER_LATENCY frames old.
+bool gpu_profiler_latest(const GpuProfiler* p, const char* name, unsigned int* frame_index, double* gpu_ms);
+
+// Prints one line per scope name: samples, average CPU ms, average and max GPU ms; then per frame, what the CPU
+// submitted in each and, when gathered, its pipeline statistics and hardware counters
+void gpu_profiler_print(const GpuProfiler* p, FILE* out);
@@ -0,0 +1,195 @@
+#include "gl/gpu_readback.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <string.h>
+
+static const GLbitfield persistent_flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+void gpu_readback_init(GpuReadback* rb)
+{
+    memset(rb, 0, sizeof(*rb));
+    // glad only loads glBufferStorage when the context is 4.4 or newer
+    rb->persistent = glBufferStorage != NULL;
+}
+
+// The slot's staging buffer at "bytes" or more (the slot is free), bound to GL_COPY_WRITE_BUFFER
+static bool slot_reserve(GpuReadback* rb, GpuReadbackSlot* slot, size_t bytes)
+{
+    if (slot->buffer && slot->capacity >= bytes)
+    {
+        gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, slot->buffer);
+        return true;
+    }
+    size_t capacity = GPU_READBACK_MIN_BYTES;
+    while (capacity < bytes)
+        capacity *= 2;
+    if (slot->buffer && slot->mapped)
+    {
+        gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, slot->buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    gl_state_delete_buffers(1, &slot->buffer);
+    slot->buffer = 0;
+    slot->mapped = NULL;
+    slot->capacity = 0;
+
+    // Immutable storage can't be respecified: a new buffer either way
+    glGenBuffers(1, &slot->buffer);
+    gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, slot->buffer);
+    if (rb->persistent)
+    {
+        glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)capacity, NULL, persistent_flags);
+        slot->mapped = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)capacity, persistent_flags);
+        if (!slot->mapped)
+            return false;
+    }
+    else
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)capacity, NULL, GL_STREAM_READ);
+    gl_memory_buffer(slot->buffer, GPU_MEMORY_STAGING, capacity);
+    gl_debug_label(GL_BUFFER, slot->buffer, "readback");
+    slot->capacity = capacity;
+    return true;
+}
+
+// The next slot, its buffer ready for "bytes", or NULL (counted) with every slot in flight
+static GpuReadbackSlot* slot_begin(GpuReadback* rb, size_t bytes)
+{
+    ++rb->requested;
+    GpuReadbackSlot* slot = &rb->slots[(rb->head + rb->count) % GPU_READBACK_SLOTS];
+    if (rb->count == GPU_READBACK_SLOTS || !bytes || !slot_reserve(rb, slot, bytes))
+    {
+        ++rb->dropped;
+        return NULL;
+    }
+    return slot;
+}
+
+static void slot_commit(GpuReadback* rb, GpuReadbackSlot* slot, size_t bytes, void* dest, GpuReadbackFunction done,
+    void* user)
+{
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->bytes = bytes;
+    slot->dest = dest;
+    slot->done = done;
+    slot->user = user;
+    slot->frame = rb->frame;
+    ++rb->count;
+}
+
+bool gpu_readback_buffer(GpuReadback* rb, GLuint source, GLintptr offset, size_t bytes, void* dest,
+    GpuReadbackFunction done, void* user)
+{
+    GpuReadbackSlot* slot = slot_begin(rb, bytes);
+    if (!slot)
+        return false;
+    // The copy reads what shaders wrote (4.2+); queued, so it returns at once
+    if (glMemoryBarrier)
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    gl_state_bind_buffer(GL_COPY_READ_BUFFER, source);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, (GLsizeiptr)bytes);
+    slot_commit(rb, slot, bytes, dest, done, user);
+    return true;
+}
+
+bool gpu_readback_pixels(GpuReadback* rb, GLuint framebuffer, GLenum read_buffer, int x, int y, int width, int height,
+    GLenum format, GLenum type, size_t bytes, void* dest, GpuReadbackFunction done, void* user)
+{
+    GpuReadbackSlot* slot = slot_begin(rb, bytes);
+    if (!slot)
+        return false;
+    // Into the buffer, not client memory: glReadPixels returns as soon as the copy is queued. Image stores (4.2)
+    // are the only writes it wouldn't see without a barrier.
+    if (glMemoryBarrier)
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(read_buffer);
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    glReadPixels(x, y, width, height, format, type, (void*)0);
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);     // glReadPixels elsewhere reads into client memory
+    slot_commit(rb, slot, bytes, dest, done, user);
+    return true;
+}
+
+// The oldest request, once its fence says it's done ("wait": however long that takes): its bytes to the caller
+static bool slot_finish(GpuReadback* rb, bool wait)
+{
+    GpuReadbackSlot* slot = &rb->slots[rb->head];
+    GLenum status = glClientWaitSync(slot->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);   // asks, doesn't wait
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);    // 1 ms slices
+    const bool signalled = status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    if (!signalled && !wait)
+        return false;
+    glDeleteSync(slot->fence);
+    slot->fence = NULL;
+    rb->head = (rb->head + 1) % GPU_READBACK_SLOTS;
+    --rb->count;
+    if (!signalled)
+        return true;        // GL_WAIT_FAILED: lost, and the slot's free again
+
+    const uint8_t* data = slot->mapped;
+    if (!data)
+    {
+        gl_state_bind_buffer(GL_COPY_READ_BUFFER, slot->buffer);
+        data = (const uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)slot->bytes, GL_MAP_READ_BIT);
+        if (!data)
+            return true;
+    }
+    if (slot->dest)
+        memcpy(slot->dest, data, slot->bytes);
+    if (slot->done)
+        slot->done(slot->user, slot->dest ? slot->dest : data, slot->bytes, slot->frame);
+    if (!slot->mapped)
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+    ++rb->completed;
+    rb->bytes += slot->bytes;
+    rb->latency += rb->frame - slot->frame;
+    rb->waits += wait;
+    return true;
+}
+
+void gpu_readback_poll(GpuReadback* rb, unsigned int frame)
+{
+    rb->frame = frame;
+    while (rb->count && slot_finish(rb, false))
+    {
+    }
+}
+
+void gpu_readback_finish(GpuReadback* rb)
+{
+    while (rb->count)
+        slot_finish(rb, true);
+}
+
+void gpu_readback_destroy(GpuReadback* rb)
+{
+    for (int i = 0; i < GPU_READBACK_SLOTS; ++i)
+    {
+        GpuReadbackSlot* slot = &rb->slots[i];
+        if (slot->fence)
+            glDeleteSync(slot->fence);
+        if (slot->mapped)
+        {
+            gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, slot->buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+        gl_state_delete_buffers(1, &slot->buffer);
+    }
+    memset(rb, 0, sizeof(*rb));
+}
+
+void gpu_readback_print(const GpuReadback* rb, FILE* out)
+{
+    size_t staging = 0;
+    for (int i = 0; i < GPU_READBACK_SLOTS; ++i)
+        staging += rb->slots[i].capacity;
+    fprintf(out, "readback: %llu of %llu requests back %.2f frames later on average (%llu waited for at the end, "
+        "%llu dropped), %.1f KB in %.1f KB of staging (%s)\n", (unsigned long long)rb->completed,
+        (unsigned long long)rb->requested, rb->completed ? (double)rb->latency / rb->completed : 0.0,
+        (unsigned long long)rb->waits, (unsigned long long)rb->dropped, rb->bytes / 1024.0, staging / 1024.0,
+        rb->persistent ? "persistently mapped" : "mapped and copied");
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// GPU results brought back to the CPU without a stall: counts a compute
+// shader wrote, a few pixels, anything in a buffer or a framebuffer. Where
+// glGetBufferSubData waits for every command before it to finish, a readback
+// here queues a copy into a staging buffer of its own (glCopyBufferSubData,
+// or glReadPixels into it as a pixel pack buffer) and fences it, and returns
+// at once. gpu_readback_poll, once a frame, looks at the oldest fences
+// without waiting; each one that has signalled has its bytes copied into the
+// caller's memory and its callback called, usually one to three frames
+// after the request, and its staging buffer goes back to the pool.
+//
+// The staging buffers belong to a ring of GPU_READBACK_SLOTS, each grown to
+// the largest request it has carried (a power of two, GPU_READBACK_MIN_BYTES
+// at least) and kept. Where glBufferStorage is there (4.4) they're mapped
+// persistently and coherently for their life, so a finished readback is one
+// memcpy out of the mapping into the caller's memory, or none at all for a
+// caller that gives no destination and reads the mapping in its callback.
+// Without it a finished buffer is mapped, copied out and unmapped.
+//
+// Requests finish in the order they were made, as the fences signal. With
+// every slot in flight a request is refused and counted as dropped: a result
+// that comes back late is better than a frame that waits for it.
+
+#define GPU_READBACK_SLOTS 16
+#define GPU_READBACK_MIN_BYTES 256
+
+// Called from gpu_readback_poll (or _finish) with the bytes that came back: the caller's destination, or the
+// staging buffer's mapping when it gave none, which is only valid during the call. "frame" is the one the
+// request was made in.
+typedef void (*GpuReadbackFunction)(void* user, const void* data, size_t bytes, unsigned int frame);
+
+typedef struct GpuReadbackSlot
+{
+    GLuint buffer;              // staging; 0 until first used
+    size_t capacity;            // its bytes
+    uint8_t* mapped;            // the persistent mapping, NULL without one
+    GLsync fence;               // after the copy in flight; NULL for a free slot
+    size_t bytes;               // of the copy
+    void* dest;                 // where they go, NULL for the callback to read the mapping
+    GpuReadbackFunction done;
+    void* user;
+    unsigned int frame;         // the request's
+} GpuReadbackSlot;
+
+typedef struct GpuReadback
+{
+    GpuReadbackSlot slots[GPU_READBACK_SLOTS];
+    bool persistent;            // glBufferStorage's mappings
+    unsigned int head;          // the oldest request in flight
+    unsigned int count;         // in flight
+    unsigned int frame;         // as of the last poll: what requests are stamped with
+
+    // Totals over the run
+    uint64_t requested;
+    uint64_t completed;
+    uint64_t dropped;           // refused with every slot in flight
+    uint64_t bytes;             // that came back
+    uint64_t latency;           // frames between request and poll, summed over those completed
+    uint64_t waits;             // completed by gpu_readback_finish, which waits
+} GpuReadback;
+
+// Needs a current context; allocates nothing until the first request
+void gpu_readback_init(GpuReadback* rb);
+
+// Drops what's in flight without calling back, and frees the staging buffers
+void gpu_readback_destroy(GpuReadback* rb);
+
+// Queues a copy of "bytes" at "offset" of "source". Shader writes to it before the call are covered
+// (glMemoryBarrier). Once the copy's done the bytes go to "dest" unless that's NULL, then "done" is called
+// unless that's NULL. Returns false, counted as dropped, when every slot is in flight.
+bool gpu_readback_buffer(GpuReadback* rb, GLuint source, GLintptr offset, size_t bytes, void* dest,
+    GpuReadbackFunction done, void* user);
+
+// Queues a glReadPixels of "width" x "height" at (x, y) of "read_buffer" in "framebuffer" (GL_BACK of 0 for the
+// window), "bytes" of them in "format" and "type", otherwise as gpu_readback_buffer. Leaves "read_buffer"
+// selected for reading and GL_PIXEL_PACK_BUFFER unbound.
+bool gpu_readback_pixels(GpuReadback* rb, GLuint framebuffer, GLenum read_buffer, int x, int y, int width, int height,
+    GLenum format, GLenum type, size_t bytes, void* dest, GpuReadbackFunction done, void* user);
+
+// Once a frame, "frame" being the one about to be drawn: finishes every request whose copy is done, oldest first,
+// and never waits. The requests made until the next poll are stamped with "frame".
+void gpu_readback_poll(GpuReadback* rb, unsigned int frame);
+
+// Waits for every request in flight and finishes it: before reading results that have to be complete, at exit
+void gpu_readback_finish(GpuReadback* rb);
+
+// One line: the requests, how late they came back on average and the staging
+void gpu_readback_print(const GpuReadback* rb, FILE* out);
@@ -0,0 +1,124 @@
+#include "gl/hiz.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+
+// The shader's uniforms, at the locations its GLSL gives them rather than looked up by name
+enum
+{
+    HIZ_LOCATION_FROM_DEPTH = 0
+};
+
+// Level 0: a straight copy of the depth texture. Level n: the max of each 2x2 block of level n - 1, plus
+// the leftover row and column of an odd-sized source in the last texel, so no source texel is dropped.
+static const char* reduce_shader_text =
+"#version 430\n"
+"layout(local_size_x = 8, local_size_y = 8) in;\n"
+"layout(binding = 0) uniform sampler2D depth;\n"
+"layout(r32f, binding = 0) uniform readonly image2D source;\n"
+"layout(r32f, binding = 1) uniform writeonly image2D target;\n"
+"layout(location = 0) uniform bool fromDepth;\n"
+"void main()\n"
+"{\n"
+"    ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"    ivec2 size = imageSize(target);\n"
+"    if (any(greaterThanEqual(p, size)))\n"
+"        return;\n"
+"    if (fromDepth)\n"
+"    {\n"
+"        imageStore(target, p, vec4(texelFetch(depth, p, 0).r));\n"
+"        return;\n"
+"    }\n"
+"    ivec2 s = imageSize(source);\n"
+"    ivec2 last = ivec2(p.x == size.x - 1 && (s.x & 1) != 0 ? 2 : 1, p.y == size.y - 1 && (s.y & 1) != 0 ? 2 : 1);\n"
+"    float z = 0.0;\n"
+"    for (int y = 0; y <= last.y; ++y)\n"
+"        for (int x = 0; x <= last.x; ++x)\n"
+"            z = max(z, imageLoad(source, min(p * 2 + ivec2(x, y), s - 1)).r);\n"
+"    imageStore(target, p, vec4(z));\n"
+"}\n";
+
+#define HIZ_GROUP_SIZE 8    // local_size_x/y in the shader
+
+bool hiz_init(HiZ* hiz, GLResources* resources)
+{
+    hiz->resources = resources;
+    hiz->texture = 0;
+    hiz->width = hiz->height = 0;
+    hiz->levels = 0;
+    mat4x4_identity(hiz->view_projection);
+    hiz->valid = false;
+
+    GLuint shader = shader_compile(GL_COMPUTE_SHADER, reduce_shader_text);
+    hiz->program = program_link(&shader, 1, false);
+    if (!hiz->program)
+    {
+        fprintf(stderr, "hiz: can't build the reduction compute shader\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, hiz->program, "hiz reduce");
+    return true;
+}
+
+void hiz_destroy(HiZ* hiz)
+{
+    gl_state_delete_textures(1, &hiz->texture);
+    if (hiz->program)
+        glDeleteProgram(hiz->program);
+    hiz->texture = 0;
+    hiz->program = 0;
+    hiz->valid = false;
+}
+
+// Immutable storage, so the level count is fixed and textureQueryLevels reports it
+static void hiz_allocate(HiZ* hiz, int width, int height)
+{
+    // The old pyramid may still be read by culling dispatches in flight
+    if (hiz->resources)
+        gl_resources_retire(hiz->resources, GL_RESOURCE_TEXTURE, hiz->texture);
+    else
+        gl_state_delete_textures(1, &hiz->texture);
+    hiz->width = width;
+    hiz->height = height;
+    hiz->levels = 1;
+    for (int size = width > height ? width : height; size > 1; size >>= 1)
+        ++hiz->levels;
+    glGenTextures(1, &hiz->texture);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, hiz->texture);
+    glTexStorage2D(GL_TEXTURE_2D, hiz->levels, GL_R32F, width, height);
+    gl_memory_texture(hiz->texture, GPU_MEMORY_RENDER_TARGETS, GL_R32F, width, height, 1, hiz->levels, 1);
+    gl_debug_label(GL_TEXTURE, hiz->texture, "hiz pyramid");
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+}
+
+void hiz_build(HiZ* hiz, GLuint depth, int width, int height, mat4x4 const view_projection)
+{
+    if (!hiz->texture || hiz->width != width || hiz->height != height)
+        hiz_allocate(hiz, width, height);
+
+    gl_state_use_program(hiz->program);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, depth);
+    for (int level = 0; level < hiz->levels; ++level)
+    {
+        const int w = width >> level > 0 ? width >> level : 1;
+        const int h = height >> level > 0 ? height >> level : 1;
+        glUniform1i(HIZ_LOCATION_FROM_DEPTH, level == 0);
+        glBindImageTexture(0, hiz->texture, level > 0 ? level - 1 : 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, hiz->texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((w + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (h + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+        draw_counters_dispatch();
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);    // the next level reads this one
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+
+    mat4x4_dup(hiz->view_projection, view_projection);
+    hiz->valid = true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/gl_resources.h"
+#include "linmath.h"
+
+// Hierarchical-Z pyramid for occlusion culling (needs a 4.3 context).
+//
+// Level 0 is a copy of a depth buffer; every further level keeps the
+// farthest depth of the 2x2 texels below it (3 wide along an odd edge), down
+// to 1x1. A level's texel (x, y) therefore covers base pixels x << l and up,
+// clamped to the level's size, so any screen rect can be tested conservatively
+// with 4 fetches from the level where it spans at most 2x2 texels: it is
+// hidden when its nearest depth lies behind the farthest one read.
+//
+// The pyramid remembers the view-projection its depth was rendered with, so the
+// next frame can test against it before anything has been drawn.
+
+typedef struct HiZ
+{
+    GLuint program;             // reduction compute shader
+    GLuint texture;             // GL_R32F, full mip chain
+    int width, height;
+    int levels;
+    mat4x4 view_projection;     // camera of the depth it was last built from
+    bool valid;                 // built at least once
+    GLResources* resources;     // retires the old pyramid on a resize (NULL: deleted at once)
+} HiZ;
+
+// Builds the reduction program. Logs and returns false when it fails to build.
+bool hiz_init(HiZ* hiz, GLResources* resources);
+void hiz_destroy(HiZ* hiz);
+
+// Rebuilds the pyramid from "depth" (a width x height depth texture, not attached for drawing meanwhile),
+// reallocating when the size changed. Ends with the barrier for texelFetch reads of the pyramid.
+void hiz_build(HiZ* hiz, GLuint depth, int width, int height, mat4x4 const view_projection);
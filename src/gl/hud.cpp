@@ -0,0 +1,442 @@
+#include "gl/hud.h"
+
+#include "core/glyph_atlas.h"
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <GLFW/glfw3.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REFRESH_SECONDS 0.5
+#define GRAPH_HEIGHT 48     // font pixels; the graph's top is 2 x the 60 Hz frame time
+#define GRAPH_TOP_MS 33.3f
+
+#define RGBA(r, g, b, a) ((uint32_t)(r) | (uint32_t)(g) << 8 | (uint32_t)(b) << 16 | (uint32_t)(a) << 24)
+
+// Expands each instance to its rectangle; corners in counter-clockwise order, whatever the face culling
+static const char* vertex_shader_text =
+"#version 330 core\n"
+"uniform vec2 screen;\n"
+"layout(location = 0) in vec4 rect;\n"
+"layout(location = 1) in uvec2 glyphColor;\n"
+"out vec2 uv;\n"
+"flat out uint glyph;\n"
+"flat out vec4 color;\n"
+"void main()\n"
+"{\n"
+"    vec2 corner = vec2(gl_VertexID >> 1, gl_VertexID & 1);\n"
+"    vec2 p = rect.xy + corner * rect.zw;\n"
+"    gl_Position = vec4(p.x / screen.x * 2.0 - 1.0, 1.0 - p.y / screen.y * 2.0, 0.0, 1.0);\n"
+"    glyph = glyphColor.x;\n"
+"    uv = (vec2(float(glyph % 16u), float(glyph / 16u)) + corner) / vec2(16.0, 6.0);\n"
+"    color = vec4((glyphColor.yyyy >> uvec4(0u, 8u, 16u, 24u)) & 0xFFu) / 255.0;\n"
+"}\n";
+
+// The field is 0.5 on the outline: coverage ramps across about a pixel of it, whatever the glyph's scale. The
+// derivative is taken for solid quads too, outside the branch.
+static const char* fragment_shader_text =
+"#version 330 core\n"
+"uniform sampler2D atlas;\n"
+"in vec2 uv;\n"
+"flat in uint glyph;\n"
+"flat in vec4 color;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    float d = texture(atlas, uv).r;\n"
+"    float w = max(fwidth(d) * 0.5, 1e-4);\n"
+"    float coverage = glyph == 255u ? 1.0 : smoothstep(0.5 - w, 0.5 + w, d);\n"
+"    fragment = vec4(color.rgb, color.a * coverage);\n"
+"}\n";
+
+bool hud_init(Hud* hud, const char* cache_dir)
+{
+    memset(hud, 0, sizeof(*hud));
+    hud->program = program_build(vertex_shader_text, fragment_shader_text, false);
+    if (!hud->program)
+    {
+        fprintf(stderr, "hud: can't build the overlay program\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, hud->program, "hud");
+    hud->screen_location = glGetUniformLocation(hud->program, "screen");
+    gl_state_use_program(hud->program);
+    glUniform1i(glGetUniformLocation(hud->program, "atlas"), 0);
+
+    // The atlas: made once and cached, uploaded as it is; bilinear, since the field is what's interpolated
+    GlyphAtlas font;
+    if (!glyph_atlas_init(&font, cache_dir))
+    {
+        hud_destroy(hud);
+        return false;
+    }
+    glGenTextures(1, &hud->atlas);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, hud->atlas);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE,
+        font.pixels);
+    gl_memory_texture(hud->atlas, GPU_MEMORY_TEXTURES, GL_R8, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT, 1, 1, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    printf("hud: glyph atlas %s in %.1f ms\n", font.loaded ? "loaded" : "built", font.build_ms);
+    glyph_atlas_destroy(&font);
+    gl_debug_label(GL_TEXTURE, hud->atlas, "hud font");
+
+    // Per-instance attributes only; the strip's corners come from gl_VertexID. They're pointed at the frame's
+    // region of the stream in hud_draw.
+    if (!stream_buffer_init(&hud->quads, GL_ARRAY_BUFFER, sizeof(HudQuad) * HUD_MAX_QUADS))
+    {
+        fprintf(stderr, "hud: can't create the quad stream\n");
+        hud_destroy(hud);
+        return false;
+    }
+    hud->vertex_array = gl_dsa_create_vertex_array();
+    gl_state_bind_vertex_array(hud->vertex_array);
+    for (int i = 0; i < 2; ++i)
+    {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    gl_debug_label(GL_VERTEX_ARRAY, hud->vertex_array, "hud quads");
+    gl_debug_label(GL_BUFFER, hud->quads.buffer, "hud quad stream");
+
+    // The overlay's lines take the first slots; labels come after them
+    hud->text = (TextCache*)malloc(sizeof(TextCache));
+    if (!hud->text)
+    {
+        fprintf(stderr, "hud: out of memory\n");
+        hud_destroy(hud);
+        return false;
+    }
+    text_cache_init(hud->text);
+    for (int i = 0; i < HUD_LINES; ++i)
+        hud->line_slots[i] = text_cache_add(hud->text);
+
+    glGenQueries(HUD_QUERY_LATENCY, hud->queries);
+    return true;
+}
+
+void hud_destroy(Hud* hud)
+{
+    if (hud->queries[0])
+        glDeleteQueries(HUD_QUERY_LATENCY, hud->queries);
+    if (hud->vertex_array)
+        gl_state_delete_vertex_arrays(1, &hud->vertex_array);
+    if (hud->quads.buffer)
+        stream_buffer_destroy(&hud->quads);
+    if (hud->atlas)
+        gl_state_delete_textures(1, &hud->atlas);
+    if (hud->program)
+        glDeleteProgram(hud->program);
+    free(hud->text);
+    memset(hud, 0, sizeof(*hud));
+}
+
+void hud_scene_begin(Hud* hud)
+{
+    // The slot's last query is HUD_QUERY_LATENCY frames old: long done, or dropped rather than waited for
+    const int slot = hud->query_index;
+    if (hud->query_pending[slot])
+    {
+        GLuint available = 0;
+        glGetQueryObjectuiv(hud->queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 primitives = 0;
+            glGetQueryObjectui64v(hud->queries[slot], GL_QUERY_RESULT, &primitives);
+            hud->interval.triangles += primitives;
+            ++hud->interval.triangle_frames;
+        }
+        hud->query_pending[slot] = false;
+    }
+    glBeginQuery(GL_PRIMITIVES_GENERATED, hud->queries[slot]);
+}
+
+void hud_scene_end(Hud* hud)
+{
+    glEndQuery(GL_PRIMITIVES_GENERATED);
+    hud->query_pending[hud->query_index] = true;
+    hud->query_index = (hud->query_index + 1) % HUD_QUERY_LATENCY;
+}
+
+bool hud_gpu_memory(int* total_mb, int* available_mb)
+{
+    GpuMemoryDriver driver;
+    if (!gl_memory_query_driver(&driver))
+        return false;
+    *total_mb = driver.total_kb < 0 ? -1 : (int)(driver.total_kb / 1024);
+    *available_mb = (int)(driver.available_kb / 1024);
+    return true;
+}
+
+static void state_call_totals(uint64_t* issued, uint64_t* filtered)
+{
+    *issued = *filtered = 0;
+    for (int i = 0; i < GL_STATE_CALL_COUNT; ++i)
+    {
+        *issued += gl_state.issued[i];
+        *filtered += gl_state.filtered[i];
+    }
+}
+
+// Starts a new averaging interval at "now", from the current totals
+static void interval_start(Hud* hud, const HudFrameStats* stats, double now)
+{
+    HudInterval* iv = &hud->interval;
+    memset(iv, 0, sizeof(*iv));
+    iv->start = now;
+    state_call_totals(&iv->issued, &iv->filtered);
+    if (stats->profiler)
+        memcpy(iv->passes, stats->profiler->stats, sizeof(iv->passes));
+}
+
+static void add_line(Hud* hud, const char* format, ...)
+{
+    if (hud->line_count == HUD_LINES)
+        return;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(hud->lines[hud->line_count++], HUD_LINE_SIZE, format, args);
+    va_end(args);
+}
+
+// "12345678" as "12.3 M"
+static const char* format_count(char* text, size_t size, double n)
+{
+    if (n >= 1e6)
+        snprintf(text, size, "%.2f M", n * 1e-6);
+    else if (n >= 1e4)
+        snprintf(text, size, "%.1f k", n * 1e-3);
+    else
+        snprintf(text, size, "%.0f", n);
+    return text;
+}
+
+// The text, from the interval that just ended
+static void refresh_text(Hud* hud, const HudFrameStats* stats, double now)
+{
+    const HudInterval* iv = &hud->interval;
+    const double frames = iv->frames ? (double)iv->frames : 1.0;
+    const double seconds = now - iv->start;
+    hud->line_count = 0;
+    add_line(hud, "%6.1f fps  %6.2f ms  (max %.2f)", iv->frames / seconds, seconds * 1000.0 / frames, iv->frame_ms_max);
+    if (stats->frame_stats && stats->frame_stats->frames)
+    {
+        FrameStatsSummary window;
+        frame_stats_window(stats->frame_stats, &window);
+        add_line(hud, "p50 %.1f  p95 %.1f  p99 %.1f  max %.1f ms", window.p50_ms, window.p95_ms, window.p99_ms,
+            window.max_ms);
+    }
+
+    char triangles[32] = "-";
+    if (iv->triangle_frames)
+        format_count(triangles, sizeof(triangles), (double)iv->triangles / iv->triangle_frames);
+    add_line(hud, "draws %-8.0f triangles %s", iv->draw_calls / frames, triangles);
+
+    uint64_t issued = 0, filtered = 0;
+    state_call_totals(&issued, &filtered);
+    issued -= iv->issued;
+    filtered -= iv->filtered;
+    add_line(hud, "state %.0f set, %.0f filtered (%.0f%%)", issued / frames, filtered / frames,
+        issued + filtered ? 100.0 * filtered / (issued + filtered) : 0.0);
+
+    int total_mb = 0, available_mb = 0;
+    if (!hud_gpu_memory(&total_mb, &available_mb))
+        add_line(hud, "gpu memory n/a");
+    else if (total_mb > 0)
+        add_line(hud, "gpu memory %d / %d MB", total_mb - available_mb, total_mb);
+    else
+        add_line(hud, "gpu memory %d MB free", available_mb);
+    const uint64_t budget = gpu_memory_budget(&gl_memory);
+    const double tracked_mb = gpu_memory_bytes(&gl_memory, GPU_MEMORY_CATEGORY_COUNT) / 1048576.0;
+    if (budget == UINT64_MAX)
+        add_line(hud, "tracked %.1f MB", tracked_mb);
+    else
+        add_line(hud, "tracked %.1f / %.1f MB", tracked_mb, budget / 1048576.0);
+    add_line(hud, "textures %.1f MB", (gpu_memory_bytes(&gl_memory, GPU_MEMORY_TEXTURES)
+        + gpu_memory_bytes(&gl_memory, GPU_MEMORY_STREAMED_TEXTURES)) / 1048576.0);
+
+    // Per pass: what each scope added up to over the interval, per frame it was sampled in
+    const GpuProfiler* p = stats->profiler;
+    if (!p || !p->enabled)
+        return;
+    static const GpuProfilerStats none = {};
+    add_line(hud, "%-12s %7s %7s %6s %8s %6s", "pass", "cpu ms", "gpu ms", "draws", "tris", "state");
+    for (int i = 0; i < p->stat_count; ++i)
+    {
+        const GpuProfilerStats* s = &p->stats[i];
+        // New since the interval started otherwise
+        const GpuProfilerStats* before = iv->passes[i].name == s->name ? &iv->passes[i] : &none;
+        const unsigned int samples = s->samples - before->samples;
+        if (!samples)
+            continue;
+        char tris[16];
+        add_line(hud, "%-12s %7.3f %7.3f %6.0f %8s %6.0f", s->name, (s->cpu_ms - before->cpu_ms) / samples,
+            (s->gpu_ms - before->gpu_ms) / samples, (double)(s->counters.draws - before->counters.draws) / samples,
+            format_count(tris, sizeof(tris), (double)(s->counters.triangles - before->counters.triangles) / samples),
+            (double)(s->counters.state_changes - before->counters.state_changes) / samples);
+    }
+
+    // The GPU's own counts, while gathered: shader invocations, and the share of primitives clipping took away
+    if (!p->statistics)
+        return;
+    add_line(hud, "%-12s %8s %8s %8s %7s", "pass", "vs", "fs", "cs", "clipped");
+    for (int i = 0; i < p->stat_count; ++i)
+    {
+        const GpuProfilerStats* s = &p->stats[i];
+        const GpuProfilerStats* before = iv->passes[i].name == s->name ? &iv->passes[i] : &none;
+        const unsigned int samples = s->statistics_samples - before->statistics_samples;
+        if (!samples)
+            continue;
+        double per_frame[GPU_STATISTIC_COUNT];
+        for (int k = 0; k < GPU_STATISTIC_COUNT; ++k)
+            per_frame[k] = (double)(s->statistics[k] - before->statistics[k]) / samples;
+        char vs[16], fs[16], cs[16], clipped[16] = "-";
+        if (per_frame[GPU_STATISTIC_CLIPPING_IN] > 0.0)
+            snprintf(clipped, sizeof(clipped), "%.0f%%",
+                100.0 * (1.0 - per_frame[GPU_STATISTIC_CLIPPING_OUT] / per_frame[GPU_STATISTIC_CLIPPING_IN]));
+        add_line(hud, "%-12s %8s %8s %8s %7s", s->name,
+            format_count(vs, sizeof(vs), per_frame[GPU_STATISTIC_VERTEX_SHADER]),
+            format_count(fs, sizeof(fs), per_frame[GPU_STATISTIC_FRAGMENT_SHADER]),
+            format_count(cs, sizeof(cs), per_frame[GPU_STATISTIC_COMPUTE_SHADER]), clipped);
+    }
+}
+
+void hud_update(Hud* hud, const HudFrameStats* stats)
+{
+    const double now = glfwGetTime();
+    HudInterval* iv = &hud->interval;
+    if (hud->last_time <= 0.0 || now - hud->last_time > 1.0)
+    {
+        // The first frame shown, or the first after being hidden: nothing to measure from
+        hud->last_time = now;
+        interval_start(hud, stats, now);
+        return;
+    }
+    const float ms = (float)((now - hud->last_time) * 1000.0);
+    hud->last_time = now;
+    hud->frame_ms[hud->frames++ % HUD_GRAPH_FRAMES] = ms;
+    ++iv->frames;
+    iv->frame_ms_max = ms > iv->frame_ms_max ? ms : iv->frame_ms_max;
+    iv->draw_calls += stats->draw_calls;
+    if (now - iv->start >= REFRESH_SECONDS)
+    {
+        refresh_text(hud, stats, now);
+        interval_start(hud, stats, now);
+    }
+}
+
+// Appends quads to this frame's region
+typedef struct QuadWriter
+{
+    HudQuad* quads;
+    int count;
+    float scale;
+} QuadWriter;
+
+static void put_quad(QuadWriter* w, float x, float y, float width, float height, uint32_t glyph, uint32_t color)
+{
+    if (w->count == HUD_MAX_QUADS)
+        return;
+    HudQuad* q = &w->quads[w->count++];
+    q->rect[0] = x;
+    q->rect[1] = y;
+    q->rect[2] = width;
+    q->rect[3] = height;
+    q->glyph = glyph;
+    q->color = color;
+}
+
+void hud_draw(Hud* hud, int width, int height, bool overlay)
+{
+    if (width < 1 || height < 1)
+        return;
+    for (int i = 0; i < HUD_LINES; ++i)
+        text_cache_show(hud->text, hud->line_slots[i], false);
+    stream_buffer_begin_frame(&hud->quads);
+    GLintptr offset = 0;
+    QuadWriter w;
+    w.quads = (HudQuad*)stream_buffer_alloc(&hud->quads, sizeof(HudQuad) * HUD_MAX_QUADS, 16, &offset);
+    w.count = 0;
+    w.scale = height >= 1440 ? 2.f : 1.f;   // readable on high-DPI framebuffers
+    if (!w.quads)
+    {
+        stream_buffer_end_frame(&hud->quads);
+        return;
+    }
+
+    // A translucent panel holding the text lines, then the graph below them. The lines are only laid out again
+    // when they change; the labels are wherever the app put them.
+    const float s = w.scale, margin = 8.f * s, pad = 4.f * s, line = (GLYPH_FONT_HEIGHT + 1) * s;
+    float text_width_px = 0.f;
+    for (int i = 0; i < hud->line_count && overlay; ++i)
+    {
+        const float width_px = text_width(hud->lines[i], s);
+        text_width_px = width_px > text_width_px ? width_px : text_width_px;
+        text_cache_set(hud->text, hud->line_slots[i], margin + pad, margin + pad + i * line, s, RGBA(255, 255, 255, 255),
+            hud->lines[i]);
+    }
+    const float bar = 2.f * s, graph_width = HUD_GRAPH_FRAMES * bar, graph_height = GRAPH_HEIGHT * s;
+    const float panel_width = (text_width_px > graph_width ? text_width_px : graph_width) + 2.f * pad;
+    const float text_height = hud->line_count * line;
+    const float graph_y = margin + pad + text_height + (hud->line_count ? pad : 0.f);
+    hud->panel[0] = margin;
+    hud->panel[1] = margin;
+    hud->panel[2] = overlay ? panel_width : 0.f;
+    hud->panel[3] = graph_y + graph_height + pad - margin;
+    if (overlay)
+        put_quad(&w, margin, margin, panel_width, hud->panel[3], HUD_SOLID, RGBA(0, 0, 0, 160));
+    w.count += text_cache_gather(hud->text, w.quads + w.count, HUD_MAX_QUADS - w.count);
+
+    // Oldest frame on the left; green inside a 60 Hz frame, yellow inside two, red beyond
+    const float x0 = margin + pad, bottom = graph_y + graph_height;
+    const unsigned int recorded = !overlay ? 0 : hud->frames < HUD_GRAPH_FRAMES ? hud->frames : HUD_GRAPH_FRAMES;
+    for (unsigned int k = 0; k < recorded; ++k)
+    {
+        const float ms = hud->frame_ms[(hud->frames - recorded + k) % HUD_GRAPH_FRAMES];
+        const float h = (ms < GRAPH_TOP_MS ? ms : GRAPH_TOP_MS) / GRAPH_TOP_MS * graph_height;
+        const uint32_t color = ms <= 16.7f ? RGBA(80, 220, 80, 230) : ms <= GRAPH_TOP_MS ? RGBA(240, 200, 60, 230)
+            : RGBA(240, 70, 60, 230);
+        put_quad(&w, x0 + (HUD_GRAPH_FRAMES - recorded + k) * bar, bottom - h, bar, h, HUD_SOLID, color);
+    }
+    if (overlay)
+        put_quad(&w, x0, bottom - 16.7f / GRAPH_TOP_MS * graph_height, graph_width, s, HUD_SOLID,
+            RGBA(255, 255, 255, 120));
+    stream_buffer_commit(&hud->quads);
+
+    const bool depth_test = gl_state.capabilities[GL_STATE_CAP_DEPTH_TEST] == 1;
+    gl_state_use_program(hud->program);
+    gl_state_bind_vertex_array(hud->vertex_array);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, hud->quads.buffer);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(HudQuad), (void*)offset);
+    glVertexAttribIPointer(1, 2, GL_UNSIGNED_INT, sizeof(HudQuad), (void*)(offset + offsetof(HudQuad, glyph)));
+    gl_state_bind_texture(0, GL_TEXTURE_2D, hud->atlas);
+    gl_state_viewport(0, 0, width, height);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUniform2f(hud->screen_location, (float)width, (float)height);
+    if (w.count)
+    {
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, w.count);
+        draw_counters_draw(GL_TRIANGLE_STRIP, 4, w.count);
+    }
+    gl_state_enable(GL_BLEND, false);
+    gl_state_enable(GL_DEPTH_TEST, depth_test);
+    stream_buffer_end_frame(&hud->quads);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/frame_stats.h"
+#include "core/text_cache.h"
+#include "gl/gpu_profiler.h"
+#include "gl/stream_buffer.h"
+
+#include <stdint.h>
+
+// Performance overlay: frame time graph, FPS, CPU / GPU milliseconds per
+// profiler pass, draw calls, triangles, state changes the cache filtered and
+// GPU memory, drawn over the window just before it's presented. Each pass
+// also shows its draws, triangles and state changes, and its shader
+// invocations while the profiler gathers pipeline statistics.
+//
+// Everything on it is a quad: a pixel rectangle, a glyph (or a solid fill) and
+// a colour, written into a stream buffer as the overlay is built and expanded
+// to a triangle strip in the vertex shader, so the whole overlay is one
+// instanced draw with one program and one texture. Glyphs come from the
+// signed distance field atlas of core/glyph_atlas.h, kept in the app's cache
+// directory after the first run, and are antialiased across about a pixel of
+// their outline at any scale.
+//
+// Text goes through a TextCache (core/text_cache.h): the overlay's lines are
+// laid out when they change, twice a second at most, and the app's own labels
+// and readouts go in the same cache (text_cache_add on hud.text) and the same
+// draw, whether or not the overlay is shown.
+//
+// The text is refreshed twice a second from averages over that interval, so it
+// stays readable; the graph has every frame. Triangles are counted with a
+// GL_PRIMITIVES_GENERATED query around the scene pass, read HUD_QUERY_LATENCY
+// frames later like the profiler's timestamps. GPU memory comes from
+// GL_NVX_gpu_memory_info or GL_ATI_meminfo where the driver has one, next to
+// what gl/gl_memory.h tracked the app allocating, against its budget.
+
+#define HUD_MAX_QUADS 8192          // per frame, text included; more are dropped
+#define HUD_GRAPH_FRAMES 128        // frame times kept for the graph
+#define HUD_QUERY_LATENCY 4
+#define HUD_LINES 48                // text lines, each up to HUD_LINE_SIZE - 1 characters
+#define HUD_LINE_SIZE 64
+#define HUD_SOLID TEXT_SOLID        // HudQuad glyph for a filled rectangle
+
+// One instance: the text cache's quads are drawn as they are
+typedef TextQuad HudQuad;
+
+// What the renderer knows about the frame it's about to present
+typedef struct HudFrameStats
+{
+    unsigned int draw_calls;        // scene draw calls this frame, every window of a wall included
+    const GpuProfiler* profiler;    // per-pass times, shown while it's enabled
+    const FrameStats* frame_stats;  // the rolling percentiles, NULL for none
+} HudFrameStats;
+
+// Totals at the start of the text's current interval, to average over it
+typedef struct HudInterval
+{
+    double start;                   // glfwGetTime()
+    unsigned int frames;
+    double frame_ms_max;
+    uint64_t draw_calls;
+    uint64_t triangles;
+    unsigned int triangle_frames;   // frames whose query came back in the interval
+    uint64_t issued;                // gl_state calls passed on / dropped, at the interval's start
+    uint64_t filtered;
+    GpuProfilerStats passes[GPU_PROFILER_MAX_NAMES];
+} HudInterval;
+
+typedef struct Hud
+{
+    GLuint program;
+    GLint screen_location;
+    GLuint atlas;
+    GLuint vertex_array;
+    StreamBuffer quads;             // HudQuad instances, rewritten every frame
+    GLuint queries[HUD_QUERY_LATENCY];
+    bool query_pending[HUD_QUERY_LATENCY];
+    int query_index;
+    double last_time;               // the previous hud_update, 0 before the first
+    float frame_ms[HUD_GRAPH_FRAMES];
+    unsigned int frames;            // frame times recorded
+    HudInterval interval;
+    char lines[HUD_LINES][HUD_LINE_SIZE];
+    int line_count;
+    TextCache* text;                // the lines' slots, then the app's labels
+    int line_slots[HUD_LINES];
+    float panel[4];                 // the overlay as last drawn: x, y, width, height in pixels from the top left; 0 wide when hidden
+} Hud;
+
+// Needs a current context. The glyph atlas is loaded from, or stored in, "cache_dir" (NULL for neither). Returns
+// false (logged) when the program or the atlas can't be made.
+bool hud_init(Hud* hud, const char* cache_dir);
+void hud_destroy(Hud* hud);
+
+// Around the scene's draws, while the overlay is shown: counts the primitives they generate
+void hud_scene_begin(Hud* hud);
+void hud_scene_end(Hud* hud);
+
+// Once a frame it's shown, before hud_draw: records the frame time and refreshes the text when it's due
+void hud_update(Hud* hud, const HudFrameStats* stats);
+
+// Draws the labels, and the overlay when "overlay" is set, over the bound draw framebuffer, "width" x "height"
+// pixels. Leaves blending off and the depth test as it found it.
+void hud_draw(Hud* hud, int width, int height, bool overlay);
+
+// Video memory from the driver in MB: false when it reports none. "total_mb" is -1 when only the free amount is known.
+bool hud_gpu_memory(int* total_mb, int* available_mb);
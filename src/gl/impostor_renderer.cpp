@@ -0,0 +1,233 @@
+#include "gl/impostor_renderer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+#include "gl/uniforms.h"
+#include "scene/impostor.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define IMPOSTOR_MIN_MIP 4      // pixels: the smallest frames a mip level may have
+
+// The mesh flat, in a frame's orthographic view
+static const char* bake_vertex_shader_text =
+"#version 330\n"
+"uniform mat4 frame;\n"
+"layout(location = 0) in vec2 vPos;\n"
+"layout(location = 1) in vec3 vCol;\n"
+"out vec3 color;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = frame * vec4(vPos, 0.0, 1.0);\n"
+"    color = vCol;\n"
+"}\n";
+
+static const char* bake_fragment_shader_text =
+"#version 330\n"
+"in vec3 color;\n"
+"layout(location = 0) out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    fragment = vec4(color, 1.0);\n"
+"}\n";
+
+// The frame nearest the eye's direction in the object's space, as impostor_nearest_frame picks it, and the quad
+// in that frame's image plane through the object's centre (scene/impostor.h). "eye" is the eye's position with w
+// 1, or with w 0 the direction an orthographic camera looks from.
+static const char* vertex_shader_text =
+"#version 330\n"
+UNIFORMS_GLSL
+"const float YAW_FRAMES = 16.0;\n"          // IMPOSTOR_YAW_FRAMES
+"const float PITCH_FRAMES = 8.0;\n"         // IMPOSTOR_PITCH_FRAMES
+"const float FILL = 0.875;\n"               // IMPOSTOR_FRAME_FILL
+"const float PI = 3.14159265;\n"
+"layout(location = 2) in mat3x4 vModel;\n"
+"uniform vec4 eye;\n"
+"uniform float radius;\n"
+"out vec2 uv;\n"
+"void main()\n"
+"{\n"
+"    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+"    mat3 toWorld = mat3(vModel);\n"           // v * toWorld: a rotation and a uniform scale
+"    vec3 centre = vec3(vModel[0].w, vModel[1].w, vModel[2].w);\n"
+"    vec3 seen = toWorld * (eye.xyz - centre * eye.w);\n"     // the transpose: into object space, scaled
+"    float column = mod(floor(atan(seen.y, seen.x) * (YAW_FRAMES / (2.0 * PI)) + 0.5), YAW_FRAMES);\n"
+"    float fromTop = acos(clamp(seen.z / length(seen), -1.0, 1.0));\n"
+"    float row = clamp(floor((1.0 - fromTop / PI) * PITCH_FRAMES), 0.0, PITCH_FRAMES - 1.0);\n"
+"    float yaw = column * (2.0 * PI / YAW_FRAMES);\n"
+"    float elevation = PI * ((row + 0.5) / PITCH_FRAMES - 0.5);\n"
+"    vec3 dir = vec3(cos(elevation) * vec2(cos(yaw), sin(yaw)), sin(elevation));\n"
+"    vec3 right = vec3(-sin(yaw), cos(yaw), 0.0);\n"
+"    vec3 up = cross(right, -dir);\n"
+"    vec3 local = (radius / FILL) * ((corner.x * 2.0 - 1.0) * right + (corner.y * 2.0 - 1.0) * up);\n"
+"    gl_Position = viewProjection * vec4(local * toWorld + centre, 1.0);\n"
+"    uv = (vec2(column, row) + corner) / vec2(YAW_FRAMES, PITCH_FRAMES);\n"
+"}\n";
+
+// Alpha-tested; the mips averaged the colour with the transparent background, so it's divided back out
+static const char* fragment_shader_text =
+"#version 330\n"
+"uniform sampler2D atlas;\n"
+"in vec2 uv;\n"
+"layout(location = 0) out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    vec4 c = texture(atlas, uv);\n"
+"    if (c.a < 0.5)\n"
+"        discard;\n"
+"    fragment = vec4(c.rgb / c.a, 1.0);\n"
+"}\n";
+
+bool impostor_renderer_init(ImpostorRenderer* ir, int frame_size)
+{
+    memset(ir, 0, sizeof(*ir));
+    ir->frame_size = frame_size;
+    ir->bake_program = program_build(bake_vertex_shader_text, bake_fragment_shader_text, false);
+    ir->program = program_build(vertex_shader_text, fragment_shader_text, false);
+    if (!ir->bake_program || !ir->program)
+    {
+        fprintf(stderr, "impostors: can't build the %s program\n", ir->program ? "bake" : "impostor");
+        impostor_renderer_destroy(ir);
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, ir->bake_program, "impostor bake");
+    gl_debug_label(GL_PROGRAM, ir->program, "impostors");
+    ir->bake_frame_location = glGetUniformLocation(ir->bake_program, "frame");
+    ir->eye_location = glGetUniformLocation(ir->program, "eye");
+    ir->radius_location = glGetUniformLocation(ir->program, "radius");
+    uniforms_bind_blocks(ir->program);
+    gl_state_use_program(ir->program);
+    glUniform1i(glGetUniformLocation(ir->program, "atlas"), 0);
+
+    // Every mip level made up front, for the bake's glGenerateMipmap to fill
+    const GLsizei width = frame_size * IMPOSTOR_YAW_FRAMES, height = frame_size * IMPOSTOR_PITCH_FRAMES;
+    while ((frame_size >> ir->levels) >= IMPOSTOR_MIN_MIP)
+        ++ir->levels;
+    glGenTextures(1, &ir->atlas);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, ir->atlas);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    for (int l = 0; l < ir->levels; ++l)
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, width >> l, height >> l, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    gl_memory_texture(ir->atlas, GPU_MEMORY_TEXTURES, GL_RGBA8, width, height, 1, ir->levels, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ir->levels - 1);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+    gl_debug_label(GL_TEXTURE, ir->atlas, "impostor atlas");
+
+    const GLuint previous = gl_state.draw_framebuffer;
+    glGenFramebuffers(1, &ir->framebuffer);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, ir->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ir->atlas, 0);
+    gl_debug_label(GL_FRAMEBUFFER, ir->framebuffer, "impostor bake");
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, previous);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "impostors: %dx%d atlas incomplete (0x%04X)\n", width, height, status);
+        impostor_renderer_destroy(ir);
+        return false;
+    }
+
+    // Per-instance attributes only; they're pointed at the frame's impostors in impostor_renderer_draw
+    ir->vertex_array = gl_dsa_create_vertex_array();
+    gl_state_bind_vertex_array(ir->vertex_array);
+    for (int i = 0; i < 3; ++i)
+    {
+        glEnableVertexAttribArray(2 + i);
+        glVertexAttribDivisor(2 + i, 1);
+    }
+    gl_debug_label(GL_VERTEX_ARRAY, ir->vertex_array, "impostors");
+    return true;
+}
+
+void impostor_renderer_destroy(ImpostorRenderer* ir)
+{
+    gl_state_delete_vertex_arrays(1, &ir->vertex_array);
+    gl_state_delete_framebuffers(1, &ir->framebuffer);
+    gl_state_delete_textures(1, &ir->atlas);
+    if (ir->program)
+        glDeleteProgram(ir->program);
+    if (ir->bake_program)
+        glDeleteProgram(ir->bake_program);
+    memset(ir, 0, sizeof(*ir));
+}
+
+void impostor_renderer_bake(ImpostorRenderer* ir, GLuint vertex_array, const GpuMesh* mesh, float radius)
+{
+    if (ir->baked && ir->baked_buffer == mesh->vertex_buffer && ir->radius == radius)
+        return;
+    const GLuint previous = gl_state.draw_framebuffer;
+    GLint viewport[4];
+    memcpy(viewport, gl_state.viewport, sizeof(viewport));
+    if (!gl_state.viewport_known)
+        glGetIntegerv(GL_VIEWPORT, viewport);
+    const bool depth_test = gl_state.capabilities[GL_STATE_CAP_DEPTH_TEST] == 1;
+    const bool blend = gl_state.capabilities[GL_STATE_CAP_BLEND] == 1;
+    const bool cull_face = gl_state.capabilities[GL_STATE_CAP_CULL_FACE] == 1;
+
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, ir->framebuffer);
+    gl_state_enable(GL_DEPTH_TEST, false);     // a flat mesh: nothing in it hides anything else
+    gl_state_enable(GL_BLEND, false);
+    gl_state_enable(GL_CULL_FACE, false);      // frames from below see its back
+    gl_state_colour_mask(true);
+    const float clear[4] = { 0.f, 0.f, 0.f, 0.f };
+    glClearBufferfv(GL_COLOR, 0, clear);
+    gl_state_use_program(ir->bake_program);
+    gl_state_bind_vertex_array(vertex_array);
+    for (int row = 0; row < IMPOSTOR_PITCH_FRAMES; ++row)
+    {
+        for (int column = 0; column < IMPOSTOR_YAW_FRAMES; ++column)
+        {
+            mat4x4 frame;
+            impostor_frame_matrix(column, row, radius, frame);
+            gl_state_viewport(column * ir->frame_size, row * ir->frame_size, ir->frame_size, ir->frame_size);
+            glUniformMatrix4fv(ir->bake_frame_location, 1, GL_FALSE, (const GLfloat*)frame);
+            gpu_mesh_draw(mesh);
+        }
+    }
+    gl_state_bind_texture(0, GL_TEXTURE_2D, ir->atlas);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, previous);
+    gl_state_viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    gl_state_enable(GL_DEPTH_TEST, depth_test);
+    gl_state_enable(GL_BLEND, blend);
+    gl_state_enable(GL_CULL_FACE, cull_face);
+    ir->baked = true;
+    ir->baked_buffer = mesh->vertex_buffer;
+    ir->radius = radius;
+    ++ir->bakes;
+}
+
+unsigned int impostor_renderer_draw(ImpostorRenderer* ir, GLuint instance_buffer, GLintptr offset, GLsizei count,
+    mat4x4 const view, bool perspective)
+{
+    if (count <= 0 || !ir->baked)
+        return 0;
+    // The eye, or the way it looks from, in world space: the inverse view's translation or its +z axis
+    mat4x4 inverse_view;
+    mat4x4_invert(inverse_view, view);
+    const vec4 eye = { inverse_view[perspective ? 3 : 2][0], inverse_view[perspective ? 3 : 2][1],
+        inverse_view[perspective ? 3 : 2][2], perspective ? 1.f : 0.f };
+
+    gl_state_use_program(ir->program);
+    gl_state_bind_vertex_array(ir->vertex_array);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, instance_buffer);
+    for (int r = 0; r < 3; ++r)
+        glVertexAttribPointer(2 + r, 4, GL_FLOAT, GL_FALSE, sizeof(mat3x4), (void*)(offset + sizeof(vec4) * r));
+    gl_state_bind_texture(0, GL_TEXTURE_2D, ir->atlas);
+    glUniform4fv(ir->eye_location, 1, eye);
+    glUniform1f(ir->radius_location, ir->radius);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    draw_counters_draw(GL_TRIANGLE_STRIP, 4, count);
+    ir->drawn += (unsigned long long)count;
+    return 1;
+}
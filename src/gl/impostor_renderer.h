@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/mesh.h"
+#include "linmath_affine.h"
+
+// Draws scene/impostor.h's impostors: the atlas baked from the scene's mesh
+// and one instanced draw of quads for every object that's an impostor.
+//
+// The bake draws the mesh's finest resident level into each frame's cell of
+// an RGBA8 atlas through the scene's vertex array (vPos at location 0, vCol
+// at 1, unlit and untextured), over a transparent background, and builds its
+// mips. It happens once the renderer first has impostors to draw, and again
+// whenever it's handed a different mesh.
+//
+// The quads read the same model matrices as the scene's instanced draws (the
+// rows at attributes 2-4 of their own vertex array, pointed at the
+// impostors' part of the instance stream); their corners come from
+// gl_VertexID. The vertex shader works out each one's frame from where the
+// eye is in the object's space, and the fragment shader alpha-tests the
+// atlas, so the quads need no blending or sorting and write depth as the
+// meshes do.
+
+typedef struct ImpostorRenderer
+{
+    GLuint bake_program;
+    GLint bake_frame_location;
+    GLuint program;
+    GLint eye_location;
+    GLint radius_location;
+    GLuint vertex_array;        // the instance matrices only
+    GLuint atlas;               // IMPOSTOR_YAW_FRAMES x IMPOSTOR_PITCH_FRAMES frames
+    GLuint framebuffer;         // the atlas's level 0, for the bake
+    int frame_size;             // pixels a frame is square
+    int levels;                 // mips kept: down to frames of 4 pixels, before the cells' margins run out
+    bool baked;
+    GLuint baked_buffer;        // the vertex buffer of the mesh in the atlas, to tell another one by
+    float radius;               // its bounding circle, in its units
+    unsigned int bakes;
+    unsigned long long drawn;   // impostors, over the run
+} ImpostorRenderer;
+
+// Needs a current context. Frames of "frame_size" pixels. Logs and returns false when a program fails to build or
+// the atlas can't be drawn into.
+bool impostor_renderer_init(ImpostorRenderer* ir, int frame_size);
+void impostor_renderer_destroy(ImpostorRenderer* ir);
+
+// Bakes "mesh", drawn with "vertex_array", into the atlas unless it's the mesh already there. "radius" bounds the
+// mesh around its origin. Leaves the framebuffer and viewport as it found them.
+void impostor_renderer_bake(ImpostorRenderer* ir, GLuint vertex_array, const GpuMesh* mesh, float radius);
+
+// Draws "count" impostors whose model matrices are the mat3x4s at "offset" in "instance_buffer", seen through a
+// camera with "view" (perspective, or orthographic looking along its -z), with the Camera block bound and the
+// pass's depth state. Returns the draws made.
+unsigned int impostor_renderer_draw(ImpostorRenderer* ir, GLuint instance_buffer, GLintptr offset, GLsizei count,
+    mat4x4 const view, bool perspective);
@@ -0,0 +1,402 @@
+#include "gl/lighting.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The shaders' uniforms, at the locations their GLSL gives them rather than looked up by name
+enum
+{
+    ANIMATE_LOCATION_TIME = 0,
+    ANIMATE_LOCATION_COUNT = 1
+};
+
+enum
+{
+    GRID_LOCATION_INVERSE_VIEW_PROJECTION = 0,
+    GRID_LOCATION_SIZE = 1,
+    GRID_LOCATION_TILE = 2,
+    GRID_LOCATION_DEPTH_RANGE = 3
+};
+
+enum
+{
+    RESOLVE_LOCATION_INVERSE_VIEW_PROJECTION = 0,
+    RESOLVE_LOCATION_VIEWPORT = 1
+};
+
+// One invocation per light: where its orbit has it at "time"
+static const char* animate_shader_text =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+"struct Source { vec4 orbit; vec4 shape; vec4 color; };\n"     // centre xy, radius, speed; phase, height, range; rgb
+"struct Light { vec4 position; vec4 color; };\n"
+"layout(std430, binding = 0) readonly buffer Sources { Source sources[]; };\n"
+"layout(std430, binding = 1) writeonly buffer Lights { Light lights[]; };\n"
+"layout(location = 0) uniform float time;\n"
+"layout(location = 1) uniform uint count;\n"
+"void main()\n"
+"{\n"
+"    uint i = gl_GlobalInvocationID.x;\n"
+"    if (i >= count)\n"
+"        return;\n"
+"    Source s = sources[i];\n"
+"    float a = s.orbit.w * time + s.shape.x;\n"
+"    lights[i] = Light(vec4(s.orbit.xy + s.orbit.z * vec2(cos(a), sin(a)), s.shape.y, s.shape.z), vec4(s.color.rgb, 0.0));\n"
+"}\n";
+
+// One invocation per cluster. Its box is the 8 corners of its NDC slab taken back to world space; a light is listed
+// when its sphere reaches the box. Every invocation takes part in staging, so the barriers stay in uniform control
+// flow, and the ones past the last cluster only skip the tests.
+static const char* grid_shader_text =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+"struct Light { vec4 position; vec4 color; };\n"
+"layout(std430, binding = 1) readonly buffer Lights { Light lights[]; };\n"
+"layout(std430, binding = 7) writeonly buffer LightGrid { uvec4 lightGrid; vec4 lightTile; uint clusterLights[]; };\n"
+"layout(location = 0) uniform mat4 inverseViewProjection;\n"
+"layout(location = 1) uniform uvec4 gridSize;\n"     // clusters across, up, deep; lights
+"layout(location = 2) uniform vec2 tileNdc;\n"       // a cluster's width and height in NDC
+"layout(location = 3) uniform vec2 depthRange;\n"    // NDC depth at window depth 0 and 1
+"shared vec4 staged[64];\n"
+"void main()\n"
+"{\n"
+"    uint cluster = gl_GlobalInvocationID.x;\n"
+"    bool active = cluster < gridSize.x * gridSize.y * gridSize.z;\n"
+"    uvec3 c = uvec3(cluster % gridSize.x, (cluster / gridSize.x) % gridSize.y, cluster / (gridSize.x * gridSize.y));\n"
+"    vec3 size = vec3(tileNdc, (depthRange.y - depthRange.x) / float(gridSize.z));\n"
+"    vec3 lo = vec3(-1.0, -1.0, depthRange.x) + vec3(c) * size;\n"
+"    vec3 hi = min(lo + size, vec3(1.0));\n"
+"    vec3 boxMin = vec3(3.4e38), boxMax = vec3(-3.4e38);\n"
+"    for (int k = 0; k < 8; ++k)\n"
+"    {\n"
+"        vec3 corner = vec3((k & 1) != 0 ? hi.x : lo.x, (k & 2) != 0 ? hi.y : lo.y, (k & 4) != 0 ? hi.z : lo.z);\n"
+"        vec4 p = inverseViewProjection * vec4(corner, 1.0);\n"
+"        boxMin = min(boxMin, p.xyz / p.w);\n"
+"        boxMax = max(boxMax, p.xyz / p.w);\n"
+"    }\n"
+"    uint base = cluster * 128u;\n"
+"    uint count = 0u;\n"
+"    for (uint first = 0u; first < gridSize.w; first += 64u)\n"
+"    {\n"
+"        uint i = first + gl_LocalInvocationID.x;\n"
+"        staged[gl_LocalInvocationID.x] = i < gridSize.w ? lights[i].position : vec4(0.0);\n"
+"        barrier();\n"
+"        uint n = min(64u, gridSize.w - first);\n"
+"        for (uint k = 0u; k < n && active; ++k)\n"
+"        {\n"
+"            vec4 s = staged[k];\n"
+"            vec3 d = max(boxMin - s.xyz, 0.0) + max(s.xyz - boxMax, 0.0);\n"
+"            if (dot(d, d) <= s.w * s.w && count < 127u)\n"
+"                clusterLights[base + 1u + count++] = first + k;\n"
+"        }\n"
+"        barrier();\n"
+"    }\n"
+"    if (active)\n"
+"        clusterLights[base] = count;\n"
+"}\n";
+
+// Deferred: a triangle over the whole viewport. Pixels nothing was drawn to keep the clear colour.
+static const char* resolve_vertex_shader_text =
+"#version 430\n"
+"out gl_PerVertex { vec4 gl_Position; };\n"
+"void main()\n"
+"{\n"
+"    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+"    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+static const char* resolve_fragment_shader_text =
+"#version 430\n"
+LIGHTING_GLSL
+LIGHTING_OCTAHEDRAL_GLSL
+"layout(binding = 0) uniform sampler2D gbufferAlbedo;\n"
+"layout(binding = 1) uniform sampler2D gbufferNormal;\n"
+"layout(binding = 2) uniform sampler2D gbufferDepth;\n"
+"layout(location = 0) uniform mat4 inverseViewProjection;\n"
+"layout(location = 1) uniform vec2 viewportSize;\n"
+"layout(location = 0) out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+"    vec4 albedo = texelFetch(gbufferAlbedo, pixel, 0);\n"
+"    if (albedo.a == 0.0)\n"
+"    {\n"
+"        fragment = vec4(albedo.rgb, 1.0);\n"
+"        return;\n"
+"    }\n"
+"    float depth = texelFetch(gbufferDepth, pixel, 0).r;\n"
+"    vec4 p = inverseViewProjection * vec4(gl_FragCoord.xy / viewportSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);\n"
+"    vec3 normal = octahedralDecode(texelFetch(gbufferNormal, pixel, 0).xy);\n"
+"    fragment = vec4(lightClustered(albedo.rgb, p.xyz / p.w, normal, vec3(gl_FragCoord.xy, depth)), 1.0);\n"
+"}\n";
+
+// The same from pixel local storage, which the scene's G-buffer pass left in the tile
+static const char* resolve_pixel_local_shader_text =
+"#version 430\n"
+"#extension GL_EXT_shader_pixel_local_storage : require\n"
+LIGHTING_GLSL
+LIGHTING_OCTAHEDRAL_GLSL
+LIGHTING_PIXEL_LOCAL_GLSL("__pixel_local_inEXT")
+"layout(location = 0) uniform mat4 inverseViewProjection;\n"
+"layout(location = 1) uniform vec2 viewportSize;\n"
+"layout(location = 0) out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    vec4 albedo = gbuffer.albedo;\n"
+"    if (albedo.a == 0.0)\n"
+"    {\n"
+"        fragment = vec4(albedo.rgb, 1.0);\n"
+"        return;\n"
+"    }\n"
+"    float depth = gbuffer.depth;\n"
+"    vec4 p = inverseViewProjection * vec4(gl_FragCoord.xy / viewportSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);\n"
+"    vec3 normal = octahedralDecode(gbuffer.normal.xy);\n"
+"    fragment = vec4(lightClustered(albedo.rgb, p.xyz / p.w, normal, vec3(gl_FragCoord.xy, depth)), 1.0);\n"
+"}\n";
+
+#define CLUSTER_STRIDE (1 + LIGHTING_CLUSTER_LIGHTS)   // uints per cluster: its count, then its list
+#define GRID_HEADER_SIZE (8 * sizeof(GLuint))           // lightGrid and lightTile
+
+static GLuint build_compute(const char* text, const char* label)
+{
+    GLuint shader = shader_compile(GL_COMPUTE_SHADER, text);
+    const GLuint program = program_link(&shader, 1, false);
+    if (!program)
+        fprintf(stderr, "lighting: can't build the %s compute shader\n", label);
+    else
+        gl_debug_label(GL_PROGRAM, program, label);
+    return program;
+}
+
+bool lighting_init(Lighting* l, const LightSource* lights, uint32_t count, bool deferred, bool zero_to_one_depth)
+{
+    memset(l, 0, sizeof(*l));
+    l->light_count = count < LIGHTING_MAX_LIGHTS ? count : LIGHTING_MAX_LIGHTS;
+    l->animate_program = build_compute(animate_shader_text, "light animate");
+    l->grid_program = build_compute(grid_shader_text, "light grid");
+    if (!l->animate_program || !l->grid_program)
+        return false;
+    l->zero_to_one_depth = zero_to_one_depth;
+    if (deferred)
+    {
+        // Pixel local where the fast storage holds the G-buffer's 12 bytes
+        GLint fast_size = 0;
+        if (gl_ext.EXT_shader_pixel_local_storage)
+            glGetIntegerv(GL_MAX_SHADER_PIXEL_LOCAL_STORAGE_FAST_SIZE_EXT, &fast_size);
+        l->pixel_local = fast_size >= LIGHTING_PIXEL_LOCAL_BYTES;
+        l->resolve_program = program_build(resolve_vertex_shader_text,
+            l->pixel_local ? resolve_pixel_local_shader_text : resolve_fragment_shader_text, false);
+        if (!l->resolve_program)
+        {
+            fprintf(stderr, "lighting: can't build the deferred resolve program\n");
+            return false;
+        }
+        gl_debug_label(GL_PROGRAM, l->resolve_program, "light resolve");
+    }
+
+    // Three vec4s per light, as the animate shader's Source
+    float* packed = (float*)calloc(12 * (l->light_count ? l->light_count : 1), sizeof(float));
+    if (!packed)
+    {
+        fprintf(stderr, "lighting: out of memory for %u lights\n", l->light_count);
+        return false;
+    }
+    for (uint32_t i = 0; i < l->light_count; ++i)
+    {
+        const LightSource* s = &lights[i];
+        float* p = &packed[12 * i];
+        p[0] = s->center[0];
+        p[1] = s->center[1];
+        p[2] = s->orbit;
+        p[3] = s->speed;
+        p[4] = s->phase;
+        p[5] = s->height;
+        p[6] = s->range;
+        for (int c = 0; c < 3; ++c)
+            p[8 + c] = s->color[c];
+    }
+    l->source_buffer = gl_dsa_create_buffer(sizeof(float) * 12 * (l->light_count ? l->light_count : 1), packed, GL_STATIC_DRAW);
+    gl_memory_buffer(l->source_buffer, GPU_MEMORY_STORAGE, sizeof(float) * 12 * (l->light_count ? l->light_count : 1));
+    free(packed);
+    gl_debug_label(GL_BUFFER, l->source_buffer, "light sources");
+
+    // The whole block's size whatever the count: the shaders declare all of it
+    l->light_buffer = gl_dsa_create_buffer(sizeof(float) * 8 * LIGHTING_MAX_LIGHTS, NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(l->light_buffer, GPU_MEMORY_STORAGE, sizeof(float) * 8 * LIGHTING_MAX_LIGHTS);
+    gl_debug_label(GL_BUFFER, l->light_buffer, "lights");
+    l->grid_buffer = gl_dsa_create_buffer(0, NULL, GL_DYNAMIC_COPY);     // sized by the first update
+    gl_debug_label(GL_BUFFER, l->grid_buffer, "light grid");
+    return true;
+}
+
+static void gbuffer_destroy(LightingGBuffer* g)
+{
+    gl_state_delete_framebuffers(1, &g->framebuffer);
+    GLuint textures[3] = { g->albedo, g->normal, g->depth };
+    gl_state_delete_textures(3, textures);
+    memset(g, 0, sizeof(*g));
+}
+
+void lighting_destroy(Lighting* l)
+{
+    if (l->gbuffer.framebuffer)
+        gbuffer_destroy(&l->gbuffer);
+    gl_state_delete_buffers(1, &l->grid_buffer);
+    gl_state_delete_buffers(1, &l->light_buffer);
+    gl_state_delete_buffers(1, &l->source_buffer);
+    if (l->resolve_program)
+        glDeleteProgram(l->resolve_program);
+    if (l->grid_program)
+        glDeleteProgram(l->grid_program);
+    if (l->animate_program)
+        glDeleteProgram(l->animate_program);
+    memset(l, 0, sizeof(*l));
+}
+
+void lighting_update(Lighting* l, float t, mat4x4 const inverse_view_projection, int width, int height)
+{
+    // The grid follows the viewport; its buffer only ever grows
+    l->grid[0] = (uint32_t)(width + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE;
+    l->grid[1] = (uint32_t)(height + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE;
+    l->grid[2] = LIGHTING_DEPTH_SLICES;
+    const uint32_t cluster_count = l->grid[0] * l->grid[1] * l->grid[2];
+    const GLsizeiptr grid_size = (GLsizeiptr)(GRID_HEADER_SIZE + sizeof(GLuint) * CLUSTER_STRIDE * cluster_count);
+    if (grid_size > l->grid_capacity)
+    {
+        gl_dsa_buffer_data(l->grid_buffer, grid_size, NULL, GL_DYNAMIC_COPY);
+        gl_memory_buffer(l->grid_buffer, GPU_MEMORY_STORAGE, grid_size);
+        l->grid_capacity = grid_size;
+    }
+    struct
+    {
+        GLuint grid[4];
+        float tile[4];
+    } header = { { l->grid[0], l->grid[1], l->grid[2], l->light_count },
+        { (float)LIGHTING_TILE_SIZE, (float)LIGHTING_TILE_SIZE, LIGHTING_AMBIENT, 0.f } };
+    gl_dsa_buffer_sub_data(l->grid_buffer, 0, sizeof(header), &header);
+
+    gl_state_use_program(l->animate_program);
+    glUniform1f(ANIMATE_LOCATION_TIME, t);
+    glUniform1ui(ANIMATE_LOCATION_COUNT, l->light_count);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, l->source_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, l->light_buffer);
+    glDispatchCompute((l->light_count + LIGHTING_GROUP_SIZE - 1) / LIGHTING_GROUP_SIZE, 1, 1);
+    draw_counters_dispatch();
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    gl_state_use_program(l->grid_program);
+    glUniformMatrix4fv(GRID_LOCATION_INVERSE_VIEW_PROJECTION, 1, GL_FALSE, &inverse_view_projection[0][0]);
+    glUniform4ui(GRID_LOCATION_SIZE, l->grid[0], l->grid[1], l->grid[2], l->light_count);
+    glUniform2f(GRID_LOCATION_TILE, 2.f * LIGHTING_TILE_SIZE / width, 2.f * LIGHTING_TILE_SIZE / height);
+    glUniform2f(GRID_LOCATION_DEPTH_RANGE, l->zero_to_one_depth ? 0.f : -1.f, 1.f);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, LIGHTING_GRID_BINDING, l->grid_buffer);
+    glDispatchCompute((cluster_count + LIGHTING_GROUP_SIZE - 1) / LIGHTING_GROUP_SIZE, 1, 1);
+    draw_counters_dispatch();
+
+    // The fragment shaders read the lights as a uniform block and the lists as shader storage
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT);
+    gl_state_bind_buffer_base(GL_UNIFORM_BUFFER, LIGHTING_LIGHTS_BINDING, l->light_buffer);
+}
+
+static bool gbuffer_init(LightingGBuffer* g, int width, int height)
+{
+    memset(g, 0, sizeof(*g));
+    g->width = width;
+    g->height = height;
+    const GLenum formats[3] = { GL_RGBA8, gl_ext.es ? (GLenum)GL_RGB10_A2 : (GLenum)GL_RG16, GL_DEPTH_COMPONENT24 };
+    GLuint* textures[3] = { &g->albedo, &g->normal, &g->depth };
+    static const char* labels[3] = { "gbuffer albedo", "gbuffer normal", "gbuffer depth" };
+    for (int i = 0; i < 3; ++i)
+    {
+        glGenTextures(1, textures[i]);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, *textures[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+        gl_memory_texture(*textures[i], GPU_MEMORY_RENDER_TARGETS, formats[i], width, height, 1, 1, 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gl_debug_label(GL_TEXTURE, *textures[i], labels[i]);
+    }
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &g->framebuffer);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, g->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g->albedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, g->normal, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, g->depth, 0);
+    const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, buffers);
+    gl_debug_label(GL_FRAMEBUFFER, g->framebuffer, "gbuffer");
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "lighting: %dx%d G-buffer incomplete (0x%04X)\n", width, height, status);
+        gl_state_bind_framebuffer(GL_FRAMEBUFFER, 0);
+        gbuffer_destroy(g);
+        return false;
+    }
+    return true;
+}
+
+bool lighting_gbuffer_begin(Lighting* l, int width, int height)
+{
+    l->resolve_framebuffer = gl_state.draw_framebuffer;
+    if (l->pixel_local)
+    {
+        // Cleared, the storage starts at zero: alpha 0, nothing drawn
+        l->gbuffer.width = width;
+        l->gbuffer.height = height;
+        const float zero[4] = { 0.f, 0.f, 0.f, 0.f };
+        const float depth = 1.f;
+        glClearBufferfv(GL_COLOR, 0, zero);
+        glClearBufferfv(GL_DEPTH, 0, &depth);
+        glEnable(GL_SHADER_PIXEL_LOCAL_STORAGE_EXT);
+        gl_state_enable(GL_DEPTH_TEST, true);
+        gl_state_depth_func(GL_ALWAYS);
+        return true;
+    }
+    if (l->gbuffer.framebuffer && (l->gbuffer.width != width || l->gbuffer.height != height))
+        gbuffer_destroy(&l->gbuffer);
+    if (!l->gbuffer.framebuffer && !gbuffer_init(&l->gbuffer, width, height))
+        return false;
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, l->gbuffer.framebuffer);
+    const float albedo[4] = { 0.f, 0.f, 0.f, 0.f };    // the frame's clear colour, and nothing drawn
+    const float normal[4] = { 0.5f, 0.5f, 0.f, 0.f };
+    const float depth = 1.f;
+    glClearBufferfv(GL_COLOR, 0, albedo);
+    glClearBufferfv(GL_COLOR, 1, normal);
+    glClearBufferfv(GL_DEPTH, 0, &depth);
+    gl_state_enable(GL_DEPTH_TEST, true);
+    gl_state_depth_func(GL_ALWAYS);
+    return true;
+}
+
+void lighting_gbuffer_resolve(Lighting* l, mat4x4 const inverse_view_projection)
+{
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_depth_func(GL_LESS);
+    if (!l->pixel_local)
+        gl_state_bind_framebuffer(GL_FRAMEBUFFER, l->resolve_framebuffer);
+
+    gl_state_use_program(l->resolve_program);
+    glUniformMatrix4fv(RESOLVE_LOCATION_INVERSE_VIEW_PROJECTION, 1, GL_FALSE, &inverse_view_projection[0][0]);
+    glUniform2f(RESOLVE_LOCATION_VIEWPORT, (float)l->gbuffer.width, (float)l->gbuffer.height);
+    if (!l->pixel_local)
+    {
+        gl_state_bind_texture(0, GL_TEXTURE_2D, l->gbuffer.albedo);
+        gl_state_bind_texture(1, GL_TEXTURE_2D, l->gbuffer.normal);
+        gl_state_bind_texture(2, GL_TEXTURE_2D, l->gbuffer.depth);
+    }
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+    if (l->pixel_local)
+        glDisable(GL_SHADER_PIXEL_LOCAL_STORAGE_EXT);   // the storage's contents are gone from here
+}
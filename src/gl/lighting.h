@@ -0,0 +1,165 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "linmath.h"
+
+#include <stdint.h>
+
+// Clustered lighting (needs a 4.3 context): hundreds of dynamic point
+// lights without every fragment looping over all of them.
+//
+// The view frustum is cut into clusters: LIGHTING_TILE_SIZE pixel tiles on
+// screen times LIGHTING_DEPTH_SLICES slices of depth. Every frame two compute
+// passes run:
+//   animate: each light moves along its orbit on the GPU, written to the
+//            light buffer the shaders read as a uniform block.
+//   grid:    one invocation per cluster bounds its slab of the frustum with
+//            a world-space box and lists the lights whose spheres reach it.
+//            The work group stages the lights in shared memory, 64 at a
+//            time, so each is read from memory once per group.
+// A fragment then finds its cluster from gl_FragCoord and only shades with
+// that cluster's list (LIGHTING_GLSL's lightClustered).
+//
+// The clusters are slices of NDC depth, which the orthographic camera makes
+// even slices of view depth too (reversed Z just numbers them the other way).
+//
+// Forward, the scene shaders' LIT variant shades as it rasterizes. Deferred,
+// the GBUFFER variant writes albedo and an octahedral-packed normal (two
+// 16-bit unorms) into a G-buffer with its depth, and one fullscreen pass
+// shades each pixel once from those, whatever the overdraw.
+//
+// On an ES context with EXT_shader_pixel_local_storage (--gles on Mali and
+// PowerVR) the G-buffer never leaves the chip. The GBUFFER variant with
+// PIXEL_LOCAL writes albedo, normal and depth into pixel local storage
+// (LIGHTING_PIXEL_LOCAL_GLSL, 12 bytes a pixel) over the frame's own target,
+// and the resolve pass reads them back from the same tile and writes only the
+// shaded colour: no G-buffer textures, and nothing but the result stored to
+// memory.
+
+#define LIGHTING_MAX_LIGHTS 512         // the Lights uniform block's size: 16 KB, the least a driver offers
+#define LIGHTING_TILE_SIZE 64           // cluster width and height in pixels
+#define LIGHTING_DEPTH_SLICES 16
+#define LIGHTING_CLUSTER_LIGHTS 127     // lights a cluster lists at most; more are left out of it
+#define LIGHTING_GROUP_SIZE 64          // clusters per work group, and lights staged at a time (local_size_x)
+#define LIGHTING_LIGHTS_BINDING 3       // the Lights uniform block's binding, as in LIGHTING_GLSL
+#define LIGHTING_GRID_BINDING 7         // the LightGrid block's shader storage binding, as in LIGHTING_GLSL
+#define LIGHTING_AMBIENT 0.12f          // light everything gets, lit or not
+
+// The Lights block and the LightGrid block (its header, then per cluster a count and up to LIGHTING_CLUSTER_LIGHTS
+// indices), and lightClustered(albedo, world position, unit normal, gl_FragCoord.xyz). Needs GLSL 430.
+#define LIGHTING_GLSL \
+    "struct Light { vec4 position; vec4 color; };\n"    /* xyz, range; rgb */ \
+    "layout(std140, binding = 3) uniform Lights { Light lights[512]; };\n" \
+    "layout(std430, binding = 7) readonly buffer LightGrid\n" \
+    "{\n" \
+    "    uvec4 lightGrid;\n"    /* clusters across, up, deep; light count */ \
+    "    vec4 lightTile;\n"     /* cluster width and height in pixels; ambient */ \
+    "    uint clusterLights[];\n" \
+    "};\n" \
+    "vec3 lightClustered(vec3 albedo, vec3 position, vec3 normal, vec3 fragCoord)\n" \
+    "{\n" \
+    "    uvec2 tile = min(uvec2(fragCoord.xy / lightTile.xy), lightGrid.xy - 1u);\n" \
+    "    uint slice = min(uint(fragCoord.z * float(lightGrid.z)), lightGrid.z - 1u);\n" \
+    "    uint base = ((slice * lightGrid.y + tile.y) * lightGrid.x + tile.x) * 128u;\n" \
+    "    vec3 light = vec3(lightTile.z);\n" \
+    "    uint count = clusterLights[base];\n" \
+    "    for (uint k = 1u; k <= count; ++k)\n" \
+    "    {\n" \
+    "        Light l = lights[clusterLights[base + k]];\n" \
+    "        vec3 d = l.position.xyz - position;\n" \
+    "        float distance2 = max(dot(d, d), 1e-8);\n" \
+    "        float falloff = clamp(1.0 - distance2 / (l.position.w * l.position.w), 0.0, 1.0);\n" \
+    "        light += l.color.rgb * (falloff * falloff) * max(dot(normal, d * inversesqrt(distance2)), 0.0);\n" \
+    "    }\n" \
+    "    return albedo * light;\n" \
+    "}\n"
+
+// Octahedral normal packing for the G-buffer: unit vector <-> [0, 1]^2
+#define LIGHTING_OCTAHEDRAL_GLSL \
+    "vec2 octahedralEncode(vec3 n)\n" \
+    "{\n" \
+    "    n /= abs(n.x) + abs(n.y) + abs(n.z);\n" \
+    "    vec2 p = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);\n" \
+    "    return p * 0.5 + 0.5;\n" \
+    "}\n" \
+    "vec3 octahedralDecode(vec2 e)\n" \
+    "{\n" \
+    "    vec2 p = e * 2.0 - 1.0;\n" \
+    "    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));\n" \
+    "    float t = max(-n.z, 0.0);\n" \
+    "    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);\n" \
+    "    return normalize(n);\n" \
+    "}\n"
+
+// The pixel local storage block, declared __pixel_localEXT by the G-buffer pass and __pixel_local_inEXT by the
+// resolve (the same layout both sides). Needs GL_EXT_shader_pixel_local_storage.
+#define LIGHTING_PIXEL_LOCAL_GLSL(storage) \
+    storage " GBuffer\n" \
+    "{\n" \
+    "    layout(rgba8) highp vec4 albedo;\n" \
+    "    layout(rgb10_a2) highp vec4 normal;\n"     /* xy octahedral */ \
+    "    layout(r32f) highp float depth;\n" \
+    "} gbuffer;\n"
+#define LIGHTING_PIXEL_LOCAL_BYTES 12
+
+// A light circling "center" at "height" above the grid's plane, as the animate pass moves it
+typedef struct LightSource
+{
+    float center[2];            // world space
+    float orbit;                // radius of its circle
+    float speed;                // radians per second, either way round
+    float phase;                // radians at time 0
+    float height;               // above the z = 0 plane, on the side the meshes face
+    float range;                // where its light fades to nothing
+    float color[3];             // linear, times its intensity
+} LightSource;
+
+// The deferred path's render target, sized to the frame
+typedef struct LightingGBuffer
+{
+    GLuint framebuffer;
+    GLuint albedo;              // RGBA8: the lit colour before lighting; alpha 0 where nothing was drawn
+    GLuint normal;              // RG16 (RGB10_A2 on ES, where RG16 doesn't render): octahedral normal
+    GLuint depth;               // DEPTH_COMPONENT24, for the world position
+    int width;
+    int height;
+} LightingGBuffer;
+
+typedef struct Lighting
+{
+    GLuint animate_program;
+    GLuint grid_program;
+    GLuint resolve_program;     // deferred: the fullscreen pass
+    GLuint source_buffer;       // SSBO: the LightSources, packed
+    GLuint light_buffer;        // this frame's lights: written as shader storage, read as the Lights block
+    GLuint grid_buffer;         // the LightGrid block
+    GLsizeiptr grid_capacity;   // bytes it holds
+    uint32_t light_count;
+    bool zero_to_one_depth;     // NDC depth runs [0, 1] (reversed Z), not [-1, 1]
+    uint32_t grid[3];           // clusters across, up and deep as of the last update
+    LightingGBuffer gbuffer;    // deferred only; 0s until the first lighting_gbuffer_begin (only its size, pixel local)
+    bool pixel_local;           // deferred through pixel local storage: the scene draws GBUFFER with PIXEL_LOCAL
+    GLuint resolve_framebuffer; // where lighting_gbuffer_begin found the frame being drawn
+} Lighting;
+
+// Uploads "count" lights (at most LIGHTING_MAX_LIGHTS) and builds the compute programs, and the resolve program when
+// "deferred" (which assumes the [-1, 1] depth range): the pixel local storage one where the context has it.
+// "zero_to_one_depth": the projection puts NDC depth in [0, 1] (reversed Z), so the clusters' slices are cut from
+// that. Logs and returns false when one fails to build.
+bool lighting_init(Lighting* l, const LightSource* lights, uint32_t count, bool deferred, bool zero_to_one_depth);
+void lighting_destroy(Lighting* l);
+
+// Moves the lights to time "t" and lists them per cluster of a "width" x "height" viewport seen through
+// the view-projection "inverse_view_projection" undoes, then binds the Lights and LightGrid blocks for the draws
+void lighting_update(Lighting* l, float t, mat4x4 const inverse_view_projection, int width, int height);
+
+// Deferred: switches drawing to the G-buffer (resized to "width" x "height" if need be) and clears it. The scene
+// then draws with the GBUFFER variant, and depth testing on (GL_ALWAYS: the same draw order wins as forward).
+// Pixel local: the frame's target is cleared and pixel local storage turned on over it until the resolve; the
+// draws in between mustn't write colour.
+bool lighting_gbuffer_begin(Lighting* l, int width, int height);
+
+// Deferred: back to the framebuffer lighting_gbuffer_begin found, shaded from the G-buffer in one fullscreen pass
+// (a VAO bound by the caller; the pass has no attributes)
+void lighting_gbuffer_resolve(Lighting* l, mat4x4 const inverse_view_projection);
@@ -0,0 +1,192 @@
+#include "gl/line_renderer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Six vertices a segment, two triangles: corner c is at the segment's start (0) or end (1) and on the left (+1) or
+// right (-1) of it. A corner is pushed out by half the width plus half a pixel, along the normal and past the end
+// point, so neighbouring segments overlap at the joins instead of leaving a notch. "across" runs out to the
+// pushed edge, where the fragment shader fades the last pixel.
+static const char* vertex_shader_text =
+"#version 330 core\n"
+"uniform samplerBuffer pairs;\n"
+"uniform int levelOffset;\n"
+"uniform int levelMask;\n"       // buckets in the level's ring - 1
+"uniform int first;\n"
+"uniform int pointsPerBucket;\n"  // 1 at level 0 (the samples), else 2 (min, then max)
+"uniform vec4 rect;\n"
+"uniform vec2 range;\n"          // the values at the bottom and top of rect
+"uniform float spacing;\n"       // pixels per bucket
+"uniform vec2 viewport;\n"
+"uniform float halfWidth;\n"
+"out float across;\n"
+"const int ends[6] = int[6](0, 0, 1, 1, 0, 1);\n"
+"const float sides[6] = float[6](-1.0, 1.0, -1.0, -1.0, 1.0, 1.0);\n"
+"vec2 point(int k)\n"
+"{\n"
+"    int bucket = k / pointsPerBucket;\n"
+"    vec2 pair = texelFetch(pairs, levelOffset + ((first + bucket) & levelMask)).rg;\n"
+"    float value = (k - bucket * pointsPerBucket) == 0 ? pair.x : pair.y;\n"
+"    float t = clamp((value - range.x) / (range.y - range.x), 0.0, 1.0);\n"
+"    return vec2(rect.x + (float(bucket) + 0.5) * spacing, rect.y + t * rect.w);\n"
+"}\n"
+"void main()\n"
+"{\n"
+"    int segment = gl_VertexID / 6, corner = gl_VertexID - segment * 6;\n"
+"    vec2 a = point(segment), b = point(segment + 1);\n"
+"    vec2 d = b - a;\n"
+"    float len = length(d);\n"
+"    d = len > 1e-4 ? d / len : vec2(1.0, 0.0);\n"
+"    float reach = halfWidth + 0.5;\n"
+"    vec2 p = (ends[corner] == 1 ? b + d * reach : a - d * reach) + vec2(-d.y, d.x) * sides[corner] * reach;\n"
+"    across = sides[corner] * reach;\n"
+"    gl_Position = vec4(p / viewport * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+static const char* fragment_shader_text =
+"#version 330 core\n"
+"uniform vec4 color;\n"
+"uniform float halfWidth;\n"
+"in float across;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    float coverage = clamp(halfWidth + 0.5 - abs(across), 0.0, 1.0);\n"
+"    fragment = vec4(color.rgb, color.a * coverage);\n"
+"}\n";
+
+bool line_renderer_init(LineRenderer* lr, int series_count, uint32_t capacity)
+{
+    memset(lr, 0, sizeof(*lr));
+    lr->series_count = series_count;
+    lr->capacity = capacity;
+    for (uint32_t n = capacity; n; n >>= 1)
+        lr->series_pairs += n;
+
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    if ((uint64_t)lr->series_pairs * series_count > (uint64_t)max_texels)
+    {
+        fprintf(stderr, "line_renderer: %d series of %u samples need %llu texels, the driver allows %d\n", series_count,
+            capacity, (unsigned long long)lr->series_pairs * series_count, max_texels);
+        return false;
+    }
+    lr->program = program_build(vertex_shader_text, fragment_shader_text, false);
+    if (!lr->program)
+    {
+        fprintf(stderr, "line_renderer: can't build the program\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, lr->program, "lines");
+    lr->level_offset_location = glGetUniformLocation(lr->program, "levelOffset");
+    lr->level_mask_location = glGetUniformLocation(lr->program, "levelMask");
+    lr->first_location = glGetUniformLocation(lr->program, "first");
+    lr->points_per_bucket_location = glGetUniformLocation(lr->program, "pointsPerBucket");
+    lr->rect_location = glGetUniformLocation(lr->program, "rect");
+    lr->range_location = glGetUniformLocation(lr->program, "range");
+    lr->spacing_location = glGetUniformLocation(lr->program, "spacing");
+    lr->viewport_location = glGetUniformLocation(lr->program, "viewport");
+    lr->half_width_location = glGetUniformLocation(lr->program, "halfWidth");
+    lr->color_location = glGetUniformLocation(lr->program, "color");
+    gl_state_use_program(lr->program);
+    glUniform1i(glGetUniformLocation(lr->program, "pairs"), 0);
+
+    glGenBuffers(1, &lr->buffer);
+    gl_state_bind_buffer(GL_TEXTURE_BUFFER, lr->buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)sizeof(float) * 2 * lr->series_pairs * series_count, NULL, GL_DYNAMIC_DRAW);
+    gl_memory_buffer(lr->buffer, GPU_MEMORY_UNIFORMS, (GLsizeiptr)sizeof(float) * 2 * lr->series_pairs * series_count);
+    gl_state_bind_buffer(GL_TEXTURE_BUFFER, 0);
+    gl_debug_label(GL_BUFFER, lr->buffer, "line series");
+    glGenTextures(1, &lr->texture);
+    gl_state_bind_texture(0, GL_TEXTURE_BUFFER, lr->texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, lr->buffer);
+    gl_debug_label(GL_TEXTURE, lr->texture, "line series");
+    lr->vertex_array = gl_dsa_create_vertex_array();
+    gl_debug_label(GL_VERTEX_ARRAY, lr->vertex_array, "lines");
+    return true;
+}
+
+void line_renderer_destroy(LineRenderer* lr)
+{
+    if (lr->vertex_array)
+        gl_state_delete_vertex_arrays(1, &lr->vertex_array);
+    if (lr->texture)
+        gl_state_delete_textures(1, &lr->texture);
+    if (lr->buffer)
+        gl_state_delete_buffers(1, &lr->buffer);
+    if (lr->program)
+        glDeleteProgram(lr->program);
+    memset(lr, 0, sizeof(*lr));
+}
+
+void line_renderer_upload(LineRenderer* lr, int index, LineSeries* series)
+{
+    gl_state_bind_buffer(GL_TEXTURE_BUFFER, lr->buffer);
+    const GLintptr base = (GLintptr)sizeof(float) * 2 * lr->series_pairs * index;
+    for (int l = 0; l < series->level_count; ++l)
+    {
+        uint32_t ranges[2][2];
+        const int count = line_series_take_dirty(series, l, ranges);
+        for (int k = 0; k < count; ++k)
+        {
+            const uint32_t first = series->level_offset[l] + ranges[k][0];
+            const GLsizeiptr bytes = (GLsizeiptr)sizeof(float) * 2 * ranges[k][1];
+            glBufferSubData(GL_TEXTURE_BUFFER, base + (GLintptr)sizeof(float) * 2 * first, bytes,
+                series->buckets + 2 * first);
+            lr->bytes_uploaded += (uint64_t)bytes;
+            draw_counters_upload((size_t)bytes);
+        }
+    }
+    gl_state_bind_buffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void line_renderer_begin(LineRenderer* lr, int width, int height)
+{
+    lr->depth_test = gl_state.capabilities[GL_STATE_CAP_DEPTH_TEST] == 1;
+    gl_state_use_program(lr->program);
+    gl_state_bind_vertex_array(lr->vertex_array);
+    gl_state_bind_texture(0, GL_TEXTURE_BUFFER, lr->texture);
+    gl_state_viewport(0, 0, width, height);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUniform2f(lr->viewport_location, (float)width, (float)height);
+}
+
+void line_renderer_draw(LineRenderer* lr, int index, const LineSeriesView* view, const float rect[4], float low,
+    float high, float width, uint32_t color)
+{
+    const int per_bucket = view->level ? 2 : 1;
+    const uint32_t points = view->buckets * per_bucket;
+    if (points < 2)
+        return;
+    const uint32_t buckets = lr->capacity >> view->level;
+    // The finer levels before this one hold 2 x (capacity - buckets) pairs, as line_series_init laid them out
+    glUniform1i(lr->level_offset_location, (GLint)(lr->series_pairs * index + 2 * (lr->capacity - buckets)));
+    glUniform1i(lr->level_mask_location, (GLint)(buckets - 1));
+    glUniform1i(lr->first_location, (GLint)(view->first & (buckets - 1)));
+    glUniform1i(lr->points_per_bucket_location, per_bucket);
+    glUniform4fv(lr->rect_location, 1, rect);
+    glUniform2f(lr->range_location, low, high > low ? high : low + 1.f);
+    glUniform1f(lr->spacing_location, rect[2] / view->buckets);
+    glUniform1f(lr->half_width_location, 0.5f * width);
+    glUniform4f(lr->color_location, (color & 0xFF) / 255.f, (color >> 8 & 0xFF) / 255.f, (color >> 16 & 0xFF) / 255.f,
+        (color >> 24) / 255.f);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(6 * (points - 1)));
+    draw_counters_draw(GL_TRIANGLES, (GLsizei)(6 * (points - 1)), 1);
+    lr->points_drawn += points;
+    ++lr->draws;
+}
+
+void line_renderer_end(LineRenderer* lr)
+{
+    gl_state_enable(GL_BLEND, false);
+    gl_state_enable(GL_DEPTH_TEST, lr->depth_test);
+}
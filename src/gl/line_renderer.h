@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/line_series.h"
+
+#include <stdint.h>
+
+// Draws LineSeries (core/line_series.h) as screen-space lines of any width.
+//
+// Every series' pyramid lives in one buffer, read as a GL_RG32F buffer
+// texture: the same rings at the same offsets as on the CPU, so keeping it
+// current is a glBufferSubData of the slots line_series_take_dirty hands out
+// and the history is never uploaded again. A draw has no vertex buffer at
+// all: the vertex shader takes segment gl_VertexID / 6 of the view's
+// polyline, fetches its two points from the level's ring, places them in the
+// chart's rectangle and pushes each corner half the width out along the
+// segment's normal. The outer pixel fades with its coverage, so lines are
+// antialiased without MSAA. A view's cost is its points, about two a pixel
+// of chart width at any history length.
+
+typedef struct LineRenderer
+{
+    GLuint program;
+    GLint level_offset_location;
+    GLint level_mask_location;
+    GLint first_location;           // the view's first bucket's ring slot
+    GLint points_per_bucket_location;
+    GLint rect_location;            // x, y, width, height in pixels from the bottom left
+    GLint range_location;
+    GLint spacing_location;
+    GLint viewport_location;
+    GLint half_width_location;
+    GLint color_location;
+    GLuint vertex_array;            // empty: everything comes from the buffer texture
+    GLuint buffer;
+    GLuint texture;
+    int series_count;
+    uint32_t capacity;              // per series
+    uint32_t series_pairs;          // (min, max) pairs per series
+    uint64_t bytes_uploaded;        // over the run
+    uint64_t points_drawn;
+    unsigned int draws;
+    bool depth_test;                // as line_renderer_begin found it
+} LineRenderer;
+
+// Room for "series_count" series of "capacity" samples (a power of two, as line_series_init made it). Logs and
+// returns false when the program fails to build or the buffer texture would be too big for the driver.
+bool line_renderer_init(LineRenderer* lr, int series_count, uint32_t capacity);
+void line_renderer_destroy(LineRenderer* lr);
+
+// What "series" appended since its last upload into slot "index"
+void line_renderer_upload(LineRenderer* lr, int index, LineSeries* series);
+
+// State for the draws that follow, over a "width" x "height" framebuffer: blending on, depth test off
+void line_renderer_begin(LineRenderer* lr, int width, int height);
+
+// Series "index" through "view" into "rect" (x, y, width, height in pixels), its values from "low" at the bottom to
+// "high" at the top; "color" is RGBA8, red in the low byte
+void line_renderer_draw(LineRenderer* lr, int index, const LineSeriesView* view, const float rect[4], float low,
+    float high, float width, uint32_t color);
+
+// Blending back off, the depth test as line_renderer_begin found it
+void line_renderer_end(LineRenderer* lr);
@@ -0,0 +1,121 @@
+#include "gl/loading_screen.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_state.h"
+
+#include <string.h>
+
+// One triangle past the corners of clip space
+static const char* fade_vertex_shader_text =
+"#version 330 core\n"
+"void main()\n"
+"{\n"
+"    vec2 p = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);\n"
+"    gl_Position = vec4(p, 0.0, 1.0);\n"
+"}\n";
+
+static const char* fade_fragment_shader_text =
+"#version 330 core\n"
+"uniform vec4 colour;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    fragment = colour;\n"
+"}\n";
+
+// The clear colour the frames start from (GL's default: the renderer never sets another)
+static const GLfloat background[4] = { 0.f, 0.f, 0.f, 1.f };
+static const GLfloat track[4] = { 0.15f, 0.15f, 0.15f, 1.f };
+static const GLfloat fill[4] = { 0.7f, 0.7f, 0.7f, 1.f };
+
+void loading_screen_init(LoadingScreen* ls, ShaderManager* sm)
+{
+    memset(ls, 0, sizeof(*ls));
+    ls->fade_program_id = shader_manager_submit(sm, fade_vertex_shader_text, fade_fragment_shader_text);
+    ls->colour_location = -1;
+    ls->vertex_array = gl_dsa_create_vertex_array();
+    gl_debug_label(GL_VERTEX_ARRAY, ls->vertex_array, "loading screen");
+    ls->ready_time = -1.0;
+}
+
+void loading_screen_destroy(LoadingScreen* ls)
+{
+    if (ls->vertex_array)
+        gl_state_delete_vertex_arrays(1, &ls->vertex_array);
+    memset(ls, 0, sizeof(*ls));     // the program is the shader manager's
+}
+
+// "colour" over the bound framebuffer's x, y, width, height rectangle, scissor test on
+static void clear_rect(int x, int y, int width, int height, const GLfloat* colour)
+{
+    glScissor(x, y, width, height);
+    glClearBufferfv(GL_COLOR, 0, colour);
+}
+
+void loading_screen_draw(LoadingScreen* ls, int width, int height, float progress)
+{
+    if (width < 1 || height < 1)
+        return;
+    progress = progress < 0.f ? 0.f : progress > 1.f ? 1.f : progress;
+    ls->progress = progress > ls->progress ? progress : ls->progress;
+
+    // A track 40% of the width across the middle, filled from the left
+    const int bar_width = width * 2 / 5 > 2 ? width * 2 / 5 : 2;
+    const int bar_height = height / 96 > 4 ? height / 96 : 4;
+    const int x = (width - bar_width) / 2, y = (height - bar_height) / 2;
+    const int filled = (int)(ls->progress * (float)bar_width);
+    const bool scissor = gl_state.capabilities[GL_STATE_CAP_SCISSOR_TEST] == 1;
+    gl_state_colour_mask(true);
+    gl_state_enable(GL_SCISSOR_TEST, true);
+    clear_rect(x, y, bar_width, bar_height, track);
+    if (filled > 0)
+        clear_rect(x, y, filled, bar_height, fill);
+    gl_state_enable(GL_SCISSOR_TEST, scissor);
+}
+
+void loading_screen_ready(LoadingScreen* ls, double now)
+{
+    if (ls->ready_time < 0.0)
+        ls->ready_time = now;
+}
+
+bool loading_screen_fading(const LoadingScreen* ls, double now)
+{
+    return ls->ready_time >= 0.0 && now - ls->ready_time < LOADING_SCREEN_FADE_SECONDS;
+}
+
+void loading_screen_fade(LoadingScreen* ls, const ShaderManager* sm, int width, int height, double now)
+{
+    if (!loading_screen_fading(ls, now) || width < 1 || height < 1 || ls->fade_program_id < 0)
+        return;
+    const GLuint program = shader_manager_program(sm, ls->fade_program_id);
+    if (!program)
+        return;
+    if (program != ls->fade_program)
+    {
+        ls->fade_program = program;
+        ls->colour_location = glGetUniformLocation(program, "colour");
+        gl_debug_label(GL_PROGRAM, program, "loading screen fade");
+    }
+
+    // Eased out: most of the scene is there well before the end
+    const float left = 1.f - (float)((now - ls->ready_time) / LOADING_SCREEN_FADE_SECONDS);
+    const bool depth_test = gl_state.capabilities[GL_STATE_CAP_DEPTH_TEST] == 1;
+    const bool cull_face = gl_state.capabilities[GL_STATE_CAP_CULL_FACE] == 1;
+    gl_state_use_program(program);
+    gl_state_bind_vertex_array(ls->vertex_array);
+    gl_state_viewport(0, 0, width, height);
+    gl_state_colour_mask(true);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_CULL_FACE, false);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUniform4f(ls->colour_location, background[0], background[1], background[2], left * left);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+    gl_state_enable(GL_BLEND, false);
+    gl_state_enable(GL_CULL_FACE, cull_face);
+    gl_state_enable(GL_DEPTH_TEST, depth_test);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/shader_manager.h"
+
+// What the window shows between its first present and the first frame with
+// the scene in it, and the scene fading in from the clear colour after.
+//
+// The progress frame needs no program: the bar is two scissored clears over
+// the cleared frame, so it draws from the first frame after the context is
+// current while the scene's programs are still compiling. The fade is a
+// fullscreen triangle of the clear colour blended over the frame, less of it
+// each frame for LOADING_SCREEN_FADE_SECONDS; its program goes through the
+// shader manager with the rest and the scene just appears if it isn't ready.
+
+#define LOADING_SCREEN_FADE_SECONDS 0.4
+
+typedef struct LoadingScreen
+{
+    int fade_program_id;        // in the shader manager; -1 when it couldn't be submitted
+    GLint colour_location;      // looked up once the program is ready
+    GLuint fade_program;        // the program colour_location is for
+    GLuint vertex_array;        // empty: the triangle's corners come from gl_VertexID
+    float progress;             // what the bar last showed: it never goes back
+    double ready_time;          // when the scene first drew, negative before
+} LoadingScreen;
+
+// Submits the fade program to "sm". Needs a current context.
+void loading_screen_init(LoadingScreen* ls, ShaderManager* sm);
+void loading_screen_destroy(LoadingScreen* ls);
+
+// The progress bar, "progress" from 0 to 1, across the middle of the bound "width" x "height" framebuffer
+void loading_screen_draw(LoadingScreen* ls, int width, int height, float progress);
+
+// The scene drew for the first time at "now" (seconds): the fade starts. Later calls are ignored.
+void loading_screen_ready(LoadingScreen* ls, double now);
+
+// True while a frame drawn at "now" still has some of the fade over it
+bool loading_screen_fading(const LoadingScreen* ls, double now);
+
+// The fade over the bound "width" x "height" framebuffer, as it is at "now". Nothing once it's over, or while
+// its program isn't ready.
+void loading_screen_fade(LoadingScreen* ls, const ShaderManager* sm, int width, int height, double now);
@@ -0,0 +1,249 @@
+#include "gl/material.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/texture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool material_bindless_supported(void)
+{
+    return GLAD_GL_VERSION_4_3 && gl_ext.ARB_bindless_texture && gl_ext.NV_gpu_shader5;
+}
+
+// The array "file" goes into as a new layer: one with the same format, size and levels, or a new one
+static bool assign_array(MaterialSet* ms, Material* m, const TextureFile* file)
+{
+    for (int a = 0; a < ms->array_count; ++a)
+    {
+        MaterialArray* array = &ms->arrays[a];
+        if (array->format == file->format && array->srgb == file->srgb && array->width == file->width
+            && array->height == file->height && array->level_count == file->level_count)
+        {
+            m->array = a;
+            m->layer = array->layer_count++;
+            return true;
+        }
+    }
+    if (ms->array_count == MATERIAL_MAX_ARRAYS)
+        return false;
+    MaterialArray* array = &ms->arrays[ms->array_count];
+    array->texture = 0;
+    array->format = file->format;
+    array->srgb = file->srgb;
+    array->width = file->width;
+    array->height = file->height;
+    array->level_count = file->level_count;
+    array->layer_count = 1;
+    m->array = ms->array_count++;
+    m->layer = 0;
+    return true;
+}
+
+static void create_array(MaterialArray* array, GLenum internal_format, GLuint unit)
+{
+    glGenTextures(1, &array->texture);
+    gl_state_bind_texture(unit, GL_TEXTURE_2D_ARRAY, array->texture);
+    gl_ext.TexStorage3D(GL_TEXTURE_2D_ARRAY, array->level_count, internal_format, (GLsizei)array->width,
+        (GLsizei)array->height, array->layer_count);
+    gl_memory_texture(array->texture, GPU_MEMORY_TEXTURES, internal_format, (GLsizei)array->width, (GLsizei)array->height,
+        array->layer_count, array->level_count, 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    gl_debug_label(GL_TEXTURE, array->texture, "material array");
+}
+
+// Every level of "file" into layer "layer" of the array bound to the active unit
+static void upload_layer(const TextureFile* file, GLenum internal_format, int layer)
+{
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);    // straight from the mapping
+    for (int l = 0; l < file->level_count; ++l)
+    {
+        const TextureLevel* level = &file->levels[l];
+        if (file->format != TEXTURE_FORMAT_RGBA8)
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, l, 0, 0, layer, (GLsizei)level->width, (GLsizei)level->height, 1,
+                internal_format, (GLsizei)level->size, level->data);
+        else
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, l, 0, 0, layer, (GLsizei)level->width, (GLsizei)level->height, 1, GL_RGBA,
+                GL_UNSIGNED_BYTE, level->data);
+    }
+}
+
+bool material_set_init(MaterialSet* ms, GLResources* resources, const char* const* paths, int count, bool bindless)
+{
+    memset(ms, 0, sizeof(*ms));
+    ms->resources = resources;
+    if (count < 1 || count > MATERIAL_MAX)
+    {
+        fprintf(stderr, "material: %d materials, at most %d are supported\n", count, MATERIAL_MAX);
+        return false;
+    }
+    ms->mode = bindless && material_bindless_supported() ? MATERIAL_MODE_BINDLESS : MATERIAL_MODE_ARRAYS;
+    if (ms->mode == MATERIAL_MODE_ARRAYS && !gl_ext.TexStorage3D)
+    {
+        fprintf(stderr, "material: texture arrays need immutable storage (4.2 or GL_ARB_texture_storage)\n");
+        return false;
+    }
+
+    // Every file is mapped before anything is created: an array's storage needs its layer count up front
+    TextureFile* files = (TextureFile*)malloc(sizeof(TextureFile) * count);
+    GLenum internal_formats[MATERIAL_MAX];
+    int opened = 0;
+    bool ok = true;
+    while (ok && opened < count)
+    {
+        TextureFile* file = &files[opened];
+        if (!texture_file_open(file, paths[opened]))
+        {
+            ok = false;
+            break;
+        }
+        internal_formats[opened] = texture_internal_format(file->format, file->srgb);
+        if (!internal_formats[opened])
+        {
+            fprintf(stderr, "material: %s: the driver can't sample %s%s\n", paths[opened],
+                texture_format_info(file->format)->name, file->srgb ? " sRGB" : "");
+            ok = false;
+        }
+        else if (ms->mode == MATERIAL_MODE_ARRAYS && !assign_array(ms, &ms->materials[opened], file))
+        {
+            fprintf(stderr, "material: %s: %ux%u %s needs a texture array of its own, and all %d are taken\n", paths[opened],
+                file->width, file->height, texture_format_info(file->format)->name, MATERIAL_MAX_ARRAYS);
+            ok = false;
+        }
+        ++opened;
+    }
+
+    if (ok && ms->mode == MATERIAL_MODE_ARRAYS)
+    {
+        uint32_t entries[MATERIAL_MAX][4];      // the block's uvec4 per material: array, layer
+        memset(entries, 0, sizeof(entries));
+        for (int a = 0; a < ms->array_count; ++a)
+        {
+            int first = 0;
+            while (ms->materials[first].array != a)
+                ++first;
+            create_array(&ms->arrays[a], internal_formats[first], MATERIAL_TEXTURE_UNIT + a);
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            const Material* m = &ms->materials[i];
+            gl_state_bind_texture(MATERIAL_TEXTURE_UNIT + m->array, GL_TEXTURE_2D_ARRAY, ms->arrays[m->array].texture);
+            upload_layer(&files[i], internal_formats[i], m->layer);
+            entries[i][0] = (uint32_t)m->array;
+            entries[i][1] = (uint32_t)m->layer;
+        }
+        glGenBuffers(1, &ms->buffer);
+        gl_state_bind_buffer(GL_UNIFORM_BUFFER, ms->buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(entries), entries, GL_STATIC_DRAW);   // the whole declared block
+        gl_debug_label(GL_BUFFER, ms->buffer, "materials");
+        gl_memory_buffer(ms->buffer, GPU_MEMORY_UNIFORMS, sizeof(entries));
+    }
+    else if (ok)
+    {
+        // A complete texture per material, its sampling state set before the handle freezes it
+        GLuint64 handles[MATERIAL_MAX];
+        for (int i = 0; i < count; ++i)
+        {
+            Material* m = &ms->materials[i];
+            m->texture = texture_create(&files[i], internal_formats[i], 0, GPU_MEMORY_TEXTURES);
+            for (int l = 0; l < files[i].level_count; ++l)
+                texture_upload_level(m->texture, &files[i], internal_formats[i], 0, l);
+            m->handle = handles[i] = gl_ext.GetTextureHandleARB(m->texture);
+        }
+        glGenBuffers(1, &ms->buffer);
+        gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, ms->buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint64) * count, handles, GL_STATIC_DRAW);
+        gl_memory_buffer(ms->buffer, GPU_MEMORY_STORAGE, sizeof(GLuint64) * count);
+        gl_debug_label(GL_BUFFER, ms->buffer, "materials");
+        gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    for (int i = 0; i < opened; ++i)
+    {
+        for (int l = 0; ok && l < files[i].level_count; ++l)
+            ms->texture_bytes += files[i].levels[l].size;
+        texture_file_close(&files[i]);  // uploaded: the mapping isn't needed any more
+    }
+    free(files);
+    if (!ok)
+    {
+        memset(ms, 0, sizeof(*ms));     // nothing was created: creation only starts once every file checked out
+        return false;
+    }
+    ms->count = count;
+    material_set_make_resident(ms, true);
+    return true;
+}
+
+void material_set_destroy(MaterialSet* ms)
+{
+    material_set_make_resident(ms, false);
+    for (int i = 0; i < ms->count; ++i)
+        gl_resources_retire(ms->resources, GL_RESOURCE_TEXTURE, ms->materials[i].texture);
+    for (int a = 0; a < ms->array_count; ++a)
+        gl_resources_retire(ms->resources, GL_RESOURCE_TEXTURE, ms->arrays[a].texture);
+    gl_resources_retire(ms->resources, GL_RESOURCE_BUFFER, ms->buffer);
+    ms->count = ms->array_count = 0;
+    ms->buffer = 0;
+}
+
+void material_set_bind_program(const MaterialSet* ms, GLuint program)
+{
+    if (ms->mode != MATERIAL_MODE_ARRAYS)
+        return;     // the storage block's binding is in the GLSL
+    GLint units[MATERIAL_MAX_ARRAYS];
+    for (int a = 0; a < MATERIAL_MAX_ARRAYS; ++a)
+        units[a] = MATERIAL_TEXTURE_UNIT + a;
+    gl_state_use_program(program);
+    glUniform1iv(glGetUniformLocation(program, "materialArrays"), MATERIAL_MAX_ARRAYS, units);
+    const GLuint block = glGetUniformBlockIndex(program, "Materials");
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, block, MATERIAL_BINDING);
+}
+
+void material_set_make_resident(const MaterialSet* ms, bool resident)
+{
+    if (ms->mode != MATERIAL_MODE_BINDLESS)
+        return;
+    for (int i = 0; i < ms->count; ++i)
+    {
+        if (resident)
+            gl_ext.MakeTextureHandleResidentARB(ms->materials[i].handle);
+        else
+            gl_ext.MakeTextureHandleNonResidentARB(ms->materials[i].handle);
+    }
+}
+
+void material_set_bind(const MaterialSet* ms)
+{
+    if (ms->mode == MATERIAL_MODE_BINDLESS)
+    {
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, MATERIAL_BINDING, ms->buffer);
+        return;
+    }
+    for (int a = 0; a < ms->array_count; ++a)
+        gl_state_bind_texture(MATERIAL_TEXTURE_UNIT + a, GL_TEXTURE_2D_ARRAY, ms->arrays[a].texture);
+    gl_state_bind_buffer_base(GL_UNIFORM_BUFFER, MATERIAL_BINDING, ms->buffer);
+}
+
+void material_set_print(const MaterialSet* ms, FILE* out)
+{
+    if (ms->mode == MATERIAL_MODE_BINDLESS)
+        fprintf(out, "materials: %d, bindless handles in a storage buffer, %.2f MB of textures\n", ms->count,
+            ms->texture_bytes / 1048576.0);
+    else
+        fprintf(out, "materials: %d in %d texture array%s, %.2f MB of textures\n", ms->count, ms->array_count,
+            ms->array_count == 1 ? "" : "s", ms->texture_bytes / 1048576.0);
+    for (int a = 0; ms->mode == MATERIAL_MODE_ARRAYS && a < ms->array_count; ++a)
+    {
+        const MaterialArray* array = &ms->arrays[a];
+        fprintf(out, "  array %d: %d x %ux%u %s%s, %d levels\n", a, array->layer_count, array->width, array->height,
+            texture_format_info(array->format)->name, array->srgb ? " sRGB" : "", array->level_count);
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "asset/texture_file.h"
+#include "gl/gl_resources.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Materials that don't break batches: each instance carries a material index
+// (a per-instance vertex attribute), and one draw covers objects with any
+// mix of materials. Changing materials never means a glBindTexture.
+//
+// Two ways to reach the textures from the shader:
+//   arrays:   the default. Textures with the same format, size and mip chain
+//             share a GL_TEXTURE_2D_ARRAY, one layer each. A uniform block
+//             maps each material to its array and layer. Up to
+//             MATERIAL_MAX_ARRAYS arrays are bound for the whole frame.
+//   bindless: GL_ARB_bindless_texture on a 4.3 context. Every texture stays
+//             a texture of its own, and its resident handle sits in a shader
+//             storage buffer indexed by the material. This also needs
+//             GL_NV_gpu_shader5: the handle differs between the instances of
+//             one draw, and plain ARB_bindless_texture leaves a handle that
+//             isn't dynamically uniform undefined.
+//
+// Material textures are uploaded whole, every level, when the set is built.
+// Unlike gl/texture_streamer.h nothing is streamed or evicted: an array
+// layer can't own a mip range of its own, and bindless handles are fixed
+// for their texture's lifetime.
+
+#define MATERIAL_MAX 64             // as sized in MATERIAL_ARRAYS_GLSL
+#define MATERIAL_MAX_ARRAYS 4       // texture arrays the shader can choose from, as in MATERIAL_ARRAYS_GLSL
+#define MATERIAL_TEXTURE_UNIT 1     // arrays: bound to units 1 .. MATERIAL_MAX_ARRAYS
+#define MATERIAL_BINDING 5          // the Materials block's binding point (uniform or shader storage), as in the GLSL
+
+typedef enum MaterialMode
+{
+    MATERIAL_MODE_ARRAYS,
+    MATERIAL_MODE_BINDLESS
+} MaterialMode;
+
+typedef struct MaterialArray
+{
+    GLuint texture;             // GL_TEXTURE_2D_ARRAY, one layer per material
+    TextureFormat format;
+    bool srgb;
+    uint32_t width;
+    uint32_t height;
+    int level_count;
+    int layer_count;
+} MaterialArray;
+
+typedef struct Material
+{
+    int array;                  // arrays: which one holds it, and the layer
+    int layer;
+    GLuint texture;             // bindless: its own texture, and the handle the shader samples it through
+    GLuint64 handle;
+} Material;
+
+typedef struct MaterialSet
+{
+    GLResources* resources;
+    MaterialMode mode;
+    int count;
+    Material materials[MATERIAL_MAX];
+    int array_count;
+    MaterialArray arrays[MATERIAL_MAX_ARRAYS];
+    GLuint buffer;              // the Materials block: (array, layer) per material, or its handle
+    uint64_t texture_bytes;     // uploaded texel blocks, every level
+} MaterialSet;
+
+// GLSL for each mode, pasted into a fragment shader after its #version line (330 for arrays; 430 and
+// GL_ARB_bindless_texture for bindless). Both define vec4 materialSample(uint material, vec2 uv). The arrays
+// version picks its array in a switch, with the gradients taken before it: the material is flat per
+// instance, but a 2x2 quad can straddle two instances.
+#define MATERIAL_ARRAYS_GLSL \
+    "layout(std140) uniform Materials\n" \
+    "{\n" \
+    "    uvec4 materials[64];\n" \
+    "};\n" \
+    "uniform sampler2DArray materialArrays[4];\n" \
+    "vec4 materialSample(uint material, vec2 uv)\n" \
+    "{\n" \
+    "    uvec4 m = materials[material];\n" \
+    "    vec3 p = vec3(uv, float(m.y));\n" \
+    "    vec2 dx = dFdx(uv), dy = dFdy(uv);\n" \
+    "    switch (m.x)\n" \
+    "    {\n" \
+    "    case 1u: return textureGrad(materialArrays[1], p, dx, dy);\n" \
+    "    case 2u: return textureGrad(materialArrays[2], p, dx, dy);\n" \
+    "    case 3u: return textureGrad(materialArrays[3], p, dx, dy);\n" \
+    "    default: return textureGrad(materialArrays[0], p, dx, dy);\n" \
+    "    }\n" \
+    "}\n"
+
+#define MATERIAL_BINDLESS_GLSL \
+    "layout(std430, binding = 5) readonly buffer Materials\n" \
+    "{\n" \
+    "    uvec2 handles[];\n" \
+    "};\n" \
+    "vec4 materialSample(uint material, vec2 uv)\n" \
+    "{\n" \
+    "    return texture(sampler2D(handles[material]), uv);\n" \
+    "}\n"
+
+// True when this context can use MATERIAL_MODE_BINDLESS
+bool material_bindless_supported(void);
+
+// Loads "paths" (DDS / KTX2) as materials 0 .. count-1 and uploads them, bindless when "bindless" and supported,
+// arrays otherwise. All or nothing: logs and returns false, with nothing left allocated, if any file can't be
+// used, or the files need more than MATERIAL_MAX_ARRAYS arrays.
+bool material_set_init(MaterialSet* ms, GLResources* resources, const char* const* paths, int count, bool bindless);
+
+// Retires the textures and the block's buffer. Bindless: every other context that made the handles resident
+// must have made them non-resident first.
+void material_set_destroy(MaterialSet* ms);
+
+// Once per program, after linking: the sampler units and the block binding (arrays; bindless needs nothing)
+void material_set_bind_program(const MaterialSet* ms, GLuint program);
+
+// Bindless: makes the handles resident in (or releases them from) the current context. Residency is per context,
+// so a context sharing the textures calls this too. material_set_init does it for the context it runs in.
+void material_set_make_resident(const MaterialSet* ms, bool resident);
+
+// Binds the arrays and the Materials block in the current context, before the draws that use them
+void material_set_bind(const MaterialSet* ms);
+
+// Mode, arrays and bytes uploaded
+void material_set_print(const MaterialSet* ms, FILE* out);
@@ -0,0 +1,124 @@
+#include "gl/mesh.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void gpu_mesh_init_raw(GpuMesh* mesh, const void* vertices, size_t vertex_bytes, size_t vertex_count,
+    const void* indices, GLenum index_type, size_t index_count)
+{
+    memset(mesh, 0, sizeof(*mesh));
+    mesh->vertex_count = (GLsizei)vertex_count;
+    mesh->index_count = (GLsizei)index_count;
+    mesh->index_type = index_type;
+    mesh->lod_count = 1;
+    mesh->lods[0].index_count = (GLsizei)index_count;
+    const size_t index_size = index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    mesh->vertex_buffer = gl_dsa_create_buffer((GLsizeiptr)vertex_bytes, vertices, GL_STATIC_DRAW);
+    gl_memory_buffer(mesh->vertex_buffer, GPU_MEMORY_GEOMETRY, vertex_bytes);
+    gl_debug_label(GL_BUFFER, mesh->vertex_buffer, "mesh vertices");
+
+    mesh->index_buffer = gl_dsa_create_buffer((GLsizeiptr)(index_size * index_count), indices, GL_STATIC_DRAW);
+    gl_memory_buffer(mesh->index_buffer, GPU_MEMORY_GEOMETRY, index_size * index_count);
+    gl_debug_label(GL_BUFFER, mesh->index_buffer, "mesh indices");
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_buffer);  // into the bound VAO
+}
+
+bool gpu_mesh_init(GpuMesh* mesh, const void* vertices, size_t vertex_size, size_t vertex_count,
+    const uint32_t* indices, size_t index_count)
+{
+    if (vertex_count > 65536)
+    {
+        gpu_mesh_init_raw(mesh, vertices, vertex_size * vertex_count, vertex_count, indices, GL_UNSIGNED_INT,
+            index_count);
+        return true;
+    }
+
+    uint16_t* narrow = (uint16_t*)malloc(sizeof(uint16_t) * index_count);
+    if (!narrow)
+    {
+        fprintf(stderr, "mesh: out of memory for %zu indices\n", index_count);
+        memset(mesh, 0, sizeof(*mesh));
+        return false;
+    }
+    for (size_t i = 0; i < index_count; ++i)
+        narrow[i] = (uint16_t)indices[i];
+    gpu_mesh_init_raw(mesh, vertices, vertex_size * vertex_count, vertex_count, narrow, GL_UNSIGNED_SHORT,
+        index_count);
+    free(narrow);
+    return true;
+}
+
+void gpu_mesh_destroy(GpuMesh* mesh)
+{
+    gl_state_delete_buffers(1, &mesh->vertex_buffer);
+    gl_state_delete_buffers(1, &mesh->index_buffer);
+    memset(mesh, 0, sizeof(*mesh));
+}
+
+void gpu_mesh_set_lods(GpuMesh* mesh, const GpuMeshLod* lods, int lod_count)
+{
+    mesh->lod_count = lod_count;
+    memcpy(mesh->lods, lods, sizeof(GpuMeshLod) * lod_count);
+    mesh->index_count = lods[0].index_count;
+}
+
+void gpu_mesh_draw(const GpuMesh* mesh)
+{
+    gpu_mesh_draw_lod(mesh, 0);
+}
+
+void gpu_mesh_draw_instanced(const GpuMesh* mesh, GLsizei instance_count)
+{
+    gpu_mesh_draw_lod_instanced(mesh, 0, instance_count);
+}
+
+const GpuMeshLod* gpu_mesh_lod(const GpuMesh* mesh, int lod)
+{
+    lod = lod < mesh->first_lod ? mesh->first_lod : lod;
+    return &mesh->lods[lod < mesh->lod_count ? lod : mesh->lod_count - 1];
+}
+
+void gpu_mesh_set_first_lod(GpuMesh* mesh, int first, const void* all_indices)
+{
+    const size_t index_size = mesh->index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    const GpuMeshLod* last = &mesh->lods[mesh->lod_count - 1];
+    mesh->first_lod = first;
+    mesh->index_base = mesh->lods[first].first_index;
+    const size_t count = last->first_index + last->index_count - mesh->index_base;
+    // By name (or through the copy-write target), leaving the bound VAO's element binding alone
+    gl_dsa_buffer_data(mesh->index_buffer, (GLsizeiptr)(index_size * count),
+        (const char*)all_indices + index_size * mesh->index_base, GL_STATIC_DRAW);
+    gl_memory_buffer(mesh->index_buffer, GPU_MEMORY_GEOMETRY, index_size * count);
+}
+
+static const GpuMeshLod* lod_range(const GpuMesh* mesh, int lod, const void** offset)
+{
+    const GpuMeshLod* range = gpu_mesh_lod(mesh, lod);
+    const size_t index_size = mesh->index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    *offset = (const void*)((range->first_index - mesh->index_base) * index_size);
+    return range;
+}
+
+void gpu_mesh_draw_lod(const GpuMesh* mesh, int lod)
+{
+    const void* offset;
+    const GpuMeshLod* range = lod_range(mesh, lod, &offset);
+    glDrawElements(GL_TRIANGLES, range->index_count, mesh->index_type, offset);
+    draw_counters_draw(GL_TRIANGLES, range->index_count, 1);
+}
+
+void gpu_mesh_draw_lod_instanced(const GpuMesh* mesh, int lod, GLsizei instance_count)
+{
+    const void* offset;
+    const GpuMeshLod* range = lod_range(mesh, lod, &offset);
+    glDrawElementsInstanced(GL_TRIANGLES, range->index_count, mesh->index_type, offset, instance_count);
+    draw_counters_draw(GL_TRIANGLES, range->index_count, instance_count);
+}
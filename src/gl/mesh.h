@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Indexed geometry in GL buffers: vertices in a GL_ARRAY_BUFFER, indices in a
+// GL_ELEMENT_ARRAY_BUFFER. Indices are stored as GL_UNSIGNED_SHORT whenever
+// every vertex fits in 16 bits, halving index bandwidth.
+//
+// The element buffer binding is VAO state: gpu_mesh_init binds it to whatever
+// vertex array is bound, so call it with the mesh's VAO bound (and set the
+// attribute pointers against vertex_buffer afterwards).
+//
+// A mesh can hold levels of detail: ranges of its index buffer over the same
+// vertices, finest first. Without any it's a single level, the whole buffer.
+//
+// The finest levels can be dropped from video memory under a budget
+// (core/gpu_memory.h): gpu_mesh_set_first_lod respecifies the index buffer
+// with only the levels from "first" on, which needs the levels laid out in
+// order, each after the one before it. Draws of a dropped level draw the
+// finest one still there.
+
+#define GPU_MESH_MAX_LODS 8
+
+typedef struct GpuMeshLod
+{
+    GLuint first_index;
+    GLsizei index_count;
+    float error;                // how far from level 0's surface, in model units
+} GpuMeshLod;
+
+typedef struct GpuMesh
+{
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    GLsizei vertex_count;
+    GLsizei index_count;        // level 0's, which is what the plain draws (and GPU culling) use
+    GLenum index_type;          // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    int lod_count;
+    GpuMeshLod lods[GPU_MESH_MAX_LODS];
+    int first_lod;              // finest level in the index buffer
+    GLuint index_base;          // its first_index: where the buffer starts
+} GpuMesh;
+
+bool gpu_mesh_init(GpuMesh* mesh, const void* vertices, size_t vertex_size, size_t vertex_count,
+    const uint32_t* indices, size_t index_count);
+
+// Uploads vertices and indices already in their final formats ("index_type" GL_UNSIGNED_SHORT or
+// GL_UNSIGNED_INT), e.g. straight out of a mapped mesh file: no conversion, no staging copy. "vertex_bytes" is all
+// the vertex data, both streams of a mesh stored split (asset/mesh_file.h).
+void gpu_mesh_init_raw(GpuMesh* mesh, const void* vertices, size_t vertex_bytes, size_t vertex_count,
+    const void* indices, GLenum index_type, size_t index_count);
+void gpu_mesh_destroy(GpuMesh* mesh);
+
+// Replaces the single level the init functions set with "lod_count" (1 to GPU_MESH_MAX_LODS) of them, level 0
+// starting the index buffer.
+void gpu_mesh_set_lods(GpuMesh* mesh, const GpuMeshLod* lods, int lod_count);
+
+// The range drawn for level "lod": the coarsest there is when the mesh has fewer levels, the finest resident
+// when it's been dropped
+const GpuMeshLod* gpu_mesh_lod(const GpuMesh* mesh, int lod);
+
+// Keeps only levels [first, lod_count) in the index buffer, from "all_indices" (every level's, in index_type, as
+// first uploaded). Same buffer name, so VAOs and the resource registry keep pointing at it.
+void gpu_mesh_set_first_lod(GpuMesh* mesh, int first, const void* all_indices);
+
+// glDrawElements / glDrawElementsInstanced over level 0, or the finest resident (VAO bound by the caller)
+void gpu_mesh_draw(const GpuMesh* mesh);
+void gpu_mesh_draw_instanced(const GpuMesh* mesh, GLsizei instance_count);
+
+// The same over gpu_mesh_lod's range for "lod"
+void gpu_mesh_draw_lod(const GpuMesh* mesh, int lod);
+void gpu_mesh_draw_lod_instanced(const GpuMesh* mesh, int lod, GLsizei instance_count);
@@ -0,0 +1,168 @@
+#include "gl/mesh_heap.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static size_t index_size(GLenum index_type)
+{
+    return index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+bool mesh_heap_init(MeshHeap* heap, size_t vertex_size, GLenum index_type, uint32_t vertex_capacity,
+    uint32_t index_capacity, uint32_t max_meshes)
+{
+    memset(heap, 0, sizeof(*heap));
+    if (!buffer_heap_init(&heap->vertices, vertex_capacity, max_meshes))
+        return false;
+    if (!buffer_heap_init(&heap->indices, index_capacity, max_meshes))
+    {
+        buffer_heap_destroy(&heap->vertices);
+        return false;
+    }
+    heap->vertex_size = vertex_size;
+    heap->index_type = index_type;
+
+    // Fixed in size, written piece by piece; gl_dsa leaves the bound VAO's element binding as it is
+    heap->vertex_buffer = gl_dsa_create_buffer_storage((GLsizeiptr)(vertex_size * vertex_capacity), NULL,
+        GL_DYNAMIC_STORAGE_BIT);
+    gl_memory_buffer(heap->vertex_buffer, GPU_MEMORY_GEOMETRY, vertex_size * vertex_capacity);
+    gl_debug_label(GL_BUFFER, heap->vertex_buffer, "mesh heap vertices");
+
+    heap->index_buffer = gl_dsa_create_buffer_storage((GLsizeiptr)(index_size(index_type) * index_capacity), NULL,
+        GL_DYNAMIC_STORAGE_BIT);
+    gl_memory_buffer(heap->index_buffer, GPU_MEMORY_GEOMETRY, index_size(index_type) * index_capacity);
+    gl_debug_label(GL_BUFFER, heap->index_buffer, "mesh heap indices");
+    return true;
+}
+
+void mesh_heap_destroy(MeshHeap* heap)
+{
+    gl_state_delete_buffers(1, &heap->vertex_buffer);
+    gl_state_delete_buffers(1, &heap->index_buffer);
+    buffer_heap_destroy(&heap->vertices);
+    buffer_heap_destroy(&heap->indices);
+    memset(heap, 0, sizeof(*heap));
+}
+
+bool mesh_heap_add_raw(MeshHeap* heap, HeapMesh* mesh, const void* vertices, size_t vertex_count,
+    const void* indices, size_t index_count)
+{
+    mesh->vertex_range = mesh->index_range = BUFFER_HEAP_NONE;
+    if (heap->index_type == GL_UNSIGNED_SHORT && vertex_count > 65536)
+        return false;
+    if (vertex_count > 0xFFFFFFFFu || index_count > 0xFFFFFFFFu)
+        return false;
+    uint32_t base_vertex, first_index;
+    const uint32_t vertex_range = buffer_heap_alloc(&heap->vertices, (uint32_t)vertex_count, &base_vertex);
+    if (vertex_range == BUFFER_HEAP_NONE)
+        return false;
+    const uint32_t index_range = buffer_heap_alloc(&heap->indices, (uint32_t)index_count, &first_index);
+    if (index_range == BUFFER_HEAP_NONE)
+    {
+        buffer_heap_free(&heap->vertices, vertex_range);
+        return false;
+    }
+
+    const size_t isize = index_size(heap->index_type);
+    gl_dsa_buffer_sub_data(heap->vertex_buffer, (GLintptr)(heap->vertex_size * base_vertex),
+        (GLsizeiptr)(heap->vertex_size * vertex_count), vertices);
+    gl_dsa_buffer_sub_data(heap->index_buffer, (GLintptr)(isize * first_index), (GLsizeiptr)(isize * index_count), indices);
+
+    mesh->vertex_range = vertex_range;
+    mesh->index_range = index_range;
+    mesh->vertex_count = (GLsizei)vertex_count;
+    mesh->index_count = (GLsizei)index_count;
+    return true;
+}
+
+bool mesh_heap_add(MeshHeap* heap, HeapMesh* mesh, const void* vertices, size_t vertex_count,
+    const uint32_t* indices, size_t index_count)
+{
+    if (heap->index_type == GL_UNSIGNED_INT)
+        return mesh_heap_add_raw(heap, mesh, vertices, vertex_count, indices, index_count);
+
+    uint16_t* narrow = (uint16_t*)malloc(sizeof(uint16_t) * (index_count ? index_count : 1));
+    if (!narrow)
+    {
+        fprintf(stderr, "mesh_heap: out of memory for %zu indices\n", index_count);
+        mesh->vertex_range = mesh->index_range = BUFFER_HEAP_NONE;
+        return false;
+    }
+    for (size_t i = 0; i < index_count; ++i)
+        narrow[i] = (uint16_t)indices[i];
+    const bool ok = mesh_heap_add_raw(heap, mesh, vertices, vertex_count, narrow, index_count);
+    free(narrow);
+    return ok;
+}
+
+void mesh_heap_remove(MeshHeap* heap, HeapMesh* mesh)
+{
+    if (mesh->vertex_range != BUFFER_HEAP_NONE)
+        buffer_heap_free(&heap->vertices, mesh->vertex_range);
+    if (mesh->index_range != BUFFER_HEAP_NONE)
+        buffer_heap_free(&heap->indices, mesh->index_range);
+    memset(mesh, 0, sizeof(*mesh));
+    mesh->vertex_range = mesh->index_range = BUFFER_HEAP_NONE;
+}
+
+DrawElementsIndirectCommand mesh_heap_command(const MeshHeap* heap, const HeapMesh* mesh, GLuint instance_count,
+    GLuint base_instance)
+{
+    DrawElementsIndirectCommand command;
+    command.count = (GLuint)mesh->index_count;
+    command.instance_count = instance_count;
+    command.first_index = buffer_heap_offset(&heap->indices, mesh->index_range);
+    command.base_vertex = (GLint)buffer_heap_offset(&heap->vertices, mesh->vertex_range);
+    command.base_instance = base_instance;
+    return command;
+}
+
+void mesh_heap_draw(const MeshHeap* heap, const HeapMesh* mesh, GLsizei instance_count)
+{
+    const size_t first_index = buffer_heap_offset(&heap->indices, mesh->index_range);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh->index_count, heap->index_type,
+        (const void*)(index_size(heap->index_type) * first_index), instance_count,
+        (GLint)buffer_heap_offset(&heap->vertices, mesh->vertex_range));
+    draw_counters_draw(GL_TRIANGLES, mesh->index_count, instance_count);
+}
+
+// One buffer's share of mesh_heap_defrag: "unit" bytes to a heap unit
+static uint32_t defrag_buffer(BufferHeap* range, bool* under_way, GLuint buffer, size_t unit, size_t max_bytes)
+{
+    *under_way = *under_way || buffer_heap_fragmentation(range) > MESH_HEAP_DEFRAG_START;
+    if (!*under_way)
+        return 0;
+    BufferHeapMove moves[MESH_HEAP_DEFRAG_MOVES];
+    const size_t units = max_bytes / unit;
+    const uint32_t n = buffer_heap_defrag(range, units < 0xFFFFFFFFu ? (uint32_t)units : 0xFFFFFFFFu, moves,
+        MESH_HEAP_DEFRAG_MOVES);
+    *under_way = n > 0;
+    if (!n)
+        return 0;
+    // In order: a later move can land where an earlier one left. Source and destination never overlap.
+    gl_state_bind_buffer(GL_COPY_READ_BUFFER, buffer);
+    gl_state_bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+    for (uint32_t m = 0; m < n; ++m)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)(unit * moves[m].from),
+            (GLintptr)(unit * moves[m].to), (GLsizeiptr)(unit * moves[m].size));
+    return n;
+}
+
+uint32_t mesh_heap_defrag(MeshHeap* heap, size_t max_bytes)
+{
+    return defrag_buffer(&heap->vertices, &heap->defrag_vertices, heap->vertex_buffer, heap->vertex_size, max_bytes)
+        + defrag_buffer(&heap->indices, &heap->defrag_indices, heap->index_buffer, index_size(heap->index_type),
+            max_bytes);
+}
+
+void mesh_heap_print(const MeshHeap* heap, FILE* out)
+{
+    buffer_heap_print(&heap->vertices, "mesh heap vertices", out);
+    buffer_heap_print(&heap->indices, "mesh heap indices", out);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/buffer_heap.h"
+#include "gl/gpu_culling.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Many meshes in one vertex buffer and one index buffer, instead of a pair of
+// buffer objects each (gl/mesh.h). Both buffers are allocated once at their
+// full size and carved up by a BufferHeap (core/buffer_heap.h) each, in
+// vertices and in indices, so a mesh is a vertex range and an index range.
+//
+// Its indices stay relative to its own vertices: draws pass the vertex
+// range's start as baseVertex and the index range's as firstIndex. Every mesh
+// of a heap then draws from the same vertex array with no rebinding (one
+// vertex_format_attach over vertex_buffer sets it up), and a
+// DrawElementsIndirectCommand can name any of them, so a whole set goes to a
+// single glMultiDrawElementsIndirect.
+//
+// All of a heap's meshes share its vertex layout (one stride) and index type.
+// With GL_UNSIGNED_SHORT a mesh can have at most 65536 vertices, however
+// large the heap. Adding and removing are constant time; a mesh's data is
+// written with glBufferSubData, so a range freed while earlier draws still
+// read it is safe to reuse at once.
+//
+// A heap that streams meshes in and out for weeks ends with its free space
+// in gaps too small for the next mesh. mesh_heap_defrag, called between
+// frames, gathers it again a budget of bytes at a time: buffer_heap_defrag
+// picks the moves and each is a glCopyBufferSubData within its buffer,
+// queued behind the draws that read the old place. It starts once
+// MESH_HEAP_DEFRAG_START of a buffer's free space is outside its largest
+// piece and carries on until the free space is one piece. A HeapMesh holds
+// its ranges' handles, which a move keeps, and mesh_heap_command and
+// mesh_heap_draw read the ranges' offsets through them, so no mesh needs
+// patching; only commands made before a call that moved something are
+// stale.
+
+#define MESH_HEAP_DEFRAG_START 0.25f  // of a buffer's free space outside its largest piece
+#define MESH_HEAP_DEFRAG_MOVES 64     // per buffer, a mesh_heap_defrag call
+
+typedef struct MeshHeap
+{
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    size_t vertex_size;
+    GLenum index_type;          // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    BufferHeap vertices;
+    BufferHeap indices;
+    bool defrag_vertices;       // mesh_heap_defrag has a compaction of the buffer under way
+    bool defrag_indices;
+} MeshHeap;
+
+typedef struct HeapMesh
+{
+    uint32_t vertex_range;      // the heaps' handles, BUFFER_HEAP_NONE when not added; they outlive moves
+    uint32_t index_range;
+    GLsizei vertex_count;
+    GLsizei index_count;
+} HeapMesh;
+
+// Needs a current context. Room for "vertex_capacity" vertices of "vertex_size" bytes, "index_capacity" indices of
+// "index_type" and "max_meshes" meshes; logs and returns false when out of memory.
+bool mesh_heap_init(MeshHeap* heap, size_t vertex_size, GLenum index_type, uint32_t vertex_capacity,
+    uint32_t index_capacity, uint32_t max_meshes);
+void mesh_heap_destroy(MeshHeap* heap);
+
+// Copies a mesh in, its indices narrowed to the heap's type. False (and "mesh" not added) when either buffer has no
+// range left that fits, or the mesh has too many vertices for 16-bit indices.
+bool mesh_heap_add(MeshHeap* heap, HeapMesh* mesh, const void* vertices, size_t vertex_count,
+    const uint32_t* indices, size_t index_count);
+// The same with indices already in the heap's type, e.g. straight out of a mapped mesh file
+bool mesh_heap_add_raw(MeshHeap* heap, HeapMesh* mesh, const void* vertices, size_t vertex_count,
+    const void* indices, size_t index_count);
+void mesh_heap_remove(MeshHeap* heap, HeapMesh* mesh);
+
+// The draw of "mesh", for glMultiDrawElementsIndirect out of the heap's buffers, its ranges where they are now
+DrawElementsIndirectCommand mesh_heap_command(const MeshHeap* heap, const HeapMesh* mesh, GLuint instance_count,
+    GLuint base_instance);
+
+// glDrawElementsInstancedBaseVertex of "mesh" (a vertex array over the heap's buffers bound by the caller)
+void mesh_heap_draw(const MeshHeap* heap, const HeapMesh* mesh, GLsizei instance_count);
+
+// Between frames: copies up to "max_bytes" of meshes' data to lower places in each buffer that needs compacting.
+// Returns how many ranges moved; when any did, indirect commands made from the heap before are out of date.
+uint32_t mesh_heap_defrag(MeshHeap* heap, size_t max_bytes);
+
+// Both heaps' use, fragmentation and the moves made to undo it
+void mesh_heap_print(const MeshHeap* heap, FILE* out);
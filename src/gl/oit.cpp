@@ -0,0 +1,261 @@
+#include "gl/oit.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// A triangle over the whole viewport
+static const char* resolve_vertex_shader_text =
+"#version 430\n"
+"out gl_PerVertex { vec4 gl_Position; };\n"
+"void main()\n"
+"{\n"
+"    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+"    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+// Weighted: the weighted average colour, covering 1 - (the product of 1 - alpha) of what's behind
+// (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA). Pixels nothing translucent reached are discarded.
+static const char* weighted_fragment_shader_text =
+"#version 430\n"
+"layout(binding = 0) uniform sampler2D accumulation;\n"
+"layout(binding = 1) uniform sampler2D revealage;\n"
+"layout(location = 0) out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+"    float reveal = texelFetch(revealage, pixel, 0).r;\n"
+"    if (reveal <= 0.0)\n"
+"        discard;\n"
+"    vec4 accum = texelFetch(accumulation, pixel, 0);\n"
+"    fragment = vec4(accum.rgb / max(accum.a, 1e-5), 1.0 - exp(-reveal));\n"
+"}\n";
+
+// Lists: the pixel's nodes, nearest kept when there are too many, sorted far to near (the colour breaks depth
+// ties, so the result doesn't depend on the order they were appended in) and blended in that order. Out
+// premultiplied, with the transmittance left in alpha (GL_ONE, GL_ONE_MINUS_SRC_ALPHA).
+static const char* list_fragment_shader_text =
+"#version 430\n"
+"const int MAX_DEPTH = 32;\n"               // OIT_LIST_MAX_DEPTH
+"layout(std140, binding = 6) uniform OitParams { uvec4 oitParams; };\n"
+"layout(std430, binding = 9) readonly buffer OitNodes { uint oitNodeCount; uint oitNodeCapacity; uint oitNodes[]; };\n"
+"layout(std430, binding = 10) readonly buffer OitHeads { uint oitHeads[]; };\n"
+"layout(location = 0) out vec4 fragment;\n"
+"bool farther(uvec2 a, uvec2 b)\n"
+"{\n"
+"    return uintBitsToFloat(a.y) > uintBitsToFloat(b.y) || (a.y == b.y && a.x > b.x);\n"
+"}\n"
+"void main()\n"
+"{\n"
+"    uvec2 layers[MAX_DEPTH];\n"     // colour, depth
+"    int count = 0;\n"
+"    uint node = oitHeads[uint(gl_FragCoord.y) * oitParams.x + uint(gl_FragCoord.x)];\n"
+"    while (node != 0xFFFFFFFFu && node < oitNodeCapacity)\n"
+"    {\n"
+"        uvec2 layer = uvec2(oitNodes[3u * node], oitNodes[3u * node + 1u]);\n"
+"        node = oitNodes[3u * node + 2u];\n"
+"        if (count == MAX_DEPTH)\n"
+"        {\n"
+"            if (!farther(layers[0], layer))\n"   // full: it replaces the farthest, if it's nearer
+"                continue;\n"
+"            layers[0] = layer;\n"
+"            for (int i = 1; i < count && farther(layers[i], layers[i - 1]); ++i)\n"
+"            {\n"
+"                uvec2 t = layers[i]; layers[i] = layers[i - 1]; layers[i - 1] = t;\n"
+"            }\n"
+"            continue;\n"
+"        }\n"
+"        int i = count++;\n"
+"        for (; i > 0 && farther(layer, layers[i - 1]); --i)\n"
+"            layers[i] = layers[i - 1];\n"
+"        layers[i] = layer;\n"
+"    }\n"
+"    if (count == 0)\n"
+"        discard;\n"
+"    vec3 colour = vec3(0.0);\n"           // premultiplied
+"    float transmittance = 1.0;\n"
+"    for (int i = 0; i < count; ++i)\n"
+"    {\n"
+"        vec4 c = unpackUnorm4x8(layers[i].x);\n"
+"        colour = c.rgb * c.a + colour * (1.0 - c.a);\n"
+"        transmittance *= 1.0 - c.a;\n"
+"    }\n"
+"    fragment = vec4(colour, 1.0 - transmittance);\n"
+"}\n";
+
+bool oit_supported(OitMode mode)
+{
+    if (!GLAD_GL_VERSION_4_3)
+        return false;
+    if (mode != OIT_LIST)
+        return true;
+    GLint bindings = 0, fragment_blocks = 0;
+    glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &bindings);     // 8 promised: binding 10 is the eleventh
+    glGetIntegerv(GL_MAX_FRAGMENT_SHADER_STORAGE_BLOCKS, &fragment_blocks);
+    return bindings > OIT_LIST_HEADS_BINDING && fragment_blocks >= 2;
+}
+
+bool oit_init(Oit* o, OitMode mode, bool reversed_z)
+{
+    memset(o, 0, sizeof(*o));
+    o->mode = mode;
+    o->reversed_z = reversed_z;
+    o->resolve_program = program_build(resolve_vertex_shader_text,
+        mode == OIT_LIST ? list_fragment_shader_text : weighted_fragment_shader_text, false);
+    if (!o->resolve_program)
+    {
+        fprintf(stderr, "oit: can't build the %s resolve program\n", mode == OIT_LIST ? "list" : "weighted");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, o->resolve_program, "oit resolve");
+    o->params_buffer = gl_dsa_create_buffer(4 * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+    gl_memory_buffer(o->params_buffer, GPU_MEMORY_UNIFORMS, 4 * sizeof(GLuint));
+    gl_debug_label(GL_BUFFER, o->params_buffer, "oit params");
+    return true;
+}
+
+static void oit_destroy_targets(Oit* o)
+{
+    gl_state_delete_framebuffers(1, &o->framebuffer);
+    GLuint textures[2] = { o->accumulation, o->revealage };
+    gl_state_delete_textures(2, textures);
+    o->framebuffer = o->accumulation = o->revealage = o->depth = 0;
+}
+
+void oit_destroy(Oit* o)
+{
+    if (o->framebuffer)
+        oit_destroy_targets(o);
+    gl_state_delete_buffers(1, &o->head_buffer);
+    gl_state_delete_buffers(1, &o->node_buffer);
+    gl_state_delete_buffers(1, &o->params_buffer);
+    if (o->resolve_program)
+        glDeleteProgram(o->resolve_program);
+    memset(o, 0, sizeof(*o));
+}
+
+static bool oit_create_targets(Oit* o, int width, int height, GLuint depth)
+{
+    const GLenum formats[2] = { GL_RGBA16F, GL_R16F };
+    GLuint* textures[2] = { &o->accumulation, &o->revealage };
+    static const char* labels[2] = { "oit accumulation", "oit revealage" };
+    for (int i = 0; i < 2; ++i)
+    {
+        glGenTextures(1, textures[i]);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, *textures[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+        gl_memory_texture(*textures[i], GPU_MEMORY_RENDER_TARGETS, formats[i], width, height, 1, 1, 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gl_debug_label(GL_TEXTURE, *textures[i], labels[i]);
+    }
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &o->framebuffer);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, o->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, o->accumulation, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, o->revealage, 0);
+    if (depth)
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+    o->depth = depth;
+    const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, buffers);
+    gl_debug_label(GL_FRAMEBUFFER, o->framebuffer, "oit");
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "oit: %dx%d targets incomplete (0x%04X)\n", width, height, status);
+        gl_state_bind_framebuffer(GL_FRAMEBUFFER, o->resolve_framebuffer);
+        oit_destroy_targets(o);
+        return false;
+    }
+    return true;
+}
+
+// Lists: a pool of OIT_LIST_LAYERS nodes a pixel behind its count and capacity, and a head per pixel
+static void oit_create_lists(Oit* o, int width, int height)
+{
+    const uint64_t pixels = (uint64_t)width * (uint64_t)height;
+    const GLuint capacity = (GLuint)(pixels * OIT_LIST_LAYERS);
+    const GLsizeiptr node_bytes = (GLsizeiptr)(2 + 3 * (uint64_t)capacity) * sizeof(GLuint);
+    const GLsizeiptr head_bytes = (GLsizeiptr)(pixels * sizeof(GLuint));
+    if (node_bytes > o->node_bytes)
+    {
+        gl_state_delete_buffers(1, &o->node_buffer);
+        o->node_buffer = gl_dsa_create_buffer(node_bytes, NULL, GL_DYNAMIC_COPY);
+        gl_memory_buffer(o->node_buffer, GPU_MEMORY_STORAGE, (size_t)node_bytes);
+        gl_debug_label(GL_BUFFER, o->node_buffer, "oit nodes");
+        o->node_bytes = node_bytes;
+    }
+    if (head_bytes > o->head_bytes)
+    {
+        gl_state_delete_buffers(1, &o->head_buffer);
+        o->head_buffer = gl_dsa_create_buffer(head_bytes, NULL, GL_DYNAMIC_COPY);
+        gl_memory_buffer(o->head_buffer, GPU_MEMORY_STORAGE, (size_t)head_bytes);
+        gl_debug_label(GL_BUFFER, o->head_buffer, "oit heads");
+        o->head_bytes = head_bytes;
+    }
+}
+
+bool oit_begin(Oit* o, int width, int height, GLuint depth)
+{
+    o->resolve_framebuffer = gl_state.draw_framebuffer;
+    const bool resized = o->width != width || o->height != height;
+    o->width = width;
+    o->height = height;
+    const GLuint params[4] = { (GLuint)width, o->reversed_z ? 1u : 0u, 0u, 0u };
+    gl_dsa_buffer_sub_data(o->params_buffer, 0, sizeof(params), params);
+    gl_state_bind_buffer_base(GL_UNIFORM_BUFFER, OIT_PARAMS_BINDING, o->params_buffer);
+
+    if (o->mode == OIT_LIST)
+    {
+        if (resized)
+            oit_create_lists(o, width, height);
+        const GLuint counts[2] = { 0u, (GLuint)((uint64_t)width * (uint64_t)height * OIT_LIST_LAYERS) };
+        const GLuint empty = 0xFFFFFFFFu;
+        gl_dsa_buffer_sub_data(o->node_buffer, 0, sizeof(counts), counts);
+        gl_dsa_clear_buffer(o->head_buffer, GL_R32UI, 0, (GLsizeiptr)width * height * sizeof(GLuint), GL_RED_INTEGER,
+            GL_UNSIGNED_INT, &empty);
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, OIT_LIST_NODES_BINDING, o->node_buffer);
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, OIT_LIST_HEADS_BINDING, o->head_buffer);
+        return true;
+    }
+
+    if (o->framebuffer && (resized || o->depth != depth))
+        oit_destroy_targets(o);
+    if (!o->framebuffer && !oit_create_targets(o, width, height, depth))
+        return false;
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, o->framebuffer);
+    const float zero[4] = { 0.f, 0.f, 0.f, 0.f };
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glClearBufferfv(GL_COLOR, 1, zero);
+    return true;
+}
+
+void oit_resolve(Oit* o)
+{
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, o->resolve_framebuffer);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_colour_mask(true);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_use_program(o->resolve_program);
+    if (o->mode == OIT_LIST)
+    {
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);     // every append done before the walk
+        gl_state_blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    else
+    {
+        gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, o->accumulation);
+        gl_state_bind_texture(1, GL_TEXTURE_2D, o->revealage);
+    }
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+}
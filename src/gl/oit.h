@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stdint.h>
+
+// Order-independent transparency (needs a 4.3 context): translucent surfaces
+// drawn in whatever order suits the state sort, with no depth sort on the
+// CPU, and composited over what was drawn before them in one fullscreen pass.
+//
+// Weighted blended (McGuire and Bavoil's): every fragment adds its colour,
+// premultiplied and weighted by a falloff in depth and alpha, to an RGBA16F
+// accumulation target, and -log(1 - alpha) to an R16F revealage target. Both
+// blend GL_ONE, GL_ONE, so a single blend state serves both attachments and
+// the sum of the logs is the log of the product of (1 - alpha) the technique
+// needs. The resolve divides the accumulated colour by its weight and covers
+// the background by 1 - exp(-revealage). One pass, a fixed 10 bytes a pixel;
+// the weights only approximate the order, so layers of very different depth
+// and alpha blend a little wrong.
+//
+// Per-pixel linked lists, for quality captures: every fragment appends a
+// node (its colour as unorm8s, its depth, the pixel's previous head) to a
+// shader storage pool and swaps itself in as the pixel's head. The resolve
+// walks each pixel's list, insertion-sorts up to OIT_LIST_MAX_DEPTH nodes
+// back to front and blends them exactly. Memory is OIT_LIST_LAYERS nodes a
+// pixel on average; fragments past the pool are dropped.
+//
+// OIT_GLSL is the fragment stage's side of both, #included by the scene
+// shaders' OIT variants: oitAccumulate for the weighted target, oitAppend for
+// the lists. The scene draws into it between oit_begin and oit_resolve with
+// depth writes off (and colour writes too, for the lists).
+
+#define OIT_PARAMS_BINDING 6            // the OitParams uniform block's binding, as in OIT_GLSL
+#define OIT_LIST_NODES_BINDING 9        // the OitNodes shader storage binding, as in OIT_GLSL
+#define OIT_LIST_HEADS_BINDING 10       // the OitHeads shader storage binding, as in OIT_GLSL
+#define OIT_LIST_LAYERS 4               // nodes a pixel the pool holds, on average
+#define OIT_LIST_MAX_DEPTH 32           // a pixel's nearest nodes the resolve sorts; the rest are dropped
+
+#define OIT_GLSL \
+    "layout(std140, binding = 6) uniform OitParams\n" \
+    "{\n" \
+    "    uvec4 oitParams;\n"            /* x: pixels a row, y: 1 for reversed Z */ \
+    "};\n" \
+    "#if defined(OIT_WEIGHTED)\n" \
+    "layout(location = 1) out float oitRevealage;\n" \
+    "vec4 oitAccumulate(vec4 c)\n" \
+    "{\n" \
+    "    float d = oitParams.y != 0u ? 1.0 - gl_FragCoord.z : gl_FragCoord.z;\n"  /* 0 at the near plane */ \
+    "    float w = clamp(pow(min(1.0, c.a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - d * 0.9, 3.0), 1e-2, 3e3);\n" \
+    "    oitRevealage = -log(1.0 - min(c.a, 0.999));\n" \
+    "    return vec4(c.rgb * c.a, c.a) * w;\n" \
+    "}\n" \
+    "#elif defined(OIT_LIST)\n" \
+    "layout(early_fragment_tests) in;\n"    /* hidden fragments take no node */ \
+    "layout(std430, binding = 9) coherent buffer OitNodes\n" \
+    "{\n" \
+    "    uint oitNodeCount;\n" \
+    "    uint oitNodeCapacity;\n" \
+    "    uint oitNodes[];\n"            /* 3 a node: packUnorm4x8 colour, depth (0 near) bits, next */ \
+    "};\n" \
+    "layout(std430, binding = 10) coherent buffer OitHeads\n" \
+    "{\n" \
+    "    uint oitHeads[];\n"            /* per pixel, 0xFFFFFFFF for an empty list */ \
+    "};\n" \
+    "void oitAppend(vec4 c)\n" \
+    "{\n" \
+    "    uint node = atomicAdd(oitNodeCount, 1u);\n" \
+    "    if (node >= oitNodeCapacity)\n" \
+    "        return;\n" \
+    "    float d = oitParams.y != 0u ? 1.0 - gl_FragCoord.z : gl_FragCoord.z;\n" \
+    "    uint pixel = uint(gl_FragCoord.y) * oitParams.x + uint(gl_FragCoord.x);\n" \
+    "    oitNodes[3u * node] = packUnorm4x8(c);\n" \
+    "    oitNodes[3u * node + 1u] = floatBitsToUint(d);\n" \
+    "    oitNodes[3u * node + 2u] = atomicExchange(oitHeads[pixel], node);\n" \
+    "}\n" \
+    "#endif\n"
+
+typedef enum OitMode
+{
+    OIT_OFF,
+    OIT_WEIGHTED,               // --oit weighted
+    OIT_LIST                    // --oit list
+} OitMode;
+
+typedef struct Oit
+{
+    OitMode mode;
+    bool reversed_z;            // depth runs 1 (near) to 0 (far)
+    GLuint resolve_program;
+    GLuint params_buffer;       // the OitParams block
+    GLuint framebuffer;         // weighted: accumulation and revealage, and the scene's depth to test against
+    GLuint accumulation;        // RGBA16F: weighted, premultiplied colour; alpha the weights' sum
+    GLuint revealage;           // R16F: the sum of -log(1 - alpha)
+    GLuint depth;               // the depth texture attached; 0 for none
+    GLuint node_buffer;         // lists: the node count, the capacity, then the nodes
+    GLsizeiptr node_bytes;
+    GLuint head_buffer;         // lists: a head per pixel
+    GLsizeiptr head_bytes;
+    int width;                  // as of the last oit_begin
+    int height;
+    GLuint resolve_framebuffer; // where oit_begin found the frame being drawn
+} Oit;
+
+// A 4.3 context; the lists also need shader storage bindings up to OIT_LIST_HEADS_BINDING
+bool oit_supported(OitMode mode);
+
+// Builds the resolve program for "mode" and the params block. "reversed_z": depth is cleared to 0 and near is 1.
+// Logs and returns false when the program fails to build.
+bool oit_init(Oit* o, OitMode mode, bool reversed_z);
+void oit_destroy(Oit* o);
+
+// Starts the translucent pass over a "width" x "height" frame (its targets or pool resized if need be). Weighted:
+// drawing switches to the accumulation targets, cleared, with "depth" (a depth texture, 0 for none) attached for
+// the test. Lists: the heads are emptied and the pool's count reset; drawing stays where it was. False (logged)
+// when the targets can't be made, and the scene should draw as usual.
+bool oit_begin(Oit* o, int width, int height, GLuint depth);
+
+// Back to the framebuffer oit_begin found, the translucent layers blended over it in one fullscreen pass (a VAO
+// bound by the caller; the pass has no attributes). Leaves blending on.
+void oit_resolve(Oit* o);
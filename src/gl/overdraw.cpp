@@ -0,0 +1,56 @@
+#include "gl/overdraw.h"
+
+#include <string.h>
+
+void overdraw_init(OverdrawCounter* o)
+{
+    memset(o, 0, sizeof(*o));
+    glGenQueries(OVERDRAW_QUERY_LATENCY, o->queries);
+}
+
+void overdraw_destroy(OverdrawCounter* o)
+{
+    if (o->queries[0])
+        glDeleteQueries(OVERDRAW_QUERY_LATENCY, o->queries);
+    memset(o, 0, sizeof(*o));
+}
+
+void overdraw_begin(OverdrawCounter* o, int width, int height)
+{
+    if (o->counting)
+        return;
+    // The slot's last query is OVERDRAW_QUERY_LATENCY frames old: long done, or dropped rather than waited for
+    const int slot = o->query_index;
+    if (o->query_pending[slot])
+    {
+        GLuint available = 0;
+        glGetQueryObjectuiv(o->queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 samples = 0;
+            glGetQueryObjectui64v(o->queries[slot], GL_QUERY_RESULT, &samples);
+            o->samples += (double)samples;
+            o->frame_pixels += o->pixels[slot];
+            ++o->frames;
+        }
+        o->query_pending[slot] = false;
+    }
+    o->pixels[slot] = (double)width * height;
+    glBeginQuery(GL_SAMPLES_PASSED, o->queries[slot]);
+    o->counting = true;
+}
+
+void overdraw_end(OverdrawCounter* o)
+{
+    if (!o->counting)
+        return;
+    glEndQuery(GL_SAMPLES_PASSED);
+    o->counting = false;
+    o->query_pending[o->query_index] = true;
+    o->query_index = (o->query_index + 1) % OVERDRAW_QUERY_LATENCY;
+}
+
+double overdraw_average(const OverdrawCounter* o)
+{
+    return o->frame_pixels > 0.0 ? o->samples / o->frame_pixels : 0.0;
+}
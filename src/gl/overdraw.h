@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stdint.h>
+
+// Overdraw measurement: how many fragments the scene's colour pass shades per
+// pixel of the frame. A GL_SAMPLES_PASSED query wraps the pass and is read
+// OVERDRAW_QUERY_LATENCY frames later, like the profiler's timestamps, so it
+// never stalls. Samples passed are the fragments that survive the depth test,
+// which with a depth pre-pass and GL_EQUAL is close to one per covered pixel;
+// without one it's every fragment rasterized.
+//
+// --overdraw shows the same thing as a picture: the scene shaders' OVERDRAW
+// variant adds a fixed colour per fragment with additive blending, so pixels
+// shaded many times glow from red through yellow to white.
+
+#define OVERDRAW_QUERY_LATENCY 4
+
+typedef struct OverdrawCounter
+{
+    GLuint queries[OVERDRAW_QUERY_LATENCY];
+    bool query_pending[OVERDRAW_QUERY_LATENCY];
+    double pixels[OVERDRAW_QUERY_LATENCY];      // the frame's size at each query
+    int query_index;
+    bool counting;              // between overdraw_begin and overdraw_end
+    double samples;             // summed over the frames read back
+    double frame_pixels;
+    uint32_t frames;
+} OverdrawCounter;
+
+void overdraw_init(OverdrawCounter* o);
+void overdraw_destroy(OverdrawCounter* o);
+
+// Counts the samples drawn from here to overdraw_end against a "width" x "height" frame. A begin while already
+// counting (the colour pass split around other work) is ignored.
+void overdraw_begin(OverdrawCounter* o, int width, int height);
+void overdraw_end(OverdrawCounter* o);
+
+// Fragments shaded per pixel, over the frames read back so far (0 before the first)
+double overdraw_average(const OverdrawCounter* o);
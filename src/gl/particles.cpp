@@ -0,0 +1,303 @@
+#include "gl/particles.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The particle shader's uniforms, at the locations its GLSL gives them rather than looked up by name
+enum
+{
+    PARTICLE_LOCATION_PASS = 0,
+    PARTICLE_LOCATION_CURRENT = 1,
+    PARTICLE_LOCATION_DELTA = 2,
+    PARTICLE_LOCATION_EMIT_COUNT = 3,
+    PARTICLE_LOCATION_SEED = 4,
+    PARTICLE_LOCATION_EMITTER = 5,
+    PARTICLE_LOCATION_LAUNCH = 6
+};
+
+// One invocation per particle (update), per new particle (emit) or one in all (finish). A particle is two
+// vec4s: position and velocity, then age, lifetime, size and a spare. Appending takes a slot in the other live
+// list with an atomic on its count and writes the instance at the same slot, so the instances come out packed
+// and in a different order every frame. The free list is a stack: the update pushes and the emit pops, in
+// separate passes, so a pop that finds it empty (the count wrapped below 0) just puts its decrement back.
+// The instance's matrix is a std430 mat3x4 like the culling shader's; its colour fades to black, which under
+// additive blending fades the particle out.
+static const char* particle_shader_text =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+"struct Instance { mat3x4 model; vec4 color; };\n"
+"layout(std430, binding = 0) buffer Particles { vec4 particles[]; };\n"
+"layout(std430, binding = 1) readonly buffer Source { uint source[]; };\n"
+"layout(std430, binding = 2) writeonly buffer Target { uint target[]; };\n"
+"layout(std430, binding = 3) buffer Dead { uint dead[]; };\n"
+"layout(std430, binding = 4) buffer Counters\n"
+"{\n"
+"    uint indexCount; uint instanceCount; uint firstIndex; int baseVertex; uint baseInstance;\n"
+"    uint dispatchGroups[3];\n"
+"    uint aliveCount[2];\n"
+"    uint deadCount;\n"
+"};\n"
+"layout(std430, binding = 5) writeonly buffer Instances { Instance instances[]; };\n"
+"layout(location = 0) uniform int pass;\n"           // 0 update, 1 emit, 2 finish
+"layout(location = 1) uniform int current;\n"        // the live list being read; the other is appended to
+"layout(location = 2) uniform float delta;\n"
+"layout(location = 3) uniform uint emitCount;\n"
+"layout(location = 4) uniform uint seed;\n"
+"layout(location = 5) uniform vec4 emitter;\n"       // x, y, gravity, size
+"layout(location = 6) uniform vec4 launch;\n"        // speed, spread, lifetime
+"uint hash(uint x)\n"
+"{\n"
+"    x ^= x >> 16; x *= 0x7feb352du; x ^= x >> 15; x *= 0x846ca68bu; x ^= x >> 16;\n"
+"    return x;\n"
+"}\n"
+"float random(inout uint state)\n"
+"{\n"
+"    state = hash(state);\n"
+"    return float(state >> 8) * (1.0 / 16777216.0);\n"
+"}\n"
+"void append(uint p, vec4 motion, vec4 life)\n"
+"{\n"
+"    uint slot = atomicAdd(aliveCount[1 - current], 1u);\n"
+"    target[slot] = p;\n"
+"    float t = life.x / life.y;\n"
+"    float s = life.z * (1.0 - 0.5 * t);\n"
+"    vec3 color = mix(vec3(1.0, 0.85, 0.4), vec3(0.9, 0.2, 0.05), t) * (1.0 - t);\n"
+"    instances[slot] = Instance(mat3x4(vec4(s, 0.0, 0.0, motion.x), vec4(0.0, s, 0.0, motion.y), vec4(0.0, 0.0, s, 0.0)),\n"
+"        vec4(color, 1.0));\n"
+"}\n"
+"void main()\n"
+"{\n"
+"    uint i = gl_GlobalInvocationID.x;\n"
+"    if (pass == 0)\n"
+"    {\n"
+"        if (i >= aliveCount[current])\n"
+"            return;\n"
+"        uint p = source[i];\n"
+"        vec4 motion = particles[2u * p];\n"
+"        vec4 life = particles[2u * p + 1u];\n"
+"        life.x += delta;\n"
+"        if (life.x >= life.y)\n"
+"        {\n"
+"            dead[atomicAdd(deadCount, 1u)] = p;\n"
+"            return;\n"
+"        }\n"
+"        motion.w -= emitter.z * delta;\n"
+"        motion.xy += motion.zw * delta;\n"
+"        particles[2u * p] = motion;\n"
+"        particles[2u * p + 1u] = life;\n"
+"        append(p, motion, life);\n"
+"    }\n"
+"    else if (pass == 1)\n"
+"    {\n"
+"        if (i >= emitCount)\n"
+"            return;\n"
+"        uint top = atomicAdd(deadCount, 0xFFFFFFFFu);\n"
+"        if (int(top) <= 0)\n"
+"        {\n"
+"            atomicAdd(deadCount, 1u);\n"
+"            return;\n"
+"        }\n"
+"        uint p = dead[top - 1u];\n"
+"        uint state = seed ^ hash(i);\n"
+"        float angle = launch.y * (2.0 * random(state) - 1.0);\n"
+"        float speed = launch.x * (0.75 + 0.5 * random(state));\n"
+"        vec4 motion = vec4(emitter.xy, speed * sin(angle), speed * cos(angle));\n"
+"        vec4 life = vec4(0.0, launch.z * (0.75 + 0.5 * random(state)), emitter.w, 0.0);\n"
+"        particles[2u * p] = motion;\n"
+"        particles[2u * p + 1u] = life;\n"
+"        append(p, motion, life);\n"
+"    }\n"
+"    else if (i == 0u)\n"
+"    {\n"
+"        uint live = aliveCount[1 - current];\n"
+"        instanceCount = live;\n"
+"        dispatchGroups[0] = (live + 63u) / 64u;\n"
+"        aliveCount[current] = 0u;\n"
+"    }\n"
+"}\n";
+
+#define PARTICLE_SIZE (sizeof(float) * 8)       // two vec4s
+#define INSTANCE_SIZE (sizeof(float) * 16)      // mat3x4 + vec4
+#define MAX_DELTA 0.1f      // seconds a frame advances the particles at most: a stall doesn't fling them off screen
+
+bool particles_init(ParticleSystem* ps, uint32_t capacity, const ParticleEmitter* emitter, GLint position_location,
+    GLint color_location, GLint model_location)
+{
+    ps->program = 0;
+    ps->particle_buffer = ps->alive_buffers[0] = ps->alive_buffers[1] = ps->dead_buffer = 0;
+    ps->counter_buffer = ps->instance_buffer = ps->vertex_array = 0;
+    ps->capacity = capacity;
+    ps->current = 0;
+    ps->emitter = *emitter;
+    ps->emit_carry = 0.0;
+    ps->seed = 0;
+
+    GLuint shader = shader_compile(GL_COMPUTE_SHADER, particle_shader_text);
+    ps->program = program_link(&shader, 1, false);
+    if (!ps->program)
+    {
+        fprintf(stderr, "particles: can't build the particle compute shader\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, ps->program, "particles");
+
+    // Written and read by the GPU only: the particles, both live lists and the instances
+    glGenBuffers(1, &ps->particle_buffer);
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, ps->particle_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, PARTICLE_SIZE * capacity, NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(ps->particle_buffer, GPU_MEMORY_STORAGE, PARTICLE_SIZE * capacity);
+    gl_debug_label(GL_BUFFER, ps->particle_buffer, "particles");
+    glGenBuffers(2, ps->alive_buffers);
+    for (int i = 0; i < 2; ++i)
+    {
+        gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, ps->alive_buffers[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * capacity, NULL, GL_DYNAMIC_COPY);
+        gl_memory_buffer(ps->alive_buffers[i], GPU_MEMORY_STORAGE, sizeof(GLuint) * capacity);
+        gl_debug_label(GL_BUFFER, ps->alive_buffers[i], i ? "particles alive 1" : "particles alive 0");
+    }
+    glGenBuffers(1, &ps->instance_buffer);
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, ps->instance_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, INSTANCE_SIZE * capacity, NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(ps->instance_buffer, GPU_MEMORY_STORAGE, INSTANCE_SIZE * capacity);
+    gl_debug_label(GL_BUFFER, ps->instance_buffer, "particle instances");
+
+    // Every slot starts out free; this is the only time the CPU writes one
+    GLuint* slots = (GLuint*)malloc(sizeof(GLuint) * capacity);
+    for (uint32_t i = 0; i < capacity; ++i)
+        slots[i] = capacity - 1 - i;    // popped from the top: slot 0 first
+    glGenBuffers(1, &ps->dead_buffer);
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, ps->dead_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * capacity, slots, GL_DYNAMIC_COPY);
+    gl_memory_buffer(ps->dead_buffer, GPU_MEMORY_STORAGE, sizeof(GLuint) * capacity);
+    free(slots);
+    gl_debug_label(GL_BUFFER, ps->dead_buffer, "particles free");
+
+    // The vertex array: the quad per vertex, the instances per instance. Bound before the quad is made, since
+    // its element buffer binding lands in whatever vertex array is bound.
+    ps->vertex_array = gl_dsa_create_vertex_array();
+    gl_state_bind_vertex_array(ps->vertex_array);
+    gl_debug_label(GL_VERTEX_ARRAY, ps->vertex_array, "particle vertex array");
+    static const float corners[8] = { -0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f };
+    static const uint32_t quad_indices[6] = { 0, 1, 2, 0, 2, 3 };
+    gpu_mesh_init(&ps->quad, corners, sizeof(float) * 2, 4, quad_indices, 6);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, ps->quad.vertex_buffer);
+    glVertexAttribPointer(position_location, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, (void*)0);
+    glEnableVertexAttribArray(position_location);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, ps->instance_buffer);
+    for (int r = 0; r < 3; ++r)
+    {
+        glVertexAttribPointer(model_location + r, 4, GL_FLOAT, GL_FALSE, INSTANCE_SIZE, (void*)(sizeof(float) * 4 * r));
+        glVertexAttribDivisor(model_location + r, 1);
+        glEnableVertexAttribArray(model_location + r);
+    }
+    glVertexAttribPointer(color_location, 3, GL_FLOAT, GL_FALSE, INSTANCE_SIZE, (void*)(sizeof(float) * 12));
+    glVertexAttribDivisor(color_location, 1);
+    glEnableVertexAttribArray(color_location);
+
+    // Nothing alive: the first update dispatches no groups and the draw has no instances
+    const ParticleCounters counters = { { (GLuint)ps->quad.index_count, 0, 0, 0, 0 }, { 0, 1, 1 }, { 0, 0 }, capacity };
+    glGenBuffers(1, &ps->counter_buffer);
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, ps->counter_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(counters), &counters, GL_DYNAMIC_DRAW);
+    gl_memory_buffer(ps->counter_buffer, GPU_MEMORY_STORAGE, sizeof(counters));
+    gl_debug_label(GL_BUFFER, ps->counter_buffer, "particle counters");
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+void particles_destroy(ParticleSystem* ps)
+{
+    if (ps->vertex_array)
+    {
+        gpu_mesh_destroy(&ps->quad);
+        gl_state_delete_vertex_arrays(1, &ps->vertex_array);
+    }
+    gl_state_delete_buffers(1, &ps->counter_buffer);
+    gl_state_delete_buffers(1, &ps->dead_buffer);
+    gl_state_delete_buffers(1, &ps->instance_buffer);
+    gl_state_delete_buffers(2, ps->alive_buffers);
+    gl_state_delete_buffers(1, &ps->particle_buffer);
+    if (ps->program)
+        glDeleteProgram(ps->program);
+    ps->program = 0;
+    ps->particle_buffer = ps->alive_buffers[0] = ps->alive_buffers[1] = ps->dead_buffer = 0;
+    ps->counter_buffer = ps->instance_buffer = ps->vertex_array = 0;
+}
+
+void particles_update(ParticleSystem* ps, float delta)
+{
+    delta = delta > MAX_DELTA ? MAX_DELTA : delta > 0.f ? delta : 0.f;
+
+    // The emission rate is the only thing the CPU works out, and it's one number
+    ps->emit_carry += (double)ps->emitter.rate * delta;
+    uint32_t emit_count = ps->emit_carry < (double)ps->capacity ? (uint32_t)ps->emit_carry : ps->capacity;
+    ps->emit_carry = ps->emit_carry < (double)ps->capacity ? ps->emit_carry - emit_count : 0.0;
+    ps->seed = ps->seed * 1664525u + 1013904223u;
+
+    const ParticleEmitter* e = &ps->emitter;
+    gl_state_use_program(ps->program);
+    glUniform1i(PARTICLE_LOCATION_CURRENT, ps->current);
+    glUniform1f(PARTICLE_LOCATION_DELTA, delta);
+    glUniform1ui(PARTICLE_LOCATION_EMIT_COUNT, emit_count);
+    glUniform1ui(PARTICLE_LOCATION_SEED, ps->seed);
+    glUniform4f(PARTICLE_LOCATION_EMITTER, e->position[0], e->position[1], e->gravity, e->size);
+    glUniform4f(PARTICLE_LOCATION_LAUNCH, e->speed, e->spread, e->lifetime, 0.f);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, ps->particle_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, ps->alive_buffers[ps->current]);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 2, ps->alive_buffers[1 - ps->current]);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 3, ps->dead_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 4, ps->counter_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 5, ps->instance_buffer);
+
+    // Update: as many groups as the last finish counted live particles
+    glUniform1i(PARTICLE_LOCATION_PASS, 0);
+    gl_state_bind_buffer(GL_DISPATCH_INDIRECT_BUFFER, ps->counter_buffer);
+    glDispatchComputeIndirect((GLintptr)offsetof(ParticleCounters, dispatch));
+    draw_counters_dispatch();
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);     // the emit pops what the update freed
+
+    if (emit_count)
+    {
+        glUniform1i(PARTICLE_LOCATION_PASS, 1);
+        glDispatchCompute((emit_count + PARTICLES_GROUP_SIZE - 1) / PARTICLES_GROUP_SIZE, 1, 1);
+        draw_counters_dispatch();
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    glUniform1i(PARTICLE_LOCATION_PASS, 2);
+    glDispatchCompute(1, 1, 1);
+    draw_counters_dispatch();
+
+    // The draw sources its command and instances from what the passes wrote, and so does the next update
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    ps->current = 1 - ps->current;
+}
+
+void particles_draw(ParticleSystem* ps)
+{
+    gl_state_bind_vertex_array(ps->vertex_array);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_blend_func(GL_ONE, GL_ONE);
+    gl_state_depth_mask(false);
+    gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, ps->counter_buffer);
+    glDrawElementsIndirect(GL_TRIANGLES, ps->quad.index_type, (const void*)offsetof(ParticleCounters, draw));
+    draw_counters_indirect(1);
+    gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    gl_state_depth_mask(true);
+    gl_state_enable(GL_BLEND, false);
+}
+
+bool particles_read_live_count(const ParticleSystem* ps, GpuReadback* rb, uint32_t* count, GpuReadbackFunction done,
+    void* user)
+{
+    return gpu_readback_buffer(rb, ps->counter_buffer, offsetof(ParticleCounters, draw.instance_count),
+        sizeof(*count), count, done, user);
+}
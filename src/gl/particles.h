@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/gpu_culling.h"
+#include "gl/gpu_readback.h"
+#include "gl/mesh.h"
+
+#include <stdint.h>
+
+// GPU particles (needs a 4.3 context): the particles live in shader storage
+// buffers and only ever change on the GPU. The CPU's part of a frame is a
+// handful of uniforms, three dispatches and one indirect draw, however many
+// particles there are.
+//
+// Each frame runs one compute program in three passes:
+//   update: every live particle is moved, aged, and either appended to the
+//           other live list (its instance written at the same slot) or, once
+//           its lifetime is up, pushed back onto the free list. The live set
+//           is compacted as it's updated, so the state is read once.
+//   emit:   the frame's new particles pop slots off the free list and are
+//           appended after the survivors; when it's empty the rest are dropped.
+//   finish: one invocation turns the new live count into the draw's instance
+//           count and the next update's group count, and empties the old list.
+// The live lists swap every frame. The survivors are drawn with
+// glDrawElementsIndirect as instanced quads through the scene program's
+// instanced variant: the instance's model matrix feeds vModel and its colour
+// vCol, so the particles need no program of their own.
+
+#define PARTICLES_GROUP_SIZE 64     // particles per work group (local_size_x in the shader)
+
+typedef struct ParticleEmitter
+{
+    float position[2];          // world space, in the grid's plane
+    float rate;                 // particles per second
+    float speed;                // launch speed, world units per second (+- 25%)
+    float spread;               // launch direction: radians either side of +y
+    float lifetime;             // seconds (+- 25%)
+    float gravity;              // world units per second squared, towards -y
+    float size;                 // quad side at birth, world units; halves over the lifetime
+} ParticleEmitter;
+
+// The counter buffer, laid out as the shader's Counters block
+typedef struct ParticleCounters
+{
+    DrawElementsIndirectCommand draw;   // instance_count: the live particles, as of the last finish
+    GLuint dispatch[3];         // the next update's glDispatchComputeIndirect groups
+    GLuint alive_count[2];      // particles in each live list
+    GLuint dead_count;          // free slots on the free list
+} ParticleCounters;
+
+typedef struct ParticleSystem
+{
+    GLuint program;             // the emit / update / finish compute shader
+    GLuint particle_buffer;     // SSBO: vec4 position + velocity, vec4 age, lifetime, size, random per slot
+    GLuint alive_buffers[2];    // uint slot lists; alive_buffers[current] holds the live particles
+    GLuint dead_buffer;         // uint free slots, a stack
+    GLuint counter_buffer;      // ParticleCounters
+    GLuint instance_buffer;     // mat3x4 model + vec4 colour per live particle: the vModel and vCol attributes
+    GLuint vertex_array;        // the quad and the instance attributes
+    GpuMesh quad;
+    uint32_t capacity;
+    int current;
+    ParticleEmitter emitter;
+    double emit_carry;          // the fraction of a particle owed from earlier frames
+    uint32_t seed;              // differs every frame, so every particle draws different random numbers
+} ParticleSystem;
+
+// Allocates room for "capacity" particles (all free) and builds the compute program. The quad's vertex positions
+// go to attribute "position_location", and the instance matrix rows and colour to "model_location" (3 of them)
+// and "color_location". Logs and returns false when the program fails to build.
+bool particles_init(ParticleSystem* ps, uint32_t capacity, const ParticleEmitter* emitter, GLint position_location,
+    GLint color_location, GLint model_location);
+void particles_destroy(ParticleSystem* ps);
+
+// Advances the particles by "delta" seconds: the update, emit and finish passes, ending with the barrier for the
+// indirect draw and its instance attributes
+void particles_update(ParticleSystem* ps, float delta);
+
+// Draws the live particles with the bound program and its uniform blocks, additively and without depth writes
+void particles_draw(ParticleSystem* ps);
+
+// Queues a readback of how many particles are alive into "*count"; "done" and "user" as gpu_readback_buffer takes
+// them
+bool particles_read_live_count(const ParticleSystem* ps, GpuReadback* rb, uint32_t* count, GpuReadbackFunction done,
+    void* user);
@@ -0,0 +1,125 @@
+#include "gl/pipeline_state.h"
+
+#include "gl/gl_state.h"
+
+#include <chrono>
+#include <string.h>
+
+void pipeline_states_init(PipelineStates* ps)
+{
+    memset(ps, 0, sizeof(*ps));
+}
+
+// Fields that don't take effect zeroed, so descriptions that draw alike compare equal
+static PipelineStateDesc normalised(const PipelineStateDesc* desc)
+{
+    PipelineStateDesc d;
+    memset(&d, 0, sizeof(d));     // padding too, for memcmp
+    d.program = desc->program;
+    d.program_pipeline = desc->program ? 0 : desc->program_pipeline;
+    d.vertex_array = desc->vertex_array;
+    d.depth_test = desc->depth_test;
+    d.depth_func = desc->depth_test ? desc->depth_func : 0;
+    d.depth_write = desc->depth_test && desc->depth_write;     // nothing is written with the test off
+    d.colour_write = desc->colour_write;
+    d.blend = desc->blend;
+    d.blend_src = desc->blend ? desc->blend_src : 0;
+    d.blend_dst = desc->blend ? desc->blend_dst : 0;
+    d.cull_face = desc->cull_face;
+    return d;
+}
+
+int pipeline_states_create(PipelineStates* ps, const char* name, const PipelineStateDesc* desc)
+{
+    const PipelineStateDesc d = normalised(desc);
+    for (int i = 0; i < ps->count; ++i)
+    {
+        if (!memcmp(&ps->states[i].desc, &d, sizeof(d)))
+            return i;
+    }
+    if (ps->count == PIPELINE_STATE_MAX)
+    {
+        fprintf(stderr, "pipeline_states: more than %d states, \"%s\" not made\n", PIPELINE_STATE_MAX, name);
+        return -1;
+    }
+    PipelineState* state = &ps->states[ps->count];
+    state->desc = d;
+    state->name = name;
+    state->warm = false;
+    return ps->count++;
+}
+
+void pipeline_states_clear(PipelineStates* ps)
+{
+    ps->count = 0;
+}
+
+void pipeline_state_bind(const PipelineStates* ps, int id)
+{
+    const PipelineStateDesc* d = &ps->states[id].desc;
+    gl_state_use_program(d->program);
+    if (!d->program)
+        gl_state_bind_program_pipeline(d->program_pipeline);
+    gl_state_bind_vertex_array(d->vertex_array);
+    gl_state_enable(GL_DEPTH_TEST, d->depth_test);
+    if (d->depth_test)
+    {
+        gl_state_depth_func(d->depth_func);
+        gl_state_depth_mask(d->depth_write);
+    }
+    gl_state_colour_mask(d->colour_write);
+    gl_state_enable(GL_BLEND, d->blend);
+    if (d->blend)
+        gl_state_blend_func(d->blend_src, d->blend_dst);
+    gl_state_enable(GL_CULL_FACE, d->cull_face);
+}
+
+bool pipeline_states_cold(const PipelineStates* ps)
+{
+    for (int i = 0; i < ps->count; ++i)
+    {
+        if (!ps->states[i].warm)
+            return true;
+    }
+    return false;
+}
+
+int pipeline_states_warm_up(PipelineStates* ps, void (*draw)(void* user), void* user)
+{
+    if (!pipeline_states_cold(ps))
+        return 0;
+    const auto start = std::chrono::steady_clock::now();
+    gl_state_enable(GL_SCISSOR_TEST, true);
+    glScissor(0, 0, 0, 0);      // the draws are validated, and compiled for, but cover no pixels
+    int warmed = 0;
+    for (int i = 0; i < ps->count; ++i)
+    {
+        PipelineState* state = &ps->states[i];
+        if (state->warm)
+            continue;
+        pipeline_state_bind(ps, i);
+        draw(user);
+        state->warm = true;
+        ++warmed;
+    }
+    gl_state_enable(GL_SCISSOR_TEST, false);
+    glFlush();      // the driver's compile starts now rather than at the frame's first real draw
+    ps->warm_ups += (unsigned int)warmed;
+    ps->warm_up_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return warmed;
+}
+
+void pipeline_states_print(const PipelineStates* ps, FILE* out)
+{
+    fprintf(out, "pipeline states: %d, %u warm-up draws in %.2f ms\n", ps->count, ps->warm_ups, ps->warm_up_ms);
+    for (int i = 0; i < ps->count; ++i)
+    {
+        const PipelineState* s = &ps->states[i];
+        const PipelineStateDesc* d = &s->desc;
+        fprintf(out, "  %-20s %s %u, depth %s%s, blend %s, colour %s, cull %s%s\n", s->name,
+            d->program ? "program" : "pipeline", d->program ? d->program : d->program_pipeline,
+            d->depth_test ? "tested" : "off", d->depth_test && !d->depth_write ? " (read only)" : "",
+            d->blend ? "on" : "off", d->colour_write ? "written" : "masked", d->cull_face ? "on" : "off",
+            s->warm ? "" : " (cold)");
+    }
+}
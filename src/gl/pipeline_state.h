@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Pipeline state objects: the program, the vertex array (and so the vertex
+// format) and the depth, blend, cull and colour write state a pass draws
+// with, made up front as one immutable bundle and bound in one call.
+//
+// GL takes that state piecemeal, and a driver may only find out at a draw
+// that a combination needs a program variant it hasn't compiled yet (output
+// blending or a write mask folded into the fragment shader, say). That
+// compile lands mid-frame as a hitch. Here every combination the renderer
+// will use is declared when its program is ready, and
+// pipeline_states_warm_up draws each new one once before the frame's real
+// draws, under an empty scissor so nothing reaches the target. The target is
+// the one the pass draws into, so its formats and sample count match too.
+//
+// pipeline_state_bind goes through gl/gl_state.h, so only what differs from
+// the state already set reaches GL. States stay valid until
+// pipeline_states_clear (a program rebuilt, say), which drops them all.
+
+#define PIPELINE_STATE_MAX 32
+
+typedef struct PipelineStateDesc
+{
+    GLuint program;             // a whole program, or 0 to draw with "program_pipeline"
+    GLuint program_pipeline;    // separable stages (gl/program_pipeline.h), with no program in use
+    GLuint vertex_array;        // the vertex format, and the buffers it reads
+    bool depth_test;
+    GLenum depth_func;
+    bool depth_write;
+    bool colour_write;
+    bool blend;
+    GLenum blend_src, blend_dst;    // with "blend"
+    bool cull_face;
+} PipelineStateDesc;
+
+typedef struct PipelineState
+{
+    PipelineStateDesc desc;
+    const char* name;           // for pipeline_states_print; not copied
+    bool warm;                  // drawn with once by pipeline_states_warm_up
+} PipelineState;
+
+typedef struct PipelineStates
+{
+    PipelineState states[PIPELINE_STATE_MAX];
+    int count;
+    unsigned int warm_ups;      // draws pipeline_states_warm_up made since init
+    double warm_up_ms;          // and the CPU time they took, where any compile the driver does shows up
+} PipelineStates;
+
+void pipeline_states_init(PipelineStates* ps);
+
+// The id of a state drawing as "desc". The same description asked for again gets the same id. Returns -1 (logged)
+// when the table is full.
+int pipeline_states_create(PipelineStates* ps, const char* name, const PipelineStateDesc* desc);
+
+// Drops every state: their programs or vertex arrays are about to change. Ids made before are invalid.
+void pipeline_states_clear(PipelineStates* ps);
+
+// Sets everything state "id" bundles; the program (or pipeline) and vertex array are left bound
+void pipeline_state_bind(const PipelineStates* ps, int id);
+
+// True while a state hasn't been warmed up
+bool pipeline_states_cold(const PipelineStates* ps);
+
+// Binds each state not yet warmed and calls "draw" to make one representative draw with it, under an empty
+// scissor. With the frame's target bound and its uniform blocks in place, before its first real draw. Returns how
+// many states it warmed; the last one's state is left set.
+int pipeline_states_warm_up(PipelineStates* ps, void (*draw)(void* user), void* user);
+
+// Each state and whether it's been warmed, then the warm-up draws and their time
+void pipeline_states_print(const PipelineStates* ps, FILE* out);
@@ -0,0 +1,319 @@
+#include "gl/point_cloud_renderer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// One invocation per tile. The target is point_cloud_target's; a reset starts the tile over from its first point.
+// The slice is a rounded-up 1/refineFrames of the target (at least one point), so the target is reached in
+// refineFrames frames at most and a tile that's already complete gets an empty command.
+static const char* decimate_shader_text =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+"struct Tile { vec4 bounds; uint first; uint count; uint done; uint spare; };\n"
+"struct Command { uint count; uint instanceCount; uint first; uint baseInstance; };\n"
+"layout(std430, binding = 0) buffer Tiles { Tile tiles[]; };\n"
+"layout(std430, binding = 1) writeonly buffer Commands { Command commands[]; };\n"
+"layout(std430, binding = 2) buffer Stats { uint drawn; uint targeted; uint visible; uint complete; };\n"
+"uniform vec4 view;\n"
+"uniform vec2 viewport;\n"
+"uniform float density;\n"
+"uniform uint refineFrames;\n"
+"uniform bool reset;\n"
+"uniform uint tileCount;\n"
+"void main()\n"
+"{\n"
+"    uint i = gl_GlobalInvocationID.x;\n"
+"    if (i >= tileCount)\n"
+"        return;\n"
+"    vec4 b = tiles[i].bounds;\n"
+"    uint count = tiles[i].count;\n"
+"    uint done = reset ? 0u : tiles[i].done;\n"
+"    uint target = 0u;\n"
+"    if (b.z >= view.x && b.x <= view.z && b.w >= view.y && b.y <= view.w)\n"
+"    {\n"
+"        vec2 pixels = (b.zw - b.xy) / (view.zw - view.xy) * viewport + 1.0;\n"
+"        float t = density * pixels.x * pixels.y;\n"
+"        target = t >= float(count) ? count : t < 1.0 ? 1u : uint(t);\n"
+"    }\n"
+"    uint end = min(target, done + max((target + refineFrames - 1u) / refineFrames, 1u));\n"
+"    uint slice = end > done ? end - done : 0u;\n"
+"    commands[i] = Command(slice, 1u, tiles[i].first + done, i);\n"
+"    tiles[i].done = done + slice;\n"
+"    if (target > 0u)\n"
+"    {\n"
+"        atomicAdd(drawn, slice);\n"
+"        atomicAdd(targeted, target);\n"
+"        atomicAdd(visible, 1u);\n"
+"        if (done + slice >= target)\n"
+"            atomicAdd(complete, 1u);\n"
+"    }\n"
+"}\n";
+
+static const char* vertex_shader_text =
+"#version 330 core\n"
+"uniform mat4 viewProjection;\n"
+"layout(location = 0) in vec2 vPos;\n"
+"layout(location = 1) in vec4 vCol;\n"
+"layout(location = 2) in vec4 vTile;\n"    // per instance: origin, size
+"out vec3 color;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = viewProjection * vec4(vTile.xy + vPos * vTile.zw, 0.0, 1.0);\n"
+"    color = vCol.rgb;\n"
+"}\n";
+
+static const char* fragment_shader_text =
+"#version 330 core\n"
+"in vec3 color;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    fragment = vec4(color, 1.0);\n"
+"}\n";
+
+// A full-screen triangle reading the layer texel for texel; blended premultiplied, so where nothing was drawn (0)
+// the target shows through
+static const char* composite_vertex_shader_text =
+"#version 330 core\n"
+"void main()\n"
+"{\n"
+"    gl_Position = vec4(vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+static const char* composite_fragment_shader_text =
+"#version 330 core\n"
+"uniform sampler2D layer;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    fragment = texelFetch(layer, ivec2(gl_FragCoord.xy), 0);\n"
+"}\n";
+
+// The Tiles block's element, std430
+typedef struct GpuPointTile
+{
+    float bounds[4];
+    GLuint first, count, done, spare;
+} GpuPointTile;
+
+typedef struct DrawArraysIndirectCommand
+{
+    GLuint count;
+    GLuint instance_count;
+    GLuint first;
+    GLuint base_instance;
+} DrawArraysIndirectCommand;
+
+bool point_cloud_renderer_init(PointCloudRenderer* pcr, const PointCloud* cloud, float density, int refine_frames)
+{
+    memset(pcr, 0, sizeof(*pcr));
+    pcr->tile_count = cloud->tile_count;
+    pcr->point_count = cloud->point_count;
+    pcr->density = density;
+    pcr->refine_frames = refine_frames < 1 ? 1 : refine_frames;
+
+    GLuint shader = shader_compile(GL_COMPUTE_SHADER, decimate_shader_text);
+    pcr->decimate_program = program_link(&shader, 1, false);
+    pcr->program = program_build(vertex_shader_text, fragment_shader_text, false);
+    pcr->composite_program = program_build(composite_vertex_shader_text, composite_fragment_shader_text, false);
+    if (!pcr->decimate_program || !pcr->program || !pcr->composite_program)
+    {
+        fprintf(stderr, "point_cloud: can't build the programs\n");
+        point_cloud_renderer_destroy(pcr);
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, pcr->decimate_program, "point decimate");
+    gl_debug_label(GL_PROGRAM, pcr->program, "points");
+    gl_debug_label(GL_PROGRAM, pcr->composite_program, "point composite");
+    pcr->view_location = glGetUniformLocation(pcr->decimate_program, "view");
+    pcr->viewport_location = glGetUniformLocation(pcr->decimate_program, "viewport");
+    pcr->density_location = glGetUniformLocation(pcr->decimate_program, "density");
+    pcr->refine_frames_location = glGetUniformLocation(pcr->decimate_program, "refineFrames");
+    pcr->reset_location = glGetUniformLocation(pcr->decimate_program, "reset");
+    pcr->tile_count_location = glGetUniformLocation(pcr->decimate_program, "tileCount");
+    pcr->view_projection_location = glGetUniformLocation(pcr->program, "viewProjection");
+    gl_state_use_program(pcr->composite_program);
+    glUniform1i(glGetUniformLocation(pcr->composite_program, "layer"), 0);
+
+    // The tables: the shader's half (bounds, range, progress) and the vertex shader's (origin and size)
+    GpuPointTile* tiles = (GpuPointTile*)malloc(sizeof(GpuPointTile) * (cloud->tile_count ? cloud->tile_count : 1));
+    float* origins = (float*)malloc(sizeof(float) * 4 * (cloud->tile_count ? cloud->tile_count : 1));
+    if (!tiles || !origins)
+    {
+        free(tiles);
+        free(origins);
+        fprintf(stderr, "point_cloud: out of memory for %u tiles\n", cloud->tile_count);
+        point_cloud_renderer_destroy(pcr);
+        return false;
+    }
+    for (uint32_t i = 0; i < cloud->tile_count; ++i)
+    {
+        const PointCloudTile* t = &cloud->tiles[i];
+        memcpy(tiles[i].bounds, t->bounds, sizeof(tiles[i].bounds));
+        tiles[i].first = t->first;
+        tiles[i].count = t->count;
+        tiles[i].done = tiles[i].spare = 0;
+        origins[4 * i] = t->origin[0];
+        origins[4 * i + 1] = t->origin[1];
+        origins[4 * i + 2] = t->size[0];
+        origins[4 * i + 3] = t->size[1];
+    }
+    glGenBuffers(1, &pcr->tile_buffer);
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, pcr->tile_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuPointTile) * cloud->tile_count, tiles, GL_DYNAMIC_COPY);
+    gl_memory_buffer(pcr->tile_buffer, GPU_MEMORY_STORAGE, sizeof(GpuPointTile) * cloud->tile_count);
+    gl_debug_label(GL_BUFFER, pcr->tile_buffer, "point tiles");
+    glGenBuffers(1, &pcr->command_buffer);
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, pcr->command_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawArraysIndirectCommand) * cloud->tile_count, NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(pcr->command_buffer, GPU_MEMORY_STORAGE, sizeof(DrawArraysIndirectCommand) * cloud->tile_count);
+    gl_debug_label(GL_BUFFER, pcr->command_buffer, "point draws");
+    glGenBuffers(1, &pcr->stats_buffer);
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, pcr->stats_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(PointCloudStats), NULL, GL_DYNAMIC_COPY);
+    gl_memory_buffer(pcr->stats_buffer, GPU_MEMORY_STORAGE, sizeof(PointCloudStats));
+    gl_debug_label(GL_BUFFER, pcr->stats_buffer, "point stats");
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, 0);
+    free(tiles);
+
+    // The vertex array: the records per vertex, the tile per instance (the draw's base instance picks it)
+    pcr->vertex_array = gl_dsa_create_vertex_array();
+    gl_state_bind_vertex_array(pcr->vertex_array);
+    gl_debug_label(GL_VERTEX_ARRAY, pcr->vertex_array, "points");
+    vertex_format_init(&pcr->format);
+    vertex_format_add(&pcr->format, 0, 2, VERTEX_ATTRIB_UNORM16);
+    vertex_format_add(&pcr->format, 1, 4, VERTEX_ATTRIB_UNORM8);
+    glGenBuffers(1, &pcr->record_buffer);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, pcr->record_buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)sizeof(PointRecord) * cloud->point_count, cloud->records, GL_STATIC_DRAW);
+    gl_memory_buffer(pcr->record_buffer, GPU_MEMORY_GEOMETRY, (GLsizeiptr)sizeof(PointRecord) * cloud->point_count);
+    gl_debug_label(GL_BUFFER, pcr->record_buffer, "point records");
+    vertex_format_apply(&pcr->format, 0);
+    glGenBuffers(1, &pcr->tile_attribute_buffer);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, pcr->tile_attribute_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 4 * cloud->tile_count, origins, GL_STATIC_DRAW);
+    gl_memory_buffer(pcr->tile_attribute_buffer, GPU_MEMORY_GEOMETRY, sizeof(float) * 4 * cloud->tile_count);
+    gl_debug_label(GL_BUFFER, pcr->tile_attribute_buffer, "point tile origins");
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)0);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(2);
+    free(origins);
+    if (glGetError() == GL_OUT_OF_MEMORY)
+    {
+        fprintf(stderr, "point_cloud: out of GPU memory for %u points\n", cloud->point_count);
+        point_cloud_renderer_destroy(pcr);
+        return false;
+    }
+    return true;
+}
+
+void point_cloud_renderer_destroy(PointCloudRenderer* pcr)
+{
+    if (pcr->layer.framebuffer)
+        render_target_destroy(&pcr->layer);
+    if (pcr->vertex_array)
+        gl_state_delete_vertex_arrays(1, &pcr->vertex_array);
+    GLuint buffers[5] = { pcr->record_buffer, pcr->tile_attribute_buffer, pcr->tile_buffer, pcr->command_buffer,
+        pcr->stats_buffer };
+    gl_state_delete_buffers(5, buffers);
+    if (pcr->composite_program)
+        glDeleteProgram(pcr->composite_program);
+    if (pcr->program)
+        glDeleteProgram(pcr->program);
+    if (pcr->decimate_program)
+        glDeleteProgram(pcr->decimate_program);
+    memset(pcr, 0, sizeof(*pcr));
+}
+
+void point_cloud_renderer_draw(PointCloudRenderer* pcr, const float view[4], mat4x4 const view_projection, int width,
+    int height)
+{
+    if (!pcr->tile_count || width < 1 || height < 1)
+        return;
+    const GLuint read_framebuffer = gl_state.read_framebuffer, draw_framebuffer = gl_state.draw_framebuffer;
+    GLint viewport[4] = { 0, 0, width, height };
+    if (gl_state.viewport_known)
+        memcpy(viewport, gl_state.viewport, sizeof(viewport));
+
+    // A new size or a new view: the layer holds the wrong picture, start it over
+    bool reset = memcmp(view, pcr->view, sizeof(pcr->view)) != 0;
+    if (pcr->layer.width != width || pcr->layer.height != height)
+    {
+        if (pcr->layer.framebuffer)
+            render_target_destroy(&pcr->layer);
+        if (!render_target_init(&pcr->layer, width, height, GL_RGBA8, false, 1))
+            return;
+        gl_debug_label(GL_FRAMEBUFFER, pcr->layer.framebuffer, "point layer");
+        reset = true;
+    }
+    render_target_bind(&pcr->layer);
+    gl_state_viewport(0, 0, width, height);
+    if (reset)
+    {
+        static const GLfloat transparent[4] = { 0.f, 0.f, 0.f, 0.f };
+        glClearBufferfv(GL_COLOR, 0, transparent);
+        memcpy(pcr->view, view, sizeof(pcr->view));
+        ++pcr->resets;
+    }
+
+    // Every tile's slice, then the draws that read them
+    const GLuint zero = 0;
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, pcr->stats_buffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    gl_state_use_program(pcr->decimate_program);
+    glUniform4fv(pcr->view_location, 1, view);
+    glUniform2f(pcr->viewport_location, (float)width, (float)height);
+    glUniform1f(pcr->density_location, pcr->density);
+    glUniform1ui(pcr->refine_frames_location, (GLuint)pcr->refine_frames);
+    glUniform1i(pcr->reset_location, reset);
+    glUniform1ui(pcr->tile_count_location, pcr->tile_count);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, pcr->tile_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, pcr->command_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 2, pcr->stats_buffer);
+    glDispatchCompute((pcr->tile_count + POINT_CLOUD_GROUP_SIZE - 1) / POINT_CLOUD_GROUP_SIZE, 1, 1);
+    draw_counters_dispatch();
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);    // the draws, then next frame's progress
+
+    const bool depth_test = gl_state.capabilities[GL_STATE_CAP_DEPTH_TEST] == 1;
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_use_program(pcr->program);
+    glUniformMatrix4fv(pcr->view_projection_location, 1, GL_FALSE, &view_projection[0][0]);
+    gl_state_bind_vertex_array(pcr->vertex_array);
+    gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, pcr->command_buffer);
+    glMultiDrawArraysIndirect(GL_POINTS, (const void*)0, (GLsizei)pcr->tile_count, sizeof(DrawArraysIndirectCommand));
+    draw_counters_indirect((GLsizei)pcr->tile_count);
+    gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // Onto the caller's target, under what it draws next
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer);
+    gl_state_viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    gl_state_use_program(pcr->composite_program);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, pcr->layer.color);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+    gl_state_enable(GL_BLEND, false);
+    gl_state_enable(GL_DEPTH_TEST, depth_test);
+    ++pcr->frames;
+}
+
+void point_cloud_renderer_stats(const PointCloudRenderer* pcr, PointCloudStats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (!pcr->stats_buffer)
+        return;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, pcr->stats_buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(*stats), stats);
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/point_cloud.h"
+#include "gl/render_target.h"
+#include "gl/vertex_format.h"
+#include "linmath.h"
+
+#include <stdint.h>
+
+// Draws a PointCloud (core/point_cloud.h) as GL_POINTS (needs a 4.3 context),
+// decimated and refined on the GPU.
+//
+// The records go into one vertex buffer as uploaded, position as UNORM16x2
+// at location 0 and colour as UNORM8x4 at 1, and each tile's origin and size
+// into an instanced attribute at 2. Every frame a compute pass takes each
+// tile, works out its target as point_cloud_target does (nothing outside the
+// view, at most "density" points per pixel it covers) and writes one
+// DrawArraysIndirectCommand: the tile's next slice of points, with the tile
+// as its base instance so the vertex shader finds its origin. One
+// glMultiDrawArraysIndirect then draws every tile's slice.
+//
+// Refinement is over frames: the points are drawn into a layer of their own
+// that is only cleared when the view changes, and each frame adds a slice of
+// 1/"refine_frames" of every tile's target after what's already there. A
+// moved view is complete at that density after "refine_frames" frames, each
+// slice a uniform sample (the tiles are shuffled), and once it's complete a
+// frame costs the compute pass and the composite onto the scene target. The
+// CPU never reads anything back but for the report.
+//
+// Points are opaque and a pixel each. The layer is composited under whatever
+// draws after it in the same pass.
+
+#define POINT_CLOUD_GROUP_SIZE 64   // tiles per work group (local_size_x in the shader)
+
+typedef struct PointCloudStats
+{
+    uint32_t drawn;                 // points in the last frame's slices
+    uint32_t target;                // points the view needs at the density
+    uint32_t visible;               // tiles in view
+    uint32_t complete;              // of those, the ones with their target drawn
+} PointCloudStats;
+
+typedef struct PointCloudRenderer
+{
+    GLuint decimate_program;        // the per-tile compute pass
+    GLint view_location;
+    GLint viewport_location;
+    GLint density_location;
+    GLint refine_frames_location;
+    GLint reset_location;
+    GLint tile_count_location;
+    GLuint program;                 // the points
+    GLint view_projection_location;
+    GLuint composite_program;       // the layer onto the bound framebuffer
+    GLuint vertex_array;
+    VertexFormat format;
+    GLuint record_buffer;
+    GLuint tile_attribute_buffer;   // vec4 origin, size per tile
+    GLuint tile_buffer;             // SSBO: bounds, first, count and points drawn so far per tile
+    GLuint command_buffer;          // DrawArraysIndirectCommand per tile
+    GLuint stats_buffer;            // PointCloudStats, the last frame's
+    RenderTarget layer;             // the points drawn so far, cleared to transparent
+    uint32_t tile_count;
+    uint32_t point_count;
+    float density;                  // points per pixel
+    int refine_frames;
+    float view[4];                  // what the layer holds: the view rectangle it was drawn for
+    unsigned int frames;            // drawn
+    unsigned int resets;            // of them, started over
+} PointCloudRenderer;
+
+// Uploads "cloud" (it may be destroyed afterwards) and builds the programs. Logs and returns false when a program
+// fails to build.
+bool point_cloud_renderer_init(PointCloudRenderer* pcr, const PointCloud* cloud, float density, int refine_frames);
+void point_cloud_renderer_destroy(PointCloudRenderer* pcr);
+
+// Adds this frame's slices for the world rectangle "view" (min x, min y, max x, max y) seen through
+// "view_projection" over "width" x "height" pixels, starting over when either changed, then composites the layer
+// onto the draw framebuffer that was bound, which it leaves bound
+void point_cloud_renderer_draw(PointCloudRenderer* pcr, const float view[4], mat4x4 const view_projection, int width,
+    int height);
+
+// Reads back the last frame's stats. Waits for the GPU: for reports, not every frame.
+void point_cloud_renderer_stats(const PointCloudRenderer* pcr, PointCloudStats* stats);
@@ -0,0 +1,361 @@
+#include "gl/post_process.h"
+
+#include "gl/draw_counters.h"
+#include "gl/frame_graph_gl.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// A triangle over the whole viewport; uv runs [0, 1] across it
+static const char* post_vertex_shader_text =
+"#version 330\n"
+"out vec2 uv;\n"
+"void main()\n"
+"{\n"
+"    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+"    uv = p;\n"
+"    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+// "sourceScale" is the part of the source that holds the picture (the scene covers a corner of its target). Reads
+// are clamped half a texel inside it, so filtering never pulls in what's beyond.
+#define POST_FETCH_GLSL \
+    "uniform sampler2D source;\n" \
+    "uniform vec2 texel;\n"           /* 1 / the source texture's size */ \
+    "uniform vec2 sourceScale;\n" \
+    "in vec2 uv;\n" \
+    "layout(location = 0) out vec4 fragment;\n" \
+    "vec3 fetch(vec2 st)\n" \
+    "{\n" \
+    "    return texture(source, clamp(st, 0.5 * texel, sourceScale - 0.5 * texel)).rgb;\n" \
+    "}\n"
+
+// Half size with 5 bilinear taps (the centre weighted 4), from a 2x2 texel neighbourhood each. The first level
+// also keeps only what's above the threshold, with a quadratic knee so bloom fades in rather than switching on.
+static const char* downsample_fragment_shader_text =
+"#version 330\n"
+POST_FETCH_GLSL
+"uniform float threshold;\n"      // 0 past the first level
+"void main()\n"
+"{\n"
+"    vec2 st = uv * sourceScale;\n"
+"    vec3 c = fetch(st) * 4.0 + fetch(st + vec2(-texel.x, -texel.y)) + fetch(st + vec2(texel.x, -texel.y))\n"
+"        + fetch(st + vec2(-texel.x, texel.y)) + fetch(st + texel);\n"
+"    c *= 0.125;\n"
+"    if (threshold > 0.0)\n"
+"    {\n"
+"        float brightness = max(c.r, max(c.g, c.b));\n"
+"        float knee = 0.5 * threshold;\n"
+"        float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);\n"
+"        soft = soft * soft / (4.0 * knee + 1e-4);\n"
+"        c *= max(soft, brightness - threshold) / max(brightness, 1e-4);\n"
+"    }\n"
+"    fragment = vec4(c, 1.0);\n"
+"}\n";
+
+// Double size with a tent of 8 bilinear taps, blended additively onto the level below
+static const char* upsample_fragment_shader_text =
+"#version 330\n"
+POST_FETCH_GLSL
+"void main()\n"
+"{\n"
+"    vec3 c = fetch(uv + vec2(-2.0 * texel.x, 0.0)) + fetch(uv + vec2(2.0 * texel.x, 0.0))\n"
+"        + fetch(uv + vec2(0.0, -2.0 * texel.y)) + fetch(uv + vec2(0.0, 2.0 * texel.y));\n"
+"    c += 2.0 * (fetch(uv + vec2(-texel.x, texel.y)) + fetch(uv + texel) + fetch(uv + vec2(texel.x, -texel.y))\n"
+"        + fetch(uv - texel));\n"
+"    fragment = vec4(c / 12.0, 1.0);\n"
+"}\n";
+
+// The stage chain's draws, after the defines for the stages merged into it. FXAA is the quality-preset-free
+// version (a search along the edge's direction, kept when its luma stays in the neighbourhood's range); uv's y
+// runs up, so the direction's y is the x gradient with the sign that makes it along the edge.
+static const char* stage_fragment_shader_text =
+POST_FETCH_GLSL
+"uniform sampler2D bloom;\n"
+"uniform float exposure;\n"
+"uniform float bloomIntensity;\n"
+"float luma(vec3 c) { return dot(c, vec3(0.299, 0.587, 0.114)); }\n"
+"vec3 fxaa(vec2 st)\n"
+"{\n"
+"    float nw = luma(fetch(st + vec2(-texel.x, texel.y)));\n"
+"    float ne = luma(fetch(st + texel));\n"
+"    float sw = luma(fetch(st - texel));\n"
+"    float se = luma(fetch(st + vec2(texel.x, -texel.y)));\n"
+"    vec3 centre = fetch(st);\n"
+"    float m = luma(centre);\n"
+"    float lo = min(m, min(min(nw, ne), min(sw, se)));\n"
+"    float hi = max(m, max(max(nw, ne), max(sw, se)));\n"
+"    vec2 dir = vec2(-((nw + ne) - (sw + se)), (ne + se) - (nw + sw));\n"
+"    float reduce = max((nw + ne + sw + se) * (0.25 / 8.0), 1.0 / 128.0);\n"
+"    dir = clamp(dir / (min(abs(dir.x), abs(dir.y)) + reduce), -8.0, 8.0) * texel;\n"
+"    vec3 a = 0.5 * (fetch(st - dir * (1.0 / 6.0)) + fetch(st + dir * (1.0 / 6.0)));\n"
+"    vec3 b = 0.5 * a + 0.25 * (fetch(st - dir * 0.5) + fetch(st + dir * 0.5));\n"
+"    float lb = luma(b);\n"
+"    return lb < lo || lb > hi ? a : b;\n"
+"}\n"
+"vec3 tonemap(vec3 c)\n"
+"{\n"
+"    c *= exposure;\n"
+"    c = clamp(c * (2.51 * c + 0.03) / (c * (2.43 * c + 0.59) + 0.14), 0.0, 1.0);\n"
+"    return pow(c, vec3(1.0 / 2.2));\n"
+"}\n"
+"void main()\n"
+"{\n"
+"    vec2 st = uv * sourceScale;\n"
+"#ifdef STAGE_FXAA\n"
+"    vec3 c = fxaa(st);\n"
+"#else\n"
+"    vec3 c = fetch(st);\n"
+"#endif\n"
+"#ifdef STAGE_BLOOM\n"
+"    c += bloomIntensity * texture(bloom, uv).rgb;\n"
+"#endif\n"
+"#ifdef STAGE_TONEMAP\n"
+"    c = tonemap(c);\n"
+"#endif\n"
+"    fragment = vec4(c, 1.0);\n"
+"}\n";
+
+static const char* stage_defines[POST_STAGE_COUNT] = { "#define STAGE_BLOOM\n", "#define STAGE_TONEMAP\n", "#define STAGE_FXAA\n" };
+static const bool stage_neighbourhood[POST_STAGE_COUNT] = { false, false, true };
+
+enum { POST_PASS_DOWNSAMPLE, POST_PASS_UPSAMPLE, POST_PASS_STAGES };
+
+static GLuint post_build(const char* fragment_shader_text, const char* label)
+{
+    const GLuint program = program_build(post_vertex_shader_text, fragment_shader_text, false);
+    if (!program)
+    {
+        fprintf(stderr, "post_process: can't build the %s program\n", label);
+        return 0;
+    }
+    gl_debug_label(GL_PROGRAM, program, label);
+    gl_state_use_program(program);
+    glUniform1i(glGetUniformLocation(program, "source"), 0);
+    glUniform1i(glGetUniformLocation(program, "bloom"), 1);
+    return program;
+}
+
+bool post_process_init(PostProcess* post, RenderTargetPool* pool)
+{
+    memset(post, 0, sizeof(*post));
+    post->pool = pool;
+    post->downsample_program = post_build(downsample_fragment_shader_text, "bloom downsample");
+    post->upsample_program = post_build(upsample_fragment_shader_text, "bloom upsample");
+    if (!post->downsample_program || !post->upsample_program)
+        return false;
+    post->downsample_texel_location = glGetUniformLocation(post->downsample_program, "texel");
+    post->downsample_scale_location = glGetUniformLocation(post->downsample_program, "sourceScale");
+    post->downsample_threshold_location = glGetUniformLocation(post->downsample_program, "threshold");
+    post->upsample_texel_location = glGetUniformLocation(post->upsample_program, "texel");
+    gl_state_use_program(post->upsample_program);
+    glUniform2f(glGetUniformLocation(post->upsample_program, "sourceScale"), 1.f, 1.f);
+    return true;
+}
+
+void post_process_destroy(PostProcess* post)
+{
+    for (int i = 0; i < 1 << POST_STAGE_COUNT; ++i)
+        if (post->programs[i].program)
+            glDeleteProgram(post->programs[i].program);
+    if (post->downsample_program)
+        glDeleteProgram(post->downsample_program);
+    if (post->upsample_program)
+        glDeleteProgram(post->upsample_program);
+    memset(post, 0, sizeof(*post));
+}
+
+// The program for a draw of the stages in "mix", built the first time it's asked for
+static const PostProgram* post_program(PostProcess* post, unsigned mix)
+{
+    PostProgram* p = &post->programs[mix];
+    if (p->program || p->failed)
+        return p->program ? p : NULL;
+    char text[8192];
+    int length = snprintf(text, sizeof(text), "#version 330\n");
+    for (int s = 0; s < POST_STAGE_COUNT; ++s)
+        if (mix & (1u << s))
+            length += snprintf(text + length, sizeof(text) - length, "%s", stage_defines[s]);
+    snprintf(text + length, sizeof(text) - length, "%s", stage_fragment_shader_text);
+    p->program = post_build(text, "post stages");
+    p->failed = !p->program;
+    if (p->failed)
+        return NULL;
+    p->texel_location = glGetUniformLocation(p->program, "texel");
+    p->scale_location = glGetUniformLocation(p->program, "sourceScale");
+    p->exposure_location = glGetUniformLocation(p->program, "exposure");
+    p->bloom_intensity_location = glGetUniformLocation(p->program, "bloomIntensity");
+    return p;
+}
+
+static void post_pass_execute(void* user, const FrameGraph* graph, int pass)
+{
+    const PostPass* p = (const PostPass*)user;
+    PostProcess* post = p->post;
+    const PooledTarget* source = frame_graph_gl_target(graph, p->source);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, source->texture);
+    const float texel[2] = { 1.f / source->width, 1.f / source->height };
+    if (p->kind == POST_PASS_DOWNSAMPLE)
+    {
+        gl_state_use_program(post->downsample_program);
+        glUniform2f(post->downsample_texel_location, texel[0], texel[1]);
+        glUniform2f(post->downsample_scale_location, p->scale[0], p->scale[1]);
+        glUniform1f(post->downsample_threshold_location, p->threshold);
+    }
+    else if (p->kind == POST_PASS_UPSAMPLE)
+    {
+        // Onto what the level already holds
+        gl_state_use_program(post->upsample_program);
+        glUniform2f(post->upsample_texel_location, texel[0], texel[1]);
+        gl_state_enable(GL_BLEND, true);
+        gl_state_blend_func(GL_ONE, GL_ONE);
+    }
+    else
+    {
+        const PostProgram* program = &post->programs[p->mix];     // built before the graph ran
+        gl_state_use_program(program->program);
+        if (p->bloom >= 0)
+        {
+            gl_state_bind_texture(1, GL_TEXTURE_2D, frame_graph_gl_target(graph, p->bloom)->texture);
+            glUniform1f(program->bloom_intensity_location, p->settings->bloom_intensity);
+        }
+        glUniform2f(program->texel_location, texel[0], texel[1]);
+        glUniform2f(program->scale_location, p->scale[0], p->scale[1]);
+        glUniform1f(program->exposure_location, p->settings->exposure);
+        ++post->merged_draws;
+    }
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+    gl_state_enable(GL_BLEND, false);
+    ++post->draws;
+}
+
+static PostPass* post_add_pass(PostProcess* post, const char* name, int kind, const PostSettings* settings, int* index)
+{
+    *index = frame_graph_add_pass(&post->graph, name, post_pass_execute, NULL);
+    if (*index < 0)
+        return NULL;
+    PostPass* p = &post->passes[*index];
+    memset(p, 0, sizeof(*p));
+    p->post = post;
+    p->settings = settings;
+    p->kind = kind;
+    p->bloom = -1;
+    p->scale[0] = p->scale[1] = 1.f;
+    post->graph.passes[*index].user = p;
+    return p;
+}
+
+bool post_process_run(PostProcess* post, const PostSettings* settings, const RenderTarget* scene, int width, int height,
+    GLuint framebuffer, int target_width, int target_height)
+{
+    post->draws = 0;
+    post->merged_draws = 0;
+
+    // The depth only served the scene's tests: a tiled GPU needn't write it out
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, scene->framebuffer);
+    frame_graph_gl_invalidate(GL_DEPTH_STENCIL_ATTACHMENT);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_BLEND, false);
+
+    FrameGraph* g = &post->graph;
+    frame_graph_reset(g);
+    const PooledTarget scene_target = { scene->color, scene->framebuffer, scene->width, scene->height, scene->color_format, true, 0 };
+    const PooledTarget output_target = { 0, framebuffer, target_width, target_height, 0, true, 0 };
+    const int scene_resource = frame_graph_import(g, "scene", NULL, (uintptr_t)&scene_target, false);
+    const int output_resource = frame_graph_import(g, "output", NULL, (uintptr_t)&output_target, true);
+    const float scene_scale[2] = { (float)width / scene->width, (float)height / scene->height };
+
+    // Bloom's chain, whether or not a stage asks for it: the graph drops it when none does
+    int levels[POST_BLOOM_LEVELS];
+    int level_count = 0;
+    for (int w = width >> 1, h = height >> 1; level_count < POST_BLOOM_LEVELS && w >= 2 && h >= 2; w >>= 1, h >>= 1)
+    {
+        const FrameGraphTextureDesc desc = { w, h, GL_RGBA16F, 8 };
+        levels[level_count] = frame_graph_create_texture(g, "bloom", &desc);
+        int index = -1;
+        PostPass* p = post_add_pass(post, "bloom downsample", POST_PASS_DOWNSAMPLE, settings, &index);
+        if (p)
+        {
+            p->source = level_count ? levels[level_count - 1] : scene_resource;
+            if (!level_count)
+            {
+                p->scale[0] = scene_scale[0];
+                p->scale[1] = scene_scale[1];
+                p->threshold = settings->bloom_threshold;
+            }
+            frame_graph_read(g, index, p->source, FRAME_GRAPH_SAMPLED);
+            frame_graph_write(g, index, levels[level_count], FRAME_GRAPH_ATTACHMENT);
+        }
+        ++level_count;
+    }
+    for (int i = level_count - 1; i > 0; --i)
+    {
+        int index = -1;
+        PostPass* p = post_add_pass(post, "bloom upsample", POST_PASS_UPSAMPLE, settings, &index);
+        if (!p)
+            break;
+        p->source = levels[i];
+        frame_graph_read(g, index, levels[i], FRAME_GRAPH_SAMPLED);
+        frame_graph_read(g, index, levels[i - 1], FRAME_GRAPH_ATTACHMENT);
+        frame_graph_write(g, index, levels[i - 1], FRAME_GRAPH_ATTACHMENT);
+    }
+
+    // Per-pixel stages join the draw before them; a neighbourhood stage starts a draw of its own
+    unsigned mixes[POST_MAX_DRAWS] = { 0 };
+    int draw_count = 1;
+    for (int s = 0; s < POST_STAGE_COUNT; ++s)
+    {
+        if (!settings->stages[s] || (s == POST_STAGE_BLOOM && !level_count))
+            continue;
+        if (stage_neighbourhood[s] && mixes[draw_count - 1] && draw_count < POST_MAX_DRAWS)
+            ++draw_count;
+        mixes[draw_count - 1] |= 1u << s;
+    }
+
+    int source = scene_resource;
+    bool display_values = false;    // tonemapped by an earlier draw: the rest can be 8-bit
+    for (int d = 0; d < draw_count; ++d)
+    {
+        if (!post_program(post, mixes[d]))
+            return false;
+        int index = -1;
+        PostPass* p = post_add_pass(post, "post stages", POST_PASS_STAGES, settings, &index);
+        if (!p)
+            break;
+        p->mix = mixes[d];
+        p->source = source;
+        if (source == scene_resource)
+        {
+            p->scale[0] = scene_scale[0];
+            p->scale[1] = scene_scale[1];
+        }
+        frame_graph_read(g, index, source, FRAME_GRAPH_SAMPLED);
+        if (mixes[d] & (1u << POST_STAGE_BLOOM))
+        {
+            p->bloom = levels[0];
+            frame_graph_read(g, index, levels[0], FRAME_GRAPH_SAMPLED);
+        }
+        display_values = display_values || (mixes[d] & (1u << POST_STAGE_TONEMAP));
+        if (d == draw_count - 1)
+            frame_graph_write(g, index, output_resource, FRAME_GRAPH_ATTACHMENT);
+        else
+        {
+            const FrameGraphTextureDesc desc = { width, height, display_values ? (uint32_t)GL_RGBA8 : (uint32_t)GL_RGBA16F,
+                display_values ? 4u : 8u };
+            source = frame_graph_create_texture(g, "post", &desc);
+            frame_graph_write(g, index, source, FRAME_GRAPH_ATTACHMENT);
+        }
+    }
+
+    if (!frame_graph_compile(g))
+    {
+        fprintf(stderr, "post_process: the chain's graph doesn't compile\n");
+        return false;
+    }
+    post->culled = (uint32_t)g->culled_count;
+    return frame_graph_gl_execute(g, post->pool);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/frame_graph.h"
+#include "gl/render_target.h"
+#include "gl/render_target_pool.h"
+
+#include <stdint.h>
+
+// Post-processing: bloom, tonemapping and FXAA between the scene's HDR colour
+// and the window, with every intermediate texture from a RenderTargetPool.
+//
+// The chain is a list of stages in order, each either per-pixel (it reads its
+// input at the pixel it writes: bloom's composite, the tonemap) or a
+// neighbourhood stage (it reads around the pixel: FXAA). Per-pixel stages
+// merge into the draw before them, so a draw is one neighbourhood stage or
+// the plain source fetch, then every per-pixel stage up to the next
+// neighbourhood one, compiled into one program (built the first time that
+// mix is used). Bloom + tonemap + FXAA is two fullscreen draws; without FXAA
+// it's one. The last draw writes the destination at its size, sampling the
+// source's scene-sized corner, so it is also the upscale --dynamic-res needs.
+//
+// Bloom first runs its own chain: a thresholded downsample of the scene to
+// half size, POST_BLOOM_LEVELS - 1 further halvings, then back up adding each
+// level's tent-filtered blur onto the next larger one. The composite stage
+// adds the half-size result.
+//
+// Every draw is a pass of a frame graph (core/frame_graph.h) run by
+// gl/frame_graph_gl.h: bloom's passes are always declared and culled when no
+// stage reads their result, and the textures between passes are transients
+// it places on pooled targets. Tiled GPUs keep a framebuffer's contents in
+// tile memory and write them out (or read them back in) unless told not to:
+// where glInvalidateFramebuffer is available the scene's depth is dropped
+// before post-processing reads its colour, and every target a pass
+// overwrites whole is invalidated first, so nothing is loaded only to be
+// painted over.
+
+#define POST_BLOOM_LEVELS 5             // half size down to 1/32
+#define POST_MAX_DRAWS 4                // merged draws in one chain
+
+typedef enum PostStage
+{
+    POST_STAGE_BLOOM,                   // adds the bloom chain's result
+    POST_STAGE_TONEMAP,                 // exposure, a filmic curve (ACES fit) and gamma 2.2: HDR to display values
+    POST_STAGE_FXAA,                    // edge antialiasing on display values
+    POST_STAGE_COUNT
+} PostStage;
+
+typedef struct PostSettings
+{
+    bool stages[POST_STAGE_COUNT];      // which run, in PostStage order
+    float exposure;
+    float bloom_threshold;              // scene brightness where bloom starts (with a soft knee half as wide)
+    float bloom_intensity;
+} PostSettings;
+
+// One draw's mix of stages, compiled together
+typedef struct PostProgram
+{
+    GLuint program;             // 0 until the mix is first run
+    bool failed;                // it didn't build: not tried again
+    GLint texel_location;
+    GLint scale_location;
+    GLint exposure_location;
+    GLint bloom_intensity_location;
+} PostProgram;
+
+// What a pass of the chain draws, for its FrameGraphExecute
+typedef struct PostPass
+{
+    struct PostProcess* post;
+    const PostSettings* settings;
+    int kind;                   // POST_PASS_*
+    int source;                 // graph resources it samples
+    int bloom;                  // -1 unless its mix adds bloom
+    unsigned mix;               // POST_PASS_STAGES: a bit per PostStage
+    float scale[2];             // of the source that holds the picture
+    float threshold;            // POST_PASS_DOWNSAMPLE: 0 past the first level
+} PostPass;
+
+typedef struct PostProcess
+{
+    PostProgram programs[1 << POST_STAGE_COUNT];    // indexed by the mix: a bit per PostStage
+    GLuint downsample_program;
+    GLint downsample_texel_location;
+    GLint downsample_scale_location;
+    GLint downsample_threshold_location;
+    GLuint upsample_program;
+    GLint upsample_texel_location;
+    RenderTargetPool* pool;
+    FrameGraph graph;                   // rebuilt for every run
+    PostPass passes[FRAME_GRAPH_MAX_PASSES];
+    uint32_t draws;                     // fullscreen draws in the last chain, bloom's included
+    uint32_t merged_draws;              // of those, the stage chain's
+    uint32_t culled;                    // passes declared but not needed
+} PostProcess;
+
+#define POST_PROCESS_DEFAULTS { { true, true, true }, 1.f, 1.f, 0.3f }
+
+// Builds the bloom programs (the stage mixes are built as they're first run). Logs and returns false when one fails.
+bool post_process_init(PostProcess* post, RenderTargetPool* pool);
+void post_process_destroy(PostProcess* post);
+
+// Runs the chain over the "width" x "height" corner of "scene" (its depth is invalidated first: nothing may read it
+// after this), writing a "target_width" x "target_height" viewport of "framebuffer" whole. Uses a VAO bound by the
+// caller (the draws have no attributes) and leaves blending and depth testing off, "framebuffer" bound.
+// Returns false when a program or target was unavailable; the destination is then left as it was.
+bool post_process_run(PostProcess* post, const PostSettings* settings, const RenderTarget* scene, int width, int height,
+    GLuint framebuffer, int target_width, int target_height);
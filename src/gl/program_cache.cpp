@@ -0,0 +1,187 @@
+#include "gl/program_cache.h"
+#include "gl/gl_ext.h"
+#include "gl/shader.h"
+
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t program_cache_magic = 0x42505247u;   // "GRPB"
+static const uint64_t fnv_offset = 14695981039346656037ull;
+
+// File layout: header, then "length" bytes of driver binary
+typedef struct ProgramCacheHeader
+{
+    uint32_t magic;
+    uint32_t format;    // GLenum binary format reported by the driver
+    uint64_t key;       // repeated so a renamed/corrupt file is detected
+    uint32_t length;
+    uint32_t reserved;
+} ProgramCacheHeader;
+
+uint64_t program_cache_hash(uint64_t seed, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static uint64_t hash_string(uint64_t seed, const char* s)
+{
+    // Include the terminator so "ab" + "c" and "a" + "bc" hash differently
+    return s ? program_cache_hash(seed, s, strlen(s) + 1) : program_cache_hash(seed, "", 1);
+}
+
+void program_cache_init(ProgramCache* cache, const char* dir)
+{
+    memset(cache, 0, sizeof(*cache));
+    snprintf(cache->dir, sizeof(cache->dir), "%s", dir);
+
+    uint64_t h = fnv_offset;
+    h = hash_string(h, (const char*)glGetString(GL_VENDOR));
+    h = hash_string(h, (const char*)glGetString(GL_RENDERER));
+    h = hash_string(h, (const char*)glGetString(GL_VERSION));
+    cache->driver_hash = h;
+
+    GLint formats = 0;
+    if (glGetProgramBinary && glProgramBinary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    cache->supported = formats > 0;
+
+    if (cache->supported)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(cache->dir, ec);
+        if (ec)
+        {
+            fprintf(stderr, "program_cache: can't create %s: %s\n", cache->dir, ec.message().c_str());
+            cache->supported = false;
+        }
+    }
+}
+
+static void entry_path(const ProgramCache* cache, uint64_t key, char* path, size_t size)
+{
+    snprintf(path, size, "%s/%016llx.bin", cache->dir, (unsigned long long)key);
+}
+
+static GLuint load_entry(ProgramCache* cache, uint64_t key, bool separable)
+{
+    if (!cache->supported)
+        return 0;
+
+    char path[320];
+    entry_path(cache, key, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return 0;
+
+    ProgramCacheHeader header;
+    void* binary = NULL;
+    GLuint program = 0;
+    if (fread(&header, sizeof(header), 1, f) == 1 && header.magic == program_cache_magic && header.key == key)
+    {
+        binary = malloc(header.length);
+        if (binary && fread(binary, 1, header.length, f) == header.length)
+        {
+            program = glCreateProgram();
+            if (separable)
+                gl_ext.ProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+            glProgramBinary(program, header.format, binary, (GLsizei)header.length);
+
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (!linked)
+            {
+                // Driver refused its own binary - recompile from source below
+                glDeleteProgram(program);
+                program = 0;
+                ++cache->rejects;
+            }
+        }
+    }
+    free(binary);
+    fclose(f);
+    return program;
+}
+
+GLuint program_cache_load(ProgramCache* cache, uint64_t key)
+{
+    return load_entry(cache, key, false);
+}
+
+GLuint program_cache_load_stage(ProgramCache* cache, uint64_t key)
+{
+    return load_entry(cache, key, true);
+}
+
+void program_cache_store(const ProgramCache* cache, uint64_t key, GLuint program)
+{
+    if (!cache->supported)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    void* binary = malloc(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, NULL, &format, binary);
+
+    // Write to a temporary name and rename, so a crash mid-write never leaves a truncated entry behind
+    char path[320], temp[330];
+    entry_path(cache, key, path, sizeof(path));
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE* f = fopen(temp, "wb");
+    if (f)
+    {
+        ProgramCacheHeader header = { program_cache_magic, format, key, (uint32_t)length, 0 };
+        const bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(binary, 1, length, f) == (size_t)length;
+        fclose(f);
+
+        std::error_code ec;
+        if (ok)
+            std::filesystem::rename(temp, path, ec);
+        if (!ok || ec)
+            std::filesystem::remove(temp, ec);
+    }
+    free(binary);
+}
+
+uint64_t program_cache_key(const ProgramCache* cache, const char* vertex_source, const char* fragment_source)
+{
+    return hash_string(hash_string(cache->driver_hash, vertex_source), fragment_source);
+}
+
+uint64_t program_cache_stage_key(const ProgramCache* cache, GLenum type, const char* source)
+{
+    const uint32_t stage[2] = { 0x50455453u, (uint32_t)type };  // "STEP" + the stage: never a whole program's key
+    return hash_string(program_cache_hash(cache->driver_hash, stage, sizeof(stage)), source);
+}
+
+GLuint program_cache_get(ProgramCache* cache, const char* vertex_source, const char* fragment_source)
+{
+    if (!cache->supported)
+        return program_build(vertex_source, fragment_source, false);
+
+    const uint64_t key = program_cache_key(cache, vertex_source, fragment_source);
+    GLuint program = program_cache_load(cache, key);
+    if (program)
+    {
+        ++cache->hits;
+        return program;
+    }
+
+    ++cache->misses;
+    program = program_build(vertex_source, fragment_source, true);
+    if (program)
+        program_cache_store(cache, key, program);
+    return program;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+//
+// Entries are keyed by a 64-bit hash of every shader source plus the
+// GL_VENDOR/GL_RENDERER/GL_VERSION strings, so a driver update or a source
+// edit simply misses instead of loading a stale binary. Drivers may still
+// reject a binary they produced (after an update that kept the version
+// string, for instance); that falls back to compiling from source and
+// overwrites the entry.
+
+typedef struct ProgramCache
+{
+    char dir[260];          // directory holding <key>.bin files
+    uint64_t driver_hash;   // hash of the vendor/renderer/version strings
+    bool supported;         // GL 4.1 / ARB_get_program_binary with at least one binary format
+    size_t hits;            // programs loaded from a binary
+    size_t misses;          // programs compiled from source (no entry, or the entry was rejected)
+    size_t rejects;         // entries the driver refused, then recompiled
+} ProgramCache;
+
+// Needs a current context. Creates "dir" if it does not exist.
+void program_cache_init(ProgramCache* cache, const char* dir);
+
+// Returns a linked program for the vertex + fragment pair, from the cache when possible
+// and compiled (then stored) otherwise. Returns 0 if the sources fail to link.
+GLuint program_cache_get(ProgramCache* cache, const char* vertex_source, const char* fragment_source);
+
+// The lookup and store steps of program_cache_get, for callers that compile asynchronously.
+// program_cache_load returns 0 when there is no usable entry (counting a reject if the driver
+// refused it); program_cache_store expects a program linked with the retrievable hint.
+uint64_t program_cache_key(const ProgramCache* cache, const char* vertex_source, const char* fragment_source);
+GLuint program_cache_load(ProgramCache* cache, uint64_t key);
+void program_cache_store(const ProgramCache* cache, uint64_t key, GLuint program);
+
+// The same for separable single-stage programs (gl/program_pipeline.h). Their keys never match a whole program's,
+// and the load marks the program separable before handing the driver its binary.
+uint64_t program_cache_stage_key(const ProgramCache* cache, GLenum type, const char* source);
+GLuint program_cache_load_stage(ProgramCache* cache, uint64_t key);
+
+// 64-bit FNV-1a, exposed so other caches can derive compatible keys
+uint64_t program_cache_hash(uint64_t seed, const void* data, size_t size);
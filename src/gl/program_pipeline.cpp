@@ -0,0 +1,187 @@
+#include "gl/program_pipeline.h"
+
+#include "gl/gl_ext.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <string.h>
+
+bool program_pipelines_supported(void)
+{
+    return gl_ext.ARB_separate_shader_objects;
+}
+
+void program_pipelines_init(ProgramPipelines* pp, ProgramCache* cache)
+{
+    memset(pp, 0, sizeof(*pp));
+    pp->cache = cache;
+    pp->parallel = gl_ext.KHR_parallel_shader_compile;
+}
+
+void program_pipelines_destroy(ProgramPipelines* pp)
+{
+    for (int i = 0; i < pp->pipeline_count; ++i)
+    {
+        if (pp->pipelines[i].pipeline)
+            gl_state_delete_program_pipelines(1, &pp->pipelines[i].pipeline);
+    }
+    for (int i = 0; i < pp->stage_count; ++i)
+    {
+        StageProgram* st = &pp->stages[i];
+        if (st->state == PROGRAM_STATE_COMPILING || st->state == PROGRAM_STATE_LINKING)
+            glDeleteShader(st->shader);
+        if (st->state == PROGRAM_STATE_LINKING || st->state == PROGRAM_STATE_READY)
+            glDeleteProgram(st->program);
+    }
+    memset(pp, 0, sizeof(*pp));
+}
+
+int program_pipelines_stage(ProgramPipelines* pp, GLenum type, const char* source)
+{
+    // Without a cache the key is still a hash of the source; the driver part just stays zero
+    static const ProgramCache no_cache = {};
+    const uint64_t key = program_cache_stage_key(pp->cache ? pp->cache : &no_cache, type, source);
+    for (int i = 0; i < pp->stage_count; ++i)
+    {
+        if (pp->stages[i].cache_key == key && pp->stages[i].type == type)
+            return i;
+    }
+    if (pp->stage_count == PROGRAM_PIPELINE_MAX_STAGES)
+    {
+        fprintf(stderr, "program_pipeline: more than %d stages\n", PROGRAM_PIPELINE_MAX_STAGES);
+        return -1;
+    }
+
+    const int id = pp->stage_count++;
+    StageProgram* st = &pp->stages[id];
+    memset(st, 0, sizeof(*st));
+    st->type = type;
+    st->source = source;
+    st->cache_key = key;
+    if (pp->cache)
+    {
+        st->program = program_cache_load_stage(pp->cache, key);
+        if (st->program)
+        {
+            ++pp->cache->hits;
+            st->state = PROGRAM_STATE_READY;
+            return id;
+        }
+        ++pp->cache->misses;
+    }
+    st->shader = shader_compile(type, source);
+    st->state = PROGRAM_STATE_COMPILING;
+    return id;
+}
+
+int program_pipelines_add(ProgramPipelines* pp, int vertex_stage, int fragment_stage)
+{
+    if (vertex_stage < 0 || fragment_stage < 0)
+        return -1;
+    for (int i = 0; i < pp->pipeline_count; ++i)
+    {
+        if (pp->pipelines[i].stages[0] == vertex_stage && pp->pipelines[i].stages[1] == fragment_stage)
+            return i;
+    }
+    if (pp->pipeline_count == PROGRAM_PIPELINE_MAX_PIPELINES)
+    {
+        fprintf(stderr, "program_pipeline: more than %d pipelines\n", PROGRAM_PIPELINE_MAX_PIPELINES);
+        return -1;
+    }
+    const int id = pp->pipeline_count++;
+    pp->pipelines[id].stages[0] = vertex_stage;
+    pp->pipelines[id].stages[1] = fragment_stage;
+    pp->pipelines[id].pipeline = 0;
+    return id;
+}
+
+// Non-blocking completion checks; without the extension every query is "done" (and blocks inside the driver)
+static bool stage_done(const ProgramPipelines* pp, const StageProgram* st)
+{
+    if (!pp->parallel)
+        return true;
+    GLint done = GL_FALSE;
+    if (st->state == PROGRAM_STATE_COMPILING)
+        glGetShaderiv(st->shader, GL_COMPLETION_STATUS_KHR, &done);
+    else
+        glGetProgramiv(st->program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+GLuint program_pipelines_create(const ProgramPipelines* pp, int id)
+{
+    if (program_pipelines_state(pp, id) == PROGRAM_STATE_FAILED)
+        return 0;
+    const ProgramPipeline* p = &pp->pipelines[id];
+    const StageProgram* vertex = &pp->stages[p->stages[0]];
+    const StageProgram* fragment = &pp->stages[p->stages[1]];
+    if (vertex->state != PROGRAM_STATE_READY || fragment->state != PROGRAM_STATE_READY)
+        return 0;
+    GLuint pipeline = 0;
+    gl_ext.GenProgramPipelines(1, &pipeline);
+    gl_ext.UseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertex->program);
+    gl_ext.UseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragment->program);
+    return pipeline;
+}
+
+void program_pipelines_poll(ProgramPipelines* pp)
+{
+    const bool retrievable = pp->cache && pp->cache->supported;
+    for (int i = 0; i < pp->stage_count; ++i)
+    {
+        StageProgram* st = &pp->stages[i];
+        if (st->state == PROGRAM_STATE_COMPILING && stage_done(pp, st))
+        {
+            st->program = stage_program_link_begin(st->shader, retrievable);
+            st->state = PROGRAM_STATE_LINKING;
+            ++pp->links;
+        }
+        if (st->state == PROGRAM_STATE_LINKING && stage_done(pp, st))
+        {
+            st->program = program_link_finish(st->program, &st->shader, 1);
+            st->state = st->program ? PROGRAM_STATE_READY : PROGRAM_STATE_FAILED;
+            if (st->program && retrievable)
+                program_cache_store(pp->cache, st->cache_key, st->program);
+        }
+    }
+    for (int i = 0; i < pp->pipeline_count; ++i)
+    {
+        if (!pp->pipelines[i].pipeline)
+            pp->pipelines[i].pipeline = program_pipelines_create(pp, i);
+    }
+}
+
+ProgramState program_pipelines_state(const ProgramPipelines* pp, int id)
+{
+    if (id < 0 || id >= pp->pipeline_count)
+        return PROGRAM_STATE_FAILED;
+    const ProgramPipeline* p = &pp->pipelines[id];
+    if (pp->stages[p->stages[0]].state == PROGRAM_STATE_FAILED || pp->stages[p->stages[1]].state == PROGRAM_STATE_FAILED)
+        return PROGRAM_STATE_FAILED;
+    if (p->pipeline)
+        return PROGRAM_STATE_READY;
+    return pp->stages[p->stages[0]].state == PROGRAM_STATE_COMPILING || pp->stages[p->stages[1]].state == PROGRAM_STATE_COMPILING
+        ? PROGRAM_STATE_COMPILING : PROGRAM_STATE_LINKING;
+}
+
+GLuint program_pipelines_get(const ProgramPipelines* pp, int id)
+{
+    return program_pipelines_state(pp, id) == PROGRAM_STATE_READY ? pp->pipelines[id].pipeline : 0;
+}
+
+GLuint program_pipelines_stage_program(const ProgramPipelines* pp, int id, int stage)
+{
+    if (program_pipelines_state(pp, id) == PROGRAM_STATE_FAILED)
+        return 0;
+    const StageProgram* st = &pp->stages[pp->pipelines[id].stages[stage]];
+    return st->state == PROGRAM_STATE_READY ? st->program : 0;
+}
+
+void program_pipelines_print(const ProgramPipelines* pp, FILE* out)
+{
+    int ready = 0;
+    for (int i = 0; i < pp->pipeline_count; ++i)
+        ready += pp->pipelines[i].pipeline != 0;
+    fprintf(out, "program pipelines: %d of %d ready, from %d separable stages (%u linked from source)\n", ready,
+        pp->pipeline_count, pp->stage_count, pp->links);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/program_cache.h"
+#include "gl/shader_manager.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Programs as pipelines of separable stages (GL_ARB_separate_shader_objects,
+// core in 4.1). Every stage is its own program, compiled and linked once
+// however many pipelines use it, and glBindProgramPipeline puts a vertex and
+// a fragment stage together without a link. Whole programs need a link per
+// pair: V vertex and F fragment variants cost V * F links there, V + F here.
+//
+// Stages are found by a hash of their source, so asking for the same source
+// twice shares the stage. They build like ShaderManager's programs: through
+// the program binary cache, and in the background with
+// GL_KHR_parallel_shader_compile, advanced by program_pipelines_poll.
+//
+// Pipeline objects are containers, not shared between contexts: another
+// context sharing the stage programs makes pipelines of its own with
+// program_pipelines_create. Uniforms belong to the stage programs; set them
+// there (program_pipelines_stage_program), and draw with no program in use.
+
+#define PROGRAM_PIPELINE_MAX_STAGES 64
+#define PROGRAM_PIPELINE_MAX_PIPELINES 64
+
+typedef struct StageProgram
+{
+    GLenum type;                // GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+    const char* source;         // borrowed until the stage has built
+    uint64_t cache_key;
+    GLuint shader;              // while compiling and linking
+    GLuint program;             // separable; valid once READY
+    ProgramState state;
+} StageProgram;
+
+typedef struct ProgramPipeline
+{
+    int stages[2];              // vertex and fragment stage ids
+    GLuint pipeline;            // in the context that polled it ready
+} ProgramPipeline;
+
+typedef struct ProgramPipelines
+{
+    ProgramCache* cache;        // may be NULL
+    bool parallel;              // driver compiles in the background
+    int stage_count;
+    StageProgram stages[PROGRAM_PIPELINE_MAX_STAGES];
+    int pipeline_count;
+    ProgramPipeline pipelines[PROGRAM_PIPELINE_MAX_PIPELINES];
+    unsigned int links;         // glLinkProgram calls made: one per stage built from source
+} ProgramPipelines;
+
+// True when the context has separable programs and pipeline objects
+bool program_pipelines_supported(void);
+
+// Needs a current context where program_pipelines_supported
+void program_pipelines_init(ProgramPipelines* pp, ProgramCache* cache);
+
+// Deletes the stage programs and, in the current context, the pipelines
+void program_pipelines_destroy(ProgramPipelines* pp);
+
+// The id of the stage compiled from "source" (borrowed until it has built), shared with any earlier request for
+// the same source. Starts building it if it's new. Returns -1 (logged) when the table is full.
+int program_pipelines_stage(ProgramPipelines* pp, GLenum type, const char* source);
+
+// A pipeline of a vertex and a fragment stage, and its id (shared with an earlier request for the same pair,
+// -1 when the table is full). The pipeline object is made once both stages are ready.
+int program_pipelines_add(ProgramPipelines* pp, int vertex_stage, int fragment_stage);
+
+// Advances the building stages as far as they go without waiting, and makes the pipelines that have both
+// stages ready. Call once per frame, like shader_manager_poll.
+void program_pipelines_poll(ProgramPipelines* pp);
+
+// READY once the pipeline object exists, FAILED when one of its stages failed to build
+ProgramState program_pipelines_state(const ProgramPipelines* pp, int id);
+
+// The pipeline object, or 0 while it isn't ready
+GLuint program_pipelines_get(const ProgramPipelines* pp, int id);
+
+// Stage program "stage" (0 vertex, 1 fragment) of pipeline "id", for its uniforms; 0 while it isn't ready
+GLuint program_pipelines_stage_program(const ProgramPipelines* pp, int id, int stage);
+
+// A new pipeline object for ready pipeline "id" in the current context (one sharing the stage programs).
+// The caller deletes it, with gl_state_delete_program_pipelines.
+GLuint program_pipelines_create(const ProgramPipelines* pp, int id);
+
+// Stages, pipelines and the links they took
+void program_pipelines_print(const ProgramPipelines* pp, FILE* out);
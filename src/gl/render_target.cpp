@@ -0,0 +1,159 @@
+#include "gl/render_target.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static bool render_target_complete(const RenderTarget* rt, GLuint framebuffer)
+{
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, framebuffer);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+        fprintf(stderr, "render_target: %dx%d (%d samples) framebuffer incomplete (0x%04X)\n", rt->width, rt->height,
+            rt->samples, status);
+    return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+bool render_target_init(RenderTarget* rt, int width, int height, GLenum color_format, bool float_depth, int samples)
+{
+    memset(rt, 0, sizeof(*rt));
+    rt->width = width;
+    rt->height = height;
+    rt->color_format = color_format;
+    rt->float_depth = float_depth;
+    rt->samples = samples > 1 ? samples : 1;
+    const GLenum depth_format = float_depth ? GL_DEPTH32F_STENCIL8 : GL_DEPTH24_STENCIL8;
+
+    // Textures rather than renderbuffers so later passes can sample the colour and texelFetch the depth
+    glGenTextures(1, &rt->color);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, rt->color);
+    if (color_format == GL_RGBA16F)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+    else if (color_format == GL_R11F_G11F_B10F)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, width, height, 0, GL_RGB, GL_HALF_FLOAT, NULL);
+    else if (color_format == GL_RGB10_A2)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2, width, height, 0, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, NULL);
+    else
+    {
+        color_format = rt->color_format = GL_RGBA8;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    gl_memory_texture(rt->color, GPU_MEMORY_RENDER_TARGETS, color_format, width, height, 1, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    gl_debug_label(GL_TEXTURE, rt->color, "offscreen color");
+
+    if (rt->samples == 1)
+    {
+        glGenTextures(1, &rt->depth_stencil);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, rt->depth_stencil);
+        if (float_depth)
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, NULL);
+        else
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+        gl_memory_texture(rt->depth_stencil, GPU_MEMORY_RENDER_TARGETS, depth_format, width, height, 1, 1, 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        gl_debug_label(GL_TEXTURE, rt->depth_stencil, "offscreen depth");
+    }
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &rt->color_framebuffer);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, rt->color_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rt->color, 0);
+    if (rt->samples == 1)
+    {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, rt->depth_stencil, 0);
+        rt->framebuffer = rt->color_framebuffer;
+        gl_debug_label(GL_FRAMEBUFFER, rt->framebuffer, "offscreen");
+    }
+    else
+    {
+        // The samples live in renderbuffers: nothing samples them, they're only resolved
+        gl_debug_label(GL_FRAMEBUFFER, rt->color_framebuffer, "offscreen resolve");
+        glGenRenderbuffers(1, &rt->sample_color);
+        glBindRenderbuffer(GL_RENDERBUFFER, rt->sample_color);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, rt->samples, color_format, width, height);
+        gl_memory_renderbuffer(rt->sample_color, color_format, width, height, rt->samples);
+        glGenRenderbuffers(1, &rt->sample_depth_stencil);
+        glBindRenderbuffer(GL_RENDERBUFFER, rt->sample_depth_stencil);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, rt->samples, depth_format, width, height);
+        gl_memory_renderbuffer(rt->sample_depth_stencil, depth_format, width, height, rt->samples);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        if (render_target_complete(rt, rt->color_framebuffer))
+        {
+            glGenFramebuffers(1, &rt->framebuffer);
+            gl_state_bind_framebuffer(GL_FRAMEBUFFER, rt->framebuffer);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rt->sample_color);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rt->sample_depth_stencil);
+            gl_debug_label(GL_FRAMEBUFFER, rt->framebuffer, "offscreen samples");
+        }
+    }
+    const bool complete = rt->framebuffer && render_target_complete(rt, rt->framebuffer);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete)
+    {
+        render_target_destroy(rt);
+        return false;
+    }
+    return true;
+}
+
+void render_target_destroy(RenderTarget* rt)
+{
+    if (rt->framebuffer != rt->color_framebuffer)
+        gl_state_delete_framebuffers(1, &rt->framebuffer);
+    gl_state_delete_framebuffers(1, &rt->color_framebuffer);
+    gl_memory_delete_renderbuffers(1, &rt->sample_color);
+    gl_memory_delete_renderbuffers(1, &rt->sample_depth_stencil);
+    gl_state_delete_textures(1, &rt->color);
+    gl_state_delete_textures(1, &rt->depth_stencil);
+    memset(rt, 0, sizeof(*rt));
+}
+
+void render_target_resolve(const RenderTarget* rt, int width, int height)
+{
+    if (rt->samples == 1)
+        return;
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, rt->framebuffer);
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, rt->color_framebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    // Only the resolved colour is read from here on; the next frame clears the samples
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, rt->framebuffer);
+    if (gl_ext.ARB_invalidate_subdata)
+    {
+        const GLenum attachments[2] = { GL_COLOR_ATTACHMENT0, GL_DEPTH_STENCIL_ATTACHMENT };
+        gl_ext.InvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, 2, attachments);
+    }
+}
+
+void render_target_discard_depth(const RenderTarget* rt)
+{
+    if (rt->samples != 1 || !gl_ext.ARB_invalidate_subdata)
+        return;
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, rt->framebuffer);
+    const GLenum attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+    gl_ext.InvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, 1, &attachment);
+}
+
+void render_target_bind(const RenderTarget* rt)
+{
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, rt->framebuffer);
+}
+
+void render_target_upscale_bilinear(void* user, const RenderTarget* source, int width, int height, GLuint framebuffer,
+    int target_width, int target_height)
+{
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, source->color_framebuffer);
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    const bool same = width == target_width && height == target_height;
+    glBlitFramebuffer(0, 0, width, height, 0, 0, target_width, target_height, GL_COLOR_BUFFER_BIT, same ? GL_NEAREST : GL_LINEAR);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Offscreen framebuffer: a color texture (RGBA8, or RGBA16F for post-processing's
+// HDR input) and a 24/8 (or 32F/8) depth-stencil texture, both of which can be
+// sampled once a pass is done (the colour by gl/post_process.h, the depth to build
+// the Hi-Z pyramid in gl/hiz.h). Used by the headless benchmark so the render loop runs
+// at a fixed resolution without a visible window or a swap chain, and by any
+// pass that reads the scene's depth.
+//
+// With samples > 1 the scene draws into multisampled colour and depth
+// renderbuffers instead, and render_target_resolve blits the drawn corner's
+// colour into the single-sample texture for whatever reads it next (the
+// upscale, post-processing). The samples are then invalidated: a tiled GPU
+// never writes them out, so MSAA only costs bandwidth in the scene's passes.
+// There's no depth texture to sample then.
+
+typedef struct RenderTarget
+{
+    GLuint framebuffer;         // drawn into: the multisampled one with samples > 1
+    GLuint color;               // texture, linear filtered; the resolved colour with samples > 1
+    GLuint depth_stencil;       // texture, 0 with samples > 1
+    GLuint color_framebuffer;   // the colour texture's: resolved into and read from (the same as framebuffer at 1x)
+    GLuint sample_color;        // samples > 1: the renderbuffers behind framebuffer
+    GLuint sample_depth_stencil;
+    int width;
+    int height;
+    GLenum color_format;        // GL_RGBA8 or GL_RGBA16F; on ES GL_RGB10_A2, or GL_R11F_G11F_B10F in half the bytes
+    bool float_depth;           // GL_DEPTH32F_STENCIL8, for reversed Z
+    int samples;                // 1 without MSAA
+} RenderTarget;
+
+// Needs a current context. "samples" above GL_MAX_SAMPLES fails. Returns false (and logs the status) if the
+// framebuffer is incomplete.
+bool render_target_init(RenderTarget* rt, int width, int height, GLenum color_format, bool float_depth, int samples);
+void render_target_destroy(RenderTarget* rt);
+
+// With samples > 1: the "width" x "height" corner's colour into the texture, then the samples invalidated. The
+// draw framebuffer is left the multisampled one. Nothing to do (and no cost) at 1x.
+void render_target_resolve(const RenderTarget* rt, int width, int height);
+
+// The depth and stencil invalidated once the frame is done with them, so a tiled GPU doesn't store them to memory
+// (resolve already has at > 1x). The draw framebuffer is left the target's.
+void render_target_discard_depth(const RenderTarget* rt);
+
+// Binds the target for drawing (and reading, e.g. for glReadPixels)
+void render_target_bind(const RenderTarget* rt);
+
+// Scales the "width" x "height" corner of "source" (drawn at a lower resolution, see core/resolution_scaler.h)
+// up to cover "target_width" x "target_height" of "framebuffer". The hook where a sharpening or temporal upscaler
+// goes; "user" is its state.
+typedef void (*RenderTargetUpscale)(void* user, const RenderTarget* source, int width, int height, GLuint framebuffer,
+    int target_width, int target_height);
+
+// The default upscale: a bilinear blit (a plain copy at the same size). "user" is unused.
+void render_target_upscale_bilinear(void* user, const RenderTarget* source, int width, int height, GLuint framebuffer,
+    int target_width, int target_height);
@@ -0,0 +1,123 @@
+#include "gl/render_target_pool.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void render_target_pool_init(RenderTargetPool* pool, GLResources* resources)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->resources = resources;
+}
+
+static void pooled_target_free(RenderTargetPool* pool, PooledTarget* t)
+{
+    gl_state_delete_framebuffers(1, &t->framebuffer);
+    // A pass earlier in the frame, or a frame still in flight, may be sampling it
+    if (pool->resources)
+        gl_resources_retire(pool->resources, GL_RESOURCE_TEXTURE, t->texture);
+    else
+        gl_state_delete_textures(1, &t->texture);
+    memset(t, 0, sizeof(*t));
+    --pool->live;
+}
+
+void render_target_pool_destroy(RenderTargetPool* pool)
+{
+    for (int i = 0; i < RENDER_TARGET_POOL_SIZE; ++i)
+        if (pool->entries[i].texture)
+            pooled_target_free(pool, &pool->entries[i]);
+}
+
+static bool pooled_target_create(PooledTarget* t, int width, int height, GLenum format)
+{
+    glGenTextures(1, &t->texture);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, t->texture);
+    if (gl_ext.ARB_texture_storage)
+        gl_ext.TexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, (GLint)format, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    gl_memory_texture(t->texture, GPU_MEMORY_RENDER_TARGETS, format, width, height, 1, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl_debug_label(GL_TEXTURE, t->texture, "pooled target");
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &t->framebuffer);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, t->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t->texture, 0);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    t->width = width;
+    t->height = height;
+    t->format = format;
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "render_target_pool: %dx%d format 0x%04X framebuffer incomplete (0x%04X)\n", width, height,
+            format, status);
+        return false;
+    }
+    return true;
+}
+
+const PooledTarget* render_target_pool_acquire(RenderTargetPool* pool, int width, int height, GLenum format)
+{
+    PooledTarget* free_slot = NULL;
+    for (int i = 0; i < RENDER_TARGET_POOL_SIZE; ++i)
+    {
+        PooledTarget* t = &pool->entries[i];
+        if (!t->texture)
+        {
+            if (!free_slot)
+                free_slot = t;
+            continue;
+        }
+        if (!t->in_use && t->width == width && t->height == height && t->format == format)
+        {
+            t->in_use = true;
+            t->last_used = pool->frame;
+            return t;
+        }
+    }
+    if (!free_slot)
+    {
+        fprintf(stderr, "render_target_pool: all %d targets in use\n", RENDER_TARGET_POOL_SIZE);
+        return NULL;
+    }
+    const GLuint bound = gl_state.draw_framebuffer;
+    ++pool->live;
+    const bool complete = pooled_target_create(free_slot, width, height, format);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, bound);
+    if (!complete)
+    {
+        pooled_target_free(pool, free_slot);
+        return NULL;
+    }
+    ++pool->created;
+    free_slot->in_use = true;
+    free_slot->last_used = pool->frame;
+    return free_slot;
+}
+
+void render_target_pool_release(RenderTargetPool* pool, const PooledTarget* target)
+{
+    if (target)
+        pool->entries[target - pool->entries].in_use = false;
+}
+
+void render_target_pool_end_frame(RenderTargetPool* pool)
+{
+    for (int i = 0; i < RENDER_TARGET_POOL_SIZE; ++i)
+    {
+        PooledTarget* t = &pool->entries[i];
+        if (t->texture && !t->in_use && pool->frame - t->last_used > RENDER_TARGET_POOL_IDLE_FRAMES)
+            pooled_target_free(pool, t);
+    }
+    ++pool->frame;
+}
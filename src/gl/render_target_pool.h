@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/gl_resources.h"
+
+#include <stdint.h>
+
+// Transient render targets: colour textures a pass only needs for part of a
+// frame (post-processing's bloom chain and the results between its draws).
+// Acquiring one hands out an idle entry of exactly the same size and format,
+// so after the first frame at a size nothing is allocated; releasing it lets
+// the next pass of the frame, or the next frame, reuse it. An entry nobody
+// acquired for RENDER_TARGET_POOL_IDLE_FRAMES frames (a size the window has
+// left) is freed, its texture retired until the GPU is past it.
+//
+// Entries keep their slot for life, so the pointers acquire returns stay
+// valid until release.
+
+#define RENDER_TARGET_POOL_SIZE 32
+#define RENDER_TARGET_POOL_IDLE_FRAMES 60
+
+typedef struct PooledTarget
+{
+    GLuint texture;             // 0: a free slot
+    GLuint framebuffer;         // the texture as its only colour attachment
+    int width;
+    int height;
+    GLenum format;              // internal format: GL_RGBA8, GL_RGBA16F, GL_R11F_G11F_B10F, ...
+    bool in_use;
+    uint64_t last_used;         // the pool's frame it was last acquired in
+} PooledTarget;
+
+typedef struct RenderTargetPool
+{
+    PooledTarget entries[RENDER_TARGET_POOL_SIZE];
+    uint64_t frame;
+    uint32_t created;           // targets allocated so far: flat once every size in use has been seen
+    uint32_t live;              // entries holding a texture
+    GLResources* resources;     // retires freed textures (NULL: deleted at once)
+} RenderTargetPool;
+
+void render_target_pool_init(RenderTargetPool* pool, GLResources* resources);
+void render_target_pool_destroy(RenderTargetPool* pool);
+
+// An idle "width" x "height" target of "format" (linear filtered, clamped to its edge), allocated when none is.
+// NULL when every slot is taken or the framebuffer is incomplete (logged). The caller's until released; its
+// contents are whatever the last user left.
+const PooledTarget* render_target_pool_acquire(RenderTargetPool* pool, int width, int height, GLenum format);
+void render_target_pool_release(RenderTargetPool* pool, const PooledTarget* target);
+
+// Frees what has been idle too long. Once a frame, after its last release.
+void render_target_pool_end_frame(RenderTargetPool* pool);
@@ -0,0 +1,187 @@
+#include "gl/screen_capture.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+static const GLbitfield persistent_flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+void screen_capture_init(ScreenCapture* cap, const char* record_path, int fps)
+{
+    static_assert(SCREEN_CAPTURE_SLOTS <= SCREEN_RECORDER_MAX_SLOTS, "a recorder slot per buffer");
+    for (int i = 0; i < SCREEN_CAPTURE_SLOTS; ++i)
+    {
+        cap->buffers[i] = 0;
+        cap->sizes[i] = 0;
+        cap->pixels[i] = NULL;
+        cap->fences[i] = NULL;
+        cap->shots[i][0] = '\0';
+    }
+    // glad only loads glBufferStorage when the context is 4.4 or newer
+    cap->persistent = glBufferStorage != NULL;
+    cap->next = 0;
+    cap->head = 0;
+    cap->copies = 0;
+    cap->shot[0] = '\0';
+    cap->captured = 0;
+    cap->dropped = 0;
+    cap->cpu_seconds = 0.0;
+    cap->calls = 0;
+    screen_recorder_init(&cap->recorder, record_path, fps);
+}
+
+// The slot's buffer at "size" bytes: a new one in place of one of another size (the slot is free)
+static bool buffer_reserve(ScreenCapture* cap, int slot, size_t size)
+{
+    if (cap->buffers[slot] && cap->sizes[slot] == size)
+        return true;
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, cap->buffers[slot]);
+    if (cap->persistent && cap->pixels[slot])
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    else
+        free(cap->pixels[slot]);
+    gl_state_delete_buffers(1, &cap->buffers[slot]);
+    cap->pixels[slot] = NULL;
+    cap->sizes[slot] = 0;
+
+    // Immutable storage can't be respecified: a new buffer either way
+    glGenBuffers(1, &cap->buffers[slot]);
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, cap->buffers[slot]);
+    if (cap->persistent)
+    {
+        glBufferStorage(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, NULL, persistent_flags);
+        cap->pixels[slot] = (uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size, persistent_flags);
+    }
+    else
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_READ);
+        cap->pixels[slot] = (uint8_t*)malloc(size);
+    }
+    gl_memory_buffer(cap->buffers[slot], GPU_MEMORY_STAGING, size);
+    gl_debug_label(GL_BUFFER, cap->buffers[slot], "screen capture");
+    if (!cap->pixels[slot])
+        return false;
+    cap->sizes[slot] = size;
+    return true;
+}
+
+// The oldest copy in flight to the recorder, once its fence says it's done ("wait": however long that takes)
+static bool hand_over(ScreenCapture* cap, bool wait)
+{
+    const int slot = cap->head;
+    GLenum status = glClientWaitSync(cap->fences[slot], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(cap->fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);     // 1 ms slices
+    const bool done = status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    if (!done && !wait)
+        return false;
+    glDeleteSync(cap->fences[slot]);
+    cap->fences[slot] = NULL;
+    cap->head = (cap->head + 1) % SCREEN_CAPTURE_SLOTS;
+    --cap->copies;
+
+    if (!done)
+        return true;        // GL_WAIT_FAILED: lost, and the slot's free again
+    const size_t size = 4 * (size_t)cap->widths[slot] * cap->heights[slot];
+    if (!cap->persistent)
+    {
+        gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, cap->buffers[slot]);
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_READ_BIT);
+        if (!mapped)
+            return true;
+        memcpy(cap->pixels[slot], mapped, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    screen_recorder_submit(&cap->recorder, slot, cap->pixels[slot], cap->widths[slot], cap->heights[slot],
+        cap->shots[slot][0] ? cap->shots[slot] : NULL);
+    return true;
+}
+
+// A copy of the frame into the next slot, for the recording or for "shot". False when the slot isn't free.
+static bool copy_frame(ScreenCapture* cap, GLuint framebuffer, GLenum read_buffer, int width, int height,
+    const char* shot)
+{
+    const int slot = cap->next;
+    if (cap->fences[slot] || screen_recorder_busy(&cap->recorder, slot)
+        || !buffer_reserve(cap, slot, 4 * (size_t)width * height))
+        return false;
+
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(read_buffer);
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, cap->buffers[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    cap->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    cap->widths[slot] = width;
+    cap->heights[slot] = height;
+    snprintf(cap->shots[slot], sizeof(cap->shots[slot]), "%s", shot ? shot : "");
+    cap->next = (cap->next + 1) % SCREEN_CAPTURE_SLOTS;
+    ++cap->copies;
+    return true;
+}
+
+void screen_capture_frame(ScreenCapture* cap, GLuint framebuffer, GLenum read_buffer, int width, int height,
+    const char* screenshot)
+{
+    const auto start = std::chrono::steady_clock::now();
+    while (cap->copies && hand_over(cap, false))
+    {
+    }
+    if (screenshot)
+        snprintf(cap->shot, sizeof(cap->shot), "%s", screenshot);
+    if (width > 0 && height > 0)
+    {
+        if (cap->recorder.recording && !cap->recorder.failed)
+        {
+            if (copy_frame(cap, framebuffer, read_buffer, width, height, NULL))
+                ++cap->captured;
+            else
+                ++cap->dropped;
+        }
+        if (cap->shot[0] && copy_frame(cap, framebuffer, read_buffer, width, height, cap->shot))
+            cap->shot[0] = '\0';
+    }
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);     // glReadPixels elsewhere reads into client memory
+    cap->cpu_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ++cap->calls;
+}
+
+void screen_capture_destroy(ScreenCapture* cap)
+{
+    while (cap->copies)
+        hand_over(cap, true);
+    screen_recorder_destroy(&cap->recorder);   // done with the pixels before they're unmapped
+    for (int i = 0; i < SCREEN_CAPTURE_SLOTS; ++i)
+    {
+        if (!cap->buffers[i])
+            continue;
+        gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, cap->buffers[i]);
+        if (cap->persistent && cap->pixels[i])
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        else
+            free(cap->pixels[i]);
+        cap->pixels[i] = NULL;
+    }
+    gl_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+    gl_state_delete_buffers(SCREEN_CAPTURE_SLOTS, cap->buffers);
+    for (int i = 0; i < SCREEN_CAPTURE_SLOTS; ++i)
+        cap->buffers[i] = 0;
+}
+
+void screen_capture_print(const ScreenCapture* cap, FILE* out)
+{
+    const ScreenRecorder* rec = &cap->recorder;
+    if (rec->recording)
+        fprintf(out, "recording: %u frames to %s (%u dropped, %u skipped after a resize), %.1f MB, %.2f ms a frame "
+            "to encode\n", rec->frames, rec->path, cap->dropped, rec->skipped, rec->bytes / (1024.0 * 1024.0),
+            rec->frames ? 1000.0 * rec->encode_seconds / (rec->frames + rec->screenshots) : 0.0);
+    if (rec->screenshots)
+        fprintf(out, "screenshots: %u\n", rec->screenshots);
+    fprintf(out, "capture: %.3f ms a frame on the render thread (%s)\n",
+        cap->calls ? 1000.0 * cap->cpu_seconds / cap->calls : 0.0,
+        cap->persistent ? "persistently mapped" : "mapped and copied");
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/screen_recorder.h"
+
+// Screenshots and recordings read back without a stall. Each capture copies
+// the finished frame into a pixel pack buffer with glReadPixels and fences it:
+// the copy is queued like any other command, so presenting goes on at once. A
+// later frame finds the fence signalled without waiting and hands the buffer
+// to the recorder's thread (core/screen_recorder.h), which encodes and writes
+// it while the next frames draw; the buffer is reused once that's done.
+//
+// Where glBufferStorage is there (4.4), the buffers are mapped persistently
+// and coherently, and the recorder reads the pixels straight out of the
+// mapping: the render thread's part is the glReadPixels call, a fence and a
+// poll, a few microseconds. Without it a finished buffer is mapped, copied
+// into memory of its own and unmapped, a memcpy of the frame on the render
+// thread (about a millisecond at 1080p).
+//
+// The buffers go round in order: a copy, its encoding and its reuse, so when
+// the next one's still busy, every one is. The frame isn't captured then and
+// is counted as dropped (a screenshot waits for the next frame instead):
+// recording never slows the frames down, and a slow encoder (PNG at 60 fps)
+// shows up as drops. A buffer is (re)allocated at the frame's size when it's
+// next free, so a resize costs nothing until then.
+
+#define SCREEN_CAPTURE_SLOTS 4
+
+typedef struct ScreenCapture
+{
+    ScreenRecorder recorder;    // the slots are the buffers'
+    GLuint buffers[SCREEN_CAPTURE_SLOTS];  // pixel pack buffers; 0 until first used
+    size_t sizes[SCREEN_CAPTURE_SLOTS];    // each one's bytes
+    uint8_t* pixels[SCREEN_CAPTURE_SLOTS]; // what the recorder reads: the persistent mapping, or the copy
+    GLsync fences[SCREEN_CAPTURE_SLOTS];   // after each copy in flight; NULL otherwise
+    int widths[SCREEN_CAPTURE_SLOTS], heights[SCREEN_CAPTURE_SLOTS];  // of each copy in flight
+    char shots[SCREEN_CAPTURE_SLOTS][SCREEN_RECORDER_PATH];    // the screenshot each copy is for; empty for a frame
+    bool persistent;            // glBufferStorage's mappings, not copies
+    int next;                   // the slot the next copy goes to
+    int head;                   // the oldest copy in flight
+    int copies;                 // in flight
+    char shot[SCREEN_RECORDER_PATH];   // a screenshot still waiting for a free slot; empty for none
+
+    // Totals over the run
+    unsigned int captured;      // recording frames copied
+    unsigned int dropped;       // recording frames no slot was free for
+    double cpu_seconds;         // the render thread's time in screen_capture_frame
+    unsigned int calls;
+} ScreenCapture;
+
+// Needs a current context. "record_path" is as screen_recorder_init takes it: NULL for screenshots only.
+void screen_capture_init(ScreenCapture* cap, const char* record_path, int fps);
+
+// Waits for the copies in flight and writes them too, then stops the recorder and frees the buffers
+void screen_capture_destroy(ScreenCapture* cap);
+
+// Once a frame, when it's finished: hands the copies that are done to the recorder, then copies the "width" x
+// "height" frame in "read_buffer" of "framebuffer" (GL_BACK of 0 for the window) for the recording, if there is
+// one, and into a PNG at "screenshot" unless that's NULL. Leaves GL_PIXEL_PACK_BUFFER unbound.
+void screen_capture_frame(ScreenCapture* cap, GLuint framebuffer, GLenum read_buffer, int width, int height,
+    const char* screenshot);
+
+void screen_capture_print(const ScreenCapture* cap, FILE* out);
@@ -0,0 +1,159 @@
+#include "gl/shader.h"
+
+#include "gl/gl_ext.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Default precisions GLSL ES leaves out: float in fragment shaders, and every stage's samplers other than the 2D and
+// cube ones, and images
+static const char es_precisions[] =
+    "precision highp float;\n"
+    "precision highp int;\n"
+    "precision highp sampler3D;\n"
+    "precision highp sampler2DArray;\n"
+    "precision highp sampler2DShadow;\n"
+    "precision highp isampler2D;\n"
+    "precision highp usampler2D;\n"
+    "precision highp usampler2DArray;\n";
+static const char es_precisions_310[] =
+    "precision highp sampler2DMS;\n"
+    "precision highp image2D;\n"
+    "precision highp iimage2D;\n"
+    "precision highp uimage2D;\n"
+    "precision highp image2DArray;\n"
+    "precision highp image3D;\n";
+
+// The desktop gl_PerVertex redeclaration separable stages carry: ES before 3.2 doesn't take it, and without it the
+// built-ins are the same
+static const char per_vertex_block[] = "out gl_PerVertex { vec4 gl_Position; };";
+
+// Desktop GLSL for an ES context (--gles): the #version line becomes the context's "#version 3x0 es", the default
+// precisions go after any #extension lines that follow it, and a #line keeps the driver's line numbers the
+// source's. NULL (the source used as it is) when it doesn't start with a #version line.
+static char* es_source(const char* source)
+{
+    if (strncmp(source, "#version", 8))
+        return NULL;
+    const char* head = strchr(source, '\n');
+    int lines = 1;
+    while (head && !strncmp(head + 1, "#extension", 10))
+    {
+        head = strchr(head + 1, '\n');
+        ++lines;
+    }
+    if (!head)
+        return NULL;
+    const char* extensions = strchr(source, '\n') + 1;
+    const char* body = head + 1;
+
+    const size_t size = strlen(source) + sizeof(es_precisions) + sizeof(es_precisions_310) + 64;
+    char* text = (char*)malloc(size);
+    if (!text)
+        return NULL;
+    int used = snprintf(text, size, "#version %d es\n%.*s%s%s#line %d\n", gl_ext.es_version,
+        (int)(body - extensions), extensions, es_precisions, gl_ext.es_version >= 310 ? es_precisions_310 : "",
+        lines + 1);
+    for (const char* block; (block = strstr(body, per_vertex_block)); body = block + sizeof(per_vertex_block) - 1)
+    {
+        memcpy(text + used, body, block - body);
+        used += (int)(block - body);
+    }
+    strcpy(text + used, body);
+    return text;
+}
+
+GLuint shader_compile(GLenum type, const char* source)
+{
+    char* translated = gl_ext.es ? es_source(source) : NULL;
+    const GLuint shader = glCreateShader(type);     // Creates a new shader of the given type
+    source = translated ? translated : source;
+    glShaderSource(shader, 1, &source, NULL);       // (shader, number of strings, pointer to the source string, length auto)
+    glCompileShader(shader);
+    free(translated);
+    return shader;
+}
+
+GLuint program_link_begin(const GLuint* shaders, int shader_count, bool retrievable)
+{
+    const GLuint program = glCreateProgram();
+    for (int i = 0; i < shader_count; ++i)
+        glAttachShader(program, shaders[i]);
+
+    // Must be set before linking for glGetProgramBinary to return anything
+    if (retrievable && glProgramParameteri)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    glLinkProgram(program);
+    return program;
+}
+
+GLuint stage_program_link_begin(GLuint shader, bool retrievable)
+{
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    gl_ext.ProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    if (retrievable)
+        gl_ext.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    return program;
+}
+
+// The driver's compile or link messages, when there are any
+static void print_log(GLuint object, bool program)
+{
+    char log[4096];
+    GLsizei length = 0;
+    if (program)
+        glGetProgramInfoLog(object, sizeof(log), &length, log);
+    else
+        glGetShaderInfoLog(object, sizeof(log), &length, log);
+    if (length > 0)
+        fprintf(stderr, "%s\n", log);
+}
+
+GLuint program_link_finish(GLuint program, const GLuint* shaders, int shader_count)
+{
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    for (int i = 0; i < shader_count; ++i)
+    {
+        if (!linked)
+        {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+            if (!compiled)
+            {
+                fprintf(stderr, "shader: stage %d failed to compile:\n", i);
+                print_log(shaders[i], false);
+            }
+        }
+        glDetachShader(program, shaders[i]);
+        glDeleteShader(shaders[i]);
+    }
+
+    if (!linked)
+    {
+        fprintf(stderr, "shader: program failed to link\n");
+        print_log(program, true);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+GLuint program_link(const GLuint* shaders, int shader_count, bool retrievable)
+{
+    return program_link_finish(program_link_begin(shaders, shader_count, retrievable), shaders, shader_count);
+}
+
+GLuint program_build(const char* vertex_source, const char* fragment_source, bool retrievable)
+{
+    const GLuint shaders[2] = {
+        shader_compile(GL_VERTEX_SHADER, vertex_source),
+        shader_compile(GL_FRAGMENT_SHADER, fragment_source)
+    };
+    return program_link(shaders, 2, retrievable);
+}
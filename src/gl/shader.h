@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Compiles one shader stage from source. Returns the shader name; compile
+// status is left for the caller (or the link step) to report.
+GLuint shader_compile(GLenum type, const char* source);
+
+// Attaches the given stages, links, and returns the program (0 if linking failed).
+// The shaders are detached and deleted afterwards since the program keeps its own copy.
+GLuint program_link(const GLuint* shaders, int shader_count, bool retrievable);
+
+// program_link split in two for asynchronous compilation: begin issues glLinkProgram and
+// returns at once, finish (once the link has completed) cleans up the stages and
+// returns the program, or 0 after deleting it if linking failed. A failure logs the driver's
+// messages for the stages that didn't compile and for the link.
+GLuint program_link_begin(const GLuint* shaders, int shader_count, bool retrievable);
+GLuint program_link_finish(GLuint program, const GLuint* shaders, int shader_count);
+
+// program_link_begin for a single stage, linked as a separable program (GL_ARB_separate_shader_objects) to be
+// combined with other stages in a program pipeline. Finish it with program_link_finish(program, &shader, 1).
+GLuint stage_program_link_begin(GLuint shader, bool retrievable);
+
+// shader_compile + program_link for the common vertex + fragment pair
+GLuint program_build(const char* vertex_source, const char* fragment_source, bool retrievable);
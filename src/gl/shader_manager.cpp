@@ -0,0 +1,375 @@
+#include "gl/shader_manager.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+#include "gl/shader_permutation.h"
+
+#include <GLFW/glfw3.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+void shader_manager_init(ShaderManager* sm, ProgramCache* cache, GLuint max_threads)
+{
+    memset(sm, 0, sizeof(*sm));
+    sm->cache = cache;
+    sm->parallel = gl_ext.KHR_parallel_shader_compile;
+    file_watcher_init(&sm->watcher);
+    if (sm->parallel)
+        gl_ext.MaxShaderCompilerThreadsKHR(max_threads);
+}
+
+// Drops a rebuild in flight, if any, and its sources
+static void abandon_reload(ManagedProgram* mp)
+{
+    if (mp->reload_state == PROGRAM_STATE_COMPILING || mp->reload_state == PROGRAM_STATE_LINKING)
+    {
+        glDeleteShader(mp->reload_shaders[0]);
+        glDeleteShader(mp->reload_shaders[1]);
+    }
+    if (mp->reload_state == PROGRAM_STATE_LINKING)
+        glDeleteProgram(mp->reload_program);
+    for (int s = 0; s < 2; ++s)
+    {
+        free(mp->reload_sources[s]);
+        mp->reload_sources[s] = NULL;
+    }
+    mp->reload_program = 0;
+    mp->reload_state = PROGRAM_STATE_READY;
+}
+
+void shader_manager_destroy(ShaderManager* sm)
+{
+    for (int i = 0; i < sm->count; ++i)
+    {
+        ManagedProgram* mp = &sm->programs[i];
+        if (mp->state == PROGRAM_STATE_COMPILING || mp->state == PROGRAM_STATE_LINKING)
+        {
+            glDeleteShader(mp->shaders[0]);
+            glDeleteShader(mp->shaders[1]);
+        }
+        if (mp->program)
+            glDeleteProgram(mp->program);
+        abandon_reload(mp);
+        free(mp->owned_sources[0]);
+        free(mp->owned_sources[1]);
+    }
+    memset(sm, 0, sizeof(*sm));
+}
+
+// Non-blocking completion check; without the extension every query is "done" (and blocks inside the driver)
+static bool shader_done(const ShaderManager* sm, GLuint shader)
+{
+    if (!sm->parallel)
+        return true;
+    GLint done = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+static bool program_done(const ShaderManager* sm, GLuint program)
+{
+    if (!sm->parallel)
+        return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+static void mark_ready(ManagedProgram* mp, GLuint program)
+{
+    mp->program = program;
+    mp->state = program ? PROGRAM_STATE_READY : PROGRAM_STATE_FAILED;
+    mp->ready_time = glfwGetTime();
+}
+
+int shader_manager_submit(ShaderManager* sm, const char* vertex_source, const char* fragment_source)
+{
+    if (sm->count == SHADER_MANAGER_MAX_PROGRAMS)
+    {
+        fprintf(stderr, "shader_manager: more than %d programs\n", SHADER_MANAGER_MAX_PROGRAMS);
+        return -1;
+    }
+
+    const int id = sm->count++;
+    ManagedProgram* mp = &sm->programs[id];
+    memset(mp, 0, sizeof(*mp));
+    mp->vertex_source = vertex_source;
+    mp->fragment_source = fragment_source;
+    mp->submit_time = glfwGetTime();
+    mp->watches[0] = mp->watches[1] = -1;
+    mp->reload_state = PROGRAM_STATE_READY;
+
+    if (sm->cache)
+    {
+        mp->cache_key = program_cache_key(sm->cache, vertex_source, fragment_source);
+        const GLuint cached = program_cache_load(sm->cache, mp->cache_key);
+        if (cached)
+        {
+            ++sm->cache->hits;
+            mark_ready(mp, cached);
+            return id;
+        }
+        ++sm->cache->misses;
+    }
+
+    // With the extension these return immediately and the driver compiles on its worker threads
+    mp->shaders[0] = shader_compile(GL_VERTEX_SHADER, vertex_source);
+    mp->shaders[1] = shader_compile(GL_FRAGMENT_SHADER, fragment_source);
+    mp->state = PROGRAM_STATE_COMPILING;
+    return id;
+}
+
+static const char* stage_source(const ManagedProgram* mp, int stage)
+{
+    return stage == 0 ? mp->vertex_source : mp->fragment_source;
+}
+
+// The rebuild becomes the program: its sources are the stages' from now on, and the old program goes
+static void finish_reload(ShaderManager* sm, ManagedProgram* mp, GLuint program)
+{
+    const int id = (int)(mp - sm->programs);
+    mp->reload_state = PROGRAM_STATE_READY;
+    mp->reload_program = 0;
+    if (!program)
+    {
+        ++sm->reload_failures;
+        fprintf(stderr, "shader_manager: program %d: the edited shaders didn't build, still drawing the previous ones\n", id);
+        abandon_reload(mp);
+        return;
+    }
+    for (int s = 0; s < 2; ++s)
+    {
+        if (!mp->reload_sources[s])
+            continue;
+        free(mp->owned_sources[s]);
+        mp->owned_sources[s] = mp->reload_sources[s];
+        mp->reload_sources[s] = NULL;
+        if (s == 0)
+            mp->vertex_source = mp->owned_sources[s];
+        else
+            mp->fragment_source = mp->owned_sources[s];
+    }
+    if (mp->state == PROGRAM_STATE_COMPILING || mp->state == PROGRAM_STATE_LINKING)
+    {
+        // Edited before the first build was even done: that one is out of date already
+        glDeleteShader(mp->shaders[0]);
+        glDeleteShader(mp->shaders[1]);
+        if (mp->state == PROGRAM_STATE_LINKING)
+            glDeleteProgram(mp->program);
+        mp->ready_time = glfwGetTime();
+    }
+    else if (mp->program)
+        glDeleteProgram(mp->program);   // deferred by GL while a context still has it in use
+    mp->program = program;
+    mp->state = PROGRAM_STATE_READY;
+    mp->cache_key = mp->reload_key;
+    ++sm->reloads;
+    printf("shader_manager: program %d reloaded in %.0f ms\n", id, (glfwGetTime() - mp->reload_time) * 1000.0);
+}
+
+// Rebuilds "mp" with "sources" (taken over; NULL keeps a stage as it is), replacing any rebuild in flight
+static void start_reload(ShaderManager* sm, ManagedProgram* mp, char* sources[2])
+{
+    abandon_reload(mp);
+    mp->reload_sources[0] = sources[0];
+    mp->reload_sources[1] = sources[1];
+    const char* vertex = sources[0] ? sources[0] : mp->vertex_source;
+    const char* fragment = sources[1] ? sources[1] : mp->fragment_source;
+    mp->reload_time = glfwGetTime();
+    mp->reload_key = 0;
+    if (sm->cache)
+    {
+        mp->reload_key = program_cache_key(sm->cache, vertex, fragment);
+        const GLuint cached = program_cache_load(sm->cache, mp->reload_key);
+        if (cached)
+        {
+            ++sm->cache->hits;
+            finish_reload(sm, mp, cached);
+            return;
+        }
+        ++sm->cache->misses;
+    }
+    mp->reload_shaders[0] = shader_compile(GL_VERTEX_SHADER, vertex);
+    mp->reload_shaders[1] = shader_compile(GL_FRAGMENT_SHADER, fragment);
+    mp->reload_state = PROGRAM_STATE_COMPILING;
+}
+
+// Reads each watched stage of "mp" whose file changed (every watched one when "force") into "sources", NULL for
+// the rest. True when one of them differs from the source the stage is using.
+static bool read_changed(ShaderManager* sm, ManagedProgram* mp, char* sources[2], bool force)
+{
+    bool changed = false;
+    for (int s = 0; s < 2; ++s)
+    {
+        sources[s] = NULL;
+        if (!file_watcher_take(&sm->watcher, mp->watches[s]) && !force)
+            continue;
+        char* text = mp->watches[s] >= 0 ? file_watcher_read(sm->watcher.files[mp->watches[s]].path, NULL) : NULL;
+        if (text && mp->permutation)
+        {
+            char* master = text;
+            text = shader_permutation_compose(mp->permutation, s, master, mp->variant);
+            free(master);
+        }
+        if (text && strcmp(text, stage_source(mp, s)) != 0)
+        {
+            sources[s] = text;
+            changed = true;
+        }
+        else
+            free(text);     // unreadable, or saved without an edit
+    }
+    return changed;
+}
+
+bool shader_manager_watch(ShaderManager* sm, int id, const char* vertex_path, const char* fragment_path)
+{
+    if (id < 0 || id >= sm->count)
+        return false;
+    ManagedProgram* mp = &sm->programs[id];
+    const char* paths[2] = { vertex_path, fragment_path };
+    bool ok = true;
+    for (int s = 0; s < 2; ++s)
+    {
+        if (!paths[s])
+            continue;
+        FILE* f = fopen(paths[s], "rb");
+        if (f)
+            fclose(f);
+        else if ((f = fopen(paths[s], "wb")) != NULL)
+        {
+            // Nothing to load yet: start the file off as the program is now, or as the master its variant comes from
+            fputs(mp->permutation ? mp->permutation->sources[s] : stage_source(mp, s), f);
+            fclose(f);
+            printf("shader_manager: wrote %s, edit it to rebuild program %d\n", paths[s], id);
+        }
+        else
+            fprintf(stderr, "shader_manager: can't create %s\n", paths[s]);
+        mp->watches[s] = file_watcher_add(&sm->watcher, paths[s]);
+        ok = ok && mp->watches[s] >= 0;
+    }
+
+    // The files win over the submitted sources from the start
+    char* sources[2];
+    if (read_changed(sm, mp, sources, true))
+        start_reload(sm, mp, sources);
+    sm->watch_time = glfwGetTime();
+    return ok;
+}
+
+void shader_manager_poll(ShaderManager* sm)
+{
+    const bool retrievable = sm->cache && sm->cache->supported;
+
+    // Edited files start rebuilds; the old programs draw until they're done
+    const double now = glfwGetTime();
+    if (sm->watcher.count && now - sm->watch_time >= SHADER_MANAGER_WATCH_INTERVAL)
+    {
+        sm->watch_time = now;
+        const bool changed = file_watcher_poll(&sm->watcher) > 0;
+        for (int i = 0; changed && i < sm->count; ++i)
+        {
+            char* sources[2];
+            if (read_changed(sm, &sm->programs[i], sources, false))
+                start_reload(sm, &sm->programs[i], sources);
+        }
+    }
+
+    for (int i = 0; i < sm->count; ++i)
+    {
+        ManagedProgram* mp = &sm->programs[i];
+
+        if (mp->reload_state == PROGRAM_STATE_COMPILING && shader_done(sm, mp->reload_shaders[0])
+            && shader_done(sm, mp->reload_shaders[1]))
+        {
+            mp->reload_program = program_link_begin(mp->reload_shaders, 2, retrievable);
+            mp->reload_state = PROGRAM_STATE_LINKING;
+        }
+        if (mp->reload_state == PROGRAM_STATE_LINKING && program_done(sm, mp->reload_program))
+        {
+            const GLuint program = program_link_finish(mp->reload_program, mp->reload_shaders, 2);
+            if (program && retrievable)
+                program_cache_store(sm->cache, mp->reload_key, program);
+            mp->reload_state = PROGRAM_STATE_READY;     // the stages are gone either way
+            finish_reload(sm, mp, program);
+        }
+
+        if (mp->state == PROGRAM_STATE_COMPILING && shader_done(sm, mp->shaders[0]) && shader_done(sm, mp->shaders[1]))
+        {
+            mp->program = program_link_begin(mp->shaders, 2, retrievable);
+            mp->state = PROGRAM_STATE_LINKING;
+        }
+
+        if (mp->state == PROGRAM_STATE_LINKING && program_done(sm, mp->program))
+        {
+            const GLuint program = program_link_finish(mp->program, mp->shaders, 2);
+            if (program && retrievable)
+                program_cache_store(sm->cache, mp->cache_key, program);
+            mark_ready(mp, program);
+        }
+    }
+}
+
+GLuint shader_manager_wait(ShaderManager* sm, int id)
+{
+    if (id < 0 || id >= sm->count)
+        return 0;
+
+    ManagedProgram* mp = &sm->programs[id];
+    while (mp->state == PROGRAM_STATE_COMPILING || mp->state == PROGRAM_STATE_LINKING)
+    {
+        shader_manager_poll(sm);
+        if (mp->state != PROGRAM_STATE_READY && mp->state != PROGRAM_STATE_FAILED)
+            std::this_thread::yield();
+    }
+    return mp->program;
+}
+
+ProgramState shader_manager_state(const ShaderManager* sm, int id)
+{
+    return id >= 0 && id < sm->count ? sm->programs[id].state : PROGRAM_STATE_FAILED;
+}
+
+GLuint shader_manager_program(const ShaderManager* sm, int id)
+{
+    return shader_manager_state(sm, id) == PROGRAM_STATE_READY ? sm->programs[id].program : 0;
+}
+
+bool shader_manager_idle(const ShaderManager* sm)
+{
+    for (int i = 0; i < sm->count; ++i)
+    {
+        if (sm->programs[i].state == PROGRAM_STATE_COMPILING || sm->programs[i].state == PROGRAM_STATE_LINKING)
+            return false;
+    }
+    return true;
+}
+
+int shader_manager_warm_up(ShaderManager* sm, void (*draw)(void* user), void* user)
+{
+    int warmed = 0;
+    for (int i = 0; i < sm->count; ++i)
+    {
+        ManagedProgram* mp = &sm->programs[i];
+        if (mp->state != PROGRAM_STATE_READY || mp->warm_program == mp->program)
+            continue;
+        if (!warmed)
+        {
+            gl_state_enable(GL_SCISSOR_TEST, true);
+            glScissor(0, 0, 0, 0);
+        }
+        gl_state_use_program(mp->program);
+        draw(user);
+        mp->warm_program = mp->program;
+        ++warmed;
+    }
+    if (warmed)
+    {
+        gl_state_enable(GL_SCISSOR_TEST, false);
+        glFlush();
+    }
+    return warmed;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/file_watcher.h"
+#include "gl/program_cache.h"
+
+// Owns every program the app uses and builds them without blocking the frame.
+//
+// All programs are submitted up front. When GL_KHR_parallel_shader_compile is
+// available the driver compiles and links them on its own threads and
+// shader_manager_poll only checks GL_COMPLETION_STATUS_KHR, so the main loop
+// can keep presenting frames and start drawing with each program as soon as
+// it is ready. Without the extension poll falls back to building everything
+// synchronously the first time it runs. Binaries come from / go to the
+// program cache either way.
+//
+// Hot reload: a program's stages can be tied to files with
+// shader_manager_watch. When a file changes, the program is rebuilt from the
+// new source the same way, in the background, while the old program keeps
+// drawing. shader_manager_poll swaps the new one in once it has linked, so a
+// reload lands between two frames. A build that fails logs the driver's
+// messages and leaves the old program in place. Going back to an earlier
+// version of a file is a cache hit and takes effect immediately.
+
+#define SHADER_MANAGER_MAX_PROGRAMS 64
+#define SHADER_MANAGER_WATCH_INTERVAL 0.25  // seconds between looks at the watched files
+
+typedef enum ProgramState
+{
+    PROGRAM_STATE_COMPILING,    // stages compiling
+    PROGRAM_STATE_LINKING,      // glLinkProgram issued
+    PROGRAM_STATE_READY,
+    PROGRAM_STATE_FAILED
+} ProgramState;
+
+typedef struct ManagedProgram
+{
+    const char* vertex_source;      // borrowed, must outlive the manager
+    const char* fragment_source;
+    uint64_t cache_key;
+    GLuint shaders[2];
+    GLuint program;                 // valid once READY
+    ProgramState state;
+    double submit_time;             // seconds, for the compile latency report
+    double ready_time;
+    int watches[2];                 // each stage's file in the watcher, -1 when it isn't watched
+    char* owned_sources[2];         // a stage reloaded from its file: the source pointer above points here
+    char* reload_sources[2];        // a reload in flight: the stages it changes (NULL keeps the current source)
+    GLuint reload_shaders[2];
+    GLuint reload_program;
+    ProgramState reload_state;      // COMPILING / LINKING while a reload builds, READY otherwise
+    uint64_t reload_key;
+    double reload_time;             // when it started
+    const struct ShaderPermutation* permutation;    // a variant (gl/shader_permutation.h): its files hold the master
+    uint64_t variant;               // the variant's key
+    GLuint warm_program;            // the program shader_manager_warm_up last drew with; a rebuild is cold again
+} ManagedProgram;
+
+typedef struct ShaderManager
+{
+    ProgramCache* cache;            // may be NULL
+    bool parallel;                  // driver compiles in the background
+    int count;
+    ManagedProgram programs[SHADER_MANAGER_MAX_PROGRAMS];
+    FileWatcher watcher;
+    double watch_time;              // last look at the watched files
+    unsigned int reloads;           // programs swapped for a rebuild from edited files
+    unsigned int reload_failures;   // rebuilds that didn't compile or link
+} ShaderManager;
+
+// Needs a current context with gl_ext loaded. "max_threads" is passed to glMaxShaderCompilerThreadsKHR
+// (0xFFFFFFFF lets the driver choose).
+void shader_manager_init(ShaderManager* sm, ProgramCache* cache, GLuint max_threads);
+void shader_manager_destroy(ShaderManager* sm);
+
+// Queues a vertex + fragment program and returns its id (-1 when the table is full).
+// A cache hit is ready immediately; otherwise compilation starts right away.
+int shader_manager_submit(ShaderManager* sm, const char* vertex_source, const char* fragment_source);
+
+// Ties program "id"'s stages to files (either path may be NULL). A file that exists is its stage's source from
+// now on: if it differs from the submitted source the program is rebuilt from it right away. A file that doesn't
+// exist is written with the submitted source, to be edited. For a shader_permutation variant the files hold the
+// master source, and every edit is composed into the variant. Returns false (logged) when a file can't be watched.
+bool shader_manager_watch(ShaderManager* sm, int id, const char* vertex_path, const char* fragment_path);
+
+// Advances every pending program as far as it can go without waiting, and starts rebuilds for the watched
+// files that changed. A rebuilt program replaces the old one here: the program returned for an id can change
+// on any poll. Call once per frame, before drawing.
+void shader_manager_poll(ShaderManager* sm);
+
+// Polls until program "id" is ready or failed, and returns it (0 on failure).
+GLuint shader_manager_wait(ShaderManager* sm, int id);
+
+ProgramState shader_manager_state(const ShaderManager* sm, int id);
+
+// The program, or 0 while it isn't ready yet
+GLuint shader_manager_program(const ShaderManager* sm, int id);
+
+// True once no program is compiling or linking
+bool shader_manager_idle(const ShaderManager* sm);
+
+// Uses each ready program not drawn with yet (or rebuilt since) and calls "draw" to make one draw with it, under an
+// empty scissor, so a driver that compiles lazily does it now rather than at the program's first real draw. The
+// caller binds a vertex array and the uniform blocks. Returns how many programs it drew with.
+int shader_manager_warm_up(ShaderManager* sm, void (*draw)(void* user), void* user);
@@ -0,0 +1,290 @@
+#include "gl/shader_permutation.h"
+
+#include "gl/gl_ext.h"
+#include "gl/shader.h"
+
+#include <GLFW/glfw3.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+void shader_permutation_init(ShaderPermutation* sp, const char* vertex_source, const char* fragment_source,
+    const ShaderFeature* features, int feature_count, const uint64_t* exclusive, int exclusive_count)
+{
+    memset(sp, 0, sizeof(*sp));
+    sp->sources[0] = vertex_source;
+    sp->sources[1] = fragment_source;
+    sp->features = features;
+    sp->feature_count = feature_count < SHADER_PERMUTATION_MAX_FEATURES ? feature_count : SHADER_PERMUTATION_MAX_FEATURES;
+    sp->exclusive = exclusive;
+    sp->exclusive_count = exclusive_count;
+}
+
+void shader_permutation_destroy(ShaderPermutation* sp)
+{
+    for (int i = 0; i < sp->variant_count; ++i)
+    {
+        free(sp->variants[i].sources[0]);
+        free(sp->variants[i].sources[1]);
+    }
+    sp->variant_count = 0;
+}
+
+bool shader_permutation_reachable(const ShaderPermutation* sp, uint64_t key)
+{
+    if (key >> sp->feature_count)
+        return false;
+    for (int g = 0; g < sp->exclusive_count; ++g)
+    {
+        const uint64_t bits = key & sp->exclusive[g];
+        if (bits & (bits - 1))
+            return false;   // two or more of the group
+    }
+    return true;
+}
+
+// The key bits of the features that concern "stage"
+static uint64_t stage_mask(const ShaderPermutation* sp, int stage)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < sp->feature_count; ++i)
+    {
+        if (sp->features[i].stages & (1u << stage))
+            mask |= 1ull << i;
+    }
+    return mask;
+}
+
+// GL_SHADING_LANGUAGE_VERSION as a #version number ("4.60 ..." -> 460). On ES the desktop version whose features
+// the sources need there: 430's compute, storage and explicit locations come with ES 3.1, 330's with 3.0.
+static int glsl_version(void)
+{
+    if (gl_ext.es)
+        return gl_ext.es_version >= 310 ? 430 : 330;
+    const char* text = (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION);
+    int major = 0, minor = 0;
+    if (!text || sscanf(text, "%d.%d", &major, &minor) != 2)
+        return 0;
+    return major * 100 + minor;
+}
+
+bool shader_permutation_supported(const ShaderPermutation* sp, uint64_t key)
+{
+    const int version = glsl_version();
+    for (int i = 0; i < sp->feature_count; ++i)
+    {
+        const ShaderFeature* f = &sp->features[i];
+        if ((key >> i & 1) && ((f->version && f->version > version) || (f->extension && !gl_ext_supported(f->extension))))
+            return false;
+    }
+    return true;
+}
+
+char* shader_permutation_compose(const ShaderPermutation* sp, int stage, const char* source, uint64_t key)
+{
+    key &= stage_mask(sp, stage);
+    int version = 0, length = 0;
+    if (sscanf(source, "#version %d%n", &version, &length) != 1)
+    {
+        fprintf(stderr, "shader_permutation: the source doesn't start with a #version line\n");
+        return NULL;
+    }
+
+    // The rest of the version line ("core", "es") is kept; the body goes after the defines
+    const char* profile = source + length;
+    const char* body = strchr(profile, '\n');
+    const int profile_length = body ? (int)(body - profile) : (int)strlen(profile);
+    body = body ? body + 1 : profile + profile_length;
+
+    size_t size = strlen(source) + 64;
+    for (int i = 0; i < sp->feature_count; ++i)
+    {
+        const ShaderFeature* f = &sp->features[i];
+        if (key >> i & 1)
+        {
+            size += strlen(f->define) + 16 + (f->extension ? strlen(f->extension) + 24 : 0);
+            if (f->version > version)
+                version = f->version;
+        }
+    }
+
+    char* text = (char*)malloc(size);
+    int used = snprintf(text, size, "#version %d%.*s\n", version, profile_length, profile);
+    for (int i = 0; i < sp->feature_count; ++i)
+    {
+        if ((key >> i & 1) && sp->features[i].extension)
+            used += snprintf(text + used, size - used, "#extension %s : require\n", sp->features[i].extension);
+    }
+    for (int i = 0; i < sp->feature_count; ++i)
+    {
+        if (key >> i & 1)
+            used += snprintf(text + used, size - used, "#define %s 1\n", sp->features[i].define);
+    }
+    snprintf(text + used, size - used, "#line 2\n%s", body);   // the body starts on the master's second line
+    return text;
+}
+
+void shader_permutation_name(const ShaderPermutation* sp, uint64_t key, char* name, size_t size)
+{
+    int used = snprintf(name, size, "%s", key ? "" : "base");
+    for (int i = 0; i < sp->feature_count && used < (int)size; ++i)
+    {
+        if (key >> i & 1)
+            used += snprintf(name + used, size - used, "%s%s", used ? "+" : "", sp->features[i].define);
+    }
+}
+
+// The variant's entry, composed the first time it's looked up; NULL (logged) when it can't be
+static ShaderVariant* find_variant(ShaderPermutation* sp, uint64_t key)
+{
+    for (int i = 0; i < sp->variant_count; ++i)
+    {
+        if (sp->variants[i].key == key)
+            return &sp->variants[i];
+    }
+    if (!shader_permutation_reachable(sp, key) || sp->variant_count == SHADER_PERMUTATION_MAX_VARIANTS)
+    {
+        fprintf(stderr, "shader_permutation: variant %016llx %s\n", (unsigned long long)key,
+            sp->variant_count == SHADER_PERMUTATION_MAX_VARIANTS ? "doesn't fit, the table is full" : "isn't reachable");
+        return NULL;
+    }
+
+    ShaderVariant* v = &sp->variants[sp->variant_count];
+    v->key = key;
+    v->program = v->pipeline = -1;
+    v->sources[0] = shader_permutation_compose(sp, 0, sp->sources[0], key);
+    v->sources[1] = shader_permutation_compose(sp, 1, sp->sources[1], key);
+    if (!v->sources[0] || !v->sources[1])
+    {
+        free(v->sources[0]);
+        free(v->sources[1]);
+        return NULL;
+    }
+    ++sp->variant_count;
+    return v;
+}
+
+int shader_permutation_program(ShaderPermutation* sp, ShaderManager* sm, uint64_t key)
+{
+    ShaderVariant* v = find_variant(sp, key);
+    if (!v || v->program >= 0)
+        return v ? v->program : -1;
+    v->program = shader_manager_submit(sm, v->sources[0], v->sources[1]);
+    if (v->program >= 0)
+    {
+        sm->programs[v->program].permutation = sp;  // a reload from its files composes the edits the same way
+        sm->programs[v->program].variant = key;
+    }
+    return v->program;
+}
+
+int shader_permutation_pipeline(ShaderPermutation* sp, ProgramPipelines* pp, uint64_t key)
+{
+    ShaderVariant* v = find_variant(sp, key);
+    if (!v || v->pipeline >= 0)
+        return v ? v->pipeline : -1;
+    v->pipeline = program_pipelines_add(pp, program_pipelines_stage(pp, GL_VERTEX_SHADER, v->sources[0]),
+        program_pipelines_stage(pp, GL_FRAGMENT_SHADER, v->sources[1]));
+    return v->pipeline;
+}
+
+// The separable stage "source" into the cache unless it's there already (or was earlier in this run: "done" holds
+// the keys seen so far). Returns false when it fails to build.
+static bool precompile_stage(ProgramCache* cache, GLenum type, const char* source, uint64_t* done, int* done_count,
+    int* built, int* links)
+{
+    const uint64_t key = program_cache_stage_key(cache, type, source);
+    for (int i = 0; i < *done_count; ++i)
+    {
+        if (done[i] == key)
+            return true;
+    }
+    done[(*done_count)++] = key;
+    GLuint program = program_cache_load_stage(cache, key);
+    if (!program)
+    {
+        GLuint shader = shader_compile(type, source);
+        program = program_link_finish(stage_program_link_begin(shader, cache->supported), &shader, 1);
+        if (program)
+            program_cache_store(cache, key, program);
+        ++*links;
+        *built += program != 0;
+    }
+    glDeleteProgram(program);
+    return program != 0;
+}
+
+bool shader_permutation_precompile(const ShaderPermutation* sp, ProgramCache* cache, FILE* out)
+{
+    if (!cache->supported)
+        fprintf(out, "shader variants: this driver has no program binaries; compiling to check them only\n");
+    const bool separable = gl_ext.ARB_separate_shader_objects;
+
+    int built = 0, cached = 0, unsupported = 0, failed = 0;
+    int variants = 0, program_links = 0, stage_links = 0, stages_built = 0, stage_count = 0;
+    uint64_t* stage_keys = (uint64_t*)malloc(sizeof(uint64_t) * ((size_t)2 << sp->feature_count));    // two per variant at most
+    for (uint64_t key = 0; key < 1ull << sp->feature_count; ++key)
+    {
+        if (!shader_permutation_reachable(sp, key))
+            continue;
+        char name[256];
+        shader_permutation_name(sp, key, name, sizeof(name));
+        if (!shader_permutation_supported(sp, key))
+        {
+            fprintf(out, "  %-40s not supported by this context\n", name);
+            ++unsupported;
+            continue;
+        }
+
+        char* vertex = shader_permutation_compose(sp, 0, sp->sources[0], key);
+        char* fragment = shader_permutation_compose(sp, 1, sp->sources[1], key);
+        GLuint program = 0;
+        bool ok = vertex && fragment;
+        if (ok)
+        {
+            const uint64_t cache_key = program_cache_key(cache, vertex, fragment);
+            program = program_cache_load(cache, cache_key);
+            if (program)
+            {
+                fprintf(out, "  %-40s already cached (%016llx)\n", name, (unsigned long long)cache_key);
+                ++cached;
+            }
+            else
+            {
+                const double start = glfwGetTime();
+                program = program_build(vertex, fragment, cache->supported);
+                ++program_links;
+                if (program)
+                {
+                    program_cache_store(cache, cache_key, program);
+                    fprintf(out, "  %-40s compiled in %.0f ms (%016llx)\n", name, (glfwGetTime() - start) * 1000.0,
+                        (unsigned long long)cache_key);
+                    ++built;
+                }
+            }
+            ok = program != 0;
+            if (ok && separable)
+            {
+                ok = precompile_stage(cache, GL_VERTEX_SHADER, vertex, stage_keys, &stage_count, &stages_built, &stage_links)
+                    && precompile_stage(cache, GL_FRAGMENT_SHADER, fragment, stage_keys, &stage_count, &stages_built,
+                        &stage_links);
+            }
+        }
+        if (!ok)
+        {
+            fprintf(out, "  %-40s failed to build\n", name);
+            ++failed;
+        }
+        ++variants;
+        glDeleteProgram(program);
+        free(vertex);
+        free(fragment);
+    }
+    free(stage_keys);
+    fprintf(out, "shader variants: %d compiled, %d already cached, %d unsupported, %d failed\n", built, cached,
+        unsupported, failed);
+    if (separable)
+        fprintf(out, "separable stages: %d distinct for %d variants, %d compiled (%d links here, %d for whole programs)\n",
+            stage_count, variants, stages_built, stage_links, program_links);
+    return failed == 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/program_cache.h"
+#include "gl/program_pipeline.h"
+#include "gl/shader_manager.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Variants of one master shader, chosen by #define. The master vertex and
+// fragment sources are written once with #ifdef blocks per feature, and a
+// variant is named by a 64-bit key, one bit per feature. Composing a variant's
+// stage puts a "#define FEATURE 1" for each of its bits that concerns the
+// stage right after the #version line (raised, and the feature's #extension
+// added, when a feature needs them), then a #line so the driver's messages
+// still match the master's lines.
+//
+// A feature only touches the stages it names, so variants that differ in a
+// fragment feature share their vertex stage source. As separable programs
+// (gl/program_pipeline.h) each distinct stage is compiled and linked once, and
+// a variant is a pipeline of two of them: V + F links instead of V * F.
+//
+// The composed source is deterministic, so its program cache key is too: a
+// variant precompiled once (shader_permutation_precompile, run by
+// openGLTest --precompile-shaders) is a binary load from then on, and the
+// first frame that needs it doesn't wait for a compile.
+//
+// Features that can't be combined are listed as exclusive groups; the
+// reachable variants are the keys that have at most one bit of each group.
+
+#define SHADER_PERMUTATION_MAX_FEATURES 20  // keys are enumerated, 2^features of them, to find the reachable ones
+#define SHADER_PERMUTATION_MAX_VARIANTS 64  // variants looked up at run time
+
+#define SHADER_STAGE_VERTEX   (1u << 0)     // ShaderFeature::stages bits, one per master source
+#define SHADER_STAGE_FRAGMENT (1u << 1)
+
+typedef struct ShaderFeature
+{
+    const char* define;         // #define'd to 1 in the variants with the feature
+    int version;                // lowest GLSL version the feature compiles with, 0 for the master's own
+    const char* extension;      // #extension the feature requires, or NULL
+    unsigned int stages;        // SHADER_STAGE_* the feature is #define'd (and versioned) in
+} ShaderFeature;
+
+typedef struct ShaderVariant
+{
+    uint64_t key;
+    int program;                // its ShaderManager id, -1 until it's looked up as a whole program
+    int pipeline;               // its ProgramPipelines id, -1 until it's looked up as a pipeline
+    char* sources[2];           // composed vertex and fragment source, owned: the manager borrows them
+} ShaderVariant;
+
+typedef struct ShaderPermutation
+{
+    const char* sources[2];     // master vertex and fragment source, borrowed
+    const ShaderFeature* features;  // feature i is key bit 1 << i
+    int feature_count;
+    const uint64_t* exclusive;  // feature masks a variant may have at most one bit of, each
+    int exclusive_count;
+    int variant_count;
+    ShaderVariant variants[SHADER_PERMUTATION_MAX_VARIANTS];
+} ShaderPermutation;
+
+// Borrows everything passed in. At most SHADER_PERMUTATION_MAX_FEATURES features.
+void shader_permutation_init(ShaderPermutation* sp, const char* vertex_source, const char* fragment_source,
+    const ShaderFeature* features, int feature_count, const uint64_t* exclusive, int exclusive_count);
+
+// Frees the composed sources: after the ShaderManager the variants were submitted to has been destroyed
+void shader_permutation_destroy(ShaderPermutation* sp);
+
+// True when "key" names only known features and respects every exclusive group
+bool shader_permutation_reachable(const ShaderPermutation* sp, uint64_t key);
+
+// True when the current context has the GLSL version and extensions the variant's features need
+bool shader_permutation_supported(const ShaderPermutation* sp, uint64_t key);
+
+// "source" (master stage "stage", 0 vertex or 1 fragment, or an edited copy) with the variant's defines for that
+// stage. Returns a malloc'd string, or logs and returns NULL when the source doesn't start with a #version line.
+char* shader_permutation_compose(const ShaderPermutation* sp, int stage, const char* source, uint64_t key);
+
+// The variant's defines joined by '+', or "base" for key 0
+void shader_permutation_name(const ShaderPermutation* sp, uint64_t key, char* name, size_t size);
+
+// The variant's program id in "sm", submitted there the first time the key is looked up (a cache hit when it
+// was precompiled). Returns -1, logged, for an unreachable key or when the table is full.
+int shader_permutation_program(ShaderPermutation* sp, ShaderManager* sm, uint64_t key);
+
+// The variant as a pipeline in "pp": its two stages are shared with every other variant that composes them the
+// same. Returns -1, logged, as shader_permutation_program does.
+int shader_permutation_pipeline(ShaderPermutation* sp, ProgramPipelines* pp, uint64_t key);
+
+// Builds every reachable variant the context supports into the program cache, skipping the ones already
+// there, and reports each to "out". With GL_ARB_separate_shader_objects each distinct stage goes in as a
+// separable program too. Returns false when any of them failed to build.
+bool shader_permutation_precompile(const ShaderPermutation* sp, ProgramCache* cache, FILE* out);
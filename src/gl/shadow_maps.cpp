@@ -0,0 +1,233 @@
+#include "gl/shadow_maps.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+#include "gl/uniforms.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SHADOW_MAPS_LAMBDA 0.75f        // split spacing, mostly logarithmic
+
+// The Shadows block, as SHADOW_GLSL declares it
+typedef struct ShadowUniforms
+{
+    mat4x4 matrices[SHADOW_MAX_CASCADES];
+    vec4 params;
+} ShadowUniforms;
+
+// The ground program's uniforms, at the locations its GLSL gives them rather than looked up by name
+enum
+{
+    GROUND_LOCATION_INVERSE_VIEW_PROJECTION = 0,
+    GROUND_LOCATION_VIEWPORT = 1,
+    GROUND_LOCATION_PLANE = 2
+};
+
+// A triangle over the whole viewport
+static const char* ground_vertex_shader_text =
+"#version 430\n"
+"out gl_PerVertex { vec4 gl_Position; };\n"
+"void main()\n"
+"{\n"
+"    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+"    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+// The pixel's view ray, from the near plane to the far one, cut by the plane z = ground.x: black over it as far as
+// it's shadowed (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA). Rays that miss it, and lit points, are discarded.
+static const char* ground_fragment_shader_text =
+"#version 430\n"
+SHADOW_GLSL
+"layout(location = 0) uniform mat4 inverseViewProjection;\n"
+"layout(location = 1) uniform vec2 viewportSize;\n"
+"layout(location = 2) uniform vec3 ground;\n"    // the plane's z; the view's near and far clip depths
+"layout(location = 0) out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    vec2 ndc = gl_FragCoord.xy / viewportSize * 2.0 - 1.0;\n"
+"    vec4 n = inverseViewProjection * vec4(ndc, ground.y, 1.0);\n"
+"    vec4 f = inverseViewProjection * vec4(ndc, ground.z, 1.0);\n"
+"    vec3 a = n.xyz / n.w, b = f.xyz / f.w;\n"
+"    if (abs(b.z - a.z) < 1e-7)\n"
+"        discard;\n"
+"    float t = (ground.x - a.z) / (b.z - a.z);\n"
+"    if (t < 0.0 || t > 1.0)\n"
+"        discard;\n"
+"    float visible = shadowVisibility(mix(a, b, t));\n"
+"    if (visible >= 1.0)\n"
+"        discard;\n"
+"    fragment = vec4(0.0, 0.0, 0.0, 1.0 - visible);\n"
+"}\n";
+
+bool shadow_maps_supported(void)
+{
+    return GLAD_GL_VERSION_4_3;
+}
+
+bool shadow_maps_init(ShadowMaps* s, int count, int resolution, bool zero_to_one, float ground_z)
+{
+    memset(s, 0, sizeof(*s));
+    shadow_cascades_init(&s->cascades, count, resolution, SHADOW_MAPS_LAMBDA, zero_to_one);
+    count = s->cascades.count;
+    s->layers = count;
+    s->ground_z = ground_z;
+
+    s->ground_program = program_build(ground_vertex_shader_text, ground_fragment_shader_text, false);
+    if (!s->ground_program)
+    {
+        fprintf(stderr, "shadows: can't build the ground program\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, s->ground_program, "shadow ground");
+
+    glGenTextures(1, &s->maps);
+    gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, s->maps);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, resolution, resolution, count);
+    gl_memory_texture(s->maps, GPU_MEMORY_RENDER_TARGETS, GL_DEPTH_COMPONENT32F, resolution, resolution, count, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    gl_debug_label(GL_TEXTURE, s->maps, "shadow maps");
+    gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+    const GLuint previous = gl_state.draw_framebuffer;
+    glGenFramebuffers(count, s->framebuffers);
+    bool complete = true;
+    for (int i = 0; i < count && complete; ++i)
+    {
+        gl_state_bind_framebuffer(GL_FRAMEBUFFER, s->framebuffers[i]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, s->maps, 0, i);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        gl_debug_label(GL_FRAMEBUFFER, s->framebuffers[i], "shadow cascade");
+        const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            fprintf(stderr, "shadows: %dx%d cascade %d incomplete (0x%04X)\n", resolution, resolution, i, status);
+            complete = false;
+        }
+    }
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, previous);
+    if (!complete)
+        return false;
+
+    s->camera_stride = uniforms_block_stride(sizeof(CameraUniforms));
+    s->camera_buffer = gl_dsa_create_buffer(s->camera_stride * count, NULL, GL_DYNAMIC_DRAW);
+    gl_memory_buffer(s->camera_buffer, GPU_MEMORY_UNIFORMS, (size_t)(s->camera_stride * count));
+    gl_debug_label(GL_BUFFER, s->camera_buffer, "shadow cameras");
+    ShadowUniforms none;
+    memset(&none, 0, sizeof(none));     // no cascades: everything lit until the first fit
+    s->shadows_buffer = gl_dsa_create_buffer(sizeof(ShadowUniforms), &none, GL_DYNAMIC_DRAW);
+    gl_memory_buffer(s->shadows_buffer, GPU_MEMORY_UNIFORMS, sizeof(ShadowUniforms));
+    gl_debug_label(GL_BUFFER, s->shadows_buffer, "shadows");
+    return true;
+}
+
+void shadow_maps_destroy(ShadowMaps* s)
+{
+    gl_state_delete_framebuffers(SHADOW_MAX_CASCADES, s->framebuffers);
+    gl_state_delete_textures(1, &s->maps);
+    gl_state_delete_buffers(1, &s->camera_buffer);
+    gl_state_delete_buffers(1, &s->shadows_buffer);
+    if (s->ground_program)
+        glDeleteProgram(s->ground_program);
+    memset(s, 0, sizeof(*s));
+}
+
+void shadow_maps_set_count(ShadowMaps* s, int count)
+{
+    const int previous = s->cascades.count;
+    shadow_cascades_set_count(&s->cascades, count < s->layers ? count : s->layers);
+    if (s->cascades.count != previous)
+        s->uploaded_fits = ~0u;     // fewer cascades' fits could add up to the old sum
+}
+
+void shadow_maps_fit(ShadowMaps* s, mat4x4 const inverse_view_projection, float ndc_near, float ndc_far,
+    float near_plane, float far_plane)
+{
+    ShadowCascades* sc = &s->cascades;
+    shadow_cascades_fit(sc, inverse_view_projection, ndc_near, ndc_far, near_plane, far_plane);
+    s->ndc_near = ndc_near;
+    s->ndc_far = ndc_far;
+    uint32_t fits = 0;
+    for (int i = 0; i < sc->count; ++i)
+        fits += sc->cascades[i].fits;
+    if (fits == s->uploaded_fits)
+        return;     // every map still where the blocks say
+    s->uploaded_fits = fits;
+
+    // The casters' cameras: the light's rotation, then the cascade's box (the inverse of a rotation is its transpose)
+    mat4x4 light_inverse;
+    mat4x4_transpose(light_inverse, sc->light_view);
+    ShadowUniforms shadows;
+    memset(&shadows, 0, sizeof(shadows));
+    for (int i = 0; i < sc->count; ++i)
+    {
+        const ShadowCascade* c = &sc->cascades[i];
+        CameraUniforms camera;
+        mat4x4_dup(camera.view, sc->light_view);
+        mat4x4_mul(camera.projection, c->view_projection, light_inverse);
+        mat4x4_dup(camera.view_projection, c->view_projection);
+        camera.viewport[0] = camera.viewport[1] = 0.f;
+        camera.viewport[2] = camera.viewport[3] = (float)sc->resolution;
+        gl_dsa_buffer_sub_data(s->camera_buffer, s->camera_stride * i, sizeof(camera), &camera);
+        mat4x4_dup(shadows.matrices[i], c->texture_matrix);
+    }
+    // Every cascade's depth spans three of its half widths, which are resolution / 2 texels: two texels of depth
+    // in map units is the same for all of them
+    shadows.params[0] = (float)sc->count;
+    shadows.params[1] = 1.f / sc->resolution;
+    shadows.params[2] = 4.f / (3.f * sc->resolution);
+    shadows.params[3] = SHADOW_MAPS_DARKNESS;
+    gl_dsa_buffer_sub_data(s->shadows_buffer, 0, sizeof(shadows), &shadows);
+}
+
+void shadow_maps_begin(ShadowMaps* s, int i)
+{
+    bool ours = false;
+    for (int k = 0; k < s->cascades.count; ++k)
+        ours = ours || gl_state.draw_framebuffer == s->framebuffers[k];
+    if (!ours)
+        s->resume_framebuffer = gl_state.draw_framebuffer;
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, s->framebuffers[i]);
+    gl_state_viewport(0, 0, s->cascades.resolution, s->cascades.resolution);
+    gl_state_depth_mask(true);
+    const float far_depth = 1.f;
+    glClearBufferfv(GL_DEPTH, 0, &far_depth);
+    gl_state_bind_buffer_range(GL_UNIFORM_BUFFER, UNIFORMS_BINDING_CAMERA, s->camera_buffer, s->camera_stride * i,
+        sizeof(CameraUniforms));
+}
+
+void shadow_maps_end(ShadowMaps* s)
+{
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, s->resume_framebuffer);
+}
+
+void shadow_maps_bind(const ShadowMaps* s)
+{
+    gl_state_bind_buffer_base(GL_UNIFORM_BUFFER, SHADOW_MAPS_BINDING, s->shadows_buffer);
+    gl_state_bind_texture(SHADOW_MAPS_UNIT, GL_TEXTURE_2D_ARRAY, s->maps);
+}
+
+void shadow_maps_draw_ground(ShadowMaps* s, mat4x4 const inverse_view_projection, int width, int height)
+{
+    shadow_maps_bind(s);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl_state_colour_mask(true);
+    gl_state_use_program(s->ground_program);
+    glUniformMatrix4fv(GROUND_LOCATION_INVERSE_VIEW_PROJECTION, 1, GL_FALSE, &inverse_view_projection[0][0]);
+    glUniform2f(GROUND_LOCATION_VIEWPORT, (float)width, (float)height);
+    glUniform3f(GROUND_LOCATION_PLANE, s->ground_z, s->ndc_near, s->ndc_far);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+}
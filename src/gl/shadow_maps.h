@@ -0,0 +1,102 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "scene/shadow_cascades.h"
+
+#include <stdint.h>
+
+// Cascaded shadow maps for the sun (needs a 4.3 context): the GL side of
+// scene/shadow_cascades.h. Each cascade's map is a layer of one
+// DEPTH_COMPONENT32F array, compared in the shader (sampler2DArrayShadow,
+// linear filtering, so each tap is already a 2x2 PCF).
+//
+// The casters draw into a layer with the scene's depth-only program and the
+// layer's own Camera block (a range of this module's buffer bound at the
+// Camera binding in place of the view's), so no shader knows it's drawing a
+// shadow. Only the layers shadow_cascades_schedule picks are drawn: the rest
+// keep what they have.
+//
+// SHADOW_GLSL is the receiving side, #included by the scene shaders'
+// SHADOWED variant: the Shadows block (each cascade's texture matrix) and
+// shadowVisibility(), which looks the position up in the nearest cascade
+// that covers it. The ground pass shades the plane below the scene with it:
+// the scene itself is flat, so its shadows only show on something under it.
+
+#define SHADOW_MAPS_BINDING 7           // the Shadows uniform block's binding, as in SHADOW_GLSL
+#define SHADOW_MAPS_UNIT 7              // the maps' texture unit, as in SHADOW_GLSL
+#define SHADOW_MAPS_DARKNESS 0.55f      // of the light a fully shadowed pixel loses
+
+#define SHADOW_GLSL \
+    "layout(std140, binding = 7) uniform Shadows\n" \
+    "{\n" \
+    "    mat4 shadowMatrices[4];\n"     /* world to each map's [0, 1] coordinates and depth */ \
+    "    vec4 shadowParams;\n"          /* x: cascades, y: a texel in map coordinates, z: depth bias, w: darkness */ \
+    "};\n" \
+    "layout(binding = 7) uniform sampler2DArrayShadow shadowMaps;\n" \
+    "float shadowVisibility(vec3 position)\n" \
+    "{\n" \
+    "    for (int i = 0; i < int(shadowParams.x); ++i)\n" \
+    "    {\n" \
+    "        vec3 p = (shadowMatrices[i] * vec4(position, 1.0)).xyz;\n" \
+    "        if (any(lessThan(p.xy, vec2(shadowParams.y))) || any(greaterThan(p.xy, vec2(1.0 - shadowParams.y))) || p.z > 1.0)\n" \
+    "            continue;\n"           /* past this map's edge: the next one out */ \
+    "        float d = p.z - shadowParams.z;\n" \
+    "        float t = 0.5 * shadowParams.y;\n" \
+    "        float lit = texture(shadowMaps, vec4(p.xy + vec2(-t, -t), float(i), d))\n" \
+    "            + texture(shadowMaps, vec4(p.xy + vec2(t, -t), float(i), d))\n" \
+    "            + texture(shadowMaps, vec4(p.xy + vec2(-t, t), float(i), d))\n" \
+    "            + texture(shadowMaps, vec4(p.xy + vec2(t, t), float(i), d));\n" \
+    "        return mix(1.0 - shadowParams.w, 1.0, 0.25 * lit);\n" \
+    "    }\n" \
+    "    return 1.0;\n" \
+    "}\n"
+
+typedef struct ShadowMaps
+{
+    ShadowCascades cascades;    // where each map looks and when it's drawn
+    GLuint maps;                // the array, a layer per cascade
+    GLuint framebuffers[SHADOW_MAX_CASCADES];   // one a layer, its depth alone
+    GLuint camera_buffer;       // a CameraUniforms a cascade, camera_stride apart
+    GLsizeiptr camera_stride;
+    GLuint shadows_buffer;      // the Shadows block
+    uint32_t uploaded_fits;     // the cascades' fits as of the last upload
+    int layers;                 // cascades the array and framebuffers were made for: the most shadow_maps_set_count takes
+    GLuint ground_program;
+    float ground_z;             // the plane the ground pass shades
+    float ndc_near;             // the view's clip depths, as of the last fit
+    float ndc_far;
+    GLuint resume_framebuffer;  // where shadow_maps_begin found the frame being drawn
+} ShadowMaps;
+
+// A 4.3 context
+bool shadow_maps_supported(void);
+
+// "count" cascades of "resolution" texels across, and the ground pass for the plane z = ground_z. "zero_to_one":
+// glClipControl's [0, 1] depth range is on. Logs and returns false when anything can't be made.
+bool shadow_maps_init(ShadowMaps* s, int count, int resolution, bool zero_to_one, float ground_z);
+void shadow_maps_destroy(ShadowMaps* s);
+
+// Draws "count" of the cascades init made room for (at least 1) from now on; the next shadow_maps_fit refits and
+// uploads them all
+void shadow_maps_set_count(ShadowMaps* s, int count);
+
+// The cascades fitted to the view (shadow_cascades_fit's arguments), and the Shadows block rewritten when any moved
+void shadow_maps_fit(ShadowMaps* s, mat4x4 const inverse_view_projection, float ndc_near, float ndc_far,
+    float near_plane, float far_plane);
+
+// Drawing switches to cascade "i"'s layer, cleared, at its resolution, with its Camera block bound. The depth-only
+// state is the caller's to bind (depth writes on for the clear: this turns them on).
+void shadow_maps_begin(ShadowMaps* s, int i);
+
+// Back to the framebuffer the first shadow_maps_begin found. The viewport and the Camera block are the caller's
+// to restore.
+void shadow_maps_end(ShadowMaps* s);
+
+// The Shadows block and the maps bound for SHADOW_GLSL
+void shadow_maps_bind(const ShadowMaps* s);
+
+// The ground's shadows over what's drawn: one fullscreen pass (a VAO bound by the caller) that finds each pixel's
+// point on the plane and darkens it by its shadow. "width" x "height" is the viewport. Leaves blending on and
+// the depth test off.
+void shadow_maps_draw_ground(ShadowMaps* s, mat4x4 const inverse_view_projection, int width, int height);
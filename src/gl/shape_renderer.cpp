@@ -0,0 +1,401 @@
+#include "gl/shape_renderer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Pixels to clip space through "transform" (x, y scale, then offset); the scene's attribute names and locations
+static const char* vertex_shader_text =
+"#version 330 core\n"
+"uniform vec4 transform;\n"
+"layout(location = 0) in vec2 vPos;\n"
+"layout(location = 1) in vec4 vCol;\n"
+"layout(location = 2) in vec2 vUV;\n"
+"out vec4 color;\n"
+"out vec2 uv;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = vec4(vPos * transform.xy + transform.zw, 0.0, 1.0);\n"
+"    color = vCol;\n"
+"    uv = vUV;\n"
+"}\n";
+
+static const char* fragment_shader_text =
+"#version 330 core\n"
+"uniform sampler2D sprite;\n"
+"in vec4 color;\n"
+"in vec2 uv;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    fragment = color * texture(sprite, uv);\n"
+"}\n";
+
+// Paths: a triangle adds its winding to each coverage sample it covers; a stroke's (white) count whatever they face
+static const char* coverage_shader_text =
+"#version 330 core\n"
+"in vec4 color;\n"
+"in vec2 uv;\n"
+"out float winding;\n"
+"void main()\n"
+"{\n"
+"    winding = color.a > 0.5 || gl_FrontFacing ? 1.0 : -1.0;\n"
+"}\n";
+
+// Under a cover quad, the share of the pixel's 2 x 2 coverage samples inside by the path's rule (u: 1 for even-odd)
+static const char* cover_shader_text =
+"#version 330 core\n"
+"uniform sampler2D coverage;\n"
+"in vec4 color;\n"
+"in vec2 uv;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    ivec2 p = ivec2(gl_FragCoord.xy) * 2;\n"
+"    float inside = 0.0;\n"
+"    for (int i = 0; i < 4; ++i)\n"
+"    {\n"
+"        float w = abs(texelFetch(coverage, p + ivec2(i & 1, i >> 1), 0).r);\n"
+"        inside += uv.x > 0.5 ? mod(w, 2.0) : min(w, 1.0);\n"
+"    }\n"
+"    if (inside == 0.0)\n"
+"        discard;\n"
+"    fragment = vec4(color.rgb, color.a * inside * 0.25);\n"
+"}\n";
+
+bool shape_renderer_init(ShapeRenderer* sr, uint32_t max_vertices, uint32_t max_indices)
+{
+    memset(sr, 0, sizeof(*sr));
+    sr->max_vertices = max_vertices;
+    sr->max_indices = max_indices;
+    sr->program = program_build(vertex_shader_text, fragment_shader_text, false);
+    if (!sr->program)
+    {
+        fprintf(stderr, "shape_renderer: can't build the program\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, sr->program, "shapes");
+    sr->transform_location = glGetUniformLocation(sr->program, "transform");
+    gl_state_use_program(sr->program);
+    glUniform1i(glGetUniformLocation(sr->program, "sprite"), 0);
+    sr->coverage_program = program_build(vertex_shader_text, coverage_shader_text, false);
+    sr->cover_program = program_build(vertex_shader_text, cover_shader_text, false);
+    if (!sr->coverage_program || !sr->cover_program)
+    {
+        fprintf(stderr, "shape_renderer: can't build the path programs\n");
+        shape_renderer_destroy(sr);
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, sr->coverage_program, "path coverage");
+    gl_debug_label(GL_PROGRAM, sr->cover_program, "path cover");
+    sr->coverage_transform_location = glGetUniformLocation(sr->coverage_program, "transform");
+    sr->cover_transform_location = glGetUniformLocation(sr->cover_program, "transform");
+    gl_state_use_program(sr->cover_program);
+    glUniform1i(glGetUniformLocation(sr->cover_program, "coverage"), 0);
+
+    const uint32_t white = 0xFFFFFFFFu;
+    glGenTextures(1, &sr->white);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, sr->white);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+    gl_memory_texture(sr->white, GPU_MEMORY_TEXTURES, GL_RGBA8, 1, 1, 1, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    gl_debug_label(GL_TEXTURE, sr->white, "shapes white");
+
+    // The index stream is mapped through GL_COPY_WRITE_BUFFER: the element binding belongs to whatever vertex array
+    // is bound, and only this one's should ever hold it
+    vertex_format_init(&sr->format);
+    vertex_format_add(&sr->format, 0, 2, VERTEX_ATTRIB_FLOAT32);
+    vertex_format_add(&sr->format, 1, 4, VERTEX_ATTRIB_UNORM8);
+    vertex_format_add(&sr->format, 2, 2, VERTEX_ATTRIB_UNORM16);
+    if (sr->format.stride != sizeof(ShapeVertex)
+        || !stream_buffer_init(&sr->vertices, GL_ARRAY_BUFFER, (GLsizeiptr)sizeof(ShapeVertex) * max_vertices)
+        || !stream_buffer_init(&sr->indices, GL_COPY_WRITE_BUFFER, (GLsizeiptr)sizeof(uint32_t) * max_indices))
+    {
+        fprintf(stderr, "shape_renderer: can't create the streams\n");
+        shape_renderer_destroy(sr);
+        return false;
+    }
+    sr->vertex_array = gl_dsa_create_vertex_array();
+    gl_state_bind_vertex_array(sr->vertex_array);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, sr->vertices.buffer);
+    vertex_format_apply(&sr->format, 0);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, sr->indices.buffer);
+    gl_debug_label(GL_VERTEX_ARRAY, sr->vertex_array, "shapes");
+    gl_debug_label(GL_BUFFER, sr->vertices.buffer, "shape vertex stream");
+    gl_debug_label(GL_BUFFER, sr->indices.buffer, "shape index stream");
+    return true;
+}
+
+static void shape_renderer_release_coverage(ShapeRenderer* sr)
+{
+    if (sr->coverage_framebuffer)
+        gl_state_delete_framebuffers(1, &sr->coverage_framebuffer);
+    if (sr->coverage)
+        gl_state_delete_textures(1, &sr->coverage);
+    sr->coverage_framebuffer = sr->coverage = 0;
+    sr->coverage_width = sr->coverage_height = 0;
+}
+
+void shape_renderer_destroy(ShapeRenderer* sr)
+{
+    shape_renderer_release_coverage(sr);
+    if (sr->cover_program)
+        glDeleteProgram(sr->cover_program);
+    if (sr->coverage_program)
+        glDeleteProgram(sr->coverage_program);
+    if (sr->vertex_array)
+        gl_state_delete_vertex_arrays(1, &sr->vertex_array);
+    if (sr->indices.buffer)
+        stream_buffer_destroy(&sr->indices);
+    if (sr->vertices.buffer)
+        stream_buffer_destroy(&sr->vertices);
+    if (sr->white)
+        gl_state_delete_textures(1, &sr->white);
+    if (sr->program)
+        glDeleteProgram(sr->program);
+    memset(sr, 0, sizeof(*sr));
+}
+
+// The coverage target for a "width" x "height" frame, made again when the frame's size changes
+static bool shape_renderer_coverage(ShapeRenderer* sr, int width, int height)
+{
+    if (sr->coverage && sr->coverage_width == width && sr->coverage_height == height)
+        return true;
+    shape_renderer_release_coverage(sr);
+    const int w = SHAPE_RENDERER_PATH_SAMPLES * width, h = SHAPE_RENDERER_PATH_SAMPLES * height;
+    glGenTextures(1, &sr->coverage);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, sr->coverage);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, w, h, 0, GL_RED, GL_HALF_FLOAT, NULL);
+    gl_memory_texture(sr->coverage, GPU_MEMORY_RENDER_TARGETS, GL_R16F, w, h, 1, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    gl_debug_label(GL_TEXTURE, sr->coverage, "path coverage");
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+
+    const GLuint target = gl_state.draw_framebuffer;
+    glGenFramebuffers(1, &sr->coverage_framebuffer);
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, sr->coverage_framebuffer);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sr->coverage, 0);
+    gl_debug_label(GL_FRAMEBUFFER, sr->coverage_framebuffer, "path coverage");
+    const GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, target);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "shape_renderer: %dx%d coverage target incomplete (0x%04X)\n", w, h, status);
+        shape_renderer_release_coverage(sr);
+        return false;
+    }
+    sr->coverage_width = width;
+    sr->coverage_height = height;
+    return true;
+}
+
+// Whether a wave of paths draws between layers "below" and "layer": one of "below"'s, or of one in between
+static bool wave_between(const ShapeBatch* batch, uint32_t waves, uint32_t below, uint32_t layer)
+{
+    for (uint32_t w = 0; w < waves; ++w)
+        if (batch->waves[w].layer >= below && batch->waves[w].layer < layer)
+            return true;
+    return false;
+}
+
+// The waves from *wave on whose layers are below "layer": each the coverage of its paths' triangles, then their
+// cover quads over "target". *first is the index where the wave's indices start, in the frame's region.
+static void shape_renderer_draw_waves(ShapeRenderer* sr, const ShapeBatch* batch, uint32_t* wave, uint32_t waves,
+    uint64_t layer, uint32_t* first, GLintptr index_offset, GLint base_vertex, GLuint target, int width, int height)
+{
+    const float zero[4] = { 0.f, 0.f, 0.f, 0.f };
+    for (; *wave < waves && batch->waves[*wave].layer < layer; ++*wave)
+    {
+        const ShapePathWave* w = &batch->waves[*wave];
+        gl_state_bind_texture(0, GL_TEXTURE_2D, sr->white);     // not the target being drawn into
+        gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, sr->coverage_framebuffer);
+        gl_state_viewport(0, 0, SHAPE_RENDERER_PATH_SAMPLES * width, SHAPE_RENDERER_PATH_SAMPLES * height);
+        glClearBufferfv(GL_COLOR, 0, zero);
+        gl_state_use_program(sr->coverage_program);
+        gl_state_blend_func(GL_ONE, GL_ONE);
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)w->index_count, GL_UNSIGNED_INT,
+            (void*)(index_offset + sizeof(uint32_t) * *first), base_vertex);
+        draw_counters_draw(GL_TRIANGLES, (GLsizei)w->index_count, 1);
+        *first += w->index_count;
+
+        gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, target);
+        gl_state_viewport(0, 0, width, height);
+        gl_state_use_program(sr->cover_program);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, sr->coverage);
+        gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(6 * w->count), GL_UNSIGNED_INT,
+            (void*)(index_offset + sizeof(uint32_t) * *first), base_vertex);
+        draw_counters_draw(GL_TRIANGLES, (GLsizei)(6 * w->count), 1);
+        *first += 6 * w->count;
+        sr->draws += 2;
+        ++sr->waves;
+    }
+}
+
+unsigned int shape_renderer_flush(ShapeRenderer* sr, ShapeBatch* batch, int width, int height)
+{
+    sr->draws = 0;
+    sr->waves = 0;
+    int order[SHAPE_BATCH_MAX_BUCKETS];
+    const int count = shape_batch_order(batch, order);
+    uint32_t vertex_total = 0, index_total = 0;
+    shape_batch_totals(batch, &vertex_total, &index_total);
+    uint32_t waves = batch->path_count ? shape_batch_path_waves(batch) : 0;
+    if ((!count && !waves) || width < 1 || height < 1)
+    {
+        shape_batch_clear(batch);
+        return 0;
+    }
+
+    // Whole buckets, in order, while they fit
+    stream_buffer_begin_frame(&sr->vertices);
+    stream_buffer_begin_frame(&sr->indices);
+    uint32_t vertex_count = 0, index_count = 0;
+    int fitting = 0;
+    for (; fitting < count; ++fitting)
+    {
+        const ShapeBucket* b = &batch->buckets[order[fitting]];
+        if (vertex_count + b->vertex_count > sr->max_vertices || index_count + b->index_count > sr->max_indices)
+            break;
+        vertex_count += b->vertex_count;
+        index_count += b->index_count;
+    }
+    sr->dropped += vertex_total - vertex_count;
+
+    // Then the paths, all of them or none: their corners as they are, their triangles' indices and 6 a cover quad
+    const uint32_t shape_indices = index_count;
+    const uint32_t path_indices = batch->path_index_count + 6 * batch->path_count;
+    if (waves && (vertex_count + batch->path_vertex_count > sr->max_vertices
+        || index_count + path_indices > sr->max_indices || !shape_renderer_coverage(sr, width, height)))
+    {
+        sr->dropped += batch->path_vertex_count;
+        waves = 0;
+    }
+    if (waves)
+    {
+        vertex_count += batch->path_vertex_count;
+        index_count += path_indices;
+    }
+    GLintptr vertex_offset = 0, index_offset = 0;
+    ShapeVertex* vertices = vertex_count ? (ShapeVertex*)stream_buffer_alloc(&sr->vertices,
+        (GLsizeiptr)sizeof(ShapeVertex) * vertex_count, sizeof(ShapeVertex), &vertex_offset) : NULL;
+    uint32_t* indices = vertex_count ? (uint32_t*)stream_buffer_alloc(&sr->indices,
+        (GLsizeiptr)sizeof(uint32_t) * index_count, sizeof(uint32_t), &index_offset) : NULL;
+    if (!vertices || !indices)
+    {
+        stream_buffer_end_frame(&sr->indices);
+        stream_buffer_end_frame(&sr->vertices);
+        shape_batch_clear(batch);
+        return 0;
+    }
+
+    // Copy, rebasing each bucket's indices onto the region, and note where each run of one texture ends. A run
+    // also ends where a layer's paths draw before the next bucket.
+    uint32_t run_end[SHAPE_BATCH_MAX_BUCKETS];
+    uint32_t run_texture[SHAPE_BATCH_MAX_BUCKETS];
+    uint32_t run_layer[SHAPE_BATCH_MAX_BUCKETS];    // its first bucket's
+    int runs = 0;
+    uint32_t v = 0, n = 0, last_layer = 0;
+    for (int k = 0; k < fitting; ++k)
+    {
+        const ShapeBucket* b = &batch->buckets[order[k]];
+        memcpy(vertices + v, b->vertices, sizeof(ShapeVertex) * b->vertex_count);
+        for (uint32_t i = 0; i < b->index_count; ++i)
+            indices[n + i] = b->indices[i] + v;
+        v += b->vertex_count;
+        n += b->index_count;
+        const uint32_t texture = (uint32_t)b->key, layer = (uint32_t)(b->key >> 32);
+        if (!runs || run_texture[runs - 1] != texture || wave_between(batch, waves, last_layer, layer))
+        {
+            run_texture[runs] = texture;
+            run_layer[runs++] = layer;
+        }
+        run_end[runs - 1] = n;
+        last_layer = layer;
+    }
+
+    // The paths' corners as they are, their triangles' indices rebased, each wave's after the last, and each
+    // followed by its cover quads'
+    if (waves)
+    {
+        memcpy(vertices + v, batch->path_vertices, sizeof(ShapeVertex) * batch->path_vertex_count);
+        for (uint32_t w = 0; w < waves; ++w)
+        {
+            const ShapePathWave* wave = &batch->waves[w];
+            for (uint32_t k = wave->first; k < wave->first + wave->count; ++k)
+            {
+                const ShapePath* p = &batch->paths[(uint32_t)batch->path_order[k]];
+                for (uint32_t i = 0; i < p->index_count; ++i)
+                    indices[n + i] = batch->path_indices[p->first_index + i] + v;
+                n += p->index_count;
+            }
+            for (uint32_t k = wave->first; k < wave->first + wave->count; ++k)
+            {
+                const uint32_t c = batch->paths[(uint32_t)batch->path_order[k]].cover + v;
+                indices[n] = c;
+                indices[n + 1] = c + 1;
+                indices[n + 2] = c + 2;
+                indices[n + 3] = c;
+                indices[n + 4] = c + 2;
+                indices[n + 5] = c + 3;
+                n += 6;
+            }
+        }
+    }
+    stream_buffer_commit(&sr->vertices);
+    stream_buffer_commit(&sr->indices);
+
+    const bool depth_test = gl_state.capabilities[GL_STATE_CAP_DEPTH_TEST] == 1;
+    const bool cull_face = gl_state.capabilities[GL_STATE_CAP_CULL_FACE] == 1;
+    GLint target = (GLint)gl_state.draw_framebuffer;
+    if (waves && gl_state.draw_framebuffer == GL_STATE_UNKNOWN)
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    gl_state_bind_vertex_array(sr->vertex_array);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_CULL_FACE, false);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_use_program(sr->program);
+    glUniform4f(sr->transform_location, 2.f / width, -2.f / height, -1.f, 1.f);
+    if (waves)
+    {
+        gl_state_use_program(sr->coverage_program);
+        glUniform4f(sr->coverage_transform_location, 2.f / width, -2.f / height, -1.f, 1.f);
+        gl_state_use_program(sr->cover_program);
+        glUniform4f(sr->cover_transform_location, 2.f / width, -2.f / height, -1.f, 1.f);
+    }
+    const GLint base_vertex = (GLint)(vertex_offset / (GLintptr)sizeof(ShapeVertex));
+    uint32_t wave = 0, path_first = shape_indices;
+    for (int r = 0, first = 0; r < runs; first = run_end[r++])
+    {
+        shape_renderer_draw_waves(sr, batch, &wave, waves, run_layer[r], &path_first, index_offset, base_vertex,
+            (GLuint)target, width, height);
+        gl_state_use_program(sr->program);
+        gl_state_viewport(0, 0, width, height);
+        gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        gl_state_bind_texture(0, GL_TEXTURE_2D, run_texture[r] ? run_texture[r] : sr->white);
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(run_end[r] - first), GL_UNSIGNED_INT,
+            (void*)(index_offset + sizeof(uint32_t) * first), base_vertex);
+        draw_counters_draw(GL_TRIANGLES, (GLsizei)(run_end[r] - first), 1);
+        ++sr->draws;
+    }
+    shape_renderer_draw_waves(sr, batch, &wave, waves, UINT64_MAX, &path_first, index_offset, base_vertex,
+        (GLuint)target, width, height);
+    gl_state_enable(GL_BLEND, false);
+    gl_state_enable(GL_CULL_FACE, cull_face);
+    gl_state_enable(GL_DEPTH_TEST, depth_test);
+    stream_buffer_end_frame(&sr->indices);
+    stream_buffer_end_frame(&sr->vertices);
+    shape_batch_clear(batch);
+    return sr->draws;
+}
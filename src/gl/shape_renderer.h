@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/shape_batch.h"
+#include "gl/stream_buffer.h"
+#include "gl/vertex_format.h"
+
+#include <stdint.h>
+
+#define SHAPE_RENDERER_PATH_SAMPLES 2       // coverage samples a pixel along each axis, as in the cover program
+
+// Draws a ShapeBatch (core/shape_batch.h) with the scene's vertex inputs:
+// vPos at location 0 and vCol at 1, as RGBA8 here so shapes can be
+// translucent, plus a texture coordinate at 2 for sprites.
+//
+// Once a frame the buckets are copied, in draw order, into one region of a
+// vertex stream and one of an index stream, their indices rebased on the way
+// so consecutive buckets with the same texture share a draw. Each draw is a
+// glDrawElementsBaseVertex from the frame's region, so the vertex array is
+// set up once. Untextured shapes sample a 1x1 white texture and go through
+// the same program as sprites.
+//
+// Paths are stencil-then-cover, with a coverage target of the renderer's own
+// for the stencil, so the framebuffer drawn over needs none: an R16F target
+// SHAPE_RENDERER_PATH_SAMPLES times the size a side. For each wave
+// (core/shape_batch.h) the target is cleared and every path triangle adds
+// its winding, +1 or -1 by its facing (+1 for a stroke's), with additive
+// blending. Then the wave's cover quads are drawn over the frame: each pixel
+// counts the samples the path's rule finds inside and blends the path's
+// colour in by that share, so edges come out antialiased on any target. A
+// layer's waves draw after its other shapes.
+
+typedef struct ShapeRenderer
+{
+    GLuint program;
+    GLint transform_location;
+    GLuint vertex_array;
+    GLuint white;                   // texture 0's stand-in
+    VertexFormat format;
+    StreamBuffer vertices;
+    StreamBuffer indices;
+    uint32_t max_vertices, max_indices;     // per frame
+    unsigned int draws;             // the last flush's
+    uint32_t dropped;               // vertices beyond the streams' capacity, over the run
+
+    // Paths
+    GLuint coverage_program;        // windings into the coverage target
+    GLuint cover_program;           // the coverage target resolved under each cover quad
+    GLint coverage_transform_location, cover_transform_location;
+    GLuint coverage;                // R16F, SHAPE_RENDERER_PATH_SAMPLES times the frame's size a side
+    GLuint coverage_framebuffer;
+    int coverage_width, coverage_height;    // the frame's size it was made for
+    unsigned int waves;             // the last flush's
+} ShapeRenderer;
+
+// Needs a current context. "max_vertices" and "max_indices" size the streams: a frame's batch beyond them is cut.
+bool shape_renderer_init(ShapeRenderer* sr, uint32_t max_vertices, uint32_t max_indices);
+void shape_renderer_destroy(ShapeRenderer* sr);
+
+// Draws the batch over the bound draw framebuffer, "width" x "height" pixels, and clears it. Once a frame. Leaves
+// blending off, the depth test and face culling as it found them and the framebuffer bound; returns the draws made.
+// Paths go in whole or not at all: when their vertices or indices don't fit after the other shapes', they're
+// dropped.
+unsigned int shape_renderer_flush(ShapeRenderer* sr, ShapeBatch* batch, int width, int height);
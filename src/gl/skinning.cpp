@@ -0,0 +1,150 @@
+#include "gl/skinning.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool skinned_batch_init(SkinnedBatch* batch, const VertexFormat* format, const void* vertices, size_t vertex_count,
+    const uint32_t* indices, size_t index_count, uint32_t joint_count, uint32_t max_instances)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->joint_count = joint_count;
+    batch->max_instances = max_instances;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &batch->palette_alignment);
+    if (batch->palette_alignment < 16)
+        batch->palette_alignment = 16;
+    const GLsizeiptr palette_bytes = (GLsizeiptr)sizeof(mat3x4) * joint_count * max_instances;
+    if (!stream_buffer_init(&batch->palettes, GL_SHADER_STORAGE_BUFFER, palette_bytes + batch->palette_alignment))
+    {
+        fprintf(stderr, "skinning: can't create a palette ring of %lld bytes a frame\n", (long long)palette_bytes);
+        return false;
+    }
+    gl_debug_label(GL_BUFFER, batch->palettes.buffer, "skinning palettes");
+    gl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Bound before the mesh is made, since its element buffer binding lands in whatever vertex array is bound
+    batch->vertex_array = gl_dsa_create_vertex_array();
+    gl_state_bind_vertex_array(batch->vertex_array);
+    gl_debug_label(GL_VERTEX_ARRAY, batch->vertex_array, "skinned vertex array");
+    gpu_mesh_init(&batch->mesh, vertices, format->stride, vertex_count, indices, index_count);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, batch->mesh.vertex_buffer);
+    vertex_format_apply(format, 0);
+    return true;
+}
+
+void skinned_batch_destroy(SkinnedBatch* batch)
+{
+    if (batch->vertex_array)
+    {
+        gpu_mesh_destroy(&batch->mesh);
+        gl_state_delete_vertex_arrays(1, &batch->vertex_array);
+    }
+    if (batch->palettes.buffer)
+        stream_buffer_destroy(&batch->palettes);
+    if (batch->baked_palettes)
+        gl_state_delete_textures(1, &batch->baked_palettes);
+    if (batch->baked_instances)
+        gl_state_delete_buffers(1, &batch->baked_instances);
+    batch->vertex_array = 0;
+    batch->baked_palettes = batch->baked_instances = 0;
+}
+
+bool skinned_batch_bake(SkinnedBatch* batch, const SkinnedClip* clips, uint32_t clip_count,
+    const SkinnedInstance* instances, uint32_t instance_count)
+{
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    uint32_t rows = 0;
+    for (uint32_t c = 0; c < clip_count; ++c)
+        rows += clips[c].frame_count;
+    if (clip_count < 1 || clip_count > SKINNING_BAKED_MAX_CLIPS || !instance_count || rows > (uint32_t)max_size
+        || 3 * batch->joint_count > (uint32_t)max_size)
+    {
+        fprintf(stderr, "skinning: can't bake %u clips of %u frames in all for %u characters\n", clip_count, rows,
+            instance_count);
+        return false;
+    }
+
+    // A row a frame, the clips one under another: a mat3x4's three rows are a joint's three texels
+    const GLsizei width = (GLsizei)(3 * batch->joint_count);
+    glGenTextures(1, &batch->baked_palettes);
+    gl_state_bind_texture(SKINNING_BAKED_UNIT, GL_TEXTURE_2D, batch->baked_palettes);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, (GLsizei)rows);
+    gl_memory_texture(batch->baked_palettes, GPU_MEMORY_TEXTURES, GL_RGBA32F, width, (GLsizei)rows, 1, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl_debug_label(GL_TEXTURE, batch->baked_palettes, "skinning baked palettes");
+    uint32_t row = 0;
+    memset(batch->baked_clips, 0, sizeof(batch->baked_clips));
+    for (uint32_t c = 0; c < clip_count; ++c)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint)row, width, (GLsizei)clips[c].frame_count, GL_RGBA, GL_FLOAT,
+            clips[c].palettes);
+        batch->baked_clips[c][0] = (float)row;
+        batch->baked_clips[c][1] = (float)clips[c].frame_count;
+        batch->baked_clips[c][2] = clips[c].frame_rate;
+        row += clips[c].frame_count;
+    }
+    gl_state_bind_texture(SKINNING_BAKED_UNIT, GL_TEXTURE_2D, 0);
+
+    const GLsizeiptr bytes = (GLsizeiptr)sizeof(SkinnedInstance) * instance_count;
+    batch->baked_instances = gl_dsa_create_buffer(bytes, instances, GL_STATIC_DRAW);
+    gl_memory_buffer(batch->baked_instances, GPU_MEMORY_STORAGE, (size_t)bytes);
+    gl_debug_label(GL_BUFFER, batch->baked_instances, "skinning baked instances");
+    if (batch->palettes.buffer)
+        stream_buffer_destroy(&batch->palettes);
+    batch->clip_count = clip_count;
+    batch->instance_count = instance_count;
+    return true;
+}
+
+void skinned_batch_program(const SkinnedBatch* batch, GLuint program)
+{
+    gl_state_use_program(program);
+    if (batch->baked_palettes)
+        glUniform4fv(glGetUniformLocation(program, "bakedClips"), (GLsizei)batch->clip_count, batch->baked_clips[0]);
+    else
+        glUniform1i(glGetUniformLocation(program, "jointCount"), (GLint)batch->joint_count);
+}
+
+bool skinned_batch_upload(SkinnedBatch* batch, const mat3x4* palettes, uint32_t instance_count)
+{
+    if (batch->baked_palettes)
+        return false;
+    batch->instance_count = 0;
+    stream_buffer_begin_frame(&batch->palettes);
+    if (instance_count > batch->max_instances)
+        return false;
+    const GLsizeiptr bytes = (GLsizeiptr)sizeof(mat3x4) * batch->joint_count * instance_count;
+    void* dst = stream_buffer_alloc(&batch->palettes, bytes, batch->palette_alignment, &batch->palette_offset);
+    if (!dst)
+        return false;
+    memcpy(dst, palettes, (size_t)bytes);
+    stream_buffer_commit(&batch->palettes);
+    batch->instance_count = instance_count;
+    return true;
+}
+
+void skinned_batch_draw(SkinnedBatch* batch)
+{
+    if (batch->baked_palettes)
+    {
+        gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, SKINNING_BINDING, batch->baked_instances);
+        gl_state_bind_texture(SKINNING_BAKED_UNIT, GL_TEXTURE_2D, batch->baked_palettes);
+        gl_state_bind_vertex_array(batch->vertex_array);
+        gpu_mesh_draw_instanced(&batch->mesh, (GLsizei)batch->instance_count);
+        return;
+    }
+    if (batch->instance_count)
+    {
+        gl_state_bind_buffer_range(GL_SHADER_STORAGE_BUFFER, SKINNING_BINDING, batch->palettes.buffer,
+            batch->palette_offset, (GLsizeiptr)sizeof(mat3x4) * batch->joint_count * batch->instance_count);
+        gl_state_bind_vertex_array(batch->vertex_array);
+        gpu_mesh_draw_instanced(&batch->mesh, (GLsizei)batch->instance_count);
+    }
+    stream_buffer_end_frame(&batch->palettes);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/mesh.h"
+#include "gl/stream_buffer.h"
+#include "gl/vertex_format.h"
+#include "linmath_affine.h"
+
+#include <stdint.h>
+
+// Linear blend skinning on the GPU (needs a 4.3 context): one skinned mesh,
+// drawn instanced, one instance per character. The CPU writes every
+// character's palette (gl/../scene/animation.h) into a ring of shader
+// storage (STREAM_BUFFER_FRAMES frames of it, persistently mapped on 4.4+),
+// and the vertex shader blends up to four of them per vertex, found at
+// gl_InstanceID * jointCount + the vertex's joint index. A palette is a
+// std430 mat3x4 per joint, 48 bytes, in the same row-major layout the
+// instance matrices use; the constant bottom row never goes up.
+//
+// SKINNING_GLSL is the vertex stage's side of it: #included by the scene
+// shaders' SKINNED variant, whose vertex stage replaces the instance matrix
+// with skinMatrix().
+//
+// Baked instead (skinned_batch_bake), there's no per-frame palette at all.
+// Each clip is baked once into rows of an RGBA32F texture, one row a frame
+// at the identity placement and three texels a joint (the mat3x4's rows),
+// the clips one under another. The instances go into shader storage once:
+// a placement, a clip index and a time offset each. SKINNING_BAKED_GLSL's
+// skinMatrix() finds the instance's two frames around the Frame block's
+// time, blends each joint's matrices between them and the joints by their
+// weights, and multiplies the placement in. The CPU's part of a frame is a
+// draw, whatever the crowd's size; the price is a matrix lerp between baked
+// frames where the CPU nlerps keys, so a clip is best baked at a few times
+// its key rate.
+
+#define SKINNING_BINDING 6          // the Palettes block's shader storage binding, as in SKINNING_GLSL
+#define SKINNING_JOINTS_LOCATION 6  // vJoints: 4 x VERTEX_ATTRIB_UINT8
+#define SKINNING_WEIGHTS_LOCATION 7 // vWeights: 4 x VERTEX_ATTRIB_UNORM8, summing to 1
+
+#define SKINNING_BAKED_UNIT 6      // the baked palettes' texture unit, as in SKINNING_BAKED_GLSL
+#define SKINNING_BAKED_MAX_CLIPS 8  // the bakedClips table's length
+
+#define SKINNING_GLSL \
+    "layout(std430, binding = 6) readonly buffer Palettes\n" \
+    "{\n" \
+    "    mat3x4 palettes[];\n" \
+    "};\n" \
+    "layout(location = 6) in uvec4 vJoints;\n" \
+    "layout(location = 7) in vec4 vWeights;\n" \
+    "uniform int jointCount;\n" \
+    "mat3x4 skinMatrix()\n" \
+    "{\n" \
+    "    int base = gl_InstanceID * jointCount;\n" \
+    "    return palettes[base + int(vJoints.x)] * vWeights.x + palettes[base + int(vJoints.y)] * vWeights.y\n" \
+    "        + palettes[base + int(vJoints.z)] * vWeights.z + palettes[base + int(vJoints.w)] * vWeights.w;\n" \
+    "}\n"
+
+// bakedClips[clip]: x = first row, y = frames, z = frames per second
+#define SKINNING_BAKED_GLSL \
+    "struct BakedInstance\n" \
+    "{\n" \
+    "    mat3x4 placement;\n" \
+    "    uint clip;\n" \
+    "    float offset;\n" \
+    "};\n" \
+    "layout(std430, binding = 6) readonly buffer BakedInstances\n" \
+    "{\n" \
+    "    BakedInstance bakedInstances[];\n" \
+    "};\n" \
+    "layout(binding = 6) uniform sampler2D bakedPalettes;\n" \
+    "uniform vec4 bakedClips[8];\n" \
+    "layout(location = 6) in uvec4 vJoints;\n" \
+    "layout(location = 7) in vec4 vWeights;\n" \
+    "mat3x4 bakedJoint(uint joint, int row0, int row1, float alpha)\n" \
+    "{\n" \
+    "    int x = 3 * int(joint);\n" \
+    "    mat3x4 a = mat3x4(texelFetch(bakedPalettes, ivec2(x, row0), 0),\n" \
+    "        texelFetch(bakedPalettes, ivec2(x + 1, row0), 0), texelFetch(bakedPalettes, ivec2(x + 2, row0), 0));\n" \
+    "    mat3x4 b = mat3x4(texelFetch(bakedPalettes, ivec2(x, row1), 0),\n" \
+    "        texelFetch(bakedPalettes, ivec2(x + 1, row1), 0), texelFetch(bakedPalettes, ivec2(x + 2, row1), 0));\n" \
+    "    return a * (1.0 - alpha) + b * alpha;\n" \
+    "}\n" \
+    "mat3x4 skinMatrix()\n" \
+    "{\n" \
+    "    BakedInstance instance = bakedInstances[gl_InstanceID];\n" \
+    "    vec4 clip = bakedClips[instance.clip];\n" \
+    "    float frame = mod((time.x + instance.offset) * clip.z, clip.y);\n" \
+    "    int frames = int(clip.y), f0 = min(int(frame), frames - 1), f1 = f0 + 1 < frames ? f0 + 1 : 0;\n" \
+    "    float alpha = frame - float(f0);\n" \
+    "    int row0 = int(clip.x) + f0, row1 = int(clip.x) + f1;\n" \
+    "    mat3x4 pose = bakedJoint(vJoints.x, row0, row1, alpha) * vWeights.x\n" \
+    "        + bakedJoint(vJoints.y, row0, row1, alpha) * vWeights.y\n" \
+    "        + bakedJoint(vJoints.z, row0, row1, alpha) * vWeights.z\n" \
+    "        + bakedJoint(vJoints.w, row0, row1, alpha) * vWeights.w;\n" \
+    "    mat3x4 p = instance.placement;\n" \
+    "    return mat3x4(p[0].x * pose[0] + p[0].y * pose[1] + p[0].z * pose[2] + vec4(0.0, 0.0, 0.0, p[0].w),\n" \
+    "        p[1].x * pose[0] + p[1].y * pose[1] + p[1].z * pose[2] + vec4(0.0, 0.0, 0.0, p[1].w),\n" \
+    "        p[2].x * pose[0] + p[2].y * pose[1] + p[2].z * pose[2] + vec4(0.0, 0.0, 0.0, p[2].w));\n" \
+    "}\n"
+
+// One character of a baked crowd, as SKINNING_BAKED_GLSL's BakedInstance (std430, 64 bytes)
+typedef struct SkinnedInstance
+{
+    mat3x4 placement;
+    uint32_t clip;              // into the clips skinned_batch_bake was given
+    float offset;               // seconds into it at time 0
+    float pad[2];
+} SkinnedInstance;
+
+// A clip's baked palettes (animation_clip_bake's), joint_count a frame, looping at "frame_rate" frames a second
+typedef struct SkinnedClip
+{
+    const mat3x4* palettes;
+    uint32_t frame_count;
+    float frame_rate;
+} SkinnedClip;
+
+typedef struct SkinnedBatch
+{
+    GpuMesh mesh;
+    GLuint vertex_array;        // the mesh's attributes, joints and weights included
+    StreamBuffer palettes;      // GL_SHADER_STORAGE_BUFFER, max_instances palettes per frame
+    GLint palette_alignment;    // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+    uint32_t joint_count;
+    uint32_t max_instances;
+    GLintptr palette_offset;    // this frame's palettes, once uploaded
+    uint32_t instance_count;    // this frame's, 0 until uploaded; once baked, the crowd's
+
+    // Baked: no ring, and both written once
+    GLuint baked_palettes;      // GL_RGBA32F, 3 * joint_count texels across, a row a frame of every clip
+    GLuint baked_instances;     // GL_SHADER_STORAGE_BUFFER, SkinnedInstance per character
+    float baked_clips[SKINNING_BAKED_MAX_CLIPS][4];     // bakedClips
+    uint32_t clip_count;
+} SkinnedBatch;
+
+// Uploads the mesh, packed as "format" describes (which must include the joints and weights at their
+// locations), and sets up the palette ring for up to "max_instances" characters of "joint_count" joints.
+// Leaves its vertex array bound. Logs and returns false when the ring can't be created.
+bool skinned_batch_init(SkinnedBatch* batch, const VertexFormat* format, const void* vertices, size_t vertex_count,
+    const uint32_t* indices, size_t index_count, uint32_t joint_count, uint32_t max_instances);
+void skinned_batch_destroy(SkinnedBatch* batch);
+
+// Switches the batch to baked clips: drops the palette ring, uploads the clips' frames and "instance_count"
+// characters, and from then on draws them all with no upload. Logs and returns false, leaving the batch as it was,
+// when there are too many clips, frames or instances for it or the texture.
+bool skinned_batch_bake(SkinnedBatch* batch, const SkinnedClip* clips, uint32_t clip_count,
+    const SkinnedInstance* instances, uint32_t instance_count);
+
+// Points a newly built program at the batch: its jointCount, or once baked its clip table
+void skinned_batch_program(const SkinnedBatch* batch, GLuint program);
+
+// Copies this frame's palettes ("instance_count" characters' worth, joint-major within each) into the ring.
+// Returns false, drawing nothing this frame, when there are more than max_instances of them or the batch is baked.
+bool skinned_batch_upload(SkinnedBatch* batch, const mat3x4* palettes, uint32_t instance_count);
+
+// Draws the uploaded instances with the bound program (set up by skinned_batch_program) and uniform blocks, then
+// fences the frame's palettes. Once per frame, after skinned_batch_upload; baked, with no upload.
+void skinned_batch_draw(SkinnedBatch* batch);
@@ -0,0 +1,132 @@
+#include "gl/stream_buffer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const GLbitfield persistent_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+bool stream_buffer_init(StreamBuffer* sb, GLenum target, GLsizeiptr bytes_per_frame)
+{
+    memset(sb, 0, sizeof(*sb));
+    sb->target = target;
+    // Every region starts aligned for any binding, so its first allocation gets the whole of bytes_per_frame
+    const GLsizeiptr region_align = STREAM_BUFFER_REGION_ALIGN;
+    bytes_per_frame = (bytes_per_frame + region_align - 1) & ~(region_align - 1);
+    sb->region_size = bytes_per_frame;
+
+    glGenBuffers(1, &sb->buffer);
+    gl_state_bind_buffer(target, sb->buffer);
+
+    // glad only loads glBufferStorage when the context is 4.4 or newer
+    if (glBufferStorage)
+    {
+        const GLsizeiptr total = bytes_per_frame * STREAM_BUFFER_FRAMES;
+        glBufferStorage(target, total, NULL, persistent_flags);
+        sb->mapped = (unsigned char*)glMapBufferRange(target, 0, total, persistent_flags);
+        sb->persistent = sb->mapped != NULL;
+        if (!sb->persistent)
+        {
+            // Immutable storage can't be respecified, so start over with a mutable buffer
+            gl_state_delete_buffers(1, &sb->buffer);
+            glGenBuffers(1, &sb->buffer);
+            gl_state_bind_buffer(target, sb->buffer);
+        }
+    }
+
+    if (!sb->persistent)
+        glBufferData(target, bytes_per_frame, NULL, GL_STREAM_DRAW);
+    gl_memory_buffer(sb->buffer, GPU_MEMORY_STAGING, sb->persistent ? bytes_per_frame * STREAM_BUFFER_FRAMES : bytes_per_frame);
+
+    return sb->buffer != 0;
+}
+
+void stream_buffer_destroy(StreamBuffer* sb)
+{
+    for (int i = 0; i < STREAM_BUFFER_FRAMES; ++i)
+    {
+        if (sb->fences[i])
+            glDeleteSync(sb->fences[i]);
+    }
+    if (sb->mapped)
+    {
+        gl_state_bind_buffer(sb->target, sb->buffer);
+        glUnmapBuffer(sb->target);
+    }
+    gl_state_delete_buffers(1, &sb->buffer);
+    memset(sb, 0, sizeof(*sb));
+}
+
+void stream_buffer_begin_frame(StreamBuffer* sb)
+{
+    sb->head = 0;
+
+    if (sb->persistent)
+    {
+        // Block only if the GPU still reads the region we submitted STREAM_BUFFER_FRAMES frames ago
+        GLsync fence = sb->fences[sb->region];
+        if (fence)
+        {
+            GLenum status = glClientWaitSync(fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                ++sb->wait_count;
+                do
+                    status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);    // 1 ms slices
+                while (status == GL_TIMEOUT_EXPIRED);
+            }
+            glDeleteSync(fence);
+            sb->fences[sb->region] = NULL;
+        }
+        return;
+    }
+
+    // Orphan: the driver hands us fresh storage while the GPU keeps reading the old one
+    gl_state_bind_buffer(sb->target, sb->buffer);
+    glBufferData(sb->target, sb->region_size, NULL, GL_STREAM_DRAW);
+    sb->mapped = (unsigned char*)glMapBufferRange(sb->target, 0, sb->region_size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void* stream_buffer_alloc(StreamBuffer* sb, GLsizeiptr size, GLsizeiptr align, GLintptr* offset)
+{
+    // Aligned within the whole buffer, not just the region, for an "align" past STREAM_BUFFER_REGION_ALIGN
+    const GLintptr region_base = sb->persistent ? sb->region_size * sb->region : 0;
+    const GLsizeiptr start = ((region_base + sb->head + align - 1) & ~(align - 1)) - region_base;
+    if (!sb->mapped || start + size > sb->region_size)
+    {
+        fprintf(stderr, "stream_buffer: frame region full (%lld of %lld bytes requested)\n",
+            (long long)(start + size), (long long)sb->region_size);
+        return NULL;
+    }
+
+    sb->head = start + size;
+    draw_counters_upload((size_t)size);     // written by the caller through the mapping
+    *offset = region_base + start;
+    return sb->mapped + region_base + start;
+}
+
+void stream_buffer_commit(StreamBuffer* sb)
+{
+    if (sb->persistent || !sb->mapped)
+        return;
+
+    gl_state_bind_buffer(sb->target, sb->buffer);
+    glUnmapBuffer(sb->target);
+    sb->mapped = NULL;
+}
+
+void stream_buffer_end_frame(StreamBuffer* sb)
+{
+    if (!sb->persistent)
+    {
+        stream_buffer_commit(sb);
+        return;
+    }
+
+    sb->fences[sb->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    sb->region = (sb->region + 1) % STREAM_BUFFER_FRAMES;
+}
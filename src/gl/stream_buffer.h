@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <stddef.h>
+
+// Ring-buffer allocator for data written by the CPU every frame (instance
+// matrices, per-frame uniforms, dynamic vertices).
+//
+// On GL 4.4+ the buffer is created once with glBufferStorage and stays
+// persistently and coherently mapped; it holds STREAM_BUFFER_FRAMES regions
+// and each region is fenced with glFenceSync when its frame is submitted, so
+// the CPU only waits if it laps the GPU. On 3.3 contexts the buffer holds one
+// region that is orphaned (glBufferData with NULL) and mapped at the start of
+// every frame instead.
+//
+// Per frame: stream_buffer_begin_frame, any number of stream_buffer_alloc (write
+// through the returned pointer), stream_buffer_commit before the draws that
+// read the data, then stream_buffer_end_frame after those draws.
+
+#define STREAM_BUFFER_FRAMES 3
+#define STREAM_BUFFER_REGION_ALIGN 256  // regions start on this: the most GL's *_OFFSET_ALIGNMENT limits can be
+
+typedef struct StreamBuffer
+{
+    GLuint buffer;              // GL buffer name
+    GLenum target;              // bind point used for mapping (GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, ...)
+    GLsizeiptr region_size;     // bytes available per frame: bytes_per_frame, rounded up to STREAM_BUFFER_REGION_ALIGN
+    bool persistent;            // true when glBufferStorage + persistent mapping is in use
+    int region;                 // region written this frame (always 0 when orphaning)
+    GLsizeiptr head;            // bytes used in the current region
+    unsigned char* mapped;      // base of the mapping (whole buffer when persistent, current frame when orphaning)
+    GLsync fences[STREAM_BUFFER_FRAMES];
+    size_t wait_count;          // begin_frame calls that had to block on a fence
+} StreamBuffer;
+
+// Creates the buffer. "bytes_per_frame" is the most the caller will allocate in one frame.
+bool stream_buffer_init(StreamBuffer* sb, GLenum target, GLsizeiptr bytes_per_frame);
+void stream_buffer_destroy(StreamBuffer* sb);
+
+// Waits until the GPU is done with the region about to be reused and makes it writable.
+void stream_buffer_begin_frame(StreamBuffer* sb);
+
+// Returns a write pointer for "size" bytes and stores its offset into the buffer in
+// "offset", a multiple of "align" (a power of two) within the whole buffer. Returns NULL
+// when the frame's region is full.
+void* stream_buffer_alloc(StreamBuffer* sb, GLsizeiptr size, GLsizeiptr align, GLintptr* offset);
+
+// Makes this frame's writes visible to GL. No-op for the coherent persistent mapping.
+void stream_buffer_commit(StreamBuffer* sb);
+
+// Fences the region used this frame and advances to the next one.
+void stream_buffer_end_frame(StreamBuffer* sb);
@@ -0,0 +1,49 @@
+#include "gl/swap_damage.h"
+
+#include <string.h>
+
+// EGL's types, as far as these calls need them: EGLDisplay and EGLSurface are opaque, EGLint is 32 bits
+#define EGL_EXTENSIONS 0x3055
+#define EGL_DRAW 0x3059
+
+typedef void* (*GetCurrentDisplay)();
+typedef void* (*GetCurrentSurface)(int readdraw);
+typedef const char* (*QueryString)(void* display, int name);
+typedef unsigned int (*SwapBuffersWithDamage)(void* display, void* surface, const int* rects, int count);
+
+// "name" as a whole word of the space-separated "list"
+static bool has_extension(const char* list, const char* name)
+{
+    const size_t length = strlen(name);
+    for (const char* at = list; (at = strstr(at, name)) != NULL; at += length)
+    {
+        if ((at == list || at[-1] == ' ') && (at[length] == ' ' || at[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+bool swap_damage_init(SwapDamage* d)
+{
+    memset(d, 0, sizeof(*d));
+    const GetCurrentDisplay display_of = (GetCurrentDisplay)glfwGetProcAddress("eglGetCurrentDisplay");
+    const GetCurrentSurface surface_of = (GetCurrentSurface)glfwGetProcAddress("eglGetCurrentSurface");
+    const QueryString query = (QueryString)glfwGetProcAddress("eglQueryString");
+    if (!display_of || !surface_of || !query)
+        return false;
+    d->display = display_of();
+    d->surface = surface_of(EGL_DRAW);
+    const char* extensions = d->display ? query(d->display, EGL_EXTENSIONS) : NULL;
+    if (!d->surface || !extensions)
+        return false;
+    if (has_extension(extensions, "EGL_KHR_swap_buffers_with_damage"))
+        d->swap = (SwapBuffersWithDamage)glfwGetProcAddress("eglSwapBuffersWithDamageKHR");
+    else if (has_extension(extensions, "EGL_EXT_swap_buffers_with_damage"))
+        d->swap = (SwapBuffersWithDamage)glfwGetProcAddress("eglSwapBuffersWithDamageEXT");
+    return d->swap != NULL;
+}
+
+void swap_damage_swap(const SwapDamage* d, const int* rects, int count)
+{
+    d->swap(d->display, d->surface, rects, count);
+}
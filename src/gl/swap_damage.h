@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glad/glad.h>
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+// Partial presents: EGL_KHR_swap_buffers_with_damage (or EGL_EXT's original)
+// swaps the whole back buffer but tells the compositor which rectangles of it
+// changed, so it only recomposites those. --on-demand uses it for frames that
+// only refresh the overlay.
+//
+// Found at run time, like gl/swap_group.h: the EGL entry points come from
+// glfwGetProcAddress, so no EGL library is linked. GLX and WGL contexts (the
+// default outside --egl) have no equivalent and always swap whole.
+
+typedef struct SwapDamage
+{
+    void* display;              // EGLDisplay, EGLSurface: the current context's, at init
+    void* surface;
+    unsigned int (*swap)(void* display, void* surface, const int* rects, int count);   // NULL without the extension
+} SwapDamage;
+
+// The current context's surface. False (and d->swap NULL) without an EGL context or the extension.
+bool swap_damage_init(SwapDamage* d);
+
+// Swaps the window "d" was set up for with "count" rectangles of damage, x, y, width, height each in pixels
+// from the bottom left. 0 rectangles is the whole window.
+void swap_damage_swap(const SwapDamage* d, const int* rects, int count);
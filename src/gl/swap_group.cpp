@@ -0,0 +1,79 @@
+#include "gl/swap_group.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+typedef BOOL(WINAPI* JoinSwapGroup)(HDC dc, GLuint group);
+typedef BOOL(WINAPI* BindSwapBarrier)(GLuint group, GLuint barrier);
+typedef BOOL(WINAPI* QueryMaxSwapGroups)(HDC dc, GLuint* groups, GLuint* barriers);
+
+bool swap_group_join(GLuint group, GLuint barrier, bool* bound)
+{
+    *bound = false;
+    if (!glfwExtensionSupported("WGL_NV_swap_group"))
+        return false;
+    const JoinSwapGroup join = (JoinSwapGroup)glfwGetProcAddress("wglJoinSwapGroupNV");
+    const BindSwapBarrier bind = (BindSwapBarrier)glfwGetProcAddress("wglBindSwapBarrierNV");
+    const QueryMaxSwapGroups query = (QueryMaxSwapGroups)glfwGetProcAddress("wglQueryMaxSwapGroupsNV");
+    HDC dc = wglGetCurrentDC();
+    GLuint groups = 0, barriers = 0;
+    if (!join || !bind || !query || !dc || !query(dc, &groups, &barriers) || group > groups || !join(dc, group))
+        return false;
+    *bound = barrier && barrier <= barriers && bind(group, barrier);
+    return true;
+}
+
+void swap_group_leave(GLuint group)
+{
+    const JoinSwapGroup join = (JoinSwapGroup)glfwGetProcAddress("wglJoinSwapGroupNV");
+    const BindSwapBarrier bind = (BindSwapBarrier)glfwGetProcAddress("wglBindSwapBarrierNV");
+    HDC dc = wglGetCurrentDC();
+    if (!join || !bind || !dc)
+        return;
+    bind(group, 0);
+    join(dc, 0);
+}
+#else
+// GLX's types, as far as these calls need them: Display* is opaque here and a GLXDrawable is an XID
+typedef void* (*GetCurrentDisplay)();
+typedef unsigned long (*GetCurrentDrawable)();
+typedef int (*JoinSwapGroup)(void* display, unsigned long drawable, GLuint group);
+typedef int (*BindSwapBarrier)(void* display, GLuint group, GLuint barrier);
+typedef int (*QueryMaxSwapGroups)(void* display, int screen, GLuint* groups, GLuint* barriers);
+
+bool swap_group_join(GLuint group, GLuint barrier, bool* bound)
+{
+    *bound = false;
+    if (!glfwExtensionSupported("GLX_NV_swap_group"))
+        return false;
+    const GetCurrentDisplay display_of = (GetCurrentDisplay)glfwGetProcAddress("glXGetCurrentDisplay");
+    const GetCurrentDrawable drawable_of = (GetCurrentDrawable)glfwGetProcAddress("glXGetCurrentDrawable");
+    const JoinSwapGroup join = (JoinSwapGroup)glfwGetProcAddress("glXJoinSwapGroupNV");
+    const BindSwapBarrier bind = (BindSwapBarrier)glfwGetProcAddress("glXBindSwapBarrierNV");
+    const QueryMaxSwapGroups query = (QueryMaxSwapGroups)glfwGetProcAddress("glXQueryMaxSwapGroupsNV");
+    if (!display_of || !drawable_of || !join || !bind || !query)
+        return false;
+    void* display = display_of();
+    const unsigned long drawable = drawable_of();
+    GLuint groups = 0, barriers = 0;
+    if (!display || !drawable || !query(display, 0, &groups, &barriers) || group > groups
+        || !join(display, drawable, group))
+        return false;
+    *bound = barrier && barrier <= barriers && bind(display, group, barrier);
+    return true;
+}
+
+void swap_group_leave(GLuint group)
+{
+    const GetCurrentDisplay display_of = (GetCurrentDisplay)glfwGetProcAddress("glXGetCurrentDisplay");
+    const GetCurrentDrawable drawable_of = (GetCurrentDrawable)glfwGetProcAddress("glXGetCurrentDrawable");
+    const JoinSwapGroup join = (JoinSwapGroup)glfwGetProcAddress("glXJoinSwapGroupNV");
+    const BindSwapBarrier bind = (BindSwapBarrier)glfwGetProcAddress("glXBindSwapBarrierNV");
+    if (!display_of || !drawable_of || !join || !bind || !display_of())
+        return;
+    bind(display_of(), group, 0);
+    join(display_of(), drawable_of(), 0);
+}
+#endif
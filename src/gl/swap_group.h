@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glad/glad.h>
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+// NV_swap_group (WGL_NV_swap_group / GLX_NV_swap_group): the windows in a
+// swap group swap together, and a group bound to a swap barrier swaps
+// together with the groups on the other machines bound to it, through a frame
+// lock board (Quadro Sync). With vsync on that makes the swaps of a
+// distributed wall (core/wall_sync.h) land on the same refresh, which the
+// network barrier alone only gets within a round trip of.
+//
+// Found at run time: the function pointers come from glfwGetProcAddress, and
+// on GLX so do the current display and drawable, so no platform GL header is
+// needed. Where the extension isn't there, joining returns false and swaps
+// are only as aligned as the network barrier makes them.
+
+// Joins the current context's window to "group", and the group to "barrier" when there's one that many and
+// "barrier" isn't 0. Returns false when the extension isn't supported or the join failed; *bound says whether
+// the barrier was bound too.
+bool swap_group_join(GLuint group, GLuint barrier, bool* bound);
+
+// Unbinds "group" from its barrier and leaves it. Needs the same context current.
+void swap_group_leave(GLuint group);
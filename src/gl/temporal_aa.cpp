@@ -0,0 +1,191 @@
+#include "gl/temporal_aa.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// A triangle over the whole viewport
+static const char* taa_vertex_shader_text =
+"#version 330\n"
+"void main()\n"
+"{\n"
+"    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+"    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+// The pixel's point (its clip position and depth) through the reprojection: how far it moved since last frame.
+// A point behind last frame's camera gets a motion that leaves the screen.
+static const char* motion_fragment_shader_text =
+"#version 330\n"
+"uniform sampler2D depth;\n"
+"uniform mat4 reprojection;\n"
+"uniform vec3 view;\n"          // xy: the drawn size in pixels; z: 1 for a [0, 1] clip depth
+"layout(location = 0) out vec2 motion;\n"
+"void main()\n"
+"{\n"
+"    float d = texelFetch(depth, ivec2(gl_FragCoord.xy), 0).r;\n"
+"    vec4 clip = vec4(gl_FragCoord.xy / view.xy * 2.0 - 1.0, view.z != 0.0 ? d : d * 2.0 - 1.0, 1.0);\n"
+"    vec4 previous = reprojection * clip;\n"
+"    if (previous.w <= 0.0)\n"
+"    {\n"
+"        motion = vec2(view.xy * 2.0);\n"
+"        return;\n"
+"    }\n"
+"    motion = gl_FragCoord.xy - (previous.xy / previous.w * 0.5 + 0.5) * view.xy;\n"
+"}\n";
+
+// The history where the pixel was, clamped to this frame's neighbourhood, with the current frame blended in
+static const char* resolve_fragment_shader_text =
+"#version 330\n"
+"uniform sampler2D current;\n"
+"uniform sampler2D history;\n"
+"uniform sampler2D motion;\n"
+"uniform vec4 view;\n"          // xy: the drawn size in pixels; z: the current frame's weight; w: 1 with a history
+"layout(location = 0) out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+"    ivec2 last = ivec2(view.xy) - 1;\n"
+"    vec3 c = texelFetch(current, pixel, 0).rgb;\n"
+"    vec3 lo = c, hi = c;\n"
+"    for (int y = -1; y <= 1; ++y)\n"
+"        for (int x = -1; x <= 1; ++x)\n"
+"        {\n"
+"            vec3 n = texelFetch(current, clamp(pixel + ivec2(x, y), ivec2(0), last), 0).rgb;\n"
+"            lo = min(lo, n);\n"
+"            hi = max(hi, n);\n"
+"        }\n"
+"    vec2 previous = gl_FragCoord.xy - texelFetch(motion, pixel, 0).xy;\n"
+"    if (view.w == 0.0 || any(lessThan(previous, vec2(0.5))) || any(greaterThan(previous, view.xy - 0.5)))\n"
+"    {\n"
+"        fragment = vec4(c, 1.0);\n"
+"        return;\n"
+"    }\n"
+"    vec3 h = texture(history, previous / vec2(textureSize(history, 0))).rgb;\n"
+"    fragment = vec4(mix(clamp(h, lo, hi), c, view.z), 1.0);\n"
+"}\n";
+
+bool temporal_aa_init(TemporalAa* taa, bool zero_to_one)
+{
+    memset(taa, 0, sizeof(*taa));
+    temporal_init(&taa->temporal);
+    taa->zero_to_one = zero_to_one;
+
+    taa->motion_program = program_build(taa_vertex_shader_text, motion_fragment_shader_text, false);
+    taa->resolve_program = program_build(taa_vertex_shader_text, resolve_fragment_shader_text, false);
+    if (!taa->motion_program || !taa->resolve_program)
+    {
+        fprintf(stderr, "taa: can't build the motion or resolve program\n");
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, taa->motion_program, "taa motion");
+    gl_debug_label(GL_PROGRAM, taa->resolve_program, "taa resolve");
+    taa->motion_reprojection_location = glGetUniformLocation(taa->motion_program, "reprojection");
+    taa->motion_view_location = glGetUniformLocation(taa->motion_program, "view");
+    taa->resolve_view_location = glGetUniformLocation(taa->resolve_program, "view");
+    gl_state_use_program(taa->motion_program);
+    glUniform1i(glGetUniformLocation(taa->motion_program, "depth"), 0);
+    gl_state_use_program(taa->resolve_program);
+    glUniform1i(glGetUniformLocation(taa->resolve_program, "current"), 0);
+    glUniform1i(glGetUniformLocation(taa->resolve_program, "history"), 1);
+    glUniform1i(glGetUniformLocation(taa->resolve_program, "motion"), 2);
+    return true;
+}
+
+static void taa_release_textures(TemporalAa* taa)
+{
+    gl_state_delete_framebuffers(1, &taa->motion_framebuffer);
+    gl_state_delete_framebuffers(2, taa->history_framebuffers);
+    gl_state_delete_textures(1, &taa->motion);
+    gl_state_delete_textures(2, taa->history);
+    taa->width = taa->height = 0;
+    taa->history_written = false;
+}
+
+void temporal_aa_destroy(TemporalAa* taa)
+{
+    taa_release_textures(taa);
+    if (taa->motion_program)
+        glDeleteProgram(taa->motion_program);
+    if (taa->resolve_program)
+        glDeleteProgram(taa->resolve_program);
+    memset(taa, 0, sizeof(*taa));
+}
+
+// A texture of the given format with a framebuffer around it
+static void taa_make_target(GLuint* texture, GLuint* framebuffer, GLenum format, GLenum components, GLenum type,
+    GLint filter, int width, int height, const char* label)
+{
+    glGenTextures(1, texture);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, *texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, components, type, NULL);
+    gl_memory_texture(*texture, GPU_MEMORY_RENDER_TARGETS, format, width, height, 1, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    gl_debug_label(GL_TEXTURE, *texture, label);
+    glGenFramebuffers(1, framebuffer);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, *framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *texture, 0);
+    gl_debug_label(GL_FRAMEBUFFER, *framebuffer, label);
+}
+
+static void taa_fit_textures(TemporalAa* taa, const RenderTarget* target)
+{
+    if (taa->width == target->width && taa->height == target->height && taa->color_format == target->color_format)
+        return;
+    taa_release_textures(taa);
+    taa->width = target->width;
+    taa->height = target->height;
+    taa->color_format = target->color_format;
+    const bool half = target->color_format == GL_RGBA16F || target->color_format == GL_R11F_G11F_B10F;
+    taa_make_target(&taa->motion, &taa->motion_framebuffer, GL_RG16F, GL_RG, GL_HALF_FLOAT, GL_NEAREST,
+        taa->width, taa->height, "taa motion");
+    for (int i = 0; i < 2; ++i)
+        taa_make_target(&taa->history[i], &taa->history_framebuffers[i], half ? GL_RGBA16F : GL_RGBA8, GL_RGBA,
+            half ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE, GL_LINEAR, taa->width, taa->height, "taa history");
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+}
+
+void temporal_aa_resolve(TemporalAa* taa, const RenderTarget* target, int width, int height)
+{
+    taa_fit_textures(taa, target);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_BLEND, false);
+    gl_state_colour_mask(true);
+    gl_state_viewport(0, 0, width, height);
+
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, taa->motion_framebuffer);
+    gl_state_use_program(taa->motion_program);
+    glUniformMatrix4fv(taa->motion_reprojection_location, 1, GL_FALSE, &taa->temporal.reprojection[0][0]);
+    glUniform3f(taa->motion_view_location, (float)width, (float)height, taa->zero_to_one ? 1.f : 0.f);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, target->depth_stencil);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+
+    // Last frame's resolve is in the other history; a new size or format means there's none
+    const int previous = taa->current;
+    taa->current ^= 1;
+    const bool history = taa->history_written && taa->temporal.history_valid;
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, taa->history_framebuffers[taa->current]);
+    gl_state_use_program(taa->resolve_program);
+    glUniform4f(taa->resolve_view_location, (float)width, (float)height, TEMPORAL_AA_BLEND, history ? 1.f : 0.f);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, target->color);
+    gl_state_bind_texture(1, GL_TEXTURE_2D, taa->history[previous]);
+    gl_state_bind_texture(2, GL_TEXTURE_2D, taa->motion);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+    taa->history_written = true;
+
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, taa->history_framebuffers[taa->current]);
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, target->color_framebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, target->framebuffer);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/render_target.h"
+#include "scene/temporal.h"
+
+// Temporal antialiasing over the scene's offscreen target: the GL side of
+// scene/temporal.h. The renderer draws every frame with the jittered
+// projection, and this resolves it against the frames before.
+//
+// Two fullscreen passes (GLSL 330, a VAO bound by the caller). The first
+// reconstructs each pixel's point from the depth texture and takes it through
+// the reprojection to last frame's pixel: the motion vectors, in pixels, land
+// in an RG16F texture ("motion") that stays readable until the next frame for
+// any other effect that wants to reuse last frame's work. The second reads
+// the history there (bilinear), clamps it to the min and max of the current
+// frame's 3x3 neighbourhood - whatever the history holds that this frame
+// can't have come from (a disocclusion, an object that moved on its own) is
+// pulled back to what's there now - and blends in TEMPORAL_AA_BLEND of the
+// current frame. Without a history, or where the point was off screen last
+// frame, the current frame goes through as it is.
+//
+// The result goes to one of two history textures (ping-ponged, the target's
+// colour format) and is copied back into the target's colour, so everything
+// downstream (post-processing, the upscale, captures) reads it unchanged.
+
+#define TEMPORAL_AA_BLEND 0.1f      // of the current frame in each resolved one
+
+typedef struct TemporalAa
+{
+    Temporal temporal;          // the jitter and the reprojection; temporal_begin_frame is the renderer's to call
+    bool zero_to_one;           // the depth texture holds glClipControl's [0, 1] clip depth, not [-1, 1]'s
+    GLuint motion;              // RG16F: this pixel's position minus last frame's, in pixels
+    GLuint motion_framebuffer;
+    GLuint history[2];          // the resolved frames, colour format; "current" is this frame's
+    GLuint history_framebuffers[2];
+    int current;
+    int width;                  // the textures' size: the target's
+    int height;
+    GLenum color_format;
+    bool history_written;       // the other history holds last frame's resolve
+    GLuint motion_program;
+    GLint motion_reprojection_location;
+    GLint motion_view_location;
+    GLuint resolve_program;
+    GLint resolve_view_location;
+} TemporalAa;
+
+// "zero_to_one": glClipControl's [0, 1] depth range is on. Logs and returns false when a program can't be built.
+bool temporal_aa_init(TemporalAa* taa, bool zero_to_one);
+void temporal_aa_destroy(TemporalAa* taa);
+
+// The motion vectors, then the resolve, of the "width" x "height" corner of "target" (single-sampled, with a depth
+// texture) drawn with this frame's jitter. The textures follow the target's size and format. Leaves the target
+// bound for drawing, with blending and the depth test off.
+void temporal_aa_resolve(TemporalAa* taa, const RenderTarget* target, int width, int height);
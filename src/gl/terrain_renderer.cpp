@@ -0,0 +1,502 @@
+#include "gl/terrain_renderer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+#include "gl/uniforms.h"
+
+#include <chrono>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TERRAIN_RENDERER_UNIT 6     // the heights' texture unit: past the materials' arrays, before the shadow maps
+
+// The height under a point, bilinear from the finest level there is
+#define HEIGHT_GLSL \
+"uniform sampler2D heights;\n" \
+"uniform vec4 terrain;\n" \
+"uniform vec2 heightRange;\n" \
+"float height(vec2 p)\n" \
+"{\n" \
+"    return mix(heightRange.x, heightRange.y, textureLod(heights, (p - terrain.xy) / terrain.z, 0.0).r);\n" \
+"}\n"
+
+// A grid vertex from its index, in cells of its patch's level (the half grid's every other vertex of the whole
+// grid's, at half the patch's size, lands on whole cells too), morphed onto the grid of twice the cell as
+// scene/terrain.h has it
+#define MORPH_GLSL \
+"layout(location = 0) in vec4 vPatch;\n" \
+"layout(location = 1) in vec2 vMorph;\n" \
+"uniform vec3 eye;\n" \
+"vec2 morphed()\n" \
+"{\n" \
+"    int side = int(terrain.w) + 1;\n" \
+"    vec2 g = vec2(gl_VertexID % side, gl_VertexID / side) * (vPatch.z / vPatch.w) / terrain.w;\n" \
+"    vec2 p = vPatch.xy + g * vPatch.w;\n" \
+"    float morph = clamp((distance(eye, vec3(p, height(p))) - vMorph.x) / (vMorph.y - vMorph.x), 0.0, 1.0);\n" \
+"    return vPatch.xy + (g - mod(g, 2.0) * morph) * vPatch.w;\n" \
+"}\n"
+
+// The normal from the heights "step" either side
+#define NORMAL_GLSL \
+"vec3 terrainNormal(vec2 p, float step)\n" \
+"{\n" \
+"    vec2 dx = vec2(step, 0.0), dy = vec2(0.0, step);\n" \
+"    return normalize(vec3(height(p - dx) - height(p + dx), height(p - dy) - height(p + dy), 2.0 * step));\n" \
+"}\n"
+
+static const char* grid_vertex_shader_text =
+HEIGHT_GLSL
+MORPH_GLSL
+NORMAL_GLSL
+"out vec3 position;\n"
+"out vec3 normal;\n"
+"void main()\n"
+"{\n"
+"    vec2 p = morphed();\n"
+"    position = vec3(p, height(p));\n"
+"    normal = terrainNormal(p, vPatch.w);\n"
+"    gl_Position = viewProjection * vec4(position, 1.0);\n"
+"}\n";
+
+// Grass, rock where it's steep and snow on the flatter heights, in a fixed sun; with a virtual texture its detail
+// multiplied in, mid grey leaving the colour as it was
+static const char* fragment_shader_text =
+"uniform vec2 heightRange;\n"
+"#ifdef VIRTUAL_TEXTURE\n"
+"uniform vec4 terrain;\n"
+"#endif\n"
+"in vec3 position;\n"
+"in vec3 normal;\n"
+"layout(location = 0) out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    vec3 n = normalize(normal);\n"
+"    float slope = 1.0 - n.z;\n"
+"    float altitude = (position.z - heightRange.x) / (heightRange.y - heightRange.x);\n"
+"    vec3 albedo = mix(vec3(0.28, 0.42, 0.18), vec3(0.42, 0.38, 0.33), smoothstep(0.15, 0.35, slope));\n"
+"    albedo = mix(albedo, vec3(0.92), smoothstep(0.55, 0.7, altitude) * (1.0 - smoothstep(0.3, 0.5, slope)));\n"
+"#ifdef VIRTUAL_TEXTURE\n"
+"    albedo *= 2.0 * virtualSample((position.xy - terrain.xy) / terrain.z).rgb;\n"
+"#endif\n"
+"    float light = 0.15 + 0.85 * max(dot(n, normalize(vec3(0.4, 0.3, 0.85))), 0.0);\n"
+"    fragment = vec4(albedo * light, 1.0);\n"
+"}\n";
+
+// The virtual texture's feedback: the page the fragment shader above samples
+static const char* feedback_fragment_shader_text =
+"uniform vec4 terrain;\n"
+"in vec3 position;\n"
+"layout(location = 0) out uint page;\n"
+"void main()\n"
+"{\n"
+"    page = virtualPage((position.xy - terrain.xy) / terrain.z);\n"
+"}\n";
+
+// Tessellated: the vertex shader only morphs, the control shader sets each edge's factor from its two ends and the
+// evaluation shader places the new vertices
+static const char* tess_vertex_shader_text =
+HEIGHT_GLSL
+MORPH_GLSL
+"out vec2 controlPosition;\n"
+"out float controlCell;\n"
+"void main()\n"
+"{\n"
+"    controlPosition = morphed();\n"
+"    controlCell = vPatch.w;\n"
+"}\n";
+
+static const char* tess_control_shader_text =
+HEIGHT_GLSL
+"layout(vertices = 3) out;\n"
+"uniform vec3 eye;\n"
+"uniform vec3 tessellation;\n"    // pixels a unit spans 1 unit away, texel side, pixels aimed for
+"in vec2 controlPosition[];\n"
+"in float controlCell[];\n"
+"out vec2 evaluationPosition[];\n"
+"out float evaluationCell[];\n"
+"float edge(vec2 a, vec2 b)\n"
+"{\n"
+"    vec3 pa = vec3(a, height(a)), pb = vec3(b, height(b));\n"
+"    float len = distance(pa, pb);\n"
+"    float pixels = len * tessellation.x / max(distance(eye, 0.5 * (pa + pb)), 1e-3);\n"
+"    return clamp(pixels / tessellation.z, 1.0, max(1.0, min(len / tessellation.y, 64.0)));\n"
+"}\n"
+"void main()\n"
+"{\n"
+"    evaluationPosition[gl_InvocationID] = controlPosition[gl_InvocationID];\n"
+"    evaluationCell[gl_InvocationID] = controlCell[gl_InvocationID];\n"
+"    if (gl_InvocationID == 0)\n"
+"    {\n"
+"        gl_TessLevelOuter[0] = edge(controlPosition[1], controlPosition[2]);\n"
+"        gl_TessLevelOuter[1] = edge(controlPosition[2], controlPosition[0]);\n"
+"        gl_TessLevelOuter[2] = edge(controlPosition[0], controlPosition[1]);\n"
+"        gl_TessLevelInner[0] = max(gl_TessLevelOuter[0], max(gl_TessLevelOuter[1], gl_TessLevelOuter[2]));\n"
+"    }\n"
+"}\n";
+
+static const char* tess_evaluation_shader_text =
+HEIGHT_GLSL
+NORMAL_GLSL
+"layout(triangles, fractional_even_spacing, ccw) in;\n"
+"uniform vec3 tessellation;\n"
+"in vec2 evaluationPosition[];\n"
+"in float evaluationCell[];\n"
+"out vec3 position;\n"
+"out vec3 normal;\n"
+"void main()\n"
+"{\n"
+"    vec2 p = gl_TessCoord.x * evaluationPosition[0] + gl_TessCoord.y * evaluationPosition[1]\n"
+"        + gl_TessCoord.z * evaluationPosition[2];\n"
+"    position = vec3(p, height(p));\n"
+"    normal = terrainNormal(p, max(evaluationCell[0] / gl_TessLevelInner[0], tessellation.y));\n"
+"    gl_Position = viewProjection * vec4(position, 1.0);\n"
+"}\n";
+
+// Prefixes "body" with "version", the uniform blocks and "prefix", and compiles it
+static GLuint compile_stage(GLenum type, const char* version, const char* prefix, const char* body)
+{
+    const size_t length = strlen(version) + strlen(UNIFORMS_GLSL) + strlen(prefix) + strlen(body) + 1;
+    char* source = (char*)malloc(length);
+    if (!source)
+        return 0;
+    snprintf(source, length, "%s%s%s%s", version, UNIFORMS_GLSL, prefix, body);
+    const GLuint shader = shader_compile(type, source);
+    free(source);
+    return shader;
+}
+
+// The grid or tessellated program, its fragment stage the terrain's colour or, "feedback", the virtual texture's
+// pages; sampling the virtual texture once there is one
+static bool build_program(TerrainProgram* p, const TerrainRenderer* tr, bool tessellated, bool feedback)
+{
+    static const char* labels[2][2] = { { "terrain", "terrain feedback" },
+        { "terrain tessellated", "terrain tessellated feedback" } };
+    const char* version = !tessellated ? "#version 330\n" : GLAD_GL_VERSION_4_0 ? "#version 400 core\n"
+        : "#version 330\n#extension GL_ARB_tessellation_shader : require\n";
+    GLuint shaders[4];
+    int count = 0;
+    shaders[count++] = compile_stage(GL_VERTEX_SHADER, version, "", tessellated ? tess_vertex_shader_text
+        : grid_vertex_shader_text);
+    if (tessellated)
+    {
+        shaders[count++] = compile_stage(GL_TESS_CONTROL_SHADER, version, "", tess_control_shader_text);
+        shaders[count++] = compile_stage(GL_TESS_EVALUATION_SHADER, version, "", tess_evaluation_shader_text);
+    }
+    shaders[count++] = compile_stage(GL_FRAGMENT_SHADER, version,
+        tr->texture ? "#define VIRTUAL_TEXTURE 1\n" VIRTUAL_TEXTURE_GLSL : "",
+        feedback ? feedback_fragment_shader_text : fragment_shader_text);
+    p->program = program_link(shaders, count, false);
+    if (!p->program)
+        return false;
+    gl_debug_label(GL_PROGRAM, p->program, labels[tessellated][feedback]);
+    p->eye_location = glGetUniformLocation(p->program, "eye");
+    p->terrain_location = glGetUniformLocation(p->program, "terrain");
+    p->heights_location = glGetUniformLocation(p->program, "heightRange");
+    p->tessellation_location = glGetUniformLocation(p->program, "tessellation");
+    uniforms_bind_blocks(p->program);
+    gl_state_use_program(p->program);
+    glUniform1i(glGetUniformLocation(p->program, "heights"), TERRAIN_RENDERER_UNIT);
+    const Terrain* t = &tr->terrain;
+    glUniform4f(p->terrain_location, t->origin[0], t->origin[1], t->size, (float)t->grid);
+    glUniform2f(p->heights_location, t->height_min, t->height_max);
+    if (tr->texture)
+        virtual_texture_program(tr->texture, p->program, feedback);
+    return true;
+}
+
+// The made-up heights: generated, bounded for the culling, and uploaded with their mips
+static bool generate_heights(TerrainRenderer* tr)
+{
+    const int width = TERRAIN_RENDERER_HEIGHTS;
+    uint16_t* heights = (uint16_t*)malloc(sizeof(uint16_t) * width * width);
+    if (!heights)
+    {
+        fprintf(stderr, "terrain: out of memory for %d x %d heights\n", width, width);
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    terrain_generate_heights(heights, width, 1u, 4.f / tr->terrain.size);     // level ground a few units round
+    terrain_set_heights(&tr->terrain, heights, width);
+    printf("terrain: %d x %d heights made up in %.2f s\n", width, width,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    glGenTextures(1, &tr->heights);
+    gl_state_bind_texture(TERRAIN_RENDERER_UNIT, GL_TEXTURE_2D, tr->heights);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, width, width, 0, GL_RED, GL_UNSIGNED_SHORT, heights);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    int levels = 1;
+    while ((width >> levels) > 0)
+        ++levels;
+    gl_memory_texture(tr->heights, GPU_MEMORY_TEXTURES, GL_R16, width, width, 1, levels, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl_debug_label(GL_TEXTURE, tr->heights, "terrain heights");
+    free(heights);
+    tr->heights_width = width;
+    return true;
+}
+
+bool terrain_renderer_init(TerrainRenderer* tr, GLResources* resources, const char* heightmap, float size,
+    float height_min, float height_max, bool tessellate, uint64_t budget)
+{
+    memset(tr, 0, sizeof(*tr));
+    tr->streamed_id = -1;
+    tr->tessellate = tessellate && gl_ext.ARB_tessellation_shader;
+
+    // The heights' resolution sets the levels: a leaf's cells a texel wide, or TERRAIN_RENDERER_TESS_TEXELS of them
+    // for the tessellator to refine
+    if (heightmap)
+    {
+        tr->streamer = (TextureStreamer*)malloc(sizeof(TextureStreamer));
+        texture_streamer_init(tr->streamer, resources, budget, budget / 8);
+        tr->streamed_id = texture_streamer_load(tr->streamer, heightmap);
+        if (tr->streamed_id < 0)
+        {
+            terrain_renderer_destroy(tr);
+            return false;
+        }
+        tr->heights_width = (int)tr->streamer->textures[tr->streamed_id].file.width;
+    }
+    else
+        tr->heights_width = TERRAIN_RENDERER_HEIGHTS;
+    const int texels = tr->tessellate ? TERRAIN_RENDERER_TESS_TEXELS : 1;
+    int levels = 1;
+    while ((TERRAIN_RENDERER_GRID * texels << (levels - 1)) < tr->heights_width && levels < TERRAIN_MAX_LEVELS)
+        ++levels;
+    const float origin[2] = { -0.5f * size, -0.5f * size };
+    terrain_init(&tr->terrain, origin, size, height_min, height_max, levels, TERRAIN_RENDERER_GRID, 4.f);
+    if (!heightmap && !generate_heights(tr))
+    {
+        terrain_renderer_destroy(tr);
+        return false;
+    }
+
+    if (!build_program(&tr->grid, tr, false, false)
+        || (tr->tessellate && !build_program(&tr->tessellated, tr, true, false)))
+    {
+        fprintf(stderr, "terrain: can't build the %s program\n", tr->grid.program ? "tessellated" : "grid");
+        terrain_renderer_destroy(tr);
+        return false;
+    }
+
+    // The whole grid's triangles, then its every other vertex's
+    const int grid = TERRAIN_RENDERER_GRID, side = grid + 1;
+    tr->index_counts[0] = 6 * grid * grid;
+    tr->index_counts[1] = 6 * (grid / 2) * (grid / 2);
+    uint16_t* indices = (uint16_t*)malloc(sizeof(uint16_t) * (tr->index_counts[0] + tr->index_counts[1]));
+    uint16_t* index = indices;
+    for (int step = 1; step <= 2; ++step)
+    {
+        for (int y = 0; y < grid; y += step)
+        {
+            for (int x = 0; x < grid; x += step)
+            {
+                const uint16_t v = (uint16_t)(y * side + x), right = (uint16_t)(v + step);
+                const uint16_t up = (uint16_t)(v + step * side), corner = (uint16_t)(up + step);
+                const uint16_t triangles[6] = { v, right, corner, v, corner, up };
+                memcpy(index, triangles, sizeof(triangles));
+                index += 6;
+            }
+        }
+    }
+    tr->vertex_array = gl_dsa_create_vertex_array();
+    gl_state_bind_vertex_array(tr->vertex_array);
+    const size_t index_bytes = sizeof(uint16_t) * (tr->index_counts[0] + tr->index_counts[1]);
+    tr->index_buffer = gl_dsa_create_buffer((GLsizeiptr)index_bytes, indices, GL_STATIC_DRAW);
+    gl_memory_buffer(tr->index_buffer, GPU_MEMORY_GEOMETRY, index_bytes);
+    gl_debug_label(GL_BUFFER, tr->index_buffer, "terrain grids");
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, tr->index_buffer);    // into the vertex array
+    free(indices);
+    for (GLuint a = 0; a < 2; ++a)
+    {
+        glEnableVertexAttribArray(a);
+        glVertexAttribDivisor(a, 1);
+    }
+    gl_debug_label(GL_VERTEX_ARRAY, tr->vertex_array, "terrain");
+    stream_buffer_init(&tr->instances, GL_ARRAY_BUFFER,
+        (GLsizeiptr)sizeof(TerrainPatch) * 2 * TERRAIN_RENDERER_MAX_PATCHES);
+    gl_debug_label(GL_BUFFER, tr->instances.buffer, "terrain patches");
+
+    tr->selection.whole = (TerrainPatch*)malloc(sizeof(TerrainPatch) * TERRAIN_RENDERER_MAX_PATCHES);
+    tr->selection.quarters = (TerrainPatch*)malloc(sizeof(TerrainPatch) * TERRAIN_RENDERER_MAX_PATCHES);
+    tr->selection.capacity = TERRAIN_RENDERER_MAX_PATCHES;
+    tr->last_finest = tr->terrain.levels;
+    return true;
+}
+
+void terrain_renderer_destroy(TerrainRenderer* tr)
+{
+    if (tr->instances.buffer)
+        stream_buffer_destroy(&tr->instances);
+    gl_state_delete_vertex_arrays(1, &tr->vertex_array);
+    gl_state_delete_buffers(1, &tr->index_buffer);
+    gl_state_delete_textures(1, &tr->heights);
+    if (tr->grid.program)
+        glDeleteProgram(tr->grid.program);
+    if (tr->tessellated.program)
+        glDeleteProgram(tr->tessellated.program);
+    if (tr->feedback.program)
+        glDeleteProgram(tr->feedback.program);
+    if (tr->texture)
+    {
+        virtual_texture_destroy(tr->texture);
+        delete tr->texture;
+    }
+    if (tr->streamer)
+    {
+        texture_streamer_destroy(tr->streamer);
+        free(tr->streamer);
+    }
+    free(tr->selection.whole);
+    free(tr->selection.quarters);
+    terrain_destroy(&tr->terrain);
+    memset(tr, 0, sizeof(*tr));
+}
+
+bool terrain_renderer_texture(TerrainRenderer* tr, uint64_t budget, GpuReadback* readback)
+{
+    // As many levels as take the finest texels down to TERRAIN_RENDERER_VIRTUAL_TEXELS a unit
+    int levels = 1;
+    while (levels < VIRTUAL_TEXTURE_MAX_LEVELS
+        && VIRTUAL_TEXTURE_CONTENT * (float)(1 << levels) <= TERRAIN_RENDERER_VIRTUAL_TEXELS * tr->terrain.size)
+        ++levels;
+    tr->texture = new VirtualTexture;
+    if (!virtual_texture_init(tr->texture, levels, budget, 0, TERRAIN_RENDERER_VIRTUAL_UPLOADS, readback))
+    {
+        delete tr->texture;
+        tr->texture = NULL;
+        return false;
+    }
+
+    // The programs again, sampling it, and the feedback's; the old ones stay until the new ones have built
+    TerrainProgram programs[3] = {};
+    const bool built = build_program(&programs[0], tr, false, false)
+        && (!tr->tessellate || build_program(&programs[1], tr, true, false))
+        && build_program(&programs[2], tr, tr->tessellate, true);
+    if (!built)
+    {
+        fprintf(stderr, "terrain: can't build the virtual texture's programs; the terrain is drawn without it\n");
+        for (int i = 0; i < 3; ++i)
+        {
+            if (programs[i].program)
+                glDeleteProgram(programs[i].program);
+        }
+        virtual_texture_destroy(tr->texture);
+        delete tr->texture;
+        tr->texture = NULL;
+        return false;
+    }
+    glDeleteProgram(tr->grid.program);
+    if (tr->tessellated.program)
+        glDeleteProgram(tr->tessellated.program);
+    tr->grid = programs[0];
+    tr->tessellated = programs[1];
+    tr->feedback = programs[2];
+    printf("terrain: a virtual texture of %d levels, %d x %d pages at the finest, %s\n", levels, 1 << (levels - 1),
+        1 << (levels - 1), tr->texture->sparse ? "its cache sparse" : "its cache allocated whole");
+    return true;
+}
+
+// The frame's patches, streamed at "offset", drawn with "program": the whole ones, then the quarters
+static unsigned int draw_patches(const TerrainRenderer* tr, const TerrainProgram* program, const vec3 eye,
+    float pixel_scale, GLintptr offset)
+{
+    const TerrainSelection* s = &tr->selection;
+    gl_state_use_program(program->program);
+    glUniform3fv(program->eye_location, 1, eye);
+    if (tr->tessellate)
+        glUniform3f(program->tessellation_location, pixel_scale, tr->terrain.size / tr->heights_width,
+            TERRAIN_RENDERER_TESS_PIXELS);
+    unsigned int draws = 0;
+    for (int k = 0; k < 2; ++k)
+    {
+        const GLsizei instances = (GLsizei)(k ? s->quarter_count : s->whole_count);
+        if (!instances)
+            continue;
+        const GLintptr at = offset + (k ? (GLintptr)(sizeof(TerrainPatch) * s->whole_count) : 0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TerrainPatch), (const void*)at);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TerrainPatch),
+            (const void*)(at + offsetof(TerrainPatch, morph)));
+        glDrawElementsInstanced(tr->tessellate ? GL_PATCHES : GL_TRIANGLES, tr->index_counts[k], GL_UNSIGNED_SHORT,
+            (const void*)(k ? sizeof(uint16_t) * tr->index_counts[0] : 0), instances);
+        draw_counters_draw(GL_TRIANGLES, tr->index_counts[k], instances);   // the tessellator's own aren't counted
+        ++draws;
+    }
+    return draws;
+}
+
+unsigned int terrain_renderer_draw(TerrainRenderer* tr, const Frustum* frustum, mat4x4 const view, float pixel_scale)
+{
+    mat4x4 inverse_view;
+    mat4x4_invert(inverse_view, view);
+    const vec3 eye = { inverse_view[3][0], inverse_view[3][1], inverse_view[3][2] };
+    TerrainSelection* s = &tr->selection;
+    const uint32_t count = terrain_select(&tr->terrain, frustum, eye, s);
+    ++tr->frames;
+    tr->last_patches = count;
+    tr->last_finest = s->finest;
+
+    // A file's levels as fine as the finest grid drawn: that many vertices across the terrain, each tessellated
+    // down to a texel
+    GLuint heights = tr->heights;
+    if (tr->streamer)
+    {
+        if (count)
+        {
+            const float cells = tr->terrain.size / terrain_cell_size(&tr->terrain, s->finest);
+            texture_streamer_request(tr->streamer, tr->streamed_id,
+                cells * (tr->tessellate ? TERRAIN_RENDERER_TESS_TEXELS : 1));
+        }
+        texture_streamer_update(tr->streamer);
+        heights = texture_streamer_texture(tr->streamer, tr->streamed_id);
+    }
+    if (!count || !heights)
+        return 0;
+
+    stream_buffer_begin_frame(&tr->instances);
+    GLintptr offset = 0;
+    TerrainPatch* patches = (TerrainPatch*)stream_buffer_alloc(&tr->instances, (GLsizeiptr)sizeof(TerrainPatch) * count,
+        16, &offset);
+    memcpy(patches, s->whole, sizeof(TerrainPatch) * s->whole_count);
+    memcpy(patches + s->whole_count, s->quarters, sizeof(TerrainPatch) * s->quarter_count);
+    stream_buffer_commit(&tr->instances);
+
+    if (tr->texture)
+    {
+        virtual_texture_update(tr->texture);
+        virtual_texture_bind(tr->texture);
+    }
+    gl_state_bind_vertex_array(tr->vertex_array);
+    gl_state_bind_texture(TERRAIN_RENDERER_UNIT, GL_TEXTURE_2D, heights);
+    if (tr->streamer)
+    {
+        // The streamer's textures repeat; the heights' edges mustn't blend with the far side
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    if (tr->tessellate)
+        gl_ext.PatchParameteri(GL_PATCH_VERTICES, 3);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, tr->instances.buffer);
+    unsigned int draws = draw_patches(tr, tr->tessellate ? &tr->tessellated : &tr->grid, eye, pixel_scale, offset);
+    if (tr->texture && gl_state.viewport_known
+        && virtual_texture_begin_feedback(tr->texture, gl_state.viewport[2], gl_state.viewport[3]))
+    {
+        draws += draw_patches(tr, &tr->feedback, eye, pixel_scale, offset);
+        virtual_texture_end_feedback(tr->texture);
+    }
+    stream_buffer_end_frame(&tr->instances);
+    tr->patches += count;
+    return draws;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/gl_resources.h"
+#include "gl/stream_buffer.h"
+#include "gl/texture_streamer.h"
+#include "gl/virtual_texture.h"
+#include "scene/terrain.h"
+
+#include <stdint.h>
+
+// Draws scene/terrain.h's selection: every patch is an instance of one of
+// two grids, so a frame is two instanced draws whatever the view distance.
+//
+// The grids have no vertex buffer. Both draw from one static index buffer:
+// the whole TERRAIN_RENDERER_GRID x TERRAIN_RENDERER_GRID grid's triangles,
+// then those of its every other vertex, and the vertex shader places a
+// vertex from its index (gl_VertexID) and the instance's patch: corner,
+// size, cell and morph range, streamed each frame. It samples the height at
+// the vertex, morphs it by its distance from the eye and samples again
+// where the morph put it.
+//
+// Heights are either made up (terrain_generate_heights: an R16 texture of
+// TERRAIN_RENDERER_HEIGHTS texels a side with node bounds for the culling)
+// or a DDS / KTX2 file's red channel, streamed mip by mip through a texture
+// streamer (gl/texture_streamer.h) under its own budget: the levels asked
+// for follow the finest grid the selection draws, and nothing is drawn until
+// the mip tail is in. A file's terrain is culled against its whole height
+// range.
+//
+// With tessellation (4.0 contexts, or 3.3 with GL_ARB_tessellation_shader)
+// the grid's triangles go to the tessellator as patches instead: each edge
+// is split into as many parts as keep them TERRAIN_RENDERER_TESS_PIXELS on
+// screen, down to a texel, and the new vertices take the height there. The
+// level grid is TERRAIN_RENDERER_TESS_TEXELS times coarser then, so the
+// tessellator adds the detail up close. An edge's factor comes from its two
+// ends alone, the same in the two triangles that share it, so refining
+// opens no cracks either.
+//
+// With terrain_renderer_texture the ground takes its detail from a virtual
+// texture (gl/virtual_texture.h) spread once over the whole terrain, about
+// TERRAIN_RENDERER_VIRTUAL_TEXELS texels a unit at its finest level, so it
+// never repeats and is as sharp up close as anywhere. After the terrain is
+// drawn, and while no earlier feedback is in flight, it's drawn again into
+// the texture's small feedback target with a program writing the page each
+// pixel sampled; only the terrain, so pages behind the scene's objects are
+// asked for too.
+//
+// The terrain is drawn opaque into the bound target with the pass's depth
+// state and the Camera block (gl/uniforms.h) bound. Belongs to the thread
+// whose context renders.
+
+#define TERRAIN_RENDERER_GRID 32
+#define TERRAIN_RENDERER_HEIGHTS 1024       // texels a side of made-up heights
+#define TERRAIN_RENDERER_MAX_PATCHES 2048   // whole ones, and as many quarters
+#define TERRAIN_RENDERER_TESS_TEXELS 4      // a leaf cell's side in texels, tessellated
+#define TERRAIN_RENDERER_TESS_PIXELS 8.f    // the tessellator's aim for an edge on screen
+#define TERRAIN_RENDERER_VIRTUAL_TEXELS 64.f    // the virtual texture's finest texels a unit, at most
+#define TERRAIN_RENDERER_VIRTUAL_UPLOADS 8      // its decoded pages uploaded a frame at most
+
+typedef struct TerrainProgram
+{
+    GLuint program;
+    GLint eye_location;
+    GLint terrain_location;     // origin x, y, side, and the grid
+    GLint heights_location;     // height_min, height_max
+    GLint tessellation_location;    // pixels a unit spans 1 unit away, texel side, the aim in pixels
+} TerrainProgram;
+
+typedef struct TerrainRenderer
+{
+    Terrain terrain;
+    TerrainSelection selection;
+    TerrainProgram grid;        // the grids as triangles
+    TerrainProgram tessellated; // or as patches the tessellator refines; 0 without tessellation
+    TerrainProgram feedback;    // the one of the two drawn, writing virtual texture pages; 0 without a texture
+    VirtualTexture* texture;    // the ground detail: NULL without
+    bool tessellate;
+    GLuint vertex_array;        // the index buffer and the per-patch attributes
+    GLuint index_buffer;
+    GLsizei index_counts[2];    // the whole grid's, then the half grid's after it
+    StreamBuffer instances;     // the frame's TerrainPatches, whole then quarters
+    GLuint heights;             // made up: R16 with its mips; 0 when streamed
+    TextureStreamer* streamer;  // the heights file's: NULL for made-up heights
+    int streamed_id;
+    int heights_width;          // texels at the finest level
+
+    unsigned int frames;
+    unsigned long long patches;     // drawn over the run
+    unsigned int last_patches;      // last frame's
+    int last_finest;                // last frame's finest level
+} TerrainRenderer;
+
+// Needs a current context. A terrain "size" units a side centred on the origin, from "height_min" to "height_max",
+// its heights made up or streamed from "heightmap" (NULL: made up) within "budget" bytes through "resources".
+// Tessellates where asked and the context can. Logs and returns false when a program fails to build or the file
+// can't be used.
+bool terrain_renderer_init(TerrainRenderer* tr, GLResources* resources, const char* heightmap, float size,
+    float height_min, float height_max, bool tessellate, uint64_t budget);
+void terrain_renderer_destroy(TerrainRenderer* tr);
+
+// Textures the terrain from a virtual texture of pages cached in "budget" bytes, its feedback read back through
+// "readback". Logs and returns false, the terrain drawn untextured as before, when it can't be set up.
+bool terrain_renderer_texture(TerrainRenderer* tr, uint64_t budget, GpuReadback* readback);
+
+// Selects the patches in "frustum" as seen through "view" (camera-relative, as the Camera block's) and draws them;
+// "pixel_scale" is the pixels a unit spans one unit in front of the eye (projection[1][1] times half the viewport's
+// height). Draws the virtual texture's feedback pass too when one is due. Returns the draws made.
+unsigned int terrain_renderer_draw(TerrainRenderer* tr, const Frustum* frustum, mat4x4 const view, float pixel_scale);
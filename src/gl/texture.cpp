@@ -0,0 +1,113 @@
+#include "gl/texture.h"
+
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+GLenum texture_internal_format(TextureFormat format, bool srgb)
+{
+    switch (format)
+    {
+    case TEXTURE_FORMAT_RGBA8:
+        return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    case TEXTURE_FORMAT_BC1:
+        return !gl_ext.EXT_texture_compression_s3tc ? 0
+            : srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case TEXTURE_FORMAT_BC2:
+        return !gl_ext.EXT_texture_compression_s3tc ? 0
+            : srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT : GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    case TEXTURE_FORMAT_BC3:
+        return !gl_ext.EXT_texture_compression_s3tc ? 0
+            : srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TEXTURE_FORMAT_BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case TEXTURE_FORMAT_BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case TEXTURE_FORMAT_BC6H:
+        return gl_ext.ARB_texture_compression_bptc ? GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT : 0;
+    case TEXTURE_FORMAT_BC7:
+        return !gl_ext.ARB_texture_compression_bptc ? 0
+            : srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    case TEXTURE_FORMAT_ETC2_RGB8:
+        return !gl_ext.ARB_ES3_compatibility ? 0 : srgb ? GL_COMPRESSED_SRGB8_ETC2 : GL_COMPRESSED_RGB8_ETC2;
+    case TEXTURE_FORMAT_ETC2_RGBA8:
+        return !gl_ext.ARB_ES3_compatibility ? 0
+            : srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC : GL_COMPRESSED_RGBA8_ETC2_EAC;
+    default:
+        if (format >= TEXTURE_FORMAT_ASTC_4x4 && format <= TEXTURE_FORMAT_ASTC_12x12 && gl_ext.KHR_texture_compression_astc_ldr)
+            return (srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR : GL_COMPRESSED_RGBA_ASTC_4x4_KHR)
+                + (GLenum)(format - TEXTURE_FORMAT_ASTC_4x4);
+        return 0;
+    }
+}
+
+GLuint texture_create(const TextureFile* file, GLenum internal_format, int top, GpuMemoryCategory category)
+{
+    const TextureLevel* level = &file->levels[top];
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, texture);
+    const GLsizei levels = (GLsizei)(file->level_count - top);
+    if (gl_ext.TexStorage2D)
+        gl_ext.TexStorage2D(GL_TEXTURE_2D, levels, internal_format, (GLsizei)level->width, (GLsizei)level->height);
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);   // or it's incomplete short of a 1x1 level
+    uint64_t bytes = 0;
+    for (int l = top; l < file->level_count; ++l)
+        bytes += file->levels[l].size;
+    gl_memory_texture_bytes(texture, category, bytes);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return texture;
+}
+
+// "data" points into the mapping with no unpack buffer bound, or is an offset into the bound one
+static void upload_level(GLuint texture, const TextureFile* file, GLenum internal_format, int top, int level,
+    const void* data)
+{
+    const TextureLevel* l = &file->levels[level];
+    const GLint target_level = level - top;
+    gl_state_bind_texture(0, GL_TEXTURE_2D, texture);
+    const bool compressed = file->format != TEXTURE_FORMAT_RGBA8;
+    if (gl_ext.TexStorage2D && compressed)
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, target_level, 0, 0, (GLsizei)l->width, (GLsizei)l->height, internal_format,
+            (GLsizei)l->size, data);
+    else if (gl_ext.TexStorage2D)
+        glTexSubImage2D(GL_TEXTURE_2D, target_level, 0, 0, (GLsizei)l->width, (GLsizei)l->height, GL_RGBA,
+            GL_UNSIGNED_BYTE, data);
+    else if (compressed)
+        glCompressedTexImage2D(GL_TEXTURE_2D, target_level, internal_format, (GLsizei)l->width, (GLsizei)l->height, 0,
+            (GLsizei)l->size, data);
+    else
+        glTexImage2D(GL_TEXTURE_2D, target_level, (GLint)internal_format, (GLsizei)l->width, (GLsizei)l->height, 0, GL_RGBA,
+            GL_UNSIGNED_BYTE, data);
+}
+
+void texture_upload_level(GLuint texture, const TextureFile* file, GLenum internal_format, int top, int level)
+{
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);    // straight from the mapping
+    upload_level(texture, file, internal_format, top, level, file->levels[level].data);
+}
+
+void texture_upload_level_staged(GLuint texture, const TextureFile* file, GLenum internal_format, int top, int level,
+    GLuint buffer, size_t offset)
+{
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    upload_level(texture, file, internal_format, top, level, (const void*)offset);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool texture_can_copy(void)
+{
+    return gl_ext.CopyImageSubData && gl_ext.TexStorage2D;
+}
+
+void texture_copy_level(GLuint dst, int dst_top, GLuint src, int src_top, const TextureFile* file, int level)
+{
+    // Whole levels, so the partial blocks of the small ones are fine to copy
+    const TextureLevel* l = &file->levels[level];
+    gl_ext.CopyImageSubData(src, GL_TEXTURE_2D, level - src_top, 0, 0, 0, dst, GL_TEXTURE_2D, level - dst_top, 0, 0, 0,
+        (GLsizei)l->width, (GLsizei)l->height, 1);
+}
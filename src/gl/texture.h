@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "asset/texture_file.h"
+#include "core/gpu_memory.h"
+
+// GL textures from the levels of a TextureFile, uploaded as stored: block
+// compressed formats go to glCompressedTexSubImage2D without being decoded.
+//
+// A texture may hold only the smaller levels of its file: with "top" levels
+// left out, file level "top" is the texture's level 0. Storage is immutable
+// (glTexStorage2D, 4.2 or GL_ARB_texture_storage), so changing which levels
+// are resident means a new texture. texture_copy_level carries the levels
+// the two have in common over on the GPU.
+
+// The internal format for sampling "format" in this context, or 0 when the driver doesn't support it
+GLenum texture_internal_format(TextureFormat format, bool srgb);
+
+// Creates a texture sized for levels [top, level_count) of "file", trilinear and repeating, and leaves it
+// bound to unit 0. Without immutable storage the levels are allocated as they're uploaded instead. Either way the
+// levels' bytes are counted in "category" of gl_memory.
+GLuint texture_create(const TextureFile* file, GLenum internal_format, int top, GpuMemoryCategory category);
+
+// Uploads file level "level" into "texture" (created with "top"), from the file's mapping
+void texture_upload_level(GLuint texture, const TextureFile* file, GLenum internal_format, int top, int level);
+
+// Same, from the level's bytes at "offset" in pixel unpack buffer "buffer": the copy is the GPU's, queued like a
+// draw, and the CPU never touches them. Leaves GL_PIXEL_UNPACK_BUFFER unbound.
+void texture_upload_level_staged(GLuint texture, const TextureFile* file, GLenum internal_format, int top, int level,
+    GLuint buffer, size_t offset);
+
+// True when texture_copy_level works here: GL_ARB_copy_image and immutable storage
+bool texture_can_copy(void);
+
+// Copies file level "level" from "src" (created with "src_top") into "dst" (created with "dst_top")
+void texture_copy_level(GLuint dst, int dst_top, GLuint src, int src_top, const TextureFile* file, int level);
@@ -0,0 +1,374 @@
+#include "gl/texture_streamer.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/texture.h"
+
+#include <string.h>
+
+static const GLbitfield persistent_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+void texture_streamer_init(TextureStreamer* ts, GLResources* resources, uint64_t budget, uint64_t upload_budget)
+{
+    memset(ts, 0, sizeof(*ts));
+    ts->resources = resources;
+    ts->budget = budget;
+    texture_residency_init(&ts->residency, budget, upload_budget);
+}
+
+void texture_streamer_destroy(TextureStreamer* ts)
+{
+    if (ts->io)
+        async_io_destroy(ts->io);   // the reads in flight land before the staging buffer goes; closes the files
+    for (int i = 0; i < ts->count; ++i)
+    {
+        StreamedTexture* t = &ts->textures[i];
+        gl_resources_retire(ts->resources, GL_RESOURCE_TEXTURE, t->texture);
+        if (t->pending)
+            gl_resources_retire(ts->resources, GL_RESOURCE_TEXTURE, t->pending);
+        texture_file_close(&t->file);
+    }
+    ts->count = 0;
+    if (ts->staging_fence)
+        glDeleteSync(ts->staging_fence);
+    if (ts->staging)
+    {
+        gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, ts->staging);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        gl_state_delete_buffers(1, &ts->staging);
+    }
+    delete ts->io;
+    ts->io = NULL;
+    ts->staging = 0;
+    ts->staging_mapped = NULL;
+    ts->staging_fence = NULL;
+}
+
+bool texture_streamer_stage(TextureStreamer* ts, AsyncIoBackend backend)
+{
+    // glad only loads glBufferStorage when the context is 4.4 or newer
+    if (ts->io || glBufferStorage == NULL)
+        return ts->io != NULL;
+    ts->io = new AsyncIo;
+    if (!async_io_init(ts->io, backend, TEXTURE_STREAMER_IO_DEPTH, 2))
+    {
+        delete ts->io;
+        ts->io = NULL;
+        return false;
+    }
+    for (int i = 0; i < ts->count; ++i)
+        ts->textures[i].io_file = -1;   // loaded before: from their mappings
+    return true;
+}
+
+int texture_streamer_load(TextureStreamer* ts, const char* path)
+{
+    if (ts->count >= TEXTURE_RESIDENCY_MAX_TEXTURES)
+    {
+        fprintf(stderr, "texture_streamer: %s: too many textures\n", path);
+        return -1;
+    }
+    StreamedTexture* t = &ts->textures[ts->count];
+    if (!texture_file_open(&t->file, path))
+        return -1;
+    t->internal_format = texture_internal_format(t->file.format, t->file.srgb);
+    if (!t->internal_format)
+    {
+        fprintf(stderr, "texture_streamer: %s: the driver can't sample %s%s\n", path,
+            texture_format_info(t->file.format)->name, t->file.srgb ? " sRGB" : "");
+        texture_file_close(&t->file);
+        return -1;
+    }
+    uint64_t level_bytes[TEXTURE_FILE_MAX_LEVELS];
+    for (int l = 0; l < t->file.level_count; ++l)
+        level_bytes[l] = t->file.levels[l].size;
+    const int id = texture_residency_add(&ts->residency, t->file.width, t->file.height, t->file.level_count, level_bytes);
+    if (id != ts->count)
+    {
+        texture_file_close(&t->file);
+        return -1;
+    }
+    t->texture = 0;
+    t->top = t->file.level_count;
+    t->pending = 0;
+    t->pending_reads = 0;
+    uint64_t size = 0;
+    t->io_file = ts->io ? async_io_open(ts->io, path, false, &size) : -1;
+    return ts->count++;
+}
+
+void texture_streamer_request(TextureStreamer* ts, int id, float screen_size)
+{
+    texture_residency_request(&ts->residency, id, screen_size);
+}
+
+// A new texture over levels [to, count): what the old one shares with it is copied (or uploaded again), the rest uploaded
+static void apply_change(TextureStreamer* ts, const TextureResidencyChange* change)
+{
+    StreamedTexture* t = &ts->textures[change->texture];
+    const TextureFile* file = &t->file;
+    const GLuint texture = texture_create(file, t->internal_format, change->to, GPU_MEMORY_STREAMED_TEXTURES);
+    const bool copy = t->texture && texture_can_copy();
+    for (int l = change->to; l < file->level_count; ++l)
+    {
+        const bool kept = t->texture && l >= change->from;
+        if (kept && copy)
+        {
+            texture_copy_level(texture, change->to, t->texture, t->top, file, l);
+            ts->bytes_copied += file->levels[l].size;
+        }
+        else
+        {
+            texture_upload_level(texture, file, t->internal_format, change->to, l);
+            if (kept)
+                ts->bytes_reuploaded += file->levels[l].size;
+        }
+    }
+    gl_resources_retire(ts->resources, GL_RESOURCE_TEXTURE, t->texture);
+    if (t->texture)
+        ++ts->recreated;
+    t->texture = texture;
+    t->top = change->to;
+}
+
+// The texture's pending one in place of the one drawn so far
+static void swap_pending(TextureStreamer* ts, StreamedTexture* t)
+{
+    gl_resources_retire(ts->resources, GL_RESOURCE_TEXTURE, t->texture);
+    if (t->texture)
+        ++ts->recreated;
+    t->texture = t->pending;
+    t->top = t->pending_top;
+    t->pending = 0;
+}
+
+// The staging buffer at "bytes" or more; only called while the GPU is done with it
+static bool staging_reserve(TextureStreamer* ts, uint64_t bytes)
+{
+    if (bytes <= ts->staging_size)
+        return true;
+    uint64_t size = ts->staging_size ? ts->staging_size : TEXTURE_STREAMER_STAGING_MIN;
+    while (size < bytes)
+        size *= 2;
+    if (ts->staging)
+    {
+        gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, ts->staging);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        gl_state_delete_buffers(1, &ts->staging);
+    }
+    ts->staging_mapped = NULL;
+    ts->staging_size = 0;
+
+    // Immutable storage can't be respecified: a new buffer
+    glGenBuffers(1, &ts->staging);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, ts->staging);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, persistent_flags);
+    ts->staging_mapped = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, persistent_flags);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    gl_memory_buffer(ts->staging, GPU_MEMORY_STAGING, (size_t)size);
+    gl_debug_label(GL_BUFFER, ts->staging, "texture staging");
+    if (!ts->staging_mapped)
+    {
+        gl_state_delete_buffers(1, &ts->staging);
+        ts->staging = 0;
+        return false;
+    }
+    ts->staging_size = size;
+    return true;
+}
+
+// Whether the batch reads file level "level" of "t" for "change": it's new, or kept without copy_image
+static bool reads_level(const StreamedTexture* t, const TextureResidencyChange* change, int level, bool copy)
+{
+    return t->io_file >= 0 && !(t->texture && level >= change->from && copy);
+}
+
+// Staged: each change's texture is made now, with its kept levels copied; its other levels are read into the
+// staging buffer, the reads queued by submit_staged. A change with nothing to read swaps in at once.
+static void stage_changes(TextureStreamer* ts, int count)
+{
+    const bool copy = texture_can_copy();
+    uint64_t bytes = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const StreamedTexture* t = &ts->textures[ts->changes[i].texture];
+        for (int l = ts->changes[i].to; l < t->file.level_count; ++l)
+            if (reads_level(t, &ts->changes[i], l, copy))
+                bytes += (t->file.levels[l].size + TEXTURE_STREAMER_STAGING_ALIGN - 1)
+                    & ~(uint64_t)(TEXTURE_STREAMER_STAGING_ALIGN - 1);
+    }
+    if (bytes > UINT32_MAX || !staging_reserve(ts, bytes))
+    {
+        for (int i = 0; i < count; ++i)
+            apply_change(ts, &ts->changes[i]);     // from the mappings, as unstaged
+        return;
+    }
+
+    uint64_t offset = 0;
+    ts->staged_count = 0;
+    ts->staged_submitted = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const TextureResidencyChange* change = &ts->changes[i];
+        StreamedTexture* t = &ts->textures[change->texture];
+        const TextureFile* file = &t->file;
+        t->pending = texture_create(file, t->internal_format, change->to, GPU_MEMORY_STREAMED_TEXTURES);
+        t->pending_top = change->to;
+        t->pending_reads = 0;
+        for (int l = change->to; l < file->level_count; ++l)
+        {
+            if (reads_level(t, change, l, copy))
+            {
+                ts->staged[ts->staged_count++] = { change->texture, l, offset };
+                offset += (file->levels[l].size + TEXTURE_STREAMER_STAGING_ALIGN - 1)
+                    & ~(uint64_t)(TEXTURE_STREAMER_STAGING_ALIGN - 1);
+                ++t->pending_reads;
+                continue;
+            }
+            const bool kept = t->texture && l >= change->from;
+            if (kept && copy)
+            {
+                texture_copy_level(t->pending, change->to, t->texture, t->top, file, l);
+                ts->bytes_copied += file->levels[l].size;
+            }
+            else
+            {
+                texture_upload_level(t->pending, file, t->internal_format, change->to, l);
+                if (kept)
+                    ts->bytes_reuploaded += file->levels[l].size;
+            }
+        }
+        if (!t->pending_reads)
+            swap_pending(ts, t);
+    }
+    ts->staged_left = ts->staged_count;
+    ts->batches += ts->staged_count > 0;
+}
+
+// Queues as many of the batch's reads as async I/O takes; the rest go on a later update. The tag is the level's
+// index in "staged".
+static void submit_staged(TextureStreamer* ts)
+{
+    AsyncIoRead reads[64];
+    while (ts->staged_submitted < ts->staged_count)
+    {
+        uint32_t count = 0;
+        for (uint32_t s = ts->staged_submitted; s < ts->staged_count && count < 64; ++s)
+        {
+            const StagedLevel* staged = &ts->staged[s];
+            const StreamedTexture* t = &ts->textures[staged->texture];
+            const TextureLevel* level = &t->file.levels[staged->level];
+            const uint64_t file_offset = (uint64_t)((const uint8_t*)level->data - (const uint8_t*)t->file.file.data);
+            reads[count++] = { t->io_file, (uint32_t)level->size, file_offset, ts->staging_mapped + staged->offset,
+                s, (uint32_t)ASYNC_IO_NOW, 0 };
+        }
+        const uint32_t queued = async_io_submit(ts->io, reads, count);
+        ts->staged_submitted += queued;
+        if (queued < count)
+            return;
+    }
+}
+
+// A staged level's read is back: uploaded from the staging buffer (from the mapping should the read have
+// failed), and its texture swapped in once that was its last
+static void land_staged(TextureStreamer* ts, const StagedLevel* staged, int64_t result)
+{
+    StreamedTexture* t = &ts->textures[staged->texture];
+    const TextureLevel* level = &t->file.levels[staged->level];
+    if (result == (int64_t)level->size)
+    {
+        texture_upload_level_staged(t->pending, &t->file, t->internal_format, t->pending_top, staged->level,
+            ts->staging, (size_t)staged->offset);
+        ts->bytes_staged += level->size;
+    }
+    else
+    {
+        texture_upload_level(t->pending, &t->file, t->internal_format, t->pending_top, staged->level);
+        ++ts->read_failures;
+    }
+    --ts->staged_left;
+    if (--t->pending_reads == 0)
+        swap_pending(ts, t);
+}
+
+// Staged: uploads what landed since the last update. True once the batch is in and the GPU is done with the
+// staging buffer, so the next batch can be decided.
+static bool staged_progress(TextureStreamer* ts)
+{
+    if (ts->staged_left)
+    {
+        submit_staged(ts);
+        AsyncIoCompletion done[ASYNC_IO_MAX_DEPTH];
+        uint32_t n = 0;
+        while ((n = async_io_poll(ts->io, done, ASYNC_IO_MAX_DEPTH, false)) > 0)
+            for (uint32_t i = 0; i < n; ++i)
+                land_staged(ts, &ts->staged[done[i].tag], done[i].result);
+        if (ts->staged_left)
+            return false;
+        ts->staged_count = 0;
+        ts->staging_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);    // after the uploads out of it
+    }
+    if (ts->staging_fence)
+    {
+        const GLenum status = glClientWaitSync(ts->staging_fence, 0, 0);    // asks, doesn't wait
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED && status != GL_WAIT_FAILED)
+            return false;
+        glDeleteSync(ts->staging_fence);
+        ts->staging_fence = NULL;
+    }
+    return true;
+}
+
+void texture_streamer_update(TextureStreamer* ts)
+{
+    if (ts->io && !staged_progress(ts))
+    {
+        ++ts->updates_waited;
+        return;     // the requests so far count toward the next decision
+    }
+    const uint64_t share = gpu_memory_share(&gl_memory, GPU_MEMORY_STREAMED_TEXTURES);
+    ts->residency.budget = share < ts->budget ? share : ts->budget;
+    const int count = texture_residency_update(&ts->residency, ts->changes);
+    if (ts->io && count)
+    {
+        stage_changes(ts, count);
+        submit_staged(ts);
+    }
+    else
+    {
+        for (int i = 0; i < count; ++i)
+            apply_change(ts, &ts->changes[i]);
+    }
+}
+
+GLuint texture_streamer_texture(const TextureStreamer* ts, int id)
+{
+    return ts->textures[id].texture;
+}
+
+void texture_streamer_print(const TextureStreamer* ts, FILE* out)
+{
+    const TextureResidency* res = &ts->residency;
+    fprintf(out, "textures: %d, %.2f of %.2f MB resident; %.2f MB uploaded (at most %.2f MB a frame), %.2f MB evicted\n",
+        ts->count, res->resident_bytes / 1048576.0, res->budget / 1048576.0, res->uploaded_bytes / 1048576.0,
+        res->upload_budget / 1048576.0, res->evicted_bytes / 1048576.0);
+    fprintf(out, "  %llu recreated, %.2f MB copied on the GPU, %.2f MB uploaded again, %llu upgrades waited for memory\n",
+        (unsigned long long)ts->recreated, ts->bytes_copied / 1048576.0, ts->bytes_reuploaded / 1048576.0,
+        (unsigned long long)res->deferred);
+    if (ts->io)
+        fprintf(out, "  staged through %s: %.2f MB in %llu batches, %.1f MB of staging, %llu updates waited for a "
+            "batch, %llu reads failed\n", async_io_backend_name(ts->io->backend), ts->bytes_staged / 1048576.0,
+            (unsigned long long)ts->batches, ts->staging_size / 1048576.0, (unsigned long long)ts->updates_waited,
+            (unsigned long long)ts->read_failures);
+    for (int i = 0; i < ts->count; ++i)
+    {
+        const StreamedTexture* t = &ts->textures[i];
+        const TextureResidencyEntry* e = &res->entries[i];
+        fprintf(out, "  %-10s %5ux%-5u %2d levels, resident from %ux%u (wanted %ux%u)\n", texture_format_info(t->file.format)->name,
+            t->file.width, t->file.height, t->file.level_count, t->top < t->file.level_count ? t->file.levels[t->top].width : 0,
+            t->top < t->file.level_count ? t->file.levels[t->top].height : 0, t->file.levels[e->wanted].width,
+            t->file.levels[e->wanted].height);
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "asset/texture_file.h"
+#include "asset/texture_residency.h"
+#include "core/async_io.h"
+#include "gl/gl_resources.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Mip streaming for textures loaded from DDS / KTX2 files, under a GPU memory
+// budget.
+//
+// Every texture stays mapped. Each frame the renderer reports how large each
+// texture is drawn on screen, and texture_streamer_update carries out what
+// the residency policy (asset/texture_residency.h) decided. The policy loads
+// mip tails first, then larger levels as needed within an upload budget, and
+// evicts unneeded levels to stay under the memory budget. A texture whose
+// levels change is recreated with immutable storage for its new level range.
+// The levels it keeps are copied over on the GPU where GL_ARB_copy_image is
+// available, and re-uploaded from the mapping where it isn't. The old
+// texture is retired through the registry, so frames in flight can still
+// sample it.
+//
+// The textures count as GPU_MEMORY_STREAMED_TEXTURES in gl_memory, and each
+// update lowers the budget to their share of the video memory budget
+// (gpu_memory_share) when that is less: the rest of the app's memory comes
+// first.
+//
+// Staged (texture_streamer_stage, on 4.4), the new levels never pass
+// through the render thread: the policy's decisions for a frame are a batch,
+// whose levels are read from the files through core/async_io.h straight into
+// a persistently mapped pixel unpack buffer, and uploaded from there with
+// glCompressedTexSubImage2D once each read lands, a copy the GPU makes.
+// Without staging the driver copies every level out of the mapping inside
+// the upload call, page faults into the file included. A texture changing
+// in a batch gets its new texture (with the levels it keeps copied over)
+// at once, and swaps it in when its last read is uploaded; until then the
+// old one is drawn. The next batch is decided once this one is in and the
+// GPU is done with the staging buffer, usually a frame or two later.
+//
+// Belongs to the thread with the registry's context current.
+
+#define TEXTURE_STREAMER_IO_DEPTH 16
+#define TEXTURE_STREAMER_STAGING_MIN (1u << 20)    // bytes; grown in powers of two to a batch's levels
+#define TEXTURE_STREAMER_STAGING_ALIGN 256         // each level's offset in the staging buffer
+#define TEXTURE_STREAMER_MAX_STAGED (TEXTURE_RESIDENCY_MAX_TEXTURES * TEXTURE_FILE_MAX_LEVELS)
+
+typedef struct StreamedTexture
+{
+    TextureFile file;
+    GLenum internal_format;
+    GLuint texture;             // 0 until the mip tail is in
+    int top;                    // the file level that is the texture's level 0
+    int io_file;                // staged: async_io_open's, -1 for uploads from the mapping
+    GLuint pending;             // staged: the texture taking over once its levels are in, 0 for none
+    int pending_top;
+    int pending_reads;          // its levels still being read
+} StreamedTexture;
+
+// A level of the batch on its way through the staging buffer
+typedef struct StagedLevel
+{
+    int texture;
+    int level;
+    uint64_t offset;            // in the staging buffer
+} StagedLevel;
+
+typedef struct TextureStreamer
+{
+    GLResources* resources;
+    TextureResidency residency;
+    uint64_t budget;            // as configured; residency.budget is this or gl_memory's share
+    int count;
+    StreamedTexture textures[TEXTURE_RESIDENCY_MAX_TEXTURES];
+    TextureResidencyChange changes[TEXTURE_RESIDENCY_MAX_TEXTURES];
+    uint64_t bytes_copied;      // on the GPU, from a texture's previous storage
+    uint64_t bytes_reuploaded;  // kept levels uploaded again, without copy_image
+    uint64_t recreated;         // textures replaced with a new level range
+
+    // Staged uploads: NULL "io" for uploads straight from the mappings
+    AsyncIo* io;
+    GLuint staging;             // pixel unpack buffer
+    uint8_t* staging_mapped;    // its persistent mapping, which the reads land in
+    uint64_t staging_size;
+    GLsync staging_fence;       // after the last batch's uploads out of it; NULL once the GPU is done
+    uint32_t staged_count;      // the batch's levels in "staged"
+    uint32_t staged_submitted;  // reads queued so far
+    uint32_t staged_left;       // not uploaded yet
+    StagedLevel staged[TEXTURE_STREAMER_MAX_STAGED];
+    uint64_t bytes_staged;      // read into the staging buffer and uploaded from it
+    uint64_t batches;
+    uint64_t updates_waited;    // updates that found the batch still in flight and decided nothing
+    uint64_t read_failures;     // staged reads that failed, uploaded from the mapping instead
+} TextureStreamer;
+
+// "budget" caps the bytes of resident levels; "upload_budget" the bytes of new levels per frame
+void texture_streamer_init(TextureStreamer* ts, GLResources* resources, uint64_t budget, uint64_t upload_budget);
+
+// Retires every texture and unmaps every file
+void texture_streamer_destroy(TextureStreamer* ts);
+
+// Stages the uploads from here on, reading through "backend" (see above); call before loading. Returns false,
+// uploading from the mappings as before, without persistent mappings (4.4) or when no backend starts.
+bool texture_streamer_stage(TextureStreamer* ts, AsyncIoBackend backend);
+
+// Maps "path" (DDS / KTX2) for streaming. Nothing is uploaded until updates ask for it. Logs and returns -1
+// when the file can't be used: unreadable, an unsupported format, or one this driver can't sample.
+int texture_streamer_load(TextureStreamer* ts, const char* path);
+
+// The texture is drawn this frame at about "screen_size" pixels across
+void texture_streamer_request(TextureStreamer* ts, int id, float screen_size);
+
+// Once a frame, after the requests: uploads, copies and evicts levels. Staged, it first uploads the levels whose
+// reads have landed; a new batch waits for the last one.
+void texture_streamer_update(TextureStreamer* ts);
+
+// The GL texture to sample, 0 until the first levels are in. It can change on any update.
+GLuint texture_streamer_texture(const TextureStreamer* ts, int id);
+
+// Resident and uploaded bytes against the budgets, and each texture's resident levels
+void texture_streamer_print(const TextureStreamer* ts, FILE* out);
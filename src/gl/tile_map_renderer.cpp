@@ -0,0 +1,413 @@
+#include "gl/tile_map_renderer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INSTANCE_FLOATS 9           // rect, uv, layer
+
+// A tile is a four-vertex strip; corner (gl_VertexID & 1, gl_VertexID >> 1) of its rectangle and of its uv
+static const char* vertex_shader_text =
+"#version 330 core\n"
+"layout(location = 0) in vec4 rect;\n"
+"layout(location = 1) in vec4 uv;\n"
+"layout(location = 2) in float layer;\n"
+"uniform vec2 viewport;\n"
+"out vec3 texcoord;\n"
+"void main()\n"
+"{\n"
+"    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+"    texcoord = vec3(mix(uv.xy, uv.zw, corner), layer);\n"
+"    gl_Position = vec4(mix(rect.xy, rect.zw, corner) / viewport * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+// Half a texel in from the edges, so bilinear filtering never reaches the other side of the layer
+static const char* fragment_shader_text =
+"#version 330 core\n"
+"uniform sampler2DArray tiles;\n"
+"in vec3 texcoord;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    vec2 inset = 0.5 / vec2(textureSize(tiles, 0).xy);\n"
+"    fragment = texture(tiles, vec3(clamp(texcoord.xy, inset, 1.0 - inset), texcoord.z));\n"
+"}\n";
+
+// Value noise: a hash per lattice point of each octave, smoothly interpolated. Lattice coordinates are 64-bit, so
+// the octaves past level 20 don't wrap.
+static float lattice(int64_t x, int64_t y, int octave)
+{
+    uint64_t h = (uint64_t)x * 0x9E3779B97F4A7C15ull ^ (uint64_t)y * 0xC2B2AE3D27D4EB4Full ^ (uint64_t)octave << 56;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+    return (float)(h >> 40) / 16777216.f;
+}
+
+static float value_noise(double x, double y, int octave)
+{
+    const double fx = floor(x), fy = floor(y);
+    const int64_t ix = (int64_t)fx, iy = (int64_t)fy;
+    const float tx = (float)(x - fx), ty = (float)(y - fy);
+    const float sx = tx * tx * (3.f - 2.f * tx), sy = ty * ty * (3.f - 2.f * ty);
+    const float a = lattice(ix, iy, octave), b = lattice(ix + 1, iy, octave);
+    const float c = lattice(ix, iy + 1, octave), d = lattice(ix + 1, iy + 1, octave);
+    return (a + (b - a) * sx) + ((c + (d - c) * sx) - (a + (b - a) * sx)) * sy - 0.5f;
+}
+
+// Octave k has 4 x 2^k cells across the map and half the amplitude of k - 1
+static float octaves(double x, double y, int first, int last)
+{
+    float h = 0.f;
+    for (int k = first; k <= last; ++k)
+        h += value_noise(x * (4.0 * (double)(1ull << k)), y * (4.0 * (double)(1ull << k)), k) / (float)(1ull << k);
+    return h;
+}
+
+#define TILE_SIZE TILE_MAP_RENDERER_TILE_SIZE
+#define GRID_STEP 8                 // texels between the coarse octaves' samples
+#define GRID_SIZE (TILE_SIZE / GRID_STEP + 1)
+
+// The terrain of tile "key" into "out" (RGBA8, TILE_SIZE squared, bottom row first), with "heights" for
+// (TILE_SIZE + 1)^2 floats. The octaves finer than a texel are left out. Those with less than a cell across the
+// tile are smooth over GRID_STEP texels, so they're sampled that far apart and interpolated, which leaves 8
+// octaves a texel at any level.
+static void decode_tile(uint64_t key, float* heights, unsigned char* out)
+{
+    const int size = TILE_SIZE, stride = TILE_SIZE + 1;
+    int level;
+    uint32_t tx, ty;
+    tile_map_key_tile(key, &level, &tx, &ty);
+    const double tile = 1.0 / (double)(1u << level), texel = tile / size;
+    const int last = level + 5;                 // 4 x 2^k cells, up to half the texels across
+    const int first = level - 2 > 0 ? level - 2 : 0;
+    float grid[GRID_SIZE * GRID_SIZE];
+    for (int y = 0; y < GRID_SIZE; ++y)
+        for (int x = 0; x < GRID_SIZE; ++x)
+            grid[y * GRID_SIZE + x] = first
+                ? octaves(tx * tile + x * GRID_STEP * texel, ty * tile + y * GRID_STEP * texel, 0, first - 1) : 0.f;
+    for (int y = 0; y <= size; ++y)
+        for (int x = 0; x <= size; ++x)
+        {
+            const int gx = x / GRID_STEP < GRID_SIZE - 1 ? x / GRID_STEP : GRID_SIZE - 2;
+            const int gy = y / GRID_STEP < GRID_SIZE - 1 ? y / GRID_STEP : GRID_SIZE - 2;
+            const float u = (float)(x - gx * GRID_STEP) / GRID_STEP, v = (float)(y - gy * GRID_STEP) / GRID_STEP;
+            const float* c = &grid[gy * GRID_SIZE + gx];
+            const float coarse = (c[0] + (c[1] - c[0]) * u) * (1.f - v)
+                + (c[GRID_SIZE] + (c[GRID_SIZE + 1] - c[GRID_SIZE]) * u) * v;
+            heights[y * stride + x] = coarse + octaves(tx * tile + x * texel, ty * tile + y * texel, first, last);
+        }
+
+    // Height bands, lit from the top left by the slope across each texel. Every octave adds about 4 x texel to the
+    // slope, in random directions, so it's scaled by the texel and the square root of the octaves. Contours at an
+    // interval that halves with each level keep some lines across a tile at any depth.
+    static const struct { float height; unsigned char rgb[3]; } bands[] = {
+        { -0.30f, { 18, 46, 96 } }, { -0.02f, { 44, 96, 160 } }, { 0.00f, { 214, 200, 150 } },
+        { 0.05f, { 108, 160, 72 } }, { 0.22f, { 44, 104, 52 } }, { 0.38f, { 120, 108, 96 } },
+        { 0.52f, { 244, 244, 248 } } };
+    const int band_count = (int)(sizeof(bands) / sizeof(bands[0]));
+    const float slope_scale = (float)(texel * 4.0 * sqrt((double)last + 1.0)) * 1.5f;
+    const float contour = 0.5f / (float)(1u << level);      // about the amplitude of the tile's own first octave
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x)
+        {
+            const float* h = &heights[y * stride + x];
+            const float height = h[0];
+            int b = 0;
+            while (b + 1 < band_count && height > bands[b + 1].height)
+                ++b;
+            const int next = b + 1 < band_count ? b + 1 : b;
+            const float span = bands[next].height - bands[b].height;
+            const float t = span > 0.f ? fminf(fmaxf((height - bands[b].height) / span, 0.f), 1.f) : 0.f;
+            float light = 1.f;
+            if (height > 0.f)
+            {
+                const float slope = (h[1] - h[0]) - (h[stride] - h[0]);
+                light = 1.f + fminf(fmaxf(-slope / slope_scale, -0.45f), 0.45f);
+            }
+            // A contour where the texel's neighbours fall in another interval
+            const float band = floorf(height / contour);
+            if (band != floorf(h[1] / contour) || band != floorf(h[stride] / contour))
+                light *= 0.8f;
+            unsigned char* p = out + 4 * ((size_t)y * size + x);
+            for (int c = 0; c < 3; ++c)
+            {
+                const float value = (bands[b].rgb[c] + (bands[next].rgb[c] - bands[b].rgb[c]) * t) * light;
+                p[c] = (unsigned char)fminf(fmaxf(value, 0.f), 255.f);
+            }
+            p[3] = 255;
+        }
+}
+
+// Takes queued loads and decodes them into staging, until told to stop
+static void decode_thread(TileMapRenderer* tmr)
+{
+    float* heights = (float*)malloc(sizeof(float) * (TILE_SIZE + 1) * (TILE_SIZE + 1));
+    for (;;)
+    {
+        TileRequest request;
+        int staging;
+        {
+            std::unique_lock<std::mutex> lock(tmr->mutex);
+            tmr->wake.wait(lock, [tmr] { return tmr->stop || tmr->queue_count > 0; });
+            if (tmr->stop)
+                break;
+            request = tmr->queue[tmr->queue_head];
+            tmr->queue_head = (tmr->queue_head + 1) % tmr->map.max_loading;
+            --tmr->queue_count;
+            staging = tmr->free_staging[--tmr->free_staging_count];
+        }
+        decode_tile(request.key, heights, tmr->staging + tmr->tile_bytes * staging);
+        std::lock_guard<std::mutex> lock(tmr->mutex);
+        tmr->decoded[tmr->decoded_count] = request.slot;
+        tmr->decoded_staging[tmr->decoded_count++] = staging;
+    }
+    free(heights);
+}
+
+bool tile_map_renderer_init(TileMapRenderer* tmr, uint64_t budget, int thread_count, int uploads_per_frame)
+{
+    tmr->program = 0;
+    tmr->texture = 0;
+    tmr->vertex_array = 0;
+    tmr->thread_count = 0;
+    tmr->stop = false;
+    tmr->queue = NULL;
+    tmr->decoded = tmr->decoded_staging = tmr->free_staging = NULL;
+    tmr->staging = NULL;
+    tmr->draws = NULL;
+    tmr->queue_head = tmr->queue_count = tmr->decoded_count = tmr->free_staging_count = 0;
+    tmr->bytes_uploaded = tmr->tiles_decoded = tmr->tiles_cancelled = 0;
+    tmr->frames = tmr->draws_drawn = 0;
+    tmr->uploads_per_frame = uploads_per_frame < 1 ? 1 : uploads_per_frame > 64 ? 64 : uploads_per_frame;
+    tmr->tile_bytes = (size_t)TILE_SIZE * TILE_SIZE * 4;
+    memset(&tmr->map, 0, sizeof(tmr->map));
+    memset(&tmr->instances, 0, sizeof(tmr->instances));
+    memset(&tmr->uploads, 0, sizeof(tmr->uploads));
+
+    GLint max_layers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    const uint64_t slots = budget / tmr->tile_bytes < (uint64_t)max_layers ? budget / tmr->tile_bytes : (uint64_t)max_layers;
+    if (thread_count <= 0)
+        thread_count = (int)std::thread::hardware_concurrency() - 1;
+    thread_count = thread_count < 1 ? 1 : thread_count > TILE_MAP_RENDERER_MAX_THREADS ? TILE_MAP_RENDERER_MAX_THREADS
+        : thread_count;
+    // Enough loads in flight to keep every thread busy through a frame's uploads, and not many more: a queue is
+    // what a pan leaves behind
+    const int max_loading = 2 * thread_count + tmr->uploads_per_frame;
+    if (slots < 4u * TILE_MAP_PINNED_TILES || !tile_map_init(&tmr->map, (int)slots, TILE_MAP_RENDERER_LEVELS, TILE_SIZE,
+        max_loading, 0.4))
+    {
+        fprintf(stderr, "tile_map: %.0f MB holds %llu tiles of %d x %d (up to %d layers), too few for a view\n",
+            budget / 1048576.0, (unsigned long long)slots, TILE_SIZE, TILE_SIZE, max_layers);
+        return false;
+    }
+    tmr->program = program_build(vertex_shader_text, fragment_shader_text, false);
+    if (!tmr->program)
+    {
+        fprintf(stderr, "tile_map: can't build the program\n");
+        tile_map_destroy(&tmr->map);
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, tmr->program, "tile map");
+    tmr->viewport_location = glGetUniformLocation(tmr->program, "viewport");
+    gl_state_use_program(tmr->program);
+    glUniform1i(glGetUniformLocation(tmr->program, "tiles"), 0);
+
+    glGenTextures(1, &tmr->texture);
+    gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, tmr->texture);
+    if (gl_ext.TexStorage3D)
+        gl_ext.TexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, TILE_SIZE, TILE_SIZE, (GLsizei)slots);
+    else
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, TILE_SIZE, TILE_SIZE, (GLsizei)slots, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+            NULL);
+    gl_memory_texture(tmr->texture, GPU_MEMORY_TEXTURES, GL_RGBA8, TILE_SIZE, TILE_SIZE, (GLsizei)slots, 1, 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl_debug_label(GL_TEXTURE, tmr->texture, "map tiles");
+
+    stream_buffer_init(&tmr->instances, GL_ARRAY_BUFFER,
+        (GLsizeiptr)sizeof(float) * INSTANCE_FLOATS * TILE_MAP_RENDERER_MAX_DRAWS);
+    stream_buffer_init(&tmr->uploads, GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)tmr->tile_bytes * tmr->uploads_per_frame);
+    gl_debug_label(GL_BUFFER, tmr->instances.buffer, "map tile instances");
+    gl_debug_label(GL_BUFFER, tmr->uploads.buffer, "map tile uploads");
+    tmr->vertex_array = gl_dsa_create_vertex_array();
+    gl_state_bind_vertex_array(tmr->vertex_array);
+    for (GLuint a = 0; a < 3; ++a)
+    {
+        glEnableVertexAttribArray(a);
+        glVertexAttribDivisor(a, 1);
+    }
+    gl_debug_label(GL_VERTEX_ARRAY, tmr->vertex_array, "tile map");
+
+    tmr->draws = (TileDraw*)malloc(sizeof(TileDraw) * TILE_MAP_RENDERER_MAX_DRAWS);
+    tmr->queue = (TileRequest*)malloc(sizeof(TileRequest) * max_loading);
+    tmr->decoded = (int*)malloc(sizeof(int) * max_loading);
+    tmr->decoded_staging = (int*)malloc(sizeof(int) * max_loading);
+    tmr->free_staging = (int*)malloc(sizeof(int) * max_loading);
+    tmr->staging = (unsigned char*)malloc(tmr->tile_bytes * max_loading);
+    for (int s = 0; s < max_loading; ++s)
+        tmr->free_staging[tmr->free_staging_count++] = s;
+    for (int t = 0; t < thread_count; ++t)
+        tmr->threads[tmr->thread_count++] = std::thread(decode_thread, tmr);
+    return true;
+}
+
+void tile_map_renderer_destroy(TileMapRenderer* tmr)
+{
+    {
+        std::lock_guard<std::mutex> lock(tmr->mutex);
+        tmr->stop = true;
+    }
+    tmr->wake.notify_all();
+    for (int t = 0; t < tmr->thread_count; ++t)
+        tmr->threads[t].join();
+    tmr->thread_count = 0;
+    if (tmr->instances.buffer)
+        stream_buffer_destroy(&tmr->instances);
+    if (tmr->uploads.buffer)
+        stream_buffer_destroy(&tmr->uploads);
+    if (tmr->vertex_array)
+        gl_state_delete_vertex_arrays(1, &tmr->vertex_array);
+    if (tmr->texture)
+        gl_state_delete_textures(1, &tmr->texture);
+    if (tmr->program)
+        glDeleteProgram(tmr->program);
+    tmr->vertex_array = tmr->texture = tmr->program = 0;
+    free(tmr->draws);
+    free(tmr->queue);
+    free(tmr->decoded);
+    free(tmr->decoded_staging);
+    free(tmr->free_staging);
+    free(tmr->staging);
+    tmr->draws = NULL;
+    tmr->queue = NULL;
+    tmr->decoded = tmr->decoded_staging = tmr->free_staging = NULL;
+    tmr->staging = NULL;
+    tile_map_destroy(&tmr->map);
+}
+
+// Up to uploads_per_frame decoded tiles through the upload stream into their layers, drawn from this frame on
+static void upload_decoded(TileMapRenderer* tmr)
+{
+    int slots[64], staging[64];
+    int count;
+    {
+        std::lock_guard<std::mutex> lock(tmr->mutex);
+        count = tmr->decoded_count < tmr->uploads_per_frame ? tmr->decoded_count : tmr->uploads_per_frame;
+        count = count < 64 ? count : 64;
+        memcpy(slots, tmr->decoded, sizeof(int) * count);
+        memcpy(staging, tmr->decoded_staging, sizeof(int) * count);
+        tmr->decoded_count -= count;
+        memmove(tmr->decoded, tmr->decoded + count, sizeof(int) * tmr->decoded_count);
+        memmove(tmr->decoded_staging, tmr->decoded_staging + count, sizeof(int) * tmr->decoded_count);
+    }
+    if (!count)
+        return;
+    GLintptr offsets[64];
+    stream_buffer_begin_frame(&tmr->uploads);
+    for (int i = 0; i < count; ++i)
+    {
+        void* p = stream_buffer_alloc(&tmr->uploads, (GLsizeiptr)tmr->tile_bytes, 256, &offsets[i]);
+        memcpy(p, tmr->staging + tmr->tile_bytes * staging[i], tmr->tile_bytes);
+    }
+    stream_buffer_commit(&tmr->uploads);
+    {
+        std::lock_guard<std::mutex> lock(tmr->mutex);
+        for (int i = 0; i < count; ++i)
+            tmr->free_staging[tmr->free_staging_count++] = staging[i];
+    }
+    gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, tmr->texture);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, tmr->uploads.buffer);
+    for (int i = 0; i < count; ++i)
+    {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slots[i], TILE_SIZE, TILE_SIZE, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+            (const void*)offsets[i]);
+        tile_map_loaded(&tmr->map, slots[i]);
+    }
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    stream_buffer_end_frame(&tmr->uploads);
+    tmr->bytes_uploaded += (uint64_t)tmr->tile_bytes * count;
+    tmr->tiles_decoded += (uint64_t)count;
+}
+
+// Queued loads the view gave up on are dropped before they start, then this frame's go on the queue
+static void queue_requests(TileMapRenderer* tmr, int request_count)
+{
+    {
+        std::lock_guard<std::mutex> lock(tmr->mutex);
+        const int capacity = tmr->map.max_loading;
+        int kept = 0;
+        for (int i = 0; i < tmr->queue_count; ++i)
+        {
+            const TileRequest* q = &tmr->queue[(tmr->queue_head + i) % capacity];
+            if (tile_map_wanted(&tmr->map, q->slot))
+                tmr->queue[(tmr->queue_head + kept++) % capacity] = *q;
+            else
+            {
+                tile_map_cancel(&tmr->map, q->slot);
+                ++tmr->tiles_cancelled;
+            }
+        }
+        tmr->queue_count = kept;
+        for (int i = 0; i < request_count; ++i)
+            tmr->queue[(tmr->queue_head + tmr->queue_count++) % capacity] = tmr->requests[i];
+    }
+    if (request_count)
+        tmr->wake.notify_all();
+}
+
+void tile_map_renderer_draw(TileMapRenderer* tmr, const double view[4], int width, int height, double dt)
+{
+    upload_decoded(tmr);
+    int request_count = 0;
+    const int count = tile_map_update(&tmr->map, view, width, height, dt, tmr->draws, TILE_MAP_RENDERER_MAX_DRAWS,
+        tmr->requests, TILE_MAP_RENDERER_MAX_REQUESTS, &request_count);
+    queue_requests(tmr, request_count);
+    ++tmr->frames;
+    tmr->draws_drawn = (unsigned int)count;
+    if (!count)
+        return;
+
+    stream_buffer_begin_frame(&tmr->instances);
+    GLintptr offset = 0;
+    float* p = (float*)stream_buffer_alloc(&tmr->instances, (GLsizeiptr)sizeof(float) * INSTANCE_FLOATS * count, 16,
+        &offset);
+    for (int i = 0; i < count; ++i, p += INSTANCE_FLOATS)
+    {
+        memcpy(p, tmr->draws[i].rect, sizeof(float) * 4);
+        memcpy(p + 4, tmr->draws[i].uv, sizeof(float) * 4);
+        p[8] = (float)tmr->draws[i].slot;
+    }
+    stream_buffer_commit(&tmr->instances);
+
+    tmr->depth_test = gl_state.capabilities[GL_STATE_CAP_DEPTH_TEST] == 1;
+    gl_state_use_program(tmr->program);
+    gl_state_bind_vertex_array(tmr->vertex_array);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, tmr->instances.buffer);
+    const GLsizei stride = (GLsizei)sizeof(float) * INSTANCE_FLOATS;
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (const void*)offset);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(offset + sizeof(float) * 4));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (const void*)(offset + sizeof(float) * 8));
+    gl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, tmr->texture);
+    gl_state_viewport(0, 0, width, height);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_BLEND, false);
+    glUniform2f(tmr->viewport_location, (float)width, (float)height);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    draw_counters_draw(GL_TRIANGLE_STRIP, 4, count);
+    gl_state_enable(GL_DEPTH_TEST, tmr->depth_test);
+    stream_buffer_end_frame(&tmr->instances);
+}
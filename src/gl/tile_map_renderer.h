@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/tile_map.h"
+#include "gl/stream_buffer.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <stdint.h>
+
+// Draws a quadtree map streamed through a TileMap (core/tile_map.h): pan and
+// zoom over a map far bigger than memory, with only the tiles in view, their
+// ancestors and what the motion is heading for on the GPU.
+//
+// The cache is one GL_TEXTURE_2D_ARRAY of RGBA8 tiles, a layer per TileMap
+// slot, as many as fit the byte budget. A frame:
+//  1. tile_map_update picks the tiles and hands out loads, which go on a
+//     queue for the decode threads. Loads still queued that the view no
+//     longer wants are dropped first, so a fast pan doesn't leave a backlog;
+//  2. decoded tiles, up to "uploads_per_frame" of them, are copied into the
+//     stream buffer bound as GL_PIXEL_UNPACK_BUFFER and go into their layers
+//     from there, so the copy to the GPU runs behind the frame;
+//  3. every tile is one instance of a four-vertex strip: its rectangle in
+//     pixels, the part of its layer to show (all of it, or a quarter of a
+//     quarter... for a tile standing in for a descendant still loading) and
+//     the layer.
+//
+// The tiles are made up rather than read: each is decoded from nothing, as
+// fractal terrain at the tile's place and scale, so any of the trillion tiles
+// of the deepest level costs the same as any other. Decoding runs on threads
+// of its own, not the job system: a tile takes milliseconds and the queue
+// outlives frames.
+//
+// Belongs to the thread whose context renders; the decode threads never call
+// GL.
+
+#define TILE_MAP_RENDERER_TILE_SIZE 256
+#define TILE_MAP_RENDERER_LEVELS 21         // 2^20 x 2^20 tiles at the bottom, 256 PB of texels
+#define TILE_MAP_RENDERER_MAX_THREADS 8
+#define TILE_MAP_RENDERER_MAX_DRAWS 2048
+#define TILE_MAP_RENDERER_MAX_REQUESTS 64   // per update
+
+typedef struct TileMapRenderer
+{
+    TileMap map;
+    GLuint program;
+    GLint viewport_location;
+    GLuint texture;                 // GL_TEXTURE_2D_ARRAY, a layer per slot
+    GLuint vertex_array;
+    StreamBuffer instances;         // rect, uv and layer per tile drawn
+    StreamBuffer uploads;           // GL_PIXEL_UNPACK_BUFFER: a frame's decoded tiles
+    int uploads_per_frame;
+    TileDraw* draws;                // [TILE_MAP_RENDERER_MAX_DRAWS]
+    TileRequest requests[TILE_MAP_RENDERER_MAX_REQUESTS];
+
+    std::thread threads[TILE_MAP_RENDERER_MAX_THREADS];
+    int thread_count;
+    std::mutex mutex;
+    std::condition_variable wake;   // a tile was queued, or stop
+    bool stop;
+    TileRequest* queue;             // FIFO of loads not started, [map.max_loading], guarded by mutex
+    int queue_head, queue_count;
+    int* decoded;                   // slots decoded and not uploaded yet, with their staging, guarded by mutex
+    int* decoded_staging;
+    int decoded_count;
+    int* free_staging;              // guarded by mutex
+    int free_staging_count;
+    unsigned char* staging;         // a tile of texels per load in flight
+    size_t tile_bytes;
+    bool depth_test;                // as the draw found it
+
+    uint64_t bytes_uploaded;
+    uint64_t tiles_decoded;
+    uint64_t tiles_cancelled;
+    unsigned int frames;
+    unsigned int draws_drawn;       // instances in the last frame
+} TileMapRenderer;
+
+// A cache of "budget" bytes of tiles, decoded by "thread_count" threads (0 for all but one of the hardware's)
+// and uploaded "uploads_per_frame" a frame. Logs and returns false when the program fails to build or the
+// budget can't hold the pinned tiles and a view.
+bool tile_map_renderer_init(TileMapRenderer* tmr, uint64_t budget, int thread_count, int uploads_per_frame);
+
+// Stops and joins the decode threads, then deletes the GL objects
+void tile_map_renderer_destroy(TileMapRenderer* tmr);
+
+// The map rectangle "view" (x0, y0, x1, y1, y up in [0, 1]) over the bound "width" x "height" framebuffer,
+// "dt" seconds after the last frame, without depth testing or blending. Overwrites every pixel the map covers.
+void tile_map_renderer_draw(TileMapRenderer* tmr, const double view[4], int width, int height, double dt);
@@ -0,0 +1,238 @@
+#include "gl/ui_renderer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Pixels to clip space through "transform" (x, y scale, then offset), as gl/shape_renderer.h's; premultiplied out
+static const char* vertex_shader_text =
+"#version 330 core\n"
+"uniform vec4 transform;\n"
+"layout(location = 0) in vec2 vPos;\n"
+"layout(location = 1) in vec4 vCol;\n"
+"out vec4 color;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = vec4(vPos * transform.xy + transform.zw, 0.0, 1.0);\n"
+"    color = vec4(vCol.rgb * vCol.a, vCol.a);\n"
+"}\n";
+
+static const char* fragment_shader_text =
+"#version 330 core\n"
+"in vec4 color;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    fragment = color;\n"
+"}\n";
+
+// A full-screen triangle reading the picture texel for texel, blended premultiplied
+static const char* composite_vertex_shader_text =
+"#version 330 core\n"
+"void main()\n"
+"{\n"
+"    gl_Position = vec4(vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+static const char* composite_fragment_shader_text =
+"#version 330 core\n"
+"uniform sampler2D picture;\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    fragment = texelFetch(picture, ivec2(gl_FragCoord.xy), 0);\n"
+"}\n";
+
+bool ui_renderer_init(UiRenderer* ur)
+{
+    memset(ur, 0, sizeof(*ur));
+    ur->program = program_build(vertex_shader_text, fragment_shader_text, false);
+    ur->composite_program = program_build(composite_vertex_shader_text, composite_fragment_shader_text, false);
+    if (!ur->program || !ur->composite_program)
+    {
+        fprintf(stderr, "ui_renderer: can't build the programs\n");
+        ui_renderer_destroy(ur);
+        return false;
+    }
+    gl_debug_label(GL_PROGRAM, ur->program, "ui");
+    gl_debug_label(GL_PROGRAM, ur->composite_program, "ui composite");
+    ur->transform_location = glGetUniformLocation(ur->program, "transform");
+    gl_state_use_program(ur->composite_program);
+    glUniform1i(glGetUniformLocation(ur->composite_program, "picture"), 0);
+
+    vertex_format_init(&ur->format);
+    vertex_format_add(&ur->format, 0, 2, VERTEX_ATTRIB_FLOAT32);
+    vertex_format_add(&ur->format, 1, 4, VERTEX_ATTRIB_UNORM8);
+    vertex_format_add(&ur->format, 2, 2, VERTEX_ATTRIB_UNORM16);
+    ur->vertex_array = gl_dsa_create_vertex_array();
+    gl_debug_label(GL_VERTEX_ARRAY, ur->vertex_array, "ui");
+    return true;
+}
+
+static void ui_renderer_release_buffers(UiRenderer* ur)
+{
+    if (ur->index_buffer)
+        gl_state_delete_buffers(1, &ur->index_buffer);
+    if (ur->vertex_buffer)
+        gl_state_delete_buffers(1, &ur->vertex_buffer);
+    ur->index_buffer = ur->vertex_buffer = 0;
+    ur->vertex_capacity = ur->index_capacity = 0;
+}
+
+void ui_renderer_destroy(UiRenderer* ur)
+{
+    ui_renderer_release_buffers(ur);
+    if (ur->picture.framebuffer)
+        render_target_destroy(&ur->picture);
+    if (ur->vertex_array)
+        gl_state_delete_vertex_arrays(1, &ur->vertex_array);
+    if (ur->composite_program)
+        glDeleteProgram(ur->composite_program);
+    if (ur->program)
+        glDeleteProgram(ur->program);
+    memset(ur, 0, sizeof(*ur));
+}
+
+// Buffers as large as the layer's arrays, made again when widgets were added past them
+static bool ui_renderer_buffers(UiRenderer* ur, const UiLayer* ui)
+{
+    ui_renderer_release_buffers(ur);
+    ur->vertex_buffer = gl_dsa_create_buffer((GLsizeiptr)sizeof(ShapeVertex) * ui->vertex_capacity, NULL,
+        GL_DYNAMIC_DRAW);
+    ur->index_buffer = gl_dsa_create_buffer((GLsizeiptr)sizeof(uint32_t) * ui->index_capacity, NULL, GL_DYNAMIC_DRAW);
+    if (!ur->vertex_buffer || !ur->index_buffer)
+    {
+        ui_renderer_release_buffers(ur);
+        return false;
+    }
+    gl_memory_buffer(ur->vertex_buffer, GPU_MEMORY_GEOMETRY, sizeof(ShapeVertex) * ui->vertex_capacity);
+    gl_memory_buffer(ur->index_buffer, GPU_MEMORY_GEOMETRY, sizeof(uint32_t) * ui->index_capacity);
+    gl_debug_label(GL_BUFFER, ur->vertex_buffer, "ui vertices");
+    gl_debug_label(GL_BUFFER, ur->index_buffer, "ui indices");
+    ur->vertex_capacity = ui->vertex_capacity;
+    ur->index_capacity = ui->index_capacity;
+    gl_state_bind_vertex_array(ur->vertex_array);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, ur->vertex_buffer);
+    vertex_format_apply(&ur->format, 0);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ur->index_buffer);
+    return true;
+}
+
+void ui_renderer_draw(UiRenderer* ur, UiLayer* ui, int width, int height)
+{
+    ur->damage_count = 0;
+    if (!ui->index_count || width < 1 || height < 1)
+        return;
+    const GLuint read_framebuffer = gl_state.read_framebuffer, draw_framebuffer = gl_state.draw_framebuffer;
+    GLint viewport[4] = { 0, 0, width, height };
+    if (gl_state.viewport_known)
+        memcpy(viewport, gl_state.viewport, sizeof(viewport));
+    ++ur->frames;
+
+    // A new size or new buffers: everything, from the whole arrays
+    bool all = ui->all_dirty;
+    if (ur->picture.width != width || ur->picture.height != height)
+    {
+        if (ur->picture.framebuffer)
+            render_target_destroy(&ur->picture);
+        if (!render_target_init(&ur->picture, width, height, GL_RGBA8, false, 1))
+            return;
+        gl_debug_label(GL_FRAMEBUFFER, ur->picture.framebuffer, "ui picture");
+        all = true;
+    }
+    if (!ur->vertex_buffer || ur->vertex_capacity < ui->vertex_count || ur->index_capacity < ui->index_count)
+    {
+        if (!ui_renderer_buffers(ur, ui))
+            return;
+        all = true;     // filled whole
+    }
+    // Whole arrays, or each rewritten widget's vertices and the indices it has or had
+    if (all)
+    {
+        gl_dsa_buffer_sub_data(ur->vertex_buffer, 0, (GLsizeiptr)sizeof(ShapeVertex) * ui->vertex_count, ui->vertices);
+        gl_dsa_buffer_sub_data(ur->index_buffer, 0, (GLsizeiptr)sizeof(uint32_t) * ui->index_count, ui->indices);
+        ur->uploaded += sizeof(ShapeVertex) * ui->vertex_count + sizeof(uint32_t) * ui->index_count;
+    }
+    else
+        for (uint32_t i = 0; i < ui->widget_count && ui->dirty_widgets; ++i)
+        {
+            const UiWidget* w = &ui->widgets[i];
+            if (!w->dirty)
+                continue;
+            if (w->vertex_count)
+                gl_dsa_buffer_sub_data(ur->vertex_buffer, (GLintptr)sizeof(ShapeVertex) * w->first_vertex,
+                    (GLsizeiptr)sizeof(ShapeVertex) * w->vertex_count, ui->vertices + w->first_vertex);
+            if (w->dirty_indices)
+                gl_dsa_buffer_sub_data(ur->index_buffer, (GLintptr)sizeof(uint32_t) * w->first_index,
+                    (GLsizeiptr)sizeof(uint32_t) * w->dirty_indices, ui->indices + w->first_index);
+            ur->uploaded += sizeof(ShapeVertex) * w->vertex_count + sizeof(uint32_t) * w->dirty_indices;
+        }
+
+    // The dirty rectangles, clipped to the frame and flipped to GL's bottom-left origin
+    if (all)
+    {
+        ur->damage[0][0] = ur->damage[0][1] = 0;
+        ur->damage[0][2] = width;
+        ur->damage[0][3] = height;
+        ur->damage_count = 1;
+    }
+    else
+        for (int i = 0; i < ui->dirty_count; ++i)
+        {
+            const float* d = ui->dirty[i];
+            const int x0 = d[0] > 0.f ? (int)d[0] : 0, y0 = d[1] > 0.f ? (int)d[1] : 0;
+            const int x1 = d[2] < (float)width ? (int)d[2] : width, y1 = d[3] < (float)height ? (int)d[3] : height;
+            if (x1 <= x0 || y1 <= y0)
+                continue;
+            int* damage = ur->damage[ur->damage_count++];
+            damage[0] = x0;
+            damage[1] = height - y1;
+            damage[2] = x1 - x0;
+            damage[3] = y1 - y0;
+        }
+    ui_layer_clean(ui);
+
+    const bool depth_test = gl_state.capabilities[GL_STATE_CAP_DEPTH_TEST] == 1;
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    if (ur->damage_count)
+    {
+        static const GLfloat transparent[4] = { 0.f, 0.f, 0.f, 0.f };
+        render_target_bind(&ur->picture);
+        gl_state_viewport(0, 0, width, height);
+        gl_state_use_program(ur->program);
+        glUniform4f(ur->transform_location, 2.f / width, -2.f / height, -1.f, 1.f);
+        gl_state_bind_vertex_array(ur->vertex_array);
+        gl_state_enable(GL_SCISSOR_TEST, true);
+        for (int i = 0; i < ur->damage_count; ++i)
+        {
+            const int* damage = ur->damage[i];
+            glScissor(damage[0], damage[1], damage[2], damage[3]);
+            glClearBufferfv(GL_COLOR, 0, transparent);
+            glDrawElements(GL_TRIANGLES, (GLsizei)ui->index_count, GL_UNSIGNED_INT, (void*)0);
+            draw_counters_draw(GL_TRIANGLES, (GLsizei)ui->index_count, 1);
+            ur->pixels += (uint64_t)damage[2] * (uint64_t)damage[3];
+        }
+        gl_state_enable(GL_SCISSOR_TEST, false);
+        ++ur->redraws;
+    }
+
+    // Onto the caller's target
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer);
+    gl_state_viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    gl_state_use_program(ur->composite_program);
+    gl_state_bind_vertex_array(ur->vertex_array);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, ur->picture.color);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+    gl_state_enable(GL_BLEND, false);
+    gl_state_enable(GL_DEPTH_TEST, depth_test);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/ui_layer.h"
+#include "gl/render_target.h"
+#include "gl/vertex_format.h"
+
+#include <stdint.h>
+
+// Draws a UiLayer (core/ui_layer.h) through a picture of it that's kept
+// between frames, so a frame where nothing on it changed draws none of it.
+//
+// The widgets' vertices and indices live in a vertex and an index buffer of
+// their own, not a per-frame stream: they're written once, with
+// glBufferSubData over only the spans the layer says changed. The picture is
+// an RGBA8 target the size of the frame, premultiplied and transparent where
+// there's nothing. Each dirty rectangle is cleared in it and the whole layer
+// drawn again under a scissor of that rectangle, one draw each: the vertices
+// are all transformed but only the dirty pixels are shaded. Then a
+// full-screen triangle composites the picture over the frame, as
+// gl/point_cloud_renderer.h does its layer. A new size draws it all.
+//
+// "damage" holds the rectangles the last ui_renderer_draw redrew, in window
+// pixels from the bottom left as gl/swap_damage.h takes them: where the frame
+// differs from the last one when nothing else on it changed.
+
+typedef struct UiRenderer
+{
+    GLuint program;
+    GLint transform_location;
+    GLuint composite_program;
+    GLuint vertex_array;
+    VertexFormat format;
+    GLuint vertex_buffer, index_buffer;
+    uint32_t vertex_capacity, index_capacity;   // the buffers', grown with the layer
+    RenderTarget picture;
+
+    int damage[UI_LAYER_MAX_DIRTY][4];  // x, y, width, height
+    int damage_count;
+
+    // Over the run, for the report
+    unsigned int frames;
+    unsigned int redraws;           // frames that drew any of the layer again
+    uint64_t uploaded;              // bytes of vertices and indices
+    uint64_t pixels;                // redrawn
+} UiRenderer;
+
+// Needs a current context. Logs and returns false when a program can't be built.
+bool ui_renderer_init(UiRenderer* ur);
+void ui_renderer_destroy(UiRenderer* ur);
+
+// Brings the picture up to date with "ui", "width" x "height" pixels, and composites it over the draw framebuffer
+// that was bound, which it leaves bound. Cleans the layer. Leaves blending off, the depth test as it found it.
+void ui_renderer_draw(UiRenderer* ur, UiLayer* ui, int width, int height);
@@ -0,0 +1,51 @@
+#include "gl/uniforms.h"
+
+#include "gl/gl_state.h"
+
+void uniforms_bind_blocks(GLuint program)
+{
+    const GLuint camera_index = glGetUniformBlockIndex(program, "Camera");
+    if (camera_index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, camera_index, UNIFORMS_BINDING_CAMERA);
+
+    const GLuint frame_index = glGetUniformBlockIndex(program, "Frame");
+    if (frame_index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, frame_index, UNIFORMS_BINDING_FRAME);
+
+    const GLuint draw_index = glGetUniformBlockIndex(program, "Draw");
+    if (draw_index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, draw_index, UNIFORMS_BINDING_DRAW);
+
+    const GLuint stereo_index = glGetUniformBlockIndex(program, "Stereo");
+    if (stereo_index != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, stereo_index, UNIFORMS_BINDING_STEREO);
+}
+
+GLsizeiptr uniforms_offset_alignment(void)
+{
+    static GLint alignment = 0;
+    if (!alignment)
+    {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        if (alignment < 16)
+            alignment = 16;
+    }
+    return alignment;
+}
+
+GLsizeiptr uniforms_block_stride(GLsizeiptr block_size)
+{
+    const GLsizeiptr alignment = uniforms_offset_alignment();
+    return (block_size + alignment - 1) / alignment * alignment;
+}
+
+void* uniforms_alloc(StreamBuffer* sb, GLsizeiptr block_size, GLintptr* offset)
+{
+    // The spec only promises the alignment is a minimum, not a power of two, but every driver reports one
+    return stream_buffer_alloc(sb, block_size, uniforms_offset_alignment(), offset);
+}
+
+void uniforms_bind_range(const StreamBuffer* sb, GLuint binding, GLintptr offset, GLsizeiptr block_size)
+{
+    gl_state_bind_buffer_range(GL_UNIFORM_BUFFER, binding, sb->buffer, offset, block_size);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "linmath.h"
+#include "gl/stream_buffer.h"
+
+// std140 uniform blocks shared by every program. The C structs mirror the
+// GLSL declarations in UNIFORMS_GLSL member for member; std140 rounds vec3 up
+// to vec4 and aligns mat4 columns to 16 bytes, so only vec4/mat4 members are
+// used to keep the two layouts identical without padding fields.
+
+#define UNIFORMS_BINDING_FRAME  0   // per-frame constants, bound once per frame
+#define UNIFORMS_BINDING_DRAW   1   // per-draw constants, one range per draw
+#define UNIFORMS_BINDING_CAMERA 2   // camera constants, rewritten only when the camera changes
+#define UNIFORMS_BINDING_STEREO 8   // --stereo: both eyes' view-projections, rewritten with the camera
+
+typedef struct CameraUniforms
+{
+    mat4x4 view;
+    mat4x4 projection;
+    mat4x4 view_projection;
+    vec4 viewport;      // x, y, width, height in pixels
+} CameraUniforms;
+
+typedef struct FrameUniforms
+{
+    vec4 time;          // x = seconds since start, y = frame delta, z = frame index, w = simulated seconds
+} FrameUniforms;
+
+typedef struct DrawUniforms
+{
+    mat4x4 model;
+} DrawUniforms;
+
+typedef struct StereoUniforms
+{
+    mat4x4 eye_view_projection[2];  // left, right
+} StereoUniforms;
+
+// GLSL declarations of the blocks above, pasted after the #version line of a shader
+#define UNIFORMS_GLSL \
+    "layout(std140) uniform Camera\n" \
+    "{\n" \
+    "    mat4 view;\n" \
+    "    mat4 projection;\n" \
+    "    mat4 viewProjection;\n" \
+    "    vec4 viewport;\n" \
+    "};\n" \
+    "layout(std140) uniform Frame\n" \
+    "{\n" \
+    "    vec4 time;\n" \
+    "};\n" \
+    "layout(std140) uniform Draw\n" \
+    "{\n" \
+    "    mat4 model;\n" \
+    "};\n"
+
+// The Stereo block, for the shaders that draw both eyes at once
+#define UNIFORMS_STEREO_GLSL \
+    "layout(std140) uniform Stereo\n" \
+    "{\n" \
+    "    mat4 eyeViewProjection[2];\n" \
+    "};\n"
+
+// Points the program's Camera/Frame/Draw/Stereo blocks (when it uses them) at the fixed binding indices.
+// GLSL 330 has no layout(binding = N), so this runs once after linking.
+void uniforms_bind_blocks(GLuint program);
+
+// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, the granularity for glBindBufferRange offsets
+GLsizeiptr uniforms_offset_alignment(void);
+
+// Size of one block in a stream buffer, rounded up to the offset alignment
+GLsizeiptr uniforms_block_stride(GLsizeiptr block_size);
+
+// Reserves one block in "sb" (a GL_UNIFORM_BUFFER stream) and returns the write pointer, or NULL when full.
+// "offset" receives the position to hand to glBindBufferRange once the data is written.
+void* uniforms_alloc(StreamBuffer* sb, GLsizeiptr block_size, GLintptr* offset);
+
+// glBindBufferRange of one block of "sb" at "binding"
+void uniforms_bind_range(const StreamBuffer* sb, GLuint binding, GLintptr offset, GLsizeiptr block_size);
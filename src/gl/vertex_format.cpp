@@ -0,0 +1,191 @@
+#include "gl/vertex_format.h"
+
+#include "gl/gl_ext.h"
+#include "gl/gl_state.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void vertex_format_init(VertexFormat* format)
+{
+    memset(format, 0, sizeof(*format));
+}
+
+bool vertex_format_add(VertexFormat* format, GLuint location, int components, VertexAttribType type)
+{
+    if (format->count == VERTEX_FORMAT_MAX_ATTRIBS || components < 1 || components > 4)
+    {
+        fprintf(stderr, "vertex_format: can't add %d components at location %u\n", components, location);
+        return false;
+    }
+    VertexAttrib* attrib = &format->attribs[format->count++];
+    attrib->location = location;
+    attrib->components = components;
+    attrib->type = type;
+    attrib->offset = (format->stride + 3) & ~(size_t)3;
+    format->stride = attrib->offset + vertex_attrib_size(type) * components;
+    format->stride = (format->stride + 3) & ~(size_t)3;
+    return true;
+}
+
+void vertex_format_apply(const VertexFormat* format, GLintptr base_offset)
+{
+    for (int i = 0; i < format->count; ++i)
+    {
+        const VertexAttrib* attrib = &format->attribs[i];
+        const GLsizei stride = (GLsizei)(attrib->stream ? format->attribute_stride : format->stride);
+        const GLintptr start = base_offset + (GLintptr)(attrib->stream ? format->attribute_offset : 0);
+        glEnableVertexAttribArray(attrib->location);
+        if (attrib->type == VERTEX_ATTRIB_UINT8)
+        {
+            glVertexAttribIPointer(attrib->location, attrib->components, vertex_format_gl_type(attrib->type),
+                stride, (void*)(start + attrib->offset));
+            continue;
+        }
+        glVertexAttribPointer(attrib->location, attrib->components, vertex_format_gl_type(attrib->type),
+            vertex_format_normalized(attrib->type), stride, (void*)(start + attrib->offset));
+    }
+}
+
+bool vertex_format_equal(const VertexFormat* a, const VertexFormat* b)
+{
+    if (a->count != b->count || a->stride != b->stride || a->attribute_stride != b->attribute_stride)
+        return false;
+    for (int i = 0; i < a->count; ++i)
+    {
+        const VertexAttrib* x = &a->attribs[i];
+        const VertexAttrib* y = &b->attribs[i];
+        if (x->location != y->location || x->components != y->components || x->type != y->type || x->offset != y->offset
+            || x->stream != y->stream)
+            return false;
+    }
+    return true;
+}
+
+// The mesh file's records for "format"'s attributes
+static void to_mesh_file(const VertexFormat* format, MeshFileAttrib* attribs)
+{
+    for (int a = 0; a < format->count; ++a)
+        attribs[a] = { (uint8_t)format->attribs[a].location, (uint8_t)format->attribs[a].components,
+            (uint8_t)format->attribs[a].type, (uint8_t)format->attribs[a].stream, (uint32_t)format->attribs[a].offset };
+}
+
+bool vertex_format_split(VertexFormat* format, GLuint position_location, size_t vertex_count)
+{
+    MeshFileAttrib attribs[VERTEX_FORMAT_MAX_ATTRIBS];
+    to_mesh_file(format, attribs);
+    uint32_t stride = 0, attribute_stride = 0;
+    if (position_location > 255 || !vertex_pack_split(attribs, format->count, (uint8_t)position_location, &stride,
+        &attribute_stride))
+        return false;
+    for (int a = 0; a < format->count; ++a)
+    {
+        format->attribs[a].offset = attribs[a].offset;
+        format->attribs[a].stream = attribs[a].stream;
+    }
+    format->stride = stride;
+    format->attribute_stride = attribute_stride;
+    format->attribute_offset = (size_t)vertex_pack_attribute_offset(stride, vertex_count);
+    return true;
+}
+
+size_t vertex_format_size(const VertexFormat* format, size_t vertex_count)
+{
+    return (size_t)vertex_pack_size(format->stride, format->attribute_stride, vertex_count);
+}
+
+void vertex_format_enable_attributes(const VertexFormat* format, bool enable)
+{
+    for (int i = 0; format->attribute_stride && i < format->count; ++i)
+    {
+        if (!format->attribs[i].stream)
+            continue;
+        if (enable)
+            glEnableVertexAttribArray(format->attribs[i].location);
+        else
+            glDisableVertexAttribArray(format->attribs[i].location);
+    }
+}
+
+static bool has_location(const VertexFormat* format, GLuint location)
+{
+    for (int i = 0; i < format->count; ++i)
+        if (format->attribs[i].location == location)
+            return true;
+    return false;
+}
+
+void vertex_format_disable_missing(const VertexFormat* format, const VertexFormat* previous)
+{
+    for (int i = 0; previous && i < previous->count; ++i)
+        if (!has_location(format, previous->attribs[i].location))
+            glDisableVertexAttribArray(previous->attribs[i].location);
+}
+
+void vertex_format_attach(const VertexFormat* format, const VertexFormat* previous, GLuint buffer)
+{
+    if (!gl_ext.ARB_vertex_attrib_binding)
+    {
+        vertex_format_disable_missing(format, previous);
+        gl_state_bind_buffer(GL_ARRAY_BUFFER, buffer);
+        vertex_format_apply(format, 0);
+        return;
+    }
+
+    if (!previous || !vertex_format_equal(format, previous))
+    {
+        vertex_format_disable_missing(format, previous);
+        for (int i = 0; i < format->count; ++i)
+        {
+            const VertexAttrib* attrib = &format->attribs[i];
+            glEnableVertexAttribArray(attrib->location);
+            if (attrib->type == VERTEX_ATTRIB_UINT8)
+                gl_ext.VertexAttribIFormat(attrib->location, attrib->components, vertex_format_gl_type(attrib->type),
+                    (GLuint)attrib->offset);
+            else
+                gl_ext.VertexAttribFormat(attrib->location, attrib->components, vertex_format_gl_type(attrib->type),
+                    vertex_format_normalized(attrib->type), (GLuint)attrib->offset);
+            gl_ext.VertexAttribBinding(attrib->location,
+                attrib->stream ? VERTEX_FORMAT_ATTRIBUTE_BINDING : VERTEX_FORMAT_BINDING);
+        }
+    }
+    gl_ext.BindVertexBuffer(VERTEX_FORMAT_BINDING, buffer, 0, (GLsizei)format->stride);
+    if (format->attribute_stride)
+        gl_ext.BindVertexBuffer(VERTEX_FORMAT_ATTRIBUTE_BINDING, buffer, (GLintptr)format->attribute_offset,
+            (GLsizei)format->attribute_stride);
+}
+
+bool vertex_format_from_mesh_file(VertexFormat* format, const MeshFileHeader* header)
+{
+    vertex_format_init(format);
+    bool ok = true;
+    int position = -1;
+    for (uint32_t i = 0; i < header->attrib_count && ok; ++i)
+    {
+        const MeshFileAttrib* a = &header->attribs[i];
+        ok = a->type <= VERTEX_ATTRIB_UINT8
+            && vertex_format_add(format, a->location, a->components, (VertexAttribType)a->type);
+        position = a->stream == 0 && position < 0 ? (int)a->location : position;
+    }
+    // Stored split: laid out again the way the cooker split it, then checked against the file like an interleaved one
+    if (ok && header->attribute_stride)
+        ok = position >= 0 && vertex_format_split(format, (GLuint)position, header->vertex_count)
+            && format->attribute_stride == header->attribute_stride
+            && format->attribute_offset == header->attribute_offset;
+    for (uint32_t i = 0; i < header->attrib_count && ok; ++i)
+        ok = format->attribs[i].offset == header->attribs[i].offset
+            && format->attribs[i].stream == header->attribs[i].stream;
+    if (!ok || format->stride != header->vertex_stride)
+    {
+        fprintf(stderr, "vertex_format: mesh file has a vertex layout this build can't describe\n");
+        return false;
+    }
+    return true;
+}
+
+void vertex_format_pack(const VertexFormat* format, const VertexSource* sources, size_t vertex_count, void* out)
+{
+    MeshFileAttrib attribs[VERTEX_FORMAT_MAX_ATTRIBS];
+    to_mesh_file(format, attribs);
+    vertex_pack_streams(attribs, format->count, format->stride, format->attribute_stride, sources, vertex_count, out);
+}
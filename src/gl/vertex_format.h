@@ -0,0 +1,216 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "asset/mesh_file.h"
+#include "asset/vertex_layout.h"
+#include "asset/vertex_pack.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_state.h"
+
+#include <utility>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Declarative vertex layouts.
+//
+// A VertexFormat lists attributes (shader location, component count, storage
+// type) and derives offsets and stride from them; vertex_format_apply then
+// issues the matching glVertexAttribPointer calls, so layouts no longer have
+// to be kept in sync with hand-written offsetof() arithmetic. Data is authored
+// as floats and packed into the declared storage types at load time by
+// vertex_format_pack: half floats and normalized 8/16-bit integers cut vertex
+// size 2-4x, and the attributes still arrive in the shader as floats. UINT8
+// is the exception: small integers such as joint indices, read as uint/uvec.
+// The types and the packing itself are asset/vertex_pack.h's, which tools
+// use without GL.
+//
+// With vertex attrib binding (4.3 or GL_ARB_vertex_attrib_binding) a vertex
+// array holds the layout apart from the buffer it reads: vertex_format_attach
+// sets the formats once and only rebinds VERTEX_FORMAT_BINDING when a mesh of
+// the same layout comes along, so one VAO per layout serves every mesh in it
+// (every mesh of a gl/mesh_heap.h heap, or each mesh in turn). Attributes
+// set with glVertexAttribPointer use the binding of their own location, so
+// the two can share a VAO as long as no pointer attribute sits at location
+// VERTEX_FORMAT_BINDING.
+//
+// A layout known when the code is compiled can be a VertexLayout type
+// (asset/vertex_layout.h) instead: vertex_layout_apply and
+// vertex_layout_attach do what vertex_format_apply and vertex_format_attach
+// do, with every location, type, offset and stride a constant and no loop
+// over a table, and vertex_layout_format gives the equal VertexFormat for the
+// code that keeps or compares layouts at runtime.
+//
+// A layout can also be split (vertex_format_split): the position alone in
+// one stream and the other attributes in a second one after it in the same
+// buffer, as a mesh file cooked that way stores them. The passes that only
+// need positions (the depth pre-pass, shadows) turn the attribute stream off
+// with vertex_format_enable_attributes and fetch just the positions. With
+// vertex attrib binding the attribute stream reads through
+// VERTEX_FORMAT_ATTRIBUTE_BINDING.
+
+#define VERTEX_FORMAT_MAX_ATTRIBS 8
+#define VERTEX_FORMAT_BINDING 15    // below GL_MAX_VERTEX_ATTRIB_BINDINGS' minimum of 16, above the locations in use
+#define VERTEX_FORMAT_ATTRIBUTE_BINDING 14  // a split layout's attribute stream
+
+typedef struct VertexAttrib
+{
+    GLuint location;
+    int components;             // 1-4 in the shader
+    VertexAttribType type;
+    size_t offset;              // bytes into the vertex, in its stream
+    int stream;                 // 0, or 1 for the attribute stream of a split layout
+} VertexAttrib;
+
+typedef struct VertexFormat
+{
+    VertexAttrib attribs[VERTEX_FORMAT_MAX_ATTRIBS];
+    int count;
+    size_t stride;              // the position stream's, when split
+    size_t attribute_stride;    // the attribute stream's, 0 when interleaved
+    size_t attribute_offset;    // where the attribute stream starts in the buffer
+} VertexFormat;
+
+constexpr GLenum vertex_format_gl_type(VertexAttribType type)
+{
+    switch (type)
+    {
+    case VERTEX_ATTRIB_FLOAT32: return GL_FLOAT;
+    case VERTEX_ATTRIB_FLOAT16: return GL_HALF_FLOAT;
+    case VERTEX_ATTRIB_SNORM16: return GL_SHORT;
+    case VERTEX_ATTRIB_UNORM16: return GL_UNSIGNED_SHORT;
+    case VERTEX_ATTRIB_SNORM8: return GL_BYTE;
+    case VERTEX_ATTRIB_UNORM8:
+    case VERTEX_ATTRIB_UINT8: return GL_UNSIGNED_BYTE;
+    }
+    return GL_FLOAT;
+}
+
+constexpr GLboolean vertex_format_normalized(VertexAttribType type)
+{
+    return type != VERTEX_ATTRIB_FLOAT32 && type != VERTEX_ATTRIB_FLOAT16 && type != VERTEX_ATTRIB_UINT8 ? GL_TRUE
+        : GL_FALSE;
+}
+
+void vertex_format_init(VertexFormat* format);
+
+// Appends an attribute. Each one starts 4-byte aligned (as GL wants), so e.g. 3 x UNORM8 takes 4 bytes.
+bool vertex_format_add(VertexFormat* format, GLuint location, int components, VertexAttribType type);
+
+// Enables the attributes and points them at the bound GL_ARRAY_BUFFER, starting at "base_offset"
+void vertex_format_apply(const VertexFormat* format, GLintptr base_offset);
+
+// Layouts that describe the same vertices (a split layout's attribute_offset, which depends on the vertex count, aside)
+bool vertex_format_equal(const VertexFormat* a, const VertexFormat* b);
+
+// Splits the layout: the attribute at "position_location" alone in stream 0, the rest in stream 1, which starts
+// after "vertex_count" vertices of stream 0 (asset/vertex_pack.h's vertex_pack_split and
+// vertex_pack_attribute_offset). False, the layout left alone, when there's nothing to split.
+bool vertex_format_split(VertexFormat* format, GLuint position_location, size_t vertex_count);
+
+// Bytes "vertex_count" vertices take: vertex_count * stride, or both streams when split
+size_t vertex_format_size(const VertexFormat* format, size_t vertex_count);
+
+// Enables or disables the bound vertex array's arrays of a split layout's attribute stream, e.g. off around a pass
+// that only reads positions. Does nothing for an interleaved layout.
+void vertex_format_enable_attributes(const VertexFormat* format, bool enable);
+
+// Points the bound vertex array's attributes at "buffer" laid out as "format". "previous" is the layout the VAO had
+// (NULL or an empty one for a new VAO): its attributes "format" doesn't have are disabled. With vertex attrib binding
+// and an equal layout this is a single glBindVertexBuffer; without it, glVertexAttribPointer through GL_ARRAY_BUFFER.
+void vertex_format_attach(const VertexFormat* format, const VertexFormat* previous, GLuint buffer);
+
+// Disables the attributes of "previous" (may be NULL) that "format" doesn't have
+void vertex_format_disable_missing(const VertexFormat* format, const VertexFormat* previous);
+
+// Packs "vertex_count" vertices from one source per attribute (in declaration order) into "out", which must hold
+// vertex_format_size bytes. Values outside a normalized type's range are clamped.
+void vertex_format_pack(const VertexFormat* format, const VertexSource* sources, size_t vertex_count, void* out);
+
+// Rebuilds the layout of a mesh file. Logs and returns false if it holds types or offsets this build wouldn't produce.
+bool vertex_format_from_mesh_file(VertexFormat* format, const MeshFileHeader* header);
+
+// The VertexFormat vertex_format_add would build for "Layout"
+template <typename Layout, size_t... I>
+inline void vertex_layout_format(VertexFormat* format, std::index_sequence<I...>)
+{
+    static_assert(Layout::count <= VERTEX_FORMAT_MAX_ATTRIBS, "more attributes than a VertexFormat holds");
+    vertex_format_init(format);
+    ((format->attribs[I] = { Layout::template Attrib<I>::location, Layout::template Attrib<I>::components,
+        Layout::template Attrib<I>::type, Layout::offsets[I], 0 }), ...);
+    format->count = Layout::count;
+    format->stride = Layout::stride;
+}
+
+template <typename Layout>
+inline void vertex_layout_format(VertexFormat* format)
+{
+    vertex_layout_format<Layout>(format, std::make_index_sequence<Layout::count>());
+}
+
+template <typename Attrib, size_t Offset, size_t Stride>
+inline void vertex_layout_apply_attrib(GLintptr base_offset)
+{
+    glEnableVertexAttribArray(Attrib::location);
+    if constexpr (Attrib::type == VERTEX_ATTRIB_UINT8)
+        glVertexAttribIPointer(Attrib::location, Attrib::components, vertex_format_gl_type(Attrib::type),
+            (GLsizei)Stride, (void*)(base_offset + Offset));
+    else
+        glVertexAttribPointer(Attrib::location, Attrib::components, vertex_format_gl_type(Attrib::type),
+            vertex_format_normalized(Attrib::type), (GLsizei)Stride, (void*)(base_offset + Offset));
+}
+
+template <typename Attrib, size_t Offset>
+inline void vertex_layout_format_attrib()
+{
+    glEnableVertexAttribArray(Attrib::location);
+    if constexpr (Attrib::type == VERTEX_ATTRIB_UINT8)
+        gl_ext.VertexAttribIFormat(Attrib::location, Attrib::components, vertex_format_gl_type(Attrib::type),
+            (GLuint)Offset);
+    else
+        gl_ext.VertexAttribFormat(Attrib::location, Attrib::components, vertex_format_gl_type(Attrib::type),
+            vertex_format_normalized(Attrib::type), (GLuint)Offset);
+    gl_ext.VertexAttribBinding(Attrib::location, VERTEX_FORMAT_BINDING);
+}
+
+template <typename Layout, size_t... I>
+inline void vertex_layout_apply(GLintptr base_offset, std::index_sequence<I...>)
+{
+    (vertex_layout_apply_attrib<typename Layout::template Attrib<I>, Layout::offsets[I], Layout::stride>(base_offset),
+        ...);
+}
+
+// vertex_format_apply for "Layout"
+template <typename Layout>
+inline void vertex_layout_apply(GLintptr base_offset)
+{
+    vertex_layout_apply<Layout>(base_offset, std::make_index_sequence<Layout::count>());
+}
+
+template <typename Layout, size_t... I>
+inline void vertex_layout_attach(const VertexFormat* previous, GLuint buffer, std::index_sequence<I...>)
+{
+    VertexFormat format;
+    vertex_layout_format<Layout>(&format);
+    if (!gl_ext.ARB_vertex_attrib_binding)
+    {
+        vertex_format_disable_missing(&format, previous);
+        gl_state_bind_buffer(GL_ARRAY_BUFFER, buffer);
+        vertex_layout_apply<Layout>(0);
+        return;
+    }
+    if (!previous || !vertex_format_equal(&format, previous))
+    {
+        vertex_format_disable_missing(&format, previous);
+        (vertex_layout_format_attrib<typename Layout::template Attrib<I>, Layout::offsets[I]>(), ...);
+    }
+    gl_ext.BindVertexBuffer(VERTEX_FORMAT_BINDING, buffer, 0, (GLsizei)Layout::stride);
+}
+
+// vertex_format_attach for "Layout": "previous" is the layout the VAO had, NULL for a new one
+template <typename Layout>
+inline void vertex_layout_attach(const VertexFormat* previous, GLuint buffer)
+{
+    vertex_layout_attach<Layout>(previous, buffer, std::make_index_sequence<Layout::count>());
+}
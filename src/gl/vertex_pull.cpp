@@ -0,0 +1,79 @@
+#include "gl/vertex_pull.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool vertex_pull_supported(void)
+{
+    if (!GLAD_GL_VERSION_4_3)
+        return false;
+    GLint bindings = 0, vertex_blocks = 0;
+    glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &bindings);     // 8 promised: binding 8 is the ninth
+    glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertex_blocks);  // 0 promised
+    return bindings > VERTEX_PULL_BINDING && vertex_blocks > 0;
+}
+
+void vertex_pull_init(VertexPull* vp)
+{
+    vp->format_buffer = gl_dsa_create_buffer(sizeof(VertexPullFormat), NULL, GL_DYNAMIC_DRAW);
+    gl_memory_buffer(vp->format_buffer, GPU_MEMORY_UNIFORMS, sizeof(VertexPullFormat));
+    gl_debug_label(GL_BUFFER, vp->format_buffer, "pulled vertex format");
+    vp->vertex_buffer = 0;
+    vertex_format_init(&vp->format);
+}
+
+void vertex_pull_destroy(VertexPull* vp)
+{
+    gl_state_delete_buffers(1, &vp->format_buffer);
+    vp->format_buffer = vp->vertex_buffer = 0;
+}
+
+bool vertex_pull_describe(const VertexFormat* format, VertexPullFormat* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->stride[0] = (GLuint)(format->stride / 4);     // vertex_format_add keeps it, and every offset, 4-byte aligned
+    for (int i = 0; i < format->count; ++i)
+    {
+        const VertexAttrib* attrib = &format->attribs[i];
+        if (attrib->location >= VERTEX_PULL_LOCATIONS)
+        {
+            fprintf(stderr, "vertex_pull: location %u is past the %d a pulled layout has\n", attrib->location,
+                VERTEX_PULL_LOCATIONS);
+            return false;
+        }
+        GLuint* a = out->attribs[attrib->location];
+        a[0] = (GLuint)attrib->components;
+        a[1] = (GLuint)attrib->type;
+        a[2] = (GLuint)((attrib->offset + (attrib->stream ? format->attribute_offset : 0)) / 4);
+        a[3] = (GLuint)((attrib->stream ? format->attribute_stride : format->stride) / 4);
+    }
+    return true;
+}
+
+bool vertex_pull_attach(VertexPull* vp, const VertexFormat* format, GLuint buffer)
+{
+    // A split layout's attribute stream offset is in the block too
+    if (!vertex_format_equal(format, &vp->format) || format->attribute_offset != vp->format.attribute_offset
+        || !vp->vertex_buffer)
+    {
+        VertexPullFormat block;
+        if (!vertex_pull_describe(format, &block))
+            return false;
+        gl_dsa_buffer_sub_data(vp->format_buffer, 0, sizeof(block), &block);
+        vp->format = *format;
+    }
+    vp->vertex_buffer = buffer;
+    vertex_pull_bind(vp);
+    return true;
+}
+
+void vertex_pull_bind(const VertexPull* vp)
+{
+    gl_state_bind_buffer_base(GL_UNIFORM_BUFFER, VERTEX_PULL_FORMAT_BINDING, vp->format_buffer);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, VERTEX_PULL_BINDING, vp->vertex_buffer);
+}
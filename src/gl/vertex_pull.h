@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "gl/vertex_format.h"
+
+#include <stdint.h>
+
+// Vertex pulling (needs a 4.3 context): the vertex shader reads the mesh's
+// vertices itself, from its vertex buffer bound as shader storage and indexed
+// by gl_VertexID, and decodes each attribute in GLSL instead of through the
+// fixed-function attribute fetch.
+//
+// The layout is data, not vertex array state: a small uniform block holds
+// the stride and, per attribute location, the component count, the storage
+// type (VertexAttribType's values), the word it starts at and the words
+// between one vertex's and the next's, its stream's stride, so a split
+// layout's two streams are read from the one buffer too. Meshes of any
+// layout vertex_format_add can make are drawn by the same program and the
+// same vertex array, which keeps only the per-instance attributes and the
+// element buffer; a mesh of another layout costs a 144-byte buffer update,
+// not a vertex array switch. The types are unpacked with GLSL's unpack*
+// functions, so a compression scheme the fixed-function fetch has no format
+// for is a case in pullAttribute and a VertexAttribType value.
+//
+// VERTEX_PULL_GLSL is the vertex stage's side of it, #included by the scene
+// shaders' PULLED variant. Indexed bindings are per context: a context that
+// draws pulled meshes needs vertex_pull_bind once.
+
+#define VERTEX_PULL_BINDING 8           // the PulledVertices shader storage binding, as in VERTEX_PULL_GLSL
+#define VERTEX_PULL_FORMAT_BINDING 4    // the PulledFormat uniform block's binding, as in VERTEX_PULL_GLSL
+#define VERTEX_PULL_LOCATIONS 8         // attribute locations a pulled layout may use: 0 to 7
+
+#define VERTEX_PULL_GLSL \
+    "layout(std430, binding = 8) readonly buffer PulledVertices\n" \
+    "{\n" \
+    "    uint pulledWords[];\n" \
+    "};\n" \
+    "layout(std140, binding = 4) uniform PulledFormat\n" \
+    "{\n" \
+    "    uvec4 pulledStride;\n"         /* x: words per vertex */ \
+    "    uvec4 pulledAttribs[8];\n"     /* per location: components (0: none), type, first word, words per vertex */ \
+    "};\n" \
+    "vec4 pullAttribute(uint location)\n" \
+    "{\n" \
+    "    uvec4 a = pulledAttribs[location];\n" \
+    "    uint at = uint(gl_VertexID) * a.w + a.z;\n" \
+    "    vec4 d;\n" \
+    "    if (a.y == 0u)\n" \
+    "        d = uintBitsToFloat(uvec4(pulledWords[at], a.x > 1u ? pulledWords[at + 1u] : 0u,\n" \
+    "            a.x > 2u ? pulledWords[at + 2u] : 0u, a.x > 3u ? pulledWords[at + 3u] : 0u));\n" \
+    "    else\n" \
+    "    {\n" \
+    "        uint w0 = a.x > 0u ? pulledWords[at] : 0u;\n" \
+    "        uint w1 = a.y <= 3u && a.x > 2u ? pulledWords[at + 1u] : 0u;\n"   /* 16-bit types: two a word */ \
+    "        if (a.y == 1u)\n" \
+    "            d = vec4(unpackHalf2x16(w0), unpackHalf2x16(w1));\n" \
+    "        else if (a.y == 2u)\n" \
+    "            d = vec4(unpackSnorm2x16(w0), unpackSnorm2x16(w1));\n" \
+    "        else if (a.y == 3u)\n" \
+    "            d = vec4(unpackUnorm2x16(w0), unpackUnorm2x16(w1));\n" \
+    "        else if (a.y == 4u)\n" \
+    "            d = unpackSnorm4x8(w0);\n" \
+    "        else if (a.y == 5u)\n" \
+    "            d = unpackUnorm4x8(w0);\n" \
+    "        else\n" \
+    "            d = vec4((uvec4(w0) >> uvec4(0u, 8u, 16u, 24u)) & 0xFFu);\n" \
+    "    }\n" \
+    "    return mix(vec4(0.0, 0.0, 0.0, 1.0), d, lessThan(uvec4(0u, 1u, 2u, 3u), uvec4(a.x)));\n" /* as a fetch fills them */ \
+    "}\n"
+
+// The PulledFormat block, std140
+typedef struct VertexPullFormat
+{
+    GLuint stride[4];                           // x: words per vertex (the position stream's, when split)
+    GLuint attribs[VERTEX_PULL_LOCATIONS][4];   // per location: components (0: not in the layout), VertexAttribType,
+                                                // first word, words per vertex of its stream
+} VertexPullFormat;
+
+typedef struct VertexPull
+{
+    GLuint format_buffer;       // the PulledFormat block
+    GLuint vertex_buffer;       // the mesh's, bound at VERTEX_PULL_BINDING; 0 before the first attach
+    VertexFormat format;        // as format_buffer has it
+} VertexPull;
+
+// A 4.3 context with a vertex stage that can read shader storage at VERTEX_PULL_BINDING
+bool vertex_pull_supported(void);
+
+void vertex_pull_init(VertexPull* vp);
+void vertex_pull_destroy(VertexPull* vp);
+
+// "format" into a VertexPullFormat. False (logged) for a layout pullAttribute can't read: a location past
+// VERTEX_PULL_LOCATIONS.
+bool vertex_pull_describe(const VertexFormat* format, VertexPullFormat* out);
+
+// Draws from here on read "buffer", laid out as "format": the layout is written when it differs from the last one,
+// and both bindings are made in the current context. Returns false (logged, nothing changed) for a layout
+// vertex_pull_describe refuses.
+bool vertex_pull_attach(VertexPull* vp, const VertexFormat* format, GLuint buffer);
+
+// The current buffer and layout bound in the current context, e.g. another context sharing the objects
+void vertex_pull_bind(const VertexPull* vp);
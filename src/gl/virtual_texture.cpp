@@ -0,0 +1,493 @@
+#include "gl/virtual_texture.h"
+
+#include "gl/gl_debug.h"
+#include "gl/gl_ext.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE VIRTUAL_TEXTURE_PAGE
+#define BORDER VIRTUAL_TEXTURE_BORDER
+#define CONTENT VIRTUAL_TEXTURE_CONTENT
+
+// Value noise: a hash per lattice point of each octave, smoothly interpolated, with 64-bit lattice coordinates so
+// the deepest levels' octaves don't wrap
+static float lattice(int64_t x, int64_t y, int octave)
+{
+    uint64_t h = (uint64_t)x * 0xD6E8FEB86659FD93ull ^ (uint64_t)y * 0x9E3779B97F4A7C15ull ^ (uint64_t)octave << 56;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 32;
+    return (float)(h >> 40) / 16777216.f;
+}
+
+static float value_noise(double x, double y, int octave)
+{
+    const double fx = floor(x), fy = floor(y);
+    const int64_t ix = (int64_t)fx, iy = (int64_t)fy;
+    const float tx = (float)(x - fx), ty = (float)(y - fy);
+    const float sx = tx * tx * (3.f - 2.f * tx), sy = ty * ty * (3.f - 2.f * ty);
+    const float a = lattice(ix, iy, octave), b = lattice(ix + 1, iy, octave);
+    const float c = lattice(ix, iy + 1, octave), d = lattice(ix + 1, iy + 1, octave);
+    return (a + (b - a) * sx) + ((c + (d - c) * sx) - (a + (b - a) * sx)) * sy - 0.5f;
+}
+
+// Page "key" into "out" (RGBA8, PAGE squared, bottom row first), border included. Octave k has 2^k cells across
+// the texture; a page gets the seven octaves from a cell a page to a cell about two texels, over the page's own
+// share of the coarser ones (sampled once at its middle, they hardly change across it), so any level costs the
+// same. The result is ground detail about mid grey, for the shading to multiply in.
+static void decode_page(uint64_t key, unsigned char* out)
+{
+    int level;
+    uint32_t px, py;
+    tile_map_key_tile(key, &level, &px, &py);
+    const double page = 1.0 / (double)(1u << level), texel = page / CONTENT;
+    const double x0 = px * page - BORDER * texel, y0 = py * page - BORDER * texel;
+    float coarse = 0.f, tint = 0.f;
+    for (int k = 0; k < level; ++k)
+    {
+        const double cells = (double)(1ull << k);
+        const float n = value_noise((px + 0.5) * page * cells, (py + 0.5) * page * cells, k);
+        coarse += n * exp2f(-0.35f * (float)(level - k));
+        tint += k < 4 ? n : 0.f;
+    }
+    for (int y = 0; y < PAGE; ++y)
+        for (int x = 0; x < PAGE; ++x)
+        {
+            const double u = x0 + (x + 0.5) * texel, v = y0 + (y + 0.5) * texel;
+            float detail = coarse;
+            for (int k = level; k < level + 7; ++k)
+            {
+                const double cells = (double)(1ull << k);
+                detail += value_noise(u * cells, v * cells, k) * exp2f(-0.35f * (float)(k - level));
+            }
+            const float grey = 0.5f + 0.35f * fminf(fmaxf(detail, -1.f), 1.f);
+            const float rgb[3] = { grey * (1.f + 0.3f * tint), grey, grey * (1.f - 0.3f * tint) };
+            unsigned char* p = out + 4 * ((size_t)y * PAGE + x);
+            for (int c = 0; c < 3; ++c)
+                p[c] = (unsigned char)fminf(fmaxf(rgb[c] * 255.f, 0.f), 255.f);
+            p[3] = 255;
+        }
+}
+
+// Takes queued loads and decodes them into staging, until told to stop
+static void decode_thread(VirtualTexture* vt)
+{
+    for (;;)
+    {
+        TileRequest request;
+        int staging;
+        {
+            std::unique_lock<std::mutex> lock(vt->mutex);
+            vt->wake.wait(lock, [vt] { return vt->stop || vt->queue_count > 0; });
+            if (vt->stop)
+                break;
+            request = vt->queue[vt->queue_head];
+            vt->queue_head = (vt->queue_head + 1) % vt->map.max_loading;
+            --vt->queue_count;
+            staging = vt->free_staging[--vt->free_staging_count];
+        }
+        decode_page(request.key, vt->staging + vt->page_bytes * staging);
+        std::lock_guard<std::mutex> lock(vt->mutex);
+        vt->decoded[vt->decoded_count] = request.slot;
+        vt->decoded_staging[vt->decoded_count++] = staging;
+    }
+}
+
+// A sparse cache when the driver has a page size a layer divides into, with room for "layers"
+static bool init_sparse_cache(VirtualTexture* vt, GLsizei layers)
+{
+    GLint max_layers = 0, sizes = 0;
+    glGetIntegerv(GL_MAX_SPARSE_ARRAY_TEXTURE_LAYERS_ARB, &max_layers);
+    glGetInternalformativ(GL_TEXTURE_2D_ARRAY, GL_RGBA8, GL_NUM_VIRTUAL_PAGE_SIZES_ARB, 1, &sizes);
+    if (layers > max_layers || sizes < 1)
+        return false;
+    GLint xs[8] = {}, ys[8] = {}, zs[8] = {};
+    sizes = sizes < 8 ? sizes : 8;
+    glGetInternalformativ(GL_TEXTURE_2D_ARRAY, GL_RGBA8, GL_VIRTUAL_PAGE_SIZE_X_ARB, sizes, xs);
+    glGetInternalformativ(GL_TEXTURE_2D_ARRAY, GL_RGBA8, GL_VIRTUAL_PAGE_SIZE_Y_ARB, sizes, ys);
+    glGetInternalformativ(GL_TEXTURE_2D_ARRAY, GL_RGBA8, GL_VIRTUAL_PAGE_SIZE_Z_ARB, sizes, zs);
+    int index = -1;
+    for (int i = 0; i < sizes && index < 0; ++i)
+        index = xs[i] > 0 && ys[i] > 0 && PAGE % xs[i] == 0 && PAGE % ys[i] == 0 && zs[i] == 1 ? i : -1;
+    if (index < 0)
+        return false;
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SPARSE_ARB, GL_TRUE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_VIRTUAL_PAGE_SIZE_INDEX_ARB, index);
+    gl_ext.TexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, PAGE, PAGE, layers);
+    vt->committed = (uint8_t*)calloc((size_t)layers, 1);
+    return glGetError() == GL_NO_ERROR && vt->committed;
+}
+
+bool virtual_texture_init(VirtualTexture* vt, int levels, uint64_t budget, int thread_count, int uploads_per_frame,
+    GpuReadback* readback)
+{
+    vt->levels = levels < 1 ? 1 : levels > VIRTUAL_TEXTURE_MAX_LEVELS ? VIRTUAL_TEXTURE_MAX_LEVELS : levels;
+    vt->cache = vt->pages = 0;
+    vt->sparse = false;
+    vt->committed = NULL;
+    vt->committed_count = 0;
+    vt->uploads_per_frame = uploads_per_frame < 1 ? 1 : uploads_per_frame > 64 ? 64 : uploads_per_frame;
+    vt->feedback_framebuffer = 0;
+    vt->feedback_renderbuffers[0] = vt->feedback_renderbuffers[1] = 0;
+    vt->feedback_width = vt->feedback_height = 0;
+    vt->feedback = NULL;
+    vt->feedback_keys = NULL;
+    vt->feedback_capacity = vt->feedback_count = 0;
+    vt->feedback_in_flight = false;
+    vt->readback = readback;
+    vt->thread_count = 0;
+    vt->stop = false;
+    vt->queue = NULL;
+    vt->decoded = vt->decoded_staging = vt->free_staging = NULL;
+    vt->staging = NULL;
+    vt->queue_head = vt->queue_count = vt->decoded_count = vt->free_staging_count = 0;
+    vt->page_bytes = (size_t)PAGE * PAGE * 4;
+    vt->feedback_passes = vt->feedback_pages = vt->feedback_fallback = 0;
+    vt->pages_decoded = vt->pages_cancelled = vt->bytes_uploaded = 0;
+    memset(&vt->map, 0, sizeof(vt->map));
+    memset(&vt->uploads, 0, sizeof(vt->uploads));
+
+    GLint max_layers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    const uint64_t slots = budget / vt->page_bytes < (uint64_t)max_layers ? budget / vt->page_bytes
+        : (uint64_t)max_layers;
+    if (thread_count <= 0)
+        thread_count = (int)std::thread::hardware_concurrency() / 2;
+    thread_count = thread_count < 1 ? 1 : thread_count > VIRTUAL_TEXTURE_MAX_THREADS ? VIRTUAL_TEXTURE_MAX_THREADS
+        : thread_count;
+    const int max_loading = 2 * thread_count + vt->uploads_per_frame;
+    if (slots < 4u * TILE_MAP_PINNED_TILES || !tile_map_init(&vt->map, (int)slots, vt->levels, PAGE, max_loading, 0.0))
+    {
+        fprintf(stderr, "virtual texture: %.0f MB holds %llu pages of %d x %d (up to %d layers), too few for a frame\n",
+            budget / 1048576.0, (unsigned long long)slots, PAGE, PAGE, max_layers);
+        return false;
+    }
+
+    glGenTextures(1, &vt->cache);
+    gl_state_bind_texture(VIRTUAL_TEXTURE_CACHE_UNIT, GL_TEXTURE_2D_ARRAY, vt->cache);
+    vt->sparse = gl_ext.ARB_sparse_texture && init_sparse_cache(vt, (GLsizei)slots);
+    if (!vt->sparse)
+    {
+        // A texture whose sparse storage failed can't be given storage again
+        free(vt->committed);
+        vt->committed = NULL;
+        gl_state_delete_textures(1, &vt->cache);
+        glGenTextures(1, &vt->cache);
+        gl_state_bind_texture(VIRTUAL_TEXTURE_CACHE_UNIT, GL_TEXTURE_2D_ARRAY, vt->cache);
+        if (gl_ext.TexStorage3D)
+            gl_ext.TexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, PAGE, PAGE, (GLsizei)slots);
+        else
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, PAGE, PAGE, (GLsizei)slots, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                NULL);
+        gl_memory_texture(vt->cache, GPU_MEMORY_TEXTURES, GL_RGBA8, PAGE, PAGE, (GLsizei)slots, 1, 1);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl_debug_label(GL_TEXTURE, vt->cache, "virtual texture pages");
+
+    // The indirection, every entry 0: nothing resident
+    const int top = vt->levels - 1;
+    glGenTextures(1, &vt->pages);
+    gl_state_bind_texture(VIRTUAL_TEXTURE_PAGES_UNIT, GL_TEXTURE_2D, vt->pages);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    uint16_t* zeros = (uint16_t*)calloc((size_t)1 << (2 * top), sizeof(uint16_t));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    for (int m = 0; m <= top; ++m)
+        glTexImage2D(GL_TEXTURE_2D, m, GL_R16UI, 1 << (top - m), 1 << (top - m), 0, GL_RED_INTEGER,
+            GL_UNSIGNED_SHORT, zeros);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    free(zeros);
+    gl_memory_texture(vt->pages, GPU_MEMORY_TEXTURES, GL_R16UI, 1 << top, 1 << top, 1, vt->levels, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, top);
+    gl_debug_label(GL_TEXTURE, vt->pages, "virtual texture indirection");
+
+    stream_buffer_init(&vt->uploads, GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)vt->page_bytes * vt->uploads_per_frame);
+    gl_debug_label(GL_BUFFER, vt->uploads.buffer, "virtual texture uploads");
+    glGenFramebuffers(1, &vt->feedback_framebuffer);
+    glGenRenderbuffers(2, vt->feedback_renderbuffers);
+
+    vt->queue = (TileRequest*)malloc(sizeof(TileRequest) * max_loading);
+    vt->decoded = (int*)malloc(sizeof(int) * max_loading);
+    vt->decoded_staging = (int*)malloc(sizeof(int) * max_loading);
+    vt->free_staging = (int*)malloc(sizeof(int) * max_loading);
+    vt->staging = (unsigned char*)malloc(vt->page_bytes * max_loading);
+    for (int s = 0; s < max_loading; ++s)
+        vt->free_staging[vt->free_staging_count++] = s;
+    for (int t = 0; t < thread_count; ++t)
+        vt->threads[vt->thread_count++] = std::thread(decode_thread, vt);
+    return true;
+}
+
+void virtual_texture_destroy(VirtualTexture* vt)
+{
+    {
+        std::lock_guard<std::mutex> lock(vt->mutex);
+        vt->stop = true;
+    }
+    vt->wake.notify_all();
+    for (int t = 0; t < vt->thread_count; ++t)
+        vt->threads[t].join();
+    vt->thread_count = 0;
+    if (vt->uploads.buffer)
+        stream_buffer_destroy(&vt->uploads);
+    gl_state_delete_framebuffers(1, &vt->feedback_framebuffer);
+    gl_memory_delete_renderbuffers(2, vt->feedback_renderbuffers);
+    gl_state_delete_textures(1, &vt->cache);
+    gl_state_delete_textures(1, &vt->pages);
+    vt->feedback_framebuffer = vt->cache = vt->pages = 0;
+    vt->feedback_renderbuffers[0] = vt->feedback_renderbuffers[1] = 0;
+    free(vt->committed);
+    free(vt->feedback);
+    free(vt->feedback_keys);
+    free(vt->queue);
+    free(vt->decoded);
+    free(vt->decoded_staging);
+    free(vt->free_staging);
+    free(vt->staging);
+    vt->committed = NULL;
+    vt->feedback = NULL;
+    vt->feedback_keys = NULL;
+    vt->queue = NULL;
+    vt->decoded = vt->decoded_staging = vt->free_staging = NULL;
+    vt->staging = NULL;
+    tile_map_destroy(&vt->map);
+}
+
+void virtual_texture_program(const VirtualTexture* vt, GLuint program, bool feedback)
+{
+    gl_state_use_program(program);
+    glUniform1i(glGetUniformLocation(program, "virtualCache"), VIRTUAL_TEXTURE_CACHE_UNIT);
+    glUniform1i(glGetUniformLocation(program, "virtualPages"), VIRTUAL_TEXTURE_PAGES_UNIT);
+    glUniform4f(glGetUniformLocation(program, "virtualTexture"), (float)vt->levels, (float)CONTENT, (float)PAGE,
+        feedback ? -log2f((float)VIRTUAL_TEXTURE_FEEDBACK_SCALE) : 0.f);
+}
+
+void virtual_texture_bind(const VirtualTexture* vt)
+{
+    gl_state_bind_texture(VIRTUAL_TEXTURE_CACHE_UNIT, GL_TEXTURE_2D_ARRAY, vt->cache);
+    gl_state_bind_texture(VIRTUAL_TEXTURE_PAGES_UNIT, GL_TEXTURE_2D, vt->pages);
+}
+
+// Page "key"'s indirection texel: "entry" is its cache layer plus one, or 0
+static void set_entry(VirtualTexture* vt, uint64_t key, uint16_t entry)
+{
+    int level;
+    uint32_t x, y;
+    tile_map_key_tile(key, &level, &x, &y);
+    glTexSubImage2D(GL_TEXTURE_2D, vt->levels - 1 - level, (GLint)x, (GLint)y, 1, 1, GL_RED_INTEGER,
+        GL_UNSIGNED_SHORT, &entry);
+}
+
+// Up to uploads_per_frame decoded pages through the upload stream into their layers, then into the indirection
+static void upload_decoded(VirtualTexture* vt)
+{
+    int slots[64], staging[64];
+    int count;
+    {
+        std::lock_guard<std::mutex> lock(vt->mutex);
+        count = vt->decoded_count < vt->uploads_per_frame ? vt->decoded_count : vt->uploads_per_frame;
+        memcpy(slots, vt->decoded, sizeof(int) * count);
+        memcpy(staging, vt->decoded_staging, sizeof(int) * count);
+        vt->decoded_count -= count;
+        memmove(vt->decoded, vt->decoded + count, sizeof(int) * vt->decoded_count);
+        memmove(vt->decoded_staging, vt->decoded_staging + count, sizeof(int) * vt->decoded_count);
+    }
+    if (!count)
+        return;
+    GLintptr offsets[64];
+    stream_buffer_begin_frame(&vt->uploads);
+    for (int i = 0; i < count; ++i)
+    {
+        void* p = stream_buffer_alloc(&vt->uploads, (GLsizeiptr)vt->page_bytes, 256, &offsets[i]);
+        memcpy(p, vt->staging + vt->page_bytes * staging[i], vt->page_bytes);
+    }
+    stream_buffer_commit(&vt->uploads);
+    {
+        std::lock_guard<std::mutex> lock(vt->mutex);
+        for (int i = 0; i < count; ++i)
+            vt->free_staging[vt->free_staging_count++] = staging[i];
+    }
+    gl_state_bind_texture(VIRTUAL_TEXTURE_CACHE_UNIT, GL_TEXTURE_2D_ARRAY, vt->cache);
+    for (int i = 0; i < count; ++i)
+    {
+        if (vt->sparse && !vt->committed[slots[i]])
+        {
+            gl_ext.TexPageCommitmentARB(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slots[i], PAGE, PAGE, 1, GL_TRUE);
+            vt->committed[slots[i]] = 1;
+            ++vt->committed_count;
+            gl_memory_texture_bytes(vt->cache, GPU_MEMORY_TEXTURES, (uint64_t)vt->page_bytes * vt->committed_count);
+        }
+    }
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, vt->uploads.buffer);
+    for (int i = 0; i < count; ++i)
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slots[i], PAGE, PAGE, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+            (const void*)offsets[i]);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    gl_state_bind_texture(VIRTUAL_TEXTURE_PAGES_UNIT, GL_TEXTURE_2D, vt->pages);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    for (int i = 0; i < count; ++i)
+    {
+        set_entry(vt, vt->map.slots[slots[i]].key, (uint16_t)(slots[i] + 1));
+        tile_map_loaded(&vt->map, slots[i]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    stream_buffer_end_frame(&vt->uploads);
+    vt->bytes_uploaded += (uint64_t)vt->page_bytes * count;
+    vt->pages_decoded += (uint64_t)count;
+}
+
+// The feedback's ids as pages, their loads handed out: queued loads no pixel asks for any more are dropped before
+// they start, the slots the new ones evict leave the indirection, and the new ones go on the queue
+static void request_pages(VirtualTexture* vt)
+{
+    int key_count = 0;
+    for (size_t i = 0; i < vt->feedback_count; ++i)
+    {
+        const uint32_t id = vt->feedback[i];
+        if (id != VIRTUAL_TEXTURE_NO_PAGE)
+            vt->feedback_keys[key_count++] = tile_map_key((int)(id >> 28), id & 0x3FFFu, (id >> 14) & 0x3FFFu);
+    }
+    vt->feedback_count = 0;
+    const int request_count = tile_map_feedback(&vt->map, vt->feedback_keys, key_count, vt->requests,
+        VIRTUAL_TEXTURE_MAX_REQUESTS);
+    vt->feedback_pages += vt->map.stats.visible;
+    vt->feedback_fallback += vt->map.stats.fallback;
+
+    gl_state_bind_texture(VIRTUAL_TEXTURE_PAGES_UNIT, GL_TEXTURE_2D, vt->pages);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    for (int i = 0; i < request_count; ++i)
+    {
+        if (vt->requests[i].evicted != TILE_MAP_NO_KEY)
+            set_entry(vt, vt->requests[i].evicted, 0);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    {
+        std::lock_guard<std::mutex> lock(vt->mutex);
+        const int capacity = vt->map.max_loading;
+        int kept = 0;
+        for (int i = 0; i < vt->queue_count; ++i)
+        {
+            const TileRequest* q = &vt->queue[(vt->queue_head + i) % capacity];
+            if (tile_map_wanted(&vt->map, q->slot) || vt->map.slots[q->slot].pinned)
+                vt->queue[(vt->queue_head + kept++) % capacity] = *q;
+            else
+            {
+                tile_map_cancel(&vt->map, q->slot);
+                ++vt->pages_cancelled;
+            }
+        }
+        vt->queue_count = kept;
+        for (int i = 0; i < request_count; ++i)
+            vt->queue[(vt->queue_head + vt->queue_count++) % capacity] = vt->requests[i];
+    }
+    if (request_count)
+        vt->wake.notify_all();
+}
+
+void virtual_texture_update(VirtualTexture* vt)
+{
+    upload_decoded(vt);
+    if (vt->feedback_count || !vt->feedback_passes)
+        request_pages(vt);      // the first frame's asks for the pinned levels
+}
+
+// The pass's ids are in "feedback": turned into loads at the next update
+static void feedback_back(void* user, const void* data, size_t bytes, unsigned int frame)
+{
+    VirtualTexture* vt = (VirtualTexture*)user;
+    vt->feedback_count = bytes / sizeof(uint32_t);
+    vt->feedback_in_flight = false;
+}
+
+bool virtual_texture_begin_feedback(VirtualTexture* vt, int width, int height)
+{
+    if (vt->feedback_in_flight)
+        return false;
+    const int w = (width + VIRTUAL_TEXTURE_FEEDBACK_SCALE - 1) / VIRTUAL_TEXTURE_FEEDBACK_SCALE;
+    const int h = (height + VIRTUAL_TEXTURE_FEEDBACK_SCALE - 1) / VIRTUAL_TEXTURE_FEEDBACK_SCALE;
+    if (w < 1 || h < 1)
+        return false;
+    vt->saved_framebuffers[0] = gl_state.read_framebuffer;
+    vt->saved_framebuffers[1] = gl_state.draw_framebuffer;
+    memcpy(vt->saved_viewport, gl_state.viewport, sizeof(vt->saved_viewport));
+    vt->saved_viewport_known = gl_state.viewport_known;
+    gl_state_bind_framebuffer(GL_FRAMEBUFFER, vt->feedback_framebuffer);
+    if (w != vt->feedback_width || h != vt->feedback_height)
+    {
+        if ((size_t)w * h > vt->feedback_capacity)
+        {
+            free(vt->feedback);
+            free(vt->feedback_keys);
+            vt->feedback_capacity = (size_t)w * h;
+            vt->feedback = (uint32_t*)malloc(sizeof(uint32_t) * vt->feedback_capacity);
+            vt->feedback_keys = (uint64_t*)malloc(sizeof(uint64_t) * vt->feedback_capacity);
+            if (!vt->feedback || !vt->feedback_keys)
+            {
+                vt->feedback_capacity = 0;
+                vt->feedback_width = vt->feedback_height = 0;
+                virtual_texture_end_feedback(vt);
+                return false;
+            }
+        }
+        const GLenum formats[2] = { GL_R32UI, GL_DEPTH_COMPONENT24 };
+        const GLenum attachments[2] = { GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT };
+        for (int i = 0; i < 2; ++i)
+        {
+            glBindRenderbuffer(GL_RENDERBUFFER, vt->feedback_renderbuffers[i]);
+            glRenderbufferStorage(GL_RENDERBUFFER, formats[i], w, h);
+            gl_memory_renderbuffer(vt->feedback_renderbuffers[i], formats[i], w, h, 1);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachments[i], GL_RENDERBUFFER, vt->feedback_renderbuffers[i]);
+        }
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        gl_debug_label(GL_FRAMEBUFFER, vt->feedback_framebuffer, "virtual texture feedback");
+        vt->feedback_width = w;
+        vt->feedback_height = h;
+    }
+    gl_state_viewport(0, 0, w, h);
+    const GLuint none[4] = { VIRTUAL_TEXTURE_NO_PAGE, 0, 0, 0 };
+    const GLfloat far_depth = gl_state.depth_func == GL_GREATER || gl_state.depth_func == GL_GEQUAL ? 0.f : 1.f;
+    glClearBufferuiv(GL_COLOR, 0, none);
+    glClearBufferfv(GL_DEPTH, 0, &far_depth);
+    return true;
+}
+
+void virtual_texture_end_feedback(VirtualTexture* vt)
+{
+    if (vt->feedback_capacity)
+    {
+        const size_t bytes = sizeof(uint32_t) * vt->feedback_width * vt->feedback_height;
+        vt->feedback_in_flight = gpu_readback_pixels(vt->readback, vt->feedback_framebuffer, GL_COLOR_ATTACHMENT0, 0,
+            0, vt->feedback_width, vt->feedback_height, GL_RED_INTEGER, GL_UNSIGNED_INT, bytes, vt->feedback,
+            feedback_back, vt);
+        vt->feedback_passes += vt->feedback_in_flight;
+    }
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, vt->saved_framebuffers[0]);
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, vt->saved_framebuffers[1]);
+    if (vt->saved_viewport_known)
+        gl_state_viewport(vt->saved_viewport[0], vt->saved_viewport[1], vt->saved_viewport[2], vt->saved_viewport[3]);
+}
+
+void virtual_texture_print(const VirtualTexture* vt, FILE* out)
+{
+    int resident = 0;
+    for (int s = 0; s < vt->map.slot_count; ++s)
+        resident += vt->map.slots[s].state == TILE_SLOT_RESIDENT;
+    fprintf(out, "virtual texture: %d levels, %d of %d pages resident (%s); %llu feedback passes asked for %.1f pages "
+        "each, %.1f%% of them drawn from an ancestor; %llu pages decoded (%.1f MB uploaded), %llu cancelled, "
+        "%llu evicted\n", vt->levels, resident, vt->map.slot_count,
+        vt->sparse ? "sparse, only those committed" : "all allocated", (unsigned long long)vt->feedback_passes,
+        vt->feedback_passes ? (double)vt->feedback_pages / vt->feedback_passes : 0.0,
+        vt->feedback_pages ? 100.0 * vt->feedback_fallback / vt->feedback_pages : 0.0,
+        (unsigned long long)vt->pages_decoded, vt->bytes_uploaded / 1048576.0, (unsigned long long)vt->pages_cancelled,
+        (unsigned long long)vt->map.total_evicted);
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/tile_map.h"
+#include "gl/gpu_readback.h"
+#include "gl/stream_buffer.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <stdint.h>
+#include <stdio.h>
+
+// A texture far bigger than video memory, with only the pages the frame
+// samples on the GPU. Level L of it is 2^L x 2^L pages of
+// VIRTUAL_TEXTURE_CONTENT texels, so 14 levels are 1 M texels across at the
+// bottom; nothing about the levels is allocated but an indirection entry a
+// page.
+//
+// Residency follows what is visible, not a guess at it:
+//  1. a feedback pass draws the textured geometry again into an R32UI target
+//     1 / VIRTUAL_TEXTURE_FEEDBACK_SCALE of the frame across, each pixel the
+//     id of the page the real pass samples there (the level from the
+//     texture coordinates' derivatives, corrected for the smaller target);
+//  2. the ids come back through a GpuReadback (gl/gpu_readback.h) a few
+//     frames later without a stall, and the next pass is only drawn once
+//     they have, so there is one in flight;
+//  3. tile_map_feedback (core/tile_map.h) turns them into loads, coarsest
+//     first, evicting the pages no pixel asked for longest; decode threads
+//     make the pages, and up to "uploads_per_frame" a frame go through a
+//     stream buffer bound as GL_PIXEL_UNPACK_BUFFER into their cache layers.
+//
+// The cache is a GL_TEXTURE_2D_ARRAY of VIRTUAL_TEXTURE_PAGE-texel layers, a
+// page each, with a VIRTUAL_TEXTURE_BORDER of the neighbours' texels round
+// it so bilinear filtering doesn't seam. The indirection texture has a mip
+// level per page level, one R16UI texel a page: its cache layer plus one, 0
+// while it isn't resident. A lookup (VIRTUAL_TEXTURE_GLSL) reads the level
+// it wants and climbs to the nearest ancestor that is in, so a page being
+// loaded shows its parent's texels, blurrier, and a page that lands or is
+// evicted changes one texel.
+//
+// Where GL_ARB_sparse_texture is there the cache is sparse: a layer is
+// committed when its first page lands, so the budget caps the memory rather
+// than being taken up front.
+//
+// The pages are made up rather than read, ground detail from value noise at
+// the page's place and scale, so a page anywhere costs the same. Belongs to
+// the thread whose context renders; the decode threads never call GL.
+
+#define VIRTUAL_TEXTURE_PAGE 128            // texels a side of a cache layer
+#define VIRTUAL_TEXTURE_BORDER 1            // of those, round the page's own
+#define VIRTUAL_TEXTURE_CONTENT (VIRTUAL_TEXTURE_PAGE - 2 * VIRTUAL_TEXTURE_BORDER)
+#define VIRTUAL_TEXTURE_MAX_LEVELS 14       // a page id's x and y take 14 bits each
+#define VIRTUAL_TEXTURE_FEEDBACK_SCALE 8    // frame pixels a feedback pixel, across
+#define VIRTUAL_TEXTURE_MAX_THREADS 4
+#define VIRTUAL_TEXTURE_MAX_REQUESTS 64     // loads a feedback
+#define VIRTUAL_TEXTURE_CACHE_UNIT 5        // the cache's texture unit: between the materials' and the heights'
+#define VIRTUAL_TEXTURE_PAGES_UNIT 8        // the indirection's, past the shadow maps
+#define VIRTUAL_TEXTURE_NO_PAGE 0xFFFFFFFFu // a feedback pixel nothing textured covers
+
+// Page lookups for a shader whose coordinates "uv" span the texture over [0, 1]. virtualTexture is levels, the
+// content and layer texels a page, and the log2 bias of the pixels (0, or minus log2 of the feedback scale).
+// virtualSample is the texel, mid grey before anything is in; virtualPage is the id the feedback pass writes:
+// the level in the top 4 bits, then y and x in 14 each.
+#define VIRTUAL_TEXTURE_GLSL \
+"uniform sampler2DArray virtualCache;\n" \
+"uniform usampler2D virtualPages;\n" \
+"uniform vec4 virtualTexture;\n" \
+"int virtualLevel(vec2 uv)\n" \
+"{\n" \
+"    vec2 texels = uv * virtualTexture.y * exp2(virtualTexture.x - 1.0);\n" \
+"    vec2 dx = dFdx(texels), dy = dFdy(texels);\n" \
+"    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + virtualTexture.w;\n" \
+"    return int(clamp(floor(virtualTexture.x - 0.5 - lod), 0.0, virtualTexture.x - 1.0));\n" \
+"}\n" \
+"vec4 virtualSample(vec2 uv)\n" \
+"{\n" \
+"    uv = clamp(uv, 0.0, 0.999999);\n" \
+"    int top = int(virtualTexture.x) - 1;\n" \
+"    for (int level = virtualLevel(uv); level >= 0; --level)\n" \
+"    {\n" \
+"        vec2 page = uv * float(1 << level);\n" \
+"        uint slot = texelFetch(virtualPages, ivec2(page), top - level).r;\n" \
+"        if (slot != 0u)\n" \
+"        {\n" \
+"            vec2 texel = (virtualTexture.z - virtualTexture.y) * 0.5 + fract(page) * virtualTexture.y;\n" \
+"            return textureLod(virtualCache, vec3(texel / virtualTexture.z, float(slot - 1u)), 0.0);\n" \
+"        }\n" \
+"    }\n" \
+"    return vec4(0.5);\n" \
+"}\n" \
+"uint virtualPage(vec2 uv)\n" \
+"{\n" \
+"    uv = clamp(uv, 0.0, 0.999999);\n" \
+"    int level = virtualLevel(uv);\n" \
+"    uvec2 page = uvec2(uv * float(1 << level));\n" \
+"    return uint(level) << 28 | page.y << 14 | page.x;\n" \
+"}\n"
+
+typedef struct VirtualTexture
+{
+    TileMap map;                    // its tiles are the pages, its slots the cache layers
+    int levels;
+    GLuint cache;                   // GL_TEXTURE_2D_ARRAY, a layer per slot
+    GLuint pages;                   // the indirection: R16UI, a mip level per page level, the finest first
+    bool sparse;                    // the cache's layers committed as they're first used
+    uint8_t* committed;             // [slot_count], sparse
+    int committed_count;
+    StreamBuffer uploads;           // GL_PIXEL_UNPACK_BUFFER: a frame's decoded pages
+    int uploads_per_frame;
+    TileRequest requests[VIRTUAL_TEXTURE_MAX_REQUESTS];
+
+    GLuint feedback_framebuffer;
+    GLuint feedback_renderbuffers[2];   // R32UI ids, depth
+    int feedback_width, feedback_height;
+    uint32_t* feedback;             // the last pass's ids, as they came back
+    uint64_t* feedback_keys;        // scratch: the ids as tile keys
+    size_t feedback_capacity;       // pixels the two have room for
+    size_t feedback_count;          // ids in "feedback" to turn into loads; 0 once they have been
+    bool feedback_in_flight;        // a pass's readback not back yet
+    GpuReadback* readback;          // borrowed
+    GLuint saved_framebuffers[2];   // read and draw, bound again after the pass
+    GLint saved_viewport[4];
+    bool saved_viewport_known;
+
+    std::thread threads[VIRTUAL_TEXTURE_MAX_THREADS];
+    int thread_count;
+    std::mutex mutex;
+    std::condition_variable wake;   // a page was queued, or stop
+    bool stop;
+    TileRequest* queue;             // FIFO of loads not started, [map.max_loading], guarded by mutex
+    int queue_head, queue_count;
+    int* decoded;                   // slots decoded and not uploaded yet, with their staging, guarded by mutex
+    int* decoded_staging;
+    int decoded_count;
+    int* free_staging;              // guarded by mutex
+    int free_staging_count;
+    unsigned char* staging;         // a page of texels per load in flight
+    size_t page_bytes;
+
+    // Totals over the run
+    uint64_t feedback_passes;
+    uint64_t feedback_pages;        // distinct pages the passes asked for, summed
+    uint64_t feedback_fallback;     // of those, not resident when asked for
+    uint64_t pages_decoded;
+    uint64_t pages_cancelled;
+    uint64_t bytes_uploaded;
+} VirtualTexture;
+
+// Needs a current context. A texture of "levels" page levels (up to VIRTUAL_TEXTURE_MAX_LEVELS) cached in
+// "budget" bytes of pages, made by "thread_count" threads (0 for half the hardware's) and uploaded
+// "uploads_per_frame" a frame; the feedback goes through "readback". Logs and returns false when the budget
+// can't hold a frame's pages.
+bool virtual_texture_init(VirtualTexture* vt, int levels, uint64_t budget, int thread_count, int uploads_per_frame,
+    GpuReadback* readback);
+
+// Stops and joins the decode threads, then deletes the GL objects. Any feedback still in flight must have come
+// back or been dropped first (gpu_readback_finish or _destroy).
+void virtual_texture_destroy(VirtualTexture* vt);
+
+// Points "program"'s samplers at the units virtual_texture_bind uses and sets its virtualTexture; "feedback" for
+// a feedback pass's, biased for the smaller target. Leaves "program" in use.
+void virtual_texture_program(const VirtualTexture* vt, GLuint program, bool feedback);
+
+// Once a frame before sampling: lands decoded pages and turns feedback that came back into loads
+void virtual_texture_update(VirtualTexture* vt);
+
+// Binds the cache and the indirection to their units
+void virtual_texture_bind(const VirtualTexture* vt);
+
+// Whether a feedback pass is due, none being in flight. If so binds the feedback target for a frame "width" x
+// "height" and clears it to VIRTUAL_TEXTURE_NO_PAGE and the far depth (0 under a GL_GREATER depth test): draw
+// the textured geometry with a program writing virtualPage to an unsigned output, with depth testing, then call
+// virtual_texture_end_feedback.
+bool virtual_texture_begin_feedback(VirtualTexture* vt, int width, int height);
+
+// Queues the pass's readback and binds the framebuffers and viewport that were bound before it again
+void virtual_texture_end_feedback(VirtualTexture* vt);
+
+// One line: what's resident and committed, what the feedback asked for and what was loaded
+void virtual_texture_print(const VirtualTexture* vt, FILE* out);
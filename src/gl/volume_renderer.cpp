@@ -0,0 +1,601 @@
+#include "gl/volume_renderer.h"
+
+#include "gl/draw_counters.h"
+#include "gl/gl_debug.h"
+#include "gl/gl_dsa.h"
+#include "gl/gl_memory.h"
+#include "gl/gl_state.h"
+#include "gl/shader.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VOLUME_RENDERER_GROUP_SIZE 8    // local_size_x/y in the compute shaders
+#define VOLUME_RENDERER_MAX_ITERATIONS 4096     // per ray, whatever the field: a bound on a pass's time
+
+// The ray through marched pixel p's centre, from the near plane: its unit direction, and its length to the far
+// plane in w
+#define RAY_GLSL \
+"uniform mat4 inverseViewProjection;\n" \
+"uniform vec2 clipDepth;\n" \
+"uniform ivec2 sceneSize;\n" \
+"vec2 pixelNdc(ivec2 p)\n" \
+"{\n" \
+"    return (vec2(p) + 0.5) * float(SCALE) / vec2(sceneSize) * 2.0 - 1.0;\n" \
+"}\n" \
+"vec4 pixelRay(ivec2 p, out vec3 origin)\n" \
+"{\n" \
+"    vec4 n = inverseViewProjection * vec4(pixelNdc(p), clipDepth.x, 1.0);\n" \
+"    vec4 f = inverseViewProjection * vec4(pixelNdc(p), clipDepth.y, 1.0);\n" \
+"    origin = n.xyz / n.w;\n" \
+"    vec3 d = f.xyz / f.w - origin;\n" \
+"    return vec4(normalize(d), length(d));\n" \
+"}\n"
+
+// volume_march on the GPU, level 0 cells holding their brick's atlas slot + 1. Samples are jittered along the ray
+// by interleaved gradient noise, moved on by the golden ratio every frame.
+static const char* march_shader_text =
+"layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;\n"
+"layout(std430, binding = 0) readonly buffer Cells { uint cells[]; };\n"
+"layout(binding = 0) uniform sampler3D atlas;\n"
+"layout(binding = 1) uniform sampler2D sceneDepth;\n"
+"layout(rgba16f, binding = 0) uniform writeonly image2D color;\n"
+"layout(r32f, binding = 1) uniform writeonly image2D hitDistance;\n"
+"uniform ivec4 levelSize[MAX_LEVELS];   // cells along x, y and z, and the level's first in cells\n"
+"uniform int levels;\n"
+"uniform ivec3 fieldSize;\n"
+"uniform ivec3 atlasSlots;\n"
+"uniform float threshold;\n"
+"uniform vec4 march;     // step, detail distance, min transmittance, the frame's jitter\n"
+"uniform int depthMode;  // 0: no depth, 1: [-1, 1] clip depth, 2: [0, 1]\n"
+"float marchIndex(float t)\n"
+"{\n"
+"    float d = march.y;\n"
+"    return (t < d ? t : d + d * log(t / d)) / march.x;\n"
+"}\n"
+"float marchDistance(float index)\n"
+"{\n"
+"    float d = march.y, s = index * march.x;\n"
+"    return s < d ? s : d * exp((s - d) / d);\n"
+"}\n"
+"vec3 transferColor(float a)\n"
+"{\n"
+"    const vec3 low = vec3(0.05, 0.1, 0.4), mid = vec3(1.0, 0.45, 0.1), high = vec3(1.0, 0.95, 0.85);\n"
+"    return a < 0.5 ? mix(low, mid, 2.0 * a) : mix(mid, high, 2.0 * a - 1.0);\n"
+"}\n"
+"uint cell(int level, ivec3 c)\n"
+"{\n"
+"    ivec4 n = levelSize[level];\n"
+"    return cells[n.w + (c.z * n.y + c.y) * n.x + c.x];\n"
+"}\n"
+"// Trilinear at q (voxels) from the brick's slot, its apron covering the brick's faces\n"
+"float sampleBrick(uint slot, ivec3 brick, vec3 q)\n"
+"{\n"
+"    uint s = slot - 1u, sx = uint(atlasSlots.x), sy = uint(atlasSlots.y);\n"
+"    vec3 a = vec3(uvec3(s % sx, s / sx % sy, s / (sx * sy)));\n"
+"    vec3 texel = a * float(STORED) + float(APRON) + q - vec3(brick * BRICK);\n"
+"    return texture(atlas, texel / vec3(textureSize(atlas, 0))).r * 255.0;\n"
+"}\n"
+"void main()\n"
+"{\n"
+"    ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"    if (any(greaterThanEqual(p, imageSize(color))))\n"
+"        return;\n"
+"    vec3 origin;\n"
+"    vec4 ray = pixelRay(p, origin);\n"
+"    float tMax = ray.w;\n"
+"    if (depthMode != 0)\n"
+"    {\n"
+"        // Out to the farthest of the scene pixels this one covers\n"
+"        bool reversed = clipDepth.x > clipDepth.y;\n"
+"        float z = reversed ? 1.0 : 0.0;\n"
+"        for (int y = 0; y < SCALE; ++y)\n"
+"            for (int x = 0; x < SCALE; ++x)\n"
+"            {\n"
+"                float d = texelFetch(sceneDepth, min(p * SCALE + ivec2(x, y), sceneSize - 1), 0).r;\n"
+"                z = reversed ? min(z, d) : max(z, d);\n"
+"            }\n"
+"        vec4 h = inverseViewProjection * vec4(pixelNdc(p), depthMode == 2 ? z : 2.0 * z - 1.0, 1.0);\n"
+"        tMax = min(tMax, dot(h.xyz / h.w - origin, ray.xyz));\n"
+"    }\n"
+"\n"
+"    // The ray in voxels, and where it's in the box\n"
+"    vec3 scale = vec3(fieldSize) * 0.5;\n"
+"    vec3 o = (origin + 1.0) * scale, d = ray.xyz * scale;\n"
+"    float voxelLength = 1.0 / max(scale.x, max(scale.y, scale.z));\n"
+"    float t0 = 0.0, t1 = tMax;\n"
+"    for (int k = 0; k < 3; ++k)\n"
+"    {\n"
+"        if (d[k] == 0.0)\n"
+"        {\n"
+"            if (o[k] < 0.0 || o[k] > float(fieldSize[k]))\n"
+"                t1 = -1.0;\n"
+"            continue;\n"
+"        }\n"
+"        float a = -o[k] / d[k], b = (float(fieldSize[k]) - o[k]) / d[k];\n"
+"        t0 = max(t0, min(a, b));\n"
+"        t1 = min(t1, max(a, b));\n"
+"    }\n"
+"\n"
+"    vec3 rgb = vec3(0.0);\n"
+"    float transmittance = 1.0, reprojectAt = max(t0, 0.0);\n"
+"    bool halfway = false;\n"
+"    if (t0 < t1)\n"
+"    {\n"
+"        float jitter = fract(52.9829189 * fract(dot(vec2(p), vec2(0.06711056, 0.00583715))) + march.w);\n"
+"        float k = ceil(marchIndex(t0) - jitter), t = marchDistance(k + jitter);\n"
+"        float range = 255.0 - threshold;\n"
+"        int level = levels - 1;\n"
+"        for (int i = 0; i < MAX_ITERATIONS && t < t1; ++i)\n"
+"        {\n"
+"            vec3 q = o + d * t;\n"
+"            float side = float(BRICK << level);\n"
+"            ivec3 c = clamp(ivec3(floor(q / side)), ivec3(0), levelSize[level].xyz - 1);\n"
+"            uint occupied = cell(level, c);\n"
+"            if (occupied == 0u)\n"
+"            {\n"
+"                // On to the first sample past the cell, and a level up\n"
+"                float exit = 3.4e38;\n"
+"                for (int a = 0; a < 3; ++a)\n"
+"                {\n"
+"                    if (d[a] != 0.0)\n"
+"                        exit = min(exit, ((float(c[a]) + (d[a] > 0.0 ? 1.0 : 0.0)) * side - o[a]) / d[a]);\n"
+"                }\n"
+"                k = max(ceil(marchIndex(exit) - jitter), k + 1.0);\n"
+"                t = marchDistance(k + jitter);\n"
+"                level = min(level + 1, levels - 1);\n"
+"                continue;\n"
+"            }\n"
+"            if (level > 0)\n"
+"            {\n"
+"                --level;\n"
+"                continue;\n"
+"            }\n"
+"            float value = sampleBrick(occupied, c, q);\n"
+"            if (value > threshold)\n"
+"            {\n"
+"                float a = min(1.0, (value - threshold) / range);\n"
+"                float dt = marchDistance(k + 1.0 + jitter) - t;\n"
+"                float alpha = 1.0 - pow(1.0 - OPACITY * a * a, dt / voxelLength);\n"
+"                rgb += transmittance * alpha * transferColor(a);\n"
+"                transmittance *= 1.0 - alpha;\n"
+"                if (!halfway && transmittance <= 0.5)\n"
+"                {\n"
+"                    reprojectAt = t;\n"
+"                    halfway = true;\n"
+"                }\n"
+"                if (transmittance < march.z)\n"
+"                    break;\n"
+"            }\n"
+"            k += 1.0;\n"
+"            t = marchDistance(k + jitter);\n"
+"        }\n"
+"    }\n"
+"    imageStore(color, p, vec4(rgb, 1.0 - transmittance));\n"
+"    imageStore(hitDistance, p, vec4(reprojectAt));\n"
+"}\n";
+
+// The new frame blended over the last one's result where its point was, the history clamped to the new pixel's
+// neighbourhood while the view moves
+static const char* resolve_shader_text =
+"layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;\n"
+"layout(binding = 0) uniform sampler2D current;\n"
+"layout(binding = 1) uniform sampler2D hitDistance;\n"
+"layout(binding = 2) uniform sampler2D history;\n"
+"layout(rgba16f, binding = 0) uniform writeonly image2D target;\n"
+"uniform mat4 reprojection;  // last frame's view-projection\n"
+"uniform vec2 blend;         // the new frame's weight; 1 to clamp the history\n"
+"void main()\n"
+"{\n"
+"    ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"    ivec2 size = imageSize(target);\n"
+"    if (any(greaterThanEqual(p, size)))\n"
+"        return;\n"
+"    vec4 c = texelFetch(current, p, 0);\n"
+"    if (blend.x >= 1.0)\n"
+"    {\n"
+"        imageStore(target, p, c);\n"
+"        return;\n"
+"    }\n"
+"    vec3 origin;\n"
+"    vec4 ray = pixelRay(p, origin);\n"
+"    vec4 last = reprojection * vec4(origin + ray.xyz * texelFetch(hitDistance, p, 0).r, 1.0);\n"
+"    vec2 uv = (last.xy / last.w * 0.5 + 0.5) * vec2(sceneSize) / (float(SCALE) * vec2(size));\n"
+"    if (last.w <= 0.0 || any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))))\n"
+"    {\n"
+"        imageStore(target, p, c);\n"
+"        return;\n"
+"    }\n"
+"    vec4 h = texture(history, uv);\n"
+"    if (blend.y > 0.0)\n"
+"    {\n"
+"        vec4 lo = c, hi = c;\n"
+"        for (int y = -1; y <= 1; ++y)\n"
+"            for (int x = -1; x <= 1; ++x)\n"
+"            {\n"
+"                vec4 n = texelFetch(current, clamp(p + ivec2(x, y), ivec2(0), size - 1), 0);\n"
+"                lo = min(lo, n);\n"
+"                hi = max(hi, n);\n"
+"            }\n"
+"        h = clamp(h, lo, hi);\n"
+"    }\n"
+"    imageStore(target, p, mix(h, c, blend.x));\n"
+"}\n";
+
+static const char* composite_vertex_shader_text =
+"void main()\n"
+"{\n"
+"    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+"    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+static const char* composite_fragment_shader_text =
+"layout(binding = 0) uniform sampler2D volume;\n"
+"uniform vec2 scale;     // scene pixels to the marched texture's coordinates\n"
+"out vec4 fragment;\n"
+"void main()\n"
+"{\n"
+"    fragment = texture(volume, gl_FragCoord.xy * scale);\n"
+"}\n";
+
+// Prefixes "body" with the version, the constants the shaders share and, for the compute passes, the ray
+static GLuint compile_stage(GLenum type, const char* body, bool ray)
+{
+    char prefix[512];
+    snprintf(prefix, sizeof(prefix), "#version 430\n#define SCALE %d\n#define GROUP_SIZE %d\n#define BRICK %d\n"
+        "#define APRON %d\n#define STORED %d\n#define MAX_LEVELS %d\n#define MAX_ITERATIONS %d\n#define OPACITY %.9g\n",
+        VOLUME_RENDERER_SCALE, VOLUME_RENDERER_GROUP_SIZE, VOLUME_BRICK, VOLUME_BRICK_APRON, VOLUME_BRICK_STORED,
+        VOLUME_MAX_LEVELS, VOLUME_RENDERER_MAX_ITERATIONS, (double)VOLUME_OPACITY);
+    const char* ray_text = ray ? RAY_GLSL : "";
+    const size_t length = strlen(prefix) + strlen(ray_text) + strlen(body) + 1;
+    char* source = (char*)malloc(length);
+    if (!source)
+        return 0;
+    snprintf(source, length, "%s%s%s", prefix, ray_text, body);
+    const GLuint shader = shader_compile(type, source);
+    free(source);
+    return shader;
+}
+
+static void ray_locations(VolumeRayLocations* locations, GLuint program)
+{
+    locations->inverse_view_projection = glGetUniformLocation(program, "inverseViewProjection");
+    locations->clip_depth = glGetUniformLocation(program, "clipDepth");
+    locations->scene_size = glGetUniformLocation(program, "sceneSize");
+}
+
+static bool build_programs(VolumeRenderer* vr)
+{
+    GLuint shader = compile_stage(GL_COMPUTE_SHADER, march_shader_text, true);
+    vr->march_program = program_link(&shader, 1, false);
+    shader = compile_stage(GL_COMPUTE_SHADER, resolve_shader_text, true);
+    vr->resolve_program = program_link(&shader, 1, false);
+    GLuint shaders[2] = { compile_stage(GL_VERTEX_SHADER, composite_vertex_shader_text, false),
+        compile_stage(GL_FRAGMENT_SHADER, composite_fragment_shader_text, false) };
+    vr->composite_program = program_link(shaders, 2, false);
+    if (!vr->march_program || !vr->resolve_program || !vr->composite_program)
+        return false;
+    gl_debug_label(GL_PROGRAM, vr->march_program, "volume march");
+    gl_debug_label(GL_PROGRAM, vr->resolve_program, "volume resolve");
+    gl_debug_label(GL_PROGRAM, vr->composite_program, "volume composite");
+
+    ray_locations(&vr->march_ray, vr->march_program);
+    vr->march_location = glGetUniformLocation(vr->march_program, "march");
+    vr->depth_mode_location = glGetUniformLocation(vr->march_program, "depthMode");
+    ray_locations(&vr->resolve_ray, vr->resolve_program);
+    vr->reprojection_location = glGetUniformLocation(vr->resolve_program, "reprojection");
+    vr->blend_location = glGetUniformLocation(vr->resolve_program, "blend");
+    vr->composite_scale_location = glGetUniformLocation(vr->composite_program, "scale");
+
+    // The field's and the atlas's layout never change
+    const Volume* v = &vr->volume;
+    GLint level_size[VOLUME_MAX_LEVELS][4];
+    for (int l = 0; l < v->levels; ++l)
+    {
+        for (int k = 0; k < 3; ++k)
+            level_size[l][k] = v->level_size[l][k];
+        level_size[l][3] = (GLint)v->level_offset[l];
+    }
+    gl_state_use_program(vr->march_program);
+    glUniform4iv(glGetUniformLocation(vr->march_program, "levelSize"), v->levels, &level_size[0][0]);
+    glUniform1i(glGetUniformLocation(vr->march_program, "levels"), v->levels);
+    glUniform3i(glGetUniformLocation(vr->march_program, "fieldSize"), v->size[0], v->size[1], v->size[2]);
+    glUniform3i(glGetUniformLocation(vr->march_program, "atlasSlots"), vr->slots[0], vr->slots[1], vr->slots[2]);
+    glUniform1f(glGetUniformLocation(vr->march_program, "threshold"), (float)v->threshold);
+    return true;
+}
+
+// The field: a raw file mapped, or made up
+static bool load_field(VolumeRenderer* vr, const char* path, int side)
+{
+    const uint8_t* voxels;
+    if (path)
+    {
+        if (!mapped_file_open(&vr->file, path))
+            return false;
+        side = (int)lround(cbrt((double)vr->file.size));
+        if ((size_t)side * side * side != vr->file.size)
+        {
+            fprintf(stderr, "volume: %s is %zu bytes, not a cube of 8-bit voxels\n", path, vr->file.size);
+            return false;
+        }
+        voxels = (const uint8_t*)vr->file.data;
+    }
+    else
+    {
+        vr->generated = (uint8_t*)malloc((size_t)side * side * side);
+        if (!vr->generated)
+        {
+            fprintf(stderr, "volume: out of memory for %d^3 voxels\n", side);
+            return false;
+        }
+        volume_generate(vr->generated, side, 1u);
+        voxels = vr->generated;
+    }
+    const int size[3] = { side, side, side };
+    const float box_min[3] = { -1.f, -1.f, -1.f }, box_max[3] = { 1.f, 1.f, 1.f };
+    if (!volume_init(&vr->volume, voxels, size, box_min, box_max, VOLUME_RENDERER_THRESHOLD))
+    {
+        fprintf(stderr, "volume: nothing above the threshold in %d^3 voxels, or out of memory\n", side);
+        return false;
+    }
+    return true;
+}
+
+// As many slots as the budget holds and there are occupied bricks, laid out in a box the 3D texture size allows
+static bool allocate_atlas(VolumeRenderer* vr, uint64_t budget)
+{
+    const uint64_t slot_bytes = (uint64_t)VOLUME_BRICK_STORED * VOLUME_BRICK_STORED * VOLUME_BRICK_STORED;
+    uint64_t capacity = budget / slot_bytes;
+    capacity = capacity < vr->volume.occupied ? capacity : vr->volume.occupied;
+    capacity = capacity > 0 ? capacity : 1;
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &max_size);
+    const int axis = max_size / VOLUME_BRICK_STORED > 0 ? max_size / VOLUME_BRICK_STORED : 1;
+    int* s = vr->slots;
+    s[0] = (int)ceil(cbrt((double)capacity));
+    s[0] = s[0] < axis ? s[0] : axis;
+    s[1] = (int)ceil(sqrt((double)((capacity + s[0] - 1) / s[0])));
+    s[1] = s[1] < axis ? s[1] : axis;
+    s[2] = (int)((capacity + (uint64_t)s[0] * s[1] - 1) / ((uint64_t)s[0] * s[1]));
+    s[2] = s[2] < axis ? s[2] : axis;
+    const uint64_t slots = (uint64_t)s[0] * s[1] * s[2];
+    capacity = capacity < slots ? capacity : slots;
+    if (!volume_streaming_init(&vr->streaming, &vr->volume, (uint32_t)capacity))
+    {
+        fprintf(stderr, "volume: out of memory for streaming\n");
+        return false;
+    }
+
+    const GLsizei w = s[0] * VOLUME_BRICK_STORED, h = s[1] * VOLUME_BRICK_STORED, d = s[2] * VOLUME_BRICK_STORED;
+    glGenTextures(1, &vr->atlas);
+    gl_state_bind_texture(0, GL_TEXTURE_3D, vr->atlas);
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_R8, w, h, d);
+    gl_memory_texture(vr->atlas, GPU_MEMORY_STREAMED_TEXTURES, GL_R8, w, h, d, 1, 1);
+    gl_debug_label(GL_TEXTURE, vr->atlas, "volume bricks");
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    gl_state_bind_texture(0, GL_TEXTURE_3D, 0);
+    return true;
+}
+
+// Level 0 empty until bricks arrive, the levels above the occupancy as it is
+static bool create_cells(VolumeRenderer* vr)
+{
+    const Volume* v = &vr->volume;
+    const int top = v->levels - 1;
+    const uint32_t count = v->level_offset[top] + (uint32_t)(v->level_size[top][0] * v->level_size[top][1]
+        * v->level_size[top][2]);
+    vr->cells = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    if (!vr->cells)
+        return false;
+    const uint32_t bricks = volume_brick_count(v);
+    for (uint32_t i = 0; i < count; ++i)
+        vr->cells[i] = i < bricks ? 0u : v->occupancy[i];
+    vr->cell_buffer = gl_dsa_create_buffer((GLsizeiptr)(sizeof(uint32_t) * count), vr->cells, GL_DYNAMIC_DRAW);
+    gl_memory_buffer(vr->cell_buffer, GPU_MEMORY_STORAGE, sizeof(uint32_t) * count);
+    gl_debug_label(GL_BUFFER, vr->cell_buffer, "volume occupancy");
+    return true;
+}
+
+bool volume_renderer_init(VolumeRenderer* vr, const char* path, int side, uint64_t budget)
+{
+    memset(vr, 0, sizeof(*vr));
+    mat4x4_identity(vr->last_view_projection);
+    if (!load_field(vr, path, side) || !allocate_atlas(vr, budget) || !create_cells(vr))
+    {
+        volume_renderer_destroy(vr);
+        return false;
+    }
+    vr->loads = (VolumeLoad*)malloc(sizeof(VolumeLoad) * VOLUME_RENDERER_UPLOADS);
+    vr->brick = (uint8_t*)malloc((size_t)VOLUME_BRICK_STORED * VOLUME_BRICK_STORED * VOLUME_BRICK_STORED);
+    if (!vr->loads || !vr->brick || !build_programs(vr))
+    {
+        fprintf(stderr, "volume: can't build the march, resolve and composite programs\n");
+        volume_renderer_destroy(vr);
+        return false;
+    }
+    vr->vertex_array = gl_dsa_create_vertex_array();
+    gl_debug_label(GL_VERTEX_ARRAY, vr->vertex_array, "volume composite");
+    return true;
+}
+
+void volume_renderer_destroy(VolumeRenderer* vr)
+{
+    gl_state_delete_textures(1, &vr->atlas);
+    gl_state_delete_textures(1, &vr->current);
+    gl_state_delete_textures(1, &vr->distance);
+    gl_state_delete_textures(2, vr->history);
+    gl_state_delete_buffers(1, &vr->cell_buffer);
+    gl_state_delete_vertex_arrays(1, &vr->vertex_array);
+    if (vr->march_program)
+        glDeleteProgram(vr->march_program);
+    if (vr->resolve_program)
+        glDeleteProgram(vr->resolve_program);
+    if (vr->composite_program)
+        glDeleteProgram(vr->composite_program);
+    if (vr->streaming.slot_of)
+        volume_streaming_destroy(&vr->streaming);
+    if (vr->volume.occupancy)
+        volume_destroy(&vr->volume);
+    mapped_file_close(&vr->file);
+    free(vr->generated);
+    free(vr->loads);
+    free(vr->brick);
+    free(vr->cells);
+    memset(vr, 0, sizeof(*vr));
+}
+
+static GLuint create_image(GLenum format, GLenum filter, int width, int height, const char* name)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+    gl_memory_texture(texture, GPU_MEMORY_RENDER_TARGETS, format, width, height, 1, 1, 1);
+    gl_debug_label(GL_TEXTURE, texture, name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+// The marched images at the scene's size over VOLUME_RENDERER_SCALE; the history starts over
+static void allocate_images(VolumeRenderer* vr, int width, int height)
+{
+    gl_state_delete_textures(1, &vr->current);
+    gl_state_delete_textures(1, &vr->distance);
+    gl_state_delete_textures(2, vr->history);
+    vr->width = width;
+    vr->height = height;
+    vr->current = create_image(GL_RGBA16F, GL_NEAREST, width, height, "volume current");
+    vr->distance = create_image(GL_R32F, GL_NEAREST, width, height, "volume distance");
+    vr->history[0] = create_image(GL_RGBA16F, GL_LINEAR, width, height, "volume history 0");
+    vr->history[1] = create_image(GL_RGBA16F, GL_LINEAR, width, height, "volume history 1");
+    gl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+    vr->history_valid = false;
+}
+
+// The planned bricks into their slots, and level 0 of the cells pointing at them
+static bool stream_bricks(VolumeRenderer* vr, const vec3 eye)
+{
+    const uint32_t count = volume_streaming_plan(&vr->streaming, &vr->volume, eye, VOLUME_RENDERER_UPLOADS,
+        vr->loads);
+    if (!count)
+        return false;
+    gl_state_bind_texture(0, GL_TEXTURE_3D, vr->atlas);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const VolumeLoad* load = &vr->loads[i];
+        if (load->evicted >= 0)
+            vr->cells[load->evicted] = 0u;
+        vr->cells[load->brick] = load->slot + 1u;
+        volume_brick_voxels(&vr->volume, load->brick, vr->brick);
+        const int* s = vr->slots;
+        const GLint x = (GLint)(load->slot % s[0]), y = (GLint)(load->slot / s[0] % s[1]);
+        const GLint z = (GLint)(load->slot / s[0] / s[1]);
+        glTexSubImage3D(GL_TEXTURE_3D, 0, x * VOLUME_BRICK_STORED, y * VOLUME_BRICK_STORED, z * VOLUME_BRICK_STORED,
+            VOLUME_BRICK_STORED, VOLUME_BRICK_STORED, VOLUME_BRICK_STORED, GL_RED, GL_UNSIGNED_BYTE, vr->brick);
+        draw_counters_upload((uint64_t)VOLUME_BRICK_STORED * VOLUME_BRICK_STORED * VOLUME_BRICK_STORED);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    gl_state_bind_texture(0, GL_TEXTURE_3D, 0);
+    const GLsizeiptr bytes = (GLsizeiptr)(sizeof(uint32_t) * volume_brick_count(&vr->volume));
+    gl_dsa_buffer_sub_data(vr->cell_buffer, 0, bytes, vr->cells);
+    draw_counters_upload((uint64_t)bytes);
+    vr->uploads += count;
+    return true;
+}
+
+static void set_ray(const VolumeRayLocations* locations, const VolumeView* view, const float clip_depth[2])
+{
+    glUniformMatrix4fv(locations->inverse_view_projection, 1, GL_FALSE, &view->inverse_view_projection[0][0]);
+    glUniform2f(locations->clip_depth, clip_depth[0], clip_depth[1]);
+    glUniform2i(locations->scene_size, view->width, view->height);
+}
+
+unsigned int volume_renderer_draw(VolumeRenderer* vr, const VolumeView* view)
+{
+    const int width = (view->width + VOLUME_RENDERER_SCALE - 1) / VOLUME_RENDERER_SCALE;
+    const int height = (view->height + VOLUME_RENDERER_SCALE - 1) / VOLUME_RENDERER_SCALE;
+    if (!vr->current || vr->width != width || vr->height != height)
+        allocate_images(vr, width, height);
+
+    // The bricks nearest the near plane's centre
+    const float clip_depth[2] = { view->reversed_z ? 1.f : -1.f, view->reversed_z ? 0.f : 1.f };
+    vec4 centre = { 0.f, 0.f, clip_depth[0], 1.f }, on_plane;
+    mat4x4_mul_vec4(on_plane, view->inverse_view_projection, centre);
+    const vec3 eye = { on_plane[0] / on_plane[3], on_plane[1] / on_plane[3], on_plane[2] / on_plane[3] };
+    const bool arrived = stream_bricks(vr, eye);
+
+    // Averaged evenly while nothing changes, so the jittered samples add up to a finer step; blended and clamped
+    // otherwise
+    const bool moved = memcmp(vr->last_view_projection, view->view_projection, sizeof(mat4x4)) != 0;
+    vr->still_frames = !vr->history_valid || moved || arrived ? 0 : vr->still_frames + 1;
+    float blend = 1.f, clamp_history = 1.f;
+    if (vr->history_valid && vr->still_frames > 0)
+    {
+        blend = fmaxf(1.f / (vr->still_frames + 1), 1.f / VOLUME_RENDERER_MAX_HISTORY);
+        clamp_history = 0.f;
+    }
+    else if (vr->history_valid)
+        blend = VOLUME_RENDERER_BLEND;
+
+    const GLuint groups_x = (GLuint)((width + VOLUME_RENDERER_GROUP_SIZE - 1) / VOLUME_RENDERER_GROUP_SIZE);
+    const GLuint groups_y = (GLuint)((height + VOLUME_RENDERER_GROUP_SIZE - 1) / VOLUME_RENDERER_GROUP_SIZE);
+    const float voxel = 2.f / vr->volume.size[0];
+    const float step = VOLUME_RENDERER_STEP * voxel;
+    gl_state_use_program(vr->march_program);
+    set_ray(&vr->march_ray, view, clip_depth);
+    glUniform4f(vr->march_location, step, view->pixel_scale > 0.f ? step * view->pixel_scale / VOLUME_RENDERER_SCALE
+        : FLT_MAX, VOLUME_RENDERER_MIN_TRANSMITTANCE, (float)fmod(vr->frames * 0.6180339887, 1.0));
+    glUniform1i(vr->depth_mode_location, !view->depth ? 0 : view->zero_to_one ? 2 : 1);
+    gl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 0, vr->cell_buffer);
+    gl_state_bind_texture(0, GL_TEXTURE_3D, vr->atlas);
+    gl_state_bind_texture(1, GL_TEXTURE_2D, view->depth);
+    glBindImageTexture(0, vr->current, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindImageTexture(1, vr->distance, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute(groups_x, groups_y, 1);
+    draw_counters_dispatch();
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    const int target = vr->target ^ 1;
+    gl_state_use_program(vr->resolve_program);
+    set_ray(&vr->resolve_ray, view, clip_depth);
+    glUniformMatrix4fv(vr->reprojection_location, 1, GL_FALSE, &vr->last_view_projection[0][0]);
+    glUniform2f(vr->blend_location, blend, clamp_history);
+    gl_state_bind_texture(0, GL_TEXTURE_2D, vr->current);
+    gl_state_bind_texture(1, GL_TEXTURE_2D, vr->distance);
+    gl_state_bind_texture(2, GL_TEXTURE_2D, vr->history[vr->target]);
+    glBindImageTexture(0, vr->history[target], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glDispatchCompute(groups_x, groups_y, 1);
+    draw_counters_dispatch();
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    vr->target = target;
+    vr->history_valid = true;
+    mat4x4_dup(vr->last_view_projection, view->view_projection);
+
+    gl_state_use_program(vr->composite_program);
+    glUniform2f(vr->composite_scale_location, 1.f / (VOLUME_RENDERER_SCALE * width),
+        1.f / (VOLUME_RENDERER_SCALE * height));
+    gl_state_bind_texture(0, GL_TEXTURE_2D, vr->history[target]);
+    gl_state_bind_texture(1, GL_TEXTURE_2D, 0);
+    gl_state_bind_texture(2, GL_TEXTURE_2D, 0);
+    gl_state_bind_vertex_array(vr->vertex_array);
+    gl_state_enable(GL_DEPTH_TEST, false);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    draw_counters_draw(GL_TRIANGLES, 3, 1);
+    ++vr->frames;
+    return 3;
+}
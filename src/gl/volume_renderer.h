@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "core/mapped_file.h"
+#include "linmath.h"
+#include "scene/volume.h"
+
+#include <stdint.h>
+
+// Ray marches a scene/volume.h field in compute shaders (needs a 4.3
+// context) and composites it over the scene target.
+//
+// The occupied bricks nearest the eye are streamed into slots of an R8 3D
+// atlas (VOLUME_BRICK_STORED texels a side each, apron included, so the
+// hardware's trilinear filter never reads a neighbouring slot), at most
+// VOLUME_RENDERER_UPLOADS a frame, as many slots as "budget" bytes hold. The
+// occupancy pyramid goes to a storage buffer of one uint per cell: level 0
+// holds a brick's slot + 1 while it's resident, 0 otherwise, and the levels
+// above hold volume_occupied. The march is volume_march's, cell by cell, and
+// a brick not yet resident is skipped like an empty one until it is.
+//
+// Rays are marched at 1 / VOLUME_RENDERER_SCALE of the scene's resolution,
+// each stopping at the scene's depth where there is one (the farthest of the
+// pixels it covers), with its samples jittered along it by a per-pixel
+// offset that changes every frame. A resolve pass reprojects the last
+// frame's result through the distance where the ray became half opaque and
+// blends it in: evenly over up to VOLUME_RENDERER_MAX_HISTORY frames while
+// the view stands still, which integrates the jitter into the samples of a
+// far finer step, and by VOLUME_RENDERER_BLEND, clamped to the new pixel's
+// neighbourhood, while it moves. The composite upsamples that bilinearly.
+//
+// Belongs to the thread whose context renders.
+
+#define VOLUME_RENDERER_SCALE 2                 // scene pixels a marched pixel spans each way
+#define VOLUME_RENDERER_UPLOADS 32              // bricks a frame
+#define VOLUME_RENDERER_BLEND 0.2f              // of the new frame while the view moves
+#define VOLUME_RENDERER_MAX_HISTORY 32          // frames averaged while it stands still
+#define VOLUME_RENDERER_MIN_TRANSMITTANCE 0.01f // where a ray stops
+#define VOLUME_RENDERER_STEP 0.5f               // voxels between samples near the eye
+#define VOLUME_RENDERER_THRESHOLD 24            // field values at or below it are transparent
+
+typedef struct VolumeView
+{
+    mat4x4 view_projection;     // unjittered, camera-relative, as the Camera block's
+    mat4x4 inverse_view_projection;
+    float pixel_scale;          // pixels a unit spans one unit in front of the eye; 0 for orthographic views
+    bool reversed_z;            // the near plane is at depth 1
+    bool zero_to_one;           // clip depth is [0, 1] (glClipControl), [-1, 1] otherwise
+    GLuint depth;               // the scene's depth texture (single-sampled) to stop rays at; 0 for none
+    int width, height;          // the scene's pixels
+} VolumeView;
+
+typedef struct VolumeRayLocations
+{
+    GLint inverse_view_projection;
+    GLint clip_depth;           // the near and far planes' NDC depth
+    GLint scene_size;
+} VolumeRayLocations;
+
+typedef struct VolumeRenderer
+{
+    Volume volume;
+    uint8_t* generated;         // the made-up field's voxels; NULL for a file's
+    MappedFile file;            // a raw file's
+    VolumeStreaming streaming;
+    VolumeLoad* loads;          // [VOLUME_RENDERER_UPLOADS]
+    uint8_t* brick;             // one brick with its apron, for the uploads
+    uint32_t* cells;            // the pyramid's cells as the buffer holds them
+    GLuint cell_buffer;
+    GLuint atlas;               // GL_R8, slots[0] x slots[1] x slots[2] bricks
+    int slots[3];
+
+    GLuint march_program;       // the rays, into "current" and "distance"
+    VolumeRayLocations march_ray;
+    GLint march_location;       // step, detail distance, min transmittance, the frame's jitter
+    GLint depth_mode_location;
+    GLuint resolve_program;     // history blended in, into history[target]
+    VolumeRayLocations resolve_ray;
+    GLint reprojection_location;
+    GLint blend_location;
+    GLuint composite_program;   // history[target] over the bound framebuffer
+    GLint composite_scale_location;
+    GLuint vertex_array;        // empty, for the full-screen triangle
+
+    GLuint current;             // RGBA16F, premultiplied
+    GLuint distance;            // R32F: along the ray, where it was reprojected from
+    GLuint history[2];          // RGBA16F
+    int width, height;          // of those
+    int target;                 // the history written last
+    bool history_valid;
+    mat4x4 last_view_projection;
+    unsigned int still_frames;  // since the view last moved or a brick arrived
+
+    unsigned long long uploads; // bricks over the run
+    unsigned int frames;        // drawn; also steps the jitter
+} VolumeRenderer;
+
+// Needs a current context. The field is "path"'s, a raw cube of 8-bit voxels (its side the size's cube root), or
+// made up "side" voxels a side when "path" is NULL; it fills the box [-1, 1]^3 around the origin. The atlas holds
+// as many bricks as "budget" bytes, and never more than are occupied. Logs and returns false when a program fails
+// to build or the field can't be used.
+bool volume_renderer_init(VolumeRenderer* vr, const char* path, int side, uint64_t budget);
+void volume_renderer_destroy(VolumeRenderer* vr);
+
+// Streams the bricks "view" needs, marches and resolves, and composites the volume over the bound framebuffer with
+// premultiplied blending; leaves blending on and the depth test off. Returns the dispatches and draws made.
+unsigned int volume_renderer_draw(VolumeRenderer* vr, const VolumeView* view);
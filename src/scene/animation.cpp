@@ -0,0 +1,199 @@
+#include "scene/animation.h"
+
+#include "linmath_quat.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUAT_RANGE 0.70710678f      // the three smallest components of a unit quaternion lie within +-1/sqrt2
+#define QUAT_STEPS 32767.f          // 15 bits
+
+bool skeleton_init(Skeleton* s, const uint8_t* parent, const vec3* rest, uint32_t joint_count)
+{
+    if (joint_count < 1 || joint_count > SKELETON_MAX_JOINTS)
+    {
+        fprintf(stderr, "skeleton: %u joints, 1 to %d supported\n", joint_count, SKELETON_MAX_JOINTS);
+        return false;
+    }
+    s->joint_count = joint_count;
+    mat3x4 bind[SKELETON_MAX_JOINTS];
+    for (uint32_t j = 0; j < joint_count; ++j)
+    {
+        if (parent[j] != SKELETON_NO_PARENT && parent[j] >= j)
+        {
+            fprintf(stderr, "skeleton: joint %u's parent %u doesn't come before it\n", j, parent[j]);
+            return false;
+        }
+        s->parent[j] = parent[j];
+        vec3_dup(s->rest[j], rest[j]);
+
+        // The bind pose is the rest pose: translations only
+        mat3x4_identity(bind[j]);
+        bind[j][0][3] = rest[j][0];
+        bind[j][1][3] = rest[j][1];
+        bind[j][2][3] = rest[j][2];
+        if (parent[j] != SKELETON_NO_PARENT)
+            mat3x4_mul(bind[j], bind[parent[j]], bind[j]);
+        mat3x4_invert(s->inverse_bind[j], bind[j]);
+    }
+    return true;
+}
+
+void skeleton_palette(const Skeleton* s, const quat* rotations, mat3x4 const placement, mat3x4* palette)
+{
+    mat3x4 model[SKELETON_MAX_JOINTS];
+    for (uint32_t j = 0; j < s->joint_count; ++j)
+    {
+        mat3x4 local;
+        quat_to_mat3x4(local, rotations[j], s->rest[j]);
+        mat3x4_mul(model[j], s->parent[j] == SKELETON_NO_PARENT ? placement : model[s->parent[j]], local);
+        mat3x4_mul(palette[j], model[j], s->inverse_bind[j]);
+    }
+}
+
+void animation_quat_pack(uint16_t out[3], quat const q)
+{
+    int largest = 0;
+    for (int i = 1; i < 4; ++i)
+    {
+        if (fabsf(q[i]) > fabsf(q[largest]))
+            largest = i;
+    }
+    const float sign = q[largest] < 0.f ? -1.f : 1.f;
+    for (int i = 0, k = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float v = sign * q[i] / QUAT_RANGE * 0.5f + 0.5f;
+        v = v < 0.f ? 0.f : v > 1.f ? 1.f : v;
+        out[k++] = (uint16_t)lrintf(v * QUAT_STEPS);
+    }
+    out[0] |= (uint16_t)((largest >> 1) << 15);
+    out[1] |= (uint16_t)((largest & 1) << 15);
+}
+
+void animation_quat_unpack(quat q, const uint16_t in[3])
+{
+    const int largest = (in[0] >> 15) << 1 | in[1] >> 15;
+    float sum = 0.f;
+    for (int i = 0, k = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        const float v = ((in[k++] & 0x7FFFu) / QUAT_STEPS * 2.f - 1.f) * QUAT_RANGE;
+        q[i] = v;
+        sum += v * v;
+    }
+    q[largest] = sqrtf(sum < 1.f ? 1.f - sum : 0.f);
+}
+
+// The angle of the rotation from a to b, both unit. From the chord rather than acos of the dot product,
+// which loses the small angles the tolerance is about to float rounding.
+static float quat_angle(quat const a, quat const b)
+{
+    const float sign = quat_mul_inner(a, b) < 0.f ? -1.f : 1.f;
+    float chord = 0.f;
+    for (int i = 0; i < 4; ++i)
+        chord += (a[i] - sign * b[i]) * (a[i] - sign * b[i]);
+    const float s = sqrtf(chord) * 0.5f;
+    return 4.f * asinf(s < 1.f ? s : 1.f);
+}
+
+bool animation_clip_init(AnimationClip* clip, const quat* rotations, uint32_t joint_count, uint32_t frame_count,
+    float frame_rate, float tolerance)
+{
+    memset(clip, 0, sizeof(*clip));
+    clip->first_key = (uint32_t*)malloc(sizeof(uint32_t) * joint_count);
+    clip->animated = (uint8_t*)malloc(joint_count);
+    clip->keys = (uint16_t*)malloc(sizeof(uint16_t) * 3 * joint_count * frame_count);  // at most; trimmed below
+    if (!clip->first_key || !clip->animated || !clip->keys || !frame_count || !(frame_rate > 0.f))
+    {
+        fprintf(stderr, "animation: can't build a clip of %u frames x %u joints\n", frame_count, joint_count);
+        animation_clip_destroy(clip);
+        return false;
+    }
+    clip->joint_count = joint_count;
+    clip->frame_count = frame_count;
+    clip->frame_rate = frame_rate;
+    clip->duration = frame_count / frame_rate;
+
+    for (uint32_t j = 0; j < joint_count; ++j)
+    {
+        bool animated = false;
+        for (uint32_t f = 1; f < frame_count && !animated; ++f)
+            animated = quat_angle(rotations[j], rotations[f * joint_count + j]) > tolerance;
+        clip->first_key[j] = clip->key_count;
+        clip->animated[j] = animated;
+        const uint32_t keys = animated ? frame_count : 1;
+        for (uint32_t f = 0; f < keys; ++f)
+            animation_quat_pack(clip->keys + 3 * (clip->key_count + f), rotations[f * joint_count + j]);
+        clip->key_count += keys;
+    }
+    uint16_t* trimmed = (uint16_t*)realloc(clip->keys, sizeof(uint16_t) * 3 * clip->key_count);
+    if (trimmed)
+        clip->keys = trimmed;
+    return true;
+}
+
+void animation_clip_destroy(AnimationClip* clip)
+{
+    free(clip->first_key);
+    free(clip->animated);
+    free(clip->keys);
+    memset(clip, 0, sizeof(*clip));
+}
+
+size_t animation_clip_bytes(const AnimationClip* clip)
+{
+    return sizeof(uint16_t) * 3 * clip->key_count + (sizeof(uint32_t) + 1) * clip->joint_count;
+}
+
+void animation_clip_sample(const AnimationClip* clip, float time, quat* rotations)
+{
+    float t = fmodf(time, clip->duration);
+    t += t < 0.f ? clip->duration : 0.f;
+    const float frame = t * clip->frame_rate;
+    uint32_t k0 = (uint32_t)frame;
+    k0 = k0 < clip->frame_count ? k0 : clip->frame_count - 1;   // rounding at the very end of the clip
+    const uint32_t k1 = k0 + 1 < clip->frame_count ? k0 + 1 : 0;
+    const float alpha = frame - (float)k0;
+    for (uint32_t j = 0; j < clip->joint_count; ++j)
+    {
+        const uint16_t* keys = clip->keys + 3 * clip->first_key[j];
+        if (!clip->animated[j])
+        {
+            animation_quat_unpack(rotations[j], keys);
+            continue;
+        }
+        quat a, b;
+        animation_quat_unpack(a, keys + 3 * k0);
+        animation_quat_unpack(b, keys + 3 * k1);
+        quat_nlerp(rotations[j], a, b, alpha);     // the short way round
+    }
+}
+
+void animation_clip_bake(const Skeleton* s, const AnimationClip* clip, uint32_t frame_count, mat3x4* palettes)
+{
+    mat3x4 identity;
+    mat3x4_identity(identity);
+    quat rotations[SKELETON_MAX_JOINTS];
+    for (uint32_t f = 0; f < frame_count; ++f)
+    {
+        animation_clip_sample(clip, clip->duration * (float)f / (float)frame_count, rotations);
+        skeleton_palette(s, rotations, identity, palettes + (size_t)f * s->joint_count);
+    }
+}
+
+void animation_crowd_range(void* data, size_t begin, size_t end)
+{
+    const AnimationCrowd* crowd = (const AnimationCrowd*)data;
+    const uint32_t joints = crowd->skeleton->joint_count;
+    quat rotations[SKELETON_MAX_JOINTS];
+    for (size_t i = begin; i < end; ++i)
+    {
+        animation_clip_sample(crowd->clip, crowd->time + crowd->offset[i], rotations);
+        skeleton_palette(crowd->skeleton, rotations, crowd->placement[i], crowd->palettes + i * joints);
+    }
+}
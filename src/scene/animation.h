@@ -0,0 +1,96 @@
+#pragma once
+
+#include "linmath_affine.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Skeletal animation on the CPU: compressed clips, pose sampling, and the
+// skinning palettes the vertex shader blends.
+//
+// A skeleton is up to SKELETON_MAX_JOINTS joints, each with a parent of lower
+// index and a rest translation relative to it; the rest pose is the bind pose.
+// A clip animates every joint's rotation over frame_count evenly spaced keys
+// and loops. Keys are quantised quaternions, 6 bytes instead of 16: the
+// largest component is dropped (the sign is flipped to make it positive, q
+// and -q being the same rotation) and rebuilt from the unit length, the other
+// three are stored in 15 bits each over [-1/sqrt2, 1/sqrt2], and the dropped
+// component's index goes in two of the spare top bits. That's within 2e-4
+// radians of the original. A joint that never turns further than the clip's
+// tolerance from its first key keeps that one key. Sampling nlerps the two
+// keys around the time.
+//
+// A pose's palette is one mat3x4 per joint: the character's placement times
+// the joint's model transform times its inverse bind matrix, which is what
+// linear blend skinning multiplies a bind-pose vertex by. That's 48 bytes a
+// joint with the constant bottom row left out, against 64 for a mat4x4.
+// Since the placement only multiplies in from the left, a clip can be baked
+// once at the identity placement, frame by frame, and a character anywhere
+// in it is its placement times a baked palette (gl/skinning.h's baked path).
+//
+// animation_crowd_range evaluates whole characters, so a crowd splits across
+// job_parallel_for with no writes shared between jobs.
+
+#define SKELETON_MAX_JOINTS 64
+#define SKELETON_NO_PARENT 0xFFu
+
+typedef struct Skeleton
+{
+    uint32_t joint_count;
+    uint8_t parent[SKELETON_MAX_JOINTS];    // a lower index, or SKELETON_NO_PARENT
+    vec3 rest[SKELETON_MAX_JOINTS];         // translation from the parent
+    mat3x4 inverse_bind[SKELETON_MAX_JOINTS];
+} Skeleton;
+
+typedef struct AnimationClip
+{
+    uint32_t joint_count;
+    uint32_t frame_count;       // keys of an animated joint
+    float frame_rate;
+    float duration;             // frame_count / frame_rate: the last key blends back into the first
+    uint32_t* first_key;        // [joint_count]: joint j's keys start at keys + 3 * first_key[j]
+    uint8_t* animated;          // [joint_count]: 1 for frame_count keys, 0 for one constant key
+    uint16_t* keys;             // 3 per key
+    uint32_t key_count;
+} AnimationClip;
+
+// Logs and returns false when a parent doesn't come before its child or there are too many joints
+bool skeleton_init(Skeleton* s, const uint8_t* parent, const vec3* rest, uint32_t joint_count);
+
+// The palette for a pose ("rotations", one per joint, relative to the parent) of a character at "placement"
+void skeleton_palette(const Skeleton* s, const quat* rotations, mat3x4 const placement, mat3x4* palette);
+
+// A unit quaternion in 6 bytes, and back (unit length, the sign possibly flipped)
+void animation_quat_pack(uint16_t out[3], quat const q);
+void animation_quat_unpack(quat q, const uint16_t in[3]);
+
+// Compresses "frame_count" frames of "joint_count" unit rotations (frame-major: rotations[frame * joint_count + j])
+// sampled at "frame_rate". A joint that stays within "tolerance" radians of its first frame gets one key.
+// Logs and returns false when out of memory.
+bool animation_clip_init(AnimationClip* clip, const quat* rotations, uint32_t joint_count, uint32_t frame_count,
+    float frame_rate, float tolerance);
+void animation_clip_destroy(AnimationClip* clip);
+
+// Bytes the keys and track tables take
+size_t animation_clip_bytes(const AnimationClip* clip);
+
+// Every joint's rotation at "time" seconds, wrapped into the clip
+void animation_clip_sample(const AnimationClip* clip, float time, quat* rotations);
+
+// The palettes of "frame_count" poses evenly spaced over "clip" (the first at time 0), at the identity placement:
+// palettes[frame * joint_count + j]
+void animation_clip_bake(const Skeleton* s, const AnimationClip* clip, uint32_t frame_count, mat3x4* palettes);
+
+// A crowd of characters sharing a skeleton and a clip, each at its own placement and point in the clip
+typedef struct AnimationCrowd
+{
+    const Skeleton* skeleton;
+    const AnimationClip* clip;  // its joint_count must be the skeleton's
+    const mat3x4* placement;    // [character]
+    const float* offset;        // [character]: seconds into the clip at time 0
+    float time;
+    mat3x4* palettes;           // [character * joint_count], written
+} AnimationCrowd;
+
+// Samples the clip and builds the palettes of characters [begin, end): a JobRangeFunction over the crowd
+void animation_crowd_range(void* crowd, size_t begin, size_t end);
@@ -0,0 +1,329 @@
+#include "scene/bench_scene.h"
+
+#include "linmath_batch.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const BenchSceneParams bench_scene_presets[] = {
+    { "10k-static", 10000, 1, 8, 0, 0.f, 0, false, 1 },
+    { "100k-static", 100000, 4, 16, 0, 0.f, 0, false, 1 },
+    { "1m-instanced", 1000000, 1, 1, 0, 0.f, 0, false, 1 },
+    { "10k-lit", 10000, 4, 16, 256, 0.f, 0, false, 1 },
+    { "50k-translucent", 50000, 4, 16, 0, 0.5f, 0, false, 1 },
+    { "100k-static-hierarchy", 100000, 8, 32, 0, 0.f, 4, false, 1 },
+    { "100k-dynamic-hierarchy", 100000, 8, 32, 16, 0.1f, 4, true, 1 },
+    { "1m-dynamic-hierarchy", 1000000, 8, 32, 0, 0.f, 6, true, 1 },
+};
+const int bench_scene_preset_count = (int)(sizeof(bench_scene_presets) / sizeof(bench_scene_presets[0]));
+
+#define BENCH_SCENE_RING 0.3f       // the first ring's radius, of a root's grid cell
+#define BENCH_SCENE_RING_STEP 0.4f  // each ring's radius, of the one above's
+
+static uint32_t random_u32(uint32_t* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static float random_float(uint32_t* state, float lo, float hi)
+{
+    return lo + (hi - lo) * (float)random_u32(state) / 16777216.f;
+}
+
+bool bench_scene_parse(const char* spec, BenchSceneParams* params)
+{
+    const size_t name_length = strcspn(spec, ",");
+    int preset = -1;
+    for (int i = 0; i < bench_scene_preset_count && preset < 0; ++i)
+    {
+        if (strlen(bench_scene_presets[i].name) == name_length && !strncmp(spec, bench_scene_presets[i].name, name_length))
+            preset = i;
+    }
+    if (preset < 0)
+    {
+        fprintf(stderr, "bench_scene: no preset \"%.*s\"\n", (int)name_length, spec);
+        return false;
+    }
+    *params = bench_scene_presets[preset];
+    for (const char* at = spec + name_length; *at == ',';)
+    {
+        const char* knob = at + 1;
+        const size_t length = strcspn(knob, ",");
+        const char* equals = (const char*)memchr(knob, '=', length);
+        const size_t key = equals ? (size_t)(equals - knob) : length;
+        const char* value = equals ? equals + 1 : "";
+        const uint32_t n = (uint32_t)strtoul(value, NULL, 10);
+#define KNOB(k) (key == sizeof(k) - 1 && !strncmp(knob, k, key))
+        if (!equals)
+            preset = -1;
+        else if (KNOB("objects"))
+            params->objects = n;
+        else if (KNOB("meshes"))
+            params->meshes = n;
+        else if (KNOB("materials"))
+            params->materials = n;
+        else if (KNOB("lights"))
+            params->lights = n;
+        else if (KNOB("translucent"))
+            params->translucent = (float)atof(value);
+        else if (KNOB("depth"))
+            params->depth = n;
+        else if (KNOB("dynamic"))
+            params->dynamic = n != 0;
+        else if (KNOB("seed"))
+            params->seed = n;
+        else
+            preset = -1;
+#undef KNOB
+        if (preset < 0)
+        {
+            fprintf(stderr, "bench_scene: \"%.*s\" isn't a knob=value (objects, meshes, materials, lights, "
+                "translucent, depth, dynamic, seed)\n", (int)length, knob);
+            return false;
+        }
+        params->name = "custom";
+        at = knob + length;
+    }
+    return true;
+}
+
+void bench_scene_print_presets(FILE* out)
+{
+    for (int i = 0; i < bench_scene_preset_count; ++i)
+    {
+        const BenchSceneParams* p = &bench_scene_presets[i];
+        fprintf(out, "  %-24s %8u objects, %2u meshes, %2u materials, %3u lights, %2.0f%% translucent, depth %u%s\n",
+            p->name, p->objects, p->meshes, p->materials, p->lights, 100.f * p->translucent, p->depth,
+            p->dynamic ? ", dynamic" : "");
+    }
+}
+
+// Nodes in a full tree "depth" levels deep
+static uint32_t cluster_size(uint32_t depth)
+{
+    uint32_t nodes = 1, level = 1;
+    for (uint32_t l = 0; l < depth; ++l)
+    {
+        level *= BENCH_SCENE_BRANCHING;
+        nodes += level;
+    }
+    return nodes;
+}
+
+static void bench_scene_box(BenchScene* bs, uint32_t i)
+{
+    const float r = bs->radius[i];
+    const Aabb box = { { bs->x[i] - r, bs->y[i] - r, bs->z[i] - r }, { bs->x[i] + r, bs->y[i] + r, bs->z[i] + r } };
+    bs->bounds[i] = box;
+}
+
+// The forest: a root per grid cell, each child on a ring around its parent. Nodes go in cluster by cluster, each
+// breadth-first, so parents always come first.
+static bool bench_scene_forest(BenchScene* bs, uint32_t* random)
+{
+    const BenchSceneParams* p = &bs->params;
+    const uint32_t per_cluster = cluster_size(p->depth);
+    const uint32_t roots = (bs->count + per_cluster - 1) / per_cluster;
+    const int cols = (int)ceil(sqrt((double)roots));
+    const float cell = 2.f / cols;
+    float ring = cell * BENCH_SCENE_RING;
+    for (uint32_t l = 1; l < p->depth; ++l)
+        ring *= BENCH_SCENE_RING_STEP;
+    bs->object_scale = 0.5f * ring;
+    if (!transform_hierarchy_init(&bs->hierarchy, bs->count))
+        return false;
+
+    uint8_t* level = (uint8_t*)malloc(per_cluster);
+    if (!level)
+        return false;
+    for (uint32_t root = 0, node = 0; node < bs->count; ++root)
+    {
+        const uint32_t first = node;
+        for (uint32_t j = 0; j < per_cluster && node < bs->count; ++j, ++node)
+        {
+            const uint32_t parent = j ? (j - 1) / BENCH_SCENE_BRANCHING : 0;
+            trs local;
+            const float turn = random_float(random, -3.14159265f, 3.14159265f);
+            if (!j)
+            {
+                level[0] = 0;
+                trs_translate_rotate_Z(&local, -1.f + cell * (root % cols + 0.5f), -1.f + cell * (root / cols + 0.5f), 0.f,
+                    turn, 1.f);
+            }
+            else
+            {
+                level[j] = (uint8_t)(level[parent] + 1);
+                float r = cell * BENCH_SCENE_RING;
+                for (int l = 1; l < level[j]; ++l)
+                    r *= BENCH_SCENE_RING_STEP;
+                const float around = 6.2831853f * ((j - 1) % BENCH_SCENE_BRANCHING) / BENCH_SCENE_BRANCHING
+                    + random_float(random, -0.3f, 0.3f);
+                trs_translate_rotate_Z(&local, r * cosf(around), r * sinf(around), 0.f, turn, 1.f);
+            }
+            transform_hierarchy_add(&bs->hierarchy, j ? first + parent : TRANSFORM_NO_PARENT, &local);
+            bs->base_turn[node] = turn;
+            // Interior nodes spin, deeper ones faster, neighbours in opposite directions
+            const bool interior = BENCH_SCENE_BRANCHING * j + 1 < per_cluster;
+            const float rate = 0.25f + 0.15f * level[j];
+            bs->spin[node] = p->dynamic && interior ? (node & 1 ? rate : -rate) : 0.f;
+            bs->moving += bs->spin[node] != 0.f;
+        }
+    }
+    free(level);
+    transform_hierarchy_update(&bs->hierarchy);
+    for (uint32_t i = 0; i < bs->count; ++i)
+    {
+        const trs* world = &bs->hierarchy.world[i];
+        bs->x[i] = world->t[0];
+        bs->y[i] = world->t[1];
+        bs->z[i] = world->t[2];
+        bs->angle[i] = 2.f * atan2f(world->r[2], world->r[3]);
+    }
+    return true;
+}
+
+bool bench_scene_generate(BenchScene* bs, const BenchSceneParams* params, float mesh_radius)
+{
+    memset(bs, 0, sizeof(*bs));
+    bs->params = *params;
+    BenchSceneParams* p = &bs->params;
+    p->meshes = p->meshes ? p->meshes : 1;
+    p->materials = p->materials ? p->materials : 1;
+    p->translucent = p->translucent < 0.f ? 0.f : p->translucent > 1.f ? 1.f : p->translucent;
+    p->depth = p->depth > BENCH_SCENE_MAX_DEPTH ? BENCH_SCENE_MAX_DEPTH : p->depth;
+    if (p->objects < 1 || p->objects > BENCH_SCENE_MAX_OBJECTS)
+    {
+        fprintf(stderr, "bench_scene: %u objects; 1 to %u can be made\n", p->objects, BENCH_SCENE_MAX_OBJECTS);
+        return false;
+    }
+    const uint32_t count = p->objects;
+    bs->count = count;
+    bs->x = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    bs->y = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    bs->z = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    bs->angle = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    bs->scale = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    bs->radius = (float*)linmath_aligned_alloc(sizeof(float) * count, LINMATH_BATCH_ALIGN);
+    bs->mesh = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    bs->material = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    bs->bounds = (Aabb*)malloc(sizeof(Aabb) * count);
+    bs->translucent = (uint8_t*)malloc(count);
+    bs->base_turn = p->depth ? (float*)malloc(sizeof(float) * count) : NULL;
+    bs->spin = p->depth ? (float*)malloc(sizeof(float) * count) : NULL;
+    if (!bs->x || !bs->y || !bs->z || !bs->angle || !bs->scale || !bs->radius || !bs->mesh || !bs->material
+        || !bs->bounds || !bs->translucent || (p->depth && (!bs->base_turn || !bs->spin)))
+    {
+        fprintf(stderr, "bench_scene: out of memory for %u objects\n", count);
+        bench_scene_destroy(bs);
+        return false;
+    }
+
+    uint32_t random = p->seed * 2654435761u + 1u;
+    if (p->depth)
+    {
+        if (!bench_scene_forest(bs, &random))
+        {
+            fprintf(stderr, "bench_scene: out of memory for the hierarchy\n");
+            bench_scene_destroy(bs);
+            return false;
+        }
+    }
+    else
+    {
+        const int cols = (int)ceil(sqrt((double)count));
+        const float cell = 2.f / cols;
+        bs->object_scale = count > 1 ? cell * 0.5f : 1.f;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            bs->x[i] = count > 1 ? -1.f + cell * (i % cols + 0.5f) : 0.f;
+            bs->y[i] = count > 1 ? -1.f + cell * (i / cols + 0.5f) : 0.f;
+            bs->z[i] = 0.f;
+            bs->angle[i] = random_float(&random, -3.14159265f, 3.14159265f);
+        }
+    }
+
+    // Which mesh and material each wears, and whether it's translucent: drawn independently, so no knob's pattern
+    // lines up with another's
+    const uint32_t threshold = (uint32_t)(p->translucent * 16777216.f);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        bs->scale[i] = bs->object_scale;
+        bs->radius[i] = mesh_radius * bs->object_scale;
+        bs->mesh[i] = random_u32(&random) % p->meshes;
+        bs->material[i] = random_u32(&random) % p->materials;
+        bs->translucent[i] = random_u32(&random) < threshold;
+        bs->translucent_count += bs->translucent[i];
+        bench_scene_box(bs, i);
+    }
+    return true;
+}
+
+void bench_scene_destroy(BenchScene* bs)
+{
+    linmath_aligned_free(bs->x);
+    linmath_aligned_free(bs->y);
+    linmath_aligned_free(bs->z);
+    linmath_aligned_free(bs->angle);
+    linmath_aligned_free(bs->scale);
+    linmath_aligned_free(bs->radius);
+    free(bs->mesh);
+    free(bs->material);
+    free(bs->bounds);
+    free(bs->translucent);
+    free(bs->base_turn);
+    free(bs->spin);
+    if (bs->hierarchy.capacity)
+        transform_hierarchy_destroy(&bs->hierarchy);
+    memset(bs, 0, sizeof(*bs));
+}
+
+void bench_scene_animate(BenchScene* bs, double seconds)
+{
+    if (!bs->moving)
+        return;
+    TransformHierarchy* h = &bs->hierarchy;
+    for (uint32_t i = 0; i < bs->count; ++i)
+    {
+        if (bs->spin[i] == 0.f)
+            continue;
+        trs local = h->local[i];
+        const float turn = (float)fmod(bs->base_turn[i] + bs->spin[i] * seconds, 2.0 * 3.14159265358979323846);
+        local.r[2] = linmath_sinf(turn * 0.5f);
+        local.r[3] = linmath_cosf(turn * 0.5f);
+        transform_hierarchy_set_local(h, i, &local);
+    }
+    transform_hierarchy_update(h);
+    for (uint32_t i = 0; i < bs->count; ++i)
+    {
+        bs->x[i] = h->world[i].t[0];
+        bs->y[i] = h->world[i].t[1];
+        bs->z[i] = h->world[i].t[2];
+        bench_scene_box(bs, i);
+    }
+}
+
+void bench_scene_entities(const BenchScene* bs, SceneEntities* entities)
+{
+    entities->count = bs->count;
+    entities->x = bs->x;
+    entities->y = bs->y;
+    entities->z = bs->z;
+    entities->angle = bs->angle;
+    entities->scale = bs->scale;
+    entities->mesh = bs->mesh;
+    entities->material = bs->material;
+    entities->radius = bs->radius;
+    entities->bounds = bs->bounds;
+}
+
+void bench_scene_print(const BenchScene* bs, FILE* out)
+{
+    const BenchSceneParams* p = &bs->params;
+    fprintf(out, "bench scene %s: %u objects, %u meshes, %u materials, %u lights, %u translucent", p->name, bs->count,
+        p->meshes, p->materials, p->lights, bs->translucent_count);
+    if (p->depth)
+        fprintf(out, ", %u levels deep (%u moving)", p->depth, bs->moving);
+    fprintf(out, "\n");
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "scene/bvh.h"
+#include "scene/scene_file.h"
+#include "scene/transform_hierarchy.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Synthetic benchmark scenes: the same knobs turned up and down, so a feature's
+// cost can be measured as a curve rather than at the one size the default grid
+// happens to be. A scene is made from BenchSceneParams, usually a named preset
+// with some of its knobs overridden ("100k-dynamic-hierarchy,objects=250000").
+//
+// Everything comes from the seed, so a preset is the same scene on every run
+// and every machine. Flat scenes (depth 0) lay their objects out on a grid
+// covering [-1, 1], as the default scene does. With a depth, the objects are
+// the nodes of a forest (scene/transform_hierarchy.h): a root per grid cell,
+// each with BENCH_SCENE_BRANCHING children, down "depth" levels, every child
+// a step around its parent on a shrinking ring. A dynamic one turns every
+// interior node about its parent at its own rate, so bench_scene_animate moves
+// nearly every object each tick through the whole chain above it.
+//
+// The arrays are the scene file's entities (scene/scene_file.h): a scene can be
+// written out, or drawn in place. Meshes and materials are indices below the
+// counts asked for; "translucent" marks the share of objects that would draw
+// blended, spread through the scene rather than grouped.
+
+#define BENCH_SCENE_BRANCHING 3
+#define BENCH_SCENE_MAX_DEPTH 8
+#define BENCH_SCENE_MAX_OBJECTS (1u << 24)
+
+typedef struct BenchSceneParams
+{
+    const char* name;           // the preset's; "custom" once a knob is changed
+    uint32_t objects;
+    uint32_t meshes;            // distinct mesh indices handed out, at least 1
+    uint32_t materials;         // distinct material indices, at least 1
+    uint32_t lights;            // point lights for the renderer to add; the scene itself has none
+    float translucent;          // 0 to 1: the share of objects marked translucent
+    uint32_t depth;             // hierarchy levels under each root, 0 for a flat scene
+    bool dynamic;               // a hierarchy's interior nodes turn every tick
+    uint32_t seed;
+} BenchSceneParams;
+
+extern const BenchSceneParams bench_scene_presets[];
+extern const int bench_scene_preset_count;
+
+typedef struct BenchScene
+{
+    BenchSceneParams params;
+    uint32_t count;
+    float object_scale;         // every object's: half the spacing of the finest level
+    float* x;                   // the entities: positions, turns about Z, scales, radii and boxes, world space
+    float* y;
+    float* z;
+    float* angle;
+    float* scale;
+    uint32_t* mesh;
+    uint32_t* material;
+    float* radius;
+    Aabb* bounds;
+    uint8_t* translucent;       // 1 for a translucent object
+    uint32_t translucent_count;
+    TransformHierarchy hierarchy;   // depth > 0: node i is object i; empty for a flat scene
+    float* base_turn;           // depth > 0: each node's turn about its parent at time 0
+    float* spin;                // depth > 0: radians per second each node turns; 0 for leaves and static scenes
+    uint32_t moving;            // nodes that spin
+} BenchScene;
+
+// "spec" is a preset's name, then any of objects=N, meshes=N, materials=N, lights=N, translucent=F, depth=N,
+// dynamic=0|1 and seed=N, comma-separated. Logs and returns false for an unknown preset or knob.
+bool bench_scene_parse(const char* spec, BenchSceneParams* params);
+
+// The presets and their knobs, a line each
+void bench_scene_print_presets(FILE* out);
+
+// Builds the scene "params" describes for a mesh whose bounding circle around its origin has "mesh_radius" (the
+// boxes and radii are that, scaled). Logs and returns false when out of memory or for an object count over
+// BENCH_SCENE_MAX_OBJECTS.
+bool bench_scene_generate(BenchScene* bs, const BenchSceneParams* params, float mesh_radius);
+void bench_scene_destroy(BenchScene* bs);
+
+// A dynamic hierarchy's pose at "seconds": the spinning nodes turned, the world transforms updated, and every
+// object's position and box rewritten (their angles are left as generated). Nothing for a static scene.
+void bench_scene_animate(BenchScene* bs, double seconds);
+
+// The scene's arrays as a scene file's entities
+void bench_scene_entities(const BenchScene* bs, SceneEntities* entities);
+
+// One line: the knobs and what was made of them
+void bench_scene_print(const BenchScene* bs, FILE* out);
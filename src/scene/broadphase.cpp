@@ -0,0 +1,234 @@
+#include "scene/broadphase.h"
+
+#include "core/job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool list_reserve(BroadphaseList* list, uint32_t count)
+{
+    if (count <= list->capacity)
+        return true;
+    uint32_t grown = list->capacity ? list->capacity : 256;
+    while (grown < count)
+        grown *= 2;
+    uint64_t* p = (uint64_t*)realloc(list->pairs, sizeof(uint64_t) * grown);
+    if (!p)
+        return false;
+    list->pairs = p;
+    list->capacity = grown;
+    return true;
+}
+
+bool broadphase_init(Broadphase* bp, uint32_t capacity, int thread_count)
+{
+    memset(bp, 0, sizeof(*bp));
+    bp->thread_count = thread_count > 0 ? thread_count : 1;
+    bp->last = (Aabb*)malloc(sizeof(Aabb) * (capacity + 1));
+    bp->moved = (uint8_t*)malloc(capacity + 1);
+    bp->found = (BroadphaseList*)calloc((size_t)bp->thread_count + 1, sizeof(BroadphaseList));
+    if (!bp->last || !bp->moved || !bp->found)
+    {
+        fprintf(stderr, "broadphase: out of memory for %u objects\n", capacity);
+        broadphase_destroy(bp);
+        return false;
+    }
+    bp->capacity = capacity;
+    return true;
+}
+
+void broadphase_destroy(Broadphase* bp)
+{
+    if (bp->found)
+    {
+        for (int t = 0; t <= bp->thread_count; ++t)
+            free(bp->found[t].pairs);
+    }
+    free(bp->found);
+    free(bp->last);
+    free(bp->moved);
+    free(bp->pairs.pairs);
+    free(bp->next.pairs);
+    memset(bp, 0, sizeof(*bp));
+}
+
+void broadphase_reset(Broadphase* bp)
+{
+    bp->count = 0;
+    bp->pairs.count = 0;
+}
+
+typedef struct BroadphaseUpdate
+{
+    Broadphase* bp;
+    const SpatialGrid* grid;
+    const Aabb* bounds;
+    bool everything;            // a new count: nothing to compare with
+    bool parallel;
+    uint32_t moved;             // counted by the compare, atomically when parallel
+    uint64_t visited;
+} BroadphaseUpdate;
+
+// Which of [begin, end) moved since the last update, and their boxes kept for the next one
+static void update_compare_range(void* data, size_t begin, size_t end)
+{
+    BroadphaseUpdate* u = (BroadphaseUpdate*)data;
+    Broadphase* bp = u->bp;
+    uint32_t moved = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const bool changed = u->everything || memcmp(&bp->last[i], &u->bounds[i], sizeof(Aabb)) != 0;
+        bp->moved[i] = changed;
+        if (changed)
+        {
+            bp->last[i] = u->bounds[i];
+            ++moved;
+        }
+    }
+    if (u->parallel)
+        std::atomic_ref<uint32_t>(u->moved).fetch_add(moved, std::memory_order_relaxed);
+    else
+        u->moved += moved;
+}
+
+typedef struct BroadphaseQuery
+{
+    const Broadphase* bp;
+    BroadphaseList* out;
+    uint32_t object;
+    uint64_t visited;
+    uint64_t dropped;
+} BroadphaseQuery;
+
+// Every object the grid finds over a moved object's box overlaps it; the pair is this object's unless the other
+// moved too and comes first
+static void query_visit(void* user, uint32_t other, const Aabb* bounds)
+{
+    BroadphaseQuery* q = (BroadphaseQuery*)user;
+    ++q->visited;
+    if (other == q->object || (other < q->object && q->bp->moved[other]))
+        return;
+    if (!list_reserve(q->out, q->out->count + 1))
+    {
+        ++q->dropped;
+        return;
+    }
+    const uint32_t a = other < q->object ? other : q->object, b = other < q->object ? q->object : other;
+    q->out->pairs[q->out->count++] = (uint64_t)a << 32 | b;
+}
+
+static void update_query_range(void* data, size_t begin, size_t end)
+{
+    BroadphaseUpdate* u = (BroadphaseUpdate*)data;
+    Broadphase* bp = u->bp;
+    const int t = job_thread_current();
+    BroadphaseQuery q = { bp, &bp->found[t >= 0 && t < bp->thread_count ? t : bp->thread_count], 0, 0, 0 };
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (!bp->moved[i])
+            continue;
+        q.object = (uint32_t)i;
+        spatial_grid_visit_box(u->grid, u->bounds[i].min, u->bounds[i].max, query_visit, &q);
+    }
+    if (u->parallel)
+    {
+        std::atomic_ref<uint64_t>(u->visited).fetch_add(q.visited, std::memory_order_relaxed);
+        std::atomic_ref<uint64_t>(bp->dropped).fetch_add(q.dropped, std::memory_order_relaxed);
+    }
+    else
+    {
+        u->visited += q.visited;
+        bp->dropped += q.dropped;
+    }
+}
+
+static void update_pass(JobSystem* jobs, bool parallel, JobRangeFunction function, BroadphaseUpdate* u, size_t count)
+{
+    if (parallel)
+        job_wait(jobs, job_parallel_for(jobs, function, u, count, BROADPHASE_GRAIN));
+    else
+        function(u, 0, count);
+}
+
+void broadphase_update(Broadphase* bp, const SpatialGrid* grid, const Aabb* bounds, uint32_t count, JobSystem* jobs)
+{
+    if (count > bp->capacity)
+    {
+        fprintf(stderr, "broadphase: %u objects over a capacity of %u, the rest left out\n", count, bp->capacity);
+        count = bp->capacity;
+    }
+    BroadphaseUpdate u = { bp, grid, bounds, count != bp->count,
+        jobs && jobs->thread_count > 1 && count > BROADPHASE_GRAIN, 0, 0 };
+    if (u.everything)
+        bp->pairs.count = 0;
+    bp->count = count;
+    ++bp->updates;
+    update_pass(jobs, u.parallel, update_compare_range, &u, count);
+    bp->moved_count = u.moved;
+    bp->kept = bp->pairs.count;
+    bp->began = bp->ended = 0;
+    bp->visited = 0;
+    if (!u.moved)
+        return;     // every pair as it was
+    for (int t = 0; t <= bp->thread_count; ++t)
+        bp->found[t].count = 0;
+    update_pass(jobs, u.parallel, update_query_range, &u, count);
+    bp->visited = u.visited;
+
+    // The pairs of two unmoved objects, still in order, then everything the queries found, sorted
+    uint32_t found = 0;
+    for (int t = 0; t <= bp->thread_count; ++t)
+        found += bp->found[t].count;
+    if (!list_reserve(&bp->next, bp->pairs.count + found))
+    {
+        bp->dropped += found;
+        found = 0;
+    }
+    uint64_t* next = bp->next.pairs;
+    uint32_t kept = 0;
+    for (uint32_t p = 0; p < bp->pairs.count; ++p)
+    {
+        const uint64_t pair = bp->pairs.pairs[p];
+        if (!bp->moved[broadphase_pair_first(pair)] && !bp->moved[broadphase_pair_second(pair)])
+            next[kept++] = pair;
+    }
+    uint64_t* fresh = next + kept;
+    uint32_t n = 0;
+    for (int t = 0; t <= bp->thread_count && found; ++t)
+    {
+        if (bp->found[t].count)     // a thread that found nothing may have no list allocated
+            memcpy(fresh + n, bp->found[t].pairs, sizeof(uint64_t) * bp->found[t].count);
+        n += bp->found[t].count;
+    }
+    std::sort(fresh, fresh + n);
+
+    // Against the last list's pairs with a moved object: what's only in one of them began or ended
+    uint32_t began = 0, ended = 0, f = 0;
+    for (uint32_t p = 0; p < bp->pairs.count; ++p)
+    {
+        const uint64_t pair = bp->pairs.pairs[p];
+        if (!bp->moved[broadphase_pair_first(pair)] && !bp->moved[broadphase_pair_second(pair)])
+            continue;
+        while (f < n && fresh[f] < pair)
+        {
+            ++began;
+            ++f;
+        }
+        if (f < n && fresh[f] == pair)
+            ++f;
+        else
+            ++ended;
+    }
+    began += n - f;
+    std::inplace_merge(next, fresh, fresh + n);
+    bp->next.count = kept + n;
+    const BroadphaseList swap = bp->pairs;
+    bp->pairs = bp->next;
+    bp->next = swap;
+    bp->kept = kept;
+    bp->began = began;
+    bp->ended = ended;
+}
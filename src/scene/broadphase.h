@@ -0,0 +1,85 @@
+#pragma once
+
+#include "scene/bvh.h"
+#include "scene/spatial_grid.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct JobSystem JobSystem;
+
+// Collision broadphase over the scene's own spatial hash grid
+// (scene/spatial_grid.h): every pair of objects whose AABBs overlap, found
+// through the grid the renderer culls and picks with. There's no second
+// index to build or keep in memory, only the pair list and a copy of each
+// object's box as of the last update.
+//
+// That copy is what makes a mostly static scene cheap. An update compares
+// every box with it: a pair of objects neither of which moved overlapped
+// last time and still does, so it's kept from the last list untested. Only
+// the objects that moved query the grid, over their own box, and a pair of
+// two that both moved is taken from the lower-numbered one's query. With
+// nothing moving an update is the compare and a copy of the list.
+//
+// The queries run over a job system, each thread appending to a list of its
+// own; the lists are sorted and merged with the kept pairs into one sorted
+// list, so the pairs come out the same on any thread count. The merge
+// against the last list counts the pairs that began and ended, the contacts
+// a narrowphase would create and drop. The grid has to have been built over
+// the same boxes, as scene_simulate's rebuild after a tick leaves it.
+
+#define BROADPHASE_GRAIN 4096       // objects per job in the compare and the queries
+
+// A pair: the lower object index in the high 32 bits, the higher in the low ones
+static inline uint32_t broadphase_pair_first(uint64_t pair)
+{
+    return (uint32_t)(pair >> 32);
+}
+
+static inline uint32_t broadphase_pair_second(uint64_t pair)
+{
+    return (uint32_t)pair;
+}
+
+typedef struct BroadphaseList
+{
+    uint64_t* pairs;
+    uint32_t count;
+    uint32_t capacity;
+} BroadphaseList;
+
+typedef struct Broadphase
+{
+    uint32_t capacity;          // objects
+    uint32_t count;             // as of the last update, 0 before the first
+    Aabb* last;                 // [capacity]: each object's box at the last update
+    uint8_t* moved;             // [capacity]: whether it changed since, this update
+    BroadphaseList pairs;       // overlapping, sorted
+    BroadphaseList next;        // built by an update, then swapped with "pairs"
+    BroadphaseList* found;      // [thread_count + 1]: each job thread's queries' pairs, the last one for other threads
+    int thread_count;
+
+    // The last update's
+    uint32_t moved_count;
+    uint32_t kept;              // pairs carried over untested
+    uint32_t began;             // pairs that weren't in the list before
+    uint32_t ended;             // that were and no longer are
+    uint64_t visited;           // overlaps the queries came across, a pair of two moved objects twice
+
+    // Over its life
+    uint64_t updates;
+    uint64_t dropped;           // pairs lost to running out of memory
+} Broadphase;
+
+// Room for "capacity" objects, with lists for "thread_count" job threads (the job system's; fewer is fine, the rest
+// share one). Logs and returns false when out of memory.
+bool broadphase_init(Broadphase* bp, uint32_t capacity, int thread_count);
+void broadphase_destroy(Broadphase* bp);
+
+// Brings the pairs up to date with "bounds[0..count)" (count <= capacity), which "grid" was last built over; on
+// "jobs" when given (called from a thread running in it), serially otherwise. A new count starts over: every
+// object is taken to have moved.
+void broadphase_update(Broadphase* bp, const SpatialGrid* grid, const Aabb* bounds, uint32_t count, JobSystem* jobs);
+
+// Forgets the pairs and the boxes: the next update tests every object, as the first one does
+void broadphase_reset(Broadphase* bp);
@@ -0,0 +1,393 @@
+#include "scene/bvh.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BVH_BINS 12
+
+static void aabb_empty(vec3 min, vec3 max)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        min[k] = FLT_MAX;
+        max[k] = -FLT_MAX;
+    }
+}
+
+static void aabb_grow(vec3 min, vec3 max, const vec3 bmin, const vec3 bmax)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        min[k] = fminf(min[k], bmin[k]);
+        max[k] = fmaxf(max[k], bmax[k]);
+    }
+}
+
+static float aabb_half_area(const vec3 min, const vec3 max)
+{
+    const float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+    return dx < 0.f ? 0.f : dx * dy + dy * dz + dz * dx;
+}
+
+static float centroid(const Aabb* b, int axis)
+{
+    return 0.5f * (b->min[axis] + b->max[axis]);
+}
+
+bool bvh_init(Bvh* bvh, uint32_t capacity)
+{
+    memset(bvh, 0, sizeof(*bvh));
+    const size_t max_nodes = capacity ? 2 * (size_t)capacity - 1 : 1;
+    bvh->nodes = (BvhNode*)malloc(sizeof(BvhNode) * max_nodes);
+    bvh->next_nodes = (BvhNode*)malloc(sizeof(BvhNode) * max_nodes);
+    bvh->items = (uint32_t*)malloc(sizeof(uint32_t) * (capacity + 1));
+    bvh->next_items = (uint32_t*)malloc(sizeof(uint32_t) * (capacity + 1));
+    bvh->item_bounds = (Aabb*)malloc(sizeof(Aabb) * (capacity + 1));
+    bvh->next_bounds = (Aabb*)malloc(sizeof(Aabb) * (capacity + 1));
+    bvh->tasks = (BvhBuildTask*)malloc(sizeof(BvhBuildTask) * (capacity + 1));
+    if (!bvh->nodes || !bvh->next_nodes || !bvh->items || !bvh->next_items || !bvh->item_bounds || !bvh->next_bounds || !bvh->tasks)
+    {
+        fprintf(stderr, "bvh: out of memory for %u objects\n", capacity);
+        bvh_destroy(bvh);
+        return false;
+    }
+    bvh->capacity = capacity;
+    return true;
+}
+
+void bvh_init_view(Bvh* bvh, const BvhNode* nodes, uint32_t node_count, const uint32_t* items,
+    const Aabb* item_bounds, uint32_t count)
+{
+    memset(bvh, 0, sizeof(*bvh));
+    // Queries only read through these; nothing that writes them is allowed on a view
+    bvh->nodes = (BvhNode*)nodes;
+    bvh->node_count = node_count;
+    bvh->items = (uint32_t*)items;
+    bvh->item_bounds = (Aabb*)item_bounds;
+    bvh->item_count = bvh->capacity = count;
+    bvh->view = true;
+}
+
+void bvh_destroy(Bvh* bvh)
+{
+    if (bvh->view)
+    {
+        memset(bvh, 0, sizeof(*bvh));
+        return;
+    }
+    free(bvh->nodes);
+    free(bvh->next_nodes);
+    free(bvh->items);
+    free(bvh->next_items);
+    free(bvh->item_bounds);
+    free(bvh->next_bounds);
+    free(bvh->tasks);
+    memset(bvh, 0, sizeof(*bvh));
+}
+
+// Turns one pending node into a leaf, or splits its items with binned SAH and queues both children. The build
+// works on next_bounds, a copy of the bounds in item order, so every pass over a node's items is sequential.
+static void split_task(Bvh* bvh, BvhBuildTask task)
+{
+    BvhNode* node = &bvh->next_nodes[task.node];
+    uint32_t* items = bvh->next_items + task.first;
+    Aabb* boxes = bvh->next_bounds + task.first;
+    vec3 cmin, cmax;
+    aabb_empty(node->min, node->max);
+    aabb_empty(cmin, cmax);
+    for (uint32_t i = 0; i < task.count; ++i)
+    {
+        aabb_grow(node->min, node->max, boxes[i].min, boxes[i].max);
+        for (int k = 0; k < 3; ++k)
+        {
+            const float c = centroid(&boxes[i], k);
+            cmin[k] = fminf(cmin[k], c);
+            cmax[k] = fmaxf(cmax[k], c);
+        }
+    }
+    if (task.count <= BVH_LEAF_SIZE || task.depth + 1 >= BVH_MAX_DEPTH)
+    {
+        node->first = task.first;
+        node->count = task.count;
+        return;
+    }
+
+    int axis = 0;
+    for (int k = 1; k < 3; ++k)
+        if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis])
+            axis = k;
+    const float extent = cmax[axis] - cmin[axis];
+
+    uint32_t mid = task.count / 2;      // fallback when every centroid coincides or SAH can't separate them
+    if (extent > 0.f)
+    {
+        // Bin centroids along the widest axis, then pick the bin boundary with the lowest SAH cost
+        uint32_t bin_count[BVH_BINS] = {};
+        vec3 bin_min[BVH_BINS], bin_max[BVH_BINS];
+        for (int b = 0; b < BVH_BINS; ++b)
+            aabb_empty(bin_min[b], bin_max[b]);
+        const float to_bin = BVH_BINS * (1.f - 1e-6f) / extent;
+        for (uint32_t i = 0; i < task.count; ++i)
+        {
+            const int b = (int)((centroid(&boxes[i], axis) - cmin[axis]) * to_bin);
+            ++bin_count[b];
+            aabb_grow(bin_min[b], bin_max[b], boxes[i].min, boxes[i].max);
+        }
+
+        float right_area[BVH_BINS];
+        uint32_t right_count[BVH_BINS];
+        vec3 rmin, rmax;
+        aabb_empty(rmin, rmax);
+        uint32_t n = 0;
+        for (int b = BVH_BINS - 1; b > 0; --b)
+        {
+            aabb_grow(rmin, rmax, bin_min[b], bin_max[b]);
+            n += bin_count[b];
+            right_area[b] = aabb_half_area(rmin, rmax);
+            right_count[b] = n;
+        }
+        vec3 lmin, lmax;
+        aabb_empty(lmin, lmax);
+        n = 0;
+        float best_cost = FLT_MAX;
+        int best_split = 0;
+        for (int b = 1; b < BVH_BINS; ++b)
+        {
+            aabb_grow(lmin, lmax, bin_min[b - 1], bin_max[b - 1]);
+            n += bin_count[b - 1];
+            if (n == 0 || right_count[b] == 0)
+                continue;
+            const float cost = aabb_half_area(lmin, lmax) * n + right_area[b] * right_count[b];
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_split = b;
+            }
+        }
+
+        if (best_split > 0)
+        {
+            // In-place partition: items binned left of the split move to the front, their bounds with them
+            uint32_t lo = 0, hi = task.count;
+            while (lo < hi)
+            {
+                const int b = (int)((centroid(&boxes[lo], axis) - cmin[axis]) * to_bin);
+                if (b < best_split)
+                    ++lo;
+                else
+                {
+                    --hi;
+                    const uint32_t t = items[lo];
+                    items[lo] = items[hi];
+                    items[hi] = t;
+                    const Aabb box = boxes[lo];
+                    boxes[lo] = boxes[hi];
+                    boxes[hi] = box;
+                }
+            }
+            mid = lo;
+        }
+    }
+
+    const uint32_t left = bvh->next_node_count;
+    bvh->next_node_count += 2;
+    node->first = left;
+    node->count = 0;
+    // Right pushed first so the left subtree is split next: depth-first keeps the task list short
+    bvh->tasks[bvh->task_count++] = { left + 1, task.first + mid, task.count - mid, task.depth + 1 };
+    bvh->tasks[bvh->task_count++] = { left, task.first, mid, task.depth + 1 };
+}
+
+void bvh_rebuild_begin(Bvh* bvh, const Aabb* bounds)
+{
+    for (uint32_t i = 0; i < bvh->item_count; ++i)
+    {
+        bvh->next_items[i] = i;
+        bvh->next_bounds[i] = bounds[i];
+    }
+    bvh->next_node_count = bvh->item_count ? 1 : 0;
+    bvh->task_count = 0;
+    if (bvh->item_count)
+        bvh->tasks[bvh->task_count++] = { 0, 0, bvh->item_count, 0 };
+    bvh->rebuilding = true;
+}
+
+bool bvh_rebuild_step(Bvh* bvh, const Aabb* bounds, uint32_t max_items)
+{
+    if (!bvh->rebuilding)
+        return false;
+    // Work is measured in items visited; a step always finishes at least one node
+    uint32_t work = 0;
+    while (bvh->task_count > 0 && (work == 0 || work < max_items))
+    {
+        const BvhBuildTask task = bvh->tasks[--bvh->task_count];
+        work += task.count;
+        split_task(bvh, task);
+    }
+    if (bvh->task_count > 0)
+        return false;
+
+    BvhNode* nodes = bvh->nodes;
+    bvh->nodes = bvh->next_nodes;
+    bvh->next_nodes = nodes;
+    uint32_t* items = bvh->items;
+    bvh->items = bvh->next_items;
+    bvh->next_items = items;
+    bvh->node_count = bvh->next_node_count;
+    bvh->rebuilding = false;
+    bvh_refit(bvh, bounds);     // objects may have moved while the build was spread over frames
+    return true;
+}
+
+void bvh_build(Bvh* bvh, const Aabb* bounds, uint32_t count)
+{
+    bvh->item_count = count < bvh->capacity ? count : bvh->capacity;
+    bvh_rebuild_begin(bvh, bounds);
+    bvh_rebuild_step(bvh, bounds, UINT32_MAX);
+}
+
+void bvh_refit(Bvh* bvh, const Aabb* bounds)
+{
+    for (uint32_t i = 0; i < bvh->item_count; ++i)
+        bvh->item_bounds[i] = bounds[bvh->items[i]];
+    // Children always follow their parent, so one backwards pass sees every child before its parent
+    for (uint32_t n = bvh->node_count; n-- > 0;)
+    {
+        BvhNode* node = &bvh->nodes[n];
+        aabb_empty(node->min, node->max);
+        if (node->count)
+        {
+            for (uint32_t i = node->first; i < node->first + node->count; ++i)
+                aabb_grow(node->min, node->max, bvh->item_bounds[i].min, bvh->item_bounds[i].max);
+        }
+        else
+        {
+            aabb_grow(node->min, node->max, bvh->nodes[node->first].min, bvh->nodes[node->first].max);
+            aabb_grow(node->min, node->max, bvh->nodes[node->first + 1].min, bvh->nodes[node->first + 1].max);
+        }
+    }
+}
+
+size_t bvh_cull(const Bvh* bvh, const Frustum* frustum, uint32_t* visible)
+{
+    if (!bvh->node_count)
+        return 0;
+    struct Entry { uint32_t node; int mask; } stack[BVH_MAX_DEPTH + 1];
+    int top = 0;
+    stack[top++] = { 0, 0x3F };
+    size_t n = 0;
+    while (top > 0)
+    {
+        const Entry entry = stack[--top];
+        const BvhNode* node = &bvh->nodes[entry.node];
+        const int mask = frustum_aabb_planes(frustum, node->min, node->max, entry.mask);
+        if (mask < 0)
+            continue;
+        if (mask == 0)
+        {
+            // Inside every plane: a subtree's items are contiguous, from its leftmost to its rightmost leaf
+            const BvhNode* lo = node;
+            const BvhNode* hi = node;
+            while (!lo->count)
+                lo = &bvh->nodes[lo->first];
+            while (!hi->count)
+                hi = &bvh->nodes[hi->first + 1];
+            const uint32_t end = hi->first + hi->count;
+            memcpy(visible + n, bvh->items + lo->first, sizeof(uint32_t) * (end - lo->first));
+            n += end - lo->first;
+        }
+        else if (node->count)
+        {
+            for (uint32_t i = node->first; i < node->first + node->count; ++i)
+            {
+                visible[n] = bvh->items[i];
+                n += frustum_aabb_planes(frustum, bvh->item_bounds[i].min, bvh->item_bounds[i].max, mask) >= 0;
+            }
+        }
+        else
+        {
+            stack[top++] = { node->first + 1, mask };
+            stack[top++] = { node->first, mask };
+        }
+    }
+    return n;
+}
+
+// Slab test: entry distance of the ray into the box within [0, max_t], or FLT_MAX for a miss
+static float ray_aabb(const vec3 origin, const vec3 inv_dir, const vec3 min, const vec3 max, float max_t)
+{
+    float t0 = 0.f, t1 = max_t;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float a = (min[k] - origin[k]) * inv_dir[k];
+        const float b = (max[k] - origin[k]) * inv_dir[k];
+        t0 = fmaxf(t0, fminf(a, b));    // fminf/fmaxf drop the NaN of 0 * inf for rays in a slab's plane
+        t1 = fminf(t1, fmaxf(a, b));
+    }
+    return t0 <= t1 ? t0 : FLT_MAX;
+}
+
+int64_t bvh_raycast(const Bvh* bvh, const vec3 origin, const vec3 dir, float max_t, BvhRayHitFunction hit,
+    void* user, float* t)
+{
+    if (!bvh->node_count)
+        return -1;
+    vec3 inv_dir;
+    for (int k = 0; k < 3; ++k)
+        inv_dir[k] = 1.f / dir[k];
+
+    struct Entry { uint32_t node; float t; } stack[BVH_MAX_DEPTH + 1];
+    int top = 0;
+    float best = max_t;
+    int64_t best_object = -1;
+    const float root_t = ray_aabb(origin, inv_dir, bvh->nodes[0].min, bvh->nodes[0].max, best);
+    if (root_t != FLT_MAX)
+        stack[top++] = { 0, root_t };
+    while (top > 0)
+    {
+        const Entry entry = stack[--top];
+        if (entry.t > best)
+            continue;       // something nearer was found after this was pushed
+        const BvhNode* node = &bvh->nodes[entry.node];
+        if (node->count)
+        {
+            for (uint32_t i = node->first; i < node->first + node->count; ++i)
+            {
+                float ti = ray_aabb(origin, inv_dir, bvh->item_bounds[i].min, bvh->item_bounds[i].max, best);
+                if (ti == FLT_MAX)
+                    continue;
+                if (hit)
+                {
+                    ti = hit(user, bvh->items[i], origin, dir);
+                    if (ti < 0.f || ti > best)
+                        continue;
+                }
+                best = ti;
+                best_object = bvh->items[i];
+            }
+            continue;
+        }
+
+        // Visit the nearer child first (pushed last); the farther one is skipped later if a hit beats it
+        const BvhNode* a = &bvh->nodes[node->first];
+        const BvhNode* b = &bvh->nodes[node->first + 1];
+        float ta = ray_aabb(origin, inv_dir, a->min, a->max, best);
+        float tb = ray_aabb(origin, inv_dir, b->min, b->max, best);
+        uint32_t na = node->first, nb = node->first + 1;
+        if (ta > tb)
+        {
+            const float tt = ta; ta = tb; tb = tt;
+            const uint32_t tn = na; na = nb; nb = tn;
+        }
+        if (tb != FLT_MAX)
+            stack[top++] = { nb, tb };
+        if (ta != FLT_MAX)
+            stack[top++] = { na, ta };
+    }
+    if (best_object >= 0)
+        *t = best;
+    return best_object;
+}
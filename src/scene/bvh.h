@@ -0,0 +1,105 @@
+#pragma once
+
+#include "linmath.h"
+#include "scene/frustum.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounding volume hierarchy over object AABBs, for culling and picking without visiting every object.
+//
+// Nodes live in one flat array of 32-byte records (two per cache line). A node's children are always
+// adjacent, at "first" and "first + 1", and children come after their parent, so a refit is a single
+// backwards sweep. Leaves reference a range of "items" (object indices). The bounds of the items are
+// copied into leaf order next to them, so a query only touches memory that belongs to the nodes it
+// visits. Builds use binned SAH.
+//
+// Moving objects: bvh_refit updates the bounds in place and keeps the tree shape. That is cheap, but
+// the tree degrades as objects drift away from where they were at build time. bvh_rebuild_begin and
+// bvh_rebuild_step build a fresh tree alongside the live one, with a bounded amount of work per call,
+// which spreads the rebuild over frames. When it's finished it is refit to the latest bounds and
+// swapped in. Queries keep using the old tree until then.
+
+#define BVH_LEAF_SIZE 4
+#define BVH_MAX_DEPTH 64    // deeper nodes become leaves whatever their size, so query stacks stay fixed-size
+
+typedef struct Aabb
+{
+    vec3 min;
+    vec3 max;
+} Aabb;
+
+typedef struct BvhNode
+{
+    vec3 min;
+    uint32_t first;     // leaf: first entry in items; interior: left child (the right one is first + 1)
+    vec3 max;
+    uint32_t count;     // items in a leaf, 0 for interior nodes
+} BvhNode;
+
+// One pending node of an unfinished build: "count" items from "first" still to be split
+typedef struct BvhBuildTask
+{
+    uint32_t node;
+    uint32_t first;
+    uint32_t count;
+    uint32_t depth;
+} BvhBuildTask;
+
+typedef struct Bvh
+{
+    uint32_t capacity;          // most items the arrays were allocated for
+    uint32_t item_count;
+    BvhNode* nodes;             // live tree
+    uint32_t node_count;
+    uint32_t* items;            // object index per leaf entry
+    Aabb* item_bounds;          // bounds of items[i], in leaf order
+
+    // Incremental rebuild in progress (bvh_rebuild_*): the next tree and its work list
+    BvhNode* next_nodes;
+    uint32_t* next_items;
+    Aabb* next_bounds;          // bounds snapshot taken by bvh_rebuild_begin, permuted along with next_items
+    uint32_t next_node_count;
+    BvhBuildTask* tasks;
+    uint32_t task_count;
+    bool rebuilding;
+    bool view;                  // bvh_init_view's: the arrays are someone else's
+} Bvh;
+
+// Allocates for up to "capacity" objects. Logs and returns false when out of memory.
+bool bvh_init(Bvh* bvh, uint32_t capacity);
+void bvh_destroy(Bvh* bvh);
+
+// A tree built earlier and kept elsewhere (a scene file's mapping, scene/scene_file.h), queried in place:
+// "node_count" nodes over "count" items, laid out as bvh_build leaves them. Only bvh_cull and bvh_raycast may
+// be used on it; bvh_destroy just forgets the arrays.
+void bvh_init_view(Bvh* bvh, const BvhNode* nodes, uint32_t node_count, const uint32_t* items,
+    const Aabb* item_bounds, uint32_t count);
+
+// Builds the whole tree for "bounds[0..count)" now (cancels an unfinished incremental rebuild)
+void bvh_build(Bvh* bvh, const Aabb* bounds, uint32_t count);
+
+// Recomputes every node's bounds from "bounds" (same objects as the last build) without changing the tree
+void bvh_refit(Bvh* bvh, const Aabb* bounds);
+
+// Starts building a replacement tree for the same objects from a snapshot of "bounds"; the live tree keeps
+// answering queries
+void bvh_rebuild_begin(Bvh* bvh, const Aabb* bounds);
+
+// Splits pending nodes of the replacement tree until about "max_items" items have been visited (at least one
+// node per call, so the first steps cost up to the object count). When the tree is complete it is refit to
+// the current "bounds", replaces the live one and this returns true.
+bool bvh_rebuild_step(Bvh* bvh, const Aabb* bounds, uint32_t max_items);
+
+// Writes the index of every object whose AABB may intersect the frustum to "visible" (room for the object
+// count) in tree order; subtrees entirely inside are emitted without testing their items. Returns the count.
+size_t bvh_cull(const Bvh* bvh, const Frustum* frustum, uint32_t* visible);
+
+// Exact test for one object the ray's AABB test hit: returns the hit distance along "dir", or a negative value
+// for a miss. "user" is what was passed to bvh_raycast.
+typedef float (*BvhRayHitFunction)(void* user, uint32_t object, const vec3 origin, const vec3 dir);
+
+// Nearest object hit by origin + t * dir for 0 <= t <= max_t, visiting nodes front to back. Without "hit"
+// the objects' AABBs are the hit shapes. Returns the object index and sets *t, or returns -1.
+int64_t bvh_raycast(const Bvh* bvh, const vec3 origin, const vec3 dir, float max_t, BvhRayHitFunction hit,
+    void* user, float* t);
@@ -0,0 +1,330 @@
+#include "scene/camera.h"
+
+#include <string.h>
+
+void camera_init(Camera* camera, float zoom)
+{
+    camera->width = 0;
+    camera->height = 0;
+    camera->zoom = zoom;
+    camera->projection_type = CAMERA_ORTHOGRAPHIC;
+    camera->fov_y = 1.0471976f;     // 60 degrees
+    camera->near_plane = 0.01f;
+    camera->far_plane = 100.f;
+    dmat4x4_identity(camera->eye_view);
+    camera->origin[0] = camera->origin[1] = camera->origin[2] = 0.0;
+    camera->tile[0] = camera->tile[1] = 0.f;
+    camera->tile[2] = camera->tile[3] = 1.f;
+    mat4x4_identity(camera->view);
+    mat4x4_identity(camera->projection);
+    mat4x4_identity(camera->view_projection);
+    mat4x4_identity(camera->inverse_view_projection);
+    frustum_from_matrix(&camera->frustum, camera->view_projection);
+    camera->stereo_separation = 0.f;
+    camera->stereo_convergence = 1.f;
+    mat4x4_identity(camera->stereo_view_projection[0]);
+    mat4x4_identity(camera->stereo_view_projection[1]);
+    camera->tracked = false;
+    mat4x4_identity(camera->head);
+    memset(camera->eyes, 0, sizeof(camera->eyes));
+    camera->eye_margin = 0.f;
+    camera->version = 0;
+    camera->reversed_z = false;
+    camera->dirty = true;
+}
+
+void camera_set_viewport(Camera* camera, int width, int height)
+{
+    if (width <= 0 || height <= 0 || (width == camera->width && height == camera->height))
+        return;
+    camera->width = width;
+    camera->height = height;
+    camera->dirty = true;
+}
+
+void camera_set_zoom(Camera* camera, float zoom)
+{
+    if (zoom == camera->zoom)
+        return;
+    camera->zoom = zoom;
+    camera->dirty = true;
+}
+
+void camera_set_reversed_z(Camera* camera, bool reversed)
+{
+    if (reversed == camera->reversed_z)
+        return;
+    camera->reversed_z = reversed;
+    camera->dirty = true;
+}
+
+void camera_set_perspective(Camera* camera, float fov_y, float near_plane, float far_plane)
+{
+    if (camera->projection_type == CAMERA_PERSPECTIVE && fov_y == camera->fov_y && near_plane == camera->near_plane
+        && far_plane == camera->far_plane)
+        return;
+    camera->projection_type = CAMERA_PERSPECTIVE;
+    camera->fov_y = fov_y;
+    camera->near_plane = near_plane;
+    camera->far_plane = far_plane;
+    camera->dirty = true;
+}
+
+void camera_set_view(Camera* camera, dmat4x4 const view)
+{
+    if (!memcmp(camera->eye_view, view, sizeof(dmat4x4)))
+        return;
+    dmat4x4_dup(camera->eye_view, view);
+    camera->dirty = true;
+}
+
+void camera_set_origin(Camera* camera, dvec3 const origin)
+{
+    if (!memcmp(camera->origin, origin, sizeof(dvec3)))
+        return;
+    dvec3_dup(camera->origin, origin);
+    camera->dirty = true;
+}
+
+void camera_set_tile(Camera* camera, float x0, float y0, float x1, float y1)
+{
+    const float tile[4] = { x0, y0, x1, y1 };
+    if (!memcmp(camera->tile, tile, sizeof(tile)) || x1 <= x0 || y1 <= y0)
+        return;
+    memcpy(camera->tile, tile, sizeof(tile));
+    camera->dirty = true;
+}
+
+void camera_set_stereo(Camera* camera, float separation, float convergence)
+{
+    if (!(separation > 0.f))
+        separation = 0.f;
+    if (separation == camera->stereo_separation && convergence == camera->stereo_convergence)
+        return;
+    camera->stereo_separation = separation;
+    camera->stereo_convergence = convergence > 0.f ? convergence : 1.f;
+    camera->dirty = true;
+}
+
+void camera_set_eyes(Camera* camera, mat4x4 const head, const CameraEye eyes[2], float margin)
+{
+    if (!eyes)
+    {
+        camera->dirty = camera->dirty || camera->tracked;
+        camera->tracked = false;
+        return;
+    }
+    if (camera->tracked && !memcmp(camera->head, head, sizeof(mat4x4))
+        && !memcmp(camera->eyes, eyes, sizeof(camera->eyes)) && margin == camera->eye_margin)
+        return;
+    camera->tracked = true;
+    mat4x4_dup(camera->head, head);
+    memcpy(camera->eyes, eyes, sizeof(camera->eyes));
+    camera->eye_margin = margin;
+    camera->dirty = true;
+}
+
+// The inverse of a rotation and translation: the rotation transposed, and the translation undone through it
+static void rigid_invert(mat4x4 T, mat4x4 const M)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+            T[i][j] = M[j][i];
+        T[i][3] = 0.f;
+    }
+    for (int j = 0; j < 3; ++j)
+        T[3][j] = -(M[3][0] * M[j][0] + M[3][1] * M[j][1] + M[3][2] * M[j][2]);
+    T[3][3] = 1.f;
+}
+
+void camera_eye_view_projection(const Camera* camera, const CameraEye* eye, mat4x4 view_projection)
+{
+    const float n = camera->near_plane, f = camera->far_plane;
+    const float* t = eye->tangents;
+    mat4x4 projection, view;
+    if (camera->reversed_z)
+        mat4x4_frustum_reversed(projection, t[0] * n, t[1] * n, t[2] * n, t[3] * n, n, f);
+    else
+        mat4x4_frustum(projection, t[0] * n, t[1] * n, t[2] * n, t[3] * n, n, f);
+    rigid_invert(view, eye->pose);
+    mat4x4_mul(view, view, camera->view);
+    mat4x4_mul_restrict(view_projection, projection, view);
+}
+
+// The eyes' view-projections and the frustum around both. The cull eye sits "back" behind the view's eye, far
+// enough that each side of its frustum runs through the eyes' outermost sides at the near and far planes, and its
+// tangents then take in every corner of both eyes' frusta: as posed, and with the head turned "margin" radians
+// left, right, up and down. Should the eyes diverge less than a frustum through the view's eye, the cull eye stays
+// there with its sides opened to the far corners.
+static void camera_update_eyes(Camera* camera, const CameraEye eyes[2], float margin)
+{
+    const float n = camera->near_plane, f = camera->far_plane;
+    const int turns = margin > 0.f ? 5 : 1;
+    vec4 corners[2][5][2][4];   // eye, turn, near or far plane, corner: in the view's space
+    for (int e = 0; e < 2; ++e)
+    {
+        camera_eye_view_projection(camera, &eyes[e], camera->stereo_view_projection[e]);
+        const float* t = eyes[e].tangents;
+        for (int turn = 0; turn < turns; ++turn)
+        {
+            mat4x4 pose;
+            mat4x4_identity(pose);
+            if (turn)
+            {
+                const float angle = turn & 1 ? margin : -margin;
+                if (turn < 3)
+                    mat4x4_rotate_Y(pose, pose, angle);
+                else
+                    mat4x4_rotate_X(pose, pose, angle);
+            }
+            mat4x4_mul(pose, pose, eyes[e].pose);
+            for (int p = 0; p < 2; ++p)
+            {
+                const float depth = p ? f : n;
+                for (int c = 0; c < 4; ++c)
+                {
+                    const vec4 corner = { (c & 1 ? t[1] : t[0]) * depth, (c & 2 ? t[3] : t[2]) * depth, -depth, 1.f };
+                    mat4x4_mul_vec4(corners[e][turn][p][c], pose, corner);
+                }
+            }
+        }
+    }
+
+    // Sides right, left, top and bottom: how far out each reaches at either plane
+    static const int axes[4] = { 0, 0, 1, 1 };
+    static const float signs[4] = { 1.f, -1.f, 1.f, -1.f };
+    float back = 0.f;
+    for (int s = 0; s < 4; ++s)
+    {
+        float reach[2] = { -INFINITY, -INFINITY };
+        for (int e = 0; e < 2; ++e)
+            for (int turn = 0; turn < turns; ++turn)
+                for (int p = 0; p < 2; ++p)
+                    for (int c = 0; c < 4; ++c)
+                        reach[p] = fmaxf(reach[p], signs[s] * corners[e][turn][p][c][axes[s]]);
+        if (reach[1] > reach[0])
+            back = fmaxf(back, reach[0] * (f - n) / (reach[1] - reach[0]) - n);
+    }
+    float tangents[4] = { -INFINITY, -INFINITY, -INFINITY, -INFINITY };
+    float near_depth = INFINITY, far_depth = 0.f;
+    for (int e = 0; e < 2; ++e)
+        for (int turn = 0; turn < turns; ++turn)
+            for (int p = 0; p < 2; ++p)
+                for (int c = 0; c < 4; ++c)
+                {
+                    const float* corner = corners[e][turn][p][c];
+                    const float depth = back - corner[2];
+                    near_depth = fminf(near_depth, depth);
+                    far_depth = fmaxf(far_depth, depth);
+                    for (int s = 0; s < 4; ++s)
+                        tangents[s] = fmaxf(tangents[s], signs[s] * corner[axes[s]] / depth);
+                }
+    mat4x4 cull, view;
+    mat4x4_frustum(cull, -tangents[1] * near_depth, tangents[0] * near_depth, -tangents[3] * near_depth,
+        tangents[2] * near_depth, near_depth, far_depth);
+    mat4x4_dup(view, camera->view);
+    view[3][2] -= back;
+    mat4x4 cull_view_projection;
+    mat4x4_mul_restrict(cull_view_projection, cull, view);
+    frustum_from_matrix(&camera->frustum, cull_view_projection);
+}
+
+// camera_set_stereo's eyes, in the centre eye's space, from an eye's "ratio". The left eye sits half the
+// separation left of the centre one, its frustum shifted right so that its centre line crosses the centre eye's at
+// the convergence distance; the right eye mirrors it.
+static void camera_update_stereo(Camera* camera, float ratio)
+{
+    const float half = 0.5f * camera->stereo_separation;
+    const float top = tanf(camera->fov_y / 2.f), right = top * ratio;
+    const float shift = half / camera->stereo_convergence;
+    CameraEye eyes[2];
+    for (int e = 0; e < 2; ++e)
+    {
+        const float side = e == 0 ? 1.f : -1.f;
+        mat4x4_translate(eyes[e].pose, -side * half, 0.f, 0.f);
+        eyes[e].tangents[0] = -right + side * shift;
+        eyes[e].tangents[1] = right + side * shift;
+        eyes[e].tangents[2] = -top;
+        eyes[e].tangents[3] = top;
+    }
+    camera_update_eyes(camera, eyes, 0.f);
+}
+
+bool camera_update(Camera* camera)
+{
+    if (!camera->dirty || camera->width <= 0 || camera->height <= 0)
+        return false;
+    // The whole view's aspect ratio: the viewport is the tile's share of it
+    const float* tile = camera->tile;
+    const bool stereo = (camera->stereo_separation > 0.f || camera->tracked)
+        && camera->projection_type == CAMERA_PERSPECTIVE;
+    const bool tiled = !stereo && (tile[0] != 0.f || tile[1] != 0.f || tile[2] != 1.f || tile[3] != 1.f);
+    const float ratio = stereo ? camera->width * 0.5f / camera->height
+        : camera->width / (tile[2] - tile[0]) / (camera->height / (tile[3] - tile[1]));
+    mat4x4 inverse_view, inverse_projection;
+    if (camera->projection_type == CAMERA_PERSPECTIVE)
+    {
+        mat4x4_from_dmat4x4_relative(camera->view, camera->eye_view, camera->origin);
+        if (camera->tracked)
+        {
+            // The head's view: the world moves the other way from the head
+            mat4x4 head_view;
+            rigid_invert(head_view, camera->head);
+            mat4x4_mul(camera->view, head_view, camera->view);
+        }
+        if (tiled)
+        {
+            // The off-centre frustum through the tile's part of the near plane
+            const float top = camera->near_plane * tanf(camera->fov_y / 2.f), right = top * ratio;
+            const float l = right * (2.f * tile[0] - 1.f), r = right * (2.f * tile[2] - 1.f);
+            const float b = top * (2.f * tile[1] - 1.f), t = top * (2.f * tile[3] - 1.f);
+            if (camera->reversed_z)
+                mat4x4_frustum_reversed(camera->projection, l, r, b, t, camera->near_plane, camera->far_plane);
+            else
+                mat4x4_frustum(camera->projection, l, r, b, t, camera->near_plane, camera->far_plane);
+        }
+        else if (camera->reversed_z)
+            mat4x4_perspective_reversed(camera->projection, camera->fov_y, ratio, camera->near_plane,
+                camera->far_plane);
+        else
+            mat4x4_perspective(camera->projection, camera->fov_y, ratio, camera->near_plane, camera->far_plane);
+        mat4x4_mul_restrict(camera->view_projection, camera->projection, camera->view);
+        rigid_invert(inverse_view, camera->view);
+        mat4x4_frustum_invert(inverse_projection, camera->projection);
+        mat4x4_mul_restrict(camera->inverse_view_projection, inverse_view, inverse_projection);
+        if (camera->tracked)
+            camera_update_eyes(camera, camera->eyes, camera->eye_margin);
+        else if (stereo)
+            camera_update_stereo(camera, ratio);
+        else
+        {
+            frustum_from_matrix(&camera->frustum, camera->view_projection);
+            mat4x4_dup(camera->stereo_view_projection[0], camera->view_projection);
+            mat4x4_dup(camera->stereo_view_projection[1], camera->view_projection);
+        }
+        ++camera->version;
+        camera->dirty = false;
+        return true;
+    }
+    mat4x4_identity(camera->view);
+    mat4x4_scale_aniso(camera->view, camera->view, camera->zoom, camera->zoom, 1.f);
+    const float l = ratio * (2.f * tile[0] - 1.f), r = ratio * (2.f * tile[2] - 1.f);
+    const float b = 2.f * tile[1] - 1.f, t = 2.f * tile[3] - 1.f;
+    if (camera->reversed_z)
+        mat4x4_ortho_reversed(camera->projection, l, r, b, t, 1.f, -1.f);
+    else
+        mat4x4_ortho(camera->projection, l, r, b, t, 1.f, -1.f);
+    mat4x4_mul_restrict(camera->view_projection, camera->projection, camera->view);
+    // Both halves invert in closed form: the view is a scale, the projection an ortho
+    mat4x4_identity(inverse_view);
+    mat4x4_scale_aniso(inverse_view, inverse_view, 1.f / camera->zoom, 1.f / camera->zoom, 1.f);
+    mat4x4_ortho_invert(inverse_projection, camera->projection);
+    mat4x4_mul_restrict(camera->inverse_view_projection, inverse_view, inverse_projection);
+    frustum_from_matrix(&camera->frustum, camera->view_projection);
+    mat4x4_dup(camera->stereo_view_projection[0], camera->view_projection);
+    mat4x4_dup(camera->stereo_view_projection[1], camera->view_projection);
+    ++camera->version;
+    camera->dirty = false;
+    return true;
+}
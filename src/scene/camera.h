@@ -0,0 +1,129 @@
+#pragma once
+
+#include "linmath.h"
+#include "linmath_double.h"
+#include "scene/frustum.h"
+
+#include <stdint.h>
+
+// The view: an orthographic camera over the grid, or a perspective one placed
+// by a CameraController (scene/camera_controller.h), cached between frames.
+//
+// Everything derived from the camera - projection, view-projection, the cull
+// frustum - only changes when the framebuffer is resized, the zoom changes or
+// the controller moves the eye, so it is built once and then reused. The
+// camera_set_* functions mark the camera dirty when the value actually
+// differs, and camera_update rebuilds the matrices and frustum only then. "version" is bumped on every
+// rebuild, so a consumer holding its own copy (the renderer's camera uniform
+// block) re-uploads only when it no longer matches.
+//
+// A reversed-Z camera (--depth, with glClipControl's [0, 1] depth range) maps
+// the near plane to depth 1 and the far one to 0. Its frustum's near and far
+// planes come out looser than the clip volume then, which only culls less.
+//
+// Camera-relative: world positions are double (linmath_double.h), and every
+// matrix here takes positions relative to "origin" instead, so no float the
+// GPU sees holds more than a difference of nearby positions. The perspective
+// view is kept in double and only becomes float with the origin folded into
+// its translation; the orthographic camera is centred on the origin.
+//
+// A tile (camera_set_tile) makes the camera one part of a bigger view, as a
+// node of a distributed wall draws it: the projection is the off-centre
+// frustum (or ortho box) of that part of the whole view, whose aspect ratio
+// is the viewport's scaled up by the tile's share of it, so the frustum - and
+// the culling - only covers what this part shows.
+//
+// A stereo camera (camera_set_stereo) draws two eyes side by side in the
+// viewport, each half of it wide. The matrices above are the centre eye's;
+// each eye gets its own view-projection, its frustum off-centre so the two
+// meet at the convergence distance instead of toeing in. The cull frustum
+// is one around both eyes': the frustum of an eye far enough behind the
+// centre one that its sides run through both eyes' outer sides at the near
+// and far planes. A stereo camera ignores its tile.
+//
+// Head-tracked eyes (camera_set_eyes, for --xr) take the place of the
+// separation: the view becomes the head's, placed in the eye_view's space,
+// and each eye has its own pose in the head's space and its own tangents, as
+// a headset reports them. The cull frustum is built the same way and then
+// opened to every corner of both eyes' frusta, so it holds them however
+// they're turned, with a margin for the head moving on before the eyes are
+// late-latched (camera_eye_view_projection).
+
+typedef enum CameraProjection
+{
+    CAMERA_ORTHOGRAPHIC,        // the grid's [-1, 1] height, scaled by the zoom
+    CAMERA_PERSPECTIVE          // fov_y over eye_view, from camera_set_perspective and camera_set_view
+} CameraProjection;
+
+// An eye of a stereo camera: where it is and the sides of its frustum
+typedef struct CameraEye
+{
+    mat4x4 pose;                // eye to head space (the centre eye's without tracking): a rotation and a translation
+    float tangents[4];          // of the left, right, bottom and top sides' angles off its axis; left, bottom < 0
+} CameraEye;
+
+typedef struct Camera
+{
+    int width, height;          // framebuffer size in pixels
+    float zoom;                 // > 1 magnifies the centre
+    int projection_type;        // CameraProjection
+    float fov_y;                // perspective: vertical field of view in radians
+    float near_plane, far_plane;    // perspective: distances from the eye
+    dmat4x4 eye_view;           // perspective: world to eye, a rotation and a translation
+    dvec3 origin;               // world position the matrices below are relative to
+    float tile[4];              // the part of the whole view shown: x0, y0, x1, y1 in [0, 1]; all of it by default
+    mat4x4 view;
+    mat4x4 projection;
+    mat4x4 view_projection;     // projection * view
+    mat4x4 inverse_view_projection; // clip space back to world space, for unprojecting
+    Frustum frustum;            // planes of view_projection, for culling in world space; both eyes' when stereo
+    float stereo_separation;    // between the eyes, in world units; 0 for one eye
+    float stereo_convergence;   // where the eyes' frusta meet, from the eyes: objects there have no parallax
+    mat4x4 stereo_view_projection[2];   // the left eye's and the right eye's; view_projection twice for one eye
+    bool tracked;               // camera_set_eyes: head and eyes below stand in for the separation
+    mat4x4 head;                // tracked: the head's pose in eye_view's eye space, rigid
+    CameraEye eyes[2];          // tracked: the left eye and the right eye, posed in the head's space
+    float eye_margin;           // tracked: radians the head may turn before the eyes are late-latched
+    uint32_t version;           // bumped by every rebuild; 0 until the first
+    bool reversed_z;            // the projection is mat4x4_ortho_reversed's
+    bool dirty;                 // anything above changed since the last camera_update
+} Camera;
+
+// A camera with no viewport yet; call camera_set_viewport before the first camera_update
+void camera_init(Camera* camera, float zoom);
+
+// Framebuffer size; a 0 size (a minimised window) is ignored so the aspect ratio stays valid
+void camera_set_viewport(Camera* camera, int width, int height);
+
+void camera_set_zoom(Camera* camera, float zoom);
+
+// Depth from 1 at the near plane to 0 at the far one, for a [0, 1] clip depth range
+void camera_set_reversed_z(Camera* camera, bool reversed);
+
+// Switches to a perspective projection (the zoom is ignored from then on)
+void camera_set_perspective(Camera* camera, float fov_y, float near_plane, float far_plane);
+
+// The perspective camera's world-to-eye matrix; it must be rigid, as the inverse is built in closed form
+void camera_set_view(Camera* camera, dmat4x4 const view);
+
+// The world position everything the camera builds is relative to: a point at world position p goes through
+// the matrices as p - origin
+void camera_set_origin(Camera* camera, dvec3 const origin);
+
+// Shows only [x0, x1] x [y0, y1] of the whole view (fractions of it from its bottom left), in the viewport: each
+// node of a wall of n side by side shows [k / n, (k + 1) / n] x [0, 1]
+void camera_set_tile(Camera* camera, float x0, float y0, float x1, float y1);
+
+// Two eyes "separation" apart, perspective only; 0 for one. The frusta meet at "convergence" from the eyes.
+void camera_set_stereo(Camera* camera, float separation, float convergence);
+
+// Head-tracked eyes, perspective only: the head's pose in eye_view's eye space and the eyes' in the head's, in world
+// units. The cull frustum also holds the eyes with the head turned up to "margin" radians any way. NULL for none.
+void camera_set_eyes(Camera* camera, mat4x4 const head, const CameraEye eyes[2], float margin);
+
+// The view-projection of "eye", posed in the space of the camera's view: the eyes of a tracked camera as they're
+// located again just before drawing, after the camera was built and culled with
+void camera_eye_view_projection(const Camera* camera, const CameraEye* eye, mat4x4 view_projection);
+
+// Rebuilds the derived matrices and frustum if anything changed. Returns true when it did.
+bool camera_update(Camera* camera);
@@ -0,0 +1,204 @@
+#include "scene/camera_controller.h"
+
+#include <math.h>
+#include <string.h>
+
+#define DRAG_RADIANS 0.005f         // orbit and fly: turn a pixel of drag
+#define SCROLL_STEP 1.1f            // distance or speed a scroll notch
+#define ORBIT_MAX_PITCH 1.5f        // just short of the horizon either side
+#define FLY_MAX_PITCH 3.1415927f    // straight up
+#define MAX_STEP 0.1                // seconds: a stall doesn't fling the flying eye away
+
+static const char* mode_names[CAMERA_CONTROLLER_MODE_COUNT] = { "orbit", "arcball", "fly" };
+
+void camera_controller_init(CameraController* controller, int mode, float zoom, dvec3 const centre)
+{
+    controller->mode = mode;
+    controller->fov_y = 1.0471976f;     // 60 degrees
+    controller->far_plane = 0.f;
+    // Far enough that the fov spans the [-1, 1] the orthographic camera shows at "zoom"
+    controller->distance = 1.f / (zoom * tanf(0.5f * controller->fov_y));
+    dvec3_dup(controller->target, centre);
+    controller->yaw = 0.f;
+    controller->pitch = 0.f;
+    quat_identity(controller->orientation);
+    dvec3_dup(controller->position, centre);
+    controller->position[2] += controller->distance;
+    controller->speed = controller->distance;
+    controller->dragging = false;
+    controller->cursor[0] = controller->cursor[1] = 0.0;
+    controller->keys = 0;
+    controller->time = 0.0;
+    controller->changed = true;
+}
+
+int camera_controller_mode_from_name(const char* name)
+{
+    for (int m = 0; m < CAMERA_CONTROLLER_MODE_COUNT; ++m)
+        if (!strcmp(name, mode_names[m]))
+            return m;
+    return -1;
+}
+
+const char* camera_controller_mode_name(int mode)
+{
+    return mode >= 0 && mode < CAMERA_CONTROLLER_MODE_COUNT ? mode_names[mode] : "?";
+}
+
+static float clampf(float v, float lo, float hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+// Window position (x, y) on the arcball: the unit sphere under the framebuffer's centre, its radius half the
+// shorter side, and outside it the sphere's rim
+static void arcball_point(const Camera* camera, double x, double y, vec3 p)
+{
+    const float half = 0.5f * (float)(camera->width < camera->height ? camera->width : camera->height);
+    p[0] = (float)(x - 0.5 * camera->width) / half;
+    p[1] = (float)(0.5 * camera->height - y) / half;
+    const float r2 = p[0] * p[0] + p[1] * p[1];
+    if (r2 < 1.f)
+        p[2] = sqrtf(1.f - r2);
+    else
+    {
+        const float r = sqrtf(r2);
+        p[0] /= r;
+        p[1] /= r;
+        p[2] = 0.f;
+    }
+}
+
+// The right-button drag from the last cursor position to (x, y)
+static void drag(CameraController* controller, const Camera* camera, double x, double y)
+{
+    const float dx = (float)(x - controller->cursor[0]), dy = (float)(y - controller->cursor[1]);
+    switch (controller->mode)
+    {
+    case CAMERA_CONTROLLER_ORBIT:
+        controller->yaw += dx * DRAG_RADIANS;
+        controller->pitch = clampf(controller->pitch + dy * DRAG_RADIANS, -ORBIT_MAX_PITCH, ORBIT_MAX_PITCH);
+        break;
+    case CAMERA_CONTROLLER_FLY:
+        controller->yaw += dx * DRAG_RADIANS;
+        controller->pitch = clampf(controller->pitch - dy * DRAG_RADIANS, 0.f, FLY_MAX_PITCH);
+        break;
+    case CAMERA_CONTROLLER_ARCBALL:
+    {
+        // The eye-space rotation taking the ball's point under the old cursor to the one under the new, as
+        // mat4x4_arcball does, composed onto the orientation as a quaternion and renormalised against drift
+        if (camera->width <= 0 || camera->height <= 0)
+            break;
+        vec3 a, b, axis;
+        arcball_point(camera, controller->cursor[0], controller->cursor[1], a);
+        arcball_point(camera, x, y, b);
+        vec3_mul_cross(axis, a, b);
+        if (vec3_len(axis) < 1e-6f)
+            break;
+        quat turn, turned;
+        quat_rotate(turn, acosf(clampf(vec3_mul_inner(a, b), -1.f, 1.f)), axis);
+        quat_mul(turned, turn, controller->orientation);
+        vec4_norm(controller->orientation, turned);
+        break;
+    }
+    }
+    controller->changed = true;
+}
+
+bool camera_controller_event(CameraController* controller, const InputEvent* event, const Camera* camera)
+{
+    switch (event->type)
+    {
+    case INPUT_EVENT_MOUSE_BUTTON:
+        if (event->code != CAMERA_BUTTON_RIGHT)
+            return false;
+        controller->dragging = event->action == CAMERA_PRESS;
+        controller->cursor[0] = event->x;
+        controller->cursor[1] = event->y;
+        return true;
+    case INPUT_EVENT_CURSOR:
+        if (controller->dragging)
+            drag(controller, camera, event->x, event->y);
+        controller->cursor[0] = event->x;
+        controller->cursor[1] = event->y;
+        return true;
+    case INPUT_EVENT_SCROLL:
+        if (controller->mode == CAMERA_CONTROLLER_FLY)
+            controller->speed *= powf(SCROLL_STEP, (float)event->y);
+        else
+            controller->distance *= powf(SCROLL_STEP, -(float)event->y);
+        controller->changed = true;
+        return true;
+    case INPUT_EVENT_KEY:
+    {
+        if (controller->mode != CAMERA_CONTROLLER_FLY || event->code < CAMERA_KEY_RIGHT
+            || event->code > CAMERA_KEY_PAGE_DOWN)
+            return false;
+        const unsigned int bit = 1u << (event->code - CAMERA_KEY_RIGHT);
+        if (event->action == CAMERA_PRESS)
+            controller->keys |= bit;
+        else if (event->action == CAMERA_RELEASE)
+            controller->keys &= ~bit;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void camera_controller_view(const CameraController* controller, dmat4x4 view)
+{
+    // Eye space looks down -z: at pitch 0 (and the identity orientation) that is straight down onto the grid.
+    // The turn is small numbers and fine in float; the move from the world position is done in double.
+    mat4x4 turn;
+    if (controller->mode == CAMERA_CONTROLLER_FLY)
+        mat4x4_identity(turn);
+    else
+        mat4x4_translate(turn, 0.f, 0.f, -controller->distance);
+    if (controller->mode == CAMERA_CONTROLLER_ARCBALL)
+    {
+        mat4x4 rotation;
+        mat4x4_from_quat(rotation, controller->orientation);
+        mat4x4_mul(turn, turn, rotation);
+    }
+    else
+    {
+        mat4x4_rotate_X(turn, turn, -controller->pitch);
+        mat4x4_rotate_Z(turn, turn, controller->yaw);
+    }
+    const double* eye = controller->mode == CAMERA_CONTROLLER_FLY ? controller->position : controller->target;
+    dmat4x4_from_mat4x4(view, turn);
+    dmat4x4_translate_in_place(view, -eye[0], -eye[1], -eye[2]);
+}
+
+void camera_controller_apply(CameraController* controller, Camera* camera, double time)
+{
+    double dt = controller->time > 0.0 ? time - controller->time : 0.0;
+    dt = dt < 0.0 ? 0.0 : dt > MAX_STEP ? MAX_STEP : dt;
+    controller->time = time;
+    if (controller->mode == CAMERA_CONTROLLER_FLY && controller->keys && dt > 0.0)
+    {
+        // The view's rows are the eye's axes in world space: x to the right, -z forward
+        dmat4x4 view;
+        camera_controller_view(controller, view);
+        const int k = (int)controller->keys;
+        const float forward = (float)((k >> (CAMERA_KEY_UP - CAMERA_KEY_RIGHT) & 1)
+            - (k >> (CAMERA_KEY_DOWN - CAMERA_KEY_RIGHT) & 1));
+        const float right = (float)((k & 1) - (k >> (CAMERA_KEY_LEFT - CAMERA_KEY_RIGHT) & 1));
+        const float up = (float)((k >> (CAMERA_KEY_PAGE_UP - CAMERA_KEY_RIGHT) & 1)
+            - (k >> (CAMERA_KEY_PAGE_DOWN - CAMERA_KEY_RIGHT) & 1));
+        const double step = controller->speed * dt;
+        for (int i = 0; i < 3; ++i)
+            controller->position[i] += step * (right * view[i][0] - forward * view[i][2] + (i == 2 ? up : 0.0));
+        controller->changed = true;
+    }
+    if (!controller->changed)
+        return;
+    dmat4x4 view;
+    camera_controller_view(controller, view);
+    // The depth range follows the distance, so its precision stays where the grid is
+    camera_set_perspective(camera, controller->fov_y, 0.01f * controller->distance,
+        fmaxf(100.f * controller->distance, controller->far_plane));
+    camera_set_view(camera, view);
+    controller->changed = false;
+}
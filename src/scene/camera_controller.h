@@ -0,0 +1,84 @@
+#pragma once
+
+#include "core/input_queue.h"
+#include "linmath.h"
+#include "scene/camera.h"
+
+// Perspective control of a Camera from the input queue's events: orbit,
+// arcball or fly.
+//
+//  - orbit turns around "target" at "distance": dragging with the right
+//    button turns (yaw, about world z) and tilts (pitch, toward the horizon),
+//    scrolling moves in and out;
+//  - arcball turns the world as if the cursor dragged a ball under it, as a
+//    quaternion, so any orientation can be reached; scrolling as for orbit;
+//  - fly moves the eye: the arrow keys go forward, back and sideways,
+//    Page Up and Page Down go up and down, dragging looks around and
+//    scrolling changes the speed.
+//
+// All three start from the orthographic camera's framing: looking straight
+// down -z at the grid, from as far away as shows its [-1, 1] height at the
+// zoom. camera_controller_event takes events as process_input drains them
+// and only records them; camera_controller_apply then moves by the time
+// since the last call and hands the camera its view only when it changed, so
+// a still controller leaves the camera's cached matrices and frustum alone.
+//
+// The target and the flying eye are world positions in double, so a grid
+// 10^7 units out turns and flies as smoothly as one at the origin; the view
+// goes to the camera in double too, which makes it camera-relative.
+//
+// Knows nothing of GLFW: the codes below are GLFW's, which main checks.
+
+#define CAMERA_KEY_RIGHT 262
+#define CAMERA_KEY_LEFT 263
+#define CAMERA_KEY_DOWN 264
+#define CAMERA_KEY_UP 265
+#define CAMERA_KEY_PAGE_UP 266
+#define CAMERA_KEY_PAGE_DOWN 267
+#define CAMERA_BUTTON_RIGHT 1
+#define CAMERA_RELEASE 0
+#define CAMERA_PRESS 1
+
+typedef enum CameraControllerMode
+{
+    CAMERA_CONTROLLER_ORBIT,
+    CAMERA_CONTROLLER_ARCBALL,
+    CAMERA_CONTROLLER_FLY,
+    CAMERA_CONTROLLER_MODE_COUNT
+} CameraControllerMode;
+
+typedef struct CameraController
+{
+    int mode;                   // CameraControllerMode
+    dvec3 target;               // orbit, arcball: what the eye turns around, in world space
+    float distance;             // orbit, arcball: of the eye from "target"
+    float yaw, pitch;           // orbit, fly: radians about world z, then from looking down toward the horizon
+    quat orientation;           // arcball: world to eye rotation
+    dvec3 position;             // fly: the eye, in world space
+    float speed;                // fly: world units a second
+    float fov_y;                // radians
+    float far_plane;            // at least this far (--terrain's far side); 0: 100 times "distance", as it is anyway
+    bool dragging;              // the right button is down
+    double cursor[2];           // last cursor position in window coordinates
+    unsigned int keys;          // fly: movement keys held, a bit each
+    double time;                // of the last apply; 0 before the first
+    bool changed;               // something moved since the last apply
+} CameraController;
+
+// A controller in "mode" framing what an orthographic camera at "zoom" centred on world position "centre" shows
+void camera_controller_init(CameraController* controller, int mode, float zoom, dvec3 const centre);
+
+// "orbit", "arcball" or "fly"; returns -1 for anything else
+int camera_controller_mode_from_name(const char* name);
+const char* camera_controller_mode_name(int mode);
+
+// Records one event. Returns true when the controller took it (drags, scrolls, its keys) and nothing else
+// should. "camera" gives the framebuffer size arcball drags are measured against.
+bool camera_controller_event(CameraController* controller, const InputEvent* event, const Camera* camera);
+
+// Moves by what was recorded and the time since the last call ("time" in seconds), and sets the camera's
+// perspective and view; the camera is marked dirty only if they differ. Call before camera_update.
+void camera_controller_apply(CameraController* controller, Camera* camera, double time);
+
+// The world to eye matrix the controller stands for
+void camera_controller_view(const CameraController* controller, dmat4x4 view);
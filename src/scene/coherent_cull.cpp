@@ -0,0 +1,302 @@
+#include "scene/coherent_cull.h"
+
+#include "linmath_bounds.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A plane distance computed in floats is within this much of the exact one, relative to the sizes that went in;
+// margins are cut by it, so rounding can't make an answer outlive its margin
+#define ROUNDING 1e-5f
+
+bool coherent_cull_init(CoherentCull* c, uint32_t count)
+{
+    memset(c, 0, sizeof(*c));
+    c->count = count;
+    const size_t n = count ? count : 1;
+    c->expiry = (float*)malloc(sizeof(float) * n);
+    c->inside = (uint8_t*)calloc(n, 1);
+    c->order = (uint32_t*)malloc(sizeof(uint32_t) * n);
+    c->entered = (uint32_t*)malloc(sizeof(uint32_t) * n);
+    c->packed = (uint64_t*)malloc(sizeof(uint64_t) * n);
+    if (!c->expiry || !c->inside || !c->order || !c->entered || !c->packed)
+    {
+        coherent_cull_destroy(c);
+        return false;
+    }
+    return true;
+}
+
+void coherent_cull_destroy(CoherentCull* c)
+{
+    free(c->expiry);
+    free(c->inside);
+    free(c->order);
+    free(c->entered);
+    free(c->packed);
+    memset(c, 0, sizeof(*c));
+}
+
+void coherent_cull_reset(CoherentCull* c)
+{
+    c->valid = false;
+}
+
+void coherent_cull_moved(CoherentCull* c, const uint32_t* objects, size_t count)
+{
+    for (size_t k = 0; k < count; ++k)
+    {
+        if (objects[k] < c->count)
+            c->expiry[objects[k]] = -INFINITY;
+    }
+}
+
+// frustum_cull_spheres' answer for object i of "count", to the bit: its eight-wide test (the object in every lane),
+// or its scalar one for the count % 8 objects at the end
+static bool answer(const Frustum* f, uint32_t i, uint32_t count, float x, float y, float z, float r)
+{
+    if (i >= count - count % 8)
+    {
+        for (int p = 0; p < 6; ++p)
+        {
+            const float* plane = f->planes[p];
+            if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < -r)
+                return false;
+        }
+        return true;
+    }
+    float lanes[4][8];
+    for (int k = 0; k < 8; ++k)
+    {
+        lanes[0][k] = x;
+        lanes[1][k] = y;
+        lanes[2][k] = z;
+        lanes[3][k] = r;
+    }
+    return planes_test_spheres8(f->planes, 6, lanes[0], lanes[1], lanes[2], lanes[3]) & 1;
+}
+
+// Keeps object i's answer "inside" and the drift it holds until, noting when it came into view
+static void keep(CoherentCull* c, uint32_t i, float x, float y, float z, float r, bool inside)
+{
+    const Frustum* f = &c->frustum;
+    float in_margin = INFINITY, out_margin = 0.f, size = 0.f;
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* plane = f->planes[p];
+        const float s = plane[0] * x + plane[1] * y + plane[2] * z + plane[3];
+        in_margin = fminf(in_margin, s + r);
+        out_margin = fmaxf(out_margin, -r - s);
+        size = fmaxf(size, fabsf(x) + fabsf(y) + fabsf(z) + fabsf(r) + fabsf(plane[3]));
+    }
+    // An answer the rounding could have decided has no margin: it's tested again next frame
+    const float margin = (inside ? in_margin : out_margin) - ROUNDING * (size + c->drift);
+    if (inside && !c->inside[i])
+        c->entered[c->entered_count++] = i;
+    c->inside[i] = inside;
+    c->expiry[i] = c->drift + (margin > 0.f ? margin : 0.f);
+}
+
+// How far the planes moved from "from" to "to", measured about the pivot, over every object within the reach
+static float plane_drift(const Frustum* from, const Frustum* to, const vec3 pivot, float reach)
+{
+    float drift = 0.f;
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* a = from->planes[p];
+        const float* b = to->planes[p];
+        const vec3 dn = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float dd = (vec3_mul_inner(b, pivot) + b[3]) - (vec3_mul_inner(a, pivot) + a[3]);
+        drift = fmaxf(drift, vec3_len(dn) * reach + fabsf(dd));
+    }
+    return drift * (1.f + ROUNDING);
+}
+
+size_t coherent_cull(CoherentCull* c, const Frustum* frustum, const float* x, const float* y, const float* z,
+    const float* radius, uint32_t* visible)
+{
+    const uint32_t count = c->count;
+    ++c->frames;
+    c->objects += count;
+    float step = 0.f;
+    if (c->valid)
+        step = plane_drift(&c->frustum, frustum, c->pivot, c->reach);
+    c->frustum = *frustum;
+    c->entered_count = 0;
+
+    // A long way in one frame has too many objects due for the scan to beat testing them all
+    if (!c->valid || !(step <= c->reach / COHERENT_CULL_MAX_DRIFT))
+    {
+        float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float p[3] = { x[i], y[i], z ? z[i] : 0.f };
+            for (int k = 0; k < 3; ++k)
+            {
+                lo[k] = fminf(lo[k], p[k]);
+                hi[k] = fmaxf(hi[k], p[k]);
+            }
+        }
+        float reach = 0.f;
+        for (int k = 0; k < 3; ++k)
+        {
+            c->pivot[k] = count ? 0.5f * (lo[k] + hi[k]) : 0.f;
+            reach += count ? (hi[k] - lo[k]) * (hi[k] - lo[k]) : 0.f;
+        }
+        c->reach = 0.5f * sqrtf(reach) * (1.f + ROUNDING);
+        c->drift = 0.f;
+        uint32_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const unsigned int mask = planes_test_spheres8(frustum->planes, 6, x + i, y + i, z ? z + i : NULL,
+                radius + i);
+            for (uint32_t k = 0; k < 8; ++k)
+                keep(c, i + k, x[i + k], y[i + k], z ? z[i + k] : 0.f, radius[i + k], (mask >> k) & 1);
+        }
+        for (; i < count; ++i)
+        {
+            const float zi = z ? z[i] : 0.f;
+            keep(c, i, x[i], y[i], zi, radius[i], answer(frustum, i, count, x[i], y[i], zi, radius[i]));
+        }
+        c->valid = true;
+        ++c->full;
+        c->tested += count;
+    }
+    else
+    {
+        // Once the drift passes the reach it's taken off every expiry as they're scanned, so they keep their
+        // precision; the moved stay at -INFINITY
+        c->drift += step;
+        const float rebase = c->drift > c->reach ? c->drift : 0.f;
+        c->drift -= rebase;
+        if (rebase > 0.f)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+                c->expiry[i] -= rebase;
+        }
+        size_t due = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (!(c->expiry[i] <= c->drift))
+                continue;
+            const vec3 p = { x[i], y[i], z ? z[i] : 0.f };
+            vec3 offset;
+            vec3_sub(offset, p, c->pivot);
+            c->reach = fmaxf(c->reach, vec3_len(offset) * (1.f + ROUNDING));
+            keep(c, i, p[0], p[1], p[2], radius[i], answer(frustum, i, count, p[0], p[1], p[2], radius[i]));
+            ++due;
+        }
+        c->tested += due;
+    }
+
+    // The last order less what left, then what came in
+    size_t n = 0;
+    for (uint32_t k = 0; k < c->order_count; ++k)
+    {
+        visible[n] = c->order[k];
+        n += c->inside[c->order[k]];
+    }
+    memcpy(visible + n, c->entered, sizeof(uint32_t) * c->entered_count);
+    n += c->entered_count;
+    memcpy(c->order, visible, sizeof(uint32_t) * n);
+    c->order_count = (uint32_t)n;
+    return n;
+}
+
+// Keys ordered as unsigned integers: the sign bit flipped for positives, every bit for negatives
+static inline uint32_t ordered_bits(float key)
+{
+    uint32_t bits;
+    memcpy(&bits, &key, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+static int compare_packed(const void* a, const void* b)
+{
+    const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static inline float key_of(uint32_t bits)
+{
+    bits = bits & 0x80000000u ? bits & 0x7FFFFFFFu : ~bits;
+    float key;
+    memcpy(&key, &bits, sizeof(key));
+    return key;
+}
+
+bool coherent_cull_sort(CoherentCull* c, uint32_t* visible, float* keys, size_t count)
+{
+    ++c->sorted;
+    // The newcomers at the end are sorted on their own and merged in; the rest were in order last frame
+    const size_t fresh = count == c->order_count ? c->entered_count : 0, kept = count - fresh;
+    c->entered_count = 0;
+    const size_t budget = COHERENT_CULL_SORT_MOVES * count;
+    size_t moves = 0, k = 1;
+    for (; k < kept && moves <= budget; ++k)
+    {
+        const float key = keys[k];
+        const uint32_t object = visible[k];
+        size_t j = k;
+        for (; j > 0 && ordered_bits(keys[j - 1]) > ordered_bits(key); --j)
+        {
+            keys[j] = keys[j - 1];
+            visible[j] = visible[j - 1];
+        }
+        keys[j] = key;
+        visible[j] = object;
+        moves += k - j;
+    }
+    const bool coherent = k >= kept;
+    if (coherent && fresh)
+    {
+        // Merged from the back, a newcomer after the kept objects it ties with
+        for (size_t e = 0; e < fresh; ++e)
+            c->packed[e] = (uint64_t)ordered_bits(keys[kept + e]) << 32 | visible[kept + e];
+        qsort(c->packed, fresh, sizeof(uint64_t), compare_packed);
+        size_t a = kept, b = fresh, out = count;
+        while (b > 0)
+        {
+            const uint32_t bits = (uint32_t)(c->packed[b - 1] >> 32);
+            if (a > 0 && ordered_bits(keys[a - 1]) > bits)
+            {
+                --a;
+                keys[--out] = keys[a];
+                visible[out] = visible[a];
+            }
+            else
+            {
+                --b;
+                keys[--out] = key_of(bits);
+                visible[out] = (uint32_t)c->packed[b];
+            }
+        }
+    }
+    else if (!coherent)
+    {
+        // Too far from sorted: keys and places packed together sort stably in one qsort
+        ++c->resorted;
+        for (size_t e = 0; e < count; ++e)
+            c->packed[e] = (uint64_t)ordered_bits(keys[e]) << 32 | e;
+        memcpy(c->entered, visible, sizeof(uint32_t) * count);
+        qsort(c->packed, count, sizeof(uint64_t), compare_packed);
+        for (size_t e = 0; e < count; ++e)
+        {
+            keys[e] = key_of((uint32_t)(c->packed[e] >> 32));
+            visible[e] = c->entered[(uint32_t)c->packed[e]];
+        }
+    }
+    const size_t order = count < c->count ? count : c->count;
+    memcpy(c->order, visible, sizeof(uint32_t) * order);
+    c->order_count = (uint32_t)order;
+    return coherent;
+}
+
+void coherent_cull_print(const CoherentCull* c, FILE* out)
+{
+    fprintf(out, "coherent cull: %.1f%% of objects tested a frame (%llu of %llu frames in full), order sorted afresh "
+        "%llu of %llu times\n", c->objects ? 100.0 * (double)c->tested / (double)c->objects : 0.0,
+        (unsigned long long)c->full, (unsigned long long)c->frames, (unsigned long long)c->resorted,
+        (unsigned long long)c->sorted);
+}
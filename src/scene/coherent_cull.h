@@ -0,0 +1,91 @@
+#pragma once
+
+#include "scene/frustum.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Frustum culling and depth order carried over from frame to frame: a camera
+// moves a little each frame, so most objects' results and most of the order
+// are the last frame's, and only what changed is worked out again.
+//
+// Each test keeps how far the object was from changing its answer - inside,
+// the least any plane could move in before it's out; outside, the most any
+// plane that rejects it could move out before it's in. The frustum's planes
+// are measured about a pivot every object's centre lies within "reach" of,
+// so a frame's move changes no plane's distance to any object by more than
+// max over planes of |dn| * reach + |dd|: the frame's drift. Drift adds up
+// frame on frame, and an object is tested again once the drift since its
+// last test could have used up its margin. What's kept per object is the
+// drift its answer holds until, so a frame reads 4 bytes an object where
+// frustum_cull_spheres reads 12 or 16 and tests six planes, and only the few
+// due - those near the frustum's edges - are tested. The answers are the ones
+// frustum_cull_spheres gives, to the bit: an answer the rounding could have
+// gone either way on has no margin, and is tested again every frame.
+//
+// Objects that moved are the caller's to name (coherent_cull_moved); they're
+// tested on the next cull whatever the frustum did. When everything moved,
+// or the camera jumped, coherent_cull_reset (or a frame's drift past
+// 1 / COHERENT_CULL_MAX_DRIFT of the reach) tests every object again.
+//
+// The visible list comes out in the last frame's order, the objects that
+// came into view after it. coherent_cull_sort orders it by the caller's keys
+// (depth, for near to far) with an insertion sort, which is linear in the
+// objects plus how far each moved since the last frame, and keeps the result
+// as the next frame's order; the newcomers are sorted on their own and
+// merged in. A camera that slides keeps depth order as it was; one that
+// turns reorders everything to the sides, so a list too far from sorted
+// (COHERENT_CULL_SORT_MOVES) is sorted afresh.
+
+#define COHERENT_CULL_SORT_MOVES 8      // per entry: the insertion sort gives up after this many shifts on average
+#define COHERENT_CULL_MAX_DRIFT 16      // a frame's drift past 1 / this of the reach is tested in full
+
+typedef struct CoherentCull
+{
+    uint32_t count;             // objects
+    float* expiry;              // [object]: the drift its last answer holds until; -INFINITY once it moved
+    uint8_t* inside;            // [object]: the last answer
+    uint32_t* order;            // the visible objects in the last frame's order
+    uint32_t order_count;
+    uint32_t* entered;          // [count]: the objects that came into view on the last cull
+    uint32_t entered_count;     // at the end of its list, which coherent_cull_sort hasn't sorted yet
+    uint64_t* packed;           // [count]: coherent_cull_sort's keys and places, when it sorts
+    Frustum frustum;            // as last culled against
+    vec3 pivot;                 // the planes' distances are measured about it
+    float reach;                // every object's centre is within this of the pivot, as last tested
+    float drift;                // summed over the frames since the expiries were last rebased
+    bool valid;                 // false: the next cull tests every object
+
+    // Totals over the run
+    uint64_t frames;
+    uint64_t full;              // frames every object was tested on
+    uint64_t tested;            // objects tested, summed
+    uint64_t objects;           // objects culled, summed
+    uint64_t sorted;            // coherent_cull_sort calls
+    uint64_t resorted;          // of those, lists too far from sorted for the insertion sort
+} CoherentCull;
+
+// Room for "count" objects, every one to be tested on the first cull. Returns false when out of memory.
+bool coherent_cull_init(CoherentCull* c, uint32_t count);
+void coherent_cull_destroy(CoherentCull* c);
+
+// Every object is tested again on the next cull: they all moved, or there are new ones (the same count)
+void coherent_cull_reset(CoherentCull* c);
+
+// The "count" objects in "objects" are tested again on the next cull, whatever the frustum does
+void coherent_cull_moved(CoherentCull* c, const uint32_t* objects, size_t count);
+
+// The spheres at (x, y, z)[i] with radius[i] (z may be NULL for spheres in the z = 0 plane) against "frustum", as
+// frustum_cull_spheres tests them: writes the objects that may be visible to "visible" (room for the count), in
+// the last frame's order and those that came into view after, and returns how many were written
+size_t coherent_cull(CoherentCull* c, const Frustum* frustum, const float* x, const float* y, const float* z,
+    const float* radius, uint32_t* visible);
+
+// Sorts "visible", the "count" objects coherent_cull wrote, by "keys" (keys[k] for visible[k], ascending; both
+// reordered), stably, and keeps the result as the order the next cull writes them in. Ties keep the last frame's
+// order, so equal keys don't shuffle. Returns false when the list was too far from sorted and was sorted afresh.
+bool coherent_cull_sort(CoherentCull* c, uint32_t* visible, float* keys, size_t count);
+
+// One line: the objects tested a frame against those culled, and how often the order had to be sorted afresh
+void coherent_cull_print(const CoherentCull* c, FILE* out);
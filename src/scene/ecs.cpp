@@ -0,0 +1,456 @@
+#include "scene/ecs.h"
+
+#include "core/huge_pages.h"
+#include "core/job_system.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ECS_INDEX_BITS      20
+#define ECS_GENERATION_MASK 0xFFFu      // the 12 bits above the index
+#define ECS_FOR_EACH_GRAIN  4           // chunks per job: ~4096 entities, enough to amortise scheduling
+
+typedef struct EcsFieldInfo
+{
+    EcsComponent component;
+    size_t size;
+} EcsFieldInfo;
+
+static const EcsFieldInfo field_info[ECS_FIELD_COUNT] = {
+    { ECS_TRANSFORM, sizeof(float) },       // x
+    { ECS_TRANSFORM, sizeof(float) },       // y
+    { ECS_TRANSFORM, sizeof(float) },       // z
+    { ECS_TRANSFORM, sizeof(float) },       // angle
+    { ECS_TRANSFORM, sizeof(float) },       // scale
+    { ECS_TRANSFORM, sizeof(mat4x4) },      // mvp
+    { ECS_MESH_REF, sizeof(uint32_t) },
+    { ECS_MATERIAL, sizeof(uint32_t) },
+    { ECS_BOUNDS, sizeof(float) },          // radius
+};
+
+// A chunk's memory: the next "size" bytes of the world's last huge-page block (a new one when it's full), or the heap
+static void* chunk_alloc(EcsWorld* world, size_t size)
+{
+    if (world->huge_pages)
+    {
+        if (!world->block_count || world->block_used + size > world->block_size)
+        {
+            unsigned char** blocks = (unsigned char**)realloc(world->blocks,
+                sizeof(unsigned char*) * (world->block_count + 1));
+            if (!blocks)
+                return NULL;
+            world->blocks = blocks;
+            HugePageKind kind;
+            if (!(blocks[world->block_count] = (unsigned char*)huge_pages_alloc(world->block_size, &kind)))
+                return NULL;
+            ++world->block_count;
+            world->block_used = 0;
+        }
+        void* p = world->blocks[world->block_count - 1] + world->block_used;
+        world->block_used += size;      // chunk_bytes is a multiple of 64: the next one stays aligned
+        return p;
+    }
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, 64);
+#else
+    void* p = NULL;
+    return posix_memalign(&p, 64, size) == 0 ? p : NULL;
+#endif
+}
+
+static void chunk_free(void* p)
+{
+#if defined(_MSC_VER)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+static size_t round_up_64(size_t size)
+{
+    return (size + 63) & ~(size_t)63;
+}
+
+static void archetype_layout(EcsArchetype* a, uint32_t mask)
+{
+    memset(a, 0, sizeof(*a));
+    a->mask = mask;
+    size_t offset = 0;
+    for (int f = 0; f < ECS_FIELD_COUNT; ++f)
+    {
+        if (mask & ECS_MASK(field_info[f].component))
+        {
+            a->offsets[f] = offset;
+            offset += round_up_64(field_info[f].size * ECS_CHUNK_CAPACITY);
+        }
+        else
+            a->offsets[f] = SIZE_MAX;
+    }
+    a->entities_offset = offset;
+    a->chunk_bytes = offset + round_up_64(sizeof(EcsEntity) * ECS_CHUNK_CAPACITY);
+}
+
+bool ecs_init(EcsWorld* world, uint32_t max_entities)
+{
+    memset(world, 0, sizeof(*world));
+    if (max_entities >= (1u << ECS_INDEX_BITS))
+    {
+        fprintf(stderr, "ecs: %u entities is more than ids can address\n", max_entities);
+        return false;
+    }
+    world->records = (EcsRecord*)malloc(sizeof(EcsRecord) * (max_entities ? max_entities : 1));
+    if (!world->records)
+    {
+        fprintf(stderr, "ecs: out of memory for %u entities\n", max_entities);
+        return false;
+    }
+    world->capacity = max_entities;
+    for (uint32_t i = 0; i < max_entities; ++i)
+    {
+        world->records[i].generation = 1;
+        world->records[i].mask = 0;
+        world->records[i].chunk = 0;
+        world->records[i].row = i + 1;
+    }
+    for (uint32_t m = 0; m < ECS_ARCHETYPE_COUNT; ++m)
+        archetype_layout(&world->archetypes[m], m);
+    // Every archetype's chunk has to fit a block: the one with all the components is the biggest
+    world->block_size = huge_page_size();
+    world->huge_pages = huge_pages_enabled() && world->block_size >= world->archetypes[ECS_MASK_ALL].chunk_bytes;
+    return true;
+}
+
+void ecs_destroy(EcsWorld* world)
+{
+    for (uint32_t m = 0; m < ECS_ARCHETYPE_COUNT; ++m)
+    {
+        EcsArchetype* a = &world->archetypes[m];
+        for (uint32_t c = 0; c < a->chunk_capacity && !world->huge_pages; ++c)
+            chunk_free(a->chunks[c].data);
+        free(a->chunks);
+    }
+    for (uint32_t b = 0; b < world->block_count; ++b)
+        huge_pages_free(world->blocks[b], world->block_size);
+    free(world->blocks);
+    free(world->records);
+    free(world->views);
+    memset(world, 0, sizeof(*world));
+}
+
+static uint32_t entity_index(EcsEntity entity)
+{
+    return entity & ((1u << ECS_INDEX_BITS) - 1u);
+}
+
+static EcsRecord* entity_record(const EcsWorld* world, EcsEntity entity)
+{
+    const uint32_t index = entity_index(entity);
+    if (!entity || index >= world->capacity)
+        return NULL;
+    EcsRecord* r = &world->records[index];
+    return r->generation == (entity >> ECS_INDEX_BITS) ? r : NULL;
+}
+
+bool ecs_alive(const EcsWorld* world, EcsEntity entity)
+{
+    return entity_record(world, entity) != NULL;
+}
+
+uint32_t ecs_mask(const EcsWorld* world, EcsEntity entity)
+{
+    const EcsRecord* r = entity_record(world, entity);
+    return r ? r->mask : 0;
+}
+
+static void* field_at(const EcsArchetype* a, const EcsChunk* chunk, int field, uint32_t row)
+{
+    return chunk->data + a->offsets[field] + field_info[field].size * row;
+}
+
+static void row_defaults(const EcsArchetype* a, const EcsChunk* chunk, uint32_t row)
+{
+    for (int f = 0; f < ECS_FIELD_COUNT; ++f)
+    {
+        if (a->offsets[f] != SIZE_MAX)
+            memset(field_at(a, chunk, f, row), 0, field_info[f].size);
+    }
+    if (a->mask & ECS_MASK(ECS_TRANSFORM))
+    {
+        *(float*)field_at(a, chunk, ECS_FIELD_SCALE, row) = 1.f;
+        mat4x4_identity(*(mat4x4*)field_at(a, chunk, ECS_FIELD_MVP, row));
+    }
+}
+
+// Appends a row for "entity" at the archetype's end; false when out of memory
+static bool archetype_push(EcsWorld* world, EcsArchetype* a, EcsEntity entity, uint32_t* chunk_index, uint32_t* row)
+{
+    if (!a->chunk_count || a->chunks[a->chunk_count - 1].count == ECS_CHUNK_CAPACITY)
+    {
+        // Chunks emptied earlier keep their memory at the end of the array and are reused first
+        if (a->chunk_count == a->chunk_capacity)
+        {
+            const uint32_t capacity = a->chunk_capacity ? a->chunk_capacity * 2 : 4;
+            EcsChunk* chunks = (EcsChunk*)realloc(a->chunks, sizeof(EcsChunk) * capacity);
+            if (!chunks)
+                return false;
+            memset(chunks + a->chunk_capacity, 0, sizeof(EcsChunk) * (capacity - a->chunk_capacity));
+            a->chunks = chunks;
+            a->chunk_capacity = capacity;
+        }
+        EcsChunk* chunk = &a->chunks[a->chunk_count];
+        if (!chunk->data && !(chunk->data = (unsigned char*)chunk_alloc(world, a->chunk_bytes)))
+            return false;
+        chunk->count = 0;
+        ++a->chunk_count;
+    }
+    EcsChunk* chunk = &a->chunks[a->chunk_count - 1];
+    *chunk_index = a->chunk_count - 1;
+    *row = chunk->count++;
+    ((EcsEntity*)(chunk->data + a->entities_offset))[*row] = entity;
+    ++a->entity_count;
+    return true;
+}
+
+// Removes a row by moving the archetype's last entity into it
+static void archetype_remove(EcsWorld* world, EcsArchetype* a, uint32_t chunk_index, uint32_t row)
+{
+    EcsChunk* last = &a->chunks[a->chunk_count - 1];
+    const uint32_t last_row = last->count - 1;
+    EcsChunk* chunk = &a->chunks[chunk_index];
+    if (chunk != last || row != last_row)
+    {
+        for (int f = 0; f < ECS_FIELD_COUNT; ++f)
+        {
+            if (a->offsets[f] != SIZE_MAX)
+                memcpy(field_at(a, chunk, f, row), field_at(a, last, f, last_row), field_info[f].size);
+        }
+        const EcsEntity moved = ((EcsEntity*)(last->data + a->entities_offset))[last_row];
+        ((EcsEntity*)(chunk->data + a->entities_offset))[row] = moved;
+        EcsRecord* r = &world->records[entity_index(moved)];
+        r->chunk = chunk_index;
+        r->row = row;
+    }
+    if (--last->count == 0)
+        --a->chunk_count;
+    --a->entity_count;
+}
+
+EcsEntity ecs_create(EcsWorld* world, uint32_t mask)
+{
+    mask &= ECS_MASK_ALL;
+    if (world->free_head >= world->capacity)
+    {
+        fprintf(stderr, "ecs: more than %u entities\n", world->capacity);
+        return 0;
+    }
+    const uint32_t index = world->free_head;
+    EcsRecord* r = &world->records[index];
+    const EcsEntity entity = ((uint32_t)r->generation << ECS_INDEX_BITS) | index;
+    EcsArchetype* a = &world->archetypes[mask];
+    uint32_t chunk_index, row;
+    const uint32_t next_free = r->row;
+    if (!archetype_push(world, a, entity, &chunk_index, &row))
+    {
+        fprintf(stderr, "ecs: out of memory for a chunk\n");
+        return 0;
+    }
+    world->free_head = next_free;
+    r->mask = (uint16_t)mask;
+    r->chunk = chunk_index;
+    r->row = row;
+    row_defaults(a, &a->chunks[chunk_index], row);
+    ++world->live;
+    return entity;
+}
+
+void ecs_destroy_entity(EcsWorld* world, EcsEntity entity)
+{
+    EcsRecord* r = entity_record(world, entity);
+    if (!r)
+        return;
+    archetype_remove(world, &world->archetypes[r->mask], r->chunk, r->row);
+    const uint32_t generation = (r->generation + 1u) & ECS_GENERATION_MASK;
+    r->generation = (uint16_t)(generation ? generation : 1);   // no id is ever 0
+    r->row = world->free_head;
+    world->free_head = entity_index(entity);
+    --world->live;
+}
+
+bool ecs_set_mask(EcsWorld* world, EcsEntity entity, uint32_t mask)
+{
+    mask &= ECS_MASK_ALL;
+    EcsRecord* r = entity_record(world, entity);
+    if (!r)
+        return false;
+    if (r->mask == mask)
+        return true;
+
+    EcsArchetype* from = &world->archetypes[r->mask];
+    EcsArchetype* to = &world->archetypes[mask];
+    uint32_t chunk_index, row;
+    if (!archetype_push(world, to, entity, &chunk_index, &row))
+    {
+        fprintf(stderr, "ecs: out of memory for a chunk\n");
+        return false;
+    }
+    const EcsChunk* src = &from->chunks[r->chunk];
+    const EcsChunk* dst = &to->chunks[chunk_index];
+    row_defaults(to, dst, row);
+    for (int f = 0; f < ECS_FIELD_COUNT; ++f)
+    {
+        if (from->offsets[f] != SIZE_MAX && to->offsets[f] != SIZE_MAX)
+            memcpy(field_at(to, dst, f, row), field_at(from, src, f, r->row), field_info[f].size);
+    }
+    archetype_remove(world, from, r->chunk, r->row);
+    r->mask = (uint16_t)mask;
+    r->chunk = chunk_index;
+    r->row = row;
+    return true;
+}
+
+void* ecs_field(EcsWorld* world, EcsEntity entity, EcsField field)
+{
+    const EcsRecord* r = entity_record(world, entity);
+    if (!r)
+        return NULL;
+    const EcsArchetype* a = &world->archetypes[r->mask];
+    return a->offsets[field] == SIZE_MAX ? NULL : field_at(a, &a->chunks[r->chunk], field, r->row);
+}
+
+typedef struct EcsForEach
+{
+    const EcsView* views;
+    EcsChunkFunction function;
+    void* data;
+} EcsForEach;
+
+static void for_each_range(void* data, size_t begin, size_t end)
+{
+    const EcsForEach* each = (const EcsForEach*)data;
+    for (size_t v = begin; v < end; ++v)
+        each->function(each->data, &each->views[v]);
+}
+
+void ecs_for_each(EcsWorld* world, uint32_t mask, JobSystem* jobs, EcsChunkFunction function, void* data)
+{
+    // The matching chunks as one flat list, so the job system can split it evenly whatever the archetypes
+    uint32_t count = 0;
+    for (uint32_t m = 0; m < ECS_ARCHETYPE_COUNT; ++m)
+    {
+        if ((m & mask) == mask)
+            count += world->archetypes[m].chunk_count;
+    }
+    if (count > world->view_capacity)
+    {
+        EcsView* views = (EcsView*)realloc(world->views, sizeof(EcsView) * count);
+        if (!views)
+        {
+            fprintf(stderr, "ecs: out of memory for %u chunk views\n", count);
+            return;
+        }
+        world->views = views;
+        world->view_capacity = count;
+    }
+    uint32_t n = 0;
+    for (uint32_t m = 0; m < ECS_ARCHETYPE_COUNT; ++m)
+    {
+        EcsArchetype* a = &world->archetypes[m];
+        if ((m & mask) != mask)
+            continue;
+        for (uint32_t c = 0; c < a->chunk_count; ++c)
+        {
+            world->views[n].archetype = a;
+            world->views[n].chunk = &a->chunks[c];
+            ++n;
+        }
+    }
+
+    EcsForEach each = { world->views, function, data };
+    if (!jobs || jobs->thread_count == 1 || n <= ECS_FOR_EACH_GRAIN)
+        for_each_range(&each, 0, n);
+    else
+        job_wait(jobs, job_parallel_for(jobs, for_each_range, &each, n, ECS_FOR_EACH_GRAIN));
+}
+
+// sin and cos of a block of angles without libm calls, so the loop vectorizes: reduction to [-pi/4, pi/4]
+// by the nearest multiple of pi/2 (subtracted in three parts), then Cephes' minimax polynomials, swapped
+// and negated by quadrant. Within 2e-7 of libm for |a| up to ~1e4.
+static void sincos_block(const float* angle, float* sine, float* cosine, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const float fq = (angle[i] * 0.63661977236f + 12582912.f) - 12582912.f;   // 2 / pi, rounded by 1.5 * 2^23
+        const int q = (int)fq;
+        float x = angle[i] - fq * 1.5703125f;
+        x -= fq * 4.837512969970703125e-4f;
+        x -= fq * 7.54978995489188216e-8f;
+        const float x2 = x * x;
+        const float s = x + x * x2 * (-1.6666654611e-1f + x2 * (8.3321608736e-3f + x2 * -1.9515295891e-4f));
+        const float c = 1.f - 0.5f * x2 + x2 * x2 * (4.166664568298827e-2f + x2 * (-1.388731625493765e-3f + x2 * 2.443315711809948e-5f));
+        const float odd = (float)(q & 1);   // 0 or 1, so the selects below are exact and branch-free
+        const float sin_sign = (float)(1 - (q & 2));
+        const float cos_sign = (float)(1 - ((q + 1) & 2));
+        sine[i] = sin_sign * (s * (1.f - odd) + c * odd);
+        cosine[i] = cos_sign * (c * (1.f - odd) + s * odd);
+    }
+}
+
+#define ECS_TRANSFORM_BLOCK 256     // angles turned into sin/cos per pass, on the stack
+
+// MVP columns straight from the closed form of translate * scale * rotate_Z, premultiplied by the
+// view-projection's columns v0..v3: scale(k) * rotate_Z(a) only mixes v0 and v1, and the translation
+// lands in the last column.
+static void update_transforms_chunk(void* data, const EcsView* view)
+{
+    const vec4* vp = (const vec4*)data;
+    const EcsArchetype* a = view->archetype;
+    const EcsChunk* chunk = view->chunk;
+    const float* x = (const float*)ecs_chunk_field(a, chunk, ECS_FIELD_X);
+    const float* y = (const float*)ecs_chunk_field(a, chunk, ECS_FIELD_Y);
+    const float* z = (const float*)ecs_chunk_field(a, chunk, ECS_FIELD_Z);
+    const float* angle = (const float*)ecs_chunk_field(a, chunk, ECS_FIELD_ANGLE);
+    const float* scale = (const float*)ecs_chunk_field(a, chunk, ECS_FIELD_SCALE);
+    mat4x4* mvp = (mat4x4*)ecs_chunk_field(a, chunk, ECS_FIELD_MVP);
+    float sine[ECS_TRANSFORM_BLOCK], cosine[ECS_TRANSFORM_BLOCK];
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+    const __m128 v0 = _mm_loadu_ps(vp[0]), v1 = _mm_loadu_ps(vp[1]), v2 = _mm_loadu_ps(vp[2]), v3 = _mm_loadu_ps(vp[3]);
+#endif
+    for (uint32_t begin = 0; begin < chunk->count; begin += ECS_TRANSFORM_BLOCK)
+    {
+        const uint32_t n = chunk->count - begin < ECS_TRANSFORM_BLOCK ? chunk->count - begin : ECS_TRANSFORM_BLOCK;
+        sincos_block(angle + begin, sine, cosine, n);
+        for (uint32_t b = 0; b < n; ++b)
+        {
+            const uint32_t i = begin + b;
+            const float k = scale[i];
+            const float s = k * sine[b];
+            const float c = k * cosine[b];
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+            const __m128 vs = _mm_set1_ps(s), vc = _mm_set1_ps(c);
+            _mm_store_ps(mvp[i][0], _mm_add_ps(_mm_mul_ps(vc, v0), _mm_mul_ps(vs, v1)));
+            _mm_store_ps(mvp[i][1], _mm_sub_ps(_mm_mul_ps(vc, v1), _mm_mul_ps(vs, v0)));
+            _mm_store_ps(mvp[i][2], _mm_mul_ps(_mm_set1_ps(k), v2));
+            _mm_store_ps(mvp[i][3], _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(x[i]), v0), _mm_mul_ps(_mm_set1_ps(y[i]), v1)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(z[i]), v2), v3)));
+#else
+            for (int r = 0; r < 4; ++r)
+            {
+                mvp[i][0][r] = c * vp[0][r] + s * vp[1][r];
+                mvp[i][1][r] = c * vp[1][r] - s * vp[0][r];
+                mvp[i][2][r] = k * vp[2][r];
+                mvp[i][3][r] = x[i] * vp[0][r] + y[i] * vp[1][r] + z[i] * vp[2][r] + vp[3][r];
+            }
+#endif
+        }
+    }
+}
+
+void ecs_update_transforms(EcsWorld* world, JobSystem* jobs, mat4x4 const view_projection)
+{
+    mat4x4 vp;
+    mat4x4_dup(vp, view_projection);
+    ecs_for_each(world, ECS_MASK(ECS_TRANSFORM), jobs, update_transforms_chunk, vp);
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct JobSystem JobSystem;
+
+// Archetype-based entity component system for scene objects.
+//
+// An entity's archetype is the set of components it has (a bit mask). Every
+// archetype stores its entities in chunks of ECS_CHUNK_CAPACITY, and a chunk
+// keeps each component field as its own contiguous array (SoA, 64-byte
+// aligned), so a system touches only the fields it reads and streams through
+// them linearly. There is one archetype slot per possible mask, so finding
+// an entity's archetype is an array index.
+//
+// Entities are 32-bit ids: a slot in the entity table plus its generation, so
+// an id kept after its entity was destroyed is detected, never aliased.
+// Destroying an entity moves the chunk's last entity into the hole, so
+// chunks stay dense. Changing an entity's components moves it to the chunk
+// of its new archetype, keeping the fields both archetypes share.
+//
+// Systems run per chunk with ecs_for_each, which spreads the matching chunks
+// over a job system.
+//
+// With huge pages enabled when the world is made (core/huge_pages.h), chunks
+// are carved out of huge-page blocks, a huge page each, so a system's walk
+// over a big world touches a TLB entry per block rather than per 4 KB. Chunk
+// memory is only given back by ecs_destroy either way.
+
+#define ECS_CHUNK_CAPACITY 1024     // entities per chunk; a multiple of 8 keeps every field array 64-byte aligned
+
+typedef uint32_t EcsEntity;         // 0 is never a valid entity
+
+typedef enum EcsComponent
+{
+    ECS_TRANSFORM,      // position, rotation about Z, uniform scale, and the MVP derived from them
+    ECS_MESH_REF,       // which mesh to draw
+    ECS_MATERIAL,       // which material to draw it with
+    ECS_BOUNDS,         // bounding sphere radius around the position
+    ECS_COMPONENT_COUNT
+} EcsComponent;
+
+#define ECS_MASK(component) (1u << (component))
+#define ECS_MASK_ALL ((1u << ECS_COMPONENT_COUNT) - 1u)
+#define ECS_ARCHETYPE_COUNT (1 << ECS_COMPONENT_COUNT)
+
+// The arrays a chunk can hold; each belongs to one component
+typedef enum EcsField
+{
+    ECS_FIELD_X,            // float, Transform
+    ECS_FIELD_Y,            // float, Transform
+    ECS_FIELD_Z,            // float, Transform
+    ECS_FIELD_ANGLE,        // float, Transform: radians about Z
+    ECS_FIELD_SCALE,        // float, Transform
+    ECS_FIELD_MVP,          // mat4x4, Transform: written by ecs_update_transforms
+    ECS_FIELD_MESH,         // uint32_t, MeshRef
+    ECS_FIELD_MATERIAL,     // uint32_t, Material
+    ECS_FIELD_RADIUS,       // float, Bounds
+    ECS_FIELD_COUNT
+} EcsField;
+
+typedef struct EcsChunk
+{
+    unsigned char* data;            // every field array of the archetype, then the entity ids
+    uint32_t count;
+} EcsChunk;
+
+typedef struct EcsArchetype
+{
+    uint32_t mask;
+    size_t offsets[ECS_FIELD_COUNT];    // of each field array in a chunk; SIZE_MAX when the archetype lacks it
+    size_t entities_offset;             // of the EcsEntity array
+    size_t chunk_bytes;
+    EcsChunk* chunks;                   // full ones first, the last one may be partial
+    uint32_t chunk_count;
+    uint32_t chunk_capacity;
+    size_t entity_count;
+} EcsArchetype;
+
+// Where an entity lives
+typedef struct EcsRecord
+{
+    uint16_t generation;
+    uint16_t mask;              // archetype
+    uint32_t chunk;
+    uint32_t row;               // next free slot while the record isn't in use
+} EcsRecord;
+
+// A system's view of one chunk
+typedef struct EcsView
+{
+    const EcsArchetype* archetype;
+    EcsChunk* chunk;
+} EcsView;
+
+typedef struct EcsWorld
+{
+    EcsArchetype archetypes[ECS_ARCHETYPE_COUNT];   // indexed by mask
+    EcsRecord* records;
+    uint32_t capacity;          // most entities alive at once
+    uint32_t free_head;
+    uint32_t live;
+    EcsView* views;             // ecs_for_each's list of matching chunks
+    uint32_t view_capacity;
+    bool huge_pages;            // chunks come from "blocks"
+    unsigned char** blocks;     // huge_pages_alloc'd, block_size bytes each
+    uint32_t block_count;
+    size_t block_size;
+    size_t block_used;          // bytes handed out of the last block
+} EcsWorld;
+
+// Room for "max_entities" alive at once (up to 2^20). Logs and returns false when out of memory.
+bool ecs_init(EcsWorld* world, uint32_t max_entities);
+void ecs_destroy(EcsWorld* world);
+
+// A new entity with the components in "mask", fields zeroed except Transform's scale (1) and MVP (identity).
+// Logs and returns 0 when the world is full or out of memory.
+EcsEntity ecs_create(EcsWorld* world, uint32_t mask);
+void ecs_destroy_entity(EcsWorld* world, EcsEntity entity);
+bool ecs_alive(const EcsWorld* world, EcsEntity entity);
+
+// The entity's component mask (0 when it isn't alive)
+uint32_t ecs_mask(const EcsWorld* world, EcsEntity entity);
+
+// Adds and removes components: moves the entity to the archetype for "mask". Fields both archetypes have
+// keep their values, new ones start as in ecs_create. Returns false (and changes nothing) on failure.
+bool ecs_set_mask(EcsWorld* world, EcsEntity entity, uint32_t mask);
+
+// The entity's element of "field" (random access, for setup and picking); NULL if it lacks the component
+void* ecs_field(EcsWorld* world, EcsEntity entity, EcsField field);
+
+// A chunk's array of "field", "chunk->count" entries long (NULL when the archetype lacks it)
+static inline void* ecs_chunk_field(const EcsArchetype* archetype, const EcsChunk* chunk, EcsField field)
+{
+    return archetype->offsets[field] == SIZE_MAX ? NULL : chunk->data + archetype->offsets[field];
+}
+
+static inline const EcsEntity* ecs_chunk_entities(const EcsArchetype* archetype, const EcsChunk* chunk)
+{
+    return (const EcsEntity*)(chunk->data + archetype->entities_offset);
+}
+
+// Calls "function" on every chunk of every archetype that has all of "mask". With a job system (NULL: the
+// calling thread only) chunks run in parallel, so "function" must only write to the chunk it's given.
+// Entities may not be created, destroyed or moved until it returns.
+typedef void (*EcsChunkFunction)(void* data, const EcsView* view);
+void ecs_for_each(EcsWorld* world, uint32_t mask, JobSystem* jobs, EcsChunkFunction function, void* data);
+
+// Transform system: MVP = view_projection * translate(x, y, z) * scale(scale) * rotate_Z(angle) for every
+// entity with a Transform
+void ecs_update_transforms(EcsWorld* world, JobSystem* jobs, mat4x4 const view_projection);
@@ -0,0 +1,116 @@
+#include "scene/frustum.h"
+
+#include "linmath_bounds.h"
+
+#include <math.h>
+
+void frustum_from_matrix(Frustum* frustum, mat4x4 const M)
+{
+    // linmath is column-major (M[column][row]): a clip-space coordinate is dot(row, p), and the
+    // planes are row 3 +- rows 0..2
+    for (int i = 0; i < 6; ++i)
+    {
+        const int row = i / 2;
+        const float sign = (i & 1) ? -1.f : 1.f;
+        float* plane = frustum->planes[i];
+        for (int c = 0; c < 4; ++c)
+            plane[c] = M[c][3] + sign * M[c][row];
+        const float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        const float scale = length > 0.f ? 1.f / length : 0.f;
+        for (int c = 0; c < 4; ++c)
+            plane[c] *= scale;
+    }
+}
+
+// Appends base + lane for every set bit of "mask" without branching on it: every lane is written, and the
+// output position only advances past the visible ones
+static size_t append_mask(uint32_t* visible, size_t n, unsigned int mask, size_t base, int lanes)
+{
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        visible[n] = (uint32_t)(base + lane);
+        n += (mask >> lane) & 1;
+    }
+    return n;
+}
+
+static bool sphere_visible(const Frustum* f, float x, float y, float z, float r)
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* plane = f->planes[p];
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < -r)
+            return false;
+    }
+    return true;
+}
+
+static bool aabb_visible(const Frustum* f, float cx, float cy, float cz, float ex, float ey, float ez)
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        const float* plane = f->planes[p];
+        const float d = plane[0] * cx + plane[1] * cy + plane[2] * cz + plane[3];
+        const float e = fabsf(plane[0]) * ex + fabsf(plane[1]) * ey + fabsf(plane[2]) * ez;
+        if (d + e < 0.f)
+            return false;
+    }
+    return true;
+}
+
+size_t frustum_cull_spheres(const Frustum* frustum, const float* x, const float* y, const float* z,
+    const float* radius, size_t count, uint32_t* visible)
+{
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const unsigned int mask = planes_test_spheres8(frustum->planes, 6, x + i, y + i, z ? z + i : NULL, radius + i);
+        n = append_mask(visible, n, mask, i, 8);
+    }
+    for (; i < count; ++i)
+    {
+        visible[n] = (uint32_t)i;
+        n += sphere_visible(frustum, x[i], y[i], z ? z[i] : 0.f, radius[i]);
+    }
+    return n;
+}
+
+size_t frustum_cull_aabbs(const Frustum* frustum, const float* cx, const float* cy, const float* cz,
+    const float* ex, const float* ey, const float* ez, size_t count, uint32_t* visible)
+{
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const unsigned int mask = planes_test_aabbs8(frustum->planes, 6, cx + i, cy + i, cz + i, ex + i, ey + i, ez + i);
+        n = append_mask(visible, n, mask, i, 8);
+    }
+    for (; i < count; ++i)
+    {
+        visible[n] = (uint32_t)i;
+        n += aabb_visible(frustum, cx[i], cy[i], cz[i], ex[i], ey[i], ez[i]);
+    }
+    return n;
+}
+
+int frustum_aabb_planes(const Frustum* frustum, const vec3 min, const vec3 max, int mask)
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        if (!(mask & (1 << p)))
+            continue;
+        const float* plane = frustum->planes[p];
+        float d = plane[3], e = 0.f;
+        for (int k = 0; k < 3; ++k)
+        {
+            d += plane[k] * 0.5f * (min[k] + max[k]);
+            e += fabsf(plane[k]) * 0.5f * (max[k] - min[k]);
+        }
+        if (d + e < 0.f)
+            return -1;
+        if (d - e >= 0.f)
+            mask &= ~(1 << p);
+    }
+    return mask;
+}
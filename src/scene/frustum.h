@@ -0,0 +1,39 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// View-frustum culling.
+//
+// frustum_from_matrix extracts the six clip planes from a combined
+// (model-)view-projection matrix (Gribb & Hartmann), so it works for
+// mat4x4_frustum, mat4x4_perspective and mat4x4_ortho alike. Bounds are then
+// tested in structure-of-arrays form, 8 at a time by linmath_bounds.h's plane
+// tests, and the indices of the visible ones are written out compacted, ready
+// to drive instancing or draw lists.
+//
+// Tests are conservative: a bound is only rejected when it lies entirely
+// outside one plane, so a few bounds near the frustum's corners survive.
+
+typedef struct Frustum
+{
+    vec4 planes[6];     // (n, d), |n| = 1, inside when dot(n, p) + d >= 0: left, right, bottom, top, near, far
+} Frustum;
+
+// Planes of clip space [-w, w]^3 (GL conventions) for "M" - pass projection * view to cull in world space
+void frustum_from_matrix(Frustum* frustum, mat4x4 const M);
+
+// Spheres at (x, y, z)[i] with radius[i]; z may be NULL for bounds in the z = 0 plane. Writes the index of
+// every sphere that may be visible to "visible" (room for "count") and returns how many were written.
+size_t frustum_cull_spheres(const Frustum* frustum, const float* x, const float* y, const float* z,
+    const float* radius, size_t count, uint32_t* visible);
+
+// Axis-aligned boxes given as center (cx, cy, cz)[i] and half-extents (ex, ey, ez)[i]; same output as above
+size_t frustum_cull_aabbs(const Frustum* frustum, const float* cx, const float* cy, const float* cz,
+    const float* ex, const float* ey, const float* ez, size_t count, uint32_t* visible);
+
+// One box against the planes set in "mask" (bit p: planes[p]; 0x3F for all six): -1 when it's wholly outside one of
+// them, else "mask" less the planes it's wholly inside, so a hierarchy's children needn't test those again
+int frustum_aabb_planes(const Frustum* frustum, const vec3 min, const vec3 max, int mask);
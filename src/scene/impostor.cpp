@@ -0,0 +1,82 @@
+#include "scene/impostor.h"
+
+#include "scene/lod.h"
+
+#include <math.h>
+
+#define IMPOSTOR_PI 3.14159265358979f
+
+void impostor_frame_direction(int column, int row, vec3 dir)
+{
+    const float yaw = 2.f * IMPOSTOR_PI * (float)column / IMPOSTOR_YAW_FRAMES;
+    const float elevation = IMPOSTOR_PI * (((float)row + 0.5f) / IMPOSTOR_PITCH_FRAMES - 0.5f);
+    const float c = linmath_cosf(elevation);
+    dir[0] = c * linmath_cosf(yaw);
+    dir[1] = c * linmath_sinf(yaw);
+    dir[2] = linmath_sinf(elevation);
+}
+
+void impostor_nearest_frame(const vec3 dir, int* column, int* row)
+{
+    // The nearest yaw, and the row whose slice of elevations holds the direction's
+    const float yaw = atan2f(dir[1], dir[0]);
+    int c = (int)floorf(yaw * (IMPOSTOR_YAW_FRAMES / (2.f * IMPOSTOR_PI)) + 0.5f);
+    *column = (c % IMPOSTOR_YAW_FRAMES + IMPOSTOR_YAW_FRAMES) % IMPOSTOR_YAW_FRAMES;
+    const float from_top = linmath_acosf(dir[2] / vec3_len(dir));   // 0 straight above, pi straight below
+    const int r = (int)floorf((1.f - from_top / IMPOSTOR_PI) * IMPOSTOR_PITCH_FRAMES);
+    *row = r < 0 ? 0 : r >= IMPOSTOR_PITCH_FRAMES ? IMPOSTOR_PITCH_FRAMES - 1 : r;
+}
+
+void impostor_frame_basis(int column, int row, vec3 right, vec3 up)
+{
+    // mat4x4_look_at's, from the direction towards the centre with +z up: no row looks along z, so it's never
+    // degenerate
+    vec3 dir, forward;
+    impostor_frame_direction(column, row, dir);
+    vec3_scale(forward, dir, -1.f);
+    const float yaw = 2.f * IMPOSTOR_PI * (float)column / IMPOSTOR_YAW_FRAMES;
+    right[0] = -linmath_sinf(yaw);
+    right[1] = linmath_cosf(yaw);
+    right[2] = 0.f;
+    vec3_mul_cross(up, right, forward);
+}
+
+void impostor_frame_matrix(int column, int row, float radius, mat4x4 view_projection)
+{
+    const float extent = radius / IMPOSTOR_FRAME_FILL;
+    vec3 dir, eye;
+    impostor_frame_direction(column, row, dir);
+    vec3_scale(eye, dir, 2.f * extent);
+    const vec3 centre = { 0.f, 0.f, 0.f }, up = { 0.f, 0.f, 1.f };
+    mat4x4 view, projection;
+    mat4x4_look_at(view, eye, centre, up);
+    mat4x4_ortho(projection, -extent, extent, -extent, extent, extent, 3.f * extent);  // the mesh's sphere and more
+    mat4x4_mul(view_projection, projection, view);
+}
+
+void impostor_select_range(void* data, size_t begin, size_t end)
+{
+    const ImpostorSelection* s = (const ImpostorSelection*)data;
+    const float coarsen = s->threshold, refine = s->threshold * (1.f + s->hysteresis);
+    for (size_t k = begin; k < end; ++k)
+    {
+        const uint32_t i = s->visible ? s->visible[k] : (uint32_t)k;
+        const float pixels = 2.f * s->radius[i]
+            * lod_pixel_scale(s->vp, s->x[i], s->y[i], s->z ? s->z[i] : 0.f, s->viewport_height);
+        s->impostor[i] = pixels < (s->impostor[i] ? refine : coarsen) ? 1 : 0;
+    }
+}
+
+size_t impostor_partition(const uint8_t* impostor, const uint32_t* visible, size_t count, uint32_t* split)
+{
+    size_t meshes = 0;
+    for (size_t k = 0; k < count; ++k)
+        meshes += !impostor[visible ? visible[k] : k];
+    size_t mesh = 0, billboard = meshes;
+    for (size_t k = 0; k < count; ++k)
+    {
+        const uint32_t i = visible ? visible[k] : (uint32_t)k;
+        split[impostor[i] ? billboard++ : mesh++] = i;
+    }
+    return meshes;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Impostors: objects too small on screen for their mesh to matter drawn as
+// one textured quad each, all in one instanced draw.
+//
+// The mesh is baked once into an atlas of frames, each an orthographic view
+// of it from one direction: IMPOSTOR_YAW_FRAMES around its z axis by
+// IMPOSTOR_PITCH_FRAMES from below to above, the rows' elevations centred
+// in equal slices of [-90, 90] degrees so no frame looks straight along z.
+// Frame (column, row) takes up that cell of the atlas, column along u and
+// row along v, and the mesh's bounding circle fills IMPOSTOR_FRAME_FILL of
+// it, so the cells' mip levels keep a margin before they bleed together.
+//
+// At draw time an object's quad is the frame nearest the direction it's seen
+// from, in its own space: the quad lies where the frame's image plane went
+// through its centre, carried by its model matrix, so a frame shows the
+// object the way the mesh would within half a frame's angle.
+//
+// Which objects are impostors is chosen on the CPU by how many pixels their
+// bounding circle spans, with hysteresis against flicker at the boundary as
+// lod.h has; the impostors then go after the meshes in the visible list.
+
+#define IMPOSTOR_YAW_FRAMES 16      // atlas columns: one every 22.5 degrees around the object's z axis
+#define IMPOSTOR_PITCH_FRAMES 8     // atlas rows, from below to above
+#define IMPOSTOR_FRAME_FILL 0.875f  // of a frame's width, the bounding circle's diameter
+
+// The direction frame ("column", "row") is seen from: a unit vector in the object's space, from its centre
+// towards the viewer
+void impostor_frame_direction(int column, int row, vec3 dir);
+
+// The frame seen from nearest "dir" (object space, from the centre towards the viewer; any length but 0)
+void impostor_nearest_frame(const vec3 dir, int* column, int* row);
+
+// The frame's image plane in object space: "right" along its u and "up" along its v, unit and orthogonal to
+// its direction
+void impostor_frame_basis(int column, int row, vec3 right, vec3 up);
+
+// The orthographic projection * view a frame is baked with, for a mesh within "radius" of its origin: the
+// frame's square spans radius / IMPOSTOR_FRAME_FILL either side of the centre
+void impostor_frame_matrix(int column, int row, float radius, mat4x4 view_projection);
+
+// Objects of a scene choosing between their mesh and their impostor, a range at a time
+typedef struct ImpostorSelection
+{
+    vec4 const* vp;             // projection * view
+    float viewport_height;
+    float threshold;            // pixels: an object whose bounding circle spans fewer is an impostor
+    float hysteresis;           // and stays one until it spans threshold * (1 + hysteresis)
+    const float* x;             // [object]: positions; z may be NULL for objects in the z = 0 plane
+    const float* y;
+    const float* z;
+    const float* radius;        // [object]: bounding circles
+    const uint32_t* visible;    // NULL: objects 0 .. count in order
+    uint8_t* impostor;          // [object]: 1 where it was drawn as an impostor last, updated
+} ImpostorSelection;
+
+// Updates the choice of visible entries [begin, end): a JobRangeFunction over the visible list
+void impostor_select_range(void* selection, size_t begin, size_t end);
+
+// Writes the "count" objects of "visible" (NULL: 0 .. count - 1) to "split", those drawn with their mesh
+// first and then the impostors, each in their visible order. Returns how many have their mesh.
+size_t impostor_partition(const uint8_t* impostor, const uint32_t* visible, size_t count, uint32_t* split);
@@ -0,0 +1,62 @@
+#include "scene/lod.h"
+
+#include <math.h>
+#include <string.h>
+
+float lod_pixel_scale(mat4x4 const vp, float x, float y, float z, float viewport_height)
+{
+    // Clip y is row 1 (vp[column][1]); its xyz length is how fast clip y grows per world unit, at w = 1
+    const float w = vp[0][3] * x + vp[1][3] * y + vp[2][3] * z + vp[3][3];
+    const float dy = sqrtf(vp[0][1] * vp[0][1] + vp[1][1] * vp[1][1] + vp[2][1] * vp[2][1]);
+    return w > 0.f ? 0.5f * viewport_height * dy / w : INFINITY;  // at or behind the eye: the finest level
+}
+
+// The coarsest level whose projected error stays within "limit" pixels (level 0 always does)
+static int coarsest_within(const LodChain* chain, float pixel_scale, float limit)
+{
+    int level = 0;
+    while (level + 1 < chain->level_count && chain->error[level + 1] * pixel_scale <= limit)
+        ++level;
+    return level;
+}
+
+int lod_select(const LodChain* chain, float pixel_scale, int current, float threshold, float hysteresis)
+{
+    if (current >= chain->level_count)
+        current = chain->level_count - 1;
+    if (chain->error[current] * pixel_scale > threshold)
+        return coarsest_within(chain, pixel_scale, threshold);
+    const int relaxed = coarsest_within(chain, pixel_scale, threshold * (1.f - hysteresis));
+    return relaxed > current ? relaxed : current;
+}
+
+void lod_select_range(void* data, size_t begin, size_t end)
+{
+    const LodSelection* s = (const LodSelection*)data;
+    for (size_t k = begin; k < end; ++k)
+    {
+        const uint32_t i = s->visible ? s->visible[k] : (uint32_t)k;
+        const float scale = lod_pixel_scale(s->vp, s->x[i], s->y[i], s->z ? s->z[i] : 0.f, s->viewport_height);
+        s->lod[i] = (uint8_t)lod_select(s->chain, scale, s->lod[i], s->threshold, s->hysteresis);
+    }
+}
+
+void lod_group(const uint8_t* lod, const uint32_t* visible, size_t count, uint32_t* grouped,
+    uint32_t counts[LOD_MAX_LEVELS])
+{
+    memset(counts, 0, sizeof(uint32_t) * LOD_MAX_LEVELS);
+    for (size_t k = 0; k < count; ++k)
+        ++counts[lod[visible ? visible[k] : k]];
+    uint32_t start[LOD_MAX_LEVELS];
+    uint32_t first = 0;
+    for (int l = 0; l < LOD_MAX_LEVELS; ++l)
+    {
+        start[l] = first;
+        first += counts[l];
+    }
+    for (size_t k = 0; k < count; ++k)
+    {
+        const uint32_t i = visible ? visible[k] : (uint32_t)k;
+        grouped[start[lod[i]]++] = i;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Runtime level-of-detail selection by projected screen-space error.
+//
+// Each level of a mesh comes with how far its surface may be from level 0's
+// (asset/mesh_simplify.h measures it offline). Through the view-projection
+// matrix that distance becomes pixels at an object's position: the level
+// drawn is the coarsest whose error stays under a threshold, typically a
+// pixel. Hysteresis keeps objects near a boundary from popping back and
+// forth: refining happens as soon as the current level is too coarse, but
+// coarsening waits until the coarser level is well under the threshold.
+//
+// lod_group then orders a visible list by level, so each level's objects
+// are contiguous and draw in one instanced call.
+
+#define LOD_MAX_LEVELS 8
+
+typedef struct LodChain
+{
+    int level_count;            // 1 .. LOD_MAX_LEVELS; 1 means there is nothing to choose
+    float error[LOD_MAX_LEVELS];    // non-decreasing, in the object's world units; error[0] = 0
+} LodChain;
+
+// Pixels one world unit at (x, y, z) covers on a viewport "viewport_height" pixels tall, through "vp"
+// (projection * view). The y axis is measured, so the aspect ratio doesn't matter.
+float lod_pixel_scale(mat4x4 const vp, float x, float y, float z, float viewport_height);
+
+// The level to draw where a world unit is "pixel_scale" pixels, given the one drawn last ("current"): the
+// coarsest within "threshold" pixels, but only coarser than "current" once within threshold * (1 - hysteresis).
+int lod_select(const LodChain* chain, float pixel_scale, int current, float threshold, float hysteresis);
+
+// Objects of a scene choosing their levels, a range at a time
+typedef struct LodSelection
+{
+    const LodChain* chain;
+    vec4 const* vp;             // projection * view
+    float viewport_height;
+    float threshold;            // pixels
+    float hysteresis;
+    const float* x;             // [object]: positions; z may be NULL for objects in the z = 0 plane
+    const float* y;
+    const float* z;
+    const uint32_t* visible;    // NULL: objects 0 .. count in order
+    uint8_t* lod;               // [object]: the level drawn last, updated
+} LodSelection;
+
+// Updates the levels of visible entries [begin, end): a JobRangeFunction over the visible list
+void lod_select_range(void* selection, size_t begin, size_t end);
+
+// Writes the "count" objects of "visible" (NULL: 0 .. count - 1) to "grouped" ordered by their level in "lod",
+// finest first and otherwise in their visible order, and how many there are of each level to "counts".
+void lod_group(const uint8_t* lod, const uint32_t* visible, size_t count, uint32_t* grouped,
+    uint32_t counts[LOD_MAX_LEVELS]);
@@ -0,0 +1,474 @@
+#include "scene/occlusion_raster.h"
+
+#include "core/job_system.h"
+#include "linmath_batch.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GUARD_BAND 4.f      // occluder vertices further off-centre than this many viewports are left out
+#define EDGE_BIAS 1e-3f     // pixels every edge is pulled in by, against rounding in the edge functions
+#define RENDER_GRAIN 8      // tiles per job
+#define CULL_GRAIN 2048     // boxes per job
+#define CULL_BLOCK 32       // boxes whose corners go through the transform at once
+#define HIDDEN UINT32_MAX
+
+struct OcclusionTriangle
+{
+    float a[3];             // edge functions a x + b y + c of pixel coordinates, >= 0 where the pixel is wholly inside
+    float b[3];
+    float c[3];
+    float z;                // the farthest depth the triangle has within pixel (x, y) is z + zx x + zy y
+    float zx;
+    float zy;
+    float z_max;            // but no farther than its farthest vertex
+    int x0, y0, x1, y1;     // pixels it may cover, inclusive, on screen
+};
+
+bool occlusion_raster_init(OcclusionRaster* r, int width, int height, uint32_t max_triangles)
+{
+    memset(r, 0, sizeof(*r));
+    r->tiles_x = (width > 0 ? width + OCCLUSION_TILE_WIDTH - 1 : OCCLUSION_TILE_WIDTH) / OCCLUSION_TILE_WIDTH;
+    r->tiles_y = (height > 0 ? height + OCCLUSION_TILE_HEIGHT - 1 : OCCLUSION_TILE_HEIGHT) / OCCLUSION_TILE_HEIGHT;
+    r->width = r->tiles_x * OCCLUSION_TILE_WIDTH;
+    r->height = r->tiles_y * OCCLUSION_TILE_HEIGHT;
+    const size_t tiles = (size_t)r->tiles_x * r->tiles_y;
+    const size_t vertices = 3 * (size_t)max_triangles + 4;
+    r->depth = (float*)linmath_aligned_alloc(sizeof(float) * r->width * r->height, LINMATH_BATCH_ALIGN);
+    r->tile_max = (float*)malloc(sizeof(float) * tiles);
+    r->triangles = (OcclusionTriangle*)malloc(sizeof(OcclusionTriangle) * (max_triangles + 1));
+    for (int k = 0; k < 4; ++k)
+        r->clip[k] = (float*)linmath_aligned_alloc(sizeof(float) * vertices, LINMATH_BATCH_ALIGN);
+    r->bin_start = (uint32_t*)calloc(tiles + 1, sizeof(uint32_t));
+    r->bin_capacity = 2 * (size_t)max_triangles + 1;
+    r->bin = (uint32_t*)malloc(sizeof(uint32_t) * r->bin_capacity);
+    if (!r->depth || !r->tile_max || !r->triangles || !r->clip[0] || !r->clip[1] || !r->clip[2] || !r->clip[3]
+        || !r->bin_start || !r->bin)
+    {
+        fprintf(stderr, "occlusion_raster: out of memory for %dx%d pixels and %u triangles\n", r->width, r->height,
+            max_triangles);
+        occlusion_raster_destroy(r);
+        return false;
+    }
+    r->capacity = max_triangles;
+    for (size_t i = 0; i < (size_t)r->width * r->height; ++i)
+        r->depth[i] = 1.f;
+    for (size_t t = 0; t < tiles; ++t)
+        r->tile_max[t] = 1.f;
+    mat4x4_identity(r->view_projection);
+    return true;
+}
+
+void occlusion_raster_destroy(OcclusionRaster* r)
+{
+    linmath_aligned_free(r->depth);
+    free(r->tile_max);
+    free(r->triangles);
+    for (int k = 0; k < 4; ++k)
+        linmath_aligned_free(r->clip[k]);
+    free(r->bin_start);
+    free(r->bin);
+    memset(r, 0, sizeof(*r));
+}
+
+void occlusion_raster_begin(OcclusionRaster* r, mat4x4 const view_projection)
+{
+    mat4x4_dup(r->view_projection, view_projection);
+    r->triangle_count = 0;
+    r->dropped = 0;
+}
+
+// Sets up the triangle of clip-space vertices v, v + 1 and v + 2 in pixel coordinates. False when it's left out.
+static bool triangle_setup(const OcclusionRaster* r, uint32_t v, OcclusionTriangle* t)
+{
+    float sx[3], sy[3], sz[3];
+    const float half_w = 0.5f * (float)r->width, half_h = 0.5f * (float)r->height;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float w = r->clip[3][v + k];
+        if (!(w > 0.f) || !(r->clip[2][v + k] >= -w))     // in front of the near plane, or NaN
+            return false;
+        const float inv_w = 1.f / w;
+        sx[k] = half_w * (r->clip[0][v + k] * inv_w + 1.f);
+        sy[k] = half_h * (r->clip[1][v + k] * inv_w + 1.f);
+        sz[k] = r->clip[2][v + k] * inv_w;
+        if (!(fabsf(sx[k] - half_w) <= GUARD_BAND * half_w) || !(fabsf(sy[k] - half_h) <= GUARD_BAND * half_h))
+            return false;
+    }
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+    if (!(fabsf(area) >= 2.f))      // under a pixel: it can't cover one whole
+        return false;
+    if (area < 0.f)                 // counter-clockwise from here on
+    {
+        float s = sx[1]; sx[1] = sx[2]; sx[2] = s;
+        s = sy[1]; sy[1] = sy[2]; sy[2] = s;
+        s = sz[1]; sz[1] = sz[2]; sz[2] = s;
+        area = -area;
+    }
+    t->x0 = (int)floorf(fminf(fminf(sx[0], sx[1]), sx[2]));
+    t->y0 = (int)floorf(fminf(fminf(sy[0], sy[1]), sy[2]));
+    t->x1 = (int)ceilf(fmaxf(fmaxf(sx[0], sx[1]), sx[2])) - 1;
+    t->y1 = (int)ceilf(fmaxf(fmaxf(sy[0], sy[1]), sy[2])) - 1;
+    t->x0 = t->x0 > 0 ? t->x0 : 0;
+    t->y0 = t->y0 > 0 ? t->y0 : 0;
+    t->x1 = t->x1 < r->width - 1 ? t->x1 : r->width - 1;
+    t->y1 = t->y1 < r->height - 1 ? t->y1 : r->height - 1;
+    if (t->x0 > t->x1 || t->y0 > t->y1)
+        return false;
+
+    // Edge i to i + 1 at the pixel's centre, less the most it falls across the pixel
+    for (int e = 0; e < 3; ++e)
+    {
+        const int i = e, j = e == 2 ? 0 : e + 1;
+        const float a = sy[i] - sy[j], b = sx[j] - sx[i];
+        t->a[e] = a;
+        t->b[e] = b;
+        t->c[e] = sx[i] * sy[j] - sy[i] * sx[j] + 0.5f * (a + b) - (0.5f + EDGE_BIAS) * (fabsf(a) + fabsf(b));
+    }
+    // The depth plane at the pixel's centre, plus the most it rises across the pixel
+    const float dx1 = sx[1] - sx[0], dy1 = sy[1] - sy[0], dx2 = sx[2] - sx[0], dy2 = sy[2] - sy[0];
+    const float dz1 = sz[1] - sz[0], dz2 = sz[2] - sz[0];
+    t->zx = (dz1 * dy2 - dz2 * dy1) / area;
+    t->zy = (dz2 * dx1 - dz1 * dx2) / area;
+    t->z = sz[0] + t->zx * (0.5f - sx[0]) + t->zy * (0.5f - sy[0]) + 0.5f * (fabsf(t->zx) + fabsf(t->zy));
+    t->z_max = fmaxf(fmaxf(sz[0], sz[1]), sz[2]);
+    return true;
+}
+
+uint32_t occlusion_raster_add(OcclusionRaster* r, const float* x, const float* y, const float* z,
+    uint32_t vertex_count)
+{
+    uint32_t n = vertex_count / 3 * 3;
+    const uint32_t room = 3 * (r->capacity - r->triangle_count);
+    if (n > room)
+    {
+        r->dropped += (n - room) / 3;
+        n = room;
+    }
+    mat4x4_transform_soa(r->clip[0], r->clip[1], r->clip[2], r->clip[3], r->view_projection, x, y, z, NULL, n);
+    uint32_t kept = 0;
+    for (uint32_t v = 0; v < n; v += 3)
+    {
+        if (triangle_setup(r, v, &r->triangles[r->triangle_count]))
+        {
+            ++r->triangle_count;
+            ++kept;
+        }
+        else
+            ++r->dropped;
+    }
+    return kept;
+}
+
+// Clears tile "tile", draws the triangles binned to it and finds its farthest depth
+static void render_tile(OcclusionRaster* r, int tile)
+{
+    const int px0 = tile % r->tiles_x * OCCLUSION_TILE_WIDTH, py0 = tile / r->tiles_x * OCCLUSION_TILE_HEIGHT;
+    const int px1 = px0 + OCCLUSION_TILE_WIDTH - 1, py1 = py0 + OCCLUSION_TILE_HEIGHT - 1;
+    for (int y = py0; y <= py1; ++y)
+    {
+        float* row = r->depth + (size_t)y * r->width;
+        for (int x = px0; x <= px1; ++x)
+            row[x] = 1.f;
+    }
+    for (uint32_t k = r->bin_start[tile]; k < r->bin_start[tile + 1]; ++k)
+    {
+        const OcclusionTriangle* t = &r->triangles[r->bin[k]];
+        const int x0 = (t->x0 > px0 ? t->x0 : px0) & ~3, x1 = t->x1 < px1 ? t->x1 : px1;
+        const int y0 = t->y0 > py0 ? t->y0 : py0, y1 = t->y1 < py1 ? t->y1 : py1;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+        // Four pixels a step: the lanes past the triangle's bounds fail its edges
+        const __m128 lane = _mm_setr_ps(0.f, 1.f, 2.f, 3.f), zero = _mm_setzero_ps();
+        const __m128 a0 = _mm_set1_ps(t->a[0]), a1 = _mm_set1_ps(t->a[1]), a2 = _mm_set1_ps(t->a[2]);
+        const __m128 zx = _mm_set1_ps(t->zx), z_max = _mm_set1_ps(t->z_max);
+        for (int y = y0; y <= y1; ++y)
+        {
+            float* row = r->depth + (size_t)y * r->width;
+            const __m128 e0 = _mm_set1_ps(t->b[0] * (float)y + t->c[0]);
+            const __m128 e1 = _mm_set1_ps(t->b[1] * (float)y + t->c[1]);
+            const __m128 e2 = _mm_set1_ps(t->b[2] * (float)y + t->c[2]);
+            const __m128 zy = _mm_set1_ps(t->zy * (float)y + t->z);
+            for (int x = x0; x <= x1; x += 4)
+            {
+                const __m128 vx = _mm_add_ps(_mm_set1_ps((float)x), lane);
+                const __m128 inside = _mm_and_ps(_mm_and_ps(
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, vx), e0), zero),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, vx), e1), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, vx), e2), zero));
+                const __m128 z = _mm_min_ps(_mm_add_ps(_mm_mul_ps(zx, vx), zy), z_max);
+                const __m128 d = _mm_load_ps(row + x);
+                _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(d, z)), _mm_andnot_ps(inside, d)));
+            }
+        }
+#else
+        for (int y = y0; y <= y1; ++y)
+        {
+            float* row = r->depth + (size_t)y * r->width;
+            for (int x = x0; x <= x1; ++x)
+            {
+                const float fx = (float)x, fy = (float)y;
+                if (t->a[0] * fx + t->b[0] * fy + t->c[0] >= 0.f && t->a[1] * fx + t->b[1] * fy + t->c[1] >= 0.f
+                    && t->a[2] * fx + t->b[2] * fy + t->c[2] >= 0.f)
+                    row[x] = fminf(row[x], fminf(t->z + t->zx * fx + t->zy * fy, t->z_max));
+            }
+        }
+#endif
+    }
+    float farthest = -FLT_MAX;
+    for (int y = py0; y <= py1; ++y)
+    {
+        const float* row = r->depth + (size_t)y * r->width;
+        for (int x = px0; x <= px1; ++x)
+            farthest = row[x] > farthest ? row[x] : farthest;
+    }
+    r->tile_max[tile] = farthest;
+}
+
+static void render_range(void* data, size_t begin, size_t end)
+{
+    OcclusionRaster* r = (OcclusionRaster*)data;
+    for (size_t tile = begin; tile < end; ++tile)
+        render_tile(r, (int)tile);
+}
+
+void occlusion_raster_render(OcclusionRaster* r, JobSystem* jobs)
+{
+    const int tiles = r->tiles_x * r->tiles_y;
+    memset(r->bin_start, 0, sizeof(uint32_t) * (tiles + 1));
+
+    // Binned by a counting sort: every triangle counted into the tiles its bounds overlap, a prefix sum, then
+    // the triangles written in at each tile's cursor, which ends up at the next tile's start
+    size_t total = 0;
+    for (uint32_t i = 0; i < r->triangle_count; ++i)
+    {
+        const OcclusionTriangle* t = &r->triangles[i];
+        for (int ty = t->y0 / OCCLUSION_TILE_HEIGHT; ty <= t->y1 / OCCLUSION_TILE_HEIGHT; ++ty)
+            for (int tx = t->x0 / OCCLUSION_TILE_WIDTH; tx <= t->x1 / OCCLUSION_TILE_WIDTH; ++tx)
+                ++r->bin_start[ty * r->tiles_x + tx];
+        total += (size_t)(t->y1 / OCCLUSION_TILE_HEIGHT - t->y0 / OCCLUSION_TILE_HEIGHT + 1)
+            * (t->x1 / OCCLUSION_TILE_WIDTH - t->x0 / OCCLUSION_TILE_WIDTH + 1);
+    }
+    if (total > r->bin_capacity)
+    {
+        const size_t capacity = total > 2 * r->bin_capacity ? total : 2 * r->bin_capacity;
+        uint32_t* bin = (uint32_t*)realloc(r->bin, sizeof(uint32_t) * capacity);
+        if (bin)
+        {
+            r->bin = bin;
+            r->bin_capacity = capacity;
+        }
+        else    // nothing drawn: nothing is culled
+        {
+            r->dropped += r->triangle_count;
+            r->triangle_count = 0;
+            memset(r->bin_start, 0, sizeof(uint32_t) * (tiles + 1));
+        }
+    }
+    uint32_t sum = 0;
+    for (int t = 0; t < tiles; ++t)
+    {
+        const uint32_t n = r->bin_start[t];
+        r->bin_start[t] = sum;
+        sum += n;
+    }
+    for (uint32_t i = 0; i < r->triangle_count; ++i)
+    {
+        const OcclusionTriangle* t = &r->triangles[i];
+        for (int ty = t->y0 / OCCLUSION_TILE_HEIGHT; ty <= t->y1 / OCCLUSION_TILE_HEIGHT; ++ty)
+            for (int tx = t->x0 / OCCLUSION_TILE_WIDTH; tx <= t->x1 / OCCLUSION_TILE_WIDTH; ++tx)
+                r->bin[r->bin_start[ty * r->tiles_x + tx]++] = i;
+    }
+    for (int t = tiles; t > 0; --t)
+        r->bin_start[t] = r->bin_start[t - 1];
+    r->bin_start[0] = 0;
+
+    if (jobs && jobs->thread_count > 1 && tiles > RENDER_GRAIN)
+        job_wait(jobs, job_parallel_for(jobs, render_range, r, (size_t)tiles, RENDER_GRAIN));
+    else
+        render_range(r, 0, (size_t)tiles);
+}
+
+// Whether anything in pixels [x0, x1] x [y0, y1] lies at depth "z" or beyond: tiles wholly nearer are passed
+// over on their farthest depth
+static bool rect_visible(const OcclusionRaster* r, int x0, int y0, int x1, int y1, float z)
+{
+    for (int ty = y0 / OCCLUSION_TILE_HEIGHT; ty <= y1 / OCCLUSION_TILE_HEIGHT; ++ty)
+    {
+        for (int tx = x0 / OCCLUSION_TILE_WIDTH; tx <= x1 / OCCLUSION_TILE_WIDTH; ++tx)
+        {
+            if (r->tile_max[ty * r->tiles_x + tx] < z)
+                continue;
+            const int cx0 = x0 > tx * OCCLUSION_TILE_WIDTH ? x0 : tx * OCCLUSION_TILE_WIDTH;
+            const int cy0 = y0 > ty * OCCLUSION_TILE_HEIGHT ? y0 : ty * OCCLUSION_TILE_HEIGHT;
+            const int cx1 = x1 < (tx + 1) * OCCLUSION_TILE_WIDTH - 1 ? x1 : (tx + 1) * OCCLUSION_TILE_WIDTH - 1;
+            const int cy1 = y1 < (ty + 1) * OCCLUSION_TILE_HEIGHT - 1 ? y1 : (ty + 1) * OCCLUSION_TILE_HEIGHT - 1;
+            for (int y = cy0; y <= cy1; ++y)
+            {
+                const float* row = r->depth + (size_t)y * r->width;
+                for (int x = cx0; x <= cx1; ++x)
+                {
+                    if (row[x] >= z)
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Pixel column or row v (in [0, size]) falls in, and the last one a range ending at v covers
+static int pixel_floor(float v)
+{
+    return (int)v;
+}
+
+static int pixel_last(float v)
+{
+    const int i = (int)v;
+    return (float)i < v ? i : i - 1;
+}
+
+// Whether the box with clip-space corners (x, y, z, w)[0..8) may be visible
+static bool box_visible(const OcclusionRaster* r, const float* x, const float* y, const float* z, const float* w)
+{
+    float min_x, min_y, min_z, max_x, max_y;
+#if LINMATH_H_SIMD == LINMATH_H_SIMD_SSE2 || LINMATH_H_SIMD == LINMATH_H_SIMD_AVX
+    // Both halves of the corners at once, then the lanes folded together
+    const __m128 w0 = _mm_load_ps(w), w1 = _mm_load_ps(w + 4), z0 = _mm_load_ps(z), z1 = _mm_load_ps(z + 4);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 front = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(w0, zero), _mm_cmpgt_ps(w1, zero)),
+        _mm_and_ps(_mm_cmpge_ps(z0, _mm_sub_ps(zero, w0)), _mm_cmpge_ps(z1, _mm_sub_ps(zero, w1))));
+    if (_mm_movemask_ps(front) != 0xF)      // a corner crosses the near plane
+        return true;
+    const __m128 inv0 = _mm_div_ps(_mm_set1_ps(1.f), w0), inv1 = _mm_div_ps(_mm_set1_ps(1.f), w1);
+    const __m128 nx0 = _mm_mul_ps(_mm_load_ps(x), inv0), nx1 = _mm_mul_ps(_mm_load_ps(x + 4), inv1);
+    const __m128 ny0 = _mm_mul_ps(_mm_load_ps(y), inv0), ny1 = _mm_mul_ps(_mm_load_ps(y + 4), inv1);
+    __m128 lo_x = _mm_min_ps(nx0, nx1), hi_x = _mm_max_ps(nx0, nx1);
+    __m128 lo_y = _mm_min_ps(ny0, ny1), hi_y = _mm_max_ps(ny0, ny1);
+    __m128 lo_z = _mm_min_ps(_mm_mul_ps(z0, inv0), _mm_mul_ps(z1, inv1));
+    // (lo_x, hi_x, lo_y, lo_z) side by side, folded twice
+    __m128 lo = _mm_unpacklo_ps(lo_x, lo_y), lo_hi = _mm_unpackhi_ps(lo_x, lo_y);
+    lo = _mm_min_ps(lo, lo_hi);
+    lo = _mm_min_ps(lo, _mm_movehl_ps(lo, lo));
+    __m128 hi = _mm_unpacklo_ps(hi_x, hi_y), hi_hi = _mm_unpackhi_ps(hi_x, hi_y);
+    hi = _mm_max_ps(hi, hi_hi);
+    hi = _mm_max_ps(hi, _mm_movehl_ps(hi, hi));
+    lo_z = _mm_min_ps(lo_z, _mm_movehl_ps(lo_z, lo_z));
+    lo_z = _mm_min_ss(lo_z, _mm_shuffle_ps(lo_z, lo_z, 1));
+    float lo_out[4], hi_out[4];
+    _mm_storeu_ps(lo_out, lo);
+    _mm_storeu_ps(hi_out, hi);
+    min_x = lo_out[0];
+    min_y = lo_out[1];
+    max_x = hi_out[0];
+    max_y = hi_out[1];
+    min_z = _mm_cvtss_f32(lo_z);
+#else
+    min_x = min_y = min_z = FLT_MAX;
+    max_x = max_y = -FLT_MAX;
+    for (int k = 0; k < 8; ++k)
+    {
+        if (!(w[k] > 0.f) || !(z[k] >= -w[k]))      // crosses the near plane
+            return true;
+        const float inv_w = 1.f / w[k];
+        min_x = x[k] * inv_w < min_x ? x[k] * inv_w : min_x;
+        max_x = x[k] * inv_w > max_x ? x[k] * inv_w : max_x;
+        min_y = y[k] * inv_w < min_y ? y[k] * inv_w : min_y;
+        max_y = y[k] * inv_w > max_y ? y[k] * inv_w : max_y;
+        min_z = z[k] * inv_w < min_z ? z[k] * inv_w : min_z;
+    }
+#endif
+    if (!(max_x >= -1.f && min_x <= 1.f && max_y >= -1.f && min_y <= 1.f))
+        return true;        // off screen (or NaN): the frustum's to judge
+    const float half_w = 0.5f * (float)r->width, half_h = 0.5f * (float)r->height;
+    int x0 = pixel_floor(half_w * ((min_x > -1.f ? min_x : -1.f) + 1.f));
+    int y0 = pixel_floor(half_h * ((min_y > -1.f ? min_y : -1.f) + 1.f));
+    int x1 = pixel_last(half_w * ((max_x < 1.f ? max_x : 1.f) + 1.f));
+    int y1 = pixel_last(half_h * ((max_y < 1.f ? max_y : 1.f) + 1.f));
+    x0 = x0 < r->width - 1 ? x0 : r->width - 1;
+    y0 = y0 < r->height - 1 ? y0 : r->height - 1;
+    x1 = x1 > x0 ? x1 : x0;
+    y1 = y1 > y0 ? y1 : y0;
+    return rect_visible(r, x0, y0, x1, y1, min_z);
+}
+
+static void box_corners(const Aabb* b, float* x, float* y, float* z)
+{
+    for (int k = 0; k < 8; ++k)
+    {
+        x[k] = (k & 1) ? b->max[0] : b->min[0];
+        y[k] = (k & 2) ? b->max[1] : b->min[1];
+        z[k] = (k & 4) ? b->max[2] : b->min[2];
+    }
+}
+
+bool occlusion_raster_test(const OcclusionRaster* r, const vec3 min, const vec3 max)
+{
+    if (!r->triangle_count)
+        return true;
+    Aabb box;
+    vec3_dup(box.min, min);
+    vec3_dup(box.max, max);
+    alignas(LINMATH_BATCH_ALIGN) float x[8], y[8], z[8], cx[8], cy[8], cz[8], cw[8];
+    box_corners(&box, x, y, z);
+    for (int k = 0; k < 8; ++k)
+    {
+        const vec4 corner = { x[k], y[k], z[k], 1.f };
+        vec4 clip;
+        mat4x4_mul_vec4(clip, r->view_projection, corner);
+        cx[k] = clip[0];
+        cy[k] = clip[1];
+        cz[k] = clip[2];
+        cw[k] = clip[3];
+    }
+    return box_visible(r, cx, cy, cz, cw);
+}
+
+typedef struct OcclusionCull
+{
+    const OcclusionRaster* r;
+    const Aabb* bounds;
+    uint32_t* visible;          // hidden entries are overwritten with HIDDEN, then compacted out
+} OcclusionCull;
+
+// The boxes' corners CULL_BLOCK boxes at a time, through the SIMD transform together
+static void cull_range(void* data, size_t begin, size_t end)
+{
+    const OcclusionCull* cull = (const OcclusionCull*)data;
+    alignas(LINMATH_BATCH_ALIGN) float x[8 * CULL_BLOCK], y[8 * CULL_BLOCK], z[8 * CULL_BLOCK];
+    alignas(LINMATH_BATCH_ALIGN) float cx[8 * CULL_BLOCK], cy[8 * CULL_BLOCK], cz[8 * CULL_BLOCK], cw[8 * CULL_BLOCK];
+    for (size_t base = begin; base < end; base += CULL_BLOCK)
+    {
+        const size_t m = end - base < CULL_BLOCK ? end - base : CULL_BLOCK;
+        for (size_t j = 0; j < m; ++j)
+            box_corners(&cull->bounds[cull->visible[base + j]], x + 8 * j, y + 8 * j, z + 8 * j);
+        mat4x4_transform_soa(cx, cy, cz, cw, cull->r->view_projection, x, y, z, NULL, 8 * m);
+        for (size_t j = 0; j < m; ++j)
+        {
+            if (!box_visible(cull->r, cx + 8 * j, cy + 8 * j, cz + 8 * j, cw + 8 * j))
+                cull->visible[base + j] = HIDDEN;
+        }
+    }
+}
+
+size_t occlusion_raster_cull(const OcclusionRaster* r, JobSystem* jobs, const Aabb* bounds, uint32_t* visible,
+    size_t count)
+{
+    if (!r->triangle_count)
+        return count;
+    OcclusionCull cull = { r, bounds, visible };
+    if (jobs && jobs->thread_count > 1 && count > CULL_GRAIN)
+        job_wait(jobs, job_parallel_for(jobs, cull_range, &cull, count, CULL_GRAIN));
+    else
+        cull_range(&cull, 0, count);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        visible[kept] = visible[i];
+        kept += visible[i] != HIDDEN;
+    }
+    return kept;
+}
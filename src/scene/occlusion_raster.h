@@ -0,0 +1,84 @@
+#pragma once
+
+#include "linmath.h"
+#include "scene/bvh.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct JobSystem JobSystem;
+
+// Software occlusion culling on the CPU, for contexts without the compute
+// shaders and indirect draws gl/hiz.h needs (the 3.3 fallback): a few
+// low-poly occluders are drawn into a small depth buffer before the frame is
+// submitted, and object boxes are tested against it, this frame's camera and
+// no readback.
+//
+// The buffer is width x height floats of NDC depth (z / w, which is affine in
+// screen space under any projection), nearest wins, cleared to the far plane.
+// It's cut into tiles of OCCLUSION_TILE_WIDTH x OCCLUSION_TILE_HEIGHT pixels,
+// as in Masked Occlusion Culling, and each tile also keeps its farthest depth
+// so most tests read one float per tile. Occluder vertices go through
+// linmath_batch.h's SIMD transform into clip space in one pass; triangles are
+// set up once, binned by the tiles their bounds overlap, and then every tile
+// is rasterized on its own, four pixels at a time, so tiles spread over the
+// job system with no sharing.
+//
+// Both sides of the test are conservative. An occluder only covers a pixel it
+// covers whole, at the farthest depth it has within it, and triangles that
+// cross the near plane or reach far outside the view are dropped rather than
+// clipped. A box is tested by its projected corners: the rect around them,
+// at the nearest depth of any, and it's hidden only when every pixel of the
+// rect holds something nearer. A box crossing the near plane is visible. So
+// occluders must lie inside what is drawn (an object's own mesh does), and an
+// object never hides itself.
+
+#define OCCLUSION_TILE_WIDTH 32     // pixels; the buffer's width is rounded up to these
+#define OCCLUSION_TILE_HEIGHT 8
+
+typedef struct OcclusionTriangle OcclusionTriangle;
+
+typedef struct OcclusionRaster
+{
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    float* depth;               // [width * height], row-major from the bottom (NDC y = -1), LINMATH_BATCH_ALIGN aligned
+    float* tile_max;            // [tiles_x * tiles_y]: the farthest depth in each tile
+    mat4x4 view_projection;     // what the occluders are drawn and the boxes tested with
+    uint32_t capacity;          // most triangles per frame
+    uint32_t triangle_count;
+    uint32_t dropped;           // this frame's triangles left out: crossing the near plane or the guard band, edge-on
+    OcclusionTriangle* triangles;
+    float* clip[4];             // scratch: x, y, z, w of the vertices being added, [3 * capacity] each
+    uint32_t* bin_start;        // [tiles + 1]: tile t's triangles are bin[bin_start[t], bin_start[t + 1])
+    uint32_t* bin;              // triangle indices, by tile and in the order they were added within one
+    size_t bin_capacity;        // grows as the binned triangles need
+} OcclusionRaster;
+
+// A buffer of at least "width" x "height" pixels (rounded up to whole tiles) for up to "max_triangles" occluder
+// triangles a frame. Logs and returns false when out of memory.
+bool occlusion_raster_init(OcclusionRaster* r, int width, int height, uint32_t max_triangles);
+void occlusion_raster_destroy(OcclusionRaster* r);
+
+// Starts a frame seen through "view_projection" (projection * view, GL clip conventions): no occluders yet
+void occlusion_raster_begin(OcclusionRaster* r, mat4x4 const view_projection);
+
+// Adds the triangles (x, y, z)[3k .. 3k + 2] for 3k < vertex_count, world space, either winding. The arrays are
+// LINMATH_BATCH_ALIGN aligned, as linmath_batch.h's are. Past the capacity the rest are left out. Returns how many
+// were kept.
+uint32_t occlusion_raster_add(OcclusionRaster* r, const float* x, const float* y, const float* z,
+    uint32_t vertex_count);
+
+// Draws the frame's occluders into the buffer, tiles spread over "jobs" when given (called from a thread running
+// in it) and serially otherwise
+void occlusion_raster_render(OcclusionRaster* r, JobSystem* jobs);
+
+// Whether the box [min, max] may be visible past the occluders drawn
+bool occlusion_raster_test(const OcclusionRaster* r, const vec3 min, const vec3 max);
+
+// Keeps the entries of "visible[0..count)" (object indices into "bounds") that occlusion_raster_test passes,
+// compacted in place in the same order, testing on "jobs" when given. Returns how many are kept.
+size_t occlusion_raster_cull(const OcclusionRaster* r, JobSystem* jobs, const Aabb* bounds, uint32_t* visible,
+    size_t count);
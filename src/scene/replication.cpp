@@ -0,0 +1,383 @@
+#include "scene/replication.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROTATION_MAX ((1u << REPLICATION_ROTATION_BITS) - 1u)
+#define ROTATION_MASK ROTATION_MAX
+#define SQRT2 1.41421356f
+
+static const ReplicatedTrs absent = { { 0, 0, 0 }, 0, { 0, 0, 0 }, 0 };
+
+static bool newer(uint16_t a, uint16_t b)
+{
+    return (int16_t)(uint16_t)(a - b) > 0;
+}
+
+static int32_t steps(float v, float inverse_step)
+{
+    return (int32_t)floorf(v * inverse_step + 0.5f);
+}
+
+void replication_quantize(const ReplicationQuantizer* q, const trs* in, ReplicatedTrs* out)
+{
+    const float to_position = 1.f / q->position_step, to_scale = 1.f / q->scale_step;
+    for (int k = 0; k < 3; ++k)
+    {
+        out->t[k] = steps(in->t[k], to_position);
+        const int32_t s = steps(in->s[k], to_scale);
+        out->s[k] = (int16_t)(s > 32767 ? 32767 : s < -32767 ? -32767 : s);
+    }
+
+    // Smallest three: the largest component is left out, made positive (q and -q are the same rotation) and
+    // rebuilt from the others, which all lie within +-1/sqrt(2)
+    int largest = 0;
+    for (int k = 1; k < 4; ++k)
+        if (fabsf(in->r[k]) > fabsf(in->r[largest]))
+            largest = k;
+    const float sign = in->r[largest] < 0.f ? -1.f : 1.f;
+    uint32_t packed = (uint32_t)largest << 30;
+    int shift = 2 * REPLICATION_ROTATION_BITS;
+    for (int k = 0; k < 4; ++k)
+    {
+        if (k == largest)
+            continue;
+        const float unit = (in->r[k] * sign * SQRT2 * 0.5f + 0.5f) * ROTATION_MAX;
+        const int32_t v = (int32_t)floorf(unit + 0.5f);
+        packed |= (uint32_t)(v < 0 ? 0 : v > (int32_t)ROTATION_MAX ? (int32_t)ROTATION_MAX : v) << shift;
+        shift -= REPLICATION_ROTATION_BITS;
+    }
+    out->r = packed;
+    out->present = 1;
+}
+
+void replication_dequantize(const ReplicationQuantizer* q, const ReplicatedTrs* in, trs* out)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        out->t[k] = in->t[k] * q->position_step;
+        out->s[k] = in->s[k] * q->scale_step;
+    }
+    const int largest = (int)(in->r >> 30);
+    int shift = 2 * REPLICATION_ROTATION_BITS;
+    float sum = 0.f;
+    for (int k = 0; k < 4; ++k)
+    {
+        if (k == largest)
+            continue;
+        const float unit = (float)((in->r >> shift) & ROTATION_MASK) / ROTATION_MAX;
+        out->r[k] = (unit - 0.5f) * SQRT2;
+        sum += out->r[k] * out->r[k];
+        shift -= REPLICATION_ROTATION_BITS;
+    }
+    out->r[largest] = sum < 1.f ? sqrtf(1.f - sum) : 0.f;
+}
+
+bool replication_sender_init(ReplicationSender* sender, uint32_t count, const ReplicationQuantizer* quantizer)
+{
+    memset(sender, 0, sizeof(*sender));
+    sender->count = count;
+    sender->quantizer = *quantizer;
+    sender->current = (ReplicatedTrs*)calloc(count ? count : 1, sizeof(ReplicatedTrs));
+    sender->interest = (uint8_t*)calloc(count ? count : 1, 1);
+    sender->found = (uint32_t*)malloc(sizeof(uint32_t) * (count ? count : 1));
+    if (!sender->current || !sender->interest || !sender->found)
+    {
+        fprintf(stderr, "replication: out of memory for %u objects\n", count);
+        replication_sender_destroy(sender);
+        return false;
+    }
+    return true;
+}
+
+void replication_sender_destroy(ReplicationSender* sender)
+{
+    for (int c = 0; c < REPLICATION_MAX_CLIENTS; ++c)
+        replication_sender_remove_client(sender, c);
+    free(sender->current);
+    free(sender->interest);
+    free(sender->found);
+    sender->current = NULL;
+    sender->interest = NULL;
+    sender->found = NULL;
+}
+
+int replication_sender_add_client(ReplicationSender* sender)
+{
+    for (int c = 0; c < REPLICATION_MAX_CLIENTS; ++c)
+    {
+        ReplicationClient* client = &sender->clients[c];
+        if (client->active)
+            continue;
+        memset(client, 0, sizeof(*client));
+        client->records = (ReplicatedTrs*)malloc(sizeof(ReplicatedTrs) * REPLICATION_HISTORY
+            * (sender->count ? sender->count : 1));
+        if (!client->records)
+        {
+            fprintf(stderr, "replication: out of memory for a client's %d snapshots\n", REPLICATION_HISTORY);
+            return -1;
+        }
+        client->active = true;
+        return c;
+    }
+    return -1;
+}
+
+void replication_sender_remove_client(ReplicationSender* sender, int client)
+{
+    ReplicationClient* c = &sender->clients[client];
+    free(c->records);
+    memset(c, 0, sizeof(*c));
+}
+
+void replication_sender_update(ReplicationSender* sender, const trs* objects)
+{
+    for (uint32_t i = 0; i < sender->count; ++i)
+        replication_quantize(&sender->quantizer, &objects[i], &sender->current[i]);
+}
+
+void replication_sender_set_interest(ReplicationSender* sender, int client, const vec3 center, float radius)
+{
+    ReplicationClient* c = &sender->clients[client];
+    c->center[0] = center[0];
+    c->center[1] = center[1];
+    c->center[2] = center[2];
+    c->radius = radius;
+}
+
+static int32_t difference(int32_t a, int32_t b)
+{
+    return (int32_t)((uint32_t)a - (uint32_t)b);
+}
+
+// One object's fields against what the client has: present, then which of position, rotation and scale changed
+// and by how much. A rotation whose largest component is the same one changes by its three fields' differences;
+// otherwise (or when it's new) it's sent whole.
+static void write_object(BitWriter* w, const ReplicatedTrs* from, const ReplicatedTrs* to)
+{
+    bit_write(w, to->present, 1);
+    if (!to->present)
+        return;
+    const bool t = to->t[0] != from->t[0] || to->t[1] != from->t[1] || to->t[2] != from->t[2];
+    const bool r = to->r != from->r;
+    const bool s = to->s[0] != from->s[0] || to->s[1] != from->s[1] || to->s[2] != from->s[2];
+    bit_write(w, (t ? 1u : 0u) | (r ? 2u : 0u) | (s ? 4u : 0u), 3);
+    if (t)
+        for (int k = 0; k < 3; ++k)
+            bit_write_signed(w, difference(to->t[k], from->t[k]));
+    if (r)
+    {
+        const bool same_axis = from->present && (to->r >> 30) == (from->r >> 30);
+        bit_write(w, same_axis ? 1 : 0, 1);
+        if (same_axis)
+            for (int shift = 0; shift <= 2 * REPLICATION_ROTATION_BITS; shift += REPLICATION_ROTATION_BITS)
+                bit_write_signed(w, (int32_t)((to->r >> shift) & ROTATION_MASK)
+                    - (int32_t)((from->r >> shift) & ROTATION_MASK));
+        else
+            bit_write(w, to->r, 32);
+    }
+    if (s)
+        for (int k = 0; k < 3; ++k)
+            bit_write_signed(w, to->s[k] - from->s[k]);
+}
+
+static void read_object(BitReader* r, ReplicatedTrs* object)
+{
+    if (!bit_read(r, 1))
+    {
+        *object = absent;
+        return;
+    }
+    const bool was_present = object->present != 0;
+    object->present = 1;
+    const uint32_t changed = bit_read(r, 3);
+    if (changed & 1u)
+        for (int k = 0; k < 3; ++k)
+            object->t[k] = (int32_t)((uint32_t)object->t[k] + (uint32_t)bit_read_signed(r));
+    if (changed & 2u)
+    {
+        if (bit_read(r, 1) && was_present)
+        {
+            uint32_t packed = object->r & (3u << 30);
+            for (int shift = 0; shift <= 2 * REPLICATION_ROTATION_BITS; shift += REPLICATION_ROTATION_BITS)
+            {
+                const int32_t v = (int32_t)((object->r >> shift) & ROTATION_MASK) + bit_read_signed(r);
+                packed |= ((uint32_t)v & ROTATION_MASK) << shift;
+            }
+            object->r = packed;
+        }
+        else
+            object->r = bit_read(r, 32);
+    }
+    if (changed & 4u)
+        for (int k = 0; k < 3; ++k)
+            object->s[k] = (int16_t)(object->s[k] + bit_read_signed(r));
+}
+
+void replication_sender_write(ReplicationSender* sender, int client, const SpatialGrid* grid, uint16_t sequence,
+    BitWriter* w)
+{
+    ReplicationClient* c = &sender->clients[client];
+    const uint32_t count = sender->count;
+    const size_t start_bits = w->bits;
+
+    // The baseline: the latest snapshot the client acknowledged, while both sides still have it
+    const int b = c->baseline % REPLICATION_HISTORY;
+    const bool based = c->acked && c->valid[b] && c->sequences[b] == c->baseline
+        && (uint16_t)(sequence - c->baseline) < REPLICATION_HISTORY && sequence != c->baseline;
+    const int slot = sequence % REPLICATION_HISTORY;
+    ReplicatedTrs* out = c->records + (size_t)slot * count;
+    if (based)
+        memcpy(out, c->records + (size_t)b * count, sizeof(ReplicatedTrs) * count);
+    else
+    {
+        memset(out, 0, sizeof(ReplicatedTrs) * count);
+        ++c->from_nothing;
+    }
+    c->sequences[slot] = sequence;
+    c->valid[slot] = true;
+
+    // The area of interest: 1 inside the radius, 2 inside the margin, where an object the client has stays
+    const bool everything = !grid || !(c->radius > 0.f);
+    if (!everything)
+    {
+        memset(sender->interest, 0, count);
+        size_t n = spatial_grid_query_sphere(grid, c->center, c->radius * REPLICATION_INTEREST_MARGIN, sender->found,
+            count);
+        for (size_t k = 0; k < n && k < count; ++k)
+            sender->interest[sender->found[k]] = 2;
+        n = spatial_grid_query_sphere(grid, c->center, c->radius, sender->found, count);
+        for (size_t k = 0; k < n && k < count; ++k)
+            sender->interest[sender->found[k]] = 1;
+    }
+
+    bit_write(w, based ? 1 : 0, 1);
+    if (based)
+        bit_write_gamma(w, (uint16_t)(sequence - c->baseline) - 1u);
+    const uint32_t first = count ? c->cursor % count : 0;
+    bit_write_gamma(w, first);
+
+    // Every object that differs from the client's, from where the last snapshot was cut, until the room runs out
+    uint32_t last = UINT32_MAX;
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        const uint32_t i = first + k < count ? first + k : first + k - count;
+        const bool wanted = everything || sender->interest[i] == 1 || (sender->interest[i] == 2 && out[i].present);
+        const ReplicatedTrs* to = wanted ? &sender->current[i] : &absent;
+        if (!memcmp(&out[i], to, sizeof(ReplicatedTrs)))
+            continue;
+        const size_t before = w->bits;
+        bit_write(w, 1, 1);
+        bit_write_gamma(w, k - last - 1u);
+        write_object(w, &out[i], to);
+        if (w->overflow || w->bits + 1 > 8 * w->capacity)
+        {
+            w->bits = before;       // left for the next snapshot, from here
+            w->overflow = false;
+            c->cursor = i;
+            ++c->cut;
+            break;
+        }
+        out[i] = *to;
+        last = k;
+        ++c->objects_sent;
+    }
+    bit_write(w, 0, 1);
+    ++c->snapshots;
+    c->bits += w->bits - start_bits;
+}
+
+void replication_sender_ack(ReplicationSender* sender, int client, uint16_t sequence)
+{
+    ReplicationClient* c = &sender->clients[client];
+    const int slot = sequence % REPLICATION_HISTORY;
+    if (!c->active || !c->valid[slot] || c->sequences[slot] != sequence)
+        return;     // not a snapshot, or one too old to be kept
+    if (!c->acked || newer(sequence, c->baseline))
+    {
+        c->baseline = sequence;
+        c->acked = true;
+    }
+}
+
+bool replication_receiver_init(ReplicationReceiver* receiver, uint32_t count, const ReplicationQuantizer* quantizer)
+{
+    memset(receiver, 0, sizeof(*receiver));
+    receiver->count = count;
+    receiver->quantizer = *quantizer;
+    receiver->records = (ReplicatedTrs*)malloc(sizeof(ReplicatedTrs) * REPLICATION_HISTORY * (count ? count : 1));
+    if (!receiver->records)
+    {
+        fprintf(stderr, "replication: out of memory for %d snapshots of %u objects\n", REPLICATION_HISTORY, count);
+        return false;
+    }
+    return true;
+}
+
+void replication_receiver_destroy(ReplicationReceiver* receiver)
+{
+    free(receiver->records);
+    receiver->records = NULL;
+}
+
+bool replication_receiver_read(ReplicationReceiver* receiver, uint16_t sequence, BitReader* r)
+{
+    const uint32_t count = receiver->count;
+    if (receiver->has_latest && !newer(sequence, receiver->latest)
+        && (uint16_t)(receiver->latest - sequence) >= REPLICATION_HISTORY)
+    {
+        ++receiver->stale;
+        return false;   // its slot is a newer one's
+    }
+    const bool based = bit_read(r, 1) != 0;
+    const uint32_t age = based ? bit_read_gamma(r) + 1u : 0u;
+    const uint16_t baseline = (uint16_t)(sequence - age);
+    const int b = baseline % REPLICATION_HISTORY;
+    if (based && (age >= REPLICATION_HISTORY || !receiver->valid[b] || receiver->sequences[b] != baseline))
+    {
+        ++receiver->missing_baseline;
+        return false;
+    }
+    const int slot = sequence % REPLICATION_HISTORY;
+    ReplicatedTrs* out = receiver->records + (size_t)slot * count;
+    receiver->valid[slot] = false;
+    if (based)
+        memcpy(out, receiver->records + (size_t)b * count, sizeof(ReplicatedTrs) * count);
+    else
+        memset(out, 0, sizeof(ReplicatedTrs) * count);
+
+    const uint32_t first = bit_read_gamma(r);
+    if (first >= count && count)
+        return false;
+    uint32_t k = UINT32_MAX;
+    while (bit_read(r, 1) && !r->overflow)
+    {
+        k += bit_read_gamma(r) + 1u;
+        if (k >= count)
+            return false;
+        read_object(r, &out[first + k < count ? first + k : first + k - count]);
+    }
+    if (r->overflow)
+        return false;
+    receiver->sequences[slot] = sequence;
+    receiver->valid[slot] = true;
+    ++receiver->snapshots;
+    if (!receiver->has_latest || newer(sequence, receiver->latest))
+    {
+        receiver->latest = sequence;
+        receiver->has_latest = true;
+    }
+    else
+        ++receiver->stale;
+    return true;
+}
+
+const ReplicatedTrs* replication_receiver_state(const ReplicationReceiver* receiver)
+{
+    const int slot = receiver->latest % REPLICATION_HISTORY;
+    if (!receiver->has_latest || !receiver->valid[slot] || receiver->sequences[slot] != receiver->latest)
+        return NULL;    // a snapshot that failed to read was put in its slot
+    return receiver->records + (size_t)slot * receiver->count;
+}
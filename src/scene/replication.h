@@ -0,0 +1,140 @@
+#pragma once
+
+#include "linmath_trs.h"
+#include "core/bit_stream.h"
+#include "scene/spatial_grid.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Objects' transforms sent to remote clients as deltas: what a snapshot
+// costs follows how much of the scene changed, not how big it is.
+//
+// Transforms are quantised first (ReplicatedTrs): positions to steps of
+// "position_step", scales of "scale_step", and rotations as their three
+// smallest components in 10 bits each, the largest one's index in 2 more
+// (to within a quarter of a degree). An object that hasn't moved a step
+// quantises the same and isn't sent at all.
+//
+// Each snapshot is a delta against one the client has acknowledged (its
+// baseline): for every object that differs, its index (as the gap since the
+// last one sent) and the differences of its quantised fields, Elias gamma
+// coded (core/bit_stream.h), so a small move is a few bits. An object new to
+// the client is sent against zeros, and one gone as a single bit. Snapshots
+// are sent once: a lost one needs no resend, as the next is against the
+// same baseline and holds whatever it held. The sender keeps what it sent
+// in each of the last REPLICATION_HISTORY snapshots and the receiver what
+// it got, so either side can pick up any of them as the baseline; one older
+// than that is given up, and the next snapshot is against nothing.
+//
+// A snapshot is cut at its packet's room. The objects left out keep their
+// baseline's state, and the next snapshot starts where this one stopped,
+// so every change gets out within a few packets even when one packet can't
+// take them all.
+//
+// Each client can have an area of interest, a sphere around its viewpoint:
+// only the objects in it (from the scene's spatial grid, scene/spatial_grid.h)
+// are sent, and one that leaves it is removed from the client. An object
+// already sent stays until it's REPLICATION_INTEREST_MARGIN times the radius
+// away, so one sitting at the edge isn't added and removed over and over.
+//
+// Memory: REPLICATION_HISTORY states of every object per client, and as many
+// on the receiver; 24 bytes each.
+
+#define REPLICATION_HISTORY 32          // snapshots remembered; a baseline older than this is given up
+#define REPLICATION_MAX_CLIENTS 8
+#define REPLICATION_ROTATION_BITS 10    // per smallest-three component
+#define REPLICATION_INTEREST_MARGIN 1.1f
+
+typedef struct ReplicationQuantizer
+{
+    float position_step;        // units
+    float scale_step;           // scales reach 32767 of these
+} ReplicationQuantizer;
+
+// An object's transform as sent: all zero for one the client doesn't have
+typedef struct ReplicatedTrs
+{
+    int32_t t[3];
+    uint32_t r;                 // the largest component's index in bits 30-31, the other three in 10 bits each
+    int16_t s[3];
+    uint16_t present;
+} ReplicatedTrs;
+
+typedef struct ReplicationClient
+{
+    bool active;
+    uint16_t sequences[REPLICATION_HISTORY];    // by sequence % REPLICATION_HISTORY: the snapshot there
+    bool valid[REPLICATION_HISTORY];
+    ReplicatedTrs* records;     // [REPLICATION_HISTORY * count]: the objects as the client has them after each
+    bool acked;                 // has acknowledged a snapshot
+    uint16_t baseline;          // the latest it acknowledged
+    uint32_t cursor;            // the object the next snapshot starts from
+    vec3 center;                // its area of interest; radius 0 for the whole scene
+    float radius;
+
+    // Over its snapshots
+    unsigned int snapshots;
+    unsigned int from_nothing;  // sent against no baseline
+    unsigned int cut;           // ran out of room with changes left
+    uint64_t bits;
+    uint64_t objects_sent;
+} ReplicationClient;
+
+typedef struct ReplicationSender
+{
+    uint32_t count;             // objects
+    ReplicationQuantizer quantizer;
+    ReplicatedTrs* current;     // [count]: the scene as quantised by replication_sender_update
+    uint8_t* interest;          // [count] scratch: 1 within the radius, 2 within the margin
+    uint32_t* found;            // [count] scratch: a query's objects
+    ReplicationClient clients[REPLICATION_MAX_CLIENTS];
+} ReplicationSender;
+
+typedef struct ReplicationReceiver
+{
+    uint32_t count;
+    ReplicationQuantizer quantizer;
+    uint16_t sequences[REPLICATION_HISTORY];
+    bool valid[REPLICATION_HISTORY];
+    ReplicatedTrs* records;     // [REPLICATION_HISTORY * count]
+    bool has_latest;
+    uint16_t latest;            // the newest snapshot read: the one replication_receiver_state shows
+    unsigned int snapshots;
+    unsigned int missing_baseline;  // couldn't be read: their baseline had been given up
+    unsigned int stale;         // arrived after a newer one; kept as a baseline only
+} ReplicationReceiver;
+
+void replication_quantize(const ReplicationQuantizer* q, const trs* in, ReplicatedTrs* out);
+void replication_dequantize(const ReplicationQuantizer* q, const ReplicatedTrs* in, trs* out);
+
+// For "count" objects. Logs and returns false when out of memory.
+bool replication_sender_init(ReplicationSender* sender, uint32_t count, const ReplicationQuantizer* quantizer);
+void replication_sender_destroy(ReplicationSender* sender);
+
+// A client slot, its memory allocated. Returns -1 when they're all taken (or out of memory).
+int replication_sender_add_client(ReplicationSender* sender);
+void replication_sender_remove_client(ReplicationSender* sender, int client);
+
+// Once a frame, before the snapshots: quantises every object's transform
+void replication_sender_update(ReplicationSender* sender, const trs* objects);
+
+// The client's area of interest: the objects within "radius" of "center"; 0 for every object
+void replication_sender_set_interest(ReplicationSender* sender, int client, const vec3 center, float radius);
+
+// Writes the client's snapshot "sequence" (its datagram's, core/udp_channel.h) into "w", as much as its room
+// takes. "grid" indexes the objects' bounds for the area of interest; NULL sends every object.
+void replication_sender_write(ReplicationSender* sender, int client, const SpatialGrid* grid, uint16_t sequence,
+    BitWriter* w);
+
+// The client got snapshot "sequence": later ones are deltas against it
+void replication_sender_ack(ReplicationSender* sender, int client, uint16_t sequence);
+
+bool replication_receiver_init(ReplicationReceiver* receiver, uint32_t count, const ReplicationQuantizer* quantizer);
+void replication_receiver_destroy(ReplicationReceiver* receiver);
+
+// Reads snapshot "sequence" from "r". Returns false when it can't be: malformed, or against a baseline given up.
+bool replication_receiver_read(ReplicationReceiver* receiver, uint16_t sequence, BitReader* r);
+
+// The objects as of the newest snapshot read, [count] of them; NULL before the first
+const ReplicatedTrs* replication_receiver_state(const ReplicationReceiver* receiver);
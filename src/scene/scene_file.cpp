@@ -0,0 +1,300 @@
+#include "scene/scene_file.h"
+
+#include <filesystem>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t align_up(uint64_t x)
+{
+    return (x + SCENE_FILE_ALIGN - 1) & ~(uint64_t)(SCENE_FILE_ALIGN - 1);
+}
+
+// The size each section must have for the header's counts
+static uint64_t expected_size(const SceneFileHeader* h, int section)
+{
+    const uint64_t n = h->entity_count;
+    switch (section)
+    {
+    case SCENE_FILE_MESH:
+    case SCENE_FILE_MATERIAL:
+        return n * sizeof(uint32_t);
+    case SCENE_FILE_BOUNDS:
+        return n * sizeof(Aabb);
+    case SCENE_FILE_MESH_NAMES:
+        return (uint64_t)h->mesh_count * sizeof(uint32_t);
+    case SCENE_FILE_BVH_NODES:
+        return (uint64_t)h->bvh_node_count * sizeof(BvhNode);
+    case SCENE_FILE_BVH_ITEMS:
+        return h->bvh_node_count ? n * sizeof(uint32_t) : 0;
+    case SCENE_FILE_BVH_BOUNDS:
+        return h->bvh_node_count ? n * sizeof(Aabb) : 0;
+    default:
+        return n * sizeof(float);
+    }
+}
+
+// NULL when the header describes sections that lie inside the file, else what is wrong with it
+static const char* validate_header(const SceneFileHeader* h, uint64_t size)
+{
+    if (size < sizeof(SceneFileHeader) || h->magic != SCENE_FILE_MAGIC)
+        return "not a scene file";
+    if (h->version != SCENE_FILE_VERSION)
+        return "unsupported version";
+    if (h->entity_count > SCENE_FILE_MAX_ENTITIES || h->bvh_node_count > 2 * (uint64_t)h->entity_count)
+        return "bad counts";
+    for (int s = 0; s < SCENE_FILE_SECTION_COUNT; ++s)
+    {
+        const SceneFileSection* section = &h->sections[s];
+        if (s != SCENE_FILE_STRINGS && section->size != expected_size(h, s))
+            return "section of the wrong size";
+        if (section->offset % SCENE_FILE_ALIGN || section->offset > size || section->size > size - section->offset)
+            return "sections out of bounds";
+    }
+    return NULL;
+}
+
+// The names' offsets fall inside the strings, which end in a NUL
+static const char* validate_names(const SceneFile* scene)
+{
+    const uint64_t size = scene->header->sections[SCENE_FILE_STRINGS].size;
+    if (size && scene->strings[size - 1] != '\0')
+        return "unterminated names";
+    for (uint32_t m = 0; m < scene->header->mesh_count; ++m)
+        if (scene->mesh_names[m] >= size)
+            return "name out of bounds";
+    return NULL;
+}
+
+// The tree's ranges, so queries never index out of the arrays: children after their parent, no deeper than the
+// query stacks go, and leaves that cover the items once each, in order, as a build leaves them
+static const char* validate_bvh(const SceneFile* scene)
+{
+    const uint32_t node_count = scene->header->bvh_node_count;
+    const uint32_t count = scene->header->entity_count;
+    if (!node_count)
+        return NULL;
+    struct Entry { uint32_t node; uint32_t depth; } stack[BVH_MAX_DEPTH + 1];
+    int top = 0;
+    stack[top++] = { 0, 0 };
+    uint32_t next = 0;
+    while (top > 0)
+    {
+        const Entry entry = stack[--top];
+        const BvhNode* node = &scene->bvh_nodes[entry.node];
+        if (node->count)
+        {
+            if (node->first != next || node->count > count - next)
+                return "BVH leaves out of order";
+            next += node->count;
+        }
+        else
+        {
+            if (node->first <= entry.node || node->first >= node_count - 1 || entry.depth + 1 >= BVH_MAX_DEPTH)
+                return "BVH nodes out of bounds";
+            stack[top++] = { node->first + 1, entry.depth + 1 };
+            stack[top++] = { node->first, entry.depth + 1 };
+        }
+    }
+    if (next != count)
+        return "BVH leaves out of order";
+    for (uint32_t i = 0; i < count; ++i)
+        if (scene->bvh_items[i] >= count)
+            return "BVH items out of bounds";
+    return NULL;
+}
+
+bool scene_file_open(SceneFile* scene, const char* path)
+{
+    MappedFile file;
+    return mapped_file_open(&file, path) && scene_file_open_mapped(scene, &file, path);
+}
+
+bool scene_file_open_mapped(SceneFile* scene, MappedFile* file, const char* path)
+{
+    memset(scene, 0, sizeof(*scene));
+    scene->file = *file;
+    memset(file, 0, sizeof(*file));
+
+    const SceneFileHeader* h = (const SceneFileHeader*)scene->file.data;
+    const char* error = validate_header(h, scene->file.size);
+    if (!error)
+    {
+        const unsigned char* base = (const unsigned char*)scene->file.data;
+        const SceneFileSection* s = h->sections;
+        SceneEntities* e = &scene->entities;
+        scene->header = h;
+        e->count = h->entity_count;
+        e->x = (const float*)(base + s[SCENE_FILE_X].offset);
+        e->y = (const float*)(base + s[SCENE_FILE_Y].offset);
+        e->z = (const float*)(base + s[SCENE_FILE_Z].offset);
+        e->angle = (const float*)(base + s[SCENE_FILE_ANGLE].offset);
+        e->scale = (const float*)(base + s[SCENE_FILE_SCALE].offset);
+        e->mesh = (const uint32_t*)(base + s[SCENE_FILE_MESH].offset);
+        e->material = (const uint32_t*)(base + s[SCENE_FILE_MATERIAL].offset);
+        e->radius = (const float*)(base + s[SCENE_FILE_RADIUS].offset);
+        e->bounds = (const Aabb*)(base + s[SCENE_FILE_BOUNDS].offset);
+        scene->mesh_names = (const uint32_t*)(base + s[SCENE_FILE_MESH_NAMES].offset);
+        scene->strings = (const char*)(base + s[SCENE_FILE_STRINGS].offset);
+        if (h->bvh_node_count)
+        {
+            scene->bvh_nodes = (const BvhNode*)(base + s[SCENE_FILE_BVH_NODES].offset);
+            scene->bvh_items = (const uint32_t*)(base + s[SCENE_FILE_BVH_ITEMS].offset);
+            scene->bvh_bounds = (const Aabb*)(base + s[SCENE_FILE_BVH_BOUNDS].offset);
+        }
+        error = validate_names(scene);
+        if (!error)
+            error = validate_bvh(scene);
+    }
+    if (error)
+    {
+        fprintf(stderr, "scene_file: %s: %s\n", path, error);
+        scene_file_close(scene);
+        return false;
+    }
+    return true;
+}
+
+void scene_file_close(SceneFile* scene)
+{
+    mapped_file_close(&scene->file);
+    memset(scene, 0, sizeof(*scene));
+}
+
+const char* scene_file_mesh_name(const SceneFile* scene, uint32_t mesh)
+{
+    return scene->header && mesh < scene->header->mesh_count ? scene->strings + scene->mesh_names[mesh] : "";
+}
+
+bool scene_file_bvh(const SceneFile* scene, Bvh* bvh)
+{
+    if (!scene->bvh_nodes)
+        return false;
+    bvh_init_view(bvh, scene->bvh_nodes, scene->header->bvh_node_count, scene->bvh_items, scene->bvh_bounds,
+        scene->header->entity_count);
+    return true;
+}
+
+static bool write_padded(FILE* f, const void* data, uint64_t size)
+{
+    static const unsigned char zeros[SCENE_FILE_ALIGN] = {};
+    const uint64_t padding = align_up(size) - size;
+    return (!size || fwrite(data, 1, size, f) == size) && fwrite(zeros, 1, padding, f) == padding;
+}
+
+bool scene_file_write(const char* path, const SceneEntities* entities, const char* const* mesh_names,
+    uint32_t mesh_count, uint32_t material_count, const Bvh* bvh)
+{
+    const uint32_t count = entities->count;
+    if (count > SCENE_FILE_MAX_ENTITIES)
+    {
+        fprintf(stderr, "scene_file: %u entities (up to %u supported)\n", count, SCENE_FILE_MAX_ENTITIES);
+        return false;
+    }
+    if (bvh && (bvh->item_count != count || bvh->rebuilding))
+        bvh = NULL;     // not a finished tree over these entities
+
+    SceneFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SCENE_FILE_MAGIC;
+    header.version = SCENE_FILE_VERSION;
+    header.entity_count = count;
+    header.mesh_count = mesh_count;
+    header.material_count = material_count;
+    header.bvh_node_count = bvh ? bvh->node_count : 0;
+    header.flags = SCENE_FILE_UNIFORM_SCALE | SCENE_FILE_FLAT;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (entities->scale[i] != entities->scale[0])
+            header.flags &= ~SCENE_FILE_UNIFORM_SCALE;
+        if (entities->z[i] != 0.f)
+            header.flags &= ~SCENE_FILE_FLAT;
+    }
+
+    // The names, laid end to end
+    uint32_t* name_offsets = (uint32_t*)malloc(sizeof(uint32_t) * (mesh_count ? mesh_count : 1));
+    uint64_t strings_size = 0;
+    for (uint32_t m = 0; m < mesh_count && name_offsets; ++m)
+    {
+        name_offsets[m] = (uint32_t)strings_size;
+        strings_size += strlen(mesh_names[m]) + 1;
+    }
+    char* strings = name_offsets ? (char*)malloc(strings_size ? strings_size : 1) : NULL;
+    if (!strings || strings_size > UINT32_MAX)
+    {
+        fprintf(stderr, "scene_file: out of memory for %u mesh names\n", mesh_count);
+        free(name_offsets);
+        free(strings);
+        return false;
+    }
+    for (uint32_t m = 0; m < mesh_count; ++m)
+        memcpy(strings + name_offsets[m], mesh_names[m], strlen(mesh_names[m]) + 1);
+
+    const void* data[SCENE_FILE_SECTION_COUNT] = { entities->x, entities->y, entities->z, entities->angle,
+        entities->scale, entities->mesh, entities->material, entities->radius, entities->bounds, name_offsets, strings,
+        bvh ? bvh->nodes : NULL, bvh ? bvh->items : NULL, bvh ? bvh->item_bounds : NULL };
+    uint64_t offset = align_up(sizeof(header));
+    for (int s = 0; s < SCENE_FILE_SECTION_COUNT; ++s)
+    {
+        header.sections[s].offset = offset;
+        header.sections[s].size = s == SCENE_FILE_STRINGS ? strings_size : expected_size(&header, s);
+        offset = align_up(offset + header.sections[s].size);
+    }
+
+    char temp[1024];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE* f = fopen(temp, "wb");
+    bool ok = f != NULL;
+    if (f)
+    {
+        ok = write_padded(f, &header, sizeof(header));
+        for (int s = 0; s < SCENE_FILE_SECTION_COUNT && ok; ++s)
+            ok = write_padded(f, data[s], header.sections[s].size);
+        ok = fclose(f) == 0 && ok;
+
+        std::error_code ec;
+        if (ok)
+            std::filesystem::rename(temp, path, ec);
+        if (!ok || ec)
+        {
+            std::filesystem::remove(temp, ec);
+            ok = false;
+        }
+    }
+    if (!ok)
+        fprintf(stderr, "scene_file: can't write %s\n", path);
+    free(name_offsets);
+    free(strings);
+    return ok;
+}
+
+bool scene_file_write_text(FILE* out, const SceneEntities* entities, const char* const* mesh_names,
+    uint32_t mesh_count, uint32_t material_count)
+{
+    // %.9g: every float reads back as the same float
+    bool ok = fprintf(out, "scene %d entities %u meshes %u materials %u\n", SCENE_FILE_VERSION, entities->count,
+        mesh_count, material_count) > 0;
+    for (uint32_t m = 0; m < mesh_count && ok; ++m)
+        ok = fprintf(out, "mesh %u %s\n", m, mesh_names[m]) > 0;
+    for (uint32_t i = 0; i < entities->count && ok; ++i)
+    {
+        const Aabb* b = &entities->bounds[i];
+        ok = fprintf(out, "entity %u pos %.9g %.9g %.9g angle %.9g scale %.9g mesh %u material %u radius %.9g "
+            "bounds %.9g %.9g %.9g %.9g %.9g %.9g\n", i, entities->x[i], entities->y[i], entities->z[i],
+            entities->angle[i], entities->scale[i], entities->mesh[i], entities->material[i], entities->radius[i],
+            b->min[0], b->min[1], b->min[2], b->max[0], b->max[1], b->max[2]) > 0;
+    }
+    return ok;
+}
+
+bool scene_file_export_text(FILE* out, const SceneFile* scene)
+{
+    const uint32_t mesh_count = scene->header->mesh_count;
+    const char** names = (const char**)malloc(sizeof(const char*) * (mesh_count ? mesh_count : 1));
+    if (!names)
+        return false;
+    for (uint32_t m = 0; m < mesh_count; ++m)
+        names[m] = scene_file_mesh_name(scene, m);
+    const bool ok = scene_file_write_text(out, &scene->entities, names, mesh_count, scene->header->material_count);
+    free(names);
+    return ok;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "core/mapped_file.h"
+#include "scene/bvh.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Binary scene container, used straight from a memory mapping like the mesh
+// files (asset/mesh_file.h). A fixed header holds a table of sections, each
+// an offset and a size from the start of the file, SCENE_FILE_ALIGN-aligned.
+// Every per-entity component is a section of its own, one flat array indexed
+// by entity, the same structure-of-arrays the scene and the ECS keep in
+// memory: the transform (position, rotation about Z, uniform scale, as
+// scene/ecs.h's Transform is), the mesh and material indices, the bounding
+// sphere's radius and the world-space box. The mesh references are names, in
+// a table of offsets into a block of NUL-terminated strings. An optional BVH
+// (scene/bvh.h) built when the file was written rides along, nodes, items
+// and leaf-order bounds as the tree keeps them, so a loaded scene culls and
+// picks without building one.
+//
+// Opening is mapping the file and checking the header, then walking the BVH
+// once to check its ranges (a bad tree would index out of the arrays). There
+// is no other pass over the entities: the arrays come back pointing into the
+// mapping, and a page of them is first read when something touches it. The
+// mesh and material indices aren't checked against the tables; a reader
+// clamps or wraps them. Fields are little-endian, as written by the host.
+//
+// scene_file_write_text writes the same content as text, one line per
+// entity with every float printed to round-trip exactly, for diffing two
+// scenes with ordinary tools.
+
+#define SCENE_FILE_MAGIC 0x5354474Fu      // "OGTS"
+#define SCENE_FILE_VERSION 1
+#define SCENE_FILE_ALIGN 64
+#define SCENE_FILE_MAX_ENTITIES (1u << 28)
+
+// Facts the writer found, so a reader can rely on them without a pass of its own
+#define SCENE_FILE_UNIFORM_SCALE 1u     // every entity's scale is entity 0's
+#define SCENE_FILE_FLAT 2u              // every entity's z is 0
+
+typedef enum SceneFileSectionId
+{
+    SCENE_FILE_X,               // float per entity: position
+    SCENE_FILE_Y,
+    SCENE_FILE_Z,
+    SCENE_FILE_ANGLE,           // float per entity: radians about Z
+    SCENE_FILE_SCALE,           // float per entity: uniform
+    SCENE_FILE_MESH,            // uint32_t per entity: into the mesh names
+    SCENE_FILE_MATERIAL,        // uint32_t per entity: below material_count
+    SCENE_FILE_RADIUS,          // float per entity: bounding sphere around the position
+    SCENE_FILE_BOUNDS,          // Aabb per entity: world space
+    SCENE_FILE_MESH_NAMES,      // uint32_t per mesh: offset into SCENE_FILE_STRINGS
+    SCENE_FILE_STRINGS,         // the names, NUL-terminated
+    SCENE_FILE_BVH_NODES,       // BvhNode per node; empty without a BVH
+    SCENE_FILE_BVH_ITEMS,       // uint32_t per entity, in leaf order
+    SCENE_FILE_BVH_BOUNDS,      // Aabb per entity, in leaf order
+    SCENE_FILE_SECTION_COUNT
+} SceneFileSectionId;
+
+typedef struct SceneFileSection
+{
+    uint64_t offset;            // from the start of the file
+    uint64_t size;              // bytes
+} SceneFileSection;
+
+typedef struct SceneFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entity_count;
+    uint32_t mesh_count;
+    uint32_t material_count;
+    uint32_t flags;             // SCENE_FILE_UNIFORM_SCALE, SCENE_FILE_FLAT
+    uint32_t bvh_node_count;    // 0 without a BVH
+    uint32_t reserved;
+    SceneFileSection sections[SCENE_FILE_SECTION_COUNT];
+} SceneFileHeader;
+
+// The entities' arrays, "count" long each: what a writer hands over, and where an open file's point
+typedef struct SceneEntities
+{
+    uint32_t count;
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* angle;
+    const float* scale;
+    const uint32_t* mesh;
+    const uint32_t* material;
+    const float* radius;
+    const Aabb* bounds;
+} SceneEntities;
+
+// An open scene: everything points into the mapping
+typedef struct SceneFile
+{
+    MappedFile file;
+    const SceneFileHeader* header;
+    SceneEntities entities;
+    const uint32_t* mesh_names;     // offsets into "strings"
+    const char* strings;
+    const BvhNode* bvh_nodes;       // NULL without a BVH
+    const uint32_t* bvh_items;
+    const Aabb* bvh_bounds;
+} SceneFile;
+
+// Maps and validates "path" (magic, version, sections, names and the BVH's ranges). Logs and returns false on
+// failure.
+bool scene_file_open(SceneFile* scene, const char* path);
+// The same over a file already mapped (or read out of a package), which "scene" takes over - and closes, on
+// failure. "path" only names it in messages.
+bool scene_file_open_mapped(SceneFile* scene, MappedFile* file, const char* path);
+void scene_file_close(SceneFile* scene);
+
+// Mesh "mesh"'s name, or "" when there's no such mesh
+const char* scene_file_mesh_name(const SceneFile* scene, uint32_t mesh);
+
+// The file's BVH as a tree "bvh" can query in place (bvh_init_view); false when the file has none
+bool scene_file_bvh(const SceneFile* scene, Bvh* bvh);
+
+// Writes "entities" (every array given), naming "mesh_count" meshes, and "bvh" unless it's NULL (built over the
+// entities' bounds). Written to a temporary name and renamed into place.
+bool scene_file_write(const char* path, const SceneEntities* entities, const char* const* mesh_names,
+    uint32_t mesh_count, uint32_t material_count, const Bvh* bvh);
+
+// The text form: a header line, one "mesh" line per mesh, then one "entity" line per entity. Returns false when
+// a write fails.
+bool scene_file_write_text(FILE* out, const SceneEntities* entities, const char* const* mesh_names,
+    uint32_t mesh_count, uint32_t material_count);
+
+// The same for an open scene file
+bool scene_file_export_text(FILE* out, const SceneFile* scene);
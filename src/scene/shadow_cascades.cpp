@@ -0,0 +1,228 @@
+#include "scene/shadow_cascades.h"
+
+#include <math.h>
+#include <string.h>
+
+void shadow_cascades_init(ShadowCascades* sc, int count, int resolution, float lambda, bool zero_to_one)
+{
+    memset(sc, 0, sizeof(*sc));
+    sc->count = count < 1 ? 1 : count > SHADOW_MAX_CASCADES ? SHADOW_MAX_CASCADES : count;
+    sc->resolution = resolution > 0 ? resolution : 1;
+    sc->lambda = lambda;
+    sc->zero_to_one = zero_to_one;
+    for (int i = 0; i < sc->count; ++i)
+        sc->cascades[i].interval = 1u << i;
+    const vec3 down = { 0.f, 0.f, -1.f };
+    shadow_cascades_set_light(sc, down);
+}
+
+void shadow_cascades_split(float near_plane, float far_plane, int count, float lambda, float* splits)
+{
+    splits[0] = near_plane;
+    for (int i = 1; i < count; ++i)
+    {
+        const float f = (float)i / count;
+        const float logarithmic = near_plane * powf(far_plane / near_plane, f);
+        const float uniform = near_plane + (far_plane - near_plane) * f;
+        splits[i] = lambda * logarithmic + (1.f - lambda) * uniform;
+    }
+    splits[count] = far_plane;
+}
+
+void shadow_cascades_set_count(ShadowCascades* sc, int count)
+{
+    count = count < 1 ? 1 : count > SHADOW_MAX_CASCADES ? SHADOW_MAX_CASCADES : count;
+    if (count == sc->count)
+        return;
+    // Every split moves with the count, so every cascade takes a new region and is drawn again
+    sc->count = count;
+    for (int i = 0; i < count; ++i)
+    {
+        sc->cascades[i].interval = 1u << i;
+        sc->cascades[i].fitted = false;
+    }
+}
+
+bool shadow_cascades_set_light(ShadowCascades* sc, vec3 const direction)
+{
+    vec3 d;
+    vec3_norm(d, direction);
+    if (d[0] == sc->light_direction[0] && d[1] == sc->light_direction[1] && d[2] == sc->light_direction[2])
+        return false;
+    vec3_dup(sc->light_direction, d);
+    // A rotation only, so the texel grid the snapping keeps to stays put in the world
+    const vec3 eye = { 0.f, 0.f, 0.f };
+    const vec3 up_y = { 0.f, 1.f, 0.f }, up_z = { 0.f, 0.f, 1.f };
+    mat4x4_look_at(sc->light_view, eye, d, fabsf(d[1]) > 0.99f ? up_z : up_y);
+    for (int i = 0; i < sc->count; ++i)
+        sc->cascades[i].fitted = false;
+    return true;
+}
+
+// Up to a 1/SHADOW_RADIUS_STEPS step of the power of two above it
+static float shadow_round_radius(float radius)
+{
+    int exponent = 0;
+    frexpf(radius, &exponent);
+    const float step = ldexpf(1.f, exponent) / SHADOW_RADIUS_STEPS;
+    return ceilf(radius / step) * step;
+}
+
+static void shadow_unproject(vec3 out, mat4x4 const inverse_view_projection, float x, float y, float z)
+{
+    const vec4 clip = { x, y, z, 1.f };
+    vec4 p;
+    mat4x4_mul_vec4(p, inverse_view_projection, clip);
+    out[0] = p[0] / p[3];
+    out[1] = p[1] / p[3];
+    out[2] = p[2] / p[3];
+}
+
+// A new region around light-space centre "c": snapped, its matrices rebuilt
+static void shadow_cascade_place(const ShadowCascades* sc, ShadowCascade* cascade, vec4 const c, float radius)
+{
+    const float half = radius * (1.f + SHADOW_CACHE_MARGIN);
+    const float texel = 2.f * half / sc->resolution;
+    cascade->radius = radius;
+    cascade->half_size = half;
+    cascade->centre[0] = floorf(c[0] / texel + 0.5f) * texel;
+    cascade->centre[1] = floorf(c[1] / texel + 0.5f) * texel;
+    cascade->centre[2] = c[2];
+
+    // Light space looks down -z. Receivers are within "half" of the centre; casters up to twice that towards the
+    // light still throw their shadows in.
+    mat4x4 projection;
+    const float l = cascade->centre[0] - half, r = cascade->centre[0] + half;
+    const float b = cascade->centre[1] - half, t = cascade->centre[1] + half;
+    const float n = -(cascade->centre[2] + 2.f * half), f = -(cascade->centre[2] - half);
+    if (sc->zero_to_one)
+        mat4x4_ortho_zo(projection, l, r, b, t, n, f);
+    else
+        mat4x4_ortho(projection, l, r, b, t, n, f);
+    mat4x4_mul_restrict(cascade->view_projection, projection, sc->light_view);
+
+    mat4x4 bias;
+    mat4x4_identity(bias);
+    bias[0][0] = bias[1][1] = 0.5f;
+    bias[3][0] = bias[3][1] = 0.5f;
+    if (!sc->zero_to_one)
+    {
+        bias[2][2] = 0.5f;
+        bias[3][2] = 0.5f;
+    }
+    mat4x4_mul_restrict(cascade->texture_matrix, bias, cascade->view_projection);
+    cascade->fitted = true;
+    cascade->dirty = true;
+    ++cascade->fits;
+}
+
+void shadow_cascades_fit(ShadowCascades* sc, mat4x4 const inverse_view_projection, float ndc_near, float ndc_far,
+    float near_plane, float far_plane)
+{
+    // The view's corner rays, from its near plane to its far one
+    vec3 near_corners[4], far_corners[4];
+    for (int k = 0; k < 4; ++k)
+    {
+        const float x = (k & 1) ? 1.f : -1.f, y = (k & 2) ? 1.f : -1.f;
+        shadow_unproject(near_corners[k], inverse_view_projection, x, y, ndc_near);
+        shadow_unproject(far_corners[k], inverse_view_projection, x, y, ndc_far);
+    }
+    const bool perspective = far_plane > near_plane && near_plane > 0.f;
+    float splits[SHADOW_MAX_CASCADES + 1];
+    if (perspective)
+        shadow_cascades_split(near_plane, far_plane, sc->count, sc->lambda, splits);
+    for (int i = 0; i < sc->count; ++i)
+    {
+        ShadowCascade* cascade = &sc->cascades[i];
+        // View depth is linear along each corner ray, so the slice's corners are the rays' points at its splits
+        float t[2] = { (float)i / sc->count, (float)(i + 1) / sc->count };
+        if (perspective)
+        {
+            cascade->split_near = splits[i];
+            cascade->split_far = splits[i + 1];
+            t[0] = (splits[i] - near_plane) / (far_plane - near_plane);
+            t[1] = (splits[i + 1] - near_plane) / (far_plane - near_plane);
+        }
+        else
+        {
+            cascade->split_near = t[0];
+            cascade->split_far = t[1];
+        }
+        vec3 corners[8];
+        vec3 centre = { 0.f, 0.f, 0.f };
+        for (int k = 0; k < 8; ++k)
+        {
+            vec3 ray;
+            vec3_sub(ray, far_corners[k & 3], near_corners[k & 3]);
+            vec3_scale(ray, ray, t[k >> 2]);
+            vec3_add(corners[k], near_corners[k & 3], ray);
+            vec3_add(centre, centre, corners[k]);
+        }
+        vec3_scale(centre, centre, 1.f / 8.f);
+        float radius = 0.f;
+        for (int k = 0; k < 8; ++k)
+        {
+            vec3 d;
+            vec3_sub(d, corners[k], centre);
+            const float l = vec3_len(d);
+            radius = l > radius ? l : radius;
+        }
+        radius = shadow_round_radius(radius > 1e-6f ? radius : 1e-6f);
+
+        vec4 c;
+        const vec4 world = { centre[0], centre[1], centre[2], 1.f };
+        mat4x4_mul_vec4(c, sc->light_view, world);
+        if (cascade->fitted && radius == cascade->radius
+            && fabsf(c[0] - cascade->centre[0]) + radius <= cascade->half_size
+            && fabsf(c[1] - cascade->centre[1]) + radius <= cascade->half_size
+            && fabsf(c[2] - cascade->centre[2]) + radius <= cascade->half_size)
+            continue;   // the map still covers the slice: its contents hold
+        shadow_cascade_place(sc, cascade, c, radius);
+    }
+}
+
+void shadow_cascades_invalidate(ShadowCascades* sc, vec3 const min, vec3 const max)
+{
+    // The box in light space, as a centre and half extents through the rotation's absolute values
+    vec3 centre, extent;
+    for (int a = 0; a < 3; ++a)
+    {
+        centre[a] = 0.5f * (min[a] + max[a]);
+        extent[a] = 0.5f * (max[a] - min[a]);
+    }
+    vec3 c, e;
+    for (int a = 0; a < 3; ++a)
+    {
+        c[a] = sc->light_view[0][a] * centre[0] + sc->light_view[1][a] * centre[1] + sc->light_view[2][a] * centre[2];
+        e[a] = fabsf(sc->light_view[0][a]) * extent[0] + fabsf(sc->light_view[1][a]) * extent[1]
+            + fabsf(sc->light_view[2][a]) * extent[2];
+    }
+    for (int i = 0; i < sc->count; ++i)
+    {
+        ShadowCascade* cascade = &sc->cascades[i];
+        if (!cascade->fitted)
+            continue;
+        const float h = cascade->half_size;
+        if (fabsf(c[0] - cascade->centre[0]) <= h + e[0] && fabsf(c[1] - cascade->centre[1]) <= h + e[1]
+            && c[2] + e[2] >= cascade->centre[2] - h && c[2] - e[2] <= cascade->centre[2] + 2.f * h)
+            cascade->stale = true;
+    }
+}
+
+uint32_t shadow_cascades_schedule(ShadowCascades* sc)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < sc->count; ++i)
+    {
+        ShadowCascade* cascade = &sc->cascades[i];
+        // Offset by the index, so the far cascades' turns don't all fall on the same frame
+        const bool due = cascade->interval <= 1 || (sc->frame + (uint32_t)i) % cascade->interval == 0;
+        if (!cascade->fitted || !(cascade->dirty || (cascade->stale && due)))
+            continue;
+        mask |= 1u << i;
+        cascade->dirty = cascade->stale = false;
+        ++cascade->draws;
+    }
+    ++sc->frame;
+    return mask;
+}
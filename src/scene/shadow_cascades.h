@@ -0,0 +1,93 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stdint.h>
+
+// Cascaded shadow maps for one directional light: where each cascade's map
+// looks and when it has to be drawn again. Nothing here touches GL; the
+// renderer draws the casters into the maps this schedules (gl/shadow_maps.h).
+//
+// The camera's view is cut into slices along its depth, with splits that
+// blend uniform and logarithmic spacing ("lambda", 0 uniform to 1 log), and
+// each cascade's map covers one slice. The slice's bounding sphere, not its
+// box, is what's fitted: its size doesn't change as the camera turns, so the
+// map's texels keep their world size. Its centre is then snapped to a whole
+// texel in light space (the light's view is a rotation alone, so the texel
+// grid is fixed in the world), and moving the camera slides the map by whole
+// texels: the shadows' edges stay where they are instead of shimmering.
+//
+// The map covers the sphere SHADOW_CACHE_MARGIN wider than it needs, and is
+// only fitted again when the slice's sphere leaves it or the light turns. Until
+// then its contents stay valid for the casters it holds, and the cascade is
+// only drawn again when shadow_cascades_invalidate says casters in its region
+// changed - at once for the nearest cascade, and every "interval" frames
+// for the far ones (1, 2, 4, 8 by default), whose texels are big enough that
+// a lagging frame isn't seen. A new fit or a new light always draws at once.
+//
+// Positions are whatever space the camera's inverse view-projection returns
+// (camera-relative for scene/camera.h's). A cascade's "texture_matrix" takes
+// them to its map's [0, 1] texture coordinates and depth.
+
+#define SHADOW_MAX_CASCADES 4
+#define SHADOW_CACHE_MARGIN 0.25f   // of the slice's radius: the map's extra reach on every side
+#define SHADOW_RADIUS_STEPS 64      // a slice's radius is rounded up to a 1/64th of its power of two, so jitter keeps it
+
+typedef struct ShadowCascade
+{
+    float split_near;           // view distances (or, orthographic, fractions of the depth range) it covers
+    float split_far;
+    float radius;               // the slice's sphere, rounded up
+    vec3 centre;                // the map's centre in light space, x and y snapped to its texels
+    float half_size;            // the map's half width in light space: radius plus the margin
+    mat4x4 view_projection;     // to the map's clip space, as it was (or is about to be) drawn
+    mat4x4 texture_matrix;      // to [0, 1] texture coordinates and depth
+    uint32_t interval;          // frames between draws while its casters keep changing
+    uint32_t draws;             // times it was scheduled
+    uint32_t fits;              // times its region moved
+    bool fitted;                // has a region at all
+    bool dirty;                 // new region or light: drawn before it's used
+    bool stale;                 // casters in it changed since its draw
+} ShadowCascade;
+
+typedef struct ShadowCascades
+{
+    int count;
+    int resolution;             // texels across each map
+    float lambda;               // split spacing: 0 uniform, 1 logarithmic
+    bool zero_to_one;           // the maps' clip depth is [0, 1] (glClipControl's GL_ZERO_TO_ONE), not [-1, 1]
+    vec3 light_direction;       // the way the light travels, normalised
+    mat4x4 light_view;          // world to light space: a rotation looking along light_direction
+    uint32_t frame;             // shadow_cascades_schedule calls so far
+    ShadowCascade cascades[SHADOW_MAX_CASCADES];
+} ShadowCascades;
+
+// "count" cascades (1 to SHADOW_MAX_CASCADES) of "resolution" texels across, far cascade i drawn every 2^i
+// frames while its casters change. The light points straight down -z until shadow_cascades_set_light.
+void shadow_cascades_init(ShadowCascades* sc, int count, int resolution, float lambda, bool zero_to_one);
+
+// splits[0] = near, splits[count] = far, and in between lambda's blend of the logarithmic and uniform splits
+void shadow_cascades_split(float near_plane, float far_plane, int count, float lambda, float* splits);
+
+// Draws "count" cascades (1 to SHADOW_MAX_CASCADES) from now on, such as fewer when a quality governor asks.
+// A change refits every cascade at the next shadow_cascades_fit and draws each at once.
+void shadow_cascades_set_count(ShadowCascades* sc, int count);
+
+// The light's direction (the way it travels). A change refits every cascade and draws each at once. Returns true
+// when it changed.
+bool shadow_cascades_set_light(ShadowCascades* sc, vec3 const direction);
+
+// Fits each cascade to its slice of the view "inverse_view_projection" unprojects, whose near and far planes
+// are at clip depths ndc_near and ndc_far. Perspective: the slices are split between view distances near_plane
+// and far_plane. Orthographic (near_plane = far_plane = 0): the box is split evenly. A cascade whose slice
+// still lies in its map is left alone.
+void shadow_cascades_fit(ShadowCascades* sc, mat4x4 const inverse_view_projection, float ndc_near, float ndc_far,
+    float near_plane, float far_plane);
+
+// Casters inside the box [min, max] moved, appeared or went: the cascades whose maps reach it are drawn again on
+// their schedule
+void shadow_cascades_invalidate(ShadowCascades* sc, vec3 const min, vec3 const max);
+
+// The cascades to draw this frame, bit i for cascade i: every dirty one, and every stale one whose interval
+// comes up. They count as drawn from here on.
+uint32_t shadow_cascades_schedule(ShadowCascades* sc);
@@ -0,0 +1,98 @@
+#include "scene/significance.h"
+
+#include "scene/lod.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool significance_init(Significance* s, uint32_t count, float full_pixels)
+{
+    memset(s, 0, sizeof(*s));
+    s->count = count;
+    s->full_pixels = full_pixels;
+    s->tier = (uint8_t*)calloc(count ? count : 1, 1);
+    s->seen = (uint32_t*)malloc(sizeof(uint32_t) * (count ? count : 1));
+    if (!s->tier || !s->seen)
+    {
+        significance_destroy(s);
+        return false;
+    }
+    // Last seen two frames before the first, so everything comes into view on it
+    for (uint32_t i = 0; i < count; ++i)
+        s->seen[i] = ~0u - 1;
+    return true;
+}
+
+void significance_destroy(Significance* s)
+{
+    free(s->tier);
+    free(s->seen);
+    memset(s, 0, sizeof(*s));
+}
+
+int significance_tier(const Significance* s, float pixels)
+{
+    // At or behind the eye the pixels are infinite: tier 0
+    if (!(pixels < s->full_pixels))
+        return 0;
+    if (!(pixels > 0.f))
+        return SIGNIFICANCE_TIERS - 1;
+    const int tier = (int)ceilf(log2f(s->full_pixels / pixels));
+    return tier < SIGNIFICANCE_TIERS - 1 ? tier : SIGNIFICANCE_TIERS - 1;
+}
+
+size_t significance_due(Significance* s, const uint32_t* visible, size_t count, uint32_t* due)
+{
+    const uint32_t frame = s->frame, previous = frame - 1;
+    size_t n = 0, entered = 0;
+    for (size_t k = 0; k < count; ++k)
+    {
+        const uint32_t i = visible[k];
+        const bool enters = s->seen[i] != previous;
+        s->seen[i] = frame;
+        entered += enters;
+        // Staggered by index: a tier's objects take their turns on different frames
+        if (enters || ((frame + i) & ((1u << s->tier[i]) - 1)) == 0)
+            due[n++] = i;
+    }
+    ++s->frame;
+    ++s->frames;
+    s->visible += count;
+    s->due += n;
+    s->entered += entered;
+    return n;
+}
+
+void significance_score_range(void* data, size_t begin, size_t end)
+{
+    const SignificanceScoring* scoring = (const SignificanceScoring*)data;
+    Significance* s = scoring->significance;
+    for (size_t k = begin; k < end; ++k)
+    {
+        const uint32_t i = scoring->objects[k];
+        const float pixels = 2.f * scoring->radius[i] * lod_pixel_scale(scoring->vp, scoring->x[i], scoring->y[i],
+            scoring->z ? scoring->z[i] : 0.f, scoring->viewport_height);
+        s->tier[i] = (uint8_t)significance_tier(s, pixels);
+    }
+}
+
+void significance_count(Significance* s, const uint32_t* objects, size_t count)
+{
+    for (size_t k = 0; k < count; ++k)
+        ++s->tiers[s->tier[objects[k]]];
+}
+
+void significance_print(const Significance* s, FILE* out)
+{
+    uint64_t scored = 0;
+    for (int t = 0; t < SIGNIFICANCE_TIERS; ++t)
+        scored += s->tiers[t];
+    const double visible = s->visible ? (double)s->visible : 1.0, tiers = scored ? (double)scored : 1.0;
+    fprintf(out, "significance: %.1f%% of the visible objects updated a frame (%.1f%% as they came into view), "
+        "%.0f visible on average; tiers chosen, every 1 to %u frames:", 100.0 * s->due / visible,
+        100.0 * s->entered / visible, s->frames ? (double)s->visible / s->frames : 0.0, SIGNIFICANCE_MAX_PERIOD);
+    for (int t = 0; t < SIGNIFICANCE_TIERS; ++t)
+        fprintf(out, " %.1f%%", 100.0 * s->tiers[t] / tiers);
+    fprintf(out, "\n");
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Update rates by significance: objects big on screen are updated every
+// frame, small or distant ones every 2nd, 4th or 8th, and objects out of
+// view not at all, so the per-object work a frame scales with what is on
+// screen rather than with the scene.
+//
+// An object's tier is log2 of the frames between its updates. It's chosen
+// each time the object is updated, from the pixels its bounding circle spans
+// (its size over its distance, as lod.h measures them): "full_pixels" or more
+// is tier 0, and each halving under that a tier further down, to
+// SIGNIFICANCE_TIERS - 1. Objects of a tier are staggered by their index, so
+// the tier's updates spread evenly over its frames instead of landing on one.
+//
+// The visible list is filtered once a frame by significance_due: an entry is
+// due when its tier's turn has come, or when the object wasn't seen the frame
+// before (it just came into view, and whatever it was last updated with is
+// stale). What's between an object's updates is the caller's to interpolate
+// or hold; an object is updated at least every 1 << (SIGNIFICANCE_TIERS - 1)
+// frames while it stays in view, which bounds how far that has to reach.
+
+#define SIGNIFICANCE_TIERS 4            // every 1, 2, 4 or 8 frames
+#define SIGNIFICANCE_MAX_PERIOD (1u << (SIGNIFICANCE_TIERS - 1))
+
+typedef struct Significance
+{
+    uint32_t count;
+    float full_pixels;          // an object spanning as many is updated every frame
+    uint8_t* tier;              // [object]: log2 of the frames between its updates
+    uint32_t* seen;             // [object]: the last frame it was in the visible list
+    uint32_t frame;             // the one significance_due filters for next
+
+    // Totals over the run
+    uint64_t frames;
+    uint64_t visible;           // entries filtered, summed
+    uint64_t due;               // of those, due an update
+    uint64_t entered;           // of those, due because they came into view
+    uint64_t tiers[SIGNIFICANCE_TIERS];     // tiers chosen by significance_score_range
+} Significance;
+
+// Every object starts at tier 0, unseen. Returns false when out of memory.
+bool significance_init(Significance* s, uint32_t count, float full_pixels);
+void significance_destroy(Significance* s);
+
+// The tier for an object spanning "pixels" pixels
+int significance_tier(const Significance* s, float pixels);
+
+// Writes the "count" objects of "visible" due an update this frame to "due", in their visible order, marks every
+// one of them seen, and moves on to the next frame. Returns how many are due.
+size_t significance_due(Significance* s, const uint32_t* visible, size_t count, uint32_t* due);
+
+// Objects of a scene choosing their tiers, a range at a time
+typedef struct SignificanceScoring
+{
+    Significance* significance;
+    vec4 const* vp;             // projection * view
+    float viewport_height;
+    const float* x;             // [object]: positions; z may be NULL for objects in the z = 0 plane
+    const float* y;
+    const float* z;
+    const float* radius;        // [object]: bounding circles
+    const uint32_t* objects;    // the entries being updated: significance_due's list
+} SignificanceScoring;
+
+// Chooses the tiers of entries [begin, end) of the list: a JobRangeFunction. The totals of tiers chosen are left
+// to significance_count, which isn't safe to call from several threads.
+void significance_score_range(void* scoring, size_t begin, size_t end);
+
+// Adds the tiers of the "count" objects in "objects" to the totals
+void significance_count(Significance* s, const uint32_t* objects, size_t count);
+
+// One line: how much of what was visible was updated a frame, and the tiers chosen
+void significance_print(const Significance* s, FILE* out);
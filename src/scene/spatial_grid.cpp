@@ -0,0 +1,602 @@
+#include "scene/spatial_grid.h"
+
+#include "core/job_system.h"
+
+#include <atomic>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CELL_BITS 21
+#define CELL_BIAS (1 << (CELL_BITS - 1))       // coordinates from -2^20 to 2^20 - 1 cells, clamped
+#define CELL_MASK ((1u << CELL_BITS) - 1)
+
+static int cell_coord(float v, float inv_cell)
+{
+    const float c = floorf(v * inv_cell);
+    if (!(c >= (float)-CELL_BIAS))             // NaN too
+        return -CELL_BIAS;
+    return c > (float)(CELL_BIAS - 1) ? CELL_BIAS - 1 : (int)c;
+}
+
+static uint64_t cell_key(int x, int y, int z)
+{
+    return ((uint64_t)(uint32_t)(x + CELL_BIAS) << (2 * CELL_BITS)) | ((uint64_t)(uint32_t)(y + CELL_BIAS) << CELL_BITS)
+        | (uint64_t)(uint32_t)(z + CELL_BIAS);
+}
+
+static void cell_coords(uint64_t key, int* c)
+{
+    c[0] = (int)((key >> (2 * CELL_BITS)) & CELL_MASK) - CELL_BIAS;
+    c[1] = (int)((key >> CELL_BITS) & CELL_MASK) - CELL_BIAS;
+    c[2] = (int)(key & CELL_MASK) - CELL_BIAS;
+}
+
+static uint32_t cell_slot(uint64_t key, uint32_t bits)
+{
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - bits));     // Fibonacci hashing
+}
+
+// The box cell "key" covers, widened by the grid's reach: every object kept in the cell lies inside it
+static void cell_box(const SpatialGrid* grid, uint64_t key, vec3 min, vec3 max)
+{
+    int c[3];
+    cell_coords(key, c);
+    for (int k = 0; k < 3; ++k)
+    {
+        min[k] = (float)c[k] * grid->cell - grid->reach[k];
+        max[k] = (float)(c[k] + 1) * grid->cell + grid->reach[k];
+    }
+}
+
+bool spatial_grid_init(SpatialGrid* grid, uint32_t capacity)
+{
+    memset(grid, 0, sizeof(*grid));
+    grid->slot_bits = 1;
+    while ((1ull << grid->slot_bits) < 2ull * capacity)
+        ++grid->slot_bits;
+    grid->slot_count = 1u << grid->slot_bits;
+    grid->slot_start = (uint32_t*)calloc((size_t)grid->slot_count + 1, sizeof(uint32_t));
+    grid->items = (uint32_t*)malloc(sizeof(uint32_t) * (capacity + 1));
+    grid->item_cell = (uint64_t*)malloc(sizeof(uint64_t) * (capacity + 1));
+    grid->item_bounds = (Aabb*)malloc(sizeof(Aabb) * (capacity + 1));
+    grid->object_slot = (uint32_t*)malloc(sizeof(uint32_t) * (capacity + 1));
+    grid->object_cell = (uint64_t*)malloc(sizeof(uint64_t) * (capacity + 1));
+    if (!grid->slot_start || !grid->items || !grid->item_cell || !grid->item_bounds || !grid->object_slot
+        || !grid->object_cell)
+    {
+        fprintf(stderr, "spatial_grid: out of memory for %u objects\n", capacity);
+        spatial_grid_destroy(grid);
+        return false;
+    }
+    grid->capacity = capacity;
+    grid->cell = grid->inv_cell = 1.f;
+    return true;
+}
+
+void spatial_grid_destroy(SpatialGrid* grid)
+{
+    free(grid->slot_start);
+    free(grid->items);
+    free(grid->item_cell);
+    free(grid->item_bounds);
+    free(grid->object_slot);
+    free(grid->object_cell);
+    memset(grid, 0, sizeof(*grid));
+}
+
+typedef struct GridBuild
+{
+    SpatialGrid* grid;
+    const Aabb* bounds;
+    bool parallel;              // counts and cursors are shared between threads: atomic updates
+    uint32_t reach[3];          // float bits: non-negative floats order as their bits do
+    int lo[3];
+    int hi[3];
+} GridBuild;
+
+// *target = max(*target, value), or min with "less"
+template <typename T>
+static void atomic_extreme(T* target, T value, bool less, bool parallel)
+{
+    if (!parallel)
+    {
+        *target = (less ? value < *target : value > *target) ? value : *target;
+        return;
+    }
+    std::atomic_ref<T> ref(*target);
+    T seen = ref.load(std::memory_order_relaxed);
+    while ((less ? value < seen : value > seen) && !ref.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+        ;
+}
+
+// Each object's cell and slot, counted into slot_start[slot]
+static void build_hash_range(void* data, size_t begin, size_t end)
+{
+    GridBuild* build = (GridBuild*)data;
+    SpatialGrid* grid = build->grid;
+    float reach[3] = { 0.f, 0.f, 0.f };
+    int lo[3] = { CELL_BIAS, CELL_BIAS, CELL_BIAS }, hi[3] = { -CELL_BIAS, -CELL_BIAS, -CELL_BIAS };
+    for (size_t i = begin; i < end; ++i)
+    {
+        const Aabb* b = &build->bounds[i];
+        int c[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            c[k] = cell_coord(0.5f * (b->min[k] + b->max[k]), grid->inv_cell);
+            reach[k] = fmaxf(reach[k], 0.5f * (b->max[k] - b->min[k]));
+            lo[k] = c[k] < lo[k] ? c[k] : lo[k];
+            hi[k] = c[k] > hi[k] ? c[k] : hi[k];
+        }
+        const uint64_t key = cell_key(c[0], c[1], c[2]);
+        const uint32_t slot = cell_slot(key, grid->slot_bits);
+        grid->object_cell[i] = key;
+        grid->object_slot[i] = slot;
+        if (build->parallel)
+            std::atomic_ref<uint32_t>(grid->slot_start[slot]).fetch_add(1, std::memory_order_relaxed);
+        else
+            ++grid->slot_start[slot];
+    }
+    for (int k = 0; k < 3; ++k)
+    {
+        uint32_t bits;
+        memcpy(&bits, &reach[k], sizeof(bits));
+        atomic_extreme(&build->reach[k], bits, false, build->parallel);
+        atomic_extreme(&build->lo[k], lo[k], true, build->parallel);
+        atomic_extreme(&build->hi[k], hi[k], false, build->parallel);
+    }
+}
+
+// With slot_start[s] at the end of slot s's entries, each object takes the entry before its slot's cursor, which
+// leaves slot_start[s] at the slot's start once every object is in
+static void build_scatter_range(void* data, size_t begin, size_t end)
+{
+    GridBuild* build = (GridBuild*)data;
+    SpatialGrid* grid = build->grid;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const uint32_t slot = grid->object_slot[i];
+        const uint32_t at = build->parallel
+            ? std::atomic_ref<uint32_t>(grid->slot_start[slot]).fetch_sub(1, std::memory_order_relaxed) - 1
+            : --grid->slot_start[slot];
+        grid->items[at] = (uint32_t)i;
+        grid->item_cell[at] = grid->object_cell[i];
+        grid->item_bounds[at] = build->bounds[i];
+    }
+}
+
+// Each slot's entries in (cell, object) order, by insertion: slots hold a few entries at most
+static void build_sort_range(void* data, size_t begin, size_t end)
+{
+    SpatialGrid* grid = ((GridBuild*)data)->grid;
+    for (size_t s = begin; s < end; ++s)
+    {
+        const uint32_t first = grid->slot_start[s], last = grid->slot_start[s + 1];
+        for (uint32_t e = first + 1; e < last; ++e)
+        {
+            const uint32_t item = grid->items[e];
+            const uint64_t cell = grid->item_cell[e];
+            const Aabb box = grid->item_bounds[e];
+            uint32_t j = e;
+            for (; j > first && (grid->item_cell[j - 1] > cell
+                || (grid->item_cell[j - 1] == cell && grid->items[j - 1] > item)); --j)
+            {
+                grid->items[j] = grid->items[j - 1];
+                grid->item_cell[j] = grid->item_cell[j - 1];
+                grid->item_bounds[j] = grid->item_bounds[j - 1];
+            }
+            grid->items[j] = item;
+            grid->item_cell[j] = cell;
+            grid->item_bounds[j] = box;
+        }
+    }
+}
+
+static void build_pass(JobSystem* jobs, bool parallel, JobRangeFunction function, GridBuild* build, size_t count,
+    size_t grain)
+{
+    if (parallel)
+        job_wait(jobs, job_parallel_for(jobs, function, build, count, grain));
+    else
+        function(build, 0, count);
+}
+
+void spatial_grid_build(SpatialGrid* grid, JobSystem* jobs, const Aabb* bounds, uint32_t count, float cell)
+{
+    if (count > grid->capacity)
+    {
+        fprintf(stderr, "spatial_grid: %u objects over a capacity of %u, the rest left out\n", count, grid->capacity);
+        count = grid->capacity;
+    }
+    grid->count = count;
+    grid->cell = cell > 0.f ? cell : 1.f;
+    grid->inv_cell = 1.f / grid->cell;
+    GridBuild build = { grid, bounds, jobs && jobs->thread_count > 1 && count > SPATIAL_GRID_GRAIN, { 0, 0, 0 },
+        { CELL_BIAS, CELL_BIAS, CELL_BIAS }, { -CELL_BIAS, -CELL_BIAS, -CELL_BIAS } };
+
+    memset(grid->slot_start, 0, sizeof(uint32_t) * ((size_t)grid->slot_count + 1));
+    build_pass(jobs, build.parallel, build_hash_range, &build, count, SPATIAL_GRID_GRAIN);
+    uint32_t sum = 0;
+    for (uint32_t s = 0; s < grid->slot_count; ++s)    // inclusive: each slot's end
+    {
+        sum += grid->slot_start[s];
+        grid->slot_start[s] = sum;
+    }
+    grid->slot_start[grid->slot_count] = count;
+    build_pass(jobs, build.parallel, build_scatter_range, &build, count, SPATIAL_GRID_GRAIN);
+    build_pass(jobs, build.parallel, build_sort_range, &build, grid->slot_count, 2 * SPATIAL_GRID_GRAIN);
+    for (int k = 0; k < 3; ++k)
+    {
+        memcpy(&grid->reach[k], &build.reach[k], sizeof(float));
+        grid->lo[k] = build.lo[k];      // lo > hi with no objects
+        grid->hi[k] = build.hi[k];
+    }
+}
+
+// The cells [lo, hi] the box [min, max] widened by the reach covers, clipped to the occupied ones. Returns how many
+// that is, 0 when none.
+static double cell_range(const SpatialGrid* grid, const vec3 min, const vec3 max, int* lo, int* hi)
+{
+    double cells = 1.0;
+    for (int k = 0; k < 3; ++k)
+    {
+        lo[k] = cell_coord(min[k] - grid->reach[k], grid->inv_cell);
+        hi[k] = cell_coord(max[k] + grid->reach[k], grid->inv_cell);
+        lo[k] = lo[k] > grid->lo[k] ? lo[k] : grid->lo[k];
+        hi[k] = hi[k] < grid->hi[k] ? hi[k] : grid->hi[k];
+        if (lo[k] > hi[k])
+            return 0.0;
+        cells *= (double)(hi[k] - lo[k] + 1);
+    }
+    return cells;
+}
+
+// Calls "visit" with every entry that may overlap the box [min, max]: those in the cells it covers, or every entry
+// when there are more such cells than entries
+typedef void (*GridVisit)(const SpatialGrid* grid, uint32_t entry, void* user);
+
+static void visit_box(const SpatialGrid* grid, const vec3 min, const vec3 max, GridVisit visit, void* user)
+{
+    int lo[3], hi[3];
+    const double cells = cell_range(grid, min, max, lo, hi);
+    if (cells > (double)grid->count)
+    {
+        for (uint32_t e = 0; e < grid->count; ++e)
+            visit(grid, e, user);
+        return;
+    }
+    for (int x = lo[0]; x <= hi[0]; ++x)
+    {
+        for (int y = lo[1]; y <= hi[1]; ++y)
+        {
+            for (int z = lo[2]; z <= hi[2]; ++z)
+            {
+                const uint64_t key = cell_key(x, y, z);
+                const uint32_t slot = cell_slot(key, grid->slot_bits);
+                for (uint32_t e = grid->slot_start[slot]; e < grid->slot_start[slot + 1]; ++e)
+                {
+                    if (grid->item_cell[e] == key)  // another cell can share the slot
+                        visit(grid, e, user);
+                }
+            }
+        }
+    }
+}
+
+typedef struct GridQuery
+{
+    vec3 min;
+    vec3 max;
+    vec3 center;                // sphere queries
+    float radius_sq;
+    bool sphere;
+    uint32_t* out;
+    size_t max_out;
+    size_t found;
+} GridQuery;
+
+static float box_distance_sq(const Aabb* b, const vec3 p)
+{
+    float d = 0.f;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float v = p[k] < b->min[k] ? b->min[k] - p[k] : (p[k] > b->max[k] ? p[k] - b->max[k] : 0.f);
+        d += v * v;
+    }
+    return d;
+}
+
+static void query_visit(const SpatialGrid* grid, uint32_t entry, void* user)
+{
+    GridQuery* q = (GridQuery*)user;
+    const Aabb* b = &grid->item_bounds[entry];
+    for (int k = 0; k < 3; ++k)
+    {
+        if (b->max[k] < q->min[k] || b->min[k] > q->max[k])
+            return;
+    }
+    if (q->sphere && box_distance_sq(b, q->center) > q->radius_sq)
+        return;
+    if (q->found < q->max_out)
+        q->out[q->found] = grid->items[entry];
+    ++q->found;
+}
+
+size_t spatial_grid_query_box(const SpatialGrid* grid, const vec3 min, const vec3 max, uint32_t* out,
+    size_t max_out)
+{
+    GridQuery q;
+    memset(&q, 0, sizeof(q));
+    vec3_dup(q.min, min);
+    vec3_dup(q.max, max);
+    q.out = out;
+    q.max_out = max_out;
+    visit_box(grid, q.min, q.max, query_visit, &q);
+    return q.found;
+}
+
+typedef struct GridVisitBox
+{
+    vec3 min;
+    vec3 max;
+    SpatialGridVisitFunction visit;
+    void* user;
+} GridVisitBox;
+
+static void visit_box_visit(const SpatialGrid* grid, uint32_t entry, void* user)
+{
+    const GridVisitBox* v = (const GridVisitBox*)user;
+    const Aabb* b = &grid->item_bounds[entry];
+    for (int k = 0; k < 3; ++k)
+    {
+        if (b->max[k] < v->min[k] || b->min[k] > v->max[k])
+            return;
+    }
+    v->visit(v->user, grid->items[entry], b);
+}
+
+void spatial_grid_visit_box(const SpatialGrid* grid, const vec3 min, const vec3 max, SpatialGridVisitFunction visit,
+    void* user)
+{
+    GridVisitBox v;
+    vec3_dup(v.min, min);
+    vec3_dup(v.max, max);
+    v.visit = visit;
+    v.user = user;
+    visit_box(grid, v.min, v.max, visit_box_visit, &v);
+}
+
+size_t spatial_grid_query_sphere(const SpatialGrid* grid, const vec3 center, float radius, uint32_t* out,
+    size_t max_out)
+{
+    GridQuery q;
+    memset(&q, 0, sizeof(q));
+    for (int k = 0; k < 3; ++k)
+    {
+        q.min[k] = center[k] - radius;
+        q.max[k] = center[k] + radius;
+    }
+    vec3_dup(q.center, center);
+    q.radius_sq = radius * radius;
+    q.sphere = true;
+    q.out = out;
+    q.max_out = max_out;
+    visit_box(grid, q.min, q.max, query_visit, &q);
+    return q.found;
+}
+
+typedef struct GridNearest
+{
+    vec3 point;
+    float best_sq;
+    int64_t best;
+} GridNearest;
+
+static void nearest_visit(const SpatialGrid* grid, uint32_t entry, void* user)
+{
+    GridNearest* n = (GridNearest*)user;
+    const float d = box_distance_sq(&grid->item_bounds[entry], n->point);
+    const uint32_t item = grid->items[entry];
+    if (d < n->best_sq || (d == n->best_sq && n->best >= 0 && item < (uint32_t)n->best))
+    {
+        n->best_sq = d;
+        n->best = item;
+    }
+}
+
+int64_t spatial_grid_nearest(const SpatialGrid* grid, const vec3 point, float max_distance, float* distance)
+{
+    GridNearest n;
+    vec3_dup(n.point, point);
+    n.best_sq = max_distance * max_distance;
+    n.best = -1;
+    // Every object within "r" has its centre in the box of r around the point, widened by the reach: once the
+    // best found is that close, no farther ring can beat it
+    for (float r = fminf(grid->cell, max_distance);; r = fminf(2.f * r, max_distance))
+    {
+        const vec3 min = { point[0] - r, point[1] - r, point[2] - r };
+        const vec3 max = { point[0] + r, point[1] + r, point[2] + r };
+        visit_box(grid, min, max, nearest_visit, &n);
+        if ((n.best >= 0 && n.best_sq <= r * r) || r >= max_distance)
+            break;
+    }
+    if (n.best >= 0)
+        *distance = sqrtf(n.best_sq);
+    return n.best;
+}
+
+// The run of entries in [e, last) that share entry e's cell; returns its end
+static uint32_t cell_run(const SpatialGrid* grid, uint32_t e, uint32_t last)
+{
+    const uint64_t key = grid->item_cell[e];
+    while (++e < last && grid->item_cell[e] == key)
+        ;
+    return e;
+}
+
+// Entries [e, end), all of one cell, whose boxes may be in the frustum, given the planes the cell straddles
+static size_t cull_run(const SpatialGrid* grid, const Frustum* frustum, int mask, uint32_t e, uint32_t end,
+    uint32_t* visible, size_t n)
+{
+    if (mask == 0)
+    {
+        memcpy(visible + n, grid->items + e, sizeof(uint32_t) * (end - e));
+        return n + (end - e);
+    }
+    for (; e < end; ++e)
+    {
+        visible[n] = grid->items[e];
+        n += frustum_aabb_planes(frustum, grid->item_bounds[e].min, grid->item_bounds[e].max, mask) >= 0;
+    }
+    return n;
+}
+
+// The box around the frustum's eight corners, each where a side plane pair meets the near or far plane. False when
+// the planes don't make a bounded box (a far plane at infinity).
+static bool frustum_box(const Frustum* frustum, vec3 min, vec3 max)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        min[k] = FLT_MAX;
+        max[k] = -FLT_MAX;
+    }
+    for (int c = 0; c < 8; ++c)
+    {
+        const float* a = frustum->planes[c & 1];            // left or right
+        const float* b = frustum->planes[2 + (c >> 1 & 1)]; // bottom or top
+        const float* d = frustum->planes[4 + (c >> 2)];     // near or far
+        // Cramer's rule on n . p = -w for the three planes
+        vec3 bd, da, ab;
+        vec3_mul_cross(bd, b, d);
+        vec3_mul_cross(da, d, a);
+        vec3_mul_cross(ab, a, b);
+        const float det = vec3_mul_inner(a, bd);
+        if (fabsf(det) < 1e-12f)
+            return false;
+        for (int k = 0; k < 3; ++k)
+        {
+            const float p = -(a[3] * bd[k] + b[3] * da[k] + d[3] * ab[k]) / det;
+            if (!isfinite(p))
+                return false;
+            min[k] = fminf(min[k], p);
+            max[k] = fmaxf(max[k], p);
+        }
+    }
+    return true;
+}
+
+size_t spatial_grid_cull(const SpatialGrid* grid, const Frustum* frustum, uint32_t* visible)
+{
+    size_t n = 0;
+    vec3 min, max;
+    int lo[3], hi[3];
+    if (frustum_box(frustum, min, max))
+    {
+        const double cells = cell_range(grid, min, max, lo, hi);
+        if (cells == 0.0)
+            return 0;
+        if (cells < (double)grid->slot_count)
+        {
+            // The cells around the frustum, each tested before its slot is read
+            for (int x = lo[0]; x <= hi[0]; ++x)
+            {
+                for (int y = lo[1]; y <= hi[1]; ++y)
+                {
+                    for (int z = lo[2]; z <= hi[2]; ++z)
+                    {
+                        const uint64_t key = cell_key(x, y, z);
+                        vec3 cell_min, cell_max;
+                        cell_box(grid, key, cell_min, cell_max);
+                        const int mask = frustum_aabb_planes(frustum, cell_min, cell_max, 0x3F);
+                        if (mask < 0)
+                            continue;
+                        const uint32_t slot = cell_slot(key, grid->slot_bits);
+                        const uint32_t last = grid->slot_start[slot + 1];
+                        for (uint32_t e = grid->slot_start[slot]; e < last;)
+                        {
+                            const uint32_t end = cell_run(grid, e, last);
+                            if (grid->item_cell[e] == key)
+                                n = cull_run(grid, frustum, mask, e, end, visible, n);
+                            e = end;
+                        }
+                    }
+                }
+            }
+            return n;
+        }
+    }
+    // Every slot once, a cell's run of entries at a time
+    for (uint32_t s = 0; s < grid->slot_count; ++s)
+    {
+        const uint32_t last = grid->slot_start[s + 1];
+        for (uint32_t e = grid->slot_start[s]; e < last;)
+        {
+            const uint32_t end = cell_run(grid, e, last);
+            vec3 cell_min, cell_max;
+            cell_box(grid, grid->item_cell[e], cell_min, cell_max);
+            const int mask = frustum_aabb_planes(frustum, cell_min, cell_max, 0x3F);
+            if (mask >= 0)
+                n = cull_run(grid, frustum, mask, e, end, visible, n);
+            e = end;
+        }
+    }
+    return n;
+}
+
+// Slab test: entry distance of the ray into the box within [0, max_t], or FLT_MAX for a miss
+static float ray_box(const vec3 origin, const vec3 inv_dir, const vec3 min, const vec3 max, float max_t)
+{
+    float t0 = 0.f, t1 = max_t;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float a = (min[k] - origin[k]) * inv_dir[k];
+        const float b = (max[k] - origin[k]) * inv_dir[k];
+        t0 = fmaxf(t0, fminf(a, b));
+        t1 = fminf(t1, fmaxf(a, b));
+    }
+    return t0 <= t1 ? t0 : FLT_MAX;
+}
+
+int64_t spatial_grid_raycast(const SpatialGrid* grid, const vec3 origin, const vec3 dir, float max_t,
+    BvhRayHitFunction hit, void* user, float* t)
+{
+    vec3 inv_dir;
+    for (int k = 0; k < 3; ++k)
+        inv_dir[k] = 1.f / dir[k];
+    float best = max_t;
+    int64_t best_object = -1;
+    for (uint32_t s = 0; s < grid->slot_count; ++s)
+    {
+        const uint32_t last = grid->slot_start[s + 1];
+        for (uint32_t e = grid->slot_start[s]; e < last;)
+        {
+            const uint32_t end = cell_run(grid, e, last);
+            vec3 min, max;
+            cell_box(grid, grid->item_cell[e], min, max);
+            if (ray_box(origin, inv_dir, min, max, best) == FLT_MAX)
+            {
+                e = end;
+                continue;
+            }
+            for (; e < end; ++e)
+            {
+                float te = ray_box(origin, inv_dir, grid->item_bounds[e].min, grid->item_bounds[e].max, best);
+                if (te == FLT_MAX)
+                    continue;
+                if (hit)
+                {
+                    te = hit(user, grid->items[e], origin, dir);
+                    if (te < 0.f || te > best)
+                        continue;
+                }
+                best = te;
+                best_object = grid->items[e];
+            }
+        }
+    }
+    if (best_object >= 0)
+        *t = best;
+    return best_object;
+}
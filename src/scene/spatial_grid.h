@@ -0,0 +1,93 @@
+#pragma once
+
+#include "linmath.h"
+#include "scene/bvh.h"
+#include "scene/frustum.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct JobSystem JobSystem;
+
+// Uniform spatial hash grid over object AABBs: the index for objects that
+// all move every frame, where a BVH's refit costs as much as it saves and
+// its tree degrades besides.
+//
+// Space is cut into cubes of "cell" units. Each object goes in the one cell
+// its box's centre falls in, and cells are hashed into a table of a power of
+// two slots, at least twice the object count, so the grid is unbounded and
+// its memory follows the objects rather than the space they cover. The build
+// is a counting sort: hash every object and count per slot, a prefix sum,
+// then scatter, leaving the objects in slot order with their boxes copied
+// alongside, so a query reads contiguous memory. Within a slot they're sorted
+// by cell and then by object, so builds come out the same on any thread
+// count. Every step is O(n); with a job system the hashing, scatter and
+// sorting run over its threads and only the prefix sum is serial.
+//
+// Since an object is kept by its centre, queries widen by the largest
+// half-extent of any object in the grid: one huge object makes every query
+// visit more cells. A cell at least an object across is right, and in a
+// sparse space about as wide as the usual neighbour query.
+//
+// Queries visit the cells they overlap, clipped to the cells that hold
+// objects, or else every slot once when that's fewer: box and sphere queries
+// (a sphere around an object is its neighbours) and culling, which clips to
+// the box around the frustum's corners. A cell's box is tested against the
+// frustum before its slot is read, and a cell wholly inside takes its objects
+// untested. Ray casts visit every slot, which suits picking.
+
+#define SPATIAL_GRID_GRAIN 16384    // objects per job in a parallel build
+
+typedef struct SpatialGrid
+{
+    uint32_t capacity;
+    uint32_t count;
+    float cell;                 // cube size
+    float inv_cell;
+    vec3 reach;                 // the largest half-extent of any object, per axis: what queries widen by
+    int lo[3];                  // the cells holding objects lie within [lo, hi], per axis
+    int hi[3];
+    uint32_t slot_bits;
+    uint32_t slot_count;        // 1 << slot_bits
+    uint32_t* slot_start;       // [slot_count + 1]: a slot's entries are [slot_start[s], slot_start[s + 1])
+    uint32_t* items;            // object index per entry
+    uint64_t* item_cell;        // packed cell coordinates per entry
+    Aabb* item_bounds;          // per entry
+    uint32_t* object_slot;      // scratch: each object's slot, in object order
+    uint64_t* object_cell;      // scratch: each object's cell
+} SpatialGrid;
+
+// Allocates for up to "capacity" objects. Logs and returns false when out of memory.
+bool spatial_grid_init(SpatialGrid* grid, uint32_t capacity);
+void spatial_grid_destroy(SpatialGrid* grid);
+
+// Rebuilds the grid over "bounds[0..count)" (count <= capacity) with cells of "cell" units, on "jobs" when given
+// (called from a thread running in it) and serially otherwise
+void spatial_grid_build(SpatialGrid* grid, JobSystem* jobs, const Aabb* bounds, uint32_t count, float cell);
+
+// Writes the index of every object whose AABB overlaps the box [min, max] to "out" (room for "max_out"), in the same
+// order for the same grid. Returns how many overlap, which may be more than were written.
+size_t spatial_grid_query_box(const SpatialGrid* grid, const vec3 min, const vec3 max, uint32_t* out,
+    size_t max_out);
+
+// As spatial_grid_query_box, calling "visit" with each object and its AABB instead of writing it out
+typedef void (*SpatialGridVisitFunction)(void* user, uint32_t object, const Aabb* bounds);
+void spatial_grid_visit_box(const SpatialGrid* grid, const vec3 min, const vec3 max, SpatialGridVisitFunction visit,
+    void* user);
+
+// As spatial_grid_query_box, for the objects whose AABB comes within "radius" of "center"
+size_t spatial_grid_query_sphere(const SpatialGrid* grid, const vec3 center, float radius, uint32_t* out,
+    size_t max_out);
+
+// The object whose AABB is nearest "point" (0 inside it) within "max_distance", searching outwards a cell ring at
+// a time; sets *distance. Returns -1 when there's none that close.
+int64_t spatial_grid_nearest(const SpatialGrid* grid, const vec3 point, float max_distance, float* distance);
+
+// As bvh_cull: every object whose AABB may intersect the frustum, written to "visible" (room for the object
+// count), in the same order for the same grid. Returns the count.
+size_t spatial_grid_cull(const SpatialGrid* grid, const Frustum* frustum, uint32_t* visible);
+
+// As bvh_raycast: the nearest object hit by origin + t * dir for 0 <= t <= max_t, tested exactly by "hit" when
+// given. For picking: it visits every slot.
+int64_t spatial_grid_raycast(const SpatialGrid* grid, const vec3 origin, const vec3 dir, float max_t,
+    BvhRayHitFunction hit, void* user, float* t);
@@ -0,0 +1,55 @@
+#include "scene/temporal.h"
+
+#include <string.h>
+
+void temporal_init(Temporal* t)
+{
+    memset(t, 0, sizeof(*t));
+    mat4x4_identity(t->view_projection);
+    mat4x4_identity(t->previous_view_projection);
+    mat4x4_identity(t->reprojection);
+}
+
+float temporal_halton(uint32_t n, uint32_t base)
+{
+    float f = 1.f, r = 0.f;
+    while (n > 0)
+    {
+        f /= base;
+        r += f * (n % base);
+        n /= base;
+    }
+    return r;
+}
+
+void temporal_begin_frame(Temporal* t, mat4x4 const view_projection, int width, int height)
+{
+    t->history_valid = t->frame > 0 && !t->reset && width == t->width && height == t->height;
+    t->reset = false;
+    t->width = width;
+    t->height = height;
+    mat4x4_dup(t->previous_view_projection, t->history_valid ? t->view_projection : view_projection);
+    mat4x4_dup(t->view_projection, view_projection);
+    mat4x4 inverse;
+    mat4x4_invert(inverse, t->view_projection);
+    mat4x4_mul(t->reprojection, t->previous_view_projection, inverse);
+
+    // From 1: the sequence's 0th point is the corner, not a sample inside the pixel
+    const uint32_t phase = t->frame % TEMPORAL_JITTER_PHASES + 1;
+    t->jitter[0] = temporal_halton(phase, 2) - 0.5f;
+    t->jitter[1] = temporal_halton(phase, 3) - 0.5f;
+    ++t->frame;
+}
+
+void temporal_reset(Temporal* t)
+{
+    t->reset = true;
+}
+
+void temporal_jitter_matrix(const Temporal* t, mat4x4 out)
+{
+    // A translation by the jitter in NDC, scaled by w so it survives the divide: a pixel is 2 / size of NDC
+    mat4x4_identity(out);
+    out[3][0] = t->width > 0 ? 2.f * t->jitter[0] / t->width : 0.f;
+    out[3][1] = t->height > 0 ? 2.f * t->jitter[1] / t->height : 0.f;
+}
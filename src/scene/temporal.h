@@ -0,0 +1,52 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stdint.h>
+
+// The camera side of temporal effects: what the frame before saw and how to
+// get there. Nothing here touches GL; gl/temporal_aa.h resolves with it.
+//
+// Each frame the projection is shifted by a sub-pixel jitter (the Halton
+// 2, 3 sequence, TEMPORAL_JITTER_PHASES long), so successive frames sample
+// different points inside every pixel and a history that keeps them adds up
+// to a supersampled image. The unjittered view-projection of this frame and
+// the one before give "reprojection", this frame's clip space to the last
+// one's: a pixel's clip position and depth through it land where the same
+// point was drawn a frame ago - its motion vector, for a still scene under a
+// moving camera.
+//
+// The history is only worth reading when the frame before drew the same
+// pixels: a resize, or a temporal_reset (a cut, a teleport), leaves
+// history_valid false for one frame.
+
+#define TEMPORAL_JITTER_PHASES 8    // frames before the jitter repeats
+
+typedef struct Temporal
+{
+    uint32_t frame;                 // temporal_begin_frame calls so far
+    vec2 jitter;                    // this frame's offset in pixels, each in [-0.5, 0.5]
+    mat4x4 view_projection;         // this frame's, unjittered
+    mat4x4 previous_view_projection;
+    mat4x4 reprojection;            // this frame's clip space to the last one's
+    int width;                      // the view's size in pixels, as the jitter is scaled for
+    int height;
+    bool history_valid;             // the last frame drew this view at this size
+    bool reset;                     // temporal_reset since the last frame
+} Temporal;
+
+void temporal_init(Temporal* t);
+
+// The n-th point of the Halton sequence in "base", in [0, 1)
+float temporal_halton(uint32_t n, uint32_t base);
+
+// A new frame of a "width" x "height" view whose unjittered view-projection is "view_projection": the jitter
+// moves on, the last frame's matrix becomes the previous one and the reprojection is rebuilt
+void temporal_begin_frame(Temporal* t, mat4x4 const view_projection, int width, int height);
+
+// The history no longer matches the view (a cut): the next frame starts over
+void temporal_reset(Temporal* t);
+
+// The clip-space translation that shifts what a projection draws by this frame's jitter: jittered = out * projection,
+// orthographic or perspective alike
+void temporal_jitter_matrix(const Temporal* t, mat4x4 out);
@@ -0,0 +1,258 @@
+#include "scene/terrain.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool terrain_init(Terrain* terrain, const float origin[2], float size, float height_min, float height_max, int levels,
+    int grid, float detail)
+{
+    memset(terrain, 0, sizeof(*terrain));
+    if (grid < 4 || grid > 128 || (grid & (grid - 1)) || levels < 1 || levels > TERRAIN_MAX_LEVELS)
+        return false;
+    terrain->origin[0] = origin[0];
+    terrain->origin[1] = origin[1];
+    terrain->size = size;
+    terrain->height_min = height_min;
+    terrain->height_max = height_max;
+    terrain->levels = levels;
+    terrain->grid = grid;
+    detail = detail > TERRAIN_MIN_DETAIL ? detail : TERRAIN_MIN_DETAIL;
+    float previous = 0.f;
+    uint32_t offset = 0;
+    for (int l = 0; l < levels; ++l)
+    {
+        terrain->ranges[l] = detail * terrain_node_size(terrain, l);
+        terrain->morph_start[l] = previous + TERRAIN_MORPH_START * (terrain->ranges[l] - previous);
+        previous = terrain->ranges[l];
+        const uint32_t side = 1u << (levels - 1 - l);
+        terrain->level_offset[l] = offset;
+        offset += side * side;
+    }
+    return true;
+}
+
+void terrain_destroy(Terrain* terrain)
+{
+    free(terrain->bounds);
+    terrain->bounds = NULL;
+}
+
+float terrain_node_size(const Terrain* terrain, int level)
+{
+    return terrain->size / (float)(1u << (terrain->levels - 1 - level));
+}
+
+float terrain_cell_size(const Terrain* terrain, int level)
+{
+    return terrain_node_size(terrain, level) / (float)terrain->grid;
+}
+
+bool terrain_set_heights(Terrain* terrain, const uint16_t* heights, int width)
+{
+    const int levels = terrain->levels;
+    float* bounds = (float*)malloc(sizeof(float) * 2 * (terrain->level_offset[levels - 1] + 1));
+    if (!bounds)
+        return false;
+    free(terrain->bounds);
+    terrain->bounds = bounds;
+
+    // A leaf covers the texels whose centres surround it: bilinear samples anywhere on it lie between those
+    const int side = 1 << (levels - 1);
+    const float scale = (terrain->height_max - terrain->height_min) / 65535.f;
+    for (int ny = 0; ny < side; ++ny)
+    {
+        const int y0 = (int)floorf((float)ny / side * width - 0.5f);
+        const int y1 = (int)floorf((float)(ny + 1) / side * width - 0.5f) + 1;
+        for (int nx = 0; nx < side; ++nx)
+        {
+            const int x0 = (int)floorf((float)nx / side * width - 0.5f);
+            const int x1 = (int)floorf((float)(nx + 1) / side * width - 0.5f) + 1;
+            uint16_t lo = 65535, hi = 0;
+            for (int y = y0 < 0 ? 0 : y0; y <= (y1 < width ? y1 : width - 1); ++y)
+            {
+                for (int x = x0 < 0 ? 0 : x0; x <= (x1 < width ? x1 : width - 1); ++x)
+                {
+                    const uint16_t h = heights[(size_t)y * width + x];
+                    lo = h < lo ? h : lo;
+                    hi = h > hi ? h : hi;
+                }
+            }
+            float* b = &bounds[2 * ((size_t)ny * side + nx)];
+            b[0] = terrain->height_min + scale * lo;
+            b[1] = terrain->height_min + scale * hi;
+        }
+    }
+    // Every other level from its four children
+    for (int l = 1; l < levels; ++l)
+    {
+        const int n = 1 << (levels - 1 - l);
+        const float* children = &bounds[2 * terrain->level_offset[l - 1]];
+        float* b = &bounds[2 * terrain->level_offset[l]];
+        for (int ny = 0; ny < n; ++ny)
+        {
+            for (int nx = 0; nx < n; ++nx, b += 2)
+            {
+                b[0] = INFINITY;
+                b[1] = -INFINITY;
+                for (int q = 0; q < 4; ++q)
+                {
+                    const float* c = &children[2 * ((size_t)(2 * ny + (q >> 1)) * 2 * n + 2 * nx + (q & 1))];
+                    b[0] = fminf(b[0], c[0]);
+                    b[1] = fmaxf(b[1], c[1]);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+typedef struct SelectContext
+{
+    const Terrain* terrain;
+    const Frustum* frustum;
+    const float* eye;
+    TerrainSelection* selection;
+} SelectContext;
+
+static void node_box(const Terrain* terrain, int level, int nx, int ny, vec3 min, vec3 max)
+{
+    const float size = terrain_node_size(terrain, level);
+    min[0] = terrain->origin[0] + nx * size;
+    min[1] = terrain->origin[1] + ny * size;
+    max[0] = min[0] + size;
+    max[1] = min[1] + size;
+    if (terrain->bounds)
+    {
+        const size_t side = (size_t)1 << (terrain->levels - 1 - level);
+        const float* b = &terrain->bounds[2 * (terrain->level_offset[level] + ny * side + nx)];
+        min[2] = b[0];
+        max[2] = b[1];
+    }
+    else
+    {
+        min[2] = terrain->height_min;
+        max[2] = terrain->height_max;
+    }
+}
+
+static bool in_range(const float* eye, const vec3 min, const vec3 max, float range)
+{
+    float d2 = 0.f;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float d = eye[k] < min[k] ? min[k] - eye[k] : eye[k] > max[k] ? eye[k] - max[k] : 0.f;
+        d2 += d * d;
+    }
+    return d2 <= range * range;
+}
+
+static void emit(SelectContext* c, bool whole, const vec3 min, float size, int level)
+{
+    TerrainSelection* s = c->selection;
+    uint32_t* count = whole ? &s->whole_count : &s->quarter_count;
+    if (*count >= s->capacity)
+    {
+        ++s->dropped;
+        return;
+    }
+    TerrainPatch* p = &(whole ? s->whole : s->quarters)[(*count)++];
+    p->x = min[0];
+    p->y = min[1];
+    p->size = size;
+    p->cell = terrain_cell_size(c->terrain, level);
+    p->morph[0] = c->terrain->morph_start[level];
+    p->morph[1] = c->terrain->ranges[level];
+    s->finest = level < s->finest ? level : s->finest;
+}
+
+// A node that reaches into its own level's range (or the root): whole, or split where it reaches into the next
+// level down's
+static void select_node(SelectContext* c, int level, int nx, int ny, int mask)
+{
+    const Terrain* terrain = c->terrain;
+    vec3 min, max;
+    node_box(terrain, level, nx, ny, min, max);
+    if (c->frustum && (mask = frustum_aabb_planes(c->frustum, min, max, mask)) < 0)
+        return;
+    if (level == 0 || !in_range(c->eye, min, max, terrain->ranges[level - 1]))
+    {
+        emit(c, true, min, terrain_node_size(terrain, level), level);
+        return;
+    }
+    for (int q = 0; q < 4; ++q)
+    {
+        const int cx = 2 * nx + (q & 1), cy = 2 * ny + (q >> 1);
+        vec3 child_min, child_max;
+        node_box(terrain, level - 1, cx, cy, child_min, child_max);
+        if (in_range(c->eye, child_min, child_max, terrain->ranges[level - 1]))
+            select_node(c, level - 1, cx, cy, mask);
+        else if (!c->frustum || frustum_aabb_planes(c->frustum, child_min, child_max, mask) >= 0)
+            emit(c, false, child_min, terrain_node_size(terrain, level - 1), level);
+    }
+}
+
+uint32_t terrain_select(const Terrain* terrain, const Frustum* frustum, const vec3 eye, TerrainSelection* selection)
+{
+    selection->whole_count = selection->quarter_count = selection->dropped = 0;
+    selection->finest = terrain->levels;
+    SelectContext c = { terrain, frustum, eye, selection };
+    select_node(&c, terrain->levels - 1, 0, 0, 0x3F);
+    return selection->whole_count + selection->quarter_count;
+}
+
+// Value noise: a hash per lattice point of each octave, smoothly interpolated
+static float lattice(int x, int y, uint32_t seed)
+{
+    uint32_t h = (uint32_t)x * 0x8DA6B343u ^ (uint32_t)y * 0xD8163841u ^ seed * 0xCB1AB31Fu;
+    h ^= h >> 16; h *= 0x7FEB352Du; h ^= h >> 15; h *= 0x846CA68Bu; h ^= h >> 16;
+    return (float)(h >> 8) * (1.f / 16777216.f);
+}
+
+static float value_noise(float x, float y, uint32_t seed)
+{
+    const float fx = floorf(x), fy = floorf(y);
+    const int ix = (int)fx, iy = (int)fy;
+    float u = x - fx, v = y - fy;
+    u = u * u * u * (u * (u * 6.f - 15.f) + 10.f);
+    v = v * v * v * (v * (v * 6.f - 15.f) + 10.f);
+    const float a = lattice(ix, iy, seed), b = lattice(ix + 1, iy, seed);
+    const float c = lattice(ix, iy + 1, seed), d = lattice(ix + 1, iy + 1, seed);
+    return a + (b - a) * u + (c - a) * v + (a - b - c + d) * u * v;
+}
+
+void terrain_generate_heights(uint16_t* heights, int width, uint32_t seed, float flat)
+{
+    // Octaves from 4 lattice cells across down to about a texel each. Each ridge octave is weighted by the one
+    // before, so the fine detail gathers on the ridges and the valleys stay smooth.
+    int octaves = 1;
+    while ((4 << octaves) <= width && octaves < 16)
+        ++octaves;
+    for (int y = 0; y < width; ++y)
+    {
+        const float v = ((float)y + 0.5f) / width;
+        for (int x = 0; x < width; ++x)
+        {
+            const float u = ((float)x + 0.5f) / width;
+            float h = 0.f, amplitude = 0.5f, total = 0.f, weight = 1.f;
+            for (int k = 0; k < octaves; ++k)
+            {
+                const float frequency = (float)(4 << k);
+                float r = 1.f - fabsf(2.f * value_noise(u * frequency, v * frequency, seed + (uint32_t)k) - 1.f);
+                r *= r * weight;
+                weight = fminf(1.f, 2.f * r);
+                h += amplitude * r;
+                total += amplitude;
+                amplitude *= 0.5f;
+            }
+            h /= total;
+            if (flat > 0.f)
+            {
+                const float d = sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+                float t = fminf(1.f, fmaxf(0.f, (d - flat) / (3.f * flat)));
+                h *= t * t * (3.f - 2.f * t);
+            }
+            heights[(size_t)y * width + x] = (uint16_t)(h * 65535.f + 0.5f);
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "linmath.h"
+#include "scene/frustum.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Heightfield terrain as a CDLOD quadtree (continuous distance-dependent
+// level of detail): which patches of a square heightfield to draw from an
+// eye, and at what density, so the triangles stay about the same size on
+// screen from the eye's feet out to kilometres away.
+//
+// The root node covers the whole terrain; level 0 is the leaves, level
+// "levels" - 1 the root. Every node is drawn with the same grid of "grid" x
+// "grid" cells, so a level's cells are twice the size of the level below's.
+// Level L covers the eye's surroundings out to ranges[L], twice as far as
+// level L - 1: a node that reaches into the range of the level below is
+// split, and of its four quadrants those that don't reach into it are drawn
+// at the node's level, with half the grid. So there are only two meshes, the
+// whole grid and its every other vertex, and one index buffer holds both.
+//
+// Levels meet without cracks because each vertex morphs: from morph[0] out
+// to morph[1] (the end of its level's range) it slides onto the grid of
+// twice its cell, the next level's, where the next level's vertices are
+// still unmorphed. A vertex's morph comes from its own distance from the
+// eye, so the vertex a patch and its neighbour share ends up in the same
+// place in both. That takes ranges at least a few node sizes apart, which
+// terrain_init makes sure of.
+//
+// Heights are a unorm value in [0, 1] mapped to [height_min, height_max].
+// Culling and distances use each node's bounds: the heights under it, when
+// the caller has them (terrain_set_heights), or the whole height range.
+//
+// Nothing here calls GL; gl/terrain_renderer.h draws the selection.
+
+#define TERRAIN_MAX_LEVELS 16
+#define TERRAIN_MORPH_START 0.66f   // of the way from the previous level's range to its own, a level starts morphing
+#define TERRAIN_MIN_DETAIL 3.f      // level L's range in its node sizes: any less and the morph can't close the seams
+
+typedef struct TerrainPatch
+{
+    float x, y;                 // the corner with the smallest coordinates
+    float size;                 // side
+    float cell;                 // side of a cell of its level's grid; its vertices morph onto twice this
+    float morph[2];             // distances from the eye where the morph starts and ends
+} TerrainPatch;
+
+typedef struct Terrain
+{
+    float origin[2];            // the corner with the smallest coordinates
+    float size;                 // side
+    float height_min, height_max;
+    int levels;                 // 1 .. TERRAIN_MAX_LEVELS
+    int grid;                   // cells along a whole patch: a power of two, at least 4
+    float ranges[TERRAIN_MAX_LEVELS];
+    float morph_start[TERRAIN_MAX_LEVELS];
+    float* bounds;              // min and max height of every node, leaves first; NULL: the height range for all
+    uint32_t level_offset[TERRAIN_MAX_LEVELS];  // of each level's nodes in "bounds", row by row
+} Terrain;
+
+// A terrain of side "size" from "origin". "detail" is the leaves' range in leaf sizes (at least TERRAIN_MIN_DETAIL):
+// larger draws finer triangles further out. Returns false for a "grid" that isn't a power of two from 4 to 128, or
+// "levels" out of range.
+bool terrain_init(Terrain* terrain, const float origin[2], float size, float height_min, float height_max, int levels,
+    int grid, float detail);
+void terrain_destroy(Terrain* terrain);
+
+// Side of a node of "level", and of its cells
+float terrain_node_size(const Terrain* terrain, int level);
+float terrain_cell_size(const Terrain* terrain, int level);
+
+// Bounds for every node from the heights it's drawn from: "width" x "width" unorm16 texels over the terrain, the
+// first row at the origin's y, sampled bilinearly between texel centres. Returns false when out of memory (the
+// terrain keeps the whole height range).
+bool terrain_set_heights(Terrain* terrain, const uint16_t* heights, int width);
+
+typedef struct TerrainSelection
+{
+    TerrainPatch* whole;        // [capacity]: nodes drawn with the whole grid
+    TerrainPatch* quarters;     // [capacity]: quadrants of nodes, drawn with half of it
+    uint32_t capacity;
+    uint32_t whole_count;
+    uint32_t quarter_count;
+    uint32_t dropped;           // patches past the capacity
+    int finest;                 // the lowest level selected; "levels" when nothing was
+} TerrainSelection;
+
+// The patches to draw from "eye", those in "frustum" (NULL: all of them), into "selection", whose arrays are the
+// caller's. Returns the patches written.
+uint32_t terrain_select(const Terrain* terrain, const Frustum* frustum, const vec3 eye, TerrainSelection* selection);
+
+// Made-up heights for the terrain, "width" x "width" unorm16 texels in the layout terrain_set_heights takes: ridged
+// fractal noise seeded by "seed", falling to 0 within "flat" of the centre (a fraction of the side) so whatever
+// stands there stands on level ground
+void terrain_generate_heights(uint16_t* heights, int width, uint32_t seed, float flat);
@@ -0,0 +1,159 @@
+#include "scene/transform_hierarchy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool transform_hierarchy_init(TransformHierarchy* h, uint32_t capacity)
+{
+    memset(h, 0, sizeof(*h));
+    h->parent = (uint32_t*)malloc(sizeof(uint32_t) * capacity);
+    h->local = (trs*)malloc(sizeof(trs) * capacity);
+    h->world = (trs*)malloc(sizeof(trs) * capacity);
+    h->dirty = (uint8_t*)malloc(capacity);
+    h->updated_in = (uint32_t*)malloc(sizeof(uint32_t) * capacity);
+    h->capacity = capacity;
+    if (capacity && (!h->parent || !h->local || !h->world || !h->dirty || !h->updated_in))
+    {
+        fprintf(stderr, "transform_hierarchy: out of memory for %u nodes\n", capacity);
+        transform_hierarchy_destroy(h);
+        return false;
+    }
+    return true;
+}
+
+void transform_hierarchy_destroy(TransformHierarchy* h)
+{
+    free(h->parent);
+    free(h->local);
+    free(h->world);
+    free(h->dirty);
+    free(h->updated_in);
+    memset(h, 0, sizeof(*h));
+}
+
+static void mark_dirty(TransformHierarchy* h, uint32_t node)
+{
+    h->dirty[node] = 1;
+    if (node < h->first_dirty)
+        h->first_dirty = node;
+}
+
+uint32_t transform_hierarchy_add(TransformHierarchy* h, uint32_t parent, const trs* local)
+{
+    if (h->count == h->capacity || (parent != TRANSFORM_NO_PARENT && parent >= h->count))
+        return TRANSFORM_NO_PARENT;
+    const uint32_t node = h->count++;
+    h->parent[node] = parent;
+    h->local[node] = *local;
+    h->updated_in[node] = 0;
+    if (node == 0)
+        h->first_dirty = 0;
+    mark_dirty(h, node);
+    return node;
+}
+
+void transform_hierarchy_set_local(TransformHierarchy* h, uint32_t node, const trs* local)
+{
+    h->local[node] = *local;
+    mark_dirty(h, node);
+}
+
+bool transform_hierarchy_sort(TransformHierarchy* h, uint32_t* remap)
+{
+    const uint32_t n = h->count;
+    // Children of each node as one CSR list (first_child[p] .. first_child[p + 1]), roots under slot n
+    uint32_t* first_child = (uint32_t*)calloc(n + 2, sizeof(uint32_t));
+    uint32_t* children = (uint32_t*)malloc(sizeof(uint32_t) * (n ? n : 1));
+    uint32_t* order = (uint32_t*)malloc(sizeof(uint32_t) * (n ? n : 1));
+    uint32_t* new_index = (uint32_t*)malloc(sizeof(uint32_t) * (n ? n : 1));
+    TransformHierarchy sorted;
+    const bool ok = first_child && children && order && new_index && transform_hierarchy_init(&sorted, h->capacity);
+    if (!ok)
+    {
+        fprintf(stderr, "transform_hierarchy: out of memory sorting %u nodes\n", n);
+        free(first_child);
+        free(children);
+        free(order);
+        free(new_index);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < n; ++i)
+        ++first_child[(h->parent[i] == TRANSFORM_NO_PARENT ? n : h->parent[i]) + 1];
+    for (uint32_t p = 0; p <= n; ++p)
+        first_child[p + 1] += first_child[p];
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const uint32_t p = h->parent[i] == TRANSFORM_NO_PARENT ? n : h->parent[i];
+        children[first_child[p]++] = i;     // insertion order within each parent
+    }
+    for (uint32_t p = n; p > 0; --p)        // undo the advance: first_child[p] is the start again
+        first_child[p] = first_child[p - 1];
+    first_child[0] = 0;
+
+    // Breadth-first: the order array doubles as the queue
+    uint32_t tail = 0;
+    for (uint32_t c = first_child[n]; c < first_child[n + 1]; ++c)
+        order[tail++] = children[c];
+    for (uint32_t head = 0; head < tail; ++head)
+    {
+        const uint32_t node = order[head];
+        for (uint32_t c = first_child[node]; c < first_child[node + 1]; ++c)
+            order[tail++] = children[c];
+    }
+
+    for (uint32_t k = 0; k < n; ++k)
+        new_index[order[k]] = k;
+    sorted.first_dirty = n;
+    for (uint32_t k = 0; k < n; ++k)
+    {
+        const uint32_t old = order[k];
+        sorted.parent[k] = h->parent[old] == TRANSFORM_NO_PARENT ? TRANSFORM_NO_PARENT : new_index[h->parent[old]];
+        sorted.local[k] = h->local[old];
+        sorted.world[k] = h->world[old];
+        sorted.dirty[k] = h->dirty[old];
+        sorted.updated_in[k] = h->updated_in[old];
+        if (sorted.dirty[k] && k < sorted.first_dirty)
+            sorted.first_dirty = k;
+    }
+    if (remap)
+        memcpy(remap, new_index, sizeof(uint32_t) * n);
+
+    sorted.count = n;
+    sorted.serial = h->serial;
+    sorted.updated = h->updated;
+    sorted.updated_total = h->updated_total;
+    transform_hierarchy_destroy(h);
+    *h = sorted;
+    free(first_child);
+    free(children);
+    free(order);
+    free(new_index);
+    return true;
+}
+
+void transform_hierarchy_update(TransformHierarchy* h)
+{
+    // A node is recomputed when it changed or its parent was recomputed earlier in this same sweep,
+    // which the parent's serial tells without a second pass to clear flags
+    const uint32_t serial = ++h->serial;
+    uint32_t updated = 0;
+    for (uint32_t i = h->first_dirty; i < h->count; ++i)
+    {
+        const uint32_t p = h->parent[i];
+        const bool parent_moved = p != TRANSFORM_NO_PARENT && h->updated_in[p] == serial;
+        if (!h->dirty[i] && !parent_moved)
+            continue;
+        if (p == TRANSFORM_NO_PARENT)
+            h->world[i] = h->local[i];
+        else
+            trs_mul(&h->world[i], &h->world[p], &h->local[i]);
+        h->dirty[i] = 0;
+        h->updated_in[i] = serial;
+        ++updated;
+    }
+    h->first_dirty = h->count;
+    h->updated = updated;
+    h->updated_total += updated;
+}
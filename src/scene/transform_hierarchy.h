@@ -0,0 +1,56 @@
+#pragma once
+
+#include "linmath_trs.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parent/child transforms with incremental world-matrix updates.
+//
+// Nodes are stored in flat arrays in which every parent comes before its
+// children. transform_hierarchy_sort puts them in breadth-first order: roots
+// first, then each level's children grouped by parent, so siblings are
+// adjacent and one forward sweep visits parents before children.
+//
+// Transforms are 40-byte trs (linmath_trs.h) rather than 64-byte matrices;
+// trs_to_mat4x4 turns a world transform into a matrix when it's uploaded.
+//
+// Changing a node's local transform only marks it dirty. transform_hierarchy_update
+// sweeps forward from the first dirty node and recomputes a world transform only
+// when the node itself changed or its parent was recomputed in the same sweep,
+// so static parts of the scene cost a flag test per node and no transform math.
+// "updated" reports how many world transforms the last update recomputed.
+
+#define TRANSFORM_NO_PARENT 0xFFFFFFFFu
+
+typedef struct TransformHierarchy
+{
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t* parent;           // TRANSFORM_NO_PARENT for roots, otherwise a lower index
+    trs* local;                 // relative to the parent
+    trs* world;                 // world = world[parent] * local, valid after transform_hierarchy_update
+    uint8_t* dirty;             // local changed since the last update
+    uint32_t* updated_in;       // the update serial that last recomputed world[i]
+    uint32_t serial;
+    uint32_t first_dirty;       // no node below it is dirty (count when none is)
+    uint32_t updated;           // world transforms recomputed by the last update
+    uint64_t updated_total;     // summed over every update
+} TransformHierarchy;
+
+// Logs and returns false when out of memory
+bool transform_hierarchy_init(TransformHierarchy* h, uint32_t capacity);
+void transform_hierarchy_destroy(TransformHierarchy* h);
+
+// Appends a node under "parent" (TRANSFORM_NO_PARENT: a root), which must already exist. Returns its index,
+// or TRANSFORM_NO_PARENT when the hierarchy is full or the parent is invalid.
+uint32_t transform_hierarchy_add(TransformHierarchy* h, uint32_t parent, const trs* local);
+
+void transform_hierarchy_set_local(TransformHierarchy* h, uint32_t node, const trs* local);
+
+// Reorders the nodes breadth-first. "remap" (may be NULL, room for count) receives each old index's new one.
+// Logs and returns false (leaving the order as it was) when out of memory.
+bool transform_hierarchy_sort(TransformHierarchy* h, uint32_t* remap);
+
+// Recomputes the world transforms of dirty nodes and of everything below them
+void transform_hierarchy_update(TransformHierarchy* h);
@@ -0,0 +1,494 @@
+#include "scene/volume.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool volume_init(Volume* volume, const uint8_t* voxels, const int size[3], const float box_min[3],
+    const float box_max[3], uint8_t threshold)
+{
+    memset(volume, 0, sizeof(*volume));
+    if (size[0] < 1 || size[1] < 1 || size[2] < 1)
+        return false;
+    volume->voxels = voxels;
+    volume->threshold = threshold;
+    uint32_t cells = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        volume->size[k] = size[k];
+        volume->box_min[k] = box_min[k];
+        volume->box_max[k] = box_max[k];
+        volume->bricks[k] = (size[k] + VOLUME_BRICK - 1) / VOLUME_BRICK;
+        volume->level_size[0][k] = volume->bricks[k];
+    }
+    // Halving every axis until one cell is left
+    for (volume->levels = 1; volume->levels < VOLUME_MAX_LEVELS; ++volume->levels)
+    {
+        const int* below = volume->level_size[volume->levels - 1];
+        volume->level_offset[volume->levels - 1] = cells;
+        cells += (uint32_t)below[0] * below[1] * below[2];
+        if (below[0] == 1 && below[1] == 1 && below[2] == 1)
+            break;
+        for (int k = 0; k < 3; ++k)
+            volume->level_size[volume->levels][k] = (below[k] + 1) / 2;
+    }
+    if (volume->levels == VOLUME_MAX_LEVELS)
+        return false;
+    const uint32_t bricks = volume_brick_count(volume);
+    volume->brick_max = (uint8_t*)malloc(bricks);
+    volume->occupancy = (uint8_t*)calloc(cells, 1);
+    if (!volume->brick_max || !volume->occupancy)
+    {
+        volume_destroy(volume);
+        return false;
+    }
+
+    // Every brick's largest value over what its samples read: its voxels and the apron
+    for (int bz = 0; bz < volume->bricks[2]; ++bz)
+    {
+        for (int by = 0; by < volume->bricks[1]; ++by)
+        {
+            for (int bx = 0; bx < volume->bricks[0]; ++bx)
+            {
+                const int b[3] = { bx, by, bz };
+                int lo[3], hi[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    lo[k] = b[k] * VOLUME_BRICK - VOLUME_BRICK_APRON;
+                    hi[k] = (b[k] + 1) * VOLUME_BRICK - 1 + VOLUME_BRICK_APRON;
+                    lo[k] = lo[k] < 0 ? 0 : lo[k];
+                    hi[k] = hi[k] >= size[k] ? size[k] - 1 : hi[k];
+                }
+                uint8_t m = 0;
+                for (int z = lo[2]; z <= hi[2]; ++z)
+                {
+                    for (int y = lo[1]; y <= hi[1]; ++y)
+                    {
+                        const uint8_t* row = &voxels[((size_t)z * size[1] + y) * size[0]];
+                        for (int x = lo[0]; x <= hi[0]; ++x)
+                            m = row[x] > m ? row[x] : m;
+                    }
+                }
+                const uint32_t index = volume_brick_index(volume, bx, by, bz);
+                volume->brick_max[index] = m;
+                volume->occupancy[index] = m > threshold;
+                volume->occupied += m > threshold;
+            }
+        }
+    }
+    // Each level above: a cell is occupied when any of the (up to) 8 below it is
+    for (int l = 1; l < volume->levels; ++l)
+    {
+        const int* n = volume->level_size[l];
+        const int* below = volume->level_size[l - 1];
+        for (int z = 0; z < n[2]; ++z)
+        {
+            for (int y = 0; y < n[1]; ++y)
+            {
+                for (int x = 0; x < n[0]; ++x)
+                {
+                    uint8_t any = 0;
+                    for (int c = 0; c < 8; ++c)
+                    {
+                        const int cx = 2 * x + (c & 1), cy = 2 * y + (c >> 1 & 1), cz = 2 * z + (c >> 2);
+                        if (cx < below[0] && cy < below[1] && cz < below[2])
+                            any |= volume_occupied(volume, l - 1, cx, cy, cz);
+                    }
+                    volume->occupancy[volume->level_offset[l] + ((uint32_t)z * n[1] + y) * n[0] + x] = any;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void volume_destroy(Volume* volume)
+{
+    free(volume->brick_max);
+    free(volume->occupancy);
+    volume->brick_max = NULL;
+    volume->occupancy = NULL;
+}
+
+uint32_t volume_brick_count(const Volume* volume)
+{
+    return (uint32_t)volume->bricks[0] * volume->bricks[1] * volume->bricks[2];
+}
+
+uint32_t volume_brick_index(const Volume* volume, int bx, int by, int bz)
+{
+    return ((uint32_t)bz * volume->bricks[1] + by) * volume->bricks[0] + bx;
+}
+
+bool volume_occupied(const Volume* volume, int level, int x, int y, int z)
+{
+    const int* n = volume->level_size[level];
+    return volume->occupancy[volume->level_offset[level] + ((uint32_t)z * n[1] + y) * n[0] + x] != 0;
+}
+
+void volume_brick_voxels(const Volume* volume, uint32_t brick, uint8_t* out)
+{
+    const int bx = (int)(brick % volume->bricks[0]), by = (int)(brick / volume->bricks[0] % volume->bricks[1]);
+    const int bz = (int)(brick / volume->bricks[0] / volume->bricks[1]);
+    const int* size = volume->size;
+    for (int z = 0; z < VOLUME_BRICK_STORED; ++z)
+    {
+        int vz = bz * VOLUME_BRICK - VOLUME_BRICK_APRON + z;
+        vz = vz < 0 ? 0 : vz >= size[2] ? size[2] - 1 : vz;
+        for (int y = 0; y < VOLUME_BRICK_STORED; ++y)
+        {
+            int vy = by * VOLUME_BRICK - VOLUME_BRICK_APRON + y;
+            vy = vy < 0 ? 0 : vy >= size[1] ? size[1] - 1 : vy;
+            const uint8_t* row = &volume->voxels[((size_t)vz * size[1] + vy) * size[0]];
+            for (int x = 0; x < VOLUME_BRICK_STORED; ++x)
+            {
+                int vx = bx * VOLUME_BRICK - VOLUME_BRICK_APRON + x;
+                vx = vx < 0 ? 0 : vx >= size[0] ? size[0] - 1 : vx;
+                *out++ = row[vx];
+            }
+        }
+    }
+}
+
+float volume_sample(const Volume* volume, const vec3 voxel)
+{
+    int i[3][2];
+    float f[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        const float p = voxel[k] - 0.5f, fl = floorf(p);
+        f[k] = p - fl;
+        const int n = volume->size[k];
+        i[k][0] = (int)fl < 0 ? 0 : (int)fl >= n ? n - 1 : (int)fl;
+        i[k][1] = (int)fl + 1 < 0 ? 0 : (int)fl + 1 >= n ? n - 1 : (int)fl + 1;
+    }
+    float value = 0.f;
+    for (int c = 0; c < 8; ++c)
+    {
+        const int x = c & 1, y = c >> 1 & 1, z = c >> 2;
+        const float w = (x ? f[0] : 1.f - f[0]) * (y ? f[1] : 1.f - f[1]) * (z ? f[2] : 1.f - f[2]);
+        value += w * volume->voxels[((size_t)i[2][z] * volume->size[1] + i[1][y]) * volume->size[0] + i[0][x]];
+    }
+    return value;
+}
+
+void volume_color(float a, vec3 color)
+{
+    static const float low[3] = { 0.05f, 0.1f, 0.4f }, mid[3] = { 1.f, 0.45f, 0.1f }, high[3] = { 1.f, 0.95f, 0.85f };
+    const float* from = a < 0.5f ? low : mid;
+    const float* to = a < 0.5f ? mid : high;
+    const float t = a < 0.5f ? 2.f * a : 2.f * a - 1.f;
+    for (int k = 0; k < 3; ++k)
+        color[k] = from[k] + (to[k] - from[k]) * t;
+}
+
+// Uniform out to the detail distance d, then each step d / step times its distance: t = d * exp((s - d) / d)
+float volume_march_index(const VolumeMarch* march, float t)
+{
+    const float d = march->detail_distance;
+    return (t < d ? t : d + d * logf(t / d)) / march->step;
+}
+
+float volume_march_distance(const VolumeMarch* march, float index)
+{
+    const float d = march->detail_distance, s = index * march->step;
+    return s < d ? s : d * expf((s - d) / d);
+}
+
+void volume_march(const Volume* volume, const vec3 origin, const vec3 dir, float t_max, const VolumeMarch* march,
+    vec4 rgba, VolumeMarchStats* stats)
+{
+    rgba[0] = rgba[1] = rgba[2] = rgba[3] = 0.f;
+
+    // The ray in voxels, and where it's in the box
+    vec3 o, d;
+    float t0 = 0.f, t1 = t_max, voxel_length = FLT_MAX;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float scale = volume->size[k] / (volume->box_max[k] - volume->box_min[k]);
+        voxel_length = fminf(voxel_length, 1.f / scale);
+        o[k] = (origin[k] - volume->box_min[k]) * scale;
+        d[k] = dir[k] * scale;
+        if (d[k] == 0.f)
+        {
+            if (o[k] < 0.f || o[k] > volume->size[k])
+                return;
+            continue;
+        }
+        const float a = -o[k] / d[k], b = (volume->size[k] - o[k]) / d[k];
+        t0 = fmaxf(t0, fminf(a, b));
+        t1 = fminf(t1, fmaxf(a, b));
+    }
+    if (t0 >= t1)
+        return;
+
+    const float jitter = march->jitter, range = 255.f - volume->threshold;
+    float k = ceilf(volume_march_index(march, t0) - jitter), t = volume_march_distance(march, k + jitter);
+    int level = march->skip ? volume->levels - 1 : 0;
+    float transmittance = 1.f;
+    VolumeMarchStats counts = { 0, 0, 0 };
+    while (t < t1)
+    {
+        vec3 q;
+        for (int a = 0; a < 3; ++a)
+            q[a] = o[a] + d[a] * t;
+        if (march->skip)
+        {
+            const float side = (float)(VOLUME_BRICK << level);
+            int cell[3];
+            for (int a = 0; a < 3; ++a)
+            {
+                cell[a] = (int)floorf(q[a] / side);
+                cell[a] = cell[a] < 0 ? 0 : cell[a] >= volume->level_size[level][a] ? volume->level_size[level][a] - 1
+                    : cell[a];
+            }
+            if (!volume_occupied(volume, level, cell[0], cell[1], cell[2]))
+            {
+                // On to the first sample past the cell, and a level up: the cells around are likely empty too
+                float exit = FLT_MAX;
+                for (int a = 0; a < 3; ++a)
+                {
+                    if (d[a] != 0.f)
+                        exit = fminf(exit, ((cell[a] + (d[a] > 0.f)) * side - o[a]) / d[a]);
+                }
+                const float next = ceilf(volume_march_index(march, exit) - jitter);
+                k = next > k ? next : k + 1.f;
+                t = volume_march_distance(march, k + jitter);
+                level = level + 1 < volume->levels ? level + 1 : level;
+                ++counts.skips;
+                continue;
+            }
+            if (level > 0)
+            {
+                --level;
+                ++counts.descents;
+                continue;
+            }
+        }
+        const float value = volume_sample(volume, q);
+        ++counts.samples;
+        if (value > volume->threshold)
+        {
+            const float a = fminf(1.f, (value - volume->threshold) / range);
+            const float dt = volume_march_distance(march, k + 1.f + jitter) - t;
+            const float alpha = 1.f - powf(1.f - VOLUME_OPACITY * a * a, dt / voxel_length);
+            vec3 color;
+            volume_color(a, color);
+            for (int c = 0; c < 3; ++c)
+                rgba[c] += transmittance * alpha * color[c];
+            transmittance *= 1.f - alpha;
+            if (transmittance < march->min_transmittance)
+                break;
+        }
+        k += 1.f;
+        t = volume_march_distance(march, k + jitter);
+    }
+    rgba[3] = 1.f - transmittance;
+    if (stats)
+    {
+        stats->samples += counts.samples;
+        stats->skips += counts.skips;
+        stats->descents += counts.descents;
+    }
+}
+
+bool volume_streaming_init(VolumeStreaming* streaming, const Volume* volume, uint32_t capacity)
+{
+    memset(streaming, 0, sizeof(*streaming));
+    const uint32_t bricks = volume_brick_count(volume);
+    streaming->capacity = capacity;
+    streaming->slot_of = (int32_t*)malloc(sizeof(int32_t) * bricks);
+    streaming->brick_of = (int32_t*)malloc(sizeof(int32_t) * (capacity ? capacity : 1));
+    streaming->order = (VolumeCandidate*)malloc(sizeof(VolumeCandidate) * (volume->occupied ? volume->occupied : 1));
+    streaming->wanted = (uint8_t*)calloc(bricks, 1);
+    if (!streaming->slot_of || !streaming->brick_of || !streaming->order || !streaming->wanted)
+    {
+        volume_streaming_destroy(streaming);
+        return false;
+    }
+    memset(streaming->slot_of, 0xFF, sizeof(int32_t) * bricks);
+    memset(streaming->brick_of, 0xFF, sizeof(int32_t) * (capacity ? capacity : 1));
+    return true;
+}
+
+void volume_streaming_destroy(VolumeStreaming* streaming)
+{
+    free(streaming->slot_of);
+    free(streaming->brick_of);
+    free(streaming->order);
+    free(streaming->wanted);
+    memset(streaming, 0, sizeof(*streaming));
+}
+
+static int compare_candidates(const void* a, const void* b)
+{
+    const float da = ((const VolumeCandidate*)a)->distance, db = ((const VolumeCandidate*)b)->distance;
+    return da < db ? -1 : da > db ? 1 : 0;
+}
+
+static float brick_distance(const Volume* volume, uint32_t brick, const vec3 eye)
+{
+    const uint32_t b[3] = { brick % volume->bricks[0], brick / volume->bricks[0] % volume->bricks[1],
+        brick / volume->bricks[0] / volume->bricks[1] };
+    float d2 = 0.f;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float voxel = (volume->box_max[k] - volume->box_min[k]) / volume->size[k];
+        const float centre = volume->box_min[k] + ((float)b[k] + 0.5f) * VOLUME_BRICK * voxel;
+        d2 += (centre - eye[k]) * (centre - eye[k]);
+    }
+    return sqrtf(d2);
+}
+
+uint32_t volume_streaming_plan(VolumeStreaming* streaming, const Volume* volume, const vec3 eye, uint32_t max_loads,
+    VolumeLoad* loads)
+{
+    const float brick_size = VOLUME_BRICK * (volume->box_max[0] - volume->box_min[0]) / volume->size[0];
+    const float dx = eye[0] - streaming->eye[0], dy = eye[1] - streaming->eye[1], dz = eye[2] - streaming->eye[2];
+    if (streaming->settled && dx * dx + dy * dy + dz * dz < brick_size * brick_size)
+        return 0;
+    vec3_dup(streaming->eye, eye);
+
+    // The occupied bricks by distance; the nearest "capacity" of them are wanted
+    const uint32_t bricks = volume_brick_count(volume);
+    uint32_t n = 0;
+    for (uint32_t b = 0; b < bricks; ++b)
+    {
+        if (volume->occupancy[b])
+        {
+            streaming->order[n].distance = brick_distance(volume, b, eye);
+            streaming->order[n++].brick = b;
+        }
+    }
+    qsort(streaming->order, n, sizeof(VolumeCandidate), compare_candidates);
+    const uint32_t wanted = n < streaming->capacity ? n : streaming->capacity;
+    memset(streaming->wanted, 0, bricks);
+    for (uint32_t i = 0; i < wanted; ++i)
+        streaming->wanted[streaming->order[i].brick] = 1;
+
+    // Slots free or holding bricks no longer wanted, the farthest of those first
+    uint32_t written = 0, free_slot = 0, victim = n;
+    bool settled = true;
+    for (uint32_t i = 0; i < wanted; ++i)
+    {
+        const uint32_t brick = streaming->order[i].brick;
+        if (streaming->slot_of[brick] >= 0)
+            continue;
+        if (written == max_loads)
+        {
+            settled = false;
+            break;
+        }
+        while (free_slot < streaming->capacity && streaming->brick_of[free_slot] >= 0)
+            ++free_slot;
+        uint32_t slot = free_slot;
+        int32_t evicted = -1;
+        if (free_slot == streaming->capacity)
+        {
+            // Some resident isn't wanted, since fewer than "capacity" wanted ones are resident
+            do
+                --victim;
+            while (streaming->wanted[streaming->order[victim].brick]
+                || streaming->slot_of[streaming->order[victim].brick] < 0);
+            evicted = (int32_t)streaming->order[victim].brick;
+            slot = (uint32_t)streaming->slot_of[evicted];
+            streaming->slot_of[evicted] = -1;
+            ++streaming->evictions;
+            --streaming->resident;
+        }
+        streaming->slot_of[brick] = (int32_t)slot;
+        streaming->brick_of[slot] = (int32_t)brick;
+        ++streaming->resident;
+        loads[written].brick = brick;
+        loads[written].slot = slot;
+        loads[written++].evicted = evicted;
+    }
+    streaming->loads += written;
+    streaming->settled = settled;
+    return written;
+}
+
+// Value noise over a lattice, smoothly interpolated, in [0, 1]
+static float lattice(int x, int y, int z, uint32_t seed)
+{
+    uint32_t h = (uint32_t)x * 0x8DA6B343u ^ (uint32_t)y * 0xD8163841u ^ (uint32_t)z * 0xCB1AB31Fu ^ seed * 0x9E3779B9u;
+    h ^= h >> 16; h *= 0x7FEB352Du; h ^= h >> 15; h *= 0x846CA68Bu; h ^= h >> 16;
+    return (float)(h >> 8) * (1.f / 16777216.f);
+}
+
+static float value_noise(float x, float y, float z, uint32_t seed)
+{
+    const float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+    const int ix = (int)fx, iy = (int)fy, iz = (int)fz;
+    float u[3] = { x - fx, y - fy, z - fz };
+    for (int k = 0; k < 3; ++k)
+        u[k] = u[k] * u[k] * (3.f - 2.f * u[k]);
+    float value = 0.f;
+    for (int c = 0; c < 8; ++c)
+    {
+        const int cx = c & 1, cy = c >> 1 & 1, cz = c >> 2;
+        const float w = (cx ? u[0] : 1.f - u[0]) * (cy ? u[1] : 1.f - u[1]) * (cz ? u[2] : 1.f - u[2]);
+        value += w * lattice(ix + cx, iy + cy, iz + cz, seed);
+    }
+    return value;
+}
+
+static float turbulence(float x, float y, float z, uint32_t seed)
+{
+    float sum = 0.f, amplitude = 0.5f, frequency = 6.f;
+    for (int octave = 0; octave < 4; ++octave, amplitude *= 0.5f, frequency *= 2.f)
+        sum += amplitude * value_noise(x * frequency, y * frequency, z * frequency, seed + (uint32_t)octave);
+    return sum / 0.9375f;
+}
+
+#define VOLUME_BLOBS 5
+#define VOLUME_RING_RADIUS 0.3f     // of the box, around its middle in the xy plane
+#define VOLUME_RING_WIDTH 0.07f
+
+void volume_generate(uint8_t* voxels, int side, uint32_t seed)
+{
+    float blobs[VOLUME_BLOBS][4];   // centre and radius, in [0, 1] of the box
+    uint32_t state = seed * 747796405u + 2891336453u;
+    for (int i = 0; i < VOLUME_BLOBS; ++i)
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            state = state * 1664525u + 1013904223u;
+            const float r = (float)(state >> 8) / 16777216.f;
+            blobs[i][k] = k < 3 ? 0.2f + 0.6f * r : 0.08f + 0.1f * r;
+        }
+    }
+    const float reach = VOLUME_RING_WIDTH * 1.5f;
+    for (int z = 0; z < side; ++z)
+    {
+        const float pz = ((float)z + 0.5f) / side;
+        for (int y = 0; y < side; ++y)
+        {
+            const float py = ((float)y + 0.5f) / side;
+            for (int x = 0; x < side; ++x)
+            {
+                const float px = ((float)x + 0.5f) / side;
+                // Cheap shapes first; the noise only where one of them reaches
+                float shape = 0.f;
+                for (int i = 0; i < VOLUME_BLOBS; ++i)
+                {
+                    const float dx = px - blobs[i][0], dy = py - blobs[i][1], dz = pz - blobs[i][2];
+                    shape = fmaxf(shape, 1.f - sqrtf(dx * dx + dy * dy + dz * dz) / blobs[i][3]);
+                }
+                const float ring = hypotf(hypotf(px - 0.5f, py - 0.5f) - VOLUME_RING_RADIUS, pz - 0.5f);
+                if (shape <= 0.f && ring >= reach)
+                {
+                    voxels[((size_t)z * side + y) * side + x] = 0;
+                    continue;
+                }
+                const float n = turbulence(px, py, pz, seed);
+                float density = shape > 0.f ? shape * (0.4f + 1.2f * n) : 0.f;
+                if (ring < reach)
+                    density = fmaxf(density, (1.f - ring / reach) * (2.f * n - 0.6f));
+                density = fminf(1.f, fmaxf(0.f, density));
+                voxels[((size_t)z * side + y) * side + x] = (uint8_t)(density * 255.f + 0.5f);
+            }
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "linmath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 3D scalar fields drawn by ray marching: the bricks they're streamed in, the
+// occupancy pyramid that lets rays skip what's empty, and a reference march
+// that gl/volume_renderer.h's compute shader does the same as.
+//
+// The field is "size" voxels along x, y and z, one byte each (x fastest),
+// filling a world box, voxel centres half a voxel in from its faces. It is
+// cut into bricks of VOLUME_BRICK voxels a side; a brick goes to the GPU with
+// an apron of VOLUME_BRICK_APRON voxels of its neighbours', clamped at the
+// field's edges, so trilinear samples anywhere in it read nothing else.
+//
+// The transfer function is transparent at and below "threshold": a voxel
+// value v maps to a = (v - threshold) / (255 - threshold), clamped, with
+// opacity VOLUME_OPACITY * a * a per voxel's length of ray, and colour
+// volume_color(a). A brick is occupied when the largest value its samples
+// can read (apron included) is above the threshold, which is exact for
+// skipping: a trilinear sample is never above its eight voxels. Level 0 of
+// the occupancy pyramid is the bricks; each level above ORs 2x2x2 cells of
+// the one below, up to a single cell.
+//
+// A ray's samples lie at fixed places along it: uniform steps of "step"
+// world units out to "detail_distance" from its start, then growing in
+// proportion to the distance, where a voxel spans less than a pixel anyway;
+// the opacity is corrected for the step's length. Skipping a cell moves to
+// the first of those samples past it, so a march that skips empty space
+// takes the very samples a dense one would have found something at, and
+// gets the same colour. It stops once the transmittance is below
+// "min_transmittance".
+//
+// Streaming keeps the occupied bricks nearest the eye resident in a fixed
+// number of slots (the GPU's brick atlas), a few loads a frame; the
+// farthest residents make room when the nearer ones don't fit. Empty bricks
+// never go to the GPU.
+//
+// Nothing here calls GL.
+
+#define VOLUME_BRICK 16                 // voxels a brick's side
+#define VOLUME_BRICK_APRON 1            // voxels of the neighbours' each side of a brick
+#define VOLUME_BRICK_STORED (VOLUME_BRICK + 2 * VOLUME_BRICK_APRON)     // and its side with them
+#define VOLUME_MAX_LEVELS 12
+#define VOLUME_OPACITY 0.2f             // opacity per voxel's length at the transfer function's top
+
+typedef struct Volume
+{
+    const uint8_t* voxels;      // [size[0] * size[1] * size[2]], x fastest; the caller's
+    int size[3];
+    float box_min[3], box_max[3];   // the world box the voxels fill
+    uint8_t threshold;          // values at or below it are transparent
+    int bricks[3];              // along x, y and z, the last ones partly outside the field
+    int levels;                 // of the occupancy pyramid: level 0 the bricks, the last a single cell
+    int level_size[VOLUME_MAX_LEVELS][3];
+    uint32_t level_offset[VOLUME_MAX_LEVELS];   // of each level's cells in "occupancy", x fastest
+    uint8_t* occupancy;         // 1 for occupied cells, 0 for empty, every level
+    uint8_t* brick_max;         // [brick count]: the largest value each brick's samples read
+    uint32_t occupied;          // bricks
+} Volume;
+
+// Builds the bricks' maxima and the occupancy pyramid over "voxels" (kept, not copied). Returns false when out of
+// memory or the field is empty.
+bool volume_init(Volume* volume, const uint8_t* voxels, const int size[3], const float box_min[3],
+    const float box_max[3], uint8_t threshold);
+void volume_destroy(Volume* volume);
+
+uint32_t volume_brick_count(const Volume* volume);
+// The brick's index from its coordinates, x fastest
+uint32_t volume_brick_index(const Volume* volume, int bx, int by, int bz);
+bool volume_occupied(const Volume* volume, int level, int x, int y, int z);
+
+// Brick "brick"'s voxels with its apron, VOLUME_BRICK_STORED a side, x fastest, into "out"
+void volume_brick_voxels(const Volume* volume, uint32_t brick, uint8_t* out);
+
+// The field at "voxel" (in voxels from the box's min corner, so a voxel's centre is at i + 0.5), trilinear between
+// voxel centres and clamped at the edges, 0 to 255
+float volume_sample(const Volume* volume, const vec3 voxel);
+
+// The transfer function's colour for "a" in [0, 1]: deep blue through orange to near white
+void volume_color(float a, vec3 color);
+
+typedef struct VolumeMarch
+{
+    float step;                 // world units between samples near the ray's start
+    float detail_distance;      // past it the steps grow with the distance; FLT_MAX for uniform steps
+    float jitter;               // [0, 1): where in their steps the samples lie
+    float min_transmittance;    // the march stops below it; 0 to go through
+    bool skip;                  // skip empty space by the occupancy pyramid; false marches every step
+} VolumeMarch;
+
+typedef struct VolumeMarchStats
+{
+    uint32_t samples;           // of the field
+    uint32_t skips;             // empty cells stepped over
+    uint32_t descents;          // occupied cells looked inside
+} VolumeMarchStats;
+
+// Ray parameter to sample index and back, as the march spaces its samples
+float volume_march_index(const VolumeMarch* march, float t);
+float volume_march_distance(const VolumeMarch* march, float index);
+
+// Marches the ray from "origin" along "dir" (unit, world space) out to "t_max" and returns its premultiplied colour
+// and opacity in "rgba"; adds to "stats" unless NULL
+void volume_march(const Volume* volume, const vec3 origin, const vec3 dir, float t_max, const VolumeMarch* march,
+    vec4 rgba, VolumeMarchStats* stats);
+
+typedef struct VolumeCandidate
+{
+    float distance;             // of the brick's centre from the eye
+    uint32_t brick;
+} VolumeCandidate;
+
+typedef struct VolumeStreaming
+{
+    uint32_t capacity;          // slots
+    int32_t* slot_of;           // [brick count]: its slot, -1 when not resident
+    int32_t* brick_of;          // [capacity]: its brick, -1 when free
+    VolumeCandidate* order;     // [occupied]: the occupied bricks, nearest the eye first as of the last plan
+    uint8_t* wanted;            // [brick count]: among the "capacity" nearest, as of the last plan
+    vec3 eye;                   // of the last plan
+    bool settled;               // every wanted brick was resident after it
+    uint32_t resident;
+    unsigned long long loads, evictions;
+} VolumeStreaming;
+
+typedef struct VolumeLoad
+{
+    uint32_t brick;
+    uint32_t slot;
+    int32_t evicted;            // the brick the slot held, -1 for a free one
+} VolumeLoad;
+
+bool volume_streaming_init(VolumeStreaming* streaming, const Volume* volume, uint32_t capacity);
+void volume_streaming_destroy(VolumeStreaming* streaming);
+
+// Up to "max_loads" bricks to upload for "eye" (world space), nearest first, each given its slot, into "loads".
+// The residents farthest from the eye make room. Nothing is planned while every brick wanted is resident and the
+// eye has moved less than a brick since. Returns the loads written; the caller uploads them before the next
+// frame's march reads their slots.
+uint32_t volume_streaming_plan(VolumeStreaming* streaming, const Volume* volume, const vec3 eye, uint32_t max_loads,
+    VolumeLoad* loads);
+
+// A made-up field "side" voxels a cube, for when there's no file: a few turbulent blobs and a ring of smoke,
+// seeded by "seed", most of the box empty around them
+void volume_generate(uint8_t* voxels, int side, uint32_t seed);
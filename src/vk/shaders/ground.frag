@@ -0,0 +1,42 @@
+#version 460
+// The GL shadow ground pass (gl/shadow_maps.cpp) with a ray query in place of the cascades: the pixel's view ray,
+// from the near plane to the far one, cut by the plane z = ground.x, and black over it where a ray from there
+// towards the sun hits an object (SRC_ALPHA, ONE_MINUS_SRC_ALPHA). Rays that miss the plane, and lit points, are
+// discarded.
+
+#extension GL_EXT_ray_query : require
+
+layout(set = 0, binding = 0) uniform accelerationStructureEXT scene;
+
+layout(push_constant) uniform Ground
+{
+    mat4 inverseViewProjection;
+    vec4 sun;               // xyz: towards the sun; w: the light a shadowed pixel loses
+    vec4 ground;            // the plane's z, the viewport's width and height
+};
+
+layout(location = 0) out vec4 fragment;
+
+void main()
+{
+    // gl_FragCoord runs down from the top, and the camera is reversed-Z: near at 1, far at 0
+    vec2 ndc = vec2(gl_FragCoord.x / ground.y * 2.0 - 1.0, 1.0 - gl_FragCoord.y / ground.z * 2.0);
+    vec4 n = inverseViewProjection * vec4(ndc, 1.0, 1.0);
+    vec4 f = inverseViewProjection * vec4(ndc, 0.0, 1.0);
+    vec3 a = n.xyz / n.w, b = f.xyz / f.w;
+    if (abs(b.z - a.z) < 1e-7)
+        discard;
+    float t = (ground.x - a.z) / (b.z - a.z);
+    if (t < 0.0 || t > 1.0)
+        discard;
+
+    rayQueryEXT query;
+    rayQueryInitializeEXT(query, scene, gl_RayFlagsOpaqueEXT | gl_RayFlagsTerminateOnFirstHitEXT, 0xFFu, mix(a, b, t),
+        1e-4, sun.xyz, 1e30);
+    while (rayQueryProceedEXT(query))
+    {
+    }
+    if (rayQueryGetIntersectionTypeEXT(query, true) == gl_RayQueryCommittedIntersectionNoneEXT)
+        discard;
+    fragment = vec4(0.0, 0.0, 0.0, sun.w);
+}
@@ -0,0 +1,20 @@
+#version 450
+// The GL scene shader's instanced path (main.cpp), for the Vulkan backend: the same vertex and instance locations,
+// the view-projection as a push constant instead of the Camera block
+
+layout(push_constant) uniform Camera
+{
+    mat4 viewProjection;
+};
+
+layout(location = 0) in vec2 vPos;
+layout(location = 1) in vec3 vCol;
+layout(location = 2) in mat3x4 vModel;     // per-instance affine model matrix rows (locations 2-4)
+
+layout(location = 0) out vec3 color;
+
+void main()
+{
+    gl_Position = viewProjection * vec4(vec4(vPos, 0.0, 1.0) * vModel, 1.0);
+    color = vCol;
+}
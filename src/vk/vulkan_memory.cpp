@@ -0,0 +1,165 @@
+#include "vk/vulkan_memory.h"
+
+#include <string.h>
+
+void vulkan_arena_init(VulkanArena* arena, VkPhysicalDevice physical_device, VkDevice device)
+{
+    memset(arena, 0, sizeof(*arena));
+    arena->device = device;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &arena->properties);
+}
+
+void vulkan_arena_destroy(VulkanArena* arena)
+{
+    for (int b = 0; b < arena->block_count; ++b)
+    {
+        VulkanBlock* block = &arena->blocks[b];
+        if (block->mapped)
+            vkUnmapMemory(arena->device, block->memory);
+        vkFreeMemory(arena->device, block->memory, NULL);
+        buffer_heap_destroy(&block->heap);
+    }
+    arena->block_count = 0;
+    arena->allocated = arena->used = 0;
+}
+
+// The first type "type_bits" allows with all of "flags"
+static int find_type(const VulkanArena* arena, uint32_t type_bits, VkMemoryPropertyFlags flags)
+{
+    for (uint32_t t = 0; t < arena->properties.memoryTypeCount; ++t)
+        if ((type_bits & (1u << t)) && (arena->properties.memoryTypes[t].propertyFlags & flags) == flags)
+            return (int)t;
+    return -1;
+}
+
+static int open_block(VulkanArena* arena, uint32_t type, VkDeviceSize size)
+{
+    if (arena->block_count == VULKAN_ARENA_MAX_BLOCKS)
+    {
+        fprintf(stderr, "vulkan: all %d memory blocks are in use\n", VULKAN_ARENA_MAX_BLOCKS);
+        return -1;
+    }
+    VulkanBlock* block = &arena->blocks[arena->block_count];
+    memset(block, 0, sizeof(*block));
+    VkMemoryAllocateInfo info = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+    info.allocationSize = size;
+    info.memoryTypeIndex = type;
+    VkMemoryAllocateFlagsInfo flags = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO };
+    flags.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+    if (arena->device_address)
+        info.pNext = &flags;
+    if (vkAllocateMemory(arena->device, &info, NULL, &block->memory) != VK_SUCCESS)
+    {
+        fprintf(stderr, "vulkan: out of memory for a %.1f MB block of type %u\n", size / 1048576.0, type);
+        return -1;
+    }
+    if ((arena->properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        && vkMapMemory(arena->device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+        block->mapped = NULL;
+    if (!buffer_heap_init(&block->heap, (uint32_t)(size / VULKAN_ARENA_UNIT), VULKAN_ARENA_BLOCK_ALLOCATIONS))
+    {
+        vkFreeMemory(arena->device, block->memory, NULL);
+        return -1;
+    }
+    block->type = type;
+    block->size = size;
+    arena->allocated += size;
+    return arena->block_count++;
+}
+
+bool vulkan_arena_alloc(VulkanArena* arena, const VkMemoryRequirements* requirements, VkMemoryPropertyFlags flags,
+    VulkanAllocation* allocation)
+{
+    allocation->block = -1;
+    const int type = find_type(arena, requirements->memoryTypeBits, flags);
+    if (type < 0)
+    {
+        fprintf(stderr, "vulkan: no memory type with flags 0x%x\n", (unsigned)flags);
+        return false;
+    }
+
+    // Pieces start on a unit; a stricter alignment is found inside a piece that much larger
+    const VkDeviceSize alignment = requirements->alignment > VULKAN_ARENA_UNIT ? requirements->alignment : VULKAN_ARENA_UNIT;
+    const VkDeviceSize bytes = requirements->size + alignment - VULKAN_ARENA_UNIT;
+    const uint32_t units = (uint32_t)((bytes + VULKAN_ARENA_UNIT - 1) / VULKAN_ARENA_UNIT);
+    uint32_t range = BUFFER_HEAP_NONE, first = 0;
+    int b = 0;
+    for (; b < arena->block_count && range == BUFFER_HEAP_NONE; ++b)
+        if (arena->blocks[b].type == (uint32_t)type)
+            range = buffer_heap_alloc(&arena->blocks[b].heap, units, &first);
+    if (range == BUFFER_HEAP_NONE)
+    {
+        const VkDeviceSize block_bytes = (VkDeviceSize)units * VULKAN_ARENA_UNIT;
+        b = open_block(arena, (uint32_t)type, block_bytes > VULKAN_ARENA_BLOCK_SIZE ? block_bytes : VULKAN_ARENA_BLOCK_SIZE);
+        if (b < 0 || (range = buffer_heap_alloc(&arena->blocks[b].heap, units, &first)) == BUFFER_HEAP_NONE)
+            return false;
+        ++b;
+    }
+
+    VulkanBlock* block = &arena->blocks[b - 1];
+    allocation->block = b - 1;
+    allocation->range = range;
+    allocation->memory = block->memory;
+    allocation->offset = ((VkDeviceSize)first * VULKAN_ARENA_UNIT + alignment - 1) / alignment * alignment;
+    allocation->size = requirements->size;
+    allocation->mapped = block->mapped ? (char*)block->mapped + allocation->offset : NULL;
+    arena->used += (VkDeviceSize)units * VULKAN_ARENA_UNIT;
+    return true;
+}
+
+void vulkan_arena_free(VulkanArena* arena, VulkanAllocation* allocation)
+{
+    if (allocation->block < 0)
+        return;
+    BufferHeap* heap = &arena->blocks[allocation->block].heap;
+    arena->used -= (VkDeviceSize)buffer_heap_size(heap, allocation->range) * VULKAN_ARENA_UNIT;
+    buffer_heap_free(heap, allocation->range);
+    allocation->block = -1;
+    allocation->mapped = NULL;
+}
+
+bool vulkan_arena_create_buffer(VulkanArena* arena, VkDeviceSize size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags flags, VkBuffer* buffer, VulkanAllocation* allocation)
+{
+    allocation->block = -1;
+    VkBufferCreateInfo info = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    info.size = size;
+    info.usage = usage;
+    info.sharingMode = arena->queue_family_count > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+    info.queueFamilyIndexCount = arena->queue_family_count > 1 ? arena->queue_family_count : 0;
+    info.pQueueFamilyIndices = arena->queue_family_count > 1 ? arena->queue_families : NULL;
+    if (vkCreateBuffer(arena->device, &info, NULL, buffer) != VK_SUCCESS)
+        return false;
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(arena->device, *buffer, &requirements);
+    if (!vulkan_arena_alloc(arena, &requirements, flags, allocation)
+        || vkBindBufferMemory(arena->device, *buffer, allocation->memory, allocation->offset) != VK_SUCCESS)
+    {
+        vulkan_arena_free(arena, allocation);
+        vkDestroyBuffer(arena->device, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+void vulkan_arena_destroy_buffer(VulkanArena* arena, VkBuffer* buffer, VulkanAllocation* allocation)
+{
+    if (*buffer != VK_NULL_HANDLE)
+        vkDestroyBuffer(arena->device, *buffer, NULL);
+    *buffer = VK_NULL_HANDLE;
+    vulkan_arena_free(arena, allocation);
+}
+
+void vulkan_arena_print(const VulkanArena* arena, FILE* out)
+{
+    fprintf(out, "vulkan memory: %d blocks, %.1f MB allocated, %.1f MB in use\n", arena->block_count,
+        arena->allocated / 1048576.0, arena->used / 1048576.0);
+    for (int b = 0; b < arena->block_count; ++b)
+    {
+        const VulkanBlock* block = &arena->blocks[b];
+        char name[64];
+        snprintf(name, sizeof(name), "  block %d (type %u%s)", b, block->type, block->mapped ? ", mapped" : "");
+        buffer_heap_print(&block->heap, name, out);
+    }
+}
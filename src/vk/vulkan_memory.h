@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "core/buffer_heap.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Device memory for the Vulkan backend, allocated in a few large blocks and
+// handed out in pieces, since a device only allows so many vkAllocateMemory
+// calls (maxMemoryAllocationCount, 4096 on many drivers) and each is slow.
+//
+// A block is VULKAN_ARENA_BLOCK_SIZE bytes of one memory type, carved up by
+// a BufferHeap (core/buffer_heap.h) in VULKAN_ARENA_UNIT-byte units, so every
+// piece starts on a unit boundary; larger alignments are met by asking for
+// the excess and rounding the offset up. A request that finds no room in the
+// type's blocks opens another one, and one larger than a block gets a block
+// of its own. Host-visible blocks are mapped once when they're made and stay
+// mapped, so a piece's "mapped" pointer is ready to write.
+//
+// Only buffers come from here (no images), so bufferImageGranularity never
+// applies. With "device_address" set before the first allocation, every
+// block is allocated for buffers with device addresses (ray queries need
+// them). With two queue families set in "queue_families" (the async compute
+// queue's family apart from the graphics one), buffers are shared between
+// them concurrently instead of handed over. Not thread-safe.
+
+#define VULKAN_ARENA_MAX_BLOCKS 32
+#define VULKAN_ARENA_BLOCK_SIZE (64ull << 20)
+#define VULKAN_ARENA_UNIT 256ull                // bytes per heap unit: covers the usual buffer alignments
+#define VULKAN_ARENA_BLOCK_ALLOCATIONS 4096     // pieces a block's heap can hold
+
+typedef struct VulkanBlock
+{
+    VkDeviceMemory memory;
+    uint32_t type;
+    VkDeviceSize size;
+    void* mapped;               // the whole block, for a host-visible type; NULL otherwise
+    BufferHeap heap;
+} VulkanBlock;
+
+typedef struct VulkanArena
+{
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties properties;
+    VulkanBlock blocks[VULKAN_ARENA_MAX_BLOCKS];
+    int block_count;
+    bool device_address;        // blocks allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT
+    uint32_t queue_families[2]; // the families buffers are used on
+    uint32_t queue_family_count; // 2: VK_SHARING_MODE_CONCURRENT between them; exclusive otherwise
+    VkDeviceSize allocated;     // bytes of device memory in the blocks
+    VkDeviceSize used;          // bytes in live pieces, their alignment padding included
+} VulkanArena;
+
+typedef struct VulkanAllocation
+{
+    int block;                  // -1 when nothing is allocated
+    uint32_t range;             // the block heap's handle
+    VkDeviceMemory memory;
+    VkDeviceSize offset;        // in "memory", aligned as required
+    VkDeviceSize size;
+    void* mapped;               // at "offset", for host-visible memory; NULL otherwise
+} VulkanAllocation;
+
+void vulkan_arena_init(VulkanArena* arena, VkPhysicalDevice physical_device, VkDevice device);
+// Frees every block; the device must be idle
+void vulkan_arena_destroy(VulkanArena* arena);
+
+// A piece meeting "requirements" of a type with all of "flags". False when no type has them or the device is out
+// of memory.
+bool vulkan_arena_alloc(VulkanArena* arena, const VkMemoryRequirements* requirements, VkMemoryPropertyFlags flags,
+    VulkanAllocation* allocation);
+void vulkan_arena_free(VulkanArena* arena, VulkanAllocation* allocation);
+
+// vkCreateBuffer of "size" bytes for "usage", bound to a piece with "flags"
+bool vulkan_arena_create_buffer(VulkanArena* arena, VkDeviceSize size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags flags, VkBuffer* buffer, VulkanAllocation* allocation);
+void vulkan_arena_destroy_buffer(VulkanArena* arena, VkBuffer* buffer, VulkanAllocation* allocation);
+
+// Blocks, their types and use
+void vulkan_arena_print(const VulkanArena* arena, FILE* out);
@@ -0,0 +1,584 @@
+#include "vk/vulkan_ray_query.h"
+
+#include "core/spirv_reflect.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// SPIR-V words from glslc -mfmt=num, built from src/vk/shaders/
+static const uint32_t tlas_instances_comp_spv[] =
+{
+#include "tlas_instances.comp.inc"
+};
+static const uint32_t ray_pick_comp_spv[] =
+{
+#include "ray_pick.comp.inc"
+};
+
+#define VK_CHECK(call, what) \
+    do { VkResult result_ = (call); if (result_ != VK_SUCCESS) { \
+        fprintf(stderr, "vulkan: %s failed (%d)\n", what, (int)result_); return false; } } while (0)
+
+const char* const vulkan_ray_query_extensions[VULKAN_RAY_QUERY_EXTENSION_COUNT] = {
+    VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
+    VK_KHR_RAY_QUERY_EXTENSION_NAME,
+    VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,     // acceleration structures require it, though nothing defers
+};
+
+// The instance shader's push constants: buffer references, then the BLAS's address as a uvec2
+typedef struct InstancePush
+{
+    VkDeviceAddress models;
+    VkDeviceAddress objects;
+    VkDeviceAddress instances;
+    VkDeviceAddress blas;
+    uint32_t count;
+    uint32_t pad;
+} InstancePush;
+
+// The pick shader's: the ray (direction.w is t_max) and where the result goes
+typedef struct PickPush
+{
+    vec4 origin;
+    vec4 direction;
+    VkDeviceAddress result;
+} PickPush;
+
+void* vulkan_ray_query_features(VulkanRayQueryFeatures* features)
+{
+    memset(features, 0, sizeof(*features));
+    features->vulkan12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features->vulkan12.pNext = &features->acceleration;
+    features->acceleration.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+    features->acceleration.pNext = &features->ray_query;
+    features->ray_query.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
+    return &features->vulkan12;
+}
+
+bool vulkan_ray_query_supported(VkPhysicalDevice physical_device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2)
+        return false;
+
+    uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(physical_device, NULL, &extension_count, NULL);
+    VkExtensionProperties* extensions = (VkExtensionProperties*)malloc(sizeof(VkExtensionProperties)
+        * (extension_count ? extension_count : 1));
+    vkEnumerateDeviceExtensionProperties(physical_device, NULL, &extension_count, extensions);
+    int found = 0;
+    for (int n = 0; n < VULKAN_RAY_QUERY_EXTENSION_COUNT; ++n)
+        for (uint32_t e = 0; e < extension_count; ++e)
+            if (!strcmp(extensions[e].extensionName, vulkan_ray_query_extensions[n]))
+            {
+                ++found;
+                break;
+            }
+    free(extensions);
+    if (found < VULKAN_RAY_QUERY_EXTENSION_COUNT)
+        return false;
+
+    VulkanRayQueryFeatures features;
+    VkPhysicalDeviceFeatures2 query = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+    query.pNext = vulkan_ray_query_features(&features);
+    vkGetPhysicalDeviceFeatures2(physical_device, &query);
+    return features.vulkan12.bufferDeviceAddress && features.acceleration.accelerationStructure
+        && features.ray_query.rayQuery;
+}
+
+VkDeviceAddress vulkan_buffer_address(VkDevice device, VkBuffer buffer)
+{
+    VkBufferDeviceAddressInfo info = { VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
+    info.buffer = buffer;
+    return vkGetBufferDeviceAddress(device, &info);
+}
+
+// A structure of "size" bytes in a buffer of its own
+static bool create_structure(VulkanRayQuery* rq, VkAccelerationStructureTypeKHR type, VkDeviceSize size,
+    VulkanAccelerationStructure* as)
+{
+    if (!vulkan_arena_create_buffer(rq->arena, size, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR
+        | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &as->buffer, &as->memory))
+    {
+        fprintf(stderr, "vulkan: no memory for a %.1f KB acceleration structure\n", size / 1024.0);
+        return false;
+    }
+    VkAccelerationStructureCreateInfoKHR info = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR };
+    info.buffer = as->buffer;
+    info.size = size;
+    info.type = type;
+    VK_CHECK(rq->create(rq->device, &info, NULL, &as->handle), "vkCreateAccelerationStructureKHR");
+    VkAccelerationStructureDeviceAddressInfoKHR address = {
+        VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR };
+    address.accelerationStructure = as->handle;
+    as->address = rq->structure_address(rq->device, &address);
+    as->size = size;
+    return true;
+}
+
+static void destroy_structure(VulkanRayQuery* rq, VulkanAccelerationStructure* as)
+{
+    if (as->handle != VK_NULL_HANDLE)
+        rq->destroy(rq->device, as->handle, NULL);
+    as->handle = VK_NULL_HANDLE;
+    vulkan_arena_destroy_buffer(rq->arena, &as->buffer, &as->memory);
+}
+
+// Scratch of at least "size" bytes, its address rounded up to the builds' alignment
+static bool create_scratch(VulkanRayQuery* rq, VkDeviceSize size)
+{
+    if (!vulkan_arena_create_buffer(rq->arena, size + rq->scratch_alignment, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+        | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &rq->scratch, &rq->scratch_memory))
+    {
+        fprintf(stderr, "vulkan: no memory for %.1f KB of build scratch\n", size / 1024.0);
+        return false;
+    }
+    const VkDeviceAddress address = vulkan_buffer_address(rq->device, rq->scratch);
+    rq->scratch_address = (address + rq->scratch_alignment - 1) / rq->scratch_alignment * rq->scratch_alignment;
+    return true;
+}
+
+// Records with "record" into a one-off command buffer, submits it and waits
+static bool submit_once(VulkanRayQuery* rq, VkQueue queue, VkCommandPool pool,
+    void (*record)(VulkanRayQuery* rq, VkCommandBuffer cmd, void* data), void* data)
+{
+    VkCommandBufferAllocateInfo allocate = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    allocate.commandPool = pool;
+    allocate.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate.commandBufferCount = 1;
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    VK_CHECK(vkAllocateCommandBuffers(rq->device, &allocate, &cmd), "vkAllocateCommandBuffers");
+    VkCommandBufferBeginInfo begin = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &begin);
+    record(rq, cmd, data);
+    vkEndCommandBuffer(cmd);
+    VkSubmitInfo submit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &cmd;
+    const bool ok = vkQueueSubmit(queue, 1, &submit, VK_NULL_HANDLE) == VK_SUCCESS && vkQueueWaitIdle(queue) == VK_SUCCESS;
+    vkFreeCommandBuffers(rq->device, pool, 1, &cmd);
+    if (!ok)
+        fprintf(stderr, "vulkan: an acceleration structure build failed\n");
+    return ok;
+}
+
+typedef struct BlasBuild
+{
+    const VkAccelerationStructureBuildGeometryInfoKHR* info;
+    const VkAccelerationStructureBuildRangeInfoKHR* range;
+    VkQueryPool query;
+    VulkanAccelerationStructure* compacted;     // the copy's destination, for the second submission
+} BlasBuild;
+
+// The build, then its compacted size into the query once it's written
+static void record_blas_build(VulkanRayQuery* rq, VkCommandBuffer cmd, void* data)
+{
+    const BlasBuild* b = (const BlasBuild*)data;
+    vkCmdResetQueryPool(cmd, b->query, 0, 1);
+    rq->cmd_build(cmd, 1, b->info, &b->range);
+    VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+        VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &barrier, 0, NULL, 0, NULL);
+    rq->cmd_write_properties(cmd, 1, &rq->blas.handle, VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+        b->query, 0);
+}
+
+static void record_blas_compaction(VulkanRayQuery* rq, VkCommandBuffer cmd, void* data)
+{
+    const BlasBuild* b = (const BlasBuild*)data;
+    VkCopyAccelerationStructureInfoKHR copy = { VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR };
+    copy.src = rq->blas.handle;
+    copy.dst = b->compacted->handle;
+    copy.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+    rq->cmd_copy(cmd, &copy);
+}
+
+// The mesh's bottom level: built for fast tracing, then copied into one its compacted size
+static bool build_blas(VulkanRayQuery* rq, VkQueue queue, VkCommandPool pool, VkBuffer vertices, size_t vertex_size,
+    size_t vertex_count, VkBuffer indices, size_t index_count)
+{
+    VkAccelerationStructureGeometryKHR geometry = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR };
+    geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+    geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+    VkAccelerationStructureGeometryTrianglesDataKHR* triangles = &geometry.geometry.triangles;
+    triangles->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+    triangles->vertexFormat = VK_FORMAT_R32G32_SFLOAT;     // z is 0, as the flat scene's is
+    triangles->vertexData.deviceAddress = vulkan_buffer_address(rq->device, vertices);
+    triangles->vertexStride = vertex_size;
+    triangles->maxVertex = (uint32_t)(vertex_count - 1);
+    triangles->indexType = VK_INDEX_TYPE_UINT32;
+    triangles->indexData.deviceAddress = vulkan_buffer_address(rq->device, indices);
+
+    VkAccelerationStructureBuildGeometryInfoKHR info = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
+    info.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+    info.flags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR
+        | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    info.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    info.geometryCount = 1;
+    info.pGeometries = &geometry;
+    const uint32_t triangle_count = (uint32_t)(index_count / 3);
+    VkAccelerationStructureBuildSizesInfoKHR sizes = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR };
+    rq->build_sizes(rq->device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &info, &triangle_count, &sizes);
+
+    VkBuffer scratch = VK_NULL_HANDLE;
+    VulkanAllocation scratch_memory;
+    if (!create_structure(rq, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, sizes.accelerationStructureSize, &rq->blas)
+        || !vulkan_arena_create_buffer(rq->arena, sizes.buildScratchSize + rq->scratch_alignment,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &scratch, &scratch_memory))
+        return false;
+    const VkDeviceAddress scratch_address = vulkan_buffer_address(rq->device, scratch);
+    info.dstAccelerationStructure = rq->blas.handle;
+    info.scratchData.deviceAddress = (scratch_address + rq->scratch_alignment - 1) / rq->scratch_alignment
+        * rq->scratch_alignment;
+    rq->blas_built_size = sizes.accelerationStructureSize;
+
+    VkQueryPoolCreateInfo query = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+    query.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+    query.queryCount = 1;
+    VkQueryPool pool_query = VK_NULL_HANDLE;
+    if (vkCreateQueryPool(rq->device, &query, NULL, &pool_query) != VK_SUCCESS)
+    {
+        vulkan_arena_destroy_buffer(rq->arena, &scratch, &scratch_memory);
+        fprintf(stderr, "vulkan: vkCreateQueryPool failed\n");
+        return false;
+    }
+    const VkAccelerationStructureBuildRangeInfoKHR range = { triangle_count, 0, 0, 0 };
+    VulkanAccelerationStructure compacted;
+    memset(&compacted, 0, sizeof(compacted));
+    compacted.memory.block = -1;
+    BlasBuild build = { &info, &range, pool_query, &compacted };
+    VkDeviceSize compacted_size = 0;
+    bool ok = submit_once(rq, queue, pool, record_blas_build, &build)
+        && vkGetQueryPoolResults(rq->device, pool_query, 0, 1, sizeof(compacted_size), &compacted_size,
+            sizeof(compacted_size), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS;
+    vkDestroyQueryPool(rq->device, pool_query, NULL);
+    vulkan_arena_destroy_buffer(rq->arena, &scratch, &scratch_memory);
+
+    // Kept as built if compaction saves nothing or can't be had
+    if (ok && compacted_size && compacted_size < rq->blas.size
+        && create_structure(rq, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, compacted_size, &compacted)
+        && submit_once(rq, queue, pool, record_blas_compaction, &build))
+    {
+        destroy_structure(rq, &rq->blas);
+        rq->blas = compacted;
+    }
+    else
+        destroy_structure(rq, &compacted);
+    return ok;
+}
+
+static VkShaderModule create_shader(VkDevice device, const uint32_t* code, size_t size)
+{
+    VkShaderModuleCreateInfo info = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+    info.codeSize = size;
+    info.pCode = code;
+    VkShaderModule module = VK_NULL_HANDLE;
+    vkCreateShaderModule(device, &info, NULL, &module);
+    return module;
+}
+
+// A compute pipeline laid out as its SPIR-V declares: its push constants, whose block padded to 8 bytes must be the
+// "push_size" bytes the recording pushes, and the structure's set if it binds the structure
+static bool create_compute(VulkanRayQuery* rq, VkPipelineCache cache, const uint32_t* code, size_t size,
+    uint32_t push_size, VkPipelineLayout* layout, VkPipeline* pipeline)
+{
+    SpirvReflection reflection;
+    if (!spirv_reflect(code, size, &reflection))
+        return false;
+    const SpirvBinding* scene = reflection.bindings;
+    const bool with_set = reflection.binding_count > 0;
+    if ((reflection.push_constant_size + 7) / 8 * 8 != push_size || reflection.binding_count > 1
+        || (with_set && (scene->set != 0 || scene->binding != 0
+            || scene->kind != SPIRV_BINDING_ACCELERATION_STRUCTURE)))
+    {
+        fprintf(stderr, "vulkan: a ray query shader pushes %u bytes of constants (not %u) or binds more than the "
+            "structure at set 0, binding 0\n", reflection.push_constant_size, push_size);
+        return false;
+    }
+
+    const VkPushConstantRange push = { VK_SHADER_STAGE_COMPUTE_BIT, 0, push_size };
+    VkPipelineLayoutCreateInfo layout_info = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    layout_info.setLayoutCount = with_set ? 1 : 0;
+    layout_info.pSetLayouts = with_set ? &rq->set_layout : NULL;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push;
+    VK_CHECK(vkCreatePipelineLayout(rq->device, &layout_info, NULL, layout), "vkCreatePipelineLayout");
+
+    VkShaderModule module = create_shader(rq->device, code, size);
+    VkComputePipelineCreateInfo info = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    info.stage.module = module;
+    info.stage.pName = "main";
+    info.layout = *layout;
+    const VkResult result = module ? vkCreateComputePipelines(rq->device, cache, 1, &info, NULL, pipeline)
+        : VK_ERROR_INITIALIZATION_FAILED;
+    vkDestroyShaderModule(rq->device, module, NULL);
+    VK_CHECK(result, "vkCreateComputePipelines");
+    return true;
+}
+
+// The set every tracing shader binds: the top level at binding 0
+static bool create_descriptors(VulkanRayQuery* rq)
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorSetLayoutCreateInfo layout = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    layout.bindingCount = 1;
+    layout.pBindings = &binding;
+    VK_CHECK(vkCreateDescriptorSetLayout(rq->device, &layout, NULL, &rq->set_layout), "vkCreateDescriptorSetLayout");
+    const VkDescriptorPoolSize size = { VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VULKAN_RAY_QUERY_SLOTS };
+    VkDescriptorPoolCreateInfo pool = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    pool.maxSets = VULKAN_RAY_QUERY_SLOTS;
+    pool.poolSizeCount = 1;
+    pool.pPoolSizes = &size;
+    VK_CHECK(vkCreateDescriptorPool(rq->device, &pool, NULL, &rq->descriptor_pool), "vkCreateDescriptorPool");
+    VkDescriptorSetLayout layouts[VULKAN_RAY_QUERY_SLOTS];
+    for (int i = 0; i < VULKAN_RAY_QUERY_SLOTS; ++i)
+        layouts[i] = rq->set_layout;
+    VkDescriptorSetAllocateInfo allocate = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    allocate.descriptorPool = rq->descriptor_pool;
+    allocate.descriptorSetCount = VULKAN_RAY_QUERY_SLOTS;
+    allocate.pSetLayouts = layouts;
+    VK_CHECK(vkAllocateDescriptorSets(rq->device, &allocate, rq->sets), "vkAllocateDescriptorSets");
+
+    // The handles never change, only what's built into them
+    for (int i = 0; i < VULKAN_RAY_QUERY_SLOTS; ++i)
+    {
+        VkWriteDescriptorSetAccelerationStructureKHR structure = {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR };
+        structure.accelerationStructureCount = 1;
+        structure.pAccelerationStructures = &rq->tlas[i].handle;
+        VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+        write.pNext = &structure;
+        write.dstSet = rq->sets[i];
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        vkUpdateDescriptorSets(rq->device, 1, &write, 0, NULL);
+    }
+    return true;
+}
+
+// The top level's build over "count" instances, for either mode
+static void tlas_build_info(VulkanRayQuery* rq, VkAccelerationStructureGeometryKHR* geometry,
+    VkAccelerationStructureBuildGeometryInfoKHR* info)
+{
+    memset(geometry, 0, sizeof(*geometry));
+    geometry->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    geometry->geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    geometry->geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    geometry->geometry.instances.arrayOfPointers = VK_FALSE;
+    geometry->geometry.instances.data.deviceAddress = rq->instance_address;
+    memset(info, 0, sizeof(*info));
+    info->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    info->type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+    info->flags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR
+        | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
+    info->mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    info->geometryCount = 1;
+    info->pGeometries = geometry;
+}
+
+bool vulkan_ray_query_init(VulkanRayQuery* rq, VkPhysicalDevice physical_device, VkDevice device, VulkanArena* arena,
+    VkQueue queue, uint32_t queue_family, VkBuffer vertices, size_t vertex_size, size_t vertex_count,
+    VkBuffer indices, size_t index_count, uint32_t max_objects)
+{
+    memset(rq, 0, sizeof(*rq));
+    rq->blas.memory.block = rq->scratch_memory.block = rq->instance_memory.block = -1;
+    for (int i = 0; i < VULKAN_RAY_QUERY_SLOTS; ++i)
+        rq->tlas[i].memory.block = -1;
+    rq->device = device;
+    rq->arena = arena;
+    rq->max_objects = max_objects ? max_objects : 1;
+    rq->built_count = UINT32_MAX;
+    rq->last_slot = -1;
+    rq->create = (PFN_vkCreateAccelerationStructureKHR)vkGetDeviceProcAddr(device, "vkCreateAccelerationStructureKHR");
+    rq->destroy = (PFN_vkDestroyAccelerationStructureKHR)vkGetDeviceProcAddr(device, "vkDestroyAccelerationStructureKHR");
+    rq->build_sizes = (PFN_vkGetAccelerationStructureBuildSizesKHR)vkGetDeviceProcAddr(device,
+        "vkGetAccelerationStructureBuildSizesKHR");
+    rq->cmd_build = (PFN_vkCmdBuildAccelerationStructuresKHR)vkGetDeviceProcAddr(device,
+        "vkCmdBuildAccelerationStructuresKHR");
+    rq->structure_address = (PFN_vkGetAccelerationStructureDeviceAddressKHR)vkGetDeviceProcAddr(device,
+        "vkGetAccelerationStructureDeviceAddressKHR");
+    rq->cmd_write_properties = (PFN_vkCmdWriteAccelerationStructuresPropertiesKHR)vkGetDeviceProcAddr(device,
+        "vkCmdWriteAccelerationStructuresPropertiesKHR");
+    rq->cmd_copy = (PFN_vkCmdCopyAccelerationStructureKHR)vkGetDeviceProcAddr(device, "vkCmdCopyAccelerationStructureKHR");
+    if (!rq->create || !rq->destroy || !rq->build_sizes || !rq->cmd_build || !rq->structure_address
+        || !rq->cmd_write_properties || !rq->cmd_copy)
+    {
+        fprintf(stderr, "vulkan: the device's acceleration structure functions are missing\n");
+        return false;
+    }
+    VkPhysicalDeviceAccelerationStructurePropertiesKHR acceleration = {
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR };
+    VkPhysicalDeviceProperties2 properties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+    properties.pNext = &acceleration;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+    rq->scratch_alignment = acceleration.minAccelerationStructureScratchOffsetAlignment
+        ? acceleration.minAccelerationStructureScratchOffsetAlignment : 1;
+
+    VkCommandPoolCreateInfo pool_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+    VkCommandPool pool = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateCommandPool(device, &pool_info, NULL, &pool), "vkCreateCommandPool");
+    const bool built = build_blas(rq, queue, pool, vertices, vertex_size, vertex_count, indices, index_count);
+    vkDestroyCommandPool(device, pool, NULL);
+    if (!built)
+        return false;
+
+    // The top levels and their scratch, sized for every object; refits take the same scratch
+    VkAccelerationStructureGeometryKHR geometry;
+    VkAccelerationStructureBuildGeometryInfoKHR info;
+    tlas_build_info(rq, &geometry, &info);
+    VkAccelerationStructureBuildSizesInfoKHR sizes = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR };
+    rq->build_sizes(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &info, &rq->max_objects, &sizes);
+    for (int i = 0; i < VULKAN_RAY_QUERY_SLOTS; ++i)
+        if (!create_structure(rq, VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, sizes.accelerationStructureSize,
+            &rq->tlas[i]))
+            return false;
+    if (!create_scratch(rq, sizes.buildScratchSize > sizes.updateScratchSize ? sizes.buildScratchSize
+            : sizes.updateScratchSize))
+        return false;
+    if (!vulkan_arena_create_buffer(arena, sizeof(VkAccelerationStructureInstanceKHR) * (VkDeviceSize)rq->max_objects,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+        | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &rq->instances, &rq->instance_memory))
+    {
+        fprintf(stderr, "vulkan: no memory for %u acceleration structure instances\n", rq->max_objects);
+        return false;
+    }
+    rq->instance_address = vulkan_buffer_address(device, rq->instances);
+
+    return create_descriptors(rq);
+}
+
+bool vulkan_ray_query_create_pipeline(VulkanRayQuery* rq, VkPipelineCache cache, int index)
+{
+    if (index == 0)
+        return create_compute(rq, cache, tlas_instances_comp_spv, sizeof(tlas_instances_comp_spv),
+            sizeof(InstancePush), &rq->instance_layout, &rq->instance_pipeline);
+    return create_compute(rq, cache, ray_pick_comp_spv, sizeof(ray_pick_comp_spv), sizeof(PickPush), &rq->pick_layout,
+        &rq->pick_pipeline);
+}
+
+void vulkan_ray_query_destroy(VulkanRayQuery* rq)
+{
+    if (rq->device == VK_NULL_HANDLE)
+        return;
+    if (rq->pick_pipeline != VK_NULL_HANDLE)
+        vkDestroyPipeline(rq->device, rq->pick_pipeline, NULL);
+    if (rq->pick_layout != VK_NULL_HANDLE)
+        vkDestroyPipelineLayout(rq->device, rq->pick_layout, NULL);
+    if (rq->instance_pipeline != VK_NULL_HANDLE)
+        vkDestroyPipeline(rq->device, rq->instance_pipeline, NULL);
+    if (rq->instance_layout != VK_NULL_HANDLE)
+        vkDestroyPipelineLayout(rq->device, rq->instance_layout, NULL);
+    if (rq->descriptor_pool != VK_NULL_HANDLE)
+        vkDestroyDescriptorPool(rq->device, rq->descriptor_pool, NULL);
+    if (rq->set_layout != VK_NULL_HANDLE)
+        vkDestroyDescriptorSetLayout(rq->device, rq->set_layout, NULL);
+    vulkan_arena_destroy_buffer(rq->arena, &rq->instances, &rq->instance_memory);
+    vulkan_arena_destroy_buffer(rq->arena, &rq->scratch, &rq->scratch_memory);
+    if (rq->destroy)
+    {
+        for (int i = 0; i < VULKAN_RAY_QUERY_SLOTS; ++i)
+            destroy_structure(rq, &rq->tlas[i]);
+        destroy_structure(rq, &rq->blas);
+    }
+    memset(rq, 0, sizeof(*rq));
+}
+
+void vulkan_ray_query_update(VulkanRayQuery* rq, VkCommandBuffer cmd, int slot, VkDeviceAddress models,
+    VkDeviceAddress objects, uint32_t count, VkPipelineStageFlags readers)
+{
+    count = count < rq->max_objects ? count : rq->max_objects;
+
+    // The last update's build and the traces on this queue are done with the instances and the scratch, and the
+    // last structure is built before it's refit from. The slot's own was last traced a frame in flight ago, which
+    // the frame's fence has seen finish.
+    VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    const VkPipelineStageFlags stages = VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR
+        | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    vkCmdPipelineBarrier(cmd, stages, stages, 0, 1, &barrier, 0, NULL, 0, NULL);
+
+    if (count)
+    {
+        const InstancePush push = { models, objects, rq->instance_address, rq->blas.address, count, 0 };
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, rq->instance_pipeline);
+        vkCmdPushConstants(cmd, rq->instance_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+        vkCmdDispatch(cmd, (count + VULKAN_RAY_QUERY_GROUP - 1) / VULKAN_RAY_QUERY_GROUP, 1, 1);
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &barrier, 0, NULL, 0, NULL);
+    }
+
+    // A refit keeps the build's tree and moves its boxes, from the last structure into this slot's: only for the same
+    // count, and only for so long
+    VkAccelerationStructureGeometryKHR geometry;
+    VkAccelerationStructureBuildGeometryInfoKHR info;
+    tlas_build_info(rq, &geometry, &info);
+    const bool refit = count == rq->built_count && rq->last_slot >= 0
+        && rq->refits_since_build < VULKAN_RAY_QUERY_REBUILD_FRAMES;
+    info.mode = refit ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    info.srcAccelerationStructure = refit ? rq->tlas[rq->last_slot].handle : VK_NULL_HANDLE;
+    info.dstAccelerationStructure = rq->tlas[slot].handle;
+    info.scratchData.deviceAddress = rq->scratch_address;
+    const VkAccelerationStructureBuildRangeInfoKHR range = { count, 0, 0, 0 };
+    const VkAccelerationStructureBuildRangeInfoKHR* ranges = &range;
+    rq->cmd_build(cmd, 1, &info, &ranges);
+    if (refit)
+    {
+        ++rq->refits;
+        ++rq->refits_since_build;
+    }
+    else
+    {
+        ++rq->builds;
+        rq->built_count = count;
+        rq->refits_since_build = 0;
+    }
+    rq->last_slot = slot;
+
+    barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, readers, 0, 1, &barrier, 0, NULL,
+        0, NULL);
+}
+
+void vulkan_ray_query_pick(VulkanRayQuery* rq, VkCommandBuffer cmd, int slot, const vec3 origin, const vec3 dir,
+    float t_max, VkDeviceAddress result)
+{
+    const PickPush push = { { origin[0], origin[1], origin[2], 0.f }, { dir[0], dir[1], dir[2], t_max }, result };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, rq->pick_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, rq->pick_layout, 0, 1, &rq->sets[slot], 0, NULL);
+    vkCmdPushConstants(cmd, rq->pick_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(cmd, 1, 1, 1);
+    VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL,
+        0, NULL);
+    ++rq->picks;
+}
+
+void vulkan_ray_query_report(const VulkanRayQuery* rq, unsigned int frames, FILE* out)
+{
+    fprintf(out, "  ray queries: BLAS %.1f KB compacted from %.1f KB, %d TLAS %.1f KB each for %u instances\n",
+        rq->blas.size / 1024.0, rq->blas_built_size / 1024.0, VULKAN_RAY_QUERY_SLOTS, rq->tlas[0].size / 1024.0,
+        rq->max_objects);
+    fprintf(out, "  TLAS          %10llu builds, %llu refits over %u frames; %llu picks traced\n", rq->builds,
+        rq->refits, frames, rq->picks);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "linmath.h"
+#include "vk/vulkan_memory.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Hardware ray queries for the Vulkan backend (VK_KHR_acceleration_structure
+// and VK_KHR_ray_query), where the device has them: closest-hit picking and
+// the ground's hard shadows, traced inline from a compute and a fragment
+// shader instead of through a ray tracing pipeline.
+//
+// The mesh gets one bottom-level structure, built once for fast tracing and
+// then compacted: the built one's compacted size is read back through a
+// query, it is copied into a structure that size and freed. The top level
+// holds the frame's visible objects, one instance each, its custom index
+// the object's index. A compute shader writes the instances from the model
+// matrices and object indices scene_update put in the frame's buffers - the
+// matrices are already VkTransformMatrixKHR's 3x4 rows - and the structure
+// is built over them. It is built for fast updates: while the count stays
+// the same it is refit, and rebuilt from scratch whenever the count
+// changes or VULKAN_RAY_QUERY_REBUILD_FRAMES refits have loosened it.
+//
+// There is a top-level structure per frame in flight, since the update may
+// run on an async compute queue while the graphics queue still traces the
+// last frame's. A refit reads the last one updated and writes the frame's
+// own. The instances and the scratch are only used by the updates, which
+// all go through one queue, so the barrier recorded at the start of each
+// keeps the last one's reads ahead of its writes.
+
+#define VULKAN_RAY_QUERY_REBUILD_FRAMES 16      // refits before a full build
+#define VULKAN_RAY_QUERY_SLOTS 2                // top levels: VULKAN_FRAMES
+#define VULKAN_RAY_QUERY_EXTENSION_COUNT 3
+#define VULKAN_RAY_QUERY_GROUP 64               // instances a workgroup writes
+#define VULKAN_RAY_QUERY_PIPELINES 2            // the instance writer and the pick
+
+// The device extensions ray queries need, besides the swapchain's
+extern const char* const vulkan_ray_query_extensions[VULKAN_RAY_QUERY_EXTENSION_COUNT];
+
+// The features to enable, chained for VkDeviceCreateInfo::pNext
+typedef struct VulkanRayQueryFeatures
+{
+    VkPhysicalDeviceVulkan12Features vulkan12;                      // bufferDeviceAddress
+    VkPhysicalDeviceAccelerationStructureFeaturesKHR acceleration;
+    VkPhysicalDeviceRayQueryFeaturesKHR ray_query;
+} VulkanRayQueryFeatures;
+
+// What a pick wrote: the object's index, or -1 for none, and the hit's distance along the ray
+typedef struct VulkanPickResult
+{
+    int32_t object;
+    float t;
+} VulkanPickResult;
+
+typedef struct VulkanAccelerationStructure
+{
+    VkAccelerationStructureKHR handle;
+    VkBuffer buffer;
+    VulkanAllocation memory;
+    VkDeviceAddress address;
+    VkDeviceSize size;
+} VulkanAccelerationStructure;
+
+typedef struct VulkanRayQuery
+{
+    VkDevice device;
+    VulkanArena* arena;         // the renderer's, allocating with device addresses
+    PFN_vkCreateAccelerationStructureKHR create;
+    PFN_vkDestroyAccelerationStructureKHR destroy;
+    PFN_vkGetAccelerationStructureBuildSizesKHR build_sizes;
+    PFN_vkCmdBuildAccelerationStructuresKHR cmd_build;
+    PFN_vkGetAccelerationStructureDeviceAddressKHR structure_address;
+    PFN_vkCmdWriteAccelerationStructuresPropertiesKHR cmd_write_properties;
+    PFN_vkCmdCopyAccelerationStructureKHR cmd_copy;
+    VkDeviceSize scratch_alignment;
+
+    VulkanAccelerationStructure blas;
+    VkDeviceSize blas_built_size;           // before compaction
+    VulkanAccelerationStructure tlas[VULKAN_RAY_QUERY_SLOTS];   // for max_objects instances each
+    VkBuffer scratch;
+    VulkanAllocation scratch_memory;
+    VkDeviceAddress scratch_address;        // aligned for the builds
+    VkBuffer instances;                     // VkAccelerationStructureInstanceKHR [max_objects], device-local
+    VulkanAllocation instance_memory;
+    VkDeviceAddress instance_address;
+    uint32_t max_objects;
+    uint32_t built_count;                   // instances as of the last full build; UINT32_MAX before the first
+    uint32_t refits_since_build;
+    int last_slot;                          // updated last; -1 before the first
+
+    VkDescriptorSetLayout set_layout;       // binding 0: the top-level structure, for compute and fragment shaders
+    VkDescriptorPool descriptor_pool;
+    VkDescriptorSet sets[VULKAN_RAY_QUERY_SLOTS];   // each slot's top level
+    VkPipelineLayout instance_layout;
+    VkPipeline instance_pipeline;
+    VkPipelineLayout pick_layout;
+    VkPipeline pick_pipeline;
+
+    unsigned long long builds, refits, picks;
+} VulkanRayQuery;
+
+// A 1.2 device with the extensions, acceleration structures, ray queries and buffer device addresses
+bool vulkan_ray_query_supported(VkPhysicalDevice physical_device);
+// Fills "features" with what to enable and returns the chain's head
+void* vulkan_ray_query_features(VulkanRayQueryFeatures* features);
+
+// The mesh (vec2 positions "vertex_size" apart, 32-bit indices; both buffers with device addresses and
+// acceleration structure build input usage) built and compacted into the bottom level on "queue", waited for; the
+// top level, its instances and scratch for "max_objects"; the set layout. "arena" must have been made with device
+// addresses. Logs and returns false on failure; vulkan_ray_query_destroy cleans up either way.
+bool vulkan_ray_query_init(VulkanRayQuery* rq, VkPhysicalDevice physical_device, VkDevice device, VulkanArena* arena,
+    VkQueue queue, uint32_t queue_family, VkBuffer vertices, size_t vertex_size, size_t vertex_count,
+    VkBuffer indices, size_t index_count, uint32_t max_objects);
+// Pipeline "index" of VULKAN_RAY_QUERY_PIPELINES through "cache", after init; different indices may be made on
+// different threads at once. Logs and returns false on failure.
+bool vulkan_ray_query_create_pipeline(VulkanRayQuery* rq, VkPipelineCache cache, int index);
+void vulkan_ray_query_destroy(VulkanRayQuery* rq);
+
+// The device address of "buffer", made with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+VkDeviceAddress vulkan_buffer_address(VkDevice device, VkBuffer buffer);
+
+// Records into "cmd", outside a render pass: the instances written from "count" model matrices (mat3x4) and
+// object indices (uint32) at those addresses, then "slot"'s top level refit over them or rebuilt. The "readers"
+// stages of "cmd"'s queue (compute, and fragment on a graphics queue) may trace it after; another queue must wait on
+// a semaphore the submission signals.
+void vulkan_ray_query_update(VulkanRayQuery* rq, VkCommandBuffer cmd, int slot, VkDeviceAddress models,
+    VkDeviceAddress objects, uint32_t count, VkPipelineStageFlags readers);
+
+// Records into "cmd", after "slot"'s update: the closest hit along "origin" + t "dir" for t in [0, t_max], written
+// to the VulkanPickResult at "result" (host-visible memory), readable by the host once the submission is done
+void vulkan_ray_query_pick(VulkanRayQuery* rq, VkCommandBuffer cmd, int slot, const vec3 origin, const vec3 dir,
+    float t_max, VkDeviceAddress result);
+
+// The structures' sizes, builds and refits since init
+void vulkan_ray_query_report(const VulkanRayQuery* rq, unsigned int frames, FILE* out);
@@ -0,0 +1,1397 @@
+#include "vk/vulkan_renderer.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>     // after vulkan.h, for glfwCreateWindowSurface
+
+#include "core/cpu_trace.h"
+#include "core/spirv_reflect.h"
+#include "gl/program_cache.h"   // program_cache_hash only
+
+#include <filesystem>
+#include <stdlib.h>
+#include <string.h>
+#include <system_error>
+
+// SPIR-V words from glslc -mfmt=num, built from src/vk/shaders/
+static const uint32_t scene_vert_spv[] =
+{
+#include "scene.vert.inc"
+};
+static const uint32_t scene_frag_spv[] =
+{
+#include "scene.frag.inc"
+};
+static const uint32_t ground_vert_spv[] =
+{
+#include "ground.vert.inc"
+};
+static const uint32_t ground_frag_spv[] =
+{
+#include "ground.frag.inc"
+};
+
+#define VK_CHECK(call, what) \
+    do { VkResult result_ = (call); if (result_ != VK_SUCCESS) { \
+        fprintf(stderr, "vulkan: %s failed (%d)\n", what, (int)result_); return false; } } while (0)
+
+static bool create_instance(VulkanRenderer* r)
+{
+    uint32_t extension_count = 0;
+    const char** extensions = glfwGetRequiredInstanceExtensions(&extension_count);
+    if (!extensions)
+    {
+        fprintf(stderr, "vulkan: GLFW found no Vulkan loader or no surface extensions\n");
+        return false;
+    }
+    VkApplicationInfo app = { VK_STRUCTURE_TYPE_APPLICATION_INFO };
+    app.pApplicationName = "openGLTest";
+    app.apiVersion = VK_API_VERSION_1_2;    // negative viewport heights; buffer device addresses for ray queries
+    VkInstanceCreateInfo info = { VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
+    info.pApplicationInfo = &app;
+    info.enabledExtensionCount = extension_count;
+    info.ppEnabledExtensionNames = extensions;
+#ifndef NDEBUG
+    // The validation layer where it's installed, as debug builds get the GL debug output
+    static const char* validation = "VK_LAYER_KHRONOS_validation";
+    uint32_t layer_count = 0;
+    vkEnumerateInstanceLayerProperties(&layer_count, NULL);
+    VkLayerProperties* layers = (VkLayerProperties*)malloc(sizeof(VkLayerProperties) * (layer_count ? layer_count : 1));
+    vkEnumerateInstanceLayerProperties(&layer_count, layers);
+    for (uint32_t l = 0; l < layer_count; ++l)
+        if (!strcmp(layers[l].layerName, validation))
+        {
+            info.enabledLayerCount = 1;
+            info.ppEnabledLayerNames = &validation;
+        }
+    free(layers);
+#endif
+    VK_CHECK(vkCreateInstance(&info, NULL, &r->instance), "vkCreateInstance");
+    VK_CHECK(glfwCreateWindowSurface(r->instance, r->window, NULL, &r->surface), "glfwCreateWindowSurface");
+    return true;
+}
+
+// A device with a queue family that draws and presents to the surface and has VK_KHR_swapchain; a discrete GPU
+// over any other. Ray queries are enabled if they were asked for and it has them, and with them an async compute
+// queue: of a compute family without graphics, or else the graphics family's second queue.
+static bool pick_device(VulkanRenderer* r)
+{
+    uint32_t count = 0;
+    vkEnumeratePhysicalDevices(r->instance, &count, NULL);
+    VkPhysicalDevice devices[16];
+    count = count > 16 ? 16 : count;
+    vkEnumeratePhysicalDevices(r->instance, &count, devices);
+    int best_score = -1;
+    for (uint32_t d = 0; d < count; ++d)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(devices[d], &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_1)
+            continue;
+
+        uint32_t extension_count = 0;
+        vkEnumerateDeviceExtensionProperties(devices[d], NULL, &extension_count, NULL);
+        VkExtensionProperties* extensions = (VkExtensionProperties*)malloc(sizeof(VkExtensionProperties)
+            * (extension_count ? extension_count : 1));
+        vkEnumerateDeviceExtensionProperties(devices[d], NULL, &extension_count, extensions);
+        bool swapchain = false;
+        for (uint32_t e = 0; e < extension_count; ++e)
+            swapchain = swapchain || !strcmp(extensions[e].extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        free(extensions);
+        if (!swapchain)
+            continue;
+
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[d], &family_count, NULL);
+        VkQueueFamilyProperties families[32];
+        family_count = family_count > 32 ? 32 : family_count;
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[d], &family_count, families);
+        for (uint32_t f = 0; f < family_count; ++f)
+        {
+            VkBool32 present = VK_FALSE;
+            vkGetPhysicalDeviceSurfaceSupportKHR(devices[d], f, r->surface, &present);
+            if (!(families[f].queueFlags & VK_QUEUE_GRAPHICS_BIT) || !present)
+                continue;
+            const int score = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? 2
+                : properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ? 1 : 0;
+            if (score > best_score)
+            {
+                best_score = score;
+                r->physical_device = devices[d];
+                r->properties = properties;
+                r->queue_family = f;
+            }
+            break;
+        }
+    }
+    if (best_score < 0)
+    {
+        fprintf(stderr, "vulkan: no 1.1 device draws and presents to the window\n");
+        return false;
+    }
+
+    if (r->ray_query && !vulkan_ray_query_supported(r->physical_device))
+    {
+        fprintf(stderr, "vulkan: %s has no ray queries; picks go through the BVH%s\n", r->properties.deviceName,
+            r->ray_shadows ? ", and there are no shadows" : "");
+        r->ray_query = r->ray_shadows = false;
+    }
+
+    // Only the acceleration structure's passes are compute ones
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(r->physical_device, &family_count, NULL);
+    VkQueueFamilyProperties families[32];
+    family_count = family_count > 32 ? 32 : family_count;
+    vkGetPhysicalDeviceQueueFamilyProperties(r->physical_device, &family_count, families);
+    uint32_t compute_index = 0;
+    r->async_compute = r->async_compute && r->ray_query;
+    if (r->async_compute)
+    {
+        r->compute_family = UINT32_MAX;
+        for (uint32_t f = 0; f < family_count && r->compute_family == UINT32_MAX; ++f)
+            if ((families[f].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(families[f].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+                r->compute_family = f;
+        if (r->compute_family == UINT32_MAX && families[r->queue_family].queueCount > 1)
+        {
+            r->compute_family = r->queue_family;
+            compute_index = 1;
+        }
+        if (r->compute_family == UINT32_MAX)
+        {
+            fprintf(stderr, "vulkan: %s has one queue; compute passes run on the graphics one\n",
+                r->properties.deviceName);
+            r->async_compute = false;
+        }
+    }
+    r->timestamps = families[r->queue_family].timestampValidBits > 0;
+    r->compute_timestamps = r->timestamps && (!r->async_compute || families[r->compute_family].timestampValidBits > 0);
+    r->timestamp_ns = r->properties.limits.timestampPeriod;
+
+    const float priorities[2] = { 1.f, 1.f };
+    VkDeviceQueueCreateInfo queues[2] = {};
+    queues[0].sType = queues[1].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queues[0].queueFamilyIndex = r->queue_family;
+    queues[0].queueCount = r->async_compute && r->compute_family == r->queue_family ? 2 : 1;
+    queues[0].pQueuePriorities = priorities;
+    queues[1].queueFamilyIndex = r->compute_family;
+    queues[1].queueCount = 1;
+    queues[1].pQueuePriorities = priorities;
+    const char* extensions[1 + VULKAN_RAY_QUERY_EXTENSION_COUNT] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    for (int e = 0; e < VULKAN_RAY_QUERY_EXTENSION_COUNT; ++e)
+        extensions[1 + e] = vulkan_ray_query_extensions[e];
+    VulkanRayQueryFeatures features;
+    VkDeviceCreateInfo info = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+    info.pNext = r->ray_query ? vulkan_ray_query_features(&features) : NULL;
+    if (r->ray_query)
+    {
+        features.vulkan12.bufferDeviceAddress = VK_TRUE;
+        features.acceleration.accelerationStructure = VK_TRUE;
+        features.ray_query.rayQuery = VK_TRUE;
+    }
+    info.queueCreateInfoCount = r->async_compute && r->compute_family != r->queue_family ? 2 : 1;
+    info.pQueueCreateInfos = queues;
+    info.enabledExtensionCount = r->ray_query ? 1 + VULKAN_RAY_QUERY_EXTENSION_COUNT : 1;
+    info.ppEnabledExtensionNames = extensions;
+    VK_CHECK(vkCreateDevice(r->physical_device, &info, NULL, &r->device), "vkCreateDevice");
+    vkGetDeviceQueue(r->device, r->queue_family, 0, &r->queue);
+    if (r->async_compute)
+        vkGetDeviceQueue(r->device, r->compute_family, compute_index, &r->compute_queue);
+    printf("vulkan: %s (%u.%u.%u)\n", r->properties.deviceName, VK_VERSION_MAJOR(r->properties.apiVersion),
+        VK_VERSION_MINOR(r->properties.apiVersion), VK_VERSION_PATCH(r->properties.apiVersion));
+    if (r->async_compute)
+        printf("vulkan: async compute on queue family %u (%s)\n", r->compute_family,
+            r->compute_family == r->queue_family ? "the graphics family's second queue" : "compute only");
+    return true;
+}
+
+static void destroy_swapchain(VulkanRenderer* r)
+{
+    for (uint32_t i = 0; i < r->image_count; ++i)
+    {
+        vkDestroyFramebuffer(r->device, r->framebuffers[i], NULL);
+        vkDestroyImageView(r->device, r->views[i], NULL);
+        vkDestroySemaphore(r->device, r->rendered[i], NULL);
+    }
+    r->image_count = 0;
+    if (r->swapchain != VK_NULL_HANDLE)
+        vkDestroySwapchainKHR(r->device, r->swapchain, NULL);
+    r->swapchain = VK_NULL_HANDLE;
+}
+
+// The swapchain at the window's framebuffer size, with a view, framebuffer and present semaphore per image. A
+// zero extent (minimised) leaves it without one; the next begin_frame tries again.
+static bool create_swapchain(VulkanRenderer* r)
+{
+    VkSurfaceCapabilitiesKHR caps;
+    VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(r->physical_device, r->surface, &caps), "surface capabilities");
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(r->window, &width, &height);
+    r->extent = caps.currentExtent;
+    if (caps.currentExtent.width == 0xFFFFFFFFu)
+    {
+        r->extent.width = (uint32_t)width < caps.minImageExtent.width ? caps.minImageExtent.width
+            : (uint32_t)width > caps.maxImageExtent.width ? caps.maxImageExtent.width : (uint32_t)width;
+        r->extent.height = (uint32_t)height < caps.minImageExtent.height ? caps.minImageExtent.height
+            : (uint32_t)height > caps.maxImageExtent.height ? caps.maxImageExtent.height : (uint32_t)height;
+    }
+    if (r->extent.width == 0 || r->extent.height == 0)
+        return true;
+
+    uint32_t image_count = caps.minImageCount + 1;
+    if (caps.maxImageCount && image_count > caps.maxImageCount)
+        image_count = caps.maxImageCount;
+    VkSwapchainCreateInfoKHR info = { VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
+    info.surface = r->surface;
+    info.minImageCount = image_count;
+    info.imageFormat = r->format;
+    info.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    info.imageExtent = r->extent;
+    info.imageArrayLayers = 1;
+    info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.preTransform = caps.currentTransform;
+    info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    info.presentMode = r->present_mode;
+    info.clipped = VK_TRUE;
+    VK_CHECK(vkCreateSwapchainKHR(r->device, &info, NULL, &r->swapchain), "vkCreateSwapchainKHR");
+
+    vkGetSwapchainImagesKHR(r->device, r->swapchain, &image_count, NULL);
+    r->image_count = image_count > VULKAN_MAX_IMAGES ? VULKAN_MAX_IMAGES : image_count;
+    vkGetSwapchainImagesKHR(r->device, r->swapchain, &r->image_count, r->images);
+    for (uint32_t i = 0; i < r->image_count; ++i)
+    {
+        VkImageViewCreateInfo view = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+        view.image = r->images[i];
+        view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view.format = r->format;
+        view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view.subresourceRange.levelCount = 1;
+        view.subresourceRange.layerCount = 1;
+        VK_CHECK(vkCreateImageView(r->device, &view, NULL, &r->views[i]), "vkCreateImageView");
+        VkFramebufferCreateInfo framebuffer = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+        framebuffer.renderPass = r->render_pass;
+        framebuffer.attachmentCount = 1;
+        framebuffer.pAttachments = &r->views[i];
+        framebuffer.width = r->extent.width;
+        framebuffer.height = r->extent.height;
+        framebuffer.layers = 1;
+        VK_CHECK(vkCreateFramebuffer(r->device, &framebuffer, NULL, &r->framebuffers[i]), "vkCreateFramebuffer");
+        VkSemaphoreCreateInfo semaphore = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+        VK_CHECK(vkCreateSemaphore(r->device, &semaphore, NULL, &r->rendered[i]), "vkCreateSemaphore");
+    }
+    return true;
+}
+
+// The surface's format and present mode, and the render pass that clears and presents an image of it
+static bool create_render_pass(VulkanRenderer* r)
+{
+    uint32_t count = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(r->physical_device, r->surface, &count, NULL);
+    VkSurfaceFormatKHR formats[64];
+    count = count > 64 ? 64 : count;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(r->physical_device, r->surface, &count, formats);
+    if (!count)
+        return false;
+    r->format = formats[0].format;
+    for (uint32_t f = 0; f < count; ++f)
+        if (formats[f].format == VK_FORMAT_B8G8R8A8_UNORM && formats[f].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+            r->format = formats[f].format;      // unconverted, as GL's default framebuffer is
+
+    // FIFO is always there; without vsync mailbox, or failing that immediate
+    VkPresentModeKHR modes[16];
+    count = 16;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(r->physical_device, r->surface, &count, modes);
+    r->present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    for (uint32_t m = 0; m < count && !r->vsync; ++m)
+        if (modes[m] == VK_PRESENT_MODE_MAILBOX_KHR
+            || (modes[m] == VK_PRESENT_MODE_IMMEDIATE_KHR && r->present_mode != VK_PRESENT_MODE_MAILBOX_KHR))
+            r->present_mode = modes[m];
+
+    VkAttachmentDescription colour = {};
+    colour.format = r->format;
+    colour.samples = VK_SAMPLE_COUNT_1_BIT;
+    colour.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colour.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colour.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colour.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colour.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colour.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    VkAttachmentReference reference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &reference;
+    // The clear waits for the acquire semaphore, which the submit waits for at this stage
+    VkSubpassDependency dependency = {};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    VkRenderPassCreateInfo info = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+    info.attachmentCount = 1;
+    info.pAttachments = &colour;
+    info.subpassCount = 1;
+    info.pSubpasses = &subpass;
+    info.dependencyCount = 1;
+    info.pDependencies = &dependency;
+    VK_CHECK(vkCreateRenderPass(r->device, &info, NULL, &r->render_pass), "vkCreateRenderPass");
+    return true;
+}
+
+// The pipeline cache file, if it was written by this device and driver: its name is keyed by them, and the header
+// Vulkan puts in front of the data must agree (the file may have been copied or renamed); an empty cache otherwise
+static bool create_pipeline_cache(VulkanRenderer* r)
+{
+    const VkPhysicalDeviceProperties* p = &r->properties;
+    uint64_t key = program_cache_hash(14695981039346656037ull, &p->vendorID, sizeof(p->vendorID));
+    key = program_cache_hash(key, &p->deviceID, sizeof(p->deviceID));
+    key = program_cache_hash(key, &p->driverVersion, sizeof(p->driverVersion));
+    key = program_cache_hash(key, p->pipelineCacheUUID, VK_UUID_SIZE);
+    snprintf(r->pipeline_cache_path, sizeof(r->pipeline_cache_path), "%s/vulkan_%016llx.bin",
+        VULKAN_PIPELINE_CACHE_DIR, (unsigned long long)key);
+
+    void* data = NULL;
+    size_t size = 0;
+    FILE* f = fopen(r->pipeline_cache_path, "rb");
+    if (f)
+    {
+        fseek(f, 0, SEEK_END);
+        const long length = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (length > 16 + VK_UUID_SIZE && (data = malloc((size_t)length)) && fread(data, 1, (size_t)length, f) == (size_t)length)
+        {
+            const uint32_t* header = (const uint32_t*)data;
+            if (header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header[2] == r->properties.vendorID
+                && header[3] == r->properties.deviceID
+                && !memcmp(header + 4, r->properties.pipelineCacheUUID, VK_UUID_SIZE))
+                size = (size_t)length;
+        }
+        fclose(f);
+    }
+    VkPipelineCacheCreateInfo info = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+    info.initialDataSize = size;
+    info.pInitialData = size ? data : NULL;
+    const VkResult result = vkCreatePipelineCache(r->device, &info, NULL, &r->pipeline_cache);
+    free(data);
+    VK_CHECK(result, "vkCreatePipelineCache");
+    r->pipeline_cache_loaded = size;
+    return true;
+}
+
+static void save_pipeline_cache(const VulkanRenderer* r)
+{
+    size_t size = 0;
+    if (vkGetPipelineCacheData(r->device, r->pipeline_cache, &size, NULL) != VK_SUCCESS || !size)
+        return;
+    void* data = malloc(size);
+    if (data && vkGetPipelineCacheData(r->device, r->pipeline_cache, &size, data) == VK_SUCCESS)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(VULKAN_PIPELINE_CACHE_DIR, ec);
+        FILE* f = fopen(r->pipeline_cache_path, "wb");
+        if (f)
+        {
+            fwrite(data, 1, size, f);
+            fclose(f);
+        }
+        else
+            fprintf(stderr, "vulkan: can't write %s\n", r->pipeline_cache_path);
+    }
+    free(data);
+}
+
+static VkShaderModule create_shader(VkDevice device, const uint32_t* code, size_t size)
+{
+    VkShaderModuleCreateInfo info = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+    info.codeSize = size;
+    info.pCode = code;
+    VkShaderModule module = VK_NULL_HANDLE;
+    vkCreateShaderModule(device, &info, NULL, &module);
+    return module;
+}
+
+static VkFormat input_format(const SpirvInput* input)
+{
+    static const VkFormat formats[3][4] = {
+        { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT },
+        { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT },
+        { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT },
+    };
+    return formats[input->component][input->components - 1];
+}
+
+// The push constant range a pipeline's stages ask for, over every stage that has the block. Padded to 8 bytes it
+// must be the "host" bytes the recording pushes: a shader and its push struct that drifted apart are caught here.
+static bool push_constant_range(const SpirvReflection* vert, const SpirvReflection* frag, uint32_t host,
+    const char* what, VkPushConstantRange* range)
+{
+    range->stageFlags = (vert->push_constant_size ? VK_SHADER_STAGE_VERTEX_BIT : 0)
+        | (frag->push_constant_size ? VK_SHADER_STAGE_FRAGMENT_BIT : 0);
+    range->offset = 0;
+    const uint32_t size = vert->push_constant_size > frag->push_constant_size ? vert->push_constant_size
+        : frag->push_constant_size;
+    range->size = host;
+    if ((size + 7) / 8 * 8 == host)
+        return true;
+    fprintf(stderr, "vulkan: the %s shaders take %u bytes of push constants, the renderer pushes %u\n", what, size,
+        host);
+    return false;
+}
+
+// The scene pipeline, its vertex input and push constants as the shaders' SPIR-V declares them: locations below
+// VULKAN_FIRST_INSTANCE_LOCATION from the mesh's vertices on binding 0, the rest (the model matrix rows, locations
+// 2-4 as in the GL shader) from the instances on binding 1, each packed after the last in location order; the
+// view-projection as a push constant; viewport and scissor set when recording
+static bool create_pipeline(VulkanRenderer* r, size_t vertex_size)
+{
+    SpirvReflection vert_reflection, frag_reflection;
+    if (!spirv_reflect(scene_vert_spv, sizeof(scene_vert_spv), &vert_reflection)
+        || !spirv_reflect(scene_frag_spv, sizeof(scene_frag_spv), &frag_reflection))
+        return false;
+    VkPushConstantRange push;
+    if (!push_constant_range(&vert_reflection, &frag_reflection, sizeof(mat4x4), "scene", &push))
+        return false;
+    r->push_stages = push.stageFlags;
+
+    VkVertexInputAttributeDescription attributes[SPIRV_REFLECT_MAX_INPUTS];
+    uint32_t strides[2] = { 0, 0 };
+    for (int i = 0; i < vert_reflection.input_count; ++i)
+    {
+        const SpirvInput* in = &vert_reflection.inputs[i];
+        const uint32_t binding = in->location >= VULKAN_FIRST_INSTANCE_LOCATION ? 1 : 0;
+        attributes[i] = { in->location, binding, input_format(in), strides[binding] };
+        strides[binding] += spirv_input_size(in);
+    }
+    if (strides[0] > vertex_size || strides[1] > sizeof(mat3x4))
+    {
+        fprintf(stderr, "vulkan: the scene shader reads %u bytes a vertex and %u an instance, past the buffers' "
+            "%zu and %zu\n", strides[0], strides[1], vertex_size, sizeof(mat3x4));
+        return false;
+    }
+
+    VkPipelineLayoutCreateInfo layout = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    layout.pushConstantRangeCount = 1;
+    layout.pPushConstantRanges = &push;
+    VK_CHECK(vkCreatePipelineLayout(r->device, &layout, NULL, &r->layout), "vkCreatePipelineLayout");
+
+    VkShaderModule vert = create_shader(r->device, scene_vert_spv, sizeof(scene_vert_spv));
+    VkShaderModule frag = create_shader(r->device, scene_frag_spv, sizeof(scene_frag_spv));
+    VkPipelineShaderStageCreateInfo stages[2] = {
+        { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, NULL, 0, VK_SHADER_STAGE_VERTEX_BIT, vert, "main", NULL },
+        { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, NULL, 0, VK_SHADER_STAGE_FRAGMENT_BIT, frag, "main", NULL },
+    };
+
+    const VkVertexInputBindingDescription bindings[2] = {
+        { 0, (uint32_t)vertex_size, VK_VERTEX_INPUT_RATE_VERTEX },
+        { 1, sizeof(mat3x4), VK_VERTEX_INPUT_RATE_INSTANCE },
+    };
+    VkPipelineVertexInputStateCreateInfo input = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+    input.vertexBindingDescriptionCount = 2;
+    input.pVertexBindingDescriptions = bindings;
+    input.vertexAttributeDescriptionCount = (uint32_t)vert_reflection.input_count;
+    input.pVertexAttributeDescriptions = attributes;
+    VkPipelineInputAssemblyStateCreateInfo assembly = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+    assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPipelineViewportStateCreateInfo viewport = { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+    viewport.viewportCount = 1;
+    viewport.scissorCount = 1;
+    VkPipelineRasterizationStateCreateInfo raster = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+    raster.polygonMode = VK_POLYGON_MODE_FILL;
+    raster.cullMode = VK_CULL_MODE_NONE;
+    raster.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    raster.lineWidth = 1.f;
+    VkPipelineMultisampleStateCreateInfo multisample = { VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkPipelineColorBlendAttachmentState blend = {};
+    blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
+        | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo colour = { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
+    colour.attachmentCount = 1;
+    colour.pAttachments = &blend;
+    const VkDynamicState dynamic_states[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic = { VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+    dynamic.dynamicStateCount = 2;
+    dynamic.pDynamicStates = dynamic_states;
+
+    VkGraphicsPipelineCreateInfo info = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+    info.stageCount = 2;
+    info.pStages = stages;
+    info.pVertexInputState = &input;
+    info.pInputAssemblyState = &assembly;
+    info.pViewportState = &viewport;
+    info.pRasterizationState = &raster;
+    info.pMultisampleState = &multisample;
+    info.pColorBlendState = &colour;
+    info.pDynamicState = &dynamic;
+    info.layout = r->layout;
+    info.renderPass = r->render_pass;
+    const VkResult result = vert && frag
+        ? vkCreateGraphicsPipelines(r->device, r->pipeline_cache, 1, &info, NULL, &r->pipeline) : VK_ERROR_INITIALIZATION_FAILED;
+    vkDestroyShaderModule(r->device, vert, NULL);
+    vkDestroyShaderModule(r->device, frag, NULL);
+    VK_CHECK(result, "vkCreateGraphicsPipelines");
+    return true;
+}
+
+// ground.frag's Ground block
+typedef struct GroundPush
+{
+    mat4x4 inverse_view_projection;
+    vec4 sun;
+    vec4 ground;
+} GroundPush;
+
+// The ground's shadows: a full-viewport triangle whose fragments trace towards the sun, blended black over what's
+// there; the structure's set, and the inverse view-projection, the sun and the plane as push constants
+static bool create_ground_pipeline(VulkanRenderer* r)
+{
+    SpirvReflection vert_reflection, frag_reflection;
+    if (!spirv_reflect(ground_vert_spv, sizeof(ground_vert_spv), &vert_reflection)
+        || !spirv_reflect(ground_frag_spv, sizeof(ground_frag_spv), &frag_reflection))
+        return false;
+    VkPushConstantRange push;
+    if (!push_constant_range(&vert_reflection, &frag_reflection, sizeof(GroundPush), "ground", &push))
+        return false;
+    r->ground_push_stages = push.stageFlags;
+    const SpirvBinding* scene = frag_reflection.bindings;
+    if (frag_reflection.binding_count != 1 || scene->set != 0 || scene->binding != 0
+        || scene->kind != SPIRV_BINDING_ACCELERATION_STRUCTURE)
+    {
+        fprintf(stderr, "vulkan: the ground shader binds more than the structure at set 0, binding 0\n");
+        return false;
+    }
+    VkPipelineLayoutCreateInfo layout = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    layout.setLayoutCount = 1;
+    layout.pSetLayouts = &r->rq.set_layout;
+    layout.pushConstantRangeCount = 1;
+    layout.pPushConstantRanges = &push;
+    VK_CHECK(vkCreatePipelineLayout(r->device, &layout, NULL, &r->ground_layout), "vkCreatePipelineLayout");
+
+    VkShaderModule vert = create_shader(r->device, ground_vert_spv, sizeof(ground_vert_spv));
+    VkShaderModule frag = create_shader(r->device, ground_frag_spv, sizeof(ground_frag_spv));
+    VkPipelineShaderStageCreateInfo stages[2] = {
+        { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, NULL, 0, VK_SHADER_STAGE_VERTEX_BIT, vert, "main", NULL },
+        { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, NULL, 0, VK_SHADER_STAGE_FRAGMENT_BIT, frag, "main", NULL },
+    };
+    VkPipelineVertexInputStateCreateInfo input = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+    VkPipelineInputAssemblyStateCreateInfo assembly = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+    assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPipelineViewportStateCreateInfo viewport = { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+    viewport.viewportCount = 1;
+    viewport.scissorCount = 1;
+    VkPipelineRasterizationStateCreateInfo raster = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+    raster.polygonMode = VK_POLYGON_MODE_FILL;
+    raster.cullMode = VK_CULL_MODE_NONE;
+    raster.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    raster.lineWidth = 1.f;
+    VkPipelineMultisampleStateCreateInfo multisample = { VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkPipelineColorBlendAttachmentState blend = {};
+    blend.blendEnable = VK_TRUE;
+    blend.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    blend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blend.colorBlendOp = VK_BLEND_OP_ADD;
+    blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blend.alphaBlendOp = VK_BLEND_OP_ADD;
+    blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT
+        | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo colour = { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
+    colour.attachmentCount = 1;
+    colour.pAttachments = &blend;
+    const VkDynamicState dynamic_states[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic = { VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+    dynamic.dynamicStateCount = 2;
+    dynamic.pDynamicStates = dynamic_states;
+
+    VkGraphicsPipelineCreateInfo info = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+    info.stageCount = 2;
+    info.pStages = stages;
+    info.pVertexInputState = &input;
+    info.pInputAssemblyState = &assembly;
+    info.pViewportState = &viewport;
+    info.pRasterizationState = &raster;
+    info.pMultisampleState = &multisample;
+    info.pColorBlendState = &colour;
+    info.pDynamicState = &dynamic;
+    info.layout = r->ground_layout;
+    info.renderPass = r->render_pass;
+    const VkResult result = vert && frag
+        ? vkCreateGraphicsPipelines(r->device, r->pipeline_cache, 1, &info, NULL, &r->ground_pipeline)
+        : VK_ERROR_INITIALIZATION_FAILED;
+    vkDestroyShaderModule(r->device, vert, NULL);
+    vkDestroyShaderModule(r->device, frag, NULL);
+    VK_CHECK(result, "vkCreateGraphicsPipelines");
+    return true;
+}
+
+// Every pipeline the frames use, a job each: the scene's, then with ray queries the ground's and the tracing ones
+typedef struct PipelineBuild
+{
+    VulkanRenderer* r;
+    size_t vertex_size;
+    bool ok[2 + VULKAN_RAY_QUERY_PIPELINES];
+} PipelineBuild;
+
+static void create_pipeline_range(void* data, size_t begin, size_t end)
+{
+    PipelineBuild* build = (PipelineBuild*)data;
+    VulkanRenderer* r = build->r;
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (i == 0)
+            build->ok[i] = create_pipeline(r, build->vertex_size);
+        else if (i == 1)
+            build->ok[i] = !r->ray_shadows || create_ground_pipeline(r);
+        else
+            build->ok[i] = vulkan_ray_query_create_pipeline(&r->rq, r->pipeline_cache, (int)i - 2);
+    }
+}
+
+static bool create_pipelines(VulkanRenderer* r, JobSystem* jobs, size_t vertex_size)
+{
+    PipelineBuild build = {};
+    build.r = r;
+    build.vertex_size = vertex_size;
+    const size_t count = r->ray_query ? 2 + VULKAN_RAY_QUERY_PIPELINES : 1;
+    const double start = glfwGetTime();
+    job_wait(jobs, job_parallel_for(jobs, create_pipeline_range, &build, count, 1));
+    r->pipeline_ms = (glfwGetTime() - start) * 1000.0;
+    r->pipelines_created = (int)count - (r->ray_query && !r->ray_shadows ? 1 : 0);
+    for (size_t i = 0; i < count; ++i)
+        if (!build.ok[i])
+            return false;
+    return true;
+}
+
+// The mesh into device-local buffers: written to a staging buffer, copied on the queue, waited for. With ray
+// queries the acceleration structure builds read them too.
+static bool upload_mesh(VulkanRenderer* r, const VulkanRendererDesc* desc)
+{
+    const VkDeviceSize vertex_bytes = desc->vertex_size * desc->vertex_count;
+    const VkDeviceSize index_bytes = sizeof(uint32_t) * desc->index_count;
+    const VkBufferUsageFlags traced = r->ray_query ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+        | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR : 0;
+    VkBuffer staging = VK_NULL_HANDLE;
+    VulkanAllocation staging_memory;
+    if (!vulkan_arena_create_buffer(&r->arena, vertex_bytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT
+            | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | traced, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &r->vertex_buffer,
+            &r->vertex_memory)
+        || !vulkan_arena_create_buffer(&r->arena, index_bytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT
+            | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | traced, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &r->index_buffer,
+            &r->index_memory)
+        || !vulkan_arena_create_buffer(&r->arena, vertex_bytes + index_bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging, &staging_memory))
+    {
+        fprintf(stderr, "vulkan: no memory for the mesh\n");
+        return false;
+    }
+    memcpy(staging_memory.mapped, desc->vertices, vertex_bytes);
+    memcpy((char*)staging_memory.mapped + vertex_bytes, desc->indices, index_bytes);
+    r->index_count = (uint32_t)desc->index_count;
+
+    VkCommandBuffer cmd = r->frames[0].primary;
+    VkCommandBufferBeginInfo begin = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &begin);
+    const VkBufferCopy vertex_copy = { 0, 0, vertex_bytes };
+    const VkBufferCopy index_copy = { vertex_bytes, 0, index_bytes };
+    vkCmdCopyBuffer(cmd, staging, r->vertex_buffer, 1, &vertex_copy);
+    vkCmdCopyBuffer(cmd, staging, r->index_buffer, 1, &index_copy);
+    vkEndCommandBuffer(cmd);
+    VkSubmitInfo submit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &cmd;
+    const bool ok = vkQueueSubmit(r->queue, 1, &submit, VK_NULL_HANDLE) == VK_SUCCESS && vkQueueWaitIdle(r->queue) == VK_SUCCESS;
+    vkResetCommandPool(r->device, r->frames[0].pool, 0);
+    vulkan_arena_destroy_buffer(&r->arena, &staging, &staging_memory);
+    return ok;
+}
+
+static bool create_frames(VulkanRenderer* r)
+{
+    for (int i = 0; i < VULKAN_FRAMES; ++i)
+    {
+        VulkanFrame* f = &r->frames[i];
+        VkFenceCreateInfo fence = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+        fence.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        VK_CHECK(vkCreateFence(r->device, &fence, NULL, &f->fence), "vkCreateFence");
+        VkSemaphoreCreateInfo semaphore = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+        VK_CHECK(vkCreateSemaphore(r->device, &semaphore, NULL, &f->image_acquired), "vkCreateSemaphore");
+
+        // Pools are reset whole once the frame's fence says the GPU is done with them
+        VkCommandPoolCreateInfo pool = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+        pool.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        pool.queueFamilyIndex = r->queue_family;
+        VkCommandBufferAllocateInfo buffer = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        buffer.commandBufferCount = 1;
+        VK_CHECK(vkCreateCommandPool(r->device, &pool, NULL, &f->pool), "vkCreateCommandPool");
+        buffer.commandPool = f->pool;
+        buffer.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        VK_CHECK(vkAllocateCommandBuffers(r->device, &buffer, &f->primary), "vkAllocateCommandBuffers");
+        buffer.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        for (int t = 0; t < r->thread_count; ++t)
+        {
+            VK_CHECK(vkCreateCommandPool(r->device, &pool, NULL, &f->thread_pools[t]), "vkCreateCommandPool");
+            buffer.commandPool = f->thread_pools[t];
+            VK_CHECK(vkAllocateCommandBuffers(r->device, &buffer, &f->secondaries[t]), "vkAllocateCommandBuffers");
+        }
+        if (r->timestamps)
+        {
+            VkQueryPoolCreateInfo query = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+            query.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            query.queryCount = VULKAN_TIMESTAMPS;
+            VK_CHECK(vkCreateQueryPool(r->device, &query, NULL, &f->timestamps), "vkCreateQueryPool");
+        }
+
+        // The compute queue's own pool, fence (signalled, like the frame's, for the first wait) and semaphore
+        if (r->async_compute)
+        {
+            pool.queueFamilyIndex = r->compute_family;
+            VK_CHECK(vkCreateCommandPool(r->device, &pool, NULL, &f->compute_pool), "vkCreateCommandPool");
+            pool.queueFamilyIndex = r->queue_family;
+            buffer.commandPool = f->compute_pool;
+            buffer.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            VK_CHECK(vkAllocateCommandBuffers(r->device, &buffer, &f->compute), "vkAllocateCommandBuffers");
+            buffer.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            VK_CHECK(vkCreateFence(r->device, &fence, NULL, &f->compute_fence), "vkCreateFence");
+            VK_CHECK(vkCreateSemaphore(r->device, &semaphore, NULL, &f->compute_done), "vkCreateSemaphore");
+        }
+
+        // With ray queries the instance shader reads the matrices and the objects' indices by address
+        const VkMemoryPropertyFlags mapped = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        const VkBufferUsageFlags traced = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+            | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        if (!vulkan_arena_create_buffer(&r->arena, sizeof(mat3x4) * (VkDeviceSize)r->max_objects,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | (r->ray_query ? traced : 0), mapped, &f->instances, &f->instance_memory))
+        {
+            fprintf(stderr, "vulkan: no memory for %u instances\n", r->max_objects);
+            return false;
+        }
+        if (!r->ray_query)
+            continue;
+        if (!vulkan_arena_create_buffer(&r->arena, sizeof(uint32_t) * (VkDeviceSize)r->max_objects, traced, mapped,
+                &f->objects, &f->object_memory)
+            || !vulkan_arena_create_buffer(&r->arena, sizeof(VulkanPickResult), traced, mapped, &f->pick,
+                &f->pick_memory))
+        {
+            fprintf(stderr, "vulkan: no memory for %u objects' indices\n", r->max_objects);
+            return false;
+        }
+        buffer.commandPool = f->pool;
+        VK_CHECK(vkAllocateCommandBuffers(r->device, &buffer, &f->ground), "vkAllocateCommandBuffers");
+    }
+    return true;
+}
+
+// A timestamp written on an idle queue, read with the trace clock halfway through the submission, and the trace's
+// tracks for the queues; the same device clock is assumed to drive every queue's timestamps
+static bool calibrate_timestamps(VulkanRenderer* r)
+{
+    r->graphics_track = r->compute_track = -1;
+    if (!r->timestamps)
+        return true;
+    VulkanFrame* f = &r->frames[0];
+    VkCommandBufferBeginInfo begin = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(f->primary, &begin);
+    vkCmdResetQueryPool(f->primary, f->timestamps, 0, 1);
+    vkCmdWriteTimestamp(f->primary, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, f->timestamps, 0);
+    vkEndCommandBuffer(f->primary);
+    VkSubmitInfo submit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &f->primary;
+    const uint64_t before = cpu_trace_now();
+    VK_CHECK(vkQueueSubmit(r->queue, 1, &submit, VK_NULL_HANDLE), "vkQueueSubmit");
+    VK_CHECK(vkQueueWaitIdle(r->queue), "vkQueueWaitIdle");
+    const uint64_t after = cpu_trace_now();
+    VK_CHECK(vkGetQueryPoolResults(r->device, f->timestamps, 0, 1, sizeof(r->sync_gpu), &r->sync_gpu,
+        sizeof(r->sync_gpu), VK_QUERY_RESULT_64_BIT), "vkGetQueryPoolResults");
+    vkResetCommandPool(r->device, f->pool, 0);
+    r->sync_ticks = before + (after - before) / 2;
+    r->graphics_track = cpu_trace_track("Vulkan graphics");
+    r->compute_track = r->graphics_track >= 0 && r->compute_timestamps ? cpu_trace_track("Vulkan compute") : -1;
+    return true;
+}
+
+// A timestamp on the trace clock
+static uint64_t trace_ticks(const VulkanRenderer* r, uint64_t gpu)
+{
+    return r->sync_ticks + (uint64_t)(int64_t)((double)(int64_t)(gpu - r->sync_gpu) * r->timestamp_ns
+        * cpu_trace_ticks_per_ns());
+}
+
+bool vulkan_renderer_init(VulkanRenderer* r, GLFWwindow* window, JobSystem* jobs, const VulkanRendererDesc* desc)
+{
+    memset(r, 0, sizeof(*r));
+    for (int i = 0; i < VULKAN_FRAMES; ++i)
+        r->frames[i].instance_memory.block = r->frames[i].object_memory.block = r->frames[i].pick_memory.block = -1;
+    r->vertex_memory.block = r->index_memory.block = -1;
+    r->window = window;
+    r->thread_count = jobs->thread_count;
+    r->max_objects = desc->max_objects ? desc->max_objects : 1;
+    r->naive = desc->naive;
+    r->vsync = desc->vsync;
+    r->ray_query = desc->ray_query;
+    r->ray_shadows = desc->ray_query && desc->ray_shadows;
+    r->ground_z = desc->ground_z;
+    r->async_compute = desc->async_compute;
+    r->graph = (FrameGraph*)malloc(sizeof(FrameGraph));
+    if (!r->graph || !create_instance(r) || !pick_device(r))
+    {
+        r->failed = true;
+        return false;
+    }
+    vulkan_arena_init(&r->arena, r->physical_device, r->device);
+    r->arena.device_address = r->ray_query;
+    r->arena.queue_families[0] = r->queue_family;
+    r->arena.queue_families[1] = r->compute_family;
+    r->arena.queue_family_count = r->async_compute && r->compute_family != r->queue_family ? 2 : 1;
+    r->failed = !create_render_pass(r) || !create_pipeline_cache(r) || !create_frames(r) || !upload_mesh(r, desc)
+        || !calibrate_timestamps(r)
+        || (r->ray_query && !vulkan_ray_query_init(&r->rq, r->physical_device, r->device, &r->arena, r->queue,
+            r->queue_family, r->vertex_buffer, desc->vertex_size, desc->vertex_count, r->index_buffer,
+            desc->index_count, r->max_objects))
+        || !create_pipelines(r, jobs, desc->vertex_size) || !create_swapchain(r);
+    r->start_time = glfwGetTime();
+    return !r->failed;
+}
+
+void vulkan_renderer_destroy(VulkanRenderer* r)
+{
+    if (r->device != VK_NULL_HANDLE)
+    {
+        vkDeviceWaitIdle(r->device);
+        if (r->pipeline_cache != VK_NULL_HANDLE)
+        {
+            save_pipeline_cache(r);
+            vkDestroyPipelineCache(r->device, r->pipeline_cache, NULL);
+        }
+        destroy_swapchain(r);
+        for (int i = 0; i < VULKAN_FRAMES; ++i)
+        {
+            VulkanFrame* f = &r->frames[i];
+            vulkan_arena_destroy_buffer(&r->arena, &f->instances, &f->instance_memory);
+            vulkan_arena_destroy_buffer(&r->arena, &f->objects, &f->object_memory);
+            vulkan_arena_destroy_buffer(&r->arena, &f->pick, &f->pick_memory);
+            for (int t = 0; t < r->thread_count; ++t)
+                if (f->thread_pools[t] != VK_NULL_HANDLE)
+                    vkDestroyCommandPool(r->device, f->thread_pools[t], NULL);
+            if (f->pool != VK_NULL_HANDLE)
+                vkDestroyCommandPool(r->device, f->pool, NULL);
+            if (f->compute_pool != VK_NULL_HANDLE)
+                vkDestroyCommandPool(r->device, f->compute_pool, NULL);
+            if (f->compute_fence != VK_NULL_HANDLE)
+                vkDestroyFence(r->device, f->compute_fence, NULL);
+            if (f->compute_done != VK_NULL_HANDLE)
+                vkDestroySemaphore(r->device, f->compute_done, NULL);
+            if (f->timestamps != VK_NULL_HANDLE)
+                vkDestroyQueryPool(r->device, f->timestamps, NULL);
+            if (f->image_acquired != VK_NULL_HANDLE)
+                vkDestroySemaphore(r->device, f->image_acquired, NULL);
+            if (f->fence != VK_NULL_HANDLE)
+                vkDestroyFence(r->device, f->fence, NULL);
+        }
+        vulkan_ray_query_destroy(&r->rq);
+        vulkan_arena_destroy_buffer(&r->arena, &r->vertex_buffer, &r->vertex_memory);
+        vulkan_arena_destroy_buffer(&r->arena, &r->index_buffer, &r->index_memory);
+        if (r->ground_pipeline != VK_NULL_HANDLE)
+            vkDestroyPipeline(r->device, r->ground_pipeline, NULL);
+        if (r->ground_layout != VK_NULL_HANDLE)
+            vkDestroyPipelineLayout(r->device, r->ground_layout, NULL);
+        if (r->pipeline != VK_NULL_HANDLE)
+            vkDestroyPipeline(r->device, r->pipeline, NULL);
+        if (r->layout != VK_NULL_HANDLE)
+            vkDestroyPipelineLayout(r->device, r->layout, NULL);
+        if (r->render_pass != VK_NULL_HANDLE)
+            vkDestroyRenderPass(r->device, r->render_pass, NULL);
+        vulkan_arena_destroy(&r->arena);
+        vkDestroyDevice(r->device, NULL);
+    }
+    if (r->surface != VK_NULL_HANDLE)
+        vkDestroySurfaceKHR(r->instance, r->surface, NULL);
+    if (r->instance != VK_NULL_HANDLE)
+        vkDestroyInstance(r->instance, NULL);
+    free(r->graph);
+    memset(r, 0, sizeof(*r));
+}
+
+static bool rebuild_swapchain(VulkanRenderer* r)
+{
+    vkDeviceWaitIdle(r->device);
+    destroy_swapchain(r);
+    return create_swapchain(r);
+}
+
+// The time both [begin, end) intervals share
+static uint64_t overlap(uint64_t begin0, uint64_t end0, uint64_t begin1, uint64_t end1)
+{
+    const uint64_t begin = begin0 > begin1 ? begin0 : begin1, end = end0 < end1 ? end0 : end1;
+    return end > begin ? end - begin : 0;
+}
+
+// The slot's last timestamps, now its fences say they're written: the queues' times and their overlap, and the
+// trace's events. The compute work is submitted first, so it may overlap the last frame's graphics as well as its
+// own frame's.
+static void read_timestamps(VulkanRenderer* r, VulkanFrame* f)
+{
+    uint64_t t[VULKAN_TIMESTAMPS];
+    const bool graphics = f->timed && vkGetQueryPoolResults(r->device, f->timestamps, 0, 2, 2 * sizeof(uint64_t), t,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+    const bool compute = f->compute_timed && vkGetQueryPoolResults(r->device, f->timestamps, 2, 2,
+        2 * sizeof(uint64_t), t + 2, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+    f->timed = f->compute_timed = false;
+    if (!graphics)
+        return;
+    const uint64_t last_begin = r->last_graphics[0], last_end = r->last_graphics[1];
+    r->last_graphics[0] = t[0];
+    r->last_graphics[1] = t[1];
+    const double ms = r->timestamp_ns * 1e-6;
+    ++r->timed_frames;
+    r->graphics_ms += (double)(t[1] - t[0]) * ms;
+    if (r->graphics_track >= 0)
+        cpu_trace_emit(r->graphics_track, "graphics", trace_ticks(r, t[0]), trace_ticks(r, t[1]));
+    if (!compute)
+        return;
+    r->compute_ms += (double)(t[3] - t[2]) * ms;
+    if (r->async_compute)
+        r->overlap_ms += (double)(overlap(t[0], t[1], t[2], t[3]) + overlap(last_begin, last_end, t[2], t[3])) * ms;
+    if (r->compute_track >= 0)
+        cpu_trace_emit(r->compute_track, "compute", trace_ticks(r, t[2]), trace_ticks(r, t[3]));
+}
+
+mat3x4* vulkan_renderer_begin_frame(VulkanRenderer* r)
+{
+    if (r->failed)
+        return NULL;
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(r->window, &width, &height);
+    if ((uint32_t)width != r->extent.width || (uint32_t)height != r->extent.height || r->swapchain == VK_NULL_HANDLE)
+        r->failed = !rebuild_swapchain(r);
+    if (r->failed || r->swapchain == VK_NULL_HANDLE)
+        return NULL;
+
+    VulkanFrame* f = &r->frames[r->frame % VULKAN_FRAMES];
+    {
+        CPU_TRACE_SCOPE("wait frame");
+        const VkFence fences[2] = { f->fence, f->compute_fence };
+        vkWaitForFences(r->device, r->async_compute ? 2 : 1, fences, VK_TRUE, UINT64_MAX);
+    }
+    read_timestamps(r, f);
+    if (f->picking)
+    {
+        // The slot's last submission traced a pick, and it's done
+        const VulkanPickResult* result = (const VulkanPickResult*)f->pick_memory.mapped;
+        r->pick_object = result->object;
+        r->pick_latency = r->frame - f->pick_frame;
+        r->pick_ready = true;
+        f->picking = false;
+    }
+    VkResult result = vkAcquireNextImageKHR(r->device, r->swapchain, UINT64_MAX, f->image_acquired, VK_NULL_HANDLE, &r->image);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        // Nothing waits on the semaphore yet, so it's unsignalled still; the next frame tries the new swapchain
+        r->failed = !rebuild_swapchain(r);
+        return NULL;
+    }
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+    {
+        fprintf(stderr, "vulkan: vkAcquireNextImageKHR failed (%d)\n", (int)result);
+        r->failed = true;
+        return NULL;
+    }
+    vkResetFences(r->device, 1, &f->fence);
+    return (mat3x4*)f->instance_memory.mapped;
+}
+
+uint32_t* vulkan_renderer_objects(VulkanRenderer* r)
+{
+    return r->ray_query ? (uint32_t*)r->frames[r->frame % VULKAN_FRAMES].object_memory.mapped : NULL;
+}
+
+void vulkan_renderer_pick(VulkanRenderer* r, const vec3 origin, const vec3 dir)
+{
+    r->pick_requested = r->ray_query;
+    vec3_dup(r->pick_origin, origin);
+    vec3_dup(r->pick_dir, dir);
+}
+
+bool vulkan_renderer_poll_pick(VulkanRenderer* r, int* object, unsigned int* frames)
+{
+    if (!r->pick_ready)
+        return false;
+    r->pick_ready = false;
+    *object = r->pick_object;
+    *frames = r->pick_latency;
+    return true;
+}
+
+typedef struct VulkanRecord
+{
+    VulkanRenderer* r;
+    VulkanFrame* f;
+    const float* view_projection;
+    uint32_t visible_count;
+    uint32_t per_draw;          // instances a draw
+} VulkanRecord;
+
+// Draws [begin, end) into the calling thread's secondary command buffer, begun (with the state every draw shares)
+// the first time the thread gets a range this frame
+static void record_range(void* data, size_t begin, size_t end)
+{
+    const VulkanRecord* rec = (const VulkanRecord*)data;
+    VulkanRenderer* r = rec->r;
+    const int t = job_thread_current();
+    VkCommandBuffer cmd = rec->f->secondaries[t];
+    if (!rec->f->recording[t])
+    {
+        rec->f->recording[t] = 1;
+        VkCommandBufferInheritanceInfo inheritance = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+        inheritance.renderPass = r->render_pass;
+        inheritance.framebuffer = r->framebuffers[r->image];
+        VkCommandBufferBeginInfo info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+        info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        info.pInheritanceInfo = &inheritance;
+        vkBeginCommandBuffer(cmd, &info);
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->pipeline);
+        // y up as in GL: the viewport starts at the bottom and has a negative height
+        const VkViewport viewport = { 0.f, (float)r->extent.height, (float)r->extent.width, -(float)r->extent.height, 0.f, 1.f };
+        const VkRect2D scissor = { { 0, 0 }, r->extent };
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+        vkCmdPushConstants(cmd, r->layout, r->push_stages, 0, sizeof(mat4x4), rec->view_projection);
+        const VkBuffer buffers[2] = { r->vertex_buffer, rec->f->instances };
+        const VkDeviceSize offsets[2] = { 0, 0 };
+        vkCmdBindVertexBuffers(cmd, 0, 2, buffers, offsets);
+        vkCmdBindIndexBuffer(cmd, r->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+    }
+    for (size_t d = begin; d < end; ++d)
+    {
+        const uint32_t first = (uint32_t)d * rec->per_draw;
+        const uint32_t count = rec->visible_count - first < rec->per_draw ? rec->visible_count - first : rec->per_draw;
+        vkCmdDrawIndexed(cmd, r->index_count, count, 0, 0, first);
+    }
+}
+
+// The ground's shadows into the frame's own secondary buffer, drawn under the objects
+static void record_ground(VulkanRenderer* r, VulkanFrame* f, int slot, mat4x4 const inverse_view_projection)
+{
+    VkCommandBufferInheritanceInfo inheritance = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+    inheritance.renderPass = r->render_pass;
+    inheritance.framebuffer = r->framebuffers[r->image];
+    VkCommandBufferBeginInfo info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    info.pInheritanceInfo = &inheritance;
+    vkBeginCommandBuffer(f->ground, &info);
+    vkCmdBindPipeline(f->ground, VK_PIPELINE_BIND_POINT_GRAPHICS, r->ground_pipeline);
+    const VkViewport viewport = { 0.f, (float)r->extent.height, (float)r->extent.width, -(float)r->extent.height, 0.f, 1.f };
+    const VkRect2D scissor = { { 0, 0 }, r->extent };
+    vkCmdSetViewport(f->ground, 0, 1, &viewport);
+    vkCmdSetScissor(f->ground, 0, 1, &scissor);
+    vkCmdBindDescriptorSets(f->ground, VK_PIPELINE_BIND_POINT_GRAPHICS, r->ground_layout, 0, 1, &r->rq.sets[slot], 0,
+        NULL);
+    // The sun as the GL --shadows one shines, and the light its shadows take
+    GroundPush push;
+    mat4x4_dup(push.inverse_view_projection, inverse_view_projection);
+    vec3 sun = { -0.35f, 0.45f, 1.f };
+    vec3_norm(sun, sun);
+    push.sun[0] = sun[0];
+    push.sun[1] = sun[1];
+    push.sun[2] = sun[2];
+    push.sun[3] = VULKAN_SHADOW_DARKNESS;
+    push.ground[0] = r->ground_z;
+    push.ground[1] = (float)r->extent.width;
+    push.ground[2] = (float)r->extent.height;
+    push.ground[3] = 0.f;
+    vkCmdPushConstants(f->ground, r->ground_layout, r->ground_push_stages, 0, sizeof(push), &push);
+    vkCmdDraw(f->ground, 3, 1, 0, 0);
+    vkEndCommandBuffer(f->ground);
+}
+
+// What the frame graph's passes record with
+typedef struct VulkanPasses
+{
+    VulkanRenderer* r;
+    VulkanFrame* f;
+    int slot;
+    VkCommandBuffer cmd;        // the running pass's queue's: the compute buffer or the primary
+    const vec4* inverse_view_projection;
+    uint32_t visible_count;
+    bool in_render_pass;        // begun by the first pass that draws
+} VulkanPasses;
+
+// Clears the image and begins the render pass, if no pass before has
+static void begin_render_pass(VulkanPasses* passes)
+{
+    if (passes->in_render_pass)
+        return;
+    VulkanRenderer* r = passes->r;
+    VkClearValue clear;
+    clear.color = { { 0.f, 0.f, 0.f, 1.f } };
+    VkRenderPassBeginInfo pass = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+    pass.renderPass = r->render_pass;
+    pass.framebuffer = r->framebuffers[r->image];
+    pass.renderArea.extent = r->extent;
+    pass.clearValueCount = 1;
+    pass.pClearValues = &clear;
+    vkCmdBeginRenderPass(passes->f->primary, &pass, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    passes->in_render_pass = true;
+}
+
+// The acceleration structure brought up to date, for the traces on its own queue and, on the graphics queue, the
+// ground's too
+static void execute_tlas_update(void* user, const FrameGraph* graph, int pass)
+{
+    VulkanPasses* passes = (VulkanPasses*)user;
+    VulkanRenderer* r = passes->r;
+    const VkPipelineStageFlags readers = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+        | (!graph->passes[pass].async && r->ray_shadows ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : 0);
+    vulkan_ray_query_update(&r->rq, passes->cmd, passes->slot, vulkan_buffer_address(r->device, passes->f->instances),
+        vulkan_buffer_address(r->device, passes->f->objects), passes->visible_count, readers);
+}
+
+static void execute_pick(void* user, const FrameGraph*, int)
+{
+    VulkanPasses* passes = (VulkanPasses*)user;
+    VulkanRenderer* r = passes->r;
+    vulkan_ray_query_pick(&r->rq, passes->cmd, passes->slot, r->pick_origin, r->pick_dir, 1.f,
+        vulkan_buffer_address(r->device, passes->f->pick));
+    r->pick_requested = false;
+    passes->f->picking = true;
+    passes->f->pick_frame = r->frame;
+}
+
+static void execute_ground(void* user, const FrameGraph*, int)
+{
+    VulkanPasses* passes = (VulkanPasses*)user;
+    begin_render_pass(passes);
+    record_ground(passes->r, passes->f, passes->slot, passes->inverse_view_projection);
+    vkCmdExecuteCommands(passes->f->primary, 1, &passes->f->ground);
+}
+
+// Every thread's secondary buffer, recorded before the graph ran
+static void execute_scene(void* user, const FrameGraph*, int)
+{
+    VulkanPasses* passes = (VulkanPasses*)user;
+    VulkanFrame* f = passes->f;
+    begin_render_pass(passes);
+    VkCommandBuffer recorded[JOB_SYSTEM_MAX_THREADS];
+    uint32_t recorded_count = 0;
+    for (int t = 0; t < passes->r->thread_count; ++t)
+        if (f->recording[t])
+        {
+            vkEndCommandBuffer(f->secondaries[t]);
+            recorded[recorded_count++] = f->secondaries[t];
+        }
+    if (recorded_count)
+        vkCmdExecuteCommands(f->primary, recorded_count, recorded);
+}
+
+// The frame's passes: with ray queries the acceleration structure's update and the pick asked for, compute passes
+// for the async queue, then the ground's shadows, waiting on the update, and the objects
+static bool build_graph(VulkanRenderer* r, VulkanPasses* passes)
+{
+    FrameGraph* g = r->graph;
+    frame_graph_reset(g);
+    const int image = frame_graph_import(g, "swapchain image", NULL, (uintptr_t)r->images[r->image], true);
+    const int instances = frame_graph_import(g, "instances", NULL, (uintptr_t)passes->f->instances, false);
+    int tlas = -1;
+    if (r->ray_query)
+    {
+        tlas = frame_graph_import(g, "tlas", NULL, (uintptr_t)r->rq.tlas[passes->slot].handle, true);
+        const int update = frame_graph_add_pass(g, "tlas update", execute_tlas_update, passes);
+        frame_graph_read(g, update, instances, FRAME_GRAPH_STORAGE);
+        frame_graph_write(g, update, tlas, FRAME_GRAPH_STORAGE);
+        if (r->async_compute)
+            frame_graph_set_async_compute(g, update);
+    }
+    if (r->ray_query && r->pick_requested)
+    {
+        const int result = frame_graph_import(g, "pick result", NULL, (uintptr_t)passes->f->pick, true);
+        const int pick = frame_graph_add_pass(g, "pick", execute_pick, passes);
+        frame_graph_read(g, pick, tlas, FRAME_GRAPH_STORAGE);
+        frame_graph_write(g, pick, result, FRAME_GRAPH_STORAGE);
+        frame_graph_set_side_effects(g, pick);      // read back by the host
+        if (r->async_compute)
+            frame_graph_set_async_compute(g, pick);
+    }
+    if (r->ray_shadows)
+    {
+        const int ground = frame_graph_add_pass(g, "ground", execute_ground, passes);
+        frame_graph_read(g, ground, tlas, FRAME_GRAPH_STORAGE);
+        frame_graph_write(g, ground, image, FRAME_GRAPH_ATTACHMENT);
+    }
+    const int scene = frame_graph_add_pass(g, "scene", execute_scene, passes);
+    frame_graph_read(g, scene, instances, FRAME_GRAPH_VERTEX);
+    if (r->ray_shadows)
+        frame_graph_read(g, scene, image, FRAME_GRAPH_ATTACHMENT);
+    frame_graph_write(g, scene, image, FRAME_GRAPH_ATTACHMENT);
+    return frame_graph_compile(g);
+}
+
+void vulkan_renderer_draw(VulkanRenderer* r, JobSystem* jobs, mat4x4 const view_projection,
+    mat4x4 const inverse_view_projection, int visible_count)
+{
+    VulkanFrame* f = &r->frames[r->frame % VULKAN_FRAMES];
+    const double record_start = glfwGetTime();
+    uint32_t draws = 0;
+    VulkanPasses passes = { r, f, (int)(r->frame % VULKAN_FRAMES), VK_NULL_HANDLE, inverse_view_projection,
+        (uint32_t)visible_count, false };
+    const FrameGraph* g = r->graph;
+    {
+        CPU_TRACE_SCOPE("record");
+        vkResetCommandPool(r->device, f->pool, 0);
+        if (r->async_compute)
+            vkResetCommandPool(r->device, f->compute_pool, 0);
+        for (int t = 0; t < r->thread_count; ++t)
+        {
+            vkResetCommandPool(r->device, f->thread_pools[t], 0);
+            f->recording[t] = 0;
+        }
+
+        // The draws, spread over the job system
+        VulkanRecord rec = { r, f, &view_projection[0][0], (uint32_t)visible_count, r->naive ? 1u : VULKAN_INSTANCES_PER_DRAW };
+        draws = (rec.visible_count + rec.per_draw - 1) / rec.per_draw;
+        if (draws)
+            job_wait(jobs, job_parallel_for(jobs, record_range, &rec, draws, r->naive ? VULKAN_NAIVE_GRAIN : 1));
+
+        if (!build_graph(r, &passes))
+        {
+            fprintf(stderr, "vulkan: the frame graph doesn't compile\n");
+            r->failed = true;
+            return;
+        }
+
+        // The compute passes are timed on the queue they run on: the compute queue's if any went there, the
+        // graphics queue's otherwise
+        const bool async = g->async_count > 0;
+        int first_compute = -1, last_compute = -1;
+        for (int step = 0; step < g->order_count; ++step)
+            if (g->passes[g->order[step]].async_compute && g->passes[g->order[step]].async == async)
+            {
+                first_compute = first_compute < 0 ? step : first_compute;
+                last_compute = step;
+            }
+        const bool time_compute = first_compute >= 0 && (async ? r->compute_timestamps : r->timestamps);
+
+        VkCommandBufferBeginInfo begin = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+        begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(f->primary, &begin);
+        if (r->timestamps)
+        {
+            vkCmdResetQueryPool(f->primary, f->timestamps, 0, async ? 2 : VULKAN_TIMESTAMPS);
+            vkCmdWriteTimestamp(f->primary, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, f->timestamps, 0);
+        }
+        if (async)
+        {
+            vkBeginCommandBuffer(f->compute, &begin);
+            if (time_compute)
+                vkCmdResetQueryPool(f->compute, f->timestamps, 2, 2);
+        }
+
+        // The passes in the graph's order, each into its queue's buffer
+        for (int step = 0; step < g->order_count; ++step)
+        {
+            const FrameGraphPass* pass = &g->passes[g->order[step]];
+            passes.cmd = pass->async ? f->compute : f->primary;
+            if (time_compute && step == first_compute)
+                vkCmdWriteTimestamp(passes.cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, f->timestamps, 2);
+            pass->execute(pass->user, g, g->order[step]);
+            if (time_compute && step == last_compute)
+                vkCmdWriteTimestamp(passes.cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, f->timestamps, 3);
+        }
+        if (passes.in_render_pass)
+            vkCmdEndRenderPass(f->primary);
+        if (r->timestamps)
+            vkCmdWriteTimestamp(f->primary, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, f->timestamps, 1);
+        vkEndCommandBuffer(f->primary);
+        if (async)
+            vkEndCommandBuffer(f->compute);
+        f->timed = r->timestamps;
+        f->compute_timed = time_compute;
+        r->compute_frames += first_compute >= 0;
+    }
+    r->record_ms += (glfwGetTime() - record_start) * 1000.0;
+
+    // The compute queue's submission first, signalling the graphics one only if a pass there waits on it
+    if (g->async_count)
+    {
+        VkSubmitInfo compute = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+        compute.commandBufferCount = 1;
+        compute.pCommandBuffers = &f->compute;
+        compute.signalSemaphoreCount = g->wait_count ? 1 : 0;
+        compute.pSignalSemaphores = &f->compute_done;
+        vkResetFences(r->device, 1, &f->compute_fence);
+        if (vkQueueSubmit(r->compute_queue, 1, &compute, f->compute_fence) != VK_SUCCESS)
+        {
+            fprintf(stderr, "vulkan: vkQueueSubmit failed on the compute queue\n");
+            r->failed = true;
+            return;
+        }
+    }
+    // The ground is what waits, and only its fragments trace
+    const VkSemaphore waits[2] = { f->image_acquired, f->compute_done };
+    const VkPipelineStageFlags wait_stages[2] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+    VkSubmitInfo submit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submit.waitSemaphoreCount = g->async_count && g->wait_count ? 2 : 1;
+    submit.pWaitSemaphores = waits;
+    submit.pWaitDstStageMask = wait_stages;
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &f->primary;
+    submit.signalSemaphoreCount = 1;
+    submit.pSignalSemaphores = &r->rendered[r->image];
+    if (vkQueueSubmit(r->queue, 1, &submit, f->fence) != VK_SUCCESS)
+    {
+        fprintf(stderr, "vulkan: vkQueueSubmit failed\n");
+        r->failed = true;
+        return;
+    }
+    VkPresentInfoKHR present = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+    present.waitSemaphoreCount = 1;
+    present.pWaitSemaphores = &r->rendered[r->image];
+    present.swapchainCount = 1;
+    present.pSwapchains = &r->swapchain;
+    present.pImageIndices = &r->image;
+    {
+        CPU_TRACE_SCOPE("present");
+        const VkResult result = vkQueuePresentKHR(r->queue, &present);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+            r->extent.width = 0;    // rebuilt at the next begin_frame
+        else if (result != VK_SUCCESS)
+            r->failed = true;
+    }
+    ++r->frame;
+    ++r->frames_drawn;
+    r->objects_drawn += (unsigned long long)visible_count;
+    r->draws += draws;
+}
+
+void vulkan_renderer_report(const VulkanRenderer* r, int object_count, FILE* out)
+{
+    const double seconds = glfwGetTime() - r->start_time;
+    const double frames = r->frames_drawn ? (double)r->frames_drawn : 1.0;
+    fprintf(out, "vulkan: %u frames, %d objects (%s), %ux%u, %.3f s\n", r->frames_drawn, object_count,
+        r->naive ? "naive" : "instanced", r->extent.width, r->extent.height, seconds);
+    fprintf(out, "  frames/s      %10.1f\n", seconds > 0.0 ? r->frames_drawn / seconds : 0.0);
+    fprintf(out, "  drawn/frame   %10.1f\n", r->objects_drawn / frames);
+    fprintf(out, "  draws/frame   %10.1f (recorded on %d threads)\n", r->draws / frames, r->thread_count);
+    fprintf(out, "  record ms     %10.3f\n", r->record_ms / frames);
+    fprintf(out, "  pipeline cache %9zu bytes read back (%s)\n", r->pipeline_cache_loaded, r->pipeline_cache_path);
+    fprintf(out, "  pipelines ms  %10.3f (%d made at init across %d threads)\n", r->pipeline_ms, r->pipelines_created,
+        r->thread_count);
+    if (r->timed_frames)
+    {
+        const double timed = (double)r->timed_frames;
+        fprintf(out, "  graphics ms   %10.3f (timestamps over %u frames)\n", r->graphics_ms / timed, r->timed_frames);
+        if (r->compute_frames)
+            fprintf(out, "  compute ms    %10.3f (%s)\n", r->compute_ms / timed,
+                r->async_compute ? "async compute queue" : "on the graphics queue");
+        if (r->async_compute)
+            fprintf(out, "  overlap ms    %10.3f (%.0f%% of the compute time)\n", r->overlap_ms / timed,
+                r->compute_ms > 0.0 ? 100.0 * r->overlap_ms / r->compute_ms : 0.0);
+    }
+    if (r->ray_query)
+        vulkan_ray_query_report(&r->rq, r->frames_drawn, out);
+    vulkan_arena_print(&r->arena, out);
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "linmath.h"
+#include "linmath_affine.h"
+#include "core/frame_graph.h"
+#include "core/job_system.h"
+#include "vk/vulkan_memory.h"
+#include "vk/vulkan_ray_query.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct GLFWwindow;
+
+// The scene drawn through Vulkan instead of OpenGL (--vulkan). It takes what
+// the GL renderer takes from a frame packet - the camera's view-projection
+// and the visible objects' model matrices, as scene_update writes them - so
+// the simulation, culling and levels of detail are the same code for both;
+// only the submission differs.
+//
+// GL records every draw on the one thread that owns the context. Here each
+// thread of the job system records its share of the frame's draws into a
+// secondary command buffer of its own (one command pool per thread per frame
+// in flight, reset whole instead of buffer by buffer), and the main thread
+// gathers them into the primary one inside the render pass. The naive mode
+// draws each object on its own, as --naive does in GL; otherwise the visible
+// objects are drawn instanced, VULKAN_INSTANCES_PER_DRAW a draw, so there
+// are still draws to spread across threads.
+//
+// Memory is managed explicitly through a VulkanArena (vk/vulkan_memory.h):
+// the mesh is copied into device-local buffers through a staging buffer,
+// and each frame in flight has a host-visible instance buffer, mapped for
+// good, that scene_update writes the model matrices straight into. The
+// pipelines come through a VkPipelineCache read from and written back to
+// shader_cache/, as the GL program binaries are (gl/program_cache.h), in a
+// file named by a program_cache_hash of the device and driver: another GPU
+// or driver finds a file of its own rather than overwriting the last one's.
+// They are all made at init, one a job across the job system's threads (the
+// cache synchronizes itself), so none is compiled mid-frame. Their vertex
+// input and push constant ranges come from the shaders' SPIR-V
+// (core/spirv_reflect.h), checked against the structs the recording pushes.
+//
+// Where the device has ray queries (vk/vulkan_ray_query.h), scene_update
+// also writes the visible objects' indices into the frame's buffer, and
+// every frame refits or rebuilds the top-level acceleration structure over
+// them before drawing. Clicks are then traced on the GPU and read back once
+// the frame's fence says so, and with "ray_shadows" a ground pass like the
+// GL --shadows one traces towards the sun from each pixel of the plane under
+// the flat scene, before the objects are drawn over it.
+//
+// The frame's passes go through a frame graph (core/frame_graph.h): the
+// acceleration structure's update and the pick are compute passes asked
+// onto an async compute queue, a queue family of its own where the device
+// has one (or a second queue of the graphics family), submitted ahead of the
+// graphics work so they overlap the last frame's drawing and this one's.
+// The ground waits on a semaphore for the update; the objects need nothing
+// from the compute queue and don't. Timestamps at the start and end of each
+// queue's submission give the time each took and how long they overlapped,
+// and go on the trace (core/cpu_trace.h) as tracks of their own.
+//
+// The camera must be a reversed-Z one: its [0, 1] depth range is Vulkan's,
+// and the viewport's negative height flips y to match GL's.
+
+#define VULKAN_FRAMES 2                     // frames in flight
+#define VULKAN_MAX_IMAGES 8                 // swapchain images
+#define VULKAN_INSTANCES_PER_DRAW 4096
+#define VULKAN_NAIVE_GRAIN 1024             // draws a job records, naive
+#define VULKAN_FIRST_INSTANCE_LOCATION 2    // scene.vert's inputs from here on are per instance
+#define VULKAN_PIPELINE_CACHE_DIR "shader_cache"   // vulkan_<key>.bin in it
+#define VULKAN_SHADOW_DARKNESS 0.55f        // of the light a shadowed ground pixel loses, as with GL's --shadows
+#define VULKAN_TIMESTAMPS 4                 // a frame's: graphics begin and end, compute begin and end
+
+// What to draw: a mesh of vertices laid out as the scene's Vertex (vec2 position, vec3 colour) with 32-bit indices
+typedef struct VulkanRendererDesc
+{
+    const void* vertices;
+    size_t vertex_size;
+    size_t vertex_count;
+    const uint32_t* indices;
+    size_t index_count;
+    uint32_t max_objects;       // instance buffer capacity
+    bool naive;                 // one draw per object
+    bool vsync;                 // FIFO presentation; mailbox (or immediate) otherwise
+    bool ray_query;             // acceleration structures and traced picks, where the device has them
+    bool ray_shadows;           // and the ground's traced shadows, with them
+    float ground_z;             // the shadows' plane
+    bool async_compute;         // compute passes on a queue of their own, where the device has one
+} VulkanRendererDesc;
+
+typedef struct VulkanFrame
+{
+    VkFence fence;                          // signalled once the GPU is done with the frame
+    VkSemaphore image_acquired;
+    VkCommandPool pool;
+    VkCommandBuffer primary;
+    VkCommandPool thread_pools[JOB_SYSTEM_MAX_THREADS];
+    VkCommandBuffer secondaries[JOB_SYSTEM_MAX_THREADS];
+    uint8_t recording[JOB_SYSTEM_MAX_THREADS];   // written by its own thread only, gathered after the jobs
+    VkBuffer instances;
+    VulkanAllocation instance_memory;
+    VkBuffer objects;                       // with ray queries: the visible objects' indices, mapped
+    VulkanAllocation object_memory;
+    VkBuffer pick;                          // a VulkanPickResult, mapped
+    VulkanAllocation pick_memory;
+    bool picking;                           // the frame's submission traces a pick
+    uint32_t pick_frame;                    // which frame asked for it
+    VkCommandBuffer ground;                 // the shadow pass, recorded on the main thread
+    VkCommandPool compute_pool;             // with an async compute queue: its family's
+    VkCommandBuffer compute;
+    VkFence compute_fence;                  // signalled once the compute queue is done with the frame
+    VkSemaphore compute_done;               // for the graphics passes that wait on the compute ones
+    VkQueryPool timestamps;                 // VULKAN_TIMESTAMPS, where the queues have them
+    bool timed;                             // the graphics submission wrote its timestamps
+    bool compute_timed;                     // and the compute one its
+} VulkanFrame;
+
+typedef struct VulkanRenderer
+{
+    GLFWwindow* window;
+    VkInstance instance;
+    VkSurfaceKHR surface;
+    VkPhysicalDevice physical_device;
+    VkPhysicalDeviceProperties properties;
+    VkDevice device;
+    uint32_t queue_family;
+    VkQueue queue;
+    bool async_compute;                     // asked for and found a queue
+    uint32_t compute_family;
+    VkQueue compute_queue;
+    VulkanArena arena;
+
+    VkSwapchainKHR swapchain;
+    VkFormat format;
+    VkExtent2D extent;
+    VkPresentModeKHR present_mode;
+    uint32_t image_count;
+    VkImage images[VULKAN_MAX_IMAGES];
+    VkImageView views[VULKAN_MAX_IMAGES];
+    VkFramebuffer framebuffers[VULKAN_MAX_IMAGES];
+    VkSemaphore rendered[VULKAN_MAX_IMAGES];     // per image: a present may still wait on the last frame's
+    VkRenderPass render_pass;
+
+    VkPipelineCache pipeline_cache;
+    char pipeline_cache_path[320];          // this device and driver's file
+    size_t pipeline_cache_loaded;           // bytes read back from it, 0 for none
+    int pipelines_created;                  // at init
+    double pipeline_ms;                     // making them
+    VkPipelineLayout layout;
+    VkPipeline pipeline;
+    VkShaderStageFlags push_stages;         // the stages the shaders' push constant blocks are in
+    VkPipelineLayout ground_layout;
+    VkPipeline ground_pipeline;
+    VkShaderStageFlags ground_push_stages;
+
+    VkBuffer vertex_buffer;
+    VkBuffer index_buffer;
+    VulkanAllocation vertex_memory;
+    VulkanAllocation index_memory;
+    uint32_t index_count;
+
+    VulkanFrame frames[VULKAN_FRAMES];
+    int thread_count;                       // the job system's: one command pool each per frame
+    uint32_t frame;                         // frames begun
+    uint32_t image;                         // this frame's swapchain image
+    uint32_t max_objects;
+    bool naive;
+    bool vsync;
+    bool failed;
+
+    bool ray_query;                         // the device has them and they were asked for
+    VulkanRayQuery rq;
+    bool ray_shadows;
+    float ground_z;
+    bool pick_requested;                    // for the next frame drawn
+    vec3 pick_origin, pick_dir;
+    bool pick_ready;                        // a result waits for vulkan_renderer_poll_pick
+    int pick_object;
+    unsigned int pick_latency;              // frames from the request to the result
+
+    FrameGraph* graph;                      // the frame's passes
+    bool timestamps;                        // the graphics queue has them
+    bool compute_timestamps;                // and the compute queue
+    double timestamp_ns;                    // a tick of the timestamps
+    uint64_t sync_gpu;                      // a timestamp and the trace clock read together
+    uint64_t sync_ticks;
+    int graphics_track, compute_track;      // the trace's, -1 when it's off
+
+    // For the report
+    unsigned int frames_drawn;
+    unsigned long long objects_drawn;
+    unsigned long long draws;
+    double record_ms;                       // recording the command buffers, summed over the frames
+    unsigned int timed_frames;              // whose timestamps were read back
+    double graphics_ms, compute_ms;         // the queues' submissions, summed over those
+    double overlap_ms;                      // the time both ran at once
+    uint64_t last_graphics[2];              // the last timed frame's graphics timestamps
+    unsigned int compute_frames;            // with compute passes, on whichever queue
+    double start_time;
+} VulkanRenderer;
+
+// Instance, device, swapchain over "window" (created with GLFW_NO_API) and the pipelines, made across "jobs"; logs
+// and returns false on failure. "jobs" records the frames, so its thread count is fixed from here on.
+bool vulkan_renderer_init(VulkanRenderer* r, GLFWwindow* window, JobSystem* jobs, const VulkanRendererDesc* desc);
+void vulkan_renderer_destroy(VulkanRenderer* r);
+
+// Waits for the frame's slot in flight and acquires a swapchain image (rebuilding the swapchain if the window
+// changed size). Returns the slot's mapped instance buffer for the model matrices, or NULL when there's nothing to
+// draw into (minimised, or failed).
+mat3x4* vulkan_renderer_begin_frame(VulkanRenderer* r);
+
+// With ray queries, the frame begun's object index buffer for scene_update (one per model matrix); NULL otherwise
+uint32_t* vulkan_renderer_objects(VulkanRenderer* r);
+
+// Records "visible_count" objects from the instance buffer across "jobs" - after the acceleration structure's update,
+// the pick asked for and the ground's shadows, with ray queries - submits (the async compute queue's passes first)
+// and presents
+void vulkan_renderer_draw(VulkanRenderer* r, JobSystem* jobs, mat4x4 const view_projection,
+    mat4x4 const inverse_view_projection, int visible_count);
+
+// Traces the ray origin + t dir, t in [0, 1], with the next frame drawn; needs ray queries
+void vulkan_renderer_pick(VulkanRenderer* r, const vec3 origin, const vec3 dir);
+// True once a pick's frame is done, with the object hit (-1 for none) and the frames it took
+bool vulkan_renderer_poll_pick(VulkanRenderer* r, int* object, unsigned int* frames);
+
+// Frame rate, draws, recording time and the queues' times since init, then the memory
+void vulkan_renderer_report(const VulkanRenderer* r, int object_count, FILE* out);
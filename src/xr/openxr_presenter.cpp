@@ -0,0 +1,510 @@
+#include "xr/openxr_presenter.h"
+
+// The platform binding's types: WGL's on Windows, GLX's (on X11) elsewhere
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#define XR_USE_PLATFORM_WIN32
+#else
+#include <GL/glx.h>
+#define XR_USE_PLATFORM_XLIB
+#endif
+#define XR_USE_GRAPHICS_API_OPENGL
+#include <openxr/openxr_platform.h>
+
+#include "core/cpu_trace.h"
+#include "gl/gl_state.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define XR_CHECK(call, what) \
+    do { XrResult result_ = (call); if (XR_FAILED(result_)) { \
+        fprintf(stderr, "openxr: %s failed (%d)\n", what, (int)result_); return false; } } while (0)
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool has_extension(const XrExtensionProperties* extensions, uint32_t count, const char* name)
+{
+    for (uint32_t i = 0; i < count; ++i)
+        if (!strcmp(extensions[i].extensionName, name))
+            return true;
+    return false;
+}
+
+#ifdef _WIN32
+typedef XrGraphicsBindingOpenGLWin32KHR ContextBinding;
+
+static bool bind_context(ContextBinding* binding)
+{
+    binding->type = XR_TYPE_GRAPHICS_BINDING_OPENGL_WIN32_KHR;
+    binding->next = NULL;
+    binding->hDC = wglGetCurrentDC();
+    binding->hGLRC = wglGetCurrentContext();
+    if (!binding->hDC || !binding->hGLRC)
+    {
+        fprintf(stderr, "openxr: no current WGL context\n");
+        return false;
+    }
+    return true;
+}
+#else
+typedef XrGraphicsBindingOpenGLXlibKHR ContextBinding;
+
+// The runtime wants the context's framebuffer configuration and visual too, found again from its ID
+static bool bind_context(ContextBinding* binding)
+{
+    binding->type = XR_TYPE_GRAPHICS_BINDING_OPENGL_XLIB_KHR;
+    binding->next = NULL;
+    Display* display = glXGetCurrentDisplay();
+    GLXContext context = glXGetCurrentContext();
+    if (!display || !context)
+    {
+        fprintf(stderr, "openxr: no current GLX context (an EGL or Wayland one can't be bound)\n");
+        return false;
+    }
+    int id = 0, count = 0;
+    glXQueryContext(display, context, GLX_FBCONFIG_ID, &id);
+    const int attributes[] = { GLX_FBCONFIG_ID, id, None };
+    GLXFBConfig* configs = glXChooseFBConfig(display, DefaultScreen(display), attributes, &count);
+    if (!configs || count < 1)
+    {
+        fprintf(stderr, "openxr: the context's GLX framebuffer configuration wasn't found\n");
+        return false;
+    }
+    XVisualInfo* visual = glXGetVisualFromFBConfig(display, configs[0]);
+    binding->xDisplay = display;
+    binding->visualid = visual ? (uint32_t)visual->visualid : 0;
+    binding->glxFBConfig = configs[0];
+    binding->glxDrawable = glXGetCurrentDrawable();
+    binding->glxContext = context;
+    if (visual)
+        XFree(visual);
+    XFree(configs);
+    return true;
+}
+#endif
+
+static bool create_swapchain(OpenXrPresenter* xr, OpenXrSwapchain* chain, int64_t format, XrSwapchainUsageFlags usage)
+{
+    XrSwapchainCreateInfo create = { XR_TYPE_SWAPCHAIN_CREATE_INFO };
+    create.usageFlags = usage | XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT;
+    create.format = format;
+    create.sampleCount = 1;
+    create.width = (uint32_t)(2 * xr->eye_width);
+    create.height = (uint32_t)xr->eye_height;
+    create.faceCount = 1;
+    create.arraySize = 1;
+    create.mipCount = 1;
+    XR_CHECK(xrCreateSwapchain(xr->session, &create, &chain->handle), "xrCreateSwapchain");
+    chain->format = format;
+    uint32_t count = 0;
+    XR_CHECK(xrEnumerateSwapchainImages(chain->handle, 0, &count, NULL), "xrEnumerateSwapchainImages");
+    if (count > OPENXR_MAX_IMAGES)
+    {
+        fprintf(stderr, "openxr: a swapchain of %u images, more than %d\n", count, OPENXR_MAX_IMAGES);
+        return false;
+    }
+    XrSwapchainImageOpenGLKHR images[OPENXR_MAX_IMAGES];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        images[i].type = XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_KHR;
+        images[i].next = NULL;
+    }
+    XR_CHECK(xrEnumerateSwapchainImages(chain->handle, count, &count, (XrSwapchainImageBaseHeader*)images),
+        "xrEnumerateSwapchainImages");
+    for (uint32_t i = 0; i < count; ++i)
+        chain->images[i] = images[i].image;
+    chain->image_count = count;
+    return true;
+}
+
+// Colour: sRGB where the runtime has it, so the values the window would show are shown as they are (the blit
+// doesn't encode them, GL_FRAMEBUFFER_SRGB being off); otherwise its first choice. Depth: the scene's own format
+// only, as a blit can't convert depth.
+static bool choose_formats(OpenXrPresenter* xr, GLenum depth_format, int64_t* color, int64_t* depth)
+{
+    uint32_t count = 0;
+    XR_CHECK(xrEnumerateSwapchainFormats(xr->session, 0, &count, NULL), "xrEnumerateSwapchainFormats");
+    if (!count)
+        return false;
+    int64_t* formats = (int64_t*)malloc(sizeof(int64_t) * count);
+    const XrResult result = xrEnumerateSwapchainFormats(xr->session, count, &count, formats);
+    *color = formats[0];
+    *depth = 0;
+    for (uint32_t i = 0; i < count && XR_SUCCEEDED(result); ++i)
+    {
+        if (formats[i] == GL_SRGB8_ALPHA8)
+            *color = GL_SRGB8_ALPHA8;
+        if (formats[i] == (int64_t)depth_format)
+            *depth = depth_format;
+    }
+    free(formats);
+    XR_CHECK(result, "xrEnumerateSwapchainFormats");
+    return true;
+}
+
+bool openxr_presenter_init(OpenXrPresenter* xr, GLenum depth_format, int* width, int* height)
+{
+    memset(xr, 0, sizeof(*xr));
+    uint32_t count = 0;
+    if (XR_FAILED(xrEnumerateInstanceExtensionProperties(NULL, 0, &count, NULL)) || !count)
+    {
+        fprintf(stderr, "openxr: no runtime found\n");
+        return false;
+    }
+    XrExtensionProperties* extensions = (XrExtensionProperties*)calloc(count, sizeof(XrExtensionProperties));
+    for (uint32_t i = 0; i < count; ++i)
+        extensions[i].type = XR_TYPE_EXTENSION_PROPERTIES;
+    const XrResult listed = xrEnumerateInstanceExtensionProperties(NULL, count, &count, extensions);
+    const bool gl = XR_SUCCEEDED(listed) && has_extension(extensions, count, XR_KHR_OPENGL_ENABLE_EXTENSION_NAME);
+    xr->depth_layer = XR_SUCCEEDED(listed)
+        && has_extension(extensions, count, XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME);
+    free(extensions);
+    if (!gl)
+    {
+        fprintf(stderr, "openxr: the runtime has no XR_KHR_opengl_enable\n");
+        return false;
+    }
+
+    const char* enabled[2] = { XR_KHR_OPENGL_ENABLE_EXTENSION_NAME, XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME };
+    XrInstanceCreateInfo create = { XR_TYPE_INSTANCE_CREATE_INFO };
+    strncpy(create.applicationInfo.applicationName, "openGLTest", XR_MAX_APPLICATION_NAME_SIZE - 1);
+    strncpy(create.applicationInfo.engineName, "openGLTest", XR_MAX_ENGINE_NAME_SIZE - 1);
+    create.applicationInfo.apiVersion = XR_MAKE_VERSION(1, 0, 0);
+    create.enabledExtensionCount = xr->depth_layer ? 2 : 1;
+    create.enabledExtensionNames = enabled;
+    XR_CHECK(xrCreateInstance(&create, &xr->instance), "xrCreateInstance");
+    XrSystemGetInfo system = { XR_TYPE_SYSTEM_GET_INFO };
+    system.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+    XR_CHECK(xrGetSystem(xr->instance, &system, &xr->system), "xrGetSystem (no headset?)");
+    XrSystemProperties properties = { XR_TYPE_SYSTEM_PROPERTIES };
+    XR_CHECK(xrGetSystemProperties(xr->instance, xr->system, &properties), "xrGetSystemProperties");
+
+    // The extension wants the runtime's GL requirements asked for before the session is made
+    PFN_xrGetOpenGLGraphicsRequirementsKHR get_requirements = NULL;
+    XR_CHECK(xrGetInstanceProcAddr(xr->instance, "xrGetOpenGLGraphicsRequirementsKHR",
+        (PFN_xrVoidFunction*)&get_requirements), "xrGetInstanceProcAddr");
+    XrGraphicsRequirementsOpenGLKHR requirements = { XR_TYPE_GRAPHICS_REQUIREMENTS_OPENGL_KHR };
+    XR_CHECK(get_requirements(xr->instance, xr->system, &requirements), "xrGetOpenGLGraphicsRequirementsKHR");
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (XR_MAKE_VERSION(major, minor, 0) < requirements.minApiVersionSupported)
+    {
+        fprintf(stderr, "openxr: %s needs GL %d.%d, the context is %d.%d\n", properties.systemName,
+            (int)XR_VERSION_MAJOR(requirements.minApiVersionSupported),
+            (int)XR_VERSION_MINOR(requirements.minApiVersionSupported), major, minor);
+        return false;
+    }
+
+    ContextBinding binding;
+    if (!bind_context(&binding))
+        return false;
+    XrSessionCreateInfo session = { XR_TYPE_SESSION_CREATE_INFO };
+    session.next = &binding;
+    session.systemId = xr->system;
+    XR_CHECK(xrCreateSession(xr->instance, &session, &xr->session), "xrCreateSession");
+    XrReferenceSpaceCreateInfo space = { XR_TYPE_REFERENCE_SPACE_CREATE_INFO };
+    space.poseInReferenceSpace.orientation.w = 1.f;
+    space.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+    XR_CHECK(xrCreateReferenceSpace(xr->session, &space, &xr->local), "xrCreateReferenceSpace (local)");
+    space.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_VIEW;
+    XR_CHECK(xrCreateReferenceSpace(xr->session, &space, &xr->head), "xrCreateReferenceSpace (view)");
+
+    // One image for both eyes, each the larger of the two's recommended size
+    XrViewConfigurationView views[2] = { { XR_TYPE_VIEW_CONFIGURATION_VIEW }, { XR_TYPE_VIEW_CONFIGURATION_VIEW } };
+    XR_CHECK(xrEnumerateViewConfigurationViews(xr->instance, xr->system, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO, 2,
+        &count, views), "xrEnumerateViewConfigurationViews");
+    if (count != 2)
+    {
+        fprintf(stderr, "openxr: %s has %u views, not a stereo pair\n", properties.systemName, count);
+        return false;
+    }
+    for (int e = 0; e < 2; ++e)
+    {
+        if ((int)views[e].recommendedImageRectWidth > xr->eye_width)
+            xr->eye_width = (int)views[e].recommendedImageRectWidth;
+        if ((int)views[e].recommendedImageRectHeight > xr->eye_height)
+            xr->eye_height = (int)views[e].recommendedImageRectHeight;
+    }
+    int64_t color_format = 0, depth = 0;
+    if (!choose_formats(xr, depth_format, &color_format, &depth)
+        || !create_swapchain(xr, &xr->color, color_format, XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT))
+        return false;
+    if (xr->depth_layer && depth
+        && !create_swapchain(xr, &xr->depth, depth, XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+        return false;
+    glGenFramebuffers(1, &xr->framebuffer);
+    xr->state = XR_SESSION_STATE_IDLE;
+    *width = 2 * xr->eye_width;
+    *height = xr->eye_height;
+    printf("openxr: %s, %dx%d an eye, depth %s\n", properties.systemName, xr->eye_width, xr->eye_height,
+        xr->depth.handle != XR_NULL_HANDLE ? "submitted" : !xr->depth_layer ? "not taken by the runtime"
+        : "not in the scene's format");
+    return true;
+}
+
+void openxr_presenter_destroy(OpenXrPresenter* xr)
+{
+    if (xr->framebuffer)
+        gl_state_delete_framebuffers(1, &xr->framebuffer);
+    if (xr->depth.handle != XR_NULL_HANDLE)
+        xrDestroySwapchain(xr->depth.handle);
+    if (xr->color.handle != XR_NULL_HANDLE)
+        xrDestroySwapchain(xr->color.handle);
+    if (xr->head != XR_NULL_HANDLE)
+        xrDestroySpace(xr->head);
+    if (xr->local != XR_NULL_HANDLE)
+        xrDestroySpace(xr->local);
+    if (xr->session != XR_NULL_HANDLE)
+        xrDestroySession(xr->session);
+    if (xr->instance != XR_NULL_HANDLE)
+        xrDestroyInstance(xr->instance);
+    memset(xr, 0, sizeof(*xr));
+}
+
+bool openxr_presenter_poll(OpenXrPresenter* xr)
+{
+    XrEventDataBuffer event = { XR_TYPE_EVENT_DATA_BUFFER };
+    while (xrPollEvent(xr->instance, &event) == XR_SUCCESS)
+    {
+        if (event.type == XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING)
+            xr->over = true;
+        else if (event.type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED)
+        {
+            xr->state = ((const XrEventDataSessionStateChanged*)&event)->state;
+            if (xr->state == XR_SESSION_STATE_READY)
+            {
+                XrSessionBeginInfo begin = { XR_TYPE_SESSION_BEGIN_INFO };
+                begin.primaryViewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+                xr->running = XR_SUCCEEDED(xrBeginSession(xr->session, &begin));
+            }
+            else if (xr->state == XR_SESSION_STATE_STOPPING)
+            {
+                xrEndSession(xr->session);
+                xr->running = false;
+            }
+            else if (xr->state == XR_SESSION_STATE_EXITING || xr->state == XR_SESSION_STATE_LOSS_PENDING)
+                xr->over = true;
+        }
+        event.type = XR_TYPE_EVENT_DATA_BUFFER;
+        event.next = NULL;
+    }
+    return !xr->over;
+}
+
+bool openxr_presenter_begin_frame(OpenXrPresenter* xr)
+{
+    if (!xr->running)
+        return false;
+    XrFrameWaitInfo wait = { XR_TYPE_FRAME_WAIT_INFO };
+    memset(&xr->frame, 0, sizeof(xr->frame));
+    xr->frame.type = XR_TYPE_FRAME_STATE;
+    const double start = now_ms();
+    {
+        CPU_TRACE_SCOPE("xrWaitFrame");
+        XR_CHECK(xrWaitFrame(xr->session, &wait, &xr->frame), "xrWaitFrame");
+    }
+    xr->wait_ms += now_ms() - start;
+    XrFrameBeginInfo begin = { XR_TYPE_FRAME_BEGIN_INFO };
+    XR_CHECK(xrBeginFrame(xr->session, &begin), "xrBeginFrame");
+    xr->frame_begun = true;
+    xr->locates = 0;
+    if (!xr->frame.shouldRender)
+        ++xr->skipped;
+    return true;
+}
+
+// A pose as a matrix, its position scaled from metres to world units
+static void pose_matrix(mat4x4 M, const XrPosef* pose, float metre)
+{
+    const quat q = { pose->orientation.x, pose->orientation.y, pose->orientation.z, pose->orientation.w };
+    mat4x4_from_quat(M, q);
+    M[3][0] = pose->position.x * metre;
+    M[3][1] = pose->position.y * metre;
+    M[3][2] = pose->position.z * metre;
+}
+
+bool openxr_presenter_locate(OpenXrPresenter* xr, float metre, mat4x4 head, CameraEye eyes[2])
+{
+    if (!xr->frame_begun)
+        return false;
+    const XrTime time = xr->frame.predictedDisplayTime;
+    XrSpaceLocation location = { XR_TYPE_SPACE_LOCATION };
+    if (XR_FAILED(xrLocateSpace(xr->head, xr->local, time, &location))
+        || !(location.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT))
+        return false;
+    if (!(location.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT))
+        location.pose.position.x = location.pose.position.y = location.pose.position.z = 0.f;   // turning only
+    XrViewLocateInfo info = { XR_TYPE_VIEW_LOCATE_INFO };
+    info.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+    info.displayTime = time;
+    info.space = xr->local;
+    XrViewState state = { XR_TYPE_VIEW_STATE };
+    XrView views[2] = { { XR_TYPE_VIEW }, { XR_TYPE_VIEW } };
+    uint32_t count = 0;
+    if (XR_FAILED(xrLocateViews(xr->session, &info, &state, 2, &count, views)) || count != 2
+        || !(state.viewStateFlags & XR_VIEW_STATE_ORIENTATION_VALID_BIT))
+        return false;
+
+    memcpy(xr->views, views, sizeof(views));
+    if (!xr->locates++)
+        xr->first_head = location.pose.orientation;
+    xr->last_head = location.pose.orientation;
+    pose_matrix(head, &location.pose, metre);
+    mat4x4 to_head;
+    mat4x4_invert(to_head, head);
+    for (int e = 0; e < 2; ++e)
+    {
+        mat4x4 eye;
+        pose_matrix(eye, &views[e].pose, metre);
+        mat4x4_mul(eyes[e].pose, to_head, eye);
+        const XrFovf* fov = &views[e].fov;
+        eyes[e].tangents[0] = tanf(fov->angleLeft);
+        eyes[e].tangents[1] = tanf(fov->angleRight);
+        eyes[e].tangents[2] = tanf(fov->angleDown);
+        eyes[e].tangents[3] = tanf(fov->angleUp);
+    }
+    return true;
+}
+
+static bool acquire(const OpenXrSwapchain* chain, GLuint* image)
+{
+    uint32_t index = 0;
+    XrSwapchainImageAcquireInfo acquire = { XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
+    XR_CHECK(xrAcquireSwapchainImage(chain->handle, &acquire, &index), "xrAcquireSwapchainImage");
+    XrSwapchainImageWaitInfo wait = { XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
+    wait.timeout = XR_INFINITE_DURATION;
+    const XrResult result = xrWaitSwapchainImage(chain->handle, &wait);
+    if (XR_FAILED(result))
+    {
+        XrSwapchainImageReleaseInfo release = { XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO };
+        xrReleaseSwapchainImage(chain->handle, &release);
+        fprintf(stderr, "openxr: xrWaitSwapchainImage failed (%d)\n", (int)result);
+        return false;
+    }
+    *image = chain->images[index];
+    return true;
+}
+
+static void release(const OpenXrSwapchain* chain)
+{
+    XrSwapchainImageReleaseInfo release = { XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO };
+    xrReleaseSwapchainImage(chain->handle, &release);
+}
+
+// The drawn corner onto this frame's images: the colour filtered where it's scaled, the depth sampled nearest
+static bool copy_frame(OpenXrPresenter* xr, GLuint color_framebuffer, GLuint depth_framebuffer, int width, int height)
+{
+    const bool depth = depth_framebuffer && xr->depth.handle != XR_NULL_HANDLE;
+    GLuint color_image = 0, depth_image = 0;
+    if (!acquire(&xr->color, &color_image))
+        return false;
+    if (depth && !acquire(&xr->depth, &depth_image))
+    {
+        release(&xr->color);
+        return false;
+    }
+    const int target_width = 2 * xr->eye_width, target_height = xr->eye_height;
+    const bool same = width == target_width && height == target_height;
+    gl_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, xr->framebuffer);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_image, 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth_image, 0);
+    gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, color_framebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, target_width, target_height, GL_COLOR_BUFFER_BIT,
+        same ? GL_NEAREST : GL_LINEAR);
+    if (depth)
+    {
+        gl_state_bind_framebuffer(GL_READ_FRAMEBUFFER, depth_framebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, target_width, target_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        release(&xr->depth);
+    }
+    release(&xr->color);
+    return true;
+}
+
+void openxr_presenter_end_frame(OpenXrPresenter* xr, GLuint color_framebuffer, GLuint depth_framebuffer, int width,
+    int height, float near_z, float far_z)
+{
+    if (!xr->frame_begun)
+        return;
+    xr->frame_begun = false;
+    CPU_TRACE_SCOPE("xrEndFrame");
+    XrCompositionLayerProjectionView views[2];
+    XrCompositionLayerDepthInfoKHR depths[2];
+    XrCompositionLayerProjection layer = { XR_TYPE_COMPOSITION_LAYER_PROJECTION };
+    const XrCompositionLayerBaseHeader* layers[1] = { (const XrCompositionLayerBaseHeader*)&layer };
+    const bool shown = color_framebuffer && xr->frame.shouldRender && xr->locates > 0
+        && copy_frame(xr, color_framebuffer, depth_framebuffer, width, height);
+    if (shown)
+    {
+        const bool depth = depth_framebuffer && xr->depth.handle != XR_NULL_HANDLE;
+        for (int e = 0; e < 2; ++e)
+        {
+            memset(&views[e], 0, sizeof(views[e]));
+            views[e].type = XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW;
+            views[e].pose = xr->views[e].pose;
+            views[e].fov = xr->views[e].fov;
+            views[e].subImage.swapchain = xr->color.handle;
+            views[e].subImage.imageRect.offset.x = e * xr->eye_width;
+            views[e].subImage.imageRect.extent.width = xr->eye_width;
+            views[e].subImage.imageRect.extent.height = xr->eye_height;
+            if (depth)
+            {
+                memset(&depths[e], 0, sizeof(depths[e]));
+                depths[e].type = XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR;
+                depths[e].subImage = views[e].subImage;
+                depths[e].subImage.swapchain = xr->depth.handle;
+                depths[e].minDepth = 0.f;
+                depths[e].maxDepth = 1.f;
+                depths[e].nearZ = near_z;
+                depths[e].farZ = far_z;
+                views[e].next = &depths[e];
+            }
+        }
+        layer.space = xr->local;
+        layer.viewCount = 2;
+        layer.views = views;
+    }
+    XrFrameEndInfo end = { XR_TYPE_FRAME_END_INFO };
+    end.displayTime = xr->frame.predictedDisplayTime;
+    end.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+    end.layerCount = shown ? 1 : 0;
+    end.layers = layers;
+    const XrResult result = xrEndFrame(xr->session, &end);
+    if (XR_FAILED(result))
+        fprintf(stderr, "openxr: xrEndFrame failed (%d)\n", (int)result);
+    ++xr->frames;
+
+    // The late latch's worth: the angle between the frame's first located head and its last
+    if (xr->locates > 1)
+    {
+        const XrQuaternionf* a = &xr->first_head;
+        const XrQuaternionf* b = &xr->last_head;
+        const float dot = fabsf(a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w);
+        const double degrees = 2.0 * acos(dot < 1.f ? dot : 1.f) * 57.29577951308232;
+        xr->late_degrees += degrees;
+        if (degrees > xr->late_max_degrees)
+            xr->late_max_degrees = degrees;
+        ++xr->latched;
+    }
+}
+
+void openxr_presenter_report(const OpenXrPresenter* xr, FILE* out)
+{
+    const double frames = xr->frames ? (double)xr->frames : 1.0;
+    fprintf(out, "openxr: %u frames, %dx%d an eye, depth %s\n", xr->frames, xr->eye_width, xr->eye_height,
+        xr->depth.handle != XR_NULL_HANDLE ? "submitted" : "not submitted");
+    fprintf(out, "  wait ms       %10.3f (in xrWaitFrame, a frame)\n", xr->wait_ms / frames);
+    fprintf(out, "  skipped       %10u (frames the runtime didn't show)\n", xr->skipped);
+    if (xr->latched)
+        fprintf(out, "  late latch    %10.3f degrees the head turned after culling, a frame (max %.3f)\n",
+            xr->late_degrees / xr->latched, xr->late_max_degrees);
+}
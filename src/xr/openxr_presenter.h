@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <openxr/openxr.h>
+
+#include "linmath.h"
+#include "scene/camera.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// The frames presented through an OpenXR runtime instead of the window's
+// swap (--xr). The session is made on the renderer's GL context
+// (XR_KHR_opengl_enable), and its frame loop takes the place of the swap
+// interval and glfwSwapBuffers:
+//
+//   xrWaitFrame blocks until the runtime wants the next frame, and says when
+//   it will be shown. openxr_presenter_begin_frame waits and begins it at
+//   the top of the loop, where a frame-rate limit would wait.
+//
+//   The head and the eyes are located for that time twice. Once before the
+//   simulation, for the camera to build its cull frustum from
+//   (camera_set_eyes), and once more just before the frame's draws are
+//   submitted: late-latched, with the tracking data that came in meanwhile,
+//   into the frame's stereo block (camera_eye_view_projection). The layer
+//   goes to the runtime with the late poses, the ones the frame was really
+//   drawn from.
+//
+//   openxr_presenter_end_frame copies the scene's colour onto a double-wide
+//   swapchain image, each eye's half its view of a projection layer, and its
+//   depth onto a depth swapchain image where the runtime takes depth
+//   (XR_KHR_composition_layer_depth), so its reprojection can move each
+//   pixel by its own depth rather than as if the scene were a plane. Then
+//   xrEndFrame presents it.
+//
+// Poses come in metres of the LOCAL space, whose origin is where the
+// camera's eye is; the scene's world units are "metre" to a metre of it.
+// The instance, system and session need the loader and a runtime: init
+// logs why and returns false without them, and the app goes on in its
+// window.
+
+#define OPENXR_MAX_IMAGES 8         // a swapchain's
+
+typedef struct OpenXrSwapchain
+{
+    XrSwapchain handle;             // XR_NULL_HANDLE for none
+    int64_t format;                 // the GL internal format
+    uint32_t image_count;
+    GLuint images[OPENXR_MAX_IMAGES];
+} OpenXrSwapchain;
+
+typedef struct OpenXrPresenter
+{
+    XrInstance instance;
+    XrSystemId system;
+    XrSession session;
+    XrSpace local;                  // the layer's space, and the eyes'
+    XrSpace head;                   // VIEW: the head
+    XrSessionState state;
+    bool running;                   // between xrBeginSession and xrEndSession
+    bool over;                      // the runtime is done with the session: the app should quit
+    bool depth_layer;               // XR_KHR_composition_layer_depth was there
+
+    OpenXrSwapchain color;          // both eyes side by side
+    OpenXrSwapchain depth;          // the same, for the depth; no handle where the runtime takes none
+    GLuint framebuffer;             // the acquired images attached, blitted into
+    int eye_width, eye_height;      // each eye's half of the images
+
+    XrFrameState frame;             // the last xrWaitFrame's
+    bool frame_begun;               // xrBeginFrame'd, not yet ended
+    XrView views[2];                // the last located: the layer's
+    int locates;                    // this frame's
+    XrQuaternionf first_head;       // this frame's first located head and its last: how far the late latch moved it
+    XrQuaternionf last_head;
+
+    // For the report
+    unsigned int frames;            // ended
+    unsigned int skipped;           // the runtime said not to render
+    double wait_ms;                 // in xrWaitFrame, summed
+    double late_degrees;            // how far the head turned between a frame's first and last locate, summed
+    double late_max_degrees;
+    unsigned int latched;           // frames located more than once
+} OpenXrPresenter;
+
+// Needs the renderer's context current. Makes the instance, session, spaces and swapchains, the depth one in
+// "depth_format" (the scene's depth texture's) if the runtime takes depth in it. *width x *height is the size to
+// draw at: both eyes' recommended sizes side by side. Returns false, logging why, when there's no runtime or it
+// can't present this context.
+bool openxr_presenter_init(OpenXrPresenter* xr, GLenum depth_format, int* width, int* height);
+
+// Needs the context current. Safe after a failed init.
+void openxr_presenter_destroy(OpenXrPresenter* xr);
+
+// Handles the runtime's events: begins the session once it's ready and ends it when it's stopping. Returns false
+// once the session is over, lost or exited.
+bool openxr_presenter_poll(OpenXrPresenter* xr);
+
+// xrWaitFrame and xrBeginFrame. Returns false while the session isn't running: there's no frame to draw for.
+bool openxr_presenter_begin_frame(OpenXrPresenter* xr);
+
+// Whether the begun frame is shown at all; when not, end it undrawn
+static inline bool openxr_presenter_should_render(const OpenXrPresenter* xr)
+{
+    return xr->frame.shouldRender;
+}
+
+// The head in the LOCAL space and the eyes in the head's, where the runtime predicts them at the begun frame's
+// display, in world units of "metre" a metre. Returns false, leaving them, while the head isn't tracked.
+bool openxr_presenter_locate(OpenXrPresenter* xr, float metre, mat4x4 head, CameraEye eyes[2]);
+
+// Copies the "width" x "height" corner of "color_framebuffer" (and of "depth_framebuffer"'s depth, 0 for none)
+// onto the frame's swapchain images, scaled to fill them, and ends the frame with them as a projection layer at
+// the views last located. Depth 0 is "near_z" metres away and 1 "far_z" (near_z > far_z for reversed Z).
+// "color_framebuffer" 0 ends the frame with nothing to show.
+void openxr_presenter_end_frame(OpenXrPresenter* xr, GLuint color_framebuffer, GLuint depth_framebuffer, int width,
+    int height, float near_z, float far_z);
+
+void openxr_presenter_report(const OpenXrPresenter* xr, FILE* out);
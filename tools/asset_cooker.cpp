@@ -0,0 +1,553 @@
+// Offline asset cooker: imports glTF 2.0 models (.gltf or .glb, asset/gltf.h) and writes what the runtime maps
+// without parsing - one mesh file per mesh (asset/mesh_cook.h: cache and fetch order, levels of detail, meshlets,
+// packed vertices) and a scene file of the node instances (scene/scene_file.h) with its BVH, naming those mesh
+// files. INPUT is one model, cooked into OUTDIR, or a directory whose models (found recursively) each cook into
+// OUTDIR/<path without extension>.
+//
+// Everything runs on the job system: a job per model, each cooking its meshes as jobs of their own, so one big
+// model and many small ones both fill the threads. A model whose inputs and settings hash to a cook already done
+// (asset/asset_cache.h) isn't cooked: when OUTDIR already holds its outputs it's up to date, otherwise they're
+// restored from the local or shared cache. Input hashes are remembered by file size and time, so an unchanged
+// asset set costs a stat per file.
+//
+// With --package FILE, every model's mesh and scene files are then also written into one asset package
+// (asset/asset_package.h), compressed on the job system: the app reads them out of it by the same paths.
+//
+// A node's world matrix becomes the scene's transform: its translation, its rotation about Z and its uniform
+// scale (the length of its first column), which is all the scene keeps. Bounds are the mesh's box through the
+// full matrix, so they stay right whatever was dropped.
+//
+// --streams auto|interleaved|split chooses how vertices are stored (asset/mesh_cook.h's MeshCookStreams): by
+// default each mesh big enough to gain from it gets a position stream of its own.
+//
+// --static-batch CELL merges the instances of meshes with the same material in each CELL-sized cube of the world
+// into one mesh of pre-transformed vertices and one entity (asset/static_batch.h); the meshes no instance still
+// uses on its own aren't written.
+//
+// Usage: asset_cooker INPUT OUTDIR [--jobs N] [--float-positions] [--lod-ratio R] [--lods N] [--no-meshlets]
+//                     [--streams auto|interleaved|split] [--static-batch CELL] [--cache DIR] [--shared-cache DIR]
+//                     [--no-cache] [--package FILE]
+
+#include "asset/asset_cache.h"
+#include "asset/asset_package.h"
+#include "asset/gltf.h"
+#include "asset/mesh_cook.h"
+#include "asset/mesh_file.h"
+#include "asset/static_batch.h"
+#include "core/job_system.h"
+#include "scene/bvh.h"
+#include "scene/scene_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <filesystem>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Bump whenever the cooked output changes for the same input and settings, so cached cooks miss
+#define ASSET_COOKER_VERSION 1
+
+typedef enum ModelStatus
+{
+    MODEL_FAILED,
+    MODEL_UP_TO_DATE,
+    MODEL_RESTORED,
+    MODEL_RESTORED_SHARED,
+    MODEL_COOKED
+} ModelStatus;
+
+typedef struct CookModel
+{
+    std::string input;
+    std::string out_dir;
+    ModelStatus status;
+    uint32_t mesh_count;
+    uint32_t failed_meshes;
+    uint32_t entity_count;
+    uint64_t triangles;
+    uint64_t meshlets;
+    uint32_t skipped_primitives;
+    uint32_t batches;
+    uint32_t batched_instances;
+    double ms;
+    std::vector<std::string> mesh_paths;
+    std::vector<MeshCookResult> results;
+} CookModel;
+
+typedef struct CookRun
+{
+    JobSystem* jobs;
+    AssetCache* cache;
+    const MeshCookOptions* options;
+    float batch_cell;           // --static-batch, 0 for none
+    CookModel* models;
+} CookRun;
+
+typedef struct MeshBatch
+{
+    const GltfMesh* const* meshes;
+    const MeshCookOptions* options;
+    CookModel* model;
+    bool* cooked;
+} MeshBatch;
+
+static void cook_mesh_range(void* data, size_t begin, size_t end)
+{
+    MeshBatch* batch = (MeshBatch*)data;
+    for (size_t m = begin; m < end; ++m)
+        batch->cooked[m] = mesh_cook(batch->meshes[m], batch->options, batch->model->mesh_paths[m].c_str(),
+            &batch->model->results[m]);
+}
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// "name" with anything but letters, digits, '-' and '_' replaced, so it's a file name on every system
+static std::string file_stem(const char* name)
+{
+    std::string stem;
+    for (const char* c = name; *c; ++c)
+        stem += (isalnum((unsigned char)*c) || *c == '-' || *c == '_') ? *c : '_';
+    return stem;
+}
+
+static void add_buffer_file(void* user, const char* file)
+{
+    ((std::vector<std::string>*)user)->push_back(file);
+}
+
+// Everything the outputs depend on: the cooker, the formats, the settings, the output directory (the scene
+// names its meshes by path) and the bytes of the model and its buffer files (whose names are in the model)
+static bool model_key(AssetCache* cache, const CookRun* run, const CookModel* model, uint64_t* key)
+{
+    const MeshCookOptions* options = run->options;
+    uint64_t k = asset_hash(0, "asset_cooker", 12);
+    const uint64_t versions[] = { ASSET_COOKER_VERSION, MESH_FILE_VERSION, SCENE_FILE_VERSION };
+    for (uint64_t v : versions)
+        k = asset_hash_value(k, v);
+    uint32_t ratio_bits;
+    memcpy(&ratio_bits, &options->lod_ratio, sizeof(ratio_bits));
+    k = asset_hash_value(k, (uint64_t)options->float_positions << 40 | (uint64_t)options->meshlets << 32 | ratio_bits);
+    k = asset_hash_value(k, (uint64_t)options->max_lods);
+    k = asset_hash_value(k, (uint64_t)options->streams);
+    if (run->batch_cell > 0.f)
+    {
+        uint32_t cell_bits;
+        memcpy(&cell_bits, &run->batch_cell, sizeof(cell_bits));
+        k = asset_hash_value(k, (uint64_t)1 << 32 | cell_bits);
+    }
+    k = asset_hash(k, model->out_dir.data(), model->out_dir.size());
+    std::vector<std::string> files(1, model->input);
+    if (!gltf_buffer_files(model->input.c_str(), add_buffer_file, &files))
+        return false;
+    for (const std::string& file : files)
+    {
+        uint64_t hash;
+        if (!asset_cache_file_hash(cache, file.c_str(), &hash))
+            return false;
+        k = asset_hash_value(k, hash);
+    }
+    *key = k;
+    return true;
+}
+
+// Imports, cooks and writes one model; true when every mesh and the scene were written
+static bool cook_model(const CookRun* run, CookModel* model)
+{
+    GltfScene scene;
+    if (!gltf_load(&scene, model->input.c_str()))
+        return false;
+    std::error_code ec;
+    std::filesystem::create_directories(model->out_dir, ec);
+    if (ec)
+    {
+        fprintf(stderr, "asset_cooker: can't create %s: %s\n", model->out_dir.c_str(), ec.message().c_str());
+        gltf_free(&scene);
+        return false;
+    }
+    StaticBatches batches;
+    memset(&batches, 0, sizeof(batches));
+    if (run->batch_cell > 0.f && !static_batch_build(&batches, &scene, run->batch_cell))
+    {
+        gltf_free(&scene);
+        return false;
+    }
+
+    // What's cooked: every mesh, or with batching the batches and the meshes an instance still uses alone
+    std::vector<const GltfMesh*> sources;
+    std::vector<uint32_t> source_of(scene.mesh_count, UINT32_MAX);
+    for (uint32_t m = 0; m < scene.mesh_count; ++m)
+    {
+        bool used = !batches.batched;
+        for (uint32_t i = 0; i < scene.instance_count && !used; ++i)
+            used = scene.instances[i].mesh == m && !batches.batched[i];
+        if (!used)
+            continue;
+        source_of[m] = (uint32_t)sources.size();
+        sources.push_back(&scene.meshes[m]);
+        model->mesh_paths.push_back(model->out_dir + "/" + std::to_string(m) + "_" + file_stem(scene.meshes[m].name)
+            + ".mesh");
+    }
+    const uint32_t first_batch = (uint32_t)sources.size();
+    for (uint32_t b = 0; b < batches.batch_count; ++b)
+    {
+        sources.push_back(&batches.batches[b].mesh);
+        model->mesh_paths.push_back(model->out_dir + "/" + batches.batches[b].mesh.name + ".mesh");
+    }
+    const uint32_t source_count = (uint32_t)sources.size();
+    model->mesh_count = source_count;
+    model->skipped_primitives = scene.skipped_primitives;
+    model->batches = batches.batch_count;
+    model->batched_instances = batches.batched_count;
+    model->results.resize(source_count);
+    std::vector<char> cooked(source_count + 1, 0);
+    MeshBatch batch = { sources.data(), run->options, model, (bool*)cooked.data() };
+    job_wait(run->jobs, job_parallel_for(run->jobs, cook_mesh_range, &batch, source_count, 1));
+
+    // One entity per instance of a mesh that cooked, and one per batch
+    std::vector<float> x, y, z, angle, scale, radius;
+    std::vector<uint32_t> mesh, material;
+    std::vector<Aabb> bounds;
+    for (uint32_t m = 0; m < source_count; ++m)
+    {
+        model->failed_meshes += !cooked[m];
+        model->triangles += cooked[m] ? model->results[m].index_count / 3 : 0;
+        model->meshlets += cooked[m] ? model->results[m].meshlet_count : 0;
+    }
+    for (uint32_t i = 0; i < scene.instance_count; ++i)
+    {
+        const GltfInstance* instance = &scene.instances[i];
+        const uint32_t source = source_of[instance->mesh];
+        if ((batches.batched && batches.batched[i]) || !cooked[source])
+            continue;
+        const MeshCookResult* r = &model->results[source];
+        const float s = sqrtf(instance->world[0][0] * instance->world[0][0] + instance->world[0][1] * instance->world[0][1]
+            + instance->world[0][2] * instance->world[0][2]);
+        x.push_back(instance->world[3][0]);
+        y.push_back(instance->world[3][1]);
+        z.push_back(instance->world[3][2]);
+        angle.push_back(atan2f(instance->world[0][1], instance->world[0][0]));
+        scale.push_back(s);
+        mesh.push_back(source);
+        material.push_back(0);
+        radius.push_back(r->radius * s);
+        Aabb box;
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            const vec4 local = { corner & 1 ? r->max[0] : r->min[0], corner & 2 ? r->max[1] : r->min[1],
+                corner & 4 ? r->max[2] : r->min[2], 1.f };
+            vec4 world;
+            mat4x4_mul_vec4(world, instance->world, local);
+            for (int c = 0; c < 3; ++c)
+            {
+                box.min[c] = corner ? fminf(box.min[c], world[c]) : world[c];
+                box.max[c] = corner ? fmaxf(box.max[c], world[c]) : world[c];
+            }
+        }
+        bounds.push_back(box);
+    }
+    for (uint32_t b = 0; b < batches.batch_count; ++b)
+    {
+        // Already in world space about its centre: no turn, no scale, its box as stored
+        const uint32_t source = first_batch + b;
+        if (!cooked[source])
+            continue;
+        const MeshCookResult* r = &model->results[source];
+        const float* center = batches.batches[b].center;
+        x.push_back(center[0]);
+        y.push_back(center[1]);
+        z.push_back(center[2]);
+        angle.push_back(0.f);
+        scale.push_back(1.f);
+        mesh.push_back(source);
+        material.push_back(0);
+        radius.push_back(r->radius);
+        Aabb box;
+        for (int c = 0; c < 3; ++c)
+        {
+            box.min[c] = center[c] + r->min[c];
+            box.max[c] = center[c] + r->max[c];
+        }
+        bounds.push_back(box);
+    }
+    static_batch_free(&batches);
+
+    const uint32_t count = (uint32_t)x.size();
+    model->entity_count = count;
+    std::vector<const char*> names(source_count);
+    for (uint32_t m = 0; m < source_count; ++m)
+        names[m] = model->mesh_paths[m].c_str();
+    bool ok = model->failed_meshes == 0;
+    if (count)
+    {
+        Bvh bvh;
+        const bool built = bvh_init(&bvh, count);
+        if (built)
+            bvh_build(&bvh, bounds.data(), count);
+        const SceneEntities entities = { count, x.data(), y.data(), z.data(), angle.data(), scale.data(), mesh.data(),
+            material.data(), radius.data(), bounds.data() };
+        ok = scene_file_write((model->out_dir + "/scene.scene").c_str(), &entities, names.data(), source_count, 0,
+            built ? &bvh : NULL) && ok;
+        bvh_destroy(&bvh);
+    }
+    else
+        fprintf(stderr, "Warning: %s places no meshes; no scene written\n", model->input.c_str());
+    gltf_free(&scene);
+    return ok;
+}
+
+static void cook_model_range(void* data, size_t begin, size_t end)
+{
+    const CookRun* run = (const CookRun*)data;
+    for (size_t i = begin; i < end; ++i)
+    {
+        CookModel* model = &run->models[i];
+        const double start = now_ms();
+        uint64_t key;
+        model->status = MODEL_FAILED;
+        const bool keyed = model_key(run->cache, run, model, &key);
+        if (keyed && asset_cache_up_to_date(model->out_dir.c_str(), key))
+            model->status = MODEL_UP_TO_DATE;
+        else if (keyed)
+        {
+            const AssetCacheResult found = asset_cache_restore(run->cache, key, model->out_dir.c_str());
+            if (found != ASSET_CACHE_MISS)
+                model->status = found == ASSET_CACHE_SHARED ? MODEL_RESTORED_SHARED : MODEL_RESTORED;
+            else if (cook_model(run, model))
+            {
+                // Only complete cooks are cached; a failed one is retried next time
+                std::vector<std::string> outputs;
+                for (const std::string& path : model->mesh_paths)
+                    outputs.push_back(std::filesystem::path(path).filename().string());
+                if (model->entity_count)
+                    outputs.push_back("scene.scene");
+                std::vector<const char*> names;
+                for (const std::string& name : outputs)
+                    names.push_back(name.c_str());
+                asset_cache_store(run->cache, key, model->out_dir.c_str(), names.data(), (uint32_t)names.size());
+                model->status = MODEL_COOKED;
+            }
+        }
+        model->ms = now_ms() - start;
+    }
+}
+
+static bool is_model(const std::filesystem::path& path)
+{
+    std::string ext = path.extension().string();
+    for (char& c : ext)
+        c = (char)tolower((unsigned char)c);
+    return ext == ".gltf" || ext == ".glb";
+}
+
+// The models under "input" and where each cooks to; one model straight into "out_dir" when "input" is a file
+static bool find_models(const char* input, const char* out_dir, std::vector<CookModel>* models)
+{
+    std::error_code ec;
+    if (!std::filesystem::is_directory(input, ec))
+    {
+        models->push_back(CookModel());
+        models->back().input = input;
+        models->back().out_dir = out_dir;
+        return true;
+    }
+    std::vector<std::filesystem::path> found;
+    for (std::filesystem::recursive_directory_iterator it(input, ec), end; !ec && it != end; it.increment(ec))
+        if (it->is_regular_file(ec) && is_model(it->path()))
+            found.push_back(it->path());
+    if (ec)
+    {
+        fprintf(stderr, "asset_cooker: can't list %s: %s\n", input, ec.message().c_str());
+        return false;
+    }
+    std::sort(found.begin(), found.end());
+    for (const std::filesystem::path& path : found)
+    {
+        const std::string dir = (std::filesystem::path(out_dir) / std::filesystem::relative(path, input, ec))
+            .replace_extension().generic_string();
+        if (!models->empty() && models->back().out_dir == dir)
+        {
+            fprintf(stderr, "Warning: %s ignored: it cooks to the same directory as %s\n", path.string().c_str(),
+                models->back().input.c_str());
+            continue;
+        }
+        models->push_back(CookModel());
+        models->back().input = path.generic_string();
+        models->back().out_dir = dir;
+    }
+    return true;
+}
+
+static bool is_output(const std::filesystem::path& path)
+{
+    const std::string ext = path.extension().string();
+    return ext == ".mesh" || ext == ".scene";
+}
+
+// Packs every cooked model's outputs, named by the paths the scene files use for them
+static bool write_package(const char* path, const std::vector<CookModel>& models, JobSystem* jobs)
+{
+    std::vector<std::string> names;
+    for (const CookModel& model : models)
+    {
+        if (model.status == MODEL_FAILED)
+            continue;
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it(model.out_dir, ec), end; !ec && it != end; it.increment(ec))
+            if (it->is_regular_file(ec) && is_output(it->path()))
+                names.push_back(model.out_dir + "/" + it->path().filename().generic_string());
+    }
+    std::vector<MappedFile> files(names.size());
+    std::vector<PackageInput> inputs(names.size());
+    bool ok = true;
+    for (size_t i = 0; i < names.size() && ok; ++i)
+    {
+        ok = mapped_file_open(&files[i], names[i].c_str());
+        inputs[i] = { names[i].c_str(), files[i].data, files[i].size };
+    }
+    const double start = now_ms();
+    PackageWriteResult result;
+    ok = ok && package_write(path, inputs.data(), (uint32_t)inputs.size(), PACKAGE_DEFAULT_BLOCK_SIZE, jobs, &result);
+    if (ok)
+        printf("asset_cooker: %zu files packaged into %s, %.1f MB to %.1f MB (%u of %u blocks stored), %.1f ms\n",
+            names.size(), path, result.bytes / 1e6, result.packed_bytes / 1e6, result.stored_blocks, result.blocks,
+            now_ms() - start);
+    for (MappedFile& file : files)
+        mapped_file_close(&file);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    MeshCookOptions options;
+    mesh_cook_default_options(&options);
+    int threads = 0;
+    const char* input = NULL;
+    const char* out_dir = NULL;
+    const char* cache_dir = NULL;
+    const char* shared_dir = NULL;
+    const char* package_path = NULL;
+    bool use_cache = true;
+    float batch_cell = 0.f;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--jobs") && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--float-positions"))
+            options.float_positions = true;
+        else if (!strcmp(argv[i], "--lod-ratio") && i + 1 < argc)
+            options.lod_ratio = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--lods") && i + 1 < argc)
+            options.max_lods = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--no-meshlets"))
+            options.meshlets = false;
+        else if (!strcmp(argv[i], "--streams") && i + 1 < argc)
+        {
+            const char* streams = argv[++i];
+            if (!strcmp(streams, "auto") || !strcmp(streams, "interleaved") || !strcmp(streams, "split"))
+                options.streams = streams[0] == 'a' ? MESH_COOK_STREAMS_AUTO
+                    : streams[0] == 'i' ? MESH_COOK_STREAMS_INTERLEAVED : MESH_COOK_STREAMS_SPLIT;
+            else
+                fprintf(stderr, "Warning: --streams %s ignored (auto, interleaved or split)\n", streams);
+        }
+        else if (!strcmp(argv[i], "--static-batch") && i + 1 < argc)
+            batch_cell = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc)
+            cache_dir = argv[++i];
+        else if (!strcmp(argv[i], "--shared-cache") && i + 1 < argc)
+            shared_dir = argv[++i];
+        else if (!strcmp(argv[i], "--no-cache"))
+            use_cache = false;
+        else if (!strcmp(argv[i], "--package") && i + 1 < argc)
+            package_path = argv[++i];
+        else if (!input)
+            input = argv[i];
+        else if (!out_dir)
+            out_dir = argv[i];
+        else
+            fprintf(stderr, "Warning: unknown argument %s ignored\n", argv[i]);
+    }
+    if (!input || !out_dir)
+    {
+        fprintf(stderr, "usage: asset_cooker INPUT OUTDIR [--jobs N] [--float-positions] [--lod-ratio R] [--lods N] "
+                        "[--no-meshlets] [--streams auto|interleaved|split] [--static-batch CELL] [--cache DIR] "
+                        "[--shared-cache DIR] [--no-cache] [--package FILE]\n");
+        return 2;
+    }
+    if (!(options.lod_ratio > 0.f && options.lod_ratio < 1.f))
+    {
+        fprintf(stderr, "Warning: --lod-ratio %g ignored (0 to 1)\n", options.lod_ratio);
+        options.lod_ratio = 0.5f;
+    }
+    if (!(batch_cell >= 0.f && batch_cell < INFINITY))
+    {
+        fprintf(stderr, "Warning: --static-batch %g ignored (a cell size in world units)\n", batch_cell);
+        batch_cell = 0.f;
+    }
+
+    const double start = now_ms();
+    std::vector<CookModel> models;
+    if (!find_models(input, out_dir, &models))
+        return 1;
+    // The local cache sits with the outputs unless told otherwise; --no-cache still skips up-to-date models
+    const std::string default_cache = std::string(out_dir) + "/.cache";
+    AssetCache cache;
+    if (!asset_cache_init(&cache, use_cache ? (cache_dir ? cache_dir : default_cache.c_str()) : NULL,
+            use_cache ? shared_dir : NULL))
+        return 1;
+    JobSystem jobs;
+    if (!job_system_init(&jobs, threads))
+    {
+        fprintf(stderr, "asset_cooker: can't start the job system\n");
+        asset_cache_destroy(&cache);
+        return 1;
+    }
+    CookRun run = { &jobs, &cache, &options, batch_cell, models.data() };
+    job_wait(&jobs, job_parallel_for(&jobs, cook_model_range, &run, models.size(), 1));
+    const bool packaged = !package_path || write_package(package_path, models, &jobs);
+    const int thread_count = jobs.thread_count;
+    job_system_destroy(&jobs);
+    asset_cache_destroy(&cache);
+    const double done = now_ms();
+
+    uint32_t counts[MODEL_COOKED + 1] = {};
+    for (const CookModel& model : models)
+    {
+        ++counts[model.status];
+        if (model.status == MODEL_FAILED)
+            fprintf(stderr, "asset_cooker: %s failed\n", model.input.c_str());
+        if (model.status != MODEL_COOKED)
+            continue;
+        if (models.size() == 1)
+        {
+            for (uint32_t m = 0; m < model.mesh_count; ++m)
+            {
+                const MeshCookResult* r = &model.results[m];
+                printf("  %-40s %8u vertices %9u triangles %u levels %6u meshlets, acmr %.2f -> %.2f%s\n",
+                    model.mesh_paths[m].c_str(), r->vertex_count, r->index_count / 3, r->lod_count, r->meshlet_count,
+                    r->acmr_before, r->acmr_after, r->split ? ", split" : "");
+            }
+        }
+        char batched[80] = "";
+        if (batch_cell > 0.f)
+            snprintf(batched, sizeof(batched), " (%u instances in %u static batches)", model.batched_instances,
+                model.batches);
+        printf("  %s: %u meshes, %llu triangles, %llu meshlets, %u entities%s%s, %.1f ms\n", model.input.c_str(),
+            model.mesh_count, (unsigned long long)model.triangles, (unsigned long long)model.meshlets,
+            model.entity_count, batched, model.skipped_primitives ? " (primitives skipped: not triangles, or sparse)"
+            : "", model.ms);
+    }
+    printf("asset_cooker: %zu models: %u up to date, %u restored (%u from the shared cache), %u cooked, %u failed\n",
+        models.size(), counts[MODEL_UP_TO_DATE], counts[MODEL_RESTORED] + counts[MODEL_RESTORED_SHARED],
+        counts[MODEL_RESTORED_SHARED], counts[MODEL_COOKED], counts[MODEL_FAILED]);
+    printf("asset_cooker: %u files hashed (%.1f MB), %u hashes remembered, %.1f ms on %d threads\n",
+        cache.hashed_files.load(), cache.hashed_bytes.load() / 1e6, cache.stamp_hits.load(), done - start, thread_count);
+    return counts[MODEL_FAILED] || !packaged ? 1 : 0;
+}
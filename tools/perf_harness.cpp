@@ -0,0 +1,531 @@
+// Performance regression harness: runs the headless app over benchmark scene presets (scene/bench_scene.h) and
+// linmath_bench, each several times, and compares every measurement against this machine's baseline
+// (core/perf_stats.h). Exits 1 when something got significantly slower, so a build step or CI job can fail on it.
+//
+// An app run is `APP --headless FRAMES --bench-scene PRESET --profile-csv ...`; its first tenth of frames (at least
+// 10) warm up, and each profiler scope's CPU and GPU milliseconds a frame over the rest are one sample of
+// "app/PRESET/SCOPE/cpu_ms" and ".../gpu_ms". A linmath_bench run is `--json`, and each op's ns/op at each batch
+// is one sample of "linmath/OP/BATCH". Scopes taking under --floor ms on both sides are reported but can't fail:
+// at a few microseconds the timer's own jitter is a large share.
+//
+// Baselines are DIR/MACHINE.json, a summary (count, mean, standard deviation) per metric; the machine defaults to
+// the host name, since timings only compare on the same hardware. --update-baseline writes this run's summaries
+// into it (metrics not measured this time are kept). With no baseline yet, the run is reported and the harness
+// exits 0 with a hint to record one.
+//
+// --report PREFIX writes PREFIX.json and PREFIX.html: every metric's baseline and current mean with its confidence
+// interval, the change and the verdict, regressions first.
+//
+// Usage: perf_harness [--app PATH] [--linmath PATH] [--runs N] [--frames N] [--preset SPEC]... [--linmath-filter S]
+//                     [--baselines DIR] [--machine NAME] [--update-baseline] [--report PREFIX] [--confidence C]
+//                     [--threshold F] [--floor MS]
+// Exit codes: 0 nothing regressed, 1 something did, 2 a run failed or the arguments were wrong.
+
+#include "asset/json.h"
+#include "core/perf_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <filesystem>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <unistd.h>
+#endif
+
+typedef struct HarnessOptions
+{
+    const char* app;
+    const char* linmath;
+    int runs;
+    int frames;
+    std::vector<std::string> presets;
+    const char* linmath_filter;
+    std::string baselines;
+    std::string machine;
+    bool update_baseline;
+    const char* report;
+    double confidence;
+    double threshold;
+    double floor_ms;
+} HarnessOptions;
+
+// Every run's value of each metric, by name
+typedef std::map<std::string, std::vector<double>> Samples;
+
+typedef struct MetricResult
+{
+    std::string name;
+    PerfSummary baseline;       // n == 0: none recorded
+    PerfSummary current;
+    PerfComparison comparison;
+    bool floored;               // both under --floor: never a regression
+} MetricResult;
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string quote(const std::string& s)
+{
+    return "\"" + s + "\"";
+}
+
+static std::string machine_name()
+{
+    char name[256] = "";
+#ifdef _WIN32
+    const char* env = getenv("COMPUTERNAME");
+    snprintf(name, sizeof(name), "%s", env ? env : "");
+#else
+    if (gethostname(name, sizeof(name) - 1) != 0)
+        name[0] = '\0';
+#endif
+    std::string safe;
+    for (const char* c = name; *c; ++c)
+        safe += isalnum((unsigned char)*c) || *c == '-' || *c == '_' ? *c : '_';
+    return safe.empty() ? "unknown" : safe;
+}
+
+static bool read_file(const std::string& path, std::string* text)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    char buffer[65536];
+    size_t n;
+    text->clear();
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        text->append(buffer, n);
+    fclose(f);
+    return true;
+}
+
+// --- App runs ---
+
+// One run's per-frame means of each scope, from the profiler's CSV (frame,scope,depth,cpu_ms,gpu_ms)
+static bool read_profile(const std::string& path, int frames, const std::string& prefix, Samples* samples)
+{
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f)
+        return false;
+    const uint32_t warmup = (uint32_t)std::max(10, frames / 10);
+    std::map<std::string, double> cpu, gpu;
+    uint32_t first = UINT32_MAX, last = 0;
+    char line[512];
+    bool header = true;
+    while (fgets(line, sizeof(line), f))
+    {
+        if (header)
+        {
+            header = false;
+            continue;
+        }
+        unsigned frame;
+        char scope[256];
+        int depth;
+        double cpu_ms, gpu_ms;
+        if (sscanf(line, "%u,%255[^,],%d,%lf,%lf", &frame, scope, &depth, &cpu_ms, &gpu_ms) != 5)
+            continue;
+        first = std::min(first, (uint32_t)frame);
+        if (frame - first < warmup)
+            continue;
+        last = std::max(last, (uint32_t)frame);
+        cpu[scope] += cpu_ms;
+        gpu[scope] += gpu_ms;
+    }
+    fclose(f);
+    if (cpu.empty())
+        return false;
+    // The CSV lags the frames by the profiler's queries, so count the frames it holds, not the ones asked for
+    const double counted = (double)(last - first - warmup + 1);
+    for (const auto& it : cpu)
+    {
+        (*samples)[prefix + it.first + "/cpu_ms"].push_back(it.second / counted);
+        (*samples)[prefix + it.first + "/gpu_ms"].push_back(gpu[it.first] / counted);
+    }
+    return true;
+}
+
+static bool run_app(const HarnessOptions* o, const std::string& preset, const std::string& work, Samples* samples)
+{
+    const std::string csv = work + "/profile.csv", log = work + "/app.log";
+    const std::string command = quote(o->app) + " --headless " + std::to_string(o->frames) + " --bench-scene "
+        + quote(preset) + " --profile-csv " + quote(csv) + " > " + quote(log) + " 2>&1";
+    for (int run = 0; run < o->runs; ++run)
+    {
+        printf("  app %s, run %d of %d\n", preset.c_str(), run + 1, o->runs);
+        fflush(stdout);
+        remove(csv.c_str());
+#ifdef _WIN32
+        // cmd.exe drops the outer quotes of a command line that starts with one
+        const int status = system(("\"" + command + "\"").c_str());
+#else
+        const int status = system(command.c_str());
+#endif
+        if (status != 0 || !read_profile(csv, o->frames, "app/" + preset + "/", samples))
+        {
+            fprintf(stderr, "perf_harness: %s --bench-scene %s failed (status %d); its output is in %s\n", o->app,
+                preset.c_str(), status, log.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- linmath_bench runs ---
+
+static bool run_linmath(const HarnessOptions* o, Samples* samples)
+{
+    std::string command = quote(o->linmath) + " --json --min-time 50 --batch 1 --batch 1024";
+    if (o->linmath_filter)
+        command += " --filter " + quote(o->linmath_filter);
+#ifdef _WIN32
+    command = "\"" + command + "\"";
+#endif
+    for (int run = 0; run < o->runs; ++run)
+    {
+        printf("  linmath_bench, run %d of %d\n", run + 1, o->runs);
+        fflush(stdout);
+        FILE* pipe = popen(command.c_str(), "r");
+        if (!pipe)
+        {
+            fprintf(stderr, "perf_harness: can't run %s\n", o->linmath);
+            return false;
+        }
+        std::string text;
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+            text.append(buffer, n);
+        const int status = pclose(pipe);
+        JsonDocument doc;
+        const bool parsed = status == 0 && json_parse(&doc, text.data(), text.size());
+        const JsonValue* results = parsed ? json_member(&doc, json_root(&doc), "results") : NULL;
+        if (!results)
+        {
+            fprintf(stderr, "perf_harness: %s failed (status %d)%s%s\n", o->linmath, status, parsed ? "" : ": ",
+                parsed ? "" : doc.error);
+            json_free(&doc);
+            return false;
+        }
+        for (uint32_t i = 0; i < results->count; ++i)
+        {
+            const JsonValue* r = json_at(&doc, results, i);
+            const std::string name = std::string("linmath/") + json_member_string(&doc, r, "op", "?") + "/"
+                + std::to_string((long long)json_member_number(&doc, r, "batch", 0));
+            (*samples)[name].push_back(json_member_number(&doc, r, "ns_per_op", 0.0));
+        }
+        json_free(&doc);
+    }
+    return true;
+}
+
+// --- Baselines ---
+
+static bool read_baseline(const std::string& path, std::map<std::string, PerfSummary>* baseline)
+{
+    std::string text;
+    if (!read_file(path, &text))
+        return false;
+    JsonDocument doc;
+    const JsonValue* metrics = json_parse(&doc, text.data(), text.size())
+        ? json_member(&doc, json_root(&doc), "metrics") : NULL;
+    if (!metrics)
+    {
+        fprintf(stderr, "perf_harness: %s isn't a baseline%s%s\n", path.c_str(), doc.error[0] ? ": " : "", doc.error);
+        json_free(&doc);
+        return false;
+    }
+    for (uint32_t i = 0; i < metrics->count; ++i)
+    {
+        const JsonValue* m = json_at(&doc, metrics, i);
+        PerfSummary s;
+        s.n = (uint32_t)json_member_number(&doc, m, "n", 0);
+        s.mean = json_member_number(&doc, m, "mean", 0.0);
+        s.stddev = json_member_number(&doc, m, "stddev", 0.0);
+        (*baseline)[json_key(&doc, m)] = s;
+    }
+    json_free(&doc);
+    return true;
+}
+
+static void write_json_string(FILE* f, const std::string& s)
+{
+    fputc('"', f);
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            fputc('\\', f);
+        fputc((unsigned char)c < 0x20 ? ' ' : c, f);
+    }
+    fputc('"', f);
+}
+
+static void write_summary(FILE* f, const PerfSummary* s)
+{
+    fprintf(f, "{ \"n\": %u, \"mean\": %.9g, \"stddev\": %.9g }", s->n, s->mean, s->stddev);
+}
+
+static bool write_baseline(const std::string& path, const std::string& machine,
+    const std::map<std::string, PerfSummary>& baseline)
+{
+    const std::string temporary = path + ".tmp";
+    FILE* f = fopen(temporary.c_str(), "w");
+    if (!f)
+    {
+        fprintf(stderr, "perf_harness: can't write %s\n", temporary.c_str());
+        return false;
+    }
+    fprintf(f, "{\n  \"machine\": ");
+    write_json_string(f, machine);
+    fprintf(f, ",\n  \"metrics\": {");
+    bool first = true;
+    for (const auto& it : baseline)
+    {
+        fprintf(f, "%s\n    ", first ? "" : ",");
+        write_json_string(f, it.first);
+        fprintf(f, ": ");
+        write_summary(f, &it.second);
+        first = false;
+    }
+    fprintf(f, "\n  }\n}\n");
+    const bool ok = fclose(f) == 0;
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (!ok || ec)
+    {
+        fprintf(stderr, "perf_harness: can't write %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// --- Reports ---
+
+static int verdict_order(const MetricResult& r)
+{
+    return r.comparison.verdict == PERF_REGRESSED ? 0 : r.comparison.verdict == PERF_IMPROVED ? 1 : 2;
+}
+
+static bool write_report_json(const std::string& path, const HarnessOptions* o, const std::vector<MetricResult>& results,
+    int regressions)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    fprintf(f, "{\n  \"machine\": ");
+    write_json_string(f, o->machine);
+    fprintf(f, ",\n  \"runs\": %d,\n  \"confidence\": %g,\n  \"threshold\": %g,\n  \"regressions\": %d,\n"
+        "  \"metrics\": [", o->runs, o->confidence, o->threshold, regressions);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const MetricResult* r = &results[i];
+        fprintf(f, "%s\n    { \"name\": ", i ? "," : "");
+        write_json_string(f, r->name);
+        fprintf(f, ", \"current\": ");
+        write_summary(f, &r->current);
+        fprintf(f, ", \"current_ci\": %.9g", perf_interval(&r->current, o->confidence));
+        if (r->baseline.n)
+        {
+            fprintf(f, ", \"baseline\": ");
+            write_summary(f, &r->baseline);
+            fprintf(f, ", \"baseline_ci\": %.9g, \"change\": %.6f, \"t\": %.4f, \"verdict\": \"%s\"",
+                perf_interval(&r->baseline, o->confidence), r->comparison.change,
+                isfinite(r->comparison.t) ? r->comparison.t : (r->comparison.t > 0 ? 1e9 : -1e9),
+                r->floored ? "floored" : perf_verdict_name(r->comparison.verdict));
+        }
+        fprintf(f, " }");
+    }
+    fprintf(f, "\n  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+static bool write_report_html(const std::string& path, const HarnessOptions* o, const std::vector<MetricResult>& results,
+    int regressions)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    fprintf(f, "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>Performance report: %s</title>\n"
+        "<style>body{font-family:sans-serif}table{border-collapse:collapse}td,th{padding:2px 8px;text-align:right}"
+        "td:first-child{text-align:left;font-family:monospace}tr.regressed{background:#fcc}tr.improved{background:#cfc}"
+        "tr.none{color:#888}</style></head><body>\n", o->machine.c_str());
+    fprintf(f, "<h1>%s: %d regression%s</h1>\n<p>%d runs each, %g%% confidence, changes under %g%% ignored, "
+        "scopes under %g ms floored. Times in ms (app) or ns/op (linmath), &plusmn; the confidence interval.</p>\n",
+        o->machine.c_str(), regressions, regressions == 1 ? "" : "s", o->runs, 100.0 * o->confidence,
+        100.0 * o->threshold, o->floor_ms);
+    fprintf(f, "<table>\n<tr><th>metric</th><th>baseline</th><th>current</th><th>change</th><th>t</th>"
+        "<th>verdict</th></tr>\n");
+    for (const MetricResult& r : results)
+    {
+        const char* verdict = !r.baseline.n ? "none" : r.floored ? "floored" : perf_verdict_name(r.comparison.verdict);
+        fprintf(f, "<tr class=\"%s\"><td>%s</td>", verdict, r.name.c_str());
+        if (r.baseline.n)
+            fprintf(f, "<td>%.4f &plusmn; %.4f</td>", r.baseline.mean, perf_interval(&r.baseline, o->confidence));
+        else
+            fprintf(f, "<td></td>");
+        fprintf(f, "<td>%.4f &plusmn; %.4f</td>", r.current.mean, perf_interval(&r.current, o->confidence));
+        if (r.baseline.n)
+            fprintf(f, "<td>%+.1f%%</td><td>%.2f</td><td>%s</td></tr>\n", 100.0 * r.comparison.change,
+                r.comparison.t, verdict);
+        else
+            fprintf(f, "<td></td><td></td><td>no baseline</td></tr>\n");
+    }
+    fprintf(f, "</table>\n</body></html>\n");
+    return fclose(f) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    HarnessOptions o;
+    o.app = NULL;
+    o.linmath = NULL;
+    o.runs = 5;
+    o.frames = 300;
+    o.linmath_filter = NULL;
+    o.baselines = "perf_baselines";
+    o.update_baseline = false;
+    o.report = NULL;
+    o.confidence = 0.99;
+    o.threshold = 0.05;
+    o.floor_ms = 0.02;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--app") && i + 1 < argc)
+            o.app = argv[++i];
+        else if (!strcmp(argv[i], "--linmath") && i + 1 < argc)
+            o.linmath = argv[++i];
+        else if (!strcmp(argv[i], "--runs") && i + 1 < argc)
+            o.runs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+            o.frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--preset") && i + 1 < argc)
+            o.presets.push_back(argv[++i]);
+        else if (!strcmp(argv[i], "--linmath-filter") && i + 1 < argc)
+            o.linmath_filter = argv[++i];
+        else if (!strcmp(argv[i], "--baselines") && i + 1 < argc)
+            o.baselines = argv[++i];
+        else if (!strcmp(argv[i], "--machine") && i + 1 < argc)
+            o.machine = argv[++i];
+        else if (!strcmp(argv[i], "--update-baseline"))
+            o.update_baseline = true;
+        else if (!strcmp(argv[i], "--report") && i + 1 < argc)
+            o.report = argv[++i];
+        else if (!strcmp(argv[i], "--confidence") && i + 1 < argc)
+            o.confidence = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--threshold") && i + 1 < argc)
+            o.threshold = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--floor") && i + 1 < argc)
+            o.floor_ms = atof(argv[++i]);
+        else
+            fprintf(stderr, "Warning: unknown argument %s ignored\n", argv[i]);
+    }
+    if ((!o.app && !o.linmath) || o.runs < 2 || o.frames < 20)
+    {
+        fprintf(stderr, "usage: perf_harness [--app PATH] [--linmath PATH] [--runs N (2+)] [--frames N (20+)] "
+                        "[--preset SPEC]... [--linmath-filter S] [--baselines DIR] [--machine NAME] "
+                        "[--update-baseline] [--report PREFIX] [--confidence 0.95|0.99] [--threshold F] [--floor MS]\n");
+        return 2;
+    }
+    if (o.presets.empty())
+        o.presets = { "10k-static", "100k-static", "100k-dynamic-hierarchy" };
+    if (o.machine.empty())
+        o.machine = machine_name();
+    const std::string baseline_path = o.baselines + "/" + o.machine + ".json";
+
+    std::error_code ec;
+    const std::string work = (std::filesystem::temp_directory_path(ec) / ("perf_harness_" + o.machine)).string();
+    std::filesystem::create_directories(work, ec);
+    if (ec)
+    {
+        fprintf(stderr, "perf_harness: can't create %s: %s\n", work.c_str(), ec.message().c_str());
+        return 2;
+    }
+
+    const double start = now_ms();
+    Samples samples;
+    printf("perf_harness: %s, %d runs each\n", o.machine.c_str(), o.runs);
+    bool ran = true;
+    if (o.app)
+        for (const std::string& preset : o.presets)
+            ran = ran && run_app(&o, preset, work, &samples);
+    if (o.linmath && ran)
+        ran = run_linmath(&o, &samples);
+    if (!ran)
+        return 2;
+
+    std::map<std::string, PerfSummary> baseline;
+    const bool have_baseline = std::filesystem::exists(baseline_path, ec);
+    if (have_baseline && !read_baseline(baseline_path, &baseline))
+        return 2;
+
+    std::vector<MetricResult> results;
+    int regressions = 0, improvements = 0;
+    for (const auto& it : samples)
+    {
+        MetricResult r;
+        r.name = it.first;
+        perf_summarise(&r.current, it.second.data(), (uint32_t)it.second.size());
+        const auto found = baseline.find(it.first);
+        r.baseline = found != baseline.end() ? found->second : PerfSummary{ 0, 0.0, 0.0 };
+        perf_compare(&r.baseline, &r.current, o.confidence, o.threshold, &r.comparison);
+        r.floored = r.name.compare(0, 4, "app/") == 0 && r.baseline.mean < o.floor_ms && r.current.mean < o.floor_ms;
+        if (r.floored)
+            r.comparison.verdict = PERF_SAME;
+        regressions += r.comparison.verdict == PERF_REGRESSED;
+        improvements += r.comparison.verdict == PERF_IMPROVED;
+        results.push_back(r);
+    }
+    std::stable_sort(results.begin(), results.end(),
+        [](const MetricResult& a, const MetricResult& b) { return verdict_order(a) < verdict_order(b); });
+
+    for (const MetricResult& r : results)
+    {
+        if (r.comparison.verdict == PERF_SAME)
+            continue;
+        printf("  %-9s %-60s %10.4f -> %10.4f (%+.1f%%, t %.1f)\n", perf_verdict_name(r.comparison.verdict),
+            r.name.c_str(), r.baseline.mean, r.current.mean, 100.0 * r.comparison.change, r.comparison.t);
+    }
+    printf("perf_harness: %zu metrics, %d regressed, %d improved, %.1f s\n", results.size(), regressions,
+        improvements, (now_ms() - start) / 1000.0);
+
+    if (o.report)
+    {
+        const std::string json = std::string(o.report) + ".json", html = std::string(o.report) + ".html";
+        if (!write_report_json(json, &o, results, regressions) || !write_report_html(html, &o, results, regressions))
+        {
+            fprintf(stderr, "perf_harness: can't write the report to %s\n", o.report);
+            return 2;
+        }
+        printf("perf_harness: report in %s and %s\n", json.c_str(), html.c_str());
+    }
+
+    if (o.update_baseline)
+    {
+        std::filesystem::create_directories(o.baselines, ec);
+        for (const MetricResult& r : results)
+            baseline[r.name] = r.current;
+        if (!write_baseline(baseline_path, o.machine, baseline))
+            return 2;
+        printf("perf_harness: baseline %s updated\n", baseline_path.c_str());
+        return 0;
+    }
+    if (!have_baseline)
+    {
+        printf("perf_harness: no baseline for %s yet; record one with --update-baseline\n", o.machine.c_str());
+        return 0;
+    }
+    return regressions ? 1 : 0;
+}